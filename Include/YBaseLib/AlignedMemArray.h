@@ -1,11 +1,12 @@
 #pragma once
+#include "YBaseLib/Allocator.h"
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Common.h"
 #include "YBaseLib/Memory.h"
 
 // array class suitable for POD types (int, float, etc), or simple structs with no dependance on memory location
-template<class T, int ALIGNMENT = 16>
-class AlignedMemArray
+template<class T, int ALIGNMENT = 16, class AllocatorType = HeapAllocator>
+class AlignedMemArray : private AllocatorType
 {
 public:
   static_assert((sizeof(T) % ALIGNMENT) == 0, "size of T must be divisable by ALIGNMENT");
@@ -16,20 +17,30 @@ public:
     m_uSize = m_uReserve = 0;
   }
 
-  AlignedMemArray(uint32 nReserve)
+  explicit AlignedMemArray(const AllocatorType& allocator) : AllocatorType(allocator)
   {
     m_pElements = NULL;
     m_uSize = m_uReserve = 0;
   }
 
-  AlignedMemArray(const AlignedMemArray& c)
+  AlignedMemArray(uint32 nReserve, const AllocatorType& allocator = AllocatorType()) : AllocatorType(allocator)
+  {
+    m_pElements = NULL;
+    m_uSize = m_uReserve = 0;
+  }
+
+  AlignedMemArray(const AlignedMemArray& c) : AllocatorType(c.GetAllocator())
   {
     m_pElements = NULL;
     m_uSize = m_uReserve = 0;
     Copy(c);
   }
 
-  ~AlignedMemArray() { Y_aligned_free(m_pElements); }
+  ~AlignedMemArray() { FreeElements(); }
+
+  // allocator the elements come from, copies of the array share a copy of it
+  const AllocatorType& GetAllocator() const { return *this; }
+  AllocatorType& GetAllocator() { return *this; }
 
   void Clear()
   {
@@ -53,6 +64,7 @@ public:
     ::Swap(m_pElements, c.m_pElements);
     ::Swap(m_uSize, c.m_uSize);
     ::Swap(m_uReserve, c.m_uReserve);
+    ::Swap(GetAllocator(), c.GetAllocator());
   }
 
   void Obliterate()
@@ -61,7 +73,7 @@ public:
       return;
 
     Clear();
-    Y_aligned_free(m_pElements);
+    FreeElements();
     m_pElements = NULL;
     m_uReserve = 0;
   }
@@ -79,21 +91,9 @@ public:
     if (m_uReserve >= nElements)
       return;
 
-    if (m_pElements != NULL)
-    {
-      T* pNewElements = (T*)Y_aligned_malloc(sizeof(T) * nElements, ALIGNMENT);
-      Assert(pNewElements != NULL);
-      if (m_uSize > 0)
-        std::memcpy(pNewElements, m_pElements, sizeof(T) * m_uSize);
-
-      Y_aligned_free(m_pElements);
-      m_pElements = pNewElements;
-    }
-    else
-    {
-      m_pElements = (T*)Y_aligned_malloc(sizeof(T) * nElements, ALIGNMENT);
-      Assert(m_pElements != NULL);
-    }
+    m_pElements =
+      (T*)GetAllocator().Reallocate(m_pElements, sizeof(T) * m_uReserve, sizeof(T) * nElements, ALIGNMENT);
+    Assert(m_pElements != NULL);
     m_uReserve = nElements;
   }
 
@@ -121,18 +121,15 @@ public:
     // if reserve > size, resize down to size
     if (m_uSize == 0)
     {
-      Y_aligned_free(m_pElements);
+      FreeElements();
       m_pElements = NULL;
       m_uReserve = 0;
     }
     else if (m_uReserve > m_uSize)
     {
-      // m_pElements = (T *)Y_aligned_realloc(m_pElements, SIZEOF_T * m_uSize, ALIGNMENT);
-      T* pNewElements = (T*)Y_aligned_malloc(sizeof(T) * m_uSize, ALIGNMENT);
-      Assert(pNewElements != NULL);
-      std::memcpy(pNewElements, m_pElements, sizeof(T) * m_uSize);
-      Y_aligned_free(m_pElements);
-      m_pElements = pNewElements;
+      m_pElements =
+        (T*)GetAllocator().Reallocate(m_pElements, sizeof(T) * m_uReserve, sizeof(T) * m_uSize, ALIGNMENT);
+      Assert(m_pElements != NULL);
       m_uReserve = m_uSize;
     }
   }
@@ -141,7 +138,7 @@ public:
   {
     // autosize
     if (m_uSize == m_uReserve)
-      Reserve(Max(m_uSize + 1, m_uSize * 2));
+      Reserve(Y_GetArrayGrowthSize(m_uSize, m_uSize + 1));
 
     std::memcpy(m_pElements + m_uSize, &value, sizeof(T));
     m_uSize++;
@@ -188,6 +185,7 @@ public:
     }
   }
 
+  // the caller takes ownership of the elements, they must be freed through the same allocator
   void DetachArray(T** pBasePointer, uint32* pSize)
   {
     DebugAssert(pBasePointer != NULL && pSize != NULL);
@@ -218,19 +216,25 @@ public:
   T* GetBasePointer() { return m_pElements; }
 
   // assignment operator
-  AlignedMemArray<T, ALIGNMENT>& operator=(const AlignedMemArray<T, ALIGNMENT>& c)
+  AlignedMemArray& operator=(const AlignedMemArray& c)
   {
-    Assign(c);
+    Copy(c);
     return *this;
   }
 
   // operator wrappers
-  bool operator==(const AlignedMemArray<T, ALIGNMENT>& c) const { return Equals(c); }
-  bool operator!=(const AlignedMemArray<T, ALIGNMENT>& c) const { return !Equals(c); }
+  bool operator==(const AlignedMemArray& c) const { return Equals(c); }
+  bool operator!=(const AlignedMemArray& c) const { return !Equals(c); }
   const T& operator[](uint32 index) const { return GetElement(index); }
   T& operator[](uint32 index) { return GetElement(index); }
 
 private:
+  void FreeElements()
+  {
+    if (m_pElements != NULL)
+      GetAllocator().Free(m_pElements, sizeof(T) * m_uReserve, ALIGNMENT);
+  }
+
   T* m_pElements;
   uint32 m_uSize;
   uint32 m_uReserve;
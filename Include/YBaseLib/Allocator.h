@@ -0,0 +1,314 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Memory.h"
+
+// Allocators for the container classes. An allocator is any copyable class with these members:
+//   void* Allocate(size_t size, size_t alignment);
+//   void* Reallocate(void* pMemory, size_t oldSize, size_t newSize, size_t alignment);
+//   void Free(void* pMemory, size_t size, size_t alignment);
+// Containers keep a copy of their allocator, so stateful allocators should be a small handle onto the real
+// storage, like ArenaAllocator. Empty allocators cost nothing, the containers store them as a base class.
+// PoolAllocator is the exception, it is meant to be owned by a single node-based container.
+
+// the default, goes to Y_malloc and friends, which are the C heap unless Y_THREAD_CACHED_MALLOC is set
+class HeapAllocator
+{
+public:
+  // alignment malloc guarantees on every platform we target
+  static const size_t MallocAlignment = 2 * sizeof(void*);
+
+  void* Allocate(size_t size, size_t alignment)
+  {
+    return (alignment <= MallocAlignment) ? Y_malloc(size) : Y_aligned_malloc(size, alignment);
+  }
+
+  void* Reallocate(void* pMemory, size_t oldSize, size_t newSize, size_t alignment)
+  {
+    if (alignment <= MallocAlignment)
+      return Y_realloc(pMemory, newSize);
+
+    void* pNewMemory = Y_aligned_malloc(newSize, alignment);
+    if (pNewMemory != NULL && pMemory != NULL)
+    {
+      std::memcpy(pNewMemory, pMemory, Min(oldSize, newSize));
+      Y_aligned_free(pMemory);
+    }
+
+    return pNewMemory;
+  }
+
+  void Free(void* pMemory, size_t size, size_t alignment)
+  {
+    if (alignment <= MallocAlignment)
+      Y_free(pMemory);
+    else
+      Y_aligned_free(pMemory);
+  }
+};
+
+// HeapAllocator with Y_MALLOC_FLAGS, for the big tables and buffers worth backing with huge pages or keeping on one
+// NUMA node, e.g. AlignedMemArray<T, 16, FlaggedHeapAllocator> table(FlaggedHeapAllocator(Y_MALLOC_FLAG_HUGE_PAGES)).
+class FlaggedHeapAllocator
+{
+public:
+  FlaggedHeapAllocator(uint32 flags = 0) : m_flags(flags) {}
+
+  uint32 GetFlags() const { return m_flags; }
+
+  void* Allocate(size_t size, size_t alignment) { return Y_aligned_malloc_flags(size, alignment, m_flags); }
+
+  // always a fresh allocation, since the heap can move a reallocation to pages the hints never reached
+  void* Reallocate(void* pMemory, size_t oldSize, size_t newSize, size_t alignment)
+  {
+    void* pNewMemory = Y_aligned_malloc_flags(newSize, alignment, m_flags);
+    if (pNewMemory != NULL && pMemory != NULL)
+    {
+      std::memcpy(pNewMemory, pMemory, Min(oldSize, newSize));
+      Y_aligned_free(pMemory);
+    }
+
+    return pNewMemory;
+  }
+
+  void Free(void* pMemory, size_t size, size_t alignment) { Y_aligned_free(pMemory); }
+
+private:
+  uint32 m_flags;
+};
+
+// Linear allocator, memory is carved out of large blocks and only given back all at once with Reset, which
+// keeps the blocks around for reuse, or back to a marker with Rewind. Meant for per-frame or per-request scratch
+// containers and strings. Not thread safe, each thread has its own scratch arena for temporary work. Blocks are
+// allocated with allocationFlags, Y_MALLOC_FLAGS, which only reach blocks big enough to span whole pages.
+class MemoryArena
+{
+  struct Block;
+
+public:
+  // position in the arena to rewind to, everything allocated after it is released
+  struct Marker
+  {
+    Block* pBlock;
+    size_t Used;
+  };
+
+  MemoryArena(size_t blockSize = 65536, uint32 allocationFlags = 0);
+  ~MemoryArena();
+
+  // arena belonging to the calling thread, created on first use and freed when the thread exits.
+  // ReleaseThreadScratchArena frees it early.
+  static MemoryArena& GetThreadScratchArena();
+  static void ReleaseThreadScratchArena();
+
+  void* Allocate(size_t size, size_t alignment);
+
+  // grows or shrinks the most recent allocation in place, fails if something has been allocated since
+  bool TryResize(void* pMemory, size_t oldSize, size_t newSize);
+
+  // gives the memory back if it was the most recent allocation, otherwise it stays used until Reset
+  void Release(void* pMemory, size_t size);
+
+  // releases every allocation, invalidating anything still pointing into the arena
+  void Reset();
+
+  // releases everything allocated since the marker was taken, which must be from this arena
+  Marker GetMarker() const;
+  void Rewind(const Marker& marker);
+
+  // bytes handed out since the last reset, and bytes held in blocks
+  size_t GetBytesUsed() const;
+  size_t GetMemoryUsage() const { return m_memoryUsage; }
+
+private:
+  struct Block
+  {
+    Block* pNext;
+    size_t Size;
+    size_t Used;
+  };
+
+  static byte* GetBlockData(Block* pBlock) { return reinterpret_cast<byte*>(pBlock + 1); }
+
+  Block* m_pFirstBlock;
+  Block* m_pCurrentBlock;
+  size_t m_blockSize;
+  size_t m_memoryUsage;
+  uint32 m_allocationFlags;
+
+  DeclareNonCopyable(MemoryArena);
+};
+
+// rewinds an arena to where it was when constructed, for scoped scratch allocations
+class ScopedArenaRewind
+{
+public:
+  ScopedArenaRewind(MemoryArena& arena) : m_arena(arena), m_marker(arena.GetMarker()) {}
+  ~ScopedArenaRewind() { m_arena.Rewind(m_marker); }
+
+  MemoryArena& GetArena() const { return m_arena; }
+
+private:
+  MemoryArena& m_arena;
+  MemoryArena::Marker m_marker;
+
+  DeclareNonCopyable(ScopedArenaRewind);
+};
+
+// container allocator that takes its memory from a MemoryArena, the arena must outlive the container
+class ArenaAllocator
+{
+public:
+  ArenaAllocator() : m_pArena(NULL) {}
+  ArenaAllocator(MemoryArena* pArena) : m_pArena(pArena) {}
+
+  MemoryArena* GetArena() const { return m_pArena; }
+
+  void* Allocate(size_t size, size_t alignment)
+  {
+    DebugAssert(m_pArena != NULL);
+    return m_pArena->Allocate(size, alignment);
+  }
+
+  void* Reallocate(void* pMemory, size_t oldSize, size_t newSize, size_t alignment)
+  {
+    DebugAssert(m_pArena != NULL);
+    if (pMemory != NULL && m_pArena->TryResize(pMemory, oldSize, newSize))
+      return pMemory;
+
+    void* pNewMemory = m_pArena->Allocate(newSize, alignment);
+    if (pMemory != NULL)
+    {
+      std::memcpy(pNewMemory, pMemory, Min(oldSize, newSize));
+      m_pArena->Release(pMemory, oldSize);
+    }
+
+    return pNewMemory;
+  }
+
+  void Free(void* pMemory, size_t size, size_t alignment)
+  {
+    if (pMemory != NULL)
+      m_pArena->Release(pMemory, size);
+  }
+
+private:
+  MemoryArena* m_pArena;
+};
+
+// Node pool for containers that allocate lots of small blocks one at a time, like LinkedList and the hash tables.
+// Blocks are bump allocated out of slabs in size classes of PoolGranularity bytes, and freed blocks go on a free
+// list for their class, so a long-lived container reuses its own memory instead of scattering nodes across the
+// heap. Blocks over MaxBlockSize or aligned past PoolGranularity, such as bucket arrays, go to HeapAllocator.
+// Slabs are only released when the pool is destroyed. Not thread safe.
+// Unlike the other allocators this one owns its storage: copying it gives an empty pool with the same slab size,
+// so a copied container gets a pool of its own, and assigning one is a no-op. Moving takes the slabs with it,
+// which is how the containers' Compact() swaps in a freshly packed pool.
+class PoolAllocator
+{
+public:
+  static const size_t PoolGranularity = 16;
+  static const size_t MaxBlockSize = 256;
+
+  PoolAllocator(size_t slabSize = 16384);
+  PoolAllocator(const PoolAllocator& copy);
+  PoolAllocator(PoolAllocator&& from);
+  ~PoolAllocator();
+
+  PoolAllocator& operator=(const PoolAllocator&) { return *this; }
+  PoolAllocator& operator=(PoolAllocator&& from);
+
+  void* Allocate(size_t size, size_t alignment)
+  {
+    if (!IsPooled(size, alignment))
+      return HeapAllocator().Allocate(size, alignment);
+
+    size_t sizeClass = GetSizeClass(size);
+    FreeBlock* pBlock = m_pFreeLists[sizeClass];
+    m_liveBlockCount++;
+    if (pBlock != NULL)
+    {
+      m_pFreeLists[sizeClass] = pBlock->pNext;
+      return pBlock;
+    }
+
+    size_t blockSize = (sizeClass + 1) * PoolGranularity;
+    if ((size_t)(m_pSlabEnd - m_pSlabCurrent) < blockSize)
+      AllocateSlab();
+
+    void* pMemory = m_pSlabCurrent;
+    m_pSlabCurrent += blockSize;
+    return pMemory;
+  }
+
+  void* Reallocate(void* pMemory, size_t oldSize, size_t newSize, size_t alignment)
+  {
+    bool oldPooled = (pMemory != NULL && IsPooled(oldSize, alignment));
+    bool newPooled = IsPooled(newSize, alignment);
+    if (oldPooled && newPooled && GetSizeClass(oldSize) == GetSizeClass(newSize))
+      return pMemory;
+    if ((pMemory == NULL || !oldPooled) && !newPooled)
+      return HeapAllocator().Reallocate(pMemory, oldSize, newSize, alignment);
+
+    void* pNewMemory = Allocate(newSize, alignment);
+    if (pMemory != NULL)
+    {
+      std::memcpy(pNewMemory, pMemory, Min(oldSize, newSize));
+      Free(pMemory, oldSize, alignment);
+    }
+
+    return pNewMemory;
+  }
+
+  void Free(void* pMemory, size_t size, size_t alignment)
+  {
+    if (pMemory == NULL)
+      return;
+
+    if (!IsPooled(size, alignment))
+    {
+      HeapAllocator().Free(pMemory, size, alignment);
+      return;
+    }
+
+    DebugAssert(m_liveBlockCount > 0);
+    size_t sizeClass = GetSizeClass(size);
+    FreeBlock* pBlock = reinterpret_cast<FreeBlock*>(pMemory);
+    pBlock->pNext = m_pFreeLists[sizeClass];
+    m_pFreeLists[sizeClass] = pBlock;
+    m_liveBlockCount--;
+  }
+
+  size_t GetSlabSize() const { return m_slabSize; }
+
+  // pooled blocks currently allocated, and bytes held in slabs
+  size_t GetLiveBlockCount() const { return m_liveBlockCount; }
+  size_t GetMemoryUsage() const { return m_memoryUsage; }
+
+private:
+  static const size_t SizeClassCount = MaxBlockSize / PoolGranularity;
+
+  struct FreeBlock
+  {
+    FreeBlock* pNext;
+  };
+
+  struct Slab
+  {
+    Slab* pNext;
+  };
+
+  static bool IsPooled(size_t size, size_t alignment) { return (size <= MaxBlockSize && alignment <= PoolGranularity); }
+  static size_t GetSizeClass(size_t size) { return (size > 0) ? ((size - 1) / PoolGranularity) : 0; }
+
+  void AllocateSlab();
+  void ReleaseSlabs();
+
+  FreeBlock* m_pFreeLists[SizeClassCount];
+  Slab* m_pFirstSlab;
+  byte* m_pSlabCurrent;
+  byte* m_pSlabEnd;
+  size_t m_slabSize;
+  size_t m_liveBlockCount;
+  size_t m_memoryUsage;
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "YBaseLib/Common.h"
+#include "YBaseLib/LockProfiler.h"
 #include <pthread.h>
 
 class ReadWriteLock
@@ -20,6 +21,20 @@ public:
 
   void UpgradeSharedLockToExclusive();
 
+  // counts this lock under name with LockProfiler, when built with Y_LOCK_PROFILING
+  void SetProfileName(const char* name)
+  {
+#if Y_LOCK_PROFILING
+    m_profile.SetName(name);
+#else
+    UNREFERENCED_PARAMETER(name);
+#endif
+  }
+
 private:
   pthread_rwlock_t m_ReadWriteLock;
+
+#if Y_LOCK_PROFILING
+  LockProfile m_profile;
+#endif
 };
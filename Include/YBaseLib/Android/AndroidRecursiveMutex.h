@@ -1,6 +1,7 @@
 #pragma once
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Common.h"
+#include "YBaseLib/LockProfiler.h"
 #include <pthread.h>
 
 class RecursiveMutex
@@ -19,12 +20,53 @@ public:
 
   ~RecursiveMutex() { pthread_mutex_destroy(&m_Mutex); }
 
-  void Lock() { pthread_mutex_lock(&m_Mutex); }
+  void Lock()
+  {
+#if Y_LOCK_PROFILING
+    if (m_profile.IsEnabled())
+    {
+      m_profile.Acquire([this]() { return (pthread_mutex_trylock(&m_Mutex) == 0); },
+                        [this]() { pthread_mutex_lock(&m_Mutex); });
+      return;
+    }
+#endif
+
+    pthread_mutex_lock(&m_Mutex);
+  }
+
+  bool TryLock()
+  {
+    if (pthread_mutex_trylock(&m_Mutex) != 0)
+      return false;
+
+#if Y_LOCK_PROFILING
+    m_profile.OnTryAcquired();
+#endif
+    return true;
+  }
 
-  bool TryLock() { return (pthread_mutex_trylock(&m_Mutex) == 0); }
+  void Unlock()
+  {
+#if Y_LOCK_PROFILING
+    m_profile.Release();
+#endif
+    pthread_mutex_unlock(&m_Mutex);
+  }
 
-  void Unlock() { pthread_mutex_unlock(&m_Mutex); }
+  // counts this lock under name with LockProfiler, when built with Y_LOCK_PROFILING
+  void SetProfileName(const char* name)
+  {
+#if Y_LOCK_PROFILING
+    m_profile.SetName(name);
+#else
+    UNREFERENCED_PARAMETER(name);
+#endif
+  }
 
 private:
   pthread_mutex_t m_Mutex;
+
+#if Y_LOCK_PROFILING
+  LockProfile m_profile;
+#endif
 };
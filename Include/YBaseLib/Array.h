@@ -1,13 +1,15 @@
 #pragma once
 
+#include "YBaseLib/Allocator.h"
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Common.h"
 #include "YBaseLib/Memory.h"
+#include "YBaseLib/RelocationTrait.h"
 #include <new>
 
 // array class suitable for any data type including classes
-template<class T>
-class Array
+template<class T, class AllocatorType = HeapAllocator>
+class Array : private AllocatorType
 {
 public:
   Array()
@@ -16,20 +18,26 @@ public:
     m_size = m_reserve = 0;
   }
 
-  Array(uint32 nReserve)
+  explicit Array(const AllocatorType& allocator) : AllocatorType(allocator)
   {
     m_pElements = NULL;
     m_size = m_reserve = 0;
   }
 
-  Array(const Array& c)
+  Array(uint32 nReserve, const AllocatorType& allocator = AllocatorType()) : AllocatorType(allocator)
+  {
+    m_pElements = NULL;
+    m_size = m_reserve = 0;
+  }
+
+  Array(const Array& c) : AllocatorType(c.GetAllocator())
   {
     m_pElements = NULL;
     m_size = m_reserve = 0;
     Assign(c);
   }
 
-  Array(Array&& c)
+  Array(Array&& c) : AllocatorType(c.GetAllocator())
   {
     m_pElements = c.m_pElements;
     m_size = c.m_size;
@@ -45,9 +53,13 @@ public:
     for (i = 0; i < m_size; i++)
       _Destruct(i);
 
-    std::free(m_pElements);
+    FreeElements(m_pElements, m_reserve);
   }
 
+  // allocator the elements come from, copies of the array share a copy of it
+  const AllocatorType& GetAllocator() const { return *this; }
+  AllocatorType& GetAllocator() { return *this; }
+
   void Clear()
   {
     if (m_pElements == NULL)
@@ -59,7 +71,7 @@ public:
     m_size = 0;
   }
 
-  void Assign(const Array<T>& c)
+  void Assign(const Array& c)
   {
     uint32 i;
 
@@ -73,7 +85,7 @@ public:
     m_size = c.m_size;
   }
 
-  bool Equals(const Array<T>& c) const
+  bool Equals(const Array& c) const
   {
     if (c.m_size != m_size)
       return false;
@@ -93,16 +105,7 @@ public:
     if (m_reserve >= nElements)
       return;
 
-    uint32 i;
-    T* pOldElements = m_pElements;
-    m_pElements = (T*)Y_mallocarray(sizeof(T), nElements);
-    Assert(m_pElements != NULL);
-    m_reserve = nElements;
-
-    for (i = 0; i < m_size; i++)
-      _Construct(i, pOldElements[i]);
-
-    std::free(pOldElements);
+    Relocate(nElements);
   }
 
   void Shrink()
@@ -112,20 +115,11 @@ public:
 
     if (m_size > 0)
     {
-      uint32 i;
-      T* pOldElements = m_pElements;
-      m_pElements = (T*)Y_mallocarray(sizeof(T), m_size);
-      Assert(m_pElements != NULL);
-      m_reserve = m_size;
-
-      for (i = 0; i < m_size; i++)
-        _Construct(i, pOldElements[i]);
-
-      std::free(pOldElements);
+      Relocate(m_size);
     }
     else
     {
-      std::free(m_pElements);
+      FreeElements(m_pElements, m_reserve);
       m_pElements = NULL;
       m_reserve = 0;
     }
@@ -138,8 +132,8 @@ public:
     {
       while (m_size > newSize)
       {
-        _Destruct(m_size);
         m_size--;
+        _Destruct(m_size);
       }
     }
     else
@@ -160,24 +154,35 @@ public:
     ::Swap(m_pElements, s.m_pElements);
     ::Swap(m_size, s.m_size);
     ::Swap(m_reserve, s.m_reserve);
+    ::Swap(GetAllocator(), s.GetAllocator());
   }
 
   void Add(const T& value)
   {
     // autosize
     if (m_size == m_reserve)
-      Reserve(Max(m_size + 1, m_size * 2));
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + 1));
 
     _Construct(m_size, value);
     m_size++;
   }
 
+  void Add(T&& value)
+  {
+    // autosize
+    if (m_size == m_reserve)
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + 1));
+
+    new (&m_pElements[m_size]) T(std::move(value));
+    m_size++;
+  }
+
   template<typename... Args>
   void Emplace(Args... args)
   {
     // autosize
     if (m_size == m_reserve)
-      Reserve(Max(m_size + 1, m_size * 2));
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + 1));
 
     new (&m_pElements[m_size]) T(args...);
     m_size++;
@@ -204,8 +209,7 @@ public:
     {
       // swap end and index elements
       _Destruct(index);
-      _Construct(index, _GetElement(m_size - 1));
-      _Destruct(m_size - 1);
+      RelocateElements(&m_pElements[index], &m_pElements[m_size - 1], 1, TriviallyRelocatable());
       m_size--;
     }
   }
@@ -224,13 +228,9 @@ public:
       // destruct index
       _Destruct(index);
 
-      // loop and move everything from index+1 back one index
-      uint32 i;
-      for (i = index + 1; i < m_size; i++)
-      {
-        _Construct(i - 1, _GetElement(i));
-        _Destruct(i);
-      }
+      // move everything from index+1 back one index
+      RelocateElements(m_pElements + index, m_pElements + index + 1, m_size - index - 1, TriviallyRelocatable());
+      m_size--;
     }
   }
 
@@ -239,7 +239,7 @@ public:
     if (m_pElements != NULL)
     {
       Clear();
-      std::free(m_pElements);
+      FreeElements(m_pElements, m_reserve);
       m_pElements = NULL;
       m_reserve = 0;
     }
@@ -289,7 +289,7 @@ public:
   void EnsureReserve(uint32 n)
   {
     if ((m_size + n) > m_reserve)
-      Reserve(Max(m_size + n, m_size * 2));
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + n));
   }
 
   // exists in array?
@@ -308,20 +308,20 @@ public:
   T* end() { return (m_size > 0) ? &m_pElements[m_size] : m_pElements; }
 
   // assignment operator
-  Array<T>& operator=(const Array<T>& c)
+  Array& operator=(const Array& c)
   {
     Assign(c);
     return *this;
   }
-  Array<T>& operator=(Array<T>&& c)
+  Array& operator=(Array&& c)
   {
     Swap(c);
     return *this;
   }
 
   // operator wrappers
-  bool operator==(const Array<T>& c) const { return Equals(c); }
-  bool operator!=(const Array<T>& c) const { return !Equals(c); }
+  bool operator==(const Array& c) const { return Equals(c); }
+  bool operator!=(const Array& c) const { return !Equals(c); }
   const T& operator[](uint32 index) const { return GetElement(index); }
   T& operator[](uint32 index) { return GetElement(index); }
 
@@ -331,6 +331,63 @@ private:
   uint32 m_reserve;
 
   // helper functions
+  // picked at compile time, so the memcpy paths are never instantiated for types that can't take them
+  typedef std::integral_constant<bool, RelocationTrait<T>::IsTriviallyRelocatable> TriviallyRelocatable;
+
+  // moves the elements into storage for newReserve elements, types that can be moved with memcpy are reallocated
+  // in place, anything else is move constructed across and the originals destroyed
+  void Relocate(uint32 newReserve)
+  {
+    DebugAssert(newReserve >= m_size);
+    Relocate(newReserve, TriviallyRelocatable());
+    m_reserve = newReserve;
+  }
+
+  void Relocate(uint32 newReserve, std::true_type)
+  {
+    m_pElements =
+      (T*)GetAllocator().Reallocate(m_pElements, sizeof(T) * m_reserve, sizeof(T) * newReserve, alignof(T));
+    Assert(m_pElements != NULL);
+  }
+
+  void Relocate(uint32 newReserve, std::false_type)
+  {
+    T* pOldElements = m_pElements;
+    m_pElements = AllocateElements(newReserve);
+    RelocateElements(m_pElements, pOldElements, m_size, std::false_type());
+    FreeElements(pOldElements, m_reserve);
+  }
+
+  // moves count elements to pDestination, leaving the originals destroyed. the ranges may only overlap when
+  // moving to a lower address.
+  static void RelocateElements(T* pDestination, T* pSource, uint32 count, std::true_type)
+  {
+    // a byte copy is what relocation means for these types, hence the casts past -Wclass-memaccess
+    std::memmove(static_cast<void*>(pDestination), static_cast<const void*>(pSource), sizeof(T) * count);
+  }
+
+  static void RelocateElements(T* pDestination, T* pSource, uint32 count, std::false_type)
+  {
+    for (uint32 i = 0; i < count; i++)
+    {
+      new (&pDestination[i]) T(std::move(pSource[i]));
+      pSource[i].~T();
+    }
+  }
+
+  T* AllocateElements(uint32 count)
+  {
+    T* pElements = (T*)GetAllocator().Allocate(sizeof(T) * count, alignof(T));
+    Assert(pElements != NULL);
+    return pElements;
+  }
+
+  void FreeElements(T* pElements, uint32 count)
+  {
+    if (pElements != NULL)
+      GetAllocator().Free(pElements, sizeof(T) * count, alignof(T));
+  }
+
   inline void _Construct(uint32 i) { new (&m_pElements[i]) T; }
 
   inline void _Construct(uint32 i, const T& v) { new (&m_pElements[i]) T(v); }
@@ -347,3 +404,10 @@ private:
 
   inline T& _GetElement(uint32 i) { return m_pElements[i]; }
 };
+
+// the array object only points at its elements, so arrays of arrays can be reallocated in place
+template<class T, class AllocatorType>
+struct RelocationTrait<Array<T, AllocatorType>>
+{
+  static const bool IsTriviallyRelocatable = true;
+};
@@ -0,0 +1,207 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/PODArray.h"
+
+// Searches and reductions over arrays of int32, uint32, int64, uint64, float and double, using SSE2/AVX2/NEON as
+// the cpu allows. Each type has its own overload, so mixed arguments need a cast to pick one. Counts are uint32, as
+// with PODArray; indices are returned as int32 with -1 for none, matching PODArray::IndexOf.
+// Floating point compares follow the C++ operators, so NaN is only ever "not equal".
+// See ParallelArrayAlgorithms.h for versions spread across a ThreadPool.
+//   Y_array_find          index of the first element equal to a value
+//   Y_array_count         number of elements comparing true against a value
+//   Y_array_filter        copies the elements comparing true against a value, in order
+//   Y_array_minmax        smallest and largest element
+//   Y_array_sum           sum of the elements
+//   Y_array_prefix_sum    running sum of the elements
+//   Y_eytzinger_layout    rearranges a sorted array so binary searches over it read memory in order
+//   Y_eytzinger_lower_bound
+
+// element <compare> value
+enum Y_ARRAY_COMPARE
+{
+  Y_ARRAY_COMPARE_EQUAL,
+  Y_ARRAY_COMPARE_NOT_EQUAL,
+  Y_ARRAY_COMPARE_LESS,
+  Y_ARRAY_COMPARE_LESS_EQUAL,
+  Y_ARRAY_COMPARE_GREATER,
+  Y_ARRAY_COMPARE_GREATER_EQUAL,
+  Y_ARRAY_COMPARE_COUNT,
+};
+
+int32 Y_array_find(const int32* pValues, uint32 count, int32 value);
+int32 Y_array_find(const uint32* pValues, uint32 count, uint32 value);
+int32 Y_array_find(const int64* pValues, uint32 count, int64 value);
+int32 Y_array_find(const uint64* pValues, uint32 count, uint64 value);
+int32 Y_array_find(const float* pValues, uint32 count, float value);
+int32 Y_array_find(const double* pValues, uint32 count, double value);
+
+uint32 Y_array_count(const int32* pValues, uint32 count, Y_ARRAY_COMPARE compare, int32 value);
+uint32 Y_array_count(const uint32* pValues, uint32 count, Y_ARRAY_COMPARE compare, uint32 value);
+uint32 Y_array_count(const int64* pValues, uint32 count, Y_ARRAY_COMPARE compare, int64 value);
+uint32 Y_array_count(const uint64* pValues, uint32 count, Y_ARRAY_COMPARE compare, uint64 value);
+uint32 Y_array_count(const float* pValues, uint32 count, Y_ARRAY_COMPARE compare, float value);
+uint32 Y_array_count(const double* pValues, uint32 count, Y_ARRAY_COMPARE compare, double value);
+
+// Returns the number kept. pResult needs room for count elements, but only that many are written. It may be the
+// same array as pValues, but may not otherwise overlap it.
+uint32 Y_array_filter(int32* pResult, const int32* pValues, uint32 count, Y_ARRAY_COMPARE compare, int32 value);
+uint32 Y_array_filter(uint32* pResult, const uint32* pValues, uint32 count, Y_ARRAY_COMPARE compare, uint32 value);
+uint32 Y_array_filter(int64* pResult, const int64* pValues, uint32 count, Y_ARRAY_COMPARE compare, int64 value);
+uint32 Y_array_filter(uint64* pResult, const uint64* pValues, uint32 count, Y_ARRAY_COMPARE compare, uint64 value);
+uint32 Y_array_filter(float* pResult, const float* pValues, uint32 count, Y_ARRAY_COMPARE compare, float value);
+uint32 Y_array_filter(double* pResult, const double* pValues, uint32 count, Y_ARRAY_COMPARE compare, double value);
+
+// False when there's nothing to compare: no elements, or for floating point only NaNs, which are otherwise skipped.
+bool Y_array_minmax(const int32* pValues, uint32 count, int32* pMin, int32* pMax);
+bool Y_array_minmax(const uint32* pValues, uint32 count, uint32* pMin, uint32* pMax);
+bool Y_array_minmax(const int64* pValues, uint32 count, int64* pMin, int64* pMax);
+bool Y_array_minmax(const uint64* pValues, uint32 count, uint64* pMin, uint64* pMax);
+bool Y_array_minmax(const float* pValues, uint32 count, float* pMin, float* pMax);
+bool Y_array_minmax(const double* pValues, uint32 count, double* pMin, double* pMax);
+
+// Integers wrap. Floating point sums are kept in several lanes and added together at the end, so they can differ in
+// the last bits from adding in order, and between cpus.
+int32 Y_array_sum(const int32* pValues, uint32 count);
+uint32 Y_array_sum(const uint32* pValues, uint32 count);
+int64 Y_array_sum(const int64* pValues, uint32 count);
+uint64 Y_array_sum(const uint64* pValues, uint32 count);
+float Y_array_sum(const float* pValues, uint32 count);
+double Y_array_sum(const double* pValues, uint32 count);
+
+// pResult[i] = initial + pValues[0] + ... + pValues[i], returning the total. pResult may be the same array as pValues,
+// but may not otherwise overlap it.
+int32 Y_array_prefix_sum(int32* pResult, const int32* pValues, uint32 count, int32 initial = 0);
+uint32 Y_array_prefix_sum(uint32* pResult, const uint32* pValues, uint32 count, uint32 initial = 0);
+int64 Y_array_prefix_sum(int64* pResult, const int64* pValues, uint32 count, int64 initial = 0);
+uint64 Y_array_prefix_sum(uint64* pResult, const uint64* pValues, uint32 count, uint64 initial = 0);
+float Y_array_prefix_sum(float* pResult, const float* pValues, uint32 count, float initial = 0.0f);
+double Y_array_prefix_sum(double* pResult, const double* pValues, uint32 count, double initial = 0.0);
+
+namespace ArrayAlgorithmsDetail {
+
+// keeps a parameter out of deduction, so a value converts to the array's element type
+template<typename T>
+struct Identity
+{
+  typedef T Type;
+};
+
+template<typename T>
+inline void PrefetchRead(const T* p)
+{
+#if defined(Y_COMPILER_MSVC) && (defined(Y_CPU_X86) || defined(Y_CPU_X64))
+  _mm_prefetch(reinterpret_cast<const char*>(p), _MM_HINT_T0);
+#elif defined(Y_COMPILER_GCC) || defined(Y_COMPILER_CLANG)
+  __builtin_prefetch(p);
+#endif
+}
+
+// in-order walk of the implicit tree, which visits the slots in sorted order
+template<typename T>
+uint32 FillEytzinger(T* pResult, const T* pSorted, uint32 count, uint32 sortedIndex, uint32 slot)
+{
+  if (slot < count)
+  {
+    sortedIndex = FillEytzinger(pResult, pSorted, count, sortedIndex, slot * 2 + 1);
+    pResult[slot] = pSorted[sortedIndex++];
+    sortedIndex = FillEytzinger(pResult, pSorted, count, sortedIndex, slot * 2 + 2);
+  }
+
+  return sortedIndex;
+}
+
+struct LessCompare
+{
+  template<typename T, typename K>
+  bool operator()(const T& element, const K& value) const
+  {
+    return (element < value);
+  }
+};
+
+}; // namespace ArrayAlgorithmsDetail
+
+// PODArray versions. The filter keeps the matching elements in place, shrinking the array, and the prefix sum replaces
+// the elements with the running sum.
+template<typename T, class A>
+int32 Y_array_find(const PODArray<T, A>& array, typename ArrayAlgorithmsDetail::Identity<T>::Type value)
+{
+  return Y_array_find(array.GetBasePointer(), array.GetSize(), value);
+}
+
+template<typename T, class A>
+uint32 Y_array_count(const PODArray<T, A>& array, Y_ARRAY_COMPARE compare,
+                     typename ArrayAlgorithmsDetail::Identity<T>::Type value)
+{
+  return Y_array_count(array.GetBasePointer(), array.GetSize(), compare, value);
+}
+
+template<typename T, class A>
+uint32 Y_array_filter(PODArray<T, A>* pArray, Y_ARRAY_COMPARE compare,
+                      typename ArrayAlgorithmsDetail::Identity<T>::Type value)
+{
+  uint32 keptCount = Y_array_filter(pArray->GetBasePointer(), pArray->GetBasePointer(), pArray->GetSize(), compare,
+                                    value);
+  pArray->Resize(keptCount);
+  return keptCount;
+}
+
+template<typename T, class A>
+bool Y_array_minmax(const PODArray<T, A>& array, T* pMin, T* pMax)
+{
+  return Y_array_minmax(array.GetBasePointer(), array.GetSize(), pMin, pMax);
+}
+
+template<typename T, class A>
+T Y_array_sum(const PODArray<T, A>& array)
+{
+  return Y_array_sum(array.GetBasePointer(), array.GetSize());
+}
+
+template<typename T, class A>
+T Y_array_prefix_sum(PODArray<T, A>* pArray, typename ArrayAlgorithmsDetail::Identity<T>::Type initial = T())
+{
+  return Y_array_prefix_sum(pArray->GetBasePointer(), pArray->GetBasePointer(), pArray->GetSize(), initial);
+}
+
+// Eytzinger layout: the sorted array as a complete binary tree stored breadth first, the children of slot k at 2k+1
+// and 2k+2. A search then reads the first few levels from the same cache lines every time, and each level's slots
+// sit together, so the next ones can be prefetched while comparing. Works for any copyable T; payloads kept in a
+// separate array in the same sorted order can be rearranged with the same call to stay in step with their keys.
+// pResult may not overlap pSorted.
+template<typename T>
+void Y_eytzinger_layout(T* pResult, const T* pSorted, uint32 count)
+{
+  ArrayAlgorithmsDetail::FillEytzinger(pResult, pSorted, count, 0, 0);
+}
+
+// Slot of the first element not ordering before value, or count if there's none. compare(element, value) returns
+// true when the element orders before value, like operator<. Branchless: the walk always goes to the bottom of the
+// tree, then climbs back past the right turns taken since the last left one.
+template<typename T, typename K, typename Compare>
+uint32 Y_eytzinger_lower_bound(const T* pLayout, uint32 count, const K& value, Compare compare)
+{
+  // 1-based, so the children of j are 2j and 2j+1, and the path taken is the bits of j
+  DebugAssert(count < 0x80000000u);
+  uint32 j = 1;
+  while (j <= count)
+  {
+    // four levels down are sixteen consecutive slots, a cache line or two
+    uint64 descendant = (uint64)j * 16 - 1;
+    ArrayAlgorithmsDetail::PrefetchRead(pLayout + ((descendant < count) ? descendant : 0));
+    j = 2 * j + (compare(pLayout[j - 1], value) ? 1 : 0);
+  }
+
+  // right turns set the low bits, dropping them and the left turn before leaves the last node that wasn't less
+  uint32 trailingOnes;
+  Y_bitscanforward(~j, &trailingOnes);
+  j >>= trailingOnes + 1;
+  return (j != 0) ? (j - 1) : count;
+}
+
+template<typename T, typename K>
+uint32 Y_eytzinger_lower_bound(const T* pLayout, uint32 count, const K& value)
+{
+  return Y_eytzinger_lower_bound(pLayout, count, value, ArrayAlgorithmsDetail::LessCompare());
+}
@@ -0,0 +1,209 @@
+#pragma once
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/ConditionVariable.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/ReferenceCounted.h"
+
+class AsyncFileQueue;
+class AsyncFileStream;
+class TaskQueue;
+
+// One read or write at an offset in a file. The caller owns the request and its buffer and keeps both alive until
+// the request completes, so having many requests in flight costs no allocations. A request can be resubmitted from
+// its own completion callback.
+struct AsyncFileRequest
+{
+  typedef void (*CompletionCallback)(AsyncFileRequest* pRequest);
+
+  enum TYPE
+  {
+    TYPE_READ,
+    TYPE_WRITE,
+  };
+
+  AsyncFileRequest()
+    : Type(TYPE_READ), pBuffer(nullptr), Offset(0), Size(0), Callback(nullptr), pUserData(nullptr),
+      BytesTransferred(0), Succeeded(false), m_pStream(nullptr), m_pNext(nullptr), m_completed(0)
+  {
+  }
+
+  // set up by the caller before submitting
+  TYPE Type;
+  void* pBuffer;
+  uint64 Offset;
+  uint32 Size;
+  CompletionCallback Callback;
+  void* pUserData;
+
+  // filled in before the callback runs. reads stopping at the end of the file succeed with fewer bytes.
+  uint32 BytesTransferred;
+  bool Succeeded;
+
+  // becomes true once the result is filled in, just before the callback runs. callers that poll this rather than
+  // waiting for the callback must not touch the request from the callback.
+  bool IsComplete() const { return (Y_AtomicLoadAcquire(m_completed) != 0); }
+
+  // the stream the request was last submitted to
+  AsyncFileStream* GetStream() const { return m_pStream; }
+
+private:
+  friend AsyncFileQueue;
+  friend AsyncFileStream;
+
+  // OVERLAPPED on Windows, the iovec for io_uring
+  uint64 m_platformData[4];
+
+  AsyncFileStream* m_pStream;
+  AsyncFileRequest* m_pNext;
+  Y_ATOMIC_DECL uint32 m_completed;
+};
+
+// A file opened for asynchronous I/O through an AsyncFileQueue. Requests keep a reference to the stream while they
+// are in flight, so it can be released with requests outstanding.
+class AsyncFileStream : public ReferenceCounted
+{
+  friend AsyncFileQueue;
+
+public:
+  AsyncFileQueue* GetQueue() const { return m_pQueue; }
+
+  // current size of the file
+  uint64 GetSize() const;
+
+  // Submits requests, returns false if the queue has been shut down. Completions run on the queue's completion
+  // thread, or as tasks on its completion task queue. Requests that don't fit in the kernel's queue right away are
+  // held back and submitted as earlier ones complete. A batch is passed to the kernel in one call where possible.
+  bool Submit(AsyncFileRequest* pRequest) { return Submit(&pRequest, 1); }
+  bool Submit(AsyncFileRequest** ppRequests, uint32 count);
+
+private:
+#if defined(Y_PLATFORM_WINDOWS)
+  typedef void* FileHandle;
+#else
+  typedef int FileHandle;
+#endif
+
+  AsyncFileStream(AsyncFileQueue* pQueue, FileHandle fileHandle);
+  ~AsyncFileStream();
+
+  AsyncFileQueue* m_pQueue;
+  FileHandle m_fileHandle;
+};
+
+// Runs asynchronous file I/O for any number of files. Linux uses io_uring, Windows uses overlapped I/O on a
+// completion port, and anywhere else, or when the kernel doesn't allow io_uring, worker threads do positioned
+// blocking reads and writes.
+//   AsyncFileQueue queue;
+//   queue.Initialize();
+//   AsyncFileStream* pStream;
+//   if (queue.OpenFile("data.pak", BYTESTREAM_OPEN_READ, &pStream))
+//   {
+//     request.pBuffer = buffer; request.Offset = offset; request.Size = size; request.Callback = OnRead;
+//     pStream->Submit(&request);
+//     pStream->Release();
+//   }
+class AsyncFileQueue
+{
+  friend AsyncFileStream;
+
+public:
+  enum BACKEND
+  {
+    BACKEND_NONE,
+    BACKEND_IO_URING,
+    BACKEND_IOCP,
+    BACKEND_THREADS,
+  };
+
+  AsyncFileQueue();
+
+  // waits for outstanding requests and shuts down
+  ~AsyncFileQueue();
+
+  // Starts the queue. queueDepth is the number of requests the kernel is given at once. If pCompletionQueue is set,
+  // completion callbacks are queued on it as tasks, otherwise they run on the completion thread and should be short.
+  // workerThreadCount is only used by the thread fallback, with no threads requests are carried out in Submit.
+  bool Initialize(uint32 queueDepth = 128, TaskQueue* pCompletionQueue = nullptr, uint32 workerThreadCount = 4);
+
+  // waits for outstanding requests and stops the completion and worker threads
+  void Shutdown();
+
+  BACKEND GetBackend() const { return m_backend; }
+
+  // Opens a file for asynchronous access. openMode takes the BYTESTREAM_OPEN_READ, WRITE, CREATE and TRUNCATE flags.
+  bool OpenFile(const char* fileName, uint32 openMode, AsyncFileStream** ppStream);
+
+  // requests submitted whose callbacks haven't returned yet
+  uint32 GetPendingCount() const { return m_pendingCount; }
+
+  // blocks until every request submitted has completed and its callback has returned
+  void WaitForIdle();
+
+private:
+  class CompletionThread;
+
+  bool InitializeIOUring(uint32 queueDepth);
+  bool InitializeIOCP();
+  bool InitializeThreads(uint32 workerThreadCount);
+
+  bool SubmitRequests(AsyncFileRequest** ppRequests, uint32 count);
+
+  // hands held back requests to the kernel while there's room, returns the number passed on
+  uint32 FlushIOUringSubmissions();
+  void SubmitIOCPRequest(AsyncFileRequest* pRequest);
+
+  // runs on the completion thread
+  void IOUringCompletionLoop();
+  void IOCPCompletionLoop();
+  void WorkerLoop();
+
+  // synchronous positioned transfer, used by the thread fallback
+  static void TransferSynchronous(AsyncFileRequest* pRequest);
+
+  // fills in the result and runs or queues the callback
+  void CompleteRequest(AsyncFileRequest* pRequest, bool succeeded);
+
+  // drops the request's stream reference and pending count once its callback has returned
+  void FinishRequest(AsyncFileStream* pStream);
+
+  BACKEND m_backend;
+  TaskQueue* m_pCompletionQueue;
+  PODArray<CompletionThread*> m_threads;
+  bool m_shutdown;
+
+  Y_ATOMIC_DECL uint32 m_pendingCount;
+  Mutex m_idleLock;
+  ConditionVariable m_idleConditionVariable;
+
+  // requests waiting for the kernel or a worker, protected by m_submitLock
+  Mutex m_submitLock;
+  ConditionVariable m_submitConditionVariable;
+  AsyncFileRequest* m_pWaitingHead;
+  AsyncFileRequest* m_pWaitingTail;
+
+  // io_uring rings, the submission side is protected by m_submitLock
+  int m_ringFileDescriptor;
+  void* m_pSubmissionRing;
+  size_t m_submissionRingSize;
+  void* m_pCompletionRing;
+  size_t m_completionRingSize;
+  void* m_pSubmissionEntries;
+  size_t m_submissionEntriesSize;
+  uint32* m_pSubmissionHead;
+  uint32* m_pSubmissionTail;
+  uint32* m_pSubmissionArray;
+  uint32 m_submissionMask;
+  uint32* m_pCompletionHead;
+  uint32* m_pCompletionTail;
+  void* m_pCompletionEntries;
+  uint32 m_completionMask;
+  uint32 m_ringCapacity;
+  uint32 m_ringInFlight;
+
+  // Windows completion port
+  void* m_completionPort;
+
+  DeclareNonCopyable(AsyncFileQueue);
+};
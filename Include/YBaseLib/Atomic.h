@@ -11,23 +11,418 @@
 #define Y_ATOMIC_PTR_DECL(type) ALIGN_DECL(4) type* volatile
 #endif
 
-// atomic functions
+// Orderings for the atomics below, as in C++11. Relaxed only makes the operation itself atomic, acquire keeps what
+// comes after it from moving before it, release keeps what comes before it from moving after it, and seq_cst is a
+// full barrier. Loads take relaxed, acquire or seq_cst, stores relaxed, release or seq_cst.
+enum ATOMIC_MEMORY_ORDER
+{
+  ATOMIC_MEMORY_ORDER_RELAXED,
+  ATOMIC_MEMORY_ORDER_ACQUIRE,
+  ATOMIC_MEMORY_ORDER_RELEASE,
+  ATOMIC_MEMORY_ORDER_ACQ_REL,
+  ATOMIC_MEMORY_ORDER_SEQ_CST,
+};
+
+// Atomics on integers of 8 to 64 bits, inlined to the compiler's intrinsics. The Fetch operations return the value
+// from before, Increment, Decrement, Add and And the value after. GCC and clang get the orderings as given, MSVC's
+// interlocked intrinsics are full barriers whatever the order, so there they only make loads and stores cheaper.
+#if defined(Y_COMPILER_MSVC)
+
+template<uint32 SIZE>
+struct Y_AtomicIntrinsics;
+
+template<>
+struct Y_AtomicIntrinsics<1>
+{
+  typedef char Type;
+  static inline char Exchange(volatile char* p, char v) { return _InterlockedExchange8(p, v); }
+  static inline char CompareExchange(volatile char* p, char v, char c) { return _InterlockedCompareExchange8(p, v, c); }
+  static inline char ExchangeAdd(volatile char* p, char v) { return _InterlockedExchangeAdd8(p, v); }
+  static inline char And(volatile char* p, char v) { return _InterlockedAnd8(p, v); }
+  static inline char Or(volatile char* p, char v) { return _InterlockedOr8(p, v); }
+  static inline char Xor(volatile char* p, char v) { return _InterlockedXor8(p, v); }
+};
+
+template<>
+struct Y_AtomicIntrinsics<2>
+{
+  typedef short Type;
+  static inline short Exchange(volatile short* p, short v) { return _InterlockedExchange16(p, v); }
+  static inline short CompareExchange(volatile short* p, short v, short c)
+  {
+    return _InterlockedCompareExchange16(p, v, c);
+  }
+  static inline short ExchangeAdd(volatile short* p, short v) { return _InterlockedExchangeAdd16(p, v); }
+  static inline short And(volatile short* p, short v) { return _InterlockedAnd16(p, v); }
+  static inline short Or(volatile short* p, short v) { return _InterlockedOr16(p, v); }
+  static inline short Xor(volatile short* p, short v) { return _InterlockedXor16(p, v); }
+};
+
+template<>
+struct Y_AtomicIntrinsics<4>
+{
+  typedef long Type;
+  static inline long Exchange(volatile long* p, long v) { return _InterlockedExchange(p, v); }
+  static inline long CompareExchange(volatile long* p, long v, long c) { return _InterlockedCompareExchange(p, v, c); }
+  static inline long ExchangeAdd(volatile long* p, long v) { return _InterlockedExchangeAdd(p, v); }
+  static inline long And(volatile long* p, long v) { return _InterlockedAnd(p, v); }
+  static inline long Or(volatile long* p, long v) { return _InterlockedOr(p, v); }
+  static inline long Xor(volatile long* p, long v) { return _InterlockedXor(p, v); }
+};
+
+template<>
+struct Y_AtomicIntrinsics<8>
+{
+  typedef __int64 Type;
+  static inline __int64 CompareExchange(volatile __int64* p, __int64 v, __int64 c)
+  {
+    return _InterlockedCompareExchange64(p, v, c);
+  }
+#if defined(Y_CPU_X86)
+  // x86 only has the 64-bit compare-exchange, the rest loop on it
+  static inline __int64 Exchange(volatile __int64* p, __int64 v)
+  {
+    __int64 previous = *p;
+    for (__int64 seen; (seen = _InterlockedCompareExchange64(p, v, previous)) != previous;)
+      previous = seen;
+    return previous;
+  }
+  static inline __int64 ExchangeAdd(volatile __int64* p, __int64 v)
+  {
+    __int64 previous = *p;
+    for (__int64 seen; (seen = _InterlockedCompareExchange64(p, previous + v, previous)) != previous;)
+      previous = seen;
+    return previous;
+  }
+  static inline __int64 And(volatile __int64* p, __int64 v)
+  {
+    __int64 previous = *p;
+    for (__int64 seen; (seen = _InterlockedCompareExchange64(p, previous & v, previous)) != previous;)
+      previous = seen;
+    return previous;
+  }
+  static inline __int64 Or(volatile __int64* p, __int64 v)
+  {
+    __int64 previous = *p;
+    for (__int64 seen; (seen = _InterlockedCompareExchange64(p, previous | v, previous)) != previous;)
+      previous = seen;
+    return previous;
+  }
+  static inline __int64 Xor(volatile __int64* p, __int64 v)
+  {
+    __int64 previous = *p;
+    for (__int64 seen; (seen = _InterlockedCompareExchange64(p, previous ^ v, previous)) != previous;)
+      previous = seen;
+    return previous;
+  }
+#else
+  static inline __int64 Exchange(volatile __int64* p, __int64 v) { return _InterlockedExchange64(p, v); }
+  static inline __int64 ExchangeAdd(volatile __int64* p, __int64 v) { return _InterlockedExchangeAdd64(p, v); }
+  static inline __int64 And(volatile __int64* p, __int64 v) { return _InterlockedAnd64(p, v); }
+  static inline __int64 Or(volatile __int64* p, __int64 v) { return _InterlockedOr64(p, v); }
+  static inline __int64 Xor(volatile __int64* p, __int64 v) { return _InterlockedXor64(p, v); }
+#endif
+};
+
+#define Y_ATOMIC_OPS(T) Y_AtomicIntrinsics<sizeof(T)>
+#define Y_ATOMIC_PTR(T, p) ((volatile typename Y_ATOMIC_OPS(T)::Type*)(p))
+#define Y_ATOMIC_VAL(T, v) ((typename Y_ATOMIC_OPS(T)::Type)(v))
+
 template<typename T>
-T Y_AtomicIncrement(volatile T& Value);
+inline T Y_AtomicLoad(const volatile T& Value, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+#if defined(Y_CPU_X86)
+  // plain 64-bit loads aren't atomic on x86, a compare-exchange of 0 with 0 is
+  if (sizeof(T) == 8)
+    return T(Y_ATOMIC_OPS(T)::CompareExchange(Y_ATOMIC_PTR(T, &Value), 0, 0));
+#endif
+#if defined(Y_CPU_X86) || defined(Y_CPU_X64)
+  // x86 loads already have acquire ordering, and seq_cst stores are the ones with the fence
+  T value = Value;
+  _ReadWriteBarrier();
+  return value;
+#else
+  if (order == ATOMIC_MEMORY_ORDER_SEQ_CST)
+    __dmb(_ARM64_BARRIER_ISH);
+  T value = Value;
+  if (order != ATOMIC_MEMORY_ORDER_RELAXED)
+    __dmb(_ARM64_BARRIER_ISH);
+  return value;
+#endif
+}
+
 template<typename T>
-T Y_AtomicDecrement(volatile T& Value);
+inline void Y_AtomicStore(volatile T& Value, T NewValue, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+#if defined(Y_CPU_X86)
+  // nor are plain 64-bit stores
+  if (order == ATOMIC_MEMORY_ORDER_SEQ_CST || sizeof(T) == 8)
+#else
+  if (order == ATOMIC_MEMORY_ORDER_SEQ_CST)
+#endif
+  {
+    Y_ATOMIC_OPS(T)::Exchange(Y_ATOMIC_PTR(T, &Value), Y_ATOMIC_VAL(T, NewValue));
+    return;
+  }
+#if defined(Y_CPU_X86) || defined(Y_CPU_X64)
+  _ReadWriteBarrier();
+#else
+  if (order != ATOMIC_MEMORY_ORDER_RELAXED)
+    __dmb(_ARM64_BARRIER_ISH);
+#endif
+  Value = NewValue;
+}
+
 template<typename T>
-T Y_AtomicCompareExchange(volatile T& Result, T Exchange, T Comparand);
+inline T Y_AtomicExchange(volatile T& Value, T Exchange, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return T(Y_ATOMIC_OPS(T)::Exchange(Y_ATOMIC_PTR(T, &Value), Y_ATOMIC_VAL(T, Exchange)));
+}
+
+// Stores Desired if Value holds Expected, otherwise copies what it does hold into Expected.
 template<typename T>
-T Y_AtomicExchange(volatile T& Result, T Exchange);
+inline bool Y_AtomicTryCompareExchange(volatile T& Value, T& Expected, T Desired,
+                                       ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  T previous =
+    T(Y_ATOMIC_OPS(T)::CompareExchange(Y_ATOMIC_PTR(T, &Value), Y_ATOMIC_VAL(T, Desired), Y_ATOMIC_VAL(T, Expected)));
+  if (previous == Expected)
+    return true;
+
+  Expected = previous;
+  return false;
+}
+
 template<typename T>
-T Y_AtomicAnd(volatile T& Value, T AndVal);
+inline T Y_AtomicFetchAdd(volatile T& Value, T AddVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return T(Y_ATOMIC_OPS(T)::ExchangeAdd(Y_ATOMIC_PTR(T, &Value), Y_ATOMIC_VAL(T, AddVal)));
+}
+
+template<typename T>
+inline T Y_AtomicFetchSub(volatile T& Value, T SubVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return T(Y_ATOMIC_OPS(T)::ExchangeAdd(Y_ATOMIC_PTR(T, &Value), Y_ATOMIC_VAL(T, T(0) - SubVal)));
+}
+
 template<typename T>
-T Y_AtomicAdd(volatile T& Value, T AddVal);
+inline T Y_AtomicFetchAnd(volatile T& Value, T AndVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return T(Y_ATOMIC_OPS(T)::And(Y_ATOMIC_PTR(T, &Value), Y_ATOMIC_VAL(T, AndVal)));
+}
+
+template<typename T>
+inline T Y_AtomicFetchOr(volatile T& Value, T OrVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return T(Y_ATOMIC_OPS(T)::Or(Y_ATOMIC_PTR(T, &Value), Y_ATOMIC_VAL(T, OrVal)));
+}
+
+template<typename T>
+inline T Y_AtomicFetchXor(volatile T& Value, T XorVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return T(Y_ATOMIC_OPS(T)::Xor(Y_ATOMIC_PTR(T, &Value), Y_ATOMIC_VAL(T, XorVal)));
+}
+
+#undef Y_ATOMIC_VAL
+#undef Y_ATOMIC_PTR
+#undef Y_ATOMIC_OPS
+
+#else
+
+// the __ATOMIC_ constant for an order, folded away once inlined with a constant
+inline int Y_AtomicBuiltinOrder(ATOMIC_MEMORY_ORDER order)
+{
+  switch (order)
+  {
+    case ATOMIC_MEMORY_ORDER_RELAXED:
+      return __ATOMIC_RELAXED;
+    case ATOMIC_MEMORY_ORDER_ACQUIRE:
+      return __ATOMIC_ACQUIRE;
+    case ATOMIC_MEMORY_ORDER_RELEASE:
+      return __ATOMIC_RELEASE;
+    case ATOMIC_MEMORY_ORDER_ACQ_REL:
+      return __ATOMIC_ACQ_REL;
+    default:
+      return __ATOMIC_SEQ_CST;
+  }
+}
+
+template<typename T>
+inline T Y_AtomicLoad(const volatile T& Value, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return __atomic_load_n(&Value, Y_AtomicBuiltinOrder(order));
+}
+
+template<typename T>
+inline void Y_AtomicStore(volatile T& Value, T NewValue, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  __atomic_store_n(&Value, NewValue, Y_AtomicBuiltinOrder(order));
+}
+
+template<typename T>
+inline T Y_AtomicExchange(volatile T& Value, T Exchange, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return __atomic_exchange_n(&Value, Exchange, Y_AtomicBuiltinOrder(order));
+}
+
+// Stores Desired if Value holds Expected, otherwise copies what it does hold into Expected.
+template<typename T>
+inline bool Y_AtomicTryCompareExchange(volatile T& Value, T& Expected, T Desired,
+                                       ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  // a failure doesn't store, so it can't have release ordering
+  ATOMIC_MEMORY_ORDER failureOrder = (order == ATOMIC_MEMORY_ORDER_RELEASE) ?
+                                       ATOMIC_MEMORY_ORDER_RELAXED :
+                                       ((order == ATOMIC_MEMORY_ORDER_ACQ_REL) ? ATOMIC_MEMORY_ORDER_ACQUIRE : order);
+  return __atomic_compare_exchange_n(&Value, &Expected, Desired, false, Y_AtomicBuiltinOrder(order),
+                                     Y_AtomicBuiltinOrder(failureOrder));
+}
+
+template<typename T>
+inline T Y_AtomicFetchAdd(volatile T& Value, T AddVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return __atomic_fetch_add(&Value, AddVal, Y_AtomicBuiltinOrder(order));
+}
+
+template<typename T>
+inline T Y_AtomicFetchSub(volatile T& Value, T SubVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return __atomic_fetch_sub(&Value, SubVal, Y_AtomicBuiltinOrder(order));
+}
+
+template<typename T>
+inline T Y_AtomicFetchAnd(volatile T& Value, T AndVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return __atomic_fetch_and(&Value, AndVal, Y_AtomicBuiltinOrder(order));
+}
+
+template<typename T>
+inline T Y_AtomicFetchOr(volatile T& Value, T OrVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return __atomic_fetch_or(&Value, OrVal, Y_AtomicBuiltinOrder(order));
+}
+
+template<typename T>
+inline T Y_AtomicFetchXor(volatile T& Value, T XorVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return __atomic_fetch_xor(&Value, XorVal, Y_AtomicBuiltinOrder(order));
+}
+
+#endif
+
+// Min and max loop on a compare-exchange, and don't store at all if the value's already past the operand.
+template<typename T>
+inline T Y_AtomicFetchMin(volatile T& Value, T MinVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  T previous = Y_AtomicLoad(Value, (order == ATOMIC_MEMORY_ORDER_RELEASE) ? ATOMIC_MEMORY_ORDER_RELAXED :
+                                     ((order == ATOMIC_MEMORY_ORDER_ACQ_REL) ? ATOMIC_MEMORY_ORDER_ACQUIRE : order));
+  while (MinVal < previous && !Y_AtomicTryCompareExchange(Value, previous, MinVal, order))
+    ;
+  return previous;
+}
+
+template<typename T>
+inline T Y_AtomicFetchMax(volatile T& Value, T MaxVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  T previous = Y_AtomicLoad(Value, (order == ATOMIC_MEMORY_ORDER_RELEASE) ? ATOMIC_MEMORY_ORDER_RELAXED :
+                                     ((order == ATOMIC_MEMORY_ORDER_ACQ_REL) ? ATOMIC_MEMORY_ORDER_ACQUIRE : order));
+  while (MaxVal > previous && !Y_AtomicTryCompareExchange(Value, previous, MaxVal, order))
+    ;
+  return previous;
+}
+
+// the older forms, returning the value after, or before for the compare-exchange
+template<typename T>
+inline T Y_AtomicIncrement(volatile T& Value, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return T(Y_AtomicFetchAdd(Value, T(1), order) + T(1));
+}
+
+template<typename T>
+inline T Y_AtomicDecrement(volatile T& Value, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return T(Y_AtomicFetchSub(Value, T(1), order) - T(1));
+}
+
+template<typename T>
+inline T Y_AtomicAdd(volatile T& Value, T AddVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return T(Y_AtomicFetchAdd(Value, AddVal, order) + AddVal);
+}
+
+template<typename T>
+inline T Y_AtomicAnd(volatile T& Value, T AndVal, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  return T(Y_AtomicFetchAnd(Value, AndVal, order) & AndVal);
+}
+
+template<typename T>
+inline T Y_AtomicCompareExchange(volatile T& Result, T Exchange, T Comparand,
+                                 ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+{
+  Y_AtomicTryCompareExchange(Result, Comparand, Exchange, order);
+  return Comparand;
+}
+
+// Loads and stores with acquire and release ordering, for handing data between threads without a full
+// MemoryBarrier. Nothing after an acquire load moves before it, nothing before a release store moves after it.
+// T is an integer or pointer no wider than a pointer, so plain loads and stores of it are atomic.
+template<typename T>
+inline T Y_AtomicLoadAcquire(const volatile T& Value)
+{
+#if defined(Y_COMPILER_MSVC) && (defined(Y_CPU_X86) || defined(Y_CPU_X64))
+  // x86 loads already have acquire ordering, only the compiler needs fencing
+  T value = Value;
+  _ReadWriteBarrier();
+  return value;
+#elif defined(Y_COMPILER_MSVC)
+  T value = Value;
+  __dmb(_ARM64_BARRIER_ISH);
+  return value;
+#else
+  return __atomic_load_n(&Value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+template<typename T>
+inline void Y_AtomicStoreRelease(volatile T& Value, T NewValue)
+{
+#if defined(Y_COMPILER_MSVC) && (defined(Y_CPU_X86) || defined(Y_CPU_X64))
+  _ReadWriteBarrier();
+  Value = NewValue;
+#elif defined(Y_COMPILER_MSVC)
+  __dmb(_ARM64_BARRIER_ISH);
+  Value = NewValue;
+#else
+  __atomic_store_n(&Value, NewValue, __ATOMIC_RELEASE);
+#endif
+}
+
+// for pointer types, full barriers
+inline void* Y_AtomicCompareExchangeVoidPointer(void* volatile& Pointer, void* Exchange, void* Comparand)
+{
+#if defined(Y_COMPILER_MSVC)
+  return _InterlockedCompareExchangePointer(&Pointer, Exchange, Comparand);
+#else
+  __atomic_compare_exchange_n(&Pointer, &Comparand, Exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  return Comparand;
+#endif
+}
+
+inline void* Y_AtomicExchangeVoidPointer(void* volatile& Pointer, void* Exchange)
+{
+#if defined(Y_COMPILER_MSVC)
+  return _InterlockedExchangePointer(&Pointer, Exchange);
+#else
+  return __atomic_exchange_n(&Pointer, Exchange, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Compare-exchange of two adjacent pointer-sized words, for a pointer paired with a counter. pValue must be aligned
+// to the size of both words. Stores pExchange and returns true if pValue held pComparand, otherwise copies what it
+// did hold into pComparand and returns false. Full barrier.
+bool Y_AtomicCompareExchangeDoubleWord(volatile size_t* pValue, const size_t* pExchange, size_t* pComparand);
 
-// for pointer types
-void* Y_AtomicCompareExchangeVoidPointer(void* volatile& Pointer, void* Exchange, void* Comparand);
-void* Y_AtomicExchangeVoidPointer(void* volatile& Pointer, void* Exchange);
 template<typename T>
 T Y_AtomicCompareExchangePointer(T volatile& Pointer, T Exchange, T Comparand)
 {
@@ -51,10 +446,14 @@ public:
   inline AtomicPointer(T* ptr) : m_ptr(ptr) {}
 
   inline T* Load() const { return m_ptr; }
+  inline T* LoadAcquire() const { return Y_AtomicLoadAcquire(m_ptr); }
 
   inline bool Set(T* ptr) { return (Y_AtomicCompareExchangePointer<T*>(m_ptr, ptr, nullptr) == nullptr); }
   inline bool Clear(T* ptr) { return (Y_AtomicCompareExchangePointer<T*>(m_ptr, nullptr, ptr) == nullptr); }
 
+  // stores ptr whatever was there, returning what was, full barrier
+  inline T* Exchange(T* ptr) { return Y_AtomicExchangePointer<T*>(m_ptr, ptr); }
+
   inline const T& operator*() const { return *Load(); }
   inline T& operator*() { return *Load(); }
   inline const T* operator->() const { return Load(); }
@@ -73,3 +472,73 @@ public:
 private:
   Y_ATOMIC_PTR_DECL(T) m_ptr;
 };
+
+// An integer only reached through the atomics above, ordered seq_cst unless told otherwise.
+template<typename T>
+class Atomic
+{
+public:
+  inline Atomic() : m_value(0) {}
+  inline Atomic(T value) : m_value(value) {}
+
+  inline T Load(ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST) const { return Y_AtomicLoad(m_value, order); }
+  inline void Store(T value, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+  {
+    Y_AtomicStore(m_value, value, order);
+  }
+
+  inline T Exchange(T value, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+  {
+    return Y_AtomicExchange(m_value, value, order);
+  }
+  inline bool CompareExchange(T& expected, T desired, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+  {
+    return Y_AtomicTryCompareExchange(m_value, expected, desired, order);
+  }
+
+  // the value before
+  inline T FetchAdd(T value, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+  {
+    return Y_AtomicFetchAdd(m_value, value, order);
+  }
+  inline T FetchSub(T value, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+  {
+    return Y_AtomicFetchSub(m_value, value, order);
+  }
+  inline T FetchAnd(T value, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+  {
+    return Y_AtomicFetchAnd(m_value, value, order);
+  }
+  inline T FetchOr(T value, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+  {
+    return Y_AtomicFetchOr(m_value, value, order);
+  }
+  inline T FetchXor(T value, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+  {
+    return Y_AtomicFetchXor(m_value, value, order);
+  }
+  inline T FetchMin(T value, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+  {
+    return Y_AtomicFetchMin(m_value, value, order);
+  }
+  inline T FetchMax(T value, ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+  {
+    return Y_AtomicFetchMax(m_value, value, order);
+  }
+
+  // the value after
+  inline T Increment(ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+  {
+    return Y_AtomicIncrement(m_value, order);
+  }
+  inline T Decrement(ATOMIC_MEMORY_ORDER order = ATOMIC_MEMORY_ORDER_SEQ_CST)
+  {
+    return Y_AtomicDecrement(m_value, order);
+  }
+
+  DeclareNonCopyable(Atomic);
+
+private:
+  // aligned to its size, which 64-bit integers on 32-bit targets aren't otherwise
+  alignas(sizeof(T)) volatile T m_value;
+};
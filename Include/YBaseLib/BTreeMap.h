@@ -0,0 +1,615 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/NonCopyable.h"
+#include <functional>
+
+// Ordered map as a B+tree, for maps too large or changing too often for FlatMap. Every node is sized to fit in
+// NodeBytes, a few cache lines by default, and holds as many keys as that allows, so the tree stays a handful of
+// levels deep and each level costs a couple of line fills instead of the one miss per level of a binary tree.
+// Inner nodes hold only keys and child pointers; the members live in the leaves, which are linked in key order so
+// iteration and range scans walk them without going back up the tree.
+// Insert, Set and Remove are O(log n) and move members within and between leaves, so Member pointers and iterators
+// are only valid until the next change. Keys and values must be default constructible and assignable. The comparator
+// is a callable like operator<, as for Y_sort.
+template<typename KeyType, typename ValueType, class Compare = std::less<KeyType>,
+         uint32 NodeBytes = 4 * Y_CACHE_LINE_SIZE>
+class BTreeMap
+{
+public:
+  struct Member
+  {
+    KeyType Key;
+    ValueType Value;
+  };
+
+private:
+  struct Node
+  {
+    uint32 Count;
+    bool IsLeaf;
+  };
+
+  static const uint32 LeafCapacityForBytes = (NodeBytes - sizeof(Node) - 2 * sizeof(void*)) / sizeof(Member);
+  static const uint32 InnerCapacityForBytes = (NodeBytes - sizeof(Node) - sizeof(void*)) /
+                                              (sizeof(KeyType) + sizeof(void*));
+
+public:
+  // members per leaf and keys per inner node, at least 4 however large the types are
+  static const uint32 LeafCapacity = (LeafCapacityForBytes > 4) ? LeafCapacityForBytes : 4;
+  static const uint32 InnerCapacity = (InnerCapacityForBytes > 4) ? InnerCapacityForBytes : 4;
+
+private:
+  struct Leaf : Node
+  {
+    Member Members[LeafCapacity];
+    Leaf* pPrev;
+    Leaf* pNext;
+  };
+
+  // child i holds the keys from Keys[i - 1] up to, not including, Keys[i]
+  struct Inner : Node
+  {
+    KeyType Keys[InnerCapacity];
+    Node* pChildren[InnerCapacity + 1];
+  };
+
+public:
+  template<class MemberType>
+  class IteratorBase
+  {
+  public:
+    IteratorBase() : m_pLeaf(nullptr), m_index(0) {}
+    IteratorBase(Leaf* pLeaf, uint32 index) : m_pLeaf(pLeaf), m_index(index)
+    {
+      // past the end of a leaf is the start of the next
+      if (m_pLeaf != nullptr && m_index == m_pLeaf->Count)
+      {
+        m_pLeaf = m_pLeaf->pNext;
+        m_index = 0;
+      }
+    }
+
+    inline void Forward()
+    {
+      if (++m_index == m_pLeaf->Count)
+      {
+        m_pLeaf = m_pLeaf->pNext;
+        m_index = 0;
+      }
+    }
+    inline bool AtEnd() const { return (m_pLeaf == nullptr); }
+
+    inline bool operator==(const IteratorBase& rhs) const
+    {
+      return (m_pLeaf == rhs.m_pLeaf && m_index == rhs.m_index);
+    }
+    inline bool operator!=(const IteratorBase& rhs) const { return !operator==(rhs); }
+
+    // pre-increment
+    inline IteratorBase& operator++()
+    {
+      Forward();
+      return *this;
+    }
+
+    // post-increment
+    IteratorBase operator++(int)
+    {
+      IteratorBase i(*this);
+      Forward();
+      return i;
+    }
+
+    // dereference
+    inline MemberType& operator*() const { return m_pLeaf->Members[m_index]; }
+    inline MemberType* operator->() const { return &m_pLeaf->Members[m_index]; }
+
+  private:
+    Leaf* m_pLeaf;
+    uint32 m_index;
+  };
+
+  typedef IteratorBase<Member> Iterator;
+  typedef IteratorBase<const Member> ConstIterator;
+
+  BTreeMap(const Compare& compare = Compare())
+    : m_pRoot(nullptr), m_pFirstLeaf(nullptr), m_nMembers(0), m_compare(compare)
+  {
+  }
+
+  ~BTreeMap() { Clear(); }
+
+  uint32 GetMemberCount() const { return m_nMembers; }
+  bool IsEmpty() const { return (m_nMembers == 0); }
+
+  void Clear()
+  {
+    if (m_pRoot != nullptr)
+      DeleteNode(m_pRoot);
+
+    m_pRoot = nullptr;
+    m_pFirstLeaf = nullptr;
+    m_nMembers = 0;
+  }
+
+  Member* Find(const KeyType& Key)
+  {
+    if (m_pRoot == nullptr)
+      return nullptr;
+
+    Leaf* pLeaf = FindLeaf(Key);
+    uint32 index = LeafLowerBound(pLeaf, Key);
+    return (index < pLeaf->Count && !m_compare(Key, pLeaf->Members[index].Key)) ? &pLeaf->Members[index] : nullptr;
+  }
+  const Member* Find(const KeyType& Key) const { return const_cast<BTreeMap*>(this)->Find(Key); }
+
+  // Iterating from LowerBound(low) until reaching UpperBound(high) visits the keys in [low, high].
+  Iterator LowerBound(const KeyType& Key) { return BoundIterator<Iterator>(Key, false); }
+  ConstIterator LowerBound(const KeyType& Key) const { return BoundIterator<ConstIterator>(Key, false); }
+  Iterator UpperBound(const KeyType& Key) { return BoundIterator<Iterator>(Key, true); }
+  ConstIterator UpperBound(const KeyType& Key) const { return BoundIterator<ConstIterator>(Key, true); }
+
+  Member* Insert(const KeyType& Key, const ValueType& Value)
+  {
+    bool IsNew;
+    Member* pMember = _Insert(Key, Value, &IsNew);
+    AssertMsg(IsNew, "Attempting to insert an already-existing key to B-tree.");
+    return pMember;
+  }
+
+  Member* Set(const KeyType& Key, const ValueType& Value, bool* IsNew)
+  {
+    bool IsNew_;
+    Member* pMember = _Insert(Key, Value, &IsNew_);
+    if (!IsNew_)
+    {
+      // overwrite member value
+      pMember->Value = Value;
+    }
+
+    if (IsNew != nullptr)
+      *IsNew = IsNew_;
+
+    return pMember;
+  }
+
+  bool Remove(const KeyType& Key)
+  {
+    if (m_pRoot == nullptr || !RemoveFromNode(m_pRoot, Key))
+      return false;
+
+    m_nMembers--;
+
+    // the root may have as few entries as it likes, but shrinks the tree when it has none
+    if (m_pRoot->Count == 0)
+    {
+      Node* pOldRoot = m_pRoot;
+      if (m_pRoot->IsLeaf)
+      {
+        m_pRoot = nullptr;
+        m_pFirstLeaf = nullptr;
+        delete static_cast<Leaf*>(pOldRoot);
+      }
+      else
+      {
+        m_pRoot = static_cast<Inner*>(pOldRoot)->pChildren[0];
+        delete static_cast<Inner*>(pOldRoot);
+      }
+    }
+
+    return true;
+  }
+
+  // returns an iterator pointing to the first member
+  Iterator Begin() { return Iterator(m_pFirstLeaf, 0); }
+  ConstIterator Begin() const { return ConstIterator(m_pFirstLeaf, 0); }
+
+  // returns an iterator past the last member
+  Iterator End() { return Iterator(); }
+  ConstIterator End() const { return ConstIterator(); }
+
+private:
+  static const uint32 LeafMinCount = LeafCapacity / 2;
+  static const uint32 InnerMinCount = InnerCapacity / 2;
+
+  static void DeleteNode(Node* pNode)
+  {
+    if (pNode->IsLeaf)
+    {
+      delete static_cast<Leaf*>(pNode);
+      return;
+    }
+
+    Inner* pInner = static_cast<Inner*>(pNode);
+    for (uint32 i = 0; i <= pInner->Count; i++)
+      DeleteNode(pInner->pChildren[i]);
+    delete pInner;
+  }
+
+  // index of the child of pInner that would hold Key
+  uint32 ChildIndex(const Inner* pInner, const KeyType& Key) const
+  {
+    uint32 first = 0;
+    uint32 count = pInner->Count;
+    while (count > 0)
+    {
+      uint32 half = count / 2;
+      if (!m_compare(Key, pInner->Keys[first + half]))
+      {
+        first += half + 1;
+        count -= half + 1;
+      }
+      else
+      {
+        count = half;
+      }
+    }
+
+    return first;
+  }
+
+  // index of the first member of pLeaf not ordering before Key, or ordering after it if upper is set
+  uint32 LeafLowerBound(const Leaf* pLeaf, const KeyType& Key, bool upper = false) const
+  {
+    uint32 first = 0;
+    uint32 count = pLeaf->Count;
+    while (count > 0)
+    {
+      uint32 half = count / 2;
+      const KeyType& memberKey = pLeaf->Members[first + half].Key;
+      if (upper ? !m_compare(Key, memberKey) : m_compare(memberKey, Key))
+      {
+        first += half + 1;
+        count -= half + 1;
+      }
+      else
+      {
+        count = half;
+      }
+    }
+
+    return first;
+  }
+
+  Leaf* FindLeaf(const KeyType& Key) const
+  {
+    Node* pNode = m_pRoot;
+    while (!pNode->IsLeaf)
+    {
+      const Inner* pInner = static_cast<const Inner*>(pNode);
+      pNode = pInner->pChildren[ChildIndex(pInner, Key)];
+    }
+
+    return static_cast<Leaf*>(pNode);
+  }
+
+  template<class IteratorType>
+  IteratorType BoundIterator(const KeyType& Key, bool upper) const
+  {
+    if (m_pRoot == nullptr)
+      return IteratorType();
+
+    Leaf* pLeaf = FindLeaf(Key);
+    return IteratorType(pLeaf, LeafLowerBound(pLeaf, Key, upper));
+  }
+
+  Member* _Insert(const KeyType& Key, const ValueType& Value, bool* IsNew)
+  {
+    if (m_pRoot == nullptr)
+    {
+      Leaf* pLeaf = new Leaf();
+      pLeaf->Count = 0;
+      pLeaf->IsLeaf = true;
+      pLeaf->pPrev = nullptr;
+      pLeaf->pNext = nullptr;
+      m_pRoot = pLeaf;
+      m_pFirstLeaf = pLeaf;
+    }
+
+    Member* pMember;
+    KeyType splitKey;
+    Node* pSplitNode = InsertIntoNode(m_pRoot, Key, Value, IsNew, &pMember, &splitKey);
+    if (pSplitNode != nullptr)
+    {
+      // the root split, so the tree grows a level
+      Inner* pNewRoot = new Inner();
+      pNewRoot->Count = 1;
+      pNewRoot->IsLeaf = false;
+      pNewRoot->Keys[0] = splitKey;
+      pNewRoot->pChildren[0] = m_pRoot;
+      pNewRoot->pChildren[1] = pSplitNode;
+      m_pRoot = pNewRoot;
+    }
+
+    if (*IsNew)
+      m_nMembers++;
+
+    return pMember;
+  }
+
+  // Inserts into the subtree under pNode. When the node was full it's split first, and the new right half is
+  // returned, with the lowest key under it in pSplitKey, for the caller to add to the parent.
+  Node* InsertIntoNode(Node* pNode, const KeyType& Key, const ValueType& Value, bool* IsNew, Member** ppMember,
+                       KeyType* pSplitKey)
+  {
+    if (pNode->IsLeaf)
+    {
+      Leaf* pLeaf = static_cast<Leaf*>(pNode);
+      uint32 index = LeafLowerBound(pLeaf, Key);
+      if (index < pLeaf->Count && !m_compare(Key, pLeaf->Members[index].Key))
+      {
+        *IsNew = false;
+        *ppMember = &pLeaf->Members[index];
+        return nullptr;
+      }
+
+      *IsNew = true;
+      if (pLeaf->Count < LeafCapacity)
+      {
+        *ppMember = InsertIntoLeaf(pLeaf, index, Key, Value);
+        return nullptr;
+      }
+
+      // move the upper half to a new leaf after this one
+      Leaf* pRight = new Leaf();
+      uint32 keep = LeafCapacity / 2;
+      pRight->IsLeaf = true;
+      pRight->Count = LeafCapacity - keep;
+      for (uint32 i = 0; i < pRight->Count; i++)
+        pRight->Members[i] = pLeaf->Members[keep + i];
+      pLeaf->Count = keep;
+
+      pRight->pPrev = pLeaf;
+      pRight->pNext = pLeaf->pNext;
+      if (pLeaf->pNext != nullptr)
+        pLeaf->pNext->pPrev = pRight;
+      pLeaf->pNext = pRight;
+
+      if (index <= keep)
+        *ppMember = InsertIntoLeaf(pLeaf, index, Key, Value);
+      else
+        *ppMember = InsertIntoLeaf(pRight, index - keep, Key, Value);
+
+      *pSplitKey = pRight->Members[0].Key;
+      return pRight;
+    }
+
+    Inner* pInner = static_cast<Inner*>(pNode);
+    uint32 childIndex = ChildIndex(pInner, Key);
+    KeyType childSplitKey;
+    Node* pChildSplit = InsertIntoNode(pInner->pChildren[childIndex], Key, Value, IsNew, ppMember, &childSplitKey);
+    if (pChildSplit == nullptr)
+      return nullptr;
+
+    if (pInner->Count < InnerCapacity)
+    {
+      InsertIntoInner(pInner, childIndex, childSplitKey, pChildSplit);
+      return nullptr;
+    }
+
+    // the middle key moves up to the parent, the keys and children after it to a new node
+    Inner* pRight = new Inner();
+    uint32 middle = InnerCapacity / 2;
+    pRight->IsLeaf = false;
+    pRight->Count = InnerCapacity - middle - 1;
+    for (uint32 i = 0; i < pRight->Count; i++)
+      pRight->Keys[i] = pInner->Keys[middle + 1 + i];
+    for (uint32 i = 0; i <= pRight->Count; i++)
+      pRight->pChildren[i] = pInner->pChildren[middle + 1 + i];
+    *pSplitKey = pInner->Keys[middle];
+    pInner->Count = middle;
+
+    if (childIndex <= middle)
+      InsertIntoInner(pInner, childIndex, childSplitKey, pChildSplit);
+    else
+      InsertIntoInner(pRight, childIndex - middle - 1, childSplitKey, pChildSplit);
+
+    return pRight;
+  }
+
+  static Member* InsertIntoLeaf(Leaf* pLeaf, uint32 index, const KeyType& Key, const ValueType& Value)
+  {
+    for (uint32 i = pLeaf->Count; i > index; i--)
+      pLeaf->Members[i] = pLeaf->Members[i - 1];
+
+    pLeaf->Members[index].Key = Key;
+    pLeaf->Members[index].Value = Value;
+    pLeaf->Count++;
+    return &pLeaf->Members[index];
+  }
+
+  // adds pChild after child childIndex, with Key separating them
+  static void InsertIntoInner(Inner* pInner, uint32 childIndex, const KeyType& Key, Node* pChild)
+  {
+    for (uint32 i = pInner->Count; i > childIndex; i--)
+    {
+      pInner->Keys[i] = pInner->Keys[i - 1];
+      pInner->pChildren[i + 1] = pInner->pChildren[i];
+    }
+
+    pInner->Keys[childIndex] = Key;
+    pInner->pChildren[childIndex + 1] = pChild;
+    pInner->Count++;
+  }
+
+  // Removes Key from the subtree under pNode, leaving pNode itself possibly under its minimum count for the caller
+  // to fix up, as it has the siblings.
+  bool RemoveFromNode(Node* pNode, const KeyType& Key)
+  {
+    if (pNode->IsLeaf)
+    {
+      Leaf* pLeaf = static_cast<Leaf*>(pNode);
+      uint32 index = LeafLowerBound(pLeaf, Key);
+      if (index == pLeaf->Count || m_compare(Key, pLeaf->Members[index].Key))
+        return false;
+
+      for (uint32 i = index + 1; i < pLeaf->Count; i++)
+        pLeaf->Members[i - 1] = pLeaf->Members[i];
+      pLeaf->Count--;
+      return true;
+    }
+
+    Inner* pInner = static_cast<Inner*>(pNode);
+    uint32 childIndex = ChildIndex(pInner, Key);
+    Node* pChild = pInner->pChildren[childIndex];
+    if (!RemoveFromNode(pChild, Key))
+      return false;
+
+    if (pChild->Count < (pChild->IsLeaf ? LeafMinCount : InnerMinCount))
+      Rebalance(pInner, childIndex);
+
+    return true;
+  }
+
+  // Tops up an underfull child from a sibling with entries to spare, or merges it with one.
+  static void Rebalance(Inner* pParent, uint32 childIndex)
+  {
+    Node* pChild = pParent->pChildren[childIndex];
+    Node* pLeft = (childIndex > 0) ? pParent->pChildren[childIndex - 1] : nullptr;
+    Node* pRight = (childIndex < pParent->Count) ? pParent->pChildren[childIndex + 1] : nullptr;
+    uint32 minCount = pChild->IsLeaf ? LeafMinCount : InnerMinCount;
+
+    if (pLeft != nullptr && pLeft->Count > minCount)
+    {
+      if (pChild->IsLeaf)
+        BorrowFromLeftLeaf(pParent, childIndex);
+      else
+        BorrowFromLeftInner(pParent, childIndex);
+    }
+    else if (pRight != nullptr && pRight->Count > minCount)
+    {
+      if (pChild->IsLeaf)
+        BorrowFromRightLeaf(pParent, childIndex);
+      else
+        BorrowFromRightInner(pParent, childIndex);
+    }
+    else
+    {
+      // neither sibling can spare one, so the two together fit in one node
+      uint32 leftIndex = (pLeft != nullptr) ? (childIndex - 1) : childIndex;
+      if (pChild->IsLeaf)
+        MergeLeaves(pParent, leftIndex);
+      else
+        MergeInners(pParent, leftIndex);
+    }
+  }
+
+  static void BorrowFromLeftLeaf(Inner* pParent, uint32 childIndex)
+  {
+    Leaf* pChild = static_cast<Leaf*>(pParent->pChildren[childIndex]);
+    Leaf* pLeft = static_cast<Leaf*>(pParent->pChildren[childIndex - 1]);
+    for (uint32 i = pChild->Count; i > 0; i--)
+      pChild->Members[i] = pChild->Members[i - 1];
+
+    pChild->Members[0] = pLeft->Members[--pLeft->Count];
+    pChild->Count++;
+    pParent->Keys[childIndex - 1] = pChild->Members[0].Key;
+  }
+
+  static void BorrowFromRightLeaf(Inner* pParent, uint32 childIndex)
+  {
+    Leaf* pChild = static_cast<Leaf*>(pParent->pChildren[childIndex]);
+    Leaf* pRight = static_cast<Leaf*>(pParent->pChildren[childIndex + 1]);
+    pChild->Members[pChild->Count++] = pRight->Members[0];
+
+    for (uint32 i = 1; i < pRight->Count; i++)
+      pRight->Members[i - 1] = pRight->Members[i];
+    pRight->Count--;
+    pParent->Keys[childIndex] = pRight->Members[0].Key;
+  }
+
+  // the separating key comes down from the parent, and the sibling's last key goes up in its place
+  static void BorrowFromLeftInner(Inner* pParent, uint32 childIndex)
+  {
+    Inner* pChild = static_cast<Inner*>(pParent->pChildren[childIndex]);
+    Inner* pLeft = static_cast<Inner*>(pParent->pChildren[childIndex - 1]);
+    pChild->pChildren[pChild->Count + 1] = pChild->pChildren[pChild->Count];
+    for (uint32 i = pChild->Count; i > 0; i--)
+    {
+      pChild->Keys[i] = pChild->Keys[i - 1];
+      pChild->pChildren[i] = pChild->pChildren[i - 1];
+    }
+
+    pChild->Keys[0] = pParent->Keys[childIndex - 1];
+    pChild->pChildren[0] = pLeft->pChildren[pLeft->Count];
+    pChild->Count++;
+    pParent->Keys[childIndex - 1] = pLeft->Keys[--pLeft->Count];
+  }
+
+  static void BorrowFromRightInner(Inner* pParent, uint32 childIndex)
+  {
+    Inner* pChild = static_cast<Inner*>(pParent->pChildren[childIndex]);
+    Inner* pRight = static_cast<Inner*>(pParent->pChildren[childIndex + 1]);
+    pChild->Keys[pChild->Count] = pParent->Keys[childIndex];
+    pChild->pChildren[pChild->Count + 1] = pRight->pChildren[0];
+    pChild->Count++;
+    pParent->Keys[childIndex] = pRight->Keys[0];
+
+    for (uint32 i = 1; i < pRight->Count; i++)
+      pRight->Keys[i - 1] = pRight->Keys[i];
+    for (uint32 i = 1; i <= pRight->Count; i++)
+      pRight->pChildren[i - 1] = pRight->pChildren[i];
+    pRight->Count--;
+  }
+
+  // removes the separator at index and the child after it from pParent
+  static void RemoveFromInner(Inner* pParent, uint32 index)
+  {
+    for (uint32 i = index + 1; i < pParent->Count; i++)
+    {
+      pParent->Keys[i - 1] = pParent->Keys[i];
+      pParent->pChildren[i] = pParent->pChildren[i + 1];
+    }
+
+    pParent->Count--;
+  }
+
+  // moves child leftIndex + 1 into child leftIndex
+  static void MergeLeaves(Inner* pParent, uint32 leftIndex)
+  {
+    Leaf* pLeft = static_cast<Leaf*>(pParent->pChildren[leftIndex]);
+    Leaf* pRight = static_cast<Leaf*>(pParent->pChildren[leftIndex + 1]);
+    for (uint32 i = 0; i < pRight->Count; i++)
+      pLeft->Members[pLeft->Count + i] = pRight->Members[i];
+    pLeft->Count += pRight->Count;
+
+    pLeft->pNext = pRight->pNext;
+    if (pRight->pNext != nullptr)
+      pRight->pNext->pPrev = pLeft;
+
+    RemoveFromInner(pParent, leftIndex);
+    delete pRight;
+  }
+
+  static void MergeInners(Inner* pParent, uint32 leftIndex)
+  {
+    Inner* pLeft = static_cast<Inner*>(pParent->pChildren[leftIndex]);
+    Inner* pRight = static_cast<Inner*>(pParent->pChildren[leftIndex + 1]);
+    pLeft->Keys[pLeft->Count] = pParent->Keys[leftIndex];
+    for (uint32 i = 0; i < pRight->Count; i++)
+      pLeft->Keys[pLeft->Count + 1 + i] = pRight->Keys[i];
+    for (uint32 i = 0; i <= pRight->Count; i++)
+      pLeft->pChildren[pLeft->Count + 1 + i] = pRight->pChildren[i];
+    pLeft->Count += pRight->Count + 1;
+
+    RemoveFromInner(pParent, leftIndex);
+    delete pRight;
+  }
+
+  Node* m_pRoot;
+  Leaf* m_pFirstLeaf;
+  uint32 m_nMembers;
+  Compare m_compare;
+
+  DeclareNonCopyable(BTreeMap);
+};
+
+template<typename KeyType, typename ValueType, class Compare, uint32 NodeBytes>
+const uint32 BTreeMap<KeyType, ValueType, Compare, NodeBytes>::LeafCapacity;
+template<typename KeyType, typename ValueType, class Compare, uint32 NodeBytes>
+const uint32 BTreeMap<KeyType, ValueType, Compare, NodeBytes>::InnerCapacity;
+template<typename KeyType, typename ValueType, class Compare, uint32 NodeBytes>
+const uint32 BTreeMap<KeyType, ValueType, Compare, NodeBytes>::LeafMinCount;
+template<typename KeyType, typename ValueType, class Compare, uint32 NodeBytes>
+const uint32 BTreeMap<KeyType, ValueType, Compare, NodeBytes>::InnerMinCount;
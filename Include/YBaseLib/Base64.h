@@ -0,0 +1,81 @@
+#pragma once
+#include "YBaseLib/Common.h"
+
+class ByteStream;
+class String;
+
+// Base64 text, in the standard alphabet or the URL and filename safe one from RFC 4648, which has '-' and '_' in
+// place of '+' and '/'. Encoding and decoding run 24 bytes at a time with AVX2 when the cpu has it, or 48 with NEON.
+// Decoding accepts either alphabet, with or without padding.
+enum BASE64_ALPHABET
+{
+  BASE64_ALPHABET_STANDARD,
+  BASE64_ALPHABET_URL_SAFE,
+  BASE64_ALPHABET_COUNT,
+};
+
+namespace Base64 {
+// characters for the bytes, rounded up to a multiple of four when padded
+uint32 GetEncodedLength(uint32 byteLength, bool padding = true);
+
+// the most bytes text of the length can hold
+uint32 GetMaxDecodedLength(uint32 textLength);
+
+// Writes GetEncodedLength characters, without a terminator, and returns how many that was.
+uint32 Encode(char* pDestination, const void* pData, uint32 dataLength,
+              BASE64_ALPHABET alphabet = BASE64_ALPHABET_STANDARD, bool padding = true);
+void Encode(String& destination, const void* pData, uint32 dataLength,
+            BASE64_ALPHABET alphabet = BASE64_ALPHABET_STANDARD, bool padding = true);
+
+// Returns false, with nothing decoded, if the text has a character outside the alphabets or padding anywhere but
+// the end, is a length no encoding has, or decodes to more than destinationSize bytes.
+bool Decode(void* pDestination, uint32 destinationSize, const char* pText, uint32 textLength,
+            uint32* pDecodedLength);
+} // namespace Base64
+
+// Encodes bytes as they're written, writing the text to a stream. Up to two bytes are held until more come, or
+// Finish writes them with the padding.
+class Base64Encoder
+{
+public:
+  Base64Encoder(ByteStream* pStream, BASE64_ALPHABET alphabet = BASE64_ALPHABET_STANDARD, bool padding = true);
+
+  // Returns false if the stream can't be written to.
+  bool Write(const void* pData, uint32 length);
+  bool Finish();
+
+private:
+  ByteStream* m_pStream;
+  BASE64_ALPHABET m_alphabet;
+  bool m_padding;
+  byte m_pending[2];
+  uint32 m_pendingLength;
+
+  DeclareNonCopyable(Base64Encoder);
+};
+
+// Decodes text as it's written, writing the bytes to a stream. Whitespace, like line breaks in wrapped text, is
+// skipped. Up to three characters are held until more come, or Finish decodes them.
+class Base64Decoder
+{
+public:
+  Base64Decoder(ByteStream* pStream);
+
+  // Returns false if the text isn't base64, or the stream can't be written to, after which the decoder stops.
+  bool Write(const char* pText, uint32 length);
+
+  // Returns false if the text can't end where it did.
+  bool Finish();
+
+private:
+  // decodes the gathered characters, keeping any last partial group
+  bool DecodePending(bool finish);
+
+  ByteStream* m_pStream;
+  char m_pending[1024];
+  uint32 m_pendingLength;
+  uint32 m_paddingLength;
+  bool m_errorState;
+
+  DeclareNonCopyable(Base64Decoder);
+};
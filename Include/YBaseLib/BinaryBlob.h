@@ -4,30 +4,43 @@
 
 class ByteStream;
 
+// Blobs up to MaxPooledSize are carved from blocks of a few fixed size classes, holding the blob and its data
+// together. Released blocks go back to a free list for their class rather than to the heap, so short-lived blobs cost
+// a couple of pointer moves. Larger blobs come from the heap as before.
 class BinaryBlob : public ReferenceCounted
 {
 public:
-  static BinaryBlob* Allocate(uint32 DataSize);
-  static BinaryBlob* CreateFromPointer(const void* pData, uint32 dataSize);
-  static BinaryBlob* CreateFromStream(ByteStream* pStream, bool seekToStart = true, int32 byteCount = -1);
+  static const size_t MaxPooledSize = 65536;
 
-  // inline const byte *GetDataPointer() const { return reinterpret_cast<const byte *>(this + 1); }
-  // inline byte *GetDataPointer() { return reinterpret_cast<byte *>(this + 1); }
+  static BinaryBlob* Allocate(size_t DataSize);
+  static BinaryBlob* CreateFromPointer(const void* pData, size_t dataSize);
+  static BinaryBlob* CreateFromStream(ByteStream* pStream, bool seekToStart = true, int64 byteCount = -1);
+
+  // References byteCount bytes from offset directly when the stream is in memory (see ByteStream::GetBasePointer),
+  // holding a reference to the stream, so mapped files are used without copying. The data must not be written to,
+  // and neither may the stream while the blob exists. Other streams are read into a new blob. Doesn't move the
+  // stream's position. A negative byteCount is to the end of the stream.
+  static BinaryBlob* CreateFromMappedStream(ByteStream* pStream, uint64 offset = 0, int64 byteCount = -1);
 
   inline const byte* GetDataPointer() const { return m_pDataPointer; }
   inline byte* GetDataPointer() { return m_pDataPointer; }
-  inline uint32 GetDataSize() const { return m_iDataSize; }
+  inline size_t GetDataSize() const { return m_iDataSize; }
+
+  // Returns a blob sharing size bytes of this one's data from offset, without copying. It holds a reference to this
+  // blob, so the data stays alive for as long as either does, and writes through one are seen by the other.
+  BinaryBlob* CreateView(size_t offset, size_t size) const;
 
   // creates a read-only stream from this blob
   ByteStream* CreateReadOnlyStream() const;
 
-  // Detaches the buffer from this stream, rendering the blob itself useless. Free this buffer with Y_free.
-  void DetachMemory(void** ppMemory, uint32* pSize);
+  // Detaches the buffer from this stream, rendering the blob itself useless. Free this buffer with Y_free. Blobs that
+  // don't own a heap buffer of their own (pooled, views and mapped) copy their data into one.
+  virtual void DetachMemory(void** ppMemory, size_t* pSize);
 
 protected:
-  BinaryBlob(uint32 iDataSize);
-  ~BinaryBlob();
+  BinaryBlob(byte* pDataPointer, size_t iDataSize);
+  virtual ~BinaryBlob();
 
   byte* m_pDataPointer;
-  uint32 m_iDataSize;
+  size_t m_iDataSize;
 };
@@ -0,0 +1,154 @@
+#pragma once
+#include "YBaseLib/Array.h"
+#include "YBaseLib/BinaryReader.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/FlatHashTable.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/Timer.h"
+#include "YBaseLib/TypedFormat.h"
+#include <cstdarg>
+
+class ByteStream;
+
+// Log messages kept as their format strings and raw arguments, so nothing is formatted by the thread logging. Each
+// format string, channel and function name goes into the stream once, the first time it's seen, and messages refer
+// to them by number, followed by the arguments in variable length integers. The text is rendered later, from the
+// stream, by BinaryLogReader. See Log::SetBinaryOutput.
+//   BinaryLogReader reader(pStream);
+//   BinaryLogReader::Message message;
+//   while (reader.ReadMessage(&message))
+//     Log_InfoPrint(message.Text);
+// Values are stored in the writer's byte order, the reader checks it matches its own.
+namespace BinaryLog {
+// the first bytes of the stream, "YBLG"
+static const uint32 Magic = 0x474C4259;
+static const uint32 Version = 1;
+
+enum RECORD_TYPE
+{
+  RECORD_TYPE_STRING = 1,
+  RECORD_TYPE_MESSAGE = 2,
+};
+
+enum MESSAGE_KIND
+{
+  MESSAGE_KIND_TEXT,   // the message as is
+  MESSAGE_KIND_PRINTF, // a printf format string and its arguments
+  MESSAGE_KIND_FORMAT, // a TypedFormat format string and its arguments
+};
+} // namespace BinaryLog
+
+// Writes messages to a stream, one caller at a time, the log serializes them. Records go to the stream with a
+// single write each, so it should be buffered, see BufferedByteStream.
+class BinaryLogWriter
+{
+public:
+  // Writes the header, message times are from startTimeStamp. The stream is referenced until the writer is deleted,
+  // which flushes it.
+  BinaryLogWriter(ByteStream* pStream, Y_TIMER_VALUE startTimeStamp);
+  ~BinaryLogWriter();
+
+  // Set once a write to the stream has failed, nothing more is written.
+  bool InErrorState() const { return m_errorState; }
+
+  // Each returns false if nothing was written, for printf conversions that can't be captured, %n and wide strings,
+  // for arguments with custom formatters, and once the writer is in an error state. The message is formatted as
+  // usual then. Format strings, channel and function names are looked up by address, with the contents compared to
+  // the copy kept, so they don't have to be literals.
+  bool WriteText(const char* channelName, const char* functionName, LOGLEVEL level, const char* message,
+                 uint32 messageLength);
+  bool WritePrintf(const char* channelName, const char* functionName, LOGLEVEL level, const char* format,
+                   va_list ap);
+  bool WriteFormatted(const char* channelName, const char* functionName, LOGLEVEL level, const StringView& format,
+                      const TypedFormat::Argument* pArguments, uint32 argumentCount);
+
+  bool Flush();
+
+private:
+  struct InternedString
+  {
+    uint32 ID;
+    uint32 Offset;
+    uint32 Length;
+  };
+
+  // The number of the string at the address, adding a string record for it if it's new or has changed.
+  uint32 InternString(const char* pString, uint32 length);
+
+  // writes the string records added since the last message, then the message with the payload gathered
+  bool WriteMessage(BinaryLog::MESSAGE_KIND kind, const char* channelName, const char* functionName, LOGLEVEL level,
+                    uint32 formatID);
+
+  ByteStream* m_pStream;
+  Y_TIMER_VALUE m_lastTimeStamp;
+  bool m_errorState;
+
+  // copies of the strings written, by address
+  FlatHashTable<const char*, InternedString> m_strings;
+  PODArray<char> m_stringData;
+  uint32 m_nextStringID;
+
+  // the record being built, and the arguments of its message
+  PODArray<byte> m_record;
+  PODArray<byte> m_payload;
+
+  DeclareNonCopyable(BinaryLogWriter);
+};
+
+// Reads messages back from a binary log, rendering their text.
+class BinaryLogReader
+{
+public:
+  struct Message
+  {
+    String ChannelName;
+    String FunctionName;
+    LOGLEVEL Level;
+
+    // seconds from the start of the log, which is the start of the process for Log's
+    double Time;
+
+    String Text;
+  };
+
+  // The stream is referenced until the reader is deleted, and read from its current position.
+  BinaryLogReader(ByteStream* pStream);
+  ~BinaryLogReader();
+
+  // Reads the next message, returning false at the end of the stream, or at a record that's cut short or doesn't
+  // make sense, which IsDamaged tells apart. A log whose writer didn't get to flush usually ends in part of a record.
+  bool ReadMessage(Message* pMessage);
+  bool IsDamaged() const { return m_damaged; }
+
+  // Renders a binary log as lines of text, with the same prefixes as the console output. Returns false if the log
+  // is damaged or the output can't be written, after writing what could be read.
+  static bool DecodeToText(ByteStream* pInput, ByteStream* pOutput);
+
+private:
+  bool ReadHeader();
+  bool ReadStringRecord();
+
+  // renders the payload of a message of the kind into the text, returning false if it doesn't fit the format
+  bool RenderPrintf(const String& format, String& text);
+  bool RenderFormat(const String& format, String& text);
+
+  // the string for a number from a message
+  const String* GetString(uint64 id) const;
+
+  ByteStream* m_pStream;
+  BinaryReader m_reader;
+  bool m_headerRead;
+  bool m_damaged;
+  double m_secondsPerTick;
+  uint64 m_timeStamp;
+
+  // by number, from 1
+  Array<String> m_strings;
+
+  PODArray<byte> m_payload;
+  PODArray<TypedFormat::Argument> m_arguments;
+
+  DeclareNonCopyable(BinaryLogReader);
+};
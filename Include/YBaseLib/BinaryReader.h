@@ -1,20 +1,37 @@
 #pragma once
+#include "YBaseLib/Assert.h"
 #include "YBaseLib/ByteStream.h"
 #include "YBaseLib/Common.h"
 #include "YBaseLib/Endian.h"
 #include "YBaseLib/String.h"
+#include <cstring>
 
 // implements a class that can read/write common types
 // it will automatically perform endianness conversion for multibyte types, if needed.
 class BinaryReader
 {
 public:
+  // longest a variable length integer gets, a full 64-bit value
+  static const uint32 MaxVarIntSize = 10;
+
   // constructs a reader using the specified stream and the endianness of the stream.
   // if throwExceptions is set to false, and it goes past EOF/errors, 0's will be returned.
-  BinaryReader(ByteStream* pStream, ENDIAN_TYPE streamByteOrder = Y_HOST_ENDIAN_TYPE, bool ignoreErrors = false);
+  // A buffered reader reads ahead, straight from a read view if the stream has them, otherwise through a buffer of
+  // its own, so reading a field is a bounds check and a copy rather than a call into the stream. The stream's
+  // position runs ahead of or behind the reader's until SyncStream is called, which GetStream and the destructor do.
+  BinaryReader(ByteStream* pStream, ENDIAN_TYPE streamByteOrder = Y_HOST_ENDIAN_TYPE, bool ignoreErrors = false,
+               bool buffered = false);
+  ~BinaryReader();
+
+  // returns the pointer to the underlying stream of this reader, at the reader's position
+  ByteStream* GetStream()
+  {
+    SyncStream();
+    return m_pStream;
+  }
 
-  // returns the pointer to the underlying stream of this reader
-  ByteStream* GetStream() { return m_pStream; }
+  // moves the stream to the reader's position and drops anything read ahead, a no-op for unbuffered readers
+  void SyncStream();
 
   // returns the error state of the reader
   bool GetErrorState() const { return m_errorState || m_pStream->InErrorState(); }
@@ -25,7 +42,7 @@ public:
   }
 
   // these alter the underlying stream
-  uint64 GetStreamPosition() { return m_pStream->GetPosition(); }
+  uint64 GetStreamPosition();
   void SeekAbsolute(uint64 position);
   void SeekRelative(int64 offset);
   void SeekToEnd();
@@ -66,29 +83,115 @@ public:
   bool SafeReadSizePrefixedString(String* pValue);
 
   // endian-specific type readers
-  int16 ReadInt16();
-  uint16 ReadUInt16();
-  int32 ReadInt32();
-  uint32 ReadUInt32();
-  int64 ReadInt64();
-  uint64 ReadUInt64();
-  float ReadFloat();
-  double ReadDouble();
+  int16 ReadInt16() { return InternalReadValue<int16>(); }
+  uint16 ReadUInt16() { return InternalReadValue<uint16>(); }
+  int32 ReadInt32() { return InternalReadValue<int32>(); }
+  uint32 ReadUInt32() { return InternalReadValue<uint32>(); }
+  int64 ReadInt64() { return InternalReadValue<int64>(); }
+  uint64 ReadUInt64() { return InternalReadValue<uint64>(); }
+  float ReadFloat() { return InternalReadValue<float>(); }
+  double ReadDouble() { return InternalReadValue<double>(); }
 
   // safe variants
-  bool SafeReadInt16(int16* pValue);
-  bool SafeReadUInt16(uint16* pValue);
-  bool SafeReadInt32(int32* pValue);
-  bool SafeReadUInt32(uint32* pValue);
-  bool SafeReadInt64(int64* pValue);
-  bool SafeReadUInt64(uint64* pValue);
-  bool SafeReadFloat(float* pValue);
-  bool SafeReadDouble(double* pValue);
+  bool SafeReadInt16(int16* pValue) { return SafeInternalReadValue(pValue); }
+  bool SafeReadUInt16(uint16* pValue) { return SafeInternalReadValue(pValue); }
+  bool SafeReadInt32(int32* pValue) { return SafeInternalReadValue(pValue); }
+  bool SafeReadUInt32(uint32* pValue) { return SafeInternalReadValue(pValue); }
+  bool SafeReadInt64(int64* pValue) { return SafeInternalReadValue(pValue); }
+  bool SafeReadUInt64(uint64* pValue) { return SafeInternalReadValue(pValue); }
+  bool SafeReadFloat(float* pValue) { return SafeInternalReadValue(pValue); }
+  bool SafeReadDouble(double* pValue) { return SafeInternalReadValue(pValue); }
+
+  // Variable length integers as BinaryWriter writes them, LEB128 with signed values zigzag encoded. Encodings that
+  // run past ten bytes or don't fit the type are errors, like reading past the end.
+  uint32 ReadVarUInt32();
+  uint64 ReadVarUInt64();
+  int32 ReadVarInt32() { return ZigZagDecode(ReadVarUInt32()); }
+  int64 ReadVarInt64() { return ZigZagDecode(ReadVarUInt64()); }
+  bool SafeReadVarUInt32(uint32* pValue);
+  bool SafeReadVarUInt64(uint64* pValue);
+  bool SafeReadVarInt32(int32* pValue);
+  bool SafeReadVarInt64(int64* pValue);
+
+  // Reads count variable length integers. Buffered readers decode them in blocks straight out of what's been read
+  // ahead, eight at a time while they're single bytes.
+  void ReadVarUInt32Array(uint32* pValues, uint32 count);
+  void ReadVarUInt64Array(uint64* pValues, uint32 count);
+  void ReadVarInt32Array(int32* pValues, uint32 count);
+  void ReadVarInt64Array(int64* pValues, uint32 count);
+  bool SafeReadVarUInt32Array(uint32* pValues, uint32 count);
+  bool SafeReadVarUInt64Array(uint64* pValues, uint32 count);
+  bool SafeReadVarInt32Array(int32* pValues, uint32 count);
+  bool SafeReadVarInt64Array(int64* pValues, uint32 count);
+
+  // Reads bitCount bits, up to 64, packed as BinaryWriter::WriteBits packs them. What's left of the last byte read
+  // stays for the next call, AlignToByte drops it before reading anything else or seeking.
+  uint64 ReadBits(uint32 bitCount);
+  bool SafeReadBits(uint32 bitCount, uint64* pValue);
+  void AlignToByte()
+  {
+    m_bitBuffer = 0;
+    m_bitCount = 0;
+  }
+
+  // reverses BinaryWriter::ZigZagEncode
+  static int32 ZigZagDecode(uint32 v) { return (int32)((v >> 1) ^ (0 - (v & 1))); }
+  static int64 ZigZagDecode(uint64 v) { return (int64)((v >> 1) ^ (0 - (v & 1))); }
+
+  // decodes a variable length integer from at most available bytes, returning the number used, or zero if it runs
+  // past them or past the ten bytes a 64-bit value can take
+  static uint32 DecodeVarUInt(const byte* pSource, uint32 available, uint64* pValue)
+  {
+    uint64 value = 0;
+    uint32 limit = (available < MaxVarIntSize) ? available : MaxVarIntSize;
+    for (uint32 i = 0; i < limit; i++)
+    {
+      byte b = pSource[i];
+      value |= (uint64)(b & 0x7F) << (i * 7);
+      if (b < 0x80)
+      {
+        // the tenth byte only has room for the top bit
+        if (i == MaxVarIntSize - 1 && b > 1)
+          return 0;
+
+        *pValue = value;
+        return i + 1;
+      }
+    }
+
+    return 0;
+  }
+
+  // reads count values of a 1, 2, 4 or 8 byte type, byte swapping them all at once if the stream's endianness
+  // differs, see Y_byteswap_array
+  template<typename T>
+  void ReadArray(T* pValues, uint32 count)
+  {
+    DebugAssert(count <= 0xFFFFFFFF / sizeof(T));
+    if (sizeof(T) > 1 && m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
+      InternalReadSwappedArray(pValues, count, (uint32)sizeof(T));
+    else
+      InternalReadBytes(pValues, count * (uint32)sizeof(T));
+  }
+  template<typename T>
+  bool SafeReadArray(T* pValues, uint32 count)
+  {
+    DebugAssert(count <= 0xFFFFFFFF / sizeof(T));
+    if (sizeof(T) > 1 && m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
+      return SafeInternalReadSwappedArray(pValues, count, (uint32)sizeof(T));
+
+    return SafeInternalReadBytes(pValues, count * (uint32)sizeof(T));
+  }
 
   // reads a variable number of bytes from the stream, no endian conversion is done
   void ReadBytes(void* dst, uint32 dstSize);
   bool SafeReadBytes(void* dst, uint32 dstSize);
 
+  // Returns a pointer to the next bytes in the stream itself and skips over them, for streams with read views, see
+  // ByteStream::AcquireReadView. Returns null if the stream has no views, or if fewer bytes are left, which also
+  // sets the error state. The pointer is only valid until the stream is next used.
+  const void* ReadBytesInPlace(uint32 byteCount);
+
   // reads a user-specified type from the stream, no endian conversion is done.
   template<typename T>
   T ReadType()
@@ -165,11 +268,98 @@ public:
 
 protected:
   // internal function that reads the actual data from the stream, and does error checking
-  void InternalReadBytes(void* pDestination, uint32 cbDestination);
-  bool SafeInternalReadBytes(void* pDestination, uint32 cbDestination);
+  // reads that fit in what's been read ahead don't leave the header
+  void InternalReadBytes(void* pDestination, uint32 cbDestination)
+  {
+    if (cbDestination > 0 && cbDestination <= (uint32)(m_pBufferEnd - m_pBufferPosition))
+    {
+      std::memcpy(pDestination, m_pBufferPosition, cbDestination);
+      m_pBufferPosition += cbDestination;
+      return;
+    }
+
+    InternalReadBytesUnbuffered(pDestination, cbDestination);
+  }
+  bool SafeInternalReadBytes(void* pDestination, uint32 cbDestination)
+  {
+    if (cbDestination > 0 && cbDestination <= (uint32)(m_pBufferEnd - m_pBufferPosition))
+    {
+      std::memcpy(pDestination, m_pBufferPosition, cbDestination);
+      m_pBufferPosition += cbDestination;
+      return true;
+    }
+
+    return SafeInternalReadBytesUnbuffered(pDestination, cbDestination);
+  }
+  void InternalReadBytesUnbuffered(void* pDestination, uint32 cbDestination);
+  bool SafeInternalReadBytesUnbuffered(void* pDestination, uint32 cbDestination);
+
+  // swapped straight out of what's been read ahead, otherwise read and then swapped in place
+  void InternalReadSwappedArray(void* pValues, uint32 count, uint32 elementSize);
+  bool SafeInternalReadSwappedArray(void* pValues, uint32 count, uint32 elementSize);
+
+  template<typename T>
+  T InternalReadValue()
+  {
+    T value;
+    InternalReadBytes(&value, sizeof(T));
+    if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
+      Y_byteswap_array(&value, 1, sizeof(T));
+
+    return value;
+  }
+  template<typename T>
+  bool SafeInternalReadValue(T* pValue)
+  {
+    if (!SafeInternalReadBytes(pValue, sizeof(T)))
+      return false;
+
+    if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
+      Y_byteswap_array(pValue, 1, sizeof(T));
+
+    return true;
+  }
+
+  // single byte varints come straight out of the buffer
+  bool InternalReadVarUInt(uint64* pValue, bool safe)
+  {
+    if (m_pBufferPosition != m_pBufferEnd && *m_pBufferPosition < 0x80)
+    {
+      *pValue = *m_pBufferPosition++;
+      return true;
+    }
+
+    return InternalReadVarUIntSlow(pValue, safe);
+  }
+  bool InternalReadVarUIntSlow(uint64* pValue, bool safe);
+  bool InternalReadVarUIntFailed(uint64* pValue, bool safe);
+
+  template<typename T>
+  bool InternalReadVarIntArray(T* pValues, uint32 count, bool safe);
+  bool InternalReadBits(uint32 bitCount, uint64* pValue, bool safe);
+
+  // reads ahead so at least minimumSize bytes are buffered, false if the stream doesn't have that many left
+  bool FillBuffer(uint32 minimumSize);
+
+  // reads a C string straight out of a read view, false if there isn't one or the string isn't terminated
+  bool ReadCStringInPlace(String& dest);
 
   ByteStream* m_pStream;
   ENDIAN_TYPE m_eStreamByteOrder;
   bool m_ignoreErrors;
   bool m_errorState;
+
+  // what's been read ahead and not used yet, empty for unbuffered readers and after errors. m_pBufferStart is the
+  // start of the stream's view, or of m_pReadBuffer, which is only allocated for streams without views.
+  const byte* m_pBufferStart;
+  const byte* m_pBufferPosition;
+  const byte* m_pBufferEnd;
+  byte* m_pReadBuffer;
+  bool m_buffered;
+
+  // bits read from the stream and not used yet, lowest first
+  uint64 m_bitBuffer;
+  uint32 m_bitCount;
+
+  DeclareNonCopyable(BinaryReader);
 };
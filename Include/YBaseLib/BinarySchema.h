@@ -0,0 +1,567 @@
+#pragma once
+#include "YBaseLib/Array.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/BinaryReader.h"
+#include "YBaseLib/BinaryWriter.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/StringView.h"
+#include <cstring>
+#include <type_traits>
+
+// Serialization from a list of a type's fields, in place of a hand written sequence of reads and writes. An encoded
+// object is a header, a fixed part holding the plain fields and a slot for each of the others, then the strings,
+// arrays and nested objects the slots point at, by offset from the start of the object. Plain fields next to each
+// other in the type and in the fixed part are copied as one, and a view reads any field straight from the encoding,
+// a mapped file say, without decoding the rest.
+//
+// Fields are appended, never removed or reordered, each with the version it was added in. An older reader doesn't
+// see the newer fields on the end of the fixed part, and a newer one finds the older encoding's fixed part short and
+// leaves the fields past it as they are, reading them from a view as a default constructed object has them. The
+// encoding is little endian.
+//   BEGIN_BINARY_SCHEMA(MeshInfo)
+//     BINARY_SCHEMA_FIELD(VertexCount)
+//     BINARY_SCHEMA_FIELD(IndexCount)
+//     BINARY_SCHEMA_FIELD(Name)
+//     BINARY_SCHEMA_FIELD_SINCE(Bounds, 2)
+//   END_BINARY_SCHEMA()
+//
+//   BinarySchema::Write(&writer, meshInfo);
+//   BinarySchemaView<MeshInfo> view(pMappedData, mappedSize);
+//   uint32 vertexCount = view.Get(&MeshInfo::VertexCount);
+
+namespace BinarySchemaFormat {
+// objects, and the arrays and objects in them, start on this boundary, and their sizes are multiples of it
+static const uint32 Alignment = 8;
+
+struct Header
+{
+  // everything the object's slots point at is within its total size
+  uint32 TotalSize;
+  uint32 FixedSize;
+  uint32 Version;
+  uint32 Reserved;
+};
+
+// A string's is its length, without the terminating zero that follows it, an array's is its element count, and a
+// nested object's is its total size. An array of objects is a table of their offsets, the slot's count of them.
+struct Slot
+{
+  uint32 Offset;
+  uint32 Count;
+};
+} // namespace BinarySchemaFormat
+
+// Specialized by BEGIN_BINARY_SCHEMA for the types that have a schema.
+template<typename T>
+struct BinarySchemaDefinition
+{
+  static const bool IsDefined = false;
+};
+
+template<typename M, typename Enable = void>
+struct BinarySchemaFieldTraits;
+
+class BinarySchema
+{
+public:
+  enum FieldKind
+  {
+    FieldKind_Plain,
+    FieldKind_String,
+    FieldKind_PODArray,
+    FieldKind_Object,
+    FieldKind_ObjectArray,
+  };
+
+  // Appends what the member points at, and sets its slot, at slotPosition in the buffer.
+  typedef void (*EncodeFieldFunction)(const void* pMember, PODArray<byte>* pBuffer, uint32 objectStart,
+                                      uint32 slotPosition);
+
+  // Returns false if what the slot points at is out of the object, or damaged.
+  typedef bool (*DecodeFieldFunction)(void* pMember, const byte* pObject, uint32 objectSize,
+                                      const BinarySchemaFormat::Slot& slot);
+
+  struct Field
+  {
+    const char* Name;
+    FieldKind Kind;
+    uint32 MemberOffset;
+    uint32 FixedOffset;
+    uint32 Size;
+    uint32 Alignment;
+    uint32 SinceVersion;
+
+    // null for plain fields
+    EncodeFieldFunction EncodeFunction;
+    DecodeFieldFunction DecodeFunction;
+  };
+
+  typedef void (*DefineFunction)(BinarySchema* pSchema);
+
+  static const uint32 LatestVersion = 0xFFFFFFFF;
+
+  // pDefaultObject is what a view reads the fields an encoding doesn't have from.
+  BinarySchema(const char* typeName, DefineFunction defineFunction, const void* pDefaultObject);
+  ~BinarySchema();
+
+  template<typename T>
+  static const BinarySchema* Get()
+  {
+    static_assert(BinarySchemaDefinition<T>::IsDefined, "the type has a schema");
+    return BinarySchemaDefinition<T>::Get();
+  }
+
+  const char* GetTypeName() const { return m_typeName; }
+  uint32 GetVersion() const { return m_version; }
+  uint32 GetFieldCount() const { return m_fields.GetSize(); }
+  const Field& GetField(uint32 index) const { return m_fields[index]; }
+  const void* GetDefaultObject() const { return m_pDefaultObject; }
+
+  // the field for a member, or null if it isn't one of them
+  const Field* FindField(uint32 memberOffset) const;
+
+  template<typename T, typename M>
+  static uint32 GetMemberOffset(M T::*pMember)
+  {
+    // measured on storage no T is constructed in, the way offsetof would be
+    static const typename std::aligned_storage<sizeof(T), alignof(T)>::type storage = {};
+    const T* pObject = reinterpret_cast<const T*>(&storage);
+    return (uint32)(reinterpret_cast<const byte*>(&(pObject->*pMember)) - reinterpret_cast<const byte*>(pObject));
+  }
+
+  // Called from the schema's definition, in the order the fields are encoded in. Fields added since a version go
+  // after all those from before it.
+  template<typename T, typename M>
+  void AddField(const char* name, M T::*pMember, uint32 sinceVersion)
+  {
+    Field field;
+    field.Name = name;
+    field.MemberOffset = GetMemberOffset(pMember);
+    field.SinceVersion = sinceVersion;
+    BinarySchemaFieldTraits<M>::Describe(&field);
+    AddField(field);
+  }
+
+  // Appends the object's encoding, starting aligned, returning the offset it starts at. With an older version only
+  // the fields an older reader knows are written.
+  template<typename T>
+  static uint32 Encode(const T& value, PODArray<byte>* pBuffer, uint32 version = LatestVersion)
+  {
+    return Get<T>()->EncodeObject(&value, pBuffer, version);
+  }
+
+  // Sets the fields the encoding has, leaving the rest. Returns false if it's damaged, when the object is only
+  // partly decoded.
+  template<typename T>
+  static bool Decode(const void* pData, size_t size, T* pValue)
+  {
+    return Get<T>()->DecodeObject(pValue, pData, size);
+  }
+
+  // Encodes the object into memory and writes it in one go. As the encodings' sizes are aligned, a run of objects
+  // written from an aligned position can be viewed in place once mapped.
+  template<typename T>
+  static bool Write(BinaryWriter* pWriter, const T& value, uint32 version = LatestVersion)
+  {
+    PODArray<byte> buffer;
+    Encode(value, &buffer, version);
+    return pWriter->SafeWriteBytes(buffer.GetBasePointer(), buffer.GetSize());
+  }
+
+  template<typename T>
+  static bool Read(BinaryReader* pReader, T* pValue)
+  {
+    PODArray<byte> buffer;
+    const void* pData;
+    uint32 size;
+    return ReadEncoding(pReader, &buffer, &pData, &size) && Decode(pData, size, pValue);
+  }
+
+  // The next object's encoding, whole, where the reader has it in place (see BinaryReader::ReadBytesInPlace), or
+  // read into the buffer otherwise. Only valid until the reader's next used.
+  static bool ReadEncoding(BinaryReader* pReader, PODArray<byte>* pBuffer, const void** ppData, uint32* pSize);
+
+  uint32 EncodeObject(const void* pObject, PODArray<byte>* pBuffer, uint32 version) const;
+  bool DecodeObject(void* pObject, const void* pData, size_t size) const;
+
+  // The header, if the encoding's sizes agree with each other and with the size of the data.
+  static bool ReadHeader(const void* pData, size_t size, BinarySchemaFormat::Header* pHeader);
+
+  // Pads the buffer to the alignment and appends size bytes, zeroed if there's no data, returning their offset.
+  static uint32 AppendData(PODArray<byte>* pBuffer, const void* pData, uint32 size);
+  static void SetSlot(PODArray<byte>* pBuffer, uint32 slotPosition, uint32 offset, uint32 count);
+
+  // What an offset from the start of an object points at, or null if size bytes from there aren't in the object.
+  // Offsets point past the header, so a damaged one can't lead back to the object it's in.
+  static const byte* GetObjectData(const byte* pObject, uint32 objectSize, uint32 offset, uint64 size);
+
+private:
+  // plain fields laid out the same in the type and the fixed part, back to back, copied together
+  struct Run
+  {
+    uint32 MemberOffset;
+    uint32 FixedOffset;
+    uint32 Size;
+    uint32 SinceVersion;
+    uint32 FirstField;
+    uint32 FieldCount;
+  };
+
+  void AddField(const Field& field);
+  void Finalize();
+
+  const char* m_typeName;
+  const void* m_pDefaultObject;
+  PODArray<Field> m_fields;
+  PODArray<Run> m_runs;
+  uint32 m_fixedSize;
+  uint32 m_version;
+
+  DeclareNonCopyable(BinarySchema);
+};
+
+// An encoded object, read in place. The data is aligned to BinarySchemaFormat::Alignment, and stays put while the
+// view and the views from it are used. Only the header is checked up front, fields are checked as they're read, and
+// one that's missing or damaged reads as it would from a default constructed object, as does every field of an
+// invalid view.
+template<typename T>
+class BinarySchemaView
+{
+public:
+  BinarySchemaView() : m_pData(nullptr), m_size(0), m_fixedSize(0), m_version(0) {}
+  BinarySchemaView(const void* pData, size_t size) : m_pData(nullptr), m_size(0), m_fixedSize(0), m_version(0)
+  {
+    DebugAssert(((uintptr_t)pData % BinarySchemaFormat::Alignment) == 0);
+    BinarySchemaFormat::Header header;
+    if (BinarySchema::ReadHeader(pData, size, &header))
+    {
+      m_pData = static_cast<const byte*>(pData);
+      m_size = header.TotalSize;
+      m_fixedSize = header.FixedSize;
+      m_version = header.Version;
+    }
+  }
+
+  bool IsValid() const { return (m_pData != nullptr); }
+  const void* GetData() const { return m_pData; }
+  uint32 GetSize() const { return m_size; }
+  uint32 GetVersion() const { return m_version; }
+
+  // A plain field is returned by reference, a string as a StringView, a PODArray as a BinarySchemaArrayView, an
+  // object as a BinarySchemaView and an Array of them as a BinarySchemaObjectArrayView.
+  template<typename M>
+  typename BinarySchemaFieldTraits<M>::ViewType Get(M T::*pMember) const
+  {
+    const BinarySchema* pSchema = BinarySchema::Get<T>();
+    const BinarySchema::Field* pField = pSchema->FindField(BinarySchema::GetMemberOffset(pMember));
+    DebugAssertMsg(pField != nullptr, "the member is in the schema");
+
+    const byte* pFixedField = nullptr;
+    if (m_pData != nullptr && pField->FixedOffset + pField->Size <= m_fixedSize)
+      pFixedField = m_pData + pField->FixedOffset;
+
+    const M& defaultValue =
+      *reinterpret_cast<const M*>(static_cast<const byte*>(pSchema->GetDefaultObject()) + pField->MemberOffset);
+    return BinarySchemaFieldTraits<M>::View(m_pData, m_size, pFixedField, defaultValue);
+  }
+
+private:
+  const byte* m_pData;
+  uint32 m_size;
+  uint32 m_fixedSize;
+  uint32 m_version;
+};
+
+template<typename T>
+class BinarySchemaArrayView
+{
+public:
+  BinarySchemaArrayView(const T* pElements, uint32 count) : m_pElements(pElements), m_count(count) {}
+
+  uint32 GetSize() const { return m_count; }
+  bool IsEmpty() const { return (m_count == 0); }
+  const T* GetBasePointer() const { return m_pElements; }
+  const T& operator[](uint32 index) const
+  {
+    DebugAssert(index < m_count);
+    return m_pElements[index];
+  }
+
+  const T* begin() const { return m_pElements; }
+  const T* end() const { return m_pElements + m_count; }
+
+private:
+  const T* m_pElements;
+  uint32 m_count;
+};
+
+template<typename T>
+class BinarySchemaObjectArrayView
+{
+public:
+  BinarySchemaObjectArrayView() : m_pObject(nullptr), m_objectSize(0), m_pOffsets(nullptr), m_count(0) {}
+  BinarySchemaObjectArrayView(const byte* pObject, uint32 objectSize, const byte* pOffsets, uint32 count)
+    : m_pObject(pObject), m_objectSize(objectSize), m_pOffsets(pOffsets), m_count(count)
+  {
+  }
+
+  uint32 GetSize() const { return m_count; }
+  bool IsEmpty() const { return (m_count == 0); }
+
+  // an invalid view if the element's out of the object it's in
+  BinarySchemaView<T> operator[](uint32 index) const
+  {
+    DebugAssert(index < m_count);
+    uint32 offset;
+    std::memcpy(&offset, m_pOffsets + index * sizeof(uint32), sizeof(offset));
+
+    const byte* pElement =
+      BinarySchema::GetObjectData(m_pObject, m_objectSize, offset, sizeof(BinarySchemaFormat::Header));
+    return (pElement != nullptr) ? BinarySchemaView<T>(pElement, m_objectSize - offset) : BinarySchemaView<T>();
+  }
+
+private:
+  const byte* m_pObject;
+  uint32 m_objectSize;
+  const byte* m_pOffsets;
+  uint32 m_count;
+};
+
+// Anything trivially copyable is a plain field, copied as it is.
+template<typename M, typename Enable>
+struct BinarySchemaFieldTraits
+{
+  static_assert(std::is_trivially_copyable<M>::value, "fields are trivially copyable, or have a schema");
+  static_assert(alignof(M) <= BinarySchemaFormat::Alignment, "fields are aligned to the encoding's alignment");
+
+  typedef const M& ViewType;
+
+  static void Describe(BinarySchema::Field* pField)
+  {
+    pField->Kind = BinarySchema::FieldKind_Plain;
+    pField->Size = sizeof(M);
+    pField->Alignment = alignof(M);
+    pField->EncodeFunction = nullptr;
+    pField->DecodeFunction = nullptr;
+  }
+
+  static ViewType View(const byte*, uint32, const byte* pFixedField, const M& defaultValue)
+  {
+    return (pFixedField != nullptr) ? *reinterpret_cast<const M*>(pFixedField) : defaultValue;
+  }
+};
+
+// The rest are held in the fixed part by a slot.
+struct BinarySchemaVariableFieldTraits
+{
+  static void Describe(BinarySchema::Field* pField, BinarySchema::FieldKind kind,
+                       BinarySchema::EncodeFieldFunction encodeFunction,
+                       BinarySchema::DecodeFieldFunction decodeFunction)
+  {
+    pField->Kind = kind;
+    pField->Size = sizeof(BinarySchemaFormat::Slot);
+    pField->Alignment = alignof(BinarySchemaFormat::Slot);
+    pField->EncodeFunction = encodeFunction;
+    pField->DecodeFunction = decodeFunction;
+  }
+
+  static BinarySchemaFormat::Slot ReadSlot(const byte* pFixedField)
+  {
+    BinarySchemaFormat::Slot slot;
+    std::memcpy(&slot, pFixedField, sizeof(slot));
+    return slot;
+  }
+};
+
+template<>
+struct BinarySchemaFieldTraits<String>
+{
+  typedef StringView ViewType;
+
+  static void Describe(BinarySchema::Field* pField)
+  {
+    BinarySchemaVariableFieldTraits::Describe(pField, BinarySchema::FieldKind_String, &Encode, &Decode);
+  }
+
+  static void Encode(const void* pMember, PODArray<byte>* pBuffer, uint32 objectStart, uint32 slotPosition);
+  static bool Decode(void* pMember, const byte* pObject, uint32 objectSize, const BinarySchemaFormat::Slot& slot);
+  static ViewType View(const byte* pObject, uint32 objectSize, const byte* pFixedField, const String& defaultValue);
+};
+
+template<typename U>
+struct BinarySchemaFieldTraits<PODArray<U>>
+{
+  static_assert(std::is_trivially_copyable<U>::value, "array elements are trivially copyable");
+  static_assert(alignof(U) <= BinarySchemaFormat::Alignment, "array elements are aligned to the encoding's alignment");
+
+  typedef BinarySchemaArrayView<U> ViewType;
+
+  static void Describe(BinarySchema::Field* pField)
+  {
+    BinarySchemaVariableFieldTraits::Describe(pField, BinarySchema::FieldKind_PODArray, &Encode, &Decode);
+  }
+
+  static void Encode(const void* pMember, PODArray<byte>* pBuffer, uint32 objectStart, uint32 slotPosition)
+  {
+    const PODArray<U>* pArray = static_cast<const PODArray<U>*>(pMember);
+    uint32 offset = BinarySchema::AppendData(pBuffer, pArray->GetBasePointer(), pArray->GetSize() * sizeof(U));
+    BinarySchema::SetSlot(pBuffer, slotPosition, offset - objectStart, pArray->GetSize());
+  }
+
+  static bool Decode(void* pMember, const byte* pObject, uint32 objectSize, const BinarySchemaFormat::Slot& slot)
+  {
+    const byte* pElements =
+      BinarySchema::GetObjectData(pObject, objectSize, slot.Offset, (uint64)slot.Count * sizeof(U));
+    if (pElements == nullptr)
+      return false;
+
+    PODArray<U>* pArray = static_cast<PODArray<U>*>(pMember);
+    pArray->Resize(slot.Count);
+    if (slot.Count > 0)
+      std::memcpy(pArray->GetBasePointer(), pElements, slot.Count * sizeof(U));
+
+    return true;
+  }
+
+  static ViewType View(const byte* pObject, uint32 objectSize, const byte* pFixedField,
+                       const PODArray<U>& defaultValue)
+  {
+    if (pFixedField != nullptr)
+    {
+      BinarySchemaFormat::Slot slot = BinarySchemaVariableFieldTraits::ReadSlot(pFixedField);
+      const byte* pElements =
+        BinarySchema::GetObjectData(pObject, objectSize, slot.Offset, (uint64)slot.Count * sizeof(U));
+      if (pElements != nullptr)
+        return ViewType(reinterpret_cast<const U*>(pElements), slot.Count);
+    }
+
+    return ViewType(defaultValue.GetBasePointer(), defaultValue.GetSize());
+  }
+};
+
+// Types with a schema nest, encoded as they would be on their own, so their schema is defined first.
+template<typename U>
+struct BinarySchemaFieldTraits<U, typename std::enable_if<BinarySchemaDefinition<U>::IsDefined>::type>
+{
+  typedef BinarySchemaView<U> ViewType;
+
+  static void Describe(BinarySchema::Field* pField)
+  {
+    BinarySchemaVariableFieldTraits::Describe(pField, BinarySchema::FieldKind_Object, &Encode, &Decode);
+  }
+
+  static void Encode(const void* pMember, PODArray<byte>* pBuffer, uint32 objectStart, uint32 slotPosition)
+  {
+    uint32 offset = BinarySchema::Get<U>()->EncodeObject(pMember, pBuffer, BinarySchema::LatestVersion);
+    BinarySchema::SetSlot(pBuffer, slotPosition, offset - objectStart, pBuffer->GetSize() - offset);
+  }
+
+  static bool Decode(void* pMember, const byte* pObject, uint32 objectSize, const BinarySchemaFormat::Slot& slot)
+  {
+    const byte* pData = BinarySchema::GetObjectData(pObject, objectSize, slot.Offset, slot.Count);
+    return (pData != nullptr && BinarySchema::Get<U>()->DecodeObject(pMember, pData, slot.Count));
+  }
+
+  static ViewType View(const byte* pObject, uint32 objectSize, const byte* pFixedField, const U&)
+  {
+    if (pFixedField != nullptr)
+    {
+      BinarySchemaFormat::Slot slot = BinarySchemaVariableFieldTraits::ReadSlot(pFixedField);
+      const byte* pData = BinarySchema::GetObjectData(pObject, objectSize, slot.Offset, slot.Count);
+      if (pData != nullptr)
+        return ViewType(pData, slot.Count);
+    }
+
+    return ViewType();
+  }
+};
+
+template<typename U>
+struct BinarySchemaFieldTraits<Array<U>>
+{
+  static_assert(BinarySchemaDefinition<U>::IsDefined, "array elements have a schema, or go in a PODArray");
+
+  typedef BinarySchemaObjectArrayView<U> ViewType;
+
+  static void Describe(BinarySchema::Field* pField)
+  {
+    BinarySchemaVariableFieldTraits::Describe(pField, BinarySchema::FieldKind_ObjectArray, &Encode, &Decode);
+  }
+
+  static void Encode(const void* pMember, PODArray<byte>* pBuffer, uint32 objectStart, uint32 slotPosition)
+  {
+    const Array<U>* pArray = static_cast<const Array<U>*>(pMember);
+    const BinarySchema* pSchema = BinarySchema::Get<U>();
+    uint32 tableOffset = BinarySchema::AppendData(pBuffer, nullptr, pArray->GetSize() * sizeof(uint32));
+    BinarySchema::SetSlot(pBuffer, slotPosition, tableOffset - objectStart, pArray->GetSize());
+
+    for (uint32 i = 0; i < pArray->GetSize(); i++)
+    {
+      uint32 elementOffset = pSchema->EncodeObject(&(*pArray)[i], pBuffer, BinarySchema::LatestVersion) - objectStart;
+      std::memcpy(pBuffer->GetBasePointer() + tableOffset + i * sizeof(uint32), &elementOffset, sizeof(uint32));
+    }
+  }
+
+  static bool Decode(void* pMember, const byte* pObject, uint32 objectSize, const BinarySchemaFormat::Slot& slot)
+  {
+    const byte* pOffsets =
+      BinarySchema::GetObjectData(pObject, objectSize, slot.Offset, (uint64)slot.Count * sizeof(uint32));
+    if (pOffsets == nullptr)
+      return false;
+
+    Array<U>* pArray = static_cast<Array<U>*>(pMember);
+    const BinarySchema* pSchema = BinarySchema::Get<U>();
+    pArray->Resize(slot.Count);
+    for (uint32 i = 0; i < slot.Count; i++)
+    {
+      uint32 offset;
+      std::memcpy(&offset, pOffsets + i * sizeof(uint32), sizeof(offset));
+
+      const byte* pElement =
+        BinarySchema::GetObjectData(pObject, objectSize, offset, sizeof(BinarySchemaFormat::Header));
+      if (pElement == nullptr || !pSchema->DecodeObject(&(*pArray)[i], pElement, objectSize - offset))
+        return false;
+    }
+
+    return true;
+  }
+
+  static ViewType View(const byte* pObject, uint32 objectSize, const byte* pFixedField, const Array<U>&)
+  {
+    if (pFixedField != nullptr)
+    {
+      BinarySchemaFormat::Slot slot = BinarySchemaVariableFieldTraits::ReadSlot(pFixedField);
+      const byte* pOffsets =
+        BinarySchema::GetObjectData(pObject, objectSize, slot.Offset, (uint64)slot.Count * sizeof(uint32));
+      if (pOffsets != nullptr)
+        return ViewType(pObject, objectSize, pOffsets, slot.Count);
+    }
+
+    return ViewType();
+  }
+};
+
+// Defines a type's schema, at global scope, after the schemas of the types it holds.
+#define BEGIN_BINARY_SCHEMA(Type)                                                                                      \
+  template<>                                                                                                           \
+  struct BinarySchemaDefinition<Type>                                                                                  \
+  {                                                                                                                    \
+    typedef Type SchemaType;                                                                                           \
+    static const bool IsDefined = true;                                                                                \
+    static const BinarySchema* Get()                                                                                   \
+    {                                                                                                                  \
+      static const Type defaultObject{};                                                                               \
+      static const BinarySchema schema(#Type, &DefineFields, &defaultObject);                                          \
+      return &schema;                                                                                                  \
+    }                                                                                                                  \
+    static void DefineFields(BinarySchema* pSchema)                                                                    \
+    {
+
+#define BINARY_SCHEMA_FIELD(Name) pSchema->AddField(#Name, &SchemaType::Name, 1);
+#define BINARY_SCHEMA_FIELD_SINCE(Name, Version) pSchema->AddField(#Name, &SchemaType::Name, Version);
+
+#define END_BINARY_SCHEMA()                                                                                            \
+  }                                                                                                                    \
+  };
@@ -1,20 +1,37 @@
 #pragma once
+#include "YBaseLib/Assert.h"
 #include "YBaseLib/ByteStream.h"
 #include "YBaseLib/Common.h"
 #include "YBaseLib/Endian.h"
 #include "YBaseLib/String.h"
+#include <cstring>
 
 // implements a class that can read/write common types
 // it will automatically perform endianness conversion for multibyte types, if needed.
 class BinaryWriter
 {
 public:
+  // longest a variable length integer gets, a full 64-bit value
+  static const uint32 MaxVarIntSize = 10;
+
   // constructs a reader using the specified stream and the endianness of the stream.
   // if throwExceptions is set to false, and it goes past EOF/errors, 0's will be returned.
-  BinaryWriter(ByteStream* pStream, ENDIAN_TYPE streamByteOrder = Y_HOST_ENDIAN_TYPE, bool ignoreErrors = false);
+  // A buffered writer collects fields straight in a write view if the stream has them, otherwise in a buffer of its
+  // own, and hands them to the stream in bulk. Nothing reaches the stream until SyncStream is called, which
+  // GetStream, the seek functions and the destructor do, and write errors only show up then.
+  BinaryWriter(ByteStream* pStream, ENDIAN_TYPE streamByteOrder = Y_HOST_ENDIAN_TYPE, bool ignoreErrors = false,
+               bool buffered = false);
+  ~BinaryWriter();
+
+  // returns the pointer to the underlying stream of this reader, with everything written to it
+  ByteStream* GetStream()
+  {
+    SyncStream();
+    return m_pStream;
+  }
 
-  // returns the pointer to the underlying stream of this reader
-  ByteStream* GetStream() { return m_pStream; }
+  // passes anything buffered on to the stream, false if it couldn't all be written
+  bool SyncStream();
 
   // returns the error state of the writer
   bool InErrorState() const { return m_errorState || m_pStream->InErrorState(); }
@@ -25,7 +42,7 @@ public:
   }
 
   // these alter the underlying stream
-  uint64 GetStreamPosition() { return m_pStream->GetPosition(); }
+  uint64 GetStreamPosition() { return m_pStream->GetPosition() + (uint64)(m_pBufferPosition - m_pBufferStart); }
   void SeekAbsolute(uint64 position);
   void SeekRelative(int64 offset);
   void SeekToEnd();
@@ -78,24 +95,90 @@ public:
   bool SafeWriteSizePrefixedString(const char* str, uint32 len);
 
   // endian-specific type readers
-  void WriteInt16(const int16 v);
-  void WriteUInt16(const uint16 v);
-  void WriteInt32(const int32 v);
-  void WriteUInt32(const uint32 v);
-  void WriteInt64(const int64& v);
-  void WriteUInt64(const uint64& v);
-  void WriteFloat(const float& v);
-  void WriteDouble(const double& v);
+  void WriteInt16(const int16 v) { InternalWriteValue(v); }
+  void WriteUInt16(const uint16 v) { InternalWriteValue(v); }
+  void WriteInt32(const int32 v) { InternalWriteValue(v); }
+  void WriteUInt32(const uint32 v) { InternalWriteValue(v); }
+  void WriteInt64(const int64& v) { InternalWriteValue(v); }
+  void WriteUInt64(const uint64& v) { InternalWriteValue(v); }
+  void WriteFloat(const float& v) { InternalWriteValue(v); }
+  void WriteDouble(const double& v) { InternalWriteValue(v); }
 
   // safe variants
-  bool SafeWriteInt16(const int16 v);
-  bool SafeWriteUInt16(const uint16 v);
-  bool SafeWriteInt32(const int32 v);
-  bool SafeWriteUInt32(const uint32 v);
-  bool SafeWriteInt64(const int64& v);
-  bool SafeWriteUInt64(const uint64& v);
-  bool SafeWriteFloat(const float& v);
-  bool SafeWriteDouble(const double& v);
+  bool SafeWriteInt16(const int16 v) { return SafeInternalWriteValue(v); }
+  bool SafeWriteUInt16(const uint16 v) { return SafeInternalWriteValue(v); }
+  bool SafeWriteInt32(const int32 v) { return SafeInternalWriteValue(v); }
+  bool SafeWriteUInt32(const uint32 v) { return SafeInternalWriteValue(v); }
+  bool SafeWriteInt64(const int64& v) { return SafeInternalWriteValue(v); }
+  bool SafeWriteUInt64(const uint64& v) { return SafeInternalWriteValue(v); }
+  bool SafeWriteFloat(const float& v) { return SafeInternalWriteValue(v); }
+  bool SafeWriteDouble(const double& v) { return SafeInternalWriteValue(v); }
+
+  // Variable length integers in LEB128: seven bits to a byte, lowest first, with the top bit set on every byte but
+  // the last, so values under 128 take one byte and a full 64-bit value ten. Signed values are zigzag encoded first,
+  // which keeps small negative numbers small. The encoding doesn't depend on the stream's byte order.
+  void WriteVarUInt32(const uint32 v) { InternalWriteVarUInt(v); }
+  void WriteVarUInt64(const uint64 v) { InternalWriteVarUInt(v); }
+  void WriteVarInt32(const int32 v) { InternalWriteVarUInt(ZigZagEncode(v)); }
+  void WriteVarInt64(const int64 v) { InternalWriteVarUInt(ZigZagEncode(v)); }
+  bool SafeWriteVarUInt32(const uint32 v) { return SafeInternalWriteVarUInt(v); }
+  bool SafeWriteVarUInt64(const uint64 v) { return SafeInternalWriteVarUInt(v); }
+  bool SafeWriteVarInt32(const int32 v) { return SafeInternalWriteVarUInt(ZigZagEncode(v)); }
+  bool SafeWriteVarInt64(const int64 v) { return SafeInternalWriteVarUInt(ZigZagEncode(v)); }
+
+  // writes count values as variable length integers, encoding them in blocks
+  void WriteVarUInt32Array(const uint32* pValues, uint32 count);
+  void WriteVarUInt64Array(const uint64* pValues, uint32 count);
+  void WriteVarInt32Array(const int32* pValues, uint32 count);
+  void WriteVarInt64Array(const int64* pValues, uint32 count);
+  bool SafeWriteVarUInt32Array(const uint32* pValues, uint32 count);
+  bool SafeWriteVarUInt64Array(const uint64* pValues, uint32 count);
+  bool SafeWriteVarInt32Array(const int32* pValues, uint32 count);
+  bool SafeWriteVarInt64Array(const int64* pValues, uint32 count);
+
+  // Writes the low bitCount bits of value, up to 64, packed low bits first into each byte. Bits are held back until
+  // they fill a byte, FlushBits pads the last one with zeros and writes it. Flush before writing anything else or
+  // seeking, the destructor flushes whatever is left.
+  void WriteBits(uint64 value, uint32 bitCount) { InternalWriteBits(value, bitCount, false); }
+  bool SafeWriteBits(uint64 value, uint32 bitCount) { return InternalWriteBits(value, bitCount, true); }
+  void FlushBits() { InternalFlushBits(false); }
+  bool SafeFlushBits() { return InternalFlushBits(true); }
+
+  // zigzag encoding, 0, -1, 1, -2 become 0, 1, 2, 3
+  static uint32 ZigZagEncode(int32 v) { return ((uint32)v << 1) ^ (uint32)(v >> 31); }
+  static uint64 ZigZagEncode(int64 v) { return ((uint64)v << 1) ^ (uint64)(v >> 63); }
+
+  // encodes a variable length integer into at least MaxVarIntSize bytes, returning the number used
+  static uint32 EncodeVarUInt(byte* pDestination, uint64 value)
+  {
+    uint32 length = 0;
+    for (; value >= 0x80; value >>= 7)
+      pDestination[length++] = (byte)(value | 0x80);
+
+    pDestination[length++] = (byte)value;
+    return length;
+  }
+
+  // writes count values of a 1, 2, 4 or 8 byte type, byte swapping them in chunks if the stream's endianness
+  // differs, see Y_byteswap_array
+  template<typename T>
+  void WriteArray(const T* pValues, uint32 count)
+  {
+    DebugAssert(count <= 0xFFFFFFFF / sizeof(T));
+    if (sizeof(T) == 1 || m_eStreamByteOrder == Y_HOST_ENDIAN_TYPE)
+      InternalWriteBytes(pValues, count * (uint32)sizeof(T));
+    else
+      InternalWriteSwappedArray(pValues, count, (uint32)sizeof(T));
+  }
+  template<typename T>
+  bool SafeWriteArray(const T* pValues, uint32 count)
+  {
+    DebugAssert(count <= 0xFFFFFFFF / sizeof(T));
+    if (sizeof(T) == 1 || m_eStreamByteOrder == Y_HOST_ENDIAN_TYPE)
+      return SafeInternalWriteBytes(pValues, count * (uint32)sizeof(T));
+    else
+      return SafeInternalWriteSwappedArray(pValues, count, (uint32)sizeof(T));
+  }
 
   // reads a variable number of bytes from the stream, no endian conversion is done
   void WriteBytes(const void* src, uint32 len);
@@ -178,11 +261,99 @@ public:
 
 protected:
   // internal function that reads the actual data from the stream, and does error checking
-  void InternalWriteBytes(const void* pSource, uint32 cbSource);
-  bool SafeInternalWriteBytes(const void* pSource, uint32 cbSource);
+  // writes that fit in the buffer don't leave the header
+  void InternalWriteBytes(const void* pSource, uint32 cbSource)
+  {
+    if (cbSource > 0 && cbSource <= (uint32)(m_pBufferEnd - m_pBufferPosition))
+    {
+      std::memcpy(m_pBufferPosition, pSource, cbSource);
+      m_pBufferPosition += cbSource;
+      return;
+    }
+
+    InternalWriteBytesUnbuffered(pSource, cbSource);
+  }
+  bool SafeInternalWriteBytes(const void* pSource, uint32 cbSource)
+  {
+    if (cbSource > 0 && cbSource <= (uint32)(m_pBufferEnd - m_pBufferPosition))
+    {
+      std::memcpy(m_pBufferPosition, pSource, cbSource);
+      m_pBufferPosition += cbSource;
+      return true;
+    }
+
+    return SafeInternalWriteBytesUnbuffered(pSource, cbSource);
+  }
+  void InternalWriteBytesUnbuffered(const void* pSource, uint32 cbSource);
+  bool SafeInternalWriteBytesUnbuffered(const void* pSource, uint32 cbSource);
+  void InternalWriteSwappedArray(const void* pValues, uint32 count, uint32 elementSize);
+  bool SafeInternalWriteSwappedArray(const void* pValues, uint32 count, uint32 elementSize);
+
+  template<typename T>
+  void InternalWriteValue(T value)
+  {
+    if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
+      Y_byteswap_array(&value, 1, sizeof(T));
+
+    InternalWriteBytes(&value, sizeof(T));
+  }
+  template<typename T>
+  bool SafeInternalWriteValue(T value)
+  {
+    if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
+      Y_byteswap_array(&value, 1, sizeof(T));
+
+    return SafeInternalWriteBytes(&value, sizeof(T));
+  }
+
+  // varints are encoded in place when there's room in the buffer
+  void InternalWriteVarUInt(uint64 value)
+  {
+    if ((uint32)(m_pBufferEnd - m_pBufferPosition) >= MaxVarIntSize)
+    {
+      m_pBufferPosition += EncodeVarUInt(m_pBufferPosition, value);
+      return;
+    }
+
+    byte encoded[MaxVarIntSize];
+    InternalWriteBytes(encoded, EncodeVarUInt(encoded, value));
+  }
+  bool SafeInternalWriteVarUInt(uint64 value)
+  {
+    if ((uint32)(m_pBufferEnd - m_pBufferPosition) >= MaxVarIntSize)
+    {
+      m_pBufferPosition += EncodeVarUInt(m_pBufferPosition, value);
+      return true;
+    }
+
+    byte encoded[MaxVarIntSize];
+    return SafeInternalWriteBytes(encoded, EncodeVarUInt(encoded, value));
+  }
+
+  template<typename T>
+  bool InternalWriteVarIntArray(const T* pValues, uint32 count, bool safe);
+  bool InternalWriteBits(uint64 value, uint32 bitCount, bool safe);
+  bool InternalFlushBits(bool safe);
+
+  // makes room for at least minimumSize bytes in the buffer, false if the stream can't take that many at once
+  bool ReserveBuffer(uint32 minimumSize);
 
   ByteStream* m_pStream;
   ENDIAN_TYPE m_eStreamByteOrder;
   bool m_ignoreErrors;
   bool m_errorState;
+
+  // space for buffered writers, empty for unbuffered ones and after errors. it's a write view of the stream, or
+  // m_pWriteBuffer, which is only allocated for streams without views.
+  byte* m_pBufferStart;
+  byte* m_pBufferPosition;
+  byte* m_pBufferEnd;
+  byte* m_pWriteBuffer;
+  bool m_buffered;
+
+  // bits written that don't make up a whole byte yet, lowest first
+  uint64 m_bitBuffer;
+  uint32 m_bitCount;
+
+  DeclareNonCopyable(BinaryWriter);
 };
@@ -0,0 +1,215 @@
+#pragma once
+#include "YBaseLib/BinaryWriter.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/StringHashTable.h"
+#include "YBaseLib/StringView.h"
+#include "YBaseLib/XMLReader.h"
+
+// A binary form of an XML document, with BinaryXMLWriter in place of XMLWriter and BinaryXMLReader in place of
+// XMLReader. After a header of BinaryXMLMagic and BinaryXMLVersion as little endian uint32s, the document is a list
+// of records, each a BINARY_XML_RECORD byte followed by its contents:
+// - Names are varints, an index into the names seen so far counting from one, or zero followed by a new name's
+//   string, which takes the next index.
+// - Strings are a varint length, the characters and a null, so the reader hands out pointers into the document.
+// - Numbers are LEB128 varints, signed ones zigzag encoded, or little endian floats and doubles, like BinaryWriter.
+// An element's attribute records follow it, then its content, then an end record. BinaryXML::ConvertToText and
+// ConvertFromText turn documents into the text form and back, for tools and for editing by hand.
+static const uint32 BinaryXMLMagic = 0x4D584259; // 'YBXM'
+static const uint32 BinaryXMLVersion = 1;
+
+enum BINARY_XML_RECORD
+{
+  BINARY_XML_RECORD_END_DOCUMENT,
+  BINARY_XML_RECORD_ELEMENT,       // name
+  BINARY_XML_RECORD_END_ELEMENT,   //
+  BINARY_XML_RECORD_STRING,        // name, string
+  BINARY_XML_RECORD_INT,           // name, zigzag varint
+  BINARY_XML_RECORD_UINT,          // name, varint
+  BINARY_XML_RECORD_FLOAT,         // name, float
+  BINARY_XML_RECORD_DOUBLE,        // name, double
+  BINARY_XML_RECORD_TEXT,          // string
+  BINARY_XML_RECORD_CDATA,         // string
+  BINARY_XML_RECORD_RAW,           // string
+  BINARY_XML_RECORD_BINARY,        // varint length, bytes
+  BINARY_XML_RECORD_COUNT,
+};
+
+// XMLWriter's interface, with the typed attributes kept as numbers. Names are written once and referred to by index
+// after that. Attributes must come straight after StartElement, like XMLWriter. Writes are buffered, so errors
+// writing to the stream show up once Close has written everything out.
+class BinaryXMLWriter
+{
+public:
+  BinaryXMLWriter();
+  ~BinaryXMLWriter();
+
+  bool InErrorState() const { return m_bErrorState || (m_pWriter != NULL && m_pWriter->InErrorState()); }
+
+  // Close ends any open elements and the document
+  bool Create(ByteStream* pOutputStream);
+  void Close();
+
+  void WriteEmptyElement(const char* elementName);
+  void StartElement(const char* elementName);
+  void EndElement();
+
+  void WriteAttribute(const char* attributeName, const char* attributeValue);
+  void WriteAttributef(const char* attributeName, const char* format, ...);
+  void WriteAttributeInt32(const char* attributeName, int32 value) { WriteAttributeInt64(attributeName, value); }
+  void WriteAttributeUInt32(const char* attributeName, uint32 value) { WriteAttributeUInt64(attributeName, value); }
+  void WriteAttributeInt64(const char* attributeName, int64 value);
+  void WriteAttributeUInt64(const char* attributeName, uint64 value);
+  void WriteAttributeFloat(const char* attributeName, float value);
+  void WriteAttributeDouble(const char* attributeName, double value);
+
+  void WriteString(const char* data);
+  void WriteCDATA(const char* data);
+  void WriteRaw(const char* data, uint32 dataLength);
+
+  // kept as bytes, the reader gives them back as base64 text
+  void WriteBase64EncodedData(const void* pData, uint32 dataLength);
+
+private:
+  // false if the writer has failed or been closed
+  bool CanWrite() const { return (!m_bErrorState && m_pWriter != NULL); }
+
+  void WriteName(BINARY_XML_RECORD type, const StringView& name);
+  void WriteStringBody(const char* data, uint32 dataLength);
+  void WriteContent(BINARY_XML_RECORD type, const char* data, uint32 dataLength);
+  bool StartAttribute(BINARY_XML_RECORD type, const char* attributeName);
+
+  BinaryWriter* m_pWriter;
+  StringHashTable<uint32> m_nameIndices;
+  uint32 m_depth;
+  bool m_inStartTag;
+  bool m_bErrorState;
+
+  DeclareNonCopyable(BinaryXMLWriter);
+};
+
+// XMLReader's interface over a binary document, which is read where it is if the stream is in memory or read in
+// whole otherwise. Names and strings point into the document, only numbers and binary data are formatted as text,
+// when they're asked for. Pointers stay valid until the next NextToken. The typed fetches read numbers as they were
+// written, or parse them if they were written as text.
+class BinaryXMLReader
+{
+public:
+  BinaryXMLReader();
+  ~BinaryXMLReader();
+
+  bool Create(ByteStream* pInputStream, const char* FileName);
+
+  bool MoveToFirstAttribute();
+  bool MoveToNextAttribute();
+  bool MoveToAttribute(const char* AttributeName);
+  bool MoveToElement();
+
+  bool NextToken();
+  XMLREADER_TOKEN_TYPE GetTokenType() const { return m_eCurrentNodeType; }
+  const char* GetFileName() const { return m_szFileName; }
+
+  const char* GetNodeName();
+  const char* GetNodeValue();
+  const char* GetNodeValueString(); // same as GetNodeValue, except will never return null
+
+  const char* FetchAttribute(const char* AttributeName);
+  const char* FetchAttributeString(const char* AttributeName);
+  const char* FetchAttributeDefault(const char* attributeName, const char* defaultValue);
+  int64 FetchAttributeInt64(const char* attributeName, int64 defaultValue);
+  uint64 FetchAttributeUInt64(const char* attributeName, uint64 defaultValue);
+  double FetchAttributeDouble(const char* attributeName, double defaultValue);
+
+  String GetElementText(bool skipElement = false);
+
+  bool IsEmptyElement();
+
+  bool InErrorState() const { return m_bErrorState; }
+
+  void PrintWarning(const char* Format, ...);
+  void PrintError(const char* Format, ...);
+
+  bool SkipToElement(const char* ElementName);
+  bool SkipCurrentElement();
+
+  int32 Select(const char* SelectionString, bool AbortOnError = true);
+  int32 SelectAttribute(const char* AttributeName, const char* SelectionString, bool AbortOnError = true);
+
+  bool ExpectEndOfElement();
+  bool ExpectEndOfElementName(const char* nodeName);
+
+private:
+  // an attribute or text token's value, with the text of a number or binary data once it's been formatted
+  struct Value
+  {
+    BINARY_XML_RECORD Type;
+    StringView Text;
+    union
+    {
+      int64 Int;
+      uint64 UInt;
+      float Float;
+      double Double;
+    };
+    const char* pFormatted;
+  };
+  struct Attribute
+  {
+    StringView Name;
+    Value AttributeValue;
+  };
+
+  // the pieces of a record, which return false once they've reported the document is bad
+  bool ReadName(StringView* pName);
+  bool ReadString(StringView* pString);
+  bool ReadVarUInt(uint64* pValue);
+  bool ReadValue(BINARY_XML_RECORD type, Value* pValue);
+  bool CorruptDocument(const char* what);
+
+  // makes room for the token's formatted values without moving the ones given out already
+  void ResetStrings(uint32 maxLength);
+
+  // the text of a value, formatted into the strings buffer if it's a number or binary data
+  const char* GetValueText(Value* pValue);
+  Value* GetCurrentValue();
+
+  ByteStream* m_pInputStream;
+  const char* m_szFileName;
+
+  // the document, and what's been read of it
+  const byte* m_pDocument;
+  const byte* m_pDocumentEnd;
+  const byte* m_pPosition;
+  byte* m_pOwnedDocument;
+  PODArray<StringView> m_names;
+
+  // the current token, with the element's attributes
+  const byte* m_pTokenStart;
+  StringView m_name;
+  Value m_value;
+  bool m_isEmptyElement;
+  PODArray<Attribute> m_attributes;
+  int32 m_currentAttribute;
+  PODArray<StringView> m_openElements;
+
+  // formatted numbers and base64 text for the token, sized when it's read so nothing handed out moves
+  char* m_pStrings;
+  uint32 m_stringsSize;
+  uint32 m_stringsLength;
+
+  XMLREADER_TOKEN_TYPE m_eCurrentNodeType;
+  bool m_bErrorState;
+
+  DeclareNonCopyable(BinaryXMLReader);
+};
+
+namespace BinaryXML {
+// Reads a text document with XMLPullReader and writes it in binary. Attribute text that reads back as a number
+// exactly, like "12" or "0.5" but not "012", is kept as the number.
+bool ConvertFromText(ByteStream* pTextStream, const char* fileName, ByteStream* pBinaryStream);
+
+// Writes a binary document out as text, indented like XMLWriter's.
+bool ConvertToText(ByteStream* pBinaryStream, const char* fileName, ByteStream* pTextStream);
+} // namespace BinaryXML
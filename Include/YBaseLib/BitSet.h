@@ -3,11 +3,28 @@
 #include "YBaseLib/Common.h"
 #include "YBaseLib/Memory.h"
 
+// Bulk operations on raw bit set storage, vectorized with SSE2 or NEON, see BitSet.cpp.
+namespace BitSetOperations {
+
+// pDestination[i] op= pSource[i] for byteCount bytes
+void And(void* pDestination, const void* pSource, size_t byteCount);
+void Or(void* pDestination, const void* pSource, size_t byteCount);
+void Xor(void* pDestination, const void* pSource, size_t byteCount);
+void AndNot(void* pDestination, const void* pSource, size_t byteCount);
+
+size_t PopCount(const void* pValues, size_t byteCount);
+
+// offset of the first non-zero byte at or after startByte, or byteCount if the rest are all zero
+size_t FindNonZeroByte(const void* pValues, size_t startByte, size_t byteCount);
+
+}; // namespace BitSetOperations
+
+// Bits past GetBitCount() in the last value are always kept clear, so whole values can be compared and counted.
 template<typename TYPE>
 class BitSet
 {
 public:
-  const size_t BITS_PER_VALUE = sizeof(TYPE) * 8;
+  static const size_t BITS_PER_VALUE = sizeof(TYPE) * 8;
 
 public:
   BitSet() : m_values(nullptr), m_valueCount(0), m_bitCount(0) {}
@@ -17,9 +34,11 @@ public:
     m_values = (copy.m_values != nullptr) ? (TYPE*)Y_reallocarray(nullptr, copy.m_valueCount, sizeof(TYPE)) : nullptr;
     m_valueCount = copy.m_valueCount;
     m_bitCount = copy.m_bitCount;
+    if (m_values != nullptr)
+      std::memcpy(m_values, copy.m_values, sizeof(TYPE) * m_valueCount);
   }
 
-  BitSet(const BitSet&& from)
+  BitSet(BitSet&& from)
   {
     m_values = from.m_values;
     from.m_values = nullptr;
@@ -39,7 +58,7 @@ public:
     Resize(bits);
   }
 
-  ~BitSet() { std::free(m_values); }
+  ~BitSet() { Y_free(m_values); }
 
   TYPE* GetValuesPointer() { return m_values; }
   const TYPE* GetValuesPointer() const { return m_values; }
@@ -56,7 +75,7 @@ public:
     if (bits > 0)
     {
       size_t oldValues = m_valueCount;
-      size_t newValues = bits / BITS_PER_VALUE + 1;
+      size_t newValues = (bits + BITS_PER_VALUE - 1) / BITS_PER_VALUE;
       m_bitCount = bits;
       m_valueCount = newValues;
       if (oldValues != newValues)
@@ -65,10 +84,13 @@ public:
         if (m_valueCount > oldValues)
           Y_memzero(m_values + oldValues, sizeof(TYPE) * (m_valueCount - oldValues));
       }
+
+      // shrinking can leave set bits past the end
+      m_values[m_valueCount - 1] &= GetLastValueMask();
     }
     else
     {
-      std::free(m_values);
+      Y_free(m_values);
       m_values = nullptr;
       m_valueCount = m_bitCount = 0;
     }
@@ -77,16 +99,16 @@ public:
   bool TestBit(size_t bit) const
   {
     DebugAssert(bit < m_bitCount);
-    return (m_values[bit / BITS_PER_VALUE] & (1 << (bit % BITS_PER_VALUE))) != 0;
+    return (m_values[bit / BITS_PER_VALUE] & (TYPE(1) << (bit % BITS_PER_VALUE))) != 0;
   }
 
   void SetBit(size_t bit, bool on = true)
   {
     DebugAssert(bit < m_bitCount);
     if (on)
-      m_values[bit / BITS_PER_VALUE] |= TYPE(1 << (bit % BITS_PER_VALUE));
+      m_values[bit / BITS_PER_VALUE] |= TYPE(TYPE(1) << (bit % BITS_PER_VALUE));
     else
-      m_values[bit / BITS_PER_VALUE] &= ~TYPE(1 << (bit % BITS_PER_VALUE));
+      m_values[bit / BITS_PER_VALUE] &= ~TYPE(TYPE(1) << (bit % BITS_PER_VALUE));
   }
 
   void UnsetBit(size_t bit) { SetBit(bit, false); }
@@ -94,7 +116,7 @@ public:
   void FlipBit(size_t bit)
   {
     DebugAssert(bit < m_bitCount);
-    m_values[bit / BITS_PER_VALUE] ^= TYPE(1 << (bit % BITS_PER_VALUE));
+    m_values[bit / BITS_PER_VALUE] ^= TYPE(TYPE(1) << (bit % BITS_PER_VALUE));
   }
 
   bool TestSetMask(const BitSet& mask) const
@@ -123,18 +145,12 @@ public:
     if (test.m_valueCount != m_valueCount)
       return false;
 
-    for (size_t i = 0; i < m_valueCount; i++)
-    {
-      if (m_values[i] != mask.m_values[i])
-        return false;
-    }
-
-    return true;
+    return (m_valueCount == 0 || std::memcmp(m_values, test.m_values, sizeof(TYPE) * m_valueCount) == 0);
   }
 
   void Copy(const BitSet& other)
   {
-    if (m_valueCount != other.m_bitCount)
+    if (m_bitCount != other.m_bitCount)
       Resize(other.m_bitCount);
 
     DebugAssert(m_valueCount == other.m_valueCount);
@@ -149,78 +165,105 @@ public:
     ::Swap(m_values, other.m_values);
   }
 
+  // OR, growing to the size of other
   void Combine(const BitSet& other)
   {
     if (other.m_bitCount > m_bitCount)
       Resize(other.m_bitCount);
 
-    size_t loopCount = Min(m_valueCount, other.m_valueCount);
-    for (size_t i = 0; i < loopCount; i++)
-      m_values[i] |= other.m_values[i];
+    BitSetOperations::Or(m_values, other.m_values, sizeof(TYPE) * Min(m_valueCount, other.m_valueCount));
   }
 
+  // AND, bits past the end of other are cleared
   void Mask(const BitSet& other)
   {
-    if (other.m_valueCount < m_valueCount)
-    {
-      for (size_t i = 0; i < other.m_valueCount; i++)
-        m_values[i] &= other.m_values[i];
-      for (size_t i = other.m_valueCount; i < m_valueCount; i++)
-        m_valueCount[i] = 0;
-    }
-    else
-    {
-      size_t loopCount = Min(m_valueCount, other.m_valueCount);
-      for (size_t i = 0; i < loopCount; i++)
-        m_values[i] &= other.m_values[i];
-    }
+    size_t loopCount = Min(m_valueCount, other.m_valueCount);
+    BitSetOperations::And(m_values, other.m_values, sizeof(TYPE) * loopCount);
+    if (m_valueCount > loopCount)
+      Y_memzero(m_values + loopCount, sizeof(TYPE) * (m_valueCount - loopCount));
+  }
+
+  // XOR, growing to the size of other
+  void Xor(const BitSet& other)
+  {
+    if (other.m_bitCount > m_bitCount)
+      Resize(other.m_bitCount);
+
+    BitSetOperations::Xor(m_values, other.m_values, sizeof(TYPE) * Min(m_valueCount, other.m_valueCount));
+  }
+
+  // clears every bit that is set in other
+  void AndNot(const BitSet& other)
+  {
+    BitSetOperations::AndNot(m_values, other.m_values, sizeof(TYPE) * Min(m_valueCount, other.m_valueCount));
   }
 
   void Flip()
   {
     for (size_t i = 0; i < m_valueCount; i++)
+      m_values[i] = ~m_values[i];
+
+    // careful not to flip out of bit range
+    if (m_valueCount > 0)
+      m_values[m_valueCount - 1] &= GetLastValueMask();
+  }
+
+  bool FindFirstSetBit(size_t* foundIndex) const { return FindNextSetBit(0, foundIndex); }
+
+  // first set bit at or after startIndex
+  bool FindNextSetBit(size_t startIndex, size_t* foundIndex) const
+  {
+    if (startIndex >= m_bitCount)
+      return false;
+
+    // the rest of the value startIndex is in, then skip ahead to the next non-zero byte
+    size_t valueIndex = startIndex / BITS_PER_VALUE;
+    TYPE value = m_values[valueIndex] & TYPE(TYPE(~TYPE(0)) << (startIndex % BITS_PER_VALUE));
+    if (value == 0)
     {
-      // careful not to flip out of bit range
-      if ((i + 1) * BITS_PER_VALUE > m_bitCount)
-      {
-        size_t count = BITS_PER_VALUE - (((i + 1) * BITS_PER_VALUE) - m_bitCount);
-        for (size_t j = 0; j < count; j++)
-          m_values[i] ^= (1 << j);
-      }
-      else
-      {
-        m_values[i] = ~m_values[i];
-      }
+      size_t byteCount = sizeof(TYPE) * m_valueCount;
+      size_t byteIndex = BitSetOperations::FindNonZeroByte(m_values, sizeof(TYPE) * (valueIndex + 1), byteCount);
+      if (byteIndex == byteCount)
+        return false;
+
+      valueIndex = byteIndex / sizeof(TYPE);
+      value = m_values[valueIndex];
     }
+
+    TYPE index;
+    Y_bitscanforward(value, &index);
+    *foundIndex = valueIndex * BITS_PER_VALUE + (size_t)index;
+    return true;
   }
 
-  bool FindFirstSetBit(size_t* foundIndex) const
+  // calls callback(index) for every set bit in ascending order
+  template<typename CB>
+  void ForEachSetBit(CB callback) const
   {
     for (size_t i = 0; i < m_valueCount; i++)
     {
-      if (m_values[i] == 0)
-        continue;
-
-      uint32 index;
-      Y_bitscanforward(m_values[i], &index);
-      *foundIndex = i * BITS_PER_VALUE + index;
-      return true;
+      TYPE value = m_values[i];
+      while (value != 0)
+      {
+        TYPE index;
+        Y_bitscanforward(value, &index);
+        callback(i * BITS_PER_VALUE + (size_t)index);
+        value &= value - 1;
+      }
     }
-
-    return false;
   }
 
   bool FindFirstClearBit(size_t* foundIndex) const
   {
     for (size_t i = 0; i < m_valueCount; i++)
     {
-      if (m_values[i] == ~(TYPE)0)
+      if (m_values[i] == TYPE(~TYPE(0)))
         continue;
 
-      uint32 index;
-      Y_bitscanforward(static_cast<uint32>(~m_values[i]), &index);
-      *foundIndex = i * BITS_PER_VALUE + index;
-      return true;
+      TYPE index;
+      Y_bitscanforward(TYPE(~m_values[i]), &index);
+      *foundIndex = i * BITS_PER_VALUE + (size_t)index;
+      return (*foundIndex < m_bitCount);
     }
 
     return false;
@@ -230,7 +273,7 @@ public:
   {
     for (size_t i = 0; i < m_valueCount; i++)
     {
-      if (m_values[i] == ~(TYPE)0)
+      if (m_values[i] == TYPE(~TYPE(0)))
         continue;
 
       TYPE mask = TYPE(size_t(1 << Min(BITS_PER_VALUE, count)) - 1);
@@ -271,13 +314,9 @@ public:
     return false;
   }
 
-  size_t Cardinality() const
-  {
-    size_t count = 0;
-    for (size_t i = 0; i < m_valueCount; i++)
-      count += (size_t)Y_popcnt(m_values[i]);
-    return count;
-  }
+  // number of set bits
+  size_t PopCount() const { return BitSetOperations::PopCount(m_values, sizeof(TYPE) * m_valueCount); }
+  size_t Cardinality() const { return PopCount(); }
 
   // wrapper for operator[]
   class IndexAccessor
@@ -310,7 +349,7 @@ public:
     Copy(rhs);
     return *this;
   }
-  BitSet& operator=(const BitSet&& rhs)
+  BitSet& operator=(BitSet&& rhs)
   {
     Swap(rhs);
     return *this;
@@ -325,6 +364,11 @@ public:
     Mask(rhs);
     return *this;
   }
+  BitSet& operator^=(const BitSet& rhs)
+  {
+    Xor(rhs);
+    return *this;
+  }
   BitSet operator|(const BitSet& rhs) const
   {
     BitSet ret(*this);
@@ -337,6 +381,12 @@ public:
     ret.Mask(rhs);
     return ret;
   }
+  BitSet operator^(const BitSet& rhs) const
+  {
+    BitSet ret(*this);
+    ret.Xor(rhs);
+    return ret;
+  }
   BitSet operator~() const
   {
     BitSet ret(*this);
@@ -345,11 +395,21 @@ public:
   }
 
 private:
+  // bits of the last value that are inside the set
+  TYPE GetLastValueMask() const
+  {
+    size_t usedBits = m_bitCount - (m_valueCount - 1) * BITS_PER_VALUE;
+    return (usedBits == BITS_PER_VALUE) ? TYPE(~TYPE(0)) : TYPE((TYPE(1) << usedBits) - 1);
+  }
+
   TYPE* m_values;
   size_t m_valueCount;
   size_t m_bitCount;
 };
 
+template<typename TYPE>
+const size_t BitSet<TYPE>::BITS_PER_VALUE;
+
 typedef BitSet<uint8> BitSet8;
 typedef BitSet<uint32> BitSet32;
 typedef BitSet<uint64> BitSet64;
@@ -0,0 +1,54 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/NonCopyable.h"
+
+// Blocked Bloom filter over hashes, to put in front of a lookup that mostly misses so that a miss usually costs one
+// cache line instead of a walk through the table. Each hash picks one 32-byte block and sets one bit in each of its
+// eight words (a split block filter, as in Parquet), so adding and testing touch a single line and the test is one
+// SIMD compare. At the default 12 bits per key about 0.5% of hashes that were never added pass the filter.
+//
+// Hashes are remixed, so 32-bit hashes such as HashTrait's do as well as 64-bit ones. Bits can't be cleared
+// one key at a time, so rebuild the filter when keys are removed or once more than the expected count is added, see
+// CuckooFilter for a filter supporting removal. Not thread-safe for adding, any number of threads may test.
+//   BloomFilter filter;
+//   filter.Reset(names.GetSize());
+//   for (...) filter.Add(Y_HashStringCaseInsensitive(name, length));
+//   if (filter.MayContain(hash)) { ... look it up properly ... }
+class BloomFilter
+{
+public:
+  BloomFilter();
+  ~BloomFilter();
+
+  // Empties the filter and sizes it for expectedCount hashes. A filter with no room, as constructed, passes every
+  // hash, so it's safe to test before the first Reset.
+  void Reset(uint32 expectedCount, uint32 bitsPerKey = 12);
+
+  // empties the filter, keeping its size
+  void Clear();
+
+  void Add(uint64 hash);
+
+  // false if the hash was certainly never added
+  bool MayContain(uint64 hash) const;
+
+  uint32 GetAddedCount() const { return m_addedCount; }
+  uint32 GetExpectedCount() const { return m_expectedCount; }
+  size_t GetMemoryUsage() const { return m_blockCount * sizeof(Block); }
+
+  // more was added than it was sized for, so it passes more than it should and wants resetting larger
+  bool IsOverfilled() const { return (m_addedCount > m_expectedCount); }
+
+private:
+  struct Block
+  {
+    uint32 Words[8];
+  };
+
+  Block* m_pBlocks;
+  uint32 m_blockCount;
+  uint32 m_addedCount;
+  uint32 m_expectedCount;
+
+  DeclareNonCopyable(BloomFilter);
+};
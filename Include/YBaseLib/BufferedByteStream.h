@@ -0,0 +1,114 @@
+#pragma once
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/ConditionVariable.h"
+#include "YBaseLib/Mutex.h"
+
+class TaskQueue;
+
+// Wraps another stream, reading ahead and writing behind on a task queue so the caller doesn't wait on the device.
+// Reads are served from a ring of buffers that a task keeps filling with what comes next, writes are gathered in
+// the ring and handed to the task a buffer at a time. The wrapped stream is only ever used by one thread at a time,
+// but it belongs to the wrapper until the wrapper is released, nothing else may use it in the meantime.
+// Seeking within the buffer being read is free, other seeks wait for the task to stop. Flush and Commit write out
+// everything gathered so far and then flush or commit the wrapped stream. The task queue needs worker threads, with
+// no task queue the buffers are filled and written on the calling thread.
+//   BufferedByteStream* pStream = new BufferedByteStream(pFileStream, pTaskQueue);
+//   pFileStream->Release();
+class BufferedByteStream : public ByteStream
+{
+public:
+  static const uint32 DefaultBufferSize = 65536;
+  static const uint32 DefaultBufferCount = 3;
+
+  BufferedByteStream(ByteStream* pStream, TaskQueue* pTaskQueue, uint32 bufferSize = DefaultBufferSize,
+                     uint32 bufferCount = DefaultBufferCount);
+
+  // writes out anything gathered and releases the wrapped stream
+  ~BufferedByteStream();
+
+  ByteStream* GetInnerStream() const { return m_pStream; }
+
+  virtual bool ReadByte(byte* pDestByte) override final;
+  virtual uint32 Read(void* pDestination, uint32 ByteCount) override final;
+  virtual bool Read2(void* pDestination, uint32 ByteCount, uint32* pNumberOfBytesRead = nullptr) override final;
+  virtual bool WriteByte(byte SourceByte) override final;
+  virtual uint32 Write(const void* pSource, uint32 ByteCount) override final;
+  virtual bool Write2(const void* pSource, uint32 ByteCount, uint32* pNumberOfBytesWritten = nullptr) override final;
+  virtual bool SeekAbsolute(uint64 Offset) override final;
+  virtual bool SeekRelative(int64 Offset) override final;
+  virtual bool SeekToEnd() override final;
+  virtual uint64 GetPosition() const override final { return m_position; }
+  virtual uint64 GetSize() const override final { return m_size; }
+  virtual bool Flush() override final;
+  virtual bool Discard() override final;
+  virtual bool Commit() override final;
+
+private:
+  enum MODE
+  {
+    MODE_NONE,
+    MODE_READ,
+    MODE_WRITE,
+  };
+
+  struct Buffer
+  {
+    byte* pData;
+    uint64 Offset;
+    uint32 Size;
+  };
+
+  // fills buffers ahead of the reader or writes out full ones, runs as a task
+  void Pump();
+
+  // queues the pump task if it isn't running and there's work for it, with the lock held
+  bool NeedsPump() const;
+  void StartPump();
+
+  // waits for the pump task to finish what it's doing, with the lock held. the buffers are kept.
+  void StopPumpLocked();
+
+  // moves the reader on to the next filled buffer, returns false at the end of the stream
+  bool NextReadBuffer();
+
+  // hands the buffer being written to the pump, waiting for a free one if they're all in use
+  bool SubmitWriteBuffer();
+
+  // writes out everything gathered so far, leaving the wrapped stream at m_position
+  bool DrainWrites();
+
+  // throws away buffers read ahead, leaving the wrapped stream at m_position
+  bool DropReadAhead();
+
+  // switches between reading and writing
+  bool EnterMode(MODE mode);
+
+  ByteStream* m_pStream;
+  TaskQueue* m_pTaskQueue;
+  Buffer* m_pBuffers;
+  uint32 m_bufferSize;
+  uint32 m_bufferCount;
+  MODE m_mode;
+  uint64 m_position;
+  uint64 m_size;
+
+  // the buffer the caller is reading from or writing to, only used by the calling thread
+  byte* m_pCurrentData;
+  uint64 m_currentOffset;
+  uint32 m_currentPosition;
+  uint32 m_currentSize;
+  bool m_holdingBuffer;
+
+  // the ring, protected by m_lock. buffers from m_head on are filled and waiting to be read, or full and waiting to be
+  // written, m_queuedCount of them. the pump works on the next one along when reading, and m_head when writing.
+  Mutex m_lock;
+  ConditionVariable m_conditionVariable;
+  uint32 m_head;
+  uint32 m_queuedCount;
+  uint64 m_pumpOffset;
+  bool m_pumpActive;
+  bool m_pumpStopping;
+  bool m_endOfStream;
+  bool m_pumpError;
+};
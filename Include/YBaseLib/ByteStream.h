@@ -1,5 +1,6 @@
 #pragma once
 #include "YBaseLib/Common.h"
+#include "YBaseLib/PODArray.h"
 #include "YBaseLib/ReferenceCounted.h"
 #include "YBaseLib/String.h"
 
@@ -15,6 +16,15 @@ enum BYTESTREAM_OPEN_MODE
   BYTESTREAM_OPEN_ATOMIC_UPDATE = 64, //
   BYTESTREAM_OPEN_SEEKABLE = 128,
   BYTESTREAM_OPEN_STREAMED = 256,
+  BYTESTREAM_OPEN_MAPPED = 512,       // read-only, maps the whole file into memory when it can
+  BYTESTREAM_OPEN_DIRECT = 1024,      // bypasses the page cache, read-only or write-only with truncate
+};
+
+// which views a stream supports, see ByteStream::AcquireReadView
+enum BYTESTREAM_VIEW_FLAGS
+{
+  BYTESTREAM_VIEW_READ = 1,
+  BYTESTREAM_VIEW_WRITE = 2,
 };
 
 // interface class used by readers, writers, etc.
@@ -41,6 +51,11 @@ public:
   // write bytes to this stream, optionally returning the number of bytes written.
   virtual bool Write2(const void* pSource, uint32 ByteCount, uint32* pNumberOfBytesWritten = nullptr) = 0;
 
+  // Reads or writes any number of bytes in one call, returning the number transferred as Read and Write do. By
+  // default these loop over Read and Write, streams that can move everything at once override them.
+  virtual uint64 Read64(void* pDestination, uint64 ByteCount);
+  virtual uint64 Write64(const void* pSource, uint64 ByteCount);
+
   // seeks to the specified position in the stream
   // if seek failed, returns false.
   virtual bool SeekAbsolute(uint64 Offset) = 0;
@@ -53,6 +68,30 @@ public:
   // gets the size of the stream
   virtual uint64 GetSize() const = 0;
 
+  // Returns the data of the whole stream if it is all in memory, for memory streams and mapped files, so readers can
+  // use it in place rather than copying it out with Read. Offsets match GetPosition. Returns null for streams that
+  // aren't in memory. The pointer stays valid until the stream is written to or released.
+  virtual const byte* GetBasePointer() const { return nullptr; }
+
+  // Streams over a regular file return its descriptor, after writing out anything they hold in user space so the file
+  // matches the stream up to GetPosition. Lets copies between files be done by the operating system, the stream must
+  // be repositioned with SeekAbsolute after using the descriptor directly. Returns false for other streams.
+  virtual bool GetFileDescriptor(int* pFileDescriptor) { return false; }
+
+  // Views give direct access to the stream's memory at the current position, so data can be used or produced in
+  // place instead of being copied through a buffer with Read or Write. GetViewFlags says which kinds the stream
+  // supports, by default read views are available whenever GetBasePointer is.
+  // AcquireReadView returns up to maxSize contiguous bytes, fewer at the end of the stream, zero if there are none
+  // or views aren't supported. ReleaseReadView moves the position past the bytes that were used.
+  // AcquireWriteView returns up to size writable bytes, growable streams make room for all of them. Releasing it
+  // moves the position past the bytes that were filled in, extending the stream if needed.
+  // A view is only valid until the next call on the stream.
+  virtual uint32 GetViewFlags() const;
+  virtual uint32 AcquireReadView(uint32 maxSize, const void** ppData);
+  virtual void ReleaseReadView(uint32 bytesConsumed);
+  virtual uint32 AcquireWriteView(uint32 size, void** ppData);
+  virtual void ReleaseWriteView(uint32 bytesWritten);
+
   // flush any changes to the stream to disk
   virtual bool Flush() = 0;
 
@@ -105,11 +144,11 @@ public:
 class MemoryByteStream : public ByteStream
 {
 public:
-  MemoryByteStream(void* pMemory, uint32 MemSize);
+  MemoryByteStream(void* pMemory, size_t MemSize);
   virtual ~MemoryByteStream();
 
   byte* GetMemoryPointer() const { return m_pMemory; }
-  uint32 GetMemorySize() const { return m_iSize; }
+  size_t GetMemorySize() const { return m_iSize; }
 
   virtual bool ReadByte(byte* pDestByte) override;
   virtual uint32 Read(void* pDestination, uint32 ByteCount) override;
@@ -117,29 +156,38 @@ public:
   virtual bool WriteByte(byte SourceByte) override;
   virtual uint32 Write(const void* pSource, uint32 ByteCount) override;
   virtual bool Write2(const void* pSource, uint32 ByteCount, uint32* pNumberOfBytesWritten /* = nullptr */) override;
+  virtual uint64 Read64(void* pDestination, uint64 ByteCount) override;
+  virtual uint64 Write64(const void* pSource, uint64 ByteCount) override;
   virtual bool SeekAbsolute(uint64 Offset) override;
   virtual bool SeekRelative(int64 Offset) override;
   virtual bool SeekToEnd() override;
   virtual uint64 GetSize() const override;
   virtual uint64 GetPosition() const override;
+  virtual const byte* GetBasePointer() const override { return m_pMemory; }
+  virtual uint32 GetViewFlags() const override { return BYTESTREAM_VIEW_READ | BYTESTREAM_VIEW_WRITE; }
+  virtual uint32 AcquireWriteView(uint32 size, void** ppData) override;
+  virtual void ReleaseWriteView(uint32 bytesWritten) override;
   virtual bool Flush() override;
   virtual bool Commit() override;
   virtual bool Discard() override;
 
 private:
   byte* m_pMemory;
-  uint32 m_iPosition;
-  uint32 m_iSize;
+  size_t m_iPosition;
+  size_t m_iSize;
 };
 
 class ReadOnlyMemoryByteStream : public ByteStream
 {
 public:
-  ReadOnlyMemoryByteStream(const void* pMemory, uint32 MemSize);
+  ReadOnlyMemoryByteStream(const void* pMemory, size_t MemSize);
   virtual ~ReadOnlyMemoryByteStream();
 
   const byte* GetMemoryPointer() const { return m_pMemory; }
-  uint32 GetMemorySize() const { return m_iSize; }
+  size_t GetMemorySize() const { return m_iSize; }
+
+  // points the stream at other memory, from its start with no error, so one stream reads a run of buffers
+  void SetMemory(const void* pMemory, size_t MemSize);
 
   virtual bool ReadByte(byte* pDestByte) override;
   virtual uint32 Read(void* pDestination, uint32 ByteCount) override;
@@ -147,29 +195,32 @@ public:
   virtual bool WriteByte(byte SourceByte) override;
   virtual uint32 Write(const void* pSource, uint32 ByteCount) override;
   virtual bool Write2(const void* pSource, uint32 ByteCount, uint32* pNumberOfBytesWritten /* = nullptr */) override;
+  virtual uint64 Read64(void* pDestination, uint64 ByteCount) override;
+  virtual uint64 Write64(const void* pSource, uint64 ByteCount) override;
   virtual bool SeekAbsolute(uint64 Offset) override;
   virtual bool SeekRelative(int64 Offset) override;
   virtual bool SeekToEnd() override;
   virtual uint64 GetSize() const override;
   virtual uint64 GetPosition() const override;
+  virtual const byte* GetBasePointer() const override { return m_pMemory; }
   virtual bool Flush() override;
   virtual bool Commit() override;
   virtual bool Discard() override;
 
 private:
   const byte* m_pMemory;
-  uint32 m_iPosition;
-  uint32 m_iSize;
+  size_t m_iPosition;
+  size_t m_iSize;
 };
 
 class GrowableMemoryByteStream : public ByteStream
 {
 public:
-  GrowableMemoryByteStream(void* pInitialMem, uint32 InitialMemSize);
+  GrowableMemoryByteStream(void* pInitialMem, size_t InitialMemSize);
   virtual ~GrowableMemoryByteStream();
 
   byte* GetMemoryPointer() const { return m_pMemory; }
-  uint32 GetMemorySize() const { return m_iSize; }
+  size_t GetMemorySize() const { return m_iSize; }
 
   virtual bool ReadByte(byte* pDestByte) override;
   virtual uint32 Read(void* pDestination, uint32 ByteCount) override;
@@ -177,23 +228,114 @@ public:
   virtual bool WriteByte(byte SourceByte) override;
   virtual uint32 Write(const void* pSource, uint32 ByteCount) override;
   virtual bool Write2(const void* pSource, uint32 ByteCount, uint32* pNumberOfBytesWritten /* = nullptr */) override;
+  virtual uint64 Read64(void* pDestination, uint64 ByteCount) override;
+  virtual uint64 Write64(const void* pSource, uint64 ByteCount) override;
   virtual bool SeekAbsolute(uint64 Offset) override;
   virtual bool SeekRelative(int64 Offset) override;
   virtual bool SeekToEnd() override;
   virtual uint64 GetSize() const override;
   virtual uint64 GetPosition() const override;
+  virtual const byte* GetBasePointer() const override { return m_pMemory; }
+  virtual uint32 GetViewFlags() const override { return BYTESTREAM_VIEW_READ | BYTESTREAM_VIEW_WRITE; }
+  virtual uint32 AcquireWriteView(uint32 size, void** ppData) override;
+  virtual void ReleaseWriteView(uint32 bytesWritten) override;
   virtual bool Flush() override;
   virtual bool Commit() override;
   virtual bool Discard() override;
 
 private:
-  void Grow(uint32 MinimumGrowth);
+  void Grow(size_t MinimumGrowth);
 
   byte* m_pPrivateMemory;
   byte* m_pMemory;
-  uint32 m_iPosition;
-  uint32 m_iSize;
-  uint32 m_iMemorySize;
+  size_t m_iPosition;
+  size_t m_iSize;
+  size_t m_iMemorySize;
+};
+
+// A growable memory stream kept in fixed size segments rather than one block, so growing never copies what has
+// already been written and large streams never need twice their size while they grow. Reads, writes and seeks work
+// anywhere in the stream. The data isn't contiguous, so there are no views or base pointer, instead the segments can
+// be handed to a socket's WriteVector or written to a file with writev.
+class SegmentedMemoryByteStream : public ByteStream
+{
+public:
+  static const uint32 DefaultSegmentSize = 65536;
+
+  // segmentSize must be a power of two
+  SegmentedMemoryByteStream(uint32 segmentSize = DefaultSegmentSize);
+  virtual ~SegmentedMemoryByteStream();
+
+  uint32 GetSegmentSize() const { return m_segmentSize; }
+
+  // number of segments holding data, the last one is partly filled
+  uint32 GetSegmentCount() const { return (uint32)((m_iSize + m_segmentSize - 1) >> m_segmentShift); }
+
+  virtual bool ReadByte(byte* pDestByte) override;
+  virtual uint32 Read(void* pDestination, uint32 ByteCount) override;
+  virtual bool Read2(void* pDestination, uint32 ByteCount, uint32* pNumberOfBytesRead /* = nullptr */) override;
+  virtual bool WriteByte(byte SourceByte) override;
+  virtual uint32 Write(const void* pSource, uint32 ByteCount) override;
+  virtual bool Write2(const void* pSource, uint32 ByteCount, uint32* pNumberOfBytesWritten /* = nullptr */) override;
+  virtual uint64 Read64(void* pDestination, uint64 ByteCount) override;
+  virtual uint64 Write64(const void* pSource, uint64 ByteCount) override;
+  virtual bool SeekAbsolute(uint64 Offset) override;
+  virtual bool SeekRelative(int64 Offset) override;
+  virtual bool SeekToEnd() override;
+  virtual uint64 GetSize() const override;
+  virtual uint64 GetPosition() const override;
+  virtual bool Flush() override;
+  virtual bool Commit() override;
+  virtual bool Discard() override;
+
+  // empties the stream, the segments are kept and filled again
+  void Clear();
+
+  // fills in the data and length of up to maxBuffers segments, starting at segment firstSegment, in the form
+  // WriteVector takes. returns the number of segments filled in, zero past the end.
+  uint32 GetBuffers(uint32 firstSegment, const void** ppBuffers, size_t* pBufferLengths, uint32 maxBuffers) const;
+
+  // writes the whole stream to another at its current position, with writev when it is a file. returns false if the
+  // stream fails.
+  bool WriteToStream(ByteStream* pStream) const;
+
+  // sends the whole stream with as few WriteVector calls as possible, for StreamSocket and BufferedStreamSocket.
+  // returns the number of bytes the socket took, which is less than the size if it stopped taking data.
+  template<typename SocketType>
+  uint64 WriteVector(SocketType* pSocket) const
+  {
+    static const uint32 BatchSize = 64;
+    const void* pBuffers[BatchSize];
+    size_t bufferLengths[BatchSize];
+    uint64 bytesWritten = 0;
+    uint32 segmentIndex = 0;
+    uint32 count;
+    while ((count = GetBuffers(segmentIndex, pBuffers, bufferLengths, BatchSize)) > 0)
+    {
+      size_t batchLength = 0;
+      for (uint32 i = 0; i < count; i++)
+        batchLength += bufferLengths[i];
+
+      size_t sent = pSocket->WriteVector(pBuffers, bufferLengths, count);
+      bytesWritten += sent;
+      if (sent != batchLength)
+        break;
+
+      segmentIndex += count;
+    }
+
+    return bytesWritten;
+  }
+
+private:
+  // allocates segments up to and including the one holding offset
+  void EnsureSegments(size_t offset);
+
+  PODArray<byte*> m_segments;
+  uint32 m_segmentSize;
+  uint32 m_segmentShift;
+  size_t m_iPosition;
+  size_t m_iSize;
 };
 
 // base byte stream creation functions
@@ -202,16 +344,20 @@ bool ByteStream_OpenFileStream(const char* FileName, uint32 OpenMode, ByteStream
 
 // memory byte stream, caller is responsible for management, therefore it can be located on either the stack or on the
 // heap.
-MemoryByteStream* ByteStream_CreateMemoryStream(void* pMemory, uint32 Size);
+MemoryByteStream* ByteStream_CreateMemoryStream(void* pMemory, size_t Size);
 
 // a growable memory byte stream will automatically allocate its own memory if the provided memory is overflowed.
 // a "pure heap" buffer, i.e. a buffer completely managed by this implementation, can be created by supplying a NULL
 // pointer and initialSize of zero.
-GrowableMemoryByteStream* ByteStream_CreateGrowableMemoryStream(void* pInitialMemory, uint32 InitialSize);
+GrowableMemoryByteStream* ByteStream_CreateGrowableMemoryStream(void* pInitialMemory, size_t InitialSize);
 GrowableMemoryByteStream* ByteStream_CreateGrowableMemoryStream();
 
+// a growable memory stream in segments of segmentSize bytes, a power of two
+SegmentedMemoryByteStream* ByteStream_CreateSegmentedMemoryStream(
+  uint32 segmentSize = SegmentedMemoryByteStream::DefaultSegmentSize);
+
 // readable memory stream
-ReadOnlyMemoryByteStream* ByteStream_CreateReadOnlyMemoryStream(const void* pMemory, uint32 Size);
+ReadOnlyMemoryByteStream* ByteStream_CreateReadOnlyMemoryStream(const void* pMemory, size_t Size);
 
 // null memory stream
 NullByteStream* ByteStream_CreateNullStream();
@@ -225,3 +371,4 @@ bool ByteStream_AppendStream(ByteStream* pSourceStream, ByteStream* pDestination
 
 // copies a number of bytes from one to another
 uint32 ByteStream_CopyBytes(ByteStream* pSourceStream, uint32 byteCount, ByteStream* pDestinationStream);
+uint64 ByteStream_CopyBytes64(ByteStream* pSourceStream, uint64 byteCount, ByteStream* pDestinationStream);
@@ -1,15 +1,19 @@
 #pragma once
+#include "YBaseLib/Allocator.h"
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/CString.h"
 #include "YBaseLib/Common.h"
 #include "YBaseLib/HashTrait.h"
 #include "YBaseLib/Memory.h"
+#include "YBaseLib/StringView.h"
 #include <new>
+#include <utility>
 
-template<typename ValueType>
-class CIStringHashTable
+template<typename ValueType, class AllocatorType = HeapAllocator>
+class CIStringHashTable : private AllocatorType
 {
 public:
+  // the key is stored in the same allocation, after the member
   struct Member
   {
     char* Key;
@@ -19,6 +23,9 @@ public:
 
     Member* PrevMember;
     Member* NextMember;
+
+    // next member in the same bucket
+    Member* NextInBucket;
   };
 
   class Iterator;
@@ -154,45 +161,36 @@ public:
     Member* m_pCurrentMember;
   };
 
-  static HashType GetStringHash(const char* Str, uint32 Length)
-  {
-    // http://en.wikipedia.org/wiki/Jenkins_hash_function
-    uint32 hash = 0;
-    uint32 i = 0;
-    for (; i < Length; i++)
-    {
-      hash += Y_tolower(Str[i]);
-      hash += (hash << 10);
-      hash ^= (hash >> 6);
-    }
+  // the hash is kept with each member, so lookups only fold the key they are given
+  static HashType GetStringHash(const char* Str, uint32 Length) { return Y_HashStringCaseInsensitive(Str, Length); }
 
-    hash += (hash << 3);
-    hash ^= (hash >> 11);
-    hash += (hash << 15);
-    return (HashType)hash;
+  // nBuckets is rounded up to a power of two, the table grows past it automatically
+  CIStringHashTable(uint32 nBuckets = 16, const AllocatorType& allocator = AllocatorType()) : AllocatorType(allocator)
+  {
+    m_pFirstMember = m_pLastMember = NULL;
+    m_nMembers = 0;
+    m_maxLoadFactor = 1.0f;
+    InitBuckets(RoundUpBucketCount(nBuckets));
   }
 
-  CIStringHashTable(uint32 nBuckets = 4, uint32 uBucketSize = 16)
+  explicit CIStringHashTable(const AllocatorType& allocator) : AllocatorType(allocator)
   {
-    m_pBuckets = NULL;
-    m_nBuckets = 0;
     m_pFirstMember = m_pLastMember = NULL;
     m_nMembers = 0;
-    InitBuckets(nBuckets, uBucketSize);
+    m_maxLoadFactor = 1.0f;
+    InitBuckets(16);
   }
 
-  CIStringHashTable(const CIStringHashTable& Copy)
+  CIStringHashTable(const CIStringHashTable& Copy) : AllocatorType(Copy.GetAllocator())
   {
-    // init to same bucket size/count as copy
-    m_pBuckets = NULL;
-    m_nBuckets = 0;
+    // init to same bucket count as copy
     m_pFirstMember = m_pLastMember = NULL;
     m_nMembers = 0;
-    InitBuckets(Copy.m_nBuckets, Copy.m_uBucketSize);
+    m_maxLoadFactor = Copy.m_maxLoadFactor;
+    InitBuckets(Copy.m_nBuckets);
 
     // insert all its members
-    Member* member = Copy.m_pFirstMember;
-    while (member != NULL)
+    for (Member* member = Copy.m_pFirstMember; member != NULL; member = member->NextMember)
       Insert(member->Key, member->Value);
   }
 
@@ -202,9 +200,38 @@ public:
     FreeMembers();
   }
 
+  // allocator the members and buckets come from, copies of the table share a copy of it
+  const AllocatorType& GetAllocator() const { return *this; }
+  AllocatorType& GetAllocator() { return *this; }
+
   uint32 GetMemberCount() const { return m_nMembers; }
 
-  Member* Insert(const char* Key, const ValueType& Value)
+  // number of buckets members are currently being added to
+  uint32 GetBucketCount() const { return m_nBuckets; }
+
+  // average members per bucket before the table grows, defaults to 1
+  float GetMaxLoadFactor() const { return m_maxLoadFactor; }
+  void SetMaxLoadFactor(float maxLoadFactor)
+  {
+    DebugAssert(maxLoadFactor > 0.0f);
+    m_maxLoadFactor = maxLoadFactor;
+  }
+
+  // grows the table so count members fit without going over the load factor. this rehashes immediately.
+  void Reserve(uint32 count)
+  {
+    uint32 nBuckets = GetBucketCountForMembers(count, m_maxLoadFactor);
+    if (nBuckets <= m_nBuckets)
+      return;
+
+    if (m_pOldBuckets != NULL)
+      MigrateBuckets(m_nOldBuckets);
+
+    BeginRehash(nBuckets);
+    MigrateBuckets(m_nOldBuckets);
+  }
+
+  Member* Insert(const StringView& Key, const ValueType& Value)
   {
     bool IsNew;
     Member* pMember = _Insert(Key, Value, &IsNew);
@@ -212,7 +239,7 @@ public:
     return pMember;
   }
 
-  Member* Set(const char* Key, const ValueType& Value, bool* IsNew)
+  Member* Set(const StringView& Key, const ValueType& Value, bool* IsNew)
   {
     bool IsNew_;
     Member* pMember = _Insert(Key, Value, &IsNew_);
@@ -228,21 +255,26 @@ public:
     return pMember;
   }
 
-  Member* Find(const char* Key)
+  // keys are views, so tokens cut out of a larger buffer can be looked up without copying or measuring them
+  Member* Find(const StringView& Key)
   {
-    uint32 KeyLength = Y_strlen(Key);
-    HashType Hash = GetStringHash(Key, KeyLength);
-    return m_pBuckets[Hash % m_nBuckets].Find(Key, KeyLength, Hash);
+    HashType Hash = GetStringHash(Key.GetData(), Key.GetLength());
+    return FindInBucket(*GetBucket(Hash), Key.GetData(), Key.GetLength(), Hash);
   }
 
-  const Member* Find(const char* Key) const
+  const Member* Find(const StringView& Key) const
   {
-    uint32 KeyLength = Y_strlen(Key);
-    HashType Hash = GetStringHash(Key, KeyLength);
-    return (const Member*)const_cast<Bucket&>(m_pBuckets[Hash % m_nBuckets]).Find(Key, KeyLength, Hash);
+    HashType Hash = GetStringHash(Key.GetData(), Key.GetLength());
+    return FindInBucket(*GetBucket(Hash), Key.GetData(), Key.GetLength(), Hash);
+  }
+
+  // with the hash from GetStringHash, for callers that needed it first, e.g. to test a BloomFilter
+  const Member* Find(const StringView& Key, HashType Hash) const
+  {
+    return FindInBucket(*GetBucket(Hash), Key.GetData(), Key.GetLength(), Hash);
   }
 
-  bool Remove(const char* Key)
+  bool Remove(const StringView& Key)
   {
     Member* pMember = Find(Key);
     if (pMember != NULL)
@@ -260,10 +292,14 @@ public:
   {
     DebugAssert(pMember != NULL);
 
-    // determine bucket member is associated with
-    Bucket* bucket = &m_pBuckets[pMember->Hash % m_nBuckets];
-    bool r = bucket->Remove(pMember);
-    AssertMsg(r, "HashTable corrupted.");
+    // unlink from the bucket member is associated with
+    Member** ppLink = GetBucket(pMember->Hash);
+    while (*ppLink != pMember)
+    {
+      AssertMsg(*ppLink != NULL, "HashTable corrupted.");
+      ppLink = &(*ppLink)->NextInBucket;
+    }
+    *ppLink = pMember->NextInBucket;
 
     if (pMember->PrevMember != NULL)
       pMember->PrevMember->NextMember = pMember->NextMember;
@@ -277,25 +313,77 @@ public:
     // free the member itself
     FreeMember(pMember);
     m_nMembers--;
+
+    // keep any rehash moving
+    if (m_pOldBuckets != NULL)
+      MigrateBuckets(MigrateBucketsPerOperation);
   }
 
   void Clear()
   {
-    Member* pNext = m_pFirstMember;
-    while (pNext != NULL)
+    FreeMembers();
+
+    // any rehash in progress is finished, the old buckets can only hold removed members
+    FreeBucketArray(m_pOldBuckets, m_nOldBuckets);
+    m_pOldBuckets = NULL;
+    m_nOldBuckets = 0;
+    m_migrateIndex = 0;
+    Y_memzero(m_pBuckets, sizeof(Member*) * m_nBuckets);
+  }
+
+  // reallocates the buckets and every member, in iteration order, from a new copy of the allocator, which then
+  // replaces the current one. with a PoolAllocator this packs the members next to each other and releases the
+  // old slabs. invalidates iterators and member pointers, values are moved to their new members.
+  void Compact()
+  {
+    if (m_pOldBuckets != NULL)
+      MigrateBuckets(m_nOldBuckets);
+
+    AllocatorType compactAllocator(GetAllocator());
+    Member** ppNewBuckets = (Member**)compactAllocator.Allocate(sizeof(Member*) * m_nBuckets, alignof(Member*));
+    Assert(ppNewBuckets != NULL);
+    Y_memzero(ppNewBuckets, sizeof(Member*) * m_nBuckets);
+
+    Member* pPrevious = NULL;
+    Member* pMember = m_pFirstMember;
+    while (pMember != NULL)
     {
-      Member* pCur = pNext;
-      pNext = pCur->NextMember;
-      Remove(pCur);
+      Member* pNewMember = AllocateMember(compactAllocator, pMember->Key, pMember->KeyLength);
+      new (&pNewMember->Value) ValueType(std::move(pMember->Value));
+      pNewMember->Hash = pMember->Hash;
+
+      Member** ppBucket = &ppNewBuckets[GetBucketIndex(pMember->Hash, m_nBuckets)];
+      pNewMember->NextInBucket = *ppBucket;
+      *ppBucket = pNewMember;
+
+      pNewMember->PrevMember = pPrevious;
+      pNewMember->NextMember = NULL;
+      if (pPrevious != NULL)
+        pPrevious->NextMember = pNewMember;
+      else
+        m_pFirstMember = pNewMember;
+
+      Member* pNextMember = pMember->NextMember;
+      FreeMember(pMember);
+      pPrevious = pNewMember;
+      pMember = pNextMember;
     }
+
+    m_pLastMember = pPrevious;
+    FreeBucketArray(m_pBuckets, m_nBuckets);
+    m_pBuckets = ppNewBuckets;
+    GetAllocator() = std::move(compactAllocator);
   }
 
   // operators
   CIStringHashTable& operator=(const CIStringHashTable& Assign)
   {
-    FreeMembers();
-    FreeBuckets();
-    InitBuckets(Assign.m_nBuckets, Assign.m_uBucketSize);
+    if (&Assign == this)
+      return *this;
+
+    Clear();
+    m_maxLoadFactor = Assign.m_maxLoadFactor;
+    Reserve(Assign.m_nMembers);
 
     for (Member* member = Assign.m_pFirstMember; member != NULL; member = member->NextMember)
       Insert(member->Key, member->Value);
@@ -321,123 +409,151 @@ private:
   bool operator!=(const CIStringHashTable& Comp);
 
 private:
-  // TODO improve allocation, allocate buckets + bucket members in one shot
-  class Bucket
+  // Buckets are singly linked chains through Member::NextInBucket, the bucket count is always a power of two.
+  // Once the load factor is exceeded a bucket array twice the size is allocated, and the old buckets are moved
+  // across a few at a time on each insert or remove, so no single call pays for rehashing the whole table.
+  // Old buckets below m_migrateIndex are empty, a member lives in the old bucket for its hash if that hasn't been
+  // moved yet, otherwise in the new one.
+  static const uint32 MigrateBucketsPerOperation = 4;
+
+  static uint32 RoundUpBucketCount(uint32 nBuckets)
   {
-  public:
-    void Init(uint32 uBucketSize)
-    {
-      // calloc automatically nulls
-      m_pMembers = (Member**)calloc(uBucketSize, sizeof(Member*));
-      m_uBucketSize = uBucketSize;
-    }
+    uint32 roundedBuckets = 1;
+    while (roundedBuckets < nBuckets)
+      roundedBuckets *= 2;
+    return roundedBuckets;
+  }
 
-    void Free() { free(m_pMembers); }
+  static uint32 GetBucketCountForMembers(uint32 nMembers, float maxLoadFactor)
+  {
+    uint32 nBuckets = 1;
+    while ((float)nBuckets * maxLoadFactor < (float)nMembers)
+      nBuckets *= 2;
+    return nBuckets;
+  }
 
-    bool Insert(Member* pMember)
-    {
-      // try for best position
-      uint32 hpos = pMember->Hash % m_uBucketSize;
-      uint32 pos = hpos;
-      if (m_pMembers[pos] != NULL)
-      {
-        // search for another position
-        for (;;)
-        {
-          pos = (pos + 1) % m_uBucketSize;
-          if (pos == hpos)
-          {
-            // looped around
-            return false;
-          }
-
-          if (m_pMembers[pos] == NULL)
-            break;
-        }
-      }
+  // legacy and custom traits are often the identity or aligned pointers, so mix the bits before masking
+  static uint32 GetBucketIndex(HashType Hash, uint32 nBuckets)
+  {
+    uint32 mixed = Hash;
+    mixed ^= mixed >> 16;
+    mixed *= 0x85EBCA6B;
+    mixed ^= mixed >> 13;
+    return mixed & (nBuckets - 1);
+  }
 
-      // set in list
-      m_pMembers[pos] = pMember;
-      return true;
-    }
+  void InitBuckets(uint32 nBuckets)
+  {
+    DebugAssert(nBuckets > 0 && (nBuckets & (nBuckets - 1)) == 0);
+
+    m_pBuckets = AllocateBucketArray(nBuckets);
+    m_nBuckets = nBuckets;
+    m_pOldBuckets = NULL;
+    m_nOldBuckets = 0;
+    m_migrateIndex = 0;
+  }
+
+  Member** AllocateBucketArray(uint32 nBuckets)
+  {
+    Member** ppBuckets = (Member**)GetAllocator().Allocate(sizeof(Member*) * nBuckets, alignof(Member*));
+    Assert(ppBuckets != NULL);
+    Y_memzero(ppBuckets, sizeof(Member*) * nBuckets);
+    return ppBuckets;
+  }
+
+  void FreeBucketArray(Member** ppBuckets, uint32 nBuckets)
+  {
+    if (ppBuckets != NULL)
+      GetAllocator().Free(ppBuckets, sizeof(Member*) * nBuckets, alignof(Member*));
+  }
+
+  void FreeBuckets()
+  {
+    FreeBucketArray(m_pBuckets, m_nBuckets);
+    FreeBucketArray(m_pOldBuckets, m_nOldBuckets);
+    m_pBuckets = NULL;
+    m_pOldBuckets = NULL;
+    m_nBuckets = 0;
+    m_nOldBuckets = 0;
+    m_migrateIndex = 0;
+  }
 
-    Member* Find(const char* Key, uint32 KeyLength, HashType Hash)
+  // head of the chain a member with this hash is in, or should be added to
+  Member** GetBucket(HashType Hash) const
+  {
+    if (m_pOldBuckets != NULL)
     {
-      // try best position
-      uint32 hpos = Hash % m_uBucketSize;
-      uint32 pos = hpos;
-      Member* member = m_pMembers[pos];
-      if (member != NULL && member->Hash == Hash && KeyLength == member->KeyLength && Y_stricmp(Key, member->Key) == 0)
-        return member;
-
-      for (;;)
-      {
-        pos = (pos + 1) % m_uBucketSize;
-        if (pos == hpos)
-        {
-          // looped around
-          return NULL;
-        }
-
-        member = m_pMembers[pos];
-        if (member != NULL && member->Hash == Hash && Y_stricmp(Key, member->Key) == 0)
-          return m_pMembers[pos];
-      }
+      uint32 oldIndex = GetBucketIndex(Hash, m_nOldBuckets);
+      if (oldIndex >= m_migrateIndex)
+        return &m_pOldBuckets[oldIndex];
     }
 
-    bool Remove(Member* pMember)
-    {
-      // try best position
-      uint32 pos = pMember->Hash % m_uBucketSize;
-      if (m_pMembers[pos] == pMember)
-      {
-        m_pMembers[pos] = NULL;
-        return true;
-      }
+    return &m_pBuckets[GetBucketIndex(Hash, m_nBuckets)];
+  }
 
-      for (;;)
-      {
-        pos = (pos + 1) % m_uBucketSize;
-        if (pos == m_uBucketSize)
-          return false;
-
-        if (m_pMembers[pos] == pMember)
-        {
-          m_pMembers[pos] = NULL;
-          return true;
-        }
-      }
+  Member* FindInBucket(Member* pMember, const char* Key, uint32 KeyLength, HashType Hash) const
+  {
+    for (; pMember != NULL; pMember = pMember->NextInBucket)
+    {
+      if (pMember->Hash == Hash && KeyLength == pMember->KeyLength &&
+          Y_stricmp(Key, KeyLength, pMember->Key, KeyLength) == 0)
+        return pMember;
     }
 
-  public:
-    Member** m_pMembers;
-    uint32 m_uBucketSize;
-  };
+    return NULL;
+  }
 
-  void InitBuckets(uint32 nBuckets, uint32 uBucketSize)
+  void BeginRehash(uint32 newBuckets)
   {
-    DebugAssert(nBuckets > 0);
-    DebugAssert(uBucketSize > 0);
-
-    m_pBuckets = (Bucket*)malloc(sizeof(Bucket) * nBuckets);
-    m_nBuckets = nBuckets;
-    m_uBucketSize = uBucketSize;
-    for (uint32 i = 0; i < nBuckets; i++)
-      m_pBuckets[i].Init(uBucketSize);
+    DebugAssert(m_pOldBuckets == NULL);
+    m_pOldBuckets = m_pBuckets;
+    m_nOldBuckets = m_nBuckets;
+    m_migrateIndex = 0;
+    m_pBuckets = AllocateBucketArray(newBuckets);
+    m_nBuckets = newBuckets;
   }
 
-  void FreeBuckets()
+  // moves up to count old buckets into the new array, freeing it once they have all moved
+  void MigrateBuckets(uint32 count)
   {
-    if (m_pBuckets != NULL)
+    DebugAssert(m_pOldBuckets != NULL);
+    for (; count > 0 && m_migrateIndex < m_nOldBuckets; count--)
     {
-      for (uint32 i = 0; i < m_nBuckets; i++)
-        m_pBuckets[i].Free();
+      Member* pMember = m_pOldBuckets[m_migrateIndex];
+      m_pOldBuckets[m_migrateIndex] = NULL;
+      while (pMember != NULL)
+      {
+        Member* pNextMember = pMember->NextInBucket;
+        Member** ppBucket = &m_pBuckets[GetBucketIndex(pMember->Hash, m_nBuckets)];
+        pMember->NextInBucket = *ppBucket;
+        *ppBucket = pMember;
+        pMember = pNextMember;
+      }
+
+      m_migrateIndex++;
     }
 
-    free(m_pBuckets);
-    m_pBuckets = NULL;
-    m_nBuckets = 0;
-    m_uBucketSize = 0;
+    if (m_migrateIndex == m_nOldBuckets)
+    {
+      FreeBucketArray(m_pOldBuckets, m_nOldBuckets);
+      m_pOldBuckets = NULL;
+      m_nOldBuckets = 0;
+      m_migrateIndex = 0;
+    }
+  }
+
+  static size_t GetMemberAllocationSize(uint32 KeyLength) { return sizeof(Member) + KeyLength + 1; }
+
+  // allocates a member with a copy of the key, the value is left for the caller to construct
+  static Member* AllocateMember(AllocatorType& allocator, const char* Key, uint32 KeyLength)
+  {
+    Member* pMember = (Member*)allocator.Allocate(GetMemberAllocationSize(KeyLength), alignof(Member));
+    Assert(pMember != NULL);
+    pMember->KeyLength = KeyLength;
+    pMember->Key = reinterpret_cast<char*>(pMember + 1);
+    std::memcpy(pMember->Key, Key, KeyLength);
+    pMember->Key[KeyLength] = '\0';
+    return pMember;
   }
 
   void FreeMember(Member* member)
@@ -446,8 +562,7 @@ private:
     member->Value.~ValueType();
 
     // free memory
-    std::free(member->Key);
-    std::free(member);
+    GetAllocator().Free(member, GetMemberAllocationSize(member->KeyLength), alignof(Member));
   }
 
   void FreeMembers()
@@ -468,55 +583,15 @@ private:
     m_nMembers = 0;
   }
 
-  void AutoResize()
-  {
-    // basically, we double the bucket size until it's the number of buckets * 8, then
-    // we multiply the number of buckets by 2
-    uint32 newBuckets;
-    uint32 newBucketSize;
-    if ((m_nBuckets * 8) > m_uBucketSize)
-    {
-      // grow bucket size
-      newBuckets = m_nBuckets;
-      newBucketSize = m_uBucketSize * 2;
-    }
-    else
-    {
-      // grow bucket count
-      newBuckets = m_nBuckets * 2;
-      newBucketSize = m_uBucketSize;
-    }
-
-    // do the resize
-    Resize(newBuckets, newBucketSize);
-  }
-
-  void Resize(uint32 newBuckets, uint32 newBucketSize)
-  {
-    DebugAssert(newBuckets > 0);
-    DebugAssert(newBucketSize > 0);
-    DebugAssert((newBuckets * newBucketSize) >= m_nMembers);
-
-    FreeBuckets();
-    InitBuckets(newBuckets, newBucketSize);
-
-    // re-insert all members
-    for (Member* member = m_pFirstMember; member != NULL; member = member->NextMember)
-    {
-      bool r = m_pBuckets[member->Hash % m_nBuckets].Insert(member);
-      DebugAssert(r);
-      UNREFERENCED_PARAMETER(r);
-    }
-  }
-
-  Member* _Insert(const char* Key, const ValueType& Value, bool* IsNew)
+  Member* _Insert(const StringView& KeyView, const ValueType& Value, bool* IsNew)
   {
     // hash the key
-    uint32 KeyLength = Y_strlen(Key);
+    const char* Key = KeyView.GetData();
+    uint32 KeyLength = KeyView.GetLength();
     HashType Hash = GetStringHash(Key, KeyLength);
 
     // look up
-    Member* pMember = m_pBuckets[Hash % m_nBuckets].Find(Key, KeyLength, Hash);
+    Member* pMember = FindInBucket(*GetBucket(Hash), Key, KeyLength, Hash);
     if (pMember != NULL)
     {
       *IsNew = false;
@@ -524,24 +599,14 @@ private:
     }
 
     // create member
-    pMember = (Member*)malloc(sizeof(Member));
-    pMember->KeyLength = KeyLength;
-    pMember->Key = Y_mallocT<char>(pMember->KeyLength + 1);
-    for (uint32 i = 0; i < KeyLength; i++)
-      pMember->Key[i] = Key[i]; // Y_tolower(Key[i]);
-    pMember->Key[KeyLength] = '\0';
-
+    pMember = AllocateMember(GetAllocator(), Key, KeyLength);
     new (&pMember->Value) ValueType(Value);
     pMember->Hash = Hash;
 
     // insert into bucket
-    for (;;)
-    {
-      if (m_pBuckets[Hash % m_nBuckets].Insert(pMember))
-        break;
-
-      AutoResize();
-    }
+    Member** ppBucket = GetBucket(Hash);
+    pMember->NextInBucket = *ppBucket;
+    *ppBucket = pMember;
 
     // insert into member chain
     if (m_pLastMember != NULL)
@@ -559,13 +624,23 @@ private:
 
     m_nMembers++;
     *IsNew = true;
+
+    // move part of the table on if it's rehashing, otherwise start growing it once the load factor is exceeded
+    if (m_pOldBuckets != NULL)
+      MigrateBuckets(MigrateBucketsPerOperation);
+    else if ((float)m_nMembers > (float)m_nBuckets * m_maxLoadFactor)
+      BeginRehash(m_nBuckets * 2);
+
     return pMember;
   }
 
   Member* m_pFirstMember;
   Member* m_pLastMember;
   uint32 m_nMembers;
-  Bucket* m_pBuckets;
+  Member** m_pBuckets;
   uint32 m_nBuckets;
-  uint32 m_uBucketSize;
+  Member** m_pOldBuckets;
+  uint32 m_nOldBuckets;
+  uint32 m_migrateIndex;
+  float m_maxLoadFactor;
 };
@@ -29,6 +29,7 @@ struct Y_CPUID_RESULT
   bool SupportsSSE42;
   bool SupportsSSE5A;
   bool SupportsAVX;
+  bool SupportsAVX2;
   bool SupportsAES;
   bool SupportsHTT;
   bool Supports3DNow;
@@ -36,3 +37,109 @@ struct Y_CPUID_RESULT
 };
 
 void Y_ReadCPUID(Y_CPUID_RESULT* pResult);
+
+// Checks only for AVX2, without the rest of Y_ReadCPUID, for choosing code paths at startup.
+// Includes the check that the OS saves the AVX registers.
+bool Y_CPUSupportsAVX2();
+
+// Carry-less multiplication (PCLMULQDQ), used to fold CRCs 64 bytes at a time.
+bool Y_CPUSupportsPCLMULQDQ();
+
+// The SHA extensions, along with the SSE4.1 the code using them needs.
+bool Y_CPUSupportsSHA();
+
+// A timestamp counter that ticks at a constant rate through frequency and power state changes, so it can time
+// intervals. Always false on other cpus.
+bool Y_CPUSupportsInvariantTSC();
+
+// The ARMv8 SHA-256 instructions. Always false on other cpus.
+bool Y_CPUSupportsARMSHA2();
+
+// The ARMv8 CRC32 instructions, which are optional before ARMv8.1. Always false on other cpus.
+bool Y_CPUSupportsARMCRC32();
+
+// Instruction set extensions, as a bitmask for choosing code paths at runtime. Read once and cached, so checking is
+// cheap enough to do anywhere. Only the flags for the cpu the library was built for are ever set, and the ones that
+// need OS support (AVX, F16C, FMA, AVX-512) are only set when the OS saves their registers.
+enum Y_CPU_FEATURE : uint32
+{
+  Y_CPU_FEATURE_SSE2 = (1 << 0),
+  Y_CPU_FEATURE_SSSE3 = (1 << 1),
+  Y_CPU_FEATURE_SSE41 = (1 << 2),
+  Y_CPU_FEATURE_SSE42 = (1 << 3),
+  Y_CPU_FEATURE_POPCNT = (1 << 4),
+  Y_CPU_FEATURE_AVX = (1 << 5),
+  Y_CPU_FEATURE_AVX2 = (1 << 6),
+  Y_CPU_FEATURE_AVX512F = (1 << 7),
+  Y_CPU_FEATURE_AVX512BW = (1 << 8),
+  Y_CPU_FEATURE_BMI1 = (1 << 9),
+  Y_CPU_FEATURE_BMI2 = (1 << 10),
+  Y_CPU_FEATURE_PCLMULQDQ = (1 << 11),
+  Y_CPU_FEATURE_AES = (1 << 12),
+  Y_CPU_FEATURE_SHA = (1 << 13),
+  Y_CPU_FEATURE_INVARIANT_TSC = (1 << 14),
+  Y_CPU_FEATURE_F16C = (1 << 15),
+  Y_CPU_FEATURE_FMA = (1 << 21),
+  Y_CPU_FEATURE_NEON = (1 << 16),
+  Y_CPU_FEATURE_ARM_CRC32 = (1 << 17),
+  Y_CPU_FEATURE_ARM_AES = (1 << 18),
+  Y_CPU_FEATURE_ARM_PMULL = (1 << 19),
+  Y_CPU_FEATURE_ARM_SHA2 = (1 << 20),
+};
+
+uint32 Y_GetCPUFeatures();
+
+// True if the cpu has all of the given features.
+inline bool Y_CPUHasFeatures(uint32 features)
+{
+  return ((Y_GetCPUFeatures() & features) == features);
+}
+
+// Sizes in bytes of the data caches seen by one core, zero for levels the cpu doesn't have. When the OS and cpu don't
+// say, the line size is taken as 64 bytes and the rest are left zero.
+struct Y_CPU_CACHE_INFO
+{
+  uint32 LineSize;
+  uint32 L1DataSize;
+  uint32 L2Size;
+  uint32 L3Size;
+};
+
+void Y_ReadCPUCacheInfo(Y_CPU_CACHE_INFO* pResult);
+
+// The line size from Y_ReadCPUCacheInfo, for strides picked at runtime. Layouts fixed at compile time use
+// Y_CACHE_LINE_SIZE instead.
+uint32 Y_GetCacheLineSize();
+
+// Picks one implementation of a function for the cpu, for kernels with several versions compiled for different
+// instruction sets. Defines a static pointer Name, which starts out pointing at Fallback and is set to whatever
+// Resolver returns during static initialization. Anything that calls through it before then, such as another static
+// initializer, gets the fallback, so it has to be one every cpu can run.
+//
+//   static uint32 ComputeScalar(const byte* pBytes, size_t length);
+//   static decltype(&ComputeScalar) SelectCompute()
+//   {
+//     return Y_CPUHasFeatures(Y_CPU_FEATURE_AVX2) ? ComputeAVX2 : ComputeScalar;
+//   }
+//   Y_CPU_DISPATCH(s_pCompute, ComputeScalar, SelectCompute);
+#define Y_CPU_DISPATCH(Name, Fallback, Resolver)                                                                       \
+  static decltype(&Fallback) Name = &Fallback;                                                                         \
+  static const bool Name##Resolved = ((Name = Resolver()), true)
+
+// Logical processors, cores and NUMA nodes, for placing threads. Masks have bit n set for logical processor n, so
+// only the first Y_CPU_TOPOLOGY_MAX_PROCESSORS processors are described. When the OS doesn't expose the topology,
+// every processor is reported as its own core on a single node.
+#define Y_CPU_TOPOLOGY_MAX_PROCESSORS 64
+
+struct Y_CPU_TOPOLOGY
+{
+  uint32 LogicalProcessorCount;
+  uint32 CoreCount;
+  uint32 NodeCount;
+
+  // processors making up each core (hyperthread siblings) and each node
+  uint64 CoreMasks[Y_CPU_TOPOLOGY_MAX_PROCESSORS];
+  uint64 NodeMasks[Y_CPU_TOPOLOGY_MAX_PROCESSORS];
+};
+
+void Y_ReadCPUTopology(Y_CPU_TOPOLOGY* pResult);
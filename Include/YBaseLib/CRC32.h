@@ -16,6 +16,10 @@ public:
   bool HashStreamPartial(ByteStream* pStream, uint64 count);
   void Reset();
 
+  // The crc of two buffers one after the other, from each one's crc and the second's length, so buffers can be hashed
+  // apart (on several threads, say) and joined.
+  static uint32 Combine(uint32 crcA, uint32 crcB, uint64 lengthB);
+
 private:
   uint32 m_currentCRC;
 };
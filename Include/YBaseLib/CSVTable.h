@@ -0,0 +1,68 @@
+#pragma once
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/ParallelTextReader.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/StringView.h"
+#include "YBaseLib/ThreadPool.h"
+
+enum CSV_COLUMN_TYPE
+{
+  CSV_COLUMN_TYPE_INT64,
+  CSV_COLUMN_TYPE_DOUBLE,
+  CSV_COLUMN_TYPE_STRING,
+  CSV_COLUMN_TYPE_COUNT,
+};
+
+// Delimited text read into a column per field, each an array of int64, double or strings. There's no schema: a
+// column is INT64 if every value in it is an integer written the way FormatInt64 would write it, otherwise DOUBLE if
+// every value is a number, otherwise STRING, and empty values don't count either way, reading as zero in numeric
+// columns. Fields may be quoted, with "" for a quote inside, but can't span lines.
+// Parse splits the stream by ParallelForEachLine's rules and reads the chunks on the pool twice: once to find each
+// column's type and size, then again to write the values straight into the columns, each chunk at its own offset.
+class CSVTable
+{
+public:
+  CSVTable();
+  ~CSVTable();
+
+  // The stream must be in memory, like a file opened with BYTESTREAM_OPEN_MAPPED. With a header, the first line is
+  // the columns' names, otherwise they're unnamed and the first line is data. Every record must have every field.
+  bool Parse(ThreadPool* pThreadPool, ByteStream* pStream, const char* FileName, char delimiter = ',',
+             bool hasHeader = true, uint32 chunkSize = ParallelTextReaderChunkSize);
+  void Clear();
+
+  uint32 GetRecordCount() const { return m_recordCount; }
+  uint32 GetColumnCount() const { return m_columns.GetSize(); }
+  const String& GetColumnName(uint32 column) const { return m_columns[column]->Name; }
+  CSV_COLUMN_TYPE GetColumnType(uint32 column) const { return m_columns[column]->Type; }
+
+  // the index of the column with the name, or -1
+  int32 FindColumn(const char* name) const;
+
+  // A column's values, one per record, or null if it's a column of another type.
+  const int64* GetInt64Column(uint32 column) const;
+  const double* GetDoubleColumn(uint32 column) const;
+
+  // a record's value in a string column, empty for other types
+  StringView GetString(uint32 column, uint32 record) const;
+
+private:
+  struct Column
+  {
+    String Name;
+    CSV_COLUMN_TYPE Type;
+    PODArray<int64> Int64Values;
+    PODArray<double> DoubleValues;
+
+    // the values one after another, and where each starts, with the end at the back
+    PODArray<char> StringData;
+    PODArray<uint32> StringOffsets;
+  };
+
+  PODArray<Column*> m_columns;
+  uint32 m_recordCount;
+
+  DeclareNonCopyable(CSVTable);
+};
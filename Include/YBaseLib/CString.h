@@ -19,6 +19,11 @@ int32 Y_strncmp(const char* S1, const char* S2, uint32 Count);
 int32 Y_stricmp(const char* S1, const char* S2);
 int32 Y_strnicmp(const char* S1, const char* S2, uint32 Count);
 
+// compare strings of known length, which don't have to be null-terminated. ordered like Y_strcmp, with a string that
+// is a prefix of the other one coming first.
+int32 Y_strcmp(const char* S1, uint32 Length1, const char* S2, uint32 Length2);
+int32 Y_stricmp(const char* S1, uint32 Length1, const char* S2, uint32 Length2);
+
 // format functions
 uint32 Y_snprintf(char* Destination, uint32 cbDestination, const char* Format, ...);
 uint32 Y_vsnprintf(char* Destination, uint32 cbDestination, const char* Format, va_list ArgPointer);
@@ -39,6 +44,11 @@ char* Y_strstr(char* SearchString, const char* SearchTerm);
 char* Y_strpbrk(char* SearchString, const char* SearchTerms);
 char* Y_strrpbrk(char* SearchString, const char* SearchTerms);
 
+// search the first Length characters of a string, which doesn't have to be null-terminated
+const char* Y_strnchr(const char* SearchString, uint32 Length, char Character);
+const char* Y_strnrchr(const char* SearchString, uint32 Length, char Character);
+const char* Y_strnstr(const char* SearchString, uint32 Length, const char* SearchTerm, uint32 SearchTermLength);
+
 // substring functions
 char* Y_substr(char* Destination, uint32 cbDestination, const char* Source, int32 Offset, int32 Count = -1);
 
@@ -48,6 +58,10 @@ char Y_toupper(char Character);
 void Y_strlwr(char* Str, uint32 Length);
 void Y_strupr(char* Str, uint32 Length);
 
+// lower-cases ASCII letters only, whatever the locale, so it folds the same way as Y_stricmp with lengths.
+// Destination can be Source.
+void Y_strlwrcpy(char* Destination, const char* Source, uint32 Length);
+
 // split string using Separator, consecutive separators count as multiple tokens
 uint32 Y_strsplit(char* Str, char Separator, char** Tokens, uint32 MaxTokens);
 
@@ -73,9 +87,12 @@ int32 Y_selectstring(const char* SelectionString, const char* ValueString);
 // hex strings
 uint32 Y_parsehexstring(const char* hexString, void* pOutBytes, uint32 maxOutBytes, bool exitOnInvalidCharacter = true,
                         bool* pAtEnd = NULL);
+uint32 Y_parsehexstring(const char* hexString, uint32 hexStringLength, void* pOutBytes, uint32 maxOutBytes,
+                        bool exitOnInvalidCharacter = true, bool* pAtEnd = NULL);
 uint32 Y_makehexstring(const void* pInBytes, uint32 nInBytes, char* outBuffer, uint32 bufferSize);
 
-// base64 strings. bufferSize must be (nInBytes / 4 + 1) * 3 long at a minimum
+// base64 strings, see Base64.h for the other alphabet, unpadded text and streaming. bufferSize must be
+// (nInBytes / 4 + 1) * 3 long at a minimum
 uint32 Y_getencodedbase64length(uint32 byteLength);
 uint32 Y_getdecodedbase64length(uint32 base64Length);
 uint32 Y_parsebase64(const char* base64String, void* pOutBytes, uint32 maxOutBytes, bool exitOnInvalidCharacter = true,
@@ -0,0 +1,286 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/HashTable.h"
+#include "YBaseLib/HashTrait.h"
+#include "YBaseLib/NonCopyable.h"
+
+// Hit and miss counts of a cache, and what it holds.
+struct CacheStatistics
+{
+  uint64 Hits;
+  uint64 Misses;
+  uint64 Insertions;
+  uint64 Evictions;
+  size_t ByteCount;
+  uint32 EntryCount;
+};
+
+// HashTable of values that each take up a number of bytes given when they're added, keeping the total within a
+// budget by evicting the least recently used. Eviction is segmented LRU: new entries start on probation, and move to a
+// protected segment, of at most protectedPercent of the budget, when they're found again. Entries pushed out of the
+// protected segment go back to probation, and evictions come from probation first, so one pass over many entries
+// that are never used again doesn't flush the ones that are.
+//
+// The eviction callback is called for every value that leaves the cache, with evicted set if it was to make room,
+// after the entry is unlinked, so it can release whatever the value owns. It must not call back into the cache.
+// Not thread-safe, see ConcurrentCache.
+template<typename KeyType, typename ValueType, class HashTraitClass = HashTrait<KeyType>>
+class Cache
+{
+public:
+  typedef void (*EvictionCallbackType)(void* pUserParam, const KeyType& key, ValueType& value, bool evicted);
+
+  Cache(size_t byteBudget, uint32 protectedPercent = 80)
+    : m_byteBudget(byteBudget), m_protectedPercent(protectedPercent), m_pEvictionCallback(nullptr),
+      m_pEvictionCallbackParam(nullptr)
+  {
+    DebugAssert(protectedPercent <= 100);
+    ResetStatistics();
+  }
+
+  ~Cache() { Clear(); }
+
+  void SetEvictionCallback(EvictionCallbackType callback, void* pUserParam)
+  {
+    m_pEvictionCallback = callback;
+    m_pEvictionCallbackParam = pUserParam;
+  }
+
+  size_t GetByteBudget() const { return m_byteBudget; }
+  size_t GetByteCount() const { return m_probation.ByteCount + m_protected.ByteCount; }
+  uint32 GetEntryCount() const { return m_table.GetMemberCount(); }
+
+  // Evicts what no longer fits straight away.
+  void SetByteBudget(size_t byteBudget)
+  {
+    m_byteBudget = byteBudget;
+    DemoteToProtectedBudget();
+    EvictToBudget(nullptr);
+  }
+
+  // Counts a hit or a miss, and marks the entry used. The pointer is valid until the cache is next changed.
+  ValueType* Find(const KeyType& key)
+  {
+    typename Table::Member* pMember = m_table.Find(key);
+    if (pMember == nullptr)
+    {
+      m_statistics.Misses++;
+      return nullptr;
+    }
+
+    m_statistics.Hits++;
+    Entry* pEntry = pMember->Value;
+    Touch(pEntry);
+    return &pEntry->Value;
+  }
+
+  // copies the value out, otherwise the same as Find
+  bool Find(const KeyType& key, ValueType* pValue)
+  {
+    ValueType* pFound = Find(key);
+    if (pFound == nullptr)
+      return false;
+
+    *pValue = *pFound;
+    return true;
+  }
+
+  // doesn't count or mark the entry used
+  bool Contains(const KeyType& key) const { return (m_table.Find(key) != nullptr); }
+
+  // Adds the value, or replaces the key's current one, which goes to the eviction callback, and evicts until it
+  // fits. Returns false if byteSize is more than the whole budget, in which case the key is removed instead.
+  bool Insert(const KeyType& key, const ValueType& value, size_t byteSize)
+  {
+    if (byteSize > m_byteBudget)
+    {
+      Remove(key);
+      return false;
+    }
+
+    m_statistics.Insertions++;
+
+    typename Table::Member* pMember = m_table.Find(key);
+    Entry* pEntry;
+    if (pMember != nullptr)
+    {
+      pEntry = pMember->Value;
+      if (m_pEvictionCallback != nullptr)
+        m_pEvictionCallback(m_pEvictionCallbackParam, pMember->Key, pEntry->Value, false);
+
+      pEntry->Value = value;
+      GetSegment(pEntry).ByteCount += byteSize - pEntry->ByteSize;
+      pEntry->ByteSize = byteSize;
+      Touch(pEntry);
+    }
+    else
+    {
+      pEntry = new Entry(value, byteSize);
+      pEntry->pMember = m_table.Insert(key, pEntry);
+      LinkFront(m_probation, pEntry);
+    }
+
+    EvictToBudget(pEntry);
+    return true;
+  }
+
+  bool Remove(const KeyType& key)
+  {
+    typename Table::Member* pMember = m_table.Find(key);
+    if (pMember == nullptr)
+      return false;
+
+    RemoveEntry(pMember->Value, false);
+    return true;
+  }
+
+  void Clear()
+  {
+    while (m_probation.pTail != nullptr)
+      RemoveEntry(m_probation.pTail, false);
+    while (m_protected.pTail != nullptr)
+      RemoveEntry(m_protected.pTail, false);
+  }
+
+  CacheStatistics GetStatistics() const
+  {
+    CacheStatistics statistics = m_statistics;
+    statistics.ByteCount = GetByteCount();
+    statistics.EntryCount = GetEntryCount();
+    return statistics;
+  }
+
+  void ResetStatistics()
+  {
+    m_statistics.Hits = 0;
+    m_statistics.Misses = 0;
+    m_statistics.Insertions = 0;
+    m_statistics.Evictions = 0;
+  }
+
+private:
+  struct Entry;
+  typedef HashTable<KeyType, Entry*, HashTraitClass> Table;
+
+  struct Entry
+  {
+    Entry(const ValueType& value, size_t byteSize)
+      : Value(value), ByteSize(byteSize), pMember(nullptr), pPrev(nullptr), pNext(nullptr), Protected(false)
+    {
+    }
+
+    ValueType Value;
+    size_t ByteSize;
+    typename Table::Member* pMember;
+
+    // in the segment's list, most recently used first
+    Entry* pPrev;
+    Entry* pNext;
+    bool Protected;
+  };
+
+  struct Segment
+  {
+    Segment() : pHead(nullptr), pTail(nullptr), ByteCount(0) {}
+
+    Entry* pHead;
+    Entry* pTail;
+    size_t ByteCount;
+  };
+
+  Segment& GetSegment(Entry* pEntry) { return pEntry->Protected ? m_protected : m_probation; }
+
+  size_t GetProtectedBudget() const
+  {
+    // divided first so large budgets don't overflow
+    return m_byteBudget / 100 * m_protectedPercent + m_byteBudget % 100 * m_protectedPercent / 100;
+  }
+
+  static void LinkFront(Segment& segment, Entry* pEntry)
+  {
+    pEntry->pPrev = nullptr;
+    pEntry->pNext = segment.pHead;
+    if (segment.pHead != nullptr)
+      segment.pHead->pPrev = pEntry;
+    else
+      segment.pTail = pEntry;
+
+    segment.pHead = pEntry;
+    segment.ByteCount += pEntry->ByteSize;
+  }
+
+  static void Unlink(Segment& segment, Entry* pEntry)
+  {
+    if (pEntry->pPrev != nullptr)
+      pEntry->pPrev->pNext = pEntry->pNext;
+    else
+      segment.pHead = pEntry->pNext;
+    if (pEntry->pNext != nullptr)
+      pEntry->pNext->pPrev = pEntry->pPrev;
+    else
+      segment.pTail = pEntry->pPrev;
+
+    segment.ByteCount -= pEntry->ByteSize;
+  }
+
+  // moves the entry to the front of the protected segment, making room there by demoting its oldest
+  void Touch(Entry* pEntry)
+  {
+    Unlink(GetSegment(pEntry), pEntry);
+    pEntry->Protected = true;
+    LinkFront(m_protected, pEntry);
+    DemoteToProtectedBudget();
+  }
+
+  void DemoteToProtectedBudget()
+  {
+    size_t protectedBudget = GetProtectedBudget();
+    while (m_protected.ByteCount > protectedBudget && m_protected.pTail != m_protected.pHead)
+    {
+      Entry* pEntry = m_protected.pTail;
+      Unlink(m_protected, pEntry);
+      pEntry->Protected = false;
+      LinkFront(m_probation, pEntry);
+    }
+  }
+
+  // Evicts the oldest on probation, then from the protected segment, never pKeep.
+  void EvictToBudget(Entry* pKeep)
+  {
+    while (GetByteCount() > m_byteBudget)
+    {
+      Entry* pVictim = m_probation.pTail;
+      if (pVictim == nullptr || pVictim == pKeep)
+        pVictim = (m_protected.pTail != pKeep) ? m_protected.pTail : nullptr;
+      if (pVictim == nullptr)
+        break;
+
+      m_statistics.Evictions++;
+      RemoveEntry(pVictim, true);
+    }
+  }
+
+  void RemoveEntry(Entry* pEntry, bool evicted)
+  {
+    Unlink(GetSegment(pEntry), pEntry);
+    if (m_pEvictionCallback != nullptr)
+      m_pEvictionCallback(m_pEvictionCallbackParam, pEntry->pMember->Key, pEntry->Value, evicted);
+
+    m_table.Remove(pEntry->pMember);
+    delete pEntry;
+  }
+
+  Table m_table;
+  Segment m_probation;
+  Segment m_protected;
+  size_t m_byteBudget;
+  uint32 m_protectedPercent;
+
+  EvictionCallbackType m_pEvictionCallback;
+  void* m_pEvictionCallbackParam;
+
+  CacheStatistics m_statistics;
+
+  DeclareNonCopyable(Cache);
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Memory.h"
+
+// A value on cache lines of its own, so writes to it don't invalidate the line for threads using what's next to it.
+// It's only aligned if whatever holds it is: statics, locals and members of those are, but new only aligns to 16
+// bytes before C++17, so heap objects only get the padding unless their class uses Y_DECLARE_CACHE_ALIGNED_NEW.
+template<typename T>
+struct Y_CACHE_ALIGNED_DECL CacheAligned
+{
+  T Value;
+
+  CacheAligned() : Value() {}
+  CacheAligned(const T& value) : Value(value) {}
+};
+
+// Gives a class holding cache aligned members an aligned new and delete, for compilers that don't do it themselves.
+#define Y_DECLARE_CACHE_ALIGNED_NEW()                                                                                  \
+  static void* operator new(size_t size) { return Y_aligned_malloc(size, Y_CACHE_LINE_SIZE); }                        \
+  static void operator delete(void* pMemory) { Y_aligned_free(pMemory); }
+
+// Small per-thread number for picking shards, handed out in the order threads first ask, so up to N threads never
+// share a shard of a structure with N of them. Take it modulo the shard count.
+uint32 Y_GetThreadShardIndex();
+
+// A counter split into shards on their own cache lines, each thread adding to the one its shard index picks, so
+// threads counting on different cores don't take turns owning one line. Reading sums the shards, making it the
+// thing for counts updated far more often than they're read. The value read while others add may be slightly stale.
+template<typename T, uint32 SHARD_COUNT = 16>
+class ShardedCounter
+{
+public:
+  void Add(T value) { Y_AtomicAdd(m_shards[Y_GetThreadShardIndex() % SHARD_COUNT].Value, value); }
+  void Increment() { Add(T(1)); }
+  void Decrement() { Add(T(-1)); }
+
+  T GetValue() const
+  {
+    T value = 0;
+    for (uint32 i = 0; i < SHARD_COUNT; i++)
+      value += Y_AtomicLoad(m_shards[i].Value, ATOMIC_MEMORY_ORDER_RELAXED);
+
+    return value;
+  }
+
+  // not atomic with respect to Add
+  void Reset()
+  {
+    for (uint32 i = 0; i < SHARD_COUNT; i++)
+      Y_AtomicStore(m_shards[i].Value, T(0), ATOMIC_MEMORY_ORDER_RELAXED);
+  }
+
+private:
+  CacheAligned<volatile T> m_shards[SHARD_COUNT];
+};
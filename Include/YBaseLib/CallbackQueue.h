@@ -1,21 +1,161 @@
 #pragma once
+#include "YBaseLib/Atomic.h"
 #include "YBaseLib/Common.h"
 #include "YBaseLib/Functor.h"
-#include "YBaseLib/Mutex.h"
-#include "YBaseLib/PODArray.h"
+#include "YBaseLib/IntrusiveLockFreeStack.h"
+#include "YBaseLib/IntrusiveMPSCQueue.h"
+#include "YBaseLib/SchedulerStats.h"
+#include "YBaseLib/SpinLock.h"
 
+// Queue of callbacks added from any thread and run by one. Adding a callback doesn't take a lock, the callbacks
+// are linked into a lock-free queue through nodes recycled from a free list, so only the first few adds allocate.
+// Callables are stored in the node itself, or when too big for it in a block from a second free list, so adding a
+// lambda doesn't allocate either unless its captures are larger than OverflowCallbackSize.
+// RunCallbacks must only be called from one thread at a time.
 class CallbackQueue
 {
+  DeclareNonCopyable(CallbackQueue);
+
 public:
+  static const uint32 InlineCallbackSize = 64;
+  static const uint32 OverflowCallbackSize = 512;
+  static const uint32 CallbackAlignment = 16;
+
   CallbackQueue();
   ~CallbackQueue();
 
+  // the functor is deleted once it has run
   void AddCallback(Functor* pCallback);
 
+  // stores a copy of any callable taking no arguments
+  template<class T, class = typename std::enable_if<!std::is_convertible<T, Functor*>::value>::type>
+  void AddCallback(T&& callback)
+  {
+    typedef typename std::decay<T>::type CallbackType;
+    CallbackNode* pNode = AllocateNode();
+    StoreCallback<CallbackType>(pNode, std::forward<T>(callback),
+                                std::integral_constant<CALLBACK_STORAGE, GetCallbackStorage<CallbackType>()>());
+    QueueNode(pNode);
+  }
+
+  // runs until the queue is empty, including callbacks added by the callbacks. a callback still being added by
+  // another thread can be left for the next call.
   void RunCallbacks();
 
+  // per-callback queue time and execution time counters, off by default
+  bool IsStatsEnabled() const { return m_StatsEnabled; }
+  void SetStatsEnabled(bool enabled);
+
+  // snapshot of the counters, the thread calling RunCallbacks counts as the one worker
+  SchedulerStats GetStats();
+
 private:
-  typedef PODArray<Functor*> CallbackFunctionQueue;
-  CallbackFunctionQueue m_CallbackQueue;
-  Mutex m_CallbackQueueLock;
+  // runs the callable stored in the node, unless execute is false, then destroys it
+  typedef void (*InvokeFunction)(CallbackQueue* pQueue, void* pStorage, bool execute);
+
+  // QueueTime is zero if stats were disabled when the callback was added
+  struct CallbackNode
+  {
+    CallbackNode* next;
+    InvokeFunction pInvoke;
+    Y_TIMER_VALUE QueueTime;
+    ALIGN_DECL(16) byte Storage[InlineCallbackSize];
+  };
+
+  struct OverflowBlock
+  {
+    OverflowBlock* next;
+    ALIGN_DECL(16) byte Storage[OverflowCallbackSize];
+  };
+
+  // where a callable is kept, picked at compile time so only that placement is instantiated for it
+  enum CALLBACK_STORAGE
+  {
+    CALLBACK_STORAGE_INLINE,
+    CALLBACK_STORAGE_OVERFLOW,
+    CALLBACK_STORAGE_ALLOCATED,
+  };
+
+  template<class T>
+  static constexpr CALLBACK_STORAGE GetCallbackStorage()
+  {
+    return (alignof(T) > CallbackAlignment || sizeof(T) > OverflowCallbackSize)
+             ? CALLBACK_STORAGE_ALLOCATED
+             : ((sizeof(T) > InlineCallbackSize) ? CALLBACK_STORAGE_OVERFLOW : CALLBACK_STORAGE_INLINE);
+  }
+
+  template<class T, class U>
+  void StoreCallback(CallbackNode* pNode, U&& callback,
+                     std::integral_constant<CALLBACK_STORAGE, CALLBACK_STORAGE_INLINE>)
+  {
+    new (pNode->Storage) T(std::forward<U>(callback));
+    pNode->pInvoke = &InvokeInline<T>;
+  }
+
+  template<class T, class U>
+  void StoreCallback(CallbackNode* pNode, U&& callback,
+                     std::integral_constant<CALLBACK_STORAGE, CALLBACK_STORAGE_OVERFLOW>)
+  {
+    OverflowBlock* pBlock = AllocateOverflowBlock();
+    new (pBlock->Storage) T(std::forward<U>(callback));
+    *reinterpret_cast<OverflowBlock**>(pNode->Storage) = pBlock;
+    pNode->pInvoke = &InvokeOverflow<T>;
+  }
+
+  template<class T, class U>
+  void StoreCallback(CallbackNode* pNode, U&& callback,
+                     std::integral_constant<CALLBACK_STORAGE, CALLBACK_STORAGE_ALLOCATED>)
+  {
+    *reinterpret_cast<T**>(pNode->Storage) = new T(std::forward<U>(callback));
+    pNode->pInvoke = &InvokeAllocated<T>;
+  }
+
+  template<class T>
+  static void InvokeInline(CallbackQueue* pQueue, void* pStorage, bool execute)
+  {
+    T* pCallback = reinterpret_cast<T*>(pStorage);
+    if (execute)
+      (*pCallback)();
+
+    pCallback->~T();
+  }
+
+  template<class T>
+  static void InvokeOverflow(CallbackQueue* pQueue, void* pStorage, bool execute)
+  {
+    OverflowBlock* pBlock = *reinterpret_cast<OverflowBlock**>(pStorage);
+    InvokeInline<T>(pQueue, pBlock->Storage, execute);
+    pQueue->m_FreeOverflowBlocks.Push(pBlock);
+  }
+
+  template<class T>
+  static void InvokeAllocated(CallbackQueue* pQueue, void* pStorage, bool execute)
+  {
+    T* pCallback = *reinterpret_cast<T**>(pStorage);
+    if (execute)
+      (*pCallback)();
+
+    delete pCallback;
+  }
+
+  static void InvokeFunctor(CallbackQueue* pQueue, void* pStorage, bool execute);
+
+  CallbackNode* AllocateNode();
+  OverflowBlock* AllocateOverflowBlock();
+  void QueueNode(CallbackNode* pNode);
+
+  IntrusiveMPSCQueue<CallbackNode> m_PendingCallbacks;
+
+  // nodes and blocks are only freed by the destructor, which the free lists rely on
+  IntrusiveLockFreeStack<CallbackNode> m_FreeNodes;
+  IntrusiveLockFreeStack<OverflowBlock> m_FreeOverflowBlocks;
+
+  Y_ATOMIC_DECL uint32 m_PendingCount;
+
+  // only guards the stats, held for a few additions
+  SpinLock m_StatsLock;
+
+  volatile bool m_StatsEnabled;
+  Y_TIMER_VALUE m_StatsStartTime;
+  SchedulerWorkerStats m_Stats;
 };
@@ -0,0 +1,57 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/ContentChunker.h"
+#include "YBaseLib/HashTable.h"
+#include "YBaseLib/PODArray.h"
+
+class ByteStream;
+
+// Where each known chunk is stored, by digest, for deduplicating packs and building delta updates. What a pack is,
+// an archive, a file in one, or anything else, is up to the caller, which numbers them.
+//   ChunkIndex index;
+//   index.Load(pIndexStream);
+//   index.FindMissingChunks(newChunks.GetBasePointer(), newChunks.GetSize(), &missing);
+//   // ship only the missing chunks, then add them with their new pack
+class ChunkIndex
+{
+public:
+  struct Location
+  {
+    uint32 PackID;
+    uint32 Size;
+    uint64 Offset;
+  };
+
+  ChunkIndex();
+  ~ChunkIndex();
+
+  uint32 GetChunkCount() const { return m_chunks.GetMemberCount(); }
+
+  // Adds a chunk, returning false if it was already there, in which case it keeps its first location.
+  bool AddChunk(const CHUNK_DIGEST& digest, const Location& location);
+
+  // adds chunks from a ContentChunker, located by their offsets in the pack, returning how many were new
+  uint32 AddChunks(const CONTENT_CHUNK* pChunks, uint32 count, uint32 packID);
+
+  const Location* FindChunk(const CHUNK_DIGEST& digest) const;
+  bool RemoveChunk(const CHUNK_DIGEST& digest);
+
+  // drops every chunk in a pack, for when it's deleted or rewritten
+  uint32 RemovePack(uint32 packID);
+
+  void Clear();
+
+  // The indices of the chunks that aren't in the index, which are what a delta update has to carry. Chunks
+  // repeated within the list are only counted as missing the first time.
+  void FindMissingChunks(const CONTENT_CHUNK* pChunks, uint32 count, PODArray<uint32>* pMissingIndices) const;
+
+  // little endian, the same on every platform, replacing everything in the index when loading
+  bool Save(ByteStream* pStream) const;
+  bool Load(ByteStream* pStream);
+
+private:
+  typedef HashTable<CHUNK_DIGEST, Location> ChunkTable;
+  ChunkTable m_chunks;
+
+  DeclareNonCopyable(ChunkIndex);
+};
@@ -42,6 +42,11 @@ public:
   // When finished, call FlushBytes(length).
   bool GetReadPointer(const void** ppReadPointer, size_t* pByteCount) const;
 
+  // Both runs of data in order, the second empty if the data doesn't wrap, for vectored writes. Moving the read
+  // pointer past the first run takes two calls, as the second run only becomes the first once it's consumed.
+  bool GetReadPointers(const void** ppFirstPointer, size_t* pFirstByteCount, const void** ppSecondPointer,
+                       size_t* pSecondByteCount) const;
+
   // Frees up buffer space.
   void MoveReadPointer(size_t byteCount);
 
@@ -167,6 +167,18 @@
 
 #endif
 
+// Hint to the processor that the thread is in a spin-wait loop
+#if defined(Y_COMPILER_MSVC)
+#include <intrin.h>
+#define Y_SpinWaitHint() _mm_pause()
+#elif (defined(Y_COMPILER_GCC) || defined(Y_COMPILER_CLANG)) && (defined(Y_CPU_X86) || defined(Y_CPU_X64))
+#define Y_SpinWaitHint() __builtin_ia32_pause()
+#elif (defined(Y_COMPILER_GCC) || defined(Y_COMPILER_CLANG)) && (defined(Y_CPU_ARM) || defined(Y_CPU_AARCH64))
+#define Y_SpinWaitHint() __asm__ __volatile__("yield")
+#else
+#define Y_SpinWaitHint()
+#endif
+
 // Deprecated Macro
 #ifdef Y_COMPILER_MSVC
 #define DEPRECATED_DECL(Msg) __declspec(deprecated(Msg))
@@ -185,6 +197,19 @@
 #error Invalid compiler
 #endif
 
+// Cache line size assumed for padding and alignment, which has to be known at compile time. Apple's arm64 cpus have
+// 128 byte lines, everything else 64. Y_GetCacheLineSize in CPUID.h gives the running cpu's.
+#ifndef Y_CACHE_LINE_SIZE
+#if defined(Y_CPU_AARCH64) && defined(Y_PLATFORM_OSX)
+#define Y_CACHE_LINE_SIZE 128
+#else
+#define Y_CACHE_LINE_SIZE 64
+#endif
+#endif
+
+// Starts a member on a new cache line, and pads a type to a whole number of lines.
+#define Y_CACHE_ALIGNED_DECL ALIGN_DECL(Y_CACHE_LINE_SIZE)
+
 // Thread local declaration
 #if defined(Y_COMPILER_MSVC)
 #define Y_DECLARE_THREAD_LOCAL(decl) static __declspec(thread) decl
@@ -0,0 +1,190 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/PODArray.h"
+
+class BinaryReader;
+class BinaryWriter;
+
+// Compressed bitmap over the full 32-bit index space, for large sparse sets of IDs (Roaring style).
+// Indices are split on their high 16 bits into chunks of 65536, and only chunks with bits set are stored, each one
+// in whichever container suits it:
+//   array   sorted 16-bit low halves, up to ArrayMaxCardinality bits
+//   bitmap  65536 bits in 8KB
+//   run     sorted (start, length - 1) pairs of 16-bit low halves, for chunks made of long runs of set bits
+// Setting single bits grows arrays into bitmaps and clearing them shrinks bitmaps back. Whenever a chunk is rebuilt,
+// by SetRange, the set operations or RunOptimize, it gets whichever container is smallest.
+// The query interface follows BitSet where it can, with 32-bit indices and no fixed size.
+class CompressedBitSet
+{
+public:
+  // chunks with more bits than this are stored as a bitmap
+  static const uint32 ArrayMaxCardinality = 4096;
+
+  CompressedBitSet();
+  CompressedBitSet(const CompressedBitSet& copy);
+  CompressedBitSet(CompressedBitSet&& from);
+  ~CompressedBitSet();
+
+  bool IsEmpty() const { return m_containers.IsEmpty(); }
+  void Clear();
+
+  bool TestBit(uint32 bit) const;
+  void SetBit(uint32 bit, bool on = true);
+  void UnsetBit(uint32 bit) { SetBit(bit, false); }
+  void FlipBit(uint32 bit) { SetBit(bit, !TestBit(bit)); }
+
+  // sets every bit in [first, last]
+  void SetRange(uint32 first, uint32 last);
+
+  // every bit set in mask is also set in this set
+  bool TestSetMask(const CompressedBitSet& mask) const;
+  bool TestSetEqual(const CompressedBitSet& test) const;
+
+  void Copy(const CompressedBitSet& other);
+  void Swap(CompressedBitSet& other) { m_containers.Swap(other.m_containers); }
+
+  // OR, AND, XOR and AND NOT with another set
+  void Combine(const CompressedBitSet& other);
+  void Mask(const CompressedBitSet& other);
+  void Xor(const CompressedBitSet& other);
+  void AndNot(const CompressedBitSet& other);
+
+  bool FindFirstSetBit(uint32* foundIndex) const { return FindNextSetBit(0, foundIndex); }
+  bool FindNextSetBit(uint32 startIndex, uint32* foundIndex) const;
+
+  // calls callback(index) for every set bit in ascending order
+  template<typename CB>
+  void ForEachSetBit(CB callback) const;
+
+  // number of set bits
+  uint64 PopCount() const;
+  uint64 Cardinality() const { return PopCount(); }
+
+  // rebuilds every chunk as its smallest container, worth calling once a set built bit by bit stops changing.
+  // returns true if any container changed type.
+  bool RunOptimize();
+
+  // bytes allocated for containers
+  size_t GetMemoryUsage() const;
+
+  // Read replaces the contents of the set, and leaves it empty if the stream fails or the data is malformed
+  // (unsorted values, overlapping runs, containers out of order).
+  bool Write(BinaryWriter* pWriter) const;
+  bool Read(BinaryReader* pReader);
+
+  // operators
+  bool operator[](uint32 index) const { return TestBit(index); }
+  bool operator==(const CompressedBitSet& rhs) const { return TestSetEqual(rhs); }
+  bool operator!=(const CompressedBitSet& rhs) const { return !TestSetEqual(rhs); }
+  CompressedBitSet& operator=(const CompressedBitSet& rhs)
+  {
+    Copy(rhs);
+    return *this;
+  }
+  CompressedBitSet& operator=(CompressedBitSet&& rhs)
+  {
+    Swap(rhs);
+    return *this;
+  }
+  CompressedBitSet& operator|=(const CompressedBitSet& rhs)
+  {
+    Combine(rhs);
+    return *this;
+  }
+  CompressedBitSet& operator&=(const CompressedBitSet& rhs)
+  {
+    Mask(rhs);
+    return *this;
+  }
+  CompressedBitSet& operator^=(const CompressedBitSet& rhs)
+  {
+    Xor(rhs);
+    return *this;
+  }
+  CompressedBitSet operator|(const CompressedBitSet& rhs) const
+  {
+    CompressedBitSet ret(*this);
+    ret.Combine(rhs);
+    return ret;
+  }
+  CompressedBitSet operator&(const CompressedBitSet& rhs) const
+  {
+    CompressedBitSet ret(*this);
+    ret.Mask(rhs);
+    return ret;
+  }
+  CompressedBitSet operator^(const CompressedBitSet& rhs) const
+  {
+    CompressedBitSet ret(*this);
+    ret.Xor(rhs);
+    return ret;
+  }
+
+private:
+  enum CONTAINER_TYPE
+  {
+    CONTAINER_TYPE_ARRAY,
+    CONTAINER_TYPE_BITMAP,
+    CONTAINER_TYPE_RUN,
+  };
+
+  // pValues is Size sorted uint16s for arrays, 1024 uint64s for bitmaps, and Size pairs of start/length for runs.
+  // a stored container is never empty.
+  struct Container
+  {
+    uint16 Key;
+    uint16 Type;
+    uint32 Cardinality;
+    uint32 Size;
+    uint32 Capacity;
+    uint16* pValues;
+  };
+
+  // index of the container for key, or where it would be inserted
+  uint32 FindContainer(uint16 key) const;
+
+  PODArray<Container> m_containers;
+
+  friend struct CompressedBitSetContainers;
+};
+
+template<typename CB>
+void CompressedBitSet::ForEachSetBit(CB callback) const
+{
+  for (uint32 containerIndex = 0; containerIndex < m_containers.GetSize(); containerIndex++)
+  {
+    const Container& container = m_containers[containerIndex];
+    uint32 high = (uint32)container.Key << 16;
+    if (container.Type == CONTAINER_TYPE_ARRAY)
+    {
+      for (uint32 i = 0; i < container.Size; i++)
+        callback(high | container.pValues[i]);
+    }
+    else if (container.Type == CONTAINER_TYPE_BITMAP)
+    {
+      const uint64* pWords = reinterpret_cast<const uint64*>(container.pValues);
+      for (uint32 i = 0; i < 1024; i++)
+      {
+        uint64 word = pWords[i];
+        while (word != 0)
+        {
+          uint64 index;
+          Y_bitscanforward(word, &index);
+          callback(high | (i * 64 + (uint32)index));
+          word &= word - 1;
+        }
+      }
+    }
+    else
+    {
+      for (uint32 i = 0; i < container.Size; i++)
+      {
+        uint32 start = container.pValues[i * 2];
+        uint32 end = start + container.pValues[i * 2 + 1];
+        for (uint32 value = start; value <= end; value++)
+          callback(high | value);
+      }
+    }
+  }
+}
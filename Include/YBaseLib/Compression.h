@@ -0,0 +1,110 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/PODArray.h"
+
+// Codecs for the buffer functions below. Deflate is built in with HAVE_ZLIB, LZ4 with HAVE_LZ4 and Zstandard with
+// HAVE_ZSTD, and a codec that isn't built in fails. Deflate is what every tool reads, LZ4 decompresses several times
+// faster at a worse ratio, and Zstandard decompresses a few times faster than deflate at a better ratio.
+enum COMPRESSION_CODEC
+{
+  COMPRESSION_CODEC_NONE,
+  COMPRESSION_CODEC_DEFLATE,
+  COMPRESSION_CODEC_LZ4,
+  COMPRESSION_CODEC_ZSTD,
+  COMPRESSION_CODEC_COUNT,
+};
+
+namespace Compression {
+
+const char* GetCodecName(COMPRESSION_CODEC codec);
+bool IsCodecAvailable(COMPRESSION_CODEC codec);
+
+// Levels are the codec's own: deflate 1-9, LZ4 1 for the fast compressor and 2-12 for LZ4HC, Zstandard 1-22. Levels
+// outside these are clamped, the default is used for 0.
+int32 GetDefaultLevel(COMPRESSION_CODEC codec);
+int32 GetEffectiveLevel(COMPRESSION_CODEC codec, int32 level);
+
+// the largest the compressed data can be, for sizing the destination buffer
+uint32 GetCompressedSizeUpperBound(COMPRESSION_CODEC codec, uint32 cbSourceBuffer);
+
+// Deflate data is in the zlib format, as ZLibHelpers writes it. LZ4 data is a raw block, it has no frame, so the
+// decompressed size has to be known to read it back.
+bool CompressBuffer(COMPRESSION_CODEC codec, void* pDestinationBuffer, uint32 cbDestinationBuffer,
+                    uint32* pCompressedSize, const void* pSourceBuffer, uint32 cbSourceBuffer, int32 level = 0);
+bool DecompressBuffer(COMPRESSION_CODEC codec, void* pDestinationBuffer, uint32 cbDestinationBuffer,
+                      uint32* pDecompressedSize, const void* pSourceBuffer, uint32 cbSourceBuffer);
+
+// Builds a dictionary of at most dictionaryCapacity bytes from sample records, for compressing records like them.
+// Runs of bytes found in many samples are picked, the most common closest to the end, where they're cheapest to refer
+// back to. The dictionary is raw content, so it works with every codec and trains the same in every build. A few
+// thousand samples and a dictionary around 100 times smaller than them is a good start. Returns false if there's
+// too little to learn from.
+bool TrainDictionary(const void* const* ppSamples, const uint32* pSampleSizes, uint32 sampleCount,
+                     uint32 dictionaryCapacity, PODArray<byte>* pDictionary);
+
+} // namespace Compression
+
+// Compresses many buffers one after another with the same codec, level and dictionary, keeping the codec's state
+// between them instead of setting it up for every buffer, which is most of the cost for small records. Data with no
+// dictionary is the same as Compression::CompressBuffer writes. With one, the decompressor needs the same
+// dictionary, deflate only uses its last 32KB and LZ4 its last 64KB. Not thread safe, keep one per thread.
+//   Compressor compressor;
+//   compressor.Initialize(COMPRESSION_CODEC_ZSTD);
+//   compressor.SetDictionary(dictionary.GetBasePointer(), dictionary.GetSize());
+//   compressor.Compress(pDest, cbDest, &compressedSize, pRecord, recordSize);
+class Compressor
+{
+public:
+  Compressor();
+  ~Compressor();
+
+  COMPRESSION_CODEC GetCodec() const { return m_codec; }
+  int32 GetLevel() const { return m_level; }
+
+  // returns false if the codec isn't built in
+  bool Initialize(COMPRESSION_CODEC codec, int32 level = 0);
+
+  // the dictionary is copied, and an empty one goes back to none
+  bool SetDictionary(const void* pDictionary, uint32 dictionarySize);
+
+  uint32 GetCompressedSizeUpperBound(uint32 cbSourceBuffer) const;
+  bool Compress(void* pDestinationBuffer, uint32 cbDestinationBuffer, uint32* pCompressedSize,
+                const void* pSourceBuffer, uint32 cbSourceBuffer);
+
+private:
+  struct State;
+  void Shutdown();
+
+  COMPRESSION_CODEC m_codec;
+  int32 m_level;
+  PODArray<byte> m_dictionary;
+  State* m_pState;
+
+  DeclareNonCopyable(Compressor);
+};
+
+// the other side of Compressor, with the same codec and dictionary
+class Decompressor
+{
+public:
+  Decompressor();
+  ~Decompressor();
+
+  COMPRESSION_CODEC GetCodec() const { return m_codec; }
+
+  bool Initialize(COMPRESSION_CODEC codec);
+  bool SetDictionary(const void* pDictionary, uint32 dictionarySize);
+
+  bool Decompress(void* pDestinationBuffer, uint32 cbDestinationBuffer, uint32* pDecompressedSize,
+                  const void* pSourceBuffer, uint32 cbSourceBuffer);
+
+private:
+  struct State;
+  void Shutdown();
+
+  COMPRESSION_CODEC m_codec;
+  PODArray<byte> m_dictionary;
+  State* m_pState;
+
+  DeclareNonCopyable(Decompressor);
+};
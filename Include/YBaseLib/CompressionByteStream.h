@@ -0,0 +1,84 @@
+#pragma once
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Compression.h"
+
+// Wraps another stream, compressing what's written to it or decompressing what's read from it a buffer at a time, so
+// streams of any size go through in bounded memory. The wrapped stream can be anything written or read in order, a
+// file, a socket's stream or another wrapper. Deflate data is in the zlib format, as ZLibHelpers writes it, LZ4 data
+// is an LZ4 frame and Zstandard data a Zstandard frame, so other tools read them. A stream either compresses or
+// decompresses, and only moves forward: seeking ahead while decompressing reads and drops the data in between.
+//   CompressionByteStream* pStream = CompressionByteStream::CreateCompressor(pFileStream, COMPRESSION_CODEC_ZSTD);
+//   pStream->Write2(pData, dataSize);
+//   pStream->Commit();
+//   pStream->Release();
+class CompressionByteStream : public ByteStream
+{
+public:
+  static const uint32 DefaultBufferSize = 65536;
+
+  // Flush writes out everything compressed so far, which costs a little ratio, for streams read as they're written.
+  // Commit ends the compressed data and commits the wrapped stream, releasing the stream does the same unless it
+  // was discarded. Returns nullptr if the codec isn't built in.
+  static CompressionByteStream* CreateCompressor(ByteStream* pStream, COMPRESSION_CODEC codec, int32 level = 0,
+                                                 uint32 bufferSize = DefaultBufferSize);
+
+  // Reads stop at the end of the compressed data, and the wrapped stream ending before then is an error. The
+  // wrapped stream is read a buffer at a time, so it may be left past the end of the compressed data.
+  static CompressionByteStream* CreateDecompressor(ByteStream* pStream, COMPRESSION_CODEC codec,
+                                                   uint32 bufferSize = DefaultBufferSize);
+
+  ~CompressionByteStream();
+
+  ByteStream* GetInnerStream() const { return m_pStream; }
+  COMPRESSION_CODEC GetCodec() const { return m_codec; }
+  bool IsCompressing() const { return m_compressing; }
+
+  // whether decompressing has reached the end of the compressed data
+  bool IsEndOfStream() const { return m_endOfStream; }
+
+  // ends the compressed data without committing the wrapped stream, after which nothing more can be written
+  bool Finish();
+
+  virtual bool ReadByte(byte* pDestByte) override final;
+  virtual uint32 Read(void* pDestination, uint32 ByteCount) override final;
+  virtual bool Read2(void* pDestination, uint32 ByteCount, uint32* pNumberOfBytesRead = nullptr) override final;
+  virtual bool WriteByte(byte SourceByte) override final;
+  virtual uint32 Write(const void* pSource, uint32 ByteCount) override final;
+  virtual bool Write2(const void* pSource, uint32 ByteCount, uint32* pNumberOfBytesWritten = nullptr) override final;
+  virtual bool SeekAbsolute(uint64 Offset) override final;
+  virtual bool SeekRelative(int64 Offset) override final;
+  virtual bool SeekToEnd() override final;
+  virtual uint64 GetPosition() const override final { return m_position; }
+
+  // the uncompressed size isn't known ahead, so this is the amount written or read so far
+  virtual uint64 GetSize() const override final { return m_position; }
+
+  virtual bool Flush() override final;
+  virtual bool Discard() override final;
+  virtual bool Commit() override final;
+
+  class Codec;
+
+private:
+  CompressionByteStream(ByteStream* pStream, COMPRESSION_CODEC codec, Codec* pCodec, bool compressing,
+                        uint32 bufferSize);
+
+  // compresses what's waiting in the buffer, then the source, with a FLUSH_ mode from the source file
+  bool CompressPending(const byte* pSource, uint32 sourceSize, uint32 flushMode);
+
+  ByteStream* m_pStream;
+  COMPRESSION_CODEC m_codec;
+  Codec* m_pCodec;
+  bool m_compressing;
+  bool m_finished;
+  bool m_endOfStream;
+  bool m_innerEndOfStream;
+  uint64 m_position;
+
+  // writes waiting to be compressed, or compressed data read and not yet decompressed
+  byte* m_pBuffer;
+  uint32 m_bufferSize;
+  uint32 m_bufferStart;
+  uint32 m_bufferEnd;
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include "YBaseLib/Cache.h"
+#include "YBaseLib/Mutex.h"
+#include <new>
+
+// Cache split into independently locked shards, each with an even share of the budget, for caches shared between
+// many threads. Keys map to shards as in ConcurrentHashTable. Every lookup marks its entry used, so each takes its
+// shard's lock exclusively. Values are copied out, and the eviction callback is called with the shard locked.
+template<typename KeyType, typename ValueType, class HashTraitClass = HashTrait<KeyType>>
+class ConcurrentCache
+{
+public:
+  typedef Cache<KeyType, ValueType, HashTraitClass> ShardCache;
+  typedef typename ShardCache::EvictionCallbackType EvictionCallbackType;
+
+  // shardCount is rounded up to a power of two
+  ConcurrentCache(size_t byteBudget, uint32 shardCount = 16, uint32 protectedPercent = 80)
+  {
+    m_shardBits = 0;
+    while ((1u << m_shardBits) < shardCount && m_shardBits < 16)
+      m_shardBits++;
+
+    m_pShards = static_cast<Shard*>(operator new(sizeof(Shard) * GetShardCount()));
+    for (uint32 i = 0; i < GetShardCount(); i++)
+      new (&m_pShards[i]) Shard(byteBudget >> m_shardBits, protectedPercent);
+  }
+
+  ~ConcurrentCache()
+  {
+    for (uint32 i = 0; i < GetShardCount(); i++)
+      m_pShards[i].~Shard();
+    operator delete(m_pShards);
+  }
+
+  uint32 GetShardCount() const { return (1u << m_shardBits); }
+
+  void SetEvictionCallback(EvictionCallbackType callback, void* pUserParam)
+  {
+    for (uint32 i = 0; i < GetShardCount(); i++)
+    {
+      m_pShards[i].Lock.Lock();
+      m_pShards[i].Table.SetEvictionCallback(callback, pUserParam);
+      m_pShards[i].Lock.Unlock();
+    }
+  }
+
+  void SetByteBudget(size_t byteBudget)
+  {
+    for (uint32 i = 0; i < GetShardCount(); i++)
+    {
+      m_pShards[i].Lock.Lock();
+      m_pShards[i].Table.SetByteBudget(byteBudget >> m_shardBits);
+      m_pShards[i].Lock.Unlock();
+    }
+  }
+
+  bool Find(const KeyType& key, ValueType* pValue)
+  {
+    Shard& shard = GetShard(key);
+    shard.Lock.Lock();
+    bool result = shard.Table.Find(key, pValue);
+    shard.Lock.Unlock();
+    return result;
+  }
+
+  bool Insert(const KeyType& key, const ValueType& value, size_t byteSize)
+  {
+    Shard& shard = GetShard(key);
+    shard.Lock.Lock();
+    bool result = shard.Table.Insert(key, value, byteSize);
+    shard.Lock.Unlock();
+    return result;
+  }
+
+  bool Remove(const KeyType& key)
+  {
+    Shard& shard = GetShard(key);
+    shard.Lock.Lock();
+    bool result = shard.Table.Remove(key);
+    shard.Lock.Unlock();
+    return result;
+  }
+
+  void Clear()
+  {
+    for (uint32 i = 0; i < GetShardCount(); i++)
+    {
+      m_pShards[i].Lock.Lock();
+      m_pShards[i].Table.Clear();
+      m_pShards[i].Lock.Unlock();
+    }
+  }
+
+  // sum of every shard, may be stale by the time it returns if other threads are using the cache
+  CacheStatistics GetStatistics() const
+  {
+    CacheStatistics total = {};
+    for (uint32 i = 0; i < GetShardCount(); i++)
+    {
+      m_pShards[i].Lock.Lock();
+      CacheStatistics statistics = m_pShards[i].Table.GetStatistics();
+      m_pShards[i].Lock.Unlock();
+
+      total.Hits += statistics.Hits;
+      total.Misses += statistics.Misses;
+      total.Insertions += statistics.Insertions;
+      total.Evictions += statistics.Evictions;
+      total.ByteCount += statistics.ByteCount;
+      total.EntryCount += statistics.EntryCount;
+    }
+
+    return total;
+  }
+
+  void ResetStatistics()
+  {
+    for (uint32 i = 0; i < GetShardCount(); i++)
+    {
+      m_pShards[i].Lock.Lock();
+      m_pShards[i].Table.ResetStatistics();
+      m_pShards[i].Lock.Unlock();
+    }
+  }
+
+private:
+  // padded so neighbouring shards' locks don't share a cache line
+  struct Shard
+  {
+    Shard(size_t byteBudget, uint32 protectedPercent) : Table(byteBudget, protectedPercent) {}
+
+    Mutex Lock;
+    ShardCache Table;
+    byte Padding[Y_CACHE_LINE_SIZE];
+  };
+
+  Shard& GetShard(const KeyType& key) const
+  {
+    if (m_shardBits == 0)
+      return m_pShards[0];
+
+    uint32 hash = Y_HashInteger(HashTraitClass::GetHash(key));
+    return m_pShards[hash >> (32 - m_shardBits)];
+  }
+
+  Shard* m_pShards;
+  uint32 m_shardBits;
+
+  DeclareNonCopyable(ConcurrentCache);
+};
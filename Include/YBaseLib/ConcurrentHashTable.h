@@ -0,0 +1,205 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/HashTable.h"
+#include "YBaseLib/HashTrait.h"
+#include "YBaseLib/ReadWriteLock.h"
+
+// HashTable split into independently locked shards, for tables shared between many threads.
+// A key always maps to the same shard, picked from the top bits of its mixed hash, so operations on keys in
+// different shards never contend. Lookups take their shard's lock shared, changes take it exclusive.
+// Values are copied out, or reached through a callback while the shard is locked, member pointers are never
+// handed out since another thread could remove them. Callbacks must not call back into the same table.
+template<typename KeyType, typename ValueType, class HashTraitClass = HashTrait<KeyType>>
+class ConcurrentHashTable
+{
+public:
+  typedef HashTable<KeyType, ValueType, HashTraitClass> ShardTable;
+
+  // shardCount is rounded up to a power of two, more shards than threads keeps contention low
+  ConcurrentHashTable(uint32 shardCount = 32)
+  {
+    m_shardBits = 0;
+    while ((1u << m_shardBits) < shardCount && m_shardBits < 16)
+      m_shardBits++;
+
+    m_pShards = new Shard[1u << m_shardBits];
+  }
+
+  ~ConcurrentHashTable() { delete[] m_pShards; }
+
+  uint32 GetShardCount() const { return (1u << m_shardBits); }
+
+  // sum of every shard, may be stale by the time it returns if other threads are changing the table
+  uint32 GetMemberCount() const
+  {
+    uint32 count = 0;
+    for (uint32 i = 0; i < GetShardCount(); i++)
+    {
+      m_pShards[i].Lock.LockShared();
+      count += m_pShards[i].Table.GetMemberCount();
+      m_pShards[i].Lock.UnlockShared();
+    }
+
+    return count;
+  }
+
+  // sizes every shard for an even share of count members
+  void Reserve(uint32 count)
+  {
+    uint32 shardCount = GetShardCount();
+    for (uint32 i = 0; i < shardCount; i++)
+    {
+      m_pShards[i].Lock.LockExclusive();
+      m_pShards[i].Table.Reserve((count + shardCount - 1) / shardCount);
+      m_pShards[i].Lock.UnlockExclusive();
+    }
+  }
+
+  // copies the value out if the key exists, pValue may be NULL to just test for it
+  bool Find(const KeyType& Key, ValueType* pValue) const
+  {
+    Shard& shard = GetShard(Key);
+    shard.Lock.LockShared();
+
+    const typename ShardTable::Member* pMember = shard.Table.Find(Key);
+    if (pMember != NULL && pValue != NULL)
+      *pValue = pMember->Value;
+
+    shard.Lock.UnlockShared();
+    return (pMember != NULL);
+  }
+
+  // calls visitor(const ValueType&) with the shard locked shared, returns false if the key doesn't exist
+  template<typename VisitorType>
+  bool Visit(const KeyType& Key, const VisitorType& visitor) const
+  {
+    Shard& shard = GetShard(Key);
+    shard.Lock.LockShared();
+
+    const typename ShardTable::Member* pMember = shard.Table.Find(Key);
+    if (pMember != NULL)
+      visitor(pMember->Value);
+
+    shard.Lock.UnlockShared();
+    return (pMember != NULL);
+  }
+
+  // adds the key if it doesn't already exist, returns false and leaves the existing value alone if it does
+  bool Insert(const KeyType& Key, const ValueType& Value)
+  {
+    Shard& shard = GetShard(Key);
+    shard.Lock.LockExclusive();
+
+    bool isNew = (shard.Table.Find(Key) == NULL);
+    if (isNew)
+      shard.Table.Insert(Key, Value);
+
+    shard.Lock.UnlockExclusive();
+    return isNew;
+  }
+
+  // adds the key or overwrites its value, returns true if it was added
+  bool InsertOrUpdate(const KeyType& Key, const ValueType& Value)
+  {
+    Shard& shard = GetShard(Key);
+    shard.Lock.LockExclusive();
+
+    bool isNew;
+    shard.Table.Set(Key, Value, &isNew);
+
+    shard.Lock.UnlockExclusive();
+    return isNew;
+  }
+
+  // adds the key with initialValue, or calls updater(ValueType&) on the existing value in place, with the
+  // shard locked exclusive. returns true if it was added.
+  template<typename UpdaterType>
+  bool InsertOrUpdate(const KeyType& Key, const ValueType& initialValue, const UpdaterType& updater)
+  {
+    Shard& shard = GetShard(Key);
+    shard.Lock.LockExclusive();
+
+    typename ShardTable::Member* pMember = shard.Table.Find(Key);
+    bool isNew = (pMember == NULL);
+    if (isNew)
+      shard.Table.Insert(Key, initialValue);
+    else
+      updater(pMember->Value);
+
+    shard.Lock.UnlockExclusive();
+    return isNew;
+  }
+
+  // calls updater(ValueType&) on the existing value in place, returns false if the key doesn't exist
+  template<typename UpdaterType>
+  bool Update(const KeyType& Key, const UpdaterType& updater)
+  {
+    Shard& shard = GetShard(Key);
+    shard.Lock.LockExclusive();
+
+    typename ShardTable::Member* pMember = shard.Table.Find(Key);
+    if (pMember != NULL)
+      updater(pMember->Value);
+
+    shard.Lock.UnlockExclusive();
+    return (pMember != NULL);
+  }
+
+  bool Remove(const KeyType& Key)
+  {
+    Shard& shard = GetShard(Key);
+    shard.Lock.LockExclusive();
+    bool result = shard.Table.Remove(Key);
+    shard.Lock.UnlockExclusive();
+    return result;
+  }
+
+  void Clear()
+  {
+    for (uint32 i = 0; i < GetShardCount(); i++)
+    {
+      m_pShards[i].Lock.LockExclusive();
+      m_pShards[i].Table.Clear();
+      m_pShards[i].Lock.UnlockExclusive();
+    }
+  }
+
+  // calls visitor(const KeyType&, const ValueType&) for every member, one shard at a time. members added or
+  // removed in other shards while this runs may or may not be seen.
+  template<typename VisitorType>
+  void ForEach(const VisitorType& visitor) const
+  {
+    for (uint32 i = 0; i < GetShardCount(); i++)
+    {
+      m_pShards[i].Lock.LockShared();
+      for (typename ShardTable::ConstIterator itr = m_pShards[i].Table.Begin(); !itr.AtEnd(); itr.Forward())
+        visitor(itr->Key, itr->Value);
+      m_pShards[i].Lock.UnlockShared();
+    }
+  }
+
+private:
+  // padded so neighbouring shards' locks don't share a cache line
+  struct Shard
+  {
+    ReadWriteLock Lock;
+    ShardTable Table;
+    byte Padding[Y_CACHE_LINE_SIZE];
+  };
+
+  // the shard table picks buckets from the low bits of the hash, so use the top bits here
+  Shard& GetShard(const KeyType& Key) const
+  {
+    if (m_shardBits == 0)
+      return m_pShards[0];
+
+    uint32 hash = Y_HashInteger(HashTraitClass::GetHash(Key));
+    return m_pShards[hash >> (32 - m_shardBits)];
+  }
+
+  Shard* m_pShards;
+  uint32 m_shardBits;
+
+  DeclareNonCopyable(ConcurrentHashTable);
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/HashTrait.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/SHA256Digest.h"
+
+class ByteStream;
+
+// a chunk's SHA-256, which is what chunks are known by
+struct CHUNK_DIGEST
+{
+  byte Bytes[SHA256Digest::DIGEST_SIZE];
+
+  bool operator==(const CHUNK_DIGEST& rhs) const;
+  bool operator!=(const CHUNK_DIGEST& rhs) const { return !operator==(rhs); }
+};
+
+// the digest is already uniform, so its first bytes are as good a hash as any
+template<>
+struct HashTrait<CHUNK_DIGEST>
+{
+  static HashType GetHash(const CHUNK_DIGEST& Value)
+  {
+    return (HashType)Value.Bytes[0] | ((HashType)Value.Bytes[1] << 8) | ((HashType)Value.Bytes[2] << 16) |
+           ((HashType)Value.Bytes[3] << 24);
+  }
+};
+
+struct CONTENT_CHUNK
+{
+  uint64 Offset;
+  uint32 Size;
+  CHUNK_DIGEST Digest;
+};
+
+// Splits data into chunks at boundaries chosen by its content, with FastCDC (Xia et al, 2016). A gear hash rolls
+// over the data and a chunk ends where its top bits are zero, so inserting or removing bytes only moves the
+// boundaries near the change, and the chunks either side are found again unchanged. A stricter test before the
+// average size and a looser one after it keep sizes close to the average. Boundaries depend only on the data and
+// the sizes, so chunks from different runs and machines can be compared.
+//   ContentChunker chunker;
+//   PODArray<CONTENT_CHUNK> chunks;
+//   chunker.ChunkStream(pStream, pStream->GetSize(), &chunks);
+class ContentChunker
+{
+public:
+  // The average size is rounded down to a power of two, and the others are clamped around it. Chunks are never
+  // smaller than the minimum, except the last, or larger than the maximum.
+  ContentChunker(uint32 minimumSize = 2048, uint32 averageSize = 8192, uint32 maximumSize = 65536);
+
+  uint32 GetMinimumSize() const { return m_minimumSize; }
+  uint32 GetAverageSize() const { return m_averageSize; }
+  uint32 GetMaximumSize() const { return m_maximumSize; }
+
+  // Length of the chunk at the start of the data. Unless the data runs to its end, 0 means more is needed to find
+  // the boundary, which is never the case with at least the maximum size available.
+  uint32 FindBoundary(const void* pData, size_t length, bool endOfData) const;
+
+  // split the data into chunks with their digests, appending to pChunks with offsets from the start of the data
+  void ChunkBuffer(const void* pData, size_t length, PODArray<CONTENT_CHUNK>* pChunks) const;
+
+  // the same for count bytes from the stream's position
+  bool ChunkStream(ByteStream* pStream, uint64 count, PODArray<CONTENT_CHUNK>* pChunks) const;
+
+private:
+  uint32 m_minimumSize;
+  uint32 m_averageSize;
+  uint32 m_maximumSize;
+
+  // tested before and after the average size
+  uint64 m_smallMask;
+  uint64 m_largeMask;
+};
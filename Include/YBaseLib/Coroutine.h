@@ -0,0 +1,289 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+
+// The library builds as C++14, so coroutines are only there for translation units compiled as C++20 or later.
+#if defined(__cpp_impl_coroutine)
+#if __cpp_impl_coroutine >= 201902L
+#define Y_HAVE_COROUTINES 1
+#endif
+#endif
+#ifndef Y_HAVE_COROUTINES
+#define Y_HAVE_COROUTINES 0
+#endif
+
+#if Y_HAVE_COROUTINES
+
+#include "YBaseLib/AsyncFileStream.h"
+#include "YBaseLib/TaskQueue.h"
+#include "YBaseLib/ThreadCachedHeap.h"
+#include <coroutine>
+#include <optional>
+#include <utility>
+
+template<class T>
+class Coroutine;
+
+// Everything a coroutine's promise shares whatever it returns. Frames come from ThreadCachedHeap, so starting a
+// coroutine on a thread that's been running them already takes a block from that thread's cache instead of the heap.
+class CoroutinePromiseBase
+{
+public:
+  static void* operator new(size_t size) { return ThreadCachedHeap::Allocate(size); }
+  static void operator delete(void* pMemory) { ThreadCachedHeap::Free(pMemory); }
+
+  // nothing runs until the coroutine is started or awaited
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+
+  // Carries straight on with whoever awaited the coroutine, without growing the stack. Detached coroutines free their
+  // own frame, anything else is kept for its Coroutine to read the result from and destroy.
+  struct FinalAwaiter
+  {
+    bool await_ready() const noexcept { return false; }
+
+    template<class Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) const noexcept
+    {
+      CoroutinePromiseBase& promise = handle.promise();
+      if (promise.m_continuation)
+        return promise.m_continuation;
+
+      if (promise.m_detached)
+        handle.destroy();
+
+      return std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+
+  // the library doesn't use exceptions, so one escaping a coroutine is fatal, as it would be anywhere else
+  void unhandled_exception() { Panic("Unhandled exception in coroutine"); }
+
+protected:
+  template<class T>
+  friend class Coroutine;
+
+  std::coroutine_handle<> m_continuation;
+  bool m_detached = false;
+};
+
+template<class T>
+class CoroutineResultStorage : public CoroutinePromiseBase
+{
+public:
+  template<class U>
+  void return_value(U&& value)
+  {
+    m_result.emplace(std::forward<U>(value));
+  }
+
+  T& GetResult() { return *m_result; }
+
+private:
+  std::optional<T> m_result;
+};
+
+template<>
+class CoroutineResultStorage<void> : public CoroutinePromiseBase
+{
+public:
+  void return_void() {}
+  void GetResult() {}
+};
+
+// A coroutine returning T, which owns the coroutine's frame until it's destroyed or detached. Coroutines start
+// suspended: awaiting one from another coroutine runs it and carries on with the result once it's done, while Start
+// runs it from ordinary code up to its first suspension, with whatever resumes it after that taking it the rest of
+// the way, e.g. a task queue, a file completion or a socket event. Only a coroutine that hasn't been started can be
+// awaited, as awaiting resumes it.
+//   Coroutine<uint32> LoadHeader(AsyncFileStream* pStream, Header* pHeader)
+//   {
+//     uint32 bytesRead;
+//     if (!co_await AsyncFileRead(pStream, pHeader, 0, sizeof(Header), &bytesRead))
+//       co_return 0;
+//     co_await SwitchToTaskQueue(pWorkerQueue);
+//     co_return ParseHeader(pHeader, bytesRead);
+//   }
+template<class T = void>
+class Coroutine
+{
+public:
+  struct promise_type : public CoroutineResultStorage<T>
+  {
+    Coroutine get_return_object() { return Coroutine(std::coroutine_handle<promise_type>::from_promise(*this)); }
+  };
+
+  Coroutine() = default;
+  Coroutine(Coroutine&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+  ~Coroutine()
+  {
+    if (m_handle)
+      m_handle.destroy();
+  }
+
+  Coroutine& operator=(Coroutine&& other) noexcept
+  {
+    if (this != &other)
+    {
+      if (m_handle)
+        m_handle.destroy();
+      m_handle = std::exchange(other.m_handle, nullptr);
+    }
+
+    return *this;
+  }
+
+  Coroutine(const Coroutine&) = delete;
+  Coroutine& operator=(const Coroutine&) = delete;
+
+  bool IsValid() const { return static_cast<bool>(m_handle); }
+  bool IsDone() const { return m_handle.done(); }
+
+  // Runs the coroutine until it first suspends. It must be done before this is destroyed, as destroying a suspended
+  // coroutine would leave whatever is going to resume it pointing at freed memory.
+  void Start()
+  {
+    DebugAssert(m_handle && !m_handle.done());
+    m_handle.resume();
+  }
+
+  // starts the coroutine and gives up ownership, its frame is freed when it finishes, wherever that is
+  void StartDetached()
+  {
+    DebugAssert(m_handle && !m_handle.done());
+    std::coroutine_handle<promise_type> handle = std::exchange(m_handle, nullptr);
+    handle.promise().m_detached = true;
+    handle.resume();
+  }
+
+  // what the coroutine returned, once it's done
+  decltype(auto) GetResult()
+  {
+    DebugAssert(IsDone());
+    return m_handle.promise().GetResult();
+  }
+
+  // runs the coroutine and resumes the awaiting one with its result, as an ordinary call would
+  struct Awaiter
+  {
+    std::coroutine_handle<promise_type> m_handle;
+
+    bool await_ready() const noexcept { return m_handle.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+    {
+      m_handle.promise().m_continuation = continuation;
+      return m_handle;
+    }
+    decltype(auto) await_resume() { return m_handle.promise().GetResult(); }
+  };
+
+  Awaiter operator co_await() const&
+  {
+    DebugAssert(m_handle);
+    return Awaiter{m_handle};
+  }
+
+private:
+  explicit Coroutine(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+  std::coroutine_handle<promise_type> m_handle;
+};
+
+// Resumes the coroutine as a task on the queue, i.e. on one of its worker threads, or on whoever executes the queue
+// when it has none. Queuing doesn't allocate. Put a TaskQueue in front of a ThreadPool to move onto the pool.
+class SwitchToTaskQueue
+{
+public:
+  SwitchToTaskQueue(TaskQueue* pQueue) : m_pQueue(pQueue) {}
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle)
+  {
+    m_pQueue->QueueLambdaTask([handle]() { handle.resume(); });
+  }
+  void await_resume() const noexcept {}
+
+private:
+  TaskQueue* m_pQueue;
+};
+
+// One read or write through an AsyncFileStream, with the request kept in the coroutine's frame. The coroutine resumes
+// where the stream's completions run, the queue's completion thread or its completion task queue, and gets whether
+// the transfer succeeded, and through pBytesTransferred how much was moved. Failing to submit, because the queue has
+// shut down, doesn't suspend at all and fails the transfer.
+class AsyncFileTransfer
+{
+public:
+  bool await_ready() const noexcept { return false; }
+  bool await_suspend(std::coroutine_handle<> handle)
+  {
+    m_handle = handle;
+    m_request.Callback = OnComplete;
+    m_request.pUserData = this;
+
+    // the request can complete on another thread before Submit returns, taking this awaiter with its frame
+    AsyncFileStream* pStream = m_pStream;
+    if (pStream->Submit(&m_request))
+      return true;
+
+    m_request.Succeeded = false;
+    m_request.BytesTransferred = 0;
+    return false;
+  }
+  bool await_resume() const noexcept
+  {
+    if (m_pBytesTransferred != nullptr)
+      *m_pBytesTransferred = m_request.BytesTransferred;
+
+    return m_request.Succeeded;
+  }
+
+protected:
+  AsyncFileTransfer(AsyncFileStream* pStream, AsyncFileRequest::TYPE type, void* pBuffer, uint64 offset, uint32 size,
+                    uint32* pBytesTransferred)
+    : m_pStream(pStream), m_pBytesTransferred(pBytesTransferred)
+  {
+    m_request.Type = type;
+    m_request.pBuffer = pBuffer;
+    m_request.Offset = offset;
+    m_request.Size = size;
+  }
+
+private:
+  // the queue is done with the request once the callback is running, so the frame can go on from here
+  static void OnComplete(AsyncFileRequest* pRequest)
+  {
+    static_cast<AsyncFileTransfer*>(pRequest->pUserData)->m_handle.resume();
+  }
+
+  AsyncFileRequest m_request;
+  AsyncFileStream* m_pStream;
+  uint32* m_pBytesTransferred;
+  std::coroutine_handle<> m_handle;
+};
+
+class AsyncFileRead : public AsyncFileTransfer
+{
+public:
+  AsyncFileRead(AsyncFileStream* pStream, void* pBuffer, uint64 offset, uint32 size,
+                uint32* pBytesRead = nullptr)
+    : AsyncFileTransfer(pStream, AsyncFileRequest::TYPE_READ, pBuffer, offset, size, pBytesRead)
+  {
+  }
+};
+
+class AsyncFileWrite : public AsyncFileTransfer
+{
+public:
+  AsyncFileWrite(AsyncFileStream* pStream, const void* pBuffer, uint64 offset, uint32 size,
+                 uint32* pBytesWritten = nullptr)
+    : AsyncFileTransfer(pStream, AsyncFileRequest::TYPE_WRITE, const_cast<void*>(pBuffer), offset, size,
+                        pBytesWritten)
+  {
+  }
+};
+
+#endif // Y_HAVE_COROUTINES
@@ -0,0 +1,58 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/NonCopyable.h"
+
+// Cuckoo filter over hashes (Fan et al, 2014), a front filter like BloomFilter that also supports removal. Each hash
+// keeps a 16-bit fingerprint in one of two buckets of four, and each bucket is one 64-bit word, so a test reads at
+// most two words and compares the four fingerprints in each at once. About 0.01% of hashes that were never added
+// pass, at 2 bytes a key, filled up to 95%.
+//
+// Add fails once the filter is too full to place a fingerprint, after which it should be reset larger and refilled.
+// Remove must only be given hashes that were added, or it may remove another key's fingerprint, and a hash added
+// twice has to be removed twice. Hashes are remixed as for BloomFilter. Not thread-safe for changes, any number of
+// threads may test.
+class CuckooFilter
+{
+public:
+  CuckooFilter();
+  ~CuckooFilter();
+
+  // Empties the filter and sizes it for capacity hashes. A filter with no room, as constructed, passes every hash.
+  void Reset(uint32 capacity);
+
+  // empties the filter, keeping its size
+  void Clear();
+
+  // false if there was no room, in which case the filter is unchanged
+  bool Add(uint64 hash);
+
+  // removes one copy of a hash that was added, returning false if it isn't there
+  bool Remove(uint64 hash);
+
+  // false if the hash was certainly never added, or has been removed
+  bool MayContain(uint64 hash) const;
+
+  uint32 GetCount() const { return m_count; }
+  uint32 GetCapacity() const { return m_bucketCount * SlotsPerBucket; }
+  size_t GetMemoryUsage() const { return m_bucketCount * sizeof(uint64); }
+
+private:
+  static const uint32 SlotsPerBucket = 4;
+
+  // the fingerprint and both buckets it may be in
+  void GetPosition(uint64 hash, uint16* pFingerprint, uint32* pFirstBucket, uint32* pSecondBucket) const;
+  uint32 GetAlternateBucket(uint32 bucket, uint16 fingerprint) const;
+
+  bool AddToBucket(uint32 bucket, uint16 fingerprint);
+  bool RemoveFromBucket(uint32 bucket, uint16 fingerprint);
+
+  // fingerprints packed four to a word, 0 is an empty slot
+  uint64* m_pBuckets;
+  uint32 m_bucketCount;
+  uint32 m_count;
+
+  // picks the slot to kick out when both buckets are full
+  uint32 m_randomState;
+
+  DeclareNonCopyable(CuckooFilter);
+};
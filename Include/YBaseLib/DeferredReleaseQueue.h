@@ -0,0 +1,41 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/RefPtr.h"
+#include "YBaseLib/SpinLock.h"
+
+// Collects releases from threads that shouldn't pay for the destructor and free, and performs them in a batch
+// when Flush is called, usually from a background or end-of-frame thread. Releasing through the queue keeps the
+// object alive until the next flush even when it was the last reference.
+class DeferredReleaseQueue
+{
+  DeclareNonCopyable(DeferredReleaseQueue);
+
+public:
+  DeferredReleaseQueue() = default;
+  ~DeferredReleaseQueue();
+
+  // Queues one reference for release. Returns the number of releases pending.
+  uint32 Release(const ReferenceCounted* pObject);
+
+  // Hands the pointer's reference to the queue and leaves it null.
+  template<class T>
+  uint32 Release(RefPtr<T>& ptr)
+  {
+    return Release(static_cast<const ReferenceCounted*>(ptr.Detach()));
+  }
+
+  // Releases everything queued so far, returning how many references were dropped.
+  uint32 Flush();
+
+  uint32 GetPendingCount() const;
+
+private:
+  mutable SpinLock m_pendingLock;
+  PODArray<const ReferenceCounted*> m_pending;
+
+  // the flush swaps its buffer with the pending one, so both keep their capacity
+  Mutex m_flushLock;
+  PODArray<const ReferenceCounted*> m_flushing;
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/ParallelFor.h"
+
+// Helpers for any of the digests (MD5Digest, SHA1Digest, SHA256Digest, XXHash64Digest), which share the shape:
+//   static const uint32 DIGEST_SIZE;
+//   void Update(const void* pData, size_t cbData);
+//   void Final(byte Digest[DIGEST_SIZE]);
+//   void Reset();
+namespace Digest {
+
+// hashes count bytes from the stream's position, in place when the stream has read views
+template<class T>
+bool HashStreamPartial(T* pDigest, ByteStream* pStream, uint64 count)
+{
+  if (pStream->GetViewFlags() & BYTESTREAM_VIEW_READ)
+  {
+    while (count > 0)
+    {
+      const void* pView;
+      uint32 viewSize = pStream->AcquireReadView((uint32)Min(count, (uint64)0xFFFFFFFF), &pView);
+      if (viewSize == 0)
+        return false;
+
+      pDigest->Update(pView, viewSize);
+      pStream->ReleaseReadView(viewSize);
+      count -= viewSize;
+    }
+
+    return true;
+  }
+
+  static const uint32 BUFFER_SIZE = 16384;
+  byte buffer[BUFFER_SIZE];
+  while (count > 0)
+  {
+    uint32 readCount = (count > BUFFER_SIZE) ? BUFFER_SIZE : (uint32)count;
+    if (!pStream->Read2(buffer, readCount))
+      return false;
+
+    pDigest->Update(buffer, readCount);
+    count -= readCount;
+  }
+
+  return true;
+}
+
+// hashes the rest of the stream, like CRC32::HashStream
+template<class T>
+bool HashStream(T* pDigest, ByteStream* pStream, bool seekToStart = false, bool restorePosition = false)
+{
+  uint64 currentPosition = pStream->GetPosition();
+  if (seekToStart)
+    pStream->SeekAbsolute(0);
+
+  bool result = HashStreamPartial(pDigest, pStream, pStream->GetSize() - pStream->GetPosition());
+  if (restorePosition)
+    pStream->SeekAbsolute(currentPosition);
+
+  return result;
+}
+
+// Digests many buffers at once, spread over the pool's threads, writing DIGEST_SIZE bytes for each buffer to
+// pDigests in order. Without a pool they're hashed one after another on the calling thread.
+template<class T>
+void HashBuffers(const void* const* ppData, const size_t* pSizes, uint32 count, byte* pDigests,
+                 ThreadPool* pThreadPool = nullptr, uint32 grainSize = 16)
+{
+  ParallelForRange(pThreadPool, 0, count, grainSize, [=](uint32 rangeBegin, uint32 rangeEnd) {
+    T digest;
+    for (uint32 i = rangeBegin; i < rangeEnd; i++)
+    {
+      if (i != rangeBegin)
+        digest.Reset();
+
+      digest.Update(ppData[i], pSizes[i]);
+      digest.Final(pDigests + (size_t)i * T::DIGEST_SIZE);
+    }
+  });
+}
+
+} // namespace Digest
@@ -0,0 +1,55 @@
+#pragma once
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Mutex.h"
+
+// A ReadWriteLock for data that's read far more often than it's written. Readers count themselves in one of several
+// counters, each on its own cache line and picked by thread, so readers on different cores never write the same
+// line. A writer takes a mutex, raises a flag that turns new readers away, then waits for every counter to drain,
+// so exclusive locking costs a sweep of the counters. Writers come first: readers that arrive while one's waiting
+// or holding the lock sleep on its mutex until it's done. Neither shared nor exclusive locking is recursive.
+class DistributedReadWriteLock
+{
+public:
+  static const uint32 MaxSlotCount = 64;
+
+  // with no slot count, one per hardware thread, rounded up to a power of two and at most MaxSlotCount
+  DistributedReadWriteLock(uint32 slotCount = 0);
+  ~DistributedReadWriteLock();
+
+  void LockShared();
+  void LockExclusive();
+
+  bool TryLockShared();
+  bool TryLockExclusive();
+
+  void UnlockShared();
+  void UnlockExclusive();
+
+  void UpgradeSharedLockToExclusive();
+
+  uint32 GetSlotCount() const { return m_slotMask + 1; }
+
+private:
+  struct Y_CACHE_ALIGNED_DECL ReaderSlot
+  {
+    Y_ATOMIC_DECL int32 Count;
+  };
+
+  // the calling thread's slot, the same one every time
+  ReaderSlot* GetReaderSlot() const;
+
+  // returns false if a writer is in, having taken the reader back out
+  bool TryEnterShared(ReaderSlot* pSlot);
+
+  ReaderSlot* m_pSlots;
+  uint32 m_slotMask;
+
+  // held by the writer from before it raises the flag until it's done
+  Mutex m_writerLock;
+
+  // set while a writer holds the lock or waits for readers to leave
+  Y_ATOMIC_DECL int32 m_writerActive;
+
+  DeclareNonCopyable(DistributedReadWriteLock);
+};
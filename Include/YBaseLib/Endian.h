@@ -25,4 +25,11 @@ uint32 Y_byteswap_uint32(uint32 uValue);
 uint64 Y_byteswap_uint64(uint64 uValue);
 void Y_byteswap_uint16(uint16* uValue);
 void Y_byteswap_uint32(uint32* uValue);
-void Y_byteswap_uint64(uint64* uValue);
\ No newline at end of file
+void Y_byteswap_uint64(uint64* uValue);
+
+// Reverses the bytes of each of count values of elementSize bytes, which has to be 1, 2, 4 or 8. Runs 32 bytes at a
+// time with AVX2 where the cpu has it, otherwise 16 with SSE2 or NEON, the values don't need to be aligned.
+void Y_byteswap_array(void* pValues, size_t count, uint32 elementSize);
+
+// The same, swapping as the values are copied, for when they're moving anyway. The arrays mustn't overlap.
+void Y_byteswap_array_copy(void* pDestination, const void* pSource, size_t count, uint32 elementSize);
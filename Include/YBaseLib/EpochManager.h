@@ -0,0 +1,140 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/NonCopyable.h"
+#include "YBaseLib/PODArray.h"
+
+// Epoch-based reclamation, for freeing memory that lock-free readers may still be looking at. Each thread using the
+// manager registers for a record, and brackets every read of shared nodes with Enter and Exit. A node that has been
+// unlinked is handed to Retire rather than freed, and its callback runs once every thread that was in a critical
+// region at the time has left it. The global epoch only advances when every thread in a region has seen the
+// current one, so anything retired two advances ago can no longer be reached.
+// Retired nodes are kept per thread and reclaimed in batches as they build up, so Retire is a push onto a local
+// list most of the time. A thread stalled inside a region holds up reclamation for everyone, keep regions short.
+class EpochManager
+{
+public:
+  typedef void (*ReclaimCallback)(void* pObject);
+
+  // a thread tries to reclaim each time the count it holds retired reaches a multiple of this
+  static const uint32 RetireBatchSize = 64;
+
+  struct ThreadRecord
+  {
+    struct RetiredObject
+    {
+      void* pObject;
+      ReclaimCallback Callback;
+    };
+
+    struct RetireList
+    {
+      uint32 Epoch;
+      PODArray<RetiredObject> Objects;
+    };
+
+    // the global epoch with the low bit set while in a region, zero outside
+    Y_ATOMIC_DECL uint32 LocalEpoch;
+    Y_ATOMIC_DECL uint32 InUse;
+    uint32 Nesting;
+    ThreadRecord* pNext;
+
+    // one list for each of the last three epochs, anything older has been reclaimed
+    RetireList RetireLists[3];
+    uint32 RetiredCount;
+  };
+
+  EpochManager();
+
+  // reclaims everything still retired, no thread may be in a region
+  ~EpochManager();
+
+  // gives the calling thread a record, reusing one an unregistered thread left behind if there is one
+  ThreadRecord* RegisterThread();
+
+  // the record must be outside a region. Nodes it retired that can't be reclaimed yet stay with it, for whichever
+  // thread registers next or the destructor.
+  void UnregisterThread(ThreadRecord* pRecord);
+
+  // Enter and Exit nest, only the outermost pair counts
+  void Enter(ThreadRecord* pRecord)
+  {
+    if (pRecord->Nesting++ != 0)
+      return;
+
+    // the record has to be visible before any shared node is read
+    Y_AtomicStore(pRecord->LocalEpoch, Y_AtomicLoad(m_globalEpoch, ATOMIC_MEMORY_ORDER_RELAXED) | 1);
+    MemoryBarrier();
+  }
+
+  void Exit(ThreadRecord* pRecord)
+  {
+    DebugAssert(pRecord->Nesting > 0);
+    if (--pRecord->Nesting == 0)
+      Y_AtomicStore(pRecord->LocalEpoch, uint32(0), ATOMIC_MEMORY_ORDER_RELEASE);
+  }
+
+  // pObject must already be unreachable for threads entering a region from now on
+  void Retire(ThreadRecord* pRecord, void* pObject, ReclaimCallback callback);
+
+  template<class T>
+  void Retire(ThreadRecord* pRecord, T* pObject)
+  {
+    Retire(pRecord, pObject, &DeleteObject<T>);
+  }
+
+  // RCU-style update: publishes pNewObject in place of whatever pointer held, and retires the old object. Readers
+  // load the pointer with LoadAcquire inside a region and can use what they got until they exit.
+  template<class T>
+  void SwapAndRetire(ThreadRecord* pRecord, AtomicPointer<T>& pointer, T* pNewObject)
+  {
+    T* pOldObject = pointer.Exchange(pNewObject);
+    if (pOldObject != nullptr)
+      Retire(pRecord, pOldObject);
+  }
+
+  // advances the epoch if every thread in a region has seen the current one
+  bool TryAdvance();
+
+  // tries to advance, then reclaims what this record retired that nobody can reach now
+  void Collect(ThreadRecord* pRecord);
+
+  // number of nodes retired through this record and not yet reclaimed
+  uint32 GetRetiredCount(const ThreadRecord* pRecord) const { return pRecord->RetiredCount; }
+
+private:
+  template<class T>
+  static void DeleteObject(void* pObject)
+  {
+    delete static_cast<T*>(pObject);
+  }
+
+  void ReclaimList(ThreadRecord* pRecord, ThreadRecord::RetireList& list);
+
+  // steps by two so a record's low bit is free to mark it in a region
+  Y_ATOMIC_DECL uint32 m_globalEpoch;
+
+  // records are only ever pushed, and freed by the destructor
+  Y_ATOMIC_PTR_DECL(ThreadRecord) m_pRecords;
+
+  DeclareNonCopyable(EpochManager);
+};
+
+// Enter and Exit for a scope
+class EpochGuard
+{
+  DeclareNonCopyable(EpochGuard);
+
+public:
+  EpochGuard(EpochManager& manager, EpochManager::ThreadRecord* pRecord) : m_manager(manager), m_pRecord(pRecord)
+  {
+    m_manager.Enter(m_pRecord);
+  }
+
+  ~EpochGuard() { m_manager.Exit(m_pRecord); }
+
+private:
+  EpochManager& m_manager;
+  EpochManager::ThreadRecord* m_pRecord;
+};
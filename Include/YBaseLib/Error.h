@@ -1,6 +1,8 @@
 #pragma once
 #include "YBaseLib/Common.h"
 #include "YBaseLib/String.h"
+#include <new>
+#include <type_traits>
 
 enum ERROR_TYPE
 {
@@ -13,10 +15,15 @@ enum ERROR_TYPE
   ERROR_TYPE_HRESULT = 5, // Error that is returned by Win32 COM methods, e.g. S_OK.
 };
 
-// this class provides enough storage room for all of these types
+// This class provides enough storage room for all of these types. Only the code is stored when an error is set, the
+// code string and description are made when first asked for, so setting an error nobody reads doesn't format or
+// allocate. The const accessors fill them in, so an error shouldn't be read from several threads at once.
 class Error
 {
 public:
+  // bytes of arguments SetErrorUserStaticFormatted can hold
+  static const uint32 ArgumentStorageSize = 32;
+
   Error();
   Error(const Error& c);
   ~Error();
@@ -44,6 +51,17 @@ public:
   void SetErrorCodeHResult(long err);
 #endif
 
+  // The same as SetErrorUser and SetErrorUserFormatted, but only the message or format pointer is kept and the
+  // arguments are copied in, so nothing is formatted unless the description is asked for. The message or format, and
+  // any string arguments, must outlive the error, so these are for literals. Arguments must be numbers or pointers.
+  void SetErrorUserStatic(int32 err, const char* staticMessage);
+  template<class... Args>
+  void SetErrorUserStaticFormatted(int32 err, const char* staticFormat, Args... args);
+
+  // An error that ignores whatever is set on it, for functions that need somewhere to put one the caller doesn't
+  // want. Setting it does nothing, so it can be shared by every thread. Reads as no error.
+  static Error* Discard();
+
   // constructors
   static Error CreateErrorNone();
   static Error CreateErrorErrno(int err);
@@ -58,10 +76,22 @@ public:
 #endif
 
   // get code, e.g. "0x00000002"
-  const String& GetErrorCodeString() const { return m_codeString; }
+  const String& GetErrorCodeString() const
+  {
+    if (m_pending != 0)
+      Render();
+
+    return m_codeString;
+  }
 
   // get description, e.g. "File not Found"
-  const String& GetErrorDescription() const { return m_message; }
+  const String& GetErrorDescription() const
+  {
+    if (m_pending != 0)
+      Render();
+
+    return m_message;
+  }
 
   // get code and description, e.g. "[0x00000002]: File not Found"
   SmallString GetErrorCodeAndDescription() const;
@@ -73,6 +103,56 @@ public:
   bool operator!=(const Error& e) const;
 
 private:
+  enum : uint8
+  {
+    PENDING_CODE_STRING = (1 << 0),
+    PENDING_MESSAGE = (1 << 1),
+  };
+
+  // The arguments of SetErrorUserStaticFormatted, each level holding one and passing it on to the next, the last of
+  // which formats them all.
+  template<class... Args>
+  struct ArgumentPack
+  {
+    template<class... Previous>
+    void Format(String& dest, const char* format, Previous... previous) const
+    {
+      dest.Format(format, previous...);
+    }
+  };
+  template<class First, class... Rest>
+  struct ArgumentPack<First, Rest...>
+  {
+    ArgumentPack(First first, Rest... rest) : Value(first), Next(rest...) {}
+
+    template<class... Previous>
+    void Format(String& dest, const char* format, Previous... previous) const
+    {
+      Next.Format(dest, format, previous..., Value);
+    }
+
+    First Value;
+    ArgumentPack<Rest...> Next;
+  };
+
+  template<class... Args>
+  static void FormatArguments(String& dest, const char* format, const void* pArguments)
+  {
+    static_cast<const ArgumentPack<Args...>*>(pArguments)->Format(dest, format);
+  }
+
+  typedef void (*FormatFunction)(String& dest, const char* format, const void* pArguments);
+
+  struct DiscardTag
+  {
+  };
+  Error(DiscardTag);
+
+  // clears everything and sets the type, false for the discard error
+  bool BeginSet(ERROR_TYPE type);
+
+  void Render() const;
+
   ERROR_TYPE m_type;
   union
   {
@@ -86,6 +166,36 @@ private:
     long hresult;
 #endif
   } m_error;
-  TinyString m_codeString;
-  SmallString m_message;
+
+  // user errors set with a static message, or a format and its arguments, to render on demand
+  const char* m_pStaticMessage;
+  FormatFunction m_pFormatFunction;
+  union
+  {
+    uint64 align;
+    byte data[ArgumentStorageSize];
+  } m_arguments;
+
+  bool m_discard;
+  mutable uint8 m_pending;
+  mutable TinyString m_codeString;
+  mutable SmallString m_message;
 };
+
+template<class... Args>
+void Error::SetErrorUserStaticFormatted(int32 err, const char* staticFormat, Args... args)
+{
+  typedef ArgumentPack<Args...> PackType;
+  static_assert(sizeof(PackType) <= ArgumentStorageSize, "error arguments fit the inline storage");
+  static_assert(alignof(PackType) <= alignof(uint64), "error arguments are aligned by the inline storage");
+  static_assert(std::is_trivially_copyable<PackType>::value, "error arguments are numbers or pointers");
+
+  if (!BeginSet(ERROR_TYPE_USER))
+    return;
+
+  m_error.user = err;
+  m_pStaticMessage = staticFormat;
+  m_pFormatFunction = &FormatArguments<Args...>;
+  new (m_arguments.data) PackType(args...);
+  m_pending = PENDING_CODE_STRING | PENDING_MESSAGE;
+}
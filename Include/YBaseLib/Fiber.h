@@ -0,0 +1,59 @@
+#pragma once
+#include "YBaseLib/Common.h"
+
+// Cooperatively scheduled execution context with its own stack.
+// A thread has to be converted to a fiber before it can switch to other fibers, and a fiber may be resumed on a
+// different thread to the one it was suspended on. The entry point must never return, it has to switch away
+// instead. Fibers are available on Windows and POSIX, on other platforms Create and ConvertFromThread fail.
+
+class Fiber
+{
+public:
+  typedef void (*EntryPoint)(void* pUserData);
+
+  // 256KiB default stack size
+  static const uint32 DefaultStackSize = 262144;
+
+public:
+  Fiber();
+  ~Fiber();
+
+  // whether the fiber has been created or converted
+  bool IsValid() const { return (m_pContext != nullptr); }
+
+  // creates a new fiber, it does not start running until it is switched to
+  bool Create(EntryPoint entryPoint, void* pUserData, uint32 stackSize = DefaultStackSize);
+
+  // makes the calling thread's current context this fiber, so it can switch to others
+  bool ConvertFromThread();
+
+  // turns the calling thread back into a regular thread, it must be running this fiber
+  void ConvertToThread();
+
+  // saves the running context into pFrom, and resumes pTo. pFrom must be the fiber currently running.
+  static void Switch(Fiber* pFrom, Fiber* pTo);
+
+  // whether fibers can be used on this platform
+  static bool IsSupported();
+
+private:
+  // platform-specific context, the fiber handle on Windows
+  void* m_pContext;
+
+  // stack for created fibers, unused on Windows
+  void* m_pStack;
+  uint32 m_stackSize;
+
+  EntryPoint m_entryPoint;
+  void* m_pUserData;
+  bool m_converted;
+
+  // internal method
+#if defined(Y_PLATFORM_WINDOWS)
+  static void __stdcall __FiberStart(void* pParameter);
+#else
+  static void __FiberStart(uint32 pointerHigh, uint32 pointerLow);
+#endif
+
+  DeclareNonCopyable(Fiber);
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/MemArray.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/Timer.h"
+#include "YBaseLib/Timestamp.h"
+
+class ByteStream;
+class ThreadPool;
+
+// A log sink writing to files, through a large buffer, so a message costs a copy rather than a write. Files are named
+// for when they were opened, "<baseName>-YYYYMMDD-HHMMSS.log" in the directory, so starting a new one never renames
+// the old. The file rotates once it reaches a size or an age, and only the newest files are kept. Rotated files can
+// be compressed on a thread pool, to "<name>.log.zz" in the zlib format, with the original deleted once that's done.
+// Warnings and errors flush the buffer as they're written, so they're on disk if the process dies.
+//   FileLogSink* pSink = new FileLogSink();
+//   pSink->SetRotation(64 * 1024 * 1024, 24 * 60 * 60, 10);
+//   pSink->SetCompression(pThreadPool);
+//   pSink->Open("logs", "server");
+class FileLogSink
+{
+public:
+  static const uint32 DefaultBufferSize = 1048576;
+
+  FileLogSink();
+
+  // closes the file, and waits for the files being compressed
+  ~FileLogSink();
+
+  // Filters as the console output does, messages past the level or from channels named in the filter are skipped.
+  void SetFilter(const char* channelFilter, LOGLEVEL levelFilter = LOGLEVEL_TRACE);
+
+  // Starts each line with the local time, in a strftime format down to the second and the digits of the second's
+  // fraction after it, read from the coarse clock. A null format leaves lines with the log's own time only.
+  void SetTimestampFormat(const char* format, uint32 fractionDigits = 3);
+
+  // Rotates once the file has maxFileSize bytes, or is maxFileAge seconds old, zero disables either. The newest
+  // keepCount files besides the open one are kept, compressed or not, and older ones deleted as the file rotates,
+  // zero keeps them all.
+  void SetRotation(uint64 maxFileSize, uint32 maxFileAge, uint32 keepCount);
+
+  // Compresses files on the pool as they're rotated out, at a deflate level, zero for the default. A null pool stops
+  // compressing files rotated from then on. Returns false if deflate isn't built in.
+  bool SetCompression(ThreadPool* pThreadPool, int32 level = 0);
+
+  // Creates the directory if there isn't one, opens the first file and registers with the log. Returns false if the
+  // file can't be created.
+  bool Open(const char* directory, const char* baseName, uint32 bufferSize = DefaultBufferSize);
+
+  // Unregisters from the log and closes the file. The last file isn't compressed, it's kept as it is for reading.
+  void Close();
+
+  bool IsOpen() const { return (m_pStream != nullptr); }
+
+  // the file being written, empty when closed
+  const String& GetFileName() const { return m_fileName; }
+
+  // Starts a new file now. Returns false if it can't be created, the current one is kept then.
+  bool Rotate();
+
+  // writes out what's buffered
+  bool Flush();
+
+private:
+  class CompressJob;
+
+  static void LogCallback(void* pUserParam, const char* channelName, const char* functionName, LOGLEVEL level,
+                          const char* message);
+  static void WriteText(const char* text, void* pUserParam);
+
+  // The rest are called with the lock held, and must not log, as they run inside the log's callbacks.
+  void WriteMessage(const char* channelName, const char* functionName, LOGLEVEL level, const char* message);
+
+  // opens a new file, leaving the current one untouched on failure
+  bool OpenNewFile();
+
+  // closes the current file, compressing it if rotating
+  void CloseFile(bool rotating);
+
+  // releases finished compressions, waiting for every one if wait is set
+  void ReapCompressJobs(bool wait);
+
+  // deletes the oldest files past the keep count
+  void DeleteOldFiles();
+
+  Mutex m_lock;
+  String m_directory;
+  String m_baseName;
+  uint32 m_bufferSize;
+
+  String m_channelFilter;
+  LOGLEVEL m_levelFilter;
+
+  TimestampFormatter m_timestampFormatter;
+  bool m_writeTimestamps;
+
+  uint64 m_maxFileSize;
+  uint32 m_maxFileAge;
+  uint32 m_keepCount;
+
+  ThreadPool* m_pCompressionThreadPool;
+  int32 m_compressionLevel;
+  MemArray<CompressJob*> m_compressJobs;
+
+  // the open file, and the size and time it's due to rotate from, which failing to rotate moves on to now
+  ByteStream* m_pStream;
+  String m_fileName;
+  uint64 m_rotationStartSize;
+  Y_TIMER_VALUE m_rotationStartTime;
+
+  bool m_registered;
+
+  DeclareNonCopyable(FileLogSink);
+};
@@ -5,6 +5,8 @@
 #include "YBaseLib/String.h"
 #include "YBaseLib/Timestamp.h"
 
+class ThreadPool;
+
 #define FS_MAX_PATH 512
 
 #ifdef Y_PLATFORM_WINDOWS
@@ -28,6 +30,7 @@ enum FILESYSTEM_FIND_FLAGS
   FILESYSTEM_FIND_FOLDERS = (1 << 3),
   FILESYSTEM_FIND_FILES = (1 << 4),
   FILESYSTEM_FIND_KEEP_ARRAY = (1 << 5),
+  FILESYSTEM_FIND_NO_STAT = (1 << 6), // leaves Size and ModificationTime unset, saves a stat per file on POSIX
 };
 
 struct FILESYSTEM_STAT_DATA
@@ -67,6 +70,10 @@ public:
     ChangeEvent_FileModified = (1 << 2),
     ChangeEvent_RenamedOldName = (1 << 3),
     ChangeEvent_RenamedNewName = (1 << 4),
+
+    // changes were lost because they came in faster than they were enumerated. Path is the watched directory,
+    // anything under it may have changed.
+    ChangeEvent_Overflow = (1 << 5),
   };
 
   struct ChangeInfo
@@ -136,12 +143,50 @@ void SanitizeFileName(char* Destination, uint32 cbDestination, const char* FileN
 void SanitizeFileName(String& Destination, const char* FileName, bool StripSlashes = true);
 void SanitizeFileName(String& Destination, bool StripSlashes = true);
 
-// search for files
+// search for files. the pattern is matched against names as a GlobPattern, so it can hold classes and ';' separated
+// alternatives as well as '*' and '?'
 bool FindFiles(const char* Path, const char* Pattern, uint32 Flags, FindResultsArray* pResults);
 
+// called for each match found by FindFilesParallel, on whichever thread found it
+typedef void (*FindFilesCallback)(const FILESYSTEM_FIND_DATA* pFindData, void* pUserData);
+
+// Searches like FindFiles, but spreads the directories over the pool's workers and passes each match to the callback
+// as soon as it is found rather than gathering them into an array. The callback can be called from several threads
+// at once, in no particular order. The calling thread searches too, so this completes with a null or busy pool, and
+// returns once every directory has been searched and every callback has returned. Returns false if nothing matched.
+bool FindFilesParallel(const char* Path, const char* Pattern, uint32 Flags, ThreadPool* pThreadPool,
+                       FindFilesCallback callback, void* pUserData);
+
+// takes anything callable as callback(const FILESYSTEM_FIND_DATA*)
+template<typename CALLBACK_TYPE>
+bool FindFilesParallel(const char* Path, const char* Pattern, uint32 Flags, ThreadPool* pThreadPool,
+                       const CALLBACK_TYPE& callback)
+{
+  struct Trampoline
+  {
+    static void Invoke(const FILESYSTEM_FIND_DATA* pFindData, void* pUserData)
+    {
+      (*reinterpret_cast<const CALLBACK_TYPE*>(pUserData))(pFindData);
+    }
+  };
+
+  return FindFilesParallel(Path, Pattern, Flags, pThreadPool, &Trampoline::Invoke,
+                           const_cast<CALLBACK_TYPE*>(&callback));
+}
+
 // stat file
 bool StatFile(const char* Path, FILESYSTEM_STAT_DATA* pStatData);
 
+// Stats many paths at once, spread over the pool's workers. The calling thread stats too, so a null pool does them
+// one after another. pFound[i] is set to whether Paths[i] exists, pStatData[i] is only filled in if it does.
+// Returns the number found.
+uint32 StatFiles(const char* const* Paths, uint32 Count, FILESYSTEM_STAT_DATA* pStatData, bool* pFound,
+                 ThreadPool* pThreadPool = nullptr);
+
+// as StatFiles, for names relative to one directory, which is only looked up once rather than for every name
+uint32 StatFilesInDirectory(const char* DirectoryPath, const char* const* Names, uint32 Count,
+                            FILESYSTEM_STAT_DATA* pStatData, bool* pFound, ThreadPool* pThreadPool = nullptr);
+
 // file exists?
 bool FileExists(const char* Path);
 
@@ -0,0 +1,130 @@
+#pragma once
+#include "YBaseLib/Array.h"
+#include "YBaseLib/CIStringHashTable.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/ReadWriteLock.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/StringHashTable.h"
+
+class ThreadPool;
+
+// An in-memory copy of a directory tree, for tools that search and stat the same files over and over. The tree is
+// read once with FindFilesParallel, or loaded from a snapshot saved by an earlier run, and kept up to date from a
+// change notifier each time Update is called. FindFiles, StatFile, FileExists and DirectoryExists take the same
+// arguments as the FileSystem versions and answer from memory for paths in the tree, anything outside it is passed
+// on to the file system. Queries can run on any number of threads at once, Build, LoadSnapshot and Update wait for
+// them to finish. Names starting with a '.' are hidden on every platform.
+//   FileSystemIndex index;
+//   if (!index.LoadSnapshot("assets", "assets.index", pThreadPool))
+//     index.Build("assets", pThreadPool);
+//   index.FindFiles("assets/textures", "*.png", FILESYSTEM_FIND_RECURSIVE | FILESYSTEM_FIND_FILES, &results);
+//   index.Update();
+//   index.SaveSnapshot("assets.index");
+class FileSystemIndex
+{
+public:
+  FileSystemIndex();
+  ~FileSystemIndex();
+
+  // Reads the tree under rootPath, replacing anything indexed before. With watch set, a change notifier is created
+  // first so nothing changed while the tree is being read is missed.
+  bool Build(const char* rootPath, ThreadPool* pThreadPool, bool watch = true);
+
+  // Loads the tree under rootPath from a snapshot. Every directory is stat'd, and those changed since they were read
+  // are read again, which catches files added, removed or renamed while nothing was watching. Files written in place
+  // don't change their directory, so their sizes and times are the snapshot's until the notifier sees them change.
+  // Fails, leaving the index empty, if the snapshot is missing, damaged or of another directory.
+  bool LoadSnapshot(const char* rootPath, const char* snapshotFileName, ThreadPool* pThreadPool, bool watch = true);
+
+  // writes the tree out for LoadSnapshot, replacing the file only once it's complete
+  bool SaveSnapshot(const char* snapshotFileName) const;
+
+  // Applies the changes reported since the last update, returns false if there weren't any. New directories are read
+  // on the pool. If the notifier lost changes the whole tree is read again.
+  bool Update(ThreadPool* pThreadPool = nullptr);
+
+  // forgets the tree and stops watching
+  void Clear();
+
+  const String& GetRootPath() const { return m_rootPath; }
+  bool IsWatching() const { return (m_pChangeNotifier != nullptr); }
+
+  // files and directories in the tree, not counting the root
+  uint32 GetEntryCount() const;
+
+  bool FindFiles(const char* Path, const char* Pattern, uint32 Flags, FileSystem::FindResultsArray* pResults) const;
+  bool StatFile(const char* Path, FILESYSTEM_STAT_DATA* pStatData) const;
+  bool FileExists(const char* Path) const;
+  bool DirectoryExists(const char* Path) const;
+
+private:
+  static const uint32 InvalidNode = 0xFFFFFFFF;
+  static const uint32 RootNode = 0;
+
+  // names are the same whatever their case on Windows
+#if defined(Y_PLATFORM_WINDOWS)
+  typedef CIStringHashTable<uint32> PathTable;
+#else
+  typedef StringHashTable<uint32> PathTable;
+#endif
+
+  // one file or directory, children are linked through their siblings
+  struct Node
+  {
+    // relative to the root with '/' separators, empty for the root
+    String Path;
+    uint32 NameOffset;
+    FILESYSTEM_STAT_DATA StatData;
+
+    // for directories, the unix time just before their contents were last read
+    uint64 ReadTime;
+
+    uint32 Parent;
+    uint32 FirstChild;
+    uint32 NextSibling;
+    uint32 PreviousSibling;
+  };
+
+  // the rest are called with m_lock held exclusively, or shared for the const ones
+
+  // turns a path into one relative to the root, false if it isn't under the root
+  bool GetRelativePath(String& destination, const char* path) const;
+  void GetFullPath(String& destination, const String& relativePath) const;
+
+  uint32 FindNode(const String& relativePath) const;
+  uint32 GetOrCreateNode(const String& relativePath, bool* pCreated);
+  void RemoveNode(uint32 nodeIndex);
+  void ResetNodes();
+
+  // reads everything below a directory, adding it to the tree
+  void ScanTree(uint32 nodeIndex, ThreadPool* pThreadPool);
+
+  // reads a directory's entries and brings its children in line, new subdirectories are scanned
+  void SyncDirectory(uint32 nodeIndex, ThreadPool* pThreadPool);
+
+  // stats a path that may have changed, adding, updating or removing it
+  void RefreshPath(const String& relativePath, bool contentsChanged, ThreadPool* pThreadPool);
+
+  // the snapshot format, entries are written parents first, each naming its parent by its position in the file
+  bool ReadSnapshot(ByteStream* pStream);
+  bool WriteSnapshot(ByteStream* pStream) const;
+
+  bool StartWatching();
+
+  String m_rootPath;
+  String m_canonicalRootPath;
+  FileSystem::ChangeNotifier* m_pChangeNotifier;
+
+  mutable ReadWriteLock m_lock;
+  Array<Node> m_nodes;
+  PODArray<uint32> m_freeNodes;
+  PathTable m_pathTable;
+
+  // held by Update while it enumerates the notifier's changes
+  Mutex m_updateLock;
+
+  DeclareNonCopyable(FileSystemIndex);
+};
@@ -0,0 +1,504 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/HashTrait.h"
+#include "YBaseLib/Memory.h"
+#include <new>
+#include <utility>
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <emmintrin.h>
+#define Y_FLATHASHTABLE_SSE2 1
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_FLATHASHTABLE_NEON 1
+#endif
+
+// Open-addressing hash table with the same interface as HashTable, laid out like a Swiss table.
+// Members are stored inline in one array, next to an array of control bytes holding 7 bits of each member's hash,
+// so a lookup compares 16 candidates at once and usually touches a single member. Removal leaves a tombstone,
+// nothing moves until the table grows, so Member pointers stay valid across Remove but not across Insert/Set.
+// Iteration is in slot order, not insertion order.
+template<typename KeyType, typename ValueType, class HashTraitClass = HashTrait<KeyType>>
+class FlatHashTable
+{
+public:
+  struct Member
+  {
+    KeyType Key;
+    ValueType Value;
+  };
+
+  // slots probed per step
+  static const uint32 GroupWidth = 16;
+
+  class Iterator;
+  class ConstIterator;
+
+  class Iterator
+  {
+    friend class ConstIterator;
+
+  public:
+    Iterator() : m_pTable(NULL), m_index(0) {}
+    Iterator(FlatHashTable* pTable, uint32 index) : m_pTable(pTable), m_index(index) { SkipEmpty(); }
+    Iterator(const Iterator& c) : m_pTable(c.m_pTable), m_index(c.m_index) {}
+
+    inline void Forward()
+    {
+      m_index++;
+      SkipEmpty();
+    }
+    inline bool AtEnd() { return (m_index >= m_pTable->m_capacity); }
+
+    inline bool operator==(const Iterator& rhs) { return (m_index == rhs.m_index); }
+    inline bool operator!=(const Iterator& rhs) { return (m_index != rhs.m_index); }
+
+    inline Iterator& operator=(const Iterator& rhs)
+    {
+      m_pTable = rhs.m_pTable;
+      m_index = rhs.m_index;
+      return *this;
+    }
+
+    // pre-increment
+    inline Iterator& operator++()
+    {
+      Forward();
+      return *this;
+    }
+
+    // post-increment
+    Iterator operator++(int)
+    {
+      Iterator i(*this);
+      this->Forward();
+      return i;
+    }
+
+    // dereference
+    inline Member& operator*() { return m_pTable->m_pMembers[m_index]; }
+    inline Member* operator->() { return &m_pTable->m_pMembers[m_index]; }
+
+  private:
+    void SkipEmpty()
+    {
+      while (m_index < m_pTable->m_capacity && !IsFull(m_pTable->m_pControl[m_index]))
+        m_index++;
+    }
+
+    FlatHashTable* m_pTable;
+    uint32 m_index;
+  };
+
+  class ConstIterator
+  {
+  public:
+    ConstIterator() : m_pTable(NULL), m_index(0) {}
+    ConstIterator(const FlatHashTable* pTable, uint32 index) : m_pTable(pTable), m_index(index) { SkipEmpty(); }
+    ConstIterator(const Iterator& c) : m_pTable(c.m_pTable), m_index(c.m_index) {}
+    ConstIterator(const ConstIterator& c) : m_pTable(c.m_pTable), m_index(c.m_index) {}
+
+    inline void Forward()
+    {
+      m_index++;
+      SkipEmpty();
+    }
+    inline bool AtEnd() { return (m_index >= m_pTable->m_capacity); }
+
+    inline bool operator==(const ConstIterator& rhs) { return (m_index == rhs.m_index); }
+    inline bool operator!=(const ConstIterator& rhs) { return (m_index != rhs.m_index); }
+
+    inline ConstIterator& operator=(const ConstIterator& rhs)
+    {
+      m_pTable = rhs.m_pTable;
+      m_index = rhs.m_index;
+      return *this;
+    }
+
+    // pre-increment
+    inline ConstIterator& operator++()
+    {
+      Forward();
+      return *this;
+    }
+
+    // post-increment
+    ConstIterator operator++(int)
+    {
+      ConstIterator i(*this);
+      this->Forward();
+      return i;
+    }
+
+    // dereference
+    inline const Member& operator*() { return m_pTable->m_pMembers[m_index]; }
+    inline const Member* operator->() { return &m_pTable->m_pMembers[m_index]; }
+
+  private:
+    void SkipEmpty()
+    {
+      while (m_index < m_pTable->m_capacity && !IsFull(m_pTable->m_pControl[m_index]))
+        m_index++;
+    }
+
+    const FlatHashTable* m_pTable;
+    uint32 m_index;
+  };
+
+  FlatHashTable(uint32 reserveCount = 0)
+    : m_pMembers(NULL), m_pControl(NULL), m_capacity(0), m_nMembers(0), m_growthLeft(0)
+  {
+    if (reserveCount > 0)
+      Reserve(reserveCount);
+  }
+
+  FlatHashTable(const FlatHashTable& Copy)
+    : m_pMembers(NULL), m_pControl(NULL), m_capacity(0), m_nMembers(0), m_growthLeft(0)
+  {
+    Reserve(Copy.m_nMembers);
+    for (ConstIterator itr = Copy.Begin(); !itr.AtEnd(); itr.Forward())
+      Insert(itr->Key, itr->Value);
+  }
+
+  ~FlatHashTable()
+  {
+    DestroyMembers();
+    std::free(m_pMembers);
+  }
+
+  uint32 GetMemberCount() const { return m_nMembers; }
+
+  // number of slots, members can be added until 7/8ths of them are used
+  uint32 GetCapacity() const { return m_capacity; }
+
+  // makes room for count members without growing
+  void Reserve(uint32 count)
+  {
+    uint32 newCapacity = GetCapacityForCount(count);
+    if (newCapacity > m_capacity)
+      Resize(newCapacity);
+  }
+
+  Member* Insert(const KeyType& Key, const ValueType& Value)
+  {
+    bool IsNew;
+    Member* pMember = _Insert(Key, Value, &IsNew);
+    AssertMsg(IsNew, "Attempting to insert an already-existing key to hash table.");
+    return pMember;
+  }
+
+  Member* Set(const KeyType& Key, const ValueType& Value, bool* IsNew)
+  {
+    bool IsNew_;
+    Member* pMember = _Insert(Key, Value, &IsNew_);
+    if (!IsNew_)
+    {
+      // overwrite member value
+      pMember->Value = Value;
+    }
+
+    if (IsNew != NULL)
+      *IsNew = IsNew_;
+
+    return pMember;
+  }
+
+  Member* Find(const KeyType& Key) { return FindMember(Key, GetMixedHash(Key)); }
+
+  const Member* Find(const KeyType& Key) const { return FindMember(Key, GetMixedHash(Key)); }
+
+  bool Remove(const KeyType& Key)
+  {
+    Member* pMember = Find(Key);
+    if (pMember != NULL)
+    {
+      Remove(pMember);
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  void Remove(Member* pMember)
+  {
+    DebugAssert(pMember >= m_pMembers && pMember < m_pMembers + m_capacity);
+    uint32 index = static_cast<uint32>(pMember - m_pMembers);
+    DebugAssert(IsFull(m_pControl[index]));
+
+    // leave a tombstone so probe sequences running through this slot keep going
+    pMember->Key.~KeyType();
+    pMember->Value.~ValueType();
+    SetControl(index, CONTROL_DELETED);
+    m_nMembers--;
+  }
+
+  void Clear()
+  {
+    DestroyMembers();
+    if (m_capacity > 0)
+    {
+      std::memset(m_pControl, CONTROL_EMPTY, m_capacity + GroupWidth);
+      m_growthLeft = GetMaxLoad(m_capacity);
+    }
+  }
+
+  // operators
+  FlatHashTable& operator=(const FlatHashTable& Assign)
+  {
+    if (&Assign == this)
+      return *this;
+
+    Clear();
+    Reserve(Assign.m_nMembers);
+    for (ConstIterator itr = Assign.Begin(); !itr.AtEnd(); itr.Forward())
+      Insert(itr->Key, itr->Value);
+
+    return *this;
+  }
+
+  // returns an iterator pointing to the first member
+  Iterator Begin() { return Iterator(this, 0); }
+  ConstIterator Begin() const { return ConstIterator(this, 0); }
+
+  // returns an iterator past the last member
+  Iterator End() { return Iterator(this, m_capacity); }
+  ConstIterator End() const { return ConstIterator(this, m_capacity); }
+
+private:
+  // disable equality operators
+  bool operator==(const FlatHashTable& Comp);
+  bool operator!=(const FlatHashTable& Comp);
+
+private:
+  // control byte values, full slots hold the low 7 bits of the hash so they are never negative
+  static const int8 CONTROL_EMPTY = -128;
+  static const int8 CONTROL_DELETED = -2;
+
+  static bool IsFull(int8 control) { return (control >= 0); }
+
+  // legacy and custom traits are often the identity, so spread the hash before splitting into position and tag
+  static uint32 GetMixedHash(const KeyType& Key)
+  {
+    uint64 mixed = static_cast<uint64>(HashTraitClass::GetHash(Key)) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<uint32>(mixed >> 32) ^ static_cast<uint32>(mixed);
+  }
+  static uint32 GetH1(uint32 hash) { return (hash >> 7); }
+  static int8 GetH2(uint32 hash) { return static_cast<int8>(hash & 0x7F); }
+
+  // group of control bytes starting at any slot, one bit per slot in the returned masks
+  struct Group
+  {
+#if defined(Y_FLATHASHTABLE_SSE2)
+    __m128i Control;
+
+    Group(const int8* pControl) : Control(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pControl))) {}
+
+    uint32 Match(int8 h2) const { return _mm_movemask_epi8(_mm_cmpeq_epi8(Control, _mm_set1_epi8(h2))); }
+    uint32 MatchEmpty() const { return Match(CONTROL_EMPTY); }
+    uint32 MatchEmptyOrDeleted() const { return _mm_movemask_epi8(Control); }
+
+#elif defined(Y_FLATHASHTABLE_NEON)
+    int8x16_t Control;
+
+    Group(const int8* pControl) : Control(vld1q_s8(pControl)) {}
+
+    static uint32 ToMask(uint8x16_t comparison)
+    {
+      static const uint8 bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+      uint8x16_t masked = vandq_u8(comparison, vld1q_u8(bits));
+      return vaddv_u8(vget_low_u8(masked)) | (static_cast<uint32>(vaddv_u8(vget_high_u8(masked))) << 8);
+    }
+
+    uint32 Match(int8 h2) const { return ToMask(vceqq_s8(Control, vdupq_n_s8(h2))); }
+    uint32 MatchEmpty() const { return Match(CONTROL_EMPTY); }
+    uint32 MatchEmptyOrDeleted() const { return ToMask(vcltq_s8(Control, vdupq_n_s8(0))); }
+
+#else
+    const int8* Control;
+
+    Group(const int8* pControl) : Control(pControl) {}
+
+    uint32 Match(int8 h2) const
+    {
+      uint32 mask = 0;
+      for (uint32 i = 0; i < GroupWidth; i++)
+        mask |= static_cast<uint32>(Control[i] == h2) << i;
+      return mask;
+    }
+    uint32 MatchEmpty() const { return Match(CONTROL_EMPTY); }
+    uint32 MatchEmptyOrDeleted() const
+    {
+      uint32 mask = 0;
+      for (uint32 i = 0; i < GroupWidth; i++)
+        mask |= static_cast<uint32>(Control[i] < 0) << i;
+      return mask;
+    }
+#endif
+  };
+
+  static uint32 GetLowestBit(uint32 mask)
+  {
+    uint32 index;
+    Y_bitscanforward(mask, &index);
+    return index;
+  }
+
+  // 7/8ths of the slots, so a probe always reaches an empty slot
+  static uint32 GetMaxLoad(uint32 capacity) { return capacity - capacity / 8; }
+
+  static uint32 GetCapacityForCount(uint32 count)
+  {
+    uint32 capacity = GroupWidth;
+    while (GetMaxLoad(capacity) < count)
+      capacity *= 2;
+    return capacity;
+  }
+
+  // the first group is mirrored after the last slot, so a group can be loaded from any slot without wrapping
+  void SetControl(uint32 index, int8 control)
+  {
+    m_pControl[index] = control;
+    if (index < GroupWidth)
+      m_pControl[m_capacity + index] = control;
+  }
+
+  // probe positions step by one more group each time, which visits every group when capacity is a power of two
+  Member* FindMember(const KeyType& Key, uint32 hash) const
+  {
+    if (m_nMembers == 0)
+      return NULL;
+
+    const uint32 capacityMask = m_capacity - 1;
+    const int8 h2 = GetH2(hash);
+    uint32 position = GetH1(hash) & capacityMask;
+    for (uint32 stride = GroupWidth;; stride += GroupWidth)
+    {
+      Group group(m_pControl + position);
+      for (uint32 match = group.Match(h2); match != 0; match &= match - 1)
+      {
+        uint32 index = (position + GetLowestBit(match)) & capacityMask;
+        if (m_pMembers[index].Key == Key)
+          return &m_pMembers[index];
+      }
+
+      // keys are never placed past an empty slot
+      if (group.MatchEmpty() != 0)
+        return NULL;
+
+      position = (position + stride) & capacityMask;
+    }
+  }
+
+  uint32 FindInsertIndex(uint32 hash) const
+  {
+    const uint32 capacityMask = m_capacity - 1;
+    uint32 position = GetH1(hash) & capacityMask;
+    for (uint32 stride = GroupWidth;; stride += GroupWidth)
+    {
+      uint32 match = Group(m_pControl + position).MatchEmptyOrDeleted();
+      if (match != 0)
+        return (position + GetLowestBit(match)) & capacityMask;
+
+      position = (position + stride) & capacityMask;
+    }
+  }
+
+  void DestroyMembers()
+  {
+    for (uint32 i = 0; i < m_capacity; i++)
+    {
+      if (IsFull(m_pControl[i]))
+      {
+        m_pMembers[i].Key.~KeyType();
+        m_pMembers[i].Value.~ValueType();
+      }
+    }
+
+    m_nMembers = 0;
+  }
+
+  void Resize(uint32 newCapacity)
+  {
+    DebugAssert(newCapacity >= GroupWidth && (newCapacity & (newCapacity - 1)) == 0);
+    DebugAssert(GetMaxLoad(newCapacity) >= m_nMembers);
+
+    Member* pOldMembers = m_pMembers;
+    int8* pOldControl = m_pControl;
+    uint32 oldCapacity = m_capacity;
+
+    // members and control bytes share one allocation
+    m_pMembers = (Member*)std::malloc(sizeof(Member) * newCapacity + newCapacity + GroupWidth);
+    m_pControl = reinterpret_cast<int8*>(m_pMembers + newCapacity);
+    m_capacity = newCapacity;
+    m_growthLeft = GetMaxLoad(newCapacity) - m_nMembers;
+    std::memset(m_pControl, CONTROL_EMPTY, newCapacity + GroupWidth);
+
+    // move the members across, this also drops any tombstones
+    for (uint32 i = 0; i < oldCapacity; i++)
+    {
+      if (!IsFull(pOldControl[i]))
+        continue;
+
+      Member* pOldMember = &pOldMembers[i];
+      uint32 hash = GetMixedHash(pOldMember->Key);
+      uint32 index = FindInsertIndex(hash);
+      SetControl(index, GetH2(hash));
+      new (&m_pMembers[index].Key) KeyType(std::move(pOldMember->Key));
+      new (&m_pMembers[index].Value) ValueType(std::move(pOldMember->Value));
+      pOldMember->Key.~KeyType();
+      pOldMember->Value.~ValueType();
+    }
+
+    std::free(pOldMembers);
+  }
+
+  Member* _Insert(const KeyType& Key, const ValueType& Value, bool* IsNew)
+  {
+    uint32 hash = GetMixedHash(Key);
+    Member* pMember = FindMember(Key, hash);
+    if (pMember != NULL)
+    {
+      *IsNew = false;
+      return pMember;
+    }
+
+    if (m_capacity == 0)
+      Resize(GroupWidth);
+
+    // reusing a tombstone doesn't use up an empty slot, so only grow when taking an empty one
+    uint32 index = FindInsertIndex(hash);
+    if (m_growthLeft == 0 && m_pControl[index] == CONTROL_EMPTY)
+    {
+      // mostly tombstones, rebuild at the same size
+      if (m_nMembers * 2 <= GetMaxLoad(m_capacity))
+        Resize(m_capacity);
+      else
+        Resize(m_capacity * 2);
+
+      index = FindInsertIndex(hash);
+    }
+
+    if (m_pControl[index] == CONTROL_EMPTY)
+      m_growthLeft--;
+
+    SetControl(index, GetH2(hash));
+    pMember = &m_pMembers[index];
+    new (&pMember->Key) KeyType(Key);
+    new (&pMember->Value) ValueType(Value);
+
+    m_nMembers++;
+    *IsNew = true;
+    return pMember;
+  }
+
+  Member* m_pMembers;
+  int8* m_pControl;
+  uint32 m_capacity;
+  uint32 m_nMembers;
+
+  // empty slots that can still be filled before the table has to grow
+  uint32 m_growthLeft;
+};
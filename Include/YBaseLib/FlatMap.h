@@ -0,0 +1,248 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/MemArray.h"
+#include "YBaseLib/Sort.h"
+#include <functional>
+#include <utility>
+
+// Map kept as one array of members sorted by key, with the same interface as HashTable plus ordered lookups.
+// Lookups are a binary search over contiguous memory and iteration is a linear walk in key order, but Insert and
+// Remove move every member after the position, so build large maps with SetRange, which sorts the new members and
+// merges them in one pass. Member pointers and iterators are invalidated by any change.
+// The comparator is a callable like operator<, as for Y_sort. Members must be relocatable by memcpy (see MemArray).
+template<typename KeyType, typename ValueType, class Compare = std::less<KeyType>>
+class FlatMap
+{
+public:
+  struct Member
+  {
+    Member() {}
+    Member(const KeyType& key, const ValueType& value) : Key(key), Value(value) {}
+
+    KeyType Key;
+    ValueType Value;
+  };
+
+  template<class MemberType>
+  class IteratorBase
+  {
+  public:
+    IteratorBase() : m_pMember(nullptr), m_pEnd(nullptr) {}
+    IteratorBase(MemberType* pMember, MemberType* pEnd) : m_pMember(pMember), m_pEnd(pEnd) {}
+
+    inline void Forward() { m_pMember++; }
+    inline bool AtEnd() const { return (m_pMember == m_pEnd); }
+
+    inline bool operator==(const IteratorBase& rhs) const { return (m_pMember == rhs.m_pMember); }
+    inline bool operator!=(const IteratorBase& rhs) const { return (m_pMember != rhs.m_pMember); }
+
+    // pre-increment
+    inline IteratorBase& operator++()
+    {
+      Forward();
+      return *this;
+    }
+
+    // post-increment
+    IteratorBase operator++(int)
+    {
+      IteratorBase i(*this);
+      Forward();
+      return i;
+    }
+
+    // dereference
+    inline MemberType& operator*() const { return *m_pMember; }
+    inline MemberType* operator->() const { return m_pMember; }
+
+  private:
+    MemberType* m_pMember;
+    MemberType* m_pEnd;
+  };
+
+  typedef IteratorBase<Member> Iterator;
+  typedef IteratorBase<const Member> ConstIterator;
+
+  FlatMap(const Compare& compare = Compare()) : m_compare(compare) {}
+
+  uint32 GetMemberCount() const { return m_members.GetSize(); }
+  bool IsEmpty() const { return m_members.IsEmpty(); }
+  void Reserve(uint32 count) { m_members.Reserve(count); }
+  void Clear() { m_members.Clear(); }
+
+  // members in key order, by index
+  const Member& GetMember(uint32 index) const { return m_members[index]; }
+  Member& GetMember(uint32 index) { return m_members[index]; }
+
+  Member* Find(const KeyType& Key)
+  {
+    uint32 index = LowerBoundIndex(Key);
+    return (index < m_members.GetSize() && !m_compare(Key, m_members[index].Key)) ? &m_members[index] : nullptr;
+  }
+  const Member* Find(const KeyType& Key) const { return const_cast<FlatMap*>(this)->Find(Key); }
+
+  // index of the first member not ordering before Key, or the member count if there's none
+  uint32 LowerBoundIndex(const KeyType& Key) const
+  {
+    uint32 first = 0;
+    uint32 count = m_members.GetSize();
+    while (count > 0)
+    {
+      uint32 half = count / 2;
+      if (m_compare(m_members[first + half].Key, Key))
+      {
+        first += half + 1;
+        count -= half + 1;
+      }
+      else
+      {
+        count = half;
+      }
+    }
+
+    return first;
+  }
+
+  // index of the first member ordering after Key
+  uint32 UpperBoundIndex(const KeyType& Key) const
+  {
+    uint32 first = 0;
+    uint32 count = m_members.GetSize();
+    while (count > 0)
+    {
+      uint32 half = count / 2;
+      if (!m_compare(Key, m_members[first + half].Key))
+      {
+        first += half + 1;
+        count -= half + 1;
+      }
+      else
+      {
+        count = half;
+      }
+    }
+
+    return first;
+  }
+
+  // Iterating from LowerBound(low) until reaching UpperBound(high) visits the keys in [low, high].
+  Iterator LowerBound(const KeyType& Key) { return IteratorAt(LowerBoundIndex(Key)); }
+  ConstIterator LowerBound(const KeyType& Key) const { return IteratorAt(LowerBoundIndex(Key)); }
+  Iterator UpperBound(const KeyType& Key) { return IteratorAt(UpperBoundIndex(Key)); }
+  ConstIterator UpperBound(const KeyType& Key) const { return IteratorAt(UpperBoundIndex(Key)); }
+
+  Member* Insert(const KeyType& Key, const ValueType& Value)
+  {
+    bool IsNew;
+    Member* pMember = _Insert(Key, Value, &IsNew);
+    AssertMsg(IsNew, "Attempting to insert an already-existing key to flat map.");
+    return pMember;
+  }
+
+  Member* Set(const KeyType& Key, const ValueType& Value, bool* IsNew)
+  {
+    bool IsNew_;
+    Member* pMember = _Insert(Key, Value, &IsNew_);
+    if (!IsNew_)
+    {
+      // overwrite member value
+      pMember->Value = Value;
+    }
+
+    if (IsNew != nullptr)
+      *IsNew = IsNew_;
+
+    return pMember;
+  }
+
+  // Sets count members at once, in any order, in O(n + count log count) rather than a move of the array for each.
+  // Where a key appears more than once, the last one given wins, as if Set was called for each in turn.
+  void SetRange(const Member* pMembers, uint32 count)
+  {
+    if (count == 0)
+      return;
+
+    // sort the new members on their own, stable so the last of equal keys stays last
+    MemArray<Member> incoming;
+    incoming.AddRange(pMembers, count);
+    Compare& compare = m_compare;
+    Y_stable_sort(incoming.GetBasePointer(), incoming.GetSize(),
+                  [&compare](const Member& left, const Member& right) { return compare(left.Key, right.Key); });
+
+    // then merge them with the current members, taking the last of each run of equal keys
+    MemArray<Member> merged;
+    merged.Reserve(m_members.GetSize() + count);
+    uint32 currentIndex = 0;
+    uint32 incomingIndex = 0;
+    while (incomingIndex < incoming.GetSize())
+    {
+      const Member& next = incoming[incomingIndex];
+      while (currentIndex < m_members.GetSize() && m_compare(m_members[currentIndex].Key, next.Key))
+        merged.Add(m_members[currentIndex++]);
+      if (currentIndex < m_members.GetSize() && !m_compare(next.Key, m_members[currentIndex].Key))
+        currentIndex++;
+
+      while (incomingIndex + 1 < incoming.GetSize() && !m_compare(next.Key, incoming[incomingIndex + 1].Key))
+        incomingIndex++;
+      merged.Add(incoming[incomingIndex++]);
+    }
+    while (currentIndex < m_members.GetSize())
+      merged.Add(m_members[currentIndex++]);
+
+    m_members.Swap(merged);
+  }
+
+  bool Remove(const KeyType& Key)
+  {
+    Member* pMember = Find(Key);
+    if (pMember == nullptr)
+      return false;
+
+    Remove(pMember);
+    return true;
+  }
+
+  void Remove(Member* pMember)
+  {
+    DebugAssert(pMember >= m_members.GetBasePointer() && pMember < m_members.GetBasePointer() + m_members.GetSize());
+    m_members.OrderedRemove(static_cast<uint32>(pMember - m_members.GetBasePointer()));
+  }
+
+  // returns an iterator pointing to the first member
+  Iterator Begin() { return IteratorAt(0); }
+  ConstIterator Begin() const { return IteratorAt(0); }
+
+  // returns an iterator past the last member
+  Iterator End() { return IteratorAt(m_members.GetSize()); }
+  ConstIterator End() const { return IteratorAt(m_members.GetSize()); }
+
+private:
+  Iterator IteratorAt(uint32 index)
+  {
+    Member* pBase = m_members.GetBasePointer();
+    return Iterator(pBase + index, pBase + m_members.GetSize());
+  }
+  ConstIterator IteratorAt(uint32 index) const
+  {
+    const Member* pBase = m_members.GetBasePointer();
+    return ConstIterator(pBase + index, pBase + m_members.GetSize());
+  }
+
+  Member* _Insert(const KeyType& Key, const ValueType& Value, bool* IsNew)
+  {
+    uint32 index = LowerBoundIndex(Key);
+    if (index < m_members.GetSize() && !m_compare(Key, m_members[index].Key))
+    {
+      *IsNew = false;
+      return &m_members[index];
+    }
+
+    m_members.Insert(Member(Key, Value), index);
+    *IsNew = true;
+    return &m_members[index];
+  }
+
+  MemArray<Member> m_members;
+  Compare m_compare;
+};
@@ -0,0 +1,145 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/Timer.h"
+
+class ByteStream;
+
+// The file is a header, then a lane after another, each a write counter followed by a ring of fixed-size records.
+// Values are stored in the writer's byte order, the reader checks it matches its own.
+namespace FlightRecorder {
+// the first bytes of the file, "YBFR"
+static const uint32 Magic = 0x52464259;
+static const uint32 Version = 1;
+} // namespace FlightRecorder
+
+// Keeps the last messages logged in a memory-mapped file, so they survive the process crashing: the pages belong to
+// the file, and the system writes them out whatever happens to the process. Nothing survives the machine going down
+// that hadn't been written out by then, which Flush forces.
+//   FlightRecorderLogSink* pRecorder = new FlightRecorderLogSink();
+//   pRecorder->Open("server.flight");
+//
+// Messages are copied into fixed-size records, cut short if they don't fit, on the thread logging, before async
+// output queues them, so they're recorded even if the process dies before the log thread gets to them. Each thread
+// writes to a lane of its own, with threads sharing lanes once there are more of them than lanes, so writing a message
+// costs a copy and an increment of a counter nobody else is using, without taking any lock. Each lane keeps its last
+// recordsPerLane messages. Messages that go to the binary output aren't formatted, so aren't recorded.
+// Read the file back with FlightRecorderReader.
+class FlightRecorderLogSink
+{
+public:
+  static const uint32 DefaultLaneCount = 16;
+  static const uint32 DefaultRecordsPerLane = 1024;
+  static const uint32 DefaultRecordSize = 256;
+
+  FlightRecorderLogSink();
+  ~FlightRecorderLogSink();
+
+  // messages past the level aren't recorded
+  void SetLevelFilter(LOGLEVEL level) { m_levelFilter = level; }
+
+  // Creates the file, replacing one that's there, so a recording from a run that crashed has to be read or moved
+  // first. Records are rounded up to a multiple of 8 bytes, of which 32 are taken by the time, level and lengths,
+  // and the rest by the channel, function and message. Sets itself as the log's flight recorder. Returns false if the
+  // file can't be created or mapped.
+  bool Open(const char* fileName, uint32 laneCount = DefaultLaneCount, uint32 recordsPerLane = DefaultRecordsPerLane,
+            uint32 recordSize = DefaultRecordSize);
+
+  // Stops the log recording to the file and unmaps it. Like destroying the log, this should wait until the threads
+  // logging have stopped, as one could still be writing a message.
+  void Close();
+
+  bool IsOpen() const { return (m_pMapping != nullptr); }
+  uint64 GetFileSize() const { return m_mappingSize; }
+
+  // writes the recording to disk now, rather than whenever the system gets to it
+  bool Flush();
+
+  // records a message, called by the log on the thread logging it
+  void Record(const char* channelName, const char* functionName, LOGLEVEL level, const char* message,
+              uint32 messageLength);
+
+private:
+  byte* m_pMapping;
+  uint64 m_mappingSize;
+  uint32 m_laneCount;
+  uint32 m_recordsPerLane;
+  uint32 m_recordSize;
+  uint64 m_laneSize;
+  volatile LOGLEVEL m_levelFilter;
+
+  DeclareNonCopyable(FlightRecorderLogSink);
+};
+
+// Reads the messages back from a flight recorder's file, oldest first across the lanes.
+//   FlightRecorderReader reader(pStream);
+//   FlightRecorderReader::Message message;
+//   while (reader.ReadMessage(&message))
+//     Log_InfoPrint(message.Text);
+class FlightRecorderReader
+{
+public:
+  struct Message
+  {
+    String ChannelName;
+    String FunctionName;
+    LOGLEVEL Level;
+
+    // seconds from when the recording was opened
+    double Time;
+
+    // numbered from 1 in the order the threads first logged
+    uint32 Thread;
+
+    // set if the message didn't fit its record
+    bool Truncated;
+
+    String Text;
+  };
+
+  // The stream is referenced until the reader is deleted, and read from its current position.
+  FlightRecorderReader(ByteStream* pStream);
+  ~FlightRecorderReader();
+
+  // Reads the next message, returning false once there are no more, or if the stream isn't a flight recording,
+  // which IsDamaged tells apart.
+  bool ReadMessage(Message* pMessage);
+  bool IsDamaged() const { return m_damaged; }
+
+  // when the recording was opened, as a unix timestamp
+  uint64 GetStartTime() const { return m_startTime; }
+
+  // records that were being written when the process stopped, and are skipped
+  uint32 GetTornRecordCount() const { return m_tornRecordCount; }
+
+  // Renders a recording as lines of text, with the same prefixes as the console output, after a line saying when it
+  // was started. Returns false if the recording is damaged or the output can't be written.
+  static bool DecodeToText(ByteStream* pInput, ByteStream* pOutput);
+
+private:
+  struct RecordReference
+  {
+    uint64 TimeStamp;
+    uint64 Sequence;
+    uint32 Offset;
+  };
+
+  // reads the file and sorts its records, the first time a message is read
+  bool Load();
+
+  ByteStream* m_pStream;
+  PODArray<byte> m_data;
+  PODArray<RecordReference> m_records;
+  uint32 m_nextRecord;
+  uint32 m_recordSize;
+  Y_TIMER_VALUE m_startTimeStamp;
+  double m_secondsPerTick;
+  uint64 m_startTime;
+  uint32 m_tornRecordCount;
+  bool m_loaded;
+  bool m_damaged;
+
+  DeclareNonCopyable(FlightRecorderReader);
+};
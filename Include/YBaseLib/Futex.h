@@ -0,0 +1,14 @@
+#pragma once
+#include "YBaseLib/Common.h"
+
+// Waiting on the value of a word, with no kernel object behind it. Linux and Android use the futex system call,
+// Windows 8 and later WaitOnAddress, and everything else a small table of condition variables hashed by address.
+// Wakes only reach threads waiting on the same address, but a wait may also return spuriously, so callers re-check
+// their condition in a loop.
+
+// sleeps as long as *pAddress still holds expectedValue
+void Y_FutexWait(volatile uint32* pAddress, uint32 expectedValue);
+
+// wakes one or every thread waiting on pAddress
+void Y_FutexWakeOne(volatile uint32* pAddress);
+void Y_FutexWakeAll(volatile uint32* pAddress);
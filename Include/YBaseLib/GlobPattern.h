@@ -0,0 +1,98 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/StringView.h"
+
+// A wildcard pattern parsed once and then matched against any number of names, as FindFiles does for each entry.
+// '*' matches any run of characters but '/', '**' matches any run including '/', '?' matches one character but '/',
+// and [abc], [a-z] and [!abc] (or [^abc]) match one character from or outside a class. A '[' without its ']' is an
+// ordinary character. Several patterns can be given separated by ';', a name matches if any of them does.
+// The characters before the first wildcard and after the last are compared before anything else, so a name that can't
+// match is usually rejected in a compare or two, and patterns like "*", "name", "*.txt" or "prefix*" never get further.
+//   GlobPattern pattern("*.png;*.tga", GlobPattern::FLAG_CASE_INSENSITIVE);
+//   if (pattern.Match(fileName)) ...
+class GlobPattern
+{
+public:
+  enum FLAGS
+  {
+    FLAG_CASE_INSENSITIVE = (1 << 0),
+  };
+
+  // an empty pattern matches nothing
+  GlobPattern();
+  GlobPattern(const char* pattern, uint32 flags = 0);
+
+  // replaces the pattern
+  void Compile(const char* pattern, uint32 flags = 0);
+
+  // adds more patterns to match alongside the current ones, ';' separated as well
+  void AddPattern(const char* pattern);
+
+  void Clear();
+
+  bool IsEmpty() const { return (m_alternatives.GetSize() == 0); }
+
+  // true if any name matches, as for "*" or "**"
+  bool MatchesAll() const { return m_matchesAll; }
+
+  bool Match(const StringView& subject) const;
+
+private:
+  enum TOKEN_TYPE
+  {
+    TOKEN_CHARACTER,
+    TOKEN_ANY,
+    TOKEN_CLASS,
+    TOKEN_STAR,
+    TOKEN_GLOBSTAR,
+  };
+
+  struct Token
+  {
+    uint8 Type;
+    char Character;
+    uint16 ClassIndex;
+  };
+
+  // one ';' separated part. the leading and trailing characters are kept apart, the tokens in between need the
+  // general match. shapes like "abc*xyz" are decided by the prefix and suffix alone.
+  struct Alternative
+  {
+    uint32 PrefixOffset;
+    uint32 PrefixLength;
+    uint32 SuffixOffset;
+    uint32 SuffixLength;
+    uint32 FirstToken;
+    uint32 TokenCount;
+    uint32 MinimumLength;
+    bool HasWildCards;
+  };
+
+  // a class is a bit for each character
+  struct CharacterClass
+  {
+    uint32 Bits[8];
+  };
+
+  void AddAlternative(const char* pattern, uint32 length);
+
+  // parses a class starting at '[', returns the characters used, or 0 if it isn't one
+  uint32 ParseClass(const char* pattern, uint32 length, CharacterClass* pClass) const;
+
+  bool MatchAlternative(const Alternative& alternative, const char* subject, uint32 length) const;
+
+  // runs the tokens between the prefix and suffix over the characters between them, as a set of states
+  bool MatchTokens(const Alternative& alternative, const char* subject, uint32 length) const;
+
+  bool CompareCharacters(const char* left, const char* right, uint32 length) const;
+
+  char FoldCharacter(char ch) const;
+
+  PODArray<Alternative> m_alternatives;
+  PODArray<Token> m_tokens;
+  PODArray<CharacterClass> m_classes;
+  PODArray<char> m_literals;
+  uint32 m_flags;
+  bool m_matchesAll;
+};
@@ -7,7 +7,7 @@ class Mutex
   friend class ConditionVariable;
 
 public:
-  Mutex() {}
+  Mutex(uint32 spinCount = 0) {}
 
   ~Mutex() {}
 
@@ -17,5 +17,8 @@ public:
 
   void Unlock() {}
 
+  // there's nothing to contend on without threads
+  void SetProfileName(const char* name) {}
+
 private:
 };
@@ -19,5 +19,8 @@ public:
 
   void UpgradeSharedLockToExclusive();
 
+  // there's nothing to contend on without threads
+  void SetProfileName(const char* name) {}
+
 private:
 };
@@ -17,5 +17,8 @@ public:
 
   void Unlock() {}
 
+  // there's nothing to contend on without threads
+  void SetProfileName(const char* name) {}
+
 private:
 };
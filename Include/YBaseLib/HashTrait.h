@@ -4,21 +4,71 @@
 
 typedef uint32 HashType;
 
+// 64-bit hash of a block of memory, in the style of wyhash. Keys are read a word at a time, and keys longer than
+// 48 bytes are processed in three independent lanes so the multiplies can overlap. Values may change between
+// versions, anything stored on disk should use LegacyHashTrait.
+uint64 Y_HashBytes64(const void* pData, size_t length, uint64 seed = 0);
+
+// strong 64-bit integer mixer, every input bit affects every output bit
+uint64 Y_HashInteger64(uint64 value);
+
+// MurmurHash3's finalizer, for structures that split a hash they're given into several indices, such as BloomFilter
+// and CuckooFilter. Neighbouring keys hashed with a single multiply, as Y_HashInteger64 is, still share enough
+// structure to raise their false positive rate several times, this mixes every bit into every other.
+uint64 Y_HashFinalize64(uint64 hash);
+
+// the above folded to HashType
+inline HashType Y_HashBytes(const void* pData, size_t length)
+{
+  uint64 hash = Y_HashBytes64(pData, length);
+  return (HashType)(hash ^ (hash >> 32));
+}
+inline HashType Y_HashInteger(uint64 value)
+{
+  uint64 hash = Y_HashInteger64(value);
+  return (HashType)(hash ^ (hash >> 32));
+}
+
+// hash of a string with ASCII letters lower-cased, so strings that Y_stricmp says are equal hash the same. the key
+// is folded onto the stack a block at a time and hashed with Y_HashBytes64, nothing is allocated.
+uint64 Y_HashStringCaseInsensitive64(const char* pData, size_t length);
+inline HashType Y_HashStringCaseInsensitive(const char* pData, size_t length)
+{
+  uint64 hash = Y_HashStringCaseInsensitive64(pData, length);
+  return (HashType)(hash ^ (hash >> 32));
+}
+
 template<typename KEYTYPE>
 struct HashTrait
 {
 };
 
+// the original hashes, integers hash to themselves and strings use Jenkins one-at-a-time
+template<typename KEYTYPE>
+struct LegacyHashTrait
+{
+};
+
 // built-ins
 #define DECLARE_HASHTRAIT_BYVAL(type)                                                                                  \
   template<>                                                                                                           \
   struct HashTrait<type>                                                                                               \
+  {                                                                                                                    \
+    static HashType GetHash(const type Value);                                                                         \
+  };                                                                                                                   \
+  template<>                                                                                                           \
+  struct LegacyHashTrait<type>                                                                                         \
   {                                                                                                                    \
     static HashType GetHash(const type Value);                                                                         \
   };
 #define DECLARE_HASHTRAIT_BYREF(type)                                                                                  \
   template<>                                                                                                           \
   struct HashTrait<type>                                                                                               \
+  {                                                                                                                    \
+    static HashType GetHash(const type& Value);                                                                        \
+  };                                                                                                                   \
+  template<>                                                                                                           \
+  struct LegacyHashTrait<type>                                                                                         \
   {                                                                                                                    \
     static HashType GetHash(const type& Value);                                                                        \
   };
@@ -36,9 +86,15 @@ class String;
 DECLARE_HASHTRAIT_BYREF(String);
 // DECLARE_HASHTRAIT_BYVAL(char *);
 
-// built-in hash function for a pointer type
+// built-in hash function for a pointer type, allocations are aligned so the low bits carry nothing on their own
 template<typename KEYTYPE>
 struct HashTrait<KEYTYPE*>
 {
-  static HashType GetHash(const KEYTYPE* Value) { return (HashType)Value; }
+  static HashType GetHash(const KEYTYPE* Value) { return Y_HashInteger((uint64)(uintptr_t)Value); }
+};
+
+template<typename KEYTYPE>
+struct LegacyHashTrait<KEYTYPE*>
+{
+  static HashType GetHash(const KEYTYPE* Value) { return (HashType)(uintptr_t)Value; }
 };
@@ -0,0 +1,180 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+#include <new>
+#include <type_traits>
+
+template<class Signature, uint32 InlineSize = 48>
+class InlineFunction;
+
+// Move-only holder for any callable with the given signature. Callables up to InlineSize bytes are stored in the
+// object itself, larger ones are allocated. A call goes through one function pointer set when the callable was
+// stored, with no virtual dispatch, and moving the holder moves the callable. The default size makes the holder one
+// cache line on 64-bit targets.
+template<class R, class... Args, uint32 InlineSize>
+class InlineFunction<R(Args...), InlineSize>
+{
+  static_assert(InlineSize >= sizeof(void*), "inline storage must be able to hold a pointer");
+
+  template<class F>
+  struct IsInlineFunction : std::false_type
+  {
+  };
+  template<class S, uint32 N>
+  struct IsInlineFunction<InlineFunction<S, N>> : std::true_type
+  {
+  };
+
+public:
+  static const uint32 StorageAlignment = 16;
+
+  InlineFunction() : m_pInvoke(nullptr), m_pMove(nullptr) {}
+  InlineFunction(std::nullptr_t) : m_pInvoke(nullptr), m_pMove(nullptr) {}
+
+  template<class F, class = typename std::enable_if<!IsInlineFunction<typename std::decay<F>::type>::value>::type>
+  InlineFunction(F&& callable)
+  {
+    Store(std::forward<F>(callable));
+  }
+
+  InlineFunction(InlineFunction&& other) { MoveFrom(other); }
+
+  ~InlineFunction() { Reset(); }
+
+  InlineFunction& operator=(InlineFunction&& other)
+  {
+    if (this != &other)
+    {
+      Reset();
+      MoveFrom(other);
+    }
+
+    return *this;
+  }
+
+  InlineFunction& operator=(std::nullptr_t)
+  {
+    Reset();
+    return *this;
+  }
+
+  template<class F, class = typename std::enable_if<!IsInlineFunction<typename std::decay<F>::type>::value>::type>
+  InlineFunction& operator=(F&& callable)
+  {
+    Reset();
+    Store(std::forward<F>(callable));
+    return *this;
+  }
+
+  InlineFunction(const InlineFunction&) = delete;
+  InlineFunction& operator=(const InlineFunction&) = delete;
+
+  bool IsEmpty() const { return (m_pInvoke == nullptr); }
+  explicit operator bool() const { return (m_pInvoke != nullptr); }
+
+  // whether a callable of type F is stored in the object rather than allocated
+  template<class F>
+  static constexpr bool FitsInline()
+  {
+    return (sizeof(F) <= InlineSize && alignof(F) <= StorageAlignment);
+  }
+
+  // destroys the callable, leaving the holder empty
+  void Reset()
+  {
+    if (m_pInvoke != nullptr)
+    {
+      m_pMove(m_storage, nullptr);
+      m_pInvoke = nullptr;
+      m_pMove = nullptr;
+    }
+  }
+
+  R operator()(Args... args) const
+  {
+    DebugAssert(m_pInvoke != nullptr);
+    return m_pInvoke(m_storage, std::forward<Args>(args)...);
+  }
+
+private:
+  typedef R (*InvokeFunction)(void* pStorage, Args... args);
+
+  // moves the callable to pDestination and destroys the original, or only destroys it when pDestination is null
+  typedef void (*MoveFunction)(void* pStorage, void* pDestination);
+
+  template<class F>
+  struct InlineStorage
+  {
+    static R Invoke(void* pStorage, Args... args)
+    {
+      return (*reinterpret_cast<F*>(pStorage))(std::forward<Args>(args)...);
+    }
+
+    static void Move(void* pStorage, void* pDestination)
+    {
+      F* pCallable = reinterpret_cast<F*>(pStorage);
+      if (pDestination != nullptr)
+        new (pDestination) F(std::move(*pCallable));
+
+      pCallable->~F();
+    }
+  };
+
+  template<class F>
+  struct AllocatedStorage
+  {
+    static R Invoke(void* pStorage, Args... args)
+    {
+      return (**reinterpret_cast<F**>(pStorage))(std::forward<Args>(args)...);
+    }
+
+    static void Move(void* pStorage, void* pDestination)
+    {
+      F* pCallable = *reinterpret_cast<F**>(pStorage);
+      if (pDestination != nullptr)
+        *reinterpret_cast<F**>(pDestination) = pCallable;
+      else
+        delete pCallable;
+    }
+  };
+
+  // the placement is picked at compile time, so only the one used is instantiated for a callable
+  template<class F>
+  void Store(F&& callable)
+  {
+    typedef typename std::decay<F>::type CallableType;
+    Store<CallableType>(std::forward<F>(callable), std::integral_constant<bool, FitsInline<CallableType>()>());
+  }
+
+  template<class CallableType, class F>
+  void Store(F&& callable, std::true_type)
+  {
+    new (m_storage) CallableType(std::forward<F>(callable));
+    m_pInvoke = &InlineStorage<CallableType>::Invoke;
+    m_pMove = &InlineStorage<CallableType>::Move;
+  }
+
+  template<class CallableType, class F>
+  void Store(F&& callable, std::false_type)
+  {
+    *reinterpret_cast<CallableType**>(m_storage) = new CallableType(std::forward<F>(callable));
+    m_pInvoke = &AllocatedStorage<CallableType>::Invoke;
+    m_pMove = &AllocatedStorage<CallableType>::Move;
+  }
+
+  void MoveFrom(InlineFunction& other)
+  {
+    m_pInvoke = other.m_pInvoke;
+    m_pMove = other.m_pMove;
+    if (m_pInvoke != nullptr)
+    {
+      m_pMove(other.m_storage, m_storage);
+      other.m_pInvoke = nullptr;
+      other.m_pMove = nullptr;
+    }
+  }
+
+  InvokeFunction m_pInvoke;
+  MoveFunction m_pMove;
+  mutable ALIGN_DECL(16) byte m_storage[InlineSize];
+};
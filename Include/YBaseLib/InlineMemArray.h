@@ -0,0 +1,48 @@
+#pragma once
+#include "YBaseLib/InlinePODArray.h"
+
+// MemArray with room for the first N elements inside the object, see InlinePODArray.
+// Elements are only ever moved with memcpy, and popped through an out pointer like MemArray.
+template<class T, uint32 N>
+class InlineMemArray : public InlinePODArray<T, N>
+{
+  typedef InlinePODArray<T, N> BaseClass;
+
+public:
+  InlineMemArray() {}
+  InlineMemArray(uint32 nReserve) : BaseClass(nReserve) {}
+  InlineMemArray(const InlineMemArray& c) : BaseClass(c) {}
+  InlineMemArray(InlineMemArray&& c) : BaseClass(static_cast<BaseClass&&>(c)) {}
+
+  void PopFront(T* pReturnValue)
+  {
+    DebugAssert(this->m_size > 0);
+
+    if (pReturnValue != nullptr)
+      std::memcpy(pReturnValue, &this->m_pElements[0], sizeof(T));
+
+    this->RemoveFront();
+  }
+
+  void PopBack(T* pReturnValue)
+  {
+    DebugAssert(this->m_size > 0);
+
+    if (pReturnValue != nullptr)
+      std::memcpy(pReturnValue, &this->m_pElements[this->m_size - 1], sizeof(T));
+
+    this->RemoveBack();
+  }
+
+  // assignment operator
+  InlineMemArray& operator=(const InlineMemArray& c)
+  {
+    this->Assign(c);
+    return *this;
+  }
+  InlineMemArray& operator=(InlineMemArray&& c)
+  {
+    this->Swap(c);
+    return *this;
+  }
+};
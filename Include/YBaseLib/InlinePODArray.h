@@ -0,0 +1,494 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/Sort.h"
+
+// PODArray with room for the first N elements inside the object itself, so small arrays never touch the heap.
+// Growing past N moves the elements to a heap allocation, which is kept until Shrink or Obliterate moves them
+// back. The interface matches PODArray, but since the elements can live inside the object their addresses
+// change when the array is moved or swapped, not just when it grows.
+template<class T, uint32 N>
+class InlinePODArray
+{
+  static_assert(N > 0, "inline capacity must be at least one element");
+
+public:
+  InlinePODArray()
+  {
+    m_pElements = m_inlineElements;
+    m_size = 0;
+    m_reserve = N;
+  }
+
+  InlinePODArray(uint32 nReserve)
+  {
+    m_pElements = m_inlineElements;
+    m_size = 0;
+    m_reserve = N;
+    Reserve(nReserve);
+  }
+
+  InlinePODArray(const InlinePODArray& c)
+  {
+    m_pElements = m_inlineElements;
+    m_size = 0;
+    m_reserve = N;
+    Assign(c);
+  }
+
+  InlinePODArray(InlinePODArray&& c)
+  {
+    m_pElements = m_inlineElements;
+    m_size = 0;
+    m_reserve = N;
+    Swap(c);
+  }
+
+  ~InlinePODArray()
+  {
+    if (!IsInline())
+      Y_free(m_pElements);
+  }
+
+  // true while the elements are stored inside the object
+  bool IsInline() const { return (m_pElements == m_inlineElements); }
+
+  void Clear() { m_size = 0; }
+
+  void Assign(const InlinePODArray& c)
+  {
+    if (&c == this)
+      return;
+
+    Clear();
+    Reserve(c.m_size);
+    m_size = c.m_size;
+    if (m_size > 0)
+      std::memcpy(m_pElements, c.m_pElements, sizeof(T) * m_size);
+  }
+
+  void Swap(InlinePODArray& c)
+  {
+    if (&c == this)
+      return;
+
+    // two heap arrays can just trade pointers
+    if (!IsInline() && !c.IsInline())
+    {
+      ::Swap(m_pElements, c.m_pElements);
+      ::Swap(m_size, c.m_size);
+      ::Swap(m_reserve, c.m_reserve);
+      return;
+    }
+
+    // otherwise the inline side's elements have to be copied across
+    if (IsInline() && c.IsInline())
+    {
+      T temp[N];
+      std::memcpy(temp, m_inlineElements, sizeof(T) * m_size);
+      std::memcpy(m_inlineElements, c.m_inlineElements, sizeof(T) * c.m_size);
+      std::memcpy(c.m_inlineElements, temp, sizeof(T) * m_size);
+      ::Swap(m_size, c.m_size);
+      return;
+    }
+
+    InlinePODArray& inlineArray = (IsInline()) ? *this : c;
+    InlinePODArray& heapArray = (IsInline()) ? c : *this;
+    std::memcpy(heapArray.m_inlineElements, inlineArray.m_inlineElements, sizeof(T) * inlineArray.m_size);
+    inlineArray.m_pElements = heapArray.m_pElements;
+    heapArray.m_pElements = heapArray.m_inlineElements;
+    ::Swap(m_size, c.m_size);
+    ::Swap(m_reserve, c.m_reserve);
+  }
+
+  void Obliterate()
+  {
+    Clear();
+    if (!IsInline())
+    {
+      Y_free(m_pElements);
+      m_pElements = m_inlineElements;
+      m_reserve = N;
+    }
+  }
+
+  bool Equals(const InlinePODArray& c) const
+  {
+    if (c.m_size != m_size)
+      return false;
+
+    return std::memcmp(m_pElements, c.m_pElements, sizeof(T) * m_size) == 0;
+  }
+
+  void Reserve(uint32 nElements)
+  {
+    if (m_reserve >= nElements)
+      return;
+
+    // first spill copies the inline elements out, after that it's a normal realloc
+    if (IsInline())
+    {
+      T* pNewElements = (T*)Y_mallocarray(sizeof(T), nElements);
+      if (m_size > 0)
+        std::memcpy(pNewElements, m_inlineElements, sizeof(T) * m_size);
+
+      m_pElements = pNewElements;
+    }
+    else
+    {
+      m_pElements = (T*)Y_reallocarray(m_pElements, sizeof(T), nElements);
+    }
+
+    m_reserve = nElements;
+  }
+
+  void Resize(uint32 newSize)
+  {
+    // expanding?
+    if (newSize < m_size)
+    {
+      m_size = newSize;
+    }
+    else
+    {
+      if (newSize > m_reserve)
+        Reserve(newSize);
+
+      Y_memzero(m_pElements + m_size, sizeof(T) * (newSize - m_size));
+      m_size = newSize;
+    }
+  }
+
+  void Shrink()
+  {
+    if (IsInline() || m_reserve == m_size)
+      return;
+
+    // back into the object if it fits, otherwise trim the heap allocation
+    if (m_size <= N)
+    {
+      if (m_size > 0)
+        std::memcpy(m_inlineElements, m_pElements, sizeof(T) * m_size);
+
+      Y_free(m_pElements);
+      m_pElements = m_inlineElements;
+      m_reserve = N;
+    }
+    else
+    {
+      m_pElements = (T*)Y_reallocarray(m_pElements, sizeof(T), m_size);
+      m_reserve = m_size;
+    }
+  }
+
+  void Add(const T& value)
+  {
+    // autosize
+    if (m_size == m_reserve)
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + 1));
+
+    std::memcpy(&m_pElements[m_size], &value, sizeof(T));
+    m_size++;
+  }
+
+  template<typename... Args>
+  void Emplace(Args... args)
+  {
+    // autosize
+    if (m_size == m_reserve)
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + 1));
+
+    new (&m_pElements[m_size]) T(args...);
+    m_size++;
+  }
+
+  void AddRange(const T* pValues, uint32 count)
+  {
+    if (!count)
+      return;
+
+    if ((m_size + count) > m_reserve)
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + count));
+
+    std::memcpy(m_pElements + m_size, pValues, sizeof(T) * count);
+    m_size += count;
+  }
+
+  void AddArray(const InlinePODArray& array)
+  {
+    if (array.GetSize() > 0)
+      AddRange(array.GetBasePointer(), array.GetSize());
+  }
+
+  void RemoveFront()
+  {
+    DebugAssert(m_size > 0);
+    std::memmove(m_pElements, m_pElements + 1, sizeof(T) * (m_size - 1));
+    m_size--;
+  }
+
+  void RemoveBack()
+  {
+    DebugAssert(m_size > 0);
+    m_size--;
+  }
+
+  T PopFront()
+  {
+    DebugAssert(m_size > 0);
+    T returnValue = m_pElements[0];
+
+    RemoveFront();
+
+    return returnValue;
+  }
+
+  T PopBack()
+  {
+    DebugAssert(m_size > 0);
+
+    T returnValue = m_pElements[m_size - 1];
+
+    RemoveBack();
+
+    return returnValue;
+  }
+
+  void FastRemove(uint32 index)
+  {
+    DebugAssert(index < m_size);
+
+    // swap end and index elements
+    if (index != (m_size - 1))
+      std::memcpy(&m_pElements[index], &m_pElements[m_size - 1], sizeof(T));
+
+    m_size--;
+  }
+
+  void OrderedRemove(uint32 index)
+  {
+    DebugAssert(index < m_size);
+
+    // move everything from index+1 back one index
+    if (index != (m_size - 1))
+      std::memmove(m_pElements + index, m_pElements + index + 1, sizeof(T) * (m_size - index - 1));
+
+    m_size--;
+  }
+
+  void RemoveRange(uint32 first, uint32 count)
+  {
+    DebugAssert((first + count) <= m_size);
+
+    // move everything after first + count backwards, unless taking a slice off the end
+    if ((first + count) != m_size)
+      std::memmove(m_pElements + first, m_pElements + first + count, sizeof(T) * (m_size - first - count));
+
+    m_size -= count;
+  }
+
+  bool FastRemoveItem(const T& item)
+  {
+    int32 index = IndexOf(item);
+    if (index < 0)
+      return false;
+
+    FastRemove(index);
+    return true;
+  }
+
+  bool OrderedRemoveItem(const T& item)
+  {
+    int32 index = IndexOf(item);
+    if (index < 0)
+      return false;
+
+    OrderedRemove(index);
+    return true;
+  }
+
+  // caller owns the returned pointer and frees it with Y_free, inline elements are copied to the heap first
+  void DetachArray(T** pBasePointer, uint32* pSize)
+  {
+    DebugAssert(pBasePointer != NULL && pSize != NULL);
+    if (IsInline())
+    {
+      *pBasePointer = NULL;
+      if (m_size > 0)
+      {
+        *pBasePointer = (T*)Y_mallocarray(sizeof(T), m_size);
+        std::memcpy(*pBasePointer, m_inlineElements, sizeof(T) * m_size);
+      }
+    }
+    else
+    {
+      *pBasePointer = m_pElements;
+    }
+
+    *pSize = m_size;
+    m_pElements = m_inlineElements;
+    m_size = 0;
+    m_reserve = N;
+  }
+
+  uint32 GetSize() const { return m_size; }
+
+  uint32 GetReserve() const { return m_reserve; }
+
+  // number of elements that fit without a heap allocation
+  static uint32 GetInlineCapacity() { return N; }
+
+  const T& GetElement(uint32 i) const
+  {
+    DebugAssert(i < m_size);
+    return m_pElements[i];
+  }
+
+  uint32 GetStorageSizeInBytes() const { return m_size * sizeof(T); }
+
+  uint32 GetStorageReserveInBytes() const { return m_reserve * sizeof(T); }
+
+  // callback(left, right) returns a qsort-style int, and is inlined into the sort
+  template<class CB>
+  void SortCB(CB callback)
+  {
+    Y_sort(m_pElements, m_size, [&callback](const T& left, const T& right) { return callback(left, right) < 0; });
+  }
+
+  void Sort(int (*CompareFunction)(const T* pLeft, const T* pRight))
+  {
+    Y_sort(m_pElements, m_size,
+           [CompareFunction](const T& left, const T& right) { return CompareFunction(&left, &right) < 0; });
+  }
+
+  bool BinarySearch(uint32* pOutIndex, const T& searchKey,
+                    int (*CompareFunction)(const T* pLeft, const T* pRight)) const
+  {
+    if (m_size == 0)
+      return false;
+
+    const T* pResult = Y_bsearchT(&searchKey, m_pElements, m_size, CompareFunction);
+    if (pResult == NULL)
+      return false;
+
+    if (pOutIndex != NULL)
+      *pOutIndex = uint32(pResult - m_pElements);
+
+    return true;
+  }
+
+  template<typename key_t>
+  const T* BinarySearchKey(const key_t& searchKey,
+                           int (*SearchCompareFunction)(const key_t* pSearchKey, const T* pElement)) const
+  {
+    if (m_size == 0)
+      return NULL;
+
+    return Y_bsearchT(&searchKey, m_pElements, m_size, SearchCompareFunction);
+  }
+
+  // linear search
+  int32 IndexOf(const T& item) const
+  {
+    for (uint32 i = 0; i < m_size; i++)
+    {
+      if (m_pElements[i] == item)
+        return (int32)i;
+    }
+    return -1;
+  }
+
+  // exists in array?
+  bool Contains(const T& item) const { return (IndexOf(item) >= 0); }
+  bool IsEmpty() const { return (m_size == 0); }
+
+  // slow! insert at a specific position of the array
+  void Insert(const T& item, uint32 index)
+  {
+    DebugAssert(index <= m_size);
+
+    // ensure we have room
+    if (m_size == m_reserve)
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + 1));
+
+    // move everything forwards and insert into place
+    std::memmove(m_pElements + index + 1, m_pElements + index, sizeof(T) * (m_size - index));
+    std::memcpy(&m_pElements[index], &item, sizeof(T));
+    m_size++;
+  }
+
+  // zero everything
+  void ZeroContents() { Y_memzero(m_pElements, sizeof(T) * m_reserve); }
+
+  // ensure space exists for the next n elements
+  void EnsureReserve(uint32 n)
+  {
+    if ((m_size + n) > m_reserve)
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + n));
+  }
+
+  // pointer readers, use with care
+  const T* GetBasePointer() const { return m_pElements; }
+  T* GetBasePointer() { return m_pElements; }
+
+  // element accessors
+  const T& FirstElement() const
+  {
+    DebugAssert(m_size > 0);
+    return m_pElements[0];
+  }
+  const T& LastElement() const
+  {
+    DebugAssert(m_size > 0);
+    return m_pElements[m_size - 1];
+  }
+  T& FirstElement()
+  {
+    DebugAssert(m_size > 0);
+    return m_pElements[0];
+  }
+  T& LastElement()
+  {
+    DebugAssert(m_size > 0);
+    return m_pElements[m_size - 1];
+  }
+
+  // element accessor
+  T& GetElement(uint32 i)
+  {
+    DebugAssert(i < m_size);
+    return m_pElements[i];
+  }
+
+  // assignment operator
+  InlinePODArray& operator=(const InlinePODArray& c)
+  {
+    Assign(c);
+    return *this;
+  }
+  InlinePODArray& operator=(InlinePODArray&& c)
+  {
+    Swap(c);
+    return *this;
+  }
+
+  // operator wrappers
+  bool operator==(const InlinePODArray& c) const { return Equals(c); }
+  bool operator!=(const InlinePODArray& c) const { return !Equals(c); }
+  const T& operator[](uint32 index) const { return GetElement(index); }
+  T& operator[](uint32 index) { return GetElement(index); }
+
+  // mainly for range-based for
+  const T* begin() const { return m_pElements; }
+  const T* end() const { return m_pElements + m_size; }
+  T* begin() { return m_pElements; }
+  T* end() { return m_pElements + m_size; }
+
+protected:
+  // points at m_inlineElements until the array outgrows it
+  T* m_pElements;
+  uint32 m_size;
+  uint32 m_reserve;
+  T m_inlineElements[N];
+};
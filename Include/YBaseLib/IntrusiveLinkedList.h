@@ -1,4 +1,5 @@
 #pragma once
+#include "YBaseLib/Assert.h"
 #include "YBaseLib/Common.h"
 #include "YBaseLib/NonCopyable.h"
 
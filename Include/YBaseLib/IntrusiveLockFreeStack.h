@@ -0,0 +1,102 @@
+#pragma once
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+
+// Lock-free intrusive LIFO stack (Treiber stack), any number of threads may push and pop. Node is any type with a
+// Node* next member, such as IntrusiveLinkedList<T>::Node.
+// The top pointer is paired with a count of pops and both are swapped together, so a pop that read the top, lost
+// the race to another pop and then saw the same node pushed back fails instead of linking in a stale next pointer.
+// A pop can still read next from a node another thread has just popped, so nodes must stay readable memory for
+// as long as the stack is in use, for example by only ever moving between stacks and queues, or coming from a pool.
+template<class Node>
+class IntrusiveLockFreeStack
+{
+  DeclareNonCopyable(IntrusiveLockFreeStack);
+
+public:
+  IntrusiveLockFreeStack()
+  {
+    m_top.Words[0] = 0;
+    m_top.Words[1] = 0;
+  }
+
+  void Push(Node* pNode)
+  {
+    TaggedTop top = LoadTop();
+    TaggedTop newTop;
+    do
+    {
+      pNode->next = GetNode(top);
+      newTop.Words[0] = reinterpret_cast<size_t>(pNode);
+      newTop.Words[1] = top.Words[1];
+    } while (!Y_AtomicCompareExchangeDoubleWord(m_top.Words, newTop.Words, top.Words));
+  }
+
+  // pushes a chain of nodes already linked through next, from pFirst to pLast, with one compare-exchange
+  void PushChain(Node* pFirst, Node* pLast)
+  {
+    TaggedTop top = LoadTop();
+    TaggedTop newTop;
+    do
+    {
+      pLast->next = GetNode(top);
+      newTop.Words[0] = reinterpret_cast<size_t>(pFirst);
+      newTop.Words[1] = top.Words[1];
+    } while (!Y_AtomicCompareExchangeDoubleWord(m_top.Words, newTop.Words, top.Words));
+  }
+
+  // returns null if the stack is empty
+  Node* Pop()
+  {
+    TaggedTop top = LoadTop();
+    TaggedTop newTop;
+    for (;;)
+    {
+      Node* pNode = GetNode(top);
+      if (pNode == nullptr)
+        return nullptr;
+
+      newTop.Words[0] = reinterpret_cast<size_t>(Y_AtomicLoadAcquire(pNode->next));
+      newTop.Words[1] = top.Words[1] + 1;
+      if (Y_AtomicCompareExchangeDoubleWord(m_top.Words, newTop.Words, top.Words))
+        return pNode;
+    }
+  }
+
+  // takes every node at once, returned newest first and linked through next
+  Node* PopAll()
+  {
+    TaggedTop top = LoadTop();
+    TaggedTop newTop;
+    do
+    {
+      newTop.Words[0] = 0;
+      newTop.Words[1] = top.Words[1] + 1;
+    } while (GetNode(top) != nullptr && !Y_AtomicCompareExchangeDoubleWord(m_top.Words, newTop.Words, top.Words));
+
+    return GetNode(top);
+  }
+
+  // can be stale by the time it returns
+  bool IsEmpty() const { return (Y_AtomicLoadAcquire(m_top.Words[0]) == 0); }
+
+private:
+  // node pointer and pop count, aligned for the double word compare-exchange
+  struct ALIGN_DECL(2 * sizeof(size_t)) TaggedTop
+  {
+    size_t Words[2];
+  };
+
+  static Node* GetNode(const TaggedTop& top) { return reinterpret_cast<Node*>(top.Words[0]); }
+
+  // the two words can be read separately, a torn read just fails the first compare-exchange and gets refreshed
+  TaggedTop LoadTop() const
+  {
+    TaggedTop top;
+    top.Words[1] = Y_AtomicLoadAcquire(m_top.Words[1]);
+    top.Words[0] = Y_AtomicLoadAcquire(m_top.Words[0]);
+    return top;
+  }
+
+  volatile TaggedTop m_top;
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+
+// Lock-free intrusive FIFO queue, any number of threads may push, one thread at a time may pop (Vyukov's MPSC
+// queue). Node is any type with a Node* next member that the queue is free to overwrite while the node is queued,
+// such as IntrusiveLinkedList<T>::Node. Push is a single exchange, so producers never wait on each other or on the
+// consumer. A push that has swapped in its node but not linked it yet hides every node behind it, so Pop can
+// briefly return null while the queue is not empty, the nodes turn up on a later call.
+template<class Node>
+class IntrusiveMPSCQueue
+{
+  DeclareNonCopyable(IntrusiveMPSCQueue);
+
+public:
+  IntrusiveMPSCQueue() : m_pHead(&m_stub), m_pTail(&m_stub) { m_stub.next = nullptr; }
+
+  // any thread
+  void Push(Node* pNode)
+  {
+    pNode->next = nullptr;
+
+    // the exchange orders the store above before the node can be reached, the release makes it reachable
+    Node* pPrevious = Y_AtomicExchangePointer(m_pHead, pNode);
+    Y_AtomicStoreRelease(pPrevious->next, pNode);
+  }
+
+  // consumer only, returns null if the queue is empty
+  Node* Pop()
+  {
+    Node* pTail = m_pTail;
+    Node* pNext = Y_AtomicLoadAcquire(pTail->next);
+    if (pTail == &m_stub)
+    {
+      if (pNext == nullptr)
+        return nullptr;
+
+      m_pTail = pNext;
+      pTail = pNext;
+      pNext = Y_AtomicLoadAcquire(pNext->next);
+    }
+
+    if (pNext != nullptr)
+    {
+      m_pTail = pNext;
+      return pTail;
+    }
+
+    // the tail is the last linked node. if the head has moved past it a push is in progress, otherwise put the
+    // stub behind it so it can be handed out without leaving the queue without a node.
+    if (pTail != Y_AtomicLoadAcquire(m_pHead))
+      return nullptr;
+
+    Push(&m_stub);
+    pNext = Y_AtomicLoadAcquire(pTail->next);
+    if (pNext == nullptr)
+      return nullptr;
+
+    m_pTail = pNext;
+    return pTail;
+  }
+
+  // consumer only, false can be stale by the time it returns
+  bool IsEmpty() const { return (m_pTail == &m_stub && Y_AtomicLoadAcquire(m_stub.next) == nullptr); }
+
+private:
+  // producers only touch the head, so keep it off the consumer's line
+  Y_ATOMIC_PTR_DECL(Node) m_pHead;
+  byte m_padding[Y_CACHE_LINE_SIZE - sizeof(Node*)];
+  Node* m_pTail;
+  Node m_stub;
+};
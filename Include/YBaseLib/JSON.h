@@ -0,0 +1,193 @@
+#pragma once
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/StringView.h"
+
+enum JSONREADER_TOKEN_TYPE
+{
+  JSONREADER_TOKEN_START_OBJECT,
+  JSONREADER_TOKEN_END_OBJECT,
+  JSONREADER_TOKEN_START_ARRAY,
+  JSONREADER_TOKEN_END_ARRAY,
+  JSONREADER_TOKEN_STRING,
+  JSONREADER_TOKEN_NUMBER,
+  JSONREADER_TOKEN_BOOLEAN,
+  JSONREADER_TOKEN_NULL,
+  JSONREADER_TOKEN_COUNT,
+};
+
+// A pull parser for JSON text, in the style of XMLPullReader: NextToken moves from value to value, with the start
+// and end of objects and arrays as tokens of their own. Inside an object each value has the member's name.
+// A stream that's in memory is read where it is, anything else is read into memory first. Names and values are
+// found without copying: the view accessors point into the stream's memory, and only strings with escapes are
+// decoded, when they're asked for. The const char* accessors copy into a buffer owned by the reader, and stay valid
+// until the next NextToken. The text must be UTF-8, and a single value, usually an object or an array.
+class JSONReader
+{
+public:
+  JSONReader();
+  ~JSONReader();
+
+  bool Create(ByteStream* pInputStream, const char* FileName);
+
+  // Returns false at the end of the document, or once the text isn't JSON.
+  bool NextToken();
+  JSONREADER_TOKEN_TYPE GetTokenType() const { return m_eCurrentTokenType; }
+  const char* GetFileName() const { return m_szFileName; }
+
+  // objects and arrays the token is inside, not counting the one it starts or ends
+  uint32 GetDepth() const;
+
+  // the member's name, or empty outside an object and for the end of a container
+  const char* GetName();
+  StringView GetNameView();
+
+  // A string's text, or a number, boolean or null as it's written. Null for the start and end of containers.
+  const char* GetValue();
+  StringView GetValueView();
+
+  // numbers as they're written, saturating if they're out of range, and zero for anything else
+  bool IsInteger() const { return m_isInteger; }
+  int64 GetInt64() const;
+  uint64 GetUInt64() const;
+  double GetDouble() const;
+  bool GetBool() const { return (m_eCurrentTokenType == JSONREADER_TOKEN_BOOLEAN && m_value.GetData()[0] == 't'); }
+
+  // skips the object or array the token starts, to its end token, or does nothing for other values
+  bool SkipCurrentValue();
+
+  // skips values until a member with the name in the current object, returning false at the end of the object
+  bool SkipToMember(const char* name);
+
+  bool InErrorState() const { return m_bErrorState; }
+
+  void PrintWarning(const char* Format, ...);
+  void PrintError(const char* Format, ...);
+
+private:
+  // A string is a view of the document, without the quotes, until it's decoded, then a view of the copy.
+  bool ReadString(StringView* pText, bool* pHasEscapes);
+  bool ReadNumber();
+  bool ReadLiteral(const char* literal, uint32 length, JSONREADER_TOKEN_TYPE tokenType);
+  bool ReadValue();
+  void SkipWhitespace();
+  bool SyntaxError(const char* Format, ...);
+
+  // makes room for every string of the token to be copied without moving the ones given out already
+  void ResetStrings(uint32 maxLength);
+  const char* CopyString(StringView* pText, bool decode);
+
+  ByteStream* m_pInputStream;
+  const char* m_szFileName;
+
+  // the document, and what's been read of it
+  const char* m_pText;
+  const char* m_pTextEnd;
+  const char* m_pPosition;
+  char* m_pOwnedText;
+
+  // the current token
+  const char* m_pTokenStart;
+  StringView m_name;
+  StringView m_value;
+  const char* m_pNameCopy;
+  const char* m_pValueCopy;
+  bool m_nameHasEscapes;
+  bool m_valueHasEscapes;
+  bool m_isInteger;
+
+  // The open objects and arrays, as '{' or '[', and where the innermost is: after a value, the next thing is a comma
+  // or its end, and after a comma, a value.
+  PODArray<char> m_containers;
+  bool m_afterValue;
+  bool m_afterComma;
+  bool m_rootRead;
+
+  // copies of the token's name and value
+  char* m_pStrings;
+  uint32 m_stringsSize;
+  uint32 m_stringsLength;
+
+  JSONREADER_TOKEN_TYPE m_eCurrentTokenType;
+  bool m_bErrorState;
+
+  DeclareNonCopyable(JSONReader);
+};
+
+// Writes JSON text through a buffer, like XMLWriter. Inside an object, each value is preceded by WriteName. Strings
+// are escaped with runs that need none found 16 bytes at a time, and numbers are formatted straight into the
+// buffer. Floating point values that JSON can't hold, infinities and NaNs, are written as null. Indented output has
+// a member or element per line, four spaces deep, otherwise there's no whitespace at all.
+class JSONWriter
+{
+public:
+  static const uint32 BufferSize = 4096;
+
+  JSONWriter();
+  ~JSONWriter();
+
+  bool InErrorState() const { return m_bErrorState; }
+
+  // Close ends any open objects and arrays and writes out what's buffered.
+  bool Create(ByteStream* pOutputStream, bool indent = true);
+  void Close();
+
+  void StartObject();
+  void EndObject();
+  void StartArray();
+  void EndArray();
+
+  // the name of the next value, which must be in an object
+  void WriteName(const char* name);
+  void WriteName(const char* name, uint32 nameLength);
+
+  void WriteString(const char* value);
+  void WriteString(const char* value, uint32 valueLength);
+  void WriteInt32(int32 value);
+  void WriteUInt32(uint32 value);
+  void WriteInt64(int64 value);
+  void WriteUInt64(uint64 value);
+  void WriteFloat(float value);
+  void WriteDouble(double value);
+  void WriteBool(bool value);
+  void WriteNull();
+
+  // a value that's already JSON, written as is
+  void WriteRaw(const char* value, uint32 valueLength);
+
+private:
+  // Writes what goes before a value: the comma and line break after the last one, or fails if the value can't go
+  // here. Returns false if the writer has failed.
+  bool StartValue();
+  void StartContainer(char open);
+  void EndContainer(char open, char close);
+  void WriteLineBreak();
+  void WriteEscaped(const char* text, uint32 length);
+
+  // copies into the buffer, writing it out as it fills
+  void Write(const char* text, uint32 length);
+
+  // The buffer's free space once there's at least the given size, or NULL if the stream has failed. Text put there
+  // is kept with CommitBuffer.
+  char* ReserveBuffer(uint32 size);
+  void CommitBuffer(uint32 length) { m_bufferLength += length; }
+  bool FlushBuffer();
+
+  ByteStream* m_pOutputStream;
+  bool m_indent;
+
+  // the open objects and arrays, as '{' or '[', whether the innermost has anything in it yet, and whether its next
+  // value has had its name written
+  PODArray<char> m_containers;
+  bool m_containerEmpty;
+  bool m_nameWritten;
+  bool m_rootWritten;
+
+  char m_buffer[BufferSize];
+  uint32 m_bufferLength;
+  bool m_bErrorState;
+
+  DeclareNonCopyable(JSONWriter);
+};
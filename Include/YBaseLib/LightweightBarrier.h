@@ -0,0 +1,29 @@
+#pragma once
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/NonCopyable.h"
+
+// A reusable barrier for a fixed number of threads, with the same interface as Barrier. The last thread to arrive
+// bumps a generation word and the others spin, then sleep with a futex, until it changes. The last arrival only
+// makes a system call when someone has gone to sleep.
+class LightweightBarrier
+{
+  DeclareNonCopyable(LightweightBarrier);
+
+public:
+  LightweightBarrier(uint32 threadCount) : m_threadCount(threadCount), m_arrivedCount(0), m_generation(0), m_sleepers(0)
+  {
+  }
+  ~LightweightBarrier() {}
+
+  const uint32 GetThreadCount() const { return m_threadCount; }
+  void SetThreadCount(uint32 threadCount);
+
+  void Wait();
+
+private:
+  uint32 m_threadCount;
+  Y_ATOMIC_DECL uint32 m_arrivedCount;
+  Y_ATOMIC_DECL uint32 m_generation;
+  Y_ATOMIC_DECL uint32 m_sleepers;
+};
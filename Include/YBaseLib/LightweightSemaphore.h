@@ -0,0 +1,44 @@
+#pragma once
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/NonCopyable.h"
+
+// A counting semaphore kept entirely in user space while it isn't contended. Wait takes a count with a compare
+// exchange, spins a little when there's none, and only then sleeps on the count with a futex. Post only makes a
+// system call when a thread is asleep.
+class LightweightSemaphore
+{
+  DeclareNonCopyable(LightweightSemaphore);
+
+public:
+  LightweightSemaphore(uint32 initialCount = 0) : m_count(initialCount), m_sleepers(0) {}
+  ~LightweightSemaphore() {}
+
+  uint32 GetCount() const { return Y_AtomicLoad(m_count, ATOMIC_MEMORY_ORDER_RELAXED); }
+
+  bool TryWait()
+  {
+    uint32 count = Y_AtomicLoad(m_count, ATOMIC_MEMORY_ORDER_RELAXED);
+    while (count > 0)
+    {
+      if (Y_AtomicTryCompareExchange(m_count, count, count - 1, ATOMIC_MEMORY_ORDER_ACQUIRE))
+        return true;
+    }
+
+    return false;
+  }
+
+  void Wait()
+  {
+    if (!TryWait())
+      WaitSlow();
+  }
+
+  void Post(uint32 count = 1);
+
+private:
+  void WaitSlow();
+
+  Y_ATOMIC_DECL uint32 m_count;
+  Y_ATOMIC_DECL uint32 m_sleepers;
+};
@@ -1,9 +1,15 @@
 #pragma once
+#include "YBaseLib/Allocator.h"
+#include "YBaseLib/Assert.h"
 #include "YBaseLib/Common.h"
+#include <new>
+#include <utility>
 
 // LinkedList implements a double-linked list of type T.
-template<class T>
-class LinkedList
+// Every node is a separate allocation, use PoolAllocator as the allocator to keep them together in slabs, and
+// Compact() to lay them out in list order again once the list has seen a lot of churn.
+template<class T, class AllocatorType = HeapAllocator>
+class LinkedList : private AllocatorType
 {
 private:
   // Node type
@@ -14,11 +20,19 @@ private:
     Node* prev;
   };
 
+  // the item is stored in the same allocation, after the node
+  static const size_t NodeDataOffset = (sizeof(Node) + alignof(T) - 1) & ~(alignof(T) - 1);
+  static const size_t NodeAllocationSize = NodeDataOffset + sizeof(T);
+  static const size_t NodeAlignment = (alignof(T) > alignof(Node)) ? alignof(T) : alignof(Node);
+
   // allocates a node for the specified pointer
   inline Node* AllocNode(const T& data)
   {
-    Node* n = new Node;
-    n->data = new T(data);
+    byte* pMemory = (byte*)GetAllocator().Allocate(NodeAllocationSize, NodeAlignment);
+    Assert(pMemory != NULL);
+
+    Node* n = reinterpret_cast<Node*>(pMemory);
+    n->data = new (pMemory + NodeDataOffset) T(data);
     return n;
   }
 
@@ -35,8 +49,8 @@ private:
       m_tail = n->prev;
 
     m_size--;
-    delete n->data;
-    delete n;
+    n->data->~T();
+    GetAllocator().Free(n, NodeAllocationSize, NodeAlignment);
   }
 
 public:
@@ -184,7 +198,14 @@ public:
     m_size = 0;
   }
 
-  LinkedList(const LinkedList& c)
+  explicit LinkedList(const AllocatorType& allocator) : AllocatorType(allocator)
+  {
+    m_head = NULL;
+    m_tail = NULL;
+    m_size = 0;
+  }
+
+  LinkedList(const LinkedList& c) : AllocatorType(c.GetAllocator())
   {
     m_head = NULL;
     m_tail = NULL;
@@ -203,6 +224,10 @@ public:
       Clear();
   }
 
+  // allocator the nodes come from, copies of the list share a copy of it
+  const AllocatorType& GetAllocator() const { return *this; }
+  AllocatorType& GetAllocator() { return *this; }
+
   // returns an iterator pointing to the head of the list.
   Iterator Begin() { return Iterator(m_head); }
   ConstIterator Begin() const { return ConstIterator(m_head); }
@@ -409,6 +434,39 @@ public:
   // get the current size of the list
   inline uint32 GetSize() const { return m_size; }
 
+  // reallocates every node in list order from a new copy of the allocator, which then replaces the current one.
+  // with a PoolAllocator this packs the nodes next to each other and releases the old slabs. invalidates
+  // iterators, items are moved to their new nodes.
+  void Compact()
+  {
+    AllocatorType compactAllocator(GetAllocator());
+    Node* pPrevious = NULL;
+    Node* n = m_head;
+    while (n != NULL)
+    {
+      byte* pMemory = (byte*)compactAllocator.Allocate(NodeAllocationSize, NodeAlignment);
+      Assert(pMemory != NULL);
+
+      Node* pNewNode = reinterpret_cast<Node*>(pMemory);
+      pNewNode->data = new (pMemory + NodeDataOffset) T(std::move(*n->data));
+      pNewNode->prev = pPrevious;
+      pNewNode->next = NULL;
+      if (pPrevious != NULL)
+        pPrevious->next = pNewNode;
+      else
+        m_head = pNewNode;
+
+      Node* pNextNode = n->next;
+      n->data->~T();
+      GetAllocator().Free(n, NodeAllocationSize, NodeAlignment);
+      pPrevious = pNewNode;
+      n = pNextNode;
+    }
+
+    m_tail = pPrevious;
+    GetAllocator() = std::move(compactAllocator);
+  }
+
 private:
   // list head/tail
   Node* m_head;
@@ -0,0 +1,184 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Timer.h"
+
+// Build with Y_LOCK_PROFILING defined to 1, for the library and everything using it alike, to profile the Mutex,
+// RecursiveMutex and ReadWriteLock instances that have been given a name with SetProfileName. It needs 64-bit
+// atomics, which GCC and Clang builds only have on x64.
+#ifndef Y_LOCK_PROFILING
+#define Y_LOCK_PROFILING 0
+#endif
+
+// Lock contention profiling. Every acquisition of a named lock is counted, and when it had to wait, how long for.
+// Exclusive holds are timed from acquisition to release, less any time spent asleep on a condition variable, shared
+// holds only have their acquisitions counted. Locks with the same name are counted together, so per-instance locks
+// like a socket's show up as one. One in every sample rate contended acquisitions on a thread also records its call
+// stack, so the callers doing the waiting can be found.
+// Without Y_LOCK_PROFILING, names can still be registered but nothing is counted.
+namespace LockProfiler {
+
+static const uint32 MaxLockCount = 128;
+static const uint32 MaxStackFrames = 16;
+
+// Lock 0 is "Unprofiled", and is what's returned once every lock has been used. The name isn't copied, and
+// registering a name twice returns the same lock.
+uint32 RegisterLock(const char* name);
+uint32 GetLockCount();
+
+// records the call stack of 1 in every sampleRate contended acquisitions on each thread, 16 by default, 0 turns
+// sampling off
+void SetSampleRate(uint32 sampleRate);
+uint32 GetSampleRate();
+
+// times are in nanoseconds
+struct LockStats
+{
+  const char* Name;
+  uint64 Acquisitions;
+  uint64 ContendedAcquisitions;
+  uint64 TotalWaitTime;
+  uint64 MaxWaitTime;
+  uint64 TotalHoldTime;
+  uint64 MaxHoldTime;
+};
+
+// returns false for locks that haven't been registered
+bool GetLockStats(uint32 lock, LockStats* pStats);
+
+struct StackSample
+{
+  uint32 Lock;
+  uint32 FrameCount;
+  void* Frames[MaxStackFrames];
+
+  // contended acquisitions sampled from this stack, and the nanoseconds they waited
+  uint64 SampleCount;
+  uint64 SampledWaitTime;
+};
+
+// copies out up to maxSamples recorded stacks, longest sampled wait first, returning the number copied
+uint32 GetStackSamples(StackSample* pSamples, uint32 maxSamples);
+
+// zeroes every lock's counters and forgets the sampled stacks, e.g. between phases of a benchmark
+void Reset();
+
+// logs every lock that has been acquired, most time spent waiting first, followed by the sampled stacks that
+// waited longest as raw return addresses
+void Dump(uint32 maxStacks = 10);
+
+// sets lock.<name>.acquisitions, .contended, .wait_ns, .max_wait_ns, .hold_ns and .max_hold_ns gauges in the
+// metrics registry, for every lock that has been acquired
+void PublishMetrics();
+
+// bookkeeping for LockProfile, times are in Y_FastTimerGetValue ticks
+void OnAcquired(uint32 lock, bool contended, Y_TIMER_VALUE waitTime);
+void OnReleased(uint32 lock, Y_TIMER_VALUE holdTime);
+
+}; // namespace LockProfiler
+
+#if Y_LOCK_PROFILING
+
+// What a profiled lock keeps, the lock it's counted as and, for exclusive holds, when it was taken. Only the
+// thread holding the lock exclusively touches the depth and acquire time, so they need no synchronization.
+class LockProfile
+{
+public:
+  LockProfile() : m_lock(0), m_depth(0), m_acquireTime(0) {}
+
+  bool IsEnabled() const { return (m_lock != 0); }
+
+  // should be set before the lock is first used
+  void SetName(const char* name) { m_lock = LockProfiler::RegisterLock(name); }
+
+  // takes the lock exclusively with tryLock, falling back to lock and timing the wait when that fails
+  template<class TryLockFunction, class LockFunction>
+  void Acquire(const TryLockFunction& tryLock, const LockFunction& lock)
+  {
+    Y_TIMER_VALUE waitStart = 0;
+    bool contended = !tryLock();
+    if (contended)
+    {
+      waitStart = Y_FastTimerGetValue();
+      lock();
+    }
+
+    // recursive acquisitions by the holder are neither counted nor timed
+    Y_TIMER_VALUE now = Y_FastTimerGetValue();
+    if (m_depth++ == 0)
+    {
+      LockProfiler::OnAcquired(m_lock, contended, contended ? (now - waitStart) : 0);
+      m_acquireTime = now;
+    }
+  }
+
+  // as Acquire, without timing the hold, as there can be any number of them
+  template<class TryLockFunction, class LockFunction>
+  void AcquireShared(const TryLockFunction& tryLock, const LockFunction& lock)
+  {
+    if (tryLock())
+    {
+      LockProfiler::OnAcquired(m_lock, false, 0);
+      return;
+    }
+
+    Y_TIMER_VALUE waitStart = Y_FastTimerGetValue();
+    lock();
+    LockProfiler::OnAcquired(m_lock, true, Y_FastTimerGetValue() - waitStart);
+  }
+
+  // after a successful TryLock
+  void OnTryAcquired()
+  {
+    if (IsEnabled() && m_depth++ == 0)
+    {
+      LockProfiler::OnAcquired(m_lock, false, 0);
+      m_acquireTime = Y_FastTimerGetValue();
+    }
+  }
+
+  void OnTryAcquiredShared()
+  {
+    if (IsEnabled())
+      LockProfiler::OnAcquired(m_lock, false, 0);
+  }
+
+  // before an exclusive hold is released, does nothing for holds that started before the lock was named
+  void Release()
+  {
+    if (m_depth != 0 && --m_depth == 0)
+      LockProfiler::OnReleased(m_lock, Y_FastTimerGetValue() - m_acquireTime);
+  }
+
+  // a condition variable releases the lock while it sleeps, so the hold ends before and starts again after
+  void BeginConditionWait()
+  {
+    if (m_depth != 0)
+      LockProfiler::OnReleased(m_lock, Y_FastTimerGetValue() - m_acquireTime);
+  }
+
+  void EndConditionWait()
+  {
+    if (m_depth != 0)
+      m_acquireTime = Y_FastTimerGetValue();
+  }
+
+private:
+  uint32 m_lock;
+  uint32 m_depth;
+  Y_TIMER_VALUE m_acquireTime;
+};
+
+// for condition variables, pauses the hold on the lock they sleep on for the lifetime of the object
+class LockProfileConditionWait
+{
+public:
+  LockProfileConditionWait(LockProfile& profile) : m_profile(profile) { m_profile.BeginConditionWait(); }
+  ~LockProfileConditionWait() { m_profile.EndConditionWait(); }
+
+private:
+  LockProfile& m_profile;
+
+  DeclareNonCopyable(LockProfileConditionWait);
+};
+
+#endif // Y_LOCK_PROFILING
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "YBaseLib/Common.h"
+#include "YBaseLib/Event.h"
 #include "YBaseLib/MemArray.h"
 #include "YBaseLib/Mutex.h"
 #include "YBaseLib/Singleton.h"
+#include "YBaseLib/StringHashTable.h"
+#include "YBaseLib/TypedFormat.h"
 #include <cinttypes>
 
 enum LOGLEVEL
@@ -21,6 +24,32 @@ enum LOGLEVEL
   LOGLEVEL_COUNT = 10
 };
 
+class BinaryLogWriter;
+class ByteStream;
+class FlightRecorderLogSink;
+struct LogThreadBuffer;
+
+// A channel declared with Log_SetChannel. The log keeps the levels each channel's messages pass in a mask, from the
+// filter level and the channel's own, which the macros test before evaluating any arguments, so a filtered message
+// costs a load and a branch. Channels register themselves when constructed and stay registered for the life of the
+// process.
+class LogChannel
+{
+public:
+  LogChannel(const char* name);
+
+  const char* GetName() const { return m_name; }
+  bool IsLevelEnabled(LOGLEVEL level) const { return ((m_levelMask & (1u << level)) != 0); }
+
+private:
+  const char* m_name;
+  volatile uint32 m_levelMask;
+  LogChannel* m_pNext;
+
+  friend class Log;
+  DeclareNonCopyable(LogChannel);
+};
+
 class Log : public Singleton<Log>
 {
 public:
@@ -46,16 +75,70 @@ public:
   // Sets global filtering level, messages below this level won't be sent to any of the logging sinks.
   void SetFilterLevel(LOGLEVEL level);
 
+  // Filters a channel's messages at a level of its own, on top of the global level, LOGLEVEL_COUNT clears it. This
+  // is the channel's mask the macros test, so unlike the sinks' channel filters, filtered messages never get as far
+  // as the log. Direct calls to Write aren't filtered by channel.
+  void SetChannelFilterLevel(const char* channelName, LOGLEVEL level);
+
+  // Runs the callbacks on a thread of their own, so a slow sink doesn't hold up the threads logging. Each thread
+  // formats into a lock-free buffer of its own, which the log thread drains oldest first every AsyncFlushInterval
+  // milliseconds, and sooner for warnings, errors or a buffer getting full. When a buffer is full, errors wait for
+  // room and anything else is dropped, with the number dropped reported as a warning. Messages longer than a
+  // quarter of the buffer are cut short. The log thread's own messages go to the callbacks directly.
+  static const uint32 DefaultAsyncBufferSize = 65536;
+  static const uint32 AsyncFlushInterval = 10;
+  void SetAsyncOutput(bool enabled, uint32 threadBufferSize = DefaultAsyncBufferSize);
+  bool IsAsyncOutputEnabled() const { return m_asyncOutputEnabled; }
+
+  // Writes messages at the levels in levelMask, a bit for each, to the stream as their format strings and raw
+  // arguments, in place of running the callbacks, so the threads logging don't format them. See BinaryLog.h for
+  // reading them back. Messages that can't be kept that way, with printf conversions like %n or wide strings, or
+  // typed arguments with custom formatters, are formatted and go to the callbacks as usual, as does everything once
+  // a write to the stream fails. The stream should be buffered, a null stream stops the binary output. Returns
+  // false if the header couldn't be written.
+  static const uint32 DefaultBinaryOutputLevels = (1 << LOGLEVEL_PERF) | (1 << LOGLEVEL_PROFILE);
+  bool SetBinaryOutput(ByteStream* pStream, uint32 levelMask = DefaultBinaryOutputLevels);
+
+  // Copies every formatted message into the recorder on the thread logging it, ahead of async output and the
+  // callbacks, see FlightRecorderLogSink.h. The recorder sets and clears itself, null stops the recording.
+  void SetFlightRecorder(FlightRecorderLogSink* pFlightRecorder) { m_pFlightRecorder = pFlightRecorder; }
+
+  // Runs the callbacks for everything buffered for async output, and flushes the binary output, before returning.
+  // Panics and failed assertions flush first, as does destroying the log. Shutdown can destroy it with DestroyInstance
+  // once the threads logging have stopped, rather than leaving it to whenever it comes up at exit.
+  void Flush();
+
+  // Frees the calling thread's async buffer once it has been drained. Thread releases it when a thread exits,
+  // threads started any other way should call ReleaseThreadBuffer before exiting.
+  static void ReleaseThreadBuffer();
+
   // writes a message to the log
   void Write(const char* channelName, const char* functionName, LOGLEVEL level, const char* message);
   void Writef(const char* channelName, const char* functionName, LOGLEVEL level, const char* format, ...);
   void Writev(const char* channelName, const char* functionName, LOGLEVEL level, const char* format, va_list ap);
 
+  // type-safe formatted message, see TypedFormat.h. nothing is formatted if the level is filtered out.
+  template<typename... Args>
+  void WriteFormat(const char* channelName, const char* functionName, LOGLEVEL level, const StringView& format,
+                   const Args&... args)
+  {
+    if (level > m_filterLevel)
+      return;
+
+    const TypedFormat::Argument arguments[] = {TypedFormat::MakeArgument(args)..., TypedFormat::Argument()};
+    WriteFormatted(channelName, functionName, level, format, arguments, sizeof...(Args));
+  }
+
   // formats a log message for display, involves multiple print calls
   static void FormatLogMessageForDisplay(const char* channelName, const char* functionName, LOGLEVEL level,
                                          const char* message, void (*printCallback)(const char*, void*),
                                          void* pCallbackUserData = nullptr);
 
+  // the same, for a message written messageTime seconds after the log started
+  static void FormatLogMessageForDisplay(const char* channelName, const char* functionName, LOGLEVEL level,
+                                         double messageTime, const char* message,
+                                         void (*printCallback)(const char*, void*), void* pCallbackUserData = nullptr);
+
 private:
   struct RegisteredCallback
   {
@@ -69,7 +152,50 @@ private:
 
   LOGLEVEL m_filterLevel;
 
+  // channel levels, the lock is held to change them or the masks
+  StringHashTable<LOGLEVEL> m_channelFilterLevels;
+  Mutex m_channelLock;
+
+  // recomputes the channel's mask, with the channel lock held
+  void UpdateChannelLevelMask(LogChannel* pChannel);
+  void RegisterChannel(LogChannel* pChannel);
+
+  friend class LogChannel;
+
+  // async output, the buffers are only freed once released by their threads, or with the log
+  class AsyncOutputThread;
+  AsyncOutputThread* m_pAsyncOutputThread;
+  volatile bool m_asyncOutputEnabled;
+  uint32 m_asyncBufferSize;
+  LogThreadBuffer* m_pAsyncThreadBuffers;
+  Mutex m_asyncThreadBufferLock;
+  Mutex m_asyncDrainLock;
+  Event m_asyncWakeEvent;
+
+  // binary output, the writer is only used with the lock held
+  BinaryLogWriter* m_pBinaryOutput;
+  volatile uint32 m_binaryOutputLevels;
+  Mutex m_binaryOutputLock;
+
+  // flight recorder, used without a lock
+  FlightRecorderLogSink* volatile m_pFlightRecorder;
+
+  bool IsBinaryOutputLevel(LOGLEVEL level) const { return ((m_binaryOutputLevels & (1u << level)) != 0); }
+
+  // Queues on the calling thread's buffer when async output is on, otherwise runs the callbacks.
+  void Dispatch(const char* channelName, const char* functionName, LOGLEVEL level, const char* message,
+                uint32 messageLength);
+  bool QueueAsync(const char* channelName, const char* functionName, LOGLEVEL level, const char* message,
+                  uint32 messageLength);
+  LogThreadBuffer* GetAsyncThreadBuffer();
+
+  // Runs the callbacks for the buffered messages up to now, oldest first across the threads, with the drain lock
+  // held. Reports drops and frees released buffers that are empty.
+  void DrainAsyncBuffers();
+
   void ExecuteCallbacks(const char* channelName, const char* functionName, LOGLEVEL level, const char* message);
+  void WriteFormatted(const char* channelName, const char* functionName, LOGLEVEL level, const StringView& format,
+                      const TypedFormat::Argument* pArguments, uint32 argumentCount);
 };
 
 extern Log* g_pLog;
@@ -80,43 +206,141 @@ extern Log* g_pLog;
 #define LOG_MESSAGE_FUNCTION_NAME __FUNCTION__
 #endif
 
-// log wrappers
-#define Log_SetChannel(ChannelName) static const char* ___LogChannel___ = #ChannelName;
-#define Log_ErrorPrint(msg) Log::GetInstance().Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_ERROR, msg)
+// The most verbose level compiled in, as a number so the preprocessor can test it. Messages past it are compiled
+// out, and Debug and Trace messages aren't compiled at all, arguments included.
+#ifndef Y_LOG_MAX_LEVEL
+#ifdef Y_BUILD_CONFIG_RELEASE
+#define Y_LOG_MAX_LEVEL 7 // LOGLEVEL_PROFILE
+#else
+#define Y_LOG_MAX_LEVEL 9 // LOGLEVEL_TRACE
+#endif
+#endif
+
+// log wrappers, the arguments are only evaluated if the channel passes the level
+#define Log_SetChannel(ChannelName)                                                                                    \
+  static LogChannel ___LogChannelState___(#ChannelName);                                                               \
+  static const char* ___LogChannel___ = #ChannelName;
+
+#define Y_LOG_MESSAGE(level, call)                                                                                     \
+  MULTI_STATEMENT_MACRO_BEGIN                                                                                          \
+  if ((level) <= Y_LOG_MAX_LEVEL && ___LogChannelState___.IsLevelEnabled(level))                                       \
+    Log::GetInstance().call;                                                                                           \
+  MULTI_STATEMENT_MACRO_END
+
+#define Log_ErrorPrint(msg)                                                                                            \
+  Y_LOG_MESSAGE(LOGLEVEL_ERROR, Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_ERROR, msg))
 #define Log_ErrorPrintf(...)                                                                                           \
-  Log::GetInstance().Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_ERROR, __VA_ARGS__)
+  Y_LOG_MESSAGE(LOGLEVEL_ERROR, Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_ERROR, __VA_ARGS__))
+
 #define Log_WarningPrint(msg)                                                                                          \
-  Log::GetInstance().Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_WARNING, msg)
+  Y_LOG_MESSAGE(LOGLEVEL_WARNING, Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_WARNING, msg))
 #define Log_WarningPrintf(...)                                                                                         \
-  Log::GetInstance().Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_WARNING, __VA_ARGS__)
+  Y_LOG_MESSAGE(LOGLEVEL_WARNING, Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_WARNING, __VA_ARGS__))
+
 #define Log_SuccessPrint(msg)                                                                                          \
-  Log::GetInstance().Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_SUCCESS, msg)
+  Y_LOG_MESSAGE(LOGLEVEL_SUCCESS, Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_SUCCESS, msg))
 #define Log_SuccessPrintf(...)                                                                                         \
-  Log::GetInstance().Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_SUCCESS, __VA_ARGS__)
-#define Log_InfoPrint(msg) Log::GetInstance().Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_INFO, msg)
+  Y_LOG_MESSAGE(LOGLEVEL_SUCCESS, Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_SUCCESS, __VA_ARGS__))
+
+#define Log_InfoPrint(msg)                                                                                             \
+  Y_LOG_MESSAGE(LOGLEVEL_INFO, Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_INFO, msg))
 #define Log_InfoPrintf(...)                                                                                            \
-  Log::GetInstance().Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_INFO, __VA_ARGS__)
-#define Log_PerfPrint(msg) Log::GetInstance().Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_PERF, msg)
+  Y_LOG_MESSAGE(LOGLEVEL_INFO, Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_INFO, __VA_ARGS__))
+
+#define Log_PerfPrint(msg)                                                                                             \
+  Y_LOG_MESSAGE(LOGLEVEL_PERF, Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_PERF, msg))
 #define Log_PerfPrintf(...)                                                                                            \
-  Log::GetInstance().Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_PERF, __VA_ARGS__)
-#define Log_DevPrint(msg) Log::GetInstance().Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_DEV, msg)
+  Y_LOG_MESSAGE(LOGLEVEL_PERF, Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_PERF, __VA_ARGS__))
+
+#define Log_DevPrint(msg)                                                                                              \
+  Y_LOG_MESSAGE(LOGLEVEL_DEV, Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_DEV, msg))
 #define Log_DevPrintf(...)                                                                                             \
-  Log::GetInstance().Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_DEV, __VA_ARGS__)
+  Y_LOG_MESSAGE(LOGLEVEL_DEV, Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_DEV, __VA_ARGS__))
+
 #define Log_ProfilePrint(msg)                                                                                          \
-  Log::GetInstance().Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_PROFILE, msg)
+  Y_LOG_MESSAGE(LOGLEVEL_PROFILE, Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_PROFILE, msg))
 #define Log_ProfilePrintf(...)                                                                                         \
-  Log::GetInstance().Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_PROFILE, __VA_ARGS__)
+  Y_LOG_MESSAGE(LOGLEVEL_PROFILE, Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_PROFILE, __VA_ARGS__))
 
-#ifdef Y_BUILD_CONFIG_RELEASE
+#if Y_LOG_MAX_LEVEL < 8
 #define Log_DebugPrint(msg) MULTI_STATEMENT_MACRO_BEGIN MULTI_STATEMENT_MACRO_END
 #define Log_DebugPrintf(...) MULTI_STATEMENT_MACRO_BEGIN MULTI_STATEMENT_MACRO_END
+#else
+#define Log_DebugPrint(msg)                                                                                            \
+  Y_LOG_MESSAGE(LOGLEVEL_DEBUG, Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_DEBUG, msg))
+#define Log_DebugPrintf(...)                                                                                           \
+  Y_LOG_MESSAGE(LOGLEVEL_DEBUG, Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_DEBUG, __VA_ARGS__))
+#endif
+
+#if Y_LOG_MAX_LEVEL < 9
 #define Log_TracePrint(msg) MULTI_STATEMENT_MACRO_BEGIN MULTI_STATEMENT_MACRO_END
 #define Log_TracePrintf(...) MULTI_STATEMENT_MACRO_BEGIN MULTI_STATEMENT_MACRO_END
 #else
-#define Log_DebugPrint(msg) Log::GetInstance().Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_DEBUG, msg)
-#define Log_DebugPrintf(...)                                                                                           \
-  Log::GetInstance().Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_DEBUG, __VA_ARGS__)
-#define Log_TracePrint(msg) Log::GetInstance().Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_TRACE, msg)
+#define Log_TracePrint(msg)                                                                                            \
+  Y_LOG_MESSAGE(LOGLEVEL_TRACE, Write(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_TRACE, msg))
 #define Log_TracePrintf(...)                                                                                           \
-  Log::GetInstance().Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_TRACE, __VA_ARGS__)
+  Y_LOG_MESSAGE(LOGLEVEL_TRACE, Writef(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_TRACE, __VA_ARGS__))
+#endif
+
+// type-safe wrappers, the format string must be a literal and is checked against the arguments at compile time
+#define Log_ErrorFmt(...)                                                                                              \
+  MULTI_STATEMENT_MACRO_BEGIN                                                                                          \
+  Y_CHECK_FORMAT(__VA_ARGS__);                                                                                         \
+  Y_LOG_MESSAGE(LOGLEVEL_ERROR,                                                                                        \
+                WriteFormat(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_ERROR, __VA_ARGS__));                \
+  MULTI_STATEMENT_MACRO_END
+#define Log_WarningFmt(...)                                                                                            \
+  MULTI_STATEMENT_MACRO_BEGIN                                                                                          \
+  Y_CHECK_FORMAT(__VA_ARGS__);                                                                                         \
+  Y_LOG_MESSAGE(LOGLEVEL_WARNING,                                                                                      \
+                WriteFormat(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_WARNING, __VA_ARGS__));              \
+  MULTI_STATEMENT_MACRO_END
+#define Log_SuccessFmt(...)                                                                                            \
+  MULTI_STATEMENT_MACRO_BEGIN                                                                                          \
+  Y_CHECK_FORMAT(__VA_ARGS__);                                                                                         \
+  Y_LOG_MESSAGE(LOGLEVEL_SUCCESS,                                                                                      \
+                WriteFormat(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_SUCCESS, __VA_ARGS__));              \
+  MULTI_STATEMENT_MACRO_END
+#define Log_InfoFmt(...)                                                                                               \
+  MULTI_STATEMENT_MACRO_BEGIN                                                                                          \
+  Y_CHECK_FORMAT(__VA_ARGS__);                                                                                         \
+  Y_LOG_MESSAGE(LOGLEVEL_INFO, WriteFormat(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_INFO, __VA_ARGS__));  \
+  MULTI_STATEMENT_MACRO_END
+#define Log_PerfFmt(...)                                                                                               \
+  MULTI_STATEMENT_MACRO_BEGIN                                                                                          \
+  Y_CHECK_FORMAT(__VA_ARGS__);                                                                                         \
+  Y_LOG_MESSAGE(LOGLEVEL_PERF, WriteFormat(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_PERF, __VA_ARGS__));  \
+  MULTI_STATEMENT_MACRO_END
+#define Log_DevFmt(...)                                                                                                \
+  MULTI_STATEMENT_MACRO_BEGIN                                                                                          \
+  Y_CHECK_FORMAT(__VA_ARGS__);                                                                                         \
+  Y_LOG_MESSAGE(LOGLEVEL_DEV, WriteFormat(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_DEV, __VA_ARGS__));    \
+  MULTI_STATEMENT_MACRO_END
+#define Log_ProfileFmt(...)                                                                                            \
+  MULTI_STATEMENT_MACRO_BEGIN                                                                                          \
+  Y_CHECK_FORMAT(__VA_ARGS__);                                                                                         \
+  Y_LOG_MESSAGE(LOGLEVEL_PROFILE,                                                                                      \
+                WriteFormat(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_PROFILE, __VA_ARGS__));              \
+  MULTI_STATEMENT_MACRO_END
+
+#if Y_LOG_MAX_LEVEL < 8
+#define Log_DebugFmt(...) MULTI_STATEMENT_MACRO_BEGIN MULTI_STATEMENT_MACRO_END
+#else
+#define Log_DebugFmt(...)                                                                                              \
+  MULTI_STATEMENT_MACRO_BEGIN                                                                                          \
+  Y_CHECK_FORMAT(__VA_ARGS__);                                                                                         \
+  Y_LOG_MESSAGE(LOGLEVEL_DEBUG,                                                                                        \
+                WriteFormat(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_DEBUG, __VA_ARGS__));                \
+  MULTI_STATEMENT_MACRO_END
+#endif
+
+#if Y_LOG_MAX_LEVEL < 9
+#define Log_TraceFmt(...) MULTI_STATEMENT_MACRO_BEGIN MULTI_STATEMENT_MACRO_END
+#else
+#define Log_TraceFmt(...)                                                                                              \
+  MULTI_STATEMENT_MACRO_BEGIN                                                                                          \
+  Y_CHECK_FORMAT(__VA_ARGS__);                                                                                         \
+  Y_LOG_MESSAGE(LOGLEVEL_TRACE,                                                                                        \
+                WriteFormat(___LogChannel___, LOG_MESSAGE_FUNCTION_NAME, LOGLEVEL_TRACE, __VA_ARGS__));                \
+  MULTI_STATEMENT_MACRO_END
 #endif
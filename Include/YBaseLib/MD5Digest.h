@@ -7,9 +7,11 @@
 class MD5Digest
 {
 public:
+  static const uint32 DIGEST_SIZE = 16;
+
   MD5Digest();
 
-  void Update(const void* pData, uint32 cbData);
+  void Update(const void* pData, size_t cbData);
   void Final(byte Digest[16]);
   void Reset();
 
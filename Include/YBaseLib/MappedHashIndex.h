@@ -0,0 +1,129 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/StringView.h"
+
+class BinaryBlob;
+class ByteStream;
+
+// A read-only string-keyed index kept on disk in the form it's searched in, so opening one doesn't insert anything.
+// The image is an open addressed table of fixed size slots followed by a pool of keys and values, located by offset,
+// and lookups run straight on the mapped file, paging in only the slots and entries they touch. Keys are hashed
+// with XXH64, which is the same in every version, and the image is little endian.
+//   MappedHashIndexWriter writer;
+//   writer.Add("textures/stone.dds", &location, sizeof(location));
+//   writer.WriteFile("assets.hashindex");
+//
+//   MappedHashIndex index;
+//   index.OpenFile("assets.hashindex");
+//   const AssetLocation* pLocation = index.FindValue<AssetLocation>("textures/stone.dds");
+
+namespace MappedHashIndexFormat {
+static const uint32 Magic = 0x58494859; // 'YHIX'
+static const uint32 Version = 1;
+
+// values start on this boundary from the start of the image
+static const uint32 ValueAlignment = 8;
+
+struct Header
+{
+  uint32 Magic;
+  uint32 Version;
+
+  // a power of two, and more than the entries, so there's always an empty slot to end a probe
+  uint32 SlotCount;
+  uint32 EntryCount;
+
+  // the pool follows the slots, which follow the header
+  uint64 PoolSize;
+  uint64 Reserved;
+};
+
+// Empty if the tag is zero. The tag is the top half of the key's hash, never zero otherwise, and the bottom half
+// picks the slot a probe starts at. An entry is its value's size, the key and a terminating zero, then the value on
+// the next aligned offset.
+struct Slot
+{
+  uint32 Tag;
+  uint32 KeyLength;
+  uint64 EntryOffset;
+};
+} // namespace MappedHashIndexFormat
+
+// Builds an index in memory, to be written out whole.
+class MappedHashIndexWriter
+{
+public:
+  MappedHashIndexWriter();
+  ~MappedHashIndexWriter();
+
+  uint32 GetEntryCount() const { return m_entryCount; }
+
+  // Returns false if the key's already there, which keeps its first value.
+  bool Add(const StringView& key, const void* pValue, uint32 valueSize);
+  template<typename T>
+  bool Add(const StringView& key, const T& value)
+  {
+    return Add(key, &value, sizeof(T));
+  }
+
+  void Clear();
+
+  bool Write(ByteStream* pStream) const;
+
+  // replaces the file only once it's complete
+  bool WriteFile(const char* fileName) const;
+
+private:
+  // the slot holding the key, or the empty one it'd go in
+  uint32 FindSlot(const char* pKey, uint32 keyLength, uint64 hash) const;
+  void Grow();
+
+  PODArray<MappedHashIndexFormat::Slot> m_slots;
+  PODArray<byte> m_pool;
+  uint32 m_entryCount;
+
+  DeclareNonCopyable(MappedHashIndexWriter);
+};
+
+// An index opened from a file or stream. Lookups can be made from any number of threads at once, and what they
+// return lasts until the index is closed.
+class MappedHashIndex
+{
+public:
+  MappedHashIndex();
+  ~MappedHashIndex();
+
+  // Uses the stream's memory in place when it has any (see ByteStream::GetBasePointer), which files opened with
+  // BYTESTREAM_OPEN_MAPPED do, holding a reference to it. Other streams are read in whole. Only the header and the
+  // image's size are checked up front, entries are checked as they're reached, so a damaged image can't be read
+  // past the end of.
+  bool Open(ByteStream* pStream);
+  bool OpenFile(const char* fileName);
+  void Close();
+
+  bool IsOpen() const { return (m_pImage != nullptr); }
+  uint32 GetEntryCount() const { return (m_pHeader != nullptr) ? m_pHeader->EntryCount : 0; }
+
+  // The value, aligned to ValueAlignment from the start of the image, or null if the key's not there.
+  const void* Find(const StringView& key, uint32* pValueSize = nullptr) const;
+  bool Contains(const StringView& key) const { return (Find(key) != nullptr); }
+
+  // null if the key's not there, or its value isn't a T
+  template<typename T>
+  const T* FindValue(const StringView& key) const
+  {
+    uint32 valueSize;
+    const void* pValue = Find(key, &valueSize);
+    return (pValue != nullptr && valueSize == sizeof(T)) ? static_cast<const T*>(pValue) : nullptr;
+  }
+
+private:
+  BinaryBlob* m_pImage;
+  const MappedHashIndexFormat::Header* m_pHeader;
+  const MappedHashIndexFormat::Slot* m_pSlots;
+  const byte* m_pPool;
+  uint32 m_slotMask;
+
+  DeclareNonCopyable(MappedHashIndex);
+};
@@ -5,14 +5,37 @@
 #include <cstring>
 
 void Y_memzero(void* pDestination, size_t ByteCount);
+// Copies Count elements of Size bytes between strided arrays. 1, 2, 4, 8, 12 and 16 byte elements have their
+// own loops, and packing 4 byte elements out of an 8 or 16 byte stride is done with SSE2/NEON shuffles.
 void Y_memcpy_stride(void* pDestination, size_t DestinationStride, const void* pSource, size_t SourceStride,
                      size_t Size, size_t Count);
+
+// Same as Y_memcpy_stride, using non-temporal stores where possible so a large destination that won't be read
+// again soon doesn't push everything else out of the cache.
+void Y_memcpy_stride_streaming(void* pDestination, size_t DestinationStride, const void* pSource,
+                               size_t SourceStride, size_t Size, size_t Count);
 int32 Y_memcmp_stride(const void* pMem1, size_t mem1Stride, const void* pMem2, size_t mem2Stride, size_t elementSize,
                       size_t count);
 
+// Build with Y_THREAD_CACHED_MALLOC defined to 1 to serve these from ThreadCachedHeap instead of the C heap, which
+// avoids the C heap's locks when many threads allocate at once. Memory from any of these has to go back through
+// Y_free or Y_aligned_free, never std::free.
+#ifndef Y_THREAD_CACHED_MALLOC
+#define Y_THREAD_CACHED_MALLOC 0
+#endif
+
+// Build with Y_MEMORY_TRACKING defined to 1 to count these allocations by tag and sample their call stacks, see
+// MemoryTracker. It needs 64-bit atomics, which GCC and Clang builds only have on x64.
+#ifndef Y_MEMORY_TRACKING
+#define Y_MEMORY_TRACKING 0
+#endif
+
+void* Y_malloc(size_t size);
 void* Y_malloczero(size_t size);
 void* Y_mallocarray(size_t num, size_t size);
+void* Y_realloc(void* ptr, size_t size);
 void* Y_reallocarray(void* ptr, size_t num, size_t size);
+void Y_free(void* ptr);
 
 // aligned malloc variants
 void* Y_aligned_malloc(size_t size, size_t alignment);
@@ -22,6 +45,19 @@ void* Y_aligned_realloc(void* ptr, size_t size, size_t alignment);
 void* Y_aligned_reallocarray(void* ptr, size_t num, size_t size, size_t alignment);
 void Y_aligned_free(void* ptr);
 
+// Placement hints for big, long-lived allocations. HUGE_PAGES asks for the memory to be backed by huge pages, which
+// cuts TLB misses on large tables walked at random. NUMA_LOCAL keeps the memory on the calling thread's node even
+// when other threads touch it first. Both only apply to the whole pages inside an allocation, so they do nothing
+// for small ones, and are ignored where the platform can't do them, see Platform::AdviseMemory.
+enum Y_MALLOC_FLAGS
+{
+  Y_MALLOC_FLAG_HUGE_PAGES = (1 << 0),
+  Y_MALLOC_FLAG_NUMA_LOCAL = (1 << 1),
+};
+
+// Y_aligned_malloc with Y_MALLOC_FLAGS, freed with Y_aligned_free
+void* Y_aligned_malloc_flags(size_t size, size_t alignment, uint32 flags);
+
 #define Y_SSE_ALIGNMENT 16
 
 void Y_qsort(void* pBase, size_t nElements, size_t ElementSize, int (*CompareFunction)(const void*, const void*));
@@ -64,7 +100,7 @@ void Y_memzeroT(T* pDestination, uint32 uCount)
 template<typename T>
 T* Y_mallocT(size_t nCount = 1)
 {
-  return (T*)std::malloc(sizeof(T) * nCount);
+  return (T*)Y_malloc(sizeof(T) * nCount);
 }
 template<typename T>
 T* Y_malloczeroT(size_t nCount = 1)
@@ -74,7 +110,7 @@ T* Y_malloczeroT(size_t nCount = 1)
 template<typename T>
 T* Y_reallocT(T* pMemory, size_t nNewCount)
 {
-  return (T*)std::realloc(pMemory, sizeof(T) * nNewCount);
+  return (T*)Y_realloc(pMemory, sizeof(T) * nNewCount);
 }
 template<typename T>
 T* Y_aligned_mallocT(size_t nCount, size_t uAlignment)
@@ -87,6 +123,23 @@ T* Y_aligned_malloczeroT(size_t nCount, size_t uAlignment)
   return (T*)Y_aligned_malloczero(sizeof(T) * nCount, uAlignment);
 }
 
+// Number of elements an array grows to when it needs room for requiredSize, the larger of that and
+// Y_ARRAY_GROWTH_PERCENT of the current size. Memory-constrained targets grow by 1.5x to waste less on
+// slack, everything else doubles. Define Y_ARRAY_GROWTH_PERCENT project-wide to override it.
+#ifndef Y_ARRAY_GROWTH_PERCENT
+#if defined(Y_PLATFORM_ANDROID) || defined(Y_PLATFORM_HTML5)
+#define Y_ARRAY_GROWTH_PERCENT 150
+#else
+#define Y_ARRAY_GROWTH_PERCENT 200
+#endif
+#endif
+
+static inline uint32 Y_GetArrayGrowthSize(uint32 currentSize, uint32 requiredSize)
+{
+  uint64 grownSize = Min((uint64)currentSize * Y_ARRAY_GROWTH_PERCENT / 100, (uint64)0xFFFFFFFF);
+  return Max((uint32)grownSize, requiredSize);
+}
+
 // other templates
 template<typename T>
 void Y_qsortT(T* pBase, size_t nElements, int (*CompareFunction)(const T*, const T*))
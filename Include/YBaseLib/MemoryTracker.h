@@ -0,0 +1,75 @@
+#pragma once
+#include "YBaseLib/Common.h"
+
+// Heap profiling for the Y_malloc and Y_aligned_* functions, compiled in with Y_MEMORY_TRACKING.
+// Every allocation is charged to the calling thread's current tag, and one in every sample rate allocations on
+// a thread also records its call stack, so hot spots like container growth can be traced back to their caller.
+// Tracked allocations carry a small header, so memory from Y_malloc must never go to std::free.
+// Without Y_MEMORY_TRACKING, tags can still be set but nothing is counted.
+namespace MemoryTracker {
+
+static const uint32 MaxTagCount = 64;
+static const uint32 MaxStackFrames = 16;
+
+// tag 0 is "Untagged". The name isn't copied, and registering a name twice returns the same tag.
+uint32 RegisterTag(const char* name);
+uint32 GetTagCount();
+
+// tag new allocations on the calling thread are charged to, see ScopedMemoryTag
+uint32 GetCurrentTag();
+void SetCurrentTag(uint32 tag);
+
+// records the call stack of 1 in every sampleRate allocations on each thread, 0 turns sampling off
+void SetSampleRate(uint32 sampleRate);
+uint32 GetSampleRate();
+
+struct TagStats
+{
+  const char* Name;
+  uint64 CurrentBytes;
+  uint64 PeakBytes;
+  uint64 CurrentCount;
+  uint64 TotalBytes;
+  uint64 TotalCount;
+};
+
+// returns false for tags that haven't been registered
+bool GetTagStats(uint32 tag, TagStats* pStats);
+
+struct StackSample
+{
+  uint32 Tag;
+  uint32 FrameCount;
+  void* Frames[MaxStackFrames];
+
+  // allocations sampled from this stack and their total size, and how much of that is still allocated
+  uint64 SampleCount;
+  uint64 SampledBytes;
+  uint64 LiveBytes;
+};
+
+// copies out up to maxSamples recorded stacks, most sampled bytes first, returning the number copied
+uint32 GetStackSamples(StackSample* pSamples, uint32 maxSamples);
+
+// logs every tag's counters and allocation rate since the previous dump, followed by the heaviest sampled
+// stacks as raw return addresses. Dumps should all come from the same thread.
+void Dump(uint32 maxStacks = 10);
+
+// bookkeeping for Memory.cpp, called for every tracked allocation and free
+void OnAllocate(size_t size, uint16* pTag, uint16* pStackRecord);
+void OnFree(size_t size, uint16 tag, uint16 stackRecord);
+
+}; // namespace MemoryTracker
+
+// sets the calling thread's memory tag for the lifetime of the object
+class ScopedMemoryTag
+{
+public:
+  ScopedMemoryTag(uint32 tag) : m_previousTag(MemoryTracker::GetCurrentTag()) { MemoryTracker::SetCurrentTag(tag); }
+  ~ScopedMemoryTag() { MemoryTracker::SetCurrentTag(m_previousTag); }
+
+private:
+  uint32 m_previousTag;
+
+  DeclareNonCopyable(ScopedMemoryTag);
+};
@@ -0,0 +1,222 @@
+#pragma once
+#include "YBaseLib/Array.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/CacheAligned.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/HashTable.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/String.h"
+
+class BinaryReader;
+class BinaryWriter;
+class TextWriter;
+
+// Named counters, gauges and histograms, for subsystems to report what they're doing. Recording takes no locks:
+// counters and histograms are split into shards of their own, threads spread across them, and the shards are only
+// summed when something reads them. Metrics are created by name from a registry and live as long as it, so look
+// them up once and keep the pointer.
+//   static MetricsCounter* s_pBytesSent = MetricsRegistry::GetInstance().GetCounter("socket.bytes_sent");
+//   s_pBytesSent->Add(size);
+// A snapshot copies every metric's value at once, for exporting as text or as a binary stream that can be read back.
+
+// threads recording a metric share this many copies of it
+static const uint32 MetricsShardCount = 8;
+
+enum METRIC_TYPE
+{
+  METRIC_TYPE_COUNTER,
+  METRIC_TYPE_GAUGE,
+  METRIC_TYPE_HISTOGRAM,
+  METRIC_TYPE_COUNT,
+};
+
+// a total that only goes up
+class MetricsCounter
+{
+  friend class MetricsRegistry;
+
+public:
+  const String& GetName() const { return m_name; }
+
+  void Add(uint64 value = 1);
+  uint64 GetValue() const;
+
+private:
+  MetricsCounter(const char* name);
+
+  String m_name;
+  ShardedCounter<uint64, MetricsShardCount> m_value;
+
+  Y_DECLARE_CACHE_ALIGNED_NEW();
+
+  DeclareNonCopyable(MetricsCounter);
+};
+
+// a value that's set, or moves up and down, like a queue's length
+class MetricsGauge
+{
+  friend class MetricsRegistry;
+
+public:
+  const String& GetName() const { return m_name; }
+
+  void Set(int64 value) { Y_AtomicStoreRelease(m_value, value); }
+  void Add(int64 value) { Y_AtomicAdd(m_value, value); }
+  void Subtract(int64 value) { Y_AtomicAdd(m_value, -value); }
+  int64 GetValue() const { return Y_AtomicLoadAcquire(m_value); }
+
+private:
+  MetricsGauge(const char* name);
+
+  String m_name;
+  Y_ATOMIC_DECL64 int64 m_value;
+
+  DeclareNonCopyable(MetricsGauge);
+};
+
+// The distribution of recorded values, like latencies or sizes. Buckets are log-linear: values below 8 have one
+// each, and every power of two above is split into 8, so a value's bucket is within 12.5% of it.
+class MetricsHistogram
+{
+  friend class MetricsRegistry;
+
+public:
+  static const uint32 SubBucketBits = 3;
+  static const uint32 SubBucketCount = 1 << SubBucketBits;
+  static const uint32 BucketCount = SubBucketCount + (64 - SubBucketBits) * SubBucketCount;
+
+  const String& GetName() const { return m_name; }
+
+  void Record(uint64 value);
+
+  // totals over the shards, which threads can be recording into
+  uint64 GetCount() const;
+  uint64 GetSum() const;
+  void GetBucketCounts(uint64 pCounts[BucketCount]) const;
+
+  // the bucket a value goes in, and the lowest and highest values that go in a bucket
+  static uint32 GetBucketIndex(uint64 value);
+  static uint64 GetBucketLowerBound(uint32 index);
+  static uint64 GetBucketUpperBound(uint32 index);
+
+private:
+  MetricsHistogram(const char* name);
+  ~MetricsHistogram();
+
+  struct Shard
+  {
+    Y_ATOMIC_DECL64 uint64 Sum;
+    Y_ATOMIC_DECL64 uint64 Buckets[BucketCount];
+  };
+
+  String m_name;
+  Shard* m_pShards;
+
+  DeclareNonCopyable(MetricsHistogram);
+};
+
+// every metric's value at one point, ordered by when the metrics were created
+class MetricsSnapshot
+{
+public:
+  struct Counter
+  {
+    String Name;
+    uint64 Value;
+  };
+
+  struct Gauge
+  {
+    String Name;
+    int64 Value;
+  };
+
+  struct HistogramBucket
+  {
+    uint32 Index;
+    uint64 Count;
+  };
+
+  struct Histogram
+  {
+    String Name;
+    uint64 Count;
+    uint64 Sum;
+
+    // only buckets holding values, lowest first
+    PODArray<HistogramBucket> Buckets;
+
+    // The highest value the given fraction of values are at or below, to within the buckets' precision, so
+    // 0.99 gives the 99th percentile. Returns 0 for an empty histogram.
+    uint64 GetPercentile(double fraction) const;
+    double GetMean() const { return (Count > 0) ? ((double)Sum / (double)Count) : 0.0; }
+  };
+
+  MetricsSnapshot();
+  ~MetricsSnapshot();
+
+  const Array<Counter>& GetCounters() const { return m_counters; }
+  const Array<Gauge>& GetGauges() const { return m_gauges; }
+  const Array<Histogram>& GetHistograms() const { return m_histograms; }
+
+  // by name, or nullptr if the snapshot doesn't have it
+  const Counter* FindCounter(const char* name) const;
+  const Gauge* FindGauge(const char* name) const;
+  const Histogram* FindHistogram(const char* name) const;
+
+  void Clear();
+
+  // A line for each metric, "counter <name> <value>", "gauge <name> <value>" or "histogram <name> count=<n>
+  // sum=<n> mean=<n> p50=<n> p90=<n> p99=<n> max=<n>".
+  void WriteText(TextWriter* pWriter) const;
+
+  // The whole snapshot, for reading back with ReadBinary. Returns false if the stream can't read it.
+  void WriteBinary(BinaryWriter* pWriter) const;
+  bool ReadBinary(BinaryReader* pReader);
+
+private:
+  friend class MetricsRegistry;
+
+  Array<Counter> m_counters;
+  Array<Gauge> m_gauges;
+  Array<Histogram> m_histograms;
+};
+
+// Creates and owns metrics. Getting a metric that exists returns it, so subsystems can share one by name, but
+// names have to be unique across types. Creating metrics and taking snapshots lock, recording doesn't.
+class MetricsRegistry
+{
+public:
+  MetricsRegistry();
+  ~MetricsRegistry();
+
+  // the registry YBaseLib's own subsystems report to
+  static MetricsRegistry& GetInstance();
+
+  // Returns nullptr if the name is taken by a metric of another type.
+  MetricsCounter* GetCounter(const char* name);
+  MetricsGauge* GetGauge(const char* name);
+  MetricsHistogram* GetHistogram(const char* name);
+
+  void GetSnapshot(MetricsSnapshot* pSnapshot) const;
+
+private:
+  struct Entry
+  {
+    METRIC_TYPE Type;
+    uint32 Index;
+  };
+
+  // Looks the name up, setting *pIndex to its metric's index if it has one. Returns false if the name is another
+  // type's.
+  bool FindEntry(const char* name, METRIC_TYPE type, bool* pFound, uint32* pIndex) const;
+
+  mutable Mutex m_lock;
+  HashTable<String, Entry> m_entries;
+  PODArray<MetricsCounter*> m_counters;
+  PODArray<MetricsGauge*> m_gauges;
+  PODArray<MetricsHistogram*> m_histograms;
+
+  DeclareNonCopyable(MetricsRegistry);
+};
@@ -18,12 +18,51 @@ struct NameTableEntry
   }                                                                                                                    \
   ;
 
+// Hashed lookups for tables searched often, with the same results as searching the table: the first entry with the
+// name or value. Declared next to the table and used in its place, as Name_Index, with the NameTable_ functions.
+// Nothing is built until the first lookup, which builds the index once, even if threads race to it.
+class NameTableIndex
+{
+public:
+  NameTableIndex(const NameTableEntry* pNameTable) : m_pNameTable(pNameTable), m_pIndex(NULL) {}
+  ~NameTableIndex();
+
+  const NameTableEntry* GetNameTable() const { return m_pNameTable; }
+
+  const NameTableEntry* LookupByName(const char* sName, bool bCaseInsensitive = false) const;
+  const NameTableEntry* LookupByValue(int iValue) const;
+
+private:
+  struct Index;
+  const Index* GetIndex() const;
+
+  const NameTableEntry* m_pNameTable;
+  mutable Index* volatile m_pIndex;
+
+  DeclareNonCopyable(NameTableIndex);
+};
+
+#define Y_Declare_NameTableIndex(Name) extern const NameTableIndex Name##_Index;
+#define Y_Define_NameTableIndex(Name) const NameTableIndex Name##_Index(Name);
+
 const NameTableEntry* NameTable_LookupByName(const NameTableEntry* pNameTable, const char* sName,
                                              bool bCaseInsensitive = false);
 const NameTableEntry* NameTable_LookupByValue(const NameTableEntry* pNameTable, int iValue);
 
-template<typename T>
-inline bool NameTable_TranslateType(const NameTableEntry* pNameTable, const char* sName, T* pDestination,
+inline const NameTableEntry* NameTable_LookupByName(const NameTableIndex* pNameTable, const char* sName,
+                                                    bool bCaseInsensitive = false)
+{
+  return pNameTable->LookupByName(sName, bCaseInsensitive);
+}
+
+inline const NameTableEntry* NameTable_LookupByValue(const NameTableIndex* pNameTable, int iValue)
+{
+  return pNameTable->LookupByValue(iValue);
+}
+
+// TABLE is NameTableEntry or NameTableIndex
+template<typename T, typename TABLE>
+inline bool NameTable_TranslateType(const TABLE* pNameTable, const char* sName, T* pDestination,
                                     bool bCaseInsensitive = false)
 {
   const NameTableEntry* pFoundEntry = NameTable_LookupByName(pNameTable, sName, bCaseInsensitive);
@@ -36,8 +75,8 @@ inline bool NameTable_TranslateType(const NameTableEntry* pNameTable, const char
   return false;
 }
 
-template<typename T>
-inline const char* NameTable_GetNameString(const NameTableEntry* pNameTable, const T Value,
+template<typename T, typename TABLE>
+inline const char* NameTable_GetNameString(const TABLE* pNameTable, const T Value,
                                            const char* DefaultReturn = "UNKNOWN")
 {
   const NameTableEntry* pFoundEntry = NameTable_LookupByValue(pNameTable, (int)Value);
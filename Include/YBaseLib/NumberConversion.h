@@ -0,0 +1,38 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/StringView.h"
+
+// Conversions between numbers and decimal text, without going through the C runtime's printf and strtod.
+// Integers are written two digits at a time from a lookup table. Floating point values are written with Grisu2,
+// so they always read back to the same value, with the shortest digits for nearly all inputs and a few more for the
+// rest. Parsing handles the common cases exactly and inline, and only falls back to the C runtime for long or
+// extreme inputs.
+// The format functions write to a caller-supplied buffer of at least the given size, without a terminator,
+// and return the number of characters written.
+namespace NumberConversion {
+// longest integer, "-9223372036854775808" or "18446744073709551615"
+static const uint32 MaxIntegerLength = 20;
+
+// room for any floating point value, the longest are like "-0.000012345678901234567" or "-2.2250738585072014e-308"
+static const uint32 MaxFloatLength = 32;
+
+uint32 FormatInt32(char* pBuffer, int32 value);
+uint32 FormatUInt32(char* pBuffer, uint32 value);
+uint32 FormatInt64(char* pBuffer, int64 value);
+uint32 FormatUInt64(char* pBuffer, uint64 value);
+
+// Fixed notation for decimal exponents from -6 to 20 ("123.25", "0.001", "1000"), otherwise scientific
+// ("1.5e+30", "2e-7"). Infinities and NaNs are written as "inf", "-inf" and "nan".
+uint32 FormatFloat(char* pBuffer, float value);
+uint32 FormatDouble(char* pBuffer, double value);
+
+// Parse a number from the start of a view. Leading whitespace and a sign are skipped, and integers may be hex with
+// a 0x prefix. Out of range integers saturate, unsigned values negate like strtoul. Returns the number of characters
+// used, or zero if the view doesn't start with a number, in which case the value is set to zero.
+uint32 ParseInt32(const StringView& text, int32* pValue);
+uint32 ParseUInt32(const StringView& text, uint32* pValue);
+uint32 ParseInt64(const StringView& text, int64* pValue);
+uint32 ParseUInt64(const StringView& text, uint64* pValue);
+uint32 ParseFloat(const StringView& text, float* pValue);
+uint32 ParseDouble(const StringView& text, double* pValue);
+} // namespace NumberConversion
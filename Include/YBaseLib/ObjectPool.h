@@ -0,0 +1,186 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/IntrusiveLockFreeStack.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/NonCopyable.h"
+#include "YBaseLib/ThreadLocal.h"
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Fixed number of objects shared between threads, for things that are handed out and given back often enough that
+// going to the heap each time shows up, like barriers for blocking tasks and socket receive buffers.
+//
+// Objects are constructed the first time they're handed out and only destroyed with the pool. Release puts an object
+// back as it is, and the next Allocate to get it receives it like that, so whoever takes one resets what it needs
+// to. Because the object stays alive, something still touching it just after it was released, such as a thread
+// leaving a barrier, is safe.
+//
+// Each thread keeps a magazine of released objects to allocate from and release into without any atomics. When a
+// magazine fills up, half of it goes to a lock-free depot shared by every thread as one batch, and an empty magazine
+// takes a whole batch back with one compare-exchange. Objects that have never been used come from the pool's block
+// in order, so its memory is only touched as the pool fills.
+//
+// Once every object is in use, or sitting in other threads' magazines, Allocate returns null and the caller falls
+// back to something else, e.g. the heap. Owns tells the two apart when they're released. Up to 2 * MagazineSize - 1
+// objects can be held by a thread that only releases, so the capacity should allow for that per thread.
+template<class T>
+class ObjectPool
+{
+  DeclareNonCopyable(ObjectPool);
+
+public:
+  static const uint32 MagazineSize = 8;
+
+  ObjectPool(uint32 capacity)
+  {
+    m_storage.pSlots = static_cast<Slot*>(Y_aligned_malloc(Max(capacity, 1u) * sizeof(Slot), alignof(Slot)));
+    m_storage.Capacity = capacity;
+    if (m_storage.pSlots == nullptr)
+      Panic("ObjectPool: failed to allocate storage");
+  }
+
+  uint32 GetCapacity() const { return m_storage.Capacity; }
+
+  // objects handed out at least once, including those released since
+  uint32 GetConstructedCount() const { return m_storage.GetConstructedCount(); }
+
+  // a released object, or a new one constructed from args. null when none are free.
+  template<class... Args>
+  T* Allocate(Args&&... args)
+  {
+    Magazine& magazine = GetMagazine();
+    Slot* pSlot = magazine.pFirst;
+    if (pSlot == nullptr)
+    {
+      // refill from the depot, whose batches keep their own count in the first slot
+      pSlot = m_depot.Pop();
+      if (pSlot == nullptr)
+        return ConstructObject(std::forward<Args>(args)...);
+
+      magazine.Count = pSlot->BatchSize;
+    }
+
+    magazine.pFirst = pSlot->pNextInMagazine;
+    magazine.Count--;
+    return pSlot->GetObject();
+  }
+
+  void Release(T* pObject)
+  {
+    DebugAssert(Owns(pObject));
+    Slot* pSlot = Slot::FromObject(pObject);
+    Magazine& magazine = GetMagazine();
+    pSlot->pNextInMagazine = magazine.pFirst;
+    magazine.pFirst = pSlot;
+    magazine.Count++;
+
+    // the most recent half stays, since it's the most likely to still be in cache
+    if (magazine.Count == 2 * MagazineSize)
+    {
+      Slot* pLastKept = magazine.pFirst;
+      for (uint32 i = 1; i < MagazineSize; i++)
+        pLastKept = pLastKept->pNextInMagazine;
+
+      Slot* pBatch = pLastKept->pNextInMagazine;
+      pLastKept->pNextInMagazine = nullptr;
+      pBatch->BatchSize = MagazineSize;
+      m_depot.Push(pBatch);
+      magazine.Count = MagazineSize;
+    }
+  }
+
+  // whether the object came from this pool, rather than wherever the caller went when it was full
+  bool Owns(const T* pObject) const
+  {
+    const byte* pAddress = reinterpret_cast<const byte*>(pObject);
+    const byte* pStart = reinterpret_cast<const byte*>(m_storage.pSlots);
+    return (pAddress >= pStart && pAddress < pStart + m_storage.Capacity * sizeof(Slot));
+  }
+
+private:
+  struct Slot
+  {
+    // link in the depot, only meaningful in the first slot of a batch
+    Slot* next;
+    Slot* pNextInMagazine;
+    uint32 BatchSize;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type Object;
+
+    T* GetObject() { return reinterpret_cast<T*>(&Object); }
+    static Slot* FromObject(T* pObject)
+    {
+      return reinterpret_cast<Slot*>(reinterpret_cast<byte*>(pObject) - offsetof(Slot, Object));
+    }
+  };
+
+  struct Magazine
+  {
+    Magazine() : pPool(nullptr), pFirst(nullptr), Count(0) {}
+
+    // the thread's objects go back to the depot as one batch when it exits, or when the pool goes
+    ~Magazine()
+    {
+      if (pFirst != nullptr)
+      {
+        pFirst->BatchSize = Count;
+        pPool->m_depot.Push(pFirst);
+      }
+    }
+
+    ObjectPool* pPool;
+    Slot* pFirst;
+    uint32 Count;
+  };
+
+  // The block, and how far into it objects have been constructed. A member of its own, declared first so it's
+  // destroyed last, after m_magazines has handed every thread's slots back.
+  struct Storage
+  {
+    Storage() : pSlots(nullptr), Capacity(0), UsedSlotCount(0) {}
+    ~Storage()
+    {
+      if (pSlots == nullptr)
+        return;
+
+      uint32 constructedCount = GetConstructedCount();
+      for (uint32 i = 0; i < constructedCount; i++)
+        pSlots[i].GetObject()->~T();
+      Y_aligned_free(pSlots);
+    }
+
+    // the count can run past the capacity by the number of threads racing for the last slot, never further
+    uint32 GetConstructedCount() const { return Min(Y_AtomicLoad(UsedSlotCount), Capacity); }
+
+    Slot* pSlots;
+    uint32 Capacity;
+    Y_ATOMIC_DECL uint32 UsedSlotCount;
+  };
+
+  Magazine& GetMagazine()
+  {
+    Magazine& magazine = m_magazines.Get();
+    magazine.pPool = this;
+    return magazine;
+  }
+
+  template<class... Args>
+  T* ConstructObject(Args&&... args)
+  {
+    if (Y_AtomicLoad(m_storage.UsedSlotCount, ATOMIC_MEMORY_ORDER_RELAXED) >= m_storage.Capacity)
+      return nullptr;
+
+    uint32 index = Y_AtomicIncrement(m_storage.UsedSlotCount) - 1;
+    if (index >= m_storage.Capacity)
+      return nullptr;
+
+    return new (m_storage.pSlots[index].GetObject()) T(std::forward<Args>(args)...);
+  }
+
+  Storage m_storage;
+  IntrusiveLockFreeStack<Slot> m_depot;
+  ThreadLocal<Magazine> m_magazines;
+};
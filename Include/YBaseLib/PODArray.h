@@ -1,11 +1,14 @@
 #pragma once
+#include "YBaseLib/Allocator.h"
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Common.h"
 #include "YBaseLib/Memory.h"
+#include "YBaseLib/RelocationTrait.h"
+#include "YBaseLib/Sort.h"
 
 // array class suitable for POD types (int, float, etc)
-template<class T>
-class PODArray
+template<class T, class AllocatorType = HeapAllocator>
+class PODArray : private AllocatorType
 {
 public:
   PODArray()
@@ -14,20 +17,26 @@ public:
     m_size = m_reserve = 0;
   }
 
-  PODArray(uint32 nReserve)
+  explicit PODArray(const AllocatorType& allocator) : AllocatorType(allocator)
   {
     m_pElements = NULL;
     m_size = m_reserve = 0;
   }
 
-  PODArray(const PODArray& c)
+  PODArray(uint32 nReserve, const AllocatorType& allocator = AllocatorType()) : AllocatorType(allocator)
+  {
+    m_pElements = NULL;
+    m_size = m_reserve = 0;
+  }
+
+  PODArray(const PODArray& c) : AllocatorType(c.GetAllocator())
   {
     m_pElements = NULL;
     m_size = m_reserve = 0;
     Assign(c);
   }
 
-  PODArray(PODArray&& c)
+  PODArray(PODArray&& c) : AllocatorType(c.GetAllocator())
   {
     m_pElements = c.m_pElements;
     m_size = c.m_size;
@@ -37,7 +46,11 @@ public:
     c.m_reserve = 0;
   }
 
-  ~PODArray() { std::free(m_pElements); }
+  ~PODArray() { FreeElements(); }
+
+  // allocator the elements come from, copies of the array share a copy of it
+  const AllocatorType& GetAllocator() const { return *this; }
+  AllocatorType& GetAllocator() { return *this; }
 
   void Clear()
   {
@@ -47,7 +60,7 @@ public:
     m_size = 0;
   }
 
-  void Assign(const PODArray<T>& c)
+  void Assign(const PODArray& c)
   {
     Clear();
     Reserve(c.m_reserve);
@@ -56,11 +69,12 @@ public:
       std::memcpy(m_pElements, c.m_pElements, sizeof(T) * m_size);
   }
 
-  void Swap(PODArray<T>& c)
+  void Swap(PODArray& c)
   {
     ::Swap(m_pElements, c.m_pElements);
     ::Swap(m_size, c.m_size);
     ::Swap(m_reserve, c.m_reserve);
+    ::Swap(GetAllocator(), c.GetAllocator());
   }
 
   void Obliterate()
@@ -69,12 +83,12 @@ public:
       return;
 
     Clear();
-    std::free(m_pElements);
+    FreeElements();
     m_pElements = NULL;
     m_reserve = 0;
   }
 
-  bool Equals(const PODArray<T>& c) const
+  bool Equals(const PODArray& c) const
   {
     if (c.m_size != m_size)
       return false;
@@ -87,7 +101,7 @@ public:
     if (m_reserve >= nElements)
       return;
 
-    m_pElements = (T*)Y_reallocarray(m_pElements, sizeof(T), nElements);
+    m_pElements = (T*)GetAllocator().Reallocate(m_pElements, sizeof(T) * m_reserve, sizeof(T) * nElements, alignof(T));
     m_reserve = nElements;
   }
 
@@ -98,7 +112,7 @@ public:
     {
       m_size = newSize;
     }
-    else
+    else if (newSize > m_size)
     {
       if (newSize > m_reserve)
         Reserve(newSize);
@@ -116,13 +130,13 @@ public:
     // if reserve > size, resize down to size
     if (m_size == 0)
     {
-      std::free(m_pElements);
+      FreeElements();
       m_pElements = NULL;
       m_reserve = 0;
     }
     else if (m_reserve > m_size)
     {
-      m_pElements = (T*)Y_reallocarray(m_pElements, sizeof(T), m_size);
+      m_pElements = (T*)GetAllocator().Reallocate(m_pElements, sizeof(T) * m_reserve, sizeof(T) * m_size, alignof(T));
       m_reserve = m_size;
     }
   }
@@ -131,7 +145,7 @@ public:
   {
     // autosize
     if (m_size == m_reserve)
-      Reserve(Max(m_size + 1, m_size * 2));
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + 1));
 
     m_pElements[m_size] = value;
     m_size++;
@@ -142,7 +156,7 @@ public:
   {
     // autosize
     if (m_size == m_reserve)
-      Reserve(Max(m_size + 1, m_size * 2));
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + 1));
 
     new (&m_pElements[m_size]) T(args...);
     m_size++;
@@ -154,13 +168,13 @@ public:
       return;
 
     if ((m_size + count) >= m_reserve)
-      Reserve(Max(m_size + count, m_size * 2));
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + count));
 
     std::memcpy(m_pElements + m_size, pValues, sizeof(T) * count);
     m_size += count;
   }
 
-  void AddArray(const PODArray<T>& array)
+  void AddArray(const PODArray& array)
   {
     if (array.GetSize() > 0)
       AddRange(array.GetBasePointer(), array.GetSize());
@@ -278,6 +292,7 @@ public:
     return true;
   }
 
+  // the caller takes ownership of the elements, they must be freed through the same allocator
   void DetachArray(T** pBasePointer, uint32* pSize)
   {
     DebugAssert(pBasePointer != NULL && pSize != NULL);
@@ -301,26 +316,17 @@ public:
 
   uint32 GetStorageReserveInBytes() const { return m_reserve * sizeof(T); }
 
+  // callback(left, right) returns a qsort-style int, and is inlined into the sort
   template<class CB>
   void SortCB(CB callback)
   {
-    struct __unused__
-    {
-      static int __cb_trampoline(void* context, const void* pLeft, const void* pRight)
-      {
-        return (*reinterpret_cast<CB*>(context))(*reinterpret_cast<const T*>(pLeft),
-                                                 *reinterpret_cast<const T*>(pRight));
-      }
-    };
-
-    if (m_size > 0)
-      Y_qsort_r(m_pElements, m_size, sizeof(T), reinterpret_cast<void*>(&callback), __unused__::__cb_trampoline);
+    Y_sort(m_pElements, m_size, [&callback](const T& left, const T& right) { return callback(left, right) < 0; });
   }
 
   void Sort(int (*CompareFunction)(const T* pLeft, const T* pRight))
   {
-    if (m_size > 0)
-      Y_qsortT(m_pElements, m_size, CompareFunction);
+    Y_sort(m_pElements, m_size,
+           [CompareFunction](const T& left, const T& right) { return CompareFunction(&left, &right) < 0; });
   }
 
   bool BinarySearch(uint32* pOutIndex, const T& searchKey,
@@ -403,7 +409,7 @@ public:
 
     // ensure we have room
     if (m_size == m_reserve)
-      Reserve(Max(m_size + 1, m_size * 2));
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + 1));
 
     // move everything forwards
     uint32 countAfter = m_size - index;
@@ -411,6 +417,7 @@ public:
 
     // insert into place
     m_pElements[index] = item;
+    m_size++;
   }
 
   // zero everything
@@ -424,7 +431,7 @@ public:
   void EnsureReserve(uint32 n)
   {
     if ((m_size + n) > m_reserve)
-      Reserve(Max(m_size + n, m_size * 2));
+      Reserve(Y_GetArrayGrowthSize(m_size, m_size + n));
   }
 
   // pointer readers, use with care
@@ -461,24 +468,30 @@ public:
   }
 
   // assignment operator
-  PODArray<T>& operator=(const PODArray<T>& c)
+  PODArray& operator=(const PODArray& c)
   {
     Assign(c);
     return *this;
   }
-  PODArray<T>& operator=(PODArray<T>&& c)
+  PODArray& operator=(PODArray&& c)
   {
     Swap(c);
     return *this;
   }
 
   // operator wrappers
-  bool operator==(const PODArray<T>& c) const { return Equals(c); }
-  bool operator!=(const PODArray<T>& c) const { return !Equals(c); }
+  bool operator==(const PODArray& c) const { return Equals(c); }
+  bool operator!=(const PODArray& c) const { return !Equals(c); }
   const T& operator[](uint32 index) const { return GetElement(index); }
   T& operator[](uint32 index) { return GetElement(index); }
 
 protected:
+  void FreeElements()
+  {
+    if (m_pElements != NULL)
+      GetAllocator().Free(m_pElements, sizeof(T) * m_reserve, alignof(T));
+  }
+
   T* m_pElements;
   uint32 m_size;
   uint32 m_reserve;
@@ -601,3 +614,10 @@ public:
   T* end() { return (m_size > 0) ? &m_pElements[m_size] : m_pElements; }
 #endif
 };
+
+// the array object only points at its elements, so arrays of arrays can be reallocated in place
+template<class T, class AllocatorType>
+struct RelocationTrait<PODArray<T, AllocatorType>>
+{
+  static const bool IsTriviallyRelocatable = true;
+};
@@ -13,6 +13,10 @@ public:
   void SleepAndRelease(Mutex* pMutex);
   void SleepAndRelease(RecursiveMutex* pMutex);
 
+  // gives up after timeout milliseconds, returning false if it did. like any wait it can also return spuriously.
+  bool SleepAndRelease(Mutex* pMutex, uint32 timeout);
+  bool SleepAndRelease(RecursiveMutex* pMutex, uint32 timeout);
+
   void WakeAll();
   void Wake();
 
@@ -1,82 +1,68 @@
 #pragma once
-#include "YBaseLib/Assert.h"
 #include "YBaseLib/Common.h"
-#include <poll.h>
 
-class Event
+// An event that's also a file descriptor, readable while it's signaled, so it can be waited on with poll, epoll or
+// kqueue alongside sockets. On Linux it's an eventfd, elsewhere a pipe. Auto reset events are reset by the Wait or
+// TryWait that sees them signaled, manual reset events stay signaled until Reset.
+class PollableEvent
 {
 public:
-  Event(bool autoReset = false) : m_autoReset(autoReset)
-  {
-    m_pipeFds[0] = m_pipeFds[1] = -1;
+  PollableEvent(bool autoReset = false);
+  ~PollableEvent();
+
+  int GetFileDescriptor() const { return m_fileDescriptors[0]; }
+
+  void Signal();
+  void Wait();
+  bool TryWait(uint32 timeout);
+  void Reset();
+
+private:
+  // resets an auto reset event, returning false if another waiter already has
+  bool Consume();
+
+  // the read and write ends, both the same eventfd on Linux
+  int m_fileDescriptors[2];
+  bool m_autoReset;
+};
+
 #if defined(Y_PLATFORM_LINUX)
-    pipe2(m_pipeFds, O_NONBLOCK);
-#else
-    pipe(m_pipeFds);
-    fcntl(m_pipeFds[0], F_SETFL, fcntl(m_pipeFds[0], F_GETFL) | O_NONBLOCK);
-    fcntl(m_pipeFds[1], F_SETFL, fcntl(m_pipeFds[1], F_GETFL) | O_NONBLOCK);
-#endif
-  }
-
-  ~Event()
-  {
-    close(m_pipeFds[0]);
-    close(m_pipeFds[1]);
-  }
-
-  void Signal()
-  {
-    char buf[1] = {0};
-    write(m_pipeFds[1], buf, sizeof(buf));
-  }
-
-  void Wait()
-  {
-    pollfd pollDescriptors;
-    pollDescriptors.fd = m_pipeFds[0];
-    pollDescriptors.events = POLLRDNORM;
-    poll(&pollDescriptors, 1, -1);
-
-    if (m_autoReset)
-      Reset();
-  }
-
-  bool TryWait(uint32 timeout)
-  {
-    pollfd pollDescriptors;
-    pollDescriptors.fd = m_pipeFds[0];
-    pollDescriptors.events = POLLRDNORM;
-    if (poll(&pollDescriptors, 1, timeout) == 0)
-      return false;
-
-    if (m_autoReset)
-      Reset();
-
-    return true;
-  }
-
-  void Reset()
-  {
-    char buf[1];
-    while (read(m_pipeFds[0], buf, sizeof(buf)) > 0)
-      ;
-  }
-
-  static void WaitForMultipleEvents(Event** ppEvents, uint32 nEvents)
-  {
-    DebugAssert(nEvents > 0);
-
-    uint32 i;
-    pollfd pollDescriptors;
-    pollDescriptors.events = POLLRDNORM;
-    for (i = 0; i < nEvents; i++)
-    {
-      pollDescriptors.fd = ppEvents[i]->m_pipeFds[0];
-      poll(&pollDescriptors, 1, -1);
-    }
-  }
+
+// A futex on a state word, so Signal and Reset are only system calls when there's a thread asleep on the event.
+class Event
+{
+public:
+  Event(bool autoReset = false);
+  ~Event();
+
+  void Signal();
+  void Wait();
+  bool TryWait(uint32 timeout);
+  void Reset();
+
+  static void WaitForMultipleEvents(Event** ppEvents, uint32 nEvents);
 
 private:
-  int m_pipeFds[2];
+  // checks for the signal, resetting it if the event is auto reset
+  bool TryAcquire();
+
+  // sleeps until the state isn't 0 or the deadline passes, returning false if it did
+  bool Sleep(const struct timespec* pDeadline);
+
+  // 1 while signaled, and the threads asleep or about to be, so Signal knows if there's anyone to wake
+  volatile int32 m_state;
+  volatile int32 m_waiters;
   bool m_autoReset;
 };
+
+#else
+
+class Event : public PollableEvent
+{
+public:
+  Event(bool autoReset = false) : PollableEvent(autoReset) {}
+
+  static void WaitForMultipleEvents(Event** ppEvents, uint32 nEvents);
+};
+
+#endif
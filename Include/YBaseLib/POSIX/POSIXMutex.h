@@ -1,13 +1,17 @@
 #pragma once
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Common.h"
+#include "YBaseLib/LockProfiler.h"
+#include "YBaseLib/SpinLock.h"
 
+// With a spin count the mutex is adaptive: Lock retries for up to that many pause hints, backing off
+// exponentially, before it blocks, for locks held so briefly that sleeping costs more than the wait.
 class Mutex
 {
   friend class ConditionVariable;
 
 public:
-  Mutex()
+  Mutex(uint32 spinCount = 0) : m_spinCount(spinCount)
   {
     pthread_mutexattr_t mutexAttributes;
     pthread_mutexattr_init(&mutexAttributes);
@@ -18,12 +22,73 @@ public:
 
   ~Mutex() { pthread_mutex_destroy(&m_Mutex); }
 
-  void Lock() { pthread_mutex_lock(&m_Mutex); }
+  void Lock()
+  {
+#if Y_LOCK_PROFILING
+    if (m_profile.IsEnabled())
+    {
+      m_profile.Acquire([this]() { return TryLockUnprofiled(); }, [this]() { LockUnprofiled(); });
+      return;
+    }
+#endif
+
+    LockUnprofiled();
+  }
+
+  bool TryLock()
+  {
+    if (!TryLockUnprofiled())
+      return false;
 
-  bool TryLock() { return (pthread_mutex_trylock(&m_Mutex) == 0); }
+#if Y_LOCK_PROFILING
+    m_profile.OnTryAcquired();
+#endif
+    return true;
+  }
+
+  void Unlock()
+  {
+#if Y_LOCK_PROFILING
+    m_profile.Release();
+#endif
+    pthread_mutex_unlock(&m_Mutex);
+  }
 
-  void Unlock() { pthread_mutex_unlock(&m_Mutex); }
+  // counts this lock under name with LockProfiler, when built with Y_LOCK_PROFILING
+  void SetProfileName(const char* name)
+  {
+#if Y_LOCK_PROFILING
+    m_profile.SetName(name);
+#else
+    UNREFERENCED_PARAMETER(name);
+#endif
+  }
 
 private:
+  void LockUnprofiled()
+  {
+    if (m_spinCount != 0)
+    {
+      SpinBackoff backoff;
+      for (uint32 spins = 0; spins < m_spinCount;)
+      {
+        if (TryLockUnprofiled())
+          return;
+
+        spins += backoff.GetSpins();
+        backoff.Pause();
+      }
+    }
+
+    pthread_mutex_lock(&m_Mutex);
+  }
+
+  bool TryLockUnprofiled() { return (pthread_mutex_trylock(&m_Mutex) == 0); }
+
   pthread_mutex_t m_Mutex;
+  uint32 m_spinCount;
+
+#if Y_LOCK_PROFILING
+  LockProfile m_profile;
+#endif
 };
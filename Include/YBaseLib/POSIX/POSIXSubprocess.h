@@ -5,14 +5,19 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+struct SubprocessSharedRing;
+
 class Subprocess
 {
 public:
+  // Bytes buffered in each direction when the channel runs over shared memory.
+  static const uint32 DefaultSharedMemoryChannelSize = 1024 * 1024;
+
   class Connection
   {
   private:
     Connection(pid_t targetProcessID, int readPipe, int hWritePipe, bool isParentConnection,
-               bool terminateOnParentLost);
+               bool terminateOnParentLost, void* pSharedMemory = nullptr, uint32 sharedMemoryChannelSize = 0);
 
   public:
     ~Connection();
@@ -30,17 +35,29 @@ public:
 
     uint32 WriteData(const void* pBuffer, uint32 byteCount);
 
+    // true when data moves through shared memory rather than the pipes
+    bool IsSharedMemoryChannel() const { return (m_pSharedMemory != nullptr); }
+
   private:
+    // called when the other side's gone, aborting if the connection was made with terminateOnParentLost
+    uint32 OnOtherSideLost();
+
     friend class Subprocess;
     pid_t m_targetProcess;
     int m_readPipe;
     int m_writePipe;
     bool m_isParentConnection;
     bool m_terminateOnParentLost;
+
+    // rings in the shared mapping, the pipes then only carry the handshake
+    void* m_pSharedMemory;
+    uint32 m_sharedMemoryChannelSize;
+    SubprocessSharedRing* m_pSendRing;
+    SubprocessSharedRing* m_pReceiveRing;
   };
 
 private:
-  Subprocess(pid_t childProcessID, int readPipe, int writePipe);
+  Subprocess(pid_t childProcessID, int readPipe, int writePipe, void* pSharedMemory, uint32 sharedMemoryChannelSize);
 
 public:
   ~Subprocess();
@@ -52,8 +69,18 @@ public:
   static Connection* ConnectToParent(int32 connectionTimeout = -1);
 
   // Parent process functions
+  // The channel is offered to the child over shared memory when sharedMemoryChannelSize is non-zero and the
+  // platform supports it, and falls back to the pipes otherwise.
   static Subprocess* Create(const char* executableFileName, const char* parameters = NULL, bool openChannel = true,
-                            bool newConsole = true, bool terminateOnParentLost = true);
+                            bool newConsole = true, bool terminateOnParentLost = true,
+                            uint32 sharedMemoryChannelSize = DefaultSharedMemoryChannelSize);
+
+  // Starts count children the same way as Create, sharing the setup between them, so they start up side by side
+  // while the caller connects to each in turn. Returns how many were started, they fill ppSubprocesses in order.
+  static uint32 CreateMultiple(Subprocess** ppSubprocesses, uint32 count, const char* executableFileName,
+                               const char* parameters = NULL, bool openChannel = true, bool newConsole = true,
+                               bool terminateOnParentLost = true,
+                               uint32 sharedMemoryChannelSize = DefaultSharedMemoryChannelSize);
   Connection* ConnectToChild(int32 connectionTimeout = -1);
   bool IsChildAlive();
   void RequestChildToExit();
@@ -64,5 +91,7 @@ private:
   pid_t m_childProcessID;
   int m_readPipe;
   int m_writePipe;
+  void* m_pSharedMemory;
+  uint32 m_sharedMemoryChannelSize;
   Connection* m_pChildConnection;
 };
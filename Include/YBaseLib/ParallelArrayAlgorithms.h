@@ -0,0 +1,205 @@
+#pragma once
+#include "YBaseLib/ArrayAlgorithms.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/ParallelFor.h"
+#include <type_traits>
+
+// The ArrayAlgorithms.h functions spread across a ThreadPool, each thread running the vector kernels over its own
+// blocks. Small arrays, or a null pool, run on the calling thread. Floating point sums combine the blocks in whatever
+// order they finish, so can differ in the last bits between runs as well. The filter and prefix sum go over the
+// array twice, first for each block's count or sum and then to write the results, and can't work in place.
+
+namespace ArrayAlgorithmsDetail {
+
+// blocks below this aren't worth handing to another thread
+static const uint32 ParallelArrayBlockSize = 65536;
+
+// signed integers are added as unsigned, so they wrap as they do in the kernels
+template<typename T, bool Integral = std::is_integral<T>::value>
+struct WrappingSum
+{
+  typedef T Type;
+};
+template<typename T>
+struct WrappingSum<T, true>
+{
+  typedef typename std::make_unsigned<T>::type Type;
+};
+
+template<typename T>
+T AddWrapping(T a, T b)
+{
+  typedef typename WrappingSum<T>::Type Sum;
+  return (T)((Sum)a + (Sum)b);
+}
+
+}; // namespace ArrayAlgorithmsDetail
+
+template<typename T>
+int32 Y_parallel_array_find(ThreadPool* pThreadPool, const T* pValues, uint32 count,
+                            typename ArrayAlgorithmsDetail::Identity<T>::Type value)
+{
+  using namespace ArrayAlgorithmsDetail;
+
+  // blocks past the first match found so far are skipped
+  volatile uint32 firstIndex = count;
+  ParallelForRange(pThreadPool, 0, count, ParallelArrayBlockSize,
+                   [pValues, value, &firstIndex](uint32 rangeBegin, uint32 rangeEnd) {
+                     if (rangeBegin >= Y_AtomicLoad(firstIndex))
+                       return;
+
+                     int32 index = Y_array_find(pValues + rangeBegin, rangeEnd - rangeBegin, value);
+                     if (index < 0)
+                       return;
+
+                     uint32 foundIndex = rangeBegin + (uint32)index;
+                     uint32 expected = Y_AtomicLoad(firstIndex);
+                     while (foundIndex < expected)
+                     {
+                       if (Y_AtomicTryCompareExchange(firstIndex, expected, foundIndex))
+                         break;
+                     }
+                   });
+
+  return (firstIndex < count) ? (int32)firstIndex : -1;
+}
+
+template<typename T>
+uint32 Y_parallel_array_count(ThreadPool* pThreadPool, const T* pValues, uint32 count, Y_ARRAY_COMPARE compare,
+                              typename ArrayAlgorithmsDetail::Identity<T>::Type value)
+{
+  using namespace ArrayAlgorithmsDetail;
+  return ParallelReduce(pThreadPool, 0, count, ParallelArrayBlockSize, 0u,
+                        [pValues, compare, value](uint32 rangeBegin, uint32 rangeEnd, uint32 partial) {
+                          return partial + Y_array_count(pValues + rangeBegin, rangeEnd - rangeBegin, compare, value);
+                        },
+                        [](uint32 a, uint32 b) { return a + b; });
+}
+
+template<typename T>
+bool Y_parallel_array_minmax(ThreadPool* pThreadPool, const T* pValues, uint32 count, T* pMin, T* pMax)
+{
+  using namespace ArrayAlgorithmsDetail;
+
+  struct Bounds
+  {
+    T Min;
+    T Max;
+    bool Valid;
+
+    static Bounds Combine(const Bounds& a, const Bounds& b)
+    {
+      if (!a.Valid || !b.Valid)
+        return a.Valid ? a : b;
+
+      Bounds result = {(b.Min < a.Min) ? b.Min : a.Min, (b.Max > a.Max) ? b.Max : a.Max, true};
+      return result;
+    }
+  };
+
+  Bounds identity = {T(), T(), false};
+  Bounds bounds = ParallelReduce(pThreadPool, 0, count, ParallelArrayBlockSize, identity,
+                                 [pValues, &identity](uint32 rangeBegin, uint32 rangeEnd, const Bounds& partial) {
+                                   Bounds range = identity;
+                                   range.Valid = Y_array_minmax(pValues + rangeBegin, rangeEnd - rangeBegin,
+                                                                &range.Min, &range.Max);
+                                   return Bounds::Combine(partial, range);
+                                 },
+                                 &Bounds::Combine);
+
+  if (!bounds.Valid)
+    return false;
+
+  *pMin = bounds.Min;
+  *pMax = bounds.Max;
+  return true;
+}
+
+template<typename T>
+T Y_parallel_array_sum(ThreadPool* pThreadPool, const T* pValues, uint32 count)
+{
+  using namespace ArrayAlgorithmsDetail;
+  return ParallelReduce(pThreadPool, 0, count, ParallelArrayBlockSize, T(),
+                        [pValues](uint32 rangeBegin, uint32 rangeEnd, T partial) {
+                          return AddWrapping(partial, Y_array_sum(pValues + rangeBegin, rangeEnd - rangeBegin));
+                        },
+                        &AddWrapping<T>);
+}
+
+// pResult may not overlap pValues.
+template<typename T>
+uint32 Y_parallel_array_filter(ThreadPool* pThreadPool, T* pResult, const T* pValues, uint32 count,
+                               Y_ARRAY_COMPARE compare, typename ArrayAlgorithmsDetail::Identity<T>::Type value)
+{
+  using namespace ArrayAlgorithmsDetail;
+  DebugAssert(pResult + count <= pValues || pValues + count <= pResult);
+
+  uint32 blockCount = (count + ParallelArrayBlockSize - 1) / ParallelArrayBlockSize;
+  if (pThreadPool == nullptr || blockCount <= 1)
+    return Y_array_filter(pResult, pValues, count, compare, value);
+
+  // each block's results start after the ones kept from the blocks before
+  PODArray<uint32> offsets;
+  offsets.Resize(blockCount);
+  ParallelFor(pThreadPool, 0, blockCount, 1, [pValues, count, compare, value, &offsets](uint32 blockIndex) {
+    uint32 blockBegin = blockIndex * ParallelArrayBlockSize;
+    uint32 blockSize = Min(count - blockBegin, ParallelArrayBlockSize);
+    offsets[blockIndex] = Y_array_count(pValues + blockBegin, blockSize, compare, value);
+  });
+
+  uint32 keptCount = 0;
+  for (uint32 blockIndex = 0; blockIndex < blockCount; blockIndex++)
+  {
+    uint32 blockKeptCount = offsets[blockIndex];
+    offsets[blockIndex] = keptCount;
+    keptCount += blockKeptCount;
+  }
+
+  ParallelFor(pThreadPool, 0, blockCount, 1, [pResult, pValues, count, compare, value, &offsets](uint32 blockIndex) {
+    uint32 blockBegin = blockIndex * ParallelArrayBlockSize;
+    uint32 blockSize = Min(count - blockBegin, ParallelArrayBlockSize);
+    Y_array_filter(pResult + offsets[blockIndex], pValues + blockBegin, blockSize, compare, value);
+  });
+
+  return keptCount;
+}
+
+// pResult may not overlap pValues.
+template<typename T>
+T Y_parallel_array_prefix_sum(ThreadPool* pThreadPool, T* pResult, const T* pValues, uint32 count,
+                              typename ArrayAlgorithmsDetail::Identity<T>::Type initial = T())
+{
+  using namespace ArrayAlgorithmsDetail;
+  DebugAssert(pResult + count <= pValues || pValues + count <= pResult);
+
+  uint32 blockCount = (count + ParallelArrayBlockSize - 1) / ParallelArrayBlockSize;
+  if (pThreadPool == nullptr || blockCount <= 1)
+    return Y_array_prefix_sum(pResult, pValues, count, initial);
+
+  // each block's running sum starts from the total of the blocks before
+  PODArray<T> starts;
+  starts.Resize(blockCount);
+  ParallelFor(pThreadPool, 0, blockCount, 1, [pValues, count, &starts](uint32 blockIndex) {
+    uint32 blockBegin = blockIndex * ParallelArrayBlockSize;
+    uint32 blockSize = Min(count - blockBegin, ParallelArrayBlockSize);
+    starts[blockIndex] = Y_array_sum(pValues + blockBegin, blockSize);
+  });
+
+  T total = initial;
+  for (uint32 blockIndex = 0; blockIndex < blockCount; blockIndex++)
+  {
+    T blockSum = starts[blockIndex];
+    starts[blockIndex] = total;
+    total = AddWrapping(total, blockSum);
+  }
+
+  ParallelFor(pThreadPool, 0, blockCount, 1, [pResult, pValues, count, &starts](uint32 blockIndex) {
+    uint32 blockBegin = blockIndex * ParallelArrayBlockSize;
+    uint32 blockSize = Min(count - blockBegin, ParallelArrayBlockSize);
+    Y_array_prefix_sum(pResult + blockBegin, pValues + blockBegin, blockSize, starts[blockIndex]);
+  });
+
+  // rather than the total of the block sums, which for floating point can round differently
+  return pResult[count - 1];
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "YBaseLib/Array.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/ThreadPool.h"
+
+// ParallelFor / ParallelReduce over a ThreadPool.
+// The range is divided into one slot per participant, the pool's workers plus the calling thread. Each participant
+// takes grain-sized chunks from the front of its own slot, and when it runs dry it steals the back half of the
+// largest remaining slot (lazy binary splitting), so ranges are only split further when a thread is idle.
+// One work item is queued per helper rather than per chunk, and the calling thread works on the range itself,
+// returning once every index has been processed.
+// These can be called from inside a pool work item, the caller only ever waits on chunks that are already running.
+
+class ParallelForScheduler
+{
+public:
+  // called for each chunk, participantIndex is stable for the calling thread for one dispatch
+  typedef void (*RangeCallback)(void* pUserData, uint32 participantIndex, uint32 rangeBegin, uint32 rangeEnd);
+
+  // number of threads that may work on the range, at least one
+  static uint32 GetParticipantCount(ThreadPool* pThreadPool, uint32 begin, uint32 end, uint32 grainSize);
+
+  // processes [begin, end) with participantCount threads, including the caller
+  static void Execute(ThreadPool* pThreadPool, uint32 participantCount, uint32 begin, uint32 end, uint32 grainSize,
+                      RangeCallback callback, void* pUserData);
+};
+
+// calls body(rangeBegin, rangeEnd) for chunks covering [begin, end)
+template<class T>
+void ParallelForRange(ThreadPool* pThreadPool, uint32 begin, uint32 end, uint32 grainSize, const T& body)
+{
+  struct Callback
+  {
+    static void Invoke(void* pUserData, uint32 participantIndex, uint32 rangeBegin, uint32 rangeEnd)
+    {
+      (*reinterpret_cast<const T*>(pUserData))(rangeBegin, rangeEnd);
+    }
+  };
+
+  uint32 participantCount = ParallelForScheduler::GetParticipantCount(pThreadPool, begin, end, grainSize);
+  if (participantCount == 1)
+  {
+    if (begin < end)
+      body(begin, end);
+
+    return;
+  }
+
+  ParallelForScheduler::Execute(pThreadPool, participantCount, begin, end, grainSize, &Callback::Invoke,
+                                const_cast<T*>(&body));
+}
+
+// calls body(index) for every index in [begin, end)
+template<class T>
+void ParallelFor(ThreadPool* pThreadPool, uint32 begin, uint32 end, uint32 grainSize, const T& body)
+{
+  ParallelForRange(pThreadPool, begin, end, grainSize, [&body](uint32 rangeBegin, uint32 rangeEnd) {
+    for (uint32 i = rangeBegin; i < rangeEnd; i++)
+      body(i);
+  });
+}
+
+// reduces [begin, end). rangeReduce(rangeBegin, rangeEnd, value) folds a chunk into value and returns the result,
+// combine(a, b) merges two partial results. each participant starts from identity, so combine must be associative
+// and identity must be neutral for it. the order chunks are folded in is not defined.
+template<class T, class RangeReduce, class Combine>
+T ParallelReduce(ThreadPool* pThreadPool, uint32 begin, uint32 end, uint32 grainSize, const T& identity,
+                 const RangeReduce& rangeReduce, const Combine& combine)
+{
+  struct Context
+  {
+    const RangeReduce* pRangeReduce;
+    Array<T> partials;
+
+    static void Invoke(void* pUserData, uint32 participantIndex, uint32 rangeBegin, uint32 rangeEnd)
+    {
+      Context* pContext = reinterpret_cast<Context*>(pUserData);
+      T& partial = pContext->partials[participantIndex];
+      partial = (*pContext->pRangeReduce)(rangeBegin, rangeEnd, partial);
+    }
+  };
+
+  uint32 participantCount = ParallelForScheduler::GetParticipantCount(pThreadPool, begin, end, grainSize);
+  if (participantCount == 1)
+    return (begin < end) ? rangeReduce(begin, end, identity) : identity;
+
+  Context context;
+  context.pRangeReduce = &rangeReduce;
+  context.partials.Reserve(participantCount);
+  for (uint32 i = 0; i < participantCount; i++)
+    context.partials.Add(identity);
+
+  ParallelForScheduler::Execute(pThreadPool, participantCount, begin, end, grainSize, &Context::Invoke, &context);
+
+  T result = context.partials[0];
+  for (uint32 i = 1; i < participantCount; i++)
+    result = combine(result, context.partials[i]);
+
+  return result;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/CacheAligned.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Timer.h"
+
+class ProgressCallbacks;
+
+// Progress of work spread over many threads, which add completed units without locking. The total is passed on to a
+// ProgressCallbacks no more often than the report interval, by whichever thread adds first once it has passed, one
+// thread at a time. While work is being added nothing else may use the callbacks, as they aren't thread-safe.
+//
+// A parallel sub-task can be given a Range of its own, counted in its own units and scaled into a share of its
+// parent's, so it doesn't need to know how the whole job is divided up.
+class ParallelProgress
+{
+  DeclareNonCopyable(ParallelProgress);
+
+public:
+  class Range
+  {
+    DeclareNonCopyable(Range);
+
+  public:
+    // Takes up parentUnits of the parent's units, reaching them all when range units are added. The parent must
+    // outlive it.
+    Range(Range* pParent, uint64 parentUnits, uint64 range);
+
+    uint64 GetRange() const { return m_range; }
+    uint64 GetCompleted() const;
+
+    // Any thread. Units past the range are counted here, but not passed on to the parent.
+    void Add(uint64 units = 1);
+
+    // Any thread. Whether the callbacks were cancelled when last reported to.
+    bool IsCancelled() const { return m_pProgress->IsCancelled(); }
+
+  private:
+    friend class ParallelProgress;
+
+    // the root, which passes what's added straight to the progress
+    Range(ParallelProgress* pProgress, uint64 range);
+
+    uint64 ScaleToParent(uint64 completed) const;
+
+    ParallelProgress* m_pProgress;
+    Range* m_pParent;
+    uint64 m_parentUnits;
+    uint64 m_range;
+    Y_ATOMIC_DECL64 uint64 m_completed;
+  };
+
+  // Reports progress through pCallbacks as a range of its own, setting it straight away.
+  ParallelProgress(ProgressCallbacks* pCallbacks, uint64 range, uint32 reportIntervalMilliseconds = 100);
+
+  // Reports the final total.
+  ~ParallelProgress();
+
+  uint64 GetRange() const { return m_root.GetRange(); }
+  uint64 GetCompleted() const;
+
+  // Any thread.
+  void Add(uint64 units = 1);
+  bool IsCancelled() const { return (Y_AtomicLoad(m_cancelled, ATOMIC_MEMORY_ORDER_RELAXED) != 0); }
+
+  // The root range, for making children of.
+  Range* GetRootRange() { return &m_root; }
+
+  // Passes the total on now, regardless of the interval. Returns false if another thread was already reporting.
+  bool Report();
+
+  Y_DECLARE_CACHE_ALIGNED_NEW();
+
+private:
+  ProgressCallbacks* m_pCallbacks;
+  Range m_root;
+
+  // the callbacks take 32-bit values, larger ranges are scaled down
+  uint32 m_reportedRange;
+
+  // in fast timer ticks
+  uint64 m_reportInterval;
+  Y_ATOMIC_DECL64 uint64 m_nextReportTime;
+  Y_ATOMIC_DECL uint32 m_reporting;
+  Y_ATOMIC_DECL uint32 m_cancelled;
+
+  // added to from every thread, so split to keep them from fighting over one line
+  ShardedCounter<uint64> m_completed;
+};
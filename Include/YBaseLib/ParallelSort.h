@@ -0,0 +1,144 @@
+#pragma once
+#include "YBaseLib/Allocator.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/ParallelFor.h"
+#include "YBaseLib/Sort.h"
+#include <new>
+#include <utility>
+
+// Y_parallel_sort sorts contiguous chunks with Y_sort across the pool, then merges pairs of runs until one is
+// left, moving elements between the array and a buffer of the same size. Each merge is split along the merge
+// path so every round has the same number of independent pieces, even the last one. Not stable.
+// Small arrays, or a null pool, are sorted on the calling thread.
+
+namespace SortDetail {
+
+// chunks below this aren't worth handing to another thread
+static const size_t ParallelSortMinChunkSize = 8192;
+
+// number of elements of the first run that come before output position diagonal when merging. ties go to the
+// first run, matching MergeRuns.
+template<typename T, typename Compare>
+size_t FindMergeSplit(const T* pFirst, size_t firstCount, const T* pSecond, size_t secondCount, size_t diagonal,
+                      const Compare& compare)
+{
+  size_t low = (diagonal > secondCount) ? (diagonal - secondCount) : 0;
+  size_t high = Min(diagonal, firstCount);
+  while (low < high)
+  {
+    size_t middle = low + (high - low) / 2;
+    if (!compare(pSecond[diagonal - middle - 1], pFirst[middle]))
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return low;
+}
+
+template<typename T, typename Compare>
+void MergeRuns(T* pDestination, T* pFirst, T* pFirstEnd, T* pSecond, T* pSecondEnd, const Compare& compare)
+{
+  while (pFirst != pFirstEnd && pSecond != pSecondEnd)
+  {
+    if (compare(*pSecond, *pFirst))
+      *(pDestination++) = std::move(*(pSecond++));
+    else
+      *(pDestination++) = std::move(*(pFirst++));
+  }
+  while (pFirst != pFirstEnd)
+    *(pDestination++) = std::move(*(pFirst++));
+  while (pSecond != pSecondEnd)
+    *(pDestination++) = std::move(*(pSecond++));
+}
+
+}; // namespace SortDetail
+
+template<typename T, typename Compare>
+void Y_parallel_sort(ThreadPool* pThreadPool, T* pBase, size_t count, Compare compare)
+{
+  using namespace SortDetail;
+
+  // power of two chunks, so the merge tree is balanced
+  uint32 chunkCount = 1;
+  if (pThreadPool != nullptr && count <= 0xFFFFFFFFu)
+  {
+    uint32 participantCount = pThreadPool->GetWorkerThreadCount() + 1;
+    while (chunkCount < participantCount && (count / (chunkCount * 2)) >= ParallelSortMinChunkSize)
+      chunkCount *= 2;
+  }
+  if (chunkCount == 1)
+  {
+    Y_sort(pBase, count, compare);
+    return;
+  }
+
+  size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+  ParallelFor(pThreadPool, 0, chunkCount, 1, [pBase, count, chunkSize, &compare](uint32 chunkIndex) {
+    size_t chunkBegin = Min((size_t)chunkIndex * chunkSize, count);
+    size_t chunkEnd = Min(chunkBegin + chunkSize, count);
+    Y_sort(pBase + chunkBegin, chunkEnd - chunkBegin, compare);
+  });
+
+  HeapAllocator allocator;
+  T* pBuffer = reinterpret_cast<T*>(allocator.Allocate(sizeof(T) * count, alignof(T)));
+  Assert(pBuffer != nullptr);
+  ParallelFor(pThreadPool, 0, chunkCount, 1, [pBase, pBuffer, count, chunkSize](uint32 chunkIndex) {
+    size_t chunkBegin = Min((size_t)chunkIndex * chunkSize, count);
+    size_t chunkEnd = Min(chunkBegin + chunkSize, count);
+    for (size_t i = chunkBegin; i < chunkEnd; i++)
+      new (&pBuffer[i]) T(std::move(pBase[i]));
+  });
+
+  // after the move, the buffer holds the sorted chunks and every element in both arrays is constructed
+  T* pSource = pBuffer;
+  T* pDestination = pBase;
+  for (size_t runSize = chunkSize; runSize < count; runSize *= 2)
+  {
+    // chunkCount pieces per round, split evenly between the pairs of runs
+    size_t pairCount = (count + runSize * 2 - 1) / (runSize * 2);
+    uint32 piecesPerPair = (uint32)Max(chunkCount / pairCount, (size_t)1);
+    uint32 pieceCount = (uint32)(pairCount * piecesPerPair);
+    ParallelFor(pThreadPool, 0, pieceCount, 1,
+                [pSource, pDestination, count, runSize, piecesPerPair, &compare](uint32 pieceIndex) {
+                  size_t pairBegin = (size_t)(pieceIndex / piecesPerPair) * runSize * 2;
+                  size_t pairMiddle = Min(pairBegin + runSize, count);
+                  size_t pairEnd = Min(pairMiddle + runSize, count);
+                  size_t pairSize = pairEnd - pairBegin;
+                  size_t piece = pieceIndex % piecesPerPair;
+
+                  T* pFirst = pSource + pairBegin;
+                  T* pSecond = pSource + pairMiddle;
+                  size_t firstCount = pairMiddle - pairBegin;
+                  size_t secondCount = pairEnd - pairMiddle;
+                  size_t outputBegin = pairSize * piece / piecesPerPair;
+                  size_t outputEnd = pairSize * (piece + 1) / piecesPerPair;
+                  size_t firstBegin = FindMergeSplit(pFirst, firstCount, pSecond, secondCount, outputBegin, compare);
+                  size_t firstEnd = FindMergeSplit(pFirst, firstCount, pSecond, secondCount, outputEnd, compare);
+                  MergeRuns(pDestination + pairBegin + outputBegin, pFirst + firstBegin, pFirst + firstEnd,
+                            pSecond + (outputBegin - firstBegin), pSecond + (outputEnd - firstEnd), compare);
+                });
+
+    std::swap(pSource, pDestination);
+  }
+
+  ParallelFor(pThreadPool, 0, chunkCount, 1, [pBase, pBuffer, pSource, count, chunkSize](uint32 chunkIndex) {
+    size_t chunkBegin = Min((size_t)chunkIndex * chunkSize, count);
+    size_t chunkEnd = Min(chunkBegin + chunkSize, count);
+    for (size_t i = chunkBegin; i < chunkEnd; i++)
+    {
+      if (pSource != pBase)
+        pBase[i] = std::move(pBuffer[i]);
+
+      pBuffer[i].~T();
+    }
+  });
+
+  allocator.Free(pBuffer, sizeof(T) * count, alignof(T));
+}
+
+template<typename T>
+void Y_parallel_sort(ThreadPool* pThreadPool, T* pBase, size_t count)
+{
+  Y_parallel_sort(pThreadPool, pBase, count, [](const T& left, const T& right) { return left < right; });
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/ParallelFor.h"
+#include "YBaseLib/TextReader.h"
+
+// the text a participant takes at a time, moved on to the next line break
+static const uint32 ParallelTextReaderChunkSize = 1024 * 1024;
+
+// Splits a stream that's in memory, like a file opened with BYTESTREAM_OPEN_MAPPED, into chunks at line breaks and
+// calls body(offset, line) for every line, from the pool's workers and the calling thread. The offset is where the
+// line starts in the stream, so results can be put back in order: lines within a chunk come in order, but chunks
+// are read at the same time. Lines are stripped of their line breaks like TextReader's, and point into the stream's
+// memory. The stream's position isn't used or moved. Returns false if the stream has no memory to split
+// (GetBasePointer), which TextReader can still read a line at a time.
+template<class T>
+bool ParallelForEachLine(ThreadPool* pThreadPool, ByteStream* pStream, const T& body,
+                         uint32 chunkSize = ParallelTextReaderChunkSize)
+{
+  const char* pText = reinterpret_cast<const char*>(pStream->GetBasePointer());
+  if (pText == nullptr)
+    return false;
+
+  // a line belongs to the chunk it starts in
+  uint64 textLength = pStream->GetSize();
+  uint32 chunkCount = uint32((textLength + chunkSize - 1) / chunkSize);
+  ParallelFor(pThreadPool, 0, chunkCount, 1, [pText, textLength, chunkSize, &body](uint32 chunkIndex) {
+    const char* pPosition = pText + TextReader::FindLineStart(pText, textLength, uint64(chunkIndex) * chunkSize);
+    const char* pEnd = pText + TextReader::FindLineStart(pText, textLength, uint64(chunkIndex + 1) * chunkSize);
+    const char* pLineStart = pPosition;
+    StringView line;
+    while (TextReader::SplitLine(&pPosition, pEnd, &line))
+    {
+      body(uint64(pLineStart - pText), line);
+      pLineStart = pPosition;
+    }
+  });
+
+  return true;
+}
@@ -0,0 +1,469 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/NonCopyable.h"
+#include "YBaseLib/PODArray.h"
+
+// Radix tree of values keyed by '/' separated paths, for questions a hash table of paths can only answer by looking
+// at every key: what's under a directory, and which stored path is the longest prefix of another. Each node's label
+// is one or more components, with runs of nodes that have a single child and no value folded into one, and children
+// are kept sorted by their first component and binary searched. Listing a directory only visits what's under it.
+//
+// Paths are split at every '/', so "a//b", "/a/b" and "a/b/" are all different paths from "a/b", with an empty
+// component where there's nothing between separators, and a path matches another as a prefix only at a separator.
+// With FLAG_CASE_INSENSITIVE, components are compared as Y_stricmp does, and a path keeps the case it was inserted
+// with. Values must be default constructible and assignable. Not thread-safe for changes.
+//   PathTrie<uint32> files(PathTrie<uint32>::FLAG_CASE_INSENSITIVE);
+//   files.Set("textures/stone.png", index);
+//   files.EnumerateUnder("textures", false, [](const char* path, uint32 length, const uint32& value) { ... });
+template<typename ValueType>
+class PathTrie
+{
+public:
+  enum FLAGS
+  {
+    FLAG_CASE_INSENSITIVE = (1 << 0),
+  };
+
+  PathTrie(uint32 flags = 0) : m_flags(flags), m_valueCount(0)
+  {
+    m_root.pParent = nullptr;
+    m_root.pLabel = nullptr;
+    m_root.LabelLength = 0;
+    m_root.HasValue = false;
+  }
+
+  ~PathTrie() { Clear(); }
+
+  uint32 GetValueCount() const { return m_valueCount; }
+
+  void Clear()
+  {
+    for (uint32 i = 0; i < m_root.Children.GetSize(); i++)
+      DeleteNode(m_root.Children[i]);
+
+    m_root.Children.Obliterate();
+    m_valueCount = 0;
+  }
+
+  ValueType* Find(const char* path)
+  {
+    Position position;
+    Descend(path, Y_strlen(path), &position);
+    return (position.Path.Done && position.Label.Done && position.pNode->HasValue) ? &position.pNode->Value : nullptr;
+  }
+  const ValueType* Find(const char* path) const { return const_cast<PathTrie*>(this)->Find(path); }
+
+  // Adds the path with a copy of value if it isn't there. Either way, returns the path's value.
+  ValueType* Insert(const char* path, const ValueType& value, bool* pIsNew = nullptr)
+  {
+    Node* pNode = GetOrCreateNode(path, Y_strlen(path));
+    bool isNew = !pNode->HasValue;
+    if (isNew)
+    {
+      pNode->Value = value;
+      pNode->HasValue = true;
+      m_valueCount++;
+    }
+
+    if (pIsNew != nullptr)
+      *pIsNew = isNew;
+
+    return &pNode->Value;
+  }
+
+  // adds the path, or replaces its value
+  ValueType* Set(const char* path, const ValueType& value)
+  {
+    bool isNew;
+    ValueType* pValue = Insert(path, value, &isNew);
+    if (!isNew)
+      *pValue = value;
+
+    return pValue;
+  }
+
+  bool Remove(const char* path)
+  {
+    Position position;
+    Descend(path, Y_strlen(path), &position);
+    Node* pNode = position.pNode;
+    if (!position.Path.Done || !position.Label.Done || !pNode->HasValue)
+      return false;
+
+    pNode->Value = ValueType();
+    pNode->HasValue = false;
+    m_valueCount--;
+
+    // take out nodes left with nothing under them, then fold what's left into its only child
+    while (pNode != &m_root && !pNode->HasValue && pNode->Children.IsEmpty())
+    {
+      Node* pParent = pNode->pParent;
+      RemoveChild(pParent, pNode);
+      DeleteNode(pNode);
+      pNode = pParent;
+    }
+    if (pNode != &m_root && !pNode->HasValue && pNode->Children.GetSize() == 1)
+      MergeWithChild(pNode);
+
+    return true;
+  }
+
+  // The value of the longest stored path that path is or starts with, ending at a separator, with that path's length
+  // in pPrefixLength. Null if none is.
+  ValueType* FindLongestPrefix(const char* path, uint32* pPrefixLength = nullptr)
+  {
+    Position position;
+    Node* pBest = nullptr;
+    uint32 bestLength = 0;
+    Descend(path, Y_strlen(path), &position, &pBest, &bestLength);
+    if (pPrefixLength != nullptr)
+      *pPrefixLength = bestLength;
+
+    return (pBest != nullptr) ? &pBest->Value : nullptr;
+  }
+  const ValueType* FindLongestPrefix(const char* path, uint32* pPrefixLength = nullptr) const
+  {
+    return const_cast<PathTrie*>(this)->FindLongestPrefix(path, pPrefixLength);
+  }
+
+  // Calls callback(const char* path, uint32 pathLength, const ValueType& value) for each stored path under path, one
+  // component below it unless recursive, and returns how many there were. Siblings come in component order. An empty
+  // path is the top of the tree, so the paths under it are every path, or those with one component.
+  template<class Callback>
+  uint32 EnumerateUnder(const char* path, bool recursive, Callback callback) const
+  {
+    uint32 pathLength = Y_strlen(path);
+    Position position;
+    if (pathLength > 0)
+    {
+      const_cast<PathTrie*>(this)->Descend(path, pathLength, &position);
+      if (!position.Path.Done)
+        return 0;
+    }
+    else
+    {
+      position.pNode = const_cast<Node*>(&m_root);
+    }
+
+    // the path so far, built up as the nodes are walked, with the case the paths were stored with
+    PODArray<char> buffer;
+    const Node* pNode = position.pNode;
+    AppendNodePath(pNode, buffer);
+    if (position.Label.Done)
+    {
+      uint32 count = 0;
+      for (uint32 i = 0; i < pNode->Children.GetSize(); i++)
+        count += EnumerateNode(pNode->Children[i], 0, recursive, buffer, callback);
+      return count;
+    }
+
+    // the path ends part way along this node's label, so the node is the rest of its label below it
+    uint32 depth = CountComponents(pNode->pLabel + position.Label.Pos, pNode->LabelLength - position.Label.Pos);
+    return EnumerateSubtree(pNode, depth, recursive, buffer, callback);
+  }
+
+private:
+  struct Node
+  {
+    Node* pParent;
+    PODArray<Node*> Children;
+
+    // one or more components, Y_malloc'd
+    char* pLabel;
+    uint32 LabelLength;
+
+    bool HasValue;
+    ValueType Value;
+  };
+
+  // walks the components of a path or label
+  struct Cursor
+  {
+    Cursor() : pString(nullptr), Length(0), Pos(0), Done(true) {}
+    Cursor(const char* pString_, uint32 length) : pString(pString_), Length(length), Pos(0), Done(false) {}
+
+    // the next component, without moving on
+    uint32 PeekLength() const
+    {
+      uint32 end = Pos;
+      while (end < Length && pString[end] != '/')
+        end++;
+      return end - Pos;
+    }
+
+    // moves past the next component and its separator, a separator at the end leaves an empty component
+    void Skip(uint32 componentLength)
+    {
+      Pos += componentLength;
+      if (Pos < Length)
+        Pos++;
+      else
+        Done = true;
+    }
+
+    const char* pString;
+    uint32 Length;
+    uint32 Pos;
+    bool Done;
+  };
+
+  // how far a path got down the tree: the last node reached, how much of its label matched, and what's left of the
+  // path, either of which may be done
+  struct Position
+  {
+    Node* pNode;
+    Cursor Label;
+    Cursor Path;
+  };
+
+  int32 CompareComponents(const char* pLeft, uint32 leftLength, const char* pRight, uint32 rightLength) const
+  {
+    return (m_flags & FLAG_CASE_INSENSITIVE) ? Y_stricmp(pLeft, leftLength, pRight, rightLength) :
+                                               Y_strcmp(pLeft, leftLength, pRight, rightLength);
+  }
+
+  static uint32 FirstComponentLength(const Node* pNode)
+  {
+    Cursor cursor(pNode->pLabel, pNode->LabelLength);
+    return cursor.PeekLength();
+  }
+
+  static uint32 CountComponents(const char* pString, uint32 length)
+  {
+    uint32 count = 1;
+    for (uint32 i = 0; i < length; i++)
+      count += (pString[i] == '/') ? 1 : 0;
+    return count;
+  }
+
+  // index of the first child whose first component doesn't order before the given one
+  uint32 FindChildIndex(const Node* pNode, const char* pComponent, uint32 componentLength) const
+  {
+    uint32 first = 0;
+    uint32 count = pNode->Children.GetSize();
+    while (count > 0)
+    {
+      uint32 half = count / 2;
+      const Node* pChild = pNode->Children[first + half];
+      if (CompareComponents(pChild->pLabel, FirstComponentLength(pChild), pComponent, componentLength) < 0)
+      {
+        first += half + 1;
+        count -= half + 1;
+      }
+      else
+      {
+        count = half;
+      }
+    }
+
+    return first;
+  }
+
+  Node* FindChild(const Node* pNode, const char* pComponent, uint32 componentLength) const
+  {
+    uint32 index = FindChildIndex(pNode, pComponent, componentLength);
+    if (index == pNode->Children.GetSize())
+      return nullptr;
+
+    Node* pChild = pNode->Children[index];
+    return (CompareComponents(pChild->pLabel, FirstComponentLength(pChild), pComponent, componentLength) == 0) ?
+             pChild :
+             nullptr;
+  }
+
+  // Matches the path's components against the tree for as long as they match, noting the deepest node with a value
+  // that the path has fully matched, and the length of the path to it.
+  void Descend(const char* path, uint32 pathLength, Position* pPosition, Node** ppLastValue = nullptr,
+               uint32* pLastValueLength = nullptr)
+  {
+    Node* pNode = &m_root;
+    Cursor label;
+    Cursor pathCursor(path, pathLength);
+    while (!pathCursor.Done)
+    {
+      uint32 pathComponentLength = pathCursor.PeekLength();
+      if (label.Done)
+      {
+        Node* pChild = FindChild(pNode, path + pathCursor.Pos, pathComponentLength);
+        if (pChild == nullptr)
+          break;
+
+        pNode = pChild;
+        label = Cursor(pNode->pLabel, pNode->LabelLength);
+      }
+
+      uint32 labelComponentLength = label.PeekLength();
+      if (CompareComponents(label.pString + label.Pos, labelComponentLength, path + pathCursor.Pos,
+                            pathComponentLength) != 0)
+      {
+        break;
+      }
+
+      label.Skip(labelComponentLength);
+      uint32 matchedLength = pathCursor.Pos + pathComponentLength;
+      pathCursor.Skip(pathComponentLength);
+      if (label.Done && pNode->HasValue && ppLastValue != nullptr)
+      {
+        *ppLastValue = pNode;
+        *pLastValueLength = matchedLength;
+      }
+    }
+
+    pPosition->pNode = pNode;
+    pPosition->Label = label;
+    pPosition->Path = pathCursor;
+  }
+
+  Node* NewNode(Node* pParent, const char* pLabel, uint32 labelLength)
+  {
+    Node* pNode = new Node();
+    pNode->pParent = pParent;
+    pNode->pLabel = static_cast<char*>(Y_malloc(Max(labelLength, 1u)));
+    Y_memcpyT(pNode->pLabel, pLabel, labelLength);
+    pNode->LabelLength = labelLength;
+    pNode->HasValue = false;
+    return pNode;
+  }
+
+  static void DeleteNode(Node* pNode)
+  {
+    for (uint32 i = 0; i < pNode->Children.GetSize(); i++)
+      DeleteNode(pNode->Children[i]);
+
+    Y_free(pNode->pLabel);
+    delete pNode;
+  }
+
+  void AddChild(Node* pParent, Node* pChild)
+  {
+    uint32 index = FindChildIndex(pParent, pChild->pLabel, FirstComponentLength(pChild));
+    pParent->Children.Insert(pChild, index);
+  }
+
+  void RemoveChild(Node* pParent, Node* pChild)
+  {
+    uint32 index = FindChildIndex(pParent, pChild->pLabel, FirstComponentLength(pChild));
+    DebugAssert(index < pParent->Children.GetSize() && pParent->Children[index] == pChild);
+    pParent->Children.OrderedRemove(index);
+  }
+
+  // Cuts the node's label before the component at labelPos, which moves to a new child along with the node's
+  // value and children. The first component stays, so the node keeps its place among its siblings.
+  void Split(Node* pNode, uint32 labelPos)
+  {
+    DebugAssert(labelPos > 0 && pNode->pLabel[labelPos - 1] == '/');
+    Node* pLower = NewNode(pNode, pNode->pLabel + labelPos, pNode->LabelLength - labelPos);
+    pLower->Children.Swap(pNode->Children);
+    for (uint32 i = 0; i < pLower->Children.GetSize(); i++)
+      pLower->Children[i]->pParent = pLower;
+    pLower->HasValue = pNode->HasValue;
+    pLower->Value = pNode->Value;
+
+    pNode->LabelLength = labelPos - 1;
+    pNode->HasValue = false;
+    pNode->Value = ValueType();
+    pNode->Children.Add(pLower);
+  }
+
+  // folds a node with no value into its only child, which takes its place
+  void MergeWithChild(Node* pNode)
+  {
+    DebugAssert(!pNode->HasValue && pNode->Children.GetSize() == 1);
+    Node* pChild = pNode->Children[0];
+    Node* pParent = pNode->pParent;
+
+    uint32 labelLength = pNode->LabelLength + 1 + pChild->LabelLength;
+    char* pLabel = static_cast<char*>(Y_malloc(labelLength));
+    Y_memcpyT(pLabel, pNode->pLabel, pNode->LabelLength);
+    pLabel[pNode->LabelLength] = '/';
+    Y_memcpyT(pLabel + pNode->LabelLength + 1, pChild->pLabel, pChild->LabelLength);
+
+    RemoveChild(pParent, pNode);
+    Y_free(pChild->pLabel);
+    pChild->pLabel = pLabel;
+    pChild->LabelLength = labelLength;
+    pChild->pParent = pParent;
+    AddChild(pParent, pChild);
+
+    pNode->Children.Clear();
+    DeleteNode(pNode);
+  }
+
+  Node* GetOrCreateNode(const char* path, uint32 pathLength)
+  {
+    Position position;
+    Descend(path, pathLength, &position);
+    Node* pNode = position.pNode;
+
+    // a path ending or turning off part way along a label needs a node where it does
+    if (!position.Label.Done)
+      Split(pNode, position.Label.Pos);
+
+    if (position.Path.Done)
+      return pNode;
+
+    Node* pChild = NewNode(pNode, path + position.Path.Pos, pathLength - position.Path.Pos);
+    AddChild(pNode, pChild);
+    return pChild;
+  }
+
+  static void AppendNodePath(const Node* pNode, PODArray<char>& buffer)
+  {
+    if (pNode->pParent == nullptr)
+      return;
+
+    AppendNodePath(pNode->pParent, buffer);
+    if (pNode->pParent->pParent != nullptr)
+      buffer.Add('/');
+    buffer.AddRange(pNode->pLabel, pNode->LabelLength);
+  }
+
+  // reports the node if it's at the right depth, and what's under it, with the buffer holding its path
+  template<class Callback>
+  uint32 EnumerateSubtree(const Node* pNode, uint32 depth, bool recursive, PODArray<char>& buffer,
+                          Callback& callback) const
+  {
+    uint32 count = 0;
+    if (pNode->HasValue && (recursive || depth == 1))
+    {
+      buffer.Add('\0');
+      callback(buffer.GetBasePointer(), buffer.GetSize() - 1, pNode->Value);
+      buffer.RemoveBack();
+      count++;
+    }
+
+    if (recursive || depth < 1)
+    {
+      for (uint32 i = 0; i < pNode->Children.GetSize(); i++)
+        count += EnumerateNode(pNode->Children[i], depth, recursive, buffer, callback);
+    }
+
+    return count;
+  }
+
+  template<class Callback>
+  uint32 EnumerateNode(const Node* pNode, uint32 parentDepth, bool recursive, PODArray<char>& buffer,
+                       Callback& callback) const
+  {
+    uint32 bufferLength = buffer.GetSize();
+    if (pNode->pParent != &m_root)
+      buffer.Add('/');
+    buffer.AddRange(pNode->pLabel, pNode->LabelLength);
+
+    uint32 count = EnumerateSubtree(pNode, parentDepth + CountComponents(pNode->pLabel, pNode->LabelLength),
+                                    recursive, buffer, callback);
+    buffer.Resize(bufferLength);
+    return count;
+  }
+
+  uint32 m_flags;
+  uint32 m_valueCount;
+
+  // has no label, its children's first components are the first components of paths
+  Node m_root;
+
+  DeclareNonCopyable(PathTrie);
+};
@@ -0,0 +1,205 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/NonCopyable.h"
+#include "YBaseLib/PODArray.h"
+
+class ThreadPool;
+
+enum PIPELINE_STAGE_MODE
+{
+  // one item at a time, in the order the source produced them
+  PIPELINE_STAGE_SERIAL,
+
+  // several items at once, each passed on as soon as it's done
+  PIPELINE_STAGE_PARALLEL,
+
+  // several items at once, passed on in the order the source produced them
+  PIPELINE_STAGE_ORDERED_PARALLEL,
+};
+
+class PipelineQueueBase
+{
+public:
+  virtual ~PipelineQueueBase() {}
+};
+
+// The items passed from one stage to the next. There's a slot for each item the pipeline can have in flight, and
+// an item keeps its slot from the source to the sink, so the queues between stages are bounded by construction.
+// Slots are constructed once, when the stage is added, and reused for every item after, so buffers in them keep
+// their memory from one item to the next.
+template<class T>
+class PipelineQueue : public PipelineQueueBase
+{
+public:
+  PipelineQueue(uint32 slotCount) : m_pItems(new T[slotCount]) {}
+  virtual ~PipelineQueue() override { delete[] m_pItems; }
+
+  T& GetItem(uint32 slot) { return m_pItems[slot]; }
+
+private:
+  T* m_pItems;
+
+  DeclareNonCopyable(PipelineQueue);
+};
+
+// A chain of stages from a source to a sink, run on a thread pool's workers and the thread calling Run, e.g.
+//   Pipeline pipeline(16);
+//   PipelineQueue<Chunk>* pChunks = pipeline.AddSource<Chunk>([&](Chunk& chunk) { return ReadChunk(&chunk); });
+//   PipelineQueue<Block>* pBlocks = pipeline.AddStage<Block>(
+//     pChunks, PIPELINE_STAGE_ORDERED_PARALLEL, [](Chunk& chunk, Block& block) { Inflate(chunk, &block); });
+//   pipeline.AddSink(pBlocks, PIPELINE_STAGE_SERIAL, [&](Block& block) { Upload(block); });
+//   pipeline.Run(pThreadPool);
+//
+// No more than maxItemsInFlight items are ever between the source and the sink. Once that many are, the source isn't
+// called until the sink has finished one, so a fast stage waits for a slow one rather than piling up work for it,
+// and memory use is fixed however the stages' speeds compare. Workers are only taken from the pool while there's a
+// stage they can run, and go back to the pool rather than waiting for one. Stages further down the chain go first,
+// so finished work drains before new work is started.
+//
+// The source is called one item at a time and returns false once it has nothing more. Each stage is called with the
+// item from the stage before it and the item it fills in for the next, and the sink with the last item. Parallel
+// stages are called from several threads at once, with up to maxParallelism items, or as many as are in flight if it
+// is zero. Items are handed between threads under a lock, so stages should do more work per item than that costs.
+class Pipeline
+{
+public:
+  Pipeline(uint32 maxItemsInFlight = 16);
+  ~Pipeline();
+
+  uint32 GetMaxItemsInFlight() const { return m_maxItemsInFlight; }
+
+  // bool function(Out& output)
+  template<class Out, class Function>
+  PipelineQueue<Out>* AddSource(const Function& function)
+  {
+    DebugAssert(m_stages.GetSize() == 0);
+    PipelineQueue<Out>* pOutput = AddQueue<Out>();
+    m_stages.Add(new SourceStage<Out, Function>(function, pOutput));
+    return pOutput;
+  }
+
+  // void function(In& input, Out& output)
+  template<class Out, class In, class Function>
+  PipelineQueue<Out>* AddStage(PipelineQueue<In>* pInput, PIPELINE_STAGE_MODE mode, const Function& function,
+                               uint32 maxParallelism = 0)
+  {
+    DebugAssert(pInput == m_pLastQueue);
+    PipelineQueue<Out>* pOutput = AddQueue<Out>();
+    m_stages.Add(new TransformStage<In, Out, Function>(mode, maxParallelism, function, pInput, pOutput));
+    return pOutput;
+  }
+
+  // void function(In& input)
+  template<class In, class Function>
+  void AddSink(PipelineQueue<In>* pInput, PIPELINE_STAGE_MODE mode, const Function& function, uint32 maxParallelism = 0)
+  {
+    DebugAssert(pInput == m_pLastQueue);
+    m_stages.Add(new SinkStage<In, Function>(mode, maxParallelism, function, pInput));
+    m_pLastQueue = nullptr;
+  }
+
+  // Runs until the source is exhausted and everything it produced has reached the sink, or until cancelled.
+  // Without a thread pool everything runs on the calling thread. Returns false if cancelled.
+  bool Run(ThreadPool* pThreadPool);
+
+  // Stops calling the source, from a stage or any other thread while running. Items already in flight still go
+  // through the rest of the pipeline, so nothing is left half done.
+  void Cancel();
+
+  // A stage, as the pipeline runs it on an item's slot.
+  class Stage
+  {
+  public:
+    Stage(PIPELINE_STAGE_MODE mode, uint32 maxParallelism) : m_mode(mode), m_maxParallelism(maxParallelism) {}
+    virtual ~Stage() {}
+
+    PIPELINE_STAGE_MODE GetMode() const { return m_mode; }
+    uint32 GetMaxParallelism() const { return m_maxParallelism; }
+
+    // returns false from the source when it has nothing more
+    virtual bool Process(uint32 slot) = 0;
+
+  private:
+    PIPELINE_STAGE_MODE m_mode;
+    uint32 m_maxParallelism;
+  };
+
+private:
+  template<class Out, class Function>
+  class SourceStage : public Stage
+  {
+  public:
+    SourceStage(const Function& function, PipelineQueue<Out>* pOutput)
+      : Stage(PIPELINE_STAGE_SERIAL, 1), m_function(function), m_pOutput(pOutput)
+    {
+    }
+
+    virtual bool Process(uint32 slot) override { return m_function(m_pOutput->GetItem(slot)); }
+
+  private:
+    Function m_function;
+    PipelineQueue<Out>* m_pOutput;
+  };
+
+  template<class In, class Out, class Function>
+  class TransformStage : public Stage
+  {
+  public:
+    TransformStage(PIPELINE_STAGE_MODE mode, uint32 maxParallelism, const Function& function,
+                   PipelineQueue<In>* pInput, PipelineQueue<Out>* pOutput)
+      : Stage(mode, maxParallelism), m_function(function), m_pInput(pInput), m_pOutput(pOutput)
+    {
+    }
+
+    virtual bool Process(uint32 slot) override
+    {
+      m_function(m_pInput->GetItem(slot), m_pOutput->GetItem(slot));
+      return true;
+    }
+
+  private:
+    Function m_function;
+    PipelineQueue<In>* m_pInput;
+    PipelineQueue<Out>* m_pOutput;
+  };
+
+  template<class In, class Function>
+  class SinkStage : public Stage
+  {
+  public:
+    SinkStage(PIPELINE_STAGE_MODE mode, uint32 maxParallelism, const Function& function, PipelineQueue<In>* pInput)
+      : Stage(mode, maxParallelism), m_function(function), m_pInput(pInput)
+    {
+    }
+
+    virtual bool Process(uint32 slot) override
+    {
+      m_function(m_pInput->GetItem(slot));
+      return true;
+    }
+
+  private:
+    Function m_function;
+    PipelineQueue<In>* m_pInput;
+  };
+
+  template<class T>
+  PipelineQueue<T>* AddQueue()
+  {
+    PipelineQueue<T>* pQueue = new PipelineQueue<T>(m_maxItemsInFlight);
+    m_queues.Add(pQueue);
+    m_pLastQueue = pQueue;
+    return pQueue;
+  }
+
+  uint32 m_maxItemsInFlight;
+  PODArray<Stage*> m_stages;
+  PODArray<PipelineQueueBase*> m_queues;
+  PipelineQueueBase* m_pLastQueue;
+
+  // read by the run in progress when it's about to call the source
+  volatile bool m_cancelled;
+
+  DeclareNonCopyable(Pipeline);
+};
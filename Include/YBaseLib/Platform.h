@@ -16,7 +16,36 @@ bool GetProgramFileName(String& destination);
 // get memory usage of the process in bytes
 size_t GetProgramMemoryUsage();
 
+// Fills ppFrames with the return addresses of the calling stack, innermost first, starting skipFrames above the
+// caller, and returns how many there were. For profilers, so it doesn't allocate or take locks once it's been
+// called the first time. Returns 0 if the platform can't walk the stack.
+uint32 CaptureCallStack(void** ppFrames, uint32 maxFrames, uint32 skipFrames);
+
 // initialize socket support.
 bool InitializeSocketSupport(Error* pError);
 
+// Maps the same size bytes of memory twice, back to back, so reads and writes running off the end of the first
+// view carry on at the start of it again. size must be a multiple of GetMirroredMemoryGranularity().
+// Returns null if the platform can't do this.
+void* AllocateMirroredMemory(size_t size);
+void FreeMirroredMemory(void* pMemory, size_t size);
+size_t GetMirroredMemoryGranularity();
+
+// Address space with no memory behind it until pages are committed, so what's put there never has to move. Committed
+// pages read as zero the first time, and decommitting gives their memory back but keeps the range reserved. Addresses
+// and sizes are multiples of GetVirtualMemoryPageSize(), and Release takes the size that was reserved. flags are
+// Y_MALLOC_FLAGS, with huge pages the range is also aligned so the kernel can back all of it with them. Reserve
+// returns null if there isn't the address space, or the platform has no virtual memory.
+void* ReserveVirtualMemory(size_t size, uint32 flags);
+bool CommitVirtualMemory(void* pMemory, size_t size);
+void DecommitVirtualMemory(void* pMemory, size_t size);
+void ReleaseVirtualMemory(void* pMemory, size_t size);
+size_t GetVirtualMemoryPageSize();
+
+// Applies Y_MALLOC_FLAGS to the whole pages in a range, for pages that haven't been touched yet. Linux backs ranges of
+// 2MB and more with transparent huge pages, and prefers the calling thread's NUMA node. Windows has no hints for
+// memory that's already allocated, it takes them when reserving instead, and only for the NUMA node: large pages
+// have to be committed as they're reserved and need a privilege. Elsewhere this does nothing.
+void AdviseMemory(void* pMemory, size_t size, uint32 flags);
+
 }; // namespace Platform
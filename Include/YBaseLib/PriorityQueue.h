@@ -0,0 +1,321 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/MemArray.h"
+#include "YBaseLib/PODArray.h"
+#include <functional>
+#include <utility>
+
+// Heaps with Arity children per node, 4 by default. A wider node makes the tree shallower and puts each node's
+// children in one or two cache lines, so pushes compare less and pops touch fewer lines than in a binary heap.
+// The comparator is a callable like operator<, as for Y_sort, and the element ordering first is on top.
+//   PriorityQueue         push, pop and peek at the top, O(log n)
+//   IndexedPriorityQueue  the same, with a handle for each element so it can be updated or removed, e.g. for timers
+// Elements are kept in a MemArray, so must be relocatable by memcpy.
+
+namespace HeapDetail {
+
+// Moves the hole at index towards the root until value orders after its parent, calling place(index, value) for
+// every element moved down into the hole, and finally for value.
+template<uint32 Arity, class T, class Compare, class Place>
+void SiftUp(T* pBase, uint32 index, T value, Compare& compare, Place& place)
+{
+  while (index > 0)
+  {
+    uint32 parent = (index - 1) / Arity;
+    if (!compare(value, pBase[parent]))
+      break;
+
+    place(index, std::move(pBase[parent]));
+    index = parent;
+  }
+
+  place(index, std::move(value));
+}
+
+// Moves the hole at index towards the leaves until none of its children order before value.
+template<uint32 Arity, class T, class Compare, class Place>
+void SiftDown(T* pBase, uint32 index, uint32 count, T value, Compare& compare, Place& place)
+{
+  for (;;)
+  {
+    uint32 firstChild = index * Arity + 1;
+    if (firstChild >= count)
+      break;
+
+    uint32 endChild = (count - firstChild > Arity) ? (firstChild + Arity) : count;
+    uint32 bestChild = firstChild;
+    for (uint32 child = firstChild + 1; child < endChild; child++)
+    {
+      if (compare(pBase[child], pBase[bestChild]))
+        bestChild = child;
+    }
+
+    if (!compare(pBase[bestChild], value))
+      break;
+
+    place(index, std::move(pBase[bestChild]));
+    index = bestChild;
+  }
+
+  place(index, std::move(value));
+}
+
+} // namespace HeapDetail
+
+template<class T, class Compare = std::less<T>, uint32 Arity = 4>
+class PriorityQueue
+{
+  static_assert(Arity >= 2, "heaps need at least two children per node");
+
+public:
+  PriorityQueue(const Compare& compare = Compare()) : m_compare(compare) {}
+
+  uint32 GetSize() const { return m_elements.GetSize(); }
+  bool IsEmpty() const { return m_elements.IsEmpty(); }
+  void Reserve(uint32 count) { m_elements.Reserve(count); }
+  void Clear() { m_elements.Clear(); }
+
+  const T& Top() const
+  {
+    DebugAssert(!IsEmpty());
+    return m_elements[0];
+  }
+
+  void Push(const T& value)
+  {
+    m_elements.Add(value);
+
+    T* pBase = m_elements.GetBasePointer();
+    uint32 index = m_elements.GetSize() - 1;
+    auto place = [pBase](uint32 placeIndex, T&& placeValue) { pBase[placeIndex] = std::move(placeValue); };
+    HeapDetail::SiftUp<Arity>(pBase, index, std::move(pBase[index]), m_compare, place);
+  }
+
+  // removes the top element, returning it
+  T Pop()
+  {
+    DebugAssert(!IsEmpty());
+    T* pBase = m_elements.GetBasePointer();
+    T top(std::move(pBase[0]));
+
+    T last;
+    m_elements.PopBack(&last);
+    if (!m_elements.IsEmpty())
+    {
+      auto place = [pBase](uint32 placeIndex, T&& placeValue) { pBase[placeIndex] = std::move(placeValue); };
+      HeapDetail::SiftDown<Arity>(pBase, 0, m_elements.GetSize(), std::move(last), m_compare, place);
+    }
+
+    return top;
+  }
+
+  // Replaces the contents with count values, ordering them all at once in O(n), rather than O(n log n) by pushing.
+  void Assign(const T* pValues, uint32 count)
+  {
+    m_elements.Clear();
+    m_elements.AddRange(pValues, count);
+    if (count < 2)
+      return;
+
+    T* pBase = m_elements.GetBasePointer();
+    auto place = [pBase](uint32 placeIndex, T&& placeValue) { pBase[placeIndex] = std::move(placeValue); };
+    for (uint32 index = (count - 2) / Arity + 1; index > 0; index--)
+      HeapDetail::SiftDown<Arity>(pBase, index - 1, count, std::move(pBase[index - 1]), m_compare, place);
+  }
+
+  // in heap order, not sorted
+  const T* GetBasePointer() const { return m_elements.GetBasePointer(); }
+
+private:
+  MemArray<T> m_elements;
+  Compare m_compare;
+};
+
+// Each element pushed gets a handle, which stays the same while it moves around the heap, until it's popped or
+// removed. Handles are reused after that, so holders must forget them. Updating an element's value moves it up or
+// down as needed, e.g. rescheduling a timer.
+template<class T, class Compare = std::less<T>, uint32 Arity = 4>
+class IndexedPriorityQueue
+{
+  static_assert(Arity >= 2, "heaps need at least two children per node");
+
+public:
+  static const uint32 InvalidHandle = 0xFFFFFFFF;
+
+  IndexedPriorityQueue(const Compare& compare = Compare()) : m_compare(compare), m_firstFreeHandle(NoFreeHandle) {}
+
+  uint32 GetSize() const { return m_nodes.GetSize(); }
+  bool IsEmpty() const { return m_nodes.IsEmpty(); }
+
+  void Clear()
+  {
+    m_nodes.Clear();
+    m_positions.Clear();
+    m_firstFreeHandle = NoFreeHandle;
+  }
+
+  // whether the handle currently refers to an element
+  bool Contains(uint32 handle) const
+  {
+    return (handle < m_positions.GetSize() && m_positions[handle] < m_nodes.GetSize() &&
+            m_nodes[m_positions[handle]].Handle == handle);
+  }
+
+  const T& Top() const
+  {
+    DebugAssert(!IsEmpty());
+    return m_nodes[0].Value;
+  }
+  uint32 GetTopHandle() const
+  {
+    DebugAssert(!IsEmpty());
+    return m_nodes[0].Handle;
+  }
+
+  const T& Get(uint32 handle) const
+  {
+    DebugAssert(Contains(handle));
+    return m_nodes[m_positions[handle]].Value;
+  }
+
+  uint32 Push(const T& value)
+  {
+    uint32 handle = AllocateHandle();
+    uint32 index = m_nodes.GetSize();
+
+    Node node;
+    node.Value = value;
+    node.Handle = handle;
+    m_nodes.Add(node);
+    m_positions[handle] = index;
+
+    SiftUpFrom(index);
+    return handle;
+  }
+
+  // removes the top element, returning it
+  T Pop()
+  {
+    DebugAssert(!IsEmpty());
+    T top(std::move(m_nodes[0].Value));
+    RemoveAt(0);
+    return top;
+  }
+
+  // Changes an element's value and moves it to where the new value belongs.
+  void Update(uint32 handle, const T& value)
+  {
+    DebugAssert(Contains(handle));
+    uint32 index = m_positions[handle];
+    m_nodes[index].Value = value;
+
+    if (index > 0 && m_compare(value, m_nodes[(index - 1) / Arity].Value))
+      SiftUpFrom(index);
+    else
+      SiftDownFrom(index);
+  }
+
+  void Remove(uint32 handle)
+  {
+    DebugAssert(Contains(handle));
+    RemoveAt(m_positions[handle]);
+  }
+
+private:
+  struct Node
+  {
+    T Value;
+    uint32 Handle;
+  };
+
+  // compares the values of nodes, for the sifts
+  struct NodeCompare
+  {
+    NodeCompare(Compare& compare) : ValueCompare(compare) {}
+    bool operator()(const Node& left, const Node& right) const { return ValueCompare(left.Value, right.Value); }
+
+    Compare& ValueCompare;
+  };
+
+  // Free handles are chained through their position slots, so handles take no memory besides the array.
+  uint32 AllocateHandle()
+  {
+    if (m_firstFreeHandle == NoFreeHandle)
+    {
+      DebugAssert(m_positions.GetSize() < NoFreeHandle);
+      m_positions.Add(0);
+      return m_positions.GetSize() - 1;
+    }
+
+    uint32 handle = m_firstFreeHandle;
+    m_firstFreeHandle = m_positions[handle] & ~FreeHandleBit;
+    return handle;
+  }
+
+  void FreeHandle(uint32 handle)
+  {
+    m_positions[handle] = m_firstFreeHandle | FreeHandleBit;
+    m_firstFreeHandle = handle;
+  }
+
+  void SiftUpFrom(uint32 index)
+  {
+    Node* pBase = m_nodes.GetBasePointer();
+    uint32* pPositions = m_positions.GetBasePointer();
+    auto place = [pBase, pPositions](uint32 placeIndex, Node&& placeNode) {
+      pPositions[placeNode.Handle] = placeIndex;
+      pBase[placeIndex] = std::move(placeNode);
+    };
+
+    NodeCompare compare(m_compare);
+    HeapDetail::SiftUp<Arity>(pBase, index, std::move(pBase[index]), compare, place);
+  }
+
+  void SiftDownFrom(uint32 index)
+  {
+    Node* pBase = m_nodes.GetBasePointer();
+    uint32* pPositions = m_positions.GetBasePointer();
+    auto place = [pBase, pPositions](uint32 placeIndex, Node&& placeNode) {
+      pPositions[placeNode.Handle] = placeIndex;
+      pBase[placeIndex] = std::move(placeNode);
+    };
+
+    NodeCompare compare(m_compare);
+    HeapDetail::SiftDown<Arity>(pBase, index, m_nodes.GetSize(), std::move(pBase[index]), compare, place);
+  }
+
+  // fills the hole with the last node, which may belong above or below it
+  void RemoveAt(uint32 index)
+  {
+    FreeHandle(m_nodes[index].Handle);
+
+    Node last;
+    m_nodes.PopBack(&last);
+    if (index == m_nodes.GetSize())
+      return;
+
+    m_positions[last.Handle] = index;
+    m_nodes[index] = std::move(last);
+    if (index > 0 && m_compare(m_nodes[index].Value, m_nodes[(index - 1) / Arity].Value))
+      SiftUpFrom(index);
+    else
+      SiftDownFrom(index);
+  }
+
+  // set in the position slots of free handles, so Contains can't mistake the chain for a position
+  static const uint32 FreeHandleBit = 0x80000000;
+  static const uint32 NoFreeHandle = 0x7FFFFFFF;
+
+  MemArray<Node> m_nodes;
+  PODArray<uint32> m_positions;
+  Compare m_compare;
+  uint32 m_firstFreeHandle;
+};
+
+template<class T, class Compare, uint32 Arity>
+const uint32 IndexedPriorityQueue<T, Compare, Arity>::InvalidHandle;
+template<class T, class Compare, uint32 Arity>
+const uint32 IndexedPriorityQueue<T, Compare, Arity>::FreeHandleBit;
+template<class T, class Compare, uint32 Arity>
+const uint32 IndexedPriorityQueue<T, Compare, Arity>::NoFreeHandle;
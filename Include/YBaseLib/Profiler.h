@@ -0,0 +1,87 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Timer.h"
+
+class ByteStream;
+
+// Zones compiled in, on for everything but shipping builds. With them off the macros compile to nothing.
+#ifndef Y_PROFILER_ENABLED
+#ifdef Y_BUILD_CONFIG_SHIPPING
+#define Y_PROFILER_ENABLED 0
+#else
+#define Y_PROFILER_ENABLED 1
+#endif
+#endif
+
+// Records zones, named spans of a thread's time, while a capture runs, for viewing as a timeline. Each thread
+// records into a buffer of its own without locking, so a zone costs two timer reads and a store, and nothing more
+// than a test of a flag when no capture is running. Captures export as Chrome trace JSON, for chrome://tracing and
+// the Perfetto UI, or as a Perfetto protobuf trace.
+//   Profiler::StartCapture();
+//   {
+//     Y_PROFILE_ZONE("LoadLevel");
+//     ...
+//   }
+//   Profiler::StopCapture();
+//   Profiler::ExportChromeTrace(pStream);
+// Threads are named in the trace by Thread::SetDebugName, or Profiler::SetThreadName for threads started otherwise.
+namespace Profiler {
+
+// events a thread keeps in a capture, the rest are dropped and counted
+static const uint32 DefaultMaxEventsPerThread = 1048576;
+
+// Starts a capture, dropping what the last one recorded. Each thread's buffer is reused where it can be, and grows
+// up to maxEventsPerThread events, rounded up to the buffers' chunks.
+void StartCapture(uint32 maxEventsPerThread = DefaultMaxEventsPerThread);
+
+// Stops recording, zones already started are still recorded as they end.
+void StopCapture();
+
+extern volatile bool g_isCapturing;
+inline bool IsCapturing() { return g_isCapturing; }
+
+// the events that didn't fit in their thread's buffer since the capture started
+uint32 GetDroppedEventCount();
+
+// Records a zone on the calling thread. The name isn't copied, so it has to outlive the capture, literals are best.
+void RecordZone(const char* name, Y_TIMER_VALUE startTime, Y_TIMER_VALUE endTime);
+
+// names the calling thread in exports, the name is copied
+void SetThreadName(const char* name);
+
+// Lets another thread reuse the calling thread's buffer once what it recorded has been dropped, by the next
+// capture. Thread does this when a thread exits, threads started any other way should call it before exiting.
+void ReleaseThreadBuffer();
+
+// Write the capture so far, which can still be running. Times are from when it started. Returns false if the stream
+// can't be written.
+bool ExportChromeTrace(ByteStream* pStream);
+bool ExportPerfettoTrace(ByteStream* pStream);
+
+} // namespace Profiler
+
+// Records the time from construction to destruction as a zone, if a capture was running when it started.
+class ProfileZone
+{
+public:
+  ProfileZone(const char* name) : m_name(name), m_startTime(Profiler::IsCapturing() ? Y_FastTimerGetValue() : 0) {}
+  ~ProfileZone()
+  {
+    if (m_startTime != 0)
+      Profiler::RecordZone(m_name, m_startTime, Y_FastTimerGetValue());
+  }
+
+private:
+  const char* m_name;
+  Y_TIMER_VALUE m_startTime;
+
+  DeclareNonCopyable(ProfileZone);
+};
+
+#if Y_PROFILER_ENABLED
+#define Y_PROFILE_ZONE_VARIABLE_NAME2(Line) ___ProfileZone___##Line
+#define Y_PROFILE_ZONE_VARIABLE_NAME(Line) Y_PROFILE_ZONE_VARIABLE_NAME2(Line)
+#define Y_PROFILE_ZONE(Name) ProfileZone Y_PROFILE_ZONE_VARIABLE_NAME(__LINE__)(Name)
+#else
+#define Y_PROFILE_ZONE(Name) MULTI_STATEMENT_MACRO_BEGIN MULTI_STATEMENT_MACRO_END
+#endif
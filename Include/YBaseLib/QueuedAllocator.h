@@ -1,155 +1,217 @@
 #pragma once
+#include "YBaseLib/Allocator.h"
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Common.h"
-
-template<class T>
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/MutexLock.h"
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Pool of fixed-size objects. Storage is allocated in slabs of SlabSize objects and never given back until the
+// pool is destroyed, freed objects go on an intrusive free list and are reused by the next allocation.
+// Allocate and Free are thread safe and take a lock. Threads that allocate a lot should each create a
+// ThreadCache, which keeps a private free list and only touches the lock to move a batch of objects at a time.
+// Objects can be freed through any cache or the pool itself, regardless of where they were allocated.
+template<class T, uint32 SlabSize = 64>
 class QueuedAllocator
 {
   DeclareNonCopyable(QueuedAllocator);
 
-  struct Node
+  union Node {
+    Node* pNextFree;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+  };
+
+  struct Slab
   {
-    T Obj;
-    Node* pPrev;
-    Node* pNext;
+    Node Nodes[SlabSize];
+    Slab* pNext;
   };
 
+  // objects moved between a thread cache and the shared list at once
+  static const uint32 CacheBatchSize = (SlabSize < 32) ? SlabSize : 32;
+
 public:
+  class ThreadCache
+  {
+    DeclareNonCopyable(ThreadCache);
+
+  public:
+    ThreadCache(QueuedAllocator* pAllocator) : m_pAllocator(pAllocator), m_pFreeList(nullptr), m_freeListSize(0) {}
+    ~ThreadCache() { Flush(); }
+
+    // objects held by this cache, not counted in the pool's free list
+    uint32 GetFreeListSize() const { return m_freeListSize; }
+
+    template<typename... Args>
+    T* Allocate(Args&&... args)
+    {
+      if (m_pFreeList == nullptr)
+      {
+        m_pFreeList = m_pAllocator->PopNodes(CacheBatchSize);
+        m_freeListSize = CacheBatchSize;
+      }
+
+      Node* pNode = m_pFreeList;
+      m_pFreeList = pNode->pNextFree;
+      m_freeListSize--;
+      return new (&pNode->Storage) T(std::forward<Args>(args)...);
+    }
+
+    void Free(T* pObject)
+    {
+      if (pObject == nullptr)
+        return;
+
+      pObject->~T();
+      Node* pNode = reinterpret_cast<Node*>(pObject);
+      pNode->pNextFree = m_pFreeList;
+      m_pFreeList = pNode;
+      m_freeListSize++;
+
+      // hand back a batch once it's holding two, so a thread that only frees doesn't hoard everything
+      if (m_freeListSize >= CacheBatchSize * 2)
+        ReleaseNodes(CacheBatchSize);
+    }
+
+    // returns every cached object to the pool
+    void Flush() { ReleaseNodes(m_freeListSize); }
+
+  private:
+    void ReleaseNodes(uint32 count)
+    {
+      if (count == 0)
+        return;
+
+      Node* pHead = m_pFreeList;
+      Node* pTail = pHead;
+      for (uint32 i = 1; i < count; i++)
+        pTail = pTail->pNextFree;
+
+      m_pFreeList = pTail->pNextFree;
+      m_freeListSize -= count;
+      m_pAllocator->PushNodes(pHead, pTail, count);
+    }
+
+    QueuedAllocator* m_pAllocator;
+    Node* m_pFreeList;
+    uint32 m_freeListSize;
+  };
+
   QueuedAllocator();
   ~QueuedAllocator();
 
-  const size_t GetFreeListSize() const { return m_freeListSize; }
-  const size_t GetAllocatedListSize() const { return m_allocatedListSize; }
+  // objects on the shared free list, and the total the slabs can hold
+  size_t GetFreeListSize() const { return m_freeListSize; }
+  size_t GetCapacity() const { return m_slabCount * SlabSize; }
+  size_t GetSlabCount() const { return m_slabCount; }
+
+  // allocates slabs up front so at least count objects are free
+  void Reserve(size_t count);
 
-  T* Allocate();
-  T* Allocate(const T& copy);
-  T* Allocate(const T&& move);
+  template<typename... Args>
+  T* Allocate(Args&&... args)
+  {
+    Node* pNode = PopNodes(1);
+    return new (&pNode->Storage) T(std::forward<Args>(args)...);
+  }
 
   void Free(T* pObject);
 
 private:
-  Node* AllocateNode();
-
-  Node* m_pFreeListHead;
-  Node* m_pFreeListTail;
-  Node* m_pAllocatedListHead;
-  Node* m_pAllocatedListTail;
+  // takes count nodes off the free list as a chain, allocating slabs if there aren't enough
+  Node* PopNodes(uint32 count);
+  void PushNodes(Node* pHead, Node* pTail, uint32 count);
+  void AllocateSlab();
+
+  Slab* m_pSlabs;
+  size_t m_slabCount;
+  Node* m_pFreeList;
   size_t m_freeListSize;
-  size_t m_allocatedListSize;
+  Mutex m_lock;
 };
 
-template<class T>
-void QueuedAllocator<T>::QueuedAllocator()
-  : m_pFreeListHead(nullptr), m_pFreeListTail(nullptr), m_pAllocatedListHead(nullptr), m_pAllocatedListTail(nullptr),
-    m_freeListSize(0), m_allocatedListSize(0)
+template<class T, uint32 SlabSize>
+QueuedAllocator<T, SlabSize>::QueuedAllocator()
+  : m_pSlabs(nullptr), m_slabCount(0), m_pFreeList(nullptr), m_freeListSize(0)
 {
 }
 
-template<class T>
-QueuedAllocator<T>::~QueuedAllocator()
+template<class T, uint32 SlabSize>
+QueuedAllocator<T, SlabSize>::~QueuedAllocator()
 {
-  Assert(m_allocatedListSize == 0);
+  AssertMsg(m_freeListSize == GetCapacity(), "objects still allocated, or held by a thread cache");
 
-  Node* pNode = m_pFreeListHead;
-  while (pNode != nullptr)
+  HeapAllocator allocator;
+  while (m_pSlabs != nullptr)
   {
-    Node* pTemp = pNode;
-    pNode = pNode->pNext;
-    delete pTemp;
+    Slab* pSlab = m_pSlabs;
+    m_pSlabs = pSlab->pNext;
+    allocator.Free(pSlab, sizeof(Slab), alignof(Slab));
   }
 }
 
-template<class T>
-T* QueuedAllocator<T>::Allocate()
+template<class T, uint32 SlabSize>
+void QueuedAllocator<T, SlabSize>::Reserve(size_t count)
 {
-  Node* pNode = AllocateNode();
-  new (&pNode->Obj) T();
-  return &pNode->Obj;
+  MutexLock lock(m_lock);
+  while (m_freeListSize < count)
+    AllocateSlab();
 }
 
-template<class T>
-T* QueuedAllocator<T>::Allocate(const T& copy)
+template<class T, uint32 SlabSize>
+void QueuedAllocator<T, SlabSize>::Free(T* pObject)
 {
-  Node* pNode = AllocateNode();
-  new (&pNode->Obj) T(copy);
-  return &pNode->Obj;
+  if (pObject == nullptr)
+    return;
+
+  pObject->~T();
+  Node* pNode = reinterpret_cast<Node*>(pObject);
+  PushNodes(pNode, pNode, 1);
 }
 
-template<class T>
-T* QueuedAllocator<T>::Allocate(const T&& move)
+template<class T, uint32 SlabSize>
+typename QueuedAllocator<T, SlabSize>::Node* QueuedAllocator<T, SlabSize>::PopNodes(uint32 count)
 {
-  Node* pNode = AllocateNode();
-  new (&pNode->Obj) T(move);
-  return &pNode->Obj;
+  MutexLock lock(m_lock);
+  while (m_freeListSize < count)
+    AllocateSlab();
+
+  Node* pHead = m_pFreeList;
+  Node* pTail = pHead;
+  for (uint32 i = 1; i < count; i++)
+    pTail = pTail->pNextFree;
+
+  m_pFreeList = pTail->pNextFree;
+  m_freeListSize -= count;
+  pTail->pNextFree = nullptr;
+  return pHead;
 }
 
-template<class T>
-QueuedAllocator<T>::Node* QueuedAllocator<T>::AllocateNode()
+template<class T, uint32 SlabSize>
+void QueuedAllocator<T, SlabSize>::PushNodes(Node* pHead, Node* pTail, uint32 count)
 {
-  Node* pNode;
-  if (m_pFreeListHead != nullptr)
-  {
-    pNode = m_pFreeListHead;
-    if (pNode->pNext != nullptr)
-    {
-      pNode->pNext->pPrev = nullptr;
-      m_pFreeListHead = pNode->pNext;
-    }
-    else
-    {
-      m_pFreeListHead = nullptr;
-      m_pFreeListTail = nullptr;
-    }
-    m_freeListSize--;
-  }
-  else
-  {
-    pNode = new Node();
-  }
-
-  pNode->pPrev = m_pAllocatedListTail;
-  pNode->pNext = nullptr;
-  if (m_pAllocatedListTail == nullptr)
-    m_pAllocatedListHead = m_pAllocatedListTail = pNode;
-  else
-    m_pAllocatedListTail = pNode;
-
-  m_allocatedListSize++;
-  return pNode;
+  MutexLock lock(m_lock);
+  pTail->pNextFree = m_pFreeList;
+  m_pFreeList = pHead;
+  m_freeListSize += count;
 }
 
-template<class T>
-void QueuedAllocator<T>::Free(T* pObject)
+template<class T, uint32 SlabSize>
+void QueuedAllocator<T, SlabSize>::AllocateSlab()
 {
-  Node* pNode = CONTAINING_STRUCTURE(pObject, Node, Obj);
-  pNode->Obj.~T();
-
-  if (pNode->pNext == nullptr)
-  {
-    DebugAssert(m_pAllocatedListTail == pNode);
-    m_pAllocatedListTail = pNode->pPrev;
-    if (pNode->pPrev != nullptr)
-      pNode->pPrev->pNext = nullptr;
-  }
-  else
-  {
-    pNode->pNext->pPrev = pNode->pPrev;
-  }
-  if (pNode->pPrev == nullptr)
-  {
-    DebugAssert(m_pAllocatedListHead == pNode);
-    m_pAllocatedListHead = pNode->pNext;
-    if (pNode->pNext != nullptr)
-      pNode->pNext->pPrev = pNode->pNext;
-  }
-  m_allocatedListSize--;
-
-  pNode->pPrev = m_pFreeListTail;
-  pNode->pNext = nullptr;
-  if (m_pFreeListTail == nullptr)
-    m_pFreeListHead = m_pFreeListTail = pNode;
-  else
-    m_pFreeListTail = pNode;
-
-  m_freeListSize++;
+  Slab* pSlab = (Slab*)HeapAllocator().Allocate(sizeof(Slab), alignof(Slab));
+  Assert(pSlab != nullptr);
+  pSlab->pNext = m_pSlabs;
+  m_pSlabs = pSlab;
+  m_slabCount++;
+
+  // thread the new nodes onto the front of the free list, in address order
+  for (uint32 i = 0; i < SlabSize - 1; i++)
+    pSlab->Nodes[i].pNextFree = &pSlab->Nodes[i + 1];
+
+  pSlab->Nodes[SlabSize - 1].pNextFree = m_pFreeList;
+  m_pFreeList = &pSlab->Nodes[0];
+  m_freeListSize += SlabSize;
 }
@@ -0,0 +1,138 @@
+#pragma once
+#include "YBaseLib/BinaryReader.h"
+#include "YBaseLib/BinaryWriter.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Error.h"
+#include "YBaseLib/HashTable.h"
+#include "YBaseLib/InlineFunction.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/PODArray.h"
+
+class GrowableMemoryByteStream;
+class ReadOnlyMemoryByteStream;
+
+// Calls between the two ends of a connection, whatever carries it. Each end registers methods by ID and calls the
+// other's, with the arguments and results packed by a BinaryWriter, little-endian, and read back by a BinaryReader.
+// The variable length integer fields are the cheap way to send most values. Calls are pipelined, each carries an ID
+// its response is matched on, so any number can be outstanding and methods can answer in any order, or later from
+// another thread.
+//
+// Frames go out through the send function in batches, several per write, up to the batch size. Frames are batched
+// while the channel is corked, while another thread is sending, and while the responses to a batch received are
+// being made. The transport hands what it receives to ReceiveFrames when batches arrive whole, as messages, or to
+// ReceiveStream when they arrive as a byte stream. See RPCSocket and SubprocessRPCChannel.
+//   channel.RegisterMethod(Method_Add, [](RPCChannel* pChannel, uint32 requestID, BinaryReader* pArguments) {
+//     int32 sum = pArguments->ReadVarInt32() + pArguments->ReadVarInt32();
+//     pChannel->BeginResponse(requestID)->WriteVarInt32(sum);
+//     pChannel->EndMessage();
+//   });
+//   BinaryWriter* pArguments = channel.BeginCall(Method_Add, [](BinaryReader* pResults, const Error* pError) {});
+//   pArguments->WriteVarInt32(1);
+//   pArguments->WriteVarInt32(2);
+//   channel.EndMessage();
+class RPCChannel
+{
+public:
+  // Hands the transport a batch of frames, to be sent whole. Returns false if it can't be taken now, and the batch
+  // is kept for the next Flush, which the transport calls once there's room.
+  typedef InlineFunction<bool(const void* pData, size_t size)> SendFunction;
+
+  // pResults is null if the call failed, pError saying why. Either is only valid for the call.
+  typedef InlineFunction<void(BinaryReader* pResults, const Error* pError)> ResponseFunction;
+
+  // Reads the arguments, only valid for the call, and answers requestID with BeginResponse or RespondError, then or
+  // later. Notifications have a requestID of 0 and take no answer.
+  typedef InlineFunction<void(RPCChannel* pChannel, uint32 requestID, BinaryReader* pArguments)> MethodFunction;
+
+  static const uint32 DefaultMaxBatchSize = 16384;
+
+  RPCChannel(SendFunction sendFunction, uint32 maxBatchSize = DefaultMaxBatchSize);
+
+  // calls still outstanding fail
+  ~RPCChannel();
+
+  // Methods are registered before the other side calls them, and not changed while frames are being received.
+  void RegisterMethod(uint32 methodID, MethodFunction method);
+
+  // Each starts a frame, returning the writer for its arguments or results, with the channel locked until EndMessage
+  // queues it. Nothing else is done with the channel in between.
+  BinaryWriter* BeginCall(uint32 methodID, ResponseFunction callback);
+  BinaryWriter* BeginNotify(uint32 methodID);
+  BinaryWriter* BeginResponse(uint32 requestID);
+
+  // Queues the frame and sends it, unless corked. Returns false if it's larger than the batch size, or the channel
+  // is closed, when a call's callback gets the error before this returns.
+  bool EndMessage();
+
+  // Fails a call, the caller's callback gets an error with the code and message.
+  void RespondError(uint32 requestID, int32 errorCode, const char* message);
+
+  // Holds frames back until the last Uncork, then sends them together. Corks nest.
+  void Cork();
+  void Uncork();
+
+  // Sends what's queued, returning false if the transport couldn't take all of it.
+  bool Flush();
+
+  // Dispatches a received batch of whole frames, or the next part of a stream of them, keeping a frame that's cut
+  // off until the rest arrives. Methods and callbacks run on the calling thread, one call at a time. Returns false
+  // if the data is malformed, and the transport should drop the connection.
+  bool ReceiveFrames(const void* pData, size_t size);
+  bool ReceiveStream(const void* pData, size_t size);
+
+  // For when the connection's gone. Outstanding calls fail with the error, queued frames are dropped, and later
+  // calls fail straight away.
+  void Close(const Error* pError);
+  bool IsClosed() const { return m_closed; }
+
+  uint32 GetMaxBatchSize() const { return m_maxBatchSize; }
+  uint32 GetOutstandingCallCount();
+
+private:
+  enum FrameType
+  {
+    FrameType_Call,
+    FrameType_Notify,
+    FrameType_Response,
+    FrameType_Error,
+  };
+
+  // Dispatches the whole frames at the start of the data, returning the bytes they took, or -1 if it's malformed.
+  ptrdiff_t DispatchFrames(const byte* pData, size_t size);
+  bool DispatchFrame(const byte* pFrame, size_t size);
+
+  // Takes a call's callback out of the outstanding calls, null if it's not there.
+  ResponseFunction* TakeOutstandingCall(uint32 requestID);
+
+  // Sends whole frames from the start of the data in batches, returning the bytes the transport took.
+  size_t SendBatches(const byte* pData, size_t size);
+
+  SendFunction m_sendFunction;
+  uint32 m_maxBatchSize;
+
+  Mutex m_lock;
+  HashTable<uint32, MethodFunction*> m_methods;
+  HashTable<uint32, ResponseFunction*> m_outstandingCalls;
+  uint32 m_nextRequestID;
+
+  // the frame being written, and the call it's for, 0 if it isn't one
+  GrowableMemoryByteStream* m_pFrameStream;
+  BinaryWriter m_frameWriter;
+  uint32 m_frameCallID;
+
+  // Frames waiting to go, each with its length in front. One thread sends at a time, from the sending buffer, while
+  // the rest queue behind it.
+  PODArray<byte> m_sendQueue;
+  PODArray<byte> m_sendingBuffer;
+  bool m_sending;
+  uint32 m_corkCount;
+
+  bool m_closed;
+  Error m_closeError;
+
+  // pointed at each frame received in turn, and the start of a frame cut off at the end of a stream's data
+  ReadOnlyMemoryByteStream* m_pReceiveStream;
+  PODArray<byte> m_partialFrame;
+
+  DeclareNonCopyable(RPCChannel);
+};
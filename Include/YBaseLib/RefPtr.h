@@ -0,0 +1,138 @@
+#pragma once
+#include "YBaseLib/ReferenceCounted.h"
+#include <utility>
+
+//
+// RefPtr
+//
+// Holds one reference to an intrusively counted object, either ReferenceCounted or SingleThreadReferenceCounted.
+// Moves hand the reference over without touching the count, so returning and storing RefPtrs only costs an
+// AddRef where a new owner really appears.
+//
+
+template<class T>
+class RefPtr
+{
+  template<class U>
+  friend class RefPtr;
+
+public:
+  RefPtr() : m_pPtr(nullptr) {}
+  RefPtr(std::nullptr_t) : m_pPtr(nullptr) {}
+  explicit RefPtr(T* pPtr) : m_pPtr(pPtr)
+  {
+    if (m_pPtr != nullptr)
+      m_pPtr->AddRef();
+  }
+  RefPtr(const RefPtr<T>& Other) : m_pPtr(Other.m_pPtr)
+  {
+    if (m_pPtr != nullptr)
+      m_pPtr->AddRef();
+  }
+  RefPtr(RefPtr<T>&& Other) : m_pPtr(Other.m_pPtr) { Other.m_pPtr = nullptr; }
+  template<class U>
+  RefPtr(const RefPtr<U>& Other) : m_pPtr(Other.m_pPtr)
+  {
+    if (m_pPtr != nullptr)
+      m_pPtr->AddRef();
+  }
+  template<class U>
+  RefPtr(RefPtr<U>&& Other) : m_pPtr(Other.m_pPtr)
+  {
+    Other.m_pPtr = nullptr;
+  }
+  ~RefPtr()
+  {
+    if (m_pPtr != nullptr)
+      m_pPtr->Release();
+  }
+
+  // Takes over a reference the caller already owns, such as the one a new object starts with.
+  static RefPtr<T> Adopt(T* pPtr)
+  {
+    RefPtr<T> ptr;
+    ptr.m_pPtr = pPtr;
+    return ptr;
+  }
+
+  T* Get() const { return m_pPtr; }
+  T& operator*() const { return *m_pPtr; }
+  T* operator->() const { return m_pPtr; }
+  explicit operator bool() const { return (m_pPtr != nullptr); }
+  bool IsNull() const { return (m_pPtr == nullptr); }
+
+  bool operator==(const RefPtr<T>& Other) const { return (m_pPtr == Other.m_pPtr); }
+  bool operator!=(const RefPtr<T>& Other) const { return (m_pPtr != Other.m_pPtr); }
+  bool operator==(const T* pPtr) const { return (m_pPtr == pPtr); }
+  bool operator!=(const T* pPtr) const { return (m_pPtr != pPtr); }
+
+  RefPtr<T>& operator=(const RefPtr<T>& Other)
+  {
+    // add first, so assigning a pointer to itself can't free the object
+    T* pPtr = Other.m_pPtr;
+    if (pPtr != nullptr)
+      pPtr->AddRef();
+    if (m_pPtr != nullptr)
+      m_pPtr->Release();
+
+    m_pPtr = pPtr;
+    return *this;
+  }
+
+  RefPtr<T>& operator=(RefPtr<T>&& Other)
+  {
+    if (this != &Other)
+    {
+      T* pPtr = Other.m_pPtr;
+      Other.m_pPtr = nullptr;
+      if (m_pPtr != nullptr)
+        m_pPtr->Release();
+
+      m_pPtr = pPtr;
+    }
+
+    return *this;
+  }
+
+  RefPtr<T>& operator=(std::nullptr_t)
+  {
+    Reset();
+    return *this;
+  }
+
+  // Drops the reference held, if any.
+  void Reset()
+  {
+    if (m_pPtr != nullptr)
+    {
+      T* pPtr = m_pPtr;
+      m_pPtr = nullptr;
+      pPtr->Release();
+    }
+  }
+
+  // Gives the reference back to the caller, who then has to release it.
+  T* Detach()
+  {
+    T* pPtr = m_pPtr;
+    m_pPtr = nullptr;
+    return pPtr;
+  }
+
+  void Swap(RefPtr<T>& Other)
+  {
+    T* pPtr = m_pPtr;
+    m_pPtr = Other.m_pPtr;
+    Other.m_pPtr = pPtr;
+  }
+
+private:
+  T* m_pPtr;
+};
+
+// Creates an object and adopts its initial reference.
+template<class T, typename... Args>
+RefPtr<T> MakeRefPtr(Args&&... args)
+{
+  return RefPtr<T>::Adopt(new T(std::forward<Args>(args)...));
+}
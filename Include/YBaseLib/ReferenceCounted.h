@@ -1,4 +1,5 @@
 #pragma once
+#include "YBaseLib/Assert.h"
 #include "YBaseLib/Atomic.h"
 #include "YBaseLib/Common.h"
 
@@ -11,10 +12,26 @@ protected:
   virtual ~ReferenceCounted();
 
 public:
-  void AddRef() const;
-  uint32 Release() const;
+  // A new reference is always copied from one that's held already, so it needs no ordering. Releases are acquire
+  // and release, so the last one sees every other owner done with the object before deleting it. Only the delete
+  // is out of line.
+  void AddRef() const { Y_AtomicIncrement(m_uReferenceCount, ATOMIC_MEMORY_ORDER_RELAXED); }
+  uint32 Release() const
+  {
+    DebugAssert(m_uReferenceCount > 0 && m_uReferenceCountValid == ReferenceCountValidValue);
+    uint32 newReferenceCount = Y_AtomicDecrement(m_uReferenceCount, ATOMIC_MEMORY_ORDER_ACQ_REL);
+    if (newReferenceCount == 0)
+      Destroy();
+
+    return newReferenceCount;
+  }
 
 private:
+  static const uint32 ReferenceCountValidValue = 0x11C0FFEE;
+  static const uint32 ReferenceCountInvalidValue = 0xDEADC0DE;
+
+  void Destroy() const;
+
   mutable Y_ATOMIC_DECL uint32 m_uReferenceCount;
   mutable uint32 m_uReferenceCountValid;
 
@@ -24,6 +41,35 @@ private:
   ReferenceCounted& operator=(const ReferenceCounted&);
 };
 
+// The same interface for objects that never leave the thread that created them, which count without atomics. Every
+// AddRef and Release, including those made by a RefPtr, have to happen on that one thread.
+class SingleThreadReferenceCounted
+{
+protected:
+  SingleThreadReferenceCounted() : m_uReferenceCount(1) {}
+  virtual ~SingleThreadReferenceCounted() { DebugAssert(m_uReferenceCount == 0); }
+
+public:
+  void AddRef() const { m_uReferenceCount++; }
+  uint32 Release() const
+  {
+    DebugAssert(m_uReferenceCount > 0);
+    uint32 newReferenceCount = --m_uReferenceCount;
+    if (newReferenceCount == 0)
+      delete this;
+
+    return newReferenceCount;
+  }
+
+private:
+  mutable uint32 m_uReferenceCount;
+
+  // make noncopyable
+private:
+  SingleThreadReferenceCounted(const SingleThreadReferenceCounted&);
+  SingleThreadReferenceCounted& operator=(const SingleThreadReferenceCounted&);
+};
+
 // Helper method to add/release a reference and return the same pointer
 template<class T>
 T AddRefAndReturn(T pPointer)
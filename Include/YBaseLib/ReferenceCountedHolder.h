@@ -80,10 +80,15 @@ public:
   // move assignment
   ReferenceCountedHolder<T>& operator=(ReferenceCountedHolder<T>&& Other)
   {
-    // written in this order so that this = this has no effect
-    T* ptr = Other.m_pPtr;
-    Other.m_pPtr = nullptr;
-    m_pPtr = ptr;
+    if (this != &Other)
+    {
+      T* ptr = Other.m_pPtr;
+      Other.m_pPtr = nullptr;
+      Release();
+      m_pPtr = ptr;
+    }
+
+    return *this;
   }
 
 private:
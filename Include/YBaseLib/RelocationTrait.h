@@ -0,0 +1,21 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include <type_traits>
+
+// Whether objects of a type can be moved to a new address with a plain memcpy, leaving the old copy
+// unconstructed. Containers use this to realloc storage rather than copy and destroy every element.
+// Anything trivially copyable qualifies, as do most classes that only hold pointers to other memory,
+// which need to be declared with DECLARE_TRIVIALLY_RELOCATABLE. Classes pointing into themselves
+// (like StackString, or InlinePODArray) must never be declared.
+template<typename T>
+struct RelocationTrait
+{
+  static const bool IsTriviallyRelocatable = std::is_trivially_copyable<T>::value;
+};
+
+#define DECLARE_TRIVIALLY_RELOCATABLE(type)                                                                            \
+  template<>                                                                                                           \
+  struct RelocationTrait<type>                                                                                         \
+  {                                                                                                                    \
+    static const bool IsTriviallyRelocatable = true;                                                                   \
+  };
@@ -0,0 +1,20 @@
+#pragma once
+#include "YBaseLib/Common.h"
+
+// SHA-1, as in FIPS 180-4. Kept for formats that name it, prefer SHA256Digest for anything new.
+class SHA1Digest
+{
+public:
+  static const uint32 DIGEST_SIZE = 20;
+
+  SHA1Digest();
+
+  void Update(const void* pData, size_t cbData);
+  void Final(byte Digest[DIGEST_SIZE]);
+  void Reset();
+
+private:
+  uint32 m_state[5];
+  uint64 m_byteCount;
+  byte m_block[64];
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include "YBaseLib/Common.h"
+
+// SHA-256, as in FIPS 180-4. Blocks are hashed with the SHA extensions on x86, or the ARMv8 SHA-256 instructions,
+// when the cpu has them.
+class SHA256Digest
+{
+public:
+  static const uint32 DIGEST_SIZE = 32;
+
+  SHA256Digest();
+
+  void Update(const void* pData, size_t cbData);
+  void Final(byte Digest[DIGEST_SIZE]);
+  void Reset();
+
+private:
+  uint32 m_state[8];
+  uint64 m_byteCount;
+  byte m_block[64];
+};
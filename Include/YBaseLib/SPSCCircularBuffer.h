@@ -0,0 +1,81 @@
+#pragma once
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+
+// Circular byte buffer shared by exactly one producer thread and one consumer thread, without a lock.
+// The interface follows CircularBuffer. The read and write positions are free-running counters, each written by
+// one side only, published with release stores and picked up with acquire loads. Each side keeps its own copy of
+// the other side's position on its own cache line, and only refreshes it when that copy says the buffer is full
+// or empty, so the two threads don't bounce a line between them on every call.
+// Mirrored buffers map the same memory twice back to back, so everything that has been written can be read with
+// one pointer, and all of the free space written to with one, even across the wrap-around. The size is rounded up
+// to the platform's mapping granularity. If the platform can't mirror memory it falls back to a plain buffer,
+// check IsMirrored().
+class SPSCCircularBuffer
+{
+  DeclareNonCopyable(SPSCCircularBuffer);
+
+public:
+  // bufferSize is rounded up to a power of two
+  SPSCCircularBuffer(size_t bufferSize, bool mirrored = false);
+  ~SPSCCircularBuffer();
+
+  size_t GetBufferSize() const { return m_bufferSize; }
+  bool IsMirrored() const { return m_mirrored; }
+
+  // either thread, only a snapshot as the other side can be moving
+  size_t GetBufferUsed() const;
+  size_t GetBufferSpace() const { return m_bufferSize - GetBufferUsed(); }
+
+  // producer thread only
+  // Current space in the buffer (excluding wrap-around, unless mirrored).
+  size_t GetContiguousBufferSpace();
+
+  // Write bytes to the buffer. Only will return true upon completing the entire write.
+  bool Write(const void* pSource, size_t byteCount);
+
+  // Obtains a pointer to at least *pByteCount bytes of contiguous free space, and sets *pByteCount to all of it.
+  bool GetWritePointer(void** ppWritePointer, size_t* pByteCount);
+
+  // Publishes byteCount bytes written through the write pointer to the consumer.
+  void MoveWritePointer(size_t byteCount);
+
+  // consumer thread only
+  // Current data size in the buffer (excluding wrap-around, unless mirrored).
+  size_t GetContiguousUsedBytes();
+
+  // Read bytes from the buffer. Only will return true upon completing the entire read.
+  bool Read(void* pDestination, size_t byteCount);
+
+  // Obtains a pointer to the start of the data in the buffer. When finished, call MoveReadPointer.
+  bool GetReadPointer(const void** ppReadPointer, size_t* pByteCount);
+
+  // Hands byteCount bytes back to the producer.
+  void MoveReadPointer(size_t byteCount);
+
+private:
+  // written by one thread, with its copy of the other thread's position
+  struct Position
+  {
+    Y_ATOMIC_DECL size_t Value;
+    size_t CachedOtherValue;
+    byte Padding[Y_CACHE_LINE_SIZE - sizeof(size_t) * 2];
+  };
+
+  // bytes from the position to the end of the buffer, or everything when mirrored
+  size_t GetContiguousLength(size_t position, size_t length) const
+  {
+    return m_mirrored ? length : Min(length, m_bufferSize - (position & m_mask));
+  }
+
+  // shared, fixed after construction
+  byte* m_pBuffer;
+  size_t m_bufferSize;
+  size_t m_mask;
+  bool m_mirrored;
+  byte m_padding[Y_CACHE_LINE_SIZE];
+
+  // m_write is owned by the producer, and caches the read position. m_read the other way around.
+  Position m_write;
+  Position m_read;
+};
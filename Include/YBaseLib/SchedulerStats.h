@@ -0,0 +1,95 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Timer.h"
+
+// Log-linear histogram of timer values, in the style of HDR histograms. Values below 8 ticks have a bucket each,
+// above that every power of two is split into 8 buckets, so a recorded value is known to within 12.5%.
+// Recording is a handful of integer operations, there is no locking, each writer should own its histogram.
+class LatencyHistogram
+{
+public:
+  static const uint32 SubBucketBits = 3;
+  static const uint32 SubBucketCount = 1 << SubBucketBits;
+  static const uint32 BucketCount = (64 - SubBucketBits + 1) * SubBucketCount;
+
+public:
+  LatencyHistogram() { Reset(); }
+
+  void Reset();
+  void Record(Y_TIMER_VALUE value);
+  void Accumulate(const LatencyHistogram& other);
+
+  uint64 GetCount() const { return m_count; }
+  Y_TIMER_VALUE GetTotal() const { return m_total; }
+  Y_TIMER_VALUE GetMin() const { return (m_count > 0) ? m_min : 0; }
+  Y_TIMER_VALUE GetMax() const { return m_max; }
+
+  // upper bound of the bucket containing the given percentile (0-100) of the recorded values
+  Y_TIMER_VALUE GetPercentile(double percentile) const;
+
+  // millisecond conversions of the above
+  double GetMeanMilliseconds() const;
+  double GetMaxMilliseconds() const { return Y_TimerConvertToMilliseconds(GetMax()); }
+  double GetPercentileMilliseconds(double percentile) const
+  {
+    return Y_TimerConvertToMilliseconds(GetPercentile(percentile));
+  }
+
+  // bucket access, for exporting the distribution
+  uint64 GetBucketCount(uint32 index) const { return m_buckets[index]; }
+  static uint32 GetBucketIndex(uint64 value);
+  static uint64 GetBucketUpperBound(uint32 index);
+
+private:
+  uint64 m_buckets[BucketCount];
+  uint64 m_count;
+  Y_TIMER_VALUE m_total;
+  Y_TIMER_VALUE m_min;
+  Y_TIMER_VALUE m_max;
+};
+
+// Task counters for one worker. Each worker updates its own copy without locking, so a snapshot taken while
+// tasks are running may be slightly stale. Counters are cumulative, export the difference between snapshots.
+struct SchedulerWorkerStats
+{
+  uint64 TasksExecuted;
+
+  // time spent running tasks
+  Y_TIMER_VALUE BusyTime;
+
+  // deepest the queue was when a task was picked up
+  uint32 MaxQueueDepth;
+
+  // time from a task being queued to it starting, and how long it ran for
+  LatencyHistogram QueueTime;
+  LatencyHistogram ExecutionTime;
+
+  SchedulerWorkerStats() { Reset(); }
+
+  void Reset();
+  void Accumulate(const SchedulerWorkerStats& other);
+
+  // queueTime is zero for tasks queued before stats were enabled
+  void RecordTask(Y_TIMER_VALUE queueTime, Y_TIMER_VALUE startTime, Y_TIMER_VALUE endTime, uint32 queueDepth);
+};
+
+// Snapshot of a scheduler's counters.
+struct SchedulerStats
+{
+  // workers contributing to the totals
+  uint32 WorkerCount;
+
+  // tasks waiting to start when the snapshot was taken
+  uint32 QueueDepth;
+
+  // time since stats were first enabled
+  Y_TIMER_VALUE ElapsedTime;
+
+  // sum of every worker's counters
+  SchedulerWorkerStats Totals;
+
+  SchedulerStats() : WorkerCount(0), QueueDepth(0), ElapsedTime(0) {}
+
+  // fraction of the available worker time spent running tasks
+  double GetUtilization() const;
+};
@@ -1,13 +1,75 @@
 #pragma once
+#include "YBaseLib/Atomic.h"
 #include "YBaseLib/Common.h"
+#include "YBaseLib/SpinLock.h"
+#include <cstdlib>
+#include <new>
+#include <type_traits>
 
+// The instance is constructed in static storage by the first GetInstance, under a lock, and published with a release
+// store. After that GetInstance is an acquire load and a branch, with no lock or guard variable. The constructor must
+// not call GetInstance itself.
+//
+// It's destroyed at exit in the usual reverse order of construction, unless DestroyInstance was called first, which
+// lets shutdown tear singletons down in an order of its choosing while their threads can still be stopped. A
+// GetInstance after that constructs a new one in the same storage, so pointers kept to the instance stay valid.
 template<class T>
 class Singleton
 {
 public:
   static T& GetInstance()
   {
-    static T staticInstance;
-    return staticInstance;
+    T* pInstance = Y_AtomicLoad(s_pInstance, ATOMIC_MEMORY_ORDER_ACQUIRE);
+    if (pInstance == nullptr)
+      pInstance = CreateInstance();
+
+    return *pInstance;
   }
+
+  static bool HasInstance() { return (Y_AtomicLoad(s_pInstance, ATOMIC_MEMORY_ORDER_ACQUIRE) != nullptr); }
+
+  // Destroys the instance now, if there is one. Nothing else may be using it. Calls made from its destructor get
+  // the instance being destroyed.
+  static void DestroyInstance()
+  {
+    s_lock.Lock();
+
+    T* pInstance = Y_AtomicLoad(s_pInstance, ATOMIC_MEMORY_ORDER_RELAXED);
+    if (pInstance != nullptr)
+    {
+      pInstance->~T();
+      Y_AtomicStore(s_pInstance, static_cast<T*>(nullptr), ATOMIC_MEMORY_ORDER_RELEASE);
+    }
+
+    s_lock.Unlock();
+  }
+
+private:
+  static T* CreateInstance()
+  {
+    // trivial, so it's zeroed with the rest of static storage rather than needing a guard of its own
+    static typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+    s_lock.Lock();
+
+    T* pInstance = Y_AtomicLoad(s_pInstance, ATOMIC_MEMORY_ORDER_RELAXED);
+    if (pInstance == nullptr)
+    {
+      pInstance = new (&storage) T();
+      Y_AtomicStore(s_pInstance, pInstance, ATOMIC_MEMORY_ORDER_RELEASE);
+      std::atexit(&Singleton::DestroyInstance);
+    }
+
+    s_lock.Unlock();
+    return pInstance;
+  }
+
+  // both constant initialized, so usable from other static constructors
+  static T* volatile s_pInstance;
+  static SpinLock s_lock;
 };
+
+template<class T>
+T* volatile Singleton<T>::s_pInstance = nullptr;
+template<class T>
+SpinLock Singleton<T>::s_lock;
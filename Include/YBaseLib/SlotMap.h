@@ -0,0 +1,191 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/MemArray.h"
+#include "YBaseLib/PODArray.h"
+
+// Objects stored by value in one packed array, each reached through a handle that stays the same while the object
+// moves around in it, for objects that would otherwise be a HashTable<ID, T*> and a heap allocation each.
+// Insert, Remove and Get are O(1), and iterating with begin()/end() walks the packed array in no particular order.
+// Removal moves the last object into the hole, so pointers to objects are only valid until the next Remove.
+//
+// A handle packs the index of a slot, which points into the packed array, with the generation of the slot, bumped
+// every time its object is removed, so a handle to a removed object doesn't find whatever reuses its slot. With
+// 32-bit handles there are 20 bits of index, about a million objects, and a slot's generation wraps after 4095
+// reuses; with 64-bit handles both are 32 bits. Free slots are reused oldest first, so a stale handle only aliases
+// after its slot has been through every generation. Handles are never 0, which is InvalidHandle.
+// Objects must be relocatable by memcpy (see MemArray).
+template<class T, typename HandleType = uint32>
+class SlotMap
+{
+  static_assert(sizeof(HandleType) == 4 || sizeof(HandleType) == 8, "handles are 32 or 64 bit");
+
+public:
+  static const HandleType InvalidHandle = 0;
+  static const uint32 IndexBits = (sizeof(HandleType) == 4) ? 20 : 32;
+  static const uint32 GenerationBits = sizeof(HandleType) * 8 - IndexBits;
+  static const uint32 MaxSize = static_cast<uint32>((static_cast<uint64>(1) << IndexBits) - 1);
+
+  SlotMap() : m_firstFreeSlot(NoFreeSlot), m_lastFreeSlot(NoFreeSlot) {}
+
+  uint32 GetSize() const { return m_values.GetSize(); }
+  bool IsEmpty() const { return m_values.IsEmpty(); }
+
+  void Reserve(uint32 count)
+  {
+    m_values.Reserve(count);
+    m_valueSlots.Reserve(count);
+    m_slots.Reserve(count);
+  }
+
+  // removes every object, handles to them stop being valid as if each had been removed
+  void Clear()
+  {
+    for (uint32 i = 0; i < m_valueSlots.GetSize(); i++)
+      FreeSlot(m_valueSlots[i]);
+
+    m_values.Clear();
+    m_valueSlots.Clear();
+  }
+
+  HandleType Insert(const T& value)
+  {
+    uint32 slotIndex = AllocateSlot();
+    Slot& slot = m_slots[slotIndex];
+    slot.Index = m_values.GetSize();
+    m_values.Add(value);
+    m_valueSlots.Add(slotIndex);
+    return MakeHandle(slotIndex, slot.Generation);
+  }
+
+  bool Contains(HandleType handle) const { return (FindValueIndex(handle) != NoFreeSlot); }
+
+  T* Get(HandleType handle)
+  {
+    uint32 index = FindValueIndex(handle);
+    return (index != NoFreeSlot) ? &m_values[index] : nullptr;
+  }
+  const T* Get(HandleType handle) const { return const_cast<SlotMap*>(this)->Get(handle); }
+
+  // Removes the object if the handle still refers to one, moving the last object into its place.
+  bool Remove(HandleType handle)
+  {
+    uint32 index = FindValueIndex(handle);
+    if (index == NoFreeSlot)
+      return false;
+
+    FreeSlot(m_valueSlots[index]);
+
+    uint32 lastIndex = m_values.GetSize() - 1;
+    if (index != lastIndex)
+    {
+      m_slots[m_valueSlots[lastIndex]].Index = index;
+      m_valueSlots[index] = m_valueSlots[lastIndex];
+    }
+
+    m_values.FastRemove(index);
+    m_valueSlots.RemoveBack();
+    return true;
+  }
+
+  // the packed objects, by index from 0 to GetSize()
+  const T* GetBasePointer() const { return m_values.GetBasePointer(); }
+  T* GetBasePointer() { return m_values.GetBasePointer(); }
+  const T& operator[](uint32 index) const { return m_values[index]; }
+  T& operator[](uint32 index) { return m_values[index]; }
+
+  // handle of the object at a packed index
+  HandleType GetHandle(uint32 index) const
+  {
+    uint32 slotIndex = m_valueSlots[index];
+    return MakeHandle(slotIndex, m_slots[slotIndex].Generation);
+  }
+
+  const T* begin() const { return m_values.GetBasePointer(); }
+  const T* end() const { return m_values.GetBasePointer() + m_values.GetSize(); }
+  T* begin() { return m_values.GetBasePointer(); }
+  T* end() { return m_values.GetBasePointer() + m_values.GetSize(); }
+
+private:
+  // Index is the object's packed index while the slot is used, and the next free slot while it's free.
+  struct Slot
+  {
+    uint32 Index;
+    uint32 Generation;
+  };
+
+  static const uint32 NoFreeSlot = 0xFFFFFFFF;
+  static const uint32 GenerationMask = static_cast<uint32>((static_cast<uint64>(1) << GenerationBits) - 1);
+
+  static HandleType MakeHandle(uint32 slotIndex, uint32 generation)
+  {
+    return (static_cast<HandleType>(generation) << IndexBits) | static_cast<HandleType>(slotIndex);
+  }
+
+  // the object's packed index, or NoFreeSlot if the handle is stale or was never valid
+  uint32 FindValueIndex(HandleType handle) const
+  {
+    uint32 slotIndex = static_cast<uint32>(handle & static_cast<HandleType>(MaxSize));
+    uint32 generation = static_cast<uint32>(handle >> IndexBits);
+    if (slotIndex >= m_slots.GetSize() || m_slots[slotIndex].Generation != generation)
+      return NoFreeSlot;
+
+    // a free slot's generation is the next one to be handed out, which no handle has yet, but check the way back
+    // so made-up handles can't reach a free slot either
+    uint32 index = m_slots[slotIndex].Index;
+    return (index < m_valueSlots.GetSize() && m_valueSlots[index] == slotIndex) ? index : NoFreeSlot;
+  }
+
+  uint32 AllocateSlot()
+  {
+    if (m_firstFreeSlot == NoFreeSlot)
+    {
+      DebugAssert(m_slots.GetSize() < MaxSize);
+      Slot slot = {0, 1};
+      m_slots.Add(slot);
+      return m_slots.GetSize() - 1;
+    }
+
+    uint32 slotIndex = m_firstFreeSlot;
+    m_firstFreeSlot = m_slots[slotIndex].Index;
+    if (m_firstFreeSlot == NoFreeSlot)
+      m_lastFreeSlot = NoFreeSlot;
+
+    return slotIndex;
+  }
+
+  // bumps the generation, skipping 0 so no handle is InvalidHandle, and queues the slot for reuse
+  void FreeSlot(uint32 slotIndex)
+  {
+    Slot& slot = m_slots[slotIndex];
+    slot.Generation = (slot.Generation + 1) & GenerationMask;
+    if (slot.Generation == 0)
+      slot.Generation = 1;
+
+    slot.Index = NoFreeSlot;
+    if (m_lastFreeSlot != NoFreeSlot)
+      m_slots[m_lastFreeSlot].Index = slotIndex;
+    else
+      m_firstFreeSlot = slotIndex;
+    m_lastFreeSlot = slotIndex;
+  }
+
+  MemArray<T> m_values;
+  PODArray<uint32> m_valueSlots;
+  PODArray<Slot> m_slots;
+  uint32 m_firstFreeSlot;
+  uint32 m_lastFreeSlot;
+};
+
+template<class T, typename HandleType>
+const HandleType SlotMap<T, HandleType>::InvalidHandle;
+template<class T, typename HandleType>
+const uint32 SlotMap<T, HandleType>::IndexBits;
+template<class T, typename HandleType>
+const uint32 SlotMap<T, HandleType>::GenerationBits;
+template<class T, typename HandleType>
+const uint32 SlotMap<T, HandleType>::MaxSize;
+template<class T, typename HandleType>
+const uint32 SlotMap<T, HandleType>::NoFreeSlot;
+template<class T, typename HandleType>
+const uint32 SlotMap<T, HandleType>::GenerationMask;
@@ -0,0 +1,303 @@
+#pragma once
+#include "YBaseLib/Allocator.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Memory.h"
+#include <tuple>
+#include <type_traits>
+
+// Structure-of-arrays counterpart to AlignedMemArray, for loops that only touch a few fields of each element.
+// Every field is stored in its own column, and the columns share one allocation. Each column starts on an
+// ALIGNMENT boundary and is padded out to one, so vector loads of ALIGNMENT bytes from an aligned element never
+// leave the allocation. Fields must be trivially copyable, they are moved around with memcpy.
+//   AlignedSoAArray<32, HeapAllocator, float, float, float, uint32> particles;
+//   particles.Add(x, y, z, flags);
+//   float* pX = particles.GetColumn<0>();
+// Column pointers are invalidated by anything that grows or shrinks the reserve.
+template<int ALIGNMENT, class AllocatorType, typename... Fields>
+class AlignedSoAArray : private AllocatorType
+{
+  template<typename... Rest>
+  struct CheckFields
+  {
+    static const bool Value = true;
+  };
+  template<typename First, typename... Rest>
+  struct CheckFields<First, Rest...>
+  {
+    static const bool Value = std::is_trivially_copyable<First>::value && alignof(First) <= ALIGNMENT &&
+                              CheckFields<Rest...>::Value;
+  };
+
+public:
+  static const uint32 ColumnCount = sizeof...(Fields);
+
+  static_assert(ColumnCount > 0, "an array needs at least one field");
+  static_assert((ALIGNMENT & (ALIGNMENT - 1)) == 0, "ALIGNMENT must be a power of two");
+  static_assert(CheckFields<Fields...>::Value, "fields must be trivially copyable and aligned to at most ALIGNMENT");
+
+  template<uint32 COLUMN>
+  using FieldType = typename std::tuple_element<COLUMN, std::tuple<Fields...>>::type;
+
+  AlignedSoAArray() { Init(); }
+
+  explicit AlignedSoAArray(const AllocatorType& allocator) : AllocatorType(allocator) { Init(); }
+
+  AlignedSoAArray(uint32 nReserve, const AllocatorType& allocator = AllocatorType()) : AllocatorType(allocator)
+  {
+    Init();
+    Reserve(nReserve);
+  }
+
+  AlignedSoAArray(const AlignedSoAArray& c) : AllocatorType(c.GetAllocator())
+  {
+    Init();
+    Copy(c);
+  }
+
+  ~AlignedSoAArray() { FreeColumns(); }
+
+  // allocator the columns come from, copies of the array share a copy of it
+  const AllocatorType& GetAllocator() const { return *this; }
+  AllocatorType& GetAllocator() { return *this; }
+
+  void Clear() { m_uSize = 0; }
+
+  void Copy(const AlignedSoAArray& c)
+  {
+    Clear();
+    Reserve(c.m_uSize);
+    m_uSize = c.m_uSize;
+    for (uint32 column = 0; column < ColumnCount; column++)
+    {
+      if (m_uSize > 0)
+        std::memcpy(m_pColumns[column], c.m_pColumns[column], GetFieldSize(column) * m_uSize);
+    }
+  }
+
+  void Swap(AlignedSoAArray& c)
+  {
+    for (uint32 column = 0; column < ColumnCount; column++)
+      ::Swap(m_pColumns[column], c.m_pColumns[column]);
+    ::Swap(m_uSize, c.m_uSize);
+    ::Swap(m_uReserve, c.m_uReserve);
+    ::Swap(GetAllocator(), c.GetAllocator());
+  }
+
+  void Obliterate()
+  {
+    FreeColumns();
+    Init();
+  }
+
+  bool Equals(const AlignedSoAArray& c) const
+  {
+    if (c.m_uSize != m_uSize)
+      return false;
+
+    for (uint32 column = 0; column < ColumnCount; column++)
+    {
+      if (m_uSize > 0 && std::memcmp(m_pColumns[column], c.m_pColumns[column], GetFieldSize(column) * m_uSize) != 0)
+        return false;
+    }
+
+    return true;
+  }
+
+  void Reserve(uint32 nElements)
+  {
+    if (m_uReserve >= nElements)
+      return;
+
+    SetReserve(nElements);
+  }
+
+  void Resize(uint32 newSize)
+  {
+    if (newSize > m_uReserve)
+      Reserve(newSize);
+
+    m_uSize = newSize;
+  }
+
+  void Shrink()
+  {
+    if (m_uReserve == m_uSize)
+      return;
+
+    if (m_uSize == 0)
+      Obliterate();
+    else
+      SetReserve(m_uSize);
+  }
+
+  void Add(const Fields&... values)
+  {
+    // autosize
+    if (m_uSize == m_uReserve)
+      Reserve(Y_GetArrayGrowthSize(m_uSize, m_uSize + 1));
+
+    m_uSize++;
+    Set(m_uSize - 1, values...);
+  }
+
+  // overwrites every field of an element
+  void Set(uint32 index, const Fields&... values)
+  {
+    DebugAssert(index < m_uSize);
+
+    const void* pValues[] = {&values...};
+    for (uint32 column = 0; column < ColumnCount; column++)
+      std::memcpy(m_pColumns[column] + GetFieldSize(column) * index, pValues[column], GetFieldSize(column));
+  }
+
+  void Pop()
+  {
+    DebugAssert(m_uSize > 0);
+
+    m_uSize--;
+  }
+
+  // moves the last element into the removed one's place
+  void FastRemove(uint32 index)
+  {
+    DebugAssert(index < m_uSize);
+
+    uint32 lastIndex = m_uSize - 1;
+    if (index != lastIndex)
+    {
+      for (uint32 column = 0; column < ColumnCount; column++)
+      {
+        size_t fieldSize = GetFieldSize(column);
+        std::memcpy(m_pColumns[column] + fieldSize * index, m_pColumns[column] + fieldSize * lastIndex, fieldSize);
+      }
+    }
+
+    m_uSize--;
+  }
+
+  void OrderedRemove(uint32 index)
+  {
+    Assert(index < m_uSize);
+
+    uint32 moveCount = m_uSize - index - 1;
+    if (moveCount > 0)
+    {
+      for (uint32 column = 0; column < ColumnCount; column++)
+      {
+        size_t fieldSize = GetFieldSize(column);
+        byte* pElement = m_pColumns[column] + fieldSize * index;
+        std::memmove(pElement, pElement + fieldSize, fieldSize * moveCount);
+      }
+    }
+
+    m_uSize--;
+  }
+
+  uint32 GetSize() const { return m_uSize; }
+
+  uint32 GetReserve() const { return m_uReserve; }
+
+  // start of a column, aligned to ALIGNMENT, null until something has been reserved
+  template<uint32 COLUMN>
+  const FieldType<COLUMN>* GetColumn() const
+  {
+    return reinterpret_cast<const FieldType<COLUMN>*>(m_pColumns[COLUMN]);
+  }
+
+  template<uint32 COLUMN>
+  FieldType<COLUMN>* GetColumn()
+  {
+    return reinterpret_cast<FieldType<COLUMN>*>(m_pColumns[COLUMN]);
+  }
+
+  template<uint32 COLUMN>
+  const FieldType<COLUMN>& GetField(uint32 i) const
+  {
+    DebugAssert(i < m_uSize);
+    return GetColumn<COLUMN>()[i];
+  }
+
+  template<uint32 COLUMN>
+  FieldType<COLUMN>& GetField(uint32 i)
+  {
+    DebugAssert(i < m_uSize);
+    return GetColumn<COLUMN>()[i];
+  }
+
+  // assignment operator
+  AlignedSoAArray& operator=(const AlignedSoAArray& c)
+  {
+    Copy(c);
+    return *this;
+  }
+
+  // operator wrappers
+  bool operator==(const AlignedSoAArray& c) const { return Equals(c); }
+  bool operator!=(const AlignedSoAArray& c) const { return !Equals(c); }
+
+private:
+  static size_t GetFieldSize(uint32 column)
+  {
+    static const size_t fieldSizes[] = {sizeof(Fields)...};
+    return fieldSizes[column];
+  }
+
+  static size_t GetColumnSize(uint32 column, uint32 nElements)
+  {
+    return ALIGNED_SIZE(GetFieldSize(column) * nElements, (size_t)ALIGNMENT);
+  }
+
+  static size_t GetAllocationSize(uint32 nElements)
+  {
+    size_t size = 0;
+    for (uint32 column = 0; column < ColumnCount; column++)
+      size += GetColumnSize(column, nElements);
+    return size;
+  }
+
+  void Init()
+  {
+    for (uint32 column = 0; column < ColumnCount; column++)
+      m_pColumns[column] = NULL;
+    m_uSize = m_uReserve = 0;
+  }
+
+  // every column moves when the reserve changes, so this is always a fresh allocation
+  void SetReserve(uint32 nElements)
+  {
+    DebugAssert(nElements >= m_uSize && nElements > 0);
+
+    byte* pOldColumns = m_pColumns[0];
+    byte* pNewColumns = (byte*)GetAllocator().Allocate(GetAllocationSize(nElements), ALIGNMENT);
+    Assert(pNewColumns != NULL);
+
+    byte* pColumn = pNewColumns;
+    for (uint32 column = 0; column < ColumnCount; column++)
+    {
+      if (m_uSize > 0)
+        std::memcpy(pColumn, m_pColumns[column], GetFieldSize(column) * m_uSize);
+
+      m_pColumns[column] = pColumn;
+      pColumn += GetColumnSize(column, nElements);
+    }
+
+    if (pOldColumns != NULL)
+      GetAllocator().Free(pOldColumns, GetAllocationSize(m_uReserve), ALIGNMENT);
+    m_uReserve = nElements;
+  }
+
+  void FreeColumns()
+  {
+    if (m_pColumns[0] != NULL)
+      GetAllocator().Free(m_pColumns[0], GetAllocationSize(m_uReserve), ALIGNMENT);
+  }
+
+  byte* m_pColumns[ColumnCount];
+  uint32 m_uSize;
+  uint32 m_uReserve;
+};
+
+// SoA array with AlignedMemArray's defaults
+template<typename... Fields>
+using SoAArray = AlignedSoAArray<16, HeapAllocator, Fields...>;
@@ -0,0 +1,135 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Error.h"
+#include "YBaseLib/HashTable.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/Sockets/SocketAddress.h"
+#include "YBaseLib/Sockets/SocketMultiplexer.h"
+#include "YBaseLib/Timer.h"
+
+class StreamSocket;
+
+// Keeps outgoing connections once their users are done with them, by address, so the next request to the same host
+// skips the handshake and slow start. Connections are handed out by Acquire and given back with Release, and no more
+// than the limit per host are out or connecting at once, while idle ones wait to be reused for up to the idle
+// timeout. An idle connection is checked with StreamSocket::IsReusable before it's handed out again, and closed if
+// the peer has gone or sent something. New connections are made on the acquiring thread, as
+// SocketMultiplexer::ConnectStreamSocket does, with the socket the pool was created for.
+//   ConnectionPool pool(pMultiplexer, []() -> StreamSocket* { return new MySocket(); });
+//   MySocket* pSocket = static_cast<MySocket*>(pool.Acquire(&address, &error));
+//   ...
+//   pool.Release(pSocket);
+class ConnectionPool
+{
+public:
+  typedef SocketMultiplexer::CreateStreamSocketCallback CreateStreamSocketCallback;
+
+  // pSocket is null if there was no connection to be had, pError saying why, otherwise the callback has it until it's
+  // released
+  typedef SocketMultiplexer::ConnectFunction AcquireFunction;
+
+  static const uint32 DefaultMaxConnectionsPerHost = 8;
+
+  // milliseconds
+  static const uint32 DefaultIdleTimeout = 30000;
+
+  ConnectionPool(SocketMultiplexer* pMultiplexer, CreateStreamSocketCallback createCallback,
+                 uint32 maxConnectionsPerHost = DefaultMaxConnectionsPerHost, uint32 idleTimeout = DefaultIdleTimeout);
+
+  // closes the idle connections, every acquired one must have been released
+  ~ConnectionPool();
+
+  // Connects with TCP fast open where the platform has it, linux, so the first request goes out with the SYN once
+  // the host has handed out a cookie. The connect is then only made by the first send, which suits protocols where
+  // the client speaks first, and errors connecting show up there. Off by default, set it before acquiring.
+  void SetFastOpen(bool enabled) { m_fastOpen = enabled; }
+  bool GetFastOpen() const { return m_fastOpen; }
+
+  // The most recently released healthy connection to the address, or a new one. Returns null with pError set if it
+  // couldn't connect, or the host already has its limit of connections out.
+  StreamSocket* Acquire(const SocketAddress* pAddress, Error* pError);
+
+  // The same, except at the limit the request waits for one of the host's connections to be released, and is called
+  // back on the releasing thread. Otherwise it's called back before this returns.
+  void Acquire(const SocketAddress* pAddress, AcquireFunction callback);
+
+  // Gives back a connection from Acquire, along with the caller's reference. It's kept for reuse if reusable and
+  // still connected, or goes straight to a waiting request, otherwise it's closed. Pass false for a connection left
+  // partway through a request.
+  void Release(StreamSocket* pSocket, bool reusable = true);
+
+  // Closes connections idle for longer than the timeout and those that have disconnected, and forgets hosts with
+  // nothing left. A host's connections are otherwise only looked at when it's acquired from, so call this now and
+  // then, from a SocketTimer for instance.
+  void PruneIdleConnections();
+
+  // closes every idle connection
+  void CloseIdleConnections();
+
+  // connections idle in the pool, and acquired or connecting, across all hosts
+  uint32 GetIdleConnectionCount();
+  uint32 GetActiveConnectionCount();
+
+private:
+  struct IdleConnection
+  {
+    StreamSocket* pSocket;
+    double ReleaseTime;
+  };
+
+  struct Waiter
+  {
+    Waiter(AcquireFunction callback) : Callback(std::move(callback)), pNext(nullptr) {}
+
+    AcquireFunction Callback;
+    Waiter* pNext;
+  };
+
+  struct Host
+  {
+    SocketAddress Address;
+
+    // oldest first, so the most recently used is taken and the longest idle expire first
+    PODArray<IdleConnection> IdleConnections;
+
+    // connections acquired or being connected, which the limit is on
+    uint32 ActiveCount;
+
+    // requests waiting for a connection to be released, in order
+    Waiter* pWaitingHead;
+    Waiter* pWaitingTail;
+  };
+
+  typedef HashTable<SocketAddress, Host*> HostTable;
+
+  // Finds or adds the address's host, with the lock held.
+  Host* GetHost(const SocketAddress* pAddress);
+
+  // Fills a slot already counted in the host's active connections, with an idle connection or a new one. Returns
+  // null with pError set if it couldn't connect, the slot is still taken.
+  StreamSocket* TakeConnection(Host* pHost, Error* pError);
+
+  // Frees a slot, or hands it to the first waiting request, and the next if that one's connect fails.
+  void ReleaseSlot(Host* pHost);
+
+  // closes and releases sockets taken out of the pool, without the lock
+  static void CloseConnections(const PODArray<StreamSocket*>& sockets);
+
+  SocketMultiplexer* m_pMultiplexer;
+  CreateStreamSocketCallback m_createCallback;
+  uint32 m_maxConnectionsPerHost;
+  uint32 m_idleTimeout;
+  bool m_fastOpen;
+
+  Mutex m_lock;
+  HostTable m_hosts;
+
+  // which host each acquired connection belongs to
+  HashTable<StreamSocket*, Host*> m_acquiredConnections;
+
+  // idle times are measured on this
+  Timer m_timer;
+
+  DeclareNonCopyable(ConnectionPool);
+};
@@ -1,6 +1,8 @@
 #pragma once
 #include "YBaseLib/ReferenceCounted.h"
 #include "YBaseLib/Sockets/Common.h"
+#include "YBaseLib/Sockets/SocketStats.h"
+#include "YBaseLib/ThreadCachedHeap.h"
 
 #ifdef Y_SOCKET_IMPLEMENTATION_GENERIC
 
@@ -9,15 +11,31 @@ class SocketMultiplexer;
 class BaseSocket : public ReferenceCounted
 {
 public:
-  BaseSocket() {}
+  BaseSocket() : m_eventLoopIndex(0) {}
   virtual ~BaseSocket() {}
 
   virtual void Close() = 0;
 
+  // Sockets come from ThreadCachedHeap, so the ones accepted on an event loop are carved from that loop thread's
+  // cache, and one freed after its connection ends is handed to the next accepted, rather than each going through
+  // the shared heap lock in a connection storm. Subclasses needing more than 16 byte alignment declare their own.
+  static void* operator new(size_t size) { return ThreadCachedHeap::Allocate(size); }
+  static void operator delete(void* pMemory) { ThreadCachedHeap::Free(pMemory); }
+
+  // the socket's traffic so far, see SocketStats
+  SocketStats GetStats() const { return m_stats; }
+
+protected:
+  // updated with the socket lock held
+  SocketStats m_stats;
+
 private:
   virtual void OnReadEvent() = 0;
   virtual void OnWriteEvent() = 0;
 
+  // the multiplexer's event loop the socket is bound on
+  uint32 m_eventLoopIndex;
+
   // Ugly, but needed in order to call the events.
   friend SocketMultiplexer;
 };
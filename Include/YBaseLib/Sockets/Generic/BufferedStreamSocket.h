@@ -1,5 +1,8 @@
 #pragma once
 #include "YBaseLib/CircularBuffer.h"
+#include "YBaseLib/Sockets/SocketBuffer.h"
+#include "YBaseLib/Sockets/SocketRateLimiter.h"
+#include "YBaseLib/Sockets/SocketTimer.h"
 #include "YBaseLib/Sockets/StreamSocket.h"
 
 #ifdef Y_SOCKET_IMPLEMENTATION_GENERIC
@@ -7,30 +10,99 @@
 class BufferedStreamSocket : public StreamSocket
 {
 public:
+  enum ReceiveMode
+  {
+    // received bytes are copied into the receive buffer, then read out with Read or AcquireReadBuffer
+    ReceiveMode_Buffered,
+
+    // Received bytes go straight into pooled SocketBuffers handed to OnReadBuffer, which keeps them by adding a
+    // reference. Up to the receive buffer size is taken per event, and the rest is left for the next.
+    ReceiveMode_PooledBuffers,
+  };
+
   BufferedStreamSocket(size_t receiveBufferSize = 16384, size_t sendBufferSize = 16384);
   virtual ~BufferedStreamSocket();
 
+  ReceiveMode GetReceiveMode() const { return m_receiveMode; }
+  void SetReceiveMode(ReceiveMode mode);
+
   // Hide StreamSocket read/write methods.
   size_t Read(void* pBuffer, size_t bufferSize);
   size_t Write(const void* pBuffer, size_t bufferSize);
   size_t WriteVector(const void** ppBuffers, const size_t* pBufferLengths, size_t numBuffers);
 
+  // Holds writes back until the last Uncork, then sends them with one call, for handlers writing several small
+  // messages. Corks nest. Writes made while handling a read event are corked this way already.
+  void Cork();
+  void Uncork();
+
+  // Caps what this socket sends in bytes per second, 0 for unlimited, as well as the multiplexer's limit. Writes past
+  // it are buffered, as if the peer were slow to read, and sent as the limit allows.
+  void SetSendRateLimit(uint64 bytesPerSecond, uint64 burstBytes = 0);
+
   // Access to read buffer.
   bool AcquireReadBuffer(const void** ppBuffer, size_t* pBytesAvailable);
   void ReleaseReadBuffer(size_t bytesConsumed);
 
+  // also requires the receive buffer to be empty
+  virtual bool IsReusable() override;
+
 protected:
   virtual void OnConnected() override;
   virtual void OnDisconnected(Error* pError) override;
   virtual void OnRead() override;
 
+  // Each pooled buffer received, with the socket lock held, followed by OnRead once the event's reads are done.
+  // This copies into the receive buffer, for subclasses that only use Read and AcquireReadBuffer.
+  virtual void OnReadBuffer(SocketBuffer* pBuffer);
+
+  // The send buffer has been flushed, by a write event or the last Uncork, with the socket lock held. For writers
+  // waiting for room.
+  virtual void OnSendBufferSpace();
+
 private:
   virtual void OnReadEvent() override;
   virtual void OnWriteEvent() override;
 
+  // a corked write, held in the send buffer, which is flushed first if the write doesn't fit
+  size_t WriteCorked(const void* pBuffer, size_t bufferSize);
+
+  // copies what fits contiguously into the send buffer, returning how much did
+  size_t BufferBytes(const void* pBuffer, size_t bufferSize);
+
+  // Sends the buffered bytes and then the payload, if any, in one call, returning how much of the payload went.
+  // Sends no more than maxBytes, and what the rate limits allow. Returns false if the socket was closed on an error.
+  bool FlushSendBuffer(const void* pPayload, size_t payloadSize, size_t* pPayloadBytesSent,
+                       size_t maxBytes = SIZE_MAX);
+
+  // registers for write notifications while there's buffered data and no cork, and unregisters otherwise
+  void UpdateWriteNotification();
+
+  // Bytes the socket's and the multiplexer's rate limits allow sending now. With nothing allowed, the socket is
+  // throttled, taking no write events until a timer says the limits have refilled.
+  size_t GetSendAllowance();
+  void ConsumeSendAllowance(size_t bytes);
+  void ThrottleSends();
+  static void OnThrottleTimer(SocketTimer* pTimer, void* pUserData);
+
 private:
   CircularBuffer m_receiveBuffer;
   CircularBuffer m_sendBuffer;
+  ReceiveMode m_receiveMode;
+  uint32 m_corkCount;
+  bool m_writeNotificationsEnabled;
+
+  SocketRateLimiter m_sendRateLimiter;
+
+  // holds a reference to the socket while scheduled
+  SocketTimer m_throttleTimer;
+  bool m_sendThrottled;
+
+  // bytes this socket's write events can still send this round, see SocketMultiplexer::SetWriteQuantum
+  size_t m_writeDeficit;
+
+  // frames are parsed in place and written whole
+  friend MessageSocket;
 };
 
 #endif // #ifdef Y_SOCKET_IMPLEMENTATION_GENERIC
\ No newline at end of file
@@ -0,0 +1,206 @@
+#pragma once
+#include "YBaseLib/Coroutine.h"
+#include "YBaseLib/Sockets/BufferedStreamSocket.h"
+#include "YBaseLib/Sockets/SocketMultiplexer.h"
+
+#if defined(Y_SOCKET_IMPLEMENTATION_GENERIC) && Y_HAVE_COROUTINES
+
+// A buffered stream socket read and written by awaiting, so a connection's handling is written top to bottom in a
+// coroutine rather than split across OnRead and the write events. Waiting coroutines are resumed on the socket's
+// event loop thread with the socket lock held, as OnRead is called, and their writes while handling a read are corked
+// with the rest of the event's. One read and one write can be waiting at a time.
+//   Coroutine<> Echo(CoroutineStreamSocket* pSocket)
+//   {
+//     byte buffer[512];
+//     size_t length;
+//     while ((length = co_await pSocket->ReadAsync(buffer, sizeof(buffer))) > 0)
+//       co_await pSocket->WriteAsync(buffer, length);
+//   }
+class CoroutineStreamSocket : public BufferedStreamSocket
+{
+public:
+  // resolves to the bytes read, at least one, or zero once the socket has closed
+  class ReadAwaiter
+  {
+  public:
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) { return m_pSocket->SuspendRead(this, handle); }
+    size_t await_resume() const noexcept { return m_bytesRead; }
+
+  private:
+    friend CoroutineStreamSocket;
+
+    ReadAwaiter(CoroutineStreamSocket* pSocket, void* pBuffer, size_t bufferSize)
+      : m_pSocket(pSocket), m_pBuffer(pBuffer), m_bufferSize(bufferSize), m_bytesRead(0)
+    {
+    }
+
+    CoroutineStreamSocket* m_pSocket;
+    void* m_pBuffer;
+    size_t m_bufferSize;
+    size_t m_bytesRead;
+    std::coroutine_handle<> m_handle;
+  };
+
+  // resolves to the bytes sent or buffered, all of them unless the socket closed first
+  class WriteAwaiter
+  {
+  public:
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) { return m_pSocket->SuspendWrite(this, handle); }
+    size_t await_resume() const noexcept { return m_bytesWritten; }
+
+  private:
+    friend CoroutineStreamSocket;
+
+    WriteAwaiter(CoroutineStreamSocket* pSocket, const void* pBuffer, size_t bufferSize)
+      : m_pSocket(pSocket), m_pBuffer(static_cast<const byte*>(pBuffer)), m_bufferSize(bufferSize), m_bytesWritten(0)
+    {
+    }
+
+    CoroutineStreamSocket* m_pSocket;
+    const byte* m_pBuffer;
+    size_t m_bufferSize;
+    size_t m_bytesWritten;
+    std::coroutine_handle<> m_handle;
+  };
+
+  // Resolves and connects through the multiplexer, resuming on the new socket's event loop thread with the socket,
+  // whose reference the coroutine then holds, or null with the error in GetError. A request still waiting when the
+  // multiplexer is destroyed never resumes.
+  template<class T>
+  class ConnectAwaiter
+  {
+  public:
+    ConnectAwaiter(SocketMultiplexer* pMultiplexer, const char* hostName, uint32 port)
+      : m_pMultiplexer(pMultiplexer), m_hostName(hostName), m_port(port), m_pSocket(nullptr)
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+      m_handle = handle;
+      m_pMultiplexer->ConnectStreamSocket<T>(m_hostName, m_port, [this](StreamSocket* pSocket, const Error* pError) {
+        m_pSocket = static_cast<T*>(pSocket);
+        if (pSocket == nullptr && pError != nullptr)
+          m_error = *pError;
+        m_handle.resume();
+      });
+    }
+    T* await_resume() const noexcept { return m_pSocket; }
+
+    const Error* GetError() const { return &m_error; }
+
+  private:
+    SocketMultiplexer* m_pMultiplexer;
+    const char* m_hostName;
+    uint32 m_port;
+    T* m_pSocket;
+    Error m_error;
+    std::coroutine_handle<> m_handle;
+  };
+
+  CoroutineStreamSocket(size_t receiveBufferSize = 16384, size_t sendBufferSize = 16384)
+    : BufferedStreamSocket(receiveBufferSize, sendBufferSize), m_pReadAwaiter(nullptr), m_pWriteAwaiter(nullptr)
+  {
+  }
+
+  ReadAwaiter ReadAsync(void* pBuffer, size_t bufferSize) { return ReadAwaiter(this, pBuffer, bufferSize); }
+  WriteAwaiter WriteAsync(const void* pBuffer, size_t bufferSize) { return WriteAwaiter(this, pBuffer, bufferSize); }
+
+  // co_await CoroutineStreamSocket::ConnectAsync<ClientSocket>(pMultiplexer, "example.com", 80)
+  template<class T>
+  static ConnectAwaiter<T> ConnectAsync(SocketMultiplexer* pMultiplexer, const char* hostName, uint32 port)
+  {
+    return ConnectAwaiter<T>(pMultiplexer, hostName, port);
+  }
+
+protected:
+  virtual void OnDisconnected(Error* pError) override
+  {
+    BufferedStreamSocket::OnDisconnected(pError);
+
+    // both waiters finish short, taken first as either coroutine could go on to wait again
+    ReadAwaiter* pReadAwaiter = std::exchange(m_pReadAwaiter, nullptr);
+    WriteAwaiter* pWriteAwaiter = std::exchange(m_pWriteAwaiter, nullptr);
+    if (pReadAwaiter != nullptr)
+      pReadAwaiter->m_handle.resume();
+    if (pWriteAwaiter != nullptr)
+      pWriteAwaiter->m_handle.resume();
+  }
+
+  virtual void OnRead() override
+  {
+    BufferedStreamSocket::OnRead();
+    if (m_pReadAwaiter == nullptr)
+      return;
+
+    ReadAwaiter* pAwaiter = m_pReadAwaiter;
+    pAwaiter->m_bytesRead = Read(pAwaiter->m_pBuffer, pAwaiter->m_bufferSize);
+    if (pAwaiter->m_bytesRead == 0)
+      return;
+
+    m_pReadAwaiter = nullptr;
+    pAwaiter->m_handle.resume();
+  }
+
+  virtual void OnSendBufferSpace() override
+  {
+    BufferedStreamSocket::OnSendBufferSpace();
+    if (m_pWriteAwaiter == nullptr)
+      return;
+
+    // unregistered while writing, since a write failing closes the socket and resumes whoever is registered
+    WriteAwaiter* pAwaiter = std::exchange(m_pWriteAwaiter, nullptr);
+    pAwaiter->m_bytesWritten += Write(pAwaiter->m_pBuffer + pAwaiter->m_bytesWritten,
+                                      pAwaiter->m_bufferSize - pAwaiter->m_bytesWritten);
+    if (pAwaiter->m_bytesWritten < pAwaiter->m_bufferSize && m_connected)
+      m_pWriteAwaiter = pAwaiter;
+    else
+      pAwaiter->m_handle.resume();
+  }
+
+private:
+  // Reads what's already buffered, or waits for more. The check and the wait happen under the socket lock, so data
+  // arriving on the event loop in between can't be missed. Returns false to carry on without suspending.
+  bool SuspendRead(ReadAwaiter* pAwaiter, std::coroutine_handle<> handle)
+  {
+    m_lock.Lock();
+    DebugAssert(m_pReadAwaiter == nullptr);
+    pAwaiter->m_bytesRead = Read(pAwaiter->m_pBuffer, pAwaiter->m_bufferSize);
+    if (pAwaiter->m_bytesRead > 0 || !m_connected)
+    {
+      m_lock.Unlock();
+      return false;
+    }
+
+    pAwaiter->m_handle = handle;
+    m_pReadAwaiter = pAwaiter;
+    m_lock.Unlock();
+    return true;
+  }
+
+  // writes or buffers what fits, and waits for space for the rest
+  bool SuspendWrite(WriteAwaiter* pAwaiter, std::coroutine_handle<> handle)
+  {
+    m_lock.Lock();
+    DebugAssert(m_pWriteAwaiter == nullptr);
+    pAwaiter->m_bytesWritten = Write(pAwaiter->m_pBuffer, pAwaiter->m_bufferSize);
+    if (pAwaiter->m_bytesWritten == pAwaiter->m_bufferSize || !m_connected)
+    {
+      m_lock.Unlock();
+      return false;
+    }
+
+    pAwaiter->m_handle = handle;
+    m_pWriteAwaiter = pAwaiter;
+    m_lock.Unlock();
+    return true;
+  }
+
+  ReadAwaiter* m_pReadAwaiter;
+  WriteAwaiter* m_pWriteAwaiter;
+};
+
+#endif // #if defined(Y_SOCKET_IMPLEMENTATION_GENERIC) && Y_HAVE_COROUTINES
@@ -0,0 +1,83 @@
+#pragma once
+#include "YBaseLib/RecursiveMutex.h"
+#include "YBaseLib/Sockets/BaseSocket.h"
+#include "YBaseLib/Sockets/Common.h"
+#include "YBaseLib/Sockets/SocketAddress.h"
+#include "YBaseLib/Sockets/SocketBuffer.h"
+#include "YBaseLib/Sockets/SocketMultiplexer.h"
+
+#ifdef Y_SOCKET_IMPLEMENTATION_GENERIC
+
+// A UDP socket on a multiplexer. Datagrams are received in batches, with recvmmsg on Linux, into pooled
+// SocketBuffers handed to OnDatagram, and sent in batches with sendmmsg. Datagrams larger than a SocketBuffer are
+// dropped. Sends that would block are dropped too, as the network would.
+//   class ReplicationSocket : public DatagramSocket
+//   {
+//     virtual void OnDatagram(SocketBuffer* pBuffer, const SocketAddress* pFromAddress) override;
+//   };
+//   ReplicationSocket* pSocket = pMultiplexer->CreateDatagramSocket<ReplicationSocket>(&bindAddress, &error);
+class DatagramSocket : public BaseSocket
+{
+public:
+  // datagrams taken per receive call, and calls per read event, so other sockets get their turn
+  static const uint32 ReceiveBatchSize = 32;
+  static const uint32 ReceiveBatchesPerEvent = 8;
+
+  struct OutgoingDatagram
+  {
+    const SocketAddress* pAddress;
+    const void* pData;
+    size_t Size;
+  };
+
+  DatagramSocket();
+  virtual ~DatagramSocket();
+
+  const SocketAddress* GetLocalAddress() const { return &m_localAddress; }
+  bool IsOpen() const { return (m_fileDescriptor != INVALID_SOCKET); }
+
+  virtual void Close() override final;
+
+  // Returns false if it wasn't sent, which for a datagram isn't a failure of the socket.
+  bool SendTo(const SocketAddress* pAddress, const void* pData, size_t size);
+
+  // sends in order with as few calls as the platform allows, returning how many went before one didn't
+  uint32 SendBatch(const OutgoingDatagram* pDatagrams, uint32 count);
+
+  // Sends data to one address as datagrams of segmentSize bytes, the last possibly shorter. With UDP GSO on Linux
+  // the kernel splits it, so this is one call however many datagrams there are. Returns false if any weren't sent.
+  bool SendSegmented(const SocketAddress* pAddress, const void* pData, size_t size, size_t segmentSize);
+
+protected:
+  // Each datagram received, with the socket lock held. Add a reference to keep the buffer.
+  virtual void OnDatagram(SocketBuffer* pBuffer, const SocketAddress* pFromAddress);
+
+private:
+  virtual void OnReadEvent() override final;
+  virtual void OnWriteEvent() override final;
+
+  bool InitializeSocket(SocketMultiplexer* pMultiplexer, SOCKET fileDescriptor, Error* pError);
+
+  // one receive call, returning the number of datagrams it took, or -1 once there's nothing more to read
+  int32 ReceiveBatch();
+
+  // counts a call in the stats, with the datagrams it sent, negative results checked for would block
+  void RecordSend(int64 result, uint32 datagramCount);
+  void RecordReceiveCall(int64 result);
+
+private:
+  SocketMultiplexer* m_pMultiplexer;
+  SocketAddress m_localAddress;
+  RecursiveMutex m_lock;
+  SOCKET m_fileDescriptor;
+
+  // receive buffers not yet handed on, kept for the next batch
+  SocketBuffer* m_pReceiveBuffers[ReceiveBatchSize];
+
+  // whether the kernel took a UDP_SEGMENT send, cleared the first time it doesn't
+  bool m_segmentationOffload;
+
+  friend SocketMultiplexer;
+};
+
+#endif // Y_SOCKET_IMPLEMENTATION_GENERIC
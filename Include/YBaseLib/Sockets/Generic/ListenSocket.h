@@ -12,8 +12,10 @@ class ListenSocket : public BaseSocket
   friend SocketMultiplexer;
 
 public:
+  // With an event loop index, both the socket and the connections it accepts are bound on that loop, otherwise
+  // connections are spread across the loops.
   ListenSocket(SocketMultiplexer* pMultiplexer, SocketMultiplexer::CreateStreamSocketCallback acceptCallback,
-               SOCKET fileDescriptor);
+               SOCKET fileDescriptor, uint32 eventLoopIndex = Y_UINT32_MAX);
   virtual ~ListenSocket();
 
   const SocketAddress* GetLocalAddress() const { return &m_localAddress; }
@@ -22,6 +24,10 @@ public:
   virtual void Close() override final;
 
 private:
+  // Connections accepted for each read event before the loop moves on, so a storm on one listener doesn't hold up
+  // the other sockets on its loop. The rest are still waiting, and the next wait reports it readable again.
+  static const uint32 MaxAcceptsPerEvent = 64;
+
   virtual void OnReadEvent() override final;
   virtual void OnWriteEvent() override final;
 
@@ -30,6 +36,7 @@ private:
   SocketMultiplexer::CreateStreamSocketCallback m_acceptCallback;
   SocketAddress m_localAddress;
   uint32 m_numConnectionsAccepted;
+  uint32 m_acceptEventLoopIndex;
   SOCKET m_fileDescriptor;
 };
 
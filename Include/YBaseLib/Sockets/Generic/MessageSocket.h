@@ -0,0 +1,70 @@
+#pragma once
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/Sockets/BufferedStreamSocket.h"
+
+#ifdef Y_SOCKET_IMPLEMENTATION_GENERIC
+
+// A stream socket carrying length-prefixed messages. Frames are parsed straight out of the receive buffer and handed
+// to OnMessage in place, only copied when one wraps around the end of the buffer. Outgoing frames are batched into
+// vectored writes, and never sent in part. A frame over the maximum size in either direction is an error.
+//   class RpcSocket : public MessageSocket
+//   {
+//     virtual void OnMessage(const void* pData, size_t size) override;
+//   };
+//   RpcSocket* pSocket = pMultiplexer->ConnectStreamSocket<RpcSocket>(&address, &error);
+class MessageSocket : public BufferedStreamSocket
+{
+public:
+  enum LengthPrefix
+  {
+    // LEB128, as BinaryWriter::WriteVarUInt32 writes it
+    LengthPrefix_VarUInt32,
+
+    // 4 bytes, little-endian
+    LengthPrefix_UInt32,
+  };
+
+  // longest prefix of either kind
+  static const uint32 MaxPrefixSize = 5;
+
+  // frames taken per vectored write, two buffers each
+  static const uint32 MaxMessagesPerWrite = 64;
+
+  // The buffers are grown to fit whole frames of the maximum size.
+  MessageSocket(LengthPrefix lengthPrefix = LengthPrefix_VarUInt32, size_t maxMessageSize = 16384,
+                size_t receiveBufferSize = 16384, size_t sendBufferSize = 16384);
+  virtual ~MessageSocket();
+
+  LengthPrefix GetLengthPrefix() const { return m_lengthPrefix; }
+  size_t GetMaxMessageSize() const { return m_maxMessageSize; }
+
+  // Returns false if the message is too large, or the send buffer can't take all of it now.
+  bool WriteMessage(const void* pData, size_t size);
+
+  // Writes messages in order, as few calls as the send buffer allows, returning how many were taken before one
+  // wasn't. Messages the send buffer can't take whole yet are left for the caller to retry.
+  uint32 WriteMessages(const void* const* ppMessages, const size_t* pMessageSizes, uint32 count);
+
+protected:
+  // Each message received, with the socket lock held. The data is only valid for the call.
+  virtual void OnMessage(const void* pData, size_t size);
+
+  virtual void OnRead() override final;
+
+private:
+  // encodes size's prefix to pBuffer, returning its length
+  size_t EncodePrefix(size_t size, byte* pBuffer) const;
+
+  // Decodes a prefix from the bytes available, returning 1 with its length and the message size, 0 if more bytes
+  // are needed, or -1 if it's malformed.
+  int32 DecodePrefix(const byte* pBytes, size_t byteCount, size_t* pPrefixLength, size_t* pMessageSize) const;
+
+private:
+  LengthPrefix m_lengthPrefix;
+  size_t m_maxMessageSize;
+
+  // where frames that wrap around the receive buffer are put back together
+  PODArray<byte> m_reassemblyBuffer;
+};
+
+#endif // Y_SOCKET_IMPLEMENTATION_GENERIC
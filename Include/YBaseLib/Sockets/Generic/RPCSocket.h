@@ -0,0 +1,30 @@
+#pragma once
+#include "YBaseLib/RPCChannel.h"
+#include "YBaseLib/Sockets/MessageSocket.h"
+
+#ifdef Y_SOCKET_IMPLEMENTATION_GENERIC
+
+// An RPCChannel over a message socket, a batch of frames per message. Methods and callbacks run on the event loop
+// thread with the socket lock held, and batches the send buffer can't take wait for room. Calls still outstanding
+// when the connection closes fail with its error.
+//   RPCSocket* pSocket = pMultiplexer->ConnectStreamSocket<RPCSocket>(&address, &error);
+//   pSocket->GetChannel()->RegisterMethod(Method_Log, logMethod);
+class RPCSocket : public MessageSocket
+{
+public:
+  // The maximum message size is the channel's batch size.
+  RPCSocket(size_t maxMessageSize = 16384, size_t receiveBufferSize = 16384, size_t sendBufferSize = 16384);
+  virtual ~RPCSocket();
+
+  RPCChannel* GetChannel() { return &m_channel; }
+
+protected:
+  virtual void OnMessage(const void* pData, size_t size) override;
+  virtual void OnSendBufferSpace() override;
+  virtual void OnDisconnected(Error* pError) override;
+
+private:
+  RPCChannel m_channel;
+};
+
+#endif // Y_SOCKET_IMPLEMENTATION_GENERIC
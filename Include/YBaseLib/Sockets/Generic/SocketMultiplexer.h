@@ -1,13 +1,22 @@
 #pragma once
+#include "YBaseLib/CacheAligned.h"
 #include "YBaseLib/Error.h"
 #include "YBaseLib/Event.h"
+#include "YBaseLib/HashTable.h"
+#include "YBaseLib/InlineFunction.h"
 #include "YBaseLib/MemArray.h"
 #include "YBaseLib/Mutex.h"
+#include "YBaseLib/NumericLimits.h"
 #include "YBaseLib/PODArray.h"
 #include "YBaseLib/ReferenceCounted.h"
 #include "YBaseLib/Sockets/Common.h"
 #include "YBaseLib/Sockets/SocketAddress.h"
+#include "YBaseLib/Sockets/SocketRateLimiter.h"
+#include "YBaseLib/Sockets/SocketStats.h"
+#include "YBaseLib/Sockets/SocketTimer.h"
+#include "YBaseLib/Sockets/SocketTimerWheel.h"
 #include "YBaseLib/Thread.h"
+#include "YBaseLib/Timer.h"
 
 #ifdef Y_SOCKET_IMPLEMENTATION_GENERIC
 
@@ -15,6 +24,10 @@ class BaseSocket;
 class ListenSocket;
 class StreamSocket;
 class BufferedStreamSocket;
+class DatagramSocket;
+class SocketResolver;
+class TLSStreamSocket;
+class ConnectionPool;
 
 class SocketMultiplexer
 {
@@ -27,73 +40,330 @@ public:
   };
 
   typedef StreamSocket* (*CreateStreamSocketCallback)();
+  typedef DatagramSocket* (*CreateDatagramSocketCallback)();
+
+  Y_DECLARE_CACHE_ALIGNED_NEW();
+
+  // pAddress is null if the name didn't resolve, pError saying why
+  typedef void (*ResolveCallback)(const SocketAddress* pAddress, const Error* pError, void* pUserData);
+
+  // pSocket is null if it didn't resolve or connect, otherwise the callback takes its reference
+  typedef void (*ConnectCallback)(StreamSocket* pSocket, const Error* pError, void* pUserData);
+
+  // How listen sockets are set up, for CreateListenSocket and CreateListenSockets.
+  struct ListenOptions
+  {
+    ListenOptions() : Backlog(0), DeferAcceptSeconds(0) {}
+
+    // Connections the kernel holds waiting to be accepted, past which new handshakes are dropped. 0 is SOMAXCONN,
+    // and the kernel caps it at its own limit either way, net.core.somaxconn on linux.
+    uint32 Backlog;
+
+    // With TCP_DEFER_ACCEPT, on linux, a connection isn't handed over until its first data arrives or this many
+    // seconds pass, so connections that never send don't wake the loop. For protocols where the client speaks
+    // first, 0 accepts on the handshake.
+    uint32 DeferAcceptSeconds;
+  };
+
+  // the same callbacks as any callable, stored in the request rather than allocated
+  typedef InlineFunction<void(const SocketAddress* pAddress, const Error* pError)> ResolveFunction;
+  typedef InlineFunction<void(StreamSocket* pSocket, const Error* pError)> ConnectFunction;
   friend BaseSocket;
   friend ListenSocket;
   friend StreamSocket;
   friend BufferedStreamSocket;
+  friend DatagramSocket;
+  friend TLSStreamSocket;
+  friend ConnectionPool;
 
 public:
+  // Most event loops one multiplexer runs, and so most worker threads.
+  static const uint32 MaxEventLoops = 64;
+
+  // bytes a buffered socket's write event sends by default, see SetWriteQuantum
+  static const uint32 DefaultWriteQuantum = 65536;
+
   virtual ~SocketMultiplexer();
 
   // Access the type of multiplexer
-  SOCKET_MULTIPLEXER_TYPE GetType() const { return SOCKET_MULTIPLEXER_TYPE_GENERIC; }
+  SOCKET_MULTIPLEXER_TYPE GetType() const { return m_type; }
+
+  // Whether a type is built for this platform, and the best of those, which Create(pError) uses.
+  static bool IsTypeSupported(SOCKET_MULTIPLEXER_TYPE type);
+  static SOCKET_MULTIPLEXER_TYPE GetDefaultType();
 
-  // Factory method.
+  // Factory methods. Every type reports readiness level-triggered, so sockets see the same events from each.
   static SocketMultiplexer* Create(Error* pError);
+  static SocketMultiplexer* Create(SOCKET_MULTIPLEXER_TYPE type, Error* pError);
 
   // Public interface
   template<class T>
   ListenSocket* CreateListenSocket(const SocketAddress* pAddress, Error* pError);
   template<class T>
+  ListenSocket* CreateListenSocket(const SocketAddress* pAddress, const ListenOptions& options, Error* pError);
+  template<class T>
   T* ConnectStreamSocket(const SocketAddress* pAddress, Error* pError);
 
-  // Create worker threads, set threadCount to 0 for implementation-specific value.
+  // Looks a host name up on the resolver's threads, so no event loop waits on DNS, with answers cached for a while.
+  // The callback runs on the first event loop's thread.
+  void ResolveAddress(const char* hostName, uint32 port, ResolveCallback callback, void* pUserData);
+  void ResolveAddress(const char* hostName, uint32 port, ResolveFunction callback);
+
+  // Resolves and connects off the caller's thread, calling back on the new socket's event loop thread, or the first
+  // loop's if it failed. Requests still waiting when the multiplexer is destroyed are dropped without a callback.
+  template<class T>
+  void ConnectStreamSocket(const char* hostName, uint32 port, ConnectCallback callback, void* pUserData);
+  template<class T>
+  void ConnectStreamSocket(const char* hostName, uint32 port, ConnectFunction callback);
+
+  // a UDP socket bound to the address, port 0 for any, spread across the event loops like stream sockets
+  template<class T>
+  T* CreateDatagramSocket(const SocketAddress* pBindAddress, Error* pError);
+
+  // One listen socket per event loop on the same address, with SO_REUSEPORT so the kernel spreads connections
+  // between them, and each accepting onto its own loop. Where the kernel doesn't balance reused ports, this is a
+  // single listen socket spreading connections across the loops. Create the worker threads first.
+  template<class T>
+  bool CreateListenSockets(const SocketAddress* pAddress, PODArray<ListenSocket*>* pSockets, Error* pError);
+  template<class T>
+  bool CreateListenSockets(const SocketAddress* pAddress, const ListenOptions& options,
+                           PODArray<ListenSocket*>* pSockets, Error* pError);
+
+  // Each socket belongs to one event loop, handled by one worker thread, so sockets on different loops never share
+  // a lock. Connected and accepted sockets are spread across the loops in turn.
+  uint32 GetEventLoopCount() const { return m_eventLoopCount; }
+
+  // Create worker threads, one per event loop, adding loops up to threadCount, or the CPU count for 0. Sockets
+  // already open stay on the loops they're on. Returns the number of threads running.
   uint32 CreateWorkerThreads(uint32 threadCount = 0);
 
   // Stop worker threads.
   void StopWorkerThreads();
 
+  // Runs a timer in milliseconds, on the socket's event loop if there is one, so it fires on the thread that handles
+  // the socket, otherwise the first loop's. Scheduling a scheduled timer moves it. Scheduling and cancelling take
+  // constant time, and a timer costs nothing until it's due, when it fires after the loop's socket events, no
+  // earlier than asked. A timer is scheduled and cancelled from one thread at a time.
+  void ScheduleTimer(SocketTimer* pTimer, uint32 milliseconds, const BaseSocket* pSocket = nullptr);
+
+  // Returns false if it wasn't scheduled, which includes it having been taken to fire.
+  bool CancelTimer(SocketTimer* pTimer);
+
+  // Caps what the buffered stream sockets on the multiplexer send, between them, in bytes per second, 0 for
+  // unlimited, see SocketRateLimiter. Sockets over the limit buffer what they're given and stop taking write events
+  // until it allows more. Each socket can have its own limit as well, BufferedStreamSocket::SetSendRateLimit.
+  void SetSendRateLimit(uint64 bytesPerSecond, uint64 burstBytes = 0)
+  {
+    m_sendRateLimiter.SetRate(bytesPerSecond, burstBytes);
+  }
+
+  // Most bytes a buffered stream socket sends from its buffer for one write event, 0 for all it can. Every socket
+  // that's writable gets an event each loop iteration, so a few with a lot to send take turns with the rest rather
+  // than holding up the loop, deficit round robin style, with a share the kernel didn't take carried to the socket's
+  // next turn. Writes made from handlers aren't held to it, they only send when nothing's buffered.
+  void SetWriteQuantum(uint32 bytes) { m_writeQuantum = bytes; }
+  uint32 GetWriteQuantum() const { return m_writeQuantum; }
+
   // Close all sockets on this multiplexer.
   void CloseAll();
 
-  // Poll for events, set to Y_UINT32_MAX for infinite pause
+  // A snapshot of the loops' counters and the traffic of every socket opened on the multiplexer. Nothing is locked
+  // for counting, so it may be slightly stale while the loops are running.
+  SocketMultiplexerStats GetStats();
+
+  // Poll for events without worker threads, set to Y_UINT32_MAX for infinite pause. Only the first event loop
+  // waits, the others are checked without waiting.
   void PollEvents(uint32 milliseconds);
 
 protected:
   // Internal interface
-  ListenSocket* InternalCreateListenSocket(const SocketAddress* pAddress, CreateStreamSocketCallback callback,
-                                           Error* pError);
+  ListenSocket* InternalCreateListenSocket(const SocketAddress* pAddress, const ListenOptions& options,
+                                           CreateStreamSocketCallback callback, Error* pError);
+  // With fastOpen, where the platform has it, the handshake waits for the first send and carries its data once the
+  // host has given out a cookie, so connect errors show up on the first send or receive.
   StreamSocket* InternalConnectStreamSocket(const SocketAddress* pAddress, CreateStreamSocketCallback callback,
-                                            Error* pError);
+                                            Error* pError, bool fastOpen = false);
+  void InternalConnectStreamSocket(const char* hostName, uint32 port, CreateStreamSocketCallback createCallback,
+                                   ConnectFunction callback);
+  bool InternalCreateListenSockets(const SocketAddress* pAddress, const ListenOptions& options,
+                                   CreateStreamSocketCallback callback, PODArray<ListenSocket*>* pSockets,
+                                   Error* pError);
+  DatagramSocket* InternalCreateDatagramSocket(const SocketAddress* pBindAddress, CreateDatagramSocketCallback callback,
+                                               Error* pError);
 
 private:
   // Hide the constructor.
-  SocketMultiplexer();
+  SocketMultiplexer(SOCKET_MULTIPLEXER_TYPE type);
 
-  // Tracking of open sockets.
-  void AddOpenSocket(BaseSocket* pSocket);
+  // Opens a listening descriptor, with SO_REUSEPORT set if reusePort is.
+  static SOCKET OpenListenDescriptor(const SocketAddress* pAddress, const ListenOptions& options, bool reusePort,
+                                     Error* pError);
+
+  // Adds an event loop, returning false if its kernel queue can't be created.
+  bool AddEventLoop(Error* pError);
+
+  // Tracking of open sockets, which assigns the socket to an event loop, in turn for Y_UINT32_MAX.
+  void AddOpenSocket(BaseSocket* pSocket, uint32 eventLoopIndex = Y_UINT32_MAX);
   void RemoveOpenSocket(BaseSocket* pSocket);
 
-  // Register for notifications
+  // Register for notifications, on the socket's event loop
   void SetNotificationMask(BaseSocket* pSocket, SOCKET fileDescriptor, uint32 mask);
 
 private:
-  // We store the fd in the struct to avoid the cache miss reading the object.
-  struct BoundSocket
+  struct TriggeredSocket
   {
     BaseSocket* pSocket;
     uint32 EventMask;
-    SOCKET FileDescriptor;
   };
-  MemArray<BoundSocket> m_boundSockets;
-  Mutex m_boundSocketLock;
+
+  class WorkerThread;
+
+  // a resolve waiting on the resolver, then on an event loop to call back
+  class PendingResolve;
+
+  // Hands a resolved request to the socket's event loop, or the first if there's no socket, to call back on.
+  void QueueCompletion(PendingResolve* pPendingResolve, const BaseSocket* pSocket);
+
+  // A set of bound sockets and the means to wait on them, polled by at most one thread at a time.
+  class EventLoop
+  {
+  public:
+    EventLoop(SOCKET_MULTIPLEXER_TYPE type);
+    ~EventLoop();
+
+    Y_DECLARE_CACHE_ALIGNED_NEW();
+
+    // creates the epoll or kqueue descriptor for those types
+    bool Initialize(Error* pError);
+
+    void SetNotificationMask(BaseSocket* pSocket, SOCKET fileDescriptor, uint32 mask);
+    bool IsBound(const BaseSocket* pSocket);
+
+    // waits no longer than the nearest timer, then fires what triggered and the timers that are due
+    void PollEvents(uint32 milliseconds);
+
+    void ScheduleTimer(SocketTimer* pTimer, uint32 milliseconds);
+    bool CancelTimer(SocketTimer* pTimer);
+
+    // wakes a wait, whether on an empty loop or in the kernel, for stopping its thread
+    void Wakeup();
+
+    // adds this loop's counters to the snapshot
+    void AccumulateStats(SocketMultiplexerStats* pStats) const;
+
+    // Queues a resolve to call back after the next wait, which is cut short for it. Any thread can queue.
+    void QueueCompletion(PendingResolve* pPendingResolve);
+
+    WorkerThread* GetWorkerThread() const { return m_pWorkerThread; }
+    void SetWorkerThread(WorkerThread* pWorkerThread) { m_pWorkerThread = pWorkerThread; }
+
+  private:
+    uint64 GetCurrentTick() const;
+
+    // Advances the wheel to now, then fires the timers that are due one at a time, without the lock.
+    void FireTimers();
+
+    // Calls back the resolves queued, in order, without the lock, then deletes them.
+    void RunCompletions();
+
+    // Creates the descriptor Wakeup writes to, which every wait includes.
+    bool CreateWakeupSocket();
+    void DrainWakeupSocket();
+
+    // Updates the kernel's interest list for the epoll and kqueue types, called with the bound socket lock held.
+    bool UpdateKernelMask(SOCKET fileDescriptor, uint32 oldMask, uint32 newMask);
+
+    // Waits with each type's mechanism and fires what triggered, once there are sockets bound.
+    void PollSockets(uint32 milliseconds);
+    void PollSelect(uint32 milliseconds);
+    void PollPoll(uint32 milliseconds);
+    void PollEPoll(uint32 milliseconds);
+    void PollKQueue(uint32 milliseconds);
+
+    // Looks up the socket bound to a descriptor and adds a reference, with the bound socket lock held. Returns false
+    // if it was unbound from all of the events since the wait, which can happen as the lock isn't held while waiting.
+    bool FindTriggeredSocket(SOCKET fileDescriptor, uint32 eventMask, TriggeredSocket* pTriggeredSocket);
+
+    // Fires events on sockets found by FindTriggeredSocket, without the lock, then releases them.
+    void FireTriggeredSockets(TriggeredSocket* pTriggeredSockets, uint32 count);
+
+    // notes when the wait returned, which each iteration's time is taken from
+    void MarkWakeTime() { m_wakeTime = Y_TimerGetValue(); }
+
+    SOCKET_MULTIPLEXER_TYPE m_type;
+
+    // epoll or kqueue descriptor, for those types
+    int m_kernelQueue;
+
+    // We store the fd in the struct to avoid the cache miss reading the object.
+    struct BoundSocket
+    {
+      BaseSocket* pSocket;
+      uint32 EventMask;
+      SOCKET FileDescriptor;
+    };
+    MemArray<BoundSocket> m_boundSockets;
+    Mutex m_boundSocketLock;
+
+    // Index of each descriptor's entry in m_boundSockets, so masks change in constant time.
+    HashTable<SOCKET, uint32> m_boundSocketIndices;
+
+    // Wakeup when sleeping with no sockets.
+    Event m_wakeupEvent;
+
+    // A loopback datagram socket connected to itself, so another thread can interrupt a wait on sockets. Where
+    // there's a PollableEvent it's the event's descriptor instead, an eventfd on linux.
+    SOCKET m_wakeupSocket;
+#if defined(Y_PLATFORM_POSIX)
+    PollableEvent m_wakeupPollableEvent;
+#endif
+
+    // The tick the current wait ends on, Y_UINT64_MAX for infinite and 0 when not waiting, so scheduling a timer
+    // that's due sooner, or a mask change select and poll wouldn't see, knows to wake it.
+    uint64 m_waitEndTick;
+
+    // Timers, scheduled and fired with the bound socket lock held, on ticks of milliseconds since m_timerBase.
+    SocketTimerWheel m_timerWheel;
+    Y_TIMER_VALUE m_timerBase;
+
+    // resolves to call back, newest first
+    PendingResolve* m_pCompletions;
+
+    // Counters, written only by the thread polling the loop, and read without the lock for stats. They start a new
+    // cache line so the polling thread's writes don't take the line from threads adding timers and completions.
+    Y_CACHE_ALIGNED_DECL uint64 m_socketEvents;
+    uint64 m_timersFired;
+    uint64 m_completionsRun;
+    LatencyHistogram m_iterationTime;
+    Y_TIMER_VALUE m_wakeTime;
+
+    WorkerThread* m_pWorkerThread;
+
+    DeclareNonCopyable(EventLoop);
+  };
+
+  SOCKET_MULTIPLEXER_TYPE m_type;
+
+  // Loops are only added, and a slot is filled before the count includes it, so sockets look theirs up unlocked.
+  EventLoop* m_eventLoops[MaxEventLoops];
+  volatile uint32 m_eventLoopCount;
+
+  // round robin for new sockets, written by every thread creating one, so it's kept off the count's line
+  Y_CACHE_ALIGNED_DECL volatile uint32 m_nextEventLoop;
 
   // Open socket list
   PODArray<BaseSocket*> m_openSockets;
   Mutex m_openSocketLock;
 
-  // Wakeup when sleeping with no sockets.
-  Event m_wakeupEvent;
+  // traffic of the sockets no longer in the list, added as they're removed
+  SocketStats m_closedSocketStats;
+
+  // host name lookups, its threads are started by the first
+  SocketResolver* m_pResolver;
+
+  // shared by the buffered stream sockets, which read the quantum on each write event
+  SocketRateLimiter m_sendRateLimiter;
+  uint32 m_writeQuantum;
 
 private:
   // Worker thread
@@ -102,21 +372,27 @@ private:
     friend SocketMultiplexer;
 
   public:
-    WorkerThread(SocketMultiplexer* pThis);
+    WorkerThread(EventLoop* pEventLoop);
     virtual int ThreadEntryPoint() override final;
 
   private:
-    SocketMultiplexer* m_pThis;
+    EventLoop* m_pEventLoop;
     volatile bool m_stopFlag;
   };
-  WorkerThread* m_pWorkerThread;
 };
 
 template<class T>
 ListenSocket* SocketMultiplexer::CreateListenSocket(const SocketAddress* pAddress, Error* pError)
+{
+  return CreateListenSocket<T>(pAddress, ListenOptions(), pError);
+}
+
+template<class T>
+ListenSocket* SocketMultiplexer::CreateListenSocket(const SocketAddress* pAddress, const ListenOptions& options,
+                                                    Error* pError)
 {
   CreateStreamSocketCallback callback = []() -> StreamSocket* { return new T(); };
-  return InternalCreateListenSocket(pAddress, callback, pError);
+  return InternalCreateListenSocket(pAddress, options, callback, pError);
 }
 
 template<class T>
@@ -126,4 +402,42 @@ T* SocketMultiplexer::ConnectStreamSocket(const SocketAddress* pAddress, Error*
   return static_cast<T*>(InternalConnectStreamSocket(pAddress, callback, pError));
 }
 
+template<class T>
+void SocketMultiplexer::ConnectStreamSocket(const char* hostName, uint32 port, ConnectCallback callback,
+                                            void* pUserData)
+{
+  ConnectStreamSocket<T>(hostName, port, [callback, pUserData](StreamSocket* pSocket, const Error* pError) {
+    callback(pSocket, pError, pUserData);
+  });
+}
+
+template<class T>
+void SocketMultiplexer::ConnectStreamSocket(const char* hostName, uint32 port, ConnectFunction callback)
+{
+  CreateStreamSocketCallback createCallback = []() -> StreamSocket* { return new T(); };
+  InternalConnectStreamSocket(hostName, port, createCallback, std::move(callback));
+}
+
+template<class T>
+T* SocketMultiplexer::CreateDatagramSocket(const SocketAddress* pBindAddress, Error* pError)
+{
+  CreateDatagramSocketCallback callback = []() -> DatagramSocket* { return new T(); };
+  return static_cast<T*>(InternalCreateDatagramSocket(pBindAddress, callback, pError));
+}
+
+template<class T>
+bool SocketMultiplexer::CreateListenSockets(const SocketAddress* pAddress, PODArray<ListenSocket*>* pSockets,
+                                            Error* pError)
+{
+  return CreateListenSockets<T>(pAddress, ListenOptions(), pSockets, pError);
+}
+
+template<class T>
+bool SocketMultiplexer::CreateListenSockets(const SocketAddress* pAddress, const ListenOptions& options,
+                                            PODArray<ListenSocket*>* pSockets, Error* pError)
+{
+  CreateStreamSocketCallback callback = []() -> StreamSocket* { return new T(); };
+  return InternalCreateListenSockets(pAddress, options, callback, pSockets, pError);
+}
+
 #endif // Y_SOCKET_IMPLEMENTATION_GENERIC
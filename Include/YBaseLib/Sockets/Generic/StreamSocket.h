@@ -1,5 +1,6 @@
 #pragma once
 #include "YBaseLib/Error.h"
+#include "YBaseLib/NumericLimits.h"
 #include "YBaseLib/RecursiveMutex.h"
 #include "YBaseLib/Sockets/BaseSocket.h"
 #include "YBaseLib/Sockets/Common.h"
@@ -9,6 +10,9 @@
 
 class ListenSocket;
 class BufferedStreamSocket;
+class CoroutineStreamSocket;
+class MessageSocket;
+class TLSStreamSocket;
 
 class StreamSocket : public BaseSocket
 {
@@ -23,6 +27,11 @@ public:
   const SocketAddress* GetRemoteAddress() const { return &m_remoteAddress; }
   bool IsConnected() const { return m_connected; }
 
+  // Whether an idle connection can be handed to another user, being connected with nothing received. Anything
+  // arriving on an idle connection is the peer closing it, or bytes the next user's protocol would be out of step
+  // with. Subclasses that buffer received data check their buffers too.
+  virtual bool IsReusable();
+
   // Read/write
   size_t Read(void* pBuffer, size_t bufferSize);
   size_t Write(const void* pBuffer, size_t bufferSize);
@@ -37,8 +46,11 @@ private:
   virtual void OnReadEvent() override;
   virtual void OnWriteEvent() override;
 
-  bool InitializeSocket(SocketMultiplexer* pMultiplexer, SOCKET fileDescriptor, Error* pError);
+  // binds on the given event loop, or the next in turn for Y_UINT32_MAX, nonBlocking if the descriptor already is
+  bool InitializeSocket(SocketMultiplexer* pMultiplexer, SOCKET fileDescriptor, Error* pError,
+                        uint32 eventLoopIndex = Y_UINT32_MAX, bool nonBlocking = false);
   void CloseWithError();
+  void CloseWithError(const Error* pError);
 
 private:
   SocketMultiplexer* m_pMultiplexer;
@@ -52,6 +64,9 @@ private:
   friend SocketMultiplexer;
   friend ListenSocket;
   friend BufferedStreamSocket;
+  friend CoroutineStreamSocket;
+  friend MessageSocket;
+  friend TLSStreamSocket;
 };
 
 #endif // Y_SOCKET_IMPLEMENTATION_GENERIC
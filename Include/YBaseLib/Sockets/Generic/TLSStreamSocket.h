@@ -0,0 +1,111 @@
+#pragma once
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/Sockets/StreamSocket.h"
+#include "YBaseLib/Sockets/TLSContext.h"
+#include "YBaseLib/String.h"
+
+#if defined(Y_SOCKET_IMPLEMENTATION_GENERIC) && defined(HAVE_OPENSSL)
+
+// A stream socket speaking TLS. OpenSSL reads and writes the descriptor itself, so records are decrypted straight
+// into the buffer given to Read and encrypted from the one given to Write, with no ciphertext buffers in between,
+// and with kTLS the records don't pass through userspace at all. The socket is plaintext until StartTLS, or from the
+// start when constructed with a server context, so accepted sockets handshake on their own.
+//   class HttpsConnection : public TLSStreamSocket
+//   {
+//     HttpsConnection() : TLSStreamSocket(s_pServerContext) {}
+//     virtual void OnRead() override;
+//   };
+//   pSocket->StartTLS(pClientContext, "example.com");
+class TLSStreamSocket : public StreamSocket
+{
+public:
+  // the most plaintext in a record, writes are split at this
+  static const uint32 MaxRecordSize = 16384;
+
+  // A server context is accepted with once the socket connects, the socket holds a reference to it.
+  TLSStreamSocket(TLSContext* pAcceptContext = nullptr);
+  virtual ~TLSStreamSocket();
+
+  // Starts the handshake on the connected socket, as the server for a server context and the client otherwise. The
+  // server name is sent for SNI, verified against the certificate, and resumes the session last used with it.
+  // Returns false if the socket is closed, which it is on failure.
+  bool StartTLS(TLSContext* pContext, const char* serverName = nullptr);
+
+  // Sends close_notify if the handshake has completed, then closes.
+  void Shutdown();
+
+  // Accessors
+  bool IsTLSStarted() const { return (m_pSSL != nullptr); }
+  bool IsHandshakeComplete() const { return m_handshakeComplete; }
+  bool IsSessionReused() const;
+  const String& GetServerName() const { return m_serverName; }
+
+  // whether the kernel is encrypting sends and decrypting receives for this socket
+  bool IsKernelTLSSend() const;
+  bool IsKernelTLSReceive() const;
+
+  // also requires a completed handshake with nothing decrypted and unread, or kept to send
+  virtual bool IsReusable() override;
+
+  // Hide StreamSocket read/write methods. These are plaintext before StartTLS, and return 0 between it and the
+  // handshake completing. A record the socket can't take yet is kept and sent as it drains, counting as written,
+  // until then writes return 0. Stats count the plaintext and the calls into OpenSSL, which makes its own on the
+  // descriptor.
+  size_t Read(void* pBuffer, size_t bufferSize);
+  size_t Write(const void* pBuffer, size_t bufferSize);
+  size_t WriteVector(const void** ppBuffers, const size_t* pBufferLengths, size_t numBuffers);
+
+protected:
+  virtual void OnConnected() override;
+  virtual void OnDisconnected(Error* pError) override;
+
+  // With the lock held, once the handshake completes, so writes are taken.
+  virtual void OnHandshakeComplete();
+
+  // With the lock held, once a record that was kept for the socket to drain has gone, so writes are taken again.
+  virtual void OnWriteDrained();
+
+private:
+  virtual void OnReadEvent() override;
+  virtual void OnWriteEvent() override;
+
+  // Creates the session and sets it up for the side the context is for. The socket is closed on failure.
+  bool CreateSession(TLSContext* pContext, const char* serverName);
+  void FreeSession();
+
+  void ContinueHandshake();
+
+  // Calls OnRead until the handler stops taking the decrypted bytes, which OpenSSL buffers out of the socket's sight.
+  void DispatchRead();
+
+  // writes in records, gathered from bufferLength bytes
+  size_t WriteRecords(const byte* pBuffer, size_t bufferLength);
+
+  // Sends the kept record, returning false if it's still there.
+  bool FlushPendingWrite();
+
+  // Handles an OpenSSL call that didn't succeed, returning false if the socket was closed for it.
+  bool HandleSSLError(int result);
+
+  // registers for write notifications while OpenSSL is waiting to write, and unregisters otherwise
+  void UpdateWriteNotification();
+
+  TLSContext* m_pContext;
+  ssl_st* m_pSSL;
+  String m_serverName;
+
+  // a record OpenSSL has built and is waiting to send, which has to be retried with the same bytes
+  PODArray<byte> m_pendingWrite;
+
+  bool m_handshakeComplete;
+
+  // the handshake or a read is waiting for the socket to be writable
+  bool m_wantWrite;
+
+  bool m_writeNotificationsEnabled;
+
+  // set by each read returning data, so DispatchRead knows the handler is still taking them
+  bool m_readProgress;
+};
+
+#endif // Y_SOCKET_IMPLEMENTATION_GENERIC && HAVE_OPENSSL
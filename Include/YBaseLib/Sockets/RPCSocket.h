@@ -0,0 +1,7 @@
+#include "YBaseLib/Sockets/Common.h"
+
+#if defined(Y_SOCKET_IMPLEMENTATION_GENERIC)
+#include "YBaseLib/Sockets/Generic/RPCSocket.h"
+#else
+#error Unknown socket implementation.
+#endif
@@ -1,7 +1,10 @@
 #pragma once
 #include "YBaseLib/Common.h"
+#include "YBaseLib/HashTrait.h"
 #include "YBaseLib/String.h"
 
+class Error;
+
 struct SocketAddress
 {
   enum Type
@@ -18,29 +21,58 @@ struct SocketAddress
   SocketAddress(const SocketAddress& copy);
   SocketAddress& operator=(const SocketAddress& copy);
 
+  // the same type and sockaddr, so the same host and port
+  bool operator==(const SocketAddress& rhs) const;
+  bool operator!=(const SocketAddress& rhs) const { return !operator==(rhs); }
+
   // accessors
   Type GetType() const { return m_type; }
   const void* GetData() const { return m_data; }
 
+  // size of the sockaddr in GetData, 0 if the type isn't an IP address
+  size_t GetLength() const;
+
   // parse interface
   static bool Parse(Type type, const char* address, uint32 port, SocketAddress* pOutAddress);
 
-  // resolve interface
-  static bool Resolve(const char* address, uint32 port, SocketAddress* pOutAddress);
+  // Resolve interface, blocking, see SocketMultiplexer::ResolveAddress for the asynchronous version.
+  static bool Resolve(const char* address, uint32 port, SocketAddress* pOutAddress, Error* pError = nullptr);
 
   // to string interface
   void ToString(String& destination) const;
+  void AppendToString(String& destination) const;
   SmallString ToString() const;
 
   // initializers
   void SetUnknown();
   void SetFromSockaddr(const void* pSockaddr, size_t sockaddrLength);
 
+  // for IP addresses, otherwise ignored
+  void SetPort(uint32 port);
+
 private:
   Type m_type;
   byte m_data[128];
 };
 
+template<>
+struct HashTrait<SocketAddress>
+{
+  static HashType GetHash(const SocketAddress& Value) { return Y_HashBytes(Value.GetData(), Value.GetLength()); }
+};
+
+// addresses format as ToString() does, the spec is ignored
+namespace TypedFormat {
+template<>
+struct Formatter<SocketAddress>
+{
+  static void Format(String& destination, const SocketAddress& value, const StringView& spec)
+  {
+    value.AppendToString(destination);
+  }
+};
+} // namespace TypedFormat
+
 // struct SocketAddressIPv4 : public SocketAddress
 // {
 //     virtual Type GetType() { return SocketAddress::Type_IPv4; }
@@ -0,0 +1,53 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+
+template<class T>
+class ObjectPool;
+
+// A reference counted block of received bytes, taken from a pool shared by every socket. Sockets receive straight
+// into these and hand them on, so a payload can be kept or passed to another thread by adding a reference instead
+// of copying it out. The last release returns the block to the pool.
+//   void MySocket::OnReadBuffer(SocketBuffer* pBuffer)
+//   {
+//     pBuffer->AddRef();
+//     m_pendingPayloads.Add(pBuffer);
+//   }
+class SocketBuffer
+{
+public:
+  static const uint32 Capacity = 16384;
+
+  // blocks in the shared pool, beyond which they come from the heap and are freed when released
+  static const uint32 MaxPooledBuffers = 256;
+
+  // an empty block holding the one reference
+  static SocketBuffer* Allocate();
+
+  void AddRef() { Y_AtomicIncrement(m_referenceCount); }
+  uint32 Release();
+
+  const byte* GetData() const { return m_data; }
+  size_t GetSize() const { return m_size; }
+
+  // for filling the block, then setting how much of it holds data
+  byte* GetWritePointer() { return m_data; }
+  void SetSize(size_t size)
+  {
+    DebugAssert(size <= Capacity);
+    m_size = size;
+  }
+
+private:
+  friend class ObjectPool<SocketBuffer>;
+
+  SocketBuffer() : m_referenceCount(1), m_size(0) {}
+  ~SocketBuffer() {}
+
+  Y_ATOMIC_DECL uint32 m_referenceCount;
+  size_t m_size;
+  byte m_data[Capacity];
+
+  DeclareNonCopyable(SocketBuffer);
+};
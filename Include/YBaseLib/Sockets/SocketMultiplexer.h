@@ -3,10 +3,10 @@
 
 enum SOCKET_MULTIPLEXER_TYPE
 {
-  SOCKET_MULTIPLEXER_TYPE_GENERIC,
-  // SOCKET_MULTIPLEXER_TYPE_EPOLL,
-  // SOCKET_MULTIPLEXER_TYPE_KQUEUE,
-  // SOCKET_MULTIPLEXER_TYPE_IOCP,
+  SOCKET_MULTIPLEXER_TYPE_GENERIC, // select, everywhere
+  SOCKET_MULTIPLEXER_TYPE_POLL,    // poll, or WSAPoll on windows
+  SOCKET_MULTIPLEXER_TYPE_EPOLL,   // linux and android
+  SOCKET_MULTIPLEXER_TYPE_KQUEUE,  // mac and the bsds
   NUM_SOCKET_MULTIPLEXER_TYPES
 };
 
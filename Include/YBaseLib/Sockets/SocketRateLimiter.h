@@ -0,0 +1,42 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/Timer.h"
+
+// A token bucket of bytes, filling at the rate up to the burst size, for capping how fast sockets send. Sends are
+// made with whatever's available and then consumed, so one that goes over leaves the bucket in debt, which the next
+// has to wait out, rather than every send being cut to fit exactly. Unlimited until a rate is set. Any thread can
+// use it, so one limiter can be shared by many sockets.
+class SocketRateLimiter
+{
+public:
+  SocketRateLimiter();
+
+  // Bytes per second, 0 for unlimited. A burst of 0 is a tenth of a second's worth. The bucket starts full.
+  void SetRate(uint64 bytesPerSecond, uint64 burstBytes = 0);
+  uint64 GetRate() const { return m_bytesPerSecond; }
+  bool IsLimited() const { return (m_bytesPerSecond > 0); }
+
+  // bytes that can be sent now, SIZE_MAX when unlimited
+  size_t GetAvailable();
+
+  // takes bytes sent out of the bucket
+  void Consume(size_t bytes);
+
+  // milliseconds until bytes are available, or the whole burst if it's smaller, 0 if they are now
+  uint32 GetWaitTime(size_t bytes = 1);
+
+private:
+  // adds what's accumulated since the last refill, with the lock held
+  void Refill();
+
+  Mutex m_lock;
+  uint64 m_bytesPerSecond;
+  double m_burstBytes;
+
+  // negative while in debt
+  double m_tokens;
+  Y_TIMER_VALUE m_lastRefill;
+
+  DeclareNonCopyable(SocketRateLimiter);
+};
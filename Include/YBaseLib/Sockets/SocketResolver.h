@@ -0,0 +1,106 @@
+#pragma once
+#include "YBaseLib/CIStringHashTable.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/ConditionVariable.h"
+#include "YBaseLib/Error.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/Sockets/SocketAddress.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/Timer.h"
+
+// Resolves host names on threads of its own, so nothing handling sockets waits in getaddrinfo. Answers are cached by
+// host name, as getaddrinfo doesn't give the records' TTLs successes are kept for CacheLifetime and failures for
+// FailureCacheLifetime. What happens with an answer is up to the request, which is subclassed for it.
+//   class MyRequest : public SocketResolver::Request
+//   {
+//     MyRequest() : SocketResolver::Request("example.com", 80) {}
+//     virtual void OnResolved() override;
+//   };
+//   resolver.Resolve(new MyRequest());
+class SocketResolver
+{
+public:
+  static const uint32 ThreadCount = 4;
+
+  // milliseconds
+  static const uint32 CacheLifetime = 60000;
+  static const uint32 FailureCacheLifetime = 5000;
+
+  // past this, expired entries are dropped, and if there aren't any, everything
+  static const uint32 MaxCacheEntries = 1024;
+
+  class Request
+  {
+  public:
+    Request(const char* hostName, uint32 port)
+      : m_pNext(nullptr), m_hostName(hostName), m_port(port), m_resolved(false)
+    {
+      m_address.SetUnknown();
+    }
+    virtual ~Request() {}
+
+    const String& GetHostName() const { return m_hostName; }
+    uint32 GetPort() const { return m_port; }
+
+    // the answer, once OnResolved is called, the error set if it failed
+    bool IsResolved() const { return m_resolved; }
+    const SocketAddress* GetAddress() const { return &m_address; }
+    const Error* GetError() const { return &m_error; }
+
+    // Called on a resolver thread with the answer, which is free to block, and owns the request from then on.
+    virtual void OnResolved() = 0;
+
+    // unused by the resolver once the request is resolved, for queueing it elsewhere
+    Request* m_pNext;
+
+  private:
+    String m_hostName;
+    uint32 m_port;
+    SocketAddress m_address;
+    Error m_error;
+    bool m_resolved;
+
+    friend SocketResolver;
+  };
+
+  SocketResolver();
+
+  // stops the threads, after the lookups they're in, and deletes the requests they didn't get to
+  ~SocketResolver();
+
+  // Queues a request, owned by the resolver until it's resolved. Threads are started on the first.
+  void Resolve(Request* pRequest);
+
+  void ClearCache();
+
+private:
+  class ResolverThread;
+
+  struct CacheEntry
+  {
+    SocketAddress Address;
+    Error ResolveError;
+    double ExpiryTime;
+    bool Resolved;
+  };
+
+  // runs on each resolver thread
+  void WorkerLoop();
+
+  // Fills in the request from the cache, called with the lock held. Returns false if there's no live entry.
+  bool LookupCache(Request* pRequest);
+  void AddToCache(const Request* pRequest);
+
+  Mutex m_lock;
+  ConditionVariable m_requestConditionVariable;
+  Request* m_pWaitingHead;
+  Request* m_pWaitingTail;
+  PODArray<ResolverThread*> m_threads;
+  bool m_shutdown;
+
+  CIStringHashTable<CacheEntry> m_cache;
+  Timer m_cacheTimer;
+
+  DeclareNonCopyable(SocketResolver);
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/SchedulerStats.h"
+
+// Traffic counters for one socket, updated by the socket's calls into the kernel with the socket lock it already
+// holds, so counting takes no atomics. A snapshot taken while the socket is in use may be slightly stale. Counters
+// are cumulative, export the difference between snapshots.
+struct SocketStats
+{
+  uint64 BytesReceived;
+  uint64 BytesSent;
+
+  // for datagram sockets, each one a packet
+  uint64 DatagramsReceived;
+  uint64 DatagramsSent;
+
+  // calls into the kernel, and how many of those would have blocked
+  uint64 ReceiveCalls;
+  uint64 SendCalls;
+  uint64 ReceiveWouldBlock;
+  uint64 SendWouldBlock;
+
+  // times sends were held back by a rate limit
+  uint64 SendThrottled;
+
+  // most bytes waiting to be sent in userspace at once, the largest of any socket's in totals
+  uint64 MaxSendBufferBytes;
+
+  SocketStats() { Reset(); }
+
+  void Reset();
+  void Accumulate(const SocketStats& other);
+
+  // one call's result, negative for errors and would block, which are counted separately
+  void RecordReceive(int64 result)
+  {
+    ReceiveCalls++;
+    if (result > 0)
+      BytesReceived += (uint64)result;
+  }
+  void RecordSend(int64 result)
+  {
+    SendCalls++;
+    if (result > 0)
+      BytesSent += (uint64)result;
+  }
+
+  void RecordSendBuffered(uint64 bufferedBytes) { MaxSendBufferBytes = Max(MaxSendBufferBytes, bufferedBytes); }
+};
+
+// Snapshot of a multiplexer's counters.
+struct SocketMultiplexerStats
+{
+  uint32 EventLoopCount;
+  uint32 OpenSockets;
+
+  // sockets fired for read and write events, timers fired, and resolves called back
+  uint64 SocketEvents;
+  uint64 TimersFired;
+  uint64 CompletionsRun;
+
+  // each time a loop wakes with something to do, from the wait returning to its events, timers and completions
+  // having run
+  LatencyHistogram IterationTime;
+
+  // sum of every socket's counters, closed ones included
+  SocketStats Totals;
+
+  SocketMultiplexerStats()
+    : EventLoopCount(0), OpenSockets(0), SocketEvents(0), TimersFired(0), CompletionsRun(0)
+  {
+  }
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+
+class SocketMultiplexer;
+class SocketTimerWheel;
+
+// A timer run by a multiplexer's event loop, embedded in whatever owns it so scheduling never allocates. The
+// callback runs on the loop's thread once the timer is due, with no locks held, and may schedule it again.
+//   MySocket::MySocket() : m_idleTimer(OnIdleTimeout, this) {}
+//   void MySocket::OnIdleTimeout(SocketTimer* pTimer, void* pUserData) { static_cast<MySocket*>(pUserData)->Close(); }
+//   m_pMultiplexer->ScheduleTimer(&m_idleTimer, 30000, this);
+class SocketTimer
+{
+public:
+  typedef void (*Callback)(SocketTimer* pTimer, void* pUserData);
+
+  SocketTimer(Callback callback, void* pUserData)
+    : m_callback(callback), m_pUserData(pUserData), m_expiryTick(0), m_pNext(nullptr), m_ppPrevNext(nullptr),
+      m_eventLoopIndex(0)
+  {
+  }
+
+  // cancel it before it goes
+  ~SocketTimer() { DebugAssert(m_ppPrevNext == nullptr); }
+
+  // only meaningful to the thread that schedules and cancels it
+  bool IsScheduled() const { return (m_ppPrevNext != nullptr); }
+
+private:
+  Callback m_callback;
+  void* m_pUserData;
+
+  // the loop's tick it's due on
+  uint64 m_expiryTick;
+
+  // links in a wheel slot, m_ppPrevNext points at whatever points at this, so it can unlink without the slot
+  SocketTimer* m_pNext;
+  SocketTimer** m_ppPrevNext;
+
+  uint32 m_eventLoopIndex;
+
+  friend SocketMultiplexer;
+  friend SocketTimerWheel;
+
+  DeclareNonCopyable(SocketTimer);
+};
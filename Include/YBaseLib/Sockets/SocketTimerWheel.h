@@ -0,0 +1,52 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Sockets/SocketTimer.h"
+
+// The timers of one event loop, kept in a hierarchical wheel of millisecond ticks. Each level has a slot per tick of
+// the level below's whole span, covering about 4.6 hours in all, longer timers wait in the last level and go round
+// again. It has no clock or lock of its own, the loop passes the current tick in and holds its lock around each call.
+class SocketTimerWheel
+{
+public:
+  static const uint32 Levels = 4;
+  static const uint32 SlotBits = 6;
+  static const uint32 Slots = 1 << SlotBits;
+  static const uint32 SlotMask = Slots - 1;
+
+  SocketTimerWheel();
+
+  // timers still scheduled are let go, so their owners can destroy them
+  ~SocketTimerWheel();
+
+  // timers scheduled, including those taken to fire that haven't been yet
+  uint32 GetTimerCount() const { return m_timerCount; }
+
+  // Schedules a timer, or moves it if it's scheduled, to be due on the first tick after milliseconds have passed,
+  // returning that tick.
+  uint64 ScheduleTimer(SocketTimer* pTimer, uint64 currentTick, uint32 milliseconds);
+
+  // Returns false if it wasn't scheduled, which includes it having been taken to fire.
+  bool CancelTimer(SocketTimer* pTimer);
+
+  // Milliseconds until a timer might be due, no more than milliseconds, found by looking ahead in the wheel.
+  uint32 GetTimerWait(uint64 currentTick, uint32 milliseconds) const;
+
+  // Advances the wheel to the current tick, moving timers that are due to the due list.
+  void AdvanceTimers(uint64 currentTick);
+
+  // Takes the next timer off the due list, or null once it's empty.
+  SocketTimer* TakeDueTimer();
+
+private:
+  static void LinkTimer(SocketTimer** ppHead, SocketTimer* pTimer);
+  static void UnlinkTimer(SocketTimer* pTimer);
+  void InsertTimer(SocketTimer* pTimer);
+
+  // Slots, their timers due on the ticks from m_nextTick on, and the timers taken from them to fire.
+  SocketTimer* m_pSlots[Levels][Slots];
+  SocketTimer* m_pDueTimers;
+  uint64 m_nextTick;
+  uint32 m_timerCount;
+
+  DeclareNonCopyable(SocketTimerWheel);
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include "YBaseLib/CIStringHashTable.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/ReferenceCounted.h"
+
+#ifdef HAVE_OPENSSL
+
+class Error;
+class TLSStreamSocket;
+struct ssl_ctx_st;
+struct ssl_st;
+struct ssl_session_st;
+
+// Certificates, settings and the session cache shared by TLS sockets, over an OpenSSL SSL_CTX, which each socket
+// using it holds a reference to. Servers resume from OpenSSL's session cache and tickets, clients keep the latest
+// session each server name gave them, so reconnecting skips the full handshake. Where OpenSSL is built with kTLS and
+// the kernel has it, records are handed to the kernel once the handshake is done, taking encryption out of userspace.
+//   TLSContext* pContext = TLSContext::Create(TLSContext::Mode_Server, &error);
+//   pContext->SetCertificate("server.pem", "server.key", &error);
+class TLSContext : public ReferenceCounted
+{
+public:
+  enum Mode
+  {
+    Mode_Client,
+    Mode_Server,
+  };
+
+  // sessions kept by either side
+  static const uint32 MaxCachedSessions = 1024;
+
+  // TLS 1.2 and up, verifying servers against the system's certificates for clients.
+  static TLSContext* Create(Mode mode, Error* pError);
+
+  Mode GetMode() const { return m_mode; }
+
+  // PEM files, the chain starting with the certificate itself.
+  bool SetCertificate(const char* certificateChainFileName, const char* privateKeyFileName, Error* pError);
+
+  // Certificates to verify peers against, in place of the system's. Clients verify by default, servers don't ask
+  // for certificates unless verification is turned on.
+  bool SetVerifyLocations(const char* caFileName, Error* pError);
+  void SetVerifyPeer(bool enabled);
+  bool GetVerifyPeer() const { return m_verifyPeer; }
+
+  // on by default where it's available
+  void SetKernelTLS(bool enabled);
+
+  void ClearSessionCache();
+
+private:
+  TLSContext(Mode mode, ssl_ctx_st* pContext);
+  ~TLSContext();
+
+  // fills in an error from OpenSSL's error queue, clearing it
+  static void SetErrorFromQueue(Error* pError);
+
+  // The client session to resume the server name with, which the caller takes a reference to. TLS 1.3 sessions are
+  // taken out of the cache, as each ticket is meant to be used once, and the connection brings new ones.
+  ssl_session_st* TakeSession(const char* serverName);
+
+  // stores client sessions as the server sends them
+  static int NewSessionCallback(ssl_st* pSSL, ssl_session_st* pSession);
+
+  Mode m_mode;
+  ssl_ctx_st* m_pContext;
+  bool m_verifyPeer;
+
+  Mutex m_sessionLock;
+  CIStringHashTable<ssl_session_st*> m_sessions;
+
+  friend TLSStreamSocket;
+};
+
+#endif // HAVE_OPENSSL
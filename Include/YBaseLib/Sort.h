@@ -0,0 +1,354 @@
+#pragma once
+#include "YBaseLib/Allocator.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Memory.h"
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Sorting templates. The comparator is a template parameter, so unlike Y_qsort it gets inlined, and is any
+// callable returning true when the left element orders before the right one, like operator<.
+//   Y_sort           introsort, quicksort falling back to heap sort on bad pivots, not stable
+//   Y_stable_sort    merge sort, keeps equal elements in their original order
+//   Y_radix_sort     LSD radix sort on integer or floating point keys, stable, trivially copyable elements only
+// See ParallelSort.h for sorting across a ThreadPool.
+
+namespace SortDetail {
+
+// ranges this short are finished with an insertion sort
+static const size_t InsertionSortThreshold = 16;
+
+template<typename T, typename Compare>
+void SiftDown(T* pBase, size_t root, size_t count, Compare& compare)
+{
+  T value(std::move(pBase[root]));
+  for (;;)
+  {
+    size_t child = root * 2 + 1;
+    if (child >= count)
+      break;
+    if (child + 1 < count && compare(pBase[child], pBase[child + 1]))
+      child++;
+    if (!compare(value, pBase[child]))
+      break;
+
+    pBase[root] = std::move(pBase[child]);
+    root = child;
+  }
+
+  pBase[root] = std::move(value);
+}
+
+template<typename T, typename Compare>
+void IntroSort(T* pBase, size_t count, uint32 depthLimit, Compare& compare);
+
+template<typename T, typename Compare>
+void MergeSort(T* pBase, size_t count, T* pBuffer, Compare& compare);
+
+}; // namespace SortDetail
+
+template<typename T, typename Compare>
+void Y_insertion_sort(T* pBase, size_t count, Compare compare)
+{
+  for (size_t i = 1; i < count; i++)
+  {
+    if (!compare(pBase[i], pBase[i - 1]))
+      continue;
+
+    T value(std::move(pBase[i]));
+    size_t j = i;
+    do
+    {
+      pBase[j] = std::move(pBase[j - 1]);
+      j--;
+    } while (j > 0 && compare(value, pBase[j - 1]));
+
+    pBase[j] = std::move(value);
+  }
+}
+
+template<typename T, typename Compare>
+void Y_heap_sort(T* pBase, size_t count, Compare compare)
+{
+  if (count < 2)
+    return;
+
+  for (size_t i = count / 2; i > 0; i--)
+    SortDetail::SiftDown(pBase, i - 1, count, compare);
+
+  for (size_t i = count - 1; i > 0; i--)
+  {
+    std::swap(pBase[0], pBase[i]);
+    SortDetail::SiftDown(pBase, 0, i, compare);
+  }
+}
+
+template<typename T, typename Compare>
+void Y_sort(T* pBase, size_t count, Compare compare)
+{
+  // quicksort gets 2 * log2(count) levels before heap sort takes over
+  uint32 depthLimit = 0;
+  for (size_t remaining = count; remaining > 1; remaining >>= 1)
+    depthLimit += 2;
+
+  SortDetail::IntroSort(pBase, count, depthLimit, compare);
+}
+
+template<typename T>
+void Y_sort(T* pBase, size_t count)
+{
+  Y_sort(pBase, count, [](const T& left, const T& right) { return left < right; });
+}
+
+template<typename T, typename Compare>
+void Y_stable_sort(T* pBase, size_t count, Compare compare)
+{
+  if (count <= SortDetail::InsertionSortThreshold)
+  {
+    Y_insertion_sort(pBase, count, compare);
+    return;
+  }
+
+  // merges only ever need to set aside the left half
+  HeapAllocator allocator;
+  size_t bufferSize = sizeof(T) * (count / 2);
+  T* pBuffer = reinterpret_cast<T*>(allocator.Allocate(bufferSize, alignof(T)));
+  Assert(pBuffer != nullptr);
+  SortDetail::MergeSort(pBase, count, pBuffer, compare);
+  allocator.Free(pBuffer, bufferSize, alignof(T));
+}
+
+template<typename T>
+void Y_stable_sort(T* pBase, size_t count)
+{
+  Y_stable_sort(pBase, count, [](const T& left, const T& right) { return left < right; });
+}
+
+// Maps radix sort keys to unsigned integers that sort the same way. Negative floats have every bit flipped and
+// positive ones just the sign bit, so -0.0 sorts before 0.0 and NaNs go to the ends by their sign.
+template<typename K>
+struct RadixKeyTrait;
+
+template<>
+struct RadixKeyTrait<uint32>
+{
+  typedef uint32 UnsignedType;
+  static UnsignedType ToUnsigned(uint32 key) { return key; }
+};
+
+template<>
+struct RadixKeyTrait<int32>
+{
+  typedef uint32 UnsignedType;
+  static UnsignedType ToUnsigned(int32 key) { return (uint32)key ^ 0x80000000u; }
+};
+
+template<>
+struct RadixKeyTrait<uint64>
+{
+  typedef uint64 UnsignedType;
+  static UnsignedType ToUnsigned(uint64 key) { return key; }
+};
+
+template<>
+struct RadixKeyTrait<int64>
+{
+  typedef uint64 UnsignedType;
+  static UnsignedType ToUnsigned(int64 key) { return (uint64)key ^ 0x8000000000000000ULL; }
+};
+
+template<>
+struct RadixKeyTrait<float>
+{
+  typedef uint32 UnsignedType;
+  static UnsignedType ToUnsigned(float key)
+  {
+    uint32 bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+  }
+};
+
+template<>
+struct RadixKeyTrait<double>
+{
+  typedef uint64 UnsignedType;
+  static UnsignedType ToUnsigned(double key)
+  {
+    uint64 bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    return (bits & 0x8000000000000000ULL) ? ~bits : (bits | 0x8000000000000000ULL);
+  }
+};
+
+// sorts by getKey(element), which returns one of the key types above. elements are moved with memcpy through a
+// scratch copy of the array, and byte positions every key agrees on are skipped.
+template<typename T, typename KeyFunction>
+void Y_radix_sort(T* pBase, size_t count, KeyFunction getKey)
+{
+  static_assert(std::is_trivially_copyable<T>::value, "radix sort moves elements with memcpy");
+  typedef typename std::decay<decltype(getKey(*pBase))>::type KeyType;
+  typedef RadixKeyTrait<KeyType> KeyTrait;
+  typedef typename KeyTrait::UnsignedType UnsignedKey;
+  static const uint32 PassCount = sizeof(UnsignedKey);
+
+  if (count <= SortDetail::InsertionSortThreshold * 4)
+  {
+    Y_insertion_sort(pBase, count, [&getKey](const T& left, const T& right) {
+      return KeyTrait::ToUnsigned(getKey(left)) < KeyTrait::ToUnsigned(getKey(right));
+    });
+    return;
+  }
+
+  // one read fills the histograms for every pass
+  size_t histograms[PassCount][256];
+  std::memset(histograms, 0, sizeof(histograms));
+  for (size_t i = 0; i < count; i++)
+  {
+    UnsignedKey key = KeyTrait::ToUnsigned(getKey(pBase[i]));
+    for (uint32 pass = 0; pass < PassCount; pass++)
+      histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+  }
+
+  HeapAllocator allocator;
+  T* pScratch = reinterpret_cast<T*>(allocator.Allocate(sizeof(T) * count, alignof(T)));
+  Assert(pScratch != nullptr);
+
+  T* pSource = pBase;
+  T* pDestination = pScratch;
+  UnsignedKey firstKey = KeyTrait::ToUnsigned(getKey(pBase[0]));
+  for (uint32 pass = 0; pass < PassCount; pass++)
+  {
+    size_t* pHistogram = histograms[pass];
+    if (pHistogram[(firstKey >> (pass * 8)) & 0xFF] == count)
+      continue;
+
+    size_t offset = 0;
+    for (uint32 i = 0; i < 256; i++)
+    {
+      size_t bucketCount = pHistogram[i];
+      pHistogram[i] = offset;
+      offset += bucketCount;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+      UnsignedKey key = KeyTrait::ToUnsigned(getKey(pSource[i]));
+      std::memcpy(&pDestination[pHistogram[(key >> (pass * 8)) & 0xFF]++], &pSource[i], sizeof(T));
+    }
+
+    std::swap(pSource, pDestination);
+  }
+
+  if (pSource != pBase)
+    std::memcpy(pBase, pSource, sizeof(T) * count);
+
+  allocator.Free(pScratch, sizeof(T) * count, alignof(T));
+}
+
+template<typename T>
+void Y_radix_sort(T* pBase, size_t count)
+{
+  Y_radix_sort(pBase, count, [](const T& value) { return value; });
+}
+
+template<typename T, typename Compare>
+void SortDetail::IntroSort(T* pBase, size_t count, uint32 depthLimit, Compare& compare)
+{
+  while (count > InsertionSortThreshold)
+  {
+    if (depthLimit == 0)
+    {
+      Y_heap_sort(pBase, count, compare);
+      return;
+    }
+    depthLimit--;
+
+    // median of three goes to the front as the pivot, leaving an element on each side that stops the scans
+    size_t middle = count / 2;
+    if (compare(pBase[middle], pBase[1]))
+      std::swap(pBase[middle], pBase[1]);
+    if (compare(pBase[count - 1], pBase[middle]))
+    {
+      std::swap(pBase[count - 1], pBase[middle]);
+      if (compare(pBase[middle], pBase[1]))
+        std::swap(pBase[middle], pBase[1]);
+    }
+    std::swap(pBase[0], pBase[middle]);
+
+    // hoare partition, stopping on equal elements keeps runs of duplicates balanced
+    size_t left = 0;
+    size_t right = count;
+    for (;;)
+    {
+      do
+      {
+        left++;
+      } while (compare(pBase[left], pBase[0]));
+      do
+      {
+        right--;
+      } while (compare(pBase[0], pBase[right]));
+
+      if (left >= right)
+        break;
+
+      std::swap(pBase[left], pBase[right]);
+    }
+    std::swap(pBase[0], pBase[right]);
+
+    // recurse into the smaller side so the stack stays at log2(count)
+    size_t leftCount = right;
+    size_t rightCount = count - right - 1;
+    if (leftCount < rightCount)
+    {
+      IntroSort(pBase, leftCount, depthLimit, compare);
+      pBase += right + 1;
+      count = rightCount;
+    }
+    else
+    {
+      IntroSort(pBase + right + 1, rightCount, depthLimit, compare);
+      count = leftCount;
+    }
+  }
+
+  Y_insertion_sort(pBase, count, compare);
+}
+
+template<typename T, typename Compare>
+void SortDetail::MergeSort(T* pBase, size_t count, T* pBuffer, Compare& compare)
+{
+  if (count <= InsertionSortThreshold)
+  {
+    Y_insertion_sort(pBase, count, compare);
+    return;
+  }
+
+  size_t half = count / 2;
+  MergeSort(pBase, half, pBuffer, compare);
+  MergeSort(pBase + half, count - half, pBuffer, compare);
+  if (!compare(pBase[half], pBase[half - 1]))
+    return;
+
+  // left half moves out of the way, then the merge fills in from the front. ties take the left element.
+  for (size_t i = 0; i < half; i++)
+    new (&pBuffer[i]) T(std::move(pBase[i]));
+
+  size_t left = 0;
+  size_t right = half;
+  size_t output = 0;
+  while (left < half && right < count)
+  {
+    if (compare(pBase[right], pBuffer[left]))
+      pBase[output++] = std::move(pBase[right++]);
+    else
+      pBase[output++] = std::move(pBuffer[left++]);
+  }
+  while (left < half)
+    pBase[output++] = std::move(pBuffer[left++]);
+
+  for (size_t i = 0; i < half; i++)
+    pBuffer[i].~T();
+}
@@ -0,0 +1,270 @@
+#pragma once
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/NonCopyable.h"
+#include "YBaseLib/Thread.h"
+
+// Exponential backoff for spin-waits. Each Pause spins twice as long as the last, up to MaxSpins pause hints, so
+// threads contending for a cache line stop hammering it. Past that PauseOrYield gives the core up instead.
+class SpinBackoff
+{
+public:
+  static const uint32 MaxSpins = 64;
+
+  SpinBackoff() : m_spins(1) {}
+
+  // hints spun by the next Pause
+  uint32 GetSpins() const { return m_spins; }
+  bool IsSaturated() const { return (m_spins >= MaxSpins); }
+
+  void Pause()
+  {
+    for (uint32 i = 0; i < m_spins; i++)
+      Y_SpinWaitHint();
+
+    if (m_spins < MaxSpins)
+      m_spins *= 2;
+  }
+
+  void PauseOrYield()
+  {
+    if (IsSaturated())
+      Thread::Yield();
+    else
+      Pause();
+  }
+
+  void Reset() { m_spins = 1; }
+
+private:
+  uint32 m_spins;
+};
+
+// A lock that never sleeps, for critical sections of a few instructions. Waiters only read the word until it looks
+// free, then back off exponentially before yielding. The constructor's constexpr, so a static SpinLock is usable
+// before static constructors have run.
+class SpinLock
+{
+public:
+  constexpr SpinLock() : m_locked(0) {}
+
+  void Lock()
+  {
+    SpinBackoff backoff;
+    while (!TryLock())
+    {
+      do
+        backoff.PauseOrYield();
+      while (Y_AtomicLoad(m_locked, ATOMIC_MEMORY_ORDER_RELAXED) != 0);
+    }
+  }
+
+  bool TryLock() { return (Y_AtomicExchange(m_locked, int32(1), ATOMIC_MEMORY_ORDER_ACQUIRE) == 0); }
+
+  void Unlock() { Y_AtomicStore(m_locked, int32(0), ATOMIC_MEMORY_ORDER_RELEASE); }
+
+private:
+  int32 m_locked;
+
+  DeclareNonCopyable(SpinLock);
+};
+
+// A spin lock taken in the order it was asked for: each locker draws a ticket and waits for it to be served, so
+// none can be starved. Every waiter still watches the same word, see MCSLock for heavier contention.
+class TicketLock
+{
+public:
+  constexpr TicketLock() : m_nextTicket(0), m_nowServing(0) {}
+
+  void Lock()
+  {
+    uint32 ticket = Y_AtomicFetchAdd(m_nextTicket, uint32(1), ATOMIC_MEMORY_ORDER_RELAXED);
+    SpinBackoff backoff;
+    while (Y_AtomicLoad(m_nowServing, ATOMIC_MEMORY_ORDER_ACQUIRE) != ticket)
+      backoff.PauseOrYield();
+  }
+
+  // only takes a ticket if it'd be served straight away
+  bool TryLock()
+  {
+    uint32 ticket = Y_AtomicLoad(m_nowServing, ATOMIC_MEMORY_ORDER_RELAXED);
+    return Y_AtomicTryCompareExchange(m_nextTicket, ticket, ticket + 1, ATOMIC_MEMORY_ORDER_ACQUIRE);
+  }
+
+  // only the holder writes the count being served
+  void Unlock() { Y_AtomicStore(m_nowServing, m_nowServing + 1, ATOMIC_MEMORY_ORDER_RELEASE); }
+
+private:
+  uint32 m_nextTicket;
+  uint32 m_nowServing;
+
+  DeclareNonCopyable(TicketLock);
+};
+
+// A queue lock (Mellor-Crummey and Scott): each waiter spins on its own node, linked behind the one before, so a
+// release only touches the next waiter's cache line. Fair, and it scales where every waiter polling one word
+// doesn't. Each acquisition needs a node that stays put until it's released, MCSLockGuard keeps one on the stack.
+class MCSLock
+{
+public:
+  struct Node
+  {
+    Node* volatile pNext;
+    uint32 Waiting;
+  };
+
+  constexpr MCSLock() : m_pTail(nullptr) {}
+
+  void Lock(Node* pNode)
+  {
+    pNode->pNext = nullptr;
+    pNode->Waiting = 1;
+
+    Node* pPrevious = Y_AtomicExchangePointer(m_pTail, pNode);
+    if (pPrevious == nullptr)
+      return;
+
+    // the holder hands over by clearing our flag
+    Y_AtomicStoreRelease(pPrevious->pNext, pNode);
+    SpinBackoff backoff;
+    while (Y_AtomicLoad(pNode->Waiting, ATOMIC_MEMORY_ORDER_ACQUIRE) != 0)
+      backoff.PauseOrYield();
+  }
+
+  bool TryLock(Node* pNode)
+  {
+    pNode->pNext = nullptr;
+    pNode->Waiting = 1;
+    return (Y_AtomicCompareExchangePointer(m_pTail, pNode, static_cast<Node*>(nullptr)) == nullptr);
+  }
+
+  void Unlock(Node* pNode)
+  {
+    Node* pNext = Y_AtomicLoadAcquire(pNode->pNext);
+    if (pNext == nullptr)
+    {
+      if (Y_AtomicCompareExchangePointer(m_pTail, static_cast<Node*>(nullptr), pNode) == pNode)
+        return;
+
+      // a waiter has queued behind us but not linked itself in yet
+      SpinBackoff backoff;
+      while ((pNext = Y_AtomicLoadAcquire(pNode->pNext)) == nullptr)
+        backoff.PauseOrYield();
+    }
+
+    Y_AtomicStore(pNext->Waiting, uint32(0), ATOMIC_MEMORY_ORDER_RELEASE);
+  }
+
+private:
+  Node* m_pTail;
+
+  DeclareNonCopyable(MCSLock);
+};
+
+// MutexLock for any lock with Lock, TryLock and Unlock, such as SpinLock, TicketLock or an adaptive Mutex. It takes
+// the lock as it's constructed, unless told otherwise, which leaves it to Lock or TryLock.
+template<class T>
+class ScopedLock
+{
+  DeclareNonCopyable(ScopedLock);
+
+public:
+  ScopedLock(T& lock, bool acquire = true) : m_lock(lock), m_locked(false)
+  {
+    if (acquire)
+      Lock();
+  }
+
+  ~ScopedLock()
+  {
+    if (m_locked)
+      m_lock.Unlock();
+  }
+
+  void Lock()
+  {
+    if (m_locked)
+      return;
+
+    m_lock.Lock();
+    m_locked = true;
+  }
+
+  bool TryLock()
+  {
+    if (m_locked)
+      return true;
+
+    if (m_lock.TryLock())
+    {
+      m_locked = true;
+      return true;
+    }
+
+    return false;
+  }
+
+  void Unlock()
+  {
+    if (!m_locked)
+      return;
+
+    m_lock.Unlock();
+    m_locked = false;
+  }
+
+private:
+  T& m_lock;
+  bool m_locked;
+};
+
+// MutexLock for an MCSLock, with the queue node it locks with
+class MCSLockGuard
+{
+  DeclareNonCopyable(MCSLockGuard);
+
+public:
+  MCSLockGuard(MCSLock& lock, bool acquire = true) : m_lock(lock), m_locked(false)
+  {
+    if (acquire)
+      Lock();
+  }
+
+  ~MCSLockGuard()
+  {
+    if (m_locked)
+      m_lock.Unlock(&m_node);
+  }
+
+  void Lock()
+  {
+    if (m_locked)
+      return;
+
+    m_lock.Lock(&m_node);
+    m_locked = true;
+  }
+
+  bool TryLock()
+  {
+    if (m_locked)
+      return true;
+
+    m_locked = m_lock.TryLock(&m_node);
+    return m_locked;
+  }
+
+  void Unlock()
+  {
+    if (!m_locked)
+      return;
+
+    m_lock.Unlock(&m_node);
+    m_locked = false;
+  }
+
+private:
+  MCSLock& m_lock;
+  MCSLock::Node m_node;
+  bool m_locked;
+};
@@ -3,12 +3,16 @@
 #include "YBaseLib/CString.h"
 #include "YBaseLib/Common.h"
 #include "YBaseLib/Memory.h"
+#include "YBaseLib/RelocationTrait.h"
+#include "YBaseLib/StringView.h"
+#include "YBaseLib/TypedFormat.h"
 
 //
 // String
 // Implements a UTF-8 string container with copy-on-write behavior.
-// The data class is not currently threadsafe (creating a mutex on each container would be overkill),
-// so locking is still required when multiple threads are involved.
+// The shared data is reference counted atomically, so copies of a string can be handed to other threads (captured
+// by a task, queued for a log sink) without copying the characters, and each thread can modify its copy. A single
+// String object is still not threadsafe, it must not be modified while another thread is reading or copying it.
 //
 class String
 {
@@ -28,10 +32,16 @@ public:
     // Whether the memory pointed to by pBuffer is writable.
     bool ReadOnly;
 
-    // Reference count of this data object. If set to -1,
+    // Whether Hash is filled in. Only sharable data caches its hash, so every copy of a string shares it.
+    volatile bool HashValid;
+
+    // Reference count of this data object, only changed atomically. If set to -1,
     // it is considered noncopyable and any copies of the string
     // will always create their own copy.
     ALIGN_DECL(4) volatile int32 ReferenceCount;
+
+    // HashTrait<String>'s hash of the text, computed on first use and cleared by anything that writes to the buffer.
+    ALIGN_DECL(4) volatile uint32 Hash;
   };
 
 public:
@@ -43,15 +53,24 @@ public:
   // For strings that do not allocate any space on the heap, see StaticString.
   String(const char* Text);
 
+  // Creates a string containing a copy of the characters in a view.
+  explicit String(const StringView& view);
+
   // Creates a string using the same buffer as another string (copy-on-write).
   String(const String& copyString);
 
+  // Takes over the buffer of another string, which is left empty. Buffers that can't be shared, like that of a
+  // StackString, are copied instead.
+  String(String&& moveString);
+
   // Destructor. Child classes may not have any destructors, as this is not virtual.
   ~String();
 
   // manual assignment
   void Assign(const String& copyString);
+  void Assign(String&& moveString);
   void Assign(const char* copyText);
+  void Assign(const StringView& copyView);
 
   // assignment but ensures that we have our own copy.
   void AssignCopy(const String& copyString);
@@ -78,6 +97,7 @@ public:
   void AppendString(const String& appendStr);
   void AppendString(const char* appendText);
   void AppendString(const char* appendString, uint32 Count);
+  void AppendString(const StringView& appendView);
 
   // append a substring of the specified string to this string
   void AppendSubString(const String& appendStr, int32 Offset = 0, int32 Count = INT_MAX);
@@ -87,6 +107,14 @@ public:
   void AppendFormattedString(const char* FormatString, ...);
   void AppendFormattedStringVA(const char* FormatString, va_list ArgPtr);
 
+  // append type-safe formatted string to this string, see TypedFormat.h
+  template<typename... Args>
+  void AppendFormat(const StringView& format, const Args&... args)
+  {
+    const TypedFormat::Argument arguments[] = {TypedFormat::MakeArgument(args)..., TypedFormat::Argument()};
+    TypedFormat::AppendFormatted(*this, format, arguments, sizeof...(Args));
+  }
+
   // append a single character to this string
   void PrependCharacter(char c);
 
@@ -94,6 +122,7 @@ public:
   void PrependString(const String& appendStr);
   void PrependString(const char* appendText);
   void PrependString(const char* appendString, uint32 Count);
+  void PrependString(const StringView& appendView);
 
   // append a substring of the specified string to this string
   void PrependSubString(const String& appendStr, int32 Offset = 0, int32 Count = INT_MAX);
@@ -107,32 +136,47 @@ public:
   void InsertString(int32 offset, const String& appendStr);
   void InsertString(int32 offset, const char* appendStr);
   void InsertString(int32 offset, const char* appendStr, uint32 appendStrLength);
+  void InsertString(int32 offset, const StringView& appendView);
 
   // set to formatted string
   void Format(const char* FormatString, ...);
   void FormatVA(const char* FormatString, va_list ArgPtr);
 
+  // set to type-safe formatted string
+  template<typename... Args>
+  void AssignFormat(const StringView& format, const Args&... args)
+  {
+    Clear();
+    AppendFormat(format, args...);
+  }
+
   // compare one string to another
   bool Compare(const String& otherString) const;
   bool Compare(const char* otherText) const;
+  bool Compare(const StringView& otherView) const;
   bool SubCompare(const String& otherString, uint32 Length) const;
   bool SubCompare(const char* otherText, uint32 Length) const;
   bool CompareInsensitive(const String& otherString) const;
   bool CompareInsensitive(const char* otherText) const;
+  bool CompareInsensitive(const StringView& otherView) const;
   bool SubCompareInsensitive(const String& otherString, uint32 Length) const;
   bool SubCompareInsensitive(const char* otherText, uint32 Length) const;
 
   // numerical compares
   int NumericCompare(const String& otherString) const;
   int NumericCompare(const char* otherText) const;
+  int NumericCompare(const StringView& otherView) const;
   int NumericCompareInsensitive(const String& otherString) const;
   int NumericCompareInsensitive(const char* otherText) const;
+  int NumericCompareInsensitive(const StringView& otherView) const;
 
   // starts with / ends with
   bool StartsWith(const char* compareString, bool caseSensitive = true) const;
   bool StartsWith(const String& compareString, bool caseSensitive = true) const;
+  bool StartsWith(const StringView& compareView, bool caseSensitive = true) const;
   bool EndsWith(const char* compareString, bool caseSensitive = true) const;
   bool EndsWith(const String& compareString, bool caseSensitive = true) const;
+  bool EndsWith(const StringView& compareView, bool caseSensitive = true) const;
 
   // searches for a character inside a string
   // rfind is the same except it starts at the end instead of the start
@@ -143,7 +187,7 @@ public:
   // searches for a string inside a string
   // rfind is the same except it starts at the end instead of the start
   // returns -1 if it is not found, otherwise the offset in the string
-  int32 Find(const char* str, uint32 Offset = 0) const;
+  int32 Find(const StringView& str, uint32 Offset = 0) const;
 
   // alters the length of the string to be at least len bytes long
   void Reserve(uint32 newReserve, bool Force = false);
@@ -172,6 +216,12 @@ public:
   // creates a new string using part of this string
   String SubString(int32 Offset, int32 Count = INT_MAX) const;
 
+  // view of part of this string, without copying it. offset and count are clamped to the string.
+  StringView SubView(uint32 Offset, uint32 Count = StringView::NoPosition) const
+  {
+    return StringView(*this).SubView(Offset, Count);
+  }
+
   // erase count characters at offset from this string. if count is less than zero, everything past offset is erased
   void Erase(int32 Offset, int32 Count = INT_MAX);
 
@@ -197,13 +247,18 @@ public:
   // gets a constant pointer to the string
   const char* GetCharArray() const { return m_pStringData->pBuffer; }
 
-  // gets a writable char array, do not write more than reserve characters to it.
+  // gets a writable char array, do not write more than reserve characters to it. call UpdateSize after writing,
+  // which also drops the cached hash.
   char* GetWriteableCharArray()
   {
     EnsureOwnWritableCopy();
     return m_pStringData->pBuffer;
   }
 
+  // HashTrait<String>'s hash of the text. Heap strings compute it once and share it with their copies, so a key
+  // that's looked up over and over, like a resource or channel name, is only hashed the first time.
+  uint32 GetHash() const;
+
   // creates a new string from the specified format
   static String FromFormat(const char* FormatString, ...);
 
@@ -221,6 +276,13 @@ public:
     return *this;
   }
 
+  // Takes the string data, if it can be shared.
+  String& operator=(String&& moveString)
+  {
+    Assign(std::move(moveString));
+    return *this;
+  }
+
   // Allocates own buffer and copies text.
   String& operator=(const char* Text)
   {
@@ -228,11 +290,20 @@ public:
     return *this;
   }
 
+  // Allocates own buffer and copies the viewed characters.
+  String& operator=(const StringView& view)
+  {
+    Assign(view);
+    return *this;
+  }
+
   // comparative operators
   bool operator==(const String& compString) const { return Compare(compString); }
   bool operator==(const char* compString) const { return Compare(compString); }
   bool operator!=(const String& compString) const { return !Compare(compString); }
   bool operator!=(const char* compString) const { return !Compare(compString); }
+  bool operator==(const StringView& compView) const { return Compare(compView); }
+  bool operator!=(const StringView& compView) const { return !Compare(compView); }
   bool operator<(const String& compString) const { return (NumericCompare(compString) < 0); }
   bool operator<(const char* compString) const { return (NumericCompare(compString) < 0); }
   bool operator>(const String& compString) const { return (NumericCompare(compString) > 0); }
@@ -254,6 +325,20 @@ protected:
   static const StringData s_EmptyStringData;
 };
 
+inline StringView::StringView(const String& str) : m_pData(str.GetCharArray()), m_length(str.GetLength()) {}
+
+// strings and everything derived from them format as their text
+namespace TypedFormat {
+template<typename T>
+struct ArgumentTraits<T, typename std::enable_if<std::is_base_of<String, T>::value>::type>
+{
+  static Argument Make(const String& value) { return MakeStringArgument(value.GetCharArray(), value.GetLength()); }
+};
+} // namespace TypedFormat
+
+// only the data pointer moves, so arrays of strings can be reallocated in place
+DECLARE_TRIVIALLY_RELOCATABLE(String);
+
 // static string, stored in .rodata
 class StaticString : public String
 {
@@ -264,6 +349,7 @@ public:
     m_sStringData.StringLength = Y_strlen(Text);
     m_sStringData.BufferSize = m_sStringData.StringLength + 1;
     m_sStringData.ReadOnly = true;
+    m_sStringData.HashValid = false;
     m_sStringData.ReferenceCount = -1;
   }
 
@@ -298,6 +384,19 @@ public:
     Assign(copyString.GetCharArray());
   }
 
+  // heap buffers are taken over, text in another stack buffer is copied into this one
+  StackString(String&& moveString) : String(&m_sStringData)
+  {
+    InitStackStringData();
+    Assign(std::move(moveString));
+  }
+
+  StackString(StackString&& moveString) : String(&m_sStringData)
+  {
+    InitStackStringData();
+    Assign(std::move(moveString));
+  }
+
   // Override the fromstring method
   static StackString FromFormat(const char* FormatString, ...)
   {
@@ -323,6 +422,16 @@ public:
     Assign(copyString.GetCharArray());
     return *this;
   }
+  StackString& operator=(StackString&& moveString)
+  {
+    Assign(std::move(moveString));
+    return *this;
+  }
+  StackString& operator=(String&& moveString)
+  {
+    Assign(std::move(moveString));
+    return *this;
+  }
 
   // Allocates own buffer and copies text.
   StackString& operator=(const char* Text)
@@ -330,6 +439,11 @@ public:
     Assign(Text);
     return *this;
   }
+  StackString& operator=(const StringView& view)
+  {
+    Assign(view);
+    return *this;
+  }
 
 private:
   StringData m_sStringData;
@@ -341,6 +455,7 @@ private:
     m_sStringData.StringLength = 0;
     m_sStringData.BufferSize = countof(m_strStackBuffer);
     m_sStringData.ReadOnly = false;
+    m_sStringData.HashValid = false;
     m_sStringData.ReferenceCount = -1;
 
 #if Y_BUILD_CONFIG_DEBUG
@@ -351,6 +466,48 @@ private:
   }
 };
 
+class MemoryArena;
+
+// string with its buffer allocated from a MemoryArena, for scratch strings built while parsing. like StackString,
+// growing past the buffer moves it to the heap, and copies into other strings always make their own copy.
+// the arena has to outlive the string, and must not be rewound past it while it's alive.
+class ArenaString : public String
+{
+public:
+  ArenaString(MemoryArena& arena, uint32 bufferSize = 256);
+  ArenaString(MemoryArena& arena, const char* Text);
+  ArenaString(const ArenaString& copyString);
+
+  MemoryArena& GetArena() const { return *m_pArena; }
+
+  ArenaString& operator=(const ArenaString& copyString)
+  {
+    Assign(copyString.GetCharArray());
+    return *this;
+  }
+  ArenaString& operator=(const String& copyString)
+  {
+    Assign(copyString.GetCharArray());
+    return *this;
+  }
+  ArenaString& operator=(const char* Text)
+  {
+    Assign(Text);
+    return *this;
+  }
+  ArenaString& operator=(const StringView& view)
+  {
+    Assign(view);
+    return *this;
+  }
+
+private:
+  void InitArenaStringData(uint32 bufferSize);
+
+  MemoryArena* m_pArena;
+  StringData m_sStringData;
+};
+
 // stack string types
 typedef StackString<64> TinyString;
 typedef StackString<256> SmallString;
@@ -0,0 +1,133 @@
+#pragma once
+#include "YBaseLib/Allocator.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/StringView.h"
+#include "YBaseLib/TypedFormat.h"
+#include <cstdarg>
+
+class ByteStream;
+
+// Builder for large amounts of text, like serialized documents and reports. Text is appended into a chain of
+// chunks that never move, so appending never copies what is already there, unlike growing a String. Chunks double
+// in size up to MaxChunkSize, and come from a MemoryArena, either the builder's own or one that is passed in.
+// The text is never contiguous, it is written out chunk by chunk to a stream or a socket, or copied to a String.
+//   StringBuilder builder;
+//   for (const Item& item : items)
+//     builder.AppendFormat("<item id=\"{}\">{}</item>\n", item.Id, item.Name);
+//   builder.WriteToStream(pStream);
+class StringBuilder
+{
+  struct Chunk;
+
+public:
+  static const uint32 MaxChunkSize = 262144;
+
+  // chunks from a private arena, freed with the builder
+  StringBuilder(uint32 firstChunkSize = 4096);
+
+  // chunks from the given arena, which has to outlive the builder and not be rewound past its chunks.
+  // chunks stay allocated in the arena after the builder is destroyed.
+  StringBuilder(MemoryArena& arena, uint32 firstChunkSize = 4096);
+
+  ~StringBuilder();
+
+  uint64 GetLength() const { return m_length; }
+  bool IsEmpty() const { return (m_length == 0); }
+
+  // number of chunks holding text
+  uint32 GetChunkCount() const;
+
+  void AppendCharacter(char c)
+  {
+    if (m_pCurrentChunk == NULL || m_pCurrentChunk->Used == m_pCurrentChunk->Size)
+      NextChunk();
+
+    GetChunkData(m_pCurrentChunk)[m_pCurrentChunk->Used++] = c;
+    m_length++;
+  }
+
+  void AppendString(const char* appendText);
+  void AppendString(const char* appendString, uint32 Count);
+  void AppendString(const StringView& appendView) { AppendString(appendView.GetData(), appendView.GetLength()); }
+  void AppendString(const String& appendStr) { AppendString(appendStr.GetCharArray(), appendStr.GetLength()); }
+
+  // printf-style and type-safe formatting, see TypedFormat.h. each piece is formatted on the stack first.
+  void AppendFormattedString(const char* FormatString, ...);
+  void AppendFormattedStringVA(const char* FormatString, va_list ArgPtr);
+
+  template<typename... Args>
+  void AppendFormat(const StringView& format, const Args&... args)
+  {
+    const TypedFormat::Argument arguments[] = {TypedFormat::MakeArgument(args)..., TypedFormat::Argument()};
+    AppendFormatted(format, arguments, sizeof...(Args));
+  }
+
+  // empties the builder, the chunks are kept and filled again
+  void Clear();
+
+  // copies the whole text into a string, for when it has to be contiguous after all
+  void CopyTo(String& destination) const;
+
+  // writes the chunks to the stream in order, returns false if the stream fails
+  bool WriteToStream(ByteStream* pStream) const;
+
+  // fills in the data and length of up to maxBuffers chunks, starting at chunk firstChunk, in the form
+  // WriteVector takes. returns the number of chunks filled in, zero past the end.
+  uint32 GetBuffers(uint32 firstChunk, const void** ppBuffers, size_t* pBufferLengths, uint32 maxBuffers) const;
+
+  // sends the text with as few WriteVector calls as possible, for StreamSocket and BufferedStreamSocket.
+  // returns the number of bytes the socket took, which is less than the length if it stopped taking data.
+  template<typename SocketType>
+  uint64 WriteVector(SocketType* pSocket) const
+  {
+    static const uint32 BatchSize = 64;
+    const void* pBuffers[BatchSize];
+    size_t bufferLengths[BatchSize];
+    uint64 bytesWritten = 0;
+    uint32 chunkIndex = 0;
+    uint32 count;
+    while ((count = GetBuffers(chunkIndex, pBuffers, bufferLengths, BatchSize)) > 0)
+    {
+      size_t batchLength = 0;
+      for (uint32 i = 0; i < count; i++)
+        batchLength += bufferLengths[i];
+
+      size_t sent = pSocket->WriteVector(pBuffers, bufferLengths, count);
+      bytesWritten += sent;
+      if (sent != batchLength)
+        break;
+
+      chunkIndex += count;
+    }
+
+    return bytesWritten;
+  }
+
+private:
+  struct Chunk
+  {
+    Chunk* pNext;
+    uint32 Size;
+    uint32 Used;
+  };
+
+  static char* GetChunkData(Chunk* pChunk) { return reinterpret_cast<char*>(pChunk + 1); }
+  static const char* GetChunkData(const Chunk* pChunk) { return reinterpret_cast<const char*>(pChunk + 1); }
+
+  // moves on to the next empty chunk, allocating it if there isn't one
+  void NextChunk();
+
+  void AppendFormatted(const StringView& format, const TypedFormat::Argument* pArguments, uint32 argumentCount);
+
+  MemoryArena m_ownArena;
+  MemoryArena* m_pArena;
+
+  // chunks after the current one are empty, left over from before a Clear
+  Chunk* m_pFirstChunk;
+  Chunk* m_pCurrentChunk;
+  uint32 m_nextChunkSize;
+  uint64 m_length;
+
+  DeclareNonCopyable(StringBuilder);
+};
@@ -1,27 +1,38 @@
 #pragma once
 #include "YBaseLib/Common.h"
 #include "YBaseLib/String.h"
+#include "YBaseLib/StringView.h"
 
 class String;
 class ByteStream;
 
 namespace StringConverter {
-bool StringToBool(const char* Source);
-byte StringToByte(const char* Source);
-int8 StringToInt8(const char* Source);
-int16 StringToInt16(const char* Source);
-int32 StringToInt32(const char* Source);
-int64 StringToInt64(const char* Source);
-uint8 StringToUInt8(const char* Source);
-uint16 StringToUInt16(const char* Source);
-uint32 StringToUInt32(const char* Source);
-uint64 StringToUInt64(const char* Source);
-float StringToFloat(const char* Source);
-double StringToDouble(const char* Source);
-uint32 StringToColor(const char* Source);
-uint32 HexStringToBytes(void* pDestination, uint32 cbDestination, const char* Source);
+// sources are views, so numbers can be parsed straight out of a larger buffer
+bool StringToBool(const StringView& Source);
+byte StringToByte(const StringView& Source);
+int8 StringToInt8(const StringView& Source);
+int16 StringToInt16(const StringView& Source);
+int32 StringToInt32(const StringView& Source);
+int64 StringToInt64(const StringView& Source);
+uint8 StringToUInt8(const StringView& Source);
+uint16 StringToUInt16(const StringView& Source);
+uint32 StringToUInt32(const StringView& Source);
+uint64 StringToUInt64(const StringView& Source);
+float StringToFloat(const StringView& Source);
+double StringToDouble(const StringView& Source);
+uint32 StringToColor(const StringView& Source);
+
+// Stops at the first character that isn't a hex digit, or once the destination is full, returning the bytes written.
+uint32 HexStringToBytes(void* pDestination, uint32 cbDestination, const StringView& Source);
+
+// Reads numbers separated by commas or whitespace, as StringParser's arrays do, stopping at the first field that isn't
+// a number or once the destination is full, and returns how many were read.
+uint32 StringToInt32Array(int32* pDestination, uint32 maxCount, const StringView& Source);
+uint32 StringToFloatArray(float* pDestination, uint32 maxCount, const StringView& Source);
+
 void StringToStream(ByteStream* pStream, const String& Source);
 void StringToStream(ByteStream* pStream, const char* Source, uint32 Length);
+void StringToStream(ByteStream* pStream, const StringView& Source);
 
 void BoolToString(String& Destination, const bool Value);
 void Int8ToString(String& Destination, const int8 Value);
@@ -36,6 +47,11 @@ void FloatToString(String& Destination, const float Value);
 void DoubleToString(String& Destination, const double Value);
 void ColorToString(String& Destination, const uint32 Value);
 void BytesToHexString(String& Destination, const void* pData, uint32 cbData);
+
+// Formats the values straight into the destination's buffer, joined by the separator, replacing what was there.
+void Int32ArrayToString(String& Destination, const int32* pValues, uint32 count, const char* separator = " ");
+void FloatArrayToString(String& Destination, const float* pValues, uint32 count, const char* separator = " ");
+
 bool StreamToString(String& Destination, ByteStream* pStream);
 bool AppendStreamToString(String& Destination, ByteStream* pStream);
 void SizeToHumanReadableString(String& Destination, uint64 nBytes);
@@ -1,8 +1,95 @@
 #pragma once
 #include "YBaseLib/Common.h"
+#include "YBaseLib/NumberConversion.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/StringView.h"
 
 class String;
 
+// Splits text into fields on any of a set of delimiter characters, one field per call to Next, without copying.
+// Fields are views of the original text, which has to outlive them.
+//   StringTokenizer tokenizer(line, ",;", StringTokenizer::FLAG_TRIM_WHITESPACE | StringTokenizer::FLAG_QUOTED_FIELDS);
+//   for (const StringView& field : tokenizer)
+//     ...
+// Every delimiter ends a field, so "a,,b," is four fields, the last two empty, unless FLAG_SKIP_EMPTY is set.
+// Empty text has no fields.
+class StringTokenizer
+{
+public:
+  enum FLAGS
+  {
+    // strip spaces, tabs and line breaks from both ends of each field, unless they are delimiters
+    FLAG_TRIM_WHITESPACE = (1 << 0),
+
+    // leave out empty fields, so runs of delimiters count as one. quoted empty fields are kept.
+    FLAG_SKIP_EMPTY = (1 << 1),
+
+    // a field starting with a double quote runs to the closing quote, delimiters included. the field is the text
+    // inside the quotes, with doubled quotes left as they are, see UnescapeQuotes. anything between the closing
+    // quote and the next delimiter is dropped.
+    FLAG_QUOTED_FIELDS = (1 << 2),
+  };
+
+  StringTokenizer(const StringView& text, const char* delimiters = ",", uint32 flags = 0);
+
+  // moves on to the next field, returns false once there are none left
+  bool Next(StringView* pToken);
+
+  // whether the last field returned was quoted in the text
+  bool WasQuoted() const { return m_lastWasQuoted; }
+
+  // text that hasn't been split up yet
+  StringView GetRemaining() const { return StringView(m_pPosition, m_pEnd); }
+  bool IsAtEnd() const { return m_atEnd; }
+
+  // copies a quoted field to a string, turning doubled quotes back into single ones
+  static void UnescapeQuotes(const StringView& field, String& destination);
+
+  // forward iteration over the fields, which uses up the tokenizer
+  class Iterator
+  {
+  public:
+    Iterator(StringTokenizer* pTokenizer) : m_pTokenizer(pTokenizer)
+    {
+      if (m_pTokenizer != NULL && !m_pTokenizer->Next(&m_token))
+        m_pTokenizer = NULL;
+    }
+
+    const StringView& operator*() const { return m_token; }
+    const StringView* operator->() const { return &m_token; }
+    Iterator& operator++()
+    {
+      if (!m_pTokenizer->Next(&m_token))
+        m_pTokenizer = NULL;
+      return *this;
+    }
+
+    bool operator==(const Iterator& other) const { return (m_pTokenizer == other.m_pTokenizer); }
+    bool operator!=(const Iterator& other) const { return (m_pTokenizer != other.m_pTokenizer); }
+
+  private:
+    StringTokenizer* m_pTokenizer;
+    StringView m_token;
+  };
+
+  Iterator begin() { return Iterator(this); }
+  Iterator end() { return Iterator(NULL); }
+
+private:
+  bool IsDelimiter(char ch) const { return ((m_delimiterMask[byte(ch) >> 5] >> (byte(ch) & 31)) & 1) != 0; }
+  bool IsTrimmable(char ch) const;
+
+  // reads one field, which may be empty
+  StringView ReadField();
+
+  const char* m_pPosition;
+  const char* m_pEnd;
+  uint32 m_delimiterMask[8];
+  uint32 m_flags;
+  bool m_atEnd;
+  bool m_lastWasQuoted;
+};
+
 // this class can be casted from a string or array of strings to provide conversion
 class StringParser
 {
@@ -22,6 +109,53 @@ public:
   uint32 ParseUInt32() const;
   uint64 ParseUInt64() const;
 
+  // Parses a list of numbers straight into an array, appending to it. Fields are trimmed and empty ones skipped,
+  // so "1, 2,3" and "1 2  3" with " " as the delimiter both work. Returns false at the first field that isn't
+  // entirely a number, the values before it are left in the array.
+  template<class AllocatorType>
+  static bool ParseInt32Array(const StringView& text, PODArray<int32, AllocatorType>* pValues,
+                              const char* delimiters = ", \t")
+  {
+    return ParseArray(text, pValues, delimiters, &NumberConversion::ParseInt32);
+  }
+  template<class AllocatorType>
+  static bool ParseUInt32Array(const StringView& text, PODArray<uint32, AllocatorType>* pValues,
+                               const char* delimiters = ", \t")
+  {
+    return ParseArray(text, pValues, delimiters, &NumberConversion::ParseUInt32);
+  }
+  template<class AllocatorType>
+  static bool ParseFloatArray(const StringView& text, PODArray<float, AllocatorType>* pValues,
+                              const char* delimiters = ", \t")
+  {
+    return ParseArray(text, pValues, delimiters, &NumberConversion::ParseFloat);
+  }
+  template<class AllocatorType>
+  static bool ParseDoubleArray(const StringView& text, PODArray<double, AllocatorType>* pValues,
+                               const char* delimiters = ", \t")
+  {
+    return ParseArray(text, pValues, delimiters, &NumberConversion::ParseDouble);
+  }
+
 private:
+  template<typename T, class AllocatorType>
+  static bool ParseArray(const StringView& text, PODArray<T, AllocatorType>* pValues, const char* delimiters,
+                         uint32 (*parseFunction)(const StringView&, T*))
+  {
+    StringTokenizer tokenizer(text, delimiters,
+                              StringTokenizer::FLAG_TRIM_WHITESPACE | StringTokenizer::FLAG_SKIP_EMPTY);
+    StringView field;
+    while (tokenizer.Next(&field))
+    {
+      T value;
+      if (parseFunction(field, &value) != field.GetLength())
+        return false;
+
+      pValues->Add(value);
+    }
+
+    return true;
+  }
+
   const char* m_szValue;
 };
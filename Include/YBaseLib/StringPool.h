@@ -0,0 +1,122 @@
+#pragma once
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/DistributedReadWriteLock.h"
+#include "YBaseLib/HashTrait.h"
+#include "YBaseLib/PODArray.h"
+
+// Interning pool for strings that are repeated many times, like names read from config and XML files.
+// Each distinct string is stored once in arena blocks and given a 32-bit id, ids start at 1 and zero is the empty
+// string. Ids and the string pointers stay valid until the pool is destroyed, nothing is ever removed.
+// Interning takes a lock, resolving an id to its string does not, so ids can be shared between threads freely.
+class StringPool
+{
+public:
+  StringPool();
+  ~StringPool();
+
+  // pool shared by the whole process, StringAtom resolves against this one
+  static StringPool& GetGlobalPool();
+
+  // returns the id of the string, adding it if this is the first time it's been seen
+  uint32 Intern(const char* str, uint32 length);
+  uint32 Intern(const char* str);
+
+  // returns the id of the string if it has been interned, otherwise zero
+  uint32 Find(const char* str, uint32 length) const;
+  uint32 Find(const char* str) const;
+
+  // id accessors, the hash is HashTrait<String>'s hash of the text
+  const char* GetString(uint32 id) const { return GetEntry(id).String; }
+  uint32 GetLength(uint32 id) const { return GetEntry(id).Length; }
+  HashType GetHash(uint32 id) const { return GetEntry(id).Hash; }
+
+  // number of distinct strings, not counting the empty string
+  uint32 GetCount() const { return m_count; }
+
+  // bytes allocated for string storage and bookkeeping
+  size_t GetMemoryUsage() const;
+
+private:
+  struct Entry
+  {
+    const char* String;
+    uint32 Length;
+    HashType Hash;
+  };
+
+  // entries live in chunks that double in size, so they never move and can be read without the lock.
+  // chunk n holds ids [FirstChunkSize * (2^n - 1) + 1, FirstChunkSize * (2^(n+1) - 1)].
+  static const uint32 FirstChunkBits = 10;
+  static const uint32 ChunkCount = 32 - FirstChunkBits;
+
+  // string storage block size, longer strings get a block to themselves
+  static const uint32 ArenaBlockSize = 65536;
+
+  const Entry& GetEntry(uint32 id) const;
+  Entry& AllocateEntry(uint32 id);
+
+  const char* StoreString(const char* str, uint32 length);
+
+  // index from string to id, open addressing over ids with zero meaning empty
+  uint32 FindLocked(const char* str, uint32 length, HashType hash) const;
+  void InsertIndex(uint32 id, HashType hash);
+  void GrowIndex();
+
+  Entry m_emptyEntry;
+  Entry* m_pChunks[ChunkCount];
+  Y_ATOMIC_DECL uint32 m_count;
+
+  uint32* m_pIndex;
+  uint32 m_indexSize;
+
+  char* m_pArenaPosition;
+  uint32 m_arenaRemaining;
+  PODArray<char*> m_arenaBlocks;
+  size_t m_arenaBytes;
+
+  // lookups vastly outnumber new strings, so readers mustn't contend
+  mutable DistributedReadWriteLock m_lock;
+
+  DeclareNonCopyable(StringPool);
+};
+
+// Interned string in the global pool, compares and hashes as a single integer.
+class StringAtom
+{
+public:
+  StringAtom() : m_id(0) {}
+  explicit StringAtom(const char* str) : m_id(StringPool::GetGlobalPool().Intern(str)) {}
+  StringAtom(const char* str, uint32 length) : m_id(StringPool::GetGlobalPool().Intern(str, length)) {}
+
+  // wraps an id returned by the global pool
+  static StringAtom FromID(uint32 id)
+  {
+    StringAtom atom;
+    atom.m_id = id;
+    return atom;
+  }
+
+  // returns the atom for the string if it has been interned, otherwise the empty atom
+  static StringAtom Find(const char* str) { return FromID(StringPool::GetGlobalPool().Find(str)); }
+
+  uint32 GetID() const { return m_id; }
+  bool IsEmpty() const { return (m_id == 0); }
+
+  const char* GetString() const { return StringPool::GetGlobalPool().GetString(m_id); }
+  uint32 GetLength() const { return StringPool::GetGlobalPool().GetLength(m_id); }
+
+  bool operator==(const StringAtom& rhs) const { return (m_id == rhs.m_id); }
+  bool operator!=(const StringAtom& rhs) const { return (m_id != rhs.m_id); }
+  bool operator<(const StringAtom& rhs) const { return (m_id < rhs.m_id); }
+
+private:
+  uint32 m_id;
+};
+
+// lets atoms key a HashTable directly
+template<>
+struct HashTrait<StringAtom>
+{
+  static HashType GetHash(const StringAtom& Value) { return Y_HashInteger(Value.GetID()); }
+};
@@ -0,0 +1,168 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Common.h"
+
+class String;
+
+//
+// StringView
+// Non-owning reference to a run of characters, a pointer and a length. Views are cheap to copy and slicing one
+// never copies or measures the string, so tokens can be cut out of a buffer and compared, searched, hashed or
+// parsed in place. A view is not null-terminated in general, pass GetLength() along with GetData().
+// The characters must outlive the view, a view of a String is invalidated by anything that modifies the string.
+//
+class StringView
+{
+public:
+  static const uint32 NoPosition = 0xFFFFFFFF;
+
+  StringView() : m_pData(""), m_length(0) {}
+  StringView(const char* text) : m_pData(text), m_length(Y_strlen(text)) {}
+  StringView(const char* text, uint32 length) : m_pData(text), m_length(length) {}
+  StringView(const char* pStart, const char* pEnd) : m_pData(pStart), m_length(uint32(pEnd - pStart)) {}
+
+  // defined in String.h
+  StringView(const String& str);
+
+  const char* GetData() const { return m_pData; }
+  const char* GetEnd() const { return m_pData + m_length; }
+  uint32 GetLength() const { return m_length; }
+  bool IsEmpty() const { return (m_length == 0); }
+
+  // part of the view, offset and count are clamped to it
+  StringView SubView(uint32 offset, uint32 count = NoPosition) const
+  {
+    offset = Min(offset, m_length);
+    return StringView(m_pData + offset, Min(count, m_length - offset));
+  }
+
+  // drop characters from either end of the view
+  void RemovePrefix(uint32 count)
+  {
+    DebugAssert(count <= m_length);
+    m_pData += count;
+    m_length -= count;
+  }
+  void RemoveSuffix(uint32 count)
+  {
+    DebugAssert(count <= m_length);
+    m_length -= count;
+  }
+
+  // compare one view to another
+  bool Compare(const StringView& other) const
+  {
+    return (m_length == other.m_length && Y_strcmp(m_pData, m_length, other.m_pData, other.m_length) == 0);
+  }
+  bool CompareInsensitive(const StringView& other) const
+  {
+    return (m_length == other.m_length && Y_stricmp(m_pData, m_length, other.m_pData, other.m_length) == 0);
+  }
+
+  // numerical compares, ordered like Y_strcmp
+  int NumericCompare(const StringView& other) const
+  {
+    return Y_strcmp(m_pData, m_length, other.m_pData, other.m_length);
+  }
+  int NumericCompareInsensitive(const StringView& other) const
+  {
+    return Y_stricmp(m_pData, m_length, other.m_pData, other.m_length);
+  }
+
+  // starts with / ends with
+  bool StartsWith(const StringView& other, bool caseSensitive = true) const
+  {
+    return (other.m_length <= m_length) && SubView(0, other.m_length).CompareWith(other, caseSensitive);
+  }
+  bool EndsWith(const StringView& other, bool caseSensitive = true) const
+  {
+    return (other.m_length <= m_length) && SubView(m_length - other.m_length).CompareWith(other, caseSensitive);
+  }
+
+  // searches for a character or a string inside the view, starting at offset.
+  // rfind searches backwards from the end, and stops at offset.
+  // returns -1 if it is not found, otherwise the offset in the view
+  int32 Find(char c, uint32 offset = 0) const
+  {
+    DebugAssert(offset <= m_length);
+    const char* pAt = Y_strnchr(m_pData + offset, m_length - offset, c);
+    return (pAt == NULL) ? -1 : int32(pAt - m_pData);
+  }
+  int32 RFind(char c, uint32 offset = 0) const
+  {
+    DebugAssert(offset <= m_length);
+    const char* pAt = Y_strnrchr(m_pData + offset, m_length - offset, c);
+    return (pAt == NULL) ? -1 : int32(pAt - m_pData);
+  }
+  int32 Find(const StringView& str, uint32 offset = 0) const
+  {
+    DebugAssert(offset <= m_length);
+    const char* pAt = Y_strnstr(m_pData + offset, m_length - offset, str.m_pData, str.m_length);
+    return (pAt == NULL) ? -1 : int32(pAt - m_pData);
+  }
+
+  // views with the characters in stripCharacters removed from the start, end or both
+  StringView LStrip(const char* stripCharacters = " \t\r\n") const
+  {
+    uint32 start = 0;
+    while (start < m_length && Y_strchr(stripCharacters, m_pData[start]) != NULL)
+      start++;
+    return StringView(m_pData + start, m_length - start);
+  }
+  StringView RStrip(const char* stripCharacters = " \t\r\n") const
+  {
+    uint32 length = m_length;
+    while (length > 0 && Y_strchr(stripCharacters, m_pData[length - 1]) != NULL)
+      length--;
+    return StringView(m_pData, length);
+  }
+  StringView Strip(const char* stripCharacters = " \t\r\n") const
+  {
+    return LStrip(stripCharacters).RStrip(stripCharacters);
+  }
+
+  // splits off everything up to the next separator, and moves the view past it.
+  // returns false once the view is empty, consecutive separators give empty tokens.
+  bool NextToken(char separator, StringView* pToken)
+  {
+    if (m_length == 0)
+      return false;
+
+    int32 separatorIndex = Find(separator);
+    if (separatorIndex < 0)
+    {
+      *pToken = *this;
+      RemovePrefix(m_length);
+    }
+    else
+    {
+      *pToken = StringView(m_pData, uint32(separatorIndex));
+      RemovePrefix(uint32(separatorIndex) + 1);
+    }
+
+    return true;
+  }
+
+  // accessor operators
+  char operator[](uint32 i) const
+  {
+    DebugAssert(i < m_length);
+    return m_pData[i];
+  }
+
+  // comparative operators
+  bool operator==(const StringView& other) const { return Compare(other); }
+  bool operator!=(const StringView& other) const { return !Compare(other); }
+  bool operator<(const StringView& other) const { return (NumericCompare(other) < 0); }
+  bool operator>(const StringView& other) const { return (NumericCompare(other) > 0); }
+
+private:
+  bool CompareWith(const StringView& other, bool caseSensitive) const
+  {
+    return caseSensitive ? Compare(other) : CompareInsensitive(other);
+  }
+
+  const char* m_pData;
+  uint32 m_length;
+};
@@ -0,0 +1,112 @@
+#pragma once
+#include "YBaseLib/Array.h"
+#include "YBaseLib/BinaryBlob.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/InlineFunction.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/Subprocess.h"
+
+class TaskQueue;
+
+// Keeps a fixed number of worker processes running ahead of time and passes requests to them, so callers don't pay
+// for process creation per request. Each request goes to the live worker with the fewest requests outstanding, and
+// its response is handed to the callback on the continuation queue, or on the worker's reader thread when there is
+// no queue. A worker that dies is restarted, and the requests it had outstanding complete with a null response.
+//
+// Workers call ServeRequests, which answers the requests one at a time in the order they arrive.
+class SubprocessPool
+{
+  DeclareNonCopyable(SubprocessPool);
+
+public:
+  // How long a reader thread waits before trying again when a worker fails to restart.
+  static const uint32 RestartRetryDelay = 1000;
+
+  // pResponse is null when the request failed, it's released after the call returns
+  typedef InlineFunction<void(BinaryBlob* pResponse)> ResponseCallback;
+
+  // Builds the response to one request, which arrives in pResponse empty. Runs in the worker process.
+  typedef void (*RequestHandler)(const byte* pRequest, uint32 requestSize, PODArray<byte>* pResponse,
+                                 void* pUserData);
+
+  // The pool takes nothing from the continuation queue but the ability to queue tasks on it, so it must outlive the
+  // pool and any response still in flight.
+  SubprocessPool(const char* executableFileName, const char* parameters, uint32 workerCount,
+                 TaskQueue* pContinuationQueue = nullptr);
+  ~SubprocessPool();
+
+  // Starts the workers and their reader threads. Returns false if any worker failed to start, the reader thread
+  // keeps trying to start it.
+  bool Start();
+
+  // Asks the workers to exit and waits for their reader threads. Requests still outstanding complete with a null
+  // response. Called by the destructor if needed.
+  void Shutdown();
+
+  uint32 GetWorkerCount() const { return m_workers.GetSize(); }
+  uint32 GetLiveWorkerCount() const;
+  uint32 GetRestartCount() const;
+
+  // Sends a copy of the request to a worker. The callback is always called exactly once, straight away with a null
+  // response if no worker is running.
+  void SubmitRequest(const void* pRequest, uint32 requestSize, ResponseCallback callback);
+
+  // Worker process side: connects to the parent and answers requests until the parent asks it to exit or goes
+  // away. Returns false if the connection could not be made.
+  static bool ServeRequests(RequestHandler handler, void* pUserData);
+
+  template<class T>
+  static bool ServeRequests(const T& handler)
+  {
+    return ServeRequests(
+      [](const byte* pRequest, uint32 requestSize, PODArray<byte>* pResponse, void* pUserData) {
+        (*reinterpret_cast<const T*>(pUserData))(pRequest, requestSize, pResponse);
+      },
+      const_cast<T*>(&handler));
+  }
+
+private:
+  class ReaderThread;
+
+  struct PendingRequest
+  {
+    uint32 RequestID;
+    ResponseCallback Callback;
+  };
+
+  struct Worker
+  {
+    SubprocessPool* pPool;
+    ReaderThread* pThread;
+
+    // both are replaced with the write lock and the pool lock held, and only by the reader thread
+    Subprocess* pProcess;
+    Subprocess::Connection* pConnection;
+    uint32 Generation;
+
+    // responses come back in request order, protected by the pool lock
+    Array<PendingRequest> Pending;
+
+    // keeps requests from different threads from interleaving on the channel
+    Mutex WriteLock;
+  };
+
+  bool StartWorker(Worker* pWorker);
+  bool ConnectWorker(Worker* pWorker, Subprocess* pProcess);
+  void StopWorker(Worker* pWorker);
+  void RunReaderThread(Worker* pWorker);
+  void CompleteRequest(ResponseCallback callback, BinaryBlob* pResponse);
+
+  String m_executableFileName;
+  String m_parameters;
+  TaskQueue* m_pContinuationQueue;
+  PODArray<Worker*> m_workers;
+
+  mutable Mutex m_lock;
+  uint32 m_nextRequestID;
+  uint32 m_restartCount;
+  bool m_started;
+  bool m_shutdown;
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/RPCChannel.h"
+#include "YBaseLib/Subprocess.h"
+
+// An RPCChannel over a Subprocess::Connection, from either end. Batches are written to the connection as they're
+// sent, blocking while it's full, and what arrives is read and dispatched by Poll, on whichever thread calls it.
+//   SubprocessRPCChannel rpc(pSubprocess->ConnectToChild());
+//   rpc.GetChannel()->BeginCall(Method_Compile, callback)->WriteSizePrefixedString(fileName);
+//   rpc.GetChannel()->EndMessage();
+//   while (rpc.GetChannel()->GetOutstandingCallCount() > 0 && rpc.Poll(-1)) {}
+class SubprocessRPCChannel
+{
+public:
+  // The connection stays the caller's, and outlives the channel.
+  SubprocessRPCChannel(Subprocess::Connection* pConnection,
+                       uint32 maxBatchSize = RPCChannel::DefaultMaxBatchSize);
+  ~SubprocessRPCChannel();
+
+  Subprocess::Connection* GetConnection() const { return m_pConnection; }
+  RPCChannel* GetChannel() { return &m_channel; }
+
+  // Dispatches whatever's arrived, waiting up to timeout milliseconds for something, or forever for -1. Returns false
+  // once the other side has gone or sent something malformed, and the channel is closed.
+  bool Poll(int32 timeout = 0);
+
+  // The child's side, answering calls until the parent goes or asks it to exit.
+  void Serve();
+
+private:
+  Subprocess::Connection* m_pConnection;
+  RPCChannel m_channel;
+  PODArray<byte> m_receiveBuffer;
+
+  // a write that didn't all go, after which the stream can't be trusted
+  bool m_writeFailed;
+
+  DeclareNonCopyable(SubprocessRPCChannel);
+};
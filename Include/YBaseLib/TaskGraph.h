@@ -0,0 +1,155 @@
+#pragma once
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/AutoReleasePtr.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/ConditionVariable.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/TaskQueue.h"
+#include "YBaseLib/ThreadPool.h"
+
+// Dependency-counted task graph.
+// Tasks are created unsubmitted, dependencies are added, and then the task is submitted. A submitted task is
+// scheduled onto the task queue or thread pool once all of its dependencies have completed, so no thread is
+// blocked waiting on a predecessor. Dependencies can only be added to a task before it is submitted, but the
+// predecessor may be in any state, including already completed.
+
+class TaskGraph
+{
+public:
+  class Node : public ThreadPoolWorkItem
+  {
+    friend class TaskGraph;
+
+  public:
+    bool IsSubmitted() const { return m_submitted; }
+    bool IsFinished() const { return m_finished; }
+
+  protected:
+    Node(TaskGraph* pGraph);
+    virtual ~Node();
+
+    // the task body
+    virtual void Run() = 0;
+
+    // thread pool entry point
+    virtual int32 ProcessWork() override;
+
+  private:
+    // singly-linked list of tasks waiting on this one, pushed with compare-exchange
+    struct SuccessorLink
+    {
+      Node* pNode;
+      SuccessorLink* pNext;
+    };
+
+    TaskGraph* m_pGraph;
+
+    // number of unfinished dependencies, plus one until the task is submitted
+    Y_ATOMIC_DECL uint32 m_pendingCount;
+
+    // set to SuccessorListClosed once the task finishes, so late dependents see it as complete
+    Y_ATOMIC_PTR_DECL(SuccessorLink) m_pSuccessors;
+
+    volatile bool m_finished;
+    bool m_submitted;
+  };
+
+  // handles own a reference to the task
+  typedef AutoReleasePtr<Node> TaskHandle;
+
+private:
+  template<class T>
+  struct LambdaNode : public Node
+  {
+    T m_callback;
+
+    LambdaNode(TaskGraph* pGraph, const T& callback) : Node(pGraph), m_callback(callback) {}
+    LambdaNode(TaskGraph* pGraph, T&& callback) : Node(pGraph), m_callback(std::move(callback)) {}
+    virtual void Run() override { m_callback(); }
+  };
+
+public:
+  // tasks are run through the task queue, which can itself be backed by a thread pool
+  TaskGraph(TaskQueue* pTaskQueue);
+
+  // tasks are run directly as thread pool work items
+  TaskGraph(ThreadPool* pThreadPool);
+
+  // waits for all submitted tasks to finish
+  ~TaskGraph();
+
+  // creates a task, it will not run until submitted
+  template<class T>
+  TaskHandle CreateTask(T&& lambda)
+  {
+    typedef typename std::decay<T>::type LambdaType;
+    return TaskHandle(new LambdaNode<LambdaType>(this, std::forward<T>(lambda)));
+  }
+
+  // creates a task which depends on the specified tasks, it will not run until submitted
+  template<class T>
+  TaskHandle CreateTask(T&& lambda, TaskHandle* pDependencies, uint32 dependencyCount)
+  {
+    TaskHandle task(CreateTask(std::forward<T>(lambda)));
+    for (uint32 i = 0; i < dependencyCount; i++)
+      AddDependency(task, pDependencies[i]);
+
+    return task;
+  }
+
+  // task will not start until dependsOn has finished. task must not have been submitted yet.
+  void AddDependency(Node* pTask, Node* pDependsOn);
+
+  // allows the task to run once its dependencies are satisfied
+  void Submit(Node* pTask);
+
+  // creates and submits a task that runs after antecedent has finished
+  template<class T>
+  TaskHandle AddContinuation(Node* pAntecedent, T&& lambda)
+  {
+    TaskHandle task(CreateTask(std::forward<T>(lambda)));
+    AddDependency(task, pAntecedent);
+    Submit(task);
+    return task;
+  }
+
+  // blocks the calling thread until the task has finished. if the task queue has no workers, queued tasks are
+  // executed on the calling thread while waiting. waiting from inside a graph task occupies that worker, so
+  // prefer continuations there.
+  void WaitFor(Node* pTask);
+
+  // blocks until every submitted task has finished
+  void WaitForAll();
+
+  // number of tasks submitted but not yet finished
+  uint32 GetOutstandingTaskCount() const { return m_outstandingTaskCount; }
+
+private:
+  // schedules a task whose dependencies are all satisfied
+  void ScheduleTask(Node* pTask);
+
+  // drops one pending dependency, scheduling the task if it was the last
+  void ReleaseDependency(Node* pTask);
+
+  // runs the task body and releases its dependents
+  void ExecuteTask(Node* pTask);
+
+  // whether waits should run tasks on the calling thread
+  bool ShouldExecuteWhileWaiting() const;
+
+  // blocks until the condition holds
+  template<class T>
+  void WaitUntil(const T& condition);
+
+  TaskQueue* m_pTaskQueue;
+  ThreadPool* m_pThreadPool;
+
+  Y_ATOMIC_DECL uint32 m_outstandingTaskCount;
+
+  // waiters sleep on this, completions only take the lock for the last task or when someone is waiting
+  Mutex m_waitLock;
+  ConditionVariable m_waitConditionVariable;
+  Y_ATOMIC_DECL uint32 m_waiterCount;
+
+  DeclareNonCopyable(TaskGraph);
+};
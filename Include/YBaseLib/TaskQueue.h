@@ -1,13 +1,23 @@
 #pragma once
-#include "YBaseLib/Barrier.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/LightweightBarrier.h"
+#include "YBaseLib/CacheAligned.h"
 #include "YBaseLib/CircularBuffer.h"
 #include "YBaseLib/Common.h"
+#include "YBaseLib/ConditionVariable.h"
+#include "YBaseLib/Fiber.h"
+#include "YBaseLib/ObjectPool.h"
+#include "YBaseLib/PriorityQueue.h"
 #include "YBaseLib/RecursiveMutex.h"
 #include "YBaseLib/Thread.h"
 #include "YBaseLib/ThreadPool.h"
+#include "YBaseLib/WorkerIdlePolicy.h"
 
 // Thread-safe task queue
 
+// fiber that tasks run on when fiber jobs are enabled
+struct TaskQueueFiber;
+
 class TaskQueue
 {
 public:
@@ -34,14 +44,77 @@ private:
     virtual void Execute() { m_callback(); }
   };
 
+public:
+  // Number of outstanding tasks queued against it with QueueCountedLambdaTask, which WaitForCounter waits on.
+  // The counter must outlive its tasks. It can be reused once it has reached zero.
+  class JobCounter
+  {
+    friend class TaskQueue;
+
+  public:
+    JobCounter() : m_value(0), m_pWaiters(nullptr) {}
+    ~JobCounter() { DebugAssert(m_value == 0 && m_pWaiters == nullptr); }
+
+    uint32 GetValue() const { return m_value; }
+    bool IsComplete() const { return (m_value == 0); }
+
+  private:
+    // raised by producers, the decrement to zero happens with the queue lock held
+    Y_ATOMIC_DECL uint32 m_value;
+
+    // suspended fibers to resume once the value reaches zero, protected by the queue lock
+    TaskQueueFiber* m_pWaiters;
+
+    DeclareNonCopyable(JobCounter);
+  };
+
+private:
+  template<class T>
+  struct CountedLamdaTask : public Task
+  {
+    T m_callback;
+    TaskQueue* m_pTaskQueue;
+    JobCounter* m_pCounter;
+
+    CountedLamdaTask(TaskQueue* pTaskQueue, JobCounter* pCounter, T&& callback)
+      : m_callback(std::move(callback)), m_pTaskQueue(pTaskQueue), m_pCounter(pCounter)
+    {
+    }
+    CountedLamdaTask(TaskQueue* pTaskQueue, JobCounter* pCounter, const T& callback)
+      : m_callback(callback), m_pTaskQueue(pTaskQueue), m_pCounter(pCounter)
+    {
+    }
+    virtual ~CountedLamdaTask() {}
+
+    virtual void Execute()
+    {
+      m_callback();
+      m_pTaskQueue->ReleaseJobCounter(m_pCounter);
+    }
+  };
+
 public:
   TaskQueue();
   ~TaskQueue();
 
+  Y_DECLARE_CACHE_ALIGNED_NEW();
+
   // Initialize the command queue
   // If workerThreadCount is set to zero, the calling thread must execute work queued by other threads
   // by calling ExecuteQueuedTasks.
-  bool Initialize(uint32 taskQueueSize = DefaultQueueSize, uint32 workerThreadCount = 1);
+  // If lockFreeProducers is set, queueing threads reserve and commit space in the fifo with atomic operations
+  // instead of taking the queue lock. The queue size is rounded up to a power of two in this mode. Producers are
+  // not blocked by PauseWorkers in this mode, but the workers will not pick up new tasks until resumed.
+  // Worker threads are placed on processors the same way as thread pool workers.
+  bool Initialize(uint32 taskQueueSize = DefaultQueueSize, uint32 workerThreadCount = 1,
+                  bool lockFreeProducers = false, THREADPOOL_AFFINITY affinity = THREADPOOL_AFFINITY_DEFAULT);
+
+  // Runs tasks on fibers rather than directly on the worker threads, must be called before Initialize with worker
+  // threads. A task waiting in WaitForCounter then suspends its fiber and the worker carries on with other tasks,
+  // instead of the worker blocking. Fibers are created as needed and reused, each with a stack of stackSize bytes.
+  // Returns false if the platform doesn't support fibers.
+  bool EnableFiberJobs(uint32 stackSize = Fiber::DefaultStackSize);
+  bool IsUsingFiberJobs() const { return (m_fiberStackSize > 0); }
 
   // Initialize the command queue using a shared thread pool
   bool Initialize(ThreadPool* pThreadPool, uint32 taskQueueSize = DefaultQueueSize, bool yieldToOtherJobs = false);
@@ -54,6 +127,25 @@ public:
   Thread::ThreadIdType GetWorkerThreadID(uint32 idx) const { return m_workerThreads[idx]->GetThreadId(); }
   uint32 GetWorkerThreadCount() const { return m_workerThreads.GetSize(); }
 
+  // Thread pool the queue is executed by, if any
+  ThreadPool* GetThreadPool() const { return m_pThreadPool; }
+
+  // How the queue's own worker threads wait when the queue is empty, defaults to parking straight away.
+  // Queues running on a thread pool use the pool's policy instead.
+  const WorkerIdlePolicy& GetIdlePolicy() const { return m_idlePolicy; }
+  void SetIdlePolicy(const WorkerIdlePolicy& policy);
+
+  // sum of the worker threads' idle counters
+  WorkerIdleStats GetIdleStats() const;
+
+  // per-task queue time and execution time counters, off by default. enabling them costs a timer read when a task
+  // is queued and two when it runs. for fiber jobs the execution time includes time spent waiting on counters.
+  bool IsStatsEnabled() const { return m_statsEnabled; }
+  void SetStatsEnabled(bool enabled);
+
+  // snapshot of the counters, summed over the workers and any thread executing tasks directly
+  SchedulerStats GetStats() const;
+
   // Pausing/resuming of thread
   void PauseWorkers();
   void ResumeWorkers();
@@ -65,7 +157,7 @@ public:
   template<class T>
   void QueueLambdaTask(const T& lambda)
   {
-    if (m_taskQueueBuffer.GetBufferSize() == 0)
+    if (!HasQueue())
     {
       lambda();
       return;
@@ -76,14 +168,14 @@ public:
     LamdaTask<T>* trampoline = (LamdaTask<T>*)FifoAllocateTask(sizeof(LamdaTask<T>), nullptr);
     new (trampoline) LamdaTask<T>(lambda);
 
-    UnlockQueueForNewTask();
+    UnlockQueueForNewTask(trampoline);
   }
 
   // Queue lambda call using move semantics
   template<class T>
   void QueueLambdaTask(T&& lambda)
   {
-    if (m_taskQueueBuffer.GetBufferSize() == 0)
+    if (!HasQueue())
     {
       lambda();
       return;
@@ -94,9 +186,43 @@ public:
     LamdaTask<T>* trampoline = (LamdaTask<T>*)FifoAllocateTask(sizeof(LamdaTask<T>), nullptr);
     new (trampoline) LamdaTask<T>(std::move(lambda));
 
-    UnlockQueueForNewTask();
+    UnlockQueueForNewTask(trampoline);
   }
 
+  // Queues several tasks under a single reservation. With the locked fifo the queue lock is held for the lifetime of
+  // the scope, with the lock-free fifo tasks are committed as they are queued. In both cases workers are only woken
+  // when the scope ends, and then only as many as there are new tasks. Blocking tasks can't be queued in a batch.
+  class BatchScope
+  {
+  public:
+    BatchScope(TaskQueue* pTaskQueue);
+    ~BatchScope();
+
+    void QueueTask(Task* pTask, uint32 taskSize);
+
+    template<class T>
+    void QueueLambdaTask(T&& lambda)
+    {
+      if (!m_pTaskQueue->HasQueue())
+      {
+        lambda();
+        return;
+      }
+
+      typedef typename std::decay<T>::type LambdaType;
+      LamdaTask<LambdaType>* trampoline =
+        (LamdaTask<LambdaType>*)m_pTaskQueue->FifoAllocateTask(sizeof(LamdaTask<LambdaType>), nullptr);
+      new (trampoline) LamdaTask<LambdaType>(std::forward<T>(lambda));
+
+      m_pTaskQueue->CommitBatchedTask(trampoline);
+    }
+
+  private:
+    TaskQueue* m_pTaskQueue;
+
+    DeclareNonCopyable(BatchScope);
+  };
+
   // blocking variants
   void QueueBlockingTask(Task* pTask, uint32 taskSize);
   template<class T>
@@ -104,7 +230,7 @@ public:
   {
     // We can't queue blocking tasks if we're on the same thread, so execute it immediately.
     // This could cause issues if a non-blocking task is queued first, so beware.
-    if (m_taskQueueBuffer.GetBufferSize() == 0 || IsOnWorkerThread())
+    if (!HasQueue() || IsOnWorkerThread())
     {
       lambda();
       return;
@@ -112,16 +238,75 @@ public:
 
     LockQueueForNewTask();
 
-    Barrier* pBarrier;
+    LightweightBarrier* pBarrier;
     LamdaTask<T>* trampoline = (LamdaTask<T>*)FifoAllocateTask(sizeof(LamdaTask<T>), &pBarrier);
     new (trampoline) LamdaTask<T>(lambda);
 
-    UnlockQueueForNewTask();
+    UnlockQueueForNewTask(trampoline);
 
     // block
     pBarrier->Wait();
   }
 
+  // queues a task which raises the counter until it has finished executing
+  template<class T>
+  void QueueCountedLambdaTask(JobCounter* pCounter, T&& lambda)
+  {
+    Y_AtomicIncrement(pCounter->m_value);
+
+    typedef typename std::decay<T>::type LambdaType;
+    if (!HasQueue())
+    {
+      lambda();
+      ReleaseJobCounter(pCounter);
+      return;
+    }
+
+    LockQueueForNewTask();
+
+    CountedLamdaTask<LambdaType>* trampoline =
+      (CountedLamdaTask<LambdaType>*)FifoAllocateTask(sizeof(CountedLamdaTask<LambdaType>), nullptr);
+    new (trampoline) CountedLamdaTask<LambdaType>(this, pCounter, std::forward<T>(lambda));
+
+    UnlockQueueForNewTask(trampoline);
+  }
+
+  // identifies a delayed or periodic task so it can be cancelled, zero is never used
+  typedef uint64 TimerID;
+  static const TimerID InvalidTimerID = 0;
+
+  // Runs the lambda on the queue once delay milliseconds have passed. Workers with nothing to do sleep until the
+  // earliest deadline at most, so a queue with only timers pending wakes when the next is due, and not before.
+  // Timers run on a worker, ahead of queued tasks once due, on the worker's own stack rather than a job fiber.
+  // A queue without workers runs those that are due in ExecuteQueuedTasks. Queues on a thread pool only check their
+  // timers while running tasks, as there's no thread of their own to wait for the deadline. Timers that haven't
+  // run when the queue is destroyed are dropped.
+  template<class T>
+  TimerID QueueDelayedLambdaTask(uint32 delay, T&& lambda)
+  {
+    typedef typename std::decay<T>::type LambdaType;
+    return AddTimer(delay, 0, new LamdaTask<LambdaType>(std::forward<T>(lambda)));
+  }
+
+  // Runs the lambda every period milliseconds, the first time a period from now, until cancelled. A run never
+  // overlaps the one before, and runs missed by falling behind are skipped rather than made up back to back.
+  template<class T>
+  TimerID QueuePeriodicLambdaTask(uint32 period, T&& lambda)
+  {
+    DebugAssert(period > 0);
+    typedef typename std::decay<T>::type LambdaType;
+    return AddTimer(period, period, new LamdaTask<LambdaType>(std::forward<T>(lambda)));
+  }
+
+  // Stops a timer from running again, returns false if it already ran or was cancelled. A periodic timer that's
+  // running when cancelled finishes that run, without waiting for it here.
+  bool CancelTimer(TimerID id);
+
+  // blocks until the counter reaches zero. inside a task of a queue using fiber jobs the task's fiber is suspended,
+  // and resumed on any worker once the counter completes. a queue without workers executes tasks while waiting.
+  // on the workers of other queues the wait occupies the worker, so the counted tasks must not depend on it.
+  void WaitForCounter(JobCounter* pCounter);
+
   // executes any pending tasks on the current thread, and blocks until the queue is empty
   // returns true if a task was executed, false if the queue was empty
   bool ExecuteQueuedTasks();
@@ -129,16 +314,37 @@ public:
   // helper method for determining if the caller is on a worker thread.
   bool IsOnWorkerThread() const;
 
+  // returns true if producers are using the lock-free fifo
+  bool IsLockFreeQueue() const { return (m_pLockFreeBuffer != nullptr); }
+
 private:
   // worker thread class
   class WorkerThread : public Thread
   {
   public:
-    WorkerThread(TaskQueue* pParent);
+    WorkerThread(TaskQueue* pParent, uint64 affinityMask);
+
+    const WorkerIdleStats& GetIdleStats() const { return m_idleStats; }
+    const SchedulerWorkerStats& GetSchedulerStats() const { return m_schedulerStats; }
 
   protected:
     virtual int ThreadEntryPoint() override;
+
+    // switches to a job fiber, then either frees it or parks it on its counter once it switches back.
+    // called without the queue lock, returns with it held.
+    void RunJobFiber(TaskQueueFiber* pFiber);
+
     TaskQueue* m_this;
+
+    // the worker's own context when using fiber jobs, job fibers switch back to it
+    Fiber m_schedulerFiber;
+
+    // processors the worker binds itself to when it starts, zero if unbound
+    uint64 m_affinityMask;
+
+    // only written by this worker
+    WorkerIdleStats m_idleStats;
+    SchedulerWorkerStats m_schedulerStats;
   };
 
   // thread pool task class
@@ -150,36 +356,77 @@ private:
     bool IsActive() const { return m_active; }
     void SetActive() { m_active = true; }
 
+    const SchedulerWorkerStats& GetSchedulerStats() const { return m_schedulerStats; }
+
   protected:
     virtual int32 ProcessWork() override;
     TaskQueue* m_this;
     bool m_active;
+
+    // only one pool worker runs the task at a time
+    SchedulerWorkerStats m_schedulerStats;
   };
 
+  friend TaskQueueFiber;
   // so the tasks can call our internal methods
   friend WorkerThread;
   friend ThreadPoolTask;
+  friend BatchScope;
 
   // fifo queue entry
   struct FifoQueueEntryHeader
   {
     uint32 Size;
-    Barrier* pBarrier;
+    // lock-free mode only, set by the producer once the entry is fully written
+    volatile uint32 CommitState;
+    LightweightBarrier* pBarrier;
     bool AcceptedFlag;
     bool CompletedFlag;
+    // when the task was queued, zero if stats were disabled at the time
+    Y_TIMER_VALUE QueueTime;
+  };
+
+  // lock-free entry commit states
+  enum : uint32
+  {
+    FIFO_ENTRY_RESERVED = 0,
+    FIFO_ENTRY_COMMITTED = 1,
+    FIFO_ENTRY_PADDING = 2,
   };
 
+  // lock-free entries are padded to this alignment so the task objects are suitably aligned
+  static const uint32 LockFreeEntryAlignment = 16;
+
+  // pooled barriers, one for each blocking task in flight plus those cached by the threads releasing them
+  static const uint32 BarrierPoolCapacity = 256;
+
   // allocate the queue
   void AllocateQueue(uint32 size);
+  void AllocateLockFreeQueue(uint32 size);
 
-  // lock the queue
+  // is there a queue at all? if not, tasks are executed immediately
+  bool HasQueue() const { return (m_taskQueueBuffer.GetBufferSize() > 0 || m_pLockFreeBuffer != nullptr); }
+
+  // lock the queue, does nothing for the lock-free queue
   void LockQueueForNewTask();
 
-  // unlock the queue, call this variant if no additional tasks were added
-  void UnlockQueueForNewTask();
+  // unlock the queue after allocating pTaskMemory, and wake a worker. the lock-free queue commits the task instead.
+  void UnlockQueueForNewTask(void* pTaskMemory);
+
+  // makes a task allocated in a batch visible without waking any workers
+  void CommitBatchedTask(void* pTaskMemory);
+
+  // resets the batched task count, returning the old value
+  uint32 ClearBatchedTaskCount();
+
+  // wakes workers for any tasks committed by a batch. the queue lock must be held.
+  void FlushBatchedTasks();
+
+  // wakes up to count sleeping workers, or starts up to count thread pool tasks. the queue lock must be held.
+  void WakeWorkers(uint32 count);
 
-  // allocate bytes in the queue, assumes that the queue lock is held
-  void* FifoAllocateTask(uint32 size, Barrier** ppBarrier);
+  // allocate bytes in the queue, assumes that the queue lock is held for the locked queue
+  void* FifoAllocateTask(uint32 size, LightweightBarrier** ppBarrier);
 
   // fifo is empty?
   bool FifoIsEmpty() const;
@@ -190,9 +437,60 @@ private:
   // release a fifo task
   void FifoReleaseTask(FifoQueueEntryHeader* taskHdr);
 
-  // barrier allocator
-  Barrier* AllocateBarrier();
-  void ReleaseBarrier(Barrier* pBarrier);
+  // lock-free fifo implementation, consumer side methods assume the queue lock is held
+  void* LockFreeAllocateTask(uint32 size, LightweightBarrier** ppBarrier);
+  void LockFreeCommitTask(void* pTaskMemory, bool wakeWorker = true);
+  FifoQueueEntryHeader* LockFreeFindNextTask(bool acceptTask);
+  void LockFreeReleaseTask(FifoQueueEntryHeader* taskHdr);
+  FifoQueueEntryHeader* LockFreeGetEntry(uint32 position) const
+  {
+    return reinterpret_cast<FifoQueueEntryHeader*>(m_pLockFreeBuffer + (position & m_lockFreeBufferMask));
+  }
+
+  // fiber jobs, these assume the queue lock is held unless noted
+  TaskQueueFiber* AllocateJobFiber();
+  void PushReadyJobFiber(TaskQueueFiber* pFiber);
+  TaskQueueFiber* PopReadyJobFiber();
+  static void JobFiberEntryPoint(void* pUserData);
+
+  // runs a task on the calling job fiber and releases it, takes the queue lock itself
+  void ExecuteJobFiberTask(FifoQueueEntryHeader* taskHdr);
+
+  // drops one from the counter, resuming anything waiting on it when it reaches zero. takes the queue lock.
+  void ReleaseJobCounter(JobCounter* pCounter);
+
+  // A delayed or periodic task in the timer heap, which owns the task. Deadlines are in milliseconds of the timer
+  // clock, ties go to the timer added first. A periodic timer that's running stays in the heap, so it can still be
+  // cancelled, with a deadline that never comes.
+  struct TimerEntry
+  {
+    uint64 Deadline;
+    uint32 Serial;
+    uint32 Period;
+    Task* pTask;
+  };
+  struct TimerEntryCompare
+  {
+    bool operator()(const TimerEntry& left, const TimerEntry& right) const
+    {
+      return (left.Deadline < right.Deadline || (left.Deadline == right.Deadline && left.Serial < right.Serial));
+    }
+  };
+  static const uint64 RunningTimerDeadline = 0xFFFFFFFFFFFFFFFFull;
+  static const uint32 NoTimerWait = 0xFFFFFFFF;
+
+  TimerID AddTimer(uint32 delay, uint32 period, Task* pTask);
+
+  // Runs the earliest timer if it's due, releasing the queue lock while it runs. Returns false if none was due.
+  // Worker and pool tasks record it in their own stats, anything else in the shared stats.
+  bool RunDueTimer(SchedulerWorkerStats* pStats);
+
+  // milliseconds until the earliest timer is due, or NoTimerWait if there's nothing to wait for
+  uint32 GetTimerWaitTime() const;
+
+  // barrier allocator, only takes the queue lock once the pool is exhausted
+  LightweightBarrier* AllocateBarrier();
+  void ReleaseBarrier(LightweightBarrier* pBarrier);
 
   // worker thread
   PODArray<WorkerThread*> m_workerThreads;
@@ -201,18 +499,63 @@ private:
   // thread pool
   PODArray<ThreadPoolTask*> m_threadPoolTasks;
   ThreadPool* m_pThreadPool;
-  volatile uint32 m_activeThreadPoolTasks;
   bool m_threadPoolYieldToOtherJobs;
 
   // fifo members
   CircularBuffer m_taskQueueBuffer;
   RecursiveMutex m_queueLock;
-  volatile uint32 m_activeWorkerThreads;
+
+  // idle behaviour, and when a sleeping worker was last woken for work. the wake time is protected by the lock.
+  WorkerIdlePolicy m_idlePolicy;
+  Y_TIMER_VALUE m_lastWakeRequestTime;
+
+  // lock-free fifo buffer, its positions are below with the other counters
+  byte* m_pLockFreeBuffer;
+  uint32 m_lockFreeBufferMask;
 
   // condition variable for worker wakeup
   ConditionVariable m_conditionVariable;
 
-  // barrier for sync event pool
-  PODArray<Barrier*> m_barrierPool;
-  size_t m_allocatedBarrierCount;
+  // delayed and periodic tasks, protected by the lock
+  IndexedPriorityQueue<TimerEntry, TimerEntryCompare> m_timers;
+  uint32 m_nextTimerSerial;
+
+  // fiber jobs. fibers are reused once their task finishes, and resumed in the order their counters completed.
+  uint32 m_fiberStackSize;
+  PODArray<TaskQueueFiber*> m_freeJobFibers;
+  TaskQueueFiber* m_pReadyJobFibersHead;
+  TaskQueueFiber* m_pReadyJobFibersTail;
+  uint32 m_jobFiberCount;
+
+  // threads outside the job fibers waiting for a counter
+  ConditionVariable m_counterConditionVariable;
+
+  // scheduler stats, and when they were first enabled. tasks that don't run on a worker or a pool task, ie
+  // ExecuteQueuedTasks and fiber jobs, are counted in the shared stats with the queue lock held.
+  volatile bool m_statsEnabled;
+  Y_TIMER_VALUE m_statsStartTime;
+  SchedulerWorkerStats m_sharedSchedulerStats;
+
+  // barriers for blocking tasks. a waiter can still be leaving one after the task's released it, so they're never
+  // freed while the queue is alive: those past the pool's capacity are kept on the overflow list, under the lock.
+  ObjectPool<LightweightBarrier> m_barrierPool;
+  PODArray<LightweightBarrier*> m_overflowBarriers;
+
+  // Counters written by every producer and worker, each on a cache line of its own so that updating one doesn't take
+  // the line away from threads reading the members around it.
+  Y_CACHE_ALIGNED_DECL volatile uint32 m_activeThreadPoolTasks;
+  Y_CACHE_ALIGNED_DECL volatile uint32 m_activeWorkerThreads;
+
+  // tasks that are visible in the fifo but haven't been picked up yet, so idle workers can spin without the lock
+  Y_CACHE_ALIGNED_DECL volatile uint32 m_pendingTaskCount;
+
+  // tasks committed by batches that haven't woken a worker yet
+  Y_CACHE_ALIGNED_DECL volatile uint32 m_batchedTaskCount;
+
+  // lock-free fifo positions, free-running and masked to get the buffer offset. producers advance the tail with
+  // compare-exchange, consumers advance the head while holding the queue lock. producers waiting for space wait on
+  // the head, and count themselves next to it, where consumers moving it look.
+  Y_CACHE_ALIGNED_DECL volatile uint32 m_lockFreeHead;
+  volatile uint32 m_lockFreeSpaceWaiters;
+  Y_CACHE_ALIGNED_DECL volatile uint32 m_lockFreeTail;
 };
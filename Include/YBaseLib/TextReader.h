@@ -1,6 +1,7 @@
 #pragma once
 #include "YBaseLib/ByteStream.h"
 #include "YBaseLib/Common.h"
+#include "YBaseLib/StringView.h"
 
 class String;
 
@@ -12,17 +13,47 @@ enum TEXT_ENCODING
   TEXT_ENCODING_AUTODETECT,
 };
 
+// Reads lines from a stream a block at a time, searching each block for line breaks with memchr. A stream that's
+// all in memory, like a memory stream or a mapped file, is read in place without copying. The reader reads ahead
+// of what it returns, so the stream shouldn't be used directly while it's reading; when the reader is destroyed,
+// the stream is seeked back to just past the last line returned, if it can seek.
 class TextReader
 {
 public:
+  static const uint32 DefaultBufferSize = 65536;
+
   TextReader(ByteStream* pStream, TEXT_ENCODING eSourceEncoding = TEXT_ENCODING_UTF8);
+  ~TextReader();
 
   bool ReadCharacter(char* pDestination);
   bool ReadLine(char* pDestination, uint32 cbDestination, uint32* pLineLength = NULL, bool* pEndOfLine = NULL);
   bool ReadLine(String* pDestString);
 
+  // The next line without its line break, pointing into the reader's buffer or the stream's memory, so it's only
+  // valid until the next read. A line longer than the buffer grows it. Returns false at the end of the stream.
+  bool ReadLine(StringView* pLine);
+
+  // For splitting text that's all in memory: the offset of the first line starting at or after the offset, and the
+  // line at *pPosition, moving it past the line break. These are what ParallelForEachLine is built from.
+  static uint64 FindLineStart(const char* pText, uint64 textLength, uint64 offset);
+  static bool SplitLine(const char** ppPosition, const char* pEnd, StringView* pLine);
+
 private:
+  // Keeps what's left of the window, reading in another block after it. Returns false if nothing more could be
+  // read.
+  bool FillBuffer();
+
   ByteStream* m_pStream;
   TEXT_ENCODING m_eSourceEncoding;
+
+  // where the stream's text is read into, unless it's in memory
+  char* m_pBuffer;
+  uint32 m_bufferSize;
+
+  // the text read but not returned, in the buffer or the stream's memory
+  const char* m_pPosition;
+  const char* m_pEnd;
+  bool m_endOfStream;
+
   DeclareNonCopyable(TextReader);
 };
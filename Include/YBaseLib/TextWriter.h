@@ -2,13 +2,26 @@
 #include "YBaseLib/ByteStream.h"
 #include "YBaseLib/Common.h"
 #include "YBaseLib/TextReader.h" // <-- for TEXT_ENCODING
+#include "YBaseLib/TypedFormat.h"
 
 class String;
 
+// Writes text to a stream through a buffer, so small writes don't each call the stream. Formatted text and numbers
+// are written straight into the buffer. Line breaks are written as the platform's when the buffer goes out. What's
+// buffered is written out by Flush or when the writer is destroyed, so flush before using the stream directly,
+// committing it, or reading back what was written.
 class TextWriter
 {
 public:
+  static const uint32 BufferSize = 4096;
+
   TextWriter(ByteStream* pStream, TEXT_ENCODING eSourceEncoding = TEXT_ENCODING_UTF8);
+  ~TextWriter();
+
+  // Writes out what's buffered, without flushing the stream itself. Returns false if a write to the stream has
+  // failed, after which everything written is dropped.
+  bool Flush();
+  bool InErrorState() const { return m_errorState; }
 
   void Write(const char* szCharacters);
   void Write(const char* szCharacters, uint32 cbCharacters);
@@ -18,6 +31,28 @@ public:
   void WriteLine(const char* szCharacters, uint32 cbCharacters);
   void WriteLine(const String& strCharacters);
   void WriteFormattedLine(const char* szFormat, ...);
+
+  // numbers as decimal text, floating point in a form that reads back the same, see NumberConversion.h
+  void WriteInt32(int32 value);
+  void WriteUInt32(uint32 value);
+  void WriteInt64(int64 value);
+  void WriteUInt64(uint64 value);
+  void WriteFloat(float value);
+  void WriteDouble(double value);
+
+  // type-safe formatted text, see TypedFormat.h
+  template<typename... Args>
+  void WriteFormat(const StringView& format, const Args&... args)
+  {
+    const TypedFormat::Argument arguments[] = {TypedFormat::MakeArgument(args)..., TypedFormat::Argument()};
+    WriteFormatted(format, arguments, sizeof...(Args), false);
+  }
+  template<typename... Args>
+  void WriteFormatLine(const StringView& format, const Args&... args)
+  {
+    const TypedFormat::Argument arguments[] = {TypedFormat::MakeArgument(args)..., TypedFormat::Argument()};
+    WriteFormatted(format, arguments, sizeof...(Args), true);
+  }
   void WriteWithLineNumbers(const char* str);
   void WriteWithLineNumbers(const char* str, uint32 strLength);
   bool WriteStream(ByteStream* pStream, bool restorePosition = false, bool rewindStream = false);
@@ -27,9 +62,28 @@ public:
   TextWriter& operator<<(const String& strCharacters);
 
 private:
+  // copies into the buffer, writing it out as it fills
   void _Write(const char* szCharacters, uint32 nCharacters);
 
+  // The buffer's free space once there's at least the given size, which is at most BufferSize, or nullptr if the
+  // stream has failed. Text put there is kept with CommitBuffer.
+  char* ReserveBuffer(uint32 size);
+  void CommitBuffer(uint32 length) { m_bufferLength += length; }
+
+  // printf-style text into the buffer, or through the heap if it doesn't fit
+  void WriteFormattedVA(const char* szFormat, va_list ap, bool newLine);
+  void WriteFormatted(const StringView& format, const TypedFormat::Argument* pArguments, uint32 argumentCount,
+                      bool newLine);
+
+  // writes to the stream, with line breaks as the platform's
+  void WriteToStream(const char* pText, uint32 length);
+
   ByteStream* m_pStream;
   TEXT_ENCODING m_eSourceEncoding;
+
+  char m_buffer[BufferSize];
+  uint32 m_bufferLength;
+  bool m_errorState;
+
   DeclareNonCopyable(TextWriter);
 };
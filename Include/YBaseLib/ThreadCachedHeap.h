@@ -0,0 +1,45 @@
+#pragma once
+#include "YBaseLib/Common.h"
+
+// Size-class heap with a cache in front of it for each thread. Small blocks are carved out of 64KB spans and
+// kept on per-thread free lists, a thread only takes a lock to move a batch of blocks between its cache and
+// the shared list for the size class. Anything over MaxSmallSize goes to the system allocator.
+// A block can be freed on any thread. Blocks freed away from the thread that allocated them go into the
+// freeing thread's cache, and are handed back to the shared list once that cache holds two batches, so a
+// thread that only frees what another thread allocates doesn't grow without bound.
+// Span memory is kept for reuse and only given back to the system when the process exits.
+// The Y_malloc and Y_aligned_* functions use this heap when built with Y_THREAD_CACHED_MALLOC.
+namespace ThreadCachedHeap {
+
+// largest block served from the size classes, and the largest alignment supported
+static const size_t MaxSmallSize = 8192;
+static const size_t MaxAlignment = 4096;
+
+// blocks are aligned to 16 bytes unless requested otherwise
+void* Allocate(size_t size);
+void* AllocateAligned(size_t size, size_t alignment);
+
+// keeps the block where it is if it's already big enough, pMemory can be null
+void* Reallocate(void* pMemory, size_t size);
+void* ReallocateAligned(void* pMemory, size_t size, size_t alignment);
+
+void Free(void* pMemory);
+
+// bytes that can be used at pMemory, at least the size requested
+size_t GetUsableSize(const void* pMemory);
+
+// returns the calling thread's cached blocks to the shared lists. Thread releases the cache when a thread
+// exits, threads started any other way should call ReleaseThreadCache before exiting.
+void FlushThreadCache();
+void ReleaseThreadCache();
+
+struct Stats
+{
+  uint32 SpanCount;
+  size_t SpanMemory;
+  uint32 LargeAllocationCount;
+};
+
+void GetStats(Stats* pStats);
+
+}; // namespace ThreadCachedHeap
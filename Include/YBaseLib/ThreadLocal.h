@@ -0,0 +1,78 @@
+#pragma once
+#include "YBaseLib/Common.h"
+
+struct ThreadLocalRecord;
+
+// Storage for per-thread objects that need a destructor, which Y_DECLARE_THREAD_LOCAL can't give them. Each thread's
+// value is created on its first Get and destroyed when the thread exits, or when the ThreadLocal itself is
+// destroyed, whichever comes first.
+//
+// Threads started with Thread release their values as they finish. Others are caught by the platform's TLS
+// destructors (pthread keys, or fiber local storage on Windows), so std::thread and native threads are covered too.
+// The constructor's constexpr, so a static ThreadLocal can be used from other static constructors.
+class ThreadLocalBase
+{
+  DeclareNonCopyable(ThreadLocalBase);
+
+public:
+  typedef void* (*ConstructFunction)();
+  typedef void (*DestructFunction)(void* pValue);
+
+  // destroys the calling thread's values in every ThreadLocal. values created by those destructors are destroyed
+  // in turn, a few rounds deep. called by Thread as it exits.
+  static void ReleaseCurrentThreadValues();
+
+protected:
+  static const uint32 InvalidSlot = 0xFFFFFFFF;
+
+  constexpr ThreadLocalBase(ConstructFunction constructFunction, DestructFunction destructFunction)
+    : m_constructFunction(constructFunction), m_destructFunction(destructFunction), m_slot(InvalidSlot),
+      m_pRecords(nullptr)
+  {
+  }
+  ~ThreadLocalBase();
+
+  // the calling thread's value, created if it has none
+  void* GetValue()
+  {
+    void* pValue = PeekValue();
+    return (pValue != nullptr) ? pValue : CreateValue();
+  }
+
+  // the calling thread's value, or null if it hasn't created one
+  void* PeekValue() const;
+
+  // destroys the calling thread's value, the next GetValue creates another
+  void ReleaseValue();
+
+private:
+  void* CreateValue();
+
+  ConstructFunction m_constructFunction;
+  DestructFunction m_destructFunction;
+  volatile uint32 m_slot;
+
+  // every thread's value, so they can be destroyed along with this
+  ThreadLocalRecord* m_pRecords;
+};
+
+template<class T>
+class ThreadLocal : public ThreadLocalBase
+{
+public:
+  constexpr ThreadLocal() : ThreadLocalBase(&Construct, &Destruct) {}
+  ~ThreadLocal() {}
+
+  T& Get() { return *static_cast<T*>(GetValue()); }
+  T* operator->() { return static_cast<T*>(GetValue()); }
+  T& operator*() { return *static_cast<T*>(GetValue()); }
+
+  // null until the calling thread first calls Get
+  T* Peek() const { return static_cast<T*>(PeekValue()); }
+
+  void Release() { ReleaseValue(); }
+
+private:
+  static void* Construct() { return new T(); }
+  static void Destruct(void* pValue) { delete static_cast<T*>(pValue); }
+};
@@ -1,65 +1,265 @@
 #pragma once
+#include "YBaseLib/CacheAligned.h"
 #include "YBaseLib/Common.h"
 #include "YBaseLib/ConditionVariable.h"
 #include "YBaseLib/Event.h"
 #include "YBaseLib/Mutex.h"
+#include "YBaseLib/NonCopyable.h"
 #include "YBaseLib/PODArray.h"
+#include "YBaseLib/SchedulerStats.h"
 #include "YBaseLib/Thread.h"
+#include "YBaseLib/Timer.h"
+#include "YBaseLib/WorkStealingDeque.h"
+#include "YBaseLib/WorkerIdlePolicy.h"
+
+// Work item priority classes, each has its own queues. Workers take the highest priority work available, except
+// that periodically they look at the lowest priority first, so background work is never starved completely.
+enum THREADPOOL_PRIORITY
+{
+  THREADPOOL_PRIORITY_REALTIME,
+  THREADPOOL_PRIORITY_NORMAL,
+  THREADPOOL_PRIORITY_BACKGROUND,
+  THREADPOOL_PRIORITY_COUNT,
+};
+
+// How worker threads are placed on processors. PER_CORE binds each worker to one physical core and its hyperthread
+// siblings, PER_NODE lets a worker float within one NUMA node, keeping its caches and memory local to that node.
+// Workers are spread evenly over the nodes. DEFAULT uses PER_NODE when there is more than one node, and otherwise
+// leaves the workers to the OS scheduler.
+enum THREADPOOL_AFFINITY
+{
+  THREADPOOL_AFFINITY_DEFAULT,
+  THREADPOOL_AFFINITY_NONE,
+  THREADPOOL_AFFINITY_PER_CORE,
+  THREADPOOL_AFFINITY_PER_NODE,
+};
 
 class ThreadPool;
 class ThreadPoolWorkItem;
 class ThreadPoolWorkerThread;
 
+// A pool of worker threads running work items.
+//
+// With a maxWorkerThreadCount above workerThreadCount the pool is elastic. workerThreadCount workers are always
+// kept, and more are started while queued work outnumbers the workers free to run it, at most one every few
+// milliseconds so a short burst is absorbed rather than met with threads that only retire again. Workers past
+// workerThreadCount retire once they've been idle for the idle timeout. A work item about to block, e.g. on file
+// I/O, can say so with a ThreadPoolBlockingScope, and if that leaves queued work without a worker, another is started
+// straight away to run it.
 class ThreadPool
 {
   friend class ThreadPoolWorkerThread;
 
 public:
-  ThreadPool(uint32 workerThreadCount = GetDefaultWorkerThreadCount());
+  ThreadPool(uint32 workerThreadCount = GetDefaultWorkerThreadCount(),
+             THREADPOOL_AFFINITY affinity = THREADPOOL_AFFINITY_DEFAULT, uint32 maxWorkerThreadCount = 0);
   ~ThreadPool();
 
+  Y_DECLARE_CACHE_ALIGNED_NEW();
+
+  // The number of workers the pool always has, which is what it's sized for. Work is split by this count, an
+  // elastic pool's extra workers only make up for blocked workers and backlogs.
   const uint32 GetWorkerThreadCount() const { return m_nWorkerThreads; }
 
-  // queues a work item
+  // the most workers an elastic pool grows to, the same as the worker count otherwise
+  uint32 GetMaxWorkerThreadCount() const { return m_maxWorkerThreads; }
+  bool IsElastic() const { return (m_maxWorkerThreads > m_nWorkerThreads); }
+
+  // workers with a thread at the moment, including those blocked or idle
+  uint32 GetRunningWorkerThreadCount() const { return m_runningWorkerCount; }
+
+  // how long a worker past the worker count waits for work before retiring, 10 seconds by default
+  uint32 GetIdleTimeout() const { return m_idleTimeout; }
+  void SetIdleTimeout(uint32 milliseconds);
+
+  // Marks the calling worker as blocked until the matching end, see ThreadPoolBlockingScope. Does nothing on threads
+  // that aren't pool workers. Regions can be nested, only the outermost counts.
+  static void BeginBlockingRegion();
+  static void EndBlockingRegion();
+
+  // placement the workers were started with, never DEFAULT
+  const THREADPOOL_AFFINITY GetAffinity() const { return m_affinity; }
+
+  // queues a work item. when called from one of this pool's worker threads the item is pushed
+  // to that worker's local deque, otherwise it is placed in the global injection queue.
   void EnqueueWorkItem(ThreadPoolWorkItem* pWorkItem);
 
+  // queues several work items at once, taking the injection queue lock once and waking at most count workers
+  void EnqueueWorkItems(ThreadPoolWorkItem** ppWorkItems, uint32 count);
+
   // allows a work item to yield, ie checks if there are any pending tasks of
-  // higher priority, allowing them to preempt this task
+  // higher priority, allowing them to preempt this task. items past their deadline count as higher priority.
+  // when called from outside the pool, returns true if any work is pending.
   bool ShouldYieldToOtherTask();
 
+  // how workers wait when they run out of work, defaults to parking straight away
+  const WorkerIdlePolicy& GetIdlePolicy() const { return m_idlePolicy; }
+  void SetIdlePolicy(const WorkerIdlePolicy& policy);
+
+  // sum of every worker's idle counters
+  WorkerIdleStats GetIdleStats() const;
+
+  // per-item queue time and execution time counters, off by default. enabling them costs a timer read when an
+  // item is queued and two when it runs.
+  bool IsStatsEnabled() const { return m_statsEnabled; }
+  void SetStatsEnabled(bool enabled);
+
+  // snapshot of the counters, summed over every worker
+  SchedulerStats GetStats() const;
+
+  // number of items queued but not started yet
+  uint32 GetQueueDepth() const;
+
 private:
+  // one set of queues for each priority class
+  struct PriorityQueue
+  {
+    // global injection queue, used for items queued from threads outside the pool.
+    // entries before InjectionQueueHead have already been consumed.
+    PODArray<ThreadPoolWorkItem*> InjectionQueue;
+    uint32 InjectionQueueHead;
+    Y_ATOMIC_DECL uint32 InjectionQueueSize;
+
+    // items with a deadline, min-heap ordered on the deadline
+    PODArray<ThreadPoolWorkItem*> DeadlineHeap;
+
+    // items of this priority queued anywhere in the pool, raised before the item is pushed. every push and pop
+    // writes it, so it's kept off the line with the lock-protected members above, and off the next queue's.
+    Y_CACHE_ALIGNED_DECL volatile uint32 PendingCount;
+  };
+
   void StartWorkerThreads();
   void StopWorkerThreads();
 
+  // Starts a worker in a retired slot, or a slot that hasn't been used yet, if there are fewer than the maximum
+  // running. Assumes the work queue lock is held. Returns false if no worker was started.
+  bool SpawnWorkerThread();
+
+  // starts a worker if queued work is waiting for one, called when nobody is sleeping to take it
+  void GrowForBacklog();
+
   // callback from worker thread method. returns NULL if the thread is to exit.
-  ThreadPoolWorkItem* ThreadGetNextWorkItem();
+  ThreadPoolWorkItem* ThreadGetNextWorkItem(ThreadPoolWorkerThread* pWorkerThread);
+
+  // queues an item from a worker of this pool, or null for any other thread
+  void PushWorkItem(ThreadPoolWorkItem* pWorkItem, ThreadPoolWorkerThread* pWorkerThread);
+
+  // queue access for items that aren't in a worker's deque, assumes the work queue lock is held
+  void PushSharedWorkItem(ThreadPoolWorkItem* pWorkItem);
+  ThreadPoolWorkItem* PopInjectionQueue(uint32 priority);
+  ThreadPoolWorkItem* PopDeadlineHeap(uint32 priority);
 
-  // vars
+  // finds the next item for a worker, returns null if there is nothing queued
+  ThreadPoolWorkItem* FindWorkItem(ThreadPoolWorkerThread* pWorkerThread);
+  ThreadPoolWorkItem* FindWorkItemWithPriority(ThreadPoolWorkerThread* pWorkerThread, uint32 priority);
+
+  // removes the most urgent item whose deadline has passed, assumes the work queue lock is held
+  ThreadPoolWorkItem* PopOverdueWorkItem(Y_TIMER_VALUE currentTime);
+  bool HasOverdueWorkItem();
+
+  // tries to steal an item from another worker's deque, starting at a random victim
+  ThreadPoolWorkItem* StealWorkItem(ThreadPoolWorkerThread* pThief, uint32 priority);
+
+  // returns true if there is any work queued anywhere in the pool
+  bool HasPendingWork() const;
+
+  // wakes up to count sleeping workers
+  void WakeSleepingWorkers(uint32 count);
+
+  // Worker slots, up to the maximum. Workers are never deleted until the pool is, and retired ones have empty deques,
+  // so thieves can look at any slot up to the created count without a lock. Retired slots are restarted first.
   PODArray<ThreadPoolWorkerThread*> m_WorkerThreads;
   uint32 m_nWorkerThreads;
-  bool m_bExitThreads;
-  PODArray<ThreadPoolWorkItem*> m_WorkItemQueue;
-  Mutex m_WorkQueueLock;
+  uint32 m_maxWorkerThreads;
+  volatile uint32 m_createdWorkerCount;
+  THREADPOOL_AFFINITY m_affinity;
+  volatile bool m_bExitThreads;
+
+  // queues for each priority, and the number of items in the deadline heaps
+  PriorityQueue m_priorityQueues[THREADPOOL_PRIORITY_COUNT];
+  Y_ATOMIC_DECL uint32 m_deadlineItemCount;
+
+  // protects the injection queues, deadline heaps and worker sleep/wake. on its own line, away from the counters
+  // workers read without it.
+  Y_CACHE_ALIGNED_DECL Mutex m_WorkQueueLock;
   ConditionVariable m_WorkQueueConditionVariable;
 
-  // todo: lock-free queue
+  // idle behaviour, and when a sleeping worker was last woken for work. the wake time is protected by the lock.
+  WorkerIdlePolicy m_idlePolicy;
+  Y_TIMER_VALUE m_lastWakeRequestTime;
+
+  // scheduler stats, and when they were first enabled
+  volatile bool m_statsEnabled;
+  Y_TIMER_VALUE m_statsStartTime;
+
+  // elastic pools. the running count only changes with the lock held, the blocked count is a hint kept without it.
+  volatile uint32 m_runningWorkerCount;
+  Y_ATOMIC_DECL uint32 m_blockedWorkerCount;
+  uint32 m_idleTimeout;
+  Y_TIMER_VALUE m_lastSpawnTime;
+
+  // checked by every thread that queues work, on a cache line of its own
+  Y_CACHE_ALIGNED_DECL volatile uint32 m_sleepingWorkerCount;
 
 public:
   // default number of worker threads is max(1, ncpus - 1)
   static uint32 GetDefaultWorkerThreadCount();
+
+  // resolves DEFAULT from the processor topology
+  static THREADPOOL_AFFINITY ResolveAffinity(THREADPOOL_AFFINITY affinity);
+
+  // processors a worker should be bound to, or zero to leave it unbound. also used for task queue workers.
+  static uint64 GetWorkerAffinityMask(THREADPOOL_AFFINITY affinity, uint32 workerIndex, uint32 workerCount);
 };
 
 class ThreadPoolWorkerThread : public Thread
 {
+  friend class ThreadPool;
+
 public:
-  ThreadPoolWorkerThread(ThreadPool* pThreadPool);
+  ThreadPoolWorkerThread(ThreadPool* pThreadPool, uint32 workerIndex, uint64 affinityMask);
   ~ThreadPoolWorkerThread();
 
+  ThreadPool* GetThreadPool() const { return m_pThreadPool; }
+  uint32 GetWorkerIndex() const { return m_workerIndex; }
+
+  // returns the pool worker the calling thread belongs to, or null
+  static ThreadPoolWorkerThread* GetCurrentWorkerThread();
+
 protected:
   virtual int32 ThreadEntryPoint();
 
 private:
+  // xorshift generator for victim selection
+  uint32 NextRandom();
+
   ThreadPool* m_pThreadPool;
+  uint32 m_workerIndex;
+  uint32 m_randomState;
+
+  // processors the worker binds itself to when it starts, zero if unbound
+  uint64 m_affinityMask;
+
+  // number of items this worker has fetched, drives the starvation check
+  uint32 m_fetchCount;
+
+  // priority of the item being run, or THREADPOOL_PRIORITY_COUNT when idle
+  uint32 m_currentPriority;
+
+  // nesting of blocking regions, only touched by this worker
+  uint32 m_blockingDepth;
+
+  // the thread has exited, or is about to, having been idle too long. the slot can be restarted once it's joined.
+  // protected by the pool's work queue lock.
+  bool m_retired;
+  bool m_needsJoin;
+
+  // items queued by this worker, stolen from the top by others
+  WorkStealingDeque<ThreadPoolWorkItem*> m_workDeques[THREADPOOL_PRIORITY_COUNT];
+
+  // only written by this worker
+  WorkerIdleStats m_idleStats;
+  SchedulerWorkerStats m_schedulerStats;
 };
 
 class ThreadPoolWorkItem : public ReferenceCounted
@@ -82,6 +282,18 @@ public:
   const bool IsCompleted() const { return (m_iState == STATE_COMPLETED); }
   const int32 GetReturnValue() const { return m_iReturnValue; }
 
+  // scheduling parameters, these must not be changed while the item is queued
+  const THREADPOOL_PRIORITY GetPriority() const { return static_cast<THREADPOOL_PRIORITY>(m_priority); }
+  void SetPriority(THREADPOOL_PRIORITY priority);
+
+  // items past their deadline are run before anything else, items waiting on a deadline are run first within
+  // their priority, earliest deadline first
+  const bool HasDeadline() const { return m_hasDeadline; }
+  const Y_TIMER_VALUE GetDeadline() const { return m_deadline; }
+  void SetDeadline(Y_TIMER_VALUE deadline);
+  void SetDeadlineFromNow(double milliseconds);
+  void ClearDeadline();
+
 protected:
   // callback methods
   virtual int32 ProcessWork();
@@ -90,6 +302,24 @@ protected:
 private:
   uint32 m_iState;
   int32 m_iReturnValue;
+  uint32 m_priority;
+  bool m_hasDeadline;
+  Y_TIMER_VALUE m_deadline;
+
+  // when the item was last queued, zero if stats were disabled at the time
+  Y_TIMER_VALUE m_queueTime;
+};
+
+// Marks the calling pool worker as blocked for the lifetime of the scope, so an elastic pool can start another worker
+// for queued work in the meantime. Use it around waits that don't need the cpu, e.g. file or network I/O.
+class ThreadPoolBlockingScope
+{
+public:
+  ThreadPoolBlockingScope() { ThreadPool::BeginBlockingRegion(); }
+  ~ThreadPoolBlockingScope() { ThreadPool::EndBlockingRegion(); }
+
+private:
+  DeclareNonCopyable(ThreadPoolBlockingScope);
 };
 
 class ThreadPoolWorkItemSignaled : public ThreadPoolWorkItem
@@ -106,3 +336,33 @@ protected:
 private:
   Event m_CompletionEvent;
 };
+
+// Runs one helper's part of a job several workers take part in at once. The pool keeps an item's state and stats in
+// the item, so it can only be queued once at a time, and each helper needs an item of its own. The item holds a
+// reference to the job, keeping it alive for helpers that only start after the caller is done with it.
+// T is reference counted, with a RunHelper() method.
+template<class T>
+class ThreadPoolHelperWorkItem : public ThreadPoolWorkItem
+{
+public:
+  ThreadPoolHelperWorkItem(T* pJob) : m_pJob(pJob) { m_pJob->AddRef(); }
+  virtual ~ThreadPoolHelperWorkItem() { m_pJob->Release(); }
+
+  // queues another helper for pJob
+  static void Enqueue(ThreadPool* pThreadPool, T* pJob)
+  {
+    ThreadPoolHelperWorkItem* pWorkItem = new ThreadPoolHelperWorkItem(pJob);
+    pThreadPool->EnqueueWorkItem(pWorkItem);
+    pWorkItem->Release();
+  }
+
+protected:
+  virtual int32 ProcessWork() override
+  {
+    m_pJob->RunHelper();
+    return 0;
+  }
+
+private:
+  T* m_pJob;
+};
@@ -15,6 +15,67 @@ double Y_TimerConvertToSeconds(Y_TIMER_VALUE Value);
 double Y_TimerConvertToMilliseconds(Y_TIMER_VALUE Value);
 double Y_TimerConvertToNanoseconds(Y_TIMER_VALUE Value);
 
+// A cheaper timer for fine-grained measurement, reading the cpu's timestamp counter where it ticks at a constant
+// rate (invariant TSC on x86, CNTVCT_EL0 on AArch64), and Y_TimerGetValue everywhere else. Its values don't mix with
+// Y_TimerGetValue's, convert them with the functions below. On x86 the rate is calibrated against the monotonic
+// clock by the first conversion, which waits until 10ms have passed since the timer was first read.
+#if (defined(Y_CPU_X86) || defined(Y_CPU_X64) || defined(Y_CPU_AARCH64)) && !defined(Y_PLATFORM_HTML5)
+#define Y_FAST_TIMER_HAS_CPU_COUNTER 1
+
+#if defined(Y_COMPILER_MSVC) && !defined(Y_CPU_AARCH64)
+extern "C" unsigned __int64 __rdtsc();
+#pragma intrinsic(__rdtsc)
+#elif defined(Y_COMPILER_MSVC)
+extern "C" __int64 _ReadStatusReg(int);
+#pragma intrinsic(_ReadStatusReg)
+#endif
+
+inline Y_TIMER_VALUE Y_ReadCPUCounter()
+{
+#if defined(Y_COMPILER_MSVC) && !defined(Y_CPU_AARCH64)
+  return __rdtsc();
+#elif defined(Y_COMPILER_MSVC)
+  // ARM64_CNTVCT
+  return (Y_TIMER_VALUE)_ReadStatusReg(0x5F02);
+#elif defined(Y_CPU_AARCH64)
+  uint64 value;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+  return value;
+#else
+  uint32 low, high;
+  asm volatile("rdtsc" : "=a"(low), "=d"(high));
+  return ((uint64)high << 32) | low;
+#endif
+}
+
+// unknown until the first read picks one
+enum Y_FAST_TIMER_SOURCE
+{
+  Y_FAST_TIMER_SOURCE_UNKNOWN,
+  Y_FAST_TIMER_SOURCE_CPU_COUNTER,
+  Y_FAST_TIMER_SOURCE_SYSTEM_TIMER,
+};
+extern volatile Y_FAST_TIMER_SOURCE g_fastTimerSource;
+Y_TIMER_VALUE Y_FastTimerGetValueFallback();
+
+inline Y_TIMER_VALUE Y_FastTimerGetValue()
+{
+  if (g_fastTimerSource == Y_FAST_TIMER_SOURCE_CPU_COUNTER)
+    return Y_ReadCPUCounter();
+
+  return Y_FastTimerGetValueFallback();
+}
+#else
+inline Y_TIMER_VALUE Y_FastTimerGetValue() { return Y_TimerGetValue(); }
+#endif
+
+double Y_FastTimerConvertToSeconds(Y_TIMER_VALUE Value);
+double Y_FastTimerConvertToMilliseconds(Y_TIMER_VALUE Value);
+double Y_FastTimerConvertToNanoseconds(Y_TIMER_VALUE Value);
+
+// whether Y_FastTimerGetValue reads the cpu's counter, rather than falling back
+bool Y_FastTimerUsesCPUCounter();
+
 class Timer
 {
 public:
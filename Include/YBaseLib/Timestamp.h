@@ -32,12 +32,19 @@ public:
   UnixTimestampValue AsUnixTimestamp() const;
   ExpandedTime AsExpandedTime() const;
 
+  // the microseconds past the second, which windows only keeps to the millisecond
+  uint32 GetSubSecondMicroseconds() const;
+
   // calculators
   double DifferenceInSeconds(Timestamp& other) const;
   int64 DifferenceInSecondsInt(Timestamp& other) const;
 
   // setters
   void SetNow();
+
+  // Now as the OS's coarse clock has it, which only moves every tick of a few milliseconds, but is read from memory
+  // the kernel keeps updated rather than with a system call, for stamping things at a high rate.
+  void SetNowCoarse();
   void SetUnixTimestamp(UnixTimestampValue value);
   void SetExpandedTime(const ExpandedTime& value);
 
@@ -47,6 +54,7 @@ public:
 
   // creators
   static Timestamp Now();
+  static Timestamp NowCoarse();
   static Timestamp FromUnixTimestamp(UnixTimestampValue value);
   static Timestamp FromExpandedTime(const ExpandedTime& value);
 
@@ -73,3 +81,42 @@ private:
   struct timeval m_value;
 #endif
 };
+
+// Formats timestamps as local time at a high rate, like for stamping log lines. The part down to the second is
+// formatted with strftime once a second and kept, so timestamps within the same second only write their fraction.
+// Each thread formatting needs a formatter of its own.
+class TimestampFormatter
+{
+public:
+  static const uint32 MaxFractionDigits = 6;
+
+  // the strftime format down to the second, and the digits of the fraction to write after it, following a '.'
+  TimestampFormatter(const char* format = "%Y-%m-%d %H:%M:%S", uint32 fractionDigits = 3);
+
+  void SetFormat(const char* format, uint32 fractionDigits);
+
+  // Formats into the formatter's buffer, which stays valid until the next call.
+  const char* Format(const Timestamp& timestamp, uint32* pLength = nullptr);
+
+  // appends to the destination
+  void Format(String& destination, const Timestamp& timestamp);
+
+private:
+  String m_format;
+  uint32 m_fractionDigits;
+
+  // the second the buffer's prefix is for, and how long it is
+  Timestamp::UnixTimestampValue m_prefixSecond;
+  uint32 m_prefixLength;
+  bool m_prefixValid;
+  char m_buffer[128];
+};
+
+// timestamps format as local time, the spec is a strftime format and defaults to "%Y-%m-%d %H:%M:%S"
+namespace TypedFormat {
+template<>
+struct Formatter<Timestamp>
+{
+  static void Format(String& destination, const Timestamp& value, const StringView& spec);
+};
+} // namespace TypedFormat
@@ -0,0 +1,292 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/StringView.h"
+#include <cstddef>
+#include <type_traits>
+
+class String;
+
+// Type-safe formatting, the replacement for the printf-style Format functions.
+//   str.AppendFormat("{} of {} items, {:.1f}% done", done, total, percent);
+// A placeholder is {} for the next argument or {n} for argument n, optionally followed by a spec after a colon:
+//   [[fill]align][+][#][0][width][.precision][type]
+// align is one of < > ^, type is d x X b o for integers, f e g for floating point, s for strings, c for characters
+// and p for pointers. {{ and }} are literal braces. Floating point values without a precision are written so they
+// read back to the same value, nearly always with the fewest digits that do.
+// Arguments are gathered into an array on the stack, and the output is appended to the destination in one pass,
+// without measuring it first. Types without a built-in conversion fail to compile, unless Formatter is specialized:
+//   namespace TypedFormat {
+//   template<> struct Formatter<Vector3>
+//   {
+//     static void Format(String& destination, const Vector3& value, const StringView& spec);
+//   };
+//   }
+// The spec of a custom type is passed through untouched. Y_CHECK_FORMAT checks a literal format string against its
+// arguments at compile time, the Log_*Fmt macros do this for every call.
+namespace TypedFormat {
+enum ARGUMENT_TYPE
+{
+  ARGUMENT_TYPE_NONE,
+  ARGUMENT_TYPE_BOOL,
+  ARGUMENT_TYPE_CHARACTER,
+  ARGUMENT_TYPE_SIGNED,
+  ARGUMENT_TYPE_UNSIGNED,
+  ARGUMENT_TYPE_FLOAT,
+  ARGUMENT_TYPE_DOUBLE,
+  ARGUMENT_TYPE_STRING,
+  ARGUMENT_TYPE_POINTER,
+  ARGUMENT_TYPE_CUSTOM
+};
+
+typedef void (*CustomFormatFunction)(String& destination, const void* pValue, const StringView& spec);
+
+// one argument with its type erased, these only live for the duration of a call
+struct Argument
+{
+  struct StringValue
+  {
+    const char* pData;
+    uint32 Length;
+  };
+  struct CustomValue
+  {
+    const void* pValue;
+    CustomFormatFunction pFunction;
+  };
+
+  ARGUMENT_TYPE Type;
+  union
+  {
+    int64 Signed;
+    uint64 Unsigned;
+    double Double;
+    const void* Pointer;
+    StringValue Text;
+    CustomValue Custom;
+  };
+};
+
+inline Argument MakeSignedArgument(ARGUMENT_TYPE type, int64 value)
+{
+  Argument argument;
+  argument.Type = type;
+  argument.Signed = value;
+  return argument;
+}
+inline Argument MakeUnsignedArgument(ARGUMENT_TYPE type, uint64 value)
+{
+  Argument argument;
+  argument.Type = type;
+  argument.Unsigned = value;
+  return argument;
+}
+inline Argument MakeDoubleArgument(ARGUMENT_TYPE type, double value)
+{
+  Argument argument;
+  argument.Type = type;
+  argument.Double = value;
+  return argument;
+}
+inline Argument MakePointerArgument(const void* value)
+{
+  Argument argument;
+  argument.Type = ARGUMENT_TYPE_POINTER;
+  argument.Pointer = value;
+  return argument;
+}
+inline Argument MakeStringArgument(const char* pData, uint32 length)
+{
+  Argument argument;
+  argument.Type = ARGUMENT_TYPE_STRING;
+  argument.Text.pData = pData;
+  argument.Text.Length = length;
+  return argument;
+}
+inline Argument MakeCustomArgument(const void* pValue, CustomFormatFunction pFunction)
+{
+  Argument argument;
+  argument.Type = ARGUMENT_TYPE_CUSTOM;
+  argument.Custom.pValue = pValue;
+  argument.Custom.pFunction = pFunction;
+  return argument;
+}
+
+// specialize for types that should be formattable, Enable allows partial specializations with enable_if
+template<typename T, typename Enable = void>
+struct Formatter;
+
+template<typename T>
+void FormatCustomArgument(String& destination, const void* pValue, const StringView& spec)
+{
+  Formatter<T>::Format(destination, *static_cast<const T*>(pValue), spec);
+}
+
+// conversion from a value to an argument, anything not handled here goes through Formatter
+template<typename T, typename Enable = void>
+struct ArgumentTraits
+{
+  static Argument Make(const T& value) { return MakeCustomArgument(&value, &FormatCustomArgument<T>); }
+};
+
+template<>
+struct ArgumentTraits<bool>
+{
+  static Argument Make(bool value) { return MakeUnsignedArgument(ARGUMENT_TYPE_BOOL, value ? 1 : 0); }
+};
+
+template<>
+struct ArgumentTraits<char>
+{
+  static Argument Make(char value) { return MakeSignedArgument(ARGUMENT_TYPE_CHARACTER, value); }
+};
+
+// int8 and uint8 are written as numbers, only char is a character
+template<typename T>
+struct ArgumentTraits<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value &&
+                                                 !std::is_same<T, char>::value>::type>
+{
+  static Argument Make(T value) { return MakeSignedArgument(ARGUMENT_TYPE_SIGNED, int64(value)); }
+};
+
+template<typename T>
+struct ArgumentTraits<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value &&
+                                                 !std::is_same<T, bool>::value && !std::is_same<T, char>::value>::type>
+{
+  static Argument Make(T value) { return MakeUnsignedArgument(ARGUMENT_TYPE_UNSIGNED, uint64(value)); }
+};
+
+template<typename T>
+struct ArgumentTraits<T, typename std::enable_if<std::is_enum<T>::value>::type>
+{
+  static Argument Make(T value)
+  {
+    typedef typename std::underlying_type<T>::type UnderlyingType;
+    return ArgumentTraits<UnderlyingType>::Make(UnderlyingType(value));
+  }
+};
+
+template<>
+struct ArgumentTraits<float>
+{
+  static Argument Make(float value) { return MakeDoubleArgument(ARGUMENT_TYPE_FLOAT, value); }
+};
+
+template<>
+struct ArgumentTraits<double>
+{
+  static Argument Make(double value) { return MakeDoubleArgument(ARGUMENT_TYPE_DOUBLE, value); }
+};
+
+template<>
+struct ArgumentTraits<long double>
+{
+  static Argument Make(long double value) { return MakeDoubleArgument(ARGUMENT_TYPE_DOUBLE, double(value)); }
+};
+
+template<>
+struct ArgumentTraits<const char*>
+{
+  static Argument Make(const char* value)
+  {
+    return (value != nullptr) ? MakeStringArgument(value, Y_strlen(value)) : MakeStringArgument("(null)", 6);
+  }
+};
+
+template<>
+struct ArgumentTraits<char*> : public ArgumentTraits<const char*>
+{
+};
+
+// literals and character buffers, the string stops at the terminator
+template<size_t N>
+struct ArgumentTraits<char[N]>
+{
+  static Argument Make(const char (&value)[N]) { return MakeStringArgument(value, Y_strlen(value)); }
+};
+
+template<>
+struct ArgumentTraits<StringView>
+{
+  static Argument Make(const StringView& value) { return MakeStringArgument(value.GetData(), value.GetLength()); }
+};
+
+template<typename T>
+struct ArgumentTraits<T*>
+{
+  static Argument Make(const T* value) { return MakePointerArgument(value); }
+};
+
+template<>
+struct ArgumentTraits<std::nullptr_t>
+{
+  static Argument Make(std::nullptr_t) { return MakePointerArgument(nullptr); }
+};
+
+template<typename T>
+inline Argument MakeArgument(const T& value)
+{
+  return ArgumentTraits<T>::Make(value);
+}
+
+// appends the formatted text to destination. a placeholder without an argument is written out as it is.
+void AppendFormatted(String& destination, const StringView& format, const Argument* pArguments,
+                     uint32 argumentCount);
+
+// true if every placeholder is well formed and refers to an argument, and every argument is used
+constexpr bool IsFormatValid(const char* format, uint32 argumentCount)
+{
+  uint32 nextIndex = 0;
+  uint64 usedMask = 0;
+  for (const char* p = format; *p != '\0'; p++)
+  {
+    if (*p == '}')
+    {
+      if (*(++p) != '}')
+        return false;
+      continue;
+    }
+    if (*p != '{')
+      continue;
+    if (*(++p) == '{')
+      continue;
+
+    uint32 index = nextIndex;
+    if (*p >= '0' && *p <= '9')
+    {
+      index = 0;
+      for (; *p >= '0' && *p <= '9'; p++)
+        index = index * 10 + uint32(*p - '0');
+    }
+    else
+    {
+      nextIndex++;
+    }
+
+    if (*p == ':')
+    {
+      while (*p != '}' && *p != '{' && *p != '\0')
+        p++;
+    }
+    if (*p != '}' || index >= argumentCount)
+      return false;
+    if (index < 64)
+      usedMask |= uint64(1) << index;
+  }
+
+  return (argumentCount >= 64 || usedMask == (uint64(1) << argumentCount) - 1);
+}
+
+// only used in unevaluated contexts, to count the arguments of a macro
+template<typename... Args>
+char (&CountArguments(const Args&...))[sizeof...(Args)];
+} // namespace TypedFormat
+
+// Y_CHECK_FORMAT(format, args...) fails to compile if a literal format string doesn't match its arguments.
+// the arguments are not evaluated.
+#define Y_FORMAT_EXPAND(x) x
+#define Y_FORMAT_FIRST_ARGUMENT_(first, ...) first
+#define Y_FORMAT_FIRST_ARGUMENT(...) Y_FORMAT_EXPAND(Y_FORMAT_FIRST_ARGUMENT_(__VA_ARGS__, 0))
+#define Y_CHECK_FORMAT(...)                                                                                            \
+  static_assert(TypedFormat::IsFormatValid(Y_FORMAT_FIRST_ARGUMENT(__VA_ARGS__),                                       \
+                                           uint32(sizeof(TypedFormat::CountArguments(__VA_ARGS__)) - 1)),              \
+                "format string does not match its arguments")
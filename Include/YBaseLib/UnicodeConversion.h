@@ -0,0 +1,97 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/StringView.h"
+
+class String;
+
+// Conversions between UTF-8, UTF-16 and UTF-32, for text going to and from APIs that don't take UTF-8. Input is
+// always validated: overlong forms, encoded surrogates, unpaired surrogates and code points past U+10FFFF are errors,
+// nothing is replaced. Runs of ASCII are checked and widened or narrowed 16 characters at a time with SSE2 or NEON.
+// Lengths are in code units of the type concerned, and nothing is null-terminated unless stated.
+namespace UnicodeConversion {
+// returned by the length and conversion functions when the input isn't valid
+static const uint32 InvalidLength = 0xFFFFFFFF;
+
+// Returns true if the text is well-formed. If it isn't, *pErrorOffset is set to the code unit the first bad sequence
+// starts at.
+bool ValidateUTF8(const char* pText, uint32 length, uint32* pErrorOffset = NULL);
+bool ValidateUTF16(const char16_t* pText, uint32 length, uint32* pErrorOffset = NULL);
+bool ValidateUTF32(const char32_t* pText, uint32 length, uint32* pErrorOffset = NULL);
+
+// length of the text once converted, without converting it, or InvalidLength if it isn't well-formed
+uint32 GetUTF16Length(const char* pText, uint32 length);
+uint32 GetUTF32Length(const char* pText, uint32 length);
+uint32 GetUTF8Length(const char16_t* pText, uint32 length);
+uint32 GetUTF8Length(const char32_t* pText, uint32 length);
+
+// Convert into a caller-supplied buffer and return the number of code units written. Returns InvalidLength if the
+// source isn't well-formed or doesn't fit, the buffer then holds whatever was converted before that point.
+// UTF-8 never needs more UTF-16 or UTF-32 code units than it has bytes.
+uint32 UTF8ToUTF16(char16_t* pDestination, uint32 destinationLength, const char* pSource, uint32 sourceLength);
+uint32 UTF8ToUTF32(char32_t* pDestination, uint32 destinationLength, const char* pSource, uint32 sourceLength);
+uint32 UTF16ToUTF8(char* pDestination, uint32 destinationLength, const char16_t* pSource, uint32 sourceLength);
+uint32 UTF32ToUTF8(char* pDestination, uint32 destinationLength, const char32_t* pSource, uint32 sourceLength);
+
+// Append converted text to a string, a StackString keeps short text off the heap. Returns false if the source isn't
+// well-formed, and leaves the string as it was.
+bool AppendUTF16(String& destination, const char16_t* pSource, uint32 sourceLength);
+bool AppendUTF32(String& destination, const char32_t* pSource, uint32 sourceLength);
+} // namespace UnicodeConversion
+
+// A null-terminated UTF-16 copy of UTF-8 text, for passing paths to the wide Windows APIs. Text of up to SIZE code
+// units is converted into the object, only longer text goes on the heap. Text that isn't valid UTF-8 converts to an
+// empty string, which the file APIs fail on like any other bad path.
+//   UTF16StackString<MAX_PATH> widePath(path);
+//   DWORD attributes = GetFileAttributesW(widePath.GetWideCharArray());
+template<uint32 SIZE>
+class UTF16StackString
+{
+public:
+  UTF16StackString(const StringView& text) : m_pData(m_buffer), m_length(0), m_valid(true)
+  {
+    // no length pass when it's known to fit
+    uint32 length = text.GetLength();
+    if (length > SIZE)
+    {
+      length = UnicodeConversion::GetUTF16Length(text.GetData(), text.GetLength());
+      if (length > SIZE && length != UnicodeConversion::InvalidLength)
+        m_pData = static_cast<char16_t*>(Y_mallocarray(length + 1, sizeof(char16_t)));
+    }
+
+    if (length != UnicodeConversion::InvalidLength)
+      m_length = UnicodeConversion::UTF8ToUTF16(m_pData, Max(length, SIZE), text.GetData(), text.GetLength());
+    if (length == UnicodeConversion::InvalidLength || m_length == UnicodeConversion::InvalidLength)
+    {
+      m_length = 0;
+      m_valid = false;
+    }
+
+    m_pData[m_length] = 0;
+  }
+
+  ~UTF16StackString()
+  {
+    if (m_pData != m_buffer)
+      Y_free(m_pData);
+  }
+
+  // false if the text wasn't valid UTF-8
+  bool IsValid() const { return m_valid; }
+
+  uint32 GetLength() const { return m_length; }
+  const char16_t* GetCharArray() const { return m_pData; }
+
+#ifdef Y_PLATFORM_WINDOWS
+  // wchar_t is UTF-16 on Windows
+  const wchar_t* GetWideCharArray() const { return reinterpret_cast<const wchar_t*>(m_pData); }
+#endif
+
+private:
+  char16_t m_buffer[SIZE + 1];
+  char16_t* m_pData;
+  uint32 m_length;
+  bool m_valid;
+
+  DeclareNonCopyable(UTF16StackString);
+};
@@ -0,0 +1,186 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/NonCopyable.h"
+#include "YBaseLib/Platform.h"
+#include <new>
+#include <utility>
+
+// Array of up to a fixed number of elements, in address space reserved for all of them up front, with memory
+// committed behind it as it grows. Elements never move, so pointers to them stay good for as long as they're in
+// the array, and growing never copies what's there. Unused address space is free, so the maximum can be generous:
+// a 64-bit process can reserve terabytes.
+//
+// Memory is committed at least CommitGranularity bytes at a time, or in 2MB steps with FLAG_HUGE_PAGES, which also
+// lets Linux back the array with transparent huge pages. FLAG_NUMA_LOCAL keeps the memory on the constructing
+// thread's node. Shrink gives back what's above the elements. Going past the maximum, or committing failing, panics,
+// as running out of heap does. Not thread-safe.
+template<class T>
+class VirtualArray
+{
+public:
+  enum FLAGS
+  {
+    FLAG_HUGE_PAGES = Y_MALLOC_FLAG_HUGE_PAGES,
+    FLAG_NUMA_LOCAL = Y_MALLOC_FLAG_NUMA_LOCAL,
+  };
+
+  static const size_t CommitGranularity = 64 * 1024;
+  static const size_t HugePageCommitGranularity = 2 * 1024 * 1024;
+
+  VirtualArray(uint32 maxSize, uint32 flags = 0) : m_size(0), m_maxSize(maxSize), m_committedBytes(0)
+  {
+    size_t pageSize = Platform::GetVirtualMemoryPageSize();
+    m_commitGranularity = RoundUp(CommitGranularity, pageSize);
+    if (flags & FLAG_HUGE_PAGES)
+      m_commitGranularity = RoundUp(HugePageCommitGranularity, pageSize);
+
+    m_reservedBytes = RoundUp(Max(static_cast<size_t>(maxSize) * sizeof(T), static_cast<size_t>(1)), pageSize);
+
+    m_pElements = static_cast<T*>(Platform::ReserveVirtualMemory(m_reservedBytes, flags));
+    if (m_pElements == nullptr)
+      Panic("VirtualArray: failed to reserve address space");
+  }
+
+  ~VirtualArray()
+  {
+    Clear();
+    Platform::ReleaseVirtualMemory(m_pElements, m_reservedBytes);
+  }
+
+  uint32 GetSize() const { return m_size; }
+  uint32 GetMaxSize() const { return m_maxSize; }
+  bool IsEmpty() const { return (m_size == 0); }
+
+  // memory behind the array, as opposed to the address space it has reserved
+  size_t GetCommittedBytes() const { return m_committedBytes; }
+  size_t GetReservedBytes() const { return m_reservedBytes; }
+
+  T& Add(const T& value)
+  {
+    EnsureCommitted(m_size + 1);
+    T* pElement = new (&m_pElements[m_size]) T(value);
+    m_size++;
+    return *pElement;
+  }
+
+  template<class... Args>
+  T& Emplace(Args&&... args)
+  {
+    EnsureCommitted(m_size + 1);
+    T* pElement = new (&m_pElements[m_size]) T(std::forward<Args>(args)...);
+    m_size++;
+    return *pElement;
+  }
+
+  void AddRange(const T* pValues, uint32 count)
+  {
+    EnsureCommitted(m_size + count);
+    for (uint32 i = 0; i < count; i++)
+      new (&m_pElements[m_size + i]) T(pValues[i]);
+    m_size += count;
+  }
+
+  // new elements are default constructed
+  void Resize(uint32 newSize)
+  {
+    if (newSize > m_size)
+    {
+      EnsureCommitted(newSize);
+      for (uint32 i = m_size; i < newSize; i++)
+        new (&m_pElements[i]) T();
+    }
+    else
+    {
+      for (uint32 i = newSize; i < m_size; i++)
+        m_pElements[i].~T();
+    }
+
+    m_size = newSize;
+  }
+
+  void RemoveBack()
+  {
+    DebugAssert(m_size > 0);
+    m_size--;
+    m_pElements[m_size].~T();
+  }
+
+  T PopBack()
+  {
+    DebugAssert(m_size > 0);
+    T value(std::move(m_pElements[m_size - 1]));
+    RemoveBack();
+    return value;
+  }
+
+  // keeps the memory committed, so the array fills again without committing
+  void Clear() { Resize(0); }
+
+  // gives back the memory above the elements
+  void Shrink()
+  {
+    size_t neededBytes = RoundUp(static_cast<size_t>(m_size) * sizeof(T), m_commitGranularity);
+    if (neededBytes >= m_committedBytes)
+      return;
+
+    Platform::DecommitVirtualMemory(reinterpret_cast<byte*>(m_pElements) + neededBytes,
+                                    m_committedBytes - neededBytes);
+    m_committedBytes = neededBytes;
+  }
+
+  const T* GetBasePointer() const { return m_pElements; }
+  T* GetBasePointer() { return m_pElements; }
+
+  const T& operator[](uint32 index) const
+  {
+    DebugAssert(index < m_size);
+    return m_pElements[index];
+  }
+  T& operator[](uint32 index)
+  {
+    DebugAssert(index < m_size);
+    return m_pElements[index];
+  }
+
+  const T& LastElement() const { return (*this)[m_size - 1]; }
+  T& LastElement() { return (*this)[m_size - 1]; }
+
+  const T* begin() const { return m_pElements; }
+  const T* end() const { return m_pElements + m_size; }
+  T* begin() { return m_pElements; }
+  T* end() { return m_pElements + m_size; }
+
+private:
+  static size_t RoundUp(size_t value, size_t multiple) { return ((value + multiple - 1) / multiple) * multiple; }
+
+  void EnsureCommitted(uint32 count)
+  {
+    if (count > m_maxSize)
+      Panic("VirtualArray: maximum size exceeded");
+
+    size_t neededBytes = static_cast<size_t>(count) * sizeof(T);
+    if (neededBytes <= m_committedBytes)
+      return;
+
+    // commit in whole steps, and no further than the reservation
+    size_t newCommittedBytes = Min(RoundUp(neededBytes, m_commitGranularity), m_reservedBytes);
+    if (!Platform::CommitVirtualMemory(reinterpret_cast<byte*>(m_pElements) + m_committedBytes,
+                                       newCommittedBytes - m_committedBytes))
+    {
+      Panic("VirtualArray: failed to commit memory");
+    }
+
+    m_committedBytes = newCommittedBytes;
+  }
+
+  T* m_pElements;
+  uint32 m_size;
+  uint32 m_maxSize;
+  size_t m_reservedBytes;
+  size_t m_committedBytes;
+  size_t m_commitGranularity;
+
+  DeclareNonCopyable(VirtualArray);
+};
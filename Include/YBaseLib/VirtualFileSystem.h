@@ -0,0 +1,156 @@
+#pragma once
+#include "YBaseLib/Array.h"
+#include "YBaseLib/BloomFilter.h"
+#include "YBaseLib/CIStringHashTable.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/ReadWriteLock.h"
+#include "YBaseLib/String.h"
+
+class BinaryBlob;
+class ByteStream;
+class ThreadPool;
+class ZipArchive;
+
+// One namespace made of directories, zip archives and in-memory packs mounted at paths within it. Where mounts hold
+// the same path, the one with the highest priority wins, and of those the one mounted last. Everything mounted is
+// listed as it's mounted into a single table of paths, so resolving a path is one hash lookup rather than a probe of
+// each mount in turn. Directory mounts are listed once, call Refresh if files are added to or removed from them.
+// Paths use '/' separators and are compared without regard to case, with '.' and '..' resolved within the namespace.
+// Lookups can run on any number of threads at once, mounting and refreshing wait for them to finish. Streams opened
+// from an archive are only as thread safe as ZipArchive, and archives must outlive their mounts.
+//   VirtualFileSystem vfs;
+//   vfs.MountDirectory("", "data");
+//   vfs.MountArchive("", pPatchArchive, 1);
+//   ByteStream* pStream = vfs.OpenFile("textures/stone.png", BYTESTREAM_OPEN_READ);
+class VirtualFileSystem
+{
+public:
+  enum MOUNT_TYPE
+  {
+    MOUNT_TYPE_DIRECTORY,
+    MOUNT_TYPE_ARCHIVE,
+    MOUNT_TYPE_MEMORY,
+  };
+
+  VirtualFileSystem();
+  ~VirtualFileSystem();
+
+  // Mounts return an id to unmount with, never 0, or 0 if the source can't be read. An empty mount point mounts at
+  // the root.
+  uint32 MountDirectory(const char* mountPoint, const char* directoryPath, int32 priority = 0,
+                        ThreadPool* pThreadPool = nullptr);
+#ifdef HAVE_ZLIB
+  uint32 MountArchive(const char* mountPoint, ZipArchive* pArchive, int32 priority = 0);
+#endif
+
+  // an empty pack to be filled with AddMemoryFile
+  uint32 MountMemory(const char* mountPoint, int32 priority = 0);
+
+  // adds or replaces a file in a memory mount, holding a reference to the blob
+  bool AddMemoryFile(uint32 mountID, const char* path, BinaryBlob* pBlob);
+
+  bool Unmount(uint32 mountID);
+  void UnmountAll();
+
+  // lists directory and archive mounts again
+  void Refresh(ThreadPool* pThreadPool = nullptr);
+
+  // files and directories in the namespace, not counting the root
+  uint32 GetEntryCount() const;
+
+  // names in FindFiles results are virtual paths
+  bool FindFiles(const char* path, const char* pattern, uint32 flags, FileSystem::FindResultsArray* pResults) const;
+  bool StatFile(const char* path, FILESYSTEM_STAT_DATA* pStatData) const;
+  bool FileExists(const char* path) const;
+  bool DirectoryExists(const char* path) const;
+
+  // files can only be opened for reading, write through the mount's source and Refresh
+  ByteStream* OpenFile(const char* path, uint32 openMode) const;
+
+  // Finds the mount a path comes from, and its path there, which is a full path for directory mounts. Directories
+  // that are only there to lead to mount points come from no mount, with an id of 0 and an empty path.
+  bool ResolvePath(const char* path, uint32* pMountID, MOUNT_TYPE* pMountType, String* pSourcePath) const;
+
+private:
+  static const uint32 InvalidIndex = 0xFFFFFFFF;
+  static const uint32 RootEntry = 0;
+
+  // a file or directory as its mount lists it, with a path relative to the mount point
+  struct MountEntry
+  {
+    String Path;
+    FILESYSTEM_STAT_DATA StatData;
+
+    // the name as the archive has it
+    String SourceName;
+
+    // the contents of a memory file
+    BinaryBlob* pBlob;
+  };
+
+  struct Mount
+  {
+    // releases the memory files
+    ~Mount();
+
+    uint32 ID;
+    MOUNT_TYPE Type;
+    String MountPoint;
+    int32 Priority;
+    String DirectoryPath;
+    ZipArchive* pArchive;
+    Array<MountEntry> Entries;
+  };
+
+  // one path in the namespace, children are linked through their siblings
+  struct Entry
+  {
+    String Path;
+    uint32 NameOffset;
+    FILESYSTEM_STAT_DATA StatData;
+
+    // position in m_mounts of the mount this comes from, and the entry there
+    uint32 MountIndex;
+    uint32 MountEntryIndex;
+
+    uint32 Parent;
+    uint32 FirstChild;
+    uint32 NextSibling;
+  };
+
+  // takes the lock to add a mount that has been listed
+  uint32 AddMount(Mount* pMount);
+
+  // reads a directory or archive's contents into its entries, with the lock held once the mount has been added
+  bool ListMount(Mount* pMount, ThreadPool* pThreadPool);
+
+  // the rest are called with m_lock held exclusively, or shared for the const ones
+
+  // builds the table from every mount's entries
+  void RebuildTable();
+
+  // adds a mount's entry to the table, unless a later mount already has the path
+  void InsertEntry(uint32 mountIndex, uint32 mountEntryIndex);
+
+  // sizes the path filter for twice the table, or a few hundred paths, and refills it from the members' hashes
+  void RebuildPathFilter();
+
+  uint32 FindEntry(const String& path) const;
+  uint32 GetOrCreateEntry(const String& path);
+  void ResetEntries();
+
+  uint32 FindMountIndex(uint32 mountID) const;
+
+  mutable ReadWriteLock m_lock;
+  PODArray<Mount*> m_mounts;
+  uint32 m_nextMountID;
+  Array<Entry> m_entries;
+  CIStringHashTable<uint32> m_pathTable;
+
+  // most lookups that miss are turned away here, without walking a bucket of the table
+  BloomFilter m_pathFilter;
+
+  DeclareNonCopyable(VirtualFileSystem);
+};
@@ -1,20 +1,33 @@
 #pragma once
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Common.h"
+#include "YBaseLib/LockProfiler.h"
 #include "YBaseLib/Windows/WindowsHeaders.h"
 
+// With a spin count the mutex is adaptive, spinning that many times before it blocks, as critical sections do.
 class Mutex
 {
   friend class ConditionVariable;
 
 public:
-  Mutex() { InitializeCriticalSection(&m_CriticalSection); }
+  Mutex(uint32 spinCount = 0) { InitializeCriticalSectionAndSpinCount(&m_CriticalSection, spinCount); }
 
   ~Mutex() { DeleteCriticalSection(&m_CriticalSection); }
 
   void Lock()
   {
-    EnterCriticalSection(&m_CriticalSection);
+#if Y_LOCK_PROFILING
+    if (m_profile.IsEnabled())
+    {
+      m_profile.Acquire([this]() { return (TryEnterCriticalSection(&m_CriticalSection) == TRUE); },
+                        [this]() { EnterCriticalSection(&m_CriticalSection); });
+    }
+    else
+#endif
+    {
+      EnterCriticalSection(&m_CriticalSection);
+    }
+
     DebugAssert(m_CriticalSection.RecursionCount == 1);
   }
 
@@ -23,6 +36,9 @@ public:
     if (TryEnterCriticalSection(&m_CriticalSection) == TRUE)
     {
       DebugAssert(m_CriticalSection.RecursionCount == 1);
+#if Y_LOCK_PROFILING
+      m_profile.OnTryAcquired();
+#endif
       return true;
     }
 
@@ -32,9 +48,26 @@ public:
   void Unlock()
   {
     DebugAssert(m_CriticalSection.RecursionCount == 1);
+#if Y_LOCK_PROFILING
+    m_profile.Release();
+#endif
     LeaveCriticalSection(&m_CriticalSection);
   }
 
+  // counts this lock under name with LockProfiler, when built with Y_LOCK_PROFILING
+  void SetProfileName(const char* name)
+  {
+#if Y_LOCK_PROFILING
+    m_profile.SetName(name);
+#else
+    UNREFERENCED_PARAMETER(name);
+#endif
+  }
+
 private:
   CRITICAL_SECTION m_CriticalSection;
+
+#if Y_LOCK_PROFILING
+  LockProfile m_profile;
+#endif
 };
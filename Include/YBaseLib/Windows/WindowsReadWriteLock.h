@@ -1,5 +1,6 @@
 #pragma once
 #include "YBaseLib/Common.h"
+#include "YBaseLib/LockProfiler.h"
 #include "YBaseLib/Windows/WindowsHeaders.h"
 
 class ReadWriteLock
@@ -21,6 +22,20 @@ public:
 
   void UpgradeSharedLockToExclusive();
 
+  // counts this lock under name with LockProfiler, when built with Y_LOCK_PROFILING
+  void SetProfileName(const char* name)
+  {
+#if Y_LOCK_PROFILING
+    m_profile.SetName(name);
+#else
+    UNREFERENCED_PARAMETER(name);
+#endif
+  }
+
 private:
   SRWLOCK m_ReadWriteLock;
+
+#if Y_LOCK_PROFILING
+  LockProfile m_profile;
+#endif
 };
@@ -1,6 +1,7 @@
 #pragma once
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Common.h"
+#include "YBaseLib/LockProfiler.h"
 #include "YBaseLib/Windows/WindowsHeaders.h"
 
 class RecursiveMutex
@@ -14,7 +15,18 @@ public:
 
   void Lock()
   {
-    EnterCriticalSection(&m_CriticalSection);
+#if Y_LOCK_PROFILING
+    if (m_profile.IsEnabled())
+    {
+      m_profile.Acquire([this]() { return (TryEnterCriticalSection(&m_CriticalSection) == TRUE); },
+                        [this]() { EnterCriticalSection(&m_CriticalSection); });
+    }
+    else
+#endif
+    {
+      EnterCriticalSection(&m_CriticalSection);
+    }
+
     DebugAssert(m_CriticalSection.RecursionCount >= 1);
   }
 
@@ -23,6 +35,9 @@ public:
     if (TryEnterCriticalSection(&m_CriticalSection) == TRUE)
     {
       DebugAssert(m_CriticalSection.RecursionCount >= 1);
+#if Y_LOCK_PROFILING
+      m_profile.OnTryAcquired();
+#endif
       return true;
     }
 
@@ -32,9 +47,26 @@ public:
   void Unlock()
   {
     DebugAssert(m_CriticalSection.RecursionCount >= 1);
+#if Y_LOCK_PROFILING
+    m_profile.Release();
+#endif
     LeaveCriticalSection(&m_CriticalSection);
   }
 
+  // counts this lock under name with LockProfiler, when built with Y_LOCK_PROFILING
+  void SetProfileName(const char* name)
+  {
+#if Y_LOCK_PROFILING
+    m_profile.SetName(name);
+#else
+    UNREFERENCED_PARAMETER(name);
+#endif
+  }
+
 private:
   CRITICAL_SECTION m_CriticalSection;
+
+#if Y_LOCK_PROFILING
+  LockProfile m_profile;
+#endif
 };
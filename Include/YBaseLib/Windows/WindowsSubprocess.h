@@ -6,6 +6,9 @@
 class Subprocess
 {
 public:
+  // Bytes buffered in each direction when the channel runs over shared memory.
+  static const uint32 DefaultSharedMemoryChannelSize = 1024 * 1024;
+
   class Connection
   {
   private:
@@ -28,6 +31,9 @@ public:
 
     uint32 WriteData(const void* pBuffer, uint32 byteCount);
 
+    // true when data moves through shared memory rather than the pipes
+    bool IsSharedMemoryChannel() const { return false; }
+
   private:
     friend class Subprocess;
     HANDLE m_hTargetProcess;
@@ -51,8 +57,18 @@ public:
   static Connection* ConnectToParent(int32 connectionTimeout = -1);
 
   // Parent process functions
+  // The channel is offered to the child over shared memory when sharedMemoryChannelSize is non-zero and the
+  // platform supports it, and falls back to the pipes otherwise. Windows always uses the pipes for now.
   static Subprocess* Create(const char* executableFileName, const char* parameters = NULL, bool openChannel = true,
-                            bool newConsole = true, bool terminateOnParentLost = true);
+                            bool newConsole = true, bool terminateOnParentLost = true,
+                            uint32 sharedMemoryChannelSize = DefaultSharedMemoryChannelSize);
+
+  // Starts count children the same way as Create, sharing the setup between them, so they start up side by side
+  // while the caller connects to each in turn. Returns how many were started, they fill ppSubprocesses in order.
+  static uint32 CreateMultiple(Subprocess** ppSubprocesses, uint32 count, const char* executableFileName,
+                               const char* parameters = NULL, bool openChannel = true, bool newConsole = true,
+                               bool terminateOnParentLost = true,
+                               uint32 sharedMemoryChannelSize = DefaultSharedMemoryChannelSize);
   Connection* ConnectToChild(int32 connectionTimeout = -1);
   bool IsChildAlive();
   void RequestChildToExit();
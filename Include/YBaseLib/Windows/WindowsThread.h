@@ -25,6 +25,10 @@ public:
   bool Start(bool createSuspended = false);
   int32 Join();
 
+  // restricts the thread to the logical processors set in the mask, bit n being processor n.
+  // returns false if the platform doesn't support affinity or the mask is invalid.
+  bool SetAffinityMask(uint64 mask);
+
 protected:
   // entry point of the thread
   virtual int ThreadEntryPoint();
@@ -46,4 +50,5 @@ public:
   static ThreadIdType GetCurrentThreadId();
   static void Yield();
   static void Sleep(uint32 millisecondsToSleep);
+  static bool SetCurrentThreadAffinityMask(uint64 mask);
 };
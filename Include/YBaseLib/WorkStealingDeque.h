@@ -0,0 +1,141 @@
+#pragma once
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Memory.h"
+
+// Chase-Lev work-stealing deque.
+// The owning thread pushes and pops at the bottom, any other thread may steal from the top.
+// T must be a pointer-sized POD type, null is used to indicate an empty deque or a lost race.
+// Indices are free-running 32-bit counters, differences are computed with wrap-around.
+template<typename T>
+class WorkStealingDeque
+{
+  struct Array
+  {
+    uint32 Mask;
+    Array* pPrevious;
+    T volatile Elements[1];
+
+    T Get(uint32 index) const { return Elements[index & Mask]; }
+    void Put(uint32 index, T value) { Elements[index & Mask] = value; }
+  };
+
+public:
+  WorkStealingDeque(uint32 initialCapacity = 256) : m_top(0), m_bottom(0)
+  {
+    DebugAssert(initialCapacity > 0 && Common::IsPow2(initialCapacity));
+    m_pArray = AllocateArray(initialCapacity);
+  }
+
+  ~WorkStealingDeque()
+  {
+    // free the current array and any retired arrays
+    Array* pArray = m_pArray;
+    while (pArray != nullptr)
+    {
+      Array* pPrevious = pArray->pPrevious;
+      std::free(pArray);
+      pArray = pPrevious;
+    }
+  }
+
+  // approximate number of elements, may be stale by the time it is returned
+  uint32 GetSize() const
+  {
+    int32 size = static_cast<int32>(m_bottom - m_top);
+    return (size > 0) ? static_cast<uint32>(size) : 0;
+  }
+  bool IsEmpty() const { return (GetSize() == 0); }
+
+  // owner only: push to the bottom
+  void Push(T value)
+  {
+    uint32 bottom = m_bottom;
+    uint32 top = m_top;
+    Array* pArray = m_pArray;
+    if (static_cast<int32>(bottom - top) > static_cast<int32>(pArray->Mask))
+      pArray = Grow(pArray, bottom, top);
+
+    // the element must be visible before the new bottom
+    pArray->Put(bottom, value);
+    MemoryBarrier();
+    m_bottom = bottom + 1;
+  }
+
+  // owner only: pop from the bottom, returns null if empty
+  T Pop()
+  {
+    uint32 bottom = m_bottom - 1;
+    Array* pArray = m_pArray;
+    m_bottom = bottom;
+
+    // the store to bottom has to be ordered before the load of top
+    MemoryBarrier();
+
+    uint32 top = m_top;
+    int32 size = static_cast<int32>(bottom - top);
+    if (size < 0)
+    {
+      // empty, restore bottom
+      m_bottom = bottom + 1;
+      return nullptr;
+    }
+
+    T value = pArray->Get(bottom);
+    if (size > 0)
+      return value;
+
+    // last element, race against stealers for it
+    if (Y_AtomicCompareExchange(m_top, top + 1, top) != top)
+      value = nullptr;
+
+    m_bottom = bottom + 1;
+    return value;
+  }
+
+  // any thread: steal from the top, returns null if empty or another thread won the race
+  T Steal()
+  {
+    uint32 top = m_top;
+    MemoryBarrier();
+    uint32 bottom = m_bottom;
+    if (static_cast<int32>(bottom - top) <= 0)
+      return nullptr;
+
+    Array* pArray = m_pArray;
+    T value = pArray->Get(top);
+    if (Y_AtomicCompareExchange(m_top, top + 1, top) != top)
+      return nullptr;
+
+    return value;
+  }
+
+private:
+  static Array* AllocateArray(uint32 capacity)
+  {
+    Array* pArray = reinterpret_cast<Array*>(std::malloc(sizeof(Array) + sizeof(T) * (capacity - 1)));
+    pArray->Mask = capacity - 1;
+    pArray->pPrevious = nullptr;
+    return pArray;
+  }
+
+  Array* Grow(Array* pOldArray, uint32 bottom, uint32 top)
+  {
+    // stealers may still be reading the old array, so it is retired rather than freed
+    Array* pNewArray = AllocateArray((pOldArray->Mask + 1) * 2);
+    pNewArray->pPrevious = pOldArray;
+    for (uint32 i = top; i != bottom; i++)
+      pNewArray->Put(i, pOldArray->Get(i));
+
+    MemoryBarrier();
+    m_pArray = pNewArray;
+    return pNewArray;
+  }
+
+  Y_ATOMIC_DECL uint32 m_top;
+  Y_ATOMIC_DECL uint32 m_bottom;
+  Y_ATOMIC_PTR_DECL(Array) m_pArray;
+
+  DeclareNonCopyable(WorkStealingDeque);
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Thread.h"
+#include "YBaseLib/Timer.h"
+
+// How a worker waits once it runs out of work. It first spins for SpinCount iterations with a pause hint, then
+// calls Thread::Yield up to YieldCount times, and only then parks on its condition variable. Spinning avoids paying
+// for a full wake-up when work arrives in short bursts, at the cost of keeping the core busy while idle.
+struct WorkerIdlePolicy
+{
+  enum STAGE
+  {
+    STAGE_NONE,
+    STAGE_SPIN,
+    STAGE_YIELD,
+    STAGE_PARK,
+  };
+
+  uint32 SpinCount;
+  uint32 YieldCount;
+
+  WorkerIdlePolicy(uint32 spinCount = 0, uint32 yieldCount = 0) : SpinCount(spinCount), YieldCount(yieldCount) {}
+
+  // parks immediately, best for power consumption
+  static WorkerIdlePolicy Park() { return WorkerIdlePolicy(0, 0); }
+
+  // spins for some microseconds before yielding, for latency-sensitive loops
+  static WorkerIdlePolicy LowLatency() { return WorkerIdlePolicy(4096, 64); }
+
+  // spins and yields until hasWork returns true or the budget runs out.
+  // returns the stage work was found in, or STAGE_PARK if the caller should go to sleep.
+  template<class T>
+  STAGE Wait(const T& hasWork) const
+  {
+    for (uint32 i = 0; i < SpinCount; i++)
+    {
+      if (hasWork())
+        return STAGE_SPIN;
+
+      Y_SpinWaitHint();
+    }
+
+    for (uint32 i = 0; i < YieldCount; i++)
+    {
+      if (hasWork())
+        return STAGE_YIELD;
+
+      Thread::Yield();
+    }
+
+    return STAGE_PARK;
+  }
+};
+
+// Idle behaviour counters. Each worker updates its own copy without locking, so a snapshot taken while the
+// workers are running may be slightly stale.
+struct WorkerIdleStats
+{
+  // work was found while spinning or yielding
+  uint64 SpinWakeups;
+  uint64 YieldWakeups;
+
+  // times a worker went to sleep
+  uint64 Parks;
+
+  // wake-ups from sleep that were requested by a producer, and the time between the request and the worker running
+  uint64 ParkedWakeups;
+  Y_TIMER_VALUE TotalWakeLatency;
+  Y_TIMER_VALUE MaxWakeLatency;
+
+  WorkerIdleStats() { Reset(); }
+
+  void Reset()
+  {
+    SpinWakeups = 0;
+    YieldWakeups = 0;
+    Parks = 0;
+    ParkedWakeups = 0;
+    TotalWakeLatency = 0;
+    MaxWakeLatency = 0;
+  }
+
+  void Accumulate(const WorkerIdleStats& other)
+  {
+    SpinWakeups += other.SpinWakeups;
+    YieldWakeups += other.YieldWakeups;
+    Parks += other.Parks;
+    ParkedWakeups += other.ParkedWakeups;
+    TotalWakeLatency += other.TotalWakeLatency;
+    MaxWakeLatency = Max(MaxWakeLatency, other.MaxWakeLatency);
+  }
+
+  void RecordWakeup(WorkerIdlePolicy::STAGE stage)
+  {
+    if (stage == WorkerIdlePolicy::STAGE_SPIN)
+      SpinWakeups++;
+    else if (stage == WorkerIdlePolicy::STAGE_YIELD)
+      YieldWakeups++;
+  }
+
+  void RecordWakeLatency(Y_TIMER_VALUE latency)
+  {
+    ParkedWakeups++;
+    TotalWakeLatency += latency;
+    MaxWakeLatency = Max(MaxWakeLatency, latency);
+  }
+
+  double GetAverageWakeLatencyMilliseconds() const
+  {
+    return (ParkedWakeups > 0) ? (Y_TimerConvertToMilliseconds(TotalWakeLatency) / (double)ParkedWakeups) : 0.0;
+  }
+
+  double GetMaxWakeLatencyMilliseconds() const { return Y_TimerConvertToMilliseconds(MaxWakeLatency); }
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/StringView.h"
+#include "YBaseLib/XMLReader.h"
+#include "YBaseLib/XMLSelector.h"
+
+// XMLReader's interface, tokenizing the text in place instead of going through libxml2. A stream that's in memory,
+// like a memory stream or a mapped file, is read where it is, anything else is read into memory first. Names and
+// values are found without copying: the view accessors point into the stream's memory, and only values with
+// entities or line breaks to normalize are decoded, when they're asked for. The const char* accessors copy into a
+// buffer owned by the reader, and stay valid until the next NextToken.
+// Comments, processing instructions and the doctype are skipped, CDATA sections are text, and whitespace between
+// elements isn't returned, like XMLReader. The document must be UTF-8; there's no DTD or namespace handling.
+class XMLPullReader
+{
+public:
+  XMLPullReader();
+  ~XMLPullReader();
+
+  bool Create(ByteStream* pInputStream, const char* FileName);
+
+  bool MoveToFirstAttribute();
+  bool MoveToNextAttribute();
+  bool MoveToAttribute(const char* AttributeName);
+  bool MoveToElement();
+
+  bool NextToken();
+  XMLREADER_TOKEN_TYPE GetTokenType() const { return m_eCurrentNodeType; }
+  const char* GetFileName() const { return m_szFileName; }
+
+  const char* GetNodeName();
+  const char* GetNodeValue();
+  const char* GetNodeValueString(); // same as GetNodeValue, except will never return null
+
+  // the same without a copy, valid until the next NextToken or until the stream's memory goes away
+  StringView GetNodeNameView() const;
+  StringView GetNodeValueView();
+
+  const char* FetchAttribute(const char* AttributeName);
+  const char* FetchAttributeString(const char* AttributeName);
+  const char* FetchAttributeDefault(const char* attributeName, const char* defaultValue);
+  bool FetchAttributeView(const char* attributeName, StringView* pValue);
+
+  String GetElementText(bool skipElement = false);
+
+  bool IsEmptyElement();
+
+  bool InErrorState() const { return m_bErrorState; }
+
+  void PrintWarning(const char* Format, ...);
+  void PrintError(const char* Format, ...);
+
+  bool SkipToElement(const char* ElementName);
+  bool SkipCurrentElement();
+
+  int32 Select(const char* SelectionString, bool AbortOnError = true);
+  int32 SelectAttribute(const char* AttributeName, const char* SelectionString, bool AbortOnError = true);
+
+  // the same with a compiled selector, matching the name or value where it is in the document
+  int32 Select(const XMLSelector& selector, bool AbortOnError = true);
+  int32 SelectAttribute(const char* AttributeName, const XMLSelector& selector, bool AbortOnError = true);
+
+  bool ExpectEndOfElement();
+  bool ExpectEndOfElementName(const char* nodeName);
+
+private:
+  // A name or value is a view of the document until it's copied or decoded, then a view of the copy.
+  struct Attribute
+  {
+    StringView Name;
+    StringView Value;
+    const char* pNameCopy;
+    const char* pValueCopy;
+  };
+
+  // the pieces of a token, which return false once they've reported the text isn't XML
+  bool ReadElement();
+  bool ReadEndElement();
+  bool ReadName(StringView* pName);
+  bool SkipPast(const char* terminator, const char* what);
+  bool SkipDoctype();
+  void SkipWhitespace();
+  bool SyntaxError(const char* Format, ...);
+
+  // makes room for every string of the token to be copied without moving the ones given out already
+  void ResetStrings(uint32 maxLength);
+
+  // Copies a name, or decodes a value, into the strings buffer with a terminator, pointing the view at the copy.
+  const char* CopyString(StringView* pText);
+  const char* DecodeString(StringView* pText, bool attribute);
+
+  // the current text token or attribute's value, decoded
+  const char* GetValueCopy();
+
+  ByteStream* m_pInputStream;
+  const char* m_szFileName;
+
+  // the document, and what's been read of it
+  const char* m_pText;
+  const char* m_pTextEnd;
+  const char* m_pPosition;
+  char* m_pOwnedText;
+
+  // the current token, with the element's attributes
+  const char* m_pTokenStart;
+  StringView m_name;
+  StringView m_value;
+  const char* m_pNameCopy;
+  const char* m_pValueCopy;
+  bool m_valueIsCData;
+  bool m_isEmptyElement;
+  PODArray<Attribute> m_attributes;
+  int32 m_currentAttribute;
+
+  // open elements, to match the end tags with
+  PODArray<StringView> m_openElements;
+  bool m_rootElementRead;
+
+  // copies of the token's names and decoded values
+  char* m_pStrings;
+  uint32 m_stringsSize;
+  uint32 m_stringsLength;
+
+  XMLREADER_TOKEN_TYPE m_eCurrentNodeType;
+  bool m_bErrorState;
+
+  DeclareNonCopyable(XMLPullReader);
+};
@@ -1,13 +1,7 @@
 #pragma once
 #include "YBaseLib/Common.h"
 
-#ifdef HAVE_LIBXML2
-
-#include "YBaseLib/ByteStream.h"
-#include "YBaseLib/String.h"
-
-typedef struct _xmlTextReader* xmlTextReaderPtr;
-
+// shared with XMLPullReader, which doesn't need libxml2
 enum XMLREADER_TOKEN_TYPE
 {
   XMLREADER_TOKEN_ELEMENT,
@@ -17,6 +11,14 @@ enum XMLREADER_TOKEN_TYPE
   XMLREADER_TOKEN_COUNT,
 };
 
+#ifdef HAVE_LIBXML2
+
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/String.h"
+
+typedef struct _xmlTextReader* xmlTextReaderPtr;
+class XMLSelector;
+
 class XMLReader
 {
 public:
@@ -57,6 +59,10 @@ public:
   int32 Select(const char* SelectionString, bool AbortOnError = true);
   int32 SelectAttribute(const char* AttributeName, const char* SelectionString, bool AbortOnError = true);
 
+  // the same with a compiled selector, see XMLSelector.h
+  int32 Select(const XMLSelector& selector, bool AbortOnError = true);
+  int32 SelectAttribute(const char* AttributeName, const XMLSelector& selector, bool AbortOnError = true);
+
   bool ExpectEndOfElement();
   bool ExpectEndOfElementName(const char* nodeName);
 
@@ -0,0 +1,44 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/HashTrait.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/StringView.h"
+
+// A selection string for XMLReader and XMLPullReader's Select, like "mesh|material|light", split up and hashed once,
+// so finding which alternative a name is costs a hash and a probe rather than parsing the string and comparing every
+// alternative. Matches what Y_selectstring would: names are compared without regard to case, and the first of any
+// repeated alternatives wins. Build them once and keep them, a loader's as statics:
+//   static const XMLSelector s_elementSelector("mesh|material|light");
+//   switch (reader.Select(s_elementSelector)) ...
+class XMLSelector
+{
+public:
+  XMLSelector(const char* selectionString);
+  ~XMLSelector();
+
+  const char* GetSelectionString() const { return m_selectionString; }
+  uint32 GetAlternativeCount() const { return m_alternativeCount; }
+
+  // the index of the alternative the value is, or -1
+  int32 Find(const char* value, uint32 length) const;
+  int32 Find(const char* value) const { return Find(value, Y_strlen(value)); }
+  int32 Find(const StringView& value) const { return Find(value.GetData(), value.GetLength()); }
+
+private:
+  // an alternative, at an offset in the selection string, slots with an index of -1 are empty
+  struct Slot
+  {
+    HashType Hash;
+    int32 Index;
+    uint32 Offset;
+    uint32 Length;
+  };
+
+  String m_selectionString;
+  PODArray<Slot> m_slots;
+  uint32 m_slotMask;
+  uint32 m_alternativeCount;
+
+  DeclareNonCopyable(XMLSelector);
+};
@@ -1,15 +1,16 @@
 #pragma once
-#include "YBaseLib/Common.h"
-
-#ifdef HAVE_LIBXML2
 #include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Common.h"
+#include "YBaseLib/PODArray.h"
 
-typedef struct _xmlTextWriter* xmlTextWriterPtr;
-typedef struct _xmlOutputBuffer* xmlOutputBufferPtr;
-
+// Writes indented XML text through a buffer, the same text libxml2's xmlTextWriter writes. Runs of text that need no
+// escaping are found 16 bytes at a time and copied in one go, and numbers are formatted straight into the buffer.
+// What's buffered reaches the stream when it fills and on Close.
 class XMLWriter
 {
 public:
+  static const uint32 BufferSize = 4096;
+
   XMLWriter();
   ~XMLWriter();
 
@@ -25,13 +26,21 @@ public:
   void WriteAttribute(const char* attributeName, const char* attributeValue);
   void WriteAttributef(const char* attributeName, const char* format, ...);
 
+  // numbers as decimal text, floating point in a form that reads back the same, see NumberConversion.h
+  void WriteAttributeInt32(const char* attributeName, int32 value);
+  void WriteAttributeUInt32(const char* attributeName, uint32 value);
+  void WriteAttributeInt64(const char* attributeName, int64 value);
+  void WriteAttributeUInt64(const char* attributeName, uint64 value);
+  void WriteAttributeFloat(const char* attributeName, float value);
+  void WriteAttributeDouble(const char* attributeName, double value);
+
   // does special character encoding
   void WriteString(const char* data);
 
   // writes as cdata
   void WriteCDATA(const char* data);
 
-  // ignores it
+  // writes as is
   void WriteRaw(const char* data, uint32 dataLength);
 
   // writes data as base64 encoded
@@ -64,10 +73,39 @@ public:
   //     int32 Select(const char *SelectionString, bool AbortOnError = true);
 
 private:
+  // Closes the start tag if content is the first thing in the element. Returns false if the writer has failed.
+  bool StartContent();
+
+  // Opens an attribute in the start tag, or fails if there isn't one open.
+  bool StartAttribute(const char* attributeName);
+  void WriteIndent(uint32 depth);
+
+  // text with markup characters as entities, and in attributes line breaks, tabs and non-ASCII as character refs
+  void WriteEscaped(const char* text, uint32 length, bool attribute);
+
+  // copies into the buffer, writing it out as it fills
+  void Write(const char* text, uint32 length);
+
+  // The buffer's free space once there's at least the given size, or NULL if the stream has failed. Text put there
+  // is kept with CommitBuffer.
+  char* ReserveBuffer(uint32 size);
+  void CommitBuffer(uint32 length) { m_bufferLength += length; }
+  bool FlushBuffer();
+
   ByteStream* m_pOutputStream;
-  xmlTextWriterPtr m_pWriter;
-  xmlOutputBufferPtr m_pOutputBuffer;
+
+  // names of the open elements, each with a terminator, for the end tags
+  PODArray<char> m_elementNames;
+  PODArray<uint32> m_elementNameOffsets;
+
+  // whether the innermost element's start tag is still open for attributes, and whether its end tag goes on a line
+  // of its own, which it doesn't after text, like xmlTextWriter
+  bool m_inStartTag;
+  bool m_indentEndTag;
+
+  char m_buffer[BufferSize];
+  uint32 m_bufferLength;
   bool m_bErrorState;
-};
 
-#endif // HAVE_LIBXML2
+  DeclareNonCopyable(XMLWriter);
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include "YBaseLib/Common.h"
+
+// XXH64, a fast non-cryptographic hash for checksums and deduplication, not for anything an attacker can choose.
+// Final writes the hash big endian, as xxhash's canonical form does, GetValue returns it as a number.
+class XXHash64Digest
+{
+public:
+  static const uint32 DIGEST_SIZE = 8;
+
+  XXHash64Digest(uint64 seed = 0);
+
+  void Update(const void* pData, size_t cbData);
+  void Final(byte Digest[DIGEST_SIZE]);
+  void Reset();
+
+  // the hash of everything so far, more can be added after
+  uint64 GetValue() const;
+
+  // the hash of one buffer
+  static uint64 Hash(const void* pData, size_t cbData, uint64 seed = 0);
+
+private:
+  uint64 m_seed;
+  uint64 m_accumulators[4];
+  uint64 m_byteCount;
+  byte m_stripe[32];
+};
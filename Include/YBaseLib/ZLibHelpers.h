@@ -33,11 +33,15 @@ uint32 GetDeflatedBufferUpperBounds(uint32 cbSourceBuffer, const int compression
 bool WriteDeflatedDataToBuffer(void* pDestinationBuffer, uint32 cbDestinationBuffer, uint32* pCompressedSize,
                                const void* pSourceBuffer, uint32 cbSourceBuffer,
                                const int compressionLevel = Z_DEFAULT_COMPRESSION);
-// bool WriteDeflatedDataToStream(ByteStream *pDestinationStream, const void *pSourceBuffer, uint32 cbSourceBuffer,
-// const int compressionLevel = Z_DEFAULT_COMPRESSION);
 bool ReadDeflatedDataFromBuffer(void* pDestinationBuffer, uint32 cbDestinationBuffer, uint32* pDecompressedSize,
                                 const void* pSourceBuffer, uint32 cbSourceBuffer);
-// bool ReadDeflatedDataFromStream(void *pDestinationBuffer, uint32 cbDestinationBuffer, ByteStream *pSourceStream);
+
+// the same to and from a stream at its position, in pieces through CompressionByteStream. larger data can go through
+// a CompressionByteStream directly, without being in memory at once.
+bool WriteDeflatedDataToStream(ByteStream* pDestinationStream, const void* pSourceBuffer, uint32 cbSourceBuffer,
+                               const int compressionLevel = Z_DEFAULT_COMPRESSION);
+bool ReadDeflatedDataFromStream(void* pDestinationBuffer, uint32 cbDestinationBuffer, uint32* pDecompressedSize,
+                                ByteStream* pSourceStream);
 
 } // namespace ZipHelpers
 
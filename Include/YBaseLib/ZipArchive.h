@@ -2,12 +2,21 @@
 #include "YBaseLib/Common.h"
 
 #ifdef HAVE_ZLIB
+#include "YBaseLib/BloomFilter.h"
 #include "YBaseLib/CIStringHashTable.h"
+#include "YBaseLib/Compression.h"
 #include "YBaseLib/FileSystem.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/PathTrie.h"
+#include "YBaseLib/ProgressCallbacks.h"
 #include "YBaseLib/String.h"
 #include "YBaseLib/Timestamp.h"
 
 class ByteStream;
+class ThreadPool;
+struct ZIP_ARCHIVE_INDEX_HEADER;
+struct ZIP_ARCHIVE_LOCAL_FILE_HEADER;
 
 class ZipArchive
 {
@@ -21,12 +30,74 @@ public:
 
   const bool IsWritable() const { return (m_pWriteStream != NULL); }
 
+  // whether changes are committed by appending to the archive's own stream
+  bool IsAppending() const { return (m_pReadStream != NULL && m_pReadStream == m_pWriteStream); }
+
   // archive operations
   bool StatFile(const char* filename, FILESYSTEM_STAT_DATA* pStatData) const;
   bool FindFiles(const char* path, const char* pattern, uint32 flags, FileSystem::FindResultsArray* pResults) const;
+
+  // Stored files in an archive whose stream is in memory, such as a mapped file, are opened as a stream over the
+  // archive's memory, so GetBasePointer gives their data without it being copied. The stream holds a reference to
+  // the archive stream.
   ByteStream* OpenFile(const char* filename, uint32 openMode, uint32 compressionLevel = 6);
+
+  // Opens many files for reading at once, as OpenFile does seekable, setting each stream or NULL if the file can't be
+  // opened, and returning the number opened. Files in the read stream are read in the order they're in the archive,
+  // runs of neighbours in one read each, up to a batch at a time, and decompressed side by side on the pool. Files
+  // still to be committed, and ones too big for a batch, are opened one at a time.
+  uint32 OpenFiles(const char* const* filenames, uint32 count, ByteStream** ppStreams, ThreadPool* pThreadPool = NULL);
   bool DeleteFile(const char* filename);
 
+  // calls the callback for every file, including those written since the archive was opened
+  typedef void (*EnumerateFilesCallback)(const char* filename, const FILESYSTEM_STAT_DATA* pStatData, void* pUserData);
+  void EnumerateFiles(EnumerateFilesCallback callback, void* pUserData) const;
+
+  // Extracts files to a directory, creating it and the directories they're in, and overwriting what's there. Data is
+  // read from the archive on the calling thread, a batch at a time, and inflated and written by the pool's workers.
+  // Progress counts files. Returns false if any file couldn't be extracted or extraction was cancelled, the files
+  // that were extracted are left in place. Names that would leave the directory, through '..' or a root, fail.
+  bool ExtractFiles(const char* const* filenames, uint32 count, const char* destinationDirectory,
+                    ThreadPool* pThreadPool = NULL,
+                    ProgressCallbacks* pProgressCallbacks = ProgressCallbacks::NullProgressCallback);
+
+  // extracts every file in the archive
+  bool ExtractAll(const char* destinationDirectory, ThreadPool* pThreadPool = NULL,
+                  ProgressCallbacks* pProgressCallbacks = ProgressCallbacks::NullProgressCallback);
+
+  // Checks every file in the read stream against its CRC, reading them a batch at a time as OpenFiles does and
+  // checking them on the pool's workers. Stored files are checked where they're read, and deflated ones inflated a
+  // window at a time, so neither needs a buffer of its own. Progress counts files, and each that fails is reported as
+  // an error. Returns false if any file fails or verification was cancelled.
+  bool VerifyAll(ThreadPool* pThreadPool = NULL,
+                 ProgressCallbacks* pProgressCallbacks = ProgressCallbacks::NullProgressCallback);
+
+  // a file for WriteFiles
+  struct FileContents
+  {
+    const char* FileName;
+    const void* pData;
+    uint32 Size;
+  };
+
+  // Adds or replaces many files at once. They're compressed side by side on the pool, large ones in blocks as well,
+  // and written out in order on the calling thread. Returns false if any file couldn't be written.
+  bool WriteFiles(const FileContents* pFiles, uint32 count, uint32 compressionLevel = 6,
+                  ThreadPool* pThreadPool = NULL);
+
+  // Files opened for writing from now on are deflated on the pool's workers, in blocks that are each primed with the
+  // 32KB of data before them, so they join into one deflate stream that any unzip tool reads. This compresses a
+  // little worse than a single stream. NULL goes back to compressing on the writing thread.
+  void SetCompressionThreadPool(ThreadPool* pThreadPool) { m_pCompressionThreadPool = pThreadPool; }
+  ThreadPool* GetCompressionThreadPool() const { return m_pCompressionThreadPool; }
+
+  // The codec files written from now on are compressed with, when their level isn't 0. Deflate is the default and
+  // what every unzip tool reads. Zstandard (method 93) decompresses a few times faster at a better ratio, and is read
+  // by 7-Zip and libzip, but files are compressed and decompressed whole, so streamed opens are buffered. Levels are
+  // the codec's own. LZ4 has no zip method, so it and codecs that aren't built in return false.
+  bool SetCompressionCodec(COMPRESSION_CODEC codec);
+  COMPRESSION_CODEC GetCompressionCodec() const { return m_compressionCodec; }
+
   // copy a file from another zip archive
   bool CopyFile(ZipArchive* pOtherArchive, const char* filename);
 
@@ -35,26 +106,51 @@ public:
 
   // commit all changes, completing the write stream, replacing the read pointer with the write pointer.
   // this function expects that the write stream was also opened in write mode.
+  // When appending, only the new central directory is written after the files, and the archive stays writable.
   bool CommitChanges();
 
   // discard all changes.
   // this function will remove the write stream, UpgradeToWritableArchive must be called before it can be re-called
+  // When appending, files written since the last commit are already in the stream, so the central directory is
+  // written again after them, and the archive stays writable.
   bool DiscardChanges();
 
+  // Writes out where every file in the read stream is, for opening the archive again without reading its central
+  // directory. The index is in this machine's byte order, and holds the files as they were opened or last committed.
+  bool SaveIndex(ByteStream* pStream) const;
+
+  // whether the archive was opened from a saved index
+  bool IsIndexLoaded() const { return m_indexLoaded; }
+
   // opens a new archive
   static ZipArchive* CreateArchive(ByteStream* pWriteStream);
 
-  // open the archive read-only.
-  static ZipArchive* OpenArchiveReadOnly(ByteStream* pReadStream);
+  // Open the archive read-only. An index from SaveIndex is read in one go, or used in place if its stream is in
+  // memory, such as a mapped file, in which case the archive holds a reference to it. The index is checked against
+  // the archive's size and the end of its central directory, and if it's missing, damaged or out of date the
+  // central directory is read instead.
+  static ZipArchive* OpenArchiveReadOnly(ByteStream* pReadStream, ByteStream* pIndexStream = NULL);
 
   // opens the archive read-write.
-  static ZipArchive* OpenArchiveReadWrite(ByteStream* pReadStream, ByteStream* pWriteStream);
+  static ZipArchive* OpenArchiveReadWrite(ByteStream* pReadStream, ByteStream* pWriteStream,
+                                          ByteStream* pIndexStream = NULL);
+
+  // Opens the archive to be changed in place. Files written are appended to the stream, and committing appends a new
+  // central directory that lists them alongside the files that are still there, so the existing data isn't copied.
+  // Replaced and deleted files, and earlier central directories, are left in the stream until it's compacted. Until
+  // changes are committed or discarded the stream ends without a central directory, which other zip tools won't
+  // open. The stream must be readable, writable and seekable.
+  static ZipArchive* OpenArchiveForAppend(ByteStream* pStream, ByteStream* pIndexStream = NULL);
 
-  // todo: defragment methods
+  // Writes the files listed in an archive to another stream, leaving out the space appending left behind. The
+  // destination stream is flushed, but committing it is up to the caller.
+  static bool CompactArchive(ByteStream* pSourceStream, ByteStream* pDestinationStream);
 
 private:
   ZipArchive(ByteStream* pReadStream, ByteStream* pWriteStream);
+  static ZipArchive* OpenWritableArchive(ByteStream* pReadStream, ByteStream* pWriteStream, ByteStream* pIndexStream);
   bool ParseZip();
+  bool LoadIndex(ByteStream* pIndexStream);
 
   ByteStream* m_pReadStream;
   ByteStream* m_pWriteStream;
@@ -62,26 +158,147 @@ private:
   uint32 m_nOpenStreamedWrites;
   uint32 m_nOpenBufferedReads;
   uint32 m_nOpenBufferedWrites;
+  ThreadPool* m_pCompressionThreadPool;
+  COMPRESSION_CODEC m_compressionCodec;
+  bool m_indexLoaded;
 
-  struct FileEntry
+  // what's needed to find and check a file's data
+  struct FileLocation
   {
-    String FileName;
-    uint32 CompressionMethod;
-    Timestamp ModifiedTime;
-    uint32 CRC32;
     uint64 OffsetToFileHeader;
     uint64 CompressedFileSize;
     uint64 DecompressedFileSize;
+    uint32 CompressionMethod;
+    uint32 CRC32;
+  };
+
+  struct FileEntry : public FileLocation
+  {
+    String FileName;
+    Timestamp ModifiedTime;
     bool IsDeleted;
     uint32 WriteOpenCount;
   };
 
+  // The files in the read stream, in flat arrays of entries, hash slots and names rather than an allocation each,
+  // so archives with many files open quickly. The arrays are what SaveIndex writes, and are used in place when a
+  // saved index is loaded from memory.
+  class ReadIndex
+  {
+  public:
+    static const uint32 InvalidEntry = 0xFFFFFFFF;
+
+    struct Entry
+    {
+      FileLocation Location;
+      uint32 NameOffset;
+      uint32 NameLength;
+      uint32 NameHash;
+
+      // in the zip format
+      uint32 ModifiedTime;
+    };
+
+    ReadIndex();
+    ~ReadIndex();
+
+    uint32 GetEntryCount() const { return m_entryCount; }
+    const Entry& GetEntry(uint32 index) const { return m_pEntries[index]; }
+    const char* GetEntryName(uint32 index) const { return m_pNames + m_pEntries[index].NameOffset; }
+    bool IsEntryDeleted(uint32 index) const { return (!m_deletedEntries.IsEmpty() && m_deletedEntries[index]); }
+    bool HasDeletedEntries() const { return !m_deletedEntries.IsEmpty(); }
+    void DeleteEntry(uint32 index);
+    void UndeleteEntries() { m_deletedEntries.Obliterate(); }
+
+    // names are compared without regard to case
+    uint32 Find(const char* fileName) const;
+
+    // Replaces the index with the entries added from here. The counts are upper bounds, and names already added
+    // are refused.
+    void BeginBuild(uint32 maxEntryCount, uint32 maxNamesSize);
+    bool AddEntry(const char* fileName, uint32 nameLength, const FileLocation& location, uint32 modifiedTime);
+
+    // the header's archive fields are written as they are, and have to match when loading, or it fails as it does
+    // for a damaged index
+    bool Save(ByteStream* pStream, const ZIP_ARCHIVE_INDEX_HEADER* pArchiveHeader) const;
+    bool Load(ByteStream* pStream, const ZIP_ARCHIVE_INDEX_HEADER* pArchiveHeader);
+
+    void Clear();
+
+  private:
+    // slots hold entry numbers plus one, zero is empty
+    uint32 FindSlot(const char* fileName, uint32 nameLength, uint32 hash) const;
+
+    const Entry* m_pEntries;
+    const uint32* m_pSlots;
+    const char* m_pNames;
+    uint32 m_entryCount;
+    uint32 m_slotCount;
+    uint32 m_namesSize;
+
+    // built in these, or loaded into m_data, or used from m_pStream's memory
+    PODArray<Entry> m_entries;
+    PODArray<uint32> m_slots;
+    PODArray<char> m_names;
+    PODArray<byte> m_data;
+    ByteStream* m_pStream;
+
+    // only allocated once something's deleted
+    PODArray<bool> m_deletedEntries;
+
+    // built from the name hashes, so most names that aren't there are turned away without probing the slots
+    BloomFilter m_nameFilter;
+
+    DeclareNonCopyable(ReadIndex);
+  };
+
   typedef CIStringHashTable<FileEntry*> FileHashTable;
-  FileHashTable m_readFileHashTable;
+  ReadIndex m_readIndex;
   FileHashTable m_writeFileHashTable;
 
-  uint32 FindFilesInTable(const FileHashTable& fileTable, const char* path, const char* pattern, uint32 flags,
-                          FileSystem::FindResultsArray* pResults) const;
+  // Every name in the read index and the write table, with its read index entry if it has one, so FindFiles only
+  // looks at the files under the path. Built by the first FindFiles after the names change.
+  mutable PathTrie<uint32> m_findTrie;
+  mutable bool m_findTrieBuilt;
+  mutable Mutex m_findTrieLock;
+  void BuildFindTrie() const;
+  void AddToFindTrie(const char* fileName);
+  void ResetFindTrie();
+
+  // the zip method files written at a level are compressed with
+  uint32 GetWriteCompressionMethod(uint32 compressionLevel) const;
+
+  FileEntry* GetOrCreateWriteFileEntry(const char* filename, uint32 compressionMethod);
+
+  // appends a file's local header and data to the write stream, and points its entry at them
+  bool WriteFileData(FileEntry* pFileEntry, uint32 compressionMethod, uint32 crc, const void* pData, uint32 dataSize,
+                     uint32 decompressedSize);
+
+  // where a file is read from, and the stream it's in, or NULL if it's missing or still being written
+  const FileLocation* FindReadableFile(const char* filename, ByteStream** ppStream) const;
+
+  // reads and checks the local header for a file, leaving the stream at the start of its data
+  static bool ReadLocalFileHeader(ByteStream* pStream, const FileLocation* pLocation,
+                                  ZIP_ARCHIVE_LOCAL_FILE_HEADER* pLocalFileHeader);
+
+  // copies a file's local header and data to where the destination stream is
+  static bool CopyLocalFile(ByteStream* pSourceStream, const FileLocation* pLocation, ByteStream* pDestinationStream,
+                            const char* fileName, uint32 filenameLength);
+
+  // a file in the read stream, read with others by ReadBatch, see ZipArchive.cpp
+  struct BatchFile;
+
+  // Reads the local headers and data of files in the read stream, sorted by offset, from index on, in runs of
+  // neighbours until the batch buffer holds a batch. Files that can't be read that way have their index added to
+  // pSingles, to be read alone. Returns the index to carry on from.
+  uint32 ReadBatch(const PODArray<BatchFile>& files, uint32 index, PODArray<byte>* pBatchBuffer,
+                   PODArray<BatchFile>* pBatch, PODArray<uint32>* pSingles);
+
+  // checks a file in the read stream on the calling thread, without holding it in memory unless it's Zstandard
+  bool VerifyFile(const FileLocation* pLocation);
+
+  // the archive fields of an index header for the read stream as it is now
+  bool GetIndexKey(ZIP_ARCHIVE_INDEX_HEADER* pHeader) const;
 };
 
 #endif // HAVE_ZLIB
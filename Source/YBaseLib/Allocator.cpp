@@ -0,0 +1,235 @@
+#include "YBaseLib/Allocator.h"
+#include "YBaseLib/Platform.h"
+#include "YBaseLib/ThreadLocal.h"
+
+static ThreadLocal<MemoryArena> s_threadScratchArena;
+
+MemoryArena::MemoryArena(size_t blockSize /* = 65536 */, uint32 allocationFlags /* = 0 */)
+  : m_pFirstBlock(NULL), m_pCurrentBlock(NULL), m_blockSize(blockSize), m_memoryUsage(0),
+    m_allocationFlags(allocationFlags)
+{
+  DebugAssert(blockSize > 0);
+}
+
+MemoryArena::~MemoryArena()
+{
+  Block* pBlock = m_pFirstBlock;
+  while (pBlock != NULL)
+  {
+    Block* pNextBlock = pBlock->pNext;
+    std::free(pBlock);
+    pBlock = pNextBlock;
+  }
+}
+
+MemoryArena& MemoryArena::GetThreadScratchArena()
+{
+  return s_threadScratchArena.Get();
+}
+
+void MemoryArena::ReleaseThreadScratchArena()
+{
+  s_threadScratchArena.Release();
+}
+
+void* MemoryArena::Allocate(size_t size, size_t alignment)
+{
+  DebugAssert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+  for (;;)
+  {
+    if (m_pCurrentBlock != NULL)
+    {
+      // align the address rather than the offset, block data is only aligned to the header size
+      size_t base = reinterpret_cast<size_t>(GetBlockData(m_pCurrentBlock));
+      size_t start = (base + m_pCurrentBlock->Used + alignment - 1) & ~(size_t)(alignment - 1);
+      size_t offset = static_cast<size_t>(start - base);
+      if (offset <= m_pCurrentBlock->Size && size <= m_pCurrentBlock->Size - offset)
+      {
+        m_pCurrentBlock->Used = offset + size;
+        return reinterpret_cast<void*>(start);
+      }
+
+      // blocks after the current one are empty, either from a reset or because they were just added
+      if (m_pCurrentBlock->pNext != NULL)
+      {
+        m_pCurrentBlock = m_pCurrentBlock->pNext;
+        continue;
+      }
+    }
+
+    // out of blocks, oversized allocations get a block to themselves
+    size_t dataSize = Max(m_blockSize, size + alignment);
+    Block* pBlock = (Block*)std::malloc(sizeof(Block) + dataSize);
+    Assert(pBlock != NULL);
+    if (m_allocationFlags != 0)
+      Platform::AdviseMemory(pBlock, sizeof(Block) + dataSize, m_allocationFlags);
+
+    pBlock->pNext = NULL;
+    pBlock->Size = dataSize;
+    pBlock->Used = 0;
+    m_memoryUsage += sizeof(Block) + dataSize;
+
+    if (m_pCurrentBlock != NULL)
+      m_pCurrentBlock->pNext = pBlock;
+    else
+      m_pFirstBlock = pBlock;
+
+    m_pCurrentBlock = pBlock;
+  }
+}
+
+bool MemoryArena::TryResize(void* pMemory, size_t oldSize, size_t newSize)
+{
+  if (m_pCurrentBlock == NULL)
+    return false;
+
+  // only the allocation just below the current block's high water mark can change size
+  size_t offset = static_cast<size_t>(reinterpret_cast<byte*>(pMemory) - GetBlockData(m_pCurrentBlock));
+  if (reinterpret_cast<byte*>(pMemory) < GetBlockData(m_pCurrentBlock) || offset + oldSize != m_pCurrentBlock->Used ||
+      newSize > m_pCurrentBlock->Size - offset)
+  {
+    return false;
+  }
+
+  m_pCurrentBlock->Used = offset + newSize;
+  return true;
+}
+
+void MemoryArena::Release(void* pMemory, size_t size)
+{
+  TryResize(pMemory, size, 0);
+}
+
+void MemoryArena::Reset()
+{
+  for (Block* pBlock = m_pFirstBlock; pBlock != NULL; pBlock = pBlock->pNext)
+    pBlock->Used = 0;
+
+  m_pCurrentBlock = m_pFirstBlock;
+}
+
+MemoryArena::Marker MemoryArena::GetMarker() const
+{
+  Marker marker;
+  marker.pBlock = m_pCurrentBlock;
+  marker.Used = (m_pCurrentBlock != NULL) ? m_pCurrentBlock->Used : 0;
+  return marker;
+}
+
+void MemoryArena::Rewind(const Marker& marker)
+{
+  // a marker taken before the first block points at the start of the arena
+  Block* pBlock = (marker.pBlock != NULL) ? marker.pBlock : m_pFirstBlock;
+  if (pBlock == NULL)
+    return;
+
+  DebugAssert(marker.Used <= pBlock->Used);
+  pBlock->Used = marker.Used;
+
+  // the blocks after the current one have to be empty
+  for (Block* pNextBlock = pBlock->pNext; pNextBlock != NULL; pNextBlock = pNextBlock->pNext)
+    pNextBlock->Used = 0;
+
+  m_pCurrentBlock = pBlock;
+}
+
+size_t MemoryArena::GetBytesUsed() const
+{
+  size_t used = 0;
+  for (const Block* pBlock = m_pFirstBlock; pBlock != NULL; pBlock = pBlock->pNext)
+  {
+    used += pBlock->Used;
+    if (pBlock == m_pCurrentBlock)
+      break;
+  }
+
+  return used;
+}
+
+PoolAllocator::PoolAllocator(size_t slabSize /* = 16384 */)
+  : m_pFirstSlab(NULL), m_pSlabCurrent(NULL), m_pSlabEnd(NULL), m_slabSize(slabSize), m_liveBlockCount(0),
+    m_memoryUsage(0)
+{
+  DebugAssert(slabSize >= MaxBlockSize);
+  Y_memzero(m_pFreeLists, sizeof(m_pFreeLists));
+}
+
+PoolAllocator::PoolAllocator(const PoolAllocator& copy)
+  : m_pFirstSlab(NULL), m_pSlabCurrent(NULL), m_pSlabEnd(NULL), m_slabSize(copy.m_slabSize), m_liveBlockCount(0),
+    m_memoryUsage(0)
+{
+  Y_memzero(m_pFreeLists, sizeof(m_pFreeLists));
+}
+
+PoolAllocator::PoolAllocator(PoolAllocator&& from)
+  : m_pFirstSlab(from.m_pFirstSlab), m_pSlabCurrent(from.m_pSlabCurrent), m_pSlabEnd(from.m_pSlabEnd),
+    m_slabSize(from.m_slabSize), m_liveBlockCount(from.m_liveBlockCount), m_memoryUsage(from.m_memoryUsage)
+{
+  std::memcpy(m_pFreeLists, from.m_pFreeLists, sizeof(m_pFreeLists));
+  Y_memzero(from.m_pFreeLists, sizeof(from.m_pFreeLists));
+  from.m_pFirstSlab = NULL;
+  from.m_pSlabCurrent = from.m_pSlabEnd = NULL;
+  from.m_liveBlockCount = 0;
+  from.m_memoryUsage = 0;
+}
+
+PoolAllocator::~PoolAllocator()
+{
+  DebugAssert(m_liveBlockCount == 0);
+  ReleaseSlabs();
+}
+
+PoolAllocator& PoolAllocator::operator=(PoolAllocator&& from)
+{
+  if (&from == this)
+    return *this;
+
+  // anything still allocated from this pool would be left pointing at freed slabs
+  DebugAssert(m_liveBlockCount == 0);
+  ReleaseSlabs();
+
+  std::memcpy(m_pFreeLists, from.m_pFreeLists, sizeof(m_pFreeLists));
+  m_pFirstSlab = from.m_pFirstSlab;
+  m_pSlabCurrent = from.m_pSlabCurrent;
+  m_pSlabEnd = from.m_pSlabEnd;
+  m_slabSize = from.m_slabSize;
+  m_liveBlockCount = from.m_liveBlockCount;
+  m_memoryUsage = from.m_memoryUsage;
+
+  Y_memzero(from.m_pFreeLists, sizeof(from.m_pFreeLists));
+  from.m_pFirstSlab = NULL;
+  from.m_pSlabCurrent = from.m_pSlabEnd = NULL;
+  from.m_liveBlockCount = 0;
+  from.m_memoryUsage = 0;
+  return *this;
+}
+
+void PoolAllocator::AllocateSlab()
+{
+  // the header takes a whole granule so blocks stay aligned, the rest of the previous slab is abandoned
+  size_t allocationSize = PoolGranularity + m_slabSize;
+  Slab* pSlab = (Slab*)Y_aligned_malloc(allocationSize, PoolGranularity);
+  Assert(pSlab != NULL);
+  pSlab->pNext = m_pFirstSlab;
+  m_pFirstSlab = pSlab;
+  m_pSlabCurrent = reinterpret_cast<byte*>(pSlab) + PoolGranularity;
+  m_pSlabEnd = m_pSlabCurrent + m_slabSize;
+  m_memoryUsage += allocationSize;
+}
+
+void PoolAllocator::ReleaseSlabs()
+{
+  Slab* pSlab = m_pFirstSlab;
+  while (pSlab != NULL)
+  {
+    Slab* pNextSlab = pSlab->pNext;
+    Y_aligned_free(pSlab);
+    pSlab = pNextSlab;
+  }
+
+  Y_memzero(m_pFreeLists, sizeof(m_pFreeLists));
+  m_pFirstSlab = NULL;
+  m_pSlabCurrent = m_pSlabEnd = NULL;
+  m_memoryUsage = 0;
+}
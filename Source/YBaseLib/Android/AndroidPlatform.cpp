@@ -7,7 +7,9 @@
 #include <dlfcn.h>
 
 #include <cstdlib>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
 void Platform::MakeTempFileName(char* filename, uint32 len)
@@ -74,4 +76,118 @@ bool Platform::InitializeSocketSupport(Error* pError)
   return true;
 }
 
+void* Platform::AllocateMirroredMemory(size_t size)
+{
+  DebugAssert(size > 0 && (size % GetMirroredMemoryGranularity()) == 0);
+
+#if defined(__NR_memfd_create)
+  int fd = (int)syscall(__NR_memfd_create, "mirrored", 0);
+  if (fd < 0)
+    return nullptr;
+
+  // reserve the whole range first so nothing else can land between the two views
+  byte* pBase = nullptr;
+  if (ftruncate(fd, (off_t)size) == 0)
+  {
+    pBase = (byte*)mmap(nullptr, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pBase == MAP_FAILED)
+    {
+      pBase = nullptr;
+    }
+    else if (mmap(pBase, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+             mmap(pBase + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+      munmap(pBase, size * 2);
+      pBase = nullptr;
+    }
+  }
+
+  close(fd);
+  return pBase;
+#else
+  return nullptr;
+#endif
+}
+
+void Platform::FreeMirroredMemory(void* pMemory, size_t size)
+{
+  if (pMemory != nullptr)
+    munmap(pMemory, size * 2);
+}
+
+size_t Platform::GetMirroredMemoryGranularity()
+{
+  return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// transparent huge pages are this size where there are any
+static const size_t HugePageSize = 2 * 1024 * 1024;
+
+void* Platform::ReserveVirtualMemory(size_t size, uint32 flags)
+{
+  DebugAssert(size > 0 && (size % GetVirtualMemoryPageSize()) == 0);
+
+  // for huge pages, over-reserve so the range can start on one, and hand back the ends
+  size_t alignment = (flags & Y_MALLOC_FLAG_HUGE_PAGES) ? HugePageSize : 0;
+  byte* pBase =
+    (byte*)mmap(nullptr, size + alignment, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (pBase == MAP_FAILED)
+    return nullptr;
+
+  byte* pAligned = pBase;
+  if (alignment > 0)
+  {
+    pAligned = (byte*)(((size_t)pBase + alignment - 1) & ~(alignment - 1));
+    if (pAligned != pBase)
+      munmap(pBase, pAligned - pBase);
+    if (pAligned != pBase + alignment)
+      munmap(pAligned + size, (pBase + alignment) - pAligned);
+  }
+
+  if (flags != 0)
+    AdviseMemory(pAligned, size, flags);
+
+  return pAligned;
+}
+
+bool Platform::CommitVirtualMemory(void* pMemory, size_t size)
+{
+  return (mprotect(pMemory, size, PROT_READ | PROT_WRITE) == 0);
+}
+
+void Platform::DecommitVirtualMemory(void* pMemory, size_t size)
+{
+  // mapping fresh pages over the range drops the old ones, where madvise alone may keep them counted
+  mmap(pMemory, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+}
+
+void Platform::ReleaseVirtualMemory(void* pMemory, size_t size)
+{
+  if (pMemory != nullptr)
+    munmap(pMemory, size);
+}
+
+size_t Platform::GetVirtualMemoryPageSize()
+{
+  return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// phones aren't NUMA, so only huge pages apply
+void Platform::AdviseMemory(void* pMemory, size_t size, uint32 flags)
+{
+#if defined(MADV_HUGEPAGE)
+  size_t pageSize = GetVirtualMemoryPageSize();
+  size_t start = ((size_t)pMemory + pageSize - 1) & ~(pageSize - 1);
+  size_t end = ((size_t)pMemory + size) & ~(pageSize - 1);
+  if ((flags & Y_MALLOC_FLAG_HUGE_PAGES) && end > start && end - start >= HugePageSize)
+    madvise((void*)start, end - start, MADV_HUGEPAGE);
+#endif
+}
+
+// bionic has no backtrace()
+uint32 Platform::CaptureCallStack(void** ppFrames, uint32 maxFrames, uint32 skipFrames)
+{
+  return 0;
+}
+
 #endif // Y_PLATFORM_ANDROID
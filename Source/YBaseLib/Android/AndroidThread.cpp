@@ -2,9 +2,13 @@
 
 #if defined(Y_PLATFORM_ANDROID)
 
+#include "YBaseLib/Allocator.h"
 #include "YBaseLib/Android/AndroidThread.h"
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Log.h"
+#include "YBaseLib/ThreadCachedHeap.h"
+#include "YBaseLib/ThreadLocal.h"
+#include <sched.h>
 #include <unistd.h>
 // Log_SetChannel(Thread);
 
@@ -72,6 +76,13 @@ int32 Thread::Join()
   return *(int32*)&threadExitCode;
 }
 
+bool Thread::SetAffinityMask(uint64 mask)
+{
+  // sched_setaffinity needs the kernel thread id, which can only be obtained from the thread itself
+  Assert(m_threadHandle != 0);
+  return false;
+}
+
 void Thread::SetDebugName(const char* threadName) {}
 
 void* Thread::__ThreadStart(void* pArguments)
@@ -83,6 +94,11 @@ void* Thread::__ThreadStart(void* pArguments)
   // run the thread
   int threadExitCode = pThread->ThreadEntryPoint();
 
+  // free anything the thread left behind
+  ThreadLocalBase::ReleaseCurrentThreadValues();
+  ThreadCachedHeap::ReleaseThreadCache();
+  Log::ReleaseThreadBuffer();
+
   // unset running flag
   pThread->m_bRunning = false;
   MemoryBarrier();
@@ -114,4 +130,17 @@ void Thread::Sleep(uint32 millisecondsToSleep)
   usleep(millisecondsToSleep * 1000);
 }
 
+bool Thread::SetCurrentThreadAffinityMask(uint64 mask)
+{
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  for (uint32 i = 0; i < 64; i++)
+  {
+    if (mask & ((uint64)1 << i))
+      CPU_SET(i, &cpuSet);
+  }
+
+  return (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0);
+}
+
 #endif
@@ -0,0 +1,259 @@
+#include "YBaseLib/ArrayAlgorithms.h"
+#include "YBaseLib/CPUID.h"
+#include "ArrayAlgorithmsKernels.h"
+
+#if defined(Y_ARRAY_ALGORITHMS_X86)
+
+// int32 and uint32, unsigned compares flip the sign bits first
+template<typename T>
+struct SSE2Int32Ops : LaneCompact<SSE2Int32Ops<T>>
+{
+  typedef T Element;
+  typedef __m128i Vector;
+  typedef __m128i Mask;
+  static const uint32 Width = 4;
+
+  static Vector Load(const T* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+  static void Store(T* p, Vector v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+  static Vector Set(T v) { return _mm_set1_epi32(static_cast<int32>(v)); }
+  static Vector Add(Vector a, Vector b) { return _mm_add_epi32(a, b); }
+  static Vector Bias(Vector v) { return std::is_signed<T>::value ? v : _mm_xor_si128(v, _mm_set1_epi32(INT32_MIN)); }
+  static Mask Not(Mask mask) { return _mm_xor_si128(mask, _mm_set1_epi32(-1)); }
+
+  static Mask Equal(Vector a, Vector b) { return _mm_cmpeq_epi32(a, b); }
+  static Mask NotEqual(Vector a, Vector b) { return Not(_mm_cmpeq_epi32(a, b)); }
+  static Mask Less(Vector a, Vector b) { return _mm_cmplt_epi32(Bias(a), Bias(b)); }
+  static Mask LessEqual(Vector a, Vector b) { return Not(_mm_cmpgt_epi32(Bias(a), Bias(b))); }
+  static Mask Or(Mask a, Mask b) { return _mm_or_si128(a, b); }
+  static uint32 MaskBits(Mask mask) { return _mm_movemask_ps(_mm_castsi128_ps(mask)); }
+
+  static Vector Select(Mask mask, Vector a, Vector b)
+  {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+  }
+  static Vector Min(Vector v, Vector acc) { return Select(Less(v, acc), v, acc); }
+  static Vector Max(Vector v, Vector acc) { return Select(Less(acc, v), v, acc); }
+
+  static Vector ScanAdd(Vector v)
+  {
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+    return _mm_add_epi32(v, _mm_slli_si128(v, 8));
+  }
+  static Vector BroadcastLast(Vector v) { return _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3)); }
+};
+
+struct SSE2FloatOps : LaneCompact<SSE2FloatOps>
+{
+  typedef float Element;
+  typedef __m128 Vector;
+  typedef __m128 Mask;
+  static const uint32 Width = 4;
+
+  static Vector Load(const float* p) { return _mm_loadu_ps(p); }
+  static void Store(float* p, Vector v) { _mm_storeu_ps(p, v); }
+  static Vector Set(float v) { return _mm_set1_ps(v); }
+  static Vector Add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+
+  static Mask Equal(Vector a, Vector b) { return _mm_cmpeq_ps(a, b); }
+  static Mask NotEqual(Vector a, Vector b) { return _mm_cmpneq_ps(a, b); }
+  static Mask Less(Vector a, Vector b) { return _mm_cmplt_ps(a, b); }
+  static Mask LessEqual(Vector a, Vector b) { return _mm_cmple_ps(a, b); }
+  static Mask Or(Mask a, Mask b) { return _mm_or_ps(a, b); }
+  static uint32 MaskBits(Mask mask) { return _mm_movemask_ps(mask); }
+
+  static Vector Min(Vector v, Vector acc) { return _mm_min_ps(v, acc); }
+  static Vector Max(Vector v, Vector acc) { return _mm_max_ps(v, acc); }
+
+  static Vector ScanAdd(Vector v)
+  {
+    v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)));
+    return _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+  }
+  static Vector BroadcastLast(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)); }
+};
+
+struct SSE2DoubleOps : LaneCompact<SSE2DoubleOps>
+{
+  typedef double Element;
+  typedef __m128d Vector;
+  typedef __m128d Mask;
+  static const uint32 Width = 2;
+
+  static Vector Load(const double* p) { return _mm_loadu_pd(p); }
+  static void Store(double* p, Vector v) { _mm_storeu_pd(p, v); }
+  static Vector Set(double v) { return _mm_set1_pd(v); }
+  static Vector Add(Vector a, Vector b) { return _mm_add_pd(a, b); }
+
+  static Mask Equal(Vector a, Vector b) { return _mm_cmpeq_pd(a, b); }
+  static Mask NotEqual(Vector a, Vector b) { return _mm_cmpneq_pd(a, b); }
+  static Mask Less(Vector a, Vector b) { return _mm_cmplt_pd(a, b); }
+  static Mask LessEqual(Vector a, Vector b) { return _mm_cmple_pd(a, b); }
+  static Mask Or(Mask a, Mask b) { return _mm_or_pd(a, b); }
+  static uint32 MaskBits(Mask mask) { return _mm_movemask_pd(mask); }
+
+  static Vector Min(Vector v, Vector acc) { return _mm_min_pd(v, acc); }
+  static Vector Max(Vector v, Vector acc) { return _mm_max_pd(v, acc); }
+
+  static Vector ScanAdd(Vector v) { return _mm_add_pd(v, _mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(v), 8))); }
+  static Vector BroadcastLast(Vector v) { return _mm_unpackhi_pd(v, v); }
+};
+
+
+#elif defined(Y_ARRAY_ALGORITHMS_NEON)
+
+// one bit per lane, summed across
+static inline uint32 NEONMaskBits(uint32x4_t mask)
+{
+  static const uint32 laneBits[4] = {1, 2, 4, 8};
+  return vaddvq_u32(vandq_u32(mask, vld1q_u32(laneBits)));
+}
+static inline uint32 NEONMaskBits(uint64x2_t mask)
+{
+  static const uint64 laneBits[2] = {1, 2};
+  return (uint32)vaddvq_u64(vandq_u64(mask, vld1q_u64(laneBits)));
+}
+
+// The instructions differ only in their suffix between element types. Min and max select with a compare, as there
+// are no 64-bit ones and vminq/vmaxq would give NaN rather than skip it.
+#define NEON_ARRAY_OPS(Name, T, VectorType, TypeSuffix, MaskType, MaskSuffix, MaskElement, LaneCount)                  \
+  struct Name : LaneCompact<Name>                                                                                      \
+  {                                                                                                                    \
+    typedef T Element;                                                                                                 \
+    typedef VectorType Vector;                                                                                         \
+    typedef MaskType Mask;                                                                                             \
+    static const uint32 Width = LaneCount;                                                                             \
+                                                                                                                       \
+    static Vector Load(const T* p) { return vld1q_##TypeSuffix(p); }                                                   \
+    static void Store(T* p, Vector v) { vst1q_##TypeSuffix(p, v); }                                                   \
+    static Vector Set(T v) { return vdupq_n_##TypeSuffix(v); }                                                         \
+    static Vector Add(Vector a, Vector b) { return vaddq_##TypeSuffix(a, b); }                                         \
+                                                                                                                       \
+    static Mask Equal(Vector a, Vector b) { return vceqq_##TypeSuffix(a, b); }                                         \
+    static Mask NotEqual(Vector a, Vector b)                                                                           \
+    {                                                                                                                  \
+      return veorq_##MaskSuffix(vceqq_##TypeSuffix(a, b), vdupq_n_##MaskSuffix(~(MaskElement)0));                     \
+    }                                                                                                                  \
+    static Mask Less(Vector a, Vector b) { return vcltq_##TypeSuffix(a, b); }                                          \
+    static Mask LessEqual(Vector a, Vector b) { return vcleq_##TypeSuffix(a, b); }                                     \
+    static Mask Or(Mask a, Mask b) { return vorrq_##MaskSuffix(a, b); }                                                \
+    static uint32 MaskBits(Mask mask) { return NEONMaskBits(mask); }                                                   \
+                                                                                                                       \
+    static Vector Min(Vector v, Vector acc) { return vbslq_##TypeSuffix(vcltq_##TypeSuffix(v, acc), v, acc); }         \
+    static Vector Max(Vector v, Vector acc) { return vbslq_##TypeSuffix(vcgtq_##TypeSuffix(v, acc), v, acc); }         \
+                                                                                                                       \
+    static Vector ScanAdd(Vector v)                                                                                    \
+    {                                                                                                                  \
+      Vector zero = vdupq_n_##TypeSuffix(0);                                                                           \
+      v = vaddq_##TypeSuffix(v, vextq_##TypeSuffix(zero, v, LaneCount - 1));                                           \
+      if (LaneCount > 2)                                                                                               \
+        v = vaddq_##TypeSuffix(v, vextq_##TypeSuffix(zero, v, LaneCount - 2));                                         \
+      return v;                                                                                                        \
+    }                                                                                                                  \
+    static Vector BroadcastLast(Vector v) { return vdupq_laneq_##TypeSuffix(v, LaneCount - 1); }                       \
+  };
+
+NEON_ARRAY_OPS(NEONInt32Ops, int32, int32x4_t, s32, uint32x4_t, u32, uint32, 4)
+NEON_ARRAY_OPS(NEONUInt32Ops, uint32, uint32x4_t, u32, uint32x4_t, u32, uint32, 4)
+NEON_ARRAY_OPS(NEONInt64Ops, int64, int64x2_t, s64, uint64x2_t, u64, uint64, 2)
+NEON_ARRAY_OPS(NEONUInt64Ops, uint64, uint64x2_t, u64, uint64x2_t, u64, uint64, 2)
+NEON_ARRAY_OPS(NEONFloatOps, float, float32x4_t, f32, uint32x4_t, u32, uint32, 4)
+NEON_ARRAY_OPS(NEONDoubleOps, double, float64x2_t, f64, uint64x2_t, u64, uint64, 2)
+
+#endif
+
+ARRAY_KERNELS(ScalarInt32, ScalarOps<int32>)
+ARRAY_KERNELS(ScalarUInt32, ScalarOps<uint32>)
+ARRAY_KERNELS(ScalarInt64, ScalarOps<int64>)
+ARRAY_KERNELS(ScalarUInt64, ScalarOps<uint64>)
+ARRAY_KERNELS(ScalarFloat, ScalarOps<float>)
+ARRAY_KERNELS(ScalarDouble, ScalarOps<double>)
+
+// SSE2 has no 64-bit compares, so without AVX2 64-bit integers stay scalar. The AVX2 kernels are in
+// ArrayAlgorithmsAVX2.cpp.
+#if defined(Y_ARRAY_ALGORITHMS_X86)
+ARRAY_KERNELS(SSE2Int32, SSE2Int32Ops<int32>)
+ARRAY_KERNELS(SSE2UInt32, SSE2Int32Ops<uint32>)
+ARRAY_KERNELS(SSE2Float, SSE2FloatOps)
+ARRAY_KERNELS(SSE2Double, SSE2DoubleOps)
+#define ARRAY_KERNELS_SELECT(Name, Fallback)                                                                           \
+  (Y_CPUHasFeatures(Y_CPU_FEATURE_AVX2) ? GetArrayKernelsAVX2()->p##Name : &s_kernels##Fallback##Name)
+#elif defined(Y_ARRAY_ALGORITHMS_NEON)
+ARRAY_KERNELS(NEONInt32, NEONInt32Ops)
+ARRAY_KERNELS(NEONUInt32, NEONUInt32Ops)
+ARRAY_KERNELS(NEONInt64, NEONInt64Ops)
+ARRAY_KERNELS(NEONUInt64, NEONUInt64Ops)
+ARRAY_KERNELS(NEONFloat, NEONFloatOps)
+ARRAY_KERNELS(NEONDouble, NEONDoubleOps)
+#define ARRAY_KERNELS_SELECT(Name, Fallback) (&s_kernelsNEON##Name)
+#else
+#define ARRAY_KERNELS_SELECT(Name, Fallback) (&s_kernelsScalar##Name)
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+// dispatch
+//---------------------------------------------------------------------------------------------------------------------
+
+static const ArrayKernels<int32>* SelectInt32Kernels()
+{
+  return ARRAY_KERNELS_SELECT(Int32, SSE2);
+}
+static const ArrayKernels<uint32>* SelectUInt32Kernels()
+{
+  return ARRAY_KERNELS_SELECT(UInt32, SSE2);
+}
+static const ArrayKernels<int64>* SelectInt64Kernels()
+{
+  return ARRAY_KERNELS_SELECT(Int64, Scalar);
+}
+static const ArrayKernels<uint64>* SelectUInt64Kernels()
+{
+  return ARRAY_KERNELS_SELECT(UInt64, Scalar);
+}
+static const ArrayKernels<float>* SelectFloatKernels()
+{
+  return ARRAY_KERNELS_SELECT(Float, SSE2);
+}
+static const ArrayKernels<double>* SelectDoubleKernels()
+{
+  return ARRAY_KERNELS_SELECT(Double, SSE2);
+}
+
+Y_CPU_DISPATCH(s_pInt32Kernels, s_kernelsScalarInt32, SelectInt32Kernels);
+Y_CPU_DISPATCH(s_pUInt32Kernels, s_kernelsScalarUInt32, SelectUInt32Kernels);
+Y_CPU_DISPATCH(s_pInt64Kernels, s_kernelsScalarInt64, SelectInt64Kernels);
+Y_CPU_DISPATCH(s_pUInt64Kernels, s_kernelsScalarUInt64, SelectUInt64Kernels);
+Y_CPU_DISPATCH(s_pFloatKernels, s_kernelsScalarFloat, SelectFloatKernels);
+Y_CPU_DISPATCH(s_pDoubleKernels, s_kernelsScalarDouble, SelectDoubleKernels);
+
+#define ARRAY_ENTRY_POINTS(T, Name)                                                                                    \
+  int32 Y_array_find(const T* pValues, uint32 count, T value)                                                          \
+  {                                                                                                                    \
+    return s_p##Name##Kernels->Find(pValues, count, value);                                                            \
+  }                                                                                                                    \
+  uint32 Y_array_count(const T* pValues, uint32 count, Y_ARRAY_COMPARE compare, T value)                               \
+  {                                                                                                                    \
+    return s_p##Name##Kernels->Count(pValues, count, compare, value);                                                  \
+  }                                                                                                                    \
+  uint32 Y_array_filter(T* pResult, const T* pValues, uint32 count, Y_ARRAY_COMPARE compare, T value)                  \
+  {                                                                                                                    \
+    return s_p##Name##Kernels->Filter(pResult, pValues, count, compare, value);                                        \
+  }                                                                                                                    \
+  bool Y_array_minmax(const T* pValues, uint32 count, T* pMin, T* pMax)                                                \
+  {                                                                                                                    \
+    return s_p##Name##Kernels->MinMax(pValues, count, pMin, pMax);                                                     \
+  }                                                                                                                    \
+  T Y_array_sum(const T* pValues, uint32 count)                                                                        \
+  {                                                                                                                    \
+    return s_p##Name##Kernels->Sum(pValues, count);                                                                    \
+  }                                                                                                                    \
+  T Y_array_prefix_sum(T* pResult, const T* pValues, uint32 count, T initial)                                          \
+  {                                                                                                                    \
+    return s_p##Name##Kernels->PrefixSum(pResult, pValues, count, initial);                                            \
+  }
+
+ARRAY_ENTRY_POINTS(int32, Int32)
+ARRAY_ENTRY_POINTS(uint32, UInt32)
+ARRAY_ENTRY_POINTS(int64, Int64)
+ARRAY_ENTRY_POINTS(uint64, UInt64)
+ARRAY_ENTRY_POINTS(float, Float)
+ARRAY_ENTRY_POINTS(double, Double)
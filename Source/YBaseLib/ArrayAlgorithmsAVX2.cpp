@@ -0,0 +1,264 @@
+#include "YBaseLib/ArrayAlgorithms.h"
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <immintrin.h>
+
+// Everything after the library headers is built for AVX2, the shared kernel templates as well as the operations, so
+// AVX vectors only ever pass between functions that have it enabled. MSVC gets /arch:AVX2 for this file instead.
+#if defined(Y_COMPILER_GCC)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#elif defined(Y_COMPILER_CLANG)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#endif
+
+#include "ArrayAlgorithmsKernels.h"
+
+namespace {
+
+// For each mask, the lanes it keeps in order, a byte each. The 64-bit table lists both halves of each lane.
+static uint64 s_compactPermutations32[256];
+static uint64 s_compactPermutations64[16];
+
+static bool BuildCompactPermutations()
+{
+  for (uint32 bits = 0; bits < 256; bits++)
+  {
+    uint32 keptCount = 0;
+    for (uint32 lane = 0; lane < 8; lane++)
+    {
+      if (bits & (1u << lane))
+        s_compactPermutations32[bits] |= (uint64)lane << (8 * keptCount++);
+    }
+  }
+
+  for (uint32 bits = 0; bits < 16; bits++)
+  {
+    uint32 keptCount = 0;
+    for (uint32 lane = 0; lane < 4; lane++)
+    {
+      if (bits & (1u << lane))
+      {
+        s_compactPermutations64[bits] |= (uint64)(lane * 2) << (8 * keptCount++);
+        s_compactPermutations64[bits] |= (uint64)(lane * 2 + 1) << (8 * keptCount++);
+      }
+    }
+  }
+
+  return true;
+}
+
+static inline __m256i LoadCompactPermutation(const uint64* pTable, uint32 bits)
+{
+  return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pTable + bits)));
+}
+
+// Adds the last lane of the low half to the whole of the high half, after a running sum within each half.
+static inline __m256i CarryAcrossHalves32(__m256i v)
+{
+  __m256i last = _mm256_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+  return _mm256_add_epi32(v, _mm256_permute2x128_si256(last, last, 0x08));
+}
+
+template<typename T>
+struct AVX2Int32Ops
+{
+  typedef T Element;
+  typedef __m256i Vector;
+  typedef __m256i Mask;
+  static const uint32 Width = 8;
+
+  static Vector Load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+  static void Store(T* p, Vector v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+  static Vector Set(T v) { return _mm256_set1_epi32(static_cast<int32>(v)); }
+  static Vector Add(Vector a, Vector b) { return _mm256_add_epi32(a, b); }
+  static Vector Bias(Vector v)
+  {
+    return std::is_signed<T>::value ? v : _mm256_xor_si256(v, _mm256_set1_epi32(INT32_MIN));
+  }
+  static Mask Not(Mask mask) { return _mm256_xor_si256(mask, _mm256_set1_epi32(-1)); }
+
+  static Mask Equal(Vector a, Vector b) { return _mm256_cmpeq_epi32(a, b); }
+  static Mask NotEqual(Vector a, Vector b) { return Not(_mm256_cmpeq_epi32(a, b)); }
+  static Mask Less(Vector a, Vector b) { return _mm256_cmpgt_epi32(Bias(b), Bias(a)); }
+  static Mask LessEqual(Vector a, Vector b) { return Not(_mm256_cmpgt_epi32(Bias(a), Bias(b))); }
+  static Mask Or(Mask a, Mask b) { return _mm256_or_si256(a, b); }
+  static uint32 MaskBits(Mask mask) { return _mm256_movemask_ps(_mm256_castsi256_ps(mask)); }
+
+  static Vector Min(Vector v, Vector acc)
+  {
+    return std::is_signed<T>::value ? _mm256_min_epi32(v, acc) : _mm256_min_epu32(v, acc);
+  }
+  static Vector Max(Vector v, Vector acc)
+  {
+    return std::is_signed<T>::value ? _mm256_max_epi32(v, acc) : _mm256_max_epu32(v, acc);
+  }
+
+  static Vector ScanAdd(Vector v)
+  {
+    v = _mm256_add_epi32(v, _mm256_slli_si256(v, 4));
+    v = _mm256_add_epi32(v, _mm256_slli_si256(v, 8));
+    return CarryAcrossHalves32(v);
+  }
+  static Vector BroadcastLast(Vector v) { return _mm256_permutevar8x32_epi32(v, _mm256_set1_epi32(7)); }
+
+  // the kept lanes moved to the front, and all eight stored
+  static uint32 Compact(T* pResult, Vector v, uint32 bits)
+  {
+    Store(pResult, _mm256_permutevar8x32_epi32(v, LoadCompactPermutation(s_compactPermutations32, bits)));
+    return CountBits(bits);
+  }
+};
+
+// int64 and uint64, there's no 64-bit min or max so they select with a compare
+template<typename T>
+struct AVX2Int64Ops
+{
+  typedef T Element;
+  typedef __m256i Vector;
+  typedef __m256i Mask;
+  static const uint32 Width = 4;
+
+  static Vector Load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+  static void Store(T* p, Vector v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+  static Vector Set(T v) { return _mm256_set1_epi64x(static_cast<int64>(v)); }
+  static Vector Add(Vector a, Vector b) { return _mm256_add_epi64(a, b); }
+  static Vector Bias(Vector v)
+  {
+    return std::is_signed<T>::value ? v : _mm256_xor_si256(v, _mm256_set1_epi64x(INT64_MIN));
+  }
+  static Mask Not(Mask mask) { return _mm256_xor_si256(mask, _mm256_set1_epi32(-1)); }
+
+  static Mask Equal(Vector a, Vector b) { return _mm256_cmpeq_epi64(a, b); }
+  static Mask NotEqual(Vector a, Vector b) { return Not(_mm256_cmpeq_epi64(a, b)); }
+  static Mask Less(Vector a, Vector b) { return _mm256_cmpgt_epi64(Bias(b), Bias(a)); }
+  static Mask LessEqual(Vector a, Vector b) { return Not(_mm256_cmpgt_epi64(Bias(a), Bias(b))); }
+  static Mask Or(Mask a, Mask b) { return _mm256_or_si256(a, b); }
+  static uint32 MaskBits(Mask mask) { return _mm256_movemask_pd(_mm256_castsi256_pd(mask)); }
+
+  static Vector Min(Vector v, Vector acc) { return _mm256_blendv_epi8(acc, v, Less(v, acc)); }
+  static Vector Max(Vector v, Vector acc) { return _mm256_blendv_epi8(acc, v, Less(acc, v)); }
+
+  static Vector ScanAdd(Vector v)
+  {
+    v = _mm256_add_epi64(v, _mm256_slli_si256(v, 8));
+    __m256i last = _mm256_shuffle_epi32(v, _MM_SHUFFLE(3, 2, 3, 2));
+    return _mm256_add_epi64(v, _mm256_permute2x128_si256(last, last, 0x08));
+  }
+  static Vector BroadcastLast(Vector v) { return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+  static uint32 Compact(T* pResult, Vector v, uint32 bits)
+  {
+    Store(pResult, _mm256_permutevar8x32_epi32(v, LoadCompactPermutation(s_compactPermutations64, bits)));
+    return CountBits(bits);
+  }
+};
+
+struct AVX2FloatOps
+{
+  typedef float Element;
+  typedef __m256 Vector;
+  typedef __m256 Mask;
+  static const uint32 Width = 8;
+
+  static Vector Load(const float* p) { return _mm256_loadu_ps(p); }
+  static void Store(float* p, Vector v) { _mm256_storeu_ps(p, v); }
+  static Vector Set(float v) { return _mm256_set1_ps(v); }
+  static Vector Add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+
+  static Mask Equal(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+  static Mask NotEqual(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+  static Mask Less(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static Mask LessEqual(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+  static Mask Or(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+  static uint32 MaskBits(Mask mask) { return _mm256_movemask_ps(mask); }
+
+  static Vector Min(Vector v, Vector acc) { return _mm256_min_ps(v, acc); }
+  static Vector Max(Vector v, Vector acc) { return _mm256_max_ps(v, acc); }
+
+  static Vector ScanAdd(Vector v)
+  {
+    v = _mm256_add_ps(v, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(v), 4)));
+    v = _mm256_add_ps(v, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(v), 8)));
+    __m256 last = _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm256_add_ps(v, _mm256_permute2f128_ps(last, last, 0x08));
+  }
+  static Vector BroadcastLast(Vector v) { return _mm256_permutevar8x32_ps(v, _mm256_set1_epi32(7)); }
+
+  static uint32 Compact(float* pResult, Vector v, uint32 bits)
+  {
+    Store(pResult, _mm256_permutevar8x32_ps(v, LoadCompactPermutation(s_compactPermutations32, bits)));
+    return CountBits(bits);
+  }
+};
+
+struct AVX2DoubleOps
+{
+  typedef double Element;
+  typedef __m256d Vector;
+  typedef __m256d Mask;
+  static const uint32 Width = 4;
+
+  static Vector Load(const double* p) { return _mm256_loadu_pd(p); }
+  static void Store(double* p, Vector v) { _mm256_storeu_pd(p, v); }
+  static Vector Set(double v) { return _mm256_set1_pd(v); }
+  static Vector Add(Vector a, Vector b) { return _mm256_add_pd(a, b); }
+
+  static Mask Equal(Vector a, Vector b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+  static Mask NotEqual(Vector a, Vector b) { return _mm256_cmp_pd(a, b, _CMP_NEQ_UQ); }
+  static Mask Less(Vector a, Vector b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static Mask LessEqual(Vector a, Vector b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+  static Mask Or(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+  static uint32 MaskBits(Mask mask) { return _mm256_movemask_pd(mask); }
+
+  static Vector Min(Vector v, Vector acc) { return _mm256_min_pd(v, acc); }
+  static Vector Max(Vector v, Vector acc) { return _mm256_max_pd(v, acc); }
+
+  static Vector ScanAdd(Vector v)
+  {
+    v = _mm256_add_pd(v, _mm256_castsi256_pd(_mm256_slli_si256(_mm256_castpd_si256(v), 8)));
+    __m256d last = _mm256_permute_pd(v, 0x0F);
+    return _mm256_add_pd(v, _mm256_permute2f128_pd(last, last, 0x08));
+  }
+  static Vector BroadcastLast(Vector v) { return _mm256_permute4x64_pd(v, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+  static uint32 Compact(double* pResult, Vector v, uint32 bits)
+  {
+    __m256i permutation = LoadCompactPermutation(s_compactPermutations64, bits);
+    Store(pResult, _mm256_castsi256_pd(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(v), permutation)));
+    return CountBits(bits);
+  }
+};
+
+
+} // namespace
+
+ARRAY_KERNELS(AVX2Int32, AVX2Int32Ops<int32>)
+ARRAY_KERNELS(AVX2UInt32, AVX2Int32Ops<uint32>)
+ARRAY_KERNELS(AVX2Int64, AVX2Int64Ops<int64>)
+ARRAY_KERNELS(AVX2UInt64, AVX2Int64Ops<uint64>)
+ARRAY_KERNELS(AVX2Float, AVX2FloatOps)
+ARRAY_KERNELS(AVX2Double, AVX2DoubleOps)
+
+static const ArrayKernelsAVX2 s_kernelsAVX2 = {&s_kernelsAVX2Int32,  &s_kernelsAVX2UInt32, &s_kernelsAVX2Int64,
+                                               &s_kernelsAVX2UInt64, &s_kernelsAVX2Float,  &s_kernelsAVX2Double};
+
+// The permutation tables are filled in on the first call rather than at startup, as the dispatch calling this runs
+// during static initialisation too.
+const ArrayKernelsAVX2* GetArrayKernelsAVX2()
+{
+  static const bool permutationsBuilt = BuildCompactPermutations();
+  UNREFERENCED_PARAMETER(permutationsBuilt);
+  return &s_kernelsAVX2;
+}
+
+#if defined(Y_COMPILER_GCC)
+#pragma GCC pop_options
+#elif defined(Y_COMPILER_CLANG)
+#pragma clang attribute pop
+#endif
+
+#endif
@@ -0,0 +1,437 @@
+#pragma once
+#include "YBaseLib/ArrayAlgorithms.h"
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+// The kernels and the operations they're written against, shared by ArrayAlgorithms.cpp and the translation units
+// built for other instruction sets. Everything but the kernel tables is in an anonymous namespace, so each of those
+// gets its own copy compiled for its own instruction set, and none is picked over another at link time.
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <immintrin.h>
+#define Y_ARRAY_ALGORITHMS_X86 1
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_ARRAY_ALGORITHMS_NEON 1
+#endif
+
+template<typename T>
+struct ArrayKernels
+{
+  int32 (*Find)(const T* pValues, uint32 count, T value);
+  uint32 (*Count)(const T* pValues, uint32 count, Y_ARRAY_COMPARE compare, T value);
+  uint32 (*Filter)(T* pResult, const T* pValues, uint32 count, Y_ARRAY_COMPARE compare, T value);
+  bool (*MinMax)(const T* pValues, uint32 count, T* pMin, T* pMax);
+  T (*Sum)(const T* pValues, uint32 count);
+  T (*PrefixSum)(T* pResult, const T* pValues, uint32 count, T initial);
+};
+
+#if defined(Y_ARRAY_ALGORITHMS_X86)
+
+struct ArrayKernelsAVX2
+{
+  const ArrayKernels<int32>* pInt32;
+  const ArrayKernels<uint32>* pUInt32;
+  const ArrayKernels<int64>* pInt64;
+  const ArrayKernels<uint64>* pUInt64;
+  const ArrayKernels<float>* pFloat;
+  const ArrayKernels<double>* pDouble;
+};
+
+// In ArrayAlgorithmsAVX2.cpp, which is built for AVX2, so only to be called once the cpu is known to have it.
+const ArrayKernelsAVX2* GetArrayKernelsAVX2();
+
+#endif
+
+namespace {
+
+// Like MathArray.cpp, the kernels are written once against a small set of operations, which each instruction set
+// provides per element type as a struct of static functions. Masks are whatever the compares return, and MaskBits
+// packs them to one bit per lane. Values past the last whole vector go through the scalar operations, which compare
+// and round the same way.
+
+// signed integers wrap rather than overflow
+template<typename T>
+static inline T AddElements(T a, T b)
+{
+  return a + b;
+}
+static inline int32 AddElements(int32 a, int32 b)
+{
+  return static_cast<int32>(static_cast<uint32>(a) + static_cast<uint32>(b));
+}
+static inline int64 AddElements(int64 a, int64 b)
+{
+  return static_cast<int64>(static_cast<uint64>(a) + static_cast<uint64>(b));
+}
+
+// the starting points for min and max, infinity for floating point so it's reached by any value but NaN
+template<typename T>
+struct ElementLimits
+{
+  static T Lowest() { return std::numeric_limits<T>::lowest(); }
+  static T Highest() { return std::numeric_limits<T>::max(); }
+};
+template<>
+struct ElementLimits<float>
+{
+  static float Lowest() { return -std::numeric_limits<float>::infinity(); }
+  static float Highest() { return std::numeric_limits<float>::infinity(); }
+};
+template<>
+struct ElementLimits<double>
+{
+  static double Lowest() { return -std::numeric_limits<double>::infinity(); }
+  static double Highest() { return std::numeric_limits<double>::infinity(); }
+};
+
+// masks have at most eight lanes
+static inline uint32 CountBits(uint32 bits)
+{
+  bits = bits - ((bits >> 1) & 0x55);
+  bits = (bits & 0x33) + ((bits >> 2) & 0x33);
+  return (bits + (bits >> 4)) & 0x0F;
+}
+
+// Each lane is written over the next free slot, and kept by moving past it, so up to Width elements are written.
+template<class V>
+struct LaneCompact
+{
+  template<typename T, typename Vector>
+  static uint32 Compact(T* pResult, Vector v, uint32 bits)
+  {
+    T lanes[V::Width];
+    V::Store(lanes, v);
+
+    uint32 keptCount = 0;
+    for (uint32 i = 0; i < V::Width; i++)
+    {
+      pResult[keptCount] = lanes[i];
+      keptCount += (bits >> i) & 1;
+    }
+
+    return keptCount;
+  }
+};
+
+template<typename T>
+struct ScalarOps : LaneCompact<ScalarOps<T>>
+{
+  typedef T Element;
+  typedef T Vector;
+  typedef bool Mask;
+  static const uint32 Width = 1;
+
+  static Vector Load(const T* p) { return *p; }
+  static void Store(T* p, Vector v) { *p = v; }
+  static Vector Set(T v) { return v; }
+  static Vector Add(Vector a, Vector b) { return AddElements(a, b); }
+
+  static Mask Equal(Vector a, Vector b) { return (a == b); }
+  static Mask NotEqual(Vector a, Vector b) { return (a != b); }
+  static Mask Less(Vector a, Vector b) { return (a < b); }
+  static Mask LessEqual(Vector a, Vector b) { return (a <= b); }
+  static Mask Or(Mask a, Mask b) { return (a || b); }
+  static uint32 MaskBits(Mask mask) { return mask ? 1 : 0; }
+
+  // NaN in v gives acc, as with the SSE instructions
+  static Vector Min(Vector v, Vector acc) { return (v < acc) ? v : acc; }
+  static Vector Max(Vector v, Vector acc) { return (v > acc) ? v : acc; }
+
+  // running sum across the lanes, and the last lane in all of them
+  static Vector ScanAdd(Vector v) { return v; }
+  static Vector BroadcastLast(Vector v) { return v; }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// kernels
+//---------------------------------------------------------------------------------------------------------------------
+
+template<class V, Y_ARRAY_COMPARE C>
+static inline typename V::Mask CompareVector(typename V::Vector a, typename V::Vector b)
+{
+  switch (C)
+  {
+    case Y_ARRAY_COMPARE_NOT_EQUAL:
+      return V::NotEqual(a, b);
+    case Y_ARRAY_COMPARE_LESS:
+      return V::Less(a, b);
+    case Y_ARRAY_COMPARE_LESS_EQUAL:
+      return V::LessEqual(a, b);
+    case Y_ARRAY_COMPARE_GREATER:
+      return V::Less(b, a);
+    case Y_ARRAY_COMPARE_GREATER_EQUAL:
+      return V::LessEqual(b, a);
+    default:
+      return V::Equal(a, b);
+  }
+}
+
+template<class V>
+static int32 FindArray(const typename V::Element* pValues, uint32 count, typename V::Element value)
+{
+  typedef typename V::Mask Mask;
+  typename V::Vector needle = V::Set(value);
+
+  // four vectors at a time until there's a match somewhere in them, then one at a time to find which
+  uint32 i = 0;
+  for (; (i + V::Width * 4) <= count; i += V::Width * 4)
+  {
+    Mask mask0 = V::Equal(V::Load(pValues + i), needle);
+    Mask mask1 = V::Equal(V::Load(pValues + i + V::Width), needle);
+    Mask mask2 = V::Equal(V::Load(pValues + i + V::Width * 2), needle);
+    Mask mask3 = V::Equal(V::Load(pValues + i + V::Width * 3), needle);
+    if (V::MaskBits(V::Or(V::Or(mask0, mask1), V::Or(mask2, mask3))) != 0)
+      break;
+  }
+
+  for (; (i + V::Width) <= count; i += V::Width)
+  {
+    uint32 bits = V::MaskBits(V::Equal(V::Load(pValues + i), needle));
+    uint32 lane;
+    if (Y_bitscanforward(bits, &lane))
+      return static_cast<int32>(i + lane);
+  }
+
+  for (; i < count; i++)
+  {
+    if (pValues[i] == value)
+      return static_cast<int32>(i);
+  }
+
+  return -1;
+}
+
+template<class V, Y_ARRAY_COMPARE C>
+static uint32 CountArray(const typename V::Element* pValues, uint32 count, typename V::Element value)
+{
+  typedef ScalarOps<typename V::Element> S;
+  typename V::Vector operand = V::Set(value);
+  uint32 result = 0;
+  uint32 i = 0;
+  for (; (i + V::Width) <= count; i += V::Width)
+    result += CountBits(V::MaskBits(CompareVector<V, C>(V::Load(pValues + i), operand)));
+  for (; i < count; i++)
+    result += S::MaskBits(CompareVector<S, C>(pValues[i], value));
+
+  return result;
+}
+
+template<class V>
+static uint32 CountArray(const typename V::Element* pValues, uint32 count, Y_ARRAY_COMPARE compare,
+                         typename V::Element value)
+{
+  switch (compare)
+  {
+    case Y_ARRAY_COMPARE_EQUAL:
+      return CountArray<V, Y_ARRAY_COMPARE_EQUAL>(pValues, count, value);
+    case Y_ARRAY_COMPARE_NOT_EQUAL:
+      return CountArray<V, Y_ARRAY_COMPARE_NOT_EQUAL>(pValues, count, value);
+    case Y_ARRAY_COMPARE_LESS:
+      return CountArray<V, Y_ARRAY_COMPARE_LESS>(pValues, count, value);
+    case Y_ARRAY_COMPARE_LESS_EQUAL:
+      return CountArray<V, Y_ARRAY_COMPARE_LESS_EQUAL>(pValues, count, value);
+    case Y_ARRAY_COMPARE_GREATER:
+      return CountArray<V, Y_ARRAY_COMPARE_GREATER>(pValues, count, value);
+    case Y_ARRAY_COMPARE_GREATER_EQUAL:
+      return CountArray<V, Y_ARRAY_COMPARE_GREATER_EQUAL>(pValues, count, value);
+    default:
+      UnreachableCode();
+      return 0;
+  }
+}
+
+// Each vector's kept lanes are packed onto the end of a staging buffer, which is written out a whole vector at a time
+// once it has one. So nothing past the kept elements is written, and a filter of one part of an array can't touch the
+// results of the next part.
+template<class V, Y_ARRAY_COMPARE C>
+static uint32 FilterArray(typename V::Element* pResult, const typename V::Element* pValues, uint32 count,
+                          typename V::Element value)
+{
+  typedef typename V::Element T;
+  typedef ScalarOps<T> S;
+  typename V::Vector operand = V::Set(value);
+  T staged[V::Width * 2] = {};
+  uint32 stagedCount = 0;
+  uint32 keptCount = 0;
+  uint32 i = 0;
+  for (; (i + V::Width) <= count; i += V::Width)
+  {
+    typename V::Vector v = V::Load(pValues + i);
+    stagedCount += V::Compact(staged + stagedCount, v, V::MaskBits(CompareVector<V, C>(v, operand)));
+    if (stagedCount >= V::Width)
+    {
+      V::Store(pResult + keptCount, V::Load(staged));
+      V::Store(staged, V::Load(staged + V::Width));
+      keptCount += V::Width;
+      stagedCount -= V::Width;
+    }
+  }
+
+  std::memcpy(pResult + keptCount, staged, sizeof(T) * stagedCount);
+  keptCount += stagedCount;
+  for (; i < count; i++)
+  {
+    if (S::MaskBits(CompareVector<S, C>(pValues[i], value)) != 0)
+      pResult[keptCount++] = pValues[i];
+  }
+
+  return keptCount;
+}
+
+template<class V>
+static uint32 FilterArray(typename V::Element* pResult, const typename V::Element* pValues, uint32 count,
+                          Y_ARRAY_COMPARE compare, typename V::Element value)
+{
+  switch (compare)
+  {
+    case Y_ARRAY_COMPARE_EQUAL:
+      return FilterArray<V, Y_ARRAY_COMPARE_EQUAL>(pResult, pValues, count, value);
+    case Y_ARRAY_COMPARE_NOT_EQUAL:
+      return FilterArray<V, Y_ARRAY_COMPARE_NOT_EQUAL>(pResult, pValues, count, value);
+    case Y_ARRAY_COMPARE_LESS:
+      return FilterArray<V, Y_ARRAY_COMPARE_LESS>(pResult, pValues, count, value);
+    case Y_ARRAY_COMPARE_LESS_EQUAL:
+      return FilterArray<V, Y_ARRAY_COMPARE_LESS_EQUAL>(pResult, pValues, count, value);
+    case Y_ARRAY_COMPARE_GREATER:
+      return FilterArray<V, Y_ARRAY_COMPARE_GREATER>(pResult, pValues, count, value);
+    case Y_ARRAY_COMPARE_GREATER_EQUAL:
+      return FilterArray<V, Y_ARRAY_COMPARE_GREATER_EQUAL>(pResult, pValues, count, value);
+    default:
+      UnreachableCode();
+      return 0;
+  }
+}
+
+template<class V>
+static bool MinMaxArray(const typename V::Element* pValues, uint32 count, typename V::Element* pMin,
+                        typename V::Element* pMax)
+{
+  typedef typename V::Element T;
+  typedef ScalarOps<T> S;
+  typename V::Vector minimum = V::Set(ElementLimits<T>::Highest());
+  typename V::Vector maximum = V::Set(ElementLimits<T>::Lowest());
+  uint32 i = 0;
+  for (; (i + V::Width) <= count; i += V::Width)
+  {
+    typename V::Vector v = V::Load(pValues + i);
+    minimum = V::Min(v, minimum);
+    maximum = V::Max(v, maximum);
+  }
+
+  T minimums[V::Width];
+  T maximums[V::Width];
+  V::Store(minimums, minimum);
+  V::Store(maximums, maximum);
+  T minValue = ElementLimits<T>::Highest();
+  T maxValue = ElementLimits<T>::Lowest();
+  for (uint32 lane = 0; lane < V::Width; lane++)
+  {
+    minValue = S::Min(minimums[lane], minValue);
+    maxValue = S::Max(maximums[lane], maxValue);
+  }
+  for (; i < count; i++)
+  {
+    minValue = S::Min(pValues[i], minValue);
+    maxValue = S::Max(pValues[i], maxValue);
+  }
+
+  // only passes over NaNs leave the starting points crossed
+  if (count == 0 || minValue > maxValue)
+    return false;
+
+  *pMin = minValue;
+  *pMax = maxValue;
+  return true;
+}
+
+template<class V>
+static typename V::Element SumArray(const typename V::Element* pValues, uint32 count)
+{
+  typedef typename V::Element T;
+
+  // four sums, so each add doesn't wait on the one before
+  typename V::Vector sum0 = V::Set(T());
+  typename V::Vector sum1 = sum0;
+  typename V::Vector sum2 = sum0;
+  typename V::Vector sum3 = sum0;
+  uint32 i = 0;
+  for (; (i + V::Width * 4) <= count; i += V::Width * 4)
+  {
+    sum0 = V::Add(sum0, V::Load(pValues + i));
+    sum1 = V::Add(sum1, V::Load(pValues + i + V::Width));
+    sum2 = V::Add(sum2, V::Load(pValues + i + V::Width * 2));
+    sum3 = V::Add(sum3, V::Load(pValues + i + V::Width * 3));
+  }
+  for (; (i + V::Width) <= count; i += V::Width)
+    sum0 = V::Add(sum0, V::Load(pValues + i));
+
+  T lanes[V::Width];
+  V::Store(lanes, V::Add(V::Add(sum0, sum1), V::Add(sum2, sum3)));
+  T result = T();
+  for (uint32 lane = 0; lane < V::Width; lane++)
+    result = AddElements(result, lanes[lane]);
+  for (; i < count; i++)
+    result = AddElements(result, pValues[i]);
+
+  return result;
+}
+
+// A running sum within each vector, plus the last sum of the one before.
+template<class V>
+static typename V::Element PrefixSumArray(typename V::Element* pResult, const typename V::Element* pValues,
+                                          uint32 count, typename V::Element initial)
+{
+  typedef typename V::Element T;
+  typename V::Vector carry = V::Set(initial);
+  uint32 i = 0;
+  for (; (i + V::Width) <= count; i += V::Width)
+  {
+    typename V::Vector sums = V::Add(V::ScanAdd(V::Load(pValues + i)), carry);
+    V::Store(pResult + i, sums);
+    carry = V::BroadcastLast(sums);
+  }
+
+  T total = (i > 0) ? pResult[i - 1] : initial;
+  for (; i < count; i++)
+  {
+    total = AddElements(total, pValues[i]);
+    pResult[i] = total;
+  }
+
+  return total;
+}
+
+} // namespace
+
+// One set of entry points per instruction set and element type, and the table of them the dispatch picks from.
+#define ARRAY_KERNELS(Suffix, Ops)                                                                                     \
+  static int32 Find##Suffix(const Ops::Element* pValues, uint32 count, Ops::Element value)                             \
+  {                                                                                                                    \
+    return FindArray<Ops>(pValues, count, value);                                                                      \
+  }                                                                                                                    \
+  static uint32 Count##Suffix(const Ops::Element* pValues, uint32 count, Y_ARRAY_COMPARE compare, Ops::Element value)  \
+  {                                                                                                                    \
+    return CountArray<Ops>(pValues, count, compare, value);                                                            \
+  }                                                                                                                    \
+  static uint32 Filter##Suffix(Ops::Element* pResult, const Ops::Element* pValues, uint32 count,                       \
+                               Y_ARRAY_COMPARE compare, Ops::Element value)                                            \
+  {                                                                                                                    \
+    return FilterArray<Ops>(pResult, pValues, count, compare, value);                                                  \
+  }                                                                                                                    \
+  static bool MinMax##Suffix(const Ops::Element* pValues, uint32 count, Ops::Element* pMin, Ops::Element* pMax)        \
+  {                                                                                                                    \
+    return MinMaxArray<Ops>(pValues, count, pMin, pMax);                                                               \
+  }                                                                                                                    \
+  static Ops::Element Sum##Suffix(const Ops::Element* pValues, uint32 count)                                           \
+  {                                                                                                                    \
+    return SumArray<Ops>(pValues, count);                                                                              \
+  }                                                                                                                    \
+  static Ops::Element PrefixSum##Suffix(Ops::Element* pResult, const Ops::Element* pValues, uint32 count,              \
+                                        Ops::Element initial)                                                          \
+  {                                                                                                                    \
+    return PrefixSumArray<Ops>(pResult, pValues, count, initial);                                                      \
+  }                                                                                                                    \
+  static const ArrayKernels<Ops::Element> s_kernels##Suffix = {&Find##Suffix,   &Count##Suffix, &Filter##Suffix,       \
+                                                               &MinMax##Suffix, &Sum##Suffix,   &PrefixSum##Suffix};
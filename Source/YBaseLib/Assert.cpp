@@ -1,5 +1,6 @@
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
 #include "YBaseLib/Mutex.h"
 
 #ifdef Y_PLATFORM_WINDOWS
@@ -76,6 +77,11 @@ void Y_OnAssertFailed(const char* szMessage, const char* szFunction, const char*
 {
   void* pHandle;
   s_AssertFailedMutex.Lock();
+
+  // what was logged up to here goes out before the log thread is frozen with everything else
+  if (g_pLog != nullptr)
+    g_pLog->Flush();
+
   FreezeThreads(&pHandle);
 
   char szMsg[512];
@@ -109,6 +115,11 @@ void Y_OnPanicReached(const char* szMessage, const char* szFunction, const char*
 {
   void* pHandle;
   s_AssertFailedMutex.Lock();
+
+  // what was logged up to here goes out before the log thread is frozen with everything else
+  if (g_pLog != nullptr)
+    g_pLog->Flush();
+
   FreezeThreads(&pHandle);
 
   char szMsg[512];
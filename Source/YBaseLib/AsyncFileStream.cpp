@@ -0,0 +1,778 @@
+#include "YBaseLib/AsyncFileStream.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/MutexLock.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/TaskQueue.h"
+#include "YBaseLib/Thread.h"
+#include <cerrno>
+#include <cstring>
+#if defined(Y_PLATFORM_WINDOWS)
+#include "YBaseLib/UnicodeConversion.h"
+#include <cstddef>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+#if defined(Y_PLATFORM_LINUX)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#include <linux/io_uring.h>
+#define Y_ASYNC_FILE_IO_URING 1
+#endif
+#endif
+Log_SetChannel(AsyncFileStream);
+
+#if defined(Y_PLATFORM_WINDOWS)
+static_assert(sizeof(OVERLAPPED) <= sizeof(uint64) * 4, "OVERLAPPED fits in the request");
+
+// posted to the completion port to stop the completion thread
+static const ULONG_PTR IOCP_EXIT_KEY = 1;
+#endif
+
+#if defined(Y_ASYNC_FILE_IO_URING)
+static_assert(sizeof(iovec) <= sizeof(uint64) * 4, "iovec fits in the request");
+
+static int IOUringSetup(uint32 entries, io_uring_params* pParams)
+{
+  return (int)syscall(__NR_io_uring_setup, entries, pParams);
+}
+
+static int IOUringEnter(int fd, uint32 toSubmit, uint32 minComplete, uint32 flags)
+{
+  return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+#endif
+
+class AsyncFileQueue::CompletionThread : public Thread
+{
+public:
+  CompletionThread(AsyncFileQueue* pQueue) : m_pQueue(pQueue) {}
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    Thread::SetDebugName(String::FromFormat("Async File Queue %p", m_pQueue));
+    switch (m_pQueue->m_backend)
+    {
+      case BACKEND_IO_URING:
+        m_pQueue->IOUringCompletionLoop();
+        break;
+
+      case BACKEND_IOCP:
+        m_pQueue->IOCPCompletionLoop();
+        break;
+
+      default:
+        m_pQueue->WorkerLoop();
+        break;
+    }
+
+    return 0;
+  }
+
+private:
+  AsyncFileQueue* m_pQueue;
+};
+
+AsyncFileStream::AsyncFileStream(AsyncFileQueue* pQueue, FileHandle fileHandle)
+  : m_pQueue(pQueue), m_fileHandle(fileHandle)
+{
+}
+
+AsyncFileStream::~AsyncFileStream()
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  CloseHandle((HANDLE)m_fileHandle);
+#else
+  close(m_fileHandle);
+#endif
+}
+
+uint64 AsyncFileStream::GetSize() const
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx((HANDLE)m_fileHandle, &size))
+    return 0;
+
+  return (uint64)size.QuadPart;
+#else
+  struct stat fileStat;
+  if (fstat(m_fileHandle, &fileStat) != 0)
+    return 0;
+
+  return (uint64)fileStat.st_size;
+#endif
+}
+
+bool AsyncFileStream::Submit(AsyncFileRequest** ppRequests, uint32 count)
+{
+  for (uint32 i = 0; i < count; i++)
+  {
+    AsyncFileRequest* pRequest = ppRequests[i];
+    DebugAssert(pRequest->pBuffer != nullptr || pRequest->Size == 0);
+    pRequest->m_pStream = this;
+    pRequest->m_pNext = nullptr;
+    pRequest->BytesTransferred = 0;
+    pRequest->Succeeded = false;
+    pRequest->m_completed = 0;
+  }
+
+  return m_pQueue->SubmitRequests(ppRequests, count);
+}
+
+AsyncFileQueue::AsyncFileQueue()
+  : m_backend(BACKEND_NONE), m_pCompletionQueue(nullptr), m_shutdown(false), m_pendingCount(0),
+    m_pWaitingHead(nullptr), m_pWaitingTail(nullptr), m_ringFileDescriptor(-1), m_pSubmissionRing(nullptr),
+    m_submissionRingSize(0), m_pCompletionRing(nullptr), m_completionRingSize(0), m_pSubmissionEntries(nullptr),
+    m_submissionEntriesSize(0), m_pSubmissionHead(nullptr), m_pSubmissionTail(nullptr), m_pSubmissionArray(nullptr),
+    m_submissionMask(0), m_pCompletionHead(nullptr), m_pCompletionTail(nullptr), m_pCompletionEntries(nullptr),
+    m_completionMask(0), m_ringCapacity(0), m_ringInFlight(0), m_completionPort(nullptr)
+{
+  m_submitLock.SetProfileName("asyncfilequeue.submit");
+}
+
+AsyncFileQueue::~AsyncFileQueue()
+{
+  Shutdown();
+}
+
+bool AsyncFileQueue::Initialize(uint32 queueDepth /* = 128 */, TaskQueue* pCompletionQueue /* = nullptr */,
+                                uint32 workerThreadCount /* = 4 */)
+{
+  DebugAssert(m_backend == BACKEND_NONE && queueDepth > 0);
+  m_pCompletionQueue = pCompletionQueue;
+  m_shutdown = false;
+
+#if defined(Y_PLATFORM_WINDOWS)
+  return InitializeIOCP();
+#else
+  // io_uring can be missing, or blocked in containers, in which case the threads take over
+  if (InitializeIOUring(queueDepth))
+    return true;
+
+  return InitializeThreads(workerThreadCount);
+#endif
+}
+
+bool AsyncFileQueue::InitializeIOUring(uint32 queueDepth)
+{
+#if defined(Y_ASYNC_FILE_IO_URING)
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  int fd = IOUringSetup(queueDepth, &params);
+  if (fd < 0)
+  {
+    Log_DevPrintf("io_uring unavailable (errno %d), using worker threads", errno);
+    return false;
+  }
+
+  // older kernels map the two rings separately
+  m_submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32);
+  m_completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (singleMapping)
+    m_submissionRingSize = m_completionRingSize = Max(m_submissionRingSize, m_completionRingSize);
+
+  m_pSubmissionRing =
+    mmap(nullptr, m_submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (m_pSubmissionRing != MAP_FAILED)
+  {
+    m_pCompletionRing = singleMapping ? m_pSubmissionRing :
+                                        mmap(nullptr, m_completionRingSize, PROT_READ | PROT_WRITE,
+                                             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  }
+  if (m_pSubmissionRing != MAP_FAILED && m_pCompletionRing != MAP_FAILED)
+  {
+    m_submissionEntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+    m_pSubmissionEntries = mmap(nullptr, m_submissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                fd, IORING_OFF_SQES);
+  }
+  if (m_pSubmissionRing == MAP_FAILED || m_pCompletionRing == MAP_FAILED || m_pSubmissionEntries == MAP_FAILED)
+  {
+    Log_WarningPrintf("Failed to map io_uring rings (errno %d), using worker threads", errno);
+    if (m_pSubmissionRing != MAP_FAILED)
+      munmap(m_pSubmissionRing, m_submissionRingSize);
+    if (m_pCompletionRing != MAP_FAILED && m_pCompletionRing != nullptr && !singleMapping)
+      munmap(m_pCompletionRing, m_completionRingSize);
+    m_pSubmissionRing = m_pCompletionRing = m_pSubmissionEntries = nullptr;
+    close(fd);
+    return false;
+  }
+
+  byte* pSubmissionRing = reinterpret_cast<byte*>(m_pSubmissionRing);
+  byte* pCompletionRing = reinterpret_cast<byte*>(m_pCompletionRing);
+  m_pSubmissionHead = reinterpret_cast<uint32*>(pSubmissionRing + params.sq_off.head);
+  m_pSubmissionTail = reinterpret_cast<uint32*>(pSubmissionRing + params.sq_off.tail);
+  m_pSubmissionArray = reinterpret_cast<uint32*>(pSubmissionRing + params.sq_off.array);
+  m_submissionMask = *reinterpret_cast<uint32*>(pSubmissionRing + params.sq_off.ring_mask);
+  m_pCompletionHead = reinterpret_cast<uint32*>(pCompletionRing + params.cq_off.head);
+  m_pCompletionTail = reinterpret_cast<uint32*>(pCompletionRing + params.cq_off.tail);
+  m_pCompletionEntries = pCompletionRing + params.cq_off.cqes;
+  m_completionMask = *reinterpret_cast<uint32*>(pCompletionRing + params.cq_off.ring_mask);
+
+  // never more in flight than there are completion slots, so none are dropped
+  m_ringFileDescriptor = fd;
+  m_ringCapacity = Min(params.sq_entries, params.cq_entries);
+  m_ringInFlight = 0;
+  m_backend = BACKEND_IO_URING;
+
+  CompletionThread* pThread = new CompletionThread(this);
+  m_threads.Add(pThread);
+  pThread->Start();
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool AsyncFileQueue::InitializeIOCP()
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  m_completionPort = (void*)CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+  if (m_completionPort == nullptr)
+  {
+    Log_ErrorPrintf("CreateIoCompletionPort failed: %u", GetLastError());
+    return false;
+  }
+
+  m_backend = BACKEND_IOCP;
+
+  CompletionThread* pThread = new CompletionThread(this);
+  m_threads.Add(pThread);
+  pThread->Start();
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool AsyncFileQueue::InitializeThreads(uint32 workerThreadCount)
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  return false;
+#else
+  m_backend = BACKEND_THREADS;
+  for (uint32 i = 0; i < workerThreadCount; i++)
+  {
+    CompletionThread* pThread = new CompletionThread(this);
+    m_threads.Add(pThread);
+    pThread->Start();
+  }
+
+  return true;
+#endif
+}
+
+void AsyncFileQueue::Shutdown()
+{
+  if (m_backend == BACKEND_NONE)
+    return;
+
+  WaitForIdle();
+
+  m_submitLock.Lock();
+  m_shutdown = true;
+  switch (m_backend)
+  {
+#if defined(Y_ASYNC_FILE_IO_URING)
+    case BACKEND_IO_URING:
+    {
+      // the ring is empty, a no-op with no request wakes the completion thread to exit
+      uint32 tail = *m_pSubmissionTail;
+      uint32 index = tail & m_submissionMask;
+      io_uring_sqe* pEntry = reinterpret_cast<io_uring_sqe*>(m_pSubmissionEntries) + index;
+      std::memset(pEntry, 0, sizeof(io_uring_sqe));
+      pEntry->opcode = IORING_OP_NOP;
+      pEntry->user_data = 0;
+      m_pSubmissionArray[index] = index;
+      Y_AtomicStoreRelease(*reinterpret_cast<volatile uint32*>(m_pSubmissionTail), tail + 1);
+      while (IOUringEnter(m_ringFileDescriptor, 1, 0, 0) < 0 && errno == EINTR)
+        ;
+    }
+    break;
+#endif
+
+#if defined(Y_PLATFORM_WINDOWS)
+    case BACKEND_IOCP:
+      PostQueuedCompletionStatus((HANDLE)m_completionPort, 0, IOCP_EXIT_KEY, nullptr);
+      break;
+#endif
+
+    default:
+      m_submitConditionVariable.WakeAll();
+      break;
+  }
+  m_submitLock.Unlock();
+
+  for (uint32 i = 0; i < m_threads.GetSize(); i++)
+  {
+    m_threads[i]->Join();
+    delete m_threads[i];
+  }
+  m_threads.Clear();
+
+#if defined(Y_ASYNC_FILE_IO_URING)
+  if (m_backend == BACKEND_IO_URING)
+  {
+    munmap(m_pSubmissionEntries, m_submissionEntriesSize);
+    if (m_pCompletionRing != m_pSubmissionRing)
+      munmap(m_pCompletionRing, m_completionRingSize);
+    munmap(m_pSubmissionRing, m_submissionRingSize);
+    close(m_ringFileDescriptor);
+    m_pSubmissionRing = m_pCompletionRing = m_pSubmissionEntries = nullptr;
+    m_ringFileDescriptor = -1;
+  }
+#endif
+
+#if defined(Y_PLATFORM_WINDOWS)
+  if (m_backend == BACKEND_IOCP)
+  {
+    CloseHandle((HANDLE)m_completionPort);
+    m_completionPort = nullptr;
+  }
+#endif
+
+  m_backend = BACKEND_NONE;
+}
+
+bool AsyncFileQueue::OpenFile(const char* fileName, uint32 openMode, AsyncFileStream** ppStream)
+{
+  DebugAssert(m_backend != BACKEND_NONE);
+
+#if defined(Y_PLATFORM_WINDOWS)
+  DWORD desiredAccess = 0;
+  if (openMode & BYTESTREAM_OPEN_READ)
+    desiredAccess |= GENERIC_READ;
+  if (openMode & BYTESTREAM_OPEN_WRITE)
+    desiredAccess |= GENERIC_WRITE;
+
+  DWORD creationDisposition;
+  if (openMode & BYTESTREAM_OPEN_CREATE)
+    creationDisposition = (openMode & BYTESTREAM_OPEN_TRUNCATE) ? CREATE_ALWAYS : OPEN_ALWAYS;
+  else
+    creationDisposition = (openMode & BYTESTREAM_OPEN_TRUNCATE) ? TRUNCATE_EXISTING : OPEN_EXISTING;
+
+  UTF16StackString<MAX_PATH> wideFileName(fileName);
+  HANDLE hFile = CreateFileW(wideFileName.GetWideCharArray(), desiredAccess, FILE_SHARE_READ, nullptr,
+                             creationDisposition, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE)
+    return false;
+
+  if (CreateIoCompletionPort(hFile, (HANDLE)m_completionPort, 0, 0) == nullptr)
+  {
+    Log_ErrorPrintf("Failed to associate '%s' with the completion port: %u", fileName, GetLastError());
+    CloseHandle(hFile);
+    return false;
+  }
+
+  *ppStream = new AsyncFileStream(this, (void*)hFile);
+  return true;
+#else
+  int flags;
+  if ((openMode & (BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_WRITE)) == (BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_WRITE))
+    flags = O_RDWR;
+  else if (openMode & BYTESTREAM_OPEN_WRITE)
+    flags = O_WRONLY;
+  else
+    flags = O_RDONLY;
+  if (openMode & BYTESTREAM_OPEN_CREATE)
+    flags |= O_CREAT;
+  if (openMode & BYTESTREAM_OPEN_TRUNCATE)
+    flags |= O_TRUNC;
+
+  int fd = open(fileName, flags | O_CLOEXEC, 0666);
+  if (fd < 0)
+    return false;
+
+  *ppStream = new AsyncFileStream(this, fd);
+  return true;
+#endif
+}
+
+void AsyncFileQueue::WaitForIdle()
+{
+  MutexLock lock(m_idleLock);
+  while (Y_AtomicLoadAcquire(m_pendingCount) != 0)
+    m_idleConditionVariable.SleepAndRelease(&m_idleLock);
+}
+
+bool AsyncFileQueue::SubmitRequests(AsyncFileRequest** ppRequests, uint32 count)
+{
+  if (count == 0)
+    return true;
+
+  m_submitLock.Lock();
+  if (m_shutdown || m_backend == BACKEND_NONE)
+  {
+    m_submitLock.Unlock();
+    return false;
+  }
+
+  // counted before anything can complete
+  Y_AtomicAdd(m_pendingCount, count);
+  for (uint32 i = 0; i < count; i++)
+    ppRequests[i]->m_pStream->AddRef();
+
+  switch (m_backend)
+  {
+    case BACKEND_IOCP:
+    {
+      m_submitLock.Unlock();
+      for (uint32 i = 0; i < count; i++)
+        SubmitIOCPRequest(ppRequests[i]);
+    }
+    break;
+
+    case BACKEND_THREADS:
+    {
+      if (m_threads.IsEmpty())
+      {
+        // nothing to hand the requests to, carry them out here
+        m_submitLock.Unlock();
+        for (uint32 i = 0; i < count; i++)
+          TransferSynchronous(ppRequests[i]);
+        break;
+      }
+
+      for (uint32 i = 0; i < count; i++)
+      {
+        if (m_pWaitingTail != nullptr)
+          m_pWaitingTail->m_pNext = ppRequests[i];
+        else
+          m_pWaitingHead = ppRequests[i];
+        m_pWaitingTail = ppRequests[i];
+      }
+
+      if (count == 1)
+        m_submitConditionVariable.Wake();
+      else
+        m_submitConditionVariable.WakeAll();
+      m_submitLock.Unlock();
+    }
+    break;
+
+    default:
+    {
+      for (uint32 i = 0; i < count; i++)
+      {
+        if (m_pWaitingTail != nullptr)
+          m_pWaitingTail->m_pNext = ppRequests[i];
+        else
+          m_pWaitingHead = ppRequests[i];
+        m_pWaitingTail = ppRequests[i];
+      }
+
+      FlushIOUringSubmissions();
+      m_submitLock.Unlock();
+    }
+    break;
+  }
+
+  return true;
+}
+
+uint32 AsyncFileQueue::FlushIOUringSubmissions()
+{
+#if defined(Y_ASYNC_FILE_IO_URING)
+  uint32 tail = *m_pSubmissionTail;
+  uint32 count = 0;
+  while (m_pWaitingHead != nullptr && m_ringInFlight < m_ringCapacity)
+  {
+    AsyncFileRequest* pRequest = m_pWaitingHead;
+    m_pWaitingHead = pRequest->m_pNext;
+    if (m_pWaitingHead == nullptr)
+      m_pWaitingTail = nullptr;
+    pRequest->m_pNext = nullptr;
+
+    // the remainder, when resubmitting after a short transfer
+    iovec* pVector = reinterpret_cast<iovec*>(pRequest->m_platformData);
+    pVector->iov_base = reinterpret_cast<byte*>(pRequest->pBuffer) + pRequest->BytesTransferred;
+    pVector->iov_len = pRequest->Size - pRequest->BytesTransferred;
+
+    uint32 index = tail & m_submissionMask;
+    io_uring_sqe* pEntry = reinterpret_cast<io_uring_sqe*>(m_pSubmissionEntries) + index;
+    std::memset(pEntry, 0, sizeof(io_uring_sqe));
+    pEntry->opcode = (pRequest->Type == AsyncFileRequest::TYPE_WRITE) ? IORING_OP_WRITEV : IORING_OP_READV;
+    pEntry->fd = pRequest->m_pStream->m_fileHandle;
+    pEntry->off = pRequest->Offset + pRequest->BytesTransferred;
+    pEntry->addr = reinterpret_cast<uint64>(pVector);
+    pEntry->len = 1;
+    pEntry->user_data = reinterpret_cast<uint64>(pRequest);
+    m_pSubmissionArray[index] = index;
+    tail++;
+    m_ringInFlight++;
+    count++;
+  }
+
+  if (count == 0)
+    return 0;
+
+  // entries the kernel didn't take last time are passed again
+  Y_AtomicStoreRelease(*reinterpret_cast<volatile uint32*>(m_pSubmissionTail), tail);
+  uint32 unsubmitted = tail - Y_AtomicLoadAcquire(*reinterpret_cast<volatile uint32*>(m_pSubmissionHead));
+  int result;
+  while ((result = IOUringEnter(m_ringFileDescriptor, unsubmitted, 0, 0)) < 0 && errno == EINTR)
+    ;
+  if (result < 0)
+    Log_WarningPrintf("io_uring_enter failed to submit %u requests: errno %d", unsubmitted, errno);
+
+  return count;
+#else
+  return 0;
+#endif
+}
+
+void AsyncFileQueue::IOUringCompletionLoop()
+{
+#if defined(Y_ASYNC_FILE_IO_URING)
+  struct Completion
+  {
+    AsyncFileRequest* pRequest;
+    int32 Result;
+  };
+
+  const io_uring_cqe* pEntries = reinterpret_cast<const io_uring_cqe*>(m_pCompletionEntries);
+  volatile uint32& completionHead = *reinterpret_cast<volatile uint32*>(m_pCompletionHead);
+  volatile uint32& completionTail = *reinterpret_cast<volatile uint32*>(m_pCompletionTail);
+  Completion completions[64];
+  bool exiting = false;
+  while (!exiting)
+  {
+    uint32 head = completionHead;
+    uint32 tail = Y_AtomicLoadAcquire(completionTail);
+    if (head == tail)
+    {
+      if (IOUringEnter(m_ringFileDescriptor, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+      {
+        Log_ErrorPrintf("io_uring_enter failed waiting for completions: errno %d", errno);
+        Thread::Sleep(1);
+      }
+
+      continue;
+    }
+
+    // copy the entries out so the kernel can reuse the slots while the callbacks run
+    uint32 count = 0;
+    for (; head != tail && count < countof(completions); head++)
+    {
+      const io_uring_cqe* pEntry = &pEntries[head & m_completionMask];
+      completions[count].pRequest = reinterpret_cast<AsyncFileRequest*>(pEntry->user_data);
+      completions[count].Result = pEntry->res;
+      count++;
+    }
+    Y_AtomicStoreRelease(completionHead, head);
+
+    // short transfers go back in the queue for the rest, as long as they made progress
+    uint32 finishedCount = 0;
+    uint32 retiredCount = 0;
+    AsyncFileRequest* pResubmitHead = nullptr;
+    AsyncFileRequest* pResubmitTail = nullptr;
+    for (uint32 i = 0; i < count; i++)
+    {
+      AsyncFileRequest* pRequest = completions[i].pRequest;
+      if (pRequest == nullptr)
+      {
+        exiting = true;
+        continue;
+      }
+
+      retiredCount++;
+      if (completions[i].Result > 0)
+      {
+        pRequest->BytesTransferred += (uint32)completions[i].Result;
+        if (pRequest->BytesTransferred < pRequest->Size)
+        {
+          if (pResubmitTail != nullptr)
+            pResubmitTail->m_pNext = pRequest;
+          else
+            pResubmitHead = pRequest;
+          pResubmitTail = pRequest;
+          continue;
+        }
+      }
+
+      completions[finishedCount++] = completions[i];
+    }
+
+    m_submitLock.Lock();
+    m_ringInFlight -= retiredCount;
+    if (pResubmitHead != nullptr)
+    {
+      pResubmitTail->m_pNext = m_pWaitingHead;
+      m_pWaitingHead = pResubmitHead;
+      if (m_pWaitingTail == nullptr)
+        m_pWaitingTail = pResubmitTail;
+    }
+    if (m_pWaitingHead != nullptr)
+      FlushIOUringSubmissions();
+    m_submitLock.Unlock();
+
+    for (uint32 i = 0; i < finishedCount; i++)
+      CompleteRequest(completions[i].pRequest, (completions[i].Result >= 0));
+  }
+#endif
+}
+
+void AsyncFileQueue::SubmitIOCPRequest(AsyncFileRequest* pRequest)
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  uint64 offset = pRequest->Offset + pRequest->BytesTransferred;
+  OVERLAPPED* pOverlapped = reinterpret_cast<OVERLAPPED*>(pRequest->m_platformData);
+  std::memset(pOverlapped, 0, sizeof(OVERLAPPED));
+  pOverlapped->Offset = (DWORD)offset;
+  pOverlapped->OffsetHigh = (DWORD)(offset >> 32);
+
+  HANDLE hFile = (HANDLE)pRequest->m_pStream->m_fileHandle;
+  byte* pBuffer = reinterpret_cast<byte*>(pRequest->pBuffer) + pRequest->BytesTransferred;
+  DWORD size = pRequest->Size - pRequest->BytesTransferred;
+  BOOL result = (pRequest->Type == AsyncFileRequest::TYPE_WRITE) ?
+                  WriteFile(hFile, pBuffer, size, nullptr, pOverlapped) :
+                  ReadFile(hFile, pBuffer, size, nullptr, pOverlapped);
+
+  // anything but pending or done means no completion packet is coming
+  if (!result)
+  {
+    DWORD error = GetLastError();
+    if (error != ERROR_IO_PENDING)
+      CompleteRequest(pRequest, (error == ERROR_HANDLE_EOF));
+  }
+#endif
+}
+
+void AsyncFileQueue::IOCPCompletionLoop()
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  for (;;)
+  {
+    DWORD bytesTransferred = 0;
+    ULONG_PTR key = 0;
+    OVERLAPPED* pOverlapped = nullptr;
+    BOOL result = GetQueuedCompletionStatus((HANDLE)m_completionPort, &bytesTransferred, &key, &pOverlapped, INFINITE);
+    if (pOverlapped == nullptr)
+    {
+      if (result && key == IOCP_EXIT_KEY)
+        break;
+
+      Log_ErrorPrintf("GetQueuedCompletionStatus failed: %u", GetLastError());
+      continue;
+    }
+
+    AsyncFileRequest* pRequest = reinterpret_cast<AsyncFileRequest*>(
+      reinterpret_cast<byte*>(pOverlapped) - offsetof(AsyncFileRequest, m_platformData));
+    if (!result)
+    {
+      DWORD error = GetLastError();
+      pRequest->BytesTransferred += bytesTransferred;
+      CompleteRequest(pRequest, (error == ERROR_HANDLE_EOF));
+      continue;
+    }
+
+    pRequest->BytesTransferred += bytesTransferred;
+    if (bytesTransferred > 0 && pRequest->BytesTransferred < pRequest->Size)
+      SubmitIOCPRequest(pRequest);
+    else
+      CompleteRequest(pRequest, true);
+  }
+#endif
+}
+
+void AsyncFileQueue::WorkerLoop()
+{
+  m_submitLock.Lock();
+  for (;;)
+  {
+    if (m_pWaitingHead == nullptr)
+    {
+      if (m_shutdown)
+        break;
+
+      m_submitConditionVariable.SleepAndRelease(&m_submitLock);
+      continue;
+    }
+
+    AsyncFileRequest* pRequest = m_pWaitingHead;
+    m_pWaitingHead = pRequest->m_pNext;
+    if (m_pWaitingHead == nullptr)
+      m_pWaitingTail = nullptr;
+    pRequest->m_pNext = nullptr;
+
+    m_submitLock.Unlock();
+    TransferSynchronous(pRequest);
+    m_submitLock.Lock();
+  }
+  m_submitLock.Unlock();
+}
+
+void AsyncFileQueue::TransferSynchronous(AsyncFileRequest* pRequest)
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  Panic("no synchronous fallback on Windows");
+#else
+  int fd = pRequest->m_pStream->m_fileHandle;
+  byte* pBuffer = reinterpret_cast<byte*>(pRequest->pBuffer);
+  bool succeeded = true;
+  while (pRequest->BytesTransferred < pRequest->Size)
+  {
+    uint32 remaining = pRequest->Size - pRequest->BytesTransferred;
+    off_t offset = (off_t)(pRequest->Offset + pRequest->BytesTransferred);
+    ssize_t result = (pRequest->Type == AsyncFileRequest::TYPE_WRITE) ?
+                       pwrite(fd, pBuffer + pRequest->BytesTransferred, remaining, offset) :
+                       pread(fd, pBuffer + pRequest->BytesTransferred, remaining, offset);
+    if (result < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      succeeded = false;
+      break;
+    }
+    else if (result == 0)
+    {
+      break;
+    }
+
+    pRequest->BytesTransferred += (uint32)result;
+  }
+
+  pRequest->m_pStream->m_pQueue->CompleteRequest(pRequest, succeeded);
+#endif
+}
+
+void AsyncFileQueue::CompleteRequest(AsyncFileRequest* pRequest, bool succeeded)
+{
+  // nothing is read from the request once it's marked complete, the caller may be polling it
+  AsyncFileRequest::CompletionCallback callback = pRequest->Callback;
+  AsyncFileStream* pStream = pRequest->m_pStream;
+  pRequest->Succeeded = succeeded;
+  Y_AtomicStoreRelease(pRequest->m_completed, 1u);
+
+  if (m_pCompletionQueue != nullptr)
+    m_pCompletionQueue->QueueLambdaTask([this, callback, pStream, pRequest]() {
+      if (callback != nullptr)
+        callback(pRequest);
+      FinishRequest(pStream);
+    });
+  else
+  {
+    if (callback != nullptr)
+      callback(pRequest);
+    FinishRequest(pStream);
+  }
+}
+
+void AsyncFileQueue::FinishRequest(AsyncFileStream* pStream)
+{
+  pStream->Release();
+  if (Y_AtomicDecrement(m_pendingCount) == 0)
+  {
+    MutexLock lock(m_idleLock);
+    m_idleConditionVariable.WakeAll();
+  }
+}
@@ -0,0 +1,576 @@
+#include "YBaseLib/Base64.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CPUID.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/String.h"
+#include <cstring>
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <immintrin.h>
+#define Y_BASE64_AVX2 1
+#if defined(Y_COMPILER_MSVC)
+#include <intrin.h>
+#define BASE64_AVX2_FUNCTION
+#else
+#define BASE64_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_BASE64_NEON 1
+#endif
+
+// Text is handled in groups of four characters for three bytes. The vector versions do whole groups only, and stop
+// at anything they can't decode, leaving the rest and the error reporting to the scalar loops.
+
+static const char s_encodingTables[BASE64_ALPHABET_COUNT][65] = {
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_",
+};
+
+// both alphabets' characters, with 255 for everything else
+static const byte s_decodingTable[256] = {
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // 00-0F
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // 10-1F
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 62,  255, 62,  255, 63,  // 20-2F
+  52,  53,  54,  55,  56,  57,  58,  59,  60,  61,  255, 255, 255, 255, 255, 255, // 30-3F
+  255, 0,   1,   2,   3,   4,   5,   6,   7,   8,   9,   10,  11,  12,  13,  14,  // 40-4F
+  15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25,  255, 255, 255, 255, 63,  // 50-5F
+  255, 26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,  // 60-6F
+  41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  255, 255, 255, 255, 255, // 70-7F
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // 80-8F
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // 90-9F
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // A0-AF
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // B0-BF
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // C0-CF
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // D0-DF
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // E0-EF
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // F0-FF
+};
+
+static void EncodeGroupsScalar(char* pDestination, const byte* pSource, uint32 groupCount, const char* pTable)
+{
+  for (uint32 i = 0; i < groupCount; i++, pSource += 3, pDestination += 4)
+  {
+    uint32 value = (uint32(pSource[0]) << 16) | (uint32(pSource[1]) << 8) | uint32(pSource[2]);
+    pDestination[0] = pTable[(value >> 18) & 63];
+    pDestination[1] = pTable[(value >> 12) & 63];
+    pDestination[2] = pTable[(value >> 6) & 63];
+    pDestination[3] = pTable[value & 63];
+  }
+}
+
+// returns the number of groups decoded before one that isn't valid
+static uint32 DecodeGroupsScalar(byte* pDestination, const char* pSource, uint32 groupCount)
+{
+  for (uint32 i = 0; i < groupCount; i++, pSource += 4, pDestination += 3)
+  {
+    uint32 a = s_decodingTable[byte(pSource[0])];
+    uint32 b = s_decodingTable[byte(pSource[1])];
+    uint32 c = s_decodingTable[byte(pSource[2])];
+    uint32 d = s_decodingTable[byte(pSource[3])];
+    if ((a | b | c | d) & 0x80)
+      return i;
+
+    uint32 value = (a << 18) | (b << 12) | (c << 6) | d;
+    pDestination[0] = byte(value >> 16);
+    pDestination[1] = byte(value >> 8);
+    pDestination[2] = byte(value);
+  }
+
+  return groupCount;
+}
+
+#if defined(Y_BASE64_AVX2)
+
+// Eight groups at a time, twelve bytes in each lane. The bytes of each group are spread across a 32-bit value so
+// that multiplies can shift the four 6-bit fields into bytes of their own, which then index a table of the offset
+// from each range of values to its character.
+static BASE64_AVX2_FUNCTION uint32 EncodeGroupsAVX2(char* pDestination, const byte* pSource, uint32 groupCount,
+                                                    BASE64_ALPHABET alphabet)
+{
+  const char plusOffset = (alphabet == BASE64_ALPHABET_URL_SAFE) ? char('-' - 62) : char('+' - 62);
+  const char slashOffset = (alphabet == BASE64_ALPHABET_URL_SAFE) ? char('_' - 63) : char('/' - 63);
+  const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5, 4, 7,
+                                           6, 8, 7, 10, 9, 11, 10);
+  const __m256i offsets = _mm256_setr_epi8(
+    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+    plusOffset, slashOffset, 'A', 0, 0, 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+    '0' - 52, '0' - 52, '0' - 52, plusOffset, slashOffset, 'A', 0, 0);
+
+  // each lane reads sixteen bytes for its twelve, so the last four groups are left for the scalar loop
+  uint32 i = 0;
+  for (; groupCount - i >= 8 + 2; i += 8, pSource += 24, pDestination += 32)
+  {
+    __m256i input = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource))),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + 12)), 1);
+    input = _mm256_shuffle_epi8(input, shuffle);
+
+    __m256i high = _mm256_mulhi_epu16(_mm256_and_si256(input, _mm256_set1_epi32(0x0FC0FC00)),
+                                      _mm256_set1_epi32(0x04000040));
+    __m256i low = _mm256_mullo_epi16(_mm256_and_si256(input, _mm256_set1_epi32(0x003F03F0)),
+                                     _mm256_set1_epi32(0x01000010));
+    __m256i indices = _mm256_or_si256(high, low);
+
+    // 0-25 pick entry 13, 26-51 entry 0, 52-63 entries 1-12
+    __m256i ranges = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    ranges = _mm256_or_si256(ranges, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+    __m256i characters = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, ranges), indices);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDestination), characters);
+  }
+
+  return i;
+}
+
+// Eight groups at a time. The high and low nibble of each character look up bit masks of the ranges they could
+// be in, which only share a bit for valid characters, and the high nibble picks the offset to its value. Multiply
+// adds then pack the four 6-bit values of each group into three bytes.
+static BASE64_AVX2_FUNCTION uint32 DecodeGroupsAVX2(byte* pDestination, const char* pSource, uint32 groupCount)
+{
+  const __m256i lowMasks = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A,
+                                            0x1B, 0x1B, 0x1B, 0x1A, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m256i highMasks = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+                                             0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                             0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i offsets = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0, 0, 16, 19, 4,
+                                           -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10,
+                                        9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i nibbleMask = _mm256_set1_epi8(0x0F);
+  const __m256i slash = _mm256_set1_epi8('/');
+
+  // the low lane's store writes four bytes past its twelve, which the next group has to have room for
+  uint32 i = 0;
+  for (; groupCount - i >= 8 + 2; i += 8, pSource += 32, pDestination += 24)
+  {
+    __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource));
+
+    // the URL safe alphabet's characters become the standard ones
+    input = _mm256_blendv_epi8(input, _mm256_set1_epi8('+'), _mm256_cmpeq_epi8(input, _mm256_set1_epi8('-')));
+    input = _mm256_blendv_epi8(input, slash, _mm256_cmpeq_epi8(input, _mm256_set1_epi8('_')));
+
+    __m256i highNibbles = _mm256_and_si256(_mm256_srli_epi32(input, 4), nibbleMask);
+    __m256i lowNibbles = _mm256_and_si256(input, nibbleMask);
+    __m256i ranges = _mm256_and_si256(_mm256_shuffle_epi8(lowMasks, lowNibbles),
+                                      _mm256_shuffle_epi8(highMasks, highNibbles));
+    if (!_mm256_testz_si256(ranges, ranges))
+      break;
+
+    // '/' shares its high nibble with '+', so it's moved to the next entry
+    __m256i offsetIndices = _mm256_add_epi8(_mm256_cmpeq_epi8(input, slash), highNibbles);
+    __m256i values = _mm256_add_epi8(input, _mm256_shuffle_epi8(offsets, offsetIndices));
+
+    __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    __m256i groups = _mm256_shuffle_epi8(_mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000)), pack);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination), _mm256_castsi256_si128(groups));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + 12), _mm256_extracti128_si256(groups, 1));
+  }
+
+  return i;
+}
+
+#elif defined(Y_BASE64_NEON)
+
+// Sixteen groups at a time, with the loads and stores splitting and interleaving the bytes and characters.
+static uint32 EncodeGroupsNEON(char* pDestination, const byte* pSource, uint32 groupCount, BASE64_ALPHABET alphabet)
+{
+  const uint8* pTable = reinterpret_cast<const uint8*>(s_encodingTables[alphabet]);
+  uint8x16x4_t table = {{vld1q_u8(pTable), vld1q_u8(pTable + 16), vld1q_u8(pTable + 32), vld1q_u8(pTable + 48)}};
+  const uint8x16_t mask = vdupq_n_u8(63);
+
+  uint32 i = 0;
+  for (; groupCount - i >= 16; i += 16, pSource += 48, pDestination += 64)
+  {
+    uint8x16x3_t bytes = vld3q_u8(pSource);
+    uint8x16x4_t characters;
+    characters.val[0] = vqtbl4q_u8(table, vshrq_n_u8(bytes.val[0], 2));
+    characters.val[1] =
+      vqtbl4q_u8(table, vandq_u8(vorrq_u8(vshlq_n_u8(bytes.val[0], 4), vshrq_n_u8(bytes.val[1], 4)), mask));
+    characters.val[2] =
+      vqtbl4q_u8(table, vandq_u8(vorrq_u8(vshlq_n_u8(bytes.val[1], 2), vshrq_n_u8(bytes.val[2], 6)), mask));
+    characters.val[3] = vqtbl4q_u8(table, vandq_u8(bytes.val[2], mask));
+    vst4q_u8(reinterpret_cast<uint8*>(pDestination), characters);
+  }
+
+  return i;
+}
+
+// The decoding table's first half is looked up in two pieces, anything past it isn't base64.
+static uint32 DecodeGroupsNEON(byte* pDestination, const char* pSource, uint32 groupCount)
+{
+  uint8x16x4_t lowTable = {{vld1q_u8(s_decodingTable), vld1q_u8(s_decodingTable + 16),
+                            vld1q_u8(s_decodingTable + 32), vld1q_u8(s_decodingTable + 48)}};
+  uint8x16x4_t highTable = {{vld1q_u8(s_decodingTable + 64), vld1q_u8(s_decodingTable + 80),
+                             vld1q_u8(s_decodingTable + 96), vld1q_u8(s_decodingTable + 112)}};
+  const uint8x16_t highOffset = vdupq_n_u8(64);
+
+  uint32 i = 0;
+  for (; groupCount - i >= 16; i += 16, pSource += 64, pDestination += 48)
+  {
+    uint8x16x4_t characters = vld4q_u8(reinterpret_cast<const uint8*>(pSource));
+    uint8x16x4_t values;
+    uint8x16_t invalid = vdupq_n_u8(0);
+    for (uint32 j = 0; j < 4; j++)
+    {
+      uint8x16_t value = vqtbl4q_u8(lowTable, characters.val[j]);
+      values.val[j] = vqtbx4q_u8(value, highTable, vsubq_u8(characters.val[j], highOffset));
+      invalid = vorrq_u8(invalid, vorrq_u8(values.val[j], characters.val[j]));
+    }
+    if (vmaxvq_u8(invalid) & 0x80)
+      break;
+
+    uint8x16x3_t bytes;
+    bytes.val[0] = vorrq_u8(vshlq_n_u8(values.val[0], 2), vshrq_n_u8(values.val[1], 4));
+    bytes.val[1] = vorrq_u8(vshlq_n_u8(values.val[1], 4), vshrq_n_u8(values.val[2], 2));
+    bytes.val[2] = vorrq_u8(vshlq_n_u8(values.val[2], 6), values.val[3]);
+    vst3q_u8(pDestination, bytes);
+  }
+
+  return i;
+}
+
+#endif
+
+// for cpus without a vector path, everything is left to the scalar loops
+static uint32 EncodeGroupsNone(char* pDestination, const byte* pSource, uint32 groupCount, BASE64_ALPHABET alphabet)
+{
+  return 0;
+}
+
+static uint32 DecodeGroupsNone(byte* pDestination, const char* pSource, uint32 groupCount)
+{
+  return 0;
+}
+
+static decltype(&EncodeGroupsNone) SelectEncodeGroups()
+{
+#if defined(Y_BASE64_AVX2)
+  if (Y_CPUHasFeatures(Y_CPU_FEATURE_AVX2))
+    return EncodeGroupsAVX2;
+#elif defined(Y_BASE64_NEON)
+  return EncodeGroupsNEON;
+#endif
+
+  return EncodeGroupsNone;
+}
+
+static decltype(&DecodeGroupsNone) SelectDecodeGroups()
+{
+#if defined(Y_BASE64_AVX2)
+  if (Y_CPUHasFeatures(Y_CPU_FEATURE_AVX2))
+    return DecodeGroupsAVX2;
+#elif defined(Y_BASE64_NEON)
+  return DecodeGroupsNEON;
+#endif
+
+  return DecodeGroupsNone;
+}
+
+// anything called before static initialization gets here uses the scalar loops
+Y_CPU_DISPATCH(s_pEncodeGroupsVector, EncodeGroupsNone, SelectEncodeGroups);
+Y_CPU_DISPATCH(s_pDecodeGroupsVector, DecodeGroupsNone, SelectDecodeGroups);
+
+static uint32 EncodeGroups(char* pDestination, const byte* pSource, uint32 groupCount, BASE64_ALPHABET alphabet)
+{
+  uint32 done = s_pEncodeGroupsVector(pDestination, pSource, groupCount, alphabet);
+  EncodeGroupsScalar(pDestination + done * 4, pSource + done * 3, groupCount - done, s_encodingTables[alphabet]);
+  return groupCount * 4;
+}
+
+static bool DecodeGroups(byte* pDestination, const char* pSource, uint32 groupCount)
+{
+  uint32 done = s_pDecodeGroupsVector(pDestination, pSource, groupCount);
+  return (DecodeGroupsScalar(pDestination + done * 3, pSource + done * 4, groupCount - done) == groupCount - done);
+}
+
+// the last one or two bytes, as two or three characters
+static uint32 EncodeTail(char* pDestination, const byte* pSource, uint32 length, BASE64_ALPHABET alphabet,
+                         bool padding)
+{
+  DebugAssert(length > 0 && length < 3);
+  const char* pTable = s_encodingTables[alphabet];
+  uint32 value = (uint32(pSource[0]) << 16) | ((length > 1) ? (uint32(pSource[1]) << 8) : 0);
+  pDestination[0] = pTable[(value >> 18) & 63];
+  pDestination[1] = pTable[(value >> 12) & 63];
+  if (length > 1)
+    pDestination[2] = pTable[(value >> 6) & 63];
+  if (!padding)
+    return length + 1;
+
+  if (length == 1)
+    pDestination[2] = '=';
+  pDestination[3] = '=';
+  return 4;
+}
+
+// the last two or three characters, as one or two bytes
+static bool DecodeTail(byte* pDestination, const char* pSource, uint32 length)
+{
+  DebugAssert(length > 1 && length < 4);
+  uint32 a = s_decodingTable[byte(pSource[0])];
+  uint32 b = s_decodingTable[byte(pSource[1])];
+  uint32 c = (length > 2) ? s_decodingTable[byte(pSource[2])] : 0;
+  if ((a | b | c) & 0x80)
+    return false;
+
+  uint32 value = (a << 18) | (b << 12) | (c << 6);
+  pDestination[0] = byte(value >> 16);
+  if (length > 2)
+    pDestination[1] = byte(value >> 8);
+  return true;
+}
+
+namespace Base64 {
+
+uint32 GetEncodedLength(uint32 byteLength, bool padding /*= true*/)
+{
+  uint32 remainder = byteLength % 3;
+  uint32 length = (byteLength / 3) * 4;
+  if (remainder != 0)
+    length += padding ? 4 : (remainder + 1);
+  return length;
+}
+
+uint32 GetMaxDecodedLength(uint32 textLength)
+{
+  uint32 remainder = textLength % 4;
+  return (textLength / 4) * 3 + ((remainder > 1) ? (remainder - 1) : 0);
+}
+
+uint32 Encode(char* pDestination, const void* pData, uint32 dataLength,
+              BASE64_ALPHABET alphabet /*= BASE64_ALPHABET_STANDARD*/, bool padding /*= true*/)
+{
+  const byte* pSource = reinterpret_cast<const byte*>(pData);
+  uint32 groupCount = dataLength / 3;
+  uint32 length = EncodeGroups(pDestination, pSource, groupCount, alphabet);
+  if ((dataLength % 3) != 0)
+    length += EncodeTail(pDestination + length, pSource + groupCount * 3, dataLength % 3, alphabet, padding);
+
+  return length;
+}
+
+void Encode(String& destination, const void* pData, uint32 dataLength,
+            BASE64_ALPHABET alphabet /*= BASE64_ALPHABET_STANDARD*/, bool padding /*= true*/)
+{
+  destination.Resize(GetEncodedLength(dataLength, padding));
+  Encode(destination.GetWriteableCharArray(), pData, dataLength, alphabet, padding);
+}
+
+bool Decode(void* pDestination, uint32 destinationSize, const char* pText, uint32 textLength,
+            uint32* pDecodedLength)
+{
+  // padding only goes on the end, to make a whole group
+  uint32 length = textLength;
+  while (length > 0 && (textLength - length) < 2 && pText[length - 1] == '=')
+    length--;
+  if ((length % 4) == 1 || (length != textLength && (textLength % 4) != 0))
+    return false;
+
+  uint32 decodedLength = GetMaxDecodedLength(length);
+  if (decodedLength > destinationSize)
+    return false;
+
+  byte* pBytes = reinterpret_cast<byte*>(pDestination);
+  uint32 groupCount = length / 4;
+  if (!DecodeGroups(pBytes, pText, groupCount) ||
+      ((length % 4) != 0 && !DecodeTail(pBytes + groupCount * 3, pText + groupCount * 4, length % 4)))
+  {
+    return false;
+  }
+
+  *pDecodedLength = decodedLength;
+  return true;
+}
+
+} // namespace Base64
+
+Base64Encoder::Base64Encoder(ByteStream* pStream, BASE64_ALPHABET alphabet /*= BASE64_ALPHABET_STANDARD*/,
+                             bool padding /*= true*/)
+  : m_pStream(pStream), m_alphabet(alphabet), m_padding(padding), m_pendingLength(0)
+{
+}
+
+bool Base64Encoder::Write(const void* pData, uint32 length)
+{
+  const byte* pSource = reinterpret_cast<const byte*>(pData);
+  char buffer[1024];
+
+  // finish the group held back from last time
+  if (m_pendingLength > 0)
+  {
+    if (m_pendingLength + length < 3)
+    {
+      for (; length > 0; length--)
+        m_pending[m_pendingLength++] = *(pSource++);
+      return true;
+    }
+
+    byte group[3] = {m_pending[0], m_pending[1], 0};
+    for (; m_pendingLength < 3; length--)
+      group[m_pendingLength++] = *(pSource++);
+
+    m_pendingLength = 0;
+    EncodeGroups(buffer, group, 1, m_alphabet);
+    if (!m_pStream->Write2(buffer, 4))
+      return false;
+  }
+
+  while (length >= 3)
+  {
+    uint32 groupCount = Min(length / 3, uint32(sizeof(buffer) / 4));
+    uint32 textLength = EncodeGroups(buffer, pSource, groupCount, m_alphabet);
+    if (!m_pStream->Write2(buffer, textLength))
+      return false;
+
+    pSource += groupCount * 3;
+    length -= groupCount * 3;
+  }
+
+  for (; length > 0; length--)
+    m_pending[m_pendingLength++] = *(pSource++);
+
+  return true;
+}
+
+bool Base64Encoder::Finish()
+{
+  if (m_pendingLength == 0)
+    return true;
+
+  char buffer[4];
+  uint32 textLength = EncodeTail(buffer, m_pending, m_pendingLength, m_alphabet, m_padding);
+  m_pendingLength = 0;
+  return m_pStream->Write2(buffer, textLength);
+}
+
+Base64Decoder::Base64Decoder(ByteStream* pStream)
+  : m_pStream(pStream), m_pendingLength(0), m_paddingLength(0), m_errorState(false)
+{
+}
+
+bool Base64Decoder::Write(const char* pText, uint32 length)
+{
+  if (m_errorState)
+    return false;
+
+  for (uint32 i = 0; i < length; i++)
+  {
+    char ch = pText[i];
+    if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')
+      continue;
+
+    // nothing but more padding can follow padding
+    if (ch == '=')
+    {
+      if (++m_paddingLength > 2)
+        m_errorState = true;
+    }
+    else if (m_paddingLength > 0 || s_decodingTable[byte(ch)] == 255)
+    {
+      m_errorState = true;
+    }
+    else
+    {
+      m_pending[m_pendingLength++] = ch;
+      if (m_pendingLength == countof(m_pending) && !DecodePending(false))
+        m_errorState = true;
+    }
+
+    if (m_errorState)
+      return false;
+  }
+
+  return true;
+}
+
+bool Base64Decoder::Finish()
+{
+  if (m_errorState || !DecodePending(true))
+  {
+    m_errorState = true;
+    return false;
+  }
+
+  m_paddingLength = 0;
+  return true;
+}
+
+bool Base64Decoder::DecodePending(bool finish)
+{
+  // the characters are already known to be valid
+  byte buffer[countof(m_pending) / 4 * 3];
+  uint32 groupCount = m_pendingLength / 4;
+  uint32 remainder = m_pendingLength % 4;
+  if (finish && (remainder == 1 || (m_paddingLength > 0 && remainder + m_paddingLength != 4)))
+    return false;
+
+  DecodeGroups(buffer, m_pending, groupCount);
+  uint32 bufferLength = groupCount * 3;
+  if (finish && remainder > 0)
+  {
+    DecodeTail(buffer + bufferLength, m_pending + groupCount * 4, remainder);
+    bufferLength += remainder - 1;
+    remainder = 0;
+  }
+
+  std::memmove(m_pending, m_pending + groupCount * 4, remainder);
+  m_pendingLength = remainder;
+  return (bufferLength == 0 || m_pStream->Write2(buffer, bufferLength));
+}
+
+// The CString.h versions, which encode as much as fits with a terminator and decode up to the first character that
+// isn't base64.
+uint32 Y_getencodedbase64length(uint32 byteLength)
+{
+  return Base64::GetEncodedLength(byteLength);
+}
+
+uint32 Y_getdecodedbase64length(uint32 base64Length)
+{
+  if (base64Length > 0)
+    return (base64Length / 4 + 1) * 3;
+  else
+    return 0;
+}
+
+uint32 Y_parsebase64(const char* base64String, void* pOutBytes, uint32 maxOutBytes,
+                     bool exitOnInvalidCharacter /*= true*/, bool* pAtEnd /*= NULL*/)
+{
+  uint32 length = 0;
+  while (s_decodingTable[byte(base64String[length])] != 255)
+    length++;
+
+  // whole groups that fit, then as much of the next as fits
+  byte* pBytes = reinterpret_cast<byte*>(pOutBytes);
+  uint32 groupCount = Min(length / 4, maxOutBytes / 3);
+  DecodeGroups(pBytes, base64String, groupCount);
+  uint32 decodedLength = groupCount * 3;
+
+  uint32 remainder = Min(length - groupCount * 4, 3u);
+  if (remainder > 1 && decodedLength < maxOutBytes)
+  {
+    byte group[2];
+    DecodeTail(group, base64String + groupCount * 4, remainder);
+    uint32 copyLength = Min(remainder - 1, maxOutBytes - decodedLength);
+    std::memcpy(pBytes + decodedLength, group, copyLength);
+    decodedLength += copyLength;
+  }
+
+  if (pAtEnd != NULL)
+    *pAtEnd = (base64String[length] == '\0' && decodedLength == Base64::GetMaxDecodedLength(length));
+
+  return decodedLength;
+}
+
+uint32 Y_makebase64(const void* pInBytes, uint32 nInBytes, char* outBuffer, uint32 bufferSize)
+{
+  if (bufferSize == 0)
+    return 0;
+
+  uint32 length = Base64::Encode(outBuffer, pInBytes, Min(nInBytes, ((bufferSize - 1) / 4) * 3));
+  outBuffer[length] = '\0';
+  return length;
+}
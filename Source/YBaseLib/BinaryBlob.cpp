@@ -2,38 +2,178 @@
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/ByteStream.h"
 #include "YBaseLib/Memory.h"
+#include "YBaseLib/Mutex.h"
+#include <new>
 
-BinaryBlob::BinaryBlob(uint32 iDataSize) : m_iDataSize(iDataSize)
+const size_t BinaryBlob::MaxPooledSize;
+
+BinaryBlob::BinaryBlob(byte* pDataPointer, size_t iDataSize) : m_pDataPointer(pDataPointer), m_iDataSize(iDataSize) {}
+
+BinaryBlob::~BinaryBlob() {}
+
+// larger than any size class, owns its buffer
+class HeapBinaryBlob : public BinaryBlob
+{
+public:
+  HeapBinaryBlob(size_t dataSize) : BinaryBlob(static_cast<byte*>(Y_malloc(dataSize)), dataSize) {}
+  virtual ~HeapBinaryBlob() { Y_free(m_pDataPointer); }
+
+  virtual void DetachMemory(void** ppMemory, size_t* pSize) override
+  {
+    DebugAssert(m_pDataPointer != nullptr);
+    *ppMemory = m_pDataPointer;
+    *pSize = m_iDataSize;
+    m_pDataPointer = nullptr;
+  }
+};
+
+// Each class holds at most this many bytes of free blocks, anything released past it goes back to the heap.
+static const size_t s_sizeClassSizes[] = {256, 1024, 4096, 16384, BinaryBlob::MaxPooledSize};
+static const uint32 SizeClassCount = countof(s_sizeClassSizes);
+static const size_t MaxPooledBytesPerClass = 1024 * 1024;
+
+// In front of every pooled blob, so its operator delete knows which free list the block goes back to. Padded so the
+// data after the blob stays 16 byte aligned.
+struct PooledBlockHeader
+{
+  PooledBlockHeader* pNextFree;
+  uint32 sizeClass;
+};
+static const size_t PooledBlockHeaderSize = 16;
+static_assert(sizeof(PooledBlockHeader) <= PooledBlockHeaderSize, "pooled block header fits its padding");
+
+// Released blocks of one class, linked through their headers. As with socket buffers, a plain lock is only held for
+// a couple of pointer moves.
+struct SizeClassPool
+{
+  Mutex Lock;
+  PooledBlockHeader* pFreeBlocks;
+  uint32 FreeCount;
+};
+static SizeClassPool s_sizeClassPools[SizeClassCount];
+
+// the blob, then its data, in one block from the pool
+class PooledBinaryBlob : public BinaryBlob
+{
+public:
+  static PooledBinaryBlob* Create(size_t dataSize, uint32 sizeClass);
+
+  // called by the deleting destructor once the blob is destroyed, returns the block to its pool
+  static void operator delete(void* pMemory);
+
+private:
+  PooledBinaryBlob(size_t dataSize);
+};
+
+static const size_t PooledBlobSize = (sizeof(PooledBinaryBlob) + 15) & ~size_t(15);
+
+PooledBinaryBlob::PooledBinaryBlob(size_t dataSize)
+  : BinaryBlob(reinterpret_cast<byte*>(this) + PooledBlobSize, dataSize)
 {
-  m_pDataPointer = (byte*)std::malloc(iDataSize);
 }
 
-BinaryBlob::~BinaryBlob()
+PooledBinaryBlob* PooledBinaryBlob::Create(size_t dataSize, uint32 sizeClass)
 {
-  std::free(m_pDataPointer);
+  SizeClassPool& pool = s_sizeClassPools[sizeClass];
+  pool.Lock.Lock();
+  PooledBlockHeader* pHeader = pool.pFreeBlocks;
+  if (pHeader != nullptr)
+  {
+    pool.pFreeBlocks = pHeader->pNextFree;
+    pool.FreeCount--;
+  }
+  pool.Lock.Unlock();
+
+  if (pHeader == nullptr)
+  {
+    pHeader = static_cast<PooledBlockHeader*>(
+      Y_malloc(PooledBlockHeaderSize + PooledBlobSize + s_sizeClassSizes[sizeClass]));
+    pHeader->sizeClass = sizeClass;
+  }
+
+  return new (reinterpret_cast<byte*>(pHeader) + PooledBlockHeaderSize) PooledBinaryBlob(dataSize);
+}
+
+void PooledBinaryBlob::operator delete(void* pMemory)
+{
+  PooledBlockHeader* pHeader =
+    reinterpret_cast<PooledBlockHeader*>(static_cast<byte*>(pMemory) - PooledBlockHeaderSize);
+  SizeClassPool& pool = s_sizeClassPools[pHeader->sizeClass];
+
+  pool.Lock.Lock();
+  if (pool.FreeCount < MaxPooledBytesPerClass / s_sizeClassSizes[pHeader->sizeClass])
+  {
+    pHeader->pNextFree = pool.pFreeBlocks;
+    pool.pFreeBlocks = pHeader;
+    pool.FreeCount++;
+    pool.Lock.Unlock();
+    return;
+  }
+  pool.Lock.Unlock();
+
+  Y_free(pHeader);
 }
 
-BinaryBlob* BinaryBlob::Allocate(uint32 DataSize)
+// shares part of another blob's data, keeping it alive
+class ViewBinaryBlob : public BinaryBlob
+{
+public:
+  ViewBinaryBlob(const BinaryBlob* pParent, size_t offset, size_t size)
+    : BinaryBlob(const_cast<byte*>(pParent->GetDataPointer()) + offset, size), m_pParent(pParent)
+  {
+    m_pParent->AddRef();
+  }
+
+  virtual ~ViewBinaryBlob() { m_pParent->Release(); }
+
+private:
+  const BinaryBlob* m_pParent;
+};
+
+// references the memory of a stream, keeping it alive
+class MappedBinaryBlob : public BinaryBlob
 {
-  DebugAssert(DataSize > 0);
-  // return new (Y_malloc(sizeof(BinaryBlob) + DataSize)) BinaryBlob(DataSize);
-  return new BinaryBlob(DataSize);
+public:
+  MappedBinaryBlob(ByteStream* pStream, const byte* pData, size_t size)
+    : BinaryBlob(const_cast<byte*>(pData), size), m_pStream(pStream)
+  {
+    m_pStream->AddRef();
+  }
+
+  virtual ~MappedBinaryBlob() { m_pStream->Release(); }
+
+private:
+  ByteStream* m_pStream;
+};
+
+BinaryBlob* BinaryBlob::Allocate(size_t DataSize)
+{
+  if (DataSize > MaxPooledSize)
+    return new HeapBinaryBlob(DataSize);
+
+  uint32 sizeClass = 0;
+  while (s_sizeClassSizes[sizeClass] < DataSize)
+    sizeClass++;
+
+  return PooledBinaryBlob::Create(DataSize, sizeClass);
 }
 
-BinaryBlob* BinaryBlob::CreateFromStream(ByteStream* pStream, bool seekToStart /* = true */, int32 byteCount /* = -1 */)
+BinaryBlob* BinaryBlob::CreateFromStream(ByteStream* pStream, bool seekToStart /* = true */, int64 byteCount /* = -1 */)
 {
-  uint32 blobSize = (byteCount < 0) ? (uint32)pStream->GetSize() : (uint32)byteCount;
+  uint64 blobSize = (byteCount < 0) ? pStream->GetSize() : (uint64)byteCount;
   uint64 currentPosition = pStream->GetPosition();
 
   if (!seekToStart && byteCount < 0)
-    blobSize -= (uint32)currentPosition;
+    blobSize -= currentPosition;
   else
     pStream->SeekAbsolute(0);
 
-  Assert(blobSize < 0xFFFFFFFFUL);
+  if (blobSize > (uint64)SIZE_MAX)
+    return nullptr;
 
-  BinaryBlob* pBlob = BinaryBlob::Allocate(blobSize);
-  if (!pStream->Read(pBlob->GetDataPointer(), blobSize))
+  // memory streams and mapped files copy it all in one go
+  BinaryBlob* pBlob = BinaryBlob::Allocate((size_t)blobSize);
+  if (pStream->Read64(pBlob->GetDataPointer(), blobSize) != blobSize)
   {
     pBlob->Release();
     return nullptr;
@@ -45,7 +185,7 @@ BinaryBlob* BinaryBlob::CreateFromStream(ByteStream* pStream, bool seekToStart /
   return pBlob;
 }
 
-BinaryBlob* BinaryBlob::CreateFromPointer(const void* pData, uint32 dataSize)
+BinaryBlob* BinaryBlob::CreateFromPointer(const void* pData, size_t dataSize)
 {
   BinaryBlob* pBlob = BinaryBlob::Allocate(dataSize);
   if (dataSize > 0)
@@ -54,16 +194,71 @@ BinaryBlob* BinaryBlob::CreateFromPointer(const void* pData, uint32 dataSize)
   return pBlob;
 }
 
+// keeps the blob alive for as long as the stream reads from it
+class BinaryBlobReadOnlyByteStream : public ReadOnlyMemoryByteStream
+{
+public:
+  BinaryBlobReadOnlyByteStream(const BinaryBlob* pBlob)
+    : ReadOnlyMemoryByteStream(pBlob->GetDataPointer(), pBlob->GetDataSize()), m_pBlob(pBlob)
+  {
+    m_pBlob->AddRef();
+  }
+
+  virtual ~BinaryBlobReadOnlyByteStream() { m_pBlob->Release(); }
+
+private:
+  const BinaryBlob* m_pBlob;
+};
+
 ByteStream* BinaryBlob::CreateReadOnlyStream() const
 {
-  // todo: seperate class here for tracking references back to the blob
-  return ByteStream_CreateReadOnlyMemoryStream(m_pDataPointer, m_iDataSize);
+  return new BinaryBlobReadOnlyByteStream(this);
+}
+
+BinaryBlob* BinaryBlob::CreateFromMappedStream(ByteStream* pStream, uint64 offset /* = 0 */,
+                                               int64 byteCount /* = -1 */)
+{
+  uint64 streamSize = pStream->GetSize();
+  if (offset > streamSize)
+    return nullptr;
+
+  uint64 blobSize = (byteCount < 0) ? (streamSize - offset) : (uint64)byteCount;
+  if (blobSize > streamSize - offset || blobSize > (uint64)SIZE_MAX)
+    return nullptr;
+
+  const byte* pBasePointer = pStream->GetBasePointer();
+  if (pBasePointer != nullptr)
+    return new MappedBinaryBlob(pStream, pBasePointer + offset, (size_t)blobSize);
+
+  uint64 currentPosition = pStream->GetPosition();
+  if (!pStream->SeekAbsolute(offset))
+    return nullptr;
+
+  BinaryBlob* pBlob = BinaryBlob::Allocate((size_t)blobSize);
+  if (pStream->Read64(pBlob->GetDataPointer(), blobSize) != blobSize)
+  {
+    pBlob->Release();
+    pBlob = nullptr;
+  }
+
+  pStream->SeekAbsolute(currentPosition);
+  return pBlob;
+}
+
+BinaryBlob* BinaryBlob::CreateView(size_t offset, size_t size) const
+{
+  DebugAssert(offset <= m_iDataSize && size <= m_iDataSize - offset);
+  return new ViewBinaryBlob(this, offset, size);
 }
 
-void BinaryBlob::DetachMemory(void** ppMemory, uint32* pSize)
+void BinaryBlob::DetachMemory(void** ppMemory, size_t* pSize)
 {
   DebugAssert(m_pDataPointer != nullptr);
-  *ppMemory = m_pDataPointer;
+  void* pMemory = Y_malloc(m_iDataSize);
+  if (m_iDataSize > 0)
+    std::memcpy(pMemory, m_pDataPointer, m_iDataSize);
+
+  *ppMemory = pMemory;
   *pSize = m_iDataSize;
   m_pDataPointer = nullptr;
 }
@@ -0,0 +1,897 @@
+#include "YBaseLib/BinaryLog.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/BinaryWriter.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+Log_SetChannel(BinaryLog);
+
+using namespace BinaryLog;
+
+namespace {
+
+enum PRINTF_ARGUMENT
+{
+  PRINTF_ARGUMENT_SIGNED,
+  PRINTF_ARGUMENT_UNSIGNED,
+  PRINTF_ARGUMENT_CHARACTER,
+  PRINTF_ARGUMENT_DOUBLE,
+  PRINTF_ARGUMENT_STRING,
+  PRINTF_ARGUMENT_POINTER,
+};
+
+enum PRINTF_LENGTH
+{
+  PRINTF_LENGTH_NONE,
+  PRINTF_LENGTH_CHAR,
+  PRINTF_LENGTH_SHORT,
+  PRINTF_LENGTH_LONG,
+  PRINTF_LENGTH_LONG_LONG,
+  PRINTF_LENGTH_INTMAX,
+  PRINTF_LENGTH_SIZE,
+  PRINTF_LENGTH_PTRDIFF,
+  PRINTF_LENGTH_LONG_DOUBLE,
+};
+
+// One conversion of a printf format string, the spec being the flags, width and precision after the %.
+struct PrintfConversion
+{
+  const char* pSpec;
+  uint32 SpecLength;
+  bool WidthArgument;
+  bool PrecisionArgument;
+  PRINTF_LENGTH Length;
+  PRINTF_ARGUMENT Argument;
+  char Conversion;
+  const char* pEnd;
+};
+
+} // namespace
+
+static inline bool IsDigit(char ch)
+{
+  return (ch >= '0' && ch <= '9');
+}
+
+// Parses the conversion following a %, returning false for ones that can't be captured.
+static bool ParsePrintfConversion(const char* pSpec, PrintfConversion* pConversion)
+{
+  const char* p = pSpec;
+  while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0' || *p == '\'')
+    p++;
+
+  pConversion->WidthArgument = (*p == '*');
+  if (*p == '*')
+    p++;
+  while (IsDigit(*p))
+    p++;
+
+  pConversion->PrecisionArgument = false;
+  if (*p == '.')
+  {
+    p++;
+    pConversion->PrecisionArgument = (*p == '*');
+    if (*p == '*')
+      p++;
+    while (IsDigit(*p))
+      p++;
+  }
+
+  pConversion->pSpec = pSpec;
+  pConversion->SpecLength = uint32(p - pSpec);
+
+  // I, I32 and I64 are Microsoft's
+  pConversion->Length = PRINTF_LENGTH_NONE;
+  switch (*p)
+  {
+    case 'h':
+      pConversion->Length = (p[1] == 'h') ? PRINTF_LENGTH_CHAR : PRINTF_LENGTH_SHORT;
+      p += (p[1] == 'h') ? 2 : 1;
+      break;
+    case 'l':
+      pConversion->Length = (p[1] == 'l') ? PRINTF_LENGTH_LONG_LONG : PRINTF_LENGTH_LONG;
+      p += (p[1] == 'l') ? 2 : 1;
+      break;
+    case 'q':
+      pConversion->Length = PRINTF_LENGTH_LONG_LONG;
+      p++;
+      break;
+    case 'j':
+      pConversion->Length = PRINTF_LENGTH_INTMAX;
+      p++;
+      break;
+    case 'z':
+      pConversion->Length = PRINTF_LENGTH_SIZE;
+      p++;
+      break;
+    case 't':
+      pConversion->Length = PRINTF_LENGTH_PTRDIFF;
+      p++;
+      break;
+    case 'L':
+      pConversion->Length = PRINTF_LENGTH_LONG_DOUBLE;
+      p++;
+      break;
+    case 'I':
+      if (p[1] == '6' && p[2] == '4')
+      {
+        pConversion->Length = PRINTF_LENGTH_LONG_LONG;
+        p += 3;
+      }
+      else if (p[1] == '3' && p[2] == '2')
+      {
+        p += 3;
+      }
+      else
+      {
+        pConversion->Length = PRINTF_LENGTH_SIZE;
+        p++;
+      }
+      break;
+  }
+
+  pConversion->Conversion = *p;
+  pConversion->pEnd = p + 1;
+  switch (*p)
+  {
+    case 'd':
+    case 'i':
+      pConversion->Argument = PRINTF_ARGUMENT_SIGNED;
+      return true;
+
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      pConversion->Argument = PRINTF_ARGUMENT_UNSIGNED;
+      return true;
+
+    case 'c':
+      pConversion->Argument = PRINTF_ARGUMENT_CHARACTER;
+      return (pConversion->Length == PRINTF_LENGTH_NONE);
+
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      pConversion->Argument = PRINTF_ARGUMENT_DOUBLE;
+      return true;
+
+    case 's':
+      pConversion->Argument = PRINTF_ARGUMENT_STRING;
+      return (pConversion->Length == PRINTF_LENGTH_NONE);
+
+    case 'p':
+      pConversion->Argument = PRINTF_ARGUMENT_POINTER;
+      return (pConversion->Length == PRINTF_LENGTH_NONE);
+
+    default:
+      // %n, wide characters and strings, and anything malformed
+      return false;
+  }
+}
+
+static void AppendVarUInt(PODArray<byte>& buffer, uint64 value)
+{
+  byte encoded[BinaryWriter::MaxVarIntSize];
+  buffer.AddRange(encoded, BinaryWriter::EncodeVarUInt(encoded, value));
+}
+
+static void AppendVarInt(PODArray<byte>& buffer, int64 value)
+{
+  AppendVarUInt(buffer, BinaryWriter::ZigZagEncode(value));
+}
+
+static void AppendDouble(PODArray<byte>& buffer, double value)
+{
+  buffer.AddRange(reinterpret_cast<const byte*>(&value), sizeof(value));
+}
+
+static void AppendString(PODArray<byte>& buffer, const char* pString, uint32 length)
+{
+  AppendVarUInt(buffer, length);
+  buffer.AddRange(reinterpret_cast<const byte*>(pString), length);
+}
+
+static int64 ReadSignedArgument(PRINTF_LENGTH length, va_list& ap)
+{
+  switch (length)
+  {
+    case PRINTF_LENGTH_CHAR:
+      return (signed char)va_arg(ap, int);
+    case PRINTF_LENGTH_SHORT:
+      return (short)va_arg(ap, int);
+    case PRINTF_LENGTH_LONG:
+      return va_arg(ap, long);
+    case PRINTF_LENGTH_LONG_LONG:
+    case PRINTF_LENGTH_LONG_DOUBLE:
+      return va_arg(ap, long long);
+    case PRINTF_LENGTH_INTMAX:
+      return va_arg(ap, intmax_t);
+    case PRINTF_LENGTH_SIZE:
+    case PRINTF_LENGTH_PTRDIFF:
+      return va_arg(ap, ptrdiff_t);
+    default:
+      return va_arg(ap, int);
+  }
+}
+
+static uint64 ReadUnsignedArgument(PRINTF_LENGTH length, va_list& ap)
+{
+  switch (length)
+  {
+    case PRINTF_LENGTH_CHAR:
+      return (unsigned char)va_arg(ap, unsigned int);
+    case PRINTF_LENGTH_SHORT:
+      return (unsigned short)va_arg(ap, unsigned int);
+    case PRINTF_LENGTH_LONG:
+      return va_arg(ap, unsigned long);
+    case PRINTF_LENGTH_LONG_LONG:
+    case PRINTF_LENGTH_LONG_DOUBLE:
+      return va_arg(ap, unsigned long long);
+    case PRINTF_LENGTH_INTMAX:
+      return va_arg(ap, uintmax_t);
+    case PRINTF_LENGTH_SIZE:
+    case PRINTF_LENGTH_PTRDIFF:
+      return va_arg(ap, size_t);
+    default:
+      return va_arg(ap, unsigned int);
+  }
+}
+
+// Gathers the arguments as the format reads them, integers narrowed as the conversion would, so they can be written
+// out at their full width later. Star widths and precisions go before the value.
+static bool CapturePrintfArguments(PODArray<byte>& payload, const char* format, va_list& ap)
+{
+  for (const char* p = format; *p != '\0'; p++)
+  {
+    if (*p != '%')
+      continue;
+    if (p[1] == '%')
+    {
+      p++;
+      continue;
+    }
+
+    PrintfConversion conversion;
+    if (!ParsePrintfConversion(p + 1, &conversion))
+      return false;
+
+    if (conversion.WidthArgument)
+      AppendVarInt(payload, va_arg(ap, int));
+    if (conversion.PrecisionArgument)
+      AppendVarInt(payload, va_arg(ap, int));
+
+    switch (conversion.Argument)
+    {
+      case PRINTF_ARGUMENT_SIGNED:
+        AppendVarInt(payload, ReadSignedArgument(conversion.Length, ap));
+        break;
+
+      case PRINTF_ARGUMENT_UNSIGNED:
+        AppendVarUInt(payload, ReadUnsignedArgument(conversion.Length, ap));
+        break;
+
+      case PRINTF_ARGUMENT_CHARACTER:
+        AppendVarInt(payload, va_arg(ap, int));
+        break;
+
+      case PRINTF_ARGUMENT_DOUBLE:
+        if (conversion.Length == PRINTF_LENGTH_LONG_DOUBLE)
+          AppendDouble(payload, (double)va_arg(ap, long double));
+        else
+          AppendDouble(payload, va_arg(ap, double));
+        break;
+
+      case PRINTF_ARGUMENT_STRING:
+      {
+        // the same as the C library is expected to print, rather than crashing the decoder
+        const char* pString = va_arg(ap, const char*);
+        if (pString == nullptr)
+          pString = "(null)";
+        AppendString(payload, pString, Y_strlen(pString));
+      }
+      break;
+
+      case PRINTF_ARGUMENT_POINTER:
+        AppendVarUInt(payload, (uint64)(uintptr_t)va_arg(ap, void*));
+        break;
+    }
+
+    p = conversion.pEnd - 1;
+  }
+
+  return true;
+}
+
+namespace {
+
+// reads values back out of a message's payload
+class PayloadReader
+{
+public:
+  PayloadReader(const byte* pData, uint32 size) : m_pData(pData), m_remaining(size) {}
+
+  bool IsAtEnd() const { return (m_remaining == 0); }
+
+  bool ReadVarUInt(uint64* pValue)
+  {
+    uint32 length = BinaryReader::DecodeVarUInt(m_pData, m_remaining, pValue);
+    m_pData += length;
+    m_remaining -= length;
+    return (length > 0);
+  }
+
+  bool ReadVarInt(int64* pValue)
+  {
+    uint64 value;
+    if (!ReadVarUInt(&value))
+      return false;
+
+    *pValue = BinaryReader::ZigZagDecode(value);
+    return true;
+  }
+
+  bool ReadDouble(double* pValue)
+  {
+    if (m_remaining < sizeof(double))
+      return false;
+
+    std::memcpy(pValue, m_pData, sizeof(double));
+    m_pData += sizeof(double);
+    m_remaining -= sizeof(double);
+    return true;
+  }
+
+  bool ReadString(const char** ppString, uint32* pLength)
+  {
+    uint64 length;
+    if (!ReadVarUInt(&length) || length > m_remaining)
+      return false;
+
+    *ppString = reinterpret_cast<const char*>(m_pData);
+    *pLength = (uint32)length;
+    m_pData += length;
+    m_remaining -= (uint32)length;
+    return true;
+  }
+
+private:
+  const byte* m_pData;
+  uint32 m_remaining;
+};
+
+} // namespace
+
+BinaryLogWriter::BinaryLogWriter(ByteStream* pStream, Y_TIMER_VALUE startTimeStamp)
+  : m_pStream(pStream), m_lastTimeStamp(startTimeStamp), m_errorState(false), m_nextStringID(1)
+{
+  m_pStream->AddRef();
+
+  // the reader converts the times with the writer's timer resolution
+  double secondsPerTick = Y_TimerConvertToSeconds(1);
+  m_record.AddRange(reinterpret_cast<const byte*>(&Magic), sizeof(Magic));
+  m_record.AddRange(reinterpret_cast<const byte*>(&Version), sizeof(Version));
+  m_record.AddRange(reinterpret_cast<const byte*>(&secondsPerTick), sizeof(secondsPerTick));
+  m_errorState = !m_pStream->Write2(m_record.GetBasePointer(), m_record.GetSize());
+  m_record.Clear();
+}
+
+BinaryLogWriter::~BinaryLogWriter()
+{
+  Flush();
+  m_pStream->Release();
+}
+
+bool BinaryLogWriter::Flush()
+{
+  if (!m_errorState && !m_pStream->Flush())
+    m_errorState = true;
+
+  return !m_errorState;
+}
+
+uint32 BinaryLogWriter::InternString(const char* pString, uint32 length)
+{
+  // strings that aren't literals can change under the same address, and get a new number when they do
+  FlatHashTable<const char*, InternedString>::Member* pMember = m_strings.Find(pString);
+  if (pMember != nullptr && pMember->Value.Length == length &&
+      std::memcmp(m_stringData.GetBasePointer() + pMember->Value.Offset, pString, length) == 0)
+  {
+    return pMember->Value.ID;
+  }
+
+  InternedString interned;
+  interned.ID = m_nextStringID++;
+  interned.Offset = m_stringData.GetSize();
+  interned.Length = length;
+  m_stringData.AddRange(pString, length);
+  if (pMember != nullptr)
+    pMember->Value = interned;
+  else
+    m_strings.Insert(pString, interned);
+
+  m_record.Add((byte)RECORD_TYPE_STRING);
+  AppendVarUInt(m_record, interned.ID);
+  AppendString(m_record, pString, length);
+  return interned.ID;
+}
+
+bool BinaryLogWriter::WriteMessage(MESSAGE_KIND kind, const char* channelName, const char* functionName,
+                                   LOGLEVEL level, uint32 formatID)
+{
+  uint32 channelID = InternString(channelName, Y_strlen(channelName));
+  uint32 functionID = InternString(functionName, Y_strlen(functionName));
+
+  Y_TIMER_VALUE timeStamp = Y_TimerGetValue();
+  if (timeStamp < m_lastTimeStamp)
+    timeStamp = m_lastTimeStamp;
+
+  m_record.Add((byte)RECORD_TYPE_MESSAGE);
+  m_record.Add((byte)kind);
+  m_record.Add((byte)level);
+  AppendVarUInt(m_record, channelID);
+  AppendVarUInt(m_record, functionID);
+  if (kind != MESSAGE_KIND_TEXT)
+    AppendVarUInt(m_record, formatID);
+  AppendVarUInt(m_record, (uint64)(timeStamp - m_lastTimeStamp));
+  AppendVarUInt(m_record, m_payload.GetSize());
+  m_record.AddArray(m_payload);
+  m_lastTimeStamp = timeStamp;
+
+  // the strings go with the message that introduced them, so the stream never refers to one it doesn't have
+  m_errorState = !m_pStream->Write2(m_record.GetBasePointer(), m_record.GetSize());
+  m_record.Clear();
+  m_payload.Clear();
+  return !m_errorState;
+}
+
+bool BinaryLogWriter::WriteText(const char* channelName, const char* functionName, LOGLEVEL level,
+                                const char* message, uint32 messageLength)
+{
+  if (m_errorState)
+    return false;
+
+  m_payload.AddRange(reinterpret_cast<const byte*>(message), messageLength);
+  return WriteMessage(MESSAGE_KIND_TEXT, channelName, functionName, level, 0);
+}
+
+bool BinaryLogWriter::WritePrintf(const char* channelName, const char* functionName, LOGLEVEL level,
+                                  const char* format, va_list ap)
+{
+  if (m_errorState)
+    return false;
+
+  va_list apCapture;
+  va_copy(apCapture, ap);
+  bool captured = CapturePrintfArguments(m_payload, format, apCapture);
+  va_end(apCapture);
+  if (!captured)
+  {
+    m_payload.Clear();
+    return false;
+  }
+
+  uint32 formatID = InternString(format, Y_strlen(format));
+  return WriteMessage(MESSAGE_KIND_PRINTF, channelName, functionName, level, formatID);
+}
+
+bool BinaryLogWriter::WriteFormatted(const char* channelName, const char* functionName, LOGLEVEL level,
+                                     const StringView& format, const TypedFormat::Argument* pArguments,
+                                     uint32 argumentCount)
+{
+  if (m_errorState)
+    return false;
+
+  // custom formatters only work on the value while it exists
+  for (uint32 i = 0; i < argumentCount; i++)
+  {
+    if (pArguments[i].Type == TypedFormat::ARGUMENT_TYPE_CUSTOM)
+      return false;
+  }
+
+  AppendVarUInt(m_payload, argumentCount);
+  for (uint32 i = 0; i < argumentCount; i++)
+  {
+    const TypedFormat::Argument& argument = pArguments[i];
+    m_payload.Add((byte)argument.Type);
+    switch (argument.Type)
+    {
+      case TypedFormat::ARGUMENT_TYPE_CHARACTER:
+      case TypedFormat::ARGUMENT_TYPE_SIGNED:
+        AppendVarInt(m_payload, argument.Signed);
+        break;
+
+      case TypedFormat::ARGUMENT_TYPE_BOOL:
+      case TypedFormat::ARGUMENT_TYPE_UNSIGNED:
+        AppendVarUInt(m_payload, argument.Unsigned);
+        break;
+
+      case TypedFormat::ARGUMENT_TYPE_FLOAT:
+      case TypedFormat::ARGUMENT_TYPE_DOUBLE:
+        AppendDouble(m_payload, argument.Double);
+        break;
+
+      case TypedFormat::ARGUMENT_TYPE_STRING:
+        AppendString(m_payload, argument.Text.pData, argument.Text.Length);
+        break;
+
+      case TypedFormat::ARGUMENT_TYPE_POINTER:
+        AppendVarUInt(m_payload, (uint64)(uintptr_t)argument.Pointer);
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  uint32 formatID = InternString(format.GetData(), format.GetLength());
+  return WriteMessage(MESSAGE_KIND_FORMAT, channelName, functionName, level, formatID);
+}
+
+BinaryLogReader::BinaryLogReader(ByteStream* pStream)
+  : m_pStream(pStream), m_reader(pStream, Y_HOST_ENDIAN_TYPE, false, true), m_headerRead(false), m_damaged(false),
+    m_secondsPerTick(0.0), m_timeStamp(0)
+{
+  m_pStream->AddRef();
+}
+
+BinaryLogReader::~BinaryLogReader()
+{
+  m_reader.SyncStream();
+  m_pStream->Release();
+}
+
+bool BinaryLogReader::ReadHeader()
+{
+  uint32 magic, version;
+  if (!m_reader.SafeReadUInt32(&magic) || !m_reader.SafeReadUInt32(&version) ||
+      !m_reader.SafeReadDouble(&m_secondsPerTick))
+  {
+    Log_ErrorPrint("BinaryLogReader::ReadHeader: Stream is too short for a binary log");
+    return false;
+  }
+
+  // a log from a machine of the other byte order has its magic reversed
+  if (magic != Magic)
+  {
+    Log_ErrorPrintf("BinaryLogReader::ReadHeader: Not a binary log, or written in the other byte order (%08X)",
+                    magic);
+    return false;
+  }
+  if (version != Version)
+  {
+    Log_ErrorPrintf("BinaryLogReader::ReadHeader: Unsupported version %u", version);
+    return false;
+  }
+
+  m_headerRead = true;
+  return true;
+}
+
+bool BinaryLogReader::ReadStringRecord()
+{
+  uint64 id, length;
+  if (!m_reader.SafeReadVarUInt64(&id) || !m_reader.SafeReadVarUInt64(&length) || length > 0xFFFFFFFF)
+    return false;
+
+  // numbers are handed out in order, and never reused
+  if (id != (uint64)m_strings.GetSize() + 1)
+  {
+    Log_ErrorPrintf("BinaryLogReader::ReadStringRecord: String %" PRIu64 " is out of order", id);
+    return false;
+  }
+
+  String value;
+  if (!m_reader.SafeReadFixedString((uint32)length, &value))
+    return false;
+
+  m_strings.Add(std::move(value));
+  return true;
+}
+
+const String* BinaryLogReader::GetString(uint64 id) const
+{
+  return (id > 0 && id <= m_strings.GetSize()) ? &m_strings[(uint32)(id - 1)] : nullptr;
+}
+
+bool BinaryLogReader::ReadMessage(Message* pMessage)
+{
+  if (m_damaged || (!m_headerRead && !ReadHeader()))
+  {
+    m_damaged = true;
+    return false;
+  }
+
+  for (;;)
+  {
+    // the end of the stream, unless it's in the middle of a record
+    byte recordType;
+    if (!m_reader.SafeReadByte(&recordType))
+      return false;
+
+    if (recordType == RECORD_TYPE_STRING)
+    {
+      if (!ReadStringRecord())
+        break;
+
+      continue;
+    }
+    if (recordType != RECORD_TYPE_MESSAGE)
+    {
+      Log_ErrorPrintf("BinaryLogReader::ReadMessage: Unknown record type %u", (uint32)recordType);
+      break;
+    }
+
+    byte kind, level;
+    uint64 channelID, functionID, formatID = 0, timeDelta, payloadSize;
+    if (!m_reader.SafeReadByte(&kind) || !m_reader.SafeReadByte(&level) ||
+        !m_reader.SafeReadVarUInt64(&channelID) || !m_reader.SafeReadVarUInt64(&functionID) ||
+        (kind != MESSAGE_KIND_TEXT && !m_reader.SafeReadVarUInt64(&formatID)) ||
+        !m_reader.SafeReadVarUInt64(&timeDelta) || !m_reader.SafeReadVarUInt64(&payloadSize) ||
+        payloadSize > 0xFFFFFFFF)
+    {
+      break;
+    }
+
+    m_payload.Resize((uint32)payloadSize);
+    if (payloadSize > 0 && !m_reader.SafeReadBytes(m_payload.GetBasePointer(), (uint32)payloadSize))
+      break;
+
+    const String* pChannelName = GetString(channelID);
+    const String* pFunctionName = GetString(functionID);
+    const String* pFormat = GetString(formatID);
+    if (pChannelName == nullptr || pFunctionName == nullptr || level >= LOGLEVEL_COUNT ||
+        (kind != MESSAGE_KIND_TEXT && pFormat == nullptr))
+    {
+      Log_ErrorPrint("BinaryLogReader::ReadMessage: Message refers to a string that isn't in the log");
+      break;
+    }
+
+    m_timeStamp += timeDelta;
+    pMessage->ChannelName = *pChannelName;
+    pMessage->FunctionName = *pFunctionName;
+    pMessage->Level = (LOGLEVEL)level;
+    pMessage->Time = (double)m_timeStamp * m_secondsPerTick;
+    pMessage->Text.Clear();
+
+    bool rendered;
+    switch (kind)
+    {
+      case MESSAGE_KIND_TEXT:
+        pMessage->Text.AppendString(reinterpret_cast<const char*>(m_payload.GetBasePointer()), m_payload.GetSize());
+        rendered = true;
+        break;
+      case MESSAGE_KIND_PRINTF:
+        rendered = RenderPrintf(*pFormat, pMessage->Text);
+        break;
+      case MESSAGE_KIND_FORMAT:
+        rendered = RenderFormat(*pFormat, pMessage->Text);
+        break;
+      default:
+        rendered = false;
+        break;
+    }
+
+    if (!rendered)
+    {
+      Log_ErrorPrintf("BinaryLogReader::ReadMessage: Message arguments don't match its format string '%s'",
+                      (pFormat != nullptr) ? pFormat->GetCharArray() : "");
+      break;
+    }
+
+    return true;
+  }
+
+  m_damaged = true;
+  return false;
+}
+
+bool BinaryLogReader::RenderPrintf(const String& format, String& text)
+{
+  PayloadReader payload(m_payload.GetBasePointer(), m_payload.GetSize());
+  const char* pLiteral = format.GetCharArray();
+  for (const char* p = pLiteral; *p != '\0'; p++)
+  {
+    if (*p != '%')
+      continue;
+
+    text.AppendString(pLiteral, uint32(p - pLiteral));
+    if (p[1] == '%')
+    {
+      text.AppendCharacter('%');
+      pLiteral = ++p + 1;
+      continue;
+    }
+
+    PrintfConversion conversion;
+    if (!ParsePrintfConversion(p + 1, &conversion))
+      return false;
+
+    // The conversion is rebuilt with the star arguments written in, and integers at their full width. A negative
+    // precision is the same as none, and a negative width is left aligned, which the minus sign gives.
+    int64 widthArgument = 0, precisionArgument = 0;
+    if ((conversion.WidthArgument && !payload.ReadVarInt(&widthArgument)) ||
+        (conversion.PrecisionArgument && !payload.ReadVarInt(&precisionArgument)))
+    {
+      return false;
+    }
+
+    TinyString conversionFormat;
+    conversionFormat.AppendCharacter('%');
+    for (uint32 i = 0; i < conversion.SpecLength; i++)
+    {
+      char ch = conversion.pSpec[i];
+      if (ch != '*')
+      {
+        conversionFormat.AppendCharacter(ch);
+        continue;
+      }
+
+      bool isPrecision = (i > 0 && conversion.pSpec[i - 1] == '.');
+      int64 value = isPrecision ? precisionArgument : widthArgument;
+      if (isPrecision && value < 0)
+        conversionFormat.Erase(-1);
+      else
+        conversionFormat.AppendFormattedString("%d", (int)value);
+    }
+
+    switch (conversion.Argument)
+    {
+      case PRINTF_ARGUMENT_SIGNED:
+      {
+        int64 value;
+        if (!payload.ReadVarInt(&value))
+          return false;
+        conversionFormat.AppendFormattedString("ll%c", conversion.Conversion);
+        text.AppendFormattedString(conversionFormat.GetCharArray(), (long long)value);
+      }
+      break;
+
+      case PRINTF_ARGUMENT_UNSIGNED:
+      {
+        uint64 value;
+        if (!payload.ReadVarUInt(&value))
+          return false;
+        conversionFormat.AppendFormattedString("ll%c", conversion.Conversion);
+        text.AppendFormattedString(conversionFormat.GetCharArray(), (unsigned long long)value);
+      }
+      break;
+
+      case PRINTF_ARGUMENT_CHARACTER:
+      {
+        int64 value;
+        if (!payload.ReadVarInt(&value))
+          return false;
+        conversionFormat.AppendCharacter('c');
+        text.AppendFormattedString(conversionFormat.GetCharArray(), (int)value);
+      }
+      break;
+
+      case PRINTF_ARGUMENT_DOUBLE:
+      {
+        double value;
+        if (!payload.ReadDouble(&value))
+          return false;
+        conversionFormat.AppendCharacter(conversion.Conversion);
+        text.AppendFormattedString(conversionFormat.GetCharArray(), value);
+      }
+      break;
+
+      case PRINTF_ARGUMENT_STRING:
+      {
+        const char* pString;
+        uint32 length;
+        if (!payload.ReadString(&pString, &length))
+          return false;
+        String value;
+        value.AppendString(pString, length);
+        conversionFormat.AppendCharacter('s');
+        text.AppendFormattedString(conversionFormat.GetCharArray(), value.GetCharArray());
+      }
+      break;
+
+      case PRINTF_ARGUMENT_POINTER:
+      {
+        uint64 value;
+        if (!payload.ReadVarUInt(&value))
+          return false;
+        conversionFormat.AppendCharacter('p');
+        text.AppendFormattedString(conversionFormat.GetCharArray(), (void*)(uintptr_t)value);
+      }
+      break;
+    }
+
+    p = conversion.pEnd - 1;
+    pLiteral = conversion.pEnd;
+  }
+
+  text.AppendString(pLiteral);
+  return payload.IsAtEnd();
+}
+
+bool BinaryLogReader::RenderFormat(const String& format, String& text)
+{
+  PayloadReader payload(m_payload.GetBasePointer(), m_payload.GetSize());
+  uint64 argumentCount;
+  if (!payload.ReadVarUInt(&argumentCount) || argumentCount > m_payload.GetSize())
+    return false;
+
+  // strings point into the payload, which stays put until the next message is read
+  m_arguments.Resize((uint32)argumentCount);
+  for (uint32 i = 0; i < (uint32)argumentCount; i++)
+  {
+    uint64 type;
+    if (!payload.ReadVarUInt(&type))
+      return false;
+
+    TypedFormat::Argument& argument = m_arguments[i];
+    argument.Type = (TypedFormat::ARGUMENT_TYPE)type;
+    switch (argument.Type)
+    {
+      case TypedFormat::ARGUMENT_TYPE_CHARACTER:
+      case TypedFormat::ARGUMENT_TYPE_SIGNED:
+        if (!payload.ReadVarInt(&argument.Signed))
+          return false;
+        break;
+
+      case TypedFormat::ARGUMENT_TYPE_BOOL:
+      case TypedFormat::ARGUMENT_TYPE_UNSIGNED:
+        if (!payload.ReadVarUInt(&argument.Unsigned))
+          return false;
+        break;
+
+      case TypedFormat::ARGUMENT_TYPE_FLOAT:
+      case TypedFormat::ARGUMENT_TYPE_DOUBLE:
+        if (!payload.ReadDouble(&argument.Double))
+          return false;
+        break;
+
+      case TypedFormat::ARGUMENT_TYPE_STRING:
+        if (!payload.ReadString(&argument.Text.pData, &argument.Text.Length))
+          return false;
+        break;
+
+      case TypedFormat::ARGUMENT_TYPE_POINTER:
+      {
+        uint64 value;
+        if (!payload.ReadVarUInt(&value))
+          return false;
+        argument.Pointer = (const void*)(uintptr_t)value;
+      }
+      break;
+
+      default:
+        return false;
+    }
+  }
+
+  TypedFormat::AppendFormatted(text, format, m_arguments.GetBasePointer(), (uint32)argumentCount);
+  return payload.IsAtEnd();
+}
+
+bool BinaryLogReader::DecodeToText(ByteStream* pInput, ByteStream* pOutput)
+{
+  BinaryLogReader reader(pInput);
+  Message message;
+  String line;
+  bool written = true;
+  while (written && reader.ReadMessage(&message))
+  {
+    line.Clear();
+    Log::FormatLogMessageForDisplay(
+      message.ChannelName, message.FunctionName, message.Level, message.Time, message.Text,
+      [](const char* text, void* pLine) { static_cast<String*>(pLine)->AppendString(text); }, &line);
+    line.AppendCharacter('\n');
+    written = pOutput->Write2(line.GetCharArray(), line.GetLength());
+  }
+
+  return (written && !reader.IsDamaged());
+}
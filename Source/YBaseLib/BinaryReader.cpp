@@ -1,15 +1,87 @@
 #include "YBaseLib/BinaryReader.h"
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Memory.h"
+#include <cstring>
+#include <type_traits>
+
+// how much a buffered reader reads ahead of streams without views
+static const uint32 READ_BUFFER_SIZE = 4096;
 
 BinaryReader::BinaryReader(ByteStream* pStream, ENDIAN_TYPE streamByteOrder /* = Y_HOST_ENDIAN_TYPE */,
-                           bool ignoreErrors /* = false */)
-  : m_pStream(pStream), m_eStreamByteOrder(streamByteOrder), m_ignoreErrors(ignoreErrors), m_errorState(false)
+                           bool ignoreErrors /* = false */, bool buffered /* = false */)
+  : m_pStream(pStream), m_eStreamByteOrder(streamByteOrder), m_ignoreErrors(ignoreErrors), m_errorState(false),
+    m_pBufferStart(nullptr), m_pBufferPosition(nullptr), m_pBufferEnd(nullptr), m_pReadBuffer(nullptr),
+    m_buffered(buffered), m_bitBuffer(0), m_bitCount(0)
+{
+}
+
+BinaryReader::~BinaryReader()
+{
+  SyncStream();
+  if (m_pReadBuffer != nullptr)
+    Y_free(m_pReadBuffer);
+}
+
+void BinaryReader::SyncStream()
 {
+  if (m_pBufferStart == m_pBufferEnd)
+    return;
+
+  // views are given back with what was used, buffered bytes that weren't used are seeked back over
+  if (m_pReadBuffer == nullptr)
+    m_pStream->ReleaseReadView((uint32)(m_pBufferPosition - m_pBufferStart));
+  else if (m_pBufferPosition != m_pBufferEnd)
+    m_pStream->SeekRelative(-(int64)(m_pBufferEnd - m_pBufferPosition));
+
+  m_pBufferStart = m_pBufferPosition = m_pBufferEnd = m_pReadBuffer;
+}
+
+bool BinaryReader::FillBuffer(uint32 minimumSize)
+{
+  if (m_pReadBuffer == nullptr)
+  {
+    // the view is everything that's left, so there's nothing to keep from the last one
+    if (m_pStream->GetViewFlags() & BYTESTREAM_VIEW_READ)
+    {
+      SyncStream();
+
+      const void* pView;
+      uint32 viewSize = m_pStream->AcquireReadView(0xFFFFFFFF, &pView);
+      m_pBufferStart = m_pBufferPosition = reinterpret_cast<const byte*>(pView);
+      m_pBufferEnd = m_pBufferStart + viewSize;
+      return (viewSize >= minimumSize);
+    }
+
+    m_pReadBuffer = static_cast<byte*>(Y_malloc(READ_BUFFER_SIZE));
+    m_pBufferStart = m_pBufferPosition = m_pBufferEnd = m_pReadBuffer;
+  }
+
+  if (minimumSize > READ_BUFFER_SIZE)
+    return false;
+
+  // keep what's left, and top it up
+  uint32 remaining = (uint32)(m_pBufferEnd - m_pBufferPosition);
+  if (remaining > 0 && m_pBufferPosition != m_pReadBuffer)
+    std::memmove(m_pReadBuffer, m_pBufferPosition, remaining);
+
+  uint32 bytesRead = m_pStream->Read(m_pReadBuffer + remaining, READ_BUFFER_SIZE - remaining);
+  m_pBufferStart = m_pBufferPosition = m_pReadBuffer;
+  m_pBufferEnd = m_pReadBuffer + remaining + bytesRead;
+  return ((remaining + bytesRead) >= minimumSize);
+}
+
+uint64 BinaryReader::GetStreamPosition()
+{
+  uint64 streamPosition = m_pStream->GetPosition();
+  if (m_pReadBuffer == nullptr)
+    return streamPosition + (uint64)(m_pBufferPosition - m_pBufferStart);
+  else
+    return streamPosition - (uint64)(m_pBufferEnd - m_pBufferPosition);
 }
 
 void BinaryReader::SeekAbsolute(uint64 position)
 {
+  SyncStream();
   if (m_errorState || !m_pStream->SeekAbsolute(position))
   {
     m_errorState = true;
@@ -21,6 +93,7 @@ void BinaryReader::SeekAbsolute(uint64 position)
 
 void BinaryReader::SeekRelative(int64 offset)
 {
+  SyncStream();
   if (m_errorState || !m_pStream->SeekRelative(offset))
   {
     m_errorState = true;
@@ -32,6 +105,7 @@ void BinaryReader::SeekRelative(int64 offset)
 
 void BinaryReader::SeekToEnd()
 {
+  SyncStream();
   if (m_errorState || !m_pStream->SeekToEnd())
   {
     m_errorState = true;
@@ -43,6 +117,7 @@ void BinaryReader::SeekToEnd()
 
 bool BinaryReader::SafeSeekAbsolute(uint64 position)
 {
+  SyncStream();
   if (m_errorState)
     return false;
 
@@ -51,6 +126,7 @@ bool BinaryReader::SafeSeekAbsolute(uint64 position)
 
 bool BinaryReader::SafeSeekRelative(int64 offset)
 {
+  SyncStream();
   if (m_errorState)
     return false;
 
@@ -59,17 +135,42 @@ bool BinaryReader::SafeSeekRelative(int64 offset)
 
 bool BinaryReader::SafeSeekToEnd()
 {
+  SyncStream();
   if (m_errorState)
     return false;
 
   return m_pStream->SeekToEnd();
 }
 
-void BinaryReader::InternalReadBytes(void* pDestination, uint32 cbDestination)
+void BinaryReader::InternalReadBytesUnbuffered(void* pDestination, uint32 cbDestination)
 {
   if (!cbDestination)
     return;
 
+  if (m_buffered && !m_errorState)
+  {
+    if (FillBuffer(cbDestination))
+    {
+      std::memcpy(pDestination, m_pBufferPosition, cbDestination);
+      m_pBufferPosition += cbDestination;
+      return;
+    }
+
+    // too big to buffer, or past the end, whatever was buffered goes first and the stream fills in the rest
+    if (m_pReadBuffer != nullptr)
+    {
+      uint32 bufferedCount = (uint32)(m_pBufferEnd - m_pBufferPosition);
+      std::memcpy(pDestination, m_pBufferPosition, bufferedCount);
+      m_pBufferStart = m_pBufferPosition = m_pBufferEnd = m_pReadBuffer;
+      pDestination = reinterpret_cast<byte*>(pDestination) + bufferedCount;
+      cbDestination -= bufferedCount;
+    }
+    else
+    {
+      SyncStream();
+    }
+  }
+
   if (m_errorState)
   {
     if (!m_ignoreErrors)
@@ -95,7 +196,7 @@ void BinaryReader::InternalReadBytes(void* pDestination, uint32 cbDestination)
   }
 }
 
-bool BinaryReader::SafeInternalReadBytes(void* pDestination, uint32 cbDestination)
+bool BinaryReader::SafeInternalReadBytesUnbuffered(void* pDestination, uint32 cbDestination)
 {
   if (!cbDestination)
     return true;
@@ -103,6 +204,29 @@ bool BinaryReader::SafeInternalReadBytes(void* pDestination, uint32 cbDestinatio
   if (m_errorState)
     return false;
 
+  if (m_buffered)
+  {
+    if (FillBuffer(cbDestination))
+    {
+      std::memcpy(pDestination, m_pBufferPosition, cbDestination);
+      m_pBufferPosition += cbDestination;
+      return true;
+    }
+
+    if (m_pReadBuffer != nullptr)
+    {
+      uint32 bufferedCount = (uint32)(m_pBufferEnd - m_pBufferPosition);
+      std::memcpy(pDestination, m_pBufferPosition, bufferedCount);
+      m_pBufferStart = m_pBufferPosition = m_pBufferEnd = m_pReadBuffer;
+      pDestination = reinterpret_cast<byte*>(pDestination) + bufferedCount;
+      cbDestination -= bufferedCount;
+    }
+    else
+    {
+      SyncStream();
+    }
+  }
+
   uint32 bytesRead;
   if (cbDestination == 1)
     bytesRead = m_pStream->ReadByte((byte*)pDestination) ? 1 : 0;
@@ -116,6 +240,37 @@ bool BinaryReader::SafeInternalReadBytes(void* pDestination, uint32 cbDestinatio
   return false;
 }
 
+void BinaryReader::InternalReadSwappedArray(void* pValues, uint32 count, uint32 elementSize)
+{
+  uint32 byteCount = count * elementSize;
+  if (byteCount > 0 && byteCount <= (uint32)(m_pBufferEnd - m_pBufferPosition))
+  {
+    Y_byteswap_array_copy(pValues, m_pBufferPosition, count, elementSize);
+    m_pBufferPosition += byteCount;
+    return;
+  }
+
+  InternalReadBytesUnbuffered(pValues, byteCount);
+  Y_byteswap_array(pValues, count, elementSize);
+}
+
+bool BinaryReader::SafeInternalReadSwappedArray(void* pValues, uint32 count, uint32 elementSize)
+{
+  uint32 byteCount = count * elementSize;
+  if (byteCount > 0 && byteCount <= (uint32)(m_pBufferEnd - m_pBufferPosition))
+  {
+    Y_byteswap_array_copy(pValues, m_pBufferPosition, count, elementSize);
+    m_pBufferPosition += byteCount;
+    return true;
+  }
+
+  if (!SafeInternalReadBytesUnbuffered(pValues, byteCount))
+    return false;
+
+  Y_byteswap_array(pValues, count, elementSize);
+  return true;
+}
+
 bool BinaryReader::ReadBool()
 {
   byte ret;
@@ -164,6 +319,46 @@ bool BinaryReader::SafeReadUInt8(uint8* pValue)
   return SafeInternalReadBytes(reinterpret_cast<void*>(pValue), 1);
 }
 
+bool BinaryReader::ReadCStringInPlace(String& dest)
+{
+  if (m_errorState)
+    return false;
+
+  // buffered readers look in what's been read ahead, strings that run past it are read a byte at a time
+  if (m_buffered)
+  {
+    if (m_pBufferPosition == m_pBufferEnd && !FillBuffer(1))
+      return false;
+
+    const byte* pEnd = static_cast<const byte*>(
+      std::memchr(m_pBufferPosition, 0, (size_t)(m_pBufferEnd - m_pBufferPosition)));
+    if (pEnd == nullptr)
+      return false;
+
+    dest.AppendString(reinterpret_cast<const char*>(m_pBufferPosition), (uint32)(pEnd - m_pBufferPosition));
+    m_pBufferPosition = pEnd + 1;
+    return true;
+  }
+
+  if ((m_pStream->GetViewFlags() & BYTESTREAM_VIEW_READ) == 0)
+    return false;
+
+  // a missing terminator is left to the byte-at-a-time path, which fails the same way on any stream
+  const void* pView;
+  uint32 viewSize = m_pStream->AcquireReadView(0xFFFFFFFF, &pView);
+  const char* pStart = reinterpret_cast<const char*>(pView);
+  const char* pEnd = (viewSize > 0) ? reinterpret_cast<const char*>(std::memchr(pStart, 0, viewSize)) : nullptr;
+  if (pEnd == nullptr)
+  {
+    m_pStream->ReleaseReadView(0);
+    return false;
+  }
+
+  dest.AppendString(pStart, (uint32)(pEnd - pStart));
+  m_pStream->ReleaseReadView((uint32)(pEnd - pStart) + 1);
+  return true;
+}
+
 // string functions
 String BinaryReader::ReadCString()
 {
@@ -176,6 +371,8 @@ String BinaryReader::ReadCString()
 bool BinaryReader::SafeReadCString(String* pValue)
 {
   pValue->Clear();
+  if (ReadCStringInPlace(*pValue))
+    return true;
 
   char ch;
   for (;;)
@@ -223,6 +420,8 @@ uint32 BinaryReader::ReadCString(char* dest, uint32 maxSize)
 void BinaryReader::ReadCString(String& dest)
 {
   dest.Clear();
+  if (ReadCStringInPlace(dest))
+    return;
 
   char c;
   for (;;)
@@ -341,181 +540,302 @@ bool BinaryReader::SafeReadSizePrefixedString(String* pValue)
   return true;
 }
 
-// endian-specific
-int16 BinaryReader::ReadInt16()
+void BinaryReader::ReadBytes(void* dst, uint32 dstSize)
 {
-  int16 ret;
-  InternalReadBytes(&ret, 2);
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint16((uint16*)&ret);
+  InternalReadBytes(dst, dstSize);
+}
 
-  return ret;
+bool BinaryReader::SafeReadBytes(void* dst, uint32 dstSize)
+{
+  return SafeInternalReadBytes(dst, dstSize);
 }
 
-bool BinaryReader::SafeReadInt16(int16* pValue)
+const void* BinaryReader::ReadBytesInPlace(uint32 byteCount)
 {
-  if (!SafeInternalReadBytes(pValue, sizeof(int16)))
-    return false;
+  if (m_errorState || (m_pStream->GetViewFlags() & BYTESTREAM_VIEW_READ) == 0)
+    return nullptr;
 
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint16(reinterpret_cast<uint16*>(pValue));
+  // buffered readers hand out their view, streams with views are never read into the buffer
+  if (m_buffered)
+  {
+    if (byteCount > (uint32)(m_pBufferEnd - m_pBufferPosition) && !FillBuffer(byteCount))
+    {
+      SyncStream();
+      m_errorState = true;
+      return nullptr;
+    }
+
+    const byte* pBytes = m_pBufferPosition;
+    m_pBufferPosition += byteCount;
+    return pBytes;
+  }
 
-  return true;
+  const void* pView;
+  if (m_pStream->AcquireReadView(byteCount, &pView) != byteCount)
+  {
+    m_pStream->ReleaseReadView(0);
+    m_errorState = true;
+    return nullptr;
+  }
+
+  m_pStream->ReleaseReadView(byteCount);
+  return pView;
 }
 
-uint16 BinaryReader::ReadUInt16()
+bool BinaryReader::InternalReadVarUIntFailed(uint64* pValue, bool safe)
 {
-  uint16 ret;
-  InternalReadBytes(&ret, 2);
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint16(&ret);
+  m_errorState = true;
+  if (!safe && !m_ignoreErrors)
+    Panic("BinaryReader::ReadVarUInt() failed");
 
-  return ret;
+  *pValue = 0;
+  return false;
 }
 
-bool BinaryReader::SafeReadUInt16(uint16* pValue)
+bool BinaryReader::InternalReadVarUIntSlow(uint64* pValue, bool safe)
 {
-  if (!SafeInternalReadBytes(pValue, sizeof(uint16)))
-    return false;
+  if (m_errorState)
+    return InternalReadVarUIntFailed(pValue, safe);
 
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint16(reinterpret_cast<uint16*>(pValue));
+  // less can be left near the end of the stream, which only matters if the value runs into it
+  if (m_buffered && (uint32)(m_pBufferEnd - m_pBufferPosition) < MaxVarIntSize)
+    FillBuffer(MaxVarIntSize);
 
-  return true;
-}
+  if (m_pBufferPosition != m_pBufferEnd)
+  {
+    uint32 length = DecodeVarUInt(m_pBufferPosition, (uint32)(m_pBufferEnd - m_pBufferPosition), pValue);
+    if (length == 0)
+      return InternalReadVarUIntFailed(pValue, safe);
 
-int32 BinaryReader::ReadInt32()
-{
-  int32 ret;
-  InternalReadBytes(&ret, 4);
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint32((uint32*)&ret);
+    m_pBufferPosition += length;
+    return true;
+  }
 
-  return ret;
+  // unbuffered readers can't read ahead of the value
+  uint64 value = 0;
+  for (uint32 i = 0; i < MaxVarIntSize; i++)
+  {
+    byte b;
+    if (!SafeInternalReadBytes(&b, 1) || (i == MaxVarIntSize - 1 && b > 1))
+      return InternalReadVarUIntFailed(pValue, safe);
+
+    value |= (uint64)(b & 0x7F) << (i * 7);
+    if (b < 0x80)
+    {
+      *pValue = value;
+      return true;
+    }
+  }
+
+  return InternalReadVarUIntFailed(pValue, safe);
 }
 
-bool BinaryReader::SafeReadInt32(int32* pValue)
+uint32 BinaryReader::ReadVarUInt32()
 {
-  if (!SafeInternalReadBytes(pValue, sizeof(int32)))
-    return false;
+  uint64 value;
+  if (InternalReadVarUInt(&value, false) && value > 0xFFFFFFFF)
+    InternalReadVarUIntFailed(&value, false);
 
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint32(reinterpret_cast<uint32*>(pValue));
-
-  return true;
+  return (uint32)value;
 }
 
-uint32 BinaryReader::ReadUInt32()
+uint64 BinaryReader::ReadVarUInt64()
 {
-  uint32 ret;
-  InternalReadBytes(&ret, 4);
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint32(&ret);
-
-  return ret;
+  uint64 value;
+  InternalReadVarUInt(&value, false);
+  return value;
 }
 
-bool BinaryReader::SafeReadUInt32(uint32* pValue)
+bool BinaryReader::SafeReadVarUInt32(uint32* pValue)
 {
-  if (!SafeInternalReadBytes(pValue, sizeof(uint32)))
+  uint64 value;
+  if (!InternalReadVarUInt(&value, true) || (value > 0xFFFFFFFF && !InternalReadVarUIntFailed(&value, true)))
     return false;
 
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint32(reinterpret_cast<uint32*>(pValue));
-
+  *pValue = (uint32)value;
   return true;
 }
 
-int64 BinaryReader::ReadInt64()
+bool BinaryReader::SafeReadVarUInt64(uint64* pValue)
 {
-  int64 ret;
-  InternalReadBytes(&ret, 8);
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint64((uint64*)&ret);
-
-  return ret;
+  return InternalReadVarUInt(pValue, true);
 }
 
-bool BinaryReader::SafeReadInt64(int64* pValue)
+bool BinaryReader::SafeReadVarInt32(int32* pValue)
 {
-  if (!SafeInternalReadBytes(pValue, sizeof(int64)))
+  uint32 value;
+  if (!SafeReadVarUInt32(&value))
     return false;
 
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint64(reinterpret_cast<uint64*>(pValue));
-
+  *pValue = ZigZagDecode(value);
   return true;
 }
 
-uint64 BinaryReader::ReadUInt64()
+bool BinaryReader::SafeReadVarInt64(int64* pValue)
 {
-  uint64 ret;
-  InternalReadBytes(&ret, 8);
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint64(&ret);
+  uint64 value;
+  if (!InternalReadVarUInt(&value, true))
+    return false;
 
-  return ret;
+  *pValue = ZigZagDecode(value);
+  return true;
 }
 
-bool BinaryReader::SafeReadUInt64(uint64* pValue)
+template<typename T>
+bool BinaryReader::InternalReadVarIntArray(T* pValues, uint32 count, bool safe)
 {
-  if (!SafeInternalReadBytes(pValue, sizeof(uint64)))
-    return false;
+  typedef typename std::make_unsigned<T>::type UnsignedType;
+  const uint64 maxValue = (UnsignedType)-1;
+  uint32 index = 0;
+  while (index < count)
+  {
+    if (m_buffered && !m_errorState && (uint32)(m_pBufferEnd - m_pBufferPosition) < MaxVarIntSize)
+      FillBuffer(MaxVarIntSize);
+
+    // in blocks while whole values are sure to be buffered
+    const byte* pPosition = m_pBufferPosition;
+    const byte* pEnd = m_pBufferEnd;
+    while (index < count && (uint32)(pEnd - pPosition) >= MaxVarIntSize)
+    {
+      // eight single byte values at once
+      uint64 word;
+      std::memcpy(&word, pPosition, sizeof(word));
+      if ((count - index) >= 8 && (word & UINT64_C(0x8080808080808080)) == 0)
+      {
+        for (uint32 i = 0; i < 8; i++)
+        {
+          UnsignedType value = (UnsignedType)pPosition[i];
+          pValues[index + i] = std::is_signed<T>::value ? (T)ZigZagDecode(value) : (T)value;
+        }
+
+        pPosition += 8;
+        index += 8;
+        continue;
+      }
+
+      uint64 value;
+      uint32 length = DecodeVarUInt(pPosition, MaxVarIntSize, &value);
+      if (length == 0 || value > maxValue)
+      {
+        m_pBufferPosition = pPosition;
+        Y_memzero(pValues + index, sizeof(T) * (count - index));
+        return InternalReadVarUIntFailed(&value, safe);
+      }
+
+      pPosition += length;
+      pValues[index++] = std::is_signed<T>::value ? (T)ZigZagDecode((UnsignedType)value) : (T)value;
+    }
+
+    m_pBufferPosition = pPosition;
+    if (index == count)
+      break;
 
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint64(reinterpret_cast<uint64*>(pValue));
+    // near the end of what's buffered, or unbuffered
+    uint64 value;
+    if (!InternalReadVarUInt(&value, safe) || (value > maxValue && !InternalReadVarUIntFailed(&value, safe)))
+    {
+      Y_memzero(pValues + index, sizeof(T) * (count - index));
+      return false;
+    }
+
+    pValues[index++] = std::is_signed<T>::value ? (T)ZigZagDecode((UnsignedType)value) : (T)value;
+  }
 
   return true;
 }
 
-float BinaryReader::ReadFloat()
+void BinaryReader::ReadVarUInt32Array(uint32* pValues, uint32 count)
 {
-  float ret;
-  InternalReadBytes(&ret, 4);
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint32((uint32*)&ret);
+  InternalReadVarIntArray(pValues, count, false);
+}
 
-  return ret;
+void BinaryReader::ReadVarUInt64Array(uint64* pValues, uint32 count)
+{
+  InternalReadVarIntArray(pValues, count, false);
 }
 
-bool BinaryReader::SafeReadFloat(float* pValue)
+void BinaryReader::ReadVarInt32Array(int32* pValues, uint32 count)
 {
-  if (!SafeInternalReadBytes(pValue, sizeof(float)))
-    return false;
+  InternalReadVarIntArray(pValues, count, false);
+}
 
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint32(reinterpret_cast<uint32*>(pValue));
+void BinaryReader::ReadVarInt64Array(int64* pValues, uint32 count)
+{
+  InternalReadVarIntArray(pValues, count, false);
+}
 
-  return true;
+bool BinaryReader::SafeReadVarUInt32Array(uint32* pValues, uint32 count)
+{
+  return InternalReadVarIntArray(pValues, count, true);
+}
+
+bool BinaryReader::SafeReadVarUInt64Array(uint64* pValues, uint32 count)
+{
+  return InternalReadVarIntArray(pValues, count, true);
 }
 
-double BinaryReader::ReadDouble()
+bool BinaryReader::SafeReadVarInt32Array(int32* pValues, uint32 count)
 {
-  double ret;
-  InternalReadBytes(&ret, 8);
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint64((uint64*)&ret);
+  return InternalReadVarIntArray(pValues, count, true);
+}
 
-  return ret;
+bool BinaryReader::SafeReadVarInt64Array(int64* pValues, uint32 count)
+{
+  return InternalReadVarIntArray(pValues, count, true);
 }
 
-bool BinaryReader::SafeReadDouble(double* pValue)
+bool BinaryReader::InternalReadBits(uint32 bitCount, uint64* pValue, bool safe)
 {
-  if (!SafeInternalReadBytes(pValue, sizeof(double)))
-    return false;
+  DebugAssert(bitCount <= 64);
+
+  // at most seven bits are left over, so up to 32 more always fit
+  if (bitCount > 32)
+  {
+    uint64 low, high;
+    if (!InternalReadBits(32, &low, safe) || !InternalReadBits(bitCount - 32, &high, safe))
+    {
+      *pValue = 0;
+      return false;
+    }
 
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint64(reinterpret_cast<uint64*>(pValue));
+    *pValue = low | (high << 32);
+    return true;
+  }
+
+  while (m_bitCount < bitCount)
+  {
+    byte b;
+    if (safe)
+    {
+      if (!SafeInternalReadBytes(&b, 1))
+      {
+        *pValue = 0;
+        return false;
+      }
+    }
+    else
+    {
+      InternalReadBytes(&b, 1);
+    }
+
+    m_bitBuffer |= (uint64)b << m_bitCount;
+    m_bitCount += 8;
+  }
 
+  *pValue = m_bitBuffer & ((UINT64_C(1) << bitCount) - 1);
+  m_bitBuffer >>= bitCount;
+  m_bitCount -= bitCount;
   return true;
 }
 
-void BinaryReader::ReadBytes(void* dst, uint32 dstSize)
+uint64 BinaryReader::ReadBits(uint32 bitCount)
 {
-  InternalReadBytes(dst, dstSize);
+  uint64 value;
+  InternalReadBits(bitCount, &value, false);
+  return value;
 }
 
-bool BinaryReader::SafeReadBytes(void* dst, uint32 dstSize)
+bool BinaryReader::SafeReadBits(uint32 bitCount, uint64* pValue)
 {
-  return SafeInternalReadBytes(dst, dstSize);
+  return InternalReadBits(bitCount, pValue, true);
 }
@@ -0,0 +1,276 @@
+#include "YBaseLib/BinarySchema.h"
+#include "YBaseLib/Log.h"
+Log_SetChannel(BinarySchema);
+
+using namespace BinarySchemaFormat;
+
+static const uint32 MinBufferSize = 256;
+
+BinarySchema::BinarySchema(const char* typeName, DefineFunction defineFunction, const void* pDefaultObject)
+  : m_typeName(typeName), m_pDefaultObject(pDefaultObject), m_fixedSize(sizeof(Header)), m_version(0)
+{
+  defineFunction(this);
+  Finalize();
+}
+
+BinarySchema::~BinarySchema() {}
+
+void BinarySchema::AddField(const Field& field)
+{
+  DebugAssertMsg(m_fields.IsEmpty() || m_fields.LastElement().SinceVersion <= field.SinceVersion,
+                 "fields are added in the order of their versions");
+  DebugAssertMsg(FindField(field.MemberOffset) == nullptr, "members are added once");
+  m_fields.Add(field);
+}
+
+void BinarySchema::Finalize()
+{
+  // each field on its own alignment, in the order they were added
+  uint32 offset = sizeof(Header);
+  for (uint32 i = 0; i < m_fields.GetSize(); i++)
+  {
+    Field& field = m_fields[i];
+    offset = ALIGNED_SIZE(offset, field.Alignment);
+    field.FixedOffset = offset;
+    offset += field.Size;
+    m_version = Max(m_version, field.SinceVersion);
+
+    if (field.Kind != FieldKind_Plain)
+      continue;
+
+    // A field joins the run before it if it follows straight on in both places. Padding between them could hold a
+    // member the schema doesn't have, which decoding the run would overwrite.
+    if (!m_runs.IsEmpty())
+    {
+      Run& run = m_runs.LastElement();
+      if (run.FirstField + run.FieldCount == i && run.SinceVersion == field.SinceVersion &&
+          run.MemberOffset + run.Size == field.MemberOffset && run.FixedOffset + run.Size == field.FixedOffset)
+      {
+        run.Size += field.Size;
+        run.FieldCount++;
+        continue;
+      }
+    }
+
+    Run run = {field.MemberOffset, field.FixedOffset, field.Size, field.SinceVersion, i, 1};
+    m_runs.Add(run);
+  }
+
+  m_fixedSize = offset;
+}
+
+const BinarySchema::Field* BinarySchema::FindField(uint32 memberOffset) const
+{
+  for (const Field& field : m_fields)
+  {
+    if (field.MemberOffset == memberOffset)
+      return &field;
+  }
+
+  return nullptr;
+}
+
+uint32 BinarySchema::EncodeObject(const void* pObject, PODArray<byte>* pBuffer, uint32 version) const
+{
+  // the fixed part ends after the last field the version has
+  uint32 fixedSize = m_fixedSize;
+  if (version < m_version)
+  {
+    fixedSize = sizeof(Header);
+    for (uint32 i = 0; i < m_fields.GetSize() && m_fields[i].SinceVersion <= version; i++)
+      fixedSize = m_fields[i].FixedOffset + m_fields[i].Size;
+  }
+
+  const byte* pSource = static_cast<const byte*>(pObject);
+  uint32 start = AppendData(pBuffer, nullptr, fixedSize);
+  for (const Run& run : m_runs)
+  {
+    if (run.SinceVersion <= version)
+      std::memcpy(pBuffer->GetBasePointer() + start + run.FixedOffset, pSource + run.MemberOffset, run.Size);
+  }
+
+  for (const Field& field : m_fields)
+  {
+    if (field.EncodeFunction != nullptr && field.SinceVersion <= version)
+      field.EncodeFunction(pSource + field.MemberOffset, pBuffer, start, start + field.FixedOffset);
+  }
+
+  // padded, so whatever's written after starts aligned too
+  AppendData(pBuffer, nullptr, 0);
+
+  Header header;
+  header.TotalSize = pBuffer->GetSize() - start;
+  header.FixedSize = fixedSize;
+  header.Version = Min(version, m_version);
+  header.Reserved = 0;
+  std::memcpy(pBuffer->GetBasePointer() + start, &header, sizeof(header));
+  return start;
+}
+
+bool BinarySchema::DecodeObject(void* pObject, const void* pData, size_t size) const
+{
+  Header header;
+  if (!ReadHeader(pData, size, &header))
+    return false;
+
+  byte* pDestination = static_cast<byte*>(pObject);
+  const byte* pSource = static_cast<const byte*>(pData);
+  for (const Run& run : m_runs)
+  {
+    if (run.FixedOffset + run.Size <= header.FixedSize)
+    {
+      std::memcpy(pDestination + run.MemberOffset, pSource + run.FixedOffset, run.Size);
+      continue;
+    }
+
+    // the fixed part ends partway through the run
+    for (uint32 i = run.FirstField; i < run.FirstField + run.FieldCount; i++)
+    {
+      const Field& field = m_fields[i];
+      if (field.FixedOffset + field.Size <= header.FixedSize)
+        std::memcpy(pDestination + field.MemberOffset, pSource + field.FixedOffset, field.Size);
+    }
+  }
+
+  for (const Field& field : m_fields)
+  {
+    if (field.DecodeFunction == nullptr || field.FixedOffset + field.Size > header.FixedSize)
+      continue;
+
+    Slot slot;
+    std::memcpy(&slot, pSource + field.FixedOffset, sizeof(slot));
+    if (!field.DecodeFunction(pDestination + field.MemberOffset, pSource, header.TotalSize, slot))
+      return false;
+  }
+
+  return true;
+}
+
+bool BinarySchema::ReadEncoding(BinaryReader* pReader, PODArray<byte>* pBuffer, const void** ppData, uint32* pSize)
+{
+  // in place when the header and the rest come from the same view, one after the other
+  const byte* pHeaderData = static_cast<const byte*>(pReader->ReadBytesInPlace(sizeof(Header)));
+  Header header;
+  if (pHeaderData != nullptr)
+    std::memcpy(&header, pHeaderData, sizeof(header));
+  else if (!pReader->SafeReadBytes(&header, sizeof(header)))
+    header.TotalSize = 0;
+
+  if (header.TotalSize < sizeof(header))
+  {
+    Log_ErrorPrint("BinarySchema::ReadEncoding: failed to read the header");
+    return false;
+  }
+
+  if (pHeaderData != nullptr)
+  {
+    const byte* pRest = static_cast<const byte*>(pReader->ReadBytesInPlace(header.TotalSize - sizeof(header)));
+    if (pRest == pHeaderData + sizeof(header))
+    {
+      *ppData = pHeaderData;
+      *pSize = header.TotalSize;
+      return true;
+    }
+    else if (pRest != nullptr)
+    {
+      pBuffer->Resize(header.TotalSize);
+      std::memcpy(pBuffer->GetBasePointer(), &header, sizeof(header));
+      std::memcpy(pBuffer->GetBasePointer() + sizeof(header), pRest, header.TotalSize - sizeof(header));
+      *ppData = pBuffer->GetBasePointer();
+      *pSize = header.TotalSize;
+      return true;
+    }
+
+    Log_ErrorPrint("BinarySchema::ReadEncoding: failed to read the object");
+    return false;
+  }
+
+  pBuffer->Resize(header.TotalSize);
+  std::memcpy(pBuffer->GetBasePointer(), &header, sizeof(header));
+  if (!pReader->SafeReadBytes(pBuffer->GetBasePointer() + sizeof(header), header.TotalSize - sizeof(header)))
+  {
+    Log_ErrorPrint("BinarySchema::ReadEncoding: failed to read the object");
+    return false;
+  }
+
+  *ppData = pBuffer->GetBasePointer();
+  *pSize = header.TotalSize;
+  return true;
+}
+
+bool BinarySchema::ReadHeader(const void* pData, size_t size, Header* pHeader)
+{
+  if (size < sizeof(Header))
+    return false;
+
+  std::memcpy(pHeader, pData, sizeof(Header));
+  return (pHeader->TotalSize <= size && pHeader->FixedSize >= sizeof(Header) &&
+          pHeader->FixedSize <= pHeader->TotalSize);
+}
+
+uint32 BinarySchema::AppendData(PODArray<byte>* pBuffer, const void* pData, uint32 size)
+{
+  // grown by half again, as an object's appended a field at a time, and resizing zeroes the padding
+  uint32 offset = ALIGNED_SIZE(pBuffer->GetSize(), Alignment);
+  if (offset + size > pBuffer->GetReserve())
+    pBuffer->Reserve(Max(offset + size, Max(pBuffer->GetReserve() + pBuffer->GetReserve() / 2, MinBufferSize)));
+
+  pBuffer->Resize(offset + size);
+  if (pData != nullptr && size > 0)
+    std::memcpy(pBuffer->GetBasePointer() + offset, pData, size);
+
+  return offset;
+}
+
+void BinarySchema::SetSlot(PODArray<byte>* pBuffer, uint32 slotPosition, uint32 offset, uint32 count)
+{
+  Slot slot = {offset, count};
+  std::memcpy(pBuffer->GetBasePointer() + slotPosition, &slot, sizeof(slot));
+}
+
+const byte* BinarySchema::GetObjectData(const byte* pObject, uint32 objectSize, uint32 offset, uint64 size)
+{
+  if ((offset % Alignment) != 0 || offset < sizeof(Header) || offset > objectSize || size > objectSize - offset)
+    return nullptr;
+
+  return pObject + offset;
+}
+
+void BinarySchemaFieldTraits<String>::Encode(const void* pMember, PODArray<byte>* pBuffer, uint32 objectStart,
+                                             uint32 slotPosition)
+{
+  // with its terminating zero, so a view's can be passed on as a C string
+  const String* pString = static_cast<const String*>(pMember);
+  uint32 offset = BinarySchema::AppendData(pBuffer, pString->GetCharArray(), pString->GetLength() + 1);
+  BinarySchema::SetSlot(pBuffer, slotPosition, offset - objectStart, pString->GetLength());
+}
+
+static const char* GetStringData(const byte* pObject, uint32 objectSize, const Slot& slot)
+{
+  const byte* pData = BinarySchema::GetObjectData(pObject, objectSize, slot.Offset, (uint64)slot.Count + 1);
+  return (pData != nullptr && pData[slot.Count] == 0) ? reinterpret_cast<const char*>(pData) : nullptr;
+}
+
+bool BinarySchemaFieldTraits<String>::Decode(void* pMember, const byte* pObject, uint32 objectSize, const Slot& slot)
+{
+  const char* pData = GetStringData(pObject, objectSize, slot);
+  if (pData == nullptr)
+    return false;
+
+  static_cast<String*>(pMember)->Assign(StringView(pData, slot.Count));
+  return true;
+}
+
+StringView BinarySchemaFieldTraits<String>::View(const byte* pObject, uint32 objectSize, const byte* pFixedField,
+                                                 const String& defaultValue)
+{
+  if (pFixedField != nullptr)
+  {
+    Slot slot = BinarySchemaVariableFieldTraits::ReadSlot(pFixedField);
+    const char* pData = GetStringData(pObject, objectSize, slot);
+    if (pData != nullptr)
+      return StringView(pData, slot.Count);
+  }
+
+  return defaultValue;
+}
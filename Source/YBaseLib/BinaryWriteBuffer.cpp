@@ -19,5 +19,5 @@ const byte* BinaryWriteBuffer::GetBufferPointer() const
 
 const uint32 BinaryWriteBuffer::GetBufferSize() const
 {
-  return static_cast<GrowableMemoryByteStream*>(m_pStream)->GetMemorySize();
+  return (uint32)static_cast<GrowableMemoryByteStream*>(m_pStream)->GetMemorySize();
 }
@@ -1,15 +1,84 @@
 #include "YBaseLib/BinaryWriter.h"
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Memory.h"
+#include <type_traits>
+
+// how much a buffered writer collects before writing to streams without views, and asks views for
+static const uint32 WRITE_BUFFER_SIZE = 4096;
+static const uint32 WRITE_VIEW_SIZE = 65536;
 
 BinaryWriter::BinaryWriter(ByteStream* pStream, ENDIAN_TYPE streamByteOrder /* = Y_HOST_ENDIAN_TYPE */,
-                           bool ignoreErrors /* = false */)
-  : m_pStream(pStream), m_eStreamByteOrder(streamByteOrder), m_ignoreErrors(ignoreErrors), m_errorState(false)
+                           bool ignoreErrors /* = false */, bool buffered /* = false */)
+  : m_pStream(pStream), m_eStreamByteOrder(streamByteOrder), m_ignoreErrors(ignoreErrors), m_errorState(false),
+    m_pBufferStart(nullptr), m_pBufferPosition(nullptr), m_pBufferEnd(nullptr), m_pWriteBuffer(nullptr),
+    m_buffered(buffered), m_bitBuffer(0), m_bitCount(0)
+{
+}
+
+BinaryWriter::~BinaryWriter()
+{
+  InternalFlushBits(false);
+  SyncStream();
+  if (m_pWriteBuffer != nullptr)
+    Y_free(m_pWriteBuffer);
+}
+
+bool BinaryWriter::SyncStream()
+{
+  if (m_pBufferStart == m_pBufferEnd)
+    return true;
+
+  uint32 bufferedCount = (uint32)(m_pBufferPosition - m_pBufferStart);
+  bool result = true;
+  if (m_pWriteBuffer == nullptr)
+    m_pStream->ReleaseWriteView(bufferedCount);
+  else if (bufferedCount > 0)
+    result = (m_pStream->Write(m_pWriteBuffer, bufferedCount) == bufferedCount);
+
+  m_pBufferStart = m_pBufferPosition = m_pBufferEnd = m_pWriteBuffer;
+  if (!result && !m_ignoreErrors)
+    m_errorState = true;
+
+  return result;
+}
+
+bool BinaryWriter::ReserveBuffer(uint32 minimumSize)
 {
+  if (!SyncStream())
+    return false;
+
+  if (m_pWriteBuffer == nullptr)
+  {
+    if (m_pStream->GetViewFlags() & BYTESTREAM_VIEW_WRITE)
+    {
+      // fixed size streams can give less than was asked for, the caller falls back to writing directly
+      void* pView;
+      uint32 viewSize = m_pStream->AcquireWriteView(Max(minimumSize, WRITE_VIEW_SIZE), &pView);
+      if (viewSize < minimumSize)
+      {
+        m_pStream->ReleaseWriteView(0);
+        return false;
+      }
+
+      m_pBufferStart = m_pBufferPosition = static_cast<byte*>(pView);
+      m_pBufferEnd = m_pBufferStart + viewSize;
+      return true;
+    }
+
+    m_pWriteBuffer = static_cast<byte*>(Y_malloc(WRITE_BUFFER_SIZE));
+  }
+
+  if (minimumSize >= WRITE_BUFFER_SIZE)
+    return false;
+
+  m_pBufferStart = m_pBufferPosition = m_pWriteBuffer;
+  m_pBufferEnd = m_pWriteBuffer + WRITE_BUFFER_SIZE;
+  return true;
 }
 
 void BinaryWriter::SeekAbsolute(uint64 position)
 {
+  SyncStream();
   if (m_errorState || !m_pStream->SeekAbsolute(position))
   {
     m_errorState = true;
@@ -21,6 +90,7 @@ void BinaryWriter::SeekAbsolute(uint64 position)
 
 void BinaryWriter::SeekRelative(int64 offset)
 {
+  SyncStream();
   if (m_errorState || !m_pStream->SeekRelative(offset))
   {
     m_errorState = true;
@@ -32,6 +102,7 @@ void BinaryWriter::SeekRelative(int64 offset)
 
 void BinaryWriter::SeekToEnd()
 {
+  SyncStream();
   if (m_errorState || !m_pStream->SeekToEnd())
   {
     m_errorState = true;
@@ -43,6 +114,7 @@ void BinaryWriter::SeekToEnd()
 
 bool BinaryWriter::SafeSeekAbsolute(uint64 position)
 {
+  SyncStream();
   if (m_errorState)
     return false;
 
@@ -51,6 +123,7 @@ bool BinaryWriter::SafeSeekAbsolute(uint64 position)
 
 bool BinaryWriter::SafeSeekRelative(int64 offset)
 {
+  SyncStream();
   if (m_errorState)
     return false;
 
@@ -59,17 +132,28 @@ bool BinaryWriter::SafeSeekRelative(int64 offset)
 
 bool BinaryWriter::SafeSeekToEnd()
 {
+  SyncStream();
   if (m_errorState)
     return false;
 
   return m_pStream->SeekToEnd();
 }
 
-void BinaryWriter::InternalWriteBytes(const void* pSource, uint32 cbSource)
+void BinaryWriter::InternalWriteBytesUnbuffered(const void* pSource, uint32 cbSource)
 {
   if (m_errorState || cbSource == 0)
     return;
 
+  if (m_buffered && ReserveBuffer(cbSource))
+  {
+    std::memcpy(m_pBufferPosition, pSource, cbSource);
+    m_pBufferPosition += cbSource;
+    return;
+  }
+
+  if (m_errorState)
+    return;
+
   uint32 bytesWritten;
   if (cbSource == 1)
     bytesWritten = (m_pStream->WriteByte(*(byte*)pSource)) ? 1 : 0;
@@ -83,11 +167,25 @@ void BinaryWriter::InternalWriteBytes(const void* pSource, uint32 cbSource)
     m_errorState = true;
 }
 
-bool BinaryWriter::SafeInternalWriteBytes(const void* pSource, uint32 cbSource)
+bool BinaryWriter::SafeInternalWriteBytesUnbuffered(const void* pSource, uint32 cbSource)
 {
   if (cbSource == 0)
     return true;
 
+  if (m_buffered)
+  {
+    // what's already buffered has to get to the stream first
+    if (!SyncStream())
+      return false;
+
+    if (ReserveBuffer(cbSource))
+    {
+      std::memcpy(m_pBufferPosition, pSource, cbSource);
+      m_pBufferPosition += cbSource;
+      return true;
+    }
+  }
+
   uint32 bytesWritten;
   if (cbSource == 1)
     bytesWritten = (m_pStream->WriteByte(*(byte*)pSource)) ? 1 : 0;
@@ -294,157 +392,192 @@ bool BinaryWriter::SafeWriteSizePrefixedString(const char* str, uint32 len)
     return true;
 }
 
-// endian-specific
-void BinaryWriter::WriteInt16(const int16 v)
-{
-  int16 valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint16((uint16*)&valueToWrite);
 
-  InternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
+void BinaryWriter::InternalWriteSwappedArray(const void* pValues, uint32 count, uint32 elementSize)
+{
+  // swapped into the buffer where there's room, otherwise a chunk at a time on the stack. chunks are a multiple of
+  // every element size.
+  byte chunk[1024];
+  const byte* pSource = static_cast<const byte*>(pValues);
+  uint32 remaining = count * elementSize;
+  while (remaining > 0)
+  {
+    uint32 chunkSize = Min(remaining, (uint32)sizeof(chunk));
+    if (chunkSize <= (uint32)(m_pBufferEnd - m_pBufferPosition))
+    {
+      Y_byteswap_array_copy(m_pBufferPosition, pSource, chunkSize / elementSize, elementSize);
+      m_pBufferPosition += chunkSize;
+    }
+    else
+    {
+      Y_byteswap_array_copy(chunk, pSource, chunkSize / elementSize, elementSize);
+      InternalWriteBytes(chunk, chunkSize);
+    }
+
+    pSource += chunkSize;
+    remaining -= chunkSize;
+  }
 }
 
-void BinaryWriter::WriteUInt16(const uint16 v)
+bool BinaryWriter::SafeInternalWriteSwappedArray(const void* pValues, uint32 count, uint32 elementSize)
 {
-  uint16 valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint16(&valueToWrite);
+  byte chunk[1024];
+  const byte* pSource = static_cast<const byte*>(pValues);
+  uint32 remaining = count * elementSize;
+  while (remaining > 0)
+  {
+    uint32 chunkSize = Min(remaining, (uint32)sizeof(chunk));
+    if (chunkSize <= (uint32)(m_pBufferEnd - m_pBufferPosition))
+    {
+      Y_byteswap_array_copy(m_pBufferPosition, pSource, chunkSize / elementSize, elementSize);
+      m_pBufferPosition += chunkSize;
+    }
+    else
+    {
+      Y_byteswap_array_copy(chunk, pSource, chunkSize / elementSize, elementSize);
+      if (!SafeInternalWriteBytes(chunk, chunkSize))
+        return false;
+    }
+
+    pSource += chunkSize;
+    remaining -= chunkSize;
+  }
 
-  InternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
+  return true;
 }
 
-void BinaryWriter::WriteInt32(const int32 v)
+void BinaryWriter::WriteBytes(const void* src, uint32 len)
 {
-  int32 valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint32((uint32*)&valueToWrite);
-
-  InternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
+  InternalWriteBytes(src, len);
 }
 
-void BinaryWriter::WriteUInt32(const uint32 v)
+bool BinaryWriter::SafeWriteBytes(const void* src, uint32 len)
 {
-  uint32 valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint32(&valueToWrite);
-
-  InternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
+  return SafeInternalWriteBytes(src, len);
 }
 
-void BinaryWriter::WriteInt64(const int64& v)
+template<typename T>
+bool BinaryWriter::InternalWriteVarIntArray(const T* pValues, uint32 count, bool safe)
 {
-  int64 valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint64((uint64*)&valueToWrite);
+  // straight into the buffer while there's room, through a chunk when it runs low
+  byte chunk[1024];
+  uint32 chunkSize = 0;
+  for (uint32 i = 0; i < count; i++)
+  {
+    uint64 value = std::is_signed<T>::value ? ZigZagEncode((int64)pValues[i]) : (uint64)pValues[i];
+    if (chunkSize == 0 && (uint32)(m_pBufferEnd - m_pBufferPosition) >= MaxVarIntSize)
+    {
+      m_pBufferPosition += EncodeVarUInt(m_pBufferPosition, value);
+      continue;
+    }
+
+    chunkSize += EncodeVarUInt(chunk + chunkSize, value);
+    if (chunkSize > sizeof(chunk) - MaxVarIntSize)
+    {
+      if (safe && !SafeInternalWriteBytes(chunk, chunkSize))
+        return false;
+      else if (!safe)
+        InternalWriteBytes(chunk, chunkSize);
+
+      chunkSize = 0;
+    }
+  }
 
-  InternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
+  if (safe)
+    return SafeInternalWriteBytes(chunk, chunkSize);
+
+  InternalWriteBytes(chunk, chunkSize);
+  return true;
 }
 
-void BinaryWriter::WriteUInt64(const uint64& v)
+void BinaryWriter::WriteVarUInt32Array(const uint32* pValues, uint32 count)
 {
-  uint64 valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint64(&valueToWrite);
-
-  InternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
+  InternalWriteVarIntArray(pValues, count, false);
 }
 
-void BinaryWriter::WriteFloat(const float& v)
+void BinaryWriter::WriteVarUInt64Array(const uint64* pValues, uint32 count)
 {
-  float valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint32((uint32*)&valueToWrite);
-
-  InternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
+  InternalWriteVarIntArray(pValues, count, false);
 }
 
-void BinaryWriter::WriteDouble(const double& v)
+void BinaryWriter::WriteVarInt32Array(const int32* pValues, uint32 count)
 {
-  double valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint64((uint64*)&valueToWrite);
-
-  InternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
+  InternalWriteVarIntArray(pValues, count, false);
 }
 
-bool BinaryWriter::SafeWriteInt16(const int16 v)
+void BinaryWriter::WriteVarInt64Array(const int64* pValues, uint32 count)
 {
-  int16 valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint16((uint16*)&valueToWrite);
-
-  return SafeInternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
+  InternalWriteVarIntArray(pValues, count, false);
 }
 
-bool BinaryWriter::SafeWriteUInt16(const uint16 v)
+bool BinaryWriter::SafeWriteVarUInt32Array(const uint32* pValues, uint32 count)
 {
-  uint16 valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint16(&valueToWrite);
-
-  return SafeInternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
+  return InternalWriteVarIntArray(pValues, count, true);
 }
 
-bool BinaryWriter::SafeWriteInt32(const int32 v)
+bool BinaryWriter::SafeWriteVarUInt64Array(const uint64* pValues, uint32 count)
 {
-  int32 valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint32((uint32*)&valueToWrite);
-
-  return SafeInternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
+  return InternalWriteVarIntArray(pValues, count, true);
 }
 
-bool BinaryWriter::SafeWriteUInt32(const uint32 v)
+bool BinaryWriter::SafeWriteVarInt32Array(const int32* pValues, uint32 count)
 {
-  uint32 valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint32(&valueToWrite);
-
-  return SafeInternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
+  return InternalWriteVarIntArray(pValues, count, true);
 }
 
-bool BinaryWriter::SafeWriteInt64(const int64& v)
+bool BinaryWriter::SafeWriteVarInt64Array(const int64* pValues, uint32 count)
 {
-  int64 valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint64((uint64*)&valueToWrite);
-
-  return SafeInternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
+  return InternalWriteVarIntArray(pValues, count, true);
 }
 
-bool BinaryWriter::SafeWriteUInt64(const uint64& v)
+bool BinaryWriter::InternalWriteBits(uint64 value, uint32 bitCount, bool safe)
 {
-  uint64 valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint64(&valueToWrite);
+  DebugAssert(bitCount <= 64);
 
-  return SafeInternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
-}
+  // at most seven bits are held back, so up to 32 more always fit
+  if (bitCount > 32)
+  {
+    if (!InternalWriteBits(value & 0xFFFFFFFF, 32, safe))
+      return false;
 
-bool BinaryWriter::SafeWriteFloat(const float& v)
-{
-  float valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint32((uint32*)&valueToWrite);
+    value >>= 32;
+    bitCount -= 32;
+  }
 
-  return SafeInternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
-}
+  if (bitCount < 64)
+    value &= (UINT64_C(1) << bitCount) - 1;
 
-bool BinaryWriter::SafeWriteDouble(const double& v)
-{
-  double valueToWrite = v;
-  if (m_eStreamByteOrder != Y_HOST_ENDIAN_TYPE)
-    Y_byteswap_uint64((uint64*)&valueToWrite);
+  m_bitBuffer |= value << m_bitCount;
+  m_bitCount += bitCount;
+  if (m_bitCount < 8)
+    return true;
 
-  return SafeInternalWriteBytes(&valueToWrite, sizeof(valueToWrite));
-}
+  // whole bytes are taken out before writing them, the write can't see them twice
+  byte bytes[8];
+  uint32 byteCount = m_bitCount / 8;
+  for (uint32 i = 0; i < byteCount; i++)
+    bytes[i] = (byte)(m_bitBuffer >> (i * 8));
+  m_bitBuffer >>= byteCount * 8;
+  m_bitCount -= byteCount * 8;
 
-void BinaryWriter::WriteBytes(const void* src, uint32 len)
-{
-  InternalWriteBytes(src, len);
+  if (safe)
+    return SafeInternalWriteBytes(bytes, byteCount);
+
+  InternalWriteBytes(bytes, byteCount);
+  return true;
 }
 
-bool BinaryWriter::SafeWriteBytes(const void* src, uint32 len)
+bool BinaryWriter::InternalFlushBits(bool safe)
 {
-  return SafeInternalWriteBytes(src, len);
+  if (m_bitCount == 0)
+    return true;
+
+  byte lastByte = (byte)m_bitBuffer;
+  m_bitBuffer = 0;
+  m_bitCount = 0;
+  if (safe)
+    return SafeInternalWriteBytes(&lastByte, 1);
+
+  InternalWriteBytes(&lastByte, 1);
+  return true;
 }
@@ -0,0 +1,1130 @@
+#include "YBaseLib/BinaryXML.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Base64.h"
+#include "YBaseLib/BinaryReader.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Endian.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/NumberConversion.h"
+#include "YBaseLib/TextWriter.h"
+#include "YBaseLib/XMLPullReader.h"
+#include <cstring>
+Log_SetChannel(BinaryXML);
+
+static inline bool IsAttributeRecord(byte type)
+{
+  return (type >= BINARY_XML_RECORD_STRING && type <= BINARY_XML_RECORD_DOUBLE);
+}
+
+static inline bool IsNumberRecord(BINARY_XML_RECORD type)
+{
+  return (type >= BINARY_XML_RECORD_INT && type <= BINARY_XML_RECORD_DOUBLE);
+}
+
+BinaryXMLWriter::BinaryXMLWriter() : m_pWriter(NULL), m_depth(0), m_inStartTag(false), m_bErrorState(true) {}
+
+BinaryXMLWriter::~BinaryXMLWriter()
+{
+  Close();
+}
+
+bool BinaryXMLWriter::Create(ByteStream* pOutputStream)
+{
+  Close();
+
+  m_pWriter = new BinaryWriter(pOutputStream, ENDIAN_TYPE_LITTLE, false, true);
+  m_nameIndices.Clear();
+  m_depth = 0;
+  m_inStartTag = false;
+  m_bErrorState = false;
+
+  m_pWriter->WriteUInt32(BinaryXMLMagic);
+  m_pWriter->WriteUInt32(BinaryXMLVersion);
+  return !InErrorState();
+}
+
+void BinaryXMLWriter::Close()
+{
+  if (m_pWriter == NULL)
+    return;
+
+  if (!InErrorState())
+  {
+    while (m_depth > 0)
+      EndElement();
+
+    m_pWriter->WriteByte(BINARY_XML_RECORD_END_DOCUMENT);
+  }
+
+  // the buffered records only reach the stream here, so this is where writing them can fail
+  if (!m_pWriter->SyncStream() || m_pWriter->InErrorState())
+    m_bErrorState = true;
+
+  delete m_pWriter;
+  m_pWriter = NULL;
+}
+
+void BinaryXMLWriter::WriteStringBody(const char* data, uint32 dataLength)
+{
+  m_pWriter->WriteVarUInt32(dataLength);
+  m_pWriter->WriteBytes(data, dataLength);
+  m_pWriter->WriteByte(0);
+}
+
+void BinaryXMLWriter::WriteName(BINARY_XML_RECORD type, const StringView& name)
+{
+  m_pWriter->WriteByte(byte(type));
+
+  const StringHashTable<uint32>::Member* pMember = m_nameIndices.Find(name);
+  if (pMember != NULL)
+  {
+    m_pWriter->WriteVarUInt32(pMember->Value);
+    return;
+  }
+
+  m_nameIndices.Insert(name, m_nameIndices.GetMemberCount() + 1);
+  m_pWriter->WriteVarUInt32(0);
+  WriteStringBody(name.GetData(), name.GetLength());
+}
+
+void BinaryXMLWriter::WriteContent(BINARY_XML_RECORD type, const char* data, uint32 dataLength)
+{
+  if (!CanWrite())
+    return;
+
+  if (m_depth == 0)
+  {
+    Log_ErrorPrintf("BinaryXMLWriter::WriteContent: content outside of an element");
+    m_bErrorState = true;
+    return;
+  }
+
+  m_inStartTag = false;
+  m_pWriter->WriteByte(byte(type));
+  if (type == BINARY_XML_RECORD_BINARY)
+  {
+    m_pWriter->WriteVarUInt32(dataLength);
+    m_pWriter->WriteBytes(data, dataLength);
+  }
+  else
+  {
+    WriteStringBody(data, dataLength);
+  }
+}
+
+bool BinaryXMLWriter::StartAttribute(BINARY_XML_RECORD type, const char* attributeName)
+{
+  if (!CanWrite())
+    return false;
+
+  if (!m_inStartTag)
+  {
+    Log_ErrorPrintf("BinaryXMLWriter::StartAttribute: attribute '%s' outside of a start tag", attributeName);
+    m_bErrorState = true;
+    return false;
+  }
+
+  WriteName(type, StringView(attributeName));
+  return true;
+}
+
+void BinaryXMLWriter::WriteEmptyElement(const char* elementName)
+{
+  if (!CanWrite())
+    return;
+
+  WriteName(BINARY_XML_RECORD_ELEMENT, StringView(elementName));
+  m_pWriter->WriteByte(BINARY_XML_RECORD_END_ELEMENT);
+  m_inStartTag = false;
+}
+
+void BinaryXMLWriter::StartElement(const char* elementName)
+{
+  if (!CanWrite())
+    return;
+
+  WriteName(BINARY_XML_RECORD_ELEMENT, StringView(elementName));
+  m_depth++;
+  m_inStartTag = true;
+}
+
+void BinaryXMLWriter::EndElement()
+{
+  if (!CanWrite())
+    return;
+
+  if (m_depth == 0)
+  {
+    Log_ErrorPrintf("BinaryXMLWriter::EndElement: no element to end");
+    m_bErrorState = true;
+    return;
+  }
+
+  m_pWriter->WriteByte(BINARY_XML_RECORD_END_ELEMENT);
+  m_depth--;
+  m_inStartTag = false;
+}
+
+void BinaryXMLWriter::WriteAttribute(const char* attributeName, const char* attributeValue)
+{
+  if (StartAttribute(BINARY_XML_RECORD_STRING, attributeName))
+    WriteStringBody(attributeValue, Y_strlen(attributeValue));
+}
+
+void BinaryXMLWriter::WriteAttributef(const char* attributeName, const char* format, ...)
+{
+  SmallString value;
+
+  va_list ap;
+  va_start(ap, format);
+  value.FormatVA(format, ap);
+  va_end(ap);
+
+  if (StartAttribute(BINARY_XML_RECORD_STRING, attributeName))
+    WriteStringBody(value.GetCharArray(), value.GetLength());
+}
+
+void BinaryXMLWriter::WriteAttributeInt64(const char* attributeName, int64 value)
+{
+  if (StartAttribute(BINARY_XML_RECORD_INT, attributeName))
+    m_pWriter->WriteVarInt64(value);
+}
+
+void BinaryXMLWriter::WriteAttributeUInt64(const char* attributeName, uint64 value)
+{
+  if (StartAttribute(BINARY_XML_RECORD_UINT, attributeName))
+    m_pWriter->WriteVarUInt64(value);
+}
+
+void BinaryXMLWriter::WriteAttributeFloat(const char* attributeName, float value)
+{
+  if (StartAttribute(BINARY_XML_RECORD_FLOAT, attributeName))
+    m_pWriter->WriteFloat(value);
+}
+
+void BinaryXMLWriter::WriteAttributeDouble(const char* attributeName, double value)
+{
+  if (StartAttribute(BINARY_XML_RECORD_DOUBLE, attributeName))
+    m_pWriter->WriteDouble(value);
+}
+
+void BinaryXMLWriter::WriteString(const char* data)
+{
+  WriteContent(BINARY_XML_RECORD_TEXT, data, Y_strlen(data));
+}
+
+void BinaryXMLWriter::WriteCDATA(const char* data)
+{
+  WriteContent(BINARY_XML_RECORD_CDATA, data, Y_strlen(data));
+}
+
+void BinaryXMLWriter::WriteRaw(const char* data, uint32 dataLength)
+{
+  WriteContent(BINARY_XML_RECORD_RAW, data, dataLength);
+}
+
+void BinaryXMLWriter::WriteBase64EncodedData(const void* pData, uint32 dataLength)
+{
+  WriteContent(BINARY_XML_RECORD_BINARY, reinterpret_cast<const char*>(pData), dataLength);
+}
+
+BinaryXMLReader::BinaryXMLReader()
+  : m_pInputStream(NULL), m_szFileName(NULL), m_pDocument(NULL), m_pDocumentEnd(NULL), m_pPosition(NULL),
+    m_pOwnedDocument(NULL), m_pTokenStart(NULL), m_isEmptyElement(false), m_currentAttribute(-1), m_pStrings(NULL),
+    m_stringsSize(0), m_stringsLength(0), m_eCurrentNodeType(XMLREADER_TOKEN_COUNT), m_bErrorState(true)
+{
+  m_value.Type = BINARY_XML_RECORD_COUNT;
+  m_value.UInt = 0;
+  m_value.pFormatted = NULL;
+}
+
+BinaryXMLReader::~BinaryXMLReader()
+{
+  if (m_pOwnedDocument != NULL)
+    Y_free(m_pOwnedDocument);
+  if (m_pStrings != NULL)
+    Y_free(m_pStrings);
+}
+
+bool BinaryXMLReader::Create(ByteStream* pInputStream, const char* FileName)
+{
+  if (m_pOwnedDocument != NULL)
+  {
+    Y_free(m_pOwnedDocument);
+    m_pOwnedDocument = NULL;
+  }
+
+  m_pInputStream = pInputStream;
+  m_szFileName = FileName;
+  m_names.Clear();
+  m_pTokenStart = NULL;
+  m_attributes.Clear();
+  m_currentAttribute = -1;
+  m_openElements.Clear();
+  m_eCurrentNodeType = XMLREADER_TOKEN_COUNT;
+  m_bErrorState = true;
+
+  uint64 position = pInputStream->GetPosition();
+  uint64 size = pInputStream->GetSize();
+  if (size - position > 0xFFFFFFFF)
+  {
+    Log_ErrorPrintf("BinaryXMLReader::Create: %s is too large.", FileName);
+    return false;
+  }
+
+  // anything that isn't in memory already is read in whole
+  const byte* pBasePointer = pInputStream->GetBasePointer();
+  if (pBasePointer != NULL)
+  {
+    m_pDocument = pBasePointer + position;
+  }
+  else
+  {
+    uint32 length = uint32(size - position);
+    m_pOwnedDocument = static_cast<byte*>(Y_malloc(Max(length, 1u)));
+    if (pInputStream->Read(m_pOwnedDocument, length) != length)
+    {
+      Log_ErrorPrintf("BinaryXMLReader::Create: failed to read %s.", FileName);
+      return false;
+    }
+
+    m_pDocument = m_pOwnedDocument;
+  }
+
+  m_pDocumentEnd = m_pDocument + (size - position);
+
+  uint32 header[2];
+  if (m_pDocumentEnd - m_pDocument < ptrdiff_t(sizeof(header)))
+  {
+    Log_ErrorPrintf("BinaryXMLReader::Create: %s is too short to be a binary XML document.", FileName);
+    return false;
+  }
+
+  std::memcpy(header, m_pDocument, sizeof(header));
+  if (Y_HOST_ENDIAN_TYPE != ENDIAN_TYPE_LITTLE)
+  {
+    header[0] = Y_byteswap_uint32(header[0]);
+    header[1] = Y_byteswap_uint32(header[1]);
+  }
+  if (header[0] != BinaryXMLMagic || header[1] != BinaryXMLVersion)
+  {
+    Log_ErrorPrintf("BinaryXMLReader::Create: %s is not a version %u binary XML document.", FileName,
+                    BinaryXMLVersion);
+    return false;
+  }
+
+  m_pPosition = m_pDocument + sizeof(header);
+  m_bErrorState = false;
+  return true;
+}
+
+bool BinaryXMLReader::CorruptDocument(const char* what)
+{
+  Log_ErrorPrintf("%s:+%u: corrupt binary XML document: %s", m_szFileName, uint32(m_pPosition - m_pDocument), what);
+  m_bErrorState = true;
+  return false;
+}
+
+bool BinaryXMLReader::ReadVarUInt(uint64* pValue)
+{
+  uint32 length = BinaryReader::DecodeVarUInt(m_pPosition, uint32(m_pDocumentEnd - m_pPosition), pValue);
+  if (length == 0)
+    return CorruptDocument("bad or truncated varint");
+
+  m_pPosition += length;
+  return true;
+}
+
+bool BinaryXMLReader::ReadString(StringView* pString)
+{
+  uint64 length;
+  if (!ReadVarUInt(&length))
+    return false;
+
+  // the terminator is what lets the text be handed out in place
+  if (length >= uint64(m_pDocumentEnd - m_pPosition) || m_pPosition[length] != 0)
+    return CorruptDocument("bad or truncated string");
+
+  *pString = StringView(reinterpret_cast<const char*>(m_pPosition), uint32(length));
+  m_pPosition += length + 1;
+  return true;
+}
+
+bool BinaryXMLReader::ReadName(StringView* pName)
+{
+  uint64 index;
+  if (!ReadVarUInt(&index))
+    return false;
+
+  if (index == 0)
+  {
+    if (!ReadString(pName))
+      return false;
+
+    m_names.Add(*pName);
+    return true;
+  }
+
+  if (index > m_names.GetSize())
+    return CorruptDocument("name index out of range");
+
+  *pName = m_names[uint32(index - 1)];
+  return true;
+}
+
+bool BinaryXMLReader::ReadValue(BINARY_XML_RECORD type, Value* pValue)
+{
+  pValue->Type = type;
+  pValue->Text = StringView();
+  pValue->UInt = 0;
+  pValue->pFormatted = NULL;
+
+  switch (type)
+  {
+    case BINARY_XML_RECORD_STRING:
+    case BINARY_XML_RECORD_TEXT:
+    case BINARY_XML_RECORD_CDATA:
+    case BINARY_XML_RECORD_RAW:
+      return ReadString(&pValue->Text);
+
+    case BINARY_XML_RECORD_INT:
+      if (!ReadVarUInt(&pValue->UInt))
+        return false;
+      pValue->Int = BinaryReader::ZigZagDecode(pValue->UInt);
+      return true;
+
+    case BINARY_XML_RECORD_UINT:
+      return ReadVarUInt(&pValue->UInt);
+
+    case BINARY_XML_RECORD_FLOAT:
+    {
+      uint32 bits;
+      if (m_pDocumentEnd - m_pPosition < ptrdiff_t(sizeof(bits)))
+        return CorruptDocument("truncated float");
+
+      std::memcpy(&bits, m_pPosition, sizeof(bits));
+      if (Y_HOST_ENDIAN_TYPE != ENDIAN_TYPE_LITTLE)
+        bits = Y_byteswap_uint32(bits);
+      std::memcpy(&pValue->Float, &bits, sizeof(bits));
+      m_pPosition += sizeof(bits);
+      return true;
+    }
+
+    case BINARY_XML_RECORD_DOUBLE:
+    {
+      uint64 bits;
+      if (m_pDocumentEnd - m_pPosition < ptrdiff_t(sizeof(bits)))
+        return CorruptDocument("truncated double");
+
+      std::memcpy(&bits, m_pPosition, sizeof(bits));
+      if (Y_HOST_ENDIAN_TYPE != ENDIAN_TYPE_LITTLE)
+        bits = Y_byteswap_uint64(bits);
+      std::memcpy(&pValue->Double, &bits, sizeof(bits));
+      m_pPosition += sizeof(bits);
+      return true;
+    }
+
+    case BINARY_XML_RECORD_BINARY:
+    {
+      uint64 length;
+      if (!ReadVarUInt(&length))
+        return false;
+      if (length > uint64(m_pDocumentEnd - m_pPosition) || length > 0xBFFFFFF0)
+        return CorruptDocument("truncated binary data");
+
+      pValue->Text = StringView(reinterpret_cast<const char*>(m_pPosition), uint32(length));
+      m_pPosition += length;
+      return true;
+    }
+
+    default:
+      return CorruptDocument("unknown value type");
+  }
+}
+
+bool BinaryXMLReader::NextToken()
+{
+  if (m_bErrorState)
+    return false;
+
+  m_pTokenStart = m_pPosition;
+  m_name = StringView();
+  m_value.Type = BINARY_XML_RECORD_COUNT;
+  m_value.Text = StringView();
+  m_value.pFormatted = NULL;
+  m_isEmptyElement = false;
+  m_attributes.Clear();
+  m_currentAttribute = -1;
+  m_eCurrentNodeType = XMLREADER_TOKEN_COUNT;
+
+  if (m_pPosition == m_pDocumentEnd)
+    return CorruptDocument("missing end of document");
+
+  BINARY_XML_RECORD type = BINARY_XML_RECORD(*(m_pPosition++));
+  switch (type)
+  {
+    case BINARY_XML_RECORD_END_DOCUMENT:
+    {
+      if (m_openElements.GetSize() > 0)
+        return CorruptDocument("end of document with elements open");
+
+      // stay on the end, so reading further keeps returning false
+      m_pPosition--;
+      return false;
+    }
+
+    case BINARY_XML_RECORD_ELEMENT:
+    {
+      if (!ReadName(&m_name))
+        return false;
+
+      // the attributes follow, and numbers among them need room to be formatted
+      uint32 stringsLength = 0;
+      while (m_pPosition != m_pDocumentEnd && IsAttributeRecord(*m_pPosition))
+      {
+        Attribute attribute;
+        BINARY_XML_RECORD attributeType = BINARY_XML_RECORD(*(m_pPosition++));
+        if (!ReadName(&attribute.Name) || !ReadValue(attributeType, &attribute.AttributeValue))
+          return false;
+
+        if (IsNumberRecord(attributeType))
+          stringsLength += NumberConversion::MaxFloatLength + 1;
+
+        m_attributes.Add(attribute);
+      }
+
+      // an end straight after the start is an empty element, which gets no end token, like XMLReader
+      if (m_pPosition != m_pDocumentEnd && *m_pPosition == BINARY_XML_RECORD_END_ELEMENT)
+      {
+        m_pPosition++;
+        m_isEmptyElement = true;
+      }
+      else
+      {
+        m_openElements.Add(m_name);
+      }
+
+      ResetStrings(stringsLength);
+      m_eCurrentNodeType = XMLREADER_TOKEN_ELEMENT;
+      return true;
+    }
+
+    case BINARY_XML_RECORD_END_ELEMENT:
+    {
+      if (m_openElements.GetSize() == 0)
+        return CorruptDocument("end of element with none open");
+
+      m_name = m_openElements.LastElement();
+      m_openElements.RemoveBack();
+      m_eCurrentNodeType = XMLREADER_TOKEN_END_ELEMENT;
+      return true;
+    }
+
+    case BINARY_XML_RECORD_TEXT:
+    case BINARY_XML_RECORD_CDATA:
+    case BINARY_XML_RECORD_RAW:
+    case BINARY_XML_RECORD_BINARY:
+    {
+      if (m_openElements.GetSize() == 0)
+        return CorruptDocument("content outside of an element");
+      if (!ReadValue(type, &m_value))
+        return false;
+
+      ResetStrings((type == BINARY_XML_RECORD_BINARY) ? Base64::GetEncodedLength(m_value.Text.GetLength()) + 1 : 0);
+      m_name = StringView("#text", 5);
+      m_eCurrentNodeType = XMLREADER_TOKEN_TEXT;
+      return true;
+    }
+
+    default:
+      m_pPosition--;
+      return CorruptDocument("unknown record");
+  }
+}
+
+void BinaryXMLReader::ResetStrings(uint32 maxLength)
+{
+  if (maxLength > m_stringsSize)
+  {
+    m_stringsSize = Max(maxLength, Max(m_stringsSize * 2, 256u));
+    m_pStrings = static_cast<char*>(Y_realloc(m_pStrings, m_stringsSize));
+  }
+
+  m_stringsLength = 0;
+}
+
+const char* BinaryXMLReader::GetValueText(Value* pValue)
+{
+  if (pValue->pFormatted != NULL)
+    return pValue->pFormatted;
+
+  char* pText = m_pStrings + m_stringsLength;
+  uint32 length;
+  switch (pValue->Type)
+  {
+    case BINARY_XML_RECORD_INT:
+      length = NumberConversion::FormatInt64(pText, pValue->Int);
+      break;
+
+    case BINARY_XML_RECORD_UINT:
+      length = NumberConversion::FormatUInt64(pText, pValue->UInt);
+      break;
+
+    case BINARY_XML_RECORD_FLOAT:
+      length = NumberConversion::FormatFloat(pText, pValue->Float);
+      break;
+
+    case BINARY_XML_RECORD_DOUBLE:
+      length = NumberConversion::FormatDouble(pText, pValue->Double);
+      break;
+
+    case BINARY_XML_RECORD_BINARY:
+      length = Base64::Encode(pText, pValue->Text.GetData(), pValue->Text.GetLength());
+      break;
+
+    default:
+      // strings are terminated in the document
+      pValue->pFormatted = pValue->Text.GetData();
+      return (pValue->pFormatted != NULL) ? pValue->pFormatted : "";
+  }
+
+  DebugAssert(m_stringsLength + length < m_stringsSize);
+  pText[length] = '\0';
+  m_stringsLength += length + 1;
+  pValue->pFormatted = pText;
+  return pText;
+}
+
+BinaryXMLReader::Value* BinaryXMLReader::GetCurrentValue()
+{
+  if (m_currentAttribute >= 0)
+    return &m_attributes[m_currentAttribute].AttributeValue;
+
+  return (m_eCurrentNodeType == XMLREADER_TOKEN_TEXT) ? &m_value : NULL;
+}
+
+const char* BinaryXMLReader::GetNodeName()
+{
+  if (m_currentAttribute >= 0)
+    return m_attributes[m_currentAttribute].Name.GetData();
+
+  return (m_eCurrentNodeType != XMLREADER_TOKEN_COUNT) ? m_name.GetData() : NULL;
+}
+
+const char* BinaryXMLReader::GetNodeValue()
+{
+  Value* pValue = GetCurrentValue();
+  return (pValue != NULL) ? GetValueText(pValue) : NULL;
+}
+
+const char* BinaryXMLReader::GetNodeValueString()
+{
+  const char* v = GetNodeValue();
+  return (v != NULL) ? v : "";
+}
+
+bool BinaryXMLReader::MoveToFirstAttribute()
+{
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_ELEMENT && m_eCurrentNodeType != XMLREADER_TOKEN_ATTRIBUTE)
+    return false;
+  if (m_attributes.GetSize() == 0)
+    return false;
+
+  m_currentAttribute = 0;
+  m_eCurrentNodeType = XMLREADER_TOKEN_ATTRIBUTE;
+  return true;
+}
+
+bool BinaryXMLReader::MoveToNextAttribute()
+{
+  if (m_eCurrentNodeType == XMLREADER_TOKEN_ELEMENT)
+    return MoveToFirstAttribute();
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_ATTRIBUTE || uint32(m_currentAttribute + 1) >= m_attributes.GetSize())
+    return false;
+
+  m_currentAttribute++;
+  return true;
+}
+
+bool BinaryXMLReader::MoveToAttribute(const char* AttributeName)
+{
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_ELEMENT && m_eCurrentNodeType != XMLREADER_TOKEN_ATTRIBUTE)
+    return false;
+
+  StringView name(AttributeName);
+  for (uint32 i = 0; i < m_attributes.GetSize(); i++)
+  {
+    if (m_attributes[i].Name.Compare(name))
+    {
+      m_currentAttribute = int32(i);
+      m_eCurrentNodeType = XMLREADER_TOKEN_ATTRIBUTE;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool BinaryXMLReader::MoveToElement()
+{
+  if (m_eCurrentNodeType == XMLREADER_TOKEN_ELEMENT)
+    return true;
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_ATTRIBUTE)
+    return false;
+
+  m_currentAttribute = -1;
+  m_eCurrentNodeType = XMLREADER_TOKEN_ELEMENT;
+  return true;
+}
+
+const char* BinaryXMLReader::FetchAttribute(const char* AttributeName)
+{
+  return (MoveToAttribute(AttributeName)) ? GetNodeValue() : NULL;
+}
+
+const char* BinaryXMLReader::FetchAttributeString(const char* AttributeName)
+{
+  return (MoveToAttribute(AttributeName)) ? GetNodeValueString() : "";
+}
+
+const char* BinaryXMLReader::FetchAttributeDefault(const char* attributeName, const char* defaultValue)
+{
+  return (MoveToAttribute(attributeName)) ? GetNodeValueString() : defaultValue;
+}
+
+int64 BinaryXMLReader::FetchAttributeInt64(const char* attributeName, int64 defaultValue)
+{
+  if (!MoveToAttribute(attributeName))
+    return defaultValue;
+
+  const Value& value = m_attributes[m_currentAttribute].AttributeValue;
+  switch (value.Type)
+  {
+    case BINARY_XML_RECORD_INT:
+      return value.Int;
+    case BINARY_XML_RECORD_UINT:
+      return int64(value.UInt);
+    case BINARY_XML_RECORD_FLOAT:
+      return int64(value.Float);
+    case BINARY_XML_RECORD_DOUBLE:
+      return int64(value.Double);
+    default:
+    {
+      int64 parsed;
+      return (NumberConversion::ParseInt64(value.Text, &parsed) > 0) ? parsed : defaultValue;
+    }
+  }
+}
+
+uint64 BinaryXMLReader::FetchAttributeUInt64(const char* attributeName, uint64 defaultValue)
+{
+  if (!MoveToAttribute(attributeName))
+    return defaultValue;
+
+  const Value& value = m_attributes[m_currentAttribute].AttributeValue;
+  switch (value.Type)
+  {
+    case BINARY_XML_RECORD_INT:
+      return uint64(value.Int);
+    case BINARY_XML_RECORD_UINT:
+      return value.UInt;
+    case BINARY_XML_RECORD_FLOAT:
+      return uint64(value.Float);
+    case BINARY_XML_RECORD_DOUBLE:
+      return uint64(value.Double);
+    default:
+    {
+      uint64 parsed;
+      return (NumberConversion::ParseUInt64(value.Text, &parsed) > 0) ? parsed : defaultValue;
+    }
+  }
+}
+
+double BinaryXMLReader::FetchAttributeDouble(const char* attributeName, double defaultValue)
+{
+  if (!MoveToAttribute(attributeName))
+    return defaultValue;
+
+  const Value& value = m_attributes[m_currentAttribute].AttributeValue;
+  switch (value.Type)
+  {
+    case BINARY_XML_RECORD_INT:
+      return double(value.Int);
+    case BINARY_XML_RECORD_UINT:
+      return double(value.UInt);
+    case BINARY_XML_RECORD_FLOAT:
+      return double(value.Float);
+    case BINARY_XML_RECORD_DOUBLE:
+      return value.Double;
+    default:
+    {
+      double parsed;
+      return (NumberConversion::ParseDouble(value.Text, &parsed) > 0) ? parsed : defaultValue;
+    }
+  }
+}
+
+bool BinaryXMLReader::IsEmptyElement()
+{
+  DebugAssert(m_eCurrentNodeType == XMLREADER_TOKEN_ELEMENT || m_eCurrentNodeType == XMLREADER_TOKEN_ATTRIBUTE);
+  return m_isEmptyElement;
+}
+
+void BinaryXMLReader::PrintWarning(const char* Format, ...)
+{
+  char buf[512];
+
+  va_list ap;
+  va_start(ap, Format);
+  Y_vsnprintf(buf, countof(buf), Format, ap);
+  va_end(ap);
+
+  const byte* pPosition = (m_pTokenStart != NULL) ? m_pTokenStart : m_pDocument;
+  Log_WarningPrintf("%s:+%u: %s", m_szFileName, uint32(pPosition - m_pDocument), buf);
+}
+
+void BinaryXMLReader::PrintError(const char* Format, ...)
+{
+  char buf[512];
+
+  va_list ap;
+  va_start(ap, Format);
+  Y_vsnprintf(buf, countof(buf), Format, ap);
+  va_end(ap);
+
+  const byte* pPosition = (m_pTokenStart != NULL) ? m_pTokenStart : m_pDocument;
+  Log_ErrorPrintf("%s:+%u: %s", m_szFileName, uint32(pPosition - m_pDocument), buf);
+}
+
+bool BinaryXMLReader::SkipToElement(const char* ElementName)
+{
+  StringView elementName(ElementName);
+  for (;;)
+  {
+    if (m_eCurrentNodeType == XMLREADER_TOKEN_ELEMENT && m_name.CompareInsensitive(elementName))
+      return true;
+
+    if (!NextToken())
+      return false;
+  }
+}
+
+bool BinaryXMLReader::SkipCurrentElement()
+{
+  // if we're on the attribute node, switch back to the element node.
+  MoveToElement();
+
+  // if we're an empty node, exit out, since the next node will be the next one in the tree anyway.
+  if (m_isEmptyElement)
+    return true;
+
+  // the end that closes it is the one that brings the open elements back to where they were before it
+  uint32 depth = m_openElements.GetSize();
+  for (;;)
+  {
+    if (!NextToken())
+      return false;
+
+    if (m_eCurrentNodeType == XMLREADER_TOKEN_END_ELEMENT && m_openElements.GetSize() < depth)
+      return true;
+  }
+}
+
+int32 BinaryXMLReader::Select(const char* SelectionString, bool AbortOnError /* = true */)
+{
+  int32 s = Y_selectstring(SelectionString, GetNodeName());
+  if (s < 0 && AbortOnError)
+  {
+    PrintError("expected '%s', got '%s'", SelectionString, GetNodeName());
+    m_bErrorState = true;
+  }
+
+  return s;
+}
+
+int32 BinaryXMLReader::SelectAttribute(const char* AttributeName, const char* SelectionString,
+                                       bool AbortOnError /* = true */)
+{
+  const char* attributeValue = FetchAttributeString(AttributeName);
+  int32 s = Y_selectstring(SelectionString, attributeValue);
+  if (s < 0 && AbortOnError)
+  {
+    PrintError("for attribute '%s': expected '%s', got '%s'", AttributeName, SelectionString, attributeValue);
+    m_bErrorState = true;
+  }
+
+  return s;
+}
+
+String BinaryXMLReader::GetElementText(bool skipElement /*= false*/)
+{
+  String retString;
+  if (!m_bErrorState)
+  {
+    DebugAssert(m_eCurrentNodeType == XMLREADER_TOKEN_ATTRIBUTE || m_eCurrentNodeType == XMLREADER_TOKEN_ELEMENT ||
+                m_eCurrentNodeType == XMLREADER_TOKEN_TEXT);
+    if (m_eCurrentNodeType == XMLREADER_TOKEN_TEXT ||
+        (MoveToElement() && !m_isEmptyElement && NextToken() && m_eCurrentNodeType == XMLREADER_TOKEN_TEXT))
+    {
+      retString = GetNodeValue();
+      if (skipElement)
+        SkipCurrentElement();
+    }
+  }
+
+  return retString;
+}
+
+bool BinaryXMLReader::ExpectEndOfElement()
+{
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_END_ELEMENT)
+  {
+    PrintError("expected end of element, current node is not end of element.");
+    m_bErrorState = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool BinaryXMLReader::ExpectEndOfElementName(const char* nodeName)
+{
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_END_ELEMENT)
+  {
+    PrintError("expected end of element, current node is not end of element.");
+    m_bErrorState = true;
+    return false;
+  }
+
+  if (!m_name.CompareInsensitive(StringView(nodeName)))
+  {
+    PrintError("expecting end of element type '%s', got '%.*s'", nodeName, m_name.GetLength(), m_name.GetData());
+    m_bErrorState = true;
+    return false;
+  }
+
+  return true;
+}
+
+// Writes an attribute as the number it reads back as exactly, so nothing changes going back to text.
+static void ConvertAttribute(BinaryXMLWriter& writer, const char* name, const char* value)
+{
+  StringView text(value);
+  if (text.GetLength() > 0 && ((value[0] >= '0' && value[0] <= '9') || value[0] == '-'))
+  {
+    char buffer[NumberConversion::MaxFloatLength];
+    if (value[0] == '-')
+    {
+      int64 intValue;
+      if (NumberConversion::ParseInt64(text, &intValue) == text.GetLength() &&
+          text.Compare(StringView(buffer, NumberConversion::FormatInt64(buffer, intValue))))
+      {
+        writer.WriteAttributeInt64(name, intValue);
+        return;
+      }
+    }
+    else
+    {
+      uint64 uintValue;
+      if (NumberConversion::ParseUInt64(text, &uintValue) == text.GetLength() &&
+          text.Compare(StringView(buffer, NumberConversion::FormatUInt64(buffer, uintValue))))
+      {
+        writer.WriteAttributeUInt64(name, uintValue);
+        return;
+      }
+    }
+
+    double doubleValue;
+    if (NumberConversion::ParseDouble(text, &doubleValue) == text.GetLength() &&
+        text.Compare(StringView(buffer, NumberConversion::FormatDouble(buffer, doubleValue))))
+    {
+      writer.WriteAttributeDouble(name, doubleValue);
+      return;
+    }
+  }
+
+  writer.WriteAttribute(name, value);
+}
+
+bool BinaryXML::ConvertFromText(ByteStream* pTextStream, const char* fileName, ByteStream* pBinaryStream)
+{
+  XMLPullReader reader;
+  BinaryXMLWriter writer;
+  if (!reader.Create(pTextStream, fileName) || !writer.Create(pBinaryStream))
+    return false;
+
+  while (reader.NextToken())
+  {
+    switch (reader.GetTokenType())
+    {
+      case XMLREADER_TOKEN_ELEMENT:
+      {
+        bool isEmpty = reader.IsEmptyElement();
+        writer.StartElement(reader.GetNodeName());
+        while (reader.MoveToNextAttribute())
+          ConvertAttribute(writer, reader.GetNodeName(), reader.GetNodeValueString());
+
+        if (isEmpty)
+          writer.EndElement();
+      }
+      break;
+
+      case XMLREADER_TOKEN_END_ELEMENT:
+        writer.EndElement();
+        break;
+
+      case XMLREADER_TOKEN_TEXT:
+        writer.WriteString(reader.GetNodeValueString());
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  if (reader.InErrorState())
+    return false;
+
+  writer.Close();
+  return !writer.InErrorState();
+}
+
+// Writes text with the characters that would be read as markup escaped.
+static void WriteEscaped(TextWriter& writer, const char* text, bool attribute)
+{
+  const char* pRunStart = text;
+  for (const char* pCurrent = text; *pCurrent != '\0'; pCurrent++)
+  {
+    const char* replacement;
+    switch (*pCurrent)
+    {
+      case '&':
+        replacement = "&amp;";
+        break;
+      case '<':
+        replacement = "&lt;";
+        break;
+      case '>':
+        replacement = "&gt;";
+        break;
+      case '"':
+        replacement = attribute ? "&quot;" : NULL;
+        break;
+      case '\n':
+        replacement = attribute ? "&#10;" : NULL;
+        break;
+      case '\r':
+        replacement = "&#13;";
+        break;
+      case '\t':
+        replacement = attribute ? "&#9;" : NULL;
+        break;
+      default:
+        replacement = NULL;
+        break;
+    }
+
+    if (replacement != NULL)
+    {
+      writer.Write(pRunStart, uint32(pCurrent - pRunStart));
+      writer.Write(replacement);
+      pRunStart = pCurrent + 1;
+    }
+  }
+
+  writer.Write(pRunStart);
+}
+
+static void WriteIndent(TextWriter& writer, uint32 depth)
+{
+  for (uint32 i = 0; i < depth; i++)
+    writer.Write("    ", 4);
+}
+
+bool BinaryXML::ConvertToText(ByteStream* pBinaryStream, const char* fileName, ByteStream* pTextStream)
+{
+  BinaryXMLReader reader;
+  if (!reader.Create(pBinaryStream, fileName))
+    return false;
+
+  TextWriter writer(pTextStream);
+  writer.Write("<?xml version=\"1.0\"?>\n");
+
+  // Elements go on lines of their own, except inside an element with text, where added whitespace would be
+  // read back as part of it. textDepth is the depth of that element, or zero.
+  uint32 depth = 0;
+  uint32 textDepth = 0;
+  while (reader.NextToken())
+  {
+    switch (reader.GetTokenType())
+    {
+      case XMLREADER_TOKEN_ELEMENT:
+      {
+        if (textDepth == 0)
+        {
+          if (depth > 0)
+            writer.Write("\n", 1);
+          WriteIndent(writer, depth);
+        }
+
+        bool isEmpty = reader.IsEmptyElement();
+        writer.Write("<", 1);
+        writer.Write(reader.GetNodeName());
+        while (reader.MoveToNextAttribute())
+        {
+          writer.Write(" ", 1);
+          writer.Write(reader.GetNodeName());
+          writer.Write("=\"", 2);
+          WriteEscaped(writer, reader.GetNodeValueString(), true);
+          writer.Write("\"", 1);
+        }
+
+        if (isEmpty)
+        {
+          writer.Write("/>", 2);
+        }
+        else
+        {
+          writer.Write(">", 1);
+          depth++;
+        }
+      }
+      break;
+
+      case XMLREADER_TOKEN_END_ELEMENT:
+      {
+        if (textDepth == 0)
+        {
+          writer.Write("\n", 1);
+          WriteIndent(writer, depth - 1);
+        }
+        else if (textDepth == depth)
+        {
+          textDepth = 0;
+        }
+
+        writer.Write("</", 2);
+        writer.Write(reader.GetNodeName());
+        writer.Write(">", 1);
+        depth--;
+      }
+      break;
+
+      case XMLREADER_TOKEN_TEXT:
+      {
+        if (textDepth == 0)
+          textDepth = depth;
+
+        WriteEscaped(writer, reader.GetNodeValueString(), false);
+      }
+      break;
+
+      default:
+        break;
+    }
+  }
+
+  writer.Write("\n", 1);
+  return (!reader.InErrorState() && writer.Flush() && !writer.InErrorState());
+}
@@ -0,0 +1,186 @@
+#include "YBaseLib/BitSet.h"
+#include <cstring>
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <emmintrin.h>
+#define Y_BITSET_SSE2 1
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_BITSET_NEON 1
+#endif
+
+// Each operation runs 16 bytes at a time with SSE2 or NEON, then 8 byte words, then single bytes for the tail.
+// Bit sets are unaligned as far as these are concerned, malloc only promises 16 bytes on some platforms.
+
+static inline uint64 LoadWord(const byte* pValues)
+{
+  uint64 value;
+  std::memcpy(&value, pValues, sizeof(value));
+  return value;
+}
+
+static inline void StoreWord(byte* pValues, uint64 value)
+{
+  std::memcpy(pValues, &value, sizeof(value));
+}
+
+#if defined(Y_BITSET_SSE2)
+
+#define BITSET_VECTOR_OPERATION(name, expression)                                                                      \
+  static inline __m128i name(__m128i a, __m128i b) { return expression; }
+
+BITSET_VECTOR_OPERATION(VectorAnd, _mm_and_si128(a, b))
+BITSET_VECTOR_OPERATION(VectorOr, _mm_or_si128(a, b))
+BITSET_VECTOR_OPERATION(VectorXor, _mm_xor_si128(a, b))
+BITSET_VECTOR_OPERATION(VectorAndNot, _mm_andnot_si128(b, a))
+
+#define BITSET_VECTOR_LOOP(function)                                                                                   \
+  for (; byteCount >= 16; byteCount -= 16, pDestination += 16, pSource += 16)                                          \
+  {                                                                                                                    \
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pDestination));                                      \
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource));                                            \
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination), function(a, b));                                        \
+  }
+
+#elif defined(Y_BITSET_NEON)
+
+#define BITSET_VECTOR_OPERATION(name, expression)                                                                      \
+  static inline uint8x16_t name(uint8x16_t a, uint8x16_t b) { return expression; }
+
+BITSET_VECTOR_OPERATION(VectorAnd, vandq_u8(a, b))
+BITSET_VECTOR_OPERATION(VectorOr, vorrq_u8(a, b))
+BITSET_VECTOR_OPERATION(VectorXor, veorq_u8(a, b))
+BITSET_VECTOR_OPERATION(VectorAndNot, vbicq_u8(a, b))
+
+#define BITSET_VECTOR_LOOP(function)                                                                                   \
+  for (; byteCount >= 16; byteCount -= 16, pDestination += 16, pSource += 16)                                          \
+    vst1q_u8(pDestination, function(vld1q_u8(pDestination), vld1q_u8(pSource)));
+
+#else
+
+#define BITSET_VECTOR_LOOP(function)
+
+#endif
+
+#define BITSET_BINARY_OPERATION(name, vectorFunction, operation)                                                       \
+  void BitSetOperations::name(void* pDestinationValues, const void* pSourceValues, size_t byteCount)                   \
+  {                                                                                                                    \
+    byte* pDestination = reinterpret_cast<byte*>(pDestinationValues);                                                  \
+    const byte* pSource = reinterpret_cast<const byte*>(pSourceValues);                                                \
+    BITSET_VECTOR_LOOP(vectorFunction);                                                                                \
+    for (; byteCount >= 8; byteCount -= 8, pDestination += 8, pSource += 8)                                            \
+    {                                                                                                                  \
+      uint64 a = LoadWord(pDestination);                                                                               \
+      uint64 b = LoadWord(pSource);                                                                                    \
+      StoreWord(pDestination, operation);                                                                              \
+    }                                                                                                                  \
+    for (; byteCount > 0; byteCount--, pDestination++, pSource++)                                                      \
+    {                                                                                                                  \
+      byte a = *pDestination;                                                                                          \
+      byte b = *pSource;                                                                                               \
+      *pDestination = (byte)(operation);                                                                               \
+    }                                                                                                                  \
+  }
+
+BITSET_BINARY_OPERATION(And, VectorAnd, a & b)
+BITSET_BINARY_OPERATION(Or, VectorOr, a | b)
+BITSET_BINARY_OPERATION(Xor, VectorXor, a ^ b)
+BITSET_BINARY_OPERATION(AndNot, VectorAndNot, a & ~b)
+
+size_t BitSetOperations::PopCount(const void* pValues, size_t byteCount)
+{
+  const byte* pBytes = reinterpret_cast<const byte*>(pValues);
+  size_t count = 0;
+
+#if defined(Y_BITSET_SSE2) && !defined(__POPCNT__)
+  // without POPCNT, count bits per byte in vector registers and sum the bytes with SAD. every byte counter
+  // holds at most 8, so 31 iterations of adding them up can't overflow.
+  const __m128i mask1 = _mm_set1_epi8(0x55);
+  const __m128i mask2 = _mm_set1_epi8(0x33);
+  const __m128i mask4 = _mm_set1_epi8(0x0F);
+  while (byteCount >= 16)
+  {
+    __m128i byteCounts = _mm_setzero_si128();
+    for (uint32 i = 0; i < 31 && byteCount >= 16; i++, byteCount -= 16, pBytes += 16)
+    {
+      __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBytes));
+      value = _mm_sub_epi8(value, _mm_and_si128(_mm_srli_epi64(value, 1), mask1));
+      value = _mm_add_epi8(_mm_and_si128(value, mask2), _mm_and_si128(_mm_srli_epi64(value, 2), mask2));
+      value = _mm_and_si128(_mm_add_epi8(value, _mm_srli_epi64(value, 4)), mask4);
+      byteCounts = _mm_add_epi8(byteCounts, value);
+    }
+
+    __m128i sums = _mm_sad_epu8(byteCounts, _mm_setzero_si128());
+    count += (size_t)_mm_cvtsi128_si32(sums) + (size_t)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+  }
+#elif defined(Y_BITSET_NEON)
+  // CNT per byte, widened before the byte counters could overflow
+  while (byteCount >= 16)
+  {
+    uint16x8_t sums = vdupq_n_u16(0);
+    for (uint32 i = 0; i < 31 && byteCount >= 16; i++, byteCount -= 16, pBytes += 16)
+      sums = vpadalq_u8(sums, vcntq_u8(vld1q_u8(pBytes)));
+
+    count += (size_t)vaddvq_u16(sums);
+  }
+#else
+  // four independent POPCNTs per iteration
+  for (; byteCount >= 32; byteCount -= 32, pBytes += 32)
+  {
+    count += Y_popcnt(LoadWord(pBytes)) + Y_popcnt(LoadWord(pBytes + 8)) + Y_popcnt(LoadWord(pBytes + 16)) +
+             Y_popcnt(LoadWord(pBytes + 24));
+  }
+#endif
+
+  for (; byteCount >= 8; byteCount -= 8, pBytes += 8)
+    count += Y_popcnt(LoadWord(pBytes));
+  for (; byteCount > 0; byteCount--, pBytes++)
+    count += Y_popcnt(*pBytes);
+
+  return count;
+}
+
+size_t BitSetOperations::FindNonZeroByte(const void* pValues, size_t startByte, size_t byteCount)
+{
+  const byte* pBytes = reinterpret_cast<const byte*>(pValues);
+  size_t offset = startByte;
+
+#if defined(Y_BITSET_SSE2)
+  for (; offset + 16 <= byteCount; offset += 16)
+  {
+    __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBytes + offset));
+    uint32 zeroMask = (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(value, _mm_setzero_si128()));
+    if (zeroMask != 0xFFFF)
+    {
+      uint32 index;
+      Y_bitscanforward(~zeroMask & 0xFFFF, &index);
+      return offset + index;
+    }
+  }
+#elif defined(Y_BITSET_NEON)
+  for (; offset + 16 <= byteCount; offset += 16)
+  {
+    if (vmaxvq_u8(vld1q_u8(pBytes + offset)) != 0)
+      break;
+  }
+#endif
+
+  for (; offset + 8 <= byteCount; offset += 8)
+  {
+    uint64 value = LoadWord(pBytes + offset);
+    if (value != 0)
+    {
+      // bit sets are stored little endian, so the lowest set bit is in the first non-zero byte
+      uint64 index;
+      Y_bitscanforward(value, &index);
+      return offset + (size_t)(index / 8);
+    }
+  }
+  for (; offset < byteCount; offset++)
+  {
+    if (pBytes[offset] != 0)
+      return offset;
+  }
+
+  return byteCount;
+}
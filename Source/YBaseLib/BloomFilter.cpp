@@ -0,0 +1,101 @@
+#include "YBaseLib/BloomFilter.h"
+#include "YBaseLib/HashTrait.h"
+#include "YBaseLib/Memory.h"
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <emmintrin.h>
+#define Y_BLOOMFILTER_SSE2 1
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_BLOOMFILTER_NEON 1
+#endif
+
+// Odd multipliers picking the bit in each word, the ones Parquet uses.
+static const uint32 s_salts[8] = {0x47B6137BU, 0x44974D91U, 0x8824AD5BU, 0xA2B7289DU,
+                                  0x705495C7U, 0x2DF1424BU, 0x9EFC4947U, 0x5C6BFB31U};
+
+// one bit in each word, from the top five bits of the key times its salt
+static void MakeMask(uint32 key, uint32 mask[8])
+{
+  for (uint32 i = 0; i < 8; i++)
+    mask[i] = 1u << ((key * s_salts[i]) >> 27);
+}
+
+BloomFilter::BloomFilter() : m_pBlocks(nullptr), m_blockCount(0), m_addedCount(0), m_expectedCount(0) {}
+
+BloomFilter::~BloomFilter()
+{
+  Y_aligned_free(m_pBlocks);
+}
+
+void BloomFilter::Reset(uint32 expectedCount, uint32 bitsPerKey /* = 12 */)
+{
+  uint64 bitCount = static_cast<uint64>(expectedCount) * bitsPerKey;
+  uint32 blockCount = static_cast<uint32>((bitCount + sizeof(Block) * 8 - 1) / (sizeof(Block) * 8));
+  if (blockCount == 0)
+    blockCount = 1;
+
+  if (blockCount != m_blockCount)
+  {
+    Y_aligned_free(m_pBlocks);
+    m_pBlocks = static_cast<Block*>(Y_aligned_malloc(sizeof(Block) * blockCount, sizeof(Block)));
+    m_blockCount = blockCount;
+  }
+
+  m_expectedCount = expectedCount;
+  Clear();
+}
+
+void BloomFilter::Clear()
+{
+  if (m_blockCount > 0)
+    Y_memzero(m_pBlocks, sizeof(Block) * m_blockCount);
+
+  m_addedCount = 0;
+}
+
+void BloomFilter::Add(uint64 hash)
+{
+  if (m_blockCount == 0)
+    return;
+
+  // the high half picks the block without a division, the low half the bits
+  uint64 mixed = Y_HashFinalize64(hash);
+  Block& block = m_pBlocks[((mixed >> 32) * m_blockCount) >> 32];
+  uint32 mask[8];
+  MakeMask(static_cast<uint32>(mixed), mask);
+  for (uint32 i = 0; i < 8; i++)
+    block.Words[i] |= mask[i];
+
+  m_addedCount++;
+}
+
+bool BloomFilter::MayContain(uint64 hash) const
+{
+  if (m_blockCount == 0)
+    return true;
+
+  uint64 mixed = Y_HashFinalize64(hash);
+  const Block& block = m_pBlocks[((mixed >> 32) * m_blockCount) >> 32];
+  uint32 mask[8];
+  MakeMask(static_cast<uint32>(mixed), mask);
+
+  // every bit of the mask has to be set in the block
+#if defined(Y_BLOOMFILTER_SSE2)
+  const __m128i* pWords = reinterpret_cast<const __m128i*>(block.Words);
+  __m128i missingLow = _mm_andnot_si128(_mm_load_si128(pWords), _mm_loadu_si128(reinterpret_cast<__m128i*>(mask)));
+  __m128i missingHigh =
+    _mm_andnot_si128(_mm_load_si128(pWords + 1), _mm_loadu_si128(reinterpret_cast<__m128i*>(mask + 4)));
+  __m128i missing = _mm_or_si128(missingLow, missingHigh);
+  return (_mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xFFFF);
+#elif defined(Y_BLOOMFILTER_NEON)
+  uint32x4_t missingLow = vbicq_u32(vld1q_u32(mask), vld1q_u32(block.Words));
+  uint32x4_t missingHigh = vbicq_u32(vld1q_u32(mask + 4), vld1q_u32(block.Words + 4));
+  return (vmaxvq_u32(vorrq_u32(missingLow, missingHigh)) == 0);
+#else
+  uint32 missing = 0;
+  for (uint32 i = 0; i < 8; i++)
+    missing |= mask[i] & ~block.Words[i];
+  return (missing == 0);
+#endif
+}
@@ -0,0 +1,500 @@
+#include "YBaseLib/BufferedByteStream.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/TaskQueue.h"
+#include <cstring>
+
+BufferedByteStream::BufferedByteStream(ByteStream* pStream, TaskQueue* pTaskQueue,
+                                       uint32 bufferSize /* = DefaultBufferSize */,
+                                       uint32 bufferCount /* = DefaultBufferCount */)
+  : m_pStream(pStream), m_pTaskQueue(pTaskQueue), m_pBuffers(nullptr), m_bufferSize(bufferSize),
+    m_bufferCount(bufferCount), m_mode(MODE_NONE), m_position(pStream->GetPosition()), m_size(pStream->GetSize()),
+    m_pCurrentData(nullptr), m_currentOffset(0), m_currentPosition(0), m_currentSize(0), m_holdingBuffer(false),
+    m_head(0), m_queuedCount(0), m_pumpOffset(0), m_pumpActive(false), m_pumpStopping(false), m_endOfStream(false),
+    m_pumpError(false)
+{
+  DebugAssert(bufferSize > 0 && bufferCount >= 2);
+  m_pStream->AddRef();
+
+  m_pBuffers = new Buffer[bufferCount];
+  for (uint32 i = 0; i < bufferCount; i++)
+  {
+    m_pBuffers[i].pData = (byte*)Y_malloc(bufferSize);
+    m_pBuffers[i].Offset = 0;
+    m_pBuffers[i].Size = 0;
+  }
+}
+
+BufferedByteStream::~BufferedByteStream()
+{
+  if (m_mode == MODE_WRITE)
+  {
+    DrainWrites();
+  }
+  else if (m_mode == MODE_READ)
+  {
+    m_lock.Lock();
+    StopPumpLocked();
+    m_lock.Unlock();
+  }
+
+  for (uint32 i = 0; i < m_bufferCount; i++)
+    Y_free(m_pBuffers[i].pData);
+  delete[] m_pBuffers;
+
+  m_pStream->Release();
+}
+
+bool BufferedByteStream::NeedsPump() const
+{
+  if (m_pumpActive || m_pumpStopping || m_pumpError)
+    return false;
+
+  if (m_mode == MODE_WRITE)
+    return (m_queuedCount > 0);
+  else
+    return (m_mode == MODE_READ && !m_endOfStream && m_queuedCount < m_bufferCount);
+}
+
+void BufferedByteStream::StartPump()
+{
+  if (m_pTaskQueue != nullptr)
+    m_pTaskQueue->QueueLambdaTask([this]() { Pump(); });
+  else
+    Pump();
+}
+
+void BufferedByteStream::StopPumpLocked()
+{
+  m_pumpStopping = true;
+  while (m_pumpActive)
+    m_conditionVariable.SleepAndRelease(&m_lock);
+  m_pumpStopping = false;
+}
+
+void BufferedByteStream::Pump()
+{
+  m_lock.Lock();
+  while (!m_pumpStopping && !m_pumpError)
+  {
+    if (m_mode == MODE_WRITE)
+    {
+      if (m_queuedCount == 0)
+        break;
+
+      // the writer never touches queued buffers, so the lock isn't needed while writing
+      Buffer& buffer = m_pBuffers[m_head];
+      m_lock.Unlock();
+      bool result = m_pStream->Write2(buffer.pData, buffer.Size);
+      m_lock.Lock();
+
+      m_head = (m_head + 1) % m_bufferCount;
+      m_queuedCount--;
+      m_pumpError = !result;
+    }
+    else
+    {
+      if (m_endOfStream || m_queuedCount == m_bufferCount)
+        break;
+
+      // the slot after the filled ones isn't the reader's until it's counted
+      Buffer& buffer = m_pBuffers[(m_head + m_queuedCount) % m_bufferCount];
+      buffer.Offset = m_pumpOffset;
+      m_lock.Unlock();
+      uint32 size = m_pStream->Read(buffer.pData, m_bufferSize);
+      bool error = m_pStream->InErrorState();
+      m_lock.Lock();
+
+      buffer.Size = size;
+      m_pumpOffset += size;
+      m_queuedCount++;
+      m_endOfStream = (size < m_bufferSize);
+      m_pumpError = error;
+    }
+
+    m_conditionVariable.WakeAll();
+  }
+
+  m_pumpActive = false;
+  m_conditionVariable.WakeAll();
+  m_lock.Unlock();
+}
+
+bool BufferedByteStream::NextReadBuffer()
+{
+  m_lock.Lock();
+  if (m_holdingBuffer)
+  {
+    m_head = (m_head + 1) % m_bufferCount;
+    m_queuedCount--;
+    m_holdingBuffer = false;
+  }
+
+  while (m_queuedCount == 0)
+  {
+    if (m_endOfStream || m_pumpError)
+    {
+      if (m_pumpError)
+        m_errorState = true;
+
+      m_lock.Unlock();
+      return false;
+    }
+
+    if (!m_pumpActive)
+    {
+      m_pumpActive = true;
+      m_lock.Unlock();
+      StartPump();
+      m_lock.Lock();
+      continue;
+    }
+
+    m_conditionVariable.SleepAndRelease(&m_lock);
+  }
+
+  const Buffer& buffer = m_pBuffers[m_head];
+  m_pCurrentData = buffer.pData;
+  m_currentOffset = buffer.Offset;
+  m_currentSize = buffer.Size;
+  m_currentPosition = (uint32)(m_position - buffer.Offset);
+  m_holdingBuffer = true;
+
+  // keep reading ahead into the slot that was just freed
+  bool startPump = NeedsPump();
+  m_pumpActive |= startPump;
+  m_lock.Unlock();
+  if (startPump)
+    StartPump();
+
+  return true;
+}
+
+bool BufferedByteStream::SubmitWriteBuffer()
+{
+  m_lock.Lock();
+  Buffer& buffer = m_pBuffers[(m_head + m_queuedCount) % m_bufferCount];
+  buffer.Offset = m_currentOffset;
+  buffer.Size = m_currentSize;
+  m_queuedCount++;
+  m_holdingBuffer = false;
+
+  bool startPump = NeedsPump();
+  m_pumpActive |= startPump;
+  bool pumpError = m_pumpError;
+  m_lock.Unlock();
+  if (startPump)
+    StartPump();
+
+  if (pumpError)
+  {
+    m_errorState = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool BufferedByteStream::DrainWrites()
+{
+  if (m_holdingBuffer)
+  {
+    if (m_currentSize > 0)
+      SubmitWriteBuffer();
+    else
+      m_holdingBuffer = false;
+  }
+
+  m_lock.Lock();
+  while (m_pumpActive || (m_queuedCount > 0 && !m_pumpError))
+  {
+    if (!m_pumpActive)
+    {
+      m_pumpActive = true;
+      m_lock.Unlock();
+      StartPump();
+      m_lock.Lock();
+      continue;
+    }
+
+    m_conditionVariable.SleepAndRelease(&m_lock);
+  }
+
+  // whatever didn't make it is lost
+  bool pumpError = m_pumpError;
+  m_head = 0;
+  m_queuedCount = 0;
+  m_lock.Unlock();
+  if (pumpError)
+  {
+    m_errorState = true;
+    return false;
+  }
+
+  // a seek back within the last buffer leaves the wrapped stream past the position
+  if (m_pStream->GetPosition() != m_position && !m_pStream->SeekAbsolute(m_position))
+  {
+    m_errorState = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool BufferedByteStream::DropReadAhead()
+{
+  m_lock.Lock();
+  StopPumpLocked();
+  m_head = 0;
+  m_queuedCount = 0;
+  m_endOfStream = false;
+  m_holdingBuffer = false;
+  m_pumpOffset = m_position;
+  bool pumpError = m_pumpError;
+  m_lock.Unlock();
+  if (pumpError)
+  {
+    m_errorState = true;
+    return false;
+  }
+
+  return (m_pStream->GetPosition() == m_position || m_pStream->SeekAbsolute(m_position));
+}
+
+bool BufferedByteStream::EnterMode(MODE mode)
+{
+  if (m_mode == mode)
+    return true;
+
+  if (m_mode == MODE_WRITE && !DrainWrites())
+    return false;
+  if (m_mode == MODE_READ && !DropReadAhead())
+    return false;
+
+  m_mode = mode;
+  m_pumpOffset = m_position;
+  m_endOfStream = false;
+  return true;
+}
+
+bool BufferedByteStream::ReadByte(byte* pDestByte)
+{
+  if (m_holdingBuffer && m_mode == MODE_READ && m_currentPosition < m_currentSize && !m_errorState)
+  {
+    *pDestByte = m_pCurrentData[m_currentPosition++];
+    m_position++;
+    return true;
+  }
+
+  return Read2(pDestByte, 1);
+}
+
+uint32 BufferedByteStream::Read(void* pDestination, uint32 ByteCount)
+{
+  if (m_errorState || !EnterMode(MODE_READ))
+    return 0;
+
+  byte* pDestinationBytes = reinterpret_cast<byte*>(pDestination);
+  uint32 bytesRead = 0;
+  while (bytesRead < ByteCount)
+  {
+    if (!m_holdingBuffer || m_currentPosition == m_currentSize)
+    {
+      if (!NextReadBuffer())
+        break;
+
+      continue;
+    }
+
+    uint32 count = Min(ByteCount - bytesRead, m_currentSize - m_currentPosition);
+    std::memcpy(pDestinationBytes + bytesRead, m_pCurrentData + m_currentPosition, count);
+    m_currentPosition += count;
+    m_position += count;
+    bytesRead += count;
+  }
+
+  return bytesRead;
+}
+
+bool BufferedByteStream::Read2(void* pDestination, uint32 ByteCount, uint32* pNumberOfBytesRead /* = nullptr */)
+{
+  uint32 bytesRead = Read(pDestination, ByteCount);
+  if (pNumberOfBytesRead != nullptr)
+    *pNumberOfBytesRead = bytesRead;
+
+  if (bytesRead != ByteCount)
+  {
+    m_errorState = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool BufferedByteStream::WriteByte(byte SourceByte)
+{
+  if (m_holdingBuffer && m_mode == MODE_WRITE && m_currentPosition + 1 < m_bufferSize && !m_errorState)
+  {
+    m_pCurrentData[m_currentPosition++] = SourceByte;
+    m_currentSize = Max(m_currentSize, m_currentPosition);
+    m_position++;
+    m_size = Max(m_size, m_position);
+    return true;
+  }
+
+  return Write2(&SourceByte, 1);
+}
+
+uint32 BufferedByteStream::Write(const void* pSource, uint32 ByteCount)
+{
+  if (m_errorState || !EnterMode(MODE_WRITE))
+    return 0;
+
+  const byte* pSourceBytes = reinterpret_cast<const byte*>(pSource);
+  uint32 bytesWritten = 0;
+  while (bytesWritten < ByteCount)
+  {
+    if (!m_holdingBuffer)
+    {
+      // the next free buffer, once the pump has written one out if they're all full
+      m_lock.Lock();
+      while (m_queuedCount == m_bufferCount && !m_pumpError)
+        m_conditionVariable.SleepAndRelease(&m_lock);
+      bool pumpError = m_pumpError;
+      m_pCurrentData = m_pBuffers[(m_head + m_queuedCount) % m_bufferCount].pData;
+      m_lock.Unlock();
+      if (pumpError)
+      {
+        m_errorState = true;
+        break;
+      }
+
+      m_currentOffset = m_position;
+      m_currentPosition = 0;
+      m_currentSize = 0;
+      m_holdingBuffer = true;
+    }
+
+    uint32 count = Min(ByteCount - bytesWritten, m_bufferSize - m_currentPosition);
+    std::memcpy(m_pCurrentData + m_currentPosition, pSourceBytes + bytesWritten, count);
+    m_currentPosition += count;
+    m_currentSize = Max(m_currentSize, m_currentPosition);
+    m_position += count;
+    bytesWritten += count;
+
+    if (m_currentPosition == m_bufferSize && !SubmitWriteBuffer())
+      break;
+  }
+
+  m_size = Max(m_size, m_position);
+  return bytesWritten;
+}
+
+bool BufferedByteStream::Write2(const void* pSource, uint32 ByteCount, uint32* pNumberOfBytesWritten /* = nullptr */)
+{
+  uint32 bytesWritten = Write(pSource, ByteCount);
+  if (pNumberOfBytesWritten != nullptr)
+    *pNumberOfBytesWritten = bytesWritten;
+
+  if (bytesWritten != ByteCount)
+  {
+    m_errorState = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool BufferedByteStream::SeekAbsolute(uint64 Offset)
+{
+  if (m_errorState)
+    return false;
+
+  // within the buffer being read or written
+  if (m_holdingBuffer && Offset >= m_currentOffset && Offset <= m_currentOffset + m_currentSize)
+  {
+    m_currentPosition = (uint32)(Offset - m_currentOffset);
+    m_position = Offset;
+    return true;
+  }
+
+  if (m_mode == MODE_WRITE && !DrainWrites())
+    return false;
+  if (m_mode == MODE_READ && !DropReadAhead())
+    return false;
+
+  if (!m_pStream->SeekAbsolute(Offset))
+  {
+    m_errorState = m_pStream->InErrorState();
+    return false;
+  }
+
+  m_position = Offset;
+  m_pumpOffset = Offset;
+  return true;
+}
+
+bool BufferedByteStream::SeekRelative(int64 Offset)
+{
+  if (Offset < 0 && (uint64)-Offset > m_position)
+    return false;
+
+  return SeekAbsolute(m_position + Offset);
+}
+
+bool BufferedByteStream::SeekToEnd()
+{
+  return SeekAbsolute(m_size);
+}
+
+bool BufferedByteStream::Flush()
+{
+  if (m_errorState)
+    return false;
+
+  if (m_mode == MODE_WRITE && !DrainWrites())
+    return false;
+
+  // buffers read ahead are kept, the pump carries on with the next read
+  if (m_mode == MODE_READ)
+  {
+    m_lock.Lock();
+    StopPumpLocked();
+    m_lock.Unlock();
+  }
+
+  return m_pStream->Flush();
+}
+
+bool BufferedByteStream::Discard()
+{
+  // nothing more is written, what's gathered is thrown away
+  m_lock.Lock();
+  StopPumpLocked();
+  m_head = 0;
+  m_queuedCount = 0;
+  m_endOfStream = false;
+  m_lock.Unlock();
+  m_holdingBuffer = false;
+  m_mode = MODE_NONE;
+
+  return m_pStream->Discard();
+}
+
+bool BufferedByteStream::Commit()
+{
+  if (m_errorState)
+    return false;
+
+  if (m_mode == MODE_WRITE && !DrainWrites())
+    return false;
+
+  if (m_mode == MODE_READ)
+  {
+    m_lock.Lock();
+    StopPumpLocked();
+    m_lock.Unlock();
+  }
+
+  return m_pStream->Commit();
+}
@@ -1,8 +1,13 @@
 #include "YBaseLib/ByteStream.h"
 #include "YBaseLib/Assert.h"
+#include "YBaseLib/ConditionVariable.h"
 #include "YBaseLib/Log.h"
 #include "YBaseLib/Memory.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/MutexLock.h"
 #include "YBaseLib/String.h"
+#include "YBaseLib/Thread.h"
+#include "YBaseLib/UnicodeConversion.h"
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
@@ -12,8 +17,20 @@
 #include <io.h>
 #include <share.h>
 #else
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#if defined(Y_PLATFORM_LINUX)
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#if !defined(FICLONE)
+#define FICLONE _IOW(0x94, 9, int)
+#endif
 #endif
 
 Log_SetChannel(ByteStream);
@@ -245,6 +262,19 @@ public:
 
   virtual bool Discard() override { return false; }
 
+  virtual bool GetFileDescriptor(int* pFileDescriptor) override
+  {
+    if (m_errorState || fflush(m_pFile) != 0)
+      return false;
+
+#if defined(Y_PLATFORM_WINDOWS)
+    *pFileDescriptor = _fileno(m_pFile);
+#else
+    *pFileDescriptor = fileno(m_pFile);
+#endif
+    return true;
+  }
+
 protected:
   FILE* m_pFile;
 };
@@ -264,7 +294,7 @@ public:
     {
 #if Y_PLATFORM_WINDOWS
       // delete the temporary file
-      if (!DeleteFileA(m_temporaryFileName))
+      if (!DeleteFileW(UTF16StackString<MAX_PATH>(m_temporaryFileName).GetWideCharArray()))
         Log_WarningPrintf(
           "AtomicUpdatedFileByteStream::~AtomicUpdatedFileByteStream(): Failed to delete temporary file '%s'",
           m_temporaryFileName.GetCharArray());
@@ -305,7 +335,10 @@ public:
 
 #ifdef Y_PLATFORM_WINDOWS
     // move the atomic file name to the original file name
-    if (!MoveFileExA(m_temporaryFileName, m_originalFileName, MOVEFILE_REPLACE_EXISTING))
+    UTF16StackString<MAX_PATH> wideTemporaryFileName(m_temporaryFileName);
+    UTF16StackString<MAX_PATH> wideOriginalFileName(m_originalFileName);
+    if (!MoveFileExW(wideTemporaryFileName.GetWideCharArray(), wideOriginalFileName.GetWideCharArray(),
+                     MOVEFILE_REPLACE_EXISTING))
     {
       Log_WarningPrintf("AtomicUpdatedFileByteStream::Commit(): Failed to rename temporary file '%s' to '%s'",
                         m_temporaryFileName.GetCharArray(), m_originalFileName.GetCharArray());
@@ -346,6 +379,73 @@ private:
   String m_temporaryFileName;
 };
 
+uint64 ByteStream::Read64(void* pDestination, uint64 ByteCount)
+{
+  // in chunks that Read can report the size of
+  const uint64 chunkSize = 0x40000000;
+  uint64 bytesRead = 0;
+  while (bytesRead < ByteCount)
+  {
+    uint32 count = (uint32)Min(ByteCount - bytesRead, chunkSize);
+    uint32 chunkRead = Read(reinterpret_cast<byte*>(pDestination) + bytesRead, count);
+    bytesRead += chunkRead;
+    if (chunkRead != count)
+      break;
+  }
+
+  return bytesRead;
+}
+
+uint64 ByteStream::Write64(const void* pSource, uint64 ByteCount)
+{
+  const uint64 chunkSize = 0x40000000;
+  uint64 bytesWritten = 0;
+  while (bytesWritten < ByteCount)
+  {
+    uint32 count = (uint32)Min(ByteCount - bytesWritten, chunkSize);
+    uint32 chunkWritten = Write(reinterpret_cast<const byte*>(pSource) + bytesWritten, count);
+    bytesWritten += chunkWritten;
+    if (chunkWritten != count)
+      break;
+  }
+
+  return bytesWritten;
+}
+
+uint32 ByteStream::GetViewFlags() const
+{
+  return (GetBasePointer() != nullptr) ? BYTESTREAM_VIEW_READ : 0;
+}
+
+uint32 ByteStream::AcquireReadView(uint32 maxSize, const void** ppData)
+{
+  const byte* pBase = GetBasePointer();
+  *ppData = nullptr;
+  if (pBase == nullptr || m_errorState)
+    return 0;
+
+  uint64 position = GetPosition();
+  *ppData = pBase + position;
+  return (uint32)Min((uint64)maxSize, GetSize() - position);
+}
+
+void ByteStream::ReleaseReadView(uint32 bytesConsumed)
+{
+  if (bytesConsumed > 0)
+    SeekRelative(bytesConsumed);
+}
+
+uint32 ByteStream::AcquireWriteView(uint32 size, void** ppData)
+{
+  *ppData = nullptr;
+  return 0;
+}
+
+void ByteStream::ReleaseWriteView(uint32 bytesWritten)
+{
+  DebugAssert(bytesWritten == 0);
+}
+
 NullByteStream::NullByteStream() {}
 
 NullByteStream::~NullByteStream() {}
@@ -430,7 +530,7 @@ bool NullByteStream::Discard()
   return true;
 }
 
-MemoryByteStream::MemoryByteStream(void* pMemory, uint32 MemSize)
+MemoryByteStream::MemoryByteStream(void* pMemory, size_t MemSize)
 {
   m_iPosition = 0;
   m_iSize = MemSize;
@@ -452,10 +552,12 @@ bool MemoryByteStream::ReadByte(byte* pDestByte)
 
 uint32 MemoryByteStream::Read(void* pDestination, uint32 ByteCount)
 {
-  uint32 sz = ByteCount;
-  if ((m_iPosition + ByteCount) > m_iSize)
-    sz = m_iSize - m_iPosition;
+  return (uint32)Read64(pDestination, ByteCount);
+}
 
+uint64 MemoryByteStream::Read64(void* pDestination, uint64 ByteCount)
+{
+  size_t sz = (size_t)Min(ByteCount, (uint64)(m_iSize - m_iPosition));
   if (sz > 0)
   {
     std::memcpy(pDestination, m_pMemory + m_iPosition, sz);
@@ -478,7 +580,7 @@ bool MemoryByteStream::WriteByte(byte SourceByte)
 {
   if (m_iPosition < m_iSize)
   {
-    m_pMemory[m_iSize++] = SourceByte;
+    m_pMemory[m_iPosition++] = SourceByte;
     return true;
   }
 
@@ -487,10 +589,12 @@ bool MemoryByteStream::WriteByte(byte SourceByte)
 
 uint32 MemoryByteStream::Write(const void* pSource, uint32 ByteCount)
 {
-  uint32 sz = ByteCount;
-  if ((m_iPosition + ByteCount) > m_iSize)
-    sz = m_iSize - m_iPosition;
+  return (uint32)Write64(pSource, ByteCount);
+}
 
+uint64 MemoryByteStream::Write64(const void* pSource, uint64 ByteCount)
+{
+  size_t sz = (size_t)Min(ByteCount, (uint64)(m_iSize - m_iPosition));
   if (sz > 0)
   {
     std::memcpy(m_pMemory + m_iPosition, pSource, sz);
@@ -509,23 +613,36 @@ bool MemoryByteStream::Write2(const void* pSource, uint32 ByteCount, uint32* pNu
   return (r == ByteCount);
 }
 
+uint32 MemoryByteStream::AcquireWriteView(uint32 size, void** ppData)
+{
+  *ppData = m_pMemory + m_iPosition;
+  return (uint32)Min((size_t)size, m_iSize - m_iPosition);
+}
+
+void MemoryByteStream::ReleaseWriteView(uint32 bytesWritten)
+{
+  DebugAssert(bytesWritten <= m_iSize - m_iPosition);
+  m_iPosition += bytesWritten;
+}
+
 bool MemoryByteStream::SeekAbsolute(uint64 Offset)
 {
-  uint32 Offset32 = (uint32)Offset;
-  if (Offset32 > m_iSize)
+  if (Offset > (uint64)m_iSize)
     return false;
 
-  m_iPosition = Offset32;
+  m_iPosition = (size_t)Offset;
   return true;
 }
 
 bool MemoryByteStream::SeekRelative(int64 Offset)
 {
-  int32 Offset32 = (int32)Offset;
-  if ((Offset32 < 0 && -Offset32 > (int32)m_iPosition) || (uint32)((int32)m_iPosition + Offset32) > m_iSize)
+  if ((Offset < 0 && (uint64)-Offset > (uint64)m_iPosition) ||
+      (Offset > 0 && (uint64)Offset > (uint64)(m_iSize - m_iPosition)))
+  {
     return false;
+  }
 
-  m_iPosition += Offset32;
+  m_iPosition = (size_t)((int64)m_iPosition + Offset);
   return true;
 }
 
@@ -560,7 +677,7 @@ bool MemoryByteStream::Discard()
   return false;
 }
 
-ReadOnlyMemoryByteStream::ReadOnlyMemoryByteStream(const void* pMemory, uint32 MemSize)
+ReadOnlyMemoryByteStream::ReadOnlyMemoryByteStream(const void* pMemory, size_t MemSize)
 {
   m_iPosition = 0;
   m_iSize = MemSize;
@@ -569,6 +686,14 @@ ReadOnlyMemoryByteStream::ReadOnlyMemoryByteStream(const void* pMemory, uint32 M
 
 ReadOnlyMemoryByteStream::~ReadOnlyMemoryByteStream() {}
 
+void ReadOnlyMemoryByteStream::SetMemory(const void* pMemory, size_t MemSize)
+{
+  m_pMemory = reinterpret_cast<const byte*>(pMemory);
+  m_iSize = MemSize;
+  m_iPosition = 0;
+  ClearErrorState();
+}
+
 bool ReadOnlyMemoryByteStream::ReadByte(byte* pDestByte)
 {
   if (m_iPosition < m_iSize)
@@ -582,10 +707,12 @@ bool ReadOnlyMemoryByteStream::ReadByte(byte* pDestByte)
 
 uint32 ReadOnlyMemoryByteStream::Read(void* pDestination, uint32 ByteCount)
 {
-  uint32 sz = ByteCount;
-  if ((m_iPosition + ByteCount) > m_iSize)
-    sz = m_iSize - m_iPosition;
+  return (uint32)Read64(pDestination, ByteCount);
+}
 
+uint64 ReadOnlyMemoryByteStream::Read64(void* pDestination, uint64 ByteCount)
+{
+  size_t sz = (size_t)Min(ByteCount, (uint64)(m_iSize - m_iPosition));
   if (sz > 0)
   {
     std::memcpy(pDestination, m_pMemory + m_iPosition, sz);
@@ -614,6 +741,11 @@ uint32 ReadOnlyMemoryByteStream::Write(const void* pSource, uint32 ByteCount)
   return 0;
 }
 
+uint64 ReadOnlyMemoryByteStream::Write64(const void* pSource, uint64 ByteCount)
+{
+  return 0;
+}
+
 bool ReadOnlyMemoryByteStream::Write2(const void* pSource, uint32 ByteCount,
                                       uint32* pNumberOfBytesWritten /* = nullptr */)
 {
@@ -622,21 +754,22 @@ bool ReadOnlyMemoryByteStream::Write2(const void* pSource, uint32 ByteCount,
 
 bool ReadOnlyMemoryByteStream::SeekAbsolute(uint64 Offset)
 {
-  uint32 Offset32 = (uint32)Offset;
-  if (Offset32 > m_iSize)
+  if (Offset > (uint64)m_iSize)
     return false;
 
-  m_iPosition = Offset32;
+  m_iPosition = (size_t)Offset;
   return true;
 }
 
 bool ReadOnlyMemoryByteStream::SeekRelative(int64 Offset)
 {
-  int32 Offset32 = (int32)Offset;
-  if ((Offset32 < 0 && -Offset32 > (int32)m_iPosition) || (uint32)((int32)m_iPosition + Offset32) > m_iSize)
+  if ((Offset < 0 && (uint64)-Offset > (uint64)m_iPosition) ||
+      (Offset > 0 && (uint64)Offset > (uint64)(m_iSize - m_iPosition)))
+  {
     return false;
+  }
 
-  m_iPosition += Offset32;
+  m_iPosition = (size_t)((int64)m_iPosition + Offset);
   return true;
 }
 
@@ -671,7 +804,7 @@ bool ReadOnlyMemoryByteStream::Discard()
   return false;
 }
 
-GrowableMemoryByteStream::GrowableMemoryByteStream(void* pInitialMem, uint32 InitialMemSize)
+GrowableMemoryByteStream::GrowableMemoryByteStream(void* pInitialMem, size_t InitialMemSize)
 {
   m_iPosition = 0;
   m_iSize = 0;
@@ -684,7 +817,7 @@ GrowableMemoryByteStream::GrowableMemoryByteStream(void* pInitialMem, uint32 Ini
   }
   else
   {
-    m_iMemorySize = Max(InitialMemSize, (uint32)64);
+    m_iMemorySize = Max(InitialMemSize, (size_t)64);
     m_pPrivateMemory = m_pMemory = (byte*)std::malloc(m_iMemorySize);
   }
 }
@@ -708,10 +841,12 @@ bool GrowableMemoryByteStream::ReadByte(byte* pDestByte)
 
 uint32 GrowableMemoryByteStream::Read(void* pDestination, uint32 ByteCount)
 {
-  uint32 sz = ByteCount;
-  if ((m_iPosition + ByteCount) > m_iSize)
-    sz = m_iSize - m_iPosition;
+  return (uint32)Read64(pDestination, ByteCount);
+}
 
+uint64 GrowableMemoryByteStream::Read64(void* pDestination, uint64 ByteCount)
+{
+  size_t sz = (size_t)Min(ByteCount, (uint64)(m_iSize - m_iPosition));
   if (sz > 0)
   {
     std::memcpy(pDestination, m_pMemory + m_iPosition, sz);
@@ -742,13 +877,23 @@ bool GrowableMemoryByteStream::WriteByte(byte SourceByte)
 
 uint32 GrowableMemoryByteStream::Write(const void* pSource, uint32 ByteCount)
 {
-  if ((m_iPosition + ByteCount) > m_iMemorySize)
-    Grow(ByteCount);
+  return (uint32)Write64(pSource, ByteCount);
+}
+
+uint64 GrowableMemoryByteStream::Write64(const void* pSource, uint64 ByteCount)
+{
+  // more than the address space can never fit
+  if (ByteCount > (uint64)(SIZE_MAX - m_iPosition))
+    return 0;
+
+  size_t sz = (size_t)ByteCount;
+  if ((m_iPosition + sz) > m_iMemorySize)
+    Grow(sz);
 
-  std::memcpy(m_pMemory + m_iPosition, pSource, ByteCount);
-  m_iPosition += ByteCount;
+  std::memcpy(m_pMemory + m_iPosition, pSource, sz);
+  m_iPosition += sz;
   m_iSize = Max(m_iSize, m_iPosition);
-  return ByteCount;
+  return sz;
 }
 
 bool GrowableMemoryByteStream::Write2(const void* pSource, uint32 ByteCount,
@@ -761,23 +906,40 @@ bool GrowableMemoryByteStream::Write2(const void* pSource, uint32 ByteCount,
   return (r == ByteCount);
 }
 
+uint32 GrowableMemoryByteStream::AcquireWriteView(uint32 size, void** ppData)
+{
+  if ((m_iPosition + size) > m_iMemorySize)
+    Grow(size);
+
+  *ppData = m_pMemory + m_iPosition;
+  return size;
+}
+
+void GrowableMemoryByteStream::ReleaseWriteView(uint32 bytesWritten)
+{
+  DebugAssert(bytesWritten <= m_iMemorySize - m_iPosition);
+  m_iPosition += bytesWritten;
+  m_iSize = Max(m_iSize, m_iPosition);
+}
+
 bool GrowableMemoryByteStream::SeekAbsolute(uint64 Offset)
 {
-  uint32 Offset32 = (uint32)Offset;
-  if (Offset32 > m_iSize)
+  if (Offset > (uint64)m_iSize)
     return false;
 
-  m_iPosition = Offset32;
+  m_iPosition = (size_t)Offset;
   return true;
 }
 
 bool GrowableMemoryByteStream::SeekRelative(int64 Offset)
 {
-  int32 Offset32 = (int32)Offset;
-  if ((Offset32 < 0 && -Offset32 > (int32)m_iPosition) || (uint32)((int32)m_iPosition + Offset32) > m_iSize)
+  if ((Offset < 0 && (uint64)-Offset > (uint64)m_iPosition) ||
+      (Offset > 0 && (uint64)Offset > (uint64)(m_iSize - m_iPosition)))
+  {
     return false;
+  }
 
-  m_iPosition += Offset32;
+  m_iPosition = (size_t)((int64)m_iPosition + Offset);
   return true;
 }
 
@@ -812,9 +974,9 @@ bool GrowableMemoryByteStream::Discard()
   return false;
 }
 
-void GrowableMemoryByteStream::Grow(uint32 MinimumGrowth)
+void GrowableMemoryByteStream::Grow(size_t MinimumGrowth)
 {
-  uint32 NewSize = Max(m_iMemorySize + MinimumGrowth, m_iMemorySize * 2);
+  size_t NewSize = Max(m_iMemorySize + MinimumGrowth, m_iMemorySize * 2);
   if (m_pPrivateMemory == nullptr)
   {
     m_pPrivateMemory = (byte*)std::malloc(NewSize);
@@ -829,97 +991,1053 @@ void GrowableMemoryByteStream::Grow(uint32 MinimumGrowth)
   }
 }
 
-#if defined(Y_PLATFORM_WINDOWS)
+SegmentedMemoryByteStream::SegmentedMemoryByteStream(uint32 segmentSize /* = DefaultSegmentSize */)
+  : m_segmentSize(segmentSize), m_segmentShift(0), m_iPosition(0), m_iSize(0)
+{
+  DebugAssert(segmentSize > 0 && (segmentSize & (segmentSize - 1)) == 0);
+  while ((UINT32_C(1) << m_segmentShift) < segmentSize)
+    m_segmentShift++;
+}
 
-bool ByteStream_OpenFileStream(const char* fileName, uint32 openMode, ByteStream** ppReturnPointer)
+SegmentedMemoryByteStream::~SegmentedMemoryByteStream()
 {
-  if ((openMode & (BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE)) == BYTESTREAM_OPEN_WRITE)
+  for (uint32 i = 0; i < m_segments.GetSize(); i++)
+    Y_free(m_segments[i]);
+}
+
+bool SegmentedMemoryByteStream::ReadByte(byte* pDestByte)
+{
+  if (m_iPosition < m_iSize)
   {
-    // if opening with write but not create, the path must exist.
-    if (GetFileAttributes(fileName) == INVALID_FILE_ATTRIBUTES)
-      return false;
+    *pDestByte = m_segments[(uint32)(m_iPosition >> m_segmentShift)][m_iPosition & (m_segmentSize - 1)];
+    m_iPosition++;
+    return true;
   }
 
-  char modeString[16];
-  uint32 modeStringLength = 0;
+  return false;
+}
 
-  if (openMode & BYTESTREAM_OPEN_WRITE)
-  {
-    // if the file exists, use r+, otherwise w+
-    // HACK: if we're not truncating, and the file exists (we want to only update it), we still have to use r+
-    if ((openMode & BYTESTREAM_OPEN_TRUNCATE) || GetFileAttributes(fileName) == INVALID_FILE_ATTRIBUTES)
-    {
-      modeString[modeStringLength++] = 'w';
-      if (openMode & BYTESTREAM_OPEN_READ)
-        modeString[modeStringLength++] = '+';
-    }
-    else
-    {
-      modeString[modeStringLength++] = 'r';
-      modeString[modeStringLength++] = '+';
-    }
+uint32 SegmentedMemoryByteStream::Read(void* pDestination, uint32 ByteCount)
+{
+  return (uint32)Read64(pDestination, ByteCount);
+}
 
-    modeString[modeStringLength++] = 'b';
+uint64 SegmentedMemoryByteStream::Read64(void* pDestination, uint64 ByteCount)
+{
+  size_t sz = (size_t)Min(ByteCount, (uint64)(m_iSize - m_iPosition));
+  byte* pDestinationBytes = reinterpret_cast<byte*>(pDestination);
+  size_t remaining = sz;
+  while (remaining > 0)
+  {
+    size_t segmentOffset = m_iPosition & (m_segmentSize - 1);
+    size_t count = Min(remaining, (size_t)m_segmentSize - segmentOffset);
+    std::memcpy(pDestinationBytes, m_segments[(uint32)(m_iPosition >> m_segmentShift)] + segmentOffset, count);
+    pDestinationBytes += count;
+    m_iPosition += count;
+    remaining -= count;
   }
-  else if (openMode & BYTESTREAM_OPEN_READ)
+
+  return sz;
+}
+
+bool SegmentedMemoryByteStream::Read2(void* pDestination, uint32 ByteCount,
+                                      uint32* pNumberOfBytesRead /* = nullptr */)
+{
+  uint32 r = Read(pDestination, ByteCount);
+  if (pNumberOfBytesRead != nullptr)
+    *pNumberOfBytesRead = r;
+
+  return (r == ByteCount);
+}
+
+bool SegmentedMemoryByteStream::WriteByte(byte SourceByte)
+{
+  EnsureSegments(m_iPosition);
+  m_segments[(uint32)(m_iPosition >> m_segmentShift)][m_iPosition & (m_segmentSize - 1)] = SourceByte;
+  m_iPosition++;
+  m_iSize = Max(m_iSize, m_iPosition);
+  return true;
+}
+
+uint32 SegmentedMemoryByteStream::Write(const void* pSource, uint32 ByteCount)
+{
+  return (uint32)Write64(pSource, ByteCount);
+}
+
+uint64 SegmentedMemoryByteStream::Write64(const void* pSource, uint64 ByteCount)
+{
+  // more than the address space can never fit
+  if (ByteCount > (uint64)(SIZE_MAX - m_iPosition))
+    return 0;
+
+  size_t sz = (size_t)ByteCount;
+  if (sz == 0)
+    return 0;
+
+  EnsureSegments(m_iPosition + sz - 1);
+
+  const byte* pSourceBytes = reinterpret_cast<const byte*>(pSource);
+  size_t remaining = sz;
+  while (remaining > 0)
   {
-    modeString[modeStringLength++] = 'r';
-    modeString[modeStringLength++] = 'b';
+    size_t segmentOffset = m_iPosition & (m_segmentSize - 1);
+    size_t count = Min(remaining, (size_t)m_segmentSize - segmentOffset);
+    std::memcpy(m_segments[(uint32)(m_iPosition >> m_segmentShift)] + segmentOffset, pSourceBytes, count);
+    pSourceBytes += count;
+    m_iPosition += count;
+    remaining -= count;
   }
 
-  // doesn't work with _fdopen
-  if (!(openMode & BYTESTREAM_OPEN_ATOMIC_UPDATE))
+  m_iSize = Max(m_iSize, m_iPosition);
+  return sz;
+}
+
+bool SegmentedMemoryByteStream::Write2(const void* pSource, uint32 ByteCount,
+                                       uint32* pNumberOfBytesWritten /* = nullptr */)
+{
+  uint32 r = Write(pSource, ByteCount);
+  if (pNumberOfBytesWritten != nullptr)
+    *pNumberOfBytesWritten = r;
+
+  return (r == ByteCount);
+}
+
+bool SegmentedMemoryByteStream::SeekAbsolute(uint64 Offset)
+{
+  if (Offset > (uint64)m_iSize)
+    return false;
+
+  m_iPosition = (size_t)Offset;
+  return true;
+}
+
+bool SegmentedMemoryByteStream::SeekRelative(int64 Offset)
+{
+  if ((Offset < 0 && (uint64)-Offset > (uint64)m_iPosition) ||
+      (Offset > 0 && (uint64)Offset > (uint64)(m_iSize - m_iPosition)))
   {
-    if (openMode & BYTESTREAM_OPEN_STREAMED)
-      modeString[modeStringLength++] = 'S';
-    else if (openMode & BYTESTREAM_OPEN_SEEKABLE)
-      modeString[modeStringLength++] = 'R';
+    return false;
   }
 
-  modeString[modeStringLength] = 0;
+  m_iPosition = (size_t)((int64)m_iPosition + Offset);
+  return true;
+}
 
-  if (openMode & BYTESTREAM_OPEN_CREATE_PATH)
+bool SegmentedMemoryByteStream::SeekToEnd()
+{
+  m_iPosition = m_iSize;
+  return true;
+}
+
+uint64 SegmentedMemoryByteStream::GetSize() const
+{
+  return (uint64)m_iSize;
+}
+
+uint64 SegmentedMemoryByteStream::GetPosition() const
+{
+  return (uint64)m_iPosition;
+}
+
+bool SegmentedMemoryByteStream::Flush()
+{
+  return true;
+}
+
+bool SegmentedMemoryByteStream::Commit()
+{
+  return true;
+}
+
+bool SegmentedMemoryByteStream::Discard()
+{
+  return false;
+}
+
+void SegmentedMemoryByteStream::Clear()
+{
+  m_iPosition = 0;
+  m_iSize = 0;
+}
+
+uint32 SegmentedMemoryByteStream::GetBuffers(uint32 firstSegment, const void** ppBuffers, size_t* pBufferLengths,
+                                             uint32 maxBuffers) const
+{
+  uint32 segmentCount = GetSegmentCount();
+  uint32 count = 0;
+  for (uint32 i = firstSegment; i < segmentCount && count < maxBuffers; i++, count++)
   {
-    uint32 i;
-    uint32 fileNameLength = Y_strlen(fileName);
-    char* tempStr = (char*)alloca(fileNameLength + 1);
+    ppBuffers[count] = m_segments[i];
+    pBufferLengths[count] = (i == segmentCount - 1) ? (m_iSize - ((size_t)i << m_segmentShift)) : m_segmentSize;
+  }
 
-    // check if it starts with a drive letter. if so, skip ahead
-    if (fileNameLength >= 2 && fileName[1] == ':')
+  return count;
+}
+
+bool SegmentedMemoryByteStream::WriteToStream(ByteStream* pStream) const
+{
+  static const uint32 BatchSize = 64;
+  const void* pBuffers[BatchSize];
+  size_t bufferLengths[BatchSize];
+  uint32 segmentIndex = 0;
+  uint32 count;
+
+#if !defined(Y_PLATFORM_WINDOWS)
+  // a batch of segments per call straight to the file, then the stream is moved past them
+  int fileDescriptor;
+  if (pStream->GetFileDescriptor(&fileDescriptor))
+  {
+    uint64 startPosition = pStream->GetPosition();
+    uint64 bytesWritten = 0;
+    while ((count = GetBuffers(segmentIndex, pBuffers, bufferLengths, BatchSize)) > 0)
     {
-      if (fileNameLength <= 3)
+      struct iovec vectors[BatchSize];
+      size_t batchLength = 0;
+      for (uint32 i = 0; i < count; i++)
       {
-        // create a file called driveletter: or driveletter:\ ? you must be crazy
-        i = fileNameLength;
+        vectors[i].iov_base = const_cast<void*>(pBuffers[i]);
+        vectors[i].iov_len = bufferLengths[i];
+        batchLength += bufferLengths[i];
       }
-      else
+
+      // short writes pick up where they stopped, through the copying path
+      ssize_t result = writev(fileDescriptor, vectors, (int)count);
+      if (result < 0)
       {
-        std::memcpy(tempStr, fileName, 3);
-        i = 3;
+        if (errno == EINTR)
+          continue;
+
+        break;
       }
+
+      bytesWritten += (uint64)result;
+      if ((size_t)result != batchLength)
+        break;
+
+      segmentIndex += count;
     }
-    else
+
+    if (!pStream->SeekAbsolute(startPosition + bytesWritten))
+      return false;
+    if (bytesWritten == (uint64)m_iSize)
+      return true;
+
+    // carry on from wherever writev stopped
+    size_t offset = (size_t)bytesWritten;
+    while (offset < m_iSize)
     {
-      // start at beginning
-      i = 0;
+      size_t segmentOffset = offset & (m_segmentSize - 1);
+      uint32 length = (uint32)Min(m_iSize - offset, (size_t)m_segmentSize - segmentOffset);
+      if (pStream->Write(m_segments[(uint32)(offset >> m_segmentShift)] + segmentOffset, length) != length)
+        return false;
+
+      offset += length;
     }
 
-    // step through each path component, create folders as necessary
-    for (; i < fileNameLength; i++)
+    return true;
+  }
+#endif
+
+  while ((count = GetBuffers(segmentIndex, pBuffers, bufferLengths, BatchSize)) > 0)
+  {
+    for (uint32 i = 0; i < count; i++)
     {
-      if (i > 0 && (fileName[i] == '\\' || fileName[i] == '/'))
-      {
-        // terminate the string
-        tempStr[i] = '\0';
+      if (pStream->Write(pBuffers[i], (uint32)bufferLengths[i]) != (uint32)bufferLengths[i])
+        return false;
+    }
 
-        // check if it exists
-        struct stat s;
-        if (stat(tempStr, &s) < 0)
+    segmentIndex += count;
+  }
+
+  return true;
+}
+
+void SegmentedMemoryByteStream::EnsureSegments(size_t offset)
+{
+  uint32 segmentCount = (uint32)(offset >> m_segmentShift) + 1;
+  while (m_segments.GetSize() < segmentCount)
+    m_segments.Add(static_cast<byte*>(Y_malloc(m_segmentSize)));
+}
+
+// A whole file mapped read-only. Reads copy straight out of the mapping without going through the C runtime's
+// buffer, and readers that check GetBasePointer don't copy at all.
+class MappedFileByteStream : public ByteStream
+{
+public:
+  MappedFileByteStream(const void* pData, uint64 size)
+    : m_pData(reinterpret_cast<const byte*>(pData)), m_size(size), m_position(0)
+  {
+  }
+
+  virtual ~MappedFileByteStream()
+  {
+#if defined(Y_PLATFORM_WINDOWS)
+    UnmapViewOfFile(m_pData);
+#else
+    munmap(const_cast<byte*>(m_pData), (size_t)m_size);
+#endif
+  }
+
+  virtual bool ReadByte(byte* pDestByte) override
+  {
+    if (m_errorState || m_position == m_size)
+    {
+      m_errorState = true;
+      return false;
+    }
+
+    *pDestByte = m_pData[m_position++];
+    return true;
+  }
+
+  virtual uint32 Read(void* pDestination, uint32 ByteCount) override { return (uint32)Read64(pDestination, ByteCount); }
+
+  virtual uint64 Read64(void* pDestination, uint64 ByteCount) override
+  {
+    if (m_errorState)
+      return 0;
+
+    uint64 count = Min(ByteCount, m_size - m_position);
+    std::memcpy(pDestination, m_pData + m_position, (size_t)count);
+    m_position += count;
+    return count;
+  }
+
+  virtual bool Read2(void* pDestination, uint32 ByteCount, uint32* pNumberOfBytesRead /* = nullptr */) override
+  {
+    uint32 bytesRead = Read(pDestination, ByteCount);
+    if (pNumberOfBytesRead != nullptr)
+      *pNumberOfBytesRead = bytesRead;
+
+    if (bytesRead != ByteCount)
+    {
+      m_errorState = true;
+      return false;
+    }
+
+    return true;
+  }
+
+  virtual bool WriteByte(byte SourceByte) override { return false; }
+  virtual uint32 Write(const void* pSource, uint32 ByteCount) override { return 0; }
+  virtual bool Write2(const void* pSource, uint32 ByteCount, uint32* pNumberOfBytesWritten /* = nullptr */) override
+  {
+    return false;
+  }
+
+  // seeks outside the file fail without affecting the stream, as they do for memory streams
+  virtual bool SeekAbsolute(uint64 Offset) override
+  {
+    if (m_errorState || Offset > m_size)
+      return false;
+
+    m_position = Offset;
+    return true;
+  }
+
+  virtual bool SeekRelative(int64 Offset) override
+  {
+    if (m_errorState || (Offset < 0 && (uint64)-Offset > m_position) ||
+        (Offset > 0 && (uint64)Offset > m_size - m_position))
+    {
+      return false;
+    }
+
+    m_position += Offset;
+    return true;
+  }
+
+  virtual bool SeekToEnd() override
+  {
+    if (m_errorState)
+      return false;
+
+    m_position = m_size;
+    return true;
+  }
+
+  virtual uint64 GetPosition() const override { return m_position; }
+  virtual uint64 GetSize() const override { return m_size; }
+  virtual const byte* GetBasePointer() const override { return m_pData; }
+
+  virtual bool Flush() override { return !m_errorState; }
+  virtual bool Commit() override { return true; }
+  virtual bool Discard() override { return false; }
+
+private:
+  const byte* m_pData;
+  uint64 m_size;
+  uint64 m_position;
+};
+
+// Maps the file if it can be. Returns false without setting *ppReturnPointer for empty files, files too large for
+// the address space, and anything else that can't be mapped, for the caller to open it normally instead.
+static bool OpenMappedFileStream(const char* fileName, uint32 openMode, ByteStream** ppReturnPointer)
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  DWORD flags = (openMode & BYTESTREAM_OPEN_STREAMED) ? FILE_FLAG_SEQUENTIAL_SCAN : 0;
+  HANDLE hFile = CreateFileW(UTF16StackString<MAX_PATH>(fileName).GetWideCharArray(), GENERIC_READ,
+                             FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, flags, NULL);
+  if (hFile == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0 || (uint64)fileSize.QuadPart > (uint64)SIZE_MAX)
+  {
+    CloseHandle(hFile);
+    return false;
+  }
+
+  // the view keeps the mapping and the file open
+  HANDLE hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(hFile);
+  if (hMapping == NULL)
+    return false;
+
+  const void* pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(hMapping);
+  if (pView == NULL)
+    return false;
+
+  *ppReturnPointer = new MappedFileByteStream(pView, (uint64)fileSize.QuadPart);
+  return true;
+#else
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) < 0 || !S_ISREG(fileStat.st_mode) || fileStat.st_size == 0 ||
+      (uint64)fileStat.st_size > (uint64)SIZE_MAX)
+  {
+    close(fd);
+    return false;
+  }
+
+  // the mapping holds its own reference to the file
+  void* pView = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (pView == MAP_FAILED)
+    return false;
+
+  if (openMode & BYTESTREAM_OPEN_STREAMED)
+    madvise(pView, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+
+  *ppReturnPointer = new MappedFileByteStream(pView, (uint64)fileStat.st_size);
+  return true;
+#endif
+}
+
+// Unbuffered file stream for large sequential transfers, which keeps them out of the page cache. The device only
+// sees whole aligned blocks: data is gathered in one of two aligned buffers while the other is written out, or read
+// ahead, on a helper thread. Reads can seek anywhere in the file, writes can only seek back within the buffer being
+// filled, since everything before it may already be on its way to the disk.
+class DirectFileByteStream : public ByteStream
+{
+public:
+#if defined(Y_PLATFORM_WINDOWS)
+  typedef HANDLE FileHandle;
+#else
+  typedef int FileHandle;
+#endif
+
+  // device transfers are whole blocks at block offsets from block-aligned memory
+  static const uint32 BlockSize = 4096;
+  static const uint32 BufferSize = 1024 * 1024;
+
+  DirectFileByteStream(FileHandle fileHandle, bool writing, bool dropCache, uint64 fileSize)
+    : m_fileHandle(fileHandle), m_writing(writing), m_dropCache(dropCache), m_activeBuffer(0), m_bufferOffset(0),
+      m_bufferSize(0), m_position(0), m_fileSize(fileSize), m_pTransferThread(nullptr), m_transferInFlight(false),
+      m_transferPending(false), m_transferExit(false), m_transferBuffer(0), m_transferOffset(0), m_transferSize(0),
+      m_transferResult(0)
+  {
+    m_pBuffers[0] = (byte*)Y_aligned_malloc(BufferSize, BlockSize);
+    m_pBuffers[1] = (byte*)Y_aligned_malloc(BufferSize, BlockSize);
+  }
+
+  virtual ~DirectFileByteStream()
+  {
+    if (m_writing)
+      Flush();
+    if (m_transferInFlight)
+      WaitForTransfer();
+
+    if (m_pTransferThread != nullptr)
+    {
+      m_transferLock.Lock();
+      m_transferExit = true;
+      m_transferConditionVariable.WakeAll();
+      m_transferLock.Unlock();
+      m_pTransferThread->Join();
+      delete m_pTransferThread;
+    }
+
+    Y_aligned_free(m_pBuffers[1]);
+    Y_aligned_free(m_pBuffers[0]);
+#if defined(Y_PLATFORM_WINDOWS)
+    CloseHandle(m_fileHandle);
+#else
+    close(m_fileHandle);
+#endif
+  }
+
+  virtual bool ReadByte(byte* pDestByte) override { return Read2(pDestByte, 1, nullptr); }
+
+  virtual uint32 Read(void* pDestination, uint32 ByteCount) override
+  {
+    if (m_errorState)
+      return 0;
+    if (m_writing)
+    {
+      m_errorState = true;
+      return 0;
+    }
+
+    byte* pDestinationBytes = reinterpret_cast<byte*>(pDestination);
+    uint32 bytesRead = 0;
+    while (bytesRead < ByteCount)
+    {
+      if (m_position < m_bufferOffset || m_position >= m_bufferOffset + m_bufferSize)
+      {
+        if (m_position >= m_fileSize)
+          break;
+        if (!LoadBuffer(m_position))
+        {
+          m_errorState = true;
+          break;
+        }
+        if (m_position >= m_bufferOffset + m_bufferSize)
+          break;
+      }
+
+      uint32 offsetInBuffer = (uint32)(m_position - m_bufferOffset);
+      uint32 count = Min(ByteCount - bytesRead, m_bufferSize - offsetInBuffer);
+      std::memcpy(pDestinationBytes + bytesRead, m_pBuffers[m_activeBuffer] + offsetInBuffer, count);
+      bytesRead += count;
+      m_position += count;
+    }
+
+    return bytesRead;
+  }
+
+  virtual bool Read2(void* pDestination, uint32 ByteCount, uint32* pNumberOfBytesRead /* = nullptr */) override
+  {
+    uint32 bytesRead = Read(pDestination, ByteCount);
+    if (pNumberOfBytesRead != nullptr)
+      *pNumberOfBytesRead = bytesRead;
+
+    if (bytesRead != ByteCount)
+    {
+      m_errorState = true;
+      return false;
+    }
+
+    return true;
+  }
+
+  virtual bool WriteByte(byte SourceByte) override { return Write2(&SourceByte, 1, nullptr); }
+
+  virtual uint32 Write(const void* pSource, uint32 ByteCount) override
+  {
+    if (m_errorState)
+      return 0;
+    if (!m_writing)
+    {
+      m_errorState = true;
+      return 0;
+    }
+
+    const byte* pSourceBytes = reinterpret_cast<const byte*>(pSource);
+    uint32 bytesWritten = 0;
+    while (bytesWritten < ByteCount)
+    {
+      uint32 offsetInBuffer = (uint32)(m_position - m_bufferOffset);
+      uint32 count = Min(ByteCount - bytesWritten, BufferSize - offsetInBuffer);
+      std::memcpy(m_pBuffers[m_activeBuffer] + offsetInBuffer, pSourceBytes + bytesWritten, count);
+      bytesWritten += count;
+      m_position += count;
+      m_bufferSize = Max(m_bufferSize, offsetInBuffer + count);
+
+      // full buffers go to the helper thread, and the other one is filled in the meantime
+      if (m_position == m_bufferOffset + BufferSize && !WriteActiveBuffer())
+        break;
+    }
+
+    return bytesWritten;
+  }
+
+  virtual bool Write2(const void* pSource, uint32 ByteCount, uint32* pNumberOfBytesWritten /* = nullptr */) override
+  {
+    uint32 bytesWritten = Write(pSource, ByteCount);
+    if (pNumberOfBytesWritten != nullptr)
+      *pNumberOfBytesWritten = bytesWritten;
+
+    if (bytesWritten != ByteCount)
+    {
+      m_errorState = true;
+      return false;
+    }
+
+    return true;
+  }
+
+  // seeks that can't be done fail without affecting the stream
+  virtual bool SeekAbsolute(uint64 Offset) override
+  {
+    if (m_errorState)
+      return false;
+
+    if (m_writing ? (Offset < m_bufferOffset || Offset > m_bufferOffset + m_bufferSize) : (Offset > m_fileSize))
+      return false;
+
+    m_position = Offset;
+    return true;
+  }
+
+  virtual bool SeekRelative(int64 Offset) override
+  {
+    if (Offset < 0 && (uint64)-Offset > m_position)
+      return false;
+
+    return SeekAbsolute(m_position + Offset);
+  }
+
+  virtual bool SeekToEnd() override { return SeekAbsolute(GetSize()); }
+
+  virtual uint64 GetPosition() const override { return m_position; }
+  virtual uint64 GetSize() const override { return m_writing ? (m_bufferOffset + m_bufferSize) : m_fileSize; }
+
+  // writes out the partly filled buffer padded to a whole block, then trims the padding off the file. the buffer
+  // is kept, and written again once it fills up.
+  virtual bool Flush() override
+  {
+    if (m_errorState)
+      return false;
+    if (!m_writing)
+      return true;
+
+    if (m_transferInFlight && !WaitForTransfer())
+    {
+      m_errorState = true;
+      return false;
+    }
+
+    uint64 fileSize = m_bufferOffset + m_bufferSize;
+    if (m_bufferSize > 0)
+    {
+      uint32 paddedSize = (m_bufferSize + BlockSize - 1) & ~(BlockSize - 1);
+      std::memset(m_pBuffers[m_activeBuffer] + m_bufferSize, 0, paddedSize - m_bufferSize);
+      if (TransferBlocks(true, m_pBuffers[m_activeBuffer], m_bufferOffset, paddedSize) != (int64)paddedSize)
+      {
+        m_errorState = true;
+        return false;
+      }
+    }
+
+    if (!TruncateFile(fileSize))
+    {
+      m_errorState = true;
+      return false;
+    }
+
+    return true;
+  }
+
+  virtual bool Commit() override { return Flush(); }
+  virtual bool Discard() override { return false; }
+
+private:
+  class TransferThread : public Thread
+  {
+  public:
+    TransferThread(DirectFileByteStream* pStream) : m_pStream(pStream) {}
+
+  protected:
+    virtual int ThreadEntryPoint() override
+    {
+      m_pStream->TransferThreadLoop();
+      return 0;
+    }
+
+  private:
+    DirectFileByteStream* m_pStream;
+  };
+
+  // synchronous positioned transfer of whole blocks, returns the number of bytes transferred or -1 on error.
+  // reads can come up short at the end of the file.
+  int64 TransferBlocks(bool write, byte* pBuffer, uint64 offset, uint32 size)
+  {
+    uint32 transferred = 0;
+    while (transferred < size)
+    {
+#if defined(Y_PLATFORM_WINDOWS)
+      OVERLAPPED overlapped;
+      std::memset(&overlapped, 0, sizeof(overlapped));
+      overlapped.Offset = (DWORD)(offset + transferred);
+      overlapped.OffsetHigh = (DWORD)((offset + transferred) >> 32);
+      DWORD count = 0;
+      BOOL result = write ? WriteFile(m_fileHandle, pBuffer + transferred, size - transferred, &count, &overlapped) :
+                            ReadFile(m_fileHandle, pBuffer + transferred, size - transferred, &count, &overlapped);
+      if (!result)
+      {
+        if (!write && GetLastError() == ERROR_HANDLE_EOF)
+          break;
+
+        return -1;
+      }
+#else
+      ssize_t count = write ? pwrite(m_fileHandle, pBuffer + transferred, size - transferred, offset + transferred) :
+                              pread(m_fileHandle, pBuffer + transferred, size - transferred, offset + transferred);
+      if (count < 0)
+      {
+        if (errno == EINTR)
+          continue;
+
+        return -1;
+      }
+#endif
+      if (count == 0)
+        break;
+
+      transferred += (uint32)count;
+    }
+
+#if defined(Y_PLATFORM_LINUX)
+    // without O_DIRECT the pages are dropped once they're clean
+    if (m_dropCache && transferred > 0)
+    {
+      if (write)
+        sync_file_range(m_fileHandle, offset, transferred,
+                        SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+      posix_fadvise(m_fileHandle, offset, transferred, POSIX_FADV_DONTNEED);
+    }
+#endif
+
+    return transferred;
+  }
+
+  bool TruncateFile(uint64 size)
+  {
+#if defined(Y_PLATFORM_WINDOWS)
+    FILE_END_OF_FILE_INFO info;
+    info.EndOfFile.QuadPart = (LONGLONG)size;
+    return (SetFileInformationByHandle(m_fileHandle, FileEndOfFileInfo, &info, sizeof(info)) != FALSE);
+#else
+    return (ftruncate(m_fileHandle, (off_t)size) == 0);
+#endif
+  }
+
+  // hands a transfer of one of the buffers to the helper thread, starting it the first time
+  void StartTransfer(uint32 bufferIndex, uint64 offset, uint32 size)
+  {
+    DebugAssert(!m_transferInFlight);
+    if (m_pTransferThread == nullptr)
+    {
+      m_pTransferThread = new TransferThread(this);
+      m_pTransferThread->Start();
+    }
+
+    MutexLock lock(m_transferLock);
+    m_transferBuffer = bufferIndex;
+    m_transferOffset = offset;
+    m_transferSize = size;
+    m_transferPending = true;
+    m_transferInFlight = true;
+    m_transferConditionVariable.WakeAll();
+  }
+
+  // waits for the helper thread's transfer. writes succeed if they were written in full, reads if they didn't fail.
+  bool WaitForTransfer()
+  {
+    DebugAssert(m_transferInFlight);
+    MutexLock lock(m_transferLock);
+    while (m_transferPending)
+      m_transferConditionVariable.SleepAndRelease(&m_transferLock);
+
+    m_transferInFlight = false;
+    return m_writing ? (m_transferResult == (int64)m_transferSize) : (m_transferResult >= 0);
+  }
+
+  void TransferThreadLoop()
+  {
+    MutexLock lock(m_transferLock);
+    for (;;)
+    {
+      if (!m_transferPending)
+      {
+        if (m_transferExit)
+          break;
+
+        m_transferConditionVariable.SleepAndRelease(&m_transferLock);
+        continue;
+      }
+
+      uint32 bufferIndex = m_transferBuffer;
+      uint64 offset = m_transferOffset;
+      uint32 size = m_transferSize;
+      m_transferLock.Unlock();
+      int64 result = TransferBlocks(m_writing, m_pBuffers[bufferIndex], offset, size);
+      m_transferLock.Lock();
+
+      m_transferResult = result;
+      m_transferPending = false;
+      m_transferConditionVariable.WakeAll();
+    }
+  }
+
+  // sends the full buffer off to be written and switches to the other one
+  bool WriteActiveBuffer()
+  {
+    if (m_transferInFlight && !WaitForTransfer())
+    {
+      m_errorState = true;
+      return false;
+    }
+
+    StartTransfer(m_activeBuffer, m_bufferOffset, BufferSize);
+    m_activeBuffer ^= 1;
+    m_bufferOffset += BufferSize;
+    m_bufferSize = 0;
+    return true;
+  }
+
+  // makes the active buffer the one holding position, reading ahead into the other one
+  bool LoadBuffer(uint64 position)
+  {
+    uint64 offset = position - (position % BufferSize);
+    bool loaded = false;
+    if (m_transferInFlight)
+    {
+      // the read ahead is used if it's the part that's wanted, otherwise it's thrown away
+      bool readAheadSucceeded = WaitForTransfer();
+      if (readAheadSucceeded && m_transferOffset == offset)
+      {
+        m_activeBuffer = m_transferBuffer;
+        m_bufferOffset = offset;
+        m_bufferSize = (uint32)m_transferResult;
+        loaded = true;
+      }
+    }
+
+    if (!loaded)
+    {
+      int64 result = TransferBlocks(false, m_pBuffers[m_activeBuffer], offset, BufferSize);
+      if (result < 0)
+        return false;
+
+      m_bufferOffset = offset;
+      m_bufferSize = (uint32)result;
+    }
+
+    if (m_bufferSize == BufferSize && offset + BufferSize < m_fileSize)
+      StartTransfer(m_activeBuffer ^ 1, offset + BufferSize, BufferSize);
+
+    return true;
+  }
+
+  FileHandle m_fileHandle;
+  bool m_writing;
+  bool m_dropCache;
+
+  // the active buffer holds m_bufferSize bytes of the file from m_bufferOffset, which is a multiple of BufferSize
+  byte* m_pBuffers[2];
+  uint32 m_activeBuffer;
+  uint64 m_bufferOffset;
+  uint32 m_bufferSize;
+  uint64 m_position;
+  uint64 m_fileSize;
+
+  // the helper thread, and the transfer it has been given, protected by m_transferLock
+  TransferThread* m_pTransferThread;
+  Mutex m_transferLock;
+  ConditionVariable m_transferConditionVariable;
+  bool m_transferInFlight;
+  bool m_transferPending;
+  bool m_transferExit;
+  uint32 m_transferBuffer;
+  uint64 m_transferOffset;
+  uint32 m_transferSize;
+  int64 m_transferResult;
+};
+
+// Opens a file for unbuffered transfers. Direct streams go one way only, and writes always start from an empty file
+// so the padding on the last block never lands on anything that was there before.
+static bool OpenDirectFileStream(const char* fileName, uint32 openMode, ByteStream** ppReturnPointer)
+{
+  bool writing = (openMode & BYTESTREAM_OPEN_WRITE) != 0;
+  if ((openMode & (BYTESTREAM_OPEN_APPEND | BYTESTREAM_OPEN_ATOMIC_UPDATE)) != 0 ||
+      (writing && (openMode & (BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_TRUNCATE)) != BYTESTREAM_OPEN_TRUNCATE) ||
+      (!writing && !(openMode & BYTESTREAM_OPEN_READ)))
+  {
+    return false;
+  }
+
+#if defined(Y_PLATFORM_WINDOWS)
+  DWORD creationDisposition;
+  if (writing)
+    creationDisposition = (openMode & BYTESTREAM_OPEN_CREATE) ? CREATE_ALWAYS : TRUNCATE_EXISTING;
+  else
+    creationDisposition = OPEN_EXISTING;
+
+  HANDLE hFile = CreateFileW(UTF16StackString<MAX_PATH>(fileName).GetWideCharArray(),
+                             writing ? GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, NULL, creationDisposition,
+                             FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (hFile == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(hFile, &fileSize))
+  {
+    CloseHandle(hFile);
+    return false;
+  }
+
+  *ppReturnPointer = new DirectFileByteStream(hFile, writing, false, (uint64)fileSize.QuadPart);
+  return true;
+#else
+  int flags = O_RDONLY;
+  if (writing)
+    flags = O_WRONLY | O_TRUNC | ((openMode & BYTESTREAM_OPEN_CREATE) ? O_CREAT : 0);
+
+  // file systems without direct I/O, tmpfs for one, drop the pages after each transfer instead
+  bool dropCache = false;
+#if defined(O_DIRECT)
+  int fd = open(fileName, flags | O_DIRECT | O_CLOEXEC, 0666);
+  if (fd < 0 && errno == EINVAL)
+  {
+    fd = open(fileName, flags | O_CLOEXEC, 0666);
+    dropCache = true;
+  }
+#else
+  int fd = open(fileName, flags | O_CLOEXEC, 0666);
+#if defined(F_NOCACHE)
+  if (fd >= 0)
+    fcntl(fd, F_NOCACHE, 1);
+#endif
+#endif
+  if (fd < 0)
+    return false;
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) < 0 || !S_ISREG(fileStat.st_mode))
+  {
+    close(fd);
+    return false;
+  }
+
+  *ppReturnPointer = new DirectFileByteStream(fd, writing, dropCache, (uint64)fileStat.st_size);
+  return true;
+#endif
+}
+
+#if defined(Y_PLATFORM_WINDOWS)
+
+bool ByteStream_OpenFileStream(const char* fileName, uint32 openMode, ByteStream** ppReturnPointer)
+{
+  // mapped files can only be read
+  if (openMode & BYTESTREAM_OPEN_MAPPED)
+  {
+    if (openMode & (BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_APPEND | BYTESTREAM_OPEN_TRUNCATE | BYTESTREAM_OPEN_CREATE))
+      return false;
+    if (OpenMappedFileStream(fileName, openMode, ppReturnPointer))
+      return true;
+  }
+
+  // the wide APIs take any path, not just ones in the ANSI code page
+  UTF16StackString<MAX_PATH> wideFileName(fileName);
+  if ((openMode & (BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE)) == BYTESTREAM_OPEN_WRITE)
+  {
+    // if opening with write but not create, the path must exist.
+    if (GetFileAttributesW(wideFileName.GetWideCharArray()) == INVALID_FILE_ATTRIBUTES)
+      return false;
+  }
+
+  char modeString[16];
+  uint32 modeStringLength = 0;
+
+  if (openMode & BYTESTREAM_OPEN_WRITE)
+  {
+    // if the file exists, use r+, otherwise w+
+    // HACK: if we're not truncating, and the file exists (we want to only update it), we still have to use r+
+    if ((openMode & BYTESTREAM_OPEN_TRUNCATE) ||
+        GetFileAttributesW(wideFileName.GetWideCharArray()) == INVALID_FILE_ATTRIBUTES)
+    {
+      modeString[modeStringLength++] = 'w';
+      if (openMode & BYTESTREAM_OPEN_READ)
+        modeString[modeStringLength++] = '+';
+    }
+    else
+    {
+      modeString[modeStringLength++] = 'r';
+      modeString[modeStringLength++] = '+';
+    }
+
+    modeString[modeStringLength++] = 'b';
+  }
+  else if (openMode & BYTESTREAM_OPEN_READ)
+  {
+    modeString[modeStringLength++] = 'r';
+    modeString[modeStringLength++] = 'b';
+  }
+
+  // doesn't work with _fdopen
+  if (!(openMode & BYTESTREAM_OPEN_ATOMIC_UPDATE))
+  {
+    if (openMode & BYTESTREAM_OPEN_STREAMED)
+      modeString[modeStringLength++] = 'S';
+    else if (openMode & BYTESTREAM_OPEN_SEEKABLE)
+      modeString[modeStringLength++] = 'R';
+  }
+
+  modeString[modeStringLength] = 0;
+
+  wchar_t wideModeString[countof(modeString)];
+  for (uint32 i = 0; i <= modeStringLength; i++)
+    wideModeString[i] = wchar_t(modeString[i]);
+
+  if (openMode & BYTESTREAM_OPEN_CREATE_PATH)
+  {
+    uint32 i;
+    uint32 fileNameLength = Y_strlen(fileName);
+    char* tempStr = (char*)alloca(fileNameLength + 1);
+
+    // check if it starts with a drive letter. if so, skip ahead
+    if (fileNameLength >= 2 && fileName[1] == ':')
+    {
+      if (fileNameLength <= 3)
+      {
+        // create a file called driveletter: or driveletter:\ ? you must be crazy
+        i = fileNameLength;
+      }
+      else
+      {
+        std::memcpy(tempStr, fileName, 3);
+        i = 3;
+      }
+    }
+    else
+    {
+      // start at beginning
+      i = 0;
+    }
+
+    // step through each path component, create folders as necessary
+    for (; i < fileNameLength; i++)
+    {
+      if (i > 0 && (fileName[i] == '\\' || fileName[i] == '/'))
+      {
+        // terminate the string
+        tempStr[i] = '\0';
+
+        // check if it exists
+        UTF16StackString<MAX_PATH> widePath(StringView(tempStr, i));
+        struct _stat s;
+        if (_wstat(widePath.GetWideCharArray(), &s) < 0)
         {
           if (errno == ENOENT)
           {
             // try creating it
-            if (_mkdir(tempStr) < 0)
+            if (_wmkdir(widePath.GetWideCharArray()) < 0)
             {
               // no point trying any further down the chain
               break;
@@ -948,6 +2066,10 @@ bool ByteStream_OpenFileStream(const char* fileName, uint32 openMode, ByteStream
     }
   }
 
+  // unbuffered streams do their own I/O
+  if (openMode & BYTESTREAM_OPEN_DIRECT)
+    return OpenDirectFileStream(fileName, openMode, ppReturnPointer);
+
   if (openMode & BYTESTREAM_OPEN_ATOMIC_UPDATE)
   {
     DebugAssert(openMode & (BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE));
@@ -961,23 +2083,39 @@ bool ByteStream_OpenFileStream(const char* fileName, uint32 openMode, ByteStream
     _mktemp_s(temporaryFileName, fileNameLength + 8);
 
     // open the file
-    errno_t err;
     FILE* pTemporaryFile;
 
     // massive hack here
     DWORD desiredAccess = GENERIC_WRITE;
     if (openMode & BYTESTREAM_OPEN_READ)
       desiredAccess |= GENERIC_READ;
-    HANDLE hFile = CreateFileA(temporaryFileName, desiredAccess, FILE_SHARE_DELETE, NULL, CREATE_NEW, 0, NULL);
+    UTF16StackString<MAX_PATH> wideTemporaryFileName(temporaryFileName);
+
+    // do we need to copy the existing file into this one? CopyFile clones the blocks on ReFS, and has the copy done
+    // by the storage where it can.
+    bool copyOriginal = !(openMode & BYTESTREAM_OPEN_TRUNCATE);
+    if (copyOriginal &&
+        !CopyFileW(wideFileName.GetWideCharArray(), wideTemporaryFileName.GetWideCharArray(), TRUE))
+    {
+      return false;
+    }
+
+    HANDLE hFile = CreateFileW(wideTemporaryFileName.GetWideCharArray(), desiredAccess, FILE_SHARE_DELETE, NULL,
+                               copyOriginal ? OPEN_EXISTING : CREATE_NEW, 0, NULL);
     if (hFile == INVALID_HANDLE_VALUE)
+    {
+      if (copyOriginal)
+        DeleteFileW(wideTemporaryFileName.GetWideCharArray());
+
       return false;
+    }
 
     // get fd from this
     int fd = _open_osfhandle(reinterpret_cast<intptr_t>(hFile), 0);
     if (fd < 0)
     {
       CloseHandle(hFile);
-      DeleteFileA(temporaryFileName);
+      DeleteFileW(wideTemporaryFileName.GetWideCharArray());
       return false;
     }
 
@@ -986,56 +2124,23 @@ bool ByteStream_OpenFileStream(const char* fileName, uint32 openMode, ByteStream
     if (pTemporaryFile == nullptr)
     {
       close(fd);
-      DeleteFileA(temporaryFileName);
+      DeleteFileW(wideTemporaryFileName.GetWideCharArray());
       return false;
     }
 
-    // create the stream pointer
-    AtomicUpdatedFileByteStream* pStream = new AtomicUpdatedFileByteStream(pTemporaryFile, fileName, temporaryFileName);
-
-    // do we need to copy the existing file into this one?
-    if (!(openMode & BYTESTREAM_OPEN_TRUNCATE))
-    {
-      FILE* pOriginalFile;
-      err = fopen_s(&pOriginalFile, fileName, "rb");
-      if (err != 0 || pOriginalFile == nullptr)
-      {
-        // this will delete the temporary file
-        pStream->Discard();
-        pStream->Release();
-        return false;
-      }
-
-      static const size_t BUFFERSIZE = 4096;
-      byte buffer[BUFFERSIZE];
-      while (!feof(pOriginalFile))
-      {
-        size_t nBytes = fread(buffer, BUFFERSIZE, sizeof(byte), pOriginalFile);
-        if (nBytes == 0)
-          break;
-
-        if (pStream->Write(buffer, (uint32)nBytes) != (uint32)nBytes)
-        {
-          pStream->Discard();
-          pStream->Release();
-          fclose(pOriginalFile);
-          return false;
-        }
-      }
-
-      // close original file
-      fclose(pOriginalFile);
-    }
+    // the copied contents are kept, so start after them
+    if (copyOriginal)
+      fseek(pTemporaryFile, 0, SEEK_END);
 
     // return pointer
-    *ppReturnPointer = pStream;
+    *ppReturnPointer = new AtomicUpdatedFileByteStream(pTemporaryFile, fileName, temporaryFileName);
     return true;
   }
   else
   {
     // forward through
     FILE* pFile;
-    errno_t err = fopen_s(&pFile, fileName, modeString);
+    errno_t err = _wfopen_s(&pFile, wideFileName.GetWideCharArray(), wideModeString);
     if (err != 0 || pFile == NULL)
       return false;
 
@@ -1046,8 +2151,72 @@ bool ByteStream_OpenFileStream(const char* fileName, uint32 openMode, ByteStream
 
 #elif defined(Y_COMPILER_GCC) || defined(Y_COMPILER_CLANG) || defined(Y_COMPILER_EMSCRIPTEN)
 
+// Fills a new file with the contents of another, for an atomic update that keeps them. The blocks are shared with
+// FICLONE on file systems that can (btrfs, xfs), or copied by the kernel with copy_file_range, and only read through
+// a buffer when neither works. Leaves the destination's offset at its end.
+static bool CopyOriginalFile(int sourceFileDescriptor, int destinationFileDescriptor)
+{
+#if defined(Y_PLATFORM_LINUX)
+  if (ioctl(destinationFileDescriptor, FICLONE, sourceFileDescriptor) == 0)
+    return (lseek(destinationFileDescriptor, 0, SEEK_END) >= 0);
+
+#if defined(__NR_copy_file_range)
+  // the file offsets move with the copy, so the buffered copy can carry on from wherever this stops
+  for (;;)
+  {
+    ssize_t result = syscall(__NR_copy_file_range, sourceFileDescriptor, nullptr, destinationFileDescriptor, nullptr,
+                             (size_t)0x40000000, 0);
+    if (result == 0)
+      return true;
+    else if (result < 0 && errno != EINTR)
+      break;
+  }
+#endif
+#endif
+
+  static const size_t BUFFERSIZE = 16384;
+  byte buffer[BUFFERSIZE];
+  for (;;)
+  {
+    ssize_t bytesRead = read(sourceFileDescriptor, buffer, BUFFERSIZE);
+    if (bytesRead == 0)
+      return true;
+
+    if (bytesRead < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      return false;
+    }
+
+    for (ssize_t bytesWritten = 0; bytesWritten < bytesRead;)
+    {
+      ssize_t result = write(destinationFileDescriptor, buffer + bytesWritten, (size_t)(bytesRead - bytesWritten));
+      if (result < 0)
+      {
+        if (errno == EINTR)
+          continue;
+
+        return false;
+      }
+
+      bytesWritten += result;
+    }
+  }
+}
+
 bool ByteStream_OpenFileStream(const char* fileName, uint32 openMode, ByteStream** ppReturnPointer)
 {
+  // mapped files can only be read
+  if (openMode & BYTESTREAM_OPEN_MAPPED)
+  {
+    if (openMode & (BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_APPEND | BYTESTREAM_OPEN_TRUNCATE | BYTESTREAM_OPEN_CREATE))
+      return false;
+    if (OpenMappedFileStream(fileName, openMode, ppReturnPointer))
+      return true;
+  }
+
   if ((openMode & (BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE)) == BYTESTREAM_OPEN_WRITE)
   {
     // if opening with write but not create, the path must exist.
@@ -1155,61 +2324,55 @@ bool ByteStream_OpenFileStream(const char* fileName, uint32 openMode, ByteStream
     }
   }
 
+  // unbuffered streams do their own I/O
+  if (openMode & BYTESTREAM_OPEN_DIRECT)
+    return OpenDirectFileStream(fileName, openMode, ppReturnPointer);
+
   if (openMode & BYTESTREAM_OPEN_ATOMIC_UPDATE)
   {
     DebugAssert(openMode & (BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE));
 
-    // generate the temporary file name
+    // create the temporary file, with the name's random characters picked and the file opened in one step. the copy
+    // is made before it becomes a stream, as the kernel won't copy into an appending file.
     uint32 fileNameLength = Y_strlen(fileName);
     char* temporaryFileName = (char*)alloca(fileNameLength + 8);
     Y_snprintf(temporaryFileName, fileNameLength + 8, "%s.XXXXXX", fileName);
-
-    // fill in random characters
-    mktemp(temporaryFileName);
-
-    // open the file
-    FILE* pTemporaryFile = fopen(temporaryFileName, modeString);
-    if (pTemporaryFile == nullptr)
+    int temporaryFileDescriptor = mkostemp(temporaryFileName, O_CLOEXEC);
+    if (temporaryFileDescriptor < 0)
       return false;
 
-    // create the stream pointer
-    AtomicUpdatedFileByteStream* pStream = new AtomicUpdatedFileByteStream(pTemporaryFile, fileName, temporaryFileName);
+    // it's created only readable by us, so it takes the permissions of the file it's replacing, if there is one
+    struct stat originalStat;
+    if (stat(fileName, &originalStat) == 0)
+      fchmod(temporaryFileDescriptor, originalStat.st_mode & 07777);
 
     // do we need to copy the existing file into this one?
     if (!(openMode & BYTESTREAM_OPEN_TRUNCATE))
     {
-      FILE* pOriginalFile = fopen(fileName, "rb");
-      if (pOriginalFile == nullptr)
-      {
-        // this will delete the temporary file
-        pStream->SetErrorState();
-        pStream->Release();
-        return false;
-      }
+      int originalFileDescriptor = open(fileName, O_RDONLY | O_CLOEXEC);
+      bool copied = (originalFileDescriptor >= 0 && CopyOriginalFile(originalFileDescriptor, temporaryFileDescriptor));
+      if (originalFileDescriptor >= 0)
+        close(originalFileDescriptor);
 
-      static const size_t BUFFERSIZE = 4096;
-      byte buffer[BUFFERSIZE];
-      while (!feof(pOriginalFile))
+      if (!copied)
       {
-        size_t nBytes = fread(buffer, BUFFERSIZE, sizeof(byte), pOriginalFile);
-        if (nBytes == 0)
-          break;
-
-        if (pStream->Write(buffer, (uint32)nBytes) != (uint32)nBytes)
-        {
-          pStream->SetErrorState();
-          pStream->Release();
-          fclose(pOriginalFile);
-          return false;
-        }
+        close(temporaryFileDescriptor);
+        remove(temporaryFileName);
+        return false;
       }
+    }
 
-      // close original file
-      fclose(pOriginalFile);
+    // convert to a stream
+    FILE* pTemporaryFile = fdopen(temporaryFileDescriptor, modeString);
+    if (pTemporaryFile == nullptr)
+    {
+      close(temporaryFileDescriptor);
+      remove(temporaryFileName);
+      return false;
     }
 
     // return pointer
-    *ppReturnPointer = pStream;
+    *ppReturnPointer = new AtomicUpdatedFileByteStream(pTemporaryFile, fileName, temporaryFileName);
     return true;
   }
   else
@@ -1225,13 +2388,13 @@ bool ByteStream_OpenFileStream(const char* fileName, uint32 openMode, ByteStream
 
 #endif
 
-MemoryByteStream* ByteStream_CreateMemoryStream(void* pMemory, uint32 Size)
+MemoryByteStream* ByteStream_CreateMemoryStream(void* pMemory, size_t Size)
 {
   DebugAssert(pMemory != nullptr && Size > 0);
   return new MemoryByteStream(pMemory, Size);
 }
 
-ReadOnlyMemoryByteStream* ByteStream_CreateReadOnlyMemoryStream(const void* pMemory, uint32 Size)
+ReadOnlyMemoryByteStream* ByteStream_CreateReadOnlyMemoryStream(const void* pMemory, size_t Size)
 {
   DebugAssert(pMemory != nullptr && Size > 0);
   return new ReadOnlyMemoryByteStream(pMemory, Size);
@@ -1242,7 +2405,7 @@ NullByteStream* ByteStream_CreateNullStream()
   return new NullByteStream();
 }
 
-GrowableMemoryByteStream* ByteStream_CreateGrowableMemoryStream(void* pInitialMemory, uint32 InitialSize)
+GrowableMemoryByteStream* ByteStream_CreateGrowableMemoryStream(void* pInitialMemory, size_t InitialSize)
 {
   return new GrowableMemoryByteStream(pInitialMemory, InitialSize);
 }
@@ -1252,77 +2415,235 @@ GrowableMemoryByteStream* ByteStream_CreateGrowableMemoryStream()
   return new GrowableMemoryByteStream(nullptr, 0);
 }
 
-bool ByteStream_CopyStream(ByteStream* pDestinationStream, ByteStream* pSourceStream)
+SegmentedMemoryByteStream* ByteStream_CreateSegmentedMemoryStream(
+  uint32 segmentSize /* = SegmentedMemoryByteStream::DefaultSegmentSize */)
 {
-  const uint32 chunkSize = 4096;
-  byte chunkData[chunkSize];
+  return new SegmentedMemoryByteStream(segmentSize);
+}
 
-  uint64 oldSourcePosition = pSourceStream->GetPosition();
-  if (!pSourceStream->SeekAbsolute(0) || !pDestinationStream->SeekAbsolute(0))
+#if defined(Y_PLATFORM_LINUX)
+
+// Copies between two files in the kernel, with copy_file_range where the kernel and file systems allow it and
+// sendfile otherwise, so the data never comes up to user space. Leaves both streams after what was copied. Returns
+// false with nothing copied if neither applies, for the caller to copy through a buffer instead.
+static bool CopyFileData(ByteStream* pSourceStream, ByteStream* pDestinationStream, uint64 maxBytes,
+                         uint64* pBytesCopied, bool* pSourceDone)
+{
+  int sourceFileDescriptor, destinationFileDescriptor;
+  if (!pSourceStream->GetFileDescriptor(&sourceFileDescriptor) ||
+      !pDestinationStream->GetFileDescriptor(&destinationFileDescriptor))
+  {
     return false;
+  }
 
-  bool success = false;
-  for (;;)
+  loff_t sourceOffset = (loff_t)pSourceStream->GetPosition();
+  loff_t destinationOffset = (loff_t)pDestinationStream->GetPosition();
+  uint64 copied = 0;
+  bool useSendFile = false;
+#if !defined(__NR_copy_file_range)
+  useSendFile = true;
+#endif
+
+  while (copied < maxBytes)
   {
-    uint32 nBytes = pSourceStream->Read(chunkData, chunkSize);
-    if (nBytes == 0)
+    size_t count = (size_t)Min(maxBytes - copied, (uint64)0x40000000);
+    ssize_t result;
+#if defined(__NR_copy_file_range)
+    if (!useSendFile)
+    {
+      result = syscall(__NR_copy_file_range, sourceFileDescriptor, &sourceOffset, destinationFileDescriptor,
+                       &destinationOffset, count, 0);
+
+      // unsupported by the kernel, across file systems, or with appending destinations
+      if (result < 0 && errno != EINTR && copied == 0)
+      {
+        useSendFile = true;
+        continue;
+      }
+    }
+    else
+#endif
+    {
+      // sendfile writes at the destination's file offset
+      if (copied == 0 && lseek(destinationFileDescriptor, (off_t)destinationOffset, SEEK_SET) < 0)
+        return false;
+
+      off_t sendOffset = (off_t)sourceOffset;
+      result = sendfile(destinationFileDescriptor, sourceFileDescriptor, &sendOffset, count);
+      if (result > 0)
+      {
+        sourceOffset += result;
+        destinationOffset += result;
+      }
+      else if (result < 0 && errno != EINTR && copied == 0)
+      {
+        return false;
+      }
+    }
+
+    if (result < 0)
     {
-      success = true;
+      // errors part way leave the rest to the buffered copy, which finds them again and sets the stream's error
+      if (errno == EINTR)
+        continue;
+
       break;
     }
 
-    if (pDestinationStream->Write(chunkData, nBytes) != nBytes)
+    if (result == 0)
+    {
+      *pSourceDone = true;
       break;
+    }
+
+    copied += (uint64)result;
   }
 
-  return (pSourceStream->SeekAbsolute(oldSourcePosition) && success);
+  pSourceStream->SeekAbsolute((uint64)sourceOffset);
+  pDestinationStream->SeekAbsolute((uint64)destinationOffset);
+  *pBytesCopied = copied;
+  return true;
 }
 
-bool ByteStream_AppendStream(ByteStream* pSourceStream, ByteStream* pDestinationStream)
+#endif
+
+// Copies up to maxBytes from the source's position to the destination's, returning false if the destination
+// couldn't take it all. Files are copied by the kernel where it can, and a view on either side removes the
+// intermediate copy.
+static bool CopyStreamData(ByteStream* pSourceStream, ByteStream* pDestinationStream, uint64 maxBytes,
+                           uint64* pBytesCopied)
 {
-  const uint32 chunkSize = 4096;
-  byte chunkData[chunkSize];
+  uint64 copied = 0;
+  bool sourceDone = false;
 
-  uint64 oldSourcePosition = pSourceStream->GetPosition();
-  if (!pSourceStream->SeekAbsolute(0))
-    return false;
+#if defined(Y_PLATFORM_LINUX)
+  if (CopyFileData(pSourceStream, pDestinationStream, maxBytes, &copied, &sourceDone) &&
+      (sourceDone || copied == maxBytes))
+  {
+    *pBytesCopied = copied;
+    return true;
+  }
+#endif
 
-  bool success = false;
-  for (;;)
+  if (pSourceStream->GetViewFlags() & BYTESTREAM_VIEW_READ)
   {
-    uint32 nBytes = pSourceStream->Read(chunkData, chunkSize);
-    if (nBytes == 0)
+    // written straight out of the source
+    while (copied < maxBytes)
     {
-      success = true;
-      break;
+      const void* pData;
+      uint32 viewSize = pSourceStream->AcquireReadView((uint32)Min(maxBytes - copied, (uint64)0xFFFFFFFF), &pData);
+      if (viewSize == 0)
+      {
+        sourceDone = true;
+        break;
+      }
+
+      uint32 bytesWritten = pDestinationStream->Write(pData, viewSize);
+      pSourceStream->ReleaseReadView(bytesWritten);
+      copied += bytesWritten;
+      if (bytesWritten != viewSize)
+      {
+        *pBytesCopied = copied;
+        return false;
+      }
+    }
+  }
+  else if (pDestinationStream->GetViewFlags() & BYTESTREAM_VIEW_WRITE)
+  {
+    // read straight into the destination, until it runs out of room
+    const uint32 chunkSize = 65536;
+    while (copied < maxBytes)
+    {
+      void* pData;
+      uint32 viewSize = pDestinationStream->AcquireWriteView((uint32)Min(maxBytes - copied, (uint64)chunkSize), &pData);
+      if (viewSize == 0)
+        break;
+
+      uint32 bytesRead = pSourceStream->Read(pData, viewSize);
+      pDestinationStream->ReleaseWriteView(bytesRead);
+      copied += bytesRead;
+      if (bytesRead != viewSize)
+      {
+        sourceDone = true;
+        break;
+      }
+    }
+  }
+
+  // through a buffer, and whatever was left above. large copies get a large buffer to cut the calls per byte.
+  const uint32 smallBufferSize = 4096;
+  const uint32 largeBufferSize = 1024 * 1024;
+  byte smallBuffer[smallBufferSize];
+  byte* pBuffer = smallBuffer;
+  uint32 bufferSize = smallBufferSize;
+  if (!sourceDone && maxBytes - copied > smallBufferSize)
+  {
+    uint64 sourceSize = pSourceStream->GetSize();
+    uint64 sourcePosition = pSourceStream->GetPosition();
+    if (sourceSize > sourcePosition && sourceSize - sourcePosition > smallBufferSize)
+    {
+      byte* pLargeBuffer = (byte*)Y_malloc(largeBufferSize);
+      if (pLargeBuffer != nullptr)
+      {
+        pBuffer = pLargeBuffer;
+        bufferSize = largeBufferSize;
+      }
     }
+  }
+
+  bool result = true;
+  while (!sourceDone && copied < maxBytes)
+  {
+    uint32 bytesRead = pSourceStream->Read(pBuffer, (uint32)Min(maxBytes - copied, (uint64)bufferSize));
+    if (bytesRead == 0)
+      break;
 
-    if (pDestinationStream->Write(chunkData, nBytes) != nBytes)
+    uint32 bytesWritten = pDestinationStream->Write(pBuffer, bytesRead);
+    copied += bytesWritten;
+    if (bytesWritten != bytesRead)
+    {
+      result = false;
       break;
+    }
   }
 
-  return (pSourceStream->SeekAbsolute(oldSourcePosition) && success);
+  if (pBuffer != smallBuffer)
+    Y_free(pBuffer);
+
+  *pBytesCopied = copied;
+  return result;
 }
 
-uint32 ByteStream_CopyBytes(ByteStream* pSourceStream, uint32 byteCount, ByteStream* pDestinationStream)
+bool ByteStream_CopyStream(ByteStream* pDestinationStream, ByteStream* pSourceStream)
 {
-  const uint32 chunkSize = 4096;
-  byte chunkData[chunkSize];
+  uint64 oldSourcePosition = pSourceStream->GetPosition();
+  if (!pSourceStream->SeekAbsolute(0) || !pDestinationStream->SeekAbsolute(0))
+    return false;
 
-  uint32 remaining = byteCount;
-  while (remaining > 0)
-  {
-    uint32 toCopy = Min(remaining, chunkSize);
-    uint32 bytesRead = pSourceStream->Read(chunkData, toCopy);
-    if (bytesRead == 0)
-      break;
+  uint64 bytesCopied;
+  bool success = CopyStreamData(pSourceStream, pDestinationStream, 0xFFFFFFFFFFFFFFFFULL, &bytesCopied);
+  return (pSourceStream->SeekAbsolute(oldSourcePosition) && success);
+}
 
-    uint32 bytesWritten = pDestinationStream->Write(chunkData, bytesRead);
-    if (bytesWritten == 0)
-      break;
+bool ByteStream_AppendStream(ByteStream* pSourceStream, ByteStream* pDestinationStream)
+{
+  uint64 oldSourcePosition = pSourceStream->GetPosition();
+  if (!pSourceStream->SeekAbsolute(0))
+    return false;
 
-    remaining -= bytesWritten;
-  }
+  uint64 bytesCopied;
+  bool success = CopyStreamData(pSourceStream, pDestinationStream, 0xFFFFFFFFFFFFFFFFULL, &bytesCopied);
+  return (pSourceStream->SeekAbsolute(oldSourcePosition) && success);
+}
+
+uint32 ByteStream_CopyBytes(ByteStream* pSourceStream, uint32 byteCount, ByteStream* pDestinationStream)
+{
+  return (uint32)ByteStream_CopyBytes64(pSourceStream, byteCount, pDestinationStream);
+}
 
-  return byteCount - remaining;
+uint64 ByteStream_CopyBytes64(ByteStream* pSourceStream, uint64 byteCount, ByteStream* pDestinationStream)
+{
+  uint64 bytesCopied;
+  CopyStreamData(pSourceStream, pDestinationStream, byteCount, &bytesCopied);
+  return bytesCopied;
 }
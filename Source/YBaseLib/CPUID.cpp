@@ -6,11 +6,18 @@
 
 #if defined(Y_PLATFORM_WINDOWS)
 #include "YBaseLib/Windows/WindowsHeaders.h"
-#elif defined(Y_PLATFORM_LINUX) || defined(Y_PLATFORM_OSX)
-#include <unistd.h> // sysconf
+#elif defined(Y_PLATFORM_LINUX)
+#include <cstdio>     // sysfs
+#include <sys/auxv.h> // getauxval
+#include <unistd.h>   // sysconf
+#elif defined(Y_PLATFORM_OSX)
+#include <sys/sysctl.h> // sysctlbyname
+#include <unistd.h>     // sysconf
 #elif defined(Y_PLATFORM_FREEBSD)
 #error fixme
 #elif defined(Y_PLATFORM_ANDROID)
+#include <cstdio>
+#include <sys/auxv.h>
 #include <unistd.h>
 #elif defined(Y_PLATFORM_HTML5)
 
@@ -23,15 +30,37 @@
 #if defined(Y_PLATFORM_WINDOWS)
 #include <intrin.h>
 #define CALL_CPUID(in, out) __cpuid((int*)out, in)
+#define CALL_CPUID_COUNT(in, count, out) __cpuidex((int*)out, in, count)
 #elif defined(Y_COMPILER_GCC) || defined(Y_COMPILER_CLANG)
 //#define CALL_CPUID(in, out) asm volatile ( "cpuid" : "=a"(*(out + 0)), "=b"(*(out + 1)), "=c"(*(out + 2)), "=d"(*(out
 //+ 3)) : "a"(in) )
 #include <cpuid.h>
 #define CALL_CPUID(in, out) __get_cpuid(in, &out[0], &out[1], &out[2], &out[3])
+#define CALL_CPUID_COUNT(in, count, out) __get_cpuid_count(in, count, &out[0], &out[1], &out[2], &out[3])
 #endif
 
 #define CheckBit(val, bit) (((((val) & (1 << (bit))) != 0) ? 1 : 0) != 0)
 
+static uint64 CPUID_ReadXCR0()
+{
+#if defined(Y_COMPILER_MSVC)
+  return _xgetbv(0);
+#else
+  uint32 xcr0Low, xcr0High;
+  asm volatile("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+  return (uint64(xcr0High) << 32) | xcr0Low;
+#endif
+}
+
+// the AVX registers are only usable if the OS has enabled saving them (XCR0 bits 1 and 2)
+static bool CPUID_OSSavesAVXState(const uint32* leaf1Data)
+{
+  if (!CheckBit(leaf1Data[2], 27))
+    return false;
+
+  return ((CPUID_ReadXCR0() & 0x6) == 0x6);
+}
+
 static void CPUID_ReadCPUData(Y_CPUID_RESULT* pResult)
 {
   // http://www.sandpile.org/ia32/cpuid.htm
@@ -57,7 +86,8 @@ static void CPUID_ReadCPUData(Y_CPUID_RESULT* pResult)
   pResult->BrandId = data[1] & 0xf;
 
   // feature flags
-  pResult->SupportsAVX = CheckBit(data[2], 28);
+  pResult->SupportsAVX = CheckBit(data[2], 28) && CPUID_OSSavesAVXState(data);
+  pResult->SupportsAVX2 = Y_CPUHasFeatures(Y_CPU_FEATURE_AVX2);
   pResult->SupportsAES = CheckBit(data[2], 25);
   pResult->SupportsSSE42 = CheckBit(data[2], 20);
   pResult->SupportsSSE41 = CheckBit(data[2], 19);
@@ -197,6 +227,492 @@ static void CPUID_ReadOSData(Y_CPUID_RESULT* pResult)
 #endif
 }
 
+static uint32 CPUID_CountProcessors(uint64 mask)
+{
+  uint32 count = 0;
+  for (; mask != 0; mask &= mask - 1)
+    count++;
+
+  return count;
+}
+
+#if defined(Y_PLATFORM_WINDOWS)
+
+static bool CPUID_ReadOSTopology(Y_CPU_TOPOLOGY* pResult)
+{
+  DWORD bufferSize = 0;
+  if (GetLogicalProcessorInformation(nullptr, &bufferSize) || GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+    return false;
+
+  SYSTEM_LOGICAL_PROCESSOR_INFORMATION* pInfo = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION*)std::malloc(bufferSize);
+  if (!GetLogicalProcessorInformation(pInfo, &bufferSize))
+  {
+    std::free(pInfo);
+    return false;
+  }
+
+  uint64 processorMask = 0;
+  uint32 count = bufferSize / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
+  for (uint32 i = 0; i < count; i++)
+  {
+    uint64 mask = static_cast<uint64>(pInfo[i].ProcessorMask);
+    if (pInfo[i].Relationship == RelationProcessorCore && pResult->CoreCount < Y_CPU_TOPOLOGY_MAX_PROCESSORS)
+    {
+      pResult->CoreMasks[pResult->CoreCount++] = mask;
+      processorMask |= mask;
+    }
+    else if (pInfo[i].Relationship == RelationNumaNode && pResult->NodeCount < Y_CPU_TOPOLOGY_MAX_PROCESSORS)
+    {
+      pResult->NodeMasks[pResult->NodeCount++] = mask;
+    }
+  }
+
+  std::free(pInfo);
+  pResult->LogicalProcessorCount = CPUID_CountProcessors(processorMask);
+  if (pResult->NodeCount == 0)
+  {
+    pResult->NodeCount = 1;
+    pResult->NodeMasks[0] = processorMask;
+  }
+
+  return (pResult->CoreCount > 0);
+}
+
+#elif defined(Y_PLATFORM_LINUX) || defined(Y_PLATFORM_ANDROID)
+
+static bool CPUID_ReadSysfsValue(const char* path, uint32* pValue)
+{
+  FILE* pFile = fopen(path, "r");
+  if (pFile == nullptr)
+    return false;
+
+  bool result = (fscanf(pFile, "%u", pValue) == 1);
+  fclose(pFile);
+  return result;
+}
+
+// parses a processor list such as "0-3,8-11"
+static uint64 CPUID_ReadSysfsProcessorList(const char* path)
+{
+  FILE* pFile = fopen(path, "r");
+  if (pFile == nullptr)
+    return 0;
+
+  uint64 mask = 0;
+  for (;;)
+  {
+    uint32 first, last;
+    if (fscanf(pFile, "%u", &first) != 1)
+      break;
+
+    last = first;
+    int separator = fgetc(pFile);
+    if (separator == '-')
+    {
+      if (fscanf(pFile, "%u", &last) != 1)
+        break;
+
+      separator = fgetc(pFile);
+    }
+
+    for (uint32 i = first; i <= last && i < Y_CPU_TOPOLOGY_MAX_PROCESSORS; i++)
+      mask |= (uint64)1 << i;
+
+    if (separator != ',')
+      break;
+  }
+
+  fclose(pFile);
+  return mask;
+}
+
+static bool CPUID_ReadOSTopology(Y_CPU_TOPOLOGY* pResult)
+{
+  // cores are identified by package and core id, offline processors have no topology directory
+  char path[128];
+  uint64 coreKeys[Y_CPU_TOPOLOGY_MAX_PROCESSORS];
+  uint64 processorMask = 0;
+  for (uint32 cpu = 0; cpu < Y_CPU_TOPOLOGY_MAX_PROCESSORS; cpu++)
+  {
+    uint32 coreId, packageId;
+    Y_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/core_id", cpu);
+    if (!CPUID_ReadSysfsValue(path, &coreId))
+      continue;
+
+    Y_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", cpu);
+    if (!CPUID_ReadSysfsValue(path, &packageId))
+      packageId = 0;
+
+    uint64 key = ((uint64)packageId << 32) | coreId;
+    uint32 coreIndex = 0;
+    while (coreIndex < pResult->CoreCount && coreKeys[coreIndex] != key)
+      coreIndex++;
+
+    if (coreIndex == pResult->CoreCount)
+    {
+      coreKeys[coreIndex] = key;
+      pResult->CoreMasks[coreIndex] = 0;
+      pResult->CoreCount++;
+    }
+
+    pResult->CoreMasks[coreIndex] |= (uint64)1 << cpu;
+    processorMask |= (uint64)1 << cpu;
+  }
+
+  if (pResult->CoreCount == 0)
+    return false;
+
+  // node ids can be sparse, and the node directory is missing on kernels without NUMA support
+  for (uint32 node = 0; node < Y_CPU_TOPOLOGY_MAX_PROCESSORS; node++)
+  {
+    Y_snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+    uint64 mask = CPUID_ReadSysfsProcessorList(path) & processorMask;
+    if (mask != 0)
+      pResult->NodeMasks[pResult->NodeCount++] = mask;
+  }
+
+  pResult->LogicalProcessorCount = CPUID_CountProcessors(processorMask);
+  if (pResult->NodeCount == 0)
+  {
+    pResult->NodeCount = 1;
+    pResult->NodeMasks[0] = processorMask;
+  }
+
+  return true;
+}
+
+#else
+
+static bool CPUID_ReadOSTopology(Y_CPU_TOPOLOGY* pResult)
+{
+  return false;
+}
+
+#endif
+
+#if defined(Y_CPU_X86) || defined(Y_CPU_X64)
+
+static uint32 CPUID_ReadFeatureFlags()
+{
+  uint32 data[4];
+  CALL_CPUID(0x00000000, data);
+  uint32 maxBasicLevel = data[0];
+
+  uint32 leaf1Data[4];
+  CALL_CPUID(0x00000001, leaf1Data);
+
+  uint32 features = 0;
+  if (CheckBit(leaf1Data[3], 26))
+    features |= Y_CPU_FEATURE_SSE2;
+  if (CheckBit(leaf1Data[2], 9))
+    features |= Y_CPU_FEATURE_SSSE3;
+  if (CheckBit(leaf1Data[2], 19))
+    features |= Y_CPU_FEATURE_SSE41;
+  if (CheckBit(leaf1Data[2], 20))
+    features |= Y_CPU_FEATURE_SSE42;
+  if (CheckBit(leaf1Data[2], 23))
+    features |= Y_CPU_FEATURE_POPCNT;
+  if (CheckBit(leaf1Data[2], 1))
+    features |= Y_CPU_FEATURE_PCLMULQDQ;
+  if (CheckBit(leaf1Data[2], 25))
+    features |= Y_CPU_FEATURE_AES;
+
+  bool avxState = CPUID_OSSavesAVXState(leaf1Data);
+  if (avxState && CheckBit(leaf1Data[2], 28))
+    features |= Y_CPU_FEATURE_AVX;
+  if (avxState && CheckBit(leaf1Data[2], 12))
+    features |= Y_CPU_FEATURE_FMA;
+  if (avxState && CheckBit(leaf1Data[2], 29))
+    features |= Y_CPU_FEATURE_F16C;
+
+  if (maxBasicLevel >= 7)
+  {
+    // AVX-512 additionally needs the opmask and upper zmm state saved (XCR0 bits 5 to 7)
+    bool avx512State = avxState && ((CPUID_ReadXCR0() & 0xE0) == 0xE0);
+
+    CALL_CPUID_COUNT(0x00000007, 0, data);
+    if (CheckBit(data[1], 3))
+      features |= Y_CPU_FEATURE_BMI1;
+    if (CheckBit(data[1], 8))
+      features |= Y_CPU_FEATURE_BMI2;
+    if (avxState && CheckBit(data[1], 5))
+      features |= Y_CPU_FEATURE_AVX2;
+    if (avx512State && CheckBit(data[1], 16))
+      features |= Y_CPU_FEATURE_AVX512F;
+    if (avx512State && CheckBit(data[1], 16) && CheckBit(data[1], 30))
+      features |= Y_CPU_FEATURE_AVX512BW;
+
+    // the code using the SHA extensions also needs SSE4.1
+    if (CheckBit(data[1], 29) && CheckBit(leaf1Data[2], 19))
+      features |= Y_CPU_FEATURE_SHA;
+  }
+
+  // advanced power management leaf
+  CALL_CPUID(0x80000000, data);
+  if (data[0] >= 0x80000007)
+  {
+    CALL_CPUID(0x80000007, data);
+    if (CheckBit(data[3], 8))
+      features |= Y_CPU_FEATURE_INVARIANT_TSC;
+  }
+
+  return features;
+}
+
+// deterministic cache parameters, which AMD cpus only fill in on recent families
+static bool CPUID_ReadCacheInfo(Y_CPU_CACHE_INFO* pResult)
+{
+  uint32 data[4];
+  CALL_CPUID(0x00000000, data);
+  if (data[0] < 4)
+    return false;
+
+  for (uint32 index = 0;; index++)
+  {
+    CALL_CPUID_COUNT(0x00000004, index, data);
+    uint32 type = data[0] & 0x1F;
+    if (type == 0)
+      break;
+
+    // instruction caches are skipped, 1 is data and 3 unified
+    if (type == 2)
+      continue;
+
+    uint32 level = (data[0] >> 5) & 0x7;
+    uint32 lineSize = (data[1] & 0xFFF) + 1;
+    uint32 partitions = ((data[1] >> 12) & 0x3FF) + 1;
+    uint32 ways = (data[1] >> 22) + 1;
+    uint32 sets = data[2] + 1;
+    uint32 size = ways * partitions * lineSize * sets;
+    if (level == 1)
+    {
+      pResult->LineSize = lineSize;
+      pResult->L1DataSize = size;
+    }
+    else if (level == 2)
+    {
+      pResult->L2Size = size;
+    }
+    else if (level == 3)
+    {
+      pResult->L3Size = size;
+    }
+  }
+
+  return (pResult->LineSize != 0);
+}
+
+#elif defined(Y_CPU_ARM) || defined(Y_CPU_AARCH64)
+
+static uint32 CPUID_ReadFeatureFlags()
+{
+#if defined(Y_CPU_AARCH64) && (defined(Y_PLATFORM_LINUX) || defined(Y_PLATFORM_ANDROID))
+  // HWCAP_AES, HWCAP_PMULL, HWCAP_SHA2 and HWCAP_CRC32, which older headers don't define; AdvSIMD is always there
+  unsigned long hwcap = getauxval(AT_HWCAP);
+  uint32 features = Y_CPU_FEATURE_NEON;
+  if (hwcap & (1 << 3))
+    features |= Y_CPU_FEATURE_ARM_AES;
+  if (hwcap & (1 << 4))
+    features |= Y_CPU_FEATURE_ARM_PMULL;
+  if (hwcap & (1 << 6))
+    features |= Y_CPU_FEATURE_ARM_SHA2;
+  if (hwcap & (1 << 7))
+    features |= Y_CPU_FEATURE_ARM_CRC32;
+  return features;
+#elif defined(Y_CPU_AARCH64) && defined(Y_PLATFORM_OSX)
+  // every apple arm64 cpu has all of them
+  return Y_CPU_FEATURE_NEON | Y_CPU_FEATURE_ARM_CRC32 | Y_CPU_FEATURE_ARM_AES | Y_CPU_FEATURE_ARM_PMULL |
+         Y_CPU_FEATURE_ARM_SHA2;
+#elif defined(Y_CPU_ARM) && (defined(Y_PLATFORM_LINUX) || defined(Y_PLATFORM_ANDROID))
+  // HWCAP_NEON, and the ARMv8 extensions are reported through HWCAP2 in 32-bit mode
+  unsigned long hwcap2 = getauxval(AT_HWCAP2);
+  uint32 features = 0;
+  if (getauxval(AT_HWCAP) & (1 << 12))
+    features |= Y_CPU_FEATURE_NEON;
+  if (hwcap2 & (1 << 0))
+    features |= Y_CPU_FEATURE_ARM_AES;
+  if (hwcap2 & (1 << 1))
+    features |= Y_CPU_FEATURE_ARM_PMULL;
+  if (hwcap2 & (1 << 3))
+    features |= Y_CPU_FEATURE_ARM_SHA2;
+  if (hwcap2 & (1 << 4))
+    features |= Y_CPU_FEATURE_ARM_CRC32;
+  return features;
+#elif defined(Y_CPU_AARCH64)
+  return Y_CPU_FEATURE_NEON;
+#else
+  return 0;
+#endif
+}
+
+static bool CPUID_ReadCacheInfo(Y_CPU_CACHE_INFO* pResult)
+{
+  return false;
+}
+
+#else
+
+static uint32 CPUID_ReadFeatureFlags()
+{
+  return 0;
+}
+
+static bool CPUID_ReadCacheInfo(Y_CPU_CACHE_INFO* pResult)
+{
+  return false;
+}
+
+#endif
+
+#if defined(Y_PLATFORM_WINDOWS)
+
+static bool CPUID_ReadOSCacheInfo(Y_CPU_CACHE_INFO* pResult)
+{
+  DWORD bufferSize = 0;
+  if (GetLogicalProcessorInformation(nullptr, &bufferSize) || GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+    return false;
+
+  SYSTEM_LOGICAL_PROCESSOR_INFORMATION* pInfo = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION*)std::malloc(bufferSize);
+  if (!GetLogicalProcessorInformation(pInfo, &bufferSize))
+  {
+    std::free(pInfo);
+    return false;
+  }
+
+  // every core's caches are listed, they are all the same size
+  uint32 count = bufferSize / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
+  for (uint32 i = 0; i < count; i++)
+  {
+    const CACHE_DESCRIPTOR& cache = pInfo[i].Cache;
+    if (pInfo[i].Relationship != RelationCache || cache.Type == CacheInstruction || cache.Type == CacheTrace)
+      continue;
+
+    if (cache.Level == 1)
+    {
+      pResult->LineSize = cache.LineSize;
+      pResult->L1DataSize = cache.Size;
+    }
+    else if (cache.Level == 2)
+    {
+      pResult->L2Size = cache.Size;
+    }
+    else if (cache.Level == 3)
+    {
+      pResult->L3Size = cache.Size;
+    }
+  }
+
+  std::free(pInfo);
+  return (pResult->LineSize != 0);
+}
+
+#elif defined(Y_PLATFORM_LINUX) || defined(Y_PLATFORM_ANDROID)
+
+static bool CPUID_ReadOSCacheInfo(Y_CPU_CACHE_INFO* pResult)
+{
+  char path[128];
+  for (uint32 index = 0;; index++)
+  {
+    uint32 level;
+    Y_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/level", index);
+    if (!CPUID_ReadSysfsValue(path, &level))
+      break;
+
+    char type[16] = {};
+    Y_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/type", index);
+    FILE* pFile = fopen(path, "r");
+    if (pFile != nullptr)
+    {
+      if (fscanf(pFile, "%15s", type) != 1)
+        type[0] = 0;
+
+      fclose(pFile);
+    }
+    if (Y_strcmp(type, "Instruction") == 0)
+      continue;
+
+    // sizes are written with a suffix, such as "48K"
+    uint32 size = 0;
+    char suffix = 0;
+    Y_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/size", index);
+    pFile = fopen(path, "r");
+    if (pFile != nullptr)
+    {
+      if (fscanf(pFile, "%u%c", &size, &suffix) < 1)
+        size = 0;
+
+      fclose(pFile);
+    }
+    if (suffix == 'K')
+      size *= 1024;
+    else if (suffix == 'M')
+      size *= 1024 * 1024;
+
+    uint32 lineSize;
+    Y_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/coherency_line_size", index);
+    if (level == 1 && CPUID_ReadSysfsValue(path, &lineSize))
+    {
+      pResult->LineSize = lineSize;
+      pResult->L1DataSize = size;
+    }
+    else if (level == 2)
+    {
+      pResult->L2Size = size;
+    }
+    else if (level == 3)
+    {
+      pResult->L3Size = size;
+    }
+  }
+
+  return (pResult->LineSize != 0);
+}
+
+#elif defined(Y_PLATFORM_OSX)
+
+static bool CPUID_ReadOSCacheInfo(Y_CPU_CACHE_INFO* pResult)
+{
+  uint64 value;
+  size_t length = sizeof(value);
+  if (sysctlbyname("hw.cachelinesize", &value, &length, nullptr, 0) != 0)
+    return false;
+
+  pResult->LineSize = (uint32)value;
+  length = sizeof(value);
+  if (sysctlbyname("hw.l1dcachesize", &value, &length, nullptr, 0) == 0)
+    pResult->L1DataSize = (uint32)value;
+  length = sizeof(value);
+  if (sysctlbyname("hw.l2cachesize", &value, &length, nullptr, 0) == 0)
+    pResult->L2Size = (uint32)value;
+  length = sizeof(value);
+  if (sysctlbyname("hw.l3cachesize", &value, &length, nullptr, 0) == 0)
+    pResult->L3Size = (uint32)value;
+
+  return true;
+}
+
+#else
+
+static bool CPUID_ReadOSCacheInfo(Y_CPU_CACHE_INFO* pResult)
+{
+  return false;
+}
+
+#endif
+
+static void CPUID_GenerateFallbackTopology(Y_CPU_TOPOLOGY* pResult, uint32 processorCount)
+{
+  Y_memzero(pResult, sizeof(Y_CPU_TOPOLOGY));
+  pResult->LogicalProcessorCount = Min(Max(processorCount, (uint32)1), (uint32)Y_CPU_TOPOLOGY_MAX_PROCESSORS);
+  pResult->CoreCount = pResult->LogicalProcessorCount;
+  pResult->NodeCount = 1;
+  for (uint32 i = 0; i < pResult->LogicalProcessorCount; i++)
+  {
+    pResult->CoreMasks[i] = (uint64)1 << i;
+    pResult->NodeMasks[0] |= (uint64)1 << i;
+  }
+}
+
 static void CPUID_GenerateSummaryString(Y_CPUID_RESULT* pResult)
 {
   char tmp[128];
@@ -239,6 +755,8 @@ static void CPUID_GenerateSummaryString(Y_CPUID_RESULT* pResult)
     CONCAT_FMT("SSE4.2/");
   if (pResult->SupportsAVX)
     CONCAT_FMT("AVX/");
+  if (pResult->SupportsAVX2)
+    CONCAT_FMT("AVX2/");
 
   // remove trailing / if present
   uint32 len = Y_strlen(pResult->SummaryString);
@@ -256,9 +774,102 @@ void Y_ReadCPUID(Y_CPUID_RESULT* pResult)
     Y_memzero(&CachedResult, sizeof(CachedResult));
     CPUID_ReadCPUData(&CachedResult);
     CPUID_ReadOSData(&CachedResult);
+
+    // prefer the OS's count of physical cores over guessing from the HTT flag
+    Y_CPU_TOPOLOGY topology;
+    Y_memzero(&topology, sizeof(topology));
+    if (CPUID_ReadOSTopology(&topology) && topology.LogicalProcessorCount == CachedResult.ThreadCount)
+      CachedResult.ProcessorCount = topology.CoreCount;
+
     CPUID_GenerateSummaryString(&CachedResult);
     CachedResultFilled = true;
   }
 
   std::memcpy(pResult, &CachedResult, sizeof(CachedResult));
 }
+
+uint32 Y_GetCPUFeatures()
+{
+  static const uint32 features = CPUID_ReadFeatureFlags();
+  return features;
+}
+
+bool Y_CPUSupportsAVX2()
+{
+  return Y_CPUHasFeatures(Y_CPU_FEATURE_AVX2);
+}
+
+bool Y_CPUSupportsPCLMULQDQ()
+{
+  return Y_CPUHasFeatures(Y_CPU_FEATURE_PCLMULQDQ);
+}
+
+bool Y_CPUSupportsSHA()
+{
+  return Y_CPUHasFeatures(Y_CPU_FEATURE_SHA);
+}
+
+bool Y_CPUSupportsInvariantTSC()
+{
+  return Y_CPUHasFeatures(Y_CPU_FEATURE_INVARIANT_TSC);
+}
+
+bool Y_CPUSupportsARMSHA2()
+{
+  return Y_CPUHasFeatures(Y_CPU_FEATURE_ARM_SHA2);
+}
+
+bool Y_CPUSupportsARMCRC32()
+{
+  return Y_CPUHasFeatures(Y_CPU_FEATURE_ARM_CRC32);
+}
+
+void Y_ReadCPUCacheInfo(Y_CPU_CACHE_INFO* pResult)
+{
+  static Y_CPU_CACHE_INFO CachedResult;
+  static bool CachedResultFilled = false;
+  if (!CachedResultFilled)
+  {
+    Y_memzero(&CachedResult, sizeof(CachedResult));
+    if (!CPUID_ReadOSCacheInfo(&CachedResult))
+    {
+      Y_memzero(&CachedResult, sizeof(CachedResult));
+      if (!CPUID_ReadCacheInfo(&CachedResult))
+      {
+        Y_memzero(&CachedResult, sizeof(CachedResult));
+        CachedResult.LineSize = 64;
+      }
+    }
+
+    CachedResultFilled = true;
+  }
+
+  std::memcpy(pResult, &CachedResult, sizeof(CachedResult));
+}
+
+uint32 Y_GetCacheLineSize()
+{
+  Y_CPU_CACHE_INFO cacheInfo;
+  Y_ReadCPUCacheInfo(&cacheInfo);
+  return cacheInfo.LineSize;
+}
+
+void Y_ReadCPUTopology(Y_CPU_TOPOLOGY* pResult)
+{
+  static Y_CPU_TOPOLOGY CachedResult;
+  static bool CachedResultFilled = false;
+  if (!CachedResultFilled)
+  {
+    Y_memzero(&CachedResult, sizeof(CachedResult));
+    if (!CPUID_ReadOSTopology(&CachedResult))
+    {
+      Y_CPUID_RESULT cpuidResult;
+      Y_ReadCPUID(&cpuidResult);
+      CPUID_GenerateFallbackTopology(&CachedResult, cpuidResult.ThreadCount);
+    }
+
+    CachedResultFilled = true;
+  }
+
+  std::memcpy(pResult, &CachedResult, sizeof(CachedResult));
+}
@@ -1,8 +1,252 @@
 #include "YBaseLib/CRC32.h"
 #include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CPUID.h"
 #include "YBaseLib/String.h"
+#include <cstring>
 
-static uint32 Crc32_ComputeBuf(uint32 inCrc32, const void* buf, size_t bufLen);
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#define Y_CRC32_PCLMUL 1
+#if defined(Y_COMPILER_MSVC)
+#include <intrin.h>
+#define CRC32_PCLMUL_FUNCTION
+#else
+#define CRC32_PCLMUL_FUNCTION __attribute__((target("pclmul")))
+#endif
+#elif defined(Y_CPU_AARCH64) && (defined(Y_COMPILER_GCC) || defined(Y_COMPILER_CLANG))
+#include <arm_acle.h>
+#define Y_CRC32_ARM 1
+#if defined(Y_COMPILER_CLANG)
+#define CRC32_ARM_FUNCTION __attribute__((target("crc")))
+#else
+#define CRC32_ARM_FUNCTION __attribute__((target("+crc")))
+#endif
+#endif
+
+// Buffers are hashed 8 bytes at a time through slicing tables, or on x86 folded 64 bytes at a time with carry-less
+// multiplication when the cpu has it, and on ARMv8 with its CRC32 instructions. The faster paths are compiled for
+// their targets on their own, and only called once CPUID says they can be.
+
+// http://csbruce.com/software/crc32.c
+static const uint32 s_crcTable[256] = {
+  0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3, 0x0EDB8832,
+  0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91, 0x1DB71064, 0x6AB020F2,
+  0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7, 0x136C9856, 0x646BA8C0, 0xFD62F97A,
+  0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5, 0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
+  0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B, 0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3,
+  0x45DF5C75, 0xDCD60DCF, 0xABD13D59, 0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423,
+  0xCFBA9599, 0xB8BDA50F, 0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB,
+  0xB6662D3D, 0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+  0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01, 0x6B6B51F4,
+  0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457, 0x65B0D9C6, 0x12B7E950,
+  0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65, 0x4DB26158, 0x3AB551CE, 0xA3BC0074,
+  0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB, 0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
+  0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9, 0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525,
+  0x206F85B3, 0xB966D409, 0xCE61E49F, 0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81,
+  0xB7BD5C3B, 0xC0BA6CAD, 0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615,
+  0x73DC1683, 0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+  0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7, 0xFED41B76,
+  0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5, 0xD6D6A3E8, 0xA1D1937E,
+  0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B, 0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6,
+  0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79, 0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
+  0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F, 0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7,
+  0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D, 0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F,
+  0x72076785, 0x05005713, 0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7,
+  0x0BDBDF21, 0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+  0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45, 0xA00AE278,
+  0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB, 0xAED16A4A, 0xD9D65ADC,
+  0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9, 0xBDBDF21C, 0xCABAC28A, 0x53B39330,
+  0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF, 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
+  0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D};
+
+// s_sliceTable[n][i] is the crc of byte i followed by n zero bytes, so eight table lookups advance eight bytes
+static uint32 s_sliceTable[8][256];
+
+static bool Crc32_BuildSliceTable()
+{
+  for (uint32 i = 0; i < 256; i++)
+  {
+    uint32 crc = s_crcTable[i];
+    s_sliceTable[0][i] = crc;
+    for (uint32 n = 1; n < 8; n++)
+    {
+      crc = (crc >> 8) ^ s_crcTable[crc & 0xFF];
+      s_sliceTable[n][i] = crc;
+    }
+  }
+
+  return true;
+}
+
+// false until static initialization gets here, anything hashed before that goes a byte at a time
+static const bool s_sliceTableBuilt = Crc32_BuildSliceTable();
+
+// these take and return the crc without the pre and post inversion
+static uint32 Crc32_ComputeBytes(uint32 crc, const byte* pBytes, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+    crc = (crc >> 8) ^ s_crcTable[(crc ^ pBytes[i]) & 0xFF];
+
+  return crc;
+}
+
+static uint32 Crc32_ComputeSliced(uint32 crc, const byte* pBytes, size_t length)
+{
+  for (; length >= 8; pBytes += 8, length -= 8)
+  {
+    uint32 low = crc ^ ((uint32)pBytes[0] | ((uint32)pBytes[1] << 8) | ((uint32)pBytes[2] << 16) |
+                        ((uint32)pBytes[3] << 24));
+    crc = s_sliceTable[7][low & 0xFF] ^ s_sliceTable[6][(low >> 8) & 0xFF] ^ s_sliceTable[5][(low >> 16) & 0xFF] ^
+          s_sliceTable[4][low >> 24] ^ s_sliceTable[3][pBytes[4]] ^ s_sliceTable[2][pBytes[5]] ^
+          s_sliceTable[1][pBytes[6]] ^ s_sliceTable[0][pBytes[7]];
+  }
+
+  return Crc32_ComputeBytes(crc, pBytes, length);
+}
+
+#if defined(Y_CRC32_PCLMUL)
+
+// Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction", with the constants for the
+// reflected polynomial. Four 16 byte lanes are folded forward 64 bytes at a time, then into one lane, then reduced
+// to 32 bits. The length must be a multiple of 16, at least 64.
+static CRC32_PCLMUL_FUNCTION uint32 Crc32_FoldPCLMUL(uint32 crc, const byte* pBytes, size_t length)
+{
+  static const uint64 k1k2[2] = {0x0154442BD4ULL, 0x01C6E41596ULL};
+  static const uint64 k3k4[2] = {0x01751997D0ULL, 0x00CCAA009EULL};
+  static const uint64 k5k0[2] = {0x0163CD6124ULL, 0x0000000000ULL};
+  static const uint64 poly[2] = {0x01DB710641ULL, 0x01F7011641ULL};
+
+  __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBytes + 0x00));
+  __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBytes + 0x10));
+  __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBytes + 0x20));
+  __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBytes + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+  pBytes += 64;
+  length -= 64;
+
+  __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(k1k2));
+  for (; length >= 64; pBytes += 64, length -= 64)
+  {
+    __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+    __m128i x6 = _mm_clmulepi64_si128(x2, k, 0x00);
+    __m128i x7 = _mm_clmulepi64_si128(x3, k, 0x00);
+    __m128i x8 = _mm_clmulepi64_si128(x4, k, 0x00);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k, 0x11), x5);
+    x2 = _mm_xor_si128(_mm_clmulepi64_si128(x2, k, 0x11), x6);
+    x3 = _mm_xor_si128(_mm_clmulepi64_si128(x3, k, 0x11), x7);
+    x4 = _mm_xor_si128(_mm_clmulepi64_si128(x4, k, 0x11), x8);
+    x1 = _mm_xor_si128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBytes + 0x00)));
+    x2 = _mm_xor_si128(x2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBytes + 0x10)));
+    x3 = _mm_xor_si128(x3, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBytes + 0x20)));
+    x4 = _mm_xor_si128(x4, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBytes + 0x30)));
+  }
+
+  // fold the lanes into one, then any remaining 16 byte blocks into it
+  k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(k3k4));
+  __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k, 0x11), x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k, 0x11), x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k, 0x11), x4), x5);
+  for (; length >= 16; pBytes += 16, length -= 16)
+  {
+    x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBytes));
+    x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k, 0x11), x2), x5);
+  }
+
+  // 128 bits to 64
+  __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+  x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  k = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x00), x2);
+
+  // barrett reduction to 32
+  k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(poly));
+  x2 = _mm_and_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x10), mask);
+  x1 = _mm_xor_si128(x1, _mm_clmulepi64_si128(x2, k, 0x00));
+  return (uint32)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+
+#elif defined(Y_CRC32_ARM)
+
+static CRC32_ARM_FUNCTION uint32 Crc32_ComputeARM(uint32 crc, const byte* pBytes, size_t length)
+{
+  for (; length >= 8; pBytes += 8, length -= 8)
+  {
+    uint64 value;
+    std::memcpy(&value, pBytes, sizeof(value));
+    crc = __crc32d(crc, value);
+  }
+
+  for (; length > 0; pBytes++, length--)
+    crc = __crc32b(crc, *pBytes);
+
+  return crc;
+}
+
+#endif
+
+static uint32 Crc32_ComputePortable(uint32 crc, const byte* pBytes, size_t length)
+{
+  return s_sliceTableBuilt ? Crc32_ComputeSliced(crc, pBytes, length) : Crc32_ComputeBytes(crc, pBytes, length);
+}
+
+#if defined(Y_CRC32_PCLMUL)
+
+static uint32 Crc32_ComputeWithPCLMUL(uint32 crc, const byte* pBytes, size_t length)
+{
+  if (length >= 64)
+  {
+    size_t foldLength = length & ~(size_t)15;
+    crc = Crc32_FoldPCLMUL(crc, pBytes, foldLength);
+    pBytes += foldLength;
+    length -= foldLength;
+  }
+
+  return Crc32_ComputePortable(crc, pBytes, length);
+}
+
+#endif
+
+static decltype(&Crc32_ComputePortable) Crc32_SelectCompute()
+{
+#if defined(Y_CRC32_PCLMUL)
+  if (Y_CPUHasFeatures(Y_CPU_FEATURE_PCLMULQDQ))
+    return Crc32_ComputeWithPCLMUL;
+#elif defined(Y_CRC32_ARM)
+  if (Y_CPUHasFeatures(Y_CPU_FEATURE_ARM_CRC32))
+    return Crc32_ComputeARM;
+#endif
+
+  return Crc32_ComputePortable;
+}
+
+Y_CPU_DISPATCH(s_pCrc32Compute, Crc32_ComputePortable, Crc32_SelectCompute);
+
+static uint32 Crc32_ComputeBuf(uint32 inCrc32, const void* buf, size_t bufLen)
+{
+  return (s_pCrc32Compute(inCrc32 ^ 0xFFFFFFFF, reinterpret_cast<const byte*>(buf), bufLen) ^ 0xFFFFFFFF);
+}
+
+// Multiplies two polynomials modulo the crc polynomial, in its reflected bit order, where bit 31 is x^0.
+static uint32 Crc32_MultiplyModP(uint32 a, uint32 b)
+{
+  uint32 result = 0;
+  for (uint32 bit = 0x80000000; bit != 0; bit >>= 1)
+  {
+    if (a & bit)
+      result ^= b;
+
+    b = (b & 1) ? ((b >> 1) ^ 0xEDB88320) : (b >> 1);
+  }
+
+  return result;
+}
 
 CRC32::CRC32(uint32 start /*= 0*/) : m_currentCRC(start) {}
 
@@ -32,7 +276,25 @@ bool CRC32::HashStream(ByteStream* pStream, bool seekToStart /* = false */, bool
 
 bool CRC32::HashStreamPartial(ByteStream* pStream, uint64 count)
 {
-  static const uint32 BUFFER_SIZE = 1024;
+  // hash the stream's memory in place when it can be
+  if (pStream->GetViewFlags() & BYTESTREAM_VIEW_READ)
+  {
+    while (count > 0)
+    {
+      const void* pView;
+      uint32 viewSize = pStream->AcquireReadView((uint32)Min(count, (uint64)0xFFFFFFFF), &pView);
+      if (viewSize == 0)
+        return false;
+
+      m_currentCRC = Crc32_ComputeBuf(m_currentCRC, pView, viewSize);
+      pStream->ReleaseReadView(viewSize);
+      count -= viewSize;
+    }
+
+    return true;
+  }
+
+  static const uint32 BUFFER_SIZE = 16384;
   byte buffer[BUFFER_SIZE];
   while (count > 0)
   {
@@ -47,54 +309,23 @@ bool CRC32::HashStreamPartial(ByteStream* pStream, uint64 count)
   return true;
 }
 
-void CRC32::Reset()
+uint32 CRC32::Combine(uint32 crcA, uint32 crcB, uint64 lengthB)
 {
-  m_currentCRC = 0;
+  // appending lengthB bytes multiplies crcA by x^(8 * lengthB), worked out by squaring from x^8
+  uint32 shift = 0x80000000;
+  for (uint32 power = 0x00800000; lengthB != 0; lengthB >>= 1)
+  {
+    if (lengthB & 1)
+      shift = Crc32_MultiplyModP(shift, power);
+
+    power = Crc32_MultiplyModP(power, power);
+  }
+
+  return Crc32_MultiplyModP(shift, crcA) ^ crcB;
 }
 
-// http://csbruce.com/software/crc32.c
-static uint32 Crc32_ComputeBuf(uint32 inCrc32, const void* buf, size_t bufLen)
+void CRC32::Reset()
 {
-  static const unsigned long crcTable[256] = {
-    0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3, 0x0EDB8832,
-    0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91, 0x1DB71064, 0x6AB020F2,
-    0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7, 0x136C9856, 0x646BA8C0, 0xFD62F97A,
-    0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5, 0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
-    0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B, 0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3,
-    0x45DF5C75, 0xDCD60DCF, 0xABD13D59, 0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423,
-    0xCFBA9599, 0xB8BDA50F, 0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB,
-    0xB6662D3D, 0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
-    0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01, 0x6B6B51F4,
-    0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457, 0x65B0D9C6, 0x12B7E950,
-    0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65, 0x4DB26158, 0x3AB551CE, 0xA3BC0074,
-    0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB, 0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
-    0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9, 0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525,
-    0x206F85B3, 0xB966D409, 0xCE61E49F, 0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81,
-    0xB7BD5C3B, 0xC0BA6CAD, 0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615,
-    0x73DC1683, 0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
-    0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7, 0xFED41B76,
-    0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5, 0xD6D6A3E8, 0xA1D1937E,
-    0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B, 0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6,
-    0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79, 0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
-    0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F, 0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7,
-    0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D, 0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F,
-    0x72076785, 0x05005713, 0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7,
-    0x0BDBDF21, 0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
-    0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45, 0xA00AE278,
-    0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB, 0xAED16A4A, 0xD9D65ADC,
-    0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9, 0xBDBDF21C, 0xCABAC28A, 0x53B39330,
-    0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF, 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
-    0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D};
-  unsigned long crc32;
-  unsigned char* byteBuf;
-  size_t i;
-
-  /** accumulate crc32 for buffer **/
-  crc32 = inCrc32 ^ 0xFFFFFFFF;
-  byteBuf = (unsigned char*)buf;
-  for (i = 0; i < bufLen; i++)
-  {
-    crc32 = (crc32 >> 8) ^ crcTable[(crc32 ^ byteBuf[i]) & 0xFF];
-  }
-  return (crc32 ^ 0xFFFFFFFF);
+  m_currentCRC = 0;
 }
+
@@ -0,0 +1,459 @@
+#include "YBaseLib/CSVTable.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/NumberConversion.h"
+#include "YBaseLib/ParallelFor.h"
+#include "YBaseLib/TextReader.h"
+#include <cstring>
+Log_SetChannel(CSVTable);
+
+namespace {
+// what a chunk has seen in a column, in the order types widen
+enum FIELD_KIND
+{
+  FIELD_KIND_EMPTY,
+  FIELD_KIND_INT64,
+  FIELD_KIND_DOUBLE,
+  FIELD_KIND_STRING,
+};
+
+struct Field
+{
+  StringView Text;
+  bool HasQuotes;
+};
+
+struct Chunk
+{
+  uint32 FirstRecord;
+  uint32 RecordCount;
+
+  // the first bad record, as its offset in the stream and its field count, or ~0 if its quotes are broken
+  bool Failed;
+  uint64 ErrorOffset;
+  uint32 ErrorFieldCount;
+};
+
+// where the chunks are, and how their records are split
+struct Records
+{
+  const char* pText;
+  const char* pData;
+  uint64 DataLength;
+  uint32 ChunkSize;
+  char Delimiter;
+  uint32 ColumnCount;
+};
+} // namespace
+
+// The field at *ppPosition, moving past it but not the delimiter after it. Quoted fields are given without their
+// quotes, with HasQuotes set if there's a "" inside. Returns false if a quote isn't closed, or is followed by
+// anything but the delimiter.
+static bool SplitField(const char** ppPosition, const char* pEnd, char delimiter, Field* pField)
+{
+  const char* pPosition = *ppPosition;
+  pField->HasQuotes = false;
+  if (pPosition == pEnd || *pPosition != '"')
+  {
+    const char* pDelimiter = static_cast<const char*>(std::memchr(pPosition, delimiter, size_t(pEnd - pPosition)));
+    if (pDelimiter == nullptr)
+      pDelimiter = pEnd;
+
+    pField->Text = StringView(pPosition, pDelimiter);
+    *ppPosition = pDelimiter;
+    return true;
+  }
+
+  const char* pStart = ++pPosition;
+  for (;;)
+  {
+    const char* pQuote = static_cast<const char*>(std::memchr(pPosition, '"', size_t(pEnd - pPosition)));
+    if (pQuote == nullptr)
+      return false;
+
+    if ((pQuote + 1) != pEnd && pQuote[1] == '"')
+    {
+      pField->HasQuotes = true;
+      pPosition = pQuote + 2;
+      continue;
+    }
+
+    pPosition = pQuote + 1;
+    if (pPosition != pEnd && *pPosition != delimiter)
+      return false;
+
+    pField->Text = StringView(pStart, pQuote);
+    *ppPosition = pPosition;
+    return true;
+  }
+}
+
+static bool SplitRecord(const StringView& line, char delimiter, PODArray<Field>& fields)
+{
+  const char* pPosition = line.GetData();
+  const char* pEnd = pPosition + line.GetLength();
+  fields.Clear();
+  for (;;)
+  {
+    Field field;
+    if (!SplitField(&pPosition, pEnd, delimiter, &field))
+      return false;
+
+    fields.Add(field);
+    if (pPosition == pEnd)
+      return true;
+
+    // past the delimiter, there's always another field, even if it's empty
+    pPosition++;
+  }
+}
+
+// a quoted field's length with each "" as one quote
+static uint32 GetUnquotedLength(const Field& field)
+{
+  if (!field.HasQuotes)
+    return field.Text.GetLength();
+
+  uint32 quoteCount = 0;
+  for (uint32 i = 0; i < field.Text.GetLength(); i++)
+    quoteCount += (field.Text.GetData()[i] == '"') ? 1 : 0;
+
+  return field.Text.GetLength() - quoteCount / 2;
+}
+
+// copies the field's text with each "" as one quote, returning the length
+static uint32 CopyField(const Field& field, char* pDestination)
+{
+  const char* pText = field.Text.GetData();
+  uint32 textLength = field.Text.GetLength();
+  if (!field.HasQuotes)
+  {
+    std::memcpy(pDestination, pText, textLength);
+    return textLength;
+  }
+
+  uint32 length = 0;
+  for (uint32 i = 0; i < textLength; i++)
+  {
+    pDestination[length++] = pText[i];
+    if (pText[i] == '"')
+      i++;
+  }
+
+  return length;
+}
+
+static FIELD_KIND ClassifyField(const Field& field)
+{
+  const StringView& text = field.Text;
+  if (text.IsEmpty())
+    return FIELD_KIND_EMPTY;
+  if (field.HasQuotes)
+    return FIELD_KIND_STRING;
+
+  // integers only if they'd be written the same back, so nothing's lost to padding, signs or saturation
+  int64 int64Value;
+  char buffer[NumberConversion::MaxIntegerLength];
+  if (text.GetLength() <= NumberConversion::MaxIntegerLength &&
+      NumberConversion::ParseInt64(text, &int64Value) == text.GetLength() &&
+      NumberConversion::FormatInt64(buffer, int64Value) == text.GetLength() &&
+      std::memcmp(buffer, text.GetData(), text.GetLength()) == 0)
+  {
+    return FIELD_KIND_INT64;
+  }
+
+  double doubleValue;
+  if (NumberConversion::ParseDouble(text, &doubleValue) == text.GetLength())
+    return FIELD_KIND_DOUBLE;
+
+  return FIELD_KIND_STRING;
+}
+
+// calls body(fields) for every record of a chunk, stopping at a broken one
+template<class T>
+static void ForEachRecord(const Records& records, uint32 chunkIndex, Chunk& chunk, const T& body)
+{
+  const char* pData = records.pData;
+  uint64 chunkStart = uint64(chunkIndex) * records.ChunkSize;
+  const char* pPosition = pData + TextReader::FindLineStart(pData, records.DataLength, chunkStart);
+  const char* pEnd = pData + TextReader::FindLineStart(pData, records.DataLength, chunkStart + records.ChunkSize);
+  PODArray<Field> fields;
+  StringView line;
+  while (TextReader::SplitLine(&pPosition, pEnd, &line))
+  {
+    if (line.IsEmpty())
+      continue;
+
+    bool split = SplitRecord(line, records.Delimiter, fields);
+    if (!split || fields.GetSize() != records.ColumnCount)
+    {
+      chunk.Failed = true;
+      chunk.ErrorOffset = uint64(line.GetData() - records.pText);
+      chunk.ErrorFieldCount = split ? fields.GetSize() : 0xFFFFFFFF;
+      return;
+    }
+
+    body(fields);
+  }
+}
+
+static uint32 GetLineNumber(const char* pText, uint64 offset)
+{
+  uint32 line = 1;
+  const char* pPosition = pText;
+  const char* pEnd = pText + offset;
+  while ((pPosition = static_cast<const char*>(std::memchr(pPosition, '\n', size_t(pEnd - pPosition)))) != nullptr)
+  {
+    pPosition++;
+    line++;
+  }
+
+  return line;
+}
+
+CSVTable::CSVTable() : m_recordCount(0) {}
+
+CSVTable::~CSVTable()
+{
+  Clear();
+}
+
+void CSVTable::Clear()
+{
+  for (uint32 i = 0; i < m_columns.GetSize(); i++)
+    delete m_columns[i];
+
+  m_columns.Obliterate();
+  m_recordCount = 0;
+}
+
+bool CSVTable::Parse(ThreadPool* pThreadPool, ByteStream* pStream, const char* FileName, char delimiter /* = ',' */,
+                     bool hasHeader /* = true */, uint32 chunkSize /* = ParallelTextReaderChunkSize */)
+{
+  DebugAssert(chunkSize > 0 && delimiter != '"' && delimiter != '\n');
+  Clear();
+
+  const char* pText = reinterpret_cast<const char*>(pStream->GetBasePointer());
+  if (pText == nullptr)
+  {
+    Log_ErrorPrintf("CSVTable::Parse: %s is not in memory.", FileName);
+    return false;
+  }
+
+  // the first line with anything on it sets the columns, and is their names if there's a header
+  uint64 textLength = pStream->GetSize();
+  const char* pPosition = pText;
+  const char* pTextEnd = pText + textLength;
+  StringView line;
+  PODArray<Field> fields;
+  while (TextReader::SplitLine(&pPosition, pTextEnd, &line) && line.IsEmpty()) {}
+  if (line.IsEmpty())
+    return true;
+
+  if (!SplitRecord(line, delimiter, fields))
+  {
+    Log_ErrorPrintf("CSVTable::Parse: %s:%u: unterminated quote, or text after a closing quote.", FileName,
+                    GetLineNumber(pText, uint64(line.GetData() - pText)));
+    return false;
+  }
+
+  uint32 columnCount = fields.GetSize();
+  m_columns.Resize(columnCount);
+  for (uint32 i = 0; i < columnCount; i++)
+  {
+    Column* pColumn = new Column();
+    if (hasHeader)
+    {
+      pColumn->Name.Resize(GetUnquotedLength(fields[i]));
+      CopyField(fields[i], pColumn->Name.GetWriteableCharArray());
+    }
+
+    m_columns[i] = pColumn;
+  }
+
+  // the rest is split into chunks, which are read independently, each writing only its own entries
+  uint64 dataStart = hasHeader ? uint64(pPosition - pText) : uint64(line.GetData() - pText);
+  const char* pData = pText + dataStart;
+  uint64 dataLength = textLength - dataStart;
+  uint64 chunkCount64 = (dataLength + chunkSize - 1) / chunkSize;
+  if (chunkCount64 > 0xFFFFFFFF / Max(columnCount, 1u))
+  {
+    Log_ErrorPrintf("CSVTable::Parse: %s is too large.", FileName);
+    Clear();
+    return false;
+  }
+
+  uint32 chunkCount = uint32(chunkCount64);
+  PODArray<Chunk> chunks;
+  PODArray<uint8> chunkKinds;
+  PODArray<uint64> chunkStringLengths;
+  chunks.Resize(chunkCount);
+  chunkKinds.Resize(chunkCount * columnCount);
+  chunkStringLengths.Resize(chunkCount * columnCount);
+
+  Records records = {pText, pData, dataLength, chunkSize, delimiter, columnCount};
+
+  // first the records are counted, with the widest type and the total string length of each column
+  ParallelFor(pThreadPool, 0, chunkCount, 1, [&](uint32 chunkIndex) {
+    Chunk& chunk = chunks[chunkIndex];
+    uint8* pKinds = chunkKinds.GetBasePointer() + chunkIndex * columnCount;
+    uint64* pStringLengths = chunkStringLengths.GetBasePointer() + chunkIndex * columnCount;
+    chunk.RecordCount = 0;
+    chunk.Failed = false;
+    std::memset(pKinds, FIELD_KIND_EMPTY, columnCount);
+    std::memset(pStringLengths, 0, sizeof(uint64) * columnCount);
+    ForEachRecord(records, chunkIndex, chunk, [&](const PODArray<Field>& fields) {
+      for (uint32 i = 0; i < columnCount; i++)
+      {
+        pKinds[i] = Max(pKinds[i], uint8(ClassifyField(fields[i])));
+        pStringLengths[i] += GetUnquotedLength(fields[i]);
+      }
+      chunk.RecordCount++;
+    });
+  });
+
+  // then each chunk is given where its records and strings start
+  uint64 recordCount = 0;
+  for (uint32 chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+  {
+    const Chunk& chunk = chunks[chunkIndex];
+    if (chunk.Failed)
+    {
+      uint32 lineNumber = GetLineNumber(pText, chunk.ErrorOffset);
+      if (chunk.ErrorFieldCount == 0xFFFFFFFF)
+      {
+        Log_ErrorPrintf("CSVTable::Parse: %s:%u: unterminated quote, or text after a closing quote.", FileName,
+                        lineNumber);
+      }
+      else
+      {
+        Log_ErrorPrintf("CSVTable::Parse: %s:%u: record has %u fields, expected %u.", FileName, lineNumber,
+                        chunk.ErrorFieldCount, columnCount);
+      }
+
+      Clear();
+      return false;
+    }
+
+    chunks[chunkIndex].FirstRecord = uint32(recordCount);
+    recordCount += chunk.RecordCount;
+  }
+
+  if (recordCount >= 0xFFFFFFFF)
+  {
+    Log_ErrorPrintf("CSVTable::Parse: %s has too many records.", FileName);
+    Clear();
+    return false;
+  }
+
+  for (uint32 i = 0; i < columnCount; i++)
+  {
+    Column* pColumn = m_columns[i];
+    uint8 kind = FIELD_KIND_EMPTY;
+    uint64 stringLength = 0;
+    for (uint32 chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+    {
+      kind = Max(kind, chunkKinds[chunkIndex * columnCount + i]);
+      uint64 chunkStringLength = chunkStringLengths[chunkIndex * columnCount + i];
+      chunkStringLengths[chunkIndex * columnCount + i] = stringLength;
+      stringLength += chunkStringLength;
+    }
+
+    // a column with nothing in it is empty strings
+    if (kind == FIELD_KIND_INT64)
+    {
+      pColumn->Type = CSV_COLUMN_TYPE_INT64;
+      pColumn->Int64Values.Resize(uint32(recordCount));
+    }
+    else if (kind == FIELD_KIND_DOUBLE)
+    {
+      pColumn->Type = CSV_COLUMN_TYPE_DOUBLE;
+      pColumn->DoubleValues.Resize(uint32(recordCount));
+    }
+    else
+    {
+      if (stringLength > 0xFFFFFFFF)
+      {
+        Log_ErrorPrintf("CSVTable::Parse: %s has too much text in column %u.", FileName, i);
+        Clear();
+        return false;
+      }
+
+      pColumn->Type = CSV_COLUMN_TYPE_STRING;
+      pColumn->StringData.Resize(uint32(stringLength));
+      pColumn->StringOffsets.Resize(uint32(recordCount) + 1);
+      pColumn->StringOffsets[uint32(recordCount)] = uint32(stringLength);
+    }
+  }
+
+  // and the second pass converts the values into place
+  Column* const* ppColumns = m_columns.GetBasePointer();
+  ParallelFor(pThreadPool, 0, chunkCount, 1, [&](uint32 chunkIndex) {
+    Chunk& chunk = chunks[chunkIndex];
+    uint64* pStringOffsets = chunkStringLengths.GetBasePointer() + chunkIndex * columnCount;
+    uint32 record = chunk.FirstRecord;
+    ForEachRecord(records, chunkIndex, chunk, [&](const PODArray<Field>& fields) {
+      for (uint32 i = 0; i < columnCount; i++)
+      {
+        Column* pColumn = ppColumns[i];
+        const Field& field = fields[i];
+        switch (pColumn->Type)
+        {
+          case CSV_COLUMN_TYPE_INT64:
+            NumberConversion::ParseInt64(field.Text, &pColumn->Int64Values[record]);
+            break;
+
+          case CSV_COLUMN_TYPE_DOUBLE:
+            NumberConversion::ParseDouble(field.Text, &pColumn->DoubleValues[record]);
+            break;
+
+          default:
+          {
+            uint32 offset = uint32(pStringOffsets[i]);
+            pColumn->StringOffsets[record] = offset;
+            pStringOffsets[i] += CopyField(field, pColumn->StringData.GetBasePointer() + offset);
+          }
+          break;
+        }
+      }
+      record++;
+    });
+  });
+
+  m_recordCount = uint32(recordCount);
+  return true;
+}
+
+int32 CSVTable::FindColumn(const char* name) const
+{
+  for (uint32 i = 0; i < m_columns.GetSize(); i++)
+  {
+    if (m_columns[i]->Name.Compare(name))
+      return int32(i);
+  }
+
+  return -1;
+}
+
+const int64* CSVTable::GetInt64Column(uint32 column) const
+{
+  const Column* pColumn = m_columns[column];
+  return (pColumn->Type == CSV_COLUMN_TYPE_INT64) ? pColumn->Int64Values.GetBasePointer() : nullptr;
+}
+
+const double* CSVTable::GetDoubleColumn(uint32 column) const
+{
+  const Column* pColumn = m_columns[column];
+  return (pColumn->Type == CSV_COLUMN_TYPE_DOUBLE) ? pColumn->DoubleValues.GetBasePointer() : nullptr;
+}
+
+StringView CSVTable::GetString(uint32 column, uint32 record) const
+{
+  const Column* pColumn = m_columns[column];
+  if (pColumn->Type != CSV_COLUMN_TYPE_STRING)
+    return StringView();
+
+  uint32 start = pColumn->StringOffsets[record];
+  return StringView(pColumn->StringData.GetBasePointer() + start, pColumn->StringOffsets[record + 1] - start);
+}
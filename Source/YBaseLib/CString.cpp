@@ -1,6 +1,8 @@
 #include "YBaseLib/CString.h"
 #include "YBaseLib/Assert.h"
+#include "YBaseLib/CPUID.h"
 #include "YBaseLib/Memory.h"
+#include "YBaseLib/NumberConversion.h"
 
 // call into system CRT
 #include <cctype>
@@ -13,6 +15,372 @@
 #define strtoull _strtoui64
 #endif
 
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <emmintrin.h>
+#include <immintrin.h>
+#define Y_CSTRING_SSE2 1
+#define Y_CSTRING_AVX2 1
+#if defined(Y_COMPILER_MSVC)
+#include <intrin.h>
+#define CSTRING_AVX2_FUNCTION
+#else
+#define CSTRING_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_CSTRING_NEON 1
+#endif
+
+// The case-insensitive compare and the reverse character and substring searches run 16 bytes at a time with SSE2 or
+// NEON, or 32 with AVX2 when the cpu has it. The AVX2 versions are compiled for that target on their own, and only
+// called once CPUID says they can be. strlen, memchr and memcmp are left to the C runtime, which already does the
+// same. Case folding in these is ASCII only, like tolower in the C locale.
+
+static inline char AsciiToLower(char ch)
+{
+  return (ch >= 'A' && ch <= 'Z') ? char(ch | 0x20) : ch;
+}
+
+static uint32 FindCaseInsensitiveMismatchScalar(const char* S1, const char* S2, uint32 Length)
+{
+  uint32 i = 0;
+  while (i < Length && AsciiToLower(S1[i]) == AsciiToLower(S2[i]))
+    i++;
+  return i;
+}
+
+static void LowerCaseCopyScalar(char* Destination, const char* Source, uint32 Length)
+{
+  for (uint32 i = 0; i < Length; i++)
+    Destination[i] = AsciiToLower(Source[i]);
+}
+
+static const char* FindLastCharacterScalar(const char* SearchString, uint32 Length, char Character)
+{
+  for (uint32 i = Length; i > 0; i--)
+  {
+    if (SearchString[i - 1] == Character)
+      return SearchString + i - 1;
+  }
+
+  return NULL;
+}
+
+// SearchTermLength is at least one
+static const char* FindSubstringScalar(const char* SearchString, uint32 Length, const char* SearchTerm,
+                                       uint32 SearchTermLength)
+{
+  if (SearchTermLength > Length)
+    return NULL;
+
+  // find each occurrence of the first character with memchr, and only compare the rest there
+  const char* pLastStart = SearchString + (Length - SearchTermLength);
+  for (const char* pAt = SearchString; pAt <= pLastStart; pAt++)
+  {
+    pAt = (const char*)memchr(pAt, SearchTerm[0], size_t(pLastStart - pAt) + 1);
+    if (pAt == NULL)
+      break;
+
+    if (memcmp(pAt + 1, SearchTerm + 1, SearchTermLength - 1) == 0)
+      return pAt;
+  }
+
+  return NULL;
+}
+
+#if defined(Y_CSTRING_SSE2)
+
+// mask is never zero
+static inline uint32 LowestSetBit(uint32 mask)
+{
+#if defined(Y_COMPILER_MSVC)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  return uint32(__builtin_ctz(mask));
+#endif
+}
+static inline uint32 HighestSetBit(uint32 mask)
+{
+#if defined(Y_COMPILER_MSVC)
+  unsigned long index;
+  _BitScanReverse(&index, mask);
+  return index;
+#else
+  return 31 - uint32(__builtin_clz(mask));
+#endif
+}
+
+static inline __m128i LowerCaseSSE2(__m128i value)
+{
+  // moves 'A'..'Z' down to -128..-103, so one signed compare finds them
+  __m128i shifted = _mm_add_epi8(value, _mm_set1_epi8(char(0x80 - 'A')));
+  __m128i isUpper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(char(-128 + 26)));
+  return _mm_or_si128(value, _mm_and_si128(isUpper, _mm_set1_epi8(0x20)));
+}
+
+static uint32 FindCaseInsensitiveMismatchSSE2(const char* S1, const char* S2, uint32 Length)
+{
+  uint32 i = 0;
+  for (; Length - i >= 16; i += 16)
+  {
+    __m128i a = LowerCaseSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(S1 + i)));
+    __m128i b = LowerCaseSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(S2 + i)));
+    uint32 mismatches = uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))) ^ 0xFFFFu;
+    if (mismatches != 0)
+      return i + LowestSetBit(mismatches);
+  }
+
+  return i + FindCaseInsensitiveMismatchScalar(S1 + i, S2 + i, Length - i);
+}
+
+static void LowerCaseCopySSE2(char* Destination, const char* Source, uint32 Length)
+{
+  uint32 i = 0;
+  for (; Length - i >= 16; i += 16)
+  {
+    __m128i value = LowerCaseSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Source + i)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(Destination + i), value);
+  }
+
+  LowerCaseCopyScalar(Destination + i, Source + i, Length - i);
+}
+
+static const char* FindLastCharacterSSE2(const char* SearchString, uint32 Length, char Character)
+{
+  __m128i needle = _mm_set1_epi8(Character);
+  for (; Length >= 16; Length -= 16)
+  {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(SearchString + Length - 16));
+    uint32 matches = uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+    if (matches != 0)
+      return SearchString + Length - 16 + HighestSetBit(matches);
+  }
+
+  return FindLastCharacterScalar(SearchString, Length, Character);
+}
+
+// compares the first and last characters of the term at 16 positions at once, and the rest only where both match.
+// SearchTermLength is at least two.
+static const char* FindSubstringSSE2(const char* SearchString, uint32 Length, const char* SearchTerm,
+                                     uint32 SearchTermLength)
+{
+  __m128i first = _mm_set1_epi8(SearchTerm[0]);
+  __m128i last = _mm_set1_epi8(SearchTerm[SearchTermLength - 1]);
+  uint32 i = 0;
+  for (; Length - i >= SearchTermLength + 15; i += 16)
+  {
+    __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(SearchString + i));
+    __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(SearchString + i + SearchTermLength - 1));
+    uint32 candidates =
+      uint32(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last))));
+    for (; candidates != 0; candidates &= candidates - 1)
+    {
+      const char* pAt = SearchString + i + LowestSetBit(candidates);
+      if (memcmp(pAt + 1, SearchTerm + 1, SearchTermLength - 2) == 0)
+        return pAt;
+    }
+  }
+
+  return FindSubstringScalar(SearchString + i, Length - i, SearchTerm, SearchTermLength);
+}
+
+#endif // Y_CSTRING_SSE2
+
+#if defined(Y_CSTRING_AVX2)
+
+static CSTRING_AVX2_FUNCTION inline __m256i LowerCaseAVX2(__m256i value)
+{
+  __m256i shifted = _mm256_add_epi8(value, _mm256_set1_epi8(char(0x80 - 'A')));
+  __m256i isUpper = _mm256_cmpgt_epi8(_mm256_set1_epi8(char(-128 + 26)), shifted);
+  return _mm256_or_si256(value, _mm256_and_si256(isUpper, _mm256_set1_epi8(0x20)));
+}
+
+static CSTRING_AVX2_FUNCTION uint32 FindCaseInsensitiveMismatchAVX2(const char* S1, const char* S2, uint32 Length)
+{
+  uint32 i = 0;
+  for (; Length - i >= 32; i += 32)
+  {
+    __m256i a = LowerCaseAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(S1 + i)));
+    __m256i b = LowerCaseAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(S2 + i)));
+    uint32 mismatches = ~uint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+    if (mismatches != 0)
+      return i + LowestSetBit(mismatches);
+  }
+
+  return i + FindCaseInsensitiveMismatchSSE2(S1 + i, S2 + i, Length - i);
+}
+
+static CSTRING_AVX2_FUNCTION void LowerCaseCopyAVX2(char* Destination, const char* Source, uint32 Length)
+{
+  uint32 i = 0;
+  for (; Length - i >= 32; i += 32)
+  {
+    __m256i value = LowerCaseAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(Source + i)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(Destination + i), value);
+  }
+
+  LowerCaseCopySSE2(Destination + i, Source + i, Length - i);
+}
+
+static CSTRING_AVX2_FUNCTION const char* FindLastCharacterAVX2(const char* SearchString, uint32 Length,
+                                                               char Character)
+{
+  __m256i needle = _mm256_set1_epi8(Character);
+  for (; Length >= 32; Length -= 32)
+  {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(SearchString + Length - 32));
+    uint32 matches = uint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+    if (matches != 0)
+      return SearchString + Length - 32 + HighestSetBit(matches);
+  }
+
+  return FindLastCharacterSSE2(SearchString, Length, Character);
+}
+
+static CSTRING_AVX2_FUNCTION const char* FindSubstringAVX2(const char* SearchString, uint32 Length,
+                                                           const char* SearchTerm, uint32 SearchTermLength)
+{
+  __m256i first = _mm256_set1_epi8(SearchTerm[0]);
+  __m256i last = _mm256_set1_epi8(SearchTerm[SearchTermLength - 1]);
+  uint32 i = 0;
+  for (; Length - i >= SearchTermLength + 31; i += 32)
+  {
+    __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(SearchString + i));
+    __m256i blockLast =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(SearchString + i + SearchTermLength - 1));
+    uint32 candidates = uint32(_mm256_movemask_epi8(
+      _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last))));
+    for (; candidates != 0; candidates &= candidates - 1)
+    {
+      const char* pAt = SearchString + i + LowestSetBit(candidates);
+      if (memcmp(pAt + 1, SearchTerm + 1, SearchTermLength - 2) == 0)
+        return pAt;
+    }
+  }
+
+  return FindSubstringSSE2(SearchString + i, Length - i, SearchTerm, SearchTermLength);
+}
+
+#endif // Y_CSTRING_AVX2
+
+#if defined(Y_CSTRING_NEON)
+
+// narrows a comparison result to four bits per byte, NEON has no movemask
+static inline uint64 NibbleMaskNEON(uint8x16_t comparison)
+{
+  return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(comparison), 4)), 0);
+}
+
+static inline uint8x16_t LowerCaseNEON(uint8x16_t value)
+{
+  uint8x16_t isUpper = vcltq_u8(vsubq_u8(value, vdupq_n_u8('A')), vdupq_n_u8(26));
+  return vorrq_u8(value, vandq_u8(isUpper, vdupq_n_u8(0x20)));
+}
+
+static uint32 FindCaseInsensitiveMismatchNEON(const char* S1, const char* S2, uint32 Length)
+{
+  uint32 i = 0;
+  for (; Length - i >= 16; i += 16)
+  {
+    uint8x16_t a = LowerCaseNEON(vld1q_u8(reinterpret_cast<const uint8*>(S1 + i)));
+    uint8x16_t b = LowerCaseNEON(vld1q_u8(reinterpret_cast<const uint8*>(S2 + i)));
+    uint64 mismatches = NibbleMaskNEON(vmvnq_u8(vceqq_u8(a, b)));
+    if (mismatches != 0)
+      return i + uint32(__builtin_ctzll(mismatches)) / 4;
+  }
+
+  return i + FindCaseInsensitiveMismatchScalar(S1 + i, S2 + i, Length - i);
+}
+
+static void LowerCaseCopyNEON(char* Destination, const char* Source, uint32 Length)
+{
+  uint32 i = 0;
+  for (; Length - i >= 16; i += 16)
+  {
+    uint8x16_t value = LowerCaseNEON(vld1q_u8(reinterpret_cast<const uint8*>(Source + i)));
+    vst1q_u8(reinterpret_cast<uint8*>(Destination + i), value);
+  }
+
+  LowerCaseCopyScalar(Destination + i, Source + i, Length - i);
+}
+
+static const char* FindLastCharacterNEON(const char* SearchString, uint32 Length, char Character)
+{
+  uint8x16_t needle = vdupq_n_u8(uint8(Character));
+  for (; Length >= 16; Length -= 16)
+  {
+    uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8*>(SearchString + Length - 16));
+    uint64 matches = NibbleMaskNEON(vceqq_u8(block, needle));
+    if (matches != 0)
+      return SearchString + Length - 16 + (63 - uint32(__builtin_clzll(matches))) / 4;
+  }
+
+  return FindLastCharacterScalar(SearchString, Length, Character);
+}
+
+static const char* FindSubstringNEON(const char* SearchString, uint32 Length, const char* SearchTerm,
+                                     uint32 SearchTermLength)
+{
+  uint8x16_t first = vdupq_n_u8(uint8(SearchTerm[0]));
+  uint8x16_t last = vdupq_n_u8(uint8(SearchTerm[SearchTermLength - 1]));
+  uint32 i = 0;
+  for (; Length - i >= SearchTermLength + 15; i += 16)
+  {
+    uint8x16_t blockFirst = vld1q_u8(reinterpret_cast<const uint8*>(SearchString + i));
+    uint8x16_t blockLast = vld1q_u8(reinterpret_cast<const uint8*>(SearchString + i + SearchTermLength - 1));
+    uint64 candidates = NibbleMaskNEON(vandq_u8(vceqq_u8(blockFirst, first), vceqq_u8(blockLast, last)));
+
+    // each candidate is four bits, clear all of them at once
+    for (; candidates != 0; candidates &= ~(uint64(0xF) << (__builtin_ctzll(candidates) & ~3)))
+    {
+      const char* pAt = SearchString + i + uint32(__builtin_ctzll(candidates)) / 4;
+      if (memcmp(pAt + 1, SearchTerm + 1, SearchTermLength - 2) == 0)
+        return pAt;
+    }
+  }
+
+  return FindSubstringScalar(SearchString + i, Length - i, SearchTerm, SearchTermLength);
+}
+
+#endif // Y_CSTRING_NEON
+
+// Each kernel is picked once for the cpu. Until static initialization gets here, anything calling them gets the scalar
+// versions.
+#if defined(Y_CSTRING_AVX2)
+#define CSTRING_SELECT(Name) (Y_CPUHasFeatures(Y_CPU_FEATURE_AVX2) ? Name##AVX2 : Name##SSE2)
+#elif defined(Y_CSTRING_NEON)
+#define CSTRING_SELECT(Name) Name##NEON
+#else
+#define CSTRING_SELECT(Name) Name##Scalar
+#endif
+
+static decltype(&FindCaseInsensitiveMismatchScalar) SelectFindCaseInsensitiveMismatch()
+{
+  return CSTRING_SELECT(FindCaseInsensitiveMismatch);
+}
+
+static decltype(&LowerCaseCopyScalar) SelectLowerCaseCopy()
+{
+  return CSTRING_SELECT(LowerCaseCopy);
+}
+
+static decltype(&FindLastCharacterScalar) SelectFindLastCharacter()
+{
+  return CSTRING_SELECT(FindLastCharacter);
+}
+
+static decltype(&FindSubstringScalar) SelectFindSubstring()
+{
+  return CSTRING_SELECT(FindSubstring);
+}
+
+Y_CPU_DISPATCH(s_pFindCaseInsensitiveMismatch, FindCaseInsensitiveMismatchScalar, SelectFindCaseInsensitiveMismatch);
+Y_CPU_DISPATCH(s_pLowerCaseCopy, LowerCaseCopyScalar, SelectLowerCaseCopy);
+Y_CPU_DISPATCH(s_pFindLastCharacter, FindLastCharacterScalar, SelectFindLastCharacter);
+Y_CPU_DISPATCH(s_pFindSubstring, FindSubstringScalar, SelectFindSubstring);
+
 char* Y_strdup(const char* Str)
 {
   size_t len = strlen(Str);
@@ -109,6 +477,25 @@ int32 Y_strnicmp(const char* S1, const char* S2, uint32 Count)
 
 #endif
 
+int32 Y_strcmp(const char* S1, uint32 Length1, const char* S2, uint32 Length2)
+{
+  int32 result = (Length1 > 0 && Length2 > 0) ? memcmp(S1, S2, Min(Length1, Length2)) : 0;
+  if (result != 0)
+    return result;
+
+  return (Length1 < Length2) ? -1 : ((Length1 > Length2) ? 1 : 0);
+}
+
+int32 Y_stricmp(const char* S1, uint32 Length1, const char* S2, uint32 Length2)
+{
+  uint32 commonLength = Min(Length1, Length2);
+  uint32 mismatch = s_pFindCaseInsensitiveMismatch(S1, S2, commonLength);
+  if (mismatch < commonLength)
+    return (int32)(byte)AsciiToLower(S1[mismatch]) - (int32)(byte)AsciiToLower(S2[mismatch]);
+
+  return (Length1 < Length2) ? -1 : ((Length1 > Length2) ? 1 : 0);
+}
+
 uint32 Y_snprintf(char* pszDestination, uint32 cbDestination, const char* szFormat, ...)
 {
   va_list ap;
@@ -256,6 +643,28 @@ char* Y_strrpbrk(char* SearchString, const char* SearchTerms)
   return lastResult;
 }
 
+const char* Y_strnchr(const char* SearchString, uint32 Length, char Character)
+{
+  return (Length > 0) ? (const char*)memchr(SearchString, Character, Length) : NULL;
+}
+
+const char* Y_strnrchr(const char* SearchString, uint32 Length, char Character)
+{
+  return s_pFindLastCharacter(SearchString, Length, Character);
+}
+
+const char* Y_strnstr(const char* SearchString, uint32 Length, const char* SearchTerm, uint32 SearchTermLength)
+{
+  if (SearchTermLength == 0)
+    return SearchString;
+  if (SearchTermLength > Length)
+    return NULL;
+  if (SearchTermLength == 1)
+    return (const char*)memchr(SearchString, SearchTerm[0], Length);
+
+  return s_pFindSubstring(SearchString, Length, SearchTerm, SearchTermLength);
+}
+
 char* Y_substr(char* Destination, uint32 cbDestination, const char* Source, int32 Offset, int32 Count /* = -1 */)
 {
   const char* start = Source + Offset;
@@ -293,6 +702,11 @@ void Y_strlwr(char* Str, uint32 Length)
     Str[i] = Y_tolower(Str[i]);
 }
 
+void Y_strlwrcpy(char* Destination, const char* Source, uint32 Length)
+{
+  s_pLowerCaseCopy(Destination, Source, Length);
+}
+
 void Y_strupr(char* Str, uint32 Length)
 {
   for (uint32 i = 0; i < Length; i++)
@@ -668,13 +1082,19 @@ int32 Y_selectstring(const char* SelectionString, const char* ValueString)
 
 uint32 Y_parsehexstring(const char* hexString, void* pOutBytes, uint32 maxOutBytes, bool exitOnInvalidCharacter,
                         bool* pAtEnd)
+{
+  return Y_parsehexstring(hexString, Y_strlen(hexString), pOutBytes, maxOutBytes, exitOnInvalidCharacter, pAtEnd);
+}
+
+uint32 Y_parsehexstring(const char* hexString, uint32 hexStringLength, void* pOutBytes, uint32 maxOutBytes,
+                        bool exitOnInvalidCharacter, bool* pAtEnd)
 {
   uint32 i = 0;
   uint32 n = 0;
   byte last = 0;
   bool lb = false;
 
-  while (hexString[i] != '\0' && n < maxOutBytes)
+  while (i < hexStringLength && n < maxOutBytes)
   {
     byte b = 0;
     char ch = hexString[i];
@@ -691,10 +1111,9 @@ uint32 Y_parsehexstring(const char* hexString, void* pOutBytes, uint32 maxOutByt
       // skip whitespace
       if (exitOnInvalidCharacter)
         break;
-      else
-        continue;
 
-      // else if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r')
+      i++;
+      continue;
     }
 
     if (lb)
@@ -712,7 +1131,7 @@ uint32 Y_parsehexstring(const char* hexString, void* pOutBytes, uint32 maxOutByt
   }
 
   if (pAtEnd != NULL)
-    *pAtEnd = (hexString[i] == '\0');
+    *pAtEnd = (i == hexStringLength);
 
   return n;
 }
@@ -747,157 +1166,6 @@ uint32 Y_makehexstring(const void* pInBytes, uint32 nInBytes, char* outBuffer, u
   return n;
 }
 
-uint32 Y_getencodedbase64length(uint32 byteLength)
-{
-  uint32 inMod3 = byteLength % 3;
-  uint32 currentSize = byteLength;
-  if (inMod3 != 0)
-    currentSize += 3 - inMod3;
-
-  DebugAssert((currentSize % 3) == 0);
-  return (currentSize / 3) * 4;
-}
-
-uint32 Y_getdecodedbase64length(uint32 base64Length)
-{
-  if (base64Length > 0)
-    return (base64Length / 4 + 1) * 3;
-  else
-    return 0;
-}
-
-uint32 Y_parsebase64(const char* base64String, void* pOutBytes, uint32 maxOutBytes,
-                     bool exitOnInvalidCharacter /*= true*/, bool* pAtEnd /*= NULL*/)
-{
-  static const byte base64DecodingTable[256] = {
-    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // 00-0F
-    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // 10-1F
-    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 62,  255, 255, 255, 63,  // 20-2F
-    52,  53,  54,  55,  56,  57,  58,  59,  60,  61,  255, 255, 255, 255, 255, 255, // 30-3F
-    255, 0,   1,   2,   3,   4,   5,   6,   7,   8,   9,   10,  11,  12,  13,  14,  // 40-4F
-    15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25,  255, 255, 255, 255, 255, // 50-5F
-    255, 26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,  // 60-6F
-    41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  255, 255, 255, 255, 255, // 70-7F
-    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // 80-8F
-    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // 90-9F
-    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // A0-AF
-    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // B0-BF
-    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // C0-CF
-    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // D0-DF
-    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // E0-EF
-    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, // F0-FF
-  };
-
-  const char* inPointer = base64String;
-  const char* inPointerEnd = base64String + Y_strlen(base64String);
-  byte* outPointer = reinterpret_cast<byte*>(pOutBytes);
-  byte* outPointerStart = outPointer;
-  byte* outPointerEnd = outPointer + maxOutBytes;
-
-  while (outPointer != outPointerEnd)
-  {
-    if ((inPointerEnd - inPointer) < 4)
-      break;
-
-    // get the base64 values
-    uint32 i;
-    byte base64Values[4];
-    uint32 nBase64Values = 0;
-    for (i = 0; i < 4; i++)
-    {
-      byte base64Character = *reinterpret_cast<const byte*>(inPointer++);
-      if ((base64Values[nBase64Values] = base64DecodingTable[base64Character]) == 255)
-      {
-        if (base64Character == '=')
-          break;
-
-        // if (exitOnInvalidCharacter)
-        break;
-      }
-
-      nBase64Values++;
-    }
-
-    // end of stream or error?
-    if (nBase64Values == 0)
-      continue;
-
-    // decode base64 values
-    uint32 nOutputBytes = Min(nBase64Values - 1, (uint32)(outPointerEnd - outPointer));
-    switch (nOutputBytes)
-    {
-      case 1:
-        *(outPointer++) = base64Values[0] << 2 | ((base64Values[1] >> 4) & 3);
-        break;
-
-      case 2:
-        *(outPointer++) = base64Values[0] << 2 | ((base64Values[1] >> 4) & 3);
-        *(outPointer++) = (base64Values[1] & 15) << 4 | ((base64Values[2] >> 2));
-        break;
-
-      case 3:
-        *(outPointer++) = base64Values[0] << 2 | ((base64Values[1] >> 4) & 3);
-        *(outPointer++) = (base64Values[1] & 15) << 4 | ((base64Values[2] >> 2));
-        *(outPointer++) = (base64Values[2] & 3) << 6 | (base64Values[3] & 63);
-        break;
-    }
-  }
-
-  return uint32(outPointer - outPointerStart);
-}
-
-uint32 Y_makebase64(const void* pInBytes, uint32 nInBytes, char* outBuffer, uint32 bufferSize)
-{
-  static const char base64EncodingTable[64] = {
-    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V',
-    'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r',
-    's', 't', 'u', 'v', 'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/'};
-
-  const byte* inPointer = reinterpret_cast<const byte*>(pInBytes);
-  const byte* inPointerEnd = inPointer + nInBytes;
-  char* outPointer = outBuffer;
-  char* outPointerStart = outBuffer;
-  char* outPointerEnd = outPointer + bufferSize;
-
-  for (; inPointer < inPointerEnd; inPointer += 3)
-  {
-    // space for another sequence?
-    if ((outPointerEnd - outPointer) < 5)
-      break;
-
-    // calculate number of bytes in sequence
-    uint32 nBytesInSequence = Min((uint32)3, (uint32)(inPointerEnd - inPointer));
-    switch (nBytesInSequence)
-    {
-      case 1:
-        *(outPointer++) = base64EncodingTable[(*(inPointer + 0) >> 2) & 63];
-        *(outPointer++) = base64EncodingTable[(*(inPointer + 0) & 3) << 4];
-        *(outPointer++) = '=';
-        *(outPointer++) = '=';
-        break;
-
-      case 2:
-        *(outPointer++) = base64EncodingTable[(*(inPointer + 0) >> 2) & 63];
-        *(outPointer++) = base64EncodingTable[((*(inPointer + 0) & 3) << 4) | ((*(inPointer + 1) >> 4) & 15)];
-        *(outPointer++) = base64EncodingTable[(*(inPointer + 1) & 15) << 2];
-        *(outPointer++) = '=';
-        break;
-
-      case 3:
-        *(outPointer++) = base64EncodingTable[((*inPointer + 0) >> 2) & 63];
-        *(outPointer++) = base64EncodingTable[((*(inPointer + 0) & 3) << 4) | ((*(inPointer + 1) >> 4) & 15)];
-        *(outPointer++) = base64EncodingTable[((*(inPointer + 1) & 15) << 2) | ((*(inPointer + 2) >> 6) & 3)];
-        *(outPointer++) = base64EncodingTable[*(inPointer + 2) & 63];
-        break;
-    }
-  }
-
-  if ((outPointer - outPointerStart) > 0)
-    *(outPointer) = '\0';
-
-  return uint32(outPointer - outPointerStart);
-}
-
 //---------------------------------------------------------------------------------------------------------------------
 bool Y_strtobool(const char* Str, char** pEndPtr /* = NULL */)
 {
@@ -1040,7 +1308,7 @@ void Y_strfromfloat(char* Str, uint32 MaxLength, float Value)
 
 void Y_strfromdouble(char* Str, uint32 MaxLength, double Value)
 {
-  Y_snprintf(Str, MaxLength, "%Lf", Value);
+  Y_snprintf(Str, MaxLength, "%f", Value);
 }
 
 void Y_strfrombyte(char* Str, uint32 MaxLength, byte Value)
@@ -1048,42 +1316,81 @@ void Y_strfrombyte(char* Str, uint32 MaxLength, byte Value)
   Y_snprintf(Str, MaxLength, "%02X", (uint32)Value);
 }
 
+// decimal integers skip printf, cut off to fit like Y_snprintf would
+static void Y_strfromdecimal(char* Str, uint32 MaxLength, const char* Number, uint32 Length)
+{
+  if (MaxLength == 0)
+    return;
+
+  Length = Min(Length, MaxLength - 1);
+  std::memcpy(Str, Number, Length);
+  Str[Length] = '\0';
+}
+
 void Y_strfromint8(char* Str, uint32 MaxLength, int8 Value, uint32 Base)
 {
-  Y_snprintf(Str, MaxLength, (Base == 10) ? "%d" : "%02X", (int32)Value);
+  if (Base == 10)
+    Y_strfromint32(Str, MaxLength, (int32)Value, Base);
+  else
+    Y_snprintf(Str, MaxLength, "%02X", (int32)Value);
 }
 
 void Y_strfromint16(char* Str, uint32 MaxLength, int16 Value, uint32 Base)
 {
-  Y_snprintf(Str, MaxLength, (Base == 10) ? "%d" : "%04X", (int32)Value);
+  if (Base == 10)
+    Y_strfromint32(Str, MaxLength, (int32)Value, Base);
+  else
+    Y_snprintf(Str, MaxLength, "%04X", (int32)Value);
 }
 
 void Y_strfromint32(char* Str, uint32 MaxLength, int32 Value, uint32 Base)
 {
-  Y_snprintf(Str, MaxLength, (Base == 10) ? "%d" : "%08X", (int32)Value);
+  char Number[NumberConversion::MaxIntegerLength];
+  if (Base == 10)
+    Y_strfromdecimal(Str, MaxLength, Number, NumberConversion::FormatInt32(Number, Value));
+  else
+    Y_snprintf(Str, MaxLength, "%08X", (uint32)Value);
 }
 
 void Y_strfromint64(char* Str, uint32 MaxLength, int64 Value, uint32 Base)
 {
-  Y_snprintf(Str, MaxLength, (Base == 10) ? "%I64" : "%I64X", (int64)Value);
+  char Number[NumberConversion::MaxIntegerLength];
+  if (Base == 10)
+    Y_strfromdecimal(Str, MaxLength, Number, NumberConversion::FormatInt64(Number, Value));
+  else
+    Y_snprintf(Str, MaxLength, "%016llX", (unsigned long long)Value);
 }
 
 void Y_strfromuint8(char* Str, uint32 MaxLength, uint8 Value, uint32 Base)
 {
-  Y_snprintf(Str, MaxLength, (Base == 10) ? "%d" : "%02X", (uint32)Value);
+  if (Base == 10)
+    Y_strfromuint32(Str, MaxLength, (uint32)Value, Base);
+  else
+    Y_snprintf(Str, MaxLength, "%02X", (uint32)Value);
 }
 
 void Y_strfromuint16(char* Str, uint32 MaxLength, uint16 Value, uint32 Base)
 {
-  Y_snprintf(Str, MaxLength, (Base == 10) ? "%d" : "%04X", (uint32)Value);
+  if (Base == 10)
+    Y_strfromuint32(Str, MaxLength, (uint32)Value, Base);
+  else
+    Y_snprintf(Str, MaxLength, "%04X", (uint32)Value);
 }
 
 void Y_strfromuint32(char* Str, uint32 MaxLength, uint32 Value, uint32 Base)
 {
-  Y_snprintf(Str, MaxLength, (Base == 10) ? "%d" : "%08X", (uint32)Value);
+  char Number[NumberConversion::MaxIntegerLength];
+  if (Base == 10)
+    Y_strfromdecimal(Str, MaxLength, Number, NumberConversion::FormatUInt32(Number, Value));
+  else
+    Y_snprintf(Str, MaxLength, "%08X", Value);
 }
 
 void Y_strfromuint64(char* Str, uint32 MaxLength, uint64 Value, uint32 Base)
 {
-  Y_snprintf(Str, MaxLength, (Base == 10) ? "%I64u" : "%I64X", (uint64)Value);
+  char Number[NumberConversion::MaxIntegerLength];
+  if (Base == 10)
+    Y_strfromdecimal(Str, MaxLength, Number, NumberConversion::FormatUInt64(Number, Value));
+  else
+    Y_snprintf(Str, MaxLength, "%016llX", (unsigned long long)Value);
 }
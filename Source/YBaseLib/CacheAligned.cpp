@@ -0,0 +1,21 @@
+#include "YBaseLib/CacheAligned.h"
+
+// 0 until the thread first asks, then its index plus one
+Y_DECLARE_THREAD_LOCAL(uint32) s_threadShardIndex = 0;
+static Y_ATOMIC_DECL uint32 s_nextShardIndex = 0;
+
+uint32 Y_GetThreadShardIndex()
+{
+  uint32 index = s_threadShardIndex;
+  if (index == 0)
+  {
+    // skips zero when the counter wraps, it means unassigned
+    index = Y_AtomicIncrement(s_nextShardIndex, ATOMIC_MEMORY_ORDER_RELAXED);
+    if (index == 0)
+      index = Y_AtomicIncrement(s_nextShardIndex, ATOMIC_MEMORY_ORDER_RELAXED);
+
+    s_threadShardIndex = index;
+  }
+
+  return index - 1;
+}
@@ -1,50 +1,118 @@
 #include "YBaseLib/CallbackQueue.h"
 
-CallbackQueue::CallbackQueue() {}
+CallbackQueue::CallbackQueue() : m_PendingCount(0), m_StatsEnabled(false), m_StatsStartTime(0) {}
 
 CallbackQueue::~CallbackQueue()
 {
-  uint32 i;
-  for (i = 0; i < m_CallbackQueue.GetSize(); i++)
-    delete m_CallbackQueue[i];
+  // callbacks that never ran still hold their captures, and possibly an overflow block
+  CallbackNode* pNode;
+  while ((pNode = m_PendingCallbacks.Pop()) != nullptr)
+  {
+    pNode->pInvoke(this, pNode->Storage, false);
+    delete pNode;
+  }
+
+  pNode = m_FreeNodes.PopAll();
+  while (pNode != nullptr)
+  {
+    CallbackNode* pNext = pNode->next;
+    delete pNode;
+    pNode = pNext;
+  }
+
+  OverflowBlock* pBlock = m_FreeOverflowBlocks.PopAll();
+  while (pBlock != nullptr)
+  {
+    OverflowBlock* pNext = pBlock->next;
+    delete pBlock;
+    pBlock = pNext;
+  }
+}
+
+void CallbackQueue::InvokeFunctor(CallbackQueue* pQueue, void* pStorage, bool execute)
+{
+  Functor* pCallback = *reinterpret_cast<Functor**>(pStorage);
+  if (execute)
+    pCallback->Invoke();
+
+  delete pCallback;
 }
 
 void CallbackQueue::AddCallback(Functor* pCallback)
 {
-  m_CallbackQueueLock.Lock();
-  m_CallbackQueue.Add(pCallback);
-  m_CallbackQueueLock.Unlock();
+  CallbackNode* pNode = AllocateNode();
+  *reinterpret_cast<Functor**>(pNode->Storage) = pCallback;
+  pNode->pInvoke = &InvokeFunctor;
+  QueueNode(pNode);
+}
+
+CallbackQueue::CallbackNode* CallbackQueue::AllocateNode()
+{
+  CallbackNode* pNode = m_FreeNodes.Pop();
+  return (pNode != nullptr) ? pNode : new CallbackNode();
+}
+
+CallbackQueue::OverflowBlock* CallbackQueue::AllocateOverflowBlock()
+{
+  OverflowBlock* pBlock = m_FreeOverflowBlocks.Pop();
+  return (pBlock != nullptr) ? pBlock : new OverflowBlock();
+}
+
+void CallbackQueue::QueueNode(CallbackNode* pNode)
+{
+  pNode->QueueTime = m_StatsEnabled ? Y_TimerGetValue() : 0;
+
+  // counted first, so the count never drops below zero when the consumer gets to it
+  Y_AtomicIncrement(m_PendingCount);
+  m_PendingCallbacks.Push(pNode);
 }
 
 void CallbackQueue::RunCallbacks()
 {
-  uint32 i;
+  // counted locally and merged once the queue is empty, so the callbacks run without the lock held
+  const bool recordStats = m_StatsEnabled;
+  SchedulerWorkerStats batchStats;
+
+  CallbackNode* pNode;
+  while ((pNode = m_PendingCallbacks.Pop()) != nullptr)
+  {
+    Y_TIMER_VALUE queueTime = pNode->QueueTime;
+    uint32 remaining = Y_AtomicDecrement(m_PendingCount);
+
+    // the callable lives in the node, so it only goes back once the callback has run
+    Y_TIMER_VALUE startTime = recordStats ? Y_TimerGetValue() : 0;
+    pNode->pInvoke(this, pNode->Storage, true);
+    m_FreeNodes.Push(pNode);
+    if (recordStats)
+      batchStats.RecordTask(queueTime, startTime, Y_TimerGetValue(), remaining);
+  }
 
-  for (;;)
+  if (recordStats)
   {
-    m_CallbackQueueLock.Lock();
-
-    if (m_CallbackQueue.GetSize() > 0)
-    {
-      Functor** pCallbacks;
-      uint32 nCallbacks;
-
-      // array has to be detached for recursive mutex safety, fix me later, replace with 'locked queue'
-      m_CallbackQueue.DetachArray(&pCallbacks, &nCallbacks);
-      m_CallbackQueueLock.Unlock();
-
-      for (i = 0; i < nCallbacks; i++)
-      {
-        pCallbacks[i]->Invoke();
-        delete pCallbacks[i];
-      }
-
-      std::free(pCallbacks);
-    }
-    else
-    {
-      m_CallbackQueueLock.Unlock();
-      break;
-    }
+    m_StatsLock.Lock();
+    m_Stats.Accumulate(batchStats);
+    m_StatsLock.Unlock();
   }
 }
+
+void CallbackQueue::SetStatsEnabled(bool enabled)
+{
+  m_StatsLock.Lock();
+  if (enabled && m_StatsStartTime == 0)
+    m_StatsStartTime = Y_TimerGetValue();
+
+  m_StatsEnabled = enabled;
+  m_StatsLock.Unlock();
+}
+
+SchedulerStats CallbackQueue::GetStats()
+{
+  SchedulerStats stats;
+  m_StatsLock.Lock();
+  stats.WorkerCount = 1;
+  stats.QueueDepth = Y_AtomicLoadAcquire(m_PendingCount);
+  stats.ElapsedTime = (m_StatsStartTime != 0) ? (Y_TimerGetValue() - m_StatsStartTime) : 0;
+  stats.Totals.Accumulate(m_Stats);
+  m_StatsLock.Unlock();
+  return stats;
+}
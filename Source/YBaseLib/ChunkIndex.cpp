@@ -0,0 +1,136 @@
+#include "YBaseLib/ChunkIndex.h"
+#include "YBaseLib/BinaryReader.h"
+#include "YBaseLib/BinaryWriter.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Log.h"
+Log_SetChannel(ChunkIndex);
+
+static const uint32 INDEX_MAGIC = 0x49435959; // 'YYCI'
+static const uint32 INDEX_VERSION = 1;
+
+ChunkIndex::ChunkIndex() {}
+
+ChunkIndex::~ChunkIndex() {}
+
+bool ChunkIndex::AddChunk(const CHUNK_DIGEST& digest, const Location& location)
+{
+  if (m_chunks.Find(digest) != nullptr)
+    return false;
+
+  m_chunks.Insert(digest, location);
+  return true;
+}
+
+uint32 ChunkIndex::AddChunks(const CONTENT_CHUNK* pChunks, uint32 count, uint32 packID)
+{
+  uint32 newCount = 0;
+  for (uint32 i = 0; i < count; i++)
+  {
+    Location location;
+    location.PackID = packID;
+    location.Size = pChunks[i].Size;
+    location.Offset = pChunks[i].Offset;
+    if (AddChunk(pChunks[i].Digest, location))
+      newCount++;
+  }
+
+  return newCount;
+}
+
+const ChunkIndex::Location* ChunkIndex::FindChunk(const CHUNK_DIGEST& digest) const
+{
+  const ChunkTable::Member* pMember = m_chunks.Find(digest);
+  return (pMember != nullptr) ? &pMember->Value : nullptr;
+}
+
+bool ChunkIndex::RemoveChunk(const CHUNK_DIGEST& digest)
+{
+  return m_chunks.Remove(digest);
+}
+
+uint32 ChunkIndex::RemovePack(uint32 packID)
+{
+  uint32 removedCount = 0;
+  for (ChunkTable::Iterator itr = m_chunks.Begin(); !itr.AtEnd();)
+  {
+    ChunkTable::Member* pMember = &(*itr);
+    itr.Forward();
+    if (pMember->Value.PackID == packID)
+    {
+      m_chunks.Remove(pMember);
+      removedCount++;
+    }
+  }
+
+  return removedCount;
+}
+
+void ChunkIndex::Clear()
+{
+  m_chunks.Clear();
+}
+
+void ChunkIndex::FindMissingChunks(const CONTENT_CHUNK* pChunks, uint32 count, PODArray<uint32>* pMissingIndices) const
+{
+  HashTable<CHUNK_DIGEST, bool> seenDigests;
+  pMissingIndices->Clear();
+  for (uint32 i = 0; i < count; i++)
+  {
+    if (m_chunks.Find(pChunks[i].Digest) != nullptr)
+      continue;
+
+    bool isNew;
+    seenDigests.Set(pChunks[i].Digest, true, &isNew);
+    if (isNew)
+      pMissingIndices->Add(i);
+  }
+}
+
+bool ChunkIndex::Save(ByteStream* pStream) const
+{
+  BinaryWriter writer(pStream, ENDIAN_TYPE_LITTLE, true, true);
+  writer.WriteUInt32(INDEX_MAGIC);
+  writer.WriteUInt32(INDEX_VERSION);
+  writer.WriteVarUInt32(m_chunks.GetMemberCount());
+  for (ChunkTable::ConstIterator itr = m_chunks.Begin(); !itr.AtEnd(); itr.Forward())
+  {
+    writer.WriteBytes(itr->Key.Bytes, sizeof(itr->Key.Bytes));
+    writer.WriteVarUInt32(itr->Value.PackID);
+    writer.WriteVarUInt32(itr->Value.Size);
+    writer.WriteVarUInt64(itr->Value.Offset);
+  }
+
+  if (!writer.SyncStream() || writer.InErrorState())
+  {
+    Log_ErrorPrint("ChunkIndex::Save: failed to write the index");
+    return false;
+  }
+
+  return true;
+}
+
+bool ChunkIndex::Load(ByteStream* pStream)
+{
+  m_chunks.Clear();
+
+  BinaryReader reader(pStream, ENDIAN_TYPE_LITTLE, true, true);
+  bool result = (reader.ReadUInt32() == INDEX_MAGIC && reader.ReadUInt32() == INDEX_VERSION);
+  uint32 chunkCount = result ? reader.ReadVarUInt32() : 0;
+  for (uint32 i = 0; i < chunkCount && result; i++)
+  {
+    CHUNK_DIGEST digest;
+    Location location;
+    result = reader.SafeReadBytes(digest.Bytes, sizeof(digest.Bytes)) && reader.SafeReadVarUInt32(&location.PackID) &&
+             reader.SafeReadVarUInt32(&location.Size) && reader.SafeReadVarUInt64(&location.Offset) &&
+             AddChunk(digest, location);
+  }
+
+  if (!result || reader.GetErrorState())
+  {
+    Log_ErrorPrint("ChunkIndex::Load: the stream is not a valid chunk index");
+    m_chunks.Clear();
+    return false;
+  }
+
+  return true;
+}
@@ -95,6 +95,18 @@ bool CircularBuffer::GetReadPointer(const void** ppReadPointer, size_t* pByteCou
   return true;
 }
 
+bool CircularBuffer::GetReadPointers(const void** ppFirstPointer, size_t* pFirstByteCount,
+                                     const void** ppSecondPointer, size_t* pSecondByteCount) const
+{
+  if (!GetReadPointer(ppFirstPointer, pFirstByteCount))
+    return false;
+
+  // B always starts at the buffer base
+  *ppSecondPointer = m_pBuffer;
+  *pSecondByteCount = (m_pRegionBTail != nullptr) ? static_cast<size_t>(m_pRegionBTail - m_pBuffer) : 0;
+  return true;
+}
+
 void CircularBuffer::MoveReadPointer(size_t byteCount)
 {
   DebugAssert(byteCount <= static_cast<size_t>(m_pRegionATail - m_pRegionAHead));
@@ -138,7 +150,7 @@ bool CircularBuffer::GetWritePointer(void** ppWritePointer, size_t* pByteCount)
     if (requiredBytes > freeSpace)
       return false;
 
-    *ppWritePointer = m_pBuffer;
+    *ppWritePointer = m_pRegionBTail;
     *pByteCount = freeSpace;
     return true;
   }
@@ -217,21 +229,24 @@ bool CircularBuffer::Write(const void* pSource, size_t byteCount)
   if (byteCount > GetBufferSpace())
     return false;
 
+  // The space counted includes both after A and before it, so fill after A first, and only then start B. Going by
+  // GetWritePointer, which starts B whenever it's the bigger, would leave the space after A unused and run out.
   const byte* pSourcePtr = reinterpret_cast<const byte*>(pSource);
-  while (byteCount > 0)
+  if (m_pRegionBTail == nullptr)
   {
-    void* pWritePointer;
-    size_t availableBytes;
-    if (!GetWritePointer(&pWritePointer, &availableBytes))
-      Panic("Buffer failed mid-write.");
-
-    // copy data
-    size_t copyCount = Min(byteCount, availableBytes);
-    std::memcpy(pWritePointer, pSourcePtr, copyCount);
-    MoveWritePointer(copyCount);
+    size_t copyCount = Min(byteCount, static_cast<size_t>((m_pBuffer + m_bufferSize) - m_pRegionATail));
+    std::memcpy(m_pRegionATail, pSourcePtr, copyCount);
+    m_pRegionATail += copyCount;
     pSourcePtr += copyCount;
     byteCount -= copyCount;
+    if (byteCount == 0)
+      return true;
+
+    m_pRegionBTail = m_pBuffer;
   }
 
+  DebugAssert(byteCount <= static_cast<size_t>(m_pRegionAHead - m_pRegionBTail));
+  std::memcpy(m_pRegionBTail, pSourcePtr, byteCount);
+  m_pRegionBTail += byteCount;
   return true;
 }
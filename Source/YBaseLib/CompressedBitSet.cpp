@@ -0,0 +1,938 @@
+#include "YBaseLib/CompressedBitSet.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/BinaryReader.h"
+#include "YBaseLib/BinaryWriter.h"
+#include <cstring>
+
+// a bitmap container is 1024 words, stored in the same uint16 allocation as the other container types
+static const uint32 BITMAP_WORD_COUNT = 1024;
+static const uint32 BITMAP_VALUE_COUNT = BITMAP_WORD_COUNT * 4;
+static const uint32 CHUNK_BIT_COUNT = 65536;
+
+// the container operations, given access through friendship
+struct CompressedBitSetContainers
+{
+  typedef CompressedBitSet::Container Container;
+
+  enum OPERATION
+  {
+    OPERATION_OR,
+    OPERATION_AND,
+    OPERATION_XOR,
+    OPERATION_ANDNOT,
+  };
+
+  static const uint16 TYPE_ARRAY = CompressedBitSet::CONTAINER_TYPE_ARRAY;
+  static const uint16 TYPE_BITMAP = CompressedBitSet::CONTAINER_TYPE_BITMAP;
+  static const uint16 TYPE_RUN = CompressedBitSet::CONTAINER_TYPE_RUN;
+
+  static Container Create(uint16 key)
+  {
+    Container container = {key, TYPE_ARRAY, 0, 0, 0, nullptr};
+    return container;
+  }
+
+  // uint16s of storage the contents need
+  static uint32 GetValueCount(const Container& container)
+  {
+    if (container.Type == TYPE_BITMAP)
+      return BITMAP_VALUE_COUNT;
+    else if (container.Type == TYPE_RUN)
+      return container.Size * 2;
+    else
+      return container.Size;
+  }
+
+  // resizes the allocation to exactly valueCount uint16s
+  static void SetCapacity(Container& container, uint32 valueCount)
+  {
+    if (container.Capacity == valueCount)
+      return;
+
+    container.pValues = (uint16*)Y_reallocarray(container.pValues, valueCount, sizeof(uint16));
+    container.Capacity = valueCount;
+  }
+
+  static void Release(Container& container)
+  {
+    Y_free(container.pValues);
+    container.pValues = nullptr;
+    container.Capacity = 0;
+  }
+
+  static Container Clone(const Container& container)
+  {
+    Container clone = container;
+    clone.pValues = nullptr;
+    clone.Capacity = 0;
+    SetCapacity(clone, GetValueCount(container));
+    std::memcpy(clone.pValues, container.pValues, sizeof(uint16) * clone.Capacity);
+    return clone;
+  }
+
+  static const uint64* GetWords(const Container& container)
+  {
+    return reinterpret_cast<const uint64*>(container.pValues);
+  }
+  static uint64* GetWords(Container& container) { return reinterpret_cast<uint64*>(container.pValues); }
+
+  // first index with a value >= value
+  static uint32 LowerBound(const uint16* pValues, uint32 count, uint32 value)
+  {
+    uint32 low = 0;
+    uint32 high = count;
+    while (low < high)
+    {
+      uint32 middle = (low + high) / 2;
+      if (pValues[middle] < value)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+
+    return low;
+  }
+
+  // first run that ends at or after value
+  static uint32 FindRun(const Container& container, uint32 value)
+  {
+    uint32 low = 0;
+    uint32 high = container.Size;
+    while (low < high)
+    {
+      uint32 middle = (low + high) / 2;
+      if ((uint32)container.pValues[middle * 2] + container.pValues[middle * 2 + 1] < value)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+
+    return low;
+  }
+
+  static bool Contains(const Container& container, uint32 value)
+  {
+    if (container.Type == TYPE_ARRAY)
+    {
+      uint32 index = LowerBound(container.pValues, container.Size, value);
+      return (index < container.Size && container.pValues[index] == value);
+    }
+    else if (container.Type == TYPE_BITMAP)
+    {
+      return (GetWords(container)[value / 64] & (1ULL << (value % 64))) != 0;
+    }
+    else
+    {
+      uint32 index = FindRun(container, value);
+      return (index < container.Size && container.pValues[index * 2] <= value);
+    }
+  }
+
+  // first bit at or after position that is set (or clear), CHUNK_BIT_COUNT if there isn't one
+  static uint32 FindBit(const uint64* pWords, uint32 position, bool set)
+  {
+    uint64 flip = set ? 0 : ~0ULL;
+    uint32 wordIndex = position / 64;
+    uint64 word = (pWords[wordIndex] ^ flip) & (~0ULL << (position % 64));
+    for (;;)
+    {
+      if (word != 0)
+      {
+        uint64 index;
+        Y_bitscanforward(word, &index);
+        return wordIndex * 64 + (uint32)index;
+      }
+
+      if (++wordIndex == BITMAP_WORD_COUNT)
+        return CHUNK_BIT_COUNT;
+
+      word = pWords[wordIndex] ^ flip;
+    }
+  }
+
+  static bool FindNext(const Container& container, uint32 position, uint32* pFound)
+  {
+    if (container.Type == TYPE_ARRAY)
+    {
+      uint32 index = LowerBound(container.pValues, container.Size, position);
+      if (index == container.Size)
+        return false;
+
+      *pFound = container.pValues[index];
+      return true;
+    }
+    else if (container.Type == TYPE_BITMAP)
+    {
+      *pFound = FindBit(GetWords(container), position, true);
+      return (*pFound != CHUNK_BIT_COUNT);
+    }
+    else
+    {
+      uint32 index = FindRun(container, position);
+      if (index == container.Size)
+        return false;
+
+      *pFound = Max(position, (uint32)container.pValues[index * 2]);
+      return true;
+    }
+  }
+
+  // applies op to [first, last] of pWords with every bit set, AND isn't a range operation
+  static void ApplyRange(uint64* pWords, uint32 first, uint32 last, OPERATION op)
+  {
+    DebugAssert(op != OPERATION_AND && first <= last);
+    uint32 firstWord = first / 64;
+    uint32 lastWord = last / 64;
+    for (uint32 i = firstWord; i <= lastWord; i++)
+    {
+      uint64 mask = ~0ULL;
+      if (i == firstWord)
+        mask &= ~0ULL << (first % 64);
+      if (i == lastWord)
+        mask &= ~0ULL >> (63 - (last % 64));
+
+      if (op == OPERATION_OR)
+        pWords[i] |= mask;
+      else if (op == OPERATION_XOR)
+        pWords[i] ^= mask;
+      else
+        pWords[i] &= ~mask;
+    }
+  }
+
+  static void ToWords(const Container& container, uint64* pWords)
+  {
+    if (container.Type == TYPE_BITMAP)
+    {
+      std::memcpy(pWords, container.pValues, sizeof(uint64) * BITMAP_WORD_COUNT);
+      return;
+    }
+
+    std::memset(pWords, 0, sizeof(uint64) * BITMAP_WORD_COUNT);
+    if (container.Type == TYPE_ARRAY)
+    {
+      for (uint32 i = 0; i < container.Size; i++)
+        pWords[container.pValues[i] / 64] |= 1ULL << (container.pValues[i] % 64);
+    }
+    else
+    {
+      for (uint32 i = 0; i < container.Size; i++)
+      {
+        uint32 start = container.pValues[i * 2];
+        ApplyRange(pWords, start, start + container.pValues[i * 2 + 1], OPERATION_OR);
+      }
+    }
+  }
+
+  // pWords = pWords op container
+  static void ApplyToWords(uint64* pWords, const Container& container, OPERATION op)
+  {
+    if (container.Type == TYPE_BITMAP)
+    {
+      const uint64* pOtherWords = GetWords(container);
+      for (uint32 i = 0; i < BITMAP_WORD_COUNT; i++)
+      {
+        if (op == OPERATION_OR)
+          pWords[i] |= pOtherWords[i];
+        else if (op == OPERATION_AND)
+          pWords[i] &= pOtherWords[i];
+        else if (op == OPERATION_XOR)
+          pWords[i] ^= pOtherWords[i];
+        else
+          pWords[i] &= ~pOtherWords[i];
+      }
+    }
+    else if (container.Type == TYPE_ARRAY)
+    {
+      // AND with an array is always done by filtering the array instead
+      DebugAssert(op != OPERATION_AND);
+      for (uint32 i = 0; i < container.Size; i++)
+        ApplyRange(pWords, container.pValues[i], container.pValues[i], op);
+    }
+    else if (op == OPERATION_AND)
+    {
+      // clear the gaps between runs
+      uint32 position = 0;
+      for (uint32 i = 0; i < container.Size; i++)
+      {
+        uint32 start = container.pValues[i * 2];
+        if (start > position)
+          ApplyRange(pWords, position, start - 1, OPERATION_ANDNOT);
+
+        position = start + container.pValues[i * 2 + 1] + 1;
+      }
+      if (position < CHUNK_BIT_COUNT)
+        ApplyRange(pWords, position, CHUNK_BIT_COUNT - 1, OPERATION_ANDNOT);
+    }
+    else
+    {
+      for (uint32 i = 0; i < container.Size; i++)
+      {
+        uint32 start = container.pValues[i * 2];
+        ApplyRange(pWords, start, start + container.pValues[i * 2 + 1], op);
+      }
+    }
+  }
+
+  // rebuilds the container from pWords as whichever of an array, bitmap or runs is smallest. single bit changes
+  // don't pick runs, since every change to a run container rebuilds it. pWords can't be the container's storage.
+  static void FromWords(Container& container, const uint64* pWords, bool allowRuns = true)
+  {
+    DebugAssert(pWords != GetWords(container));
+
+    // a run starts at every set bit whose lower neighbour is clear
+    uint32 cardinality = 0;
+    uint32 runCount = 0;
+    uint64 carry = 0;
+    for (uint32 i = 0; i < BITMAP_WORD_COUNT; i++)
+    {
+      uint64 word = pWords[i];
+      cardinality += Y_popcnt(word);
+      runCount += Y_popcnt(word & ~((word << 1) | carry));
+      carry = word >> 63;
+    }
+
+    container.Cardinality = cardinality;
+    if (cardinality == 0)
+    {
+      Release(container);
+      container.Type = TYPE_ARRAY;
+      container.Size = 0;
+    }
+    else if (allowRuns && runCount * 2 < Min(cardinality, BITMAP_VALUE_COUNT))
+    {
+      container.Type = TYPE_RUN;
+      container.Size = runCount;
+      SetCapacity(container, runCount * 2);
+
+      uint32 position = 0;
+      for (uint32 i = 0; i < runCount; i++)
+      {
+        uint32 start = FindBit(pWords, position, true);
+        uint32 end = (start < CHUNK_BIT_COUNT - 1) ? FindBit(pWords, start + 1, false) : CHUNK_BIT_COUNT;
+        container.pValues[i * 2] = (uint16)start;
+        container.pValues[i * 2 + 1] = (uint16)(end - 1 - start);
+        position = end;
+      }
+    }
+    else if (cardinality <= CompressedBitSet::ArrayMaxCardinality)
+    {
+      container.Type = TYPE_ARRAY;
+      container.Size = cardinality;
+      SetCapacity(container, cardinality);
+
+      uint32 count = 0;
+      for (uint32 i = 0; i < BITMAP_WORD_COUNT; i++)
+      {
+        uint64 word = pWords[i];
+        while (word != 0)
+        {
+          uint64 index;
+          Y_bitscanforward(word, &index);
+          container.pValues[count++] = (uint16)(i * 64 + (uint32)index);
+          word &= word - 1;
+        }
+      }
+    }
+    else
+    {
+      container.Type = TYPE_BITMAP;
+      container.Size = 0;
+      SetCapacity(container, BITMAP_VALUE_COUNT);
+      std::memcpy(container.pValues, pWords, sizeof(uint64) * BITMAP_WORD_COUNT);
+    }
+  }
+
+  // returns false if the bit was already set
+  static bool Add(Container& container, uint32 value)
+  {
+    if (container.Type == TYPE_ARRAY && container.Size < CompressedBitSet::ArrayMaxCardinality)
+    {
+      uint32 index = LowerBound(container.pValues, container.Size, value);
+      if (index < container.Size && container.pValues[index] == value)
+        return false;
+
+      if (container.Size == container.Capacity)
+        SetCapacity(container, Min(Max(container.Size * 2, 8u), CompressedBitSet::ArrayMaxCardinality));
+
+      std::memmove(container.pValues + index + 1, container.pValues + index,
+                   sizeof(uint16) * (container.Size - index));
+      container.pValues[index] = (uint16)value;
+      container.Size++;
+      container.Cardinality++;
+      return true;
+    }
+    else if (container.Type == TYPE_BITMAP)
+    {
+      uint64& word = GetWords(container)[value / 64];
+      uint64 bit = 1ULL << (value % 64);
+      if (word & bit)
+        return false;
+
+      word |= bit;
+      container.Cardinality++;
+      return true;
+    }
+
+    // full arrays and runs are rebuilt
+    if (Contains(container, value))
+      return false;
+
+    uint64 words[BITMAP_WORD_COUNT];
+    ToWords(container, words);
+    words[value / 64] |= 1ULL << (value % 64);
+    FromWords(container, words, false);
+    return true;
+  }
+
+  // returns false if the bit wasn't set
+  static bool Remove(Container& container, uint32 value)
+  {
+    if (container.Type == TYPE_ARRAY)
+    {
+      uint32 index = LowerBound(container.pValues, container.Size, value);
+      if (index == container.Size || container.pValues[index] != value)
+        return false;
+
+      std::memmove(container.pValues + index, container.pValues + index + 1,
+                   sizeof(uint16) * (container.Size - index - 1));
+      container.Size--;
+      container.Cardinality--;
+      return true;
+    }
+    else if (container.Type == TYPE_BITMAP)
+    {
+      uint64& word = GetWords(container)[value / 64];
+      uint64 bit = 1ULL << (value % 64);
+      if (!(word & bit))
+        return false;
+
+      word &= ~bit;
+      container.Cardinality--;
+      if (container.Cardinality > CompressedBitSet::ArrayMaxCardinality)
+        return true;
+    }
+    else if (!Contains(container, value))
+    {
+      return false;
+    }
+
+    // runs, and bitmaps that have become small enough to be arrays, are rebuilt
+    uint64 words[BITMAP_WORD_COUNT];
+    ToWords(container, words);
+    words[value / 64] &= ~(1ULL << (value % 64));
+    FromWords(container, words, false);
+    return true;
+  }
+
+  // a op b as a new container, which is empty if nothing is left
+  static Container Apply(const Container& a, const Container& b, OPERATION op)
+  {
+    Container result = Create(a.Key);
+
+    // intersections with an array only need to look up the array's values
+    if ((op == OPERATION_AND && (a.Type == TYPE_ARRAY || b.Type == TYPE_ARRAY)) ||
+        (op == OPERATION_ANDNOT && a.Type == TYPE_ARRAY))
+    {
+      const Container* pFilter = &a;
+      const Container* pOther = &b;
+      if (op == OPERATION_AND && (a.Type != TYPE_ARRAY || (b.Type == TYPE_ARRAY && b.Size < a.Size)))
+        Swap(pFilter, pOther);
+
+      bool keepMatches = (op == OPERATION_AND);
+      SetCapacity(result, pFilter->Size);
+      for (uint32 i = 0; i < pFilter->Size; i++)
+      {
+        uint16 value = pFilter->pValues[i];
+        if (Contains(*pOther, value) == keepMatches)
+          result.pValues[result.Size++] = value;
+      }
+
+      result.Cardinality = result.Size;
+      return result;
+    }
+
+    // small unions and differences of arrays are merges
+    if ((op == OPERATION_OR || op == OPERATION_XOR) && a.Type == TYPE_ARRAY && b.Type == TYPE_ARRAY &&
+        a.Size + b.Size <= CompressedBitSet::ArrayMaxCardinality)
+    {
+      SetCapacity(result, a.Size + b.Size);
+      uint32 i = 0;
+      uint32 j = 0;
+      while (i < a.Size || j < b.Size)
+      {
+        if (j == b.Size || (i < a.Size && a.pValues[i] < b.pValues[j]))
+        {
+          result.pValues[result.Size++] = a.pValues[i++];
+        }
+        else if (i == a.Size || b.pValues[j] < a.pValues[i])
+        {
+          result.pValues[result.Size++] = b.pValues[j++];
+        }
+        else
+        {
+          if (op == OPERATION_OR)
+            result.pValues[result.Size++] = a.pValues[i];
+
+          i++;
+          j++;
+        }
+      }
+
+      result.Cardinality = result.Size;
+      return result;
+    }
+
+    uint64 words[BITMAP_WORD_COUNT];
+    ToWords(a, words);
+    ApplyToWords(words, b, op);
+    FromWords(result, words);
+    return result;
+  }
+
+  // merges two sorted container lists, releasing every container in pContainers that isn't kept
+  static void Apply(PODArray<Container>* pContainers, const PODArray<Container>& others, OPERATION op)
+  {
+    if (pContainers == &others)
+    {
+      // x | x and x & x are x, x ^ x and x & ~x are empty
+      if (op == OPERATION_XOR || op == OPERATION_ANDNOT)
+      {
+        for (uint32 i = 0; i < pContainers->GetSize(); i++)
+          Release((*pContainers)[i]);
+        pContainers->Clear();
+      }
+
+      return;
+    }
+
+    PODArray<Container> result;
+    result.Reserve(Max(pContainers->GetSize(), others.GetSize()));
+
+    uint32 i = 0;
+    uint32 j = 0;
+    while (i < pContainers->GetSize() || j < others.GetSize())
+    {
+      if (j == others.GetSize() || (i < pContainers->GetSize() && (*pContainers)[i].Key < others[j].Key))
+      {
+        // only in this set
+        if (op == OPERATION_AND)
+          Release((*pContainers)[i]);
+        else
+          result.Add((*pContainers)[i]);
+
+        i++;
+      }
+      else if (i == pContainers->GetSize() || others[j].Key < (*pContainers)[i].Key)
+      {
+        // only in the other set
+        if (op == OPERATION_OR || op == OPERATION_XOR)
+          result.Add(Clone(others[j]));
+
+        j++;
+      }
+      else
+      {
+        Container combined = Apply((*pContainers)[i], others[j], op);
+        Release((*pContainers)[i]);
+        if (combined.Cardinality > 0)
+          result.Add(combined);
+        else
+          Release(combined);
+
+        i++;
+        j++;
+      }
+    }
+
+    pContainers->Swap(result);
+  }
+};
+
+typedef CompressedBitSetContainers Containers;
+
+CompressedBitSet::CompressedBitSet() {}
+
+CompressedBitSet::CompressedBitSet(const CompressedBitSet& copy)
+{
+  Copy(copy);
+}
+
+CompressedBitSet::CompressedBitSet(CompressedBitSet&& from)
+{
+  Swap(from);
+}
+
+CompressedBitSet::~CompressedBitSet()
+{
+  Clear();
+}
+
+void CompressedBitSet::Clear()
+{
+  for (uint32 i = 0; i < m_containers.GetSize(); i++)
+    Containers::Release(m_containers[i]);
+
+  m_containers.Clear();
+}
+
+uint32 CompressedBitSet::FindContainer(uint16 key) const
+{
+  uint32 low = 0;
+  uint32 high = m_containers.GetSize();
+  while (low < high)
+  {
+    uint32 middle = (low + high) / 2;
+    if (m_containers[middle].Key < key)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return low;
+}
+
+bool CompressedBitSet::TestBit(uint32 bit) const
+{
+  uint16 key = (uint16)(bit >> 16);
+  uint32 index = FindContainer(key);
+  return (index < m_containers.GetSize() && m_containers[index].Key == key &&
+          Containers::Contains(m_containers[index], bit & 0xFFFF));
+}
+
+void CompressedBitSet::SetBit(uint32 bit, bool on /* = true */)
+{
+  uint16 key = (uint16)(bit >> 16);
+  uint32 index = FindContainer(key);
+  bool exists = (index < m_containers.GetSize() && m_containers[index].Key == key);
+  if (on)
+  {
+    if (!exists)
+      m_containers.Insert(Containers::Create(key), index);
+
+    Containers::Add(m_containers[index], bit & 0xFFFF);
+  }
+  else if (exists)
+  {
+    Container& container = m_containers[index];
+    if (Containers::Remove(container, bit & 0xFFFF) && container.Cardinality == 0)
+    {
+      Containers::Release(container);
+      m_containers.OrderedRemove(index);
+    }
+  }
+}
+
+void CompressedBitSet::SetRange(uint32 first, uint32 last)
+{
+  DebugAssert(first <= last);
+  uint32 firstKey = first >> 16;
+  uint32 lastKey = last >> 16;
+  for (uint32 key = firstKey; key <= lastKey; key++)
+  {
+    uint32 low = (key == firstKey) ? (first & 0xFFFF) : 0;
+    uint32 high = (key == lastKey) ? (last & 0xFFFF) : 0xFFFF;
+    uint32 index = FindContainer((uint16)key);
+    if (index == m_containers.GetSize() || m_containers[index].Key != key)
+      m_containers.Insert(Containers::Create((uint16)key), index);
+
+    Container& container = m_containers[index];
+    if (low == 0 && high == 0xFFFF)
+    {
+      // whole chunk is a single run
+      container.Type = CONTAINER_TYPE_RUN;
+      container.Size = 1;
+      container.Cardinality = CHUNK_BIT_COUNT;
+      Containers::SetCapacity(container, 2);
+      container.pValues[0] = 0;
+      container.pValues[1] = 0xFFFF;
+      continue;
+    }
+
+    uint64 words[BITMAP_WORD_COUNT];
+    Containers::ToWords(container, words);
+    Containers::ApplyRange(words, low, high, Containers::OPERATION_OR);
+    Containers::FromWords(container, words);
+  }
+}
+
+bool CompressedBitSet::TestSetMask(const CompressedBitSet& mask) const
+{
+  for (uint32 i = 0; i < mask.m_containers.GetSize(); i++)
+  {
+    const Container& maskContainer = mask.m_containers[i];
+    uint32 index = FindContainer(maskContainer.Key);
+    if (index == m_containers.GetSize() || m_containers[index].Key != maskContainer.Key ||
+        m_containers[index].Cardinality < maskContainer.Cardinality)
+    {
+      return false;
+    }
+
+    Container remaining = Containers::Apply(maskContainer, m_containers[index], Containers::OPERATION_ANDNOT);
+    bool isSubset = (remaining.Cardinality == 0);
+    Containers::Release(remaining);
+    if (!isSubset)
+      return false;
+  }
+
+  return true;
+}
+
+bool CompressedBitSet::TestSetEqual(const CompressedBitSet& test) const
+{
+  if (m_containers.GetSize() != test.m_containers.GetSize())
+    return false;
+
+  for (uint32 i = 0; i < m_containers.GetSize(); i++)
+  {
+    const Container& left = m_containers[i];
+    const Container& right = test.m_containers[i];
+    if (left.Key != right.Key || left.Cardinality != right.Cardinality)
+      return false;
+
+    // each container type has one encoding for a given set of bits
+    if (left.Type == right.Type)
+    {
+      if (left.Size != right.Size ||
+          std::memcmp(left.pValues, right.pValues, sizeof(uint16) * Containers::GetValueCount(left)) != 0)
+      {
+        return false;
+      }
+
+      continue;
+    }
+
+    Container difference = Containers::Apply(left, right, Containers::OPERATION_XOR);
+    bool isEqual = (difference.Cardinality == 0);
+    Containers::Release(difference);
+    if (!isEqual)
+      return false;
+  }
+
+  return true;
+}
+
+void CompressedBitSet::Copy(const CompressedBitSet& other)
+{
+  if (&other == this)
+    return;
+
+  Clear();
+  m_containers.Reserve(other.m_containers.GetSize());
+  for (uint32 i = 0; i < other.m_containers.GetSize(); i++)
+    m_containers.Add(Containers::Clone(other.m_containers[i]));
+}
+
+void CompressedBitSet::Combine(const CompressedBitSet& other)
+{
+  Containers::Apply(&m_containers, other.m_containers, Containers::OPERATION_OR);
+}
+
+void CompressedBitSet::Mask(const CompressedBitSet& other)
+{
+  Containers::Apply(&m_containers, other.m_containers, Containers::OPERATION_AND);
+}
+
+void CompressedBitSet::Xor(const CompressedBitSet& other)
+{
+  Containers::Apply(&m_containers, other.m_containers, Containers::OPERATION_XOR);
+}
+
+void CompressedBitSet::AndNot(const CompressedBitSet& other)
+{
+  Containers::Apply(&m_containers, other.m_containers, Containers::OPERATION_ANDNOT);
+}
+
+bool CompressedBitSet::FindNextSetBit(uint32 startIndex, uint32* foundIndex) const
+{
+  uint16 key = (uint16)(startIndex >> 16);
+  uint32 index = FindContainer(key);
+  uint32 value;
+  if (index < m_containers.GetSize() && m_containers[index].Key == key)
+  {
+    if (Containers::FindNext(m_containers[index], startIndex & 0xFFFF, &value))
+    {
+      *foundIndex = ((uint32)key << 16) | value;
+      return true;
+    }
+
+    index++;
+  }
+
+  // containers are never empty, so the next one starts with a set bit
+  if (index == m_containers.GetSize())
+    return false;
+
+  Containers::FindNext(m_containers[index], 0, &value);
+  *foundIndex = ((uint32)m_containers[index].Key << 16) | value;
+  return true;
+}
+
+uint64 CompressedBitSet::PopCount() const
+{
+  uint64 count = 0;
+  for (uint32 i = 0; i < m_containers.GetSize(); i++)
+    count += m_containers[i].Cardinality;
+
+  return count;
+}
+
+bool CompressedBitSet::RunOptimize()
+{
+  bool changed = false;
+  for (uint32 i = 0; i < m_containers.GetSize(); i++)
+  {
+    Container& container = m_containers[i];
+    uint16 oldType = container.Type;
+
+    uint64 words[BITMAP_WORD_COUNT];
+    Containers::ToWords(container, words);
+    Containers::FromWords(container, words);
+    changed |= (container.Type != oldType);
+  }
+
+  return changed;
+}
+
+size_t CompressedBitSet::GetMemoryUsage() const
+{
+  size_t bytes = sizeof(Container) * m_containers.GetReserve();
+  for (uint32 i = 0; i < m_containers.GetSize(); i++)
+    bytes += sizeof(uint16) * m_containers[i].Capacity;
+
+  return bytes;
+}
+
+// Stream layout, in the byte order of the reader and writer:
+//   uint32 container count
+//   per container: uint16 key, uint8 type, uint32 size, then size uint16s for an array, size start/length pairs
+//   of uint16s for runs, or 1024 uint64s for a bitmap (where size is the cardinality)
+bool CompressedBitSet::Write(BinaryWriter* pWriter) const
+{
+  if (!pWriter->SafeWriteUInt32(m_containers.GetSize()))
+    return false;
+
+  for (uint32 i = 0; i < m_containers.GetSize(); i++)
+  {
+    const Container& container = m_containers[i];
+    uint32 size = (container.Type == CONTAINER_TYPE_BITMAP) ? container.Cardinality : container.Size;
+    if (!pWriter->SafeWriteUInt16(container.Key) || !pWriter->SafeWriteUInt8((uint8)container.Type) ||
+        !pWriter->SafeWriteUInt32(size))
+    {
+      return false;
+    }
+
+    if (container.Type == CONTAINER_TYPE_BITMAP)
+    {
+      const uint64* pWords = Containers::GetWords(container);
+      for (uint32 j = 0; j < BITMAP_WORD_COUNT; j++)
+      {
+        if (!pWriter->SafeWriteUInt64(pWords[j]))
+          return false;
+      }
+    }
+    else
+    {
+      uint32 valueCount = Containers::GetValueCount(container);
+      for (uint32 j = 0; j < valueCount; j++)
+      {
+        if (!pWriter->SafeWriteUInt16(container.pValues[j]))
+          return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool CompressedBitSet::Read(BinaryReader* pReader)
+{
+  Clear();
+
+  uint32 containerCount;
+  if (!pReader->SafeReadUInt32(&containerCount) || containerCount > 0x10000)
+    return false;
+
+  m_containers.Reserve(containerCount);
+  for (uint32 i = 0; i < containerCount; i++)
+  {
+    uint16 key;
+    uint8 type;
+    uint32 size;
+    if (!pReader->SafeReadUInt16(&key) || !pReader->SafeReadUInt8(&type) || !pReader->SafeReadUInt32(&size) ||
+        (i > 0 && key <= m_containers.LastElement().Key))
+    {
+      Clear();
+      return false;
+    }
+
+    // every check below also keeps the container from being empty
+    Container container = Containers::Create(key);
+    container.Type = type;
+    bool valid;
+    if (type == CONTAINER_TYPE_ARRAY)
+    {
+      valid = (size > 0 && size <= ArrayMaxCardinality);
+      if (valid)
+      {
+        container.Size = size;
+        Containers::SetCapacity(container, size);
+        for (uint32 j = 0; j < size && valid; j++)
+        {
+          valid = pReader->SafeReadUInt16(&container.pValues[j]) &&
+                  (j == 0 || container.pValues[j] > container.pValues[j - 1]);
+        }
+        container.Cardinality = size;
+      }
+    }
+    else if (type == CONTAINER_TYPE_RUN)
+    {
+      // runs have to be sorted and separated, so each set of bits has one encoding
+      valid = (size > 0 && size <= CHUNK_BIT_COUNT / 2);
+      if (valid)
+      {
+        container.Size = size;
+        Containers::SetCapacity(container, size * 2);
+        uint32 nextStart = 0;
+        for (uint32 j = 0; j < size && valid; j++)
+        {
+          valid = pReader->SafeReadUInt16(&container.pValues[j * 2]) &&
+                  pReader->SafeReadUInt16(&container.pValues[j * 2 + 1]);
+
+          uint32 start = container.pValues[j * 2];
+          uint32 end = start + container.pValues[j * 2 + 1];
+          valid = valid && start >= nextStart && end < CHUNK_BIT_COUNT;
+          container.Cardinality += end - start + 1;
+          nextStart = end + 2;
+        }
+      }
+    }
+    else if (type == CONTAINER_TYPE_BITMAP)
+    {
+      Containers::SetCapacity(container, BITMAP_VALUE_COUNT);
+      uint64* pWords = Containers::GetWords(container);
+      valid = true;
+      for (uint32 j = 0; j < BITMAP_WORD_COUNT && valid; j++)
+      {
+        valid = pReader->SafeReadUInt64(&pWords[j]);
+        container.Cardinality += Y_popcnt(pWords[j]);
+      }
+      valid = valid && container.Cardinality == size && size > 0;
+    }
+    else
+    {
+      valid = false;
+    }
+
+    if (!valid)
+    {
+      Containers::Release(container);
+      Clear();
+      return false;
+    }
+
+    m_containers.Add(container);
+  }
+
+  return true;
+}
@@ -0,0 +1,877 @@
+#include "YBaseLib/Compression.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Sort.h"
+#include <cstring>
+Log_SetChannel(Compression);
+
+#ifdef HAVE_ZLIB
+#include "YBaseLib/ZLibHelpers.h"
+#endif
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#if Y_COMPILER_MSVC
+#pragma comment(lib, "liblz4.lib")
+#endif
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#if Y_COMPILER_MSVC
+#pragma comment(lib, "libzstd.lib")
+#endif
+#endif
+
+namespace Compression {
+
+const char* GetCodecName(COMPRESSION_CODEC codec)
+{
+  static const char* codecNames[COMPRESSION_CODEC_COUNT] = {"none", "deflate", "lz4", "zstd"};
+  return (codec < COMPRESSION_CODEC_COUNT) ? codecNames[codec] : "unknown";
+}
+
+bool IsCodecAvailable(COMPRESSION_CODEC codec)
+{
+  switch (codec)
+  {
+    case COMPRESSION_CODEC_NONE:
+      return true;
+
+#ifdef HAVE_ZLIB
+    case COMPRESSION_CODEC_DEFLATE:
+      return true;
+#endif
+
+#ifdef HAVE_LZ4
+    case COMPRESSION_CODEC_LZ4:
+      return true;
+#endif
+
+#ifdef HAVE_ZSTD
+    case COMPRESSION_CODEC_ZSTD:
+      return true;
+#endif
+
+    default:
+      return false;
+  }
+}
+
+int32 GetDefaultLevel(COMPRESSION_CODEC codec)
+{
+  switch (codec)
+  {
+    case COMPRESSION_CODEC_DEFLATE:
+      return 6;
+    case COMPRESSION_CODEC_LZ4:
+      return 1;
+    case COMPRESSION_CODEC_ZSTD:
+      return 3;
+    default:
+      return 0;
+  }
+}
+
+int32 GetEffectiveLevel(COMPRESSION_CODEC codec, int32 level)
+{
+  static const int32 maxLevels[COMPRESSION_CODEC_COUNT] = {0, 9, 12, 22};
+  if (codec >= COMPRESSION_CODEC_COUNT || level <= 0)
+    return GetDefaultLevel(codec);
+
+  return Min(level, maxLevels[codec]);
+}
+
+uint32 GetCompressedSizeUpperBound(COMPRESSION_CODEC codec, uint32 cbSourceBuffer)
+{
+  switch (codec)
+  {
+#ifdef HAVE_ZLIB
+    case COMPRESSION_CODEC_DEFLATE:
+      return ZLibHelpers::GetDeflatedBufferUpperBounds(cbSourceBuffer);
+#endif
+
+#ifdef HAVE_LZ4
+    case COMPRESSION_CODEC_LZ4:
+      return (cbSourceBuffer <= LZ4_MAX_INPUT_SIZE) ? (uint32)LZ4_compressBound((int)cbSourceBuffer) : 0;
+#endif
+
+#ifdef HAVE_ZSTD
+    case COMPRESSION_CODEC_ZSTD:
+      return (uint32)ZSTD_compressBound(cbSourceBuffer);
+#endif
+
+    default:
+      return cbSourceBuffer;
+  }
+}
+
+bool CompressBuffer(COMPRESSION_CODEC codec, void* pDestinationBuffer, uint32 cbDestinationBuffer,
+                    uint32* pCompressedSize, const void* pSourceBuffer, uint32 cbSourceBuffer, int32 level /* = 0 */)
+{
+  if (!IsCodecAvailable(codec))
+  {
+    Log_ErrorPrintf("Compression::CompressBuffer: %s is not built in", GetCodecName(codec));
+    return false;
+  }
+
+  level = GetEffectiveLevel(codec, level);
+  uint32 compressedSize = 0;
+  switch (codec)
+  {
+    case COMPRESSION_CODEC_NONE:
+    {
+      if (cbSourceBuffer > cbDestinationBuffer)
+        return false;
+
+      // either buffer may be null when there's nothing to copy
+      if (cbSourceBuffer > 0)
+        std::memcpy(pDestinationBuffer, pSourceBuffer, cbSourceBuffer);
+
+      compressedSize = cbSourceBuffer;
+    }
+    break;
+
+#ifdef HAVE_ZLIB
+    case COMPRESSION_CODEC_DEFLATE:
+    {
+      if (!ZLibHelpers::WriteDeflatedDataToBuffer(pDestinationBuffer, cbDestinationBuffer, &compressedSize,
+                                                  pSourceBuffer, cbSourceBuffer, level))
+      {
+        return false;
+      }
+    }
+    break;
+#endif
+
+#ifdef HAVE_LZ4
+    case COMPRESSION_CODEC_LZ4:
+    {
+      if (cbSourceBuffer > LZ4_MAX_INPUT_SIZE)
+        return false;
+
+      int destinationSize = (int)Min(cbDestinationBuffer, (uint32)0x7FFFFFFF);
+      int result = (level <= 1) ?
+                     LZ4_compress_default((const char*)pSourceBuffer, (char*)pDestinationBuffer, (int)cbSourceBuffer,
+                                          destinationSize) :
+                     LZ4_compress_HC((const char*)pSourceBuffer, (char*)pDestinationBuffer, (int)cbSourceBuffer,
+                                     destinationSize, level);
+
+      // zero is failure, unless there was nothing to compress
+      if (result <= 0 && cbSourceBuffer > 0)
+        return false;
+
+      compressedSize = (uint32)Max(result, 0);
+    }
+    break;
+#endif
+
+#ifdef HAVE_ZSTD
+    case COMPRESSION_CODEC_ZSTD:
+    {
+      size_t result = ZSTD_compress(pDestinationBuffer, cbDestinationBuffer, pSourceBuffer, cbSourceBuffer, level);
+      if (ZSTD_isError(result))
+        return false;
+
+      compressedSize = (uint32)result;
+    }
+    break;
+#endif
+
+    default:
+      return false;
+  }
+
+  if (pCompressedSize != nullptr)
+    *pCompressedSize = compressedSize;
+
+  return true;
+}
+
+bool DecompressBuffer(COMPRESSION_CODEC codec, void* pDestinationBuffer, uint32 cbDestinationBuffer,
+                      uint32* pDecompressedSize, const void* pSourceBuffer, uint32 cbSourceBuffer)
+{
+  if (!IsCodecAvailable(codec))
+  {
+    Log_ErrorPrintf("Compression::DecompressBuffer: %s is not built in", GetCodecName(codec));
+    return false;
+  }
+
+  uint32 decompressedSize = 0;
+  switch (codec)
+  {
+    case COMPRESSION_CODEC_NONE:
+    {
+      if (cbSourceBuffer > cbDestinationBuffer)
+        return false;
+
+      // either buffer may be null when there's nothing to copy
+      if (cbSourceBuffer > 0)
+        std::memcpy(pDestinationBuffer, pSourceBuffer, cbSourceBuffer);
+
+      decompressedSize = cbSourceBuffer;
+    }
+    break;
+
+#ifdef HAVE_ZLIB
+    case COMPRESSION_CODEC_DEFLATE:
+    {
+      if (!ZLibHelpers::ReadDeflatedDataFromBuffer(pDestinationBuffer, cbDestinationBuffer, &decompressedSize,
+                                                   pSourceBuffer, cbSourceBuffer))
+      {
+        return false;
+      }
+    }
+    break;
+#endif
+
+#ifdef HAVE_LZ4
+    case COMPRESSION_CODEC_LZ4:
+    {
+      int result = LZ4_decompress_safe((const char*)pSourceBuffer, (char*)pDestinationBuffer,
+                                       (int)Min(cbSourceBuffer, (uint32)0x7FFFFFFF),
+                                       (int)Min(cbDestinationBuffer, (uint32)0x7FFFFFFF));
+      if (result < 0)
+        return false;
+
+      decompressedSize = (uint32)result;
+    }
+    break;
+#endif
+
+#ifdef HAVE_ZSTD
+    case COMPRESSION_CODEC_ZSTD:
+    {
+      size_t result = ZSTD_decompress(pDestinationBuffer, cbDestinationBuffer, pSourceBuffer, cbSourceBuffer);
+      if (ZSTD_isError(result))
+        return false;
+
+      decompressedSize = (uint32)result;
+    }
+    break;
+#endif
+
+    default:
+      return false;
+  }
+
+  if (pDecompressedSize != nullptr)
+    *pDecompressedSize = decompressedSize;
+
+  return true;
+}
+
+// Dictionaries are trained like zstd's COVER trainer, simplified. Every 8 byte run (dmer) is scored by how many
+// samples it's in, and a segment's score is what its dmers add up to. The data is split into one epoch per segment
+// the dictionary has room for, the best segment of each is picked, and its dmers score nothing from then on, so
+// later segments bring something new.
+static const uint32 TRAIN_DMER_SIZE = 8;
+static const uint32 TRAIN_SEGMENT_SIZE = 64;
+static const uint32 TRAIN_HASH_BITS = 20;
+static const uint32 TRAIN_NO_DMER = 0xFFFFFFFF;
+
+bool TrainDictionary(const void* const* ppSamples, const uint32* pSampleSizes, uint32 sampleCount,
+                     uint32 dictionaryCapacity, PODArray<byte>* pDictionary)
+{
+  pDictionary->Clear();
+
+  uint64 totalSize = 0;
+  for (uint32 i = 0; i < sampleCount; i++)
+    totalSize += pSampleSizes[i];
+  if (sampleCount < 2 || dictionaryCapacity < TRAIN_SEGMENT_SIZE || totalSize < TRAIN_SEGMENT_SIZE * 4 ||
+      totalSize > 0xFFFFFFF0)
+  {
+    Log_ErrorPrintf("Compression::TrainDictionary: not enough to train on, %u samples of %u bytes", sampleCount,
+                    (uint32)Min(totalSize, (uint64)0xFFFFFFFF));
+    return false;
+  }
+
+  // the samples one after another, with the dmer starting at each position, none where it runs past a sample
+  uint32 dataSize = (uint32)totalSize;
+  PODArray<byte> data;
+  PODArray<uint32> dmers;
+  data.Resize(dataSize);
+  dmers.Resize(dataSize);
+
+  const uint32 hashTableSize = 1u << TRAIN_HASH_BITS;
+  PODArray<uint32> frequencies;
+  PODArray<uint32> lastSamples;
+  frequencies.Resize(hashTableSize);
+  lastSamples.Resize(hashTableSize);
+  Y_memzero(frequencies.GetBasePointer(), sizeof(uint32) * hashTableSize);
+  std::memset(lastSamples.GetBasePointer(), 0xFF, sizeof(uint32) * hashTableSize);
+
+  uint32 sampleStart = 0;
+  for (uint32 sampleIndex = 0; sampleIndex < sampleCount; sampleIndex++)
+  {
+    uint32 sampleSize = pSampleSizes[sampleIndex];
+    std::memcpy(data.GetBasePointer() + sampleStart, ppSamples[sampleIndex], sampleSize);
+    for (uint32 i = 0; i < sampleSize; i++)
+    {
+      uint32 position = sampleStart + i;
+      if (i + TRAIN_DMER_SIZE > sampleSize)
+      {
+        dmers[position] = TRAIN_NO_DMER;
+        continue;
+      }
+
+      uint64 value;
+      std::memcpy(&value, data.GetBasePointer() + position, sizeof(value));
+      uint32 hash = (uint32)((value * 0x9E3779B97F4A7C15ULL) >> (64 - TRAIN_HASH_BITS));
+      dmers[position] = hash;
+
+      // counted once per sample
+      if (lastSamples[hash] != sampleIndex)
+      {
+        lastSamples[hash] = sampleIndex;
+        frequencies[hash]++;
+      }
+    }
+
+    sampleStart += sampleSize;
+  }
+
+  // runs that are only in one sample don't help the others
+  for (uint32 i = 0; i < hashTableSize; i++)
+  {
+    if (frequencies[i] < 2)
+      frequencies[i] = 0;
+  }
+
+  struct Segment
+  {
+    uint32 Start;
+    uint64 Score;
+  };
+  PODArray<Segment> segments;
+  const uint32 dmersPerSegment = TRAIN_SEGMENT_SIZE - TRAIN_DMER_SIZE + 1;
+  auto DmerScore = [&frequencies, &dmers](uint32 position) -> uint64 {
+    return (dmers[position] != TRAIN_NO_DMER) ? frequencies[dmers[position]] : 0;
+  };
+
+  uint32 segmentCount = dictionaryCapacity / TRAIN_SEGMENT_SIZE;
+  uint32 epochSize = Max(dataSize / segmentCount, TRAIN_SEGMENT_SIZE);
+  for (uint32 epochStart = 0; epochStart + TRAIN_SEGMENT_SIZE <= dataSize && segments.GetSize() < segmentCount;
+       epochStart += epochSize)
+  {
+    // slide a segment over the epoch, keeping the sum of its dmers' scores
+    uint32 epochEnd = Min(epochStart + epochSize, dataSize);
+    if (epochEnd - epochStart < TRAIN_SEGMENT_SIZE)
+      break;
+
+    uint64 score = 0;
+    for (uint32 i = 0; i < dmersPerSegment; i++)
+      score += DmerScore(epochStart + i);
+
+    Segment best = {epochStart, score};
+    for (uint32 start = epochStart + 1; start + TRAIN_SEGMENT_SIZE <= epochEnd; start++)
+    {
+      score = score - DmerScore(start - 1) + DmerScore(start + dmersPerSegment - 1);
+      if (score > best.Score)
+      {
+        best.Start = start;
+        best.Score = score;
+      }
+    }
+
+    if (best.Score == 0)
+      continue;
+
+    segments.Add(best);
+    for (uint32 i = 0; i < dmersPerSegment; i++)
+    {
+      if (dmers[best.Start + i] != TRAIN_NO_DMER)
+        frequencies[dmers[best.Start + i]] = 0;
+    }
+  }
+
+  if (segments.IsEmpty())
+  {
+    Log_ErrorPrint("Compression::TrainDictionary: the samples have nothing in common");
+    return false;
+  }
+
+  // best last
+  Y_sort(segments.GetBasePointer(), segments.GetSize(),
+         [](const Segment& left, const Segment& right) { return left.Score < right.Score; });
+  for (uint32 i = 0; i < segments.GetSize(); i++)
+    pDictionary->AddRange(data.GetBasePointer() + segments[i].Start, TRAIN_SEGMENT_SIZE);
+
+  return true;
+}
+
+} // namespace Compression
+
+struct Compressor::State
+{
+#ifdef HAVE_ZLIB
+  z_stream zStream;
+  bool zStreamInitialized;
+#endif
+#ifdef HAVE_LZ4
+  // the fast compressor's state, and a copy of it with the dictionary loaded, which is cheaper to copy than to load
+  LZ4_stream_t* pLZ4Stream;
+  LZ4_stream_t* pLZ4DictionaryStream;
+  LZ4_streamHC_t* pLZ4HCStream;
+#endif
+#ifdef HAVE_ZSTD
+  ZSTD_CCtx* pZstdContext;
+  ZSTD_CDict* pZstdDictionary;
+#endif
+};
+
+Compressor::Compressor() : m_codec(COMPRESSION_CODEC_NONE), m_level(0), m_pState(nullptr) {}
+
+Compressor::~Compressor()
+{
+  Shutdown();
+}
+
+void Compressor::Shutdown()
+{
+  if (m_pState == nullptr)
+    return;
+
+#ifdef HAVE_ZLIB
+  if (m_pState->zStreamInitialized)
+    deflateEnd(&m_pState->zStream);
+#endif
+#ifdef HAVE_LZ4
+  if (m_pState->pLZ4Stream != nullptr)
+    LZ4_freeStream(m_pState->pLZ4Stream);
+  if (m_pState->pLZ4DictionaryStream != nullptr)
+    LZ4_freeStream(m_pState->pLZ4DictionaryStream);
+  if (m_pState->pLZ4HCStream != nullptr)
+    LZ4_freeStreamHC(m_pState->pLZ4HCStream);
+#endif
+#ifdef HAVE_ZSTD
+  ZSTD_freeCDict(m_pState->pZstdDictionary);
+  ZSTD_freeCCtx(m_pState->pZstdContext);
+#endif
+
+  delete m_pState;
+  m_pState = nullptr;
+  m_codec = COMPRESSION_CODEC_NONE;
+  m_dictionary.Clear();
+}
+
+bool Compressor::Initialize(COMPRESSION_CODEC codec, int32 level /* = 0 */)
+{
+  Shutdown();
+  if (!Compression::IsCodecAvailable(codec))
+  {
+    Log_ErrorPrintf("Compressor::Initialize: %s is not built in", Compression::GetCodecName(codec));
+    return false;
+  }
+
+  m_codec = codec;
+  m_level = Compression::GetEffectiveLevel(codec, level);
+  m_pState = new State;
+  Y_memzero(m_pState, sizeof(State));
+
+  bool result = true;
+  switch (codec)
+  {
+#ifdef HAVE_ZLIB
+    case COMPRESSION_CODEC_DEFLATE:
+      m_pState->zStreamInitialized = result = (deflateInit(&m_pState->zStream, m_level) == Z_OK);
+      break;
+#endif
+
+#ifdef HAVE_LZ4
+    case COMPRESSION_CODEC_LZ4:
+    {
+      if (m_level <= 1)
+      {
+        m_pState->pLZ4Stream = LZ4_createStream();
+        result = (m_pState->pLZ4Stream != nullptr);
+      }
+      else
+      {
+        m_pState->pLZ4HCStream = LZ4_createStreamHC();
+        result = (m_pState->pLZ4HCStream != nullptr);
+      }
+    }
+    break;
+#endif
+
+#ifdef HAVE_ZSTD
+    case COMPRESSION_CODEC_ZSTD:
+      m_pState->pZstdContext = ZSTD_createCCtx();
+      result = (m_pState->pZstdContext != nullptr);
+      break;
+#endif
+
+    default:
+      break;
+  }
+
+  if (!result)
+  {
+    Log_ErrorPrintf("Compressor::Initialize: %s could not be set up", Compression::GetCodecName(codec));
+    Shutdown();
+  }
+
+  return result;
+}
+
+bool Compressor::SetDictionary(const void* pDictionary, uint32 dictionarySize)
+{
+  if (m_pState == nullptr)
+    return false;
+
+  m_dictionary.Clear();
+  m_dictionary.AddRange(reinterpret_cast<const byte*>(pDictionary), dictionarySize);
+
+  switch (m_codec)
+  {
+#ifdef HAVE_LZ4
+    case COMPRESSION_CODEC_LZ4:
+    {
+      if (m_pState->pLZ4Stream == nullptr)
+        return true;
+
+      if (m_pState->pLZ4DictionaryStream == nullptr)
+        m_pState->pLZ4DictionaryStream = LZ4_createStream();
+      else
+        LZ4_resetStream_fast(m_pState->pLZ4DictionaryStream);
+
+      LZ4_loadDict(m_pState->pLZ4DictionaryStream, (const char*)m_dictionary.GetBasePointer(),
+                   (int)m_dictionary.GetSize());
+      return true;
+    }
+#endif
+
+#ifdef HAVE_ZSTD
+    case COMPRESSION_CODEC_ZSTD:
+    {
+      ZSTD_freeCDict(m_pState->pZstdDictionary);
+      m_pState->pZstdDictionary = nullptr;
+      if (m_dictionary.IsEmpty())
+        return true;
+
+      m_pState->pZstdDictionary = ZSTD_createCDict(m_dictionary.GetBasePointer(), m_dictionary.GetSize(), m_level);
+      return (m_pState->pZstdDictionary != nullptr);
+    }
+#endif
+
+    default:
+      return true;
+  }
+}
+
+uint32 Compressor::GetCompressedSizeUpperBound(uint32 cbSourceBuffer) const
+{
+  // a zlib header with a dictionary carries its checksum
+  uint32 bound = Compression::GetCompressedSizeUpperBound(m_codec, cbSourceBuffer);
+  return (m_codec == COMPRESSION_CODEC_DEFLATE) ? (bound + 4) : bound;
+}
+
+bool Compressor::Compress(void* pDestinationBuffer, uint32 cbDestinationBuffer, uint32* pCompressedSize,
+                          const void* pSourceBuffer, uint32 cbSourceBuffer)
+{
+  if (m_pState == nullptr)
+    return false;
+
+  uint32 compressedSize = 0;
+  switch (m_codec)
+  {
+    case COMPRESSION_CODEC_NONE:
+      return Compression::CompressBuffer(m_codec, pDestinationBuffer, cbDestinationBuffer, pCompressedSize,
+                                         pSourceBuffer, cbSourceBuffer);
+
+#ifdef HAVE_ZLIB
+    case COMPRESSION_CODEC_DEFLATE:
+    {
+      z_stream* pStream = &m_pState->zStream;
+      if (deflateReset(pStream) != Z_OK ||
+          (!m_dictionary.IsEmpty() &&
+           deflateSetDictionary(pStream, m_dictionary.GetBasePointer(), m_dictionary.GetSize()) != Z_OK))
+      {
+        return false;
+      }
+
+      pStream->next_in = (Bytef*)pSourceBuffer;
+      pStream->avail_in = cbSourceBuffer;
+      pStream->next_out = (Bytef*)pDestinationBuffer;
+      pStream->avail_out = cbDestinationBuffer;
+      if (deflate(pStream, Z_FINISH) != Z_STREAM_END)
+        return false;
+
+      compressedSize = (uint32)pStream->total_out;
+    }
+    break;
+#endif
+
+#ifdef HAVE_LZ4
+    case COMPRESSION_CODEC_LZ4:
+    {
+      if (cbSourceBuffer > LZ4_MAX_INPUT_SIZE)
+        return false;
+
+      const char* pSource = (const char*)pSourceBuffer;
+      char* pDestination = (char*)pDestinationBuffer;
+      int destinationSize = (int)Min(cbDestinationBuffer, (uint32)0x7FFFFFFF);
+      int result;
+      if (m_pState->pLZ4Stream != nullptr)
+      {
+        if (m_pState->pLZ4DictionaryStream != nullptr && !m_dictionary.IsEmpty())
+        {
+          std::memcpy(m_pState->pLZ4Stream, m_pState->pLZ4DictionaryStream, sizeof(LZ4_stream_t));
+          result = LZ4_compress_fast_continue(m_pState->pLZ4Stream, pSource, pDestination, (int)cbSourceBuffer,
+                                              destinationSize, 1);
+        }
+        else
+        {
+          result = LZ4_compress_fast_extState(m_pState->pLZ4Stream, pSource, pDestination, (int)cbSourceBuffer,
+                                              destinationSize, 1);
+        }
+      }
+      else
+      {
+        // LZ4HC's state is too large to copy, so the dictionary is loaded every time
+        if (!m_dictionary.IsEmpty())
+        {
+          LZ4_resetStreamHC_fast(m_pState->pLZ4HCStream, m_level);
+          LZ4_loadDictHC(m_pState->pLZ4HCStream, (const char*)m_dictionary.GetBasePointer(),
+                         (int)m_dictionary.GetSize());
+          result = LZ4_compress_HC_continue(m_pState->pLZ4HCStream, pSource, pDestination, (int)cbSourceBuffer,
+                                            destinationSize);
+        }
+        else
+        {
+          result = LZ4_compress_HC_extStateHC(m_pState->pLZ4HCStream, pSource, pDestination, (int)cbSourceBuffer,
+                                              destinationSize, m_level);
+        }
+      }
+
+      if (result <= 0 && cbSourceBuffer > 0)
+        return false;
+
+      compressedSize = (uint32)Max(result, 0);
+    }
+    break;
+#endif
+
+#ifdef HAVE_ZSTD
+    case COMPRESSION_CODEC_ZSTD:
+    {
+      size_t result =
+        (m_pState->pZstdDictionary != nullptr) ?
+          ZSTD_compress_usingCDict(m_pState->pZstdContext, pDestinationBuffer, cbDestinationBuffer, pSourceBuffer,
+                                   cbSourceBuffer, m_pState->pZstdDictionary) :
+          ZSTD_compressCCtx(m_pState->pZstdContext, pDestinationBuffer, cbDestinationBuffer, pSourceBuffer,
+                            cbSourceBuffer, m_level);
+      if (ZSTD_isError(result))
+        return false;
+
+      compressedSize = (uint32)result;
+    }
+    break;
+#endif
+
+    default:
+      return false;
+  }
+
+  if (pCompressedSize != nullptr)
+    *pCompressedSize = compressedSize;
+
+  return true;
+}
+
+struct Decompressor::State
+{
+#ifdef HAVE_ZLIB
+  z_stream zStream;
+  bool zStreamInitialized;
+#endif
+#ifdef HAVE_ZSTD
+  ZSTD_DCtx* pZstdContext;
+  ZSTD_DDict* pZstdDictionary;
+#endif
+
+  // LZ4 blocks need no state
+  bool Unused;
+};
+
+Decompressor::Decompressor() : m_codec(COMPRESSION_CODEC_NONE), m_pState(nullptr) {}
+
+Decompressor::~Decompressor()
+{
+  Shutdown();
+}
+
+void Decompressor::Shutdown()
+{
+  if (m_pState == nullptr)
+    return;
+
+#ifdef HAVE_ZLIB
+  if (m_pState->zStreamInitialized)
+    inflateEnd(&m_pState->zStream);
+#endif
+#ifdef HAVE_ZSTD
+  ZSTD_freeDDict(m_pState->pZstdDictionary);
+  ZSTD_freeDCtx(m_pState->pZstdContext);
+#endif
+
+  delete m_pState;
+  m_pState = nullptr;
+  m_codec = COMPRESSION_CODEC_NONE;
+  m_dictionary.Clear();
+}
+
+bool Decompressor::Initialize(COMPRESSION_CODEC codec)
+{
+  Shutdown();
+  if (!Compression::IsCodecAvailable(codec))
+  {
+    Log_ErrorPrintf("Decompressor::Initialize: %s is not built in", Compression::GetCodecName(codec));
+    return false;
+  }
+
+  m_codec = codec;
+  m_pState = new State;
+  Y_memzero(m_pState, sizeof(State));
+
+  bool result = true;
+  switch (codec)
+  {
+#ifdef HAVE_ZLIB
+    case COMPRESSION_CODEC_DEFLATE:
+      m_pState->zStreamInitialized = result = (inflateInit(&m_pState->zStream) == Z_OK);
+      break;
+#endif
+
+#ifdef HAVE_ZSTD
+    case COMPRESSION_CODEC_ZSTD:
+      m_pState->pZstdContext = ZSTD_createDCtx();
+      result = (m_pState->pZstdContext != nullptr);
+      break;
+#endif
+
+    default:
+      break;
+  }
+
+  if (!result)
+  {
+    Log_ErrorPrintf("Decompressor::Initialize: %s could not be set up", Compression::GetCodecName(codec));
+    Shutdown();
+  }
+
+  return result;
+}
+
+bool Decompressor::SetDictionary(const void* pDictionary, uint32 dictionarySize)
+{
+  if (m_pState == nullptr)
+    return false;
+
+  m_dictionary.Clear();
+  m_dictionary.AddRange(reinterpret_cast<const byte*>(pDictionary), dictionarySize);
+
+#ifdef HAVE_ZSTD
+  if (m_codec == COMPRESSION_CODEC_ZSTD)
+  {
+    ZSTD_freeDDict(m_pState->pZstdDictionary);
+    m_pState->pZstdDictionary = nullptr;
+    if (!m_dictionary.IsEmpty())
+    {
+      m_pState->pZstdDictionary = ZSTD_createDDict(m_dictionary.GetBasePointer(), m_dictionary.GetSize());
+      return (m_pState->pZstdDictionary != nullptr);
+    }
+  }
+#endif
+
+  return true;
+}
+
+bool Decompressor::Decompress(void* pDestinationBuffer, uint32 cbDestinationBuffer, uint32* pDecompressedSize,
+                              const void* pSourceBuffer, uint32 cbSourceBuffer)
+{
+  if (m_pState == nullptr)
+    return false;
+
+  uint32 decompressedSize = 0;
+  switch (m_codec)
+  {
+    case COMPRESSION_CODEC_NONE:
+      return Compression::DecompressBuffer(m_codec, pDestinationBuffer, cbDestinationBuffer, pDecompressedSize,
+                                           pSourceBuffer, cbSourceBuffer);
+
+#ifdef HAVE_ZLIB
+    case COMPRESSION_CODEC_DEFLATE:
+    {
+      z_stream* pStream = &m_pState->zStream;
+      if (inflateReset(pStream) != Z_OK)
+        return false;
+
+      pStream->next_in = (Bytef*)pSourceBuffer;
+      pStream->avail_in = cbSourceBuffer;
+      pStream->next_out = (Bytef*)pDestinationBuffer;
+      pStream->avail_out = cbDestinationBuffer;
+      int err = inflate(pStream, Z_FINISH);
+
+      // the header names the dictionary it needs, which has to be ours
+      if (err == Z_NEED_DICT)
+      {
+        if (m_dictionary.IsEmpty() ||
+            inflateSetDictionary(pStream, m_dictionary.GetBasePointer(), m_dictionary.GetSize()) != Z_OK)
+        {
+          return false;
+        }
+
+        err = inflate(pStream, Z_FINISH);
+      }
+
+      if (err != Z_STREAM_END)
+        return false;
+
+      decompressedSize = (uint32)pStream->total_out;
+    }
+    break;
+#endif
+
+#ifdef HAVE_LZ4
+    case COMPRESSION_CODEC_LZ4:
+    {
+      int result = LZ4_decompress_safe_usingDict(
+        (const char*)pSourceBuffer, (char*)pDestinationBuffer, (int)Min(cbSourceBuffer, (uint32)0x7FFFFFFF),
+        (int)Min(cbDestinationBuffer, (uint32)0x7FFFFFFF), (const char*)m_dictionary.GetBasePointer(),
+        (int)m_dictionary.GetSize());
+      if (result < 0)
+        return false;
+
+      decompressedSize = (uint32)result;
+    }
+    break;
+#endif
+
+#ifdef HAVE_ZSTD
+    case COMPRESSION_CODEC_ZSTD:
+    {
+      size_t result =
+        (m_pState->pZstdDictionary != nullptr) ?
+          ZSTD_decompress_usingDDict(m_pState->pZstdContext, pDestinationBuffer, cbDestinationBuffer, pSourceBuffer,
+                                     cbSourceBuffer, m_pState->pZstdDictionary) :
+          ZSTD_decompressDCtx(m_pState->pZstdContext, pDestinationBuffer, cbDestinationBuffer, pSourceBuffer,
+                              cbSourceBuffer);
+      if (ZSTD_isError(result))
+        return false;
+
+      decompressedSize = (uint32)result;
+    }
+    break;
+#endif
+
+    default:
+      return false;
+  }
+
+  if (pDecompressedSize != nullptr)
+    *pDecompressedSize = decompressedSize;
+
+  return true;
+}
@@ -0,0 +1,670 @@
+#include "YBaseLib/CompressionByteStream.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Memory.h"
+#include <cstring>
+Log_SetChannel(CompressionByteStream);
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// how much a codec is asked to write out after compressing
+enum FLUSH_MODE
+{
+  FLUSH_NONE,
+  FLUSH_SYNC,
+  FLUSH_FINISH,
+};
+
+// what's left over when a codec compresses with nothing buffered is bounded, so it has its own output buffer
+static const uint32 COMPRESSED_OUTPUT_BUFFER_SIZE = 65536;
+
+class CompressionByteStream::Codec
+{
+public:
+  virtual ~Codec() {}
+
+  // compresses the input, writing what comes out to the stream, and as much as the flush mode asks for
+  virtual bool Compress(ByteStream* pStream, const byte* pInput, uint32 inputSize, uint32 flushMode) = 0;
+
+  // decompresses as much as fits, advancing the input and output, and setting *pEnd at the end of the data
+  virtual bool Decompress(const byte** ppInput, uint32* pInputSize, byte** ppOutput, uint32* pOutputSize,
+                          bool* pEnd) = 0;
+};
+
+namespace {
+
+// no compression, the data is written and read as it is, ending with the wrapped stream
+class StoreCodec : public CompressionByteStream::Codec
+{
+public:
+  virtual bool Compress(ByteStream* pStream, const byte* pInput, uint32 inputSize, uint32 flushMode) override
+  {
+    return (inputSize == 0 || pStream->Write2(pInput, inputSize));
+  }
+
+  virtual bool Decompress(const byte** ppInput, uint32* pInputSize, byte** ppOutput, uint32* pOutputSize,
+                          bool* pEnd) override
+  {
+    uint32 count = Min(*pInputSize, *pOutputSize);
+    std::memcpy(*ppOutput, *ppInput, count);
+    *ppInput += count;
+    *pInputSize -= count;
+    *ppOutput += count;
+    *pOutputSize -= count;
+    return true;
+  }
+};
+
+#ifdef HAVE_ZLIB
+
+class DeflateCodec : public CompressionByteStream::Codec
+{
+public:
+  DeflateCodec(bool compressing) : m_compressing(compressing), m_initialized(false)
+  {
+    Y_memzero(&m_zStream, sizeof(m_zStream));
+  }
+
+  ~DeflateCodec()
+  {
+    if (m_initialized)
+    {
+      if (m_compressing)
+        deflateEnd(&m_zStream);
+      else
+        inflateEnd(&m_zStream);
+    }
+  }
+
+  bool Initialize(int32 level)
+  {
+    int err = m_compressing ? deflateInit(&m_zStream, level) : inflateInit(&m_zStream);
+    m_initialized = (err == Z_OK);
+    return m_initialized;
+  }
+
+  virtual bool Compress(ByteStream* pStream, const byte* pInput, uint32 inputSize, uint32 flushMode) override
+  {
+    static const int zlibFlushModes[] = {Z_NO_FLUSH, Z_SYNC_FLUSH, Z_FINISH};
+    m_zStream.next_in = (Bytef*)pInput;
+    m_zStream.avail_in = inputSize;
+    for (;;)
+    {
+      m_zStream.next_out = (Bytef*)m_output;
+      m_zStream.avail_out = sizeof(m_output);
+
+      // Z_BUF_ERROR is only a flush with nothing to do
+      int err = deflate(&m_zStream, zlibFlushModes[flushMode]);
+      if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
+        return false;
+
+      uint32 outputSize = sizeof(m_output) - m_zStream.avail_out;
+      if (outputSize > 0 && !pStream->Write2(m_output, outputSize))
+        return false;
+
+      // all the input is taken once there's room left over
+      if ((flushMode == FLUSH_FINISH) ? (err == Z_STREAM_END) : (m_zStream.avail_out != 0))
+        return true;
+    }
+  }
+
+  virtual bool Decompress(const byte** ppInput, uint32* pInputSize, byte** ppOutput, uint32* pOutputSize,
+                          bool* pEnd) override
+  {
+    m_zStream.next_in = (Bytef*)*ppInput;
+    m_zStream.avail_in = *pInputSize;
+    m_zStream.next_out = (Bytef*)*ppOutput;
+    m_zStream.avail_out = *pOutputSize;
+    int err = inflate(&m_zStream, Z_NO_FLUSH);
+    if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
+      return false;
+
+    *ppInput = (const byte*)m_zStream.next_in;
+    *pInputSize = m_zStream.avail_in;
+    *ppOutput = (byte*)m_zStream.next_out;
+    *pOutputSize = m_zStream.avail_out;
+    *pEnd = (err == Z_STREAM_END);
+    return true;
+  }
+
+private:
+  z_stream m_zStream;
+  bool m_compressing;
+  bool m_initialized;
+  byte m_output[COMPRESSED_OUTPUT_BUFFER_SIZE];
+};
+
+#endif
+
+#ifdef HAVE_LZ4
+
+class LZ4Codec : public CompressionByteStream::Codec
+{
+public:
+  // compressUpdate needs room for everything a call could produce, so input is handed over this much at a time
+  static const uint32 INPUT_CHUNK_SIZE = 65536;
+
+  LZ4Codec()
+    : m_pCompressionContext(nullptr), m_pDecompressionContext(nullptr), m_pOutput(nullptr), m_outputSize(0),
+      m_started(false)
+  {
+    Y_memzero(&m_preferences, sizeof(m_preferences));
+  }
+
+  ~LZ4Codec()
+  {
+    if (m_pCompressionContext != nullptr)
+      LZ4F_freeCompressionContext(m_pCompressionContext);
+    if (m_pDecompressionContext != nullptr)
+      LZ4F_freeDecompressionContext(m_pDecompressionContext);
+
+    Y_free(m_pOutput);
+  }
+
+  bool InitializeCompression(int32 level)
+  {
+    // level 1 is the fast compressor, which LZ4F calls 0, the rest are LZ4HC's levels
+    m_preferences.compressionLevel = (level <= 1) ? 0 : level;
+    m_preferences.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+    if (LZ4F_isError(LZ4F_createCompressionContext(&m_pCompressionContext, LZ4F_VERSION)))
+      return false;
+
+    m_outputSize = Max((uint32)LZ4F_compressBound(INPUT_CHUNK_SIZE, &m_preferences), (uint32)LZ4F_HEADER_SIZE_MAX);
+    m_pOutput = (byte*)Y_malloc(m_outputSize);
+    return true;
+  }
+
+  bool InitializeDecompression()
+  {
+    return !LZ4F_isError(LZ4F_createDecompressionContext(&m_pDecompressionContext, LZ4F_VERSION));
+  }
+
+  virtual bool Compress(ByteStream* pStream, const byte* pInput, uint32 inputSize, uint32 flushMode) override
+  {
+    if (!m_started)
+    {
+      size_t headerSize = LZ4F_compressBegin(m_pCompressionContext, m_pOutput, m_outputSize, &m_preferences);
+      if (LZ4F_isError(headerSize) || !pStream->Write2(m_pOutput, (uint32)headerSize))
+        return false;
+
+      m_started = true;
+    }
+
+    while (inputSize > 0)
+    {
+      uint32 chunkSize = Min(inputSize, INPUT_CHUNK_SIZE);
+      size_t outputSize =
+        LZ4F_compressUpdate(m_pCompressionContext, m_pOutput, m_outputSize, pInput, chunkSize, nullptr);
+      if (LZ4F_isError(outputSize) || (outputSize > 0 && !pStream->Write2(m_pOutput, (uint32)outputSize)))
+        return false;
+
+      pInput += chunkSize;
+      inputSize -= chunkSize;
+    }
+
+    if (flushMode == FLUSH_NONE)
+      return true;
+
+    size_t outputSize = (flushMode == FLUSH_FINISH) ?
+                          LZ4F_compressEnd(m_pCompressionContext, m_pOutput, m_outputSize, nullptr) :
+                          LZ4F_flush(m_pCompressionContext, m_pOutput, m_outputSize, nullptr);
+    return (!LZ4F_isError(outputSize) && (outputSize == 0 || pStream->Write2(m_pOutput, (uint32)outputSize)));
+  }
+
+  virtual bool Decompress(const byte** ppInput, uint32* pInputSize, byte** ppOutput, uint32* pOutputSize,
+                          bool* pEnd) override
+  {
+    size_t inputSize = *pInputSize;
+    size_t outputSize = *pOutputSize;
+    size_t result = LZ4F_decompress(m_pDecompressionContext, *ppOutput, &outputSize, *ppInput, &inputSize, nullptr);
+    if (LZ4F_isError(result))
+      return false;
+
+    *ppInput += inputSize;
+    *pInputSize -= (uint32)inputSize;
+    *ppOutput += outputSize;
+    *pOutputSize -= (uint32)outputSize;
+    *pEnd = (result == 0);
+    return true;
+  }
+
+private:
+  LZ4F_cctx* m_pCompressionContext;
+  LZ4F_dctx* m_pDecompressionContext;
+  LZ4F_preferences_t m_preferences;
+  byte* m_pOutput;
+  uint32 m_outputSize;
+  bool m_started;
+};
+
+#endif
+
+#ifdef HAVE_ZSTD
+
+class ZstdCodec : public CompressionByteStream::Codec
+{
+public:
+  ZstdCodec() : m_pCompressionStream(nullptr), m_pDecompressionStream(nullptr) {}
+
+  ~ZstdCodec()
+  {
+    if (m_pCompressionStream != nullptr)
+      ZSTD_freeCStream(m_pCompressionStream);
+    if (m_pDecompressionStream != nullptr)
+      ZSTD_freeDStream(m_pDecompressionStream);
+  }
+
+  bool InitializeCompression(int32 level)
+  {
+    m_pCompressionStream = ZSTD_createCStream();
+    return (m_pCompressionStream != nullptr && !ZSTD_isError(ZSTD_initCStream(m_pCompressionStream, level)));
+  }
+
+  bool InitializeDecompression()
+  {
+    m_pDecompressionStream = ZSTD_createDStream();
+    return (m_pDecompressionStream != nullptr && !ZSTD_isError(ZSTD_initDStream(m_pDecompressionStream)));
+  }
+
+  virtual bool Compress(ByteStream* pStream, const byte* pInput, uint32 inputSize, uint32 flushMode) override
+  {
+    ZSTD_inBuffer input = {pInput, inputSize, 0};
+    while (input.pos < input.size)
+    {
+      ZSTD_outBuffer output = {m_output, sizeof(m_output), 0};
+      if (ZSTD_isError(ZSTD_compressStream(m_pCompressionStream, &output, &input)) || !WriteOutput(pStream, output))
+        return false;
+    }
+
+    if (flushMode == FLUSH_NONE)
+      return true;
+
+    // both return what's still to be written out
+    size_t remaining;
+    do
+    {
+      ZSTD_outBuffer output = {m_output, sizeof(m_output), 0};
+      remaining = (flushMode == FLUSH_FINISH) ? ZSTD_endStream(m_pCompressionStream, &output) :
+                                                ZSTD_flushStream(m_pCompressionStream, &output);
+      if (ZSTD_isError(remaining) || !WriteOutput(pStream, output))
+        return false;
+    } while (remaining > 0);
+
+    return true;
+  }
+
+  virtual bool Decompress(const byte** ppInput, uint32* pInputSize, byte** ppOutput, uint32* pOutputSize,
+                          bool* pEnd) override
+  {
+    ZSTD_inBuffer input = {*ppInput, *pInputSize, 0};
+    ZSTD_outBuffer output = {*ppOutput, *pOutputSize, 0};
+    size_t result = ZSTD_decompressStream(m_pDecompressionStream, &output, &input);
+    if (ZSTD_isError(result))
+      return false;
+
+    *ppInput += input.pos;
+    *pInputSize -= (uint32)input.pos;
+    *ppOutput += output.pos;
+    *pOutputSize -= (uint32)output.pos;
+    *pEnd = (result == 0);
+    return true;
+  }
+
+private:
+  static bool WriteOutput(ByteStream* pStream, const ZSTD_outBuffer& output)
+  {
+    return (output.pos == 0 || pStream->Write2(output.dst, (uint32)output.pos));
+  }
+
+  ZSTD_CStream* m_pCompressionStream;
+  ZSTD_DStream* m_pDecompressionStream;
+  byte m_output[COMPRESSED_OUTPUT_BUFFER_SIZE];
+};
+
+#endif
+
+// the codec, set up to compress or decompress, or nullptr if it isn't built in or can't be started
+CompressionByteStream::Codec* CreateCodec(COMPRESSION_CODEC codec, bool compressing, int32 level)
+{
+  switch (codec)
+  {
+    case COMPRESSION_CODEC_NONE:
+      return new StoreCodec();
+
+#ifdef HAVE_ZLIB
+    case COMPRESSION_CODEC_DEFLATE:
+    {
+      DeflateCodec* pCodec = new DeflateCodec(compressing);
+      if (pCodec->Initialize(level))
+        return pCodec;
+
+      delete pCodec;
+      return nullptr;
+    }
+#endif
+
+#ifdef HAVE_LZ4
+    case COMPRESSION_CODEC_LZ4:
+    {
+      LZ4Codec* pCodec = new LZ4Codec();
+      if (compressing ? pCodec->InitializeCompression(level) : pCodec->InitializeDecompression())
+        return pCodec;
+
+      delete pCodec;
+      return nullptr;
+    }
+#endif
+
+#ifdef HAVE_ZSTD
+    case COMPRESSION_CODEC_ZSTD:
+    {
+      ZstdCodec* pCodec = new ZstdCodec();
+      if (compressing ? pCodec->InitializeCompression(level) : pCodec->InitializeDecompression())
+        return pCodec;
+
+      delete pCodec;
+      return nullptr;
+    }
+#endif
+
+    default:
+      return nullptr;
+  }
+}
+
+} // namespace
+
+CompressionByteStream* CompressionByteStream::CreateCompressor(ByteStream* pStream, COMPRESSION_CODEC codec,
+                                                               int32 level /* = 0 */,
+                                                               uint32 bufferSize /* = DefaultBufferSize */)
+{
+  Codec* pCodec = CreateCodec(codec, true, Compression::GetEffectiveLevel(codec, level));
+  if (pCodec == nullptr)
+  {
+    Log_ErrorPrintf("CompressionByteStream::CreateCompressor: %s is not available", Compression::GetCodecName(codec));
+    return nullptr;
+  }
+
+  return new CompressionByteStream(pStream, codec, pCodec, true, bufferSize);
+}
+
+CompressionByteStream* CompressionByteStream::CreateDecompressor(ByteStream* pStream, COMPRESSION_CODEC codec,
+                                                                 uint32 bufferSize /* = DefaultBufferSize */)
+{
+  Codec* pCodec = CreateCodec(codec, false, 0);
+  if (pCodec == nullptr)
+  {
+    Log_ErrorPrintf("CompressionByteStream::CreateDecompressor: %s is not available",
+                    Compression::GetCodecName(codec));
+    return nullptr;
+  }
+
+  return new CompressionByteStream(pStream, codec, pCodec, false, bufferSize);
+}
+
+CompressionByteStream::CompressionByteStream(ByteStream* pStream, COMPRESSION_CODEC codec, Codec* pCodec,
+                                             bool compressing, uint32 bufferSize)
+  : m_pStream(pStream), m_codec(codec), m_pCodec(pCodec), m_compressing(compressing), m_finished(false),
+    m_endOfStream(false), m_innerEndOfStream(false), m_position(0), m_pBuffer(nullptr), m_bufferSize(bufferSize),
+    m_bufferStart(0), m_bufferEnd(0)
+{
+  DebugAssert(bufferSize > 0);
+  m_pStream->AddRef();
+  m_pBuffer = (byte*)Y_malloc(bufferSize);
+}
+
+CompressionByteStream::~CompressionByteStream()
+{
+  if (m_compressing)
+    Finish();
+
+  delete m_pCodec;
+  Y_free(m_pBuffer);
+  m_pStream->Release();
+}
+
+bool CompressionByteStream::CompressPending(const byte* pSource, uint32 sourceSize, uint32 flushMode)
+{
+  // the buffer only ever needs a flush of its own when there's nothing else to go with it
+  if (m_bufferEnd > 0)
+  {
+    uint32 bufferedSize = m_bufferEnd;
+    m_bufferEnd = 0;
+    if (!m_pCodec->Compress(m_pStream, m_pBuffer, bufferedSize, (sourceSize > 0) ? (uint32)FLUSH_NONE : flushMode))
+    {
+      m_errorState = true;
+      return false;
+    }
+
+    if (sourceSize == 0)
+      return true;
+  }
+
+  if (!m_pCodec->Compress(m_pStream, pSource, sourceSize, flushMode))
+  {
+    m_errorState = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool CompressionByteStream::Finish()
+{
+  if (!m_compressing)
+    return false;
+
+  if (m_finished)
+    return !m_errorState;
+
+  m_finished = true;
+  return (!m_errorState && CompressPending(nullptr, 0, FLUSH_FINISH));
+}
+
+bool CompressionByteStream::ReadByte(byte* pDestByte)
+{
+  return Read2(pDestByte, 1);
+}
+
+uint32 CompressionByteStream::Read(void* pDestination, uint32 ByteCount)
+{
+  if (m_compressing || m_errorState)
+    return 0;
+
+  byte* pOutput = reinterpret_cast<byte*>(pDestination);
+  uint32 outputSize = ByteCount;
+  while (outputSize > 0 && !m_endOfStream)
+  {
+    if (m_bufferStart == m_bufferEnd && !m_innerEndOfStream)
+    {
+      m_bufferStart = 0;
+      m_bufferEnd = m_pStream->Read(m_pBuffer, m_bufferSize);
+      if (m_bufferEnd == 0)
+      {
+        if (m_pStream->InErrorState())
+        {
+          m_errorState = true;
+          break;
+        }
+
+        m_innerEndOfStream = true;
+      }
+    }
+
+    const byte* pInput = m_pBuffer + m_bufferStart;
+    uint32 inputSize = m_bufferEnd - m_bufferStart;
+    uint32 lastOutputSize = outputSize;
+    bool end = false;
+    if (!m_pCodec->Decompress(&pInput, &inputSize, &pOutput, &outputSize, &end))
+    {
+      Log_ErrorPrintf("CompressionByteStream::Read: %s data is corrupt", Compression::GetCodecName(m_codec));
+      m_errorState = true;
+      break;
+    }
+
+    bool progress = (inputSize != m_bufferEnd - m_bufferStart || outputSize != lastOutputSize);
+    m_bufferStart = m_bufferEnd - inputSize;
+    m_endOfStream = end;
+    if (!progress && m_innerEndOfStream)
+    {
+      // stored data ends with the wrapped stream, anything else ending there was cut short
+      if (m_codec == COMPRESSION_CODEC_NONE)
+      {
+        m_endOfStream = true;
+      }
+      else
+      {
+        Log_ErrorPrintf("CompressionByteStream::Read: %s data is truncated", Compression::GetCodecName(m_codec));
+        m_errorState = true;
+      }
+
+      break;
+    }
+  }
+
+  uint32 bytesRead = ByteCount - outputSize;
+  m_position += bytesRead;
+  return bytesRead;
+}
+
+bool CompressionByteStream::Read2(void* pDestination, uint32 ByteCount, uint32* pNumberOfBytesRead /* = nullptr */)
+{
+  uint32 bytesRead = Read(pDestination, ByteCount);
+  if (pNumberOfBytesRead != nullptr)
+    *pNumberOfBytesRead = bytesRead;
+
+  if (bytesRead != ByteCount)
+  {
+    m_errorState = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool CompressionByteStream::WriteByte(byte SourceByte)
+{
+  if (m_compressing && !m_finished && m_bufferEnd < m_bufferSize && !m_errorState)
+  {
+    m_pBuffer[m_bufferEnd++] = SourceByte;
+    m_position++;
+    return true;
+  }
+
+  return Write2(&SourceByte, 1);
+}
+
+uint32 CompressionByteStream::Write(const void* pSource, uint32 ByteCount)
+{
+  if (!m_compressing || m_finished || m_errorState)
+    return 0;
+
+  // small writes are gathered, large ones go straight to the codec
+  if (m_bufferEnd + ByteCount <= m_bufferSize)
+  {
+    std::memcpy(m_pBuffer + m_bufferEnd, pSource, ByteCount);
+    m_bufferEnd += ByteCount;
+  }
+  else if (!CompressPending(reinterpret_cast<const byte*>(pSource), ByteCount, FLUSH_NONE))
+  {
+    return 0;
+  }
+
+  m_position += ByteCount;
+  return ByteCount;
+}
+
+bool CompressionByteStream::Write2(const void* pSource, uint32 ByteCount, uint32* pNumberOfBytesWritten /* = nullptr */)
+{
+  uint32 bytesWritten = Write(pSource, ByteCount);
+  if (pNumberOfBytesWritten != nullptr)
+    *pNumberOfBytesWritten = bytesWritten;
+
+  if (bytesWritten != ByteCount)
+  {
+    m_errorState = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool CompressionByteStream::SeekAbsolute(uint64 Offset)
+{
+  if (Offset < m_position)
+    return false;
+
+  return SeekRelative((int64)(Offset - m_position));
+}
+
+bool CompressionByteStream::SeekRelative(int64 Offset)
+{
+  if (Offset == 0)
+    return !m_errorState;
+
+  if (m_compressing || Offset < 0)
+    return false;
+
+  // read and drop what's skipped
+  byte skipBuffer[4096];
+  uint64 remaining = (uint64)Offset;
+  while (remaining > 0)
+  {
+    uint32 count = (uint32)Min(remaining, (uint64)sizeof(skipBuffer));
+    if (Read(skipBuffer, count) != count)
+      return false;
+
+    remaining -= count;
+  }
+
+  return true;
+}
+
+bool CompressionByteStream::SeekToEnd()
+{
+  if (m_compressing)
+    return !m_errorState;
+
+  byte skipBuffer[4096];
+  while (!m_endOfStream && !m_errorState)
+    Read(skipBuffer, sizeof(skipBuffer));
+
+  return !m_errorState;
+}
+
+bool CompressionByteStream::Flush()
+{
+  if (!m_compressing)
+    return !m_errorState;
+
+  if (m_errorState || (!m_finished && !CompressPending(nullptr, 0, FLUSH_SYNC)))
+    return false;
+
+  return m_pStream->Flush();
+}
+
+bool CompressionByteStream::Discard()
+{
+  // nothing more is written, the wrapped stream decides what happens to what already was
+  m_finished = true;
+  m_bufferEnd = 0;
+  return m_pStream->Discard();
+}
+
+bool CompressionByteStream::Commit()
+{
+  if (m_compressing && !Finish())
+    return false;
+
+  return m_pStream->Commit();
+}
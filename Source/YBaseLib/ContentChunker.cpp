@@ -0,0 +1,175 @@
+#include "YBaseLib/ContentChunker.h"
+#include "YBaseLib/ByteStream.h"
+#include <cstring>
+
+// Random values for each byte, from splitmix64 seeded with 0. These can never change, since boundaries found with them
+// are stored in indexes.
+static const uint64 s_gearTable[256] = {
+  0xE220A8397B1DCDAFULL, 0x6E789E6AA1B965F4ULL, 0x06C45D188009454FULL, 0xF88BB8A8724C81ECULL, 0x1B39896A51A8749BULL,
+  0x53CB9F0C747EA2EAULL, 0x2C829ABE1F4532E1ULL, 0xC584133AC916AB3CULL, 0x3EE5789041C98AC3ULL, 0xF3B8488C368CB0A6ULL,
+  0x657EECDD3CB13D09ULL, 0xC2D326E0055BDEF6ULL, 0x8621A03FE0BBDB7BULL, 0x8E1F7555983AA92FULL, 0xB54E0F1600CC4D19ULL,
+  0x84BB3F97971D80ABULL, 0x7D29825C75521255ULL, 0xC3CF17102B7F7F86ULL, 0x3466E9A083914F64ULL, 0xD81A8D2B5A4485ACULL,
+  0xDB01602B100B9ED7ULL, 0xA9038A921825F10DULL, 0xEDF5F1D90DCA2F6AULL, 0x54496AD67BD2634CULL, 0xDD7C01D4F5407269ULL,
+  0x935E82F1DB4C4F7BULL, 0x69B82EBC92233300ULL, 0x40D29EB57DE1D510ULL, 0xA2F09DABB45C6316ULL, 0xEE521D7A0F4D3872ULL,
+  0xF16952EE72F3454FULL, 0x377D35DEA8E40225ULL, 0x0C7DE8064963BAB0ULL, 0x05582D37111AC529ULL, 0xD254741F599DC6F7ULL,
+  0x69630F7593D108C3ULL, 0x417EF96181DAA383ULL, 0x3C3C41A3B43343A1ULL, 0x6E19905DCBE531DFULL, 0x4FA9FA7324851729ULL,
+  0x84EB4454A792922AULL, 0x134F7096918175CEULL, 0x07DC930B302278A8ULL, 0x12C015A97019E937ULL, 0xCC06C31652EBF438ULL,
+  0xECEE65630A691E37ULL, 0x3E84ECB1763E79ADULL, 0x690ED476743AAE49ULL, 0x774615D7B1A1F2E1ULL, 0x22B353F04F4F52DAULL,
+  0xE3DDD86BA71A5EB1ULL, 0xDF268ADEB6513356ULL, 0x2098EB73D4367D77ULL, 0x03D6845323CE3C71ULL, 0xC952C5620043C714ULL,
+  0x9B196BCA844F1705ULL, 0x30260345DD9E0EC1ULL, 0xCF448A5882BB9698ULL, 0xF4A578DCCBC87656ULL, 0xBFDEAED9A17B3C8FULL,
+  0xED79402D1D5C5D7BULL, 0x55F070AB1CBBF170ULL, 0x3E00A34929A88F1DULL, 0xE255B237B8BB18FBULL, 0x2A7B67AF6C6AD50EULL,
+  0x466D5E7F3E46F143ULL, 0x42375CB399A4FC72ULL, 0x8C8A1F148A8BB259ULL, 0x32FCAB5DAED5BDFCULL, 0x9E60398C8D8553C0ULL,
+  0xEE89CCEB8C4064C0ULL, 0xDB0215941D86A66FULL, 0x5CCDE78203C367A8ULL, 0xF1BCBC6A1EC11786ULL, 0xEF054FCEEE954551ULL,
+  0xDF82012D0555C6DFULL, 0x292566FF72403C08ULL, 0xC4DD302A1BFA1137ULL, 0xD85F219DB5C554E1ULL, 0x6A27FF807441BCD2ULL,
+  0x96A573E9B48216E8ULL, 0x46A9FDAC40BF0048ULL, 0x3DD12464A0EE15B4ULL, 0x451E521296A7EEA1ULL, 0x56E4398A98F8A0FDULL,
+  0x7B7DC2160E3335A7ULL, 0xC679EE0BEBCB1CCAULL, 0x928D6F2D7453424EULL, 0x1B38994205234C6DULL, 0x8086D193A6F2B568ULL,
+  0x21C6E26639AC2C65ULL, 0xD9DCCAC414D23C6FULL, 0x91CD642057E00235ULL, 0x77FC607DC6589373ULL, 0x05B8ABE26DD3AEE7ULL,
+  0x12F6436AC376CC66ULL, 0x64952424897B2307ULL, 0xEE8C2BAF6343E5C3ULL, 0xDC4C613D9EBA2304ULL, 0x3505B7796BD1A506ULL,
+  0x8176DAF800A05F50ULL, 0x8BD8FF7A0385CDBCULL, 0x1A764A3CD78101DAULL, 0xBE4D15BF6CA266ACULL, 0xA85E1F38BB2DC749ULL,
+  0x56759A968493CD8CULL, 0xF3A9BCE7336BD182ULL, 0x365B15013741519BULL, 0x1F7A44A6B109AC94ULL, 0x3521D628813CB177ULL,
+  0x6A77AFAB0F7C9370ULL, 0x179642D8CDE95015ULL, 0x5EF102A8FB354461ULL, 0xF51C504764ED82F2ULL, 0xC58427F041CE6808ULL,
+  0xFAD8FC45C9643C37ULL, 0xCF8682F9A70FA9C0ULL, 0x7E1B3B75A4005729ULL, 0x992DD867927B52D8ULL, 0x7FBD5DB142F6791FULL,
+  0x370595AACAB4ADAEULL, 0xB1392DBDC5AB61D6ULL, 0x9FEA7DFC79D452D9ULL, 0x40B12B120085641CULL, 0xA192AFE3157C85D0ULL,
+  0xC847729F4E08F3A3ULL, 0x6F1384A306C41FC2ULL, 0x12D05C4045A39C19ULL, 0x9899202FD20F0841ULL, 0xE9C7191857E774B8ULL,
+  0x4EEAD809AF5B0CC3ULL, 0xE809ACAFA23864A4ULL, 0x4DA1EDABA1D0F7BDULL, 0x846EB9673349F8E4ULL, 0x87BAE55B86039FE8ULL,
+  0x7F367B8BD953EFF2ULL, 0x3884700F650D04E1ULL, 0xBFE4B2AB46980CADULL, 0xC5FC89075299106CULL, 0x37B2FA361ADEA7CDULL,
+  0x7D75D813F04895B4ULL, 0x702F5B393F62C0E0ULL, 0x0A3FC775F4ECF37FULL, 0xE4B23787A352437FULL, 0xF83FA245C34D6363ULL,
+  0xB99BCF040786CF50ULL, 0x38B6EA0A0E6C9D8AULL, 0x093FDC76776E37E1ULL, 0x1A75E6F76BA7EEE8ULL, 0x442CDCFEE9660C62ULL,
+  0x22D58D35116B5E0BULL, 0x87D4A5180F6A3645ULL, 0x589FB216BD82131BULL, 0x91D031CAD319AEC0ULL, 0xABECF76A553D320BULL,
+  0xB8686CB347612DCFULL, 0xFCAB66337C0A77F5ULL, 0xAC318214381EC437ULL, 0x6EB7F0FCA24494AEULL, 0xCF42861DCDC895A9ULL,
+  0x4ABAD7A1586D7A91ULL, 0xC21B318DC2F49745ULL, 0xD49474DC2ACBD1F0ULL, 0xB1D4873747C1C8E1ULL, 0x5434DC8C7D015BF6ULL,
+  0xE1C486287511B6A9ULL, 0xA8616DF62E89A193ULL, 0x31CE6319498D8347ULL, 0xAFD0B486123D6FAAULL, 0xE6495F5D102301EBULL,
+  0x0DC51CED17A43C52ULL, 0x8BCBCDE81355EF2DULL, 0x2412AF73FDEE7CFCULL, 0xC8D589E486E29EEDULL, 0x23390E8664517F89ULL,
+  0x251ADE58E8A6849DULL, 0xF8555DBD2E8F9CB0ULL, 0xCB417C3EEF54F7C3ULL, 0x8028F8E1AAC3A919ULL, 0x10E31052ACF748A0ULL,
+  0x2D886C073B1E1B78ULL, 0x972974D90DF9FAEEULL, 0xBC1B7B38796893BAULL, 0x1958ED432070E652ULL, 0xCA5F297197A12DCCULL,
+  0xE025A27375704F28ULL, 0x418010A570A924FBULL, 0x9828E2941BFC419CULL, 0x4FBACD2F52B85C1FULL, 0x33DD5B756211CC67ULL,
+  0x23C8DFDD1DB57FF0ULL, 0x32F81801A1A8E901ULL, 0x26884EAC5ADA36DAULL, 0xCAA82F9BB42E37D4ULL, 0x19FB1A7491D6A7D1ULL,
+  0x5AA0243AA357F38EULL, 0xB31D917809E447F0ULL, 0x3F9C197225215BE0ULL, 0xDC3C315A1E33C095ULL, 0x3DD399AD533E80ACULL,
+  0x566F32CCE8301D95ULL, 0xC880188083D9BA21ULL, 0xB9CC357F3B0E7D2EULL, 0x0237D2123A8A8D6CULL, 0xBF636E9AA7CBF6BDULL,
+  0xD7BD4284C4E2A6A7ULL, 0xDA2EBB47D50577A9ULL, 0x90BA1C11B539087DULL, 0x44993D31552B4F57ULL, 0x32C2D6F80A8A8898ULL,
+  0x450583ED7FB54B19ULL, 0xEC2B0B09E50EF3EFULL, 0xD918A0B6E2EFD65CULL, 0xE37A868D9785F572ULL, 0x7D1A6118F2B0F37AULL,
+  0x9E2E3CC13B343439ULL, 0xEFD82C11212E37E8ULL, 0xAF89C05CD4FC75EDULL, 0x55BC16BB9697108EULL, 0x6C4701FA5DB69BEEULL,
+  0x9237338441DAF445ULL, 0x248CF0831E81A5FCULL, 0xACC13557E77DE273ULL, 0x520970C25E06513AULL, 0x657329CB02987CABULL,
+  0xA9B0B3366A4E55A8ULL, 0xC4D06CA2F39ACDD4ULL, 0x5DCE37D68170CDE1ULL, 0x5F1E44E77E1854C9ULL, 0x6883D452D55DF899ULL,
+  0x05C5BD62F1067032ULL, 0xE680B683CE60FAB0ULL, 0x5DC9DA3F286D18B1ULL, 0x94B4BF3AB85ED6D8ULL, 0xCE65F449E3ACC5A3ULL,
+  0x34B0209642CEA639ULL, 0xC14C3C771D904827ULL, 0x6ADDCEE2BD9CDEE5ULL, 0xE24EED137FFBB613ULL, 0x75DD58EF79963D1BULL,
+  0xFDB83ECF6CC24920ULL, 0x7A1D0057C57169FBULL, 0x339200F4FEB62D07ULL, 0xD33F4D4AC88469F4ULL, 0x8226F234E68DFEE4ULL,
+  0x320DEF4F2A105536ULL, 0x7786F3B13AEFC159ULL, 0xB28225AC9DF63EE2ULL, 0x781B9D0376CC6044ULL, 0x05BD0115226C6AB6ULL,
+  0xD302230207BDFDABULL, 0xDB898ABD8E0D2933ULL, 0x9E79A397BA00B9CCULL, 0x89DF84A5F0003EE8ULL, 0x011F04F2A75FB9BEULL,
+  0x5A5832BB47BCF19EULL
+};
+
+bool CHUNK_DIGEST::operator==(const CHUNK_DIGEST& rhs) const
+{
+  return (std::memcmp(Bytes, rhs.Bytes, sizeof(Bytes)) == 0);
+}
+
+// a mask of the top bitCount bits, which depend on the most recent bytes hashed
+static uint64 MakeTopBitsMask(uint32 bitCount)
+{
+  return (bitCount == 0) ? 0 : (~(uint64)0 << (64 - bitCount));
+}
+
+ContentChunker::ContentChunker(uint32 minimumSize /* = 2048 */, uint32 averageSize /* = 8192 */,
+                               uint32 maximumSize /* = 65536 */)
+{
+  uint32 averageBits = 8;
+  while (averageBits < 26 && (1u << (averageBits + 1)) <= averageSize)
+    averageBits++;
+
+  m_averageSize = 1u << averageBits;
+  m_minimumSize = Max(Min(minimumSize, m_averageSize / 2), 64u);
+  m_maximumSize = Max(maximumSize, m_averageSize * 2);
+  m_smallMask = MakeTopBitsMask(averageBits + 1);
+  m_largeMask = MakeTopBitsMask(averageBits - 1);
+}
+
+uint32 ContentChunker::FindBoundary(const void* pData, size_t length, bool endOfData) const
+{
+  const byte* pBytes = reinterpret_cast<const byte*>(pData);
+  uint32 searchLength = (uint32)Min(length, (size_t)m_maximumSize);
+  if (searchLength <= m_minimumSize)
+    return (endOfData || length >= m_maximumSize) ? searchLength : 0;
+
+  // nothing before the minimum size can be a boundary, so hashing starts there
+  uint64 hash = 0;
+  uint32 normalLength = Min(searchLength, m_averageSize);
+  uint32 i = m_minimumSize;
+  for (; i < normalLength; i++)
+  {
+    hash = (hash << 1) + s_gearTable[pBytes[i]];
+    if ((hash & m_smallMask) == 0)
+      return i + 1;
+  }
+  for (; i < searchLength; i++)
+  {
+    hash = (hash << 1) + s_gearTable[pBytes[i]];
+    if ((hash & m_largeMask) == 0)
+      return i + 1;
+  }
+
+  return (endOfData || searchLength == m_maximumSize) ? searchLength : 0;
+}
+
+static void AddChunk(const byte* pBytes, uint64 offset, uint32 size, PODArray<CONTENT_CHUNK>* pChunks)
+{
+  CONTENT_CHUNK chunk;
+  chunk.Offset = offset;
+  chunk.Size = size;
+
+  SHA256Digest digest;
+  digest.Update(pBytes, size);
+  digest.Final(chunk.Digest.Bytes);
+  pChunks->Add(chunk);
+}
+
+void ContentChunker::ChunkBuffer(const void* pData, size_t length, PODArray<CONTENT_CHUNK>* pChunks) const
+{
+  const byte* pBytes = reinterpret_cast<const byte*>(pData);
+  size_t offset = 0;
+  while (offset < length)
+  {
+    uint32 chunkSize = FindBoundary(pBytes + offset, length - offset, true);
+    AddChunk(pBytes + offset, offset, chunkSize, pChunks);
+    offset += chunkSize;
+  }
+}
+
+bool ContentChunker::ChunkStream(ByteStream* pStream, uint64 count, PODArray<CONTENT_CHUNK>* pChunks) const
+{
+  // twice the maximum size, so every refill makes room for at least one whole chunk
+  PODArray<byte> buffer;
+  buffer.Resize(m_maximumSize * 2);
+
+  uint64 offset = 0;
+  uint32 bufferStart = 0;
+  uint32 bufferEnd = 0;
+  while (count > 0 || bufferStart < bufferEnd)
+  {
+    if (count > 0 && bufferEnd - bufferStart < m_maximumSize)
+    {
+      if (bufferStart > 0)
+      {
+        std::memmove(buffer.GetBasePointer(), buffer.GetBasePointer() + bufferStart, bufferEnd - bufferStart);
+        bufferEnd -= bufferStart;
+        bufferStart = 0;
+      }
+
+      uint32 readCount = (uint32)Min(count, (uint64)(buffer.GetSize() - bufferEnd));
+      if (!pStream->Read2(buffer.GetBasePointer() + bufferEnd, readCount))
+        return false;
+
+      bufferEnd += readCount;
+      count -= readCount;
+    }
+
+    uint32 chunkSize =
+      FindBoundary(buffer.GetBasePointer() + bufferStart, bufferEnd - bufferStart, (count == 0));
+    DebugAssert(chunkSize > 0);
+    AddChunk(buffer.GetBasePointer() + bufferStart, offset, chunkSize, pChunks);
+    bufferStart += chunkSize;
+    offset += chunkSize;
+  }
+
+  return true;
+}
@@ -0,0 +1,184 @@
+#include "YBaseLib/CuckooFilter.h"
+#include "YBaseLib/HashTrait.h"
+#include "YBaseLib/Memory.h"
+
+// fingerprints moved to make room before giving up on an Add
+static const uint32 MaxKicks = 500;
+
+static const uint64 LaneOnes = 0x0001000100010001ULL;
+static const uint64 LaneHighBits = 0x8000800080008000ULL;
+
+static uint16 GetSlot(uint64 bucket, uint32 slot)
+{
+  return static_cast<uint16>(bucket >> (slot * 16));
+}
+
+static uint64 SetSlot(uint64 bucket, uint32 slot, uint16 fingerprint)
+{
+  uint32 shift = slot * 16;
+  return (bucket & ~(static_cast<uint64>(0xFFFF) << shift)) | (static_cast<uint64>(fingerprint) << shift);
+}
+
+// Whether any of the four fingerprints in the bucket is this one: the lanes holding it are zero after the xor, and
+// a lane is zero exactly when subtracting one borrows into a top bit it didn't have.
+static bool BucketHasFingerprint(uint64 bucket, uint16 fingerprint)
+{
+  uint64 difference = bucket ^ (fingerprint * LaneOnes);
+  return (((difference - LaneOnes) & ~difference & LaneHighBits) != 0);
+}
+
+CuckooFilter::CuckooFilter() : m_pBuckets(nullptr), m_bucketCount(0), m_count(0), m_randomState(1) {}
+
+CuckooFilter::~CuckooFilter()
+{
+  Y_free(m_pBuckets);
+}
+
+void CuckooFilter::Reset(uint32 capacity)
+{
+  // the bucket count is a power of two so the alternate bucket is an xor, filled to at most 95%
+  uint64 neededBuckets = (static_cast<uint64>(capacity) * 100 / 95 + SlotsPerBucket - 1) / SlotsPerBucket;
+  uint32 bucketCount = 2;
+  while (bucketCount < neededBuckets && bucketCount < 0x80000000)
+    bucketCount *= 2;
+
+  if (bucketCount != m_bucketCount)
+  {
+    Y_free(m_pBuckets);
+    m_pBuckets = static_cast<uint64*>(Y_malloc(sizeof(uint64) * bucketCount));
+    m_bucketCount = bucketCount;
+  }
+
+  Clear();
+}
+
+void CuckooFilter::Clear()
+{
+  if (m_bucketCount > 0)
+    Y_memzero(m_pBuckets, sizeof(uint64) * m_bucketCount);
+
+  m_count = 0;
+}
+
+void CuckooFilter::GetPosition(uint64 hash, uint16* pFingerprint, uint32* pFirstBucket, uint32* pSecondBucket) const
+{
+  uint64 mixed = Y_HashFinalize64(hash);
+  uint16 fingerprint = static_cast<uint16>(mixed);
+  if (fingerprint == 0)
+    fingerprint = 1;
+
+  *pFingerprint = fingerprint;
+  *pFirstBucket = static_cast<uint32>(mixed >> 32) & (m_bucketCount - 1);
+  *pSecondBucket = GetAlternateBucket(*pFirstBucket, fingerprint);
+}
+
+// its own inverse, so either bucket leads to the other
+uint32 CuckooFilter::GetAlternateBucket(uint32 bucket, uint16 fingerprint) const
+{
+  return (bucket ^ (fingerprint * 0x5BD1E995U)) & (m_bucketCount - 1);
+}
+
+bool CuckooFilter::AddToBucket(uint32 bucket, uint16 fingerprint)
+{
+  for (uint32 slot = 0; slot < SlotsPerBucket; slot++)
+  {
+    if (GetSlot(m_pBuckets[bucket], slot) == 0)
+    {
+      m_pBuckets[bucket] = SetSlot(m_pBuckets[bucket], slot, fingerprint);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool CuckooFilter::RemoveFromBucket(uint32 bucket, uint16 fingerprint)
+{
+  for (uint32 slot = 0; slot < SlotsPerBucket; slot++)
+  {
+    if (GetSlot(m_pBuckets[bucket], slot) == fingerprint)
+    {
+      m_pBuckets[bucket] = SetSlot(m_pBuckets[bucket], slot, 0);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool CuckooFilter::Add(uint64 hash)
+{
+  if (m_bucketCount == 0)
+    return false;
+
+  uint16 fingerprint;
+  uint32 firstBucket, secondBucket;
+  GetPosition(hash, &fingerprint, &firstBucket, &secondBucket);
+  if (AddToBucket(firstBucket, fingerprint) || AddToBucket(secondBucket, fingerprint))
+  {
+    m_count++;
+    return true;
+  }
+
+  // Both are full, so swap it for a random one of the second bucket's and try that one's other bucket, and so on.
+  // The swaps are remembered so they can be undone if no room turns up.
+  uint32 kickedBuckets[MaxKicks];
+  uint8 kickedSlots[MaxKicks];
+  uint32 bucket = secondBucket;
+  for (uint32 kick = 0; kick < MaxKicks; kick++)
+  {
+    m_randomState = m_randomState * 1664525 + 1013904223;
+    uint32 slot = (m_randomState >> 16) % SlotsPerBucket;
+    kickedBuckets[kick] = bucket;
+    kickedSlots[kick] = static_cast<uint8>(slot);
+
+    uint16 kicked = GetSlot(m_pBuckets[bucket], slot);
+    m_pBuckets[bucket] = SetSlot(m_pBuckets[bucket], slot, fingerprint);
+    fingerprint = kicked;
+
+    bucket = GetAlternateBucket(bucket, fingerprint);
+    if (AddToBucket(bucket, fingerprint))
+    {
+      m_count++;
+      return true;
+    }
+  }
+
+  // put everything back where it was, ending with the new fingerprint in hand again
+  for (uint32 kick = MaxKicks; kick > 0; kick--)
+  {
+    uint32 undoBucket = kickedBuckets[kick - 1];
+    uint16 placed = GetSlot(m_pBuckets[undoBucket], kickedSlots[kick - 1]);
+    m_pBuckets[undoBucket] = SetSlot(m_pBuckets[undoBucket], kickedSlots[kick - 1], fingerprint);
+    fingerprint = placed;
+  }
+
+  return false;
+}
+
+bool CuckooFilter::Remove(uint64 hash)
+{
+  if (m_bucketCount == 0)
+    return false;
+
+  uint16 fingerprint;
+  uint32 firstBucket, secondBucket;
+  GetPosition(hash, &fingerprint, &firstBucket, &secondBucket);
+  if (!RemoveFromBucket(firstBucket, fingerprint) && !RemoveFromBucket(secondBucket, fingerprint))
+    return false;
+
+  m_count--;
+  return true;
+}
+
+bool CuckooFilter::MayContain(uint64 hash) const
+{
+  if (m_bucketCount == 0)
+    return true;
+
+  uint16 fingerprint;
+  uint32 firstBucket, secondBucket;
+  GetPosition(hash, &fingerprint, &firstBucket, &secondBucket);
+  return (BucketHasFingerprint(m_pBuckets[firstBucket], fingerprint) ||
+          BucketHasFingerprint(m_pBuckets[secondBucket], fingerprint));
+}
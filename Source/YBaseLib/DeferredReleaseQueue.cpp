@@ -0,0 +1,39 @@
+#include "YBaseLib/DeferredReleaseQueue.h"
+#include "YBaseLib/MutexLock.h"
+
+DeferredReleaseQueue::~DeferredReleaseQueue()
+{
+  Flush();
+}
+
+uint32 DeferredReleaseQueue::Release(const ReferenceCounted* pObject)
+{
+  ScopedLock<SpinLock> lock(m_pendingLock);
+  if (pObject != nullptr)
+    m_pending.Add(pObject);
+
+  return m_pending.GetSize();
+}
+
+uint32 DeferredReleaseQueue::Flush()
+{
+  MutexLock flushLock(m_flushLock);
+  {
+    ScopedLock<SpinLock> lock(m_pendingLock);
+    m_pending.Swap(m_flushing);
+  }
+
+  // destructors run outside the spin lock, and may queue further releases
+  uint32 count = m_flushing.GetSize();
+  for (uint32 i = 0; i < count; i++)
+    m_flushing[i]->Release();
+
+  m_flushing.Clear();
+  return count;
+}
+
+uint32 DeferredReleaseQueue::GetPendingCount() const
+{
+  ScopedLock<SpinLock> lock(m_pendingLock);
+  return m_pending.GetSize();
+}
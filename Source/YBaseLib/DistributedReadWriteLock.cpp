@@ -0,0 +1,123 @@
+#include "YBaseLib/DistributedReadWriteLock.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/CacheAligned.h"
+#include "YBaseLib/CPUID.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/SpinLock.h"
+
+static uint32 GetDefaultSlotCount()
+{
+  Y_CPUID_RESULT cpuidResult;
+  Y_ReadCPUID(&cpuidResult);
+
+  uint32 slotCount = 1;
+  while (slotCount < cpuidResult.ThreadCount && slotCount < DistributedReadWriteLock::MaxSlotCount)
+    slotCount *= 2;
+
+  return slotCount;
+}
+
+DistributedReadWriteLock::DistributedReadWriteLock(uint32 slotCount /* = 0 */) : m_writerActive(0)
+{
+  if (slotCount == 0)
+  {
+    static const uint32 defaultSlotCount = GetDefaultSlotCount();
+    slotCount = defaultSlotCount;
+  }
+
+  DebugAssert(slotCount <= MaxSlotCount && (slotCount & (slotCount - 1)) == 0);
+  m_pSlots = static_cast<ReaderSlot*>(Y_aligned_malloczero(sizeof(ReaderSlot) * slotCount, Y_CACHE_LINE_SIZE));
+  m_slotMask = slotCount - 1;
+}
+
+DistributedReadWriteLock::~DistributedReadWriteLock()
+{
+  Y_aligned_free(m_pSlots);
+}
+
+DistributedReadWriteLock::ReaderSlot* DistributedReadWriteLock::GetReaderSlot() const
+{
+  // up to the slot count of threads never share a counter
+  return &m_pSlots[Y_GetThreadShardIndex() & m_slotMask];
+}
+
+bool DistributedReadWriteLock::TryEnterShared(ReaderSlot* pSlot)
+{
+  // The reader counts itself before looking for a writer, and the writer raises its flag before looking for
+  // readers, both seq_cst, so at least one of them sees the other.
+  Y_AtomicIncrement(pSlot->Count);
+  if (Y_AtomicLoad(m_writerActive) == 0)
+    return true;
+
+  Y_AtomicDecrement(pSlot->Count, ATOMIC_MEMORY_ORDER_RELEASE);
+  return false;
+}
+
+void DistributedReadWriteLock::LockShared()
+{
+  ReaderSlot* pSlot = GetReaderSlot();
+  while (!TryEnterShared(pSlot))
+  {
+    // sleep until the writer's done rather than spin against it
+    m_writerLock.Lock();
+    m_writerLock.Unlock();
+  }
+}
+
+bool DistributedReadWriteLock::TryLockShared()
+{
+  return TryEnterShared(GetReaderSlot());
+}
+
+void DistributedReadWriteLock::UnlockShared()
+{
+  ReaderSlot* pSlot = GetReaderSlot();
+  DebugAssert(pSlot->Count > 0);
+  Y_AtomicDecrement(pSlot->Count, ATOMIC_MEMORY_ORDER_RELEASE);
+}
+
+void DistributedReadWriteLock::LockExclusive()
+{
+  m_writerLock.Lock();
+  Y_AtomicStore(m_writerActive, int32(1));
+
+  // readers can only leave now, each counter drains by itself
+  for (uint32 i = 0; i <= m_slotMask; i++)
+  {
+    SpinBackoff backoff;
+    while (Y_AtomicLoad(m_pSlots[i].Count, ATOMIC_MEMORY_ORDER_ACQUIRE) != 0)
+      backoff.PauseOrYield();
+  }
+}
+
+bool DistributedReadWriteLock::TryLockExclusive()
+{
+  if (!m_writerLock.TryLock())
+    return false;
+
+  Y_AtomicStore(m_writerActive, int32(1));
+  for (uint32 i = 0; i <= m_slotMask; i++)
+  {
+    if (Y_AtomicLoad(m_pSlots[i].Count, ATOMIC_MEMORY_ORDER_ACQUIRE) != 0)
+    {
+      Y_AtomicStore(m_writerActive, int32(0), ATOMIC_MEMORY_ORDER_RELEASE);
+      m_writerLock.Unlock();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void DistributedReadWriteLock::UnlockExclusive()
+{
+  Y_AtomicStore(m_writerActive, int32(0), ATOMIC_MEMORY_ORDER_RELEASE);
+  m_writerLock.Unlock();
+}
+
+void DistributedReadWriteLock::UpgradeSharedLockToExclusive()
+{
+  // as with ReadWriteLock, another writer can get in between, so anything read under the shared lock needs checking
+  UnlockShared();
+  LockExclusive();
+}
@@ -1,4 +1,22 @@
 #include "YBaseLib/Endian.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/CPUID.h"
+#include <cstring>
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <immintrin.h>
+#define Y_ENDIAN_SSE2 1
+#define Y_ENDIAN_AVX2 1
+#if defined(Y_COMPILER_MSVC)
+#include <intrin.h>
+#define ENDIAN_AVX2_FUNCTION
+#else
+#define ENDIAN_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_ENDIAN_NEON 1
+#endif
 
 #define IS_HOST_ENDIAN_TYPE(x) ((x) == Y_HOST_ENDIAN_TYPE)
 
@@ -14,8 +32,9 @@
 #define flip32(x) (((x) >> 24) | ((((x) >> 16) & 0xff) << 8) | ((((x) >> 8) & 0xff) << 16) | (((x)&0xff) << 24))
 
 #define flip64(x)                                                                                                      \
-  (((x) >> 56) | ((((x) >> 48) & 0xffULL) << 8) | ((((x) >> 40) & 0xffULL) << 16) | ((((x) >> 32) & 0xffULL) << 32) |  \
-   ((((x) >> 16) & 0xffULL) << 40) | ((((x) >> 8) & 0xffULL) << 48) | (((x)&0xffULL) << 56))
+  (((x) >> 56) | ((((x) >> 48) & 0xffULL) << 8) | ((((x) >> 40) & 0xffULL) << 16) | ((((x) >> 32) & 0xffULL) << 24) |  \
+   ((((x) >> 24) & 0xffULL) << 32) | ((((x) >> 16) & 0xffULL) << 40) | ((((x) >> 8) & 0xffULL) << 48) |                \
+   (((x)&0xffULL) << 56))
 
 #endif
 
@@ -94,3 +113,150 @@ void Y_byteswap_uint64(uint64* uValue)
 {
   *uValue = flip64(*uValue);
 }
+
+#if Y_ENDIAN_SSE2
+
+// SSE2 has no byte shuffle, so 16-bit lanes are swapped with shifts, after reordering the lanes for wider values
+static inline __m128i SwapBytesInWords(__m128i value)
+{
+  return _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+}
+
+static inline __m128i SwapVector(__m128i value, uint32 elementSize)
+{
+  if (elementSize == 4)
+  {
+    value = _mm_shufflelo_epi16(value, _MM_SHUFFLE(2, 3, 0, 1));
+    value = _mm_shufflehi_epi16(value, _MM_SHUFFLE(2, 3, 0, 1));
+  }
+  else if (elementSize == 8)
+  {
+    value = _mm_shufflelo_epi16(value, _MM_SHUFFLE(0, 1, 2, 3));
+    value = _mm_shufflehi_epi16(value, _MM_SHUFFLE(0, 1, 2, 3));
+  }
+
+  return SwapBytesInWords(value);
+}
+
+#endif
+
+#if Y_ENDIAN_AVX2
+
+// pshufb reverses any element size in one instruction, 32 bytes at a time. Returns the bytes it did.
+template<uint32 SIZE>
+static ENDIAN_AVX2_FUNCTION size_t SwapArrayAVX2(byte* pDestination, const byte* pSource, size_t byteCount)
+{
+  const __m256i shuffle =
+    (SIZE == 2) ? _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8,
+                                   11, 10, 13, 12, 15, 14) :
+    (SIZE == 4) ? _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10,
+                                   9, 8, 15, 14, 13, 12) :
+                  _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14,
+                                   13, 12, 11, 10, 9, 8);
+
+  size_t i = 0;
+  for (; i + 32 <= byteCount; i += 32)
+  {
+    __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDestination + i), _mm256_shuffle_epi8(value, shuffle));
+  }
+
+  return i;
+}
+
+// false until static initialization gets here, anything called before that uses SSE2
+static const bool s_useAVX2 = Y_CPUHasFeatures(Y_CPU_FEATURE_AVX2);
+
+#endif
+
+// Source and destination are the same for swapping in place, otherwise they mustn't overlap.
+template<uint32 SIZE>
+static void SwapArray(byte* pDestination, const byte* pSource, size_t count)
+{
+  size_t byteCount = count * SIZE;
+  size_t i = 0;
+
+#if Y_ENDIAN_SSE2
+#if Y_ENDIAN_AVX2
+  if (s_useAVX2)
+    i = SwapArrayAVX2<SIZE>(pDestination, pSource, byteCount);
+#endif
+  for (; i + 16 <= byteCount; i += 16)
+  {
+    __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + i), SwapVector(value, SIZE));
+  }
+#elif Y_ENDIAN_NEON
+  for (; i + 16 <= byteCount; i += 16)
+  {
+    uint8x16_t value = vld1q_u8(pSource + i);
+    if (SIZE == 2)
+      value = vrev16q_u8(value);
+    else if (SIZE == 4)
+      value = vrev32q_u8(value);
+    else
+      value = vrev64q_u8(value);
+    vst1q_u8(pDestination + i, value);
+  }
+#endif
+
+  // whatever is left, through the scalar swaps. memcpy because the values may not be aligned.
+  for (; i < byteCount; i += SIZE)
+  {
+    if (SIZE == 2)
+    {
+      uint16 value;
+      std::memcpy(&value, pSource + i, sizeof(value));
+      value = flip16(value);
+      std::memcpy(pDestination + i, &value, sizeof(value));
+    }
+    else if (SIZE == 4)
+    {
+      uint32 value;
+      std::memcpy(&value, pSource + i, sizeof(value));
+      value = flip32(value);
+      std::memcpy(pDestination + i, &value, sizeof(value));
+    }
+    else
+    {
+      uint64 value;
+      std::memcpy(&value, pSource + i, sizeof(value));
+      value = flip64(value);
+      std::memcpy(pDestination + i, &value, sizeof(value));
+    }
+  }
+}
+
+void Y_byteswap_array(void* pValues, size_t count, uint32 elementSize)
+{
+  Y_byteswap_array_copy(pValues, pValues, count, elementSize);
+}
+
+void Y_byteswap_array_copy(void* pDestination, const void* pSource, size_t count, uint32 elementSize)
+{
+  byte* pDestinationBytes = reinterpret_cast<byte*>(pDestination);
+  const byte* pSourceBytes = reinterpret_cast<const byte*>(pSource);
+  switch (elementSize)
+  {
+    case 1:
+      if (pDestination != pSource)
+        std::memcpy(pDestination, pSource, count);
+      break;
+
+    case 2:
+      SwapArray<2>(pDestinationBytes, pSourceBytes, count);
+      break;
+
+    case 4:
+      SwapArray<4>(pDestinationBytes, pSourceBytes, count);
+      break;
+
+    case 8:
+      SwapArray<8>(pDestinationBytes, pSourceBytes, count);
+      break;
+
+    default:
+      Panic("Y_byteswap_array_copy: unsupported element size");
+      break;
+  }
+}
@@ -0,0 +1,119 @@
+#include "YBaseLib/EpochManager.h"
+
+// a node retired at one epoch is unreachable once the global epoch has advanced twice past it
+static const uint32 EPOCH_STEP = 2;
+static const uint32 RECLAIM_DISTANCE = EPOCH_STEP * 2;
+
+EpochManager::EpochManager() : m_globalEpoch(0), m_pRecords(nullptr) {}
+
+EpochManager::~EpochManager()
+{
+  ThreadRecord* pRecord = m_pRecords;
+  while (pRecord != nullptr)
+  {
+    DebugAssert(pRecord->Nesting == 0);
+    for (uint32 i = 0; i < countof(pRecord->RetireLists); i++)
+      ReclaimList(pRecord, pRecord->RetireLists[i]);
+
+    ThreadRecord* pNext = pRecord->pNext;
+    delete pRecord;
+    pRecord = pNext;
+  }
+}
+
+EpochManager::ThreadRecord* EpochManager::RegisterThread()
+{
+  for (ThreadRecord* pRecord = Y_AtomicLoadAcquire(m_pRecords); pRecord != nullptr; pRecord = pRecord->pNext)
+  {
+    uint32 inUse = 0;
+    if (Y_AtomicLoad(pRecord->InUse, ATOMIC_MEMORY_ORDER_RELAXED) == 0 &&
+        Y_AtomicTryCompareExchange(pRecord->InUse, inUse, uint32(1), ATOMIC_MEMORY_ORDER_ACQUIRE))
+    {
+      return pRecord;
+    }
+  }
+
+  ThreadRecord* pRecord = new ThreadRecord();
+  pRecord->LocalEpoch = 0;
+  pRecord->InUse = 1;
+  pRecord->Nesting = 0;
+  pRecord->RetiredCount = 0;
+  for (uint32 i = 0; i < countof(pRecord->RetireLists); i++)
+    pRecord->RetireLists[i].Epoch = 0;
+
+  ThreadRecord* pHead = Y_AtomicLoadAcquire(m_pRecords);
+  for (;;)
+  {
+    pRecord->pNext = pHead;
+    ThreadRecord* pOldHead = Y_AtomicCompareExchangePointer(m_pRecords, pRecord, pHead);
+    if (pOldHead == pHead)
+      return pRecord;
+
+    pHead = pOldHead;
+  }
+}
+
+void EpochManager::UnregisterThread(ThreadRecord* pRecord)
+{
+  DebugAssert(pRecord->Nesting == 0);
+  Collect(pRecord);
+  Y_AtomicStore(pRecord->InUse, uint32(0), ATOMIC_MEMORY_ORDER_RELEASE);
+}
+
+void EpochManager::Retire(ThreadRecord* pRecord, void* pObject, ReclaimCallback callback)
+{
+  uint32 epoch = Y_AtomicLoad(m_globalEpoch);
+  ThreadRecord::RetireList& list = pRecord->RetireLists[(epoch / EPOCH_STEP) % countof(pRecord->RetireLists)];
+
+  // The list was last used three epochs back, so what's in it is unreachable. Only when the epoch has wrapped can
+  // it be closer than that, and then its nodes wait for this epoch's.
+  if (list.Epoch != epoch)
+  {
+    if ((epoch - list.Epoch) >= RECLAIM_DISTANCE)
+      ReclaimList(pRecord, list);
+
+    list.Epoch = epoch;
+  }
+
+  ThreadRecord::RetiredObject retiredObject = {pObject, callback};
+  list.Objects.Add(retiredObject);
+  if ((++pRecord->RetiredCount % RetireBatchSize) == 0)
+    Collect(pRecord);
+}
+
+bool EpochManager::TryAdvance()
+{
+  uint32 epoch = Y_AtomicLoad(m_globalEpoch);
+  for (const ThreadRecord* pRecord = Y_AtomicLoadAcquire(m_pRecords); pRecord != nullptr; pRecord = pRecord->pNext)
+  {
+    uint32 localEpoch = Y_AtomicLoad(pRecord->LocalEpoch);
+    if (localEpoch != 0 && localEpoch != (epoch | 1))
+      return false;
+  }
+
+  // losing the race is fine, someone else advanced it
+  Y_AtomicTryCompareExchange(m_globalEpoch, epoch, epoch + EPOCH_STEP);
+  return true;
+}
+
+void EpochManager::Collect(ThreadRecord* pRecord)
+{
+  TryAdvance();
+
+  uint32 epoch = Y_AtomicLoad(m_globalEpoch, ATOMIC_MEMORY_ORDER_ACQUIRE);
+  for (uint32 i = 0; i < countof(pRecord->RetireLists); i++)
+  {
+    ThreadRecord::RetireList& list = pRecord->RetireLists[i];
+    if (list.Objects.GetSize() > 0 && (epoch - list.Epoch) >= RECLAIM_DISTANCE)
+      ReclaimList(pRecord, list);
+  }
+}
+
+void EpochManager::ReclaimList(ThreadRecord* pRecord, ThreadRecord::RetireList& list)
+{
+  for (uint32 i = 0; i < list.Objects.GetSize(); i++)
+    list.Objects[i].Callback(list.Objects[i].pObject);
+
+  pRecord->RetiredCount -= list.Objects.GetSize();
+  list.Objects.Clear();
+}
@@ -12,21 +12,119 @@ static_assert(std::is_same<HRESULT, long>::value, "HRESULT is long");
 #include <cstring>
 #include <type_traits>
 
-Error::Error() : m_type(ERROR_TYPE_NONE)
+Error::Error()
+  : m_type(ERROR_TYPE_NONE), m_pStaticMessage(nullptr), m_pFormatFunction(nullptr), m_discard(false), m_pending(0)
+{
+  m_error.none = 0;
+}
+
+Error::Error(DiscardTag)
+  : m_type(ERROR_TYPE_NONE), m_pStaticMessage(nullptr), m_pFormatFunction(nullptr), m_discard(true), m_pending(0)
 {
   m_error.none = 0;
 }
 
 Error::Error(const Error& c)
+  : m_type(c.m_type), m_pStaticMessage(c.m_pStaticMessage), m_pFormatFunction(c.m_pFormatFunction), m_discard(false),
+    m_pending(c.m_pending)
 {
-  m_type = c.m_type;
   std::memcpy(&m_error, &c.m_error, sizeof(m_error));
+  std::memcpy(&m_arguments, &c.m_arguments, sizeof(m_arguments));
   m_codeString.AppendString(c.m_codeString);
   m_message.AppendString(c.m_message);
 }
 
 Error::~Error() {}
 
+Error* Error::Discard()
+{
+  static Error discardError{DiscardTag()};
+  return &discardError;
+}
+
+bool Error::BeginSet(ERROR_TYPE type)
+{
+  if (m_discard)
+    return false;
+
+  m_type = type;
+  m_pStaticMessage = nullptr;
+  m_pFormatFunction = nullptr;
+  m_pending = 0;
+  m_codeString.Clear();
+  m_message.Clear();
+  return true;
+}
+
+void Error::Render() const
+{
+  if (m_pending & PENDING_CODE_STRING)
+  {
+    switch (m_type)
+    {
+#ifdef Y_PLATFORM_WINDOWS
+      case ERROR_TYPE_WIN32:
+        m_codeString.Format("%u", (uint32)m_error.win32);
+        break;
+
+      case ERROR_TYPE_HRESULT:
+        m_codeString.Format("%08X", (uint32)m_error.hresult);
+        break;
+#endif
+
+      default:
+        m_codeString.Format("%i", m_error.user);
+        break;
+    }
+  }
+
+  if (m_pending & PENDING_MESSAGE)
+  {
+    switch (m_type)
+    {
+      case ERROR_TYPE_ERRNO:
+      {
+        const char* messageStr = strerror(m_error.errno_f);
+        if (messageStr != nullptr)
+          m_message = messageStr;
+        else
+          m_message = "<Could not get error message>";
+      }
+      break;
+
+#ifdef Y_PLATFORM_WINDOWS
+      case ERROR_TYPE_WIN32:
+      case ERROR_TYPE_HRESULT:
+      {
+        DWORD r = FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, NULL, m_error.win32, 0, m_message.GetWriteableCharArray(),
+                                 m_message.GetWritableBufferSize(), NULL);
+        if (r > 0)
+        {
+          m_message.Resize(r);
+          m_message.RStrip();
+        }
+        else
+        {
+          m_message = "<Could not resolve system error ID>";
+        }
+      }
+      break;
+#endif
+
+      default:
+      {
+        if (m_pFormatFunction != nullptr)
+          m_pFormatFunction(m_message, m_pStaticMessage, m_arguments.data);
+        else
+          m_message = m_pStaticMessage;
+      }
+      break;
+    }
+  }
+
+  m_pending = 0;
+}
+
 ERROR_TYPE Error::GetType() const
 {
   return m_type;
@@ -62,24 +160,19 @@ long Error::GetErrorCodeHResult() const
 // setter functions
 void Error::SetErrorNone()
 {
-  m_type = ERROR_TYPE_NONE;
+  if (!BeginSet(ERROR_TYPE_NONE))
+    return;
+
   m_error.none = 0;
-  m_codeString.Clear();
-  m_message.Clear();
 }
 
 void Error::SetErrorErrno(int err)
 {
-  m_type = ERROR_TYPE_ERRNO;
-  m_error.errno_f = err;
-
-  m_codeString.Format("%i", err);
+  if (!BeginSet(ERROR_TYPE_ERRNO))
+    return;
 
-  const char* messageStr = strerror(err);
-  if (messageStr != nullptr)
-    m_message = messageStr;
-  else
-    m_message = "<Could not get error message>";
+  m_error.errno_f = err;
+  m_pending = PENDING_CODE_STRING | PENDING_MESSAGE;
 }
 
 void Error::SetErrorSocket(int err)
@@ -94,15 +187,19 @@ void Error::SetErrorSocket(int err)
 
 void Error::SetErrorUser(int32 err, const char* msg)
 {
-  m_type = ERROR_TYPE_USER;
+  if (!BeginSet(ERROR_TYPE_USER))
+    return;
+
   m_error.user = err;
-  m_codeString.Format("%i", err);
   m_message = msg;
+  m_pending = PENDING_CODE_STRING;
 }
 
 void Error::SetErrorUser(const char* code, const char* message)
 {
-  m_type = ERROR_TYPE_USER;
+  if (!BeginSet(ERROR_TYPE_USER))
+    return;
+
   m_error.user = 0;
   m_codeString = code;
   m_message = message;
@@ -110,68 +207,60 @@ void Error::SetErrorUser(const char* code, const char* message)
 
 void Error::SetErrorUserFormatted(int32 err, const char* format, ...)
 {
+  if (!BeginSet(ERROR_TYPE_USER))
+    return;
+
   va_list ap;
   va_start(ap, format);
 
-  m_type = ERROR_TYPE_USER;
   m_error.user = err;
-  m_codeString.Format("%i", err);
   m_message.FormatVA(format, ap);
+  m_pending = PENDING_CODE_STRING;
   va_end(ap);
 }
 
 void Error::SetErrorUserFormatted(const char* code, const char* format, ...)
 {
+  if (!BeginSet(ERROR_TYPE_USER))
+    return;
+
   va_list ap;
   va_start(ap, format);
 
-  m_type = ERROR_TYPE_USER;
   m_error.user = 0;
   m_codeString = code;
   m_message.FormatVA(format, ap);
   va_end(ap);
 }
 
+void Error::SetErrorUserStatic(int32 err, const char* staticMessage)
+{
+  if (!BeginSet(ERROR_TYPE_USER))
+    return;
+
+  m_error.user = err;
+  m_pStaticMessage = staticMessage;
+  m_pending = PENDING_CODE_STRING | PENDING_MESSAGE;
+}
+
 #ifdef Y_PLATFORM_WINDOWS
 
 void Error::SetErrorCodeWin32(unsigned long err)
 {
-  m_type = ERROR_TYPE_WIN32;
-  m_error.win32 = err;
-  m_codeString.Format("%u", (uint32)err);
-  m_message.Clear();
+  if (!BeginSet(ERROR_TYPE_WIN32))
+    return;
 
-  DWORD r = FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, NULL, m_error.win32, 0, m_message.GetWriteableCharArray(),
-                           m_message.GetWritableBufferSize(), NULL);
-  if (r > 0)
-  {
-    m_message.Resize(r);
-    m_message.RStrip();
-  }
-  else
-  {
-    m_message = "<Could not resolve system error ID>";
-  }
+  m_error.win32 = err;
+  m_pending = PENDING_CODE_STRING | PENDING_MESSAGE;
 }
 
 void Error::SetErrorCodeHResult(long err)
 {
-  m_type = ERROR_TYPE_HRESULT;
-  m_error.win32 = err;
-  m_codeString.Format("%08X", (uint32)err);
-  m_message.Clear();
+  if (!BeginSet(ERROR_TYPE_HRESULT))
+    return;
 
-  DWORD r = FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, NULL, m_error.win32, 0, m_message.GetWriteableCharArray(),
-                           m_message.GetWritableBufferSize(), NULL);
-  if (r > 0)
-  {
-    m_message.Resize(r);
-    m_message.RStrip();
-  }
-  else
-  {
-    m_message = "<Could not resolve system error ID>";
-  }
+  m_error.hresult = err;
+  m_pending = PENDING_CODE_STRING | PENDING_MESSAGE;
 }
 
 #endif
@@ -220,8 +309,8 @@ Error Error::CreateErrorUserFormatted(int32 err, const char* format, ...)
   Error ret;
   ret.m_type = ERROR_TYPE_USER;
   ret.m_error.user = err;
-  ret.m_codeString.Format("%i", err);
   ret.m_message.FormatVA(format, ap);
+  ret.m_pending = PENDING_CODE_STRING;
 
   va_end(ap);
 
@@ -263,8 +352,15 @@ Error Error::CreateErrorHResult(long err)
 
 Error& Error::operator=(const Error& e)
 {
+  if (m_discard || this == &e)
+    return *this;
+
   m_type = e.m_type;
   std::memcpy(&m_error, &e.m_error, sizeof(m_error));
+  m_pStaticMessage = e.m_pStaticMessage;
+  m_pFormatFunction = e.m_pFormatFunction;
+  std::memcpy(&m_arguments, &e.m_arguments, sizeof(m_arguments));
+  m_pending = e.m_pending;
   m_codeString.Clear();
   m_codeString.AppendString(e.m_codeString);
   m_message.Clear();
@@ -341,5 +437,5 @@ SmallString Error::GetErrorCodeAndDescription() const
 
 void Error::GetErrorCodeAndDescription(String& dest) const
 {
-  dest.Format("[%s]: %s", m_codeString.GetCharArray(), m_message.GetCharArray());
+  dest.Format("[%s]: %s", GetErrorCodeString().GetCharArray(), GetErrorDescription().GetCharArray());
 }
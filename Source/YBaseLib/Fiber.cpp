@@ -0,0 +1,196 @@
+#if defined(__APPLE__)
+// ucontext is only exposed with the XSI extensions on OSX
+#define _XOPEN_SOURCE 600
+#endif
+
+#include "YBaseLib/Fiber.h"
+#include "YBaseLib/Assert.h"
+
+#if defined(Y_PLATFORM_WINDOWS)
+#include "YBaseLib/Windows/WindowsHeaders.h"
+#elif defined(Y_PLATFORM_POSIX)
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+Fiber::Fiber()
+  : m_pContext(nullptr), m_pStack(nullptr), m_stackSize(0), m_entryPoint(nullptr), m_pUserData(nullptr),
+    m_converted(false)
+{
+}
+
+#if defined(Y_PLATFORM_WINDOWS)
+
+Fiber::~Fiber()
+{
+  DebugAssert(!m_converted);
+  if (m_pContext != nullptr)
+    DeleteFiber(m_pContext);
+}
+
+bool Fiber::Create(EntryPoint entryPoint, void* pUserData, uint32 stackSize /* = DefaultStackSize */)
+{
+  DebugAssert(!IsValid());
+  m_entryPoint = entryPoint;
+  m_pUserData = pUserData;
+  m_pContext = CreateFiber(stackSize, __FiberStart, this);
+  return (m_pContext != nullptr);
+}
+
+bool Fiber::ConvertFromThread()
+{
+  DebugAssert(!IsValid());
+  m_pContext = ConvertThreadToFiber(nullptr);
+  if (m_pContext == nullptr)
+    return false;
+
+  m_converted = true;
+  return true;
+}
+
+void Fiber::ConvertToThread()
+{
+  Assert(m_converted);
+  ConvertFiberToThread();
+  m_pContext = nullptr;
+  m_converted = false;
+}
+
+void Fiber::Switch(Fiber* pFrom, Fiber* pTo)
+{
+  DebugAssert(pFrom->m_pContext == GetCurrentFiber() && pTo->IsValid());
+  SwitchToFiber(pTo->m_pContext);
+}
+
+bool Fiber::IsSupported()
+{
+  return true;
+}
+
+void __stdcall Fiber::__FiberStart(void* pParameter)
+{
+  Fiber* pFiber = reinterpret_cast<Fiber*>(pParameter);
+  pFiber->m_entryPoint(pFiber->m_pUserData);
+
+  // returning would exit the thread
+  Panic("Fiber entry point returned");
+}
+
+#elif defined(Y_PLATFORM_POSIX)
+
+Fiber::~Fiber()
+{
+  DebugAssert(!m_converted);
+  delete reinterpret_cast<ucontext_t*>(m_pContext);
+  if (m_pStack != nullptr)
+    munmap(m_pStack, m_stackSize);
+}
+
+bool Fiber::Create(EntryPoint entryPoint, void* pUserData, uint32 stackSize /* = DefaultStackSize */)
+{
+  DebugAssert(!IsValid());
+
+  // The page below the stack is left inaccessible, so an overflow faults instead of corrupting the heap. The rounded
+  // size is a new local, as getcontext returns twice and an argument modified before it may be clobbered.
+  const uint32 pageSize = static_cast<uint32>(sysconf(_SC_PAGESIZE));
+  const uint32 roundedStackSize = (stackSize + pageSize - 1) / pageSize * pageSize;
+  void* pMapping = mmap(nullptr, roundedStackSize + pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (pMapping == MAP_FAILED)
+    return false;
+
+  ucontext_t* pContext = new ucontext_t;
+  if (mprotect(pMapping, pageSize, PROT_NONE) != 0 || getcontext(pContext) != 0)
+  {
+    delete pContext;
+    munmap(pMapping, roundedStackSize + pageSize);
+    return false;
+  }
+
+  m_pStack = pMapping;
+  m_stackSize = roundedStackSize + pageSize;
+  m_entryPoint = entryPoint;
+  m_pUserData = pUserData;
+
+  // makecontext only passes int arguments, so the pointer is split in two
+  uint64 pointerValue = static_cast<uint64>(reinterpret_cast<uintptr_t>(this));
+  pContext->uc_stack.ss_sp = reinterpret_cast<byte*>(pMapping) + pageSize;
+  pContext->uc_stack.ss_size = roundedStackSize;
+  pContext->uc_link = nullptr;
+  makecontext(pContext, reinterpret_cast<void (*)()>(__FiberStart), 2, static_cast<uint32>(pointerValue >> 32),
+              static_cast<uint32>(pointerValue));
+
+  m_pContext = pContext;
+  return true;
+}
+
+bool Fiber::ConvertFromThread()
+{
+  DebugAssert(!IsValid());
+
+  // filled in by the first switch away from the thread
+  m_pContext = new ucontext_t;
+  m_converted = true;
+  return true;
+}
+
+void Fiber::ConvertToThread()
+{
+  Assert(m_converted);
+  delete reinterpret_cast<ucontext_t*>(m_pContext);
+  m_pContext = nullptr;
+  m_converted = false;
+}
+
+void Fiber::Switch(Fiber* pFrom, Fiber* pTo)
+{
+  DebugAssert(pFrom->IsValid() && pTo->IsValid());
+  swapcontext(reinterpret_cast<ucontext_t*>(pFrom->m_pContext), reinterpret_cast<ucontext_t*>(pTo->m_pContext));
+}
+
+bool Fiber::IsSupported()
+{
+  return true;
+}
+
+void Fiber::__FiberStart(uint32 pointerHigh, uint32 pointerLow)
+{
+  Fiber* pFiber = reinterpret_cast<Fiber*>(static_cast<uintptr_t>(((uint64)pointerHigh << 32) | pointerLow));
+  pFiber->m_entryPoint(pFiber->m_pUserData);
+
+  // there is no context to return to
+  Panic("Fiber entry point returned");
+}
+
+#else
+
+Fiber::~Fiber() {}
+
+bool Fiber::Create(EntryPoint entryPoint, void* pUserData, uint32 stackSize /* = DefaultStackSize */)
+{
+  return false;
+}
+
+bool Fiber::ConvertFromThread()
+{
+  return false;
+}
+
+void Fiber::ConvertToThread()
+{
+  Panic("Fibers are not supported on this platform");
+}
+
+void Fiber::Switch(Fiber* pFrom, Fiber* pTo)
+{
+  Panic("Fibers are not supported on this platform");
+}
+
+bool Fiber::IsSupported()
+{
+  return false;
+}
+
+void Fiber::__FiberStart(uint32 pointerHigh, uint32 pointerLow) {}
+
+#endif
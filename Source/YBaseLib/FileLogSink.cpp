@@ -0,0 +1,381 @@
+#include "YBaseLib/FileLogSink.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/BufferedByteStream.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/CompressionByteStream.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/ThreadPool.h"
+#include "YBaseLib/Timestamp.h"
+Log_SetChannel(FileLogSink);
+
+const uint32 FileLogSink::DefaultBufferSize;
+
+// appended to the names of compressed files
+static const char CompressedFileExtension[] = ".zz";
+
+// Compresses a rotated file next to it, then deletes it. The compressed file only appears once it's complete, so an
+// interrupted job leaves the original in place.
+class FileLogSink::CompressJob : public ThreadPoolWorkItemSignaled
+{
+public:
+  CompressJob(const String& fileName, int32 level) : m_fileName(fileName), m_level(level) {}
+
+  const String& GetFileName() const { return m_fileName; }
+
+protected:
+  virtual int32 ProcessWork() override final
+  {
+    ByteStream* pSourceStream = FileSystem::OpenFile(m_fileName, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_STREAMED);
+    if (pSourceStream == nullptr)
+    {
+      Log_WarningPrintf("FileLogSink::CompressJob: Failed to open '%s'", m_fileName.GetCharArray());
+      return -1;
+    }
+
+    SmallString compressedFileName;
+    compressedFileName.Format("%s%s", m_fileName.GetCharArray(), CompressedFileExtension);
+    uint32 openMode =
+      BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_TRUNCATE | BYTESTREAM_OPEN_ATOMIC_UPDATE;
+    ByteStream* pFileStream = FileSystem::OpenFile(compressedFileName, openMode);
+    if (pFileStream == nullptr)
+    {
+      Log_WarningPrintf("FileLogSink::CompressJob: Failed to create '%s'", compressedFileName.GetCharArray());
+      pSourceStream->Release();
+      return -1;
+    }
+
+    // the compressor holds its own reference, and commits the file
+    CompressionByteStream* pCompressor =
+      CompressionByteStream::CreateCompressor(pFileStream, COMPRESSION_CODEC_DEFLATE, m_level);
+    bool result = (pCompressor != nullptr && ByteStream_AppendStream(pSourceStream, pCompressor) &&
+                   pCompressor->Commit());
+    if (!result)
+    {
+      if (pCompressor != nullptr)
+        pCompressor->Discard();
+      else
+        pFileStream->Discard();
+    }
+
+    if (pCompressor != nullptr)
+      pCompressor->Release();
+    pFileStream->Release();
+    pSourceStream->Release();
+
+    if (!result)
+    {
+      Log_WarningPrintf("FileLogSink::CompressJob: Failed to compress '%s'", m_fileName.GetCharArray());
+      return -1;
+    }
+
+    FileSystem::DeleteFile(m_fileName);
+    return 0;
+  }
+
+private:
+  String m_fileName;
+  int32 m_level;
+};
+
+FileLogSink::FileLogSink()
+  : m_bufferSize(DefaultBufferSize), m_levelFilter(LOGLEVEL_TRACE), m_writeTimestamps(false), m_maxFileSize(0),
+    m_maxFileAge(0), m_keepCount(0), m_pCompressionThreadPool(nullptr), m_compressionLevel(0), m_pStream(nullptr),
+    m_rotationStartSize(0), m_rotationStartTime(0), m_registered(false)
+{
+}
+
+FileLogSink::~FileLogSink()
+{
+  Close();
+
+  // no longer registered, so the jobs logging can't wait on the lock
+  ReapCompressJobs(true);
+}
+
+void FileLogSink::SetFilter(const char* channelFilter, LOGLEVEL levelFilter)
+{
+  m_lock.Lock();
+  m_channelFilter = (channelFilter != nullptr) ? channelFilter : "";
+  m_levelFilter = levelFilter;
+  m_lock.Unlock();
+}
+
+void FileLogSink::SetTimestampFormat(const char* format, uint32 fractionDigits)
+{
+  m_lock.Lock();
+  m_writeTimestamps = (format != nullptr);
+  if (format != nullptr)
+    m_timestampFormatter.SetFormat(format, fractionDigits);
+  m_lock.Unlock();
+}
+
+void FileLogSink::SetRotation(uint64 maxFileSize, uint32 maxFileAge, uint32 keepCount)
+{
+  m_lock.Lock();
+  m_maxFileSize = maxFileSize;
+  m_maxFileAge = maxFileAge;
+  m_keepCount = keepCount;
+  m_lock.Unlock();
+}
+
+bool FileLogSink::SetCompression(ThreadPool* pThreadPool, int32 level)
+{
+  if (pThreadPool != nullptr && !Compression::IsCodecAvailable(COMPRESSION_CODEC_DEFLATE))
+  {
+    Log_ErrorPrintf("FileLogSink::SetCompression: Deflate is not built in");
+    return false;
+  }
+
+  m_lock.Lock();
+  m_pCompressionThreadPool = pThreadPool;
+  m_compressionLevel = level;
+  m_lock.Unlock();
+  return true;
+}
+
+bool FileLogSink::Open(const char* directory, const char* baseName, uint32 bufferSize)
+{
+  Close();
+
+  if (!FileSystem::CreateDirectory(directory, true))
+  {
+    Log_ErrorPrintf("FileLogSink::Open: Failed to create directory '%s'", directory);
+    return false;
+  }
+
+  m_lock.Lock();
+  m_directory = directory;
+  m_baseName = baseName;
+  m_bufferSize = bufferSize;
+  bool result = OpenNewFile();
+  m_lock.Unlock();
+  if (!result)
+  {
+    Log_ErrorPrintf("FileLogSink::Open: Failed to create log file in '%s'", directory);
+    return false;
+  }
+
+  Log::GetInstance().RegisterCallback(LogCallback, this);
+  m_registered = true;
+  return true;
+}
+
+void FileLogSink::Close()
+{
+  if (m_registered)
+  {
+    Log::GetInstance().UnregisterCallback(LogCallback, this);
+    m_registered = false;
+  }
+
+  m_lock.Lock();
+  CloseFile(false);
+  m_lock.Unlock();
+}
+
+bool FileLogSink::Rotate()
+{
+  m_lock.Lock();
+  bool result = (m_pStream != nullptr && OpenNewFile());
+  m_lock.Unlock();
+  return result;
+}
+
+bool FileLogSink::Flush()
+{
+  m_lock.Lock();
+  bool result = (m_pStream == nullptr || m_pStream->Flush());
+  m_lock.Unlock();
+  return result;
+}
+
+void FileLogSink::LogCallback(void* pUserParam, const char* channelName, const char* functionName, LOGLEVEL level,
+                              const char* message)
+{
+  FileLogSink* pSink = static_cast<FileLogSink*>(pUserParam);
+  pSink->m_lock.Lock();
+  pSink->WriteMessage(channelName, functionName, level, message);
+  pSink->m_lock.Unlock();
+}
+
+void FileLogSink::WriteText(const char* text, void* pUserParam)
+{
+  static_cast<ByteStream*>(pUserParam)->Write2(text, Y_strlen(text));
+}
+
+void FileLogSink::WriteMessage(const char* channelName, const char* functionName, LOGLEVEL level,
+                               const char* message)
+{
+  if (m_pStream == nullptr || level > m_levelFilter || m_channelFilter.Find(channelName) >= 0)
+    return;
+
+  // rotate before the message, so each file starts with the first message past the limit
+  if ((m_maxFileSize != 0 && (m_pStream->GetPosition() - m_rotationStartSize) >= m_maxFileSize) ||
+      (m_maxFileAge != 0 && Y_TimerConvertToSeconds(Y_TimerGetValue() - m_rotationStartTime) >= m_maxFileAge))
+  {
+    OpenNewFile();
+  }
+
+  if (m_writeTimestamps)
+  {
+    uint32 length;
+    const char* timeString = m_timestampFormatter.Format(Timestamp::NowCoarse(), &length);
+    m_pStream->Write2(timeString, length);
+    m_pStream->Write2(" ", 1);
+  }
+
+  Log::FormatLogMessageForDisplay(channelName, functionName, level, message, WriteText, m_pStream);
+  m_pStream->Write2("\n", 1);
+
+  if (level <= LOGLEVEL_WARNING)
+    m_pStream->Flush();
+}
+
+bool FileLogSink::OpenNewFile()
+{
+  // named for now, with a number after it if there's already a file from this second
+  SmallString timeString;
+  Timestamp::Now().ToString(timeString, "%Y%m%d-%H%M%S");
+
+  String fileName;
+  SmallString compressedFileName;
+  for (uint32 attempt = 0;; attempt++)
+  {
+    fileName.Format("%s%c%s-%s", m_directory.GetCharArray(), FS_OSPATH_SEPERATOR_CHARACTER, m_baseName.GetCharArray(),
+                    timeString.GetCharArray());
+    if (attempt > 0)
+      fileName.AppendFormattedString("-%u", attempt);
+    fileName.AppendString(".log");
+    compressedFileName.Format("%s%s", fileName.GetCharArray(), CompressedFileExtension);
+    if (!FileSystem::FileExists(fileName) && !FileSystem::FileExists(compressedFileName))
+      break;
+  }
+
+  uint32 openMode =
+    BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_TRUNCATE | BYTESTREAM_OPEN_STREAMED;
+  ByteStream* pFileStream = FileSystem::OpenFile(fileName, openMode);
+  if (pFileStream == nullptr)
+  {
+    // try again after another period, rather than for every message
+    if (m_pStream != nullptr)
+    {
+      m_rotationStartSize = m_pStream->GetPosition();
+      m_rotationStartTime = Y_TimerGetValue();
+    }
+
+    return false;
+  }
+
+  CloseFile(true);
+
+  // no task queue, so the buffer is written out on the thread logging once it fills
+  m_pStream = new BufferedByteStream(pFileStream, nullptr, m_bufferSize, 1);
+  pFileStream->Release();
+  m_fileName = fileName;
+  m_rotationStartSize = 0;
+  m_rotationStartTime = Y_TimerGetValue();
+
+  DeleteOldFiles();
+  return true;
+}
+
+void FileLogSink::CloseFile(bool rotating)
+{
+  if (m_pStream == nullptr)
+    return;
+
+  m_pStream->Commit();
+  m_pStream->Release();
+  m_pStream = nullptr;
+
+  ReapCompressJobs(false);
+  if (rotating && m_pCompressionThreadPool != nullptr)
+  {
+    CompressJob* pJob = new CompressJob(m_fileName, m_compressionLevel);
+    m_compressJobs.Add(pJob);
+    m_pCompressionThreadPool->EnqueueWorkItem(pJob);
+  }
+
+  m_fileName.Clear();
+}
+
+void FileLogSink::ReapCompressJobs(bool wait)
+{
+  for (uint32 i = 0; i < m_compressJobs.GetSize();)
+  {
+    CompressJob* pJob = m_compressJobs[i];
+    if (wait)
+      pJob->WaitForCompletion();
+    else if (!pJob->IsCompleted())
+    {
+      i++;
+      continue;
+    }
+
+    pJob->Release();
+    m_compressJobs.FastRemove(i);
+  }
+}
+
+void FileLogSink::DeleteOldFiles()
+{
+  if (m_keepCount == 0)
+    return;
+
+  // names match on the digits after the base name, so other sinks' files in the directory with longer base names
+  // are left alone
+  SmallString pattern;
+  pattern.Format("%s-[0-9]*.log;%s-[0-9]*.log%s", m_baseName.GetCharArray(), m_baseName.GetCharArray(),
+                 CompressedFileExtension);
+
+  FileSystem::FindResultsArray files;
+  if (!FileSystem::FindFiles(m_directory, pattern,
+                             FILESYSTEM_FIND_FILES | FILESYSTEM_FIND_RELATIVE_PATHS | FILESYSTEM_FIND_NO_STAT, &files))
+  {
+    return;
+  }
+
+  // The names sort by when they were opened once the extensions are dropped, with a file's numbered ones after it,
+  // as the shorter name sorts first. The search is for names with the base name, so its length is where they
+  // start to differ.
+  uint32 baseNameLength = m_baseName.GetLength();
+  files.SortCB([baseNameLength](const FILESYSTEM_FIND_DATA& left, const FILESYSTEM_FIND_DATA& right) {
+    const char* pLeftName = left.FileName + baseNameLength;
+    const char* pRightName = right.FileName + baseNameLength;
+    uint32 leftLength = (uint32)(Y_strchr(pLeftName, '.') - pLeftName);
+    uint32 rightLength = (uint32)(Y_strchr(pRightName, '.') - pRightName);
+    int result = Y_strncmp(pLeftName, pRightName, Min(leftLength, rightLength));
+    return (result != 0) ? result : ((int)leftLength - (int)rightLength);
+  });
+
+  // Newest first, skipping the open file. Files being compressed are kept, and counted once by their original
+  // names, as the compressed file can appear before the original is deleted.
+  SmallString fileName;
+  uint32 keptCount = 0;
+  for (uint32 i = files.GetSize(); i > 0; i--)
+  {
+    fileName.Format("%s%c%s", m_directory.GetCharArray(), FS_OSPATH_SEPERATOR_CHARACTER, files[i - 1].FileName);
+    if (fileName == m_fileName)
+      continue;
+
+    bool compressing = false;
+    bool compressedCopy = false;
+    for (CompressJob* pJob : m_compressJobs)
+    {
+      const String& jobFileName = pJob->GetFileName();
+      if (fileName.StartsWith(jobFileName))
+      {
+        compressing = true;
+        compressedCopy = (fileName.GetLength() != jobFileName.GetLength());
+        break;
+      }
+    }
+
+    if (compressedCopy)
+      continue;
+
+    if (++keptCount > m_keepCount && !compressing)
+      FileSystem::DeleteFile(fileName);
+  }
+}
@@ -0,0 +1,815 @@
+#include "YBaseLib/FileSystemIndex.h"
+#include "YBaseLib/BinaryReader.h"
+#include "YBaseLib/BinaryWriter.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/GlobPattern.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/MutexLock.h"
+#include "YBaseLib/Timestamp.h"
+Log_SetChannel(FileSystemIndex);
+
+static const uint32 SNAPSHOT_MAGIC = 0x49534659; // 'YFSI'
+static const uint32 SNAPSHOT_VERSION = 1;
+
+const uint32 FileSystemIndex::InvalidNode;
+const uint32 FileSystemIndex::RootNode;
+
+static bool IsHiddenName(const char* name)
+{
+  return (name[0] == '.');
+}
+
+static bool IsDirectory(const FILESYSTEM_STAT_DATA& statData)
+{
+  return (statData.Attributes & FILESYSTEM_FILE_ATTRIBUTE_DIRECTORY) != 0;
+}
+
+static uint64 GetCurrentUnixTime()
+{
+  return (uint64)Timestamp::Now().AsUnixTimestamp();
+}
+
+static bool IsSeparator(char ch)
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  return (ch == '/' || ch == '\\');
+#else
+  return (ch == '/');
+#endif
+}
+
+// Paths are kept with '/' separators, without '.' or empty parts, and with '..' only at the start. A path leaving the
+// directory it starts from keeps its leading '..', so it's never taken for one under a relative root.
+static void CanonicalizeIndexPath(String& destination, const char* path)
+{
+  destination.Clear();
+
+  // the root or drive an absolute path starts with
+  uint32 prefixLength = 0;
+  if (IsSeparator(path[0]))
+    prefixLength = 1;
+#if defined(Y_PLATFORM_WINDOWS)
+  else if (path[0] != '\0' && path[1] == ':')
+    prefixLength = IsSeparator(path[2]) ? 3 : 2;
+#endif
+  destination.AppendString(path, prefixLength);
+
+  const char* pCurrent = path + prefixLength;
+  while (*pCurrent != '\0')
+  {
+    const char* pEnd = pCurrent;
+    while (*pEnd != '\0' && !IsSeparator(*pEnd))
+      pEnd++;
+
+    uint32 partLength = (uint32)(pEnd - pCurrent);
+    if (partLength == 2 && pCurrent[0] == '.' && pCurrent[1] == '.')
+    {
+      // drop the last part, unless there's nothing left but '..', which can only be kept on a relative path
+      int32 separatorPosition = destination.RFind('/');
+      uint32 lastPartStart = (separatorPosition >= (int32)prefixLength) ? (uint32)separatorPosition + 1 : prefixLength;
+      if (destination.GetLength() > prefixLength && Y_strcmp(destination.GetCharArray() + lastPartStart, "..") != 0)
+      {
+        destination.Erase((int32)((lastPartStart > prefixLength) ? lastPartStart - 1 : prefixLength));
+      }
+      else if (prefixLength == 0)
+      {
+        if (destination.GetLength() > 0)
+          destination.AppendCharacter('/');
+        destination.AppendString("..");
+      }
+    }
+    else if (partLength > 1 || (partLength == 1 && pCurrent[0] != '.'))
+    {
+      if (destination.GetLength() > prefixLength)
+        destination.AppendCharacter('/');
+      destination.AppendString(pCurrent, partLength);
+    }
+
+    pCurrent = (*pEnd != '\0') ? pEnd + 1 : pEnd;
+  }
+
+#if defined(Y_PLATFORM_WINDOWS)
+  destination.Replace('\\', '/');
+#endif
+}
+
+FileSystemIndex::FileSystemIndex() : m_pChangeNotifier(nullptr)
+{
+  ResetNodes();
+}
+
+FileSystemIndex::~FileSystemIndex()
+{
+  delete m_pChangeNotifier;
+}
+
+bool FileSystemIndex::Build(const char* rootPath, ThreadPool* pThreadPool, bool watch /* = true */)
+{
+  m_lock.LockExclusive();
+
+  delete m_pChangeNotifier;
+  m_pChangeNotifier = nullptr;
+  m_rootPath = rootPath;
+  CanonicalizeIndexPath(m_canonicalRootPath, rootPath);
+  ResetNodes();
+
+  FILESYSTEM_STAT_DATA statData;
+  if (!FileSystem::StatFile(rootPath, &statData) || !IsDirectory(statData) || (watch && !StartWatching()))
+  {
+    Log_ErrorPrintf("FileSystemIndex::Build: failed to open '%s'", rootPath);
+    delete m_pChangeNotifier;
+    m_pChangeNotifier = nullptr;
+    m_lock.UnlockExclusive();
+    return false;
+  }
+
+  m_nodes[RootNode].StatData = statData;
+  ScanTree(RootNode, pThreadPool);
+  m_lock.UnlockExclusive();
+  return true;
+}
+
+bool FileSystemIndex::LoadSnapshot(const char* rootPath, const char* snapshotFileName, ThreadPool* pThreadPool,
+                                   bool watch /* = true */)
+{
+  ByteStream* pStream;
+  if (!ByteStream_OpenFileStream(snapshotFileName, BYTESTREAM_OPEN_READ, &pStream))
+    return false;
+
+  m_lock.LockExclusive();
+
+  delete m_pChangeNotifier;
+  m_pChangeNotifier = nullptr;
+  m_rootPath = rootPath;
+  CanonicalizeIndexPath(m_canonicalRootPath, rootPath);
+  ResetNodes();
+
+  bool result = ReadSnapshot(pStream);
+  pStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrintf("FileSystemIndex::LoadSnapshot: '%s' is not a snapshot of '%s'", snapshotFileName, rootPath);
+    ResetNodes();
+    m_lock.UnlockExclusive();
+    return false;
+  }
+
+  FILESYSTEM_STAT_DATA statData;
+  if (!FileSystem::StatFile(rootPath, &statData) || !IsDirectory(statData) || (watch && !StartWatching()))
+  {
+    Log_ErrorPrintf("FileSystemIndex::LoadSnapshot: failed to open '%s'", rootPath);
+    delete m_pChangeNotifier;
+    m_pChangeNotifier = nullptr;
+    ResetNodes();
+    m_lock.UnlockExclusive();
+    return false;
+  }
+
+  // a directory changed since it was read, or in the same second, has to be read again
+  PODArray<uint32> directoryStack;
+  PathString fullPath;
+  directoryStack.Add(RootNode);
+  while (directoryStack.GetSize() > 0)
+  {
+    uint32 nodeIndex = directoryStack.PopBack();
+    Node& node = m_nodes[nodeIndex];
+    if (nodeIndex != RootNode)
+    {
+      GetFullPath(fullPath, node.Path);
+      if (!FileSystem::StatFile(fullPath, &statData) || !IsDirectory(statData))
+      {
+        PathString relativePath(node.Path);
+        RemoveNode(nodeIndex);
+        RefreshPath(relativePath, true, pThreadPool);
+        continue;
+      }
+    }
+
+    uint64 modificationTime = (uint64)statData.ModificationTime.AsUnixTimestamp();
+    if (modificationTime != (uint64)node.StatData.ModificationTime.AsUnixTimestamp() ||
+        node.ReadTime <= modificationTime)
+    {
+      SyncDirectory(nodeIndex, pThreadPool);
+    }
+
+    for (uint32 childIndex = m_nodes[nodeIndex].FirstChild; childIndex != InvalidNode;
+         childIndex = m_nodes[childIndex].NextSibling)
+    {
+      const Node& child = m_nodes[childIndex];
+      if (IsDirectory(child.StatData))
+        directoryStack.Add(childIndex);
+    }
+  }
+
+  m_lock.UnlockExclusive();
+  return true;
+}
+
+bool FileSystemIndex::SaveSnapshot(const char* snapshotFileName) const
+{
+  ByteStream* pStream;
+  if (!ByteStream_OpenFileStream(snapshotFileName,
+                                 BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_TRUNCATE |
+                                   BYTESTREAM_OPEN_ATOMIC_UPDATE,
+                                 &pStream))
+  {
+    Log_ErrorPrintf("FileSystemIndex::SaveSnapshot: failed to open '%s'", snapshotFileName);
+    return false;
+  }
+
+  m_lock.LockShared();
+
+  bool result = WriteSnapshot(pStream) && pStream->Commit();
+  m_lock.UnlockShared();
+
+  if (!result)
+  {
+    Log_ErrorPrintf("FileSystemIndex::SaveSnapshot: failed to write '%s'", snapshotFileName);
+    pStream->Discard();
+  }
+
+  pStream->Release();
+  return result;
+}
+
+bool FileSystemIndex::ReadSnapshot(ByteStream* pStream)
+{
+  BinaryReader reader(pStream, ENDIAN_TYPE_LITTLE, true, true);
+  SmallString snapshotRootPath;
+  bool result = (reader.ReadUInt32() == SNAPSHOT_MAGIC && reader.ReadUInt32() == SNAPSHOT_VERSION);
+  result = result && reader.SafeReadCString(&snapshotRootPath) && snapshotRootPath.Compare(m_canonicalRootPath);
+  if (result)
+  {
+    m_nodes[RootNode].StatData.ModificationTime.SetUnixTimestamp(reader.ReadVarUInt64());
+    m_nodes[RootNode].ReadTime = reader.ReadVarUInt64();
+
+    uint32 entryCount = reader.ReadVarUInt32();
+    PODArray<uint32> entryNodes;
+    entryNodes.Add(RootNode);
+
+    PathString name;
+    PathString path;
+    for (uint32 i = 0; i < entryCount && result; i++)
+    {
+      uint32 parentEntry = reader.ReadVarUInt32();
+      if (!reader.SafeReadCString(&name) || parentEntry >= entryNodes.GetSize() || name.GetLength() == 0 ||
+          name.Find('/') >= 0 || !IsDirectory(m_nodes[entryNodes[parentEntry]].StatData))
+      {
+        result = false;
+        break;
+      }
+
+      const String& parentPath = m_nodes[entryNodes[parentEntry]].Path;
+      if (parentPath.GetLength() > 0)
+        path.Format("%s/%s", parentPath.GetCharArray(), name.GetCharArray());
+      else
+        path.Assign(name);
+
+      bool created;
+      uint32 nodeIndex = GetOrCreateNode(path, &created);
+      Node& node = m_nodes[nodeIndex];
+      node.StatData.Attributes = reader.ReadVarUInt32();
+      node.StatData.ModificationTime.SetUnixTimestamp(reader.ReadVarUInt64());
+      node.StatData.Size = reader.ReadVarUInt64();
+      node.ReadTime = IsDirectory(node.StatData) ? reader.ReadVarUInt64() : 0;
+      entryNodes.Add(nodeIndex);
+      result = created;
+    }
+
+    result = result && !reader.GetErrorState();
+  }
+  return result;
+}
+
+bool FileSystemIndex::WriteSnapshot(ByteStream* pStream) const
+{
+  BinaryWriter writer(pStream, ENDIAN_TYPE_LITTLE, true, true);
+  writer.WriteUInt32(SNAPSHOT_MAGIC);
+  writer.WriteUInt32(SNAPSHOT_VERSION);
+  writer.WriteCString(m_canonicalRootPath);
+  writer.WriteVarUInt64((uint64)m_nodes[RootNode].StatData.ModificationTime.AsUnixTimestamp());
+  writer.WriteVarUInt64(m_nodes[RootNode].ReadTime);
+  writer.WriteVarUInt32(GetEntryCount());
+
+  // depth first, numbering the entries as they're written
+  PODArray<uint32> entryNumbers;
+  PODArray<uint32> nodeStack;
+  entryNumbers.Resize(m_nodes.GetSize());
+  entryNumbers[RootNode] = 0;
+  uint32 entryCount = 1;
+  nodeStack.Add(RootNode);
+  while (nodeStack.GetSize() > 0)
+  {
+    uint32 nodeIndex = nodeStack.PopBack();
+    for (uint32 childIndex = m_nodes[nodeIndex].FirstChild; childIndex != InvalidNode;
+         childIndex = m_nodes[childIndex].NextSibling)
+    {
+      const Node& child = m_nodes[childIndex];
+      writer.WriteVarUInt32(entryNumbers[nodeIndex]);
+      writer.WriteCString(child.Path.GetCharArray() + child.NameOffset);
+      writer.WriteVarUInt32(child.StatData.Attributes);
+      writer.WriteVarUInt64((uint64)child.StatData.ModificationTime.AsUnixTimestamp());
+      writer.WriteVarUInt64(child.StatData.Size);
+      if (IsDirectory(child.StatData))
+      {
+        writer.WriteVarUInt64(child.ReadTime);
+        entryNumbers[childIndex] = entryCount;
+        nodeStack.Add(childIndex);
+      }
+
+      entryCount++;
+    }
+  }
+
+  return writer.SyncStream() && !writer.InErrorState();
+}
+
+bool FileSystemIndex::Update(ThreadPool* pThreadPool /* = nullptr */)
+{
+  struct Change
+  {
+    String Path;
+    uint32 Event;
+  };
+
+  MutexLock locker(m_updateLock);
+  if (m_pChangeNotifier == nullptr)
+    return false;
+
+  Array<Change> changes;
+  m_pChangeNotifier->EnumerateChanges([&changes](const FileSystem::ChangeNotifier::ChangeInfo* pChangeInfo) {
+    Change change;
+    change.Path = pChangeInfo->Path;
+    change.Event = pChangeInfo->Event;
+    changes.Add(change);
+  });
+
+  if (changes.GetSize() == 0)
+    return false;
+
+  m_lock.LockExclusive();
+
+  PathString relativePath;
+  for (uint32 i = 0; i < changes.GetSize(); i++)
+  {
+    const Change& change = changes[i];
+    if (change.Event & FileSystem::ChangeNotifier::ChangeEvent_Overflow)
+    {
+      Log_WarningPrintf("FileSystemIndex::Update: changes to '%s' were lost, reading it again",
+                        m_rootPath.GetCharArray());
+
+      FILESYSTEM_STAT_DATA rootStatData = m_nodes[RootNode].StatData;
+      ResetNodes();
+      FileSystem::StatFile(m_rootPath, &rootStatData);
+      m_nodes[RootNode].StatData = rootStatData;
+      ScanTree(RootNode, pThreadPool);
+      continue;
+    }
+
+    // changes to the root itself don't matter, its entries report their own
+    if (!GetRelativePath(relativePath, change.Path) || relativePath.GetLength() == 0)
+      continue;
+
+    if (change.Event & (FileSystem::ChangeNotifier::ChangeEvent_FileRemoved |
+                        FileSystem::ChangeNotifier::ChangeEvent_RenamedOldName))
+    {
+      uint32 nodeIndex = FindNode(relativePath);
+      if (nodeIndex != InvalidNode)
+        RemoveNode(nodeIndex);
+    }
+    else
+    {
+      // a modified directory only had its entries change, they're reported separately
+      RefreshPath(relativePath, !(change.Event & FileSystem::ChangeNotifier::ChangeEvent_FileModified), pThreadPool);
+    }
+  }
+
+  m_lock.UnlockExclusive();
+  return true;
+}
+
+void FileSystemIndex::Clear()
+{
+  MutexLock locker(m_updateLock);
+  m_lock.LockExclusive();
+  delete m_pChangeNotifier;
+  m_pChangeNotifier = nullptr;
+  m_rootPath.Clear();
+  m_canonicalRootPath.Clear();
+  ResetNodes();
+  m_lock.UnlockExclusive();
+}
+
+uint32 FileSystemIndex::GetEntryCount() const
+{
+  return m_pathTable.GetMemberCount() - 1;
+}
+
+bool FileSystemIndex::FindFiles(const char* Path, const char* Pattern, uint32 Flags,
+                                FileSystem::FindResultsArray* pResults) const
+{
+  PathString relativePath;
+  if (!GetRelativePath(relativePath, Path))
+    return FileSystem::FindFiles(Path, Pattern, Flags, pResults);
+
+  if (!(Flags & FILESYSTEM_FIND_KEEP_ARRAY))
+    pResults->Clear();
+
+  GlobPattern compiledPattern(Pattern);
+
+  m_lock.LockShared();
+
+  uint32 searchIndex = FindNode(relativePath);
+  if (searchIndex == InvalidNode || !IsDirectory(m_nodes[searchIndex].StatData))
+  {
+    m_lock.UnlockShared();
+    return false;
+  }
+
+  // names in the results are relative to the search path, or start with it as it was given
+  uint32 searchPathLength = m_nodes[searchIndex].Path.GetLength();
+  if (searchPathLength > 0)
+    searchPathLength++;
+
+  uint32 nFiles = 0;
+  PODArray<uint32> directoryStack;
+  directoryStack.Add(searchIndex);
+  while (directoryStack.GetSize() > 0)
+  {
+    uint32 directoryIndex = directoryStack.PopBack();
+    for (uint32 childIndex = m_nodes[directoryIndex].FirstChild; childIndex != InvalidNode;
+         childIndex = m_nodes[childIndex].NextSibling)
+    {
+      const Node& child = m_nodes[childIndex];
+      const char* name = child.Path.GetCharArray() + child.NameOffset;
+      if (IsHiddenName(name) && !(Flags & FILESYSTEM_FIND_HIDDEN_FILES))
+        continue;
+
+      if (IsDirectory(child.StatData))
+      {
+        if (Flags & FILESYSTEM_FIND_RECURSIVE)
+          directoryStack.Add(childIndex);
+
+        if (!(Flags & FILESYSTEM_FIND_FOLDERS))
+          continue;
+      }
+      else
+      {
+        if (!(Flags & FILESYSTEM_FIND_FILES))
+          continue;
+      }
+
+      if (!compiledPattern.MatchesAll() && !compiledPattern.Match(name))
+        continue;
+
+      FILESYSTEM_FIND_DATA outData;
+      const char* pRelativeName = child.Path.GetCharArray() + searchPathLength;
+      if (Flags & FILESYSTEM_FIND_RELATIVE_PATHS)
+        Y_strncpy(outData.FileName, countof(outData.FileName), pRelativeName);
+      else
+        Y_snprintf(outData.FileName, countof(outData.FileName), "%s/%s", Path, pRelativeName);
+
+#if defined(Y_PLATFORM_WINDOWS)
+      for (char* pCh = outData.FileName; *pCh != '\0'; pCh++)
+      {
+        if (*pCh == '/')
+          *pCh = FS_OSPATH_SEPERATOR_CHARACTER;
+      }
+#endif
+
+      outData.Attributes = child.StatData.Attributes;
+      outData.ModificationTime = child.StatData.ModificationTime;
+      outData.Size = child.StatData.Size;
+      pResults->Add(outData);
+      nFiles++;
+    }
+  }
+
+  m_lock.UnlockShared();
+  return (nFiles > 0);
+}
+
+bool FileSystemIndex::StatFile(const char* Path, FILESYSTEM_STAT_DATA* pStatData) const
+{
+  PathString relativePath;
+  if (!GetRelativePath(relativePath, Path))
+    return FileSystem::StatFile(Path, pStatData);
+
+  m_lock.LockShared();
+  uint32 nodeIndex = FindNode(relativePath);
+  if (nodeIndex != InvalidNode)
+    *pStatData = m_nodes[nodeIndex].StatData;
+  m_lock.UnlockShared();
+  return (nodeIndex != InvalidNode);
+}
+
+bool FileSystemIndex::FileExists(const char* Path) const
+{
+  FILESYSTEM_STAT_DATA statData;
+  return StatFile(Path, &statData) && !IsDirectory(statData);
+}
+
+bool FileSystemIndex::DirectoryExists(const char* Path) const
+{
+  FILESYSTEM_STAT_DATA statData;
+  return StatFile(Path, &statData) && IsDirectory(statData);
+}
+
+bool FileSystemIndex::GetRelativePath(String& destination, const char* path) const
+{
+  if (path[0] == '\0' || m_rootPath.IsEmpty())
+    return false;
+
+  CanonicalizeIndexPath(destination, path);
+
+  // a root of "." canonicalizes to nothing, every relative path is under it
+  uint32 rootLength = m_canonicalRootPath.GetLength();
+  if (rootLength == 0)
+  {
+    bool absolute = (destination[0] == '/' || (destination.GetLength() > 1 && destination[1] == ':'));
+    bool outside = (destination.StartsWith("..") && (destination.GetLength() == 2 || destination[2] == '/'));
+    return !absolute && !outside;
+  }
+
+#if defined(Y_PLATFORM_WINDOWS)
+  bool matches = destination.StartsWith(m_canonicalRootPath, false);
+#else
+  bool matches = destination.StartsWith(m_canonicalRootPath, true);
+#endif
+  if (!matches)
+    return false;
+
+  if (destination.GetLength() == rootLength)
+  {
+    destination.Clear();
+    return true;
+  }
+
+  if (destination[rootLength] != '/' && m_canonicalRootPath[rootLength - 1] != '/')
+    return false;
+
+  destination.Erase(0, (m_canonicalRootPath[rootLength - 1] == '/') ? rootLength : rootLength + 1);
+  return true;
+}
+
+void FileSystemIndex::GetFullPath(String& destination, const String& relativePath) const
+{
+  if (relativePath.GetLength() == 0)
+    destination.Assign(m_rootPath);
+  else
+    destination.Format("%s/%s", m_rootPath.GetCharArray(), relativePath.GetCharArray());
+}
+
+uint32 FileSystemIndex::FindNode(const String& relativePath) const
+{
+  const PathTable::Member* pMember = m_pathTable.Find(relativePath);
+  return (pMember != nullptr) ? pMember->Value : InvalidNode;
+}
+
+uint32 FileSystemIndex::GetOrCreateNode(const String& relativePath, bool* pCreated)
+{
+  uint32 nodeIndex = FindNode(relativePath);
+  *pCreated = (nodeIndex == InvalidNode);
+  if (nodeIndex != InvalidNode)
+    return nodeIndex;
+
+  // parents found after their children start out as directories, and are filled in when they turn up
+  int32 separatorPosition = relativePath.RFind('/');
+  uint32 parentIndex = RootNode;
+  if (separatorPosition >= 0)
+  {
+    bool parentCreated;
+    PathString parentPath;
+    parentPath.AppendSubString(relativePath, 0, separatorPosition);
+    parentIndex = GetOrCreateNode(parentPath, &parentCreated);
+  }
+
+  if (m_freeNodes.GetSize() > 0)
+  {
+    nodeIndex = m_freeNodes.PopBack();
+  }
+  else
+  {
+    nodeIndex = m_nodes.GetSize();
+    m_nodes.Add(Node());
+  }
+
+  Node& node = m_nodes[nodeIndex];
+  node.Path = relativePath;
+  node.NameOffset = (uint32)(separatorPosition + 1);
+  node.StatData.Attributes = FILESYSTEM_FILE_ATTRIBUTE_DIRECTORY;
+  node.StatData.ModificationTime.SetUnixTimestamp(0);
+  node.StatData.Size = 0;
+  node.ReadTime = 0;
+  node.Parent = parentIndex;
+  node.FirstChild = InvalidNode;
+  node.PreviousSibling = InvalidNode;
+  node.NextSibling = m_nodes[parentIndex].FirstChild;
+  if (node.NextSibling != InvalidNode)
+    m_nodes[node.NextSibling].PreviousSibling = nodeIndex;
+  m_nodes[parentIndex].FirstChild = nodeIndex;
+
+  m_pathTable.Insert(node.Path, nodeIndex);
+  return nodeIndex;
+}
+
+void FileSystemIndex::RemoveNode(uint32 nodeIndex)
+{
+  DebugAssert(nodeIndex != RootNode);
+
+  // unlink it, then free it and everything below
+  Node& node = m_nodes[nodeIndex];
+  if (node.PreviousSibling != InvalidNode)
+    m_nodes[node.PreviousSibling].NextSibling = node.NextSibling;
+  else
+    m_nodes[node.Parent].FirstChild = node.NextSibling;
+  if (node.NextSibling != InvalidNode)
+    m_nodes[node.NextSibling].PreviousSibling = node.PreviousSibling;
+
+  PODArray<uint32> nodeStack;
+  nodeStack.Add(nodeIndex);
+  while (nodeStack.GetSize() > 0)
+  {
+    uint32 currentIndex = nodeStack.PopBack();
+    Node& currentNode = m_nodes[currentIndex];
+    for (uint32 childIndex = currentNode.FirstChild; childIndex != InvalidNode;
+         childIndex = m_nodes[childIndex].NextSibling)
+    {
+      nodeStack.Add(childIndex);
+    }
+
+    m_pathTable.Remove(currentNode.Path);
+    currentNode.Path.Obliterate();
+    currentNode.FirstChild = InvalidNode;
+    m_freeNodes.Add(currentIndex);
+  }
+}
+
+void FileSystemIndex::ResetNodes()
+{
+  m_nodes.Clear();
+  m_freeNodes.Clear();
+  m_pathTable.Clear();
+
+  Node root;
+  root.NameOffset = 0;
+  root.StatData.Attributes = FILESYSTEM_FILE_ATTRIBUTE_DIRECTORY;
+  root.StatData.ModificationTime.SetUnixTimestamp(0);
+  root.StatData.Size = 0;
+  root.ReadTime = 0;
+  root.Parent = InvalidNode;
+  root.FirstChild = InvalidNode;
+  root.NextSibling = InvalidNode;
+  root.PreviousSibling = InvalidNode;
+  m_nodes.Add(root);
+  m_pathTable.Insert(EmptyString, RootNode);
+}
+
+void FileSystemIndex::ScanTree(uint32 nodeIndex, ThreadPool* pThreadPool)
+{
+  PathString fullPath;
+  PathString basePath(m_nodes[nodeIndex].Path);
+  GetFullPath(fullPath, basePath);
+
+  // matches come in from the pool's threads, the tree is only touched by one at a time
+  Mutex lock;
+  uint64 readTime = GetCurrentUnixTime();
+  FileSystem::FindFilesParallel(
+    fullPath, "*",
+    FILESYSTEM_FIND_RECURSIVE | FILESYSTEM_FIND_RELATIVE_PATHS | FILESYSTEM_FIND_HIDDEN_FILES |
+      FILESYSTEM_FIND_FOLDERS | FILESYSTEM_FIND_FILES,
+    pThreadPool, [this, &lock, &basePath, readTime](const FILESYSTEM_FIND_DATA* pFindData) {
+      PathString relativePath;
+      if (basePath.GetLength() > 0)
+        relativePath.Format("%s/%s", basePath.GetCharArray(), pFindData->FileName);
+      else
+        relativePath.Assign(pFindData->FileName);
+#if defined(Y_PLATFORM_WINDOWS)
+      relativePath.Replace('\\', '/');
+#endif
+
+      MutexLock locker(lock);
+      bool created;
+      Node& node = m_nodes[GetOrCreateNode(relativePath, &created)];
+      node.StatData.Attributes = pFindData->Attributes;
+      node.StatData.ModificationTime = pFindData->ModificationTime;
+      node.StatData.Size = pFindData->Size;
+      node.ReadTime = readTime;
+    });
+
+  m_nodes[nodeIndex].ReadTime = readTime;
+}
+
+void FileSystemIndex::SyncDirectory(uint32 nodeIndex, ThreadPool* pThreadPool)
+{
+  PathString fullPath;
+  GetFullPath(fullPath, m_nodes[nodeIndex].Path);
+
+  uint64 readTime = GetCurrentUnixTime();
+  FILESYSTEM_STAT_DATA statData;
+  FileSystem::FindResultsArray entries;
+  if (FileSystem::StatFile(fullPath, &statData))
+    m_nodes[nodeIndex].StatData = statData;
+  FileSystem::FindFilesParallel(
+    fullPath, "*",
+    FILESYSTEM_FIND_RELATIVE_PATHS | FILESYSTEM_FIND_HIDDEN_FILES | FILESYSTEM_FIND_FOLDERS | FILESYSTEM_FIND_FILES,
+    nullptr, [&entries](const FILESYSTEM_FIND_DATA* pFindData) { entries.Add(*pFindData); });
+
+  // drop children that have gone
+  PathTable entryNames;
+  for (uint32 i = 0; i < entries.GetSize(); i++)
+    entryNames.Insert(entries[i].FileName, i);
+  for (uint32 childIndex = m_nodes[nodeIndex].FirstChild; childIndex != InvalidNode;)
+  {
+    const Node& child = m_nodes[childIndex];
+    uint32 nextIndex = child.NextSibling;
+    if (entryNames.Find(child.Path.GetCharArray() + child.NameOffset) == nullptr)
+      RemoveNode(childIndex);
+
+    childIndex = nextIndex;
+  }
+
+  PathString relativePath;
+  for (uint32 i = 0; i < entries.GetSize(); i++)
+  {
+    const FILESYSTEM_FIND_DATA& entry = entries[i];
+    const String& directoryPath = m_nodes[nodeIndex].Path;
+    if (directoryPath.GetLength() > 0)
+      relativePath.Format("%s/%s", directoryPath.GetCharArray(), entry.FileName);
+    else
+      relativePath.Assign(entry.FileName);
+
+    // something replaced by something else of another type has nothing worth keeping
+    uint32 childIndex = FindNode(relativePath);
+    bool isDirectory = (entry.Attributes & FILESYSTEM_FILE_ATTRIBUTE_DIRECTORY) != 0;
+    if (childIndex != InvalidNode && IsDirectory(m_nodes[childIndex].StatData) != isDirectory)
+    {
+      RemoveNode(childIndex);
+      childIndex = InvalidNode;
+    }
+
+    bool created;
+    childIndex = GetOrCreateNode(relativePath, &created);
+    Node& child = m_nodes[childIndex];
+    child.StatData.Attributes = entry.Attributes;
+    child.StatData.ModificationTime = entry.ModificationTime;
+    child.StatData.Size = entry.Size;
+    if (created && isDirectory)
+      ScanTree(childIndex, pThreadPool);
+  }
+
+  m_nodes[nodeIndex].ReadTime = readTime;
+}
+
+void FileSystemIndex::RefreshPath(const String& relativePath, bool contentsChanged, ThreadPool* pThreadPool)
+{
+  PathString fullPath;
+  GetFullPath(fullPath, relativePath);
+
+  FILESYSTEM_STAT_DATA statData;
+  uint32 nodeIndex = FindNode(relativePath);
+  if (!FileSystem::StatFile(fullPath, &statData))
+  {
+    if (nodeIndex != InvalidNode && nodeIndex != RootNode)
+      RemoveNode(nodeIndex);
+
+    return;
+  }
+
+  if (nodeIndex == InvalidNode)
+  {
+    // a parent that isn't known yet brings this in with it
+    int32 separatorPosition = relativePath.RFind('/');
+    if (separatorPosition >= 0)
+    {
+      PathString parentPath;
+      parentPath.AppendSubString(relativePath, 0, separatorPosition);
+      if (FindNode(parentPath) == InvalidNode)
+      {
+        RefreshPath(parentPath, true, pThreadPool);
+        return;
+      }
+    }
+  }
+  else if (IsDirectory(m_nodes[nodeIndex].StatData) != IsDirectory(statData))
+  {
+    RemoveNode(nodeIndex);
+  }
+
+  bool created;
+  nodeIndex = GetOrCreateNode(relativePath, &created);
+  m_nodes[nodeIndex].StatData = statData;
+  if (IsDirectory(statData))
+  {
+    if (created)
+      ScanTree(nodeIndex, pThreadPool);
+    else if (contentsChanged)
+      SyncDirectory(nodeIndex, pThreadPool);
+  }
+}
+
+bool FileSystemIndex::StartWatching()
+{
+  m_pChangeNotifier = FileSystem::CreateChangeNotifier(m_rootPath, true);
+  return (m_pChangeNotifier != nullptr);
+}
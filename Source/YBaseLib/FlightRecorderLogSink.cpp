@@ -0,0 +1,386 @@
+#include "YBaseLib/FlightRecorderLogSink.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Timestamp.h"
+#include "YBaseLib/UnicodeConversion.h"
+Log_SetChannel(FlightRecorderLogSink);
+
+#if defined(Y_PLATFORM_WINDOWS)
+#include "YBaseLib/Windows/WindowsHeaders.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const uint32 FlightRecorderLogSink::DefaultLaneCount;
+const uint32 FlightRecorderLogSink::DefaultRecordsPerLane;
+const uint32 FlightRecorderLogSink::DefaultRecordSize;
+
+struct FlightRecorderFileHeader
+{
+  uint32 Magic;
+  uint32 Version;
+  uint32 LaneCount;
+  uint32 RecordsPerLane;
+  uint32 RecordSize;
+  uint32 Reserved;
+  double SecondsPerTick;
+  uint64 StartTimeStamp;
+  uint64 StartTime;
+  byte Padding[16];
+};
+
+// each lane's counter has a cache line of its own, so threads on different lanes never touch the same one
+struct FlightRecorderLaneHeader
+{
+  Y_ATOMIC_DECL64 int64 WriteIndex;
+  byte Padding[56];
+};
+
+// The sequence is the write index + 1, and is cleared before the rest is written and set after, so a record left
+// half written by the process stopping is recognizably torn.
+struct FlightRecorderRecordHeader
+{
+  Y_ATOMIC_DECL64 int64 Sequence;
+  uint64 TimeStamp;
+  uint32 Thread;
+  uint16 MessageLength;
+  uint8 ChannelLength;
+  uint8 FunctionLength;
+  uint8 Level;
+  uint8 Flags;
+  byte Padding[6];
+};
+
+static_assert(sizeof(FlightRecorderFileHeader) == 64, "file header is a cache line");
+static_assert(sizeof(FlightRecorderLaneHeader) == 64, "lane header is a cache line");
+static_assert(sizeof(FlightRecorderRecordHeader) == 32, "record header is 32 bytes");
+
+static const uint8 RecordFlagTruncated = 0x01;
+
+// longest channel and function names kept, the rest of a record is for the message
+static const uint32 MaxChannelLength = 32;
+static const uint32 MaxFunctionLength = 64;
+
+// numbered from 1 the first time a thread records a message, and which lane it writes to
+static Y_ATOMIC_DECL uint32 s_nextThreadNumber = 0;
+Y_DECLARE_THREAD_LOCAL(uint32) s_threadNumber = 0;
+
+// Creates the file at its full size, zero filled, and maps it shared, so the pages are the file's.
+static byte* CreateMappedFile(const char* fileName, uint64 size)
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  HANDLE hFile = CreateFileW(UTF16StackString<MAX_PATH>(fileName).GetWideCharArray(), GENERIC_READ | GENERIC_WRITE,
+                             FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hFile == INVALID_HANDLE_VALUE)
+    return nullptr;
+
+  // the view keeps the mapping and the file open
+  HANDLE hMapping =
+    CreateFileMappingW(hFile, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF), NULL);
+  CloseHandle(hFile);
+  if (hMapping == NULL)
+    return nullptr;
+
+  void* pView = MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)size);
+  CloseHandle(hMapping);
+  return static_cast<byte*>(pView);
+#else
+  int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return nullptr;
+
+  if (ftruncate(fd, (off_t)size) < 0)
+  {
+    close(fd);
+    return nullptr;
+  }
+
+  // the mapping holds its own reference to the file
+  void* pView = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  return (pView != MAP_FAILED) ? static_cast<byte*>(pView) : nullptr;
+#endif
+}
+
+static void UnmapFile(byte* pMapping, uint64 size)
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  UnmapViewOfFile(pMapping);
+#else
+  munmap(pMapping, (size_t)size);
+#endif
+}
+
+FlightRecorderLogSink::FlightRecorderLogSink()
+  : m_pMapping(nullptr), m_mappingSize(0), m_laneCount(0), m_recordsPerLane(0), m_recordSize(0), m_laneSize(0),
+    m_levelFilter(LOGLEVEL_TRACE)
+{
+}
+
+FlightRecorderLogSink::~FlightRecorderLogSink()
+{
+  Close();
+}
+
+bool FlightRecorderLogSink::Open(const char* fileName, uint32 laneCount /* = DefaultLaneCount */,
+                                 uint32 recordsPerLane /* = DefaultRecordsPerLane */,
+                                 uint32 recordSize /* = DefaultRecordSize */)
+{
+  Close();
+
+  // enough room for a short message, and no more than a record's lengths can describe
+  recordSize = Min(Max((recordSize + 7) & ~7u, 64u), (uint32)sizeof(FlightRecorderRecordHeader) + 0xFFF8u);
+  laneCount = Max(laneCount, 1u);
+  recordsPerLane = Max(recordsPerLane, 1u);
+
+  uint64 laneSize = sizeof(FlightRecorderLaneHeader) + (uint64)recordsPerLane * recordSize;
+  uint64 size = sizeof(FlightRecorderFileHeader) + laneCount * laneSize;
+  if (size > (uint64)SIZE_MAX)
+  {
+    Log_ErrorPrintf("FlightRecorderLogSink::Open: %llu bytes is too large to map", size);
+    return false;
+  }
+
+  byte* pMapping = CreateMappedFile(fileName, size);
+  if (pMapping == nullptr)
+  {
+    Log_ErrorPrintf("FlightRecorderLogSink::Open: Failed to create and map '%s'", fileName);
+    return false;
+  }
+
+  FlightRecorderFileHeader* pHeader = reinterpret_cast<FlightRecorderFileHeader*>(pMapping);
+  pHeader->Magic = FlightRecorder::Magic;
+  pHeader->Version = FlightRecorder::Version;
+  pHeader->LaneCount = laneCount;
+  pHeader->RecordsPerLane = recordsPerLane;
+  pHeader->RecordSize = recordSize;
+  pHeader->SecondsPerTick = Y_TimerConvertToSeconds(1);
+  pHeader->StartTimeStamp = (uint64)Y_TimerGetValue();
+  pHeader->StartTime = Timestamp::Now().AsUnixTimestamp();
+
+  m_pMapping = pMapping;
+  m_mappingSize = size;
+  m_laneCount = laneCount;
+  m_recordsPerLane = recordsPerLane;
+  m_recordSize = recordSize;
+  m_laneSize = laneSize;
+
+  Log::GetInstance().SetFlightRecorder(this);
+  return true;
+}
+
+void FlightRecorderLogSink::Close()
+{
+  if (m_pMapping == nullptr)
+    return;
+
+  Log::GetInstance().SetFlightRecorder(nullptr);
+
+  UnmapFile(m_pMapping, m_mappingSize);
+  m_pMapping = nullptr;
+  m_mappingSize = 0;
+}
+
+bool FlightRecorderLogSink::Flush()
+{
+  if (m_pMapping == nullptr)
+    return true;
+
+#if defined(Y_PLATFORM_WINDOWS)
+  return (FlushViewOfFile(m_pMapping, 0) != FALSE);
+#else
+  return (msync(m_pMapping, (size_t)m_mappingSize, MS_SYNC) == 0);
+#endif
+}
+
+void FlightRecorderLogSink::Record(const char* channelName, const char* functionName, LOGLEVEL level,
+                                   const char* message, uint32 messageLength)
+{
+  if (level > m_levelFilter)
+    return;
+
+  uint32 thread = s_threadNumber;
+  if (thread == 0)
+  {
+    thread = Y_AtomicIncrement(s_nextThreadNumber);
+    s_threadNumber = thread;
+  }
+
+  // only threads sharing the lane ever take from its counter
+  byte* pLane = m_pMapping + sizeof(FlightRecorderFileHeader) + ((thread - 1) % m_laneCount) * m_laneSize;
+  FlightRecorderLaneHeader* pLaneHeader = reinterpret_cast<FlightRecorderLaneHeader*>(pLane);
+  int64 index = Y_AtomicIncrement(pLaneHeader->WriteIndex) - 1;
+  FlightRecorderRecordHeader* pRecord = reinterpret_cast<FlightRecorderRecordHeader*>(
+    pLane + sizeof(FlightRecorderLaneHeader) + (uint64)index % m_recordsPerLane * m_recordSize);
+
+  Y_AtomicStore(pRecord->Sequence, (int64)0);
+
+  char* pText = reinterpret_cast<char*>(pRecord + 1);
+  uint32 space = m_recordSize - sizeof(FlightRecorderRecordHeader);
+  uint32 channelLength = Min(Y_strlen(channelName), MaxChannelLength);
+  uint32 functionLength = (functionName != nullptr) ? Min(Y_strlen(functionName), MaxFunctionLength) : 0;
+  functionLength = Min(functionLength, space - channelLength);
+  uint32 length = Min(messageLength, space - channelLength - functionLength);
+  std::memcpy(pText, channelName, channelLength);
+  std::memcpy(pText + channelLength, functionName, functionLength);
+  std::memcpy(pText + channelLength + functionLength, message, length);
+
+  pRecord->TimeStamp = (uint64)Y_TimerGetValue();
+  pRecord->Thread = thread;
+  pRecord->MessageLength = (uint16)length;
+  pRecord->ChannelLength = (uint8)channelLength;
+  pRecord->FunctionLength = (uint8)functionLength;
+  pRecord->Level = (uint8)level;
+  pRecord->Flags = (length < messageLength) ? RecordFlagTruncated : 0;
+
+  Y_AtomicStoreRelease(pRecord->Sequence, index + 1);
+}
+
+FlightRecorderReader::FlightRecorderReader(ByteStream* pStream)
+  : m_pStream(pStream), m_nextRecord(0), m_recordSize(0), m_startTimeStamp(0), m_secondsPerTick(0.0),
+    m_startTime(0), m_tornRecordCount(0), m_loaded(false), m_damaged(false)
+{
+  m_pStream->AddRef();
+}
+
+FlightRecorderReader::~FlightRecorderReader()
+{
+  m_pStream->Release();
+}
+
+bool FlightRecorderReader::Load()
+{
+  m_loaded = true;
+
+  uint64 size = m_pStream->GetSize() - m_pStream->GetPosition();
+  if (size < sizeof(FlightRecorderFileHeader) || size > 0xFFFFFFFFull)
+  {
+    m_damaged = true;
+    return false;
+  }
+
+  m_data.Resize((uint32)size);
+  if (!m_pStream->Read2(m_data.GetBasePointer(), (uint32)size))
+  {
+    m_damaged = true;
+    return false;
+  }
+
+  FlightRecorderFileHeader header;
+  std::memcpy(&header, m_data.GetBasePointer(), sizeof(header));
+  uint64 laneSize = sizeof(FlightRecorderLaneHeader) + (uint64)header.RecordsPerLane * header.RecordSize;
+  if (header.Magic != FlightRecorder::Magic || header.Version != FlightRecorder::Version || header.LaneCount == 0 ||
+      header.RecordSize < 64 || (header.RecordSize % 8) != 0 ||
+      size < sizeof(FlightRecorderFileHeader) + header.LaneCount * laneSize)
+  {
+    m_damaged = true;
+    return false;
+  }
+
+  m_recordSize = header.RecordSize;
+  m_startTimeStamp = (Y_TIMER_VALUE)header.StartTimeStamp;
+  m_secondsPerTick = header.SecondsPerTick;
+  m_startTime = header.StartTime;
+
+  uint32 space = header.RecordSize - sizeof(FlightRecorderRecordHeader);
+  for (uint32 lane = 0; lane < header.LaneCount; lane++)
+  {
+    uint32 laneOffset = (uint32)(sizeof(FlightRecorderFileHeader) + lane * laneSize);
+    const FlightRecorderLaneHeader* pLaneHeader =
+      reinterpret_cast<const FlightRecorderLaneHeader*>(m_data.GetBasePointer() + laneOffset);
+    uint64 writeIndex = (uint64)pLaneHeader->WriteIndex;
+
+    for (uint32 slot = 0; slot < header.RecordsPerLane; slot++)
+    {
+      uint32 offset = laneOffset + sizeof(FlightRecorderLaneHeader) + slot * header.RecordSize;
+      const FlightRecorderRecordHeader* pRecord =
+        reinterpret_cast<const FlightRecorderRecordHeader*>(m_data.GetBasePointer() + offset);
+
+      // never written
+      uint64 sequence = (uint64)pRecord->Sequence;
+      if (sequence == 0 && pRecord->TimeStamp == 0)
+        continue;
+
+      // cleared and not yet set again, or not belonging where it is
+      if (sequence == 0 || sequence > writeIndex || (sequence - 1) % header.RecordsPerLane != slot ||
+          pRecord->Level >= LOGLEVEL_COUNT ||
+          (uint32)pRecord->ChannelLength + pRecord->FunctionLength + pRecord->MessageLength > space)
+      {
+        m_tornRecordCount++;
+        continue;
+      }
+
+      RecordReference reference;
+      reference.TimeStamp = pRecord->TimeStamp;
+      reference.Sequence = sequence;
+      reference.Offset = offset;
+      m_records.Add(reference);
+    }
+  }
+
+  // threads' clocks agree, and a lane's own messages are in sequence order whatever their times
+  m_records.SortCB([](const RecordReference& left, const RecordReference& right) {
+    if (left.TimeStamp != right.TimeStamp)
+      return (left.TimeStamp < right.TimeStamp) ? -1 : 1;
+    return (left.Sequence < right.Sequence) ? -1 : ((left.Sequence > right.Sequence) ? 1 : 0);
+  });
+
+  return true;
+}
+
+bool FlightRecorderReader::ReadMessage(Message* pMessage)
+{
+  if (!m_loaded && !Load())
+    return false;
+
+  if (m_nextRecord == m_records.GetSize())
+    return false;
+
+  const RecordReference& reference = m_records[m_nextRecord++];
+  const FlightRecorderRecordHeader* pRecord =
+    reinterpret_cast<const FlightRecorderRecordHeader*>(m_data.GetBasePointer() + reference.Offset);
+  const char* pText = reinterpret_cast<const char*>(pRecord + 1);
+
+  pMessage->ChannelName.Clear();
+  pMessage->ChannelName.AppendString(pText, pRecord->ChannelLength);
+  pMessage->FunctionName.Clear();
+  pMessage->FunctionName.AppendString(pText + pRecord->ChannelLength, pRecord->FunctionLength);
+  pMessage->Level = (LOGLEVEL)pRecord->Level;
+  pMessage->Time = (double)(int64)(reference.TimeStamp - (uint64)m_startTimeStamp) * m_secondsPerTick;
+  pMessage->Thread = pRecord->Thread;
+  pMessage->Truncated = ((pRecord->Flags & RecordFlagTruncated) != 0);
+  pMessage->Text.Clear();
+  pMessage->Text.AppendString(pText + pRecord->ChannelLength + pRecord->FunctionLength, pRecord->MessageLength);
+  return true;
+}
+
+bool FlightRecorderReader::DecodeToText(ByteStream* pInput, ByteStream* pOutput)
+{
+  FlightRecorderReader reader(pInput);
+  Message message;
+  String line;
+  bool written = true;
+  while (written && reader.ReadMessage(&message))
+  {
+    if (line.IsEmpty())
+    {
+      line.Format("Flight recording started at unix time %llu, %u torn records skipped\n", reader.GetStartTime(),
+                  reader.GetTornRecordCount());
+      written = pOutput->Write2(line.GetCharArray(), line.GetLength());
+    }
+
+    line.Clear();
+    Log::FormatLogMessageForDisplay(
+      message.ChannelName, message.FunctionName, message.Level, message.Time, message.Text,
+      [](const char* text, void* pLine) { static_cast<String*>(pLine)->AppendString(text); }, &line);
+    line.AppendString(message.Truncated ? "...\n" : "\n");
+    written = written && pOutput->Write2(line.GetCharArray(), line.GetLength());
+  }
+
+  return (written && !reader.IsDamaged());
+}
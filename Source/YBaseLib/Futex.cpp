@@ -0,0 +1,154 @@
+#include "YBaseLib/Futex.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/ConditionVariable.h"
+#include "YBaseLib/Mutex.h"
+
+#if defined(Y_PLATFORM_LINUX) || defined(Y_PLATFORM_ANDROID)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define Y_FUTEX_NATIVE 1
+#elif defined(Y_PLATFORM_WINDOWS)
+#include "YBaseLib/Windows/WindowsHeaders.h"
+#endif
+
+#if !defined(Y_FUTEX_NATIVE)
+
+// Each bucket is shared by every address hashing to it, so wakes go to all its sleepers and those waiting on
+// other addresses just see a spurious wakeup.
+struct FutexBucket
+{
+  Mutex Lock;
+  ConditionVariable Sleepers;
+};
+
+static const uint32 FutexBucketCount = 64;
+
+static FutexBucket* GetFutexBucket(volatile uint32* pAddress)
+{
+  static FutexBucket buckets[FutexBucketCount];
+  return &buckets[(reinterpret_cast<size_t>(pAddress) >> 2) % FutexBucketCount];
+}
+
+static void FutexBucketWait(volatile uint32* pAddress, uint32 expectedValue)
+{
+  // the wake takes the lock after the value has changed, so the check here can't miss it
+  FutexBucket* pBucket = GetFutexBucket(pAddress);
+  pBucket->Lock.Lock();
+  if (Y_AtomicLoad(*pAddress) == expectedValue)
+    pBucket->Sleepers.SleepAndRelease(&pBucket->Lock);
+  pBucket->Lock.Unlock();
+}
+
+static void FutexBucketWake(volatile uint32* pAddress)
+{
+  FutexBucket* pBucket = GetFutexBucket(pAddress);
+  pBucket->Lock.Lock();
+  pBucket->Sleepers.WakeAll();
+  pBucket->Lock.Unlock();
+}
+
+#endif
+
+#if defined(Y_FUTEX_NATIVE)
+
+static void Futex(volatile uint32* pAddress, int operation, uint32 value)
+{
+  syscall(SYS_futex, pAddress, operation, value, nullptr, nullptr, 0);
+}
+
+void Y_FutexWait(volatile uint32* pAddress, uint32 expectedValue)
+{
+  Futex(pAddress, FUTEX_WAIT_PRIVATE, expectedValue);
+}
+
+void Y_FutexWakeOne(volatile uint32* pAddress)
+{
+  Futex(pAddress, FUTEX_WAKE_PRIVATE, 1);
+}
+
+void Y_FutexWakeAll(volatile uint32* pAddress)
+{
+  Futex(pAddress, FUTEX_WAKE_PRIVATE, INT_MAX);
+}
+
+#elif defined(Y_PLATFORM_WINDOWS)
+
+// WaitOnAddress is Windows 8 and up, and the headers are built for Vista, so it's looked up at runtime.
+typedef BOOL(WINAPI* WaitOnAddressFunction)(volatile VOID*, PVOID, SIZE_T, DWORD);
+typedef VOID(WINAPI* WakeByAddressFunction)(PVOID);
+
+struct WaitOnAddressFunctions
+{
+  WaitOnAddressFunction pWaitOnAddress;
+  WakeByAddressFunction pWakeByAddressSingle;
+  WakeByAddressFunction pWakeByAddressAll;
+
+  WaitOnAddressFunctions() : pWaitOnAddress(nullptr), pWakeByAddressSingle(nullptr), pWakeByAddressAll(nullptr)
+  {
+    HMODULE hModule = GetModuleHandleA("api-ms-win-core-synch-l1-2-0.dll");
+    if (hModule == NULL)
+      hModule = LoadLibraryA("api-ms-win-core-synch-l1-2-0.dll");
+    if (hModule == NULL)
+      return;
+
+    pWaitOnAddress = reinterpret_cast<WaitOnAddressFunction>(GetProcAddress(hModule, "WaitOnAddress"));
+    pWakeByAddressSingle = reinterpret_cast<WakeByAddressFunction>(GetProcAddress(hModule, "WakeByAddressSingle"));
+    pWakeByAddressAll = reinterpret_cast<WakeByAddressFunction>(GetProcAddress(hModule, "WakeByAddressAll"));
+    if (pWaitOnAddress == nullptr || pWakeByAddressSingle == nullptr || pWakeByAddressAll == nullptr)
+      pWaitOnAddress = nullptr;
+  }
+};
+
+static const WaitOnAddressFunctions& GetWaitOnAddressFunctions()
+{
+  static const WaitOnAddressFunctions functions;
+  return functions;
+}
+
+void Y_FutexWait(volatile uint32* pAddress, uint32 expectedValue)
+{
+  const WaitOnAddressFunctions& functions = GetWaitOnAddressFunctions();
+  if (functions.pWaitOnAddress != nullptr)
+    functions.pWaitOnAddress(pAddress, &expectedValue, sizeof(expectedValue), INFINITE);
+  else
+    FutexBucketWait(pAddress, expectedValue);
+}
+
+void Y_FutexWakeOne(volatile uint32* pAddress)
+{
+  const WaitOnAddressFunctions& functions = GetWaitOnAddressFunctions();
+  if (functions.pWaitOnAddress != nullptr)
+    functions.pWakeByAddressSingle(const_cast<uint32*>(pAddress));
+  else
+    FutexBucketWake(pAddress);
+}
+
+void Y_FutexWakeAll(volatile uint32* pAddress)
+{
+  const WaitOnAddressFunctions& functions = GetWaitOnAddressFunctions();
+  if (functions.pWaitOnAddress != nullptr)
+    functions.pWakeByAddressAll(const_cast<uint32*>(pAddress));
+  else
+    FutexBucketWake(pAddress);
+}
+
+#else
+
+void Y_FutexWait(volatile uint32* pAddress, uint32 expectedValue)
+{
+  FutexBucketWait(pAddress, expectedValue);
+}
+
+void Y_FutexWakeOne(volatile uint32* pAddress)
+{
+  FutexBucketWake(pAddress);
+}
+
+void Y_FutexWakeAll(volatile uint32* pAddress)
+{
+  FutexBucketWake(pAddress);
+}
+
+#endif
@@ -0,0 +1,355 @@
+#include "YBaseLib/GlobPattern.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Memory.h"
+#include <cstring>
+
+GlobPattern::GlobPattern() : m_flags(0), m_matchesAll(false) {}
+
+GlobPattern::GlobPattern(const char* pattern, uint32 flags /* = 0 */) : m_flags(0), m_matchesAll(false)
+{
+  Compile(pattern, flags);
+}
+
+void GlobPattern::Compile(const char* pattern, uint32 flags /* = 0 */)
+{
+  Clear();
+  m_flags = flags;
+  AddPattern(pattern);
+}
+
+void GlobPattern::AddPattern(const char* pattern)
+{
+  const char* pCurrent = pattern;
+  for (;;)
+  {
+    const char* pEnd = Y_strchr(pCurrent, ';');
+    uint32 length = (pEnd != nullptr) ? (uint32)(pEnd - pCurrent) : Y_strlen(pCurrent);
+    if (length > 0)
+      AddAlternative(pCurrent, length);
+
+    if (pEnd == nullptr)
+      break;
+
+    pCurrent = pEnd + 1;
+  }
+}
+
+void GlobPattern::Clear()
+{
+  m_alternatives.Clear();
+  m_tokens.Clear();
+  m_classes.Clear();
+  m_literals.Clear();
+  m_matchesAll = false;
+}
+
+bool GlobPattern::Match(const StringView& subject) const
+{
+  for (uint32 i = 0; i < m_alternatives.GetSize(); i++)
+  {
+    if (MatchAlternative(m_alternatives[i], subject.GetData(), subject.GetLength()))
+      return true;
+  }
+
+  return false;
+}
+
+void GlobPattern::AddAlternative(const char* pattern, uint32 length)
+{
+  PODArray<Token> tokens;
+  for (uint32 i = 0; i < length;)
+  {
+    Token token;
+    token.Character = 0;
+    token.ClassIndex = 0;
+
+    char ch = pattern[i];
+    if (ch == '*')
+    {
+      // any run of stars is one, and a globstar if two or more are together
+      uint32 starCount = 0;
+      for (; i < length && pattern[i] == '*'; i++)
+        starCount++;
+
+      token.Type = (starCount > 1) ? TOKEN_GLOBSTAR : TOKEN_STAR;
+      Token* pLastToken = (tokens.GetSize() > 0) ? &tokens.LastElement() : nullptr;
+      if (pLastToken != nullptr && (pLastToken->Type == TOKEN_STAR || pLastToken->Type == TOKEN_GLOBSTAR))
+      {
+        if (token.Type == TOKEN_GLOBSTAR)
+          pLastToken->Type = TOKEN_GLOBSTAR;
+
+        continue;
+      }
+
+      tokens.Add(token);
+      continue;
+    }
+
+    if (ch == '?')
+    {
+      token.Type = TOKEN_ANY;
+      tokens.Add(token);
+      i++;
+      continue;
+    }
+
+    if (ch == '[')
+    {
+      CharacterClass characterClass;
+      uint32 classLength = ParseClass(pattern + i, length - i, &characterClass);
+      if (classLength > 0)
+      {
+        token.Type = TOKEN_CLASS;
+        token.ClassIndex = (uint16)m_classes.GetSize();
+        m_classes.Add(characterClass);
+        tokens.Add(token);
+        i += classLength;
+        continue;
+      }
+    }
+
+    token.Type = TOKEN_CHARACTER;
+    token.Character = FoldCharacter(ch);
+    tokens.Add(token);
+    i++;
+  }
+
+  // split off the characters at either end
+  uint32 prefixLength = 0;
+  while (prefixLength < tokens.GetSize() && tokens[prefixLength].Type == TOKEN_CHARACTER)
+    prefixLength++;
+
+  uint32 suffixLength = 0;
+  while ((prefixLength + suffixLength) < tokens.GetSize() &&
+         tokens[tokens.GetSize() - suffixLength - 1].Type == TOKEN_CHARACTER)
+  {
+    suffixLength++;
+  }
+
+  Alternative alternative;
+  alternative.PrefixOffset = m_literals.GetSize();
+  alternative.PrefixLength = prefixLength;
+  for (uint32 i = 0; i < prefixLength; i++)
+    m_literals.Add(tokens[i].Character);
+
+  alternative.SuffixOffset = m_literals.GetSize();
+  alternative.SuffixLength = suffixLength;
+  for (uint32 i = tokens.GetSize() - suffixLength; i < tokens.GetSize(); i++)
+    m_literals.Add(tokens[i].Character);
+
+  alternative.FirstToken = m_tokens.GetSize();
+  alternative.TokenCount = tokens.GetSize() - prefixLength - suffixLength;
+  alternative.MinimumLength = prefixLength + suffixLength;
+  alternative.HasWildCards = (alternative.TokenCount > 0);
+  for (uint32 i = prefixLength; i < (tokens.GetSize() - suffixLength); i++)
+  {
+    const Token& token = tokens[i];
+    if (token.Type != TOKEN_STAR && token.Type != TOKEN_GLOBSTAR)
+      alternative.MinimumLength++;
+
+    m_tokens.Add(token);
+  }
+
+  if (prefixLength == 0 && suffixLength == 0 && alternative.TokenCount == 1 &&
+      (tokens[0].Type == TOKEN_STAR || tokens[0].Type == TOKEN_GLOBSTAR))
+  {
+    m_matchesAll = true;
+  }
+
+  m_alternatives.Add(alternative);
+}
+
+uint32 GlobPattern::ParseClass(const char* pattern, uint32 length, CharacterClass* pClass) const
+{
+  DebugAssert(length > 0 && pattern[0] == '[');
+  Y_memzero(pClass, sizeof(CharacterClass));
+
+  uint32 i = 1;
+  bool negate = (i < length && (pattern[i] == '!' || pattern[i] == '^'));
+  if (negate)
+    i++;
+
+  // a ']' straight after the '[' is one of the characters
+  uint32 firstCharacter = i;
+  for (; i < length; i++)
+  {
+    byte ch = (byte)pattern[i];
+    if (ch == ']' && i != firstCharacter)
+      break;
+
+    byte lastCh = ch;
+    if ((i + 2) < length && pattern[i + 1] == '-' && pattern[i + 2] != ']')
+    {
+      lastCh = (byte)pattern[i + 2];
+      i += 2;
+    }
+
+    for (uint32 classCh = ch; classCh <= lastCh; classCh++)
+      pClass->Bits[classCh >> 5] |= (1u << (classCh & 31));
+  }
+
+  if (i == length)
+    return 0;
+
+  if (negate)
+  {
+    for (uint32 j = 0; j < countof(pClass->Bits); j++)
+      pClass->Bits[j] = ~pClass->Bits[j];
+  }
+
+  // names are compared folded, so the class has to hold the folded characters too
+  if (m_flags & FLAG_CASE_INSENSITIVE)
+  {
+    for (uint32 classCh = 0; classCh < 256; classCh++)
+    {
+      if (pClass->Bits[classCh >> 5] & (1u << (classCh & 31)))
+      {
+        byte foldedCh = (byte)Y_tolower((char)classCh);
+        pClass->Bits[foldedCh >> 5] |= (1u << (foldedCh & 31));
+      }
+    }
+  }
+
+  // separators only match globstars
+  pClass->Bits['/' >> 5] &= ~(1u << ('/' & 31));
+  return i + 1;
+}
+
+bool GlobPattern::MatchAlternative(const Alternative& alternative, const char* subject, uint32 length) const
+{
+  if (length < alternative.MinimumLength)
+    return false;
+
+  if (alternative.PrefixLength > 0 &&
+      !CompareCharacters(subject, m_literals.GetBasePointer() + alternative.PrefixOffset, alternative.PrefixLength))
+  {
+    return false;
+  }
+
+  if (!alternative.HasWildCards)
+    return (length == alternative.PrefixLength);
+
+  if (alternative.SuffixLength > 0 &&
+      !CompareCharacters(subject + length - alternative.SuffixLength,
+                         m_literals.GetBasePointer() + alternative.SuffixOffset, alternative.SuffixLength))
+  {
+    return false;
+  }
+
+  // a lone star in the middle takes whatever is left
+  const char* middle = subject + alternative.PrefixLength;
+  uint32 middleLength = length - alternative.PrefixLength - alternative.SuffixLength;
+  if (alternative.TokenCount == 1)
+  {
+    uint8 type = m_tokens[alternative.FirstToken].Type;
+    if (type == TOKEN_GLOBSTAR)
+      return true;
+    else if (type == TOKEN_STAR)
+      return (std::memchr(middle, '/', middleLength) == nullptr);
+  }
+
+  return MatchTokens(alternative, middle, middleLength);
+}
+
+bool GlobPattern::MatchTokens(const Alternative& alternative, const char* subject, uint32 length) const
+{
+  // state i means the first i tokens have matched, state TokenCount is a match. stars keep their state as they
+  // take characters, and also pass it on to the next state without taking any.
+  const Token* pTokens = m_tokens.GetBasePointer() + alternative.FirstToken;
+  uint32 tokenCount = alternative.TokenCount;
+  uint32 wordCount = (tokenCount + 1 + 63) / 64;
+  uint64* pStates = (uint64*)alloca(sizeof(uint64) * wordCount * 2);
+  uint64* pNextStates = pStates + wordCount;
+  Y_memzero(pStates, sizeof(uint64) * wordCount);
+  pStates[0] = 1;
+
+#define STATE_SET(states, index) ((states[(index) >> 6] & (uint64(1) << ((index)&63))) != 0)
+#define SET_STATE(states, index) states[(index) >> 6] |= (uint64(1) << ((index)&63))
+
+  for (uint32 i = 0; i < tokenCount; i++)
+  {
+    if (STATE_SET(pStates, i) && (pTokens[i].Type == TOKEN_STAR || pTokens[i].Type == TOKEN_GLOBSTAR))
+      SET_STATE(pStates, i + 1);
+  }
+
+  for (uint32 position = 0; position < length; position++)
+  {
+    char ch = FoldCharacter(subject[position]);
+    bool anyState = false;
+    Y_memzero(pNextStates, sizeof(uint64) * wordCount);
+    for (uint32 i = 0; i < tokenCount; i++)
+    {
+      if (!STATE_SET(pStates, i))
+        continue;
+
+      const Token& token = pTokens[i];
+      switch (token.Type)
+      {
+        case TOKEN_CHARACTER:
+          if (ch == token.Character)
+            SET_STATE(pNextStates, i + 1);
+          break;
+
+        case TOKEN_ANY:
+          if (ch != '/')
+            SET_STATE(pNextStates, i + 1);
+          break;
+
+        case TOKEN_CLASS:
+        {
+          const CharacterClass& characterClass = m_classes[token.ClassIndex];
+          byte classCh = (byte)ch;
+          if (characterClass.Bits[classCh >> 5] & (1u << (classCh & 31)))
+            SET_STATE(pNextStates, i + 1);
+        }
+        break;
+
+        case TOKEN_STAR:
+          if (ch != '/')
+            SET_STATE(pNextStates, i);
+          break;
+
+        case TOKEN_GLOBSTAR:
+          SET_STATE(pNextStates, i);
+          break;
+      }
+    }
+
+    for (uint32 i = 0; i <= tokenCount; i++)
+    {
+      if (!STATE_SET(pNextStates, i))
+        continue;
+
+      anyState = true;
+      if (i < tokenCount && (pTokens[i].Type == TOKEN_STAR || pTokens[i].Type == TOKEN_GLOBSTAR))
+        SET_STATE(pNextStates, i + 1);
+    }
+
+    if (!anyState)
+      return false;
+
+    uint64* pTemp = pStates;
+    pStates = pNextStates;
+    pNextStates = pTemp;
+  }
+
+  bool matched = STATE_SET(pStates, tokenCount);
+
+#undef SET_STATE
+#undef STATE_SET
+
+  return matched;
+}
+
+bool GlobPattern::CompareCharacters(const char* left, const char* right, uint32 length) const
+{
+  if (m_flags & FLAG_CASE_INSENSITIVE)
+    return (Y_strnicmp(left, right, length) == 0);
+  else
+    return (std::memcmp(left, right, length) == 0);
+}
+
+char GlobPattern::FoldCharacter(char ch) const
+{
+  return (m_flags & FLAG_CASE_INSENSITIVE) ? Y_tolower(ch) : ch;
+}
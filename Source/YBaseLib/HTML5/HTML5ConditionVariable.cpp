@@ -21,6 +21,18 @@ void ConditionVariable::SleepAndRelease(RecursiveMutex* pMutex)
   Log_WarningPrintf("ConditionVariable::SleepAndRelease unimplemented on HTML5.");
 }
 
+bool ConditionVariable::SleepAndRelease(Mutex* pMutex, uint32 timeout)
+{
+  Log_WarningPrintf("ConditionVariable::SleepAndRelease unimplemented on HTML5.");
+  return false;
+}
+
+bool ConditionVariable::SleepAndRelease(RecursiveMutex* pMutex, uint32 timeout)
+{
+  Log_WarningPrintf("ConditionVariable::SleepAndRelease unimplemented on HTML5.");
+  return false;
+}
+
 void ConditionVariable::WakeAll()
 {
   Log_WarningPrintf("ConditionVariable::WakeAll unimplemented on HTML5.");
@@ -30,4 +30,44 @@ size_t Platform::GetProgramMemoryUsage()
   return 0;
 }
 
+// no virtual memory to map twice
+void* Platform::AllocateMirroredMemory(size_t size)
+{
+  return nullptr;
+}
+
+void Platform::FreeMirroredMemory(void* pMemory, size_t size) {}
+
+size_t Platform::GetMirroredMemoryGranularity()
+{
+  return 65536;
+}
+
+// nor to reserve
+void* Platform::ReserveVirtualMemory(size_t size, uint32 flags)
+{
+  return nullptr;
+}
+
+bool Platform::CommitVirtualMemory(void* pMemory, size_t size)
+{
+  return false;
+}
+
+void Platform::DecommitVirtualMemory(void* pMemory, size_t size) {}
+
+void Platform::ReleaseVirtualMemory(void* pMemory, size_t size) {}
+
+size_t Platform::GetVirtualMemoryPageSize()
+{
+  return 65536;
+}
+
+void Platform::AdviseMemory(void* pMemory, size_t size, uint32 flags) {}
+
+uint32 Platform::CaptureCallStack(void** ppFrames, uint32 maxFrames, uint32 skipFrames)
+{
+  return 0;
+}
+
 #endif // Y_PLATFORM_POSIX
@@ -48,6 +48,11 @@ int Thread::ThreadEntryPoint()
   return 0;
 }
 
+bool Thread::SetAffinityMask(uint64 mask)
+{
+  return false;
+}
+
 void Thread::SetDebugName(const char* threadName) {}
 
 Thread::ThreadIdType Thread::GetCurrentThreadId()
@@ -64,4 +69,9 @@ void Thread::Sleep(uint32 millisecondsToSleep)
   // usleep(millisecondsToSleep * 1000);
 }
 
+bool Thread::SetCurrentThreadAffinityMask(uint64 mask)
+{
+  return false;
+}
+
 #endif
@@ -1,48 +1,237 @@
 #include "YBaseLib/HashTrait.h"
 #include "YBaseLib/CString.h"
+#include "YBaseLib/Memory.h"
 #include "YBaseLib/String.h"
 
+#if defined(Y_COMPILER_MSVC) && defined(Y_CPU_X64)
+#include <intrin.h>
+#pragma intrinsic(_umul128)
+#endif
+
+// wyhash constants
+static const uint64 s_hashSecret[4] = {0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL,
+                                       0x589965cc75374cc3ULL};
+
+// full 64x64->128 multiply, low half in *pA and high half in *pB
+static inline void HashMultiply(uint64* pA, uint64* pB)
+{
+#if (defined(Y_COMPILER_GCC) || defined(Y_COMPILER_CLANG)) && (defined(Y_CPU_X64) || defined(Y_CPU_AARCH64))
+  __uint128_t product = (__uint128_t)*pA * *pB;
+  *pA = (uint64)product;
+  *pB = (uint64)(product >> 64);
+#elif defined(Y_COMPILER_MSVC) && defined(Y_CPU_X64)
+  *pA = _umul128(*pA, *pB, pB);
+#else
+  uint64 high_a = *pA >> 32, high_b = *pB >> 32, low_a = (uint32)*pA, low_b = (uint32)*pB;
+  uint64 high = high_a * high_b, middle_0 = high_a * low_b, middle_1 = low_a * high_b, low = low_a * low_b;
+  uint64 carry = ((uint64)(uint32)middle_0 + (uint64)(uint32)middle_1 + (low >> 32)) >> 32;
+  uint64 productLow = low + (middle_0 << 32);
+  productLow += (middle_1 << 32);
+  *pA = productLow;
+  *pB = high + (middle_0 >> 32) + (middle_1 >> 32) + carry;
+#endif
+}
+
+static inline uint64 HashMix(uint64 a, uint64 b)
+{
+  HashMultiply(&a, &b);
+  return a ^ b;
+}
+
+// unaligned native-endian reads, the hash only has to be consistent within a process
+static inline uint64 HashRead64(const byte* p)
+{
+  uint64 value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+static inline uint64 HashRead32(const byte* p)
+{
+  uint32 value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+static inline uint64 HashRead3(const byte* p, size_t length)
+{
+  return ((uint64)p[0] << 16) | ((uint64)p[length >> 1] << 8) | p[length - 1];
+}
+
+uint64 Y_HashBytes64(const void* pData, size_t length, uint64 seed)
+{
+  const byte* p = reinterpret_cast<const byte*>(pData);
+  seed ^= HashMix(seed ^ s_hashSecret[0], s_hashSecret[1]);
+
+  uint64 a, b;
+  if (length <= 16)
+  {
+    // short keys are read as two possibly-overlapping halves
+    if (length >= 4)
+    {
+      size_t offset = (length >> 3) << 2;
+      a = (HashRead32(p) << 32) | HashRead32(p + offset);
+      b = (HashRead32(p + length - 4) << 32) | HashRead32(p + length - 4 - offset);
+    }
+    else if (length > 0)
+    {
+      a = HashRead3(p, length);
+      b = 0;
+    }
+    else
+    {
+      a = b = 0;
+    }
+  }
+  else
+  {
+    size_t remaining = length;
+    if (remaining > 48)
+    {
+      // three independent lanes
+      uint64 lane1 = seed, lane2 = seed;
+      do
+      {
+        seed = HashMix(HashRead64(p) ^ s_hashSecret[1], HashRead64(p + 8) ^ seed);
+        lane1 = HashMix(HashRead64(p + 16) ^ s_hashSecret[2], HashRead64(p + 24) ^ lane1);
+        lane2 = HashMix(HashRead64(p + 32) ^ s_hashSecret[3], HashRead64(p + 40) ^ lane2);
+        p += 48;
+        remaining -= 48;
+      } while (remaining > 48);
+      seed ^= lane1 ^ lane2;
+    }
+
+    while (remaining > 16)
+    {
+      seed = HashMix(HashRead64(p) ^ s_hashSecret[1], HashRead64(p + 8) ^ seed);
+      p += 16;
+      remaining -= 16;
+    }
+
+    // last 16 bytes, overlapping what has already been consumed
+    a = HashRead64(p + remaining - 16);
+    b = HashRead64(p + remaining - 8);
+  }
+
+  a ^= s_hashSecret[1];
+  b ^= seed;
+  HashMultiply(&a, &b);
+  return HashMix(a ^ s_hashSecret[0] ^ (uint64)length, b ^ s_hashSecret[1]);
+}
+
+uint64 Y_HashStringCaseInsensitive64(const char* pData, size_t length)
+{
+  // longer keys chain their blocks through the seed
+  char folded[256];
+  uint64 hash = 0;
+  do
+  {
+    size_t blockLength = Min(length, sizeof(folded));
+    Y_strlwrcpy(folded, pData, (uint32)blockLength);
+    hash = Y_HashBytes64(folded, blockLength, hash);
+    pData += blockLength;
+    length -= blockLength;
+  } while (length > 0);
+
+  return hash;
+}
+
+uint64 Y_HashInteger64(uint64 value)
+{
+  return HashMix(value ^ s_hashSecret[0], s_hashSecret[1]);
+}
+
+uint64 Y_HashFinalize64(uint64 hash)
+{
+  hash = (hash ^ (hash >> 33)) * 0xFF51AFD7ED558CCDULL;
+  hash = (hash ^ (hash >> 33)) * 0xC4CEB9FE1A85EC53ULL;
+  return hash ^ (hash >> 33);
+}
+
 HashType HashTrait<uint8>::GetHash(const uint8 Value)
 {
-  return (HashType)Value;
+  return Y_HashInteger(Value);
 }
 
 HashType HashTrait<uint16>::GetHash(const uint16 Value)
 {
-  return (HashType)Value;
+  return Y_HashInteger(Value);
 }
 
 HashType HashTrait<uint32>::GetHash(const uint32 Value)
 {
-  return (HashType)Value;
+  return Y_HashInteger(Value);
 }
 
 HashType HashTrait<uint64>::GetHash(const uint64 Value)
 {
-  return (HashType)((uint32)(Value & 0xffffffff) ^ ((uint32)(Value >> 32)));
+  return Y_HashInteger(Value);
 }
 
 HashType HashTrait<int8>::GetHash(const int8 Value)
 {
-  return (HashType)Value;
+  return Y_HashInteger((uint64)(int64)Value);
 }
 
 HashType HashTrait<int16>::GetHash(const int16 Value)
 {
-  return (HashType)Value;
+  return Y_HashInteger((uint64)(int64)Value);
 }
 
 HashType HashTrait<int32>::GetHash(const int32 Value)
 {
-  return (HashType)Value;
+  return Y_HashInteger((uint64)(int64)Value);
 }
 
 HashType HashTrait<int64>::GetHash(const int64 Value)
 {
-  return (HashType)((int32)(Value & 0xffffffff) ^ ((int32)(Value >> 32)));
+  return Y_HashInteger((uint64)Value);
 }
 
 HashType HashTrait<String>::GetHash(const String& Value)
+{
+  return Value.GetHash();
+}
+
+HashType LegacyHashTrait<uint8>::GetHash(const uint8 Value)
+{
+  return (HashType)Value;
+}
+
+HashType LegacyHashTrait<uint16>::GetHash(const uint16 Value)
+{
+  return (HashType)Value;
+}
+
+HashType LegacyHashTrait<uint32>::GetHash(const uint32 Value)
+{
+  return (HashType)Value;
+}
+
+HashType LegacyHashTrait<uint64>::GetHash(const uint64 Value)
+{
+  return (HashType)((uint32)(Value & 0xffffffff) ^ ((uint32)(Value >> 32)));
+}
+
+HashType LegacyHashTrait<int8>::GetHash(const int8 Value)
+{
+  return (HashType)Value;
+}
+
+HashType LegacyHashTrait<int16>::GetHash(const int16 Value)
+{
+  return (HashType)Value;
+}
+
+HashType LegacyHashTrait<int32>::GetHash(const int32 Value)
+{
+  return (HashType)Value;
+}
+
+HashType LegacyHashTrait<int64>::GetHash(const int64 Value)
+{
+  return (HashType)((int32)(Value & 0xffffffff) ^ ((int32)(Value >> 32)));
+}
+
+HashType LegacyHashTrait<String>::GetHash(const String& Value)
 {
   // http://en.wikipedia.org/wiki/Jenkins_hash_function
   uint32 hash = 0;
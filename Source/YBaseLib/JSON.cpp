@@ -0,0 +1,1078 @@
+#include "YBaseLib/JSON.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/NumberConversion.h"
+#include "YBaseLib/UnicodeConversion.h"
+#include <cmath>
+#include <cstring>
+Log_SetChannel(JSON);
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <emmintrin.h>
+#define Y_JSON_SSE2 1
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_JSON_NEON 1
+#endif
+
+// Most of a JSON document's bytes are in strings, and the only characters in a string that matter are the quote
+// ending it, backslashes and control characters, which the reader rejects and the writer escapes. Both look for them
+// 16 bytes at a time.
+static uint32 FindStringSpecial(const char* pText, uint32 length)
+{
+  uint32 i = 0;
+
+#if defined(Y_JSON_SSE2)
+  const __m128i quotes = _mm_set1_epi8('"');
+  const __m128i backslashes = _mm_set1_epi8('\\');
+  const __m128i controls = _mm_set1_epi8(0x1F);
+  for (; length - i >= 16; i += 16)
+  {
+    __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pText + i));
+    __m128i found = _mm_or_si128(_mm_cmpeq_epi8(chars, quotes), _mm_cmpeq_epi8(chars, backslashes));
+    found = _mm_or_si128(found, _mm_cmpeq_epi8(_mm_min_epu8(chars, controls), chars));
+    uint32 mask = uint32(_mm_movemask_epi8(found));
+    if (mask != 0)
+    {
+      uint32 index;
+      Y_bitscanforward(mask, &index);
+      return i + index;
+    }
+  }
+#elif defined(Y_JSON_NEON)
+  const uint8x16_t quotes = vdupq_n_u8('"');
+  const uint8x16_t backslashes = vdupq_n_u8('\\');
+  const uint8x16_t controls = vdupq_n_u8(0x1F);
+  for (; length - i >= 16; i += 16)
+  {
+    uint8x16_t chars = vld1q_u8(reinterpret_cast<const uint8*>(pText + i));
+    uint8x16_t found = vorrq_u8(vorrq_u8(vceqq_u8(chars, quotes), vceqq_u8(chars, backslashes)),
+                                vcleq_u8(chars, controls));
+    if (vmaxvq_u8(found) != 0)
+      break;
+  }
+#endif
+
+  for (; i < length; i++)
+  {
+    char ch = pText[i];
+    if (ch == '"' || ch == '\\' || uint8(ch) <= 0x1F)
+      break;
+  }
+
+  return i;
+}
+
+static inline bool IsWhitespace(char ch)
+{
+  return (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t');
+}
+
+static inline int32 HexDigitValue(char ch)
+{
+  if (ch >= '0' && ch <= '9')
+    return ch - '0';
+  if (ch >= 'a' && ch <= 'f')
+    return ch - 'a' + 10;
+  if (ch >= 'A' && ch <= 'F')
+    return ch - 'A' + 10;
+  return -1;
+}
+
+// the value of the four hex digits of a \u escape, which the reader has already checked
+static uint32 ReadHexEscape(const char* pDigits)
+{
+  uint32 value = 0;
+  for (uint32 i = 0; i < 4; i++)
+    value = (value << 4) | uint32(HexDigitValue(pDigits[i]));
+
+  return value;
+}
+
+static void GetLocation(const char* pText, const char* pPosition, uint32* pLine, uint32* pColumn)
+{
+  uint32 line = 1;
+  const char* pLineStart = pText;
+  for (;;)
+  {
+    const char* pLineFeed =
+      reinterpret_cast<const char*>(std::memchr(pLineStart, '\n', size_t(pPosition - pLineStart)));
+    if (pLineFeed == nullptr)
+      break;
+
+    pLineStart = pLineFeed + 1;
+    line++;
+  }
+
+  *pLine = line;
+  *pColumn = uint32(pPosition - pLineStart) + 1;
+}
+
+JSONReader::JSONReader()
+  : m_pInputStream(NULL), m_szFileName(NULL), m_pText(NULL), m_pTextEnd(NULL), m_pPosition(NULL),
+    m_pOwnedText(NULL), m_pTokenStart(NULL), m_pNameCopy(NULL), m_pValueCopy(NULL), m_nameHasEscapes(false),
+    m_valueHasEscapes(false), m_isInteger(false), m_afterValue(false), m_afterComma(false), m_rootRead(false),
+    m_pStrings(NULL), m_stringsSize(0), m_stringsLength(0), m_eCurrentTokenType(JSONREADER_TOKEN_COUNT),
+    m_bErrorState(true)
+{
+}
+
+JSONReader::~JSONReader()
+{
+  if (m_pOwnedText != NULL)
+    Y_free(m_pOwnedText);
+  if (m_pStrings != NULL)
+    Y_free(m_pStrings);
+}
+
+bool JSONReader::Create(ByteStream* pInputStream, const char* FileName)
+{
+  if (m_pOwnedText != NULL)
+  {
+    Y_free(m_pOwnedText);
+    m_pOwnedText = NULL;
+  }
+
+  m_pInputStream = pInputStream;
+  m_szFileName = FileName;
+  m_pTokenStart = NULL;
+  m_containers.Clear();
+  m_afterValue = false;
+  m_afterComma = false;
+  m_rootRead = false;
+  m_eCurrentTokenType = JSONREADER_TOKEN_COUNT;
+  m_bErrorState = true;
+
+  uint64 position = pInputStream->GetPosition();
+  uint64 size = pInputStream->GetSize();
+  if (size - position > 0xFFFFFFFF)
+  {
+    Log_ErrorPrintf("JSONReader::Create: %s is too large.", FileName);
+    return false;
+  }
+
+  // anything that isn't in memory already is read in whole
+  const byte* pBasePointer = pInputStream->GetBasePointer();
+  if (pBasePointer != NULL)
+  {
+    m_pText = reinterpret_cast<const char*>(pBasePointer + position);
+  }
+  else
+  {
+    uint32 length = uint32(size - position);
+    m_pOwnedText = static_cast<char*>(Y_malloc(Max(length, 1u)));
+    if (pInputStream->Read(m_pOwnedText, length) != length)
+    {
+      Log_ErrorPrintf("JSONReader::Create: failed to read %s.", FileName);
+      return false;
+    }
+
+    m_pText = m_pOwnedText;
+  }
+
+  m_pTextEnd = m_pText + (size - position);
+  if ((m_pTextEnd - m_pText) >= 3 && std::memcmp(m_pText, "\xEF\xBB\xBF", 3) == 0)
+    m_pText += 3;
+
+  m_pPosition = m_pText;
+  m_bErrorState = false;
+  return true;
+}
+
+bool JSONReader::NextToken()
+{
+  if (m_bErrorState)
+    return false;
+
+  m_name = StringView();
+  m_value = StringView();
+  m_pNameCopy = NULL;
+  m_pValueCopy = NULL;
+  m_nameHasEscapes = false;
+  m_valueHasEscapes = false;
+  m_isInteger = false;
+
+  SkipWhitespace();
+  m_pTokenStart = m_pPosition;
+
+  // outside any container there's the one value, then nothing
+  if (m_containers.GetSize() == 0)
+  {
+    if (m_rootRead)
+    {
+      m_eCurrentTokenType = JSONREADER_TOKEN_COUNT;
+      if (m_pPosition != m_pTextEnd)
+        return SyntaxError("text after the end of the document");
+
+      return false;
+    }
+
+    return ReadValue();
+  }
+
+  char open = m_containers.LastElement();
+  char close = (open == '{') ? '}' : ']';
+  if (m_pPosition == m_pTextEnd)
+    return SyntaxError("unexpected end of document, expected '%c'", close);
+
+  if (m_afterValue)
+  {
+    if (*m_pPosition == ',')
+    {
+      m_pPosition++;
+      m_afterValue = false;
+      m_afterComma = true;
+      SkipWhitespace();
+      m_pTokenStart = m_pPosition;
+    }
+    else if (*m_pPosition != close)
+    {
+      return SyntaxError("expected ',' or '%c'", close);
+    }
+  }
+
+  // the end can't follow a comma
+  if (!m_afterComma && m_pPosition != m_pTextEnd && *m_pPosition == close)
+  {
+    m_pPosition++;
+    m_containers.RemoveBack();
+    m_afterValue = true;
+    m_eCurrentTokenType = (open == '{') ? JSONREADER_TOKEN_END_OBJECT : JSONREADER_TOKEN_END_ARRAY;
+    ResetStrings(0);
+    return true;
+  }
+
+  if (open == '{')
+  {
+    if (m_pPosition == m_pTextEnd || *m_pPosition != '"')
+      return SyntaxError("expected a member name");
+    if (!ReadString(&m_name, &m_nameHasEscapes))
+      return false;
+
+    SkipWhitespace();
+    if (m_pPosition == m_pTextEnd || *m_pPosition != ':')
+      return SyntaxError("expected ':' after the member name");
+
+    m_pPosition++;
+    SkipWhitespace();
+  }
+
+  return ReadValue();
+}
+
+bool JSONReader::ReadValue()
+{
+  if (m_pPosition == m_pTextEnd)
+    return SyntaxError("expected a value");
+
+  bool result;
+  switch (*m_pPosition)
+  {
+    case '{':
+    case '[':
+      m_containers.Add(*m_pPosition);
+      m_eCurrentTokenType = (*m_pPosition == '{') ? JSONREADER_TOKEN_START_OBJECT : JSONREADER_TOKEN_START_ARRAY;
+      m_pPosition++;
+      result = true;
+      break;
+
+    case '"':
+      m_eCurrentTokenType = JSONREADER_TOKEN_STRING;
+      result = ReadString(&m_value, &m_valueHasEscapes);
+      break;
+
+    case 't':
+      result = ReadLiteral("true", 4, JSONREADER_TOKEN_BOOLEAN);
+      break;
+
+    case 'f':
+      result = ReadLiteral("false", 5, JSONREADER_TOKEN_BOOLEAN);
+      break;
+
+    case 'n':
+      result = ReadLiteral("null", 4, JSONREADER_TOKEN_NULL);
+      break;
+
+    default:
+      result = ReadNumber();
+      break;
+  }
+
+  if (!result)
+    return false;
+
+  // a container that's just opened has nothing in it, anything else is a value in the one it's in
+  bool opened = (m_eCurrentTokenType == JSONREADER_TOKEN_START_OBJECT ||
+                 m_eCurrentTokenType == JSONREADER_TOKEN_START_ARRAY);
+  m_afterValue = !opened;
+  m_afterComma = false;
+  m_rootRead = true;
+  ResetStrings(m_name.GetLength() + m_value.GetLength() + 2);
+  return true;
+}
+
+bool JSONReader::ReadString(StringView* pText, bool* pHasEscapes)
+{
+  DebugAssert(*m_pPosition == '"');
+  const char* pStart = ++m_pPosition;
+  bool hasEscapes = false;
+  for (;;)
+  {
+    m_pPosition += FindStringSpecial(m_pPosition, uint32(m_pTextEnd - m_pPosition));
+    if (m_pPosition == m_pTextEnd)
+      return SyntaxError("unterminated string");
+
+    char ch = *m_pPosition;
+    if (ch == '"')
+      break;
+
+    if (ch != '\\')
+      return SyntaxError("control character in a string");
+
+    // escapes are checked here, so decoding them later can't fail
+    hasEscapes = true;
+    if ((m_pTextEnd - m_pPosition) < 2)
+      return SyntaxError("unterminated string");
+
+    char escape = m_pPosition[1];
+    if (escape == 'u')
+    {
+      if ((m_pTextEnd - m_pPosition) < 6 || HexDigitValue(m_pPosition[2]) < 0 || HexDigitValue(m_pPosition[3]) < 0 ||
+          HexDigitValue(m_pPosition[4]) < 0 || HexDigitValue(m_pPosition[5]) < 0)
+      {
+        return SyntaxError("bad \\u escape");
+      }
+
+      m_pPosition += 6;
+    }
+    else if (escape == '"' || escape == '\\' || escape == '/' || escape == 'b' || escape == 'f' || escape == 'n' ||
+             escape == 'r' || escape == 't')
+    {
+      m_pPosition += 2;
+    }
+    else
+    {
+      return SyntaxError("bad escape '\\%c'", escape);
+    }
+  }
+
+  *pText = StringView(pStart, uint32(m_pPosition - pStart));
+  *pHasEscapes = hasEscapes;
+  m_pPosition++;
+  return true;
+}
+
+bool JSONReader::ReadNumber()
+{
+  const char* pCurrent = m_pPosition;
+  if (pCurrent != m_pTextEnd && *pCurrent == '-')
+    pCurrent++;
+
+  // no leading zeros, and digits either side of the point
+  if (pCurrent == m_pTextEnd || *pCurrent < '0' || *pCurrent > '9')
+    return SyntaxError("expected a value");
+  if (*pCurrent == '0')
+    pCurrent++;
+  else
+    for (; pCurrent != m_pTextEnd && *pCurrent >= '0' && *pCurrent <= '9'; pCurrent++) {}
+
+  bool isInteger = true;
+  if (pCurrent != m_pTextEnd && *pCurrent == '.')
+  {
+    isInteger = false;
+    pCurrent++;
+    if (pCurrent == m_pTextEnd || *pCurrent < '0' || *pCurrent > '9')
+      return SyntaxError("expected digits after the decimal point");
+    for (; pCurrent != m_pTextEnd && *pCurrent >= '0' && *pCurrent <= '9'; pCurrent++) {}
+  }
+
+  if (pCurrent != m_pTextEnd && (*pCurrent == 'e' || *pCurrent == 'E'))
+  {
+    isInteger = false;
+    pCurrent++;
+    if (pCurrent != m_pTextEnd && (*pCurrent == '+' || *pCurrent == '-'))
+      pCurrent++;
+    if (pCurrent == m_pTextEnd || *pCurrent < '0' || *pCurrent > '9')
+      return SyntaxError("expected digits in the exponent");
+    for (; pCurrent != m_pTextEnd && *pCurrent >= '0' && *pCurrent <= '9'; pCurrent++) {}
+  }
+
+  m_value = StringView(m_pPosition, uint32(pCurrent - m_pPosition));
+  m_isInteger = isInteger;
+  m_eCurrentTokenType = JSONREADER_TOKEN_NUMBER;
+  m_pPosition = pCurrent;
+  return true;
+}
+
+bool JSONReader::ReadLiteral(const char* literal, uint32 length, JSONREADER_TOKEN_TYPE tokenType)
+{
+  if (uint32(m_pTextEnd - m_pPosition) < length || std::memcmp(m_pPosition, literal, length) != 0)
+    return SyntaxError("expected a value");
+
+  m_value = StringView(m_pPosition, length);
+  m_eCurrentTokenType = tokenType;
+  m_pPosition += length;
+  return true;
+}
+
+void JSONReader::SkipWhitespace()
+{
+  while (m_pPosition != m_pTextEnd && IsWhitespace(*m_pPosition))
+    m_pPosition++;
+}
+
+bool JSONReader::SyntaxError(const char* Format, ...)
+{
+  char buf[512];
+
+  va_list ap;
+  va_start(ap, Format);
+  Y_vsnprintf(buf, countof(buf), Format, ap);
+  va_end(ap);
+
+  uint32 line, col;
+  GetLocation(m_pText, m_pPosition, &line, &col);
+  Log_ErrorPrintf("%s:%u:%u: %s", m_szFileName, line, col, buf);
+  m_eCurrentTokenType = JSONREADER_TOKEN_COUNT;
+  m_bErrorState = true;
+  return false;
+}
+
+void JSONReader::ResetStrings(uint32 maxLength)
+{
+  if (maxLength > m_stringsSize)
+  {
+    m_stringsSize = Max(maxLength, Max(m_stringsSize * 2, 256u));
+    m_pStrings = static_cast<char*>(Y_realloc(m_pStrings, m_stringsSize));
+  }
+
+  m_stringsLength = 0;
+}
+
+const char* JSONReader::CopyString(StringView* pText, bool decode)
+{
+  // decoded text is never longer than the escapes it came from
+  DebugAssert((m_stringsLength + pText->GetLength() + 1) <= m_stringsSize);
+  char* pCopy = m_pStrings + m_stringsLength;
+  uint32 length = 0;
+  if (!decode)
+  {
+    std::memcpy(pCopy, pText->GetData(), pText->GetLength());
+    length = pText->GetLength();
+  }
+  else
+  {
+    const char* pCurrent = pText->GetData();
+    const char* pEnd = pCurrent + pText->GetLength();
+    while (pCurrent != pEnd)
+    {
+      const char* pBackslash = static_cast<const char*>(std::memchr(pCurrent, '\\', size_t(pEnd - pCurrent)));
+      if (pBackslash == NULL)
+        pBackslash = pEnd;
+
+      std::memcpy(pCopy + length, pCurrent, size_t(pBackslash - pCurrent));
+      length += uint32(pBackslash - pCurrent);
+      pCurrent = pBackslash;
+      if (pCurrent == pEnd)
+        break;
+
+      char escape = pCurrent[1];
+      pCurrent += 2;
+      switch (escape)
+      {
+        case 'b':
+          pCopy[length++] = '\b';
+          break;
+        case 'f':
+          pCopy[length++] = '\f';
+          break;
+        case 'n':
+          pCopy[length++] = '\n';
+          break;
+        case 'r':
+          pCopy[length++] = '\r';
+          break;
+        case 't':
+          pCopy[length++] = '\t';
+          break;
+        case 'u':
+        {
+          // surrogate pairs are two escapes, and a surrogate without its other half is a replacement character
+          char32_t codePoint = char32_t(ReadHexEscape(pCurrent));
+          pCurrent += 4;
+          if (codePoint >= 0xD800 && codePoint <= 0xDBFF && (pEnd - pCurrent) >= 6 && pCurrent[0] == '\\' &&
+              pCurrent[1] == 'u')
+          {
+            uint32 lowSurrogate = ReadHexEscape(pCurrent + 2);
+            if (lowSurrogate >= 0xDC00 && lowSurrogate <= 0xDFFF)
+            {
+              codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+              pCurrent += 6;
+            }
+          }
+          if (codePoint >= 0xD800 && codePoint <= 0xDFFF)
+            codePoint = 0xFFFD;
+
+          length += UnicodeConversion::UTF32ToUTF8(pCopy + length, 4, &codePoint, 1);
+        }
+        break;
+        default:
+          pCopy[length++] = escape;
+          break;
+      }
+    }
+  }
+
+  pCopy[length] = '\0';
+  m_stringsLength += length + 1;
+  *pText = StringView(pCopy, length);
+  return pCopy;
+}
+
+uint32 JSONReader::GetDepth() const
+{
+  uint32 depth = m_containers.GetSize();
+  if (m_eCurrentTokenType == JSONREADER_TOKEN_START_OBJECT || m_eCurrentTokenType == JSONREADER_TOKEN_START_ARRAY)
+    depth--;
+
+  return depth;
+}
+
+const char* JSONReader::GetName()
+{
+  if (m_name.GetLength() == 0)
+    return "";
+
+  if (m_pNameCopy == NULL)
+    m_pNameCopy = CopyString(&m_name, m_nameHasEscapes);
+
+  return m_pNameCopy;
+}
+
+StringView JSONReader::GetNameView()
+{
+  if (m_nameHasEscapes && m_pNameCopy == NULL)
+    GetName();
+
+  return m_name;
+}
+
+const char* JSONReader::GetValue()
+{
+  if (m_eCurrentTokenType < JSONREADER_TOKEN_STRING || m_eCurrentTokenType >= JSONREADER_TOKEN_COUNT)
+    return NULL;
+  if (m_value.GetLength() == 0)
+    return "";
+
+  if (m_pValueCopy == NULL)
+    m_pValueCopy = CopyString(&m_value, m_valueHasEscapes);
+
+  return m_pValueCopy;
+}
+
+StringView JSONReader::GetValueView()
+{
+  if (m_valueHasEscapes && m_pValueCopy == NULL)
+    GetValue();
+
+  return m_value;
+}
+
+int64 JSONReader::GetInt64() const
+{
+  if (m_eCurrentTokenType != JSONREADER_TOKEN_NUMBER)
+    return 0;
+
+  int64 value;
+  if (m_isInteger)
+  {
+    NumberConversion::ParseInt64(m_value, &value);
+    return value;
+  }
+
+  double doubleValue;
+  NumberConversion::ParseDouble(m_value, &doubleValue);
+  if (!(doubleValue > -9223372036854775808.0))
+    return (doubleValue != doubleValue) ? 0 : (-9223372036854775807ll - 1);
+  if (doubleValue >= 9223372036854775808.0)
+    return 9223372036854775807ll;
+
+  return int64(doubleValue);
+}
+
+uint64 JSONReader::GetUInt64() const
+{
+  if (m_eCurrentTokenType != JSONREADER_TOKEN_NUMBER || m_value.GetData()[0] == '-')
+    return 0;
+
+  uint64 value;
+  if (m_isInteger)
+  {
+    NumberConversion::ParseUInt64(m_value, &value);
+    return value;
+  }
+
+  double doubleValue;
+  NumberConversion::ParseDouble(m_value, &doubleValue);
+  if (doubleValue >= 18446744073709551616.0)
+    return 0xFFFFFFFFFFFFFFFFull;
+
+  return uint64(doubleValue);
+}
+
+double JSONReader::GetDouble() const
+{
+  if (m_eCurrentTokenType != JSONREADER_TOKEN_NUMBER)
+    return 0.0;
+
+  double value;
+  NumberConversion::ParseDouble(m_value, &value);
+  return value;
+}
+
+bool JSONReader::SkipCurrentValue()
+{
+  if (m_eCurrentTokenType != JSONREADER_TOKEN_START_OBJECT && m_eCurrentTokenType != JSONREADER_TOKEN_START_ARRAY)
+    return !m_bErrorState;
+
+  // the end that closes it is the one that brings the open containers back to where they were before it
+  uint32 depth = m_containers.GetSize();
+  for (;;)
+  {
+    if (!NextToken())
+      return false;
+
+    if (m_containers.GetSize() < depth)
+      return true;
+  }
+}
+
+bool JSONReader::SkipToMember(const char* name)
+{
+  // from inside a member, the rest of its value goes first
+  if (m_eCurrentTokenType != JSONREADER_TOKEN_START_OBJECT && !SkipCurrentValue())
+    return false;
+
+  uint32 depth = m_containers.GetSize();
+  if (depth == 0 || m_containers[depth - 1] != '{')
+    return false;
+
+  StringView memberName(name);
+  for (;;)
+  {
+    if (!NextToken() || m_containers.GetSize() < depth)
+      return false;
+
+    if (GetNameView().Compare(memberName))
+      return true;
+
+    if (!SkipCurrentValue())
+      return false;
+  }
+}
+
+void JSONReader::PrintWarning(const char* Format, ...)
+{
+  char buf[512];
+
+  va_list ap;
+  va_start(ap, Format);
+  Y_vsnprintf(buf, countof(buf), Format, ap);
+  va_end(ap);
+
+  uint32 line, col;
+  GetLocation(m_pText, (m_pTokenStart != NULL) ? m_pTokenStart : m_pText, &line, &col);
+  Log_WarningPrintf("%s:%u:%u: %s", m_szFileName, line, col, buf);
+}
+
+void JSONReader::PrintError(const char* Format, ...)
+{
+  char buf[512];
+
+  va_list ap;
+  va_start(ap, Format);
+  Y_vsnprintf(buf, countof(buf), Format, ap);
+  va_end(ap);
+
+  uint32 line, col;
+  GetLocation(m_pText, (m_pTokenStart != NULL) ? m_pTokenStart : m_pText, &line, &col);
+  Log_ErrorPrintf("%s:%u:%u: %s", m_szFileName, line, col, buf);
+}
+
+const uint32 JSONWriter::BufferSize;
+
+JSONWriter::JSONWriter()
+  : m_pOutputStream(NULL), m_indent(true), m_containerEmpty(true), m_nameWritten(false), m_rootWritten(false),
+    m_bufferLength(0), m_bErrorState(true)
+{
+}
+
+JSONWriter::~JSONWriter()
+{
+  Close();
+}
+
+bool JSONWriter::Create(ByteStream* pOutputStream, bool indent /* = true */)
+{
+  Close();
+
+  m_pOutputStream = pOutputStream;
+  m_indent = indent;
+  m_containers.Clear();
+  m_containerEmpty = true;
+  m_nameWritten = false;
+  m_rootWritten = false;
+  m_bufferLength = 0;
+  m_bErrorState = false;
+  return true;
+}
+
+void JSONWriter::Close()
+{
+  if (m_pOutputStream == NULL)
+    return;
+
+  // open containers are ended even after a call failed, and a name without its value gets a null
+  m_bErrorState = m_pOutputStream->InErrorState();
+  if (m_nameWritten)
+    WriteNull();
+
+  while (!m_bErrorState && m_containers.GetSize() > 0)
+  {
+    if (m_containers.LastElement() == '{')
+      EndObject();
+    else
+      EndArray();
+  }
+
+  if (m_indent && m_rootWritten && !m_bErrorState)
+    Write("\n", 1);
+
+  FlushBuffer();
+  m_pOutputStream = NULL;
+  m_bErrorState = true;
+}
+
+bool JSONWriter::FlushBuffer()
+{
+  if (m_bufferLength > 0 && !m_bErrorState)
+  {
+    if (m_pOutputStream->Write(m_buffer, m_bufferLength) != m_bufferLength)
+    {
+      Log_ErrorPrintf("JSONWriter::FlushBuffer: failed to write to the stream.");
+      m_bErrorState = true;
+    }
+  }
+
+  m_bufferLength = 0;
+  return !m_bErrorState;
+}
+
+void JSONWriter::Write(const char* text, uint32 length)
+{
+  if (length > (BufferSize - m_bufferLength))
+  {
+    if (!FlushBuffer())
+      return;
+
+    // too big to be worth buffering
+    if (length >= BufferSize)
+    {
+      if (m_pOutputStream->Write(text, length) != length)
+      {
+        Log_ErrorPrintf("JSONWriter::Write: failed to write to the stream.");
+        m_bErrorState = true;
+      }
+
+      return;
+    }
+  }
+
+  std::memcpy(m_buffer + m_bufferLength, text, length);
+  m_bufferLength += length;
+}
+
+char* JSONWriter::ReserveBuffer(uint32 size)
+{
+  DebugAssert(size <= BufferSize);
+  if ((BufferSize - m_bufferLength) < size && !FlushBuffer())
+    return NULL;
+
+  return m_buffer + m_bufferLength;
+}
+
+void JSONWriter::WriteLineBreak()
+{
+  if (!m_indent)
+    return;
+
+  Write("\n", 1);
+  for (uint32 i = 0; i < m_containers.GetSize(); i++)
+    Write("    ", 4);
+}
+
+void JSONWriter::WriteEscaped(const char* text, uint32 length)
+{
+  Write("\"", 1);
+  for (;;)
+  {
+    uint32 runLength = FindStringSpecial(text, length);
+    Write(text, runLength);
+    text += runLength;
+    length -= runLength;
+    if (length == 0)
+      break;
+
+    char escape[6] = {'\\', 0, 0, 0, 0, 0};
+    uint32 escapeLength = 2;
+    switch (*text)
+    {
+      case '"':
+        escape[1] = '"';
+        break;
+      case '\\':
+        escape[1] = '\\';
+        break;
+      case '\b':
+        escape[1] = 'b';
+        break;
+      case '\f':
+        escape[1] = 'f';
+        break;
+      case '\n':
+        escape[1] = 'n';
+        break;
+      case '\r':
+        escape[1] = 'r';
+        break;
+      case '\t':
+        escape[1] = 't';
+        break;
+      default:
+        escape[1] = 'u';
+        escape[2] = '0';
+        escape[3] = '0';
+        escape[4] = "0123456789abcdef"[uint8(*text) >> 4];
+        escape[5] = "0123456789abcdef"[uint8(*text) & 0xF];
+        escapeLength = 6;
+        break;
+    }
+
+    Write(escape, escapeLength);
+    text++;
+    length--;
+  }
+
+  Write("\"", 1);
+}
+
+bool JSONWriter::StartValue()
+{
+  if (m_bErrorState)
+    return false;
+
+  if (m_containers.GetSize() == 0)
+  {
+    if (m_rootWritten)
+    {
+      Log_ErrorPrintf("JSONWriter::StartValue: a document has one value at the root");
+      m_bErrorState = true;
+      return false;
+    }
+
+    m_rootWritten = true;
+    return true;
+  }
+
+  // in an object the name has written what goes before
+  if (m_containers.LastElement() == '{')
+  {
+    if (!m_nameWritten)
+    {
+      Log_ErrorPrintf("JSONWriter::StartValue: a value in an object needs a name first");
+      m_bErrorState = true;
+      return false;
+    }
+
+    m_nameWritten = false;
+    return true;
+  }
+
+  if (!m_containerEmpty)
+    Write(",", 1);
+
+  WriteLineBreak();
+  m_containerEmpty = false;
+  return true;
+}
+
+void JSONWriter::StartContainer(char open)
+{
+  if (!StartValue())
+    return;
+
+  Write(&open, 1);
+  m_containers.Add(open);
+  m_containerEmpty = true;
+}
+
+void JSONWriter::EndContainer(char open, char close)
+{
+  if (m_bErrorState)
+    return;
+
+  if (m_containers.GetSize() == 0 || m_containers.LastElement() != open || m_nameWritten)
+  {
+    Log_ErrorPrintf("JSONWriter::EndContainer: no '%c' to end with '%c'", open, close);
+    m_bErrorState = true;
+    return;
+  }
+
+  m_containers.RemoveBack();
+  if (!m_containerEmpty)
+    WriteLineBreak();
+
+  Write(&close, 1);
+  m_containerEmpty = false;
+}
+
+void JSONWriter::StartObject()
+{
+  StartContainer('{');
+}
+
+void JSONWriter::EndObject()
+{
+  EndContainer('{', '}');
+}
+
+void JSONWriter::StartArray()
+{
+  StartContainer('[');
+}
+
+void JSONWriter::EndArray()
+{
+  EndContainer('[', ']');
+}
+
+void JSONWriter::WriteName(const char* name)
+{
+  WriteName(name, Y_strlen(name));
+}
+
+void JSONWriter::WriteName(const char* name, uint32 nameLength)
+{
+  if (m_bErrorState)
+    return;
+
+  if (m_containers.GetSize() == 0 || m_containers.LastElement() != '{' || m_nameWritten)
+  {
+    Log_ErrorPrintf("JSONWriter::WriteName: name '%.*s' outside of an object", nameLength, name);
+    m_bErrorState = true;
+    return;
+  }
+
+  if (!m_containerEmpty)
+    Write(",", 1);
+
+  WriteLineBreak();
+  WriteEscaped(name, nameLength);
+  if (m_indent)
+    Write(": ", 2);
+  else
+    Write(":", 1);
+
+  m_containerEmpty = false;
+  m_nameWritten = true;
+}
+
+void JSONWriter::WriteString(const char* value)
+{
+  WriteString(value, Y_strlen(value));
+}
+
+void JSONWriter::WriteString(const char* value, uint32 valueLength)
+{
+  if (StartValue())
+    WriteEscaped(value, valueLength);
+}
+
+void JSONWriter::WriteInt32(int32 value)
+{
+  char* pBuffer;
+  if (StartValue() && (pBuffer = ReserveBuffer(NumberConversion::MaxIntegerLength)) != NULL)
+    CommitBuffer(NumberConversion::FormatInt32(pBuffer, value));
+}
+
+void JSONWriter::WriteUInt32(uint32 value)
+{
+  char* pBuffer;
+  if (StartValue() && (pBuffer = ReserveBuffer(NumberConversion::MaxIntegerLength)) != NULL)
+    CommitBuffer(NumberConversion::FormatUInt32(pBuffer, value));
+}
+
+void JSONWriter::WriteInt64(int64 value)
+{
+  char* pBuffer;
+  if (StartValue() && (pBuffer = ReserveBuffer(NumberConversion::MaxIntegerLength)) != NULL)
+    CommitBuffer(NumberConversion::FormatInt64(pBuffer, value));
+}
+
+void JSONWriter::WriteUInt64(uint64 value)
+{
+  char* pBuffer;
+  if (StartValue() && (pBuffer = ReserveBuffer(NumberConversion::MaxIntegerLength)) != NULL)
+    CommitBuffer(NumberConversion::FormatUInt64(pBuffer, value));
+}
+
+void JSONWriter::WriteFloat(float value)
+{
+  if (!std::isfinite(value))
+  {
+    WriteNull();
+    return;
+  }
+
+  char* pBuffer;
+  if (StartValue() && (pBuffer = ReserveBuffer(NumberConversion::MaxFloatLength)) != NULL)
+    CommitBuffer(NumberConversion::FormatFloat(pBuffer, value));
+}
+
+void JSONWriter::WriteDouble(double value)
+{
+  if (!std::isfinite(value))
+  {
+    WriteNull();
+    return;
+  }
+
+  char* pBuffer;
+  if (StartValue() && (pBuffer = ReserveBuffer(NumberConversion::MaxFloatLength)) != NULL)
+    CommitBuffer(NumberConversion::FormatDouble(pBuffer, value));
+}
+
+void JSONWriter::WriteBool(bool value)
+{
+  if (StartValue())
+  {
+    if (value)
+      Write("true", 4);
+    else
+      Write("false", 5);
+  }
+}
+
+void JSONWriter::WriteNull()
+{
+  if (StartValue())
+    Write("null", 4);
+}
+
+void JSONWriter::WriteRaw(const char* value, uint32 valueLength)
+{
+  if (StartValue())
+    Write(value, valueLength);
+}
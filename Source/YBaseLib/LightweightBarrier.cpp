@@ -0,0 +1,40 @@
+#include "YBaseLib/LightweightBarrier.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Futex.h"
+#include "YBaseLib/SpinLock.h"
+
+void LightweightBarrier::SetThreadCount(uint32 threadCount)
+{
+  DebugAssert(m_arrivedCount == 0);
+  m_threadCount = threadCount;
+}
+
+void LightweightBarrier::Wait()
+{
+  // The generation can't move until this thread has arrived, so reading it first is safe. The count is reset
+  // before the generation's bumped, so threads released into the next round start from zero.
+  uint32 generation = Y_AtomicLoad(m_generation, ATOMIC_MEMORY_ORDER_ACQUIRE);
+  if (Y_AtomicIncrement(m_arrivedCount) == m_threadCount)
+  {
+    Y_AtomicStore(m_arrivedCount, uint32(0), ATOMIC_MEMORY_ORDER_RELAXED);
+    Y_AtomicStore(m_generation, generation + 1);
+    if (Y_AtomicLoad(m_sleepers) != 0)
+      Y_FutexWakeAll(&m_generation);
+
+    return;
+  }
+
+  SpinBackoff backoff;
+  while (!backoff.IsSaturated())
+  {
+    backoff.Pause();
+    if (Y_AtomicLoad(m_generation, ATOMIC_MEMORY_ORDER_ACQUIRE) != generation)
+      return;
+  }
+
+  // as with LightweightSemaphore, either the sleeper sees the new generation or the last arrival sees the sleeper
+  Y_AtomicIncrement(m_sleepers);
+  while (Y_AtomicLoad(m_generation, ATOMIC_MEMORY_ORDER_ACQUIRE) == generation)
+    Y_FutexWait(&m_generation, generation);
+  Y_AtomicDecrement(m_sleepers);
+}
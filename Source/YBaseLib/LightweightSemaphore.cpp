@@ -0,0 +1,34 @@
+#include "YBaseLib/LightweightSemaphore.h"
+#include "YBaseLib/Futex.h"
+#include "YBaseLib/SpinLock.h"
+
+void LightweightSemaphore::WaitSlow()
+{
+  // a post usually comes soon after a wait on a busy queue, so spin before sleeping
+  SpinBackoff backoff;
+  while (!backoff.IsSaturated())
+  {
+    backoff.Pause();
+    if (TryWait())
+      return;
+  }
+
+  // Sleepers count themselves before the futex checks the count, and Post reads the sleepers after raising it,
+  // so either the sleeper sees the count or the post sees the sleeper.
+  Y_AtomicIncrement(m_sleepers);
+  while (!TryWait())
+    Y_FutexWait(&m_count, 0);
+  Y_AtomicDecrement(m_sleepers);
+}
+
+void LightweightSemaphore::Post(uint32 count /* = 1 */)
+{
+  Y_AtomicAdd(m_count, count);
+  if (Y_AtomicLoad(m_sleepers) == 0)
+    return;
+
+  if (count == 1)
+    Y_FutexWakeOne(&m_count);
+  else
+    Y_FutexWakeAll(&m_count);
+}
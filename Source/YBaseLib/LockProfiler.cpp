@@ -0,0 +1,324 @@
+#include "YBaseLib/LockProfiler.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Metrics.h"
+#include "YBaseLib/Platform.h"
+#include "YBaseLib/SpinLock.h"
+#include "YBaseLib/String.h"
+Log_SetChannel(LockProfiler);
+
+// Locks can be named from static constructors, so everything here is zero or constant initialized, and the locks
+// protecting it are SpinLocks rather than Mutexes, which could be being profiled themselves.
+struct LockCounters
+{
+  Y_ATOMIC_DECL64 int64 Acquisitions;
+  Y_ATOMIC_DECL64 int64 ContendedAcquisitions;
+  Y_ATOMIC_DECL64 int64 TotalWaitTime;
+  Y_ATOMIC_DECL64 int64 MaxWaitTime;
+  Y_ATOMIC_DECL64 int64 TotalHoldTime;
+  Y_ATOMIC_DECL64 int64 MaxHoldTime;
+};
+
+// Sampled stacks live in an open addressed table and are only removed by Reset. When the table is busy the sample
+// is just dropped.
+static const uint32 StackRecordCount = 1024;
+
+struct StackRecord
+{
+  uint32 Hash;
+  uint32 Lock;
+  uint32 FrameCount;
+  void* Frames[LockProfiler::MaxStackFrames];
+  uint64 SampleCount;
+  uint64 SampledWaitTime;
+};
+
+static const char* s_lockNames[LockProfiler::MaxLockCount] = {"Unprofiled"};
+static Y_ATOMIC_DECL uint32 s_lockCount = 1;
+static SpinLock s_lockNameLock;
+static LockCounters s_lockCounters[LockProfiler::MaxLockCount];
+
+static StackRecord s_stackRecords[StackRecordCount];
+static uint32 s_stackRecordsUsed;
+static SpinLock s_stackRecordLock;
+static Y_ATOMIC_DECL uint32 s_sampleRate = 16;
+
+Y_DECLARE_THREAD_LOCAL(uint32) s_sampleCountdown = 0;
+
+static uint64 TicksToNanoseconds(int64 ticks)
+{
+  return (ticks > 0) ? (uint64)Y_FastTimerConvertToNanoseconds((Y_TIMER_VALUE)ticks) : 0;
+}
+
+static void RecordStackSample(uint32 lock, uint64 waitTime)
+{
+  void* pFrames[LockProfiler::MaxStackFrames];
+  // skip ourselves and OnAcquired
+  uint32 frameCount = Platform::CaptureCallStack(pFrames, countof(pFrames), 2);
+
+  // FNV-1a over the frame addresses and the lock
+  uint32 hash = 2166136261u ^ lock;
+  for (uint32 i = 0; i < frameCount; i++)
+  {
+    uintptr_t frame = reinterpret_cast<uintptr_t>(pFrames[i]);
+    for (uint32 j = 0; j < sizeof(frame); j++)
+      hash = (hash ^ (uint32)((frame >> (j * 8)) & 0xFF)) * 16777619u;
+  }
+
+  if (!s_stackRecordLock.TryLock())
+    return;
+
+  uint32 index = hash % StackRecordCount;
+  for (uint32 probe = 0; probe < StackRecordCount; probe++, index = (index + 1) % StackRecordCount)
+  {
+    StackRecord& record = s_stackRecords[index];
+    if (record.SampleCount == 0)
+    {
+      // table is kept at most 3/4 full so probes stay short
+      if (s_stackRecordsUsed >= StackRecordCount / 4 * 3)
+        break;
+
+      record.Hash = hash;
+      record.Lock = lock;
+      record.FrameCount = frameCount;
+      std::memcpy(record.Frames, pFrames, sizeof(void*) * frameCount);
+      s_stackRecordsUsed++;
+    }
+    else if (record.Hash != hash || record.Lock != lock || record.FrameCount != frameCount ||
+             std::memcmp(record.Frames, pFrames, sizeof(void*) * frameCount) != 0)
+    {
+      continue;
+    }
+
+    record.SampleCount++;
+    record.SampledWaitTime += waitTime;
+    break;
+  }
+
+  s_stackRecordLock.Unlock();
+}
+
+uint32 LockProfiler::RegisterLock(const char* name)
+{
+  s_lockNameLock.Lock();
+
+  uint32 lock;
+  for (lock = 1; lock < s_lockCount; lock++)
+  {
+    if (Y_strcmp(s_lockNames[lock], name) == 0)
+      break;
+  }
+
+  if (lock == s_lockCount)
+  {
+    // Nothing is logged when we run out, as this can be called for the log's own locks. The lock just isn't
+    // profiled, and any lock with a name can be profiled like that.
+    if (lock == MaxLockCount)
+    {
+      s_lockNameLock.Unlock();
+      return 0;
+    }
+
+    s_lockNames[lock] = name;
+    MemoryBarrier();
+    s_lockCount = lock + 1;
+  }
+
+  s_lockNameLock.Unlock();
+  return lock;
+}
+
+uint32 LockProfiler::GetLockCount()
+{
+  return s_lockCount;
+}
+
+void LockProfiler::SetSampleRate(uint32 sampleRate)
+{
+  s_sampleRate = sampleRate;
+}
+
+uint32 LockProfiler::GetSampleRate()
+{
+  return s_sampleRate;
+}
+
+bool LockProfiler::GetLockStats(uint32 lock, LockStats* pStats)
+{
+  if (lock >= s_lockCount)
+    return false;
+
+  const LockCounters& counters = s_lockCounters[lock];
+  pStats->Name = s_lockNames[lock];
+  pStats->Acquisitions = (uint64)counters.Acquisitions;
+  pStats->ContendedAcquisitions = (uint64)counters.ContendedAcquisitions;
+  pStats->TotalWaitTime = TicksToNanoseconds(counters.TotalWaitTime);
+  pStats->MaxWaitTime = TicksToNanoseconds(counters.MaxWaitTime);
+  pStats->TotalHoldTime = TicksToNanoseconds(counters.TotalHoldTime);
+  pStats->MaxHoldTime = TicksToNanoseconds(counters.MaxHoldTime);
+  return true;
+}
+
+uint32 LockProfiler::GetStackSamples(StackSample* pSamples, uint32 maxSamples)
+{
+  uint32 count = 0;
+  s_stackRecordLock.Lock();
+
+  // keep the longest waiting maxSamples, in order
+  for (uint32 i = 0; i < StackRecordCount; i++)
+  {
+    const StackRecord& record = s_stackRecords[i];
+    if (record.SampleCount == 0)
+      continue;
+
+    uint32 position = count;
+    while (position > 0 && pSamples[position - 1].SampledWaitTime < record.SampledWaitTime)
+      position--;
+    if (position == maxSamples)
+      continue;
+
+    uint32 moveCount = Min(count, maxSamples - 1) - position;
+    std::memmove(&pSamples[position + 1], &pSamples[position], sizeof(StackSample) * moveCount);
+    count = Min(count + 1, maxSamples);
+
+    StackSample& sample = pSamples[position];
+    sample.Lock = record.Lock;
+    sample.FrameCount = record.FrameCount;
+    std::memcpy(sample.Frames, record.Frames, sizeof(void*) * record.FrameCount);
+    sample.SampleCount = record.SampleCount;
+    sample.SampledWaitTime = record.SampledWaitTime;
+  }
+
+  s_stackRecordLock.Unlock();
+
+  // recorded in ticks, converted once they're sorted
+  for (uint32 i = 0; i < count; i++)
+    pSamples[i].SampledWaitTime = TicksToNanoseconds((int64)pSamples[i].SampledWaitTime);
+
+  return count;
+}
+
+void LockProfiler::Reset()
+{
+  // acquisitions in progress can still land on either side of this
+  for (uint32 lock = 0; lock < MaxLockCount; lock++)
+  {
+    LockCounters& counters = s_lockCounters[lock];
+    Y_AtomicExchange(counters.Acquisitions, (int64)0);
+    Y_AtomicExchange(counters.ContendedAcquisitions, (int64)0);
+    Y_AtomicExchange(counters.TotalWaitTime, (int64)0);
+    Y_AtomicExchange(counters.MaxWaitTime, (int64)0);
+    Y_AtomicExchange(counters.TotalHoldTime, (int64)0);
+    Y_AtomicExchange(counters.MaxHoldTime, (int64)0);
+  }
+
+  s_stackRecordLock.Lock();
+  Y_memzero(s_stackRecords, sizeof(s_stackRecords));
+  s_stackRecordsUsed = 0;
+  s_stackRecordLock.Unlock();
+}
+
+void LockProfiler::Dump(uint32 maxStacks /* = 10 */)
+{
+  // most waited on first
+  LockStats stats[MaxLockCount];
+  uint32 statCount = 0;
+  uint32 lockCount = s_lockCount;
+  for (uint32 lock = 1; lock < lockCount; lock++)
+  {
+    LockStats lockStats;
+    GetLockStats(lock, &lockStats);
+    if (lockStats.Acquisitions == 0)
+      continue;
+
+    uint32 position = statCount++;
+    for (; position > 0 && stats[position - 1].TotalWaitTime < lockStats.TotalWaitTime; position--)
+      stats[position] = stats[position - 1];
+    stats[position] = lockStats;
+  }
+
+  Log_InfoPrintf("Locks by time spent waiting:");
+  for (uint32 i = 0; i < statCount; i++)
+  {
+    const LockStats& lockStats = stats[i];
+    double contendedPercent = (double)lockStats.ContendedAcquisitions * 100.0 / (double)lockStats.Acquisitions;
+    Log_InfoPrintf("  %-28s %10llu acquisitions, %10llu contended (%5.1f%%), waited %10.3f ms (max %8.3f ms), "
+                   "held %10.3f ms (max %8.3f ms)",
+                   lockStats.Name, lockStats.Acquisitions, lockStats.ContendedAcquisitions, contendedPercent,
+                   (double)lockStats.TotalWaitTime / 1000000.0, (double)lockStats.MaxWaitTime / 1000000.0,
+                   (double)lockStats.TotalHoldTime / 1000000.0, (double)lockStats.MaxHoldTime / 1000000.0);
+  }
+
+  StackSample samples[32];
+  uint32 sampleCount = GetStackSamples(samples, Min(maxStacks, (uint32)countof(samples)));
+  if (sampleCount == 0)
+    return;
+
+  Log_InfoPrintf("Longest waiting sampled stacks, 1 in %u contended acquisitions:", s_sampleRate);
+  for (uint32 i = 0; i < sampleCount; i++)
+  {
+    const StackSample& sample = samples[i];
+    Log_InfoPrintf("  #%u: %s, %llu samples, waited %.3f ms", i, s_lockNames[sample.Lock], sample.SampleCount,
+                   (double)sample.SampledWaitTime / 1000000.0);
+    for (uint32 j = 0; j < sample.FrameCount; j++)
+      Log_InfoPrintf("      %p", sample.Frames[j]);
+  }
+}
+
+void LockProfiler::PublishMetrics()
+{
+  MetricsRegistry& registry = MetricsRegistry::GetInstance();
+  uint32 lockCount = s_lockCount;
+  for (uint32 lock = 1; lock < lockCount; lock++)
+  {
+    LockStats stats;
+    GetLockStats(lock, &stats);
+    if (stats.Acquisitions == 0)
+      continue;
+
+    SmallString name;
+    name.Format("lock.%s.acquisitions", stats.Name);
+    registry.GetGauge(name.GetCharArray())->Set((int64)stats.Acquisitions);
+    name.Format("lock.%s.contended", stats.Name);
+    registry.GetGauge(name.GetCharArray())->Set((int64)stats.ContendedAcquisitions);
+    name.Format("lock.%s.wait_ns", stats.Name);
+    registry.GetGauge(name.GetCharArray())->Set((int64)stats.TotalWaitTime);
+    name.Format("lock.%s.max_wait_ns", stats.Name);
+    registry.GetGauge(name.GetCharArray())->Set((int64)stats.MaxWaitTime);
+    name.Format("lock.%s.hold_ns", stats.Name);
+    registry.GetGauge(name.GetCharArray())->Set((int64)stats.TotalHoldTime);
+    name.Format("lock.%s.max_hold_ns", stats.Name);
+    registry.GetGauge(name.GetCharArray())->Set((int64)stats.MaxHoldTime);
+  }
+}
+
+void LockProfiler::OnAcquired(uint32 lock, bool contended, Y_TIMER_VALUE waitTime)
+{
+  LockCounters& counters = s_lockCounters[lock];
+  Y_AtomicIncrement(counters.Acquisitions);
+  if (!contended)
+    return;
+
+  Y_AtomicIncrement(counters.ContendedAcquisitions);
+  Y_AtomicAdd(counters.TotalWaitTime, (int64)waitTime);
+  Y_AtomicFetchMax(counters.MaxWaitTime, (int64)waitTime, ATOMIC_MEMORY_ORDER_RELAXED);
+
+  uint32 sampleRate = s_sampleRate;
+  if (sampleRate != 0)
+  {
+    if (s_sampleCountdown == 0 || s_sampleCountdown > sampleRate)
+      s_sampleCountdown = sampleRate;
+
+    if (--s_sampleCountdown == 0)
+      RecordStackSample(lock, (uint64)waitTime);
+  }
+}
+
+void LockProfiler::OnReleased(uint32 lock, Y_TIMER_VALUE holdTime)
+{
+  LockCounters& counters = s_lockCounters[lock];
+  Y_AtomicAdd(counters.TotalHoldTime, (int64)holdTime);
+  Y_AtomicFetchMax(counters.MaxHoldTime, (int64)holdTime, ATOMIC_MEMORY_ORDER_RELAXED);
+}
@@ -1,7 +1,14 @@
 #include "YBaseLib/Log.h"
 #include "YBaseLib/Assert.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/BinaryLog.h"
+#include "YBaseLib/ByteStream.h"
 #include "YBaseLib/CString.h"
+#include "YBaseLib/FlightRecorderLogSink.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/SPSCCircularBuffer.h"
 #include "YBaseLib/String.h"
+#include "YBaseLib/Thread.h"
 #include "YBaseLib/Timer.h"
 
 #if defined(Y_PLATFORM_WINDOWS)
@@ -13,15 +20,132 @@
 Log* g_pLog = &Log::GetInstance();
 static Y_TIMER_VALUE s_startTimeStamp;
 
+const uint32 Log::DefaultAsyncBufferSize;
+const uint32 Log::AsyncFlushInterval;
+const uint32 Log::DefaultBinaryOutputLevels;
+
+// Every channel registered, pushed on as they're constructed, mostly during static initialization. Channels made
+// before the log pass every level, which is the log's default.
+static LogChannel* volatile s_pChannels = nullptr;
+
+static inline uint32 GetLevelMask(LOGLEVEL level)
+{
+  return (2u << level) - 1;
+}
+
+// the smallest buffer a thread gets, so the names always fit in a record
+static const uint32 MinAsyncBufferSize = 4096;
+static const uint32 MaxAsyncNameLength = 255;
+
+// A message in a thread's buffer, followed by the channel, function and message text, each nul-terminated.
+struct LogRecordHeader
+{
+  Y_TIMER_VALUE TimeStamp;
+  uint32 Level;
+  uint32 ChannelLength;
+  uint32 FunctionLength;
+  uint32 TextSize;
+};
+
+// Written by its thread alone, and read by whoever holds the drain lock.
+struct LogThreadBuffer
+{
+  LogThreadBuffer(uint32 bufferSize)
+    : Buffer(bufferSize), pNext(nullptr), DroppedCount(0), Released(false), HasStagedRecord(false)
+  {
+  }
+
+  SPSCCircularBuffer Buffer;
+  LogThreadBuffer* pNext;
+  Y_ATOMIC_DECL uint32 DroppedCount;
+  volatile bool Released;
+
+  // The oldest record, read out by the drain and held until it's the oldest of every thread's.
+  LogRecordHeader StagedHeader;
+  PODArray<char> StagedText;
+  bool HasStagedRecord;
+};
+
+Y_DECLARE_THREAD_LOCAL(LogThreadBuffer*) s_pThreadBuffer = nullptr;
+Y_DECLARE_THREAD_LOCAL(bool) s_isAsyncOutputThread = false;
+Y_DECLARE_THREAD_LOCAL(bool) s_isDraining = false;
+
+// when the message being dispatched was written, zero for now
+Y_DECLARE_THREAD_LOCAL(Y_TIMER_VALUE) s_messageTimeStamp = 0;
+
+class Log::AsyncOutputThread : public Thread
+{
+public:
+  AsyncOutputThread(Log* pLog) : m_pLog(pLog), m_stopFlag(false) {}
+
+  // drains what's left once the thread has stopped
+  void Stop()
+  {
+    m_stopFlag = true;
+    m_pLog->m_asyncWakeEvent.Signal();
+    Join();
+  }
+
+  virtual int ThreadEntryPoint() override final
+  {
+    SetDebugName("Log");
+    s_isAsyncOutputThread = true;
+    while (!m_stopFlag)
+    {
+      m_pLog->m_asyncWakeEvent.TryWait(AsyncFlushInterval);
+      m_pLog->m_asyncDrainLock.Lock();
+      m_pLog->DrainAsyncBuffers();
+      m_pLog->m_asyncDrainLock.Unlock();
+    }
+
+    return 0;
+  }
+
+private:
+  Log* m_pLog;
+  volatile bool m_stopFlag;
+};
+
+LogChannel::LogChannel(const char* name) : m_name(name), m_levelMask(GetLevelMask(LOGLEVEL_TRACE)), m_pNext(nullptr)
+{
+  LogChannel* pHead;
+  do
+  {
+    pHead = s_pChannels;
+    m_pNext = pHead;
+  } while (Y_AtomicCompareExchangePointer(s_pChannels, this, pHead) != pHead);
+
+  if (g_pLog != nullptr)
+    g_pLog->RegisterChannel(this);
+}
+
 Log::Log()
+  : m_pAsyncOutputThread(nullptr), m_asyncOutputEnabled(false), m_asyncBufferSize(DefaultAsyncBufferSize),
+    m_pAsyncThreadBuffers(nullptr), m_asyncWakeEvent(true), m_pBinaryOutput(nullptr), m_binaryOutputLevels(0),
+    m_pFlightRecorder(nullptr)
 {
   s_startTimeStamp = Y_TimerGetValue();
   m_filterLevel = LOGLEVEL_TRACE;
+  m_callbackLock.SetProfileName("log.callbacks");
+  m_channelLock.SetProfileName("log.channels");
 }
 
 Log::~Log()
 {
   DebugAssert(g_pLog == this);
+  m_pFlightRecorder = nullptr;
+  SetAsyncOutput(false);
+  SetBinaryOutput(nullptr);
+  Flush();
+
+  // threads that never released theirs have nothing left to write to
+  while (m_pAsyncThreadBuffers != nullptr)
+  {
+    LogThreadBuffer* pBuffer = m_pAsyncThreadBuffers;
+    m_pAsyncThreadBuffers = pBuffer->pNext;
+    delete pBuffer;
+  }
+
   g_pLog = NULL;
 }
 
@@ -56,10 +180,17 @@ void Log::FormatLogMessageForDisplay(const char* channelName, const char* functi
                                      const char* message, void (*printCallback)(const char*, void*),
                                      void* pCallbackUserData)
 {
-  static const char levelCharacters[LOGLEVEL_COUNT] = {'X', 'E', 'W', 'P', 'S', 'I', 'D', 'R', 'B', 'T'};
+  // find time since start of process, to when the message was written for async output
+  Y_TIMER_VALUE timeStamp = (s_messageTimeStamp != 0) ? s_messageTimeStamp : Y_TimerGetValue();
+  FormatLogMessageForDisplay(channelName, functionName, level, Y_TimerConvertToSeconds(timeStamp - s_startTimeStamp),
+                             message, printCallback, pCallbackUserData);
+}
 
-  // find time since start of process
-  float messageTime = (float)Y_TimerConvertToSeconds(Y_TimerGetValue() - s_startTimeStamp);
+void Log::FormatLogMessageForDisplay(const char* channelName, const char* functionName, LOGLEVEL level,
+                                     double messageTime, const char* message,
+                                     void (*printCallback)(const char*, void*), void* pCallbackUserData)
+{
+  static const char levelCharacters[LOGLEVEL_COUNT] = {'X', 'E', 'W', 'P', 'S', 'I', 'D', 'R', 'B', 'T'};
 
   // write prefix
 #ifndef Y_BUILD_CONFIG_SHIPPING
@@ -300,7 +431,299 @@ void Log::SetDebugOutputParams(bool enabled, const char* channelFilter /* = null
 void Log::SetFilterLevel(LOGLEVEL level)
 {
   DebugAssert(level < LOGLEVEL_COUNT);
+  m_channelLock.Lock();
   m_filterLevel = level;
+  for (LogChannel* pChannel = s_pChannels; pChannel != nullptr; pChannel = pChannel->m_pNext)
+    UpdateChannelLevelMask(pChannel);
+  m_channelLock.Unlock();
+}
+
+void Log::SetChannelFilterLevel(const char* channelName, LOGLEVEL level)
+{
+  DebugAssert(level <= LOGLEVEL_COUNT);
+  m_channelLock.Lock();
+
+  if (level < LOGLEVEL_COUNT)
+    m_channelFilterLevels.Set(channelName, level, nullptr);
+  else
+    m_channelFilterLevels.Remove(channelName);
+
+  for (LogChannel* pChannel = s_pChannels; pChannel != nullptr; pChannel = pChannel->m_pNext)
+  {
+    if (Y_strcmp(pChannel->m_name, channelName) == 0)
+      UpdateChannelLevelMask(pChannel);
+  }
+
+  m_channelLock.Unlock();
+}
+
+void Log::RegisterChannel(LogChannel* pChannel)
+{
+  m_channelLock.Lock();
+  UpdateChannelLevelMask(pChannel);
+  m_channelLock.Unlock();
+}
+
+void Log::UpdateChannelLevelMask(LogChannel* pChannel)
+{
+  LOGLEVEL level = m_filterLevel;
+  const StringHashTable<LOGLEVEL>::Member* pMember = m_channelFilterLevels.Find(pChannel->m_name);
+  if (pMember != nullptr)
+    level = Min(level, pMember->Value);
+
+  pChannel->m_levelMask = GetLevelMask(level);
+}
+
+void Log::SetAsyncOutput(bool enabled, uint32 threadBufferSize /* = DefaultAsyncBufferSize */)
+{
+  // buffers already made keep their size
+  m_asyncBufferSize = Max(threadBufferSize, MinAsyncBufferSize);
+  if (enabled == (m_pAsyncOutputThread != nullptr))
+    return;
+
+  if (enabled)
+  {
+    m_pAsyncOutputThread = new AsyncOutputThread(this);
+    if (!m_pAsyncOutputThread->Start())
+    {
+      delete m_pAsyncOutputThread;
+      m_pAsyncOutputThread = nullptr;
+      return;
+    }
+
+    Y_AtomicStoreRelease(m_asyncOutputEnabled, true);
+  }
+  else
+  {
+    // messages written as it's turned off can be left for the next flush
+    Y_AtomicStoreRelease(m_asyncOutputEnabled, false);
+    m_pAsyncOutputThread->Stop();
+    delete m_pAsyncOutputThread;
+    m_pAsyncOutputThread = nullptr;
+    Flush();
+  }
+}
+
+bool Log::SetBinaryOutput(ByteStream* pStream, uint32 levelMask /* = DefaultBinaryOutputLevels */)
+{
+  BinaryLogWriter* pWriter = nullptr;
+  if (pStream != nullptr)
+  {
+    pWriter = new BinaryLogWriter(pStream, s_startTimeStamp);
+    if (pWriter->InErrorState())
+    {
+      delete pWriter;
+      return false;
+    }
+  }
+
+  m_binaryOutputLock.Lock();
+  BinaryLogWriter* pOldWriter = m_pBinaryOutput;
+  m_pBinaryOutput = pWriter;
+  m_binaryOutputLevels = (pWriter != nullptr) ? levelMask : 0;
+  m_binaryOutputLock.Unlock();
+
+  // flushes the stream
+  delete pOldWriter;
+  return true;
+}
+
+void Log::Flush()
+{
+  // a callback flushing, or panicking, would wait on itself
+  if (s_isDraining)
+    return;
+
+  m_asyncDrainLock.Lock();
+  DrainAsyncBuffers();
+  m_asyncDrainLock.Unlock();
+
+  if (m_binaryOutputLevels != 0)
+  {
+    m_binaryOutputLock.Lock();
+    if (m_pBinaryOutput != nullptr)
+      m_pBinaryOutput->Flush();
+    m_binaryOutputLock.Unlock();
+  }
+}
+
+void Log::ReleaseThreadBuffer()
+{
+  // the drain frees it once it's empty
+  LogThreadBuffer* pBuffer = s_pThreadBuffer;
+  if (pBuffer == nullptr)
+    return;
+
+  s_pThreadBuffer = nullptr;
+  Y_AtomicStoreRelease(pBuffer->Released, true);
+}
+
+LogThreadBuffer* Log::GetAsyncThreadBuffer()
+{
+  LogThreadBuffer* pBuffer = s_pThreadBuffer;
+  if (pBuffer != nullptr)
+    return pBuffer;
+
+  pBuffer = new LogThreadBuffer(m_asyncBufferSize);
+  m_asyncThreadBufferLock.Lock();
+  pBuffer->pNext = m_pAsyncThreadBuffers;
+  m_pAsyncThreadBuffers = pBuffer;
+  m_asyncThreadBufferLock.Unlock();
+
+  s_pThreadBuffer = pBuffer;
+  return pBuffer;
+}
+
+bool Log::QueueAsync(const char* channelName, const char* functionName, LOGLEVEL level, const char* message,
+                     uint32 messageLength)
+{
+  LogThreadBuffer* pBuffer = GetAsyncThreadBuffer();
+  size_t bufferSize = pBuffer->Buffer.GetBufferSize();
+
+  LogRecordHeader header;
+  header.TimeStamp = Y_TimerGetValue();
+  header.Level = (uint32)level;
+  header.ChannelLength = Min(Y_strlen(channelName), MaxAsyncNameLength);
+  header.FunctionLength = Min(Y_strlen(functionName), MaxAsyncNameLength);
+
+  // anything past a quarter of the buffer is cut, so a record always has room once the buffer drains
+  uint32 nameSize = header.ChannelLength + header.FunctionLength + 2;
+  messageLength = Min(messageLength, (uint32)(bufferSize / 4 - sizeof(LogRecordHeader)) - nameSize - 1);
+  header.TextSize = nameSize + messageLength + 1;
+
+  // the record goes in with one write, so the drain never sees part of it
+  uint32 recordSize = (uint32)sizeof(LogRecordHeader) + header.TextSize;
+  byte stackRecord[1024];
+  byte* pRecord = (recordSize <= sizeof(stackRecord)) ? stackRecord : (byte*)std::malloc(recordSize);
+  char* pText = reinterpret_cast<char*>(pRecord + sizeof(LogRecordHeader));
+  std::memcpy(pRecord, &header, sizeof(header));
+  std::memcpy(pText, channelName, header.ChannelLength);
+  pText[header.ChannelLength] = '\0';
+  pText += header.ChannelLength + 1;
+  std::memcpy(pText, functionName, header.FunctionLength);
+  pText[header.FunctionLength] = '\0';
+  pText += header.FunctionLength + 1;
+  std::memcpy(pText, message, messageLength);
+  pText[messageLength] = '\0';
+
+  // errors aren't dropped, they wait for the log thread to make room
+  size_t usedBefore = pBuffer->Buffer.GetBufferUsed();
+  bool written = pBuffer->Buffer.Write(pRecord, recordSize);
+  while (!written && level <= LOGLEVEL_ERROR && m_asyncOutputEnabled)
+  {
+    m_asyncWakeEvent.Signal();
+    Thread::Sleep(1);
+    written = pBuffer->Buffer.Write(pRecord, recordSize);
+  }
+
+  if (pRecord != stackRecord)
+    std::free(pRecord);
+
+  if (!written)
+  {
+    if (level <= LOGLEVEL_ERROR)
+      return false;
+
+    Y_AtomicIncrement(pBuffer->DroppedCount);
+    return true;
+  }
+
+  // warnings and errors go out promptly, everything else on the interval unless the buffer is filling up
+  size_t halfBufferSize = bufferSize / 2;
+  if (level <= LOGLEVEL_WARNING || (usedBefore < halfBufferSize && usedBefore + recordSize >= halfBufferSize))
+    m_asyncWakeEvent.Signal();
+
+  return true;
+}
+
+// reads the buffer's oldest record out, if there is one and it hasn't already been
+static void StageRecord(LogThreadBuffer* pBuffer)
+{
+  // each record goes in with one write, so once the header is there the text is too
+  if (pBuffer->HasStagedRecord || !pBuffer->Buffer.Read(&pBuffer->StagedHeader, sizeof(LogRecordHeader)))
+    return;
+
+  pBuffer->StagedText.Resize(pBuffer->StagedHeader.TextSize);
+  bool textRead = pBuffer->Buffer.Read(pBuffer->StagedText.GetBasePointer(), pBuffer->StagedHeader.TextSize);
+  DebugAssert(textRead);
+  UNREFERENCED_PARAMETER(textRead);
+  pBuffer->HasStagedRecord = true;
+}
+
+void Log::DrainAsyncBuffers()
+{
+  // Each thread's records are in order, so the oldest of their first records is the oldest of all of them. Only
+  // records from before the drain started are taken, so threads that keep writing can't hold it up.
+  Y_TIMER_VALUE drainTimeStamp = Y_TimerGetValue();
+  m_asyncThreadBufferLock.Lock();
+  s_isDraining = true;
+
+  for (;;)
+  {
+    LogThreadBuffer* pOldest = nullptr;
+    for (LogThreadBuffer* pBuffer = m_pAsyncThreadBuffers; pBuffer != nullptr; pBuffer = pBuffer->pNext)
+    {
+      StageRecord(pBuffer);
+      if (pBuffer->HasStagedRecord && pBuffer->StagedHeader.TimeStamp <= drainTimeStamp &&
+          (pOldest == nullptr || pBuffer->StagedHeader.TimeStamp < pOldest->StagedHeader.TimeStamp))
+      {
+        pOldest = pBuffer;
+      }
+    }
+    if (pOldest == nullptr)
+      break;
+
+    const LogRecordHeader& header = pOldest->StagedHeader;
+    const char* channelName = pOldest->StagedText.GetBasePointer();
+    const char* functionName = channelName + header.ChannelLength + 1;
+    const char* message = functionName + header.FunctionLength + 1;
+    s_messageTimeStamp = header.TimeStamp;
+    ExecuteCallbacks(channelName, functionName, (LOGLEVEL)header.Level, message);
+    s_messageTimeStamp = 0;
+    pOldest->HasStagedRecord = false;
+  }
+
+  // drops are reported after the messages that made it, and released buffers go once they're empty
+  LogThreadBuffer** ppBuffer = &m_pAsyncThreadBuffers;
+  while (*ppBuffer != nullptr)
+  {
+    LogThreadBuffer* pBuffer = *ppBuffer;
+    uint32 droppedCount = Y_AtomicExchange(pBuffer->DroppedCount, (uint32)0);
+    if (droppedCount > 0)
+    {
+      char message[128];
+      Y_snprintf(message, countof(message), "%u messages dropped, a thread's log buffer was full", droppedCount);
+      ExecuteCallbacks("Log", "Log::DrainAsyncBuffers", LOGLEVEL_WARNING, message);
+    }
+
+    if (Y_AtomicLoadAcquire(pBuffer->Released) && !pBuffer->HasStagedRecord && pBuffer->Buffer.GetBufferUsed() == 0)
+    {
+      *ppBuffer = pBuffer->pNext;
+      delete pBuffer;
+      continue;
+    }
+
+    ppBuffer = &pBuffer->pNext;
+  }
+
+  s_isDraining = false;
+  m_asyncThreadBufferLock.Unlock();
+}
+
+void Log::Dispatch(const char* channelName, const char* functionName, LOGLEVEL level, const char* message,
+                   uint32 messageLength)
+{
+  FlightRecorderLogSink* pFlightRecorder = m_pFlightRecorder;
+  if (pFlightRecorder != nullptr)
+    pFlightRecorder->Record(channelName, functionName, level, message, messageLength);
+
+  if (m_asyncOutputEnabled && !s_isAsyncOutputThread &&
+      QueueAsync(channelName, functionName, level, message, messageLength))
+  {
+    return;
+  }
+
+  ExecuteCallbacks(channelName, functionName, level, message);
 }
 
 void Log::ExecuteCallbacks(const char* channelName, const char* functionName, LOGLEVEL level, const char* message)
@@ -318,7 +741,18 @@ void Log::Write(const char* channelName, const char* functionName, LOGLEVEL leve
   if (level > m_filterLevel)
     return;
 
-  ExecuteCallbacks(channelName, functionName, level, message);
+  uint32 messageLength = Y_strlen(message);
+  if (IsBinaryOutputLevel(level))
+  {
+    m_binaryOutputLock.Lock();
+    bool written = (m_pBinaryOutput != nullptr &&
+                    m_pBinaryOutput->WriteText(channelName, functionName, level, message, messageLength));
+    m_binaryOutputLock.Unlock();
+    if (written)
+      return;
+  }
+
+  Dispatch(channelName, functionName, level, message, messageLength);
 }
 
 void Log::Writef(const char* channelName, const char* functionName, LOGLEVEL level, const char* format, ...)
@@ -337,21 +771,60 @@ void Log::Writev(const char* channelName, const char* functionName, LOGLEVEL lev
   if (level > m_filterLevel)
     return;
 
-  va_list apCopy;
-  va_copy(apCopy, ap);
+  // the binary output takes a copy of the arguments, leaving ap to format with if it can't
+  if (IsBinaryOutputLevel(level))
+  {
+    m_binaryOutputLock.Lock();
+    bool written = (m_pBinaryOutput != nullptr &&
+                    m_pBinaryOutput->WritePrintf(channelName, functionName, level, format, ap));
+    m_binaryOutputLock.Unlock();
+    if (written)
+      return;
+  }
 
-  uint32 requiredSize = Y_vscprintf(format, apCopy);
-  if (requiredSize < 512)
+  // Formatted once into the stack buffer, and only measured and formatted again when it doesn't fit. Windows
+  // gives the truncated length rather than the one needed, so a full buffer is measured to make sure.
+  va_list apMeasure;
+  va_list apFormat;
+  va_copy(apMeasure, ap);
+  va_copy(apFormat, ap);
+
+  char buffer[512];
+  uint32 length = Y_vsnprintf(buffer, countof(buffer), format, ap);
+  if (length >= countof(buffer) - 1)
+    length = Y_vscprintf(format, apMeasure);
+
+  if (length < countof(buffer))
   {
-    char buffer[512];
-    Y_vsnprintf(buffer, countof(buffer), format, ap);
-    ExecuteCallbacks(channelName, functionName, level, buffer);
+    Dispatch(channelName, functionName, level, buffer, length);
   }
   else
   {
-    char* buffer = (char*)std::malloc(requiredSize + 1);
-    Y_vsnprintf(buffer, requiredSize + 1, format, ap);
-    ExecuteCallbacks(channelName, functionName, level, buffer);
-    std::free(buffer);
+    char* heapBuffer = (char*)std::malloc(length + 1);
+    Y_vsnprintf(heapBuffer, length + 1, format, apFormat);
+    Dispatch(channelName, functionName, level, heapBuffer, length);
+    std::free(heapBuffer);
   }
+
+  va_end(apFormat);
+  va_end(apMeasure);
+}
+
+void Log::WriteFormatted(const char* channelName, const char* functionName, LOGLEVEL level, const StringView& format,
+                         const TypedFormat::Argument* pArguments, uint32 argumentCount)
+{
+  if (IsBinaryOutputLevel(level))
+  {
+    m_binaryOutputLock.Lock();
+    bool written = (m_pBinaryOutput != nullptr && m_pBinaryOutput->WriteFormatted(channelName, functionName, level,
+                                                                                  format, pArguments, argumentCount));
+    m_binaryOutputLock.Unlock();
+    if (written)
+      return;
+  }
+
+  // formatted straight into the buffer, which only moves to the heap for long messages
+  StackString<512> message;
+  TypedFormat::AppendFormatted(message, format, pArguments, argumentCount);
+  Dispatch(channelName, functionName, level, message.GetCharArray(), message.GetLength());
 }
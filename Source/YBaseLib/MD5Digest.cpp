@@ -135,17 +135,17 @@ void MD5Digest::Reset()
   this->bits[1] = 0;
 }
 
-void MD5Digest::Update(const void* pData, uint32 cbData)
+void MD5Digest::Update(const void* pData, size_t cbData)
 {
-  uint32 t;
+  size_t t;
   const byte* pByteData = reinterpret_cast<const byte*>(pData);
 
   /* Update bitcount */
 
   t = this->bits[0];
-  if ((this->bits[0] = t + ((uint32)cbData << 3)) < t)
-    this->bits[1]++; /* Carry from low to high */
-  this->bits[1] += cbData >> 29;
+  uint64 bitCount = ((((uint64)this->bits[1] << 32) | this->bits[0]) + ((uint64)cbData << 3));
+  this->bits[0] = (uint32)bitCount;
+  this->bits[1] = (uint32)(bitCount >> 32);
 
   t = (t >> 3) & 0x3f; /* Bytes already in shsInfo->data */
 
@@ -0,0 +1,271 @@
+#include "YBaseLib/MappedHashIndex.h"
+#include "YBaseLib/BinaryBlob.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Math.h"
+#include "YBaseLib/XXHash64Digest.h"
+#include <cstring>
+Log_SetChannel(MappedHashIndex);
+
+using namespace MappedHashIndexFormat;
+
+static const uint32 INITIAL_SLOT_COUNT = 16;
+
+static inline uint32 GetTag(uint64 hash)
+{
+  uint32 tag = (uint32)(hash >> 32);
+  return (tag != 0) ? tag : 1;
+}
+
+// from the start of an entry, after the value's size, the key and its terminator
+static inline uint64 GetValueOffset(uint32 keyLength)
+{
+  return ALIGNED_SIZE((uint64)sizeof(uint32) + keyLength + 1, (uint64)ValueAlignment);
+}
+
+MappedHashIndexWriter::MappedHashIndexWriter() : m_entryCount(0)
+{
+  Clear();
+}
+
+MappedHashIndexWriter::~MappedHashIndexWriter() {}
+
+void MappedHashIndexWriter::Clear()
+{
+  m_slots.Resize(INITIAL_SLOT_COUNT);
+  Y_memzero(m_slots.GetBasePointer(), sizeof(Slot) * m_slots.GetSize());
+  m_pool.Clear();
+  m_entryCount = 0;
+}
+
+uint32 MappedHashIndexWriter::FindSlot(const char* pKey, uint32 keyLength, uint64 hash) const
+{
+  uint32 mask = m_slots.GetSize() - 1;
+  uint32 tag = GetTag(hash);
+  for (uint32 index = (uint32)hash & mask;; index = (index + 1) & mask)
+  {
+    const Slot& slot = m_slots[index];
+    if (slot.Tag == 0 ||
+        (slot.Tag == tag && slot.KeyLength == keyLength &&
+         std::memcmp(m_pool.GetBasePointer() + slot.EntryOffset + sizeof(uint32), pKey, keyLength) == 0))
+    {
+      return index;
+    }
+  }
+}
+
+void MappedHashIndexWriter::Grow()
+{
+  PODArray<Slot> oldSlots;
+  oldSlots.Swap(m_slots);
+  m_slots.Resize(oldSlots.GetSize() * 2);
+  Y_memzero(m_slots.GetBasePointer(), sizeof(Slot) * m_slots.GetSize());
+
+  // the keys are all different, so each goes in the first empty slot from where it hashes to
+  for (const Slot& slot : oldSlots)
+  {
+    if (slot.Tag == 0)
+      continue;
+
+    const char* pKey = reinterpret_cast<const char*>(m_pool.GetBasePointer() + slot.EntryOffset + sizeof(uint32));
+    uint64 hash = XXHash64Digest::Hash(pKey, slot.KeyLength);
+    m_slots[FindSlot(pKey, slot.KeyLength, hash)] = slot;
+  }
+}
+
+bool MappedHashIndexWriter::Add(const StringView& key, const void* pValue, uint32 valueSize)
+{
+  // three quarters full at most, which keeps probes short and leaves empty slots to end them
+  if ((m_entryCount + 1) * 4 > m_slots.GetSize() * 3)
+    Grow();
+
+  uint64 hash = XXHash64Digest::Hash(key.GetData(), key.GetLength());
+  uint32 index = FindSlot(key.GetData(), key.GetLength(), hash);
+  if (m_slots[index].Tag != 0)
+    return false;
+
+  // entries start aligned, as the pool does, and so do their values
+  uint32 entryOffset = m_pool.GetSize();
+  uint32 valueOffset = entryOffset + (uint32)GetValueOffset(key.GetLength());
+  m_pool.Resize(valueOffset + (uint32)ALIGNED_SIZE((uint64)valueSize, (uint64)ValueAlignment));
+  Y_memzero(m_pool.GetBasePointer() + entryOffset, m_pool.GetSize() - entryOffset);
+  std::memcpy(m_pool.GetBasePointer() + entryOffset, &valueSize, sizeof(valueSize));
+  std::memcpy(m_pool.GetBasePointer() + entryOffset + sizeof(uint32), key.GetData(), key.GetLength());
+  if (valueSize > 0)
+    std::memcpy(m_pool.GetBasePointer() + valueOffset, pValue, valueSize);
+
+  Slot& slot = m_slots[index];
+  slot.Tag = GetTag(hash);
+  slot.KeyLength = key.GetLength();
+  slot.EntryOffset = entryOffset;
+  m_entryCount++;
+  return true;
+}
+
+bool MappedHashIndexWriter::Write(ByteStream* pStream) const
+{
+  Header header;
+  header.Magic = MappedHashIndexFormat::Magic;
+  header.Version = MappedHashIndexFormat::Version;
+  header.SlotCount = m_slots.GetSize();
+  header.EntryCount = m_entryCount;
+  header.PoolSize = m_pool.GetSize();
+  header.Reserved = 0;
+
+  uint64 slotsSize = (uint64)sizeof(Slot) * m_slots.GetSize();
+  if (pStream->Write64(&header, sizeof(header)) != sizeof(header) ||
+      pStream->Write64(m_slots.GetBasePointer(), slotsSize) != slotsSize ||
+      pStream->Write64(m_pool.GetBasePointer(), m_pool.GetSize()) != m_pool.GetSize())
+  {
+    Log_ErrorPrint("MappedHashIndexWriter::Write: failed to write the index");
+    return false;
+  }
+
+  return true;
+}
+
+bool MappedHashIndexWriter::WriteFile(const char* fileName) const
+{
+  ByteStream* pStream;
+  if (!ByteStream_OpenFileStream(fileName,
+                                 BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_TRUNCATE |
+                                   BYTESTREAM_OPEN_ATOMIC_UPDATE,
+                                 &pStream))
+  {
+    Log_ErrorPrintf("MappedHashIndexWriter::WriteFile: failed to open '%s'", fileName);
+    return false;
+  }
+
+  bool result = Write(pStream) && pStream->Commit();
+  if (!result)
+    pStream->Discard();
+
+  pStream->Release();
+  return result;
+}
+
+MappedHashIndex::MappedHashIndex()
+  : m_pImage(nullptr), m_pHeader(nullptr), m_pSlots(nullptr), m_pPool(nullptr), m_slotMask(0)
+{
+}
+
+MappedHashIndex::~MappedHashIndex()
+{
+  Close();
+}
+
+bool MappedHashIndex::Open(ByteStream* pStream)
+{
+  Close();
+
+  BinaryBlob* pImage = BinaryBlob::CreateFromMappedStream(pStream);
+  if (pImage == nullptr)
+  {
+    Log_ErrorPrint("MappedHashIndex::Open: failed to read the stream");
+    return false;
+  }
+
+  // memory streams can start anywhere, which the fields can't
+  if (((uintptr_t)pImage->GetDataPointer() % ValueAlignment) != 0)
+  {
+    BinaryBlob* pCopy = BinaryBlob::CreateFromPointer(pImage->GetDataPointer(), pImage->GetDataSize());
+    pImage->Release();
+    pImage = pCopy;
+  }
+
+  // sizes are compared by what's left, so a damaged one can't overflow
+  const byte* pData = pImage->GetDataPointer();
+  uint64 imageSize = pImage->GetDataSize();
+  const Header* pHeader = reinterpret_cast<const Header*>(pData);
+  if (imageSize < sizeof(Header) || pHeader->Magic != MappedHashIndexFormat::Magic ||
+      pHeader->Version != MappedHashIndexFormat::Version || !Y_ispow2(pHeader->SlotCount) ||
+      pHeader->EntryCount >= pHeader->SlotCount ||
+      (uint64)sizeof(Slot) * pHeader->SlotCount > imageSize - sizeof(Header) ||
+      pHeader->PoolSize > imageSize - sizeof(Header) - (uint64)sizeof(Slot) * pHeader->SlotCount)
+  {
+    Log_ErrorPrint("MappedHashIndex::Open: the stream is not a valid hash index");
+    pImage->Release();
+    return false;
+  }
+
+  m_pImage = pImage;
+  m_pHeader = pHeader;
+  m_pSlots = reinterpret_cast<const Slot*>(pData + sizeof(Header));
+  m_pPool = pData + sizeof(Header) + (uint64)sizeof(Slot) * pHeader->SlotCount;
+  m_slotMask = pHeader->SlotCount - 1;
+  return true;
+}
+
+bool MappedHashIndex::OpenFile(const char* fileName)
+{
+  ByteStream* pStream;
+  if (!ByteStream_OpenFileStream(fileName, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_MAPPED, &pStream))
+  {
+    Log_ErrorPrintf("MappedHashIndex::OpenFile: failed to open '%s'", fileName);
+    return false;
+  }
+
+  // a mapped image keeps its own reference to the stream
+  bool result = Open(pStream);
+  pStream->Release();
+  return result;
+}
+
+void MappedHashIndex::Close()
+{
+  if (m_pImage != nullptr)
+  {
+    m_pImage->Release();
+    m_pImage = nullptr;
+  }
+
+  m_pHeader = nullptr;
+  m_pSlots = nullptr;
+  m_pPool = nullptr;
+  m_slotMask = 0;
+}
+
+const void* MappedHashIndex::Find(const StringView& key, uint32* pValueSize /*= nullptr*/) const
+{
+  if (m_pHeader == nullptr)
+    return nullptr;
+
+  uint64 hash = XXHash64Digest::Hash(key.GetData(), key.GetLength());
+  uint32 tag = GetTag(hash);
+  uint64 poolSize = m_pHeader->PoolSize;
+
+  // a damaged image might have no empty slot, so the probe stops after every slot's been seen
+  uint32 index = (uint32)hash & m_slotMask;
+  for (uint32 probes = 0; probes <= m_slotMask; probes++, index = (index + 1) & m_slotMask)
+  {
+    const Slot& slot = m_pSlots[index];
+    if (slot.Tag == 0)
+      return nullptr;
+    if (slot.Tag != tag || slot.KeyLength != key.GetLength())
+      continue;
+
+    // the entry has to be in the pool, and where the value can be aligned, or the image is damaged
+    uint64 valueOffset = GetValueOffset(slot.KeyLength);
+    if ((slot.EntryOffset % ValueAlignment) != 0 || slot.EntryOffset > poolSize ||
+        valueOffset > poolSize - slot.EntryOffset)
+    {
+      return nullptr;
+    }
+
+    const byte* pEntry = m_pPool + slot.EntryOffset;
+    if (std::memcmp(pEntry + sizeof(uint32), key.GetData(), key.GetLength()) != 0)
+      continue;
+
+    uint32 valueSize;
+    std::memcpy(&valueSize, pEntry, sizeof(valueSize));
+    if (valueSize > poolSize - slot.EntryOffset - valueOffset)
+      return nullptr;
+
+    if (pValueSize != nullptr)
+      *pValueSize = valueSize;
+
+    return pEntry + valueOffset;
+  }
+
+  return nullptr;
+}
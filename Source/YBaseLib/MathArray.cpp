@@ -0,0 +1,250 @@
+#include "YBaseLib/CPUID.h"
+#include "YBaseLib/Math.h"
+#include "MathArrayKernels.h"
+
+#if defined(Y_MATH_ARRAY_X86)
+
+struct SSE2Ops
+{
+  typedef __m128 Float;
+  typedef __m128i Int;
+  typedef __m128 Mask;
+  static const uint32 Width = 4;
+
+  static Float Load(const float* p) { return _mm_loadu_ps(p); }
+  static void Store(float* p, Float v) { _mm_storeu_ps(p, v); }
+  static Float Set(float v) { return _mm_set1_ps(v); }
+  static Int SetInt(int32 v) { return _mm_set1_epi32(v); }
+
+  static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+  static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+  static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+  static Float MulAdd(Float a, Float b, Float c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+  static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+  static Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+
+  static Mask Less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+  static Mask Equal(Float a, Float b) { return _mm_cmpeq_ps(a, b); }
+  static Mask Or(Mask a, Mask b) { return _mm_or_ps(a, b); }
+  static Float Select(Mask mask, Float a, Float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+  static Float Xor(Float a, Float b) { return _mm_xor_ps(a, b); }
+
+  static Int RoundToInt(Float v) { return _mm_cvtps_epi32(v); }
+  static Float ToFloat(Int v) { return _mm_cvtepi32_ps(v); }
+  static Int AsInt(Float v) { return _mm_castps_si128(v); }
+  static Float AsFloat(Int v) { return _mm_castsi128_ps(v); }
+
+  static Int IntAdd(Int a, Int b) { return _mm_add_epi32(a, b); }
+  static Int IntSub(Int a, Int b) { return _mm_sub_epi32(a, b); }
+  static Int IntAnd(Int a, Int b) { return _mm_and_si128(a, b); }
+  static Int IntOr(Int a, Int b) { return _mm_or_si128(a, b); }
+  static Mask IntEqual(Int a, Int b) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b)); }
+  template<int N>
+  static Int ShiftLeft(Int v)
+  {
+    return _mm_slli_epi32(v, N);
+  }
+  template<int N>
+  static Int ShiftRight(Int v)
+  {
+    return _mm_srli_epi32(v, N);
+  }
+
+  // the estimate has 12 bits, one Newton-Raphson step brings it to about 23
+  static Float RsqrtEstimate(Float v) { return _mm_rsqrt_ps(v); }
+  static Float RsqrtRefine(Float v, Float estimate)
+  {
+    Float halfVR2 = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), v), _mm_mul_ps(estimate, estimate));
+    return _mm_mul_ps(estimate, _mm_sub_ps(_mm_set1_ps(1.5f), halfVR2));
+  }
+};
+
+#elif defined(Y_MATH_ARRAY_NEON)
+
+struct NEONOps
+{
+  typedef float32x4_t Float;
+  typedef int32x4_t Int;
+  typedef uint32x4_t Mask;
+  static const uint32 Width = 4;
+
+  static Float Load(const float* p) { return vld1q_f32(p); }
+  static void Store(float* p, Float v) { vst1q_f32(p, v); }
+  static Float Set(float v) { return vdupq_n_f32(v); }
+  static Int SetInt(int32 v) { return vdupq_n_s32(v); }
+
+  static Float Add(Float a, Float b) { return vaddq_f32(a, b); }
+  static Float Sub(Float a, Float b) { return vsubq_f32(a, b); }
+  static Float Mul(Float a, Float b) { return vmulq_f32(a, b); }
+  static Float MulAdd(Float a, Float b, Float c) { return vfmaq_f32(c, a, b); }
+
+  // NaN in a gives b, like the other versions, rather than the NaN vminq/vmaxq would
+  static Float Min(Float a, Float b) { return vbslq_f32(vcltq_f32(a, b), a, b); }
+  static Float Max(Float a, Float b) { return vbslq_f32(vcgtq_f32(a, b), a, b); }
+
+  static Mask Less(Float a, Float b) { return vcltq_f32(a, b); }
+  static Mask Equal(Float a, Float b) { return vceqq_f32(a, b); }
+  static Mask Or(Mask a, Mask b) { return vorrq_u32(a, b); }
+  static Float Select(Mask mask, Float a, Float b) { return vbslq_f32(mask, a, b); }
+  static Float Xor(Float a, Float b) { return AsFloat(veorq_s32(AsInt(a), AsInt(b))); }
+
+  static Int RoundToInt(Float v) { return vcvtnq_s32_f32(v); }
+  static Float ToFloat(Int v) { return vcvtq_f32_s32(v); }
+  static Int AsInt(Float v) { return vreinterpretq_s32_f32(v); }
+  static Float AsFloat(Int v) { return vreinterpretq_f32_s32(v); }
+
+  static Int IntAdd(Int a, Int b) { return vaddq_s32(a, b); }
+  static Int IntSub(Int a, Int b) { return vsubq_s32(a, b); }
+  static Int IntAnd(Int a, Int b) { return vandq_s32(a, b); }
+  static Int IntOr(Int a, Int b) { return vorrq_s32(a, b); }
+  static Mask IntEqual(Int a, Int b) { return vceqq_s32(a, b); }
+  template<int N>
+  static Int ShiftLeft(Int v)
+  {
+    return vshlq_n_s32(v, N);
+  }
+  template<int N>
+  static Int ShiftRight(Int v)
+  {
+    return vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(v), N));
+  }
+
+  // the estimate has 8 bits, each step roughly doubles that
+  static Float RsqrtEstimate(Float v) { return vrsqrteq_f32(v); }
+  static Float RsqrtRefine(Float v, Float estimate)
+  {
+    estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(v, estimate), estimate));
+    estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(v, estimate), estimate));
+    return estimate;
+  }
+};
+
+#endif
+
+MATH_ARRAY_KERNELS(Scalar, ScalarOps)
+
+// The AVX2 kernels are in MathArrayAVX2.cpp and the F16C ones in MathArrayF16C.cpp.
+#if defined(Y_MATH_ARRAY_X86)
+
+MATH_ARRAY_KERNELS(SSE2, SSE2Ops)
+#define MATH_ARRAY_SELECT(Name)                                                                                        \
+  (Y_CPUHasFeatures(Y_CPU_FEATURE_AVX2 | Y_CPU_FEATURE_FMA) ? GetMathArrayKernelsAVX2()->Name : Name##SSE2)
+#define MATH_HALF_SELECT(Name) (Y_CPUHasFeatures(Y_CPU_FEATURE_F16C) ? GetMathHalfKernelsF16C()->Name : Name##Scalar)
+
+#elif defined(Y_MATH_ARRAY_NEON)
+
+MATH_ARRAY_KERNELS(NEON, NEONOps)
+#define MATH_ARRAY_SELECT(Name) Name##NEON
+
+static void FloatToHalfNEON(uint16* pResult, const float* pValues, uint32 count)
+{
+  uint32 i = 0;
+  for (; (i + 4) <= count; i += 4)
+    vst1_u16(pResult + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(pValues + i))));
+
+  FloatToHalfScalar(pResult + i, pValues + i, count - i);
+}
+
+static void HalfToFloatNEON(float* pResult, const uint16* pValues, uint32 count)
+{
+  uint32 i = 0;
+  for (; (i + 4) <= count; i += 4)
+    vst1q_f32(pResult + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(pValues + i))));
+
+  HalfToFloatScalar(pResult + i, pValues + i, count - i);
+}
+
+#define MATH_HALF_SELECT(Name) Name##NEON
+
+#else
+
+#define MATH_ARRAY_SELECT(Name) Name##Scalar
+#define MATH_HALF_SELECT(Name) Name##Scalar
+
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------
+// dispatch
+//---------------------------------------------------------------------------------------------------------------------
+
+static decltype(&SinCosScalar) SelectSinCos()
+{
+  return MATH_ARRAY_SELECT(SinCos);
+}
+static decltype(&RsqrtScalar) SelectRsqrt()
+{
+  return MATH_ARRAY_SELECT(Rsqrt);
+}
+static decltype(&ExpScalar) SelectExp()
+{
+  return MATH_ARRAY_SELECT(Exp);
+}
+static decltype(&LogScalar) SelectLog()
+{
+  return MATH_ARRAY_SELECT(Log);
+}
+static decltype(&ClampScalar) SelectClamp()
+{
+  return MATH_ARRAY_SELECT(Clamp);
+}
+static decltype(&LerpScalar) SelectLerp()
+{
+  return MATH_ARRAY_SELECT(Lerp);
+}
+static decltype(&FloatToHalfScalar) SelectFloatToHalf()
+{
+  return MATH_HALF_SELECT(FloatToHalf);
+}
+static decltype(&HalfToFloatScalar) SelectHalfToFloat()
+{
+  return MATH_HALF_SELECT(HalfToFloat);
+}
+
+Y_CPU_DISPATCH(s_pSinCos, SinCosScalar, SelectSinCos);
+Y_CPU_DISPATCH(s_pRsqrt, RsqrtScalar, SelectRsqrt);
+Y_CPU_DISPATCH(s_pExp, ExpScalar, SelectExp);
+Y_CPU_DISPATCH(s_pLog, LogScalar, SelectLog);
+Y_CPU_DISPATCH(s_pClamp, ClampScalar, SelectClamp);
+Y_CPU_DISPATCH(s_pLerp, LerpScalar, SelectLerp);
+Y_CPU_DISPATCH(s_pFloatToHalf, FloatToHalfScalar, SelectFloatToHalf);
+Y_CPU_DISPATCH(s_pHalfToFloat, HalfToFloatScalar, SelectHalfToFloat);
+
+void Y_sincosf_array(float* pSinv, float* pCosv, const float* pValues, uint32 count)
+{
+  s_pSinCos(pSinv, pCosv, pValues, count);
+}
+
+void Y_rsqrtf_array(float* pResult, const float* pValues, uint32 count)
+{
+  s_pRsqrt(pResult, pValues, count);
+}
+
+void Y_expf_array(float* pResult, const float* pValues, uint32 count)
+{
+  s_pExp(pResult, pValues, count);
+}
+
+void Y_logf_array(float* pResult, const float* pValues, uint32 count)
+{
+  s_pLog(pResult, pValues, count);
+}
+
+void Y_fclamp_array(float* pResult, const float* pValues, float min, float max, uint32 count)
+{
+  s_pClamp(pResult, pValues, min, max, count);
+}
+
+void Y_lerpf_array(float* pResult, const float* pStart, const float* pEnd, float factor, uint32 count)
+{
+  s_pLerp(pResult, pStart, pEnd, factor, count);
+}
+
+void Y_floattohalf_array(uint16* pResult, const float* pValues, uint32 count)
+{
+  s_pFloatToHalf(pResult, pValues, count);
+}
+
+void Y_halftofloat_array(float* pResult, const uint16* pValues, uint32 count)
+{
+  s_pHalfToFloat(pResult, pValues, count);
+}
@@ -0,0 +1,94 @@
+#include "YBaseLib/Math.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <immintrin.h>
+
+// Everything after the library headers is built for AVX2 and FMA, the shared kernel templates as well as the
+// operations, so AVX vectors only ever pass between functions that have it enabled. MSVC gets /arch:AVX2 for this
+// file instead.
+#if defined(Y_COMPILER_GCC)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#elif defined(Y_COMPILER_CLANG)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#endif
+
+#include "MathArrayKernels.h"
+
+namespace {
+
+struct AVX2Ops
+{
+  typedef __m256 Float;
+  typedef __m256i Int;
+  typedef __m256 Mask;
+  static const uint32 Width = 8;
+
+  static Float Load(const float* p) { return _mm256_loadu_ps(p); }
+  static void Store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+  static Float Set(float v) { return _mm256_set1_ps(v); }
+  static Int SetInt(int32 v) { return _mm256_set1_epi32(v); }
+
+  static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+  static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+  static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+  static Float MulAdd(Float a, Float b, Float c) { return _mm256_fmadd_ps(a, b, c); }
+  static Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+  static Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+
+  static Mask Less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static Mask Equal(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+  static Mask Or(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+  static Float Select(Mask mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+  static Float Xor(Float a, Float b) { return _mm256_xor_ps(a, b); }
+
+  static Int RoundToInt(Float v) { return _mm256_cvtps_epi32(v); }
+  static Float ToFloat(Int v) { return _mm256_cvtepi32_ps(v); }
+  static Int AsInt(Float v) { return _mm256_castps_si256(v); }
+  static Float AsFloat(Int v) { return _mm256_castsi256_ps(v); }
+
+  static Int IntAdd(Int a, Int b) { return _mm256_add_epi32(a, b); }
+  static Int IntSub(Int a, Int b) { return _mm256_sub_epi32(a, b); }
+  static Int IntAnd(Int a, Int b) { return _mm256_and_si256(a, b); }
+  static Int IntOr(Int a, Int b) { return _mm256_or_si256(a, b); }
+  static Mask IntEqual(Int a, Int b) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)); }
+  template<int N>
+  static Int ShiftLeft(Int v)
+  {
+    return _mm256_slli_epi32(v, N);
+  }
+  template<int N>
+  static Int ShiftRight(Int v)
+  {
+    return _mm256_srli_epi32(v, N);
+  }
+
+  static Float RsqrtEstimate(Float v) { return _mm256_rsqrt_ps(v); }
+  static Float RsqrtRefine(Float v, Float estimate)
+  {
+    Float halfVR2 = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), v), _mm256_mul_ps(estimate, estimate));
+    return _mm256_mul_ps(estimate, _mm256_sub_ps(_mm256_set1_ps(1.5f), halfVR2));
+  }
+};
+
+} // namespace
+
+MATH_ARRAY_KERNELS(AVX2, AVX2Ops)
+
+static const MathArrayKernels s_kernelsAVX2 = {&SinCosAVX2, &RsqrtAVX2, &ExpAVX2, &LogAVX2, &ClampAVX2, &LerpAVX2};
+
+const MathArrayKernels* GetMathArrayKernelsAVX2()
+{
+  return &s_kernelsAVX2;
+}
+
+#if defined(Y_COMPILER_GCC)
+#pragma GCC pop_options
+#elif defined(Y_COMPILER_CLANG)
+#pragma clang attribute pop
+#endif
+
+#endif
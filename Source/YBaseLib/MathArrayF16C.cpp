@@ -0,0 +1,57 @@
+#include "YBaseLib/Math.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <immintrin.h>
+
+// Everything after the library headers is built for F16C and the AVX its 256-bit forms need, the scalar tails
+// included. MSVC gets /arch:AVX for this file instead.
+#if defined(Y_COMPILER_GCC)
+#pragma GCC push_options
+#pragma GCC target("avx,f16c")
+#elif defined(Y_COMPILER_CLANG)
+#pragma clang attribute push(__attribute__((target("avx,f16c"))), apply_to = function)
+#endif
+
+#include "MathArrayKernels.h"
+
+static void FloatToHalfF16C(uint16* pResult, const float* pValues, uint32 count)
+{
+  uint32 i = 0;
+  for (; (i + 8) <= count; i += 8)
+  {
+    __m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(pValues + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pResult + i), halves);
+  }
+
+  FloatToHalfScalar(pResult + i, pValues + i, count - i);
+}
+
+static void HalfToFloatF16C(float* pResult, const uint16* pValues, uint32 count)
+{
+  uint32 i = 0;
+  for (; (i + 8) <= count; i += 8)
+  {
+    __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pValues + i));
+    _mm256_storeu_ps(pResult + i, _mm256_cvtph_ps(halves));
+  }
+
+  HalfToFloatScalar(pResult + i, pValues + i, count - i);
+}
+
+static const MathHalfKernels s_kernelsF16C = {&FloatToHalfF16C, &HalfToFloatF16C};
+
+const MathHalfKernels* GetMathHalfKernelsF16C()
+{
+  return &s_kernelsF16C;
+}
+
+#if defined(Y_COMPILER_GCC)
+#pragma GCC pop_options
+#elif defined(Y_COMPILER_CLANG)
+#pragma clang attribute pop
+#endif
+
+#endif
@@ -0,0 +1,399 @@
+#pragma once
+#include "YBaseLib/Math.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// The kernels and the operations they're written against, shared by MathArray.cpp and the translation units built
+// for other instruction sets. Everything but the kernel tables is in an anonymous namespace, so each of those gets
+// its own copy compiled for its own instruction set, and none is picked over another at link time.
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <immintrin.h>
+#define Y_MATH_ARRAY_X86 1
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_MATH_ARRAY_NEON 1
+#endif
+
+#if defined(Y_MATH_ARRAY_X86)
+
+struct MathArrayKernels
+{
+  void (*SinCos)(float* pSinv, float* pCosv, const float* pValues, uint32 count);
+  void (*Rsqrt)(float* pResult, const float* pValues, uint32 count);
+  void (*Exp)(float* pResult, const float* pValues, uint32 count);
+  void (*Log)(float* pResult, const float* pValues, uint32 count);
+  void (*Clamp)(float* pResult, const float* pValues, float min, float max, uint32 count);
+  void (*Lerp)(float* pResult, const float* pStart, const float* pEnd, float factor, uint32 count);
+};
+
+struct MathHalfKernels
+{
+  void (*FloatToHalf)(uint16* pResult, const float* pValues, uint32 count);
+  void (*HalfToFloat)(float* pResult, const uint16* pValues, uint32 count);
+};
+
+// In MathArrayAVX2.cpp and MathArrayF16C.cpp, which are built for AVX2 and FMA, and for F16C. So each is only to be
+// called once the cpu is known to have those.
+const MathArrayKernels* GetMathArrayKernelsAVX2();
+const MathHalfKernels* GetMathHalfKernelsF16C();
+
+#endif
+
+namespace {
+
+// the Y_FLT_ values are function calls, these fold into the kernels
+static const float s_infinity = std::numeric_limits<float>::infinity();
+static const float s_nan = std::numeric_limits<float>::quiet_NaN();
+static const float s_minNormal = std::numeric_limits<float>::min();
+
+// The kernels are written once against a small set of operations, which each instruction set provides as a struct
+// of static functions. Masks are whatever the compares return, all bits set for true. Values past the last whole
+// vector go through the same kernel in a padded copy, so every element gets the same arithmetic.
+
+struct ScalarOps
+{
+  typedef float Float;
+  typedef int32 Int;
+  typedef bool Mask;
+  static const uint32 Width = 1;
+
+  static Float Load(const float* p) { return *p; }
+  static void Store(float* p, Float v) { *p = v; }
+  static Float Set(float v) { return v; }
+  static Int SetInt(int32 v) { return v; }
+
+  static Float Add(Float a, Float b) { return a + b; }
+  static Float Sub(Float a, Float b) { return a - b; }
+  static Float Mul(Float a, Float b) { return a * b; }
+  static Float MulAdd(Float a, Float b, Float c) { return a * b + c; }
+
+  // NaN in a gives b, as with the SSE instructions
+  static Float Min(Float a, Float b) { return (a < b) ? a : b; }
+  static Float Max(Float a, Float b) { return (a > b) ? a : b; }
+
+  static Mask Less(Float a, Float b) { return (a < b); }
+  static Mask Equal(Float a, Float b) { return (a == b); }
+  static Mask Or(Mask a, Mask b) { return (a || b); }
+  static Float Select(Mask mask, Float a, Float b) { return mask ? a : b; }
+  static Float Xor(Float a, Float b) { return AsFloat(AsInt(a) ^ AsInt(b)); }
+
+  static Int RoundToInt(Float v) { return static_cast<Int>(std::nearbyint(v)); }
+  static Float ToFloat(Int v) { return static_cast<Float>(v); }
+  static Int AsInt(Float v)
+  {
+    Int result;
+    std::memcpy(&result, &v, sizeof(result));
+    return result;
+  }
+  static Float AsFloat(Int v)
+  {
+    Float result;
+    std::memcpy(&result, &v, sizeof(result));
+    return result;
+  }
+
+  static Int IntAdd(Int a, Int b) { return a + b; }
+  static Int IntSub(Int a, Int b) { return a - b; }
+  static Int IntAnd(Int a, Int b) { return a & b; }
+  static Int IntOr(Int a, Int b) { return a | b; }
+  static Mask IntEqual(Int a, Int b) { return (a == b); }
+  template<int N>
+  static Int ShiftLeft(Int v)
+  {
+    return static_cast<Int>(static_cast<uint32>(v) << N);
+  }
+  template<int N>
+  static Int ShiftRight(Int v)
+  {
+    return static_cast<Int>(static_cast<uint32>(v) >> N);
+  }
+
+  static Float RsqrtEstimate(Float v) { return 1.0f / std::sqrt(v); }
+  static Float RsqrtRefine(Float v, Float estimate) { return estimate; }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+// kernels
+//---------------------------------------------------------------------------------------------------------------------
+
+// Reduces by the nearest multiple of pi/2, with pi/2 split in three so the products with the quadrant are exact, then
+// evaluates both minimax polynomials (from Cephes) on [-pi/4, pi/4]. The quadrant swaps and negates the results.
+template<class V>
+static void SinCosVector(typename V::Float* pSinv, typename V::Float* pCosv, typename V::Float v)
+{
+  typedef typename V::Float Float;
+  typedef typename V::Int Int;
+
+  Int quadrant = V::RoundToInt(V::Mul(v, V::Set(0.636619772367581343f)));
+  Float q = V::ToFloat(quadrant);
+  Float r = V::MulAdd(q, V::Set(-1.5703125f), v);
+  r = V::MulAdd(q, V::Set(-4.837512969970703125e-4f), r);
+  r = V::MulAdd(q, V::Set(-7.54978995489188216e-8f), r);
+  Float r2 = V::Mul(r, r);
+
+  Float s = V::MulAdd(V::Set(-1.9515295891e-4f), r2, V::Set(8.3321608736e-3f));
+  s = V::MulAdd(s, r2, V::Set(-1.6666654611e-1f));
+  s = V::MulAdd(s, V::Mul(r2, r), r);
+
+  Float c = V::MulAdd(V::Set(2.443315711809948e-5f), r2, V::Set(-1.388731625493765e-3f));
+  c = V::MulAdd(c, r2, V::Set(4.166664568298827e-2f));
+  c = V::MulAdd(c, V::Mul(r2, r2), V::MulAdd(V::Set(-0.5f), r2, V::Set(1.0f)));
+
+  // odd quadrants swap sin and cos, sin is negative in quadrants 2 and 3, cos in 1 and 2
+  typename V::Mask swap = V::IntEqual(V::IntAnd(quadrant, V::SetInt(1)), V::SetInt(1));
+  Int sinSign = V::template ShiftLeft<30>(V::IntAnd(quadrant, V::SetInt(2)));
+  Int cosSign = V::template ShiftLeft<30>(V::IntAnd(V::IntAdd(quadrant, V::SetInt(1)), V::SetInt(2)));
+  *pSinv = V::Xor(V::Select(swap, c, s), V::AsFloat(sinSign));
+  *pCosv = V::Xor(V::Select(swap, s, c), V::AsFloat(cosSign));
+}
+
+template<class V>
+struct RsqrtKernel
+{
+  typename V::Float operator()(typename V::Float v) const
+  {
+    // refining the estimates for zero and infinity would give NaN, they're exact anyway
+    typename V::Float estimate = V::RsqrtEstimate(v);
+    typename V::Mask special = V::Or(V::Equal(v, V::Set(0.0f)), V::Equal(v, V::Set(s_infinity)));
+    return V::Select(special, estimate, V::RsqrtRefine(v, estimate));
+  }
+};
+
+// exp(v) = 2^n * exp(r), with r = v - n * ln 2 split the same way as for sincos, and exp(r) from a Cephes
+// polynomial. At the ends of the range 2^n isn't a normal float, so it's applied in two halves.
+template<class V>
+struct ExpKernel
+{
+  typename V::Float operator()(typename V::Float v) const
+  {
+    typedef typename V::Float Float;
+    typedef typename V::Int Int;
+
+    Float x = V::Min(V::Max(v, V::Set(-87.3365448f)), V::Set(88.7228394f));
+    Int n = V::RoundToInt(V::Mul(x, V::Set(1.44269504088896341f)));
+    Float nf = V::ToFloat(n);
+    Int halfN = V::RoundToInt(V::Mul(nf, V::Set(0.5f)));
+    Float scale = V::AsFloat(V::template ShiftLeft<23>(V::IntAdd(halfN, V::SetInt(127))));
+    Float otherScale = V::AsFloat(V::template ShiftLeft<23>(V::IntAdd(V::IntSub(n, halfN), V::SetInt(127))));
+
+    Float r = V::MulAdd(nf, V::Set(-0.693359375f), x);
+    r = V::MulAdd(nf, V::Set(2.12194440e-4f), r);
+
+    Float p = V::MulAdd(V::Set(1.9875691500e-4f), r, V::Set(1.3981999507e-3f));
+    p = V::MulAdd(p, r, V::Set(8.3334519073e-3f));
+    p = V::MulAdd(p, r, V::Set(4.1665795894e-2f));
+    p = V::MulAdd(p, r, V::Set(1.6666665459e-1f));
+    p = V::MulAdd(p, r, V::Set(5.0000001201e-1f));
+    p = V::MulAdd(p, V::Mul(r, r), V::Add(r, V::Set(1.0f)));
+
+    Float result = V::Mul(V::Mul(p, scale), otherScale);
+    result = V::Select(V::Less(v, V::Set(-87.3365448f)), V::Set(0.0f), result);
+    return V::Select(V::Less(V::Set(88.7228394f), v), V::Set(s_infinity), result);
+  }
+};
+
+// log(v) = e * ln 2 + log(m), with m taken from the bits in [sqrt(1/2), sqrt(2)) and log(1 + x) from a Cephes
+// polynomial. ln 2 is split so e * ln 2 adds no error of its own.
+template<class V>
+struct LogKernel
+{
+  typename V::Float operator()(typename V::Float v) const
+  {
+    typedef typename V::Float Float;
+    typedef typename V::Int Int;
+
+    Int bits = V::AsInt(V::Max(v, V::Set(s_minNormal)));
+    Float e = V::ToFloat(V::IntSub(V::template ShiftRight<23>(bits), V::SetInt(126)));
+    Float m = V::AsFloat(V::IntOr(V::IntAnd(bits, V::SetInt(0x007FFFFF)), V::SetInt(0x3F000000)));
+
+    // m is in [0.5, 1), move the bottom of that up an octave
+    typename V::Mask low = V::Less(m, V::Set(0.707106781186547524f));
+    e = V::Sub(e, V::Select(low, V::Set(1.0f), V::Set(0.0f)));
+    Float x = V::Sub(V::Add(m, V::Select(low, m, V::Set(0.0f))), V::Set(1.0f));
+    Float x2 = V::Mul(x, x);
+
+    Float p = V::MulAdd(V::Set(7.0376836292e-2f), x, V::Set(-1.1514610310e-1f));
+    p = V::MulAdd(p, x, V::Set(1.1676998740e-1f));
+    p = V::MulAdd(p, x, V::Set(-1.2420140846e-1f));
+    p = V::MulAdd(p, x, V::Set(1.4249322787e-1f));
+    p = V::MulAdd(p, x, V::Set(-1.6668057665e-1f));
+    p = V::MulAdd(p, x, V::Set(2.0000714765e-1f));
+    p = V::MulAdd(p, x, V::Set(-2.4999993993e-1f));
+    p = V::MulAdd(p, x, V::Set(3.3333331174e-1f));
+    p = V::Mul(V::Mul(p, x), x2);
+    p = V::MulAdd(e, V::Set(-2.12194440e-4f), p);
+    p = V::MulAdd(x2, V::Set(-0.5f), p);
+    Float result = V::MulAdd(e, V::Set(0.693359375f), V::Add(x, p));
+
+    result = V::Select(V::Less(v, V::Set(0.0f)), V::Set(s_nan), result);
+    result = V::Select(V::Equal(v, V::Set(0.0f)), V::Set(-s_infinity), result);
+    return V::Select(V::Equal(v, V::Set(s_infinity)), v, result);
+  }
+};
+
+template<class V>
+struct ClampKernel
+{
+  ClampKernel(float min, float max) : Minimum(V::Set(min)), Maximum(V::Set(max)) {}
+  typename V::Float operator()(typename V::Float v) const { return V::Min(V::Max(v, Minimum), Maximum); }
+
+  typename V::Float Minimum;
+  typename V::Float Maximum;
+};
+
+template<class V, class Kernel>
+static void ApplyUnary(float* pResult, const float* pValues, uint32 count, const Kernel& kernel)
+{
+  uint32 i = 0;
+  for (; (i + V::Width) <= count; i += V::Width)
+    V::Store(pResult + i, kernel(V::Load(pValues + i)));
+
+  if (i < count)
+  {
+    float values[V::Width] = {};
+    float results[V::Width];
+    std::memcpy(values, pValues + i, sizeof(float) * (count - i));
+    V::Store(results, kernel(V::Load(values)));
+    std::memcpy(pResult + i, results, sizeof(float) * (count - i));
+  }
+}
+
+template<class V>
+static void SinCosArray(float* pSinv, float* pCosv, const float* pValues, uint32 count)
+{
+  typename V::Float sinv, cosv;
+  uint32 i = 0;
+  for (; (i + V::Width) <= count; i += V::Width)
+  {
+    SinCosVector<V>(&sinv, &cosv, V::Load(pValues + i));
+    V::Store(pSinv + i, sinv);
+    V::Store(pCosv + i, cosv);
+  }
+
+  if (i < count)
+  {
+    float values[V::Width] = {};
+    float sinResults[V::Width];
+    float cosResults[V::Width];
+    std::memcpy(values, pValues + i, sizeof(float) * (count - i));
+    SinCosVector<V>(&sinv, &cosv, V::Load(values));
+    V::Store(sinResults, sinv);
+    V::Store(cosResults, cosv);
+    std::memcpy(pSinv + i, sinResults, sizeof(float) * (count - i));
+    std::memcpy(pCosv + i, cosResults, sizeof(float) * (count - i));
+  }
+}
+
+template<class V>
+static void LerpArray(float* pResult, const float* pStart, const float* pEnd, float factor, uint32 count)
+{
+  typename V::Float factorVector = V::Set(factor);
+  uint32 i = 0;
+  for (; (i + V::Width) <= count; i += V::Width)
+  {
+    typename V::Float start = V::Load(pStart + i);
+    V::Store(pResult + i, V::MulAdd(V::Sub(V::Load(pEnd + i), start), factorVector, start));
+  }
+
+  if (i < count)
+  {
+    float starts[V::Width] = {};
+    float ends[V::Width] = {};
+    float results[V::Width];
+    std::memcpy(starts, pStart + i, sizeof(float) * (count - i));
+    std::memcpy(ends, pEnd + i, sizeof(float) * (count - i));
+    typename V::Float start = V::Load(starts);
+    V::Store(results, V::MulAdd(V::Sub(V::Load(ends), start), factorVector, start));
+    std::memcpy(pResult + i, results, sizeof(float) * (count - i));
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// half conversion
+//---------------------------------------------------------------------------------------------------------------------
+
+static inline uint16 FloatToHalfRoundEven(float v)
+{
+  uint32 bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  uint32 sign = (bits >> 16) & 0x8000;
+  uint32 magnitude = bits & 0x7FFFFFFF;
+
+  // NaNs keep the top of their payload and are made quiet
+  if (magnitude >= 0x7F800000)
+    return static_cast<uint16>(sign | 0x7C00 | ((magnitude > 0x7F800000) ? (0x200 | ((magnitude >> 13) & 0x3FF)) : 0));
+
+  // 65520 and up round to infinity
+  if (magnitude >= 0x477FF000)
+    return static_cast<uint16>(sign | 0x7C00);
+
+  uint32 result;
+  uint32 shift;
+  if (magnitude >= 0x38800000)
+  {
+    // normal, rebias the exponent and drop 13 bits of mantissa, a carry out of the mantissa bumps the exponent
+    result = (magnitude >> 13) - (112 << 10);
+    shift = 13;
+  }
+  else
+  {
+    // denormal, counting in units of 2^-24, with values below 2^-25 rounding to zero
+    uint32 exponent = magnitude >> 23;
+    if (exponent < 102)
+      return static_cast<uint16>(sign);
+
+    shift = 126 - exponent;
+    magnitude = (magnitude & 0x007FFFFF) | 0x00800000;
+    result = magnitude >> shift;
+  }
+
+  uint32 remainder = magnitude & ((1u << shift) - 1);
+  uint32 halfway = 1u << (shift - 1);
+  if (remainder > halfway || (remainder == halfway && (result & 1) != 0))
+    result++;
+
+  return static_cast<uint16>(sign | result);
+}
+
+static inline void FloatToHalfScalar(uint16* pResult, const float* pValues, uint32 count)
+{
+  for (uint32 i = 0; i < count; i++)
+    pResult[i] = FloatToHalfRoundEven(pValues[i]);
+}
+
+static inline void HalfToFloatScalar(float* pResult, const uint16* pValues, uint32 count)
+{
+  for (uint32 i = 0; i < count; i++)
+    pResult[i] = Y_halftofloat(pValues[i]);
+}
+
+} // namespace
+
+// One set of entry points per instruction set.
+#define MATH_ARRAY_KERNELS(Suffix, Ops)                                                                                \
+  static void SinCos##Suffix(float* pSinv, float* pCosv, const float* pValues, uint32 count)                           \
+  {                                                                                                                    \
+    SinCosArray<Ops>(pSinv, pCosv, pValues, count);                                                                    \
+  }                                                                                                                    \
+  static void Rsqrt##Suffix(float* pResult, const float* pValues, uint32 count)                                        \
+  {                                                                                                                    \
+    ApplyUnary<Ops>(pResult, pValues, count, RsqrtKernel<Ops>());                                                      \
+  }                                                                                                                    \
+  static void Exp##Suffix(float* pResult, const float* pValues, uint32 count)                                          \
+  {                                                                                                                    \
+    ApplyUnary<Ops>(pResult, pValues, count, ExpKernel<Ops>());                                                        \
+  }                                                                                                                    \
+  static void Log##Suffix(float* pResult, const float* pValues, uint32 count)                                          \
+  {                                                                                                                    \
+    ApplyUnary<Ops>(pResult, pValues, count, LogKernel<Ops>());                                                        \
+  }                                                                                                                    \
+  static void Clamp##Suffix(float* pResult, const float* pValues, float min, float max, uint32 count)                  \
+  {                                                                                                                    \
+    ApplyUnary<Ops>(pResult, pValues, count, ClampKernel<Ops>(min, max));                                              \
+  }                                                                                                                    \
+  static void Lerp##Suffix(float* pResult, const float* pStart, const float* pEnd, float factor, uint32 count)         \
+  {                                                                                                                    \
+    LerpArray<Ops>(pResult, pStart, pEnd, factor, count);                                                              \
+  }
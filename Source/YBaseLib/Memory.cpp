@@ -1,6 +1,9 @@
 #include "YBaseLib/Memory.h"
 #include "YBaseLib/Assert.h"
+#include "YBaseLib/MemoryTracker.h"
+#include "YBaseLib/Platform.h"
 #include "YBaseLib/String.h"
+#include "YBaseLib/ThreadCachedHeap.h"
 #include <cstdlib>
 #include <cstring>
 
@@ -12,6 +15,14 @@
 #include <malloc.h>
 #endif
 
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <emmintrin.h>
+#define Y_MEMORY_SSE2 1
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_MEMORY_NEON 1
+#endif
+
 static void MemoryAllocationOverflowHandler(size_t num, size_t size)
 {
   char msg[128];
@@ -31,12 +42,121 @@ void Y_memzero(void* pDestination, size_t ByteCount)
   memset(pDestination, 0, ByteCount);
 }
 
+// Fixed size memcpy/memcmp compile down to plain loads and stores, so each common element size gets its own loop.
+template<size_t SIZE>
+static void CopyStrided(byte* pDestination, size_t destinationStride, const byte* pSource, size_t sourceStride,
+                        size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    std::memcpy(pDestination, pSource, SIZE);
+    pDestination += destinationStride;
+    pSource += sourceStride;
+  }
+}
+
+template<size_t SIZE>
+static int32 CompareStrided(const byte* pMem1, size_t mem1Stride, const byte* pMem2, size_t mem2Stride, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    // the equality test is inlined, only a mismatch needs the real memcmp for its ordering
+    if (std::memcmp(pMem1, pMem2, SIZE) != 0)
+      return std::memcmp(pMem1, pMem2, SIZE);
+
+    pMem1 += mem1Stride;
+    pMem2 += mem2Stride;
+  }
+
+  return 0;
+}
+
+// Packs every second or fourth 32-bit word of the source into the destination with shuffles, the usual case of
+// pulling one float out of interleaved vertices. Each group reads up to the start of the element after it, so
+// the last group is left for the scalar loop. Returns the number of elements copied.
+static size_t GatherWords(byte* pDestination, const byte* pSource, size_t sourceStride, size_t count)
+{
+  size_t i = 0;
+
+#if defined(Y_MEMORY_SSE2)
+  if (sourceStride == 8)
+  {
+    for (; i + 4 < count; i += 4, pSource += 32, pDestination += 16)
+    {
+      __m128 a = _mm_loadu_ps(reinterpret_cast<const float*>(pSource));
+      __m128 b = _mm_loadu_ps(reinterpret_cast<const float*>(pSource + 16));
+      _mm_storeu_ps(reinterpret_cast<float*>(pDestination), _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    }
+  }
+  else if (sourceStride == 16)
+  {
+    for (; i + 4 < count; i += 4, pSource += 64, pDestination += 16)
+    {
+      __m128 ab = _mm_unpacklo_ps(_mm_loadu_ps(reinterpret_cast<const float*>(pSource)),
+                                  _mm_loadu_ps(reinterpret_cast<const float*>(pSource + 16)));
+      __m128 cd = _mm_unpacklo_ps(_mm_loadu_ps(reinterpret_cast<const float*>(pSource + 32)),
+                                  _mm_loadu_ps(reinterpret_cast<const float*>(pSource + 48)));
+      _mm_storeu_ps(reinterpret_cast<float*>(pDestination), _mm_movelh_ps(ab, cd));
+    }
+  }
+#elif defined(Y_MEMORY_NEON)
+  if (sourceStride == 8)
+  {
+    for (; i + 4 < count; i += 4, pSource += 32, pDestination += 16)
+      vst1q_u32(reinterpret_cast<uint32_t*>(pDestination),
+                vld2q_u32(reinterpret_cast<const uint32_t*>(pSource)).val[0]);
+  }
+  else if (sourceStride == 16)
+  {
+    for (; i + 4 < count; i += 4, pSource += 64, pDestination += 16)
+      vst1q_u32(reinterpret_cast<uint32_t*>(pDestination),
+                vld4q_u32(reinterpret_cast<const uint32_t*>(pSource)).val[0]);
+  }
+#endif
+
+  return i;
+}
+
 void Y_memcpy_stride(void* pDestination, size_t DestinationStride, const void* pSource, size_t SourceStride,
                      size_t Size, size_t Count)
 {
-  // Optimize me!
   const byte* pByteSource = (const byte*)pSource;
   byte* pByteDestination = (byte*)pDestination;
+  if (DestinationStride == Size && SourceStride == Size)
+  {
+    std::memcpy(pByteDestination, pByteSource, Size * Count);
+    return;
+  }
+
+  if (Size == 4 && DestinationStride == 4)
+  {
+    size_t gathered = GatherWords(pByteDestination, pByteSource, SourceStride, Count);
+    pByteDestination += gathered * DestinationStride;
+    pByteSource += gathered * SourceStride;
+    Count -= gathered;
+  }
+
+  switch (Size)
+  {
+    case 1:
+      CopyStrided<1>(pByteDestination, DestinationStride, pByteSource, SourceStride, Count);
+      return;
+    case 2:
+      CopyStrided<2>(pByteDestination, DestinationStride, pByteSource, SourceStride, Count);
+      return;
+    case 4:
+      CopyStrided<4>(pByteDestination, DestinationStride, pByteSource, SourceStride, Count);
+      return;
+    case 8:
+      CopyStrided<8>(pByteDestination, DestinationStride, pByteSource, SourceStride, Count);
+      return;
+    case 12:
+      CopyStrided<12>(pByteDestination, DestinationStride, pByteSource, SourceStride, Count);
+      return;
+    case 16:
+      CopyStrided<16>(pByteDestination, DestinationStride, pByteSource, SourceStride, Count);
+      return;
+  }
 
   for (size_t i = 0; i < Count; i++)
   {
@@ -46,12 +166,81 @@ void Y_memcpy_stride(void* pDestination, size_t DestinationStride, const void* p
   }
 }
 
+void Y_memcpy_stride_streaming(void* pDestination, size_t DestinationStride, const void* pSource,
+                               size_t SourceStride, size_t Size, size_t Count)
+{
+#if defined(Y_MEMORY_SSE2)
+  const byte* pByteSource = (const byte*)pSource;
+  byte* pByteDestination = (byte*)pDestination;
+  bool destinationAligned = ((reinterpret_cast<uintptr_t>(pByteDestination) | DestinationStride) & 15) == 0;
+
+  if (DestinationStride == Size && SourceStride == Size)
+  {
+    // plain copy for the unaligned head and the tail, streaming stores for the middle
+    size_t byteCount = Size * Count;
+    size_t headCount = Min((16 - (reinterpret_cast<uintptr_t>(pByteDestination) & 15)) & 15, byteCount);
+    std::memcpy(pByteDestination, pByteSource, headCount);
+    pByteDestination += headCount;
+    pByteSource += headCount;
+    byteCount -= headCount;
+
+    for (; byteCount >= 16; byteCount -= 16, pByteDestination += 16, pByteSource += 16)
+      _mm_stream_si128(reinterpret_cast<__m128i*>(pByteDestination),
+                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(pByteSource)));
+
+    std::memcpy(pByteDestination, pByteSource, byteCount);
+    _mm_sfence();
+    return;
+  }
+  else if (Size == 16 && destinationAligned)
+  {
+    for (size_t i = 0; i < Count; i++, pByteDestination += DestinationStride, pByteSource += SourceStride)
+      _mm_stream_si128(reinterpret_cast<__m128i*>(pByteDestination),
+                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(pByteSource)));
+
+    _mm_sfence();
+    return;
+  }
+  else if (Size == 4 && ((reinterpret_cast<uintptr_t>(pByteDestination) | DestinationStride) & 3) == 0)
+  {
+    for (size_t i = 0; i < Count; i++, pByteDestination += DestinationStride, pByteSource += SourceStride)
+    {
+      int value;
+      std::memcpy(&value, pByteSource, sizeof(value));
+      _mm_stream_si32(reinterpret_cast<int*>(pByteDestination), value);
+    }
+
+    _mm_sfence();
+    return;
+  }
+#endif
+
+  Y_memcpy_stride(pDestination, DestinationStride, pSource, SourceStride, Size, Count);
+}
+
 int32 Y_memcmp_stride(const void* pMem1, size_t mem1Stride, const void* pMem2, size_t mem2Stride, size_t elementSize,
                       size_t count)
 {
-  // Optimize me!
   const byte* pByteMem1 = (const byte*)pMem1;
   const byte* pByteMem2 = (const byte*)pMem2;
+  if (mem1Stride == elementSize && mem2Stride == elementSize)
+    return std::memcmp(pByteMem1, pByteMem2, elementSize * count);
+
+  switch (elementSize)
+  {
+    case 1:
+      return CompareStrided<1>(pByteMem1, mem1Stride, pByteMem2, mem2Stride, count);
+    case 2:
+      return CompareStrided<2>(pByteMem1, mem1Stride, pByteMem2, mem2Stride, count);
+    case 4:
+      return CompareStrided<4>(pByteMem1, mem1Stride, pByteMem2, mem2Stride, count);
+    case 8:
+      return CompareStrided<8>(pByteMem1, mem1Stride, pByteMem2, mem2Stride, count);
+    case 12:
+      return CompareStrided<12>(pByteMem1, mem1Stride, pByteMem2, mem2Stride, count);
+    case 16:
+      return CompareStrided<16>(pByteMem1, mem1Stride, pByteMem2, mem2Stride, count);
+  }
 
   for (size_t i = 0; i < count; i++)
   {
@@ -66,90 +255,90 @@ int32 Y_memcmp_stride(const void* pMem1, size_t mem1Stride, const void* pMem2, s
   return 0;
 }
 
-void* Y_malloczero(size_t size)
+// the heap underneath, allocation tracking sits on top of these
+#if Y_THREAD_CACHED_MALLOC
+
+static void* HeapMalloc(size_t size)
 {
-  void* ptr = std::malloc(size);
-  if (ptr != nullptr)
-    Y_memzero(ptr, size);
-  return ptr;
+  return ThreadCachedHeap::Allocate(size);
 }
 
-void* Y_mallocarray(size_t num, size_t size)
+static void* HeapRealloc(void* ptr, size_t size)
 {
-  REQUEST_SIZE_OVERFLOW_CHECK(num, size);
-  return std::malloc(num * size);
+  return ThreadCachedHeap::Reallocate(ptr, size);
 }
 
-void* Y_reallocarray(void* ptr, size_t num, size_t size)
+static void HeapFree(void* ptr)
 {
-  REQUEST_SIZE_OVERFLOW_CHECK(num, size);
-  return std::realloc(ptr, num * size);
+  ThreadCachedHeap::Free(ptr);
 }
 
-#if defined(Y_PLATFORM_WINDOWS)
+#else
 
-void* Y_aligned_malloc(size_t size, size_t alignment)
+static void* HeapMalloc(size_t size)
 {
-  return _aligned_malloc(size, alignment);
+  return std::malloc(size);
 }
 
-void* Y_aligned_malloczero(size_t size, size_t alignment)
+static void* HeapRealloc(void* ptr, size_t size)
 {
-  void* ptr = _aligned_malloc(size, alignment);
-  if (ptr != nullptr)
-    Y_memzero(ptr, size);
-  return ptr;
+  return std::realloc(ptr, size);
 }
 
-void* Y_aligned_mallocarray(size_t num, size_t size, size_t alignment)
+static void HeapFree(void* ptr)
 {
-  REQUEST_SIZE_OVERFLOW_CHECK(num, size);
-  return Y_aligned_malloc(num * size, alignment);
+  std::free(ptr);
 }
 
-void* Y_aligned_realloc(void* ptr, size_t size, size_t alignment)
+#endif
+
+#if Y_THREAD_CACHED_MALLOC
+
+static void* HeapAlignedMalloc(size_t size, size_t alignment)
 {
-  return _aligned_realloc(ptr, size, alignment);
+  return ThreadCachedHeap::AllocateAligned(size, alignment);
 }
 
-void* Y_aligned_reallocarray(void* ptr, size_t num, size_t size, size_t alignment)
+static void* HeapAlignedRealloc(void* ptr, size_t size, size_t alignment)
 {
-  REQUEST_SIZE_OVERFLOW_CHECK(num, size);
-  return _aligned_realloc(ptr, num * size, alignment);
+  return ThreadCachedHeap::ReallocateAligned(ptr, size, alignment);
 }
 
-void Y_aligned_free(void* ptr)
+static void HeapAlignedFree(void* ptr)
 {
-  return _aligned_free(ptr);
+  ThreadCachedHeap::Free(ptr);
 }
 
-#elif defined(Y_PLATFORM_LINUX)
+#elif defined(Y_PLATFORM_WINDOWS)
 
-void* Y_aligned_malloc(size_t size, size_t alignment)
+static void* HeapAlignedMalloc(size_t size, size_t alignment)
 {
-  return memalign(alignment, size);
+  return _aligned_malloc(size, alignment);
 }
 
-void* Y_aligned_malloczero(size_t size, size_t alignment)
+static void* HeapAlignedRealloc(void* ptr, size_t size, size_t alignment)
 {
-  void* ptr = memalign(alignment, size);
-  if (ptr != nullptr)
-    Y_memzero(ptr, size);
-  return ptr;
+  return _aligned_realloc(ptr, size, alignment);
 }
 
-void* Y_aligned_mallocarray(size_t num, size_t size, size_t alignment)
+static void HeapAlignedFree(void* ptr)
 {
-  REQUEST_SIZE_OVERFLOW_CHECK(num, size);
-  return Y_aligned_malloc(num * size, alignment);
+  _aligned_free(ptr);
 }
 
-void* Y_aligned_realloc(void* ptr, size_t size, size_t alignment)
+#elif defined(Y_PLATFORM_LINUX)
+
+static void* HeapAlignedMalloc(size_t size, size_t alignment)
 {
-  void* new_ptr = memalign(size, alignment);
+  return memalign(alignment, size);
+}
+
+static void* HeapAlignedRealloc(void* ptr, size_t size, size_t alignment)
+{
+  void* new_ptr = memalign(alignment, size);
   if (new_ptr != nullptr && ptr != nullptr)
   {
-    size_t copy_size = malloc_usable_size(ptr);
+    size_t copy_size = Min(malloc_usable_size(ptr), size);
     if (copy_size > 0)
       std::memcpy(new_ptr, ptr, copy_size);
 
@@ -159,138 +348,377 @@ void* Y_aligned_realloc(void* ptr, size_t size, size_t alignment)
   return new_ptr;
 }
 
-void* Y_aligned_reallocarray(void* ptr, size_t num, size_t size, size_t alignment)
-{
-  REQUEST_SIZE_OVERFLOW_CHECK(num, size);
-  return Y_aligned_realloc(ptr, num * size, alignment);
-}
-
-void Y_aligned_free(void* ptr)
+static void HeapAlignedFree(void* ptr)
 {
   std::free(ptr);
 }
 
 #elif defined(Y_PLATFORM_OSX)
 
-void* Y_aligned_malloc(size_t size, size_t alignment)
+static void* HeapAlignedMalloc(size_t size, size_t alignment)
 {
   // OSX guarantees 16 byte alignment.
   DebugAssert(alignment <= 16);
   return std::malloc(size);
 }
 
-void* Y_aligned_malloczero(size_t size, size_t alignment)
+static void* HeapAlignedRealloc(void* ptr, size_t size, size_t alignment)
 {
   DebugAssert(alignment <= 16);
-  void* ptr = Y_aligned_malloc(alignment);
-  if (ptr != nullptr)
-    Y_memzero(ptr, size);
+  return std::realloc(ptr, size);
+}
+
+static void HeapAlignedFree(void* ptr)
+{
+  std::free(ptr);
+}
+
+#endif
+
+#if Y_MEMORY_TRACKING
+
+// Tracked allocations have a header just before the pointer handed out. Aligned allocations are pushed in by
+// the alignment, so Offset is how far the pointer is from the start of the underlying allocation.
+struct TrackedAllocationHeader
+{
+  size_t Size;
+  uint16 Tag;
+  uint16 StackRecord;
+  uint32 Offset;
+};
+
+static const size_t TrackedHeaderSize = 16;
+static_assert(sizeof(TrackedAllocationHeader) <= TrackedHeaderSize, "header must fit in front of the allocation");
+
+static inline TrackedAllocationHeader* GetTrackedAllocationHeader(void* ptr)
+{
+  return reinterpret_cast<TrackedAllocationHeader*>(reinterpret_cast<byte*>(ptr) - TrackedHeaderSize);
+}
+
+static void* TrackAllocation(void* pBase, size_t offset, size_t size)
+{
+  if (pBase == nullptr)
+    return nullptr;
+
+  void* ptr = reinterpret_cast<byte*>(pBase) + offset;
+  TrackedAllocationHeader* pHeader = GetTrackedAllocationHeader(ptr);
+  pHeader->Size = size;
+  pHeader->Offset = (uint32)offset;
+  MemoryTracker::OnAllocate(size, &pHeader->Tag, &pHeader->StackRecord);
   return ptr;
 }
 
-void* Y_aligned_mallocarray(size_t num, size_t size, size_t alignment)
+// returns the start of the underlying allocation
+static void* UntrackAllocation(void* ptr)
 {
-  REQUEST_SIZE_OVERFLOW_CHECK(num, size);
-  return Y_aligned_malloc(num * size, alignment);
+  TrackedAllocationHeader* pHeader = GetTrackedAllocationHeader(ptr);
+  MemoryTracker::OnFree(pHeader->Size, pHeader->Tag, pHeader->StackRecord);
+  return reinterpret_cast<byte*>(ptr) - pHeader->Offset;
+}
+
+static inline size_t GetTrackedAlignmentOffset(size_t alignment)
+{
+  return Max(alignment, TrackedHeaderSize);
+}
+
+void* Y_malloc(size_t size)
+{
+  if (size > SIZE_MAX - TrackedHeaderSize)
+    MemoryAllocationOverflowHandler(1, size);
+
+  return TrackAllocation(HeapMalloc(size + TrackedHeaderSize), TrackedHeaderSize, size);
+}
+
+void* Y_realloc(void* ptr, size_t size)
+{
+  if (ptr == nullptr)
+    return Y_malloc(size);
+
+  if (size == 0)
+  {
+    Y_free(ptr);
+    return nullptr;
+  }
+
+  // a failed realloc leaves the old allocation alone, so it stays counted until this succeeds
+  TrackedAllocationHeader header = *GetTrackedAllocationHeader(ptr);
+  void* pNewBase = HeapRealloc(reinterpret_cast<byte*>(ptr) - TrackedHeaderSize, size + TrackedHeaderSize);
+  if (pNewBase == nullptr)
+    return nullptr;
+
+  MemoryTracker::OnFree(header.Size, header.Tag, header.StackRecord);
+  return TrackAllocation(pNewBase, TrackedHeaderSize, size);
+}
+
+void Y_free(void* ptr)
+{
+  if (ptr != nullptr)
+    HeapFree(UntrackAllocation(ptr));
+}
+
+void* Y_aligned_malloc(size_t size, size_t alignment)
+{
+  size_t offset = GetTrackedAlignmentOffset(alignment);
+  if (size > SIZE_MAX - offset)
+    MemoryAllocationOverflowHandler(1, size);
+
+  return TrackAllocation(HeapAlignedMalloc(size + offset, Max(alignment, (size_t)Y_SSE_ALIGNMENT)), offset, size);
 }
 
 void* Y_aligned_realloc(void* ptr, size_t size, size_t alignment)
 {
-  DebugAssert(alignment <= 16);
-  return std::realloc(ptr, size, alignment);
+  if (ptr == nullptr)
+    return Y_aligned_malloc(size, alignment);
+
+  // the offset only depends on the alignment, so the contents land at the same place in the new allocation
+  size_t offset = GetTrackedAlignmentOffset(alignment);
+  TrackedAllocationHeader header = *GetTrackedAllocationHeader(ptr);
+  DebugAssert(header.Offset == offset);
+  void* pNewBase = HeapAlignedRealloc(reinterpret_cast<byte*>(ptr) - offset, size + offset,
+                                      Max(alignment, (size_t)Y_SSE_ALIGNMENT));
+  if (pNewBase == nullptr)
+    return nullptr;
+
+  MemoryTracker::OnFree(header.Size, header.Tag, header.StackRecord);
+  return TrackAllocation(pNewBase, offset, size);
 }
 
-void* Y_aligned_reallocarray(void* ptr, size_t num, size_t size, size_t alignment)
+void Y_aligned_free(void* ptr)
 {
-  REQUEST_SIZE_OVERFLOW_CHECK(num, size);
-  return Y_aligned_realloc(ptr, num * size, alignment);
+  if (ptr != nullptr)
+    HeapAlignedFree(UntrackAllocation(ptr));
+}
+
+#else
+
+void* Y_malloc(size_t size)
+{
+  return HeapMalloc(size);
+}
+
+void* Y_realloc(void* ptr, size_t size)
+{
+  return HeapRealloc(ptr, size);
+}
+
+void Y_free(void* ptr)
+{
+  HeapFree(ptr);
+}
+
+void* Y_aligned_malloc(size_t size, size_t alignment)
+{
+  return HeapAlignedMalloc(size, alignment);
+}
+
+void* Y_aligned_realloc(void* ptr, size_t size, size_t alignment)
+{
+  return HeapAlignedRealloc(ptr, size, alignment);
 }
 
 void Y_aligned_free(void* ptr)
 {
-  std::free(ptr);
+  HeapAlignedFree(ptr);
 }
 
 #endif
 
-void Y_qsort(void* pBase, size_t nElements, size_t ElementSize, int (*CompareFunction)(const void*, const void*))
+void* Y_malloczero(size_t size)
 {
-  qsort(pBase, nElements, ElementSize, CompareFunction);
+  void* ptr = Y_malloc(size);
+  if (ptr != nullptr)
+    Y_memzero(ptr, size);
+  return ptr;
 }
 
-#if defined(Y_PLATFORM_WINDOWS)
+void* Y_mallocarray(size_t num, size_t size)
+{
+  REQUEST_SIZE_OVERFLOW_CHECK(num, size);
+  return Y_malloc(num * size);
+}
 
-void Y_qsort_r(void* pBase, size_t nElements, size_t ElementSize, void* pContext,
-               int (*CompareFunction)(void*, const void*, const void*))
+void* Y_reallocarray(void* ptr, size_t num, size_t size)
 {
-  qsort_s(pBase, nElements, ElementSize, CompareFunction, pContext);
+  REQUEST_SIZE_OVERFLOW_CHECK(num, size);
+  return Y_realloc(ptr, num * size);
 }
 
-#elif defined(Y_PLATFORM_OSX)
+void* Y_aligned_malloczero(size_t size, size_t alignment)
+{
+  void* ptr = Y_aligned_malloc(size, alignment);
+  if (ptr != nullptr)
+    Y_memzero(ptr, size);
+  return ptr;
+}
 
-void Y_qsort_r(void* pBase, size_t nElements, size_t ElementSize, void* pContext,
-               int (*CompareFunction)(void*, const void*, const void*))
+void* Y_aligned_mallocarray(size_t num, size_t size, size_t alignment)
 {
-  qsort_r(pBase, nElements, ElementSize, pContext, CompareFunction);
+  REQUEST_SIZE_OVERFLOW_CHECK(num, size);
+  return Y_aligned_malloc(num * size, alignment);
 }
 
-#elif defined(Y_PLATFORM_HTML5) || defined(Y_PLATFORM_ANDROID)
+void* Y_aligned_reallocarray(void* ptr, size_t num, size_t size, size_t alignment)
+{
+  REQUEST_SIZE_OVERFLOW_CHECK(num, size);
+  return Y_aligned_realloc(ptr, num * size, alignment);
+}
 
-// have to remap it.. this really needs a better solution :/
-struct RecursiveQSortData
+void* Y_aligned_malloc_flags(size_t size, size_t alignment, uint32 flags)
 {
-  int (*CompareFunction)(void*, const void*, const void*);
-  void* pRealUserData;
-};
+  // the heap hands big allocations fresh pages, which the advice reaches before anything touches them
+  void* ptr = Y_aligned_malloc(size, alignment);
+  if (ptr != nullptr && flags != 0)
+    Platform::AdviseMemory(ptr, size, flags);
+  return ptr;
+}
+
+// Y_qsort and Y_qsort_r share one byte-wise introsort rather than going through the C library, which needed a
+// different qsort_r signature on every platform and a thread-local trampoline where there wasn't one.
+// Typed code should use Y_sort from Sort.h instead, which inlines the comparator.
+static void SwapElements(byte* pLeft, byte* pRight, size_t elementSize)
+{
+  byte temp[64];
+  while (elementSize > 0)
+  {
+    size_t chunkSize = Min(elementSize, sizeof(temp));
+    std::memcpy(temp, pLeft, chunkSize);
+    std::memcpy(pLeft, pRight, chunkSize);
+    std::memcpy(pRight, temp, chunkSize);
+    pLeft += chunkSize;
+    pRight += chunkSize;
+    elementSize -= chunkSize;
+  }
+}
+
+template<typename Compare>
+static void ByteInsertionSort(byte* pBase, size_t count, size_t elementSize, const Compare& compare)
+{
+  for (size_t i = 1; i < count; i++)
+  {
+    for (size_t j = i; j > 0; j--)
+    {
+      byte* pCurrent = pBase + j * elementSize;
+      if (compare(pCurrent - elementSize, pCurrent) <= 0)
+        break;
 
-Y_DECLARE_THREAD_LOCAL(RecursiveQSortData* g_pCurrentQSortData) = nullptr;
+      SwapElements(pCurrent - elementSize, pCurrent, elementSize);
+    }
+  }
+}
 
-static int Y_qsort_trampoline(const void* pLeft, const void* pRight)
+template<typename Compare>
+static void ByteSiftDown(byte* pBase, size_t root, size_t count, size_t elementSize, const Compare& compare)
 {
-  return g_pCurrentQSortData->CompareFunction(g_pCurrentQSortData->pRealUserData, pLeft, pRight);
+  for (;;)
+  {
+    size_t child = root * 2 + 1;
+    if (child >= count)
+      break;
+    if (child + 1 < count && compare(pBase + child * elementSize, pBase + (child + 1) * elementSize) < 0)
+      child++;
+    if (compare(pBase + root * elementSize, pBase + child * elementSize) >= 0)
+      break;
+
+    SwapElements(pBase + root * elementSize, pBase + child * elementSize, elementSize);
+    root = child;
+  }
 }
 
-void Y_qsort_r(void* pBase, size_t nElements, size_t ElementSize, void* pContext,
-               int (*CompareFunction)(void*, const void*, const void*))
+template<typename Compare>
+static void ByteIntroSort(byte* pBase, size_t count, size_t elementSize, uint32 depthLimit, const Compare& compare)
 {
-  RecursiveQSortData* pOldValue = g_pCurrentQSortData;
+  while (count > 16)
+  {
+    if (depthLimit == 0)
+    {
+      // heap sort what's left
+      for (size_t i = count / 2; i > 0; i--)
+        ByteSiftDown(pBase, i - 1, count, elementSize, compare);
+      for (size_t i = count - 1; i > 0; i--)
+      {
+        SwapElements(pBase, pBase + i * elementSize, elementSize);
+        ByteSiftDown(pBase, 0, i, elementSize, compare);
+      }
+      return;
+    }
+    depthLimit--;
+
+    // median of three into the first element, see SortDetail::IntroSort
+    byte* pFirst = pBase + elementSize;
+    byte* pMiddle = pBase + (count / 2) * elementSize;
+    byte* pLast = pBase + (count - 1) * elementSize;
+    if (compare(pMiddle, pFirst) < 0)
+      SwapElements(pMiddle, pFirst, elementSize);
+    if (compare(pLast, pMiddle) < 0)
+    {
+      SwapElements(pLast, pMiddle, elementSize);
+      if (compare(pMiddle, pFirst) < 0)
+        SwapElements(pMiddle, pFirst, elementSize);
+    }
+    SwapElements(pBase, pMiddle, elementSize);
 
-  RecursiveQSortData data;
-  data.CompareFunction = CompareFunction;
-  data.pRealUserData = pContext;
-  g_pCurrentQSortData = &data;
+    size_t left = 0;
+    size_t right = count;
+    for (;;)
+    {
+      do
+      {
+        left++;
+      } while (compare(pBase + left * elementSize, pBase) < 0);
+      do
+      {
+        right--;
+      } while (compare(pBase, pBase + right * elementSize) < 0);
 
-  qsort(pBase, nElements, ElementSize, Y_qsort_trampoline);
+      if (left >= right)
+        break;
 
-  g_pCurrentQSortData = pOldValue;
-}
+      SwapElements(pBase + left * elementSize, pBase + right * elementSize, elementSize);
+    }
+    SwapElements(pBase, pBase + right * elementSize, elementSize);
 
-#else
+    size_t leftCount = right;
+    size_t rightCount = count - right - 1;
+    if (leftCount < rightCount)
+    {
+      ByteIntroSort(pBase, leftCount, elementSize, depthLimit, compare);
+      pBase += (right + 1) * elementSize;
+      count = rightCount;
+    }
+    else
+    {
+      ByteIntroSort(pBase + (right + 1) * elementSize, rightCount, elementSize, depthLimit, compare);
+      count = leftCount;
+    }
+  }
+
+  ByteInsertionSort(pBase, count, elementSize, compare);
+}
 
-// have to remap it.. this really needs a better solution :/
-struct RecursiveQSortData
+template<typename Compare>
+static void ByteSort(void* pBase, size_t count, size_t elementSize, const Compare& compare)
 {
-  int (*CompareFunction)(void*, const void*, const void*);
-  void* pRealUserData;
-};
+  uint32 depthLimit = 0;
+  for (size_t remaining = count; remaining > 1; remaining >>= 1)
+    depthLimit += 2;
+
+  ByteIntroSort(reinterpret_cast<byte*>(pBase), count, elementSize, depthLimit, compare);
+}
 
-static int Y_qsort_r_trampoline(const void* pLeft, const void* pRight, void* pUserData)
+void Y_qsort(void* pBase, size_t nElements, size_t ElementSize, int (*CompareFunction)(const void*, const void*))
 {
-  RecursiveQSortData* pData = reinterpret_cast<RecursiveQSortData*>(pUserData);
-  return pData->CompareFunction(pData->pRealUserData, pLeft, pRight);
+  ByteSort(pBase, nElements, ElementSize,
+           [CompareFunction](const void* pLeft, const void* pRight) { return CompareFunction(pLeft, pRight); });
 }
 
 void Y_qsort_r(void* pBase, size_t nElements, size_t ElementSize, void* pContext,
                int (*CompareFunction)(void*, const void*, const void*))
 {
-  RecursiveQSortData data;
-  data.CompareFunction = CompareFunction;
-  data.pRealUserData = pContext;
-  qsort_r(pBase, nElements, ElementSize, Y_qsort_r_trampoline, reinterpret_cast<void*>(&data));
+  ByteSort(pBase, nElements, ElementSize, [CompareFunction, pContext](const void* pLeft, const void* pRight) {
+    return CompareFunction(pContext, pLeft, pRight);
+  });
 }
 
-#endif
-
 void* Y_bsearch(const void* pKey, const void* pBase, size_t nElements, size_t ElementSize,
                 int (*CompareFunction)(const void*, const void*))
 {
@@ -469,7 +897,58 @@ bool Y_bitscanreverse(uint16 mask, uint16* index)
   return false;
 }
 
-// TODO: Use __builtin_popcount
+#if defined(Y_COMPILER_GCC) || defined(Y_COMPILER_CLANG) || defined(Y_COMPILER_EMSCRIPTEN)
+
+// the builtins become a single POPCNT/CNT when the target has one
+uint32 Y_popcnt(uint8 value)
+{
+  return static_cast<uint32>(__builtin_popcount(value));
+}
+
+uint32 Y_popcnt(uint16 value)
+{
+  return static_cast<uint32>(__builtin_popcount(value));
+}
+
+uint32 Y_popcnt(uint32 value)
+{
+  return static_cast<uint32>(__builtin_popcount(value));
+}
+
+uint32 Y_popcnt(uint64 value)
+{
+  return static_cast<uint32>(__builtin_popcountll(value));
+}
+
+#elif defined(Y_PLATFORM_WINDOWS) && defined(__AVX__)
+
+// every CPU with AVX has POPCNT, MSVC doesn't emit it otherwise
+uint32 Y_popcnt(uint8 value)
+{
+  return __popcnt16(value);
+}
+
+uint32 Y_popcnt(uint16 value)
+{
+  return __popcnt16(value);
+}
+
+uint32 Y_popcnt(uint32 value)
+{
+  return __popcnt(value);
+}
+
+uint32 Y_popcnt(uint64 value)
+{
+#ifdef Y_CPU_X64
+  return static_cast<uint32>(__popcnt64(value));
+#else
+  return __popcnt((uint32)value) + __popcnt((uint32)(value >> 32));
+#endif
+}
+
+#else
+
 // Adapted from qemu host-utils.h
 uint32 Y_popcnt(uint8 value)
 {
@@ -509,6 +988,8 @@ uint32 Y_popcnt(uint64 value)
   return static_cast<uint32>(value);
 }
 
+#endif
+
 #ifdef Y_PLATFORM_WINDOWS
 
 bool Y_bitscanforward(uint32 mask, uint32* index)
@@ -590,7 +1071,7 @@ bool Y_bitscanforward(uint64 mask, uint64* index)
   if (mask == 0)
     return false;
 
-  *index = __builtin_ctz(mask);
+  *index = __builtin_ctzll(mask);
   return true;
 #else
   if ((uint32)mask != 0)
@@ -622,7 +1103,7 @@ bool Y_bitscanreverse(uint64 mask, uint64* index)
   if (mask == 0)
     return false;
 
-  *index = 63u - __builtin_clz(mask);
+  *index = 63u - __builtin_clzll(mask);
   return true;
 #else
   if ((uint32)(mask >> 32) != 0)
@@ -0,0 +1,287 @@
+#include "YBaseLib/MemoryTracker.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/Platform.h"
+#include "YBaseLib/SpinLock.h"
+#include "YBaseLib/Timer.h"
+Log_SetChannel(MemoryTracker);
+
+// Allocations can happen before any static constructor has run, so everything here is zero or constant
+// initialized, and the locks are SpinLocks.
+struct TagCounters
+{
+  Y_ATOMIC_DECL64 int64 CurrentBytes;
+  Y_ATOMIC_DECL64 int64 PeakBytes;
+  Y_ATOMIC_DECL64 int64 CurrentCount;
+  Y_ATOMIC_DECL64 int64 TotalBytes;
+  Y_ATOMIC_DECL64 int64 TotalCount;
+};
+
+// Sampled stacks live in an open addressed table and are never removed, allocations remember their record's
+// index + 1 so frees can take their bytes back off. When the table is busy the sample is just dropped.
+static const uint32 StackRecordCount = 4096;
+
+struct StackRecord
+{
+  uint32 Hash;
+  uint32 Tag;
+  uint32 FrameCount;
+  void* Frames[MemoryTracker::MaxStackFrames];
+  uint64 SampleCount;
+  uint64 SampledBytes;
+  Y_ATOMIC_DECL64 int64 LiveBytes;
+};
+
+static const char* s_tagNames[MemoryTracker::MaxTagCount] = {"Untagged"};
+static Y_ATOMIC_DECL uint32 s_tagCount = 1;
+static SpinLock s_tagLock;
+static TagCounters s_tagCounters[MemoryTracker::MaxTagCount];
+
+static StackRecord s_stackRecords[StackRecordCount];
+static uint32 s_stackRecordsUsed;
+static SpinLock s_stackRecordLock;
+static Y_ATOMIC_DECL uint32 s_sampleRate;
+
+Y_DECLARE_THREAD_LOCAL(uint32) s_currentTag = 0;
+Y_DECLARE_THREAD_LOCAL(uint32) s_sampleCountdown = 0;
+
+// counters as of the last dump, for the rates
+static uint64 s_lastDumpTotalBytes[MemoryTracker::MaxTagCount];
+static uint64 s_lastDumpTotalCount[MemoryTracker::MaxTagCount];
+static Y_TIMER_VALUE s_lastDumpTime;
+
+static uint16 RecordStackSample(uint32 tag, size_t size)
+{
+  void* pFrames[MemoryTracker::MaxStackFrames];
+  // skip ourselves
+  uint32 frameCount = Platform::CaptureCallStack(pFrames, countof(pFrames), 1);
+
+  // FNV-1a over the frame addresses and the tag
+  uint32 hash = 2166136261u ^ tag;
+  for (uint32 i = 0; i < frameCount; i++)
+  {
+    uintptr_t frame = reinterpret_cast<uintptr_t>(pFrames[i]);
+    for (uint32 j = 0; j < sizeof(frame); j++)
+      hash = (hash ^ (uint32)((frame >> (j * 8)) & 0xFF)) * 16777619u;
+  }
+
+  if (!s_stackRecordLock.TryLock())
+    return 0;
+
+  uint32 index = hash % StackRecordCount;
+  for (uint32 probe = 0; probe < StackRecordCount; probe++, index = (index + 1) % StackRecordCount)
+  {
+    StackRecord& record = s_stackRecords[index];
+    if (record.SampleCount == 0)
+    {
+      // table is kept at most 3/4 full so probes stay short
+      if (s_stackRecordsUsed >= StackRecordCount / 4 * 3)
+        break;
+
+      record.Hash = hash;
+      record.Tag = tag;
+      record.FrameCount = frameCount;
+      std::memcpy(record.Frames, pFrames, sizeof(void*) * frameCount);
+      s_stackRecordsUsed++;
+    }
+    else if (record.Hash != hash || record.Tag != tag || record.FrameCount != frameCount ||
+             std::memcmp(record.Frames, pFrames, sizeof(void*) * frameCount) != 0)
+    {
+      continue;
+    }
+
+    record.SampleCount++;
+    record.SampledBytes += size;
+    Y_AtomicAdd(record.LiveBytes, (int64)size);
+    s_stackRecordLock.Unlock();
+    return (uint16)(index + 1);
+  }
+
+  s_stackRecordLock.Unlock();
+  return 0;
+}
+
+uint32 MemoryTracker::RegisterTag(const char* name)
+{
+  s_tagLock.Lock();
+
+  uint32 tag;
+  for (tag = 0; tag < s_tagCount; tag++)
+  {
+    if (Y_strcmp(s_tagNames[tag], name) == 0)
+      break;
+  }
+
+  if (tag == s_tagCount)
+  {
+    if (tag == MaxTagCount)
+    {
+      s_tagLock.Unlock();
+      Log_WarningPrintf("Out of memory tags, '%s' will be counted as untagged", name);
+      return 0;
+    }
+
+    s_tagNames[tag] = name;
+    MemoryBarrier();
+    s_tagCount = tag + 1;
+  }
+
+  s_tagLock.Unlock();
+  return tag;
+}
+
+uint32 MemoryTracker::GetTagCount()
+{
+  return s_tagCount;
+}
+
+uint32 MemoryTracker::GetCurrentTag()
+{
+  return s_currentTag;
+}
+
+void MemoryTracker::SetCurrentTag(uint32 tag)
+{
+  DebugAssert(tag < s_tagCount);
+  s_currentTag = tag;
+}
+
+void MemoryTracker::SetSampleRate(uint32 sampleRate)
+{
+  s_sampleRate = sampleRate;
+}
+
+uint32 MemoryTracker::GetSampleRate()
+{
+  return s_sampleRate;
+}
+
+bool MemoryTracker::GetTagStats(uint32 tag, TagStats* pStats)
+{
+  if (tag >= s_tagCount)
+    return false;
+
+  const TagCounters& counters = s_tagCounters[tag];
+  pStats->Name = s_tagNames[tag];
+  pStats->CurrentBytes = (uint64)counters.CurrentBytes;
+  pStats->PeakBytes = (uint64)counters.PeakBytes;
+  pStats->CurrentCount = (uint64)counters.CurrentCount;
+  pStats->TotalBytes = (uint64)counters.TotalBytes;
+  pStats->TotalCount = (uint64)counters.TotalCount;
+  return true;
+}
+
+uint32 MemoryTracker::GetStackSamples(StackSample* pSamples, uint32 maxSamples)
+{
+  uint32 count = 0;
+  s_stackRecordLock.Lock();
+
+  // keep the heaviest maxSamples, in order
+  for (uint32 i = 0; i < StackRecordCount; i++)
+  {
+    const StackRecord& record = s_stackRecords[i];
+    if (record.SampleCount == 0)
+      continue;
+
+    uint32 position = count;
+    while (position > 0 && pSamples[position - 1].SampledBytes < record.SampledBytes)
+      position--;
+    if (position == maxSamples)
+      continue;
+
+    uint32 moveCount = Min(count, maxSamples - 1) - position;
+    std::memmove(&pSamples[position + 1], &pSamples[position], sizeof(StackSample) * moveCount);
+    count = Min(count + 1, maxSamples);
+
+    StackSample& sample = pSamples[position];
+    sample.Tag = record.Tag;
+    sample.FrameCount = record.FrameCount;
+    std::memcpy(sample.Frames, record.Frames, sizeof(void*) * record.FrameCount);
+    sample.SampleCount = record.SampleCount;
+    sample.SampledBytes = record.SampledBytes;
+    sample.LiveBytes = (uint64)record.LiveBytes;
+  }
+
+  s_stackRecordLock.Unlock();
+  return count;
+}
+
+void MemoryTracker::Dump(uint32 maxStacks /* = 10 */)
+{
+  Y_TIMER_VALUE now = Y_TimerGetValue();
+  double seconds = (s_lastDumpTime != 0) ? Y_TimerConvertToSeconds(now - s_lastDumpTime) : 0.0;
+  s_lastDumpTime = now;
+
+  Log_InfoPrintf("Memory by tag, rates over the last %.1f seconds:", seconds);
+  uint32 tagCount = s_tagCount;
+  for (uint32 tag = 0; tag < tagCount; tag++)
+  {
+    TagStats stats;
+    GetTagStats(tag, &stats);
+
+    double allocationRate = 0.0, byteRate = 0.0;
+    if (seconds > 0.0)
+    {
+      allocationRate = (double)(stats.TotalCount - s_lastDumpTotalCount[tag]) / seconds;
+      byteRate = (double)(stats.TotalBytes - s_lastDumpTotalBytes[tag]) / seconds;
+    }
+    s_lastDumpTotalCount[tag] = stats.TotalCount;
+    s_lastDumpTotalBytes[tag] = stats.TotalBytes;
+
+    Log_InfoPrintf("  %-20s %12llu bytes in %8llu allocations, peak %12llu bytes, %10.0f allocs/s %14.0f bytes/s",
+                   stats.Name, stats.CurrentBytes, stats.CurrentCount, stats.PeakBytes, allocationRate, byteRate);
+  }
+
+  StackSample samples[32];
+  uint32 sampleCount = GetStackSamples(samples, Min(maxStacks, (uint32)countof(samples)));
+  if (sampleCount == 0)
+    return;
+
+  Log_InfoPrintf("Heaviest sampled stacks, 1 in %u allocations:", s_sampleRate);
+  for (uint32 i = 0; i < sampleCount; i++)
+  {
+    const StackSample& sample = samples[i];
+    Log_InfoPrintf("  #%u: %s, %llu samples, %llu bytes sampled, %llu still allocated", i, s_tagNames[sample.Tag],
+                   sample.SampleCount, sample.SampledBytes, sample.LiveBytes);
+    for (uint32 j = 0; j < sample.FrameCount; j++)
+      Log_InfoPrintf("      %p", sample.Frames[j]);
+  }
+}
+
+void MemoryTracker::OnAllocate(size_t size, uint16* pTag, uint16* pStackRecord)
+{
+  uint32 tag = s_currentTag;
+  TagCounters& counters = s_tagCounters[tag];
+  int64 currentBytes = Y_AtomicAdd(counters.CurrentBytes, (int64)size);
+  Y_AtomicIncrement(counters.CurrentCount);
+  Y_AtomicAdd(counters.TotalBytes, (int64)size);
+  Y_AtomicIncrement(counters.TotalCount);
+
+  Y_AtomicFetchMax(counters.PeakBytes, currentBytes, ATOMIC_MEMORY_ORDER_RELAXED);
+
+  *pTag = (uint16)tag;
+  *pStackRecord = 0;
+
+  uint32 sampleRate = s_sampleRate;
+  if (sampleRate != 0)
+  {
+    if (s_sampleCountdown == 0 || s_sampleCountdown > sampleRate)
+      s_sampleCountdown = sampleRate;
+
+    if (--s_sampleCountdown == 0)
+      *pStackRecord = RecordStackSample(tag, size);
+  }
+}
+
+void MemoryTracker::OnFree(size_t size, uint16 tag, uint16 stackRecord)
+{
+  TagCounters& counters = s_tagCounters[tag];
+  Y_AtomicAdd(counters.CurrentBytes, -(int64)size);
+  Y_AtomicDecrement(counters.CurrentCount);
+
+  if (stackRecord != 0)
+    Y_AtomicAdd(s_stackRecords[stackRecord - 1].LiveBytes, -(int64)size);
+}
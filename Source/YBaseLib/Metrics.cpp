@@ -0,0 +1,400 @@
+#include "YBaseLib/Metrics.h"
+#include "YBaseLib/BinaryReader.h"
+#include "YBaseLib/BinaryWriter.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/MutexLock.h"
+#include "YBaseLib/TextWriter.h"
+Log_SetChannel(Metrics);
+
+static const uint32 SNAPSHOT_MAGIC = 0x4D4D5959; // 'YYMM'
+static const uint32 SNAPSHOT_VERSION = 1;
+
+const uint32 MetricsHistogram::SubBucketBits;
+const uint32 MetricsHistogram::SubBucketCount;
+const uint32 MetricsHistogram::BucketCount;
+
+MetricsCounter::MetricsCounter(const char* name) : m_name(name) {}
+
+void MetricsCounter::Add(uint64 value /* = 1 */)
+{
+  m_value.Add(value);
+}
+
+uint64 MetricsCounter::GetValue() const
+{
+  return m_value.GetValue();
+}
+
+MetricsGauge::MetricsGauge(const char* name) : m_name(name), m_value(0) {}
+
+MetricsHistogram::MetricsHistogram(const char* name) : m_name(name)
+{
+  m_pShards = new Shard[MetricsShardCount];
+  Y_memzero(m_pShards, sizeof(Shard) * MetricsShardCount);
+}
+
+MetricsHistogram::~MetricsHistogram()
+{
+  delete[] m_pShards;
+}
+
+void MetricsHistogram::Record(uint64 value)
+{
+  Shard& shard = m_pShards[Y_GetThreadShardIndex() % MetricsShardCount];
+  Y_AtomicIncrement(shard.Buckets[GetBucketIndex(value)]);
+  Y_AtomicAdd(shard.Sum, value);
+}
+
+uint64 MetricsHistogram::GetCount() const
+{
+  uint64 counts[BucketCount];
+  GetBucketCounts(counts);
+
+  uint64 count = 0;
+  for (uint32 i = 0; i < BucketCount; i++)
+    count += counts[i];
+
+  return count;
+}
+
+uint64 MetricsHistogram::GetSum() const
+{
+  uint64 sum = 0;
+  for (uint32 i = 0; i < MetricsShardCount; i++)
+    sum += Y_AtomicLoadAcquire(m_pShards[i].Sum);
+
+  return sum;
+}
+
+void MetricsHistogram::GetBucketCounts(uint64 pCounts[BucketCount]) const
+{
+  Y_memzero(pCounts, sizeof(uint64) * BucketCount);
+  for (uint32 i = 0; i < MetricsShardCount; i++)
+  {
+    for (uint32 j = 0; j < BucketCount; j++)
+      pCounts[j] += Y_AtomicLoadAcquire(m_pShards[i].Buckets[j]);
+  }
+}
+
+uint32 MetricsHistogram::GetBucketIndex(uint64 value)
+{
+  if (value < SubBucketCount)
+    return (uint32)value;
+
+  // the power of two, then the eighth of it
+  uint64 highestBit;
+  Y_bitscanreverse(value, &highestBit);
+  uint32 shift = (uint32)highestBit - SubBucketBits;
+  return SubBucketCount + shift * SubBucketCount + (uint32)((value >> shift) & (SubBucketCount - 1));
+}
+
+uint64 MetricsHistogram::GetBucketLowerBound(uint32 index)
+{
+  if (index < SubBucketCount)
+    return index;
+
+  uint32 shift = (index - SubBucketCount) / SubBucketCount;
+  uint64 subBucket = (index - SubBucketCount) % SubBucketCount;
+  return (SubBucketCount + subBucket) << shift;
+}
+
+uint64 MetricsHistogram::GetBucketUpperBound(uint32 index)
+{
+  if (index < SubBucketCount)
+    return index;
+
+  uint32 shift = (index - SubBucketCount) / SubBucketCount;
+  return GetBucketLowerBound(index) + ((uint64(1) << shift) - 1);
+}
+
+uint64 MetricsSnapshot::Histogram::GetPercentile(double fraction) const
+{
+  if (Count == 0 || Buckets.IsEmpty())
+    return 0;
+
+  // the rank of the value, from 1
+  uint64 rank = (uint64)(fraction * (double)Count + 0.5);
+  rank = Max(rank, (uint64)1);
+
+  uint64 seen = 0;
+  for (const HistogramBucket& bucket : Buckets)
+  {
+    seen += bucket.Count;
+    if (seen >= rank)
+      return MetricsHistogram::GetBucketUpperBound(bucket.Index);
+  }
+
+  return MetricsHistogram::GetBucketUpperBound(Buckets.LastElement().Index);
+}
+
+MetricsSnapshot::MetricsSnapshot() {}
+
+MetricsSnapshot::~MetricsSnapshot() {}
+
+const MetricsSnapshot::Counter* MetricsSnapshot::FindCounter(const char* name) const
+{
+  for (const Counter& counter : m_counters)
+  {
+    if (counter.Name.Compare(name))
+      return &counter;
+  }
+
+  return nullptr;
+}
+
+const MetricsSnapshot::Gauge* MetricsSnapshot::FindGauge(const char* name) const
+{
+  for (const Gauge& gauge : m_gauges)
+  {
+    if (gauge.Name.Compare(name))
+      return &gauge;
+  }
+
+  return nullptr;
+}
+
+const MetricsSnapshot::Histogram* MetricsSnapshot::FindHistogram(const char* name) const
+{
+  for (const Histogram& histogram : m_histograms)
+  {
+    if (histogram.Name.Compare(name))
+      return &histogram;
+  }
+
+  return nullptr;
+}
+
+void MetricsSnapshot::Clear()
+{
+  m_counters.Clear();
+  m_gauges.Clear();
+  m_histograms.Clear();
+}
+
+void MetricsSnapshot::WriteText(TextWriter* pWriter) const
+{
+  for (const Counter& counter : m_counters)
+    pWriter->WriteFormattedLine("counter %s %llu", counter.Name.GetCharArray(), counter.Value);
+  for (const Gauge& gauge : m_gauges)
+    pWriter->WriteFormattedLine("gauge %s %lld", gauge.Name.GetCharArray(), gauge.Value);
+  for (const Histogram& histogram : m_histograms)
+  {
+    pWriter->WriteFormattedLine("histogram %s count=%llu sum=%llu mean=%.3f p50=%llu p90=%llu p99=%llu max=%llu",
+                                histogram.Name.GetCharArray(), histogram.Count, histogram.Sum, histogram.GetMean(),
+                                histogram.GetPercentile(0.5), histogram.GetPercentile(0.9),
+                                histogram.GetPercentile(0.99), histogram.GetPercentile(1.0));
+  }
+}
+
+void MetricsSnapshot::WriteBinary(BinaryWriter* pWriter) const
+{
+  pWriter->WriteUInt32(SNAPSHOT_MAGIC);
+  pWriter->WriteUInt32(SNAPSHOT_VERSION);
+
+  pWriter->WriteVarUInt32(m_counters.GetSize());
+  for (const Counter& counter : m_counters)
+  {
+    pWriter->WriteSizePrefixedString(counter.Name);
+    pWriter->WriteVarUInt64(counter.Value);
+  }
+
+  pWriter->WriteVarUInt32(m_gauges.GetSize());
+  for (const Gauge& gauge : m_gauges)
+  {
+    pWriter->WriteSizePrefixedString(gauge.Name);
+    pWriter->WriteVarInt64(gauge.Value);
+  }
+
+  pWriter->WriteVarUInt32(m_histograms.GetSize());
+  for (const Histogram& histogram : m_histograms)
+  {
+    pWriter->WriteSizePrefixedString(histogram.Name);
+    pWriter->WriteVarUInt64(histogram.Count);
+    pWriter->WriteVarUInt64(histogram.Sum);
+    pWriter->WriteVarUInt32(histogram.Buckets.GetSize());
+    for (const HistogramBucket& bucket : histogram.Buckets)
+    {
+      pWriter->WriteVarUInt32(bucket.Index);
+      pWriter->WriteVarUInt64(bucket.Count);
+    }
+  }
+}
+
+bool MetricsSnapshot::ReadBinary(BinaryReader* pReader)
+{
+  Clear();
+
+  uint32 magic, version, count;
+  bool result = pReader->SafeReadUInt32(&magic) && magic == SNAPSHOT_MAGIC && pReader->SafeReadUInt32(&version) &&
+                version == SNAPSHOT_VERSION;
+
+  result = result && pReader->SafeReadVarUInt32(&count);
+  for (uint32 i = 0; result && i < count; i++)
+  {
+    Counter counter;
+    result = pReader->SafeReadSizePrefixedString(&counter.Name) && pReader->SafeReadVarUInt64(&counter.Value);
+    m_counters.Add(std::move(counter));
+  }
+
+  result = result && pReader->SafeReadVarUInt32(&count);
+  for (uint32 i = 0; result && i < count; i++)
+  {
+    Gauge gauge;
+    result = pReader->SafeReadSizePrefixedString(&gauge.Name) && pReader->SafeReadVarInt64(&gauge.Value);
+    m_gauges.Add(std::move(gauge));
+  }
+
+  result = result && pReader->SafeReadVarUInt32(&count);
+  for (uint32 i = 0; result && i < count; i++)
+  {
+    Histogram histogram;
+    uint32 bucketCount;
+    result = pReader->SafeReadSizePrefixedString(&histogram.Name) && pReader->SafeReadVarUInt64(&histogram.Count) &&
+             pReader->SafeReadVarUInt64(&histogram.Sum) && pReader->SafeReadVarUInt32(&bucketCount) &&
+             bucketCount <= MetricsHistogram::BucketCount;
+    for (uint32 j = 0; result && j < bucketCount; j++)
+    {
+      HistogramBucket bucket;
+      result = pReader->SafeReadVarUInt32(&bucket.Index) && pReader->SafeReadVarUInt64(&bucket.Count) &&
+               bucket.Index < MetricsHistogram::BucketCount;
+      histogram.Buckets.Add(bucket);
+    }
+    m_histograms.Add(std::move(histogram));
+  }
+
+  if (!result)
+  {
+    Log_ErrorPrint("MetricsSnapshot::ReadBinary: the stream is not a valid snapshot");
+    Clear();
+    return false;
+  }
+
+  return true;
+}
+
+MetricsRegistry::MetricsRegistry() {}
+
+MetricsRegistry::~MetricsRegistry()
+{
+  for (MetricsCounter* pCounter : m_counters)
+    delete pCounter;
+  for (MetricsGauge* pGauge : m_gauges)
+    delete pGauge;
+  for (MetricsHistogram* pHistogram : m_histograms)
+    delete pHistogram;
+}
+
+MetricsRegistry& MetricsRegistry::GetInstance()
+{
+  static MetricsRegistry staticInstance;
+  return staticInstance;
+}
+
+bool MetricsRegistry::FindEntry(const char* name, METRIC_TYPE type, bool* pFound, uint32* pIndex) const
+{
+  const HashTable<String, Entry>::Member* pMember = m_entries.Find(name);
+  *pFound = (pMember != nullptr);
+  if (pMember == nullptr)
+    return true;
+
+  if (pMember->Value.Type != type)
+  {
+    Log_ErrorPrintf("MetricsRegistry::FindEntry: '%s' is already a metric of another type", name);
+    return false;
+  }
+
+  *pIndex = pMember->Value.Index;
+  return true;
+}
+
+MetricsCounter* MetricsRegistry::GetCounter(const char* name)
+{
+  MutexLock lock(m_lock);
+  bool found;
+  uint32 index;
+  if (!FindEntry(name, METRIC_TYPE_COUNTER, &found, &index))
+    return nullptr;
+  if (found)
+    return m_counters[index];
+
+  Entry entry = {METRIC_TYPE_COUNTER, m_counters.GetSize()};
+  m_entries.Insert(name, entry);
+  m_counters.Add(new MetricsCounter(name));
+  return m_counters.LastElement();
+}
+
+MetricsGauge* MetricsRegistry::GetGauge(const char* name)
+{
+  MutexLock lock(m_lock);
+  bool found;
+  uint32 index;
+  if (!FindEntry(name, METRIC_TYPE_GAUGE, &found, &index))
+    return nullptr;
+  if (found)
+    return m_gauges[index];
+
+  Entry entry = {METRIC_TYPE_GAUGE, m_gauges.GetSize()};
+  m_entries.Insert(name, entry);
+  m_gauges.Add(new MetricsGauge(name));
+  return m_gauges.LastElement();
+}
+
+MetricsHistogram* MetricsRegistry::GetHistogram(const char* name)
+{
+  MutexLock lock(m_lock);
+  bool found;
+  uint32 index;
+  if (!FindEntry(name, METRIC_TYPE_HISTOGRAM, &found, &index))
+    return nullptr;
+  if (found)
+    return m_histograms[index];
+
+  Entry entry = {METRIC_TYPE_HISTOGRAM, m_histograms.GetSize()};
+  m_entries.Insert(name, entry);
+  m_histograms.Add(new MetricsHistogram(name));
+  return m_histograms.LastElement();
+}
+
+void MetricsRegistry::GetSnapshot(MetricsSnapshot* pSnapshot) const
+{
+  pSnapshot->Clear();
+
+  MutexLock lock(m_lock);
+  for (const MetricsCounter* pCounter : m_counters)
+  {
+    MetricsSnapshot::Counter counter;
+    counter.Name = pCounter->GetName();
+    counter.Value = pCounter->GetValue();
+    pSnapshot->m_counters.Add(std::move(counter));
+  }
+
+  for (const MetricsGauge* pGauge : m_gauges)
+  {
+    MetricsSnapshot::Gauge gauge;
+    gauge.Name = pGauge->GetName();
+    gauge.Value = pGauge->GetValue();
+    pSnapshot->m_gauges.Add(std::move(gauge));
+  }
+
+  // the count comes from the buckets so percentiles add up, the sum can be a few records behind it
+  uint64 counts[MetricsHistogram::BucketCount];
+  for (const MetricsHistogram* pHistogram : m_histograms)
+  {
+    MetricsSnapshot::Histogram histogram;
+    histogram.Name = pHistogram->GetName();
+    histogram.Count = 0;
+    histogram.Sum = pHistogram->GetSum();
+    pHistogram->GetBucketCounts(counts);
+    for (uint32 i = 0; i < MetricsHistogram::BucketCount; i++)
+    {
+      if (counts[i] == 0)
+        continue;
+
+      MetricsSnapshot::HistogramBucket bucket = {i, counts[i]};
+      histogram.Buckets.Add(bucket);
+      histogram.Count += counts[i];
+    }
+    pSnapshot->m_histograms.Add(std::move(histogram));
+  }
+}
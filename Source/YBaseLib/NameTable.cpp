@@ -1,5 +1,8 @@
 #include "YBaseLib/NameTable.h"
+#include "YBaseLib/Atomic.h"
 #include "YBaseLib/CString.h"
+#include "YBaseLib/HashTrait.h"
+#include "YBaseLib/Memory.h"
 
 const NameTableEntry* NameTable_LookupByName(const NameTableEntry* pNameTable, const char* sName,
                                              bool bCaseInsensitive /* = false */)
@@ -35,4 +38,139 @@ const NameTableEntry* NameTable_LookupByValue(const NameTableEntry* pNameTable,
   }
 
   return NULL;
-}
\ No newline at end of file
+}
+
+namespace {
+struct Slot
+{
+  HashType Hash;
+  uint32 EntryIndex;
+};
+} // namespace
+
+// Three open addressed tables of entry indices, by name, by name ignoring case, and by value, each with twice as
+// many slots as entries so probes stay short. Slots keep the key's hash so most mismatches skip the compare.
+struct NameTableIndex::Index
+{
+  uint32 SlotMask;
+  Slot* pNameSlots;
+  Slot* pCaseInsensitiveNameSlots;
+  Slot* pValueSlots;
+};
+
+static const uint32 EmptySlot = 0xFFFFFFFF;
+
+static HashType HashName(const char* sName, bool bCaseInsensitive)
+{
+  uint32 length = Y_strlen(sName);
+  return bCaseInsensitive ? Y_HashStringCaseInsensitive(sName, length) : Y_HashBytes(sName, length);
+}
+
+// adds an entry unless an earlier one has its key, so lookups find the first like the linear search does
+template<class Equals>
+static void InsertSlot(Slot* pSlots, uint32 slotMask, HashType hash, uint32 entryIndex, const Equals& equals)
+{
+  for (uint32 slot = hash & slotMask;; slot = (slot + 1) & slotMask)
+  {
+    if (pSlots[slot].EntryIndex == EmptySlot)
+    {
+      pSlots[slot].Hash = hash;
+      pSlots[slot].EntryIndex = entryIndex;
+      return;
+    }
+
+    if (pSlots[slot].Hash == hash && equals(pSlots[slot].EntryIndex))
+      return;
+  }
+}
+
+template<class Equals>
+static const NameTableEntry* FindSlot(const NameTableEntry* pNameTable, const Slot* pSlots, uint32 slotMask,
+                                      HashType hash, const Equals& equals)
+{
+  for (uint32 slot = hash & slotMask;; slot = (slot + 1) & slotMask)
+  {
+    uint32 entryIndex = pSlots[slot].EntryIndex;
+    if (entryIndex == EmptySlot)
+      return NULL;
+
+    if (pSlots[slot].Hash == hash && equals(entryIndex))
+      return &pNameTable[entryIndex];
+  }
+}
+
+NameTableIndex::~NameTableIndex()
+{
+  Y_free(m_pIndex);
+}
+
+const NameTableIndex::Index* NameTableIndex::GetIndex() const
+{
+  Index* pIndex = Y_AtomicLoadAcquire(m_pIndex);
+  if (pIndex != NULL)
+    return pIndex;
+
+  uint32 entryCount = 0;
+  while (m_pNameTable[entryCount].sName != NULL)
+    entryCount++;
+
+  uint32 slotCount = 1;
+  while (slotCount < entryCount * 2 + 1)
+    slotCount *= 2;
+
+  // the header and slots are one allocation, freed together
+  pIndex = static_cast<Index*>(Y_malloc(sizeof(Index) + sizeof(Slot) * slotCount * 3));
+  pIndex->SlotMask = slotCount - 1;
+  pIndex->pNameSlots = reinterpret_cast<Slot*>(pIndex + 1);
+  pIndex->pCaseInsensitiveNameSlots = pIndex->pNameSlots + slotCount;
+  pIndex->pValueSlots = pIndex->pCaseInsensitiveNameSlots + slotCount;
+  for (uint32 i = 0; i < slotCount * 3; i++)
+    pIndex->pNameSlots[i].EntryIndex = EmptySlot;
+
+  const NameTableEntry* pNameTable = m_pNameTable;
+  for (uint32 i = 0; i < entryCount; i++)
+  {
+    const char* sName = pNameTable[i].sName;
+    int iValue = pNameTable[i].iValue;
+    InsertSlot(pIndex->pNameSlots, pIndex->SlotMask, HashName(sName, false), i,
+               [pNameTable, sName](uint32 entryIndex) { return Y_strcmp(pNameTable[entryIndex].sName, sName) == 0; });
+    InsertSlot(pIndex->pCaseInsensitiveNameSlots, pIndex->SlotMask, HashName(sName, true), i,
+               [pNameTable, sName](uint32 entryIndex) { return Y_stricmp(pNameTable[entryIndex].sName, sName) == 0; });
+    InsertSlot(pIndex->pValueSlots, pIndex->SlotMask, Y_HashInteger(uint64(int64(iValue))), i,
+               [pNameTable, iValue](uint32 entryIndex) { return pNameTable[entryIndex].iValue == iValue; });
+  }
+
+  // the first to finish publishes theirs, the others use it instead
+  Index* pExistingIndex = Y_AtomicCompareExchangePointer(m_pIndex, pIndex, static_cast<Index*>(NULL));
+  if (pExistingIndex != NULL)
+  {
+    Y_free(pIndex);
+    return pExistingIndex;
+  }
+
+  return pIndex;
+}
+
+const NameTableEntry* NameTableIndex::LookupByName(const char* sName, bool bCaseInsensitive /* = false */) const
+{
+  const Index* pIndex = GetIndex();
+  const NameTableEntry* pNameTable = m_pNameTable;
+  if (bCaseInsensitive)
+  {
+    auto equals = [pNameTable, sName](uint32 entryIndex) {
+      return Y_stricmp(pNameTable[entryIndex].sName, sName) == 0;
+    };
+    return FindSlot(pNameTable, pIndex->pCaseInsensitiveNameSlots, pIndex->SlotMask, HashName(sName, true), equals);
+  }
+
+  auto equals = [pNameTable, sName](uint32 entryIndex) { return Y_strcmp(pNameTable[entryIndex].sName, sName) == 0; };
+  return FindSlot(pNameTable, pIndex->pNameSlots, pIndex->SlotMask, HashName(sName, false), equals);
+}
+
+const NameTableEntry* NameTableIndex::LookupByValue(int iValue) const
+{
+  const Index* pIndex = GetIndex();
+  const NameTableEntry* pNameTable = m_pNameTable;
+  return FindSlot(pNameTable, pIndex->pValueSlots, pIndex->SlotMask, Y_HashInteger(uint64(int64(iValue))),
+                  [pNameTable, iValue](uint32 entryIndex) { return pNameTable[entryIndex].iValue == iValue; });
+}
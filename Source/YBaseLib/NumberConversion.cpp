@@ -0,0 +1,711 @@
+#include "YBaseLib/NumberConversion.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Memory.h"
+#include <cstdlib>
+#include <cstring>
+
+//---------------------------------------------------------------------------------------------------------------------
+// integer formatting
+//---------------------------------------------------------------------------------------------------------------------
+
+static const char s_digitPairs[201] =
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+static uint32 CountDigits(uint64 value)
+{
+  uint32 count = 1;
+  for (;;)
+  {
+    if (value < 10)
+      return count;
+    if (value < 100)
+      return count + 1;
+    if (value < 1000)
+      return count + 2;
+    if (value < 10000)
+      return count + 3;
+
+    value /= 10000;
+    count += 4;
+  }
+}
+
+// writes the digits of value backwards from pEnd, two per division
+template<typename T>
+static void WriteDigits(char* pEnd, T value)
+{
+  while (value >= 100)
+  {
+    const char* pPair = s_digitPairs + (value % 100) * 2;
+    value /= 100;
+    pEnd -= 2;
+    pEnd[0] = pPair[0];
+    pEnd[1] = pPair[1];
+  }
+
+  if (value >= 10)
+  {
+    pEnd[-2] = s_digitPairs[value * 2];
+    pEnd[-1] = s_digitPairs[value * 2 + 1];
+  }
+  else
+  {
+    pEnd[-1] = char('0' + value);
+  }
+}
+
+uint32 NumberConversion::FormatUInt32(char* pBuffer, uint32 value)
+{
+  uint32 length = CountDigits(value);
+  WriteDigits(pBuffer + length, value);
+  return length;
+}
+
+uint32 NumberConversion::FormatInt32(char* pBuffer, int32 value)
+{
+  if (value >= 0)
+    return FormatUInt32(pBuffer, uint32(value));
+
+  pBuffer[0] = '-';
+  return 1 + FormatUInt32(pBuffer + 1, 0u - uint32(value));
+}
+
+uint32 NumberConversion::FormatUInt64(char* pBuffer, uint64 value)
+{
+  // 64-bit divisions are slow on 32-bit targets, so only use them when needed
+  if (value <= 0xFFFFFFFFu)
+    return FormatUInt32(pBuffer, uint32(value));
+
+  uint32 length = CountDigits(value);
+  WriteDigits(pBuffer + length, value);
+  return length;
+}
+
+uint32 NumberConversion::FormatInt64(char* pBuffer, int64 value)
+{
+  if (value >= 0)
+    return FormatUInt64(pBuffer, uint64(value));
+
+  pBuffer[0] = '-';
+  return 1 + FormatUInt64(pBuffer + 1, 0u - uint64(value));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// floating point formatting, Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with
+// Integers"), laid out like Milo Yip's implementation. The digits are generated from the value's rounding interval,
+// so they always read back to the same value, and are the shortest possible for all but a few inputs.
+//---------------------------------------------------------------------------------------------------------------------
+
+// f * 2^e
+struct DiyFp
+{
+  uint64 f;
+  int32 e;
+};
+
+// 10^k for k = -348, -340, ..., 340, normalized to a 64-bit significand and rounded
+struct CachedPower
+{
+  uint64 Significand;
+  int32 BinaryExponent;
+};
+
+static const CachedPower s_cachedPowers[] = {
+  {0xfa8fd5a0081c0288ULL, -1220}, {0xbaaee17fa23ebf76ULL, -1193}, {0x8b16fb203055ac76ULL, -1166},
+  {0xcf42894a5dce35eaULL, -1140}, {0x9a6bb0aa55653b2dULL, -1113}, {0xe61acf033d1a45dfULL, -1087},
+  {0xab70fe17c79ac6caULL, -1060}, {0xff77b1fcbebcdc4fULL, -1034}, {0xbe5691ef416bd60cULL, -1007},
+  {0x8dd01fad907ffc3cULL, -980}, {0xd3515c2831559a83ULL, -954}, {0x9d71ac8fada6c9b5ULL, -927},
+  {0xea9c227723ee8bcbULL, -901}, {0xaecc49914078536dULL, -874}, {0x823c12795db6ce57ULL, -847},
+  {0xc21094364dfb5637ULL, -821}, {0x9096ea6f3848984fULL, -794}, {0xd77485cb25823ac7ULL, -768},
+  {0xa086cfcd97bf97f4ULL, -741}, {0xef340a98172aace5ULL, -715}, {0xb23867fb2a35b28eULL, -688},
+  {0x84c8d4dfd2c63f3bULL, -661}, {0xc5dd44271ad3cdbaULL, -635}, {0x936b9fcebb25c996ULL, -608},
+  {0xdbac6c247d62a584ULL, -582}, {0xa3ab66580d5fdaf6ULL, -555}, {0xf3e2f893dec3f126ULL, -529},
+  {0xb5b5ada8aaff80b8ULL, -502}, {0x87625f056c7c4a8bULL, -475}, {0xc9bcff6034c13053ULL, -449},
+  {0x964e858c91ba2655ULL, -422}, {0xdff9772470297ebdULL, -396}, {0xa6dfbd9fb8e5b88fULL, -369},
+  {0xf8a95fcf88747d94ULL, -343}, {0xb94470938fa89bcfULL, -316}, {0x8a08f0f8bf0f156bULL, -289},
+  {0xcdb02555653131b6ULL, -263}, {0x993fe2c6d07b7facULL, -236}, {0xe45c10c42a2b3b06ULL, -210},
+  {0xaa242499697392d3ULL, -183}, {0xfd87b5f28300ca0eULL, -157}, {0xbce5086492111aebULL, -130},
+  {0x8cbccc096f5088ccULL, -103}, {0xd1b71758e219652cULL, -77}, {0x9c40000000000000ULL, -50},
+  {0xe8d4a51000000000ULL, -24}, {0xad78ebc5ac620000ULL, 3}, {0x813f3978f8940984ULL, 30},
+  {0xc097ce7bc90715b3ULL, 56}, {0x8f7e32ce7bea5c70ULL, 83}, {0xd5d238a4abe98068ULL, 109},
+  {0x9f4f2726179a2245ULL, 136}, {0xed63a231d4c4fb27ULL, 162}, {0xb0de65388cc8ada8ULL, 189},
+  {0x83c7088e1aab65dbULL, 216}, {0xc45d1df942711d9aULL, 242}, {0x924d692ca61be758ULL, 269},
+  {0xda01ee641a708deaULL, 295}, {0xa26da3999aef774aULL, 322}, {0xf209787bb47d6b85ULL, 348},
+  {0xb454e4a179dd1877ULL, 375}, {0x865b86925b9bc5c2ULL, 402}, {0xc83553c5c8965d3dULL, 428},
+  {0x952ab45cfa97a0b3ULL, 455}, {0xde469fbd99a05fe3ULL, 481}, {0xa59bc234db398c25ULL, 508},
+  {0xf6c69a72a3989f5cULL, 534}, {0xb7dcbf5354e9beceULL, 561}, {0x88fcf317f22241e2ULL, 588},
+  {0xcc20ce9bd35c78a5ULL, 614}, {0x98165af37b2153dfULL, 641}, {0xe2a0b5dc971f303aULL, 667},
+  {0xa8d9d1535ce3b396ULL, 694}, {0xfb9b7cd9a4a7443cULL, 720}, {0xbb764c4ca7a44410ULL, 747},
+  {0x8bab8eefb6409c1aULL, 774}, {0xd01fef10a657842cULL, 800}, {0x9b10a4e5e9913129ULL, 827},
+  {0xe7109bfba19c0c9dULL, 853}, {0xac2820d9623bf429ULL, 880}, {0x80444b5e7aa7cf85ULL, 907},
+  {0xbf21e44003acdd2dULL, 933}, {0x8e679c2f5e44ff8fULL, 960}, {0xd433179d9c8cb841ULL, 986},
+  {0x9e19db92b4e31ba9ULL, 1013}, {0xeb96bf6ebadf77d9ULL, 1039}, {0xaf87023b9bf0ee6bULL, 1066},
+};
+
+static const uint64 s_powersOf10[] = {1ULL,
+                                      10ULL,
+                                      100ULL,
+                                      1000ULL,
+                                      10000ULL,
+                                      100000ULL,
+                                      1000000ULL,
+                                      10000000ULL,
+                                      100000000ULL,
+                                      1000000000ULL,
+                                      10000000000ULL,
+                                      100000000000ULL,
+                                      1000000000000ULL,
+                                      10000000000000ULL,
+                                      100000000000000ULL,
+                                      1000000000000000ULL,
+                                      10000000000000000ULL,
+                                      100000000000000000ULL,
+                                      1000000000000000000ULL,
+                                      10000000000000000000ULL};
+
+static inline DiyFp MakeDiyFp(uint64 f, int32 e)
+{
+  DiyFp result;
+  result.f = f;
+  result.e = e;
+  return result;
+}
+
+// upper half of the 128-bit product, rounded
+static DiyFp Multiply(const DiyFp& x, const DiyFp& y)
+{
+  const uint64 M32 = 0xFFFFFFFFu;
+  uint64 a = x.f >> 32;
+  uint64 b = x.f & M32;
+  uint64 c = y.f >> 32;
+  uint64 d = y.f & M32;
+  uint64 ac = a * c;
+  uint64 bc = b * c;
+  uint64 ad = a * d;
+  uint64 bd = b * d;
+  uint64 middle = (bd >> 32) + (ad & M32) + (bc & M32) + (1u << 31);
+  return MakeDiyFp(ac + (ad >> 32) + (bc >> 32) + (middle >> 32), x.e + y.e + 64);
+}
+
+static DiyFp Normalize(DiyFp x)
+{
+  DebugAssert(x.f != 0);
+  uint64 topBit;
+  Y_bitscanreverse(x.f, &topBit);
+  uint32 shift = 63 - uint32(topBit);
+  x.f <<= shift;
+  x.e -= int32(shift);
+  return x;
+}
+
+// cached power that brings a value with binary exponent e into [2^-60, 2^-32), and its decimal exponent negated
+static DiyFp GetCachedPower(int32 e, int32* pK)
+{
+  double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int32 k = int32(dk);
+  if (dk - k > 0.0)
+    k++;
+
+  uint32 index = uint32((k >> 3) + 1);
+  DebugAssert(index < countof(s_cachedPowers));
+  *pK = -(-348 + int32(index << 3));
+  return MakeDiyFp(s_cachedPowers[index].Significand, s_cachedPowers[index].BinaryExponent);
+}
+
+// moves the last digit down while that brings it closer to the exact value and stays inside the interval
+static void GrisuRound(char* pDigits, int32 length, uint64 delta, uint64 rest, uint64 tenKappa, uint64 distance)
+{
+  while (rest < distance && delta - rest >= tenKappa &&
+         (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance))
+  {
+    pDigits[length - 1]--;
+    rest += tenKappa;
+  }
+}
+
+static void DigitGen(const DiyFp& w, const DiyFp& upper, uint64 delta, char* pDigits, int32* pLength, int32* pK)
+{
+  const DiyFp one = MakeDiyFp(uint64(1) << -upper.e, upper.e);
+  const uint64 distance = upper.f - w.f;
+  uint32 p1 = uint32(upper.f >> -one.e);
+  uint64 p2 = upper.f & (one.f - 1);
+  int32 kappa = int32(CountDigits(p1));
+  int32 length = 0;
+
+  // integral part
+  while (kappa > 0)
+  {
+    uint32 divisor = uint32(s_powersOf10[kappa - 1]);
+    uint32 digit = p1 / divisor;
+    p1 %= divisor;
+    if (digit != 0 || length != 0)
+      pDigits[length++] = char('0' + digit);
+
+    kappa--;
+    uint64 rest = (uint64(p1) << -one.e) + p2;
+    if (rest <= delta)
+    {
+      *pK += kappa;
+      *pLength = length;
+      GrisuRound(pDigits, length, delta, rest, s_powersOf10[kappa] << -one.e, distance);
+      return;
+    }
+  }
+
+  // fractional part
+  for (;;)
+  {
+    p2 *= 10;
+    delta *= 10;
+    uint32 digit = uint32(p2 >> -one.e);
+    if (digit != 0 || length != 0)
+      pDigits[length++] = char('0' + digit);
+
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta)
+    {
+      *pK += kappa;
+      *pLength = length;
+      int32 index = -kappa;
+      GrisuRound(pDigits, length, delta, p2, one.f, distance * ((index < 20) ? s_powersOf10[index] : 0));
+      return;
+    }
+  }
+}
+
+// value = significand * 2^exponent, digits * 10^k comes out. the gap to the next value down is half the size of the
+// gap up when the significand is a power of two, other than for the smallest normal value.
+static void Grisu2(uint64 significand, int32 exponent, bool lowerGapSmaller, char* pDigits, int32* pLength,
+                   int32* pK)
+{
+  DiyFp upper = Normalize(MakeDiyFp((significand << 1) + 1, exponent - 1));
+  DiyFp lower = lowerGapSmaller ? MakeDiyFp((significand << 2) - 1, exponent - 2) :
+                                  MakeDiyFp((significand << 1) - 1, exponent - 1);
+  lower.f <<= lower.e - upper.e;
+  lower.e = upper.e;
+
+  DiyFp cachedPower = GetCachedPower(upper.e, pK);
+  DiyFp w = Multiply(Normalize(MakeDiyFp(significand, exponent)), cachedPower);
+  DiyFp scaledUpper = Multiply(upper, cachedPower);
+  DiyFp scaledLower = Multiply(lower, cachedPower);
+  scaledLower.f++;
+  scaledUpper.f--;
+  DigitGen(w, scaledUpper, scaledUpper.f - scaledLower.f, pDigits, pLength, pK);
+}
+
+// lays out digits * 10^k, like JavaScript's Number.prototype.toString
+static uint32 WriteDecimal(char* pBuffer, const char* pDigits, int32 length, int32 k)
+{
+  // position of the decimal point relative to the first digit
+  int32 point = length + k;
+  if (length <= point && point <= 21)
+  {
+    // 1234e7 -> 12340000000
+    std::memcpy(pBuffer, pDigits, length);
+    std::memset(pBuffer + length, '0', point - length);
+    return uint32(point);
+  }
+  else if (0 < point && point <= 21)
+  {
+    // 1234e-2 -> 12.34
+    std::memcpy(pBuffer, pDigits, point);
+    pBuffer[point] = '.';
+    std::memcpy(pBuffer + point + 1, pDigits + point, length - point);
+    return uint32(length + 1);
+  }
+  else if (-6 < point && point <= 0)
+  {
+    // 1234e-6 -> 0.001234
+    pBuffer[0] = '0';
+    pBuffer[1] = '.';
+    std::memset(pBuffer + 2, '0', -point);
+    std::memcpy(pBuffer + 2 - point, pDigits, length);
+    return uint32(2 - point + length);
+  }
+
+  // 1234e30 -> 1.234e+33
+  uint32 position = 1;
+  pBuffer[0] = pDigits[0];
+  if (length > 1)
+  {
+    pBuffer[1] = '.';
+    std::memcpy(pBuffer + 2, pDigits + 1, length - 1);
+    position = uint32(length + 1);
+  }
+
+  int32 exponent = point - 1;
+  pBuffer[position++] = 'e';
+  pBuffer[position++] = (exponent < 0) ? '-' : '+';
+  return position + NumberConversion::FormatUInt32(pBuffer + position, uint32((exponent < 0) ? -exponent : exponent));
+}
+
+static uint32 WriteSpecialValue(char* pBuffer, bool negative, bool isNaN)
+{
+  const char* text = isNaN ? "nan" : (negative ? "-inf" : "inf");
+  uint32 length = Y_strlen(text);
+  std::memcpy(pBuffer, text, length);
+  return length;
+}
+
+uint32 NumberConversion::FormatDouble(char* pBuffer, double value)
+{
+  uint64 bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  bool negative = (bits >> 63) != 0;
+  uint32 biasedExponent = uint32(bits >> 52) & 0x7FF;
+  uint64 fraction = bits & ((uint64(1) << 52) - 1);
+  if (biasedExponent == 0x7FF)
+    return WriteSpecialValue(pBuffer, negative, fraction != 0);
+
+  uint32 position = 0;
+  if (negative)
+    pBuffer[position++] = '-';
+
+  if (biasedExponent == 0 && fraction == 0)
+  {
+    pBuffer[position++] = '0';
+    return position;
+  }
+
+  uint64 significand = (biasedExponent != 0) ? (fraction | (uint64(1) << 52)) : fraction;
+  int32 exponent = (biasedExponent != 0) ? (int32(biasedExponent) - 1075) : -1074;
+
+  char digits[24];
+  int32 length, k;
+  Grisu2(significand, exponent, (fraction == 0 && biasedExponent > 1), digits, &length, &k);
+  return position + WriteDecimal(pBuffer + position, digits, length, k);
+}
+
+uint32 NumberConversion::FormatFloat(char* pBuffer, float value)
+{
+  uint32 bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  bool negative = (bits >> 31) != 0;
+  uint32 biasedExponent = (bits >> 23) & 0xFF;
+  uint32 fraction = bits & ((1u << 23) - 1);
+  if (biasedExponent == 0xFF)
+    return WriteSpecialValue(pBuffer, negative, fraction != 0);
+
+  uint32 position = 0;
+  if (negative)
+    pBuffer[position++] = '-';
+
+  if (biasedExponent == 0 && fraction == 0)
+  {
+    pBuffer[position++] = '0';
+    return position;
+  }
+
+  // the float's own interval is used, so the digits are the shortest for a float, not for the widened double
+  uint64 significand = (biasedExponent != 0) ? (fraction | (1u << 23)) : fraction;
+  int32 exponent = (biasedExponent != 0) ? (int32(biasedExponent) - 150) : -149;
+
+  char digits[24];
+  int32 length, k;
+  Grisu2(significand, exponent, (fraction == 0 && biasedExponent > 1), digits, &length, &k);
+  return position + WriteDecimal(pBuffer + position, digits, length, k);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// parsing
+//---------------------------------------------------------------------------------------------------------------------
+
+static inline bool IsSpace(char ch)
+{
+  return (ch == ' ' || (ch >= '\t' && ch <= '\r'));
+}
+
+static inline uint32 GetDigitValue(char ch)
+{
+  return uint32(byte(ch) - byte('0'));
+}
+
+// 16 or more for anything that isn't a hex digit
+static inline uint32 GetHexDigitValue(char ch)
+{
+  if (ch >= '0' && ch <= '9')
+    return uint32(ch - '0');
+  else if (ch >= 'a' && ch <= 'f')
+    return uint32(ch - 'a' + 10);
+  else if (ch >= 'A' && ch <= 'F')
+    return uint32(ch - 'A' + 10);
+  else
+    return 16;
+}
+
+// [whitespace][sign][0x]digits. the magnitude saturates at the limit for its sign, setting pOverflow.
+static uint32 ParseMagnitude(const StringView& text, uint64 positiveLimit, uint64 negativeLimit, bool* pNegative,
+                             bool* pOverflow, uint64* pMagnitude)
+{
+  const char* pStart = text.GetData();
+  const char* pEnd = text.GetEnd();
+  const char* p = pStart;
+  while (p != pEnd && IsSpace(*p))
+    p++;
+
+  *pNegative = false;
+  if (p != pEnd && (*p == '+' || *p == '-'))
+    *pNegative = (*(p++) == '-');
+
+  const uint64 limit = *pNegative ? negativeLimit : positiveLimit;
+  const char* pDigits;
+  uint64 magnitude = 0;
+  bool overflow = false;
+  if ((pEnd - p) > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && GetHexDigitValue(p[2]) < 16)
+  {
+    p += 2;
+    pDigits = p;
+    for (uint32 digit; p != pEnd && (digit = GetHexDigitValue(*p)) < 16; p++)
+    {
+      overflow |= (magnitude > (limit - digit) / 16);
+      magnitude = magnitude * 16 + digit;
+    }
+  }
+  else
+  {
+    pDigits = p;
+    for (uint32 digit; p != pEnd && (digit = GetDigitValue(*p)) < 10; p++)
+    {
+      overflow |= (magnitude > (limit - digit) / 10);
+      magnitude = magnitude * 10 + digit;
+    }
+  }
+
+  if (p == pDigits)
+  {
+    *pOverflow = false;
+    *pMagnitude = 0;
+    return 0;
+  }
+
+  *pOverflow = overflow;
+  *pMagnitude = overflow ? limit : magnitude;
+  return uint32(p - pStart);
+}
+
+uint32 NumberConversion::ParseInt32(const StringView& text, int32* pValue)
+{
+  bool negative, overflow;
+  uint64 magnitude;
+  uint32 length = ParseMagnitude(text, 0x7FFFFFFFu, 0x80000000u, &negative, &overflow, &magnitude);
+  *pValue = negative ? int32(0u - uint32(magnitude)) : int32(magnitude);
+  return length;
+}
+
+uint32 NumberConversion::ParseUInt32(const StringView& text, uint32* pValue)
+{
+  bool negative, overflow;
+  uint64 magnitude;
+  uint32 length = ParseMagnitude(text, 0xFFFFFFFFu, 0xFFFFFFFFu, &negative, &overflow, &magnitude);
+
+  // like strtoul, a negative value too large to negate saturates rather than wrapping
+  *pValue = (negative && !overflow) ? (0u - uint32(magnitude)) : uint32(magnitude);
+  return length;
+}
+
+uint32 NumberConversion::ParseInt64(const StringView& text, int64* pValue)
+{
+  bool negative, overflow;
+  uint64 magnitude;
+  uint32 length = ParseMagnitude(text, 0x7FFFFFFFFFFFFFFFULL, 0x8000000000000000ULL, &negative, &overflow, &magnitude);
+  *pValue = negative ? int64(0u - magnitude) : int64(magnitude);
+  return length;
+}
+
+uint32 NumberConversion::ParseUInt64(const StringView& text, uint64* pValue)
+{
+  bool negative, overflow;
+  uint64 magnitude;
+  uint32 length = ParseMagnitude(text, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL, &negative, &overflow, &magnitude);
+  *pValue = (negative && !overflow) ? (0u - magnitude) : magnitude;
+  return length;
+}
+
+// decimal number split into significand * 10^Exponent, Length is zero if the text doesn't start with one
+struct DecimalNumber
+{
+  uint64 Significand;
+  int32 Exponent;
+  uint32 Length;
+  bool Negative;
+};
+
+// reads [whitespace][sign]digits[.digits][e[sign]digits] with up to 19 significant digits. returns false for
+// anything else the C runtime might accept, such as longer numbers, hex floats, infinities and NaNs.
+static bool ParseDecimalNumber(const StringView& text, DecimalNumber* pNumber)
+{
+  const char* pStart = text.GetData();
+  const char* pEnd = text.GetEnd();
+  const char* p = pStart;
+  while (p != pEnd && IsSpace(*p))
+    p++;
+
+  pNumber->Negative = false;
+  if (p != pEnd && (*p == '+' || *p == '-'))
+    pNumber->Negative = (*(p++) == '-');
+
+  uint64 significand = 0;
+  uint32 significantDigits = 0;
+  int32 exponent = 0;
+  const char* pIntegerStart = p;
+  for (uint32 digit; p != pEnd && (digit = GetDigitValue(*p)) < 10; p++)
+  {
+    if (significantDigits == 19)
+      return false;
+
+    significand = significand * 10 + digit;
+    significantDigits += (significand != 0) ? 1 : 0;
+  }
+
+  bool anyDigits = (p != pIntegerStart);
+  if (anyDigits && p != pEnd && (*p == 'x' || *p == 'X'))
+    return false;
+
+  if (p != pEnd && *p == '.')
+  {
+    const char* pFractionStart = ++p;
+    for (uint32 digit; p != pEnd && (digit = GetDigitValue(*p)) < 10; p++)
+    {
+      if (significantDigits == 19)
+        return false;
+
+      significand = significand * 10 + digit;
+      significantDigits += (significand != 0) ? 1 : 0;
+      exponent--;
+    }
+
+    anyDigits |= (p != pFractionStart);
+  }
+
+  if (!anyDigits)
+  {
+    // inf, nan, or not a number
+    pNumber->Length = 0;
+    return (pIntegerStart == pEnd || (*pIntegerStart != 'i' && *pIntegerStart != 'I' && *pIntegerStart != 'n' &&
+                                      *pIntegerStart != 'N'));
+  }
+
+  // the exponent is only part of the number if it has digits
+  if (p != pEnd && (*p == 'e' || *p == 'E'))
+  {
+    const char* q = p + 1;
+    bool negativeExponent = false;
+    if (q != pEnd && (*q == '+' || *q == '-'))
+      negativeExponent = (*(q++) == '-');
+
+    if (q != pEnd && GetDigitValue(*q) < 10)
+    {
+      int32 exponentValue = 0;
+      for (uint32 digit; q != pEnd && (digit = GetDigitValue(*q)) < 10; q++)
+        exponentValue = Min(exponentValue * 10 + int32(digit), 100000);
+
+      exponent += negativeExponent ? -exponentValue : exponentValue;
+      p = q;
+    }
+  }
+
+  pNumber->Significand = significand;
+  pNumber->Exponent = exponent;
+  pNumber->Length = uint32(p - pStart);
+  return true;
+}
+
+// the C runtime needs a terminated string, so copy out the characters that could be part of a number
+static uint32 ParseWithRuntime(const StringView& text, double* pDoubleValue, float* pFloatValue)
+{
+  const char* pStart = text.GetData();
+  const char* pEnd = text.GetEnd();
+  const char* p = pStart;
+  while (p != pEnd && IsSpace(*p))
+    p++;
+  while (p != pEnd && (GetHexDigitValue(*p) < 16 || (*p >= 'g' && *p <= 'z') || (*p >= 'G' && *p <= 'Z') ||
+                       *p == '.' || *p == '+' || *p == '-' || *p == '(' || *p == ')' || *p == '_'))
+  {
+    p++;
+  }
+
+  size_t length = size_t(p - pStart);
+  char stackBuffer[128];
+  char* pBuffer = (length < sizeof(stackBuffer)) ? stackBuffer : (char*)std::malloc(length + 1);
+  std::memcpy(pBuffer, pStart, length);
+  pBuffer[length] = '\0';
+
+  char* pParseEnd;
+  if (pDoubleValue != NULL)
+    *pDoubleValue = std::strtod(pBuffer, &pParseEnd);
+  else
+    *pFloatValue = std::strtof(pBuffer, &pParseEnd);
+
+  uint32 parsedLength = uint32(pParseEnd - pBuffer);
+  if (pBuffer != stackBuffer)
+    std::free(pBuffer);
+
+  return parsedLength;
+}
+
+// every power of ten up to these is exact, so one multiply or divide by one rounds correctly (Clinger's fast path).
+// this relies on the arithmetic being done at the type's own precision, as it is with SSE and NEON.
+static const double s_exactDoublePowers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+static const float s_exactFloatPowers[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+uint32 NumberConversion::ParseDouble(const StringView& text, double* pValue)
+{
+  DecimalNumber number;
+  if (ParseDecimalNumber(text, &number))
+  {
+    if (number.Length == 0)
+    {
+      *pValue = 0.0;
+      return 0;
+    }
+
+    if (number.Significand == 0 ||
+        (number.Significand <= (uint64(1) << 53) && number.Exponent >= -22 && number.Exponent <= 22))
+    {
+      double value = double(number.Significand);
+      if (number.Exponent < 0)
+        value /= s_exactDoublePowers[Min(-number.Exponent, 22)];
+      else
+        value *= s_exactDoublePowers[Min(number.Exponent, 22)];
+
+      *pValue = number.Negative ? -value : value;
+      return number.Length;
+    }
+  }
+
+  return ParseWithRuntime(text, pValue, NULL);
+}
+
+uint32 NumberConversion::ParseFloat(const StringView& text, float* pValue)
+{
+  DecimalNumber number;
+  if (ParseDecimalNumber(text, &number))
+  {
+    if (number.Length == 0)
+    {
+      *pValue = 0.0f;
+      return 0;
+    }
+
+    if (number.Significand == 0 ||
+        (number.Significand <= (uint64(1) << 24) && number.Exponent >= -10 && number.Exponent <= 10))
+    {
+      float value = float(number.Significand);
+      if (number.Exponent < 0)
+        value /= s_exactFloatPowers[Min(-number.Exponent, 10)];
+      else
+        value *= s_exactFloatPowers[Min(number.Exponent, 10)];
+
+      *pValue = number.Negative ? -value : value;
+      return number.Length;
+    }
+  }
+
+  return ParseWithRuntime(text, NULL, pValue);
+}
@@ -5,10 +5,44 @@
 #include "YBaseLib/POSIX/POSIXConditionVariable.h"
 #include "YBaseLib/POSIX/POSIXMutex.h"
 #include "YBaseLib/POSIX/POSIXRecursiveMutex.h"
+#include <cerrno>
+#include <ctime>
+
+static bool TimedWait(pthread_cond_t* pConditionVariable, pthread_mutex_t* pMutex, uint32 timeout)
+{
+  timespec duration;
+  duration.tv_sec = timeout / 1000;
+  duration.tv_nsec = long(timeout % 1000) * 1000000;
+
+#if defined(Y_PLATFORM_OSX)
+  return (pthread_cond_timedwait_relative_np(pConditionVariable, pMutex, &duration) != ETIMEDOUT);
+#else
+  timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += duration.tv_sec;
+  deadline.tv_nsec += duration.tv_nsec;
+  if (deadline.tv_nsec >= 1000000000)
+  {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  return (pthread_cond_timedwait(pConditionVariable, pMutex, &deadline) != ETIMEDOUT);
+#endif
+}
 
 ConditionVariable::ConditionVariable()
 {
+#if defined(Y_PLATFORM_OSX)
   pthread_cond_init(&m_ConditionVariable, NULL);
+#else
+  // timed waits are measured against the monotonic clock, so changing the system time doesn't stretch them
+  pthread_condattr_t attributes;
+  pthread_condattr_init(&attributes);
+  pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+  pthread_cond_init(&m_ConditionVariable, &attributes);
+  pthread_condattr_destroy(&attributes);
+#endif
 }
 
 ConditionVariable::~ConditionVariable()
@@ -18,14 +52,36 @@ ConditionVariable::~ConditionVariable()
 
 void ConditionVariable::SleepAndRelease(Mutex* pMutex)
 {
+#if Y_LOCK_PROFILING
+  LockProfileConditionWait profileWait(pMutex->m_profile);
+#endif
   pthread_cond_wait(&m_ConditionVariable, &pMutex->m_Mutex);
 }
 
 void ConditionVariable::SleepAndRelease(RecursiveMutex* pMutex)
 {
+#if Y_LOCK_PROFILING
+  LockProfileConditionWait profileWait(pMutex->m_profile);
+#endif
   pthread_cond_wait(&m_ConditionVariable, &pMutex->m_Mutex);
 }
 
+bool ConditionVariable::SleepAndRelease(Mutex* pMutex, uint32 timeout)
+{
+#if Y_LOCK_PROFILING
+  LockProfileConditionWait profileWait(pMutex->m_profile);
+#endif
+  return TimedWait(&m_ConditionVariable, &pMutex->m_Mutex, timeout);
+}
+
+bool ConditionVariable::SleepAndRelease(RecursiveMutex* pMutex, uint32 timeout)
+{
+#if Y_LOCK_PROFILING
+  LockProfileConditionWait profileWait(pMutex->m_profile);
+#endif
+  return TimedWait(&m_ConditionVariable, &pMutex->m_Mutex, timeout);
+}
+
 void ConditionVariable::WakeAll()
 {
   pthread_cond_broadcast(&m_ConditionVariable);
@@ -0,0 +1,222 @@
+#include "YBaseLib/Common.h"
+
+#if defined(Y_PLATFORM_POSIX)
+
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/POSIX/POSIXEvent.h"
+#include <climits>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(Y_PLATFORM_LINUX)
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif
+
+// the timeout TryWait takes as forever, like INFINITE on windows
+static const uint32 InfiniteTimeout = 0xFFFFFFFF;
+
+static void GetDeadline(timespec* pDeadline, uint32 timeout)
+{
+  clock_gettime(CLOCK_MONOTONIC, pDeadline);
+  pDeadline->tv_sec += timeout / 1000;
+  pDeadline->tv_nsec += long(timeout % 1000) * 1000000;
+  if (pDeadline->tv_nsec >= 1000000000)
+  {
+    pDeadline->tv_sec++;
+    pDeadline->tv_nsec -= 1000000000;
+  }
+}
+
+// milliseconds left until the deadline, rounded up so a wait doesn't end just short of it
+static int GetRemainingTime(const timespec& deadline)
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  int64 nanoseconds = int64(deadline.tv_sec - now.tv_sec) * 1000000000 + (deadline.tv_nsec - now.tv_nsec);
+  return (nanoseconds > 0) ? int((nanoseconds + 999999) / 1000000) : 0;
+}
+
+PollableEvent::PollableEvent(bool autoReset) : m_autoReset(autoReset)
+{
+#if defined(Y_PLATFORM_LINUX)
+  m_fileDescriptors[0] = m_fileDescriptors[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  Assert(m_fileDescriptors[0] >= 0);
+#else
+  m_fileDescriptors[0] = m_fileDescriptors[1] = -1;
+  pipe(m_fileDescriptors);
+  for (uint32 i = 0; i < 2; i++)
+  {
+    fcntl(m_fileDescriptors[i], F_SETFL, fcntl(m_fileDescriptors[i], F_GETFL) | O_NONBLOCK);
+    fcntl(m_fileDescriptors[i], F_SETFD, FD_CLOEXEC);
+  }
+#endif
+}
+
+PollableEvent::~PollableEvent()
+{
+  close(m_fileDescriptors[0]);
+  if (m_fileDescriptors[1] != m_fileDescriptors[0])
+    close(m_fileDescriptors[1]);
+}
+
+void PollableEvent::Signal()
+{
+  // if the write would block, the event is already signaled
+#if defined(Y_PLATFORM_LINUX)
+  uint64 value = 1;
+  write(m_fileDescriptors[1], &value, sizeof(value));
+#else
+  char value = 0;
+  write(m_fileDescriptors[1], &value, sizeof(value));
+#endif
+}
+
+bool PollableEvent::Consume()
+{
+#if defined(Y_PLATFORM_LINUX)
+  // reading an eventfd takes the whole count at once
+  uint64 value;
+  return (read(m_fileDescriptors[0], &value, sizeof(value)) == sizeof(value));
+#else
+  char buffer[64];
+  bool consumed = false;
+  while (read(m_fileDescriptors[0], buffer, sizeof(buffer)) > 0)
+    consumed = true;
+
+  return consumed;
+#endif
+}
+
+void PollableEvent::Wait()
+{
+  TryWait(InfiniteTimeout);
+}
+
+bool PollableEvent::TryWait(uint32 timeout)
+{
+  timespec deadline;
+  if (timeout != InfiniteTimeout)
+    GetDeadline(&deadline, timeout);
+
+  pollfd pollDescriptor;
+  pollDescriptor.fd = m_fileDescriptors[0];
+  pollDescriptor.events = POLLIN;
+  for (;;)
+  {
+    int result = poll(&pollDescriptor, 1, (timeout != InfiniteTimeout) ? GetRemainingTime(deadline) : -1);
+    if (result > 0)
+    {
+      // another thread can reset an auto reset event between the poll and the read
+      if (!m_autoReset || Consume())
+        return true;
+    }
+    else if (result == 0 || errno != EINTR)
+    {
+      return false;
+    }
+  }
+}
+
+void PollableEvent::Reset()
+{
+  Consume();
+}
+
+#if defined(Y_PLATFORM_LINUX)
+
+static int Futex(volatile int32* pAddress, int operation, int32 value, const timespec* pTimeout)
+{
+  return int(syscall(SYS_futex, pAddress, operation, value, pTimeout, nullptr, FUTEX_BITSET_MATCH_ANY));
+}
+
+Event::Event(bool autoReset) : m_state(0), m_waiters(0), m_autoReset(autoReset)
+{
+}
+
+Event::~Event()
+{
+}
+
+void Event::Signal()
+{
+  // The waiter count is read after the state's written, and waiters count themselves before the futex checks the
+  // state, so either a waiter sees the signal or a wake is sent for it. If the event was already signaled, that
+  // Signal sent it.
+  if (Y_AtomicExchange(m_state, int32(1)) != 0 || Y_AtomicLoadAcquire(m_waiters) == 0)
+    return;
+
+  Futex(&m_state, FUTEX_WAKE_PRIVATE, m_autoReset ? 1 : INT_MAX, nullptr);
+}
+
+bool Event::Sleep(const timespec* pDeadline)
+{
+  Y_AtomicIncrement(m_waiters);
+
+  // waiting with a bitset takes an absolute monotonic timeout, so waking early doesn't extend the wait
+  int result = Futex(&m_state, FUTEX_WAIT_BITSET_PRIVATE, 0, pDeadline);
+  Y_AtomicDecrement(m_waiters);
+  return (result == 0 || errno != ETIMEDOUT);
+}
+
+bool Event::TryAcquire()
+{
+  if (m_autoReset)
+    return (Y_AtomicCompareExchange(m_state, int32(0), int32(1)) == 1);
+  else
+    return (Y_AtomicLoadAcquire(m_state) != 0);
+}
+
+void Event::Wait()
+{
+  for (;;)
+  {
+    if (TryAcquire())
+      return;
+
+    Sleep(nullptr);
+  }
+}
+
+bool Event::TryWait(uint32 timeout)
+{
+  if (timeout == InfiniteTimeout)
+  {
+    Wait();
+    return true;
+  }
+
+  timespec deadline;
+  if (timeout != 0)
+    GetDeadline(&deadline, timeout);
+
+  for (;;)
+  {
+    if (TryAcquire())
+      return true;
+
+    if (timeout == 0 || !Sleep(&deadline))
+      return false;
+  }
+}
+
+void Event::Reset()
+{
+  Y_AtomicStoreRelease(m_state, int32(0));
+}
+
+#endif // Y_PLATFORM_LINUX
+
+void Event::WaitForMultipleEvents(Event** ppEvents, uint32 nEvents)
+{
+  DebugAssert(nEvents > 0);
+
+  // each is waited for in turn, so auto reset events are reset as they're seen rather than all at once
+  for (uint32 i = 0; i < nEvents; i++)
+    ppEvents[i]->Wait();
+}
+
+#endif // Y_PLATFORM_POSIX
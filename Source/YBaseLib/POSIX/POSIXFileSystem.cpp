@@ -3,21 +3,384 @@
 // Posix FileSystem implementation.
 #if defined(Y_PLATFORM_POSIX)
 
+#include "YBaseLib/Array.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/ConditionVariable.h"
+#include "YBaseLib/GlobPattern.h"
+#include "YBaseLib/HashTable.h"
 #include "YBaseLib/Log.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/ParallelFor.h"
+#include "YBaseLib/StringHashTable.h"
+#include "YBaseLib/ThreadPool.h"
+#include <cstddef>
+#include <cstring>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#if defined(Y_PLATFORM_LINUX)
+#include <sys/inotify.h>
+#endif
 
 Log_SetChannel(FileSystem);
 
+#if defined(Y_PLATFORM_LINUX)
+
+static const uint32 INOTIFY_WATCH_MASK =
+  IN_CREATE | IN_DELETE | IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+// inotify only watches single directories, so recursive watches add one for every directory in the tree, and for
+// directories as they are created or moved in. Everything read in one EnumerateChanges call is coalesced before the
+// callback sees it: repeated modifications are reported once, and files created and deleted in between aren't
+// reported at all. Moves are paired by their cookie into old and new names, moves in and out of the tree become
+// additions and removals. If the kernel's queue overflows the watches are rebuilt and ChangeEvent_Overflow is
+// reported.
+class ChangeNotifierInotify : public FileSystem::ChangeNotifier
+{
+public:
+  ChangeNotifierInotify(int fileDescriptor, const String& directoryPath, bool recursiveWatch)
+    : FileSystem::ChangeNotifier(directoryPath, recursiveWatch), m_fileDescriptor(fileDescriptor)
+  {
+  }
+
+  virtual ~ChangeNotifierInotify()
+  {
+    // takes the watches with it
+    close(m_fileDescriptor);
+  }
+
+  // watches the directory, and everything below it for recursive watches. reportContents queues additions for what
+  // is already there, for directories that appeared after their parent was watched.
+  bool AddWatches(const String& relativePath, bool reportContents)
+  {
+    PathString directoryPath;
+    GetFullPath(directoryPath, relativePath);
+
+    int watchDescriptor = inotify_add_watch(m_fileDescriptor, directoryPath, INOTIFY_WATCH_MASK);
+    if (watchDescriptor < 0)
+      return false;
+
+    bool isNew;
+    m_watches.Set(watchDescriptor, relativePath, &isNew);
+    if (!m_recursiveWatch && !reportContents)
+      return true;
+
+    DIR* pDir = opendir(directoryPath);
+    if (pDir == nullptr)
+      return true;
+
+    PathString childPath;
+    struct dirent* pDirEnt;
+    while ((pDirEnt = readdir(pDir)) != nullptr)
+    {
+      if (pDirEnt->d_name[0] == '.' &&
+          (pDirEnt->d_name[1] == '\0' || (pDirEnt->d_name[1] == '.' && pDirEnt->d_name[2] == '\0')))
+      {
+        continue;
+      }
+
+      GetRelativePath(childPath, relativePath, pDirEnt->d_name);
+      if (reportContents)
+        AddChange(childPath, ChangeEvent_FileAdded);
+
+      bool isDirectory = (pDirEnt->d_type == DT_DIR);
+      if (pDirEnt->d_type == DT_UNKNOWN)
+      {
+        struct stat64 sysStatData;
+        isDirectory = (fstatat64(dirfd(pDir), pDirEnt->d_name, &sysStatData, AT_SYMLINK_NOFOLLOW) == 0 &&
+                       S_ISDIR(sysStatData.st_mode));
+      }
+
+      if (isDirectory && m_recursiveWatch)
+        AddWatches(childPath, reportContents);
+    }
+
+    closedir(pDir);
+    return true;
+  }
+
+  virtual void EnumerateChanges(EnumerateChangesCallback callback, void* pUserData) override
+  {
+    // everything queued, so moves can be paired up
+    bool overflowed = false;
+    ALIGN_DECL(8) byte buffer[16384];
+    for (;;)
+    {
+      ssize_t bytesRead = read(m_fileDescriptor, buffer, sizeof(buffer));
+      if (bytesRead < 0 && errno == EINTR)
+        continue;
+      if (bytesRead <= 0)
+        break;
+
+      const byte* pCurrentPointer = buffer;
+      const byte* pEndPointer = buffer + bytesRead;
+      while (pCurrentPointer < pEndPointer)
+      {
+        const struct inotify_event* pEvent = reinterpret_cast<const struct inotify_event*>(pCurrentPointer);
+        pCurrentPointer += sizeof(struct inotify_event) + pEvent->len;
+        if (pEvent->mask & IN_Q_OVERFLOW)
+          overflowed = true;
+        else
+          HandleEvent(pEvent);
+      }
+    }
+
+    // moves whose other half is outside the tree
+    for (uint32 i = 0; i < m_pendingMoves.GetSize(); i++)
+    {
+      const PendingMove& move = m_pendingMoves[i];
+      m_changes[move.ChangeIndex].Event = ChangeEvent_FileRemoved;
+      if (move.IsDirectory)
+        RemoveWatches(m_changes[move.ChangeIndex].RelativePath);
+    }
+    m_pendingMoves.Clear();
+
+    if (overflowed)
+    {
+      // what's there now is all that can be known, start again from it
+      for (HashTable<int32, String>::Iterator itr = m_watches.Begin(); !itr.AtEnd(); itr.Forward())
+        inotify_rm_watch(m_fileDescriptor, itr->Key);
+      m_watches.Clear();
+      AddWatches(EmptyString, false);
+    }
+
+    PathString fullPath;
+    for (uint32 i = 0; i < m_changes.GetSize(); i++)
+    {
+      if (m_changes[i].Event == 0)
+        continue;
+
+      GetFullPath(fullPath, m_changes[i].RelativePath);
+
+      ChangeInfo changeInfo;
+      changeInfo.Path = fullPath;
+      changeInfo.Event = m_changes[i].Event;
+      callback(&changeInfo, pUserData);
+    }
+    m_changes.Clear();
+    m_changeIndices.Clear();
+
+    if (overflowed)
+    {
+      ChangeInfo changeInfo;
+      changeInfo.Path = m_directoryPath;
+      changeInfo.Event = ChangeEvent_Overflow;
+      callback(&changeInfo, pUserData);
+    }
+  }
+
+private:
+  struct Change
+  {
+    String RelativePath;
+    uint32 Event;
+  };
+
+  struct PendingMove
+  {
+    uint32 Cookie;
+    uint32 ChangeIndex;
+    bool IsDirectory;
+  };
+
+  void GetFullPath(String& destination, const String& relativePath) const
+  {
+    if (relativePath.GetLength() > 0)
+      destination.Format("%s/%s", m_directoryPath.GetCharArray(), relativePath.GetCharArray());
+    else
+      destination.Assign(m_directoryPath);
+  }
+
+  static void GetRelativePath(String& destination, const String& directoryPath, const char* name)
+  {
+    if (directoryPath.GetLength() > 0)
+      destination.Format("%s/%s", directoryPath.GetCharArray(), name);
+    else
+      destination.Assign(name);
+  }
+
+  void HandleEvent(const struct inotify_event* pEvent)
+  {
+    // events for the watched directory itself are followed by IN_IGNORED, and its parent reports the change
+    if (pEvent->mask & IN_IGNORED)
+    {
+      m_watches.Remove(pEvent->wd);
+      return;
+    }
+
+    const HashTable<int32, String>::Member* pWatch = m_watches.Find(pEvent->wd);
+    if (pWatch == nullptr || pEvent->len == 0)
+      return;
+
+    PathString relativePath;
+    GetRelativePath(relativePath, pWatch->Value, pEvent->name);
+    bool isDirectory = (pEvent->mask & IN_ISDIR) != 0;
+    if (pEvent->mask & IN_CREATE)
+    {
+      AddChange(relativePath, ChangeEvent_FileAdded);
+      if (isDirectory && m_recursiveWatch)
+        AddWatches(relativePath, true);
+    }
+    else if (pEvent->mask & IN_DELETE)
+    {
+      AddChange(relativePath, ChangeEvent_FileRemoved);
+    }
+    else if (pEvent->mask & IN_MODIFY)
+    {
+      AddChange(relativePath, ChangeEvent_FileModified);
+    }
+    else if (pEvent->mask & IN_MOVED_FROM)
+    {
+      PendingMove move;
+      move.Cookie = pEvent->cookie;
+      move.ChangeIndex = AddChange(relativePath, ChangeEvent_RenamedOldName);
+      move.IsDirectory = isDirectory;
+      m_pendingMoves.Add(move);
+    }
+    else if (pEvent->mask & IN_MOVED_TO)
+    {
+      for (uint32 i = 0; i < m_pendingMoves.GetSize(); i++)
+      {
+        if (m_pendingMoves[i].Cookie != pEvent->cookie)
+          continue;
+
+        // the watches below a moved directory go with it, only their paths change
+        if (isDirectory)
+          RenameWatches(m_changes[m_pendingMoves[i].ChangeIndex].RelativePath, relativePath);
+
+        m_pendingMoves.FastRemove(i);
+        AddChange(relativePath, ChangeEvent_RenamedNewName);
+        return;
+      }
+
+      AddChange(relativePath, ChangeEvent_FileAdded);
+      if (isDirectory && m_recursiveWatch)
+        AddWatches(relativePath, true);
+    }
+  }
+
+  // queues a change, folding it into an earlier one for the same path where that says the same thing or more
+  uint32 AddChange(const String& relativePath, uint32 event)
+  {
+    StringHashTable<uint32>::Member* pIndex = m_changeIndices.Find(relativePath);
+    if (pIndex != nullptr)
+    {
+      Change& previous = m_changes[pIndex->Value];
+      // a new directory's contents can be seen both when it's read and through its watch
+      if ((event == ChangeEvent_FileModified &&
+           (previous.Event == ChangeEvent_FileAdded || previous.Event == ChangeEvent_FileModified ||
+            previous.Event == ChangeEvent_RenamedNewName)) ||
+          (event == ChangeEvent_FileAdded && previous.Event == ChangeEvent_FileAdded))
+      {
+        return pIndex->Value;
+      }
+
+      // created and gone again, or modified and then deleted
+      if (event == ChangeEvent_FileRemoved &&
+          (previous.Event == ChangeEvent_FileAdded || previous.Event == ChangeEvent_FileModified))
+      {
+        bool wasAdded = (previous.Event == ChangeEvent_FileAdded);
+        previous.Event = 0;
+        m_changeIndices.Remove(pIndex);
+        if (wasAdded)
+          return m_changes.GetSize();
+      }
+    }
+
+    Change change;
+    change.RelativePath = relativePath;
+    change.Event = event;
+    m_changes.Add(change);
+
+    bool isNew;
+    m_changeIndices.Set(relativePath, m_changes.GetSize() - 1, &isNew);
+    return m_changes.GetSize() - 1;
+  }
+
+  // collects the watches for a directory and everything below it
+  void FindWatches(const String& relativePath, PODArray<int32>* pWatchDescriptors)
+  {
+    for (HashTable<int32, String>::Iterator itr = m_watches.Begin(); !itr.AtEnd(); itr.Forward())
+    {
+      const String& watchPath = itr->Value;
+      if (watchPath.StartsWith(relativePath) &&
+          (watchPath.GetLength() == relativePath.GetLength() || watchPath[relativePath.GetLength()] == '/'))
+      {
+        pWatchDescriptors->Add(itr->Key);
+      }
+    }
+  }
+
+  void RenameWatches(const String& oldPath, const String& newPath)
+  {
+    PODArray<int32> watchDescriptors;
+    FindWatches(oldPath, &watchDescriptors);
+
+    PathString renamedPath;
+    for (uint32 i = 0; i < watchDescriptors.GetSize(); i++)
+    {
+      HashTable<int32, String>::Member* pWatch = m_watches.Find(watchDescriptors[i]);
+      renamedPath.Format("%s%s", newPath.GetCharArray(), pWatch->Value.GetCharArray() + oldPath.GetLength());
+      pWatch->Value = renamedPath;
+    }
+  }
+
+  void RemoveWatches(const String& relativePath)
+  {
+    PODArray<int32> watchDescriptors;
+    FindWatches(relativePath, &watchDescriptors);
+    for (uint32 i = 0; i < watchDescriptors.GetSize(); i++)
+    {
+      inotify_rm_watch(m_fileDescriptor, watchDescriptors[i]);
+      m_watches.Remove(watchDescriptors[i]);
+    }
+  }
+
+  int m_fileDescriptor;
+
+  // path of each watched directory, relative to the watched path
+  HashTable<int32, String> m_watches;
+
+  // changes read so far in this call, and where each path's last one is
+  Array<Change> m_changes;
+  StringHashTable<uint32> m_changeIndices;
+  PODArray<PendingMove> m_pendingMoves;
+};
+
+FileSystem::ChangeNotifier* FileSystem::CreateChangeNotifier(const char* path, bool recursiveWatch)
+{
+  int fileDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fileDescriptor < 0)
+  {
+    Log_ErrorPrintf("FileSystem::CreateChangeNotifier(%s): inotify_init1() failed: %d", path, errno);
+    return nullptr;
+  }
+
+  ChangeNotifierInotify* pChangeNotifier = new ChangeNotifierInotify(fileDescriptor, path, recursiveWatch);
+  if (!pChangeNotifier->AddWatches(EmptyString, false))
+  {
+    Log_ErrorPrintf("FileSystem::CreateChangeNotifier(%s): inotify_add_watch() failed: %d", path, errno);
+    delete pChangeNotifier;
+    return nullptr;
+  }
+
+  return pChangeNotifier;
+}
+
+#else
+
 FileSystem::ChangeNotifier* FileSystem::CreateChangeNotifier(const char* path, bool recursiveWatch)
 {
   Log_ErrorPrintf("FileSystem::CreateChangeNotifier(%s) not implemented", path);
   return nullptr;
 }
 
+#endif
+
 void FileSystem::BuildOSPath(char* Destination, uint32 cbDestination, const char* Path)
 {
   uint32 i;
@@ -78,8 +441,8 @@ void FileSystem::BuildOSPath(String& Destination)
   BuildOSPath(Destination, Destination);
 }
 
-static uint32 RecursiveFindFiles(const char* OriginPath, const char* ParentPath, const char* Path, const char* Pattern,
-                                 uint32 Flags, FileSystem::FindResultsArray* pResults)
+static uint32 RecursiveFindFiles(const char* OriginPath, const char* ParentPath, const char* Path,
+                                 const GlobPattern& Pattern, uint32 Flags, FileSystem::FindResultsArray* pResults)
 {
   uint32 tempPathLength = Y_strlen(OriginPath) + 2;
   if (ParentPath != NULL)
@@ -104,15 +467,7 @@ static uint32 RecursiveFindFiles(const char* OriginPath, const char* ParentPath,
   if (pDir == NULL)
     return 0;
 
-  // small speed optimization for '*' case
-  bool hasWildCards = false;
-  bool wildCardMatchAll = false;
   uint32 nFiles = 0;
-  if (Y_strpbrk(Pattern, "*?") != NULL)
-  {
-    hasWildCards = true;
-    wildCardMatchAll = !(Y_strcmp(Pattern, "*"));
-  }
 
   // iterate results
   struct dirent* pDirEnt;
@@ -164,16 +519,8 @@ static uint32 RecursiveFindFiles(const char* OriginPath, const char* ParentPath,
     //            outData.Attributes |= FILESYSTEM_FILE_ATTRIBUTE_READ_ONLY;
 
     // match the filename
-    if (hasWildCards)
-    {
-      if (!wildCardMatchAll && !Y_strwildcmp(pDirEnt->d_name, Pattern))
-        continue;
-    }
-    else
-    {
-      if (Y_strcmp(pDirEnt->d_name, Pattern) != 0)
-        continue;
-    }
+    if (!Pattern.MatchesAll() && !Pattern.Match(pDirEnt->d_name))
+      continue;
 
     // add file to list
     // TODO string formatter, clean this mess..
@@ -216,20 +563,238 @@ bool FileSystem::FindFiles(const char* Path, const char* Pattern, uint32 Flags,
     pResults->Clear();
 
   // enter the recursive function
-  return (RecursiveFindFiles(Path, NULL, NULL, Pattern, Flags, pResults) > 0);
+  GlobPattern compiledPattern(Pattern);
+  return (RecursiveFindFiles(Path, NULL, NULL, compiledPattern, Flags, pResults) > 0);
 }
 
-bool FileSystem::StatFile(const char* Path, FILESYSTEM_STAT_DATA* pStatData)
+// Shared state for one FindFilesParallel call, run by helpers like ParallelForJob. Directories waiting to be
+// searched are kept on a stack by their path relative to the origin, so the search stays roughly depth first.
+// Entries are typed from d_type and stat'd relative to the open directory, only when they match or d_type is unknown.
+class ParallelFindJob : public ReferenceCounted
+{
+public:
+  ParallelFindJob(const char* originPath, const char* pattern, uint32 flags, FileSystem::FindFilesCallback callback,
+                  void* pUserData)
+    : m_originPath(originPath), m_pattern(pattern), m_flags(flags), m_callback(callback), m_pUserData(pUserData),
+      m_pPendingDirectories(nullptr), m_outstandingCount(1), m_matchCount(0)
+  {
+    m_pPendingDirectories = AllocatePendingDirectory("", 0, nullptr);
+  }
+
+  ~ParallelFindJob() { DebugAssert(m_pPendingDirectories == nullptr); }
+
+  uint32 GetMatchCount() const { return m_matchCount; }
+
+  // searches directories until there are none left anywhere
+  void Participate()
+  {
+    m_lock.Lock();
+    for (;;)
+    {
+      // others may still find more
+      while (m_pPendingDirectories == nullptr && m_outstandingCount > 0)
+        m_conditionVariable.SleepAndRelease(&m_lock);
+      if (m_pPendingDirectories == nullptr)
+        break;
+
+      PendingDirectory* pDirectory = m_pPendingDirectories;
+      m_pPendingDirectories = pDirectory->pNext;
+      m_lock.Unlock();
+
+      SearchDirectory(pDirectory->Path);
+      Y_free(pDirectory);
+
+      m_lock.Lock();
+      if (--m_outstandingCount == 0)
+        m_conditionVariable.WakeAll();
+    }
+    m_lock.Unlock();
+  }
+
+  void RunHelper() { Participate(); }
+
+private:
+  struct PendingDirectory
+  {
+    PendingDirectory* pNext;
+    char Path[1];
+  };
+
+  static PendingDirectory* AllocatePendingDirectory(const char* path, uint32 pathLength, PendingDirectory* pNext)
+  {
+    PendingDirectory* pDirectory =
+      static_cast<PendingDirectory*>(Y_malloc(offsetof(PendingDirectory, Path) + pathLength + 1));
+    pDirectory->pNext = pNext;
+    std::memcpy(pDirectory->Path, path, pathLength);
+    pDirectory->Path[pathLength] = '\0';
+    return pDirectory;
+  }
+
+  void SearchDirectory(const char* relativePath)
+  {
+    PathString directoryPath;
+    if (relativePath[0] != '\0')
+      directoryPath.Format("%s/%s", m_originPath, relativePath);
+    else
+      directoryPath.Assign(m_originPath);
+
+    DIR* pDir = opendir(directoryPath);
+    if (pDir == nullptr)
+      return;
+
+    // subdirectories are queued together once this one is done
+    int directoryFileDescriptor = dirfd(pDir);
+    PendingDirectory* pSubdirectories = nullptr;
+    uint32 subdirectoryCount = 0;
+    PathString subdirectoryPath;
+
+    struct dirent* pDirEnt;
+    while ((pDirEnt = readdir(pDir)) != nullptr)
+    {
+      if (pDirEnt->d_name[0] == '.')
+      {
+        if (pDirEnt->d_name[1] == '\0' || (pDirEnt->d_name[1] == '.' && pDirEnt->d_name[2] == '\0'))
+          continue;
+
+        if (!(m_flags & FILESYSTEM_FIND_HIDDEN_FILES))
+          continue;
+      }
+
+      // some file systems don't fill in the type
+      struct stat64 sysStatData;
+      bool haveStatData = false;
+      bool isDirectory = (pDirEnt->d_type == DT_DIR);
+      if (pDirEnt->d_type == DT_UNKNOWN)
+      {
+        if (fstatat64(directoryFileDescriptor, pDirEnt->d_name, &sysStatData, AT_SYMLINK_NOFOLLOW) < 0)
+          continue;
+
+        haveStatData = true;
+        isDirectory = S_ISDIR(sysStatData.st_mode);
+      }
+
+      if (isDirectory)
+      {
+        if (m_flags & FILESYSTEM_FIND_RECURSIVE)
+        {
+          if (relativePath[0] != '\0')
+            subdirectoryPath.Format("%s/%s", relativePath, pDirEnt->d_name);
+          else
+            subdirectoryPath.Assign(pDirEnt->d_name);
+
+          pSubdirectories =
+            AllocatePendingDirectory(subdirectoryPath, subdirectoryPath.GetLength(), pSubdirectories);
+          subdirectoryCount++;
+        }
+
+        if (!(m_flags & FILESYSTEM_FIND_FOLDERS))
+          continue;
+      }
+      else
+      {
+        if (!(m_flags & FILESYSTEM_FIND_FILES))
+          continue;
+      }
+
+      // match the filename
+      if (!m_pattern.MatchesAll() && !m_pattern.Match(pDirEnt->d_name))
+        continue;
+
+      FILESYSTEM_FIND_DATA outData;
+      outData.Attributes = isDirectory ? FILESYSTEM_FILE_ATTRIBUTE_DIRECTORY : 0;
+      if (!(m_flags & FILESYSTEM_FIND_RELATIVE_PATHS))
+      {
+        if (relativePath[0] != '\0')
+          Y_snprintf(outData.FileName, countof(outData.FileName), "%s/%s/%s", m_originPath, relativePath,
+                     pDirEnt->d_name);
+        else
+          Y_snprintf(outData.FileName, countof(outData.FileName), "%s/%s", m_originPath, pDirEnt->d_name);
+      }
+      else
+      {
+        if (relativePath[0] != '\0')
+          Y_snprintf(outData.FileName, countof(outData.FileName), "%s/%s", relativePath, pDirEnt->d_name);
+        else
+          Y_strncpy(outData.FileName, countof(outData.FileName), pDirEnt->d_name);
+      }
+
+      if (!(m_flags & FILESYSTEM_FIND_NO_STAT))
+      {
+        if (haveStatData ||
+            fstatat64(directoryFileDescriptor, pDirEnt->d_name, &sysStatData, AT_SYMLINK_NOFOLLOW) == 0)
+        {
+          outData.ModificationTime.SetUnixTimestamp((Timestamp::UnixTimestampValue)sysStatData.st_mtime);
+          outData.Size = S_ISREG(sysStatData.st_mode) ? static_cast<uint64>(sysStatData.st_size) : 0;
+        }
+        else
+        {
+          outData.ModificationTime.SetUnixTimestamp(0);
+          outData.Size = 0;
+        }
+      }
+
+      Y_AtomicIncrement(m_matchCount);
+      m_callback(&outData, m_pUserData);
+    }
+
+    closedir(pDir);
+    if (pSubdirectories == nullptr)
+      return;
+
+    // the new ones count before this one is finished, so the count can't reach zero in between
+    PendingDirectory* pLast = pSubdirectories;
+    while (pLast->pNext != nullptr)
+      pLast = pLast->pNext;
+
+    m_lock.Lock();
+    pLast->pNext = m_pPendingDirectories;
+    m_pPendingDirectories = pSubdirectories;
+    m_outstandingCount += subdirectoryCount;
+    if (subdirectoryCount > 1)
+      m_conditionVariable.WakeAll();
+    else
+      m_conditionVariable.Wake();
+    m_lock.Unlock();
+  }
+
+  const char* m_originPath;
+  GlobPattern m_pattern;
+  uint32 m_flags;
+  FileSystem::FindFilesCallback m_callback;
+  void* m_pUserData;
+
+  // directories waiting and the number queued or being searched, protected by m_lock
+  Mutex m_lock;
+  ConditionVariable m_conditionVariable;
+  PendingDirectory* m_pPendingDirectories;
+  uint32 m_outstandingCount;
+
+  Y_ATOMIC_DECL uint32 m_matchCount;
+};
+
+bool FileSystem::FindFilesParallel(const char* Path, const char* Pattern, uint32 Flags, ThreadPool* pThreadPool,
+                                   FindFilesCallback callback, void* pUserData)
 {
   // has a path
   if (Path[0] == '\0')
     return false;
 
-  // stat file
-  struct stat64 sysStatData;
-  if (stat64(Path, &sysStatData) < 0)
-    return false;
+  ParallelFindJob* pJob = new ParallelFindJob(Path, Pattern, Flags, callback, pUserData);
+  if (pThreadPool != nullptr && (Flags & FILESYSTEM_FIND_RECURSIVE))
+  {
+    for (uint32 i = 0; i < pThreadPool->GetWorkerThreadCount(); i++)
+      ThreadPoolHelperWorkItem<ParallelFindJob>::Enqueue(pThreadPool, pJob);
+  }
 
+  // helpers that start after this returns find nothing left and leave without touching the callback
+  pJob->Participate();
+  bool result = (pJob->GetMatchCount() > 0);
+  pJob->Release();
+  return result;
+}
+
+static void TranslateStatData(const struct stat64& sysStatData, FILESYSTEM_STAT_DATA* pStatData)
+{
   // parse attributes
   pStatData->Attributes = 0;
   if (S_ISDIR(sysStatData.st_mode))
@@ -243,11 +808,85 @@ bool FileSystem::StatFile(const char* Path, FILESYSTEM_STAT_DATA* pStatData)
     pStatData->Size = static_cast<uint64>(sysStatData.st_size);
   else
     pStatData->Size = 0;
+}
 
-  // ok
+bool FileSystem::StatFile(const char* Path, FILESYSTEM_STAT_DATA* pStatData)
+{
+  // has a path
+  if (Path[0] == '\0')
+    return false;
+
+  // stat file
+  struct stat64 sysStatData;
+  if (stat64(Path, &sysStatData) < 0)
+    return false;
+
+  TranslateStatData(sysStatData, pStatData);
   return true;
 }
 
+// Stats [begin, end) of a batch, relative to directoryFileDescriptor, or the working directory for AT_FDCWD.
+// Returns the number found.
+static uint32 StatFileRange(int directoryFileDescriptor, const char* const* Paths, uint32 begin, uint32 end,
+                            FILESYSTEM_STAT_DATA* pStatData, bool* pFound)
+{
+  uint32 foundCount = 0;
+  for (uint32 i = begin; i < end; i++)
+  {
+    struct stat64 sysStatData;
+    pFound[i] = (Paths[i][0] != '\0' && fstatat64(directoryFileDescriptor, Paths[i], &sysStatData, 0) == 0);
+    if (pFound[i])
+    {
+      TranslateStatData(sysStatData, &pStatData[i]);
+      foundCount++;
+    }
+  }
+
+  return foundCount;
+}
+
+// paths stat'd by a thread at a time, enough to make handing out chunks cheap
+static const uint32 STAT_FILES_GRAIN_SIZE = 64;
+
+// one path per stat is all the kernel offers, so the batch is only spread over threads
+static uint32 StatFileBatch(int directoryFileDescriptor, const char* const* Paths, uint32 Count,
+                            FILESYSTEM_STAT_DATA* pStatData, bool* pFound, ThreadPool* pThreadPool)
+{
+  Y_ATOMIC_DECL uint32 foundCount = 0;
+  ParallelForRange(pThreadPool, 0, Count, STAT_FILES_GRAIN_SIZE, [&](uint32 rangeBegin, uint32 rangeEnd) {
+    uint32 rangeFoundCount = StatFileRange(directoryFileDescriptor, Paths, rangeBegin, rangeEnd, pStatData, pFound);
+    if (rangeFoundCount > 0)
+      Y_AtomicAdd(foundCount, rangeFoundCount);
+  });
+
+  return foundCount;
+}
+
+uint32 FileSystem::StatFiles(const char* const* Paths, uint32 Count, FILESYSTEM_STAT_DATA* pStatData, bool* pFound,
+                             ThreadPool* pThreadPool /* = nullptr */)
+{
+  return StatFileBatch(AT_FDCWD, Paths, Count, pStatData, pFound, pThreadPool);
+}
+
+uint32 FileSystem::StatFilesInDirectory(const char* DirectoryPath, const char* const* Names, uint32 Count,
+                                        FILESYSTEM_STAT_DATA* pStatData, bool* pFound,
+                                        ThreadPool* pThreadPool /* = nullptr */)
+{
+  // the names are looked up from the open directory, so its path is only resolved once
+  int directoryFileDescriptor = open(DirectoryPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (directoryFileDescriptor < 0)
+  {
+    for (uint32 i = 0; i < Count; i++)
+      pFound[i] = false;
+
+    return 0;
+  }
+
+  uint32 foundCount = StatFileBatch(directoryFileDescriptor, Names, Count, pStatData, pFound, pThreadPool);
+  close(directoryFileDescriptor);
+  return foundCount;
+}
+
 bool FileSystem::FileExists(const char* Path)
 {
   // has a path
@@ -357,9 +996,7 @@ bool FileSystem::CreateDirectory(const char* Path, bool Recursive)
         if (mkdir(tempStr, 0777) < 0)
         {
           lastError = errno;
-          if (lastError == EEXIST) // fine, continue to next path segment
-            continue;
-          else // anything else is a fail
+          if (lastError != EEXIST) // existing is fine, anything else is a fail
             return false;
         }
       }
@@ -402,8 +1039,42 @@ bool FileSystem::DeleteFile(const char* Path)
 
 bool FileSystem::DeleteDirectory(const char* Path, bool Recursive)
 {
-  Log_ErrorPrintf("FileSystem::DeleteDirectory(%s) not implemented", Path);
-  return false;
+  // ensure it exists
+  struct stat sysStatData;
+  if (Path[0] == '\0' || lstat(Path, &sysStatData) < 0 || !S_ISDIR(sysStatData.st_mode))
+    return false;
+
+  // non-recursive case just try removing the directory
+  if (!Recursive)
+    return (rmdir(Path) == 0);
+
+  // doing a recursive delete
+  DIR* pDir = opendir(Path);
+  if (pDir == NULL)
+    return false;
+
+  // links are removed rather than followed
+  bool result = true;
+  PathString fileName;
+  struct dirent* pDirEnt;
+  while (result && (pDirEnt = readdir(pDir)) != NULL)
+  {
+    // skip . and ..
+    if (pDirEnt->d_name[0] == '.' &&
+        (pDirEnt->d_name[1] == '\0' || (pDirEnt->d_name[1] == '.' && pDirEnt->d_name[2] == '\0')))
+    {
+      continue;
+    }
+
+    fileName.Format("%s/%s", Path, pDirEnt->d_name);
+    if (lstat(fileName, &sysStatData) == 0 && S_ISDIR(sysStatData.st_mode))
+      result = DeleteDirectory(fileName, true);
+    else
+      result = (unlink(fileName) == 0);
+  }
+
+  closedir(pDir);
+  return (result && rmdir(Path) == 0);
 }
 
 #endif // Y_PLATFORM_POSIX
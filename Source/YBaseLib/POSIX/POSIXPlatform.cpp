@@ -6,6 +6,12 @@
 #if defined(Y_PLATFORM_LINUX)
 #define _GNU_SOURCE 1
 #include <dlfcn.h>
+#include <sys/syscall.h>
+#endif
+
+#if (defined(Y_PLATFORM_LINUX) && defined(__GLIBC__)) || defined(Y_PLATFORM_OSX)
+#include <execinfo.h>
+#define HAVE_EXECINFO 1
 #endif
 
 #if defined(Y_PLATFORM_OSX)
@@ -14,7 +20,11 @@
 #include <sys/param.h>
 #endif
 
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/CString.h"
 #include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -152,4 +162,169 @@ bool Platform::InitializeSocketSupport(Error* pError)
   return true;
 }
 
+// shared memory object with no name, so the mappings are the only thing keeping it alive
+static int CreateMirroredMemoryFile()
+{
+#if defined(Y_PLATFORM_LINUX)
+#if defined(SYS_memfd_create)
+  return (int)syscall(SYS_memfd_create, "mirrored", 0);
+#else
+  return -1;
+#endif
+#else
+  static Y_ATOMIC_DECL uint32 sequence = 0;
+  char name[64];
+  Y_snprintf(name, sizeof(name), "/ybaselib-mirror-%d-%u", (int)getpid(), Y_AtomicIncrement(sequence));
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd >= 0)
+    shm_unlink(name);
+
+  return fd;
+#endif
+}
+
+void* Platform::AllocateMirroredMemory(size_t size)
+{
+  DebugAssert(size > 0 && (size % GetMirroredMemoryGranularity()) == 0);
+
+  int fd = CreateMirroredMemoryFile();
+  if (fd < 0)
+    return nullptr;
+
+  // reserve the whole range first so nothing else can land between the two views
+  byte* pBase = nullptr;
+  if (ftruncate(fd, (off_t)size) == 0)
+  {
+    pBase = (byte*)mmap(nullptr, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pBase == MAP_FAILED)
+    {
+      pBase = nullptr;
+    }
+    else if (mmap(pBase, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+             mmap(pBase + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+      munmap(pBase, size * 2);
+      pBase = nullptr;
+    }
+  }
+
+  close(fd);
+  return pBase;
+}
+
+void Platform::FreeMirroredMemory(void* pMemory, size_t size)
+{
+  if (pMemory != nullptr)
+    munmap(pMemory, size * 2);
+}
+
+size_t Platform::GetMirroredMemoryGranularity()
+{
+  return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// transparent huge pages are this size where there are any
+static const size_t HugePageSize = 2 * 1024 * 1024;
+
+void* Platform::ReserveVirtualMemory(size_t size, uint32 flags)
+{
+  DebugAssert(size > 0 && (size % GetVirtualMemoryPageSize()) == 0);
+
+  // for huge pages, over-reserve so the range can start on one, and hand back the ends
+  size_t alignment = (flags & Y_MALLOC_FLAG_HUGE_PAGES) ? HugePageSize : 0;
+  byte* pBase =
+    (byte*)mmap(nullptr, size + alignment, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (pBase == MAP_FAILED)
+    return nullptr;
+
+  byte* pAligned = pBase;
+  if (alignment > 0)
+  {
+    pAligned = (byte*)(((size_t)pBase + alignment - 1) & ~(alignment - 1));
+    if (pAligned != pBase)
+      munmap(pBase, pAligned - pBase);
+    if (pAligned != pBase + alignment)
+      munmap(pAligned + size, (pBase + alignment) - pAligned);
+  }
+
+  if (flags != 0)
+    AdviseMemory(pAligned, size, flags);
+
+  return pAligned;
+}
+
+bool Platform::CommitVirtualMemory(void* pMemory, size_t size)
+{
+  return (mprotect(pMemory, size, PROT_READ | PROT_WRITE) == 0);
+}
+
+void Platform::DecommitVirtualMemory(void* pMemory, size_t size)
+{
+  // mapping fresh pages over the range drops the old ones, where madvise alone may keep them counted
+  mmap(pMemory, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+}
+
+void Platform::ReleaseVirtualMemory(void* pMemory, size_t size)
+{
+  if (pMemory != nullptr)
+    munmap(pMemory, size);
+}
+
+size_t Platform::GetVirtualMemoryPageSize()
+{
+  return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+#if defined(Y_PLATFORM_LINUX)
+// from linux/mempolicy.h, which clashes with the libc headers
+static const int MemoryPolicyPreferred = 1;
+static const uint32 NodeMaskBits = 1024;
+#endif
+
+void Platform::AdviseMemory(void* pMemory, size_t size, uint32 flags)
+{
+#if defined(Y_PLATFORM_LINUX)
+  // only whole pages can be advised, the ones at the ends may be shared with other allocations
+  size_t pageSize = GetVirtualMemoryPageSize();
+  size_t start = ((size_t)pMemory + pageSize - 1) & ~(pageSize - 1);
+  size_t end = ((size_t)pMemory + size) & ~(pageSize - 1);
+  if (end <= start)
+    return;
+
+#if defined(MADV_HUGEPAGE)
+  if ((flags & Y_MALLOC_FLAG_HUGE_PAGES) && end - start >= HugePageSize)
+    madvise((void*)start, end - start, MADV_HUGEPAGE);
+#endif
+
+  // preferred rather than bound, so the pages go elsewhere when the node is full rather than failing
+  unsigned int cpu, node;
+  if ((flags & Y_MALLOC_FLAG_NUMA_LOCAL) && syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 && node < NodeMaskBits)
+  {
+    const uint32 wordBits = sizeof(unsigned long) * 8;
+    unsigned long nodeMask[NodeMaskBits / wordBits] = {};
+    nodeMask[node / wordBits] = 1UL << (node % wordBits);
+    syscall(SYS_mbind, start, end - start, MemoryPolicyPreferred, nodeMask, (unsigned long)NodeMaskBits + 1, 0);
+  }
+#endif
+}
+
+uint32 Platform::CaptureCallStack(void** ppFrames, uint32 maxFrames, uint32 skipFrames)
+{
+#if defined(HAVE_EXECINFO)
+  // backtrace() can't skip, so it fills a buffer with room for the frames skipped, ourselves too
+  static const uint32 MaxCapturedFrames = 128;
+  void* pFrames[MaxCapturedFrames];
+  uint32 skipCount = skipFrames + 1;
+  int frameCount = backtrace(pFrames, (int)Min(maxFrames + skipCount, MaxCapturedFrames));
+  if (frameCount <= (int)skipCount)
+    return 0;
+
+  uint32 count = Min((uint32)frameCount - skipCount, maxFrames);
+  std::memcpy(ppFrames, pFrames + skipCount, sizeof(void*) * count);
+  return count;
+#else
+  return 0;
+#endif
+}
+
 #endif // Y_PLATFORM_POSIX
@@ -16,11 +16,29 @@ ReadWriteLock::~ReadWriteLock()
 
 void ReadWriteLock::LockShared()
 {
+#if Y_LOCK_PROFILING
+  if (m_profile.IsEnabled())
+  {
+    m_profile.AcquireShared([this]() { return (pthread_rwlock_tryrdlock(&m_ReadWriteLock) == 0); },
+                            [this]() { pthread_rwlock_rdlock(&m_ReadWriteLock); });
+    return;
+  }
+#endif
+
   pthread_rwlock_rdlock(&m_ReadWriteLock);
 }
 
 void ReadWriteLock::LockExclusive()
 {
+#if Y_LOCK_PROFILING
+  if (m_profile.IsEnabled())
+  {
+    m_profile.Acquire([this]() { return (pthread_rwlock_trywrlock(&m_ReadWriteLock) == 0); },
+                      [this]() { pthread_rwlock_wrlock(&m_ReadWriteLock); });
+    return;
+  }
+#endif
+
   pthread_rwlock_wrlock(&m_ReadWriteLock);
 }
 
@@ -31,23 +49,47 @@ void ReadWriteLock::UnlockShared()
 
 void ReadWriteLock::UnlockExclusive()
 {
+#if Y_LOCK_PROFILING
+  m_profile.Release();
+#endif
   pthread_rwlock_unlock(&m_ReadWriteLock);
 }
 
 bool ReadWriteLock::TryLockShared()
 {
-  return (pthread_rwlock_tryrdlock(&m_ReadWriteLock) == 0);
+  if (pthread_rwlock_tryrdlock(&m_ReadWriteLock) != 0)
+    return false;
+
+#if Y_LOCK_PROFILING
+  m_profile.OnTryAcquiredShared();
+#endif
+  return true;
 }
 
 bool ReadWriteLock::TryLockExclusive()
 {
-  return (pthread_rwlock_trywrlock(&m_ReadWriteLock) == 0);
+  if (pthread_rwlock_trywrlock(&m_ReadWriteLock) != 0)
+    return false;
+
+#if Y_LOCK_PROFILING
+  m_profile.OnTryAcquired();
+#endif
+  return true;
 }
 
 void ReadWriteLock::UpgradeSharedLockToExclusive()
 {
   // windows provides no api for this, so it may be slow dependant on contention
   pthread_rwlock_unlock(&m_ReadWriteLock);
+#if Y_LOCK_PROFILING
+  if (m_profile.IsEnabled())
+  {
+    m_profile.Acquire([this]() { return (pthread_rwlock_trywrlock(&m_ReadWriteLock) == 0); },
+                      [this]() { pthread_rwlock_wrlock(&m_ReadWriteLock); });
+    return;
+  }
+#endif
+
   pthread_rwlock_wrlock(&m_ReadWriteLock);
 }
 
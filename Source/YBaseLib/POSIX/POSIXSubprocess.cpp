@@ -1,31 +1,212 @@
 #include "YBaseLib/Common.h"
 
 #ifdef Y_PLATFORM_POSIX
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/CString.h"
 #include "YBaseLib/Log.h"
 #include "YBaseLib/PODArray.h"
 #include "YBaseLib/String.h"
 #include "YBaseLib/StringConverter.h"
 #include "YBaseLib/Subprocess.h"
+#include "YBaseLib/Timer.h"
+#include <fcntl.h>
 #include <poll.h>
 #include <signal.h>
+#include <spawn.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/wait.h>
+
+// The shared memory channel needs memfd and futexes that work across processes.
+#if defined(Y_PLATFORM_LINUX)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#define Y_SUBPROCESS_SHARED_MEMORY 1
+#endif
+
+extern char** environ;
+
 Log_SetChannel(Subprocess);
 
 // Environment variable keys
+static const char* COMM_ENV_VAR_PREFIX = "__SUBPROCESS_";
 static const char* COMM_ENV_VAR_PARENT_PROCESS_ID = "__SUBPROCESS_PPID";
 static const char* COMM_ENV_VAR_PARAMETERS = "__SUBPROCESS_PARAMETERS";
 static const char* COMM_ENV_VAR_EVENT_HANDLE = "__SUBPROCESS_EVENTHANDLE";
 static const char* COMM_ENV_VAR_READ_PIPE_HANDLE = "__SUBPROCESS_RDPIPE_HANDLE";
 static const char* COMM_ENV_VAR_WRITE_PIPE_HANDLE = "__SUBPROCESS_WRPIPE_HANDLE";
 static const char* COMM_ENV_VAR_TERMINATE_ON_PARENT_LOST = "__SUBPROCESS_TERMINATE_ON_PARENT_LOST";
+static const char* COMM_ENV_VAR_SHARED_MEMORY_HANDLE = "__SUBPROCESS_SHM_HANDLE";
+static const char* COMM_ENV_VAR_SHARED_MEMORY_SIZE = "__SUBPROCESS_SHM_SIZE";
 
-// Messages sent during initialization
+// Messages sent during initialization. The shared memory variants offer and accept the shared channel, a child that
+// can't map it answers with the plain message and both sides stay on the pipes.
 static const uint32 PARENT_READY_MESSAGE_VALUE = 0xaabbcc00;
+static const uint32 PARENT_READY_SHARED_MEMORY_MESSAGE_VALUE = 0xaabbcc01;
 static const uint32 CHILD_READY_MESSAGE_VALUE = 0xbbccdd01;
+static const uint32 CHILD_READY_SHARED_MEMORY_MESSAGE_VALUE = 0xbbccdd02;
 static const int PARENT_PROCESS_DIED_EXIT_CODE = 0xdeadf00d;
 
+// How long a blocked shared memory read or write sleeps before checking the other side's still alive.
+static const uint32 SHARED_MEMORY_LIVENESS_INTERVAL = 100;
+
+// One direction of the shared memory channel, a single producer single consumer byte ring. Positions run freely and
+// are masked by the power of two capacity. Each side flags itself before sleeping on the other's position with a
+// futex, and the other side only wakes it when the flag's set.
+struct SubprocessSharedRing
+{
+  Y_CACHE_ALIGNED_DECL Y_ATOMIC_DECL uint32 WritePosition;
+  Y_ATOMIC_DECL uint32 ReaderWaiting;
+  Y_CACHE_ALIGNED_DECL Y_ATOMIC_DECL uint32 ReadPosition;
+  Y_ATOMIC_DECL uint32 WriterWaiting;
+};
+
+// the rings' headers sit in the first page, the parent to child data follows, then the child to parent data
+static const size_t SHARED_MEMORY_HEADER_SIZE = 4096;
+
+static size_t GetSharedMemorySize(uint32 channelSize)
+{
+  return SHARED_MEMORY_HEADER_SIZE + size_t(channelSize) * 2;
+}
+
+static uint32 GetSharedMemoryChannelSize(uint32 requestedSize)
+{
+  // round up to a power of two, so positions can be masked
+  uint32 channelSize = 4096;
+  while (channelSize < requestedSize && channelSize < 0x40000000)
+    channelSize *= 2;
+
+  return channelSize;
+}
+
+#ifdef Y_SUBPROCESS_SHARED_MEMORY
+
+static void SharedFutexWait(volatile uint32* pAddress, uint32 expectedValue, uint32 timeoutMilliseconds)
+{
+  // not FUTEX_PRIVATE_FLAG, the word's in memory shared with the other process
+  timespec timeout;
+  timeout.tv_sec = timeoutMilliseconds / 1000;
+  timeout.tv_nsec = (timeoutMilliseconds % 1000) * 1000000;
+  syscall(SYS_futex, pAddress, FUTEX_WAIT, expectedValue, &timeout, nullptr, 0);
+}
+
+static void SharedFutexWake(volatile uint32* pAddress)
+{
+  syscall(SYS_futex, pAddress, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+static void* CreateSharedMemory(uint32 channelSize, int* pFileDescriptor)
+{
+  // no MFD_CLOEXEC, the child inherits the descriptor across exec
+  int fd = int(syscall(SYS_memfd_create, "subprocess-channel", 0));
+  if (fd < 0)
+    return nullptr;
+
+  size_t size = GetSharedMemorySize(channelSize);
+  void* pMemory = (ftruncate(fd, off_t(size)) == 0) ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) :
+                                                       MAP_FAILED;
+  if (pMemory == MAP_FAILED)
+  {
+    close(fd);
+    return nullptr;
+  }
+
+  *pFileDescriptor = fd;
+  return pMemory;
+}
+
+#endif
+
+static void* MapSharedMemory(int fd, uint32 channelSize)
+{
+  void* pMemory = mmap(nullptr, GetSharedMemorySize(channelSize), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  return (pMemory != MAP_FAILED) ? pMemory : nullptr;
+}
+
+static void UnmapSharedMemory(void* pMemory, uint32 channelSize)
+{
+  if (pMemory != nullptr)
+    munmap(pMemory, GetSharedMemorySize(channelSize));
+}
+
+static SubprocessSharedRing* GetSharedRing(void* pMemory, bool parentToChild)
+{
+  return reinterpret_cast<SubprocessSharedRing*>(reinterpret_cast<byte*>(pMemory) +
+                                                 (parentToChild ? 0 : sizeof(SubprocessSharedRing)));
+}
+
+static byte* GetSharedRingData(void* pMemory, uint32 channelSize, bool parentToChild)
+{
+  return reinterpret_cast<byte*>(pMemory) + SHARED_MEMORY_HEADER_SIZE + (parentToChild ? 0 : channelSize);
+}
+
+static uint32 ReadSharedRing(SubprocessSharedRing* pRing, const byte* pData, uint32 channelSize, void* pBuffer,
+                             uint32 byteCount)
+{
+  uint32 readPosition = Y_AtomicLoad(pRing->ReadPosition, ATOMIC_MEMORY_ORDER_RELAXED);
+  uint32 available = Y_AtomicLoad(pRing->WritePosition, ATOMIC_MEMORY_ORDER_ACQUIRE) - readPosition;
+  uint32 count = Min(available, byteCount);
+  if (count == 0)
+    return 0;
+
+  // in up to two pieces, when the range wraps
+  uint32 offset = readPosition & (channelSize - 1);
+  uint32 firstCount = Min(count, channelSize - offset);
+  memcpy(pBuffer, pData + offset, firstCount);
+  memcpy(reinterpret_cast<byte*>(pBuffer) + firstCount, pData, count - firstCount);
+
+  // the position is stored before the flag's read, and the writer flags itself before reading the position
+  Y_AtomicStore(pRing->ReadPosition, readPosition + count);
+#ifdef Y_SUBPROCESS_SHARED_MEMORY
+  if (Y_AtomicLoad(pRing->WriterWaiting) != 0)
+    SharedFutexWake(&pRing->ReadPosition);
+#endif
+
+  return count;
+}
+
+static uint32 WriteSharedRing(SubprocessSharedRing* pRing, byte* pData, uint32 channelSize, const void* pBuffer,
+                              uint32 byteCount)
+{
+  uint32 writePosition = Y_AtomicLoad(pRing->WritePosition, ATOMIC_MEMORY_ORDER_RELAXED);
+  uint32 space = channelSize - (writePosition - Y_AtomicLoad(pRing->ReadPosition, ATOMIC_MEMORY_ORDER_ACQUIRE));
+  uint32 count = Min(space, byteCount);
+  if (count == 0)
+    return 0;
+
+  uint32 offset = writePosition & (channelSize - 1);
+  uint32 firstCount = Min(count, channelSize - offset);
+  memcpy(pData + offset, pBuffer, firstCount);
+  memcpy(pData, reinterpret_cast<const byte*>(pBuffer) + firstCount, count - firstCount);
+
+  Y_AtomicStore(pRing->WritePosition, writePosition + count);
+#ifdef Y_SUBPROCESS_SHARED_MEMORY
+  if (Y_AtomicLoad(pRing->ReaderWaiting) != 0)
+    SharedFutexWake(&pRing->WritePosition);
+#endif
+
+  return count;
+}
+
+// Sleeps until the word at pPosition moves from position, or the timeout passes. Returns false if it didn't move.
+static bool WaitForSharedRing(volatile uint32* pPosition, volatile uint32* pWaitingFlag, uint32 position,
+                              uint32 timeoutMilliseconds)
+{
+  if (Y_AtomicLoad(*pPosition, ATOMIC_MEMORY_ORDER_ACQUIRE) != position)
+    return true;
+
+#ifdef Y_SUBPROCESS_SHARED_MEMORY
+  Y_AtomicStore(*pWaitingFlag, uint32(1));
+  if (Y_AtomicLoad(*pPosition) == position)
+    SharedFutexWait(pPosition, position, timeoutMilliseconds);
+  Y_AtomicStore(*pWaitingFlag, uint32(0));
+#endif
+
+  return (Y_AtomicLoad(*pPosition, ATOMIC_MEMORY_ORDER_ACQUIRE) != position);
+}
+
 // SIGPIPE blocker
 class SIGPIPEBlocker
 {
@@ -62,20 +243,78 @@ static bool ReadEnvironmentVariableHandle(const char* key, int* dest)
   return true;
 }
 
-static void SetEnvironmentVariable(const char* key, const char* value)
+// The environment a child is spawned with, this process's own less any channel variables it was given, plus the
+// child's. The inherited part is gathered once and reused for every child of a batch.
+class SubprocessEnvironment
 {
-  setenv(key, value, 1);
-}
+public:
+  SubprocessEnvironment()
+  {
+    for (char** ppVariable = environ; *ppVariable != nullptr; ppVariable++)
+    {
+      if (Y_strncmp(*ppVariable, COMM_ENV_VAR_PREFIX, Y_strlen(COMM_ENV_VAR_PREFIX)) != 0)
+        m_variables.Add(*ppVariable);
+    }
+
+    m_inheritedCount = m_variables.GetSize();
+  }
+
+  ~SubprocessEnvironment() { Reset(); }
+
+  void Set(const char* key, const char* value)
+  {
+    SmallString variable;
+    variable.Format("%s=%s", key, value);
+    m_variables.Add(Y_strdup(variable));
+  }
+
+  void SetHandle(const char* key, int handle)
+  {
+    TinyString value;
+    value.Format("%d", handle);
+    Set(key, value);
+  }
+
+  // drops the variables set for the previous child
+  void Reset()
+  {
+    for (uint32 i = m_inheritedCount; i < m_variables.GetSize(); i++)
+      Y_free(m_variables[i]);
+    m_variables.Resize(m_inheritedCount);
+  }
+
+  // null terminates the list, once per child
+  char* const* GetVariables()
+  {
+    m_variables.Add(nullptr);
+    return m_variables.GetBasePointer();
+  }
+
+private:
+  PODArray<char*> m_variables;
+  uint32 m_inheritedCount;
+};
 
-static void SetEnvironmentVariableHandle(const char* key, int handle)
+static pid_t SpawnChild(const char* executableFileName, SubprocessEnvironment* pEnvironment)
 {
-  TinyString str;
-  str.Format("%d", handle);
-  setenv(key, str, 1);
+  // posix_spawn doesn't copy the page tables the way fork does, which gets slow when this process is large
+  char* const arguments[] = {const_cast<char*>(executableFileName), nullptr};
+  pid_t childProcessID;
+  int res = posix_spawn(&childProcessID, executableFileName, nullptr, nullptr, arguments, pEnvironment->GetVariables());
+  if (res != 0)
+  {
+    Log_ErrorPrintf("Subprocess::Create: posix_spawn(%s) failed: %d (%s)", executableFileName, res, strerror(res));
+    return -1;
+  }
+
+  Log_InfoPrintf("SubProcess::Create: Spawned process %u.", childProcessID);
+  return childProcessID;
 }
 
-Subprocess::Subprocess(pid_t childProcessID, int readPipe, int writePipe)
-  : m_childProcessID(childProcessID), m_readPipe(readPipe), m_writePipe(writePipe), m_pChildConnection(nullptr)
+Subprocess::Subprocess(pid_t childProcessID, int readPipe, int writePipe, void* pSharedMemory,
+                       uint32 sharedMemoryChannelSize)
+  : m_childProcessID(childProcessID), m_readPipe(readPipe), m_writePipe(writePipe), m_pSharedMemory(pSharedMemory),
+    m_sharedMemoryChannelSize(sharedMemoryChannelSize), m_pChildConnection(nullptr)
 {
 }
 
@@ -95,6 +334,7 @@ Subprocess::~Subprocess()
       close(m_writePipe);
     if (m_readPipe >= 0)
       close(m_readPipe);
+    UnmapSharedMemory(m_pSharedMemory, m_sharedMemoryChannelSize);
   }
 }
 
@@ -118,100 +358,123 @@ bool Subprocess::GetParameters(String* pDestination)
 
 Subprocess* Subprocess::Create(const char* executableFileName, const char* parameters /* = NULL */,
                                bool openChannel /* = true */, bool newConsole /* = true */,
-                               bool terminateOnParentLost /* = true */)
+                               bool terminateOnParentLost /* = true */,
+                               uint32 sharedMemoryChannelSize /* = DefaultSharedMemoryChannelSize */)
 {
-  // Creating with a communication channel?
-  if (openChannel)
+  Subprocess* pSubprocess;
+  if (CreateMultiple(&pSubprocess, 1, executableFileName, parameters, openChannel, newConsole, terminateOnParentLost,
+                     sharedMemoryChannelSize) == 0)
   {
-    // Create event and pipes in parent process. These are labelled in regards to the parent's view, ie read -
-    // child-parent, write - parent-child
-    // TODO: error check here
-    int readPipeFDs[2], writePipeFDs[2];
-    pipe(readPipeFDs);
-    pipe(writePipeFDs);
+    return nullptr;
+  }
 
-    // Get ends of pipe
-    int readPipeReadEnd = readPipeFDs[0];
-    int readPipeWriteEnd = readPipeFDs[1];
-    int writePipeReadEnd = writePipeFDs[0];
-    int writePipeWriteEnd = writePipeFDs[1];
+  return pSubprocess;
+}
 
-    /*
-    if (hQuitEvent == NULL || !hasReadPipe || !hasWritePipe)
-    {
-        Log_ErrorPrint("Subprocess::Create: Failed to create one or more IPC objects.");
-        return nullptr;
-    }
-    */
+uint32 Subprocess::CreateMultiple(Subprocess** ppSubprocesses, uint32 count, const char* executableFileName,
+                                  const char* parameters /* = NULL */, bool openChannel /* = true */,
+                                  bool newConsole /* = true */, bool terminateOnParentLost /* = true */,
+                                  uint32 sharedMemoryChannelSize /* = DefaultSharedMemoryChannelSize */)
+{
+  SubprocessEnvironment environment;
 
-    // Fork the process.
-    pid_t childProcessID = fork();
-    if (childProcessID < 0)
+  // Creating without communication channel, just spawn
+  if (!openChannel)
+  {
+    uint32 createdCount = 0;
+    for (; createdCount < count; createdCount++)
     {
-      // todo: cleanup pipes
-      Log_ErrorPrint("Subprocess::Create: Fork failed");
-      return nullptr;
+      pid_t childProcessID = SpawnChild(executableFileName, &environment);
+      if (childProcessID < 0)
+        break;
+
+      ppSubprocesses[createdCount] = new Subprocess(childProcessID, -1, -1, nullptr, 0);
     }
 
-    // Child end?
-    if (childProcessID == 0)
-    {
-      // Close the unused ends of the pipe
-      close(readPipeReadEnd);
-      close(writePipeWriteEnd);
+    return createdCount;
+  }
 
-      // Set the environment variables
-      SetEnvironmentVariableHandle(COMM_ENV_VAR_PARENT_PROCESS_ID, getppid());
-      if (parameters != NULL)
-        SetEnvironmentVariable(COMM_ENV_VAR_PARAMETERS, parameters);
+#ifdef Y_SUBPROCESS_SHARED_MEMORY
+  if (sharedMemoryChannelSize > 0)
+    sharedMemoryChannelSize = GetSharedMemoryChannelSize(sharedMemoryChannelSize);
+#endif
 
-      // Read pipe write end
-      SetEnvironmentVariableHandle(COMM_ENV_VAR_READ_PIPE_HANDLE, writePipeReadEnd);
+  uint32 createdCount = 0;
+  for (; createdCount < count; createdCount++)
+  {
+    // Create pipes in parent process. These are labelled in regards to the parent's view, ie read - child-parent,
+    // write - parent-child
+    int readPipeFDs[2], writePipeFDs[2];
+    if (pipe(readPipeFDs) != 0)
+    {
+      Log_ErrorPrintf("Subprocess::Create: Failed to create pipe, errno = %d", errno);
+      break;
+    }
+    if (pipe(writePipeFDs) != 0)
+    {
+      Log_ErrorPrintf("Subprocess::Create: Failed to create pipe, errno = %d", errno);
+      close(readPipeFDs[0]);
+      close(readPipeFDs[1]);
+      break;
+    }
 
-      // Read pipe write end
-      SetEnvironmentVariableHandle(COMM_ENV_VAR_WRITE_PIPE_HANDLE, readPipeWriteEnd);
+    // Get ends of pipe
+    int readPipeReadEnd = readPipeFDs[0];
+    int readPipeWriteEnd = readPipeFDs[1];
+    int writePipeReadEnd = writePipeFDs[0];
+    int writePipeWriteEnd = writePipeFDs[1];
 
-      // Terminate on parent lost
-      SetEnvironmentVariable(COMM_ENV_VAR_TERMINATE_ON_PARENT_LOST, terminateOnParentLost ? "1" : "0");
+    // Our ends stay out of every child, including the later ones of the batch, so a child exiting closes its pipe.
+    fcntl(readPipeReadEnd, F_SETFD, FD_CLOEXEC);
+    fcntl(writePipeWriteEnd, F_SETFD, FD_CLOEXEC);
 
-      // Execute the child process, if successful, this won't return
-      int res = execl(executableFileName, executableFileName, NULL);
-      Log_ErrorPrintf("Subprocess::Create: exec(%s) failed: %d", executableFileName, res);
-      _exit(-1);
-    }
-    else
+    // Create the shared memory for the channel, the child inherits the descriptor and maps it when connecting.
+    void* pSharedMemory = nullptr;
+    int sharedMemoryFD = -1;
+#ifdef Y_SUBPROCESS_SHARED_MEMORY
+    if (sharedMemoryChannelSize > 0)
     {
-      // Close the unused ends of the pipe
-      close(readPipeWriteEnd);
-      close(writePipeReadEnd);
-
-      // Construct subprocess object
-      Log_InfoPrintf("SubProcess::Create: Spawned process %u.", childProcessID);
-      return new Subprocess(childProcessID, readPipeReadEnd, writePipeWriteEnd);
+      pSharedMemory = CreateSharedMemory(sharedMemoryChannelSize, &sharedMemoryFD);
+      if (pSharedMemory == nullptr)
+        Log_WarningPrintf("Subprocess::Create: Failed to create shared memory, errno = %d. Using pipes.", errno);
     }
-  }
-  else
-  {
-    // Creating without communication channel, fork and exec
-    int res = fork();
-    if (res < 0)
+#endif
+
+    // The child finds its ends of the pipes and its parent through the environment
+    environment.Reset();
+    environment.SetHandle(COMM_ENV_VAR_PARENT_PROCESS_ID, getpid());
+    if (parameters != NULL)
+      environment.Set(COMM_ENV_VAR_PARAMETERS, parameters);
+    environment.SetHandle(COMM_ENV_VAR_READ_PIPE_HANDLE, writePipeReadEnd);
+    environment.SetHandle(COMM_ENV_VAR_WRITE_PIPE_HANDLE, readPipeWriteEnd);
+    environment.Set(COMM_ENV_VAR_TERMINATE_ON_PARENT_LOST, terminateOnParentLost ? "1" : "0");
+    if (sharedMemoryFD >= 0)
     {
-      Log_ErrorPrint("Subprocess::Create: vfork failed.");
-      return nullptr;
+      environment.SetHandle(COMM_ENV_VAR_SHARED_MEMORY_HANDLE, sharedMemoryFD);
+      environment.SetHandle(COMM_ENV_VAR_SHARED_MEMORY_SIZE, int(sharedMemoryChannelSize));
     }
 
-    if (res == 0)
+    pid_t childProcessID = SpawnChild(executableFileName, &environment);
+
+    // Close the child's ends of the pipe, the mapping outlives the shared memory descriptor
+    close(readPipeWriteEnd);
+    close(writePipeReadEnd);
+    if (sharedMemoryFD >= 0)
+      close(sharedMemoryFD);
+
+    if (childProcessID < 0)
     {
-      // child
-      res = execl(executableFileName, executableFileName, NULL);
-      Log_ErrorPrintf("Subprocess::Create: exec failed: %d", res);
-      _exit(-1);
+      close(readPipeReadEnd);
+      close(writePipeWriteEnd);
+      UnmapSharedMemory(pSharedMemory, sharedMemoryChannelSize);
+      break;
     }
 
-    // parent
-    Log_InfoPrintf("SubProcess::Create: Spawned process %u.", res);
-    return new Subprocess(res, -1, -1);
+    ppSubprocesses[createdCount] = new Subprocess(childProcessID, readPipeReadEnd, writePipeWriteEnd, pSharedMemory,
+                                                  (pSharedMemory != nullptr) ? sharedMemoryChannelSize : 0);
   }
+
+  return createdCount;
 }
 
 Subprocess::Connection* Subprocess::ConnectToChild(int32 connectionTimeout /*= -1*/)
@@ -227,10 +490,11 @@ Subprocess::Connection* Subprocess::ConnectToChild(int32 connectionTimeout /*= -
   if (m_pChildConnection != nullptr)
     return m_pChildConnection;
 
-  // Send the ready message to the child
+  // Send the ready message to the child, offering the shared memory if there is any
   Log_DevPrintf("Subprocess::ConnectToChild: Sending ready message...");
-  if (write(m_writePipe, &PARENT_READY_MESSAGE_VALUE, sizeof(PARENT_READY_MESSAGE_VALUE)) !=
-      sizeof(PARENT_READY_MESSAGE_VALUE))
+  const uint32 parentReadyMessage =
+    (m_pSharedMemory != nullptr) ? PARENT_READY_SHARED_MEMORY_MESSAGE_VALUE : PARENT_READY_MESSAGE_VALUE;
+  if (write(m_writePipe, &parentReadyMessage, sizeof(parentReadyMessage)) != sizeof(parentReadyMessage))
   {
     Log_ErrorPrintf("Subprocess::ConnectToChild: Failed to write parent ready message to pipe. errno = %d", errno);
     return nullptr;
@@ -240,15 +504,27 @@ Subprocess::Connection* Subprocess::ConnectToChild(int32 connectionTimeout /*= -
   Log_DevPrintf("Subprocess::ConnectToChild: Waiting for client response...");
   uint32 readyMessage;
   if (read(m_readPipe, &readyMessage, sizeof(readyMessage)) != sizeof(readyMessage) ||
-      readyMessage != CHILD_READY_MESSAGE_VALUE)
+      (readyMessage != CHILD_READY_MESSAGE_VALUE && readyMessage != CHILD_READY_SHARED_MEMORY_MESSAGE_VALUE))
   {
     Log_ErrorPrintf("Subprocess::ConnectToChild: Failed to read child ready message from pipe. errno = %d", errno);
     return nullptr;
   }
 
-  // Create connection object
-  Log_InfoPrintf("Subprocess::ConnectToChild: Connected with child process %u", m_childProcessID);
-  m_pChildConnection = new Connection(m_childProcessID, m_readPipe, m_writePipe, false, false);
+  // The child may have turned the shared memory down
+  if (readyMessage != CHILD_READY_SHARED_MEMORY_MESSAGE_VALUE && m_pSharedMemory != nullptr)
+  {
+    Log_WarningPrintf("Subprocess::ConnectToChild: Child couldn't map shared memory, using pipes.");
+    UnmapSharedMemory(m_pSharedMemory, m_sharedMemoryChannelSize);
+    m_pSharedMemory = nullptr;
+    m_sharedMemoryChannelSize = 0;
+  }
+
+  // Create connection object, which takes the shared memory
+  Log_InfoPrintf("Subprocess::ConnectToChild: Connected with child process %u%s", m_childProcessID,
+                 (m_pSharedMemory != nullptr) ? " over shared memory" : "");
+  m_pChildConnection = new Connection(m_childProcessID, m_readPipe, m_writePipe, false, false, m_pSharedMemory,
+                                      m_sharedMemoryChannelSize);
+  m_pSharedMemory = nullptr;
   return m_pChildConnection;
 }
 
@@ -278,27 +554,63 @@ Subprocess::Connection* Subprocess::ConnectToParent(int32 connectionTimeout /*=
   // Read terminate on lost string
   bool terminateOnParentLost = StringConverter::StringToBool(environmentVariableValue);
 
+  // The shared memory descriptor is only needed long enough to map it.
+  int sharedMemoryFD = -1;
+  int sharedMemoryChannelSize = 0;
+  if (ReadEnvironmentVariableHandle(COMM_ENV_VAR_SHARED_MEMORY_HANDLE, &sharedMemoryFD) &&
+      !ReadEnvironmentVariableHandle(COMM_ENV_VAR_SHARED_MEMORY_SIZE, &sharedMemoryChannelSize))
+  {
+    close(sharedMemoryFD);
+    sharedMemoryFD = -1;
+  }
+
   // Wait for the parent ready message.
   uint32 readyMessage;
   Log_DevPrintf("Subprocess::ConnectToParent: Waiting for parent message...");
   if (read(readPipe, &readyMessage, sizeof(readyMessage)) != sizeof(readyMessage) ||
-      readyMessage != PARENT_READY_MESSAGE_VALUE)
+      (readyMessage != PARENT_READY_MESSAGE_VALUE && readyMessage != PARENT_READY_SHARED_MEMORY_MESSAGE_VALUE))
   {
     Log_ErrorPrint("Subprocess::ConnectToParent: Failed to read child ready message from pipe.");
+    if (sharedMemoryFD >= 0)
+      close(sharedMemoryFD);
     return nullptr;
   }
 
+  // Map the shared memory if it was offered.
+  void* pSharedMemory = nullptr;
+  if (sharedMemoryFD >= 0)
+  {
+    if (readyMessage == PARENT_READY_SHARED_MEMORY_MESSAGE_VALUE)
+    {
+      pSharedMemory = MapSharedMemory(sharedMemoryFD, uint32(sharedMemoryChannelSize));
+      if (pSharedMemory == nullptr)
+        Log_WarningPrintf("Subprocess::ConnectToParent: Failed to map shared memory, errno = %d. Using pipes.", errno);
+    }
+
+    close(sharedMemoryFD);
+  }
+
   // Send the client ready message.
   Log_DevPrintf("Subprocess::ConnectToParent: Sending ready message...");
-  if (write(writePipe, &CHILD_READY_MESSAGE_VALUE, sizeof(CHILD_READY_MESSAGE_VALUE)) !=
-      sizeof(CHILD_READY_MESSAGE_VALUE))
+  const uint32 childReadyMessage =
+    (pSharedMemory != nullptr) ? CHILD_READY_SHARED_MEMORY_MESSAGE_VALUE : CHILD_READY_MESSAGE_VALUE;
+  if (write(writePipe, &childReadyMessage, sizeof(childReadyMessage)) != sizeof(childReadyMessage))
   {
     Log_ErrorPrint("Subprocess::ConnectToParent: Failed to write parent ready message to pipe.");
+    UnmapSharedMemory(pSharedMemory, uint32(sharedMemoryChannelSize));
     return nullptr;
   }
 
   // Create connection object.
-  return new Connection(parentProcessID, readPipe, writePipe, true, terminateOnParentLost);
+  return new Connection(parentProcessID, readPipe, writePipe, true, terminateOnParentLost, pSharedMemory,
+                        (pSharedMemory != nullptr) ? uint32(sharedMemoryChannelSize) : 0);
+}
+
+bool Subprocess::IsChildAlive()
+{
+  // this reaps the child once it has exited, the same as the connection's check
+  int status;
+  return (waitpid(m_childProcessID, &status, WNOHANG) == 0);
 }
 
 void Subprocess::RequestChildToExit()
@@ -321,18 +633,37 @@ void Subprocess::TerminateChild()
 }
 
 Subprocess::Connection::Connection(pid_t targetProcess, int readPipe, int writePipe, bool isParentConnection,
-                                   bool terminateOnParentLost)
+                                   bool terminateOnParentLost, void* pSharedMemory /* = nullptr */,
+                                   uint32 sharedMemoryChannelSize /* = 0 */)
   : m_targetProcess(targetProcess), m_readPipe(readPipe), m_writePipe(writePipe),
-    m_isParentConnection(isParentConnection), m_terminateOnParentLost(terminateOnParentLost)
+    m_isParentConnection(isParentConnection), m_terminateOnParentLost(terminateOnParentLost),
+    m_pSharedMemory(pSharedMemory), m_sharedMemoryChannelSize(sharedMemoryChannelSize), m_pSendRing(nullptr),
+    m_pReceiveRing(nullptr)
 {
+  // the parent sends on the first ring, the child on the second
+  if (m_pSharedMemory != nullptr)
+  {
+    m_pSendRing = GetSharedRing(m_pSharedMemory, !isParentConnection);
+    m_pReceiveRing = GetSharedRing(m_pSharedMemory, isParentConnection);
+  }
 }
 
 Subprocess::Connection::~Connection()
 {
+  UnmapSharedMemory(m_pSharedMemory, m_sharedMemoryChannelSize);
   close(m_readPipe);
   close(m_writePipe);
 }
 
+uint32 Subprocess::Connection::OnOtherSideLost()
+{
+  Log_ErrorPrintf("Subprocess::Connection: Process %u is gone.", m_targetProcess);
+  if (m_terminateOnParentLost)
+    abort();
+
+  return 0;
+}
+
 bool Subprocess::Connection::IsOtherSideAlive()
 {
   if (m_isParentConnection)
@@ -364,6 +695,30 @@ bool Subprocess::Connection::IsExitRequested()
 
 bool Subprocess::Connection::WaitForData(int32 timeout /*= -1*/)
 {
+  if (m_pReceiveRing != nullptr)
+  {
+    // sleep in slices, so a dead process is noticed
+    Y_TIMER_VALUE startTime = Y_TimerGetValue();
+    uint32 readPosition = Y_AtomicLoad(m_pReceiveRing->ReadPosition, ATOMIC_MEMORY_ORDER_RELAXED);
+    for (;;)
+    {
+      uint32 sliceTime = SHARED_MEMORY_LIVENESS_INTERVAL;
+      if (timeout >= 0)
+      {
+        double elapsedTime = Y_TimerConvertToMilliseconds(Y_TimerGetValue() - startTime);
+        if (elapsedTime >= double(timeout))
+          sliceTime = 0;
+        else
+          sliceTime = Min(sliceTime, uint32(double(timeout) - elapsedTime) + 1);
+      }
+
+      if (WaitForSharedRing(&m_pReceiveRing->WritePosition, &m_pReceiveRing->ReaderWaiting, readPosition, sliceTime))
+        return true;
+      if (sliceTime == 0 || !IsOtherSideAlive())
+        return false;
+    }
+  }
+
   pollfd fd;
   fd.fd = m_readPipe;
   fd.events = POLLIN;
@@ -373,6 +728,12 @@ bool Subprocess::Connection::WaitForData(int32 timeout /*= -1*/)
 
 uint32 Subprocess::Connection::ReadDataNonBlocking(void* pBuffer, uint32 byteCount)
 {
+  if (m_pReceiveRing != nullptr)
+  {
+    const byte* pData = GetSharedRingData(m_pSharedMemory, m_sharedMemoryChannelSize, m_isParentConnection);
+    return ReadSharedRing(m_pReceiveRing, pData, m_sharedMemoryChannelSize, pBuffer, byteCount);
+  }
+
   pollfd fd;
   fd.fd = m_readPipe;
   fd.events = POLLIN;
@@ -408,6 +769,26 @@ uint32 Subprocess::Connection::ReadDataNonBlocking(void* pBuffer, uint32 byteCou
 
 uint32 Subprocess::Connection::ReadDataBlocking(void* pBuffer, uint32 byteCount)
 {
+  if (m_pReceiveRing != nullptr)
+  {
+    // like the pipe, returns as soon as there's anything to read
+    const byte* pData = GetSharedRingData(m_pSharedMemory, m_sharedMemoryChannelSize, m_isParentConnection);
+    for (;;)
+    {
+      uint32 readPosition = Y_AtomicLoad(m_pReceiveRing->ReadPosition, ATOMIC_MEMORY_ORDER_RELAXED);
+      uint32 count = ReadSharedRing(m_pReceiveRing, pData, m_sharedMemoryChannelSize, pBuffer, byteCount);
+      if (count > 0 || byteCount == 0)
+        return count;
+
+      if (!WaitForSharedRing(&m_pReceiveRing->WritePosition, &m_pReceiveRing->ReaderWaiting, readPosition,
+                             SHARED_MEMORY_LIVENESS_INTERVAL) &&
+          !IsOtherSideAlive())
+      {
+        return OnOtherSideLost();
+      }
+    }
+  }
+
   SIGPIPEBlocker blocker;
   int res = read(m_readPipe, pBuffer, byteCount);
   if (res < 0)
@@ -424,6 +805,32 @@ uint32 Subprocess::Connection::ReadDataBlocking(void* pBuffer, uint32 byteCount)
 
 uint32 Subprocess::Connection::WriteData(const void* pBuffer, uint32 byteCount)
 {
+  if (m_pSendRing != nullptr)
+  {
+    // like the pipe, blocks until everything's been written
+    byte* pData = GetSharedRingData(m_pSharedMemory, m_sharedMemoryChannelSize, !m_isParentConnection);
+    uint32 written = 0;
+    while (written < byteCount)
+    {
+      uint32 readPosition = Y_AtomicLoad(m_pSendRing->ReadPosition, ATOMIC_MEMORY_ORDER_ACQUIRE);
+      uint32 count = WriteSharedRing(m_pSendRing, pData, m_sharedMemoryChannelSize,
+                                     reinterpret_cast<const byte*>(pBuffer) + written, byteCount - written);
+      written += count;
+      if (count > 0)
+        continue;
+
+      if (!WaitForSharedRing(&m_pSendRing->ReadPosition, &m_pSendRing->WriterWaiting, readPosition,
+                             SHARED_MEMORY_LIVENESS_INTERVAL) &&
+          !IsOtherSideAlive())
+      {
+        OnOtherSideLost();
+        break;
+      }
+    }
+
+    return written;
+  }
+
   SIGPIPEBlocker blocker;
   int res = write(m_writePipe, pBuffer, byteCount);
   if (res < 0)
@@ -2,12 +2,35 @@
 
 #if defined(Y_PLATFORM_POSIX)
 
+#include "YBaseLib/Allocator.h"
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Log.h"
+#include "YBaseLib/Profiler.h"
 #include "YBaseLib/POSIX/POSIXThread.h"
+#include "YBaseLib/ThreadCachedHeap.h"
+#include "YBaseLib/ThreadLocal.h"
+#include <sched.h>
 #include <unistd.h>
 // Log_SetChannel(Thread);
 
+static bool SetPThreadAffinityMask(pthread_t thread, uint64 mask)
+{
+#if defined(Y_PLATFORM_LINUX)
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  for (uint32 i = 0; i < 64; i++)
+  {
+    if (mask & ((uint64)1 << i))
+      CPU_SET(i, &cpuSet);
+  }
+
+  return (pthread_setaffinity_np(thread, sizeof(cpuSet), &cpuSet) == 0);
+#else
+  // OSX only has affinity hints, not binding
+  return false;
+#endif
+}
+
 Thread::Thread() : m_threadHandle(0), m_bRunning(false) {}
 
 Thread::~Thread()
@@ -72,7 +95,16 @@ int32 Thread::Join()
   return *(int32*)&threadExitCode;
 }
 
-void Thread::SetDebugName(const char* threadName) {}
+bool Thread::SetAffinityMask(uint64 mask)
+{
+  Assert(m_threadHandle != 0);
+  return SetPThreadAffinityMask(m_threadHandle, mask);
+}
+
+void Thread::SetDebugName(const char* threadName)
+{
+  Profiler::SetThreadName(threadName);
+}
 
 void* Thread::__ThreadStart(void* pArguments)
 {
@@ -83,6 +115,12 @@ void* Thread::__ThreadStart(void* pArguments)
   // run the thread
   int threadExitCode = pThread->ThreadEntryPoint();
 
+  // free anything the thread left behind
+  ThreadLocalBase::ReleaseCurrentThreadValues();
+  ThreadCachedHeap::ReleaseThreadCache();
+  Log::ReleaseThreadBuffer();
+  Profiler::ReleaseThreadBuffer();
+
   // unset running flag
   pThread->m_bRunning = false;
   MemoryBarrier();
@@ -114,4 +152,9 @@ void Thread::Sleep(uint32 millisecondsToSleep)
   usleep(millisecondsToSleep * 1000);
 }
 
+bool Thread::SetCurrentThreadAffinityMask(uint64 mask)
+{
+  return SetPThreadAffinityMask(pthread_self(), mask);
+}
+
 #endif
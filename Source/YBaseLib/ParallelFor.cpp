@@ -0,0 +1,201 @@
+#include "YBaseLib/ParallelFor.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/LightweightSemaphore.h"
+
+// Range owned by one participant, padded so neighbouring slots don't share a cache line.
+// Begin/End are only written with the lock held, other threads may read them unlocked to pick a victim.
+struct ParallelForSlot
+{
+  Y_ATOMIC_DECL uint32 Lock;
+  volatile uint32 Begin;
+  volatile uint32 End;
+  byte Padding[64 - sizeof(uint32) * 3];
+
+  void Acquire()
+  {
+    while (Y_AtomicCompareExchange(Lock, (uint32)1, (uint32)0) != 0)
+    {
+      while (Lock != 0)
+        Thread::Yield();
+    }
+  }
+
+  void Release()
+  {
+    MemoryBarrier();
+    Lock = 0;
+  }
+};
+
+// Shared state for one dispatch. Each helper's work item holds a reference, so it is also what keeps the slots alive
+// for helpers that only start after the caller has returned.
+class ParallelForJob : public ReferenceCounted
+{
+public:
+  ParallelForJob(uint32 participantCount, uint32 begin, uint32 end, uint32 grainSize,
+                 ParallelForScheduler::RangeCallback callback, void* pUserData)
+    : m_pSlots(new ParallelForSlot[participantCount]), m_participantCount(participantCount), m_grainSize(grainSize),
+      m_callback(callback), m_pUserData(pUserData), m_nextParticipantIndex(0), m_remainingCount(end - begin)
+  {
+    // even split to start with, stealing evens out the rest
+    uint64 count = end - begin;
+    for (uint32 i = 0; i < participantCount; i++)
+    {
+      m_pSlots[i].Lock = 0;
+      m_pSlots[i].Begin = begin + static_cast<uint32>(count * i / participantCount);
+      m_pSlots[i].End = begin + static_cast<uint32>(count * (i + 1) / participantCount);
+    }
+  }
+
+  ~ParallelForJob() { delete[] m_pSlots; }
+
+  // blocks until every index has been processed
+  void WaitForFinish() { m_finishedSemaphore.Wait(); }
+
+  void Participate(uint32 participantIndex)
+  {
+    for (;;)
+    {
+      uint32 rangeBegin, rangeEnd;
+      while (TakeChunk(participantIndex, &rangeBegin, &rangeEnd))
+      {
+        m_callback(m_pUserData, participantIndex, rangeBegin, rangeEnd);
+        FinishIndices(rangeEnd - rangeBegin);
+      }
+
+      if (!StealRange(participantIndex))
+        break;
+    }
+  }
+
+  void RunHelper()
+  {
+    // the calling thread is participant zero
+    uint32 participantIndex = Y_AtomicIncrement(m_nextParticipantIndex);
+    DebugAssert(participantIndex < m_participantCount);
+    Participate(participantIndex);
+  }
+
+private:
+  bool TakeChunk(uint32 participantIndex, uint32* pRangeBegin, uint32* pRangeEnd)
+  {
+    ParallelForSlot& slot = m_pSlots[participantIndex];
+    slot.Acquire();
+
+    uint32 remaining = slot.End - slot.Begin;
+    if (remaining == 0)
+    {
+      slot.Release();
+      return false;
+    }
+
+    *pRangeBegin = slot.Begin;
+    *pRangeEnd = slot.Begin + Min(remaining, m_grainSize);
+    slot.Begin = *pRangeEnd;
+    slot.Release();
+    return true;
+  }
+
+  // moves part of the largest other slot into ours, returns false if there is nothing left to take
+  bool StealRange(uint32 participantIndex)
+  {
+    for (;;)
+    {
+      uint32 victimIndex = participantIndex;
+      uint32 victimRemaining = 0;
+      for (uint32 i = 0; i < m_participantCount; i++)
+      {
+        // unlocked read, the two fields can be from different updates
+        int32 remaining = static_cast<int32>(m_pSlots[i].End - m_pSlots[i].Begin);
+        if (i != participantIndex && remaining > static_cast<int32>(victimRemaining))
+        {
+          victimIndex = i;
+          victimRemaining = static_cast<uint32>(remaining);
+        }
+      }
+
+      if (victimIndex == participantIndex)
+        return false;
+
+      // take the back half, or everything if it is no more than a chunk. the owner may not have started yet.
+      ParallelForSlot& victim = m_pSlots[victimIndex];
+      victim.Acquire();
+
+      uint32 remaining = victim.End - victim.Begin;
+      if (remaining == 0)
+      {
+        victim.Release();
+        continue;
+      }
+
+      uint32 stolenEnd = victim.End;
+      uint32 stolenBegin = (remaining > m_grainSize) ? (victim.Begin + remaining / 2) : victim.Begin;
+      victim.End = stolenBegin;
+      victim.Release();
+
+      ParallelForSlot& slot = m_pSlots[participantIndex];
+      slot.Acquire();
+      DebugAssert(slot.Begin == slot.End);
+      slot.Begin = stolenBegin;
+      slot.End = stolenEnd;
+      slot.Release();
+      return true;
+    }
+  }
+
+  void FinishIndices(uint32 count)
+  {
+    // whoever finishes the last chunk lets the caller go, the post is free unless the caller is already asleep
+    DebugAssert(m_remainingCount >= count);
+    if (Y_AtomicAdd(m_remainingCount, 0u - count) == 0)
+      m_finishedSemaphore.Post();
+  }
+
+  ParallelForSlot* m_pSlots;
+  uint32 m_participantCount;
+  uint32 m_grainSize;
+  ParallelForScheduler::RangeCallback m_callback;
+  void* m_pUserData;
+
+  Y_ATOMIC_DECL uint32 m_nextParticipantIndex;
+  Y_ATOMIC_DECL uint32 m_remainingCount;
+  LightweightSemaphore m_finishedSemaphore;
+};
+
+uint32 ParallelForScheduler::GetParticipantCount(ThreadPool* pThreadPool, uint32 begin, uint32 end, uint32 grainSize)
+{
+  if (pThreadPool == nullptr || end <= begin)
+    return 1;
+
+  // no point waking more threads than there are chunks
+  grainSize = Max(grainSize, (uint32)1);
+  uint32 chunkCount = (end - begin - 1) / grainSize + 1;
+  return Min(pThreadPool->GetWorkerThreadCount() + 1, chunkCount);
+}
+
+void ParallelForScheduler::Execute(ThreadPool* pThreadPool, uint32 participantCount, uint32 begin, uint32 end,
+                                   uint32 grainSize, RangeCallback callback, void* pUserData)
+{
+  DebugAssert(participantCount > 0 && begin <= end);
+  if (begin == end)
+    return;
+
+  if (participantCount == 1)
+  {
+    callback(pUserData, 0, begin, end);
+    return;
+  }
+
+  ParallelForJob* pJob =
+    new ParallelForJob(participantCount, begin, end, Max(grainSize, (uint32)1), callback, pUserData);
+  for (uint32 i = 1; i < participantCount; i++)
+    ThreadPoolHelperWorkItem<ParallelForJob>::Enqueue(pThreadPool, pJob);
+
+  pJob->Participate(0);
+
+  // anything left is a chunk another participant is already running, and taking the semaphore's count makes
+  // the participants' writes visible to the caller
+  pJob->WaitForFinish();
+  pJob->Release();
+}
@@ -0,0 +1,108 @@
+#include "YBaseLib/ParallelProgress.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/NumericLimits.h"
+#include "YBaseLib/ProgressCallbacks.h"
+
+// value * numerator / denominator, without overflowing when the product doesn't fit
+static uint64 ScaleValue(uint64 value, uint64 numerator, uint64 denominator)
+{
+  if (value == 0 || numerator <= Y_UINT64_MAX / value)
+    return value * numerator / denominator;
+
+  return static_cast<uint64>(static_cast<double>(value) * static_cast<double>(numerator) /
+                             static_cast<double>(denominator));
+}
+
+ParallelProgress::Range::Range(Range* pParent, uint64 parentUnits, uint64 range)
+  : m_pProgress(pParent->m_pProgress), m_pParent(pParent), m_parentUnits(parentUnits), m_range(range), m_completed(0)
+{
+  DebugAssert(range > 0);
+}
+
+ParallelProgress::Range::Range(ParallelProgress* pProgress, uint64 range)
+  : m_pProgress(pProgress), m_pParent(nullptr), m_parentUnits(0), m_range(range), m_completed(0)
+{
+}
+
+uint64 ParallelProgress::Range::GetCompleted() const
+{
+  if (m_pParent == nullptr)
+    return m_pProgress->GetCompleted();
+
+  return Y_AtomicLoad(m_completed, ATOMIC_MEMORY_ORDER_RELAXED);
+}
+
+void ParallelProgress::Range::Add(uint64 units)
+{
+  if (m_pParent == nullptr)
+  {
+    m_pProgress->Add(units);
+    return;
+  }
+
+  // Each caller passes on the parent units between where the count was before its add and after it. Those spans
+  // never overlap, so whatever the order, the parent ends up with exactly its share of the count.
+  uint64 before = Y_AtomicFetchAdd(m_completed, units, ATOMIC_MEMORY_ORDER_RELAXED);
+  uint64 parentUnits = ScaleToParent(before + units) - ScaleToParent(before);
+  if (parentUnits > 0)
+    m_pParent->Add(parentUnits);
+}
+
+uint64 ParallelProgress::Range::ScaleToParent(uint64 completed) const
+{
+  return ScaleValue(Min(completed, m_range), m_parentUnits, m_range);
+}
+
+ParallelProgress::ParallelProgress(ProgressCallbacks* pCallbacks, uint64 range,
+                                   uint32 reportIntervalMilliseconds /* = 100 */)
+  : m_pCallbacks(pCallbacks), m_root(this, range),
+    m_reportedRange(static_cast<uint32>(Min(range, static_cast<uint64>(Y_UINT32_MAX)))), m_nextReportTime(0),
+    m_reporting(0), m_cancelled(0)
+{
+  DebugAssert(range > 0);
+
+  // convert the interval to ticks once, so adding only compares
+  double millisecondsPerTick = Y_FastTimerConvertToMilliseconds(1);
+  m_reportInterval = static_cast<uint64>(static_cast<double>(reportIntervalMilliseconds) / millisecondsPerTick);
+  m_nextReportTime = static_cast<uint64>(Y_FastTimerGetValue()) + m_reportInterval;
+
+  m_pCallbacks->SetProgressRange(m_reportedRange);
+  m_pCallbacks->SetProgressValue(0);
+  m_cancelled = m_pCallbacks->IsCancelled() ? 1 : 0;
+}
+
+ParallelProgress::~ParallelProgress()
+{
+  Report();
+}
+
+uint64 ParallelProgress::GetCompleted() const
+{
+  return m_completed.GetValue();
+}
+
+void ParallelProgress::Add(uint64 units)
+{
+  m_completed.Add(units);
+
+  // the deadline is only read here, so it stays shared in every adding thread's cache
+  if (static_cast<uint64>(Y_FastTimerGetValue()) >= Y_AtomicLoad(m_nextReportTime, ATOMIC_MEMORY_ORDER_RELAXED))
+    Report();
+}
+
+bool ParallelProgress::Report()
+{
+  uint32 expected = 0;
+  if (!Y_AtomicTryCompareExchange(m_reporting, expected, 1u, ATOMIC_MEMORY_ORDER_ACQUIRE))
+    return false;
+
+  Y_AtomicStore(m_nextReportTime, static_cast<uint64>(Y_FastTimerGetValue()) + m_reportInterval,
+                ATOMIC_MEMORY_ORDER_RELAXED);
+
+  uint64 completed = Min(m_completed.GetValue(), m_root.GetRange());
+  m_pCallbacks->SetProgressValue(static_cast<uint32>(ScaleValue(completed, m_reportedRange, m_root.GetRange())));
+  Y_AtomicStore(m_cancelled, m_pCallbacks->IsCancelled() ? 1u : 0u, ATOMIC_MEMORY_ORDER_RELAXED);
+
+  Y_AtomicStore(m_reporting, 0u, ATOMIC_MEMORY_ORDER_RELEASE);
+  return true;
+}
@@ -0,0 +1,328 @@
+#include "YBaseLib/Pipeline.h"
+#include "YBaseLib/ConditionVariable.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/ThreadPool.h"
+
+// One run of a pipeline. Items are identified by their slot, which they keep from the source to the sink, and put in
+// order by the sequence number the source gave them. Each helper's work item holds a reference, so it is also what
+// keeps the state alive for helpers that only start after Run has returned. Those find the run finished and leave
+// without touching the stages.
+class PipelineJob : public ReferenceCounted
+{
+public:
+  PipelineJob(Pipeline::Stage* const* ppStages, uint32 stageCount, uint32 slotCount, ThreadPool* pThreadPool,
+              const volatile bool* pCancelled)
+    : m_pStages(new StageState[stageCount]), m_stageCount(stageCount), m_slotCount(slotCount),
+      m_pSlotSequences(new uint64[slotCount]), m_pFreeSlots(new uint32[slotCount]), m_freeSlotCount(slotCount),
+      m_nextSourceSequence(0), m_sourceDone(false), m_finished(false), m_pCancelled(pCancelled),
+      m_pThreadPool(pThreadPool), m_maxHelperCount(0), m_helperCount(0), m_callerWaiting(false)
+  {
+    // no more threads than the stages can keep busy together
+    uint32 totalParallelism = 0;
+    for (uint32 i = 0; i < stageCount; i++)
+    {
+      StageState& stage = m_pStages[i];
+      stage.pStage = ppStages[i];
+      stage.Mode = stage.pStage->GetMode();
+      stage.MaxParallelism = (stage.Mode == PIPELINE_STAGE_SERIAL) ? 1 : stage.pStage->GetMaxParallelism();
+      if (stage.MaxParallelism == 0 || stage.MaxParallelism > slotCount)
+        stage.MaxParallelism = slotCount;
+      stage.RunningCount = 0;
+      stage.NextSequence = 0;
+      stage.pSequenceSlots = new uint32[slotCount];
+      stage.pFifo = new uint32[slotCount];
+      stage.FifoHead = 0;
+      stage.FifoCount = 0;
+      for (uint32 j = 0; j < slotCount; j++)
+        stage.pSequenceSlots[j] = InvalidSlot;
+
+      totalParallelism += stage.MaxParallelism;
+    }
+
+    for (uint32 i = 0; i < slotCount; i++)
+      m_pFreeSlots[i] = slotCount - i - 1;
+
+    if (pThreadPool != nullptr)
+      m_maxHelperCount = Min(pThreadPool->GetWorkerThreadCount(), totalParallelism - 1);
+  }
+
+  ~PipelineJob()
+  {
+    for (uint32 i = 0; i < m_stageCount; i++)
+    {
+      delete[] m_pStages[i].pFifo;
+      delete[] m_pStages[i].pSequenceSlots;
+    }
+
+    delete[] m_pFreeSlots;
+    delete[] m_pSlotSequences;
+    delete[] m_pStages;
+  }
+
+  // Runs stages until the pipeline is finished. Helpers go back to the pool when there's nothing for them to run,
+  // while the caller waits for more, as it has to be there at the end.
+  void Participate(bool isCaller)
+  {
+    m_lock.Lock();
+    while (!m_finished)
+    {
+      uint32 stageIndex, slot;
+      if (!TakeWork(&stageIndex, &slot))
+      {
+        if (!isCaller)
+        {
+          m_helperCount--;
+          break;
+        }
+
+        m_callerWaiting = true;
+        m_conditionVariable.SleepAndRelease(&m_lock);
+        m_callerWaiting = false;
+        continue;
+      }
+
+      m_lock.Unlock();
+      bool produced = m_pStages[stageIndex].pStage->Process(slot);
+      m_lock.Lock();
+
+      FinishWork(stageIndex, slot, produced);
+    }
+
+    m_lock.Unlock();
+  }
+
+  void RunHelper() { Participate(false); }
+
+private:
+  static const uint32 InvalidSlot = 0xFFFFFFFFu;
+
+  struct StageState
+  {
+    Pipeline::Stage* pStage;
+    PIPELINE_STAGE_MODE Mode;
+    uint32 MaxParallelism;
+    uint32 RunningCount;
+
+    // Serial stages start items in sequence order, ordered stages pass them on in sequence order. Either way every
+    // sequence number from here to the newest is still in flight, so there are never more than one slot count of
+    // them, and an item waiting for its turn can be kept at its sequence modulo the slot count.
+    uint64 NextSequence;
+    uint32* pSequenceSlots;
+
+    // items waiting for parallel stages, in arrival order
+    uint32* pFifo;
+    uint32 FifoHead;
+    uint32 FifoCount;
+  };
+
+  // picks an item for the furthest stage down that can take one, returns false if none can
+  bool TakeWork(uint32* pStageIndex, uint32* pSlot)
+  {
+    for (uint32 i = m_stageCount; i-- > 0;)
+    {
+      StageState& stage = m_pStages[i];
+      if (stage.RunningCount >= stage.MaxParallelism)
+        continue;
+
+      uint32 slot;
+      if (i == 0)
+      {
+        if (m_sourceDone || *m_pCancelled || m_freeSlotCount == 0)
+          continue;
+
+        slot = m_pFreeSlots[--m_freeSlotCount];
+        m_pSlotSequences[slot] = m_nextSourceSequence++;
+      }
+      else if (stage.Mode == PIPELINE_STAGE_SERIAL)
+      {
+        uint32 index = static_cast<uint32>(stage.NextSequence % m_slotCount);
+        slot = stage.pSequenceSlots[index];
+        if (slot == InvalidSlot)
+          continue;
+
+        stage.pSequenceSlots[index] = InvalidSlot;
+        stage.NextSequence++;
+      }
+      else
+      {
+        if (stage.FifoCount == 0)
+          continue;
+
+        slot = stage.pFifo[stage.FifoHead];
+        stage.FifoHead = (stage.FifoHead + 1) % m_slotCount;
+        stage.FifoCount--;
+      }
+
+      stage.RunningCount++;
+      *pStageIndex = i;
+      *pSlot = slot;
+      return true;
+    }
+
+    return false;
+  }
+
+  void FinishWork(uint32 stageIndex, uint32 slot, bool produced)
+  {
+    StageState& stage = m_pStages[stageIndex];
+    stage.RunningCount--;
+
+    if (!produced)
+    {
+      // the source has run dry, and the sequence number it was given goes to nobody
+      m_sourceDone = true;
+      m_nextSourceSequence--;
+      m_pFreeSlots[m_freeSlotCount++] = slot;
+    }
+    else if (stage.Mode == PIPELINE_STAGE_ORDERED_PARALLEL)
+    {
+      // held back until everything before it has been passed on
+      stage.pSequenceSlots[m_pSlotSequences[slot] % m_slotCount] = slot;
+      for (;;)
+      {
+        uint32 index = static_cast<uint32>(stage.NextSequence % m_slotCount);
+        uint32 nextSlot = stage.pSequenceSlots[index];
+        if (nextSlot == InvalidSlot)
+          break;
+
+        stage.pSequenceSlots[index] = InvalidSlot;
+        stage.NextSequence++;
+        PassOn(stageIndex + 1, nextSlot);
+      }
+    }
+    else
+    {
+      PassOn(stageIndex + 1, slot);
+    }
+
+    // nothing's left once every slot is free, and the source won't be called again
+    if (m_freeSlotCount == m_slotCount && (m_sourceDone || *m_pCancelled))
+    {
+      m_finished = true;
+      if (m_callerWaiting)
+        m_conditionVariable.WakeAll();
+
+      return;
+    }
+
+    WakeParticipants();
+  }
+
+  // hands an item to the next stage, or frees its slot once it's through the sink
+  void PassOn(uint32 stageIndex, uint32 slot)
+  {
+    if (stageIndex == m_stageCount)
+    {
+      m_pFreeSlots[m_freeSlotCount++] = slot;
+      return;
+    }
+
+    StageState& stage = m_pStages[stageIndex];
+    if (stage.Mode == PIPELINE_STAGE_SERIAL)
+    {
+      stage.pSequenceSlots[m_pSlotSequences[slot] % m_slotCount] = slot;
+    }
+    else
+    {
+      stage.pFifo[(stage.FifoHead + stage.FifoCount) % m_slotCount] = slot;
+      stage.FifoCount++;
+    }
+  }
+
+  // items that could be started right now, up to limit
+  uint32 CountStartableWork(uint32 limit) const
+  {
+    uint32 count = 0;
+    for (uint32 i = 0; i < m_stageCount && count < limit; i++)
+    {
+      const StageState& stage = m_pStages[i];
+      uint32 available;
+      if (i == 0)
+        available = (m_sourceDone || *m_pCancelled || m_freeSlotCount == 0) ? 0 : 1;
+      else if (stage.Mode == PIPELINE_STAGE_SERIAL)
+        available = (stage.pSequenceSlots[stage.NextSequence % m_slotCount] != InvalidSlot) ? 1 : 0;
+      else
+        available = stage.FifoCount;
+
+      count += Min(available, stage.MaxParallelism - stage.RunningCount);
+    }
+
+    return count;
+  }
+
+  // The thread that finished an item takes the next one itself, anything past that goes to the waiting caller and
+  // then to helpers from the pool.
+  void WakeParticipants()
+  {
+    uint32 extraWork = CountStartableWork(m_maxHelperCount + 2);
+    if (extraWork <= 1)
+      return;
+
+    extraWork--;
+    if (m_callerWaiting)
+    {
+      m_conditionVariable.Wake();
+      extraWork--;
+    }
+
+    while (extraWork > 0 && m_helperCount < m_maxHelperCount)
+    {
+      m_helperCount++;
+      ThreadPoolHelperWorkItem<PipelineJob>::Enqueue(m_pThreadPool, this);
+      extraWork--;
+    }
+  }
+
+  StageState* m_pStages;
+  uint32 m_stageCount;
+  uint32 m_slotCount;
+
+  // the source's sequence number for the item in each slot, and the slots not in use
+  uint64* m_pSlotSequences;
+  uint32* m_pFreeSlots;
+  uint32 m_freeSlotCount;
+
+  uint64 m_nextSourceSequence;
+  bool m_sourceDone;
+  bool m_finished;
+  const volatile bool* m_pCancelled;
+
+  ThreadPool* m_pThreadPool;
+  uint32 m_maxHelperCount;
+  uint32 m_helperCount;
+  bool m_callerWaiting;
+
+  Mutex m_lock;
+  ConditionVariable m_conditionVariable;
+};
+
+Pipeline::Pipeline(uint32 maxItemsInFlight /* = 16 */)
+  : m_maxItemsInFlight(Max(maxItemsInFlight, 1u)), m_pLastQueue(nullptr), m_cancelled(false)
+{
+}
+
+Pipeline::~Pipeline()
+{
+  for (uint32 i = 0; i < m_stages.GetSize(); i++)
+    delete m_stages[i];
+  for (uint32 i = 0; i < m_queues.GetSize(); i++)
+    delete m_queues[i];
+}
+
+bool Pipeline::Run(ThreadPool* pThreadPool)
+{
+  DebugAssert(m_stages.GetSize() >= 2 && m_pLastQueue == nullptr);
+  m_cancelled = false;
+
+  PipelineJob* pJob =
+    new PipelineJob(m_stages.GetBasePointer(), m_stages.GetSize(), m_maxItemsInFlight, pThreadPool, &m_cancelled);
+  pJob->Participate(true);
+  pJob->Release();
+
+  return !m_cancelled;
+}
+
+void Pipeline::Cancel()
+{
+  m_cancelled = true;
+}
@@ -0,0 +1,488 @@
+#include "YBaseLib/Profiler.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/BinaryWriter.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/TextWriter.h"
+#include <cstring>
+Log_SetChannel(Profiler);
+
+namespace Profiler {
+
+volatile bool g_isCapturing = false;
+
+struct Event
+{
+  const char* Name;
+  Y_TIMER_VALUE StartTime;
+  Y_TIMER_VALUE EndTime;
+};
+
+// Events are only ever appended to a chunk by its thread, and published by the count, so readers take up to the
+// count and nothing past it.
+static const uint32 EventsPerChunk = 4096;
+struct EventChunk
+{
+  Event Events[EventsPerChunk];
+  Y_ATOMIC_DECL uint32 Count;
+  EventChunk* volatile pNext;
+};
+
+static const uint32 MaxThreadNameLength = 63;
+
+// A thread's events, kept for the process's life and reused by other threads once released. Chunks are never
+// freed, a new capture empties them as each thread next records, by setting their counts to zero and then the
+// generation. A reader takes a buffer's events only if its generation is the capture's before and after copying
+// them, the names are all from literals, so a copy torn by a thread starting over is thrown away safely.
+struct ThreadBuffer
+{
+  Y_ATOMIC_DECL uint32 Generation;
+  Y_ATOMIC_DECL uint32 ThreadNumber;
+  Y_ATOMIC_DECL uint32 Released;
+  char ThreadName[MaxThreadNameLength + 1];
+
+  // written by the thread alone
+  EventChunk* volatile pFirstChunk;
+  EventChunk* pCurrentChunk;
+  uint32 ChunkCount;
+
+  ThreadBuffer* pNext;
+};
+
+// every buffer made, pushed on as threads first record or are named
+static ThreadBuffer* volatile s_pThreadBuffers = nullptr;
+static Y_ATOMIC_DECL uint32 s_nextThreadNumber = 0;
+Y_DECLARE_THREAD_LOCAL(ThreadBuffer*) s_pThreadBuffer = nullptr;
+
+// the capture, changed only with recording stopped
+static Y_ATOMIC_DECL uint32 s_generation = 0;
+static uint32 s_maxChunksPerThread = 0;
+static Y_TIMER_VALUE s_captureStartTime = 0;
+static Y_ATOMIC_DECL uint32 s_droppedEventCount = 0;
+
+static ThreadBuffer* GetThreadBuffer()
+{
+  ThreadBuffer* pBuffer = s_pThreadBuffer;
+  if (pBuffer != nullptr)
+    return pBuffer;
+
+  // take a released buffer whose events have already been dropped
+  uint32 generation = Y_AtomicLoadAcquire(s_generation);
+  for (pBuffer = s_pThreadBuffers; pBuffer != nullptr; pBuffer = pBuffer->pNext)
+  {
+    if (pBuffer->Released != 0 && Y_AtomicLoadAcquire(pBuffer->Generation) != generation &&
+        Y_AtomicCompareExchange(pBuffer->Released, 0u, 1u) == 1)
+    {
+      break;
+    }
+  }
+
+  if (pBuffer != nullptr)
+  {
+    pBuffer->ThreadName[0] = '\0';
+  }
+  else
+  {
+    pBuffer = new ThreadBuffer();
+    pBuffer->Generation = generation - 1;
+    pBuffer->Released = 0;
+    pBuffer->ThreadName[0] = '\0';
+    pBuffer->pFirstChunk = nullptr;
+    pBuffer->pCurrentChunk = nullptr;
+    pBuffer->ChunkCount = 0;
+
+    ThreadBuffer* pHead;
+    do
+    {
+      pHead = s_pThreadBuffers;
+      pBuffer->pNext = pHead;
+    } while (Y_AtomicCompareExchangePointer(s_pThreadBuffers, pBuffer, pHead) != pHead);
+  }
+
+  Y_AtomicStoreRelease(pBuffer->ThreadNumber, Y_AtomicIncrement(s_nextThreadNumber));
+  s_pThreadBuffer = pBuffer;
+  return pBuffer;
+}
+
+static void StartOver(ThreadBuffer* pBuffer, uint32 generation)
+{
+  for (EventChunk* pChunk = pBuffer->pFirstChunk; pChunk != nullptr; pChunk = pChunk->pNext)
+    Y_AtomicStoreRelease(pChunk->Count, 0u);
+
+  pBuffer->pCurrentChunk = pBuffer->pFirstChunk;
+  Y_AtomicStoreRelease(pBuffer->Generation, generation);
+}
+
+// the chunk to record the next event in, nullptr if the buffer is full
+static EventChunk* GetChunkWithRoom(ThreadBuffer* pBuffer)
+{
+  EventChunk* pChunk = pBuffer->pCurrentChunk;
+  if (pChunk != nullptr && pChunk->Count < EventsPerChunk)
+    return pChunk;
+
+  // reuse the chunks from earlier captures before adding more
+  EventChunk* pNextChunk = (pChunk != nullptr) ? pChunk->pNext : pBuffer->pFirstChunk;
+  if (pNextChunk == nullptr)
+  {
+    if (pBuffer->ChunkCount >= s_maxChunksPerThread)
+      return nullptr;
+
+    pNextChunk = new EventChunk();
+    pNextChunk->Count = 0;
+    pNextChunk->pNext = nullptr;
+    pBuffer->ChunkCount++;
+
+    // published once it's set up
+    if (pChunk != nullptr)
+      Y_AtomicStoreRelease(pChunk->pNext, pNextChunk);
+    else
+      Y_AtomicStoreRelease(pBuffer->pFirstChunk, pNextChunk);
+  }
+
+  pBuffer->pCurrentChunk = pNextChunk;
+  return pNextChunk;
+}
+
+void StartCapture(uint32 maxEventsPerThread)
+{
+  g_isCapturing = false;
+  s_maxChunksPerThread = Max((maxEventsPerThread + EventsPerChunk - 1) / EventsPerChunk, 1u);
+  s_captureStartTime = Y_FastTimerGetValue();
+  Y_AtomicStoreRelease(s_droppedEventCount, 0u);
+  Y_AtomicIncrement(s_generation);
+  g_isCapturing = true;
+}
+
+void StopCapture()
+{
+  g_isCapturing = false;
+}
+
+uint32 GetDroppedEventCount()
+{
+  return Y_AtomicLoadAcquire(s_droppedEventCount);
+}
+
+void RecordZone(const char* name, Y_TIMER_VALUE startTime, Y_TIMER_VALUE endTime)
+{
+  // zones started before the capture belong to the last one, which is gone
+  if (startTime < s_captureStartTime)
+    return;
+
+  ThreadBuffer* pBuffer = GetThreadBuffer();
+  uint32 generation = Y_AtomicLoadAcquire(s_generation);
+  if (pBuffer->Generation != generation)
+    StartOver(pBuffer, generation);
+
+  EventChunk* pChunk = GetChunkWithRoom(pBuffer);
+  if (pChunk == nullptr)
+  {
+    Y_AtomicIncrement(s_droppedEventCount);
+    return;
+  }
+
+  uint32 index = pChunk->Count;
+  Event& event = pChunk->Events[index];
+  event.Name = name;
+  event.StartTime = startTime;
+  event.EndTime = endTime;
+  Y_AtomicStoreRelease(pChunk->Count, index + 1);
+}
+
+void SetThreadName(const char* name)
+{
+  ThreadBuffer* pBuffer = GetThreadBuffer();
+  Y_strncpy(pBuffer->ThreadName, countof(pBuffer->ThreadName), name);
+}
+
+void ReleaseThreadBuffer()
+{
+  ThreadBuffer* pBuffer = s_pThreadBuffer;
+  if (pBuffer == nullptr)
+    return;
+
+  s_pThreadBuffer = nullptr;
+  Y_AtomicStoreRelease(pBuffer->Released, 1u);
+}
+
+namespace {
+
+// A copy of a thread's events in the capture, ordered by start, with the outer of two zones starting together first.
+struct ThreadSnapshot
+{
+  uint32 ThreadNumber;
+  SmallString ThreadName;
+  PODArray<Event> Events;
+};
+
+} // namespace
+
+static void TakeSnapshots(PODArray<ThreadSnapshot*>& snapshots)
+{
+  uint32 generation = Y_AtomicLoadAcquire(s_generation);
+  for (ThreadBuffer* pBuffer = Y_AtomicLoadAcquire(s_pThreadBuffers); pBuffer != nullptr; pBuffer = pBuffer->pNext)
+  {
+    if (Y_AtomicLoadAcquire(pBuffer->Generation) != generation)
+      continue;
+
+    ThreadSnapshot* pSnapshot = new ThreadSnapshot();
+    pSnapshot->ThreadNumber = Y_AtomicLoadAcquire(pBuffer->ThreadNumber);
+    char threadName[MaxThreadNameLength + 1];
+    std::memcpy(threadName, pBuffer->ThreadName, sizeof(threadName));
+    threadName[MaxThreadNameLength] = '\0';
+    pSnapshot->ThreadName = threadName;
+
+    for (EventChunk* pChunk = Y_AtomicLoadAcquire(pBuffer->pFirstChunk); pChunk != nullptr;
+         pChunk = Y_AtomicLoadAcquire(pChunk->pNext))
+    {
+      uint32 count = Y_AtomicLoadAcquire(pChunk->Count);
+      pSnapshot->Events.AddRange(pChunk->Events, count);
+      if (count < EventsPerChunk)
+        break;
+    }
+
+    // started over while being copied, it's the next capture's now
+    if (Y_AtomicLoadAcquire(pBuffer->Generation) != generation || pSnapshot->Events.IsEmpty())
+    {
+      delete pSnapshot;
+      continue;
+    }
+
+    pSnapshot->Events.SortCB([](const Event& left, const Event& right) {
+      if (left.StartTime != right.StartTime)
+        return (left.StartTime < right.StartTime) ? -1 : 1;
+      if (left.EndTime != right.EndTime)
+        return (left.EndTime > right.EndTime) ? -1 : 1;
+      return 0;
+    });
+
+    snapshots.Add(pSnapshot);
+  }
+
+  // oldest threads first
+  snapshots.SortCB([](const ThreadSnapshot* pLeft, const ThreadSnapshot* pRight) {
+    return (int)pLeft->ThreadNumber - (int)pRight->ThreadNumber;
+  });
+}
+
+static void FreeSnapshots(PODArray<ThreadSnapshot*>& snapshots)
+{
+  for (ThreadSnapshot* pSnapshot : snapshots)
+    delete pSnapshot;
+  snapshots.Clear();
+}
+
+static double GetCaptureMicroseconds(Y_TIMER_VALUE time)
+{
+  return Y_FastTimerConvertToNanoseconds(time - s_captureStartTime) / 1000.0;
+}
+
+static void WriteJSONString(TextWriter& writer, const char* str)
+{
+  SmallString escaped;
+  escaped.AppendCharacter('"');
+  for (const char* pChar = str; *pChar != '\0'; pChar++)
+  {
+    char ch = *pChar;
+    if (ch == '"' || ch == '\\')
+    {
+      escaped.AppendCharacter('\\');
+      escaped.AppendCharacter(ch);
+    }
+    else if ((unsigned char)ch < 0x20)
+    {
+      escaped.AppendFormattedString("\\u%04x", (uint32)(unsigned char)ch);
+    }
+    else
+    {
+      escaped.AppendCharacter(ch);
+    }
+  }
+  escaped.AppendCharacter('"');
+  writer.Write(escaped);
+}
+
+bool ExportChromeTrace(ByteStream* pStream)
+{
+  PODArray<ThreadSnapshot*> snapshots;
+  TakeSnapshots(snapshots);
+
+  // complete events, with a name for each thread in the metadata
+  TextWriter writer(pStream);
+  writer.Write("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  bool first = true;
+  for (const ThreadSnapshot* pSnapshot : snapshots)
+  {
+    if (!pSnapshot->ThreadName.IsEmpty())
+    {
+      writer.WriteFormattedString("%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                                  first ? "" : ",", pSnapshot->ThreadNumber);
+      WriteJSONString(writer, pSnapshot->ThreadName);
+      writer.Write("}}");
+      first = false;
+    }
+
+    for (const Event& event : pSnapshot->Events)
+    {
+      writer.WriteFormattedString("%s\n{\"name\":", first ? "" : ",");
+      WriteJSONString(writer, event.Name);
+      writer.WriteFormattedString(",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                                  pSnapshot->ThreadNumber, GetCaptureMicroseconds(event.StartTime),
+                                  Y_FastTimerConvertToNanoseconds(event.EndTime - event.StartTime) / 1000.0);
+      first = false;
+    }
+  }
+  writer.Write("\n]}\n");
+
+  FreeSnapshots(snapshots);
+  if (!writer.Flush() || pStream->InErrorState())
+  {
+    Log_ErrorPrintf("Profiler::ExportChromeTrace: Failed to write trace");
+    return false;
+  }
+
+  return true;
+}
+
+// Perfetto's protobuf fields, from perfetto/trace/*.proto. The trace is a sequence of packets, each thread gets a
+// track, and zones are slices on it, begun and ended by track events.
+enum PERFETTO_FIELD
+{
+  PERFETTO_FIELD_TRACE_PACKET = 1,
+  PERFETTO_FIELD_PACKET_TIMESTAMP = 8,
+  PERFETTO_FIELD_PACKET_SEQUENCE_ID = 10,
+  PERFETTO_FIELD_PACKET_TRACK_EVENT = 11,
+  PERFETTO_FIELD_PACKET_TRACK_DESCRIPTOR = 60,
+  PERFETTO_FIELD_TRACK_DESCRIPTOR_UUID = 1,
+  PERFETTO_FIELD_TRACK_DESCRIPTOR_THREAD = 4,
+  PERFETTO_FIELD_THREAD_DESCRIPTOR_PID = 1,
+  PERFETTO_FIELD_THREAD_DESCRIPTOR_TID = 2,
+  PERFETTO_FIELD_THREAD_DESCRIPTOR_NAME = 5,
+  PERFETTO_FIELD_TRACK_EVENT_TYPE = 9,
+  PERFETTO_FIELD_TRACK_EVENT_TRACK_UUID = 11,
+  PERFETTO_FIELD_TRACK_EVENT_NAME = 23,
+};
+
+enum PERFETTO_TRACK_EVENT_TYPE
+{
+  PERFETTO_TRACK_EVENT_TYPE_SLICE_BEGIN = 1,
+  PERFETTO_TRACK_EVENT_TYPE_SLICE_END = 2,
+};
+
+// the sequence every packet is on, any number but zero
+static const uint32 PerfettoSequenceID = 1;
+
+static void AppendVarUInt(PODArray<byte>& buffer, uint64 value)
+{
+  byte encoded[BinaryWriter::MaxVarIntSize];
+  buffer.AddRange(encoded, BinaryWriter::EncodeVarUInt(encoded, value));
+}
+
+static void AppendVarIntField(PODArray<byte>& buffer, uint32 field, uint64 value)
+{
+  AppendVarUInt(buffer, (uint64)(field << 3));
+  AppendVarUInt(buffer, value);
+}
+
+static void AppendBytesField(PODArray<byte>& buffer, uint32 field, const void* pData, uint32 size)
+{
+  AppendVarUInt(buffer, (uint64)((field << 3) | 2));
+  AppendVarUInt(buffer, size);
+  buffer.AddRange(reinterpret_cast<const byte*>(pData), size);
+}
+
+static void AppendTrackEventPacket(PODArray<byte>& packets, PODArray<byte>& packet, PODArray<byte>& trackEvent,
+                                   uint32 trackNumber, PERFETTO_TRACK_EVENT_TYPE type, const char* name,
+                                   Y_TIMER_VALUE time)
+{
+  trackEvent.Clear();
+  AppendVarIntField(trackEvent, PERFETTO_FIELD_TRACK_EVENT_TYPE, type);
+  AppendVarIntField(trackEvent, PERFETTO_FIELD_TRACK_EVENT_TRACK_UUID, trackNumber);
+  if (name != nullptr)
+    AppendBytesField(trackEvent, PERFETTO_FIELD_TRACK_EVENT_NAME, name, Y_strlen(name));
+
+  packet.Clear();
+  uint64 timestamp = (uint64)Y_FastTimerConvertToNanoseconds(time - s_captureStartTime);
+  AppendVarIntField(packet, PERFETTO_FIELD_PACKET_TIMESTAMP, timestamp);
+  AppendVarIntField(packet, PERFETTO_FIELD_PACKET_SEQUENCE_ID, PerfettoSequenceID);
+  AppendBytesField(packet, PERFETTO_FIELD_PACKET_TRACK_EVENT, trackEvent.GetBasePointer(), trackEvent.GetSize());
+  AppendBytesField(packets, PERFETTO_FIELD_TRACE_PACKET, packet.GetBasePointer(), packet.GetSize());
+}
+
+bool ExportPerfettoTrace(ByteStream* pStream)
+{
+  PODArray<ThreadSnapshot*> snapshots;
+  TakeSnapshots(snapshots);
+
+  PODArray<byte> packets;
+  PODArray<byte> packet;
+  PODArray<byte> message;
+  PODArray<byte> thread;
+  PODArray<Event> openEvents;
+  bool result = true;
+  for (const ThreadSnapshot* pSnapshot : snapshots)
+  {
+    // the thread's track
+    thread.Clear();
+    AppendVarIntField(thread, PERFETTO_FIELD_THREAD_DESCRIPTOR_PID, 1);
+    AppendVarIntField(thread, PERFETTO_FIELD_THREAD_DESCRIPTOR_TID, pSnapshot->ThreadNumber);
+    if (!pSnapshot->ThreadName.IsEmpty())
+    {
+      AppendBytesField(thread, PERFETTO_FIELD_THREAD_DESCRIPTOR_NAME, pSnapshot->ThreadName.GetCharArray(),
+                       pSnapshot->ThreadName.GetLength());
+    }
+    message.Clear();
+    AppendVarIntField(message, PERFETTO_FIELD_TRACK_DESCRIPTOR_UUID, pSnapshot->ThreadNumber);
+    AppendBytesField(message, PERFETTO_FIELD_TRACK_DESCRIPTOR_THREAD, thread.GetBasePointer(), thread.GetSize());
+    packet.Clear();
+    AppendVarIntField(packet, PERFETTO_FIELD_PACKET_SEQUENCE_ID, PerfettoSequenceID);
+    AppendBytesField(packet, PERFETTO_FIELD_PACKET_TRACK_DESCRIPTOR, message.GetBasePointer(), message.GetSize());
+    AppendBytesField(packets, PERFETTO_FIELD_TRACE_PACKET, packet.GetBasePointer(), packet.GetSize());
+
+    // Slices have to nest on a track, so zones are ended as later ones start past them, and a zone overlapping the
+    // end of the one it started in, which only recording zones by hand can do, is cut short.
+    openEvents.Clear();
+    for (const Event& event : pSnapshot->Events)
+    {
+      while (!openEvents.IsEmpty() && openEvents.LastElement().EndTime <= event.StartTime)
+      {
+        AppendTrackEventPacket(packets, packet, message, pSnapshot->ThreadNumber,
+                               PERFETTO_TRACK_EVENT_TYPE_SLICE_END, nullptr, openEvents.LastElement().EndTime);
+        openEvents.RemoveBack();
+      }
+
+      Event nestedEvent = event;
+      if (!openEvents.IsEmpty())
+        nestedEvent.EndTime = Min(nestedEvent.EndTime, openEvents.LastElement().EndTime);
+
+      AppendTrackEventPacket(packets, packet, message, pSnapshot->ThreadNumber,
+                             PERFETTO_TRACK_EVENT_TYPE_SLICE_BEGIN, nestedEvent.Name, nestedEvent.StartTime);
+      openEvents.Add(nestedEvent);
+    }
+
+    while (!openEvents.IsEmpty())
+    {
+      AppendTrackEventPacket(packets, packet, message, pSnapshot->ThreadNumber, PERFETTO_TRACK_EVENT_TYPE_SLICE_END,
+                             nullptr, openEvents.LastElement().EndTime);
+      openEvents.RemoveBack();
+    }
+
+    // written a thread at a time, so a long capture isn't held in memory twice
+    if (!pStream->Write2(packets.GetBasePointer(), packets.GetSize()))
+    {
+      result = false;
+      break;
+    }
+    packets.Clear();
+  }
+
+  FreeSnapshots(snapshots);
+  if (!result)
+    Log_ErrorPrintf("Profiler::ExportPerfettoTrace: Failed to write trace");
+  return result;
+}
+
+} // namespace Profiler
@@ -0,0 +1,447 @@
+#include "YBaseLib/RPCChannel.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Log.h"
+Log_SetChannel(RPCChannel);
+
+const uint32 RPCChannel::DefaultMaxBatchSize;
+
+RPCChannel::RPCChannel(SendFunction sendFunction, uint32 maxBatchSize /*= DefaultMaxBatchSize*/)
+  : m_sendFunction(std::move(sendFunction)), m_maxBatchSize(maxBatchSize), m_nextRequestID(1),
+    m_pFrameStream(ByteStream_CreateGrowableMemoryStream()), m_frameWriter(m_pFrameStream, ENDIAN_TYPE_LITTLE),
+    m_frameCallID(0), m_sending(false), m_corkCount(0), m_closed(false),
+    m_pReceiveStream(ByteStream_CreateReadOnlyMemoryStream(nullptr, 0))
+{
+  DebugAssert(maxBatchSize > BinaryWriter::MaxVarIntSize);
+}
+
+RPCChannel::~RPCChannel()
+{
+  if (!m_closed)
+  {
+    Error error;
+    error.SetErrorUserStatic(0, "RPC channel destroyed.");
+    Close(&error);
+  }
+
+  for (HashTable<uint32, MethodFunction*>::Iterator itr = m_methods.Begin(); itr != m_methods.End(); ++itr)
+    delete itr->Value;
+
+  m_pReceiveStream->Release();
+  m_pFrameStream->Release();
+}
+
+void RPCChannel::RegisterMethod(uint32 methodID, MethodFunction method)
+{
+  m_lock.Lock();
+  HashTable<uint32, MethodFunction*>::Member* pMember = m_methods.Find(methodID);
+  if (pMember != nullptr)
+    *pMember->Value = std::move(method);
+  else
+    m_methods.Insert(methodID, new MethodFunction(std::move(method)));
+  m_lock.Unlock();
+}
+
+BinaryWriter* RPCChannel::BeginCall(uint32 methodID, ResponseFunction callback)
+{
+  m_lock.Lock();
+
+  // 0 is a notification
+  uint32 requestID = m_nextRequestID++;
+  if (requestID == 0)
+    requestID = m_nextRequestID++;
+
+  m_outstandingCalls.Insert(requestID, new ResponseFunction(std::move(callback)));
+  m_frameCallID = requestID;
+
+  m_frameWriter.SeekAbsolute(0);
+  m_frameWriter.WriteVarUInt32(FrameType_Call);
+  m_frameWriter.WriteVarUInt32(requestID);
+  m_frameWriter.WriteVarUInt32(methodID);
+  return &m_frameWriter;
+}
+
+BinaryWriter* RPCChannel::BeginNotify(uint32 methodID)
+{
+  m_lock.Lock();
+  m_frameCallID = 0;
+  m_frameWriter.SeekAbsolute(0);
+  m_frameWriter.WriteVarUInt32(FrameType_Notify);
+  m_frameWriter.WriteVarUInt32(methodID);
+  return &m_frameWriter;
+}
+
+BinaryWriter* RPCChannel::BeginResponse(uint32 requestID)
+{
+  DebugAssert(requestID != 0);
+  m_lock.Lock();
+  m_frameCallID = 0;
+  m_frameWriter.SeekAbsolute(0);
+  m_frameWriter.WriteVarUInt32(FrameType_Response);
+  m_frameWriter.WriteVarUInt32(requestID);
+  return &m_frameWriter;
+}
+
+void RPCChannel::RespondError(uint32 requestID, int32 errorCode, const char* message)
+{
+  DebugAssert(requestID != 0);
+  m_lock.Lock();
+  m_frameCallID = 0;
+  m_frameWriter.SeekAbsolute(0);
+  m_frameWriter.WriteVarUInt32(FrameType_Error);
+  m_frameWriter.WriteVarUInt32(requestID);
+  m_frameWriter.WriteVarInt32(errorCode);
+  m_frameWriter.WriteSizePrefixedString(message);
+  EndMessage();
+}
+
+bool RPCChannel::EndMessage()
+{
+  m_frameWriter.SyncStream();
+  size_t frameSize = (size_t)m_pFrameStream->GetPosition();
+
+  // the length goes in front, and it has to fit in a batch with it
+  byte prefix[BinaryWriter::MaxVarIntSize];
+  uint32 prefixSize = BinaryWriter::EncodeVarUInt(prefix, frameSize);
+  if (m_closed || frameSize + prefixSize > m_maxBatchSize)
+  {
+    Error error;
+    if (m_closed)
+      error = m_closeError;
+    else
+      error.SetErrorUserStatic(0, "RPC message too large.");
+
+    ResponseFunction* pCallback = (m_frameCallID != 0) ? TakeOutstandingCall(m_frameCallID) : nullptr;
+    m_lock.Unlock();
+
+    if (pCallback != nullptr)
+    {
+      (*pCallback)(nullptr, &error);
+      delete pCallback;
+    }
+
+    return false;
+  }
+
+  m_sendQueue.AddRange(prefix, prefixSize);
+  m_sendQueue.AddRange(m_pFrameStream->GetMemoryPointer(), (uint32)frameSize);
+  bool send = (m_corkCount == 0);
+  m_lock.Unlock();
+
+  if (send)
+    Flush();
+
+  return true;
+}
+
+void RPCChannel::Cork()
+{
+  m_lock.Lock();
+  m_corkCount++;
+  m_lock.Unlock();
+}
+
+void RPCChannel::Uncork()
+{
+  m_lock.Lock();
+  DebugAssert(m_corkCount > 0);
+  bool send = (--m_corkCount == 0 && !m_sendQueue.IsEmpty());
+  m_lock.Unlock();
+
+  if (send)
+    Flush();
+}
+
+bool RPCChannel::Flush()
+{
+  m_lock.Lock();
+
+  // whoever's sending takes what's been queued behind it before it stops
+  if (m_sending)
+  {
+    m_lock.Unlock();
+    return true;
+  }
+
+  m_sending = true;
+  bool result = true;
+  while (!m_closed && !m_sendQueue.IsEmpty())
+  {
+    // sent without the lock, as the transport has locks of its own that are held when frames are received
+    m_sendingBuffer.Swap(m_sendQueue);
+    m_lock.Unlock();
+    size_t sentBytes = SendBatches(m_sendingBuffer.GetBasePointer(), m_sendingBuffer.GetSize());
+    m_lock.Lock();
+
+    if (sentBytes < m_sendingBuffer.GetSize())
+    {
+      // what's left goes back in front of anything queued since
+      m_sendingBuffer.RemoveRange(0, (uint32)sentBytes);
+      m_sendingBuffer.AddRange(m_sendQueue.GetBasePointer(), m_sendQueue.GetSize());
+      m_sendQueue.Swap(m_sendingBuffer);
+      m_sendingBuffer.Clear();
+      result = false;
+      break;
+    }
+
+    m_sendingBuffer.Clear();
+  }
+
+  if (m_closed)
+    m_sendQueue.Clear();
+
+  m_sending = false;
+  m_lock.Unlock();
+  return result;
+}
+
+size_t RPCChannel::SendBatches(const byte* pData, size_t size)
+{
+  size_t sentBytes = 0;
+  while (sentBytes < size)
+  {
+    // as many whole frames as fit, every frame fits on its own
+    size_t batchSize = 0;
+    while (sentBytes + batchSize < size)
+    {
+      uint64 frameSize = 0;
+      uint32 prefixSize = BinaryReader::DecodeVarUInt(pData + sentBytes + batchSize,
+                                                      (uint32)Min(size - sentBytes - batchSize, (size_t)0xFFFFFFFF),
+                                                      &frameSize);
+
+      // only whole frames are queued, but a bad prefix ends the batch rather than sizing it from garbage
+      DebugAssert(prefixSize > 0);
+      if (prefixSize == 0 || batchSize + prefixSize + frameSize > m_maxBatchSize)
+        break;
+
+      batchSize += prefixSize + (size_t)frameSize;
+    }
+
+    // nothing that can be sent, what's left stays queued
+    if (batchSize == 0)
+      break;
+
+    if (!m_sendFunction(pData + sentBytes, batchSize))
+      break;
+
+    sentBytes += batchSize;
+  }
+
+  return sentBytes;
+}
+
+bool RPCChannel::ReceiveFrames(const void* pData, size_t size)
+{
+  // responses to the batch go back together
+  Cork();
+  ptrdiff_t consumed = DispatchFrames(reinterpret_cast<const byte*>(pData), size);
+  Uncork();
+
+  // a batch is only ever whole frames
+  return (consumed >= 0 && (size_t)consumed == size);
+}
+
+bool RPCChannel::ReceiveStream(const void* pData, size_t size)
+{
+  const byte* pBytes = reinterpret_cast<const byte*>(pData);
+  bool result = true;
+  Cork();
+
+  // a frame cut off last time is finished first, from as many bytes as it needs
+  if (!m_partialFrame.IsEmpty())
+  {
+    uint32 previousSize = m_partialFrame.GetSize();
+    size_t bytesToAdd = Min(size, (size_t)m_maxBatchSize - previousSize);
+    m_partialFrame.AddRange(pBytes, (uint32)bytesToAdd);
+
+    // Frames are no longer than a batch, so with nothing dispatched the frame's still not all here, and every byte
+    // has been taken. Otherwise it carries on from where the frames dispatched ended.
+    ptrdiff_t consumed = DispatchFrames(m_partialFrame.GetBasePointer(), m_partialFrame.GetSize());
+    if (consumed < 0)
+    {
+      result = false;
+    }
+    else if (consumed == 0)
+    {
+      DebugAssert(bytesToAdd == size);
+      size = 0;
+    }
+    else
+    {
+      DebugAssert((size_t)consumed > previousSize);
+      pBytes += (size_t)consumed - previousSize;
+      size -= (size_t)consumed - previousSize;
+      m_partialFrame.Clear();
+    }
+  }
+
+  if (result && size > 0)
+  {
+    ptrdiff_t consumed = DispatchFrames(pBytes, size);
+    if (consumed < 0)
+      result = false;
+    else
+      m_partialFrame.AddRange(pBytes + consumed, (uint32)(size - (size_t)consumed));
+  }
+
+  Uncork();
+  return result;
+}
+
+ptrdiff_t RPCChannel::DispatchFrames(const byte* pData, size_t size)
+{
+  size_t position = 0;
+  while (position < size)
+  {
+    uint64 frameSize;
+    size_t available = size - position;
+    uint32 prefixSize = BinaryReader::DecodeVarUInt(pData + position, (uint32)Min(available, (size_t)0xFFFFFFFF),
+                                                    &frameSize);
+    if (prefixSize == 0)
+    {
+      // a prefix only runs out of bytes when it's cut off
+      if (available >= BinaryReader::MaxVarIntSize)
+        return -1;
+
+      break;
+    }
+
+    if (frameSize + prefixSize > m_maxBatchSize)
+      return -1;
+    if (prefixSize + frameSize > available)
+      break;
+
+    if (!DispatchFrame(pData + position + prefixSize, (size_t)frameSize))
+      return -1;
+
+    position += prefixSize + (size_t)frameSize;
+  }
+
+  return (ptrdiff_t)position;
+}
+
+bool RPCChannel::DispatchFrame(const byte* pFrame, size_t size)
+{
+  // errors reading past the end are left for the reader's error state rather than raised
+  m_pReceiveStream->SetMemory(pFrame, size);
+  BinaryReader reader(m_pReceiveStream, ENDIAN_TYPE_LITTLE, true);
+
+  uint32 frameType;
+  uint32 id;
+  if (!reader.SafeReadVarUInt32(&frameType) || !reader.SafeReadVarUInt32(&id))
+    return false;
+
+  switch (frameType)
+  {
+    case FrameType_Call:
+    case FrameType_Notify:
+    {
+      // a call has its request ID ahead of the method's
+      uint32 requestID = 0;
+      uint32 methodID = id;
+      if (frameType == FrameType_Call)
+      {
+        requestID = id;
+        if (requestID == 0 || !reader.SafeReadVarUInt32(&methodID))
+          return false;
+      }
+
+      // registered up front, so looked up without the lock
+      HashTable<uint32, MethodFunction*>::Member* pMember = m_methods.Find(methodID);
+      if (pMember == nullptr)
+      {
+        Log_WarningPrintf("RPCChannel: Call to unknown method %u", methodID);
+        if (requestID != 0)
+          RespondError(requestID, 0, "Unknown RPC method.");
+
+        return true;
+      }
+
+      (*pMember->Value)(this, requestID, &reader);
+      return true;
+    }
+
+    case FrameType_Response:
+    case FrameType_Error:
+    {
+      // one that's already failed, by the channel closing, is dropped
+      m_lock.Lock();
+      ResponseFunction* pCallback = TakeOutstandingCall(id);
+      m_lock.Unlock();
+      if (pCallback == nullptr)
+        return true;
+
+      if (frameType == FrameType_Response)
+      {
+        (*pCallback)(&reader, nullptr);
+      }
+      else
+      {
+        int32 errorCode = 0;
+        String message;
+        reader.SafeReadVarInt32(&errorCode);
+        reader.SafeReadSizePrefixedString(&message);
+
+        Error error;
+        error.SetErrorUser(errorCode, message.GetCharArray());
+        (*pCallback)(nullptr, &error);
+      }
+
+      delete pCallback;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+RPCChannel::ResponseFunction* RPCChannel::TakeOutstandingCall(uint32 requestID)
+{
+  HashTable<uint32, ResponseFunction*>::Member* pMember = m_outstandingCalls.Find(requestID);
+  if (pMember == nullptr)
+    return nullptr;
+
+  ResponseFunction* pCallback = pMember->Value;
+  m_outstandingCalls.Remove(pMember);
+  return pCallback;
+}
+
+void RPCChannel::Close(const Error* pError)
+{
+  PODArray<ResponseFunction*> callbacks;
+
+  m_lock.Lock();
+  if (m_closed)
+  {
+    m_lock.Unlock();
+    return;
+  }
+
+  m_closed = true;
+  m_closeError = *pError;
+  for (HashTable<uint32, ResponseFunction*>::Iterator itr = m_outstandingCalls.Begin();
+       itr != m_outstandingCalls.End(); ++itr)
+  {
+    callbacks.Add(itr->Value);
+  }
+  m_outstandingCalls.Clear();
+
+  // a send in progress drops the rest once it's done
+  if (!m_sending)
+    m_sendQueue.Clear();
+
+  m_lock.Unlock();
+
+  for (ResponseFunction* pCallback : callbacks)
+  {
+    (*pCallback)(nullptr, pError);
+    delete pCallback;
+  }
+}
+
+uint32 RPCChannel::GetOutstandingCallCount()
+{
+  m_lock.Lock();
+  uint32 count = m_outstandingCalls.GetMemberCount();
+  m_lock.Unlock();
+  return count;
+}
@@ -1,8 +1,7 @@
 #include "YBaseLib/ReferenceCounted.h"
-#include "YBaseLib/Assert.h"
 
-static const uint32 ReferenceCountValidValue = 0x11C0FFEE;
-static const uint32 ReferenceCountInvalidValue = 0xDEADC0DE;
+const uint32 ReferenceCounted::ReferenceCountValidValue;
+const uint32 ReferenceCounted::ReferenceCountInvalidValue;
 
 ReferenceCounted::ReferenceCounted()
 {
@@ -17,17 +16,7 @@ ReferenceCounted::~ReferenceCounted()
   m_uReferenceCountValid = ReferenceCountInvalidValue;
 }
 
-void ReferenceCounted::AddRef() const
+void ReferenceCounted::Destroy() const
 {
-  Y_AtomicIncrement(m_uReferenceCount);
-}
-
-uint32 ReferenceCounted::Release() const
-{
-  DebugAssert(m_uReferenceCount > 0 && m_uReferenceCountValid == ReferenceCountValidValue);
-  uint32 NewRefCount = Y_AtomicDecrement(m_uReferenceCount);
-  if (NewRefCount == 0)
-    delete const_cast<ReferenceCounted*>(this);
-
-  return NewRefCount;
+  delete const_cast<ReferenceCounted*>(this);
 }
@@ -0,0 +1,129 @@
+#include "YBaseLib/SHA1Digest.h"
+#include <cstring>
+
+static inline uint32 RotateLeft(uint32 value, uint32 count)
+{
+  return (value << count) | (value >> (32 - count));
+}
+
+static void SHA1Transform(uint32 state[5], const byte* pBlock)
+{
+  uint32 w[80];
+  for (uint32 i = 0; i < 16; i++)
+  {
+    w[i] = ((uint32)pBlock[i * 4] << 24) | ((uint32)pBlock[i * 4 + 1] << 16) | ((uint32)pBlock[i * 4 + 2] << 8) |
+           (uint32)pBlock[i * 4 + 3];
+  }
+  for (uint32 i = 16; i < 80; i++)
+    w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+  uint32 a = state[0];
+  uint32 b = state[1];
+  uint32 c = state[2];
+  uint32 d = state[3];
+  uint32 e = state[4];
+  for (uint32 i = 0; i < 80; i++)
+  {
+    uint32 f, k;
+    if (i < 20)
+    {
+      f = d ^ (b & (c ^ d));
+      k = 0x5A827999;
+    }
+    else if (i < 40)
+    {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    }
+    else if (i < 60)
+    {
+      f = (b & c) | (d & (b | c));
+      k = 0x8F1BBCDC;
+    }
+    else
+    {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+
+    uint32 temp = RotateLeft(a, 5) + f + e + k + w[i];
+    e = d;
+    d = c;
+    c = RotateLeft(b, 30);
+    b = a;
+    a = temp;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+SHA1Digest::SHA1Digest()
+{
+  Reset();
+}
+
+void SHA1Digest::Reset()
+{
+  m_state[0] = 0x67452301;
+  m_state[1] = 0xEFCDAB89;
+  m_state[2] = 0x98BADCFE;
+  m_state[3] = 0x10325476;
+  m_state[4] = 0xC3D2E1F0;
+  m_byteCount = 0;
+}
+
+void SHA1Digest::Update(const void* pData, size_t cbData)
+{
+  const byte* pByteData = reinterpret_cast<const byte*>(pData);
+  size_t blockBytes = (size_t)(m_byteCount & 63);
+  m_byteCount += cbData;
+
+  // top up a partly filled block first
+  if (blockBytes > 0)
+  {
+    size_t copyLength = Min(cbData, 64 - blockBytes);
+    std::memcpy(m_block + blockBytes, pByteData, copyLength);
+    if (blockBytes + copyLength < 64)
+      return;
+
+    SHA1Transform(m_state, m_block);
+    pByteData += copyLength;
+    cbData -= copyLength;
+  }
+
+  for (; cbData >= 64; pByteData += 64, cbData -= 64)
+    SHA1Transform(m_state, pByteData);
+
+  std::memcpy(m_block, pByteData, cbData);
+}
+
+void SHA1Digest::Final(byte Digest[DIGEST_SIZE])
+{
+  // a one bit, zeros to 56 mod 64, then the length in bits, big endian
+  uint64 bitCount = m_byteCount << 3;
+  size_t blockBytes = (size_t)(m_byteCount & 63);
+  m_block[blockBytes++] = 0x80;
+  if (blockBytes > 56)
+  {
+    std::memset(m_block + blockBytes, 0, 64 - blockBytes);
+    SHA1Transform(m_state, m_block);
+    blockBytes = 0;
+  }
+
+  std::memset(m_block + blockBytes, 0, 56 - blockBytes);
+  for (uint32 i = 0; i < 8; i++)
+    m_block[56 + i] = (byte)(bitCount >> (56 - i * 8));
+  SHA1Transform(m_state, m_block);
+
+  for (uint32 i = 0; i < 5; i++)
+  {
+    Digest[i * 4] = (byte)(m_state[i] >> 24);
+    Digest[i * 4 + 1] = (byte)(m_state[i] >> 16);
+    Digest[i * 4 + 2] = (byte)(m_state[i] >> 8);
+    Digest[i * 4 + 3] = (byte)m_state[i];
+  }
+}
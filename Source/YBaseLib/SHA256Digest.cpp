@@ -0,0 +1,286 @@
+#include "YBaseLib/SHA256Digest.h"
+#include "YBaseLib/CPUID.h"
+#include <cstring>
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <emmintrin.h>
+#include <immintrin.h>
+#define Y_SHA256_X86 1
+#if defined(Y_COMPILER_MSVC)
+#include <intrin.h>
+#define SHA256_X86_FUNCTION
+#else
+#define SHA256_X86_FUNCTION __attribute__((target("sha,sse4.1")))
+#endif
+#elif defined(Y_CPU_AARCH64) && (defined(Y_COMPILER_GCC) || defined(Y_COMPILER_CLANG))
+#include <arm_neon.h>
+#define Y_SHA256_ARM 1
+#if defined(Y_COMPILER_CLANG)
+#define SHA256_ARM_FUNCTION __attribute__((target("crypto")))
+#else
+#define SHA256_ARM_FUNCTION __attribute__((target("+crypto")))
+#endif
+#endif
+
+// the first 32 bits of the fractional parts of the cube roots of the first 64 primes
+static const uint32 s_roundConstants[64] = {
+  0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5, 0xD807AA98,
+  0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174, 0xE49B69C1, 0xEFBE4786,
+  0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA, 0x983E5152, 0xA831C66D, 0xB00327C8,
+  0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967, 0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+  0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85, 0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819,
+  0xD6990624, 0xF40E3585, 0x106AA070, 0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A,
+  0x5B9CCA4F, 0x682E6FF3, 0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7,
+  0xC67178F2};
+
+static inline uint32 RotateRight(uint32 value, uint32 count)
+{
+  return (value >> count) | (value << (32 - count));
+}
+
+static void SHA256TransformPortable(uint32 state[8], const byte* pBlocks, size_t blockCount)
+{
+  for (; blockCount > 0; pBlocks += 64, blockCount--)
+  {
+    uint32 w[64];
+    for (uint32 i = 0; i < 16; i++)
+    {
+      w[i] = ((uint32)pBlocks[i * 4] << 24) | ((uint32)pBlocks[i * 4 + 1] << 16) |
+             ((uint32)pBlocks[i * 4 + 2] << 8) | (uint32)pBlocks[i * 4 + 3];
+    }
+    for (uint32 i = 16; i < 64; i++)
+    {
+      uint32 s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32 s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32 a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32 e = state[4], f = state[5], g = state[6], h = state[7];
+    for (uint32 i = 0; i < 64; i++)
+    {
+      uint32 s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+      uint32 ch = g ^ (e & (f ^ g));
+      uint32 temp1 = h + s1 + ch + s_roundConstants[i] + w[i];
+      uint32 s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+      uint32 maj = (a & b) | (c & (a | b));
+      uint32 temp2 = s0 + maj;
+      h = g;
+      g = f;
+      f = e;
+      e = d + temp1;
+      d = c;
+      c = b;
+      b = a;
+      a = temp1 + temp2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+  }
+}
+
+#if defined(Y_SHA256_X86)
+
+// The SHA extensions keep the state as ABEF and CDGH, and do two rounds per sha256rnds2. Each group of four rounds
+// uses one of four message registers, which sha256msg1/msg2 extend to the messages for the groups to come.
+static SHA256_X86_FUNCTION void SHA256TransformX86(uint32 state[8], const byte* pBlocks, size_t blockCount)
+{
+  const __m128i byteSwapMask = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+  __m128i temp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+  __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+  __m128i state0 = _mm_alignr_epi8(temp, state1, 8);
+  state1 = _mm_blend_epi16(state1, temp, 0xF0);
+
+  for (; blockCount > 0; pBlocks += 64, blockCount--)
+  {
+    __m128i savedState0 = state0;
+    __m128i savedState1 = state1;
+
+    __m128i messages[4];
+    for (uint32 i = 0; i < 4; i++)
+    {
+      messages[i] =
+        _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pBlocks + i * 16)), byteSwapMask);
+    }
+
+    for (uint32 group = 0; group < 16; group++)
+    {
+      uint32 current = group & 3;
+      __m128i message = _mm_add_epi32(messages[current],
+                                      _mm_loadu_si128(reinterpret_cast<const __m128i*>(&s_roundConstants[group * 4])));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+      if (group >= 3 && group < 15)
+      {
+        uint32 next = (current + 1) & 3;
+        temp = _mm_alignr_epi8(messages[current], messages[(current + 3) & 3], 4);
+        messages[next] = _mm_sha256msg2_epu32(_mm_add_epi32(messages[next], temp), messages[current]);
+      }
+
+      state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(message, 0x0E));
+      if (group >= 1 && group < 13)
+      {
+        uint32 previous = (current + 3) & 3;
+        messages[previous] = _mm_sha256msg1_epu32(messages[previous], messages[current]);
+      }
+    }
+
+    state0 = _mm_add_epi32(state0, savedState0);
+    state1 = _mm_add_epi32(state1, savedState1);
+  }
+
+  temp = _mm_shuffle_epi32(state0, 0x1B);
+  state1 = _mm_shuffle_epi32(state1, 0xB1);
+  state0 = _mm_blend_epi16(temp, state1, 0xF0);
+  state1 = _mm_alignr_epi8(state1, temp, 8);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+// false until static initialization gets here, anything hashed before that uses the portable version
+static const bool s_useSHAExtensions = Y_CPUHasFeatures(Y_CPU_FEATURE_SHA);
+
+#elif defined(Y_SHA256_ARM)
+
+// four rounds per sha256h/h2 pair, with sha256su0/su1 extending each message register four groups ahead
+static SHA256_ARM_FUNCTION void SHA256TransformARM(uint32 state[8], const byte* pBlocks, size_t blockCount)
+{
+  uint32x4_t state0 = vld1q_u32(&state[0]);
+  uint32x4_t state1 = vld1q_u32(&state[4]);
+  for (; blockCount > 0; pBlocks += 64, blockCount--)
+  {
+    uint32x4_t savedState0 = state0;
+    uint32x4_t savedState1 = state1;
+
+    uint32x4_t messages[4];
+    for (uint32 i = 0; i < 4; i++)
+      messages[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(pBlocks + i * 16)));
+
+    for (uint32 group = 0; group < 16; group++)
+    {
+      uint32 current = group & 3;
+      uint32x4_t message = vaddq_u32(messages[current], vld1q_u32(&s_roundConstants[group * 4]));
+      if (group < 12)
+      {
+        messages[current] = vsha256su1q_u32(vsha256su0q_u32(messages[current], messages[(current + 1) & 3]),
+                                            messages[(current + 2) & 3], messages[(current + 3) & 3]);
+      }
+
+      uint32x4_t previousState0 = state0;
+      state0 = vsha256hq_u32(state0, state1, message);
+      state1 = vsha256h2q_u32(state1, previousState0, message);
+    }
+
+    state0 = vaddq_u32(state0, savedState0);
+    state1 = vaddq_u32(state1, savedState1);
+  }
+
+  vst1q_u32(&state[0], state0);
+  vst1q_u32(&state[4], state1);
+}
+
+static const bool s_useARMSHA2 = Y_CPUHasFeatures(Y_CPU_FEATURE_ARM_SHA2);
+
+#endif
+
+static void SHA256Transform(uint32 state[8], const byte* pBlocks, size_t blockCount)
+{
+#if defined(Y_SHA256_X86)
+  if (s_useSHAExtensions)
+  {
+    SHA256TransformX86(state, pBlocks, blockCount);
+    return;
+  }
+#elif defined(Y_SHA256_ARM)
+  if (s_useARMSHA2)
+  {
+    SHA256TransformARM(state, pBlocks, blockCount);
+    return;
+  }
+#endif
+
+  SHA256TransformPortable(state, pBlocks, blockCount);
+}
+
+SHA256Digest::SHA256Digest()
+{
+  Reset();
+}
+
+void SHA256Digest::Reset()
+{
+  m_state[0] = 0x6A09E667;
+  m_state[1] = 0xBB67AE85;
+  m_state[2] = 0x3C6EF372;
+  m_state[3] = 0xA54FF53A;
+  m_state[4] = 0x510E527F;
+  m_state[5] = 0x9B05688C;
+  m_state[6] = 0x1F83D9AB;
+  m_state[7] = 0x5BE0CD19;
+  m_byteCount = 0;
+}
+
+void SHA256Digest::Update(const void* pData, size_t cbData)
+{
+  const byte* pByteData = reinterpret_cast<const byte*>(pData);
+  size_t blockBytes = (size_t)(m_byteCount & 63);
+  m_byteCount += cbData;
+
+  // top up a partly filled block first
+  if (blockBytes > 0)
+  {
+    size_t copyLength = Min(cbData, 64 - blockBytes);
+    std::memcpy(m_block + blockBytes, pByteData, copyLength);
+    if (blockBytes + copyLength < 64)
+      return;
+
+    SHA256Transform(m_state, m_block, 1);
+    pByteData += copyLength;
+    cbData -= copyLength;
+  }
+
+  // whole blocks straight from the input
+  size_t blockCount = cbData / 64;
+  if (blockCount > 0)
+  {
+    SHA256Transform(m_state, pByteData, blockCount);
+    pByteData += blockCount * 64;
+    cbData -= blockCount * 64;
+  }
+
+  std::memcpy(m_block, pByteData, cbData);
+}
+
+void SHA256Digest::Final(byte Digest[DIGEST_SIZE])
+{
+  // a one bit, zeros to 56 mod 64, then the length in bits, big endian
+  uint64 bitCount = m_byteCount << 3;
+  size_t blockBytes = (size_t)(m_byteCount & 63);
+  m_block[blockBytes++] = 0x80;
+  if (blockBytes > 56)
+  {
+    std::memset(m_block + blockBytes, 0, 64 - blockBytes);
+    SHA256Transform(m_state, m_block, 1);
+    blockBytes = 0;
+  }
+
+  std::memset(m_block + blockBytes, 0, 56 - blockBytes);
+  for (uint32 i = 0; i < 8; i++)
+    m_block[56 + i] = (byte)(bitCount >> (56 - i * 8));
+  SHA256Transform(m_state, m_block, 1);
+
+  for (uint32 i = 0; i < 8; i++)
+  {
+    Digest[i * 4] = (byte)(m_state[i] >> 24);
+    Digest[i * 4 + 1] = (byte)(m_state[i] >> 16);
+    Digest[i * 4 + 2] = (byte)(m_state[i] >> 8);
+    Digest[i * 4 + 3] = (byte)m_state[i];
+  }
+}
@@ -0,0 +1,166 @@
+#include "YBaseLib/SPSCCircularBuffer.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/Platform.h"
+
+SPSCCircularBuffer::SPSCCircularBuffer(size_t bufferSize, bool mirrored /* = false */)
+  : m_pBuffer(nullptr), m_bufferSize(1), m_mask(0), m_mirrored(false)
+{
+  DebugAssert(bufferSize > 0);
+  while (m_bufferSize < bufferSize)
+    m_bufferSize *= 2;
+
+  if (mirrored)
+  {
+    // granularities are powers of two, so this stays one
+    m_bufferSize = Max(m_bufferSize, Platform::GetMirroredMemoryGranularity());
+    m_pBuffer = (byte*)Platform::AllocateMirroredMemory(m_bufferSize);
+    m_mirrored = (m_pBuffer != nullptr);
+  }
+  if (m_pBuffer == nullptr)
+  {
+    m_pBuffer = (byte*)std::malloc(m_bufferSize);
+    Assert(m_pBuffer != nullptr);
+  }
+
+  m_mask = m_bufferSize - 1;
+  m_write.Value = 0;
+  m_write.CachedOtherValue = 0;
+  m_read.Value = 0;
+  m_read.CachedOtherValue = 0;
+}
+
+SPSCCircularBuffer::~SPSCCircularBuffer()
+{
+  if (m_mirrored)
+    Platform::FreeMirroredMemory(m_pBuffer, m_bufferSize);
+  else
+    std::free(m_pBuffer);
+}
+
+size_t SPSCCircularBuffer::GetBufferUsed() const
+{
+  // read the consumer's position first, so the difference can't go negative
+  size_t readPosition = Y_AtomicLoadAcquire(m_read.Value);
+  size_t writePosition = Y_AtomicLoadAcquire(m_write.Value);
+  return writePosition - readPosition;
+}
+
+size_t SPSCCircularBuffer::GetContiguousBufferSpace()
+{
+  size_t writePosition = m_write.Value;
+  size_t space = m_bufferSize - (writePosition - m_write.CachedOtherValue);
+  if (space < m_bufferSize)
+  {
+    m_write.CachedOtherValue = Y_AtomicLoadAcquire(m_read.Value);
+    space = m_bufferSize - (writePosition - m_write.CachedOtherValue);
+  }
+
+  return GetContiguousLength(writePosition, space);
+}
+
+bool SPSCCircularBuffer::GetWritePointer(void** ppWritePointer, size_t* pByteCount)
+{
+  size_t requiredBytes = *pByteCount;
+  size_t writePosition = m_write.Value;
+  size_t space = GetContiguousLength(writePosition, m_bufferSize - (writePosition - m_write.CachedOtherValue));
+  if (space < requiredBytes || space == 0)
+  {
+    // only go to the consumer's cache line when our copy of its position doesn't leave enough room
+    m_write.CachedOtherValue = Y_AtomicLoadAcquire(m_read.Value);
+    space = GetContiguousLength(writePosition, m_bufferSize - (writePosition - m_write.CachedOtherValue));
+    if (space < requiredBytes || space == 0)
+      return false;
+  }
+
+  *ppWritePointer = m_pBuffer + (writePosition & m_mask);
+  *pByteCount = space;
+  return true;
+}
+
+void SPSCCircularBuffer::MoveWritePointer(size_t byteCount)
+{
+  size_t writePosition = m_write.Value;
+  DebugAssert(byteCount <= m_bufferSize - (writePosition - m_write.CachedOtherValue));
+
+  // the data has to be visible before the new position
+  Y_AtomicStoreRelease(m_write.Value, writePosition + byteCount);
+}
+
+size_t SPSCCircularBuffer::GetContiguousUsedBytes()
+{
+  size_t readPosition = m_read.Value;
+  size_t used = m_read.CachedOtherValue - readPosition;
+  if (used < m_bufferSize)
+  {
+    m_read.CachedOtherValue = Y_AtomicLoadAcquire(m_write.Value);
+    used = m_read.CachedOtherValue - readPosition;
+  }
+
+  return GetContiguousLength(readPosition, used);
+}
+
+bool SPSCCircularBuffer::GetReadPointer(const void** ppReadPointer, size_t* pByteCount)
+{
+  size_t readPosition = m_read.Value;
+  if (m_read.CachedOtherValue == readPosition)
+  {
+    m_read.CachedOtherValue = Y_AtomicLoadAcquire(m_write.Value);
+    if (m_read.CachedOtherValue == readPosition)
+      return false;
+  }
+
+  *ppReadPointer = m_pBuffer + (readPosition & m_mask);
+  *pByteCount = GetContiguousLength(readPosition, m_read.CachedOtherValue - readPosition);
+  return true;
+}
+
+void SPSCCircularBuffer::MoveReadPointer(size_t byteCount)
+{
+  size_t readPosition = m_read.Value;
+  DebugAssert(byteCount <= m_read.CachedOtherValue - readPosition);
+
+  // reads of the data have to finish before the producer can overwrite it
+  Y_AtomicStoreRelease(m_read.Value, readPosition + byteCount);
+}
+
+bool SPSCCircularBuffer::Read(void* pDestination, size_t byteCount)
+{
+  size_t readPosition = m_read.Value;
+  if (byteCount > m_read.CachedOtherValue - readPosition)
+  {
+    m_read.CachedOtherValue = Y_AtomicLoadAcquire(m_write.Value);
+    if (byteCount > m_read.CachedOtherValue - readPosition)
+      return false;
+  }
+
+  // at most two copies, the second from the start of the buffer
+  size_t offset = readPosition & m_mask;
+  size_t firstCount = GetContiguousLength(readPosition, byteCount);
+  std::memcpy(pDestination, m_pBuffer + offset, firstCount);
+  if (firstCount < byteCount)
+    std::memcpy(reinterpret_cast<byte*>(pDestination) + firstCount, m_pBuffer, byteCount - firstCount);
+
+  Y_AtomicStoreRelease(m_read.Value, readPosition + byteCount);
+  return true;
+}
+
+bool SPSCCircularBuffer::Write(const void* pSource, size_t byteCount)
+{
+  size_t writePosition = m_write.Value;
+  if (byteCount > m_bufferSize - (writePosition - m_write.CachedOtherValue))
+  {
+    m_write.CachedOtherValue = Y_AtomicLoadAcquire(m_read.Value);
+    if (byteCount > m_bufferSize - (writePosition - m_write.CachedOtherValue))
+      return false;
+  }
+
+  size_t offset = writePosition & m_mask;
+  size_t firstCount = GetContiguousLength(writePosition, byteCount);
+  std::memcpy(m_pBuffer + offset, pSource, firstCount);
+  if (firstCount < byteCount)
+    std::memcpy(m_pBuffer, reinterpret_cast<const byte*>(pSource) + firstCount, byteCount - firstCount);
+
+  Y_AtomicStoreRelease(m_write.Value, writePosition + byteCount);
+  return true;
+}
@@ -0,0 +1,123 @@
+#include "YBaseLib/SchedulerStats.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Memory.h"
+
+void LatencyHistogram::Reset()
+{
+  Y_memzero(m_buckets, sizeof(m_buckets));
+  m_count = 0;
+  m_total = 0;
+  m_min = 0;
+  m_max = 0;
+}
+
+uint32 LatencyHistogram::GetBucketIndex(uint64 value)
+{
+  if (value < SubBucketCount)
+    return static_cast<uint32>(value);
+
+  // the top bit picks the power of two, the bits below it the sub-bucket
+  uint64 topBit;
+  Y_bitscanreverse(value, &topBit);
+  uint32 shift = static_cast<uint32>(topBit) - SubBucketBits;
+  uint32 subBucket = static_cast<uint32>(value >> shift) & (SubBucketCount - 1);
+  return (shift + 1) * SubBucketCount + subBucket;
+}
+
+uint64 LatencyHistogram::GetBucketUpperBound(uint32 index)
+{
+  DebugAssert(index < BucketCount);
+  if (index < SubBucketCount)
+    return index;
+
+  uint32 shift = index / SubBucketCount - 1;
+  uint64 lowerBound = static_cast<uint64>(SubBucketCount + index % SubBucketCount) << shift;
+  return lowerBound + (((uint64)1 << shift) - 1);
+}
+
+void LatencyHistogram::Record(Y_TIMER_VALUE value)
+{
+  uint64 ticks = static_cast<uint64>(value);
+  m_buckets[GetBucketIndex(ticks)]++;
+  m_total += value;
+  m_min = (m_count == 0) ? value : Min(m_min, value);
+  m_max = Max(m_max, value);
+  m_count++;
+}
+
+void LatencyHistogram::Accumulate(const LatencyHistogram& other)
+{
+  if (other.m_count == 0)
+    return;
+
+  for (uint32 i = 0; i < BucketCount; i++)
+    m_buckets[i] += other.m_buckets[i];
+
+  m_min = (m_count == 0) ? other.m_min : Min(m_min, other.m_min);
+  m_max = Max(m_max, other.m_max);
+  m_total += other.m_total;
+  m_count += other.m_count;
+}
+
+Y_TIMER_VALUE LatencyHistogram::GetPercentile(double percentile) const
+{
+  if (m_count == 0)
+    return 0;
+
+  // rank of the value we're after, at least the first one
+  uint64 rank = static_cast<uint64>((double)m_count * Min(Max(percentile, 0.0), 100.0) / 100.0 + 0.5);
+  rank = Max(rank, (uint64)1);
+
+  uint64 seen = 0;
+  for (uint32 i = 0; i < BucketCount; i++)
+  {
+    seen += m_buckets[i];
+    if (seen >= rank)
+      return Min(static_cast<Y_TIMER_VALUE>(GetBucketUpperBound(i)), m_max);
+  }
+
+  return m_max;
+}
+
+double LatencyHistogram::GetMeanMilliseconds() const
+{
+  return (m_count > 0) ? (Y_TimerConvertToMilliseconds(m_total) / (double)m_count) : 0.0;
+}
+
+void SchedulerWorkerStats::Reset()
+{
+  TasksExecuted = 0;
+  BusyTime = 0;
+  MaxQueueDepth = 0;
+  QueueTime.Reset();
+  ExecutionTime.Reset();
+}
+
+void SchedulerWorkerStats::Accumulate(const SchedulerWorkerStats& other)
+{
+  TasksExecuted += other.TasksExecuted;
+  BusyTime += other.BusyTime;
+  MaxQueueDepth = Max(MaxQueueDepth, other.MaxQueueDepth);
+  QueueTime.Accumulate(other.QueueTime);
+  ExecutionTime.Accumulate(other.ExecutionTime);
+}
+
+void SchedulerWorkerStats::RecordTask(Y_TIMER_VALUE queueTime, Y_TIMER_VALUE startTime, Y_TIMER_VALUE endTime,
+                                      uint32 queueDepth)
+{
+  TasksExecuted++;
+  BusyTime += endTime - startTime;
+  MaxQueueDepth = Max(MaxQueueDepth, queueDepth);
+  if (queueTime != 0 && startTime >= queueTime)
+    QueueTime.Record(startTime - queueTime);
+
+  ExecutionTime.Record(endTime - startTime);
+}
+
+double SchedulerStats::GetUtilization() const
+{
+  if (ElapsedTime == 0 || WorkerCount == 0)
+    return 0.0;
+
+  return (double)Totals.BusyTime / ((double)ElapsedTime * (double)WorkerCount);
+}
@@ -0,0 +1,305 @@
+#include "YBaseLib/Sockets/ConnectionPool.h"
+#include "YBaseLib/Sockets/StreamSocket.h"
+
+const uint32 ConnectionPool::DefaultMaxConnectionsPerHost;
+const uint32 ConnectionPool::DefaultIdleTimeout;
+
+ConnectionPool::ConnectionPool(SocketMultiplexer* pMultiplexer, CreateStreamSocketCallback createCallback,
+                               uint32 maxConnectionsPerHost /*= DefaultMaxConnectionsPerHost*/,
+                               uint32 idleTimeout /*= DefaultIdleTimeout*/)
+  : m_pMultiplexer(pMultiplexer), m_createCallback(createCallback), m_maxConnectionsPerHost(maxConnectionsPerHost),
+    m_idleTimeout(idleTimeout), m_fastOpen(false)
+{
+  DebugAssert(maxConnectionsPerHost > 0);
+}
+
+ConnectionPool::~ConnectionPool()
+{
+  // with nothing acquired there's nothing waiting either, as requests only wait on connections that are out
+  DebugAssert(m_acquiredConnections.GetMemberCount() == 0);
+  CloseIdleConnections();
+
+  for (HostTable::Iterator itr = m_hosts.Begin(); itr != m_hosts.End(); ++itr)
+  {
+    Host* pHost = itr->Value;
+    while (pHost->pWaitingHead != nullptr)
+    {
+      Waiter* pWaiter = pHost->pWaitingHead;
+      pHost->pWaitingHead = pWaiter->pNext;
+
+      Error error;
+      error.SetErrorUserStatic(0, "Connection pool destroyed.");
+      pWaiter->Callback(nullptr, &error);
+      delete pWaiter;
+    }
+
+    delete pHost;
+  }
+}
+
+ConnectionPool::Host* ConnectionPool::GetHost(const SocketAddress* pAddress)
+{
+  HostTable::Member* pMember = m_hosts.Find(*pAddress);
+  if (pMember != nullptr)
+    return pMember->Value;
+
+  Host* pHost = new Host();
+  pHost->Address = *pAddress;
+  pHost->ActiveCount = 0;
+  pHost->pWaitingHead = nullptr;
+  pHost->pWaitingTail = nullptr;
+  m_hosts.Insert(*pAddress, pHost);
+  return pHost;
+}
+
+StreamSocket* ConnectionPool::Acquire(const SocketAddress* pAddress, Error* pError)
+{
+  m_lock.Lock();
+  Host* pHost = GetHost(pAddress);
+  if (pHost->ActiveCount >= m_maxConnectionsPerHost)
+  {
+    m_lock.Unlock();
+    if (pError != nullptr)
+      pError->SetErrorUserStatic(0, "Too many connections to host.");
+
+    return nullptr;
+  }
+
+  pHost->ActiveCount++;
+  m_lock.Unlock();
+
+  StreamSocket* pSocket = TakeConnection(pHost, pError);
+  if (pSocket == nullptr)
+    ReleaseSlot(pHost);
+
+  return pSocket;
+}
+
+void ConnectionPool::Acquire(const SocketAddress* pAddress, AcquireFunction callback)
+{
+  m_lock.Lock();
+  Host* pHost = GetHost(pAddress);
+  if (pHost->ActiveCount >= m_maxConnectionsPerHost)
+  {
+    Waiter* pWaiter = new Waiter(std::move(callback));
+    if (pHost->pWaitingTail != nullptr)
+      pHost->pWaitingTail->pNext = pWaiter;
+    else
+      pHost->pWaitingHead = pWaiter;
+    pHost->pWaitingTail = pWaiter;
+    m_lock.Unlock();
+    return;
+  }
+
+  pHost->ActiveCount++;
+  m_lock.Unlock();
+
+  // the slot goes to whoever's waiting before the callback, which may well acquire again
+  Error error;
+  StreamSocket* pSocket = TakeConnection(pHost, &error);
+  if (pSocket == nullptr)
+    ReleaseSlot(pHost);
+
+  callback(pSocket, &error);
+}
+
+StreamSocket* ConnectionPool::TakeConnection(Host* pHost, Error* pError)
+{
+  PODArray<StreamSocket*> staleSockets;
+  StreamSocket* pSocket = nullptr;
+
+  m_lock.Lock();
+  while (!pHost->IdleConnections.IsEmpty())
+  {
+    // if the newest has been idle too long, so have the rest
+    IdleConnection idleConnection = pHost->IdleConnections.PopBack();
+    if (m_timer.GetTimeMilliseconds() - idleConnection.ReleaseTime > (double)m_idleTimeout)
+    {
+      staleSockets.Add(idleConnection.pSocket);
+      while (!pHost->IdleConnections.IsEmpty())
+        staleSockets.Add(pHost->IdleConnections.PopBack().pSocket);
+
+      break;
+    }
+
+    // the check takes the socket's lock, which handlers hold while releasing into the pool, so it's made without ours
+    m_lock.Unlock();
+    if (idleConnection.pSocket->IsReusable())
+    {
+      pSocket = idleConnection.pSocket;
+      m_lock.Lock();
+      break;
+    }
+
+    staleSockets.Add(idleConnection.pSocket);
+    m_lock.Lock();
+  }
+  m_lock.Unlock();
+
+  CloseConnections(staleSockets);
+
+  if (pSocket == nullptr)
+  {
+    pSocket = m_pMultiplexer->InternalConnectStreamSocket(&pHost->Address, m_createCallback, pError, m_fastOpen);
+    if (pSocket == nullptr)
+      return nullptr;
+  }
+
+  m_lock.Lock();
+  m_acquiredConnections.Insert(pSocket, pHost);
+  m_lock.Unlock();
+  return pSocket;
+}
+
+void ConnectionPool::ReleaseSlot(Host* pHost)
+{
+  for (;;)
+  {
+    m_lock.Lock();
+    Waiter* pWaiter = pHost->pWaitingHead;
+    if (pWaiter == nullptr)
+    {
+      pHost->ActiveCount--;
+      m_lock.Unlock();
+      return;
+    }
+
+    pHost->pWaitingHead = pWaiter->pNext;
+    if (pHost->pWaitingHead == nullptr)
+      pHost->pWaitingTail = nullptr;
+    m_lock.Unlock();
+
+    Error error;
+    StreamSocket* pSocket = TakeConnection(pHost, &error);
+    pWaiter->Callback(pSocket, &error);
+    delete pWaiter;
+
+    // a failed connect leaves the slot free for the next
+    if (pSocket != nullptr)
+      return;
+  }
+}
+
+void ConnectionPool::Release(StreamSocket* pSocket, bool reusable /*= true*/)
+{
+  m_lock.Lock();
+  HashTable<StreamSocket*, Host*>::Member* pMember = m_acquiredConnections.Find(pSocket);
+  DebugAssert(pMember != nullptr);
+  Host* pHost = pMember->Value;
+  m_acquiredConnections.Remove(pMember);
+
+  if (reusable && pSocket->IsConnected())
+  {
+    // straight to the next request, it's still counted as out
+    Waiter* pWaiter = pHost->pWaitingHead;
+    if (pWaiter != nullptr)
+    {
+      pHost->pWaitingHead = pWaiter->pNext;
+      if (pHost->pWaitingHead == nullptr)
+        pHost->pWaitingTail = nullptr;
+      m_acquiredConnections.Insert(pSocket, pHost);
+      m_lock.Unlock();
+
+      Error error;
+      pWaiter->Callback(pSocket, &error);
+      delete pWaiter;
+      return;
+    }
+
+    IdleConnection idleConnection;
+    idleConnection.pSocket = pSocket;
+    idleConnection.ReleaseTime = m_timer.GetTimeMilliseconds();
+    pHost->IdleConnections.Add(idleConnection);
+    pHost->ActiveCount--;
+    m_lock.Unlock();
+    return;
+  }
+
+  m_lock.Unlock();
+
+  pSocket->Close();
+  pSocket->Release();
+  ReleaseSlot(pHost);
+}
+
+void ConnectionPool::PruneIdleConnections()
+{
+  PODArray<StreamSocket*> staleSockets;
+
+  m_lock.Lock();
+  double currentTime = m_timer.GetTimeMilliseconds();
+  for (HostTable::Iterator itr = m_hosts.Begin(); itr != m_hosts.End();)
+  {
+    HostTable::Member* pMember = const_cast<HostTable::Member*>(&(*itr));
+    ++itr;
+
+    Host* pHost = pMember->Value;
+    for (uint32 i = 0; i < pHost->IdleConnections.GetSize();)
+    {
+      const IdleConnection& idleConnection = pHost->IdleConnections[i];
+      if (currentTime - idleConnection.ReleaseTime > (double)m_idleTimeout || !idleConnection.pSocket->IsConnected())
+      {
+        staleSockets.Add(idleConnection.pSocket);
+        pHost->IdleConnections.OrderedRemove(i);
+        continue;
+      }
+
+      i++;
+    }
+
+    if (pHost->IdleConnections.IsEmpty() && pHost->ActiveCount == 0 && pHost->pWaitingHead == nullptr)
+    {
+      m_hosts.Remove(pMember);
+      delete pHost;
+    }
+  }
+  m_lock.Unlock();
+
+  CloseConnections(staleSockets);
+}
+
+void ConnectionPool::CloseIdleConnections()
+{
+  PODArray<StreamSocket*> idleSockets;
+
+  m_lock.Lock();
+  for (HostTable::Iterator itr = m_hosts.Begin(); itr != m_hosts.End(); ++itr)
+  {
+    Host* pHost = itr->Value;
+    for (const IdleConnection& idleConnection : pHost->IdleConnections)
+      idleSockets.Add(idleConnection.pSocket);
+    pHost->IdleConnections.Clear();
+  }
+  m_lock.Unlock();
+
+  CloseConnections(idleSockets);
+}
+
+uint32 ConnectionPool::GetIdleConnectionCount()
+{
+  uint32 count = 0;
+  m_lock.Lock();
+  for (HostTable::Iterator itr = m_hosts.Begin(); itr != m_hosts.End(); ++itr)
+    count += itr->Value->IdleConnections.GetSize();
+  m_lock.Unlock();
+  return count;
+}
+
+uint32 ConnectionPool::GetActiveConnectionCount()
+{
+  uint32 count = 0;
+  m_lock.Lock();
+  for (HostTable::Iterator itr = m_hosts.Begin(); itr != m_hosts.End(); ++itr)
+    count += itr->Value->ActiveCount;
+  m_lock.Unlock();
+  return count;
+}
+
+void ConnectionPool::CloseConnections(const PODArray<StreamSocket*>& sockets)
+{
+  for (StreamSocket* pSocket : sockets)
+  {
+    pSocket->Close();
+    pSocket->Release();
+  }
+}
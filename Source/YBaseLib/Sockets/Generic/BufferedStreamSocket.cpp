@@ -17,13 +17,88 @@ Log_SetChannel(BufferedStreamSocket);
 #define SIZE_CAST(x) static_cast<int>(x)
 #endif
 
+// Sends the buffers in order with one call, no more than maxBytes of them, returning the bytes sent, which is 0 when
+// the socket would block, or -1 on error. The call is counted in the socket's stats.
+static ssize_t SendBuffers(SOCKET fileDescriptor, const void* const* ppBuffers, const size_t* pBufferLengths,
+                           size_t numBuffers, size_t maxBytes, SocketStats* pStats)
+{
+#ifdef Y_PLATFORM_WINDOWS
+  WSABUF* bufs = (WSABUF*)alloca(sizeof(WSABUF) * numBuffers);
+  DWORD count = 0;
+  for (size_t i = 0; i < numBuffers && maxBytes > 0; i++)
+  {
+    size_t length = Min(pBufferLengths[i], maxBytes);
+    bufs[count].buf = (CHAR*)ppBuffers[i];
+    bufs[count++].len = (ULONG)length;
+    maxBytes -= length;
+  }
+
+  DWORD bytesSent = 0;
+  if (WSASend(fileDescriptor, bufs, count, &bytesSent, 0, nullptr, nullptr) == SOCKET_ERROR)
+  {
+    pStats->RecordSend(-1);
+    if (WSAGetLastError() != WSAEWOULDBLOCK)
+      return -1;
+
+    pStats->SendWouldBlock++;
+    return 0;
+  }
+
+  pStats->RecordSend((int64)bytesSent);
+  return (ssize_t)bytesSent;
+
+#else // Y_PLATFORM_WINDOWS
+
+  iovec* bufs = (iovec*)alloca(sizeof(iovec) * numBuffers);
+  int count = 0;
+  for (size_t i = 0; i < numBuffers && maxBytes > 0; i++)
+  {
+    size_t length = Min(pBufferLengths[i], maxBytes);
+    bufs[count].iov_base = (void*)ppBuffers[i];
+    bufs[count++].iov_len = length;
+    maxBytes -= length;
+  }
+
+  ssize_t res = writev(fileDescriptor, bufs, count);
+  pStats->RecordSend(res);
+  if (res < 0)
+  {
+    // EINPROGRESS is a fast open connect's first send going out as a plain SYN, the data waits for the connection
+    if (errno != EAGAIN && errno != EINPROGRESS)
+      return -1;
+
+    pStats->SendWouldBlock++;
+    return 0;
+  }
+
+  return res;
+
+#endif // Y_PLATFORM_WINDOWS
+}
+
 BufferedStreamSocket::BufferedStreamSocket(size_t receiveBufferSize /*= 16384*/, size_t sendBufferSize /*= 16384*/)
-  : m_receiveBuffer(receiveBufferSize), m_sendBuffer(sendBufferSize)
+  : m_receiveBuffer(receiveBufferSize), m_sendBuffer(sendBufferSize), m_receiveMode(ReceiveMode_Buffered),
+    m_corkCount(0), m_writeNotificationsEnabled(false), m_throttleTimer(OnThrottleTimer, this),
+    m_sendThrottled(false), m_writeDeficit(0)
 {
 }
 
 BufferedStreamSocket::~BufferedStreamSocket() {}
 
+void BufferedStreamSocket::SetSendRateLimit(uint64 bytesPerSecond, uint64 burstBytes /*= 0*/)
+{
+  m_lock.Lock();
+  m_sendRateLimiter.SetRate(bytesPerSecond, burstBytes);
+  m_lock.Unlock();
+}
+
+void BufferedStreamSocket::SetReceiveMode(ReceiveMode mode)
+{
+  m_lock.Lock();
+  m_receiveMode = mode;
+  m_lock.Unlock();
+}
+
 size_t BufferedStreamSocket::Read(void* pBuffer, size_t bufferSize)
 {
   m_lock.Lock();
@@ -44,43 +119,45 @@ size_t BufferedStreamSocket::Write(const void* pBuffer, size_t bufferSize)
 {
   m_lock.Lock();
 
-  // Write buffer currently being used?
-  // Don't send out-of-order, push to the write buffer.
-  size_t writtenBytes = 0;
-  if (m_sendBuffer.GetBufferUsed() == 0)
+  if (!m_connected)
   {
-    // Send as many bytes as possible immediately. If this fails, push to the write buffer.
-    ssize_t res = send(m_fileDescriptor, (const char*)pBuffer, SIZE_CAST(bufferSize), 0);
-    writtenBytes = (size_t)Max(res, (ssize_t)0);
+    m_lock.Unlock();
+    return 0;
+  }
 
-    // Socket error?
-    if (res < 0 && WSAGetLastError() != WSAEWOULDBLOCK)
+  size_t writtenBytes;
+  if (m_corkCount > 0)
+  {
+    writtenBytes = WriteCorked(pBuffer, bufferSize);
+  }
+  else
+  {
+    // Write buffer currently being used?
+    // Don't send out-of-order, push to the write buffer.
+    writtenBytes = 0;
+    size_t allowance = (m_sendBuffer.GetBufferUsed() == 0) ? GetSendAllowance() : 0;
+    if (allowance > 0)
     {
-      CloseWithError();
-      m_lock.Unlock();
-      return 0;
+      // Send as many bytes as possible immediately. If this fails, push to the write buffer.
+      ssize_t res = SendBuffers(m_fileDescriptor, &pBuffer, &bufferSize, 1, allowance, &m_stats);
+      if (res < 0)
+      {
+        // Socket error.
+        CloseWithError();
+        m_lock.Unlock();
+        return 0;
+      }
+
+      writtenBytes = (size_t)res;
+      ConsumeSendAllowance(writtenBytes);
     }
-  }
 
-  // Any bytes left over?
-  if (writtenBytes < bufferSize)
-  {
-    // Copy remaining bytes into write buffer, and register for write notifications.
-    size_t bytesRemaining = bufferSize - writtenBytes;
-    size_t bufferSpace = m_sendBuffer.GetContiguousBufferSpace();
-    bool registerForWrites = (m_sendBuffer.GetBufferUsed() == 0);
-
-    // Write to buffer.
-    size_t bytesToWriteToBuffer = Min(bufferSpace, bytesRemaining);
-    if (m_sendBuffer.Write((const byte*)pBuffer + writtenBytes, bytesToWriteToBuffer))
-      writtenBytes += bytesToWriteToBuffer;
-
-    // Register for write notifications.
-    if (registerForWrites)
-      m_pMultiplexer->SetNotificationMask(this, m_fileDescriptor,
-                                          SocketMultiplexer::EventType_Read | SocketMultiplexer::EventType_Write);
+    // Copy remaining bytes into write buffer.
+    writtenBytes += BufferBytes((const byte*)pBuffer + writtenBytes, bufferSize - writtenBytes);
   }
 
+  // Register for write notifications if anything is left.
+  UpdateWriteNotification();
   m_lock.Unlock();
   return writtenBytes;
 }
@@ -95,64 +172,43 @@ size_t BufferedStreamSocket::WriteVector(const void** ppBuffers, const size_t* p
     return 0;
   }
 
-  // Write buffer currently being used?
-  // Don't send out-of-order, push to the write buffer.
+  // Corked writes are held back in order, each like a separate write.
   size_t writtenBytes = 0;
-  if (m_sendBuffer.GetBufferUsed() == 0)
+  if (m_corkCount > 0)
   {
-#ifdef Y_PLATFORM_WINDOWS
-    WSABUF* bufs = (WSABUF*)alloca(sizeof(WSABUF) * numBuffers);
-    for (size_t i = 0; i < numBuffers; i++)
-    {
-      bufs[i].buf = (CHAR*)ppBuffers[i];
-      bufs[i].len = (ULONG)pBufferLengths[i];
-    }
-
-    DWORD bytesSent = 0;
-    if (WSASend(m_fileDescriptor, bufs, (DWORD)numBuffers, &bytesSent, 0, nullptr, nullptr) == SOCKET_ERROR)
+    for (size_t i = 0; i < numBuffers && m_connected; i++)
     {
-      if (WSAGetLastError() != WSAEWOULDBLOCK)
-      {
-        // Socket error.
-        CloseWithError();
-        m_lock.Unlock();
-        return 0;
-      }
+      size_t bytesWritten = WriteCorked(ppBuffers[i], pBufferLengths[i]);
+      writtenBytes += bytesWritten;
+      if (bytesWritten < pBufferLengths[i])
+        break;
     }
 
-    writtenBytes = (size_t)bytesSent;
-
-#else // Y_PLATFORM_WINDOWS
-
-    iovec* bufs = (iovec*)alloca(sizeof(iovec) * numBuffers);
-    for (size_t i = 0; i < numBuffers; i++)
-    {
-      bufs[i].iov_base = (void*)ppBuffers[i];
-      bufs[i].iov_len = pBufferLengths[i];
-    }
+    UpdateWriteNotification();
+    m_lock.Unlock();
+    return writtenBytes;
+  }
 
-    ssize_t res = writev(m_fileDescriptor, bufs, numBuffers);
+  // Write buffer currently being used?
+  // Don't send out-of-order, push to the write buffer.
+  size_t allowance = (m_sendBuffer.GetBufferUsed() == 0) ? GetSendAllowance() : 0;
+  if (allowance > 0)
+  {
+    ssize_t res = SendBuffers(m_fileDescriptor, ppBuffers, pBufferLengths, numBuffers, allowance, &m_stats);
     if (res < 0)
     {
-      if (errno != EAGAIN)
-      {
-        // Socket error.
-        CloseWithError();
-        m_lock.Unlock();
-        return 0;
-      }
-
-      res = 0;
+      // Socket error.
+      CloseWithError();
+      m_lock.Unlock();
+      return 0;
     }
 
     writtenBytes = (size_t)res;
-
-#endif // Y_PLATFORM_WINDOWS
+    ConsumeSendAllowance(writtenBytes);
   }
 
   // Find the buffer that we got up to
   size_t currentOffset = 0;
-  bool registerForWrites = false;
   for (size_t i = 0; i < numBuffers; i++)
   {
     // Was this buffer only partially completed?
@@ -162,17 +218,12 @@ size_t BufferedStreamSocket::WriteVector(const void** ppBuffers, const size_t* p
       continue;
     }
 
-    // Copy remaining bytes into write buffer, and register for write notifications.
+    // Copy remaining bytes into write buffer.
     size_t bytesWrittenInBuffer = (writtenBytes - currentOffset);
     size_t bytesRemainingInBuffer = pBufferLengths[i] - bytesWrittenInBuffer;
-    size_t bufferSpace = m_sendBuffer.GetContiguousBufferSpace();
-    if (m_sendBuffer.GetBufferUsed() == 0)
-      registerForWrites = true;
-
-    // Write to buffer.
-    size_t bytesToWriteToBuffer = Min(bytesRemainingInBuffer, bufferSpace);
-    if (m_sendBuffer.Write((const byte*)ppBuffers[i] + bytesWrittenInBuffer, bytesToWriteToBuffer))
-      writtenBytes += bytesToWriteToBuffer;
+    size_t bytesToWriteToBuffer =
+      BufferBytes((const byte*)ppBuffers[i] + bytesWrittenInBuffer, bytesRemainingInBuffer);
+    writtenBytes += bytesToWriteToBuffer;
 
     // Was this a complete write?
     if (bytesToWriteToBuffer == bytesRemainingInBuffer)
@@ -182,14 +233,182 @@ size_t BufferedStreamSocket::WriteVector(const void** ppBuffers, const size_t* p
   }
 
   // Register for write notifications.
-  if (registerForWrites)
-    m_pMultiplexer->SetNotificationMask(this, m_fileDescriptor,
-                                        SocketMultiplexer::EventType_Read | SocketMultiplexer::EventType_Write);
-
+  UpdateWriteNotification();
   m_lock.Unlock();
   return writtenBytes;
 }
 
+void BufferedStreamSocket::Cork()
+{
+  m_lock.Lock();
+  m_corkCount++;
+  m_lock.Unlock();
+}
+
+void BufferedStreamSocket::Uncork()
+{
+  m_lock.Lock();
+  DebugAssert(m_corkCount > 0);
+
+  // the socket may have closed while corked, leaving nothing to send to
+  m_corkCount--;
+  if (m_corkCount == 0 && m_connected && m_sendBuffer.GetBufferUsed() > 0)
+  {
+    // writers that ran out of room while corked can carry on, as the buffer may now be empty with nothing to wait on
+    if (FlushSendBuffer(nullptr, 0, nullptr))
+    {
+      OnSendBufferSpace();
+      UpdateWriteNotification();
+    }
+  }
+
+  m_lock.Unlock();
+}
+
+size_t BufferedStreamSocket::WriteCorked(const void* pBuffer, size_t bufferSize)
+{
+  // Flush when the write doesn't fit. Payloads as big as the buffer go out behind what's buffered, in the same
+  // send, instead of being copied.
+  size_t writtenBytes = 0;
+  if (bufferSize > m_sendBuffer.GetContiguousBufferSpace() || bufferSize >= m_sendBuffer.GetBufferSize())
+  {
+    bool sendPayload = (bufferSize >= m_sendBuffer.GetBufferSize());
+    if (!FlushSendBuffer(sendPayload ? pBuffer : nullptr, sendPayload ? bufferSize : 0, &writtenBytes))
+      return 0;
+  }
+
+  return writtenBytes + BufferBytes((const byte*)pBuffer + writtenBytes, bufferSize - writtenBytes);
+}
+
+size_t BufferedStreamSocket::BufferBytes(const void* pBuffer, size_t bufferSize)
+{
+  size_t bytesToWriteToBuffer = Min(m_sendBuffer.GetContiguousBufferSpace(), bufferSize);
+  if (bytesToWriteToBuffer == 0 || !m_sendBuffer.Write(pBuffer, bytesToWriteToBuffer))
+    return 0;
+
+  return bytesToWriteToBuffer;
+}
+
+bool BufferedStreamSocket::FlushSendBuffer(const void* pPayload, size_t payloadSize, size_t* pPayloadBytesSent,
+                                           size_t maxBytes /*= SIZE_MAX*/)
+{
+  const void* ppBuffers[3];
+  size_t bufferLengths[3];
+  size_t numBuffers = 0;
+  size_t bufferedBytes = 0;
+
+  const void* pFirst;
+  const void* pSecond;
+  size_t firstLength, secondLength;
+  if (m_sendBuffer.GetReadPointers(&pFirst, &firstLength, &pSecond, &secondLength))
+  {
+    ppBuffers[numBuffers] = pFirst;
+    bufferLengths[numBuffers++] = firstLength;
+    if (secondLength > 0)
+    {
+      ppBuffers[numBuffers] = pSecond;
+      bufferLengths[numBuffers++] = secondLength;
+    }
+
+    bufferedBytes = firstLength + secondLength;
+  }
+  if (payloadSize > 0)
+  {
+    ppBuffers[numBuffers] = pPayload;
+    bufferLengths[numBuffers++] = payloadSize;
+  }
+
+  if (pPayloadBytesSent != nullptr)
+    *pPayloadBytesSent = 0;
+  if (numBuffers == 0)
+    return true;
+
+  // held back by the rate limits, it's as if the socket would block
+  maxBytes = Min(maxBytes, GetSendAllowance());
+  if (maxBytes == 0)
+    return true;
+
+  ssize_t res = SendBuffers(m_fileDescriptor, ppBuffers, bufferLengths, numBuffers, maxBytes, &m_stats);
+  if (res < 0)
+  {
+    CloseWithError();
+    return false;
+  }
+
+  ConsumeSendAllowance((size_t)res);
+
+  // the second run only becomes readable once the first is consumed
+  size_t sentBytes = (size_t)res;
+  size_t sentFromBuffer = Min(sentBytes, bufferedBytes);
+  size_t sentFromFirst = Min(sentFromBuffer, (bufferedBytes > 0) ? firstLength : 0);
+  if (sentFromFirst > 0)
+    m_sendBuffer.MoveReadPointer(sentFromFirst);
+  if (sentFromBuffer > sentFromFirst)
+    m_sendBuffer.MoveReadPointer(sentFromBuffer - sentFromFirst);
+
+  if (pPayloadBytesSent != nullptr)
+    *pPayloadBytesSent = sentBytes - sentFromBuffer;
+
+  return true;
+}
+
+void BufferedStreamSocket::UpdateWriteNotification()
+{
+  m_stats.RecordSendBuffered(m_sendBuffer.GetBufferUsed());
+
+  // only while there's something to send, and it isn't being held back
+  bool wantWrites = (m_connected && m_corkCount == 0 && !m_sendThrottled && m_sendBuffer.GetBufferUsed() > 0);
+  if (wantWrites == m_writeNotificationsEnabled || !m_connected)
+    return;
+
+  m_writeNotificationsEnabled = wantWrites;
+  m_pMultiplexer->SetNotificationMask(this, m_fileDescriptor,
+                                      SocketMultiplexer::EventType_Read |
+                                        (wantWrites ? (uint32)SocketMultiplexer::EventType_Write : 0u));
+}
+
+size_t BufferedStreamSocket::GetSendAllowance()
+{
+  if (m_sendThrottled)
+    return 0;
+
+  size_t allowance = Min(m_sendRateLimiter.GetAvailable(), m_pMultiplexer->m_sendRateLimiter.GetAvailable());
+  if (allowance == 0)
+    ThrottleSends();
+
+  return allowance;
+}
+
+void BufferedStreamSocket::ConsumeSendAllowance(size_t bytes)
+{
+  m_sendRateLimiter.Consume(bytes);
+  m_pMultiplexer->m_sendRateLimiter.Consume(bytes);
+}
+
+void BufferedStreamSocket::ThrottleSends()
+{
+  // Waits for a few KB rather than the first byte, so a slow limit isn't met with a wakeup every millisecond. The
+  // timer keeps the socket alive until it fires, or is cancelled by the socket disconnecting.
+  static const size_t ResumeBytes = 4096;
+  uint32 waitTime = Max(m_sendRateLimiter.GetWaitTime(ResumeBytes),
+                        m_pMultiplexer->m_sendRateLimiter.GetWaitTime(ResumeBytes));
+  m_sendThrottled = true;
+  m_stats.SendThrottled++;
+  AddRef();
+  m_pMultiplexer->ScheduleTimer(&m_throttleTimer, Max(waitTime, 1u), this);
+}
+
+void BufferedStreamSocket::OnThrottleTimer(SocketTimer* pTimer, void* pUserData)
+{
+  // the write event sends what's been held back
+  BufferedStreamSocket* pSocket = static_cast<BufferedStreamSocket*>(pUserData);
+  pSocket->m_lock.Lock();
+  pSocket->m_sendThrottled = false;
+  pSocket->UpdateWriteNotification();
+  pSocket->m_lock.Unlock();
+  pSocket->Release();
+}
+
 bool BufferedStreamSocket::AcquireReadBuffer(const void** ppBuffer, size_t* pBytesAvailable)
 {
   m_lock.Lock();
@@ -204,13 +423,21 @@ bool BufferedStreamSocket::AcquireReadBuffer(const void** ppBuffer, size_t* pByt
 
 void BufferedStreamSocket::ReleaseReadBuffer(size_t bytesConsumed)
 {
-  DebugAssert(bytesConsumed <= m_receiveBuffer.GetContiguousBufferSpace());
-  if (bytesConsumed >= 0)
+  DebugAssert(bytesConsumed <= m_receiveBuffer.GetContiguousUsedBytes());
+  if (bytesConsumed > 0)
     m_receiveBuffer.MoveReadPointer(bytesConsumed);
 
   m_lock.Unlock();
 }
 
+bool BufferedStreamSocket::IsReusable()
+{
+  m_lock.Lock();
+  bool reusable = (m_receiveBuffer.GetBufferUsed() == 0 && StreamSocket::IsReusable());
+  m_lock.Unlock();
+  return reusable;
+}
+
 void BufferedStreamSocket::OnConnected()
 {
   StreamSocket::OnConnected();
@@ -218,6 +445,14 @@ void BufferedStreamSocket::OnConnected()
 
 void BufferedStreamSocket::OnDisconnected(Error* pError)
 {
+  // whoever closed it still has a reference, so this isn't the last
+  if (m_sendThrottled)
+  {
+    m_sendThrottled = false;
+    if (m_pMultiplexer->CancelTimer(&m_throttleTimer))
+      Release();
+  }
+
   StreamSocket::OnDisconnected(pError);
 }
 
@@ -226,11 +461,81 @@ void BufferedStreamSocket::OnRead()
   StreamSocket::OnRead();
 }
 
+void BufferedStreamSocket::OnReadBuffer(SocketBuffer* pBuffer)
+{
+  // copy a contiguous run at a time, as the space either side of the wrap isn't always usable together
+  const byte* pSource = pBuffer->GetData();
+  size_t bytesRemaining = pBuffer->GetSize();
+  while (bytesRemaining > 0)
+  {
+    void* pWritePointer;
+    size_t contiguousBytes = 1;
+    if (!m_receiveBuffer.GetWritePointer(&pWritePointer, &contiguousBytes))
+      break;
+
+    size_t bytesToCopy = Min(bytesRemaining, contiguousBytes);
+    std::memcpy(pWritePointer, pSource, bytesToCopy);
+    m_receiveBuffer.MoveWritePointer(bytesToCopy);
+    pSource += bytesToCopy;
+    bytesRemaining -= bytesToCopy;
+  }
+
+  // whatever doesn't fit is dropped, so the receive buffer should be at least the size taken per event
+  if (bytesRemaining > 0)
+    Log_WarningPrintf("BufferedStreamSocket::OnReadBuffer: Receive buffer full, dropping %u bytes",
+                      (uint32)bytesRemaining);
+}
+
+void BufferedStreamSocket::OnSendBufferSpace() {}
+
 void BufferedStreamSocket::OnReadEvent()
 {
   m_lock.Lock();
 
-  if (m_connected)
+  // whatever the handlers write goes out in one send once they've all run
+  m_corkCount++;
+
+  if (m_connected && m_receiveMode == ReceiveMode_PooledBuffers)
+  {
+    // Receive into pooled buffers, up to the receive buffer's size per event so the other sockets get their turn.
+    size_t bytesRemaining = m_receiveBuffer.GetBufferSize();
+    while (bytesRemaining > 0)
+    {
+      SocketBuffer* pBuffer = SocketBuffer::Allocate();
+      size_t bytesToReceive = Min(bytesRemaining, (size_t)SocketBuffer::Capacity);
+      ssize_t res = recv(m_fileDescriptor, (char*)pBuffer->GetWritePointer(), SIZE_CAST(bytesToReceive), 0);
+      m_stats.RecordReceive(res);
+      if (res <= 0)
+      {
+        // nothing received at all is the other end closing
+        pBuffer->Release();
+        if (res == 0 || WSAGetLastError() != WSAEWOULDBLOCK)
+        {
+          CloseWithError();
+          Uncork();
+          m_lock.Unlock();
+          return;
+        }
+
+        m_stats.ReceiveWouldBlock++;
+        break;
+      }
+
+      // the handler adds its own reference to keep it
+      pBuffer->SetSize((size_t)res);
+      OnReadBuffer(pBuffer);
+      pBuffer->Release();
+      bytesRemaining -= (size_t)res;
+
+      // a short read means the socket is drained, or was closed by the handler
+      if ((size_t)res < bytesToReceive || !m_connected)
+        break;
+    }
+
+    if (m_connected)
+      OnRead();
+  }
+  else if (m_connected)
   {
     // Pull as many bytes as possible into the read buffer.
     while (m_receiveBuffer.GetBufferSpace() > 0)
@@ -240,13 +545,18 @@ void BufferedStreamSocket::OnReadEvent()
       if (m_receiveBuffer.GetWritePointer(&pBuffer, &contiguousBytes))
       {
         ssize_t res = recv(m_fileDescriptor, (char*)pBuffer, SIZE_CAST(contiguousBytes), 0);
+        m_stats.RecordReceive(res);
         if (res <= 0 && WSAGetLastError() != WSAEWOULDBLOCK)
         {
           CloseWithError();
+          Uncork();
           m_lock.Unlock();
           return;
         }
 
+        if (res < 0)
+          m_stats.ReceiveWouldBlock++;
+
         if (res > 0)
         {
           m_receiveBuffer.MoveWritePointer((size_t)res);
@@ -261,6 +571,7 @@ void BufferedStreamSocket::OnReadEvent()
     OnRead();
   }
 
+  Uncork();
   m_lock.Unlock();
 }
 
@@ -268,40 +579,34 @@ void BufferedStreamSocket::OnWriteEvent()
 {
   m_lock.Lock();
 
-  // Try to send as many bytes as possible from the write buffer.
-  while (m_sendBuffer.GetBufferUsed() > 0)
+  // Send as much of the write buffer as this turn's share allows, both runs of it at once. A share the kernel didn't
+  // take carries over, up to one more turn's worth, and is dropped once the buffer empties.
+  size_t maxBytes = SIZE_MAX;
+  size_t quantum = m_pMultiplexer->GetWriteQuantum();
+  if (quantum > 0)
   {
-    size_t contiguousBytes;
-    const void* pBuffer;
-    if (m_sendBuffer.GetReadPointer(&pBuffer, &contiguousBytes))
-    {
-      ssize_t res = send(m_fileDescriptor, (const char*)pBuffer, SIZE_CAST(contiguousBytes), 0);
-      if (res < 0 && WSAGetLastError() != WSAEWOULDBLOCK)
-      {
-        CloseWithError();
-        m_lock.Unlock();
-        return;
-      }
-
-      // Any bytes written?
-      if (res > 0)
-      {
-        m_sendBuffer.MoveWritePointer((size_t)res);
+    m_writeDeficit = Min(m_writeDeficit + quantum, quantum * 2);
+    maxBytes = m_writeDeficit;
+  }
 
-        // Try again only if we did a whole write.
-        if ((size_t)res == contiguousBytes)
-          continue;
-      }
-    }
+  size_t bufferedBytes = m_sendBuffer.GetBufferUsed();
+  if (m_connected && bufferedBytes > 0 && !FlushSendBuffer(nullptr, 0, nullptr, maxBytes))
+  {
+    m_lock.Unlock();
+    return;
+  }
 
-    // Don't try again.
-    break;
+  if (quantum > 0)
+  {
+    size_t remainingBytes = m_sendBuffer.GetBufferUsed();
+    m_writeDeficit = (remainingBytes > 0) ? (m_writeDeficit - (bufferedBytes - remainingBytes)) : 0;
   }
 
-  // Do we still have bytes? If not, unregister for read notifications.
-  if (m_sendBuffer.GetBufferUsed() == 0)
-    m_pMultiplexer->SetNotificationMask(this, m_fileDescriptor, SocketMultiplexer::EventType_Read);
+  // Let anyone waiting to write carry on, then unregister for write notifications if nothing is left.
+  if (m_connected && m_sendBuffer.GetBufferSpace() > 0)
+    OnSendBufferSpace();
 
+  UpdateWriteNotification();
   m_lock.Unlock();
 }
 
@@ -0,0 +1,440 @@
+#include "YBaseLib/Sockets/DatagramSocket.h"
+#include "YBaseLib/Error.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Sockets/SocketMultiplexer.h"
+Log_SetChannel(DatagramSocket);
+
+#ifdef Y_SOCKET_IMPLEMENTATION_GENERIC
+
+// Windows-isms
+#ifndef Y_PLATFORM_WINDOWS
+#define ioctlsocket ioctl
+#define closesocket close
+#define WSAEWOULDBLOCK EAGAIN
+#define WSAGetLastError() errno
+#define SIZE_CAST(x) x
+#else
+#define SIZE_CAST(x) static_cast<int>(x)
+#endif
+
+// batched calls, a datagram per message
+#if defined(Y_PLATFORM_LINUX) || defined(Y_PLATFORM_ANDROID)
+#define HAVE_SOCKET_MMSG 1
+#endif
+
+// UDP GSO, since Linux 4.18, older headers don't have the option
+#if defined(Y_PLATFORM_LINUX)
+#include <netinet/udp.h>
+#define HAVE_SOCKET_UDP_SEGMENT 1
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+// the kernel's limits on one segmented send
+static const size_t UDP_SEGMENT_MAX_SEGMENTS = 64;
+static const size_t UDP_SEGMENT_MAX_SIZE = 65000;
+#endif
+
+const uint32 DatagramSocket::ReceiveBatchSize;
+const uint32 DatagramSocket::ReceiveBatchesPerEvent;
+
+DatagramSocket::DatagramSocket()
+  : BaseSocket(), m_pMultiplexer(nullptr), m_fileDescriptor(INVALID_SOCKET), m_segmentationOffload(true)
+{
+  Y_memzero(m_pReceiveBuffers, sizeof(m_pReceiveBuffers));
+}
+
+DatagramSocket::~DatagramSocket()
+{
+  DebugAssert(m_fileDescriptor == INVALID_SOCKET);
+  for (uint32 i = 0; i < ReceiveBatchSize; i++)
+  {
+    if (m_pReceiveBuffers[i] != nullptr)
+      m_pReceiveBuffers[i]->Release();
+  }
+}
+
+bool DatagramSocket::InitializeSocket(SocketMultiplexer* pMultiplexer, SOCKET fileDescriptor, Error* pError)
+{
+  DebugAssert(m_pMultiplexer == nullptr);
+
+  // switch to nonblocking mode
+  unsigned long value = 1;
+  if (ioctlsocket(fileDescriptor, FIONBIO, &value) < 0)
+  {
+    if (pError != nullptr)
+      pError->SetErrorSocket(WSAGetLastError());
+
+    closesocket(fileDescriptor);
+    return false;
+  }
+
+  m_pMultiplexer = pMultiplexer;
+  m_fileDescriptor = fileDescriptor;
+
+  // get local address, for the port when bound to 0
+  sockaddr_storage sa;
+  socklen_t salen = sizeof(sa);
+  if (getsockname(m_fileDescriptor, (sockaddr*)&sa, &salen) == 0)
+    m_localAddress.SetFromSockaddr(&sa, salen);
+  else
+    m_localAddress.SetUnknown();
+
+  // register for notifications, sends never wait so only reads are needed
+  m_pMultiplexer->AddOpenSocket(this);
+  m_pMultiplexer->SetNotificationMask(this, m_fileDescriptor, SocketMultiplexer::EventType_Read);
+  return true;
+}
+
+void DatagramSocket::Close()
+{
+  m_lock.Lock();
+
+  if (m_fileDescriptor == INVALID_SOCKET)
+  {
+    m_lock.Unlock();
+    return;
+  }
+
+  m_pMultiplexer->SetNotificationMask(this, m_fileDescriptor, 0);
+  closesocket(m_fileDescriptor);
+  m_fileDescriptor = INVALID_SOCKET;
+
+  m_lock.Unlock();
+
+  // Remove the open socket last. This is because it may be the last reference holder.
+  m_pMultiplexer->RemoveOpenSocket(this);
+}
+
+bool DatagramSocket::SendTo(const SocketAddress* pAddress, const void* pData, size_t size)
+{
+  m_lock.Lock();
+
+  bool result = false;
+  if (m_fileDescriptor != INVALID_SOCKET)
+  {
+    ssize_t res = sendto(m_fileDescriptor, (const char*)pData, SIZE_CAST(size), 0,
+                         (const sockaddr*)pAddress->GetData(), (socklen_t)pAddress->GetLength());
+    RecordSend(res, 1);
+    result = (res >= 0);
+  }
+
+  m_lock.Unlock();
+  return result;
+}
+
+uint32 DatagramSocket::SendBatch(const OutgoingDatagram* pDatagrams, uint32 count)
+{
+  m_lock.Lock();
+
+  uint32 sentCount = 0;
+  if (m_fileDescriptor == INVALID_SOCKET)
+  {
+    m_lock.Unlock();
+    return 0;
+  }
+
+#ifdef HAVE_SOCKET_MMSG
+  while (sentCount < count)
+  {
+    mmsghdr messages[ReceiveBatchSize];
+    iovec iovecs[ReceiveBatchSize];
+    uint32 batchCount = Min(count - sentCount, ReceiveBatchSize);
+    Y_memzero(messages, sizeof(mmsghdr) * batchCount);
+    for (uint32 i = 0; i < batchCount; i++)
+    {
+      const OutgoingDatagram& datagram = pDatagrams[sentCount + i];
+      iovecs[i].iov_base = const_cast<void*>(datagram.pData);
+      iovecs[i].iov_len = datagram.Size;
+      messages[i].msg_hdr.msg_name = const_cast<void*>(datagram.pAddress->GetData());
+      messages[i].msg_hdr.msg_namelen = (socklen_t)datagram.pAddress->GetLength();
+      messages[i].msg_hdr.msg_iov = &iovecs[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int res = sendmmsg(m_fileDescriptor, messages, batchCount, 0);
+    int64 bytesSent = (res > 0) ? 0 : -1;
+    for (int i = 0; i < res; i++)
+      bytesSent += (int64)messages[i].msg_len;
+    RecordSend(bytesSent, (res > 0) ? (uint32)res : 0);
+    if (res <= 0)
+      break;
+
+    sentCount += (uint32)res;
+    if ((uint32)res < batchCount)
+      break;
+  }
+#else
+  for (; sentCount < count; sentCount++)
+  {
+    const OutgoingDatagram& datagram = pDatagrams[sentCount];
+    ssize_t res = sendto(m_fileDescriptor, (const char*)datagram.pData, SIZE_CAST(datagram.Size), 0,
+                         (const sockaddr*)datagram.pAddress->GetData(), (socklen_t)datagram.pAddress->GetLength());
+    RecordSend(res, 1);
+    if (res < 0)
+      break;
+  }
+#endif
+
+  m_lock.Unlock();
+  return sentCount;
+}
+
+bool DatagramSocket::SendSegmented(const SocketAddress* pAddress, const void* pData, size_t size, size_t segmentSize)
+{
+  DebugAssert(segmentSize > 0);
+  m_lock.Lock();
+
+  if (m_fileDescriptor == INVALID_SOCKET)
+  {
+    m_lock.Unlock();
+    return false;
+  }
+
+  const byte* pBytes = (const byte*)pData;
+  size_t offset = 0;
+
+#ifdef HAVE_SOCKET_UDP_SEGMENT
+  // as many segments per call as the kernel takes, falling back to a datagram at a time if it doesn't
+  size_t segmentsPerCall = Min(UDP_SEGMENT_MAX_SEGMENTS, UDP_SEGMENT_MAX_SIZE / segmentSize);
+  while (m_segmentationOffload && segmentsPerCall > 1 && size - offset > segmentSize)
+  {
+    size_t callSize = Min(size - offset, segmentsPerCall * segmentSize);
+
+    iovec iov;
+    iov.iov_base = const_cast<byte*>(pBytes + offset);
+    iov.iov_len = callSize;
+
+    union {
+      char buffer[CMSG_SPACE(sizeof(uint16_t))];
+      cmsghdr align;
+    } control;
+    Y_memzero(&control, sizeof(control));
+
+    msghdr message;
+    Y_memzero(&message, sizeof(message));
+    message.msg_name = const_cast<void*>(pAddress->GetData());
+    message.msg_namelen = (socklen_t)pAddress->GetLength();
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    cmsghdr* pControlMessage = CMSG_FIRSTHDR(&message);
+    pControlMessage->cmsg_level = SOL_UDP;
+    pControlMessage->cmsg_type = UDP_SEGMENT;
+    pControlMessage->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    uint16_t segmentSize16 = (uint16_t)segmentSize;
+    std::memcpy(CMSG_DATA(pControlMessage), &segmentSize16, sizeof(segmentSize16));
+
+    ssize_t res = sendmsg(m_fileDescriptor, &message, 0);
+    RecordSend(res, (uint32)((callSize + segmentSize - 1) / segmentSize));
+    if (res < 0)
+    {
+      // would block drops the datagrams, as any send does, anything else means no offload here
+      if (errno == EAGAIN)
+      {
+        m_lock.Unlock();
+        return false;
+      }
+
+      Log_DevPrintf("DatagramSocket::SendSegmented: UDP_SEGMENT not available (%d), sending datagrams", errno);
+      m_segmentationOffload = false;
+      break;
+    }
+
+    offset += callSize;
+  }
+#endif
+
+  // what's left, a datagram per segment, batched
+  bool result = true;
+  while (offset < size)
+  {
+    OutgoingDatagram datagrams[ReceiveBatchSize];
+    uint32 count = 0;
+    for (; count < ReceiveBatchSize && offset < size; count++)
+    {
+      datagrams[count].pAddress = pAddress;
+      datagrams[count].pData = pBytes + offset;
+      datagrams[count].Size = Min(segmentSize, size - offset);
+      offset += datagrams[count].Size;
+    }
+
+    if (SendBatch(datagrams, count) != count)
+    {
+      result = false;
+      break;
+    }
+  }
+
+  m_lock.Unlock();
+  return result;
+}
+
+void DatagramSocket::OnDatagram(SocketBuffer* pBuffer, const SocketAddress* pFromAddress) {}
+
+void DatagramSocket::RecordSend(int64 result, uint32 datagramCount)
+{
+  m_stats.RecordSend(result);
+  if (result >= 0)
+    m_stats.DatagramsSent += datagramCount;
+  else if (WSAGetLastError() == WSAEWOULDBLOCK)
+    m_stats.SendWouldBlock++;
+}
+
+void DatagramSocket::RecordReceiveCall(int64 result)
+{
+  // bytes and datagrams are counted as they're handed on
+  m_stats.ReceiveCalls++;
+  if (result < 0 && WSAGetLastError() == WSAEWOULDBLOCK)
+    m_stats.ReceiveWouldBlock++;
+}
+
+int32 DatagramSocket::ReceiveBatch()
+{
+  // buffers left unused by the last call are kept, the rest were handed on and are replaced
+  for (uint32 i = 0; i < ReceiveBatchSize; i++)
+  {
+    if (m_pReceiveBuffers[i] == nullptr)
+      m_pReceiveBuffers[i] = SocketBuffer::Allocate();
+  }
+
+  sockaddr_storage addresses[ReceiveBatchSize];
+  uint32 sizes[ReceiveBatchSize];
+  socklen_t addressLengths[ReceiveBatchSize];
+  bool truncated[ReceiveBatchSize];
+  int32 receivedCount = 0;
+
+#if defined(HAVE_SOCKET_MMSG)
+  mmsghdr messages[ReceiveBatchSize];
+  iovec iovecs[ReceiveBatchSize];
+  Y_memzero(messages, sizeof(messages));
+  for (uint32 i = 0; i < ReceiveBatchSize; i++)
+  {
+    iovecs[i].iov_base = m_pReceiveBuffers[i]->GetWritePointer();
+    iovecs[i].iov_len = SocketBuffer::Capacity;
+    messages[i].msg_hdr.msg_name = &addresses[i];
+    messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+    messages[i].msg_hdr.msg_iov = &iovecs[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int res = recvmmsg(m_fileDescriptor, messages, ReceiveBatchSize, MSG_DONTWAIT, nullptr);
+  RecordReceiveCall(res);
+  if (res <= 0)
+    return -1;
+
+  receivedCount = res;
+  for (int32 i = 0; i < receivedCount; i++)
+  {
+    sizes[i] = messages[i].msg_len;
+    addressLengths[i] = messages[i].msg_hdr.msg_namelen;
+    truncated[i] = ((messages[i].msg_hdr.msg_flags & MSG_TRUNC) != 0);
+  }
+#elif defined(Y_PLATFORM_WINDOWS)
+  for (; receivedCount < (int32)ReceiveBatchSize; receivedCount++)
+  {
+    int addressLength = sizeof(addresses[receivedCount]);
+    int res = recvfrom(m_fileDescriptor, (char*)m_pReceiveBuffers[receivedCount]->GetWritePointer(),
+                       SocketBuffer::Capacity, 0, (sockaddr*)&addresses[receivedCount], &addressLength);
+    RecordReceiveCall(res);
+
+    // oversized datagrams are an error here, and unreachable ports are reported on the next receive
+    int error = (res < 0) ? WSAGetLastError() : 0;
+    if (res < 0 && error != WSAEMSGSIZE)
+    {
+      if (error == WSAECONNRESET)
+      {
+        receivedCount--;
+        continue;
+      }
+
+      break;
+    }
+
+    sizes[receivedCount] = (res < 0) ? 0 : (uint32)res;
+    addressLengths[receivedCount] = (socklen_t)addressLength;
+    truncated[receivedCount] = (res < 0);
+  }
+
+  if (receivedCount == 0)
+    return -1;
+#else
+  for (; receivedCount < (int32)ReceiveBatchSize; receivedCount++)
+  {
+    iovec iov;
+    iov.iov_base = m_pReceiveBuffers[receivedCount]->GetWritePointer();
+    iov.iov_len = SocketBuffer::Capacity;
+
+    msghdr message;
+    Y_memzero(&message, sizeof(message));
+    message.msg_name = &addresses[receivedCount];
+    message.msg_namelen = sizeof(addresses[receivedCount]);
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+
+    ssize_t res = recvmsg(m_fileDescriptor, &message, 0);
+    RecordReceiveCall(res);
+    if (res < 0)
+      break;
+
+    sizes[receivedCount] = (uint32)res;
+    addressLengths[receivedCount] = message.msg_namelen;
+    truncated[receivedCount] = ((message.msg_flags & MSG_TRUNC) != 0);
+  }
+
+  if (receivedCount == 0)
+    return -1;
+#endif
+
+  // hand them on, the handler may close the socket, in which case the rest are dropped
+  for (int32 i = 0; i < receivedCount; i++)
+  {
+    SocketBuffer* pBuffer = m_pReceiveBuffers[i];
+    m_pReceiveBuffers[i] = nullptr;
+    m_stats.BytesReceived += sizes[i];
+    m_stats.DatagramsReceived++;
+
+    if (truncated[i])
+    {
+      Log_WarningPrintf("DatagramSocket::ReceiveBatch: Dropping datagram larger than %u bytes",
+                        SocketBuffer::Capacity);
+    }
+    else if (m_fileDescriptor != INVALID_SOCKET)
+    {
+      SocketAddress fromAddress;
+      fromAddress.SetFromSockaddr(&addresses[i], addressLengths[i]);
+      pBuffer->SetSize(sizes[i]);
+      OnDatagram(pBuffer, &fromAddress);
+    }
+
+    pBuffer->Release();
+  }
+
+  return receivedCount;
+}
+
+void DatagramSocket::OnReadEvent()
+{
+  m_lock.Lock();
+
+  // a full batch means there may be more waiting
+  for (uint32 i = 0; i < ReceiveBatchesPerEvent && m_fileDescriptor != INVALID_SOCKET; i++)
+  {
+    if (ReceiveBatch() < (int32)ReceiveBatchSize)
+      break;
+  }
+
+  m_lock.Unlock();
+}
+
+void DatagramSocket::OnWriteEvent()
+{
+  // never registered for
+}
+
+#endif // Y_SOCKET_IMPLEMENTATION_GENERIC
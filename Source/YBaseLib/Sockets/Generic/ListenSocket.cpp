@@ -12,16 +12,24 @@ Log_SetChannel(StreamSocket);
 #define ioctlsocket ioctl
 #define closesocket close
 #define WSAEWOULDBLOCK EAGAIN
+#define WSAECONNABORTED ECONNABORTED
+#define WSAECONNRESET ECONNRESET
 #define WSAGetLastError() errno
 #endif
 
 ListenSocket::ListenSocket(SocketMultiplexer* pMultiplexer,
-                           SocketMultiplexer::CreateStreamSocketCallback acceptCallback, SOCKET fileDescriptor)
+                           SocketMultiplexer::CreateStreamSocketCallback acceptCallback, SOCKET fileDescriptor,
+                           uint32 eventLoopIndex /*= Y_UINT32_MAX*/)
   : m_pMultiplexer(pMultiplexer), m_acceptCallback(acceptCallback), m_numConnectionsAccepted(0),
-    m_fileDescriptor(fileDescriptor)
+    m_acceptEventLoopIndex(eventLoopIndex), m_fileDescriptor(fileDescriptor)
 {
+  // nonblocking, so draining the backlog stops when it's empty rather than waiting for the next connection
+  unsigned long value = 1;
+  if (ioctlsocket(m_fileDescriptor, FIONBIO, &value) < 0)
+    Log_WarningPrintf("Failed to set listen socket nonblocking: %d", WSAGetLastError());
+
   // add to list
-  pMultiplexer->AddOpenSocket(this);
+  pMultiplexer->AddOpenSocket(this, eventLoopIndex);
 
   // get local address
   sockaddr_storage sa;
@@ -53,18 +61,45 @@ void ListenSocket::Close()
 
 void ListenSocket::OnReadEvent()
 {
-  // connection incoming
-  sockaddr_storage sa;
-  socklen_t salen = sizeof(sa);
-  SOCKET newFileDescriptor = accept(m_fileDescriptor, (sockaddr*)&sa, &salen);
-  if (newFileDescriptor < 0)
-    return;
+  // take every connection that's waiting, up to the cap, rather than one per wakeup
+  for (uint32 i = 0; i < MaxAcceptsPerEvent; i++)
+  {
+    sockaddr_storage sa;
+    socklen_t salen = sizeof(sa);
+
+#if defined(Y_PLATFORM_LINUX) || defined(Y_PLATFORM_ANDROID)
+    // nonblocking and close-on-exec from the start, which saves the ioctl when it's initialized
+    SOCKET newFileDescriptor = accept4(m_fileDescriptor, (sockaddr*)&sa, &salen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    const bool nonBlocking = true;
+#elif defined(Y_PLATFORM_WINDOWS)
+    // accepted sockets take on the listen socket's nonblocking mode
+    SOCKET newFileDescriptor = accept(m_fileDescriptor, (sockaddr*)&sa, &salen);
+    const bool nonBlocking = true;
+#else
+    SOCKET newFileDescriptor = accept(m_fileDescriptor, (sockaddr*)&sa, &salen);
+    const bool nonBlocking = false;
+#endif
+
+    if (newFileDescriptor == INVALID_SOCKET)
+    {
+      // a connection reset before it was accepted is skipped, anything else, out of descriptors for one, waits for
+      // the next event rather than spinning here
+      int errorCode = WSAGetLastError();
+      if (errorCode == WSAECONNABORTED || errorCode == WSAECONNRESET)
+        continue;
+
+      if (errorCode != WSAEWOULDBLOCK)
+        Log_WarningPrintf("accept() failed: %d", errorCode);
+
+      return;
+    }
 
-  // create socket, we release our own reference.
-  StreamSocket* pStreamSocket = m_acceptCallback();
-  pStreamSocket->InitializeSocket(m_pMultiplexer, newFileDescriptor, nullptr);
-  pStreamSocket->Release();
-  m_numConnectionsAccepted++;
+    // create socket, we release our own reference.
+    StreamSocket* pStreamSocket = m_acceptCallback();
+    pStreamSocket->InitializeSocket(m_pMultiplexer, newFileDescriptor, nullptr, m_acceptEventLoopIndex, nonBlocking);
+    pStreamSocket->Release();
+    m_numConnectionsAccepted++;
+  }
 }
 
 void ListenSocket::OnWriteEvent() {}
@@ -0,0 +1,216 @@
+#include "YBaseLib/Sockets/MessageSocket.h"
+#include "YBaseLib/Log.h"
+Log_SetChannel(MessageSocket);
+
+#ifdef Y_SOCKET_IMPLEMENTATION_GENERIC
+
+const uint32 MessageSocket::MaxPrefixSize;
+const uint32 MessageSocket::MaxMessagesPerWrite;
+
+// The receive buffer holds two frames, as one waiting on the rest of its bytes can be left with little more than
+// half of it once the free space wraps around.
+MessageSocket::MessageSocket(LengthPrefix lengthPrefix /*= LengthPrefix_VarUInt32*/,
+                             size_t maxMessageSize /*= 16384*/, size_t receiveBufferSize /*= 16384*/,
+                             size_t sendBufferSize /*= 16384*/)
+  : BufferedStreamSocket(Max(receiveBufferSize, (maxMessageSize + MaxPrefixSize) * 2),
+                         Max(sendBufferSize, maxMessageSize + MaxPrefixSize)),
+    m_lengthPrefix(lengthPrefix), m_maxMessageSize(Min(maxMessageSize, (size_t)Y_UINT32_MAX))
+{
+}
+
+MessageSocket::~MessageSocket() {}
+
+size_t MessageSocket::EncodePrefix(size_t size, byte* pBuffer) const
+{
+  if (m_lengthPrefix == LengthPrefix_UInt32)
+  {
+    pBuffer[0] = (byte)size;
+    pBuffer[1] = (byte)(size >> 8);
+    pBuffer[2] = (byte)(size >> 16);
+    pBuffer[3] = (byte)(size >> 24);
+    return 4;
+  }
+
+  size_t length = 0;
+  while (size >= 0x80)
+  {
+    pBuffer[length++] = (byte)(size | 0x80);
+    size >>= 7;
+  }
+  pBuffer[length++] = (byte)size;
+  return length;
+}
+
+int32 MessageSocket::DecodePrefix(const byte* pBytes, size_t byteCount, size_t* pPrefixLength,
+                                  size_t* pMessageSize) const
+{
+  if (m_lengthPrefix == LengthPrefix_UInt32)
+  {
+    if (byteCount < 4)
+      return 0;
+
+    *pPrefixLength = 4;
+    *pMessageSize = (size_t)pBytes[0] | ((size_t)pBytes[1] << 8) | ((size_t)pBytes[2] << 16) |
+                    ((size_t)pBytes[3] << 24);
+    return 1;
+  }
+
+  uint32 value = 0;
+  for (size_t i = 0; i < MaxPrefixSize; i++)
+  {
+    if (i == byteCount)
+      return 0;
+
+    // the fifth byte only has four bits left of a uint32
+    byte currentByte = pBytes[i];
+    if (i == (MaxPrefixSize - 1) && currentByte > 0x0F)
+      return -1;
+
+    value |= (uint32)(currentByte & 0x7F) << (7 * i);
+    if ((currentByte & 0x80) == 0)
+    {
+      *pPrefixLength = i + 1;
+      *pMessageSize = value;
+      return 1;
+    }
+  }
+
+  return -1;
+}
+
+bool MessageSocket::WriteMessage(const void* pData, size_t size)
+{
+  return (WriteMessages(&pData, &size, 1) == 1);
+}
+
+uint32 MessageSocket::WriteMessages(const void* const* ppMessages, const size_t* pMessageSizes, uint32 count)
+{
+  byte prefixes[MaxMessagesPerWrite][MaxPrefixSize];
+  const void* ppBuffers[MaxMessagesPerWrite * 2];
+  size_t bufferLengths[MaxMessagesPerWrite * 2];
+
+  m_lock.Lock();
+
+  uint32 messagesWritten = 0;
+  bool tooLarge = false;
+  while (messagesWritten < count && m_connected && !tooLarge)
+  {
+    // Take as many frames as the send buffer holds contiguously, which it takes whole whether or not the socket
+    // sends any of them now, so a frame is never cut off.
+    size_t bufferSpace = m_sendBuffer.GetContiguousBufferSpace();
+    size_t numBuffers = 0;
+    size_t batchBytes = 0;
+    uint32 batchCount = 0;
+    while (batchCount < MaxMessagesPerWrite && (messagesWritten + batchCount) < count)
+    {
+      uint32 index = messagesWritten + batchCount;
+      if (pMessageSizes[index] > m_maxMessageSize)
+      {
+        Log_ErrorPrintf("MessageSocket::WriteMessages: %llu byte message is over the %llu byte limit",
+                        (unsigned long long)pMessageSizes[index], (unsigned long long)m_maxMessageSize);
+        tooLarge = true;
+        break;
+      }
+
+      size_t prefixLength = EncodePrefix(pMessageSizes[index], prefixes[batchCount]);
+      if ((batchBytes + prefixLength + pMessageSizes[index]) > bufferSpace)
+        break;
+
+      ppBuffers[numBuffers] = prefixes[batchCount];
+      bufferLengths[numBuffers++] = prefixLength;
+      if (pMessageSizes[index] > 0)
+      {
+        ppBuffers[numBuffers] = ppMessages[index];
+        bufferLengths[numBuffers++] = pMessageSizes[index];
+      }
+
+      batchBytes += prefixLength + pMessageSizes[index];
+      batchCount++;
+    }
+
+    // the rest waits for the send buffer to drain
+    if (batchCount == 0)
+      break;
+
+    // short only if the socket closed on an error
+    if (WriteVector(ppBuffers, bufferLengths, numBuffers) != batchBytes)
+      break;
+
+    messagesWritten += batchCount;
+  }
+
+  m_lock.Unlock();
+  return messagesWritten;
+}
+
+void MessageSocket::OnMessage(const void* pData, size_t size) {}
+
+void MessageSocket::OnRead()
+{
+  // called with the lock held, from the read event
+  const void* pFirst;
+  const void* pSecond;
+  size_t firstLength, secondLength;
+  while (m_connected && m_receiveBuffer.GetReadPointers(&pFirst, &firstLength, &pSecond, &secondLength))
+  {
+    // the prefix can wrap too, so it's gathered from both runs
+    byte prefix[MaxPrefixSize];
+    size_t prefixBytes = Min(firstLength, (size_t)MaxPrefixSize);
+    std::memcpy(prefix, pFirst, prefixBytes);
+    if (prefixBytes < MaxPrefixSize && secondLength > 0)
+    {
+      size_t secondPrefixBytes = Min(secondLength, MaxPrefixSize - prefixBytes);
+      std::memcpy(prefix + prefixBytes, pSecond, secondPrefixBytes);
+      prefixBytes += secondPrefixBytes;
+    }
+
+    size_t prefixLength, messageSize;
+    int32 result = DecodePrefix(prefix, prefixBytes, &prefixLength, &messageSize);
+    if (result == 0)
+      break;
+    if (result < 0 || messageSize > m_maxMessageSize)
+    {
+      if (result < 0)
+        Log_ErrorPrintf("MessageSocket::OnRead: Malformed length prefix, closing");
+      else
+        Log_ErrorPrintf("MessageSocket::OnRead: %llu byte message is over the %llu byte limit, closing",
+                        (unsigned long long)messageSize, (unsigned long long)m_maxMessageSize);
+
+      Close();
+      break;
+    }
+
+    size_t frameSize = prefixLength + messageSize;
+    if (frameSize > (firstLength + secondLength))
+      break;
+
+    if (frameSize <= firstLength)
+    {
+      // contiguous, handed over in place
+      OnMessage((const byte*)pFirst + prefixLength, messageSize);
+      m_receiveBuffer.MoveReadPointer(frameSize);
+      continue;
+    }
+
+    // Wrapped, so put together from the end of the first run and the start of the second. The second run only
+    // becomes readable once the first is consumed.
+    m_reassemblyBuffer.Reserve((uint32)Max(messageSize, (size_t)1));
+    byte* pMessage = m_reassemblyBuffer.GetBasePointer();
+    if (prefixLength < firstLength)
+    {
+      size_t firstMessageBytes = firstLength - prefixLength;
+      std::memcpy(pMessage, (const byte*)pFirst + prefixLength, firstMessageBytes);
+      std::memcpy(pMessage + firstMessageBytes, pSecond, messageSize - firstMessageBytes);
+    }
+    else
+    {
+      std::memcpy(pMessage, (const byte*)pSecond + (prefixLength - firstLength), messageSize);
+    }
+
+    m_receiveBuffer.MoveReadPointer(firstLength);
+    m_receiveBuffer.MoveReadPointer(frameSize - firstLength);
+    OnMessage(pMessage, messageSize);
+  }
+}
+
+#endif // Y_SOCKET_IMPLEMENTATION_GENERIC
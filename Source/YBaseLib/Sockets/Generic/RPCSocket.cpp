@@ -0,0 +1,38 @@
+#include "YBaseLib/Sockets/RPCSocket.h"
+#include "YBaseLib/Log.h"
+Log_SetChannel(RPCSocket);
+
+#ifdef Y_SOCKET_IMPLEMENTATION_GENERIC
+
+RPCSocket::RPCSocket(size_t maxMessageSize /*= 16384*/, size_t receiveBufferSize /*= 16384*/,
+                     size_t sendBufferSize /*= 16384*/)
+  : MessageSocket(LengthPrefix_VarUInt32, maxMessageSize, receiveBufferSize, sendBufferSize),
+    m_channel([this](const void* pData, size_t size) { return WriteMessage(pData, size); },
+              (uint32)Min(maxMessageSize, (size_t)Y_UINT32_MAX))
+{
+}
+
+RPCSocket::~RPCSocket() {}
+
+void RPCSocket::OnMessage(const void* pData, size_t size)
+{
+  if (!m_channel.ReceiveFrames(pData, size))
+  {
+    Log_ErrorPrintf("RPCSocket::OnMessage: Malformed batch, closing");
+    Close();
+  }
+}
+
+void RPCSocket::OnSendBufferSpace()
+{
+  // batches that didn't fit before
+  m_channel.Flush();
+}
+
+void RPCSocket::OnDisconnected(Error* pError)
+{
+  m_channel.Close(pError);
+  MessageSocket::OnDisconnected(pError);
+}
+
+#endif // Y_SOCKET_IMPLEMENTATION_GENERIC
@@ -1,9 +1,14 @@
 #include "YBaseLib/Sockets/SocketMultiplexer.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/CPUID.h"
 #include "YBaseLib/Error.h"
 #include "YBaseLib/Log.h"
 #include "YBaseLib/NumericLimits.h"
 #include "YBaseLib/Platform.h"
+#include "YBaseLib/Profiler.h"
+#include "YBaseLib/Sockets/DatagramSocket.h"
 #include "YBaseLib/Sockets/ListenSocket.h"
+#include "YBaseLib/Sockets/SocketResolver.h"
 #include "YBaseLib/Sockets/StreamSocket.h"
 #include "YBaseLib/Thread.h"
 Log_SetChannel(StreamSocket);
@@ -17,108 +22,284 @@ Log_SetChannel(StreamSocket);
 #define WSAGetLastError() errno
 #endif
 
-SocketMultiplexer::SocketMultiplexer() : m_pWorkerThread(nullptr) {}
+// poll is everywhere but the browser, where select is emulated anyway
+#if defined(Y_PLATFORM_WINDOWS)
+#define HAVE_SOCKET_POLL 1
+#define poll WSAPoll
+#define POLL_READ_EVENTS POLLRDNORM
+#define POLL_WRITE_EVENTS POLLWRNORM
+#elif !defined(Y_PLATFORM_HTML5)
+#include <poll.h>
+#define HAVE_SOCKET_POLL 1
+#define POLL_READ_EVENTS POLLIN
+#define POLL_WRITE_EVENTS POLLOUT
+#endif
+
+#if defined(Y_PLATFORM_LINUX) || defined(Y_PLATFORM_ANDROID)
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#define HAVE_SOCKET_EPOLL 1
+#endif
+
+// elsewhere SO_REUSEPORT, if there at all, doesn't spread connections between the sockets
+#if (defined(Y_PLATFORM_LINUX) || defined(Y_PLATFORM_ANDROID)) && defined(SO_REUSEPORT)
+#define HAVE_SOCKET_REUSEPORT 1
+#endif
+
+#if defined(Y_PLATFORM_OSX)
+#include <sys/event.h>
+#include <sys/time.h>
+#define HAVE_SOCKET_KQUEUE 1
+#endif
+
+const uint32 SocketMultiplexer::MaxEventLoops;
+const uint32 SocketMultiplexer::DefaultWriteQuantum;
+
+// events taken from the kernel queue in one wait
+static const uint32 KERNEL_QUEUE_BATCH_SIZE = 64;
+
+SocketMultiplexer::SocketMultiplexer(SOCKET_MULTIPLEXER_TYPE type)
+  : m_type(type), m_eventLoopCount(0), m_nextEventLoop(0), m_pResolver(new SocketResolver()),
+    m_writeQuantum(DefaultWriteQuantum)
+{
+  Y_memzero(m_eventLoops, sizeof(m_eventLoops));
+  m_openSocketLock.SetProfileName("socketmultiplexer.open_sockets");
+}
 
 SocketMultiplexer::~SocketMultiplexer()
 {
   StopWorkerThreads();
+
+  // lookups in progress finish onto the loops, which delete them, with any sockets connected for them
+  delete m_pResolver;
   CloseAll();
+
+  for (uint32 i = 0; i < m_eventLoopCount; i++)
+    delete m_eventLoops[i];
+}
+
+bool SocketMultiplexer::IsTypeSupported(SOCKET_MULTIPLEXER_TYPE type)
+{
+  switch (type)
+  {
+    case SOCKET_MULTIPLEXER_TYPE_GENERIC:
+      return true;
+
+#ifdef HAVE_SOCKET_POLL
+    case SOCKET_MULTIPLEXER_TYPE_POLL:
+      return true;
+#endif
+
+#ifdef HAVE_SOCKET_EPOLL
+    case SOCKET_MULTIPLEXER_TYPE_EPOLL:
+      return true;
+#endif
+
+#ifdef HAVE_SOCKET_KQUEUE
+    case SOCKET_MULTIPLEXER_TYPE_KQUEUE:
+      return true;
+#endif
+
+    default:
+      return false;
+  }
+}
+
+SOCKET_MULTIPLEXER_TYPE SocketMultiplexer::GetDefaultType()
+{
+#if defined(HAVE_SOCKET_EPOLL)
+  return SOCKET_MULTIPLEXER_TYPE_EPOLL;
+#elif defined(HAVE_SOCKET_KQUEUE)
+  return SOCKET_MULTIPLEXER_TYPE_KQUEUE;
+#elif defined(HAVE_SOCKET_POLL)
+  return SOCKET_MULTIPLEXER_TYPE_POLL;
+#else
+  return SOCKET_MULTIPLEXER_TYPE_GENERIC;
+#endif
 }
 
 SocketMultiplexer* SocketMultiplexer::Create(Error* pError)
 {
+  return Create(GetDefaultType(), pError);
+}
+
+SocketMultiplexer* SocketMultiplexer::Create(SOCKET_MULTIPLEXER_TYPE type, Error* pError)
+{
+  if (!IsTypeSupported(type))
+  {
+    if (pError != nullptr)
+      pError->SetErrorUserStaticFormatted(0, "Socket multiplexer type %u is not supported on this platform.",
+                                          (uint32)type);
+
+    return nullptr;
+  }
+
   if (!Platform::InitializeSocketSupport(pError))
     return nullptr;
 
-  return new SocketMultiplexer();
+  // one loop to begin with, worker threads add more
+  SocketMultiplexer* pMultiplexer = new SocketMultiplexer(type);
+  if (!pMultiplexer->AddEventLoop(pError))
+  {
+    delete pMultiplexer;
+    return nullptr;
+  }
+
+  return pMultiplexer;
 }
 
-ListenSocket* SocketMultiplexer::InternalCreateListenSocket(const SocketAddress* pAddress,
-                                                            CreateStreamSocketCallback callback, Error* pError)
+bool SocketMultiplexer::AddEventLoop(Error* pError)
 {
-  // create and bind socket
-  SOCKET fileDescriptor = INVALID_SOCKET;
+  DebugAssert(m_eventLoopCount < MaxEventLoops);
+
+  EventLoop* pEventLoop = new EventLoop(m_type);
+  if (!pEventLoop->Initialize(pError))
+  {
+    delete pEventLoop;
+    return false;
+  }
+
+  // the slot has to be visible before the count is
+  m_eventLoops[m_eventLoopCount] = pEventLoop;
+  Y_AtomicIncrement(m_eventLoopCount);
+  return true;
+}
+
+SOCKET SocketMultiplexer::OpenListenDescriptor(const SocketAddress* pAddress, const ListenOptions& options,
+                                               bool reusePort, Error* pError)
+{
+  int family;
+  socklen_t addressLength;
   switch (pAddress->GetType())
   {
     case SocketAddress::Type_IPv4:
-    {
-      fileDescriptor = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-      if (fileDescriptor == INVALID_SOCKET)
-      {
-        if (pError != nullptr)
-          pError->SetErrorSocket(WSAGetLastError());
+      family = AF_INET;
+      addressLength = sizeof(sockaddr_in);
+      break;
 
-        return nullptr;
-      }
+    case SocketAddress::Type_IPv6:
+      family = AF_INET6;
+      addressLength = sizeof(sockaddr_in6);
+      break;
 
-      if (bind(fileDescriptor, (const sockaddr*)pAddress->GetData(), sizeof(sockaddr_in)) < 0)
-      {
-        if (pError != nullptr)
-          pError->SetErrorSocket(WSAGetLastError());
+    default:
+    {
+      if (pError != nullptr)
+        pError->SetErrorUserStatic(0, "Unknown address type.");
 
-        closesocket(fileDescriptor);
-        return nullptr;
-      }
+      return INVALID_SOCKET;
+    }
+  }
 
-      if (listen(fileDescriptor, 5) < 0)
-      {
-        if (pError != nullptr)
-          pError->SetErrorSocket(WSAGetLastError());
+  // create and bind socket
+  SOCKET fileDescriptor = socket(family, SOCK_STREAM, IPPROTO_TCP);
+  if (fileDescriptor == INVALID_SOCKET)
+  {
+    if (pError != nullptr)
+      pError->SetErrorSocket(WSAGetLastError());
 
-        closesocket(fileDescriptor);
-        return nullptr;
-      }
+    return INVALID_SOCKET;
+  }
 
-      break;
-    }
+#ifdef HAVE_SOCKET_REUSEPORT
+  int value = 1;
+  if (reusePort && setsockopt(fileDescriptor, SOL_SOCKET, SO_REUSEPORT, &value, sizeof(value)) < 0)
+  {
+    if (pError != nullptr)
+      pError->SetErrorSocket(WSAGetLastError());
 
-    case SocketAddress::Type_IPv6:
-    {
-      fileDescriptor = socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP);
-      if (fileDescriptor == INVALID_SOCKET)
-      {
-        if (pError != nullptr)
-          pError->SetErrorSocket(WSAGetLastError());
+    closesocket(fileDescriptor);
+    return INVALID_SOCKET;
+  }
+#else
+  DebugAssert(!reusePort);
+#endif
 
-        return nullptr;
-      }
+#ifdef TCP_DEFER_ACCEPT
+  // only a hint, the kernel rounds it to its retransmit schedule
+  if (options.DeferAcceptSeconds > 0)
+  {
+    int seconds = (int)options.DeferAcceptSeconds;
+    setsockopt(fileDescriptor, IPPROTO_TCP, TCP_DEFER_ACCEPT, &seconds, sizeof(seconds));
+  }
+#endif
 
-      if (bind(fileDescriptor, (const sockaddr*)pAddress->GetData(), sizeof(sockaddr_in6)) < 0)
-      {
-        if (pError != nullptr)
-          pError->SetErrorSocket(WSAGetLastError());
+  // a deep backlog by default, so bursts of connections wait to be accepted rather than having their handshakes
+  // dropped
+  int backlog = (options.Backlog > 0) ? (int)Min(options.Backlog, (uint32)Y_INT32_MAX) : SOMAXCONN;
+  if (bind(fileDescriptor, (const sockaddr*)pAddress->GetData(), addressLength) < 0 ||
+      listen(fileDescriptor, backlog) < 0)
+  {
+    if (pError != nullptr)
+      pError->SetErrorSocket(WSAGetLastError());
 
-        closesocket(fileDescriptor);
-        return nullptr;
-      }
+    closesocket(fileDescriptor);
+    return INVALID_SOCKET;
+  }
 
-      if (listen(fileDescriptor, 5) < 0)
-      {
-        if (pError != nullptr)
-          pError->SetErrorSocket(WSAGetLastError());
+  return fileDescriptor;
+}
 
-        closesocket(fileDescriptor);
-        return nullptr;
-      }
+ListenSocket* SocketMultiplexer::InternalCreateListenSocket(const SocketAddress* pAddress,
+                                                            const ListenOptions& options,
+                                                            CreateStreamSocketCallback callback, Error* pError)
+{
+  SOCKET fileDescriptor = OpenListenDescriptor(pAddress, options, false, pError);
+  if (fileDescriptor == INVALID_SOCKET)
+    return nullptr;
 
-      break;
-    }
+  // create listensocket
+  return new ListenSocket(this, callback, fileDescriptor);
+}
 
-    default:
+bool SocketMultiplexer::InternalCreateListenSockets(const SocketAddress* pAddress, const ListenOptions& options,
+                                                    CreateStreamSocketCallback callback,
+                                                    PODArray<ListenSocket*>* pSockets, Error* pError)
+{
+#ifdef HAVE_SOCKET_REUSEPORT
+  // one per loop, each accepting onto its own loop
+  uint32 eventLoopCount = m_eventLoopCount;
+  uint32 firstSocket = pSockets->GetSize();
+  for (uint32 i = 0; i < eventLoopCount; i++)
+  {
+    SOCKET fileDescriptor = OpenListenDescriptor(pAddress, options, true, pError);
+    if (fileDescriptor == INVALID_SOCKET)
     {
-      if (pError != nullptr)
-        pError->SetErrorUser((int32)0, "Unknown address type.");
-
-      return nullptr;
+      for (uint32 j = firstSocket; j < pSockets->GetSize(); j++)
+      {
+        (*pSockets)[j]->Close();
+        (*pSockets)[j]->Release();
+      }
+      pSockets->Resize(firstSocket);
+      return false;
     }
+
+    pSockets->Add(new ListenSocket(this, callback, fileDescriptor, i));
   }
 
-  // create listensocket
-  return new ListenSocket(this, callback, fileDescriptor);
+  return true;
+#else
+  ListenSocket* pSocket = InternalCreateListenSocket(pAddress, options, callback, pError);
+  if (pSocket == nullptr)
+    return false;
+
+  pSockets->Add(pSocket);
+  return true;
+#endif
+}
+
+// Defers the handshake to the first send, on linux, which has the option. Elsewhere the connect is as usual.
+static void EnableFastOpenConnect(SOCKET fileDescriptor)
+{
+#ifdef TCP_FASTOPEN_CONNECT
+  int value = 1;
+  setsockopt(fileDescriptor, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, (const char*)&value, sizeof(value));
+#endif
 }
 
 StreamSocket* SocketMultiplexer::InternalConnectStreamSocket(const SocketAddress* pAddress,
-                                                             CreateStreamSocketCallback callback, Error* pError)
+                                                             CreateStreamSocketCallback callback, Error* pError,
+                                                             bool fastOpen /*= false*/)
 {
   // create and bind socket
   SOCKET fileDescriptor = INVALID_SOCKET;
@@ -135,6 +316,9 @@ StreamSocket* SocketMultiplexer::InternalConnectStreamSocket(const SocketAddress
         return nullptr;
       }
 
+      if (fastOpen)
+        EnableFastOpenConnect(fileDescriptor);
+
       if (connect(fileDescriptor, (const sockaddr*)pAddress->GetData(), sizeof(sockaddr_in)) < 0)
       {
         if (pError != nullptr)
@@ -158,6 +342,9 @@ StreamSocket* SocketMultiplexer::InternalConnectStreamSocket(const SocketAddress
         return nullptr;
       }
 
+      if (fastOpen)
+        EnableFastOpenConnect(fileDescriptor);
+
       if (connect(fileDescriptor, (const sockaddr*)pAddress->GetData(), sizeof(sockaddr_in6)) < 0)
       {
         if (pError != nullptr)
@@ -173,7 +360,7 @@ StreamSocket* SocketMultiplexer::InternalConnectStreamSocket(const SocketAddress
     default:
     {
       if (pError != nullptr)
-        pError->SetErrorUser((int32)0, "Unknown address type.");
+        pError->SetErrorUserStatic(0, "Unknown address type.");
 
       return nullptr;
     }
@@ -187,11 +374,155 @@ StreamSocket* SocketMultiplexer::InternalConnectStreamSocket(const SocketAddress
     return nullptr;
   }
 
+  // a deferred connect has no peer name until the handshake, but we know who it's to
+  if (pSocket->m_remoteAddress.GetType() == SocketAddress::Type_Unknown)
+    pSocket->m_remoteAddress = *pAddress;
+
+  return pSocket;
+}
+
+class SocketMultiplexer::PendingResolve : public SocketResolver::Request
+{
+public:
+  PendingResolve(SocketMultiplexer* pMultiplexer, const char* hostName, uint32 port, ResolveFunction resolveCallback,
+                 CreateStreamSocketCallback createCallback, ConnectFunction connectCallback)
+    : SocketResolver::Request(hostName, port), m_pMultiplexer(pMultiplexer),
+      m_resolveCallback(std::move(resolveCallback)), m_createCallback(createCallback),
+      m_connectCallback(std::move(connectCallback)), m_pSocket(nullptr)
+  {
+  }
+
+  // a socket that was never handed over is closed
+  virtual ~PendingResolve()
+  {
+    if (m_pSocket != nullptr)
+    {
+      m_pSocket->Close();
+      m_pSocket->Release();
+    }
+  }
+
+  // on a resolver thread, so the connect can block
+  virtual void OnResolved() override
+  {
+    if (m_connectCallback && IsResolved())
+      m_pSocket = m_pMultiplexer->InternalConnectStreamSocket(GetAddress(), m_createCallback, &m_connectError);
+
+    m_pMultiplexer->QueueCompletion(this, m_pSocket);
+  }
+
+  // on the event loop's thread
+  void Complete()
+  {
+    if (m_connectCallback)
+    {
+      StreamSocket* pSocket = m_pSocket;
+      m_pSocket = nullptr;
+      m_connectCallback(pSocket, IsResolved() ? &m_connectError : GetError());
+    }
+    else
+    {
+      m_resolveCallback(IsResolved() ? GetAddress() : nullptr, GetError());
+    }
+  }
+
+private:
+  SocketMultiplexer* m_pMultiplexer;
+  ResolveFunction m_resolveCallback;
+  CreateStreamSocketCallback m_createCallback;
+  ConnectFunction m_connectCallback;
+
+  StreamSocket* m_pSocket;
+  Error m_connectError;
+};
+
+void SocketMultiplexer::ResolveAddress(const char* hostName, uint32 port, ResolveCallback callback, void* pUserData)
+{
+  ResolveAddress(hostName, port, [callback, pUserData](const SocketAddress* pAddress, const Error* pError) {
+    callback(pAddress, pError, pUserData);
+  });
+}
+
+void SocketMultiplexer::ResolveAddress(const char* hostName, uint32 port, ResolveFunction callback)
+{
+  m_pResolver->Resolve(new PendingResolve(this, hostName, port, std::move(callback), nullptr, nullptr));
+}
+
+void SocketMultiplexer::InternalConnectStreamSocket(const char* hostName, uint32 port,
+                                                    CreateStreamSocketCallback createCallback,
+                                                    ConnectFunction callback)
+{
+  m_pResolver->Resolve(new PendingResolve(this, hostName, port, nullptr, createCallback, std::move(callback)));
+}
+
+void SocketMultiplexer::QueueCompletion(PendingResolve* pPendingResolve, const BaseSocket* pSocket)
+{
+  uint32 eventLoopIndex = (pSocket != nullptr) ? pSocket->m_eventLoopIndex : 0;
+  m_eventLoops[eventLoopIndex]->QueueCompletion(pPendingResolve);
+}
+
+DatagramSocket* SocketMultiplexer::InternalCreateDatagramSocket(const SocketAddress* pBindAddress,
+                                                                CreateDatagramSocketCallback callback, Error* pError)
+{
+  int family;
+  switch (pBindAddress->GetType())
+  {
+    case SocketAddress::Type_IPv4:
+      family = AF_INET;
+      break;
+
+    case SocketAddress::Type_IPv6:
+      family = AF_INET6;
+      break;
+
+    default:
+    {
+      if (pError != nullptr)
+        pError->SetErrorUserStatic(0, "Unknown address type.");
+
+      return nullptr;
+    }
+  }
+
+  // create and bind socket
+  SOCKET fileDescriptor = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+  if (fileDescriptor == INVALID_SOCKET)
+  {
+    if (pError != nullptr)
+      pError->SetErrorSocket(WSAGetLastError());
+
+    return nullptr;
+  }
+
+  if (bind(fileDescriptor, (const sockaddr*)pBindAddress->GetData(), (socklen_t)pBindAddress->GetLength()) < 0)
+  {
+    if (pError != nullptr)
+      pError->SetErrorSocket(WSAGetLastError());
+
+    closesocket(fileDescriptor);
+    return nullptr;
+  }
+
+  // the socket takes the descriptor, closing it on failure
+  DatagramSocket* pSocket = callback();
+  if (!pSocket->InitializeSocket(this, fileDescriptor, pError))
+  {
+    pSocket->Release();
+    return nullptr;
+  }
+
   return pSocket;
 }
 
-void SocketMultiplexer::AddOpenSocket(BaseSocket* pSocket)
+void SocketMultiplexer::AddOpenSocket(BaseSocket* pSocket, uint32 eventLoopIndex /*= Y_UINT32_MAX*/)
 {
+  // spread across the loops in turn
+  if (eventLoopIndex == Y_UINT32_MAX)
+    eventLoopIndex = (Y_AtomicIncrement(m_nextEventLoop) - 1) % m_eventLoopCount;
+
+  DebugAssert(eventLoopIndex < m_eventLoopCount);
+  pSocket->m_eventLoopIndex = eventLoopIndex;
+
   m_openSocketLock.Lock();
 
   DebugAssert(m_openSockets.IndexOf(pSocket) < 0);
@@ -205,16 +536,10 @@ void SocketMultiplexer::RemoveOpenSocket(BaseSocket* pSocket)
 {
   m_openSocketLock.Lock();
 
-#ifdef Y_BUILD_CONFIG_DEBUG
-  // double-locking, living dangerously!
-  m_boundSocketLock.Lock();
-  for (BoundSocket& boundSocket : m_boundSockets)
-    DebugAssert(boundSocket.pSocket != pSocket);
-  m_boundSocketLock.Unlock();
-#endif
-
+  DebugAssert(!m_eventLoops[pSocket->m_eventLoopIndex]->IsBound(pSocket));
   DebugAssert(m_openSockets.IndexOf(pSocket) >= 0);
   m_openSockets.FastRemoveItem(pSocket);
+  m_closedSocketStats.Accumulate(pSocket->m_stats);
   pSocket->Release();
 
   m_openSocketLock.Unlock();
@@ -252,171 +577,815 @@ void SocketMultiplexer::CloseAll()
   }
 }
 
-void SocketMultiplexer::SetNotificationMask(BaseSocket* pSocket, SOCKET fileDescriptor, uint32 mask)
+SocketMultiplexerStats SocketMultiplexer::GetStats()
 {
-  m_boundSocketLock.Lock();
+  SocketMultiplexerStats stats;
+  stats.EventLoopCount = m_eventLoopCount;
+  for (uint32 i = 0; i < stats.EventLoopCount; i++)
+    m_eventLoops[i]->AccumulateStats(&stats);
 
-  for (uint32 i = 0; i < m_boundSockets.GetSize(); i++)
-  {
-    BoundSocket& boundSocket = m_boundSockets[i];
-    if (boundSocket.FileDescriptor == fileDescriptor)
-    {
-      DebugAssert(boundSocket.pSocket == pSocket);
+  m_openSocketLock.Lock();
 
-      // unbinding?
-      if (mask != 0)
-        boundSocket.EventMask = mask;
-      else
-        m_boundSockets.FastRemove(i);
+  stats.OpenSockets = m_openSockets.GetSize();
+  stats.Totals = m_closedSocketStats;
+  for (BaseSocket* pSocket : m_openSockets)
+    stats.Totals.Accumulate(pSocket->m_stats);
 
-      m_boundSocketLock.Unlock();
-      return;
-    }
-  }
+  m_openSocketLock.Unlock();
+  return stats;
+}
 
-  // don't create entries for null masks
-  if (mask != 0)
-  {
-    BoundSocket boundSocket;
-    boundSocket.pSocket = pSocket;
-    boundSocket.FileDescriptor = fileDescriptor;
-    boundSocket.EventMask = mask;
-    m_boundSockets.Add(boundSocket);
-  }
+void SocketMultiplexer::SetNotificationMask(BaseSocket* pSocket, SOCKET fileDescriptor, uint32 mask)
+{
+  m_eventLoops[pSocket->m_eventLoopIndex]->SetNotificationMask(pSocket, fileDescriptor, mask);
+}
 
-  m_wakeupEvent.Signal();
-  m_boundSocketLock.Unlock();
+SocketMultiplexer::EventLoop::EventLoop(SOCKET_MULTIPLEXER_TYPE type)
+  : m_type(type), m_kernelQueue(-1), m_wakeupSocket(INVALID_SOCKET), m_waitEndTick(0), m_timerBase(Y_TimerGetValue()),
+    m_pCompletions(nullptr), m_socketEvents(0), m_timersFired(0), m_completionsRun(0), m_wakeTime(0),
+    m_pWorkerThread(nullptr)
+{
+  m_boundSocketLock.SetProfileName("socketmultiplexer.bound_sockets");
 }
 
-void SocketMultiplexer::PollEvents(uint32 milliseconds)
+SocketMultiplexer::EventLoop::~EventLoop()
 {
-  fd_set readFds;
-  fd_set writeFds;
-  SOCKET maxFileDescriptor = 0;
-  uint32 setCount = 0;
+  DebugAssert(m_pWorkerThread == nullptr);
 
-  // loop until we get some sockets
-  for (;;)
+  // resolves never called back are dropped
+  while (m_pCompletions != nullptr)
   {
-    // clear set
-    FD_ZERO(&readFds);
-    FD_ZERO(&writeFds);
+    PendingResolve* pPendingResolve = m_pCompletions;
+    m_pCompletions = static_cast<PendingResolve*>(pPendingResolve->m_pNext);
+    delete pPendingResolve;
+  }
 
-    // fill stuff
-    m_boundSocketLock.Lock();
-    for (BoundSocket& boundSocket : m_boundSockets)
-    {
-      if (boundSocket.EventMask & EventType_Read)
-        FD_SET(boundSocket.FileDescriptor, &readFds);
-      if (boundSocket.EventMask & EventType_Write)
-        FD_SET(boundSocket.FileDescriptor, &writeFds);
+#if !defined(Y_PLATFORM_POSIX)
+  if (m_wakeupSocket != INVALID_SOCKET)
+    closesocket(m_wakeupSocket);
+#endif
 
-      maxFileDescriptor = Max(boundSocket.FileDescriptor, maxFileDescriptor);
-      setCount++;
+#if defined(HAVE_SOCKET_EPOLL) || defined(HAVE_SOCKET_KQUEUE)
+  if (m_kernelQueue >= 0)
+    close(m_kernelQueue);
+#endif
+}
+
+bool SocketMultiplexer::EventLoop::Initialize(Error* pError)
+{
+#ifdef HAVE_SOCKET_EPOLL
+  if (m_type == SOCKET_MULTIPLEXER_TYPE_EPOLL)
+    m_kernelQueue = epoll_create1(EPOLL_CLOEXEC);
+#endif
+#ifdef HAVE_SOCKET_KQUEUE
+  if (m_type == SOCKET_MULTIPLEXER_TYPE_KQUEUE)
+    m_kernelQueue = kqueue();
+#endif
+
+  if ((m_type == SOCKET_MULTIPLEXER_TYPE_EPOLL || m_type == SOCKET_MULTIPLEXER_TYPE_KQUEUE) && m_kernelQueue < 0)
+  {
+    if (pError != nullptr)
+      pError->SetErrorErrno(errno);
+
+    return false;
+  }
+
+  // without it the loop still works, but a wait only ends early for a timer scheduled from its own thread
+  if (!CreateWakeupSocket())
+  {
+    Log_WarningPrint("SocketMultiplexer::EventLoop::Initialize: Failed to create wakeup socket, timers scheduled from "
+                     "other threads may fire late");
+  }
+
+  return true;
+}
+
+bool SocketMultiplexer::EventLoop::CreateWakeupSocket()
+{
+#if defined(Y_PLATFORM_POSIX)
+  // the event's descriptor is readable while it's signaled, which is all the socket is for
+  SOCKET fileDescriptor = m_wakeupPollableEvent.GetFileDescriptor();
+  if (!UpdateKernelMask(fileDescriptor, 0, EventType_Read))
+    return false;
+
+  m_wakeupSocket = fileDescriptor;
+  return true;
+#else
+  SOCKET fileDescriptor = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (fileDescriptor == INVALID_SOCKET)
+    return false;
+
+  // bound to any loopback port, then connected to itself so nothing else can send to it
+  sockaddr_in address;
+  Y_memzero(&address, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addressLength = sizeof(address);
+  unsigned long value = 1;
+  if (bind(fileDescriptor, (const sockaddr*)&address, sizeof(address)) < 0 ||
+      getsockname(fileDescriptor, (sockaddr*)&address, &addressLength) < 0 ||
+      connect(fileDescriptor, (const sockaddr*)&address, addressLength) < 0 ||
+      ioctlsocket(fileDescriptor, FIONBIO, &value) < 0)
+  {
+    closesocket(fileDescriptor);
+    return false;
+  }
+
+  // the kernel queues watch it from here on, select and poll add it to each wait
+  if (!UpdateKernelMask(fileDescriptor, 0, EventType_Read))
+  {
+    closesocket(fileDescriptor);
+    return false;
+  }
+
+  m_wakeupSocket = fileDescriptor;
+  return true;
+#endif
+}
+
+void SocketMultiplexer::EventLoop::DrainWakeupSocket()
+{
+#if defined(Y_PLATFORM_POSIX)
+  m_wakeupPollableEvent.Reset();
+#else
+  char buffer[16];
+  while (recv(m_wakeupSocket, buffer, sizeof(buffer), 0) > 0)
+    ;
+#endif
+}
+
+void SocketMultiplexer::EventLoop::Wakeup()
+{
+  m_wakeupEvent.Signal();
+
+  // the datagram just has to be there, if the socket's buffer is full it already is
+  if (m_wakeupSocket != INVALID_SOCKET)
+  {
+#if defined(Y_PLATFORM_POSIX)
+    m_wakeupPollableEvent.Signal();
+#else
+    char value = 0;
+    send(m_wakeupSocket, &value, 1, 0);
+#endif
+  }
+}
+
+bool SocketMultiplexer::EventLoop::IsBound(const BaseSocket* pSocket)
+{
+  m_boundSocketLock.Lock();
+
+  bool bound = false;
+  for (const BoundSocket& boundSocket : m_boundSockets)
+  {
+    if (boundSocket.pSocket == pSocket)
+    {
+      bound = true;
+      break;
     }
+  }
+
+  m_boundSocketLock.Unlock();
+  return bound;
+}
+
+void SocketMultiplexer::EventLoop::SetNotificationMask(BaseSocket* pSocket, SOCKET fileDescriptor, uint32 mask)
+{
+  m_boundSocketLock.Lock();
+
+  HashTable<SOCKET, uint32>::Member* pIndexMember = m_boundSocketIndices.Find(fileDescriptor);
+  if (pIndexMember != nullptr)
+  {
+    uint32 index = pIndexMember->Value;
+    BoundSocket& boundSocket = m_boundSockets[index];
+    DebugAssert(boundSocket.FileDescriptor == fileDescriptor && boundSocket.pSocket == pSocket);
+
+    // select and poll only see the change on their next wait, so one in progress is cut short
+    bool wakeup = false;
+    if (mask != boundSocket.EventMask)
+    {
+      UpdateKernelMask(fileDescriptor, boundSocket.EventMask, mask);
+      wakeup = (m_kernelQueue < 0 && m_waitEndTick != 0);
+    }
+
+    // unbinding?
+    if (mask != 0)
+    {
+      boundSocket.EventMask = mask;
+    }
+    else
+    {
+      // the last entry moves into the hole
+      m_boundSocketIndices.Remove(pIndexMember);
+      m_boundSockets.FastRemove(index);
+      if (index < m_boundSockets.GetSize())
+        m_boundSocketIndices.Find(m_boundSockets[index].FileDescriptor)->Value = index;
+    }
+
     m_boundSocketLock.Unlock();
-    if (setCount > 0)
-      break;
+    if (wakeup)
+      Wakeup();
+
+    return;
+  }
+
+  // don't create entries for null masks
+  bool wakeup = false;
+  if (mask != 0 && UpdateKernelMask(fileDescriptor, 0, mask))
+  {
+    BoundSocket boundSocket;
+    boundSocket.pSocket = pSocket;
+    boundSocket.FileDescriptor = fileDescriptor;
+    boundSocket.EventMask = mask;
+    m_boundSocketIndices.Insert(fileDescriptor, m_boundSockets.GetSize());
+    m_boundSockets.Add(boundSocket);
+    wakeup = (m_kernelQueue < 0 && m_waitEndTick != 0);
+  }
 
-    // win32 select doesn't seem to sleep as one would expect.
-    if (milliseconds == 0)
-      return;
+  m_wakeupEvent.Signal();
+  m_boundSocketLock.Unlock();
+  if (wakeup)
+    Wakeup();
+}
 
+bool SocketMultiplexer::EventLoop::UpdateKernelMask(SOCKET fileDescriptor, uint32 oldMask, uint32 newMask)
+{
+#ifdef HAVE_SOCKET_EPOLL
+  if (m_type == SOCKET_MULTIPLEXER_TYPE_EPOLL)
+  {
+    // level-triggered, as the sockets leave data unread when their buffers fill, and accept once per event
+    epoll_event ev = {};
+    ev.events = ((newMask & EventType_Read) ? (uint32)EPOLLIN : 0) |
+                ((newMask & EventType_Write) ? (uint32)EPOLLOUT : 0);
+    ev.data.fd = fileDescriptor;
+
+    int op = (oldMask == 0) ? EPOLL_CTL_ADD : ((newMask == 0) ? EPOLL_CTL_DEL : EPOLL_CTL_MOD);
+    if (epoll_ctl(m_kernelQueue, op, fileDescriptor, &ev) < 0)
+    {
+      Log_ErrorPrintf("SocketMultiplexer::UpdateKernelMask: epoll_ctl(%d) failed: %d", op, errno);
+      return false;
+    }
+  }
+#endif
+
+#ifdef HAVE_SOCKET_KQUEUE
+  if (m_type == SOCKET_MULTIPLEXER_TYPE_KQUEUE)
+  {
+    // a filter for each event, only changing the ones that differ
+    struct kevent changes[2];
+    int nChanges = 0;
+    if ((oldMask ^ newMask) & EventType_Read)
+    {
+      EV_SET(&changes[nChanges], fileDescriptor, EVFILT_READ, (newMask & EventType_Read) ? EV_ADD : EV_DELETE, 0, 0,
+             nullptr);
+      nChanges++;
+    }
+    if ((oldMask ^ newMask) & EventType_Write)
+    {
+      EV_SET(&changes[nChanges], fileDescriptor, EVFILT_WRITE, (newMask & EventType_Write) ? EV_ADD : EV_DELETE, 0,
+             0, nullptr);
+      nChanges++;
+    }
+
+    if (nChanges > 0 && kevent(m_kernelQueue, changes, nChanges, nullptr, 0, nullptr) < 0)
+    {
+      Log_ErrorPrintf("SocketMultiplexer::UpdateKernelMask: kevent failed: %d", errno);
+      return false;
+    }
+  }
+#endif
+
+  return true;
+}
+
+bool SocketMultiplexer::EventLoop::FindTriggeredSocket(SOCKET fileDescriptor, uint32 eventMask,
+                                            TriggeredSocket* pTriggeredSocket)
+{
+  const HashTable<SOCKET, uint32>::Member* pIndexMember = m_boundSocketIndices.Find(fileDescriptor);
+  if (pIndexMember == nullptr)
+    return false;
+
+  const BoundSocket& boundSocket = m_boundSockets[pIndexMember->Value];
+  eventMask &= boundSocket.EventMask;
+  if (eventMask == 0)
+    return false;
+
+  // we add a reference here in case the read kills it with a write pending, or something like that
+  pTriggeredSocket->pSocket = boundSocket.pSocket;
+  pTriggeredSocket->EventMask = eventMask;
+  pTriggeredSocket->pSocket->AddRef();
+  return true;
+}
+
+void SocketMultiplexer::EventLoop::FireTriggeredSockets(TriggeredSocket* pTriggeredSockets, uint32 count)
+{
+  Y_PROFILE_ZONE("SocketMultiplexer::FireTriggeredSockets");
+  m_socketEvents += count;
+  for (uint32 i = 0; i < count; i++)
+  {
+    BaseSocket* pSocket = pTriggeredSockets[i].pSocket;
+    uint32 eventMask = pTriggeredSockets[i].EventMask;
+
+    // fire events
+    if (eventMask & EventType_Read)
+      pSocket->OnReadEvent();
+    if (eventMask & EventType_Write)
+      pSocket->OnWriteEvent();
+
+    // release temporary reference
+    pSocket->Release();
+  }
+}
+
+void SocketMultiplexer::EventLoop::PollEvents(uint32 milliseconds)
+{
+  // wait no longer than the nearest timer, noting when the wait ends so sooner timers wake it
+  m_boundSocketLock.Lock();
+  milliseconds = m_timerWheel.GetTimerWait(GetCurrentTick(), milliseconds);
+  if (milliseconds == Y_UINT32_MAX)
+    m_waitEndTick = Y_UINT64_MAX;
+  else if (milliseconds != 0)
+    m_waitEndTick = GetCurrentTick() + milliseconds;
+  uint32 setCount = m_boundSockets.GetSize();
+
+  // completions already queued are run straight after
+  if (m_pCompletions != nullptr)
+  {
+    milliseconds = 0;
+    m_waitEndTick = 0;
+  }
+  m_boundSocketLock.Unlock();
+
+  // win32 select doesn't seem to sleep as one would expect, so with no sockets wait for one to be added.
+  if (setCount == 0 && milliseconds != 0)
+  {
     // in case a socket is added/removed in the meantime.
-    if (!m_wakeupEvent.TryWait(milliseconds))
-      return;
+    if (m_wakeupEvent.TryWait(milliseconds))
+    {
+      // exit immediately after this next poll, don't wait.
+      m_wakeupEvent.Reset();
+      m_boundSocketLock.Lock();
+      setCount = m_boundSockets.GetSize();
+      m_boundSocketLock.Unlock();
+    }
 
-    // exit immediately after this next poll, don't wait.
-    m_wakeupEvent.Reset();
     milliseconds = 0;
   }
 
+  m_wakeTime = 0;
+  uint64 handledCount = m_socketEvents + m_timersFired + m_completionsRun;
+  if (setCount > 0)
+    PollSockets(milliseconds);
+  if (m_wakeTime == 0)
+    MarkWakeTime();
+
+  FireTimers();
+  RunCompletions();
+
+  // waits that timed out with nothing to do aren't counted, they'd only hide the iterations that did something
+  if (m_socketEvents + m_timersFired + m_completionsRun != handledCount)
+    m_iterationTime.Record(Y_TimerGetValue() - m_wakeTime);
+}
+
+void SocketMultiplexer::EventLoop::PollSockets(uint32 milliseconds)
+{
+  switch (m_type)
+  {
+    case SOCKET_MULTIPLEXER_TYPE_POLL:
+      PollPoll(milliseconds);
+      break;
+
+    case SOCKET_MULTIPLEXER_TYPE_EPOLL:
+      PollEPoll(milliseconds);
+      break;
+
+    case SOCKET_MULTIPLEXER_TYPE_KQUEUE:
+      PollKQueue(milliseconds);
+      break;
+
+    default:
+      PollSelect(milliseconds);
+      break;
+  }
+}
+
+void SocketMultiplexer::EventLoop::PollSelect(uint32 milliseconds)
+{
+  fd_set readFds;
+  fd_set writeFds;
+  SOCKET maxFileDescriptor = 0;
+  uint32 setCount = 0;
+
+  // fill stuff
+  FD_ZERO(&readFds);
+  FD_ZERO(&writeFds);
+  m_boundSocketLock.Lock();
+  for (BoundSocket& boundSocket : m_boundSockets)
+  {
+    if (boundSocket.EventMask & EventType_Read)
+      FD_SET(boundSocket.FileDescriptor, &readFds);
+    if (boundSocket.EventMask & EventType_Write)
+      FD_SET(boundSocket.FileDescriptor, &writeFds);
+
+    maxFileDescriptor = Max(boundSocket.FileDescriptor, maxFileDescriptor);
+    setCount++;
+  }
+  m_boundSocketLock.Unlock();
+  if (setCount == 0)
+    return;
+
+  if (m_wakeupSocket != INVALID_SOCKET)
+  {
+    FD_SET(m_wakeupSocket, &readFds);
+    maxFileDescriptor = Max(m_wakeupSocket, maxFileDescriptor);
+  }
+
   // call select
   timeval tv;
   tv.tv_sec = milliseconds / 1000;
   tv.tv_usec = (milliseconds % 1000) * 1000;
   int result =
     select((int)maxFileDescriptor + 1, &readFds, &writeFds, nullptr, (milliseconds != Y_UINT32_MAX) ? &tv : nullptr);
+  MarkWakeTime();
   if (result <= 0)
     return;
 
+  if (m_wakeupSocket != INVALID_SOCKET && FD_ISSET(m_wakeupSocket, &readFds))
+    DrainWakeupSocket();
+
   // find sockets that triggered, we use an array here so we can avoid holding the lock, and if a socket disconnects
-  BoundSocket* pTriggeredSockets = (BoundSocket*)alloca(sizeof(BoundSocket) * setCount);
+  TriggeredSocket* pTriggeredSockets = (TriggeredSocket*)alloca(sizeof(TriggeredSocket) * setCount);
   uint32 nTriggeredSockets = 0;
   m_boundSocketLock.Lock();
-  for (BoundSocket& boundSocket : m_boundSockets)
+
+  // the wait's over, so the handlers' mask changes don't cut the next one short
+  m_waitEndTick = 0;
+  for (uint32 i = 0; i < m_boundSockets.GetSize() && nTriggeredSockets < setCount; i++)
   {
+    const BoundSocket& boundSocket = m_boundSockets[i];
     uint32 eventMask = 0;
     if (FD_ISSET(boundSocket.FileDescriptor, &readFds))
       eventMask |= EventType_Read;
     if (FD_ISSET(boundSocket.FileDescriptor, &writeFds))
       eventMask |= EventType_Write;
 
-    if (eventMask != 0)
+    if (eventMask != 0 &&
+        FindTriggeredSocket(boundSocket.FileDescriptor, eventMask, &pTriggeredSockets[nTriggeredSockets]))
     {
-      pTriggeredSockets[nTriggeredSockets].pSocket = boundSocket.pSocket;
-      pTriggeredSockets[nTriggeredSockets].EventMask = eventMask;
       nTriggeredSockets++;
     }
   }
   m_boundSocketLock.Unlock();
 
-  // fire events
-  for (uint32 i = 0; i < nTriggeredSockets; i++)
+  FireTriggeredSockets(pTriggeredSockets, nTriggeredSockets);
+}
+
+void SocketMultiplexer::EventLoop::PollPoll(uint32 milliseconds)
+{
+#ifdef HAVE_SOCKET_POLL
+  // the set can change while we wait, so the descriptors are looked up again afterwards
+  m_boundSocketLock.Lock();
+  uint32 setCount = m_boundSockets.GetSize();
+  pollfd* pPollFds = (pollfd*)alloca(sizeof(pollfd) * (setCount + 1));
+  for (uint32 i = 0; i < setCount; i++)
   {
-    // we add a reference here in case the read kills it with a write pending, or something like that
-    BaseSocket* pSocket = pTriggeredSockets[i].pSocket;
-    uint32 eventMask = pTriggeredSockets[i].EventMask;
-    pSocket->AddRef();
+    const BoundSocket& boundSocket = m_boundSockets[i];
+    pPollFds[i].fd = boundSocket.FileDescriptor;
+    pPollFds[i].events = ((boundSocket.EventMask & EventType_Read) ? POLL_READ_EVENTS : 0) |
+                         ((boundSocket.EventMask & EventType_Write) ? POLL_WRITE_EVENTS : 0);
+    pPollFds[i].revents = 0;
+  }
+  m_boundSocketLock.Unlock();
+  if (setCount == 0)
+    return;
 
-    // fire events
-    if (eventMask & EventType_Read)
-      pSocket->OnReadEvent();
-    if (eventMask & EventType_Write)
-      pSocket->OnWriteEvent();
+  // the wakeup socket goes last
+  uint32 pollCount = setCount;
+  if (m_wakeupSocket != INVALID_SOCKET)
+  {
+    pPollFds[pollCount].fd = m_wakeupSocket;
+    pPollFds[pollCount].events = POLL_READ_EVENTS;
+    pPollFds[pollCount].revents = 0;
+    pollCount++;
+  }
 
-    // release temporary reference
-    pSocket->Release();
+  int result = poll(pPollFds, pollCount, (milliseconds != Y_UINT32_MAX) ? (int)milliseconds : -1);
+  MarkWakeTime();
+  if (result <= 0)
+    return;
+
+  if (pollCount > setCount && pPollFds[setCount].revents != 0)
+    DrainWakeupSocket();
+
+  TriggeredSocket* pTriggeredSockets = (TriggeredSocket*)alloca(sizeof(TriggeredSocket) * setCount);
+  uint32 nTriggeredSockets = 0;
+  m_boundSocketLock.Lock();
+  m_waitEndTick = 0;
+  for (uint32 i = 0; i < setCount; i++)
+  {
+    // errors and hangups are reported on whichever event the socket is waiting for, whose handler finds them
+    short revents = pPollFds[i].revents;
+    if (revents == 0)
+      continue;
+
+    uint32 eventMask = 0;
+    if (revents & (POLL_READ_EVENTS | POLLERR | POLLHUP))
+      eventMask |= EventType_Read;
+    if (revents & (POLL_WRITE_EVENTS | POLLERR | POLLHUP))
+      eventMask |= EventType_Write;
+
+    if (FindTriggeredSocket(pPollFds[i].fd, eventMask, &pTriggeredSockets[nTriggeredSockets]))
+      nTriggeredSockets++;
+  }
+  m_boundSocketLock.Unlock();
+
+  FireTriggeredSockets(pTriggeredSockets, nTriggeredSockets);
+#endif
+}
+
+void SocketMultiplexer::EventLoop::PollEPoll(uint32 milliseconds)
+{
+#ifdef HAVE_SOCKET_EPOLL
+  epoll_event events[KERNEL_QUEUE_BATCH_SIZE];
+  int result = epoll_wait(m_kernelQueue, events, KERNEL_QUEUE_BATCH_SIZE,
+                          (milliseconds != Y_UINT32_MAX) ? (int)milliseconds : -1);
+  MarkWakeTime();
+  if (result <= 0)
+    return;
+
+  TriggeredSocket pTriggeredSockets[KERNEL_QUEUE_BATCH_SIZE];
+  uint32 nTriggeredSockets = 0;
+  m_boundSocketLock.Lock();
+  for (int i = 0; i < result; i++)
+  {
+    if (events[i].data.fd == m_wakeupSocket)
+    {
+      DrainWakeupSocket();
+      continue;
+    }
+
+    uint32 eventMask = 0;
+    if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+      eventMask |= EventType_Read;
+    if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+      eventMask |= EventType_Write;
+
+    if (FindTriggeredSocket(events[i].data.fd, eventMask, &pTriggeredSockets[nTriggeredSockets]))
+      nTriggeredSockets++;
+  }
+  m_boundSocketLock.Unlock();
+
+  FireTriggeredSockets(pTriggeredSockets, nTriggeredSockets);
+#endif
+}
+
+void SocketMultiplexer::EventLoop::PollKQueue(uint32 milliseconds)
+{
+#ifdef HAVE_SOCKET_KQUEUE
+  timespec ts;
+  ts.tv_sec = milliseconds / 1000;
+  ts.tv_nsec = (milliseconds % 1000) * 1000000;
+
+  struct kevent events[KERNEL_QUEUE_BATCH_SIZE];
+  int result = kevent(m_kernelQueue, nullptr, 0, events, KERNEL_QUEUE_BATCH_SIZE,
+                      (milliseconds != Y_UINT32_MAX) ? &ts : nullptr);
+  MarkWakeTime();
+  if (result <= 0)
+    return;
+
+  // each filter is its own event, so a socket that's readable and writable comes back twice
+  TriggeredSocket pTriggeredSockets[KERNEL_QUEUE_BATCH_SIZE];
+  uint32 nTriggeredSockets = 0;
+  m_boundSocketLock.Lock();
+  for (int i = 0; i < result; i++)
+  {
+    if ((SOCKET)events[i].ident == m_wakeupSocket)
+    {
+      DrainWakeupSocket();
+      continue;
+    }
+
+    uint32 eventMask = (events[i].filter == EVFILT_READ) ? EventType_Read : EventType_Write;
+    if (FindTriggeredSocket((SOCKET)events[i].ident, eventMask, &pTriggeredSockets[nTriggeredSockets]))
+      nTriggeredSockets++;
+  }
+  m_boundSocketLock.Unlock();
+
+  FireTriggeredSockets(pTriggeredSockets, nTriggeredSockets);
+#endif
+}
+
+uint64 SocketMultiplexer::EventLoop::GetCurrentTick() const
+{
+  return (uint64)Y_TimerConvertToMilliseconds(Y_TimerGetValue() - m_timerBase);
+}
+
+void SocketMultiplexer::EventLoop::ScheduleTimer(SocketTimer* pTimer, uint32 milliseconds)
+{
+  m_boundSocketLock.Lock();
+  uint64 expiryTick = m_timerWheel.ScheduleTimer(pTimer, GetCurrentTick(), milliseconds);
+  bool wakeup = (expiryTick < m_waitEndTick);
+  m_boundSocketLock.Unlock();
+
+  // only a wait on another thread can be ending too late
+  if (wakeup)
+    Wakeup();
+}
+
+bool SocketMultiplexer::EventLoop::CancelTimer(SocketTimer* pTimer)
+{
+  m_boundSocketLock.Lock();
+  bool scheduled = m_timerWheel.CancelTimer(pTimer);
+  m_boundSocketLock.Unlock();
+  return scheduled;
+}
+
+void SocketMultiplexer::EventLoop::FireTimers()
+{
+  m_boundSocketLock.Lock();
+
+  // the wait is over, whatever's scheduled now gets fired or waited for on the next poll
+  m_waitEndTick = 0;
+  if (m_timerWheel.GetTimerCount() == 0)
+  {
+    m_boundSocketLock.Unlock();
+    return;
   }
+
+  Y_PROFILE_ZONE("SocketMultiplexer::FireTimers");
+  m_timerWheel.AdvanceTimers(GetCurrentTick());
+
+  // Fire one at a time without the lock, so callbacks can schedule and a cancel from another thread still works
+  // on the ones not yet taken.
+  SocketTimer* pTimer;
+  while ((pTimer = m_timerWheel.TakeDueTimer()) != nullptr)
+  {
+    m_timersFired++;
+
+    SocketTimer::Callback callback = pTimer->m_callback;
+    void* pUserData = pTimer->m_pUserData;
+    m_boundSocketLock.Unlock();
+    callback(pTimer, pUserData);
+    m_boundSocketLock.Lock();
+  }
+
+  m_boundSocketLock.Unlock();
+}
+
+void SocketMultiplexer::EventLoop::AccumulateStats(SocketMultiplexerStats* pStats) const
+{
+  pStats->SocketEvents += m_socketEvents;
+  pStats->TimersFired += m_timersFired;
+  pStats->CompletionsRun += m_completionsRun;
+  pStats->IterationTime.Accumulate(m_iterationTime);
+}
+
+void SocketMultiplexer::EventLoop::QueueCompletion(PendingResolve* pPendingResolve)
+{
+  m_boundSocketLock.Lock();
+  pPendingResolve->m_pNext = m_pCompletions;
+  m_pCompletions = pPendingResolve;
+  bool wakeup = (m_waitEndTick != 0);
+  m_boundSocketLock.Unlock();
+
+  if (wakeup)
+    Wakeup();
 }
 
-SocketMultiplexer::WorkerThread::WorkerThread(SocketMultiplexer* pThis) : m_pThis(pThis), m_stopFlag(false) {}
+void SocketMultiplexer::EventLoop::RunCompletions()
+{
+  m_boundSocketLock.Lock();
+  PendingResolve* pPendingResolve = m_pCompletions;
+  m_pCompletions = nullptr;
+  m_boundSocketLock.Unlock();
+
+  // queued newest first, so turned around to call back in order
+  PendingResolve* pOrdered = nullptr;
+  while (pPendingResolve != nullptr)
+  {
+    PendingResolve* pNext = static_cast<PendingResolve*>(pPendingResolve->m_pNext);
+    pPendingResolve->m_pNext = pOrdered;
+    pOrdered = pPendingResolve;
+    pPendingResolve = pNext;
+  }
+
+  while (pOrdered != nullptr)
+  {
+    PendingResolve* pNext = static_cast<PendingResolve*>(pOrdered->m_pNext);
+    pOrdered->Complete();
+    delete pOrdered;
+    m_completionsRun++;
+    pOrdered = pNext;
+  }
+}
+
+void SocketMultiplexer::ScheduleTimer(SocketTimer* pTimer, uint32 milliseconds, const BaseSocket* pSocket /*= nullptr*/)
+{
+  uint32 eventLoopIndex = (pSocket != nullptr) ? pSocket->m_eventLoopIndex : 0;
+
+  // moving loops, it comes off the old one first
+  if (pTimer->m_eventLoopIndex != eventLoopIndex)
+  {
+    m_eventLoops[pTimer->m_eventLoopIndex]->CancelTimer(pTimer);
+    pTimer->m_eventLoopIndex = eventLoopIndex;
+  }
+
+  m_eventLoops[eventLoopIndex]->ScheduleTimer(pTimer, milliseconds);
+}
+
+bool SocketMultiplexer::CancelTimer(SocketTimer* pTimer)
+{
+  return m_eventLoops[pTimer->m_eventLoopIndex]->CancelTimer(pTimer);
+}
+
+void SocketMultiplexer::PollEvents(uint32 milliseconds)
+{
+  DebugAssert(m_eventLoops[0]->GetWorkerThread() == nullptr);
+
+  uint32 eventLoopCount = m_eventLoopCount;
+  m_eventLoops[0]->PollEvents(milliseconds);
+  for (uint32 i = 1; i < eventLoopCount; i++)
+    m_eventLoops[i]->PollEvents(0);
+}
+
+SocketMultiplexer::WorkerThread::WorkerThread(EventLoop* pEventLoop) : m_pEventLoop(pEventLoop), m_stopFlag(false) {}
 
 int SocketMultiplexer::WorkerThread::ThreadEntryPoint()
 {
+  SetDebugName(String::FromFormat("Socket Multiplexer %p Worker", m_pEventLoop));
   while (!m_stopFlag)
-    m_pThis->PollEvents(1000);
+    m_pEventLoop->PollEvents(1000);
 
   return 0;
 }
 
 uint32 SocketMultiplexer::CreateWorkerThreads(uint32 threadCount /*= 0*/)
 {
-  // Only a single worker thread permitted.
-  threadCount = 1;
+  if (threadCount == 0)
+  {
+    Y_CPUID_RESULT cpuidResult;
+    Y_ReadCPUID(&cpuidResult);
+    threadCount = Max(cpuidResult.ThreadCount, 1u);
+  }
+  threadCount = Min(threadCount, MaxEventLoops);
+
+  // Add loops for the extra threads, sockets already open stay where they are.
+  while (m_eventLoopCount < threadCount)
+  {
+    if (!AddEventLoop(nullptr))
+    {
+      Log_ErrorPrint("Failed to create event loop.");
+      threadCount = m_eventLoopCount;
+      break;
+    }
+  }
 
-  // Create worker thread.
-  m_pWorkerThread = new WorkerThread(this);
-  if (!m_pWorkerThread->Start())
+  // One thread per loop, every loop has one so none are left unpolled.
+  uint32 runningCount = 0;
+  for (uint32 i = 0; i < m_eventLoopCount; i++)
   {
-    Log_ErrorPrint("Failed to start worker thread.");
-    delete m_pWorkerThread;
-    return 0;
+    EventLoop* pEventLoop = m_eventLoops[i];
+    if (pEventLoop->GetWorkerThread() == nullptr)
+    {
+      WorkerThread* pWorkerThread = new WorkerThread(pEventLoop);
+      if (!pWorkerThread->Start())
+      {
+        Log_ErrorPrint("Failed to start worker thread.");
+        delete pWorkerThread;
+        continue;
+      }
+
+      pEventLoop->SetWorkerThread(pWorkerThread);
+    }
+
+    runningCount++;
   }
 
   // Return created amount.
-  return threadCount;
+  return runningCount;
 }
 
 void SocketMultiplexer::StopWorkerThreads()
 {
-  if (m_pWorkerThread != nullptr)
+  // signal them all first so they stop together
+  for (uint32 i = 0; i < m_eventLoopCount; i++)
+  {
+    WorkerThread* pWorkerThread = m_eventLoops[i]->GetWorkerThread();
+    if (pWorkerThread != nullptr)
+    {
+      pWorkerThread->m_stopFlag = true;
+      m_eventLoops[i]->Wakeup();
+    }
+  }
+
+  for (uint32 i = 0; i < m_eventLoopCount; i++)
   {
-    m_pWorkerThread->m_stopFlag = true;
-    m_wakeupEvent.Signal();
-    m_pWorkerThread->Join();
-    delete m_pWorkerThread;
-    m_pWorkerThread = nullptr;
+    WorkerThread* pWorkerThread = m_eventLoops[i]->GetWorkerThread();
+    if (pWorkerThread != nullptr)
+    {
+      pWorkerThread->Join();
+      delete pWorkerThread;
+      m_eventLoops[i]->SetWorkerThread(nullptr);
+    }
   }
 }
 
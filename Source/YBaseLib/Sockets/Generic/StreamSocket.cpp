@@ -11,6 +11,7 @@ Log_SetChannel(StreamSocket);
 #define ioctlsocket ioctl
 #define closesocket close
 #define WSAEWOULDBLOCK EAGAIN
+#define WSAEINPROGRESS EINPROGRESS
 #define WSAGetLastError() errno
 #define SIZE_CAST(x) x
 #else
@@ -31,16 +32,21 @@ size_t StreamSocket::Read(void* pBuffer, size_t bufferSize)
 {
   m_lock.Lock();
   if (!m_connected)
+  {
+    m_lock.Unlock();
     return 0;
+  }
 
   // try a read
   ssize_t len = recv(m_fileDescriptor, (char*)pBuffer, SIZE_CAST(bufferSize), 0);
+  m_stats.RecordReceive(len);
   if (len <= 0)
   {
     // Check for EAGAIN
     if (len < 0 && WSAGetLastError() == WSAEWOULDBLOCK)
     {
       // Not an error. Just means no data is available.
+      m_stats.ReceiveWouldBlock++;
       m_lock.Unlock();
       return 0;
     }
@@ -67,12 +73,15 @@ size_t StreamSocket::Write(const void* pBuffer, size_t bufferLength)
 
   // try a write
   ssize_t len = send(m_fileDescriptor, (const char*)pBuffer, SIZE_CAST(bufferLength), 0);
+  m_stats.RecordSend(len);
   if (len <= 0)
   {
-    // Check for EAGAIN
-    if (len < 0 && WSAGetLastError() == WSAEWOULDBLOCK)
+    // Check for EAGAIN, or EINPROGRESS from the first send of a fast open connect without a cookie, which sends
+    // a plain SYN and leaves the data for when it's connected.
+    if (len < 0 && (WSAGetLastError() == WSAEWOULDBLOCK || WSAGetLastError() == WSAEINPROGRESS))
     {
       // Not an error. Just means no data is available.
+      m_stats.SendWouldBlock++;
       m_lock.Unlock();
       return 0;
     }
@@ -109,6 +118,7 @@ size_t StreamSocket::WriteVector(const void** ppBuffers, const size_t* pBufferLe
   DWORD bytesSent = 0;
   if (WSASend(m_fileDescriptor, bufs, (DWORD)numBuffers, &bytesSent, 0, nullptr, nullptr) == SOCKET_ERROR)
   {
+    m_stats.RecordSend(-1);
     if (WSAGetLastError() != WSAEWOULDBLOCK)
     {
       // Socket error.
@@ -116,6 +126,12 @@ size_t StreamSocket::WriteVector(const void** ppBuffers, const size_t* pBufferLe
       m_lock.Unlock();
       return 0;
     }
+
+    m_stats.SendWouldBlock++;
+  }
+  else
+  {
+    m_stats.RecordSend((int64)bytesSent);
   }
 
   m_lock.Unlock();
@@ -131,9 +147,10 @@ size_t StreamSocket::WriteVector(const void** ppBuffers, const size_t* pBufferLe
   }
 
   ssize_t res = writev(m_fileDescriptor, bufs, numBuffers);
+  m_stats.RecordSend(res);
   if (res < 0)
   {
-    if (errno != EAGAIN)
+    if (errno != EAGAIN && errno != EINPROGRESS)
     {
       // Socket error.
       CloseWithError();
@@ -141,6 +158,7 @@ size_t StreamSocket::WriteVector(const void** ppBuffers, const size_t* pBufferLe
       return 0;
     }
 
+    m_stats.SendWouldBlock++;
     res = 0;
   }
 
@@ -166,25 +184,34 @@ void StreamSocket::Close()
   m_connected = false;
 
   Error error;
-  error.SetErrorUser((int32)0, "Connection explicitly closed.");
+  error.SetErrorUserStatic(0, "Connection explicitly closed.");
   OnDisconnected(&error);
 
   m_lock.Unlock();
+
+  // Remove the open socket last. This is because it may be the last reference holder.
+  m_pMultiplexer->RemoveOpenSocket(this);
 }
 
 void StreamSocket::CloseWithError()
 {
-  m_lock.Lock();
-
-  DebugAssert(m_connected);
-
   Error error;
   int errorCode = WSAGetLastError();
   if (errorCode == 0)
-    error.SetErrorUser((int32)0, "Connection closed by peer.");
+    error.SetErrorUserStatic(0, "Connection closed by peer.");
   else
     error.SetErrorSocket(errorCode);
 
+  CloseWithError(&error);
+}
+
+void StreamSocket::CloseWithError(const Error* pError)
+{
+  m_lock.Lock();
+
+  DebugAssert(m_connected);
+
+  Error error(*pError);
   m_pMultiplexer->SetNotificationMask(this, m_fileDescriptor, 0);
   closesocket(m_fileDescriptor);
   m_fileDescriptor = INVALID_SOCKET;
@@ -198,6 +225,22 @@ void StreamSocket::CloseWithError()
   m_pMultiplexer->RemoveOpenSocket(this);
 }
 
+bool StreamSocket::IsReusable()
+{
+  m_lock.Lock();
+  if (!m_connected)
+  {
+    m_lock.Unlock();
+    return false;
+  }
+
+  char value;
+  ssize_t len = recv(m_fileDescriptor, &value, 1, MSG_PEEK);
+  bool reusable = (len < 0 && WSAGetLastError() == WSAEWOULDBLOCK);
+  m_lock.Unlock();
+  return reusable;
+}
+
 void StreamSocket::OnConnected()
 {
   m_connected = true;
@@ -226,7 +269,8 @@ void StreamSocket::OnWriteEvent()
   // shouldn't be called
 }
 
-bool StreamSocket::InitializeSocket(SocketMultiplexer* pMultiplexer, SOCKET fileDescriptor, Error* pError)
+bool StreamSocket::InitializeSocket(SocketMultiplexer* pMultiplexer, SOCKET fileDescriptor, Error* pError,
+                                    uint32 eventLoopIndex /*= Y_UINT32_MAX*/, bool nonBlocking /*= false*/)
 {
   DebugAssert(m_pMultiplexer == nullptr);
   m_pMultiplexer = pMultiplexer;
@@ -250,7 +294,7 @@ bool StreamSocket::InitializeSocket(SocketMultiplexer* pMultiplexer, SOCKET file
 
   // switch to nonblocking mode
   unsigned long value = 1;
-  if (ioctlsocket(m_fileDescriptor, FIONBIO, &value) < 0)
+  if (!nonBlocking && ioctlsocket(m_fileDescriptor, FIONBIO, &value) < 0)
   {
     if (pError != nullptr)
       pError->SetErrorSocket(WSAGetLastError());
@@ -259,7 +303,7 @@ bool StreamSocket::InitializeSocket(SocketMultiplexer* pMultiplexer, SOCKET file
   }
 
   // register for notifications
-  m_pMultiplexer->AddOpenSocket(this);
+  m_pMultiplexer->AddOpenSocket(this, eventLoopIndex);
   m_pMultiplexer->SetNotificationMask(this, m_fileDescriptor, SocketMultiplexer::EventType_Read);
 
   // trigger connected notitifcation
@@ -0,0 +1,518 @@
+#include "YBaseLib/Sockets/TLSStreamSocket.h"
+#include "YBaseLib/Error.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Sockets/SocketMultiplexer.h"
+Log_SetChannel(TLSStreamSocket);
+
+#if defined(Y_SOCKET_IMPLEMENTATION_GENERIC) && defined(HAVE_OPENSSL)
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+// Windows-isms
+#ifndef Y_PLATFORM_WINDOWS
+#define WSAGetLastError() errno
+#endif
+
+const uint32 TLSStreamSocket::MaxRecordSize;
+
+TLSStreamSocket::TLSStreamSocket(TLSContext* pAcceptContext /*= nullptr*/)
+  : m_pContext(pAcceptContext), m_pSSL(nullptr), m_handshakeComplete(false), m_wantWrite(false),
+    m_writeNotificationsEnabled(false), m_readProgress(false)
+{
+  if (m_pContext != nullptr)
+    m_pContext->AddRef();
+}
+
+TLSStreamSocket::~TLSStreamSocket()
+{
+  FreeSession();
+  SAFE_RELEASE(m_pContext);
+}
+
+bool TLSStreamSocket::StartTLS(TLSContext* pContext, const char* serverName /*= nullptr*/)
+{
+  m_lock.Lock();
+
+  DebugAssert(m_pSSL == nullptr);
+  bool result = false;
+  if (m_connected && m_pSSL == nullptr && CreateSession(pContext, serverName))
+  {
+    // the client's hello goes now, a server waits for it
+    ContinueHandshake();
+    result = m_connected;
+  }
+
+  m_lock.Unlock();
+  return result;
+}
+
+void TLSStreamSocket::Shutdown()
+{
+  m_lock.Lock();
+
+  // not waiting for the peer's, the descriptor is closed after
+  if (m_connected && m_handshakeComplete)
+  {
+    SSL_shutdown(m_pSSL);
+    ERR_clear_error();
+  }
+
+  m_lock.Unlock();
+  Close();
+}
+
+bool TLSStreamSocket::IsSessionReused() const
+{
+  return (m_pSSL != nullptr && SSL_session_reused(m_pSSL) != 0);
+}
+
+bool TLSStreamSocket::IsReusable()
+{
+  m_lock.Lock();
+  bool sessionIdle =
+    (m_pSSL == nullptr || (m_handshakeComplete && SSL_pending(m_pSSL) == 0 && m_pendingWrite.IsEmpty()));
+  bool reusable = (sessionIdle && StreamSocket::IsReusable());
+  m_lock.Unlock();
+  return reusable;
+}
+
+bool TLSStreamSocket::IsKernelTLSSend() const
+{
+#ifdef BIO_get_ktls_send
+  return (m_pSSL != nullptr && BIO_get_ktls_send(SSL_get_wbio(m_pSSL)));
+#else
+  return false;
+#endif
+}
+
+bool TLSStreamSocket::IsKernelTLSReceive() const
+{
+#ifdef BIO_get_ktls_recv
+  return (m_pSSL != nullptr && BIO_get_ktls_recv(SSL_get_rbio(m_pSSL)));
+#else
+  return false;
+#endif
+}
+
+size_t TLSStreamSocket::Read(void* pBuffer, size_t bufferSize)
+{
+  m_lock.Lock();
+
+  if (m_pSSL == nullptr)
+  {
+    size_t bytesRead = StreamSocket::Read(pBuffer, bufferSize);
+    m_lock.Unlock();
+    return bytesRead;
+  }
+
+  if (!m_connected || !m_handshakeComplete)
+  {
+    m_lock.Unlock();
+    return 0;
+  }
+
+  size_t bytesRead = 0;
+  int result = SSL_read_ex(m_pSSL, pBuffer, bufferSize, &bytesRead);
+  m_stats.RecordReceive((result > 0) ? (int64)bytesRead : -1);
+  if (result <= 0)
+  {
+    // a read can be waiting to write, for the TLS 1.3 messages that answer the peer's
+    bytesRead = 0;
+    if (HandleSSLError(result))
+    {
+      m_stats.ReceiveWouldBlock++;
+      UpdateWriteNotification();
+    }
+  }
+  else
+  {
+    m_readProgress = true;
+  }
+
+  m_lock.Unlock();
+  return bytesRead;
+}
+
+size_t TLSStreamSocket::Write(const void* pBuffer, size_t bufferSize)
+{
+  m_lock.Lock();
+
+  size_t bytesWritten;
+  if (m_pSSL == nullptr)
+    bytesWritten = StreamSocket::Write(pBuffer, bufferSize);
+  else
+    bytesWritten = WriteRecords(static_cast<const byte*>(pBuffer), bufferSize);
+
+  m_lock.Unlock();
+  return bytesWritten;
+}
+
+size_t TLSStreamSocket::WriteVector(const void** ppBuffers, const size_t* pBufferLengths, size_t numBuffers)
+{
+  m_lock.Lock();
+
+  if (m_pSSL == nullptr)
+  {
+    size_t bytesWritten = StreamSocket::WriteVector(ppBuffers, pBufferLengths, numBuffers);
+    m_lock.Unlock();
+    return bytesWritten;
+  }
+
+  // Small buffers are gathered into whole records, as each record costs a header, a MAC and a send. Buffers of a
+  // record or more go straight from the caller's memory.
+  byte batch[MaxRecordSize];
+  size_t batchSize = 0;
+  size_t bytesWritten = 0;
+  bool blocked = false;
+  for (size_t i = 0; i < numBuffers && !blocked; i++)
+  {
+    const byte* pBuffer = static_cast<const byte*>(ppBuffers[i]);
+    size_t remaining = pBufferLengths[i];
+    if (batchSize == 0 && remaining >= MaxRecordSize)
+    {
+      size_t recordBytes = WriteRecords(pBuffer, remaining);
+      bytesWritten += recordBytes;
+      blocked = (recordBytes < remaining);
+      continue;
+    }
+
+    while (remaining > 0 && !blocked)
+    {
+      size_t copySize = Min(remaining, (size_t)MaxRecordSize - batchSize);
+      std::memcpy(batch + batchSize, pBuffer, copySize);
+      batchSize += copySize;
+      pBuffer += copySize;
+      remaining -= copySize;
+      if (batchSize == MaxRecordSize)
+      {
+        size_t recordBytes = WriteRecords(batch, batchSize);
+        bytesWritten += recordBytes;
+        blocked = (recordBytes < batchSize);
+        batchSize = 0;
+      }
+    }
+  }
+
+  if (batchSize > 0 && !blocked)
+    bytesWritten += WriteRecords(batch, batchSize);
+
+  m_lock.Unlock();
+  return bytesWritten;
+}
+
+void TLSStreamSocket::OnConnected()
+{
+  StreamSocket::OnConnected();
+
+  // accepted with straight away, as the client speaks first
+  if (m_pSSL == nullptr && m_pContext != nullptr && m_pContext->GetMode() == TLSContext::Mode_Server)
+    CreateSession(m_pContext, nullptr);
+}
+
+void TLSStreamSocket::OnDisconnected(Error* pError)
+{
+  FreeSession();
+  StreamSocket::OnDisconnected(pError);
+}
+
+void TLSStreamSocket::OnHandshakeComplete() {}
+
+void TLSStreamSocket::OnWriteDrained() {}
+
+void TLSStreamSocket::OnReadEvent()
+{
+  m_lock.Lock();
+
+  if (!m_connected)
+  {
+    m_lock.Unlock();
+    return;
+  }
+
+  // the hello can beat OnConnected here
+  if (m_pSSL == nullptr && m_pContext != nullptr && m_pContext->GetMode() == TLSContext::Mode_Server &&
+      !CreateSession(m_pContext, nullptr))
+  {
+    m_lock.Unlock();
+    return;
+  }
+
+  if (m_pSSL == nullptr)
+  {
+    OnRead();
+    m_lock.Unlock();
+    return;
+  }
+
+  if (!m_handshakeComplete)
+    ContinueHandshake();
+
+  if (m_connected && m_handshakeComplete)
+  {
+    // a kept write that wanted to read can go now
+    if (!m_pendingWrite.IsEmpty() && FlushPendingWrite())
+      OnWriteDrained();
+
+    if (m_connected)
+      DispatchRead();
+  }
+
+  if (m_connected)
+    UpdateWriteNotification();
+
+  m_lock.Unlock();
+}
+
+void TLSStreamSocket::OnWriteEvent()
+{
+  m_lock.Lock();
+
+  if (!m_connected || m_pSSL == nullptr)
+  {
+    m_lock.Unlock();
+    return;
+  }
+
+  bool readWantedWrite = m_wantWrite;
+  m_wantWrite = false;
+  if (!m_handshakeComplete)
+  {
+    ContinueHandshake();
+
+    // the last flight can carry application data, which the socket won't signal again
+    if (m_connected && m_handshakeComplete && SSL_pending(m_pSSL) > 0)
+      DispatchRead();
+  }
+  else
+  {
+    if (!m_pendingWrite.IsEmpty() && FlushPendingWrite())
+      OnWriteDrained();
+
+    if (m_connected && readWantedWrite)
+      DispatchRead();
+  }
+
+  if (m_connected)
+    UpdateWriteNotification();
+
+  m_lock.Unlock();
+}
+
+bool TLSStreamSocket::CreateSession(TLSContext* pContext, const char* serverName)
+{
+  if (pContext != m_pContext)
+  {
+    pContext->AddRef();
+    SAFE_RELEASE(m_pContext);
+    m_pContext = pContext;
+  }
+
+  m_pSSL = SSL_new(pContext->m_pContext);
+  if (m_pSSL == nullptr || SSL_set_fd(m_pSSL, (int)m_fileDescriptor) != 1)
+  {
+    Error error;
+    TLSContext::SetErrorFromQueue(&error);
+    Log_ErrorPrintf("TLSStreamSocket::CreateSession: Failed to create session: %s",
+                    error.GetErrorDescription().GetCharArray());
+    CloseWithError(&error);
+    return false;
+  }
+
+  SSL_set_app_data(m_pSSL, this);
+  if (pContext->GetMode() == TLSContext::Mode_Server)
+  {
+    SSL_set_accept_state(m_pSSL);
+    return true;
+  }
+
+  SSL_set_connect_state(m_pSSL);
+  if (serverName != nullptr && serverName[0] != '\0')
+  {
+    m_serverName = serverName;
+    SSL_set_tlsext_host_name(m_pSSL, serverName);
+    if (pContext->GetVerifyPeer())
+      SSL_set1_host(m_pSSL, serverName);
+
+    SSL_SESSION* pSession = pContext->TakeSession(serverName);
+    if (pSession != nullptr)
+    {
+      SSL_set_session(m_pSSL, pSession);
+      SSL_SESSION_free(pSession);
+    }
+  }
+
+  return true;
+}
+
+void TLSStreamSocket::FreeSession()
+{
+  // the descriptor's the socket's, OpenSSL doesn't close it
+  if (m_pSSL != nullptr)
+  {
+    SSL_free(m_pSSL);
+    m_pSSL = nullptr;
+  }
+
+  m_pendingWrite.Clear();
+  m_handshakeComplete = false;
+  m_wantWrite = false;
+  m_writeNotificationsEnabled = false;
+}
+
+void TLSStreamSocket::ContinueHandshake()
+{
+  int result = SSL_do_handshake(m_pSSL);
+  if (result <= 0)
+  {
+    if (HandleSSLError(result))
+      UpdateWriteNotification();
+
+    return;
+  }
+
+  m_handshakeComplete = true;
+  m_wantWrite = false;
+  OnHandshakeComplete();
+  if (m_connected)
+    UpdateWriteNotification();
+}
+
+void TLSStreamSocket::DispatchRead()
+{
+  do
+  {
+    m_readProgress = false;
+    OnRead();
+  } while (m_connected && m_pSSL != nullptr && m_readProgress && SSL_pending(m_pSSL) > 0);
+}
+
+size_t TLSStreamSocket::WriteRecords(const byte* pBuffer, size_t bufferLength)
+{
+  if (!m_connected || !m_handshakeComplete || !FlushPendingWrite())
+    return 0;
+
+  size_t bytesWritten = 0;
+  while (bytesWritten < bufferLength)
+  {
+    // one record per call, so a blocked call leaves exactly what it was given
+    size_t recordSize = Min(bufferLength - bytesWritten, (size_t)MaxRecordSize);
+    size_t recordBytesWritten = 0;
+    int result = SSL_write_ex(m_pSSL, pBuffer + bytesWritten, recordSize, &recordBytesWritten);
+    m_stats.RecordSend((result > 0) ? (int64)recordBytesWritten : -1);
+    if (result > 0)
+    {
+      bytesWritten += recordBytesWritten;
+      continue;
+    }
+
+    int error = SSL_get_error(m_pSSL, result);
+    if (error == SSL_ERROR_WANT_WRITE || error == SSL_ERROR_WANT_READ)
+    {
+      // The record's built, and is retried from a copy until it goes, as the retry has to pass the same bytes. Only
+      // a blocked write pays for it.
+      m_pendingWrite.Resize((uint32)recordSize);
+      std::memcpy(m_pendingWrite.GetBasePointer(), pBuffer + bytesWritten, recordSize);
+      m_stats.SendWouldBlock++;
+      m_stats.RecordSendBuffered(recordSize);
+      bytesWritten += recordSize;
+      UpdateWriteNotification();
+      break;
+    }
+
+    HandleSSLError(result);
+    break;
+  }
+
+  return bytesWritten;
+}
+
+bool TLSStreamSocket::FlushPendingWrite()
+{
+  if (m_pendingWrite.IsEmpty())
+    return true;
+
+  size_t bytesWritten = 0;
+  int result = SSL_write_ex(m_pSSL, m_pendingWrite.GetBasePointer(), m_pendingWrite.GetSize(), &bytesWritten);
+  m_stats.RecordSend((result > 0) ? (int64)bytesWritten : -1);
+  if (result <= 0)
+  {
+    int error = SSL_get_error(m_pSSL, result);
+    if (error != SSL_ERROR_WANT_WRITE && error != SSL_ERROR_WANT_READ)
+      HandleSSLError(result);
+    else
+      m_stats.SendWouldBlock++;
+
+    return false;
+  }
+
+  DebugAssert(bytesWritten == m_pendingWrite.GetSize());
+  m_pendingWrite.Clear();
+  return true;
+}
+
+bool TLSStreamSocket::HandleSSLError(int result)
+{
+  Error error;
+  switch (SSL_get_error(m_pSSL, result))
+  {
+    case SSL_ERROR_WANT_READ:
+      m_wantWrite = false;
+      return true;
+
+    case SSL_ERROR_WANT_WRITE:
+      m_wantWrite = true;
+      return true;
+
+    case SSL_ERROR_ZERO_RETURN:
+      error.SetErrorUserStatic(0, "Connection closed by peer.");
+      break;
+
+    case SSL_ERROR_SYSCALL:
+    {
+      // no errno is the peer going without close_notify
+      int errorCode = WSAGetLastError();
+      if (ERR_peek_error() != 0)
+        TLSContext::SetErrorFromQueue(&error);
+      else if (errorCode == 0)
+        error.SetErrorUserStatic(0, "Connection closed by peer.");
+      else
+        error.SetErrorSocket(errorCode);
+
+      break;
+    }
+
+    default:
+    {
+#ifdef SSL_R_UNEXPECTED_EOF_WHILE_READING
+      // OpenSSL 3 reports the peer going without close_notify as a protocol error
+      if (ERR_GET_REASON(ERR_peek_error()) == SSL_R_UNEXPECTED_EOF_WHILE_READING)
+      {
+        error.SetErrorUserStatic(0, "Connection closed by peer.");
+        break;
+      }
+#endif
+
+      TLSContext::SetErrorFromQueue(&error);
+      Log_WarningPrintf("TLSStreamSocket::HandleSSLError: %s", error.GetErrorDescription().GetCharArray());
+      break;
+    }
+  }
+
+  ERR_clear_error();
+  CloseWithError(&error);
+  return false;
+}
+
+void TLSStreamSocket::UpdateWriteNotification()
+{
+  bool enable = (m_wantWrite || !m_pendingWrite.IsEmpty());
+  if (enable == m_writeNotificationsEnabled)
+    return;
+
+  uint32 mask = SocketMultiplexer::EventType_Read | (enable ? SocketMultiplexer::EventType_Write : 0);
+  m_pMultiplexer->SetNotificationMask(this, m_fileDescriptor, mask);
+  m_writeNotificationsEnabled = enable;
+}
+
+#endif // Y_SOCKET_IMPLEMENTATION_GENERIC && HAVE_OPENSSL
@@ -1,5 +1,9 @@
 #include "YBaseLib/Sockets/SocketAddress.h"
+#include "YBaseLib/Error.h"
 #include "YBaseLib/Sockets/SystemHeaders.h"
+#ifndef Y_PLATFORM_WINDOWS
+#include <netdb.h>
+#endif
 
 SocketAddress::SocketAddress(const SocketAddress& copy)
 {
@@ -14,6 +18,12 @@ SocketAddress& SocketAddress::operator=(const SocketAddress& copy)
   return *this;
 }
 
+bool SocketAddress::operator==(const SocketAddress& rhs) const
+{
+  // every initializer zeroes the data first, so padding in the sockaddr compares equal too
+  return (m_type == rhs.m_type && std::memcmp(m_data, rhs.m_data, GetLength()) == 0);
+}
+
 void SocketAddress::SetUnknown()
 {
   m_type = Type_Unknown;
@@ -24,6 +34,30 @@ void SocketAddress::SetFromSockaddr(const void* pSockaddr, size_t sockaddrLength
 {
   Y_memzero(m_data, sizeof(m_data));
   std::memcpy(m_data, pSockaddr, Min(sockaddrLength, sizeof(m_data)));
+
+  // the family is first in every sockaddr
+  int family = (sockaddrLength >= sizeof(sockaddr)) ? reinterpret_cast<const sockaddr*>(m_data)->sa_family : AF_UNSPEC;
+  if (family == AF_INET)
+    m_type = Type_IPv4;
+  else if (family == AF_INET6)
+    m_type = Type_IPv6;
+  else
+    m_type = Type_Unknown;
+}
+
+size_t SocketAddress::GetLength() const
+{
+  switch (m_type)
+  {
+    case Type_IPv4:
+      return sizeof(sockaddr_in);
+
+    case Type_IPv6:
+      return sizeof(sockaddr_in6);
+
+    default:
+      return 0;
+  }
 }
 
 bool SocketAddress::Parse(Type type, const char* address, uint32 port, SocketAddress* pOutAddress)
@@ -49,7 +83,7 @@ bool SocketAddress::Parse(Type type, const char* address, uint32 port, SocketAdd
       pOutAddress->m_type = Type_IPv6;
       sockaddr_in6* pSockaddrIn = reinterpret_cast<sockaddr_in6*>(pOutAddress->m_data);
       Y_memzero(pSockaddrIn, sizeof(sockaddr_in6));
-      pSockaddrIn->sin6_family = AF_INET;
+      pSockaddrIn->sin6_family = AF_INET6;
       pSockaddrIn->sin6_port = htons((uint16)port);
       int res = inet_pton(AF_INET6, address, &pSockaddrIn->sin6_addr);
       if (res != 1)
@@ -62,54 +96,100 @@ bool SocketAddress::Parse(Type type, const char* address, uint32 port, SocketAdd
   return false;
 }
 
-bool SocketAddress::Resolve(const char* address, uint32 port, SocketAddress* pOutAddress)
+bool SocketAddress::Resolve(const char* address, uint32 port, SocketAddress* pOutAddress, Error* pError /*= nullptr*/)
 {
-  // getaddrinfo()
-  Panic("Not implemented");
-  return false;
+  // only families this host has an address in, the first answer is the resolver's preference
+  addrinfo hints;
+  Y_memzero(&hints, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_ADDRCONFIG;
+
+  addrinfo* pResults = nullptr;
+  int res = getaddrinfo(address, nullptr, &hints, &pResults);
+  if (res != 0)
+  {
+    // windows returns socket error codes, elsewhere they have their own
+    if (pError != nullptr)
+    {
+#ifdef Y_PLATFORM_WINDOWS
+      pError->SetErrorSocket(res);
+#else
+      pError->SetErrorUserStatic((int32)res, gai_strerror(res));
+#endif
+    }
+
+    return false;
+  }
+
+  bool found = false;
+  for (const addrinfo* pResult = pResults; pResult != nullptr; pResult = pResult->ai_next)
+  {
+    if (pResult->ai_family == AF_INET || pResult->ai_family == AF_INET6)
+    {
+      pOutAddress->SetFromSockaddr(pResult->ai_addr, pResult->ai_addrlen);
+      pOutAddress->SetPort(port);
+      found = true;
+      break;
+    }
+  }
+  freeaddrinfo(pResults);
+
+  if (!found && pError != nullptr)
+    pError->SetErrorUserStatic(0, "No IP addresses for host.");
+
+  return found;
+}
+
+void SocketAddress::SetPort(uint32 port)
+{
+  if (m_type == Type_IPv4)
+    reinterpret_cast<sockaddr_in*>(m_data)->sin_port = htons((uint16)port);
+  else if (m_type == Type_IPv6)
+    reinterpret_cast<sockaddr_in6*>(m_data)->sin6_port = htons((uint16)port);
 }
 
 void SocketAddress::ToString(String& destination) const
 {
+  destination.Clear();
+  AppendToString(destination);
+}
+
+void SocketAddress::AppendToString(String& destination) const
+{
+  char addressString[INET6_ADDRSTRLEN];
   switch (m_type)
   {
     case Type_IPv4:
     {
-      destination.Clear();
-      destination.Reserve(128);
-      const char* res = inet_ntop(AF_INET, const_cast<byte*>(m_data), destination.GetWriteableCharArray(),
-                                  destination.GetWritableBufferSize());
-      if (res == nullptr)
+      const sockaddr_in* pSockaddrIn = reinterpret_cast<const sockaddr_in*>(m_data);
+      if (inet_ntop(AF_INET, const_cast<in_addr*>(&pSockaddrIn->sin_addr), addressString, sizeof(addressString)) ==
+          nullptr)
       {
-        destination.Clear();
         destination.AppendString("<unknown>");
+        break;
       }
 
-      destination.AppendFormattedString(":%u", (uint32)ntohs(reinterpret_cast<const sockaddr_in*>(m_data)->sin_port));
+      destination.AppendFormat("{}:{}", addressString, ntohs(pSockaddrIn->sin_port));
       break;
     }
 
     case Type_IPv6:
     {
-      destination.Clear();
-      destination.Reserve(128);
-      destination.AppendCharacter('[');
-      const char* res = inet_ntop(AF_INET, const_cast<byte*>(m_data), destination.GetWriteableCharArray() + 1,
-                                  destination.GetWritableBufferSize() - 1);
-      if (res == nullptr)
+      const sockaddr_in6* pSockaddrIn = reinterpret_cast<const sockaddr_in6*>(m_data);
+      if (inet_ntop(AF_INET6, const_cast<in6_addr*>(&pSockaddrIn->sin6_addr), addressString, sizeof(addressString)) ==
+          nullptr)
       {
-        destination.Clear();
         destination.AppendString("<unknown>");
+        break;
       }
 
-      destination.AppendFormattedString("]:%u",
-                                        (uint32)ntohs(reinterpret_cast<const sockaddr_in6*>(m_data)->sin6_port));
+      destination.AppendFormat("[{}]:{}", addressString, ntohs(pSockaddrIn->sin6_port));
       break;
     }
 
     default:
     {
-      destination.Clear();
       destination.AppendString("<unknown>");
       break;
     }
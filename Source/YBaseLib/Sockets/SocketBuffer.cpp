@@ -0,0 +1,41 @@
+#include "YBaseLib/Sockets/SocketBuffer.h"
+#include "YBaseLib/ObjectPool.h"
+
+// Released blocks stay in the pool for the next receive, on whichever thread does it, without a lock. The pool's
+// block is only touched as buffers are first used, so the space for those that never are costs nothing. It's created
+// on first use and never destroyed, as buffers can be released by sockets torn down during static destruction.
+static ObjectPool<SocketBuffer>& GetBufferPool()
+{
+  static ObjectPool<SocketBuffer>* pPool = new ObjectPool<SocketBuffer>(SocketBuffer::MaxPooledBuffers);
+  return *pPool;
+}
+
+const uint32 SocketBuffer::Capacity;
+const uint32 SocketBuffer::MaxPooledBuffers;
+
+SocketBuffer* SocketBuffer::Allocate()
+{
+  SocketBuffer* pBuffer = GetBufferPool().Allocate();
+  if (pBuffer == nullptr)
+    return new SocketBuffer();
+
+  pBuffer->m_referenceCount = 1;
+  pBuffer->m_size = 0;
+  return pBuffer;
+}
+
+uint32 SocketBuffer::Release()
+{
+  DebugAssert(m_referenceCount > 0);
+  uint32 newReferenceCount = Y_AtomicDecrement(m_referenceCount);
+  if (newReferenceCount > 0)
+    return newReferenceCount;
+
+  ObjectPool<SocketBuffer>& pool = GetBufferPool();
+  if (pool.Owns(this))
+    pool.Release(this);
+  else
+    delete this;
+
+  return 0;
+}
@@ -0,0 +1,60 @@
+#include "YBaseLib/Sockets/SocketRateLimiter.h"
+#include <cmath>
+
+SocketRateLimiter::SocketRateLimiter()
+  : m_bytesPerSecond(0), m_burstBytes(0.0), m_tokens(0.0), m_lastRefill(Y_TimerGetValue())
+{
+}
+
+void SocketRateLimiter::SetRate(uint64 bytesPerSecond, uint64 burstBytes /*= 0*/)
+{
+  m_lock.Lock();
+  m_bytesPerSecond = bytesPerSecond;
+  m_burstBytes = (double)((burstBytes > 0) ? burstBytes : Max(bytesPerSecond / 10, (uint64)1));
+  m_tokens = m_burstBytes;
+  m_lastRefill = Y_TimerGetValue();
+  m_lock.Unlock();
+}
+
+void SocketRateLimiter::Refill()
+{
+  Y_TIMER_VALUE now = Y_TimerGetValue();
+  double seconds = Y_TimerConvertToSeconds(now - m_lastRefill);
+  m_lastRefill = now;
+  m_tokens = Min(m_tokens + seconds * (double)m_bytesPerSecond, m_burstBytes);
+}
+
+size_t SocketRateLimiter::GetAvailable()
+{
+  if (m_bytesPerSecond == 0)
+    return SIZE_MAX;
+
+  m_lock.Lock();
+  Refill();
+  size_t available = (m_tokens >= 1.0) ? (size_t)m_tokens : 0;
+  m_lock.Unlock();
+  return available;
+}
+
+void SocketRateLimiter::Consume(size_t bytes)
+{
+  if (m_bytesPerSecond == 0 || bytes == 0)
+    return;
+
+  m_lock.Lock();
+  m_tokens -= (double)bytes;
+  m_lock.Unlock();
+}
+
+uint32 SocketRateLimiter::GetWaitTime(size_t bytes /*= 1*/)
+{
+  if (m_bytesPerSecond == 0)
+    return 0;
+
+  m_lock.Lock();
+  Refill();
+  double milliseconds = (Min((double)bytes, m_burstBytes) - m_tokens) * 1000.0 / (double)m_bytesPerSecond;
+  m_lock.Unlock();
+
+  return (milliseconds > 0.0) ? (uint32)Min(std::ceil(milliseconds), 60000.0) : 0;
+}
@@ -0,0 +1,178 @@
+#include "YBaseLib/Sockets/SocketResolver.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(SocketResolver);
+
+const uint32 SocketResolver::ThreadCount;
+const uint32 SocketResolver::CacheLifetime;
+const uint32 SocketResolver::FailureCacheLifetime;
+const uint32 SocketResolver::MaxCacheEntries;
+
+class SocketResolver::ResolverThread : public Thread
+{
+public:
+  ResolverThread(SocketResolver* pResolver) : m_pResolver(pResolver) {}
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    Thread::SetDebugName(String::FromFormat("Socket Resolver %p", m_pResolver));
+    m_pResolver->WorkerLoop();
+    return 0;
+  }
+
+private:
+  SocketResolver* m_pResolver;
+};
+
+SocketResolver::SocketResolver() : m_pWaitingHead(nullptr), m_pWaitingTail(nullptr), m_shutdown(false) {}
+
+SocketResolver::~SocketResolver()
+{
+  m_lock.Lock();
+  m_shutdown = true;
+  m_requestConditionVariable.WakeAll();
+  m_lock.Unlock();
+
+  for (ResolverThread* pThread : m_threads)
+  {
+    pThread->Join();
+    delete pThread;
+  }
+
+  while (m_pWaitingHead != nullptr)
+  {
+    Request* pRequest = m_pWaitingHead;
+    m_pWaitingHead = pRequest->m_pNext;
+    delete pRequest;
+  }
+}
+
+void SocketResolver::Resolve(Request* pRequest)
+{
+  m_lock.Lock();
+  DebugAssert(!m_shutdown);
+
+  // even cached answers go through the threads, as the request may block once it has one
+  pRequest->m_pNext = nullptr;
+  if (m_pWaitingTail != nullptr)
+    m_pWaitingTail->m_pNext = pRequest;
+  else
+    m_pWaitingHead = pRequest;
+  m_pWaitingTail = pRequest;
+
+  if (m_threads.IsEmpty())
+  {
+    for (uint32 i = 0; i < ThreadCount; i++)
+    {
+      ResolverThread* pThread = new ResolverThread(this);
+      if (!pThread->Start())
+      {
+        Log_ErrorPrint("SocketResolver::Resolve: Failed to start resolver thread.");
+        delete pThread;
+        continue;
+      }
+
+      m_threads.Add(pThread);
+    }
+  }
+
+  m_requestConditionVariable.Wake();
+  m_lock.Unlock();
+}
+
+void SocketResolver::ClearCache()
+{
+  m_lock.Lock();
+  m_cache.Clear();
+  m_lock.Unlock();
+}
+
+void SocketResolver::WorkerLoop()
+{
+  m_lock.Lock();
+  for (;;)
+  {
+    if (m_pWaitingHead == nullptr)
+    {
+      if (m_shutdown)
+        break;
+
+      m_requestConditionVariable.SleepAndRelease(&m_lock);
+      continue;
+    }
+
+    // the rest wait for the running lookups, rather than being dropped
+    if (m_shutdown)
+      break;
+
+    Request* pRequest = m_pWaitingHead;
+    m_pWaitingHead = pRequest->m_pNext;
+    if (m_pWaitingHead == nullptr)
+      m_pWaitingTail = nullptr;
+    pRequest->m_pNext = nullptr;
+
+    if (!LookupCache(pRequest))
+    {
+      m_lock.Unlock();
+      pRequest->m_error.SetErrorNone();
+      pRequest->m_resolved = SocketAddress::Resolve(pRequest->m_hostName, pRequest->m_port, &pRequest->m_address,
+                                                    &pRequest->m_error);
+      m_lock.Lock();
+      AddToCache(pRequest);
+    }
+
+    // the request is its own from here
+    m_lock.Unlock();
+    pRequest->OnResolved();
+    m_lock.Lock();
+  }
+  m_lock.Unlock();
+}
+
+bool SocketResolver::LookupCache(Request* pRequest)
+{
+  CIStringHashTable<CacheEntry>::Member* pMember = m_cache.Find(pRequest->m_hostName);
+  if (pMember == nullptr)
+    return false;
+
+  const CacheEntry& entry = pMember->Value;
+  if (entry.ExpiryTime <= m_cacheTimer.GetTimeMilliseconds())
+  {
+    m_cache.Remove(pMember);
+    return false;
+  }
+
+  // entries are kept without a port, each request has its own
+  pRequest->m_resolved = entry.Resolved;
+  pRequest->m_address = entry.Address;
+  pRequest->m_address.SetPort(pRequest->m_port);
+  pRequest->m_error = entry.ResolveError;
+  return true;
+}
+
+void SocketResolver::AddToCache(const Request* pRequest)
+{
+  double currentTime = m_cacheTimer.GetTimeMilliseconds();
+  if (m_cache.GetMemberCount() >= MaxCacheEntries)
+  {
+    for (CIStringHashTable<CacheEntry>::Iterator itr = m_cache.Begin(); itr != m_cache.End();)
+    {
+      CIStringHashTable<CacheEntry>::Member* pMember = &(*itr);
+      ++itr;
+      if (pMember->Value.ExpiryTime <= currentTime)
+        m_cache.Remove(pMember);
+    }
+
+    if (m_cache.GetMemberCount() >= MaxCacheEntries)
+      m_cache.Clear();
+  }
+
+  CacheEntry entry;
+  entry.Address = pRequest->m_address;
+  entry.Address.SetPort(0);
+  entry.ResolveError = pRequest->m_error;
+  entry.ExpiryTime = currentTime + (pRequest->m_resolved ? CacheLifetime : FailureCacheLifetime);
+  entry.Resolved = pRequest->m_resolved;
+  m_cache.Set(pRequest->m_hostName, entry, nullptr);
+}
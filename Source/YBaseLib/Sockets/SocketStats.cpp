@@ -0,0 +1,29 @@
+#include "YBaseLib/Sockets/SocketStats.h"
+
+void SocketStats::Reset()
+{
+  BytesReceived = 0;
+  BytesSent = 0;
+  DatagramsReceived = 0;
+  DatagramsSent = 0;
+  ReceiveCalls = 0;
+  SendCalls = 0;
+  ReceiveWouldBlock = 0;
+  SendWouldBlock = 0;
+  SendThrottled = 0;
+  MaxSendBufferBytes = 0;
+}
+
+void SocketStats::Accumulate(const SocketStats& other)
+{
+  BytesReceived += other.BytesReceived;
+  BytesSent += other.BytesSent;
+  DatagramsReceived += other.DatagramsReceived;
+  DatagramsSent += other.DatagramsSent;
+  ReceiveCalls += other.ReceiveCalls;
+  SendCalls += other.SendCalls;
+  ReceiveWouldBlock += other.ReceiveWouldBlock;
+  SendWouldBlock += other.SendWouldBlock;
+  SendThrottled += other.SendThrottled;
+  MaxSendBufferBytes = Max(MaxSendBufferBytes, other.MaxSendBufferBytes);
+}
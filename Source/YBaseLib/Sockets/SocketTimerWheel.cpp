@@ -0,0 +1,185 @@
+#include "YBaseLib/Sockets/SocketTimerWheel.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/NumericLimits.h"
+
+const uint32 SocketTimerWheel::Levels;
+const uint32 SocketTimerWheel::SlotBits;
+const uint32 SocketTimerWheel::Slots;
+const uint32 SocketTimerWheel::SlotMask;
+
+SocketTimerWheel::SocketTimerWheel() : m_pDueTimers(nullptr), m_nextTick(0), m_timerCount(0)
+{
+  Y_memzero(m_pSlots, sizeof(m_pSlots));
+}
+
+SocketTimerWheel::~SocketTimerWheel()
+{
+  for (uint32 level = 0; level < Levels; level++)
+  {
+    for (uint32 slot = 0; slot < Slots; slot++)
+    {
+      while (m_pSlots[level][slot] != nullptr)
+        UnlinkTimer(m_pSlots[level][slot]);
+    }
+  }
+  while (m_pDueTimers != nullptr)
+    UnlinkTimer(m_pDueTimers);
+}
+
+void SocketTimerWheel::LinkTimer(SocketTimer** ppHead, SocketTimer* pTimer)
+{
+  pTimer->m_pNext = *ppHead;
+  if (pTimer->m_pNext != nullptr)
+    pTimer->m_pNext->m_ppPrevNext = &pTimer->m_pNext;
+
+  pTimer->m_ppPrevNext = ppHead;
+  *ppHead = pTimer;
+}
+
+void SocketTimerWheel::UnlinkTimer(SocketTimer* pTimer)
+{
+  *pTimer->m_ppPrevNext = pTimer->m_pNext;
+  if (pTimer->m_pNext != nullptr)
+    pTimer->m_pNext->m_ppPrevNext = pTimer->m_ppPrevNext;
+
+  pTimer->m_pNext = nullptr;
+  pTimer->m_ppPrevNext = nullptr;
+}
+
+void SocketTimerWheel::InsertTimer(SocketTimer* pTimer)
+{
+  // The level is the first whose span covers the wait, and the slot is the expiry's digit at that level, so it's
+  // reached when the level above cascades that far. Waits beyond the wheel are placed at its end, and placed again
+  // from their real expiry when that cascades.
+  static const uint64 wheelSpan = (uint64)1 << (SlotBits * Levels);
+  uint64 expiryTick = Max(pTimer->m_expiryTick, m_nextTick);
+  uint64 delta = expiryTick - m_nextTick;
+  if (delta >= wheelSpan)
+  {
+    expiryTick = m_nextTick + wheelSpan - 1;
+    delta = wheelSpan - 1;
+  }
+
+  uint32 level = 0;
+  while (delta >= ((uint64)1 << (SlotBits * (level + 1))))
+    level++;
+
+  uint32 slot = (uint32)(expiryTick >> (SlotBits * level)) & SlotMask;
+  LinkTimer(&m_pSlots[level][slot], pTimer);
+}
+
+uint64 SocketTimerWheel::ScheduleTimer(SocketTimer* pTimer, uint64 currentTick, uint32 milliseconds)
+{
+  if (pTimer->m_ppPrevNext != nullptr)
+  {
+    UnlinkTimer(pTimer);
+    m_timerCount--;
+  }
+
+  // an empty wheel just catches up, it has nothing to fire on the ticks it skips
+  if (m_timerCount == 0 && m_nextTick < currentTick)
+    m_nextTick = currentTick;
+
+  // the current tick is partly gone, so the timer is due on the one after it's up
+  pTimer->m_expiryTick = currentTick + milliseconds + 1;
+  InsertTimer(pTimer);
+  m_timerCount++;
+  return pTimer->m_expiryTick;
+}
+
+bool SocketTimerWheel::CancelTimer(SocketTimer* pTimer)
+{
+  if (pTimer->m_ppPrevNext == nullptr)
+    return false;
+
+  UnlinkTimer(pTimer);
+  m_timerCount--;
+  return true;
+}
+
+uint32 SocketTimerWheel::GetTimerWait(uint64 currentTick, uint32 milliseconds) const
+{
+  if (m_pDueTimers != nullptr)
+    return 0;
+  if (m_timerCount == 0 || milliseconds == 0)
+    return milliseconds;
+
+  // Level 0 only holds timers due within its span of the next tick. Past the first of them, it's enough to wake for
+  // the cascades that could bring timers down sooner, which are the level 1 slots with timers in, and the next
+  // level 2 boundary, as scanning further than that would cost more than the wakeup.
+  uint64 wakeTick = Y_UINT64_MAX;
+  for (uint64 tick = m_nextTick; tick < m_nextTick + Slots; tick++)
+  {
+    if (m_pSlots[0][tick & SlotMask] != nullptr)
+    {
+      wakeTick = tick;
+      break;
+    }
+  }
+  for (uint64 tick = (m_nextTick + SlotMask) & ~(uint64)SlotMask; tick < wakeTick; tick += Slots)
+  {
+    uint32 slot = (uint32)(tick >> SlotBits) & SlotMask;
+    if (slot == 0 || m_pSlots[1][slot] != nullptr)
+    {
+      wakeTick = tick;
+      break;
+    }
+  }
+
+  if (wakeTick <= currentTick)
+    return 0;
+
+  return (uint32)Min(wakeTick - currentTick, (uint64)milliseconds);
+}
+
+void SocketTimerWheel::AdvanceTimers(uint64 currentTick)
+{
+  if (m_timerCount == 0)
+    return;
+
+  for (; m_nextTick <= currentTick; m_nextTick++)
+  {
+    // at the start of each span, the slot of the level above for it is placed again, one level down or more
+    uint32 slot = (uint32)m_nextTick & SlotMask;
+    if (slot == 0)
+    {
+      for (uint32 level = 1; level < Levels; level++)
+      {
+        uint32 levelSlot = (uint32)(m_nextTick >> (SlotBits * level)) & SlotMask;
+        SocketTimer* pTimer = m_pSlots[level][levelSlot];
+        m_pSlots[level][levelSlot] = nullptr;
+        while (pTimer != nullptr)
+        {
+          SocketTimer* pNextTimer = pTimer->m_pNext;
+          InsertTimer(pTimer);
+          pTimer = pNextTimer;
+        }
+
+        // the level above only cascades when this one wraps
+        if (levelSlot != 0)
+          break;
+      }
+    }
+
+    SocketTimer* pTimer = m_pSlots[0][slot];
+    m_pSlots[0][slot] = nullptr;
+    while (pTimer != nullptr)
+    {
+      SocketTimer* pNextTimer = pTimer->m_pNext;
+      LinkTimer(&m_pDueTimers, pTimer);
+      pTimer = pNextTimer;
+    }
+  }
+}
+
+SocketTimer* SocketTimerWheel::TakeDueTimer()
+{
+  SocketTimer* pTimer = m_pDueTimers;
+  if (pTimer != nullptr)
+  {
+    UnlinkTimer(pTimer);
+    m_timerCount--;
+  }
+
+  return pTimer;
+}
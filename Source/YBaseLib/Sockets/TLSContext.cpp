@@ -0,0 +1,214 @@
+#include "YBaseLib/Sockets/TLSContext.h"
+#include "YBaseLib/Error.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/NumericLimits.h"
+#include "YBaseLib/Sockets/TLSStreamSocket.h"
+Log_SetChannel(TLSContext);
+
+#ifdef HAVE_OPENSSL
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+const uint32 TLSContext::MaxCachedSessions;
+
+// the same for every context, servers only resume sessions under their own
+static const unsigned char SESSION_ID_CONTEXT[] = "YBaseLib";
+
+TLSContext::TLSContext(Mode mode, ssl_ctx_st* pContext)
+  : m_mode(mode), m_pContext(pContext), m_verifyPeer(mode == Mode_Client)
+{
+}
+
+TLSContext::~TLSContext()
+{
+  ClearSessionCache();
+  SSL_CTX_free(m_pContext);
+}
+
+TLSContext* TLSContext::Create(Mode mode, Error* pError)
+{
+  SSL_CTX* pContext = SSL_CTX_new((mode == Mode_Client) ? TLS_client_method() : TLS_server_method());
+  if (pContext == nullptr)
+  {
+    SetErrorFromQueue(pError);
+    return nullptr;
+  }
+
+  // Writes go a record at a time, and a blocked one is retried from a copy, see TLSStreamSocket::Write.
+  SSL_CTX_set_min_proto_version(pContext, TLS1_2_VERSION);
+  SSL_CTX_set_mode(pContext, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+  SSL_CTX_set_options(pContext, SSL_OP_NO_RENEGOTIATION);
+#ifdef SSL_OP_ENABLE_KTLS
+  SSL_CTX_set_options(pContext, SSL_OP_ENABLE_KTLS);
+#endif
+
+  TLSContext* pTLSContext = new TLSContext(mode, pContext);
+  SSL_CTX_set_app_data(pContext, pTLSContext);
+  if (mode == Mode_Client)
+  {
+    // OpenSSL's client cache can't be looked up by server name, so sessions are kept here instead
+    SSL_CTX_set_session_cache_mode(pContext, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(pContext, NewSessionCallback);
+    SSL_CTX_set_verify(pContext, SSL_VERIFY_PEER, nullptr);
+    if (SSL_CTX_set_default_verify_paths(pContext) != 1)
+      Log_WarningPrint("TLSContext::Create: Failed to load the system's certificates");
+  }
+  else
+  {
+    SSL_CTX_set_session_cache_mode(pContext, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(pContext, MaxCachedSessions);
+    SSL_CTX_set_session_id_context(pContext, SESSION_ID_CONTEXT, sizeof(SESSION_ID_CONTEXT) - 1);
+    SSL_CTX_set_verify(pContext, SSL_VERIFY_NONE, nullptr);
+  }
+
+  return pTLSContext;
+}
+
+bool TLSContext::SetCertificate(const char* certificateChainFileName, const char* privateKeyFileName,
+                                Error* pError)
+{
+  if (SSL_CTX_use_certificate_chain_file(m_pContext, certificateChainFileName) != 1 ||
+      SSL_CTX_use_PrivateKey_file(m_pContext, privateKeyFileName, SSL_FILETYPE_PEM) != 1 ||
+      SSL_CTX_check_private_key(m_pContext) != 1)
+  {
+    SetErrorFromQueue(pError);
+    return false;
+  }
+
+  return true;
+}
+
+bool TLSContext::SetVerifyLocations(const char* caFileName, Error* pError)
+{
+  X509_STORE* pStore = X509_STORE_new();
+  if (pStore == nullptr || X509_STORE_load_locations(pStore, caFileName, nullptr) != 1)
+  {
+    SetErrorFromQueue(pError);
+    X509_STORE_free(pStore);
+    return false;
+  }
+
+  SSL_CTX_set_cert_store(m_pContext, pStore);
+  return true;
+}
+
+void TLSContext::SetVerifyPeer(bool enabled)
+{
+  int mode = SSL_VERIFY_NONE;
+  if (enabled)
+    mode = (m_mode == Mode_Client) ? SSL_VERIFY_PEER : (SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT);
+
+  SSL_CTX_set_verify(m_pContext, mode, nullptr);
+  m_verifyPeer = enabled;
+}
+
+void TLSContext::SetKernelTLS(bool enabled)
+{
+#ifdef SSL_OP_ENABLE_KTLS
+  if (enabled)
+    SSL_CTX_set_options(m_pContext, SSL_OP_ENABLE_KTLS);
+  else
+    SSL_CTX_clear_options(m_pContext, SSL_OP_ENABLE_KTLS);
+#endif
+}
+
+void TLSContext::ClearSessionCache()
+{
+  m_sessionLock.Lock();
+
+  for (CIStringHashTable<SSL_SESSION*>::Iterator itr = m_sessions.Begin(); itr != m_sessions.End(); ++itr)
+    SSL_SESSION_free(itr->Value);
+  m_sessions.Clear();
+
+  m_sessionLock.Unlock();
+
+  if (m_mode == Mode_Server)
+    SSL_CTX_flush_sessions(m_pContext, Y_INT32_MAX);
+}
+
+void TLSContext::SetErrorFromQueue(Error* pError)
+{
+  unsigned long errorCode = ERR_get_error();
+  ERR_clear_error();
+  if (pError == nullptr)
+    return;
+
+  if (errorCode == 0)
+  {
+    pError->SetErrorUserStatic(0, "Unknown TLS error.");
+    return;
+  }
+
+  char message[256];
+  ERR_error_string_n(errorCode, message, sizeof(message));
+  pError->SetErrorUser((int32)ERR_GET_REASON(errorCode), message);
+}
+
+SSL_SESSION* TLSContext::TakeSession(const char* serverName)
+{
+  m_sessionLock.Lock();
+
+  SSL_SESSION* pSession = nullptr;
+  CIStringHashTable<SSL_SESSION*>::Member* pMember = m_sessions.Find(serverName);
+  if (pMember != nullptr)
+  {
+    pSession = pMember->Value;
+    if (!SSL_SESSION_is_resumable(pSession) || SSL_SESSION_get_protocol_version(pSession) >= TLS1_3_VERSION)
+    {
+      // the table's reference goes to the caller
+      m_sessions.Remove(pMember);
+      if (!SSL_SESSION_is_resumable(pSession))
+      {
+        SSL_SESSION_free(pSession);
+        pSession = nullptr;
+      }
+    }
+    else
+    {
+      SSL_SESSION_up_ref(pSession);
+    }
+  }
+
+  m_sessionLock.Unlock();
+  return pSession;
+}
+
+int TLSContext::NewSessionCallback(SSL* pSSL, SSL_SESSION* pSession)
+{
+  const TLSStreamSocket* pSocket = static_cast<const TLSStreamSocket*>(SSL_get_app_data(pSSL));
+  TLSContext* pTLSContext = static_cast<TLSContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(pSSL)));
+  if (pSocket == nullptr || pSocket->GetServerName().IsEmpty())
+    return 0;
+
+  pTLSContext->m_sessionLock.Lock();
+
+  CIStringHashTable<SSL_SESSION*>::Member* pMember = pTLSContext->m_sessions.Find(pSocket->GetServerName());
+  if (pMember != nullptr)
+  {
+    SSL_SESSION_free(pMember->Value);
+    pMember->Value = pSession;
+  }
+  else
+  {
+    // past the limit, everything goes, it's refilled as servers are reconnected to
+    if (pTLSContext->m_sessions.GetMemberCount() >= MaxCachedSessions)
+    {
+      for (CIStringHashTable<SSL_SESSION*>::Iterator itr = pTLSContext->m_sessions.Begin();
+           itr != pTLSContext->m_sessions.End(); ++itr)
+      {
+        SSL_SESSION_free(itr->Value);
+      }
+      pTLSContext->m_sessions.Clear();
+    }
+
+    pTLSContext->m_sessions.Set(pSocket->GetServerName(), pSession, nullptr);
+  }
+
+  pTLSContext->m_sessionLock.Unlock();
+
+  // the reference OpenSSL passed is kept
+  return 1;
+}
+
+#endif // HAVE_OPENSSL
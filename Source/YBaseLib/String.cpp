@@ -1,10 +1,12 @@
 #include "YBaseLib/String.h"
+#include "YBaseLib/Allocator.h"
 #include "YBaseLib/Atomic.h"
 #include "YBaseLib/ByteStream.h"
+#include "YBaseLib/HashTrait.h"
 #include "YBaseLib/Memory.h"
 
 // globals
-const String::StringData String::s_EmptyStringData = {const_cast<char*>(""), 0, 1, true, -1};
+const String::StringData String::s_EmptyStringData = {const_cast<char*>(""), 0, 1, true, false, -1, 0};
 const String EmptyString;
 
 // helper functions
@@ -13,12 +15,14 @@ static String::StringData* StringDataAllocate(uint32 allocSize)
   DebugAssert(allocSize > 0);
 
   String::StringData* pStringData =
-    reinterpret_cast<String::StringData*>(std::malloc(sizeof(String::StringData) + allocSize));
+    reinterpret_cast<String::StringData*>(Y_malloc(sizeof(String::StringData) + allocSize));
   pStringData->pBuffer = reinterpret_cast<char*>(pStringData + 1);
   pStringData->StringLength = 0;
   pStringData->BufferSize = allocSize;
   pStringData->ReadOnly = false;
+  pStringData->HashValid = false;
   pStringData->ReferenceCount = 1;
+  pStringData->Hash = 0;
 
   // if in debug build, set all to zero, otherwise only the first to zero.
 #if Y_BUILD_CONFIG_DEBUG
@@ -32,21 +36,42 @@ static String::StringData* StringDataAllocate(uint32 allocSize)
   return pStringData;
 }
 
+// References are added with relaxed increments, since they're only ever copied from one that's held, and dropped
+// with acquire-release decrements, so the last release can't free the data while another thread is still reading
+// it. Checks for sole ownership load the count with acquire, so a thread that sees its reference is the last one also
+// sees every other owner done with the buffer before it writes to it in place.
 static inline void StringDataAddRef(String::StringData* pStringData)
 {
   DebugAssert(pStringData->ReferenceCount > 0);
-  Y_AtomicIncrement(pStringData->ReferenceCount);
+  Y_AtomicIncrement(pStringData->ReferenceCount, ATOMIC_MEMORY_ORDER_RELAXED);
 }
 
 static inline void StringDataRelease(String::StringData* pStringData)
 {
+  // -1 is never changed, so it doesn't need an atomic load
   if (pStringData->ReferenceCount == -1)
     return;
 
   DebugAssert(pStringData->ReferenceCount > 0);
-  uint32 newRefCount = Y_AtomicDecrement(pStringData->ReferenceCount);
-  if (!newRefCount)
-    std::free(pStringData);
+  int32 newRefCount = Y_AtomicDecrement(pStringData->ReferenceCount, ATOMIC_MEMORY_ORDER_ACQ_REL);
+  if (newRefCount == 0)
+    Y_free(pStringData);
+}
+
+static bool StringDataIsSharable(const String::StringData* pStringData)
+{
+  return pStringData->ReferenceCount != -1;
+}
+
+static bool StringDataIsShared(const String::StringData* pStringData)
+{
+  return Y_AtomicLoadAcquire(pStringData->ReferenceCount) > 1;
+}
+
+// other owners can only drop their references while we check, never add them, that needs a copy of our string
+static bool StringDataIsUniquelyOwned(const String::StringData* pStringData)
+{
+  return Y_AtomicLoadAcquire(pStringData->ReferenceCount) == 1;
 }
 
 static String::StringData* StringDataClone(const String::StringData* pStringData, uint32 newSize, bool copyPastString)
@@ -87,10 +112,10 @@ static String::StringData* StringDataClone(const String::StringData* pStringData
 static String::StringData* StringDataReallocate(String::StringData* pStringData, uint32 newSize)
 {
   DebugAssert(newSize > pStringData->StringLength);
-  DebugAssert(pStringData->ReferenceCount == 1);
+  DebugAssert(StringDataIsUniquelyOwned(pStringData));
 
   // perform realloc
-  pStringData = reinterpret_cast<String::StringData*>(std::realloc(pStringData, sizeof(String::StringData) + newSize));
+  pStringData = reinterpret_cast<String::StringData*>(Y_realloc(pStringData, sizeof(String::StringData) + newSize));
   pStringData->pBuffer = reinterpret_cast<char*>(pStringData + 1);
 
   // zero bytes in debug
@@ -112,16 +137,6 @@ static String::StringData* StringDataReallocate(String::StringData* pStringData,
   return pStringData;
 }
 
-static bool StringDataIsSharable(const String::StringData* pStringData)
-{
-  return pStringData->ReferenceCount != -1;
-}
-
-static bool StringDataIsShared(const String::StringData* pStringData)
-{
-  return pStringData->ReferenceCount > 1;
-}
-
 String::String() : m_pStringData(const_cast<String::StringData*>(&s_EmptyStringData)) {}
 
 String::String(const String& copyString)
@@ -145,11 +160,34 @@ String::String(const String& copyString)
   }
 }
 
+String::String(String&& moveString)
+{
+  // the reference moves with the pointer, so the count doesn't change
+  if (StringDataIsSharable(moveString.m_pStringData))
+  {
+    m_pStringData = moveString.m_pStringData;
+    moveString.m_pStringData = const_cast<String::StringData*>(&s_EmptyStringData);
+  }
+  else if (moveString.IsEmpty())
+  {
+    m_pStringData = const_cast<String::StringData*>(&s_EmptyStringData);
+  }
+  else
+  {
+    m_pStringData = StringDataClone(moveString.m_pStringData, moveString.m_pStringData->StringLength + 1, false);
+  }
+}
+
 String::String(const char* Text) : m_pStringData(const_cast<String::StringData*>(&s_EmptyStringData))
 {
   Assign(Text);
 }
 
+String::String(const StringView& view) : m_pStringData(const_cast<String::StringData*>(&s_EmptyStringData))
+{
+  AppendString(view);
+}
+
 String::~String()
 {
   StringDataRelease(m_pStringData);
@@ -163,6 +201,9 @@ void String::EnsureOwnWritableCopy()
     StringDataRelease(m_pStringData);
     m_pStringData = pNewStringData;
   }
+
+  // the caller is about to write, so the cached hash is going stale
+  m_pStringData->HashValid = false;
 }
 
 void String::EnsureRemainingSpace(uint32 spaceRequired)
@@ -181,7 +222,7 @@ void String::EnsureRemainingSpace(uint32 spaceRequired)
     uint32 newSize = Max(requiredReserve, m_pStringData->BufferSize * 2);
 
     // if we are the only owner of the buffer, we can simply realloc it
-    if (m_pStringData->ReferenceCount == 1)
+    if (StringDataIsUniquelyOwned(m_pStringData))
     {
       // do realloc and update pointer
       m_pStringData = StringDataReallocate(m_pStringData, newSize);
@@ -194,6 +235,8 @@ void String::EnsureRemainingSpace(uint32 spaceRequired)
       m_pStringData = pNewStringData;
     }
   }
+
+  m_pStringData->HashValid = false;
 }
 
 void String::InternalAppend(const char* pString, uint32 Length)
@@ -245,6 +288,12 @@ void String::AppendString(const char* appendString, uint32 Count)
     InternalAppend(appendString, Count);
 }
 
+void String::AppendString(const StringView& appendView)
+{
+  if (appendView.GetLength() > 0)
+    InternalAppend(appendView.GetData(), appendView.GetLength());
+}
+
 void String::AppendSubString(const String& appendStr, int32 Offset /* = 0 */, int32 Count /* = INT_MAX */)
 {
   uint32 appendStrLength = appendStr.GetLength();
@@ -313,11 +362,15 @@ void String::AppendFormattedStringVA(const char* FormatString, va_list ArgPtr)
 
   for (;;)
   {
-    int ret = Y_vsnprintf(pBuffer, currentBufferSize, FormatString, ArgPtr);
+    // each attempt needs its own copy of the arguments
+    va_list ArgPtrCopy;
+    va_copy(ArgPtrCopy, ArgPtr);
+    int ret = Y_vsnprintf(pBuffer, currentBufferSize, FormatString, ArgPtrCopy);
+    va_end(ArgPtrCopy);
     if (ret < 0 || ((uint32)ret >= (currentBufferSize - 1)))
     {
       currentBufferSize *= 2;
-      pBuffer = pHeapBuffer = reinterpret_cast<char*>(std::realloc(pHeapBuffer, currentBufferSize));
+      pBuffer = pHeapBuffer = reinterpret_cast<char*>(Y_realloc(pHeapBuffer, currentBufferSize));
       continue;
     }
 
@@ -328,7 +381,7 @@ void String::AppendFormattedStringVA(const char* FormatString, va_list ArgPtr)
   InternalAppend(pBuffer, charsWritten);
 
   if (pHeapBuffer != NULL)
-    std::free(pHeapBuffer);
+    Y_free(pHeapBuffer);
 }
 
 void String::PrependCharacter(char c)
@@ -355,6 +408,12 @@ void String::PrependString(const char* appendString, uint32 Count)
     InternalPrepend(appendString, Count);
 }
 
+void String::PrependString(const StringView& appendView)
+{
+  if (appendView.GetLength() > 0)
+    InternalPrepend(appendView.GetData(), appendView.GetLength());
+}
+
 void String::PrependSubString(const String& appendStr, int32 Offset /* = 0 */, int32 Count /* = INT_MAX */)
 {
   uint32 appendStrLength = appendStr.GetLength();
@@ -423,11 +482,15 @@ void String::PrependFormattedStringVA(const char* FormatString, va_list ArgPtr)
 
   for (;;)
   {
-    int ret = Y_vsnprintf(pBuffer, currentBufferSize, FormatString, ArgPtr);
+    // each attempt needs its own copy of the arguments
+    va_list ArgPtrCopy;
+    va_copy(ArgPtrCopy, ArgPtr);
+    int ret = Y_vsnprintf(pBuffer, currentBufferSize, FormatString, ArgPtrCopy);
+    va_end(ArgPtrCopy);
     if (ret < 0 || ((uint32)ret >= (currentBufferSize - 1)))
     {
       currentBufferSize *= 2;
-      pBuffer = pHeapBuffer = reinterpret_cast<char*>(std::realloc(pHeapBuffer, currentBufferSize));
+      pBuffer = pHeapBuffer = reinterpret_cast<char*>(Y_realloc(pHeapBuffer, currentBufferSize));
       continue;
     }
 
@@ -438,7 +501,7 @@ void String::PrependFormattedStringVA(const char* FormatString, va_list ArgPtr)
   InternalPrepend(pBuffer, charsWritten);
 
   if (pHeapBuffer != NULL)
-    std::free(pHeapBuffer);
+    Y_free(pHeapBuffer);
 }
 
 void String::InsertString(int32 offset, const String& appendStr)
@@ -451,6 +514,11 @@ void String::InsertString(int32 offset, const char* appendStr)
   InsertString(offset, appendStr, Y_strlen(appendStr));
 }
 
+void String::InsertString(int32 offset, const StringView& appendView)
+{
+  InsertString(offset, appendView.GetData(), appendView.GetLength());
+}
+
 void String::InsertString(int32 offset, const char* appendStr, uint32 appendStrLength)
 {
   if (appendStrLength == 0)
@@ -498,6 +566,9 @@ void String::FormatVA(const char* FormatString, va_list ArgPtr)
 
 void String::Assign(const String& copyString)
 {
+  // the old data is released last, in case it's also copyString's
+  StringData* pOldStringData = m_pStringData;
+
   // special case: empty strings
   if (copyString.IsEmpty())
   {
@@ -515,6 +586,26 @@ void String::Assign(const String& copyString)
     // since we're going to the effort of creating a clone, we might as well create it as the smallest size possible
     m_pStringData = StringDataClone(copyString.m_pStringData, copyString.m_pStringData->StringLength + 1, false);
   }
+
+  StringDataRelease(pOldStringData);
+}
+
+void String::Assign(String&& moveString)
+{
+  if (&moveString == this)
+    return;
+
+  // text that can't be shared is copied into the buffer we already have
+  if (!StringDataIsSharable(moveString.m_pStringData))
+  {
+    Assign(StringView(moveString));
+    return;
+  }
+
+  StringData* pOldStringData = m_pStringData;
+  m_pStringData = moveString.m_pStringData;
+  moveString.m_pStringData = const_cast<String::StringData*>(&s_EmptyStringData);
+  StringDataRelease(pOldStringData);
 }
 
 void String::Assign(const char* copyText)
@@ -523,6 +614,33 @@ void String::Assign(const char* copyText)
   AppendString(copyText);
 }
 
+void String::Assign(const StringView& copyView)
+{
+  if (copyView.IsEmpty())
+  {
+    Clear();
+    return;
+  }
+
+  // a view of part of this string is moved down, clearing first would lose it
+  const char* pBuffer = m_pStringData->pBuffer;
+  if (copyView.GetData() >= pBuffer && copyView.GetData() < pBuffer + m_pStringData->StringLength)
+  {
+    uint32 offset = uint32(copyView.GetData() - pBuffer);
+    uint32 length = copyView.GetLength();
+    DebugAssert(offset + length <= m_pStringData->StringLength);
+
+    EnsureOwnWritableCopy();
+    std::memmove(m_pStringData->pBuffer, m_pStringData->pBuffer + offset, length);
+    m_pStringData->StringLength = length;
+    m_pStringData->pBuffer[length] = 0;
+    return;
+  }
+
+  Clear();
+  InternalAppend(copyView.GetData(), copyView.GetLength());
+}
+
 void String::AssignCopy(const String& copyString)
 {
   Clear();
@@ -544,6 +662,11 @@ bool String::Compare(const char* otherText) const
   return (Y_strcmp(m_pStringData->pBuffer, otherText) == 0);
 }
 
+bool String::Compare(const StringView& otherView) const
+{
+  return StringView(*this).Compare(otherView);
+}
+
 bool String::SubCompare(const String& otherString, uint32 Length) const
 {
   return (Y_strncmp(m_pStringData->pBuffer, otherString.m_pStringData->pBuffer, Length) == 0);
@@ -564,6 +687,11 @@ bool String::CompareInsensitive(const char* otherText) const
   return (Y_stricmp(m_pStringData->pBuffer, otherText) == 0);
 }
 
+bool String::CompareInsensitive(const StringView& otherView) const
+{
+  return StringView(*this).CompareInsensitive(otherView);
+}
+
 bool String::SubCompareInsensitive(const String& otherString, uint32 Length) const
 {
   return (Y_strnicmp(m_pStringData->pBuffer, otherString.m_pStringData->pBuffer, Length) == 0);
@@ -584,6 +712,11 @@ int String::NumericCompare(const char* otherText) const
   return Y_strcmp(m_pStringData->pBuffer, otherText);
 }
 
+int String::NumericCompare(const StringView& otherView) const
+{
+  return StringView(*this).NumericCompare(otherView);
+}
+
 int String::NumericCompareInsensitive(const String& otherString) const
 {
   return Y_stricmp(m_pStringData->pBuffer, otherString.m_pStringData->pBuffer);
@@ -594,6 +727,11 @@ int String::NumericCompareInsensitive(const char* otherText) const
   return Y_stricmp(m_pStringData->pBuffer, otherText);
 }
 
+int String::NumericCompareInsensitive(const StringView& otherView) const
+{
+  return StringView(*this).NumericCompareInsensitive(otherView);
+}
+
 bool String::StartsWith(const char* compareString, bool caseSensitive /*= true*/) const
 {
   uint32 compareStringLength = Y_strlen(compareString);
@@ -615,6 +753,11 @@ bool String::StartsWith(const String& compareString, bool caseSensitive /*= true
            (Y_strnicmp(compareString.m_pStringData->pBuffer, m_pStringData->pBuffer, compareStringLength) == 0);
 }
 
+bool String::StartsWith(const StringView& compareView, bool caseSensitive /*= true*/) const
+{
+  return StringView(*this).StartsWith(compareView, caseSensitive);
+}
+
 bool String::EndsWith(const char* compareString, bool caseSensitive /*= true*/) const
 {
   uint32 compareStringLength = Y_strlen(compareString);
@@ -639,6 +782,11 @@ bool String::EndsWith(const String& compareString, bool caseSensitive /*= true*/
                                        compareStringLength) == 0);
 }
 
+bool String::EndsWith(const StringView& compareView, bool caseSensitive /*= true*/) const
+{
+  return StringView(*this).EndsWith(compareView, caseSensitive);
+}
+
 void String::Clear()
 {
   if (m_pStringData == &s_EmptyStringData)
@@ -660,6 +808,7 @@ void String::Clear()
     m_pStringData->pBuffer[0] = '\0';
 #endif
     m_pStringData->StringLength = 0;
+    m_pStringData->HashValid = false;
   }
 }
 
@@ -687,11 +836,9 @@ int32 String::RFind(char c, uint32 Offset /* = 0*/) const
   return (pAt == NULL) ? -1 : int32(pAt - m_pStringData->pBuffer);
 }
 
-int32 String::Find(const char* str, uint32 Offset /* = 0 */) const
+int32 String::Find(const StringView& str, uint32 Offset /* = 0 */) const
 {
-  DebugAssert(Offset <= m_pStringData->StringLength);
-  char* pAt = Y_strstr(m_pStringData->pBuffer + Offset, str);
-  return (pAt == NULL) ? -1 : int32(pAt - m_pStringData->pBuffer);
+  return StringView(*this).Find(str, Offset);
 }
 
 void String::Reserve(uint32 newReserve, bool Force /* = false */)
@@ -714,7 +861,7 @@ void String::Reserve(uint32 newReserve, bool Force /* = false */)
       return;
 
     // if we are the only owner of the buffer, we can simply realloc it
-    if (m_pStringData->ReferenceCount == 1)
+    if (StringDataIsUniquelyOwned(m_pStringData))
     {
       // do realloc and update pointer
       m_pStringData = StringDataReallocate(m_pStringData, newSize);
@@ -758,6 +905,7 @@ void String::Resize(uint32 newSize, char fillerCharacter /* = ' ' */, bool skrin
     m_pStringData->pBuffer[newSize] = 0;
 #endif
     m_pStringData->StringLength = newSize;
+    m_pStringData->HashValid = false;
 
     // shrink if requested
     if (skrinkIfSmaller)
@@ -765,6 +913,23 @@ void String::Resize(uint32 newSize, char fillerCharacter /* = ' ' */, bool skrin
   }
 }
 
+uint32 String::GetHash() const
+{
+  // Copies on other threads can race to fill it in, they all write the same value. Strings that can't be shared,
+  // like stack and static strings and the empty string, aren't worth caching for.
+  StringData* pStringData = m_pStringData;
+  if (!StringDataIsSharable(pStringData))
+    return Y_HashBytes(pStringData->pBuffer, pStringData->StringLength);
+
+  if (Y_AtomicLoadAcquire(pStringData->HashValid))
+    return Y_AtomicLoad(pStringData->Hash, ATOMIC_MEMORY_ORDER_RELAXED);
+
+  uint32 hash = Y_HashBytes(pStringData->pBuffer, pStringData->StringLength);
+  Y_AtomicStore(pStringData->Hash, hash, ATOMIC_MEMORY_ORDER_RELAXED);
+  Y_AtomicStoreRelease(pStringData->HashValid, true);
+  return hash;
+}
+
 void String::UpdateSize()
 {
   EnsureOwnWritableCopy();
@@ -774,7 +939,7 @@ void String::UpdateSize()
 void String::Shrink(bool Force /* = false */)
 {
   // only shrink of we own the buffer, or forced
-  if (Force || m_pStringData->ReferenceCount == 1)
+  if (Force || StringDataIsUniquelyOwned(m_pStringData))
     Reserve(m_pStringData->StringLength);
 }
 
@@ -810,6 +975,9 @@ void String::Erase(int32 Offset, int32 Count /* = INT_MAX */)
     return;
   }
 
+  // the other copies keep their text
+  EnsureOwnWritableCopy();
+
   // Fastpath: offset >= 0, count < 0, wipe everything after offset + count
   if ((realOffset + realCount) == m_pStringData->StringLength)
   {
@@ -845,8 +1013,13 @@ uint32 String::Replace(char searchCharacter, char replaceCharacter)
   char* pCurrent = Y_strchr(m_pStringData->pBuffer, searchCharacter);
   while (pCurrent != NULL)
   {
+    // the first replacement may move the text to a buffer of its own
     if ((nReplacements++) == 0)
+    {
+      uint32 offset = uint32(pCurrent - m_pStringData->pBuffer);
       EnsureOwnWritableCopy();
+      pCurrent = m_pStringData->pBuffer + offset;
+    }
 
     *pCurrent = replaceCharacter;
     pCurrent = Y_strchr(pCurrent + 1, searchCharacter);
@@ -1004,3 +1177,33 @@ String String::FromFormat(const char* FormatString, ...)
 
   return returnStr;
 }
+
+ArenaString::ArenaString(MemoryArena& arena, uint32 bufferSize /* = 256 */) : String(&m_sStringData), m_pArena(&arena)
+{
+  InitArenaStringData(bufferSize);
+}
+
+ArenaString::ArenaString(MemoryArena& arena, const char* Text) : String(&m_sStringData), m_pArena(&arena)
+{
+  InitArenaStringData(Y_strlen(Text) + 1);
+  Assign(Text);
+}
+
+ArenaString::ArenaString(const ArenaString& copyString) : String(&m_sStringData), m_pArena(copyString.m_pArena)
+{
+  // force a copy into our own arena buffer by passing it a string pointer, instead of a string object
+  InitArenaStringData(copyString.GetLength() + 1);
+  Assign(copyString.GetCharArray());
+}
+
+void ArenaString::InitArenaStringData(uint32 bufferSize)
+{
+  DebugAssert(bufferSize > 0);
+  m_sStringData.pBuffer = reinterpret_cast<char*>(m_pArena->Allocate(bufferSize, 1));
+  m_sStringData.StringLength = 0;
+  m_sStringData.BufferSize = bufferSize;
+  m_sStringData.ReadOnly = false;
+  m_sStringData.HashValid = false;
+  m_sStringData.ReferenceCount = -1;
+  m_sStringData.pBuffer[0] = '\0';
+}
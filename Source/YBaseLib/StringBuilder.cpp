@@ -0,0 +1,141 @@
+#include "YBaseLib/StringBuilder.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include <cstring>
+
+// the first few chunks share a block of the private arena, the larger ones get blocks of their own
+StringBuilder::StringBuilder(uint32 firstChunkSize /* = 4096 */)
+  : m_ownArena(65536), m_pArena(&m_ownArena), m_pFirstChunk(NULL), m_pCurrentChunk(NULL),
+    m_nextChunkSize(Min(Max(firstChunkSize, 64u), MaxChunkSize)), m_length(0)
+{
+}
+
+StringBuilder::StringBuilder(MemoryArena& arena, uint32 firstChunkSize /* = 4096 */)
+  : m_ownArena(64), m_pArena(&arena), m_pFirstChunk(NULL), m_pCurrentChunk(NULL),
+    m_nextChunkSize(Min(Max(firstChunkSize, 64u), MaxChunkSize)), m_length(0)
+{
+}
+
+StringBuilder::~StringBuilder() {}
+
+uint32 StringBuilder::GetChunkCount() const
+{
+  uint32 count = 0;
+  for (const Chunk* pChunk = m_pFirstChunk; pChunk != NULL && pChunk->Used > 0; pChunk = pChunk->pNext)
+    count++;
+
+  return count;
+}
+
+void StringBuilder::NextChunk()
+{
+  if (m_pCurrentChunk != NULL && m_pCurrentChunk->pNext != NULL)
+  {
+    m_pCurrentChunk = m_pCurrentChunk->pNext;
+    return;
+  }
+
+  Chunk* pChunk = reinterpret_cast<Chunk*>(m_pArena->Allocate(sizeof(Chunk) + m_nextChunkSize, alignof(Chunk)));
+  pChunk->pNext = NULL;
+  pChunk->Size = m_nextChunkSize;
+  pChunk->Used = 0;
+  m_nextChunkSize = Min(m_nextChunkSize * 2, MaxChunkSize);
+
+  if (m_pCurrentChunk != NULL)
+    m_pCurrentChunk->pNext = pChunk;
+  else
+    m_pFirstChunk = pChunk;
+
+  m_pCurrentChunk = pChunk;
+}
+
+void StringBuilder::AppendString(const char* appendText)
+{
+  AppendString(appendText, Y_strlen(appendText));
+}
+
+void StringBuilder::AppendString(const char* appendString, uint32 Count)
+{
+  m_length += Count;
+  while (Count > 0)
+  {
+    if (m_pCurrentChunk == NULL || m_pCurrentChunk->Used == m_pCurrentChunk->Size)
+      NextChunk();
+
+    uint32 copyCount = Min(Count, m_pCurrentChunk->Size - m_pCurrentChunk->Used);
+    std::memcpy(GetChunkData(m_pCurrentChunk) + m_pCurrentChunk->Used, appendString, copyCount);
+    m_pCurrentChunk->Used += copyCount;
+    appendString += copyCount;
+    Count -= copyCount;
+  }
+}
+
+void StringBuilder::AppendFormattedString(const char* FormatString, ...)
+{
+  va_list ap;
+  va_start(ap, FormatString);
+  AppendFormattedStringVA(FormatString, ap);
+  va_end(ap);
+}
+
+void StringBuilder::AppendFormattedStringVA(const char* FormatString, va_list ArgPtr)
+{
+  StackString<1024> buffer;
+  buffer.AppendFormattedStringVA(FormatString, ArgPtr);
+  AppendString(buffer);
+}
+
+void StringBuilder::AppendFormatted(const StringView& format, const TypedFormat::Argument* pArguments,
+                                    uint32 argumentCount)
+{
+  StackString<1024> buffer;
+  TypedFormat::AppendFormatted(buffer, format, pArguments, argumentCount);
+  AppendString(buffer);
+}
+
+void StringBuilder::Clear()
+{
+  for (Chunk* pChunk = m_pFirstChunk; pChunk != NULL; pChunk = pChunk->pNext)
+    pChunk->Used = 0;
+
+  m_pCurrentChunk = m_pFirstChunk;
+  m_length = 0;
+}
+
+void StringBuilder::CopyTo(String& destination) const
+{
+  Assert(m_length < 0xFFFFFFFF);
+  destination.Clear();
+  destination.Reserve(uint32(m_length));
+  for (const Chunk* pChunk = m_pFirstChunk; pChunk != NULL && pChunk->Used > 0; pChunk = pChunk->pNext)
+    destination.AppendString(GetChunkData(pChunk), pChunk->Used);
+}
+
+bool StringBuilder::WriteToStream(ByteStream* pStream) const
+{
+  for (const Chunk* pChunk = m_pFirstChunk; pChunk != NULL && pChunk->Used > 0; pChunk = pChunk->pNext)
+  {
+    if (!pStream->Write2(GetChunkData(pChunk), pChunk->Used))
+      return false;
+  }
+
+  return true;
+}
+
+uint32 StringBuilder::GetBuffers(uint32 firstChunk, const void** ppBuffers, size_t* pBufferLengths,
+                                 uint32 maxBuffers) const
+{
+  const Chunk* pChunk = m_pFirstChunk;
+  for (uint32 i = 0; i < firstChunk && pChunk != NULL; i++)
+    pChunk = pChunk->pNext;
+
+  uint32 count = 0;
+  for (; count < maxBuffers && pChunk != NULL && pChunk->Used > 0; pChunk = pChunk->pNext, count++)
+  {
+    ppBuffers[count] = GetChunkData(pChunk);
+    pBufferLengths[count] = pChunk->Used;
+  }
+
+  return count;
+}
@@ -1,74 +1,322 @@
 #include "YBaseLib/StringConverter.h"
 #include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CPUID.h"
 #include "YBaseLib/CString.h"
+#include "YBaseLib/NumberConversion.h"
 
-bool StringConverter::StringToBool(const char* Source)
+// numbers are parsed straight out of the view by NumberConversion. Y_strtobool needs a terminator, so for it the
+// view is copied to the stack, anything longer than the buffer is cut off.
+static const uint32 BoolBufferSize = 16;
+
+static const char* TerminateBool(const StringView& Source, char (&buffer)[BoolBufferSize])
+{
+  uint32 length = Min(Source.GetLength(), BoolBufferSize - 1);
+  std::memcpy(buffer, Source.GetData(), length);
+  buffer[length] = '\0';
+  return buffer;
+}
+
+// Hex runs sixteen bytes, thirty-two characters, at a time with SSSE3 or NEON. The vector versions do whole blocks
+// only, and stop at a block with anything that isn't a hex digit, leaving the rest to the scalar loops in CString.
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <immintrin.h>
+#define Y_HEX_SSSE3 1
+#if defined(Y_COMPILER_MSVC)
+#define HEX_SSSE3_FUNCTION
+#else
+#define HEX_SSSE3_FUNCTION __attribute__((target("ssse3")))
+#endif
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_HEX_NEON 1
+#endif
+
+static const char s_hexDigits[17] = "0123456789abcdef";
+
+#if defined(Y_HEX_SSSE3)
+
+static HEX_SSSE3_FUNCTION uint32 EncodeHexSSSE3(char* pDestination, const byte* pSource, uint32 blockCount)
+{
+  const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s_hexDigits));
+  const __m128i mask = _mm_set1_epi8(0x0F);
+  for (uint32 i = 0; i < blockCount; i++, pSource += 16, pDestination += 32)
+  {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource));
+    __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+    __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination), _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + 16), _mm_unpackhi_epi8(high, low));
+  }
+
+  return blockCount;
+}
+
+// digits become 0-9, letters of either case 10-15, and anything else clears its lane of the valid mask
+static HEX_SSSE3_FUNCTION __m128i DecodeHexDigitsSSSE3(__m128i characters, __m128i* pValid)
+{
+  __m128i digit = _mm_sub_epi8(characters, _mm_set1_epi8('0'));
+  __m128i letter = _mm_sub_epi8(_mm_or_si128(characters, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+  __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+  __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+  *pValid = _mm_and_si128(*pValid, _mm_or_si128(isDigit, isLetter));
+  return _mm_or_si128(_mm_and_si128(isDigit, digit),
+                      _mm_and_si128(isLetter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+static HEX_SSSE3_FUNCTION uint32 DecodeHexSSSE3(byte* pDestination, const char* pSource, uint32 blockCount)
+{
+  // each pair of digits multiplied by 16 and 1 and summed, the high digit coming first
+  const __m128i weights = _mm_set1_epi16(0x0110);
+  uint32 i = 0;
+  for (; i < blockCount; i++, pSource += 32, pDestination += 16)
+  {
+    __m128i valid = _mm_set1_epi8(-1);
+    __m128i first = DecodeHexDigitsSSSE3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource)), &valid);
+    __m128i second = DecodeHexDigitsSSSE3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + 16)), &valid);
+    if (_mm_movemask_epi8(valid) != 0xFFFF)
+      break;
+
+    __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(first, weights), _mm_maddubs_epi16(second, weights));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination), bytes);
+  }
+
+  return i;
+}
+
+#elif defined(Y_HEX_NEON)
+
+static uint32 EncodeHexNEON(char* pDestination, const byte* pSource, uint32 blockCount)
+{
+  const uint8x16_t digits = vld1q_u8(reinterpret_cast<const uint8*>(s_hexDigits));
+  const uint8x16_t mask = vdupq_n_u8(0x0F);
+  for (uint32 i = 0; i < blockCount; i++, pSource += 16, pDestination += 32)
+  {
+    uint8x16_t bytes = vld1q_u8(pSource);
+    uint8x16x2_t characters;
+    characters.val[0] = vqtbl1q_u8(digits, vshrq_n_u8(bytes, 4));
+    characters.val[1] = vqtbl1q_u8(digits, vandq_u8(bytes, mask));
+    vst2q_u8(reinterpret_cast<uint8*>(pDestination), characters);
+  }
+
+  return blockCount;
+}
+
+static uint8x16_t DecodeHexDigitsNEON(uint8x16_t characters, uint8x16_t* pValid)
 {
-  return Y_strtobool(Source);
+  uint8x16_t digit = vsubq_u8(characters, vdupq_n_u8('0'));
+  uint8x16_t letter = vsubq_u8(vorrq_u8(characters, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+  uint8x16_t isDigit = vcleq_u8(digit, vdupq_n_u8(9));
+  uint8x16_t isLetter = vcleq_u8(letter, vdupq_n_u8(5));
+  *pValid = vandq_u8(*pValid, vorrq_u8(isDigit, isLetter));
+  return vbslq_u8(isDigit, digit, vaddq_u8(letter, vdupq_n_u8(10)));
 }
 
-byte StringConverter::StringToByte(const char* Source)
+// the loads split the high and low digits of each byte apart
+static uint32 DecodeHexNEON(byte* pDestination, const char* pSource, uint32 blockCount)
 {
-  return Y_strtobyte(Source);
+  uint32 i = 0;
+  for (; i < blockCount; i++, pSource += 32, pDestination += 16)
+  {
+    uint8x16x2_t characters = vld2q_u8(reinterpret_cast<const uint8*>(pSource));
+    uint8x16_t valid = vdupq_n_u8(0xFF);
+    uint8x16_t high = DecodeHexDigitsNEON(characters.val[0], &valid);
+    uint8x16_t low = DecodeHexDigitsNEON(characters.val[1], &valid);
+    if (vminvq_u8(valid) != 0xFF)
+      break;
+
+    vst1q_u8(pDestination, vorrq_u8(vshlq_n_u8(high, 4), low));
+  }
+
+  return i;
 }
 
-int8 StringConverter::StringToInt8(const char* Source)
+#endif
+
+static uint32 EncodeHexNone(char* pDestination, const byte* pSource, uint32 blockCount)
 {
-  return Y_strtoint8(Source);
+  return 0;
 }
 
-int16 StringConverter::StringToInt16(const char* Source)
+static uint32 DecodeHexNone(byte* pDestination, const char* pSource, uint32 blockCount)
 {
-  return Y_strtoint16(Source);
+  return 0;
 }
 
-int32 StringConverter::StringToInt32(const char* Source)
+static decltype(&EncodeHexNone) SelectEncodeHex()
 {
-  return Y_strtoint32(Source);
+#if defined(Y_HEX_SSSE3)
+  if (Y_CPUHasFeatures(Y_CPU_FEATURE_SSSE3))
+    return EncodeHexSSSE3;
+#elif defined(Y_HEX_NEON)
+  return EncodeHexNEON;
+#endif
+
+  return EncodeHexNone;
 }
 
-int64 StringConverter::StringToInt64(const char* Source)
+static decltype(&DecodeHexNone) SelectDecodeHex()
 {
-  return Y_strtoint64(Source);
+#if defined(Y_HEX_SSSE3)
+  if (Y_CPUHasFeatures(Y_CPU_FEATURE_SSSE3))
+    return DecodeHexSSSE3;
+#elif defined(Y_HEX_NEON)
+  return DecodeHexNEON;
+#endif
+
+  return DecodeHexNone;
 }
 
-uint8 StringConverter::StringToUInt8(const char* Source)
+Y_CPU_DISPATCH(s_pEncodeHexVector, EncodeHexNone, SelectEncodeHex);
+Y_CPU_DISPATCH(s_pDecodeHexVector, DecodeHexNone, SelectDecodeHex);
+
+// Formats values into one buffer sized for the longest of each, then cuts it down to what was written.
+template<typename T>
+static void FormatArray(String& Destination, const T* pValues, uint32 count, const char* separator,
+                        uint32 maxValueLength, uint32 (*formatFunction)(char*, T))
 {
-  return Y_strtouint8(Source);
+  uint32 separatorLength = Y_strlen(separator);
+  Destination.Resize(count * (maxValueLength + separatorLength));
+
+  char* pBuffer = Destination.GetWriteableCharArray();
+  uint32 length = 0;
+  for (uint32 i = 0; i < count; i++)
+  {
+    if (i > 0)
+    {
+      std::memcpy(pBuffer + length, separator, separatorLength);
+      length += separatorLength;
+    }
+
+    length += formatFunction(pBuffer + length, pValues[i]);
+  }
+
+  Destination.Resize(length);
+}
+
+// Fields are split on commas and whitespace, with runs of them counting as one, as StringParser's arrays do.
+static bool IsArraySeparator(char ch)
+{
+  return (ch == ',' || ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n');
+}
+
+template<typename T>
+static uint32 ParseArray(T* pDestination, uint32 maxCount, const StringView& Source,
+                         uint32 (*parseFunction)(const StringView&, T*))
+{
+  const char* pText = Source.GetData();
+  uint32 textLength = Source.GetLength();
+  uint32 position = 0;
+  uint32 count = 0;
+  while (count < maxCount)
+  {
+    while (position < textLength && IsArraySeparator(pText[position]))
+      position++;
+    if (position == textLength)
+      break;
+
+    T value;
+    uint32 fieldLength = parseFunction(StringView(pText + position, textLength - position), &value);
+    position += fieldLength;
+    if (fieldLength == 0 || (position < textLength && !IsArraySeparator(pText[position])))
+      break;
+
+    pDestination[count++] = value;
+  }
+
+  return count;
 }
 
-uint16 StringConverter::StringToUInt16(const char* Source)
+bool StringConverter::StringToBool(const StringView& Source)
 {
-  return Y_strtouint16(Source);
+  char buffer[BoolBufferSize];
+  return Y_strtobool(TerminateBool(Source, buffer));
 }
 
-uint32 StringConverter::StringToUInt32(const char* Source)
+byte StringConverter::StringToByte(const StringView& Source)
 {
-  return Y_strtouint32(Source);
+  uint32 value;
+  NumberConversion::ParseUInt32(Source, &value);
+  return (byte)value;
 }
 
-uint64 StringConverter::StringToUInt64(const char* Source)
+int8 StringConverter::StringToInt8(const StringView& Source)
 {
-  return Y_strtouint64(Source);
+  int32 value;
+  NumberConversion::ParseInt32(Source, &value);
+  return (int8)value;
 }
 
-float StringConverter::StringToFloat(const char* Source)
+int16 StringConverter::StringToInt16(const StringView& Source)
 {
-  return Y_strtofloat(Source);
+  int32 value;
+  NumberConversion::ParseInt32(Source, &value);
+  return (int16)value;
 }
 
-double StringConverter::StringToDouble(const char* Source)
+int32 StringConverter::StringToInt32(const StringView& Source)
 {
-  return Y_strtodouble(Source);
+  int32 value;
+  NumberConversion::ParseInt32(Source, &value);
+  return value;
 }
 
-uint32 StringConverter::StringToColor(const char* Source)
+int64 StringConverter::StringToInt64(const StringView& Source)
 {
-  if (Source[0] != '#')
+  int64 value;
+  NumberConversion::ParseInt64(Source, &value);
+  return value;
+}
+
+uint8 StringConverter::StringToUInt8(const StringView& Source)
+{
+  uint32 value;
+  NumberConversion::ParseUInt32(Source, &value);
+  return (uint8)value;
+}
+
+uint16 StringConverter::StringToUInt16(const StringView& Source)
+{
+  uint32 value;
+  NumberConversion::ParseUInt32(Source, &value);
+  return (uint16)value;
+}
+
+uint32 StringConverter::StringToUInt32(const StringView& Source)
+{
+  uint32 value;
+  NumberConversion::ParseUInt32(Source, &value);
+  return value;
+}
+
+uint64 StringConverter::StringToUInt64(const StringView& Source)
+{
+  uint64 value;
+  NumberConversion::ParseUInt64(Source, &value);
+  return value;
+}
+
+float StringConverter::StringToFloat(const StringView& Source)
+{
+  float value;
+  NumberConversion::ParseFloat(Source, &value);
+  return value;
+}
+
+double StringConverter::StringToDouble(const StringView& Source)
+{
+  double value;
+  NumberConversion::ParseDouble(Source, &value);
+  return value;
+}
+
+uint32 StringConverter::StringToColor(const StringView& Source)
+{
+  if (Source.IsEmpty() || Source[0] != '#')
     return 0;
 
   byte sourceBytes[4];
-  uint32 nComponents = Y_parsehexstring(Source + 1, sourceBytes, countof(sourceBytes), true);
+  uint32 nComponents =
+    Y_parsehexstring(Source.GetData() + 1, Source.GetLength() - 1, sourceBytes, countof(sourceBytes), true);
   uint32 outColor = 0;
   switch (nComponents)
   {
@@ -98,9 +346,22 @@ uint32 StringConverter::StringToColor(const char* Source)
   return outColor;
 }
 
-uint32 StringConverter::HexStringToBytes(void* pDestination, uint32 cbDestination, const char* Source)
+uint32 StringConverter::HexStringToBytes(void* pDestination, uint32 cbDestination, const StringView& Source)
+{
+  uint32 blockCount = Min(Source.GetLength() / 32, cbDestination / 16);
+  uint32 done = s_pDecodeHexVector(static_cast<byte*>(pDestination), Source.GetData(), blockCount) * 16;
+  return done + Y_parsehexstring(Source.GetData() + done * 2, Source.GetLength() - done * 2,
+                                 static_cast<byte*>(pDestination) + done, cbDestination - done, true, NULL);
+}
+
+uint32 StringConverter::StringToInt32Array(int32* pDestination, uint32 maxCount, const StringView& Source)
 {
-  return Y_parsehexstring(Source, pDestination, cbDestination, true, NULL);
+  return ParseArray(pDestination, maxCount, Source, &NumberConversion::ParseInt32);
+}
+
+uint32 StringConverter::StringToFloatArray(float* pDestination, uint32 maxCount, const StringView& Source)
+{
+  return ParseArray(pDestination, maxCount, Source, &NumberConversion::ParseFloat);
 }
 
 void StringConverter::StringToStream(ByteStream* pStream, const String& Source)
@@ -115,6 +376,12 @@ void StringConverter::StringToStream(ByteStream* pStream, const char* Source, ui
     pStream->Write2(Source, Length);
 }
 
+void StringConverter::StringToStream(ByteStream* pStream, const StringView& Source)
+{
+  if (Source.GetLength() > 0)
+    pStream->Write2(Source.GetData(), Source.GetLength());
+}
+
 void StringConverter::BoolToString(String& Destination, const bool Value)
 {
   char str[64];
@@ -124,72 +391,62 @@ void StringConverter::BoolToString(String& Destination, const bool Value)
 
 void StringConverter::Int8ToString(String& Destination, const int8 Value)
 {
-  char str[64];
-  Y_strfromint8(str, countof(str), Value);
-  Destination = str;
+  char str[NumberConversion::MaxIntegerLength];
+  Destination.Assign(StringView(str, NumberConversion::FormatInt32(str, (int32)Value)));
 }
 
 void StringConverter::Int16ToString(String& Destination, const int16 Value)
 {
-  char str[64];
-  Y_strfromint16(str, countof(str), Value);
-  Destination = str;
+  char str[NumberConversion::MaxIntegerLength];
+  Destination.Assign(StringView(str, NumberConversion::FormatInt32(str, (int32)Value)));
 }
 
 void StringConverter::Int32ToString(String& Destination, const int32 Value)
 {
-  char str[64];
-  Y_strfromint32(str, countof(str), Value);
-  Destination = str;
+  char str[NumberConversion::MaxIntegerLength];
+  Destination.Assign(StringView(str, NumberConversion::FormatInt32(str, Value)));
 }
 
 void StringConverter::Int64ToString(String& Destination, const int64 Value)
 {
-  char str[64];
-  Y_strfromint64(str, countof(str), Value);
-  Destination = str;
+  char str[NumberConversion::MaxIntegerLength];
+  Destination.Assign(StringView(str, NumberConversion::FormatInt64(str, Value)));
 }
 
 void StringConverter::UInt8ToString(String& Destination, const uint8 Value)
 {
-  char str[64];
-  Y_strfromuint8(str, countof(str), Value);
-  Destination = str;
+  char str[NumberConversion::MaxIntegerLength];
+  Destination.Assign(StringView(str, NumberConversion::FormatUInt32(str, (uint32)Value)));
 }
 
 void StringConverter::UInt16ToString(String& Destination, const uint16 Value)
 {
-  char str[64];
-  Y_strfromuint16(str, countof(str), Value);
-  Destination = str;
+  char str[NumberConversion::MaxIntegerLength];
+  Destination.Assign(StringView(str, NumberConversion::FormatUInt32(str, (uint32)Value)));
 }
 
 void StringConverter::UInt32ToString(String& Destination, const uint32 Value)
 {
-  char str[64];
-  Y_strfromuint32(str, countof(str), Value);
-  Destination = str;
+  char str[NumberConversion::MaxIntegerLength];
+  Destination.Assign(StringView(str, NumberConversion::FormatUInt32(str, Value)));
 }
 
 void StringConverter::UInt64ToString(String& Destination, const uint64 Value)
 {
-  char str[64];
-  Y_strfromuint64(str, countof(str), Value);
-  Destination = str;
+  char str[NumberConversion::MaxIntegerLength];
+  Destination.Assign(StringView(str, NumberConversion::FormatUInt64(str, Value)));
 }
 
 void StringConverter::FloatToString(String& Destination, const float Value)
 {
-  char str[64];
-  Y_strfromfloat(str, countof(str), Value);
-  Destination = str;
+  char str[NumberConversion::MaxFloatLength];
+  Destination.Assign(StringView(str, NumberConversion::FormatFloat(str, Value)));
 }
 
 void StringConverter::DoubleToString(String& Destination, const double Value)
 {
-  char str[64];
-  Y_strfromdouble(str, countof(str), Value);
-  Destination = str;
+  char str[NumberConversion::MaxFloatLength];
+  Destination.Assign(StringView(str, NumberConversion::FormatDouble(str, Value)));
 }
 
 void StringConverter::ColorToString(String& Destination, const uint32 Value)
@@ -207,7 +464,23 @@ void StringConverter::ColorToString(String& Destination, const uint32 Value)
 void StringConverter::BytesToHexString(String& Destination, const void* pData, uint32 cbData)
 {
   Destination.Resize(cbData * 2);
-  Y_makehexstring(pData, cbData, Destination.GetWriteableCharArray(), cbData * 2 + 1);
+  char* pBuffer = Destination.GetWriteableCharArray();
+  uint32 done = s_pEncodeHexVector(pBuffer, static_cast<const byte*>(pData), cbData / 16) * 16;
+  Y_makehexstring(static_cast<const byte*>(pData) + done, cbData - done, pBuffer + done * 2, (cbData - done) * 2 + 1);
+}
+
+void StringConverter::Int32ArrayToString(String& Destination, const int32* pValues, uint32 count,
+                                         const char* separator)
+{
+  FormatArray(Destination, pValues, count, separator, NumberConversion::MaxIntegerLength,
+              &NumberConversion::FormatInt32);
+}
+
+void StringConverter::FloatArrayToString(String& Destination, const float* pValues, uint32 count,
+                                         const char* separator)
+{
+  FormatArray(Destination, pValues, count, separator, NumberConversion::MaxFloatLength,
+              &NumberConversion::FormatFloat);
 }
 
 bool StringConverter::StreamToString(String& Destination, ByteStream* pStream)
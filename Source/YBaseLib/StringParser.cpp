@@ -1,6 +1,7 @@
 #include "YBaseLib/StringParser.h"
 #include "YBaseLib/CString.h"
 #include "YBaseLib/String.h"
+#include <cstring>
 
 // should only be sizeof(ptr), so it can be used as an array
 YStaticCheckSizeOf(StringParser, sizeof(const char*));
@@ -63,3 +64,113 @@ uint64 StringParser::ParseUInt64() const
 {
   return (m_szValue != NULL) ? Y_strtouint64(m_szValue, NULL) : 0;
 }
+
+StringTokenizer::StringTokenizer(const StringView& text, const char* delimiters /* = "," */, uint32 flags /* = 0 */)
+  : m_pPosition(text.GetData()), m_pEnd(text.GetEnd()), m_flags(flags), m_atEnd(text.IsEmpty()),
+    m_lastWasQuoted(false)
+{
+  std::memset(m_delimiterMask, 0, sizeof(m_delimiterMask));
+  for (const char* pDelimiter = delimiters; *pDelimiter != '\0'; pDelimiter++)
+    m_delimiterMask[byte(*pDelimiter) >> 5] |= uint32(1) << (byte(*pDelimiter) & 31);
+}
+
+bool StringTokenizer::IsTrimmable(char ch) const
+{
+  return (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') && !IsDelimiter(ch);
+}
+
+StringView StringTokenizer::ReadField()
+{
+  const char* pStart = m_pPosition;
+  if (m_flags & FLAG_TRIM_WHITESPACE)
+  {
+    while (pStart != m_pEnd && IsTrimmable(*pStart))
+      pStart++;
+  }
+
+  const char* pFieldStart = pStart;
+  const char* pFieldEnd;
+  const char* pAt;
+  m_lastWasQuoted = ((m_flags & FLAG_QUOTED_FIELDS) && pStart != m_pEnd && *pStart == '"');
+  if (m_lastWasQuoted)
+  {
+    // a doubled quote is part of the field, an unterminated one runs to the end
+    pFieldStart = pStart + 1;
+    for (pAt = pFieldStart; pAt != m_pEnd; pAt++)
+    {
+      if (*pAt == '"')
+      {
+        if ((pAt + 1) == m_pEnd || pAt[1] != '"')
+          break;
+        pAt++;
+      }
+    }
+
+    pFieldEnd = pAt;
+    if (pAt != m_pEnd)
+      pAt++;
+    while (pAt != m_pEnd && !IsDelimiter(*pAt))
+      pAt++;
+  }
+  else
+  {
+    for (pAt = pStart; pAt != m_pEnd && !IsDelimiter(*pAt); pAt++)
+      ;
+
+    pFieldEnd = pAt;
+    if (m_flags & FLAG_TRIM_WHITESPACE)
+    {
+      while (pFieldEnd != pFieldStart && IsTrimmable(pFieldEnd[-1]))
+        pFieldEnd--;
+    }
+  }
+
+  // there is always one more field after a delimiter, even if it's empty
+  if (pAt == m_pEnd)
+  {
+    m_atEnd = true;
+    m_pPosition = m_pEnd;
+  }
+  else
+  {
+    m_pPosition = pAt + 1;
+  }
+
+  return StringView(pFieldStart, pFieldEnd);
+}
+
+bool StringTokenizer::Next(StringView* pToken)
+{
+  while (!m_atEnd)
+  {
+    *pToken = ReadField();
+    if (!pToken->IsEmpty() || m_lastWasQuoted || !(m_flags & FLAG_SKIP_EMPTY))
+      return true;
+  }
+
+  return false;
+}
+
+void StringTokenizer::UnescapeQuotes(const StringView& field, String& destination)
+{
+  destination.Clear();
+  destination.Reserve(field.GetLength());
+
+  const char* pAt = field.GetData();
+  const char* pEnd = field.GetEnd();
+  while (pAt != pEnd)
+  {
+    const char* pQuote = Y_strnchr(pAt, uint32(pEnd - pAt), '"');
+    if (pQuote == NULL)
+    {
+      destination.AppendString(pAt, uint32(pEnd - pAt));
+      break;
+    }
+
+    // keep the first of each pair
+    destination.AppendString(pAt, uint32(pQuote - pAt) + 1);
+    pAt = pQuote + 1;
+    if (pAt != pEnd && *pAt == '"')
+      pAt++;
+  }
+}
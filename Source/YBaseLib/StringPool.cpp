@@ -0,0 +1,210 @@
+#include "YBaseLib/StringPool.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Memory.h"
+
+StringPool::StringPool()
+  : m_count(0), m_pIndex(nullptr), m_indexSize(0), m_pArenaPosition(nullptr), m_arenaRemaining(0), m_arenaBytes(0)
+{
+  m_emptyEntry.String = "";
+  m_emptyEntry.Length = 0;
+  m_emptyEntry.Hash = Y_HashBytes("", 0);
+  Y_memzero(m_pChunks, sizeof(m_pChunks));
+}
+
+StringPool::~StringPool()
+{
+  for (uint32 i = 0; i < ChunkCount; i++)
+    std::free(m_pChunks[i]);
+
+  for (uint32 i = 0; i < m_arenaBlocks.GetSize(); i++)
+    std::free(m_arenaBlocks[i]);
+
+  Y_free(m_pIndex);
+}
+
+StringPool& StringPool::GetGlobalPool()
+{
+  static StringPool globalPool;
+  return globalPool;
+}
+
+const StringPool::Entry& StringPool::GetEntry(uint32 id) const
+{
+  if (id == 0)
+    return m_emptyEntry;
+
+  DebugAssert(id <= m_count);
+  uint32 position = id - 1 + (1u << FirstChunkBits);
+  uint32 topBit;
+  Y_bitscanreverse(position, &topBit);
+
+  uint32 chunkIndex = topBit - FirstChunkBits;
+  return m_pChunks[chunkIndex][position - (1u << topBit)];
+}
+
+StringPool::Entry& StringPool::AllocateEntry(uint32 id)
+{
+  uint32 position = id - 1 + (1u << FirstChunkBits);
+  uint32 topBit;
+  Y_bitscanreverse(position, &topBit);
+
+  uint32 chunkIndex = topBit - FirstChunkBits;
+  if (m_pChunks[chunkIndex] == nullptr)
+    m_pChunks[chunkIndex] = (Entry*)std::malloc(sizeof(Entry) << topBit);
+
+  return m_pChunks[chunkIndex][position - (1u << topBit)];
+}
+
+const char* StringPool::StoreString(const char* str, uint32 length)
+{
+  uint32 size = length + 1;
+  char* pStorage;
+  if (size > ArenaBlockSize / 4)
+  {
+    // long strings get their own block, so they don't waste the rest of the current one
+    pStorage = (char*)std::malloc(size);
+    m_arenaBlocks.Add(pStorage);
+    m_arenaBytes += size;
+  }
+  else
+  {
+    if (size > m_arenaRemaining)
+    {
+      m_pArenaPosition = (char*)std::malloc(ArenaBlockSize);
+      m_arenaRemaining = ArenaBlockSize;
+      m_arenaBlocks.Add(m_pArenaPosition);
+      m_arenaBytes += ArenaBlockSize;
+    }
+
+    pStorage = m_pArenaPosition;
+    m_pArenaPosition += size;
+    m_arenaRemaining -= size;
+  }
+
+  std::memcpy(pStorage, str, length);
+  pStorage[length] = '\0';
+  return pStorage;
+}
+
+uint32 StringPool::FindLocked(const char* str, uint32 length, HashType hash) const
+{
+  if (m_indexSize == 0)
+    return 0;
+
+  uint32 mask = m_indexSize - 1;
+  for (uint32 slot = hash & mask;; slot = (slot + 1) & mask)
+  {
+    uint32 id = m_pIndex[slot];
+    if (id == 0)
+      return 0;
+
+    const Entry& entry = GetEntry(id);
+    if (entry.Hash == hash && entry.Length == length && std::memcmp(entry.String, str, length) == 0)
+      return id;
+  }
+}
+
+void StringPool::InsertIndex(uint32 id, HashType hash)
+{
+  uint32 mask = m_indexSize - 1;
+  uint32 slot = hash & mask;
+  while (m_pIndex[slot] != 0)
+    slot = (slot + 1) & mask;
+
+  m_pIndex[slot] = id;
+}
+
+void StringPool::GrowIndex()
+{
+  uint32* pOldIndex = m_pIndex;
+  uint32 oldIndexSize = m_indexSize;
+
+  m_indexSize = (oldIndexSize > 0) ? (oldIndexSize * 2) : 1024;
+  m_pIndex = (uint32*)Y_malloczero(sizeof(uint32) * m_indexSize);
+  for (uint32 i = 0; i < oldIndexSize; i++)
+  {
+    if (pOldIndex[i] != 0)
+      InsertIndex(pOldIndex[i], GetEntry(pOldIndex[i]).Hash);
+  }
+
+  Y_free(pOldIndex);
+}
+
+uint32 StringPool::Intern(const char* str, uint32 length)
+{
+  if (length == 0)
+    return 0;
+
+  // most strings have been seen before, so try with the lock shared first
+  HashType hash = Y_HashBytes(str, length);
+  m_lock.LockShared();
+  uint32 id = FindLocked(str, length, hash);
+  m_lock.UnlockShared();
+  if (id != 0)
+    return id;
+
+  m_lock.LockExclusive();
+
+  // someone else may have added it in the meantime
+  id = FindLocked(str, length, hash);
+  if (id == 0)
+  {
+    // keep the index at most half full so probes stay short
+    if ((m_count + 1) * 2 > m_indexSize)
+      GrowIndex();
+
+    id = m_count + 1;
+    AssertMsg(id != 0, "String pool is full");
+
+    Entry& entry = AllocateEntry(id);
+    entry.String = StoreString(str, length);
+    entry.Length = length;
+    entry.Hash = hash;
+    InsertIndex(id, hash);
+
+    // the entry has to be visible before anyone can get hold of the id
+    MemoryBarrier();
+    m_count = id;
+  }
+
+  m_lock.UnlockExclusive();
+  return id;
+}
+
+uint32 StringPool::Intern(const char* str)
+{
+  return Intern(str, Y_strlen(str));
+}
+
+uint32 StringPool::Find(const char* str, uint32 length) const
+{
+  if (length == 0)
+    return 0;
+
+  HashType hash = Y_HashBytes(str, length);
+  m_lock.LockShared();
+  uint32 id = FindLocked(str, length, hash);
+  m_lock.UnlockShared();
+  return id;
+}
+
+uint32 StringPool::Find(const char* str) const
+{
+  return Find(str, Y_strlen(str));
+}
+
+size_t StringPool::GetMemoryUsage() const
+{
+  m_lock.LockShared();
+
+  size_t size = m_arenaBytes + sizeof(uint32) * m_indexSize + m_arenaBlocks.GetReserve() * sizeof(char*);
+  for (uint32 i = 0; i < ChunkCount; i++)
+  {
+    if (m_pChunks[i] != nullptr)
+      size += sizeof(Entry) << (i + FirstChunkBits);
+  }
+
+  m_lock.UnlockShared();
+  return size;
+}
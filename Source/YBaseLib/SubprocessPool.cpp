@@ -0,0 +1,393 @@
+#include "YBaseLib/Common.h"
+
+#if defined(Y_PLATFORM_WINDOWS) || defined(Y_PLATFORM_POSIX)
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/MutexLock.h"
+#include "YBaseLib/SubprocessPool.h"
+#include "YBaseLib/TaskQueue.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(SubprocessPool);
+
+// precedes every request and response on the channel
+struct SubprocessPoolMessageHeader
+{
+  uint32 RequestID;
+  uint32 Size;
+};
+
+static bool ReadExactly(Subprocess::Connection* pConnection, void* pBuffer, uint32 byteCount)
+{
+  uint32 offset = 0;
+  while (offset < byteCount)
+  {
+    uint32 count = pConnection->ReadDataBlocking(reinterpret_cast<byte*>(pBuffer) + offset, byteCount - offset);
+    if (count == 0)
+      return false;
+
+    offset += count;
+  }
+
+  return true;
+}
+
+static bool WriteExactly(Subprocess::Connection* pConnection, const void* pBuffer, uint32 byteCount)
+{
+  uint32 offset = 0;
+  while (offset < byteCount)
+  {
+    uint32 count = pConnection->WriteData(reinterpret_cast<const byte*>(pBuffer) + offset, byteCount - offset);
+    if (count == 0)
+      return false;
+
+    offset += count;
+  }
+
+  return true;
+}
+
+static bool WriteMessage(Subprocess::Connection* pConnection, uint32 requestID, const void* pData, uint32 size)
+{
+  SubprocessPoolMessageHeader header = {requestID, size};
+  return (WriteExactly(pConnection, &header, sizeof(header)) && WriteExactly(pConnection, pData, size));
+}
+
+class SubprocessPool::ReaderThread : public Thread
+{
+public:
+  ReaderThread(Worker* pWorker) : m_pWorker(pWorker) {}
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    m_pWorker->pPool->RunReaderThread(m_pWorker);
+    return 0;
+  }
+
+private:
+  Worker* m_pWorker;
+};
+
+SubprocessPool::SubprocessPool(const char* executableFileName, const char* parameters, uint32 workerCount,
+                               TaskQueue* pContinuationQueue /* = nullptr */)
+  : m_executableFileName(executableFileName), m_parameters((parameters != nullptr) ? parameters : ""),
+    m_pContinuationQueue(pContinuationQueue), m_nextRequestID(1), m_restartCount(0), m_started(false),
+    m_shutdown(false)
+{
+  DebugAssert(workerCount > 0);
+  m_workers.Resize(workerCount);
+  for (uint32 i = 0; i < workerCount; i++)
+  {
+    Worker* pWorker = new Worker();
+    pWorker->pPool = this;
+    pWorker->pThread = new ReaderThread(pWorker);
+    pWorker->pProcess = nullptr;
+    pWorker->pConnection = nullptr;
+    pWorker->Generation = 0;
+    m_workers[i] = pWorker;
+  }
+}
+
+SubprocessPool::~SubprocessPool()
+{
+  Shutdown();
+
+  for (Worker* pWorker : m_workers)
+  {
+    DebugAssert(pWorker->pProcess == nullptr && pWorker->Pending.IsEmpty());
+    delete pWorker->pThread;
+    delete pWorker;
+  }
+}
+
+bool SubprocessPool::Start()
+{
+  DebugAssert(!m_started);
+  m_started = true;
+
+  // The processes start here rather than on the reader threads, so the caller learns about failures. They're all
+  // spawned before connecting to any, so they start up side by side.
+  PODArray<Subprocess*> processes;
+  processes.Resize(m_workers.GetSize());
+  uint32 createdCount = Subprocess::CreateMultiple(processes.GetBasePointer(), processes.GetSize(),
+                                                   m_executableFileName, m_parameters, true, false, true);
+  if (createdCount < processes.GetSize())
+    Log_ErrorPrintf("SubprocessPool: Failed to create worker process '%s'", m_executableFileName.GetCharArray());
+
+  bool result = (createdCount == processes.GetSize());
+  for (uint32 i = 0; i < createdCount; i++)
+    result &= ConnectWorker(m_workers[i], processes[i]);
+
+  for (Worker* pWorker : m_workers)
+    pWorker->pThread->Start();
+
+  return result;
+}
+
+void SubprocessPool::Shutdown()
+{
+  if (!m_started)
+    return;
+
+  // a worker restarting now sees the flag before it publishes its process, and stops it itself
+  m_lock.Lock();
+  m_shutdown = true;
+  for (Worker* pWorker : m_workers)
+  {
+    if (pWorker->pProcess != nullptr)
+      pWorker->pProcess->RequestChildToExit();
+  }
+  m_lock.Unlock();
+
+  // each reader thread sees its channel close, fails what was outstanding and exits
+  for (Worker* pWorker : m_workers)
+    pWorker->pThread->Join();
+
+  m_started = false;
+}
+
+uint32 SubprocessPool::GetLiveWorkerCount() const
+{
+  MutexLock lock(m_lock);
+  uint32 count = 0;
+  for (const Worker* pWorker : m_workers)
+  {
+    if (pWorker->pConnection != nullptr)
+      count++;
+  }
+
+  return count;
+}
+
+uint32 SubprocessPool::GetRestartCount() const
+{
+  MutexLock lock(m_lock);
+  return m_restartCount;
+}
+
+void SubprocessPool::SubmitRequest(const void* pRequest, uint32 requestSize, ResponseCallback callback)
+{
+  m_lock.Lock();
+
+  Worker* pWorker = nullptr;
+  if (!m_shutdown)
+  {
+    for (Worker* pCandidate : m_workers)
+    {
+      if (pCandidate->pConnection != nullptr &&
+          (pWorker == nullptr || pCandidate->Pending.GetSize() < pWorker->Pending.GetSize()))
+      {
+        pWorker = pCandidate;
+      }
+    }
+  }
+
+  if (pWorker == nullptr)
+  {
+    m_lock.Unlock();
+    CompleteRequest(std::move(callback), nullptr);
+    return;
+  }
+
+  uint32 requestID = m_nextRequestID++;
+  pWorker->Pending.Add(PendingRequest{requestID, std::move(callback)});
+  uint32 generation = pWorker->Generation;
+  m_lock.Unlock();
+
+  // If the worker was replaced in the meantime, the request has already been failed along with the rest of the old
+  // worker's. A failed write means the worker's gone, and the reader thread fails it once it notices.
+  MutexLock writeLock(pWorker->WriteLock);
+  if (pWorker->Generation == generation)
+    WriteMessage(pWorker->pConnection, requestID, pRequest, requestSize);
+}
+
+bool SubprocessPool::StartWorker(Worker* pWorker)
+{
+  // workers exit by themselves if this process goes away
+  Subprocess* pProcess = Subprocess::Create(m_executableFileName, m_parameters, true, false, true);
+  if (pProcess == nullptr)
+  {
+    Log_ErrorPrintf("SubprocessPool: Failed to create worker process '%s'", m_executableFileName.GetCharArray());
+    return false;
+  }
+
+  return ConnectWorker(pWorker, pProcess);
+}
+
+bool SubprocessPool::ConnectWorker(Worker* pWorker, Subprocess* pProcess)
+{
+  Subprocess::Connection* pConnection = pProcess->ConnectToChild();
+  if (pConnection == nullptr)
+  {
+    Log_ErrorPrintf("SubprocessPool: Failed to connect to worker process '%s'", m_executableFileName.GetCharArray());
+    pProcess->TerminateChild();
+    delete pProcess;
+    return false;
+  }
+
+  MutexLock writeLock(pWorker->WriteLock);
+  MutexLock lock(m_lock);
+  if (m_shutdown)
+  {
+    lock.Unlock();
+    writeLock.Unlock();
+    pProcess->RequestChildToExit();
+    pProcess->WaitForChildToExit();
+    delete pProcess;
+    return false;
+  }
+
+  DebugAssert(pWorker->pProcess == nullptr);
+  pWorker->pProcess = pProcess;
+  pWorker->pConnection = pConnection;
+  return true;
+}
+
+void SubprocessPool::StopWorker(Worker* pWorker)
+{
+  Array<PendingRequest> failedRequests;
+  Subprocess* pProcess;
+  {
+    MutexLock writeLock(pWorker->WriteLock);
+    MutexLock lock(m_lock);
+    pProcess = pWorker->pProcess;
+    pWorker->pProcess = nullptr;
+    pWorker->pConnection = nullptr;
+    pWorker->Generation++;
+    failedRequests.Swap(pWorker->Pending);
+  }
+
+  // the channel may have broken with the process still running
+  if (pProcess->IsChildAlive())
+    pProcess->TerminateChild();
+  pProcess->WaitForChildToExit();
+  delete pProcess;
+
+  for (PendingRequest& request : failedRequests)
+    CompleteRequest(std::move(request.Callback), nullptr);
+}
+
+void SubprocessPool::RunReaderThread(Worker* pWorker)
+{
+  for (;;)
+  {
+    // only this thread replaces the connection, so it can be used without the lock
+    Subprocess::Connection* pConnection = pWorker->pConnection;
+    if (pConnection != nullptr)
+    {
+      SubprocessPoolMessageHeader header;
+      if (ReadExactly(pConnection, &header, sizeof(header)))
+      {
+        BinaryBlob* pResponse = BinaryBlob::Allocate(header.Size);
+        if (ReadExactly(pConnection, pResponse->GetDataPointer(), header.Size))
+        {
+          ResponseCallback callback;
+          m_lock.Lock();
+          if (!pWorker->Pending.IsEmpty() && pWorker->Pending[0].RequestID == header.RequestID)
+          {
+            callback = std::move(pWorker->Pending[0].Callback);
+            pWorker->Pending.OrderedRemove(0);
+          }
+          m_lock.Unlock();
+
+          if (callback)
+          {
+            CompleteRequest(std::move(callback), pResponse);
+            continue;
+          }
+
+          Log_ErrorPrintf("SubprocessPool: Unexpected response %u from worker, restarting it", header.RequestID);
+        }
+
+        pResponse->Release();
+      }
+
+      StopWorker(pWorker);
+    }
+
+    m_lock.Lock();
+    bool shutdown = m_shutdown;
+    m_lock.Unlock();
+    if (shutdown)
+      break;
+
+    if (StartWorker(pWorker))
+    {
+      MutexLock lock(m_lock);
+      m_restartCount++;
+      continue;
+    }
+
+    // sleep in slices, so shutdown isn't held up
+    for (uint32 i = 0; i < RestartRetryDelay; i += 10)
+    {
+      m_lock.Lock();
+      shutdown = m_shutdown;
+      m_lock.Unlock();
+      if (shutdown)
+        break;
+
+      Thread::Sleep(10);
+    }
+  }
+}
+
+void SubprocessPool::CompleteRequest(ResponseCallback callback, BinaryBlob* pResponse)
+{
+  if (m_pContinuationQueue == nullptr)
+  {
+    callback(pResponse);
+    if (pResponse != nullptr)
+      pResponse->Release();
+
+    return;
+  }
+
+  m_pContinuationQueue->QueueLambdaTask([callback = std::move(callback), pResponse]() {
+    callback(pResponse);
+    if (pResponse != nullptr)
+      pResponse->Release();
+  });
+}
+
+bool SubprocessPool::ServeRequests(RequestHandler handler, void* pUserData)
+{
+  Subprocess::Connection* pConnection = Subprocess::ConnectToParent();
+  if (pConnection == nullptr)
+  {
+    Log_ErrorPrintf("SubprocessPool: Failed to connect to parent");
+    return false;
+  }
+
+  PODArray<byte> request;
+  PODArray<byte> response;
+  for (;;)
+  {
+    // wake up now and then to check for an exit request
+    if (!pConnection->WaitForData(100))
+    {
+      if (pConnection->IsExitRequested() || !pConnection->IsOtherSideAlive())
+        break;
+
+      continue;
+    }
+
+    SubprocessPoolMessageHeader header;
+    if (!ReadExactly(pConnection, &header, sizeof(header)))
+      break;
+
+    request.Resize(header.Size);
+    if (!ReadExactly(pConnection, request.GetBasePointer(), header.Size))
+      break;
+
+    response.Clear();
+    handler(request.GetBasePointer(), header.Size, &response, pUserData);
+    if (!WriteMessage(pConnection, header.RequestID, response.GetBasePointer(), response.GetSize()))
+      break;
+  }
+
+  delete pConnection;
+  return true;
+}
+
+#endif // Y_PLATFORM_WINDOWS || Y_PLATFORM_POSIX
@@ -0,0 +1,78 @@
+#include "YBaseLib/Common.h"
+
+#if defined(Y_PLATFORM_WINDOWS) || defined(Y_PLATFORM_POSIX)
+#include "YBaseLib/Log.h"
+#include "YBaseLib/SubprocessRPCChannel.h"
+Log_SetChannel(SubprocessRPCChannel);
+
+SubprocessRPCChannel::SubprocessRPCChannel(Subprocess::Connection* pConnection,
+                                           uint32 maxBatchSize /*= RPCChannel::DefaultMaxBatchSize*/)
+  : m_pConnection(pConnection),
+    m_channel(
+      [this](const void* pData, size_t size) {
+        // the connection only writes less when the other side has gone
+        if (m_writeFailed || m_pConnection->WriteData(pData, (uint32)size) != (uint32)size)
+        {
+          m_writeFailed = true;
+          return false;
+        }
+
+        return true;
+      },
+      maxBatchSize),
+    m_writeFailed(false)
+{
+  m_receiveBuffer.Resize(maxBatchSize);
+}
+
+SubprocessRPCChannel::~SubprocessRPCChannel()
+{
+  Error error;
+  error.SetErrorUserStatic(0, "Subprocess connection closed.");
+  m_channel.Close(&error);
+}
+
+bool SubprocessRPCChannel::Poll(int32 timeout /*= 0*/)
+{
+  if (m_channel.IsClosed())
+    return false;
+
+  Error error;
+  if (!m_writeFailed && m_pConnection->WaitForData(timeout))
+  {
+    // everything that's here, batches arrive as one stream
+    for (;;)
+    {
+      uint32 bytesRead =
+        m_pConnection->ReadDataNonBlocking(m_receiveBuffer.GetBasePointer(), m_receiveBuffer.GetSize());
+      if (bytesRead == 0)
+        break;
+
+      if (!m_channel.ReceiveStream(m_receiveBuffer.GetBasePointer(), bytesRead))
+      {
+        Log_ErrorPrintf("SubprocessRPCChannel: Malformed data from the other side, closing");
+        error.SetErrorUserStatic(0, "Malformed RPC data.");
+        m_channel.Close(&error);
+        return false;
+      }
+    }
+  }
+
+  if (m_writeFailed || !m_pConnection->IsOtherSideAlive())
+  {
+    error.SetErrorUserStatic(0, "Subprocess connection lost.");
+    m_channel.Close(&error);
+    return false;
+  }
+
+  return true;
+}
+
+void SubprocessRPCChannel::Serve()
+{
+  // wake up now and then to check for an exit request
+  while (!m_pConnection->IsExitRequested() && Poll(100))
+    ;
+}
+
+#endif // Y_PLATFORM_WINDOWS || Y_PLATFORM_POSIX
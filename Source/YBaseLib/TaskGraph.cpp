@@ -0,0 +1,191 @@
+#include "YBaseLib/TaskGraph.h"
+#include "YBaseLib/Assert.h"
+
+// Marker stored in a finished task's successor list.
+#define SuccessorListClosed (reinterpret_cast<TaskGraph::Node::SuccessorLink*>(static_cast<uintptr_t>(1)))
+
+TaskGraph::Node::Node(TaskGraph* pGraph)
+  : m_pGraph(pGraph), m_pendingCount(1), m_pSuccessors(nullptr), m_finished(false), m_submitted(false)
+{
+}
+
+TaskGraph::Node::~Node()
+{
+  DebugAssert(m_pSuccessors == nullptr || m_pSuccessors == SuccessorListClosed);
+}
+
+int32 TaskGraph::Node::ProcessWork()
+{
+  m_pGraph->ExecuteTask(this);
+  return 0;
+}
+
+TaskGraph::TaskGraph(TaskQueue* pTaskQueue)
+  : m_pTaskQueue(pTaskQueue), m_pThreadPool(nullptr), m_outstandingTaskCount(0), m_waiterCount(0)
+{
+}
+
+TaskGraph::TaskGraph(ThreadPool* pThreadPool)
+  : m_pTaskQueue(nullptr), m_pThreadPool(pThreadPool), m_outstandingTaskCount(0), m_waiterCount(0)
+{
+}
+
+TaskGraph::~TaskGraph()
+{
+  WaitForAll();
+
+  // make sure the thread that finished the last task has released the lock
+  m_waitLock.Lock();
+  m_waitLock.Unlock();
+}
+
+void TaskGraph::AddDependency(Node* pTask, Node* pDependsOn)
+{
+  DebugAssert(pTask->m_pGraph == this && pDependsOn->m_pGraph == this);
+  AssertMsg(!pTask->m_submitted, "Dependencies must be added before the task is submitted");
+
+  // the link holds a reference to the dependent task until the predecessor finishes
+  Node::SuccessorLink* pLink = new Node::SuccessorLink;
+  pLink->pNode = pTask;
+  pTask->AddRef();
+  Y_AtomicIncrement(pTask->m_pendingCount);
+
+  for (;;)
+  {
+    Node::SuccessorLink* pHead = pDependsOn->m_pSuccessors;
+    if (pHead == SuccessorListClosed)
+    {
+      // already finished. pending can't reach zero here, the task still holds its submit reference.
+      Y_AtomicDecrement(pTask->m_pendingCount);
+      pTask->Release();
+      delete pLink;
+      return;
+    }
+
+    pLink->pNext = pHead;
+    if (Y_AtomicCompareExchangePointer(pDependsOn->m_pSuccessors, pLink, pHead) == pHead)
+      return;
+  }
+}
+
+void TaskGraph::Submit(Node* pTask)
+{
+  DebugAssert(pTask->m_pGraph == this);
+  AssertMsg(!pTask->m_submitted, "Task submitted twice");
+  pTask->m_submitted = true;
+
+  // drop the hold that prevented the task running before submission
+  Y_AtomicIncrement(m_outstandingTaskCount);
+  ReleaseDependency(pTask);
+}
+
+void TaskGraph::ReleaseDependency(Node* pTask)
+{
+  if (Y_AtomicDecrement(pTask->m_pendingCount) == 0)
+    ScheduleTask(pTask);
+}
+
+void TaskGraph::ScheduleTask(Node* pTask)
+{
+  if (m_pThreadPool != nullptr)
+  {
+    // the pool keeps its own reference while the item is queued
+    m_pThreadPool->EnqueueWorkItem(pTask);
+    return;
+  }
+
+  pTask->AddRef();
+  m_pTaskQueue->QueueLambdaTask([this, pTask]() {
+    ExecuteTask(pTask);
+    pTask->Release();
+  });
+}
+
+void TaskGraph::ExecuteTask(Node* pTask)
+{
+  pTask->Run();
+
+  // close the successor list, any dependency added from now on sees the task as finished
+  Node::SuccessorLink* pLink;
+  for (;;)
+  {
+    pLink = pTask->m_pSuccessors;
+    if (Y_AtomicCompareExchangePointer(pTask->m_pSuccessors, SuccessorListClosed, pLink) == pLink)
+      break;
+  }
+
+  pTask->m_finished = true;
+  MemoryBarrier();
+
+  // release dependents, the list is in reverse order of addition which doesn't matter
+  while (pLink != nullptr)
+  {
+    Node::SuccessorLink* pNext = pLink->pNext;
+    ReleaseDependency(pLink->pNode);
+    pLink->pNode->Release();
+    delete pLink;
+    pLink = pNext;
+  }
+
+  // the last task finishing, or any wake, happens under the lock. otherwise a waiter could see the count reach
+  // zero and destroy the graph while we're still using it.
+  for (;;)
+  {
+    uint32 count = m_outstandingTaskCount;
+    if (count == 1 || m_waiterCount > 0)
+      break;
+
+    if (Y_AtomicCompareExchange(m_outstandingTaskCount, count - 1, count) == count)
+      return;
+  }
+
+  m_waitLock.Lock();
+  Y_AtomicDecrement(m_outstandingTaskCount);
+  m_waitConditionVariable.WakeAll();
+  m_waitLock.Unlock();
+}
+
+bool TaskGraph::ShouldExecuteWhileWaiting() const
+{
+  // a task queue with no workers only makes progress when someone executes it
+  return (m_pTaskQueue != nullptr && m_pTaskQueue->GetWorkerThreadCount() == 0 &&
+          m_pTaskQueue->GetThreadPool() == nullptr);
+}
+
+template<class T>
+void TaskGraph::WaitUntil(const T& condition)
+{
+  if (condition())
+    return;
+
+  if (ShouldExecuteWhileWaiting())
+  {
+    while (!condition())
+    {
+      if (!m_pTaskQueue->ExecuteQueuedTasks())
+        Thread::Yield();
+    }
+
+    return;
+  }
+
+  // publish that we're waiting before testing again, completions test the waiter count after finishing
+  m_waitLock.Lock();
+  Y_AtomicIncrement(m_waiterCount);
+  MemoryBarrier();
+  while (!condition())
+    m_waitConditionVariable.SleepAndRelease(&m_waitLock);
+  Y_AtomicDecrement(m_waiterCount);
+  m_waitLock.Unlock();
+}
+
+void TaskGraph::WaitFor(Node* pTask)
+{
+  AssertMsg(pTask->m_submitted, "Waiting on a task that was never submitted");
+  WaitUntil([pTask]() { return pTask->m_finished; });
+}
+
+void TaskGraph::WaitForAll()
+{
+  WaitUntil([this]() { return (m_outstandingTaskCount == 0); });
+}
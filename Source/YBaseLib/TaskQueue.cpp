@@ -1,11 +1,44 @@
 #include "YBaseLib/TaskQueue.h"
+#include "YBaseLib/Futex.h"
+#include "YBaseLib/Log.h"
 #include "YBaseLib/Memory.h"
+#include "YBaseLib/Profiler.h"
 #include "YBaseLib/String.h"
+Log_SetChannel(TaskQueue);
 
 // Pointer to whether the current thread is a worker thread for a task queue.
 // This won't work if a task calls ExecuteQueuedTasks for another queue, but
 // if you're doing that, it's probably a "bad idea" anyway.
 Y_DECLARE_THREAD_LOCAL(TaskQueue*) s_pCurrentThreadTaskQueue = nullptr;
+
+// Fiber a task runs on when fiber jobs are enabled.
+struct TaskQueueFiber
+{
+  Fiber Context;
+  TaskQueue* pTaskQueue;
+
+  // task to run when the fiber is next started by a worker
+  TaskQueue::FifoQueueEntryHeader* pTaskHeader;
+
+  // context of the worker running the fiber, set each time a worker switches to it
+  Fiber* pSchedulerFiber;
+
+  // counter the fiber is suspended on, null when it switched back because its task finished
+  TaskQueue::JobCounter* pWaitCounter;
+
+  // link in a counter's waiter list or in the ready list
+  TaskQueueFiber* pNext;
+};
+
+// Job fiber the current thread is running, if any. Fibers can move between workers, so this is only valid until
+// the fiber next switches away.
+Y_DECLARE_THREAD_LOCAL(TaskQueueFiber*) s_pCurrentJobFiber = nullptr;
+// Timer clock, in milliseconds. Deadlines don't need better, and it keeps them independent of the timer's frequency.
+static uint64 GetTimerTime()
+{
+  return (uint64)Y_TimerConvertToMilliseconds(Y_TimerGetValue());
+}
+
 static inline void BeginThreadTaskQueueProcessing(TaskQueue* pTaskQueue)
 {
   DebugAssert(s_pCurrentThreadTaskQueue == nullptr);
@@ -18,9 +51,15 @@ static inline void EndThreadTaskQueueProcessing(TaskQueue* pTaskQueue)
 }
 
 TaskQueue::TaskQueue()
-  : m_workerThreadExitFlag(true), m_pThreadPool(nullptr), m_activeThreadPoolTasks(0),
-    m_threadPoolYieldToOtherJobs(false), m_activeWorkerThreads(0), m_allocatedBarrierCount(0)
+  : m_workerThreadExitFlag(true), m_pThreadPool(nullptr), m_threadPoolYieldToOtherJobs(false),
+    m_idlePolicy(WorkerIdlePolicy::Park()), m_lastWakeRequestTime(0), m_pLockFreeBuffer(nullptr),
+    m_lockFreeBufferMask(0), m_nextTimerSerial(1), m_fiberStackSize(0), m_pReadyJobFibersHead(nullptr),
+    m_pReadyJobFibersTail(nullptr), m_jobFiberCount(0), m_statsEnabled(false), m_statsStartTime(0),
+    m_barrierPool(BarrierPoolCapacity),
+    m_activeThreadPoolTasks(0), m_activeWorkerThreads(0), m_pendingTaskCount(0), m_batchedTaskCount(0),
+    m_lockFreeHead(0), m_lockFreeSpaceWaiters(0), m_lockFreeTail(0)
 {
+  m_queueLock.SetProfileName("taskqueue.queue");
 }
 
 TaskQueue::~TaskQueue()
@@ -50,9 +89,9 @@ TaskQueue::~TaskQueue()
     // release lock
     m_queueLock.Unlock();
   }
-  else if (m_workerThreads.IsEmpty())
+  else if (m_workerThreads.IsEmpty() && IsOnWorkerThread())
   {
-    // We are using this as a non-threaded task queue.
+    // We are using this as a non-threaded task queue. The workers may also have been shut down by ExitWorkers already.
     EndThreadTaskQueueProcessing(this);
   }
 
@@ -62,18 +101,43 @@ TaskQueue::~TaskQueue()
   // the queue should be empty at this point
   Assert(FifoIsEmpty());
 
-  // free barriers
-  Assert(m_allocatedBarrierCount == 0);
-  for (uint32 i = 0; i < m_allocatedBarrierCount; i++)
-    delete m_barrierPool[i];
+  // timers that never came due
+  while (!m_timers.IsEmpty())
+    delete m_timers.Pop().pTask;
+
+  // free barriers, the pooled ones go with the pool
+  for (uint32 i = 0; i < m_overflowBarriers.GetSize(); i++)
+    delete m_overflowBarriers[i];
+
+  Y_free(m_pLockFreeBuffer);
+
+  // every fiber is idle once the workers have drained the queue
+  Assert(m_freeJobFibers.GetSize() == m_jobFiberCount && m_pReadyJobFibersHead == nullptr);
+  for (uint32 i = 0; i < m_freeJobFibers.GetSize(); i++)
+    delete m_freeJobFibers[i];
+}
+
+bool TaskQueue::EnableFiberJobs(uint32 stackSize /* = Fiber::DefaultStackSize */)
+{
+  DebugAssert(m_workerThreads.IsEmpty() && m_pThreadPool == nullptr && stackSize > 0);
+  if (!Fiber::IsSupported())
+    return false;
+
+  m_fiberStackSize = stackSize;
+  return true;
 }
 
-bool TaskQueue::Initialize(uint32 taskQueueSize /* = DefaultQueueSize */, uint32 workerThreadCount /* = 1 */)
+bool TaskQueue::Initialize(uint32 taskQueueSize /* = DefaultQueueSize */, uint32 workerThreadCount /* = 1 */,
+                           bool lockFreeProducers /* = false */,
+                           THREADPOOL_AFFINITY affinity /* = THREADPOOL_AFFINITY_DEFAULT */)
 {
   DebugAssert(m_workerThreadExitFlag && m_workerThreads.IsEmpty() && m_pThreadPool == nullptr);
 
   // allocate queue
-  AllocateQueue(taskQueueSize);
+  if (lockFreeProducers)
+    AllocateLockFreeQueue(taskQueueSize);
+  else
+    AllocateQueue(taskQueueSize);
 
   // create worker threads
   if (workerThreadCount > 0)
@@ -85,7 +149,8 @@ bool TaskQueue::Initialize(uint32 taskQueueSize /* = DefaultQueueSize */, uint32
     // create the workers
     for (uint32 i = 0; i < workerThreadCount; i++)
     {
-      WorkerThread* pThread = new WorkerThread(this);
+      WorkerThread* pThread =
+        new WorkerThread(this, ThreadPool::GetWorkerAffinityMask(affinity, i, workerThreadCount));
       if (!pThread->Start())
       {
         // cleanup the remaining threads
@@ -133,6 +198,23 @@ void TaskQueue::AllocateQueue(uint32 size)
     m_taskQueueBuffer.ResizeBuffer(size);
 }
 
+void TaskQueue::AllocateLockFreeQueue(uint32 size)
+{
+  if (size == 0)
+    return;
+
+  // positions are masked, so the size has to be a power of two
+  uint32 bufferSize = LockFreeEntryAlignment;
+  while (bufferSize < size)
+    bufferSize *= 2;
+
+  // entries are only recognized as committed by their header, so the buffer has to start zeroed
+  m_pLockFreeBuffer = (byte*)Y_malloczero(bufferSize);
+  m_lockFreeBufferMask = bufferSize - 1;
+  m_lockFreeHead = 0;
+  m_lockFreeTail = 0;
+}
+
 void TaskQueue::ExitWorkers()
 {
   // if there's no workers, just drain the queue
@@ -150,15 +232,67 @@ void TaskQueue::ExitWorkers()
   m_conditionVariable.WakeAll();
   ResumeWorkers();
 
-  // join each thread
+  // join each thread, keeping its stats
   while (m_workerThreads.GetSize() > 0)
   {
     WorkerThread* pThread = m_workerThreads.PopBack();
     pThread->Join();
+    m_sharedSchedulerStats.Accumulate(pThread->GetSchedulerStats());
     delete pThread;
   }
 }
 
+void TaskQueue::SetIdlePolicy(const WorkerIdlePolicy& policy)
+{
+  // workers read the policy each time they run out of tasks
+  m_queueLock.Lock();
+  m_idlePolicy = policy;
+  m_queueLock.Unlock();
+}
+
+WorkerIdleStats TaskQueue::GetIdleStats() const
+{
+  WorkerIdleStats stats;
+  for (uint32 i = 0; i < m_workerThreads.GetSize(); i++)
+    stats.Accumulate(m_workerThreads[i]->GetIdleStats());
+
+  return stats;
+}
+
+void TaskQueue::SetStatsEnabled(bool enabled)
+{
+  m_queueLock.Lock();
+  if (enabled && m_statsStartTime == 0)
+    m_statsStartTime = Y_TimerGetValue();
+
+  m_statsEnabled = enabled;
+  m_queueLock.Unlock();
+}
+
+SchedulerStats TaskQueue::GetStats() const
+{
+  SchedulerStats stats;
+  stats.QueueDepth = m_pendingTaskCount;
+  stats.ElapsedTime = (m_statsStartTime != 0) ? (Y_TimerGetValue() - m_statsStartTime) : 0;
+  stats.Totals.Accumulate(m_sharedSchedulerStats);
+
+  if (m_pThreadPool != nullptr)
+  {
+    stats.WorkerCount = m_threadPoolTasks.GetSize();
+    for (uint32 i = 0; i < m_threadPoolTasks.GetSize(); i++)
+      stats.Totals.Accumulate(m_threadPoolTasks[i]->GetSchedulerStats());
+  }
+  else
+  {
+    // a queue without workers is executed by the caller
+    stats.WorkerCount = Max(m_workerThreads.GetSize(), (uint32)1);
+    for (uint32 i = 0; i < m_workerThreads.GetSize(); i++)
+      stats.Totals.Accumulate(m_workerThreads[i]->GetSchedulerStats());
+  }
+
+  return stats;
+}
+
 void TaskQueue::PauseWorkers()
 {
   if (m_workerThreads.IsEmpty())
@@ -203,7 +337,7 @@ void TaskQueue::ResumeWorkers()
 
 void TaskQueue::QueueTask(Task* pTask, uint32 taskSize)
 {
-  if (m_taskQueueBuffer.GetBufferSize() == 0)
+  if (!HasQueue())
   {
     pTask->Execute();
     return;
@@ -215,12 +349,12 @@ void TaskQueue::QueueTask(Task* pTask, uint32 taskSize)
   void* task = FifoAllocateTask(taskSize, nullptr);
   std::memcpy(task, pTask, taskSize);
 
-  UnlockQueueForNewTask();
+  UnlockQueueForNewTask(task);
 }
 
 void TaskQueue::QueueBlockingTask(Task* pTask, uint32 taskSize)
 {
-  if (m_taskQueueBuffer.GetBufferSize() == 0 || m_workerThreads.IsEmpty() || IsOnWorkerThread())
+  if (!HasQueue() || m_workerThreads.IsEmpty() || IsOnWorkerThread())
   {
     pTask->Execute();
     return;
@@ -230,12 +364,12 @@ void TaskQueue::QueueBlockingTask(Task* pTask, uint32 taskSize)
   LockQueueForNewTask();
 
   // write @TODO(this should be a template function calling copy operator..)
-  Barrier* barrier;
+  LightweightBarrier* barrier;
   void* task = FifoAllocateTask(taskSize, &barrier);
   std::memcpy(task, pTask, taskSize);
 
   // unlock
-  UnlockQueueForNewTask();
+  UnlockQueueForNewTask(task);
 
   // block
   barrier->Wait();
@@ -250,6 +384,13 @@ bool TaskQueue::ExecuteQueuedTasks()
   // loop
   for (;;)
   {
+    // timers that are due go ahead of queued tasks
+    if (RunDueTimer(nullptr))
+    {
+      result = true;
+      continue;
+    }
+
     FifoQueueEntryHeader* taskHdr = FifoGetNextTask();
     if (taskHdr == nullptr)
     {
@@ -270,9 +411,15 @@ bool TaskQueue::ExecuteQueuedTasks()
     m_queueLock.Unlock();
 
     // run the task
+    const bool recordStats = m_statsEnabled;
+    Y_TIMER_VALUE startTime = recordStats ? Y_TimerGetValue() : 0;
     Task* pTask = reinterpret_cast<Task*>(taskHdr + 1);
-    pTask->Execute();
+    {
+      Y_PROFILE_ZONE("TaskQueue::Execute");
+      pTask->Execute();
+    }
     pTask->~Task();
+    Y_TIMER_VALUE endTime = recordStats ? Y_TimerGetValue() : 0;
 
     // barrier waits
     if (taskHdr->pBarrier != nullptr)
@@ -280,6 +427,8 @@ bool TaskQueue::ExecuteQueuedTasks()
 
     // re-lock queue
     m_queueLock.Lock();
+    if (recordStats)
+      m_sharedSchedulerStats.RecordTask(taskHdr->QueueTime, startTime, endTime, m_pendingTaskCount);
 
     // push barrier back to pool
     if (taskHdr->pBarrier != nullptr)
@@ -294,28 +443,232 @@ bool TaskQueue::ExecuteQueuedTasks()
   return result;
 }
 
+void TaskQueue::WaitForCounter(JobCounter* pCounter)
+{
+  if (pCounter->m_value == 0)
+    return;
+
+  // a job fiber hands itself back to its worker, which parks it on the counter. doing that from the worker means
+  // a completion on another thread can't resume the fiber before it has switched away.
+  TaskQueueFiber* pFiber = s_pCurrentJobFiber;
+  if (pFiber != nullptr && pFiber->pTaskQueue == this)
+  {
+    pFiber->pWaitCounter = pCounter;
+    Fiber::Switch(&pFiber->Context, pFiber->pSchedulerFiber);
+
+    // resumed by whichever worker picked us off the ready list
+    pFiber->pWaitCounter = nullptr;
+    return;
+  }
+
+  // nothing else will execute the tasks
+  if (m_workerThreads.IsEmpty() && m_pThreadPool == nullptr)
+  {
+    while (pCounter->m_value != 0)
+    {
+      if (!ExecuteQueuedTasks())
+        Thread::Yield();
+    }
+
+    return;
+  }
+
+  m_queueLock.Lock();
+  while (pCounter->m_value != 0)
+    m_counterConditionVariable.SleepAndRelease(&m_queueLock);
+  m_queueLock.Unlock();
+}
+
+void TaskQueue::ReleaseJobCounter(JobCounter* pCounter)
+{
+  m_queueLock.Lock();
+  DebugAssert(pCounter->m_value > 0);
+
+  // take the waiters before the counter reaches zero, a waiter may destroy it as soon as it sees zero
+  uint32 resumedCount = 0;
+  if (pCounter->m_value == 1)
+  {
+    TaskQueueFiber* pWaiter = pCounter->m_pWaiters;
+    pCounter->m_pWaiters = nullptr;
+    while (pWaiter != nullptr)
+    {
+      TaskQueueFiber* pNext = pWaiter->pNext;
+      PushReadyJobFiber(pWaiter);
+      resumedCount++;
+      pWaiter = pNext;
+    }
+  }
+
+  if (Y_AtomicDecrement(pCounter->m_value) == 0)
+  {
+    if (resumedCount > 0)
+      WakeWorkers(resumedCount);
+
+    m_counterConditionVariable.WakeAll();
+  }
+
+  m_queueLock.Unlock();
+}
+
+TaskQueueFiber* TaskQueue::AllocateJobFiber()
+{
+  if (!m_freeJobFibers.IsEmpty())
+    return m_freeJobFibers.PopBack();
+
+  TaskQueueFiber* pFiber = new TaskQueueFiber;
+  pFiber->pTaskQueue = this;
+  pFiber->pTaskHeader = nullptr;
+  pFiber->pSchedulerFiber = nullptr;
+  pFiber->pWaitCounter = nullptr;
+  pFiber->pNext = nullptr;
+  if (!pFiber->Context.Create(JobFiberEntryPoint, pFiber, m_fiberStackSize))
+    Panic("Failed to create task queue fiber");
+
+  m_jobFiberCount++;
+  return pFiber;
+}
+
+void TaskQueue::PushReadyJobFiber(TaskQueueFiber* pFiber)
+{
+  pFiber->pNext = nullptr;
+  if (m_pReadyJobFibersTail != nullptr)
+    m_pReadyJobFibersTail->pNext = pFiber;
+  else
+    m_pReadyJobFibersHead = pFiber;
+
+  m_pReadyJobFibersTail = pFiber;
+}
+
+TaskQueueFiber* TaskQueue::PopReadyJobFiber()
+{
+  TaskQueueFiber* pFiber = m_pReadyJobFibersHead;
+  if (pFiber == nullptr)
+    return nullptr;
+
+  m_pReadyJobFibersHead = pFiber->pNext;
+  if (m_pReadyJobFibersHead == nullptr)
+    m_pReadyJobFibersTail = nullptr;
+
+  return pFiber;
+}
+
+void TaskQueue::JobFiberEntryPoint(void* pUserData)
+{
+  TaskQueueFiber* pFiber = reinterpret_cast<TaskQueueFiber*>(pUserData);
+  for (;;)
+  {
+    pFiber->pTaskQueue->ExecuteJobFiberTask(pFiber->pTaskHeader);
+    pFiber->pTaskHeader = nullptr;
+
+    // back to the worker we finished on, which returns the fiber to the free list
+    DebugAssert(pFiber->pWaitCounter == nullptr);
+    Fiber::Switch(&pFiber->Context, pFiber->pSchedulerFiber);
+  }
+}
+
+void TaskQueue::ExecuteJobFiberTask(FifoQueueEntryHeader* taskHdr)
+{
+  // run the task, it may move to another worker if it waits
+  const bool recordStats = m_statsEnabled;
+  Y_TIMER_VALUE startTime = recordStats ? Y_TimerGetValue() : 0;
+  Task* pTask = reinterpret_cast<Task*>(taskHdr + 1);
+  pTask->Execute();
+  pTask->~Task();
+  Y_TIMER_VALUE endTime = recordStats ? Y_TimerGetValue() : 0;
+
+  // handle blocking events
+  if (taskHdr->pBarrier != nullptr)
+    taskHdr->pBarrier->Wait();
+
+  m_queueLock.Lock();
+  if (recordStats)
+    m_sharedSchedulerStats.RecordTask(taskHdr->QueueTime, startTime, endTime, m_pendingTaskCount);
+
+  // push barrier back to pool
+  if (taskHdr->pBarrier != nullptr)
+    ReleaseBarrier(taskHdr->pBarrier);
+
+  // destruct the task
+  FifoReleaseTask(taskHdr);
+  m_queueLock.Unlock();
+}
+
 bool TaskQueue::IsOnWorkerThread() const
 {
   // Simply test the per-thread pointer if we're pointed to our task queue.
   return (s_pCurrentThreadTaskQueue == this);
 }
 
-TaskQueue::WorkerThread::WorkerThread(TaskQueue* pParent) : m_this(pParent) {}
+TaskQueue::WorkerThread::WorkerThread(TaskQueue* pParent, uint64 affinityMask)
+  : m_this(pParent), m_affinityMask(affinityMask)
+{
+}
+
+void TaskQueue::WorkerThread::RunJobFiber(TaskQueueFiber* pFiber)
+{
+  pFiber->pSchedulerFiber = &m_schedulerFiber;
+  s_pCurrentJobFiber = pFiber;
+  Fiber::Switch(&m_schedulerFiber, &pFiber->Context);
+  s_pCurrentJobFiber = nullptr;
+
+  // the fiber either finished its task or is waiting on a counter
+  m_this->m_queueLock.Lock();
+  JobCounter* pCounter = pFiber->pWaitCounter;
+  if (pCounter == nullptr)
+  {
+    m_this->m_freeJobFibers.Add(pFiber);
+  }
+  else if (pCounter->m_value == 0)
+  {
+    // completed while we were switching, we'll pick it straight back up
+    m_this->PushReadyJobFiber(pFiber);
+  }
+  else
+  {
+    pFiber->pNext = pCounter->m_pWaiters;
+    pCounter->m_pWaiters = pFiber;
+  }
+}
 
 int TaskQueue::WorkerThread::ThreadEntryPoint()
 {
   // initialize thread name
   Thread::SetDebugName(String::FromFormat("Task Queue %p Worker", m_this));
+  if (m_affinityMask != 0 && !Thread::SetCurrentThreadAffinityMask(m_affinityMask))
+    Log_WarningPrintf("Failed to set affinity of task queue worker to 0x%llx", (unsigned long long)m_affinityMask);
   BeginThreadTaskQueueProcessing(m_this);
 
+  // job fibers switch back to the worker's own context
+  const bool useFibers = m_this->IsUsingFiberJobs();
+  if (useFibers && !m_schedulerFiber.ConvertFromThread())
+    Panic("Failed to convert task queue worker to a fiber");
+
   // start with it locked
   m_this->m_queueLock.Lock();
   m_this->m_activeWorkerThreads++;
   MemoryBarrier();
 
   // loop
+  WorkerIdlePolicy::STAGE idleStage = WorkerIdlePolicy::STAGE_NONE;
   for (;;)
   {
+    // resume jobs whose counters have completed before starting new ones
+    TaskQueueFiber* pReadyFiber = m_this->PopReadyJobFiber();
+    if (pReadyFiber != nullptr)
+    {
+      m_this->m_queueLock.Unlock();
+      RunJobFiber(pReadyFiber);
+      idleStage = WorkerIdlePolicy::STAGE_NONE;
+      continue;
+    }
+
+    // timers that are due go ahead of queued tasks
+    if (m_this->RunDueTimer(&m_schedulerStats))
+    {
+      idleStage = WorkerIdlePolicy::STAGE_NONE;
+      continue;
+    }
+
     // get the next task
     FifoQueueEntryHeader* taskHdr = m_this->FifoGetNextTask();
     if (taskHdr == nullptr)
@@ -324,16 +677,61 @@ int TaskQueue::WorkerThread::ThreadEntryPoint()
       if (m_this->m_workerThreadExitFlag)
         break;
 
+      // spin and yield without the lock first, if the policy allows it. we're still counted as active so
+      // producers won't wake us, which means the queue has to be checked again under the lock afterwards.
+      WorkerIdlePolicy policy = m_this->m_idlePolicy;
+      if (idleStage != WorkerIdlePolicy::STAGE_PARK && (policy.SpinCount > 0 || policy.YieldCount > 0))
+      {
+        TaskQueue* pTaskQueue = m_this;
+        m_this->m_queueLock.Unlock();
+        idleStage = policy.Wait(
+          [pTaskQueue]() {
+            return (pTaskQueue->m_pendingTaskCount > 0 || pTaskQueue->m_pReadyJobFibersHead != nullptr ||
+                    pTaskQueue->m_workerThreadExitFlag);
+          });
+        m_this->m_queueLock.Lock();
+        continue;
+      }
+
       // this thread is now inactive
       m_this->m_activeWorkerThreads--;
       MemoryBarrier();
 
-      // wait until there is a new event
-      m_this->m_conditionVariable.SleepAndRelease(&m_this->m_queueLock);
+      // wait until there is a new event, or the next timer is due. lock-free producers check for inactive workers
+      // without holding the lock, so look again now that our state is visible, otherwise a task committed in between
+      // is missed. a new timer due before the others wakes a worker, so the wait is never too long.
+      uint32 timerWait = m_this->GetTimerWaitTime();
+      if (timerWait > 0 && (!m_this->IsLockFreeQueue() || m_this->LockFreeFindNextTask(false) == nullptr))
+      {
+        Y_TIMER_VALUE parkTime = Y_TimerGetValue();
+        m_idleStats.Parks++;
+        if (timerWait == NoTimerWait)
+          m_this->m_conditionVariable.SleepAndRelease(&m_this->m_queueLock);
+        else
+          m_this->m_conditionVariable.SleepAndRelease(&m_this->m_queueLock, timerWait);
+
+        // only count wake-ups that were requested after we went to sleep
+        if (m_this->m_lastWakeRequestTime >= parkTime)
+          m_idleStats.RecordWakeLatency(Y_TimerGetValue() - m_this->m_lastWakeRequestTime);
+      }
 
       // this thread is now active
       m_this->m_activeWorkerThreads++;
       MemoryBarrier();
+      idleStage = WorkerIdlePolicy::STAGE_NONE;
+      continue;
+    }
+
+    m_idleStats.RecordWakeup(idleStage);
+    idleStage = WorkerIdlePolicy::STAGE_NONE;
+
+    // the fiber releases the task itself once it finishes, which may be on another worker
+    if (useFibers)
+    {
+      TaskQueueFiber* pFiber = m_this->AllocateJobFiber();
+      pFiber->pTaskHeader = taskHdr;
+      m_this->m_queueLock.Unlock();
+      RunJobFiber(pFiber);
       continue;
     }
 
@@ -341,9 +739,16 @@ int TaskQueue::WorkerThread::ThreadEntryPoint()
     m_this->m_queueLock.Unlock();
 
     // run the task
+    const bool recordStats = m_this->m_statsEnabled;
+    Y_TIMER_VALUE startTime = recordStats ? Y_TimerGetValue() : 0;
     Task* pTask = reinterpret_cast<Task*>(taskHdr + 1);
-    pTask->Execute();
+    {
+      Y_PROFILE_ZONE("TaskQueue::Execute");
+      pTask->Execute();
+    }
     pTask->~Task();
+    if (recordStats)
+      m_schedulerStats.RecordTask(taskHdr->QueueTime, startTime, Y_TimerGetValue(), m_this->m_pendingTaskCount);
 
     // handle blocking events
     if (taskHdr->pBarrier != nullptr)
@@ -364,6 +769,9 @@ int TaskQueue::WorkerThread::ThreadEntryPoint()
   MemoryBarrier();
 
   m_this->m_queueLock.Unlock();
+  if (useFibers)
+    m_schedulerFiber.ConvertToThread();
+
   EndThreadTaskQueueProcessing(m_this);
   return 0;
 }
@@ -380,6 +788,10 @@ int32 TaskQueue::ThreadPoolTask::ProcessWork()
   // loop until there are no tasks left
   for (;;)
   {
+    // timers that are due go ahead of queued tasks
+    if (m_this->RunDueTimer(&m_schedulerStats))
+      continue;
+
     // get the next task
     FifoQueueEntryHeader* taskHdr = m_this->FifoGetNextTask();
     if (taskHdr == nullptr)
@@ -389,9 +801,16 @@ int32 TaskQueue::ThreadPoolTask::ProcessWork()
     m_this->m_queueLock.Unlock();
 
     // run the task
+    const bool recordStats = m_this->m_statsEnabled;
+    Y_TIMER_VALUE startTime = recordStats ? Y_TimerGetValue() : 0;
     Task* pTask = reinterpret_cast<Task*>(taskHdr + 1);
-    pTask->Execute();
+    {
+      Y_PROFILE_ZONE("TaskQueue::Execute");
+      pTask->Execute();
+    }
     pTask->~Task();
+    if (recordStats)
+      m_schedulerStats.RecordTask(taskHdr->QueueTime, startTime, Y_TimerGetValue(), m_this->m_pendingTaskCount);
 
     // handle blocking events
     if (taskHdr->pBarrier != nullptr)
@@ -423,49 +842,261 @@ int32 TaskQueue::ThreadPoolTask::ProcessWork()
   return 0;
 }
 
-void TaskQueue::LockQueueForNewTask()
+TaskQueue::TimerID TaskQueue::AddTimer(uint32 delay, uint32 period, Task* pTask)
 {
+  DebugAssert(HasQueue());
+
+  TimerEntry entry;
+  entry.Deadline = GetTimerTime() + delay;
+  entry.Period = period;
+  entry.pTask = pTask;
+
   m_queueLock.Lock();
+  entry.Serial = m_nextTimerSerial;
+  m_nextTimerSerial = (m_nextTimerSerial == 0xFFFFFFFF) ? 1 : (m_nextTimerSerial + 1);
+  uint32 handle = m_timers.Push(entry);
+
+  // a sleeping worker may be waiting for a later deadline, or not at all
+  if (m_timers.GetTopHandle() == handle && !m_workerThreads.IsEmpty())
+    WakeWorkers(1);
+
+  m_queueLock.Unlock();
+  return ((TimerID)entry.Serial << 32) | handle;
 }
 
-void TaskQueue::UnlockQueueForNewTask()
+bool TaskQueue::CancelTimer(TimerID id)
 {
-  DebugAssert(m_taskQueueBuffer.GetBufferSize() > 0);
+  // the serial tells a timer apart from a later one given the same handle
+  uint32 handle = (uint32)id;
+  uint32 serial = (uint32)(id >> 32);
+
+  m_queueLock.Lock();
+  if (!m_timers.Contains(handle) || m_timers.Get(handle).Serial != serial)
+  {
+    m_queueLock.Unlock();
+    return false;
+  }
+
+  TimerEntry entry = m_timers.Get(handle);
+  m_timers.Remove(handle);
+  m_queueLock.Unlock();
 
+  // a running timer's task is deleted by whoever is running it, once it finds the timer gone
+  if (entry.Deadline != RunningTimerDeadline)
+    delete entry.pTask;
+
+  return true;
+}
+
+bool TaskQueue::RunDueTimer(SchedulerWorkerStats* pStats)
+{
+  if (m_timers.IsEmpty() || m_timers.Top().Deadline > GetTimerTime())
+    return false;
+
+  // one-shot timers are done with the heap, periodic ones stay in it while they run
+  uint32 handle = m_timers.GetTopHandle();
+  TimerEntry entry = m_timers.Top();
+  if (entry.Period == 0)
+  {
+    m_timers.Pop();
+  }
+  else
+  {
+    TimerEntry running = entry;
+    running.Deadline = RunningTimerDeadline;
+    m_timers.Update(handle, running);
+  }
+
+  m_queueLock.Unlock();
+
+  const bool recordStats = m_statsEnabled;
+  Y_TIMER_VALUE startTime = recordStats ? Y_TimerGetValue() : 0;
+  {
+    Y_PROFILE_ZONE("TaskQueue::ExecuteTimer");
+    entry.pTask->Execute();
+  }
+  Y_TIMER_VALUE endTime = recordStats ? Y_TimerGetValue() : 0;
+  if (entry.Period == 0)
+    delete entry.pTask;
+
+  m_queueLock.Lock();
+
+  // timers aren't queued in the fifo, so they count as having waited for nothing
+  if (recordStats)
+    ((pStats != nullptr) ? pStats : &m_sharedSchedulerStats)->RecordTask(startTime, startTime, endTime,
+                                                                         m_pendingTaskCount);
+
+  if (entry.Period != 0)
+  {
+    if (m_timers.Contains(handle) && m_timers.Get(handle).Serial == entry.Serial)
+    {
+      // keep to the original schedule, skipping any periods that have passed already
+      uint64 now = GetTimerTime();
+      uint64 nextDeadline = entry.Deadline + entry.Period;
+      if (nextDeadline <= now)
+        nextDeadline += ((now - nextDeadline) / entry.Period + 1) * entry.Period;
+
+      entry.Deadline = nextDeadline;
+      m_timers.Update(handle, entry);
+    }
+    else
+    {
+      // cancelled while it was running
+      delete entry.pTask;
+    }
+  }
+
+  return true;
+}
+
+uint32 TaskQueue::GetTimerWaitTime() const
+{
+  if (m_timers.IsEmpty() || m_timers.Top().Deadline == RunningTimerDeadline)
+    return NoTimerWait;
+
+  uint64 now = GetTimerTime();
+  uint64 deadline = m_timers.Top().Deadline;
+  if (deadline <= now)
+    return 0;
+
+  return (uint32)Min(deadline - now, (uint64)(NoTimerWait - 1));
+}
+
+void TaskQueue::LockQueueForNewTask()
+{
+  if (!IsLockFreeQueue())
+    m_queueLock.Lock();
+}
+
+void TaskQueue::UnlockQueueForNewTask(void* pTaskMemory)
+{
+  DebugAssert(HasQueue());
+  if (IsLockFreeQueue())
+  {
+    LockFreeCommitTask(pTaskMemory);
+    return;
+  }
+
+  // any batched tasks committed since the last wake can be picked up too
+  WakeWorkers(1 + ClearBatchedTaskCount());
+  m_queueLock.Unlock();
+}
+
+TaskQueue::BatchScope::BatchScope(TaskQueue* pTaskQueue) : m_pTaskQueue(pTaskQueue)
+{
+  if (m_pTaskQueue->HasQueue())
+    m_pTaskQueue->LockQueueForNewTask();
+}
+
+TaskQueue::BatchScope::~BatchScope()
+{
+  if (!m_pTaskQueue->HasQueue())
+    return;
+
+  if (m_pTaskQueue->IsLockFreeQueue())
+  {
+    if (m_pTaskQueue->m_batchedTaskCount == 0)
+      return;
+
+    m_pTaskQueue->m_queueLock.Lock();
+    m_pTaskQueue->FlushBatchedTasks();
+    m_pTaskQueue->m_queueLock.Unlock();
+  }
+  else
+  {
+    m_pTaskQueue->FlushBatchedTasks();
+    m_pTaskQueue->m_queueLock.Unlock();
+  }
+}
+
+void TaskQueue::BatchScope::QueueTask(Task* pTask, uint32 taskSize)
+{
+  if (!m_pTaskQueue->HasQueue())
+  {
+    pTask->Execute();
+    return;
+  }
+
+  void* task = m_pTaskQueue->FifoAllocateTask(taskSize, nullptr);
+  std::memcpy(task, pTask, taskSize);
+  m_pTaskQueue->CommitBatchedTask(task);
+}
+
+void TaskQueue::CommitBatchedTask(void* pTaskMemory)
+{
+  if (IsLockFreeQueue())
+    LockFreeCommitTask(pTaskMemory, false);
+
+  Y_AtomicIncrement(m_batchedTaskCount);
+}
+
+uint32 TaskQueue::ClearBatchedTaskCount()
+{
+  for (;;)
+  {
+    uint32 count = m_batchedTaskCount;
+    if (count == 0 || Y_AtomicCompareExchange(m_batchedTaskCount, (uint32)0, count) == count)
+      return count;
+  }
+}
+
+void TaskQueue::FlushBatchedTasks()
+{
+  uint32 count = ClearBatchedTaskCount();
+  if (count > 0)
+    WakeWorkers(count);
+}
+
+void TaskQueue::WakeWorkers(uint32 count)
+{
   if (m_pThreadPool != nullptr)
   {
-    bool queueTask = (m_activeThreadPoolTasks < m_threadPoolTasks.GetSize());
-    if (queueTask)
+    // start idle thread pool tasks, handing them to the pool together
+    ThreadPoolWorkItem* pTasksToStart[32];
+    uint32 startCount = 0;
+    for (uint32 i = 0; i < m_threadPoolTasks.GetSize() && count > 0; i++)
     {
-      // find a free task
-      for (uint32 i = 0; i < m_threadPoolTasks.GetSize(); i++)
+      ThreadPoolTask* pTask = m_threadPoolTasks[i];
+      if (pTask->IsActive())
+        continue;
+
+      pTask->SetActive();
+      m_activeThreadPoolTasks++;
+      pTasksToStart[startCount++] = pTask;
+      count--;
+
+      if (startCount == countof(pTasksToStart))
       {
-        ThreadPoolTask* pTask = m_threadPoolTasks[i];
-        if (!pTask->IsActive())
-        {
-          // enqueue it
-          pTask->SetActive();
-          m_activeThreadPoolTasks++;
-          m_pThreadPool->EnqueueWorkItem(pTask);
-          break;
-        }
+        m_pThreadPool->EnqueueWorkItems(pTasksToStart, startCount);
+        startCount = 0;
       }
     }
 
-    // release lock
-    m_queueLock.Unlock();
+    m_pThreadPool->EnqueueWorkItems(pTasksToStart, startCount);
+    return;
+  }
+
+  uint32 sleepingWorkerCount = m_workerThreads.GetSize() - m_activeWorkerThreads;
+  if (sleepingWorkerCount == 0)
+    return;
+
+  m_lastWakeRequestTime = Y_TimerGetValue();
+  if (count >= sleepingWorkerCount)
+  {
+    m_conditionVariable.WakeAll();
   }
   else
   {
-    if (m_activeWorkerThreads < m_workerThreads.GetSize())
+    for (uint32 i = 0; i < count; i++)
       m_conditionVariable.Wake();
-
-    m_queueLock.Unlock();
   }
 }
 
-void* TaskQueue::FifoAllocateTask(uint32 size, Barrier** ppBarrier)
+void* TaskQueue::FifoAllocateTask(uint32 size, LightweightBarrier** ppBarrier)
 {
+  if (IsLockFreeQueue())
+    return LockFreeAllocateTask(size, ppBarrier);
+
   void* pWritePointer;
   size_t requiredSpace = sizeof(FifoQueueEntryHeader) + size;
   size_t freeSpace = requiredSpace;
@@ -473,20 +1104,24 @@ void* TaskQueue::FifoAllocateTask(uint32 size, Barrier** ppBarrier)
   while (!m_taskQueueBuffer.GetWritePointer(&pWritePointer, &freeSpace) || freeSpace < requiredSpace)
   {
     // need to wait until the queue is empty @TODO find a more efficient way of doing this that doesn't spin
+    // a batch may have filled the queue without waking anyone, so make sure the workers are running
+    FlushBatchedTasks();
     freeSpace = requiredSpace;
     m_queueLock.Unlock();
     Thread::Yield();
     m_queueLock.Lock();
   }
 
-  // move buffer forward
+  // move buffer forward, the task is visible once the lock is released
   m_taskQueueBuffer.MoveWritePointer(requiredSpace);
+  Y_AtomicIncrement(m_pendingTaskCount);
 
   // fill in header details
   FifoQueueEntryHeader* hdr = reinterpret_cast<FifoQueueEntryHeader*>(pWritePointer);
   hdr->Size = sizeof(FifoQueueEntryHeader) + size;
   hdr->AcceptedFlag = false;
   hdr->CompletedFlag = false;
+  hdr->QueueTime = m_statsEnabled ? Y_TimerGetValue() : 0;
 
   // need a barrier?
   if (ppBarrier != nullptr)
@@ -507,11 +1142,23 @@ void* TaskQueue::FifoAllocateTask(uint32 size, Barrier** ppBarrier)
 
 bool TaskQueue::FifoIsEmpty() const
 {
+  if (IsLockFreeQueue())
+    return (m_lockFreeHead == m_lockFreeTail);
+
   return m_taskQueueBuffer.GetBufferUsed() == 0;
 }
 
 TaskQueue::FifoQueueEntryHeader* TaskQueue::FifoGetNextTask()
 {
+  if (IsLockFreeQueue())
+  {
+    FifoQueueEntryHeader* hdr = LockFreeFindNextTask(true);
+    if (hdr != nullptr)
+      Y_AtomicDecrement(m_pendingTaskCount);
+
+    return hdr;
+  }
+
   void* pReadPointer;
   size_t availableBytes;
   if (!m_taskQueueBuffer.GetReadPointer(const_cast<const void**>(&pReadPointer), &availableBytes))
@@ -525,6 +1172,7 @@ TaskQueue::FifoQueueEntryHeader* TaskQueue::FifoGetNextTask()
     if (!hdr->AcceptedFlag)
     {
       hdr->AcceptedFlag = true;
+      Y_AtomicDecrement(m_pendingTaskCount);
       return hdr;
     }
 
@@ -538,6 +1186,12 @@ TaskQueue::FifoQueueEntryHeader* TaskQueue::FifoGetNextTask()
 
 void TaskQueue::FifoReleaseTask(FifoQueueEntryHeader* taskHdr)
 {
+  if (IsLockFreeQueue())
+  {
+    LockFreeReleaseTask(taskHdr);
+    return;
+  }
+
   // flag as completed
   taskHdr->CompletedFlag = true;
 
@@ -569,19 +1223,196 @@ void TaskQueue::FifoReleaseTask(FifoQueueEntryHeader* taskHdr)
   }
 }
 
-Barrier* TaskQueue::AllocateBarrier()
+void* TaskQueue::LockFreeAllocateTask(uint32 size, LightweightBarrier** ppBarrier)
 {
-  m_allocatedBarrierCount++;
-  if (m_barrierPool.GetSize() > 0)
-    return m_barrierPool.PopBack();
+  const uint32 bufferSize = m_lockFreeBufferMask + 1;
+  const uint32 entrySize = ALIGNED_SIZE(static_cast<uint32>(sizeof(FifoQueueEntryHeader)) + size, LockFreeEntryAlignment);
+  AssertMsg(entrySize <= bufferSize, "Task is larger than the queue");
+
+  uint32 position;
+  uint32 paddingSize;
+  for (;;)
+  {
+    // entries never wrap, if it doesn't fit before the end of the buffer the remainder is consumed as padding
+    position = m_lockFreeTail;
+    uint32 contiguousSize = bufferSize - (position & m_lockFreeBufferMask);
+    paddingSize = (contiguousSize < entrySize) ? contiguousSize : 0;
+
+    // wait for the consumers to free up space
+    uint32 reserveSize = paddingSize + entrySize;
+    if ((position - m_lockFreeHead) + reserveSize > bufferSize)
+    {
+      // a batch may have filled the queue without waking anyone
+      if (m_batchedTaskCount > 0)
+      {
+        m_queueLock.Lock();
+        FlushBatchedTasks();
+        m_queueLock.Unlock();
+      }
+
+      // Releases only wake the head if someone's waiting on it. The increment is a full barrier, so either the
+      // release sees the waiter, or the head read here is the one it moved to.
+      Y_AtomicIncrement(m_lockFreeSpaceWaiters);
+      uint32 head = m_lockFreeHead;
+      if ((position - head) + reserveSize > bufferSize)
+        Y_FutexWait(&m_lockFreeHead, head);
+
+      Y_AtomicDecrement(m_lockFreeSpaceWaiters);
+      continue;
+    }
+
+    if (Y_AtomicCompareExchange(m_lockFreeTail, position + reserveSize, position) == position)
+      break;
+  }
+
+  // padding too small for a header is skipped implicitly by the consumer
+  if (paddingSize >= sizeof(FifoQueueEntryHeader))
+  {
+    FifoQueueEntryHeader* paddingHdr = LockFreeGetEntry(position);
+    paddingHdr->Size = paddingSize;
+    paddingHdr->pBarrier = nullptr;
+    paddingHdr->AcceptedFlag = true;
+    paddingHdr->CompletedFlag = true;
+    MemoryBarrier();
+    paddingHdr->CommitState = FIFO_ENTRY_PADDING;
+  }
+
+  // fill in header details, the entry stays invisible until committed
+  FifoQueueEntryHeader* hdr = LockFreeGetEntry(position + paddingSize);
+  DebugAssert(hdr->CommitState == FIFO_ENTRY_RESERVED);
+  hdr->Size = entrySize;
+  hdr->AcceptedFlag = false;
+  hdr->CompletedFlag = false;
+  hdr->QueueTime = m_statsEnabled ? Y_TimerGetValue() : 0;
+
+  if (ppBarrier != nullptr)
+  {
+    hdr->pBarrier = AllocateBarrier();
+    *ppBarrier = hdr->pBarrier;
+  }
   else
-    return new Barrier(2);
+  {
+    hdr->pBarrier = nullptr;
+  }
+
+  return (hdr + 1);
+}
+
+void TaskQueue::LockFreeCommitTask(void* pTaskMemory, bool wakeWorker /* = true */)
+{
+  // publish the task, the task body must be visible before the commit state
+  FifoQueueEntryHeader* hdr = reinterpret_cast<FifoQueueEntryHeader*>(pTaskMemory) - 1;
+  MemoryBarrier();
+  hdr->CommitState = FIFO_ENTRY_COMMITTED;
+
+  // the increment is a full barrier, ordering the commit before the check of the worker state below
+  Y_AtomicIncrement(m_pendingTaskCount);
+
+  // only take the lock if a worker may be sleeping
+  if (wakeWorker && m_activeWorkerThreads < m_workerThreads.GetSize())
+  {
+    m_queueLock.Lock();
+    WakeWorkers(1);
+    m_queueLock.Unlock();
+  }
+}
+
+TaskQueue::FifoQueueEntryHeader* TaskQueue::LockFreeFindNextTask(bool acceptTask)
+{
+  const uint32 bufferSize = m_lockFreeBufferMask + 1;
+  uint32 position = m_lockFreeHead;
+  uint32 tail = m_lockFreeTail;
+  while (position != tail)
+  {
+    // skip the unused end of the buffer
+    uint32 contiguousSize = bufferSize - (position & m_lockFreeBufferMask);
+    if (contiguousSize < sizeof(FifoQueueEntryHeader))
+    {
+      position += contiguousSize;
+      continue;
+    }
+
+    // tasks must be started in order, so stop at the first entry still being written
+    FifoQueueEntryHeader* hdr = LockFreeGetEntry(position);
+    if (hdr->CommitState == FIFO_ENTRY_RESERVED)
+      return nullptr;
+
+    MemoryBarrier();
+    if (!hdr->AcceptedFlag)
+    {
+      if (acceptTask)
+        hdr->AcceptedFlag = true;
+
+      return hdr;
+    }
+
+    position += hdr->Size;
+  }
+
+  return nullptr;
 }
 
-void TaskQueue::ReleaseBarrier(Barrier* pBarrier)
+void TaskQueue::LockFreeReleaseTask(FifoQueueEntryHeader* taskHdr)
 {
-  DebugAssert(m_allocatedBarrierCount > 0);
-  m_allocatedBarrierCount--;
+  taskHdr->CompletedFlag = true;
+
+  // free as many completed entries from the head as possible
+  const uint32 bufferSize = m_lockFreeBufferMask + 1;
+  uint32 position = m_lockFreeHead;
+  uint32 tail = m_lockFreeTail;
+  while (position != tail)
+  {
+    uint32 contiguousSize = bufferSize - (position & m_lockFreeBufferMask);
+    if (contiguousSize < sizeof(FifoQueueEntryHeader))
+    {
+      Y_memzero(LockFreeGetEntry(position), contiguousSize);
+      position += contiguousSize;
+      continue;
+    }
 
-  m_barrierPool.Add(pBarrier);
+    FifoQueueEntryHeader* hdr = LockFreeGetEntry(position);
+    if (hdr->CommitState == FIFO_ENTRY_RESERVED || !hdr->CompletedFlag)
+      break;
+
+    // entries can start anywhere in a later pass, so the whole entry has to be cleared, not just the header
+    uint32 entrySize = hdr->Size;
+    Y_memzero(hdr, entrySize);
+    position += entrySize;
+  }
+
+  if (position == m_lockFreeHead)
+    return;
+
+  // the cleared memory must be visible before producers can reserve it, and the head before the check for waiters
+  MemoryBarrier();
+  m_lockFreeHead = position;
+  MemoryBarrier();
+  if (m_lockFreeSpaceWaiters > 0)
+    Y_FutexWakeAll(&m_lockFreeHead);
+}
+
+LightweightBarrier* TaskQueue::AllocateBarrier()
+{
+  // barriers go back with no one waiting, so a reused one is ready as it is
+  LightweightBarrier* pBarrier = m_barrierPool.Allocate(2);
+  if (pBarrier != nullptr)
+    return pBarrier;
+
+  m_queueLock.Lock();
+  pBarrier = (m_overflowBarriers.GetSize() > 0) ? m_overflowBarriers.PopBack() : new LightweightBarrier(2);
+  m_queueLock.Unlock();
+  return pBarrier;
+}
+
+void TaskQueue::ReleaseBarrier(LightweightBarrier* pBarrier)
+{
+  if (m_barrierPool.Owns(pBarrier))
+  {
+    m_barrierPool.Release(pBarrier);
+    return;
+  }
+
+  m_queueLock.Lock();
+  m_overflowBarriers.Add(pBarrier);
+  m_queueLock.Unlock();
 }
@@ -1,45 +1,114 @@
 #include "YBaseLib/TextReader.h"
 #include "YBaseLib/CString.h"
+#include "YBaseLib/Memory.h"
 #include "YBaseLib/String.h"
 #include <cstdio>
+#include <cstring>
+
+const uint32 TextReader::DefaultBufferSize;
 
 TextReader::TextReader(ByteStream* pStream, TEXT_ENCODING eSourceEncoding)
-  : m_pStream(pStream), m_eSourceEncoding(eSourceEncoding)
+  : m_pStream(pStream), m_eSourceEncoding(eSourceEncoding), m_pBuffer(nullptr), m_bufferSize(0),
+    m_pPosition(nullptr), m_pEnd(nullptr), m_endOfStream(false)
+{
+  // a stream in memory is all there already
+  const byte* pBasePointer = pStream->GetBasePointer();
+  if (pBasePointer != nullptr)
+  {
+    m_pPosition = reinterpret_cast<const char*>(pBasePointer + pStream->GetPosition());
+    m_pEnd = reinterpret_cast<const char*>(pBasePointer + pStream->GetSize());
+    m_endOfStream = true;
+  }
+}
+
+TextReader::~TextReader()
+{
+  // give back what was read ahead
+  if (m_pBuffer == nullptr && m_pPosition != nullptr)
+    m_pStream->SeekAbsolute(uint64(reinterpret_cast<const byte*>(m_pPosition) - m_pStream->GetBasePointer()));
+  else if (m_pPosition != m_pEnd)
+    m_pStream->SeekRelative(-int64(m_pEnd - m_pPosition));
+
+  if (m_pBuffer != nullptr)
+    Y_free(m_pBuffer);
+}
+
+bool TextReader::FillBuffer()
+{
+  if (m_endOfStream)
+    return false;
+
+  uint32 remaining = uint32(m_pEnd - m_pPosition);
+  if (m_pBuffer == nullptr)
+  {
+    m_bufferSize = DefaultBufferSize;
+    m_pBuffer = static_cast<char*>(Y_malloc(m_bufferSize));
+  }
+  else if (remaining == m_bufferSize)
+  {
+    // a line bigger than the buffer
+    m_bufferSize *= 2;
+    m_pBuffer = static_cast<char*>(Y_realloc(m_pBuffer, m_bufferSize));
+    m_pPosition = m_pBuffer;
+  }
+  else if (remaining > 0 && m_pPosition != m_pBuffer)
+  {
+    std::memmove(m_pBuffer, m_pPosition, remaining);
+  }
+
+  uint32 bytesRead = m_pStream->Read(m_pBuffer + remaining, m_bufferSize - remaining);
+  m_pPosition = m_pBuffer;
+  m_pEnd = m_pBuffer + remaining + bytesRead;
+  if (bytesRead == 0)
+  {
+    m_endOfStream = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool TextReader::ReadCharacter(char* pDestination)
 {
+  if (m_pPosition == m_pEnd && !FillBuffer())
+    return false;
+
+  *pDestination = *m_pPosition++;
+  return true;
 }
 
 bool TextReader::ReadLine(char* pDestination, uint32 cbDestination, uint32* pLineLength /* = NULL */,
                           bool* pEndOfLine /* = NULL */)
 {
-  char LastCharacter = 0;
-  char Character = 0;
   bool EndOfLine = false;
   bool EndOfFile = false;
   uint32 DestinationLength = 0;
-  for (;;)
+  while ((DestinationLength + 1) < cbDestination)
   {
-    if ((DestinationLength + 1) >= cbDestination)
-      break;
-
-    if (!m_pStream->ReadByte((byte*)&Character))
+    if (m_pPosition == m_pEnd && !FillBuffer())
     {
       EndOfLine = true;
       EndOfFile = true;
       break;
     }
 
-    if (Character == '\n')
+    uint32 searchLength = Min(uint32(m_pEnd - m_pPosition), cbDestination - 1 - DestinationLength);
+    const char* pNewline = static_cast<const char*>(std::memchr(m_pPosition, '\n', searchLength));
+    uint32 copyLength = (pNewline != nullptr) ? uint32(pNewline - m_pPosition) : searchLength;
+    std::memcpy(pDestination + DestinationLength, m_pPosition, copyLength);
+    DestinationLength += copyLength;
+    m_pPosition += copyLength;
+
+    if (pNewline != nullptr)
     {
       // strip carriage returns
-      if (LastCharacter == '\r')
+      if (DestinationLength > 0 && pDestination[DestinationLength - 1] == '\r')
         DestinationLength--;
 
+      m_pPosition++;
       EndOfLine = true;
       break;
     }
-
-    pDestination[DestinationLength++] = Character;
-    LastCharacter = Character;
   }
 
   pDestination[DestinationLength] = 0;
@@ -56,21 +125,75 @@ bool TextReader::ReadLine(char* pDestination, uint32 cbDestination, uint32* pLin
 
 bool TextReader::ReadLine(String* pDestString)
 {
-  char Buffer[256 + 1];
-  pDestString->Clear();
+  StringView line;
+  if (!ReadLine(&line))
+  {
+    pDestString->Clear();
+    return false;
+  }
 
+  pDestString->Assign(line);
+  return true;
+}
+
+bool TextReader::ReadLine(StringView* pLine)
+{
+  // only what's new is searched each time the buffer fills
+  size_t searchedLength = 0;
   for (;;)
   {
-    uint32 LineLength;
-    bool EndOfLine;
-    bool Result = ReadLine(Buffer, countof(Buffer), &LineLength, &EndOfLine);
-    if (!Result)
-      return (pDestString->GetLength() > 0) ? true : false;
+    size_t length = size_t(m_pEnd - m_pPosition);
+    const char* pNewline = nullptr;
+    if (length > searchedLength)
+      pNewline = static_cast<const char*>(std::memchr(m_pPosition + searchedLength, '\n', length - searchedLength));
+    if (pNewline != nullptr)
+    {
+      const char* pLineEnd = (pNewline != m_pPosition && pNewline[-1] == '\r') ? (pNewline - 1) : pNewline;
+      *pLine = StringView(m_pPosition, pLineEnd);
+      m_pPosition = pNewline + 1;
+      return true;
+    }
 
-    if (LineLength > 0)
-      pDestString->AppendSubString(Buffer, 0, LineLength);
+    searchedLength = length;
+    if (!FillBuffer())
+    {
+      // the last line, without a line break
+      if (m_pPosition == m_pEnd)
+        return false;
 
-    if (EndOfLine)
+      *pLine = StringView(m_pPosition, m_pEnd);
+      m_pPosition = m_pEnd;
       return true;
+    }
   }
 }
+
+uint64 TextReader::FindLineStart(const char* pText, uint64 textLength, uint64 offset)
+{
+  if (offset == 0 || offset >= textLength)
+    return Min(offset, textLength);
+
+  const char* pNewline =
+    static_cast<const char*>(std::memchr(pText + offset - 1, '\n', size_t(textLength - offset + 1)));
+  return (pNewline != nullptr) ? uint64(pNewline + 1 - pText) : textLength;
+}
+
+bool TextReader::SplitLine(const char** ppPosition, const char* pEnd, StringView* pLine)
+{
+  const char* pPosition = *ppPosition;
+  if (pPosition == pEnd)
+    return false;
+
+  const char* pNewline = static_cast<const char*>(std::memchr(pPosition, '\n', size_t(pEnd - pPosition)));
+  if (pNewline == nullptr)
+  {
+    *pLine = StringView(pPosition, pEnd);
+    *ppPosition = pEnd;
+    return true;
+  }
+
+  const char* pLineEnd = (pNewline != pPosition && pNewline[-1] == '\r') ? (pNewline - 1) : pNewline;
+  *pLine = StringView(pPosition, pLineEnd);
+  *ppPosition = pNewline + 1;
+  return true;
+}
@@ -1,11 +1,29 @@
 #include "YBaseLib/TextWriter.h"
+#include "YBaseLib/Assert.h"
 #include "YBaseLib/CString.h"
+#include "YBaseLib/NumberConversion.h"
 #include "YBaseLib/String.h"
-#include <cstdio>
+#include <cstring>
+
+const uint32 TextWriter::BufferSize;
 
 TextWriter::TextWriter(ByteStream* pStream, TEXT_ENCODING eSourceEncoding)
-  : m_pStream(pStream), m_eSourceEncoding(eSourceEncoding)
+  : m_pStream(pStream), m_eSourceEncoding(eSourceEncoding), m_bufferLength(0), m_errorState(false)
+{
+}
+
+TextWriter::~TextWriter()
 {
+  Flush();
+}
+
+bool TextWriter::Flush()
+{
+  if (m_bufferLength > 0 && !m_errorState)
+    WriteToStream(m_buffer, m_bufferLength);
+
+  m_bufferLength = 0;
+  return !m_errorState;
 }
 
 void TextWriter::Write(const char* szCharacters)
@@ -29,13 +47,10 @@ void TextWriter::Write(const String& strCharacters)
 
 void TextWriter::WriteFormattedString(const char* szFormat, ...)
 {
-  char Buffer[1024];
   va_list ap;
   va_start(ap, szFormat);
-  Y_vsnprintf(Buffer, countof(Buffer), szFormat, ap);
+  WriteFormattedVA(szFormat, ap, false);
   va_end(ap);
-
-  Write(Buffer);
 }
 
 void TextWriter::WriteLine(const char* szCharacters)
@@ -58,14 +73,93 @@ void TextWriter::WriteLine(const String& strCharacters)
 
 void TextWriter::WriteFormattedLine(const char* szFormat, ...)
 {
-  char Buffer[1024];
   va_list ap;
   va_start(ap, szFormat);
-  Y_vsnprintf(Buffer, countof(Buffer), szFormat, ap);
+  WriteFormattedVA(szFormat, ap, true);
   va_end(ap);
+}
 
-  Write(Buffer);
-  Write("\n");
+void TextWriter::WriteInt32(int32 value)
+{
+  char* pBuffer = ReserveBuffer(NumberConversion::MaxIntegerLength);
+  if (pBuffer != nullptr)
+    CommitBuffer(NumberConversion::FormatInt32(pBuffer, value));
+}
+
+void TextWriter::WriteUInt32(uint32 value)
+{
+  char* pBuffer = ReserveBuffer(NumberConversion::MaxIntegerLength);
+  if (pBuffer != nullptr)
+    CommitBuffer(NumberConversion::FormatUInt32(pBuffer, value));
+}
+
+void TextWriter::WriteInt64(int64 value)
+{
+  char* pBuffer = ReserveBuffer(NumberConversion::MaxIntegerLength);
+  if (pBuffer != nullptr)
+    CommitBuffer(NumberConversion::FormatInt64(pBuffer, value));
+}
+
+void TextWriter::WriteUInt64(uint64 value)
+{
+  char* pBuffer = ReserveBuffer(NumberConversion::MaxIntegerLength);
+  if (pBuffer != nullptr)
+    CommitBuffer(NumberConversion::FormatUInt64(pBuffer, value));
+}
+
+void TextWriter::WriteFloat(float value)
+{
+  char* pBuffer = ReserveBuffer(NumberConversion::MaxFloatLength);
+  if (pBuffer != nullptr)
+    CommitBuffer(NumberConversion::FormatFloat(pBuffer, value));
+}
+
+void TextWriter::WriteDouble(double value)
+{
+  char* pBuffer = ReserveBuffer(NumberConversion::MaxFloatLength);
+  if (pBuffer != nullptr)
+    CommitBuffer(NumberConversion::FormatDouble(pBuffer, value));
+}
+
+void TextWriter::WriteFormattedVA(const char* szFormat, va_list ap, bool newLine)
+{
+  // most text fits in the buffer once there's some room, the rest goes through the heap
+  char* pBuffer = ReserveBuffer(BufferSize / 4);
+  if (pBuffer == nullptr)
+    return;
+
+  uint32 space = BufferSize - m_bufferLength;
+  va_list apCopy;
+  va_copy(apCopy, ap);
+  uint32 length = Y_vsnprintf(pBuffer, space, szFormat, apCopy);
+  va_end(apCopy);
+
+  // some runtimes return the truncated length, so anything that fills the space is taken as cut off
+  if ((length + 1) < space)
+  {
+    CommitBuffer(length);
+  }
+  else
+  {
+    String text;
+    text.AppendFormattedStringVA(szFormat, ap);
+    _Write(text.GetCharArray(), text.GetLength());
+  }
+
+  if (newLine)
+    _Write("\n", 1);
+}
+
+void TextWriter::WriteFormatted(const StringView& format, const TypedFormat::Argument* pArguments,
+                                uint32 argumentCount, bool newLine)
+{
+  // unlike the printf versions, long lines go to the heap instead of being cut off
+  StackString<1024> buffer;
+  TypedFormat::AppendFormatted(buffer, format, pArguments, argumentCount);
+  if (newLine)
+    buffer.AppendCharacter('\n');
+
+  Write(buffer);
 }
 
 void TextWriter::WriteWithLineNumbers(const char* str)
@@ -191,51 +285,62 @@ TextWriter& TextWriter::operator<<(const String& strCharacters)
 
 void TextWriter::_Write(const char* szCharacters, uint32 nCharacters)
 {
-  uint32 FirstToWrite = 0;
-  uint32 nToWrite = 0;
-  uint32 i;
+  if (m_errorState)
+    return;
 
-  for (i = 0; i < nCharacters; i++)
+  if (nCharacters > (BufferSize - m_bufferLength))
   {
-    if (szCharacters[i] == '\n')
-    {
-      if (nToWrite > 0)
-      {
-        if (m_pStream->Write(szCharacters + FirstToWrite, nToWrite) != nToWrite)
-        {
-          printf("TextWriter::_Write: m_pStream->Write failed.\n");
-          return;
-        }
-      }
+    Flush();
 
-#ifdef Y_PLATFORM_WINDOWS
-      static const char* NewLineCharacters = "\r\n";
-      uint32 NewLineCharactersLength = 2;
-#else
-      static const char* NewLineCharacters = "\n";
-      uint32 NewLineCharactersLength = 1;
-#endif
-      if (m_pStream->Write(NewLineCharacters, NewLineCharactersLength) != NewLineCharactersLength)
-      {
-        printf("TextWriter::_Write: m_pStream->Write failed.\n");
-        return;
-      }
-
-      FirstToWrite = i + 1;
-      nToWrite = 0;
-    }
-    else
+    // too big to be worth copying
+    if (nCharacters >= BufferSize)
     {
-      nToWrite++;
+      WriteToStream(szCharacters, nCharacters);
+      return;
     }
   }
 
-  if (nToWrite > 0)
+  std::memcpy(m_buffer + m_bufferLength, szCharacters, nCharacters);
+  m_bufferLength += nCharacters;
+}
+
+char* TextWriter::ReserveBuffer(uint32 size)
+{
+  DebugAssert(size <= BufferSize);
+  if ((BufferSize - m_bufferLength) < size)
+    Flush();
+
+  return m_errorState ? nullptr : (m_buffer + m_bufferLength);
+}
+
+void TextWriter::WriteToStream(const char* pText, uint32 length)
+{
+  if (m_errorState)
+    return;
+
+#ifdef Y_PLATFORM_WINDOWS
+  // expanded a chunk at a time
+  char chunk[1024];
+  uint32 chunkLength = 0;
+  bool result = true;
+  for (uint32 i = 0; i < length && result; i++)
   {
-    if (m_pStream->Write(szCharacters + FirstToWrite, nToWrite) != nToWrite)
+    if (pText[i] == '\n')
+      chunk[chunkLength++] = '\r';
+    chunk[chunkLength++] = pText[i];
+    if ((chunkLength + 2) > countof(chunk))
     {
-      printf("TextWriter::_Write: m_pStream->Write failed.\n");
-      return;
+      result = m_pStream->Write2(chunk, chunkLength);
+      chunkLength = 0;
     }
   }
+  if (result && chunkLength > 0)
+    result = m_pStream->Write2(chunk, chunkLength);
+#else
+  bool result = m_pStream->Write2(pText, length);
+#endif
+
+  // the caller finds out from InErrorState, this can be writing a log file so it doesn't log itself
+  if (!result)
+    m_errorState = true;
 }
@@ -0,0 +1,396 @@
+#include "YBaseLib/ThreadCachedHeap.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/SpinLock.h"
+#include "YBaseLib/Thread.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(Y_PLATFORM_WINDOWS)
+#include <malloc.h>
+#endif
+
+// Every span and large block starts on a SpanSize boundary with a header, so the header for any pointer the
+// heap handed out is found by masking off the low bits.
+static const size_t SpanSize = 65536;
+static const size_t SpanHeaderSize = 64;
+static const size_t BlockAlignment = 16;
+static const uint32 SpanMagic = 0x59544348;
+static const uint32 LargeSizeClass = 0xFFFFFFFF;
+
+// 16 byte steps up to 128, then four classes between each power of two up to MaxSmallSize
+static const uint32 LinearSizeClassCount = 8;
+static const uint32 SizeClassCount = 32;
+
+struct SpanHeader
+{
+  uint32 Magic;
+  uint32 SizeClass;
+
+  // block size for small spans, bytes after the header for large blocks
+  size_t BlockSize;
+
+  // every small span, so they stay reachable while all their blocks are free
+  SpanHeader* pNext;
+};
+
+// The locks are constant initialized so the heap works before static constructors have run. They only guard
+// moving a batch of blocks, so spinning beats sleeping.
+struct CentralList
+{
+  SpinLock Lock;
+  void* pHead = nullptr;
+  size_t Count = 0;
+};
+
+struct ThreadCache
+{
+  void* pFreeLists[SizeClassCount];
+  uint32 FreeCounts[SizeClassCount];
+};
+
+static CentralList s_centralLists[SizeClassCount];
+static SpinLock s_spanListLock;
+static SpanHeader* s_pSpans;
+static uint32 s_spanCount;
+static Y_ATOMIC_DECL int32 s_largeAllocationCount;
+
+Y_DECLARE_THREAD_LOCAL(ThreadCache*) s_pThreadCache = nullptr;
+
+static void* SystemAlignedAlloc(size_t size, size_t alignment)
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  return _aligned_malloc(size, alignment);
+#else
+  void* ptr;
+  return (posix_memalign(&ptr, alignment, size) == 0) ? ptr : nullptr;
+#endif
+}
+
+static void SystemAlignedFree(void* ptr)
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  _aligned_free(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+
+static inline void*& NextBlock(void* pBlock)
+{
+  return *reinterpret_cast<void**>(pBlock);
+}
+
+static inline SpanHeader* GetSpanHeader(const void* pMemory)
+{
+  SpanHeader* pHeader = reinterpret_cast<SpanHeader*>(reinterpret_cast<uintptr_t>(pMemory) & ~(SpanSize - 1));
+  DebugAssert(pHeader->Magic == SpanMagic);
+  return pHeader;
+}
+
+static inline byte* GetSpanData(SpanHeader* pHeader)
+{
+  return reinterpret_cast<byte*>(pHeader) + SpanHeaderSize;
+}
+
+static inline uint32 GetSizeClass(size_t size)
+{
+  if (size <= 128)
+    return (size <= BlockAlignment) ? 0 : (uint32)((size + BlockAlignment - 1) / BlockAlignment - 1);
+
+  uint32 topBit;
+  Y_bitscanreverse((uint32)(size - 1), &topBit);
+  uint32 step = (uint32)((size - 1) >> (topBit - 2)) & 3;
+  return LinearSizeClassCount + (topBit - 7) * 4 + step;
+}
+
+static inline size_t GetSizeClassBlockSize(uint32 sizeClass)
+{
+  if (sizeClass < LinearSizeClassCount)
+    return (sizeClass + 1) * BlockAlignment;
+
+  uint32 topBit = (sizeClass - LinearSizeClassCount) / 4 + 7;
+  uint32 step = (sizeClass - LinearSizeClassCount) & 3;
+  return (size_t)(5 + step) << (topBit - 2);
+}
+
+// blocks moved between a thread cache and the shared list at once, roughly 16KB worth
+static inline uint32 GetBatchCount(uint32 sizeClass)
+{
+  size_t count = 16384 / GetSizeClassBlockSize(sizeClass);
+  return (uint32)Max(Min(count, (size_t)64), (size_t)4);
+}
+
+static ThreadCache* GetThreadCache()
+{
+  ThreadCache* pCache = s_pThreadCache;
+  if (pCache == nullptr)
+  {
+    // from the system heap, the cache can't come from itself
+    pCache = reinterpret_cast<ThreadCache*>(std::calloc(1, sizeof(ThreadCache)));
+    if (pCache == nullptr)
+      Panic("failed to allocate thread heap cache");
+
+    s_pThreadCache = pCache;
+  }
+
+  return pCache;
+}
+
+// carves a new span into blocks, the first takeCount go to the cache and the rest to the shared list
+static bool AllocateSpan(ThreadCache* pCache, uint32 sizeClass, uint32 takeCount)
+{
+  SpanHeader* pHeader = reinterpret_cast<SpanHeader*>(SystemAlignedAlloc(SpanSize, SpanSize));
+  if (pHeader == nullptr)
+    return false;
+
+  size_t blockSize = GetSizeClassBlockSize(sizeClass);
+  uint32 blockCount = (uint32)((SpanSize - SpanHeaderSize) / blockSize);
+  pHeader->Magic = SpanMagic;
+  pHeader->SizeClass = sizeClass;
+  pHeader->BlockSize = blockSize;
+
+  byte* pData = GetSpanData(pHeader);
+  for (uint32 i = 0; i < blockCount - 1; i++)
+    NextBlock(pData + i * blockSize) = pData + (i + 1) * blockSize;
+  NextBlock(pData + (blockCount - 1) * blockSize) = nullptr;
+
+  takeCount = Min(takeCount, blockCount);
+  void* pTail = pData + (takeCount - 1) * blockSize;
+  NextBlock(pTail) = pCache->pFreeLists[sizeClass];
+  pCache->pFreeLists[sizeClass] = pData;
+  pCache->FreeCounts[sizeClass] += takeCount;
+
+  s_spanListLock.Lock();
+  pHeader->pNext = s_pSpans;
+  s_pSpans = pHeader;
+  s_spanCount++;
+  s_spanListLock.Unlock();
+
+  if (takeCount < blockCount)
+  {
+    void* pRestHead = pData + takeCount * blockSize;
+    void* pRestTail = pData + (blockCount - 1) * blockSize;
+    CentralList& list = s_centralLists[sizeClass];
+    list.Lock.Lock();
+    NextBlock(pRestTail) = list.pHead;
+    list.pHead = pRestHead;
+    list.Count += blockCount - takeCount;
+    list.Lock.Unlock();
+  }
+
+  return true;
+}
+
+static bool FillThreadCache(ThreadCache* pCache, uint32 sizeClass)
+{
+  CentralList& list = s_centralLists[sizeClass];
+  uint32 batchCount = GetBatchCount(sizeClass);
+
+  list.Lock.Lock();
+  if (list.Count == 0)
+  {
+    list.Lock.Unlock();
+    return AllocateSpan(pCache, sizeClass, batchCount);
+  }
+
+  uint32 count = (uint32)Min(list.Count, (size_t)batchCount);
+  void* pHead = list.pHead;
+  void* pTail = pHead;
+  for (uint32 i = 1; i < count; i++)
+    pTail = NextBlock(pTail);
+
+  list.pHead = NextBlock(pTail);
+  list.Count -= count;
+  list.Lock.Unlock();
+
+  NextBlock(pTail) = pCache->pFreeLists[sizeClass];
+  pCache->pFreeLists[sizeClass] = pHead;
+  pCache->FreeCounts[sizeClass] += count;
+  return true;
+}
+
+static void ReleaseCachedBlocks(ThreadCache* pCache, uint32 sizeClass, uint32 count)
+{
+  if (count == 0)
+    return;
+
+  void* pHead = pCache->pFreeLists[sizeClass];
+  void* pTail = pHead;
+  for (uint32 i = 1; i < count; i++)
+    pTail = NextBlock(pTail);
+
+  pCache->pFreeLists[sizeClass] = NextBlock(pTail);
+  pCache->FreeCounts[sizeClass] -= count;
+
+  CentralList& list = s_centralLists[sizeClass];
+  list.Lock.Lock();
+  NextBlock(pTail) = list.pHead;
+  list.pHead = pHead;
+  list.Count += count;
+  list.Lock.Unlock();
+}
+
+static void* AllocateSmall(uint32 sizeClass)
+{
+  ThreadCache* pCache = GetThreadCache();
+  if (pCache->pFreeLists[sizeClass] == nullptr && !FillThreadCache(pCache, sizeClass))
+    return nullptr;
+
+  void* pBlock = pCache->pFreeLists[sizeClass];
+  pCache->pFreeLists[sizeClass] = NextBlock(pBlock);
+  pCache->FreeCounts[sizeClass]--;
+  return pBlock;
+}
+
+static void* AllocateLarge(size_t size, size_t alignment)
+{
+  // the block must start within the first SpanSize bytes for the header to be found
+  size_t padding = (alignment > SpanHeaderSize) ? (alignment - SpanHeaderSize) : 0;
+  if (size > SIZE_MAX - SpanHeaderSize - padding)
+    return nullptr;
+
+  SpanHeader* pHeader = reinterpret_cast<SpanHeader*>(SystemAlignedAlloc(SpanHeaderSize + padding + size, SpanSize));
+  if (pHeader == nullptr)
+    return nullptr;
+
+  pHeader->Magic = SpanMagic;
+  pHeader->SizeClass = LargeSizeClass;
+  pHeader->BlockSize = padding + size;
+  pHeader->pNext = nullptr;
+  Y_AtomicIncrement(s_largeAllocationCount);
+
+  return GetSpanData(pHeader) + padding;
+}
+
+// start of the block containing pMemory, which is further in for over-aligned allocations
+static inline byte* GetBlockStart(SpanHeader* pHeader, const void* pMemory)
+{
+  byte* pData = GetSpanData(pHeader);
+  if (pHeader->SizeClass == LargeSizeClass)
+    return pData;
+
+  size_t offset = reinterpret_cast<const byte*>(pMemory) - pData;
+  return pData + (offset / pHeader->BlockSize) * pHeader->BlockSize;
+}
+
+void* ThreadCachedHeap::Allocate(size_t size)
+{
+  if (size > MaxSmallSize)
+    return AllocateLarge(size, BlockAlignment);
+
+  return AllocateSmall(GetSizeClass(size));
+}
+
+void* ThreadCachedHeap::AllocateAligned(size_t size, size_t alignment)
+{
+  DebugAssert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  Assert(alignment <= MaxAlignment);
+  if (alignment <= BlockAlignment)
+    return Allocate(size);
+
+  // small blocks are only 16 byte aligned, so take a bigger one and align within it
+  size_t paddedSize = size + alignment - BlockAlignment;
+  if (paddedSize > MaxSmallSize)
+    return AllocateLarge(size, alignment);
+
+  byte* pBlock = reinterpret_cast<byte*>(AllocateSmall(GetSizeClass(paddedSize)));
+  if (pBlock == nullptr)
+    return nullptr;
+
+  return reinterpret_cast<void*>((reinterpret_cast<uintptr_t>(pBlock) + alignment - 1) & ~(alignment - 1));
+}
+
+void* ThreadCachedHeap::Reallocate(void* pMemory, size_t size)
+{
+  return ReallocateAligned(pMemory, size, BlockAlignment);
+}
+
+void* ThreadCachedHeap::ReallocateAligned(void* pMemory, size_t size, size_t alignment)
+{
+  if (pMemory == nullptr)
+    return AllocateAligned(size, alignment);
+
+  if (size == 0)
+  {
+    Free(pMemory);
+    return nullptr;
+  }
+
+  // stay put unless growing, or shrinking to less than about half the block
+  size_t usableSize = GetUsableSize(pMemory);
+  if (size <= usableSize && (usableSize - size) <= Max(usableSize / 2, BlockAlignment) &&
+      (reinterpret_cast<uintptr_t>(pMemory) & (alignment - 1)) == 0)
+  {
+    return pMemory;
+  }
+
+  void* pNewMemory = AllocateAligned(size, alignment);
+  if (pNewMemory == nullptr)
+    return nullptr;
+
+  std::memcpy(pNewMemory, pMemory, Min(size, usableSize));
+  Free(pMemory);
+  return pNewMemory;
+}
+
+void ThreadCachedHeap::Free(void* pMemory)
+{
+  if (pMemory == nullptr)
+    return;
+
+  SpanHeader* pHeader = GetSpanHeader(pMemory);
+  if (pHeader->SizeClass == LargeSizeClass)
+  {
+    Y_AtomicDecrement(s_largeAllocationCount);
+    SystemAlignedFree(pHeader);
+    return;
+  }
+
+  // goes in this thread's cache regardless of which thread allocated it
+  uint32 sizeClass = pHeader->SizeClass;
+  void* pBlock = GetBlockStart(pHeader, pMemory);
+  ThreadCache* pCache = GetThreadCache();
+  NextBlock(pBlock) = pCache->pFreeLists[sizeClass];
+  pCache->pFreeLists[sizeClass] = pBlock;
+  pCache->FreeCounts[sizeClass]++;
+
+  uint32 batchCount = GetBatchCount(sizeClass);
+  if (pCache->FreeCounts[sizeClass] >= batchCount * 2)
+    ReleaseCachedBlocks(pCache, sizeClass, batchCount);
+}
+
+size_t ThreadCachedHeap::GetUsableSize(const void* pMemory)
+{
+  SpanHeader* pHeader = GetSpanHeader(pMemory);
+  byte* pBlockStart = GetBlockStart(pHeader, pMemory);
+  return pHeader->BlockSize - (reinterpret_cast<const byte*>(pMemory) - pBlockStart);
+}
+
+void ThreadCachedHeap::FlushThreadCache()
+{
+  ThreadCache* pCache = s_pThreadCache;
+  if (pCache == nullptr)
+    return;
+
+  for (uint32 i = 0; i < SizeClassCount; i++)
+    ReleaseCachedBlocks(pCache, i, pCache->FreeCounts[i]);
+}
+
+void ThreadCachedHeap::ReleaseThreadCache()
+{
+  FlushThreadCache();
+  std::free(s_pThreadCache);
+  s_pThreadCache = nullptr;
+}
+
+void ThreadCachedHeap::GetStats(Stats* pStats)
+{
+  s_spanListLock.Lock();
+  pStats->SpanCount = s_spanCount;
+  s_spanListLock.Unlock();
+
+  pStats->SpanMemory = (size_t)pStats->SpanCount * SpanSize;
+  pStats->LargeAllocationCount = (uint32)s_largeAllocationCount;
+}
@@ -0,0 +1,289 @@
+#include "YBaseLib/ThreadLocal.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/SpinLock.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(Y_PLATFORM_WINDOWS)
+#include "YBaseLib/Windows/WindowsHeaders.h"
+#elif defined(Y_PLATFORM_POSIX) || defined(Y_PLATFORM_ANDROID)
+#include <pthread.h>
+#endif
+
+// One thread's value in one ThreadLocal, linked into the owner's list.
+struct ThreadLocalRecord
+{
+  ThreadLocalBase* pOwner;
+  struct ThreadLocalBlock* pBlock;
+  uint32 Slot;
+  void* pValue;
+  ThreadLocalBase::DestructFunction DestructFunction;
+  ThreadLocalRecord* pPrev;
+  ThreadLocalRecord* pNext;
+};
+
+// A thread's values, indexed by slot. Only the thread itself reads the arrays, but the owners' destructors clear
+// their entries from other threads, so writes and growth are done with the lock held.
+struct ThreadLocalBlock
+{
+  void** ppValues;
+  ThreadLocalRecord** ppRecords;
+  uint32 Capacity;
+};
+
+// rounds of destructors run on thread exit, for destructors that touch other ThreadLocals
+static const uint32 MaxReleaseRounds = 4;
+
+static SpinLock s_lock;
+static uint32 s_nextSlot = 0;
+static PODArray<uint32>* s_pFreeSlots = nullptr;
+
+Y_DECLARE_THREAD_LOCAL(ThreadLocalBlock*) s_pThreadBlock = nullptr;
+
+// The platform's TLS destructor for threads that weren't started by Thread.
+#if defined(Y_PLATFORM_WINDOWS)
+
+static DWORD s_flsIndex = FLS_OUT_OF_INDEXES;
+
+static void WINAPI ThreadBlockDestructor(void* pBlock)
+{
+  if (pBlock != nullptr)
+    ThreadLocalBase::ReleaseCurrentThreadValues();
+}
+
+static void SetPlatformThreadBlock(ThreadLocalBlock* pBlock)
+{
+  static const bool initialized = ((s_flsIndex = FlsAlloc(ThreadBlockDestructor)), true);
+  UNREFERENCED_PARAMETER(initialized);
+  if (s_flsIndex != FLS_OUT_OF_INDEXES)
+    FlsSetValue(s_flsIndex, pBlock);
+}
+
+#elif defined(Y_PLATFORM_POSIX) || defined(Y_PLATFORM_ANDROID)
+
+static pthread_key_t s_blockKey;
+static pthread_once_t s_blockKeyOnce = PTHREAD_ONCE_INIT;
+
+static void ThreadBlockDestructor(void* pBlock)
+{
+  // thread locals are still usable while pthread key destructors run
+  if (pBlock != nullptr)
+    ThreadLocalBase::ReleaseCurrentThreadValues();
+}
+
+static void CreateBlockKey()
+{
+  pthread_key_create(&s_blockKey, ThreadBlockDestructor);
+}
+
+static void SetPlatformThreadBlock(ThreadLocalBlock* pBlock)
+{
+  pthread_once(&s_blockKeyOnce, CreateBlockKey);
+  pthread_setspecific(s_blockKey, pBlock);
+}
+
+#else
+
+static void SetPlatformThreadBlock(ThreadLocalBlock* pBlock)
+{
+}
+
+#endif
+
+static ThreadLocalBlock* GetThreadBlock()
+{
+  ThreadLocalBlock* pBlock = s_pThreadBlock;
+  if (pBlock == nullptr)
+  {
+    pBlock = new ThreadLocalBlock();
+    pBlock->ppValues = nullptr;
+    pBlock->ppRecords = nullptr;
+    pBlock->Capacity = 0;
+    s_pThreadBlock = pBlock;
+    SetPlatformThreadBlock(pBlock);
+  }
+
+  return pBlock;
+}
+
+// grows the block to hold slot, call with the lock held
+static void ReserveBlockSlot(ThreadLocalBlock* pBlock, uint32 slot)
+{
+  if (slot < pBlock->Capacity)
+    return;
+
+  uint32 newCapacity = Max(pBlock->Capacity * 2, Max(slot + 1, (uint32)16));
+  void** ppValues = static_cast<void**>(std::calloc(newCapacity, sizeof(void*)));
+  ThreadLocalRecord** ppRecords = static_cast<ThreadLocalRecord**>(std::calloc(newCapacity, sizeof(void*)));
+  if (ppValues == nullptr || ppRecords == nullptr)
+    Panic("failed to allocate thread local storage");
+
+  if (pBlock->Capacity > 0)
+  {
+    std::memcpy(ppValues, pBlock->ppValues, sizeof(void*) * pBlock->Capacity);
+    std::memcpy(ppRecords, pBlock->ppRecords, sizeof(void*) * pBlock->Capacity);
+  }
+
+  std::free(pBlock->ppValues);
+  std::free(pBlock->ppRecords);
+  pBlock->ppValues = ppValues;
+  pBlock->ppRecords = ppRecords;
+  pBlock->Capacity = newCapacity;
+}
+
+// removes a record from its owner and block, call with the lock held
+static void DetachRecord(ThreadLocalRecord* pRecord, ThreadLocalRecord** ppOwnerRecords)
+{
+  if (pRecord->pPrev != nullptr)
+    pRecord->pPrev->pNext = pRecord->pNext;
+  else
+    *ppOwnerRecords = pRecord->pNext;
+  if (pRecord->pNext != nullptr)
+    pRecord->pNext->pPrev = pRecord->pPrev;
+
+  pRecord->pBlock->ppValues[pRecord->Slot] = nullptr;
+  pRecord->pBlock->ppRecords[pRecord->Slot] = nullptr;
+}
+
+ThreadLocalBase::~ThreadLocalBase()
+{
+  s_lock.Lock();
+
+  ThreadLocalRecord* pRecords = m_pRecords;
+  m_pRecords = nullptr;
+  for (ThreadLocalRecord* pRecord = pRecords; pRecord != nullptr; pRecord = pRecord->pNext)
+  {
+    pRecord->pBlock->ppValues[pRecord->Slot] = nullptr;
+    pRecord->pBlock->ppRecords[pRecord->Slot] = nullptr;
+  }
+
+  if (m_slot != InvalidSlot)
+  {
+    s_pFreeSlots->Add(uint32(m_slot));
+    m_slot = InvalidSlot;
+  }
+
+  s_lock.Unlock();
+
+  // other threads' values are destroyed on this one, so nothing may still be using them
+  while (pRecords != nullptr)
+  {
+    ThreadLocalRecord* pNext = pRecords->pNext;
+    pRecords->DestructFunction(pRecords->pValue);
+    delete pRecords;
+    pRecords = pNext;
+  }
+}
+
+void* ThreadLocalBase::PeekValue() const
+{
+  ThreadLocalBlock* pBlock = s_pThreadBlock;
+  uint32 slot = m_slot;
+  return (pBlock != nullptr && slot < pBlock->Capacity) ? pBlock->ppValues[slot] : nullptr;
+}
+
+void* ThreadLocalBase::CreateValue()
+{
+  // slots are handed out on first use, so a ThreadLocal that's never touched doesn't take one
+  if (m_slot == InvalidSlot)
+  {
+    s_lock.Lock();
+    if (m_slot == InvalidSlot)
+    {
+      if (s_pFreeSlots == nullptr)
+        s_pFreeSlots = new PODArray<uint32>();
+
+      Y_AtomicStore(m_slot, (s_pFreeSlots->GetSize() > 0) ? s_pFreeSlots->PopBack() : s_nextSlot++);
+    }
+    s_lock.Unlock();
+  }
+
+  // constructed without the lock, in case the constructor uses another ThreadLocal
+  void* pValue = m_constructFunction();
+  ThreadLocalBlock* pBlock = GetThreadBlock();
+
+  ThreadLocalRecord* pRecord = new ThreadLocalRecord();
+  pRecord->pOwner = this;
+  pRecord->pBlock = pBlock;
+  pRecord->Slot = m_slot;
+  pRecord->pValue = pValue;
+  pRecord->DestructFunction = m_destructFunction;
+  pRecord->pPrev = nullptr;
+
+  s_lock.Lock();
+  ReserveBlockSlot(pBlock, pRecord->Slot);
+  DebugAssert(pBlock->ppRecords[pRecord->Slot] == nullptr);
+  pBlock->ppValues[pRecord->Slot] = pValue;
+  pBlock->ppRecords[pRecord->Slot] = pRecord;
+  pRecord->pNext = m_pRecords;
+  if (m_pRecords != nullptr)
+    m_pRecords->pPrev = pRecord;
+  m_pRecords = pRecord;
+  s_lock.Unlock();
+
+  return pValue;
+}
+
+void ThreadLocalBase::ReleaseValue()
+{
+  ThreadLocalBlock* pBlock = s_pThreadBlock;
+  if (pBlock == nullptr || m_slot >= pBlock->Capacity)
+    return;
+
+  s_lock.Lock();
+  ThreadLocalRecord* pRecord = pBlock->ppRecords[m_slot];
+  if (pRecord != nullptr)
+    DetachRecord(pRecord, &m_pRecords);
+  s_lock.Unlock();
+
+  if (pRecord != nullptr)
+  {
+    pRecord->DestructFunction(pRecord->pValue);
+    delete pRecord;
+  }
+}
+
+void ThreadLocalBase::ReleaseCurrentThreadValues()
+{
+  ThreadLocalBlock* pBlock = s_pThreadBlock;
+  if (pBlock == nullptr)
+    return;
+
+  for (uint32 round = 0; round <= MaxReleaseRounds; round++)
+  {
+    ThreadLocalRecord* pRecords = nullptr;
+    s_lock.Lock();
+    for (uint32 i = 0; i < pBlock->Capacity; i++)
+    {
+      ThreadLocalRecord* pRecord = pBlock->ppRecords[i];
+      if (pRecord != nullptr)
+      {
+        DetachRecord(pRecord, &pRecord->pOwner->m_pRecords);
+        pRecord->pNext = pRecords;
+        pRecords = pRecord;
+      }
+    }
+    s_lock.Unlock();
+
+    if (pRecords == nullptr)
+      break;
+
+    // anything still being recreated after the last round is leaked rather than looping forever
+    while (pRecords != nullptr)
+    {
+      ThreadLocalRecord* pNext = pRecords->pNext;
+      if (round < MaxReleaseRounds)
+        pRecords->DestructFunction(pRecords->pValue);
+      delete pRecords;
+      pRecords = pNext;
+    }
+  }
+
+  SetPlatformThreadBlock(nullptr);
+  s_pThreadBlock = nullptr;
+  std::free(pBlock->ppValues);
+  std::free(pBlock->ppRecords);
+  delete pBlock;
+}
@@ -1,17 +1,47 @@
 #include "YBaseLib/ThreadPool.h"
 #include "YBaseLib/CPUID.h"
 #include "YBaseLib/Log.h"
+#include "YBaseLib/Profiler.h"
+#include "YBaseLib/String.h"
 #include "YBaseLib/Timer.h"
 Log_SetChannel(ThreadPool);
 
-ThreadPool::ThreadPool(uint32 workerThreadCount /* = GetDefaultWorkerThreadCount */)
-  : m_nWorkerThreads(workerThreadCount), m_bExitThreads(false)
+// Worker thread the current thread belongs to, if any.
+Y_DECLARE_THREAD_LOCAL(ThreadPoolWorkerThread*) s_pCurrentWorkerThread = nullptr;
+
+// Number of random victims a worker tries before searching every deque in order.
+static const uint32 STEAL_ATTEMPTS = 4;
+
+// Workers search the priorities lowest first once every this many fetches.
+static const uint32 STARVATION_INTERVAL = 16;
+
+// Elastic pools grow for a backlog once there are more than this many queued items for each worker free to run
+// them, and by no more than one worker per interval.
+static const uint32 BACKLOG_ITEMS_PER_WORKER = 2;
+static const double BACKLOG_SPAWN_INTERVAL_MS = 5.0;
+
+ThreadPool::ThreadPool(uint32 workerThreadCount /* = GetDefaultWorkerThreadCount */,
+                       THREADPOOL_AFFINITY affinity /* = THREADPOOL_AFFINITY_DEFAULT */,
+                       uint32 maxWorkerThreadCount /* = 0 */)
+  : m_nWorkerThreads(workerThreadCount), m_maxWorkerThreads(Max(workerThreadCount, maxWorkerThreadCount)),
+    m_createdWorkerCount(0), m_affinity(ResolveAffinity(affinity)), m_bExitThreads(false), m_deadlineItemCount(0),
+    m_idlePolicy(WorkerIdlePolicy::Park()), m_lastWakeRequestTime(0), m_statsEnabled(false), m_statsStartTime(0),
+    m_runningWorkerCount(0), m_blockedWorkerCount(0), m_idleTimeout(10000), m_lastSpawnTime(0),
+    m_sleepingWorkerCount(0)
 {
   Assert(workerThreadCount > 0);
+  m_WorkQueueLock.SetProfileName("threadpool.work_queue");
 
-  // resize and null worker threads
-  m_WorkerThreads.Resize(workerThreadCount);
-  Y_memzero(m_WorkerThreads.GetBasePointer(), sizeof(ThreadPoolWorkerThread*) * workerThreadCount);
+  for (uint32 i = 0; i < THREADPOOL_PRIORITY_COUNT; i++)
+  {
+    m_priorityQueues[i].InjectionQueueHead = 0;
+    m_priorityQueues[i].InjectionQueueSize = 0;
+    m_priorityQueues[i].PendingCount = 0;
+  }
+
+  // resize and null worker threads, the slots never move once workers can steal from them
+  m_WorkerThreads.Resize(m_maxWorkerThreads);
+  Y_memzero(m_WorkerThreads.GetBasePointer(), sizeof(ThreadPoolWorkerThread*) * m_maxWorkerThreads);
 
   // start worker threads
   StartWorkerThreads();
@@ -24,15 +54,22 @@ ThreadPool::~ThreadPool()
 
 void ThreadPool::StartWorkerThreads()
 {
-  // spawn worker threads
+  // create all workers before starting any, since they may steal from each other immediately
   for (uint32 i = 0; i < m_nWorkerThreads; i++)
   {
-    ThreadPoolWorkerThread* pWorkerThread = new ThreadPoolWorkerThread(this);
-
     DebugAssert(m_WorkerThreads[i] == nullptr);
-    m_WorkerThreads[i] = pWorkerThread;
+    m_WorkerThreads[i] =
+      new ThreadPoolWorkerThread(this, i, GetWorkerAffinityMask(m_affinity, i, m_nWorkerThreads));
+  }
+  MemoryBarrier();
+  m_createdWorkerCount = m_nWorkerThreads;
+  m_runningWorkerCount = m_nWorkerThreads;
 
-    pWorkerThread->Start(false);
+  // spawn worker threads
+  for (uint32 i = 0; i < m_nWorkerThreads; i++)
+  {
+    m_WorkerThreads[i]->m_needsJoin = true;
+    m_WorkerThreads[i]->Start(false);
   }
 }
 
@@ -46,11 +83,13 @@ void ThreadPool::StopWorkerThreads()
   {
     uint32 activeThreads = 0;
 
+    m_WorkQueueLock.Lock();
     m_WorkQueueConditionVariable.WakeAll();
+    m_WorkQueueLock.Unlock();
 
-    for (uint32 i = 0; i < m_nWorkerThreads; i++)
+    for (uint32 i = 0; i < m_createdWorkerCount; i++)
     {
-      if (m_WorkerThreads[i] != NULL && m_WorkerThreads[i]->IsRunning())
+      if (m_WorkerThreads[i]->IsRunning())
         activeThreads++;
     }
 
@@ -60,78 +99,571 @@ void ThreadPool::StopWorkerThreads()
     Thread::Sleep(1);
   }
 
-  // join & delete all threads
-  for (uint32 i = 0; i < m_nWorkerThreads; i++)
+  // join & delete all threads, retired ones included
+  for (uint32 i = 0; i < m_createdWorkerCount; i++)
   {
     if (m_WorkerThreads[i] != nullptr)
     {
-      m_WorkerThreads[i]->Join();
+      if (m_WorkerThreads[i]->m_needsJoin)
+        m_WorkerThreads[i]->Join();
+#ifdef Y_BUILD_CONFIG_DEBUG
+      for (uint32 priority = 0; priority < THREADPOOL_PRIORITY_COUNT; priority++)
+        DebugAssert(m_WorkerThreads[i]->m_workDeques[priority].IsEmpty());
+#endif
       delete m_WorkerThreads[i];
       m_WorkerThreads[i] = nullptr;
     }
   }
 
+  m_createdWorkerCount = 0;
+  m_runningWorkerCount = 0;
   m_bExitThreads = false;
   MemoryBarrier();
 }
 
-void ThreadPool::EnqueueWorkItem(ThreadPoolWorkItem* pWorkItem)
+bool ThreadPool::SpawnWorkerThread()
+{
+  if (m_runningWorkerCount >= m_maxWorkerThreads || m_bExitThreads)
+    return false;
+
+  // a retired worker's thread has finished with the lock once it's marked, so joining here can't deadlock
+  ThreadPoolWorkerThread* pWorkerThread = nullptr;
+  for (uint32 i = 0; i < m_createdWorkerCount; i++)
+  {
+    if (m_WorkerThreads[i]->m_retired)
+    {
+      pWorkerThread = m_WorkerThreads[i];
+      if (pWorkerThread->m_needsJoin)
+      {
+        pWorkerThread->Join();
+        pWorkerThread->m_needsJoin = false;
+      }
+      break;
+    }
+  }
+
+  if (pWorkerThread == nullptr)
+  {
+    // extra workers are placed as the first ones were
+    uint32 index = m_createdWorkerCount;
+    DebugAssert(index < m_maxWorkerThreads);
+    pWorkerThread = new ThreadPoolWorkerThread(
+      this, index, GetWorkerAffinityMask(m_affinity, index % m_nWorkerThreads, m_nWorkerThreads));
+    pWorkerThread->m_retired = true;
+    m_WorkerThreads[index] = pWorkerThread;
+    MemoryBarrier();
+    m_createdWorkerCount = index + 1;
+  }
+
+  if (!pWorkerThread->Start(false))
+  {
+    Log_WarningPrintf("Failed to start thread pool worker %u", pWorkerThread->m_workerIndex);
+    return false;
+  }
+
+  pWorkerThread->m_retired = false;
+  pWorkerThread->m_needsJoin = true;
+  m_runningWorkerCount++;
+  return true;
+}
+
+void ThreadPool::GrowForBacklog()
 {
+  // Workers that are blocked don't count as free. A pool short of its worker count because of them grows as soon as
+  // anything is queued, otherwise only for a real backlog, and not again until the interval has passed.
+  uint32 runningWorkerCount = m_runningWorkerCount;
+  uint32 blockedWorkerCount = m_blockedWorkerCount;
+  if (runningWorkerCount >= m_maxWorkerThreads)
+    return;
+
+  uint32 freeWorkerCount = (runningWorkerCount > blockedWorkerCount) ? (runningWorkerCount - blockedWorkerCount) : 0;
+  uint32 queueDepth = GetQueueDepth();
+  bool compensate = (freeWorkerCount < m_nWorkerThreads && queueDepth > 0);
+  if (!compensate && queueDepth <= freeWorkerCount * BACKLOG_ITEMS_PER_WORKER)
+    return;
+
+  Y_TIMER_VALUE currentTime = Y_TimerGetValue();
+  if (!compensate && Y_TimerConvertToMilliseconds(currentTime - m_lastSpawnTime) < BACKLOG_SPAWN_INTERVAL_MS)
+    return;
+
+  // someone may have got there first
   m_WorkQueueLock.Lock();
+  if (m_sleepingWorkerCount == 0 && (compensate || Y_TimerConvertToMilliseconds(currentTime - m_lastSpawnTime) >=
+                                                      BACKLOG_SPAWN_INTERVAL_MS))
+  {
+    m_lastSpawnTime = currentTime;
+    SpawnWorkerThread();
+  }
+  m_WorkQueueLock.Unlock();
+}
+
+void ThreadPool::SetIdleTimeout(uint32 milliseconds)
+{
+  // sleeping workers pick it up the next time they wake
+  m_WorkQueueLock.Lock();
+  m_idleTimeout = milliseconds;
+  m_WorkQueueLock.Unlock();
+}
+
+void ThreadPool::BeginBlockingRegion()
+{
+  ThreadPoolWorkerThread* pWorkerThread = s_pCurrentWorkerThread;
+  if (pWorkerThread == nullptr || pWorkerThread->m_blockingDepth++ > 0)
+    return;
+
+  ThreadPool* pThreadPool = pWorkerThread->m_pThreadPool;
+  Y_AtomicIncrement(pThreadPool->m_blockedWorkerCount);
+
+  // anything already queued behind this worker needs someone else to run it
+  MemoryBarrier();
+  if (pThreadPool->m_sleepingWorkerCount > 0)
+  {
+    if (pThreadPool->HasPendingWork())
+      pThreadPool->WakeSleepingWorkers(1);
+  }
+  else if (pThreadPool->IsElastic())
+  {
+    pThreadPool->GrowForBacklog();
+  }
+}
 
+void ThreadPool::EndBlockingRegion()
+{
+  ThreadPoolWorkerThread* pWorkerThread = s_pCurrentWorkerThread;
+  if (pWorkerThread == nullptr)
+    return;
+
+  DebugAssert(pWorkerThread->m_blockingDepth > 0);
+  if (--pWorkerThread->m_blockingDepth == 0)
+    Y_AtomicDecrement(pWorkerThread->m_pThreadPool->m_blockedWorkerCount);
+}
+
+void ThreadPool::EnqueueWorkItem(ThreadPoolWorkItem* pWorkItem)
+{
   pWorkItem->AddRef();
-  m_WorkItemQueue.Add(pWorkItem);
+  pWorkItem->m_queueTime = m_statsEnabled ? Y_TimerGetValue() : 0;
 
-  m_WorkQueueConditionVariable.Wake();
+  // workers of this pool push to their own deque without taking any locks
+  ThreadPoolWorkerThread* pWorkerThread = s_pCurrentWorkerThread;
+  if (pWorkerThread != nullptr && pWorkerThread->m_pThreadPool != this)
+    pWorkerThread = nullptr;
 
-  m_WorkQueueLock.Unlock();
+  PushWorkItem(pWorkItem, pWorkerThread);
+
+  // the push must be visible before we check for sleepers, see ThreadGetNextWorkItem
+  MemoryBarrier();
+  if (m_sleepingWorkerCount > 0)
+    WakeSleepingWorkers(1);
+  else if (IsElastic())
+    GrowForBacklog();
+}
+
+void ThreadPool::EnqueueWorkItems(ThreadPoolWorkItem** ppWorkItems, uint32 count)
+{
+  if (count == 0)
+    return;
+
+  Y_TIMER_VALUE queueTime = m_statsEnabled ? Y_TimerGetValue() : 0;
+  for (uint32 i = 0; i < count; i++)
+  {
+    ppWorkItems[i]->AddRef();
+    ppWorkItems[i]->m_queueTime = queueTime;
+  }
+
+  ThreadPoolWorkerThread* pWorkerThread = s_pCurrentWorkerThread;
+  if (pWorkerThread != nullptr && pWorkerThread->m_pThreadPool == this)
+  {
+    for (uint32 i = 0; i < count; i++)
+      PushWorkItem(ppWorkItems[i], pWorkerThread);
+  }
+  else
+  {
+    m_WorkQueueLock.Lock();
+    for (uint32 i = 0; i < count; i++)
+    {
+      Y_AtomicIncrement(m_priorityQueues[ppWorkItems[i]->m_priority].PendingCount);
+      PushSharedWorkItem(ppWorkItems[i]);
+    }
+    m_WorkQueueLock.Unlock();
+  }
+
+  // same ordering as EnqueueWorkItem
+  MemoryBarrier();
+  if (m_sleepingWorkerCount > 0)
+    WakeSleepingWorkers(count);
+  else if (IsElastic())
+    GrowForBacklog();
 }
 
 bool ThreadPool::ShouldYieldToOtherTask()
 {
-  bool result;
+  ThreadPoolWorkerThread* pWorkerThread = s_pCurrentWorkerThread;
+  if (pWorkerThread == nullptr || pWorkerThread->m_pThreadPool != this)
+    return HasPendingWork();
+
+  for (uint32 priority = 0; priority < pWorkerThread->m_currentPriority; priority++)
+  {
+    if (m_priorityQueues[priority].PendingCount > 0)
+      return true;
+  }
+
+  return (m_deadlineItemCount > 0 && HasOverdueWorkItem());
+}
+
+void ThreadPool::SetIdlePolicy(const WorkerIdlePolicy& policy)
+{
+  // workers read the policy each time they go idle
   m_WorkQueueLock.Lock();
-  result = !m_WorkItemQueue.IsEmpty();
+  m_idlePolicy = policy;
   m_WorkQueueLock.Unlock();
-  return result;
 }
 
-ThreadPoolWorkItem* ThreadPool::ThreadGetNextWorkItem()
+WorkerIdleStats ThreadPool::GetIdleStats() const
 {
-  ThreadPoolWorkItem* pWorkItem;
+  WorkerIdleStats stats;
+  for (uint32 i = 0; i < m_createdWorkerCount; i++)
+  {
+    if (m_WorkerThreads[i] != nullptr)
+      stats.Accumulate(m_WorkerThreads[i]->m_idleStats);
+  }
+
+  return stats;
+}
+
+void ThreadPool::SetStatsEnabled(bool enabled)
+{
+  m_WorkQueueLock.Lock();
+  if (enabled && m_statsStartTime == 0)
+    m_statsStartTime = Y_TimerGetValue();
+
+  m_statsEnabled = enabled;
+  m_WorkQueueLock.Unlock();
+}
+
+SchedulerStats ThreadPool::GetStats() const
+{
+  SchedulerStats stats;
+  stats.WorkerCount = m_runningWorkerCount;
+  stats.QueueDepth = GetQueueDepth();
+  stats.ElapsedTime = (m_statsStartTime != 0) ? (Y_TimerGetValue() - m_statsStartTime) : 0;
+  for (uint32 i = 0; i < m_createdWorkerCount; i++)
+  {
+    if (m_WorkerThreads[i] != nullptr)
+      stats.Totals.Accumulate(m_WorkerThreads[i]->m_schedulerStats);
+  }
+
+  return stats;
+}
+
+uint32 ThreadPool::GetQueueDepth() const
+{
+  uint32 depth = 0;
+  for (uint32 i = 0; i < THREADPOOL_PRIORITY_COUNT; i++)
+    depth += m_priorityQueues[i].PendingCount;
+
+  return depth;
+}
+
+void ThreadPool::PushWorkItem(ThreadPoolWorkItem* pWorkItem, ThreadPoolWorkerThread* pWorkerThread)
+{
+  // counted first, so anyone that misses the item in its queue still sees that work is pending
+  Y_AtomicIncrement(m_priorityQueues[pWorkItem->m_priority].PendingCount);
+
+  // items with deadlines have to be visible to every worker to be ordered
+  if (pWorkerThread != nullptr && !pWorkItem->m_hasDeadline)
+  {
+    pWorkerThread->m_workDeques[pWorkItem->m_priority].Push(pWorkItem);
+    return;
+  }
 
   m_WorkQueueLock.Lock();
+  PushSharedWorkItem(pWorkItem);
+  m_WorkQueueLock.Unlock();
+}
+
+// The deadline heaps keep the earliest deadline at the front.
+static bool CompareWorkItemDeadlines(const ThreadPoolWorkItem* pLeft, const ThreadPoolWorkItem* pRight)
+{
+  return (pLeft->GetDeadline() > pRight->GetDeadline());
+}
 
-  if (m_WorkItemQueue.GetSize() > 0)
+void ThreadPool::PushSharedWorkItem(ThreadPoolWorkItem* pWorkItem)
+{
+  PriorityQueue& queue = m_priorityQueues[pWorkItem->m_priority];
+  if (pWorkItem->m_hasDeadline)
+  {
+    queue.DeadlineHeap.Add(pWorkItem);
+    std::push_heap(queue.DeadlineHeap.GetBasePointer(),
+                   queue.DeadlineHeap.GetBasePointer() + queue.DeadlineHeap.GetSize(), CompareWorkItemDeadlines);
+    Y_AtomicIncrement(m_deadlineItemCount);
+  }
+  else
   {
-    pWorkItem = m_WorkItemQueue.PopFront();
+    queue.InjectionQueue.Add(pWorkItem);
+    Y_AtomicIncrement(queue.InjectionQueueSize);
+  }
+}
+
+ThreadPoolWorkItem* ThreadPool::PopInjectionQueue(uint32 priority)
+{
+  PriorityQueue& queue = m_priorityQueues[priority];
+  if (queue.InjectionQueueHead == queue.InjectionQueue.GetSize())
+    return nullptr;
+
+  ThreadPoolWorkItem* pWorkItem = queue.InjectionQueue[queue.InjectionQueueHead++];
+  Y_AtomicDecrement(queue.InjectionQueueSize);
+
+  // reset the queue once everything has been consumed, rather than shifting the array on every pop
+  if (queue.InjectionQueueHead == queue.InjectionQueue.GetSize())
+  {
+    queue.InjectionQueue.Clear();
+    queue.InjectionQueueHead = 0;
+  }
+
+  return pWorkItem;
+}
+
+ThreadPoolWorkItem* ThreadPool::PopDeadlineHeap(uint32 priority)
+{
+  PriorityQueue& queue = m_priorityQueues[priority];
+  if (queue.DeadlineHeap.IsEmpty())
+    return nullptr;
+
+  std::pop_heap(queue.DeadlineHeap.GetBasePointer(),
+                queue.DeadlineHeap.GetBasePointer() + queue.DeadlineHeap.GetSize(), CompareWorkItemDeadlines);
+
+  ThreadPoolWorkItem* pWorkItem = queue.DeadlineHeap.PopBack();
+  Y_AtomicDecrement(m_deadlineItemCount);
+  return pWorkItem;
+}
+
+ThreadPoolWorkItem* ThreadPool::PopOverdueWorkItem(Y_TIMER_VALUE currentTime)
+{
+  // highest priority first, the front of each heap is its most urgent item
+  for (uint32 priority = 0; priority < THREADPOOL_PRIORITY_COUNT; priority++)
+  {
+    const PODArray<ThreadPoolWorkItem*>& heap = m_priorityQueues[priority].DeadlineHeap;
+    if (!heap.IsEmpty() && heap[0]->m_deadline <= currentTime)
+      return PopDeadlineHeap(priority);
+  }
+
+  return nullptr;
+}
+
+bool ThreadPool::HasOverdueWorkItem()
+{
+  Y_TIMER_VALUE currentTime = Y_TimerGetValue();
+  bool result = false;
+
+  m_WorkQueueLock.Lock();
+  for (uint32 priority = 0; priority < THREADPOOL_PRIORITY_COUNT && !result; priority++)
+  {
+    const PODArray<ThreadPoolWorkItem*>& heap = m_priorityQueues[priority].DeadlineHeap;
+    result = (!heap.IsEmpty() && heap[0]->m_deadline <= currentTime);
+  }
+  m_WorkQueueLock.Unlock();
+
+  return result;
+}
+
+ThreadPoolWorkItem* ThreadPool::FindWorkItem(ThreadPoolWorkerThread* pWorkerThread)
+{
+  ThreadPoolWorkItem* pWorkItem = nullptr;
+
+  // anything past its deadline goes first, whatever its priority
+  if (m_deadlineItemCount > 0)
+  {
+    Y_TIMER_VALUE currentTime = Y_TimerGetValue();
+    m_WorkQueueLock.Lock();
+    pWorkItem = PopOverdueWorkItem(currentTime);
     m_WorkQueueLock.Unlock();
-    return pWorkItem;
   }
 
-  if (m_bExitThreads)
+  if (pWorkItem == nullptr)
+  {
+    // every so often search from the lowest priority up, so a steady stream of higher priority work can't starve it
+    bool lowestFirst = ((++pWorkerThread->m_fetchCount % STARVATION_INTERVAL) == 0);
+    for (uint32 i = 0; i < THREADPOOL_PRIORITY_COUNT && pWorkItem == nullptr; i++)
+    {
+      uint32 priority = (lowestFirst) ? (THREADPOOL_PRIORITY_COUNT - 1 - i) : i;
+      if (m_priorityQueues[priority].PendingCount > 0)
+        pWorkItem = FindWorkItemWithPriority(pWorkerThread, priority);
+    }
+  }
+
+  if (pWorkItem != nullptr)
+    Y_AtomicDecrement(m_priorityQueues[pWorkItem->m_priority].PendingCount);
+
+  return pWorkItem;
+}
+
+ThreadPoolWorkItem* ThreadPool::FindWorkItemWithPriority(ThreadPoolWorkerThread* pWorkerThread, uint32 priority)
+{
+  PriorityQueue& queue = m_priorityQueues[priority];
+  ThreadPoolWorkItem* pWorkItem;
+
+  // items with a deadline first, earliest first
+  if (m_deadlineItemCount > 0)
+  {
+    m_WorkQueueLock.Lock();
+    pWorkItem = PopDeadlineHeap(priority);
+    m_WorkQueueLock.Unlock();
+    if (pWorkItem != nullptr)
+      return pWorkItem;
+  }
+
+  // own deque next, newest item is the most likely to be hot in cache
+  pWorkItem = pWorkerThread->m_workDeques[priority].Pop();
+  if (pWorkItem != nullptr)
+    return pWorkItem;
+
+  // then items injected from outside the pool
+  if (queue.InjectionQueueSize > 0)
   {
+    m_WorkQueueLock.Lock();
+    pWorkItem = PopInjectionQueue(priority);
     m_WorkQueueLock.Unlock();
+    if (pWorkItem != nullptr)
+      return pWorkItem;
+  }
+
+  // then other workers
+  return StealWorkItem(pWorkerThread, priority);
+}
+
+ThreadPoolWorkItem* ThreadPool::StealWorkItem(ThreadPoolWorkerThread* pThief, uint32 priority)
+{
+  // slots below the created count are never empty, see m_WorkerThreads
+  uint32 workerCount = m_createdWorkerCount;
+  MemoryBarrier();
+  if (workerCount < 2)
     return nullptr;
+
+  // random victims first, so thieves don't all hammer the same deque
+  for (uint32 attempt = 0; attempt < STEAL_ATTEMPTS; attempt++)
+  {
+    uint32 victimIndex = pThief->NextRandom() % workerCount;
+    if (victimIndex == pThief->m_workerIndex)
+      continue;
+
+    ThreadPoolWorkItem* pWorkItem = m_WorkerThreads[victimIndex]->m_workDeques[priority].Steal();
+    if (pWorkItem != nullptr)
+      return pWorkItem;
   }
 
-  // enter condition loop
+  // sweep everyone once before giving up
+  for (uint32 i = 1; i < workerCount; i++)
+  {
+    uint32 victimIndex = (pThief->m_workerIndex + i) % workerCount;
+    ThreadPoolWorkItem* pWorkItem = m_WorkerThreads[victimIndex]->m_workDeques[priority].Steal();
+    if (pWorkItem != nullptr)
+      return pWorkItem;
+  }
+
+  return nullptr;
+}
+
+bool ThreadPool::HasPendingWork() const
+{
+  for (uint32 priority = 0; priority < THREADPOOL_PRIORITY_COUNT; priority++)
+  {
+    if (m_priorityQueues[priority].PendingCount > 0)
+      return true;
+  }
+
+  return false;
+}
+
+void ThreadPool::WakeSleepingWorkers(uint32 count)
+{
+  m_WorkQueueLock.Lock();
+
+  // the sleeping count can't rise while we hold the lock
+  uint32 sleepingWorkerCount = m_sleepingWorkerCount;
+  if (sleepingWorkerCount > 0)
+    m_lastWakeRequestTime = Y_TimerGetValue();
+
+  if (count >= sleepingWorkerCount)
+  {
+    m_WorkQueueConditionVariable.WakeAll();
+  }
+  else
+  {
+    for (uint32 i = 0; i < count; i++)
+      m_WorkQueueConditionVariable.Wake();
+  }
+
+  m_WorkQueueLock.Unlock();
+}
+
+ThreadPoolWorkItem* ThreadPool::ThreadGetNextWorkItem(ThreadPoolWorkerThread* pWorkerThread)
+{
+  WorkerIdlePolicy::STAGE idleStage = WorkerIdlePolicy::STAGE_NONE;
   for (;;)
   {
-    if (m_WorkItemQueue.GetSize() > 0)
+    ThreadPoolWorkItem* pWorkItem = FindWorkItem(pWorkerThread);
+    if (pWorkItem != nullptr)
     {
-      pWorkItem = m_WorkItemQueue.PopFront();
-      m_WorkQueueLock.Unlock();
+      // a backlog queued in one go is only seen by the workers working through it
+      if (IsElastic() && m_sleepingWorkerCount == 0)
+        GrowForBacklog();
+
+      pWorkerThread->m_idleStats.RecordWakeup(idleStage);
       return pWorkItem;
     }
 
-    if (m_bExitThreads)
+    // spin and yield first, if the policy allows it. exiting is handled on the sleep path.
+    if (idleStage != WorkerIdlePolicy::STAGE_PARK && !m_bExitThreads)
     {
-      m_WorkQueueLock.Unlock();
-      return nullptr;
+      WorkerIdlePolicy policy = m_idlePolicy;
+      idleStage = policy.Wait([this]() { return (HasPendingWork() || m_bExitThreads); });
+      if (idleStage != WorkerIdlePolicy::STAGE_PARK && !m_bExitThreads)
+        continue;
+    }
+
+    // nothing found, prepare to sleep. the sleeping count is raised before the final check, and enqueuers
+    // check it after pushing, so either we see their item or they see us and wake us.
+    m_WorkQueueLock.Lock();
+    Y_AtomicIncrement(m_sleepingWorkerCount);
+    MemoryBarrier();
+
+    if (!HasPendingWork() && !m_bExitThreads)
+    {
+      Y_TIMER_VALUE parkTime = Y_TimerGetValue();
+      pWorkerThread->m_idleStats.Parks++;
+
+      do
+      {
+        // workers past the worker count only wait so long, then retire if there's still a surplus
+        if (m_runningWorkerCount <= m_nWorkerThreads)
+        {
+          m_WorkQueueConditionVariable.SleepAndRelease(&m_WorkQueueLock);
+        }
+        else if (!m_WorkQueueConditionVariable.SleepAndRelease(&m_WorkQueueLock, m_idleTimeout) &&
+                 m_runningWorkerCount > m_nWorkerThreads && !HasPendingWork() && !m_bExitThreads)
+        {
+          pWorkerThread->m_retired = true;
+          m_runningWorkerCount--;
+          Y_AtomicDecrement(m_sleepingWorkerCount);
+          m_WorkQueueLock.Unlock();
+          return nullptr;
+        }
+      } while (!HasPendingWork() && !m_bExitThreads);
+
+      // only count wake-ups that were requested after we went to sleep
+      if (m_lastWakeRequestTime >= parkTime)
+        pWorkerThread->m_idleStats.RecordWakeLatency(Y_TimerGetValue() - m_lastWakeRequestTime);
     }
 
-    m_WorkQueueConditionVariable.SleepAndRelease(&m_WorkQueueLock);
+    Y_AtomicDecrement(m_sleepingWorkerCount);
+    m_WorkQueueLock.Unlock();
+
+    // only exit once there is no work left anywhere
+    if (m_bExitThreads && !HasPendingWork())
+      return nullptr;
+
+    // spin again next time we run dry
+    idleStage = WorkerIdlePolicy::STAGE_NONE;
   }
 }
 
@@ -143,15 +675,94 @@ uint32 ThreadPool::GetDefaultWorkerThreadCount()
   return (cpuidResult.ThreadCount >= 2) ? cpuidResult.ThreadCount - 1 : 1;
 }
 
-ThreadPoolWorkerThread::ThreadPoolWorkerThread(ThreadPool* pThreadPool) : m_pThreadPool(pThreadPool) {}
+THREADPOOL_AFFINITY ThreadPool::ResolveAffinity(THREADPOOL_AFFINITY affinity)
+{
+  if (affinity != THREADPOOL_AFFINITY_DEFAULT)
+    return affinity;
+
+  // on a single node the scheduler already keeps threads near their caches
+  Y_CPU_TOPOLOGY topology;
+  Y_ReadCPUTopology(&topology);
+  return (topology.NodeCount > 1) ? THREADPOOL_AFFINITY_PER_NODE : THREADPOOL_AFFINITY_NONE;
+}
+
+uint64 ThreadPool::GetWorkerAffinityMask(THREADPOOL_AFFINITY affinity, uint32 workerIndex, uint32 workerCount)
+{
+  DebugAssert(workerIndex < workerCount);
+
+  affinity = ResolveAffinity(affinity);
+  if (affinity == THREADPOOL_AFFINITY_NONE)
+    return 0;
+
+  Y_CPU_TOPOLOGY topology;
+  Y_ReadCPUTopology(&topology);
+
+  // neighbouring workers share a node, and nodes get an equal share of the workers
+  uint32 nodeIndex = static_cast<uint32>((uint64)workerIndex * topology.NodeCount / workerCount);
+  uint64 nodeMask = topology.NodeMasks[nodeIndex];
+  if (affinity == THREADPOOL_AFFINITY_PER_NODE)
+    return nodeMask;
+
+  // pick a core within the node, wrapping if there are more workers than cores
+  uint32 nodeCoreCount = 0;
+  for (uint32 i = 0; i < topology.CoreCount; i++)
+  {
+    if ((topology.CoreMasks[i] & nodeMask) != 0)
+      nodeCoreCount++;
+  }
+
+  uint32 firstNodeWorker =
+    static_cast<uint32>(((uint64)nodeIndex * workerCount + topology.NodeCount - 1) / topology.NodeCount);
+  uint32 coreIndex = (nodeCoreCount > 0) ? ((workerIndex - firstNodeWorker) % nodeCoreCount) : 0;
+  for (uint32 i = 0; i < topology.CoreCount; i++)
+  {
+    if ((topology.CoreMasks[i] & nodeMask) == 0)
+      continue;
+
+    if (coreIndex-- == 0)
+      return topology.CoreMasks[i];
+  }
+
+  return nodeMask;
+}
+
+ThreadPoolWorkerThread::ThreadPoolWorkerThread(ThreadPool* pThreadPool, uint32 workerIndex, uint64 affinityMask)
+  : m_pThreadPool(pThreadPool), m_workerIndex(workerIndex), m_randomState((workerIndex + 1) * 2654435761u),
+    m_affinityMask(affinityMask), m_fetchCount(0), m_currentPriority(THREADPOOL_PRIORITY_COUNT), m_blockingDepth(0),
+    m_retired(false), m_needsJoin(false)
+{
+}
 
 ThreadPoolWorkerThread::~ThreadPoolWorkerThread() {}
 
+ThreadPoolWorkerThread* ThreadPoolWorkerThread::GetCurrentWorkerThread()
+{
+  return s_pCurrentWorkerThread;
+}
+
+uint32 ThreadPoolWorkerThread::NextRandom()
+{
+  uint32 x = m_randomState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  m_randomState = x;
+  return x;
+}
+
 int32 ThreadPoolWorkerThread::ThreadEntryPoint()
 {
+  s_pCurrentWorkerThread = this;
+  SetDebugName(String::FromFormat("Thread Pool %p Worker %u", m_pThreadPool, m_workerIndex));
+
+  // bind before running anything, so the worker's allocations land on its own node
+  if (m_affinityMask != 0 && !Thread::SetCurrentThreadAffinityMask(m_affinityMask))
+    Log_WarningPrintf("Failed to set affinity of worker %u to 0x%llx", m_workerIndex,
+                      (unsigned long long)m_affinityMask);
+
   for (;;)
   {
-    ThreadPoolWorkItem* pWorkItem = m_pThreadPool->ThreadGetNextWorkItem();
+    ThreadPoolWorkItem* pWorkItem = m_pThreadPool->ThreadGetNextWorkItem(this);
     if (pWorkItem == NULL)
       break;
 
@@ -159,9 +770,21 @@ int32 ThreadPoolWorkerThread::ThreadEntryPoint()
         Timer timer;
 #endif
 
+    const bool recordStats = m_pThreadPool->m_statsEnabled;
+    Y_TIMER_VALUE startTime = recordStats ? Y_TimerGetValue() : 0;
+    uint32 queueDepth = recordStats ? m_pThreadPool->GetQueueDepth() : 0;
+
+    m_currentPriority = pWorkItem->m_priority;
     pWorkItem->m_iState = ThreadPoolWorkItem::STATE_STARTED;
-    pWorkItem->m_iReturnValue = pWorkItem->ProcessWork();
+    {
+      Y_PROFILE_ZONE("ThreadPool::ProcessWork");
+      pWorkItem->m_iReturnValue = pWorkItem->ProcessWork();
+    }
     pWorkItem->m_iState = ThreadPoolWorkItem::STATE_COMPLETED;
+    m_currentPriority = THREADPOOL_PRIORITY_COUNT;
+
+    if (recordStats)
+      m_schedulerStats.RecordTask(pWorkItem->m_queueTime, startTime, Y_TimerGetValue(), queueDepth);
 
     pWorkItem->OnCompleted();
     pWorkItem->Release();
@@ -171,10 +794,15 @@ int32 ThreadPoolWorkerThread::ThreadEntryPoint()
 #endif
   }
 
+  s_pCurrentWorkerThread = nullptr;
   return 0;
 }
 
-ThreadPoolWorkItem::ThreadPoolWorkItem() : m_iState(STATE_QUEUED), m_iReturnValue(0xDEADBEEF) {}
+ThreadPoolWorkItem::ThreadPoolWorkItem()
+  : m_iState(STATE_QUEUED), m_iReturnValue(0xDEADBEEF), m_priority(THREADPOOL_PRIORITY_NORMAL), m_hasDeadline(false),
+    m_deadline(0), m_queueTime(0)
+{
+}
 
 ThreadPoolWorkItem::~ThreadPoolWorkItem() {}
 
@@ -185,6 +813,31 @@ int32 ThreadPoolWorkItem::ProcessWork()
 
 void ThreadPoolWorkItem::OnCompleted() {}
 
+void ThreadPoolWorkItem::SetPriority(THREADPOOL_PRIORITY priority)
+{
+  DebugAssert(priority < THREADPOOL_PRIORITY_COUNT);
+  m_priority = priority;
+}
+
+void ThreadPoolWorkItem::SetDeadline(Y_TIMER_VALUE deadline)
+{
+  m_hasDeadline = true;
+  m_deadline = deadline;
+}
+
+void ThreadPoolWorkItem::SetDeadlineFromNow(double milliseconds)
+{
+  // there is no conversion back to timer ticks, so derive one from the tick length
+  double ticks = milliseconds / Y_TimerConvertToMilliseconds(1);
+  SetDeadline(Y_TimerGetValue() + static_cast<Y_TIMER_VALUE>(ticks));
+}
+
+void ThreadPoolWorkItem::ClearDeadline()
+{
+  m_hasDeadline = false;
+  m_deadline = 0;
+}
+
 ThreadPoolWorkItemSignaled::ThreadPoolWorkItemSignaled() : m_CompletionEvent(true) {}
 
 ThreadPoolWorkItemSignaled::~ThreadPoolWorkItemSignaled() {}
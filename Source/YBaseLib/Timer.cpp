@@ -1,4 +1,6 @@
 #include "YBaseLib/Timer.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/CPUID.h"
 
 #if defined(Y_PLATFORM_WINDOWS)
 #include "YBaseLib/Windows/WindowsHeaders.h"
@@ -117,6 +119,126 @@ double Y_TimerConvertToSeconds(Y_TIMER_VALUE Value)
 
 #endif
 
+#ifdef Y_FAST_TIMER_HAS_CPU_COUNTER
+
+volatile Y_FAST_TIMER_SOURCE g_fastTimerSource = Y_FAST_TIMER_SOURCE_UNKNOWN;
+
+// the counter and the system timer when the source was picked, the start of the calibration
+static Y_TIMER_VALUE s_calibrationStartCounter;
+static Y_TIMER_VALUE s_calibrationStartTime;
+
+Y_TIMER_VALUE Y_FastTimerGetValueFallback()
+{
+  // even if this races, every thread picks the same source
+  if (g_fastTimerSource == Y_FAST_TIMER_SOURCE_UNKNOWN)
+  {
+#if defined(Y_CPU_AARCH64)
+    bool useCounter = true;
+#else
+    bool useCounter = Y_CPUSupportsInvariantTSC();
+#endif
+    s_calibrationStartTime = Y_TimerGetValue();
+    s_calibrationStartCounter = Y_ReadCPUCounter();
+    Y_AtomicStoreRelease(g_fastTimerSource,
+                         useCounter ? Y_FAST_TIMER_SOURCE_CPU_COUNTER : Y_FAST_TIMER_SOURCE_SYSTEM_TIMER);
+  }
+
+  return (g_fastTimerSource == Y_FAST_TIMER_SOURCE_CPU_COUNTER) ? Y_ReadCPUCounter() : Y_TimerGetValue();
+}
+
+// Nanoseconds per count. The generic timer's frequency is a register, the TSC's is measured over at least 10ms
+// against the system timer, taking the reading bracketed most tightly by the system timer from a few tries.
+static double CalibrateCPUCounter()
+{
+#if defined(Y_CPU_AARCH64) && defined(Y_COMPILER_MSVC)
+  // ARM64_CNTFRQ
+  return 1000000000.0 / (double)_ReadStatusReg(0x5F00);
+#elif defined(Y_CPU_AARCH64)
+  uint64 frequency;
+  asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+  return 1000000000.0 / (double)frequency;
+#else
+  while (Y_TimerConvertToMilliseconds(Y_TimerGetValue() - s_calibrationStartTime) < 10.0)
+    ;
+
+  Y_TIMER_VALUE bestCounter = 0;
+  Y_TIMER_VALUE bestTime = 0;
+  double bestWindow = 0.0;
+  for (uint32 i = 0; i < 8; i++)
+  {
+    Y_TIMER_VALUE startTime = Y_TimerGetValue();
+    Y_TIMER_VALUE counter = Y_ReadCPUCounter();
+    Y_TIMER_VALUE endTime = Y_TimerGetValue();
+    double window = Y_TimerConvertToNanoseconds(endTime - startTime);
+    if (i == 0 || window < bestWindow)
+    {
+      bestCounter = counter;
+      bestTime = startTime + (endTime - startTime) / 2;
+      bestWindow = window;
+    }
+  }
+
+  return Y_TimerConvertToNanoseconds(bestTime - s_calibrationStartTime) /
+         (double)(bestCounter - s_calibrationStartCounter);
+#endif
+}
+
+static double GetCPUCounterPeriod()
+{
+  static const double period = CalibrateCPUCounter();
+  return period;
+}
+
+double Y_FastTimerConvertToNanoseconds(Y_TIMER_VALUE Value)
+{
+  if (!Y_FastTimerUsesCPUCounter())
+    return Y_TimerConvertToNanoseconds(Value);
+
+  return (double)Value * GetCPUCounterPeriod();
+}
+
+double Y_FastTimerConvertToMilliseconds(Y_TIMER_VALUE Value)
+{
+  return Y_FastTimerConvertToNanoseconds(Value) / 1000000.0;
+}
+
+double Y_FastTimerConvertToSeconds(Y_TIMER_VALUE Value)
+{
+  return Y_FastTimerConvertToNanoseconds(Value) / 1000000000.0;
+}
+
+bool Y_FastTimerUsesCPUCounter()
+{
+  if (g_fastTimerSource == Y_FAST_TIMER_SOURCE_UNKNOWN)
+    Y_FastTimerGetValueFallback();
+
+  return (g_fastTimerSource == Y_FAST_TIMER_SOURCE_CPU_COUNTER);
+}
+
+#else // Y_FAST_TIMER_HAS_CPU_COUNTER
+
+double Y_FastTimerConvertToNanoseconds(Y_TIMER_VALUE Value)
+{
+  return Y_TimerConvertToNanoseconds(Value);
+}
+
+double Y_FastTimerConvertToMilliseconds(Y_TIMER_VALUE Value)
+{
+  return Y_TimerConvertToMilliseconds(Value);
+}
+
+double Y_FastTimerConvertToSeconds(Y_TIMER_VALUE Value)
+{
+  return Y_TimerConvertToSeconds(Value);
+}
+
+bool Y_FastTimerUsesCPUCounter()
+{
+  return false;
+}
+
+#endif // Y_FAST_TIMER_HAS_CPU_COUNTER
+
 Timer::Timer()
 {
   Reset();
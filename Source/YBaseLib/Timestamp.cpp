@@ -108,6 +108,15 @@ Timestamp::ExpandedTime Timestamp::AsExpandedTime() const
   return et;
 }
 
+uint32 Timestamp::GetSubSecondMicroseconds() const
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  return (uint32)m_value.wMilliseconds * 1000;
+#elif defined(Y_PLATFORM_POSIX) || defined(Y_PLATFORM_HTML5) || defined(Y_PLATFORM_ANDROID)
+  return (uint32)m_value.tv_usec;
+#endif
+}
+
 void Timestamp::SetNow()
 {
 #if defined(Y_PLATFORM_WINDOWS)
@@ -117,6 +126,24 @@ void Timestamp::SetNow()
 #endif
 }
 
+void Timestamp::SetNowCoarse()
+{
+#if defined(Y_PLATFORM_WINDOWS)
+  // the system time as of the last tick, GetSystemTime converts from it
+  FILETIME ft;
+  GetSystemTimeAsFileTime(&ft);
+  FileTimeToSystemTime(&ft, &m_value);
+#elif defined(CLOCK_REALTIME_COARSE)
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+  m_value.tv_sec = ts.tv_sec;
+  m_value.tv_usec = ts.tv_nsec / 1000;
+#else
+  // gettimeofday is already as cheap as it gets elsewhere
+  gettimeofday(&m_value, NULL);
+#endif
+}
+
 void Timestamp::SetUnixTimestamp(UnixTimestampValue value)
 {
 #if defined(Y_PLATFORM_WINDOWS)
@@ -164,9 +191,10 @@ String Timestamp::ToString(const char* format) const
   return String(destination);
 }
 
-void Timestamp::ToString(String& destination, const char* format) const
+// appends the local time in a strftime format
+static void AppendLocalTime(String& destination, const Timestamp& timestamp, const char* format)
 {
-  time_t unixTime = (time_t)AsUnixTimestamp();
+  time_t unixTime = (time_t)timestamp.AsUnixTimestamp();
   tm localTime;
 
 #if defined(Y_PLATFORM_WINDOWS)
@@ -176,11 +204,95 @@ void Timestamp::ToString(String& destination, const char* format) const
 #endif
 
   char buffer[256];
-  strftime(buffer, countof(buffer) - 1, format, &localTime);
-  buffer[countof(buffer) - 1] = 0;
+  size_t length = strftime(buffer, countof(buffer), format, &localTime);
+  destination.AppendString(buffer, uint32(length));
+}
 
+void Timestamp::ToString(String& destination, const char* format) const
+{
   destination.Clear();
-  destination.AppendString(buffer);
+  AppendLocalTime(destination, *this, format);
+}
+
+const uint32 TimestampFormatter::MaxFractionDigits;
+
+TimestampFormatter::TimestampFormatter(const char* format /* = "%Y-%m-%d %H:%M:%S" */, uint32 fractionDigits /* = 3 */)
+{
+  SetFormat(format, fractionDigits);
+}
+
+void TimestampFormatter::SetFormat(const char* format, uint32 fractionDigits)
+{
+  m_format = format;
+  m_fractionDigits = Min(fractionDigits, MaxFractionDigits);
+  m_prefixSecond = 0;
+  m_prefixLength = 0;
+  m_prefixValid = false;
+}
+
+const char* TimestampFormatter::Format(const Timestamp& timestamp, uint32* pLength /* = nullptr */)
+{
+  Timestamp::UnixTimestampValue second = timestamp.AsUnixTimestamp();
+  if (!m_prefixValid || second != m_prefixSecond)
+  {
+    time_t unixTime = (time_t)second;
+    tm localTime;
+#if defined(Y_PLATFORM_WINDOWS)
+    localtime_s(&localTime, &unixTime);
+#else
+    localtime_r(&unixTime, &localTime);
+#endif
+
+    // leaving room for the fraction
+    m_prefixLength = (uint32)strftime(m_buffer, sizeof(m_buffer) - MaxFractionDigits - 2, m_format, &localTime);
+    m_prefixSecond = second;
+    m_prefixValid = true;
+  }
+
+  uint32 length = m_prefixLength;
+  if (m_fractionDigits > 0)
+  {
+    // the leading digits of the microseconds
+    uint32 fraction = timestamp.GetSubSecondMicroseconds();
+    for (uint32 i = m_fractionDigits; i < MaxFractionDigits; i++)
+      fraction /= 10;
+
+    m_buffer[length] = '.';
+    for (uint32 i = m_fractionDigits; i > 0; i--)
+    {
+      m_buffer[length + i] = (char)('0' + (fraction % 10));
+      fraction /= 10;
+    }
+    length += m_fractionDigits + 1;
+  }
+
+  m_buffer[length] = '\0';
+  if (pLength != nullptr)
+    *pLength = length;
+
+  return m_buffer;
+}
+
+void TimestampFormatter::Format(String& destination, const Timestamp& timestamp)
+{
+  uint32 length;
+  const char* text = Format(timestamp, &length);
+  destination.AppendString(text, length);
+}
+
+void TypedFormat::Formatter<Timestamp>::Format(String& destination, const Timestamp& value, const StringView& spec)
+{
+  if (spec.IsEmpty())
+  {
+    AppendLocalTime(destination, value, "%Y-%m-%d %H:%M:%S");
+    return;
+  }
+
+  char format[128];
+  uint32 formatLength = Min(spec.GetLength(), uint32(countof(format) - 1));
+  std::memcpy(format, spec.GetData(), formatLength);
+  format[formatLength] = '\0';
+  AppendLocalTime(destination, value, format);
 }
 
 Timestamp Timestamp::Now()
@@ -190,6 +302,13 @@ Timestamp Timestamp::Now()
   return t;
 }
 
+Timestamp Timestamp::NowCoarse()
+{
+  Timestamp t;
+  t.SetNowCoarse();
+  return t;
+}
+
 Timestamp Timestamp::FromUnixTimestamp(UnixTimestampValue value)
 {
   Timestamp t;
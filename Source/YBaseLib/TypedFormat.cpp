@@ -0,0 +1,378 @@
+#include "YBaseLib/TypedFormat.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/NumberConversion.h"
+#include "YBaseLib/String.h"
+#include <cmath>
+
+struct FormatSpec
+{
+  char Fill;
+  char Align;
+  char Type;
+  bool ForceSign;
+  bool Alternate;
+  bool ZeroPad;
+  uint32 Width;
+  int32 Precision;
+};
+
+static inline bool IsAlignCharacter(char ch)
+{
+  return (ch == '<' || ch == '>' || ch == '^');
+}
+
+// reads [[fill]align][+][#][0][width][.precision][type] from the text after the colon
+static void ParseSpec(const StringView& text, FormatSpec* pSpec)
+{
+  pSpec->Fill = ' ';
+  pSpec->Align = '\0';
+  pSpec->Type = '\0';
+  pSpec->ForceSign = false;
+  pSpec->Alternate = false;
+  pSpec->ZeroPad = false;
+  pSpec->Width = 0;
+  pSpec->Precision = -1;
+
+  const char* p = text.GetData();
+  const char* pEnd = text.GetEnd();
+  if ((pEnd - p) >= 2 && IsAlignCharacter(p[1]))
+  {
+    pSpec->Fill = p[0];
+    pSpec->Align = p[1];
+    p += 2;
+  }
+  else if (p != pEnd && IsAlignCharacter(p[0]))
+  {
+    pSpec->Align = *(p++);
+  }
+
+  if (p != pEnd && *p == '+')
+  {
+    pSpec->ForceSign = true;
+    p++;
+  }
+  if (p != pEnd && *p == '#')
+  {
+    pSpec->Alternate = true;
+    p++;
+  }
+  if (p != pEnd && *p == '0')
+  {
+    pSpec->ZeroPad = true;
+    p++;
+  }
+  for (; p != pEnd && *p >= '0' && *p <= '9'; p++)
+    pSpec->Width = Min(pSpec->Width * 10 + uint32(*p - '0'), 4096u);
+
+  if (p != pEnd && *p == '.')
+  {
+    pSpec->Precision = 0;
+    for (p++; p != pEnd && *p >= '0' && *p <= '9'; p++)
+      pSpec->Precision = Min(pSpec->Precision * 10 + int32(*p - '0'), 100);
+  }
+
+  if (p != pEnd)
+    pSpec->Type = *p;
+}
+
+static void AppendFill(String& destination, char fill, uint32 count)
+{
+  for (uint32 i = 0; i < count; i++)
+    destination.AppendCharacter(fill);
+}
+
+// writes text padded out to the spec's width. prefixLength characters of sign and base prefix stay in front of the
+// zero padding of numbers.
+static void AppendPadded(String& destination, const FormatSpec& spec, const char* pText, uint32 length,
+                         bool isNumber, uint32 prefixLength = 0)
+{
+  if (length >= spec.Width)
+  {
+    destination.AppendString(pText, length);
+    return;
+  }
+
+  uint32 padding = spec.Width - length;
+  if (isNumber && spec.ZeroPad && spec.Align == '\0')
+  {
+    destination.AppendString(pText, prefixLength);
+    AppendFill(destination, '0', padding);
+    destination.AppendString(pText + prefixLength, length - prefixLength);
+    return;
+  }
+
+  // numbers go to the right by default, everything else to the left
+  char align = (spec.Align != '\0') ? spec.Align : (isNumber ? '>' : '<');
+  uint32 before = (align == '>') ? padding : ((align == '^') ? padding / 2 : 0);
+  AppendFill(destination, spec.Fill, before);
+  destination.AppendString(pText, length);
+  AppendFill(destination, spec.Fill, padding - before);
+}
+
+static void AppendInteger(String& destination, const FormatSpec& spec, uint64 magnitude, bool negative)
+{
+  // 64 binary digits, a sign and a prefix
+  char buffer[72];
+  uint32 length = 0;
+  if (negative)
+    buffer[length++] = '-';
+  else if (spec.ForceSign)
+    buffer[length++] = '+';
+
+  uint32 shift = 0;
+  const char* digits = "0123456789abcdef";
+  switch (spec.Type)
+  {
+    case 'x':
+      shift = 4;
+      break;
+    case 'X':
+      shift = 4;
+      digits = "0123456789ABCDEF";
+      break;
+    case 'b':
+      shift = 1;
+      break;
+    case 'o':
+      shift = 3;
+      break;
+  }
+
+  if (shift == 0)
+  {
+    length += NumberConversion::FormatUInt64(buffer + length, magnitude);
+    AppendPadded(destination, spec, buffer, length, true, negative || spec.ForceSign ? 1 : 0);
+    return;
+  }
+
+  if (spec.Alternate)
+  {
+    buffer[length++] = '0';
+    if (spec.Type != 'o')
+      buffer[length++] = (spec.Type == 'b') ? 'b' : spec.Type;
+  }
+
+  uint32 prefixLength = length;
+  uint32 digitCount = 1;
+  while (digitCount * shift < 64 && (magnitude >> (digitCount * shift)) != 0)
+    digitCount++;
+
+  uint64 mask = (uint64(1) << shift) - 1;
+  for (uint32 i = 0; i < digitCount; i++)
+    buffer[length + i] = digits[(magnitude >> ((digitCount - 1 - i) * shift)) & mask];
+
+  length += digitCount;
+  AppendPadded(destination, spec, buffer, length, true, prefixLength);
+}
+
+static void AppendFloatingPoint(String& destination, const FormatSpec& spec, double value, bool isFloat)
+{
+  // %f of the largest double is over 300 digits, with 100 more after the point
+  char buffer[512];
+  uint32 length;
+  if (spec.Precision < 0 && (spec.Type == '\0' || spec.Type == 'g'))
+  {
+    uint32 signLength = (spec.ForceSign && !std::signbit(value)) ? 1 : 0;
+    buffer[0] = '+';
+    if (isFloat)
+      length = signLength + NumberConversion::FormatFloat(buffer + signLength, float(value));
+    else
+      length = signLength + NumberConversion::FormatDouble(buffer + signLength, value);
+  }
+  else
+  {
+    char printfFormat[8];
+    uint32 formatLength = 0;
+    printfFormat[formatLength++] = '%';
+    if (spec.ForceSign)
+      printfFormat[formatLength++] = '+';
+    printfFormat[formatLength++] = '.';
+    printfFormat[formatLength++] = '*';
+    printfFormat[formatLength++] = (spec.Type == 'e' || spec.Type == 'g' || spec.Type == 'E' || spec.Type == 'G') ?
+                                     spec.Type :
+                                     'f';
+    printfFormat[formatLength] = '\0';
+
+    int result = Y_snprintf(buffer, sizeof(buffer), printfFormat, (spec.Precision < 0) ? 6 : spec.Precision, value);
+    length = (result < 0) ? 0 : Min(uint32(result), uint32(sizeof(buffer) - 1));
+  }
+
+  // zeros go after the sign, but not in front of inf or nan
+  bool finite = (value == value && value - value == 0.0);
+  uint32 prefixLength = (length > 0 && (buffer[0] == '-' || buffer[0] == '+')) ? 1 : 0;
+  if (finite)
+  {
+    AppendPadded(destination, spec, buffer, length, true, prefixLength);
+  }
+  else
+  {
+    FormatSpec spacePadded = spec;
+    spacePadded.ZeroPad = false;
+    AppendPadded(destination, spacePadded, buffer, length, true);
+  }
+}
+
+static void AppendPointer(String& destination, const FormatSpec& spec, const void* value)
+{
+  FormatSpec hexSpec = spec;
+  hexSpec.Type = 'x';
+  hexSpec.Alternate = true;
+  hexSpec.ForceSign = false;
+  AppendInteger(destination, hexSpec, uint64(reinterpret_cast<uintptr_t>(value)), false);
+}
+
+static void AppendArgument(String& destination, const TypedFormat::Argument& argument, const StringView& specText)
+{
+  if (argument.Type == TypedFormat::ARGUMENT_TYPE_CUSTOM)
+  {
+    argument.Custom.pFunction(destination, argument.Custom.pValue, specText);
+    return;
+  }
+
+  FormatSpec spec;
+  ParseSpec(specText, &spec);
+
+  // an integer spec on a character, bool or pointer writes it as a number
+  bool asInteger = (spec.Type == 'd' || spec.Type == 'x' || spec.Type == 'X' || spec.Type == 'b' || spec.Type == 'o');
+  switch (argument.Type)
+  {
+    case TypedFormat::ARGUMENT_TYPE_BOOL:
+      if (asInteger)
+        AppendInteger(destination, spec, argument.Unsigned, false);
+      else if (argument.Unsigned != 0)
+        AppendPadded(destination, spec, "true", 4, false);
+      else
+        AppendPadded(destination, spec, "false", 5, false);
+      break;
+
+    case TypedFormat::ARGUMENT_TYPE_CHARACTER:
+      if (asInteger)
+      {
+        AppendInteger(destination, spec, (argument.Signed < 0) ? (0u - uint64(argument.Signed)) : argument.Signed,
+                      argument.Signed < 0);
+      }
+      else
+      {
+        char ch = char(argument.Signed);
+        AppendPadded(destination, spec, &ch, 1, false);
+      }
+      break;
+
+    case TypedFormat::ARGUMENT_TYPE_SIGNED:
+      if (spec.Type == 'c')
+      {
+        char ch = char(argument.Signed);
+        AppendPadded(destination, spec, &ch, 1, false);
+      }
+      else
+      {
+        AppendInteger(destination, spec, (argument.Signed < 0) ? (0u - uint64(argument.Signed)) : argument.Signed,
+                      argument.Signed < 0);
+      }
+      break;
+
+    case TypedFormat::ARGUMENT_TYPE_UNSIGNED:
+      if (spec.Type == 'c')
+      {
+        char ch = char(argument.Unsigned);
+        AppendPadded(destination, spec, &ch, 1, false);
+      }
+      else
+      {
+        AppendInteger(destination, spec, argument.Unsigned, false);
+      }
+      break;
+
+    case TypedFormat::ARGUMENT_TYPE_FLOAT:
+    case TypedFormat::ARGUMENT_TYPE_DOUBLE:
+      AppendFloatingPoint(destination, spec, argument.Double, argument.Type == TypedFormat::ARGUMENT_TYPE_FLOAT);
+      break;
+
+    case TypedFormat::ARGUMENT_TYPE_STRING:
+    {
+      // precision cuts the string off
+      uint32 length = argument.Text.Length;
+      if (spec.Precision >= 0)
+        length = Min(length, uint32(spec.Precision));
+      AppendPadded(destination, spec, argument.Text.pData, length, false);
+    }
+    break;
+
+    case TypedFormat::ARGUMENT_TYPE_POINTER:
+      if (asInteger)
+        AppendInteger(destination, spec, uint64(reinterpret_cast<uintptr_t>(argument.Pointer)), false);
+      else
+        AppendPointer(destination, spec, argument.Pointer);
+      break;
+
+    default:
+      UnreachableCode();
+      break;
+  }
+}
+void TypedFormat::AppendFormatted(String& destination, const StringView& format, const Argument* pArguments,
+                                  uint32 argumentCount)
+{
+  const char* p = format.GetData();
+  const char* pEnd = format.GetEnd();
+  uint32 nextIndex = 0;
+  while (p != pEnd)
+  {
+    // copy text up to the next brace in one go
+    const char* pLiteralEnd = p;
+    while (pLiteralEnd != pEnd && *pLiteralEnd != '{' && *pLiteralEnd != '}')
+      pLiteralEnd++;
+    if (pLiteralEnd != p)
+    {
+      destination.AppendString(p, uint32(pLiteralEnd - p));
+      p = pLiteralEnd;
+      continue;
+    }
+
+    // doubled braces are literal, a lone closing brace is written as it is
+    if ((pEnd - p) >= 2 && p[1] == p[0])
+    {
+      destination.AppendCharacter(*p);
+      p += 2;
+      continue;
+    }
+    if (*p == '}')
+    {
+      destination.AppendCharacter(*(p++));
+      continue;
+    }
+
+    const char* pPlaceholder = p++;
+    uint32 index = nextIndex;
+    if (p != pEnd && *p >= '0' && *p <= '9')
+    {
+      index = 0;
+      for (; p != pEnd && *p >= '0' && *p <= '9'; p++)
+        index = Min(index * 10 + uint32(*p - '0'), 0xFFFFu);
+    }
+    else
+    {
+      nextIndex++;
+    }
+
+    const char* pSpecStart = p;
+    if (p != pEnd && *p == ':')
+    {
+      pSpecStart = ++p;
+      while (p != pEnd && *p != '}')
+        p++;
+    }
+
+    if (p == pEnd || *p != '}' || index >= argumentCount)
+    {
+      // malformed, or no argument for it
+      p = (p != pEnd && *p == '}') ? (p + 1) : p;
+      destination.AppendString(pPlaceholder, uint32(p - pPlaceholder));
+      continue;
+    }
+
+    AppendArgument(destination, pArguments[index], StringView(pSpecStart, p));
+    p++;
+  }
+}
@@ -0,0 +1,535 @@
+#include "YBaseLib/UnicodeConversion.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/String.h"
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <emmintrin.h>
+#define Y_UNICODE_SSE2 1
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_UNICODE_NEON 1
+#endif
+
+// Runs of ASCII are found and copied with the vector helpers below, everything else goes through the scalar
+// decoders a code point at a time.
+
+// number of ASCII characters at the start of the text
+static uint32 CountASCII(const byte* pText, uint32 length)
+{
+  uint32 i = 0;
+#if defined(Y_UNICODE_SSE2)
+  for (; length - i >= 16; i += 16)
+  {
+    uint32 mask = uint32(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pText + i))));
+    if (mask != 0)
+    {
+      uint32 index;
+      Y_bitscanforward(mask, &index);
+      return i + index;
+    }
+  }
+#elif defined(Y_UNICODE_NEON)
+  for (; length - i >= 16; i += 16)
+  {
+    if (vmaxvq_u8(vld1q_u8(pText + i)) >= 0x80)
+      break;
+  }
+#endif
+
+  while (i < length && pText[i] < 0x80)
+    i++;
+  return i;
+}
+
+static uint32 CountASCII(const char16_t* pText, uint32 length)
+{
+  uint32 i = 0;
+#if defined(Y_UNICODE_SSE2)
+  const __m128i highBits = _mm_set1_epi16(short(0xFF80));
+  for (; length - i >= 16; i += 16)
+  {
+    __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pText + i));
+    __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pText + i + 8));
+    __m128i high = _mm_and_si128(_mm_or_si128(first, second), highBits);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF)
+      break;
+  }
+#elif defined(Y_UNICODE_NEON)
+  for (; length - i >= 16; i += 16)
+  {
+    const uint16* pUnits = reinterpret_cast<const uint16*>(pText + i);
+    if (vmaxvq_u16(vorrq_u16(vld1q_u16(pUnits), vld1q_u16(pUnits + 8))) >= 0x80)
+      break;
+  }
+#endif
+
+  while (i < length && pText[i] < 0x80)
+    i++;
+  return i;
+}
+
+static uint32 CountASCII(const char32_t* pText, uint32 length)
+{
+  uint32 i = 0;
+#if defined(Y_UNICODE_SSE2)
+  const __m128i highBits = _mm_set1_epi32(int(0xFFFFFF80));
+  for (; length - i >= 8; i += 8)
+  {
+    __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pText + i));
+    __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pText + i + 4));
+    __m128i high = _mm_and_si128(_mm_or_si128(first, second), highBits);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xFFFF)
+      break;
+  }
+#elif defined(Y_UNICODE_NEON)
+  for (; length - i >= 8; i += 8)
+  {
+    const uint32* pUnits = reinterpret_cast<const uint32*>(pText + i);
+    if (vmaxvq_u32(vorrq_u32(vld1q_u32(pUnits), vld1q_u32(pUnits + 4))) >= 0x80)
+      break;
+  }
+#endif
+
+  while (i < length && pText[i] < 0x80)
+    i++;
+  return i;
+}
+
+// copies text already known to be ASCII
+static void CopyASCII(char16_t* pDestination, const byte* pSource, uint32 count)
+{
+  uint32 i = 0;
+#if defined(Y_UNICODE_SSE2)
+  for (; count - i >= 16; i += 16)
+  {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + i), _mm_unpacklo_epi8(bytes, _mm_setzero_si128()));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + i + 8), _mm_unpackhi_epi8(bytes, _mm_setzero_si128()));
+  }
+#elif defined(Y_UNICODE_NEON)
+  for (; count - i >= 16; i += 16)
+  {
+    uint8x16_t bytes = vld1q_u8(pSource + i);
+    vst1q_u16(reinterpret_cast<uint16*>(pDestination + i), vmovl_u8(vget_low_u8(bytes)));
+    vst1q_u16(reinterpret_cast<uint16*>(pDestination + i + 8), vmovl_high_u8(bytes));
+  }
+#endif
+
+  for (; i < count; i++)
+    pDestination[i] = char16_t(pSource[i]);
+}
+
+static void CopyASCII(char32_t* pDestination, const byte* pSource, uint32 count)
+{
+  uint32 i = 0;
+#if defined(Y_UNICODE_SSE2)
+  for (; count - i >= 16; i += 16)
+  {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + i));
+    __m128i low = _mm_unpacklo_epi8(bytes, _mm_setzero_si128());
+    __m128i high = _mm_unpackhi_epi8(bytes, _mm_setzero_si128());
+    __m128i* pOut = reinterpret_cast<__m128i*>(pDestination + i);
+    _mm_storeu_si128(pOut, _mm_unpacklo_epi16(low, _mm_setzero_si128()));
+    _mm_storeu_si128(pOut + 1, _mm_unpackhi_epi16(low, _mm_setzero_si128()));
+    _mm_storeu_si128(pOut + 2, _mm_unpacklo_epi16(high, _mm_setzero_si128()));
+    _mm_storeu_si128(pOut + 3, _mm_unpackhi_epi16(high, _mm_setzero_si128()));
+  }
+#elif defined(Y_UNICODE_NEON)
+  for (; count - i >= 16; i += 16)
+  {
+    uint8x16_t bytes = vld1q_u8(pSource + i);
+    uint16x8_t low = vmovl_u8(vget_low_u8(bytes));
+    uint16x8_t high = vmovl_high_u8(bytes);
+    uint32* pOut = reinterpret_cast<uint32*>(pDestination + i);
+    vst1q_u32(pOut, vmovl_u16(vget_low_u16(low)));
+    vst1q_u32(pOut + 4, vmovl_high_u16(low));
+    vst1q_u32(pOut + 8, vmovl_u16(vget_low_u16(high)));
+    vst1q_u32(pOut + 12, vmovl_high_u16(high));
+  }
+#endif
+
+  for (; i < count; i++)
+    pDestination[i] = char32_t(pSource[i]);
+}
+
+static void CopyASCII(char* pDestination, const char16_t* pSource, uint32 count)
+{
+  uint32 i = 0;
+#if defined(Y_UNICODE_SSE2)
+  for (; count - i >= 16; i += 16)
+  {
+    __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + i));
+    __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + i + 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + i), _mm_packus_epi16(first, second));
+  }
+#elif defined(Y_UNICODE_NEON)
+  for (; count - i >= 16; i += 16)
+  {
+    const uint16* pUnits = reinterpret_cast<const uint16*>(pSource + i);
+    uint8x16_t bytes = vcombine_u8(vmovn_u16(vld1q_u16(pUnits)), vmovn_u16(vld1q_u16(pUnits + 8)));
+    vst1q_u8(reinterpret_cast<uint8*>(pDestination + i), bytes);
+  }
+#endif
+
+  for (; i < count; i++)
+    pDestination[i] = char(pSource[i]);
+}
+
+static void CopyASCII(char* pDestination, const char32_t* pSource, uint32 count)
+{
+  uint32 i = 0;
+#if defined(Y_UNICODE_SSE2)
+  for (; count - i >= 8; i += 8)
+  {
+    __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + i));
+    __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + i + 4));
+    __m128i words = _mm_packs_epi32(first, second);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(pDestination + i), _mm_packus_epi16(words, words));
+  }
+#elif defined(Y_UNICODE_NEON)
+  for (; count - i >= 8; i += 8)
+  {
+    const uint32* pUnits = reinterpret_cast<const uint32*>(pSource + i);
+    uint16x8_t words = vcombine_u16(vmovn_u32(vld1q_u32(pUnits)), vmovn_u32(vld1q_u32(pUnits + 4)));
+    vst1_u8(reinterpret_cast<uint8*>(pDestination + i), vmovn_u16(words));
+  }
+#endif
+
+  for (; i < count; i++)
+    pDestination[i] = char(pSource[i]);
+}
+
+static inline bool IsSurrogate(char32_t codePoint)
+{
+  return (codePoint >= 0xD800 && codePoint <= 0xDFFF);
+}
+
+static inline bool IsContinuation(byte value)
+{
+  return ((value & 0xC0) == 0x80);
+}
+
+// decodes one sequence, returns its length in bytes, or zero if it isn't valid
+static uint32 DecodeUTF8(const byte* pText, uint32 length, char32_t* pCodePoint)
+{
+  uint32 lead = pText[0];
+  if (lead < 0x80)
+  {
+    *pCodePoint = lead;
+    return 1;
+  }
+
+  // continuation bytes can't start a sequence, and C0/C1 can only start overlong ones
+  if (lead < 0xC2)
+    return 0;
+
+  if (lead < 0xE0)
+  {
+    if (length < 2 || !IsContinuation(pText[1]))
+      return 0;
+
+    *pCodePoint = ((lead & 0x1F) << 6) | (pText[1] & 0x3F);
+    return 2;
+  }
+
+  if (lead < 0xF0)
+  {
+    if (length < 3 || !IsContinuation(pText[1]) || !IsContinuation(pText[2]))
+      return 0;
+
+    char32_t codePoint = ((lead & 0x0F) << 12) | ((pText[1] & 0x3F) << 6) | (pText[2] & 0x3F);
+    if (codePoint < 0x800 || IsSurrogate(codePoint))
+      return 0;
+
+    *pCodePoint = codePoint;
+    return 3;
+  }
+
+  if (lead < 0xF5)
+  {
+    if (length < 4 || !IsContinuation(pText[1]) || !IsContinuation(pText[2]) || !IsContinuation(pText[3]))
+      return 0;
+
+    char32_t codePoint =
+      ((lead & 0x07) << 18) | ((pText[1] & 0x3F) << 12) | ((pText[2] & 0x3F) << 6) | (pText[3] & 0x3F);
+    if (codePoint < 0x10000 || codePoint > 0x10FFFF)
+      return 0;
+
+    *pCodePoint = codePoint;
+    return 4;
+  }
+
+  return 0;
+}
+
+// decodes one code point, returns the number of code units it took, or zero for an unpaired surrogate
+static uint32 DecodeUTF16(const char16_t* pText, uint32 length, char32_t* pCodePoint)
+{
+  char32_t unit = pText[0];
+  if (!IsSurrogate(unit))
+  {
+    *pCodePoint = unit;
+    return 1;
+  }
+
+  if (unit >= 0xDC00 || length < 2 || pText[1] < 0xDC00 || pText[1] > 0xDFFF)
+    return 0;
+
+  *pCodePoint = 0x10000 + ((unit - 0xD800) << 10) + (pText[1] - 0xDC00);
+  return 2;
+}
+
+static uint32 DecodeUTF32(const char32_t* pText, uint32 length, char32_t* pCodePoint)
+{
+  UNREFERENCED_PARAMETER(length);
+  char32_t codePoint = pText[0];
+  if (codePoint > 0x10FFFF || IsSurrogate(codePoint))
+    return 0;
+
+  *pCodePoint = codePoint;
+  return 1;
+}
+
+static inline uint32 GetUTF8SequenceLength(char32_t codePoint)
+{
+  return (codePoint < 0x80) ? 1 : ((codePoint < 0x800) ? 2 : ((codePoint < 0x10000) ? 3 : 4));
+}
+
+static inline uint32 GetUTF16SequenceLength(char32_t codePoint)
+{
+  return (codePoint < 0x10000) ? 1 : 2;
+}
+
+static inline uint32 GetUTF32SequenceLength(char32_t codePoint)
+{
+  UNREFERENCED_PARAMETER(codePoint);
+  return 1;
+}
+
+static void EncodeUTF8(char32_t codePoint, char* pDestination)
+{
+  if (codePoint < 0x80)
+  {
+    pDestination[0] = char(codePoint);
+  }
+  else if (codePoint < 0x800)
+  {
+    pDestination[0] = char(0xC0 | (codePoint >> 6));
+    pDestination[1] = char(0x80 | (codePoint & 0x3F));
+  }
+  else if (codePoint < 0x10000)
+  {
+    pDestination[0] = char(0xE0 | (codePoint >> 12));
+    pDestination[1] = char(0x80 | ((codePoint >> 6) & 0x3F));
+    pDestination[2] = char(0x80 | (codePoint & 0x3F));
+  }
+  else
+  {
+    pDestination[0] = char(0xF0 | (codePoint >> 18));
+    pDestination[1] = char(0x80 | ((codePoint >> 12) & 0x3F));
+    pDestination[2] = char(0x80 | ((codePoint >> 6) & 0x3F));
+    pDestination[3] = char(0x80 | (codePoint & 0x3F));
+  }
+}
+
+static void EncodeUTF16(char32_t codePoint, char16_t* pDestination)
+{
+  if (codePoint < 0x10000)
+  {
+    pDestination[0] = char16_t(codePoint);
+  }
+  else
+  {
+    pDestination[0] = char16_t(0xD800 + ((codePoint - 0x10000) >> 10));
+    pDestination[1] = char16_t(0xDC00 + ((codePoint - 0x10000) & 0x3FF));
+  }
+}
+
+static void EncodeUTF32(char32_t codePoint, char32_t* pDestination)
+{
+  pDestination[0] = codePoint;
+}
+
+// Walks the source an ASCII run and then a code point at a time, returning the length of the source that is valid
+// and adding the converted length to *pConvertedLength.
+template<typename SourceType, typename DecodeFunction, typename LengthFunction>
+static uint32 MeasureText(const SourceType* pSource, uint32 sourceLength, DecodeFunction decode,
+                          LengthFunction sequenceLength, uint32* pConvertedLength)
+{
+  uint32 read = 0;
+  uint32 converted = 0;
+  while (read < sourceLength)
+  {
+    uint32 run = CountASCII(pSource + read, sourceLength - read);
+    read += run;
+    converted += run;
+    if (read == sourceLength)
+      break;
+
+    char32_t codePoint;
+    uint32 unitCount = decode(pSource + read, sourceLength - read, &codePoint);
+    if (unitCount == 0)
+      break;
+
+    read += unitCount;
+    converted += sequenceLength(codePoint);
+  }
+
+  *pConvertedLength = converted;
+  return read;
+}
+
+template<typename DestinationType, typename SourceType, typename DecodeFunction, typename LengthFunction,
+         typename EncodeFunction>
+static uint32 ConvertText(DestinationType* pDestination, uint32 destinationLength, const SourceType* pSource,
+                          uint32 sourceLength, DecodeFunction decode, LengthFunction sequenceLength,
+                          EncodeFunction encode)
+{
+  uint32 read = 0;
+  uint32 written = 0;
+  while (read < sourceLength)
+  {
+    uint32 run = CountASCII(pSource + read, Min(sourceLength - read, destinationLength - written));
+    CopyASCII(pDestination + written, pSource + read, run);
+    read += run;
+    written += run;
+    if (read == sourceLength)
+      break;
+
+    char32_t codePoint;
+    uint32 unitCount = decode(pSource + read, sourceLength - read, &codePoint);
+    if (unitCount == 0 || destinationLength - written < sequenceLength(codePoint))
+      return UnicodeConversion::InvalidLength;
+
+    encode(codePoint, pDestination + written);
+    read += unitCount;
+    written += sequenceLength(codePoint);
+  }
+
+  return written;
+}
+
+static const byte* AsBytes(const char* pText)
+{
+  return reinterpret_cast<const byte*>(pText);
+}
+
+namespace UnicodeConversion {
+bool ValidateUTF8(const char* pText, uint32 length, uint32* pErrorOffset /* = NULL */)
+{
+  uint32 convertedLength;
+  uint32 validLength = MeasureText(AsBytes(pText), length, DecodeUTF8, GetUTF32SequenceLength, &convertedLength);
+  if (pErrorOffset != NULL && validLength != length)
+    *pErrorOffset = validLength;
+
+  return (validLength == length);
+}
+
+bool ValidateUTF16(const char16_t* pText, uint32 length, uint32* pErrorOffset /* = NULL */)
+{
+  uint32 convertedLength;
+  uint32 validLength = MeasureText(pText, length, DecodeUTF16, GetUTF32SequenceLength, &convertedLength);
+  if (pErrorOffset != NULL && validLength != length)
+    *pErrorOffset = validLength;
+
+  return (validLength == length);
+}
+
+bool ValidateUTF32(const char32_t* pText, uint32 length, uint32* pErrorOffset /* = NULL */)
+{
+  uint32 convertedLength;
+  uint32 validLength = MeasureText(pText, length, DecodeUTF32, GetUTF32SequenceLength, &convertedLength);
+  if (pErrorOffset != NULL && validLength != length)
+    *pErrorOffset = validLength;
+
+  return (validLength == length);
+}
+
+uint32 GetUTF16Length(const char* pText, uint32 length)
+{
+  uint32 convertedLength;
+  if (MeasureText(AsBytes(pText), length, DecodeUTF8, GetUTF16SequenceLength, &convertedLength) != length)
+    return InvalidLength;
+
+  return convertedLength;
+}
+
+uint32 GetUTF32Length(const char* pText, uint32 length)
+{
+  uint32 convertedLength;
+  if (MeasureText(AsBytes(pText), length, DecodeUTF8, GetUTF32SequenceLength, &convertedLength) != length)
+    return InvalidLength;
+
+  return convertedLength;
+}
+
+uint32 GetUTF8Length(const char16_t* pText, uint32 length)
+{
+  uint32 convertedLength;
+  if (MeasureText(pText, length, DecodeUTF16, GetUTF8SequenceLength, &convertedLength) != length)
+    return InvalidLength;
+
+  return convertedLength;
+}
+
+uint32 GetUTF8Length(const char32_t* pText, uint32 length)
+{
+  uint32 convertedLength;
+  if (MeasureText(pText, length, DecodeUTF32, GetUTF8SequenceLength, &convertedLength) != length)
+    return InvalidLength;
+
+  return convertedLength;
+}
+
+uint32 UTF8ToUTF16(char16_t* pDestination, uint32 destinationLength, const char* pSource, uint32 sourceLength)
+{
+  return ConvertText(pDestination, destinationLength, AsBytes(pSource), sourceLength, DecodeUTF8,
+                     GetUTF16SequenceLength, EncodeUTF16);
+}
+
+uint32 UTF8ToUTF32(char32_t* pDestination, uint32 destinationLength, const char* pSource, uint32 sourceLength)
+{
+  return ConvertText(pDestination, destinationLength, AsBytes(pSource), sourceLength, DecodeUTF8,
+                     GetUTF32SequenceLength, EncodeUTF32);
+}
+
+uint32 UTF16ToUTF8(char* pDestination, uint32 destinationLength, const char16_t* pSource, uint32 sourceLength)
+{
+  return ConvertText(pDestination, destinationLength, pSource, sourceLength, DecodeUTF16, GetUTF8SequenceLength,
+                     EncodeUTF8);
+}
+
+uint32 UTF32ToUTF8(char* pDestination, uint32 destinationLength, const char32_t* pSource, uint32 sourceLength)
+{
+  return ConvertText(pDestination, destinationLength, pSource, sourceLength, DecodeUTF32, GetUTF8SequenceLength,
+                     EncodeUTF8);
+}
+
+bool AppendUTF16(String& destination, const char16_t* pSource, uint32 sourceLength)
+{
+  uint32 length = GetUTF8Length(pSource, sourceLength);
+  if (length == InvalidLength)
+    return false;
+
+  uint32 startLength = destination.GetLength();
+  destination.Resize(startLength + length);
+  uint32 written = UTF16ToUTF8(destination.GetWriteableCharArray() + startLength, length, pSource, sourceLength);
+  DebugAssert(written == length);
+  UNREFERENCED_PARAMETER(written);
+  return true;
+}
+
+bool AppendUTF32(String& destination, const char32_t* pSource, uint32 sourceLength)
+{
+  uint32 length = GetUTF8Length(pSource, sourceLength);
+  if (length == InvalidLength)
+    return false;
+
+  uint32 startLength = destination.GetLength();
+  destination.Resize(startLength + length);
+  uint32 written = UTF32ToUTF8(destination.GetWriteableCharArray() + startLength, length, pSource, sourceLength);
+  DebugAssert(written == length);
+  UNREFERENCED_PARAMETER(written);
+  return true;
+}
+} // namespace UnicodeConversion
@@ -0,0 +1,664 @@
+#include "YBaseLib/VirtualFileSystem.h"
+#include "YBaseLib/BinaryBlob.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/GlobPattern.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/MutexLock.h"
+#include "YBaseLib/Timestamp.h"
+#include "YBaseLib/ZipArchive.h"
+Log_SetChannel(VirtualFileSystem);
+
+const uint32 VirtualFileSystem::InvalidIndex;
+const uint32 VirtualFileSystem::RootEntry;
+
+static bool IsHiddenName(const char* name)
+{
+  return (name[0] == '.');
+}
+
+static bool IsDirectory(const FILESYSTEM_STAT_DATA& statData)
+{
+  return (statData.Attributes & FILESYSTEM_FILE_ATTRIBUTE_DIRECTORY) != 0;
+}
+
+// Virtual paths have '/' separators, no leading, trailing or empty parts, and no '.' or '..', which can't go above
+// the root. Either separator is accepted.
+static void CanonicalizeVirtualPath(String& destination, const char* path)
+{
+  destination.Clear();
+
+  const char* pCurrent = path;
+  while (*pCurrent != '\0')
+  {
+    const char* pEnd = pCurrent;
+    while (*pEnd != '\0' && *pEnd != '/' && *pEnd != '\\')
+      pEnd++;
+
+    uint32 partLength = (uint32)(pEnd - pCurrent);
+    if (partLength == 2 && pCurrent[0] == '.' && pCurrent[1] == '.')
+    {
+      int32 separatorPosition = destination.RFind('/');
+      destination.Erase((separatorPosition >= 0) ? separatorPosition : 0);
+    }
+    else if (partLength > 1 || (partLength == 1 && pCurrent[0] != '.'))
+    {
+      if (destination.GetLength() > 0)
+        destination.AppendCharacter('/');
+      destination.AppendString(pCurrent, partLength);
+    }
+
+    pCurrent = (*pEnd != '\0') ? pEnd + 1 : pEnd;
+  }
+}
+
+VirtualFileSystem::VirtualFileSystem() : m_nextMountID(1)
+{
+  ResetEntries();
+}
+
+VirtualFileSystem::~VirtualFileSystem()
+{
+  UnmountAll();
+}
+
+uint32 VirtualFileSystem::MountDirectory(const char* mountPoint, const char* directoryPath, int32 priority /* = 0 */,
+                                         ThreadPool* pThreadPool /* = nullptr */)
+{
+  Mount* pMount = new Mount();
+  pMount->Type = MOUNT_TYPE_DIRECTORY;
+  CanonicalizeVirtualPath(pMount->MountPoint, mountPoint);
+  pMount->Priority = priority;
+  pMount->DirectoryPath = directoryPath;
+  pMount->pArchive = nullptr;
+  if (!ListMount(pMount, pThreadPool))
+  {
+    Log_ErrorPrintf("VirtualFileSystem::MountDirectory: '%s' is not a directory", directoryPath);
+    delete pMount;
+    return 0;
+  }
+
+  return AddMount(pMount);
+}
+
+#ifdef HAVE_ZLIB
+
+uint32 VirtualFileSystem::MountArchive(const char* mountPoint, ZipArchive* pArchive, int32 priority /* = 0 */)
+{
+  Mount* pMount = new Mount();
+  pMount->Type = MOUNT_TYPE_ARCHIVE;
+  CanonicalizeVirtualPath(pMount->MountPoint, mountPoint);
+  pMount->Priority = priority;
+  pMount->pArchive = pArchive;
+  ListMount(pMount, nullptr);
+  return AddMount(pMount);
+}
+
+#endif
+
+uint32 VirtualFileSystem::MountMemory(const char* mountPoint, int32 priority /* = 0 */)
+{
+  Mount* pMount = new Mount();
+  pMount->Type = MOUNT_TYPE_MEMORY;
+  CanonicalizeVirtualPath(pMount->MountPoint, mountPoint);
+  pMount->Priority = priority;
+  pMount->pArchive = nullptr;
+  return AddMount(pMount);
+}
+
+bool VirtualFileSystem::AddMemoryFile(uint32 mountID, const char* path, BinaryBlob* pBlob)
+{
+  PathString mountPath;
+  CanonicalizeVirtualPath(mountPath, path);
+  if (mountPath.IsEmpty())
+    return false;
+
+  m_lock.LockExclusive();
+
+  uint32 mountIndex = FindMountIndex(mountID);
+  if (mountIndex == InvalidIndex || m_mounts[mountIndex]->Type != MOUNT_TYPE_MEMORY)
+  {
+    m_lock.UnlockExclusive();
+    return false;
+  }
+
+  // the table leads to the mount's own entry, unless another mount is in front of it
+  Mount* pMount = m_mounts[mountIndex];
+  PathString fullPath;
+  if (pMount->MountPoint.GetLength() > 0)
+    fullPath.Format("%s/%s", pMount->MountPoint.GetCharArray(), mountPath.GetCharArray());
+  else
+    fullPath.Assign(mountPath);
+
+  uint32 mountEntryIndex = InvalidIndex;
+  uint32 entryIndex = FindEntry(fullPath);
+  if (entryIndex != InvalidIndex && m_entries[entryIndex].MountIndex == mountIndex)
+  {
+    mountEntryIndex = m_entries[entryIndex].MountEntryIndex;
+  }
+  else if (entryIndex != InvalidIndex)
+  {
+    for (uint32 i = 0; i < pMount->Entries.GetSize(); i++)
+    {
+      if (pMount->Entries[i].Path.CompareInsensitive(mountPath))
+      {
+        mountEntryIndex = i;
+        break;
+      }
+    }
+  }
+
+  if (mountEntryIndex == InvalidIndex)
+  {
+    mountEntryIndex = pMount->Entries.GetSize();
+    pMount->Entries.Add(MountEntry());
+    pMount->Entries[mountEntryIndex].Path = mountPath;
+    pMount->Entries[mountEntryIndex].pBlob = nullptr;
+  }
+
+  MountEntry& mountEntry = pMount->Entries[mountEntryIndex];
+  pBlob->AddRef();
+  if (mountEntry.pBlob != nullptr)
+    mountEntry.pBlob->Release();
+  mountEntry.pBlob = pBlob;
+  mountEntry.StatData.Attributes = 0;
+  mountEntry.StatData.ModificationTime = Timestamp::Now();
+  mountEntry.StatData.Size = pBlob->GetDataSize();
+  InsertEntry(mountIndex, mountEntryIndex);
+
+  m_lock.UnlockExclusive();
+  return true;
+}
+
+bool VirtualFileSystem::Unmount(uint32 mountID)
+{
+  m_lock.LockExclusive();
+
+  uint32 mountIndex = FindMountIndex(mountID);
+  if (mountIndex == InvalidIndex)
+  {
+    m_lock.UnlockExclusive();
+    return false;
+  }
+
+  Mount* pMount = m_mounts[mountIndex];
+  m_mounts.OrderedRemove(mountIndex);
+  delete pMount;
+  RebuildTable();
+
+  m_lock.UnlockExclusive();
+  return true;
+}
+
+void VirtualFileSystem::UnmountAll()
+{
+  m_lock.LockExclusive();
+
+  for (uint32 i = 0; i < m_mounts.GetSize(); i++)
+    delete m_mounts[i];
+  m_mounts.Clear();
+  ResetEntries();
+
+  m_lock.UnlockExclusive();
+}
+
+void VirtualFileSystem::Refresh(ThreadPool* pThreadPool /* = nullptr */)
+{
+  m_lock.LockExclusive();
+
+  // a directory that has gone away is left empty rather than unmounted, so its id stays good
+  for (uint32 i = 0; i < m_mounts.GetSize(); i++)
+  {
+    if (m_mounts[i]->Type != MOUNT_TYPE_MEMORY && !ListMount(m_mounts[i], pThreadPool))
+    {
+      Log_WarningPrintf("VirtualFileSystem::Refresh: '%s' is no longer a directory",
+                        m_mounts[i]->DirectoryPath.GetCharArray());
+    }
+  }
+  RebuildTable();
+
+  m_lock.UnlockExclusive();
+}
+
+uint32 VirtualFileSystem::GetEntryCount() const
+{
+  m_lock.LockShared();
+  uint32 count = m_pathTable.GetMemberCount() - 1;
+  m_lock.UnlockShared();
+  return count;
+}
+
+bool VirtualFileSystem::FindFiles(const char* path, const char* pattern, uint32 flags,
+                                  FileSystem::FindResultsArray* pResults) const
+{
+  if (!(flags & FILESYSTEM_FIND_KEEP_ARRAY))
+    pResults->Clear();
+
+  PathString searchPath;
+  CanonicalizeVirtualPath(searchPath, path);
+  GlobPattern compiledPattern(pattern, GlobPattern::FLAG_CASE_INSENSITIVE);
+
+  m_lock.LockShared();
+
+  uint32 searchIndex = FindEntry(searchPath);
+  if (searchIndex == InvalidIndex || !IsDirectory(m_entries[searchIndex].StatData))
+  {
+    m_lock.UnlockShared();
+    return false;
+  }
+
+  // relative names start after the search path and its separator
+  uint32 searchPathLength = m_entries[searchIndex].Path.GetLength();
+  if (searchPathLength > 0)
+    searchPathLength++;
+
+  uint32 nFiles = 0;
+  PODArray<uint32> directoryStack;
+  directoryStack.Add(searchIndex);
+  while (directoryStack.GetSize() > 0)
+  {
+    uint32 directoryIndex = directoryStack.PopBack();
+    for (uint32 childIndex = m_entries[directoryIndex].FirstChild; childIndex != InvalidIndex;
+         childIndex = m_entries[childIndex].NextSibling)
+    {
+      const Entry& child = m_entries[childIndex];
+      const char* name = child.Path.GetCharArray() + child.NameOffset;
+      if (IsHiddenName(name) && !(flags & FILESYSTEM_FIND_HIDDEN_FILES))
+        continue;
+
+      if (IsDirectory(child.StatData))
+      {
+        if (flags & FILESYSTEM_FIND_RECURSIVE)
+          directoryStack.Add(childIndex);
+
+        if (!(flags & FILESYSTEM_FIND_FOLDERS))
+          continue;
+      }
+      else
+      {
+        if (!(flags & FILESYSTEM_FIND_FILES))
+          continue;
+      }
+
+      if (!compiledPattern.MatchesAll() && !compiledPattern.Match(name))
+        continue;
+
+      FILESYSTEM_FIND_DATA outData;
+      if (flags & FILESYSTEM_FIND_RELATIVE_PATHS)
+        Y_strncpy(outData.FileName, countof(outData.FileName), child.Path.GetCharArray() + searchPathLength);
+      else
+        Y_strncpy(outData.FileName, countof(outData.FileName), child.Path);
+
+      outData.Attributes = child.StatData.Attributes;
+      outData.ModificationTime = child.StatData.ModificationTime;
+      outData.Size = child.StatData.Size;
+      pResults->Add(outData);
+      nFiles++;
+    }
+  }
+
+  m_lock.UnlockShared();
+  return (nFiles > 0);
+}
+
+bool VirtualFileSystem::StatFile(const char* path, FILESYSTEM_STAT_DATA* pStatData) const
+{
+  PathString virtualPath;
+  CanonicalizeVirtualPath(virtualPath, path);
+
+  m_lock.LockShared();
+  uint32 entryIndex = FindEntry(virtualPath);
+  if (entryIndex != InvalidIndex)
+    *pStatData = m_entries[entryIndex].StatData;
+  m_lock.UnlockShared();
+  return (entryIndex != InvalidIndex);
+}
+
+bool VirtualFileSystem::FileExists(const char* path) const
+{
+  FILESYSTEM_STAT_DATA statData;
+  return StatFile(path, &statData) && !IsDirectory(statData);
+}
+
+bool VirtualFileSystem::DirectoryExists(const char* path) const
+{
+  FILESYSTEM_STAT_DATA statData;
+  return StatFile(path, &statData) && IsDirectory(statData);
+}
+
+ByteStream* VirtualFileSystem::OpenFile(const char* path, uint32 openMode) const
+{
+  if ((openMode & (BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_APPEND | BYTESTREAM_OPEN_TRUNCATE | BYTESTREAM_OPEN_CREATE |
+                   BYTESTREAM_OPEN_CREATE_PATH | BYTESTREAM_OPEN_ATOMIC_UPDATE)) != 0)
+  {
+    Log_ErrorPrintf("VirtualFileSystem::OpenFile: '%s' can only be opened for reading", path);
+    return nullptr;
+  }
+
+  PathString virtualPath;
+  CanonicalizeVirtualPath(virtualPath, path);
+
+  // the source is opened once the lock is released, memory files hold their blob until then
+  PathString sourcePath;
+  MOUNT_TYPE mountType = MOUNT_TYPE_DIRECTORY;
+#ifdef HAVE_ZLIB
+  ZipArchive* pArchive = nullptr;
+#endif
+  BinaryBlob* pBlob = nullptr;
+
+  m_lock.LockShared();
+
+  uint32 entryIndex = FindEntry(virtualPath);
+  if (entryIndex == InvalidIndex || m_entries[entryIndex].MountIndex == InvalidIndex ||
+      IsDirectory(m_entries[entryIndex].StatData))
+  {
+    m_lock.UnlockShared();
+    return nullptr;
+  }
+
+  const Entry& entry = m_entries[entryIndex];
+  const Mount* pMount = m_mounts[entry.MountIndex];
+  const MountEntry& mountEntry = pMount->Entries[entry.MountEntryIndex];
+  mountType = pMount->Type;
+  if (mountType == MOUNT_TYPE_DIRECTORY)
+  {
+    sourcePath.Format("%s/%s", pMount->DirectoryPath.GetCharArray(), mountEntry.Path.GetCharArray());
+  }
+  else if (mountType == MOUNT_TYPE_ARCHIVE)
+  {
+    sourcePath.Assign(mountEntry.SourceName);
+#ifdef HAVE_ZLIB
+    pArchive = pMount->pArchive;
+#endif
+  }
+  else
+  {
+    pBlob = mountEntry.pBlob;
+    pBlob->AddRef();
+  }
+
+  m_lock.UnlockShared();
+
+  ByteStream* pStream = nullptr;
+  if (mountType == MOUNT_TYPE_DIRECTORY)
+  {
+    if (!ByteStream_OpenFileStream(sourcePath, openMode, &pStream))
+      pStream = nullptr;
+  }
+  else if (mountType == MOUNT_TYPE_ARCHIVE)
+  {
+#ifdef HAVE_ZLIB
+    pStream = pArchive->OpenFile(sourcePath, openMode);
+#endif
+  }
+  else
+  {
+    pStream = pBlob->CreateReadOnlyStream();
+    pBlob->Release();
+  }
+
+  return pStream;
+}
+
+bool VirtualFileSystem::ResolvePath(const char* path, uint32* pMountID, MOUNT_TYPE* pMountType,
+                                    String* pSourcePath) const
+{
+  PathString virtualPath;
+  CanonicalizeVirtualPath(virtualPath, path);
+
+  m_lock.LockShared();
+
+  uint32 entryIndex = FindEntry(virtualPath);
+  if (entryIndex == InvalidIndex)
+  {
+    m_lock.UnlockShared();
+    return false;
+  }
+
+  const Entry& entry = m_entries[entryIndex];
+  if (entry.MountIndex == InvalidIndex)
+  {
+    *pMountID = 0;
+    *pMountType = MOUNT_TYPE_DIRECTORY;
+    pSourcePath->Clear();
+    m_lock.UnlockShared();
+    return true;
+  }
+
+  const Mount* pMount = m_mounts[entry.MountIndex];
+  const MountEntry& mountEntry = pMount->Entries[entry.MountEntryIndex];
+  *pMountID = pMount->ID;
+  *pMountType = pMount->Type;
+  if (pMount->Type == MOUNT_TYPE_DIRECTORY)
+    pSourcePath->Format("%s/%s", pMount->DirectoryPath.GetCharArray(), mountEntry.Path.GetCharArray());
+  else if (pMount->Type == MOUNT_TYPE_ARCHIVE)
+    pSourcePath->Assign(mountEntry.SourceName);
+  else
+    pSourcePath->Assign(mountEntry.Path);
+
+  m_lock.UnlockShared();
+  return true;
+}
+
+VirtualFileSystem::Mount::~Mount()
+{
+  for (uint32 i = 0; i < Entries.GetSize(); i++)
+  {
+    if (Entries[i].pBlob != nullptr)
+      Entries[i].pBlob->Release();
+  }
+}
+
+uint32 VirtualFileSystem::AddMount(Mount* pMount)
+{
+  m_lock.LockExclusive();
+
+  // kept in the order they win in, lowest priority first, the last mounted last where priorities are the same
+  pMount->ID = m_nextMountID++;
+  uint32 mountIndex = m_mounts.GetSize();
+  while (mountIndex > 0 && m_mounts[mountIndex - 1]->Priority > pMount->Priority)
+    mountIndex--;
+
+  m_mounts.Insert(pMount, mountIndex);
+  if (mountIndex == m_mounts.GetSize() - 1)
+  {
+    // nothing after it, so it can go straight on top
+    PathString mountPoint(pMount->MountPoint);
+    GetOrCreateEntry(mountPoint);
+    for (uint32 i = 0; i < pMount->Entries.GetSize(); i++)
+      InsertEntry(mountIndex, i);
+  }
+  else
+  {
+    RebuildTable();
+  }
+
+  uint32 mountID = pMount->ID;
+  m_lock.UnlockExclusive();
+  return mountID;
+}
+
+bool VirtualFileSystem::ListMount(Mount* pMount, ThreadPool* pThreadPool)
+{
+  // memory mounts aren't listed, so there are no blobs to release
+  DebugAssert(pMount->Type != MOUNT_TYPE_MEMORY);
+  pMount->Entries.Clear();
+
+  if (pMount->Type == MOUNT_TYPE_DIRECTORY)
+  {
+    if (!FileSystem::DirectoryExists(pMount->DirectoryPath))
+      return false;
+
+    // matches come in from the pool's threads
+    Mutex lock;
+    FileSystem::FindFilesParallel(pMount->DirectoryPath, "*",
+                                  FILESYSTEM_FIND_RECURSIVE | FILESYSTEM_FIND_RELATIVE_PATHS |
+                                    FILESYSTEM_FIND_HIDDEN_FILES | FILESYSTEM_FIND_FOLDERS | FILESYSTEM_FIND_FILES,
+                                  pThreadPool, [pMount, &lock](const FILESYSTEM_FIND_DATA* pFindData) {
+                                    MountEntry mountEntry;
+                                    CanonicalizeVirtualPath(mountEntry.Path, pFindData->FileName);
+                                    mountEntry.StatData.Attributes = pFindData->Attributes;
+                                    mountEntry.StatData.ModificationTime = pFindData->ModificationTime;
+                                    mountEntry.StatData.Size = pFindData->Size;
+                                    mountEntry.pBlob = nullptr;
+
+                                    MutexLock locker(lock);
+                                    pMount->Entries.Add(mountEntry);
+                                  });
+    return true;
+  }
+#ifdef HAVE_ZLIB
+  else if (pMount->Type == MOUNT_TYPE_ARCHIVE)
+  {
+    // names ending in a separator are the archive's own directory entries
+    struct Callback
+    {
+      static void Invoke(const char* filename, const FILESYSTEM_STAT_DATA* pStatData, void* pUserData)
+      {
+        MountEntry mountEntry;
+        CanonicalizeVirtualPath(mountEntry.Path, filename);
+        if (mountEntry.Path.IsEmpty())
+          return;
+
+        uint32 length = Y_strlen(filename);
+        bool isDirectory = (filename[length - 1] == '/' || filename[length - 1] == '\\');
+        mountEntry.SourceName = filename;
+        mountEntry.StatData = *pStatData;
+        if (isDirectory)
+        {
+          mountEntry.StatData.Attributes |= FILESYSTEM_FILE_ATTRIBUTE_DIRECTORY;
+          mountEntry.StatData.Size = 0;
+        }
+        mountEntry.pBlob = nullptr;
+        reinterpret_cast<Mount*>(pUserData)->Entries.Add(mountEntry);
+      }
+    };
+
+    pMount->pArchive->EnumerateFiles(&Callback::Invoke, pMount);
+  }
+#endif
+
+  return true;
+}
+
+void VirtualFileSystem::RebuildTable()
+{
+  ResetEntries();
+  for (uint32 mountIndex = 0; mountIndex < m_mounts.GetSize(); mountIndex++)
+  {
+    const Mount* pMount = m_mounts[mountIndex];
+    PathString mountPoint(pMount->MountPoint);
+    GetOrCreateEntry(mountPoint);
+    for (uint32 i = 0; i < pMount->Entries.GetSize(); i++)
+      InsertEntry(mountIndex, i);
+  }
+}
+
+void VirtualFileSystem::InsertEntry(uint32 mountIndex, uint32 mountEntryIndex)
+{
+  const Mount* pMount = m_mounts[mountIndex];
+  const MountEntry& mountEntry = pMount->Entries[mountEntryIndex];
+
+  PathString fullPath;
+  if (pMount->MountPoint.GetLength() > 0)
+    fullPath.Format("%s/%s", pMount->MountPoint.GetCharArray(), mountEntry.Path.GetCharArray());
+  else
+    fullPath.Assign(mountEntry.Path);
+
+  Entry& entry = m_entries[GetOrCreateEntry(fullPath)];
+  if (entry.MountIndex != InvalidIndex && entry.MountIndex > mountIndex)
+    return;
+
+  entry.StatData = mountEntry.StatData;
+  entry.MountIndex = mountIndex;
+  entry.MountEntryIndex = mountEntryIndex;
+}
+
+uint32 VirtualFileSystem::FindEntry(const String& path) const
+{
+  HashType hash = CIStringHashTable<uint32>::GetStringHash(path.GetCharArray(), path.GetLength());
+  if (!m_pathFilter.MayContain(hash))
+    return InvalidIndex;
+
+  const CIStringHashTable<uint32>::Member* pMember = m_pathTable.Find(path, hash);
+  return (pMember != nullptr) ? pMember->Value : InvalidIndex;
+}
+
+uint32 VirtualFileSystem::GetOrCreateEntry(const String& path)
+{
+  uint32 entryIndex = FindEntry(path);
+  if (entryIndex != InvalidIndex)
+    return entryIndex;
+
+  // parents found after their children start out as directories from no mount, and are filled in if they turn up
+  int32 separatorPosition = path.RFind('/');
+  uint32 parentIndex = RootEntry;
+  if (separatorPosition >= 0)
+  {
+    PathString parentPath;
+    parentPath.AppendSubString(path, 0, separatorPosition);
+    parentIndex = GetOrCreateEntry(parentPath);
+  }
+
+  entryIndex = m_entries.GetSize();
+  m_entries.Add(Entry());
+
+  Entry& entry = m_entries[entryIndex];
+  entry.Path = path;
+  entry.NameOffset = (uint32)(separatorPosition + 1);
+  entry.StatData.Attributes = FILESYSTEM_FILE_ATTRIBUTE_DIRECTORY;
+  entry.StatData.ModificationTime.SetUnixTimestamp(0);
+  entry.StatData.Size = 0;
+  entry.MountIndex = InvalidIndex;
+  entry.MountEntryIndex = InvalidIndex;
+  entry.Parent = parentIndex;
+  entry.FirstChild = InvalidIndex;
+  entry.NextSibling = m_entries[parentIndex].FirstChild;
+  m_entries[parentIndex].FirstChild = entryIndex;
+
+  const CIStringHashTable<uint32>::Member* pMember = m_pathTable.Insert(entry.Path, entryIndex);
+  m_pathFilter.Add(pMember->Hash);
+  if (m_pathFilter.IsOverfilled())
+    RebuildPathFilter();
+
+  return entryIndex;
+}
+
+void VirtualFileSystem::RebuildPathFilter()
+{
+  m_pathFilter.Reset(Max(m_pathTable.GetMemberCount() * 2, 256u));
+  for (CIStringHashTable<uint32>::ConstIterator itr = m_pathTable.Begin(); !itr.AtEnd(); itr.Forward())
+    m_pathFilter.Add(itr->Hash);
+}
+
+void VirtualFileSystem::ResetEntries()
+{
+  m_entries.Clear();
+  m_pathTable.Clear();
+
+  Entry root;
+  root.NameOffset = 0;
+  root.StatData.Attributes = FILESYSTEM_FILE_ATTRIBUTE_DIRECTORY;
+  root.StatData.ModificationTime.SetUnixTimestamp(0);
+  root.StatData.Size = 0;
+  root.MountIndex = InvalidIndex;
+  root.MountEntryIndex = InvalidIndex;
+  root.Parent = InvalidIndex;
+  root.FirstChild = InvalidIndex;
+  root.NextSibling = InvalidIndex;
+  m_entries.Add(root);
+  m_pathTable.Insert(EmptyString, RootEntry);
+  RebuildPathFilter();
+}
+
+uint32 VirtualFileSystem::FindMountIndex(uint32 mountID) const
+{
+  for (uint32 i = 0; i < m_mounts.GetSize(); i++)
+  {
+    if (m_mounts[i]->ID == mountID)
+      return i;
+  }
+
+  return InvalidIndex;
+}
@@ -29,15 +29,39 @@ ConditionVariable::~ConditionVariable() {}
 void ConditionVariable::SleepAndRelease(Mutex* pMutex)
 {
   DebugAssert(pMutex->m_CriticalSection.RecursionCount == 1);
+#if Y_LOCK_PROFILING
+  LockProfileConditionWait profileWait(pMutex->m_profile);
+#endif
   SleepConditionVariableCS(&m_ConditionVariable, &pMutex->m_CriticalSection, GetWaitTimeout());
 }
 
 void ConditionVariable::SleepAndRelease(RecursiveMutex* pMutex)
 {
   DebugAssert(pMutex->m_CriticalSection.RecursionCount == 1);
+#if Y_LOCK_PROFILING
+  LockProfileConditionWait profileWait(pMutex->m_profile);
+#endif
   SleepConditionVariableCS(&m_ConditionVariable, &pMutex->m_CriticalSection, GetWaitTimeout());
 }
 
+bool ConditionVariable::SleepAndRelease(Mutex* pMutex, uint32 timeout)
+{
+  DebugAssert(pMutex->m_CriticalSection.RecursionCount == 1);
+#if Y_LOCK_PROFILING
+  LockProfileConditionWait profileWait(pMutex->m_profile);
+#endif
+  return (SleepConditionVariableCS(&m_ConditionVariable, &pMutex->m_CriticalSection, timeout) != FALSE);
+}
+
+bool ConditionVariable::SleepAndRelease(RecursiveMutex* pMutex, uint32 timeout)
+{
+  DebugAssert(pMutex->m_CriticalSection.RecursionCount == 1);
+#if Y_LOCK_PROFILING
+  LockProfileConditionWait profileWait(pMutex->m_profile);
+#endif
+  return (SleepConditionVariableCS(&m_ConditionVariable, &pMutex->m_CriticalSection, timeout) != FALSE);
+}
+
 void ConditionVariable::WakeAll()
 {
   WakeAllConditionVariable(&m_ConditionVariable);
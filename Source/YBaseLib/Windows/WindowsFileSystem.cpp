@@ -4,10 +4,35 @@
 // Windows FileSystem implementation.
 #ifdef Y_PLATFORM_WINDOWS
 
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/ConditionVariable.h"
+#include "YBaseLib/GlobPattern.h"
 #include "YBaseLib/Log.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/ParallelFor.h"
+#include "YBaseLib/ThreadPool.h"
+#include "YBaseLib/UnicodeConversion.h"
+#include <cstddef>
+#include <cstring>
 #include <shlobj.h>
 Log_SetChannel(FileSystem);
 
+// paths are passed to the wide APIs so they aren't limited to the ANSI code page, converted on the stack
+typedef UTF16StackString<MAX_PATH> WidePath;
+
+// converts a name returned by the wide APIs back to UTF-8, returns false if it isn't valid UTF-16
+static bool GetUTF8FileName(char* pDestination, uint32 destinationSize, const WCHAR* pFileName)
+{
+  const char16_t* pUnits = reinterpret_cast<const char16_t*>(pFileName);
+  uint32 length = UnicodeConversion::UTF16ToUTF8(pDestination, destinationSize - 1, pUnits, (uint32)wcslen(pFileName));
+  if (length == UnicodeConversion::InvalidLength)
+    return false;
+
+  pDestination[length] = '\0';
+  return true;
+}
+
 static uint32 TranslateWin32Attributes(uint32 Win32Attributes)
 {
   uint32 r = 0;
@@ -124,6 +149,14 @@ public:
         DebugAssert(pCurrentPointer < (m_pBuffer + m_bufferSize));
       }
     }
+    else
+    {
+      // the buffer overflowed and the changes were thrown away
+      ChangeInfo changeInfo;
+      changeInfo.Path = m_directoryPath;
+      changeInfo.Event = ChangeEvent_Overflow;
+      callback(&changeInfo, pUserData);
+    }
 
     // re-queue the operation
     QueueReadDirectoryChanges();
@@ -153,8 +186,9 @@ private:
 FileSystem::ChangeNotifier* FileSystem::CreateChangeNotifier(const char* path, bool recursiveWatch)
 {
   // open the directory up
-  HANDLE hDirectory = CreateFileA(path, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-                                  nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+  HANDLE hDirectory = CreateFileW(WidePath(path).GetWideCharArray(), FILE_LIST_DIRECTORY,
+                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                  FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
   if (hDirectory == nullptr)
     return nullptr;
 
@@ -229,8 +263,8 @@ void FileSystem::BuildOSPath(String& Destination)
   BuildOSPath(Destination, Destination);
 }
 
-static uint32 RecursiveFindFiles(const char* OriginPath, const char* ParentPath, const char* Path, const char* Pattern,
-                                 uint32 Flags, FileSystem::FindResultsArray* pResults)
+static uint32 RecursiveFindFiles(const char* OriginPath, const char* ParentPath, const char* Path,
+                                 const GlobPattern& Pattern, uint32 Flags, FileSystem::FindResultsArray* pResults)
 {
   uint32 tempPathLength = Y_strlen(OriginPath) + 2;
   if (ParentPath != NULL)
@@ -251,22 +285,15 @@ static uint32 RecursiveFindFiles(const char* OriginPath, const char* ParentPath,
     Y_snprintf(tempStr, tempPathLength + 1, "%s\\*", OriginPath);
   }
 
-  WIN32_FIND_DATA wfd;
-  HANDLE hFind = FindFirstFileA(tempStr, &wfd);
+  WIN32_FIND_DATAW wfd;
+  HANDLE hFind = FindFirstFileW(WidePath(tempStr).GetWideCharArray(), &wfd);
   if (hFind == INVALID_HANDLE_VALUE)
     return 0;
 
-  // small speed optimization for '*' case
-  bool hasWildCards = false;
-  bool wildCardMatchAll = false;
   uint32 nFiles = 0;
-  if (Y_strpbrk(Pattern, "*?") != NULL)
-  {
-    hasWildCards = true;
-    wildCardMatchAll = !(Y_strcmp(Pattern, "*"));
-  }
 
   // iterate results
+  char fileName[MAX_PATH * 3];
   do
   {
     FILESYSTEM_FIND_DATA outData;
@@ -275,9 +302,13 @@ static uint32 RecursiveFindFiles(const char* OriginPath, const char* ParentPath,
     if (wfd.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN && !(Flags & FILESYSTEM_FIND_HIDDEN_FILES))
       continue;
 
-    if (wfd.cFileName[0] == '.')
+    // names that can't be represented in UTF-8 are skipped
+    if (!GetUTF8FileName(fileName, countof(fileName), wfd.cFileName))
+      continue;
+
+    if (fileName[0] == '.')
     {
-      if (wfd.cFileName[1] == '\0' || (wfd.cFileName[1] == '.' && wfd.cFileName[2] == '\0'))
+      if (fileName[1] == '\0' || (fileName[1] == '.' && fileName[2] == '\0'))
         continue;
 
       if (!(Flags & FILESYSTEM_FIND_HIDDEN_FILES))
@@ -292,11 +323,11 @@ static uint32 RecursiveFindFiles(const char* OriginPath, const char* ParentPath,
         if (ParentPath != NULL)
         {
           Y_snprintf(tempStr, tempPathLength + 1, "%s\\%s", ParentPath, Path);
-          nFiles += RecursiveFindFiles(OriginPath, tempStr, wfd.cFileName, Pattern, Flags, pResults);
+          nFiles += RecursiveFindFiles(OriginPath, tempStr, fileName, Pattern, Flags, pResults);
         }
         else
         {
-          nFiles += RecursiveFindFiles(OriginPath, Path, wfd.cFileName, Pattern, Flags, pResults);
+          nFiles += RecursiveFindFiles(OriginPath, Path, fileName, Pattern, Flags, pResults);
         }
       }
 
@@ -315,16 +346,8 @@ static uint32 RecursiveFindFiles(const char* OriginPath, const char* ParentPath,
       outData.Attributes |= FILESYSTEM_FILE_ATTRIBUTE_READ_ONLY;
 
     // match the filename
-    if (hasWildCards)
-    {
-      if (!wildCardMatchAll && !Y_strwildcmp(wfd.cFileName, Pattern))
-        continue;
-    }
-    else
-    {
-      if (Y_strcmp(wfd.cFileName, Pattern) != 0)
-        continue;
-    }
+    if (!Pattern.MatchesAll() && !Pattern.Match(fileName))
+      continue;
 
     // add file to list
     // TODO string formatter, clean this mess..
@@ -332,20 +355,20 @@ static uint32 RecursiveFindFiles(const char* OriginPath, const char* ParentPath,
     {
       if (ParentPath != NULL)
         Y_snprintf(outData.FileName, countof(outData.FileName), "%s\\%s\\%s\\%s", OriginPath, ParentPath, Path,
-                   wfd.cFileName);
+                   fileName);
       else if (Path != NULL)
-        Y_snprintf(outData.FileName, countof(outData.FileName), "%s\\%s\\%s", OriginPath, Path, wfd.cFileName);
+        Y_snprintf(outData.FileName, countof(outData.FileName), "%s\\%s\\%s", OriginPath, Path, fileName);
       else
-        Y_snprintf(outData.FileName, countof(outData.FileName), "%s\\%s", OriginPath, wfd.cFileName);
+        Y_snprintf(outData.FileName, countof(outData.FileName), "%s\\%s", OriginPath, fileName);
     }
     else
     {
       if (ParentPath != NULL)
-        Y_snprintf(outData.FileName, countof(outData.FileName), "%s\\%s\\%s", ParentPath, Path, wfd.cFileName);
+        Y_snprintf(outData.FileName, countof(outData.FileName), "%s\\%s\\%s", ParentPath, Path, fileName);
       else if (Path != NULL)
-        Y_snprintf(outData.FileName, countof(outData.FileName), "%s\\%s", Path, wfd.cFileName);
+        Y_snprintf(outData.FileName, countof(outData.FileName), "%s\\%s", Path, fileName);
       else
-        Y_strncpy(outData.FileName, countof(outData.FileName), wfd.cFileName);
+        Y_strncpy(outData.FileName, countof(outData.FileName), fileName);
     }
 
     outData.ModificationTime.SetWindowsFileTime(&wfd.ftLastWriteTime);
@@ -353,7 +376,7 @@ static uint32 RecursiveFindFiles(const char* OriginPath, const char* ParentPath,
 
     nFiles++;
     pResults->Add(outData);
-  } while (FindNextFileA(hFind, &wfd) == TRUE);
+  } while (FindNextFileW(hFind, &wfd) == TRUE);
   FindClose(hFind);
 
   return nFiles;
@@ -370,7 +393,221 @@ bool FileSystem::FindFiles(const char* Path, const char* Pattern, uint32 Flags,
     pResults->Clear();
 
   // enter the recursive function
-  return (RecursiveFindFiles(Path, NULL, NULL, Pattern, Flags, pResults) > 0);
+  GlobPattern compiledPattern(Pattern);
+  return (RecursiveFindFiles(Path, NULL, NULL, compiledPattern, Flags, pResults) > 0);
+}
+
+// Shared state for one FindFilesParallel call, run by helpers like ParallelForJob. Directories waiting to be
+// searched are kept on a stack by their path relative to the origin, so the search stays roughly depth first.
+// Directories are listed with FindFirstFileEx asking for large fetches and no short names, which already has
+// everything FILESYSTEM_FIND_DATA needs.
+class ParallelFindJob : public ReferenceCounted
+{
+public:
+  ParallelFindJob(const char* originPath, const char* pattern, uint32 flags, FileSystem::FindFilesCallback callback,
+                  void* pUserData)
+    : m_originPath(originPath), m_pattern(pattern), m_flags(flags), m_callback(callback), m_pUserData(pUserData),
+      m_pPendingDirectories(nullptr), m_outstandingCount(1), m_matchCount(0)
+  {
+    m_pPendingDirectories = AllocatePendingDirectory("", 0, nullptr);
+  }
+
+  ~ParallelFindJob() { DebugAssert(m_pPendingDirectories == nullptr); }
+
+  uint32 GetMatchCount() const { return m_matchCount; }
+
+  // searches directories until there are none left anywhere
+  void Participate()
+  {
+    m_lock.Lock();
+    for (;;)
+    {
+      // others may still find more
+      while (m_pPendingDirectories == nullptr && m_outstandingCount > 0)
+        m_conditionVariable.SleepAndRelease(&m_lock);
+      if (m_pPendingDirectories == nullptr)
+        break;
+
+      PendingDirectory* pDirectory = m_pPendingDirectories;
+      m_pPendingDirectories = pDirectory->pNext;
+      m_lock.Unlock();
+
+      SearchDirectory(pDirectory->Path);
+      Y_free(pDirectory);
+
+      m_lock.Lock();
+      if (--m_outstandingCount == 0)
+        m_conditionVariable.WakeAll();
+    }
+    m_lock.Unlock();
+  }
+
+  void RunHelper() { Participate(); }
+
+private:
+  struct PendingDirectory
+  {
+    PendingDirectory* pNext;
+    char Path[1];
+  };
+
+  static PendingDirectory* AllocatePendingDirectory(const char* path, uint32 pathLength, PendingDirectory* pNext)
+  {
+    PendingDirectory* pDirectory =
+      static_cast<PendingDirectory*>(Y_malloc(offsetof(PendingDirectory, Path) + pathLength + 1));
+    pDirectory->pNext = pNext;
+    std::memcpy(pDirectory->Path, path, pathLength);
+    pDirectory->Path[pathLength] = '\0';
+    return pDirectory;
+  }
+
+  void SearchDirectory(const char* relativePath)
+  {
+    PathString searchPath;
+    if (relativePath[0] != '\0')
+      searchPath.Format("%s\\%s\\*", m_originPath, relativePath);
+    else
+      searchPath.Format("%s\\*", m_originPath);
+
+    WIN32_FIND_DATAW wfd;
+    HANDLE hFind = FindFirstFileExW(WidePath(searchPath).GetWideCharArray(), FindExInfoBasic, &wfd,
+                                    FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+    if (hFind == INVALID_HANDLE_VALUE)
+      return;
+
+    // subdirectories are queued together once this one is done
+    PendingDirectory* pSubdirectories = nullptr;
+    uint32 subdirectoryCount = 0;
+    PathString subdirectoryPath;
+
+    char fileName[MAX_PATH * 3];
+    do
+    {
+      if (wfd.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN && !(m_flags & FILESYSTEM_FIND_HIDDEN_FILES))
+        continue;
+
+      // names that can't be represented in UTF-8 are skipped
+      if (!GetUTF8FileName(fileName, countof(fileName), wfd.cFileName))
+        continue;
+
+      if (fileName[0] == '.')
+      {
+        if (fileName[1] == '\0' || (fileName[1] == '.' && fileName[2] == '\0'))
+          continue;
+
+        if (!(m_flags & FILESYSTEM_FIND_HIDDEN_FILES))
+          continue;
+      }
+
+      bool isDirectory = (wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+      if (isDirectory)
+      {
+        if (m_flags & FILESYSTEM_FIND_RECURSIVE)
+        {
+          if (relativePath[0] != '\0')
+            subdirectoryPath.Format("%s\\%s", relativePath, fileName);
+          else
+            subdirectoryPath.Assign(fileName);
+
+          pSubdirectories =
+            AllocatePendingDirectory(subdirectoryPath, subdirectoryPath.GetLength(), pSubdirectories);
+          subdirectoryCount++;
+        }
+
+        if (!(m_flags & FILESYSTEM_FIND_FOLDERS))
+          continue;
+      }
+      else
+      {
+        if (!(m_flags & FILESYSTEM_FIND_FILES))
+          continue;
+      }
+
+      // match the filename
+      if (!m_pattern.MatchesAll() && !m_pattern.Match(fileName))
+        continue;
+
+      FILESYSTEM_FIND_DATA outData;
+      outData.Attributes = isDirectory ? FILESYSTEM_FILE_ATTRIBUTE_DIRECTORY : 0;
+      if (wfd.dwFileAttributes & FILE_ATTRIBUTE_READONLY)
+        outData.Attributes |= FILESYSTEM_FILE_ATTRIBUTE_READ_ONLY;
+
+      if (!(m_flags & FILESYSTEM_FIND_RELATIVE_PATHS))
+      {
+        if (relativePath[0] != '\0')
+          Y_snprintf(outData.FileName, countof(outData.FileName), "%s\\%s\\%s", m_originPath, relativePath, fileName);
+        else
+          Y_snprintf(outData.FileName, countof(outData.FileName), "%s\\%s", m_originPath, fileName);
+      }
+      else
+      {
+        if (relativePath[0] != '\0')
+          Y_snprintf(outData.FileName, countof(outData.FileName), "%s\\%s", relativePath, fileName);
+        else
+          Y_strncpy(outData.FileName, countof(outData.FileName), fileName);
+      }
+
+      outData.ModificationTime.SetWindowsFileTime(&wfd.ftLastWriteTime);
+      outData.Size = (uint64)wfd.nFileSizeHigh << 32 | (uint64)wfd.nFileSizeLow;
+
+      Y_AtomicIncrement(m_matchCount);
+      m_callback(&outData, m_pUserData);
+    } while (FindNextFileW(hFind, &wfd) == TRUE);
+    FindClose(hFind);
+
+    if (pSubdirectories == nullptr)
+      return;
+
+    // the new ones count before this one is finished, so the count can't reach zero in between
+    PendingDirectory* pLast = pSubdirectories;
+    while (pLast->pNext != nullptr)
+      pLast = pLast->pNext;
+
+    m_lock.Lock();
+    pLast->pNext = m_pPendingDirectories;
+    m_pPendingDirectories = pSubdirectories;
+    m_outstandingCount += subdirectoryCount;
+    if (subdirectoryCount > 1)
+      m_conditionVariable.WakeAll();
+    else
+      m_conditionVariable.Wake();
+    m_lock.Unlock();
+  }
+
+  const char* m_originPath;
+  GlobPattern m_pattern;
+  uint32 m_flags;
+  FileSystem::FindFilesCallback m_callback;
+  void* m_pUserData;
+
+  // directories waiting and the number queued or being searched, protected by m_lock
+  Mutex m_lock;
+  ConditionVariable m_conditionVariable;
+  PendingDirectory* m_pPendingDirectories;
+  uint32 m_outstandingCount;
+
+  Y_ATOMIC_DECL uint32 m_matchCount;
+};
+
+bool FileSystem::FindFilesParallel(const char* Path, const char* Pattern, uint32 Flags, ThreadPool* pThreadPool,
+                                   FindFilesCallback callback, void* pUserData)
+{
+  // has a path
+  if (Path[0] == '\0')
+    return false;
+
+  ParallelFindJob* pJob = new ParallelFindJob(Path, Pattern, Flags, callback, pUserData);
+  if (pThreadPool != nullptr && (Flags & FILESYSTEM_FIND_RECURSIVE))
+  {
+    for (uint32 i = 0; i < pThreadPool->GetWorkerThreadCount(); i++)
+      ThreadPoolHelperWorkItem<ParallelFindJob>::Enqueue(pThreadPool, pJob);
+  }
+
+  // helpers that start after this returns find nothing left and leave without touching the callback
+  pJob->Participate();
+  bool result = (pJob->GetMatchCount() > 0);
+  pJob->Release();
+  return result;
 }
 
 bool FileSystem::StatFile(const char* Path, FILESYSTEM_STAT_DATA* pStatData)
@@ -380,18 +617,19 @@ bool FileSystem::StatFile(const char* Path, FILESYSTEM_STAT_DATA* pStatData)
     return false;
 
   // determine attributes for the path. if it's a directory, things have to be handled differently..
-  DWORD fileAttributes = GetFileAttributesA(Path);
+  WidePath widePath(Path);
+  DWORD fileAttributes = GetFileAttributesW(widePath.GetWideCharArray());
   if (fileAttributes == INVALID_FILE_ATTRIBUTES)
     return false;
 
   // test if it is a directory
   HANDLE hFile;
+  DWORD shareMode = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
   if (fileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-    hFile = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+    hFile = CreateFileW(widePath.GetWideCharArray(), GENERIC_READ, shareMode, NULL, OPEN_EXISTING,
                         FILE_FLAG_BACKUP_SEMANTICS, NULL);
   else
-    hFile = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
-                        0, NULL);
+    hFile = CreateFileW(widePath.GetWideCharArray(), GENERIC_READ, shareMode, NULL, OPEN_EXISTING, 0, NULL);
 
   // createfile succeded?
   if (hFile == INVALID_HANDLE_VALUE)
@@ -415,6 +653,53 @@ bool FileSystem::StatFile(const char* Path, FILESYSTEM_STAT_DATA* pStatData)
   return true;
 }
 
+// paths stat'd by a thread at a time, enough to make handing out chunks cheap
+static const uint32 STAT_FILES_GRAIN_SIZE = 64;
+
+uint32 FileSystem::StatFiles(const char* const* Paths, uint32 Count, FILESYSTEM_STAT_DATA* pStatData, bool* pFound,
+                             ThreadPool* pThreadPool /* = nullptr */)
+{
+  Y_ATOMIC_DECL uint32 foundCount = 0;
+  ParallelForRange(pThreadPool, 0, Count, STAT_FILES_GRAIN_SIZE, [&](uint32 rangeBegin, uint32 rangeEnd) {
+    uint32 rangeFoundCount = 0;
+    for (uint32 i = rangeBegin; i < rangeEnd; i++)
+    {
+      pFound[i] = StatFile(Paths[i], &pStatData[i]);
+      if (pFound[i])
+        rangeFoundCount++;
+    }
+
+    if (rangeFoundCount > 0)
+      Y_AtomicAdd(foundCount, rangeFoundCount);
+  });
+
+  return foundCount;
+}
+
+uint32 FileSystem::StatFilesInDirectory(const char* DirectoryPath, const char* const* Names, uint32 Count,
+                                        FILESYSTEM_STAT_DATA* pStatData, bool* pFound,
+                                        ThreadPool* pThreadPool /* = nullptr */)
+{
+  // win32 has no call relative to a directory handle, so the names are joined to the path
+  Y_ATOMIC_DECL uint32 foundCount = 0;
+  ParallelForRange(pThreadPool, 0, Count, STAT_FILES_GRAIN_SIZE, [&](uint32 rangeBegin, uint32 rangeEnd) {
+    uint32 rangeFoundCount = 0;
+    PathString path;
+    for (uint32 i = rangeBegin; i < rangeEnd; i++)
+    {
+      path.Format("%s\\%s", DirectoryPath, Names[i]);
+      pFound[i] = (Names[i][0] != '\0' && StatFile(path, &pStatData[i]));
+      if (pFound[i])
+        rangeFoundCount++;
+    }
+
+    if (rangeFoundCount > 0)
+      Y_AtomicAdd(foundCount, rangeFoundCount);
+  });
+
+  return foundCount;
+}
+
 bool FileSystem::FileExists(const char* Path)
 {
   // has a path
@@ -422,7 +707,7 @@ bool FileSystem::FileExists(const char* Path)
     return false;
 
   // determine attributes for the path. if it's a directory, things have to be handled differently..
-  DWORD fileAttributes = GetFileAttributesA(Path);
+  DWORD fileAttributes = GetFileAttributesW(WidePath(Path).GetWideCharArray());
   if (fileAttributes == INVALID_FILE_ATTRIBUTES)
     return false;
 
@@ -439,7 +724,7 @@ bool FileSystem::DirectoryExists(const char* Path)
     return false;
 
   // determine attributes for the path. if it's a directory, things have to be handled differently..
-  DWORD fileAttributes = GetFileAttributesA(Path);
+  DWORD fileAttributes = GetFileAttributesW(WidePath(Path).GetWideCharArray());
   if (fileAttributes == INVALID_FILE_ATTRIBUTES)
     return false;
 
@@ -452,7 +737,7 @@ bool FileSystem::DirectoryExists(const char* Path)
 bool FileSystem::GetFileName(String& Destination, const char* FileName)
 {
   // fastpath for non-existant files
-  DWORD fileAttributes = GetFileAttributesA(FileName);
+  DWORD fileAttributes = GetFileAttributesW(WidePath(FileName).GetWideCharArray());
   if (fileAttributes == INVALID_FILE_ATTRIBUTES)
     return false;
 
@@ -493,7 +778,8 @@ bool FileSystem::CreateDirectory(const char* Path, bool Recursive)
     return false;
 
   // try just flat-out, might work if there's no other segments that have to be made
-  if (CreateDirectoryA(Path, NULL))
+  WidePath widePath(Path);
+  if (CreateDirectoryW(widePath.GetWideCharArray(), NULL))
     return true;
 
   // check error
@@ -501,7 +787,7 @@ bool FileSystem::CreateDirectory(const char* Path, bool Recursive)
   if (lastError == ERROR_ALREADY_EXISTS)
   {
     // check the attributes
-    uint32 Attributes = GetFileAttributesA(Path);
+    uint32 Attributes = GetFileAttributesW(widePath.GetWideCharArray());
     if (Attributes != INVALID_FILE_ATTRIBUTES && Attributes & FILE_ATTRIBUTE_DIRECTORY)
       return true;
     else
@@ -520,7 +806,7 @@ bool FileSystem::CreateDirectory(const char* Path, bool Recursive)
       if (Path[i] == '\\')
       {
         tempStr[i] = '\0';
-        if (!CreateDirectoryA(tempStr, NULL))
+        if (!CreateDirectoryW(WidePath(StringView(tempStr, i)).GetWideCharArray(), NULL))
         {
           lastError = GetLastError();
           if (lastError == ERROR_ALREADY_EXISTS) // fine, continue to next path segment
@@ -536,7 +822,7 @@ bool FileSystem::CreateDirectory(const char* Path, bool Recursive)
     // re-create the end if it's not a separator, check / as well because windows can interpret them
     if (Path[pathLength - 1] != '\\' && Path[pathLength - 1] != '\\')
     {
-      if (!CreateDirectoryA(Path, NULL))
+      if (!CreateDirectoryW(widePath.GetWideCharArray(), NULL))
       {
         lastError = GetLastError();
         if (lastError != ERROR_ALREADY_EXISTS)
@@ -559,12 +845,13 @@ bool FileSystem::DeleteFile(const char* Path)
   if (Path[0] == '\0')
     return false;
 
-  DWORD fileAttributes = GetFileAttributesA(Path);
+  WidePath widePath(Path);
+  DWORD fileAttributes = GetFileAttributesW(widePath.GetWideCharArray());
   if (fileAttributes == INVALID_FILE_ATTRIBUTES)
     return false;
 
   if (!(fileAttributes & FILE_ATTRIBUTE_DIRECTORY))
-    return (DeleteFileA(Path) == TRUE);
+    return (DeleteFileW(widePath.GetWideCharArray()) == TRUE);
   else
     return false;
 }
@@ -572,21 +859,22 @@ bool FileSystem::DeleteFile(const char* Path)
 bool FileSystem::DeleteDirectory(const char* Path, bool Recursive)
 {
   // ensure it exists
-  DWORD fileAttributes = GetFileAttributesA(Path);
+  WidePath widePath(Path);
+  DWORD fileAttributes = GetFileAttributesW(widePath.GetWideCharArray());
   if (fileAttributes == INVALID_FILE_ATTRIBUTES || !(fileAttributes & FILE_ATTRIBUTE_DIRECTORY))
     return false;
 
   // non-recursive case just try removing the directory
   if (!Recursive)
-    return (RemoveDirectoryA(Path) == TRUE);
+    return (RemoveDirectoryW(widePath.GetWideCharArray()) == TRUE);
 
   // doing a recursive delete
   SmallString fileName;
   fileName.Format("%s\\*", Path);
 
   // is there any files?
-  WIN32_FIND_DATA findData;
-  HANDLE hFind = FindFirstFileA(fileName, &findData);
+  WIN32_FIND_DATAW findData;
+  HANDLE hFind = FindFirstFileW(WidePath(fileName).GetWideCharArray(), &findData);
   if (hFind == INVALID_HANDLE_VALUE)
     return false;
 
@@ -603,7 +891,13 @@ bool FileSystem::DeleteDirectory(const char* Path, bool Recursive)
     }
 
     // found a directory?
-    fileName.Format("%s\\%s", Path, findData.cFileName);
+    fileName.Format("%s\\", Path);
+    if (!UnicodeConversion::AppendUTF16(fileName, reinterpret_cast<const char16_t*>(findData.cFileName),
+                                        (uint32)wcslen(findData.cFileName)))
+    {
+      return false;
+    }
+
     if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
     {
       // recurse into that
@@ -613,14 +907,14 @@ bool FileSystem::DeleteDirectory(const char* Path, bool Recursive)
     else
     {
       // found a file, so delete it
-      if (!DeleteFileA(fileName))
+      if (!DeleteFileW(WidePath(fileName).GetWideCharArray()))
         return false;
     }
-  } while (FindNextFileA(hFind, &findData));
+  } while (FindNextFileW(hFind, &findData));
   FindClose(hFind);
 
   // nuke the directory itself
-  if (!RemoveDirectoryA(Path))
+  if (!RemoveDirectoryW(widePath.GetWideCharArray()))
     return false;
 
   // done
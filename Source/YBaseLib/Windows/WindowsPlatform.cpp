@@ -116,4 +116,105 @@ bool Platform::InitializeSocketSupport(Error* pError)
   return true;
 }
 
+void* Platform::AllocateMirroredMemory(size_t size)
+{
+  DebugAssert(size > 0 && (size % GetMirroredMemoryGranularity()) == 0);
+
+  HANDLE hMapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64)size >> 32),
+                                       (DWORD)size, NULL);
+  if (hMapping == NULL)
+    return nullptr;
+
+  // find a free range and map both views into it. another thread can take the range between releasing the
+  // reservation and mapping, so try a few times.
+  byte* pResult = nullptr;
+  for (uint32 attempt = 0; attempt < 16 && pResult == nullptr; attempt++)
+  {
+    byte* pBase = (byte*)VirtualAlloc(NULL, size * 2, MEM_RESERVE, PAGE_NOACCESS);
+    if (pBase == nullptr)
+      break;
+    VirtualFree(pBase, 0, MEM_RELEASE);
+
+    void* pFirstView = MapViewOfFileEx(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, size, pBase);
+    if (pFirstView == nullptr)
+      continue;
+
+    if (MapViewOfFileEx(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, size, pBase + size) == nullptr)
+    {
+      UnmapViewOfFile(pFirstView);
+      continue;
+    }
+
+    pResult = pBase;
+  }
+
+  // the views hold their own references to the mapping
+  CloseHandle(hMapping);
+  return pResult;
+}
+
+void Platform::FreeMirroredMemory(void* pMemory, size_t size)
+{
+  if (pMemory == nullptr)
+    return;
+
+  UnmapViewOfFile(pMemory);
+  UnmapViewOfFile((byte*)pMemory + size);
+}
+
+size_t Platform::GetMirroredMemoryGranularity()
+{
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+  return systemInfo.dwAllocationGranularity;
+}
+
+// large pages have to be committed when they're reserved, and need a privilege, so only the NUMA flag is taken
+void* Platform::ReserveVirtualMemory(size_t size, uint32 flags)
+{
+  DebugAssert(size > 0 && (size % GetVirtualMemoryPageSize()) == 0);
+
+  if (flags & Y_MALLOC_FLAG_NUMA_LOCAL)
+  {
+    PROCESSOR_NUMBER processor;
+    USHORT node;
+    GetCurrentProcessorNumberEx(&processor);
+    if (GetNumaProcessorNodeEx(&processor, &node))
+      return VirtualAllocExNuma(GetCurrentProcess(), NULL, size, MEM_RESERVE, PAGE_NOACCESS, node);
+  }
+
+  return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool Platform::CommitVirtualMemory(void* pMemory, size_t size)
+{
+  return (VirtualAlloc(pMemory, size, MEM_COMMIT, PAGE_READWRITE) != NULL);
+}
+
+void Platform::DecommitVirtualMemory(void* pMemory, size_t size)
+{
+  VirtualFree(pMemory, size, MEM_DECOMMIT);
+}
+
+void Platform::ReleaseVirtualMemory(void* pMemory, size_t size)
+{
+  if (pMemory != nullptr)
+    VirtualFree(pMemory, 0, MEM_RELEASE);
+}
+
+size_t Platform::GetVirtualMemoryPageSize()
+{
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+  return systemInfo.dwPageSize;
+}
+
+void Platform::AdviseMemory(void* pMemory, size_t size, uint32 flags) {}
+
+uint32 Platform::CaptureCallStack(void** ppFrames, uint32 maxFrames, uint32 skipFrames)
+{
+  // skip ourselves too
+  return RtlCaptureStackBackTrace(skipFrames + 1, maxFrames, ppFrames, NULL);
+}
+
 #endif // Y_PLATFORM_WINDOWS
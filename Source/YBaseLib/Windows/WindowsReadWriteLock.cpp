@@ -13,22 +13,52 @@ ReadWriteLock::~ReadWriteLock() {}
 
 void ReadWriteLock::LockShared()
 {
+#if Y_LOCK_PROFILING
+  if (m_profile.IsEnabled())
+  {
+    m_profile.AcquireShared([this]() { return (TryAcquireSRWLockShared(&m_ReadWriteLock) == TRUE); },
+                            [this]() { AcquireSRWLockShared(&m_ReadWriteLock); });
+    return;
+  }
+#endif
+
   AcquireSRWLockShared(&m_ReadWriteLock);
 }
 
 void ReadWriteLock::LockExclusive()
 {
+#if Y_LOCK_PROFILING
+  if (m_profile.IsEnabled())
+  {
+    m_profile.Acquire([this]() { return (TryAcquireSRWLockExclusive(&m_ReadWriteLock) == TRUE); },
+                      [this]() { AcquireSRWLockExclusive(&m_ReadWriteLock); });
+    return;
+  }
+#endif
+
   AcquireSRWLockExclusive(&m_ReadWriteLock);
 }
 
 bool ReadWriteLock::TryLockShared()
 {
-  return (TryAcquireSRWLockShared(&m_ReadWriteLock) == TRUE);
+  if (TryAcquireSRWLockShared(&m_ReadWriteLock) != TRUE)
+    return false;
+
+#if Y_LOCK_PROFILING
+  m_profile.OnTryAcquiredShared();
+#endif
+  return true;
 }
 
 bool ReadWriteLock::TryLockExclusive()
 {
-  return (TryAcquireSRWLockExclusive(&m_ReadWriteLock) == TRUE);
+  if (TryAcquireSRWLockExclusive(&m_ReadWriteLock) != TRUE)
+    return false;
+
+#if Y_LOCK_PROFILING
+  m_profile.OnTryAcquired();
+#endif
+  return true;
 }
 
 void ReadWriteLock::UnlockShared()
@@ -38,6 +68,9 @@ void ReadWriteLock::UnlockShared()
 
 void ReadWriteLock::UnlockExclusive()
 {
+#if Y_LOCK_PROFILING
+  m_profile.Release();
+#endif
   ReleaseSRWLockExclusive(&m_ReadWriteLock);
 }
 
@@ -45,6 +78,15 @@ void ReadWriteLock::UpgradeSharedLockToExclusive()
 {
   // windows provides no api for this, so it may be slow dependant on contention
   ReleaseSRWLockShared(&m_ReadWriteLock);
+#if Y_LOCK_PROFILING
+  if (m_profile.IsEnabled())
+  {
+    m_profile.Acquire([this]() { return (TryAcquireSRWLockExclusive(&m_ReadWriteLock) == TRUE); },
+                      [this]() { AcquireSRWLockExclusive(&m_ReadWriteLock); });
+    return;
+  }
+#endif
+
   AcquireSRWLockExclusive(&m_ReadWriteLock);
 }
 
@@ -97,7 +97,8 @@ bool Subprocess::GetParameters(String* pDestination)
 
 Subprocess* Subprocess::Create(const char* executableFileName, const char* parameters /* = NULL */,
                                bool openChannel /* = true */, bool newConsole /* = true */,
-                               bool terminateOnParentLost /* = true */)
+                               bool terminateOnParentLost /* = true */,
+                               uint32 sharedMemoryChannelSize /* = DefaultSharedMemoryChannelSize */)
 {
   // Create flags
   DWORD creationFlags = 0;
@@ -201,7 +202,7 @@ Subprocess* Subprocess::Create(const char* executableFileName, const char* param
                         &pi))
     {
       Log_ErrorPrint("Subprocess::Create: CreateProcessA failed.");
-      std::free(targetEnvironmentString);
+      Y_free(targetEnvironmentString);
       CloseHandle(hWritePipeWriteEnd);
       CloseHandle(hWritePipeReadEnd);
       CloseHandle(hReadPipeWriteEnd);
@@ -211,7 +212,7 @@ Subprocess* Subprocess::Create(const char* executableFileName, const char* param
     }
 
     // Remove the inherit flags on the pipes, and close the ends we don't need
-    std::free(targetEnvironmentString);
+    Y_free(targetEnvironmentString);
     SetHandleInformation(hQuitEvent, HANDLE_FLAG_INHERIT, 0);
     SetHandleInformation(hReadPipeWriteEnd, HANDLE_FLAG_INHERIT, 0);
     SetHandleInformation(hWritePipeReadEnd, HANDLE_FLAG_INHERIT, 0);
@@ -237,6 +238,24 @@ Subprocess* Subprocess::Create(const char* executableFileName, const char* param
   }
 }
 
+uint32 Subprocess::CreateMultiple(Subprocess** ppSubprocesses, uint32 count, const char* executableFileName,
+                                  const char* parameters /* = NULL */, bool openChannel /* = true */,
+                                  bool newConsole /* = true */, bool terminateOnParentLost /* = true */,
+                                  uint32 sharedMemoryChannelSize /* = DefaultSharedMemoryChannelSize */)
+{
+  // CreateProcess has nothing to share between the children
+  uint32 createdCount = 0;
+  for (; createdCount < count; createdCount++)
+  {
+    ppSubprocesses[createdCount] = Create(executableFileName, parameters, openChannel, newConsole,
+                                          terminateOnParentLost, sharedMemoryChannelSize);
+    if (ppSubprocesses[createdCount] == nullptr)
+      break;
+  }
+
+  return createdCount;
+}
+
 Subprocess::Connection* Subprocess::ConnectToChild(int32 connectionTimeout /*= -1*/)
 {
   DWORD transferred;
@@ -334,6 +353,12 @@ Subprocess::Connection* Subprocess::ConnectToParent(int32 connectionTimeout /*=
   return new Connection(hParentProcess, hQuitEvent, hReadPipe, hWritePipe, true, terminateOnParentLost);
 }
 
+bool Subprocess::IsChildAlive()
+{
+  DWORD exitCode;
+  return (GetExitCodeProcess(m_hChildProcess, &exitCode) && exitCode == STILL_ACTIVE);
+}
+
 void Subprocess::RequestChildToExit()
 {
   // Flag the event
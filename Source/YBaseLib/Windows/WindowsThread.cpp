@@ -2,8 +2,12 @@
 
 #if defined(Y_PLATFORM_WINDOWS)
 
+#include "YBaseLib/Allocator.h"
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/Log.h"
+#include "YBaseLib/Profiler.h"
+#include "YBaseLib/ThreadCachedHeap.h"
+#include "YBaseLib/ThreadLocal.h"
 #include "YBaseLib/Windows/WindowsThread.h"
 #include <process.h>
 Log_SetChannel(Thread);
@@ -56,6 +60,10 @@ bool Thread::Start(bool createSuspended /* = false */)
   if (hThread == NULL)
     return false;
 
+  // a thread that has been joined can be started again, the handle to the old one is still open
+  if (m_hThread != NULL)
+    CloseHandle(m_hThread);
+
   m_hThread = hThread;
   m_threadId = static_cast<uint32>(threadId);
   m_bSuspended = createSuspended;
@@ -88,8 +96,16 @@ int32 Thread::Join()
   return static_cast<int32>(exitCode);
 }
 
+bool Thread::SetAffinityMask(uint64 mask)
+{
+  Assert(m_hThread != NULL);
+  return (SetThreadAffinityMask(m_hThread, static_cast<DWORD_PTR>(mask)) != 0);
+}
+
 void Thread::SetDebugName(const char* threadName)
 {
+  Profiler::SetThreadName(threadName);
+
 #if defined(Y_COMPILER_MSVC)
   const DWORD MS_VC_EXCEPTION = 0x406D1388;
 
@@ -126,6 +142,12 @@ unsigned __stdcall Thread::__ThreadStart(void* pArguments)
   // run the thread
   int threadExitCode = pThread->ThreadEntryPoint();
 
+  // free anything the thread left behind
+  ThreadLocalBase::ReleaseCurrentThreadValues();
+  ThreadCachedHeap::ReleaseThreadCache();
+  Log::ReleaseThreadBuffer();
+  Profiler::ReleaseThreadBuffer();
+
   // return the exit code
   _endthreadex(static_cast<unsigned>(threadExitCode));
 
@@ -153,4 +175,9 @@ void Thread::Sleep(uint32 millisecondsToSleep)
   ::Sleep(millisecondsToSleep);
 }
 
+bool Thread::SetCurrentThreadAffinityMask(uint64 mask)
+{
+  return (SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(mask)) != 0);
+}
+
 #endif
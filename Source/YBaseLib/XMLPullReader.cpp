@@ -0,0 +1,919 @@
+#include "YBaseLib/XMLPullReader.h"
+#include "YBaseLib/Assert.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Memory.h"
+#include "YBaseLib/UnicodeConversion.h"
+#include <cstring>
+Log_SetChannel(XMLPullReader);
+
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <emmintrin.h>
+#define Y_XMLPULLREADER_SSE2 1
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_XMLPULLREADER_NEON 1
+#endif
+
+// Markup is found with memchr, which the C runtime already vectorizes, for the '<' ending text and the quote ending an
+// attribute value. Whether a value needs decoding is checked 16 bytes at a time, so most values are never copied.
+
+static inline bool IsWhitespace(char ch)
+{
+  return (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r');
+}
+
+static inline bool IsNameTerminator(char ch)
+{
+  return (IsWhitespace(ch) || ch == '/' || ch == '>' || ch == '=' || ch == '<' || ch == '"' || ch == '\'');
+}
+
+static bool IsAllWhitespace(const StringView& text)
+{
+  for (uint32 i = 0; i < text.GetLength(); i++)
+  {
+    if (!IsWhitespace(text.GetData()[i]))
+      return false;
+  }
+
+  return true;
+}
+
+static inline bool HasPrefix(const char* pText, const char* pEnd, const char* prefix, uint32 prefixLength)
+{
+  return (uint32(pEnd - pText) >= prefixLength && std::memcmp(pText, prefix, prefixLength) == 0);
+}
+
+// entities and carriage returns, and in attributes the tabs and line feeds that become spaces
+static bool NeedsDecoding(const StringView& text, bool attribute)
+{
+  const char* pText = text.GetData();
+  uint32 length = text.GetLength();
+  char tab = attribute ? '\t' : '&';
+  char lineFeed = attribute ? '\n' : '&';
+  uint32 i = 0;
+
+#if defined(Y_XMLPULLREADER_SSE2)
+  const __m128i ampersands = _mm_set1_epi8('&');
+  const __m128i carriageReturns = _mm_set1_epi8('\r');
+  const __m128i tabs = _mm_set1_epi8(tab);
+  const __m128i lineFeeds = _mm_set1_epi8(lineFeed);
+  for (; length - i >= 16; i += 16)
+  {
+    __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pText + i));
+    __m128i found = _mm_or_si128(_mm_cmpeq_epi8(chars, ampersands), _mm_cmpeq_epi8(chars, carriageReturns));
+    found = _mm_or_si128(found, _mm_or_si128(_mm_cmpeq_epi8(chars, tabs), _mm_cmpeq_epi8(chars, lineFeeds)));
+    if (_mm_movemask_epi8(found) != 0)
+      return true;
+  }
+#elif defined(Y_XMLPULLREADER_NEON)
+  const uint8x16_t ampersands = vdupq_n_u8('&');
+  const uint8x16_t carriageReturns = vdupq_n_u8('\r');
+  const uint8x16_t tabs = vdupq_n_u8(uint8(tab));
+  const uint8x16_t lineFeeds = vdupq_n_u8(uint8(lineFeed));
+  for (; length - i >= 16; i += 16)
+  {
+    uint8x16_t chars = vld1q_u8(reinterpret_cast<const uint8*>(pText + i));
+    uint8x16_t found = vorrq_u8(vorrq_u8(vceqq_u8(chars, ampersands), vceqq_u8(chars, carriageReturns)),
+                                vorrq_u8(vceqq_u8(chars, tabs), vceqq_u8(chars, lineFeeds)));
+    if (vmaxvq_u8(found) != 0)
+      return true;
+  }
+#endif
+
+  for (; i < length; i++)
+  {
+    char ch = pText[i];
+    if (ch == '&' || ch == '\r' || ch == tab || ch == lineFeed)
+      return true;
+  }
+
+  return false;
+}
+
+// the line and column of a position, counted when there's something to report
+static void GetLocation(const char* pText, const char* pPosition, uint32* pLine, uint32* pColumn)
+{
+  uint32 line = 1;
+  const char* pLineStart = pText;
+  for (;;)
+  {
+    const char* pLineFeed =
+      reinterpret_cast<const char*>(std::memchr(pLineStart, '\n', size_t(pPosition - pLineStart)));
+    if (pLineFeed == nullptr)
+      break;
+
+    pLineStart = pLineFeed + 1;
+    line++;
+  }
+
+  *pLine = line;
+  *pColumn = uint32(pPosition - pLineStart) + 1;
+}
+
+XMLPullReader::XMLPullReader()
+  : m_pInputStream(NULL), m_szFileName(NULL), m_pText(NULL), m_pTextEnd(NULL), m_pPosition(NULL),
+    m_pOwnedText(NULL), m_pTokenStart(NULL), m_pNameCopy(NULL), m_pValueCopy(NULL), m_valueIsCData(false),
+    m_isEmptyElement(false), m_currentAttribute(-1), m_rootElementRead(false), m_pStrings(NULL), m_stringsSize(0),
+    m_stringsLength(0), m_eCurrentNodeType(XMLREADER_TOKEN_COUNT), m_bErrorState(true)
+{
+}
+
+XMLPullReader::~XMLPullReader()
+{
+  if (m_pOwnedText != NULL)
+    Y_free(m_pOwnedText);
+  if (m_pStrings != NULL)
+    Y_free(m_pStrings);
+}
+
+bool XMLPullReader::Create(ByteStream* pInputStream, const char* FileName)
+{
+  if (m_pOwnedText != NULL)
+  {
+    Y_free(m_pOwnedText);
+    m_pOwnedText = NULL;
+  }
+
+  m_pInputStream = pInputStream;
+  m_szFileName = FileName;
+  m_pTokenStart = NULL;
+  m_attributes.Clear();
+  m_currentAttribute = -1;
+  m_openElements.Clear();
+  m_rootElementRead = false;
+  m_eCurrentNodeType = XMLREADER_TOKEN_COUNT;
+  m_bErrorState = true;
+
+  uint64 position = pInputStream->GetPosition();
+  uint64 size = pInputStream->GetSize();
+  if (size - position > 0xFFFFFFFF)
+  {
+    Log_ErrorPrintf("XMLPullReader::Create: %s is too large.", FileName);
+    return false;
+  }
+
+  // anything that isn't in memory already is read in whole
+  const byte* pBasePointer = pInputStream->GetBasePointer();
+  if (pBasePointer != NULL)
+  {
+    m_pText = reinterpret_cast<const char*>(pBasePointer + position);
+  }
+  else
+  {
+    uint32 length = uint32(size - position);
+    m_pOwnedText = static_cast<char*>(Y_malloc(Max(length, 1u)));
+    if (pInputStream->Read(m_pOwnedText, length) != length)
+    {
+      Log_ErrorPrintf("XMLPullReader::Create: failed to read %s.", FileName);
+      return false;
+    }
+
+    m_pText = m_pOwnedText;
+  }
+
+  m_pTextEnd = m_pText + (size - position);
+  if (HasPrefix(m_pText, m_pTextEnd, "\xEF\xBB\xBF", 3))
+    m_pText += 3;
+
+  m_pPosition = m_pText;
+  m_bErrorState = false;
+  return true;
+}
+
+bool XMLPullReader::NextToken()
+{
+  if (m_bErrorState)
+    return false;
+
+  for (;;)
+  {
+    m_pTokenStart = m_pPosition;
+    m_name = StringView();
+    m_value = StringView();
+    m_pNameCopy = NULL;
+    m_pValueCopy = NULL;
+    m_valueIsCData = false;
+    m_isEmptyElement = false;
+    m_attributes.Clear();
+    m_currentAttribute = -1;
+    m_eCurrentNodeType = XMLREADER_TOKEN_COUNT;
+
+    if (m_pPosition == m_pTextEnd)
+    {
+      if (m_openElements.GetSize() > 0)
+      {
+        const StringView& name = m_openElements.LastElement();
+        return SyntaxError("end of document with element '%.*s' open", name.GetLength(), name.GetData());
+      }
+      if (!m_rootElementRead)
+        return SyntaxError("document has no root element");
+
+      return false;
+    }
+
+    // text runs up to the next markup
+    if (*m_pPosition != '<')
+    {
+      const char* pTextStart = m_pPosition;
+      m_pPosition = reinterpret_cast<const char*>(std::memchr(m_pPosition, '<', size_t(m_pTextEnd - m_pPosition)));
+      if (m_pPosition == NULL)
+        m_pPosition = m_pTextEnd;
+
+      m_value = StringView(pTextStart, m_pPosition);
+      if (IsAllWhitespace(m_value))
+        continue;
+      if (m_openElements.GetSize() == 0)
+        return SyntaxError("text outside of the root element");
+
+      m_name = StringView("#text", 5);
+      m_pNameCopy = "#text";
+      ResetStrings(m_value.GetLength() + 1);
+      m_eCurrentNodeType = XMLREADER_TOKEN_TEXT;
+      return true;
+    }
+
+    const char* pMarkup = m_pPosition + 1;
+    if (HasPrefix(pMarkup, m_pTextEnd, "/", 1))
+      return ReadEndElement();
+
+    if (HasPrefix(pMarkup, m_pTextEnd, "?", 1))
+    {
+      if (!SkipPast("?>", "processing instruction"))
+        return false;
+
+      continue;
+    }
+
+    if (HasPrefix(pMarkup, m_pTextEnd, "!--", 3))
+    {
+      m_pPosition += 4;
+      if (!SkipPast("-->", "comment"))
+        return false;
+
+      continue;
+    }
+
+    if (HasPrefix(pMarkup, m_pTextEnd, "![CDATA[", 8))
+    {
+      m_pPosition += 9;
+      const char* pTextStart = m_pPosition;
+      if (!SkipPast("]]>", "CDATA section"))
+        return false;
+      if (m_openElements.GetSize() == 0)
+        return SyntaxError("CDATA section outside of the root element");
+
+      m_name = StringView("#text", 5);
+      m_pNameCopy = "#text";
+      m_value = StringView(pTextStart, m_pPosition - 3);
+      m_valueIsCData = true;
+      ResetStrings(m_value.GetLength() + 1);
+      m_eCurrentNodeType = XMLREADER_TOKEN_TEXT;
+      return true;
+    }
+
+    if (HasPrefix(pMarkup, m_pTextEnd, "!DOCTYPE", 8))
+    {
+      if (!SkipDoctype())
+        return false;
+
+      continue;
+    }
+
+    if (HasPrefix(pMarkup, m_pTextEnd, "!", 1))
+      return SyntaxError("unknown markup");
+
+    return ReadElement();
+  }
+}
+
+bool XMLPullReader::ReadElement()
+{
+  m_pPosition++;
+  StringView name;
+  if (!ReadName(&name))
+    return false;
+  if (m_openElements.GetSize() == 0 && m_rootElementRead)
+    return SyntaxError("element '%.*s' after the root element", name.GetLength(), name.GetData());
+
+  for (;;)
+  {
+    SkipWhitespace();
+    if (m_pPosition == m_pTextEnd)
+      return SyntaxError("end of document in element '%.*s'", name.GetLength(), name.GetData());
+
+    if (*m_pPosition == '>')
+    {
+      m_pPosition++;
+      break;
+    }
+    if (*m_pPosition == '/')
+    {
+      if (!HasPrefix(m_pPosition, m_pTextEnd, "/>", 2))
+        return SyntaxError("expected '>' after '/' in element '%.*s'", name.GetLength(), name.GetData());
+
+      m_pPosition += 2;
+      m_isEmptyElement = true;
+      break;
+    }
+
+    Attribute attribute;
+    if (!ReadName(&attribute.Name))
+      return false;
+
+    SkipWhitespace();
+    if (m_pPosition == m_pTextEnd || *m_pPosition != '=')
+    {
+      return SyntaxError("expected '=' after attribute '%.*s'", attribute.Name.GetLength(),
+                         attribute.Name.GetData());
+    }
+
+    m_pPosition++;
+    SkipWhitespace();
+    if (m_pPosition == m_pTextEnd || (*m_pPosition != '"' && *m_pPosition != '\''))
+    {
+      return SyntaxError("expected a quoted value for attribute '%.*s'", attribute.Name.GetLength(),
+                         attribute.Name.GetData());
+    }
+
+    char quote = *(m_pPosition++);
+    const char* pValueEnd =
+      reinterpret_cast<const char*>(std::memchr(m_pPosition, quote, size_t(m_pTextEnd - m_pPosition)));
+    if (pValueEnd == NULL)
+    {
+      return SyntaxError("unterminated value for attribute '%.*s'", attribute.Name.GetLength(),
+                         attribute.Name.GetData());
+    }
+
+    attribute.Value = StringView(m_pPosition, pValueEnd);
+    attribute.pNameCopy = NULL;
+    attribute.pValueCopy = NULL;
+    m_attributes.Add(attribute);
+    m_pPosition = pValueEnd + 1;
+  }
+
+  m_name = name;
+  m_rootElementRead = true;
+  if (!m_isEmptyElement)
+    m_openElements.Add(name);
+
+  // the names and values are all within the tag, decoding only shortens them
+  ResetStrings(uint32(m_pPosition - m_pTokenStart) + m_attributes.GetSize() * 2 + 1);
+  m_eCurrentNodeType = XMLREADER_TOKEN_ELEMENT;
+  return true;
+}
+
+bool XMLPullReader::ReadEndElement()
+{
+  m_pPosition += 2;
+  StringView name;
+  if (!ReadName(&name))
+    return false;
+
+  SkipWhitespace();
+  if (m_pPosition == m_pTextEnd || *m_pPosition != '>')
+    return SyntaxError("expected '>' after end of element '%.*s'", name.GetLength(), name.GetData());
+
+  m_pPosition++;
+  if (m_openElements.GetSize() == 0)
+    return SyntaxError("end of element '%.*s' with no element open", name.GetLength(), name.GetData());
+
+  const StringView& openName = m_openElements.LastElement();
+  if (!openName.Compare(name))
+  {
+    return SyntaxError("end of element '%.*s' doesn't match '%.*s'", name.GetLength(), name.GetData(),
+                       openName.GetLength(), openName.GetData());
+  }
+
+  m_openElements.RemoveBack();
+  m_name = name;
+  ResetStrings(name.GetLength() + 1);
+  m_eCurrentNodeType = XMLREADER_TOKEN_END_ELEMENT;
+  return true;
+}
+
+bool XMLPullReader::ReadName(StringView* pName)
+{
+  const char* pStart = m_pPosition;
+  while (m_pPosition != m_pTextEnd && !IsNameTerminator(*m_pPosition))
+    m_pPosition++;
+
+  if (m_pPosition == pStart)
+    return SyntaxError("expected a name");
+
+  *pName = StringView(pStart, m_pPosition);
+  return true;
+}
+
+bool XMLPullReader::SkipPast(const char* terminator, const char* what)
+{
+  uint32 terminatorLength = Y_strlen(terminator);
+  const char* pFound = Y_strnstr(m_pPosition, uint32(m_pTextEnd - m_pPosition), terminator, terminatorLength);
+  if (pFound == NULL)
+    return SyntaxError("unterminated %s", what);
+
+  m_pPosition = pFound + terminatorLength;
+  return true;
+}
+
+bool XMLPullReader::SkipDoctype()
+{
+  // the internal subset in brackets can have '>' of its own, quoted or not
+  uint32 bracketDepth = 0;
+  char quote = 0;
+  for (m_pPosition += 9; m_pPosition != m_pTextEnd; m_pPosition++)
+  {
+    char ch = *m_pPosition;
+    if (quote != 0)
+    {
+      if (ch == quote)
+        quote = 0;
+    }
+    else if (ch == '"' || ch == '\'')
+    {
+      quote = ch;
+    }
+    else if (ch == '[')
+    {
+      bracketDepth++;
+    }
+    else if (ch == ']' && bracketDepth > 0)
+    {
+      bracketDepth--;
+    }
+    else if (ch == '>' && bracketDepth == 0)
+    {
+      m_pPosition++;
+      return true;
+    }
+  }
+
+  return SyntaxError("unterminated doctype");
+}
+
+void XMLPullReader::SkipWhitespace()
+{
+  while (m_pPosition != m_pTextEnd && IsWhitespace(*m_pPosition))
+    m_pPosition++;
+}
+
+bool XMLPullReader::SyntaxError(const char* Format, ...)
+{
+  char buf[512];
+
+  va_list ap;
+  va_start(ap, Format);
+  Y_vsnprintf(buf, countof(buf), Format, ap);
+  va_end(ap);
+
+  uint32 line, col;
+  GetLocation(m_pText, m_pPosition, &line, &col);
+  Log_ErrorPrintf("%s:%u:%u: %s", m_szFileName, line, col, buf);
+  m_bErrorState = true;
+  return false;
+}
+
+void XMLPullReader::ResetStrings(uint32 maxLength)
+{
+  if (maxLength > m_stringsSize)
+  {
+    m_stringsSize = Max(maxLength, Max(m_stringsSize * 2, 256u));
+    m_pStrings = static_cast<char*>(Y_realloc(m_pStrings, m_stringsSize));
+  }
+
+  m_stringsLength = 0;
+}
+
+const char* XMLPullReader::CopyString(StringView* pText)
+{
+  DebugAssert(m_stringsLength + pText->GetLength() < m_stringsSize);
+  char* pCopy = m_pStrings + m_stringsLength;
+  std::memcpy(pCopy, pText->GetData(), pText->GetLength());
+  pCopy[pText->GetLength()] = '\0';
+  m_stringsLength += pText->GetLength() + 1;
+
+  *pText = StringView(pCopy, pText->GetLength());
+  return pCopy;
+}
+
+const char* XMLPullReader::DecodeString(StringView* pText, bool attribute)
+{
+  DebugAssert(m_stringsLength + pText->GetLength() < m_stringsSize);
+  char* pCopy = m_pStrings + m_stringsLength;
+  char* pOut = pCopy;
+  const char* pIn = pText->GetData();
+  const char* pInEnd = pText->GetEnd();
+  while (pIn != pInEnd)
+  {
+    char ch = *(pIn++);
+    if (ch == '\r')
+    {
+      // line breaks are all line feeds, then in attributes, spaces
+      if (pIn != pInEnd && *pIn == '\n')
+        pIn++;
+
+      *(pOut++) = attribute ? ' ' : '\n';
+      continue;
+    }
+    if (attribute && (ch == '\t' || ch == '\n'))
+    {
+      *(pOut++) = ' ';
+      continue;
+    }
+    if (ch != '&')
+    {
+      *(pOut++) = ch;
+      continue;
+    }
+
+    // the name is short, a code point at most 8 hex digits
+    const char* pSemicolon =
+      reinterpret_cast<const char*>(std::memchr(pIn, ';', Min(size_t(pInEnd - pIn), size_t(12))));
+    StringView entity(pIn, (pSemicolon != NULL) ? pSemicolon : pIn);
+    char32_t codePoint = 0;
+    if (entity.Compare(StringView("lt", 2)))
+      codePoint = '<';
+    else if (entity.Compare(StringView("gt", 2)))
+      codePoint = '>';
+    else if (entity.Compare(StringView("amp", 3)))
+      codePoint = '&';
+    else if (entity.Compare(StringView("apos", 4)))
+      codePoint = '\'';
+    else if (entity.Compare(StringView("quot", 4)))
+      codePoint = '"';
+    else if (entity.GetLength() > 1 && entity.GetData()[0] == '#')
+    {
+      bool hex = (entity.GetData()[1] == 'x');
+      uint32 digitCount = 0;
+      for (uint32 i = hex ? 2 : 1; i < entity.GetLength(); i++, digitCount++)
+      {
+        char digit = entity.GetData()[i];
+        uint32 value;
+        if (digit >= '0' && digit <= '9')
+          value = uint32(digit - '0');
+        else if (hex && digit >= 'a' && digit <= 'f')
+          value = uint32(digit - 'a' + 10);
+        else if (hex && digit >= 'A' && digit <= 'F')
+          value = uint32(digit - 'A' + 10);
+        else
+          break;
+
+        codePoint = codePoint * (hex ? 16 : 10) + value;
+        if (codePoint > 0x10FFFF)
+          break;
+      }
+
+      if (digitCount == 0 || digitCount != entity.GetLength() - (hex ? 2 : 1))
+        codePoint = 0;
+    }
+
+    uint32 length = (codePoint != 0) ? UnicodeConversion::UTF32ToUTF8(pOut, 4, &codePoint, 1) : 0;
+    if (codePoint == 0 || length == UnicodeConversion::InvalidLength)
+    {
+      // left as it was, with the document marked as bad
+      const char* pPosition = m_pPosition;
+      m_pPosition = pIn - 1;
+      SyntaxError("unknown entity '&%.*s;'", entity.GetLength(), entity.GetData());
+      m_pPosition = pPosition;
+      *(pOut++) = '&';
+      continue;
+    }
+
+    pOut += length;
+    pIn = pSemicolon + 1;
+  }
+
+  *pOut = '\0';
+  m_stringsLength += uint32(pOut - pCopy) + 1;
+  *pText = StringView(pCopy, pOut);
+  return pCopy;
+}
+
+const char* XMLPullReader::GetValueCopy()
+{
+  if (m_currentAttribute >= 0)
+  {
+    Attribute& attribute = m_attributes[m_currentAttribute];
+    if (attribute.pValueCopy == NULL)
+      attribute.pValueCopy = DecodeString(&attribute.Value, true);
+
+    return attribute.pValueCopy;
+  }
+
+  DebugAssert(m_eCurrentNodeType == XMLREADER_TOKEN_TEXT);
+  if (m_pValueCopy == NULL)
+    m_pValueCopy = m_valueIsCData ? CopyString(&m_value) : DecodeString(&m_value, false);
+
+  return m_pValueCopy;
+}
+
+const char* XMLPullReader::GetNodeName()
+{
+  if (m_currentAttribute >= 0)
+  {
+    Attribute& attribute = m_attributes[m_currentAttribute];
+    if (attribute.pNameCopy == NULL)
+      attribute.pNameCopy = CopyString(&attribute.Name);
+
+    return attribute.pNameCopy;
+  }
+
+  if (m_eCurrentNodeType == XMLREADER_TOKEN_COUNT)
+    return NULL;
+
+  if (m_pNameCopy == NULL)
+    m_pNameCopy = CopyString(&m_name);
+
+  return m_pNameCopy;
+}
+
+const char* XMLPullReader::GetNodeValue()
+{
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_ATTRIBUTE && m_eCurrentNodeType != XMLREADER_TOKEN_TEXT)
+    return NULL;
+
+  return GetValueCopy();
+}
+
+const char* XMLPullReader::GetNodeValueString()
+{
+  const char* v = GetNodeValue();
+  return (v != NULL) ? v : "";
+}
+
+StringView XMLPullReader::GetNodeNameView() const
+{
+  return (m_currentAttribute >= 0) ? m_attributes[m_currentAttribute].Name : m_name;
+}
+
+StringView XMLPullReader::GetNodeValueView()
+{
+  if (m_currentAttribute >= 0)
+  {
+    Attribute& attribute = m_attributes[m_currentAttribute];
+    if (attribute.pValueCopy == NULL && NeedsDecoding(attribute.Value, true))
+      GetValueCopy();
+
+    return attribute.Value;
+  }
+
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_TEXT)
+    return StringView();
+
+  if (m_pValueCopy == NULL && !m_valueIsCData && NeedsDecoding(m_value, false))
+    GetValueCopy();
+
+  return m_value;
+}
+
+bool XMLPullReader::MoveToFirstAttribute()
+{
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_ELEMENT && m_eCurrentNodeType != XMLREADER_TOKEN_ATTRIBUTE)
+    return false;
+  if (m_attributes.GetSize() == 0)
+    return false;
+
+  m_currentAttribute = 0;
+  m_eCurrentNodeType = XMLREADER_TOKEN_ATTRIBUTE;
+  return true;
+}
+
+bool XMLPullReader::MoveToNextAttribute()
+{
+  if (m_eCurrentNodeType == XMLREADER_TOKEN_ELEMENT)
+    return MoveToFirstAttribute();
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_ATTRIBUTE || uint32(m_currentAttribute + 1) >= m_attributes.GetSize())
+    return false;
+
+  m_currentAttribute++;
+  return true;
+}
+
+bool XMLPullReader::MoveToAttribute(const char* AttributeName)
+{
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_ELEMENT && m_eCurrentNodeType != XMLREADER_TOKEN_ATTRIBUTE)
+    return false;
+
+  StringView name(AttributeName);
+  for (uint32 i = 0; i < m_attributes.GetSize(); i++)
+  {
+    if (m_attributes[i].Name.Compare(name))
+    {
+      m_currentAttribute = int32(i);
+      m_eCurrentNodeType = XMLREADER_TOKEN_ATTRIBUTE;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool XMLPullReader::MoveToElement()
+{
+  if (m_eCurrentNodeType == XMLREADER_TOKEN_ELEMENT)
+    return true;
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_ATTRIBUTE)
+    return false;
+
+  m_currentAttribute = -1;
+  m_eCurrentNodeType = XMLREADER_TOKEN_ELEMENT;
+  return true;
+}
+
+const char* XMLPullReader::FetchAttribute(const char* AttributeName)
+{
+  return (MoveToAttribute(AttributeName)) ? GetNodeValue() : NULL;
+}
+
+const char* XMLPullReader::FetchAttributeString(const char* AttributeName)
+{
+  return (MoveToAttribute(AttributeName)) ? GetNodeValueString() : "";
+}
+
+const char* XMLPullReader::FetchAttributeDefault(const char* attributeName, const char* defaultValue)
+{
+  return (MoveToAttribute(attributeName)) ? GetNodeValueString() : defaultValue;
+}
+
+bool XMLPullReader::FetchAttributeView(const char* attributeName, StringView* pValue)
+{
+  if (!MoveToAttribute(attributeName))
+    return false;
+
+  *pValue = GetNodeValueView();
+  return true;
+}
+
+bool XMLPullReader::IsEmptyElement()
+{
+  DebugAssert(m_eCurrentNodeType == XMLREADER_TOKEN_ELEMENT || m_eCurrentNodeType == XMLREADER_TOKEN_ATTRIBUTE);
+  return m_isEmptyElement;
+}
+
+void XMLPullReader::PrintWarning(const char* Format, ...)
+{
+  char buf[512];
+
+  va_list ap;
+  va_start(ap, Format);
+  Y_vsnprintf(buf, countof(buf), Format, ap);
+  va_end(ap);
+
+  uint32 line, col;
+  GetLocation(m_pText, (m_pTokenStart != NULL) ? m_pTokenStart : m_pText, &line, &col);
+  Log_WarningPrintf("%s:%u:%u: %s", m_szFileName, line, col, buf);
+}
+
+void XMLPullReader::PrintError(const char* Format, ...)
+{
+  char buf[512];
+
+  va_list ap;
+  va_start(ap, Format);
+  Y_vsnprintf(buf, countof(buf), Format, ap);
+  va_end(ap);
+
+  uint32 line, col;
+  GetLocation(m_pText, (m_pTokenStart != NULL) ? m_pTokenStart : m_pText, &line, &col);
+  Log_ErrorPrintf("%s:%u:%u: %s", m_szFileName, line, col, buf);
+}
+
+bool XMLPullReader::SkipToElement(const char* ElementName)
+{
+  StringView elementName(ElementName);
+  for (;;)
+  {
+    if (m_eCurrentNodeType == XMLREADER_TOKEN_ELEMENT && m_name.CompareInsensitive(elementName))
+      return true;
+
+    if (!NextToken())
+      return false;
+  }
+}
+
+bool XMLPullReader::SkipCurrentElement()
+{
+  // if we're on the attribute node, switch back to the element node.
+  MoveToElement();
+
+  // if we're an empty node, exit out, since the next node will be the next one in the tree anyway.
+  if (m_isEmptyElement)
+    return true;
+
+  // the end tag that closes it is the one that brings the open elements back to where they were before it
+  uint32 depth = m_openElements.GetSize();
+  for (;;)
+  {
+    if (!NextToken())
+      return false;
+
+    if (m_eCurrentNodeType == XMLREADER_TOKEN_END_ELEMENT && m_openElements.GetSize() < depth)
+      return true;
+  }
+}
+
+int32 XMLPullReader::Select(const char* SelectionString, bool AbortOnError /* = true */)
+{
+  int32 s = Y_selectstring(SelectionString, GetNodeName());
+  if (s < 0 && AbortOnError)
+  {
+    PrintError("expected '%s', got '%s'", SelectionString, GetNodeName());
+    m_bErrorState = true;
+  }
+
+  return s;
+}
+
+int32 XMLPullReader::SelectAttribute(const char* AttributeName, const char* SelectionString,
+                                     bool AbortOnError /* = true */)
+{
+  const char* attributeValue = FetchAttributeString(AttributeName);
+  int32 s = Y_selectstring(SelectionString, attributeValue);
+  if (s < 0 && AbortOnError)
+  {
+    PrintError("for attribute '%s': expected '%s', got '%s'", AttributeName, SelectionString, attributeValue);
+    m_bErrorState = true;
+  }
+
+  return s;
+}
+
+int32 XMLPullReader::Select(const XMLSelector& selector, bool AbortOnError /* = true */)
+{
+  StringView name = GetNodeNameView();
+  int32 s = selector.Find(name);
+  if (s < 0 && AbortOnError)
+  {
+    PrintError("expected '%s', got '%.*s'", selector.GetSelectionString(), name.GetLength(), name.GetData());
+    m_bErrorState = true;
+  }
+
+  return s;
+}
+
+int32 XMLPullReader::SelectAttribute(const char* AttributeName, const XMLSelector& selector,
+                                     bool AbortOnError /* = true */)
+{
+  // missing attributes are empty, like FetchAttributeString
+  StringView attributeValue;
+  FetchAttributeView(AttributeName, &attributeValue);
+  int32 s = selector.Find(attributeValue);
+  if (s < 0 && AbortOnError)
+  {
+    PrintError("for attribute '%s': expected '%s', got '%.*s'", AttributeName, selector.GetSelectionString(),
+               attributeValue.GetLength(), attributeValue.GetData());
+    m_bErrorState = true;
+  }
+
+  return s;
+}
+
+String XMLPullReader::GetElementText(bool skipElement /*= false*/)
+{
+  String retString;
+  if (!m_bErrorState)
+  {
+    DebugAssert(m_eCurrentNodeType == XMLREADER_TOKEN_ATTRIBUTE || m_eCurrentNodeType == XMLREADER_TOKEN_ELEMENT ||
+                m_eCurrentNodeType == XMLREADER_TOKEN_TEXT);
+    if (m_eCurrentNodeType == XMLREADER_TOKEN_TEXT ||
+        (MoveToElement() && !m_isEmptyElement && NextToken() && m_eCurrentNodeType == XMLREADER_TOKEN_TEXT))
+    {
+      retString = GetNodeValueView();
+      if (skipElement)
+        SkipCurrentElement();
+    }
+  }
+
+  return retString;
+}
+
+bool XMLPullReader::ExpectEndOfElement()
+{
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_END_ELEMENT)
+  {
+    PrintError("expected end of element, current node is not end of element.");
+    m_bErrorState = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool XMLPullReader::ExpectEndOfElementName(const char* nodeName)
+{
+  if (m_eCurrentNodeType != XMLREADER_TOKEN_END_ELEMENT)
+  {
+    PrintError("expected end of element, current node is not end of element.");
+    m_bErrorState = true;
+    return false;
+  }
+
+  if (!m_name.CompareInsensitive(StringView(nodeName)))
+  {
+    PrintError("expecting end of element type '%s', got '%.*s'", nodeName, m_name.GetLength(), m_name.GetData());
+    m_bErrorState = true;
+    return false;
+  }
+
+  return true;
+}
@@ -4,6 +4,7 @@
 #include "YBaseLib/Assert.h"
 #include "YBaseLib/CString.h"
 #include "YBaseLib/Log.h"
+#include "YBaseLib/XMLSelector.h"
 #include <libxml/threads.h>
 #include <libxml/xmlreader.h>
 Log_SetChannel(XMLReader);
@@ -347,6 +348,32 @@ int32 XMLReader::SelectAttribute(const char* AttributeName, const char* Selectio
   return s;
 }
 
+int32 XMLReader::Select(const XMLSelector& selector, bool AbortOnError /* = true */)
+{
+  int32 s = selector.Find(GetNodeName());
+  if (s < 0 && AbortOnError)
+  {
+    PrintError("expected '%s', got '%s'", selector.GetSelectionString(), GetNodeName());
+    m_bErrorState = true;
+  }
+
+  return s;
+}
+
+int32 XMLReader::SelectAttribute(const char* AttributeName, const XMLSelector& selector, bool AbortOnError /* = true */)
+{
+  const char* attributeValue = FetchAttributeString(AttributeName);
+  int32 s = selector.Find(attributeValue);
+  if (s < 0 && AbortOnError)
+  {
+    PrintError("for attribute '%s': expected '%s', got '%s'", AttributeName, selector.GetSelectionString(),
+               attributeValue);
+    m_bErrorState = true;
+  }
+
+  return s;
+}
+
 String XMLReader::GetElementText(bool skipElement /*= false*/)
 {
   String retString;
@@ -0,0 +1,72 @@
+#include "YBaseLib/XMLSelector.h"
+#include "YBaseLib/CString.h"
+
+XMLSelector::XMLSelector(const char* selectionString)
+  : m_selectionString(selectionString), m_slotMask(0), m_alternativeCount(0)
+{
+  // Alternatives are separated by '|'. Like Y_selectstring, empty ones before a '|' can match an empty value, an
+  // empty one at the end can't.
+  const char* pText = m_selectionString.GetCharArray();
+  uint32 length = m_selectionString.GetLength();
+  PODArray<Slot> alternatives;
+  uint32 start = 0;
+  for (uint32 i = 0; i <= length; i++)
+  {
+    if (i < length && pText[i] != '|')
+      continue;
+    if (i == length && start == length)
+      break;
+
+    Slot alternative;
+    alternative.Hash = Y_HashStringCaseInsensitive(pText + start, i - start);
+    alternative.Index = (int32)alternatives.GetSize();
+    alternative.Offset = start;
+    alternative.Length = i - start;
+    alternatives.Add(alternative);
+    start = i + 1;
+  }
+
+  m_alternativeCount = alternatives.GetSize();
+
+  // at most half full, so probes are short
+  uint32 slotCount = 4;
+  while (slotCount < m_alternativeCount * 2)
+    slotCount *= 2;
+
+  Slot emptySlot = {0, -1, 0, 0};
+  m_slots.Resize(slotCount);
+  for (uint32 i = 0; i < slotCount; i++)
+    m_slots[i] = emptySlot;
+  m_slotMask = slotCount - 1;
+
+  for (uint32 i = 0; i < alternatives.GetSize(); i++)
+  {
+    // repeats are left out, so the first is found
+    const Slot& alternative = alternatives[i];
+    if (Find(pText + alternative.Offset, alternative.Length) >= 0)
+      continue;
+
+    uint32 slotIndex = alternative.Hash & m_slotMask;
+    while (m_slots[slotIndex].Index >= 0)
+      slotIndex = (slotIndex + 1) & m_slotMask;
+
+    m_slots[slotIndex] = alternative;
+  }
+}
+
+XMLSelector::~XMLSelector() {}
+
+int32 XMLSelector::Find(const char* value, uint32 length) const
+{
+  HashType hash = Y_HashStringCaseInsensitive(value, length);
+  const char* pText = m_selectionString.GetCharArray();
+  for (uint32 slotIndex = hash & m_slotMask;; slotIndex = (slotIndex + 1) & m_slotMask)
+  {
+    const Slot& slot = m_slots[slotIndex];
+    if (slot.Index < 0)
+      return -1;
+
+    if (slot.Hash == hash && slot.Length == length && Y_strnicmp(pText + slot.Offset, value, length) == 0)
+      return slot.Index;
+  }
+}
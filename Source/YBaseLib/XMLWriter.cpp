@@ -1,35 +1,89 @@
 #include "YBaseLib/XMLWriter.h"
-
-#ifdef HAVE_LIBXML2
 #include "YBaseLib/Assert.h"
+#include "YBaseLib/Base64.h"
 #include "YBaseLib/CString.h"
 #include "YBaseLib/Log.h"
-#include "YBaseLib/Memory.h"
-#include <libxml/xmlwriter.h>
+#include "YBaseLib/NumberConversion.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/UnicodeConversion.h"
+#include <cstring>
 Log_SetChannel(XMLWriter);
 
-// Ensure libxml gets pulled in
-#if Y_COMPILER_MSVC
-#pragma comment(lib, "libxml2.lib")
+#if defined(Y_CPU_X64) || Y_CPU_SSE_LEVEL >= 2
+#include <emmintrin.h>
+#define Y_XMLWRITER_SSE2 1
+#elif defined(Y_CPU_AARCH64)
+#include <arm_neon.h>
+#define Y_XMLWRITER_NEON 1
 #endif
 
-static int XMLWriterWriteCallback(void* context, const char* buffer, int len)
-{
-  uint32 got = ((ByteStream*)context)->Write(buffer, len);
-  return got;
-}
+const uint32 XMLWriter::BufferSize;
 
-static int XMLWriterCloseCallback(void* context)
+// The characters xmlTextWriter escapes: in text '<', '>', '&', '"' and '\r', and in attributes also '\n', '\t' and
+// anything that isn't ASCII, which is written as a character reference.
+static uint32 FindEscape(const char* pText, uint32 length, bool attribute)
 {
-  return 0;
+  char tab = attribute ? '\t' : '&';
+  char lineFeed = attribute ? '\n' : '&';
+  uint32 i = 0;
+
+  // a block with anything to escape is left to the loop below to find where
+#if defined(Y_XMLWRITER_SSE2)
+  const __m128i lessThans = _mm_set1_epi8('<');
+  const __m128i greaterThans = _mm_set1_epi8('>');
+  const __m128i ampersands = _mm_set1_epi8('&');
+  const __m128i quotes = _mm_set1_epi8('"');
+  const __m128i carriageReturns = _mm_set1_epi8('\r');
+  const __m128i tabs = _mm_set1_epi8(tab);
+  const __m128i lineFeeds = _mm_set1_epi8(lineFeed);
+  const int nonASCIIMask = attribute ? 0xFFFF : 0;
+  for (; length - i >= 16; i += 16)
+  {
+    __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pText + i));
+    __m128i found = _mm_or_si128(_mm_cmpeq_epi8(chars, lessThans), _mm_cmpeq_epi8(chars, greaterThans));
+    found = _mm_or_si128(found, _mm_or_si128(_mm_cmpeq_epi8(chars, ampersands), _mm_cmpeq_epi8(chars, quotes)));
+    found = _mm_or_si128(found, _mm_cmpeq_epi8(chars, carriageReturns));
+    found = _mm_or_si128(found, _mm_or_si128(_mm_cmpeq_epi8(chars, tabs), _mm_cmpeq_epi8(chars, lineFeeds)));
+    if ((_mm_movemask_epi8(found) | (_mm_movemask_epi8(chars) & nonASCIIMask)) != 0)
+      break;
+  }
+#elif defined(Y_XMLWRITER_NEON)
+  const uint8x16_t lessThans = vdupq_n_u8('<');
+  const uint8x16_t greaterThans = vdupq_n_u8('>');
+  const uint8x16_t ampersands = vdupq_n_u8('&');
+  const uint8x16_t quotes = vdupq_n_u8('"');
+  const uint8x16_t carriageReturns = vdupq_n_u8('\r');
+  const uint8x16_t tabs = vdupq_n_u8(uint8(tab));
+  const uint8x16_t lineFeeds = vdupq_n_u8(uint8(lineFeed));
+  const uint8x16_t nonASCII = vdupq_n_u8(attribute ? 0x80 : 0xFF);
+  for (; length - i >= 16; i += 16)
+  {
+    uint8x16_t chars = vld1q_u8(reinterpret_cast<const uint8*>(pText + i));
+    uint8x16_t found = vorrq_u8(vceqq_u8(chars, lessThans), vceqq_u8(chars, greaterThans));
+    found = vorrq_u8(found, vorrq_u8(vceqq_u8(chars, ampersands), vceqq_u8(chars, quotes)));
+    found = vorrq_u8(found, vorrq_u8(vceqq_u8(chars, carriageReturns), vcgeq_u8(chars, nonASCII)));
+    found = vorrq_u8(found, vorrq_u8(vceqq_u8(chars, tabs), vceqq_u8(chars, lineFeeds)));
+    if (vmaxvq_u8(found) != 0)
+      break;
+  }
+#endif
+
+  for (; i < length; i++)
+  {
+    char ch = pText[i];
+    if (ch == '<' || ch == '>' || ch == '&' || ch == '"' || ch == '\r' || ch == tab || ch == lineFeed ||
+        (attribute && (ch & 0x80) != 0))
+    {
+      break;
+    }
+  }
+
+  return i;
 }
 
 XMLWriter::XMLWriter()
+  : m_pOutputStream(NULL), m_inStartTag(false), m_indentEndTag(true), m_bufferLength(0), m_bErrorState(true)
 {
-  m_pOutputStream = NULL;
-  m_pWriter = NULL;
-  m_pOutputBuffer = NULL;
-  m_bErrorState = true;
 }
 
 XMLWriter::~XMLWriter()
@@ -41,73 +95,211 @@ bool XMLWriter::Create(ByteStream* pOutputStream)
 {
   Close();
 
-  xmlOutputBufferPtr pOutputBuffer =
-    xmlOutputBufferCreateIO(XMLWriterWriteCallback, XMLWriterCloseCallback, (void*)pOutputStream, NULL);
-  if (pOutputBuffer == NULL)
+  m_pOutputStream = pOutputStream;
+  m_elementNames.Clear();
+  m_elementNameOffsets.Clear();
+  m_inStartTag = false;
+  m_indentEndTag = true;
+  m_bufferLength = 0;
+  m_bErrorState = false;
+
+  // write the start of the document
+  static const char declaration[] = "<?xml version=\"1.0\"?>\n";
+  Write(declaration, countof(declaration) - 1);
+  return !m_bErrorState;
+}
+
+void XMLWriter::Close()
+{
+  if (m_pOutputStream == NULL)
+    return;
+
+  // open elements are ended even after a call failed, like xmlTextWriterEndDocument does
+  m_bErrorState = m_pOutputStream->InErrorState();
+  while (!m_bErrorState && m_elementNameOffsets.GetSize() > 0)
+    EndElement();
+
+  FlushBuffer();
+  m_pOutputStream = NULL;
+  m_bErrorState = true;
+}
+
+bool XMLWriter::FlushBuffer()
+{
+  if (m_bufferLength > 0 && !m_bErrorState)
   {
-    Log_ErrorPrintf("XMLWriter::Create: xmlOutputBufferCreateIO failed.");
-    return false;
+    if (m_pOutputStream->Write(m_buffer, m_bufferLength) != m_bufferLength)
+    {
+      Log_ErrorPrintf("XMLWriter::FlushBuffer: failed to write to the stream.");
+      m_bErrorState = true;
+    }
   }
 
-  xmlTextWriterPtr pWriter = xmlNewTextWriter(pOutputBuffer);
-  if (pWriter == NULL)
+  m_bufferLength = 0;
+  return !m_bErrorState;
+}
+
+void XMLWriter::Write(const char* text, uint32 length)
+{
+  if (length > (BufferSize - m_bufferLength))
   {
-    Log_ErrorPrintf("XMLWriter::Create: xmlNewTextWriter failed.");
-    xmlOutputBufferClose(pOutputBuffer);
-    return false;
+    if (!FlushBuffer())
+      return;
+
+    // too big to be worth buffering
+    if (length >= BufferSize)
+    {
+      if (m_pOutputStream->Write(text, length) != length)
+      {
+        Log_ErrorPrintf("XMLWriter::Write: failed to write to the stream.");
+        m_bErrorState = true;
+      }
+
+      return;
+    }
   }
 
-  m_pOutputStream = pOutputStream;
-  m_pOutputBuffer = pOutputBuffer;
-  m_pWriter = pWriter;
+  std::memcpy(m_buffer + m_bufferLength, text, length);
+  m_bufferLength += length;
+}
 
-  // set up writer
-  xmlTextWriterSetIndent(pWriter, 1);
-  xmlTextWriterSetIndentString(pWriter, BAD_CAST "    ");
+char* XMLWriter::ReserveBuffer(uint32 size)
+{
+  DebugAssert(size <= BufferSize);
+  if ((BufferSize - m_bufferLength) < size && !FlushBuffer())
+    return NULL;
 
-  // write the start of the document
-  if (xmlTextWriterStartDocument(m_pWriter, NULL, NULL, NULL) < 0)
-    return false;
+  return m_buffer + m_bufferLength;
+}
 
-  m_bErrorState = false;
-  return true;
+void XMLWriter::WriteIndent(uint32 depth)
+{
+  for (uint32 i = 0; i < depth; i++)
+    Write("    ", 4);
 }
 
-void XMLWriter::Close()
+void XMLWriter::WriteEscaped(const char* text, uint32 length, bool attribute)
 {
-  // not a typo, writer will free outputbuffer if it is set
-  if (m_pWriter != NULL)
+  for (;;)
   {
-    xmlTextWriterEndDocument(m_pWriter);
-    xmlFreeTextWriter(m_pWriter);
+    uint32 runLength = FindEscape(text, length, attribute);
+    Write(text, runLength);
+    text += runLength;
+    length -= runLength;
+    if (length == 0)
+      return;
+
+    const char* replacement;
+    switch (*text)
+    {
+      case '<':
+        replacement = "&lt;";
+        break;
+      case '>':
+        replacement = "&gt;";
+        break;
+      case '&':
+        replacement = "&amp;";
+        break;
+      case '"':
+        replacement = "&quot;";
+        break;
+      case '\r':
+        replacement = "&#13;";
+        break;
+      case '\n':
+        replacement = "&#10;";
+        break;
+      case '\t':
+        replacement = "&#9;";
+        break;
+      default:
+        replacement = NULL;
+        break;
+    }
+
+    if (replacement != NULL)
+    {
+      Write(replacement, Y_strlen(replacement));
+      text++;
+      length--;
+      continue;
+    }
+
+    // a character outside ASCII, or a byte that doesn't start one, which is written as if it were the character
+    uint32 sequenceLength = 1;
+    uint8 lead = uint8(*text);
+    if (lead >= 0xC0)
+      sequenceLength = (lead >= 0xF0) ? 4 : ((lead >= 0xE0) ? 3 : 2);
+
+    char32_t codePoint = lead;
+    if (sequenceLength > length || !UnicodeConversion::ValidateUTF8(text, sequenceLength) ||
+        UnicodeConversion::UTF8ToUTF32(&codePoint, 1, text, sequenceLength) != 1)
+    {
+      codePoint = lead;
+      sequenceLength = 1;
+    }
+
+    char reference[16];
+    uint32 referenceLength = 0;
+    reference[referenceLength++] = '&';
+    reference[referenceLength++] = '#';
+    reference[referenceLength++] = 'x';
+    uint32 shift = 28;
+    while (shift > 0 && (codePoint >> shift) == 0)
+      shift -= 4;
+    for (;;)
+    {
+      reference[referenceLength++] = "0123456789ABCDEF"[(codePoint >> shift) & 0xF];
+      if (shift == 0)
+        break;
+      shift -= 4;
+    }
+    reference[referenceLength++] = ';';
+
+    Write(reference, referenceLength);
+    text += sequenceLength;
+    length -= sequenceLength;
   }
-  else if (m_pOutputBuffer != NULL)
+}
+
+bool XMLWriter::StartContent()
+{
+  if (m_bErrorState)
+    return false;
+
+  if (m_inStartTag)
   {
-    xmlOutputBufferClose(m_pOutputBuffer);
+    Write(">", 1);
+    m_inStartTag = false;
   }
 
-  m_pOutputStream = NULL;
-  m_pOutputBuffer = NULL;
-  m_pWriter = NULL;
-  m_bErrorState = true;
+  m_indentEndTag = false;
+  return true;
 }
 
-void XMLWriter::WriteEmptyElement(const char* elementName)
+bool XMLWriter::StartAttribute(const char* attributeName)
 {
   if (m_bErrorState)
-    return;
+    return false;
 
-  if (xmlTextWriterStartElement(m_pWriter, BAD_CAST elementName) < 0)
+  if (!m_inStartTag)
   {
+    Log_ErrorPrintf("XMLWriter::StartAttribute: attribute '%s' outside of a start tag", attributeName);
     m_bErrorState = true;
-    return;
+    return false;
   }
 
-  if (xmlTextWriterEndElement(m_pWriter) < 0)
-  {
-    m_bErrorState = true;
-    return;
-  }
+  Write(" ", 1);
+  Write(attributeName, Y_strlen(attributeName));
+  Write("=\"", 2);
+  return true;
+}
+
+void XMLWriter::WriteEmptyElement(const char* elementName)
+{
+  StartElement(elementName);
+  EndElement();
 }
 
 void XMLWriter::StartElement(const char* elementName)
@@ -115,11 +307,18 @@ void XMLWriter::StartElement(const char* elementName)
   if (m_bErrorState)
     return;
 
-  if (xmlTextWriterStartElement(m_pWriter, BAD_CAST elementName) < 0)
-  {
-    m_bErrorState = true;
-    return;
-  }
+  if (m_inStartTag)
+    Write(">\n", 2);
+
+  WriteIndent(m_elementNameOffsets.GetSize());
+
+  uint32 nameLength = Y_strlen(elementName);
+  m_elementNameOffsets.Add(m_elementNames.GetSize());
+  m_elementNames.AddRange(elementName, nameLength + 1);
+
+  Write("<", 1);
+  Write(elementName, nameLength);
+  m_inStartTag = true;
 }
 
 void XMLWriter::EndElement()
@@ -127,89 +326,197 @@ void XMLWriter::EndElement()
   if (m_bErrorState)
     return;
 
-  if (xmlTextWriterEndElement(m_pWriter) < 0)
+  if (m_elementNameOffsets.GetSize() == 0)
   {
+    Log_ErrorPrintf("XMLWriter::EndElement: no element to end");
     m_bErrorState = true;
     return;
   }
+
+  uint32 nameOffset = m_elementNameOffsets.LastElement();
+  m_elementNameOffsets.RemoveBack();
+  if (m_inStartTag)
+  {
+    Write("/>\n", 3);
+  }
+  else
+  {
+    if (m_indentEndTag)
+      WriteIndent(m_elementNameOffsets.GetSize());
+
+    const char* elementName = m_elementNames.GetBasePointer() + nameOffset;
+    Write("</", 2);
+    Write(elementName, m_elementNames.GetSize() - nameOffset - 1);
+    Write(">\n", 2);
+  }
+
+  m_elementNames.Resize(nameOffset);
+  m_inStartTag = false;
+  m_indentEndTag = true;
 }
 
 void XMLWriter::WriteAttribute(const char* attributeName, const char* attributeValue)
 {
-  if (m_bErrorState)
+  if (!StartAttribute(attributeName))
     return;
 
-  if (xmlTextWriterWriteAttribute(m_pWriter, BAD_CAST attributeName, BAD_CAST attributeValue) < 0)
-  {
-    m_bErrorState = true;
-    return;
-  }
+  WriteEscaped(attributeValue, Y_strlen(attributeValue), true);
+  Write("\"", 1);
 }
 
 void XMLWriter::WriteAttributef(const char* attributeName, const char* format, ...)
 {
-  if (m_bErrorState)
+  if (!StartAttribute(attributeName))
     return;
 
-  char buf[512];
   va_list ap;
   va_start(ap, format);
 
-  // todo fix length
-  Y_vsnprintf(buf, countof(buf), format, ap);
+  // formatted straight into the buffer, where it stays unless it needs escaping or didn't fit
+  char* pBuffer = ReserveBuffer(BufferSize / 4);
+  if (pBuffer != NULL)
+  {
+    uint32 space = BufferSize - m_bufferLength;
+    va_list apCopy;
+    va_copy(apCopy, ap);
+    uint32 length = Y_vsnprintf(pBuffer, space, format, apCopy);
+    va_end(apCopy);
+
+    // some runtimes return the truncated length, so anything that fills the space is taken as cut off
+    if ((length + 1) < space && FindEscape(pBuffer, length, true) == length)
+    {
+      CommitBuffer(length);
+    }
+    else
+    {
+      SmallString value;
+      value.FormatVA(format, ap);
+      WriteEscaped(value.GetCharArray(), value.GetLength(), true);
+    }
+
+    Write("\"", 1);
+  }
 
-  WriteAttribute(attributeName, buf);
+  va_end(ap);
 }
 
-void XMLWriter::WriteString(const char* data)
+void XMLWriter::WriteAttributeInt32(const char* attributeName, int32 value)
 {
-  if (m_bErrorState)
-    return;
+  char* pBuffer;
+  if (StartAttribute(attributeName) && (pBuffer = ReserveBuffer(NumberConversion::MaxIntegerLength + 1)) != NULL)
+  {
+    uint32 length = NumberConversion::FormatInt32(pBuffer, value);
+    pBuffer[length] = '"';
+    CommitBuffer(length + 1);
+  }
+}
 
-  if (xmlTextWriterWriteString(m_pWriter, BAD_CAST data) < 0)
+void XMLWriter::WriteAttributeUInt32(const char* attributeName, uint32 value)
+{
+  char* pBuffer;
+  if (StartAttribute(attributeName) && (pBuffer = ReserveBuffer(NumberConversion::MaxIntegerLength + 1)) != NULL)
   {
-    m_bErrorState = true;
-    return;
+    uint32 length = NumberConversion::FormatUInt32(pBuffer, value);
+    pBuffer[length] = '"';
+    CommitBuffer(length + 1);
   }
 }
 
-void XMLWriter::WriteCDATA(const char* data)
+void XMLWriter::WriteAttributeInt64(const char* attributeName, int64 value)
 {
-  if (m_bErrorState)
-    return;
+  char* pBuffer;
+  if (StartAttribute(attributeName) && (pBuffer = ReserveBuffer(NumberConversion::MaxIntegerLength + 1)) != NULL)
+  {
+    uint32 length = NumberConversion::FormatInt64(pBuffer, value);
+    pBuffer[length] = '"';
+    CommitBuffer(length + 1);
+  }
+}
 
-  if (xmlTextWriterWriteCDATA(m_pWriter, BAD_CAST data) < 0)
+void XMLWriter::WriteAttributeUInt64(const char* attributeName, uint64 value)
+{
+  char* pBuffer;
+  if (StartAttribute(attributeName) && (pBuffer = ReserveBuffer(NumberConversion::MaxIntegerLength + 1)) != NULL)
   {
-    m_bErrorState = true;
-    return;
+    uint32 length = NumberConversion::FormatUInt64(pBuffer, value);
+    pBuffer[length] = '"';
+    CommitBuffer(length + 1);
   }
 }
 
-void XMLWriter::WriteRaw(const char* data, uint32 dataLength)
+void XMLWriter::WriteAttributeFloat(const char* attributeName, float value)
 {
-  if (m_bErrorState)
-    return;
+  char* pBuffer;
+  if (StartAttribute(attributeName) && (pBuffer = ReserveBuffer(NumberConversion::MaxFloatLength + 1)) != NULL)
+  {
+    uint32 length = NumberConversion::FormatFloat(pBuffer, value);
+    pBuffer[length] = '"';
+    CommitBuffer(length + 1);
+  }
+}
 
-  if (xmlTextWriterWriteRawLen(m_pWriter, BAD_CAST data, dataLength) < 0)
+void XMLWriter::WriteAttributeDouble(const char* attributeName, double value)
+{
+  char* pBuffer;
+  if (StartAttribute(attributeName) && (pBuffer = ReserveBuffer(NumberConversion::MaxFloatLength + 1)) != NULL)
   {
-    m_bErrorState = true;
-    return;
+    uint32 length = NumberConversion::FormatDouble(pBuffer, value);
+    pBuffer[length] = '"';
+    CommitBuffer(length + 1);
   }
 }
 
-void XMLWriter::WriteBase64EncodedData(const void* pData, uint32 dataLength)
+void XMLWriter::WriteString(const char* data)
 {
-  if (m_bErrorState || dataLength == 0)
+  if (StartContent())
+    WriteEscaped(data, Y_strlen(data), false);
+}
+
+void XMLWriter::WriteCDATA(const char* data)
+{
+  if (!StartContent())
     return;
 
-  uint32 tempStrLength = Y_getencodedbase64length(dataLength) + 1;
-  char* tempStr = (char*)std::malloc(tempStrLength);
+  // a "]]>" in the data would end the section, so it's split across two
+  Write("<![CDATA[", 9);
+  for (;;)
+  {
+    const char* pTerminator = Y_strstr(data, "]]>");
+    if (pTerminator == NULL)
+      break;
 
-  uint32 nChars = Y_makebase64(pData, dataLength, tempStr, tempStrLength);
-  DebugAssert(nChars > 0);
-  WriteRaw(tempStr, nChars);
+    Write(data, uint32(pTerminator - data) + 2);
+    Write("]]><![CDATA[", 12);
+    data = pTerminator + 2;
+  }
 
-  std::free(tempStr);
+  Write(data, Y_strlen(data));
+  Write("]]>", 3);
 }
 
-#endif // HAVE_LIBXML2
+void XMLWriter::WriteRaw(const char* data, uint32 dataLength)
+{
+  if (StartContent())
+    Write(data, dataLength);
+}
+
+void XMLWriter::WriteBase64EncodedData(const void* pData, uint32 dataLength)
+{
+  if (dataLength == 0 || !StartContent())
+    return;
+
+  // encoded straight into the buffer, a piece at a time if it's large
+  static const uint32 chunkSize = (BufferSize / 4 / 3) * 3;
+  const byte* pBytes = static_cast<const byte*>(pData);
+  while (dataLength > 0)
+  {
+    uint32 length = Min(dataLength, chunkSize);
+    char* pBuffer = ReserveBuffer(Base64::GetEncodedLength(length));
+    if (pBuffer == NULL)
+      return;
+
+    CommitBuffer(Base64::Encode(pBuffer, pBytes, length));
+    pBytes += length;
+    dataLength -= length;
+  }
+}
@@ -0,0 +1,160 @@
+#include "YBaseLib/XXHash64Digest.h"
+#include <cstring>
+
+// https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+static const uint64 PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64 PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64 PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64 PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64 PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64 RotateLeft(uint64 value, uint32 count)
+{
+  return (value << count) | (value >> (64 - count));
+}
+
+// the spec reads input little endian, which every supported platform is
+static inline uint64 Read64(const byte* pBytes)
+{
+  uint64 value;
+  std::memcpy(&value, pBytes, sizeof(value));
+  return value;
+}
+
+static inline uint32 Read32(const byte* pBytes)
+{
+  uint32 value;
+  std::memcpy(&value, pBytes, sizeof(value));
+  return value;
+}
+
+static inline uint64 Round(uint64 accumulator, uint64 input)
+{
+  return RotateLeft(accumulator + input * PRIME64_2, 31) * PRIME64_1;
+}
+
+static inline uint64 MergeAccumulator(uint64 hash, uint64 accumulator)
+{
+  return (hash ^ Round(0, accumulator)) * PRIME64_1 + PRIME64_4;
+}
+
+// runs whole 32 byte stripes through the accumulators, returning the bytes consumed
+static size_t ConsumeStripes(uint64 accumulators[4], const byte* pBytes, size_t length)
+{
+  uint64 v1 = accumulators[0], v2 = accumulators[1], v3 = accumulators[2], v4 = accumulators[3];
+  size_t offset = 0;
+  for (; length - offset >= 32; offset += 32)
+  {
+    v1 = Round(v1, Read64(pBytes + offset));
+    v2 = Round(v2, Read64(pBytes + offset + 8));
+    v3 = Round(v3, Read64(pBytes + offset + 16));
+    v4 = Round(v4, Read64(pBytes + offset + 24));
+  }
+
+  accumulators[0] = v1;
+  accumulators[1] = v2;
+  accumulators[2] = v3;
+  accumulators[3] = v4;
+  return offset;
+}
+
+// mixes in the last, less than 32, bytes and avalanches
+static uint64 FinishHash(uint64 hash, const byte* pBytes, size_t length)
+{
+  for (; length >= 8; pBytes += 8, length -= 8)
+    hash = RotateLeft(hash ^ Round(0, Read64(pBytes)), 27) * PRIME64_1 + PRIME64_4;
+  if (length >= 4)
+  {
+    hash = RotateLeft(hash ^ ((uint64)Read32(pBytes) * PRIME64_1), 23) * PRIME64_2 + PRIME64_3;
+    pBytes += 4;
+    length -= 4;
+  }
+  for (; length > 0; pBytes++, length--)
+    hash = RotateLeft(hash ^ ((uint64)*pBytes * PRIME64_5), 11) * PRIME64_1;
+
+  hash ^= hash >> 33;
+  hash *= PRIME64_2;
+  hash ^= hash >> 29;
+  hash *= PRIME64_3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+static uint64 ConvergeAccumulators(const uint64 accumulators[4])
+{
+  uint64 hash = RotateLeft(accumulators[0], 1) + RotateLeft(accumulators[1], 7) + RotateLeft(accumulators[2], 12) +
+                RotateLeft(accumulators[3], 18);
+  for (uint32 i = 0; i < 4; i++)
+    hash = MergeAccumulator(hash, accumulators[i]);
+
+  return hash;
+}
+
+XXHash64Digest::XXHash64Digest(uint64 seed /* = 0 */) : m_seed(seed)
+{
+  Reset();
+}
+
+void XXHash64Digest::Reset()
+{
+  m_accumulators[0] = m_seed + PRIME64_1 + PRIME64_2;
+  m_accumulators[1] = m_seed + PRIME64_2;
+  m_accumulators[2] = m_seed;
+  m_accumulators[3] = m_seed - PRIME64_1;
+  m_byteCount = 0;
+}
+
+void XXHash64Digest::Update(const void* pData, size_t cbData)
+{
+  const byte* pByteData = reinterpret_cast<const byte*>(pData);
+  size_t stripeBytes = (size_t)(m_byteCount & 31);
+  m_byteCount += cbData;
+
+  // top up a partly filled stripe first
+  if (stripeBytes > 0)
+  {
+    size_t copyLength = Min(cbData, 32 - stripeBytes);
+    std::memcpy(m_stripe + stripeBytes, pByteData, copyLength);
+    if (stripeBytes + copyLength < 32)
+      return;
+
+    ConsumeStripes(m_accumulators, m_stripe, 32);
+    pByteData += copyLength;
+    cbData -= copyLength;
+  }
+
+  size_t consumed = ConsumeStripes(m_accumulators, pByteData, cbData);
+  std::memcpy(m_stripe, pByteData + consumed, cbData - consumed);
+}
+
+uint64 XXHash64Digest::GetValue() const
+{
+  uint64 hash = (m_byteCount >= 32) ? ConvergeAccumulators(m_accumulators) : (m_seed + PRIME64_5);
+  return FinishHash(hash + m_byteCount, m_stripe, (size_t)(m_byteCount & 31));
+}
+
+void XXHash64Digest::Final(byte Digest[DIGEST_SIZE])
+{
+  uint64 value = GetValue();
+  for (uint32 i = 0; i < 8; i++)
+    Digest[i] = (byte)(value >> (56 - i * 8));
+}
+
+uint64 XXHash64Digest::Hash(const void* pData, size_t cbData, uint64 seed /* = 0 */)
+{
+  const byte* pByteData = reinterpret_cast<const byte*>(pData);
+  uint64 hash;
+  size_t consumed = 0;
+  if (cbData >= 32)
+  {
+    uint64 accumulators[4] = {seed + PRIME64_1 + PRIME64_2, seed + PRIME64_2, seed, seed - PRIME64_1};
+    consumed = ConsumeStripes(accumulators, pByteData, cbData);
+    hash = ConvergeAccumulators(accumulators);
+  }
+  else
+  {
+    hash = seed + PRIME64_5;
+  }
+
+  return FinishHash(hash + (uint64)cbData, pByteData + consumed, cbData - consumed);
+}
@@ -1,4 +1,5 @@
 #include "YBaseLib/ZLibHelpers.h"
+#include "YBaseLib/CompressionByteStream.h"
 #include "YBaseLib/Memory.h"
 
 #ifdef HAVE_ZLIB
@@ -307,12 +308,6 @@ bool WriteDeflatedDataToBuffer(void* pDestinationBuffer, uint32 cbDestinationBuf
   return true;
 }
 
-// bool WriteDeflatedDataToStream(ByteStream *pDestinationStream, const void *pSourceBuffer, uint32 cbSourceBuffer,
-// const int compressionLevel /*= Z_DEFAULT_COMPRESSION*/)
-// {
-//
-// }
-
 bool ReadDeflatedDataFromBuffer(void* pDestinationBuffer, uint32 cbDestinationBuffer, uint32* pDecompressedSize,
                                 const void* pSourceBuffer, uint32 cbSourceBuffer)
 {
@@ -338,7 +333,7 @@ bool ReadDeflatedDataFromBuffer(void* pDestinationBuffer, uint32 cbDestinationBu
     }
     else
     {
-      deflateEnd(&zStream);
+      inflateEnd(&zStream);
       return false;
     }
   }
@@ -346,14 +341,41 @@ bool ReadDeflatedDataFromBuffer(void* pDestinationBuffer, uint32 cbDestinationBu
   if (pDecompressedSize != NULL)
     *pDecompressedSize = (uint32)zStream.total_out;
 
-  deflateEnd(&zStream);
+  inflateEnd(&zStream);
   return true;
 }
 
-// bool ReadDeflatedDataFromStream(void *pDestinationBuffer, uint32 cbDestinationBuffer, ByteStream *pSourceStream)
-// {
-//
-// }
+bool WriteDeflatedDataToStream(ByteStream* pDestinationStream, const void* pSourceBuffer, uint32 cbSourceBuffer,
+                               const int compressionLevel /*= Z_DEFAULT_COMPRESSION*/)
+{
+  CompressionByteStream* pStream =
+    CompressionByteStream::CreateCompressor(pDestinationStream, COMPRESSION_CODEC_DEFLATE, compressionLevel);
+  if (pStream == NULL)
+    return false;
+
+  bool result = (cbSourceBuffer == 0 || pStream->Write2(pSourceBuffer, cbSourceBuffer)) && pStream->Finish();
+  pStream->Release();
+  return result;
+}
+
+bool ReadDeflatedDataFromStream(void* pDestinationBuffer, uint32 cbDestinationBuffer, uint32* pDecompressedSize,
+                                ByteStream* pSourceStream)
+{
+  CompressionByteStream* pStream = CompressionByteStream::CreateDecompressor(pSourceStream, COMPRESSION_CODEC_DEFLATE);
+  if (pStream == NULL)
+    return false;
+
+  // the data has to end within the buffer
+  byte extraByte;
+  uint32 decompressedSize = pStream->Read(pDestinationBuffer, cbDestinationBuffer);
+  bool result = !pStream->InErrorState() && (pStream->IsEndOfStream() || pStream->Read(&extraByte, 1) == 0) &&
+                !pStream->InErrorState();
+  pStream->Release();
+  if (pDecompressedSize != NULL)
+    *pDecompressedSize = decompressedSize;
+
+  return result;
+}
 
 } // namespace ZipHelpers
 
@@ -3,7 +3,15 @@
 #ifdef HAVE_ZLIB
 #include "YBaseLib/BinaryReader.h"
 #include "YBaseLib/BinaryWriter.h"
+#include "YBaseLib/CRC32.h"
+#include "YBaseLib/Compression.h"
+#include "YBaseLib/GlobPattern.h"
 #include "YBaseLib/Log.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/MutexLock.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/ParallelFor.h"
+#include "YBaseLib/Profiler.h"
 #include "YBaseLib/Timestamp.h"
 Log_SetChannel(ZipArchive);
 
@@ -14,6 +22,8 @@ Log_SetChannel(ZipArchive);
 #pragma comment(lib, "zdll.lib")
 #endif
 
+const uint32 ZipArchive::ReadIndex::InvalidEntry;
+
 // zip file constants
 static const uint32 ZIP_ARCHIVE_VERSION_MADE_BY = 0;
 static const uint32 ZIP_ARCHIVE_VERSION_TO_EXTRACT = 20;
@@ -22,9 +32,36 @@ static const uint32 ZIP_ARCHIVE_DATA_DESCRIPTOR_SIGNATURE = 0x08074b50;
 static const uint32 ZIP_ARCHIVE_CENTRAL_DIRECTORY_FILE_HEADER_SIGNATURE = 0x02014b50;
 static const uint32 ZIP_ARCHIVE_END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
 
+// ZIP64, for archives with more than 65535 files or sizes and offsets past 4GB, which are saturated in the 16 and 32
+// bit fields and stored in a ZIP64 extra field, or the ZIP64 end of central directory record and its locator
+static const uint32 ZIP_ARCHIVE_VERSION_TO_EXTRACT_ZIP64 = 45;
+static const uint32 ZIP_ARCHIVE_ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06064b50;
+static const uint32 ZIP_ARCHIVE_ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE = 0x07064b50;
+static const uint32 ZIP_ARCHIVE_ZIP64_END_OF_CENTRAL_DIRECTORY_SIZE = 56;
+static const uint32 ZIP_ARCHIVE_ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIZE = 20;
+static const uint16 ZIP_ARCHIVE_ZIP64_EXTRA_FIELD_ID = 0x0001;
+static const uint64 ZIP_ARCHIVE_ZIP64_LIMIT = 0xFFFFFFFF;
+static const uint32 ZIP_ARCHIVE_ZIP64_RECORD_LIMIT = 0xFFFF;
+
+// Zstandard's method number from the zip APPNOTE, alongside stored (0) and Z_DEFLATED
+static const uint32 ZIP_COMPRESSION_METHOD_ZSTD = 93;
+
 static const uint32 ZIP_STREAM_BUFFER_SIZE = 16384;
 static const uint32 ZIP_BUFFERED_IO_CHUNK_SIZE = 4096;
 
+// data held at once by ExtractFiles, OpenFiles and WriteFiles before it's handed to the workers
+static const uint32 ZIP_BULK_BATCH_SIZE = 32 * 1024 * 1024;
+
+// OpenFiles reads neighbouring files together when no more than this lies between them, allowing this much for each
+// local header's extra field, whose length the central directory doesn't give
+static const uint32 ZIP_COALESCED_READ_GAP_SIZE = 64 * 1024;
+static const uint32 ZIP_LOCAL_EXTRA_FIELD_ALLOWANCE = 64;
+
+// parallel deflate splits data into blocks of this size, and streamed writes compress this much at a time
+static const uint32 ZIP_DEFLATE_WINDOW_SIZE = 32768;
+static const uint32 ZIP_PARALLEL_DEFLATE_BLOCK_SIZE = 128 * 1024;
+static const uint32 ZIP_PARALLEL_DEFLATE_BATCH_SIZE = 4 * 1024 * 1024;
+
 struct ZIP_ARCHIVE_LOCAL_FILE_HEADER
 {
   uint32 Signature;
@@ -39,6 +76,130 @@ struct ZIP_ARCHIVE_LOCAL_FILE_HEADER
   uint16 ExtraFieldLength;
 };
 
+// the fixed part of a local file header, before its name and extra field
+static const uint32 ZIP_ARCHIVE_LOCAL_FILE_HEADER_SIZE = 30;
+
+// the fixed part of a central directory file header, before its name, extra field and comment
+static const uint32 ZIP_ARCHIVE_CENTRAL_DIRECTORY_FILE_HEADER_SIZE = 46;
+
+// Saved indexes are checked against this much of the end of the central directory, which holds the sizes, CRCs and
+// offsets of the files at the end of the archive, where they're most often added or replaced.
+static const uint32 ZIP_ARCHIVE_INDEX_SIGNATURE = 0x5849505A;
+static const uint32 ZIP_ARCHIVE_INDEX_VERSION = 2;
+static const uint32 ZIP_ARCHIVE_INDEX_TAIL_SIZE = 4096;
+
+// the start of a saved index, followed by its entries, hash slots and names
+struct ZIP_ARCHIVE_INDEX_HEADER
+{
+  uint32 Signature;
+  uint32 Version;
+
+  // the archive it's for
+  uint64 ArchiveSize;
+  uint64 CentralDirectoryOffset;
+  uint64 CentralDirectorySize;
+  uint32 CentralDirectoryRecords;
+  uint32 CentralDirectoryTailCRC32;
+
+  uint32 EntryCount;
+  uint32 SlotCount;
+  uint32 NamesSize;
+  uint32 Reserved;
+};
+
+static inline uint16 ReadLittleEndianUInt16(const byte* pData)
+{
+  return (uint16)((uint32)pData[0] | ((uint32)pData[1] << 8));
+}
+
+static inline uint32 ReadLittleEndianUInt32(const byte* pData)
+{
+  return (uint32)pData[0] | ((uint32)pData[1] << 8) | ((uint32)pData[2] << 16) | ((uint32)pData[3] << 24);
+}
+
+static inline uint64 ReadLittleEndianUInt64(const byte* pData)
+{
+  return (uint64)ReadLittleEndianUInt32(pData) | ((uint64)ReadLittleEndianUInt32(pData + 4) << 32);
+}
+
+// Replaces the saturated values with the ones in the ZIP64 extra field, which holds just those, in this order. Local
+// headers always hold both sizes there, and have no offset. Values are left alone if there's no ZIP64 field.
+static bool ReadZip64ExtraField(const byte* pExtraField, uint32 extraFieldLength, bool localHeader,
+                                uint64* pDecompressedSize, uint64* pCompressedSize, uint64* pOffset)
+{
+  uint32 position = 0;
+  while ((extraFieldLength - position) >= 4)
+  {
+    uint32 fieldID = ReadLittleEndianUInt16(pExtraField + position);
+    uint32 fieldSize = ReadLittleEndianUInt16(pExtraField + position + 2);
+    if ((extraFieldLength - position - 4) < fieldSize)
+      return false;
+
+    if (fieldID == ZIP_ARCHIVE_ZIP64_EXTRA_FIELD_ID)
+    {
+      const byte* pField = pExtraField + position + 4;
+      uint64* values[3] = {pDecompressedSize, pCompressedSize, pOffset};
+      uint32 fieldPosition = 0;
+      for (uint32 i = 0; i < countof(values); i++)
+      {
+        if (values[i] == NULL || (!localHeader && *values[i] != ZIP_ARCHIVE_ZIP64_LIMIT))
+          continue;
+
+        if ((fieldSize - fieldPosition) < sizeof(uint64))
+          return false;
+
+        *values[i] = ReadLittleEndianUInt64(pField + fieldPosition);
+        fieldPosition += sizeof(uint64);
+      }
+
+      return true;
+    }
+
+    position += 4 + fieldSize;
+  }
+
+  return true;
+}
+
+// Writes a local file header, with a ZIP64 extra field for the sizes if they don't fit.
+static bool WriteLocalFileHeader(ByteStream* pStream, const ZIP_ARCHIVE_LOCAL_FILE_HEADER* pLocalFileHeader,
+                                 const char* fileName, uint32 filenameLength)
+{
+  bool zip64 = (pLocalFileHeader->CompressedSize >= ZIP_ARCHIVE_ZIP64_LIMIT ||
+                pLocalFileHeader->DecompressedSize >= ZIP_ARCHIVE_ZIP64_LIMIT);
+  uint32 versionRequiredToExtract = pLocalFileHeader->VersionRequiredToExtract;
+  if (zip64)
+    versionRequiredToExtract = Max(versionRequiredToExtract, ZIP_ARCHIVE_VERSION_TO_EXTRACT_ZIP64);
+
+  uint32 compressedSize32 = zip64 ? 0xFFFFFFFF : (uint32)pLocalFileHeader->CompressedSize;
+  uint32 decompressedSize32 = zip64 ? 0xFFFFFFFF : (uint32)pLocalFileHeader->DecompressedSize;
+
+  BinaryWriter binaryWriter(pStream, ENDIAN_TYPE_LITTLE);
+  if (!binaryWriter.SafeWriteUInt32(pLocalFileHeader->Signature) ||             // Signature
+      !binaryWriter.SafeWriteUInt16((uint16)versionRequiredToExtract) ||        // VersionRequiredToExtract
+      !binaryWriter.SafeWriteUInt16(pLocalFileHeader->Flags) ||                 // Flags
+      !binaryWriter.SafeWriteUInt16(pLocalFileHeader->CompressionMethod) ||     // CompressionMethod
+      !binaryWriter.SafeWriteUInt32(pLocalFileHeader->ModificationTimestamp) || // ModificationTimestamp
+      !binaryWriter.SafeWriteUInt32(pLocalFileHeader->CRC32) ||                 // CRC32
+      !binaryWriter.SafeWriteUInt32(compressedSize32) ||                        // CompressedSize
+      !binaryWriter.SafeWriteUInt32(decompressedSize32) ||                      // DecompressedSize
+      !binaryWriter.SafeWriteUInt16((uint16)filenameLength) ||                  // FilenameLength
+      !binaryWriter.SafeWriteUInt16(zip64 ? 20 : 0) ||                          // ExtraFieldLength
+      !binaryWriter.SafeWriteFixedString(fileName, filenameLength))             // Filename
+  {
+    return false;
+  }
+
+  if (zip64 && (!binaryWriter.SafeWriteUInt16(ZIP_ARCHIVE_ZIP64_EXTRA_FIELD_ID) || !binaryWriter.SafeWriteUInt16(16) ||
+                !binaryWriter.SafeWriteUInt64(pLocalFileHeader->DecompressedSize) ||
+                !binaryWriter.SafeWriteUInt64(pLocalFileHeader->CompressedSize)))
+  {
+    return false;
+  }
+
+  return true;
+}
+
 static Timestamp ZipTimeToTimestamp(const uint32 ziptime)
 {
   uint32 datePart = ziptime >> 16;
@@ -70,6 +231,247 @@ static uint32 TimestampToZipTime(const Timestamp& ts)
          ((expandedTime.Second / 2) + (32 * expandedTime.Minute) + (2048 * expandedTime.Hour));
 }
 
+// Raw deflate and inflate streams, kept once a file's done with them and reset for the next one rather than set up
+// again. Deflate's state alone is around 256KB, which dominates opening many small files. Shared by every archive and
+// thread, holding at most a few of each.
+class ZipZStreamPool
+{
+public:
+  static const uint32 MAX_INFLATE_STREAMS = 16;
+  static const uint32 MAX_DEFLATE_STREAMS = 8;
+
+  ZipZStreamPool() {}
+
+  ~ZipZStreamPool()
+  {
+    for (uint32 i = 0; i < m_inflateStreams.GetSize(); i++)
+    {
+      inflateEnd(m_inflateStreams[i]);
+      delete m_inflateStreams[i];
+    }
+    for (uint32 i = 0; i < m_deflateStreams.GetSize(); i++)
+    {
+      deflateEnd(m_deflateStreams[i].pStream);
+      delete m_deflateStreams[i].pStream;
+    }
+  }
+
+  // NULL if zlib can't set one up
+  z_stream* AcquireInflateStream()
+  {
+    {
+      MutexLock lock(m_lock);
+      if (!m_inflateStreams.IsEmpty())
+      {
+        z_stream* pStream = m_inflateStreams.PopBack();
+        lock.Unlock();
+        if (inflateReset(pStream) == Z_OK)
+          return ClearBuffers(pStream);
+
+        inflateEnd(pStream);
+        delete pStream;
+      }
+    }
+
+    z_stream* pStream = new z_stream;
+    Y_memzero(pStream, sizeof(z_stream));
+    if (inflateInit2(pStream, -MAX_WBITS) != Z_OK)
+    {
+      delete pStream;
+      return NULL;
+    }
+
+    return pStream;
+  }
+
+  void ReleaseInflateStream(z_stream* pStream)
+  {
+    MutexLock lock(m_lock);
+    if (m_inflateStreams.GetSize() < MAX_INFLATE_STREAMS)
+    {
+      m_inflateStreams.Add(pStream);
+      return;
+    }
+
+    lock.Unlock();
+    inflateEnd(pStream);
+    delete pStream;
+  }
+
+  // streams keep their level when they're reset, so one is only reused for the same level
+  z_stream* AcquireDeflateStream(int compressionLevel)
+  {
+    {
+      MutexLock lock(m_lock);
+      for (uint32 i = 0; i < m_deflateStreams.GetSize(); i++)
+      {
+        if (m_deflateStreams[i].CompressionLevel != compressionLevel)
+          continue;
+
+        z_stream* pStream = m_deflateStreams[i].pStream;
+        m_deflateStreams.FastRemove(i);
+        lock.Unlock();
+        if (deflateReset(pStream) == Z_OK)
+          return ClearBuffers(pStream);
+
+        deflateEnd(pStream);
+        delete pStream;
+        break;
+      }
+    }
+
+    z_stream* pStream = new z_stream;
+    Y_memzero(pStream, sizeof(z_stream));
+    if (deflateInit2(pStream, compressionLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+      delete pStream;
+      return NULL;
+    }
+
+    return pStream;
+  }
+
+  void ReleaseDeflateStream(z_stream* pStream, int compressionLevel)
+  {
+    MutexLock lock(m_lock);
+
+    // the oldest makes way, so the levels in use stay
+    if (m_deflateStreams.GetSize() == MAX_DEFLATE_STREAMS)
+    {
+      z_stream* pOldStream = m_deflateStreams[0].pStream;
+      m_deflateStreams.OrderedRemove(0);
+      deflateEnd(pOldStream);
+      delete pOldStream;
+    }
+
+    PooledDeflateStream pooledStream = {pStream, compressionLevel};
+    m_deflateStreams.Add(pooledStream);
+  }
+
+private:
+  // resetting leaves the previous user's buffers, and streams are used as if they were freshly zeroed
+  static z_stream* ClearBuffers(z_stream* pStream)
+  {
+    pStream->next_in = NULL;
+    pStream->avail_in = 0;
+    pStream->next_out = NULL;
+    pStream->avail_out = 0;
+    return pStream;
+  }
+
+  struct PooledDeflateStream
+  {
+    z_stream* pStream;
+    int CompressionLevel;
+  };
+
+  Mutex m_lock;
+  PODArray<z_stream*> m_inflateStreams;
+  PODArray<PooledDeflateStream> m_deflateStreams;
+};
+
+static ZipZStreamPool s_zStreamPool;
+
+// Deflates data in blocks on a thread pool, the way pigz does, appending a raw deflate stream to pOutput. Each block
+// is compressed on its own, primed with the 32KB of input before it, historySize bytes of which come before pInput.
+// Blocks end with a sync flush, which byte aligns them so they can be joined, and the last ends the stream when
+// finishing. Without a pool the input is deflated as one block. pCRC32 if given is set from the blocks' CRCs.
+static bool DeflateBlocks(const byte* pInput, uint32 inputSize, uint32 historySize, bool finish,
+                          uint32 compressionLevel, ThreadPool* pThreadPool, PODArray<byte>* pOutput,
+                          uint32* pCRC32 = NULL)
+{
+  uint32 blockSize = (pThreadPool != NULL) ? ZIP_PARALLEL_DEFLATE_BLOCK_SIZE : Max(inputSize, (uint32)1);
+  uint32 blockCount = Max((inputSize + blockSize - 1) / blockSize, (uint32)1);
+
+  // sync flushes add an empty stored block to what deflate could need
+  uint32 blockOutputSize = (uint32)compressBound(Min(blockSize, inputSize)) + 16;
+  PODArray<byte> blockOutput;
+  PODArray<uint32> blockOutputLengths;
+  PODArray<uint32> blockCRCs;
+  blockOutput.Resize(blockOutputSize * blockCount);
+  blockOutputLengths.Resize(blockCount);
+  blockCRCs.Resize(blockCount);
+
+  ParallelFor(pThreadPool, 0, blockCount, 1, [&](uint32 blockIndex) {
+    Y_PROFILE_ZONE("ZipArchive::DeflateBlock");
+    uint32 blockStart = blockIndex * blockSize;
+    uint32 blockLength = Min(blockSize, inputSize - blockStart);
+    bool lastBlock = (blockIndex == blockCount - 1);
+    blockOutputLengths[blockIndex] = 0xFFFFFFFF;
+    if (pCRC32 != NULL)
+      blockCRCs[blockIndex] = crc32(0, (const Bytef*)(pInput + blockStart), blockLength);
+
+    z_stream* pZStream = s_zStreamPool.AcquireDeflateStream(compressionLevel);
+    if (pZStream == NULL)
+      return;
+
+    z_stream& zStream = *pZStream;
+    uint32 dictionarySize = Min(ZIP_DEFLATE_WINDOW_SIZE, historySize + blockStart);
+    if (dictionarySize > 0 &&
+        deflateSetDictionary(&zStream, (const Bytef*)(pInput + blockStart - dictionarySize), dictionarySize) != Z_OK)
+    {
+      s_zStreamPool.ReleaseDeflateStream(pZStream, compressionLevel);
+      return;
+    }
+
+    // the output always fits, so one call does it
+    zStream.next_in = (Bytef*)(pInput + blockStart);
+    zStream.avail_in = blockLength;
+    zStream.next_out = (Bytef*)(blockOutput.GetBasePointer() + blockIndex * blockOutputSize);
+    zStream.avail_out = blockOutputSize;
+    bool endStream = (finish && lastBlock);
+    int err = deflate(&zStream, endStream ? Z_FINISH : Z_SYNC_FLUSH);
+    if ((endStream && err == Z_STREAM_END) || (!endStream && err == Z_OK && zStream.avail_out > 0))
+      blockOutputLengths[blockIndex] = blockOutputSize - zStream.avail_out;
+
+    s_zStreamPool.ReleaseDeflateStream(pZStream, compressionLevel);
+  });
+
+  uint32 crc = 0;
+  for (uint32 i = 0; i < blockCount; i++)
+  {
+    if (blockOutputLengths[i] == 0xFFFFFFFF)
+      return false;
+
+    pOutput->AddRange(blockOutput.GetBasePointer() + i * blockOutputSize, blockOutputLengths[i]);
+    if (pCRC32 != NULL)
+      crc = crc32_combine(crc, blockCRCs[i], Min(blockSize, inputSize - i * blockSize));
+  }
+
+  if (pCRC32 != NULL)
+    *pCRC32 = crc;
+
+  return true;
+}
+
+// Compresses a whole file for the buffered writers, deflating in blocks on the pool, or as one Zstandard frame.
+static bool CompressWholeFile(uint32 compressionMethod, uint32 compressionLevel, const byte* pInput, uint32 inputSize,
+                              ThreadPool* pThreadPool, PODArray<byte>* pOutput, uint32* pCRC32)
+{
+  if (compressionMethod == Z_DEFLATED)
+    return DeflateBlocks(pInput, inputSize, 0, true, compressionLevel, pThreadPool, pOutput, pCRC32);
+
+  pOutput->Resize(Compression::GetCompressedSizeUpperBound(COMPRESSION_CODEC_ZSTD, inputSize));
+  uint32 compressedSize;
+  if (!Compression::CompressBuffer(COMPRESSION_CODEC_ZSTD, pOutput->GetBasePointer(), pOutput->GetSize(),
+                                   &compressedSize, pInput, inputSize, (int32)compressionLevel))
+  {
+    return false;
+  }
+
+  pOutput->Resize(compressedSize);
+  *pCRC32 = crc32(0, (const Bytef*)pInput, inputSize);
+  return true;
+}
+
+// methods that files can be read in, Zstandard only when it's built in
+static bool IsReadableCompressionMethod(uint32 compressionMethod)
+{
+  return (compressionMethod == 0 || compressionMethod == Z_DEFLATED ||
+          (compressionMethod == ZIP_COMPRESSION_METHOD_ZSTD &&
+           Compression::IsCodecAvailable(COMPRESSION_CODEC_ZSTD)));
+}
+
 class ZipArchiveStreamedReadByteStream : public ByteStream
 {
 public:
@@ -80,13 +482,14 @@ public:
       m_currentCRC32(0)
   {
     std::memcpy(&m_localFileHeader, pLocalFileHeader, sizeof(m_localFileHeader));
+    m_pZStream = NULL;
 
     switch (m_localFileHeader.CompressionMethod)
     {
       case Z_DEFLATED:
       {
-        Y_memzero(&m_zStream, sizeof(m_zStream));
-        if (inflateInit2(&m_zStream, -MAX_WBITS) != Z_OK)
+        m_pZStream = s_zStreamPool.AcquireInflateStream();
+        if (m_pZStream == NULL)
           Panic("inflateInit2 failed");
       }
       break;
@@ -103,7 +506,7 @@ public:
     {
       case Z_DEFLATED:
       {
-        inflateEnd(&m_zStream);
+        s_zStreamPool.ReleaseInflateStream(m_pZStream);
       }
       break;
     }
@@ -186,27 +589,27 @@ public:
         // deflate
       case Z_DEFLATED:
       {
-        m_zStream.avail_out = ByteCount;
-        m_zStream.next_out = (Bytef*)pDestination;
+        m_pZStream->avail_out = ByteCount;
+        m_pZStream->next_out = (Bytef*)pDestination;
 
-        while (m_zStream.avail_out > 0)
+        while (m_pZStream->avail_out > 0)
         {
-          if (m_zStream.avail_in == 0)
+          if (m_pZStream->avail_in == 0)
           {
             // if there is no input bytes, there can still be output bytes if they're repeating
             // this logic could probably be written a bit better though (maybe Z_BUF_ERROR)
             if (FillInputBuffer())
             {
-              m_zStream.avail_in = m_inBufferBytes;
-              m_zStream.next_in = (Bytef*)m_pInBuffer;
+              m_pZStream->avail_in = m_inBufferBytes;
+              m_pZStream->next_in = (Bytef*)m_pInBuffer;
             }
           }
 
           // save the buffer pointer
-          Bytef* pOldPointer = m_zStream.next_out;
+          Bytef* pOldPointer = m_pZStream->next_out;
 
           // inflate it
-          int err = inflate(&m_zStream, Z_SYNC_FLUSH);
+          int err = inflate(m_pZStream, Z_SYNC_FLUSH);
           if (err != Z_OK && err != Z_STREAM_END)
           {
             // some other error
@@ -216,8 +619,8 @@ public:
           }
 
           // update crc32
-          if (m_zStream.next_out != pOldPointer)
-            m_currentCRC32 = crc32(m_currentCRC32, pOldPointer, static_cast<uInt>(m_zStream.next_out - pOldPointer));
+          if (m_pZStream->next_out != pOldPointer)
+            m_currentCRC32 = crc32(m_currentCRC32, pOldPointer, static_cast<uInt>(m_pZStream->next_out - pOldPointer));
 
           // handle return
           if (err == Z_OK)
@@ -242,10 +645,10 @@ public:
           }
         }
 
-        uint32 bytesRead = (ByteCount - (uint32)m_zStream.avail_out);
+        uint32 bytesRead = (ByteCount - (uint32)m_pZStream->avail_out);
         m_currentDecompressedOffset += (uint64)bytesRead;
-        m_zStream.avail_out = 0;
-        m_zStream.next_out = NULL;
+        m_pZStream->avail_out = 0;
+        m_pZStream->next_out = NULL;
         return bytesRead;
       }
       break;
@@ -348,19 +751,27 @@ private:
   uint64 m_currentDecompressedOffset;
   uint32 m_currentCRC32;
 
-  z_stream m_zStream;
+  z_stream* m_pZStream;
 };
 
 class ZipArchiveBufferedReadByteStream : public ByteStream
 {
 public:
   ZipArchiveBufferedReadByteStream(ZipArchive* pZipArchive)
-    : m_pZipArchive(pZipArchive), m_pData(NULL), m_position(0), m_size(0)
+    : m_pZipArchive(pZipArchive), m_pData(NULL), m_pDataOwner(NULL), m_position(0), m_size(0)
   {
     m_pZipArchive->m_nOpenBufferedReads++;
   }
 
-  ~ZipArchiveBufferedReadByteStream() { m_pZipArchive->m_nOpenBufferedReads--; }
+  ~ZipArchiveBufferedReadByteStream()
+  {
+    if (m_pDataOwner != NULL)
+      m_pDataOwner->Release();
+    else
+      delete[] m_pData;
+
+    m_pZipArchive->m_nOpenBufferedReads--;
+  }
 
   bool FillBuffer(ByteStream* pArchiveStream, uint64 baseOffset, ZIP_ARCHIVE_LOCAL_FILE_HEADER* pLocalFileHeader)
   {
@@ -372,13 +783,39 @@ public:
       return false;
 
     m_size = (uint32)pLocalFileHeader->DecompressedSize;
-    m_pData = new byte[m_size];
+
+    // archives in memory are read in place, stored files aren't copied at all
+    const byte* pArchiveMemory = pArchiveStream->GetBasePointer();
+    uint64 archivePosition = pArchiveStream->GetPosition();
+    uint64 dataSize = (pLocalFileHeader->CompressionMethod == 0) ? m_size : pLocalFileHeader->CompressedSize;
+    if (pArchiveMemory != NULL)
+    {
+      // leave the archive stream where reading would have
+      if (!pArchiveStream->SeekRelative((int64)dataSize))
+      {
+        m_errorState = true;
+        return false;
+      }
+    }
+
+    byte* pBuffer = NULL;
+    if (pArchiveMemory != NULL && pLocalFileHeader->CompressionMethod == 0)
+    {
+      m_pData = pArchiveMemory + archivePosition;
+      m_pDataOwner = pArchiveStream;
+      m_pDataOwner->AddRef();
+    }
+    else
+    {
+      pBuffer = new byte[m_size];
+      m_pData = pBuffer;
+    }
 
     switch (pLocalFileHeader->CompressionMethod)
     {
       case 0:
       {
-        if (pArchiveStream->Read(m_pData, m_size) != m_size)
+        if (pBuffer != NULL && pArchiveStream->Read(pBuffer, m_size) != m_size)
         {
           decompressError = true;
           m_errorState = true;
@@ -390,17 +827,25 @@ public:
 
       case Z_DEFLATED:
       {
-        z_stream zStream;
-        Y_memzero(&zStream, sizeof(zStream));
-        if (inflateInit2(&zStream, -MAX_WBITS) != Z_OK)
+        z_stream* pZStream = s_zStreamPool.AcquireInflateStream();
+        if (pZStream == NULL)
           Panic("inflateInit2 failed");
 
+        z_stream& zStream = *pZStream;
         zStream.next_in = NULL;
         zStream.avail_in = 0;
-        zStream.next_out = (Bytef*)m_pData;
+        zStream.next_out = (Bytef*)pBuffer;
         zStream.avail_out = m_size;
 
         uint32 remainingInputBytes = (uint32)pLocalFileHeader->CompressedSize;
+        if (pArchiveMemory != NULL)
+        {
+          // the whole input is already there
+          zStream.next_in = (Bytef*)(pArchiveMemory + archivePosition);
+          zStream.avail_in = remainingInputBytes;
+          remainingInputBytes = 0;
+        }
+
         while (zStream.avail_out > 0)
         {
           // in buffer exhausted?
@@ -450,7 +895,40 @@ public:
           }
         }
 
-        inflateEnd(&zStream);
+        s_zStreamPool.ReleaseInflateStream(pZStream);
+      }
+      break;
+
+      case ZIP_COMPRESSION_METHOD_ZSTD:
+      {
+        // the frame is decompressed at once, so it has to be read in whole first
+        uint32 compressedSize = (uint32)Min(pLocalFileHeader->CompressedSize, (uint64)0xFFFFFFFF);
+        const byte* pCompressedData = (pArchiveMemory != NULL) ? (pArchiveMemory + archivePosition) : NULL;
+        PODArray<byte> compressedData;
+        if (pCompressedData == NULL)
+        {
+          compressedData.Resize(compressedSize);
+          if (pArchiveStream->Read(compressedData.GetBasePointer(), compressedSize) != compressedSize)
+          {
+            decompressError = true;
+            m_errorState = true;
+            break;
+          }
+
+          pCompressedData = compressedData.GetBasePointer();
+        }
+
+        uint32 decompressedSize;
+        if (!Compression::DecompressBuffer(COMPRESSION_CODEC_ZSTD, pBuffer, m_size, &decompressedSize,
+                                           pCompressedData, compressedSize) ||
+            decompressedSize != m_size)
+        {
+          decompressError = true;
+          m_errorState = true;
+          break;
+        }
+
+        currentCRC32 = crc32(0, (const Bytef*)m_pData, m_size);
       }
       break;
 
@@ -471,6 +949,16 @@ public:
     return !decompressError;
   }
 
+  // takes data OpenFiles has already decoded, owning the buffer unless the archive stream it's in is given
+  void SetData(const byte* pData, uint32 size, ByteStream* pDataOwner)
+  {
+    m_pData = pData;
+    m_size = size;
+    m_pDataOwner = pDataOwner;
+    if (m_pDataOwner != NULL)
+      m_pDataOwner->AddRef();
+  }
+
   virtual uint32 Read(void* pDestination, uint32 ByteCount)
   {
     uint32 sz = ByteCount;
@@ -555,6 +1043,8 @@ public:
 
   virtual uint64 GetSize() const { return (uint64)m_size; }
 
+  virtual const byte* GetBasePointer() const { return m_pData; }
+
   virtual bool Flush() { return false; }
 
   virtual bool Discard() { return false; }
@@ -564,7 +1054,9 @@ public:
 private:
   ZipArchive* m_pZipArchive;
 
-  byte* m_pData;
+  // either our own buffer, or the memory of the archive stream when it is held in m_pDataOwner
+  const byte* m_pData;
+  ByteStream* m_pDataOwner;
   uint32 m_position;
   uint32 m_size;
 };
@@ -574,23 +1066,28 @@ class ZipArchiveStreamedWriteByteStream : public ByteStream
 public:
   ZipArchiveStreamedWriteByteStream(ZipArchive* pZipArchive, ByteStream* pArchiveStream,
                                     ZipArchive::FileEntry* pFileEntry, uint64 baseOffset, uint32 compressionMethod,
-                                    uint32 compressionLevel)
+                                    uint32 compressionLevel, ThreadPool* pThreadPool)
     : m_pZipArchive(pZipArchive), m_pArchiveStream(pArchiveStream), m_pFileEntry(pFileEntry), m_baseOffset(baseOffset),
       m_currentFileOffset(baseOffset), m_currentCompressedSize(0), m_currentDecompressedSize(0), m_outBufferBytes(0),
-      m_currentCRC32(0), m_compressionMethod(compressionMethod)
+      m_currentCRC32(0), m_compressionMethod(compressionMethod), m_compressionLevel(compressionLevel),
+      m_pThreadPool((compressionMethod == Z_DEFLATED) ? pThreadPool : NULL), m_parallelHistorySize(0)
   {
-    Y_memzero(&m_zStream, sizeof(m_zStream));
+    m_pZStream = NULL;
 
     switch (compressionMethod)
     {
       case Z_DEFLATED:
       {
-        int err = deflateInit2(&m_zStream, compressionLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
-        if (err != Z_OK)
+        // parallel writes deflate each batch of blocks separately
+        if (m_pThreadPool != NULL)
+          break;
+
+        m_pZStream = s_zStreamPool.AcquireDeflateStream(compressionLevel);
+        if (m_pZStream == NULL)
           Panic("deflateInit2 failed");
 
-        m_zStream.avail_out = sizeof(m_pOutBuffer);
-        m_zStream.next_out = (Bytef*)m_pOutBuffer;
+        m_pZStream->avail_out = sizeof(m_pOutBuffer);
+        m_pZStream->next_out = (Bytef*)m_pOutBuffer;
       }
       break;
     }
@@ -610,7 +1107,8 @@ public:
     {
       case Z_DEFLATED:
       {
-        deflateEnd(&m_zStream);
+        if (m_pThreadPool == NULL)
+          s_zStreamPool.ReleaseDeflateStream(m_pZStream, m_compressionLevel);
       }
       break;
     }
@@ -642,7 +1140,7 @@ public:
         !binaryWriter.SafeWriteUInt32(0) ||                                         // CompressedSize
         !binaryWriter.SafeWriteUInt32(0) ||                                         // DecompressedSize
         !binaryWriter.SafeWriteUInt16((uint16)filenameLength) ||                    // FilenameLength
-        !binaryWriter.SafeWriteUInt16(0) ||                                         // ExtraFieldLength
+        !binaryWriter.SafeWriteUInt16(20) ||                                        // ExtraFieldLength
         !binaryWriter.SafeWriteFixedString(m_pFileEntry->FileName, filenameLength)) // Filename
     {
 
@@ -650,6 +1148,14 @@ public:
       return false;
     }
 
+    // the size isn't known yet, so there's always room for ZIP64 sizes
+    if (!binaryWriter.SafeWriteUInt16(ZIP_ARCHIVE_ZIP64_EXTRA_FIELD_ID) || !binaryWriter.SafeWriteUInt16(16) ||
+        !binaryWriter.SafeWriteUInt64(0) || !binaryWriter.SafeWriteUInt64(0))
+    {
+      SetErrorState();
+      return false;
+    }
+
     m_currentFileOffset = m_pArchiveStream->GetPosition();
     return true;
   }
@@ -661,21 +1167,54 @@ public:
 
     if (m_outBufferBytes > 0)
     {
-      if (!m_pArchiveStream->SeekAbsolute(m_currentFileOffset) ||
-          m_pArchiveStream->Write(m_pOutBuffer, m_outBufferBytes) != m_outBufferBytes)
-      {
-        SetErrorState();
+      if (!WriteCompressedData(m_pOutBuffer, m_outBufferBytes))
         return false;
-      }
 
-      m_currentCompressedSize += (uint64)m_outBufferBytes;
-      m_currentFileOffset += (uint64)m_outBufferBytes;
       m_outBufferBytes = 0;
 
-      m_zStream.avail_out = sizeof(m_pOutBuffer);
-      m_zStream.next_out = (Bytef*)m_pOutBuffer;
+      // stored and parallel writes fill the buffer themselves
+      if (m_pZStream != NULL)
+      {
+        m_pZStream->avail_out = sizeof(m_pOutBuffer);
+        m_pZStream->next_out = (Bytef*)m_pOutBuffer;
+      }
+    }
+
+    return true;
+  }
+
+  bool WriteCompressedData(const void* pData, uint32 size)
+  {
+    if (!m_pArchiveStream->SeekAbsolute(m_currentFileOffset) || m_pArchiveStream->Write(pData, size) != size)
+    {
+      SetErrorState();
+      return false;
+    }
+
+    m_currentCompressedSize += (uint64)size;
+    m_currentFileOffset += (uint64)size;
+    return true;
+  }
+
+  // deflates the input written since the last batch, keeping the window the next batch is primed with
+  bool DeflateParallelInput(bool finish)
+  {
+    PODArray<byte> output;
+    if (!DeflateBlocks(m_parallelInput.GetBasePointer() + m_parallelHistorySize,
+                       m_parallelInput.GetSize() - m_parallelHistorySize, m_parallelHistorySize, finish,
+                       m_compressionLevel, m_pThreadPool, &output))
+    {
+      Log_ErrorPrintf("ZipArchiveStreamedWriteByteStream::DeflateParallelInput: Deflating '%s' failed",
+                      m_pFileEntry->FileName.GetCharArray());
+      SetErrorState();
+      return false;
     }
 
+    if (!WriteCompressedData(output.GetBasePointer(), output.GetSize()))
+      return false;
+
+    m_parallelHistorySize = Min(m_parallelInput.GetSize(), ZIP_DEFLATE_WINDOW_SIZE);
+    m_parallelInput.RemoveRange(0, m_parallelInput.GetSize() - m_parallelHistorySize);
     return true;
   }
 
@@ -685,12 +1224,24 @@ public:
     {
       case Z_DEFLATED:
       {
-        DebugAssert(m_zStream.avail_in == 0);
+        if (m_pThreadPool != NULL)
+        {
+          if (!DeflateParallelInput(true))
+            return false;
+
+          break;
+        }
+
+        DebugAssert(m_pZStream->avail_in == 0);
 
         for (;;)
         {
-          int err = deflate(&m_zStream, Z_FINISH);
-          m_outBufferBytes = sizeof(m_pOutBuffer) - m_zStream.avail_out;
+          // the last write can leave the buffer full, and deflate can't finish without room
+          if (m_pZStream->avail_out == 0 && !FlushOutputBuffer())
+            return false;
+
+          int err = deflate(m_pZStream, Z_FINISH);
+          m_outBufferBytes = sizeof(m_pOutBuffer) - m_pZStream->avail_out;
 
           if (err == Z_OK)
           {
@@ -731,16 +1282,26 @@ public:
     // get the timestamp
     Timestamp modifiedTimestamp(Timestamp::Now());
 
-    // rewrite the local header
+    // rewrite the local header, sizes that don't fit are saturated and only in the ZIP64 field
+    bool zip64 =
+      (m_currentCompressedSize >= ZIP_ARCHIVE_ZIP64_LIMIT || m_currentDecompressedSize >= ZIP_ARCHIVE_ZIP64_LIMIT);
+    uint32 versionRequiredToExtract = zip64 ? ZIP_ARCHIVE_VERSION_TO_EXTRACT_ZIP64 : ZIP_ARCHIVE_VERSION_TO_EXTRACT;
+    uint32 compressedSize32 = (uint32)Min(m_currentCompressedSize, ZIP_ARCHIVE_ZIP64_LIMIT);
+    uint32 decompressedSize32 = (uint32)Min(m_currentDecompressedSize, ZIP_ARCHIVE_ZIP64_LIMIT);
+    uint32 filenameLength = Min(m_pFileEntry->FileName.GetLength(), (uint32)0xFFFF);
+
     BinaryWriter binaryWriter(m_pArchiveStream, ENDIAN_TYPE_LITTLE);
     if (!binaryWriter.SafeWriteUInt32(ZIP_ARCHIVE_LOCAL_FILE_HEADER_SIGNTURE) || // Signature
-        !binaryWriter.SafeWriteUInt16(ZIP_ARCHIVE_VERSION_TO_EXTRACT) ||         // VersionRequiredToExtract
+        !binaryWriter.SafeWriteUInt16((uint16)versionRequiredToExtract) ||       // VersionRequiredToExtract
         !binaryWriter.SafeWriteUInt16(0) ||                                      // Flags
         !binaryWriter.SafeWriteUInt16((uint16)m_compressionMethod) ||            // CompressionMethod
         !binaryWriter.SafeWriteUInt32(TimestampToZipTime(Timestamp::Now())) ||   // ModificationTimestamp
         !binaryWriter.SafeWriteUInt32(m_currentCRC32) ||                         // CRC32
-        !binaryWriter.SafeWriteUInt32((uint32)m_currentCompressedSize) ||        // CompressedSize
-        !binaryWriter.SafeWriteUInt32((uint32)m_currentDecompressedSize))        // DecompressedSize
+        !binaryWriter.SafeWriteUInt32(compressedSize32) ||                       // CompressedSize
+        !binaryWriter.SafeWriteUInt32(decompressedSize32) ||                     // DecompressedSize
+        !m_pArchiveStream->SeekRelative(4 + filenameLength + 4) ||               // Lengths, Filename, ZIP64 ID
+        !binaryWriter.SafeWriteUInt64(m_currentDecompressedSize) ||              // ZIP64 DecompressedSize
+        !binaryWriter.SafeWriteUInt64(m_currentCompressedSize))                  // ZIP64 CompressedSize
     {
       SetErrorState();
       return false;
@@ -770,7 +1331,7 @@ public:
       case 0:
       {
         const byte* pCurrentPtr = reinterpret_cast<const byte*>(pSource);
-        uint32 remaining = 0;
+        uint32 remaining = ByteCount;
 
         while (remaining > 0)
         {
@@ -780,6 +1341,7 @@ public:
           uint32 copyLength = Min(remaining, uint32(sizeof(m_pOutBuffer) - m_outBufferBytes));
           std::memcpy(m_pOutBuffer + m_outBufferBytes, pCurrentPtr, copyLength);
           m_currentCRC32 = crc32(m_currentCRC32, pCurrentPtr, copyLength);
+          m_outBufferBytes += copyLength;
           pCurrentPtr += copyLength;
           remaining -= copyLength;
         }
@@ -792,14 +1354,29 @@ public:
 
       case Z_DEFLATED:
       {
+        // parallel writes collect a batch of blocks before deflating
+        if (m_pThreadPool != NULL)
+        {
+          m_currentCRC32 = crc32(m_currentCRC32, (const Bytef*)pSource, ByteCount);
+          m_parallelInput.AddRange(reinterpret_cast<const byte*>(pSource), ByteCount);
+          m_currentDecompressedSize += (uint64)ByteCount;
+          if ((m_parallelInput.GetSize() - m_parallelHistorySize) >= ZIP_PARALLEL_DEFLATE_BATCH_SIZE &&
+              !DeflateParallelInput(false))
+          {
+            return 0;
+          }
+
+          return ByteCount;
+        }
+
         // set up pointers
-        m_zStream.avail_in = ByteCount;
-        m_zStream.next_in = (Bytef*)pSource;
+        m_pZStream->avail_in = ByteCount;
+        m_pZStream->next_in = (Bytef*)pSource;
 
         // loop
-        while (m_zStream.avail_in > 0)
+        while (m_pZStream->avail_in > 0)
         {
-          if (m_zStream.avail_out == 0)
+          if (m_pZStream->avail_out == 0)
           {
             if (!FlushOutputBuffer())
             {
@@ -807,17 +1384,17 @@ public:
               break;
             }
 
-            m_zStream.avail_out = sizeof(m_pOutBuffer);
-            m_zStream.next_out = (Bytef*)m_pOutBuffer;
+            m_pZStream->avail_out = sizeof(m_pOutBuffer);
+            m_pZStream->next_out = (Bytef*)m_pOutBuffer;
           }
 
-          const Bytef* pOldPointer = m_zStream.next_in;
-          int err = deflate(&m_zStream, Z_NO_FLUSH);
-          m_outBufferBytes = sizeof(m_pOutBuffer) - m_zStream.avail_out;
+          const Bytef* pOldPointer = m_pZStream->next_in;
+          int err = deflate(m_pZStream, Z_NO_FLUSH);
+          m_outBufferBytes = sizeof(m_pOutBuffer) - m_pZStream->avail_out;
 
           // update crc
-          if (m_zStream.next_in != pOldPointer)
-            m_currentCRC32 = crc32(m_currentCRC32, pOldPointer, static_cast<uInt>(m_zStream.next_in - pOldPointer));
+          if (m_pZStream->next_in != pOldPointer)
+            m_currentCRC32 = crc32(m_currentCRC32, pOldPointer, static_cast<uInt>(m_pZStream->next_in - pOldPointer));
 
           // test return
           if (err == Z_OK)
@@ -835,9 +1412,9 @@ public:
           }
         }
 
-        uint32 bytesWritten = ByteCount - (m_zStream.avail_in);
-        m_zStream.avail_in = 0;
-        m_zStream.next_in = NULL;
+        uint32 bytesWritten = ByteCount - (m_pZStream->avail_in);
+        m_pZStream->avail_in = 0;
+        m_pZStream->next_in = NULL;
         m_currentDecompressedSize += (uint64)bytesWritten;
         return bytesWritten;
       }
@@ -902,8 +1479,14 @@ private:
   uint32 m_outBufferBytes;
   uint32 m_currentCRC32;
   uint32 m_compressionMethod;
+  uint32 m_compressionLevel;
 
-  z_stream m_zStream;
+  z_stream* m_pZStream;
+
+  // with a pool, input is collected here after the window from the previous batch
+  ThreadPool* m_pThreadPool;
+  PODArray<byte> m_parallelInput;
+  uint32 m_parallelHistorySize;
 };
 
 class ZipArchiveBufferedWriteByteStream : public ByteStream
@@ -949,161 +1532,35 @@ public:
   {
     Assert(m_pArchive->m_nOpenStreamedWrites == 0);
 
-    // setup zlib
-    z_stream zStream;
-    if (m_compressionMethod == Z_DEFLATED)
+    // the whole file is here, so it's compressed in one go
+    uint32 crc;
+    PODArray<byte> compressedData;
+    const byte* pData = m_pMemory;
+    uint32 dataSize = m_size;
+    if (m_compressionMethod != 0)
     {
-      Y_memzero(&zStream, sizeof(zStream));
-      int err = deflateInit2(&zStream, m_compressionLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
-      if (err != Z_OK)
+      if (!CompressWholeFile(m_compressionMethod, m_compressionLevel, m_pMemory, m_size,
+                             m_pArchive->m_pCompressionThreadPool, &compressedData, &crc))
+      {
+        Log_ErrorPrintf("ZipArchiveBufferedWriteByteStream::Finalize: Compressing '%s' failed",
+                        m_pFileEntry->FileName.GetCharArray());
         return false;
-    }
+      }
 
-    // seek to the header
-    if (!m_pWriteStream->SeekToEnd())
+      pData = compressedData.GetBasePointer();
+      dataSize = compressedData.GetSize();
+    }
+    else
     {
-      SetErrorState();
-      return false;
+      crc = crc32(0, (const Bytef*)m_pMemory, m_size);
     }
 
-    // get the timestamp
-    BinaryWriter binaryWriter(m_pWriteStream, ENDIAN_TYPE_LITTLE);
-    Timestamp modifiedTimestamp(Timestamp::Now());
-    uint64 offsetToLocalFileHeader = m_pWriteStream->GetPosition();
-    uint32 filenameLength = Min(m_pFileEntry->FileName.GetLength(), (uint32)0xFFFF);
-    if (!binaryWriter.SafeWriteUInt32(~ZIP_ARCHIVE_LOCAL_FILE_HEADER_SIGNTURE) ||   // Signature
-        !binaryWriter.SafeWriteUInt16(ZIP_ARCHIVE_VERSION_TO_EXTRACT) ||            // VersionRequiredToExtract
-        !binaryWriter.SafeWriteUInt16(0) ||                                         // Flags
-        !binaryWriter.SafeWriteUInt16((uint16)m_compressionMethod) ||               // CompressionMethod
-        !binaryWriter.SafeWriteUInt32(0) ||                                         // ModificationTimestamp
-        !binaryWriter.SafeWriteUInt32(0) ||                                         // CRC32
-        !binaryWriter.SafeWriteUInt32(0) ||                                         // CompressedSize
-        !binaryWriter.SafeWriteUInt32(0) ||                                         // DecompressedSize
-        !binaryWriter.SafeWriteUInt16((uint16)filenameLength) ||                    // FilenameLength
-        !binaryWriter.SafeWriteUInt16(0) ||                                         // ExtraFieldLength
-        !binaryWriter.SafeWriteFixedString(m_pFileEntry->FileName, filenameLength)) // Filename
+    if (!m_pArchive->WriteFileData(m_pFileEntry, m_compressionMethod, crc, pData, dataSize, m_size))
     {
       SetErrorState();
       return false;
     }
 
-    uint32 crc = 0;
-    uint32 compressedFileSize = 0;
-    uint32 decompressedFileSize = 0;
-    if (m_size > 0)
-    {
-      // calculate crc32
-      crc = crc32(0, (const Bytef*)m_pMemory, m_size);
-
-      // compress?
-      if (m_compressionMethod == Z_DEFLATED)
-      {
-        byte compressionBuffer[ZIP_BUFFERED_IO_CHUNK_SIZE];
-        zStream.avail_in = m_size;
-        zStream.next_in = (Bytef*)m_pMemory;
-        zStream.avail_out = sizeof(compressionBuffer);
-        zStream.next_out = (Bytef*)compressionBuffer;
-
-        while (zStream.avail_in > 0)
-        {
-          if (zStream.avail_out == 0)
-          {
-            binaryWriter.WriteBytes(compressionBuffer, sizeof(compressionBuffer));
-            zStream.avail_out = sizeof(compressionBuffer);
-            zStream.next_out = (Bytef*)compressionBuffer;
-          }
-
-          int err = deflate(&zStream, Z_NO_FLUSH);
-          if (err == Z_OK)
-          {
-            // ok, more data to go
-            continue;
-          }
-          else
-          {
-            // error of some sort
-            deflateEnd(&zStream);
-            return false;
-          }
-        }
-
-        // complete compression
-        for (;;)
-        {
-          if (zStream.avail_out == 0)
-          {
-            binaryWriter.WriteBytes(compressionBuffer, sizeof(compressionBuffer));
-            zStream.avail_out = sizeof(compressionBuffer);
-            zStream.next_out = (Bytef*)compressionBuffer;
-          }
-
-          int err = deflate(&zStream, Z_FINISH);
-          if (err == Z_STREAM_END)
-          {
-            // complete
-            break;
-          }
-          else if (err == Z_OK)
-          {
-            // more data to go
-            continue;
-          }
-          else
-          {
-            // error of some sort
-            deflateEnd(&zStream);
-            return false;
-          }
-        }
-
-        // write any remaining bytes
-        if (zStream.avail_out != sizeof(compressionBuffer))
-          binaryWriter.WriteBytes(compressionBuffer, sizeof(compressionBuffer) - zStream.avail_out);
-
-        // fill fields
-        compressedFileSize = zStream.total_out;
-        decompressedFileSize = zStream.total_in;
-      }
-      else
-      {
-        // write data out as-is
-        binaryWriter.WriteBytes(m_pMemory, m_size);
-
-        // fill fields
-        compressedFileSize = m_size;
-        decompressedFileSize = m_size;
-      }
-    }
-
-    // seek back to local header position
-    if (!m_pWriteStream->SeekAbsolute(offsetToLocalFileHeader))
-    {
-      SetErrorState();
-      return false;
-    }
-
-    // write the local header
-    if (!binaryWriter.SafeWriteUInt32(ZIP_ARCHIVE_LOCAL_FILE_HEADER_SIGNTURE) || // Signature
-        !binaryWriter.SafeWriteUInt16(ZIP_ARCHIVE_VERSION_TO_EXTRACT) ||         // VersionRequiredToExtract
-        !binaryWriter.SafeWriteUInt16(0) ||                                      // Flags
-        !binaryWriter.SafeWriteUInt16((uint16)m_compressionMethod) ||            // CompressionMethod
-        !binaryWriter.SafeWriteUInt32(TimestampToZipTime(Timestamp::Now())) ||   // ModificationTimestamp
-        !binaryWriter.SafeWriteUInt32(crc) ||                                    // CRC32
-        !binaryWriter.SafeWriteUInt32(compressedFileSize) ||                     // CompressedSize
-        !binaryWriter.SafeWriteUInt32(decompressedFileSize))                     // DecompressedSize
-    {
-      SetErrorState();
-      return false;
-    }
-
-    // update the file entry
-    m_pFileEntry->CompressionMethod = m_compressionMethod;
-    m_pFileEntry->ModifiedTime = modifiedTimestamp;
-    m_pFileEntry->CRC32 = crc;
-    m_pFileEntry->OffsetToFileHeader = offsetToLocalFileHeader;
-    m_pFileEntry->CompressedFileSize = compressedFileSize;
-    m_pFileEntry->DecompressedFileSize = decompressedFileSize;
-    m_pFileEntry->IsDeleted = false;
     return true;
   }
 
@@ -1236,417 +1693,1538 @@ private:
   uint32 m_memorySize;
 };
 
-ZipArchive::ZipArchive(ByteStream* pReadStream, ByteStream* pWriteStream)
-  : m_pReadStream(pReadStream), m_pWriteStream(pWriteStream), m_nOpenStreamedReads(0), m_nOpenStreamedWrites(0),
-    m_nOpenBufferedReads(0), m_nOpenBufferedWrites(0)
+// FNV-1a over the name with ASCII letters lower-cased, as Y_stricmp compares them. Saved indexes hold these, so
+// this can't change without changing ZIP_ARCHIVE_INDEX_VERSION.
+static uint32 HashIndexName(const char* name, uint32 length)
 {
-  if (pReadStream != NULL)
-    pReadStream->AddRef();
-  if (pWriteStream != NULL)
-    pWriteStream->AddRef();
+  uint32 hash = 2166136261u;
+  for (uint32 i = 0; i < length; i++)
+  {
+    char ch = name[i];
+    if (ch >= 'A' && ch <= 'Z')
+      ch = ch - 'A' + 'a';
+
+    hash = (hash ^ (uint32)(byte)ch) * 16777619u;
+  }
+
+  return hash;
 }
 
-ZipArchive::~ZipArchive()
+ZipArchive::ReadIndex::ReadIndex()
+  : m_pEntries(NULL), m_pSlots(NULL), m_pNames(NULL), m_entryCount(0), m_slotCount(0), m_namesSize(0),
+    m_pStream(NULL)
 {
-  if (m_pReadStream != NULL)
-    m_pReadStream->Release();
-  if (m_pWriteStream != NULL)
-    m_pWriteStream->Release();
 }
 
-bool ZipArchive::StatFile(const char* filename, FILESYSTEM_STAT_DATA* pStatData) const
+ZipArchive::ReadIndex::~ReadIndex()
 {
-  const FileHashTable::Member* pMember;
-  if (((pMember = m_writeFileHashTable.Find(filename)) != NULL && !pMember->Value->IsDeleted) ||
-      ((pMember = m_readFileHashTable.Find(filename)) != NULL && !pMember->Value->IsDeleted))
-  {
-    const FileEntry* pFileEntry = pMember->Value;
-
-    // attributes
-    pStatData->Attributes = 0;
-    {
-      // compressed
-      if (pFileEntry->CompressionMethod != 0)
-        pStatData->Attributes |= FILESYSTEM_FILE_ATTRIBUTE_COMPRESSED;
-    }
-
-    // modification time
-    pStatData->ModificationTime = pFileEntry->ModifiedTime;
+  Clear();
+}
 
-    // size (uncompressed)
-    pStatData->Size = pFileEntry->DecompressedFileSize;
+void ZipArchive::ReadIndex::Clear()
+{
+  m_pEntries = NULL;
+  m_pSlots = NULL;
+  m_pNames = NULL;
+  m_entryCount = 0;
+  m_slotCount = 0;
+  m_namesSize = 0;
+  m_entries.Obliterate();
+  m_slots.Obliterate();
+  m_names.Obliterate();
+  m_data.Obliterate();
+  m_deletedEntries.Obliterate();
+  m_nameFilter.Clear();
+
+  if (m_pStream != NULL)
+  {
+    m_pStream->Release();
+    m_pStream = NULL;
+  }
+}
 
-    // ok
-    return true;
+void ZipArchive::ReadIndex::DeleteEntry(uint32 index)
+{
+  DebugAssert(index < m_entryCount);
+  if (m_deletedEntries.IsEmpty())
+  {
+    m_deletedEntries.Resize(m_entryCount);
+    Y_memzero(m_deletedEntries.GetBasePointer(), sizeof(bool) * m_entryCount);
   }
 
-  return false;
+  m_deletedEntries[index] = true;
 }
 
-ByteStream* ZipArchive::OpenFile(const char* filename, uint32 openMode, uint32 compressionLevel /* = 6 */)
+uint32 ZipArchive::ReadIndex::FindSlot(const char* fileName, uint32 nameLength, uint32 hash) const
 {
-  // zip archives do not support reading and writing at the same time
-  if ((openMode & (BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_WRITE)) == (BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_WRITE))
-    return NULL;
-
-  // reading?
-  if (openMode & BYTESTREAM_OPEN_READ)
+  // the slot holding the name, or the empty one it would go in, there's always one empty
+  uint32 slotMask = m_slotCount - 1;
+  for (uint32 slot = hash & slotMask;; slot = (slot + 1) & slotMask)
   {
-    const FileHashTable::Member* pMember;
-    ByteStream* pStreamToReadFrom = NULL;
-    if ((pMember = m_writeFileHashTable.Find(filename)) != NULL && !pMember->Value->IsDeleted)
-    {
-      // file already open for reading?
-      if (pMember->Value->WriteOpenCount > 0)
-        return NULL;
+    uint32 entryNumber = m_pSlots[slot];
+    if (entryNumber == 0)
+      return slot;
 
-      pStreamToReadFrom = m_pWriteStream;
-    }
-    else if ((pMember = m_readFileHashTable.Find(filename)) != NULL && !pMember->Value->IsDeleted)
+    const Entry& entry = m_pEntries[entryNumber - 1];
+    if (entry.NameHash == hash &&
+        Y_stricmp(m_pNames + entry.NameOffset, entry.NameLength, fileName, nameLength) == 0)
     {
-      pStreamToReadFrom = m_pReadStream;
+      return slot;
     }
-    else
-      return NULL;
+  }
+}
 
-    // read the local file header
-    const FileEntry* pFileEntry = pMember->Value;
-    BinaryReader binaryReader(pStreamToReadFrom, ENDIAN_TYPE_LITTLE);
-    if (!pStreamToReadFrom->SeekAbsolute(pFileEntry->OffsetToFileHeader))
-      return NULL;
+uint32 ZipArchive::ReadIndex::Find(const char* fileName) const
+{
+  if (m_entryCount == 0)
+    return InvalidEntry;
 
-    ZIP_ARCHIVE_LOCAL_FILE_HEADER localFileHeader;
-    uint32 compressedSize32;
-    uint32 decompressedSize32;
-    if (!binaryReader.SafeReadUInt32(&localFileHeader.Signature) ||
-        !binaryReader.SafeReadUInt16(&localFileHeader.VersionRequiredToExtract) ||
-        !binaryReader.SafeReadUInt16(&localFileHeader.Flags) ||
-        !binaryReader.SafeReadUInt16(&localFileHeader.CompressionMethod) ||
-        !binaryReader.SafeReadUInt32(&localFileHeader.ModificationTimestamp) ||
-        !binaryReader.SafeReadUInt32(&localFileHeader.CRC32) || !binaryReader.SafeReadUInt32(&compressedSize32) ||
-        !binaryReader.SafeReadUInt32(&decompressedSize32) ||
-        !binaryReader.SafeReadUInt16(&localFileHeader.FilenameLength) ||
-        !binaryReader.SafeReadUInt16(&localFileHeader.ExtraFieldLength))
-    {
-      return NULL;
-    }
+  uint32 nameLength = Y_strlen(fileName);
+  uint32 hash = HashIndexName(fileName, nameLength);
+  if (!m_nameFilter.MayContain(hash))
+    return InvalidEntry;
 
-    localFileHeader.CompressedSize = (uint64)compressedSize32;
-    localFileHeader.DecompressedSize = (uint64)decompressedSize32;
+  uint32 entryNumber = m_pSlots[FindSlot(fileName, nameLength, hash)];
+  return (entryNumber != 0) ? (entryNumber - 1) : InvalidEntry;
+}
 
-    if (localFileHeader.Signature != ZIP_ARCHIVE_LOCAL_FILE_HEADER_SIGNTURE)
-      return NULL;
+void ZipArchive::ReadIndex::BeginBuild(uint32 maxEntryCount, uint32 maxNamesSize)
+{
+  Clear();
+
+  // at most half full
+  uint32 slotCount = 16;
+  while (slotCount < (maxEntryCount * 2))
+    slotCount *= 2;
+
+  m_entries.Reserve(maxEntryCount);
+  m_names.Reserve(maxNamesSize + maxEntryCount);
+  m_slots.Resize(slotCount);
+  Y_memzero(m_slots.GetBasePointer(), sizeof(uint32) * slotCount);
+  m_pSlots = m_slots.GetBasePointer();
+  m_slotCount = slotCount;
+  m_nameFilter.Reset(maxEntryCount);
+}
 
-    // only handling deflate at the moment
-    if (localFileHeader.CompressionMethod != 0 && localFileHeader.CompressionMethod != Z_DEFLATED)
-      return NULL;
+bool ZipArchive::ReadIndex::AddEntry(const char* fileName, uint32 nameLength, const FileLocation& location,
+                                     uint32 modifiedTime)
+{
+  DebugAssert(m_pStream == NULL && m_data.IsEmpty());
+  if (((m_entryCount + 1) * 2) > m_slotCount)
+  {
+    Log_ErrorPrintf("ZipArchive::ReadIndex::AddEntry: More entries than the index was built for");
+    return false;
+  }
 
-    // ugh, streamed files. have to handle these carefully
-    // otherwise, should be accurate
-    if (localFileHeader.Flags & 8)
-    {
-      if (pFileEntry->CRC32 == 0)
-        return NULL;
+  uint32 hash = HashIndexName(fileName, nameLength);
+  uint32 slot = FindSlot(fileName, nameLength, hash);
+  if (m_slots[slot] != 0)
+    return false;
 
-      // pull from central directory
-      localFileHeader.CRC32 = pFileEntry->CRC32;
-      localFileHeader.CompressedSize = pFileEntry->CompressedFileSize;
-      localFileHeader.DecompressedSize = pFileEntry->DecompressedFileSize;
-    }
-    else if (localFileHeader.CompressedSize != pFileEntry->CompressedFileSize ||
-             localFileHeader.DecompressedSize != pFileEntry->DecompressedFileSize)
-    {
-      return NULL;
-    }
+  Entry entry;
+  entry.Location = location;
+  entry.NameOffset = m_names.GetSize();
+  entry.NameLength = nameLength;
+  entry.NameHash = hash;
+  entry.ModifiedTime = modifiedTime;
+  m_entries.Add(entry);
+  m_names.AddRange(fileName, nameLength);
+  m_names.Add('\0');
+  m_slots[slot] = m_entries.GetSize();
+  m_nameFilter.Add(hash);
+
+  m_pEntries = m_entries.GetBasePointer();
+  m_pNames = m_names.GetBasePointer();
+  m_entryCount = m_entries.GetSize();
+  m_namesSize = m_names.GetSize();
+  return true;
+}
 
-    uint32 seekDistance = (uint32)localFileHeader.FilenameLength + (uint32)localFileHeader.ExtraFieldLength;
-    if (!pStreamToReadFrom->SeekRelative(seekDistance))
-      return NULL;
+bool ZipArchive::ReadIndex::Save(ByteStream* pStream, const ZIP_ARCHIVE_INDEX_HEADER* pArchiveHeader) const
+{
+  ZIP_ARCHIVE_INDEX_HEADER header = *pArchiveHeader;
+  header.Signature = ZIP_ARCHIVE_INDEX_SIGNATURE;
+  header.Version = ZIP_ARCHIVE_INDEX_VERSION;
+  header.EntryCount = m_entryCount;
+  header.SlotCount = m_slotCount;
+  header.NamesSize = m_namesSize;
+  header.Reserved = 0;
+
+  return (pStream->Write2(&header, sizeof(header)) && pStream->Write2(m_pEntries, sizeof(Entry) * m_entryCount) &&
+          pStream->Write2(m_pSlots, sizeof(uint32) * m_slotCount) && pStream->Write2(m_pNames, m_namesSize));
+}
 
-    if (openMode & BYTESTREAM_OPEN_STREAMED || (openMode & BYTESTREAM_OPEN_SEEKABLE) == 0)
-    {
-      // create stream
-      ZipArchiveStreamedReadByteStream* pReaderStream = new ZipArchiveStreamedReadByteStream(
-        this, pStreamToReadFrom, pStreamToReadFrom->GetPosition(), &localFileHeader);
-      return pReaderStream;
-    }
-    else
-    {
-      // create buffered stream
-      ZipArchiveBufferedReadByteStream* pReaderStream = new ZipArchiveBufferedReadByteStream(this);
-      if (!pReaderStream->FillBuffer(pStreamToReadFrom, pStreamToReadFrom->GetPosition(), &localFileHeader))
-      {
-        pReaderStream->Release();
-        pReaderStream = NULL;
-      }
-      return pReaderStream;
-    }
-  }
-  else if (openMode & BYTESTREAM_OPEN_WRITE)
-  {
-    if (m_pWriteStream == NULL)
-      return NULL;
+bool ZipArchive::ReadIndex::Load(ByteStream* pStream, const ZIP_ARCHIVE_INDEX_HEADER* pArchiveHeader)
+{
+  Clear();
 
-    bool streamed = (openMode & BYTESTREAM_OPEN_STREAMED || (openMode & BYTESTREAM_OPEN_SEEKABLE) == 0);
-    if (streamed)
-    {
-      // can only have one streamed write open at once
-      if (m_nOpenBufferedWrites > 0 || m_nOpenStreamedWrites > 0)
-        return NULL;
+  uint64 position = pStream->GetPosition();
+  uint64 size = pStream->GetSize();
+  if (position > size || (size - position) < sizeof(ZIP_ARCHIVE_INDEX_HEADER) || (size - position) > 0x7FFFFFFF)
+    return false;
 
-      // seek to the end of the write stream
-      if (!m_pWriteStream->SeekToEnd())
-        return NULL;
-    }
-    else
+  // used in place if it's in memory and the entries are aligned, otherwise read in one go
+  const byte* pData = pStream->GetBasePointer();
+  if (pData != NULL && ((size_t)(pData + position) % alignof(Entry)) == 0)
+  {
+    pData += position;
+    m_pStream = pStream;
+    m_pStream->AddRef();
+  }
+  else
+  {
+    m_data.Resize((uint32)(size - position));
+    if (!pStream->Read2(m_data.GetBasePointer(), m_data.GetSize()))
     {
-      // disallow buffered write when a streamed write is open
-      if (m_nOpenStreamedWrites > 0)
-        return NULL;
+      Clear();
+      return false;
     }
 
-    // determine compression method
-    uint32 compressionMethod = (compressionLevel == 0) ? 0 : Z_DEFLATED;
+    pData = m_data.GetBasePointer();
+  }
+
+  const ZIP_ARCHIVE_INDEX_HEADER* pHeader = reinterpret_cast<const ZIP_ARCHIVE_INDEX_HEADER*>(pData);
+  uint64 expectedSize = (uint64)sizeof(ZIP_ARCHIVE_INDEX_HEADER) + (uint64)sizeof(Entry) * pHeader->EntryCount +
+                        (uint64)sizeof(uint32) * pHeader->SlotCount + (uint64)pHeader->NamesSize;
+  if (pHeader->Signature != ZIP_ARCHIVE_INDEX_SIGNATURE || pHeader->Version != ZIP_ARCHIVE_INDEX_VERSION ||
+      pHeader->ArchiveSize != pArchiveHeader->ArchiveSize ||
+      pHeader->CentralDirectoryOffset != pArchiveHeader->CentralDirectoryOffset ||
+      pHeader->CentralDirectorySize != pArchiveHeader->CentralDirectorySize ||
+      pHeader->CentralDirectoryRecords != pArchiveHeader->CentralDirectoryRecords ||
+      pHeader->CentralDirectoryTailCRC32 != pArchiveHeader->CentralDirectoryTailCRC32 ||
+      pHeader->SlotCount < 16 || (pHeader->SlotCount & (pHeader->SlotCount - 1)) != 0 ||
+      pHeader->SlotCount < (pHeader->EntryCount * 2ULL) || expectedSize != (size - position))
+  {
+    Clear();
+    return false;
+  }
 
-    // see if the file is already present
-    FileHashTable::Member* pMember = m_writeFileHashTable.Find(filename);
-    if (pMember == NULL)
-    {
-      // create a new file entry
-      FileEntry* pFileEntry = new FileEntry;
-      pFileEntry->FileName = filename;
-      pFileEntry->CompressionMethod = compressionMethod;
-      pFileEntry->ModifiedTime = Timestamp::Now();
-      pFileEntry->CRC32 = 0;
-      pFileEntry->OffsetToFileHeader = 0;
-      pFileEntry->CompressedFileSize = 0;
-      pFileEntry->DecompressedFileSize = 0;
-      pFileEntry->IsDeleted = false;
-      pFileEntry->WriteOpenCount = 0;
-      pMember = m_writeFileHashTable.Insert(pFileEntry->FileName, pFileEntry);
-    }
+  const Entry* pEntries = reinterpret_cast<const Entry*>(pData + sizeof(ZIP_ARCHIVE_INDEX_HEADER));
+  const uint32* pSlots = reinterpret_cast<const uint32*>(pEntries + pHeader->EntryCount);
+  const char* pNames = reinterpret_cast<const char*>(pSlots + pHeader->SlotCount);
 
-    // create the stream object
-    if (streamed)
+  // a damaged index mustn't send lookups out of bounds
+  for (uint32 i = 0; i < pHeader->EntryCount; i++)
+  {
+    const Entry& entry = pEntries[i];
+    if ((uint64)entry.NameOffset + entry.NameLength >= pHeader->NamesSize ||
+        pNames[entry.NameOffset + entry.NameLength] != '\0')
     {
-      ZipArchiveStreamedWriteByteStream* pWriterStream = new ZipArchiveStreamedWriteByteStream(
-        this, m_pWriteStream, pMember->Value, m_pWriteStream->GetPosition(), compressionMethod, compressionLevel);
-      if (!pWriterStream->WriteHeader())
-      {
-        pWriterStream->Release();
-        pMember->Value->IsDeleted = true;
-        return NULL;
-      }
-
-      return pWriterStream;
+      Clear();
+      return false;
     }
-    else
+  }
+  for (uint32 i = 0; i < pHeader->SlotCount; i++)
+  {
+    if (pSlots[i] > pHeader->EntryCount)
     {
-      ZipArchiveBufferedWriteByteStream* pWriterStream = new ZipArchiveBufferedWriteByteStream(
-        this, m_pWriteStream, pMember->Value, compressionMethod, compressionLevel);
-      return pWriterStream;
+      Clear();
+      return false;
     }
   }
 
-  return NULL;
+  m_pEntries = pEntries;
+  m_pSlots = pSlots;
+  m_pNames = pNames;
+  m_entryCount = pHeader->EntryCount;
+  m_slotCount = pHeader->SlotCount;
+  m_namesSize = pHeader->NamesSize;
+
+  // the filter isn't saved, the hashes are there to rebuild it from
+  m_nameFilter.Reset(m_entryCount);
+  for (uint32 i = 0; i < m_entryCount; i++)
+    m_nameFilter.Add(m_pEntries[i].NameHash);
+
+  return true;
 }
 
-bool ZipArchive::DeleteFile(const char* filename)
+ZipArchive::ZipArchive(ByteStream* pReadStream, ByteStream* pWriteStream)
+  : m_pReadStream(pReadStream), m_pWriteStream(pWriteStream), m_nOpenStreamedReads(0), m_nOpenStreamedWrites(0),
+    m_nOpenBufferedReads(0), m_nOpenBufferedWrites(0), m_pCompressionThreadPool(NULL),
+    m_compressionCodec(COMPRESSION_CODEC_DEFLATE), m_indexLoaded(false),
+    m_findTrie(PathTrie<uint32>::FLAG_CASE_INSENSITIVE), m_findTrieBuilt(false)
 {
-  FileHashTable::Member* pMember;
-  bool result = false;
+  if (pReadStream != NULL)
+    pReadStream->AddRef();
+  if (pWriteStream != NULL)
+    pWriteStream->AddRef();
+}
 
-  // remove from both read and write streams
-  pMember = m_readFileHashTable.Find(filename);
-  if (pMember != NULL)
+ZipArchive::~ZipArchive()
+{
+  for (FileHashTable::Iterator itr = m_writeFileHashTable.Begin(); !itr.AtEnd(); itr.Forward())
+    delete itr->Value;
+
+  if (m_pReadStream != NULL)
+    m_pReadStream->Release();
+  if (m_pWriteStream != NULL)
+    m_pWriteStream->Release();
+}
+
+bool ZipArchive::StatFile(const char* filename, FILESYSTEM_STAT_DATA* pStatData) const
+{
+  const FileHashTable::Member* pMember;
+  uint32 readIndex;
+  const FileLocation* pLocation;
+  if ((pMember = m_writeFileHashTable.Find(filename)) != NULL && !pMember->Value->IsDeleted)
   {
-    pMember->Value->IsDeleted = true;
-    result = true;
+    pLocation = pMember->Value;
+    pStatData->ModificationTime = pMember->Value->ModifiedTime;
+  }
+  else if ((readIndex = m_readIndex.Find(filename)) != ReadIndex::InvalidEntry &&
+           !m_readIndex.IsEntryDeleted(readIndex))
+  {
+    pLocation = &m_readIndex.GetEntry(readIndex).Location;
+    pStatData->ModificationTime = ZipTimeToTimestamp(m_readIndex.GetEntry(readIndex).ModifiedTime);
+  }
+  else
+  {
+    return false;
   }
 
-  pMember = m_writeFileHashTable.Find(filename);
-  if (pMember != NULL)
+  // attributes
+  pStatData->Attributes = 0;
   {
-    pMember->Value->IsDeleted = true;
-    result = true;
+    // compressed
+    if (pLocation->CompressionMethod != 0)
+      pStatData->Attributes |= FILESYSTEM_FILE_ATTRIBUTE_COMPRESSED;
   }
 
-  return result;
+  // size (uncompressed)
+  pStatData->Size = pLocation->DecompressedFileSize;
+
+  // ok
+  return true;
 }
 
-bool ZipArchive::CopyFile(ZipArchive* pOtherArchive, const char* filename)
+void ZipArchive::EnumerateFiles(EnumerateFilesCallback callback, void* pUserData) const
 {
-  if (m_pWriteStream == NULL)
-    return false;
+  // written files hide the ones read with the same name, as in StatFile
+  FILESYSTEM_STAT_DATA statData;
+  for (FileHashTable::ConstIterator itr = m_writeFileHashTable.Begin(); !itr.AtEnd(); itr.Forward())
+  {
+    const FileEntry* pFileEntry = itr->Value;
+    if (pFileEntry->IsDeleted)
+      continue;
 
-  const FileHashTable::Member* pSourceMember;
-  ByteStream* pSourceStream;
+    statData.Attributes = (pFileEntry->CompressionMethod != 0) ? FILESYSTEM_FILE_ATTRIBUTE_COMPRESSED : 0;
+    statData.ModificationTime = pFileEntry->ModifiedTime;
+    statData.Size = pFileEntry->DecompressedFileSize;
+    callback(pFileEntry->FileName, &statData, pUserData);
+  }
 
-  pSourceMember = pOtherArchive->m_writeFileHashTable.Find(filename);
-  if (pSourceMember == NULL)
+  for (uint32 i = 0; i < m_readIndex.GetEntryCount(); i++)
   {
-    if ((pSourceMember = pOtherArchive->m_readFileHashTable.Find(filename)) != NULL)
+    const char* fileName = m_readIndex.GetEntryName(i);
+    const FileHashTable::Member* pWrittenMember;
+    if (m_readIndex.IsEntryDeleted(i) ||
+        ((pWrittenMember = m_writeFileHashTable.Find(fileName)) != NULL && !pWrittenMember->Value->IsDeleted))
     {
-      pSourceStream = pOtherArchive->m_pReadStream;
+      continue;
     }
-    else
+
+    const ReadIndex::Entry& entry = m_readIndex.GetEntry(i);
+    statData.Attributes = (entry.Location.CompressionMethod != 0) ? FILESYSTEM_FILE_ATTRIBUTE_COMPRESSED : 0;
+    statData.ModificationTime = ZipTimeToTimestamp(entry.ModifiedTime);
+    statData.Size = entry.Location.DecompressedFileSize;
+    callback(fileName, &statData, pUserData);
+  }
+}
+
+const ZipArchive::FileLocation* ZipArchive::FindReadableFile(const char* filename, ByteStream** ppStream) const
+{
+  const FileHashTable::Member* pMember;
+  uint32 readIndex;
+  if ((pMember = m_writeFileHashTable.Find(filename)) != NULL && !pMember->Value->IsDeleted)
+  {
+    // file still open for writing?
+    if (pMember->Value->WriteOpenCount > 0)
+      return NULL;
+
+    *ppStream = m_pWriteStream;
+    return pMember->Value;
+  }
+  else if ((readIndex = m_readIndex.Find(filename)) != ReadIndex::InvalidEntry &&
+           !m_readIndex.IsEntryDeleted(readIndex))
+  {
+    *ppStream = m_pReadStream;
+    return &m_readIndex.GetEntry(readIndex).Location;
+  }
+
+  return NULL;
+}
+
+bool ZipArchive::ReadLocalFileHeader(ByteStream* pStream, const FileLocation* pLocation,
+                                     ZIP_ARCHIVE_LOCAL_FILE_HEADER* pLocalFileHeader)
+{
+  BinaryReader binaryReader(pStream, ENDIAN_TYPE_LITTLE);
+  if (!pStream->SeekAbsolute(pLocation->OffsetToFileHeader))
+    return false;
+
+  uint32 compressedSize32;
+  uint32 decompressedSize32;
+  if (!binaryReader.SafeReadUInt32(&pLocalFileHeader->Signature) ||
+      !binaryReader.SafeReadUInt16(&pLocalFileHeader->VersionRequiredToExtract) ||
+      !binaryReader.SafeReadUInt16(&pLocalFileHeader->Flags) ||
+      !binaryReader.SafeReadUInt16(&pLocalFileHeader->CompressionMethod) ||
+      !binaryReader.SafeReadUInt32(&pLocalFileHeader->ModificationTimestamp) ||
+      !binaryReader.SafeReadUInt32(&pLocalFileHeader->CRC32) || !binaryReader.SafeReadUInt32(&compressedSize32) ||
+      !binaryReader.SafeReadUInt32(&decompressedSize32) ||
+      !binaryReader.SafeReadUInt16(&pLocalFileHeader->FilenameLength) ||
+      !binaryReader.SafeReadUInt16(&pLocalFileHeader->ExtraFieldLength))
+  {
+    return false;
+  }
+
+  pLocalFileHeader->CompressedSize = (uint64)compressedSize32;
+  pLocalFileHeader->DecompressedSize = (uint64)decompressedSize32;
+
+  if (pLocalFileHeader->Signature != ZIP_ARCHIVE_LOCAL_FILE_HEADER_SIGNTURE)
+    return false;
+
+  if (!IsReadableCompressionMethod(pLocalFileHeader->CompressionMethod))
+    return false;
+
+  // saturated sizes are in the ZIP64 extra field, which leaves the stream past the header
+  uint32 seekDistance = (uint32)pLocalFileHeader->FilenameLength + (uint32)pLocalFileHeader->ExtraFieldLength;
+  if (compressedSize32 == ZIP_ARCHIVE_ZIP64_LIMIT || decompressedSize32 == ZIP_ARCHIVE_ZIP64_LIMIT)
+  {
+    PODArray<byte> extraField;
+    extraField.Resize(pLocalFileHeader->ExtraFieldLength);
+    if (!pStream->SeekRelative(pLocalFileHeader->FilenameLength) ||
+        (extraField.GetSize() > 0 && !pStream->Read2(extraField.GetBasePointer(), extraField.GetSize())) ||
+        !ReadZip64ExtraField(extraField.GetBasePointer(), extraField.GetSize(), true,
+                             &pLocalFileHeader->DecompressedSize, &pLocalFileHeader->CompressedSize, NULL))
     {
       return false;
     }
+
+    seekDistance = 0;
   }
-  else
+
+  // ugh, streamed files. have to handle these carefully
+  // otherwise, should be accurate
+  if (pLocalFileHeader->Flags & 8)
   {
-    pSourceStream = pOtherArchive->m_pWriteStream;
+    if (pLocation->CRC32 == 0)
+      return false;
+
+    // pull from central directory
+    pLocalFileHeader->CRC32 = pLocation->CRC32;
+    pLocalFileHeader->CompressedSize = pLocation->CompressedFileSize;
+    pLocalFileHeader->DecompressedSize = pLocation->DecompressedFileSize;
+  }
+  else if (pLocalFileHeader->CompressedSize != pLocation->CompressedFileSize ||
+           pLocalFileHeader->DecompressedSize != pLocation->DecompressedFileSize)
+  {
+    return false;
   }
 
-  const FileEntry* pSourceEntry = pSourceMember->Value;
+  return pStream->SeekRelative(seekDistance);
+}
 
-  // seek read stream to the file header offset
-  if (!pSourceStream->SeekAbsolute(pSourceEntry->OffsetToFileHeader))
+bool ZipArchive::CopyLocalFile(ByteStream* pSourceStream, const FileLocation* pLocation,
+                               ByteStream* pDestinationStream, const char* fileName, uint32 filenameLength)
+{
+  // strip the streamed flag from the local header, since we're not going to append the post-header
+  ZIP_ARCHIVE_LOCAL_FILE_HEADER localFileHeader;
+  if (!ReadLocalFileHeader(pSourceStream, pLocation, &localFileHeader))
     return false;
 
-  // find offset that we are writing to
-  if (!m_pWriteStream->SeekToEnd())
+  localFileHeader.Flags &= ~(uint16)8;
+  if (!WriteLocalFileHeader(pDestinationStream, &localFileHeader, fileName, filenameLength))
     return false;
 
-  // create in file table
-  FileHashTable::Member* pDestinationMember = m_writeFileHashTable.Find(pSourceEntry->FileName);
-  if (pDestinationMember != NULL)
+  // read+write chunks
+  static const uint32 CHUNKSIZE = 4096;
+  byte chunkBuffer[CHUNKSIZE];
+  uint64 remaining = pLocation->CompressedFileSize;
+  while (remaining > 0)
   {
-    if (pDestinationMember->Value->WriteOpenCount > 0)
+    uint32 copySize = (uint32)Min(remaining, (uint64)CHUNKSIZE);
+
+    // read it
+    uint32 bytesRead = pSourceStream->Read(chunkBuffer, copySize);
+    if (bytesRead != copySize)
+    {
+      // io error
+      return false;
+    }
+
+    // write it
+    uint32 bytesWritten = pDestinationStream->Write(chunkBuffer, copySize);
+    if (bytesWritten != copySize)
+    {
+      // io error
       return false;
+    }
+
+    remaining -= (uint64)copySize;
   }
-  else
+
+  return true;
+}
+
+ByteStream* ZipArchive::OpenFile(const char* filename, uint32 openMode, uint32 compressionLevel /* = 6 */)
+{
+  // zip archives do not support reading and writing at the same time
+  if ((openMode & (BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_WRITE)) == (BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_WRITE))
+    return NULL;
+
+  // reading?
+  if (openMode & BYTESTREAM_OPEN_READ)
   {
-    FileEntry* pFileEntry = new FileEntry;
-    pDestinationMember = m_writeFileHashTable.Insert(pSourceEntry->FileName, pFileEntry);
+    ByteStream* pStreamToReadFrom;
+    const FileLocation* pLocation = FindReadableFile(filename, &pStreamToReadFrom);
+    ZIP_ARCHIVE_LOCAL_FILE_HEADER localFileHeader;
+    if (pLocation == NULL || !ReadLocalFileHeader(pStreamToReadFrom, pLocation, &localFileHeader))
+      return NULL;
+
+    // stored files in archives held in memory or mapped are read in place, however they're opened
+    // and Zstandard frames are decompressed at once, so they're always buffered
+    // files past 4GB don't fit in a buffer, so the rest are always streamed
+    bool fitsInBuffer = (localFileHeader.DecompressedSize <= 0xFFFFFFFFULL);
+    bool readInPlace =
+      (localFileHeader.CompressionMethod == 0 && pStreamToReadFrom->GetBasePointer() != NULL && fitsInBuffer);
+    bool readWhole = (readInPlace || localFileHeader.CompressionMethod == ZIP_COMPRESSION_METHOD_ZSTD);
+    if (!readWhole &&
+        (openMode & BYTESTREAM_OPEN_STREAMED || (openMode & BYTESTREAM_OPEN_SEEKABLE) == 0 || !fitsInBuffer))
+    {
+      // create stream
+      ZipArchiveStreamedReadByteStream* pReaderStream = new ZipArchiveStreamedReadByteStream(
+        this, pStreamToReadFrom, pStreamToReadFrom->GetPosition(), &localFileHeader);
+      return pReaderStream;
+    }
+    else
+    {
+      // create buffered stream
+      ZipArchiveBufferedReadByteStream* pReaderStream = new ZipArchiveBufferedReadByteStream(this);
+      if (!pReaderStream->FillBuffer(pStreamToReadFrom, pStreamToReadFrom->GetPosition(), &localFileHeader))
+      {
+        pReaderStream->Release();
+        pReaderStream = NULL;
+      }
+      return pReaderStream;
+    }
   }
+  else if (openMode & BYTESTREAM_OPEN_WRITE)
+  {
+    if (m_pWriteStream == NULL)
+      return NULL;
 
-  // fill file entry
-  FileEntry* pDestinationEntry = pDestinationMember->Value;
-  pDestinationEntry->FileName = pSourceEntry->FileName;
-  pDestinationEntry->CompressionMethod = pSourceEntry->CompressionMethod;
-  pDestinationEntry->ModifiedTime = pSourceEntry->ModifiedTime;
-  pDestinationEntry->CRC32 = pSourceEntry->CRC32;
-  pDestinationEntry->OffsetToFileHeader = m_pWriteStream->GetPosition();
-  pDestinationEntry->CompressedFileSize = pSourceEntry->CompressedFileSize;
-  pDestinationEntry->DecompressedFileSize = pSourceEntry->DecompressedFileSize;
-  pDestinationEntry->IsDeleted = false;
-  pDestinationEntry->WriteOpenCount = 0;
+    // determine compression method, Zstandard is compressed in one go so it's always buffered
+    uint32 compressionMethod = GetWriteCompressionMethod(compressionLevel);
+    bool streamed = (openMode & BYTESTREAM_OPEN_STREAMED || (openMode & BYTESTREAM_OPEN_SEEKABLE) == 0) &&
+                    compressionMethod != ZIP_COMPRESSION_METHOD_ZSTD;
+    if (streamed)
+    {
+      // can only have one streamed write open at once
+      if (m_nOpenBufferedWrites > 0 || m_nOpenStreamedWrites > 0)
+        return NULL;
 
-  // write local header
+      // seek to the end of the write stream
+      if (!m_pWriteStream->SeekToEnd())
+        return NULL;
+    }
+    else
+    {
+      // disallow buffered write when a streamed write is open
+      if (m_nOpenStreamedWrites > 0)
+        return NULL;
+    }
+
+    FileEntry* pFileEntry = GetOrCreateWriteFileEntry(filename, compressionMethod);
+
+    // create the stream object
+    if (streamed)
+    {
+      ZipArchiveStreamedWriteByteStream* pWriterStream =
+        new ZipArchiveStreamedWriteByteStream(this, m_pWriteStream, pFileEntry, m_pWriteStream->GetPosition(),
+                                              compressionMethod, compressionLevel, m_pCompressionThreadPool);
+      if (!pWriterStream->WriteHeader())
+      {
+        pWriterStream->Release();
+        pFileEntry->IsDeleted = true;
+        return NULL;
+      }
+
+      return pWriterStream;
+    }
+    else
+    {
+      ZipArchiveBufferedWriteByteStream* pWriterStream =
+        new ZipArchiveBufferedWriteByteStream(this, m_pWriteStream, pFileEntry, compressionMethod, compressionLevel);
+      return pWriterStream;
+    }
+  }
+
+  return NULL;
+}
+
+bool ZipArchive::SetCompressionCodec(COMPRESSION_CODEC codec)
+{
+  if ((codec != COMPRESSION_CODEC_DEFLATE && codec != COMPRESSION_CODEC_ZSTD) || !Compression::IsCodecAvailable(codec))
+  {
+    Log_ErrorPrintf("ZipArchive::SetCompressionCodec: %s can't be used in zip archives",
+                    Compression::GetCodecName(codec));
+    return false;
+  }
+
+  m_compressionCodec = codec;
+  return true;
+}
+
+uint32 ZipArchive::GetWriteCompressionMethod(uint32 compressionLevel) const
+{
+  if (compressionLevel == 0)
+    return 0;
+
+  return (m_compressionCodec == COMPRESSION_CODEC_ZSTD) ? ZIP_COMPRESSION_METHOD_ZSTD : Z_DEFLATED;
+}
+
+ZipArchive::FileEntry* ZipArchive::GetOrCreateWriteFileEntry(const char* filename, uint32 compressionMethod)
+{
+  // see if the file is already present
+  FileHashTable::Member* pMember = m_writeFileHashTable.Find(filename);
+  if (pMember != NULL)
+    return pMember->Value;
+
+  // create a new file entry
+  FileEntry* pFileEntry = new FileEntry;
+  pFileEntry->FileName = filename;
+  pFileEntry->CompressionMethod = compressionMethod;
+  pFileEntry->ModifiedTime = Timestamp::Now();
+  pFileEntry->CRC32 = 0;
+  pFileEntry->OffsetToFileHeader = 0;
+  pFileEntry->CompressedFileSize = 0;
+  pFileEntry->DecompressedFileSize = 0;
+  pFileEntry->IsDeleted = false;
+  pFileEntry->WriteOpenCount = 0;
+  m_writeFileHashTable.Insert(pFileEntry->FileName, pFileEntry);
+  AddToFindTrie(pFileEntry->FileName);
+  return pFileEntry;
+}
+
+bool ZipArchive::WriteFileData(FileEntry* pFileEntry, uint32 compressionMethod, uint32 crc, const void* pData,
+                               uint32 dataSize, uint32 decompressedSize)
+{
+  if (!m_pWriteStream->SeekToEnd())
+    return false;
+
+  BinaryWriter binaryWriter(m_pWriteStream, ENDIAN_TYPE_LITTLE);
+  Timestamp modifiedTimestamp(Timestamp::Now());
+  uint64 offsetToLocalFileHeader = m_pWriteStream->GetPosition();
+  uint32 filenameLength = Min(pFileEntry->FileName.GetLength(), (uint32)0xFFFF);
+  if (!binaryWriter.SafeWriteUInt32(ZIP_ARCHIVE_LOCAL_FILE_HEADER_SIGNTURE) ||    // Signature
+      !binaryWriter.SafeWriteUInt16(ZIP_ARCHIVE_VERSION_TO_EXTRACT) ||            // VersionRequiredToExtract
+      !binaryWriter.SafeWriteUInt16(0) ||                                         // Flags
+      !binaryWriter.SafeWriteUInt16((uint16)compressionMethod) ||                 // CompressionMethod
+      !binaryWriter.SafeWriteUInt32(TimestampToZipTime(modifiedTimestamp)) ||     // ModificationTimestamp
+      !binaryWriter.SafeWriteUInt32(crc) ||                                       // CRC32
+      !binaryWriter.SafeWriteUInt32(dataSize) ||                                  // CompressedSize
+      !binaryWriter.SafeWriteUInt32(decompressedSize) ||                          // DecompressedSize
+      !binaryWriter.SafeWriteUInt16((uint16)filenameLength) ||                    // FilenameLength
+      !binaryWriter.SafeWriteUInt16(0) ||                                         // ExtraFieldLength
+      !binaryWriter.SafeWriteFixedString(pFileEntry->FileName, filenameLength) || // Filename
+      (dataSize > 0 && !binaryWriter.SafeWriteBytes(pData, dataSize)))            // Data
   {
-    BinaryReader binaryReader(pSourceStream);
+    return false;
+  }
 
-    ZIP_ARCHIVE_LOCAL_FILE_HEADER localFileHeader;
-    uint32 compressedSize32;
-    uint32 decompressedSize32;
-    if (!binaryReader.SafeReadUInt32(&localFileHeader.Signature) ||
-        !binaryReader.SafeReadUInt16(&localFileHeader.VersionRequiredToExtract) ||
-        !binaryReader.SafeReadUInt16(&localFileHeader.Flags) ||
-        !binaryReader.SafeReadUInt16(&localFileHeader.CompressionMethod) ||
-        !binaryReader.SafeReadUInt32(&localFileHeader.ModificationTimestamp) ||
-        !binaryReader.SafeReadUInt32(&localFileHeader.CRC32) || !binaryReader.SafeReadUInt32(&compressedSize32) ||
-        !binaryReader.SafeReadUInt32(&decompressedSize32) ||
-        !binaryReader.SafeReadUInt16(&localFileHeader.FilenameLength) ||
-        !binaryReader.SafeReadUInt16(&localFileHeader.ExtraFieldLength))
-    {
-      pDestinationEntry->IsDeleted = true;
-      return false;
+  // update the file entry
+  pFileEntry->CompressionMethod = compressionMethod;
+  pFileEntry->ModifiedTime = modifiedTimestamp;
+  pFileEntry->CRC32 = crc;
+  pFileEntry->OffsetToFileHeader = offsetToLocalFileHeader;
+  pFileEntry->CompressedFileSize = dataSize;
+  pFileEntry->DecompressedFileSize = decompressedSize;
+  pFileEntry->IsDeleted = false;
+  return true;
+}
+
+bool ZipArchive::WriteFiles(const FileContents* pFiles, uint32 count, uint32 compressionLevel /* = 6 */,
+                            ThreadPool* pThreadPool /* = NULL */)
+{
+  Y_PROFILE_ZONE("ZipArchive::WriteFiles");
+
+  // a file compressed for writing
+  struct CompressJob
+  {
+    const FileContents* pFile;
+    PODArray<byte> CompressedData;
+    uint32 CRC32;
+    bool Result;
+  };
+
+  if (m_pWriteStream == NULL || m_nOpenStreamedWrites > 0)
+    return false;
+
+  uint32 compressionMethod = GetWriteCompressionMethod(compressionLevel);
+  Array<CompressJob> jobs;
+  uint32 failedCount = 0;
+  uint32 index = 0;
+  while (index < count)
+  {
+    // compress a batch, small files side by side and large ones in blocks as well
+    jobs.Clear();
+    uint64 batchSize = 0;
+    for (; index < count && batchSize < ZIP_BULK_BATCH_SIZE; index++)
+    {
+      CompressJob job;
+      job.pFile = &pFiles[index];
+      job.CRC32 = 0;
+      job.Result = false;
+      jobs.Add(job);
+      batchSize += pFiles[index].Size;
+    }
+
+    ParallelFor(pThreadPool, 0, jobs.GetSize(), 1, [&jobs, compressionMethod, compressionLevel,
+                                                    pThreadPool](uint32 jobIndex) {
+      Y_PROFILE_ZONE("ZipArchive::CompressFileData");
+      CompressJob& job = jobs[jobIndex];
+      const byte* pData = reinterpret_cast<const byte*>(job.pFile->pData);
+      if (compressionMethod == 0)
+      {
+        job.CRC32 = crc32(0, (const Bytef*)pData, job.pFile->Size);
+        job.Result = true;
+      }
+      else
+      {
+        ThreadPool* pBlockThreadPool = (job.pFile->Size > ZIP_PARALLEL_DEFLATE_BLOCK_SIZE) ? pThreadPool : NULL;
+        job.Result = CompressWholeFile(compressionMethod, compressionLevel, pData, job.pFile->Size,
+                                       pBlockThreadPool, &job.CompressedData, &job.CRC32);
+      }
+    });
+
+    // written in order
+    for (uint32 i = 0; i < jobs.GetSize(); i++)
+    {
+      const CompressJob& job = jobs[i];
+      FileEntry* pFileEntry = GetOrCreateWriteFileEntry(job.pFile->FileName, compressionMethod);
+      const void* pData = (compressionMethod == 0) ? job.pFile->pData : job.CompressedData.GetBasePointer();
+      uint32 dataSize = (compressionMethod == 0) ? job.pFile->Size : job.CompressedData.GetSize();
+      if (!job.Result || pFileEntry->WriteOpenCount > 0 ||
+          !WriteFileData(pFileEntry, compressionMethod, job.CRC32, pData, dataSize, job.pFile->Size))
+      {
+        Log_ErrorPrintf("ZipArchive::WriteFiles: '%s' could not be written", job.pFile->FileName);
+        if (pFileEntry->WriteOpenCount == 0)
+          pFileEntry->IsDeleted = true;
+
+        failedCount++;
+      }
     }
+  }
 
-    localFileHeader.CompressedSize = (uint64)compressedSize32;
-    localFileHeader.DecompressedSize = (uint64)decompressedSize32;
+  return (failedCount == 0);
+}
 
-    if (localFileHeader.Signature != ZIP_ARCHIVE_LOCAL_FILE_HEADER_SIGNTURE)
+bool ZipArchive::DeleteFile(const char* filename)
+{
+  FileHashTable::Member* pMember;
+  bool result = false;
+
+  // remove from both read and write streams
+  uint32 readIndex = m_readIndex.Find(filename);
+  if (readIndex != ReadIndex::InvalidEntry)
+  {
+    m_readIndex.DeleteEntry(readIndex);
+    result = true;
+  }
+
+  pMember = m_writeFileHashTable.Find(filename);
+  if (pMember != NULL)
+  {
+    pMember->Value->IsDeleted = true;
+    result = true;
+  }
+
+  return result;
+}
+
+// refuses names that would be extracted outside the destination directory
+static bool IsExtractableFileName(const char* filename)
+{
+  if (filename[0] == '\0' || filename[0] == '/' || filename[0] == '\\' || Y_strchr(filename, ':') != NULL)
+    return false;
+
+  const char* pComponent = filename;
+  for (;;)
+  {
+    const char* pComponentEnd = pComponent;
+    while (*pComponentEnd != '\0' && *pComponentEnd != '/' && *pComponentEnd != '\\')
+      pComponentEnd++;
+
+    if ((pComponentEnd - pComponent) == 2 && pComponent[0] == '.' && pComponent[1] == '.')
+      return false;
+    if (*pComponentEnd == '\0')
+      return true;
+
+    pComponent = pComponentEnd + 1;
+  }
+}
+
+// Decompresses a file's data held in memory whole into a new buffer, and checks it. Stored files aren't copied,
+// leaving the buffer NULL. Failures are logged as from the operation. Called from the workers.
+static bool DecodeFileData(const char* operation, const char* filename,
+                           const ZIP_ARCHIVE_LOCAL_FILE_HEADER* pLocalFileHeader, const byte* pData, byte** ppBuffer)
+{
+  uint32 size = (uint32)pLocalFileHeader->DecompressedSize;
+  const byte* pContents = pData;
+  byte* pBuffer = NULL;
+  if (pLocalFileHeader->CompressionMethod == Z_DEFLATED)
+  {
+    pBuffer = new byte[Max(size, (uint32)1)];
+    pContents = pBuffer;
+
+    z_stream* pZStream = s_zStreamPool.AcquireInflateStream();
+    if (pZStream == NULL)
+      Panic("inflateInit2 failed");
+
+    z_stream& zStream = *pZStream;
+    zStream.next_in = (Bytef*)pData;
+    zStream.avail_in = (uInt)pLocalFileHeader->CompressedSize;
+    zStream.next_out = (Bytef*)pBuffer;
+    zStream.avail_out = size;
+
+    // the whole file is there, so one call does it
+    int status = inflate(&zStream, Z_FINISH);
+    uLong decompressedSize = zStream.total_out;
+    s_zStreamPool.ReleaseInflateStream(pZStream);
+    if ((status != Z_STREAM_END && status != Z_OK && status != Z_BUF_ERROR) || decompressedSize != size)
+    {
+      Log_ErrorPrintf("%s: '%s' could not be inflated", operation, filename);
+      delete[] pBuffer;
+      return false;
+    }
+  }
+  else if (pLocalFileHeader->CompressionMethod == ZIP_COMPRESSION_METHOD_ZSTD)
+  {
+    pBuffer = new byte[Max(size, (uint32)1)];
+    pContents = pBuffer;
+
+    uint32 decompressedSize;
+    if (!Compression::DecompressBuffer(COMPRESSION_CODEC_ZSTD, pBuffer, size, &decompressedSize, pData,
+                                       (uint32)pLocalFileHeader->CompressedSize) ||
+        decompressedSize != size)
     {
-      pDestinationEntry->IsDeleted = true;
+      Log_ErrorPrintf("%s: '%s' could not be decompressed", operation, filename);
+      delete[] pBuffer;
       return false;
     }
+  }
+
+  if (crc32(0, (const Bytef*)pContents, size) != pLocalFileHeader->CRC32)
+  {
+    Log_ErrorPrintf("%s: '%s' fails its CRC check", operation, filename);
+    delete[] pBuffer;
+    return false;
+  }
+
+  *ppBuffer = pBuffer;
+  return true;
+}
+
+// decompresses a file's data, checks it and writes it out, called from the workers
+static bool ExtractFileData(const char* filename, const char* destinationPath,
+                            const ZIP_ARCHIVE_LOCAL_FILE_HEADER* pLocalFileHeader, const byte* pData)
+{
+  uint32 size = (uint32)pLocalFileHeader->DecompressedSize;
+  byte* pBuffer;
+  if (!DecodeFileData("ZipArchive::ExtractFiles", filename, pLocalFileHeader, pData, &pBuffer))
+    return false;
+
+  const byte* pContents = (pBuffer != NULL) ? pBuffer : pData;
+  ByteStream* pStream;
+  bool result = ByteStream_OpenFileStream(destinationPath,
+                                          BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_CREATE_PATH |
+                                            BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_TRUNCATE |
+                                            BYTESTREAM_OPEN_STREAMED,
+                                          &pStream);
+  if (result)
+  {
+    result = (size == 0 || pStream->Write2(pContents, size)) && pStream->Flush();
+    pStream->Release();
+  }
+  if (!result)
+    Log_ErrorPrintf("ZipArchive::ExtractFiles: '%s' could not be written", destinationPath);
+
+  delete[] pBuffer;
+  return result;
+}
 
-    // only handling deflate at the moment
-    if (localFileHeader.CompressionMethod != 0 && localFileHeader.CompressionMethod != Z_DEFLATED)
+// copies a file too big to hold in memory out a buffer at a time, on the calling thread
+static bool ExtractStreamedFileData(const char* filename, const char* destinationPath, ByteStream* pFileStream)
+{
+  ByteStream* pStream;
+  if (!ByteStream_OpenFileStream(destinationPath,
+                                 BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_CREATE_PATH | BYTESTREAM_OPEN_WRITE |
+                                   BYTESTREAM_OPEN_TRUNCATE | BYTESTREAM_OPEN_STREAMED,
+                                 &pStream))
+  {
+    Log_ErrorPrintf("ZipArchive::ExtractFiles: '%s' could not be written", destinationPath);
+    return false;
+  }
+
+  byte buffer[ZIP_STREAM_BUFFER_SIZE];
+  uint64 remaining = pFileStream->GetSize();
+  bool result = true;
+  while (result && remaining > 0)
+  {
+    uint32 copySize = (uint32)Min(remaining, (uint64)sizeof(buffer));
+    if (!pFileStream->Read2(buffer, copySize))
+    {
+      Log_ErrorPrintf("ZipArchive::ExtractFiles: '%s' could not be decompressed", filename);
+      result = false;
+    }
+    else if (!pStream->Write2(buffer, copySize))
     {
-      pDestinationEntry->IsDeleted = true;
+      Log_ErrorPrintf("ZipArchive::ExtractFiles: '%s' could not be written", destinationPath);
+      result = false;
+    }
+
+    remaining -= (uint64)copySize;
+  }
+
+  // reading past the end checks the CRC if the last read didn't reach the end of the deflate stream
+  if (result && (pFileStream->Read(buffer, 1) != 0 || pFileStream->InErrorState()))
+  {
+    Log_ErrorPrintf("ZipArchive::ExtractFiles: '%s' fails its CRC check", filename);
+    result = false;
+  }
+
+  result = result && pStream->Flush();
+  pStream->Release();
+  return result;
+}
+
+bool ZipArchive::ExtractFiles(const char* const* filenames, uint32 count, const char* destinationDirectory,
+                              ThreadPool* pThreadPool /* = NULL */,
+                              ProgressCallbacks* pProgressCallbacks /* = ProgressCallbacks::NullProgressCallback */)
+{
+  Y_PROFILE_ZONE("ZipArchive::ExtractFiles");
+
+  // a file read for extraction, with its data in the batch buffer, the archive's memory, or its own buffer
+  struct ExtractJob
+  {
+    const char* FileName;
+    PathString DestinationPath;
+    ZIP_ARCHIVE_LOCAL_FILE_HEADER LocalFileHeader;
+    const byte* pData;
+    uint32 BatchOffset;
+    byte* pOwnedData;
+    bool Result;
+  };
+
+  if (!FileSystem::CreateDirectory(destinationDirectory, true))
+  {
+    Log_ErrorPrintf("ZipArchive::ExtractFiles: Could not create '%s'", destinationDirectory);
+    return false;
+  }
+
+  pProgressCallbacks->SetProgressRange(count);
+  pProgressCallbacks->SetProgressValue(0);
+
+  Array<ExtractJob> jobs;
+  PODArray<byte> batchBuffer;
+  uint32 failedCount = 0;
+  uint32 index = 0;
+  while (index < count)
+  {
+    if (pProgressCallbacks->IsCancelled())
       return false;
+
+    // read a batch, files bigger than a batch get their own buffer and end it
+    jobs.Clear();
+    batchBuffer.Clear();
+    uint64 batchSize = 0;
+    for (; index < count && batchSize < ZIP_BULK_BATCH_SIZE; index++)
+    {
+      const char* filename = filenames[index];
+      if (!IsExtractableFileName(filename))
+      {
+        Log_ErrorPrintf("ZipArchive::ExtractFiles: '%s' would be outside the destination", filename);
+        failedCount++;
+        continue;
+      }
+
+      PathString destinationPath;
+      destinationPath.Format("%s/%s", destinationDirectory, filename);
+
+      // directory entries
+      if (filename[Y_strlen(filename) - 1] == '/')
+      {
+        if (!FileSystem::CreateDirectory(destinationPath, true))
+        {
+          Log_ErrorPrintf("ZipArchive::ExtractFiles: Could not create '%s'", destinationPath.GetCharArray());
+          failedCount++;
+        }
+
+        continue;
+      }
+
+      ByteStream* pStream;
+      const FileLocation* pLocation = FindReadableFile(filename, &pStream);
+      ExtractJob job;
+      if (pLocation == NULL || !ReadLocalFileHeader(pStream, pLocation, &job.LocalFileHeader))
+      {
+        Log_ErrorPrintf("ZipArchive::ExtractFiles: '%s' could not be read", filename);
+        failedCount++;
+        continue;
+      }
+
+      // ZIP64 files past 4GB are streamed out here rather than read whole for the workers
+      if (job.LocalFileHeader.DecompressedSize > 0xFFFFFFFFULL || job.LocalFileHeader.CompressedSize > 0xFFFFFFFFULL)
+      {
+        ZipArchiveStreamedReadByteStream* pFileStream =
+          new ZipArchiveStreamedReadByteStream(this, pStream, pStream->GetPosition(), &job.LocalFileHeader);
+        if (!ExtractStreamedFileData(filename, destinationPath, pFileStream))
+          failedCount++;
+
+        pFileStream->Release();
+        continue;
+      }
+
+      uint32 dataSize = (job.LocalFileHeader.CompressionMethod == 0) ? (uint32)job.LocalFileHeader.DecompressedSize :
+                                                                       (uint32)job.LocalFileHeader.CompressedSize;
+      job.FileName = filename;
+      job.DestinationPath = destinationPath;
+      job.pData = NULL;
+      job.BatchOffset = 0;
+      job.pOwnedData = NULL;
+      job.Result = false;
+
+      // archives in memory are read in place
+      byte* pReadBuffer;
+      if (pStream->GetBasePointer() != NULL)
+      {
+        job.pData = pStream->GetBasePointer() + pStream->GetPosition();
+        pReadBuffer = NULL;
+      }
+      else if (dataSize >= ZIP_BULK_BATCH_SIZE)
+      {
+        job.pOwnedData = new byte[dataSize];
+        job.pData = job.pOwnedData;
+        pReadBuffer = job.pOwnedData;
+      }
+      else
+      {
+        job.BatchOffset = batchBuffer.GetSize();
+        batchBuffer.Resize(job.BatchOffset + dataSize);
+        pReadBuffer = batchBuffer.GetBasePointer() + job.BatchOffset;
+      }
+
+      if (pReadBuffer != NULL && dataSize > 0 && pStream->Read(pReadBuffer, dataSize) != dataSize)
+      {
+        Log_ErrorPrintf("ZipArchive::ExtractFiles: '%s' could not be read", filename);
+        delete[] job.pOwnedData;
+        failedCount++;
+        continue;
+      }
+
+      batchSize += dataSize;
+      jobs.Add(job);
+    }
+
+    // the batch buffer has stopped moving
+    for (uint32 i = 0; i < jobs.GetSize(); i++)
+    {
+      if (jobs[i].pData == NULL)
+        jobs[i].pData = batchBuffer.GetBasePointer() + jobs[i].BatchOffset;
+    }
+
+    ParallelFor(pThreadPool, 0, jobs.GetSize(), 1, [&jobs](uint32 jobIndex) {
+      Y_PROFILE_ZONE("ZipArchive::ExtractFileData");
+      ExtractJob& job = jobs[jobIndex];
+      job.Result = ExtractFileData(job.FileName, job.DestinationPath, &job.LocalFileHeader, job.pData);
+    });
+
+    for (uint32 i = 0; i < jobs.GetSize(); i++)
+    {
+      if (!jobs[i].Result)
+        failedCount++;
+
+      delete[] jobs[i].pOwnedData;
+    }
+
+    pProgressCallbacks->SetProgressValue(index);
+  }
+
+  return (failedCount == 0);
+}
+
+bool ZipArchive::ExtractAll(const char* destinationDirectory, ThreadPool* pThreadPool /* = NULL */,
+                            ProgressCallbacks* pProgressCallbacks /* = ProgressCallbacks::NullProgressCallback */)
+{
+  struct Callback
+  {
+    static void AddFileName(const char* filename, const FILESYSTEM_STAT_DATA* pStatData, void* pUserData)
+    {
+      reinterpret_cast<Array<String>*>(pUserData)->Add(filename);
+    }
+  };
+
+  Array<String> filenames;
+  EnumerateFiles(&Callback::AddFileName, &filenames);
+
+  PODArray<const char*> filenamePointers;
+  filenamePointers.Reserve(filenames.GetSize());
+  for (uint32 i = 0; i < filenames.GetSize(); i++)
+    filenamePointers.Add(filenames[i].GetCharArray());
+
+  return ExtractFiles(filenamePointers.GetBasePointer(), filenamePointers.GetSize(), destinationDirectory, pThreadPool,
+                      pProgressCallbacks);
+}
+
+// a file in the read stream, read with others by ReadBatch
+struct ZipArchive::BatchFile
+{
+  // the caller's number for the file
+  uint32 Index;
+  const FileLocation* pLocation;
+  uint32 NameLength;
+
+  // filled in by ReadBatch, with the data in the batch buffer or the archive's memory
+  ZIP_ARCHIVE_LOCAL_FILE_HEADER LocalFileHeader;
+  const byte* pData;
+
+  // for the workers
+  byte* pBuffer;
+  bool Result;
+
+  static int CompareOffsets(const BatchFile* pLeft, const BatchFile* pRight)
+  {
+    uint64 leftOffset = pLeft->pLocation->OffsetToFileHeader;
+    uint64 rightOffset = pRight->pLocation->OffsetToFileHeader;
+    return (leftOffset < rightOffset) ? -1 : ((leftOffset > rightOffset) ? 1 : 0);
+  }
+};
+
+uint32 ZipArchive::ReadBatch(const PODArray<BatchFile>& files, uint32 index, PODArray<byte>* pBatchBuffer,
+                             PODArray<BatchFile>* pBatch, PODArray<uint32>* pSingles)
+{
+  // archives in memory are used in place
+  const byte* pArchiveMemory = m_pReadStream->GetBasePointer();
+  uint64 archiveSize = m_pReadStream->GetSize();
+
+  // offsets into the batch buffer until it's stopped moving
+  PODArray<uint32> batchOffsets;
+  pBatch->Clear();
+  pBatchBuffer->Clear();
+  while (index < files.GetSize() && pBatchBuffer->GetSize() < ZIP_BULK_BATCH_SIZE)
+  {
+    // a run of files with little enough between them to read over, within a batch
+    uint64 spanStart = 0;
+    uint64 spanEnd = archiveSize;
+    uint32 spanEndIndex = files.GetSize();
+    if (pArchiveMemory == NULL)
+    {
+      spanStart = files[index].pLocation->OffsetToFileHeader;
+      spanEnd = spanStart;
+      for (spanEndIndex = index; spanEndIndex < files.GetSize(); spanEndIndex++)
+      {
+        const FileLocation* pLocation = files[spanEndIndex].pLocation;
+        uint64 fileEnd = pLocation->OffsetToFileHeader + ZIP_ARCHIVE_LOCAL_FILE_HEADER_SIZE +
+                         files[spanEndIndex].NameLength + ZIP_LOCAL_EXTRA_FIELD_ALLOWANCE +
+                         pLocation->CompressedFileSize;
+        fileEnd = Min(fileEnd, archiveSize);
+        if (spanEndIndex > index && (pLocation->OffsetToFileHeader > spanEnd + ZIP_COALESCED_READ_GAP_SIZE ||
+                                     Max(spanEnd, fileEnd) - spanStart > ZIP_BULK_BATCH_SIZE))
+        {
+          break;
+        }
+
+        spanEnd = Max(spanEnd, fileEnd);
+      }
     }
 
-    // ugh, streamed files. have to handle these carefully
-    // otherwise, should be accurate
-    if (localFileHeader.Flags & 8)
+    const byte* pSpan = pArchiveMemory;
+    uint32 spanBatchOffset = pBatchBuffer->GetSize();
+    if (pSpan == NULL)
     {
-      if (pSourceEntry->CRC32 == 0)
+      uint32 spanSize = (uint32)(spanEnd - spanStart);
+      pBatchBuffer->Resize(spanBatchOffset + spanSize);
+      if (!m_pReadStream->SeekAbsolute(spanStart) ||
+          !m_pReadStream->Read2(pBatchBuffer->GetBasePointer() + spanBatchOffset, spanSize))
       {
-        pDestinationEntry->IsDeleted = true;
-        return false;
+        // whatever's wrong, reading them one at a time says what
+        for (; index < spanEndIndex; index++)
+          pSingles->Add(files[index].Index);
+
+        pBatchBuffer->Resize(spanBatchOffset);
+        continue;
       }
 
-      // pull from central directory, and strip the streamed flag from it, since we're not going to append the
-      // post-header
-      localFileHeader.CRC32 = pSourceEntry->CRC32;
-      localFileHeader.CompressedSize = pSourceEntry->CompressedFileSize;
-      localFileHeader.DecompressedSize = pSourceEntry->DecompressedFileSize;
-      localFileHeader.Flags &= ~(uint16)8;
+      pSpan = pBatchBuffer->GetBasePointer() + spanBatchOffset;
     }
-    else if (localFileHeader.CompressedSize != pSourceEntry->CompressedFileSize ||
-             localFileHeader.DecompressedSize != pSourceEntry->DecompressedFileSize)
+
+    // the headers are read from the span, files whose extra field ran past it are read on their own
+    ReadOnlyMemoryByteStream* pSpanStream =
+      ByteStream_CreateReadOnlyMemoryStream(pSpan, (size_t)(spanEnd - spanStart));
+    for (; index < spanEndIndex; index++)
     {
-      pDestinationEntry->IsDeleted = true;
-      return false;
+      BatchFile file = files[index];
+      FileLocation location = *file.pLocation;
+      location.OffsetToFileHeader -= spanStart;
+      if (!ReadLocalFileHeader(pSpanStream, &location, &file.LocalFileHeader) ||
+          pSpanStream->GetPosition() + file.LocalFileHeader.CompressedSize > spanEnd - spanStart)
+      {
+        pSingles->Add(file.Index);
+        continue;
+      }
+
+      file.pData = (pArchiveMemory != NULL) ? (pArchiveMemory + pSpanStream->GetPosition()) : NULL;
+      pBatch->Add(file);
+      batchOffsets.Add(spanBatchOffset + (uint32)pSpanStream->GetPosition());
     }
 
-    uint32 seekDistance = (uint32)localFileHeader.FilenameLength + (uint32)localFileHeader.ExtraFieldLength;
-    if (!pSourceStream->SeekRelative(seekDistance))
+    pSpanStream->Release();
+  }
+
+  for (uint32 i = 0; i < pBatch->GetSize(); i++)
+  {
+    if ((*pBatch)[i].pData == NULL)
+      (*pBatch)[i].pData = pBatchBuffer->GetBasePointer() + batchOffsets[i];
+  }
+
+  return index;
+}
+
+uint32 ZipArchive::OpenFiles(const char* const* filenames, uint32 count, ByteStream** ppStreams,
+                             ThreadPool* pThreadPool /* = NULL */)
+{
+  Y_PROFILE_ZONE("ZipArchive::OpenFiles");
+
+  // files in the read stream are read together, the rest are opened one at a time at the end
+  PODArray<BatchFile> files;
+  PODArray<uint32> singles;
+  for (uint32 i = 0; i < count; i++)
+  {
+    ppStreams[i] = NULL;
+
+    ByteStream* pStream;
+    const FileLocation* pLocation = FindReadableFile(filenames[i], &pStream);
+    if (pLocation == NULL)
+      continue;
+
+    if (pStream != m_pReadStream || pLocation->CompressedFileSize >= ZIP_BULK_BATCH_SIZE ||
+        pLocation->DecompressedFileSize > 0xFFFFFFFFULL)
+    {
+      singles.Add(i);
+      continue;
+    }
+
+    BatchFile file;
+    file.Index = i;
+    file.pLocation = pLocation;
+    file.NameLength = Y_strlen(filenames[i]);
+    file.pData = NULL;
+    file.pBuffer = NULL;
+    file.Result = false;
+    files.Add(file);
+  }
+
+  files.Sort(&BatchFile::CompareOffsets);
+
+  bool inMemory = (m_pReadStream != NULL && m_pReadStream->GetBasePointer() != NULL);
+  PODArray<BatchFile> batch;
+  PODArray<byte> batchBuffer;
+  uint32 openedCount = 0;
+  uint32 index = 0;
+  while (index < files.GetSize())
+  {
+    index = ReadBatch(files, index, &batchBuffer, &batch, &singles);
+
+    ParallelFor(pThreadPool, 0, batch.GetSize(), 1, [&batch, filenames, inMemory](uint32 batchIndex) {
+      Y_PROFILE_ZONE("ZipArchive::DecodeFileData");
+      BatchFile& file = batch[batchIndex];
+      file.Result = DecodeFileData("ZipArchive::OpenFiles", filenames[file.Index], &file.LocalFileHeader,
+                                   file.pData, &file.pBuffer);
+
+      // stored files are copied out of the batch buffer, which is about to be reused
+      uint32 size = (uint32)file.LocalFileHeader.DecompressedSize;
+      if (file.Result && file.pBuffer == NULL && !inMemory)
+      {
+        file.pBuffer = new byte[Max(size, (uint32)1)];
+        std::memcpy(file.pBuffer, file.pData, size);
+      }
+    });
+
+    // the streams count themselves against the archive, so are created here
+    for (uint32 i = 0; i < batch.GetSize(); i++)
+    {
+      const BatchFile& file = batch[i];
+      if (!file.Result)
+        continue;
+
+      ZipArchiveBufferedReadByteStream* pReaderStream = new ZipArchiveBufferedReadByteStream(this);
+      uint32 size = (uint32)file.LocalFileHeader.DecompressedSize;
+      if (file.pBuffer != NULL)
+        pReaderStream->SetData(file.pBuffer, size, NULL);
+      else
+        pReaderStream->SetData(file.pData, size, m_pReadStream);
+
+      ppStreams[file.Index] = pReaderStream;
+      openedCount++;
+    }
+  }
+
+  for (uint32 i = 0; i < singles.GetSize(); i++)
+  {
+    uint32 fileIndex = singles[i];
+    ppStreams[fileIndex] = OpenFile(filenames[fileIndex], BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_SEEKABLE);
+    if (ppStreams[fileIndex] != NULL)
+      openedCount++;
+  }
+
+  return openedCount;
+}
+
+// Checks a file's data held in memory against its CRC. Stored files are checked where they are and deflated ones
+// inflated a window at a time, only Zstandard frames, which are decompressed whole, need a buffer. Called from the
+// workers.
+static bool VerifyFileData(const ZIP_ARCHIVE_LOCAL_FILE_HEADER* pLocalFileHeader, const byte* pData)
+{
+  uint32 size = (uint32)pLocalFileHeader->DecompressedSize;
+  CRC32 crc;
+  if (pLocalFileHeader->CompressionMethod == 0)
+  {
+    crc.HashBytes(pData, size);
+  }
+  else if (pLocalFileHeader->CompressionMethod == Z_DEFLATED)
+  {
+    z_stream* pZStream = s_zStreamPool.AcquireInflateStream();
+    if (pZStream == NULL)
+      Panic("inflateInit2 failed");
+
+    z_stream& zStream = *pZStream;
+    zStream.next_in = (Bytef*)pData;
+    zStream.avail_in = (uInt)pLocalFileHeader->CompressedSize;
+
+    byte window[ZIP_STREAM_BUFFER_SIZE];
+    int status;
+    do
+    {
+      zStream.next_out = (Bytef*)window;
+      zStream.avail_out = sizeof(window);
+      status = inflate(&zStream, Z_NO_FLUSH);
+      crc.HashBytes(window, sizeof(window) - zStream.avail_out);
+    } while (status == Z_OK && zStream.total_out <= size);
+
+    uLong decompressedSize = zStream.total_out;
+    s_zStreamPool.ReleaseInflateStream(pZStream);
+    if (status != Z_STREAM_END || decompressedSize != size)
+      return false;
+  }
+  else if (pLocalFileHeader->CompressionMethod == ZIP_COMPRESSION_METHOD_ZSTD)
+  {
+    PODArray<byte> buffer;
+    buffer.Resize(Max(size, (uint32)1));
+    uint32 decompressedSize;
+    if (!Compression::DecompressBuffer(COMPRESSION_CODEC_ZSTD, buffer.GetBasePointer(), size, &decompressedSize,
+                                       pData, (uint32)pLocalFileHeader->CompressedSize) ||
+        decompressedSize != size)
     {
-      pDestinationEntry->IsDeleted = true;
       return false;
     }
 
-    // write the local file header to the write stream
-    BinaryWriter binaryWriter(m_pWriteStream, ENDIAN_TYPE_LITTLE);
-    uint32 filenameLength = Min(pSourceEntry->FileName.GetLength(), (uint32)0xFFFF);
-    if (!binaryWriter.SafeWriteUInt32(localFileHeader.Signature) ||                 // Signature
-        !binaryWriter.SafeWriteUInt16(localFileHeader.VersionRequiredToExtract) ||  // VersionRequiredToExtract
-        !binaryWriter.SafeWriteUInt16(localFileHeader.Flags) ||                     // Flags
-        !binaryWriter.SafeWriteUInt16(localFileHeader.CompressionMethod) ||         // CompressionMethod
-        !binaryWriter.SafeWriteUInt32(localFileHeader.ModificationTimestamp) ||     // ModificationTimestamp
-        !binaryWriter.SafeWriteUInt32(localFileHeader.CRC32) ||                     // CRC32
-        !binaryWriter.SafeWriteUInt32((uint32)localFileHeader.CompressedSize) ||    // CompressedSize
-        !binaryWriter.SafeWriteUInt32((uint32)localFileHeader.DecompressedSize) ||  // DecompressedSize
-        !binaryWriter.SafeWriteUInt16((uint16)filenameLength) ||                    // FilenameLength
-        !binaryWriter.SafeWriteUInt16(0) ||                                         // ExtraFieldLength
-        !binaryWriter.SafeWriteFixedString(pSourceEntry->FileName, filenameLength)) // Filename
+    crc.HashBytes(buffer.GetBasePointer(), size);
+  }
+  else
+  {
+    return false;
+  }
+
+  return (crc.GetCRC() == pLocalFileHeader->CRC32);
+}
+
+bool ZipArchive::VerifyFile(const FileLocation* pLocation)
+{
+  ZIP_ARCHIVE_LOCAL_FILE_HEADER localFileHeader;
+  if (!ReadLocalFileHeader(m_pReadStream, pLocation, &localFileHeader))
+    return false;
+
+  // Zstandard frames are only decompressed whole, which checks them
+  if (localFileHeader.CompressionMethod == ZIP_COMPRESSION_METHOD_ZSTD)
+  {
+    ZipArchiveBufferedReadByteStream* pFileStream = new ZipArchiveBufferedReadByteStream(this);
+    bool result = pFileStream->FillBuffer(m_pReadStream, m_pReadStream->GetPosition(), &localFileHeader);
+    pFileStream->Release();
+    return result;
+  }
+
+  // reading to the end checks the CRC
+  ZipArchiveStreamedReadByteStream* pFileStream =
+    new ZipArchiveStreamedReadByteStream(this, m_pReadStream, m_pReadStream->GetPosition(), &localFileHeader);
+  byte buffer[ZIP_STREAM_BUFFER_SIZE];
+  uint64 remaining = localFileHeader.DecompressedSize;
+  bool result = true;
+  while (result && remaining > 0)
+  {
+    uint32 readSize = (uint32)Min(remaining, (uint64)sizeof(buffer));
+    result = pFileStream->Read2(buffer, readSize);
+    remaining -= (uint64)readSize;
+  }
+
+  result = result && pFileStream->Read(buffer, 1) == 0 && !pFileStream->InErrorState();
+  pFileStream->Release();
+  return result;
+}
+
+bool ZipArchive::VerifyAll(ThreadPool* pThreadPool /* = NULL */,
+                           ProgressCallbacks* pProgressCallbacks /* = ProgressCallbacks::NullProgressCallback */)
+{
+  Y_PROFILE_ZONE("ZipArchive::VerifyAll");
+
+  // files too big for a batch are checked one at a time at the end
+  uint32 count = m_readIndex.GetEntryCount();
+  PODArray<BatchFile> files;
+  PODArray<uint32> singles;
+  for (uint32 i = 0; i < count; i++)
+  {
+    const ReadIndex::Entry& entry = m_readIndex.GetEntry(i);
+    if (entry.Location.CompressedFileSize >= ZIP_BULK_BATCH_SIZE || entry.Location.DecompressedFileSize > 0xFFFFFFFFULL)
     {
-      pDestinationEntry->IsDeleted = true;
+      singles.Add(i);
+      continue;
+    }
+
+    BatchFile file;
+    file.Index = i;
+    file.pLocation = &entry.Location;
+    file.NameLength = entry.NameLength;
+    file.pData = NULL;
+    file.pBuffer = NULL;
+    file.Result = false;
+    files.Add(file);
+  }
+
+  files.Sort(&BatchFile::CompareOffsets);
+
+  pProgressCallbacks->SetProgressRange(count);
+  pProgressCallbacks->SetProgressValue(0);
+
+  PODArray<BatchFile> batch;
+  PODArray<byte> batchBuffer;
+  uint32 failedCount = 0;
+  uint32 index = 0;
+  uint32 checkedCount = 0;
+  while (index < files.GetSize())
+  {
+    if (pProgressCallbacks->IsCancelled())
       return false;
+
+    index = ReadBatch(files, index, &batchBuffer, &batch, &singles);
+
+    ParallelFor(pThreadPool, 0, batch.GetSize(), 1, [&batch](uint32 batchIndex) {
+      Y_PROFILE_ZONE("ZipArchive::VerifyFileData");
+      BatchFile& file = batch[batchIndex];
+      file.Result = VerifyFileData(&file.LocalFileHeader, file.pData);
+    });
+
+    for (uint32 i = 0; i < batch.GetSize(); i++)
+    {
+      if (!batch[i].Result)
+      {
+        pProgressCallbacks->DisplayFormattedError("'%s' fails its CRC check", m_readIndex.GetEntryName(batch[i].Index));
+        failedCount++;
+      }
     }
+
+    checkedCount += batch.GetSize();
+    pProgressCallbacks->SetProgressValue(checkedCount);
   }
 
-  // read+write chunks
-  static const uint32 CHUNKSIZE = 4096;
-  byte chunkBuffer[CHUNKSIZE];
-  uint64 remaining = pSourceEntry->CompressedFileSize;
-  while (remaining > 0)
+  for (uint32 i = 0; i < singles.GetSize(); i++)
   {
-    uint32 copySize = (uint32)Min(remaining, (uint64)CHUNKSIZE);
+    if (pProgressCallbacks->IsCancelled())
+      return false;
+
+    uint32 entryIndex = singles[i];
+    if (!VerifyFile(&m_readIndex.GetEntry(entryIndex).Location))
+    {
+      pProgressCallbacks->DisplayFormattedError("'%s' could not be read or fails its CRC check",
+                                                m_readIndex.GetEntryName(entryIndex));
+      failedCount++;
+    }
+
+    pProgressCallbacks->SetProgressValue(++checkedCount);
+  }
+
+  return (failedCount == 0);
+}
+
+bool ZipArchive::CopyFile(ZipArchive* pOtherArchive, const char* filename)
+{
+  if (m_pWriteStream == NULL)
+    return false;
+
+  const FileHashTable::Member* pSourceMember;
+  uint32 sourceReadIndex;
+  ByteStream* pSourceStream;
+  const FileLocation* pSourceEntry;
+  const char* sourceFileName;
+  Timestamp sourceModifiedTime;
+
+  pSourceMember = pOtherArchive->m_writeFileHashTable.Find(filename);
+  if (pSourceMember == NULL)
+  {
+    if ((sourceReadIndex = pOtherArchive->m_readIndex.Find(filename)) != ReadIndex::InvalidEntry)
+    {
+      const ReadIndex::Entry& sourceReadEntry = pOtherArchive->m_readIndex.GetEntry(sourceReadIndex);
+      pSourceStream = pOtherArchive->m_pReadStream;
+      pSourceEntry = &sourceReadEntry.Location;
+      sourceFileName = pOtherArchive->m_readIndex.GetEntryName(sourceReadIndex);
+      sourceModifiedTime = ZipTimeToTimestamp(sourceReadEntry.ModifiedTime);
+    }
+    else
+    {
+      return false;
+    }
+  }
+  else
+  {
+    pSourceStream = pOtherArchive->m_pWriteStream;
+    pSourceEntry = pSourceMember->Value;
+    sourceFileName = pSourceMember->Value->FileName;
+    sourceModifiedTime = pSourceMember->Value->ModifiedTime;
+  }
+
+  // find offset that we are writing to
+  if (!m_pWriteStream->SeekToEnd())
+    return false;
 
-    // read it
-    uint32 bytesRead = pSourceStream->Read(chunkBuffer, copySize);
-    if (bytesRead != copySize)
-    {
-      // io error
+  // create in file table
+  FileHashTable::Member* pDestinationMember = m_writeFileHashTable.Find(sourceFileName);
+  if (pDestinationMember != NULL)
+  {
+    if (pDestinationMember->Value->WriteOpenCount > 0)
       return false;
-    }
+  }
+  else
+  {
+    FileEntry* pFileEntry = new FileEntry;
+    pDestinationMember = m_writeFileHashTable.Insert(sourceFileName, pFileEntry);
+    AddToFindTrie(sourceFileName);
+  }
 
-    // write it
-    uint32 bytesWritten = m_pWriteStream->Write(chunkBuffer, copySize);
-    if (bytesWritten != copySize)
-    {
-      // io error
-      return false;
-    }
+  // fill file entry
+  FileEntry* pDestinationEntry = pDestinationMember->Value;
+  pDestinationEntry->FileName = sourceFileName;
+  pDestinationEntry->CompressionMethod = pSourceEntry->CompressionMethod;
+  pDestinationEntry->ModifiedTime = sourceModifiedTime;
+  pDestinationEntry->CRC32 = pSourceEntry->CRC32;
+  pDestinationEntry->OffsetToFileHeader = m_pWriteStream->GetPosition();
+  pDestinationEntry->CompressedFileSize = pSourceEntry->CompressedFileSize;
+  pDestinationEntry->DecompressedFileSize = pSourceEntry->DecompressedFileSize;
+  pDestinationEntry->IsDeleted = false;
+  pDestinationEntry->WriteOpenCount = 0;
 
-    remaining -= (uint64)copySize;
+  // copy the local header and data
+  uint32 filenameLength = Min(pDestinationEntry->FileName.GetLength(), (uint32)0xFFFF);
+  if (!CopyLocalFile(pSourceStream, pSourceEntry, m_pWriteStream, pDestinationEntry->FileName, filenameLength))
+  {
+    pDestinationEntry->IsDeleted = true;
+    return false;
   }
 
   // all good
@@ -1663,12 +3241,15 @@ bool ZipArchive::UpgradeToWritableArchive(ByteStream* pWriteStream)
   return true;
 }
 
-bool ZipArchive::ParseZip()
+// finds the end of central directory record, which is followed only by the archive's comment, and the ZIP64 one
+// if its fields are saturated
+static bool ReadEndOfCentralDirectory(ByteStream* pStream, uint64* pRecordCount, uint64* pCentralDirectorySize,
+                                      uint64* pCentralDirectoryOffset)
 {
-  BinaryReader binaryReader(m_pReadStream, ENDIAN_TYPE_LITTLE);
+  BinaryReader binaryReader(pStream, ENDIAN_TYPE_LITTLE);
 
   // start at the end of the file - 4
-  if (!m_pReadStream->SeekToEnd() || !m_pReadStream->SeekRelative(-4))
+  if (!pStream->SeekToEnd() || !pStream->SeekRelative(-4))
     return false;
 
   // find the end of central directory record
@@ -1679,10 +3260,12 @@ bool ZipArchive::ParseZip()
     if (signature == ZIP_ARCHIVE_END_OF_CENTRAL_DIRECTORY_SIGNATURE)
       break;
 
-    if (!m_pReadStream->SeekRelative(-5))
+    if (!pStream->SeekRelative(-5))
       return false;
   }
 
+  uint64 endOfCentralDirectoryOffset = pStream->GetPosition() - 4;
+
   // got it, so pull out the fields
   uint16 diskNumber;
   uint16 centralDirectoryDisk;
@@ -1704,206 +3287,253 @@ bool ZipArchive::ParseZip()
   // multi-disk archives are not supported
   if (centralDirectoryDisk != 0 || centralDirectoryRecordsOnThisDisk != centralDirectoryTotalRecords)
   {
-    Log_ErrorPrintf("ZipArchive::ParseZip: Multi-disk archives are unsupported.");
+    Log_ErrorPrintf("ZipArchive: Multi-disk archives are unsupported.");
+    return false;
+  }
+
+  *pRecordCount = centralDirectoryTotalRecords;
+  *pCentralDirectorySize = centralDirectorySize;
+  *pCentralDirectoryOffset = centralDirectoryOffset;
+  if ((centralDirectoryTotalRecords != ZIP_ARCHIVE_ZIP64_RECORD_LIMIT &&
+       centralDirectorySize != ZIP_ARCHIVE_ZIP64_LIMIT && centralDirectoryOffset != ZIP_ARCHIVE_ZIP64_LIMIT) ||
+      endOfCentralDirectoryOffset < ZIP_ARCHIVE_ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIZE)
+  {
+    return true;
+  }
+
+  // the values could be real, so without a locator they're used as they are
+  uint32 locatorSignature;
+  uint32 zip64Disk;
+  uint64 zip64EndOfCentralDirectoryOffset;
+  uint32 diskCount;
+  if (!pStream->SeekAbsolute(endOfCentralDirectoryOffset - ZIP_ARCHIVE_ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIZE) ||
+      !binaryReader.SafeReadUInt32(&locatorSignature) || !binaryReader.SafeReadUInt32(&zip64Disk) ||
+      !binaryReader.SafeReadUInt64(&zip64EndOfCentralDirectoryOffset) || !binaryReader.SafeReadUInt32(&diskCount))
+  {
     return false;
   }
 
-  // go to the central directory
-  if (!m_pReadStream->SeekAbsolute(centralDirectoryOffset))
+  if (locatorSignature != ZIP_ARCHIVE_ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE)
+    return true;
+
+  uint32 zip64Signature;
+  uint64 zip64RecordSize;
+  uint16 versionMadeBy;
+  uint16 versionToExtract;
+  uint32 zip64DiskNumber;
+  uint32 zip64CentralDirectoryDisk;
+  uint64 zip64RecordsOnThisDisk;
+  uint64 zip64TotalRecords;
+  if (!pStream->SeekAbsolute(zip64EndOfCentralDirectoryOffset) || !binaryReader.SafeReadUInt32(&zip64Signature) ||
+      !binaryReader.SafeReadUInt64(&zip64RecordSize) || !binaryReader.SafeReadUInt16(&versionMadeBy) ||
+      !binaryReader.SafeReadUInt16(&versionToExtract) || !binaryReader.SafeReadUInt32(&zip64DiskNumber) ||
+      !binaryReader.SafeReadUInt32(&zip64CentralDirectoryDisk) ||
+      !binaryReader.SafeReadUInt64(&zip64RecordsOnThisDisk) || !binaryReader.SafeReadUInt64(&zip64TotalRecords) ||
+      !binaryReader.SafeReadUInt64(pCentralDirectorySize) || !binaryReader.SafeReadUInt64(pCentralDirectoryOffset) ||
+      zip64Signature != ZIP_ARCHIVE_ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE)
+  {
+    Log_ErrorPrintf("ZipArchive: ZIP64 end of central directory record is missing.");
     return false;
+  }
 
-  // parse the central directory
-  for (uint16 i = 0; i < centralDirectoryTotalRecords; i++)
+  if (diskCount > 1 || zip64CentralDirectoryDisk != 0 || zip64RecordsOnThisDisk != zip64TotalRecords)
   {
-    uint32 fileSignature;
-    uint16 versionMadeBy;
-    uint16 versionExtract;
-    uint16 bitFlags;
-    uint16 compressionMethod;
-    uint32 modificationTimestamp;
-    uint32 crc;
-    uint32 compressedSize;
-    uint32 uncompressedSize;
-    uint16 filenameLength;
-    uint16 extraFieldLength;
-    uint16 fileCommentLength;
-    uint16 diskNumberCD;
-    uint16 internalFileAttributes;
-    uint32 externalFileAttributes;
-    uint32 fileHeaderOffset;
-    String fileName;
-
-    if (!binaryReader.SafeReadUInt32(&fileSignature) || !binaryReader.SafeReadUInt16(&versionMadeBy) ||
-        !binaryReader.SafeReadUInt16(&versionExtract) || !binaryReader.SafeReadUInt16(&bitFlags) ||
-        !binaryReader.SafeReadUInt16(&compressionMethod) || !binaryReader.SafeReadUInt32(&modificationTimestamp) ||
-        !binaryReader.SafeReadUInt32(&crc) || !binaryReader.SafeReadUInt32(&compressedSize) ||
-        !binaryReader.SafeReadUInt32(&uncompressedSize) || !binaryReader.SafeReadUInt16(&filenameLength) ||
-        !binaryReader.SafeReadUInt16(&extraFieldLength) || !binaryReader.SafeReadUInt16(&fileCommentLength) ||
-        !binaryReader.SafeReadUInt16(&diskNumberCD) || !binaryReader.SafeReadUInt16(&internalFileAttributes) ||
-        !binaryReader.SafeReadUInt32(&externalFileAttributes) || !binaryReader.SafeReadUInt32(&fileHeaderOffset) ||
-        !binaryReader.SafeReadFixedString(filenameLength, &fileName))
+    Log_ErrorPrintf("ZipArchive: Multi-disk archives are unsupported.");
+    return false;
+  }
+
+  *pRecordCount = zip64TotalRecords;
+  return true;
+}
+
+bool ZipArchive::ParseZip()
+{
+  Y_PROFILE_ZONE("ZipArchive::ParseZip");
+  uint64 centralDirectoryRecords;
+  uint64 centralDirectorySize;
+  uint64 centralDirectoryOffset;
+  if (!ReadEndOfCentralDirectory(m_pReadStream, &centralDirectoryRecords, &centralDirectorySize,
+                                 &centralDirectoryOffset))
+  {
+    return false;
+  }
+
+  // ZIP64 counts and sizes are checked before anything is allocated for them
+  if (centralDirectorySize > 0x7FFFFFFF ||
+      centralDirectoryRecords > (centralDirectorySize / ZIP_ARCHIVE_CENTRAL_DIRECTORY_FILE_HEADER_SIZE))
+  {
+    Log_ErrorPrintf("ZipArchive::ParseZip: Central directory of %llu bytes can't hold %llu files",
+                    (unsigned long long)centralDirectorySize, (unsigned long long)centralDirectoryRecords);
+    return false;
+  }
+
+  // the central directory is parsed from memory, in place if the archive is in memory
+  const byte* pCentralDirectory = m_pReadStream->GetBasePointer();
+  PODArray<byte> centralDirectoryData;
+  if (pCentralDirectory != NULL)
+  {
+    if ((centralDirectoryOffset + centralDirectorySize) > m_pReadStream->GetSize())
+      return false;
+
+    pCentralDirectory += centralDirectoryOffset;
+  }
+  else
+  {
+    centralDirectoryData.Resize((uint32)centralDirectorySize);
+    if (!m_pReadStream->SeekAbsolute(centralDirectoryOffset) ||
+        !m_pReadStream->Read2(centralDirectoryData.GetBasePointer(), (uint32)centralDirectorySize))
     {
       return false;
     }
 
-    if (fileSignature != ZIP_ARCHIVE_CENTRAL_DIRECTORY_FILE_HEADER_SIGNATURE)
+    pCentralDirectory = centralDirectoryData.GetBasePointer();
+  }
+
+  // names can't be longer than the directory
+  m_readIndex.BeginBuild((uint32)centralDirectoryRecords, (uint32)centralDirectorySize);
+  ResetFindTrie();
+
+  uint32 position = 0;
+  for (uint32 i = 0; i < centralDirectoryRecords; i++)
+  {
+    if ((centralDirectorySize - position) < ZIP_ARCHIVE_CENTRAL_DIRECTORY_FILE_HEADER_SIZE)
+      return false;
+
+    const byte* pHeader = pCentralDirectory + position;
+    if (ReadLittleEndianUInt32(pHeader) != ZIP_ARCHIVE_CENTRAL_DIRECTORY_FILE_HEADER_SIGNATURE)
       return false;
 
-    if (((uint32)extraFieldLength + (uint32)fileCommentLength) > 0 &&
-        !m_pReadStream->SeekRelative((uint32)extraFieldLength + (uint32)fileCommentLength))
+    uint32 filenameLength = ReadLittleEndianUInt16(pHeader + 28);
+    uint32 extraFieldLength = ReadLittleEndianUInt16(pHeader + 30);
+    uint32 fileCommentLength = ReadLittleEndianUInt16(pHeader + 32);
+    uint32 recordSize =
+      ZIP_ARCHIVE_CENTRAL_DIRECTORY_FILE_HEADER_SIZE + filenameLength + extraFieldLength + fileCommentLength;
+    if ((centralDirectorySize - position) < recordSize)
       return false;
 
-    if (m_readFileHashTable.Find(fileName) != NULL)
+    FileLocation location;
+    location.CompressionMethod = ReadLittleEndianUInt16(pHeader + 10);
+    location.CRC32 = ReadLittleEndianUInt32(pHeader + 16);
+    location.CompressedFileSize = (uint64)ReadLittleEndianUInt32(pHeader + 20);
+    location.DecompressedFileSize = (uint64)ReadLittleEndianUInt32(pHeader + 24);
+    location.OffsetToFileHeader = (uint64)ReadLittleEndianUInt32(pHeader + 42);
+    if ((location.DecompressedFileSize == ZIP_ARCHIVE_ZIP64_LIMIT ||
+         location.CompressedFileSize == ZIP_ARCHIVE_ZIP64_LIMIT ||
+         location.OffsetToFileHeader == ZIP_ARCHIVE_ZIP64_LIMIT) &&
+        !ReadZip64ExtraField(pHeader + ZIP_ARCHIVE_CENTRAL_DIRECTORY_FILE_HEADER_SIZE + filenameLength,
+                             extraFieldLength, false, &location.DecompressedFileSize, &location.CompressedFileSize,
+                             &location.OffsetToFileHeader))
     {
-      Log_WarningPrintf("ZipArchive::ParseZip: Duplicate file name in zip: '%s'.", fileName.GetCharArray());
-      continue;
+      return false;
     }
 
-    FileEntry* pFileEntry = new FileEntry;
-    pFileEntry->FileName = fileName;
-    pFileEntry->CompressionMethod = compressionMethod;
-    pFileEntry->ModifiedTime = ZipTimeToTimestamp(modificationTimestamp);
-    pFileEntry->CRC32 = crc;
-    pFileEntry->OffsetToFileHeader = (uint64)fileHeaderOffset;
-    pFileEntry->CompressedFileSize = (uint64)compressedSize;
-    pFileEntry->DecompressedFileSize = (uint64)uncompressedSize;
-    pFileEntry->IsDeleted = false;
-    pFileEntry->WriteOpenCount = 0;
-    m_readFileHashTable.Insert(pFileEntry->FileName, pFileEntry);
+    const char* fileName = reinterpret_cast<const char*>(pHeader + ZIP_ARCHIVE_CENTRAL_DIRECTORY_FILE_HEADER_SIZE);
+    if (!m_readIndex.AddEntry(fileName, filenameLength, location, ReadLittleEndianUInt32(pHeader + 12)))
+      Log_WarningPrintf("ZipArchive::ParseZip: Duplicate file name in zip: '%.*s'.", filenameLength, fileName);
+
+    position += recordSize;
+  }
+
+  return true;
+}
+
+bool ZipArchive::GetIndexKey(ZIP_ARCHIVE_INDEX_HEADER* pHeader) const
+{
+  uint64 centralDirectoryRecords;
+  uint64 centralDirectorySize;
+  uint64 centralDirectoryOffset;
+  if (m_pReadStream == NULL ||
+      !ReadEndOfCentralDirectory(m_pReadStream, &centralDirectoryRecords, &centralDirectorySize,
+                                 &centralDirectoryOffset) ||
+      centralDirectoryRecords > 0xFFFFFFFFULL)
+  {
+    return false;
+  }
+
+  byte tail[ZIP_ARCHIVE_INDEX_TAIL_SIZE];
+  uint32 tailSize = (uint32)Min(centralDirectorySize, (uint64)ZIP_ARCHIVE_INDEX_TAIL_SIZE);
+  if (!m_pReadStream->SeekAbsolute(centralDirectoryOffset + centralDirectorySize - tailSize) ||
+      !m_pReadStream->Read2(tail, tailSize))
+  {
+    return false;
+  }
+
+  Y_memzero(pHeader, sizeof(ZIP_ARCHIVE_INDEX_HEADER));
+  pHeader->ArchiveSize = m_pReadStream->GetSize();
+  pHeader->CentralDirectoryOffset = centralDirectoryOffset;
+  pHeader->CentralDirectorySize = centralDirectorySize;
+  pHeader->CentralDirectoryRecords = (uint32)centralDirectoryRecords;
+  pHeader->CentralDirectoryTailCRC32 = (uint32)crc32(0, tail, tailSize);
+  return true;
+}
+
+bool ZipArchive::LoadIndex(ByteStream* pIndexStream)
+{
+  ZIP_ARCHIVE_INDEX_HEADER header;
+  ResetFindTrie();
+  if (!GetIndexKey(&header) || !m_readIndex.Load(pIndexStream, &header))
+  {
+    Log_DevPrintf("ZipArchive::LoadIndex: Index is out of date or damaged, reading the central directory");
+    return false;
   }
 
+  m_indexLoaded = true;
   return true;
 }
 
+bool ZipArchive::SaveIndex(ByteStream* pStream) const
+{
+  ZIP_ARCHIVE_INDEX_HEADER header;
+  if (!GetIndexKey(&header))
+    return false;
+
+  return m_readIndex.Save(pStream, &header);
+}
+
 bool ZipArchive::CommitChanges()
 {
+  Y_PROFILE_ZONE("ZipArchive::CommitChanges");
   DebugAssert(m_pWriteStream != NULL);
 
   // ensure there are no open writes
   if ((m_nOpenStreamedReads + m_nOpenStreamedWrites + m_nOpenBufferedWrites) > 0)
     return false;
 
+  // appending with nothing changed would only add another central directory
+  bool appending = IsAppending();
+  if (appending && m_writeFileHashTable.GetMemberCount() == 0 && !m_readIndex.HasDeletedEntries())
+    return true;
+
   // start writing at the end
   if (!m_pWriteStream->SeekToEnd())
     return false;
 
   // any files that are located in the read stream, but not in the write stream, now need to be written to the write
-  // stream
-  for (FileHashTable::Iterator itr = m_readFileHashTable.Begin(); !itr.AtEnd(); itr.Forward())
+  // stream, or when appending, stay where they are and are listed in the new central directory
+  for (uint32 readIndex = 0; readIndex < m_readIndex.GetEntryCount(); readIndex++)
   {
-    const FileEntry* pFileEntry = itr->Value;
-    if (pFileEntry->IsDeleted || m_writeFileHashTable.Find(itr->Key) != NULL)
+    const char* fileName = m_readIndex.GetEntryName(readIndex);
+    if (m_readIndex.IsEntryDeleted(readIndex) || m_writeFileHashTable.Find(fileName) != NULL)
       continue;
 
-    if (!m_pReadStream->SeekAbsolute(pFileEntry->OffsetToFileHeader))
-      return false;
-
-    // store the starting offset
-    uint64 newStartingOffset = m_pWriteStream->GetPosition();
-    {
-      BinaryReader binaryReader(m_pReadStream);
-
-      ZIP_ARCHIVE_LOCAL_FILE_HEADER localFileHeader;
-      uint32 compressedSize32;
-      uint32 decompressedSize32;
-      if (!binaryReader.SafeReadUInt32(&localFileHeader.Signature) ||
-          !binaryReader.SafeReadUInt16(&localFileHeader.VersionRequiredToExtract) ||
-          !binaryReader.SafeReadUInt16(&localFileHeader.Flags) ||
-          !binaryReader.SafeReadUInt16(&localFileHeader.CompressionMethod) ||
-          !binaryReader.SafeReadUInt32(&localFileHeader.ModificationTimestamp) ||
-          !binaryReader.SafeReadUInt32(&localFileHeader.CRC32) || !binaryReader.SafeReadUInt32(&compressedSize32) ||
-          !binaryReader.SafeReadUInt32(&decompressedSize32) ||
-          !binaryReader.SafeReadUInt16(&localFileHeader.FilenameLength) ||
-          !binaryReader.SafeReadUInt16(&localFileHeader.ExtraFieldLength))
-      {
-        return false;
-      }
-
-      localFileHeader.CompressedSize = (uint64)compressedSize32;
-      localFileHeader.DecompressedSize = (uint64)decompressedSize32;
-
-      if (localFileHeader.Signature != ZIP_ARCHIVE_LOCAL_FILE_HEADER_SIGNTURE)
-        return false;
-
-      // only handling deflate at the moment
-      if (localFileHeader.CompressionMethod != 0 && localFileHeader.CompressionMethod != Z_DEFLATED)
-        return false;
-
-      // ugh, streamed files. have to handle these carefully
-      // otherwise, should be accurate
-      if (localFileHeader.Flags & 8)
-      {
-        if (pFileEntry->CRC32 == 0)
-          return false;
-
-        // pull from central directory, and strip the streamed flag from it, since we're not going to append the
-        // post-header
-        localFileHeader.CRC32 = pFileEntry->CRC32;
-        localFileHeader.CompressedSize = pFileEntry->CompressedFileSize;
-        localFileHeader.DecompressedSize = pFileEntry->DecompressedFileSize;
-        localFileHeader.Flags &= ~(uint16)8;
-      }
-      else if (localFileHeader.CompressedSize != pFileEntry->CompressedFileSize ||
-               localFileHeader.DecompressedSize != pFileEntry->DecompressedFileSize)
-      {
-        return false;
-      }
-
-      uint32 seekDistance = (uint32)localFileHeader.FilenameLength + (uint32)localFileHeader.ExtraFieldLength;
-      if (!m_pReadStream->SeekRelative(seekDistance))
-        return false;
-
-      // write the local file header to the write stream
-      BinaryWriter binaryWriter(m_pWriteStream, ENDIAN_TYPE_LITTLE);
-      uint32 filenameLength = Min(pFileEntry->FileName.GetLength(), (uint32)0xFFFF);
-      if (!binaryWriter.SafeWriteUInt32(localFileHeader.Signature) ||                // Signature
-          !binaryWriter.SafeWriteUInt16(localFileHeader.VersionRequiredToExtract) || // VersionRequiredToExtract
-          !binaryWriter.SafeWriteUInt16(localFileHeader.Flags) ||                    // Flags
-          !binaryWriter.SafeWriteUInt16(localFileHeader.CompressionMethod) ||        // CompressionMethod
-          !binaryWriter.SafeWriteUInt32(localFileHeader.ModificationTimestamp) ||    // ModificationTimestamp
-          !binaryWriter.SafeWriteUInt32(localFileHeader.CRC32) ||                    // CRC32
-          !binaryWriter.SafeWriteUInt32((uint32)localFileHeader.CompressedSize) ||   // CompressedSize
-          !binaryWriter.SafeWriteUInt32((uint32)localFileHeader.DecompressedSize) || // DecompressedSize
-          !binaryWriter.SafeWriteUInt16((uint16)filenameLength) ||                   // FilenameLength
-          !binaryWriter.SafeWriteUInt16(0) ||                                        // ExtraFieldLength
-          !binaryWriter.SafeWriteFixedString(pFileEntry->FileName, filenameLength))  // Filename
-      {
-        return false;
-      }
-    }
+    const ReadIndex::Entry& readEntry = m_readIndex.GetEntry(readIndex);
+    const FileLocation* pFileEntry = &readEntry.Location;
 
-    // read+write chunks
-    static const uint32 CHUNKSIZE = 4096;
-    byte chunkBuffer[CHUNKSIZE];
-    uint64 remaining = pFileEntry->CompressedFileSize;
-    while (remaining > 0)
+    // appending leaves the file where it is
+    uint64 newStartingOffset = pFileEntry->OffsetToFileHeader;
+    if (!appending)
     {
-      uint32 copySize = (uint32)Min(remaining, (uint64)CHUNKSIZE);
-
-      // read it
-      uint32 bytesRead = m_pReadStream->Read(chunkBuffer, copySize);
-      if (bytesRead != copySize)
-      {
-        // io error
+      newStartingOffset = m_pWriteStream->GetPosition();
+      uint32 filenameLength = Min(readEntry.NameLength, (uint32)0xFFFF);
+      if (!CopyLocalFile(m_pReadStream, pFileEntry, m_pWriteStream, fileName, filenameLength))
         return false;
-      }
-
-      // write it
-      uint32 bytesWritten = m_pWriteStream->Write(chunkBuffer, copySize);
-      if (bytesWritten != copySize)
-      {
-        // io error
-        return false;
-      }
-
-      remaining -= (uint64)copySize;
     }
 
     // create a copy of the entry, and store it in the write table
     FileEntry* pNewFileEntry = new FileEntry;
-    pNewFileEntry->FileName = pFileEntry->FileName;
+    pNewFileEntry->FileName = fileName;
     pNewFileEntry->CompressionMethod = pFileEntry->CompressionMethod;
-    pNewFileEntry->ModifiedTime = pFileEntry->ModifiedTime;
+    pNewFileEntry->ModifiedTime = ZipTimeToTimestamp(readEntry.ModifiedTime);
     pNewFileEntry->CRC32 = pFileEntry->CRC32;
     pNewFileEntry->OffsetToFileHeader = newStartingOffset;
     pNewFileEntry->CompressedFileSize = pFileEntry->CompressedFileSize;
@@ -1931,45 +3561,106 @@ bool ZipArchive::CommitChanges()
       // filenames are limited to 65535 characters
       uint32 filenameLength = Min(pFileEntry->FileName.GetLength(), (uint32)0xFFFF);
 
+      // values that don't fit are saturated, and stored in the ZIP64 extra field in this order
+      uint64 zip64Values[3];
+      uint32 zip64ValueCount = 0;
+      if (pFileEntry->DecompressedFileSize >= ZIP_ARCHIVE_ZIP64_LIMIT)
+        zip64Values[zip64ValueCount++] = pFileEntry->DecompressedFileSize;
+      if (pFileEntry->CompressedFileSize >= ZIP_ARCHIVE_ZIP64_LIMIT)
+        zip64Values[zip64ValueCount++] = pFileEntry->CompressedFileSize;
+      if (pFileEntry->OffsetToFileHeader >= ZIP_ARCHIVE_ZIP64_LIMIT)
+        zip64Values[zip64ValueCount++] = pFileEntry->OffsetToFileHeader;
+
+      uint32 versionToExtract =
+        (zip64ValueCount > 0) ? ZIP_ARCHIVE_VERSION_TO_EXTRACT_ZIP64 : ZIP_ARCHIVE_VERSION_TO_EXTRACT;
+      uint32 extraFieldLength = (zip64ValueCount > 0) ? (4 + zip64ValueCount * sizeof(uint64)) : 0;
+      uint32 compressedSize32 = (uint32)Min(pFileEntry->CompressedFileSize, ZIP_ARCHIVE_ZIP64_LIMIT);
+      uint32 decompressedSize32 = (uint32)Min(pFileEntry->DecompressedFileSize, ZIP_ARCHIVE_ZIP64_LIMIT);
+      uint32 offsetToFileHeader32 = (uint32)Min(pFileEntry->OffsetToFileHeader, ZIP_ARCHIVE_ZIP64_LIMIT);
+
       // write header
       if (!binaryWriter.SafeWriteUInt32(ZIP_ARCHIVE_CENTRAL_DIRECTORY_FILE_HEADER_SIGNATURE) || // Signature
           !binaryWriter.SafeWriteUInt16(ZIP_ARCHIVE_VERSION_MADE_BY) ||                         // Version Made By
-          !binaryWriter.SafeWriteUInt16(ZIP_ARCHIVE_VERSION_TO_EXTRACT) ||                      // Version To Extract
+          !binaryWriter.SafeWriteUInt16((uint16)versionToExtract) ||                            // Version To Extract
           !binaryWriter.SafeWriteUInt16(0) ||                                                   // Flags
           !binaryWriter.SafeWriteUInt16((uint16)pFileEntry->CompressionMethod) ||               // Compression Method
           !binaryWriter.SafeWriteUInt32(TimestampToZipTime(pFileEntry->ModifiedTime)) ||        // Modified Timestamp
           !binaryWriter.SafeWriteUInt32(pFileEntry->CRC32) ||                                   // CRC32
-          !binaryWriter.SafeWriteUInt32((uint32)pFileEntry->CompressedFileSize) ||              // Compressed Size
-          !binaryWriter.SafeWriteUInt32((uint32)pFileEntry->DecompressedFileSize) ||            // Decompressed Size
+          !binaryWriter.SafeWriteUInt32(compressedSize32) ||                                    // Compressed Size
+          !binaryWriter.SafeWriteUInt32(decompressedSize32) ||                                  // Decompressed Size
           !binaryWriter.SafeWriteUInt16((uint16)filenameLength) ||                              // Filename Length
-          !binaryWriter.SafeWriteUInt16(0) ||                                                   // Extra Field Length
+          !binaryWriter.SafeWriteUInt16((uint16)extraFieldLength) ||                            // Extra Field Length
           !binaryWriter.SafeWriteUInt16(0) ||                                                   // File Comment Length
           !binaryWriter.SafeWriteUInt16(0) ||                                       // Disk number where file starts
           !binaryWriter.SafeWriteUInt16(0) ||                                       // Internal File Attributes
           !binaryWriter.SafeWriteUInt32(0) ||                                       // External File Attributes
-          !binaryWriter.SafeWriteUInt32((uint32)pFileEntry->OffsetToFileHeader) ||  // Offset to file header
+          !binaryWriter.SafeWriteUInt32(offsetToFileHeader32) ||                    // Offset to file header
           !binaryWriter.SafeWriteFixedString(pFileEntry->FileName, filenameLength)) // Filename
       {
         return false;
       }
 
+      if (zip64ValueCount > 0)
+      {
+        if (!binaryWriter.SafeWriteUInt16(ZIP_ARCHIVE_ZIP64_EXTRA_FIELD_ID) ||
+            !binaryWriter.SafeWriteUInt16((uint16)(zip64ValueCount * sizeof(uint64))))
+        {
+          return false;
+        }
+
+        for (uint32 i = 0; i < zip64ValueCount; i++)
+        {
+          if (!binaryWriter.SafeWriteUInt64(zip64Values[i]))
+            return false;
+        }
+      }
+
       nCentralDirectoryEntries++;
     }
 
-    // can only write 65536 files to a zip archive
+    // archives with more files, or a central directory past 4GB, have a ZIP64 end of central directory record,
+    // found through the locator before the end of central directory record, which has saturated fields
     uint64 centralDirectorySize = (uint64)(m_pWriteStream->GetPosition() - centralDirectoryOffset);
-    nCentralDirectoryEntries = Min(nCentralDirectoryEntries, (uint32)0xFFFF);
+    if (nCentralDirectoryEntries >= ZIP_ARCHIVE_ZIP64_RECORD_LIMIT || centralDirectorySize >= ZIP_ARCHIVE_ZIP64_LIMIT ||
+        centralDirectoryOffset >= ZIP_ARCHIVE_ZIP64_LIMIT)
+    {
+      uint64 zip64EndOfCentralDirectoryOffset = m_pWriteStream->GetPosition();
+      if (!binaryWriter.SafeWriteUInt32(ZIP_ARCHIVE_ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE) || // Signature
+          !binaryWriter.SafeWriteUInt64(ZIP_ARCHIVE_ZIP64_END_OF_CENTRAL_DIRECTORY_SIZE - 12) || // Size of the rest
+          !binaryWriter.SafeWriteUInt16(ZIP_ARCHIVE_VERSION_MADE_BY) ||                         // Version Made By
+          !binaryWriter.SafeWriteUInt16(ZIP_ARCHIVE_VERSION_TO_EXTRACT_ZIP64) ||                // Version To Extract
+          !binaryWriter.SafeWriteUInt32(0) ||                                                   // Disk Number
+          !binaryWriter.SafeWriteUInt32(0) ||                       // Disk where central directory starts
+          !binaryWriter.SafeWriteUInt64(nCentralDirectoryEntries) || // Central directory record count on this disk
+          !binaryWriter.SafeWriteUInt64(nCentralDirectoryEntries) || // Central directory record count
+          !binaryWriter.SafeWriteUInt64(centralDirectorySize) ||     // Central directory size
+          !binaryWriter.SafeWriteUInt64(centralDirectoryOffset))     // Central directory offset
+      {
+        return false;
+      }
+
+      if (!binaryWriter.SafeWriteUInt32(ZIP_ARCHIVE_ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE) || // Signature
+          !binaryWriter.SafeWriteUInt32(0) ||                                 // Disk with the ZIP64 record
+          !binaryWriter.SafeWriteUInt64(zip64EndOfCentralDirectoryOffset) || // ZIP64 record offset
+          !binaryWriter.SafeWriteUInt32(1))                                  // Disk count
+      {
+        return false;
+      }
+    }
+
+    uint32 centralDirectoryRecords16 = Min(nCentralDirectoryEntries, ZIP_ARCHIVE_ZIP64_RECORD_LIMIT);
+    uint32 centralDirectorySize32 = (uint32)Min(centralDirectorySize, ZIP_ARCHIVE_ZIP64_LIMIT);
+    uint32 centralDirectoryOffset32 = (uint32)Min(centralDirectoryOffset, ZIP_ARCHIVE_ZIP64_LIMIT);
 
     // write the end of central directory marker
     if (!binaryWriter.SafeWriteUInt32(ZIP_ARCHIVE_END_OF_CENTRAL_DIRECTORY_SIGNATURE) || // Signature
         !binaryWriter.SafeWriteUInt16(0) ||                                              // Disk Number
-        !binaryWriter.SafeWriteUInt16(0) || // Disk where central directory starts
-        !binaryWriter.SafeWriteUInt16(
-          (uint16)nCentralDirectoryEntries) || // Central directory record count on this disk
-        !binaryWriter.SafeWriteUInt16((uint16)nCentralDirectoryEntries) || // Central directory record count
-        !binaryWriter.SafeWriteUInt32((uint32)centralDirectorySize) ||     // Central directory size
-        !binaryWriter.SafeWriteUInt32((uint32)centralDirectoryOffset) ||   // Central directory offset
-        !binaryWriter.SafeWriteUInt16(0))                                  // Comment length
+        !binaryWriter.SafeWriteUInt16(0) ||                                // Disk where central directory starts
+        !binaryWriter.SafeWriteUInt16((uint16)centralDirectoryRecords16) || // Central directory record count on disk
+        !binaryWriter.SafeWriteUInt16((uint16)centralDirectoryRecords16) || // Central directory record count
+        !binaryWriter.SafeWriteUInt32(centralDirectorySize32) ||            // Central directory size
+        !binaryWriter.SafeWriteUInt32(centralDirectoryOffset32) ||          // Central directory offset
+        !binaryWriter.SafeWriteUInt16(0))                                   // Comment length
     {
       return false;
     }
@@ -1985,30 +3676,53 @@ bool ZipArchive::CommitChanges()
   // flush the write stream, commit it for atomic updated files
   m_pWriteStream->Flush();
 
-  // empty the read hash table, and move everything from the write table into it
-  for (FileHashTable::Iterator itr = m_readFileHashTable.Begin(); !itr.AtEnd(); itr.Forward())
-    delete itr->Value;
-  m_readFileHashTable.Clear();
+  // rebuild the read index from the write table, which is what's in the stream now
+  uint32 maxEntryCount = 0;
+  uint32 maxNamesSize = 0;
+  for (FileHashTable::Iterator itr = m_writeFileHashTable.Begin(); !itr.AtEnd(); itr.Forward())
+  {
+    maxEntryCount++;
+    maxNamesSize += itr->Value->FileName.GetLength();
+  }
+
+  m_readIndex.BeginBuild(maxEntryCount, maxNamesSize);
+  m_indexLoaded = false;
   for (FileHashTable::Iterator itr = m_writeFileHashTable.Begin(); !itr.AtEnd(); itr.Forward())
   {
     FileEntry* pFileEntry = itr->Value;
-    if (pFileEntry->IsDeleted)
-      delete pFileEntry;
-    else
-      m_readFileHashTable.Insert(pFileEntry->FileName, pFileEntry);
+    if (!pFileEntry->IsDeleted)
+    {
+      m_readIndex.AddEntry(pFileEntry->FileName, pFileEntry->FileName.GetLength(), *pFileEntry,
+                           TimestampToZipTime(pFileEntry->ModifiedTime));
+    }
+
+    delete pFileEntry;
   }
   m_writeFileHashTable.Clear();
+  ResetFindTrie();
 
-  // replace stream pointers
+  // replace stream pointers, appending archives stay writable
   m_pReadStream = m_pWriteStream;
   m_pWriteStream = NULL;
+  if (appending)
+    UpgradeToWritableArchive(m_pReadStream);
+
   return true;
 }
 
 bool ZipArchive::DiscardChanges()
 {
   // empty the write files table
+  bool wroteFiles = (m_writeFileHashTable.GetMemberCount() > 0);
+  for (FileHashTable::Iterator itr = m_writeFileHashTable.Begin(); !itr.AtEnd(); itr.Forward())
+    delete itr->Value;
   m_writeFileHashTable.Clear();
+  m_readIndex.UndeleteEntries();
+  ResetFindTrie();
+
+  // files written while appending are after the central directory, so it's written again after them
+  if (IsAppending())
+    return (!wroteFiles || CommitChanges());
 
   // close it
   m_pWriteStream->Release();
@@ -2022,10 +3736,10 @@ ZipArchive* ZipArchive::CreateArchive(ByteStream* pWriteStream)
   return pZipArchive;
 }
 
-ZipArchive* ZipArchive::OpenArchiveReadOnly(ByteStream* pReadStream)
+ZipArchive* ZipArchive::OpenArchiveReadOnly(ByteStream* pReadStream, ByteStream* pIndexStream /* = NULL */)
 {
   ZipArchive* pZipArchive = new ZipArchive(pReadStream, NULL);
-  if (!pZipArchive->ParseZip())
+  if ((pIndexStream == NULL || !pZipArchive->LoadIndex(pIndexStream)) && !pZipArchive->ParseZip())
   {
     delete pZipArchive;
     return NULL;
@@ -2034,12 +3748,23 @@ ZipArchive* ZipArchive::OpenArchiveReadOnly(ByteStream* pReadStream)
   return pZipArchive;
 }
 
-ZipArchive* ZipArchive::OpenArchiveReadWrite(ByteStream* pReadStream, ByteStream* pWriteStream)
+ZipArchive* ZipArchive::OpenArchiveReadWrite(ByteStream* pReadStream, ByteStream* pWriteStream,
+                                             ByteStream* pIndexStream /* = NULL */)
 {
   DebugAssert(pReadStream != pWriteStream);
+  return OpenWritableArchive(pReadStream, pWriteStream, pIndexStream);
+}
+
+ZipArchive* ZipArchive::OpenArchiveForAppend(ByteStream* pStream, ByteStream* pIndexStream /* = NULL */)
+{
+  return OpenWritableArchive(pStream, pStream, pIndexStream);
+}
 
+ZipArchive* ZipArchive::OpenWritableArchive(ByteStream* pReadStream, ByteStream* pWriteStream,
+                                            ByteStream* pIndexStream)
+{
   ZipArchive* pZipArchive = new ZipArchive(pReadStream, NULL);
-  if (!pZipArchive->ParseZip())
+  if ((pIndexStream == NULL || !pZipArchive->LoadIndex(pIndexStream)) && !pZipArchive->ParseZip())
   {
     delete pZipArchive;
     return NULL;
@@ -2054,105 +3779,155 @@ ZipArchive* ZipArchive::OpenArchiveReadWrite(ByteStream* pReadStream, ByteStream
   return pZipArchive;
 }
 
-bool ZipArchive::FindFiles(const char* path, const char* pattern, uint32 flags,
-                           FileSystem::FindResultsArray* pResults) const
+bool ZipArchive::CompactArchive(ByteStream* pSourceStream, ByteStream* pDestinationStream)
 {
-  // has a path
-  if (path[0] == '\0')
+  // committing to another stream copies only the files that are listed
+  ZipArchive* pZipArchive = OpenArchiveReadWrite(pSourceStream, pDestinationStream);
+  if (pZipArchive == NULL)
     return false;
 
-  // clear result array
-  if (!(flags & FILESYSTEM_FIND_KEEP_ARRAY))
-    pResults->Clear();
+  bool result = pZipArchive->CommitChanges();
+  delete pZipArchive;
+  return result;
+}
 
-  uint32 count = FindFilesInTable(m_writeFileHashTable, path, pattern, flags, pResults);
-  count += FindFilesInTable(m_readFileHashTable, path, pattern, flags, pResults);
+// the part of a name after the path FindFiles is looking in, or NULL if it's not in it or doesn't match
+static const char* MatchFindPath(const char* fileName, const char* path, uint32 pathLength, const GlobPattern& pattern,
+                                 uint32 flags)
+{
+  if (Y_strnicmp(fileName, path, pathLength) != 0 || fileName[pathLength] != '/')
+    return NULL;
 
-  return (count > 0);
+  // path matches
+  const char* afterPathPart = fileName + pathLength + 1;
+
+  // check if it contains another directory
+  if (!(flags & FILESYSTEM_FIND_RECURSIVE) && Y_strchr(afterPathPart, '/') != NULL)
+    return NULL;
+
+  // match the filename part
+  const char* fileNamePart = Y_strrchr(afterPathPart, '/');
+  if (fileNamePart == NULL)
+    fileNamePart = afterPathPart;
+  else
+    fileNamePart++;
+
+  if (!pattern.MatchesAll() && !pattern.Match(fileNamePart))
+    return NULL;
+
+  return afterPathPart;
 }
 
-uint32 ZipArchive::FindFilesInTable(const FileHashTable& fileTable, const char* path, const char* pattern, uint32 flags,
-                                    FileSystem::FindResultsArray* pResults) const
+// returns false if the file was already found, among the results from before this search
+static bool AddFindResult(const char* fileName, const char* afterPathPart, uint32 flags,
+                          const Timestamp& modifiedTime, uint64 size, uint32 previousResultCount,
+                          FileSystem::FindResultsArray* pResults)
 {
-  // small speed optimization for '*' case
-  bool hasWildCards = false;
-  bool wildCardMatchAll = false;
-  if (Y_strpbrk(pattern, "*?") != NULL)
+  // create data
+  FILESYSTEM_FIND_DATA outData;
+  if (flags & FILESYSTEM_FIND_RELATIVE_PATHS)
+    Y_strncpy(outData.FileName, countof(outData.FileName), afterPathPart);
+  else
+    Y_strncpy(outData.FileName, countof(outData.FileName), fileName);
+
+  // remaining fields
+  outData.ModificationTime = modifiedTime;
+  outData.Attributes = 0;
+  outData.Size = size;
+
+  // check it does not exist, the trie gives each name once so only earlier results can have it
+  for (uint32 i = 0; i < previousResultCount; i++)
   {
-    hasWildCards = true;
-    wildCardMatchAll = !(Y_strcmp(pattern, "*"));
+    if (Y_stricmp(outData.FileName, pResults->GetElement(i).FileName) == 0)
+      return false;
   }
 
-  // ignore leading /
-  if (path[0] == '/')
-    path++;
+  pResults->Add(outData);
+  return true;
+}
 
-  // get length of path
-  uint32 pathLength = Y_strlen(path);
-  uint32 count = 0;
+void ZipArchive::BuildFindTrie() const
+{
+  m_findTrie.Clear();
+  for (uint32 i = 0; i < m_readIndex.GetEntryCount(); i++)
+    m_findTrie.Insert(m_readIndex.GetEntryName(i), i);
 
-  // iterate over files
-  for (FileHashTable::ConstIterator itr = fileTable.Begin(); !itr.AtEnd(); itr.Forward())
-  {
-    const FileEntry* pFileEntry = itr->Value;
-    if (pFileEntry->IsDeleted)
-      continue;
+  // written files that aren't in the read index have no entry there
+  for (FileHashTable::ConstIterator itr = m_writeFileHashTable.Begin(); !itr.AtEnd(); itr.Forward())
+    m_findTrie.Insert(itr->Value->FileName, ReadIndex::InvalidEntry);
 
-    if (Y_strnicmp(pFileEntry->FileName, path, pathLength) == 0 && pFileEntry->FileName[pathLength] == '/')
-    {
-      // path matches
-      const char* afterPathPart = pFileEntry->FileName.GetCharArray() + pathLength + 1;
+  m_findTrieBuilt = true;
+}
 
-      // check if it contains another directory
-      if (!(flags & FILESYSTEM_FIND_RECURSIVE) && Y_strchr(afterPathPart, '/') != NULL)
-        continue;
+void ZipArchive::AddToFindTrie(const char* fileName)
+{
+  MutexLock lock(m_findTrieLock);
+  if (m_findTrieBuilt)
+    m_findTrie.Insert(fileName, ReadIndex::InvalidEntry);
+}
 
-      // match the filename part
-      const char* fileNamePart = Y_strrchr(afterPathPart, '/');
-      if (fileNamePart == NULL)
-        fileNamePart = afterPathPart;
-      else
-        fileNamePart++;
+void ZipArchive::ResetFindTrie()
+{
+  MutexLock lock(m_findTrieLock);
+  m_findTrie.Clear();
+  m_findTrieBuilt = false;
+}
 
-      if (hasWildCards)
-      {
-        if (!wildCardMatchAll && !Y_strwildcmp(fileNamePart, pattern))
-          continue;
-      }
-      else
-      {
-        if (Y_stricmp(fileNamePart, pattern) != 0)
-          continue;
-      }
+bool ZipArchive::FindFiles(const char* path, const char* pattern, uint32 flags,
+                           FileSystem::FindResultsArray* pResults) const
+{
+  // has a path
+  if (path[0] == '\0')
+    return false;
 
-      // create data
-      FILESYSTEM_FIND_DATA outData;
-      if (flags & FILESYSTEM_FIND_RELATIVE_PATHS)
-        Y_strncpy(outData.FileName, countof(outData.FileName), afterPathPart);
-      else
-        Y_strncpy(outData.FileName, countof(outData.FileName), pFileEntry->FileName);
+  // clear result array
+  if (!(flags & FILESYSTEM_FIND_KEEP_ARRAY))
+    pResults->Clear();
+
+  // ignore leading /
+  if (path[0] == '/')
+    path++;
 
-      // remaining fields
-      outData.ModificationTime = pFileEntry->ModifiedTime;
-      outData.Attributes = 0;
-      outData.Size = pFileEntry->DecompressedFileSize;
+  // names in the archive are compared without regard to case
+  GlobPattern compiledPattern(pattern, GlobPattern::FLAG_CASE_INSENSITIVE);
+  uint32 pathLength = Y_strlen(path);
+  uint32 previousResultCount = pResults->GetSize();
+  uint32 count = 0;
 
-      // check it does not exist
-      uint32 i;
-      for (i = 0; i < pResults->GetSize(); i++)
+  // A written file hides the read index's entry for the name, unless it was deleted, when the read entry is found
+  // if it's still there. The names under the path still go through MatchFindPath for the pattern.
+  auto addFile = [&](const char* trieName, uint32, const uint32& readIndex) {
+    const char* afterPathPart;
+    const FileHashTable::Member* pMember = m_writeFileHashTable.Find(trieName);
+    if (pMember != NULL && !pMember->Value->IsDeleted)
+    {
+      const FileEntry* pFileEntry = pMember->Value;
+      if ((afterPathPart = MatchFindPath(pFileEntry->FileName, path, pathLength, compiledPattern, flags)) != NULL &&
+          AddFindResult(pFileEntry->FileName, afterPathPart, flags, pFileEntry->ModifiedTime,
+                        pFileEntry->DecompressedFileSize, previousResultCount, pResults))
       {
-        if (Y_stricmp(outData.FileName, pResults->GetElement(i).FileName) == 0)
-          break;
+        count++;
       }
-      if (i == pResults->GetSize())
+    }
+    else if (readIndex != ReadIndex::InvalidEntry && !m_readIndex.IsEntryDeleted(readIndex))
+    {
+      const char* fileName = m_readIndex.GetEntryName(readIndex);
+      const ReadIndex::Entry& entry = m_readIndex.GetEntry(readIndex);
+      if ((afterPathPart = MatchFindPath(fileName, path, pathLength, compiledPattern, flags)) != NULL &&
+          AddFindResult(fileName, afterPathPart, flags, ZipTimeToTimestamp(entry.ModifiedTime),
+                        entry.Location.DecompressedFileSize, previousResultCount, pResults))
       {
-        pResults->Add(outData);
         count++;
       }
     }
-  }
+  };
 
-  return count;
+  MutexLock lock(m_findTrieLock);
+  if (!m_findTrieBuilt)
+    BuildFindTrie();
+
+  m_findTrie.EnumerateUnder(path, (flags & FILESYSTEM_FIND_RECURSIVE) != 0, addFile);
+  return (count > 0);
 }
 
 #endif // HAVE_ZLIB
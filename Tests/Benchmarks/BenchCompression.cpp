@@ -0,0 +1,200 @@
+#include "Benchmark.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CRC32.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/MD5Digest.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/ZLibHelpers.h"
+#include "YBaseLib/ZipArchive.h"
+
+// Deflate through ZLibHelpers and ZipArchive, and the checksums files are verified with. The argument of the
+// compression benchmarks is the level, and an iteration handles one buffer, so bytes per second are of the data
+// before compression.
+
+static const uint32 DataSize = 1024 * 1024;
+
+// Text-like data that deflates to roughly a third of its size, words from a short list with numbers among them,
+// the same every time.
+static void GetCompressibleData(PODArray<byte>* pData)
+{
+  static const char* words[] = {"stream ", "archive ", "buffer ", "offset ", "length ", "header ", "entry ",
+                                "block ",  "index ",   "value ",  "\n",      "= ",      ", ",     "; "};
+  uint32 state = 0x9E3779B9;
+  pData->Clear();
+  while (pData->GetSize() < DataSize)
+  {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    const char* word = words[state % countof(words)];
+    if ((state >> 8) % 4 == 0)
+    {
+      char number[16];
+      uint32 length = Y_snprintf(number, sizeof(number), "%u ", state >> 20);
+      pData->AddRange(reinterpret_cast<const byte*>(number), length);
+    }
+    else
+    {
+      pData->AddRange(reinterpret_cast<const byte*>(word), Y_strlen(word));
+    }
+  }
+
+  pData->Resize(DataSize);
+}
+
+#ifdef HAVE_ZLIB
+
+DEFINE_BENCHMARK(ZLibDeflate)
+{
+  int level = (int)pState->GetArgument();
+  pState->SetBytesPerIteration(DataSize);
+  pState->PauseTiming();
+  PODArray<byte> data;
+  GetCompressibleData(&data);
+  PODArray<byte> compressed;
+  compressed.Resize(ZLibHelpers::GetDeflatedBufferUpperBounds(DataSize, level));
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    uint32 compressedSize;
+    if (!ZLibHelpers::WriteDeflatedDataToBuffer(compressed.GetBasePointer(), compressed.GetSize(), &compressedSize,
+                                                data.GetBasePointer(), DataSize, level))
+    {
+      return;
+    }
+    Benchmark_DoNotOptimize(compressedSize);
+  }
+}
+
+DEFINE_BENCHMARK(ZLibInflate)
+{
+  int level = (int)pState->GetArgument();
+  pState->SetBytesPerIteration(DataSize);
+  pState->PauseTiming();
+  PODArray<byte> data;
+  GetCompressibleData(&data);
+  PODArray<byte> compressed;
+  compressed.Resize(ZLibHelpers::GetDeflatedBufferUpperBounds(DataSize, level));
+  uint32 compressedSize;
+  bool compressedData =
+    ZLibHelpers::WriteDeflatedDataToBuffer(compressed.GetBasePointer(), compressed.GetSize(), &compressedSize,
+                                           data.GetBasePointer(), DataSize, level);
+  pState->ResumeTiming();
+  if (!compressedData)
+    return;
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    uint32 decompressedSize;
+    if (!ZLibHelpers::ReadDeflatedDataFromBuffer(data.GetBasePointer(), DataSize, &decompressedSize,
+                                                 compressed.GetBasePointer(), compressedSize))
+    {
+      return;
+    }
+    Benchmark_DoNotOptimize(decompressedSize);
+  }
+}
+
+// an archive in memory holding the data as one file
+static ZipArchive* CreateArchive(GrowableMemoryByteStream* pArchiveStream, const PODArray<byte>& data, uint32 level)
+{
+  ZipArchive* pArchive = ZipArchive::CreateArchive(pArchiveStream);
+  ByteStream* pStream = pArchive->OpenFile("data.txt", BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE, level);
+  bool result = pStream != nullptr && pStream->Write2(data.GetBasePointer(), data.GetSize());
+  if (pStream != nullptr)
+    pStream->Release();
+
+  if (!result || !pArchive->CommitChanges())
+  {
+    delete pArchive;
+    return nullptr;
+  }
+
+  return pArchive;
+}
+
+DEFINE_BENCHMARK(ZipArchiveWrite)
+{
+  uint32 level = pState->GetArgument();
+  pState->SetBytesPerIteration(DataSize);
+  pState->PauseTiming();
+  PODArray<byte> data;
+  GetCompressibleData(&data);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    GrowableMemoryByteStream* pArchiveStream = ByteStream_CreateGrowableMemoryStream();
+    ZipArchive* pArchive = CreateArchive(pArchiveStream, data, level);
+    Benchmark_DoNotOptimize(pArchiveStream->GetSize());
+    delete pArchive;
+    pArchiveStream->Release();
+    if (pArchive == nullptr)
+      return;
+  }
+}
+
+DEFINE_BENCHMARK(ZipArchiveRead)
+{
+  uint32 level = pState->GetArgument();
+  pState->SetBytesPerIteration(DataSize);
+  pState->PauseTiming();
+  PODArray<byte> data;
+  GetCompressibleData(&data);
+  GrowableMemoryByteStream* pArchiveStream = ByteStream_CreateGrowableMemoryStream();
+  ZipArchive* pArchive = CreateArchive(pArchiveStream, data, level);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount() && pArchive != nullptr; i++)
+  {
+    ByteStream* pStream = pArchive->OpenFile("data.txt", BYTESTREAM_OPEN_READ);
+    if (pStream == nullptr)
+      break;
+
+    while (pStream->Read(data.GetBasePointer(), 65536) == 65536)
+      Benchmark_ClobberMemory();
+    pStream->Release();
+  }
+
+  pState->PauseTiming();
+  delete pArchive;
+  pArchiveStream->Release();
+}
+
+#endif // HAVE_ZLIB
+
+DEFINE_BENCHMARK(CRC32HashBytes)
+{
+  pState->SetBytesPerIteration(DataSize);
+  pState->PauseTiming();
+  PODArray<byte> data;
+  GetCompressibleData(&data);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    CRC32 crc;
+    crc.HashBytes(data.GetBasePointer(), DataSize);
+    Benchmark_DoNotOptimize(crc.GetCRC());
+  }
+}
+
+DEFINE_BENCHMARK(MD5DigestUpdate)
+{
+  pState->SetBytesPerIteration(DataSize);
+  pState->PauseTiming();
+  PODArray<byte> data;
+  GetCompressibleData(&data);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    MD5Digest digest;
+    digest.Update(data.GetBasePointer(), DataSize);
+    byte result[MD5Digest::DIGEST_SIZE];
+    digest.Final(result);
+    Benchmark_DoNotOptimize(result);
+  }
+}
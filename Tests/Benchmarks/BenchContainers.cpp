@@ -0,0 +1,684 @@
+#include "Benchmark.h"
+#include "YBaseLib/Array.h"
+#include "YBaseLib/ArrayAlgorithms.h"
+#include "YBaseLib/BitSet.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CIStringHashTable.h"
+#include "YBaseLib/HashTable.h"
+#include "YBaseLib/MappedHashIndex.h"
+#include "YBaseLib/MemArray.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/ParallelArrayAlgorithms.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/StringHashTable.h"
+#include "YBaseLib/ThreadPool.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Each container next to its std:: counterpart, running the same keys through both. The argument is the number of
+// entries, and an iteration handles all of them, so items per second compare across sizes.
+
+// distinct keys in no particular order
+static uint32 GetKey(uint32 index)
+{
+  return index * 2654435761u;
+}
+
+static void GetStringKeys(uint32 count, Array<String>* pKeys, std::vector<std::string>* pStdKeys)
+{
+  for (uint32 i = 0; i < count; i++)
+  {
+    SmallString key;
+    key.Format("Section%u/Key%08X", i % 16, GetKey(i));
+    pKeys->Add(key);
+    pStdKeys->push_back(key.GetCharArray());
+  }
+}
+
+DEFINE_BENCHMARK(HashTableInsert)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    HashTable<uint32, uint32> table;
+    for (uint32 j = 0; j < count; j++)
+      table.Insert(GetKey(j), j);
+    Benchmark_DoNotOptimize(table.GetMemberCount());
+  }
+}
+
+DEFINE_BENCHMARK(StdUnorderedMapInsert)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    std::unordered_map<uint32, uint32> table;
+    for (uint32 j = 0; j < count; j++)
+      table.emplace(GetKey(j), j);
+    Benchmark_DoNotOptimize(table.size());
+  }
+}
+
+DEFINE_BENCHMARK(HashTableFind)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  pState->PauseTiming();
+  HashTable<uint32, uint32> table;
+  for (uint32 j = 0; j < count; j++)
+    table.Insert(GetKey(j), j);
+  pState->ResumeTiming();
+
+  // every other lookup misses
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    for (uint32 j = 0; j < count; j++)
+      Benchmark_DoNotOptimize(table.Find(GetKey(j + (j & 1) * count)));
+  }
+}
+
+DEFINE_BENCHMARK(StdUnorderedMapFind)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  pState->PauseTiming();
+  std::unordered_map<uint32, uint32> table;
+  for (uint32 j = 0; j < count; j++)
+    table.emplace(GetKey(j), j);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    for (uint32 j = 0; j < count; j++)
+      Benchmark_DoNotOptimize(table.find(GetKey(j + (j & 1) * count)));
+  }
+}
+
+DEFINE_BENCHMARK(HashTableRemove)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    pState->PauseTiming();
+    HashTable<uint32, uint32> table;
+    for (uint32 j = 0; j < count; j++)
+      table.Insert(GetKey(j), j);
+    pState->ResumeTiming();
+
+    for (uint32 j = 0; j < count; j++)
+      table.Remove(GetKey(j));
+    Benchmark_DoNotOptimize(table.GetMemberCount());
+  }
+}
+
+DEFINE_BENCHMARK(StdUnorderedMapRemove)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    pState->PauseTiming();
+    std::unordered_map<uint32, uint32> table;
+    for (uint32 j = 0; j < count; j++)
+      table.emplace(GetKey(j), j);
+    pState->ResumeTiming();
+
+    for (uint32 j = 0; j < count; j++)
+      table.erase(GetKey(j));
+    Benchmark_DoNotOptimize(table.size());
+  }
+}
+
+// string keyed tables are run by key type, with the keys built outside the timing
+template<typename TableType>
+static void RunStringTableInsert(BenchmarkState* pState)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  pState->PauseTiming();
+  Array<String> keys;
+  std::vector<std::string> stdKeys;
+  GetStringKeys(count, &keys, &stdKeys);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    TableType table;
+    for (uint32 j = 0; j < count; j++)
+      table.Insert(keys[j], j);
+    Benchmark_DoNotOptimize(table.GetMemberCount());
+  }
+}
+
+template<typename TableType>
+static void RunStringTableFind(BenchmarkState* pState)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  pState->PauseTiming();
+  Array<String> keys;
+  std::vector<std::string> stdKeys;
+  GetStringKeys(count, &keys, &stdKeys);
+  TableType table;
+  for (uint32 j = 0; j < count; j++)
+    table.Insert(keys[j], j);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    for (uint32 j = 0; j < count; j++)
+      Benchmark_DoNotOptimize(table.Find(keys[j]));
+  }
+}
+
+template<typename TableType>
+static void RunStringTableRemove(BenchmarkState* pState)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  pState->PauseTiming();
+  Array<String> keys;
+  std::vector<std::string> stdKeys;
+  GetStringKeys(count, &keys, &stdKeys);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    pState->PauseTiming();
+    TableType table;
+    for (uint32 j = 0; j < count; j++)
+      table.Insert(keys[j], j);
+    pState->ResumeTiming();
+
+    for (uint32 j = 0; j < count; j++)
+      table.Remove(keys[j]);
+    Benchmark_DoNotOptimize(table.GetMemberCount());
+  }
+}
+
+DEFINE_BENCHMARK(StringHashTableInsert)
+{
+  RunStringTableInsert<StringHashTable<uint32>>(pState);
+}
+
+DEFINE_BENCHMARK(StringHashTableFind)
+{
+  RunStringTableFind<StringHashTable<uint32>>(pState);
+}
+
+DEFINE_BENCHMARK(StringHashTableRemove)
+{
+  RunStringTableRemove<StringHashTable<uint32>>(pState);
+}
+
+DEFINE_BENCHMARK(CIStringHashTableInsert)
+{
+  RunStringTableInsert<CIStringHashTable<uint32>>(pState);
+}
+
+DEFINE_BENCHMARK(CIStringHashTableFind)
+{
+  RunStringTableFind<CIStringHashTable<uint32>>(pState);
+}
+
+DEFINE_BENCHMARK(CIStringHashTableRemove)
+{
+  RunStringTableRemove<CIStringHashTable<uint32>>(pState);
+}
+
+DEFINE_BENCHMARK(StdUnorderedMapStringInsert)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  pState->PauseTiming();
+  Array<String> keys;
+  std::vector<std::string> stdKeys;
+  GetStringKeys(count, &keys, &stdKeys);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    std::unordered_map<std::string, uint32> table;
+    for (uint32 j = 0; j < count; j++)
+      table.emplace(stdKeys[j], j);
+    Benchmark_DoNotOptimize(table.size());
+  }
+}
+
+DEFINE_BENCHMARK(StdUnorderedMapStringFind)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  pState->PauseTiming();
+  Array<String> keys;
+  std::vector<std::string> stdKeys;
+  GetStringKeys(count, &keys, &stdKeys);
+  std::unordered_map<std::string, uint32> table;
+  for (uint32 j = 0; j < count; j++)
+    table.emplace(stdKeys[j], j);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    for (uint32 j = 0; j < count; j++)
+      Benchmark_DoNotOptimize(table.find(stdKeys[j]));
+  }
+}
+
+DEFINE_BENCHMARK(StdUnorderedMapStringRemove)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  pState->PauseTiming();
+  Array<String> keys;
+  std::vector<std::string> stdKeys;
+  GetStringKeys(count, &keys, &stdKeys);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    pState->PauseTiming();
+    std::unordered_map<std::string, uint32> table;
+    for (uint32 j = 0; j < count; j++)
+      table.emplace(stdKeys[j], j);
+    pState->ResumeTiming();
+
+    for (uint32 j = 0; j < count; j++)
+      table.erase(stdKeys[j]);
+    Benchmark_DoNotOptimize(table.size());
+  }
+}
+
+// the image is built and written outside the timing, as it would be by an earlier run
+static GrowableMemoryByteStream* CreateMappedHashIndexImage(const Array<String>& keys)
+{
+  MappedHashIndexWriter writer;
+  for (uint32 j = 0; j < keys.GetSize(); j++)
+    writer.Add(keys[j], j);
+
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  writer.Write(pStream);
+  return pStream;
+}
+
+// a warm start, in place of inserting every entry as StringHashTable.Insert does
+DEFINE_BENCHMARK(MappedHashIndexOpen)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  pState->PauseTiming();
+  Array<String> keys;
+  std::vector<std::string> stdKeys;
+  GetStringKeys(count, &keys, &stdKeys);
+  GrowableMemoryByteStream* pStream = CreateMappedHashIndexImage(keys);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    MappedHashIndex index;
+    index.Open(pStream);
+    Benchmark_DoNotOptimize(index.GetEntryCount());
+  }
+
+  pStream->Release();
+}
+
+DEFINE_BENCHMARK(MappedHashIndexFind)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  pState->PauseTiming();
+  Array<String> keys;
+  std::vector<std::string> stdKeys;
+  GetStringKeys(count, &keys, &stdKeys);
+  GrowableMemoryByteStream* pStream = CreateMappedHashIndexImage(keys);
+  MappedHashIndex index;
+  index.Open(pStream);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    for (uint32 j = 0; j < count; j++)
+      Benchmark_DoNotOptimize(index.FindValue<uint32>(keys[j]));
+  }
+
+  pStream->Release();
+}
+
+// growing from empty, without reserving
+DEFINE_BENCHMARK(PODArrayAdd)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    PODArray<uint32> array;
+    for (uint32 j = 0; j < count; j++)
+      array.Add(j);
+    Benchmark_DoNotOptimize(array.GetBasePointer());
+  }
+}
+
+DEFINE_BENCHMARK(MemArrayAdd)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    MemArray<uint32> array;
+    for (uint32 j = 0; j < count; j++)
+      array.Add(j);
+    Benchmark_DoNotOptimize(array.GetBasePointer());
+  }
+}
+
+DEFINE_BENCHMARK(StdVectorAdd)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    std::vector<uint32> array;
+    for (uint32 j = 0; j < count; j++)
+      array.push_back(j);
+    Benchmark_DoNotOptimize(array.data());
+  }
+}
+
+// the argument is the number of bits; an iteration sets every third, combines with a copy and counts
+DEFINE_BENCHMARK(BitSetOperations)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  BitSet64 bits(count);
+  BitSet64 other(count);
+  for (uint32 j = 0; j < count; j += 2)
+    other.SetBit(j);
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    bits.Clear();
+    for (uint32 j = 0; j < count; j += 3)
+      bits.SetBit(j);
+    bits.Combine(other);
+    bits.Xor(other);
+    Benchmark_DoNotOptimize(bits.PopCount());
+  }
+}
+
+DEFINE_BENCHMARK(StdVectorBoolOperations)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  std::vector<bool> bits(count);
+  std::vector<bool> other(count);
+  for (uint32 j = 0; j < count; j += 2)
+    other[j] = true;
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    bits.assign(count, false);
+    for (uint32 j = 0; j < count; j += 3)
+      bits[j] = true;
+    for (uint32 j = 0; j < count; j++)
+      bits[j] = bits[j] | other[j];
+    for (uint32 j = 0; j < count; j++)
+      bits[j] = bits[j] != other[j];
+
+    size_t popCount = 0;
+    for (uint32 j = 0; j < count; j++)
+      popCount += bits[j] ? 1 : 0;
+    Benchmark_DoNotOptimize(popCount);
+  }
+}
+
+// Each array algorithm next to the plain loop it replaces, over values from 0 to 999. The argument is the array size.
+static void GetArrayValues(uint32 count, PODArray<int32>* pValues)
+{
+  pValues->Resize(count);
+  for (uint32 j = 0; j < count; j++)
+    (*pValues)[j] = (int32)(GetKey(j) % 1000);
+}
+
+// a value that isn't there, so every element is looked at
+DEFINE_BENCHMARK(ArrayFind)
+{
+  pState->PauseTiming();
+  PODArray<int32> values;
+  GetArrayValues(pState->GetArgument(), &values);
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(values.GetSize());
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+    Benchmark_DoNotOptimize(Y_array_find(values, 1000));
+}
+
+DEFINE_BENCHMARK(PODArrayIndexOf)
+{
+  pState->PauseTiming();
+  PODArray<int32> values;
+  GetArrayValues(pState->GetArgument(), &values);
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(values.GetSize());
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+    Benchmark_DoNotOptimize(values.IndexOf(1000));
+}
+
+DEFINE_BENCHMARK(ArrayCount)
+{
+  pState->PauseTiming();
+  PODArray<int32> values;
+  GetArrayValues(pState->GetArgument(), &values);
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(values.GetSize());
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+    Benchmark_DoNotOptimize(Y_array_count(values, Y_ARRAY_COMPARE_LESS, 300));
+}
+
+DEFINE_BENCHMARK(ArrayCountScalar)
+{
+  pState->PauseTiming();
+  PODArray<int32> values;
+  GetArrayValues(pState->GetArgument(), &values);
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(values.GetSize());
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    uint32 count = 0;
+    for (uint32 j = 0; j < values.GetSize(); j++)
+      count += (values[j] < 300) ? 1 : 0;
+    Benchmark_DoNotOptimize(count);
+  }
+}
+
+// keeping about half, in no pattern a branch predictor could follow
+DEFINE_BENCHMARK(ArrayFilter)
+{
+  pState->PauseTiming();
+  PODArray<int32> values;
+  PODArray<int32> results;
+  GetArrayValues(pState->GetArgument(), &values);
+  results.Resize(values.GetSize());
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(values.GetSize());
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    Benchmark_DoNotOptimize(Y_array_filter(results.GetBasePointer(), values.GetBasePointer(), values.GetSize(),
+                                           Y_ARRAY_COMPARE_GREATER_EQUAL, 500));
+  }
+}
+
+DEFINE_BENCHMARK(ArrayFilterScalar)
+{
+  pState->PauseTiming();
+  PODArray<int32> values;
+  PODArray<int32> results;
+  GetArrayValues(pState->GetArgument(), &values);
+  results.Resize(values.GetSize());
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(values.GetSize());
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    uint32 keptCount = 0;
+    for (uint32 j = 0; j < values.GetSize(); j++)
+    {
+      if (values[j] >= 500)
+        results[keptCount++] = values[j];
+    }
+    Benchmark_DoNotOptimize(keptCount);
+    Benchmark_ClobberMemory();
+  }
+}
+
+DEFINE_BENCHMARK(ArrayMinMax)
+{
+  pState->PauseTiming();
+  PODArray<int32> values;
+  GetArrayValues(pState->GetArgument(), &values);
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(values.GetSize());
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    int32 minValue, maxValue;
+    Y_array_minmax(values, &minValue, &maxValue);
+    Benchmark_DoNotOptimize(minValue);
+    Benchmark_DoNotOptimize(maxValue);
+  }
+}
+
+DEFINE_BENCHMARK(ArrayMinMaxScalar)
+{
+  pState->PauseTiming();
+  PODArray<int32> values;
+  GetArrayValues(pState->GetArgument(), &values);
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(values.GetSize());
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    int32 minValue = values[0];
+    int32 maxValue = values[0];
+    for (uint32 j = 1; j < values.GetSize(); j++)
+    {
+      minValue = Min(minValue, values[j]);
+      maxValue = Max(maxValue, values[j]);
+    }
+    Benchmark_DoNotOptimize(minValue);
+    Benchmark_DoNotOptimize(maxValue);
+  }
+}
+
+DEFINE_BENCHMARK(ArrayPrefixSum)
+{
+  pState->PauseTiming();
+  PODArray<int32> values;
+  PODArray<int32> sums;
+  GetArrayValues(pState->GetArgument(), &values);
+  sums.Resize(values.GetSize());
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(values.GetSize());
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+    Benchmark_DoNotOptimize(Y_array_prefix_sum(sums.GetBasePointer(), values.GetBasePointer(), values.GetSize()));
+}
+
+DEFINE_BENCHMARK(ArrayPrefixSumScalar)
+{
+  pState->PauseTiming();
+  PODArray<int32> values;
+  PODArray<int32> sums;
+  GetArrayValues(pState->GetArgument(), &values);
+  sums.Resize(values.GetSize());
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(values.GetSize());
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    int32 total = 0;
+    for (uint32 j = 0; j < values.GetSize(); j++)
+    {
+      total += values[j];
+      sums[j] = total;
+    }
+    Benchmark_DoNotOptimize(total);
+    Benchmark_ClobberMemory();
+  }
+}
+
+// floating point, which the compiler won't reorder to vectorize a plain loop
+DEFINE_BENCHMARK(ArraySum)
+{
+  pState->PauseTiming();
+  PODArray<float> values;
+  values.Resize(pState->GetArgument());
+  for (uint32 j = 0; j < values.GetSize(); j++)
+    values[j] = (float)(GetKey(j) % 1000);
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(values.GetSize());
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+    Benchmark_DoNotOptimize(Y_array_sum(values));
+}
+
+DEFINE_BENCHMARK(ParallelArraySum)
+{
+  pState->PauseTiming();
+  PODArray<float> values;
+  values.Resize(pState->GetArgument());
+  for (uint32 j = 0; j < values.GetSize(); j++)
+    values[j] = (float)(GetKey(j) % 1000);
+
+  ThreadPool threadPool;
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(values.GetSize());
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+    Benchmark_DoNotOptimize(Y_parallel_array_sum(&threadPool, values.GetBasePointer(), values.GetSize()));
+}
+
+// 1024 lookups an iteration, of keys spread over the array
+static const uint32 LowerBoundLookupCount = 1024;
+
+static void GetSortedValues(uint32 count, PODArray<int32>* pSorted, PODArray<int32>* pLookups)
+{
+  pSorted->Resize(count);
+  for (uint32 j = 0; j < count; j++)
+    (*pSorted)[j] = (int32)(j * 2);
+
+  pLookups->Resize(LowerBoundLookupCount);
+  for (uint32 j = 0; j < LowerBoundLookupCount; j++)
+    (*pLookups)[j] = (int32)(GetKey(j) % (count * 2));
+}
+
+DEFINE_BENCHMARK(EytzingerLowerBound)
+{
+  pState->PauseTiming();
+  PODArray<int32> sorted;
+  PODArray<int32> lookups;
+  PODArray<int32> layout;
+  GetSortedValues(pState->GetArgument(), &sorted, &lookups);
+  layout.Resize(sorted.GetSize());
+  Y_eytzinger_layout(layout.GetBasePointer(), sorted.GetBasePointer(), sorted.GetSize());
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(LowerBoundLookupCount);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    for (uint32 j = 0; j < LowerBoundLookupCount; j++)
+      Benchmark_DoNotOptimize(Y_eytzinger_lower_bound(layout.GetBasePointer(), layout.GetSize(), lookups[j]));
+  }
+}
+
+DEFINE_BENCHMARK(StdLowerBound)
+{
+  pState->PauseTiming();
+  PODArray<int32> sorted;
+  PODArray<int32> lookups;
+  GetSortedValues(pState->GetArgument(), &sorted, &lookups);
+  const int32* pBegin = sorted.GetBasePointer();
+  const int32* pEnd = pBegin + sorted.GetSize();
+  pState->ResumeTiming();
+  pState->SetItemsPerIteration(LowerBoundLookupCount);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    for (uint32 j = 0; j < LowerBoundLookupCount; j++)
+      Benchmark_DoNotOptimize(std::lower_bound(pBegin, pEnd, lookups[j]));
+  }
+}
@@ -0,0 +1,411 @@
+#include "Benchmark.h"
+#include "YBaseLib/AsyncFileStream.h"
+#include "YBaseLib/BinaryReader.h"
+#include "YBaseLib/BinarySchema.h"
+#include "YBaseLib/BinaryWriter.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/PODArray.h"
+
+// Reading a file through a plain file stream, a mapped one and the async queue, and BinaryReader, BinaryWriter and
+// BinarySchema on memory. The argument of the file reads is the block size, and an iteration reads the whole file,
+// which after the first read is in the page cache, so these compare the paths' overheads rather than the disk.
+
+static const uint32 ReadFileSize = 16 * 1024 * 1024;
+
+// the file the reads share, written the first time it's needed and deleted at exit
+class ReadFile
+{
+public:
+  ReadFile() : m_created(false) {}
+  ~ReadFile()
+  {
+    if (m_created)
+      FileSystem::DeleteFile(GetFileName());
+  }
+
+  const char* GetFileName() const { return "BenchIO.tmp"; }
+
+  bool Create()
+  {
+    if (m_created)
+      return true;
+
+    ByteStream* pStream = FileSystem::OpenFile(GetFileName(), BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE |
+                                                                BYTESTREAM_OPEN_TRUNCATE);
+    if (pStream == nullptr)
+      return false;
+
+    PODArray<uint32> block;
+    block.Resize(65536 / sizeof(uint32));
+    for (uint32 i = 0; i < block.GetSize(); i++)
+      block[i] = i * 2654435761u;
+
+    bool result = true;
+    for (uint32 offset = 0; offset < ReadFileSize && result; offset += 65536)
+      result = pStream->Write2(block.GetBasePointer(), 65536);
+
+    m_created = result && pStream->Commit();
+    pStream->Release();
+    return m_created;
+  }
+
+private:
+  bool m_created;
+};
+
+static ReadFile s_readFile;
+
+static void RunStreamRead(BenchmarkState* pState, uint32 openMode)
+{
+  uint32 blockSize = pState->GetArgument();
+  pState->SetBytesPerIteration(ReadFileSize);
+  pState->PauseTiming();
+  PODArray<byte> buffer;
+  buffer.Resize(blockSize);
+  bool created = s_readFile.Create();
+  pState->ResumeTiming();
+  if (!created)
+    return;
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    ByteStream* pStream = FileSystem::OpenFile(s_readFile.GetFileName(), openMode);
+    if (pStream == nullptr)
+      return;
+
+    while (pStream->Read(buffer.GetBasePointer(), blockSize) == blockSize)
+      Benchmark_ClobberMemory();
+    pStream->Release();
+  }
+}
+
+DEFINE_BENCHMARK(FileStreamRead)
+{
+  RunStreamRead(pState, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_STREAMED);
+}
+
+DEFINE_BENCHMARK(MappedStreamRead)
+{
+  RunStreamRead(pState, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_MAPPED);
+}
+
+// a block per request, with this many in flight, each resubmitted for the next block as it completes
+static const uint32 AsyncQueueDepth = 16;
+
+struct AsyncReadState
+{
+  uint64 NextOffset;
+  uint32 BlockSize;
+  bool Failed;
+};
+
+// completions all run on the queue's completion thread, so only one touches the state at a time
+static void OnAsyncReadComplete(AsyncFileRequest* pRequest)
+{
+  AsyncReadState* pReadState = static_cast<AsyncReadState*>(pRequest->pUserData);
+  if (!pRequest->Succeeded || pRequest->BytesTransferred != pRequest->Size)
+  {
+    pReadState->Failed = true;
+    return;
+  }
+
+  if (pReadState->NextOffset < ReadFileSize && !pReadState->Failed)
+  {
+    pRequest->Offset = pReadState->NextOffset;
+    pReadState->NextOffset += pReadState->BlockSize;
+    pRequest->GetStream()->Submit(pRequest);
+  }
+}
+
+DEFINE_BENCHMARK(AsyncFileStreamRead)
+{
+  uint32 blockSize = pState->GetArgument();
+  pState->SetBytesPerIteration(ReadFileSize);
+  pState->PauseTiming();
+  AsyncFileQueue queue;
+  AsyncFileStream* pStream = nullptr;
+  PODArray<byte> buffers;
+  buffers.Resize(blockSize * AsyncQueueDepth);
+  bool opened = s_readFile.Create() && queue.Initialize(AsyncQueueDepth) &&
+                queue.OpenFile(s_readFile.GetFileName(), BYTESTREAM_OPEN_READ, &pStream);
+  pState->ResumeTiming();
+  if (!opened)
+    return;
+
+  AsyncFileRequest requests[AsyncQueueDepth];
+  AsyncFileRequest* pRequests[AsyncQueueDepth];
+  AsyncReadState readState;
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    readState.NextOffset = 0;
+    readState.BlockSize = blockSize;
+    readState.Failed = false;
+
+    uint32 requestCount = 0;
+    for (; requestCount < AsyncQueueDepth && readState.NextOffset < ReadFileSize; requestCount++)
+    {
+      AsyncFileRequest& request = requests[requestCount];
+      request.Type = AsyncFileRequest::TYPE_READ;
+      request.pBuffer = buffers.GetBasePointer() + requestCount * blockSize;
+      request.Offset = readState.NextOffset;
+      request.Size = blockSize;
+      request.Callback = OnAsyncReadComplete;
+      request.pUserData = &readState;
+      pRequests[requestCount] = &request;
+      readState.NextOffset += blockSize;
+    }
+
+    pStream->Submit(pRequests, requestCount);
+    queue.WaitForIdle();
+    if (readState.Failed)
+      break;
+  }
+
+  pState->PauseTiming();
+  pStream->Release();
+  queue.Shutdown();
+}
+
+// an iteration writes or reads this many values
+static const uint32 BinaryValueCount = 16384;
+
+static void RunBinaryWrite(BenchmarkState* pState, bool useArray)
+{
+  bool buffered = (pState->GetArgument() != 0);
+  pState->SetBytesPerIteration(BinaryValueCount * sizeof(uint32));
+  pState->PauseTiming();
+  PODArray<uint32> values;
+  for (uint32 i = 0; i < BinaryValueCount; i++)
+    values.Add(i * 2654435761u);
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    pStream->SeekAbsolute(0);
+    BinaryWriter writer(pStream, Y_HOST_ENDIAN_TYPE, false, buffered);
+    if (useArray)
+    {
+      writer.WriteArray(values.GetBasePointer(), BinaryValueCount);
+    }
+    else
+    {
+      for (uint32 j = 0; j < BinaryValueCount; j++)
+        writer.WriteUInt32(values[j]);
+    }
+  }
+
+  pState->PauseTiming();
+  pStream->Release();
+}
+
+static void RunBinaryRead(BenchmarkState* pState, bool useArray)
+{
+  bool buffered = (pState->GetArgument() != 0);
+  pState->SetBytesPerIteration(BinaryValueCount * sizeof(uint32));
+  pState->PauseTiming();
+  PODArray<uint32> values;
+  for (uint32 i = 0; i < BinaryValueCount; i++)
+    values.Add(i * 2654435761u);
+  ReadOnlyMemoryByteStream* pStream =
+    ByteStream_CreateReadOnlyMemoryStream(values.GetBasePointer(), BinaryValueCount * sizeof(uint32));
+  PODArray<uint32> readValues;
+  readValues.Resize(BinaryValueCount);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    pStream->SeekAbsolute(0);
+    BinaryReader reader(pStream, Y_HOST_ENDIAN_TYPE, false, buffered);
+    if (useArray)
+    {
+      reader.ReadArray(readValues.GetBasePointer(), BinaryValueCount);
+      Benchmark_ClobberMemory();
+    }
+    else
+    {
+      for (uint32 j = 0; j < BinaryValueCount; j++)
+        Benchmark_DoNotOptimize(reader.ReadUInt32());
+    }
+  }
+
+  pState->PauseTiming();
+  pStream->Release();
+}
+
+// the argument is whether the writer or reader is buffered
+DEFINE_BENCHMARK(BinaryWriterWriteUInt32)
+{
+  RunBinaryWrite(pState, false);
+}
+
+DEFINE_BENCHMARK(BinaryWriterWriteArray)
+{
+  RunBinaryWrite(pState, true);
+}
+
+DEFINE_BENCHMARK(BinaryReaderReadUInt32)
+{
+  RunBinaryRead(pState, false);
+}
+
+DEFINE_BENCHMARK(BinaryReaderReadArray)
+{
+  RunBinaryRead(pState, true);
+}
+
+// a record with a run of plain fields and a string, as a schema and as a hand written sequence of fields
+struct BenchRecord
+{
+  uint32 ID;
+  uint32 Flags;
+  uint64 Timestamp;
+  float Position[4];
+  uint32 Counts[4];
+  String Name;
+};
+
+BEGIN_BINARY_SCHEMA(BenchRecord)
+BINARY_SCHEMA_FIELD(ID)
+BINARY_SCHEMA_FIELD(Flags)
+BINARY_SCHEMA_FIELD(Timestamp)
+BINARY_SCHEMA_FIELD(Position)
+BINARY_SCHEMA_FIELD(Counts)
+BINARY_SCHEMA_FIELD(Name)
+END_BINARY_SCHEMA()
+
+// an iteration writes or reads this many records
+static const uint32 BenchRecordCount = 1024;
+
+static void MakeBenchRecords(Array<BenchRecord>* pRecords)
+{
+  pRecords->Resize(BenchRecordCount);
+  for (uint32 i = 0; i < BenchRecordCount; i++)
+  {
+    BenchRecord& record = (*pRecords)[i];
+    record.ID = i;
+    record.Flags = i * 2654435761u;
+    record.Timestamp = (uint64)i << 20;
+    for (uint32 j = 0; j < 4; j++)
+    {
+      record.Position[j] = (float)(i + j);
+      record.Counts[j] = i ^ j;
+    }
+    record.Name.Format("record%u", i);
+  }
+}
+
+static void WriteBenchRecord(BinaryWriter* pWriter, const BenchRecord& record)
+{
+  pWriter->WriteUInt32(record.ID);
+  pWriter->WriteUInt32(record.Flags);
+  pWriter->WriteUInt64(record.Timestamp);
+  for (uint32 j = 0; j < 4; j++)
+    pWriter->WriteFloat(record.Position[j]);
+  for (uint32 j = 0; j < 4; j++)
+    pWriter->WriteUInt32(record.Counts[j]);
+  pWriter->WriteSizePrefixedString(record.Name);
+}
+
+static void ReadBenchRecord(BinaryReader* pReader, BenchRecord* pRecord)
+{
+  pRecord->ID = pReader->ReadUInt32();
+  pRecord->Flags = pReader->ReadUInt32();
+  pRecord->Timestamp = pReader->ReadUInt64();
+  for (uint32 j = 0; j < 4; j++)
+    pRecord->Position[j] = pReader->ReadFloat();
+  for (uint32 j = 0; j < 4; j++)
+    pRecord->Counts[j] = pReader->ReadUInt32();
+  pReader->ReadSizePrefixedString(pRecord->Name);
+}
+
+// the argument is 0 for the schema and 1 for the buffered writer's field sequence
+DEFINE_BENCHMARK(BinarySchemaEncode)
+{
+  pState->SetItemsPerIteration(BenchRecordCount);
+  pState->PauseTiming();
+  Array<BenchRecord> records;
+  MakeBenchRecords(&records);
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    pStream->SeekAbsolute(0);
+    BinaryWriter writer(pStream, Y_HOST_ENDIAN_TYPE, false, true);
+    for (uint32 j = 0; j < BenchRecordCount; j++)
+    {
+      if (pState->GetArgument() == 0)
+        BinarySchema::Write(&writer, records[j]);
+      else
+        WriteBenchRecord(&writer, records[j]);
+    }
+  }
+
+  pState->PauseTiming();
+  pStream->Release();
+}
+
+// The argument is 0 for the schema, 1 for the buffered reader's field sequence, and 2 for reading every field from
+// views, without a decode.
+DEFINE_BENCHMARK(BinarySchemaDecode)
+{
+  uint32 method = pState->GetArgument();
+  pState->SetItemsPerIteration(BenchRecordCount);
+  pState->PauseTiming();
+  Array<BenchRecord> records;
+  MakeBenchRecords(&records);
+  PODArray<byte> encoded;
+  {
+    GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+    BinaryWriter writer(pStream, Y_HOST_ENDIAN_TYPE, false, true);
+    for (uint32 j = 0; j < BenchRecordCount; j++)
+    {
+      if (method == 1)
+        WriteBenchRecord(&writer, records[j]);
+      else
+        BinarySchema::Write(&writer, records[j]);
+    }
+    writer.SyncStream();
+    encoded.AddRange(pStream->GetMemoryPointer(), (uint32)pStream->GetSize());
+    pStream->Release();
+  }
+  ReadOnlyMemoryByteStream* pStream =
+    ByteStream_CreateReadOnlyMemoryStream(encoded.GetBasePointer(), encoded.GetSize());
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    if (method == 2)
+    {
+      const byte* pData = encoded.GetBasePointer();
+      for (uint32 j = 0; j < BenchRecordCount; j++)
+      {
+        BinarySchemaView<BenchRecord> view(pData, encoded.GetBasePointer() + encoded.GetSize() - pData);
+        Benchmark_DoNotOptimize(view.Get(&BenchRecord::ID));
+        Benchmark_DoNotOptimize(view.Get(&BenchRecord::Flags));
+        Benchmark_DoNotOptimize(view.Get(&BenchRecord::Timestamp));
+        Benchmark_DoNotOptimize(view.Get(&BenchRecord::Position)[3]);
+        Benchmark_DoNotOptimize(view.Get(&BenchRecord::Counts)[3]);
+        Benchmark_DoNotOptimize(view.Get(&BenchRecord::Name).GetLength());
+        pData += view.GetSize();
+      }
+      continue;
+    }
+
+    pStream->SeekAbsolute(0);
+    BinaryReader reader(pStream, Y_HOST_ENDIAN_TYPE, false, true);
+    for (uint32 j = 0; j < BenchRecordCount; j++)
+    {
+      if (method == 0)
+        BinarySchema::Read(&reader, &records[j]);
+      else
+        ReadBenchRecord(&reader, &records[j]);
+    }
+    Benchmark_ClobberMemory();
+  }
+
+  pState->PauseTiming();
+  pStream->Release();
+}
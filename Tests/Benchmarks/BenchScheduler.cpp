@@ -0,0 +1,239 @@
+#include "Benchmark.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Event.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/TaskQueue.h"
+#include "YBaseLib/Thread.h"
+#include "YBaseLib/ThreadPool.h"
+
+// TaskQueue and ThreadPool: queueing throughput with several producers, the cost of an empty task, round trips, and
+// how a batch of work scales with the number of workers. Queues and pools are created outside the timing, and an
+// iteration is a task unless a benchmark says otherwise. Counts past the machine's processors oversubscribe it,
+// which is worth seeing too, so compare curves on the same machine.
+
+// Queues its share of the tasks once told to start, so producers start together and their creation isn't timed.
+class ProducerThread : public Thread
+{
+public:
+  ProducerThread(TaskQueue* pTaskQueue, Event* pStartEvent, uint32 taskCount)
+    : m_pTaskQueue(pTaskQueue), m_pStartEvent(pStartEvent), m_taskCount(taskCount)
+  {
+  }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    m_pStartEvent->Wait();
+    for (uint32 i = 0; i < m_taskCount; i++)
+      m_pTaskQueue->QueueLambdaTask([]() {});
+
+    return 0;
+  }
+
+private:
+  TaskQueue* m_pTaskQueue;
+  Event* m_pStartEvent;
+  uint32 m_taskCount;
+};
+
+// The argument is the number of producers, queueing to one worker, so this is the fifo under contention. The time
+// runs until the worker has executed every task, which a blocking task queued behind them shows.
+static void RunTaskQueueEnqueue(BenchmarkState* pState, bool lockFreeProducers)
+{
+  uint32 producerCount = pState->GetArgument();
+  pState->SetItemsPerIteration(1);
+  pState->PauseTiming();
+  TaskQueue taskQueue;
+  taskQueue.Initialize(TaskQueue::DefaultQueueSize, 1, lockFreeProducers);
+  Event startEvent;
+  PODArray<ProducerThread*> producers;
+  for (uint32 i = 0; i < producerCount; i++)
+  {
+    uint32 taskCount = pState->GetIterationCount() / producerCount +
+                       ((i < (pState->GetIterationCount() % producerCount)) ? 1 : 0);
+    ProducerThread* pProducer = new ProducerThread(&taskQueue, &startEvent, taskCount);
+    pProducer->Start();
+    producers.Add(pProducer);
+  }
+  pState->ResumeTiming();
+
+  startEvent.Signal();
+  for (uint32 i = 0; i < producers.GetSize(); i++)
+    producers[i]->Join();
+  taskQueue.QueueBlockingLambdaTask([]() {});
+
+  pState->PauseTiming();
+  for (uint32 i = 0; i < producers.GetSize(); i++)
+    delete producers[i];
+  taskQueue.ExitWorkers();
+}
+
+DEFINE_BENCHMARK(TaskQueueEnqueue)
+{
+  RunTaskQueueEnqueue(pState, false);
+}
+
+DEFINE_BENCHMARK(TaskQueueEnqueueLockFree)
+{
+  RunTaskQueueEnqueue(pState, true);
+}
+
+// queueing and running an empty task on a queue without workers, so there's no other thread involved
+DEFINE_BENCHMARK(TaskQueueEmptyTask)
+{
+  pState->SetItemsPerIteration(1);
+  pState->PauseTiming();
+  TaskQueue taskQueue;
+  taskQueue.Initialize(TaskQueue::DefaultQueueSize, 0);
+  pState->ResumeTiming();
+
+  // in chunks, so the fifo never fills
+  for (uint32 i = 0; i < pState->GetIterationCount();)
+  {
+    uint32 chunkEnd = Min(i + 4096, pState->GetIterationCount());
+    for (; i < chunkEnd; i++)
+      taskQueue.QueueLambdaTask([]() {});
+    taskQueue.ExecuteQueuedTasks();
+  }
+}
+
+// the same, queueing each chunk in one batch
+DEFINE_BENCHMARK(TaskQueueEmptyTaskBatched)
+{
+  pState->SetItemsPerIteration(1);
+  pState->PauseTiming();
+  TaskQueue taskQueue;
+  taskQueue.Initialize(TaskQueue::DefaultQueueSize, 0);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount();)
+  {
+    uint32 chunkEnd = Min(i + 4096, pState->GetIterationCount());
+    {
+      TaskQueue::BatchScope batch(&taskQueue);
+      for (; i < chunkEnd; i++)
+        batch.QueueLambdaTask([]() {});
+    }
+    taskQueue.ExecuteQueuedTasks();
+  }
+}
+
+// an iteration queues an empty task to a worker and waits for it to run, so it's a wakeup there and back
+DEFINE_BENCHMARK(TaskQueueBlockingRoundTrip)
+{
+  pState->PauseTiming();
+  TaskQueue taskQueue;
+  taskQueue.Initialize(TaskQueue::DefaultQueueSize, 1);
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+    taskQueue.QueueBlockingLambdaTask([]() {});
+
+  pState->PauseTiming();
+  taskQueue.ExitWorkers();
+}
+
+// An iteration fans out the argument's number of tasks, with a worker per processor past the first, and waits on
+// their counter, so this is the latency of a fork and join rather than throughput.
+DEFINE_BENCHMARK(TaskQueueFanOutFanIn)
+{
+  uint32 taskCount = pState->GetArgument();
+  pState->PauseTiming();
+  TaskQueue taskQueue;
+  taskQueue.Initialize(TaskQueue::DefaultQueueSize, ThreadPool::GetDefaultWorkerThreadCount());
+  TaskQueue::JobCounter counter;
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    for (uint32 j = 0; j < taskCount; j++)
+      taskQueue.QueueCountedLambdaTask(&counter, []() {});
+    taskQueue.WaitForCounter(&counter);
+  }
+
+  pState->PauseTiming();
+  taskQueue.ExitWorkers();
+}
+
+// Counts down a batch of items and wakes the thread waiting on them once the last has run.
+class BatchCompletion
+{
+public:
+  BatchCompletion() : m_remaining(0), m_event(true) {}
+
+  void Begin(uint32 count) { m_remaining = count; }
+  void Wait() { m_event.Wait(); }
+  void OnItemCompleted()
+  {
+    if (Y_AtomicDecrement(m_remaining) == 0)
+      m_event.Signal();
+  }
+
+private:
+  Y_ATOMIC_DECL uint32 m_remaining;
+  Event m_event;
+};
+
+// Hashes a running value spinCount times, a stand-in for a piece of real work that doesn't touch memory.
+class SpinWorkItem : public ThreadPoolWorkItem
+{
+public:
+  SpinWorkItem(BatchCompletion* pCompletion, uint32 spinCount) : m_pCompletion(pCompletion), m_spinCount(spinCount) {}
+
+protected:
+  virtual int32 ProcessWork() override
+  {
+    uint32 value = m_spinCount;
+    for (uint32 i = 0; i < m_spinCount; i++)
+      value = (value ^ (value >> 15)) * 2246822519u + i;
+    Benchmark_DoNotOptimize(value);
+
+    m_pCompletion->OnItemCompleted();
+    return 0;
+  }
+
+private:
+  BatchCompletion* m_pCompletion;
+  uint32 m_spinCount;
+};
+
+// an iteration is a batch of this many items, queued at once
+static const uint32 ThreadPoolBatchSize = 256;
+
+// queues a batch of items of spinCount each and waits for them, an iteration of the pool benchmarks
+static void RunThreadPoolBatches(BenchmarkState* pState, uint32 spinCount)
+{
+  uint32 workerCount = pState->GetArgument();
+  pState->SetItemsPerIteration(ThreadPoolBatchSize);
+  pState->PauseTiming();
+  ThreadPool threadPool(workerCount);
+  BatchCompletion completion;
+  ThreadPoolWorkItem* pItems[ThreadPoolBatchSize];
+  pState->ResumeTiming();
+
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    completion.Begin(ThreadPoolBatchSize);
+    for (uint32 j = 0; j < ThreadPoolBatchSize; j++)
+      pItems[j] = new SpinWorkItem(&completion, spinCount);
+    threadPool.EnqueueWorkItems(pItems, ThreadPoolBatchSize);
+    for (uint32 j = 0; j < ThreadPoolBatchSize; j++)
+      pItems[j]->Release();
+    completion.Wait();
+  }
+
+  pState->PauseTiming();
+}
+
+// the argument is the number of workers, the items do nothing, so this is the pool's own overhead per item
+DEFINE_BENCHMARK(ThreadPoolEmptyItems)
+{
+  RunThreadPoolBatches(pState, 0);
+}
+
+// The argument is the number of workers, the items take a few microseconds each, so the time per batch against the
+// worker count is the pool's scaling curve.
+DEFINE_BENCHMARK(ThreadPoolScaling)
+{
+  RunThreadPoolBatches(pState, 2000);
+}
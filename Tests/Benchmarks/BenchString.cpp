@@ -0,0 +1,167 @@
+#include "Benchmark.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/StringConverter.h"
+#include <cstdio>
+#include <string>
+
+// String and StringConverter next to std::string and the standard conversions.
+
+// values converted per iteration, spread over the range
+static const uint32 ConversionCount = 256;
+
+static int32 GetInt32Value(uint32 index)
+{
+  return (int32)(index * 2654435761u) >> (index % 24);
+}
+
+static double GetDoubleValue(uint32 index)
+{
+  return (double)GetInt32Value(index) / 1024.0;
+}
+
+// the argument is the number of pieces appended to an empty string
+DEFINE_BENCHMARK(StringAppend)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    String str;
+    for (uint32 j = 0; j < count; j++)
+    {
+      str.AppendString("piece ");
+      str.AppendCharacter('a' + (char)(j % 26));
+    }
+    Benchmark_DoNotOptimize(str.GetCharArray());
+  }
+}
+
+DEFINE_BENCHMARK(StdStringAppend)
+{
+  uint32 count = pState->GetArgument();
+  pState->SetItemsPerIteration(count);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    std::string str;
+    for (uint32 j = 0; j < count; j++)
+    {
+      str.append("piece ");
+      str.push_back('a' + (char)(j % 26));
+    }
+    Benchmark_DoNotOptimize(str.c_str());
+  }
+}
+
+DEFINE_BENCHMARK(StringFormat)
+{
+  String str;
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    str.Format("%s %u: %.3f", "value", i, (double)i * 0.5);
+    Benchmark_DoNotOptimize(str.GetCharArray());
+  }
+}
+
+// std::string can't format, so snprintf measures then fills it
+DEFINE_BENCHMARK(StdStringFormat)
+{
+  std::string str;
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    int length = std::snprintf(nullptr, 0, "%s %u: %.3f", "value", i, (double)i * 0.5);
+    str.resize((size_t)length);
+    std::snprintf(&str[0], (size_t)length + 1, "%s %u: %.3f", "value", i, (double)i * 0.5);
+    Benchmark_DoNotOptimize(str.c_str());
+  }
+}
+
+// the argument is the length; the strings differ only in their last character
+DEFINE_BENCHMARK(StringCompare)
+{
+  uint32 length = pState->GetArgument();
+  String left, right;
+  for (uint32 j = 0; j < length; j++)
+  {
+    left.AppendCharacter('a' + (char)(j % 26));
+    right.AppendCharacter((j + 1 < length) ? ('a' + (char)(j % 26)) : '!');
+  }
+
+  pState->SetBytesPerIteration(length);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    Benchmark_DoNotOptimize(left.Compare(right));
+    Benchmark_DoNotOptimize(left.NumericCompare(right));
+  }
+}
+
+DEFINE_BENCHMARK(StdStringCompare)
+{
+  uint32 length = pState->GetArgument();
+  std::string left, right;
+  for (uint32 j = 0; j < length; j++)
+  {
+    left.push_back('a' + (char)(j % 26));
+    right.push_back((j + 1 < length) ? ('a' + (char)(j % 26)) : '!');
+  }
+
+  pState->SetBytesPerIteration(length);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    Benchmark_DoNotOptimize(left == right);
+    Benchmark_DoNotOptimize(left.compare(right));
+  }
+}
+
+DEFINE_BENCHMARK(StringConverterInt32RoundTrip)
+{
+  pState->SetItemsPerIteration(ConversionCount);
+  String str;
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    for (uint32 j = 0; j < ConversionCount; j++)
+    {
+      StringConverter::Int32ToString(str, GetInt32Value(j));
+      Benchmark_DoNotOptimize(StringConverter::StringToInt32(str));
+    }
+  }
+}
+
+DEFINE_BENCHMARK(StdInt32RoundTrip)
+{
+  pState->SetItemsPerIteration(ConversionCount);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    for (uint32 j = 0; j < ConversionCount; j++)
+    {
+      std::string str = std::to_string(GetInt32Value(j));
+      Benchmark_DoNotOptimize(std::stoi(str));
+    }
+  }
+}
+
+DEFINE_BENCHMARK(StringConverterDoubleRoundTrip)
+{
+  pState->SetItemsPerIteration(ConversionCount);
+  String str;
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    for (uint32 j = 0; j < ConversionCount; j++)
+    {
+      StringConverter::DoubleToString(str, GetDoubleValue(j));
+      Benchmark_DoNotOptimize(StringConverter::StringToDouble(str));
+    }
+  }
+}
+
+DEFINE_BENCHMARK(StdDoubleRoundTrip)
+{
+  pState->SetItemsPerIteration(ConversionCount);
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+  {
+    for (uint32 j = 0; j < ConversionCount; j++)
+    {
+      std::string str = std::to_string(GetDoubleValue(j));
+      Benchmark_DoNotOptimize(std::stod(str));
+    }
+  }
+}
@@ -0,0 +1,25 @@
+#include "Benchmark.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Timer.h"
+
+// the costs instrumentation is built from
+
+DEFINE_BENCHMARK(TimerGetValue)
+{
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+    Benchmark_DoNotOptimize(Y_TimerGetValue());
+}
+
+DEFINE_BENCHMARK(FastTimerGetValue)
+{
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+    Benchmark_DoNotOptimize(Y_FastTimerGetValue());
+}
+
+DEFINE_BENCHMARK(AtomicIncrement)
+{
+  Y_ATOMIC_DECL uint32 value = 0;
+  for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+    Y_AtomicIncrement(value);
+  Benchmark_DoNotOptimize(value);
+}
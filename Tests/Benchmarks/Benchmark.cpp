@@ -0,0 +1,252 @@
+#include "Benchmark.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CPUID.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/TextWriter.h"
+#include "YBaseLib/Thread.h"
+#include "YBaseLib/Timestamp.h"
+#include <cmath>
+Log_SetChannel(Benchmark);
+
+#if defined(Y_COMPILER_MSVC)
+volatile const void* g_pBenchmarkSink;
+#endif
+
+// counts stop doubling here, so a benchmark with nothing in its loop still finishes
+static const uint32 MaxIterationCount = 1u << 30;
+
+BenchmarkState::BenchmarkState(uint32 iterationCount, uint32 argument)
+  : m_iterationCount(iterationCount), m_argument(argument), m_bytesPerIteration(0), m_itemsPerIteration(0),
+    m_elapsedSeconds(0.0), m_startTime(0), m_running(false)
+{
+}
+
+void BenchmarkState::PauseTiming()
+{
+  if (!m_running)
+    return;
+
+  m_elapsedSeconds += Y_TimerConvertToSeconds(Y_TimerGetValue() - m_startTime);
+  m_running = false;
+}
+
+void BenchmarkState::ResumeTiming()
+{
+  if (m_running)
+    return;
+
+  m_startTime = Y_TimerGetValue();
+  m_running = true;
+}
+
+void BenchmarkState::StartTiming()
+{
+  m_elapsedSeconds = 0.0;
+  ResumeTiming();
+}
+
+double BenchmarkState::StopTiming()
+{
+  PauseTiming();
+  return m_elapsedSeconds;
+}
+
+BenchmarkOptions::BenchmarkOptions()
+  : Filter(nullptr), MinSampleTime(0.01), WarmupTime(0.1), SampleCount(20), PinProcessor(-1), JSONFileName(nullptr)
+{
+}
+
+namespace {
+
+struct BenchmarkResult
+{
+  const char* Name;
+  uint32 IterationCount;
+  uint32 SampleCount;
+
+  // nanoseconds an iteration took
+  double Min;
+  double Median;
+  double Mean;
+  double P99;
+  double Max;
+  double StdDev;
+
+  // per second at the median, zero if the benchmark didn't say what an iteration does
+  double BytesPerSecond;
+  double ItemsPerSecond;
+};
+
+} // namespace
+
+// runs the benchmark once at the count, returning how long it took
+static double RunOnce(const BenchmarkEntry& entry, uint32 iterationCount, BenchmarkState* pLastState = nullptr)
+{
+  BenchmarkState state(iterationCount, entry.Argument);
+  state.StartTiming();
+  entry.Function(&state);
+  double elapsed = state.StopTiming();
+  if (pLastState != nullptr)
+    *pLastState = state;
+
+  return elapsed;
+}
+
+// the nearest-rank percentile of sorted values
+static double GetPercentile(const PODArray<double>& sortedValues, double fraction)
+{
+  uint32 rank = (uint32)std::ceil(fraction * (double)sortedValues.GetSize());
+  return sortedValues[(rank > 0) ? (rank - 1) : 0];
+}
+
+static void RunBenchmark(const BenchmarkEntry& entry, const BenchmarkOptions& options, BenchmarkResult* pResult)
+{
+  // grow the count until a call takes a sample's time, aiming a little past it from the last call's
+  uint32 iterationCount = 1;
+  for (;;)
+  {
+    double elapsed = RunOnce(entry, iterationCount);
+    if (elapsed >= options.MinSampleTime || iterationCount >= MaxIterationCount)
+      break;
+
+    double scale = (elapsed > 0.0) ? (options.MinSampleTime * 1.2 / elapsed) : 100.0;
+    scale = Max(Min(scale, 100.0), 2.0);
+    iterationCount = (uint32)Min((double)iterationCount * scale, (double)MaxIterationCount);
+  }
+
+  // caches, branch predictors and clocks settle
+  for (double warmupElapsed = 0.0; warmupElapsed < options.WarmupTime;)
+    warmupElapsed += RunOnce(entry, iterationCount);
+
+  BenchmarkState lastState(iterationCount, entry.Argument);
+  PODArray<double> samples;
+  double sum = 0.0;
+  for (uint32 i = 0; i < options.SampleCount; i++)
+  {
+    double sample = RunOnce(entry, iterationCount, &lastState) * 1000000000.0 / (double)iterationCount;
+    samples.Add(sample);
+    sum += sample;
+  }
+  samples.SortCB(
+    [](const double& left, const double& right) { return (left < right) ? -1 : ((left > right) ? 1 : 0); });
+
+  pResult->Name = entry.Name;
+  pResult->IterationCount = iterationCount;
+  pResult->SampleCount = samples.GetSize();
+  pResult->Min = samples.FirstElement();
+  pResult->Median = GetPercentile(samples, 0.5);
+  pResult->Mean = sum / (double)samples.GetSize();
+  pResult->P99 = GetPercentile(samples, 0.99);
+  pResult->Max = samples.LastElement();
+
+  double variance = 0.0;
+  for (double sample : samples)
+    variance += (sample - pResult->Mean) * (sample - pResult->Mean);
+  pResult->StdDev = std::sqrt(variance / (double)samples.GetSize());
+
+  double iterationsPerSecond = (pResult->Median > 0.0) ? (1000000000.0 / pResult->Median) : 0.0;
+  pResult->BytesPerSecond = (double)lastState.GetBytesPerIteration() * iterationsPerSecond;
+  pResult->ItemsPerSecond = (double)lastState.GetItemsPerIteration() * iterationsPerSecond;
+}
+
+static void AppendJSONString(String& destination, const char* str)
+{
+  destination.AppendCharacter('"');
+  for (const char* pChar = str; *pChar != '\0'; pChar++)
+  {
+    if (*pChar == '"' || *pChar == '\\')
+      destination.AppendCharacter('\\');
+    if ((unsigned char)*pChar >= 0x20)
+      destination.AppendCharacter(*pChar);
+  }
+  destination.AppendCharacter('"');
+}
+
+// {"context":{...},"benchmarks":[{...},...]}, times in nanoseconds
+static bool WriteJSON(const char* fileName, const PODArray<BenchmarkResult>& results, const BenchmarkOptions& options)
+{
+  ByteStream* pStream = FileSystem::OpenFile(fileName, BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE |
+                                                         BYTESTREAM_OPEN_TRUNCATE | BYTESTREAM_OPEN_ATOMIC_UPDATE);
+  if (pStream == nullptr)
+  {
+    Log_ErrorPrintf("Benchmark_Run: Failed to open '%s'", fileName);
+    return false;
+  }
+
+  Y_CPUID_RESULT cpuid;
+  Y_CPU_TOPOLOGY topology;
+  Y_ReadCPUID(&cpuid);
+  Y_ReadCPUTopology(&topology);
+
+  TextWriter writer(pStream);
+  String line;
+  line.Format("{\"context\":{\"date\":\"%s\",\"cpu\":", Timestamp::Now().ToString("%Y-%m-%dT%H:%M:%S").GetCharArray());
+  AppendJSONString(line, cpuid.BrandString);
+  line.AppendFormattedString(",\"cpu_architecture\":\"%s\",\"processors\":%u,\"pinned_processor\":%d,",
+                             Y_CPU_STR, topology.LogicalProcessorCount, options.PinProcessor);
+  line.AppendFormattedString("\"fast_timer_uses_cpu_counter\":%s},", Y_FastTimerUsesCPUCounter() ? "true" : "false");
+  writer.WriteLine(line);
+  writer.WriteLine("\"benchmarks\":[");
+
+  for (uint32 i = 0; i < results.GetSize(); i++)
+  {
+    const BenchmarkResult& result = results[i];
+    line.Assign("{\"name\":");
+    AppendJSONString(line, result.Name);
+    line.AppendFormattedString(",\"iterations\":%u,\"samples\":%u,\"min_ns\":%.3f,\"median_ns\":%.3f,"
+                               "\"mean_ns\":%.3f,\"p99_ns\":%.3f,\"max_ns\":%.3f,\"stddev_ns\":%.3f,"
+                               "\"bytes_per_second\":%.1f,\"items_per_second\":%.1f}%s",
+                               result.IterationCount, result.SampleCount, result.Min, result.Median, result.Mean,
+                               result.P99, result.Max, result.StdDev, result.BytesPerSecond, result.ItemsPerSecond,
+                               (i + 1 < results.GetSize()) ? "," : "");
+    writer.WriteLine(line);
+  }
+
+  writer.WriteLine("]}");
+  bool result = writer.Flush() && !pStream->InErrorState() && pStream->Commit();
+  pStream->Release();
+  if (!result)
+    Log_ErrorPrintf("Benchmark_Run: Failed to write '%s'", fileName);
+
+  return result;
+}
+
+bool Benchmark_Run(const BenchmarkEntry* pEntries, uint32 entryCount, const BenchmarkOptions& options)
+{
+  if (options.PinProcessor >= 0 && !Thread::SetCurrentThreadAffinityMask(uint64(1) << options.PinProcessor))
+    Log_WarningPrintf("Benchmark_Run: Failed to pin to processor %d, running unpinned", options.PinProcessor);
+
+  String filter((options.Filter != nullptr) ? options.Filter : "");
+  filter.ToLower();
+
+  PODArray<BenchmarkResult> results;
+  for (uint32 i = 0; i < entryCount; i++)
+  {
+    String name(pEntries[i].Name);
+    name.ToLower();
+    if (!filter.IsEmpty() && name.Find(filter) < 0)
+      continue;
+
+    BenchmarkResult result;
+    RunBenchmark(pEntries[i], options, &result);
+    results.Add(result);
+
+    SmallString throughput;
+    if (result.BytesPerSecond > 0.0)
+      throughput.Format(" %10.1f MB/s", result.BytesPerSecond / 1048576.0);
+    else if (result.ItemsPerSecond > 0.0)
+      throughput.Format(" %10.3f M items/s", result.ItemsPerSecond / 1000000.0);
+
+    Log_InfoPrintf("%-48s min %12.1fns median %12.1fns p99 %12.1fns (%u iterations)%s", result.Name, result.Min,
+                   result.Median, result.P99, result.IterationCount, throughput.GetCharArray());
+  }
+
+  if (results.IsEmpty())
+    Log_WarningPrintf("Benchmark_Run: No benchmarks match '%s'", filter.GetCharArray());
+
+  return (options.JSONFileName == nullptr || WriteJSON(options.JSONFileName, results, options));
+}
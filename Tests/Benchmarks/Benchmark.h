@@ -0,0 +1,112 @@
+#pragma once
+#include "YBaseLib/Common.h"
+#include "YBaseLib/Timer.h"
+
+// A benchmark is a function running the code under test GetIterationCount() times, which the harness calls
+// repeatedly: it doubles the count until a call takes long enough to time, warms up, then takes samples and reports
+// the per-iteration times. Setup inside the function can be left out of the time with PauseTiming/ResumeTiming.
+//   DEFINE_BENCHMARK(HashTableFind)
+//   {
+//     pState->PauseTiming();
+//     ... fill the table with pState->GetArgument() entries
+//     pState->ResumeTiming();
+//     for (uint32 i = 0; i < pState->GetIterationCount(); i++)
+//       Benchmark_DoNotOptimize(table.Find(i));
+//   }
+// Benchmarks are listed in Main.cpp, where each entry gives the argument, so one function can run at several sizes.
+class BenchmarkState
+{
+public:
+  BenchmarkState(uint32 iterationCount, uint32 argument);
+
+  uint32 GetIterationCount() const { return m_iterationCount; }
+
+  // the value from the benchmark's entry, like a container size
+  uint32 GetArgument() const { return m_argument; }
+
+  void PauseTiming();
+  void ResumeTiming();
+
+  // for reporting throughput, the bytes or items one iteration processes
+  void SetBytesPerIteration(uint64 bytes) { m_bytesPerIteration = bytes; }
+  void SetItemsPerIteration(uint64 items) { m_itemsPerIteration = items; }
+
+  // the harness's side
+  void StartTiming();
+  double StopTiming();
+  uint64 GetBytesPerIteration() const { return m_bytesPerIteration; }
+  uint64 GetItemsPerIteration() const { return m_itemsPerIteration; }
+
+private:
+  uint32 m_iterationCount;
+  uint32 m_argument;
+  uint64 m_bytesPerIteration;
+  uint64 m_itemsPerIteration;
+
+  // time counted so far, and when the current stretch started if running
+  double m_elapsedSeconds;
+  Y_TIMER_VALUE m_startTime;
+  bool m_running;
+};
+
+typedef void (*BenchmarkFunction)(BenchmarkState* pState);
+
+#define DECLARE_BENCHMARK(name) void __benchmark_##name(BenchmarkState* pState)
+#define DEFINE_BENCHMARK(name) void __benchmark_##name(BenchmarkState* pState)
+#define INVOKE_BENCHMARK(name) __benchmark_##name
+
+// Keeps the compiler from optimizing away a value, or the stores to memory before it, that the benchmark doesn't
+// otherwise use.
+#if defined(Y_COMPILER_MSVC)
+#include <intrin.h>
+extern volatile const void* g_pBenchmarkSink;
+template<typename T>
+inline void Benchmark_DoNotOptimize(const T& value)
+{
+  g_pBenchmarkSink = &value;
+  _ReadWriteBarrier();
+}
+inline void Benchmark_ClobberMemory()
+{
+  _ReadWriteBarrier();
+}
+#else
+template<typename T>
+inline void Benchmark_DoNotOptimize(const T& value)
+{
+  asm volatile("" : : "m"(value) : "memory");
+}
+inline void Benchmark_ClobberMemory()
+{
+  asm volatile("" : : : "memory");
+}
+#endif
+
+struct BenchmarkOptions
+{
+  BenchmarkOptions();
+
+  // run only benchmarks with this in their name, case insensitive
+  const char* Filter;
+
+  // the time a sample takes at least, the warm-up before them, and how many samples to take
+  double MinSampleTime;
+  double WarmupTime;
+  uint32 SampleCount;
+
+  // pins the running thread to a processor, -1 to leave it where the OS puts it
+  int32 PinProcessor;
+
+  // the results as JSON for comparing runs, null to only log them
+  const char* JSONFileName;
+};
+
+struct BenchmarkEntry
+{
+  const char* Name;
+  BenchmarkFunction Function;
+  uint32 Argument;
+};
+
+// Runs the entries matching the filter, logging a line for each. Returns false if the JSON can't be written.
+bool Benchmark_Run(const BenchmarkEntry* pEntries, uint32 entryCount, const BenchmarkOptions& options);
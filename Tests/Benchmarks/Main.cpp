@@ -0,0 +1,304 @@
+#include "Benchmark.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/StringConverter.h"
+Log_SetChannel(Main);
+
+DECLARE_BENCHMARK(ArrayCount);
+DECLARE_BENCHMARK(ArrayCountScalar);
+DECLARE_BENCHMARK(ArrayFilter);
+DECLARE_BENCHMARK(ArrayFilterScalar);
+DECLARE_BENCHMARK(ArrayFind);
+DECLARE_BENCHMARK(ArrayMinMax);
+DECLARE_BENCHMARK(ArrayMinMaxScalar);
+DECLARE_BENCHMARK(ArrayPrefixSum);
+DECLARE_BENCHMARK(ArrayPrefixSumScalar);
+DECLARE_BENCHMARK(ArraySum);
+DECLARE_BENCHMARK(AsyncFileStreamRead);
+DECLARE_BENCHMARK(AtomicIncrement);
+DECLARE_BENCHMARK(BinaryReaderReadArray);
+DECLARE_BENCHMARK(BinaryReaderReadUInt32);
+DECLARE_BENCHMARK(BinarySchemaDecode);
+DECLARE_BENCHMARK(BinarySchemaEncode);
+DECLARE_BENCHMARK(BinaryWriterWriteArray);
+DECLARE_BENCHMARK(BinaryWriterWriteUInt32);
+DECLARE_BENCHMARK(BitSetOperations);
+DECLARE_BENCHMARK(CIStringHashTableFind);
+DECLARE_BENCHMARK(CIStringHashTableInsert);
+DECLARE_BENCHMARK(CIStringHashTableRemove);
+DECLARE_BENCHMARK(CRC32HashBytes);
+DECLARE_BENCHMARK(EytzingerLowerBound);
+DECLARE_BENCHMARK(FastTimerGetValue);
+DECLARE_BENCHMARK(FileStreamRead);
+DECLARE_BENCHMARK(HashTableFind);
+DECLARE_BENCHMARK(HashTableInsert);
+DECLARE_BENCHMARK(HashTableRemove);
+DECLARE_BENCHMARK(MappedHashIndexFind);
+DECLARE_BENCHMARK(MappedHashIndexOpen);
+DECLARE_BENCHMARK(MappedStreamRead);
+DECLARE_BENCHMARK(MD5DigestUpdate);
+DECLARE_BENCHMARK(MemArrayAdd);
+DECLARE_BENCHMARK(ParallelArraySum);
+DECLARE_BENCHMARK(PODArrayAdd);
+DECLARE_BENCHMARK(PODArrayIndexOf);
+DECLARE_BENCHMARK(StdDoubleRoundTrip);
+DECLARE_BENCHMARK(StdInt32RoundTrip);
+DECLARE_BENCHMARK(StdLowerBound);
+DECLARE_BENCHMARK(StdStringAppend);
+DECLARE_BENCHMARK(StdStringCompare);
+DECLARE_BENCHMARK(StdStringFormat);
+DECLARE_BENCHMARK(StdUnorderedMapFind);
+DECLARE_BENCHMARK(StdUnorderedMapInsert);
+DECLARE_BENCHMARK(StdUnorderedMapRemove);
+DECLARE_BENCHMARK(StdUnorderedMapStringFind);
+DECLARE_BENCHMARK(StdUnorderedMapStringInsert);
+DECLARE_BENCHMARK(StdUnorderedMapStringRemove);
+DECLARE_BENCHMARK(StdVectorAdd);
+DECLARE_BENCHMARK(StdVectorBoolOperations);
+DECLARE_BENCHMARK(StringAppend);
+DECLARE_BENCHMARK(StringCompare);
+DECLARE_BENCHMARK(StringConverterDoubleRoundTrip);
+DECLARE_BENCHMARK(StringConverterInt32RoundTrip);
+DECLARE_BENCHMARK(StringFormat);
+DECLARE_BENCHMARK(StringHashTableFind);
+DECLARE_BENCHMARK(StringHashTableInsert);
+DECLARE_BENCHMARK(StringHashTableRemove);
+DECLARE_BENCHMARK(TaskQueueBlockingRoundTrip);
+DECLARE_BENCHMARK(TaskQueueEmptyTask);
+DECLARE_BENCHMARK(TaskQueueEmptyTaskBatched);
+DECLARE_BENCHMARK(TaskQueueEnqueue);
+DECLARE_BENCHMARK(TaskQueueEnqueueLockFree);
+DECLARE_BENCHMARK(TaskQueueFanOutFanIn);
+DECLARE_BENCHMARK(ThreadPoolEmptyItems);
+DECLARE_BENCHMARK(ThreadPoolScaling);
+DECLARE_BENCHMARK(TimerGetValue);
+#ifdef HAVE_ZLIB
+DECLARE_BENCHMARK(ZLibDeflate);
+DECLARE_BENCHMARK(ZLibInflate);
+DECLARE_BENCHMARK(ZipArchiveRead);
+DECLARE_BENCHMARK(ZipArchiveWrite);
+#endif
+
+static const BenchmarkEntry s_benchmarks[] = {
+  {"ArrayAlgorithms.Find/1024", INVOKE_BENCHMARK(ArrayFind), 1024},
+  {"ArrayAlgorithms.Find/65536", INVOKE_BENCHMARK(ArrayFind), 65536},
+  {"ArrayAlgorithms.IndexOf/1024", INVOKE_BENCHMARK(PODArrayIndexOf), 1024},
+  {"ArrayAlgorithms.IndexOf/65536", INVOKE_BENCHMARK(PODArrayIndexOf), 65536},
+  {"ArrayAlgorithms.Count/1024", INVOKE_BENCHMARK(ArrayCount), 1024},
+  {"ArrayAlgorithms.Count/65536", INVOKE_BENCHMARK(ArrayCount), 65536},
+  {"ArrayAlgorithms.CountScalar/1024", INVOKE_BENCHMARK(ArrayCountScalar), 1024},
+  {"ArrayAlgorithms.CountScalar/65536", INVOKE_BENCHMARK(ArrayCountScalar), 65536},
+  {"ArrayAlgorithms.Filter/1024", INVOKE_BENCHMARK(ArrayFilter), 1024},
+  {"ArrayAlgorithms.Filter/65536", INVOKE_BENCHMARK(ArrayFilter), 65536},
+  {"ArrayAlgorithms.FilterScalar/1024", INVOKE_BENCHMARK(ArrayFilterScalar), 1024},
+  {"ArrayAlgorithms.FilterScalar/65536", INVOKE_BENCHMARK(ArrayFilterScalar), 65536},
+  {"ArrayAlgorithms.MinMax/1024", INVOKE_BENCHMARK(ArrayMinMax), 1024},
+  {"ArrayAlgorithms.MinMax/65536", INVOKE_BENCHMARK(ArrayMinMax), 65536},
+  {"ArrayAlgorithms.MinMaxScalar/1024", INVOKE_BENCHMARK(ArrayMinMaxScalar), 1024},
+  {"ArrayAlgorithms.MinMaxScalar/65536", INVOKE_BENCHMARK(ArrayMinMaxScalar), 65536},
+  {"ArrayAlgorithms.PrefixSum/1024", INVOKE_BENCHMARK(ArrayPrefixSum), 1024},
+  {"ArrayAlgorithms.PrefixSum/65536", INVOKE_BENCHMARK(ArrayPrefixSum), 65536},
+  {"ArrayAlgorithms.PrefixSumScalar/1024", INVOKE_BENCHMARK(ArrayPrefixSumScalar), 1024},
+  {"ArrayAlgorithms.PrefixSumScalar/65536", INVOKE_BENCHMARK(ArrayPrefixSumScalar), 65536},
+  {"ArrayAlgorithms.Sum/65536", INVOKE_BENCHMARK(ArraySum), 65536},
+  {"ArrayAlgorithms.Sum/4194304", INVOKE_BENCHMARK(ArraySum), 4194304},
+  {"ArrayAlgorithms.ParallelSum/65536", INVOKE_BENCHMARK(ParallelArraySum), 65536},
+  {"ArrayAlgorithms.ParallelSum/4194304", INVOKE_BENCHMARK(ParallelArraySum), 4194304},
+  {"ArrayAlgorithms.EytzingerLowerBound/1024", INVOKE_BENCHMARK(EytzingerLowerBound), 1024},
+  {"ArrayAlgorithms.EytzingerLowerBound/65536", INVOKE_BENCHMARK(EytzingerLowerBound), 65536},
+  {"ArrayAlgorithms.EytzingerLowerBound/4194304", INVOKE_BENCHMARK(EytzingerLowerBound), 4194304},
+  {"ArrayAlgorithms.StdLowerBound/1024", INVOKE_BENCHMARK(StdLowerBound), 1024},
+  {"ArrayAlgorithms.StdLowerBound/65536", INVOKE_BENCHMARK(StdLowerBound), 65536},
+  {"ArrayAlgorithms.StdLowerBound/4194304", INVOKE_BENCHMARK(StdLowerBound), 4194304},
+  {"Atomic.Increment", INVOKE_BENCHMARK(AtomicIncrement), 0},
+  {"BinaryReader.ReadUInt32", INVOKE_BENCHMARK(BinaryReaderReadUInt32), 0},
+  {"BinaryReader.ReadUInt32/buffered", INVOKE_BENCHMARK(BinaryReaderReadUInt32), 1},
+  {"BinaryReader.ReadArray", INVOKE_BENCHMARK(BinaryReaderReadArray), 0},
+  {"BinaryReader.ReadArray/buffered", INVOKE_BENCHMARK(BinaryReaderReadArray), 1},
+  {"BinarySchema.Encode", INVOKE_BENCHMARK(BinarySchemaEncode), 0},
+  {"BinarySchema.Encode/handwritten", INVOKE_BENCHMARK(BinarySchemaEncode), 1},
+  {"BinarySchema.Decode", INVOKE_BENCHMARK(BinarySchemaDecode), 0},
+  {"BinarySchema.Decode/handwritten", INVOKE_BENCHMARK(BinarySchemaDecode), 1},
+  {"BinarySchema.Decode/view", INVOKE_BENCHMARK(BinarySchemaDecode), 2},
+  {"BinaryWriter.WriteUInt32", INVOKE_BENCHMARK(BinaryWriterWriteUInt32), 0},
+  {"BinaryWriter.WriteUInt32/buffered", INVOKE_BENCHMARK(BinaryWriterWriteUInt32), 1},
+  {"BinaryWriter.WriteArray", INVOKE_BENCHMARK(BinaryWriterWriteArray), 0},
+  {"BinaryWriter.WriteArray/buffered", INVOKE_BENCHMARK(BinaryWriterWriteArray), 1},
+  {"BitSet.Operations/64", INVOKE_BENCHMARK(BitSetOperations), 64},
+  {"BitSet.Operations/4096", INVOKE_BENCHMARK(BitSetOperations), 4096},
+  {"BitSet.Operations/262144", INVOKE_BENCHMARK(BitSetOperations), 262144},
+  {"BitSet.StdVectorBool/64", INVOKE_BENCHMARK(StdVectorBoolOperations), 64},
+  {"BitSet.StdVectorBool/4096", INVOKE_BENCHMARK(StdVectorBoolOperations), 4096},
+  {"BitSet.StdVectorBool/262144", INVOKE_BENCHMARK(StdVectorBoolOperations), 262144},
+  {"ByteStream.FileRead/4096", INVOKE_BENCHMARK(FileStreamRead), 4096},
+  {"ByteStream.FileRead/65536", INVOKE_BENCHMARK(FileStreamRead), 65536},
+  {"ByteStream.FileRead/1048576", INVOKE_BENCHMARK(FileStreamRead), 1048576},
+  {"ByteStream.MappedRead/4096", INVOKE_BENCHMARK(MappedStreamRead), 4096},
+  {"ByteStream.MappedRead/65536", INVOKE_BENCHMARK(MappedStreamRead), 65536},
+  {"ByteStream.MappedRead/1048576", INVOKE_BENCHMARK(MappedStreamRead), 1048576},
+  {"ByteStream.AsyncRead/4096", INVOKE_BENCHMARK(AsyncFileStreamRead), 4096},
+  {"ByteStream.AsyncRead/65536", INVOKE_BENCHMARK(AsyncFileStreamRead), 65536},
+  {"ByteStream.AsyncRead/1048576", INVOKE_BENCHMARK(AsyncFileStreamRead), 1048576},
+  {"CIStringHashTable.Insert/16", INVOKE_BENCHMARK(CIStringHashTableInsert), 16},
+  {"CIStringHashTable.Insert/1024", INVOKE_BENCHMARK(CIStringHashTableInsert), 1024},
+  {"CIStringHashTable.Insert/65536", INVOKE_BENCHMARK(CIStringHashTableInsert), 65536},
+  {"CIStringHashTable.Find/16", INVOKE_BENCHMARK(CIStringHashTableFind), 16},
+  {"CIStringHashTable.Find/1024", INVOKE_BENCHMARK(CIStringHashTableFind), 1024},
+  {"CIStringHashTable.Find/65536", INVOKE_BENCHMARK(CIStringHashTableFind), 65536},
+  {"CIStringHashTable.Remove/16", INVOKE_BENCHMARK(CIStringHashTableRemove), 16},
+  {"CIStringHashTable.Remove/1024", INVOKE_BENCHMARK(CIStringHashTableRemove), 1024},
+  {"CIStringHashTable.Remove/65536", INVOKE_BENCHMARK(CIStringHashTableRemove), 65536},
+  {"CRC32.HashBytes", INVOKE_BENCHMARK(CRC32HashBytes), 0},
+  {"HashTable.Insert/16", INVOKE_BENCHMARK(HashTableInsert), 16},
+  {"HashTable.Insert/1024", INVOKE_BENCHMARK(HashTableInsert), 1024},
+  {"HashTable.Insert/65536", INVOKE_BENCHMARK(HashTableInsert), 65536},
+  {"HashTable.StdUnorderedMapInsert/16", INVOKE_BENCHMARK(StdUnorderedMapInsert), 16},
+  {"HashTable.StdUnorderedMapInsert/1024", INVOKE_BENCHMARK(StdUnorderedMapInsert), 1024},
+  {"HashTable.StdUnorderedMapInsert/65536", INVOKE_BENCHMARK(StdUnorderedMapInsert), 65536},
+  {"HashTable.Find/16", INVOKE_BENCHMARK(HashTableFind), 16},
+  {"HashTable.Find/1024", INVOKE_BENCHMARK(HashTableFind), 1024},
+  {"HashTable.Find/65536", INVOKE_BENCHMARK(HashTableFind), 65536},
+  {"HashTable.StdUnorderedMapFind/16", INVOKE_BENCHMARK(StdUnorderedMapFind), 16},
+  {"HashTable.StdUnorderedMapFind/1024", INVOKE_BENCHMARK(StdUnorderedMapFind), 1024},
+  {"HashTable.StdUnorderedMapFind/65536", INVOKE_BENCHMARK(StdUnorderedMapFind), 65536},
+  {"HashTable.Remove/16", INVOKE_BENCHMARK(HashTableRemove), 16},
+  {"HashTable.Remove/1024", INVOKE_BENCHMARK(HashTableRemove), 1024},
+  {"HashTable.Remove/65536", INVOKE_BENCHMARK(HashTableRemove), 65536},
+  {"HashTable.StdUnorderedMapRemove/16", INVOKE_BENCHMARK(StdUnorderedMapRemove), 16},
+  {"HashTable.StdUnorderedMapRemove/1024", INVOKE_BENCHMARK(StdUnorderedMapRemove), 1024},
+  {"HashTable.StdUnorderedMapRemove/65536", INVOKE_BENCHMARK(StdUnorderedMapRemove), 65536},
+  {"MappedHashIndex.Open/16", INVOKE_BENCHMARK(MappedHashIndexOpen), 16},
+  {"MappedHashIndex.Open/1024", INVOKE_BENCHMARK(MappedHashIndexOpen), 1024},
+  {"MappedHashIndex.Open/65536", INVOKE_BENCHMARK(MappedHashIndexOpen), 65536},
+  {"MappedHashIndex.Find/16", INVOKE_BENCHMARK(MappedHashIndexFind), 16},
+  {"MappedHashIndex.Find/1024", INVOKE_BENCHMARK(MappedHashIndexFind), 1024},
+  {"MappedHashIndex.Find/65536", INVOKE_BENCHMARK(MappedHashIndexFind), 65536},
+  {"MD5Digest.Update", INVOKE_BENCHMARK(MD5DigestUpdate), 0},
+  {"MemArray.Add/16", INVOKE_BENCHMARK(MemArrayAdd), 16},
+  {"MemArray.Add/1024", INVOKE_BENCHMARK(MemArrayAdd), 1024},
+  {"MemArray.Add/65536", INVOKE_BENCHMARK(MemArrayAdd), 65536},
+  {"PODArray.Add/16", INVOKE_BENCHMARK(PODArrayAdd), 16},
+  {"PODArray.Add/1024", INVOKE_BENCHMARK(PODArrayAdd), 1024},
+  {"PODArray.Add/65536", INVOKE_BENCHMARK(PODArrayAdd), 65536},
+  {"PODArray.StdVectorAdd/16", INVOKE_BENCHMARK(StdVectorAdd), 16},
+  {"PODArray.StdVectorAdd/1024", INVOKE_BENCHMARK(StdVectorAdd), 1024},
+  {"PODArray.StdVectorAdd/65536", INVOKE_BENCHMARK(StdVectorAdd), 65536},
+  {"String.Append/16", INVOKE_BENCHMARK(StringAppend), 16},
+  {"String.Append/1024", INVOKE_BENCHMARK(StringAppend), 1024},
+  {"String.StdAppend/16", INVOKE_BENCHMARK(StdStringAppend), 16},
+  {"String.StdAppend/1024", INVOKE_BENCHMARK(StdStringAppend), 1024},
+  {"String.Compare/16", INVOKE_BENCHMARK(StringCompare), 16},
+  {"String.Compare/1024", INVOKE_BENCHMARK(StringCompare), 1024},
+  {"String.StdCompare/16", INVOKE_BENCHMARK(StdStringCompare), 16},
+  {"String.StdCompare/1024", INVOKE_BENCHMARK(StdStringCompare), 1024},
+  {"String.Format", INVOKE_BENCHMARK(StringFormat), 0},
+  {"String.StdFormat", INVOKE_BENCHMARK(StdStringFormat), 0},
+  {"StringConverter.DoubleRoundTrip", INVOKE_BENCHMARK(StringConverterDoubleRoundTrip), 0},
+  {"StringConverter.Int32RoundTrip", INVOKE_BENCHMARK(StringConverterInt32RoundTrip), 0},
+  {"StringConverter.StdDoubleRoundTrip", INVOKE_BENCHMARK(StdDoubleRoundTrip), 0},
+  {"StringConverter.StdInt32RoundTrip", INVOKE_BENCHMARK(StdInt32RoundTrip), 0},
+  {"StringHashTable.Insert/16", INVOKE_BENCHMARK(StringHashTableInsert), 16},
+  {"StringHashTable.Insert/1024", INVOKE_BENCHMARK(StringHashTableInsert), 1024},
+  {"StringHashTable.Insert/65536", INVOKE_BENCHMARK(StringHashTableInsert), 65536},
+  {"StringHashTable.StdUnorderedMapInsert/16", INVOKE_BENCHMARK(StdUnorderedMapStringInsert), 16},
+  {"StringHashTable.StdUnorderedMapInsert/1024", INVOKE_BENCHMARK(StdUnorderedMapStringInsert), 1024},
+  {"StringHashTable.StdUnorderedMapInsert/65536", INVOKE_BENCHMARK(StdUnorderedMapStringInsert), 65536},
+  {"StringHashTable.Find/16", INVOKE_BENCHMARK(StringHashTableFind), 16},
+  {"StringHashTable.Find/1024", INVOKE_BENCHMARK(StringHashTableFind), 1024},
+  {"StringHashTable.Find/65536", INVOKE_BENCHMARK(StringHashTableFind), 65536},
+  {"StringHashTable.StdUnorderedMapFind/16", INVOKE_BENCHMARK(StdUnorderedMapStringFind), 16},
+  {"StringHashTable.StdUnorderedMapFind/1024", INVOKE_BENCHMARK(StdUnorderedMapStringFind), 1024},
+  {"StringHashTable.StdUnorderedMapFind/65536", INVOKE_BENCHMARK(StdUnorderedMapStringFind), 65536},
+  {"StringHashTable.Remove/16", INVOKE_BENCHMARK(StringHashTableRemove), 16},
+  {"StringHashTable.Remove/1024", INVOKE_BENCHMARK(StringHashTableRemove), 1024},
+  {"StringHashTable.Remove/65536", INVOKE_BENCHMARK(StringHashTableRemove), 65536},
+  {"StringHashTable.StdUnorderedMapRemove/16", INVOKE_BENCHMARK(StdUnorderedMapStringRemove), 16},
+  {"StringHashTable.StdUnorderedMapRemove/1024", INVOKE_BENCHMARK(StdUnorderedMapStringRemove), 1024},
+  {"StringHashTable.StdUnorderedMapRemove/65536", INVOKE_BENCHMARK(StdUnorderedMapStringRemove), 65536},
+  {"TaskQueue.Enqueue/1", INVOKE_BENCHMARK(TaskQueueEnqueue), 1},
+  {"TaskQueue.Enqueue/2", INVOKE_BENCHMARK(TaskQueueEnqueue), 2},
+  {"TaskQueue.Enqueue/4", INVOKE_BENCHMARK(TaskQueueEnqueue), 4},
+  {"TaskQueue.Enqueue/8", INVOKE_BENCHMARK(TaskQueueEnqueue), 8},
+  {"TaskQueue.EnqueueLockFree/1", INVOKE_BENCHMARK(TaskQueueEnqueueLockFree), 1},
+  {"TaskQueue.EnqueueLockFree/2", INVOKE_BENCHMARK(TaskQueueEnqueueLockFree), 2},
+  {"TaskQueue.EnqueueLockFree/4", INVOKE_BENCHMARK(TaskQueueEnqueueLockFree), 4},
+  {"TaskQueue.EnqueueLockFree/8", INVOKE_BENCHMARK(TaskQueueEnqueueLockFree), 8},
+  {"TaskQueue.EmptyTask", INVOKE_BENCHMARK(TaskQueueEmptyTask), 0},
+  {"TaskQueue.EmptyTaskBatched", INVOKE_BENCHMARK(TaskQueueEmptyTaskBatched), 0},
+  {"TaskQueue.BlockingRoundTrip", INVOKE_BENCHMARK(TaskQueueBlockingRoundTrip), 0},
+  {"TaskQueue.FanOutFanIn/4", INVOKE_BENCHMARK(TaskQueueFanOutFanIn), 4},
+  {"TaskQueue.FanOutFanIn/64", INVOKE_BENCHMARK(TaskQueueFanOutFanIn), 64},
+  {"TaskQueue.FanOutFanIn/1024", INVOKE_BENCHMARK(TaskQueueFanOutFanIn), 1024},
+  {"ThreadPool.EmptyItems/1", INVOKE_BENCHMARK(ThreadPoolEmptyItems), 1},
+  {"ThreadPool.EmptyItems/2", INVOKE_BENCHMARK(ThreadPoolEmptyItems), 2},
+  {"ThreadPool.EmptyItems/4", INVOKE_BENCHMARK(ThreadPoolEmptyItems), 4},
+  {"ThreadPool.EmptyItems/8", INVOKE_BENCHMARK(ThreadPoolEmptyItems), 8},
+  {"ThreadPool.Scaling/1", INVOKE_BENCHMARK(ThreadPoolScaling), 1},
+  {"ThreadPool.Scaling/2", INVOKE_BENCHMARK(ThreadPoolScaling), 2},
+  {"ThreadPool.Scaling/4", INVOKE_BENCHMARK(ThreadPoolScaling), 4},
+  {"ThreadPool.Scaling/8", INVOKE_BENCHMARK(ThreadPoolScaling), 8},
+  {"ThreadPool.Scaling/16", INVOKE_BENCHMARK(ThreadPoolScaling), 16},
+  {"Timer.FastTimerGetValue", INVOKE_BENCHMARK(FastTimerGetValue), 0},
+  {"Timer.TimerGetValue", INVOKE_BENCHMARK(TimerGetValue), 0},
+#ifdef HAVE_ZLIB
+  {"ZLibHelpers.Deflate/1", INVOKE_BENCHMARK(ZLibDeflate), 1},
+  {"ZLibHelpers.Deflate/6", INVOKE_BENCHMARK(ZLibDeflate), 6},
+  {"ZLibHelpers.Deflate/9", INVOKE_BENCHMARK(ZLibDeflate), 9},
+  {"ZLibHelpers.Inflate/1", INVOKE_BENCHMARK(ZLibInflate), 1},
+  {"ZLibHelpers.Inflate/6", INVOKE_BENCHMARK(ZLibInflate), 6},
+  {"ZLibHelpers.Inflate/9", INVOKE_BENCHMARK(ZLibInflate), 9},
+  {"ZipArchive.Write/1", INVOKE_BENCHMARK(ZipArchiveWrite), 1},
+  {"ZipArchive.Write/6", INVOKE_BENCHMARK(ZipArchiveWrite), 6},
+  {"ZipArchive.Write/9", INVOKE_BENCHMARK(ZipArchiveWrite), 9},
+  {"ZipArchive.Read/1", INVOKE_BENCHMARK(ZipArchiveRead), 1},
+  {"ZipArchive.Read/6", INVOKE_BENCHMARK(ZipArchiveRead), 6},
+  {"ZipArchive.Read/9", INVOKE_BENCHMARK(ZipArchiveRead), 9},
+#endif
+};
+
+static void PrintUsage()
+{
+  Log_InfoPrint("usage: Benchmarks [filter] [--json=<file>] [--pin=<processor>] [--samples=<count>]");
+  Log_InfoPrint("                  [--min-time=<milliseconds>] [--warmup=<milliseconds>]");
+}
+
+// returns the value of "--name=value", or null if the argument is something else
+static const char* GetOptionValue(const char* argument, const char* name)
+{
+  uint32 nameLength = Y_strlen(name);
+  if (Y_strncmp(argument, name, nameLength) != 0 || argument[nameLength] != '=')
+    return nullptr;
+
+  return argument + nameLength + 1;
+}
+
+int main(int argc, char* argv[])
+{
+  Log::GetInstance().SetConsoleOutputParams(true);
+  Log::GetInstance().SetDebugOutputParams(true);
+
+  BenchmarkOptions options;
+  for (int i = 1; i < argc; i++)
+  {
+    const char* value;
+    if ((value = GetOptionValue(argv[i], "--json")) != nullptr)
+      options.JSONFileName = value;
+    else if ((value = GetOptionValue(argv[i], "--pin")) != nullptr)
+      options.PinProcessor = StringConverter::StringToInt32(value);
+    else if ((value = GetOptionValue(argv[i], "--samples")) != nullptr)
+      options.SampleCount = Max(StringConverter::StringToUInt32(value), 1u);
+    else if ((value = GetOptionValue(argv[i], "--min-time")) != nullptr)
+      options.MinSampleTime = StringConverter::StringToDouble(value) / 1000.0;
+    else if ((value = GetOptionValue(argv[i], "--warmup")) != nullptr)
+      options.WarmupTime = StringConverter::StringToDouble(value) / 1000.0;
+    else if (argv[i][0] != '-' && options.Filter == nullptr)
+      options.Filter = argv[i];
+    else
+    {
+      PrintUsage();
+      return -1;
+    }
+  }
+
+  return Benchmark_Run(s_benchmarks, countof(s_benchmarks), options) ? 0 : -1;
+}
@@ -0,0 +1,464 @@
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Error.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/SchedulerStats.h"
+#include "YBaseLib/Sockets/BufferedStreamSocket.h"
+#include "YBaseLib/Sockets/ListenSocket.h"
+#include "YBaseLib/Sockets/SocketMultiplexer.h"
+#include "YBaseLib/StringConverter.h"
+#include "YBaseLib/Thread.h"
+#include "YBaseLib/Timer.h"
+Log_SetChannel(SocketLoadTest);
+
+// An echo server and a load generator keeping a request in flight on each of its connections, sending the next as
+// the last one's echo completes, which reports how fast the connections were made, the requests per second and the
+// round trip latencies. Both ends run in this process on loopback unless one is asked for on its own, so a server
+// can be loaded from another machine, or a remote one loaded from here.
+
+struct LoadTestOptions
+{
+  SOCKET_MULTIPLEXER_TYPE MultiplexerType;
+
+  // event loops, and so worker threads, for each end, 0 for the CPU count
+  uint32 ThreadCount;
+
+  // with several loops the server has a listen socket per loop, unless it's asked for one spreading connections
+  bool SingleListenSocket;
+
+  uint32 ConnectionCount;
+  uint32 ConnectThreadCount;
+  uint32 MessageSize;
+  uint32 Port;
+  double WarmupTime;
+  double Duration;
+
+  // set to run only the client, against this host
+  const char* ServerHost;
+
+  // runs only the server, for the warmup and duration
+  bool ServerOnly;
+
+  LoadTestOptions()
+    : MultiplexerType(SocketMultiplexer::GetDefaultType()), ThreadCount(1), SingleListenSocket(false),
+      ConnectionCount(64), ConnectThreadCount(4), MessageSize(64), Port(27700), WarmupTime(1.0), Duration(5.0),
+      ServerHost(nullptr), ServerOnly(false)
+  {
+  }
+};
+
+static LoadTestOptions s_options;
+
+// the request every connection sends, of the message size
+static PODArray<byte> s_requestData;
+
+// Requests are sent while running, and counted while measuring, which starts after the warmup. Replies to requests
+// sent before the measurement starts are counted too, so the first of each connection's is timed from before it.
+static volatile bool s_running = false;
+static volatile bool s_measuring = false;
+static volatile uint32 s_disconnectCount = 0;
+
+// big enough for a whole message, so a request is always taken in one write
+static size_t GetSocketBufferSize()
+{
+  return Max((size_t)s_options.MessageSize, (size_t)16384);
+}
+
+// Writes back whatever it receives, carrying on when there's room again if the send buffer fills.
+class EchoSocket : public BufferedStreamSocket
+{
+public:
+  EchoSocket() : BufferedStreamSocket(GetSocketBufferSize(), GetSocketBufferSize()) {}
+
+protected:
+  virtual void OnRead() override { Echo(); }
+  virtual void OnSendBufferSpace() override { Echo(); }
+
+private:
+  void Echo()
+  {
+    const void* pData;
+    size_t byteCount;
+    while (AcquireReadBuffer(&pData, &byteCount))
+    {
+      size_t bytesWritten = Write(pData, byteCount);
+      ReleaseReadBuffer(bytesWritten);
+      if (bytesWritten < byteCount)
+        break;
+    }
+  }
+};
+
+// Sends a request, waits for all of its echo, then sends the next, timing each round trip. Only the worker thread
+// of the socket's event loop touches the counters once the first request has gone.
+class PingPongSocket : public BufferedStreamSocket
+{
+public:
+  PingPongSocket()
+    : BufferedStreamSocket(GetSocketBufferSize(), GetSocketBufferSize()), m_requestStartTime(0),
+      m_replyBytesReceived(0), m_requestCount(0)
+  {
+  }
+
+  uint64 GetRequestCount() const { return m_requestCount; }
+  const LatencyHistogram& GetLatency() const { return m_latency; }
+
+  void SendRequest()
+  {
+    m_requestStartTime = Y_TimerGetValue();
+    if (Write(s_requestData.GetBasePointer(), s_requestData.GetSize()) != s_requestData.GetSize())
+      Close();
+  }
+
+protected:
+  virtual void OnRead() override
+  {
+    const void* pData;
+    size_t byteCount;
+    while (AcquireReadBuffer(&pData, &byteCount))
+    {
+      ReleaseReadBuffer(byteCount);
+      m_replyBytesReceived += (uint32)byteCount;
+    }
+
+    if (m_replyBytesReceived < s_requestData.GetSize())
+      return;
+
+    m_replyBytesReceived -= s_requestData.GetSize();
+    if (s_measuring)
+    {
+      m_latency.Record(Y_TimerGetValue() - m_requestStartTime);
+      m_requestCount++;
+    }
+
+    if (s_running)
+      SendRequest();
+  }
+
+  virtual void OnDisconnected(Error* pError) override
+  {
+    if (s_running)
+      Y_AtomicIncrement(s_disconnectCount);
+
+    BufferedStreamSocket::OnDisconnected(pError);
+  }
+
+private:
+  Y_TIMER_VALUE m_requestStartTime;
+  uint32 m_replyBytesReceived;
+  uint64 m_requestCount;
+  LatencyHistogram m_latency;
+};
+
+// Makes a share of the connections, so connection rates aren't limited by one thread's blocking connects.
+class ConnectThread : public Thread
+{
+public:
+  ConnectThread(SocketMultiplexer* pMultiplexer, const SocketAddress* pAddress, uint32 connectionCount)
+    : m_pMultiplexer(pMultiplexer), m_pAddress(pAddress), m_connectionCount(connectionCount)
+  {
+  }
+
+  uint32 GetConnectionCount() const { return m_connectionCount; }
+  const PODArray<PingPongSocket*>& GetSockets() const { return m_sockets; }
+  const Error& GetLastError() const { return m_lastError; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    for (uint32 i = 0; i < m_connectionCount; i++)
+    {
+      PingPongSocket* pSocket = m_pMultiplexer->ConnectStreamSocket<PingPongSocket>(m_pAddress, &m_lastError);
+      if (pSocket != nullptr)
+        m_sockets.Add(pSocket);
+    }
+
+    return 0;
+  }
+
+private:
+  SocketMultiplexer* m_pMultiplexer;
+  const SocketAddress* m_pAddress;
+  uint32 m_connectionCount;
+  PODArray<PingPongSocket*> m_sockets;
+  Error m_lastError;
+};
+
+static const char* GetMultiplexerTypeName(SOCKET_MULTIPLEXER_TYPE type)
+{
+  static const char* names[NUM_SOCKET_MULTIPLEXER_TYPES] = {"select", "poll", "epoll", "kqueue"};
+  return names[type];
+}
+
+static void PrintMultiplexerStats(const char* name, SocketMultiplexer* pMultiplexer)
+{
+  SocketMultiplexerStats stats = pMultiplexer->GetStats();
+  Log_InfoPrintf("%s: %u loops, %llu socket events, %llu receive calls, %llu send calls, loop iteration p99 %.3f ms",
+                 name, stats.EventLoopCount, stats.SocketEvents, stats.Totals.ReceiveCalls, stats.Totals.SendCalls,
+                 stats.IterationTime.GetPercentileMilliseconds(99.0));
+}
+
+// Starts the server's loops and listen sockets, returning null if it can't listen.
+static SocketMultiplexer* StartServer(const SocketAddress* pAddress, PODArray<ListenSocket*>* pListenSockets)
+{
+  Error error;
+  SocketMultiplexer* pMultiplexer = SocketMultiplexer::Create(s_options.MultiplexerType, &error);
+  if (pMultiplexer == nullptr)
+  {
+    Log_ErrorPrintf("Failed to create the server's multiplexer: %s", error.GetErrorCodeAndDescription().GetCharArray());
+    return nullptr;
+  }
+
+  pMultiplexer->CreateWorkerThreads(s_options.ThreadCount);
+
+  bool listening;
+  if (s_options.SingleListenSocket)
+  {
+    ListenSocket* pListenSocket = pMultiplexer->CreateListenSocket<EchoSocket>(pAddress, &error);
+    if (pListenSocket != nullptr)
+      pListenSockets->Add(pListenSocket);
+    listening = (pListenSocket != nullptr);
+  }
+  else
+  {
+    listening = pMultiplexer->CreateListenSockets<EchoSocket>(pAddress, pListenSockets, &error);
+  }
+
+  if (!listening)
+  {
+    Log_ErrorPrintf("Failed to listen on port %u: %s", s_options.Port,
+                    error.GetErrorCodeAndDescription().GetCharArray());
+    delete pMultiplexer;
+    return nullptr;
+  }
+
+  Log_InfoPrintf("server: %s, %u loops, %u listen sockets, port %u", GetMultiplexerTypeName(s_options.MultiplexerType),
+                 pMultiplexer->GetEventLoopCount(), pListenSockets->GetSize(), s_options.Port);
+  return pMultiplexer;
+}
+
+static void StopServer(SocketMultiplexer* pMultiplexer, PODArray<ListenSocket*>* pListenSockets)
+{
+  uint32 acceptCount = 0;
+  for (uint32 i = 0; i < pListenSockets->GetSize(); i++)
+  {
+    acceptCount += (*pListenSockets)[i]->GetConnectionsAccepted();
+    (*pListenSockets)[i]->Close();
+    (*pListenSockets)[i]->Release();
+  }
+
+  pMultiplexer->StopWorkerThreads();
+  Log_InfoPrintf("server: %u connections accepted", acceptCount);
+  PrintMultiplexerStats("server", pMultiplexer);
+  delete pMultiplexer;
+}
+
+// Connects, runs requests for the warmup and duration, and reports. Returns false if nothing connected.
+static bool RunClient(const SocketAddress* pAddress)
+{
+  Error error;
+  SocketMultiplexer* pMultiplexer = SocketMultiplexer::Create(s_options.MultiplexerType, &error);
+  if (pMultiplexer == nullptr)
+  {
+    Log_ErrorPrintf("Failed to create the client's multiplexer: %s", error.GetErrorCodeAndDescription().GetCharArray());
+    return false;
+  }
+
+  pMultiplexer->CreateWorkerThreads(s_options.ThreadCount);
+  s_requestData.Resize(s_options.MessageSize);
+  for (uint32 i = 0; i < s_options.MessageSize; i++)
+    s_requestData[i] = (byte)i;
+
+  // connections, split between the threads
+  PODArray<ConnectThread*> connectThreads;
+  uint32 connectThreadCount = Max(Min(s_options.ConnectThreadCount, s_options.ConnectionCount), 1u);
+  Timer connectTimer;
+  for (uint32 i = 0; i < connectThreadCount; i++)
+  {
+    uint32 connectionCount = s_options.ConnectionCount / connectThreadCount +
+                             ((i < (s_options.ConnectionCount % connectThreadCount)) ? 1 : 0);
+    ConnectThread* pThread = new ConnectThread(pMultiplexer, pAddress, connectionCount);
+    pThread->Start();
+    connectThreads.Add(pThread);
+  }
+
+  PODArray<PingPongSocket*> sockets;
+  for (uint32 i = 0; i < connectThreads.GetSize(); i++)
+  {
+    ConnectThread* pThread = connectThreads[i];
+    pThread->Join();
+    sockets.AddRange(pThread->GetSockets().GetBasePointer(), pThread->GetSockets().GetSize());
+    if (pThread->GetSockets().GetSize() < pThread->GetConnectionCount())
+      error = pThread->GetLastError();
+    delete pThread;
+  }
+
+  double connectTime = connectTimer.GetTimeSeconds();
+  Log_InfoPrintf("client: %s, %u loops, %u of %u connections made in %.1f ms, %.0f connections/s",
+                 GetMultiplexerTypeName(s_options.MultiplexerType), pMultiplexer->GetEventLoopCount(),
+                 sockets.GetSize(), s_options.ConnectionCount, connectTime * 1000.0,
+                 (double)sockets.GetSize() / Max(connectTime, 1e-9));
+  if (sockets.GetSize() < s_options.ConnectionCount)
+    Log_WarningPrintf("Connecting failed: %s", error.GetErrorCodeAndDescription().GetCharArray());
+
+  if (sockets.GetSize() > 0)
+  {
+    // the first request on each connection, later ones are sent by the worker threads
+    s_running = true;
+    for (uint32 i = 0; i < sockets.GetSize(); i++)
+      sockets[i]->SendRequest();
+
+    Thread::Sleep((uint32)(s_options.WarmupTime * 1000.0));
+    s_measuring = true;
+    Timer measureTimer;
+    Thread::Sleep((uint32)(s_options.Duration * 1000.0));
+    s_measuring = false;
+    double measureTime = measureTimer.GetTimeSeconds();
+    s_running = false;
+
+    pMultiplexer->StopWorkerThreads();
+
+    uint64 requestCount = 0;
+    LatencyHistogram latency;
+    for (uint32 i = 0; i < sockets.GetSize(); i++)
+    {
+      requestCount += sockets[i]->GetRequestCount();
+      latency.Accumulate(sockets[i]->GetLatency());
+    }
+
+    double requestsPerSecond = (double)requestCount / measureTime;
+    Log_InfoPrintf("client: %llu requests of %u bytes in %.2f s, %.0f requests/s, %.1f MB/s each way, %u disconnects",
+                   requestCount, s_options.MessageSize, measureTime, requestsPerSecond,
+                   requestsPerSecond * (double)s_options.MessageSize / (1024.0 * 1024.0), s_disconnectCount);
+    Log_InfoPrintf("client: latency mean %.3f ms, p50 %.3f ms, p99 %.3f ms, p99.9 %.3f ms, max %.3f ms",
+                   latency.GetMeanMilliseconds(), latency.GetPercentileMilliseconds(50.0),
+                   latency.GetPercentileMilliseconds(99.0), latency.GetPercentileMilliseconds(99.9),
+                   latency.GetMaxMilliseconds());
+  }
+
+  PrintMultiplexerStats("client", pMultiplexer);
+  pMultiplexer->CloseAll();
+  for (uint32 i = 0; i < sockets.GetSize(); i++)
+    sockets[i]->Release();
+
+  delete pMultiplexer;
+  return (sockets.GetSize() > 0);
+}
+
+static void PrintUsage()
+{
+  Log_InfoPrint("usage: SocketLoadTest [--multiplexer=select|poll|epoll|kqueue] [--threads=<count>] [--single-listen]");
+  Log_InfoPrint("                      [--connections=<count>] [--connect-threads=<count>] [--size=<bytes>]");
+  Log_InfoPrint("                      [--warmup=<seconds>] [--duration=<seconds>] [--port=<port>]");
+  Log_InfoPrint("                      [--server | --connect=<host>]");
+  Log_InfoPrint("--threads=0 runs a loop per CPU. select can't wait on descriptors past FD_SETSIZE, so keep");
+  Log_InfoPrint("connections well below it with that multiplexer.");
+}
+
+// returns the value of "--name=value", or null if the argument is something else
+static const char* GetOptionValue(const char* argument, const char* name)
+{
+  uint32 nameLength = Y_strlen(name);
+  if (Y_strncmp(argument, name, nameLength) != 0 || argument[nameLength] != '=')
+    return nullptr;
+
+  return argument + nameLength + 1;
+}
+
+static bool ParseMultiplexerType(const char* name, SOCKET_MULTIPLEXER_TYPE* pType)
+{
+  for (uint32 i = 0; i < NUM_SOCKET_MULTIPLEXER_TYPES; i++)
+  {
+    if (Y_strcmp(name, GetMultiplexerTypeName((SOCKET_MULTIPLEXER_TYPE)i)) == 0)
+    {
+      *pType = (SOCKET_MULTIPLEXER_TYPE)i;
+      return SocketMultiplexer::IsTypeSupported(*pType);
+    }
+  }
+
+  return false;
+}
+
+int main(int argc, char* argv[])
+{
+  Log::GetInstance().SetConsoleOutputParams(true);
+  Log::GetInstance().SetDebugOutputParams(true);
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char* value;
+    if ((value = GetOptionValue(argv[i], "--multiplexer")) != nullptr)
+    {
+      if (!ParseMultiplexerType(value, &s_options.MultiplexerType))
+      {
+        Log_ErrorPrintf("Multiplexer '%s' isn't supported here", value);
+        return -1;
+      }
+    }
+    else if ((value = GetOptionValue(argv[i], "--threads")) != nullptr)
+      s_options.ThreadCount = StringConverter::StringToUInt32(value);
+    else if (Y_strcmp(argv[i], "--single-listen") == 0)
+      s_options.SingleListenSocket = true;
+    else if ((value = GetOptionValue(argv[i], "--connections")) != nullptr)
+      s_options.ConnectionCount = Max(StringConverter::StringToUInt32(value), 1u);
+    else if ((value = GetOptionValue(argv[i], "--connect-threads")) != nullptr)
+      s_options.ConnectThreadCount = Max(StringConverter::StringToUInt32(value), 1u);
+    else if ((value = GetOptionValue(argv[i], "--size")) != nullptr)
+      s_options.MessageSize = Max(StringConverter::StringToUInt32(value), 1u);
+    else if ((value = GetOptionValue(argv[i], "--warmup")) != nullptr)
+      s_options.WarmupTime = StringConverter::StringToDouble(value);
+    else if ((value = GetOptionValue(argv[i], "--duration")) != nullptr)
+      s_options.Duration = Max(StringConverter::StringToDouble(value), 0.001);
+    else if ((value = GetOptionValue(argv[i], "--port")) != nullptr)
+      s_options.Port = StringConverter::StringToUInt32(value);
+    else if (Y_strcmp(argv[i], "--server") == 0)
+      s_options.ServerOnly = true;
+    else if ((value = GetOptionValue(argv[i], "--connect")) != nullptr)
+      s_options.ServerHost = value;
+    else
+    {
+      PrintUsage();
+      return -1;
+    }
+  }
+
+  if (s_options.ServerOnly && s_options.ServerHost != nullptr)
+  {
+    PrintUsage();
+    return -1;
+  }
+
+  // a server on its own takes connections from anywhere, one in this process only from loopback
+  SocketAddress serverAddress;
+  PODArray<ListenSocket*> listenSockets;
+  SocketMultiplexer* pServerMultiplexer = nullptr;
+  if (s_options.ServerHost == nullptr)
+  {
+    SocketAddress::Parse(SocketAddress::Type_IPv4, s_options.ServerOnly ? "0.0.0.0" : "127.0.0.1", s_options.Port,
+                         &serverAddress);
+    pServerMultiplexer = StartServer(&serverAddress, &listenSockets);
+    if (pServerMultiplexer == nullptr)
+      return -1;
+  }
+  else
+  {
+    Error error;
+    if (!SocketAddress::Resolve(s_options.ServerHost, s_options.Port, &serverAddress, &error))
+    {
+      Log_ErrorPrintf("Failed to resolve '%s': %s", s_options.ServerHost,
+                      error.GetErrorCodeAndDescription().GetCharArray());
+      return -1;
+    }
+  }
+
+  bool result = true;
+  if (s_options.ServerOnly)
+    Thread::Sleep((uint32)((s_options.WarmupTime + s_options.Duration) * 1000.0));
+  else
+    result = RunClient(&serverAddress);
+
+  if (pServerMultiplexer != nullptr)
+    StopServer(pServerMultiplexer, &listenSockets);
+
+  return result ? 0 : -1;
+}
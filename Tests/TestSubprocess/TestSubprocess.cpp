@@ -1,9 +1,41 @@
+#include "YBaseLib/Atomic.h"
 #include "YBaseLib/Log.h"
 #include "YBaseLib/Platform.h"
 #include "YBaseLib/Subprocess.h"
+#include "YBaseLib/SubprocessPool.h"
 #include "YBaseLib/Thread.h"
+#include "YBaseLib/Timer.h"
 Log_SetChannel(TestSubprocess);
 
+// bytes the parent sends for the child to echo back, more than either channel buffers at once
+static const uint32 ECHO_BYTE_COUNT = 8 * 1024 * 1024;
+static const uint32 ECHO_CHUNK_SIZE = 64 * 1024;
+
+// pool workers are started with this parameter, and exit when sent an empty request
+static const char* POOL_WORKER_PARAMETER = "pool";
+static const uint32 POOL_WORKER_COUNT = 3;
+static const uint32 POOL_REQUEST_COUNT = 1000;
+
+static byte GetEchoByte(uint32 index)
+{
+  return byte((index * 31) ^ (index >> 11));
+}
+
+static bool ReadExactly(Subprocess::Connection* conn, void* pBuffer, uint32 byteCount)
+{
+  uint32 offset = 0;
+  while (offset < byteCount)
+  {
+    uint32 count = conn->ReadDataBlocking(reinterpret_cast<byte*>(pBuffer) + offset, byteCount - offset);
+    if (count == 0)
+      return false;
+
+    offset += count;
+  }
+
+  return true;
+}
+
 static void parent()
 {
   printf("parent process\n");
@@ -25,7 +57,7 @@ static void parent()
     return;
   }
 
-  printf("connected with child\n");
+  printf("connected with child%s\n", conn->IsSharedMemoryChannel() ? " over shared memory" : "");
 
   conn->IsOtherSideAlive();
 
@@ -33,7 +65,47 @@ static void parent()
   uint32 b = conn->ReadDataNonBlocking(&msg, sizeof(msg));
   UNREFERENCED_PARAMETER(b);
 
-  Thread::Sleep(5000);
+  // send from another thread, so neither side stalls on a full channel
+  class SendThread : public Thread
+  {
+  public:
+    SendThread(Subprocess::Connection* conn) : m_conn(conn) {}
+
+  protected:
+    virtual int ThreadEntryPoint() override
+    {
+      byte chunk[ECHO_CHUNK_SIZE];
+      for (uint32 offset = 0; offset < ECHO_BYTE_COUNT; offset += ECHO_CHUNK_SIZE)
+      {
+        for (uint32 i = 0; i < ECHO_CHUNK_SIZE; i++)
+          chunk[i] = GetEchoByte(offset + i);
+        if (m_conn->WriteData(chunk, ECHO_CHUNK_SIZE) != ECHO_CHUNK_SIZE)
+          return 1;
+      }
+
+      return 0;
+    }
+
+  private:
+    Subprocess::Connection* m_conn;
+  };
+
+  Y_TIMER_VALUE startTime = Y_TimerGetValue();
+  SendThread sendThread(conn);
+  sendThread.Start();
+
+  bool echoed = true;
+  byte chunk[ECHO_CHUNK_SIZE];
+  for (uint32 offset = 0; offset < ECHO_BYTE_COUNT && echoed; offset += ECHO_CHUNK_SIZE)
+  {
+    echoed = ReadExactly(conn, chunk, ECHO_CHUNK_SIZE);
+    for (uint32 i = 0; i < ECHO_CHUNK_SIZE && echoed; i++)
+      echoed = (chunk[i] == GetEchoByte(offset + i));
+  }
+
+  echoed = (sendThread.Join() == 0) && echoed;
+  printf("echo %s, %.2f ms\n", echoed ? "matched" : "FAILED",
+         Y_TimerConvertToMilliseconds(Y_TimerGetValue() - startTime));
 
   printf("requesting child exit\n");
   p->RequestChildToExit();
@@ -41,6 +113,68 @@ static void parent()
   printf("child exited\n");
 }
 
+static void pool()
+{
+  String filename;
+  Platform::GetProgramFileName(filename);
+  SubprocessPool pool(filename, POOL_WORKER_PARAMETER, POOL_WORKER_COUNT);
+  if (!pool.Start())
+  {
+    Log_ErrorPrintf("Failed to start pool");
+    return;
+  }
+
+  // each worker answers with the request's bytes doubled
+  Y_ATOMIC_DECL uint32 matchedCount = 0;
+  Y_ATOMIC_DECL uint32 completedCount = 0;
+  Y_TIMER_VALUE startTime = Y_TimerGetValue();
+  for (uint32 i = 0; i < POOL_REQUEST_COUNT; i++)
+  {
+    pool.SubmitRequest(&i, sizeof(i), [i, &matchedCount, &completedCount](BinaryBlob* pResponse) {
+      if (pResponse != nullptr && pResponse->GetDataSize() == sizeof(uint32) &&
+          *reinterpret_cast<const uint32*>(pResponse->GetDataPointer()) == i * 2)
+      {
+        Y_AtomicIncrement(matchedCount);
+      }
+      Y_AtomicIncrement(completedCount);
+    });
+  }
+
+  while (Y_AtomicLoad(completedCount) < POOL_REQUEST_COUNT)
+    Thread::Sleep(1);
+
+  printf("pool %u/%u requests matched, %.2f ms\n", Y_AtomicLoad(matchedCount), POOL_REQUEST_COUNT,
+         Y_TimerConvertToMilliseconds(Y_TimerGetValue() - startTime));
+
+  // make one worker exit, its reader thread should start another
+  Y_ATOMIC_DECL uint32 failed = 0;
+  pool.SubmitRequest(nullptr, 0, [&failed](BinaryBlob* pResponse) {
+    Y_AtomicStore(failed, (pResponse == nullptr) ? 1u : 2u);
+  });
+  while (Y_AtomicLoad(failed) == 0)
+    Thread::Sleep(1);
+  while (pool.GetRestartCount() == 0)
+    Thread::Sleep(1);
+
+  printf("worker exit %s, %u of %u workers live after restart\n",
+         (Y_AtomicLoad(failed) == 1) ? "failed the request" : "FAILED", pool.GetLiveWorkerCount(),
+         pool.GetWorkerCount());
+
+  pool.Shutdown();
+  printf("pool shut down\n");
+}
+
+static void poolWorker()
+{
+  SubprocessPool::ServeRequests([](const byte* pRequest, uint32 requestSize, PODArray<byte>* pResponse) {
+    if (requestSize == 0)
+      exit(1);
+
+    uint32 value = *reinterpret_cast<const uint32*>(pRequest) * 2;
+    pResponse->AddRange(reinterpret_cast<const byte*>(&value), sizeof(value));
+  });
+}
+
 static void child()
 {
   printf("child process\n");
@@ -53,6 +187,14 @@ static void child()
   }
 
   printf("Connected with parent\n");
+
+  byte chunk[ECHO_CHUNK_SIZE];
+  for (uint32 offset = 0; offset < ECHO_BYTE_COUNT; offset += ECHO_CHUNK_SIZE)
+  {
+    if (!ReadExactly(conn, chunk, ECHO_CHUNK_SIZE) || conn->WriteData(chunk, ECHO_CHUNK_SIZE) != ECHO_CHUNK_SIZE)
+      break;
+  }
+
   while (!conn->IsExitRequested())
     Thread::Sleep(1);
 
@@ -65,10 +207,20 @@ int main(int argc, char* argv[])
   Log::GetInstance().SetConsoleOutputParams(true);
   Log::GetInstance().SetDebugOutputParams(true);
 
+  String parameters;
   if (!Subprocess::IsSubprocess())
+  {
     parent();
+    pool();
+  }
+  else if (Subprocess::GetParameters(&parameters) && parameters.Compare(POOL_WORKER_PARAMETER))
+  {
+    poolWorker();
+  }
   else
+  {
     child();
+  }
 
   return 0;
 }
@@ -3,9 +3,78 @@
 #include "YBaseLib/Log.h"
 Log_SetChannel(Main);
 
+DECLARE_TEST_SUITE(Array);
+DECLARE_TEST_SUITE(ArrayAlgorithms);
+DECLARE_TEST_SUITE(AsyncFileStream);
+DECLARE_TEST_SUITE(Atomic);
 DECLARE_TEST_SUITE(Base64);
+DECLARE_TEST_SUITE(BinaryBlob);
+DECLARE_TEST_SUITE(BinaryLog);
+DECLARE_TEST_SUITE(BinarySchema);
+DECLARE_TEST_SUITE(BinaryXML);
 DECLARE_TEST_SUITE(BitSet);
+DECLARE_TEST_SUITE(BloomFilter);
+DECLARE_TEST_SUITE(ByteStream);
 DECLARE_TEST_SUITE(CPUID);
+DECLARE_TEST_SUITE(Cache);
+DECLARE_TEST_SUITE(CacheAligned);
+DECLARE_TEST_SUITE(CircularBuffer);
+DECLARE_TEST_SUITE(CRC32);
+DECLARE_TEST_SUITE(CSVTable);
+DECLARE_TEST_SUITE(CString);
+DECLARE_TEST_SUITE(Compression);
+DECLARE_TEST_SUITE(ContentChunker);
+DECLARE_TEST_SUITE(Coroutine);
+DECLARE_TEST_SUITE(Digest);
+DECLARE_TEST_SUITE(DistributedReadWriteLock);
+DECLARE_TEST_SUITE(EpochManager);
+DECLARE_TEST_SUITE(Error);
+DECLARE_TEST_SUITE(Event);
+DECLARE_TEST_SUITE(FileLogSink);
+DECLARE_TEST_SUITE(FileSystem);
+DECLARE_TEST_SUITE(FlightRecorderLogSink);
+DECLARE_TEST_SUITE(FlatMap);
+DECLARE_TEST_SUITE(GlobPattern);
+DECLARE_TEST_SUITE(HashTable);
+DECLARE_TEST_SUITE(InlineFunction);
+DECLARE_TEST_SUITE(JSON);
+DECLARE_TEST_SUITE(LightweightSync);
+DECLARE_TEST_SUITE(LockProfiler);
+DECLARE_TEST_SUITE(Log);
+DECLARE_TEST_SUITE(MappedHashIndex);
+DECLARE_TEST_SUITE(MathArray);
+DECLARE_TEST_SUITE(Metrics);
+DECLARE_TEST_SUITE(NameTable);
+DECLARE_TEST_SUITE(ObjectPool);
+DECLARE_TEST_SUITE(ParallelProgress);
+DECLARE_TEST_SUITE(PathTrie);
+DECLARE_TEST_SUITE(Pipeline);
+DECLARE_TEST_SUITE(PriorityQueue);
+DECLARE_TEST_SUITE(Profiler);
+DECLARE_TEST_SUITE(RefPtr);
+DECLARE_TEST_SUITE(RPCChannel);
+DECLARE_TEST_SUITE(Singleton);
+DECLARE_TEST_SUITE(SlotMap);
+DECLARE_TEST_SUITE(Sockets);
+DECLARE_TEST_SUITE(SocketTimerWheel);
+DECLARE_TEST_SUITE(SpinLock);
+DECLARE_TEST_SUITE(String);
+DECLARE_TEST_SUITE(StringBuilder);
+DECLARE_TEST_SUITE(StringConverter);
+DECLARE_TEST_SUITE(TaskQueue);
+DECLARE_TEST_SUITE(TextReader);
+DECLARE_TEST_SUITE(TextWriter);
+DECLARE_TEST_SUITE(ThreadLocal);
+DECLARE_TEST_SUITE(ThreadPool);
+DECLARE_TEST_SUITE(Timer);
+DECLARE_TEST_SUITE(Timestamp);
+DECLARE_TEST_SUITE(UnicodeConversion);
+DECLARE_TEST_SUITE(VirtualArray);
+DECLARE_TEST_SUITE(VirtualFileSystem);
+DECLARE_TEST_SUITE(XMLPullReader);
+DECLARE_TEST_SUITE(XMLSelector);
+DECLARE_TEST_SUITE(XMLWriter);
+DECLARE_TEST_SUITE(ZipArchive);
 
 struct TestSuiteEntry
 {
@@ -14,9 +83,78 @@ struct TestSuiteEntry
 };
 
 static const TestSuiteEntry s_testSuites[] = {
+  {"Array", INVOKE_TEST_SUITE(Array)},
+  {"ArrayAlgorithms", INVOKE_TEST_SUITE(ArrayAlgorithms)},
+  {"AsyncFileStream", INVOKE_TEST_SUITE(AsyncFileStream)},
+  {"Atomic", INVOKE_TEST_SUITE(Atomic)},
   {"Base64", INVOKE_TEST_SUITE(Base64)},
+  {"BinaryBlob", INVOKE_TEST_SUITE(BinaryBlob)},
+  {"BinaryLog", INVOKE_TEST_SUITE(BinaryLog)},
+  {"BinarySchema", INVOKE_TEST_SUITE(BinarySchema)},
+  {"BinaryXML", INVOKE_TEST_SUITE(BinaryXML)},
   {"BitSet", INVOKE_TEST_SUITE(BitSet)},
+  {"BloomFilter", INVOKE_TEST_SUITE(BloomFilter)},
+  {"ByteStream", INVOKE_TEST_SUITE(ByteStream)},
   {"CPUID", INVOKE_TEST_SUITE(CPUID)},
+  {"Cache", INVOKE_TEST_SUITE(Cache)},
+  {"CacheAligned", INVOKE_TEST_SUITE(CacheAligned)},
+  {"CircularBuffer", INVOKE_TEST_SUITE(CircularBuffer)},
+  {"CRC32", INVOKE_TEST_SUITE(CRC32)},
+  {"CSVTable", INVOKE_TEST_SUITE(CSVTable)},
+  {"CString", INVOKE_TEST_SUITE(CString)},
+  {"Compression", INVOKE_TEST_SUITE(Compression)},
+  {"ContentChunker", INVOKE_TEST_SUITE(ContentChunker)},
+  {"Coroutine", INVOKE_TEST_SUITE(Coroutine)},
+  {"Digest", INVOKE_TEST_SUITE(Digest)},
+  {"DistributedReadWriteLock", INVOKE_TEST_SUITE(DistributedReadWriteLock)},
+  {"EpochManager", INVOKE_TEST_SUITE(EpochManager)},
+  {"Error", INVOKE_TEST_SUITE(Error)},
+  {"Event", INVOKE_TEST_SUITE(Event)},
+  {"FileLogSink", INVOKE_TEST_SUITE(FileLogSink)},
+  {"FileSystem", INVOKE_TEST_SUITE(FileSystem)},
+  {"FlightRecorderLogSink", INVOKE_TEST_SUITE(FlightRecorderLogSink)},
+  {"FlatMap", INVOKE_TEST_SUITE(FlatMap)},
+  {"GlobPattern", INVOKE_TEST_SUITE(GlobPattern)},
+  {"HashTable", INVOKE_TEST_SUITE(HashTable)},
+  {"InlineFunction", INVOKE_TEST_SUITE(InlineFunction)},
+  {"JSON", INVOKE_TEST_SUITE(JSON)},
+  {"LightweightSync", INVOKE_TEST_SUITE(LightweightSync)},
+  {"LockProfiler", INVOKE_TEST_SUITE(LockProfiler)},
+  {"Log", INVOKE_TEST_SUITE(Log)},
+  {"MappedHashIndex", INVOKE_TEST_SUITE(MappedHashIndex)},
+  {"MathArray", INVOKE_TEST_SUITE(MathArray)},
+  {"Metrics", INVOKE_TEST_SUITE(Metrics)},
+  {"NameTable", INVOKE_TEST_SUITE(NameTable)},
+  {"ObjectPool", INVOKE_TEST_SUITE(ObjectPool)},
+  {"ParallelProgress", INVOKE_TEST_SUITE(ParallelProgress)},
+  {"PathTrie", INVOKE_TEST_SUITE(PathTrie)},
+  {"Pipeline", INVOKE_TEST_SUITE(Pipeline)},
+  {"PriorityQueue", INVOKE_TEST_SUITE(PriorityQueue)},
+  {"Profiler", INVOKE_TEST_SUITE(Profiler)},
+  {"RefPtr", INVOKE_TEST_SUITE(RefPtr)},
+  {"RPCChannel", INVOKE_TEST_SUITE(RPCChannel)},
+  {"Singleton", INVOKE_TEST_SUITE(Singleton)},
+  {"SlotMap", INVOKE_TEST_SUITE(SlotMap)},
+  {"Sockets", INVOKE_TEST_SUITE(Sockets)},
+  {"SocketTimerWheel", INVOKE_TEST_SUITE(SocketTimerWheel)},
+  {"SpinLock", INVOKE_TEST_SUITE(SpinLock)},
+  {"String", INVOKE_TEST_SUITE(String)},
+  {"StringBuilder", INVOKE_TEST_SUITE(StringBuilder)},
+  {"StringConverter", INVOKE_TEST_SUITE(StringConverter)},
+  {"TaskQueue", INVOKE_TEST_SUITE(TaskQueue)},
+  {"TextReader", INVOKE_TEST_SUITE(TextReader)},
+  {"TextWriter", INVOKE_TEST_SUITE(TextWriter)},
+  {"ThreadLocal", INVOKE_TEST_SUITE(ThreadLocal)},
+  {"ThreadPool", INVOKE_TEST_SUITE(ThreadPool)},
+  {"Timer", INVOKE_TEST_SUITE(Timer)},
+  {"Timestamp", INVOKE_TEST_SUITE(Timestamp)},
+  {"UnicodeConversion", INVOKE_TEST_SUITE(UnicodeConversion)},
+  {"VirtualArray", INVOKE_TEST_SUITE(VirtualArray)},
+  {"VirtualFileSystem", INVOKE_TEST_SUITE(VirtualFileSystem)},
+  {"XMLPullReader", INVOKE_TEST_SUITE(XMLPullReader)},
+  {"XMLSelector", INVOKE_TEST_SUITE(XMLSelector)},
+  {"XMLWriter", INVOKE_TEST_SUITE(XMLWriter)},
+  {"ZipArchive", INVOKE_TEST_SUITE(ZipArchive)},
 };
 
 int main(int argc, char* argv[])
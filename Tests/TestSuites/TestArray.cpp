@@ -0,0 +1,1178 @@
+#include "TestSuite.h"
+#include "YBaseLib/AlignedMemArray.h"
+#include "YBaseLib/Allocator.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/CIStringHashTable.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Array.h"
+#include "YBaseLib/HashTable.h"
+#include "YBaseLib/InlineMemArray.h"
+#include "YBaseLib/InlinePODArray.h"
+#include "YBaseLib/LinkedList.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/MemArray.h"
+#include "YBaseLib/MemoryTracker.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/QueuedAllocator.h"
+#include "YBaseLib/SPSCCircularBuffer.h"
+#include "YBaseLib/SoAArray.h"
+#include "YBaseLib/Sort.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/StringHashTable.h"
+#include "YBaseLib/Thread.h"
+#include "YBaseLib/ThreadCachedHeap.h"
+Log_SetChannel(TestArray);
+
+struct AlignedVector4
+{
+  ALIGN_DECL(16) float Values[4];
+};
+
+static bool CheckSequence(const InlinePODArray<uint32, 4>& array, uint32 count, uint32 offset)
+{
+  if (array.GetSize() != count)
+    return false;
+
+  for (uint32 i = 0; i < count; i++)
+  {
+    if (array[i] != i + offset)
+      return false;
+  }
+
+  return true;
+}
+
+static bool TestInlineSpill()
+{
+  InlinePODArray<uint32, 4> array;
+  for (uint32 i = 0; i < 4; i++)
+    array.Add(i);
+
+  if (!array.IsInline() || !CheckSequence(array, 4, 0))
+  {
+    Log_ErrorPrintf("FAIL: inline array should hold %u elements without spilling", array.GetInlineCapacity());
+    return false;
+  }
+
+  // spilling keeps the contents, shrinking moves them back
+  for (uint32 i = 4; i < 100; i++)
+    array.Add(i);
+  if (array.IsInline() || !CheckSequence(array, 100, 0))
+  {
+    Log_ErrorPrintf("FAIL: spilled inline array");
+    return false;
+  }
+
+  array.RemoveRange(3, 97);
+  array.Shrink();
+  if (!array.IsInline() || !CheckSequence(array, 3, 0))
+  {
+    Log_ErrorPrintf("FAIL: shrunk inline array");
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: inline array spill and shrink");
+  return true;
+}
+
+static bool TestInlineSwap()
+{
+  // every combination of inline and heap storage
+  static const uint32 sizes[][2] = {{2, 3}, {2, 50}, {50, 2}, {40, 60}};
+  for (uint32 i = 0; i < countof(sizes); i++)
+  {
+    InlinePODArray<uint32, 4> left, right;
+    for (uint32 j = 0; j < sizes[i][0]; j++)
+      left.Add(j);
+    for (uint32 j = 0; j < sizes[i][1]; j++)
+      right.Add(j + 1000);
+
+    left.Swap(right);
+    if (!CheckSequence(left, sizes[i][1], 1000) || !CheckSequence(right, sizes[i][0], 0))
+    {
+      Log_ErrorPrintf("FAIL: swap of %u and %u element arrays", sizes[i][0], sizes[i][1]);
+      return false;
+    }
+
+    InlinePODArray<uint32, 4> moved(static_cast<InlinePODArray<uint32, 4>&&>(left));
+    InlinePODArray<uint32, 4> copied(right);
+    if (!left.IsEmpty() || !CheckSequence(moved, sizes[i][1], 1000) || copied != right)
+    {
+      Log_ErrorPrintf("FAIL: move/copy of %u element array", sizes[i][1]);
+      return false;
+    }
+  }
+
+  // detached inline storage has to come back as a heap pointer
+  InlinePODArray<uint32, 4> small;
+  small.Add(7);
+  uint32* pDetached;
+  uint32 detachedSize;
+  small.DetachArray(&pDetached, &detachedSize);
+  bool detachOk = (detachedSize == 1 && pDetached[0] == 7 && small.IsEmpty() && small.IsInline());
+  Y_free(pDetached);
+  if (!detachOk)
+  {
+    Log_ErrorPrintf("FAIL: detach of inline array");
+    return false;
+  }
+
+  InlineMemArray<uint32, 2> memArray;
+  memArray.Insert(3, 0);
+  memArray.Insert(1, 0);
+  memArray.Insert(2, 1);
+  uint32 front, back;
+  memArray.PopFront(&front);
+  memArray.PopBack(&back);
+  if (front != 1 || back != 3 || memArray.GetSize() != 1 || memArray[0] != 2)
+  {
+    Log_ErrorPrintf("FAIL: inline mem array insert/pop");
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: inline array swap, move and detach");
+  return true;
+}
+
+static bool TestArenaAllocator()
+{
+  // the default allocator must not make the containers any bigger
+  if (sizeof(PODArray<uint32>) != sizeof(uint32*) + 2 * sizeof(uint32) ||
+      sizeof(MemArray<uint32>) != sizeof(PODArray<uint32>))
+  {
+    Log_ErrorPrintf("FAIL: heap allocator adds %u bytes to PODArray",
+                    (uint32)(sizeof(PODArray<uint32>) - sizeof(uint32*) - 2 * sizeof(uint32)));
+    return false;
+  }
+
+  MemoryArena arena(4096);
+  ArenaAllocator allocator(&arena);
+  for (uint32 frame = 0; frame < 3; frame++)
+  {
+    // growing the most recent allocation happens in place
+    PODArray<uint32, ArenaAllocator> values(allocator);
+    for (uint32 i = 0; i < 256; i++)
+      values.Add(i);
+
+    Array<String, ArenaAllocator> names(allocator);
+    HashTable<uint32, uint32, HashTrait<uint32>, ArenaAllocator> table(allocator);
+    LinkedList<uint32, ArenaAllocator> list(allocator);
+    AlignedMemArray<AlignedVector4, 16, ArenaAllocator> vectors(allocator);
+    SmallString name;
+    for (uint32 i = 0; i < 100; i++)
+    {
+      name.Format("name%u", i);
+      names.Add(name);
+      table.Insert(i, values[i] * 2);
+      list.PushBack(i);
+      vectors.Add(AlignedVector4());
+    }
+
+    PODArray<uint32, ArenaAllocator> copy(values);
+    if (copy != values || copy.GetAllocator().GetArena() != &arena || names[99] != "name99" ||
+        table.Find(50)->Value != 100 || list.GetSize() != 100 || *list.Back() != 99 ||
+        ((size_t)vectors.GetBasePointer() & 15) != 0)
+    {
+      Log_ErrorPrintf("FAIL: arena backed containers in frame %u", frame);
+      return false;
+    }
+
+    if (frame == 2)
+    {
+      Log_InfoPrintf("PASS: arena allocator (%u bytes used, %u bytes held)", (uint32)arena.GetBytesUsed(),
+                     (uint32)arena.GetMemoryUsage());
+    }
+
+    // containers have to be gone before the arena is reset
+    names.Obliterate();
+    values.Obliterate();
+    copy.Obliterate();
+    table.Clear();
+    list.Clear();
+    vectors.Obliterate();
+  }
+
+  size_t heldAfterFrames = arena.GetMemoryUsage();
+  arena.Reset();
+  if (arena.GetBytesUsed() != 0 || arena.GetMemoryUsage() != heldAfterFrames)
+  {
+    Log_ErrorPrintf("FAIL: arena reset");
+    return false;
+  }
+
+  return true;
+}
+
+static bool TestPlacementHints()
+{
+  // big enough to span huge pages, the hints don't change what's stored
+  const uint32 flags = Y_MALLOC_FLAG_HUGE_PAGES | Y_MALLOC_FLAG_NUMA_LOCAL;
+  AlignedMemArray<AlignedVector4, 16, FlaggedHeapAllocator> vectors((FlaggedHeapAllocator(flags)));
+  AlignedVector4 vector;
+  for (uint32 i = 0; i < 300000; i++)
+  {
+    vector.Values[0] = (float)i;
+    vectors.Add(vector);
+  }
+
+  bool result = vectors.GetAllocator().GetFlags() == flags && ((size_t)vectors.GetBasePointer() & 15) == 0;
+  for (uint32 i = 0; i < vectors.GetSize() && result; i += 997)
+    result = vectors[i].Values[0] == (float)i;
+
+  MemoryArena arena(4 * 1024 * 1024, flags);
+  uint32* pValues = (uint32*)arena.Allocate(sizeof(uint32) * 1000000, 64);
+  for (uint32 i = 0; i < 1000000; i++)
+    pValues[i] = i;
+  result = result && ((size_t)pValues & 63) == 0 && pValues[999999] == 999999;
+
+  void* pMemory = Y_aligned_malloc_flags(10, 32, flags);
+  result = result && pMemory != nullptr && ((size_t)pMemory & 31) == 0;
+  Y_aligned_free(pMemory);
+
+  if (!result)
+  {
+    Log_ErrorPrintf("FAIL: huge page and NUMA hints");
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: huge page and NUMA hints");
+  return true;
+}
+
+// points into itself, so it has to be copied and destroyed whenever it moves
+struct SelfReference
+{
+  // shared by the pool threads
+  static Y_ATOMIC_DECL int32 s_liveCount;
+
+  SelfReference(uint32 value = 0) : Value(value), pSelf(this) { Y_AtomicIncrement(s_liveCount); }
+  SelfReference(const SelfReference& copy) : Value(copy.Value), pSelf(this) { Y_AtomicIncrement(s_liveCount); }
+  ~SelfReference() { Y_AtomicDecrement(s_liveCount); }
+  bool operator!=(const SelfReference& rhs) const { return (Value != rhs.Value); }
+  bool IsValid() const { return (pSelf == this); }
+
+  uint32 Value;
+  SelfReference* pSelf;
+};
+Y_ATOMIC_DECL int32 SelfReference::s_liveCount = 0;
+
+static bool TestRelocation()
+{
+  if (!RelocationTrait<String>::IsTriviallyRelocatable || RelocationTrait<SmallString>::IsTriviallyRelocatable ||
+      !RelocationTrait<PODArray<uint32>>::IsTriviallyRelocatable ||
+      RelocationTrait<SelfReference>::IsTriviallyRelocatable)
+  {
+    Log_ErrorPrintf("FAIL: relocation traits");
+    return false;
+  }
+
+  // strings are reallocated in place, their references have to survive it
+  {
+    Array<String> names;
+    SmallString name;
+    for (uint32 i = 0; i < 1000; i++)
+    {
+      name.Format("name%u", i);
+      names.Add(name);
+    }
+
+    names.OrderedRemove(0);
+    names.FastRemove(0);
+    names.Resize(500);
+    names.Shrink();
+    if (names.GetSize() != 500 || names[0] != "name999" || names[1] != "name2" || names[499] != "name500")
+    {
+      Log_ErrorPrintf("FAIL: relocated string array");
+      return false;
+    }
+  }
+
+  // everything else is copied, and every copy destroyed
+  {
+    Array<SelfReference> values;
+    for (uint32 i = 0; i < 100; i++)
+      values.Add(SelfReference(i));
+
+    values.OrderedRemove(10);
+    values.Resize(50);
+    values.Shrink();
+    for (uint32 i = 0; i < values.GetSize(); i++)
+    {
+      if (!values[i].IsValid() || values[i].Value != ((i < 10) ? i : i + 1))
+      {
+        Log_ErrorPrintf("FAIL: copied element %u", i);
+        return false;
+      }
+    }
+  }
+
+  if (SelfReference::s_liveCount != 0)
+  {
+    Log_ErrorPrintf("FAIL: %d elements were never destroyed", SelfReference::s_liveCount);
+    return false;
+  }
+
+  if (Y_GetArrayGrowthSize(100, 101) != 100 * Y_ARRAY_GROWTH_PERCENT / 100 || Y_GetArrayGrowthSize(0, 5) != 5)
+  {
+    Log_ErrorPrintf("FAIL: growth size");
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: array relocation");
+  return true;
+}
+
+// Builds strings in its scratch arena, which the thread releases when it exits.
+class ScratchThread : public Thread
+{
+public:
+  ScratchThread() : m_pArena(nullptr), m_failed(false) {}
+
+  const MemoryArena* GetArena() const { return m_pArena; }
+  bool HasFailed() const { return m_failed; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    m_pArena = &MemoryArena::GetThreadScratchArena();
+    for (uint32 i = 0; i < 1000; i++)
+    {
+      ScopedArenaRewind scratch(*m_pArena);
+      ArenaString text(*m_pArena);
+      text.Format("line %u", i);
+      m_failed |= (text.GetLength() != Y_strlen(text) || m_pArena->GetBytesUsed() != 256);
+    }
+
+    m_failed |= (m_pArena->GetBytesUsed() != 0);
+    return 0;
+  }
+
+private:
+  MemoryArena* m_pArena;
+  bool m_failed;
+};
+
+static bool TestArenaRewind()
+{
+  MemoryArena arena(1024);
+  arena.Allocate(100, 1);
+  MemoryArena::Marker marker = arena.GetMarker();
+
+  // spill into more blocks, then rewind back into the first
+  for (uint32 i = 0; i < 10; i++)
+    arena.Allocate(1000, 16);
+  arena.Rewind(marker);
+  void* pAfterRewind = arena.Allocate(8, 8);
+  if (arena.GetBytesUsed() != 112 || ((size_t)pAfterRewind & 7) != 0)
+  {
+    Log_ErrorPrintf("FAIL: arena rewind left %u bytes used", (uint32)arena.GetBytesUsed());
+    return false;
+  }
+
+  // arena strings move to the heap when they outgrow their buffer, and copies don't share the buffer
+  {
+    ScopedArenaRewind scratch(arena);
+    ArenaString text(arena, 8);
+    text.Assign("short");
+    const char* pArenaBuffer = text.GetCharArray();
+    String copy(text);
+    text.AppendString(" but now much longer");
+    if (copy.GetCharArray() == pArenaBuffer || copy != "short" || text != "short but now much longer" ||
+        text.GetCharArray() == pArenaBuffer)
+    {
+      Log_ErrorPrintf("FAIL: arena string");
+      return false;
+    }
+  }
+
+  if (arena.GetBytesUsed() != 112)
+  {
+    Log_ErrorPrintf("FAIL: scoped rewind left %u bytes used", (uint32)arena.GetBytesUsed());
+    return false;
+  }
+
+  ScratchThread thread;
+  thread.Start();
+  thread.Join();
+  if (thread.HasFailed() || thread.GetArena() == &MemoryArena::GetThreadScratchArena())
+  {
+    Log_ErrorPrintf("FAIL: thread scratch arena");
+    return false;
+  }
+
+  MemoryArena::ReleaseThreadScratchArena();
+  Log_InfoPrintf("PASS: arena rewind and scratch strings");
+  return true;
+}
+
+// Allocates through its own cache and frees half of what it allocated through the pool, the rest through the cache.
+class PoolThread : public Thread
+{
+public:
+  static const uint32 ITERATIONS = 20000;
+  static const uint32 LIVE_COUNT = 100;
+
+  PoolThread(QueuedAllocator<SelfReference>* pPool) : m_pPool(pPool), m_failed(false) {}
+
+  bool HasFailed() const { return m_failed; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    QueuedAllocator<SelfReference>::ThreadCache cache(m_pPool);
+    SelfReference* live[LIVE_COUNT] = {};
+    for (uint32 i = 0; i < ITERATIONS; i++)
+    {
+      uint32 slot = (i * 7) % LIVE_COUNT;
+      if (live[slot] != nullptr)
+      {
+        if (!live[slot]->IsValid() || live[slot]->Value != slot)
+          m_failed = true;
+
+        if ((i & 1) != 0)
+          cache.Free(live[slot]);
+        else
+          m_pPool->Free(live[slot]);
+      }
+
+      live[slot] = cache.Allocate(slot);
+    }
+
+    for (uint32 i = 0; i < LIVE_COUNT; i++)
+      cache.Free(live[i]);
+
+    return 0;
+  }
+
+private:
+  QueuedAllocator<SelfReference>* m_pPool;
+  bool m_failed;
+};
+
+static bool TestQueuedAllocator()
+{
+  QueuedAllocator<SelfReference, 16> pool;
+  pool.Reserve(20);
+
+  // freed objects are reused before any new slab
+  SelfReference* pFirst = pool.Allocate(1u);
+  pool.Free(pFirst);
+  SelfReference* pSecond = pool.Allocate(SelfReference(2));
+  if (pSecond != pFirst || pSecond->Value != 2 || !pSecond->IsValid() || pool.GetSlabCount() != 2 ||
+      pool.GetFreeListSize() != 31)
+  {
+    Log_ErrorPrintf("FAIL: pool reuse (%u slabs, %u free)", (uint32)pool.GetSlabCount(),
+                    (uint32)pool.GetFreeListSize());
+    return false;
+  }
+  pool.Free(pSecond);
+
+  static const uint32 THREAD_COUNT = 4;
+  QueuedAllocator<SelfReference> sharedPool;
+  PoolThread* threads[THREAD_COUNT];
+  for (uint32 i = 0; i < THREAD_COUNT; i++)
+  {
+    threads[i] = new PoolThread(&sharedPool);
+    threads[i]->Start();
+  }
+
+  bool failed = false;
+  for (uint32 i = 0; i < THREAD_COUNT; i++)
+  {
+    threads[i]->Join();
+    failed |= threads[i]->HasFailed();
+    delete threads[i];
+  }
+
+  // every object is back, and the pool never held much more than the threads could have live at once
+  if (failed || SelfReference::s_liveCount != 0 || sharedPool.GetFreeListSize() != sharedPool.GetCapacity() ||
+      sharedPool.GetCapacity() > THREAD_COUNT * (PoolThread::LIVE_COUNT + 128))
+  {
+    Log_ErrorPrintf("FAIL: threaded pool (%d live, %u free of %u)", SelfReference::s_liveCount,
+                    (uint32)sharedPool.GetFreeListSize(), (uint32)sharedPool.GetCapacity());
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: queued allocator (%u slabs for %u threads)", (uint32)sharedPool.GetSlabCount(), THREAD_COUNT);
+  return true;
+}
+
+static bool TestSoAArray()
+{
+  AlignedSoAArray<32, HeapAllocator, float, uint16, uint64> values;
+  for (uint32 i = 0; i < 1000; i++)
+    values.Add((float)i, (uint16)(i * 3), (uint64)i << 32);
+
+  // 0 and 1 swap in the last elements, then the ordered remove shifts everything after 10 down
+  values.FastRemove(0);
+  values.FastRemove(1);
+  values.OrderedRemove(10);
+  bool failed = (values.GetSize() != 997 || values.GetField<0>(0) != 999.0f || values.GetField<1>(1) != 998 * 3 ||
+                 values.GetField<2>(10) != (uint64)11 << 32 || values.GetField<0>(996) != 997.0f);
+  for (uint32 column = 0; column < 3; column++)
+  {
+    const void* pColumn = (column == 0) ? (const void*)values.GetColumn<0>() :
+                                          ((column == 1) ? (const void*)values.GetColumn<1>() : values.GetColumn<2>());
+    failed |= (((size_t)pColumn & 31) != 0);
+  }
+
+  // the columns survive growing, copying and shrinking
+  float sum = 0.0f;
+  const float* pX = values.GetColumn<0>();
+  for (uint32 i = 0; i < values.GetSize(); i++)
+    sum += pX[i];
+
+  AlignedSoAArray<32, HeapAllocator, float, uint16, uint64> copy(values);
+  copy.Reserve(5000);
+  copy.Shrink();
+  values.Set(5, 1.0f, 2, 3);
+  failed |= (copy == values || copy.GetReserve() != 997 || values.GetField<2>(5) != 3);
+  copy.Set(5, 1.0f, 2, 3);
+  // 0, 1 and 10 are gone from the sum
+  failed |= (copy != values || sum != 499489.0f);
+
+  SoAArray<uint32> indices;
+  for (uint32 i = 0; i < 100; i++)
+    indices.Add(i);
+  indices.Shrink();
+  failed |= (indices.GetReserve() != 100 || ((size_t)indices.GetColumn<0>() & 15) != 0);
+
+  AlignedSoAArray<32, HeapAllocator, float, uint16, uint64> empty;
+  empty.Swap(copy);
+  if (failed || copy.GetSize() != 0 || empty.GetSize() != 997)
+  {
+    Log_ErrorPrintf("FAIL: soa array");
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: soa array");
+  return true;
+}
+
+static bool TestPoolAllocator()
+{
+  // freed blocks are reused by their size class, big or overaligned blocks skip the pool
+  PoolAllocator pool(1024);
+  void* pSmall = pool.Allocate(20, 8);
+  void* pLarge = pool.Allocate(1000, 8);
+  pool.Free(pSmall, 20, 8);
+  if (pool.Allocate(32, 8) != pSmall || pool.Reallocate(pSmall, 32, 24, 8) != pSmall || pool.GetLiveBlockCount() != 1 ||
+      pool.GetMemoryUsage() != PoolAllocator::PoolGranularity + 1024)
+  {
+    Log_ErrorPrintf("FAIL: pool size classes (%u live)", (uint32)pool.GetLiveBlockCount());
+    return false;
+  }
+  pool.Free(pSmall, 24, 8);
+  pool.Free(pLarge, 1000, 8);
+
+  // churn the containers so their nodes end up out of order, then compact them back into iteration order
+  LinkedList<String, PoolAllocator> list;
+  HashTable<uint32, String, HashTrait<uint32>, PoolAllocator> table;
+  StringHashTable<uint32, PoolAllocator> names;
+  CIStringHashTable<uint32, PoolAllocator> ciNames;
+  SmallString name;
+  for (uint32 i = 0; i < 2000; i++)
+  {
+    name.Format("name%u", i);
+    list.PushBack(name);
+    table.Insert(i, name);
+    names.Insert(name, i);
+    ciNames.Insert(name, i);
+  }
+  for (uint32 i = 0; i < 2000; i += 2)
+  {
+    name.Format("name%u", i);
+    list.Remove(name);
+    table.Remove(i);
+    names.Remove(name);
+    ciNames.Remove(name);
+  }
+  for (uint32 i = 2000; i < 2500; i++)
+  {
+    name.Format("name%u", i);
+    list.PushFront(name);
+    table.Insert(i, name);
+    names.Insert(name, i);
+    ciNames.Insert(name, i);
+  }
+
+  size_t usageBefore = table.GetAllocator().GetMemoryUsage();
+  list.Compact();
+  table.Compact();
+  names.Compact();
+  ciNames.Compact();
+
+  // members are laid out one after another in iteration order, apart from where a slab runs out
+  uint32 outOfOrder = 0;
+  const HashTable<uint32, String, HashTrait<uint32>, PoolAllocator>::Member* pPrevious = NULL;
+  for (auto itr = table.Begin(); itr != table.End(); ++itr)
+  {
+    if (pPrevious != NULL && &(*itr) < pPrevious)
+      outOfOrder++;
+    pPrevious = &(*itr);
+  }
+
+  bool failed = (list.GetSize() != 1500 || table.GetMemberCount() != 1500 || names.GetMemberCount() != 1500 ||
+                 ciNames.GetMemberCount() != 1500 || outOfOrder > table.GetAllocator().GetMemoryUsage() / 1024 ||
+                 table.GetAllocator().GetMemoryUsage() >= usageBefore ||
+                 table.GetAllocator().GetLiveBlockCount() != table.GetMemberCount());
+  for (uint32 i = 0; i < 2500 && !failed; i++)
+  {
+    name.Format("NAME%u", i);
+    bool present = (i >= 2000 || (i & 1) != 0);
+    const auto* pMember = table.Find(i);
+    failed = (present != (pMember != NULL) || (pMember != NULL && pMember->Value.CompareInsensitive(name) == false) ||
+              present != (ciNames.Find(name) != NULL) || names.Find(name) != NULL);
+    name.Format("name%u", i);
+    failed |= (present != (names.Find(name) != NULL) || (present && list.Find(name) == list.End()));
+  }
+
+  if (failed)
+  {
+    Log_ErrorPrintf("FAIL: compacted pooled containers (%u out of order)", outOfOrder);
+    return false;
+  }
+
+  // a copy gets its own pool
+  StringHashTable<uint32, PoolAllocator> namesCopy(names);
+  if (namesCopy.GetAllocator().GetLiveBlockCount() != 1500 || names.GetAllocator().GetLiveBlockCount() != 1500 ||
+      namesCopy.Find("name1")->Value != 1)
+  {
+    Log_ErrorPrintf("FAIL: copied pooled table");
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: pool allocator (%u bytes for %u table members)", (uint32)table.GetAllocator().GetMemoryUsage(),
+                 table.GetMemberCount());
+  return true;
+}
+
+// Streams a counting byte sequence into a buffer in assorted chunk sizes, alternating between copying writes and
+// the zero-copy write pointer.
+class RingProducerThread : public Thread
+{
+public:
+  static const uint32 BYTE_COUNT = 1 << 20;
+
+  RingProducerThread(SPSCCircularBuffer* pBuffer) : m_pBuffer(pBuffer) {}
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    byte chunk[257];
+    uint32 position = 0;
+    for (uint32 chunkIndex = 0; position < BYTE_COUNT; chunkIndex++)
+    {
+      size_t chunkSize = Min((size_t)(1 + (chunkIndex * 37) % 257), (size_t)(BYTE_COUNT - position));
+      if ((chunkIndex & 1) != 0)
+      {
+        for (size_t i = 0; i < chunkSize; i++)
+          chunk[i] = (byte)(position + i);
+        while (!m_pBuffer->Write(chunk, chunkSize))
+          Thread::Yield();
+      }
+      else
+      {
+        void* pWritePointer;
+        size_t availableBytes = 1;
+        while (!m_pBuffer->GetWritePointer(&pWritePointer, &availableBytes))
+        {
+          Thread::Yield();
+          availableBytes = 1;
+        }
+
+        chunkSize = Min(chunkSize, availableBytes);
+        for (size_t i = 0; i < chunkSize; i++)
+          reinterpret_cast<byte*>(pWritePointer)[i] = (byte)(position + i);
+        m_pBuffer->MoveWritePointer(chunkSize);
+      }
+
+      position += (uint32)chunkSize;
+    }
+
+    return 0;
+  }
+
+private:
+  SPSCCircularBuffer* m_pBuffer;
+};
+
+static bool TestSPSCCircularBuffer()
+{
+  // a mirrored buffer hands out the data across the wrap-around as one piece
+  SPSCCircularBuffer mirrored(4096, true);
+  if (mirrored.IsMirrored())
+  {
+    byte data[4096];
+    for (uint32 i = 0; i < countof(data); i++)
+      data[i] = (byte)i;
+
+    size_t size = mirrored.GetBufferSize();
+    const void* pReadPointer;
+    size_t readBytes;
+    bool wrapped = true;
+    for (size_t position = 0; wrapped && position < size - 500; position += 100)
+      wrapped = (mirrored.Write(data, 100) && mirrored.Read(data, 100));
+    wrapped = (wrapped && mirrored.Write(data, 1000) && mirrored.GetContiguousUsedBytes() == 1000 &&
+               mirrored.GetReadPointer(&pReadPointer, &readBytes) && readBytes == 1000 &&
+               std::memcmp(pReadPointer, data, 1000) == 0);
+    if (!wrapped)
+    {
+      Log_ErrorPrintf("FAIL: mirrored ring buffer wrap-around");
+      return false;
+    }
+  }
+
+  for (uint32 pass = 0; pass < 2; pass++)
+  {
+    SPSCCircularBuffer buffer(4096, pass == 1);
+    RingProducerThread producer(&buffer);
+    producer.Start();
+
+    // consume with copying reads and the read pointer in turn, checking the sequence is unbroken
+    bool failed = false;
+    byte chunk[200];
+    uint32 position = 0;
+    for (uint32 chunkIndex = 0; position < RingProducerThread::BYTE_COUNT && !failed; chunkIndex++)
+    {
+      if ((chunkIndex & 1) != 0)
+      {
+        size_t chunkSize =
+          Min((size_t)(1 + (chunkIndex * 13) % 200), (size_t)(RingProducerThread::BYTE_COUNT - position));
+        while (!buffer.Read(chunk, chunkSize))
+          Thread::Yield();
+        for (size_t i = 0; i < chunkSize; i++)
+          failed |= (chunk[i] != (byte)(position + i));
+        position += (uint32)chunkSize;
+      }
+      else
+      {
+        const void* pReadPointer;
+        size_t availableBytes;
+        while (!buffer.GetReadPointer(&pReadPointer, &availableBytes))
+          Thread::Yield();
+        for (size_t i = 0; i < availableBytes; i++)
+          failed |= (reinterpret_cast<const byte*>(pReadPointer)[i] != (byte)(position + i));
+        buffer.MoveReadPointer(availableBytes);
+        position += (uint32)availableBytes;
+      }
+    }
+
+    producer.Join();
+    if (failed || position != RingProducerThread::BYTE_COUNT || buffer.GetBufferUsed() != 0)
+    {
+      Log_ErrorPrintf("FAIL: %s ring buffer stream broke at byte %u", (pass == 1) ? "mirrored" : "plain", position);
+      return false;
+    }
+  }
+
+  Log_InfoPrintf("PASS: spsc circular buffer (mirroring %s)", mirrored.IsMirrored() ? "available" : "unavailable");
+  return true;
+}
+
+// Allocates blocks of assorted sizes for another thread to free, or frees the ones it was handed.
+class HeapThread : public Thread
+{
+public:
+  static const uint32 BLOCK_COUNT = 5000;
+
+  HeapThread(byte** ppBlocks, bool allocate) : m_ppBlocks(ppBlocks), m_allocate(allocate), m_failed(false) {}
+
+  bool HasFailed() const { return m_failed; }
+
+  static uint32 GetBlockSize(uint32 index) { return 1 + (index * 37) % 600; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    for (uint32 i = 0; i < BLOCK_COUNT; i++)
+    {
+      if (m_allocate)
+      {
+        m_ppBlocks[i] = (byte*)ThreadCachedHeap::Allocate(GetBlockSize(i));
+        std::memset(m_ppBlocks[i], (byte)i, GetBlockSize(i));
+      }
+      else
+      {
+        if (m_ppBlocks[i][0] != (byte)i || m_ppBlocks[i][GetBlockSize(i) - 1] != (byte)i)
+          m_failed = true;
+
+        ThreadCachedHeap::Free(m_ppBlocks[i]);
+      }
+    }
+
+    return 0;
+  }
+
+private:
+  byte** m_ppBlocks;
+  bool m_allocate;
+  bool m_failed;
+};
+
+static bool TestThreadCachedHeap()
+{
+  static const uint32 sizes[] = {1, 16, 17, 100, 129, 1000, 4096, 8192, 8193, 100000};
+  for (uint32 i = 0; i < countof(sizes); i++)
+  {
+    for (size_t alignment = 16; alignment <= ThreadCachedHeap::MaxAlignment; alignment *= 4)
+    {
+      byte* pMemory = (byte*)ThreadCachedHeap::AllocateAligned(sizes[i], alignment);
+      if (pMemory == nullptr || ((uintptr_t)pMemory & (alignment - 1)) != 0 ||
+          ThreadCachedHeap::GetUsableSize(pMemory) < sizes[i])
+      {
+        Log_ErrorPrintf("FAIL: heap allocation of %u bytes aligned to %u", sizes[i], (uint32)alignment);
+        return false;
+      }
+
+      // growing has to keep the contents and the alignment
+      std::memset(pMemory, 0xAB, sizes[i]);
+      byte* pGrown = (byte*)ThreadCachedHeap::ReallocateAligned(pMemory, sizes[i] * 3, alignment);
+      bool grownOk = (((uintptr_t)pGrown & (alignment - 1)) == 0 && pGrown[0] == 0xAB && pGrown[sizes[i] - 1] == 0xAB);
+      ThreadCachedHeap::Free(pGrown);
+      if (!grownOk)
+      {
+        Log_ErrorPrintf("FAIL: heap reallocation of %u bytes aligned to %u", sizes[i], (uint32)alignment);
+        return false;
+      }
+    }
+  }
+
+  // freed blocks are reused by the same thread
+  void* pFirst = ThreadCachedHeap::Allocate(48);
+  ThreadCachedHeap::Free(pFirst);
+  void* pSecond = ThreadCachedHeap::Allocate(40);
+  ThreadCachedHeap::Free(pSecond);
+  if (pFirst != pSecond)
+  {
+    Log_ErrorPrintf("FAIL: heap block reuse");
+    return false;
+  }
+
+  // blocks allocated on one thread and freed on another have to find their way back for reuse
+  byte** ppBlocks = new byte*[HeapThread::BLOCK_COUNT];
+  ThreadCachedHeap::Stats firstRoundStats;
+  bool failed = false;
+  for (uint32 round = 0; round < 4; round++)
+  {
+    HeapThread allocateThread(ppBlocks, true);
+    allocateThread.Start();
+    allocateThread.Join();
+
+    HeapThread freeThread(ppBlocks, false);
+    freeThread.Start();
+    freeThread.Join();
+    failed |= freeThread.HasFailed();
+
+    if (round == 0)
+      ThreadCachedHeap::GetStats(&firstRoundStats);
+  }
+  delete[] ppBlocks;
+
+  ThreadCachedHeap::Stats stats;
+  ThreadCachedHeap::GetStats(&stats);
+  ThreadCachedHeap::ReleaseThreadCache();
+  if (failed || stats.SpanCount != firstRoundStats.SpanCount || stats.LargeAllocationCount != 0)
+  {
+    Log_ErrorPrintf("FAIL: cross-thread heap frees (%u spans after the first round, %u after the last)",
+                    firstRoundStats.SpanCount, stats.SpanCount);
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: thread cached heap (%u spans, %u KB)", stats.SpanCount, (uint32)(stats.SpanMemory / 1024));
+  return true;
+}
+
+static bool TestMemoryTracker()
+{
+  uint32 tag = MemoryTracker::RegisterTag("TestArray");
+  if (tag == 0 || MemoryTracker::RegisterTag("TestArray") != tag)
+  {
+    Log_ErrorPrintf("FAIL: memory tag registration");
+    return false;
+  }
+
+  MemoryTracker::TagStats before;
+  MemoryTracker::GetTagStats(tag, &before);
+  uint32 previousSampleRate = MemoryTracker::GetSampleRate();
+  MemoryTracker::SetSampleRate(1);
+
+  PODArray<uint32> array;
+  void* pAligned;
+  {
+    ScopedMemoryTag scopedTag(tag);
+    for (uint32 i = 0; i < 1000; i++)
+      array.Add(i);
+
+    pAligned = Y_aligned_realloc(Y_aligned_malloc(100, 64), 1000, 64);
+  }
+
+  MemoryTracker::SetSampleRate(previousSampleRate);
+  MemoryTracker::TagStats during;
+  MemoryTracker::GetTagStats(tag, &during);
+  bool aligned = (((uintptr_t)pAligned & 63) == 0);
+#if Y_MEMORY_TRACKING
+  uint32 reserve = array.GetReserve();
+#endif
+  Y_aligned_free(pAligned);
+  array.Obliterate();
+
+  MemoryTracker::TagStats after;
+  MemoryTracker::GetTagStats(tag, &after);
+  if (MemoryTracker::GetCurrentTag() != 0 || !aligned)
+  {
+    Log_ErrorPrintf("FAIL: memory tag scope");
+    return false;
+  }
+
+#if Y_MEMORY_TRACKING
+  // the array's growth and the aligned block are charged to the tag, and given back when freed
+  MemoryTracker::StackSample samples[4];
+  uint32 sampleCount = MemoryTracker::GetStackSamples(samples, countof(samples));
+  if (during.CurrentBytes != before.CurrentBytes + reserve * sizeof(uint32) + 1000 ||
+      during.CurrentCount != before.CurrentCount + 2 || during.TotalCount <= before.TotalCount + 2 ||
+      after.CurrentBytes != before.CurrentBytes || after.CurrentCount != before.CurrentCount ||
+      during.PeakBytes < 1000 * sizeof(uint32) || sampleCount == 0)
+  {
+    Log_ErrorPrintf("FAIL: memory tracking (%llu bytes in %llu allocations while tagged, %llu after)",
+                    during.CurrentBytes, during.CurrentCount, after.CurrentBytes);
+    return false;
+  }
+
+  MemoryTracker::Dump(2);
+#endif
+
+  Log_InfoPrintf("PASS: memory tracker (%llu allocations tagged)", after.TotalCount - before.TotalCount);
+  return true;
+}
+
+static bool TestStridedCopy()
+{
+  static const uint32 elementSizes[] = {1, 2, 3, 4, 8, 12, 16, 20};
+  static const uint32 COUNT = 37;
+  byte source[COUNT * 64];
+  byte destination[COUNT * 64 + 16];
+  byte expected[COUNT * 64 + 16];
+  for (uint32 i = 0; i < countof(source); i++)
+    source[i] = (byte)(i * 131 + 7);
+
+  for (uint32 sizeIndex = 0; sizeIndex < countof(elementSizes); sizeIndex++)
+  {
+    uint32 size = elementSizes[sizeIndex];
+    const uint32 sourceStrides[] = {size, size + 4, 8, 16, 32, 64};
+    const uint32 destinationStrides[] = {size, size * 2, 16};
+    for (uint32 i = 0; i < countof(sourceStrides); i++)
+    {
+      for (uint32 j = 0; j < countof(destinationStrides); j++)
+      {
+        uint32 sourceStride = sourceStrides[i], destinationStride = destinationStrides[j];
+        if (sourceStride < size || destinationStride < size)
+          continue;
+
+        std::memset(expected, 0xCD, sizeof(expected));
+        for (uint32 k = 0; k < COUNT; k++)
+          std::memcpy(expected + k * destinationStride, source + k * sourceStride, size);
+
+        for (uint32 streaming = 0; streaming < 2; streaming++)
+        {
+          std::memset(destination, 0xCD, sizeof(destination));
+          if (streaming != 0)
+            Y_memcpy_stride_streaming(destination, destinationStride, source, sourceStride, size, COUNT);
+          else
+            Y_memcpy_stride(destination, destinationStride, source, sourceStride, size, COUNT);
+
+          if (std::memcmp(destination, expected, sizeof(destination)) != 0 ||
+              Y_memcmp_stride(destination, destinationStride, source, sourceStride, size, COUNT) != 0)
+          {
+            Log_ErrorPrintf("FAIL: strided copy of %u byte elements from stride %u to %u", size, sourceStride,
+                            destinationStride);
+            return false;
+          }
+        }
+
+        // a difference in the last element has to order like memcmp
+        byte* pLast = destination + (COUNT - 1) * destinationStride + size - 1;
+        *pLast += 1;
+        int32 greater = Y_memcmp_stride(destination, destinationStride, source, sourceStride, size, COUNT);
+        *pLast -= 2;
+        int32 less = Y_memcmp_stride(destination, destinationStride, source, sourceStride, size, COUNT);
+        if (greater <= 0 || less >= 0)
+        {
+          Log_ErrorPrintf("FAIL: strided compare of %u byte elements from stride %u to %u", size, sourceStride,
+                          destinationStride);
+          return false;
+        }
+      }
+    }
+  }
+
+  Log_InfoPrintf("PASS: strided copy and compare");
+  return true;
+}
+
+struct SortRecord
+{
+  int32 Key;
+  uint32 Order;
+};
+
+static int SortInt32Callback(const int32* pLeft, const int32* pRight)
+{
+  return (*pLeft < *pRight) ? -1 : ((*pLeft > *pRight) ? 1 : 0);
+}
+
+static bool TestSort()
+{
+  static const uint32 COUNT = 5000;
+  PODArray<int32> values;
+  PODArray<int32> expected;
+  uint32 seed = 1234;
+  for (uint32 i = 0; i < COUNT; i++)
+  {
+    seed = seed * 1664525 + 1013904223;
+    values.Add((int32)(seed >> 8) % 1000 - 500);
+  }
+
+  // reference is a plain insertion sort, the patterns cover random keys, sorted runs and all equal keys
+  for (uint32 pattern = 0; pattern < 4; pattern++)
+  {
+    PODArray<int32> input;
+    for (uint32 i = 0; i < COUNT; i++)
+    {
+      switch (pattern)
+      {
+        case 0: input.Add(values[i]); break;
+        case 1: input.Add((int32)i); break;
+        case 2: input.Add((int32)(COUNT - i)); break;
+        default: input.Add(7); break;
+      }
+    }
+
+    expected.Clear();
+    expected.AddRange(input.GetBasePointer(), input.GetSize());
+    Y_insertion_sort(expected.GetBasePointer(), expected.GetSize(),
+                     [](int32 left, int32 right) { return left < right; });
+
+    for (uint32 method = 0; method < 6; method++)
+    {
+      PODArray<int32> sorted;
+      sorted.AddRange(input.GetBasePointer(), input.GetSize());
+      switch (method)
+      {
+        case 0: Y_sort(sorted.GetBasePointer(), sorted.GetSize()); break;
+        case 1: Y_stable_sort(sorted.GetBasePointer(), sorted.GetSize()); break;
+        case 2: Y_radix_sort(sorted.GetBasePointer(), sorted.GetSize()); break;
+        case 3: Y_heap_sort(sorted.GetBasePointer(), sorted.GetSize(), [](int32 l, int32 r) { return l < r; }); break;
+        case 4: sorted.Sort(SortInt32Callback); break;
+        default: Y_qsortT(sorted.GetBasePointer(), sorted.GetSize(), SortInt32Callback); break;
+      }
+
+      if (std::memcmp(sorted.GetBasePointer(), expected.GetBasePointer(), sizeof(int32) * COUNT) != 0)
+      {
+        Log_ErrorPrintf("FAIL: sort method %u on pattern %u", method, pattern);
+        return false;
+      }
+    }
+  }
+
+  // stable sort and radix sort keep equal keys in their original order
+  PODArray<SortRecord> records;
+  for (uint32 i = 0; i < COUNT; i++)
+  {
+    SortRecord record = {values[i] % 16, i};
+    records.Add(record);
+  }
+  for (uint32 method = 0; method < 2; method++)
+  {
+    PODArray<SortRecord> sorted;
+    sorted.AddRange(records.GetBasePointer(), records.GetSize());
+    if (method == 0)
+    {
+      Y_stable_sort(sorted.GetBasePointer(), sorted.GetSize(),
+                    [](const SortRecord& left, const SortRecord& right) { return left.Key < right.Key; });
+    }
+    else
+    {
+      Y_radix_sort(sorted.GetBasePointer(), sorted.GetSize(), [](const SortRecord& record) { return record.Key; });
+    }
+
+    for (uint32 i = 1; i < COUNT; i++)
+    {
+      const SortRecord& previous = sorted[i - 1];
+      const SortRecord& current = sorted[i];
+      if (previous.Key > current.Key || (previous.Key == current.Key && previous.Order > current.Order))
+      {
+        Log_ErrorPrintf("FAIL: %s sort not stable at %u", (method == 0) ? "merge" : "radix", i);
+        return false;
+      }
+    }
+  }
+
+  // floating point keys, negatives included
+  PODArray<float> floats;
+  for (uint32 i = 0; i < COUNT; i++)
+    floats.Add((float)values[i] * 0.25f);
+  Y_radix_sort(floats.GetBasePointer(), floats.GetSize());
+  for (uint32 i = 1; i < COUNT; i++)
+  {
+    if (floats[i - 1] > floats[i])
+    {
+      Log_ErrorPrintf("FAIL: radix sort of floats out of order at %u", i);
+      return false;
+    }
+  }
+
+  // elements that own memory have to be moved, not copied bitwise
+  Array<String> strings;
+  for (uint32 i = 0; i < 500; i++)
+    strings.Add(String::FromFormat("%08u", (uint32)(values[i] + 1000) * 7919u));
+  Y_stable_sort(strings.GetBasePointer(), strings.GetSize(),
+                [](const String& left, const String& right) { return Y_strcmp(left, right) < 0; });
+  Y_sort(strings.GetBasePointer(), strings.GetSize(),
+         [](const String& left, const String& right) { return Y_strcmp(right, left) < 0; });
+  for (uint32 i = 1; i < strings.GetSize(); i++)
+  {
+    if (Y_strcmp(strings[i - 1], strings[i]) < 0)
+    {
+      Log_ErrorPrintf("FAIL: string sort out of order at %u", i);
+      return false;
+    }
+  }
+
+  Log_InfoPrintf("PASS: sort");
+  return true;
+}
+
+DEFINE_TEST_SUITE(Array)
+{
+  if (!TestInlineSpill())
+    return false;
+  if (!TestInlineSwap())
+    return false;
+  if (!TestArenaAllocator())
+    return false;
+  if (!TestArenaRewind())
+    return false;
+  if (!TestPlacementHints())
+    return false;
+  if (!TestRelocation())
+    return false;
+  if (!TestQueuedAllocator())
+    return false;
+  if (!TestSoAArray())
+    return false;
+  if (!TestPoolAllocator())
+    return false;
+  if (!TestSPSCCircularBuffer())
+    return false;
+  if (!TestThreadCachedHeap())
+    return false;
+  if (!TestSort())
+    return false;
+  if (!TestMemoryTracker())
+    return false;
+  if (!TestStridedCopy())
+    return false;
+
+  return true;
+}
@@ -0,0 +1,372 @@
+#include "TestSuite.h"
+#include "YBaseLib/ArrayAlgorithms.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/ParallelArrayAlgorithms.h"
+#include "YBaseLib/ThreadPool.h"
+#include <cstring>
+#include <limits>
+Log_SetChannel(TestArrayAlgorithms);
+
+// Arrays are built from a few values per type, so compares go both ways and equal often. The unsigned ones sit on
+// both sides of the sign bit, and floating point ones are halves, so sums of a few thousand are exact.
+static void GetTestValues(const int32** ppValues, uint32* pCount)
+{
+  static const int32 values[] = {INT32_MIN, -20, -3, -1, 0, 1, 2, 7, 19, INT32_MAX};
+  *ppValues = values;
+  *pCount = countof(values);
+}
+static void GetTestValues(const uint32** ppValues, uint32* pCount)
+{
+  static const uint32 values[] = {0, 1, 5, 0x7FFFFFFF, 0x80000000, 0x80000003, 0xFFFFFFFE, 0xFFFFFFFF};
+  *ppValues = values;
+  *pCount = countof(values);
+}
+static void GetTestValues(const int64** ppValues, uint32* pCount)
+{
+  static const int64 values[] = {INT64_MIN, -0x100000000ll, -0xFFFFFFFFll, -1, 0, 1, 0xFFFFFFFFll, 0x100000001ll,
+                                 INT64_MAX};
+  *ppValues = values;
+  *pCount = countof(values);
+}
+static void GetTestValues(const uint64** ppValues, uint32* pCount)
+{
+  static const uint64 values[] = {0, 1, 0xFFFFFFFFull, 0x100000000ull, 0x7FFFFFFFFFFFFFFFull, 0x8000000000000000ull,
+                                  0x8000000100000000ull, 0xFFFFFFFFFFFFFFFFull};
+  *ppValues = values;
+  *pCount = countof(values);
+}
+static void GetTestValues(const float** ppValues, uint32* pCount)
+{
+  static const float values[] = {-20.0f, -2.5f, -0.5f, -0.0f, 0.0f, 0.5f, 1.0f, 3.5f, 12.0f};
+  *ppValues = values;
+  *pCount = countof(values);
+}
+static void GetTestValues(const double** ppValues, uint32* pCount)
+{
+  static const double values[] = {-20.0, -2.5, -0.5, -0.0, 0.0, 0.5, 1.0, 3.5, 12.0};
+  *ppValues = values;
+  *pCount = countof(values);
+}
+
+template<typename T>
+static void FillValues(PODArray<T>& array, uint32 count, uint32 seed)
+{
+  const T* pValues;
+  uint32 valueCount;
+  GetTestValues(&pValues, &valueCount);
+
+  array.Resize(count);
+  uint32 state = seed * 2654435761u + 1;
+  for (uint32 i = 0; i < count; i++)
+  {
+    state = state * 1664525u + 1013904223u;
+    array[i] = pValues[(state >> 16) % valueCount];
+  }
+}
+
+template<typename T>
+static bool CompareReference(T element, Y_ARRAY_COMPARE compare, T value)
+{
+  switch (compare)
+  {
+    case Y_ARRAY_COMPARE_EQUAL:
+      return element == value;
+    case Y_ARRAY_COMPARE_NOT_EQUAL:
+      return element != value;
+    case Y_ARRAY_COMPARE_LESS:
+      return element < value;
+    case Y_ARRAY_COMPARE_LESS_EQUAL:
+      return element <= value;
+    case Y_ARRAY_COMPARE_GREATER:
+      return element > value;
+    default:
+      return element >= value;
+  }
+}
+
+// integers wrap
+template<typename T>
+static T AddReference(T a, T b)
+{
+  return a + b;
+}
+static int32 AddReference(int32 a, int32 b)
+{
+  return (int32)((uint32)a + (uint32)b);
+}
+static int64 AddReference(int64 a, int64 b)
+{
+  return (int64)((uint64)a + (uint64)b);
+}
+
+// an empty array's base pointer can be null, which memcmp and memcpy mustn't be given even for no bytes
+template<typename T>
+static bool SameValues(const T* pA, const T* pB, uint32 count)
+{
+  return (count == 0 || std::memcmp(pA, pB, sizeof(T) * count) == 0);
+}
+
+template<typename T>
+static bool CheckArray(const PODArray<T>& array, const char* typeName)
+{
+  const T* pValues;
+  uint32 valueCount;
+  GetTestValues(&pValues, &valueCount);
+  uint32 count = array.GetSize();
+  bool result = true;
+
+  // the first of each value, the value not there
+  for (uint32 i = 0; i < valueCount && result; i++)
+  {
+    int32 expected = -1;
+    for (uint32 j = 0; j < count && expected < 0; j++)
+      expected = (array[j] == pValues[i]) ? (int32)j : -1;
+
+    result = (Y_array_find(array, pValues[i]) == expected);
+  }
+  result = result && Y_array_find(array.GetBasePointer(), count, (T)42) == -1;
+
+  // filter only writes what it keeps, so the sentinel after stays
+  PODArray<T> filtered;
+  for (uint32 compare = 0; compare < Y_ARRAY_COMPARE_COUNT && result; compare++)
+  {
+    for (uint32 i = 0; i < valueCount && result; i++)
+    {
+      PODArray<T> expected;
+      for (uint32 j = 0; j < count; j++)
+      {
+        if (CompareReference(array[j], (Y_ARRAY_COMPARE)compare, pValues[i]))
+          expected.Add(array[j]);
+      }
+
+      filtered.Resize(count + 1);
+      for (uint32 j = 0; j <= count; j++)
+        filtered[j] = (T)42;
+
+      uint32 keptCount = Y_array_filter(filtered.GetBasePointer(), array.GetBasePointer(), count,
+                                        (Y_ARRAY_COMPARE)compare, pValues[i]);
+      result = Y_array_count(array, (Y_ARRAY_COMPARE)compare, pValues[i]) == expected.GetSize() &&
+               keptCount == expected.GetSize() &&
+               SameValues(filtered.GetBasePointer(), expected.GetBasePointer(), keptCount);
+      for (uint32 j = keptCount; j <= count && result; j++)
+        result = (filtered[j] == (T)42);
+
+      // and in place
+      filtered.Resize(count);
+      if (count > 0)
+        std::memcpy(filtered.GetBasePointer(), array.GetBasePointer(), sizeof(T) * count);
+      result = result && Y_array_filter(&filtered, (Y_ARRAY_COMPARE)compare, pValues[i]) == expected.GetSize() &&
+               filtered.GetSize() == expected.GetSize() &&
+               SameValues(filtered.GetBasePointer(), expected.GetBasePointer(), keptCount);
+    }
+  }
+
+  T minValue = std::numeric_limits<T>::max();
+  T maxValue = std::numeric_limits<T>::lowest();
+  T sum = T();
+  PODArray<T> prefixSums;
+  for (uint32 i = 0; i < count; i++)
+  {
+    minValue = (array[i] < minValue) ? array[i] : minValue;
+    maxValue = (array[i] > maxValue) ? array[i] : maxValue;
+    sum = AddReference(sum, array[i]);
+    prefixSums.Add(AddReference(sum, (T)3));
+  }
+
+  T arrayMin, arrayMax;
+  if (count > 0)
+    result = result && Y_array_minmax(array, &arrayMin, &arrayMax) && arrayMin == minValue && arrayMax == maxValue;
+  else
+    result = result && !Y_array_minmax(array, &arrayMin, &arrayMax);
+
+  result = result && Y_array_sum(array) == sum;
+
+  PODArray<T> sums;
+  sums.Resize(count);
+  result = result && Y_array_prefix_sum(sums.GetBasePointer(), array.GetBasePointer(), count, (T)3) ==
+                       AddReference(sum, (T)3) &&
+           SameValues(sums.GetBasePointer(), prefixSums.GetBasePointer(), count);
+  sums.Assign(array);
+  Y_array_prefix_sum(&sums, (T)3);
+  result = result && SameValues(sums.GetBasePointer(), prefixSums.GetBasePointer(), count);
+
+  if (!result)
+    Log_ErrorPrintf("FAIL: %s array of %u", typeName, count);
+  return result;
+}
+
+// every length up to a few vectors, to cover the tails, then longer ones
+template<typename T>
+static bool TestType(const char* typeName)
+{
+  PODArray<T> array;
+  bool result = true;
+  for (uint32 count = 0; count <= 70 && result; count++)
+  {
+    FillValues(array, count, count);
+    result = CheckArray(array, typeName);
+  }
+
+  for (uint32 count : {1000u, 4099u})
+  {
+    FillValues(array, count, count);
+    result = result && CheckArray(array, typeName);
+  }
+
+  if (result)
+    Log_InfoPrintf("PASS: %s", typeName);
+  else
+    Log_ErrorPrintf("FAIL: %s", typeName);
+  return result;
+}
+
+// NaN compares false with everything but "not equal", and min/max pass over it
+template<typename T>
+static bool TestNaN(const char* typeName)
+{
+  const T nan = std::numeric_limits<T>::quiet_NaN();
+  const T infinity = std::numeric_limits<T>::infinity();
+  PODArray<T> array;
+  for (uint32 i = 0; i < 37; i++)
+    array.Add(nan);
+
+  T minValue, maxValue;
+  bool result = Y_array_find(array, nan) == -1 && Y_array_count(array, Y_ARRAY_COMPARE_EQUAL, nan) == 0 &&
+                Y_array_count(array, Y_ARRAY_COMPARE_NOT_EQUAL, nan) == 37 &&
+                Y_array_count(array, Y_ARRAY_COMPARE_NOT_EQUAL, (T)1) == 37 &&
+                Y_array_count(array, Y_ARRAY_COMPARE_LESS_EQUAL, infinity) == 0 &&
+                !Y_array_minmax(array, &minValue, &maxValue);
+
+  array[3] = infinity;
+  array[20] = (T)-2;
+  array[36] = -infinity;
+  result = result && Y_array_minmax(array, &minValue, &maxValue) && minValue == -infinity && maxValue == infinity &&
+           Y_array_find(array, (T)-2) == 20 && Y_array_count(array, Y_ARRAY_COMPARE_GREATER, (T)-2) == 1;
+
+  if (result)
+    Log_InfoPrintf("PASS: %s NaN", typeName);
+  else
+    Log_ErrorPrintf("FAIL: %s NaN", typeName);
+  return result;
+}
+
+// against the serial versions, with a pool and without
+template<typename T>
+static bool TestParallelType(ThreadPool* pThreadPool, const char* typeName)
+{
+  const uint32 count = 1000003;
+  PODArray<T> array;
+  FillValues(array, count, 7);
+
+  const T* pValues;
+  uint32 valueCount;
+  GetTestValues(&pValues, &valueCount);
+  T needle = (T)42;
+  array[count - 5] = needle;
+  array[700001] = needle;
+
+  PODArray<T> serial;
+  PODArray<T> parallel;
+  serial.Resize(count);
+  parallel.Resize(count);
+  uint32 keptCount = Y_array_filter(serial.GetBasePointer(), array.GetBasePointer(), count,
+                                    Y_ARRAY_COMPARE_GREATER, pValues[2]);
+  T minValue, maxValue, parallelMin, parallelMax;
+  Y_array_minmax(array, &minValue, &maxValue);
+
+  bool result = Y_parallel_array_find(pThreadPool, array.GetBasePointer(), count, needle) == 700001 &&
+                Y_parallel_array_find(pThreadPool, array.GetBasePointer(), count, (T)43) == -1 &&
+                Y_parallel_array_count(pThreadPool, array.GetBasePointer(), count, Y_ARRAY_COMPARE_LESS, pValues[3]) ==
+                  Y_array_count(array, Y_ARRAY_COMPARE_LESS, pValues[3]) &&
+                Y_parallel_array_minmax(pThreadPool, array.GetBasePointer(), count, &parallelMin, &parallelMax) &&
+                parallelMin == minValue && parallelMax == maxValue &&
+                Y_parallel_array_sum(pThreadPool, array.GetBasePointer(), count) == Y_array_sum(array) &&
+                Y_parallel_array_filter(pThreadPool, parallel.GetBasePointer(), array.GetBasePointer(), count,
+                                        Y_ARRAY_COMPARE_GREATER, pValues[2]) == keptCount &&
+                SameValues(parallel.GetBasePointer(), serial.GetBasePointer(), keptCount);
+
+  T total = Y_array_prefix_sum(serial.GetBasePointer(), array.GetBasePointer(), count, (T)1);
+  result = result &&
+           Y_parallel_array_prefix_sum(pThreadPool, parallel.GetBasePointer(), array.GetBasePointer(), count, (T)1) ==
+             total &&
+           SameValues(parallel.GetBasePointer(), serial.GetBasePointer(), count);
+
+  if (result)
+    Log_InfoPrintf("PASS: parallel %s%s", typeName, (pThreadPool != nullptr) ? "" : " without a pool");
+  else
+    Log_ErrorPrintf("FAIL: parallel %s%s", typeName, (pThreadPool != nullptr) ? "" : " without a pool");
+  return result;
+}
+
+// the slot found holds the same position in the sorted order as std::lower_bound finds, which a payload rearranged
+// alongside the keys says
+static bool TestEytzinger()
+{
+  bool result = true;
+  PODArray<int32> sorted;
+  PODArray<int32> layout;
+  PODArray<uint32> positions;
+  PODArray<uint32> positionLayout;
+  for (uint32 count = 0; count <= 300 && result; count = (count < 70) ? (count + 1) : (count * 3))
+  {
+    sorted.Resize(count);
+    positions.Resize(count);
+    for (uint32 i = 0; i < count; i++)
+    {
+      sorted[i] = (int32)(i / 3) * 2;
+      positions[i] = i;
+    }
+
+    layout.Resize(count);
+    positionLayout.Resize(count);
+    Y_eytzinger_layout(layout.GetBasePointer(), sorted.GetBasePointer(), count);
+    Y_eytzinger_layout(positionLayout.GetBasePointer(), positions.GetBasePointer(), count);
+    for (int32 value = -1; value <= (int32)count + 1 && result; value++)
+    {
+      uint32 expected = 0;
+      while (expected < count && sorted[expected] < value)
+        expected++;
+
+      uint32 slot = Y_eytzinger_lower_bound(layout.GetBasePointer(), count, value);
+      result = (expected == count) ? (slot == count) : (slot < count && positionLayout[slot] == expected);
+    }
+  }
+
+  // descending, with the comparator giving the order
+  int32 descending[] = {90, 70, 70, 50, 30, 10, 10};
+  int32 descendingLayout[countof(descending)];
+  Y_eytzinger_layout(descendingLayout, descending, countof(descending));
+  auto greater = [](int32 element, int32 value) { return element > value; };
+  result = result && descendingLayout[Y_eytzinger_lower_bound(descendingLayout, 7u, 70, greater)] == 70 &&
+           descendingLayout[Y_eytzinger_lower_bound(descendingLayout, 7u, 60, greater)] == 50 &&
+           Y_eytzinger_lower_bound(descendingLayout, 7u, 5, greater) == 7;
+
+  if (result)
+    Log_InfoPrint("PASS: eytzinger");
+  else
+    Log_ErrorPrint("FAIL: eytzinger");
+  return result;
+}
+
+DEFINE_TEST_SUITE(ArrayAlgorithms)
+{
+  bool result = true;
+  result &= TestType<int32>("int32");
+  result &= TestType<uint32>("uint32");
+  result &= TestType<int64>("int64");
+  result &= TestType<uint64>("uint64");
+  result &= TestType<float>("float");
+  result &= TestType<double>("double");
+  result &= TestNaN<float>("float");
+  result &= TestNaN<double>("double");
+
+  ThreadPool threadPool(3);
+  result &= TestParallelType<int32>(&threadPool, "int32");
+  result &= TestParallelType<uint64>(&threadPool, "uint64");
+  result &= TestParallelType<float>(&threadPool, "float");
+  result &= TestParallelType<double>(nullptr, "double");
+
+  result &= TestEytzinger();
+  return result;
+}
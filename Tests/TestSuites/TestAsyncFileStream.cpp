@@ -0,0 +1,288 @@
+#include "TestSuite.h"
+#include "YBaseLib/AsyncFileStream.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/TaskQueue.h"
+#include "YBaseLib/Timer.h"
+#include <cstring>
+Log_SetChannel(TestAsyncFileStream);
+
+static const char s_testFileName[] = "TestAsyncFileStream.tmp";
+static const uint32 s_fileSize = 1024 * 1024 + 123;
+
+static byte ExpectedByte(uint64 offset)
+{
+  return byte((offset * 131) ^ (offset >> 9));
+}
+
+static bool WriteTestFile()
+{
+  ByteStream* pStream;
+  if (!ByteStream_OpenFileStream(s_testFileName,
+                                 BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_TRUNCATE, &pStream))
+  {
+    return false;
+  }
+
+  byte* pData = new byte[s_fileSize];
+  for (uint32 i = 0; i < s_fileSize; i++)
+    pData[i] = ExpectedByte(i);
+
+  bool result = pStream->Write2(pData, s_fileSize);
+  pStream->Release();
+  delete[] pData;
+  return result;
+}
+
+static bool CheckContents(const AsyncFileRequest& request, uint32 expectedSize)
+{
+  if (!request.IsComplete() || !request.Succeeded || request.BytesTransferred != expectedSize)
+    return false;
+
+  const byte* pBuffer = reinterpret_cast<const byte*>(request.pBuffer);
+  for (uint32 i = 0; i < expectedSize; i++)
+  {
+    if (pBuffer[i] != ExpectedByte(request.Offset + i))
+      return false;
+  }
+
+  return true;
+}
+
+static Y_ATOMIC_DECL uint32 s_callbackCount = 0;
+
+static void CountingCallback(AsyncFileRequest* pRequest)
+{
+  Y_AtomicIncrement(s_callbackCount);
+}
+
+// reads the file chunk by chunk, submitting the next read from the callback of the previous one
+static void ChainedReadCallback(AsyncFileRequest* pRequest)
+{
+  uint32* pChunksRead = reinterpret_cast<uint32*>(pRequest->pUserData);
+  if (!pRequest->Succeeded || pRequest->BytesTransferred == 0)
+    return;
+
+  (*pChunksRead)++;
+  pRequest->Offset += pRequest->BytesTransferred;
+  pRequest->GetStream()->Submit(pRequest);
+}
+
+static bool TestReads(uint32 queueDepth, TaskQueue* pCompletionQueue)
+{
+  AsyncFileQueue queue;
+  if (!queue.Initialize(queueDepth, pCompletionQueue))
+  {
+    Log_ErrorPrint("FAIL: initializing the queue");
+    return false;
+  }
+
+  AsyncFileStream* pStream;
+  if (!queue.OpenFile(s_testFileName, BYTESTREAM_OPEN_READ, &pStream) || pStream->GetSize() != s_fileSize)
+  {
+    Log_ErrorPrint("FAIL: opening the file");
+    return false;
+  }
+
+  // many more reads than the queue is deep, spread over the file, in one batch
+  const uint32 requestCount = 256;
+  const uint32 requestSize = 4000;
+  byte* pBuffers = new byte[requestCount * requestSize];
+  AsyncFileRequest requests[requestCount];
+  AsyncFileRequest* pRequests[requestCount];
+  for (uint32 i = 0; i < requestCount; i++)
+  {
+    requests[i].pBuffer = pBuffers + i * requestSize;
+    requests[i].Offset = (uint64(i) * 7919 * requestSize) % (s_fileSize - requestSize);
+    requests[i].Size = requestSize;
+    requests[i].Callback = CountingCallback;
+    pRequests[i] = &requests[i];
+  }
+
+  s_callbackCount = 0;
+  bool result = pStream->Submit(pRequests, requestCount);
+
+  // reads reaching past the end stop there, ones starting past it transfer nothing
+  byte tailBuffer[256];
+  AsyncFileRequest tailRequest;
+  tailRequest.pBuffer = tailBuffer;
+  tailRequest.Offset = s_fileSize - 100;
+  tailRequest.Size = sizeof(tailBuffer);
+  AsyncFileRequest pastEndRequest;
+  pastEndRequest.pBuffer = tailBuffer + 128;
+  pastEndRequest.Offset = s_fileSize + 4096;
+  pastEndRequest.Size = 16;
+  result = result && pStream->Submit(&pastEndRequest) && pStream->Submit(&tailRequest);
+
+  // the stream stays alive until its requests are done
+  pStream->Release();
+  queue.WaitForIdle();
+
+  result = result && (s_callbackCount == requestCount) && queue.GetPendingCount() == 0 &&
+           CheckContents(tailRequest, 100) && pastEndRequest.IsComplete() && pastEndRequest.BytesTransferred == 0;
+  for (uint32 i = 0; i < requestCount && result; i++)
+    result = CheckContents(requests[i], requestSize);
+
+  delete[] pBuffers;
+  if (!result)
+  {
+    Log_ErrorPrintf("FAIL: batched reads with a queue depth of %u", queueDepth);
+    return false;
+  }
+
+  queue.Shutdown();
+  return true;
+}
+
+static bool TestChainedReadsAndWrites()
+{
+  const char writtenFileName[] = "TestAsyncFileStreamWrite.tmp";
+  AsyncFileQueue queue;
+  AsyncFileStream* pStream;
+  if (!queue.Initialize(16) || !queue.OpenFile(s_testFileName, BYTESTREAM_OPEN_READ, &pStream))
+    return false;
+
+  // one request walking the whole file
+  static byte chunk[65536];
+  uint32 chunksRead = 0;
+  AsyncFileRequest request;
+  request.pBuffer = chunk;
+  request.Size = sizeof(chunk);
+  request.Callback = ChainedReadCallback;
+  request.pUserData = &chunksRead;
+  bool result = pStream->Submit(&request);
+  queue.WaitForIdle();
+  pStream->Release();
+  result = result && (chunksRead == (s_fileSize + sizeof(chunk) - 1) / sizeof(chunk)) && request.Succeeded &&
+           request.Offset == s_fileSize;
+
+  // writes at scattered offsets land where they were asked to
+  if (result && queue.OpenFile(writtenFileName,
+                               BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_TRUNCATE, &pStream))
+  {
+    byte blocks[8][1024];
+    AsyncFileRequest writes[countof(blocks)];
+    AsyncFileRequest* pWrites[countof(blocks)];
+    for (uint32 i = 0; i < countof(blocks); i++)
+    {
+      uint32 blockIndex = (i * 5) % countof(blocks);
+      for (uint32 j = 0; j < sizeof(blocks[i]); j++)
+        blocks[i][j] = ExpectedByte(blockIndex * sizeof(blocks[i]) + j);
+
+      writes[i].Type = AsyncFileRequest::TYPE_WRITE;
+      writes[i].pBuffer = blocks[i];
+      writes[i].Offset = blockIndex * sizeof(blocks[i]);
+      writes[i].Size = sizeof(blocks[i]);
+      pWrites[i] = &writes[i];
+    }
+
+    result = pStream->Submit(pWrites, countof(writes));
+    queue.WaitForIdle();
+    result = result && pStream->GetSize() == sizeof(blocks);
+    for (uint32 i = 0; i < countof(writes); i++)
+      result = result && writes[i].Succeeded && writes[i].BytesTransferred == sizeof(blocks[i]);
+    pStream->Release();
+
+    ByteStream* pReadStream;
+    if (result && ByteStream_OpenFileStream(writtenFileName, BYTESTREAM_OPEN_READ, &pReadStream))
+    {
+      byte contents[sizeof(blocks)];
+      result = pReadStream->Read2(contents, sizeof(contents));
+      for (uint32 i = 0; i < sizeof(contents) && result; i++)
+        result = (contents[i] == ExpectedByte(i));
+      pReadStream->Release();
+    }
+    else
+    {
+      result = false;
+    }
+
+    FileSystem::DeleteFile(writtenFileName);
+  }
+  else
+  {
+    result = false;
+  }
+
+  // nothing goes in once the queue is shut down
+  queue.Shutdown();
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: chained reads and writes");
+    return false;
+  }
+
+  return true;
+}
+
+DEFINE_TEST_SUITE(AsyncFileStream)
+{
+  if (!WriteTestFile())
+    return false;
+
+  static const char* backendNames[] = {"none", "io_uring", "IOCP", "threads"};
+  AsyncFileQueue queue;
+  if (queue.Initialize())
+    Log_InfoPrintf("Using the %s backend", backendNames[queue.GetBackend()]);
+  queue.Shutdown();
+
+  TaskQueue completionQueue;
+  bool result = completionQueue.Initialize(TaskQueue::DefaultQueueSize, 2) && TestReads(8, nullptr) &&
+                TestReads(128, nullptr) && TestReads(32, &completionQueue) && TestChainedReadsAndWrites();
+  if (result)
+    Log_InfoPrint("PASS: reads and writes");
+
+  // the same scattered reads one at a time with a blocking stream, and all in flight at once
+  if (result)
+  {
+    const uint32 requestCount = 512;
+    const uint32 requestSize = 2048;
+    byte* pBuffers = new byte[requestCount * requestSize];
+    Timer timer;
+    ByteStream* pBlockingStream;
+    if (ByteStream_OpenFileStream(s_testFileName, BYTESTREAM_OPEN_READ, &pBlockingStream))
+    {
+      for (uint32 i = 0; i < requestCount; i++)
+      {
+        pBlockingStream->SeekAbsolute((uint64(i) * 104729) % (s_fileSize - requestSize));
+        pBlockingStream->Read2(pBuffers + i * requestSize, requestSize);
+      }
+      pBlockingStream->Release();
+    }
+    double blockingTime = timer.GetTimeMilliseconds();
+
+    AsyncFileRequest* pRequests = new AsyncFileRequest[requestCount];
+    AsyncFileRequest** ppRequests = new AsyncFileRequest*[requestCount];
+    for (uint32 i = 0; i < requestCount; i++)
+    {
+      pRequests[i].pBuffer = pBuffers + i * requestSize;
+      pRequests[i].Offset = (uint64(i) * 104729) % (s_fileSize - requestSize);
+      pRequests[i].Size = requestSize;
+      ppRequests[i] = &pRequests[i];
+    }
+
+    timer.Reset();
+    AsyncFileQueue timedQueue;
+    AsyncFileStream* pStream;
+    if (timedQueue.Initialize() && timedQueue.OpenFile(s_testFileName, BYTESTREAM_OPEN_READ, &pStream))
+    {
+      result = pStream->Submit(ppRequests, requestCount);
+      timedQueue.WaitForIdle();
+      pStream->Release();
+      for (uint32 i = 0; i < requestCount && result; i++)
+        result = CheckContents(pRequests[i], requestSize);
+    }
+    double asyncTime = timer.GetTimeMilliseconds();
+
+    Log_InfoPrintf("%u reads of %u bytes: blocking %.2fms, async %.2fms", requestCount, requestSize, blockingTime,
+                   asyncTime);
+    delete[] ppRequests;
+    delete[] pRequests;
+    delete[] pBuffers;
+  }
+
+  completionQueue.ExitWorkers();
+  FileSystem::DeleteFile(s_testFileName);
+  return result;
+}
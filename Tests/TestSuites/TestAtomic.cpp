@@ -0,0 +1,106 @@
+#include "TestSuite.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(TestAtomic);
+
+// each operation's result, at every width
+template<typename T>
+static bool TestOperations()
+{
+  Atomic<T> value(T(12));
+  bool result = value.FetchAdd(T(3)) == T(12) && value.Load() == T(15) && value.FetchSub(T(5)) == T(15) &&
+                value.FetchOr(T(0x21), ATOMIC_MEMORY_ORDER_RELAXED) == T(10) && value.FetchAnd(T(0x0F)) == T(0x2B) &&
+                value.FetchXor(T(0x05), ATOMIC_MEMORY_ORDER_ACQ_REL) == T(0x0B) && value.Load() == T(0x0E);
+
+  // min and max leave the value alone when it's already past them
+  result = result && value.FetchMin(T(20)) == T(14) && value.FetchMin(T(9)) == T(14) &&
+           value.FetchMax(T(3)) == T(9) && value.FetchMax(T(100), ATOMIC_MEMORY_ORDER_RELEASE) == T(9) &&
+           value.Load(ATOMIC_MEMORY_ORDER_RELAXED) == T(100);
+
+  T expected = T(99);
+  result = result && !value.CompareExchange(expected, T(1)) && expected == T(100) &&
+           value.CompareExchange(expected, T(1), ATOMIC_MEMORY_ORDER_ACQUIRE) && value.Exchange(T(7)) == T(1) &&
+           value.Increment() == T(8) && value.Decrement(ATOMIC_MEMORY_ORDER_RELAXED) == T(7);
+
+  // signed min and max compare as signed, and the old forms return the value after
+  volatile T raw = T(5);
+  result = result && Y_AtomicAdd(raw, T(2)) == T(7) && Y_AtomicAnd(raw, T(3)) == T(3) &&
+           Y_AtomicCompareExchange(raw, T(9), T(3)) == T(3) && Y_AtomicCompareExchange(raw, T(1), T(3)) == T(9);
+  if (T(-1) < T(0))
+    result = result && Y_AtomicFetchMin(raw, T(-4)) == T(9) && Y_AtomicFetchMax(raw, T(-8)) == T(-4) && raw == T(-4);
+
+  value.Store(T(0), ATOMIC_MEMORY_ORDER_RELEASE);
+  return result && value.Load(ATOMIC_MEMORY_ORDER_ACQUIRE) == T(0);
+}
+
+// Adds to a shared counter, and raises a shared maximum, with the weakest orderings that work.
+class CounterThread : public Thread
+{
+public:
+  static const uint32 Iterations = 100000;
+
+  CounterThread() : m_pCounter(nullptr), m_pMaximum(nullptr), m_base(0) {}
+
+  void SetCounters(Atomic<uint32>* pCounter, Atomic<uint64>* pMaximum, uint64 base)
+  {
+    m_pCounter = pCounter;
+    m_pMaximum = pMaximum;
+    m_base = base;
+  }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    for (uint32 i = 0; i < Iterations; i++)
+    {
+      m_pCounter->FetchAdd(1, ATOMIC_MEMORY_ORDER_RELAXED);
+      m_pMaximum->FetchMax(m_base + i, ATOMIC_MEMORY_ORDER_RELAXED);
+    }
+
+    return 0;
+  }
+
+private:
+  Atomic<uint32>* m_pCounter;
+  Atomic<uint64>* m_pMaximum;
+  uint64 m_base;
+};
+
+// no increment or maximum is lost between threads
+static bool TestContention()
+{
+  static const uint32 ThreadCount = 4;
+
+  Atomic<uint32> counter;
+  Atomic<uint64> maximum;
+  CounterThread threads[ThreadCount];
+  for (uint32 i = 0; i < ThreadCount; i++)
+  {
+    threads[i].SetCounters(&counter, &maximum, uint64(i) << 32);
+    threads[i].Start();
+  }
+  for (uint32 i = 0; i < ThreadCount; i++)
+    threads[i].Join();
+
+  bool result = counter.Load() == ThreadCount * CounterThread::Iterations &&
+                maximum.Load() == ((uint64(ThreadCount - 1) << 32) + CounterThread::Iterations - 1);
+  if (result)
+    Log_InfoPrint("PASS: contention");
+  else
+    Log_ErrorPrintf("FAIL: contention, counted %u", counter.Load());
+  return result;
+}
+
+DEFINE_TEST_SUITE(Atomic)
+{
+  bool result = TestOperations<int8>() && TestOperations<uint8>() && TestOperations<int16>() &&
+                TestOperations<uint16>() && TestOperations<int32>() && TestOperations<uint32>() &&
+                TestOperations<int64>() && TestOperations<uint64>();
+  if (result)
+    Log_InfoPrint("PASS: operations");
+  else
+    Log_ErrorPrint("FAIL: operations");
+
+  return result && TestContention();
+}
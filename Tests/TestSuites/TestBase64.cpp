@@ -1,6 +1,10 @@
 #include "TestSuite.h"
+#include "YBaseLib/Base64.h"
+#include "YBaseLib/ByteStream.h"
 #include "YBaseLib/CString.h"
 #include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include <cstring>
 Log_SetChannel(TestBase64);
 
 static bool TestBase64Encode(const char* inputHexBytes, const char* expectedOutput)
@@ -46,6 +50,164 @@ static bool TestBase64Decode(const char* pInputData, const char* expectedOutputH
   return result;
 }
 
+// a byte at a time, to check the vector versions against
+static void ReferenceEncode(String& text, const byte* pData, uint32 length, const char* pTable)
+{
+  text.Clear();
+  for (uint32 i = 0; i < length; i += 3)
+  {
+    uint32 value = uint32(pData[i]) << 16;
+    if (i + 1 < length)
+      value |= uint32(pData[i + 1]) << 8;
+    if (i + 2 < length)
+      value |= uint32(pData[i + 2]);
+
+    text.AppendCharacter(pTable[(value >> 18) & 63]);
+    text.AppendCharacter(pTable[(value >> 12) & 63]);
+    text.AppendCharacter((i + 1 < length) ? pTable[(value >> 6) & 63] : '=');
+    text.AppendCharacter((i + 2 < length) ? pTable[value & 63] : '=');
+  }
+}
+
+static bool DecodesTo(const char* pText, const byte* pExpected, uint32 expectedLength)
+{
+  byte buffer[1024];
+  uint32 length;
+  return Base64::Decode(buffer, sizeof(buffer), pText, Y_strlen(pText), &length) && length == expectedLength &&
+         std::memcmp(buffer, pExpected, length) == 0;
+}
+
+// every length either side of the vector widths, in both alphabets, with and without padding
+static bool TestLengths()
+{
+  static const char* tables[BASE64_ALPHABET_COUNT] = {
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_",
+  };
+
+  byte data[300];
+  uint32 seed = 12345;
+  for (uint32 i = 0; i < countof(data); i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    data[i] = byte(seed >> 16);
+  }
+
+  String expected, text;
+  byte decoded[countof(data)];
+  for (uint32 alphabet = 0; alphabet < BASE64_ALPHABET_COUNT; alphabet++)
+  {
+    for (uint32 length = 0; length <= countof(data); length++)
+    {
+      ReferenceEncode(expected, data, length, tables[alphabet]);
+      Base64::Encode(text, data, length, BASE64_ALPHABET(alphabet));
+
+      uint32 decodedLength;
+      bool result = text.Compare(expected) &&
+                    Base64::Decode(decoded, length, text.GetCharArray(), text.GetLength(), &decodedLength) &&
+                    decodedLength == length && std::memcmp(decoded, data, length) == 0;
+
+      // and without the padding
+      while (expected.GetLength() > 0 && expected[expected.GetLength() - 1] == '=')
+        expected.Erase(-1);
+      Base64::Encode(text, data, length, BASE64_ALPHABET(alphabet), false);
+      result = result && text.Compare(expected) && text.GetLength() == Base64::GetEncodedLength(length, false) &&
+               Base64::Decode(decoded, length, text.GetCharArray(), text.GetLength(), &decodedLength) &&
+               decodedLength == length && std::memcmp(decoded, data, length) == 0;
+      if (!result)
+      {
+        Log_ErrorPrintf("FAIL: alphabet %u length %u", alphabet, length);
+        return false;
+      }
+    }
+  }
+
+  Log_InfoPrint("PASS: lengths");
+  return true;
+}
+
+static bool TestInvalid()
+{
+  static const byte bytes[] = {0xFB, 0xFF, 0xBF};
+  static const char* invalid[] = {"A", "AB=", "AB===", "A===", "=", "AB=C", "AB!C", "ABC=ABCD",
+                                  "ABCDABCDABCDABCDABCDABCDABCDABCDABCDAB\x80" "D"};
+
+  // either alphabet and no padding decode, but nothing that isn't base64
+  bool result = DecodesTo("+/+/", bytes, 3) && DecodesTo("-_-_", bytes, 3) && DecodesTo("+_", bytes, 1) &&
+                DecodesTo("+_8", bytes, 2) && DecodesTo("+_8=", bytes, 2) && DecodesTo("", bytes, 0);
+  for (uint32 i = 0; result && i < countof(invalid); i++)
+  {
+    byte buffer[64];
+    uint32 length;
+    if (Base64::Decode(buffer, sizeof(buffer), invalid[i], Y_strlen(invalid[i]), &length))
+    {
+      Log_ErrorPrintf("FAIL: invalid '%s' decoded", invalid[i]);
+      result = false;
+    }
+  }
+
+  // too big for the destination
+  byte small[2];
+  uint32 length;
+  result = result && !Base64::Decode(small, sizeof(small), "+/+/", 4, &length);
+  if (result)
+    Log_InfoPrint("PASS: invalid");
+  return result;
+}
+
+// pieces of every size go through the streams, with whitespace in the text
+static bool TestStreaming()
+{
+  byte data[5000];
+  for (uint32 i = 0; i < countof(data); i++)
+    data[i] = byte(i * 7 + (i >> 8));
+
+  String expected;
+  Base64::Encode(expected, data, sizeof(data), BASE64_ALPHABET_URL_SAFE);
+
+  GrowableMemoryByteStream* pTextStream = ByteStream_CreateGrowableMemoryStream();
+  Base64Encoder encoder(pTextStream, BASE64_ALPHABET_URL_SAFE);
+  bool result = true;
+  for (uint32 i = 0, pieceLength = 0; i < countof(data); i += pieceLength)
+  {
+    pieceLength = Min((i % 13) + 1, uint32(countof(data)) - i);
+    result = result && encoder.Write(data + i, pieceLength);
+  }
+  result = result && encoder.Finish() && pTextStream->GetSize() == expected.GetLength() &&
+           std::memcmp(pTextStream->GetMemoryPointer(), expected.GetCharArray(), expected.GetLength()) == 0;
+
+  // wrapped like MIME text
+  String wrapped;
+  for (uint32 i = 0; i < expected.GetLength(); i += 76)
+  {
+    wrapped.AppendSubString(expected, i, 76);
+    wrapped.AppendString("\r\n");
+  }
+
+  GrowableMemoryByteStream* pDataStream = ByteStream_CreateGrowableMemoryStream();
+  Base64Decoder decoder(pDataStream);
+  for (uint32 i = 0, pieceLength = 0; i < wrapped.GetLength(); i += pieceLength)
+  {
+    pieceLength = Min((i % 1500) + 1, wrapped.GetLength() - i);
+    result = result && decoder.Write(wrapped.GetCharArray() + i, pieceLength);
+  }
+  result = result && decoder.Finish() && pDataStream->GetSize() == sizeof(data) &&
+           std::memcmp(pDataStream->GetMemoryPointer(), data, sizeof(data)) == 0;
+
+  // and bad text stops the decoder
+  Base64Decoder badDecoder(pDataStream);
+  result = result && badDecoder.Write("QUJD", 4) && badDecoder.Write("QQ=", 3) && !badDecoder.Write("Q", 1) &&
+           !badDecoder.Finish();
+
+  pDataStream->Release();
+  pTextStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: streaming");
+  else
+    Log_ErrorPrint("FAIL: streaming");
+  return result;
+}
+
 DEFINE_TEST_SUITE(Base64)
 {
   struct TestCase
@@ -84,5 +246,5 @@ DEFINE_TEST_SUITE(Base64)
       result = false;
   }
 
-  return result;
+  return result && TestLengths() && TestInvalid() && TestStreaming();
 }
@@ -0,0 +1,134 @@
+#include "TestSuite.h"
+#include "YBaseLib/BinaryBlob.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Memory.h"
+#include <cstring>
+Log_SetChannel(TestBinaryBlob);
+
+static bool TestPooled()
+{
+  // a released block is handed straight back out for the same size class
+  BinaryBlob* pBlob = BinaryBlob::Allocate(100);
+  byte* pData = pBlob->GetDataPointer();
+  bool result = (pBlob->GetDataSize() == 100 && (reinterpret_cast<size_t>(pData) & 15) == 0);
+  std::memset(pData, 0xAB, 100);
+  pBlob->Release();
+
+  pBlob = BinaryBlob::Allocate(200);
+  result = result && pBlob->GetDataPointer() == pData && pBlob->GetDataSize() == 200;
+  pBlob->Release();
+
+  // the largest pooled size, and one past it from the heap
+  for (size_t size : {size_t(0), size_t(1), size_t(4096), BinaryBlob::MaxPooledSize, BinaryBlob::MaxPooledSize + 1})
+  {
+    pBlob = BinaryBlob::Allocate(size);
+    result = result && pBlob->GetDataSize() == size;
+    if (size > 0)
+    {
+      std::memset(pBlob->GetDataPointer(), 0xCD, size);
+      result = result && pBlob->GetDataPointer()[size - 1] == 0xCD;
+    }
+    pBlob->Release();
+  }
+
+  // pooled blobs copy out when detached, heap blobs give up their buffer
+  static const char contents[] = "pooled blob contents";
+  for (size_t size : {sizeof(contents), BinaryBlob::MaxPooledSize * 2})
+  {
+    pBlob = BinaryBlob::Allocate(size);
+    std::memset(pBlob->GetDataPointer(), 0, size);
+    std::memcpy(pBlob->GetDataPointer(), contents, sizeof(contents));
+
+    void* pMemory;
+    size_t memorySize;
+    pBlob->DetachMemory(&pMemory, &memorySize);
+    pBlob->Release();
+    result = result && memorySize == size && std::memcmp(pMemory, contents, sizeof(contents)) == 0;
+    Y_free(pMemory);
+  }
+
+  if (result)
+    Log_InfoPrint("PASS: pooled blobs");
+  else
+    Log_ErrorPrint("FAIL: pooled blobs");
+  return result;
+}
+
+static bool TestViews()
+{
+  BinaryBlob* pBlob = BinaryBlob::Allocate(1000);
+  for (uint32 i = 0; i < 1000; i++)
+    pBlob->GetDataPointer()[i] = byte(i);
+
+  // views share the data and keep it alive after the blob is released
+  BinaryBlob* pView = pBlob->CreateView(100, 50);
+  BinaryBlob* pInnerView = pView->CreateView(10, 5);
+  bool result = (pView->GetDataPointer() == pBlob->GetDataPointer() + 100 && pView->GetDataSize() == 50 &&
+                 pInnerView->GetDataPointer() == pBlob->GetDataPointer() + 110 && pInnerView->GetDataSize() == 5);
+  pBlob->GetDataPointer()[110] = 0xEE;
+  pBlob->Release();
+  pView->Release();
+  result = result && pInnerView->GetDataPointer()[0] == 0xEE && pInnerView->GetDataPointer()[4] == 114;
+
+  ByteStream* pStream = pInnerView->CreateReadOnlyStream();
+  pInnerView->Release();
+  byte contents[5];
+  result = result && pStream->Read(contents, 5) == 5 && contents[1] == 111;
+  pStream->Release();
+
+  if (result)
+    Log_InfoPrint("PASS: blob views");
+  else
+    Log_ErrorPrint("FAIL: blob views");
+  return result;
+}
+
+static bool TestMappedStream()
+{
+  static const char contents[] = "0123456789abcdef";
+  ReadOnlyMemoryByteStream* pStream = ByteStream_CreateReadOnlyMemoryStream(contents, sizeof(contents) - 1);
+  pStream->SeekAbsolute(3);
+
+  // memory streams are referenced in place
+  BinaryBlob* pBlob = BinaryBlob::CreateFromMappedStream(pStream, 4, 8);
+  BinaryBlob* pRest = BinaryBlob::CreateFromMappedStream(pStream, 10);
+  bool result = (pBlob != nullptr && pBlob->GetDataPointer() == reinterpret_cast<const byte*>(contents) + 4 &&
+                 pBlob->GetDataSize() == 8 && pRest != nullptr && pRest->GetDataSize() == 6 &&
+                 std::memcmp(pRest->GetDataPointer(), "abcdef", 6) == 0 && pStream->GetPosition() == 3);
+  result = result && BinaryBlob::CreateFromMappedStream(pStream, 17) == nullptr &&
+           BinaryBlob::CreateFromMappedStream(pStream, 8, 9) == nullptr;
+
+  // the blob holds on to the stream
+  pStream->Release();
+  result = result && pBlob != nullptr && std::memcmp(pBlob->GetDataPointer(), "456789ab", 8) == 0;
+  if (pBlob != nullptr)
+    pBlob->Release();
+  if (pRest != nullptr)
+    pRest->Release();
+
+  // streams that aren't in memory are copied
+  SegmentedMemoryByteStream* pSegmented = ByteStream_CreateSegmentedMemoryStream(4);
+  pSegmented->Write(contents, sizeof(contents) - 1);
+  pBlob = BinaryBlob::CreateFromMappedStream(pSegmented, 2, 12);
+  result = result && pBlob != nullptr && pBlob->GetDataSize() == 12 &&
+           std::memcmp(pBlob->GetDataPointer(), "23456789abcd", 12) == 0 && pSegmented->GetPosition() == 16;
+  if (pBlob != nullptr)
+    pBlob->Release();
+  pSegmented->Release();
+
+  if (result)
+    Log_InfoPrint("PASS: mapped stream blobs");
+  else
+    Log_ErrorPrint("FAIL: mapped stream blobs");
+  return result;
+}
+
+DEFINE_TEST_SUITE(BinaryBlob)
+{
+  bool result = true;
+  result &= TestPooled();
+  result &= TestViews();
+  result &= TestMappedStream();
+  return result;
+}
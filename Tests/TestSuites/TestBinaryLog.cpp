@@ -0,0 +1,215 @@
+#include "TestSuite.h"
+#include "YBaseLib/BinaryLog.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/Timer.h"
+#include <cstdarg>
+#include <cstring>
+Log_SetChannel(TestBinaryLog);
+
+static bool WritePrintf(BinaryLogWriter& writer, const char* format, ...)
+{
+  va_list ap;
+  va_start(ap, format);
+  bool result = writer.WritePrintf("TestChannel", "TestFunction", LOGLEVEL_PERF, format, ap);
+  va_end(ap);
+  return result;
+}
+
+static String FormatPrintf(const char* format, ...)
+{
+  va_list ap;
+  va_start(ap, format);
+  String result;
+  result.AppendFormattedStringVA(format, ap);
+  va_end(ap);
+  return result;
+}
+
+template<typename... Args>
+static bool WriteFormat(BinaryLogWriter& writer, const StringView& format, const Args&... args)
+{
+  const TypedFormat::Argument arguments[] = {TypedFormat::MakeArgument(args)..., TypedFormat::Argument()};
+  return writer.WriteFormatted("TestChannel", "TestFunction", LOGLEVEL_PROFILE, format, arguments, sizeof...(Args));
+}
+
+static bool ReadExpected(BinaryLogReader& reader, const char* expected)
+{
+  BinaryLogReader::Message message;
+  if (!reader.ReadMessage(&message))
+  {
+    Log_ErrorPrintf("FAIL: reading back '%s'", expected);
+    return false;
+  }
+  if (!message.Text.Compare(expected) || !message.ChannelName.Compare("TestChannel") ||
+      !message.FunctionName.Compare("TestFunction"))
+  {
+    Log_ErrorPrintf("FAIL: read back '%s' (%s, %s), expecting '%s'", message.Text.GetCharArray(),
+                    message.ChannelName.GetCharArray(), message.FunctionName.GetCharArray(), expected);
+    return false;
+  }
+
+  return true;
+}
+
+// each message reads back as the C library formats it
+static bool TestPrintfMessages()
+{
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  BinaryLogWriter* pWriter = new BinaryLogWriter(pStream, Y_TimerGetValue());
+
+  int value = -42;
+  String expected[9];
+  bool result = WritePrintf(*pWriter, "plain text, 100%% literal") &&
+                WritePrintf(*pWriter, "%d %u %x %X %o", -1234, 4000000000u, 0xbeefu, 0xcafeu, 8u) &&
+                WritePrintf(*pWriter, "[%5d] [%-5d] [%05d] [%+d]", 42, 42, 42, 42) &&
+                WritePrintf(*pWriter, "%hhd %hd %ld %lld %zu %llx", 300, 70000, -5L, -1234567890123LL, (size_t)77,
+                            0x1234567890ULL) &&
+                WritePrintf(*pWriter, "%f %.2f %10.3e %g", 1.5, 3.14159, 12345.678, 0.0001) &&
+                WritePrintf(*pWriter, "[%s] [%8s] [%-8s] [%.3s] [%c]", "abc", "right", "left", "truncated", 'z') &&
+                WritePrintf(*pWriter, "[%*d] [%-*d] [%.*f] [%.*f]", 6, 1, 6, 2, 1, 2.25, -1, 0.5) &&
+                WritePrintf(*pWriter, "%s", (const char*)nullptr) && WritePrintf(*pWriter, "%p", &value);
+  expected[0] = FormatPrintf("plain text, 100%% literal");
+  expected[1] = FormatPrintf("%d %u %x %X %o", -1234, 4000000000u, 0xbeefu, 0xcafeu, 8u);
+  expected[2] = FormatPrintf("[%5d] [%-5d] [%05d] [%+d]", 42, 42, 42, 42);
+  expected[3] = FormatPrintf("%hhd %hd %ld %lld %zu %llx", 300, 70000, -5L, -1234567890123LL, (size_t)77,
+                             0x1234567890ULL);
+  expected[4] = FormatPrintf("%f %.2f %10.3e %g", 1.5, 3.14159, 12345.678, 0.0001);
+  expected[5] = FormatPrintf("[%s] [%8s] [%-8s] [%.3s] [%c]", "abc", "right", "left", "truncated", 'z');
+  expected[6] = FormatPrintf("[%*d] [%-*d] [%.*f] [%.*f]", 6, 1, 6, 2, 1, 2.25, -1, 0.5);
+  expected[7] = "(null)";
+  expected[8] = FormatPrintf("%p", &value);
+
+  // conversions that can't be kept leave nothing in the stream
+  if (result && WritePrintf(*pWriter, "%d%n", 1, &value))
+  {
+    Log_ErrorPrint("FAIL: %n was captured");
+    result = false;
+  }
+
+  delete pWriter;
+  pStream->SeekAbsolute(0);
+  BinaryLogReader reader(pStream);
+  for (uint32 i = 0; result && i < countof(expected); i++)
+    result = ReadExpected(reader, expected[i]);
+
+  BinaryLogReader::Message message;
+  if (result && (reader.ReadMessage(&message) || reader.IsDamaged()))
+  {
+    Log_ErrorPrint("FAIL: binary log didn't end cleanly");
+    result = false;
+  }
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: printf messages");
+  return result;
+}
+
+// typed arguments, text messages, and strings changing under the same address
+static bool TestFormatAndTextMessages()
+{
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  BinaryLogWriter* pWriter = new BinaryLogWriter(pStream, Y_TimerGetValue());
+
+  char format[32];
+  Y_strncpy(format, countof(format), "first {}");
+  bool result = WriteFormat(*pWriter, "{} of {:>5} items, {:.1f}% {}", 3, 17u, 17.6470588, "done") &&
+                WriteFormat(*pWriter, "{} {} {:x} {:c}", true, -9, 255, 'q') &&
+                WriteFormat(*pWriter, StringView(format), 1) &&
+                pWriter->WriteText("TestChannel", "TestFunction", LOGLEVEL_PERF, "as it is", 8);
+  Y_strncpy(format, countof(format), "second {}");
+  result = result && WriteFormat(*pWriter, StringView(format), 2);
+
+  delete pWriter;
+  pStream->SeekAbsolute(0);
+  BinaryLogReader reader(pStream);
+  result = result && ReadExpected(reader, "3 of    17 items, 17.6% done") && ReadExpected(reader, "true -9 ff q") &&
+           ReadExpected(reader, "first 1") && ReadExpected(reader, "as it is") && ReadExpected(reader, "second 2");
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: typed and text messages");
+  return result;
+}
+
+// a log cut short reads up to the last whole message, and decodes to lines
+static bool TestDamagedAndDecode()
+{
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  BinaryLogWriter* pWriter = new BinaryLogWriter(pStream, Y_TimerGetValue());
+  bool result = WritePrintf(*pWriter, "message %d", 1) && WritePrintf(*pWriter, "message %d", 2);
+  delete pWriter;
+
+  ByteStream* pCutStream =
+    ByteStream_CreateReadOnlyMemoryStream(pStream->GetMemoryPointer(), (size_t)pStream->GetSize() - 1);
+  GrowableMemoryByteStream* pText = ByteStream_CreateGrowableMemoryStream();
+  if (result && BinaryLogReader::DecodeToText(pCutStream, pText))
+  {
+    Log_ErrorPrint("FAIL: damaged log decoded cleanly");
+    result = false;
+  }
+
+  String text;
+  text.AppendString(reinterpret_cast<const char*>(pText->GetMemoryPointer()), (uint32)pText->GetSize());
+  if (result && (text.Find("P(TestFunction): message 1\n") < 0 || text.Find("message 2") >= 0))
+  {
+    Log_ErrorPrintf("FAIL: decoded text '%s'", text.GetCharArray());
+    result = false;
+  }
+
+  pText->Release();
+  pCutStream->Release();
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: damaged log and decoding");
+  return result;
+}
+
+// the log's perf messages go to the stream instead of the callbacks
+static void CountingCallback(void* pUserParam, const char* channelName, const char* functionName, LOGLEVEL level,
+                             const char* message)
+{
+  if (level == LOGLEVEL_PERF)
+    (*static_cast<uint32*>(pUserParam))++;
+}
+
+static bool TestLogBinaryOutput()
+{
+  uint32 callbackCount = 0;
+  Log::GetInstance().RegisterCallback(CountingCallback, &callbackCount);
+
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  bool result = Log::GetInstance().SetBinaryOutput(pStream);
+  Log_PerfPrintf("binary %d", 1);
+  Log_PerfFmt("binary {}", 2);
+  Log_PerfPrint("binary 3");
+  Log_PerfPrintf("%ls", L"formatted");
+  Log::GetInstance().SetBinaryOutput(nullptr);
+  Log::GetInstance().UnregisterCallback(CountingCallback, &callbackCount);
+
+  pStream->SeekAbsolute(0);
+  BinaryLogReader reader(pStream);
+  BinaryLogReader::Message message;
+  for (uint32 i = 1; result && i <= 3; i++)
+  {
+    result = (reader.ReadMessage(&message) && message.Level == LOGLEVEL_PERF &&
+              message.ChannelName.Compare("TestBinaryLog") &&
+              message.Text.Compare(String::FromFormat("binary %u", i)));
+  }
+  result = (result && !reader.ReadMessage(&message) && !reader.IsDamaged() && callbackCount == 1);
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: log binary output");
+  else
+    Log_ErrorPrintf("FAIL: log binary output (%u callbacks)", callbackCount);
+  return result;
+}
+
+DEFINE_TEST_SUITE(BinaryLog)
+{
+  return TestPrintfMessages() && TestFormatAndTextMessages() && TestDamagedAndDecode() && TestLogBinaryOutput();
+}
@@ -0,0 +1,311 @@
+#include "TestSuite.h"
+#include "YBaseLib/BinarySchema.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Log.h"
+Log_SetChannel(TestBinarySchema);
+
+struct TestVector
+{
+  float X, Y, Z;
+};
+
+struct TestPart
+{
+  uint32 ID;
+  float Weight;
+  String Name;
+};
+
+BEGIN_BINARY_SCHEMA(TestPart)
+BINARY_SCHEMA_FIELD(ID)
+BINARY_SCHEMA_FIELD(Weight)
+BINARY_SCHEMA_FIELD(Name)
+END_BINARY_SCHEMA()
+
+// the first version of TestRecord, as an older reader has it
+struct TestRecordV1
+{
+  uint32 A;
+  uint32 B;
+  uint64 C;
+  String Name;
+  PODArray<uint16> Values;
+};
+
+BEGIN_BINARY_SCHEMA(TestRecordV1)
+BINARY_SCHEMA_FIELD(A)
+BINARY_SCHEMA_FIELD(B)
+BINARY_SCHEMA_FIELD(C)
+BINARY_SCHEMA_FIELD(Name)
+BINARY_SCHEMA_FIELD(Values)
+END_BINARY_SCHEMA()
+
+struct TestRecord
+{
+  uint32 A;
+  uint32 B;
+  uint64 C;
+  String Name;
+  PODArray<uint16> Values;
+  TestVector Position;
+  uint32 Flags = 0x1234;
+  TestPart Root;
+  Array<TestPart> Parts;
+};
+
+BEGIN_BINARY_SCHEMA(TestRecord)
+BINARY_SCHEMA_FIELD(A)
+BINARY_SCHEMA_FIELD(B)
+BINARY_SCHEMA_FIELD(C)
+BINARY_SCHEMA_FIELD(Name)
+BINARY_SCHEMA_FIELD(Values)
+BINARY_SCHEMA_FIELD_SINCE(Position, 2)
+BINARY_SCHEMA_FIELD_SINCE(Flags, 2)
+BINARY_SCHEMA_FIELD_SINCE(Root, 2)
+BINARY_SCHEMA_FIELD_SINCE(Parts, 2)
+END_BINARY_SCHEMA()
+
+static void MakeRecord(TestRecord* pRecord)
+{
+  pRecord->A = 1;
+  pRecord->B = 0xDEADBEEF;
+  pRecord->C = 0x0123456789ABCDEFull;
+  pRecord->Name = "record";
+  pRecord->Values.Clear();
+  for (uint16 i = 0; i < 100; i++)
+    pRecord->Values.Add(i * 3);
+
+  pRecord->Position.X = 1.0f;
+  pRecord->Position.Y = -2.5f;
+  pRecord->Position.Z = 1000.0f;
+  pRecord->Flags = 7;
+  pRecord->Root.ID = 99;
+  pRecord->Root.Weight = 0.5f;
+  pRecord->Root.Name = "root";
+  pRecord->Parts.Resize(3);
+  for (uint32 i = 0; i < pRecord->Parts.GetSize(); i++)
+  {
+    pRecord->Parts[i].ID = i;
+    pRecord->Parts[i].Weight = (float)i * 0.25f;
+    pRecord->Parts[i].Name.Format("part%u", i);
+  }
+}
+
+static bool EqualParts(const TestPart& a, const TestPart& b)
+{
+  return a.ID == b.ID && a.Weight == b.Weight && a.Name == b.Name;
+}
+
+static bool EqualRecords(const TestRecord& a, const TestRecord& b)
+{
+  bool result = a.A == b.A && a.B == b.B && a.C == b.C && a.Name == b.Name &&
+                a.Values.GetSize() == b.Values.GetSize() && a.Position.X == b.Position.X &&
+                a.Position.Y == b.Position.Y && a.Position.Z == b.Position.Z && a.Flags == b.Flags &&
+                EqualParts(a.Root, b.Root) && a.Parts.GetSize() == b.Parts.GetSize();
+  for (uint32 i = 0; i < a.Values.GetSize() && result; i++)
+    result = a.Values[i] == b.Values[i];
+  for (uint32 i = 0; i < a.Parts.GetSize() && result; i++)
+    result = EqualParts(a.Parts[i], b.Parts[i]);
+  return result;
+}
+
+static bool TestRoundTrip()
+{
+  TestRecord record;
+  MakeRecord(&record);
+
+  PODArray<byte> buffer;
+  BinarySchema::Encode(record, &buffer);
+  TestRecord decoded;
+  bool result = BinarySchema::Decode(buffer.GetBasePointer(), buffer.GetSize(), &decoded) &&
+                EqualRecords(record, decoded) && (buffer.GetSize() % BinarySchemaFormat::Alignment) == 0;
+
+  // two after each other through a stream, one with everything empty
+  TestRecord empty = {};
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  {
+    BinaryWriter writer(pStream);
+    result = result && BinarySchema::Write(&writer, record) && BinarySchema::Write(&writer, empty);
+  }
+  pStream->SeekAbsolute(0);
+  {
+    BinaryReader reader(pStream);
+    TestRecord first, second;
+    MakeRecord(&second);
+    result = result && BinarySchema::Read(&reader, &first) && BinarySchema::Read(&reader, &second) &&
+             EqualRecords(record, first) && EqualRecords(empty, second) && !BinarySchema::Read(&reader, &first);
+  }
+  pStream->Release();
+
+  if (result)
+    Log_InfoPrint("PASS: round trip");
+  else
+    Log_ErrorPrint("FAIL: round trip");
+  return result;
+}
+
+static bool TestViews()
+{
+  TestRecord record;
+  MakeRecord(&record);
+  PODArray<byte> buffer;
+  BinarySchema::Encode(record, &buffer);
+
+  BinarySchemaView<TestRecord> view(buffer.GetBasePointer(), buffer.GetSize());
+  bool result = view.IsValid() && view.GetVersion() == 2 && view.GetSize() == buffer.GetSize() &&
+                view.Get(&TestRecord::A) == record.A && view.Get(&TestRecord::B) == record.B &&
+                view.Get(&TestRecord::C) == record.C && view.Get(&TestRecord::Flags) == record.Flags &&
+                view.Get(&TestRecord::Position).Z == record.Position.Z &&
+                view.Get(&TestRecord::Name) == StringView("record");
+
+  // fields point into the encoding rather than being copied out of it
+  const byte* pStart = buffer.GetBasePointer();
+  const byte* pEnd = pStart + buffer.GetSize();
+  const byte* pC = reinterpret_cast<const byte*>(&view.Get(&TestRecord::C));
+  result = result && pC > pStart && pC < pEnd && ((uintptr_t)pC % alignof(uint64)) == 0;
+
+  BinarySchemaArrayView<uint16> values = view.Get(&TestRecord::Values);
+  result = result && values.GetSize() == record.Values.GetSize() &&
+           reinterpret_cast<const byte*>(values.GetBasePointer()) > pStart &&
+           reinterpret_cast<const byte*>(values.GetBasePointer()) < pEnd;
+  for (uint32 i = 0; i < values.GetSize() && result; i++)
+    result = values[i] == record.Values[i];
+
+  // the string's terminated in place
+  result = result && Y_strcmp(view.Get(&TestRecord::Name).GetData(), "record") == 0;
+
+  BinarySchemaView<TestPart> root = view.Get(&TestRecord::Root);
+  result = result && root.IsValid() && root.Get(&TestPart::ID) == 99 && root.Get(&TestPart::Name) == StringView("root");
+
+  BinarySchemaObjectArrayView<TestPart> parts = view.Get(&TestRecord::Parts);
+  result = result && parts.GetSize() == record.Parts.GetSize();
+  for (uint32 i = 0; i < parts.GetSize() && result; i++)
+  {
+    BinarySchemaView<TestPart> part = parts[i];
+    result = part.IsValid() && part.Get(&TestPart::ID) == i && part.Get(&TestPart::Weight) == record.Parts[i].Weight &&
+             part.Get(&TestPart::Name) == StringView(record.Parts[i].Name);
+  }
+
+  // an invalid view reads as a default constructed object
+  BinarySchemaView<TestRecord> invalidView(buffer.GetBasePointer(), sizeof(BinarySchemaFormat::Header) - 1);
+  result = result && !invalidView.IsValid() && invalidView.Get(&TestRecord::Flags) == 0x1234 &&
+           invalidView.Get(&TestRecord::Name).IsEmpty() && invalidView.Get(&TestRecord::Values).IsEmpty() &&
+           !invalidView.Get(&TestRecord::Root).IsValid() && invalidView.Get(&TestRecord::Parts).IsEmpty();
+
+  if (result)
+    Log_InfoPrint("PASS: views");
+  else
+    Log_ErrorPrint("FAIL: views");
+  return result;
+}
+
+static bool TestVersions()
+{
+  TestRecord record;
+  MakeRecord(&record);
+
+  // a newer encoding read by an older reader, which doesn't see the fields it doesn't know
+  PODArray<byte> buffer;
+  BinarySchema::Encode(record, &buffer);
+  TestRecordV1 older;
+  bool result = BinarySchema::Decode(buffer.GetBasePointer(), buffer.GetSize(), &older) && older.A == record.A &&
+                older.B == record.B && older.C == record.C && older.Name == record.Name &&
+                older.Values.GetSize() == record.Values.GetSize();
+
+  // an older encoding read by a newer reader, which leaves the fields it doesn't have alone
+  buffer.Clear();
+  BinarySchema::Encode(older, &buffer);
+  TestRecord newer;
+  newer.Root.ID = 5;
+  result = result && BinarySchema::Decode(buffer.GetBasePointer(), buffer.GetSize(), &newer) && newer.A == record.A &&
+           newer.Name == record.Name && newer.Values.GetSize() == record.Values.GetSize() && newer.Flags == 0x1234 &&
+           newer.Root.ID == 5 && newer.Parts.IsEmpty();
+
+  BinarySchemaView<TestRecord> view(buffer.GetBasePointer(), buffer.GetSize());
+  result = result && view.IsValid() && view.GetVersion() == 1 && view.Get(&TestRecord::C) == record.C &&
+           view.Get(&TestRecord::Flags) == 0x1234 && !view.Get(&TestRecord::Root).IsValid() &&
+           view.Get(&TestRecord::Parts).IsEmpty();
+
+  // and a newer writer writing for an older reader gives the same as the older writer
+  PODArray<byte> downgraded;
+  BinarySchema::Encode(record, &downgraded, 1);
+  result = result && downgraded.GetSize() == buffer.GetSize() &&
+           std::memcmp(downgraded.GetBasePointer(), buffer.GetBasePointer(), buffer.GetSize()) == 0;
+
+  if (result)
+    Log_InfoPrint("PASS: versions");
+  else
+    Log_ErrorPrint("FAIL: versions");
+  return result;
+}
+
+static bool TestDamagedEncodings()
+{
+  TestRecord record;
+  MakeRecord(&record);
+  PODArray<byte> buffer;
+  BinarySchema::Encode(record, &buffer);
+
+  // cut short, or with its sizes out of order, it doesn't decode
+  TestRecord decoded;
+  bool result = !BinarySchema::Decode(buffer.GetBasePointer(), buffer.GetSize() - 8, &decoded);
+  BinarySchemaFormat::Header* pHeader = reinterpret_cast<BinarySchemaFormat::Header*>(buffer.GetBasePointer());
+  pHeader->FixedSize = pHeader->TotalSize + 8;
+  result = result && !BinarySchema::Decode(buffer.GetBasePointer(), buffer.GetSize(), &decoded) &&
+           !BinarySchemaView<TestRecord>(buffer.GetBasePointer(), buffer.GetSize()).IsValid();
+
+  // slots pointing out of the object, or back at its header, fail to decode and read as defaults
+  const BinarySchema* pSchema = BinarySchema::Get<TestRecord>();
+  for (uint32 i = 0; i < pSchema->GetFieldCount() && result; i++)
+  {
+    const BinarySchema::Field& field = pSchema->GetField(i);
+    if (field.Kind == BinarySchema::FieldKind_Plain)
+      continue;
+
+    const uint32 badOffsets[] = {0, 1, buffer.GetSize(), 0xFFFFFFF8};
+    for (uint32 badOffset : badOffsets)
+    {
+      buffer.Clear();
+      BinarySchema::Encode(record, &buffer);
+      BinarySchemaFormat::Slot slot;
+      std::memcpy(&slot, buffer.GetBasePointer() + field.FixedOffset, sizeof(slot));
+      slot.Offset = badOffset;
+      std::memcpy(buffer.GetBasePointer() + field.FixedOffset, &slot, sizeof(slot));
+
+      BinarySchemaView<TestRecord> view(buffer.GetBasePointer(), buffer.GetSize());
+      result = result && !BinarySchema::Decode(buffer.GetBasePointer(), buffer.GetSize(), &decoded) && view.IsValid() &&
+               view.Get(&TestRecord::Name).IsEmpty() == (field.Kind == BinarySchema::FieldKind_String) &&
+               view.Get(&TestRecord::Values).IsEmpty() == (field.Kind == BinarySchema::FieldKind_PODArray) &&
+               view.Get(&TestRecord::Root).IsValid() == (field.Kind != BinarySchema::FieldKind_Object) &&
+               view.Get(&TestRecord::Parts).IsEmpty() == (field.Kind == BinarySchema::FieldKind_ObjectArray);
+    }
+  }
+
+  // an element of an array of objects pointing back at the array's object
+  buffer.Clear();
+  BinarySchema::Encode(record, &buffer);
+  BinarySchemaView<TestRecord> view(buffer.GetBasePointer(), buffer.GetSize());
+  const BinarySchema::Field* pPartsField = pSchema->FindField(BinarySchema::GetMemberOffset(&TestRecord::Parts));
+  BinarySchemaFormat::Slot partsSlot;
+  std::memcpy(&partsSlot, buffer.GetBasePointer() + pPartsField->FixedOffset, sizeof(partsSlot));
+  uint32 zero = 0;
+  std::memcpy(buffer.GetBasePointer() + partsSlot.Offset, &zero, sizeof(zero));
+  result = result && !BinarySchema::Decode(buffer.GetBasePointer(), buffer.GetSize(), &decoded) &&
+           !view.Get(&TestRecord::Parts)[0].IsValid() && view.Get(&TestRecord::Parts)[1].IsValid();
+
+  if (result)
+    Log_InfoPrint("PASS: damaged encodings");
+  else
+    Log_ErrorPrint("FAIL: damaged encodings");
+  return result;
+}
+
+DEFINE_TEST_SUITE(BinarySchema)
+{
+  bool result = true;
+  result &= TestRoundTrip();
+  result &= TestViews();
+  result &= TestVersions();
+  result &= TestDamagedEncodings();
+  return result;
+}
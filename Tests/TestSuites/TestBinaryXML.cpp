@@ -0,0 +1,229 @@
+#include "TestSuite.h"
+#include "YBaseLib/BinaryXML.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+Log_SetChannel(TestBinaryXML);
+
+static const byte s_data[] = {0x00, 0x01, 0xFE, 0xFF, 0x10};
+
+// a document using every kind of record
+static bool WriteDocument(ByteStream* pStream)
+{
+  BinaryXMLWriter writer;
+  if (!writer.Create(pStream))
+    return false;
+
+  writer.StartElement("scene");
+  writer.WriteAttribute("name", "a \"test\" & more");
+  writer.WriteAttributef("label", "%s-%u", "item", 7u);
+  writer.WriteAttributeInt32("offset", -12);
+  writer.WriteAttributeUInt64("size", 18446744073709551615ull);
+  writer.WriteAttributeFloat("scale", 0.5f);
+  writer.WriteAttributeDouble("ratio", 0.1);
+  writer.WriteEmptyElement("object");
+  writer.StartElement("object");
+  writer.WriteAttributeInt32("offset", 3);
+  writer.WriteString("text <here>");
+  writer.EndElement();
+  writer.StartElement("data");
+  writer.WriteBase64EncodedData(s_data, sizeof(s_data));
+  writer.EndElement();
+  writer.StartElement("code");
+  writer.WriteCDATA("raw <not> &markup;");
+  writer.EndElement();
+
+  // Close ends the scene
+  writer.Close();
+  return !writer.InErrorState();
+}
+
+static bool Expect(BinaryXMLReader& reader, XMLREADER_TOKEN_TYPE type, const char* name)
+{
+  if (!reader.NextToken() || reader.GetTokenType() != type || Y_strcmp(reader.GetNodeName(), name) != 0)
+  {
+    Log_ErrorPrintf("FAIL: expected token %u '%s'", uint32(type), name);
+    return false;
+  }
+
+  return true;
+}
+
+// every record read back, as text and as the numbers they were written as
+static bool TestRecords()
+{
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  bool result = WriteDocument(pStream);
+  pStream->SeekAbsolute(0);
+
+  BinaryXMLReader reader;
+  result = result && reader.Create(pStream, "document.bxml") && Expect(reader, XMLREADER_TOKEN_ELEMENT, "scene") &&
+           !reader.IsEmptyElement() && Y_strcmp(reader.FetchAttribute("name"), "a \"test\" & more") == 0 &&
+           Y_strcmp(reader.FetchAttribute("label"), "item-7") == 0 &&
+           Y_strcmp(reader.FetchAttribute("offset"), "-12") == 0 && reader.FetchAttributeInt64("offset", 0) == -12 &&
+           Y_strcmp(reader.FetchAttribute("size"), "18446744073709551615") == 0 &&
+           reader.FetchAttributeUInt64("size", 0) == 18446744073709551615ull &&
+           Y_strcmp(reader.FetchAttribute("scale"), "0.5") == 0 &&
+           Y_strcmp(reader.FetchAttribute("ratio"), "0.1") == 0 && reader.FetchAttributeDouble("ratio", 0.0) == 0.1 &&
+           reader.FetchAttribute("missing") == NULL && reader.FetchAttributeInt64("missing", 5) == 5 &&
+           reader.FetchAttributeInt64("label", 9) == 9;
+
+  // attributes in order, with formatted values staying valid
+  const char* pOffset = NULL;
+  result = result && reader.MoveToFirstAttribute() && Y_strcmp(reader.GetNodeName(), "name") == 0 &&
+           reader.MoveToNextAttribute() && reader.MoveToNextAttribute() && (pOffset = reader.GetNodeValue()) != NULL &&
+           reader.MoveToNextAttribute() && reader.GetNodeValue() != NULL && Y_strcmp(pOffset, "-12") == 0 &&
+           reader.MoveToNextAttribute() && reader.MoveToNextAttribute() && !reader.MoveToNextAttribute() &&
+           reader.MoveToElement();
+
+  result = result && Expect(reader, XMLREADER_TOKEN_ELEMENT, "object") && reader.IsEmptyElement() &&
+           Expect(reader, XMLREADER_TOKEN_ELEMENT, "object") && !reader.IsEmptyElement() &&
+           reader.FetchAttributeUInt64("offset", 0) == 3 && Expect(reader, XMLREADER_TOKEN_TEXT, "#text") &&
+           Y_strcmp(reader.GetNodeValue(), "text <here>") == 0 && Expect(reader, XMLREADER_TOKEN_END_ELEMENT, "object");
+
+  result = result && Expect(reader, XMLREADER_TOKEN_ELEMENT, "data") &&
+           reader.GetElementText().Compare("AAH+/xA=") && Expect(reader, XMLREADER_TOKEN_END_ELEMENT, "data") &&
+           Expect(reader, XMLREADER_TOKEN_ELEMENT, "code") &&
+           reader.GetElementText(true).Compare("raw <not> &markup;") && reader.ExpectEndOfElementName("code") &&
+           Expect(reader, XMLREADER_TOKEN_END_ELEMENT, "scene") && !reader.NextToken() && !reader.InErrorState();
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: records");
+  else
+    Log_ErrorPrint("FAIL: records");
+  return result;
+}
+
+// the writer refuses what XMLWriter would
+static bool TestWriterErrors()
+{
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  BinaryXMLWriter attributeWriter;
+  attributeWriter.Create(pStream);
+  attributeWriter.StartElement("a");
+  attributeWriter.WriteString("text");
+  attributeWriter.WriteAttribute("late", "1");
+  bool result = attributeWriter.InErrorState();
+
+  BinaryXMLWriter endWriter;
+  endWriter.Create(pStream);
+  endWriter.EndElement();
+  result = result && endWriter.InErrorState();
+
+  attributeWriter.Close();
+  endWriter.Close();
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: writer errors");
+  else
+    Log_ErrorPrint("FAIL: writer errors");
+  return result;
+}
+
+// text to binary and back gives the same text, with numbers kept as numbers on the way
+static bool TestConversion()
+{
+  static const char text[] = "<?xml version=\"1.0\"?>\n"
+                             "<scene name=\"a &lt;b&gt; &amp; &quot;c&quot;&#10;\" count=\"12\" offset=\"-3\" "
+                             "ratio=\"0.25\" padded=\"012\" version=\"1.0\">\n"
+                             "    <object id=\"1\"/>\n"
+                             "    <object id=\"2\">some &amp; text<inner/></object>\n"
+                             "    <group>\n"
+                             "        <empty/>\n"
+                             "    </group>\n"
+                             "</scene>\n";
+
+  ReadOnlyMemoryByteStream* pTextStream = ByteStream_CreateReadOnlyMemoryStream(text, sizeof(text) - 1);
+  GrowableMemoryByteStream* pBinaryStream = ByteStream_CreateGrowableMemoryStream();
+  GrowableMemoryByteStream* pOutputStream = ByteStream_CreateGrowableMemoryStream();
+
+  bool result = BinaryXML::ConvertFromText(pTextStream, "document.xml", pBinaryStream) &&
+                pBinaryStream->GetSize() < sizeof(text) - 1;
+
+  BinaryXMLReader reader;
+  pBinaryStream->SeekAbsolute(0);
+  result = result && reader.Create(pBinaryStream, "document.bxml") && reader.NextToken() &&
+           reader.FetchAttributeInt64("count", 0) == 12 && reader.FetchAttributeInt64("offset", 0) == -3 &&
+           reader.FetchAttributeDouble("ratio", 0.0) == 0.25 && Y_strcmp(reader.FetchAttribute("padded"), "012") == 0 &&
+           Y_strcmp(reader.FetchAttribute("version"), "1.0") == 0;
+
+  pBinaryStream->SeekAbsolute(0);
+  result = result && BinaryXML::ConvertToText(pBinaryStream, "document.bxml", pOutputStream);
+  if (result && (pOutputStream->GetSize() != sizeof(text) - 1 ||
+                 std::memcmp(pOutputStream->GetMemoryPointer(), text, sizeof(text) - 1) != 0))
+  {
+    Log_ErrorPrintf("FAIL: converted back to '%.*s'", uint32(pOutputStream->GetSize()),
+                    pOutputStream->GetMemoryPointer());
+    result = false;
+  }
+
+  pOutputStream->Release();
+  pBinaryStream->Release();
+  pTextStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: conversion");
+  else
+    Log_ErrorPrint("FAIL: conversion");
+  return result;
+}
+
+// every truncation of a document, and a bad byte at every position, is an error rather than a crash
+static bool TestCorruption()
+{
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  bool result = WriteDocument(pStream);
+  uint32 length = uint32(pStream->GetSize());
+  byte* pDocument = pStream->GetMemoryPointer();
+
+  for (uint32 i = 0; result && i < length; i++)
+  {
+    ReadOnlyMemoryByteStream* pTruncated = ByteStream_CreateReadOnlyMemoryStream(pDocument, i);
+    BinaryXMLReader reader;
+    if (reader.Create(pTruncated, "truncated.bxml"))
+    {
+      while (reader.NextToken())
+        reader.FetchAttribute("label");
+    }
+    if (!reader.InErrorState())
+    {
+      Log_ErrorPrintf("FAIL: document truncated to %u bytes read without an error", i);
+      result = false;
+    }
+    pTruncated->Release();
+  }
+
+  for (uint32 i = 8; result && i < length; i++)
+  {
+    byte original = pDocument[i];
+    pDocument[i] = 0xFF;
+
+    ReadOnlyMemoryByteStream* pCorrupt = ByteStream_CreateReadOnlyMemoryStream(pDocument, length);
+    BinaryXMLReader reader;
+    reader.Create(pCorrupt, "corrupt.bxml");
+    while (reader.NextToken())
+    {
+      if (reader.MoveToFirstAttribute())
+      {
+        do
+        {
+          reader.GetNodeValue();
+        } while (reader.MoveToNextAttribute());
+      }
+    }
+    pCorrupt->Release();
+    pDocument[i] = original;
+  }
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: corruption");
+  return result;
+}
+
+DEFINE_TEST_SUITE(BinaryXML)
+{
+  return TestRecords() && TestWriterErrors() && TestConversion() && TestCorruption();
+}
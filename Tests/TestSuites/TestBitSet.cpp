@@ -1,8 +1,14 @@
 #include "TestSuite.h"
+#include "YBaseLib/BinaryReader.h"
+#include "YBaseLib/BinaryWriter.h"
 #include "YBaseLib/BitSet.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CompressedBitSet.h"
 #include "YBaseLib/CString.h"
 #include "YBaseLib/Log.h"
-Log_SetChannel(TestBase64);
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/Sort.h"
+Log_SetChannel(TestBitSet);
 
 static bool BitSet8Tests()
 {
@@ -30,10 +36,298 @@ static bool BitSet8Tests()
   return true;
 }
 
+// checks the bulk operations against bit-by-bit results, sizes chosen to leave partial vectors and values
+template<typename TYPE>
+static bool BulkOperationTests(size_t bitCount)
+{
+  BitSet<TYPE> a(bitCount);
+  BitSet<TYPE> b(bitCount);
+  uint32 seed = 42;
+  for (size_t i = 0; i < bitCount; i++)
+  {
+    seed = seed * 1664525 + 1013904223;
+    if ((seed >> 28) < 3)
+      a.SetBit(i);
+    if ((seed >> 24) & 1)
+      b.SetBit(i);
+  }
+
+  size_t expectedCount = 0;
+  for (size_t i = 0; i < bitCount; i++)
+    expectedCount += a.TestBit(i) ? 1 : 0;
+  if (a.PopCount() != expectedCount)
+  {
+    Log_ErrorPrintf("FAIL: PopCount of %u bits returned %u, expected %u", (uint32)bitCount, (uint32)a.PopCount(),
+                    (uint32)expectedCount);
+    return false;
+  }
+
+  // iteration visits exactly the set bits
+  size_t visited = 0;
+  size_t index = 0;
+  bool found = a.FindFirstSetBit(&index);
+  for (size_t i = 0; i < bitCount; i++)
+  {
+    if (!a.TestBit(i))
+      continue;
+    if (!found || index != i)
+    {
+      Log_ErrorPrintf("FAIL: FindNextSetBit expected %u", (uint32)i);
+      return false;
+    }
+    visited++;
+    found = a.FindNextSetBit(i + 1, &index);
+  }
+  if (found || visited != expectedCount)
+  {
+    Log_ErrorPrintf("FAIL: FindNextSetBit found bits past the end");
+    return false;
+  }
+
+  size_t callbackCount = 0;
+  bool callbackOrdered = true;
+  a.ForEachSetBit([&](size_t bit) {
+    callbackOrdered &= a.TestBit(bit);
+    callbackCount++;
+  });
+  if (!callbackOrdered || callbackCount != expectedCount)
+  {
+    Log_ErrorPrintf("FAIL: ForEachSetBit visited %u bits, expected %u", (uint32)callbackCount, (uint32)expectedCount);
+    return false;
+  }
+
+  BitSet<TYPE> andResult(a & b);
+  BitSet<TYPE> orResult(a | b);
+  BitSet<TYPE> xorResult(a ^ b);
+  BitSet<TYPE> andNotResult(a);
+  andNotResult.AndNot(b);
+  BitSet<TYPE> flipped(~a);
+  for (size_t i = 0; i < bitCount; i++)
+  {
+    bool x = a.TestBit(i), y = b.TestBit(i);
+    if (andResult.TestBit(i) != (x && y) || orResult.TestBit(i) != (x || y) || xorResult.TestBit(i) != (x != y) ||
+        andNotResult.TestBit(i) != (x && !y) || flipped.TestBit(i) == x)
+    {
+      Log_ErrorPrintf("FAIL: bulk operation on %u bits wrong at bit %u", (uint32)bitCount, (uint32)i);
+      return false;
+    }
+  }
+  if (flipped.PopCount() != bitCount - expectedCount)
+  {
+    Log_ErrorPrintf("FAIL: Flip set bits past the end");
+    return false;
+  }
+
+  return true;
+}
+
+// sorted, unique indices for checking a compressed set against
+static void FinishReference(PODArray<uint32>& values)
+{
+  Y_sort(values.GetBasePointer(), values.GetSize());
+  uint32 count = 0;
+  for (uint32 i = 0; i < values.GetSize(); i++)
+  {
+    if (count == 0 || values[i] != values[count - 1])
+      values[count++] = values[i];
+  }
+  values.Resize(count);
+}
+
+static bool CheckCompressedSet(const CompressedBitSet& set, const PODArray<uint32>& expected, const char* what)
+{
+  if (set.PopCount() != expected.GetSize())
+  {
+    Log_ErrorPrintf("FAIL: %s has %u bits, expected %u", what, (uint32)set.PopCount(), expected.GetSize());
+    return false;
+  }
+
+  uint32 visited = 0;
+  bool ordered = true;
+  set.ForEachSetBit([&](uint32 bit) {
+    ordered &= (visited < expected.GetSize() && expected[visited] == bit);
+    visited++;
+  });
+
+  uint32 index = 0;
+  bool found = set.FindFirstSetBit(&index);
+  for (uint32 i = 0; i < expected.GetSize() && ordered; i++)
+  {
+    ordered = found && index == expected[i] && set.TestBit(index) && (index == 0 || !set.TestBit(index - 1) ||
+                                                                      (i > 0 && expected[i - 1] == index - 1));
+    found = (index != 0xFFFFFFFF) && set.FindNextSetBit(index + 1, &index);
+  }
+  if (!ordered || found || visited != expected.GetSize())
+  {
+    Log_ErrorPrintf("FAIL: %s iterated out of order", what);
+    return false;
+  }
+
+  return true;
+}
+
+// expected result of op over two sorted references, 0 = or, 1 = and, 2 = xor, 3 = and not
+static void ReferenceOperation(const PODArray<uint32>& a, const PODArray<uint32>& b, uint32 op,
+                               PODArray<uint32>& result)
+{
+  result.Clear();
+  uint32 i = 0, j = 0;
+  while (i < a.GetSize() || j < b.GetSize())
+  {
+    if (j == b.GetSize() || (i < a.GetSize() && a[i] < b[j]))
+    {
+      if (op != 1)
+        result.Add(a[i]);
+      i++;
+    }
+    else if (i == a.GetSize() || b[j] < a[i])
+    {
+      if (op == 0 || op == 2)
+        result.Add(b[j]);
+      j++;
+    }
+    else
+    {
+      if (op == 0 || op == 1)
+        result.Add(a[i]);
+      i++;
+      j++;
+    }
+  }
+}
+
+// builds a set with sparse indices over the whole range, a dense chunk that needs a bitmap, and long runs
+static void BuildCompressedSet(CompressedBitSet& set, PODArray<uint32>& reference, uint32 seed)
+{
+  for (uint32 i = 0; i < 1000; i++)
+  {
+    seed = seed * 1664525 + 1013904223;
+    set.SetBit(seed);
+    reference.Add(seed);
+  }
+  for (uint32 i = 0; i < 20000; i++)
+  {
+    seed = seed * 1664525 + 1013904223;
+    uint32 bit = 0x50000 | (seed >> 16);
+    set.SetBit(bit);
+    reference.Add(bit);
+  }
+
+  uint32 rangeStart = 0x7FFF0000 + (seed & 0xFFF);
+  set.SetRange(rangeStart, rangeStart + 200000);
+  for (uint32 i = 0; i <= 200000; i++)
+    reference.Add(rangeStart + i);
+
+  set.SetBit(0);
+  set.SetBit(0xFFFFFFFF);
+  reference.Add(0);
+  reference.Add(0xFFFFFFFF);
+  FinishReference(reference);
+}
+
+static bool CompressedBitSetTests()
+{
+  CompressedBitSet a, b;
+  PODArray<uint32> referenceA, referenceB, expected;
+  BuildCompressedSet(a, referenceA, 1);
+  BuildCompressedSet(b, referenceB, 2);
+  if (!CheckCompressedSet(a, referenceA, "built set"))
+    return false;
+
+  static const char* operationNames[] = {"union", "intersection", "xor", "difference"};
+  for (uint32 op = 0; op < 4; op++)
+  {
+    CompressedBitSet result(a);
+    switch (op)
+    {
+      case 0: result.Combine(b); break;
+      case 1: result.Mask(b); break;
+      case 2: result.Xor(b); break;
+      default: result.AndNot(b); break;
+    }
+
+    ReferenceOperation(referenceA, referenceB, op, expected);
+    if (!CheckCompressedSet(result, expected, operationNames[op]))
+      return false;
+  }
+
+  // clearing most of the dense chunk turns its bitmap back into an array
+  CompressedBitSet cleared(a);
+  PODArray<uint32> remaining;
+  for (uint32 i = 0; i < referenceA.GetSize(); i++)
+  {
+    uint32 bit = referenceA[i];
+    if ((bit >> 16) == 5 && (bit & 7) != 0)
+      cleared.UnsetBit(bit);
+    else
+      remaining.Add(bit);
+  }
+  if (!CheckCompressedSet(cleared, remaining, "cleared set"))
+    return false;
+
+  // containers of different types holding the same bits still compare equal
+  CompressedBitSet optimized(a);
+  optimized.RunOptimize();
+  CompressedBitSet bitByBit;
+  for (uint32 i = 0; i < referenceA.GetSize(); i++)
+    bitByBit.SetBit(referenceA[i]);
+  if (optimized != a || bitByBit != a || !a.TestSetMask(cleared) || cleared.TestSetMask(a) ||
+      bitByBit.GetMemoryUsage() < optimized.GetMemoryUsage())
+  {
+    Log_ErrorPrintf("FAIL: compressed set comparisons");
+    return false;
+  }
+
+  // round trip through a stream, then make sure a damaged stream is rejected
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  BinaryWriter writer(pStream);
+  if (!a.Write(&writer) || !optimized.Write(&writer))
+  {
+    Log_ErrorPrintf("FAIL: compressed set write");
+    pStream->Release();
+    return false;
+  }
+
+  pStream->SeekAbsolute(0);
+  BinaryReader reader(pStream);
+  CompressedBitSet readA, readOptimized;
+  bool readOk = readA.Read(&reader) && readOptimized.Read(&reader) && readA == a && readOptimized == a;
+
+  std::memset(pStream->GetMemoryPointer() + 4, 0xFF, 2);
+  pStream->SeekAbsolute(0);
+  CompressedBitSet damaged;
+  readOk = readOk && !damaged.Read(&reader) && damaged.IsEmpty();
+  pStream->Release();
+  if (!readOk)
+  {
+    Log_ErrorPrintf("FAIL: compressed set read");
+    return false;
+  }
+
+  return true;
+}
+
 DEFINE_TEST_SUITE(BitSet)
 {
   if (!BitSet8Tests())
     return false;
 
+  static const size_t bitCounts[] = {1, 63, 64, 65, 1000, 100003};
+  for (size_t i = 0; i < countof(bitCounts); i++)
+  {
+    if (!BulkOperationTests<uint8>(bitCounts[i]) || !BulkOperationTests<uint32>(bitCounts[i]) ||
+        !BulkOperationTests<uint64>(bitCounts[i]))
+    {
+      return false;
+    }
+  }
+
+  Log_InfoPrintf("PASS: bit set bulk operations");
+
+  if (!CompressedBitSetTests())
+    return false;
+
+  Log_InfoPrintf("PASS: compressed bit set");
+
   return true;
 }
@@ -0,0 +1,95 @@
+#include "TestSuite.h"
+#include "YBaseLib/BloomFilter.h"
+#include "YBaseLib/CuckooFilter.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+Log_SetChannel(TestBloomFilter);
+
+// Keys are consecutive integers, the filters remix them. Those from KEY_COUNT on are never added, and are counted
+// as false positives when they pass.
+static const uint32 KEY_COUNT = 100000;
+
+static bool TestBloom()
+{
+  BloomFilter filter;
+  bool result = filter.MayContain(1) && filter.GetMemoryUsage() == 0;
+
+  filter.Reset(KEY_COUNT);
+  result = result && !filter.MayContain(1);
+  for (uint32 i = 0; i < KEY_COUNT; i++)
+    filter.Add(i);
+  for (uint32 i = 0; i < KEY_COUNT && result; i++)
+    result = filter.MayContain(i);
+
+  uint32 falsePositives = 0;
+  for (uint32 i = KEY_COUNT; i < KEY_COUNT * 2; i++)
+    falsePositives += filter.MayContain(i) ? 1 : 0;
+
+  // about 0.5% expected, allow double
+  result = result && falsePositives < KEY_COUNT / 100 && !filter.IsOverfilled();
+
+  filter.Add(KEY_COUNT * 2);
+  result = result && filter.IsOverfilled();
+  filter.Clear();
+  result = result && !filter.MayContain(0) && filter.GetAddedCount() == 0;
+
+  if (result)
+    Log_InfoPrintf("PASS: Bloom filter, %u false positives", falsePositives);
+  else
+    Log_ErrorPrintf("FAIL: Bloom filter, %u false positives", falsePositives);
+  return result;
+}
+
+static bool TestCuckoo()
+{
+  CuckooFilter filter;
+  bool result = filter.MayContain(1) && !filter.Add(1);
+
+  filter.Reset(KEY_COUNT);
+  for (uint32 i = 0; i < KEY_COUNT && result; i++)
+    result = filter.Add(i);
+  for (uint32 i = 0; i < KEY_COUNT && result; i++)
+    result = filter.MayContain(i);
+
+  uint32 falsePositives = 0;
+  for (uint32 i = KEY_COUNT; i < KEY_COUNT * 2; i++)
+    falsePositives += filter.MayContain(i) ? 1 : 0;
+  result = result && falsePositives < KEY_COUNT / 2000;
+
+  // removing the even keys leaves the odd ones
+  for (uint32 i = 0; i < KEY_COUNT && result; i += 2)
+    result = filter.Remove(i);
+  for (uint32 i = 1; i < KEY_COUNT && result; i += 2)
+    result = filter.MayContain(i);
+
+  uint32 stillPassing = 0;
+  for (uint32 i = 0; i < KEY_COUNT; i += 2)
+    stillPassing += filter.MayContain(i) ? 1 : 0;
+  result = result && stillPassing < KEY_COUNT / 1000 && filter.GetCount() == KEY_COUNT / 2;
+
+  // filled until an add fails, which has to leave everything added before it in place
+  CuckooFilter small;
+  small.Reset(1000);
+  uint32 added = 0;
+  while (small.Add(added))
+    added++;
+  result = result && added >= 1000 && added <= small.GetCapacity() && small.GetCount() == added;
+  for (uint32 i = 0; i < added && result; i++)
+    result = small.MayContain(i);
+
+  if (result)
+    Log_InfoPrintf("PASS: cuckoo filter, %u false positives, %u of %u added", falsePositives, added,
+                   small.GetCapacity());
+  else
+    Log_ErrorPrintf("FAIL: cuckoo filter, %u false positives, %u of %u added", falsePositives, added,
+                    small.GetCapacity());
+  return result;
+}
+
+DEFINE_TEST_SUITE(BloomFilter)
+{
+  bool result = true;
+  result &= TestBloom();
+  result &= TestCuckoo();
+  return result;
+}
@@ -30,9 +30,46 @@ DEFINE_TEST_SUITE(CPUID)
   Log_DevPrintf("| SSE4.2                        | %9s |", cpuid.SupportsSSE42 ? "Yes" : "No");
   Log_DevPrintf("| SSE5A                         | %9s |", cpuid.SupportsSSE5A ? "Yes" : "No");
   Log_DevPrintf("| AVX                           | %9s |", cpuid.SupportsAVX ? "Yes" : "No");
+  Log_DevPrintf("| AVX2                          | %9s |", cpuid.SupportsAVX2 ? "Yes" : "No");
   Log_DevPrintf("| AES                           | %9s |", cpuid.SupportsAES ? "Yes" : "No");
   Log_DevPrintf("| HTT (Hyper-threading)         | %9s |", cpuid.SupportsHTT ? "Yes" : "No");
   Log_DevPrintf("=============================================");
   Log_DevPrintf("");
+
+  // the quick check has to agree with the full one
+  if (Y_CPUSupportsAVX2() != cpuid.SupportsAVX2)
+  {
+    Log_ErrorPrintf("Y_CPUSupportsAVX2 returned %s, Y_ReadCPUID %s", Y_CPUSupportsAVX2() ? "true" : "false",
+                    cpuid.SupportsAVX2 ? "true" : "false");
+    return false;
+  }
+
+  // and so does the feature mask, for the flags both have
+  uint32 features = Y_GetCPUFeatures();
+  Log_DevPrintf("Feature mask: 0x%08X", features);
+  if (((features & Y_CPU_FEATURE_SSE2) != 0) != cpuid.SupportsSSE2 ||
+      ((features & Y_CPU_FEATURE_SSE42) != 0) != cpuid.SupportsSSE42 ||
+      ((features & Y_CPU_FEATURE_AVX) != 0) != cpuid.SupportsAVX ||
+      ((features & Y_CPU_FEATURE_AVX2) != 0) != cpuid.SupportsAVX2)
+  {
+    Log_ErrorPrintf("Feature mask 0x%08X disagrees with Y_ReadCPUID", features);
+    return false;
+  }
+  if (Y_CPUHasFeatures(Y_CPU_FEATURE_AVX512BW) && !Y_CPUHasFeatures(Y_CPU_FEATURE_AVX512F))
+  {
+    Log_ErrorPrintf("AVX-512BW reported without AVX-512F");
+    return false;
+  }
+
+  Y_CPU_CACHE_INFO cacheInfo;
+  Y_ReadCPUCacheInfo(&cacheInfo);
+  Log_DevPrintf("Cache line %u bytes, L1D %u, L2 %u, L3 %u", cacheInfo.LineSize, cacheInfo.L1DataSize,
+                cacheInfo.L2Size, cacheInfo.L3Size);
+  if (cacheInfo.LineSize == 0 || (cacheInfo.LineSize & (cacheInfo.LineSize - 1)) != 0)
+  {
+    Log_ErrorPrintf("Cache line size %u isn't a power of two", cacheInfo.LineSize);
+    return false;
+  }
+
   return true;
 }
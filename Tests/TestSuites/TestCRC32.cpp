@@ -0,0 +1,117 @@
+#include "TestSuite.h"
+#include "YBaseLib/CRC32.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+Log_SetChannel(TestCRC32);
+
+// the crc a bit at a time, to check the table and folded versions against
+static uint32 ReferenceCRC32(const byte* pBytes, size_t length)
+{
+  uint32 crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++)
+  {
+    crc ^= pBytes[i];
+    for (uint32 bit = 0; bit < 8; bit++)
+      crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320) : (crc >> 1);
+  }
+
+  return crc ^ 0xFFFFFFFF;
+}
+
+static uint32 HashBytes(const void* pBytes, size_t length, uint32 start = 0)
+{
+  CRC32 crc(start);
+  crc.HashBytes(pBytes, length);
+  return crc.GetCRC();
+}
+
+static bool TestKnownValues()
+{
+  static const char checkString[] = "123456789";
+  uint32 checkCRC = HashBytes(checkString, sizeof(checkString) - 1);
+  uint32 emptyCRC = HashBytes(checkString, 0);
+  if (checkCRC != 0xCBF43926 || emptyCRC != 0)
+  {
+    Log_ErrorPrintf("FAIL: known values (%08X, %08X)", checkCRC, emptyCRC);
+    return false;
+  }
+
+  Log_InfoPrint("PASS: known values");
+  return true;
+}
+
+// every length and alignment around the block sizes the faster paths work in
+static bool TestLengthsAndAlignments()
+{
+  PODArray<byte> data;
+  data.Resize(4096 + 64);
+  uint32 seed = 0x12345678;
+  for (uint32 i = 0; i < data.GetSize(); i++)
+  {
+    seed = seed * 1664525 + 1013904223;
+    data[i] = (byte)(seed >> 24);
+  }
+
+  for (uint32 offset = 0; offset < 16; offset++)
+  {
+    for (uint32 length = 0; length <= 4096; length += (length < 300) ? 1 : 61)
+    {
+      const byte* pBytes = data.GetBasePointer() + offset;
+      uint32 expected = ReferenceCRC32(pBytes, length);
+      uint32 actual = HashBytes(pBytes, length);
+      if (actual != expected)
+      {
+        Log_ErrorPrintf("FAIL: %u bytes at offset %u: %08X, expecting %08X", length, offset, actual, expected);
+        return false;
+      }
+    }
+  }
+
+  // hashing in pieces is the same as all at once
+  CRC32 pieces;
+  for (uint32 start = 0, length = 1; start < 4096; start += length, length = length * 2 + 3)
+    pieces.HashBytes(data.GetBasePointer() + start, Min(length, 4096 - start));
+  if (pieces.GetCRC() != ReferenceCRC32(data.GetBasePointer(), 4096))
+  {
+    Log_ErrorPrint("FAIL: hashing in pieces");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: lengths and alignments");
+  return true;
+}
+
+static bool TestCombine()
+{
+  PODArray<byte> data;
+  data.Resize(1000);
+  for (uint32 i = 0; i < data.GetSize(); i++)
+    data[i] = (byte)(i * 7 + (i >> 3));
+
+  uint32 wholeCRC = HashBytes(data.GetBasePointer(), data.GetSize());
+  static const uint32 splits[] = {0, 1, 7, 64, 500, 999, 1000};
+  for (uint32 i = 0; i < countof(splits); i++)
+  {
+    uint32 split = splits[i];
+    uint32 crcA = HashBytes(data.GetBasePointer(), split);
+    uint32 crcB = HashBytes(data.GetBasePointer() + split, data.GetSize() - split);
+    uint32 combined = CRC32::Combine(crcA, crcB, data.GetSize() - split);
+    if (combined != wholeCRC)
+    {
+      Log_ErrorPrintf("FAIL: combine split at %u: %08X, expecting %08X", split, combined, wholeCRC);
+      return false;
+    }
+  }
+
+  Log_InfoPrint("PASS: combine");
+  return true;
+}
+
+DEFINE_TEST_SUITE(CRC32)
+{
+  bool result = true;
+  result &= TestKnownValues();
+  result &= TestLengthsAndAlignments();
+  result &= TestCombine();
+  return result;
+}
@@ -0,0 +1,124 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CSVTable.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/ThreadPool.h"
+Log_SetChannel(TestCSVTable);
+
+static const uint32 TestRecordCount = 3000;
+
+// record i has an integer, a number that's only sometimes whole, a quoted string, and a column that's mostly empty
+static void GetTestText(String& text)
+{
+  text.Assign("id,value,\"na\"\"me\",sparse\r\n");
+  for (uint32 i = 0; i < TestRecordCount; i++)
+  {
+    if (i % 250 == 0)
+      text.AppendString("\n");
+
+    if (i % 2 == 0)
+      text.AppendFormattedString("%d,%u.5,\"item \"\"%u\"\", a\",%s\n", int32(i) - 5, i, i, (i == 1234) ? "7" : "");
+    else
+      text.AppendFormattedString("%d,%u,plain %u,\r\n", int32(i) - 5, i, i);
+  }
+}
+
+static bool TestColumns(ThreadPool* pThreadPool, uint32 chunkSize)
+{
+  String text;
+  GetTestText(text);
+
+  ReadOnlyMemoryByteStream* pStream = ByteStream_CreateReadOnlyMemoryStream(text.GetCharArray(), text.GetLength());
+  CSVTable table;
+  bool result = table.Parse(pThreadPool, pStream, "columns.csv", ',', true, chunkSize) &&
+                table.GetRecordCount() == TestRecordCount && table.GetColumnCount() == 4 &&
+                table.FindColumn("id") == 0 && table.FindColumn("na\"me") == 2 && table.FindColumn("none") == -1 &&
+                table.GetColumnType(0) == CSV_COLUMN_TYPE_INT64 && table.GetColumnType(1) == CSV_COLUMN_TYPE_DOUBLE &&
+                table.GetColumnType(2) == CSV_COLUMN_TYPE_STRING && table.GetColumnType(3) == CSV_COLUMN_TYPE_INT64 &&
+                table.GetDoubleColumn(0) == nullptr && table.GetString(0, 0).IsEmpty();
+
+  const int64* pIds = result ? table.GetInt64Column(0) : nullptr;
+  const double* pValues = result ? table.GetDoubleColumn(1) : nullptr;
+  const int64* pSparse = result ? table.GetInt64Column(3) : nullptr;
+  SmallString expected;
+  for (uint32 i = 0; result && i < TestRecordCount; i++)
+  {
+    if (i % 2 == 0)
+      expected.Format("item \"%u\", a", i);
+    else
+      expected.Format("plain %u", i);
+
+    if (pIds[i] != int64(i) - 5 || pValues[i] != double(i) + ((i % 2 == 0) ? 0.5 : 0.0) ||
+        pSparse[i] != ((i == 1234) ? 7 : 0) || !table.GetString(2, i).Compare(expected))
+    {
+      Log_ErrorPrintf("FAIL: columns, record %u with chunks of %u", i, chunkSize);
+      result = false;
+    }
+  }
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrintf("PASS: columns with chunks of %u", chunkSize);
+  else
+    Log_ErrorPrintf("FAIL: columns with chunks of %u", chunkSize);
+  return result;
+}
+
+// without a header the first line is data, and numbers that wouldn't survive as integers aren't read as them
+static bool TestTypes()
+{
+  static const char text[] = "007\t1\t99999999999999999999\t1e3\t\"\"\n"
+                             "8\t-2\t1\t2\t\"x\"";
+
+  ReadOnlyMemoryByteStream* pStream = ByteStream_CreateReadOnlyMemoryStream(text, sizeof(text) - 1);
+  CSVTable table;
+  bool result = table.Parse(nullptr, pStream, "types.tsv", '\t', false) && table.GetRecordCount() == 2 &&
+                table.GetColumnName(0).IsEmpty() && table.GetColumnType(0) == CSV_COLUMN_TYPE_DOUBLE &&
+                table.GetDoubleColumn(0)[0] == 7.0 && table.GetColumnType(1) == CSV_COLUMN_TYPE_INT64 &&
+                table.GetInt64Column(1)[1] == -2 && table.GetColumnType(2) == CSV_COLUMN_TYPE_DOUBLE &&
+                table.GetColumnType(3) == CSV_COLUMN_TYPE_DOUBLE && table.GetDoubleColumn(3)[0] == 1000.0 &&
+                table.GetColumnType(4) == CSV_COLUMN_TYPE_STRING && table.GetString(4, 0).IsEmpty() &&
+                table.GetString(4, 1).Compare("x");
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: types");
+  else
+    Log_ErrorPrint("FAIL: types");
+  return result;
+}
+
+// a record with the wrong number of fields, or broken quotes, fails the whole parse
+static bool TestErrors(ThreadPool* pThreadPool)
+{
+  static const char* badDocuments[] = {
+    "a,b\n1,2\n1,2,3\n", "a,b\n1\n", "a,b\n\"1,2\n", "a,b\n\"1\"x,2\n", "\"a,b\n",
+  };
+
+  bool result = true;
+  for (uint32 i = 0; i < countof(badDocuments); i++)
+  {
+    ReadOnlyMemoryByteStream* pStream =
+      ByteStream_CreateReadOnlyMemoryStream(badDocuments[i], Y_strlen(badDocuments[i]));
+    CSVTable table;
+    if (table.Parse(pThreadPool, pStream, "bad.csv", ',', true, 4) || table.GetColumnCount() != 0)
+    {
+      Log_ErrorPrintf("FAIL: '%s' parsed without an error", badDocuments[i]);
+      result = false;
+    }
+    pStream->Release();
+  }
+
+  if (result)
+    Log_InfoPrint("PASS: errors");
+  return result;
+}
+
+DEFINE_TEST_SUITE(CSVTable)
+{
+  ThreadPool threadPool(3);
+  return TestColumns(&threadPool, 1024) && TestColumns(&threadPool, 100000000) && TestColumns(nullptr, 4096) &&
+         TestTypes() && TestErrors(&threadPool);
+}
@@ -0,0 +1,184 @@
+#include "TestSuite.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Timer.h"
+#include <cstring>
+Log_SetChannel(TestCString);
+
+static uint64 NextRandom(uint64* pState)
+{
+  uint64 x = *pState;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *pState = x;
+  return x;
+}
+
+// the characters either side of both letter ranges, so the case folding edges get hit
+static const char s_alphabet[] = {'a', 'A', 'b', 'B', 'z', 'Z', '@', '[', '`', '{', '\0', char(0xC1), char(0xE1)};
+
+static void FillRandom(char* pBuffer, uint32 length, uint32 alphabetSize, uint64* pState)
+{
+  for (uint32 i = 0; i < length; i++)
+    pBuffer[i] = s_alphabet[NextRandom(pState) % alphabetSize];
+}
+
+static char ReferenceToLower(char ch)
+{
+  return (ch >= 'A' && ch <= 'Z') ? char(ch + ('a' - 'A')) : ch;
+}
+
+static int32 ReferenceCompareInsensitive(const char* S1, uint32 Length1, const char* S2, uint32 Length2)
+{
+  for (uint32 i = 0; i < Length1 && i < Length2; i++)
+  {
+    int32 difference = (int32)(byte)ReferenceToLower(S1[i]) - (int32)(byte)ReferenceToLower(S2[i]);
+    if (difference != 0)
+      return difference;
+  }
+
+  return (Length1 < Length2) ? -1 : ((Length1 > Length2) ? 1 : 0);
+}
+
+static const char* ReferenceFindLast(const char* SearchString, uint32 Length, char Character)
+{
+  const char* pResult = NULL;
+  for (uint32 i = 0; i < Length; i++)
+  {
+    if (SearchString[i] == Character)
+      pResult = SearchString + i;
+  }
+  return pResult;
+}
+
+static const char* ReferenceFindSubstring(const char* SearchString, uint32 Length, const char* SearchTerm,
+                                          uint32 SearchTermLength)
+{
+  for (uint32 i = 0; i + SearchTermLength <= Length; i++)
+  {
+    if (std::memcmp(SearchString + i, SearchTerm, SearchTermLength) == 0)
+      return SearchString + i;
+  }
+  return NULL;
+}
+
+static bool TestCompareInsensitive()
+{
+  uint64 state = 0x9E3779B97F4A7C15ull;
+  char a[300];
+  char b[300];
+  for (uint32 iteration = 0; iteration < 20000; iteration++)
+  {
+    uint32 length1 = uint32(NextRandom(&state) % 260);
+    uint32 length2 = (NextRandom(&state) % 4 == 0) ? uint32(NextRandom(&state) % 260) : length1;
+    FillRandom(a, length1, 6, &state);
+
+    // mostly the same text in another case, with the odd difference somewhere
+    for (uint32 i = 0; i < length2; i++)
+      b[i] = (i < length1) ? ((a[i] >= 'a' && a[i] <= 'z') ? char(a[i] - ('a' - 'A')) : a[i]) : 'x';
+    if (length2 > 0 && NextRandom(&state) % 2 == 0)
+      FillRandom(b + NextRandom(&state) % length2, 1, countof(s_alphabet), &state);
+
+    // offsets move the loads off any alignment
+    uint32 offset = uint32(NextRandom(&state) % 8);
+    std::memmove(a + offset, a, length1);
+    int32 expected = ReferenceCompareInsensitive(a + offset, length1, b, length2);
+    int32 result = Y_stricmp(a + offset, length1, b, length2);
+    if (result != expected)
+    {
+      Log_ErrorPrintf("Y_stricmp returned %d, expected %d (lengths %u and %u)", result, expected, length1, length2);
+      return false;
+    }
+  }
+
+  return (Y_stricmp("Hello World", 11, "hELLO wORLD", 11) == 0 && Y_stricmp("[", 1, "{", 1) < 0 &&
+          Y_stricmp("@", 1, "`", 1) < 0 && Y_stricmp("Z", 1, "a", 1) > 0);
+}
+
+static bool TestSearches()
+{
+  uint64 state = 0xD1B54A32D192ED03ull;
+  char text[300];
+  char term[40];
+  for (uint32 iteration = 0; iteration < 20000; iteration++)
+  {
+    uint32 length = uint32(NextRandom(&state) % 280);
+    uint32 alphabetSize = 2 + uint32(NextRandom(&state) % 4);
+    FillRandom(text, length, alphabetSize, &state);
+
+    char character = s_alphabet[NextRandom(&state) % alphabetSize];
+    const char* pExpected = ReferenceFindLast(text, length, character);
+    const char* pResult = Y_strnrchr(text, length, character);
+    if (pResult != pExpected)
+    {
+      Log_ErrorPrintf("Y_strnrchr found offset %d, expected %d (length %u)", pResult ? int32(pResult - text) : -1,
+                      pExpected ? int32(pExpected - text) : -1, length);
+      return false;
+    }
+
+    // terms are usually cut from the text so that there is something to find
+    uint32 termLength = uint32(NextRandom(&state) % 36);
+    if (length >= termLength && NextRandom(&state) % 2 == 0)
+      std::memcpy(term, text + (NextRandom(&state) % (length - termLength + 1)), termLength);
+    else
+      FillRandom(term, termLength, alphabetSize, &state);
+
+    pExpected = ReferenceFindSubstring(text, length, term, termLength);
+    pResult = Y_strnstr(text, length, term, termLength);
+    if (pResult != pExpected)
+    {
+      Log_ErrorPrintf("Y_strnstr found offset %d, expected %d (length %u, term length %u)",
+                      pResult ? int32(pResult - text) : -1, pExpected ? int32(pExpected - text) : -1, length,
+                      termLength);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void BenchmarkSearches()
+{
+  static const uint32 TextLength = 4096;
+  static const uint32 Count = 20000;
+  char* text = new char[TextLength];
+  char* other = new char[TextLength];
+  for (uint32 i = 0; i < TextLength; i++)
+  {
+    text[i] = char('a' + (i * 7) % 26);
+    other[i] = char('A' + (i * 7) % 26);
+  }
+
+  uint64 checksum = 0;
+  Timer timer;
+  for (uint32 i = 0; i < Count; i++)
+    checksum += uint32(Y_stricmp(text, TextLength, other, TextLength));
+  double compareTime = timer.GetTimeNanoseconds() / Count;
+
+  timer.Reset();
+  for (uint32 i = 0; i < Count; i++)
+    checksum += uintptr_t(Y_strnrchr(text + 1, TextLength - 1, '!'));
+  double rfindTime = timer.GetTimeNanoseconds() / Count;
+
+  timer.Reset();
+  for (uint32 i = 0; i < Count; i++)
+    checksum += uintptr_t(Y_strnstr(text, TextLength, "ahovcjqxel!", 11));
+  double findTime = timer.GetTimeNanoseconds() / Count;
+
+  Log_InfoPrintf("4KB: Y_stricmp %.1fns, Y_strnrchr %.1fns, Y_strnstr %.1fns (checksum %u)", compareTime, rfindTime,
+                 findTime, uint32(checksum));
+  delete[] other;
+  delete[] text;
+}
+
+DEFINE_TEST_SUITE(CString)
+{
+  if (!TestCompareInsensitive())
+    return false;
+  if (!TestSearches())
+    return false;
+
+  BenchmarkSearches();
+  return true;
+}
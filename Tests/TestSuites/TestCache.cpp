@@ -0,0 +1,170 @@
+#include "TestSuite.h"
+#include "YBaseLib/Cache.h"
+#include "YBaseLib/ConcurrentCache.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(TestCache);
+
+struct EvictionCounts
+{
+  uint32 Evicted;
+  uint32 Dropped;
+  uint32 ValueSum;
+};
+
+static void CountEviction(void* pUserParam, const uint32& key, uint32& value, bool evicted)
+{
+  EvictionCounts* pCounts = static_cast<EvictionCounts*>(pUserParam);
+  if (evicted)
+    pCounts->Evicted++;
+  else
+    pCounts->Dropped++;
+  pCounts->ValueSum += value;
+}
+
+static bool TestBudget()
+{
+  EvictionCounts counts = {};
+  Cache<uint32, uint32> cache(1000);
+  cache.SetEvictionCallback(CountEviction, &counts);
+
+  // ten 100 byte entries fill it, the eleventh pushes out the first
+  for (uint32 i = 0; i < 11; i++)
+    cache.Insert(i, i, 100);
+
+  uint32 value = 0;
+  bool result = (cache.GetByteCount() == 1000 && cache.GetEntryCount() == 10 && counts.Evicted == 1 &&
+                 counts.ValueSum == 0 && !cache.Contains(0) && cache.Find(10, &value) && value == 10);
+
+  // replacing counts the new size, and the old value goes to the callback
+  cache.Insert(10, 1234, 50);
+  result = result && cache.GetByteCount() == 950 && counts.Dropped == 1 && counts.ValueSum == 10 &&
+           *cache.Find(10) == 1234;
+
+  // too large for the whole budget, so the key goes
+  result = result && !cache.Insert(10, 5, 1001) && !cache.Contains(10) && counts.Dropped == 2;
+
+  // shrinking the budget evicts
+  cache.SetByteBudget(300);
+  result = result && cache.GetByteCount() <= 300 && cache.GetEntryCount() == 3;
+
+  CacheStatistics statistics = cache.GetStatistics();
+  result = result && statistics.Hits == 2 && statistics.Misses == 0 && statistics.Insertions == 12 &&
+           statistics.EntryCount == 3 && statistics.Evictions == counts.Evicted;
+  cache.Find(12345);
+  result = result && cache.GetStatistics().Misses == 1;
+
+  cache.Clear();
+  result = result && cache.GetEntryCount() == 0 && cache.GetByteCount() == 0 && counts.Dropped == 5;
+
+  if (result)
+    Log_InfoPrint("PASS: byte budget");
+  else
+    Log_ErrorPrintf("FAIL: byte budget, %u bytes in %u entries", (uint32)cache.GetByteCount(), cache.GetEntryCount());
+  return result;
+}
+
+static bool TestScanResistance()
+{
+  // entries found again are protected from a scan of ones that are never looked at twice
+  Cache<String, uint32> cache(100 * 16);
+  for (uint32 i = 0; i < 50; i++)
+    cache.Insert(String::FromFormat("hot%u", i), i, 16);
+  for (uint32 i = 0; i < 50; i++)
+    cache.Find(String::FromFormat("hot%u", i));
+
+  for (uint32 i = 0; i < 1000; i++)
+    cache.Insert(String::FromFormat("scan%u", i), i, 16);
+
+  uint32 hotCount = 0;
+  for (uint32 i = 0; i < 50; i++)
+    hotCount += cache.Contains(String::FromFormat("hot%u", i)) ? 1 : 0;
+
+  // a single entry larger than what probation can hold evicts from the protected segment instead of itself
+  bool result = (hotCount == 50 && cache.GetByteCount() <= 100 * 16);
+  result = result && cache.Insert("large", 1, 100 * 16) && cache.GetEntryCount() == 1 && cache.Contains("large");
+
+  if (result)
+    Log_InfoPrint("PASS: scan resistance");
+  else
+    Log_ErrorPrintf("FAIL: scan resistance, %u hot entries kept", hotCount);
+  return result;
+}
+
+class CacheThread : public Thread
+{
+public:
+  CacheThread() : m_pCache(nullptr), m_seed(0), m_mismatches(0) {}
+
+  void SetCache(ConcurrentCache<uint32, uint32>* pCache, uint32 seed)
+  {
+    m_pCache = pCache;
+    m_seed = seed;
+  }
+
+  uint32 GetMismatches() const { return m_mismatches; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    uint32 state = m_seed;
+    for (uint32 i = 0; i < 50000; i++)
+    {
+      state = state * 1664525 + 1013904223;
+      uint32 key = (state >> 8) % 4096;
+      uint32 value;
+      if (m_pCache->Find(key, &value))
+        m_mismatches += (value != key * 7) ? 1 : 0;
+      else
+        m_pCache->Insert(key, key * 7, 64);
+    }
+
+    return 0;
+  }
+
+private:
+  ConcurrentCache<uint32, uint32>* m_pCache;
+  uint32 m_seed;
+  uint32 m_mismatches;
+};
+
+static bool TestConcurrent()
+{
+  static const uint32 ThreadCount = 4;
+  ConcurrentCache<uint32, uint32> cache(64 * 1024, 8);
+
+  CacheThread threads[ThreadCount];
+  for (uint32 i = 0; i < ThreadCount; i++)
+  {
+    threads[i].SetCache(&cache, i + 1);
+    threads[i].Start();
+  }
+
+  uint32 mismatches = 0;
+  for (uint32 i = 0; i < ThreadCount; i++)
+  {
+    threads[i].Join();
+    mismatches += threads[i].GetMismatches();
+  }
+
+  CacheStatistics statistics = cache.GetStatistics();
+  bool result = (mismatches == 0 && cache.GetShardCount() == 8 && statistics.ByteCount <= 64 * 1024 &&
+                 statistics.Hits + statistics.Misses == ThreadCount * 50000 && statistics.Hits > 0 &&
+                 statistics.Evictions > 0);
+
+  if (result)
+    Log_InfoPrintf("PASS: concurrent cache, %u hits %u misses", (uint32)statistics.Hits, (uint32)statistics.Misses);
+  else
+    Log_ErrorPrintf("FAIL: concurrent cache, %u mismatches", mismatches);
+  return result;
+}
+
+DEFINE_TEST_SUITE(Cache)
+{
+  bool result = true;
+  result &= TestBudget();
+  result &= TestScanResistance();
+  result &= TestConcurrent();
+  return result;
+}
@@ -0,0 +1,107 @@
+#include "TestSuite.h"
+#include "YBaseLib/CacheAligned.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(TestCacheAligned);
+
+static const uint32 ThreadCount = 4;
+static const uint32 Iterations = 100000;
+
+// Adds to a shared counter, and checks its shard index stays put.
+class AddingThread : public Thread
+{
+public:
+  AddingThread() : m_pCounter(nullptr), m_shardIndexStable(false) {}
+
+  void SetCounter(ShardedCounter<uint64, 4>* pCounter) { m_pCounter = pCounter; }
+  bool IsShardIndexStable() const { return m_shardIndexStable; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    uint32 shardIndex = Y_GetThreadShardIndex();
+    for (uint32 i = 0; i < Iterations; i++)
+      m_pCounter->Increment();
+
+    m_shardIndexStable = (Y_GetThreadShardIndex() == shardIndex);
+    return 0;
+  }
+
+private:
+  ShardedCounter<uint64, 4>* m_pCounter;
+  bool m_shardIndexStable;
+};
+
+struct Neighbours
+{
+  uint32 Before;
+  CacheAligned<volatile uint32> Hot;
+  uint32 After;
+};
+
+struct HeapNeighbours
+{
+  CacheAligned<uint32> Value;
+
+  Y_DECLARE_CACHE_ALIGNED_NEW();
+};
+
+static bool TestLayout()
+{
+  Neighbours neighbours;
+  uintptr_t before = reinterpret_cast<uintptr_t>(&neighbours.Before);
+  uintptr_t hot = reinterpret_cast<uintptr_t>(&neighbours.Hot.Value);
+  uintptr_t after = reinterpret_cast<uintptr_t>(&neighbours.After);
+
+  HeapNeighbours* pHeap = new HeapNeighbours();
+  uintptr_t heap = reinterpret_cast<uintptr_t>(&pHeap->Value.Value);
+  delete pHeap;
+
+  bool result = (sizeof(CacheAligned<uint32>) == Y_CACHE_LINE_SIZE && (hot % Y_CACHE_LINE_SIZE) == 0 &&
+                 (before / Y_CACHE_LINE_SIZE) != (hot / Y_CACHE_LINE_SIZE) &&
+                 (after / Y_CACHE_LINE_SIZE) != (hot / Y_CACHE_LINE_SIZE) && (heap % Y_CACHE_LINE_SIZE) == 0);
+  if (result)
+    Log_InfoPrintf("PASS: layout");
+  else
+    Log_ErrorPrintf("FAIL: layout");
+  return result;
+}
+
+static bool TestShardedCounter()
+{
+  ShardedCounter<uint64, 4> counter;
+  bool result = (counter.GetValue() == 0);
+
+  AddingThread threads[ThreadCount];
+  for (uint32 i = 0; i < ThreadCount; i++)
+  {
+    threads[i].SetCounter(&counter);
+    threads[i].Start();
+  }
+  for (uint32 i = 0; i < ThreadCount; i++)
+  {
+    threads[i].Join();
+    result = result && threads[i].IsShardIndexStable();
+  }
+
+  uint64 value = counter.GetValue();
+  result = result && (value == ThreadCount * Iterations);
+  counter.Add(10);
+  counter.Decrement();
+  result = result && (counter.GetValue() == value + 9);
+  counter.Reset();
+  result = result && (counter.GetValue() == 0);
+
+  if (result)
+    Log_InfoPrintf("PASS: sharded counter");
+  else
+    Log_ErrorPrintf("FAIL: sharded counter, counted %llu", (unsigned long long)value);
+  return result;
+}
+
+DEFINE_TEST_SUITE(CacheAligned)
+{
+  bool result = TestLayout();
+  result &= TestShardedCounter();
+  return result;
+}
@@ -0,0 +1,221 @@
+#include "TestSuite.h"
+#include "YBaseLib/CircularBuffer.h"
+#include "YBaseLib/Log.h"
+Log_SetChannel(TestCircularBuffer);
+
+static uint32 NextRandom(uint32& state)
+{
+  state = state * 1664525 + 1013904223;
+  return state >> 8;
+}
+
+// bytes count up from where they start, so any one out of order or lost shows
+static void FillSequence(byte* pBytes, size_t count, uint32 start)
+{
+  for (size_t i = 0; i < count; i++)
+    pBytes[i] = (byte)(start + i);
+}
+
+static bool CheckSequence(const void* pBytes, size_t count, uint32 start)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    if (reinterpret_cast<const byte*>(pBytes)[i] != (byte)(start + i))
+      return false;
+  }
+
+  return true;
+}
+
+static bool TestReadWrite()
+{
+  CircularBuffer buffer(64);
+  byte bytes[64];
+
+  // filling it exactly leaves no space, and a write that doesn't fit changes nothing
+  FillSequence(bytes, 64, 0);
+  bool result = buffer.Write(bytes, 64) && buffer.GetBufferUsed() == 64 && buffer.GetBufferSpace() == 0;
+  result = result && !buffer.Write(bytes, 1) && buffer.GetBufferUsed() == 64;
+
+  // reading more than there is fails too
+  byte readBytes[65];
+  result = result && !buffer.Read(readBytes, 65) && buffer.Read(readBytes, 64) && CheckSequence(readBytes, 64, 0);
+
+  const void* pReadPointer;
+  size_t byteCount;
+  result = result && buffer.GetBufferUsed() == 0 && !buffer.GetReadPointer(&pReadPointer, &byteCount);
+
+  // a buffer that isn't its own
+  byte storage[16];
+  CircularBuffer external(storage, sizeof(storage));
+  result = result && external.Write(bytes, 10) && external.Read(readBytes, 4) && external.Write(bytes + 10, 10);
+  result = result && external.GetBufferUsed() == 16 && external.Read(readBytes, 16) && CheckSequence(readBytes, 16, 4);
+  return result;
+}
+
+static bool TestWrapAround()
+{
+  CircularBuffer buffer(16);
+  byte bytes[16];
+  byte readBytes[16];
+
+  // with 4 bytes left at the end and 8 free at the start, a write of 10 has to take both
+  FillSequence(bytes, 16, 0);
+  bool result = buffer.Write(bytes, 12) && buffer.Read(readBytes, 8) && CheckSequence(readBytes, 8, 0);
+  result = result && buffer.GetBufferSpace() == 12 && buffer.Write(bytes + 12, 4);
+  FillSequence(bytes, 6, 16);
+  result = result && buffer.Write(bytes, 6) && buffer.GetBufferUsed() == 14 && buffer.GetBufferSpace() == 2 &&
+           buffer.GetContiguousUsedBytes() == 8;
+
+  // it comes back out in the order it went in, across the wrap
+  result = result && buffer.Read(readBytes, 14) && CheckSequence(readBytes, 14, 8) && buffer.GetBufferUsed() == 0;
+
+  // a single write that only fits by going round, the end first, then the start
+  FillSequence(bytes, 16, 0);
+  result = result && buffer.Write(bytes, 14) && buffer.Read(readBytes, 13) && buffer.GetBufferSpace() == 15;
+  FillSequence(bytes, 15, 100);
+  result = result && buffer.Write(bytes, 15) && buffer.GetBufferSpace() == 0;
+  result = result && buffer.Read(readBytes, 1) && readBytes[0] == 13 && buffer.Read(readBytes, 15) &&
+           CheckSequence(readBytes, 15, 100);
+  return result;
+}
+
+static bool TestReadPointers()
+{
+  CircularBuffer buffer(32);
+  byte bytes[32];
+  const void* pFirst;
+  const void* pSecond;
+  size_t firstCount, secondCount;
+
+  // nothing to read, nothing returned
+  bool result = !buffer.GetReadPointers(&pFirst, &firstCount, &pSecond, &secondCount);
+
+  // without a wrap the second run is empty
+  FillSequence(bytes, 32, 0);
+  result = result && buffer.Write(bytes, 20) && buffer.GetReadPointers(&pFirst, &firstCount, &pSecond, &secondCount);
+  result = result && firstCount == 20 && secondCount == 0 && CheckSequence(pFirst, 20, 0);
+
+  // wrapped, the runs are the end then the start, in order
+  buffer.MoveReadPointer(16);
+  FillSequence(bytes, 32, 20);
+  result = result && buffer.Write(bytes, 24) && buffer.GetReadPointers(&pFirst, &firstCount, &pSecond, &secondCount);
+  result = result && firstCount + secondCount == buffer.GetBufferUsed() && firstCount == 16 && secondCount == 12 &&
+           CheckSequence(pFirst, firstCount, 16) && CheckSequence(pSecond, secondCount, 16 + (uint32)firstCount);
+
+  // part of the first run, then the rest of it, leaves the second as the first
+  buffer.MoveReadPointer(10);
+  result = result && buffer.GetReadPointers(&pFirst, &firstCount, &pSecond, &secondCount) && firstCount == 6 &&
+           secondCount == 12 && CheckSequence(pFirst, 6, 26);
+  buffer.MoveReadPointer(firstCount);
+  result = result && buffer.GetReadPointers(&pFirst, &firstCount, &pSecond, &secondCount) && firstCount == 12 &&
+           secondCount == 0 && CheckSequence(pFirst, 12, 32);
+  return result;
+}
+
+static bool TestRandomChanges()
+{
+  // reads and writes of every size, through both interfaces, against a count of what went in and came out
+  static const size_t BUFFER_SIZE = 97;
+  CircularBuffer buffer(BUFFER_SIZE);
+  byte bytes[BUFFER_SIZE];
+  uint32 written = 0;
+  uint32 read = 0;
+  uint32 state = 3;
+
+  bool result = true;
+  for (uint32 i = 0; i < 50000 && result; i++)
+  {
+    switch (NextRandom(state) % 4)
+    {
+      case 0:
+      {
+        size_t count = NextRandom(state) % (buffer.GetBufferSpace() + 1);
+        FillSequence(bytes, count, written);
+        result = buffer.Write(bytes, count);
+        written += (uint32)count;
+      }
+      break;
+
+      case 1:
+      {
+        // as a socket receives, straight into the buffer as much as one pointer allows
+        void* pWritePointer;
+        size_t count = 1;
+        if (buffer.GetWritePointer(&pWritePointer, &count))
+        {
+          count = Min(count, (size_t)(NextRandom(state) % 64) + 1);
+          FillSequence(reinterpret_cast<byte*>(pWritePointer), count, written);
+          buffer.MoveWritePointer(count);
+          written += (uint32)count;
+        }
+        else
+        {
+          result = buffer.GetContiguousBufferSpace() == 0;
+        }
+      }
+      break;
+
+      case 2:
+      {
+        size_t count = NextRandom(state) % (buffer.GetBufferUsed() + 1);
+        result = buffer.Read(bytes, count) && CheckSequence(bytes, count, read);
+        read += (uint32)count;
+      }
+      break;
+
+      case 3:
+      {
+        // as a socket sends, from both runs at once
+        const void* pFirst;
+        const void* pSecond;
+        size_t firstCount, secondCount;
+        if (buffer.GetReadPointers(&pFirst, &firstCount, &pSecond, &secondCount))
+        {
+          result = CheckSequence(pFirst, firstCount, read) &&
+                   CheckSequence(pSecond, secondCount, read + (uint32)firstCount);
+          size_t count = Min(firstCount + secondCount, (size_t)(NextRandom(state) % 64) + 1);
+          size_t firstPart = Min(count, firstCount);
+          buffer.MoveReadPointer(firstPart);
+          if (count > firstPart)
+            buffer.MoveReadPointer(count - firstPart);
+          read += (uint32)count;
+        }
+      }
+      break;
+    }
+
+    result = result && buffer.GetBufferUsed() == (size_t)(written - read);
+  }
+
+  return result;
+}
+
+DEFINE_TEST_SUITE(CircularBuffer)
+{
+  bool readWriteResult = TestReadWrite();
+  if (readWriteResult)
+    Log_InfoPrint("PASS: read and write");
+  else
+    Log_ErrorPrint("FAIL: read and write");
+
+  bool wrapResult = TestWrapAround();
+  if (wrapResult)
+    Log_InfoPrint("PASS: wrap around");
+  else
+    Log_ErrorPrint("FAIL: wrap around");
+
+  bool readPointersResult = TestReadPointers();
+  if (readPointersResult)
+    Log_InfoPrint("PASS: read pointers");
+  else
+    Log_ErrorPrint("FAIL: read pointers");
+
+  bool randomResult = TestRandomChanges();
+  if (randomResult)
+    Log_InfoPrint("PASS: random changes");
+  else
+    Log_ErrorPrint("FAIL: random changes");
+
+  return readWriteResult && wrapResult && readPointersResult && randomResult;
+}
@@ -0,0 +1,346 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Compression.h"
+#include "YBaseLib/CompressionByteStream.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/ZLibHelpers.h"
+#include <cstring>
+Log_SetChannel(TestCompression);
+
+// compressible text-like data, or noise that doesn't compress
+static void MakeData(uint32 size, bool compressible, PODArray<byte>* pData)
+{
+  pData->Resize(size);
+  uint32 state = 12345;
+  for (uint32 i = 0; i < size; i++)
+  {
+    state = state * 1103515245 + 12345;
+    (*pData)[i] = compressible ? (byte)('a' + ((i / 7) % 13) + ((state >> 28) == 0)) : (byte)(state >> 24);
+  }
+}
+
+static bool TestRoundTrip(COMPRESSION_CODEC codec, uint32 size, bool compressible, int32 level)
+{
+  PODArray<byte> data, compressed, decompressed;
+  MakeData(size, compressible, &data);
+  compressed.Resize(Compression::GetCompressedSizeUpperBound(codec, size));
+  decompressed.Resize(size + 1);
+
+  uint32 compressedSize, decompressedSize;
+  if (!Compression::CompressBuffer(codec, compressed.GetBasePointer(), compressed.GetSize(), &compressedSize,
+                                   data.GetBasePointer(), size, level) ||
+      !Compression::DecompressBuffer(codec, decompressed.GetBasePointer(), decompressed.GetSize(), &decompressedSize,
+                                     compressed.GetBasePointer(), compressedSize) ||
+      decompressedSize != size || (size > 0 && std::memcmp(decompressed.GetBasePointer(), data.GetBasePointer(), size)))
+  {
+    Log_ErrorPrintf("FAIL: %s of %u bytes at level %d", Compression::GetCodecName(codec), size, level);
+    return false;
+  }
+
+  if (codec != COMPRESSION_CODEC_NONE && compressible && size >= 4096 && compressedSize >= size / 2)
+  {
+    Log_ErrorPrintf("FAIL: %s only compressed %u bytes to %u", Compression::GetCodecName(codec), size,
+                    compressedSize);
+    return false;
+  }
+
+  return true;
+}
+
+// too little room and damaged data fail rather than overrunning
+static bool TestFailures(COMPRESSION_CODEC codec)
+{
+  PODArray<byte> data, compressed, decompressed;
+  MakeData(20000, true, &data);
+  compressed.Resize(Compression::GetCompressedSizeUpperBound(codec, data.GetSize()));
+  decompressed.Resize(data.GetSize());
+
+  uint32 compressedSize, decompressedSize;
+  if (!Compression::CompressBuffer(codec, compressed.GetBasePointer(), compressed.GetSize(), &compressedSize,
+                                   data.GetBasePointer(), data.GetSize()) ||
+      Compression::DecompressBuffer(codec, decompressed.GetBasePointer(), decompressed.GetSize() - 1,
+                                    &decompressedSize, compressed.GetBasePointer(), compressedSize) ||
+      Compression::DecompressBuffer(codec, decompressed.GetBasePointer(), decompressed.GetSize(), &decompressedSize,
+                                    compressed.GetBasePointer(), compressedSize / 2))
+  {
+    Log_ErrorPrintf("FAIL: %s failures", Compression::GetCodecName(codec));
+    return false;
+  }
+
+  return true;
+}
+
+// reads the whole decompressed stream in uneven pieces, checking it against the data and that it ends there
+static bool ReadDecompressed(ByteStream* pCompressedStream, COMPRESSION_CODEC codec, const PODArray<byte>& data,
+                             uint32 size)
+{
+  CompressionByteStream* pStream = CompressionByteStream::CreateDecompressor(pCompressedStream, codec, 1000);
+  PODArray<byte> contents;
+  contents.Resize(size + 16);
+  uint32 position = 0;
+  for (uint32 readSize = 1; position < size; readSize = readSize * 3 + 1)
+  {
+    uint32 count = pStream->Read(contents.GetBasePointer() + position, Min(readSize, size - position));
+    if (count == 0)
+      break;
+
+    position += count;
+  }
+
+  bool result = (position == size && (size == 0 || std::memcmp(contents.GetBasePointer(), data.GetBasePointer(),
+                                                               size) == 0));
+  if (size == data.GetSize())
+    result = result && pStream->Read(contents.GetBasePointer(), 16) == 0 && pStream->IsEndOfStream();
+
+  result = result && !pStream->InErrorState();
+  pStream->Release();
+  return result;
+}
+
+static bool TestStreams(COMPRESSION_CODEC codec)
+{
+  PODArray<byte> data;
+  MakeData(1000000, true, &data);
+
+  // small and large writes, with a flush half way that makes everything so far readable
+  GrowableMemoryByteStream* pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+  CompressionByteStream* pStream = CompressionByteStream::CreateCompressor(pMemoryStream, codec);
+  bool result = (pStream != nullptr);
+  uint32 position = 0;
+  while (result && position < 500000)
+  {
+    uint32 count = Min((position % 3 == 0) ? (uint32)7 : (uint32)100000, 500000 - position);
+    result = pStream->Write2(data.GetBasePointer() + position, count);
+    position += count;
+  }
+
+  for (uint32 i = 0; i < 100 && result; i++)
+    result = pStream->WriteByte(data[position++]);
+
+  result = result && pStream->Flush();
+  if (result)
+  {
+    ReadOnlyMemoryByteStream* pFlushedStream =
+      ByteStream_CreateReadOnlyMemoryStream(pMemoryStream->GetMemoryPointer(), (size_t)pMemoryStream->GetSize());
+    result = ReadDecompressed(pFlushedStream, codec, data, position);
+    pFlushedStream->Release();
+  }
+
+  result = result && pStream->Write2(data.GetBasePointer() + position, data.GetSize() - position) &&
+           pStream->GetPosition() == data.GetSize() && pStream->Commit();
+  if (pStream != nullptr)
+    pStream->Release();
+
+  // then all of it, and the whole data as a buffer, and cut short
+  uint32 compressedSize = (uint32)pMemoryStream->GetSize();
+  PODArray<byte> decompressed;
+  decompressed.Resize(data.GetSize());
+  uint32 decompressedSize;
+  pMemoryStream->SeekAbsolute(0);
+  result = result && ReadDecompressed(pMemoryStream, codec, data, data.GetSize()) &&
+           (codec == COMPRESSION_CODEC_LZ4 ||
+            (Compression::DecompressBuffer(codec, decompressed.GetBasePointer(), decompressed.GetSize(),
+                                           &decompressedSize, pMemoryStream->GetMemoryPointer(), compressedSize) &&
+             decompressedSize == data.GetSize()));
+  if (result && codec != COMPRESSION_CODEC_NONE)
+  {
+    ReadOnlyMemoryByteStream* pTruncatedStream =
+      ByteStream_CreateReadOnlyMemoryStream(pMemoryStream->GetMemoryPointer(), compressedSize / 2);
+    CompressionByteStream* pDecompressStream = CompressionByteStream::CreateDecompressor(pTruncatedStream, codec);
+    result = !pDecompressStream->Read2(decompressed.GetBasePointer(), decompressed.GetSize()) &&
+             pDecompressStream->InErrorState();
+    pDecompressStream->Release();
+    pTruncatedStream->Release();
+  }
+
+  pMemoryStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrintf("FAIL: %s streams", Compression::GetCodecName(codec));
+    return false;
+  }
+
+  return true;
+}
+
+// small records that share most of their text, like rows serialized one at a time
+static void MakeRecord(uint32 index, PODArray<byte>* pRecord)
+{
+  static const char* names[] = {"alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel"};
+  static const char* states[] = {"pending", "running", "complete", "failed"};
+  uint32 state = index * 2654435761u + 1;
+  char buffer[512];
+  int length = Y_snprintf(buffer, sizeof(buffer),
+                          "{\"id\": %u, \"name\": \"%s-%u\", \"owner\": \"%s\", \"state\": \"%s\", "
+                          "\"created\": \"2024-%02u-%02uT%02u:%02u:00Z\", \"priority\": %u, \"tags\": "
+                          "[\"%s\", \"%s\"], \"description\": \"scheduled maintenance task for the %s cluster\"}",
+                          index, names[state % 8], (state >> 8) % 1000, names[(state >> 3) % 8],
+                          states[(state >> 6) % 4], (state >> 9) % 12 + 1, (state >> 13) % 28 + 1,
+                          (state >> 17) % 24, (state >> 21) % 60, (state >> 25) % 5, names[(state >> 4) % 8],
+                          names[(state >> 7) % 8], names[(state >> 11) % 8]);
+  pRecord->Resize((uint32)length);
+  std::memcpy(pRecord->GetBasePointer(), buffer, length);
+}
+
+// compresses records with reused contexts, and a trained dictionary does better than none
+static bool TestContexts(COMPRESSION_CODEC codec, int32 level)
+{
+  static const uint32 SAMPLE_COUNT = 2000;
+  static const uint32 RECORD_COUNT = 200;
+  PODArray<byte> samples;
+  PODArray<uint32> sampleSizes;
+  PODArray<const void*> samplePointers;
+  PODArray<byte> record;
+  for (uint32 i = 0; i < SAMPLE_COUNT; i++)
+  {
+    MakeRecord(i, &record);
+    sampleSizes.Add(record.GetSize());
+    samples.AddRange(record.GetBasePointer(), record.GetSize());
+  }
+  for (uint32 i = 0, offset = 0; i < SAMPLE_COUNT; offset += sampleSizes[i++])
+    samplePointers.Add(samples.GetBasePointer() + offset);
+
+  PODArray<byte> dictionary;
+  bool result = Compression::TrainDictionary(samplePointers.GetBasePointer(), sampleSizes.GetBasePointer(),
+                                             SAMPLE_COUNT, 8192, &dictionary) &&
+                dictionary.GetSize() > 0 && dictionary.GetSize() <= 8192;
+
+  Compressor compressor, dictionaryCompressor;
+  Decompressor decompressor, dictionaryDecompressor;
+  result = result && compressor.Initialize(codec, level) && dictionaryCompressor.Initialize(codec, level) &&
+           dictionaryCompressor.SetDictionary(dictionary.GetBasePointer(), dictionary.GetSize()) &&
+           decompressor.Initialize(codec) && dictionaryDecompressor.Initialize(codec) &&
+           dictionaryDecompressor.SetDictionary(dictionary.GetBasePointer(), dictionary.GetSize());
+
+  uint64 plainSize = 0, dictionarySize = 0;
+  PODArray<byte> compressed, decompressed;
+  decompressed.Resize(1024);
+  for (uint32 i = 0; i < RECORD_COUNT && result; i++)
+  {
+    // records the dictionary wasn't trained on
+    MakeRecord(SAMPLE_COUNT + i, &record);
+    compressed.Resize(dictionaryCompressor.GetCompressedSizeUpperBound(record.GetSize()));
+    uint32 compressedSize, decompressedSize;
+    result = compressor.Compress(compressed.GetBasePointer(), compressed.GetSize(), &compressedSize,
+                                 record.GetBasePointer(), record.GetSize()) &&
+             Compression::DecompressBuffer(codec, decompressed.GetBasePointer(), decompressed.GetSize(),
+                                           &decompressedSize, compressed.GetBasePointer(), compressedSize) &&
+             decompressor.Decompress(decompressed.GetBasePointer(), decompressed.GetSize(), &decompressedSize,
+                                     compressed.GetBasePointer(), compressedSize) &&
+             decompressedSize == record.GetSize() &&
+             std::memcmp(decompressed.GetBasePointer(), record.GetBasePointer(), record.GetSize()) == 0;
+    plainSize += compressedSize;
+
+    result = result &&
+             dictionaryCompressor.Compress(compressed.GetBasePointer(), compressed.GetSize(), &compressedSize,
+                                           record.GetBasePointer(), record.GetSize()) &&
+             dictionaryDecompressor.Decompress(decompressed.GetBasePointer(), decompressed.GetSize(),
+                                               &decompressedSize, compressed.GetBasePointer(), compressedSize) &&
+             decompressedSize == record.GetSize() &&
+             std::memcmp(decompressed.GetBasePointer(), record.GetBasePointer(), record.GetSize()) == 0;
+    dictionarySize += compressedSize;
+
+    // deflate data names its dictionary, so it can't be read without it
+    if (result && codec == COMPRESSION_CODEC_DEFLATE)
+    {
+      result = !decompressor.Decompress(decompressed.GetBasePointer(), decompressed.GetSize(), &decompressedSize,
+                                        compressed.GetBasePointer(), compressedSize);
+    }
+  }
+
+  if (!result || (codec != COMPRESSION_CODEC_NONE && dictionarySize * 3 > plainSize * 2))
+  {
+    Log_ErrorPrintf("FAIL: %s contexts at level %d, %u bytes plain and %u with a dictionary",
+                    Compression::GetCodecName(codec), level, (uint32)plainSize, (uint32)dictionarySize);
+    return false;
+  }
+
+  Log_InfoPrintf("%s records at level %d: %u bytes plain, %u with a dictionary", Compression::GetCodecName(codec),
+                 level, (uint32)plainSize, (uint32)dictionarySize);
+  return true;
+}
+
+#ifdef HAVE_ZLIB
+
+// the stream helpers read what the buffer helpers write, and fail when the destination is too small
+static bool TestZLibStreamHelpers()
+{
+  PODArray<byte> data, decompressed;
+  MakeData(100000, true, &data);
+  decompressed.Resize(data.GetSize());
+
+  uint32 decompressedSize = 0;
+  GrowableMemoryByteStream* pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+  bool result = ZLibHelpers::WriteDeflatedDataToStream(pMemoryStream, data.GetBasePointer(), data.GetSize()) &&
+                pMemoryStream->SeekAbsolute(0) &&
+                ZLibHelpers::ReadDeflatedDataFromStream(decompressed.GetBasePointer(), decompressed.GetSize(),
+                                                        &decompressedSize, pMemoryStream) &&
+                decompressedSize == data.GetSize() &&
+                std::memcmp(decompressed.GetBasePointer(), data.GetBasePointer(), data.GetSize()) == 0 &&
+                ZLibHelpers::ReadDeflatedDataFromBuffer(decompressed.GetBasePointer(), decompressed.GetSize(),
+                                                        &decompressedSize, pMemoryStream->GetMemoryPointer(),
+                                                        (uint32)pMemoryStream->GetSize()) &&
+                pMemoryStream->SeekAbsolute(0) &&
+                !ZLibHelpers::ReadDeflatedDataFromStream(decompressed.GetBasePointer(), decompressed.GetSize() - 1,
+                                                         &decompressedSize, pMemoryStream);
+  pMemoryStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: zlib stream helpers");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: zlib stream helpers");
+  return true;
+}
+
+#endif
+
+DEFINE_TEST_SUITE(Compression)
+{
+  static const uint32 sizes[] = {0, 1, 100, 4096, 65536, 1000000};
+  bool result = true;
+  for (uint32 codecIndex = 0; codecIndex < COMPRESSION_CODEC_COUNT; codecIndex++)
+  {
+    COMPRESSION_CODEC codec = (COMPRESSION_CODEC)codecIndex;
+    if (!Compression::IsCodecAvailable(codec))
+    {
+      // not built in, so it has to fail
+      uint32 compressedSize;
+      byte buffer[16];
+      NullByteStream* pNullStream = ByteStream_CreateNullStream();
+      result &= !Compression::CompressBuffer(codec, buffer, sizeof(buffer), &compressedSize, "abc", 3) &&
+                CompressionByteStream::CreateDecompressor(pNullStream, codec) == nullptr;
+      pNullStream->Release();
+      Log_InfoPrintf("%s is not built in", Compression::GetCodecName(codec));
+      continue;
+    }
+
+    bool codecResult = true;
+    for (uint32 i = 0; i < countof(sizes); i++)
+    {
+      codecResult &= TestRoundTrip(codec, sizes[i], true, 0);
+      codecResult &= TestRoundTrip(codec, sizes[i], false, 0);
+      codecResult &= TestRoundTrip(codec, sizes[i], true, 9);
+    }
+
+    if (codec != COMPRESSION_CODEC_NONE)
+      codecResult &= TestFailures(codec);
+
+    codecResult &= TestStreams(codec);
+    codecResult &= TestContexts(codec, 0);
+    codecResult &= TestContexts(codec, 9);
+
+    if (codecResult)
+      Log_InfoPrintf("PASS: %s", Compression::GetCodecName(codec));
+
+    result &= codecResult;
+  }
+
+#ifdef HAVE_ZLIB
+  result &= TestZLibStreamHelpers();
+#endif
+
+  return result;
+}
@@ -0,0 +1,160 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/ChunkIndex.h"
+#include "YBaseLib/ContentChunker.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include <cstring>
+Log_SetChannel(TestContentChunker);
+
+static void MakeRandomData(PODArray<byte>* pData, uint32 size, uint32 seed)
+{
+  pData->Resize(size);
+  for (uint32 i = 0; i < size; i++)
+  {
+    seed = seed * 1664525 + 1013904223;
+    (*pData)[i] = (byte)(seed >> 24);
+  }
+}
+
+// chunks follow on from each other, cover the data and keep to the sizes
+static bool CheckChunks(const ContentChunker& chunker, const PODArray<CONTENT_CHUNK>& chunks, uint64 length)
+{
+  uint64 offset = 0;
+  for (uint32 i = 0; i < chunks.GetSize(); i++)
+  {
+    const CONTENT_CHUNK& chunk = chunks[i];
+    bool lastChunk = (i == chunks.GetSize() - 1);
+    if (chunk.Offset != offset || chunk.Size == 0 || chunk.Size > chunker.GetMaximumSize() ||
+        (!lastChunk && chunk.Size < chunker.GetMinimumSize()))
+    {
+      return false;
+    }
+
+    offset += chunk.Size;
+  }
+
+  return (offset == length);
+}
+
+static bool TestChunking()
+{
+  ContentChunker chunker(1024, 4096, 16384);
+  PODArray<byte> data;
+  MakeRandomData(&data, 1024 * 1024, 1234);
+
+  PODArray<CONTENT_CHUNK> bufferChunks;
+  chunker.ChunkBuffer(data.GetBasePointer(), data.GetSize(), &bufferChunks);
+  uint32 averageSize = data.GetSize() / Max(bufferChunks.GetSize(), 1u);
+  if (!CheckChunks(chunker, bufferChunks, data.GetSize()) || averageSize < chunker.GetAverageSize() / 2 ||
+      averageSize > chunker.GetAverageSize() * 2)
+  {
+    Log_ErrorPrintf("FAIL: chunking a buffer (%u chunks)", bufferChunks.GetSize());
+    return false;
+  }
+
+  // streams find the same chunks
+  PODArray<CONTENT_CHUNK> streamChunks;
+  ByteStream* pStream = ByteStream_CreateReadOnlyMemoryStream(data.GetBasePointer(), data.GetSize());
+  bool result = chunker.ChunkStream(pStream, data.GetSize(), &streamChunks) &&
+                streamChunks.GetSize() == bufferChunks.GetSize();
+  for (uint32 i = 0; i < streamChunks.GetSize() && result; i++)
+  {
+    result = (streamChunks[i].Offset == bufferChunks[i].Offset && streamChunks[i].Size == bufferChunks[i].Size &&
+              streamChunks[i].Digest == bufferChunks[i].Digest);
+  }
+  pStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: chunking a stream");
+    return false;
+  }
+
+  // data that's all one value has no boundaries, and is cut at the maximum size
+  PODArray<byte> zeros;
+  zeros.Resize(100000);
+  zeros.ZeroContents();
+  PODArray<CONTENT_CHUNK> zeroChunks;
+  chunker.ChunkBuffer(zeros.GetBasePointer(), zeros.GetSize(), &zeroChunks);
+  if (!CheckChunks(chunker, zeroChunks, zeros.GetSize()) || zeroChunks.GetSize() != 7 ||
+      zeroChunks[0].Digest != zeroChunks[5].Digest || zeroChunks[0].Digest == zeroChunks[6].Digest)
+  {
+    Log_ErrorPrint("FAIL: chunking uniform data");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: chunking");
+  return true;
+}
+
+static bool TestIndex()
+{
+  ContentChunker chunker(1024, 4096, 16384);
+  PODArray<byte> original;
+  MakeRandomData(&original, 512 * 1024, 5678);
+
+  // the same data with bytes inserted in the middle
+  PODArray<byte> changed;
+  changed.Resize(original.GetSize() + 100);
+  std::memcpy(changed.GetBasePointer(), original.GetBasePointer(), 200000);
+  std::memset(changed.GetBasePointer() + 200000, 0xAB, 100);
+  std::memcpy(changed.GetBasePointer() + 200100, original.GetBasePointer() + 200000, original.GetSize() - 200000);
+
+  PODArray<CONTENT_CHUNK> originalChunks, changedChunks;
+  chunker.ChunkBuffer(original.GetBasePointer(), original.GetSize(), &originalChunks);
+  chunker.ChunkBuffer(changed.GetBasePointer(), changed.GetSize(), &changedChunks);
+
+  ChunkIndex index;
+  PODArray<uint32> missing;
+  uint32 addedCount = index.AddChunks(originalChunks.GetBasePointer(), originalChunks.GetSize(), 1);
+  index.FindMissingChunks(changedChunks.GetBasePointer(), changedChunks.GetSize(), &missing);
+  const ChunkIndex::Location* pLocation = index.FindChunk(originalChunks[3].Digest);
+  bool result = addedCount == originalChunks.GetSize() && index.GetChunkCount() == addedCount &&
+                !index.AddChunk(originalChunks[0].Digest, ChunkIndex::Location()) && missing.GetSize() > 0 &&
+                missing.GetSize() <= 3 && pLocation != nullptr && pLocation->PackID == 1 &&
+                pLocation->Offset == originalChunks[3].Offset && pLocation->Size == originalChunks[3].Size;
+  if (!result)
+  {
+    Log_ErrorPrintf("FAIL: deduplicating (%u of %u chunks missing)", missing.GetSize(), changedChunks.GetSize());
+    return false;
+  }
+
+  // the missing chunks are added as a second pack, then the index goes round a stream
+  for (uint32 i = 0; i < missing.GetSize(); i++)
+    index.AddChunks(&changedChunks[missing[i]], 1, 2);
+
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  ChunkIndex loadedIndex;
+  result = index.Save(pStream) && pStream->SeekAbsolute(0) && loadedIndex.Load(pStream) &&
+           loadedIndex.GetChunkCount() == index.GetChunkCount();
+  for (uint32 i = 0; i < changedChunks.GetSize() && result; i++)
+  {
+    const ChunkIndex::Location* pLoaded = loadedIndex.FindChunk(changedChunks[i].Digest);
+    const ChunkIndex::Location* pSaved = index.FindChunk(changedChunks[i].Digest);
+    result = (pLoaded != nullptr && pSaved != nullptr && pLoaded->PackID == pSaved->PackID &&
+              pLoaded->Offset == pSaved->Offset && pLoaded->Size == pSaved->Size);
+  }
+
+  // a truncated index loads nothing
+  ByteStream* pTruncatedStream =
+    ByteStream_CreateReadOnlyMemoryStream(pStream->GetMemoryPointer(), (size_t)pStream->GetSize() - 5);
+  result = result && !loadedIndex.Load(pTruncatedStream) && loadedIndex.GetChunkCount() == 0;
+  pTruncatedStream->Release();
+  pStream->Release();
+
+  result = result && index.RemovePack(2) == missing.GetSize() && index.GetChunkCount() == originalChunks.GetSize() &&
+           index.RemoveChunk(originalChunks[0].Digest) && !index.RemoveChunk(originalChunks[0].Digest);
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: saving and loading the index");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: index");
+  return true;
+}
+
+DEFINE_TEST_SUITE(ContentChunker)
+{
+  return TestChunking() && TestIndex();
+}
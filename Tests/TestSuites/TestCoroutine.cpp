@@ -0,0 +1,173 @@
+#include "TestSuite.h"
+#include "YBaseLib/Coroutine.h"
+#include "YBaseLib/Log.h"
+Log_SetChannel(TestCoroutine);
+
+#if Y_HAVE_COROUTINES
+
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/Thread.h"
+#include <cstring>
+
+static Coroutine<uint32> Add(uint32 a, uint32 b)
+{
+  co_return a + b;
+}
+
+static Coroutine<> Accumulate(uint32* pTotal, uint32 count)
+{
+  for (uint32 i = 0; i < count; i++)
+    *pTotal = co_await Add(*pTotal, i);
+}
+
+static bool TestChaining()
+{
+  // nothing runs until it's started, and awaiting runs each call to the end before carrying on
+  uint32 total = 0;
+  Coroutine<> accumulate = Accumulate(&total, 1000);
+  bool result = total == 0 && !accumulate.IsDone();
+  accumulate.Start();
+  result = result && accumulate.IsDone() && total == 999 * 1000 / 2;
+
+  Coroutine<uint32> add = Add(2, 3);
+  add.Start();
+  result = result && add.IsDone() && add.GetResult() == 5;
+
+  // moving hands the frame over
+  Coroutine<uint32> moved = std::move(add);
+  result = result && !add.IsValid() && moved.IsValid() && moved.GetResult() == 5;
+
+  if (result)
+    Log_InfoPrintf("PASS: chaining");
+  else
+    Log_ErrorPrintf("FAIL: chaining");
+  return result;
+}
+
+static Y_ATOMIC_DECL uint32 s_completedCount = 0;
+static Y_ATOMIC_DECL uint32 s_wrongThreadCount = 0;
+
+static Coroutine<> HopBetweenQueues(TaskQueue* pFirstQueue, TaskQueue* pSecondQueue)
+{
+  Thread::ThreadIdType callerThread = Thread::GetCurrentThreadId();
+  for (uint32 i = 0; i < 4; i++)
+  {
+    TaskQueue* pQueue = (i & 1) ? pSecondQueue : pFirstQueue;
+    co_await SwitchToTaskQueue(pQueue);
+    Thread::ThreadIdType currentThread = Thread::GetCurrentThreadId();
+    if (currentThread != pQueue->GetWorkerThreadID(0) || currentThread == callerThread)
+    {
+      Y_AtomicIncrement(s_wrongThreadCount);
+    }
+  }
+
+  Y_AtomicIncrement(s_completedCount);
+}
+
+static bool TestSwitchToTaskQueue()
+{
+  static const uint32 COROUTINE_COUNT = 1000;
+  TaskQueue firstQueue, secondQueue;
+  if (!firstQueue.Initialize(TaskQueue::DefaultQueueSize, 1) || !secondQueue.Initialize(TaskQueue::DefaultQueueSize, 1))
+  {
+    Log_ErrorPrintf("FAIL: initializing the task queues");
+    return false;
+  }
+
+  // detached, so each frees itself on whichever worker it finishes on
+  for (uint32 i = 0; i < COROUTINE_COUNT; i++)
+    HopBetweenQueues(&firstQueue, &secondQueue).StartDetached();
+  while (Y_AtomicLoad(s_completedCount) < COROUTINE_COUNT)
+    Thread::Yield();
+
+  firstQueue.ExitWorkers();
+  secondQueue.ExitWorkers();
+
+  bool result = s_wrongThreadCount == 0;
+  if (result)
+    Log_InfoPrintf("PASS: switch to task queue");
+  else
+    Log_ErrorPrintf("FAIL: switch to task queue, %u resumed on the wrong thread", s_wrongThreadCount);
+  return result;
+}
+
+static const char s_testFileName[] = "TestCoroutine.tmp";
+
+// writes the file in chunks and reads it back, each transfer waiting for the previous one
+static Coroutine<bool> CopyThroughFile(AsyncFileStream* pStream, const byte* pData, uint32 size, byte* pReadBack)
+{
+  static const uint32 CHUNK_SIZE = 4096;
+  for (uint32 offset = 0; offset < size; offset += CHUNK_SIZE)
+  {
+    uint32 bytesWritten;
+    uint32 chunkSize = Min(CHUNK_SIZE, size - offset);
+    if (!co_await AsyncFileWrite(pStream, pData + offset, offset, chunkSize, &bytesWritten) ||
+        bytesWritten != chunkSize)
+    {
+      co_return false;
+    }
+  }
+
+  // reads stop short at the end of the file
+  uint32 bytesRead;
+  bool readSucceeded = co_await AsyncFileRead(pStream, pReadBack, 0, size + 100, &bytesRead);
+  co_return readSucceeded && bytesRead == size;
+}
+
+static bool TestAsyncFile(TaskQueue* pCompletionQueue)
+{
+  static const uint32 FILE_SIZE = 100000;
+  byte* pData = new byte[FILE_SIZE];
+  byte* pReadBack = new byte[FILE_SIZE + 100];
+  for (uint32 i = 0; i < FILE_SIZE; i++)
+    pData[i] = byte(i * 7 + (i >> 8));
+
+  bool result = false;
+  {
+    AsyncFileQueue queue;
+    AsyncFileStream* pStream;
+    if (queue.Initialize(16, pCompletionQueue) &&
+        queue.OpenFile(s_testFileName, BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_WRITE |
+                                         BYTESTREAM_OPEN_TRUNCATE,
+                       &pStream))
+    {
+      Coroutine<bool> copy = CopyThroughFile(pStream, pData, FILE_SIZE, pReadBack);
+      copy.Start();
+      queue.WaitForIdle();
+      pStream->Release();
+
+      result = copy.IsDone() && copy.GetResult() && std::memcmp(pData, pReadBack, FILE_SIZE) == 0;
+    }
+  }
+
+  FileSystem::DeleteFile(s_testFileName);
+  delete[] pReadBack;
+  delete[] pData;
+
+  if (result)
+    Log_InfoPrintf("PASS: async file, completions on %s", pCompletionQueue ? "a task queue" : "the queue's thread");
+  else
+    Log_ErrorPrintf("FAIL: async file, completions on %s", pCompletionQueue ? "a task queue" : "the queue's thread");
+  return result;
+}
+
+#endif // Y_HAVE_COROUTINES
+
+DEFINE_TEST_SUITE(Coroutine)
+{
+#if Y_HAVE_COROUTINES
+  bool result = true;
+  result &= TestChaining();
+  result &= TestSwitchToTaskQueue();
+  result &= TestAsyncFile(nullptr);
+
+  TaskQueue completionQueue;
+  result &= completionQueue.Initialize(TaskQueue::DefaultQueueSize, 2) && TestAsyncFile(&completionQueue);
+  completionQueue.ExitWorkers();
+  return result;
+#else
+  Log_InfoPrintf("SKIP: coroutines need C++20");
+  return true;
+#endif
+}
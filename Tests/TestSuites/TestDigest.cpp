@@ -0,0 +1,167 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Digest.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/MD5Digest.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/SHA1Digest.h"
+#include "YBaseLib/SHA256Digest.h"
+#include "YBaseLib/ThreadPool.h"
+#include "YBaseLib/XXHash64Digest.h"
+Log_SetChannel(TestDigest);
+
+// the known values are for "", "abc" and these 1000 bytes
+static void MakePatternData(PODArray<byte>* pData)
+{
+  pData->Resize(1000);
+  for (uint32 i = 0; i < pData->GetSize(); i++)
+    (*pData)[i] = (byte)(i * 7 + (i >> 3));
+}
+
+template<class T>
+static void DigestToString(T* pDigest, char* hexString, uint32 hexStringSize)
+{
+  byte digest[T::DIGEST_SIZE];
+  pDigest->Final(digest);
+  Y_makehexstring(digest, T::DIGEST_SIZE, hexString, hexStringSize);
+}
+
+template<class T>
+static bool CheckDigest(const char* name, const void* pData, size_t length, const char* expectedHex)
+{
+  char hexString[T::DIGEST_SIZE * 2 + 1];
+  T digest;
+  digest.Update(pData, length);
+  DigestToString(&digest, hexString, sizeof(hexString));
+  if (Y_stricmp(hexString, expectedHex) != 0)
+  {
+    Log_ErrorPrintf("FAIL: %s of %u bytes is %s, expecting %s", name, (uint32)length, hexString, expectedHex);
+    return false;
+  }
+
+  return true;
+}
+
+// known values, then hashing in uneven pieces, and through a stream, matches hashing all at once
+template<class T>
+static bool TestDigestType(const char* name, const char* emptyHex, const char* abcHex, const char* patternHex)
+{
+  PODArray<byte> data;
+  MakePatternData(&data);
+  if (!CheckDigest<T>(name, "", 0, emptyHex) || !CheckDigest<T>(name, "abc", 3, abcHex) ||
+      !CheckDigest<T>(name, data.GetBasePointer(), data.GetSize(), patternHex))
+  {
+    return false;
+  }
+
+  char hexString[T::DIGEST_SIZE * 2 + 1];
+  T digest;
+  for (uint32 start = 0, length = 1; start < data.GetSize(); start += length, length = length * 2 + 5)
+    digest.Update(data.GetBasePointer() + start, Min(length, data.GetSize() - start));
+  DigestToString(&digest, hexString, sizeof(hexString));
+  if (Y_stricmp(hexString, patternHex) != 0)
+  {
+    Log_ErrorPrintf("FAIL: %s in pieces", name);
+    return false;
+  }
+
+  // a growable stream has read views, a read only one is read through a buffer
+  ByteStream* pViewStream = ByteStream_CreateGrowableMemoryStream();
+  ByteStream* pBufferedStream = ByteStream_CreateReadOnlyMemoryStream(data.GetBasePointer(), data.GetSize());
+  bool result = pViewStream->Write2(data.GetBasePointer(), data.GetSize());
+  digest.Reset();
+  result = result && Digest::HashStream(&digest, pViewStream, true);
+  DigestToString(&digest, hexString, sizeof(hexString));
+  result = result && Y_stricmp(hexString, patternHex) == 0;
+  digest.Reset();
+  result = result && Digest::HashStream(&digest, pBufferedStream) && pBufferedStream->GetPosition() == data.GetSize();
+  DigestToString(&digest, hexString, sizeof(hexString));
+  result = result && Y_stricmp(hexString, patternHex) == 0;
+  pViewStream->Release();
+  pBufferedStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrintf("FAIL: %s of a stream", name);
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: %s", name);
+  return true;
+}
+
+static bool TestXXHash64Values()
+{
+  PODArray<byte> data;
+  MakePatternData(&data);
+
+  XXHash64Digest seeded(0x1234);
+  seeded.Update(data.GetBasePointer(), 500);
+  uint64 halfValue = seeded.GetValue();
+  seeded.Update(data.GetBasePointer() + 500, 500);
+  if (XXHash64Digest::Hash("", 0) != 0xEF46DB3751D8E999ULL ||
+      XXHash64Digest::Hash(data.GetBasePointer(), data.GetSize()) != 0x89765902CC28352AULL ||
+      seeded.GetValue() != 0x94488C6AD4F7C6A9ULL ||
+      halfValue != XXHash64Digest::Hash(data.GetBasePointer(), 500, 0x1234))
+  {
+    Log_ErrorPrint("FAIL: XXH64 values");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: XXH64 values");
+  return true;
+}
+
+// every length around the block size, many at once, against hashing them one at a time
+static bool TestHashBuffers(ThreadPool* pThreadPool)
+{
+  PODArray<byte> data;
+  MakePatternData(&data);
+
+  static const uint32 BUFFER_COUNT = 200;
+  const void* pointers[BUFFER_COUNT];
+  size_t sizes[BUFFER_COUNT];
+  for (uint32 i = 0; i < BUFFER_COUNT; i++)
+  {
+    pointers[i] = data.GetBasePointer() + (i % 13);
+    sizes[i] = i;
+  }
+
+  PODArray<byte> digests;
+  digests.Resize(BUFFER_COUNT * SHA256Digest::DIGEST_SIZE);
+  Digest::HashBuffers<SHA256Digest>(pointers, sizes, BUFFER_COUNT, digests.GetBasePointer(), pThreadPool);
+  for (uint32 i = 0; i < BUFFER_COUNT; i++)
+  {
+    byte expected[SHA256Digest::DIGEST_SIZE];
+    SHA256Digest digest;
+    digest.Update(pointers[i], sizes[i]);
+    digest.Final(expected);
+    if (std::memcmp(expected, digests.GetBasePointer() + i * SHA256Digest::DIGEST_SIZE, sizeof(expected)) != 0)
+    {
+      Log_ErrorPrintf("FAIL: hashing buffers, buffer %u", i);
+      return false;
+    }
+  }
+
+  Log_InfoPrint("PASS: hashing buffers");
+  return true;
+}
+
+DEFINE_TEST_SUITE(Digest)
+{
+  ThreadPool threadPool(4);
+  bool result = true;
+  result &= TestDigestType<MD5Digest>("MD5", "d41d8cd98f00b204e9800998ecf8427e", "900150983cd24fb0d6963f7d28e17f72",
+                                      "3ba8ce463745829c9efeaa1e0b703a1a");
+  result &= TestDigestType<SHA1Digest>("SHA-1", "da39a3ee5e6b4b0d3255bfef95601890afd80709",
+                                       "a9993e364706816aba3e25717850c26c9cd0d89d",
+                                       "bb6be7d57a64c80427d7a955b3820aafad736478");
+  result &= TestDigestType<SHA256Digest>("SHA-256", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+                                         "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+                                         "8904ff7ad80f2f67e9d66239879a9b351be7b5c0142cc87447b6b2042ebdec45");
+  result &= TestDigestType<XXHash64Digest>("XXH64", "ef46db3751d8e999", "44bc2cf5ad770999", "89765902cc28352a");
+  result &= TestXXHash64Values();
+  result &= TestHashBuffers(nullptr);
+  result &= TestHashBuffers(&threadPool);
+  return result;
+}
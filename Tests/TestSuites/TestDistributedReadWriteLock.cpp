@@ -0,0 +1,126 @@
+#include "TestSuite.h"
+#include "YBaseLib/DistributedReadWriteLock.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(TestDistributedReadWriteLock);
+
+// Two counters that writers move together, so a reader that sees them differ got in alongside a writer.
+struct SharedCounters
+{
+  DistributedReadWriteLock* pLock;
+  uint32 First;
+  uint32 Second;
+};
+
+class ReaderWriterThread : public Thread
+{
+public:
+  static const uint32 Iterations = 20000;
+
+  ReaderWriterThread() : m_pCounters(nullptr), m_writer(false), m_failed(false) {}
+
+  void SetCounters(SharedCounters* pCounters, bool writer)
+  {
+    m_pCounters = pCounters;
+    m_writer = writer;
+  }
+
+  bool HasFailed() const { return m_failed; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    for (uint32 i = 0; i < Iterations; i++)
+    {
+      // writers read now and again too, and upgrade
+      if (m_writer && (i % 8) != 0)
+      {
+        m_pCounters->pLock->LockExclusive();
+        m_pCounters->First++;
+        m_pCounters->Second++;
+        m_pCounters->pLock->UnlockExclusive();
+      }
+      else if (m_writer)
+      {
+        m_pCounters->pLock->LockShared();
+        m_failed |= (m_pCounters->First != m_pCounters->Second);
+        m_pCounters->pLock->UpgradeSharedLockToExclusive();
+        m_pCounters->First++;
+        m_pCounters->Second++;
+        m_pCounters->pLock->UnlockExclusive();
+      }
+      else
+      {
+        m_pCounters->pLock->LockShared();
+        m_failed |= (m_pCounters->First != m_pCounters->Second);
+        m_pCounters->pLock->UnlockShared();
+      }
+    }
+
+    return 0;
+  }
+
+private:
+  SharedCounters* m_pCounters;
+  bool m_writer;
+  bool m_failed;
+};
+
+// readers never see a writer halfway through, and no write is lost
+static bool TestExclusion(uint32 slotCount)
+{
+  static const uint32 ReaderCount = 6;
+  static const uint32 WriterCount = 2;
+
+  DistributedReadWriteLock lock(slotCount);
+  SharedCounters counters = {&lock, 0, 0};
+  ReaderWriterThread threads[ReaderCount + WriterCount];
+  for (uint32 i = 0; i < countof(threads); i++)
+  {
+    threads[i].SetCounters(&counters, i < WriterCount);
+    threads[i].Start();
+  }
+
+  bool result = true;
+  for (uint32 i = 0; i < countof(threads); i++)
+  {
+    threads[i].Join();
+    result = result && !threads[i].HasFailed();
+  }
+
+  result = result && counters.First == WriterCount * ReaderWriterThread::Iterations &&
+           counters.Second == counters.First;
+  if (result)
+    Log_InfoPrintf("PASS: exclusion with %u slots", lock.GetSlotCount());
+  else
+    Log_ErrorPrintf("FAIL: exclusion with %u slots, counted %u", lock.GetSlotCount(), counters.First);
+  return result;
+}
+
+// the try forms fail against the other side, and readers share
+static bool TestTryLock()
+{
+  DistributedReadWriteLock lock;
+  bool result = lock.GetSlotCount() >= 1 && lock.GetSlotCount() <= DistributedReadWriteLock::MaxSlotCount;
+
+  lock.LockShared();
+  result = result && lock.TryLockShared() && !lock.TryLockExclusive();
+  lock.UnlockShared();
+  result = result && !lock.TryLockExclusive();
+  lock.UnlockShared();
+  result = result && lock.TryLockExclusive() && !lock.TryLockShared() && !lock.TryLockExclusive();
+  lock.UnlockExclusive();
+  result = result && lock.TryLockShared();
+  lock.UnlockShared();
+
+  if (result)
+    Log_InfoPrint("PASS: try lock");
+  else
+    Log_ErrorPrint("FAIL: try lock");
+  return result;
+}
+
+DEFINE_TEST_SUITE(DistributedReadWriteLock)
+{
+  return TestTryLock() && TestExclusion(1) && TestExclusion(8) && TestExclusion(0);
+}
@@ -0,0 +1,152 @@
+#include "TestSuite.h"
+#include "YBaseLib/EpochManager.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(TestEpochManager);
+
+static Y_ATOMIC_DECL uint32 s_reclaimCount = 0;
+
+static void CountReclaim(void* pObject)
+{
+  Y_AtomicIncrement(s_reclaimCount);
+}
+
+// nothing is reclaimed while a thread that could see it is in a region, and everything is once it leaves
+static bool TestDeferral()
+{
+  EpochManager manager;
+  EpochManager::ThreadRecord* pWriter = manager.RegisterThread();
+  EpochManager::ThreadRecord* pReader = manager.RegisterThread();
+  int objects[16];
+
+  s_reclaimCount = 0;
+  manager.Enter(pReader);
+  for (uint32 i = 0; i < countof(objects); i++)
+    manager.Retire(pWriter, &objects[i], CountReclaim);
+
+  // a reader held in one epoch lets it advance once at most
+  for (uint32 i = 0; i < 8; i++)
+    manager.Collect(pWriter);
+  bool result = (s_reclaimCount == 0 && manager.GetRetiredCount(pWriter) == countof(objects));
+
+  manager.Exit(pReader);
+  for (uint32 i = 0; i < 4; i++)
+    manager.Collect(pWriter);
+  result = result && (s_reclaimCount == countof(objects) && manager.GetRetiredCount(pWriter) == 0);
+
+  // a record given up is handed back out, rather than a new one made
+  manager.UnregisterThread(pReader);
+  result = result && (manager.RegisterThread() == pReader);
+
+  // and the destructor reclaims what's left
+  {
+    EpochManager otherManager;
+    EpochManager::ThreadRecord* pRecord = otherManager.RegisterThread();
+    otherManager.Retire(pRecord, &objects[0], CountReclaim);
+    otherManager.UnregisterThread(pRecord);
+  }
+  result = result && (s_reclaimCount == countof(objects) + 1);
+
+  if (result)
+    Log_InfoPrint("PASS: deferral");
+  else
+    Log_ErrorPrintf("FAIL: deferral, reclaimed %u", s_reclaimCount);
+  return result;
+}
+
+// Shared configuration swapped by writers while readers use it. Reclaiming one early would have ASAN complain, and
+// the fields are scribbled on as it's destroyed so a reader that got one would see them differ.
+struct Config
+{
+  uint32 First;
+  uint32 Second;
+
+  Config(uint32 value) : First(value), Second(value) {}
+  ~Config()
+  {
+    First = 1;
+    Second = 2;
+  }
+};
+
+class ConfigThread : public Thread
+{
+public:
+  static const uint32 Iterations = 20000;
+
+  ConfigThread() : m_pManager(nullptr), m_pConfig(nullptr), m_writer(false), m_failed(false) {}
+
+  void SetConfig(EpochManager* pManager, AtomicPointer<Config>* pConfig, bool writer)
+  {
+    m_pManager = pManager;
+    m_pConfig = pConfig;
+    m_writer = writer;
+  }
+
+  bool HasFailed() const { return m_failed; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    EpochManager::ThreadRecord* pRecord = m_pManager->RegisterThread();
+    for (uint32 i = 0; i < Iterations; i++)
+    {
+      if (m_writer)
+      {
+        m_pManager->SwapAndRetire(pRecord, *m_pConfig, new Config(i));
+      }
+      else
+      {
+        EpochGuard guard(*m_pManager, pRecord);
+        const Config* pConfig = m_pConfig->LoadAcquire();
+        m_failed |= (pConfig->First != pConfig->Second);
+      }
+    }
+
+    m_pManager->UnregisterThread(pRecord);
+    return 0;
+  }
+
+private:
+  EpochManager* m_pManager;
+  AtomicPointer<Config>* m_pConfig;
+  bool m_writer;
+  bool m_failed;
+};
+
+static bool TestSwapAndRetire()
+{
+  static const uint32 ReaderCount = 6;
+  static const uint32 WriterCount = 2;
+
+  bool result = true;
+  {
+    EpochManager manager;
+    AtomicPointer<Config> config(new Config(0));
+    ConfigThread threads[ReaderCount + WriterCount];
+    for (uint32 i = 0; i < countof(threads); i++)
+    {
+      threads[i].SetConfig(&manager, &config, i < WriterCount);
+      threads[i].Start();
+    }
+
+    for (uint32 i = 0; i < countof(threads); i++)
+    {
+      threads[i].Join();
+      result = result && !threads[i].HasFailed();
+    }
+
+    delete config.Exchange(nullptr);
+  }
+
+  if (result)
+    Log_InfoPrint("PASS: swap and retire");
+  else
+    Log_ErrorPrint("FAIL: swap and retire");
+  return result;
+}
+
+DEFINE_TEST_SUITE(EpochManager)
+{
+  return TestDeferral() && TestSwapAndRetire();
+}
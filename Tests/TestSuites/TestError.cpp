@@ -0,0 +1,74 @@
+#include "TestSuite.h"
+#include "YBaseLib/Error.h"
+#include "YBaseLib/Log.h"
+#include <cerrno>
+#include <cstring>
+Log_SetChannel(TestError);
+
+static bool TestLazyFormatting()
+{
+  // copied before and after the description is made, both give the same
+  Error error;
+  error.SetErrorErrno(ENOENT);
+  Error copy(error);
+  bool result = error.GetErrorCodeString() == TinyString::FromFormat("%i", ENOENT) &&
+                error.GetErrorDescription() == strerror(ENOENT) && copy.GetErrorDescription() == strerror(ENOENT) &&
+                copy == error && copy.GetType() == ERROR_TYPE_ERRNO;
+
+  error.SetErrorUserStaticFormatted(42, "%s failed after %u tries, %.1f%%", "send", 3u, 12.5);
+  copy = error;
+  result = result && error.GetErrorCodeString() == "42" &&
+           error.GetErrorDescription() == "send failed after 3 tries, 12.5%" &&
+           copy.GetErrorCodeAndDescription() == "[42]: send failed after 3 tries, 12.5%";
+
+  // static messages are used as they are
+  error.SetErrorUserStatic(7, "100% static");
+  result = result && error.GetErrorCodeAndDescription() == "[7]: 100% static" && error.GetErrorCodeUser() == 7;
+
+  // setting again replaces what was made for the last error
+  error.SetErrorUser("E_CODE", "copied message");
+  result = result && error.GetErrorCodeString() == "E_CODE" && error.GetErrorDescription() == "copied message";
+  error.SetErrorNone();
+  result = result && error.GetType() == ERROR_TYPE_NONE && error.GetErrorCodeString().IsEmpty() &&
+           error.GetErrorDescription().IsEmpty();
+
+  Error formatted = Error::CreateErrorUserFormatted(5, "value %d", -3);
+  result = result && formatted.GetErrorCodeAndDescription() == "[5]: value -3";
+
+  if (result)
+    Log_InfoPrint("PASS: lazy formatting");
+  else
+    Log_ErrorPrint("FAIL: lazy formatting");
+  return result;
+}
+
+static bool TestDiscard()
+{
+  Error* pDiscard = Error::Discard();
+  pDiscard->SetErrorErrno(EAGAIN);
+  pDiscard->SetErrorUserStaticFormatted(1, "%d", 1);
+  pDiscard->SetErrorUser(2, "ignored");
+  *pDiscard = Error::CreateErrorUser(3, "ignored");
+
+  bool result = (pDiscard == Error::Discard() && pDiscard->GetType() == ERROR_TYPE_NONE &&
+                 pDiscard->GetErrorDescription().IsEmpty());
+
+  // copies of it are ordinary errors
+  Error copy(*pDiscard);
+  copy.SetErrorUserStatic(4, "kept");
+  result = result && copy.GetErrorCodeUser() == 4 && pDiscard->GetType() == ERROR_TYPE_NONE;
+
+  if (result)
+    Log_InfoPrint("PASS: discard");
+  else
+    Log_ErrorPrint("FAIL: discard");
+  return result;
+}
+
+DEFINE_TEST_SUITE(Error)
+{
+  bool result = true;
+  result &= TestLazyFormatting();
+  result &= TestDiscard();
+  return result;
+}
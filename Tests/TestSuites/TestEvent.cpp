@@ -0,0 +1,169 @@
+#include "TestSuite.h"
+#include "YBaseLib/Event.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Thread.h"
+#include "YBaseLib/Timer.h"
+#if defined(Y_PLATFORM_POSIX)
+#include <poll.h>
+#endif
+Log_SetChannel(TestEvent);
+
+// manual reset events stay signaled until they're reset, auto reset events until they're waited for
+static bool TestResets()
+{
+  Event manualEvent(false);
+  bool result = !manualEvent.TryWait(0);
+  manualEvent.Signal();
+  manualEvent.Signal();
+  result = result && manualEvent.TryWait(0) && manualEvent.TryWait(10);
+  manualEvent.Wait();
+  manualEvent.Reset();
+  result = result && !manualEvent.TryWait(0);
+
+  Event autoEvent(true);
+  autoEvent.Signal();
+  autoEvent.Signal();
+  result = result && autoEvent.TryWait(0) && !autoEvent.TryWait(0);
+  autoEvent.Signal();
+  autoEvent.Wait();
+  result = result && !autoEvent.TryWait(0);
+  autoEvent.Signal();
+  autoEvent.Reset();
+  result = result && !autoEvent.TryWait(0);
+
+  // a wait that times out takes about as long as it was given
+  Timer timer;
+  result = result && !autoEvent.TryWait(50) && timer.GetTimeMilliseconds() >= 45.0;
+
+  if (result)
+    Log_InfoPrint("PASS: resets");
+  else
+    Log_ErrorPrint("FAIL: resets");
+  return result;
+}
+
+// Waits for a ping and answers it with a pong, or waits for the start for the WaitForMultipleEvents test.
+class PingThread : public Thread
+{
+public:
+  PingThread() : m_pPing(nullptr), m_pPong(nullptr), m_count(0) {}
+
+  void SetEvents(Event* pPing, Event* pPong, uint32 count)
+  {
+    m_pPing = pPing;
+    m_pPong = pPong;
+    m_count = count;
+  }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    for (uint32 i = 0; i < m_count; i++)
+    {
+      m_pPing->Wait();
+      m_pPong->Signal();
+    }
+
+    return 0;
+  }
+
+private:
+  Event* m_pPing;
+  Event* m_pPong;
+  uint32 m_count;
+};
+
+// auto reset events handed back and forth between threads, each signal waking the other side once
+static bool TestPingPong()
+{
+  static const uint32 Rounds = 20000;
+
+  Event ping(true);
+  Event pong(true);
+  PingThread thread;
+  thread.SetEvents(&ping, &pong, Rounds);
+  thread.Start();
+
+  bool result = true;
+  for (uint32 i = 0; i < Rounds && result; i++)
+  {
+    ping.Signal();
+    result = pong.TryWait(10000);
+  }
+
+  thread.Join();
+  result = result && !ping.TryWait(0) && !pong.TryWait(0);
+  if (result)
+    Log_InfoPrint("PASS: ping pong");
+  else
+    Log_ErrorPrint("FAIL: ping pong");
+  return result;
+}
+
+// a manual reset event wakes every thread waiting on it
+static bool TestWakeAll()
+{
+  static const uint32 ThreadCount = 4;
+
+  Event start(false);
+  Event done[ThreadCount];
+  Event* pDone[ThreadCount];
+  PingThread threads[ThreadCount];
+  for (uint32 i = 0; i < ThreadCount; i++)
+  {
+    pDone[i] = &done[i];
+    threads[i].SetEvents(&start, &done[i], 1);
+    threads[i].Start();
+  }
+
+  start.Signal();
+  Event::WaitForMultipleEvents(pDone, ThreadCount);
+  for (uint32 i = 0; i < ThreadCount; i++)
+    threads[i].Join();
+
+  bool result = start.TryWait(0);
+  for (uint32 i = 0; i < ThreadCount; i++)
+    result = result && done[i].TryWait(0);
+
+  if (result)
+    Log_InfoPrint("PASS: wake all");
+  else
+    Log_ErrorPrint("FAIL: wake all");
+  return result;
+}
+
+#if defined(Y_PLATFORM_POSIX)
+
+// the descriptor is readable exactly while the event is signaled
+static bool TestPollableEvent()
+{
+  PollableEvent event(true);
+  pollfd pollDescriptor;
+  pollDescriptor.fd = event.GetFileDescriptor();
+  pollDescriptor.events = POLLIN;
+
+  bool result = (poll(&pollDescriptor, 1, 0) == 0) && !event.TryWait(0);
+  event.Signal();
+  event.Signal();
+  result = result && (poll(&pollDescriptor, 1, 0) == 1) && event.TryWait(0) && (poll(&pollDescriptor, 1, 0) == 0);
+  event.Signal();
+  event.Reset();
+  result = result && !event.TryWait(10);
+
+  if (result)
+    Log_InfoPrint("PASS: pollable event");
+  else
+    Log_ErrorPrint("FAIL: pollable event");
+  return result;
+}
+
+#endif
+
+DEFINE_TEST_SUITE(Event)
+{
+  bool result = TestResets() && TestPingPong() && TestWakeAll();
+#if defined(Y_PLATFORM_POSIX)
+  result = result && TestPollableEvent();
+#endif
+  return result;
+}
@@ -0,0 +1,142 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CompressionByteStream.h"
+#include "YBaseLib/FileLogSink.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/ThreadPool.h"
+#include "YBaseLib/Timestamp.h"
+Log_SetChannel(TestFileLogSink);
+
+static const char s_testDirectoryName[] = "TestFileLogSink.tmp";
+
+static bool ReadFileText(const char* fileName, String& text, bool compressed)
+{
+  ByteStream* pStream = FileSystem::OpenFile(fileName, BYTESTREAM_OPEN_READ);
+  if (pStream == nullptr)
+    return false;
+
+  if (compressed)
+  {
+    ByteStream* pFileStream = pStream;
+    pStream = CompressionByteStream::CreateDecompressor(pFileStream, COMPRESSION_CODEC_DEFLATE);
+    pFileStream->Release();
+    if (pStream == nullptr)
+      return false;
+  }
+
+  char buffer[1024];
+  uint32 bytesRead;
+  text.Clear();
+  while ((bytesRead = pStream->Read(buffer, sizeof(buffer))) > 0)
+    text.AppendString(buffer, bytesRead);
+
+  pStream->Release();
+  return true;
+}
+
+static uint32 CountFiles(const char* pattern, FileSystem::FindResultsArray* pFiles)
+{
+  pFiles->Clear();
+  FileSystem::FindFiles(s_testDirectoryName, pattern, FILESYSTEM_FIND_FILES, pFiles);
+  return pFiles->GetSize();
+}
+
+// files rotate by size, and only the newest are kept
+static bool TestRotation()
+{
+  FileSystem::DeleteDirectory(s_testDirectoryName, true);
+
+  FileLogSink* pSink = new FileLogSink();
+  pSink->SetFilter(nullptr, LOGLEVEL_INFO);
+  pSink->SetRotation(256, 0, 2);
+  bool result = pSink->Open(s_testDirectoryName, "sink");
+  for (uint32 i = 0; i < 20; i++)
+    Log_InfoPrintf("rotated message number %u", i);
+  Log_DevPrint("filtered message");
+  String lastFileName(pSink->GetFileName());
+  delete pSink;
+
+  // the open file and two before it
+  FileSystem::FindResultsArray files;
+  String text;
+  result = result && CountFiles("*.log", &files) == 3 && ReadFileText(lastFileName, text, false);
+  if (result && (text.Find("rotated message number 19\n") < 0 || text.Find("filtered") >= 0))
+    result = false;
+  for (uint32 i = 0; result && i < files.GetSize(); i++)
+    result = ReadFileText(files[i].FileName, text, false) && text.Find("rotated message number 0\n") < 0;
+
+  FileSystem::DeleteDirectory(s_testDirectoryName, true);
+  if (result)
+    Log_InfoPrint("PASS: rotation");
+  else
+    Log_ErrorPrintf("FAIL: rotation (%u files)", files.GetSize());
+  return result;
+}
+
+// rotated files are compressed on the pool, the open one isn't
+static bool TestCompression()
+{
+  if (!Compression::IsCodecAvailable(COMPRESSION_CODEC_DEFLATE))
+  {
+    Log_InfoPrint("SKIP: compression, deflate is not built in");
+    return true;
+  }
+
+  FileSystem::DeleteDirectory(s_testDirectoryName, true);
+
+  ThreadPool threadPool(2);
+  FileLogSink* pSink = new FileLogSink();
+  pSink->SetFilter(nullptr, LOGLEVEL_INFO);
+  bool result = pSink->SetCompression(&threadPool) && pSink->Open(s_testDirectoryName, "sink");
+  Log_InfoPrint("compressed message");
+  result = result && pSink->Rotate();
+  Log_InfoPrint("uncompressed message");
+  delete pSink;
+
+  FileSystem::FindResultsArray files;
+  String text;
+  result = result && CountFiles("*.log.zz", &files) == 1 && ReadFileText(files[0].FileName, text, true) &&
+           text.Find("compressed message\n") >= 0 && text.Find("uncompressed") < 0 &&
+           CountFiles("*.log", &files) == 1 &&
+           ReadFileText(files[0].FileName, text, false) && text.Find("uncompressed message\n") >= 0;
+
+  FileSystem::DeleteDirectory(s_testDirectoryName, true);
+  if (result)
+    Log_InfoPrint("PASS: compression");
+  else
+    Log_ErrorPrint("FAIL: compression");
+  return result;
+}
+
+// lines start with the local time, when there's a format for it
+static bool TestTimestamps()
+{
+  FileSystem::DeleteDirectory(s_testDirectoryName, true);
+
+  FileLogSink* pSink = new FileLogSink();
+  pSink->SetFilter(nullptr, LOGLEVEL_INFO);
+  pSink->SetTimestampFormat("[%Y]", 0);
+  bool result = pSink->Open(s_testDirectoryName, "sink");
+  Log_InfoPrint("stamped message");
+  String fileName(pSink->GetFileName());
+  delete pSink;
+
+  String text;
+  String prefix(Timestamp::Now().ToString("[%Y] "));
+  result = result && ReadFileText(fileName, text, false) && text.StartsWith(prefix) &&
+           text.Find("stamped message\n") >= 0;
+
+  FileSystem::DeleteDirectory(s_testDirectoryName, true);
+  if (result)
+    Log_InfoPrint("PASS: timestamps");
+  else
+    Log_ErrorPrintf("FAIL: timestamps: %s", text.GetCharArray());
+  return result;
+}
+
+DEFINE_TEST_SUITE(FileLogSink)
+{
+  return TestRotation() && TestCompression() && TestTimestamps();
+}
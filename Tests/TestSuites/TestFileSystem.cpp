@@ -0,0 +1,575 @@
+#include "TestSuite.h"
+#include "YBaseLib/Array.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/FileSystemIndex.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/MutexLock.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/ThreadPool.h"
+#include "YBaseLib/Timer.h"
+#include <cstdio>
+Log_SetChannel(TestFileSystem);
+
+static const char s_testDirectoryName[] = "TestFileSystem.tmp";
+static const uint32 s_directoryCount = 8;
+static const uint32 s_subdirectoryCount = 4;
+static const uint32 s_filesPerDirectory = 25;
+
+static bool WriteFile(const char* fileName, uint32 size)
+{
+  ByteStream* pStream;
+  if (!ByteStream_OpenFileStream(fileName, BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_TRUNCATE,
+                                 &pStream))
+  {
+    return false;
+  }
+
+  bool result = true;
+  for (uint32 i = 0; i < size && result; i++)
+    result = pStream->WriteByte((byte)i);
+
+  pStream->Release();
+  return result;
+}
+
+// a few levels of directories, each with files of a size their name gives away
+static bool CreateTestTree()
+{
+  PathString path;
+  bool result = FileSystem::CreateDirectory(s_testDirectoryName, false);
+  path.Format("%s/.hidden.txt", s_testDirectoryName);
+  result = result && WriteFile(path, 1);
+  for (uint32 i = 0; i < s_directoryCount && result; i++)
+  {
+    for (uint32 j = 0; j < s_subdirectoryCount && result; j++)
+    {
+      path.Format("%s/dir%u/sub%u", s_testDirectoryName, i, j);
+      result = FileSystem::CreateDirectory(path, true);
+      for (uint32 k = 0; k < s_filesPerDirectory && result; k++)
+      {
+        path.Format("%s/dir%u/sub%u/file%u.txt", s_testDirectoryName, i, j, k);
+        result = WriteFile(path, k);
+      }
+
+      path.Format("%s/dir%u/sub%u/other.dat", s_testDirectoryName, i, j);
+      result = result && WriteFile(path, 0);
+    }
+  }
+
+  return result;
+}
+
+static int CompareFindData(const FILESYSTEM_FIND_DATA* pLeft, const FILESYSTEM_FIND_DATA* pRight)
+{
+  return Y_strcmp(pLeft->FileName, pRight->FileName);
+}
+
+// searches in parallel, gathering the matches to compare against FindFiles
+static bool FindAll(const char* pattern, uint32 flags, ThreadPool* pThreadPool, FileSystem::FindResultsArray* pResults)
+{
+  Mutex lock;
+  pResults->Clear();
+  bool result = FileSystem::FindFilesParallel(s_testDirectoryName, pattern, flags, pThreadPool,
+                                              [&lock, pResults](const FILESYSTEM_FIND_DATA* pFindData) {
+                                                MutexLock locker(lock);
+                                                pResults->Add(*pFindData);
+                                              });
+
+  pResults->Sort(CompareFindData);
+  return result;
+}
+
+// files are as long as the number in their name
+static uint64 GetExpectedSize(const char* fileName)
+{
+  const char* pName = Y_strrchr(fileName, FS_OSPATH_SEPERATOR_CHARACTER);
+  pName = (pName != nullptr) ? pName + 1 : fileName;
+  return (Y_strncmp(pName, "file", 4) == 0) ? Y_strtouint32(pName + 4) : (Y_strcmp(pName, ".hidden.txt") == 0) ? 1 : 0;
+}
+
+static bool CheckSearch(const char* pattern, uint32 flags, ThreadPool* pThreadPool, uint32 expectedCount)
+{
+  FileSystem::FindResultsArray expected;
+  FileSystem::FindResultsArray found;
+  bool expectedResult = FileSystem::FindFiles(s_testDirectoryName, pattern, flags, &expected);
+  if (FindAll(pattern, flags, pThreadPool, &found) != expectedResult || found.GetSize() != expectedCount ||
+      expected.GetSize() != expectedCount)
+  {
+    return false;
+  }
+
+  expected.Sort(CompareFindData);
+  for (uint32 i = 0; i < found.GetSize(); i++)
+  {
+    if (Y_strcmp(found[i].FileName, expected[i].FileName) != 0 || found[i].Attributes != expected[i].Attributes)
+      return false;
+
+    if (!(flags & FILESYSTEM_FIND_NO_STAT) && found[i].Size != GetExpectedSize(found[i].FileName))
+      return false;
+  }
+
+  return true;
+}
+
+static bool TestParallelFind(ThreadPool* pThreadPool)
+{
+  const uint32 fileCount = s_directoryCount * s_subdirectoryCount * s_filesPerDirectory;
+  const uint32 directoryCount = s_directoryCount * (s_subdirectoryCount + 1);
+  const uint32 recursiveFiles = FILESYSTEM_FIND_RECURSIVE | FILESYSTEM_FIND_FILES;
+  bool result =
+    CheckSearch("*", recursiveFiles, pThreadPool, fileCount + s_directoryCount * s_subdirectoryCount) &&
+    CheckSearch("*.txt", recursiveFiles, pThreadPool, fileCount) &&
+    CheckSearch("*.txt", recursiveFiles | FILESYSTEM_FIND_HIDDEN_FILES, pThreadPool, fileCount + 1) &&
+    CheckSearch("file1?.txt", recursiveFiles | FILESYSTEM_FIND_NO_STAT, pThreadPool, fileCount * 10 / 25) &&
+    CheckSearch("other.dat", recursiveFiles, pThreadPool, s_directoryCount * s_subdirectoryCount) &&
+    CheckSearch("sub*", FILESYSTEM_FIND_RECURSIVE | FILESYSTEM_FIND_FOLDERS, pThreadPool,
+                s_directoryCount * s_subdirectoryCount) &&
+    CheckSearch("*", FILESYSTEM_FIND_RECURSIVE | FILESYSTEM_FIND_FOLDERS | FILESYSTEM_FIND_FILES, pThreadPool,
+                fileCount + s_directoryCount * s_subdirectoryCount + directoryCount) &&
+    CheckSearch("*", FILESYSTEM_FIND_FOLDERS, pThreadPool, s_directoryCount) &&
+    CheckSearch("*.none", recursiveFiles, pThreadPool, 0);
+
+  // relative paths, written with the OS separator
+  FileSystem::FindResultsArray found;
+  PathString expectedName;
+  expectedName.Format("dir0%csub0%cfile0.txt", FS_OSPATH_SEPERATOR_CHARACTER, FS_OSPATH_SEPERATOR_CHARACTER);
+  result = result && FindAll("*.txt", recursiveFiles | FILESYSTEM_FIND_RELATIVE_PATHS, pThreadPool, &found) &&
+           found.GetSize() == fileCount && expectedName.Compare(found[0].FileName);
+
+  if (!result)
+  {
+    Log_ErrorPrintf("FAIL: parallel find with %u workers",
+                    (pThreadPool != nullptr) ? pThreadPool->GetWorkerThreadCount() : 0);
+    return false;
+  }
+
+  return true;
+}
+
+// checks a batch against StatFile, one at a time
+static bool CheckStatBatch(const char* testName, const String* pPaths, uint32 count,
+                           const FILESYSTEM_STAT_DATA* pStatData, const bool* pFound, uint32 foundCount,
+                           uint32 expectedFoundCount)
+{
+  bool result = (foundCount == expectedFoundCount);
+  for (uint32 i = 0; i < count && result; i++)
+  {
+    FILESYSTEM_STAT_DATA expected;
+    bool expectedFound = FileSystem::StatFile(pPaths[i], &expected);
+    result = (pFound[i] == expectedFound &&
+              (!expectedFound ||
+               (pStatData[i].Attributes == expected.Attributes && pStatData[i].Size == expected.Size &&
+                pStatData[i].ModificationTime == expected.ModificationTime)));
+  }
+
+  if (!result)
+    Log_ErrorPrintf("FAIL: %s", testName);
+
+  return result;
+}
+
+static bool TestStatFiles(ThreadPool* pThreadPool)
+{
+  // every file in dir0's subdirectories, the subdirectories themselves, and a missing file in each
+  const uint32 entriesPerDirectory = s_filesPerDirectory + 2;
+  const uint32 count = s_subdirectoryCount * entriesPerDirectory;
+  const uint32 expectedFoundCount = s_subdirectoryCount * (s_filesPerDirectory + 1);
+  Array<String> names;
+  Array<String> paths;
+  for (uint32 i = 0; i < s_subdirectoryCount; i++)
+  {
+    for (uint32 j = 0; j < entriesPerDirectory; j++)
+    {
+      String name;
+      if (j < s_filesPerDirectory)
+        name.Format("sub%u/file%u.txt", i, j);
+      else if (j == s_filesPerDirectory)
+        name.Format("sub%u", i);
+      else
+        name.Format("sub%u/missing.txt", i);
+
+      String path;
+      path.Format("%s/dir0/%s", s_testDirectoryName, name.GetCharArray());
+      names.Add(name);
+      paths.Add(path);
+    }
+  }
+
+  PODArray<const char*> namePointers;
+  PODArray<const char*> pathPointers;
+  for (uint32 i = 0; i < count; i++)
+  {
+    namePointers.Add(names[i].GetCharArray());
+    pathPointers.Add(paths[i].GetCharArray());
+  }
+
+  PODArray<FILESYSTEM_STAT_DATA> statData;
+  PODArray<bool> found;
+  statData.Resize(count);
+  found.Resize(count);
+
+  uint32 foundCount = FileSystem::StatFiles(pathPointers.GetBasePointer(), count, statData.GetBasePointer(),
+                                            found.GetBasePointer(), pThreadPool);
+  bool result = CheckStatBatch("StatFiles", paths.GetBasePointer(), count, statData.GetBasePointer(),
+                               found.GetBasePointer(), foundCount, expectedFoundCount);
+
+  String directoryPath;
+  directoryPath.Format("%s/dir0", s_testDirectoryName);
+  foundCount = FileSystem::StatFilesInDirectory(directoryPath, namePointers.GetBasePointer(), count,
+                                                statData.GetBasePointer(), found.GetBasePointer(), pThreadPool);
+  result = result && CheckStatBatch("StatFilesInDirectory", paths.GetBasePointer(), count, statData.GetBasePointer(),
+                                    found.GetBasePointer(), foundCount, expectedFoundCount);
+  if (!result)
+    return false;
+
+  // nothing is found in a directory that doesn't exist
+  directoryPath.Format("%s/missing", s_testDirectoryName);
+  foundCount = FileSystem::StatFilesInDirectory(directoryPath, namePointers.GetBasePointer(), count,
+                                                statData.GetBasePointer(), found.GetBasePointer(), pThreadPool);
+  for (uint32 i = 0; i < count && result; i++)
+    result = !found[i];
+  if (!result || foundCount != 0)
+  {
+    Log_ErrorPrint("FAIL: StatFilesInDirectory in a missing directory");
+    return false;
+  }
+
+  return true;
+}
+
+#if defined(Y_PLATFORM_LINUX)
+
+static const char s_watchDirectoryName[] = "TestFileSystemWatch.tmp";
+
+// inotify queues events as the changes are made, so everything done before enumerating is seen in one batch
+static bool CheckChanges(FileSystem::ChangeNotifier* pNotifier, const char* testName, uint32 expectedCount,
+                         const char* const* pExpectedNames, const uint32* pExpectedEvents)
+{
+  PathString expectedPath;
+  uint32 count = 0;
+  bool result = true;
+  pNotifier->EnumerateChanges([&](const FileSystem::ChangeNotifier::ChangeInfo* pChangeInfo) {
+    if (count < expectedCount)
+    {
+      expectedPath.Format("%s/%s", s_watchDirectoryName, pExpectedNames[count]);
+      if (!expectedPath.Compare(pChangeInfo->Path) || pChangeInfo->Event != pExpectedEvents[count])
+      {
+        Log_ErrorPrintf("FAIL: %s: change %u is %s %u", testName, count, pChangeInfo->Path, pChangeInfo->Event);
+        result = false;
+      }
+    }
+
+    count++;
+  });
+
+  if (count != expectedCount)
+  {
+    Log_ErrorPrintf("FAIL: %s: %u changes, expected %u", testName, count, expectedCount);
+    result = false;
+  }
+
+  return result;
+}
+
+static bool TestChangeNotifier()
+{
+  typedef FileSystem::ChangeNotifier CN;
+
+  PathString path;
+  PathString newPath;
+  FileSystem::DeleteDirectory(s_watchDirectoryName, true);
+  path.Format("%s/existing", s_watchDirectoryName);
+  if (!FileSystem::CreateDirectory(path, true))
+    return false;
+
+  CN* pNotifier = FileSystem::CreateChangeNotifier(s_watchDirectoryName, true);
+  if (pNotifier == nullptr)
+  {
+    Log_ErrorPrint("FAIL: creating the change notifier");
+    return false;
+  }
+
+  // writes after the create are folded into it
+  path.Format("%s/a.txt", s_watchDirectoryName);
+  WriteFile(path, 10);
+  WriteFile(path, 20);
+  const char* createNames[] = {"a.txt"};
+  const uint32 createEvents[] = {CN::ChangeEvent_FileAdded};
+  bool result = CheckChanges(pNotifier, "create", 1, createNames, createEvents);
+
+  WriteFile(path, 30);
+  const char* modifyNames[] = {"a.txt"};
+  const uint32 modifyEvents[] = {CN::ChangeEvent_FileModified};
+  result = CheckChanges(pNotifier, "modify", 1, modifyNames, modifyEvents) && result;
+
+  newPath.Format("%s/existing/b.txt", s_watchDirectoryName);
+  std::rename(path, newPath);
+  const char* renameNames[] = {"a.txt", "existing/b.txt"};
+  const uint32 renameEvents[] = {CN::ChangeEvent_RenamedOldName, CN::ChangeEvent_RenamedNewName};
+  result = CheckChanges(pNotifier, "rename", 2, renameNames, renameEvents) && result;
+
+  // the file is in the new directory before its watch is added
+  path.Format("%s/new/deeper", s_watchDirectoryName);
+  FileSystem::CreateDirectory(path, true);
+  path.Format("%s/new/deeper/c.txt", s_watchDirectoryName);
+  WriteFile(path, 1);
+  const char* newDirectoryNames[] = {"new", "new/deeper", "new/deeper/c.txt"};
+  const uint32 newDirectoryEvents[] = {CN::ChangeEvent_FileAdded, CN::ChangeEvent_FileAdded,
+                                       CN::ChangeEvent_FileAdded};
+  result = CheckChanges(pNotifier, "new directory", 3, newDirectoryNames, newDirectoryEvents) && result;
+
+  // and from then on is watched
+  WriteFile(path, 2);
+  const char* watchedNames[] = {"new/deeper/c.txt"};
+  const uint32 watchedEvents[] = {CN::ChangeEvent_FileModified};
+  result = CheckChanges(pNotifier, "new directory watched", 1, watchedNames, watchedEvents) && result;
+
+  // a renamed directory's watches follow it
+  path.Format("%s/new", s_watchDirectoryName);
+  newPath.Format("%s/renamed", s_watchDirectoryName);
+  std::rename(path, newPath);
+  path.Format("%s/renamed/deeper/c.txt", s_watchDirectoryName);
+  FileSystem::DeleteFile(path);
+  const char* renameDirectoryNames[] = {"new", "renamed", "renamed/deeper/c.txt"};
+  const uint32 renameDirectoryEvents[] = {CN::ChangeEvent_RenamedOldName, CN::ChangeEvent_RenamedNewName,
+                                          CN::ChangeEvent_FileRemoved};
+  result = CheckChanges(pNotifier, "rename directory", 3, renameDirectoryNames, renameDirectoryEvents) && result;
+
+  // gone again before anyone looked
+  path.Format("%s/temporary.txt", s_watchDirectoryName);
+  WriteFile(path, 5);
+  FileSystem::DeleteFile(path);
+  result = CheckChanges(pNotifier, "create and delete", 0, nullptr, nullptr) && result;
+
+  // moved out of the tree, nothing below it is watched any more
+  path.Format("%s/renamed", s_watchDirectoryName);
+  newPath.Format("%s.moved", s_watchDirectoryName);
+  FileSystem::DeleteDirectory(newPath, true);
+  std::rename(path, newPath);
+  const char* moveOutNames[] = {"renamed"};
+  const uint32 moveOutEvents[] = {CN::ChangeEvent_FileRemoved};
+  result = CheckChanges(pNotifier, "move out", 1, moveOutNames, moveOutEvents) && result;
+  path.Format("%s/deeper/d.txt", newPath.GetCharArray());
+  WriteFile(path, 1);
+  result = CheckChanges(pNotifier, "moved out unwatched", 0, nullptr, nullptr) && result;
+  FileSystem::DeleteDirectory(newPath, true);
+
+  path.Format("%s/existing/b.txt", s_watchDirectoryName);
+  FileSystem::DeleteFile(path);
+  const char* deleteNames[] = {"existing/b.txt"};
+  const uint32 deleteEvents[] = {CN::ChangeEvent_FileRemoved};
+  result = CheckChanges(pNotifier, "delete", 1, deleteNames, deleteEvents) && result;
+
+  delete pNotifier;
+  FileSystem::DeleteDirectory(s_watchDirectoryName, true);
+  if (result)
+    Log_InfoPrint("PASS: change notifier");
+
+  return result;
+}
+
+#endif
+
+// the index has to find what FindFiles does
+static bool CheckIndexSearch(const FileSystemIndex& index, const char* path, const char* pattern, uint32 flags,
+                             uint32 expectedCount)
+{
+  FileSystem::FindResultsArray expected;
+  FileSystem::FindResultsArray found;
+  bool expectedResult = FileSystem::FindFiles(path, pattern, flags, &expected);
+  if (index.FindFiles(path, pattern, flags, &found) != expectedResult || found.GetSize() != expectedCount ||
+      expected.GetSize() != expectedCount)
+  {
+    return false;
+  }
+
+  expected.Sort(CompareFindData);
+  found.Sort(CompareFindData);
+  for (uint32 i = 0; i < found.GetSize(); i++)
+  {
+    if (Y_strcmp(found[i].FileName, expected[i].FileName) != 0 || found[i].Attributes != expected[i].Attributes ||
+        (!(found[i].Attributes & FILESYSTEM_FILE_ATTRIBUTE_DIRECTORY) &&
+         found[i].Size != GetExpectedSize(found[i].FileName)))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool CheckIndex(const FileSystemIndex& index, const char* testName)
+{
+  const uint32 fileCount = s_directoryCount * s_subdirectoryCount * s_filesPerDirectory;
+  const uint32 recursiveFiles = FILESYSTEM_FIND_RECURSIVE | FILESYSTEM_FIND_FILES;
+  PathString path;
+  path.Format("%s/dir3", s_testDirectoryName);
+
+  FILESYSTEM_STAT_DATA expectedStatData;
+  FILESYSTEM_STAT_DATA statData;
+  PathString fileName;
+  fileName.Format("%s/dir1/sub2/file7.txt", s_testDirectoryName);
+  bool result =
+    CheckIndexSearch(index, s_testDirectoryName, "*.txt", recursiveFiles, fileCount) &&
+    CheckIndexSearch(index, s_testDirectoryName, "*.txt", recursiveFiles | FILESYSTEM_FIND_HIDDEN_FILES,
+                     fileCount + 1) &&
+    CheckIndexSearch(index, s_testDirectoryName, "sub*", FILESYSTEM_FIND_RECURSIVE | FILESYSTEM_FIND_FOLDERS,
+                     s_directoryCount * s_subdirectoryCount) &&
+    CheckIndexSearch(index, s_testDirectoryName, "*", FILESYSTEM_FIND_FOLDERS, s_directoryCount) &&
+    CheckIndexSearch(index, path, "other.dat", recursiveFiles, s_subdirectoryCount) &&
+    CheckIndexSearch(index, path, "file2?.txt", recursiveFiles, s_subdirectoryCount * 5) &&
+    CheckIndexSearch(index, s_testDirectoryName, "*.none", recursiveFiles, 0) &&
+    FileSystem::StatFile(fileName, &expectedStatData) && index.StatFile(fileName, &statData) &&
+    statData.Size == expectedStatData.Size && statData.ModificationTime == expectedStatData.ModificationTime &&
+    index.FileExists(fileName) && !index.DirectoryExists(fileName) && index.DirectoryExists(path) &&
+    !index.FileExists(path) && index.DirectoryExists(s_testDirectoryName) &&
+    index.GetEntryCount() == fileCount + s_directoryCount * (s_subdirectoryCount * 2 + 1) + 1;
+
+  // relative paths, written with the OS separator as FindFilesParallel does
+  FileSystem::FindResultsArray found;
+  PathString expectedName;
+  expectedName.Format("sub1%cfile24.txt", FS_OSPATH_SEPERATOR_CHARACTER);
+  result = result && index.FindFiles(path, "file24.txt", recursiveFiles | FILESYSTEM_FIND_RELATIVE_PATHS, &found);
+  found.Sort(CompareFindData);
+  result = result && found.GetSize() == s_subdirectoryCount && expectedName.Compare(found[1].FileName);
+
+  // and pass on what isn't under its root
+  fileName.Format("%s/dir1/sub2/../../../Nowhere/file7.txt", s_testDirectoryName);
+  result = result && !index.FileExists(fileName) && index.DirectoryExists(".");
+  if (!result)
+    Log_ErrorPrintf("FAIL: index %s", testName);
+
+  return result;
+}
+
+static bool TestFileSystemIndex(ThreadPool* pThreadPool)
+{
+  static const char snapshotFileName[] = "TestFileSystem.index";
+
+  FileSystemIndex index;
+  if (!index.Build(s_testDirectoryName, pThreadPool, false) || !CheckIndex(index, "build") ||
+      !index.SaveSnapshot(snapshotFileName))
+  {
+    return false;
+  }
+
+  // the snapshot has everything, and anything added since is seen
+  PathString lateFileName;
+  lateFileName.Format("%s/dir2/sub1/late.txt", s_testDirectoryName);
+  FileSystemIndex loadedIndex;
+  bool result = loadedIndex.LoadSnapshot(s_testDirectoryName, snapshotFileName, pThreadPool, false) &&
+                CheckIndex(loadedIndex, "snapshot") && WriteFile(lateFileName, 3) &&
+                loadedIndex.LoadSnapshot(s_testDirectoryName, snapshotFileName, pThreadPool, false) &&
+                loadedIndex.FileExists(lateFileName) && FileSystem::DeleteFile(lateFileName);
+  if (!result)
+    Log_ErrorPrint("FAIL: index snapshot");
+
+  result = result && !loadedIndex.LoadSnapshot("TestFileSystem.other", snapshotFileName, pThreadPool, false) &&
+           loadedIndex.GetEntryCount() == 0;
+  FileSystem::DeleteFile(snapshotFileName);
+
+  if (result)
+    Log_InfoPrint("PASS: index");
+
+  return result;
+}
+
+#if defined(Y_PLATFORM_LINUX)
+
+static bool TestWatchedFileSystemIndex(ThreadPool* pThreadPool)
+{
+  FileSystemIndex index;
+  if (!index.Build(s_testDirectoryName, pThreadPool, true))
+    return false;
+
+  PathString path;
+  PathString newPath;
+  path.Format("%s/dir0/new.txt", s_testDirectoryName);
+  WriteFile(path, 4);
+  FILESYSTEM_STAT_DATA statData;
+  bool result = !index.FileExists(path) && index.Update(pThreadPool) && index.StatFile(path, &statData) &&
+                statData.Size == 4 && !index.Update(pThreadPool);
+
+  // a directory renamed takes everything below with it
+  path.Format("%s/dir7", s_testDirectoryName);
+  newPath.Format("%s/dir7.renamed", s_testDirectoryName);
+  result = result && std::rename(path, newPath) == 0 && index.Update(pThreadPool) && !index.DirectoryExists(path) &&
+           index.DirectoryExists(newPath);
+  newPath.Format("%s/dir7.renamed/sub3/file24.txt", s_testDirectoryName);
+  result = result && index.FileExists(newPath);
+  newPath.Format("%s/dir7.renamed", s_testDirectoryName);
+  result = result && std::rename(newPath, path) == 0;
+
+  // created and removed
+  path.Format("%s/dir0/new.txt", s_testDirectoryName);
+  result = result && FileSystem::DeleteFile(path) && index.Update(pThreadPool) && !index.FileExists(path) &&
+           CheckIndex(index, "after updates");
+  if (result)
+    Log_InfoPrint("PASS: watched index");
+  else
+    Log_ErrorPrint("FAIL: watched index");
+
+  return result;
+}
+
+#endif
+
+DEFINE_TEST_SUITE(FileSystem)
+{
+  FileSystem::DeleteDirectory(s_testDirectoryName, true);
+  if (!CreateTestTree())
+  {
+    Log_ErrorPrint("FAIL: creating the test directories");
+    FileSystem::DeleteDirectory(s_testDirectoryName, true);
+    return false;
+  }
+
+  ThreadPool threadPool(4);
+  bool result = TestParallelFind(nullptr) && TestParallelFind(&threadPool);
+  if (result)
+  {
+    Log_InfoPrint("PASS: parallel find");
+
+    Timer timer;
+    FileSystem::FindResultsArray results;
+    FileSystem::FindFiles(s_testDirectoryName, "*", FILESYSTEM_FIND_RECURSIVE | FILESYSTEM_FIND_FILES, &results);
+    double serialTime = timer.GetTimeMilliseconds();
+
+    // FindFiles doesn't stat on POSIX, so the fair comparison is without
+    timer.Reset();
+    Y_ATOMIC_DECL uint32 count = 0;
+    FileSystem::FindFilesParallel(s_testDirectoryName, "*",
+                                  FILESYSTEM_FIND_RECURSIVE | FILESYSTEM_FIND_FILES | FILESYSTEM_FIND_NO_STAT,
+                                  &threadPool, [&count](const FILESYSTEM_FIND_DATA*) { Y_AtomicIncrement(count); });
+    double parallelTime = timer.GetTimeMilliseconds();
+
+    timer.Reset();
+    FileSystem::FindFilesParallel(s_testDirectoryName, "*", FILESYSTEM_FIND_RECURSIVE | FILESYSTEM_FIND_FILES,
+                                  &threadPool, [](const FILESYSTEM_FIND_DATA*) {});
+    double statTime = timer.GetTimeMilliseconds();
+    Log_InfoPrintf("%u files: FindFiles %.2fms, FindFilesParallel %.2fms, with sizes and times %.2fms", count,
+                   serialTime, parallelTime, statTime);
+  }
+
+  result = result && TestStatFiles(nullptr) && TestStatFiles(&threadPool);
+  if (result)
+    Log_InfoPrint("PASS: stat files");
+
+  result = result && TestFileSystemIndex(&threadPool);
+#if defined(Y_PLATFORM_LINUX)
+  result = result && TestWatchedFileSystemIndex(&threadPool);
+#endif
+
+  result = FileSystem::DeleteDirectory(s_testDirectoryName, true) &&
+           !FileSystem::DirectoryExists(s_testDirectoryName) && result;
+
+#if defined(Y_PLATFORM_LINUX)
+  result = TestChangeNotifier() && result;
+#endif
+
+  return result;
+}
@@ -0,0 +1,173 @@
+#include "TestSuite.h"
+#include "YBaseLib/BTreeMap.h"
+#include "YBaseLib/FlatMap.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+Log_SetChannel(TestFlatMap);
+
+static uint32 NextRandom(uint32& state)
+{
+  state = state * 1664525 + 1013904223;
+  return state >> 8;
+}
+
+static const uint32 KEY_RANGE = 4096;
+
+// walks the whole map and a range of it, comparing with the reference, where values[key] is 0 for missing keys
+template<class MapType>
+static bool MatchesReference(const MapType& map, const PODArray<uint32>& values, uint32 low, uint32 high)
+{
+  uint32 count = 0;
+  uint32 key = 0;
+  for (typename MapType::ConstIterator itr = map.Begin(); !itr.AtEnd(); itr.Forward())
+  {
+    while (key < KEY_RANGE && values[key] == 0)
+      key++;
+    if (key == KEY_RANGE || itr->Key != key || itr->Value != values[key])
+      return false;
+
+    key++;
+    count++;
+  }
+
+  while (key < KEY_RANGE && values[key] == 0)
+    key++;
+  if (key != KEY_RANGE || count != map.GetMemberCount())
+    return false;
+
+  // [low, high] from the bounds
+  key = low;
+  typename MapType::ConstIterator end = map.UpperBound(high);
+  for (typename MapType::ConstIterator itr = map.LowerBound(low); itr != end; itr++)
+  {
+    while (key <= high && values[key] == 0)
+      key++;
+    if (key > high || itr->Key != key)
+      return false;
+
+    key++;
+  }
+
+  while (key <= high && values[key] == 0)
+    key++;
+  return (key > high);
+}
+
+template<class MapType>
+static bool TestRandomChanges(MapType& map)
+{
+  PODArray<uint32> values;
+  for (uint32 i = 0; i < KEY_RANGE; i++)
+    values.Add(0);
+
+  uint32 state = 7;
+  bool result = true;
+  for (uint32 i = 0; i < 40000 && result; i++)
+  {
+    uint32 key = NextRandom(state) % KEY_RANGE;
+
+    // mostly adding until the map is well filled, then mostly removing
+    bool add = (NextRandom(state) % 100) < ((i < 20000) ? 70u : 30u);
+    if (add)
+    {
+      bool isNew;
+      uint32 value = NextRandom(state) | 1;
+      typename MapType::Member* pMember = map.Set(key, value, &isNew);
+      result = isNew == (values[key] == 0) && pMember->Key == key && pMember->Value == value;
+      values[key] = value;
+    }
+    else
+    {
+      result = map.Remove(key) == (values[key] != 0);
+      values[key] = 0;
+    }
+
+    const typename MapType::Member* pFound = static_cast<const MapType&>(map).Find(NextRandom(state) % KEY_RANGE);
+    result = result && (pFound == nullptr || pFound->Value == values[pFound->Key]);
+
+    if ((i % 1000) == 999)
+    {
+      uint32 low = NextRandom(state) % KEY_RANGE;
+      uint32 high = low + NextRandom(state) % (KEY_RANGE - low);
+      result = result && MatchesReference(map, values, low, high);
+    }
+  }
+
+  // everything removed
+  for (uint32 key = 0; key < KEY_RANGE && result; key++)
+    result = map.Remove(key) == (values[key] != 0);
+  result = result && map.IsEmpty() && map.Begin().AtEnd() && map.LowerBound(0).AtEnd();
+  return result;
+}
+
+static bool TestFlatMapChanges()
+{
+  FlatMap<uint32, uint32> map;
+  bool result = TestRandomChanges(map);
+
+  // batches merged in, with later duplicates winning over earlier ones and over what's there
+  PODArray<uint32> values;
+  for (uint32 i = 0; i < KEY_RANGE; i++)
+    values.Add(0);
+
+  uint32 state = 3;
+  for (uint32 batch = 0; batch < 8 && result; batch++)
+  {
+    MemArray<FlatMap<uint32, uint32>::Member> members;
+    for (uint32 i = 0; i < 500; i++)
+    {
+      uint32 key = NextRandom(state) % KEY_RANGE;
+      uint32 value = NextRandom(state) | 1;
+      members.Add(FlatMap<uint32, uint32>::Member(key, value));
+      values[key] = value;
+    }
+
+    map.SetRange(members.GetBasePointer(), members.GetSize());
+    result = MatchesReference(map, values, batch * 100, batch * 100 + 1000);
+  }
+
+  if (result)
+    Log_InfoPrint("PASS: flat map");
+  else
+    Log_ErrorPrint("FAIL: flat map");
+  return result;
+}
+
+static bool TestBTreeMapChanges()
+{
+  // the smallest nodes make a deep tree, so splits and merges happen at every level
+  BTreeMap<uint32, uint32, std::less<uint32>, 48> smallNodes;
+  bool result = BTreeMap<uint32, uint32, std::less<uint32>, 48>::LeafCapacity == 4 && TestRandomChanges(smallNodes);
+
+  BTreeMap<uint32, uint32> defaultNodes;
+  result = result && TestRandomChanges(defaultNodes);
+
+  // in descending order, with keys apart so there are gaps for the bounds to land in
+  typedef BTreeMap<uint32, uint32, std::greater<uint32>> DescendingMap;
+  DescendingMap descending;
+  for (uint32 i = 0; i < 10000; i++)
+    descending.Insert(i * 2, i);
+  uint32 expected = 19998;
+  for (DescendingMap::Iterator itr = descending.Begin(); itr != descending.End(); ++itr)
+  {
+    result = result && itr->Key == expected;
+    expected -= 2;
+  }
+
+  result = result && descending.LowerBound(5001)->Key == 5000 && descending.UpperBound(5000)->Key == 4998 &&
+           descending.LowerBound(0)->Key == 0 && descending.UpperBound(0).AtEnd() && descending.Find(5001) == nullptr;
+
+  if (result)
+    Log_InfoPrint("PASS: B-tree map");
+  else
+    Log_ErrorPrint("FAIL: B-tree map");
+  return result;
+}
+
+DEFINE_TEST_SUITE(FlatMap)
+{
+  bool result = true;
+  result &= TestFlatMapChanges();
+  result &= TestBTreeMapChanges();
+  return result;
+}
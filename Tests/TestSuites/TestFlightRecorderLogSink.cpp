@@ -0,0 +1,197 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/FlightRecorderLogSink.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(TestFlightRecorderLogSink);
+
+static const char s_testFileName[] = "TestFlightRecorderLogSink.tmp";
+
+// reads back the messages logged by this suite, in the order the reader returns them
+static bool ReadMessages(PODArray<uint32>* pNumbers, PODArray<uint32>* pThreads, uint32* pTruncatedCount,
+                         uint32* pTornCount)
+{
+  ByteStream* pStream = FileSystem::OpenFile(s_testFileName, BYTESTREAM_OPEN_READ);
+  if (pStream == nullptr)
+    return false;
+
+  FlightRecorderReader reader(pStream);
+  pStream->Release();
+
+  FlightRecorderReader::Message message;
+  *pTruncatedCount = 0;
+  while (reader.ReadMessage(&message))
+  {
+    uint32 number;
+    if (message.ChannelName.Compare("TestFlightRecorderLogSink") &&
+        Y_sscanf(message.Text, "recorded message %u", &number) == 1)
+    {
+      pNumbers->Add(number);
+      pThreads->Add(message.Thread);
+      *pTruncatedCount += message.Truncated ? 1 : 0;
+    }
+  }
+
+  *pTornCount = reader.GetTornRecordCount();
+  return !reader.IsDamaged();
+}
+
+// messages can be read back while the file is still mapped, as they'd be after a crash
+static bool TestRecording()
+{
+  FlightRecorderLogSink recorder;
+  bool result = recorder.Open(s_testFileName, 4, 16, 256);
+  for (uint32 i = 0; i < 10; i++)
+    Log_InfoPrintf("recorded message %u", i);
+
+  PODArray<uint32> numbers;
+  PODArray<uint32> threads;
+  uint32 truncatedCount, tornCount;
+  result = result && recorder.Flush() && ReadMessages(&numbers, &threads, &truncatedCount, &tornCount) &&
+           numbers.GetSize() == 10 && truncatedCount == 0 && tornCount == 0;
+  for (uint32 i = 0; result && i < numbers.GetSize(); i++)
+    result = (numbers[i] == i && threads[i] == threads[0]);
+
+  recorder.Close();
+  FileSystem::DeleteFile(s_testFileName);
+  if (result)
+    Log_InfoPrint("PASS: recording");
+  else
+    Log_ErrorPrintf("FAIL: recording (%u messages)", numbers.GetSize());
+  return result;
+}
+
+// a lane keeps its newest messages, and ones too long for a record are cut short
+static bool TestWraparound()
+{
+  FlightRecorderLogSink recorder;
+  recorder.SetLevelFilter(LOGLEVEL_INFO);
+  bool result = recorder.Open(s_testFileName, 1, 8, 128);
+  for (uint32 i = 0; i < 20; i++)
+    Log_InfoPrintf("recorded message %u", i);
+  Log_DevPrintf("recorded message %u", 100);
+  String padding;
+  padding.Resize(200, 'x');
+  Log_InfoPrintf("recorded message %u %s", 20, padding.GetCharArray());
+  recorder.Close();
+
+  PODArray<uint32> numbers;
+  PODArray<uint32> threads;
+  uint32 truncatedCount, tornCount;
+  result = result && ReadMessages(&numbers, &threads, &truncatedCount, &tornCount) && numbers.GetSize() == 8 &&
+           truncatedCount == 1 && tornCount == 0;
+  for (uint32 i = 0; result && i < numbers.GetSize(); i++)
+    result = (numbers[i] == 13 + i);
+
+  FileSystem::DeleteFile(s_testFileName);
+  if (result)
+    Log_InfoPrint("PASS: wraparound");
+  else
+    Log_ErrorPrintf("FAIL: wraparound (%u messages)", numbers.GetSize());
+  return result;
+}
+
+class LoggingThread : public Thread
+{
+public:
+  LoggingThread(uint32 firstNumber) : m_firstNumber(firstNumber) {}
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    for (uint32 i = 0; i < 100; i++)
+      Log_InfoPrintf("recorded message %u", m_firstNumber + i);
+    return 0;
+  }
+
+private:
+  uint32 m_firstNumber;
+};
+
+// each thread's messages are all there, in the order it logged them
+static bool TestThreads()
+{
+  FlightRecorderLogSink recorder;
+  bool result = recorder.Open(s_testFileName, 4, 128, 128);
+
+  LoggingThread* threads[4];
+  for (uint32 i = 0; i < countof(threads); i++)
+  {
+    threads[i] = new LoggingThread(i * 1000);
+    threads[i]->Start();
+  }
+  for (uint32 i = 0; i < countof(threads); i++)
+  {
+    threads[i]->Join();
+    delete threads[i];
+  }
+  recorder.Close();
+
+  PODArray<uint32> numbers;
+  PODArray<uint32> threadNumbers;
+  uint32 truncatedCount, tornCount;
+  result = result && ReadMessages(&numbers, &threadNumbers, &truncatedCount, &tornCount) &&
+           numbers.GetSize() == 400 && tornCount == 0;
+
+  uint32 nextNumbers[countof(threads)] = {0, 1000, 2000, 3000};
+  for (uint32 i = 0; result && i < numbers.GetSize(); i++)
+  {
+    uint32 thread = numbers[i] / 1000;
+    result = (thread < countof(threads) && numbers[i] == nextNumbers[thread]);
+    nextNumbers[thread]++;
+  }
+
+  FileSystem::DeleteFile(s_testFileName);
+  if (result)
+    Log_InfoPrint("PASS: threads");
+  else
+    Log_ErrorPrintf("FAIL: threads (%u messages)", numbers.GetSize());
+  return result;
+}
+
+static bool TestDecodeToText()
+{
+  FlightRecorderLogSink recorder;
+  bool result = recorder.Open(s_testFileName, 1, 16, 256);
+  Log_WarningPrintf("recorded message %u", 1);
+  recorder.Close();
+
+  ByteStream* pInput = FileSystem::OpenFile(s_testFileName, BYTESTREAM_OPEN_READ);
+  GrowableMemoryByteStream* pOutput = ByteStream_CreateGrowableMemoryStream();
+  result = result && pInput != nullptr && FlightRecorderReader::DecodeToText(pInput, pOutput);
+
+  String text;
+  text.AppendString(reinterpret_cast<const char*>(pOutput->GetMemoryPointer()), (uint32)pOutput->GetSize());
+  result = result && text.StartsWith("Flight recording started at unix time ") &&
+           text.Find("TestDecodeToText") >= 0 && text.Find("recorded message 1\n") >= 0;
+  if (pInput != nullptr)
+    pInput->Release();
+  pOutput->Release();
+
+  // anything else is damaged
+  static const char notARecording[] = "this is not a flight recording, but is long enough to have been one if it were";
+  ByteStream* pGarbage = ByteStream_CreateReadOnlyMemoryStream(notARecording, sizeof(notARecording));
+  pOutput = ByteStream_CreateGrowableMemoryStream();
+  result = result && !FlightRecorderReader::DecodeToText(pGarbage, pOutput) && pOutput->GetSize() == 0;
+  pGarbage->Release();
+  pOutput->Release();
+
+  FileSystem::DeleteFile(s_testFileName);
+  if (result)
+    Log_InfoPrint("PASS: decode to text");
+  else
+    Log_ErrorPrintf("FAIL: decode to text");
+  return result;
+}
+
+DEFINE_TEST_SUITE(FlightRecorderLogSink)
+{
+  bool result = TestRecording();
+  result &= TestWraparound();
+  result &= TestThreads();
+  result &= TestDecodeToText();
+  return result;
+}
@@ -0,0 +1,134 @@
+#include "TestSuite.h"
+#include "YBaseLib/GlobPattern.h"
+#include "YBaseLib/Log.h"
+Log_SetChannel(TestGlobPattern);
+
+static bool TestMatch(const char* pattern, uint32 flags, const char* subject, bool expectedResult)
+{
+  GlobPattern globPattern(pattern, flags);
+  bool result = globPattern.Match(subject);
+  if (result == expectedResult)
+  {
+    Log_InfoPrintf("PASS: '%s' %s '%s'", pattern, result ? "matches" : "does not match", subject);
+    return true;
+  }
+
+  Log_ErrorPrintf("FAIL: '%s' %s '%s'", pattern, result ? "matches" : "does not match", subject);
+  return false;
+}
+
+DEFINE_TEST_SUITE(GlobPattern)
+{
+  static const uint32 CI = GlobPattern::FLAG_CASE_INSENSITIVE;
+  struct TestCase
+  {
+    const char* pattern;
+    uint32 flags;
+    const char* subject;
+    bool expectedResult;
+  };
+  static const TestCase testCases[] = {
+    // literals
+    {"file.txt", 0, "file.txt", true},
+    {"file.txt", 0, "file.tx", false},
+    {"file.txt", 0, "file.txt2", false},
+    {"file.txt", 0, "File.txt", false},
+    {"file.txt", CI, "FILE.TXT", true},
+
+    // stars
+    {"*.txt", 0, "file.txt", true},
+    {"*.txt", 0, ".txt", true},
+    {"*.txt", 0, "file.txt.bak", false},
+    {"prefix*", 0, "prefix", true},
+    {"prefix*", 0, "prefixed", true},
+    {"prefix*", 0, "prefi", false},
+    {"a*b*c", 0, "abc", true},
+    {"a*b*c", 0, "aXXbYYc", true},
+    {"a*b*c", 0, "abcb", false},
+    {"a*b*c", 0, "acb", false},
+    {"*a*a*", 0, "banana", true},
+    {"*x*", 0, "banana", false},
+    {"*.TXT", CI, "file.txt", true},
+
+    // single characters
+    {"file?.txt", 0, "file1.txt", true},
+    {"file?.txt", 0, "file.txt", false},
+    {"file?.txt", 0, "file12.txt", false},
+    {"???", 0, "abc", true},
+    {"???", 0, "ab", false},
+
+    // classes
+    {"file[0-9].txt", 0, "file5.txt", true},
+    {"file[0-9].txt", 0, "filea.txt", false},
+    {"file[!0-9].txt", 0, "filea.txt", true},
+    {"file[^0-9].txt", 0, "file5.txt", false},
+    {"[abc]*", 0, "banana", true},
+    {"[abc]*", 0, "dog", false},
+    {"[]]", 0, "]", true},
+    {"[a-]", 0, "-", true},
+    {"[A-Z]*", CI, "lower", true},
+    {"[a-z]*", CI, "UPPER", true},
+    {"[a-z]*", 0, "UPPER", false},
+    {"file[0.txt", 0, "file[0.txt", true},
+    {"file[0.txt", 0, "file0.txt", false},
+
+    // separators
+    {"*.txt", 0, "dir/file.txt", false},
+    {"dir/*", 0, "dir/file.txt", true},
+    {"dir/*", 0, "dir/sub/file.txt", false},
+    {"**.txt", 0, "dir/sub/file.txt", true},
+    {"dir/**/*.txt", 0, "dir/sub/file.txt", true},
+    {"dir/**/*.txt", 0, "dir/sub/sub/file.txt", true},
+    {"dir/?", 0, "dir//", false},
+    {"dir[/]x", 0, "dir/x", false},
+
+    // alternatives
+    {"*.png;*.tga", 0, "image.tga", true},
+    {"*.png;*.tga", 0, "image.png", true},
+    {"*.png;*.tga", 0, "image.jpg", false},
+    {"a;;b", 0, "b", true},
+
+    // empty patterns match nothing
+    {"", 0, "", false},
+    {"", 0, "file", false},
+    {";", 0, "file", false},
+  };
+
+  bool result = true;
+  for (uint32 i = 0; i < countof(testCases); i++)
+  {
+    if (!TestMatch(testCases[i].pattern, testCases[i].flags, testCases[i].subject, testCases[i].expectedResult))
+      result = false;
+  }
+
+  // shortcuts for matching everything
+  GlobPattern pattern;
+  if (!pattern.IsEmpty() || pattern.MatchesAll() || pattern.Match("file"))
+  {
+    Log_ErrorPrint("FAIL: empty pattern");
+    result = false;
+  }
+
+  pattern.Compile("*.txt");
+  if (pattern.IsEmpty() || pattern.MatchesAll())
+  {
+    Log_ErrorPrint("FAIL: '*.txt' matches all");
+    result = false;
+  }
+
+  pattern.AddPattern("**");
+  if (!pattern.MatchesAll() || !pattern.Match("dir/file.bin"))
+  {
+    Log_ErrorPrint("FAIL: '*.txt;**' does not match all");
+    result = false;
+  }
+
+  pattern.Clear();
+  if (!pattern.IsEmpty() || pattern.MatchesAll())
+  {
+    Log_ErrorPrint("FAIL: cleared pattern");
+    result = false;
+  }
+
+  return result;
+}
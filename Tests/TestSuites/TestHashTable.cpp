@@ -0,0 +1,502 @@
+#include "TestSuite.h"
+#include "YBaseLib/CIStringHashTable.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/ConcurrentHashTable.h"
+#include "YBaseLib/FlatHashTable.h"
+#include "YBaseLib/HashTable.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/StringConverter.h"
+#include "YBaseLib/StringHashTable.h"
+#include "YBaseLib/StringPool.h"
+#include "YBaseLib/Thread.h"
+#include "YBaseLib/Timer.h"
+Log_SetChannel(TestHashTable);
+
+static bool TestFlatIntegerKeys()
+{
+  static const uint32 KEY_COUNT = 100000;
+  FlatHashTable<uint32, uint32> table;
+
+  for (uint32 i = 0; i < KEY_COUNT; i++)
+    table.Insert(i, i * 3);
+
+  // remove every other key, leaving tombstones behind
+  for (uint32 i = 0; i < KEY_COUNT; i += 2)
+  {
+    if (!table.Remove(i))
+    {
+      Log_ErrorPrintf("FAIL: could not remove key %u", i);
+      return false;
+    }
+  }
+
+  // refill part of the gap, reusing tombstones
+  for (uint32 i = 0; i < KEY_COUNT / 2; i += 2)
+    table.Insert(i, i * 3);
+
+  for (uint32 i = 0; i < KEY_COUNT; i++)
+  {
+    const FlatHashTable<uint32, uint32>::Member* pMember = table.Find(i);
+    bool expected = ((i & 1) != 0 || i < KEY_COUNT / 2);
+    if ((pMember != NULL) != expected || (pMember != NULL && pMember->Value != i * 3))
+    {
+      Log_ErrorPrintf("FAIL: lookup of key %u", i);
+      return false;
+    }
+  }
+
+  uint32 iterated = 0;
+  for (FlatHashTable<uint32, uint32>::ConstIterator itr = table.Begin(); !itr.AtEnd(); itr.Forward())
+    iterated++;
+
+  const uint32 expectedCount = KEY_COUNT / 2 + KEY_COUNT / 4;
+  if (iterated != expectedCount || table.GetMemberCount() != expectedCount)
+  {
+    Log_ErrorPrintf("FAIL: iterated %u members, table has %u, expected %u", iterated, table.GetMemberCount(),
+                    expectedCount);
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: flat table integer keys (%u members in %u slots)", table.GetMemberCount(),
+                 table.GetCapacity());
+  return true;
+}
+
+static bool TestFlatStringKeys()
+{
+  FlatHashTable<String, uint32> table;
+  SmallString key;
+  for (uint32 i = 0; i < 1000; i++)
+  {
+    key.Format("key%u", i);
+    table.Insert(key, i);
+  }
+
+  bool isNew;
+  table.Set("key10", 12345, &isNew);
+  if (isNew || table.Find("key10")->Value != 12345)
+  {
+    Log_ErrorPrintf("FAIL: set of an existing string key");
+    return false;
+  }
+
+  // copies must be independent of the original
+  FlatHashTable<String, uint32> copy(table);
+  table.Clear();
+  if (table.GetMemberCount() != 0 || table.Find("key999") != NULL || copy.GetMemberCount() != 1000 ||
+      copy.Find("key999") == NULL || copy.Find("key999")->Value != 999)
+  {
+    Log_ErrorPrintf("FAIL: copy/clear of string keys");
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: flat table string keys");
+  return true;
+}
+
+static bool TestHashFunctions()
+{
+  // reference vectors for wyhash, seeded with the index
+  static const struct
+  {
+    const char* Input;
+    uint64 Expected;
+  } vectors[] = {
+    {"", 0x0409638ee2bde459ULL},
+    {"a", 0xa8412d091b5fe0a9ULL},
+    {"abc", 0x32dd92e4b2915153ULL},
+    {"message digest", 0x8619124089a3a16bULL},
+    {"abcdefghijklmnopqrstuvwxyz", 0x7a43afb61d7f5f40ULL},
+    {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", 0xff42329b90e50d58ULL},
+    {"12345678901234567890123456789012345678901234567890123456789012345678901234567890", 0xc39cab13b115aad3ULL},
+  };
+
+  for (uint32 i = 0; i < countof(vectors); i++)
+  {
+    uint64 hash = Y_HashBytes64(vectors[i].Input, Y_strlen(vectors[i].Input), i);
+    if (hash != vectors[i].Expected)
+    {
+      Log_ErrorPrintf("FAIL: hash of '%s' is %016llx, expected %016llx", vectors[i].Input, hash, vectors[i].Expected);
+      return false;
+    }
+  }
+
+  // sequential integers should spread over the low bits
+  uint32 bucketHits[64] = {};
+  for (uint32 i = 0; i < 6400; i++)
+    bucketHits[HashTrait<uint32>::GetHash(i) & 63]++;
+  for (uint32 i = 0; i < countof(bucketHits); i++)
+  {
+    if (bucketHits[i] < 50 || bucketHits[i] > 150)
+    {
+      Log_ErrorPrintf("FAIL: integer hash put %u of 6400 keys in bucket %u", bucketHits[i], i);
+      return false;
+    }
+  }
+
+  Log_InfoPrintf("PASS: hash functions");
+  return true;
+}
+
+// the Jenkins hash over Y_tolower that case-insensitive tables used before, for timing
+static HashType JenkinsLowerCaseHash(const char* Str, uint32 Length)
+{
+  uint32 hash = 0;
+  for (uint32 i = 0; i < Length; i++)
+  {
+    hash += Y_tolower(Str[i]);
+    hash += (hash << 10);
+    hash ^= (hash >> 6);
+  }
+
+  hash += (hash << 3);
+  hash ^= (hash >> 11);
+  hash += (hash << 15);
+  return (HashType)hash;
+}
+
+static bool TestCaseInsensitiveHash()
+{
+  // lengths either side of the vector widths and of the folding block
+  char upper[600], lower[600], different[600];
+  for (uint32 i = 0; i < countof(lower); i++)
+  {
+    lower[i] = different[i] = char('a' + i % 26);
+    upper[i] = char('A' + i % 26);
+  }
+  for (uint32 length = 0; length <= countof(lower); length++)
+  {
+    HashType hash = Y_HashStringCaseInsensitive(lower, length);
+    // keys up to one block hash like their lower-case bytes
+    if (Y_HashStringCaseInsensitive(upper, length) != hash || (length <= 256 && Y_HashBytes(lower, length) != hash))
+    {
+      Log_ErrorPrintf("FAIL: case-insensitive hash differs by case at length %u", length);
+      return false;
+    }
+    if (length > 0)
+    {
+      different[length - 1] = '@';
+      bool same = (Y_HashStringCaseInsensitive(different, length) == hash);
+      different[length - 1] = lower[length - 1];
+      if (same)
+      {
+        Log_ErrorPrintf("FAIL: case-insensitive hash ignores the last character at length %u", length);
+        return false;
+      }
+    }
+  }
+
+  // only ASCII letters fold, the characters 0x20 below or above other letters don't
+  static const char notLetters[] = "@[\\]^_\xC0";
+  static const char notLettersPlus20[] = "`{|}~\x7F\xE0";
+  for (uint32 i = 0; i < countof(notLetters) - 1; i++)
+  {
+    if (Y_HashStringCaseInsensitive(notLetters + i, 1) == Y_HashStringCaseInsensitive(notLettersPlus20 + i, 1))
+    {
+      Log_ErrorPrintf("FAIL: case-insensitive hash folds character %02x", uint32(byte(notLetters[i])));
+      return false;
+    }
+  }
+
+  // lookups with keys in a different case from the one they were inserted with
+  CIStringHashTable<uint32> table;
+  SmallString key;
+  for (uint32 i = 0; i < 2000; i++)
+  {
+    key.Format("Textures/Environment/Rock_%04u_Diffuse.DDS", i);
+    table.Insert(key, i);
+  }
+  for (uint32 i = 0; i < 2000; i++)
+  {
+    key.Format("textures/ENVIRONMENT/rock_%04u_diffuse.dds", i);
+    const CIStringHashTable<uint32>::Member* pMember = table.Find(key);
+    if (pMember == NULL || pMember->Value != i)
+    {
+      Log_ErrorPrintf("FAIL: '%s' not found", key.GetCharArray());
+      return false;
+    }
+  }
+
+  // time against the per-character hash on path-length keys
+  static const uint32 Iterations = 200000;
+  Timer timer;
+  HashType sum = 0;
+  for (uint32 i = 0; i < Iterations; i++)
+    sum += JenkinsLowerCaseHash(key, key.GetLength() - (i & 7));
+  double jenkinsTime = timer.GetTimeMilliseconds();
+
+  timer.Reset();
+  for (uint32 i = 0; i < Iterations; i++)
+    sum += Y_HashStringCaseInsensitive(key, key.GetLength() - (i & 7));
+  double foldedTime = timer.GetTimeMilliseconds();
+
+  Log_InfoPrintf("PASS: case-insensitive hash (%u hashes of %u characters: Jenkins %.2fms, folded %.2fms, %08x)",
+                 Iterations, key.GetLength(), jenkinsTime, foldedTime, sum);
+  return true;
+}
+
+static bool TestChainedRehash()
+{
+  // removing while the buckets are being migrated, and looking up members on both sides of the migration
+  static const uint32 KEY_COUNT = 50000;
+  HashTable<uint32, uint32> table;
+  for (uint32 i = 0; i < KEY_COUNT; i++)
+  {
+    table.Insert(i, i + 1);
+    if ((i % 3) == 0 && !table.Remove(i / 3))
+    {
+      Log_ErrorPrintf("FAIL: could not remove key %u", i / 3);
+      return false;
+    }
+
+    const HashTable<uint32, uint32>::Member* pMember = table.Find(i);
+    if ((i % 3) != 0 && (pMember == NULL || pMember->Value != i + 1))
+    {
+      Log_ErrorPrintf("FAIL: lookup of key %u after insert", i);
+      return false;
+    }
+  }
+
+  uint32 found = 0;
+  for (uint32 i = 0; i < KEY_COUNT; i++)
+    found += (table.Find(i) != NULL) ? 1 : 0;
+
+  if (found != table.GetMemberCount() || (float)table.GetMemberCount() > table.GetBucketCount() * 2.0f)
+  {
+    Log_ErrorPrintf("FAIL: found %u of %u members in %u buckets", found, table.GetMemberCount(),
+                    table.GetBucketCount());
+    return false;
+  }
+
+  // reserving up front means no growth while filling
+  CIStringHashTable<uint32> nameTable;
+  nameTable.Reserve(1000);
+  uint32 reservedBuckets = nameTable.GetBucketCount();
+  SmallString name;
+  for (uint32 i = 0; i < 1000; i++)
+  {
+    name.Format("Name%u", i);
+    nameTable.Insert(name, i);
+  }
+
+  CIStringHashTable<uint32> nameCopy(nameTable);
+  if (nameTable.GetBucketCount() != reservedBuckets || nameCopy.Find("NAME500") == NULL ||
+      nameCopy.Find("NAME500")->Value != 500)
+  {
+    Log_ErrorPrintf("FAIL: reserved string table");
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: chained table rehash (%u members in %u buckets)", table.GetMemberCount(),
+                 table.GetBucketCount());
+  return true;
+}
+
+// Each thread bumps a shared set of counters, and owns a range of keys it inserts and removes.
+class ConcurrentTableThread : public Thread
+{
+public:
+  static const uint32 SHARED_KEY_COUNT = 64;
+  static const uint32 ITERATIONS = 20000;
+
+  ConcurrentTableThread(ConcurrentHashTable<uint32, uint32>* pTable, uint32 index)
+    : m_pTable(pTable), m_index(index), m_failed(false)
+  {
+  }
+
+  bool HasFailed() const { return m_failed; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    for (uint32 i = 0; i < ITERATIONS; i++)
+    {
+      m_pTable->InsertOrUpdate(i % SHARED_KEY_COUNT, 1, [](uint32& value) { value++; });
+
+      uint32 ownKey = 0x10000 * (m_index + 1) + i;
+      uint32 value;
+      if (!m_pTable->Insert(ownKey, i) || !m_pTable->Find(ownKey, &value) || value != i)
+        m_failed = true;
+      if ((i & 1) != 0 && !m_pTable->Remove(ownKey))
+        m_failed = true;
+    }
+
+    return 0;
+  }
+
+private:
+  ConcurrentHashTable<uint32, uint32>* m_pTable;
+  uint32 m_index;
+  bool m_failed;
+};
+
+static bool TestConcurrentTable()
+{
+  static const uint32 THREAD_COUNT = 4;
+  ConcurrentHashTable<uint32, uint32> table;
+  ConcurrentTableThread* threads[THREAD_COUNT];
+  for (uint32 i = 0; i < THREAD_COUNT; i++)
+  {
+    threads[i] = new ConcurrentTableThread(&table, i);
+    threads[i]->Start();
+  }
+
+  bool failed = false;
+  for (uint32 i = 0; i < THREAD_COUNT; i++)
+  {
+    threads[i]->Join();
+    failed |= threads[i]->HasFailed();
+    delete threads[i];
+  }
+
+  // every update to the shared keys has to have landed
+  uint32 sharedTotal = 0;
+  for (uint32 i = 0; i < ConcurrentTableThread::SHARED_KEY_COUNT; i++)
+    table.Visit(i, [&sharedTotal](const uint32& value) { sharedTotal += value; });
+
+  const uint32 expectedShared = THREAD_COUNT * ConcurrentTableThread::ITERATIONS;
+  const uint32 expectedCount =
+    ConcurrentTableThread::SHARED_KEY_COUNT + THREAD_COUNT * ConcurrentTableThread::ITERATIONS / 2;
+  if (failed || sharedTotal != expectedShared || table.GetMemberCount() != expectedCount)
+  {
+    Log_ErrorPrintf("FAIL: concurrent table has %u members (expected %u), shared total %u (expected %u)",
+                    table.GetMemberCount(), expectedCount, sharedTotal, expectedShared);
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: concurrent table (%u members over %u shards)", table.GetMemberCount(), table.GetShardCount());
+  return true;
+}
+
+static bool TestStringPool()
+{
+  StringPool pool;
+  SmallString name;
+  uint32 ids[3000];
+  for (uint32 i = 0; i < countof(ids); i++)
+  {
+    // every name twice, spanning several entry chunks
+    name.Format("name%u", i % 1500);
+    ids[i] = pool.Intern(name);
+  }
+
+  for (uint32 i = 0; i < 1500; i++)
+  {
+    name.Format("name%u", i);
+    if (ids[i] == 0 || ids[i] != ids[i + 1500] || pool.Find(name) != ids[i] ||
+        Y_strcmp(pool.GetString(ids[i]), name) != 0 || pool.GetHash(ids[i]) != HashTrait<String>::GetHash(name))
+    {
+      Log_ErrorPrintf("FAIL: interning of '%s'", name.GetCharArray());
+      return false;
+    }
+  }
+
+  if (pool.GetCount() != 1500 || pool.Intern("") != 0 || pool.Find("missing") != 0)
+  {
+    Log_ErrorPrintf("FAIL: string pool has %u strings", pool.GetCount());
+    return false;
+  }
+
+  // global atoms as hash table keys
+  HashTable<StringAtom, uint32> table;
+  table.Insert(StringAtom("Position"), 1);
+  table.Insert(StringAtom("Rotation"), 2);
+  const HashTable<StringAtom, uint32>::Member* pMember = table.Find(StringAtom::Find("Rotation"));
+  if (pMember == NULL || pMember->Value != 2 || Y_strcmp(pMember->Key.GetString(), "Rotation") != 0)
+  {
+    Log_ErrorPrintf("FAIL: atom keyed table");
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: string pool (%u strings, %u bytes)", pool.GetCount(), (uint32)pool.GetMemoryUsage());
+  return true;
+}
+
+static bool TestStringViewKeys()
+{
+  StringHashTable<uint32> table;
+  CIStringHashTable<uint32> ciTable;
+  table.Insert("alpha", 1);
+  table.Insert("beta", 2);
+  table.Insert("gamma", 3);
+  ciTable.Insert("Alpha", 1);
+  ciTable.Insert("Beta", 2);
+
+  // tokens are looked up and parsed in place, none of them are null-terminated
+  static const char buffer[] = " alpha = 10, BETA=0x20 ,gamma= -3,delta=4";
+  StringView remaining(buffer);
+  StringView token;
+  uint32 matched = 0;
+  int32 sum = 0;
+  while (remaining.NextToken(',', &token))
+  {
+    int32 equalsIndex = token.Find('=');
+    if (equalsIndex < 0)
+      return false;
+
+    StringView key = token.SubView(0, (uint32)equalsIndex).Strip();
+    StringView value = token.SubView((uint32)equalsIndex + 1).Strip();
+    const StringHashTable<uint32>::Member* pMember = table.Find(key);
+    const CIStringHashTable<uint32>::Member* pCIMember = ciTable.Find(key);
+    if (pMember != NULL || pCIMember != NULL)
+    {
+      matched++;
+      sum += StringConverter::StringToInt32(value);
+    }
+  }
+
+  if (matched != 3 || sum != 10 + 0x20 - 3 || table.Find(StringView("alphabet", 5)) == NULL ||
+      table.Find(StringView("alphabet", 6)) != NULL)
+  {
+    Log_ErrorPrintf("FAIL: string view lookups (%u matched, sum %d)", matched, sum);
+    return false;
+  }
+
+  // string operations against views, including a view of the string being assigned to
+  SmallString str("function_name(args)");
+  StringView view(str);
+  if (!str.StartsWith(view.SubView(0, 8)) || !str.EndsWith(StringView("ARGS)"), false) ||
+      str.Find(StringView("name(")) != 9 || str.Find(StringView("(argz", 4)) != 13 || str.Find("nope") != -1 ||
+      view.RFind('_') != 8 || !str.Compare(StringView("function_name(args) trailing", 19)) ||
+      str.NumericCompare(StringView("function")) <= 0 || !(StringView("abc") < StringView("abd")))
+  {
+    Log_ErrorPrintf("FAIL: string view compares");
+    return false;
+  }
+
+  str = str.SubView(9, 4);
+  String copy(StringView("copy of a view", 4));
+  copy.AppendString(StringView(":xyz", 2));
+  if (str != "name" || copy != "copy:x" || StringConverter::HexStringToBytes(&matched, 1, StringView("7fff", 2)) != 1 ||
+      (matched & 0xFF) != 0x7F)
+  {
+    Log_ErrorPrintf("FAIL: string view assignment ('%s', '%s')", str.GetCharArray(), copy.GetCharArray());
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: string view keys and compares");
+  return true;
+}
+
+DEFINE_TEST_SUITE(HashTable)
+{
+  if (!TestHashFunctions())
+    return false;
+  if (!TestCaseInsensitiveHash())
+    return false;
+  if (!TestChainedRehash())
+    return false;
+  if (!TestFlatIntegerKeys())
+    return false;
+  if (!TestFlatStringKeys())
+    return false;
+  if (!TestConcurrentTable())
+    return false;
+  if (!TestStringPool())
+    return false;
+  if (!TestStringViewKeys())
+    return false;
+
+  return true;
+}
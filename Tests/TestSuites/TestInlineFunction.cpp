@@ -0,0 +1,105 @@
+#include "TestSuite.h"
+#include "YBaseLib/Array.h"
+#include "YBaseLib/InlineFunction.h"
+#include "YBaseLib/Log.h"
+Log_SetChannel(TestInlineFunction);
+
+static int32 s_liveCaptures = 0;
+
+// counts its live copies, so moves that leak or destroy twice show up
+struct TrackedCapture
+{
+  TrackedCapture(uint32 value) : Value(value) { s_liveCaptures++; }
+  TrackedCapture(const TrackedCapture& other) : Value(other.Value) { s_liveCaptures++; }
+  ~TrackedCapture() { s_liveCaptures--; }
+
+  uint32 Value;
+};
+
+static uint32 AddOne(uint32 value)
+{
+  return value + 1;
+}
+
+static bool TestCalls()
+{
+  typedef InlineFunction<uint32(uint32)> Function;
+
+  bool result = true;
+  {
+    Function empty;
+    Function function(&AddOne);
+    uint32 offset = 10;
+    Function lambda([offset](uint32 value) { return value + offset; });
+    result = result && !empty && function && function(1) == 2 && lambda(1) == 11;
+
+    // state kept in the callable persists between calls
+    uint32 calls = 0;
+    InlineFunction<void()> counter([&calls]() { calls++; });
+    counter();
+    counter();
+    result = result && calls == 2;
+
+    // a capture larger than the inline storage is allocated, and behaves the same
+    byte padding[128] = {};
+    padding[127] = 5;
+    auto largeLambda = [padding](uint32 value) { return value + padding[127]; };
+    Function large(largeLambda);
+    result = result && !Function::FitsInline<decltype(largeLambda)>() && large(1) == 6;
+  }
+
+  if (result)
+    Log_InfoPrint("PASS: calls");
+  else
+    Log_ErrorPrint("FAIL: calls");
+  return result;
+}
+
+template<uint32 PADDING>
+static bool TestOwnership(const char* name)
+{
+  typedef InlineFunction<uint32()> Function;
+
+  bool result = true;
+  {
+    TrackedCapture capture(7);
+    byte padding[PADDING] = {};
+    Function first([capture, padding]() { return capture.Value + padding[0]; });
+    result = result && s_liveCaptures == 2;
+
+    // moving hands the callable over, leaving the source empty
+    Function second(std::move(first));
+    result = result && !first && second() == 7 && s_liveCaptures == 2;
+
+    Function third;
+    third = std::move(second);
+    result = result && !second && third() == 7 && s_liveCaptures == 2;
+
+    third = nullptr;
+    result = result && !third && s_liveCaptures == 1;
+
+    // arrays move their elements when they grow or remove
+    Array<Function> functions;
+    for (uint32 i = 0; i < 16; i++)
+      functions.Add(Function([capture, padding, i]() { return capture.Value + padding[0] + i; }));
+    functions.OrderedRemove(0);
+    functions.FastRemove(0);
+    result = result && s_liveCaptures == 15 && functions[0]() == 22 && functions[1]() == 9;
+  }
+  result = result && s_liveCaptures == 0;
+
+  if (result)
+    Log_InfoPrintf("PASS: %s ownership", name);
+  else
+    Log_ErrorPrintf("FAIL: %s ownership, %d captures live", name, s_liveCaptures);
+  return result;
+}
+
+DEFINE_TEST_SUITE(InlineFunction)
+{
+  bool result = true;
+  result &= TestCalls();
+  result &= TestOwnership<1>("inline");
+  result &= TestOwnership<128>("allocated");
+  return result;
+}
@@ -0,0 +1,242 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/JSON.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include <cstring>
+#include <limits>
+Log_SetChannel(TestJSON);
+
+static bool Expect(JSONReader& reader, JSONREADER_TOKEN_TYPE type, const char* name, const char* value)
+{
+  if (!reader.NextToken() || reader.GetTokenType() != type || Y_strcmp(reader.GetName(), name) != 0 ||
+      (value != NULL && (reader.GetValue() == NULL || Y_strcmp(reader.GetValue(), value) != 0)))
+  {
+    Log_ErrorPrintf("FAIL: expected token %u '%s'", uint32(type), name);
+    return false;
+  }
+
+  return true;
+}
+
+// every kind of token, with escapes decoded and numbers converted
+static bool TestTokens()
+{
+  static const char text[] = "\xEF\xBB\xBF{\n"
+                             "  \"name\": \"a \\\"quoted\\\" \\\\ \\/ \\b\\f\\n\\r\\t "
+                             "\\u00e9 \\u20AC \\ud83d\\ude00 \\ud800\",\n"
+                             "  \"plain\":\"text\", \"int\": -12, \"big\": 18446744073709551615, \"real\": 2.5e-1,\n"
+                             "  \"flags\": [true, false, null, [], {}],\n"
+                             "  \"esc\\u0061ped\": 0\n"
+                             "}\n";
+
+  ReadOnlyMemoryByteStream* pStream = ByteStream_CreateReadOnlyMemoryStream(text, sizeof(text) - 1);
+  JSONReader reader;
+  bool result = reader.Create(pStream, "tokens.json") && Expect(reader, JSONREADER_TOKEN_START_OBJECT, "", NULL) &&
+                reader.GetDepth() == 0 && reader.GetValue() == NULL &&
+                Expect(reader, JSONREADER_TOKEN_STRING, "name",
+                       "a \"quoted\" \\ / \b\f\n\r\t \xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80 \xEF\xBF\xBD") &&
+                reader.GetDepth() == 1;
+
+  // views point into the document until there's something to decode
+  result = result && Expect(reader, JSONREADER_TOKEN_STRING, "plain", NULL) &&
+           reader.GetValueView().GetData() > text && reader.GetValueView().GetData() < text + sizeof(text) &&
+           reader.GetValueView().Compare("text") && Expect(reader, JSONREADER_TOKEN_NUMBER, "int", "-12") &&
+           reader.IsInteger() && reader.GetInt64() == -12 && reader.GetUInt64() == 0 && reader.GetDouble() == -12.0 &&
+           Expect(reader, JSONREADER_TOKEN_NUMBER, "big", NULL) && reader.GetUInt64() == 18446744073709551615ull &&
+           reader.GetInt64() == 9223372036854775807ll && Expect(reader, JSONREADER_TOKEN_NUMBER, "real", "2.5e-1") &&
+           !reader.IsInteger() && reader.GetDouble() == 0.25 && reader.GetInt64() == 0;
+
+  result = result && Expect(reader, JSONREADER_TOKEN_START_ARRAY, "flags", NULL) &&
+           Expect(reader, JSONREADER_TOKEN_BOOLEAN, "", "true") && reader.GetBool() &&
+           Expect(reader, JSONREADER_TOKEN_BOOLEAN, "", "false") && !reader.GetBool() &&
+           Expect(reader, JSONREADER_TOKEN_NULL, "", "null") &&
+           Expect(reader, JSONREADER_TOKEN_START_ARRAY, "", NULL) && reader.GetDepth() == 2 &&
+           Expect(reader, JSONREADER_TOKEN_END_ARRAY, "", NULL) && reader.GetDepth() == 2 &&
+           Expect(reader, JSONREADER_TOKEN_START_OBJECT, "", NULL) &&
+           Expect(reader, JSONREADER_TOKEN_END_OBJECT, "", NULL) &&
+           Expect(reader, JSONREADER_TOKEN_END_ARRAY, "", NULL) &&
+           Expect(reader, JSONREADER_TOKEN_NUMBER, "escaped", "0") &&
+           reader.GetNameView().Compare("escaped") && Expect(reader, JSONREADER_TOKEN_END_OBJECT, "", NULL) &&
+           reader.GetDepth() == 0 && !reader.NextToken() && !reader.InErrorState();
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: tokens");
+  else
+    Log_ErrorPrint("FAIL: tokens");
+  return result;
+}
+
+// skipping whole values, and finding members by name
+static bool TestSkipping()
+{
+  static const char text[] = "{\"a\": {\"x\": [1, {\"b\": 2}]}, \"b\": [[], [3]], "
+                             "\"c\": {\"d\": 4, \"e\": 5}, \"f\": 6}";
+
+  ReadOnlyMemoryByteStream* pStream = ByteStream_CreateReadOnlyMemoryStream(text, sizeof(text) - 1);
+  JSONReader reader;
+  bool result = reader.Create(pStream, "skip.json") && reader.NextToken() && reader.SkipToMember("c") &&
+                reader.GetTokenType() == JSONREADER_TOKEN_START_OBJECT && reader.SkipToMember("e") &&
+                reader.GetInt64() == 5 && !reader.SkipToMember("missing") &&
+                reader.GetTokenType() == JSONREADER_TOKEN_END_OBJECT && reader.SkipToMember("f") &&
+                reader.GetInt64() == 6 && Expect(reader, JSONREADER_TOKEN_END_OBJECT, "", NULL) &&
+                !reader.NextToken() && !reader.InErrorState();
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: skipping");
+  else
+    Log_ErrorPrint("FAIL: skipping");
+  return result;
+}
+
+static bool CheckOutput(const char* testName, GrowableMemoryByteStream* pStream, const char* expected)
+{
+  uint32 expectedLength = Y_strlen(expected);
+  if (pStream->GetSize() != expectedLength || std::memcmp(pStream->GetMemoryPointer(), expected, expectedLength) != 0)
+  {
+    Log_ErrorPrintf("FAIL: %s: wrote '%.*s'", testName, uint32(pStream->GetSize()), pStream->GetMemoryPointer());
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: %s", testName);
+  return true;
+}
+
+static void WriteDocument(JSONWriter& writer)
+{
+  writer.StartObject();
+  writer.WriteName("name");
+  writer.WriteString("a \"b\" \\ \n\t\x01 \xE2\x82\xAC");
+  writer.WriteName("numbers");
+  writer.StartArray();
+  writer.WriteInt32(-12);
+  writer.WriteUInt64(18446744073709551615ull);
+  writer.WriteFloat(0.5f);
+  writer.WriteDouble(0.1);
+  writer.WriteDouble(std::numeric_limits<double>::infinity());
+  writer.EndArray();
+  writer.WriteName("empty");
+  writer.StartObject();
+  writer.EndObject();
+  writer.WriteName("flags");
+  writer.StartArray();
+  writer.WriteBool(true);
+  writer.WriteNull();
+  writer.WriteRaw("{\"raw\":1}", 9);
+  writer.EndArray();
+
+  // Close ends the object
+  writer.Close();
+}
+
+// indented and compact output, and strings longer than the buffer read back the same
+static bool TestWriter()
+{
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  {
+    JSONWriter writer;
+    writer.Create(pStream);
+    WriteDocument(writer);
+  }
+
+  bool result = CheckOutput("indented", pStream,
+                            "{\n"
+                            "    \"name\": \"a \\\"b\\\" \\\\ \\n\\t\\u0001 \xE2\x82\xAC\",\n"
+                            "    \"numbers\": [\n"
+                            "        -12,\n"
+                            "        18446744073709551615,\n"
+                            "        0.5,\n"
+                            "        0.1,\n"
+                            "        null\n"
+                            "    ],\n"
+                            "    \"empty\": {},\n"
+                            "    \"flags\": [\n"
+                            "        true,\n"
+                            "        null,\n"
+                            "        {\"raw\":1}\n"
+                            "    ]\n"
+                            "}\n");
+
+  pStream->Release();
+  pStream = ByteStream_CreateGrowableMemoryStream();
+  {
+    JSONWriter writer;
+    writer.Create(pStream, false);
+    WriteDocument(writer);
+  }
+
+  result = result && CheckOutput("compact", pStream,
+                                 "{\"name\":\"a \\\"b\\\" \\\\ \\n\\t\\u0001 \xE2\x82\xAC\","
+                                 "\"numbers\":[-12,18446744073709551615,0.5,0.1,null],\"empty\":{},"
+                                 "\"flags\":[true,null,{\"raw\":1}]}");
+
+  String value;
+  for (uint32 i = 0; i < 10000; i++)
+    value.AppendCharacter((i % 37 == 0) ? '\\' : ((i % 53 == 0) ? '"' : char('a' + (i % 26))));
+
+  pStream->Release();
+  pStream = ByteStream_CreateGrowableMemoryStream();
+  {
+    JSONWriter writer;
+    writer.Create(pStream);
+    writer.StartArray();
+    writer.WriteString(value);
+    writer.WriteName("misplaced");
+    result = result && writer.InErrorState();
+    writer.Close();
+  }
+
+  pStream->SeekAbsolute(0);
+  JSONReader reader;
+  result = result && reader.Create(pStream, "long.json") && reader.NextToken() && reader.NextToken() &&
+           Y_strcmp(reader.GetValue(), value) == 0 && Expect(reader, JSONREADER_TOKEN_END_ARRAY, "", NULL) &&
+           !reader.NextToken() && !reader.InErrorState();
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: long values");
+  else
+    Log_ErrorPrint("FAIL: long values");
+  return result;
+}
+
+// text that isn't JSON is an error, wherever it goes wrong
+static bool TestErrors()
+{
+  static const char* badDocuments[] = {
+    "", " ", "{", "[", "}", "{\"a\"}", "{\"a\":}", "{\"a\" 1}", "{a:1}", "{\"a\":1,}", "[1,]", "[,1]", "[1 2]",
+    "[1}", "{\"a\":1]", "\"abc", "\"a\\x\"", "\"\\u12g4\"", "\"\\u12\"", "\"a\tb\"", "01", "-", "1.", ".5", "1e",
+    "1e+", "+1", "tru", "nul", "truex", "1 2", "{} {}", "[1]]", "NaN",
+  };
+
+  bool result = true;
+  for (uint32 i = 0; i < countof(badDocuments); i++)
+  {
+    ReadOnlyMemoryByteStream* pStream =
+      ByteStream_CreateReadOnlyMemoryStream(badDocuments[i], Y_strlen(badDocuments[i]));
+    JSONReader reader;
+    if (reader.Create(pStream, "bad.json"))
+    {
+      while (reader.NextToken())
+        reader.GetValue();
+    }
+    if (!reader.InErrorState())
+    {
+      Log_ErrorPrintf("FAIL: '%s' read without an error", badDocuments[i]);
+      result = false;
+    }
+    pStream->Release();
+  }
+
+  if (result)
+    Log_InfoPrint("PASS: errors");
+  return result;
+}
+
+DEFINE_TEST_SUITE(JSON)
+{
+  return TestTokens() && TestSkipping() && TestWriter() && TestErrors();
+}
@@ -0,0 +1,133 @@
+#include "TestSuite.h"
+#include "YBaseLib/LightweightBarrier.h"
+#include "YBaseLib/LightweightSemaphore.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(TestLightweightSync);
+
+static const uint32 ThreadCount = 4;
+
+// Hands tokens back and forth through two semaphores, so both sides regularly end up asleep.
+class PingPongThread : public Thread
+{
+public:
+  static const uint32 Iterations = 20000;
+
+  PingPongThread(LightweightSemaphore* pPing, LightweightSemaphore* pPong) : m_pPing(pPing), m_pPong(pPong) {}
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    for (uint32 i = 0; i < Iterations; i++)
+    {
+      m_pPing->Wait();
+      m_pPong->Post();
+    }
+
+    return 0;
+  }
+
+private:
+  LightweightSemaphore* m_pPing;
+  LightweightSemaphore* m_pPong;
+};
+
+static bool TestSemaphore()
+{
+  LightweightSemaphore ping;
+  LightweightSemaphore pong;
+  PingPongThread thread(&ping, &pong);
+  thread.Start();
+  for (uint32 i = 0; i < PingPongThread::Iterations; i++)
+  {
+    ping.Post();
+    pong.Wait();
+  }
+  thread.Join();
+
+  // counts are kept, and only taken while there are some
+  LightweightSemaphore counted(2);
+  counted.Post(3);
+  uint32 taken = 0;
+  while (counted.TryWait())
+    taken++;
+
+  bool result = (taken == 5 && ping.GetCount() == 0 && pong.GetCount() == 0);
+  if (result)
+    Log_InfoPrintf("PASS: semaphore");
+  else
+    Log_ErrorPrintf("FAIL: semaphore, took %u", taken);
+  return result;
+}
+
+// Every thread writes its slot for the round, then checks everyone else's after the barrier.
+class BarrierThread : public Thread
+{
+public:
+  static const uint32 Rounds = 2000;
+
+  BarrierThread() : m_pBarrier(nullptr), m_pRounds(nullptr), m_index(0), m_failures(0) {}
+
+  void Setup(LightweightBarrier* pBarrier, volatile uint32* pRounds, uint32 index)
+  {
+    m_pBarrier = pBarrier;
+    m_pRounds = pRounds;
+    m_index = index;
+  }
+
+  uint32 GetFailures() const { return m_failures; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    for (uint32 round = 1; round <= Rounds; round++)
+    {
+      m_pRounds[m_index] = round;
+      m_pBarrier->Wait();
+      for (uint32 i = 0; i < ThreadCount; i++)
+      {
+        if (m_pRounds[i] < round)
+          m_failures++;
+      }
+      m_pBarrier->Wait();
+    }
+
+    return 0;
+  }
+
+private:
+  LightweightBarrier* m_pBarrier;
+  volatile uint32* m_pRounds;
+  uint32 m_index;
+  uint32 m_failures;
+};
+
+static bool TestBarrier()
+{
+  LightweightBarrier barrier(ThreadCount);
+  volatile uint32 rounds[ThreadCount] = {};
+  BarrierThread threads[ThreadCount];
+  for (uint32 i = 0; i < ThreadCount; i++)
+  {
+    threads[i].Setup(&barrier, rounds, i);
+    threads[i].Start();
+  }
+
+  uint32 failures = 0;
+  for (uint32 i = 0; i < ThreadCount; i++)
+  {
+    threads[i].Join();
+    failures += threads[i].GetFailures();
+  }
+
+  if (failures == 0)
+    Log_InfoPrintf("PASS: barrier");
+  else
+    Log_ErrorPrintf("FAIL: barrier, %u threads passed early", failures);
+  return (failures == 0);
+}
+
+DEFINE_TEST_SUITE(LightweightSync)
+{
+  return TestSemaphore() && TestBarrier();
+}
@@ -0,0 +1,221 @@
+#include "TestSuite.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/LockProfiler.h"
+#include "YBaseLib/Log.h"
+Log_SetChannel(TestLockProfiler);
+
+static bool TestRegistration()
+{
+  uint32 first = LockProfiler::RegisterLock("test.registration.first");
+  uint32 second = LockProfiler::RegisterLock("test.registration.second");
+
+  LockProfiler::LockStats stats;
+  bool result = first != 0 && second != 0 && first != second &&
+                LockProfiler::RegisterLock("test.registration.first") == first &&
+                LockProfiler::GetLockStats(second, &stats) && Y_strcmp(stats.Name, "test.registration.second") == 0 &&
+                !LockProfiler::GetLockStats(LockProfiler::GetLockCount(), &stats);
+
+  if (result)
+    Log_InfoPrintf("PASS: registration");
+  else
+    Log_ErrorPrintf("FAIL: registration");
+  return result;
+}
+
+#if Y_LOCK_PROFILING
+
+#include "YBaseLib/ConditionVariable.h"
+#include "YBaseLib/Event.h"
+#include "YBaseLib/Metrics.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/ReadWriteLock.h"
+#include "YBaseLib/RecursiveMutex.h"
+#include "YBaseLib/Thread.h"
+
+static LockProfiler::LockStats GetStats(const char* name)
+{
+  LockProfiler::LockStats stats;
+  LockProfiler::GetLockStats(LockProfiler::RegisterLock(name), &stats);
+  return stats;
+}
+
+static bool TestCounting()
+{
+  Mutex mutex;
+  Mutex unnamedMutex;
+  mutex.SetProfileName("test.counting");
+  for (uint32 i = 0; i < 100; i++)
+  {
+    mutex.Lock();
+    mutex.Unlock();
+    unnamedMutex.Lock();
+    unnamedMutex.Unlock();
+  }
+
+  for (uint32 i = 0; i < 10; i++)
+  {
+    if (mutex.TryLock())
+      mutex.Unlock();
+  }
+
+  // recursive acquisitions by the holder count once
+  RecursiveMutex recursiveMutex;
+  recursiveMutex.SetProfileName("test.counting.recursive");
+  recursiveMutex.Lock();
+  recursiveMutex.Lock();
+  if (recursiveMutex.TryLock())
+    recursiveMutex.Unlock();
+  recursiveMutex.Unlock();
+  recursiveMutex.Unlock();
+
+  LockProfiler::LockStats stats = GetStats("test.counting");
+  LockProfiler::LockStats recursiveStats = GetStats("test.counting.recursive");
+  bool result = stats.Acquisitions == 110 && stats.ContendedAcquisitions == 0 && stats.TotalWaitTime == 0 &&
+                recursiveStats.Acquisitions == 1 && recursiveStats.ContendedAcquisitions == 0;
+  if (result)
+    Log_InfoPrintf("PASS: counting");
+  else
+    Log_ErrorPrintf("FAIL: counting, %llu and %llu acquisitions", stats.Acquisitions, recursiveStats.Acquisitions);
+  return result;
+}
+
+// takes the lock, lets the main thread know, and keeps it for a while
+class HoldingThread : public Thread
+{
+public:
+  HoldingThread(Mutex* pMutex, Event* pLocked) : m_pMutex(pMutex), m_pLocked(pLocked) {}
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    m_pMutex->Lock();
+    m_pLocked->Signal();
+    Thread::Sleep(30);
+    m_pMutex->Unlock();
+    return 0;
+  }
+
+private:
+  Mutex* m_pMutex;
+  Event* m_pLocked;
+};
+
+static bool TestContention()
+{
+  LockProfiler::SetSampleRate(1);
+
+  Mutex mutex;
+  mutex.SetProfileName("test.contention");
+  Event locked;
+  HoldingThread thread(&mutex, &locked);
+  thread.Start();
+  locked.Wait();
+
+  // has to wait out the rest of the other thread's hold
+  mutex.Lock();
+  mutex.Unlock();
+  thread.Join();
+
+  LockProfiler::LockStats stats = GetStats("test.contention");
+  uint32 contentionLock = LockProfiler::RegisterLock("test.contention");
+  LockProfiler::StackSample samples[32];
+  uint32 sampleCount = LockProfiler::GetStackSamples(samples, countof(samples));
+  bool sampled = false;
+  for (uint32 i = 0; i < sampleCount; i++)
+    sampled |= (samples[i].Lock == contentionLock && samples[i].SampleCount == 1);
+
+  LockProfiler::SetSampleRate(16);
+
+  bool result = stats.Acquisitions == 2 && stats.ContendedAcquisitions == 1 && stats.MaxWaitTime >= 10000000 &&
+                stats.TotalWaitTime == stats.MaxWaitTime && stats.MaxHoldTime >= 25000000 && sampled;
+  if (result)
+  {
+    Log_InfoPrintf("PASS: contention, waited %.1f ms", (double)stats.MaxWaitTime / 1000000.0);
+  }
+  else
+  {
+    Log_ErrorPrintf("FAIL: contention, %llu of %llu contended, waited %llu ns, held %llu ns, %s",
+                    stats.ContendedAcquisitions, stats.Acquisitions, stats.MaxWaitTime, stats.MaxHoldTime,
+                    sampled ? "sampled" : "not sampled");
+  }
+  return result;
+}
+
+static bool TestConditionWait()
+{
+  // sleeping on a condition variable releases the lock, so isn't held time
+  Mutex mutex;
+  mutex.SetProfileName("test.condition_wait");
+  ConditionVariable conditionVariable;
+  mutex.Lock();
+  conditionVariable.SleepAndRelease(&mutex, 50);
+  mutex.Unlock();
+
+  LockProfiler::LockStats stats = GetStats("test.condition_wait");
+  bool result = stats.Acquisitions == 1 && stats.MaxHoldTime < 25000000;
+  if (result)
+    Log_InfoPrintf("PASS: condition wait");
+  else
+    Log_ErrorPrintf("FAIL: condition wait, held %llu ns", stats.MaxHoldTime);
+  return result;
+}
+
+static bool TestReadWriteLock()
+{
+  ReadWriteLock lock;
+  lock.SetProfileName("test.read_write");
+  lock.LockShared();
+  lock.LockShared();
+  lock.UnlockShared();
+  lock.UnlockShared();
+  lock.LockExclusive();
+  lock.UnlockExclusive();
+  if (lock.TryLockShared())
+    lock.UnlockShared();
+
+  LockProfiler::LockStats stats = GetStats("test.read_write");
+  bool result = stats.Acquisitions == 4 && stats.ContendedAcquisitions == 0;
+  if (result)
+    Log_InfoPrintf("PASS: read write lock");
+  else
+    Log_ErrorPrintf("FAIL: read write lock, %llu acquisitions", stats.Acquisitions);
+  return result;
+}
+
+static bool TestReporting()
+{
+  LockProfiler::Dump();
+  LockProfiler::PublishMetrics();
+
+  MetricsRegistry& registry = MetricsRegistry::GetInstance();
+  bool result = registry.GetGauge("lock.test.counting.acquisitions")->GetValue() == 110 &&
+                registry.GetGauge("lock.test.contention.contended")->GetValue() == 1;
+
+  // counters start again from zero
+  LockProfiler::Reset();
+  LockProfiler::StackSample sample;
+  result = result && GetStats("test.counting").Acquisitions == 0 && LockProfiler::GetStackSamples(&sample, 1) == 0;
+
+  if (result)
+    Log_InfoPrintf("PASS: reporting");
+  else
+    Log_ErrorPrintf("FAIL: reporting");
+  return result;
+}
+
+#endif // Y_LOCK_PROFILING
+
+DEFINE_TEST_SUITE(LockProfiler)
+{
+  bool result = TestRegistration();
+#if Y_LOCK_PROFILING
+  result &= TestCounting();
+  result &= TestContention();
+  result &= TestConditionWait();
+  result &= TestReadWriteLock();
+  result &= TestReporting();
+#else
+  Log_InfoPrintf("SKIP: lock profiling needs Y_LOCK_PROFILING");
+#endif
+  return result;
+}
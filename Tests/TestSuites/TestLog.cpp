@@ -0,0 +1,52 @@
+#include "TestSuite.h"
+#include "YBaseLib/Log.h"
+Log_SetChannel(TestLog);
+
+static uint32 s_evaluationCount = 0;
+
+static uint32 CountEvaluation()
+{
+  return ++s_evaluationCount;
+}
+
+static void CountingCallback(void* pUserParam, const char* channelName, const char* functionName, LOGLEVEL level,
+                             const char* message)
+{
+  if (level == LOGLEVEL_DEV)
+    (*static_cast<uint32*>(pUserParam))++;
+}
+
+// filtered channels don't evaluate the arguments, and pass them again once the filter is cleared
+static bool TestChannelFilter()
+{
+  uint32 callbackCount = 0;
+  Log::GetInstance().RegisterCallback(CountingCallback, &callbackCount);
+
+  Log::GetInstance().SetChannelFilterLevel("TestLog", LOGLEVEL_INFO);
+  bool filtered = !___LogChannelState___.IsLevelEnabled(LOGLEVEL_DEV);
+  Log_DevPrintf("evaluated %u", CountEvaluation());
+  Log_DevFmt("evaluated {}", CountEvaluation());
+  uint32 filteredCount = s_evaluationCount;
+
+  Log::GetInstance().SetChannelFilterLevel("TestLog", LOGLEVEL_COUNT);
+  Log_DevPrintf("evaluated %u", CountEvaluation());
+  Log_DevFmt("evaluated {}", CountEvaluation());
+
+  // the global level applies on top of the channel's
+  Log::GetInstance().SetFilterLevel(LOGLEVEL_INFO);
+  Log_DevPrintf("evaluated %u", CountEvaluation());
+  Log::GetInstance().SetFilterLevel(LOGLEVEL_TRACE);
+  Log::GetInstance().UnregisterCallback(CountingCallback, &callbackCount);
+
+  bool result = (filtered && filteredCount == 0 && s_evaluationCount == 2 && callbackCount == 2);
+  if (result)
+    Log_InfoPrint("PASS: channel filter");
+  else
+    Log_ErrorPrintf("FAIL: channel filter (%u evaluations, %u messages)", s_evaluationCount, callbackCount);
+  return result;
+}
+
+DEFINE_TEST_SUITE(Log)
+{
+  return TestChannelFilter();
+}
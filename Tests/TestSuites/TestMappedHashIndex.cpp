@@ -0,0 +1,168 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/MappedHashIndex.h"
+#include "YBaseLib/String.h"
+#include <cstring>
+Log_SetChannel(TestMappedHashIndex);
+
+static const char s_testFileName[] = "TestMappedHashIndex.tmp";
+
+struct TestValue
+{
+  uint64 Offset;
+  uint32 Size;
+  uint32 Flags;
+};
+
+static void GetKey(uint32 index, SmallString* pKey)
+{
+  pKey->Format("dir%u/file%u.dat", index % 37, index);
+}
+
+// every key with its value, and none of the ones that weren't added
+static bool CheckIndex(const MappedHashIndex& index, uint32 count)
+{
+  bool result = index.IsOpen() && index.GetEntryCount() == count + 1;
+  SmallString key;
+  for (uint32 i = 0; i < count && result; i++)
+  {
+    GetKey(i, &key);
+    const TestValue* pValue = index.FindValue<TestValue>(key);
+    result = pValue != nullptr && pValue->Offset == (uint64)i << 32 && pValue->Size == i && pValue->Flags == ~i &&
+             ((uintptr_t)pValue % MappedHashIndexFormat::ValueAlignment) == 0;
+
+    GetKey(i + count, &key);
+    result = result && !index.Contains(key);
+  }
+
+  // a different size isn't a T, and the empty key is a key like any other
+  uint32 valueSize = 0;
+  GetKey(0, &key);
+  const void* pEmptyValue = index.Find("", &valueSize);
+  result = result && index.FindValue<uint32>(key) == nullptr && pEmptyValue != nullptr && valueSize == 5 &&
+           std::memcmp(pEmptyValue, "empty", 5) == 0;
+  return result;
+}
+
+static bool TestIndex()
+{
+  const uint32 count = 5000;
+  MappedHashIndexWriter writer;
+  SmallString key;
+  bool result = true;
+  for (uint32 i = 0; i < count; i++)
+  {
+    GetKey(i, &key);
+    TestValue value = {(uint64)i << 32, i, ~i};
+    result = result && writer.Add(key, value);
+  }
+  result = result && writer.Add("", "empty", 5);
+
+  // the first value stays
+  TestValue duplicate = {};
+  GetKey(7, &key);
+  result = result && !writer.Add(key, duplicate) && writer.GetEntryCount() == count + 1;
+
+  // from memory, read in place
+  GrowableMemoryByteStream* pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+  result = result && writer.Write(pMemoryStream);
+  {
+    MappedHashIndex index;
+    result = result && index.Open(pMemoryStream) && CheckIndex(index, count);
+  }
+
+  // and mapped from a file
+  result = result && writer.WriteFile(s_testFileName);
+  {
+    MappedHashIndex index;
+    result = result && index.OpenFile(s_testFileName) && CheckIndex(index, count);
+    index.Close();
+    result = result && !index.IsOpen() && index.GetEntryCount() == 0 && !index.Contains(key);
+  }
+  FileSystem::DeleteFile(s_testFileName);
+
+  pMemoryStream->Release();
+
+  // an empty index finds nothing
+  writer.Clear();
+  pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+  result = result && writer.Write(pMemoryStream);
+  {
+    MappedHashIndex index;
+    result = result && index.Open(pMemoryStream) && index.GetEntryCount() == 0 && !index.Contains("");
+  }
+  pMemoryStream->Release();
+
+  if (result)
+    Log_InfoPrint("PASS: index");
+  else
+    Log_ErrorPrint("FAIL: index");
+  return result;
+}
+
+static bool TestDamagedImages()
+{
+  MappedHashIndexWriter writer;
+  SmallString key;
+  for (uint32 i = 0; i < 100; i++)
+  {
+    GetKey(i, &key);
+    writer.Add(key, i);
+  }
+
+  GrowableMemoryByteStream* pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+  bool result = writer.Write(pMemoryStream);
+  byte* pImage = pMemoryStream->GetMemoryPointer();
+  uint32 imageSize = (uint32)pMemoryStream->GetSize();
+  MappedHashIndexFormat::Header* pHeader = reinterpret_cast<MappedHashIndexFormat::Header*>(pImage);
+
+  // truncated, or with a bad header, it doesn't open
+  MappedHashIndex index;
+  ReadOnlyMemoryByteStream* pTruncatedStream = ByteStream_CreateReadOnlyMemoryStream(pImage, imageSize - 8);
+  result = result && !index.Open(pTruncatedStream);
+  pTruncatedStream->Release();
+
+  pHeader->SlotCount = 100;
+  result = result && !index.Open(pMemoryStream);
+  pHeader->SlotCount = writer.GetEntryCount();
+  result = result && !index.Open(pMemoryStream);
+
+  // with entries out of the pool, lookups miss rather than read past it
+  pMemoryStream->SeekAbsolute(0);
+  result = result && writer.Write(pMemoryStream);
+  pImage = pMemoryStream->GetMemoryPointer();
+  pHeader = reinterpret_cast<MappedHashIndexFormat::Header*>(pImage);
+  MappedHashIndexFormat::Slot* pSlots = reinterpret_cast<MappedHashIndexFormat::Slot*>(pHeader + 1);
+  for (uint32 i = 0; i < pHeader->SlotCount; i++)
+  {
+    if (pSlots[i].Tag != 0)
+      pSlots[i].EntryOffset = pHeader->PoolSize - 8;
+    else
+      pSlots[i].Tag = 1;
+  }
+
+  result = result && index.Open(pMemoryStream);
+  for (uint32 i = 0; i < 100 && result; i++)
+  {
+    GetKey(i, &key);
+    result = !index.Contains(key);
+  }
+  index.Close();
+  pMemoryStream->Release();
+
+  if (result)
+    Log_InfoPrint("PASS: damaged images");
+  else
+    Log_ErrorPrint("FAIL: damaged images");
+  return result;
+}
+
+DEFINE_TEST_SUITE(MappedHashIndex)
+{
+  bool result = true;
+  result &= TestIndex();
+  result &= TestDamagedImages();
+  return result;
+}
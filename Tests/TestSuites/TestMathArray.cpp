@@ -0,0 +1,306 @@
+#include "TestSuite.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Math.h"
+#include "YBaseLib/PODArray.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+Log_SetChannel(TestMathArray);
+
+// not a multiple of any vector width, so the padded tail is covered
+static const uint32 VALUE_COUNT = 200003;
+
+static void FillRange(PODArray<float>& values, float minimum, float maximum)
+{
+  values.Resize(VALUE_COUNT);
+  for (uint32 i = 0; i < VALUE_COUNT; i++)
+    values[i] = float(double(minimum) + (double(maximum) - double(minimum)) * double(i) / double(VALUE_COUNT - 1));
+}
+
+// evenly spread over the exponents rather than the values
+static void FillExponentRange(PODArray<float>& values, float minimum, float maximum)
+{
+  values.Resize(VALUE_COUNT);
+  double logMinimum = std::log(double(minimum));
+  double logMaximum = std::log(double(maximum));
+  for (uint32 i = 0; i < VALUE_COUNT; i++)
+    values[i] = float(std::exp(logMinimum + (logMaximum - logMinimum) * double(i) / double(VALUE_COUNT - 1)));
+}
+
+static bool CheckBound(const char* name, double maxError, double bound)
+{
+  bool result = (maxError <= bound);
+  if (result)
+    Log_InfoPrintf("PASS: %s error %g (bound %g)", name, maxError, bound);
+  else
+    Log_ErrorPrintf("FAIL: %s error %g (bound %g)", name, maxError, bound);
+  return result;
+}
+
+// a value on its own goes through the tail, it has to come out the same as in the middle of the array
+template<class Function>
+static bool CheckSingle(const char* name, const PODArray<float>& values, const PODArray<float>& results,
+                        const Function& function)
+{
+  for (uint32 i = 0; i < 64; i++)
+  {
+    uint32 index = (i * 7919) % values.GetSize();
+    float single;
+    function(&single, &values[index]);
+    if (std::memcmp(&single, &results[index], sizeof(float)) != 0)
+    {
+      Log_ErrorPrintf("FAIL: %s of %g alone gives %g, in the array %g", name, values[index], single, results[index]);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool TestSinCos()
+{
+  PODArray<float> values, sinv, cosv;
+  FillRange(values, -8192.0f, 8192.0f);
+  sinv.Resize(VALUE_COUNT);
+  cosv.Resize(VALUE_COUNT);
+  Y_sincosf_array(sinv.GetBasePointer(), cosv.GetBasePointer(), values.GetBasePointer(), VALUE_COUNT);
+
+  double maxError = 0.0;
+  for (uint32 i = 0; i < VALUE_COUNT; i++)
+  {
+    maxError = Max(maxError, std::fabs(double(sinv[i]) - std::sin(double(values[i]))));
+    maxError = Max(maxError, std::fabs(double(cosv[i]) - std::cos(double(values[i]))));
+  }
+
+  bool result = CheckBound("sincos", maxError, 1.0e-7);
+  result &= CheckSingle("sin", values, sinv, [](float* pResult, const float* pValue) {
+    float cosv;
+    Y_sincosf_array(pResult, &cosv, pValue, 1);
+  });
+  return result;
+}
+
+static bool TestRsqrt()
+{
+  PODArray<float> values, results;
+  FillExponentRange(values, 1.0e-37f, 1.0e37f);
+  results.Resize(VALUE_COUNT);
+  Y_rsqrtf_array(results.GetBasePointer(), values.GetBasePointer(), VALUE_COUNT);
+
+  double maxError = 0.0;
+  for (uint32 i = 0; i < VALUE_COUNT; i++)
+  {
+    double expected = 1.0 / std::sqrt(double(values[i]));
+    maxError = Max(maxError, std::fabs(double(results[i]) - expected) / expected);
+  }
+
+  float special[2] = {0.0f, std::numeric_limits<float>::infinity()};
+  Y_rsqrtf_array(special, special, 2);
+
+  bool result = CheckBound("rsqrt", maxError, 2.5e-7);
+  result &= CheckSingle("rsqrt", values, results,
+                        [](float* pResult, const float* pValue) { Y_rsqrtf_array(pResult, pValue, 1); });
+  if (special[0] != std::numeric_limits<float>::infinity() || special[1] != 0.0f)
+  {
+    Log_ErrorPrintf("FAIL: rsqrt of zero and infinity gives %g and %g", special[0], special[1]);
+    result = false;
+  }
+
+  return result;
+}
+
+static bool TestExp()
+{
+  PODArray<float> values, results;
+  FillRange(values, -87.33f, 88.72f);
+  results.Resize(VALUE_COUNT);
+  Y_expf_array(results.GetBasePointer(), values.GetBasePointer(), VALUE_COUNT);
+
+  double maxError = 0.0;
+  for (uint32 i = 0; i < VALUE_COUNT; i++)
+  {
+    double expected = std::exp(double(values[i]));
+    maxError = Max(maxError, std::fabs(double(results[i]) - expected) / expected);
+  }
+
+  float special[3] = {-100.0f, 100.0f, 0.0f};
+  Y_expf_array(special, special, 3);
+
+  bool result = CheckBound("exp", maxError, 1.5e-7);
+  result &= CheckSingle("exp", values, results,
+                        [](float* pResult, const float* pValue) { Y_expf_array(pResult, pValue, 1); });
+  if (special[0] != 0.0f || special[1] != std::numeric_limits<float>::infinity() || special[2] != 1.0f)
+  {
+    Log_ErrorPrintf("FAIL: exp of -100, 100 and 0 gives %g, %g and %g", special[0], special[1], special[2]);
+    result = false;
+  }
+
+  return result;
+}
+
+static bool TestLog()
+{
+  PODArray<float> values, results;
+  FillExponentRange(values, 1.0e-37f, 1.0e37f);
+  results.Resize(VALUE_COUNT);
+  Y_logf_array(results.GetBasePointer(), values.GetBasePointer(), VALUE_COUNT);
+
+  // near 1 the result goes to zero, so the error there is absolute
+  double maxError = 0.0;
+  for (uint32 i = 0; i < VALUE_COUNT; i++)
+  {
+    double expected = std::log(double(values[i]));
+    double error = std::fabs(double(results[i]) - expected);
+    if (values[i] < 0.5f || values[i] > 2.0f)
+      error /= std::fabs(expected);
+    maxError = Max(maxError, error);
+  }
+
+  float special[4] = {0.0f, -1.0f, std::numeric_limits<float>::infinity(), 1.0f};
+  Y_logf_array(special, special, 4);
+
+  bool result = CheckBound("log", maxError, 1.0e-7);
+  result &= CheckSingle("log", values, results,
+                        [](float* pResult, const float* pValue) { Y_logf_array(pResult, pValue, 1); });
+  if (special[0] != -std::numeric_limits<float>::infinity() || special[1] == special[1] ||
+      special[2] != std::numeric_limits<float>::infinity() || special[3] != 0.0f)
+  {
+    Log_ErrorPrintf("FAIL: log of 0, -1, infinity and 1 gives %g, %g, %g and %g", special[0], special[1], special[2],
+                    special[3]);
+    result = false;
+  }
+
+  return result;
+}
+
+static bool TestClampLerp()
+{
+  static const uint32 count = 37;
+  float values[count], starts[count], ends[count], clamped[count], blended[count];
+  for (uint32 i = 0; i < count; i++)
+  {
+    values[i] = float(i) - 18.0f;
+    starts[i] = float(i);
+    ends[i] = float(i) * 3.0f;
+  }
+
+  Y_fclamp_array(clamped, values, -4.0f, 6.0f, count);
+  Y_lerpf_array(blended, starts, ends, 0.25f, count);
+
+  bool result = true;
+  for (uint32 i = 0; i < count; i++)
+  {
+    result &= (clamped[i] == Y_fclamp(values[i], -4.0f, 6.0f));
+    result &= (blended[i] == float(i) * 1.5f);
+  }
+
+  if (result)
+    Log_InfoPrint("PASS: clamp and lerp");
+  else
+    Log_ErrorPrint("FAIL: clamp and lerp");
+  return result;
+}
+
+static bool TestHalf()
+{
+  // every half converts to a float and back to itself, NaNs only have to stay NaN
+  PODArray<uint16> halves, roundTrip;
+  PODArray<float> floats;
+  halves.Resize(65536);
+  roundTrip.Resize(65536);
+  floats.Resize(65536);
+  for (uint32 i = 0; i < 65536; i++)
+    halves[i] = uint16(i);
+
+  Y_halftofloat_array(floats.GetBasePointer(), halves.GetBasePointer(), 65536);
+  Y_floattohalf_array(roundTrip.GetBasePointer(), floats.GetBasePointer(), 65536);
+
+  bool result = true;
+  for (uint32 i = 0; i < 65536; i++)
+  {
+    bool isNaN = ((i & 0x7C00) == 0x7C00 && (i & 0x3FF) != 0);
+    if ((isNaN && (roundTrip[i] & 0x7FFF) <= 0x7C00) ||
+        (!isNaN && (roundTrip[i] != i || floats[i] != Y_halftofloat(uint16(i)))))
+    {
+      Log_ErrorPrintf("FAIL: half %04X -> %g -> %04X", i, floats[i], roundTrip[i]);
+      result = false;
+      break;
+    }
+  }
+
+  // Floats between the halves, including ones exactly halfway, must go to the nearest, or the even one of two. A
+  // float converted on its own goes through the tail, which must agree with the vector version.
+  PODArray<float> values;
+  PODArray<uint16> converted;
+  values.Resize(VALUE_COUNT);
+  converted.Resize(VALUE_COUNT);
+  uint32 state = 12345;
+  for (uint32 i = 0; i < VALUE_COUNT; i++)
+  {
+    state = state * 1664525 + 1013904223;
+    uint32 sign = state & 0x80000000;
+    uint32 random = state >> 8;
+    state = state * 1664525 + 1013904223;
+
+    float value;
+    if (i & 1)
+    {
+      // anything from 2^-30 to past the largest half
+      uint32 bits = sign | ((97 + (state >> 16) % 48) << 23) | (random & 0x7FFFFF);
+      std::memcpy(&value, &bits, sizeof(value));
+    }
+    else
+    {
+      uint16 lower = uint16(random % 0x7BFF);
+      value = (Y_halftofloat(lower) + Y_halftofloat(uint16(lower + 1))) * 0.5f;
+      value = (sign != 0) ? -value : value;
+    }
+
+    values[i] = value;
+  }
+
+  Y_floattohalf_array(converted.GetBasePointer(), values.GetBasePointer(), VALUE_COUNT);
+  for (uint32 i = 0; i < VALUE_COUNT && result; i++)
+  {
+    double value = std::fabs(double(values[i]));
+    uint16 half = converted[i] & 0x7FFF;
+    uint16 single;
+    Y_floattohalf_array(&single, &values[i], 1);
+
+    bool correct = (single == converted[i] && (converted[i] & 0x8000) == ((values[i] < 0.0f) ? 0x8000 : 0));
+    if (value >= 65520.0)
+    {
+      correct &= (half == 0x7C00);
+    }
+    else
+    {
+      double error = std::fabs(double(Y_halftofloat(half)) - value);
+      double errorBelow = (half > 0) ? std::fabs(double(Y_halftofloat(uint16(half - 1))) - value) : 1.0e10;
+      double errorAbove = (half < 0x7BFF) ? std::fabs(double(Y_halftofloat(uint16(half + 1))) - value) : 1.0e10;
+      correct &= (error < errorBelow || (error == errorBelow && (half & 1) == 0));
+      correct &= (error < errorAbove || (error == errorAbove && (half & 1) == 0));
+    }
+
+    if (!correct)
+    {
+      Log_ErrorPrintf("FAIL: float %g -> half %04X (alone %04X)", values[i], converted[i], single);
+      result = false;
+    }
+  }
+
+  if (result)
+    Log_InfoPrint("PASS: half conversion");
+  return result;
+}
+
+DEFINE_TEST_SUITE(MathArray)
+{
+  bool result = true;
+  result &= TestSinCos();
+  result &= TestRsqrt();
+  result &= TestExp();
+  result &= TestLog();
+  result &= TestClampLerp();
+  result &= TestHalf();
+  return result;
+}
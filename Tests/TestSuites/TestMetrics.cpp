@@ -0,0 +1,130 @@
+#include "TestSuite.h"
+#include "YBaseLib/BinaryReader.h"
+#include "YBaseLib/BinaryWriter.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Metrics.h"
+#include "YBaseLib/ParallelFor.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/TextWriter.h"
+#include "YBaseLib/ThreadPool.h"
+Log_SetChannel(TestMetrics);
+
+// every value falls inside its bucket, and buckets are in order
+static bool TestBuckets()
+{
+  uint64 values[] = {0, 1, 7, 8, 9, 15, 16, 17, 100, 1000, 123456789, 0x8000000000000000ULL, 0xFFFFFFFFFFFFFFFFULL};
+  for (uint64 value : values)
+  {
+    uint32 index = MetricsHistogram::GetBucketIndex(value);
+    if (index >= MetricsHistogram::BucketCount || value < MetricsHistogram::GetBucketLowerBound(index) ||
+        value > MetricsHistogram::GetBucketUpperBound(index))
+    {
+      Log_ErrorPrintf("FAIL: %llu went in bucket %u", value, index);
+      return false;
+    }
+  }
+
+  for (uint32 i = 1; i < MetricsHistogram::BucketCount; i++)
+  {
+    if (MetricsHistogram::GetBucketLowerBound(i) != MetricsHistogram::GetBucketUpperBound(i - 1) + 1)
+    {
+      Log_ErrorPrintf("FAIL: bucket %u doesn't follow the one before it", i);
+      return false;
+    }
+  }
+
+  Log_InfoPrint("PASS: buckets");
+  return true;
+}
+
+// threads recording at once add up, and names are shared within a type
+static bool TestRecording()
+{
+  MetricsRegistry registry;
+  MetricsCounter* pCounter = registry.GetCounter("test.counter");
+  MetricsGauge* pGauge = registry.GetGauge("test.gauge");
+  MetricsHistogram* pHistogram = registry.GetHistogram("test.histogram");
+
+  ThreadPool threadPool(4);
+  ParallelFor(&threadPool, 1, 10001, 100, [pCounter, pGauge, pHistogram](uint32 i) {
+    pCounter->Add();
+    pGauge->Add(2);
+    pGauge->Subtract(1);
+    pHistogram->Record(i);
+  });
+
+  MetricsSnapshot snapshot;
+  registry.GetSnapshot(&snapshot);
+  const MetricsSnapshot::Histogram* pHistogramSnapshot = snapshot.FindHistogram("test.histogram");
+  bool result = (registry.GetCounter("test.counter") == pCounter && registry.GetGauge("test.counter") == nullptr &&
+                 pCounter->GetValue() == 10000 && pGauge->GetValue() == 10000 && pHistogram->GetCount() == 10000 &&
+                 pHistogram->GetSum() == 50005000 && pHistogramSnapshot != nullptr &&
+                 pHistogramSnapshot->Count == 10000 && snapshot.FindCounter("test.counter") != nullptr &&
+                 snapshot.FindCounter("test.counter")->Value == 10000);
+
+  // within the buckets' 12.5%
+  uint64 median = result ? pHistogramSnapshot->GetPercentile(0.5) : 0;
+  uint64 maximum = result ? pHistogramSnapshot->GetPercentile(1.0) : 0;
+  if (result && (median < 5000 || median > 5625 || maximum < 10000 || maximum > 11250))
+    result = false;
+
+  if (result)
+    Log_InfoPrint("PASS: recording");
+  else
+    Log_ErrorPrintf("FAIL: recording (median %llu, maximum %llu)", median, maximum);
+  return result;
+}
+
+// a snapshot reads back from its binary form, and writes a line per metric as text
+static bool TestExport()
+{
+  MetricsRegistry registry;
+  registry.GetCounter("export.counter")->Add(42);
+  registry.GetGauge("export.gauge")->Set(-7);
+  registry.GetHistogram("export.histogram")->Record(1000);
+
+  MetricsSnapshot snapshot;
+  registry.GetSnapshot(&snapshot);
+
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  {
+    BinaryWriter writer(pStream);
+    snapshot.WriteBinary(&writer);
+  }
+  pStream->SeekAbsolute(0);
+
+  MetricsSnapshot readSnapshot;
+  BinaryReader reader(pStream);
+  bool result = readSnapshot.ReadBinary(&reader) && readSnapshot.GetCounters().GetSize() == 1 &&
+                readSnapshot.FindCounter("export.counter") != nullptr &&
+                readSnapshot.FindCounter("export.counter")->Value == 42 &&
+                readSnapshot.FindGauge("export.gauge") != nullptr &&
+                readSnapshot.FindGauge("export.gauge")->Value == -7 &&
+                readSnapshot.FindHistogram("export.histogram") != nullptr &&
+                readSnapshot.FindHistogram("export.histogram")->Sum == 1000 &&
+                readSnapshot.FindHistogram("export.histogram")->Buckets.GetSize() == 1;
+  pStream->Release();
+
+  pStream = ByteStream_CreateGrowableMemoryStream();
+  {
+    TextWriter writer(pStream);
+    readSnapshot.WriteText(&writer);
+  }
+  String text;
+  text.AppendString(reinterpret_cast<const char*>(pStream->GetMemoryPointer()), (uint32)pStream->GetSize());
+  pStream->Release();
+  result = result && text.Find("counter export.counter 42\n") >= 0 && text.Find("gauge export.gauge -7\n") >= 0 &&
+           text.Find("histogram export.histogram count=1 sum=1000 ") >= 0;
+
+  if (result)
+    Log_InfoPrint("PASS: export");
+  else
+    Log_ErrorPrintf("FAIL: export: %s", text.GetCharArray());
+  return result;
+}
+
+DEFINE_TEST_SUITE(Metrics)
+{
+  return TestBuckets() && TestRecording() && TestExport();
+}
@@ -0,0 +1,127 @@
+#include "TestSuite.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/NameTable.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(TestNameTable);
+
+enum TEST_COLOR
+{
+  TEST_COLOR_RED,
+  TEST_COLOR_GREEN,
+  TEST_COLOR_BLUE,
+  TEST_COLOR_COUNT,
+};
+
+// duplicates of names and values, where the first entry is the one found
+Y_Define_NameTable(s_colorNames)
+  Y_NameTable_Entry("Red", TEST_COLOR_RED)
+  Y_NameTable_Entry("Green", TEST_COLOR_GREEN)
+  Y_NameTable_Entry("Blue", TEST_COLOR_BLUE)
+  Y_NameTable_Entry("red", TEST_COLOR_BLUE)
+  Y_NameTable_Entry("Crimson", TEST_COLOR_RED)
+Y_NameTable_End()
+Y_Define_NameTableIndex(s_colorNames)
+
+Y_Define_NameTable(s_emptyNames)
+Y_NameTable_End()
+Y_Define_NameTableIndex(s_emptyNames)
+
+// every lookup through the index gives the entry the linear search does
+static bool TestLookups()
+{
+  static const char* names[] = {"Red", "red", "RED", "Green", "green", "Blue", "Crimson", "crimson", "", "Purple"};
+
+  bool result = true;
+  for (uint32 i = 0; i < countof(names); i++)
+  {
+    for (uint32 caseInsensitive = 0; caseInsensitive < 2; caseInsensitive++)
+    {
+      if (NameTable_LookupByName(&s_colorNames_Index, names[i], caseInsensitive != 0) !=
+          NameTable_LookupByName(s_colorNames, names[i], caseInsensitive != 0))
+      {
+        Log_ErrorPrintf("FAIL: lookup of '%s', case insensitive %u", names[i], caseInsensitive);
+        result = false;
+      }
+    }
+  }
+
+  for (int value = -1; value <= TEST_COLOR_COUNT; value++)
+  {
+    if (NameTable_LookupByValue(&s_colorNames_Index, value) != NameTable_LookupByValue(s_colorNames, value))
+    {
+      Log_ErrorPrintf("FAIL: lookup of %d", value);
+      result = false;
+    }
+  }
+
+  TEST_COLOR color = TEST_COLOR_COUNT;
+  result = result && NameTable_TranslateType(&s_colorNames_Index, "RED", &color, true) && color == TEST_COLOR_RED &&
+           NameTable_TranslateType(&s_colorNames_Index, "red", &color) && color == TEST_COLOR_BLUE &&
+           !NameTable_TranslateType(&s_colorNames_Index, "Purple", &color) &&
+           Y_strcmp(NameTable_GetNameString(&s_colorNames_Index, TEST_COLOR_BLUE), "Blue") == 0 &&
+           Y_strcmp(NameTable_GetNameString(&s_colorNames_Index, TEST_COLOR_COUNT), "UNKNOWN") == 0 &&
+           NameTable_LookupByName(&s_emptyNames_Index, "Red") == NULL &&
+           NameTable_LookupByValue(&s_emptyNames_Index, 0) == NULL;
+
+  if (result)
+    Log_InfoPrint("PASS: lookups");
+  else
+    Log_ErrorPrint("FAIL: lookups");
+  return result;
+}
+
+// Looks a name up through an index that none of the threads has built yet.
+class LookupThread : public Thread
+{
+public:
+  LookupThread() : m_pIndex(nullptr), m_failed(false) {}
+
+  void SetIndex(const NameTableIndex* pIndex) { m_pIndex = pIndex; }
+  bool HasFailed() const { return m_failed; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    for (uint32 i = 0; i < 1000; i++)
+      m_failed |= (m_pIndex->LookupByName("green", true) != &s_colorNames[TEST_COLOR_GREEN]);
+
+    return 0;
+  }
+
+private:
+  const NameTableIndex* m_pIndex;
+  bool m_failed;
+};
+
+// threads racing to the first lookup all get the same answers
+static bool TestConcurrentBuild()
+{
+  static const uint32 ThreadCount = 4;
+
+  NameTableIndex index(s_colorNames);
+  LookupThread threads[ThreadCount];
+  for (uint32 i = 0; i < ThreadCount; i++)
+  {
+    threads[i].SetIndex(&index);
+    threads[i].Start();
+  }
+
+  bool result = true;
+  for (uint32 i = 0; i < ThreadCount; i++)
+  {
+    threads[i].Join();
+    result = result && !threads[i].HasFailed();
+  }
+
+  if (result)
+    Log_InfoPrint("PASS: concurrent build");
+  else
+    Log_ErrorPrint("FAIL: concurrent build");
+  return result;
+}
+
+DEFINE_TEST_SUITE(NameTable)
+{
+  return TestLookups() && TestConcurrentBuild();
+}
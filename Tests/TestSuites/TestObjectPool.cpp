@@ -0,0 +1,176 @@
+#include "TestSuite.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/ObjectPool.h"
+#include "YBaseLib/PODArray.h"
+#include <thread>
+Log_SetChannel(TestObjectPool);
+
+static Y_ATOMIC_DECL int32 s_liveObjects = 0;
+
+// counts constructions, and catches an object being handed to two owners at once
+struct PooledObject
+{
+  PooledObject(uint32 value) : Value(value), Owned(0) { Y_AtomicIncrement(s_liveObjects); }
+  ~PooledObject() { Y_AtomicDecrement(s_liveObjects); }
+
+  bool TakeOwnership() { return (Y_AtomicExchange(Owned, uint32(1)) == 0); }
+  void GiveUpOwnership() { Y_AtomicStore(Owned, uint32(0)); }
+
+  uint32 Value;
+  Y_ATOMIC_DECL uint32 Owned;
+};
+
+typedef ObjectPool<PooledObject> TestPool;
+
+static bool TestReuse()
+{
+  bool result = true;
+  {
+    static const uint32 CAPACITY = 4 * TestPool::MagazineSize;
+    TestPool pool(CAPACITY);
+    PODArray<PooledObject*> objects;
+    for (uint32 i = 0; i < CAPACITY; i++)
+    {
+      PooledObject* pObject = pool.Allocate(i);
+      result = result && pObject != nullptr && pObject->Value == i && pool.Owns(pObject);
+      objects.Add(pObject);
+    }
+
+    // full, and anything else isn't the pool's
+    PooledObject outside(0);
+    result = result && pool.Allocate(0u) == nullptr && !pool.Owns(&outside) && s_liveObjects == (int32)CAPACITY + 1;
+
+    // released objects come back as they were, through the magazine and the depot, and aren't constructed again
+    for (uint32 i = 0; i < CAPACITY; i++)
+    {
+      objects[i]->Value += 1000;
+      pool.Release(objects[i]);
+    }
+
+    uint64 sum = 0;
+    for (uint32 i = 0; i < CAPACITY; i++)
+    {
+      PooledObject* pObject = pool.Allocate(12345u);
+      result = result && pObject != nullptr && pObject->Value >= 1000;
+      if (pObject != nullptr)
+        sum += pObject->Value - 1000;
+    }
+    result = result && sum == CAPACITY * (CAPACITY - 1) / 2 && pool.Allocate(0u) == nullptr;
+    result = result && pool.GetConstructedCount() == CAPACITY && s_liveObjects == (int32)CAPACITY + 1;
+  }
+
+  // the pool destroys what it constructed, whether it was released or not
+  result = result && s_liveObjects == 0;
+
+  if (result)
+    Log_InfoPrintf("PASS: reuse");
+  else
+    Log_ErrorPrintf("FAIL: reuse");
+  return result;
+}
+
+static bool TestThreadExit()
+{
+  // a thread that only releases keeps some in its magazine, and gives them back when it exits
+  static const uint32 CAPACITY = 64;
+  TestPool pool(CAPACITY);
+  PODArray<PooledObject*> objects;
+  for (uint32 i = 0; i < CAPACITY; i++)
+    objects.Add(pool.Allocate(i));
+
+  std::thread releasingThread([&pool, &objects]() {
+    for (uint32 i = 0; i < objects.GetSize(); i++)
+      pool.Release(objects[i]);
+  });
+  releasingThread.join();
+
+  uint32 allocatedCount = 0;
+  while (pool.Allocate(0u) != nullptr)
+    allocatedCount++;
+
+  bool result = allocatedCount == CAPACITY && pool.GetConstructedCount() == CAPACITY;
+  if (result)
+    Log_InfoPrintf("PASS: thread exit");
+  else
+    Log_ErrorPrintf("FAIL: thread exit, %u of %u allocated", allocatedCount, CAPACITY);
+  return result;
+}
+
+static bool TestContention()
+{
+  // Threads swap objects through a shared slot array, so most are released by a different thread to the one that
+  // took them. Past the capacity they go to the heap, as the pool's users do.
+  static const uint32 THREAD_COUNT = 4;
+  static const uint32 ITERATIONS = 200000;
+  static const uint32 SHARED_SLOTS = 32;
+  TestPool pool(24);
+  PooledObject* volatile sharedSlots[SHARED_SLOTS] = {};
+  Y_ATOMIC_DECL uint32 failures = 0;
+  Y_ATOMIC_DECL uint32 heapAllocations = 0;
+
+  auto worker = [&](uint32 threadIndex) {
+    uint32 state = threadIndex * 7919 + 1;
+    for (uint32 i = 0; i < ITERATIONS; i++)
+    {
+      PooledObject* pObject = pool.Allocate(threadIndex);
+      if (pObject == nullptr)
+      {
+        pObject = new PooledObject(threadIndex);
+        Y_AtomicIncrement(heapAllocations);
+      }
+      if (!pObject->TakeOwnership())
+        Y_AtomicIncrement(failures);
+
+      // leave it for someone else, and release whatever was there
+      state = state * 1664525 + 1013904223;
+      pObject->GiveUpOwnership();
+      PooledObject* pPrevious = Y_AtomicExchange(sharedSlots[(state >> 8) % SHARED_SLOTS], pObject);
+      if (pPrevious == nullptr)
+        continue;
+
+      if (!pPrevious->TakeOwnership())
+        Y_AtomicIncrement(failures);
+      pPrevious->GiveUpOwnership();
+      if (pool.Owns(pPrevious))
+        pool.Release(pPrevious);
+      else
+        delete pPrevious;
+    }
+  };
+
+  std::thread threads[THREAD_COUNT];
+  for (uint32 i = 0; i < THREAD_COUNT; i++)
+    threads[i] = std::thread(worker, i);
+  for (uint32 i = 0; i < THREAD_COUNT; i++)
+    threads[i].join();
+
+  for (uint32 i = 0; i < SHARED_SLOTS; i++)
+  {
+    PooledObject* pObject = sharedSlots[i];
+    if (pObject != nullptr && pool.Owns(pObject))
+      pool.Release(pObject);
+    else
+      delete pObject;
+  }
+
+  // everything's back, so the whole pool can be had again
+  uint32 allocatedCount = 0;
+  while (pool.Allocate(0u) != nullptr)
+    allocatedCount++;
+
+  bool result = failures == 0 && allocatedCount == pool.GetCapacity();
+  if (result)
+    Log_InfoPrintf("PASS: contention, %u heap allocations", heapAllocations);
+  else
+    Log_ErrorPrintf("FAIL: contention, %u failures, %u allocated", failures, allocatedCount);
+  return result;
+}
+
+DEFINE_TEST_SUITE(ObjectPool)
+{
+  bool result = true;
+  result &= TestReuse();
+  result &= TestThreadExit();
+  result &= TestContention();
+  return result;
+}
@@ -0,0 +1,146 @@
+#include "TestSuite.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/NumericLimits.h"
+#include "YBaseLib/ParallelProgress.h"
+#include "YBaseLib/ProgressCallbacks.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(TestParallelProgress);
+
+static const uint32 ThreadCount = 4;
+static const uint32 TasksPerThread = 8;
+static const uint32 UnitsPerTask = 10000;
+
+// Counts the updates it gets, and notices if two threads ever update it at once.
+class RecordingProgressCallbacks : public BaseProgressCallbacks
+{
+public:
+  RecordingProgressCallbacks() : m_updateCount(0), m_overlapped(false), m_inside(0) {}
+
+  uint32 GetRange() const { return m_progressRange; }
+  uint32 GetValue() const { return m_progressValue; }
+  uint32 GetUpdateCount() const { return m_updateCount; }
+  bool HasOverlapped() const { return m_overlapped; }
+  void Cancel() { m_cancelled = true; }
+
+  virtual void SetProgressValue(uint32 value) override
+  {
+    if (Y_AtomicIncrement(m_inside) != 1)
+      m_overlapped = true;
+
+    m_updateCount++;
+    BaseProgressCallbacks::SetProgressValue(value);
+    Y_AtomicDecrement(m_inside);
+  }
+
+  virtual void DisplayError(const char* message) override {}
+  virtual void DisplayWarning(const char* message) override {}
+  virtual void DisplayInformation(const char* message) override {}
+  virtual void DisplayDebugMessage(const char* message) override {}
+  virtual void ModalError(const char* message) override {}
+  virtual bool ModalConfirmation(const char* message) override { return false; }
+  virtual uint32 ModalPrompt(const char* message, uint32 nOptions, ...) override { return 0; }
+
+private:
+  uint32 m_updateCount;
+  bool m_overlapped;
+  Y_ATOMIC_DECL uint32 m_inside;
+};
+
+// Works through tasks in child ranges of its own share of the job, a unit at a time.
+class WorkerThread : public Thread
+{
+public:
+  WorkerThread() : m_pRange(nullptr) {}
+
+  void SetRange(ParallelProgress::Range* pRange) { m_pRange = pRange; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    // the task ranges don't divide evenly into the thread's, the total still has to come out exact
+    for (uint32 task = 0; task < TasksPerThread; task++)
+    {
+      ParallelProgress::Range taskRange(m_pRange, 3, UnitsPerTask);
+      for (uint32 i = 0; i < UnitsPerTask; i++)
+        taskRange.Add();
+    }
+
+    return 0;
+  }
+
+private:
+  ParallelProgress::Range* m_pRange;
+};
+
+static bool TestParallelAdds()
+{
+  RecordingProgressCallbacks callbacks;
+  bool result;
+  {
+    ParallelProgress progress(&callbacks, 1000, 5);
+    result = (callbacks.GetRange() == 1000 && callbacks.GetValue() == 0);
+
+    ParallelProgress::Range* ranges[ThreadCount];
+    WorkerThread threads[ThreadCount];
+    for (uint32 i = 0; i < ThreadCount; i++)
+    {
+      ranges[i] = new ParallelProgress::Range(progress.GetRootRange(), 250, TasksPerThread * 3);
+      threads[i].SetRange(ranges[i]);
+      threads[i].Start();
+    }
+
+    for (uint32 i = 0; i < ThreadCount; i++)
+    {
+      threads[i].Join();
+      result &= (ranges[i]->GetCompleted() == TasksPerThread * 3);
+      delete ranges[i];
+    }
+
+    result &= (progress.GetCompleted() == 1000);
+  }
+
+  // one update to start, one to finish, and at most one per interval between
+  result &= (callbacks.GetValue() == 1000 && callbacks.GetUpdateCount() < 1000 && !callbacks.HasOverlapped());
+  if (result)
+    Log_InfoPrintf("PASS: parallel adds, %u updates", callbacks.GetUpdateCount());
+  else
+    Log_ErrorPrintf("FAIL: parallel adds, value %u after %u updates", callbacks.GetValue(),
+                    callbacks.GetUpdateCount());
+  return result;
+}
+
+static bool TestScaling()
+{
+  RecordingProgressCallbacks callbacks;
+  ParallelProgress progress(&callbacks, uint64(1) << 40);
+
+  // ranges past 32 bits are scaled down for the callbacks
+  ParallelProgress::Range half(progress.GetRootRange(), uint64(1) << 39, 7);
+  for (uint32 i = 0; i < 7; i++)
+    half.Add();
+
+  // going over doesn't take more than the share
+  half.Add(5);
+  progress.Report();
+
+  bool result = (callbacks.GetRange() == Y_UINT32_MAX && progress.GetCompleted() == (uint64(1) << 39) &&
+                 callbacks.GetValue() == Y_UINT32_MAX / 2 && half.GetCompleted() == 12);
+
+  callbacks.Cancel();
+  result &= !progress.IsCancelled() && progress.Report() && half.IsCancelled();
+
+  if (result)
+    Log_InfoPrint("PASS: scaling and cancellation");
+  else
+    Log_ErrorPrintf("FAIL: scaling and cancellation, value %u", callbacks.GetValue());
+  return result;
+}
+
+DEFINE_TEST_SUITE(ParallelProgress)
+{
+  bool result = true;
+  result &= TestParallelAdds();
+  result &= TestScaling();
+  return result;
+}
@@ -0,0 +1,187 @@
+#include "TestSuite.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/PathTrie.h"
+Log_SetChannel(TestPathTrie);
+
+static uint32 NextRandom(uint32& state)
+{
+  state = state * 1664525 + 1013904223;
+  return state >> 8;
+}
+
+// Every path of one to four components from a handful of names, so they share prefixes, numbered by depth and then
+// by the components.
+static const char* s_components[] = {"a", "bin", "data", "textures", "x", ""};
+static const uint32 PATH_COUNT = 6 + 6 * 6 + 6 * 6 * 6 + 6 * 6 * 6 * 6;
+
+static void MakePath(uint32 n, char* buffer)
+{
+  uint32 depth = 1;
+  uint32 pathsAtDepth = countof(s_components);
+  while (n >= pathsAtDepth)
+  {
+    n -= pathsAtDepth;
+    pathsAtDepth *= countof(s_components);
+    depth++;
+  }
+
+  buffer[0] = '\0';
+  for (uint32 i = 0; i < depth; i++)
+  {
+    if (i > 0)
+      Y_strncat(buffer, 64, "/");
+    Y_strncat(buffer, 64, s_components[n % countof(s_components)]);
+    n /= countof(s_components);
+  }
+}
+
+// whether path is under directory, and how many components below it
+static bool IsUnder(const char* path, const char* directory, uint32* pDepth)
+{
+  uint32 directoryLength = Y_strlen(directory);
+  if (directoryLength > 0 && (Y_strncmp(path, directory, directoryLength) != 0 || path[directoryLength] != '/'))
+    return false;
+
+  const char* rest = path + directoryLength + ((directoryLength > 0) ? 1 : 0);
+  *pDepth = 1;
+  for (; *rest != '\0'; rest++)
+    *pDepth += (*rest == '/') ? 1 : 0;
+  return true;
+}
+
+static bool TestRandomChanges()
+{
+  PathTrie<uint32> trie;
+  PODArray<bool> present;
+  present.Resize(PATH_COUNT);
+  present.ZeroContents();
+
+  uint32 state = 5;
+  bool result = true;
+  char path[64];
+  for (uint32 i = 0; i < 20000 && result; i++)
+  {
+    uint32 n = NextRandom(state) % PATH_COUNT;
+    MakePath(n, path);
+    if ((NextRandom(state) % 3) != 0)
+    {
+      bool isNew;
+      uint32* pValue = trie.Insert(path, n, &isNew);
+      result = (isNew == !present[n]) && *pValue == n;
+      present[n] = true;
+    }
+    else
+    {
+      result = trie.Remove(path) == present[n] && !trie.Remove(path);
+      present[n] = false;
+    }
+  }
+
+  uint32 count = 0;
+  for (uint32 n = 0; n < PATH_COUNT && result; n++)
+  {
+    MakePath(n, path);
+    const uint32* pValue = trie.Find(path);
+    result = present[n] ? (pValue != nullptr && *pValue == n) : (pValue == nullptr);
+    count += present[n] ? 1 : 0;
+  }
+  result = result && trie.GetValueCount() == count;
+
+  // every directory lists the same paths the brute force finds, at each depth
+  const char* directories[] = {"", "a", "bin/data", "x/x", "textures/a/bin", "/", "a/"};
+  for (uint32 d = 0; d < countof(directories) && result; d++)
+  {
+    for (uint32 recursive = 0; recursive < 2 && result; recursive++)
+    {
+      uint32 expected = 0;
+      for (uint32 n = 0; n < PATH_COUNT; n++)
+      {
+        MakePath(n, path);
+        uint32 depth;
+        if (present[n] && IsUnder(path, directories[d], &depth) && (recursive || depth == 1))
+          expected++;
+      }
+
+      bool pathsMatch = true;
+      uint32 listed = trie.EnumerateUnder(directories[d], recursive != 0,
+                                          [&](const char* listedPath, uint32 length, const uint32& value) {
+                                            char valuePath[64];
+                                            MakePath(value, valuePath);
+                                            uint32 depth;
+                                            pathsMatch &= Y_strlen(listedPath) == length &&
+                                                          Y_strcmp(listedPath, valuePath) == 0 &&
+                                                          IsUnder(listedPath, directories[d], &depth) &&
+                                                          (recursive || depth == 1);
+                                          });
+      result = pathsMatch && listed == expected;
+    }
+  }
+
+  trie.Clear();
+  result = result && trie.GetValueCount() == 0 && trie.Find("a") == nullptr;
+
+  if (result)
+    Log_InfoPrintf("PASS: random changes, %u paths", count);
+  else
+    Log_ErrorPrintf("FAIL: random changes");
+  return result;
+}
+
+static bool TestLabels()
+{
+  // one long label, split by a shorter path, a branch off its middle, and then folded back together
+  PathTrie<int> trie(PathTrie<int>::FLAG_CASE_INSENSITIVE);
+  trie.Set("Games/Data/Textures/Stone.png", 1);
+  uint32 listed = trie.EnumerateUnder("games/data", false, [](const char*, uint32, const int&) {});
+  bool result = listed == 0 && trie.EnumerateUnder("games/data", true, [](const char*, uint32, const int&) {}) == 1;
+
+  trie.Set("GAMES/DATA", 2);
+  trie.Set("games/data/Sounds/Hit.wav", 3);
+  trie.Set("Games/Data/Textures/stone.PNG", 4);
+  result = result && trie.GetValueCount() == 3 && *trie.Find("games/data/textures/stone.png") == 4;
+  result = result && *trie.Find("Games/Data") == 2 && trie.Find("Games") == nullptr;
+  result = result && trie.Find("games/data/textures") == nullptr && trie.Find("games/dat") == nullptr;
+
+  // paths come back with the case they were first inserted with, in component order
+  const char* expected[] = {"Games/Data/Sounds/Hit.wav", "Games/Data/Textures/Stone.png"};
+  uint32 index = 0;
+  trie.EnumerateUnder("GAMES/data", true, [&](const char* path, uint32, const int&) {
+    result = result && index < countof(expected) && Y_strcmp(path, expected[index++]) == 0;
+  });
+  result = result && index == 2;
+
+  // longest prefix only counts whole components
+  uint32 prefixLength = 0;
+  const int* pValue = trie.FindLongestPrefix("games/data/sounds/other.wav", &prefixLength);
+  result = result && pValue != nullptr && *pValue == 2 && prefixLength == 10;
+  pValue = trie.FindLongestPrefix("games/data/textures/stone.png/inner", &prefixLength);
+  result = result && pValue != nullptr && *pValue == 4 && prefixLength == 29;
+  result = result && trie.FindLongestPrefix("games/database", &prefixLength) == nullptr && prefixLength == 0;
+
+  result = result && trie.Remove("games/data") && trie.Remove("games/data/sounds/hit.wav");
+  result = result && *trie.Find("GAMES/DATA/TEXTURES/STONE.PNG") == 4 && trie.GetValueCount() == 1;
+  result = result && trie.EnumerateUnder("games", false, [](const char*, uint32, const int&) {}) == 0;
+
+  // case matters without the flag
+  PathTrie<int> caseSensitive;
+  caseSensitive.Set("Dir/File", 1);
+  caseSensitive.Set("dir/file", 2);
+  result = result && caseSensitive.GetValueCount() == 2 && *caseSensitive.Find("dir/file") == 2;
+  result = result && caseSensitive.Find("DIR/FILE") == nullptr;
+
+  if (result)
+    Log_InfoPrintf("PASS: labels and case");
+  else
+    Log_ErrorPrintf("FAIL: labels and case");
+  return result;
+}
+
+DEFINE_TEST_SUITE(PathTrie)
+{
+  bool result = true;
+  result &= TestRandomChanges();
+  result &= TestLabels();
+  return result;
+}
@@ -0,0 +1,230 @@
+#include "TestSuite.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/Pipeline.h"
+#include "YBaseLib/Thread.h"
+#include "YBaseLib/ThreadPool.h"
+Log_SetChannel(TestPipeline);
+
+// keeps the highest value a counter reaches
+static void RecordPeak(volatile uint32& counter, volatile uint32& peak)
+{
+  uint32 value = Y_AtomicIncrement(counter);
+  uint32 currentPeak;
+  while (value > (currentPeak = peak) && Y_AtomicCompareExchange(peak, value, currentPeak) != currentPeak)
+    ;
+}
+
+// uneven amounts of work, so parallel stages finish out of order
+static void Spin(uint32 seed)
+{
+  volatile uint32 value = seed;
+  for (uint32 i = 0; i < (seed * 2654435761u) % 2000; i++)
+    value = value * 3 + 1;
+}
+
+struct Chunk
+{
+  uint32 Index;
+  PODArray<uint32> Values;
+};
+
+struct Summary
+{
+  uint32 Index;
+  uint64 Sum;
+};
+
+static bool TestOrdering(ThreadPool* pThreadPool, PIPELINE_STAGE_MODE middleMode)
+{
+  static const uint32 ITEM_COUNT = 5000;
+  static const uint32 MAX_IN_FLIGHT = 12;
+  Pipeline pipeline(MAX_IN_FLIGHT);
+
+  uint32 nextIndex = 0;
+  Y_ATOMIC_DECL uint32 inFlight = 0;
+  Y_ATOMIC_DECL uint32 peakInFlight = 0;
+  Y_ATOMIC_DECL uint32 running = 0;
+  Y_ATOMIC_DECL uint32 peakRunning = 0;
+  uint32 allocations = 0;
+
+  PipelineQueue<Chunk>* pChunks = pipeline.AddSource<Chunk>([&](Chunk& chunk) {
+    if (nextIndex == ITEM_COUNT)
+      return false;
+
+    // slots are reused, so the array's memory is only allocated once per slot
+    if (chunk.Values.GetSize() == 0)
+      allocations++;
+
+    chunk.Index = nextIndex++;
+    chunk.Values.Clear();
+    for (uint32 i = 0; i < 16; i++)
+      chunk.Values.Add(chunk.Index * 16 + i);
+
+    RecordPeak(inFlight, peakInFlight);
+    return true;
+  });
+
+  PipelineQueue<Summary>* pSummaries =
+    pipeline.AddStage<Summary>(pChunks, middleMode,
+                               [&](Chunk& chunk, Summary& summary) {
+                                 RecordPeak(running, peakRunning);
+                                 Spin(chunk.Index);
+                                 summary.Index = chunk.Index;
+                                 summary.Sum = 0;
+                                 for (uint32 value : chunk.Values)
+                                   summary.Sum += value;
+                                 Y_AtomicDecrement(running);
+                               },
+                               4);
+
+  // the serial sink sees every item in source order, whatever the stage before did
+  uint32 expectedIndex = 0;
+  uint32 outOfOrderCount = 0;
+  uint64 total = 0;
+  pipeline.AddSink(pSummaries, PIPELINE_STAGE_SERIAL, [&](Summary& summary) {
+    if (summary.Index != expectedIndex)
+      outOfOrderCount++;
+
+    expectedIndex = summary.Index + 1;
+    total += summary.Sum;
+    Y_AtomicDecrement(inFlight);
+  });
+
+  bool completed = pipeline.Run(pThreadPool);
+  uint64 expectedTotal = (uint64)(ITEM_COUNT * 16) * (ITEM_COUNT * 16 - 1) / 2;
+  bool result = completed && expectedIndex == ITEM_COUNT && outOfOrderCount == 0 && total == expectedTotal &&
+                peakInFlight <= MAX_IN_FLIGHT && peakRunning <= 4 && allocations <= MAX_IN_FLIGHT &&
+                (middleMode != PIPELINE_STAGE_SERIAL || peakRunning == 1);
+
+  const char* modeName = (middleMode == PIPELINE_STAGE_SERIAL) ?
+                           "serial" :
+                           ((middleMode == PIPELINE_STAGE_PARALLEL) ? "parallel" : "ordered parallel");
+  if (result)
+  {
+    Log_InfoPrintf("PASS: %s stage, %s, peak %u in flight, %u running", modeName, pThreadPool ? "pool" : "caller",
+                   peakInFlight, peakRunning);
+  }
+  else
+  {
+    Log_ErrorPrintf("FAIL: %s stage, %s, %u of %u through, %u out of order, peak %u in flight, %u running",
+                    modeName, pThreadPool ? "pool" : "caller", expectedIndex, ITEM_COUNT, outOfOrderCount,
+                    peakInFlight, peakRunning);
+  }
+  return result;
+}
+
+static bool TestOrderedOutput(ThreadPool* pThreadPool)
+{
+  // an ordered stage works on several items at once, but passes them to a parallel sink in order
+  static const uint32 ITEM_COUNT = 3000;
+  Pipeline pipeline(8);
+
+  uint32 nextIndex = 0;
+  PipelineQueue<uint32>* pIndices = pipeline.AddSource<uint32>([&](uint32& index) {
+    index = nextIndex;
+    return (nextIndex++ < ITEM_COUNT);
+  });
+
+  PipelineQueue<uint32>* pOrdered =
+    pipeline.AddStage<uint32>(pIndices, PIPELINE_STAGE_ORDERED_PARALLEL, [](uint32& index, uint32& output) {
+      Spin(index);
+      output = index;
+    });
+
+  // one at a time, in the order they arrive
+  PODArray<uint32> arrivals;
+  pipeline.AddSink(pOrdered, PIPELINE_STAGE_PARALLEL, [&](uint32& index) { arrivals.Add(index); }, 1);
+
+  bool result = pipeline.Run(pThreadPool) && arrivals.GetSize() == ITEM_COUNT;
+  for (uint32 i = 0; i < arrivals.GetSize() && result; i++)
+    result = arrivals[i] == i;
+
+  if (result)
+    Log_InfoPrintf("PASS: ordered output");
+  else
+    Log_ErrorPrintf("FAIL: ordered output");
+  return result;
+}
+
+static bool TestBackpressure(ThreadPool* pThreadPool)
+{
+  // a fast source in front of a slow sink never gets more than the in-flight limit ahead of it
+  static const uint32 MAX_IN_FLIGHT = 4;
+  Pipeline pipeline(MAX_IN_FLIGHT);
+
+  Y_ATOMIC_DECL uint32 produced = 0;
+  Y_ATOMIC_DECL uint32 consumed = 0;
+  uint32 maxAhead = 0;
+  PipelineQueue<uint32>* pValues = pipeline.AddSource<uint32>([&](uint32& value) {
+    if (produced == 200)
+      return false;
+
+    uint32 ahead = produced - Y_AtomicLoad(consumed);
+    maxAhead = Max(maxAhead, ahead + 1);
+    value = Y_AtomicIncrement(produced);
+    return true;
+  });
+
+  PipelineQueue<uint32>* pDoubled = pipeline.AddStage<uint32>(
+    pValues, PIPELINE_STAGE_PARALLEL, [](uint32& value, uint32& doubled) { doubled = value * 2; });
+
+  uint64 sum = 0;
+  pipeline.AddSink(pDoubled, PIPELINE_STAGE_SERIAL, [&](uint32& doubled) {
+    Thread::Sleep(1);
+    sum += doubled;
+    Y_AtomicIncrement(consumed);
+  });
+
+  bool result = pipeline.Run(pThreadPool) && consumed == 200 && sum == 200 * 201 && maxAhead <= MAX_IN_FLIGHT;
+  if (result)
+    Log_InfoPrintf("PASS: backpressure, source at most %u ahead", maxAhead);
+  else
+    Log_ErrorPrintf("FAIL: backpressure, source %u ahead, %u consumed", maxAhead, consumed);
+  return result;
+}
+
+static bool TestCancel(ThreadPool* pThreadPool)
+{
+  // the source would never stop, the sink stops it, and what was in flight still comes out
+  static const uint32 MAX_IN_FLIGHT = 6;
+  Pipeline pipeline(MAX_IN_FLIGHT);
+
+  uint32 produced = 0;
+  PipelineQueue<uint32>* pValues = pipeline.AddSource<uint32>([&](uint32& value) {
+    value = produced++;
+    return true;
+  });
+
+  PipelineQueue<uint32>* pSame = pipeline.AddStage<uint32>(pValues, PIPELINE_STAGE_PARALLEL,
+                                                           [](uint32& value, uint32& output) { output = value; });
+
+  uint32 consumed = 0;
+  pipeline.AddSink(pSame, PIPELINE_STAGE_SERIAL, [&](uint32&) {
+    if (++consumed == 100)
+      pipeline.Cancel();
+  });
+
+  bool result = !pipeline.Run(pThreadPool) && consumed == produced && consumed >= 100 &&
+                consumed < 100 + MAX_IN_FLIGHT;
+  if (result)
+    Log_InfoPrintf("PASS: cancel, %u consumed", consumed);
+  else
+    Log_ErrorPrintf("FAIL: cancel, %u produced, %u consumed", produced, consumed);
+  return result;
+}
+
+DEFINE_TEST_SUITE(Pipeline)
+{
+  ThreadPool threadPool(4);
+  bool result = true;
+  result &= TestOrdering(nullptr, PIPELINE_STAGE_PARALLEL);
+  result &= TestOrdering(&threadPool, PIPELINE_STAGE_SERIAL);
+  result &= TestOrdering(&threadPool, PIPELINE_STAGE_PARALLEL);
+  result &= TestOrdering(&threadPool, PIPELINE_STAGE_ORDERED_PARALLEL);
+  result &= TestOrderedOutput(&threadPool);
+  result &= TestBackpressure(&threadPool);
+  result &= TestCancel(&threadPool);
+  return result;
+}
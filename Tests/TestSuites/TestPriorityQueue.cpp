@@ -0,0 +1,142 @@
+#include "TestSuite.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/PriorityQueue.h"
+#include "YBaseLib/Sort.h"
+Log_SetChannel(TestPriorityQueue);
+
+static uint32 NextRandom(uint32& state)
+{
+  state = state * 1664525 + 1013904223;
+  return state >> 8;
+}
+
+static bool TestPushPop()
+{
+  static const uint32 COUNT = 20000;
+  PriorityQueue<uint32> queue;
+  PODArray<uint32> values;
+  uint32 state = 1;
+
+  // interleaved pushes and pops always give the smallest remaining
+  bool result = true;
+  for (uint32 i = 0; i < COUNT && result; i++)
+  {
+    uint32 value = NextRandom(state) % 1000;
+    queue.Push(value);
+    values.Add(value);
+    if ((i % 3) == 2)
+    {
+      uint32 smallest = 0;
+      for (uint32 j = 1; j < values.GetSize(); j++)
+        smallest = (values[j] < values[smallest]) ? j : smallest;
+
+      result = (queue.Pop() == values[smallest]);
+      values.FastRemove(smallest);
+    }
+  }
+
+  Y_sort(values.GetBasePointer(), values.GetSize(), std::less<uint32>());
+  for (uint32 i = 0; i < values.GetSize() && result; i++)
+    result = (queue.Pop() == values[i]);
+  result = result && queue.IsEmpty();
+
+  // built all at once, with the largest first
+  PriorityQueue<uint32, std::greater<uint32>, 3> largestFirst;
+  for (uint32 i = 0; i < COUNT; i++)
+    values.Add(NextRandom(state));
+  largestFirst.Assign(values.GetBasePointer(), values.GetSize());
+  Y_sort(values.GetBasePointer(), values.GetSize(), std::greater<uint32>());
+  for (uint32 i = 0; i < values.GetSize() && result; i++)
+    result = (largestFirst.Top() == values[i] && largestFirst.Pop() == values[i]);
+
+  if (result)
+    Log_InfoPrint("PASS: push and pop");
+  else
+    Log_ErrorPrint("FAIL: push and pop");
+  return result;
+}
+
+struct TimerEntry
+{
+  uint64 Deadline;
+  uint32 ID;
+
+  bool operator<(const TimerEntry& other) const
+  {
+    return (Deadline < other.Deadline || (Deadline == other.Deadline && ID < other.ID));
+  }
+};
+
+static bool TestIndexed()
+{
+  static const uint32 TIMER_COUNT = 5000;
+  IndexedPriorityQueue<TimerEntry> queue;
+  PODArray<uint32> handles;
+  PODArray<uint64> deadlines;
+  PODArray<bool> live;
+  uint32 state = 7;
+
+  for (uint32 i = 0; i < TIMER_COUNT; i++)
+  {
+    TimerEntry entry = {NextRandom(state) % 100000, i};
+    handles.Add(queue.Push(entry));
+    deadlines.Add(entry.Deadline);
+    live.Add(true);
+  }
+
+  // reschedule some earlier and some later, cancel others
+  bool result = true;
+  for (uint32 i = 0; i < TIMER_COUNT; i += 3)
+  {
+    TimerEntry entry = {NextRandom(state) % 100000, i};
+    queue.Update(handles[i], entry);
+    deadlines[i] = entry.Deadline;
+    result = result && queue.Get(handles[i]).Deadline == entry.Deadline;
+  }
+  for (uint32 i = 1; i < TIMER_COUNT; i += 7)
+  {
+    queue.Remove(handles[i]);
+    live[i] = false;
+    result = result && !queue.Contains(handles[i]);
+  }
+
+  // handles freed by removal are reused
+  TimerEntry extra = {50000, TIMER_COUNT};
+  uint32 extraHandle = queue.Push(extra);
+  result = result && extraHandle < TIMER_COUNT && queue.Contains(extraHandle);
+  handles.Add(extraHandle);
+  deadlines.Add(extra.Deadline);
+  live.Add(true);
+
+  // everything left comes out in deadline order, each with the handle it was given
+  uint64 lastDeadline = 0;
+  uint32 popped = 0;
+  while (!queue.IsEmpty() && result)
+  {
+    uint32 handle = queue.GetTopHandle();
+    TimerEntry entry = queue.Pop();
+    result = entry.Deadline >= lastDeadline && live[entry.ID] && handles[entry.ID] == handle &&
+             deadlines[entry.ID] == entry.Deadline && !queue.Contains(handle);
+    live[entry.ID] = false;
+    lastDeadline = entry.Deadline;
+    popped++;
+  }
+
+  uint32 expected = TIMER_COUNT + 1 - (TIMER_COUNT + 5) / 7;
+  result = result && popped == expected;
+
+  if (result)
+    Log_InfoPrint("PASS: indexed heap");
+  else
+    Log_ErrorPrintf("FAIL: indexed heap, popped %u of %u", popped, expected);
+  return result;
+}
+
+DEFINE_TEST_SUITE(PriorityQueue)
+{
+  bool result = true;
+  result &= TestPushPop();
+  result &= TestIndexed();
+  return result;
+}
@@ -0,0 +1,222 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/Profiler.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/ThreadPool.h"
+Log_SetChannel(TestProfiler);
+
+class ZoneWorkItem : public ThreadPoolWorkItemSignaled
+{
+protected:
+  virtual int32 ProcessWork() override final
+  {
+    Y_PROFILE_ZONE("WorkerZone");
+    return 0;
+  }
+};
+
+static void RecordNestedZones()
+{
+  Y_PROFILE_ZONE("OuterZone");
+  for (uint32 i = 0; i < 3; i++)
+  {
+    Y_PROFILE_ZONE("InnerZone");
+  }
+}
+
+static String GetStreamText(GrowableMemoryByteStream* pStream)
+{
+  String text;
+  text.AppendString(reinterpret_cast<const char*>(pStream->GetMemoryPointer()), (uint32)pStream->GetSize());
+  return text;
+}
+
+static uint32 CountOccurrences(const String& text, const char* find)
+{
+  uint32 count = 0;
+  for (int32 position = text.Find(find); position >= 0; position = text.Find(find, position + 1))
+    count++;
+  return count;
+}
+
+// The slices in a Perfetto trace, walking the packets' fields as protobuf. Returns false if they don't parse, or a
+// slice ends on a track where none is open.
+static bool CountPerfettoSlices(const byte* pData, uint32 size, uint32* pBeginCount, uint32* pTrackCount)
+{
+  struct Reader
+  {
+    const byte* pData;
+    const byte* pEnd;
+
+    bool ReadVarUInt(uint64* pValue)
+    {
+      *pValue = 0;
+      for (uint32 shift = 0; pData < pEnd && shift < 64; shift += 7)
+      {
+        byte value = *pData++;
+        *pValue |= (uint64)(value & 0x7F) << shift;
+        if (!(value & 0x80))
+          return true;
+      }
+      return false;
+    }
+
+    // the field's number, and its value or its bytes, which are left alone for a varint
+    bool ReadField(uint32* pField, uint64* pValue, Reader* pBytes)
+    {
+      uint64 key;
+      if (!ReadVarUInt(&key) || !ReadVarUInt(pValue))
+        return false;
+
+      *pField = (uint32)(key >> 3);
+      if ((key & 7) == 0)
+        return true;
+      if ((key & 7) != 2 || *pValue > (uint64)(pEnd - pData))
+        return false;
+
+      pBytes->pData = pData;
+      pBytes->pEnd = pData + *pValue;
+      pData += *pValue;
+      return true;
+    }
+  };
+
+  PODArray<uint32> openSlices;
+  *pBeginCount = 0;
+  *pTrackCount = 0;
+  Reader trace = {pData, pData + size};
+  while (trace.pData < trace.pEnd)
+  {
+    uint32 field;
+    uint64 value;
+    Reader packet = {nullptr, nullptr};
+    if (!trace.ReadField(&field, &value, &packet) || field != 1)
+      return false;
+
+    while (packet.pData < packet.pEnd)
+    {
+      Reader message = {nullptr, nullptr};
+      if (!packet.ReadField(&field, &value, &message))
+        return false;
+
+      if (field == 60)
+      {
+        (*pTrackCount)++;
+      }
+      else if (field == 11)
+      {
+        uint64 type = 0;
+        uint64 track = 0;
+        while (message.pData < message.pEnd)
+        {
+          Reader bytes = {nullptr, nullptr};
+          if (!message.ReadField(&field, &value, &bytes))
+            return false;
+          if (field == 9)
+            type = value;
+          else if (field == 11)
+            track = value;
+        }
+
+        if (type == 1)
+        {
+          openSlices.Add((uint32)track);
+          (*pBeginCount)++;
+        }
+        else if (type == 2)
+        {
+          if (openSlices.IsEmpty() || openSlices.LastElement() != (uint32)track)
+            return false;
+          openSlices.RemoveBack();
+        }
+      }
+    }
+  }
+
+  return openSlices.IsEmpty();
+}
+
+// zones from two threads come out in both formats, and nothing is recorded outside a capture
+static bool TestExport()
+{
+  ThreadPool threadPool(1);
+  ZoneWorkItem* pWorkItem = new ZoneWorkItem();
+
+  RecordNestedZones();
+  Profiler::StartCapture();
+  RecordNestedZones();
+  threadPool.EnqueueWorkItem(pWorkItem);
+  pWorkItem->WaitForCompletion();
+  Profiler::StopCapture();
+  RecordNestedZones();
+  pWorkItem->Release();
+
+  GrowableMemoryByteStream* pJSONStream = ByteStream_CreateGrowableMemoryStream();
+  GrowableMemoryByteStream* pPerfettoStream = ByteStream_CreateGrowableMemoryStream();
+  bool result = Profiler::ExportChromeTrace(pJSONStream) && Profiler::ExportPerfettoTrace(pPerfettoStream);
+
+  String json = GetStreamText(pJSONStream);
+  uint32 outerCount = CountOccurrences(json, "\"name\":\"OuterZone\"");
+  uint32 innerCount = CountOccurrences(json, "\"name\":\"InnerZone\"");
+  uint32 workerCount = CountOccurrences(json, "\"name\":\"WorkerZone\"");
+  bool workerNamed = (json.Find("\"args\":{\"name\":\"Thread Pool") >= 0);
+  if (result && (outerCount != 1 || innerCount != 3 || workerCount != 1 || !workerNamed ||
+                 !json.StartsWith("{\"displayTimeUnit\"") || json.Find("\"ph\":\"X\"") < 0))
+  {
+    Log_ErrorPrintf("FAIL: chrome trace has %u outer, %u inner and %u worker zones: %s", outerCount, innerCount,
+                    workerCount, json.GetCharArray());
+    result = false;
+  }
+
+  uint32 beginCount, trackCount;
+  if (result && (!CountPerfettoSlices(pPerfettoStream->GetMemoryPointer(), (uint32)pPerfettoStream->GetSize(),
+                                      &beginCount, &trackCount) ||
+                 beginCount < 6 || trackCount < 2))
+  {
+    Log_ErrorPrint("FAIL: perfetto trace doesn't parse or nest");
+    result = false;
+  }
+
+  pPerfettoStream->Release();
+  pJSONStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: export");
+  return result;
+}
+
+// a full buffer drops and counts, and the next capture starts empty
+static bool TestDroppedEvents()
+{
+  Profiler::StartCapture(1);
+  for (uint32 i = 0; i < 10000; i++)
+  {
+    Y_PROFILE_ZONE("DroppedZone");
+  }
+  Profiler::StopCapture();
+  uint32 droppedCount = Profiler::GetDroppedEventCount();
+
+  Profiler::StartCapture();
+  Profiler::StopCapture();
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  bool result = Profiler::ExportChromeTrace(pStream) && droppedCount > 0 && droppedCount < 10000 &&
+                Profiler::GetDroppedEventCount() == 0 && GetStreamText(pStream).Find("DroppedZone") < 0;
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: dropped events");
+  else
+    Log_ErrorPrintf("FAIL: dropped events (%u dropped)", droppedCount);
+  return result;
+}
+
+DEFINE_TEST_SUITE(Profiler)
+{
+#if Y_PROFILER_ENABLED
+  return TestExport() && TestDroppedEvents();
+#else
+  Log_InfoPrint("SKIP: zones aren't compiled in");
+  return true;
+#endif
+}
@@ -0,0 +1,260 @@
+#include "TestSuite.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/RPCChannel.h"
+Log_SetChannel(TestRPCChannel);
+
+enum TestMethod
+{
+  TestMethod_Add,
+  TestMethod_Deferred,
+  TestMethod_Notify,
+  TestMethod_Fail,
+  TestMethod_Unknown,
+};
+
+// two channels back to back, each sending straight into the other, counting the batches that go each way
+struct ChannelPair
+{
+  ChannelPair(bool stream, uint32 maxBatchSize = RPCChannel::DefaultMaxBatchSize)
+    : Client([this, stream](const void* pData, size_t size) { return Deliver(&Server, pData, size, stream); },
+             maxBatchSize),
+      Server([this, stream](const void* pData, size_t size) { return Deliver(&Client, pData, size, stream); },
+             maxBatchSize),
+      Batches(0), Malformed(false)
+  {
+  }
+
+  bool Deliver(RPCChannel* pChannel, const void* pData, size_t size, bool stream)
+  {
+    Batches++;
+    if (!stream)
+    {
+      Malformed |= !pChannel->ReceiveFrames(pData, size);
+      return true;
+    }
+
+    // a byte at a time, so every frame is cut off somewhere
+    for (size_t i = 0; i < size; i++)
+      Malformed |= !pChannel->ReceiveStream(reinterpret_cast<const byte*>(pData) + i, 1);
+    return true;
+  }
+
+  RPCChannel Client;
+  RPCChannel Server;
+  uint32 Batches;
+  bool Malformed;
+};
+
+static void RegisterAdd(RPCChannel* pChannel)
+{
+  pChannel->RegisterMethod(TestMethod_Add, [](RPCChannel* pChannel, uint32 requestID, BinaryReader* pArguments) {
+    int32 sum = pArguments->ReadVarInt32() + pArguments->ReadVarInt32();
+    pChannel->BeginResponse(requestID)->WriteVarInt32(sum);
+    pChannel->EndMessage();
+  });
+}
+
+static void CallAdd(RPCChannel* pChannel, int32 a, int32 b, int32* pResult)
+{
+  BinaryWriter* pArguments = pChannel->BeginCall(TestMethod_Add, [pResult](BinaryReader* pResults, const Error*) {
+    *pResult = (pResults != nullptr) ? pResults->ReadVarInt32() : -1;
+  });
+  pArguments->WriteVarInt32(a);
+  pArguments->WriteVarInt32(b);
+  pChannel->EndMessage();
+}
+
+static bool TestCalls(bool stream)
+{
+  ChannelPair pair(stream);
+  RegisterAdd(&pair.Server);
+
+  bool result = true;
+  {
+    int32 sum = 0;
+    CallAdd(&pair.Client, 2, -5, &sum);
+    result = result && sum == -3 && pair.Client.GetOutstandingCallCount() == 0;
+
+    // notifications take no answer
+    uint32 notified = 0;
+    pair.Server.RegisterMethod(TestMethod_Notify, [&notified](RPCChannel*, uint32 requestID, BinaryReader* pArgs) {
+      notified += (requestID == 0) ? pArgs->ReadVarUInt32() : 1000;
+    });
+    pair.Client.BeginNotify(TestMethod_Notify)->WriteVarUInt32(7);
+    pair.Client.EndMessage();
+    result = result && notified == 7;
+
+    // failures come back as errors, with the method's code and message
+    pair.Server.RegisterMethod(TestMethod_Fail, [](RPCChannel* pChannel, uint32 requestID, BinaryReader*) {
+      pChannel->RespondError(requestID, 42, "failed");
+    });
+    int32 errorCode = 0;
+    String message;
+    pair.Client.BeginCall(TestMethod_Fail, [&](BinaryReader* pResults, const Error* pError) {
+      if (pResults == nullptr)
+      {
+        errorCode = pError->GetErrorCodeUser();
+        message = pError->GetErrorDescription();
+      }
+    });
+    pair.Client.EndMessage();
+    result = result && errorCode == 42 && message.Compare("failed");
+
+    // so do calls to methods that aren't there
+    bool unknownFailed = false;
+    pair.Client.BeginCall(TestMethod_Unknown, [&](BinaryReader* pResults, const Error*) {
+      unknownFailed = (pResults == nullptr);
+    });
+    pair.Client.EndMessage();
+    result = result && unknownFailed && pair.Client.GetOutstandingCallCount() == 0 && !pair.Malformed;
+  }
+
+  if (result)
+    Log_InfoPrintf("PASS: %s calls", stream ? "stream" : "frame");
+  else
+    Log_ErrorPrintf("FAIL: %s calls", stream ? "stream" : "frame");
+  return result;
+}
+
+static bool TestPipelining()
+{
+  ChannelPair pair(false);
+  RegisterAdd(&pair.Server);
+
+  // answered later, last first
+  PODArray<uint32> deferredRequests;
+  pair.Server.RegisterMethod(TestMethod_Deferred, [&](RPCChannel*, uint32 requestID, BinaryReader*) {
+    deferredRequests.Add(requestID);
+  });
+
+  bool result = true;
+  {
+    uint32 order[4] = {};
+    uint32 responses = 0;
+    for (uint32 i = 0; i < 4; i++)
+    {
+      pair.Client.BeginCall(TestMethod_Deferred, [&, i](BinaryReader* pResults, const Error*) {
+        if (pResults != nullptr && pResults->ReadVarUInt32() == i)
+          order[responses++] = i;
+      });
+      pair.Client.EndMessage();
+    }
+    result = result && deferredRequests.GetSize() == 4 && pair.Client.GetOutstandingCallCount() == 4;
+
+    // other calls aren't held up behind them
+    int32 sum = 0;
+    CallAdd(&pair.Client, 1, 1, &sum);
+    result = result && sum == 2;
+
+    for (uint32 i = 4; i > 0; i--)
+    {
+      pair.Server.BeginResponse(deferredRequests[i - 1])->WriteVarUInt32(i - 1);
+      pair.Server.EndMessage();
+    }
+    result = result && responses == 4 && order[0] == 3 && order[3] == 0 && pair.Client.GetOutstandingCallCount() == 0;
+  }
+
+  if (result)
+    Log_InfoPrint("PASS: pipelining");
+  else
+    Log_ErrorPrint("FAIL: pipelining");
+  return result;
+}
+
+static bool TestBatching()
+{
+  ChannelPair pair(false, 64);
+  RegisterAdd(&pair.Server);
+
+  bool result = true;
+  {
+    // corked calls go in one batch, and their responses come back in another
+    int32 sums[3] = {};
+    pair.Client.Cork();
+    for (int32 i = 0; i < 3; i++)
+      CallAdd(&pair.Client, i, i, &sums[i]);
+    result = result && pair.Batches == 0;
+    pair.Client.Uncork();
+    result = result && pair.Batches == 2 && sums[0] == 0 && sums[1] == 2 && sums[2] == 4;
+
+    // more than a batch holds is split between several
+    int32 moreSums[16] = {};
+    pair.Batches = 0;
+    pair.Client.Cork();
+    for (int32 i = 0; i < 16; i++)
+      CallAdd(&pair.Client, i, 1000, &moreSums[i]);
+    pair.Client.Uncork();
+    result = result && pair.Batches > 2 && moreSums[0] == 1000 && moreSums[15] == 1015;
+
+    // a frame larger than a batch fails its call, and nothing's sent
+    bool failed = false;
+    pair.Batches = 0;
+    BinaryWriter* pArguments = pair.Client.BeginCall(TestMethod_Add, [&](BinaryReader* pResults, const Error*) {
+      failed = (pResults == nullptr);
+    });
+    for (uint32 i = 0; i < 64; i++)
+      pArguments->WriteVarInt32(i);
+    result = result && !pair.Client.EndMessage() && failed && pair.Batches == 0;
+    result = result && pair.Client.GetOutstandingCallCount() == 0 && !pair.Malformed;
+  }
+
+  if (result)
+    Log_InfoPrint("PASS: batching");
+  else
+    Log_ErrorPrint("FAIL: batching");
+  return result;
+}
+
+static bool TestClose()
+{
+  ChannelPair pair(false);
+  pair.Server.RegisterMethod(TestMethod_Deferred, [](RPCChannel*, uint32, BinaryReader*) {});
+
+  bool result = true;
+  {
+    uint32 failures = 0;
+    for (uint32 i = 0; i < 2; i++)
+    {
+      pair.Client.BeginCall(TestMethod_Deferred, [&](BinaryReader* pResults, const Error* pError) {
+        if (pResults == nullptr && pError->GetErrorCodeUser() == 5)
+          failures++;
+      });
+      pair.Client.EndMessage();
+    }
+
+    // outstanding calls fail with the close's error, and later ones straight away
+    Error error;
+    error.SetErrorUserStatic(5, "Connection lost.");
+    pair.Client.Close(&error);
+    result = result && failures == 2 && pair.Client.IsClosed() && pair.Client.GetOutstandingCallCount() == 0;
+
+    uint32 batches = pair.Batches;
+    pair.Client.BeginCall(TestMethod_Deferred, [&](BinaryReader* pResults, const Error* pError) {
+      if (pResults == nullptr && pError->GetErrorCodeUser() == 5)
+        failures++;
+    });
+    result = result && !pair.Client.EndMessage() && failures == 3 && pair.Batches == batches;
+
+    // garbage is refused
+    byte garbage[] = {3, 9, 1, 1};
+    result = result && !pair.Server.ReceiveFrames(garbage, sizeof(garbage));
+  }
+
+  if (result)
+    Log_InfoPrint("PASS: close");
+  else
+    Log_ErrorPrint("FAIL: close");
+  return result;
+}
+
+DEFINE_TEST_SUITE(RPCChannel)
+{
+  bool result = true;
+  result &= TestCalls(false);
+  result &= TestCalls(true);
+  result &= TestPipelining();
+  result &= TestBatching();
+  result &= TestClose();
+  return result;
+}
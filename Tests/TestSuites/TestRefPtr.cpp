@@ -0,0 +1,116 @@
+#include "TestSuite.h"
+#include "YBaseLib/DeferredReleaseQueue.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/RefPtr.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(TestRefPtr);
+
+static Y_ATOMIC_DECL uint32 s_liveObjects = 0;
+
+template<class BASE>
+class TrackedObject : public BASE
+{
+public:
+  TrackedObject(uint32 value) : m_value(value) { Y_AtomicIncrement(s_liveObjects); }
+  ~TrackedObject() { Y_AtomicDecrement(s_liveObjects); }
+
+  uint32 GetValue() const { return m_value; }
+
+private:
+  uint32 m_value;
+};
+
+typedef TrackedObject<ReferenceCounted> SharedObject;
+typedef TrackedObject<SingleThreadReferenceCounted> LocalObject;
+
+template<class T>
+static RefPtr<T> PassThrough(RefPtr<T> ptr)
+{
+  return ptr;
+}
+
+template<class T>
+static bool TestOwnership(const char* name)
+{
+  bool result = true;
+  {
+    RefPtr<T> first = MakeRefPtr<T>(5);
+    RefPtr<T> second(first);
+    RefPtr<T> third = PassThrough(std::move(second));
+    result = result && second.IsNull() && third == first && third->GetValue() == 5;
+
+    // self assignment keeps the object alive
+    third = third;
+    third = std::move(third);
+    result = result && third && s_liveObjects == 1;
+
+    first.Reset();
+    T* pRaw = third.Detach();
+    result = result && s_liveObjects == 1 && !third;
+    third = RefPtr<T>::Adopt(pRaw);
+  }
+  result = result && s_liveObjects == 0;
+
+  if (result)
+    Log_InfoPrintf("PASS: %s ownership", name);
+  else
+    Log_ErrorPrintf("FAIL: %s ownership, %u objects live", name, s_liveObjects);
+  return result;
+}
+
+class ReleasingThread : public Thread
+{
+public:
+  static const uint32 ObjectCount = 1000;
+
+  ReleasingThread() : m_pQueue(nullptr) {}
+  void SetQueue(DeferredReleaseQueue* pQueue) { m_pQueue = pQueue; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    for (uint32 i = 0; i < ObjectCount; i++)
+    {
+      RefPtr<SharedObject> ptr = MakeRefPtr<SharedObject>(i);
+      m_pQueue->Release(ptr);
+    }
+
+    return 0;
+  }
+
+private:
+  DeferredReleaseQueue* m_pQueue;
+};
+
+static bool TestDeferredRelease()
+{
+  static const uint32 ThreadCount = 4;
+  DeferredReleaseQueue queue;
+  ReleasingThread threads[ThreadCount];
+  for (uint32 i = 0; i < ThreadCount; i++)
+  {
+    threads[i].SetQueue(&queue);
+    threads[i].Start();
+  }
+
+  // flushing while the producers run must not lose anything
+  uint32 released = 0;
+  for (uint32 i = 0; i < 100; i++)
+    released += queue.Flush();
+  for (uint32 i = 0; i < ThreadCount; i++)
+    threads[i].Join();
+  released += queue.Flush();
+
+  bool result = (released == ThreadCount * ReleasingThread::ObjectCount && s_liveObjects == 0 &&
+                 queue.GetPendingCount() == 0);
+  if (result)
+    Log_InfoPrintf("PASS: deferred release");
+  else
+    Log_ErrorPrintf("FAIL: deferred release, released %u with %u objects live", released, s_liveObjects);
+  return result;
+}
+
+DEFINE_TEST_SUITE(RefPtr)
+{
+  return TestOwnership<SharedObject>("atomic") && TestOwnership<LocalObject>("single thread") && TestDeferredRelease();
+}
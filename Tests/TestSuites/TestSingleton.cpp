@@ -0,0 +1,80 @@
+#include "TestSuite.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Singleton.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(TestSingleton);
+
+static Y_ATOMIC_DECL uint32 s_constructedCount = 0;
+static Y_ATOMIC_DECL uint32 s_destroyedCount = 0;
+
+// slow to construct, so threads asking for it at once all arrive before it's published
+class SlowSingleton : public Singleton<SlowSingleton>
+{
+public:
+  SlowSingleton() : m_value(0)
+  {
+    Y_AtomicIncrement(s_constructedCount);
+    Thread::Sleep(20);
+    m_value = 1234;
+  }
+
+  ~SlowSingleton() { Y_AtomicIncrement(s_destroyedCount); }
+
+  uint32 GetValue() const { return m_value; }
+
+private:
+  uint32 m_value;
+};
+
+class GettingThread : public Thread
+{
+public:
+  GettingThread() : m_pInstance(nullptr), m_value(0) {}
+
+  SlowSingleton* GetInstancePointer() const { return m_pInstance; }
+  uint32 GetValue() const { return m_value; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    m_pInstance = &SlowSingleton::GetInstance();
+    m_value = m_pInstance->GetValue();
+    return 0;
+  }
+
+private:
+  SlowSingleton* m_pInstance;
+  uint32 m_value;
+};
+
+DEFINE_TEST_SUITE(Singleton)
+{
+  static const uint32 ThreadCount = 8;
+
+  // constructed once, and fully, whichever thread gets there first
+  bool result = !SlowSingleton::HasInstance();
+  GettingThread threads[ThreadCount];
+  for (uint32 i = 0; i < ThreadCount; i++)
+    threads[i].Start();
+  for (uint32 i = 0; i < ThreadCount; i++)
+    threads[i].Join();
+
+  SlowSingleton* pInstance = &SlowSingleton::GetInstance();
+  for (uint32 i = 0; i < ThreadCount; i++)
+    result = result && threads[i].GetInstancePointer() == pInstance && threads[i].GetValue() == 1234;
+  result = result && s_constructedCount == 1 && SlowSingleton::HasInstance();
+
+  // destroyed when asked, and made again in the same place
+  SlowSingleton::DestroyInstance();
+  result = result && s_destroyedCount == 1 && !SlowSingleton::HasInstance();
+  SlowSingleton::DestroyInstance();
+  result = result && s_destroyedCount == 1;
+  result = result && &SlowSingleton::GetInstance() == pInstance && s_constructedCount == 2;
+
+  if (result)
+    Log_InfoPrint("PASS: singleton");
+  else
+    Log_ErrorPrintf("FAIL: singleton, constructed %u destroyed %u", s_constructedCount, s_destroyedCount);
+  return result;
+}
@@ -0,0 +1,109 @@
+#include "TestSuite.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/SlotMap.h"
+Log_SetChannel(TestSlotMap);
+
+static uint32 NextRandom(uint32& state)
+{
+  state = state * 1664525 + 1013904223;
+  return state >> 8;
+}
+
+struct SessionObject
+{
+  uint32 ID;
+  uint32 Payload[3];
+};
+
+template<typename HandleType>
+static bool TestRandomChanges()
+{
+  static const uint32 OBJECT_COUNT = 5000;
+  SlotMap<SessionObject, HandleType> objects;
+  PODArray<HandleType> handles;
+  PODArray<bool> live;
+  uint32 state = 11;
+
+  bool result = true;
+  for (uint32 i = 0; i < 30000 && result; i++)
+  {
+    if (handles.GetSize() < OBJECT_COUNT && (NextRandom(state) % 3) != 0)
+    {
+      SessionObject object = {handles.GetSize(), {i, i * 2, i * 3}};
+      HandleType handle = objects.Insert(object);
+      result = handle != objects.InvalidHandle && objects.Contains(handle);
+      handles.Add(handle);
+      live.Add(true);
+    }
+    else if (!handles.IsEmpty())
+    {
+      // removing again, or through a stale handle, does nothing
+      uint32 id = NextRandom(state) % handles.GetSize();
+      result = objects.Remove(handles[id]) == live[id] && !objects.Remove(handles[id]);
+      live[id] = false;
+    }
+  }
+
+  // every live handle finds its own object, every removed one finds nothing
+  uint32 liveCount = 0;
+  for (uint32 id = 0; id < handles.GetSize() && result; id++)
+  {
+    const SessionObject* pObject = objects.Get(handles[id]);
+    result = live[id] ? (pObject != nullptr && pObject->ID == id) : (pObject == nullptr);
+    liveCount += live[id] ? 1 : 0;
+  }
+
+  // the packed array holds exactly the live objects, each knowing its handle
+  uint32 walked = 0;
+  for (SessionObject& object : objects)
+  {
+    result = result && live[object.ID] && objects.GetHandle(walked) == handles[object.ID];
+    walked++;
+  }
+  result = result && walked == liveCount && objects.GetSize() == liveCount;
+
+  objects.Clear();
+  for (uint32 id = 0; id < handles.GetSize() && result; id++)
+    result = !objects.Contains(handles[id]);
+  result = result && objects.IsEmpty() && !objects.Contains(objects.InvalidHandle);
+  return result;
+}
+
+static bool TestGenerations()
+{
+  // one slot reused over and over never gives out the same handle twice in a row, or 0
+  SlotMap<uint32> values;
+
+  bool result = true;
+  uint32 previous = values.Insert(0);
+  for (uint32 i = 1; i < 10000 && result; i++)
+  {
+    values.Remove(previous);
+    uint32 handle = values.Insert(i);
+    result = handle != previous && handle != SlotMap<uint32>::InvalidHandle && !values.Contains(previous) &&
+             *values.Get(handle) == i;
+    previous = handle;
+  }
+
+  // made-up handles are rejected rather than reaching a free or out of range slot
+  result = result && !values.Contains(0xFFFFFFFF) && values.Get(previous + 1) == nullptr;
+  return result;
+}
+
+DEFINE_TEST_SUITE(SlotMap)
+{
+  bool result = TestRandomChanges<uint32>() && TestRandomChanges<uint64>();
+  if (result)
+    Log_InfoPrint("PASS: insert and remove");
+  else
+    Log_ErrorPrint("FAIL: insert and remove");
+
+  bool generationsResult = TestGenerations();
+  if (generationsResult)
+    Log_InfoPrint("PASS: generations");
+  else
+    Log_ErrorPrint("FAIL: generations");
+
+  return result && generationsResult;
+}
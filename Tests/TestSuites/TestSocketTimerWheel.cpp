@@ -0,0 +1,267 @@
+#include "TestSuite.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/NumericLimits.h"
+#include "YBaseLib/Sockets/SocketTimerWheel.h"
+Log_SetChannel(TestSocketTimerWheel);
+
+static const uint64 WHEEL_SPAN = (uint64)1 << (SocketTimerWheel::SlotBits * SocketTimerWheel::Levels);
+
+// the wheel only hands timers back, so the tests note when each one would have fired
+struct TestTimer : public SocketTimer
+{
+  TestTimer() : SocketTimer(OnTimer, nullptr), DueTick(0), FiredTick(0), FireCount(0) {}
+  static void OnTimer(SocketTimer*, void*) {}
+
+  uint64 DueTick;
+  uint64 FiredTick;
+  uint32 FireCount;
+};
+
+static uint32 NextRandom(uint32& state)
+{
+  state = state * 1664525 + 1013904223;
+  return state >> 8;
+}
+
+static void ScheduleTestTimer(SocketTimerWheel& wheel, TestTimer& timer, uint64 currentTick, uint32 milliseconds)
+{
+  timer.DueTick = wheel.ScheduleTimer(&timer, currentTick, milliseconds);
+}
+
+static uint32 FireDueTimers(SocketTimerWheel& wheel, uint64 currentTick)
+{
+  uint32 count = 0;
+  wheel.AdvanceTimers(currentTick);
+
+  SocketTimer* pTimer;
+  while ((pTimer = wheel.TakeDueTimer()) != nullptr)
+  {
+    TestTimer* pTestTimer = static_cast<TestTimer*>(pTimer);
+    pTestTimer->FiredTick = currentTick;
+    pTestTimer->FireCount++;
+    count++;
+  }
+
+  return count;
+}
+
+// Runs the wheel as an event loop does, sleeping for the wait it asks for each time, until no timers are left or
+// the tick limit. Returns false if it ever asks to sleep past a timer, or for nothing with none due.
+static bool RunUntilIdle(SocketTimerWheel& wheel, uint64* pCurrentTick, uint64 limitTick, uint32* pWakeups)
+{
+  uint64 currentTick = *pCurrentTick;
+  uint32 wakeups = 0;
+  bool result = true;
+  while (wheel.GetTimerCount() > 0 && currentTick < limitTick && result)
+  {
+    uint32 wait = wheel.GetTimerWait(currentTick, Y_UINT32_MAX);
+    result = (wait > 0 && wait != Y_UINT32_MAX);
+    currentTick += wait;
+    FireDueTimers(wheel, currentTick);
+    wakeups++;
+  }
+
+  *pCurrentTick = currentTick;
+  if (pWakeups != nullptr)
+    *pWakeups = wakeups;
+
+  return result;
+}
+
+static bool TestScheduleAndFire()
+{
+  TestTimer first, second;
+  SocketTimerWheel wheel;
+  uint64 currentTick = 1000;
+
+  // due on the tick after the wait is up, and not before
+  ScheduleTestTimer(wheel, first, currentTick, 10);
+  ScheduleTestTimer(wheel, second, currentTick, 10);
+  bool result = first.DueTick == currentTick + 11 && first.IsScheduled() && wheel.GetTimerCount() == 2;
+  result = result && wheel.GetTimerWait(currentTick, Y_UINT32_MAX) == 11 && wheel.GetTimerWait(currentTick, 5) == 5;
+  result = result && FireDueTimers(wheel, currentTick + 10) == 0 && first.FireCount == 0;
+  result = result && FireDueTimers(wheel, currentTick + 11) == 2 && first.FiredTick == first.DueTick &&
+           second.FiredTick == second.DueTick && !first.IsScheduled() && wheel.GetTimerCount() == 0;
+
+  // an empty wheel doesn't need waking, and catches up to a late schedule without firing on the ticks skipped
+  result = result && wheel.GetTimerWait(currentTick + 11, Y_UINT32_MAX) == Y_UINT32_MAX;
+  currentTick += 50000;
+  ScheduleTestTimer(wheel, first, currentTick, 0);
+  result = result && wheel.GetTimerWait(currentTick, Y_UINT32_MAX) == 1;
+  result = result && FireDueTimers(wheel, currentTick + 1) == 1 && first.FireCount == 2;
+
+  // a wheel advanced late fires what it missed
+  ScheduleTestTimer(wheel, first, currentTick + 1, 30);
+  result = result && FireDueTimers(wheel, currentTick + 500) == 1 && first.FiredTick == currentTick + 500;
+  return result;
+}
+
+static bool TestCancel()
+{
+  TestTimer kept, cancelled, moved;
+  SocketTimerWheel wheel;
+  uint64 currentTick = 77;
+
+  ScheduleTestTimer(wheel, kept, currentTick, 20);
+  ScheduleTestTimer(wheel, cancelled, currentTick, 20);
+  ScheduleTestTimer(wheel, moved, currentTick, 20);
+
+  // cancelling twice, or scheduling a scheduled timer again, leaves it scheduled once
+  bool result = wheel.CancelTimer(&cancelled) && !wheel.CancelTimer(&cancelled) && !cancelled.IsScheduled();
+  ScheduleTestTimer(wheel, moved, currentTick, 5000);
+  result = result && wheel.GetTimerCount() == 2;
+  result = result && FireDueTimers(wheel, currentTick + 21) == 1 && kept.FireCount == 1 && cancelled.FireCount == 0 &&
+           moved.FireCount == 0;
+
+  // once taken off the wheel to fire, it can't be cancelled
+  result = result && !wheel.CancelTimer(&kept);
+  result = result && FireDueTimers(wheel, moved.DueTick) == 1 && moved.FiredTick == moved.DueTick;
+
+  // cancelling the last timer leaves nothing to wait for
+  ScheduleTestTimer(wheel, cancelled, moved.DueTick, 100000);
+  result = result && wheel.CancelTimer(&cancelled) && wheel.GetTimerCount() == 0 &&
+           wheel.GetTimerWait(moved.DueTick, 1000) == 1000;
+  return result;
+}
+
+static bool TestCascade()
+{
+  // Each wait lands on a different level, starting off a boundary, so level 1 and 2 slots cascade down, and the
+  // timer has to come out on its own tick rather than its slot's first.
+  static const uint32 waits[] = {63, 64, 65, 1000, 4095, 4096, 4097, 70001, 262143, 262144, 300007, 5000003};
+  bool result = true;
+  for (uint32 i = 0; i < countof(waits) && result; i++)
+  {
+    TestTimer timer;
+    SocketTimerWheel wheel;
+    uint64 currentTick = 4096 * 3 + 17;
+    ScheduleTestTimer(wheel, timer, currentTick, waits[i]);
+
+    // a tick short of it, it's still waiting, wherever it's cascaded to
+    result = FireDueTimers(wheel, timer.DueTick - 1) == 0 && timer.IsScheduled();
+    result = result && FireDueTimers(wheel, timer.DueTick) == 1 && timer.FiredTick == timer.DueTick;
+  }
+
+  // the look ahead wakes on cascades, never past the timer, and far less often than every tick
+  for (uint32 i = 0; i < countof(waits) && result; i++)
+  {
+    TestTimer timer;
+    SocketTimerWheel wheel;
+    uint64 currentTick = 4096 * 5 + 4000;
+    uint32 wakeups;
+    ScheduleTestTimer(wheel, timer, currentTick, waits[i]);
+    result = RunUntilIdle(wheel, &currentTick, Y_UINT64_MAX, &wakeups) && timer.FiredTick == timer.DueTick &&
+             wakeups <= 2 + waits[i] / 4096 + SocketTimerWheel::Slots;
+  }
+
+  return result;
+}
+
+static bool TestBeyondSpan()
+{
+  // Waits past the wheel's span are held in its last slot and placed again from their real expiry as it comes
+  // round, which for the longest wait possible is many times over.
+  static const uint32 waits[] = {(uint32)WHEEL_SPAN - 2, (uint32)WHEEL_SPAN - 1, (uint32)WHEEL_SPAN,
+                                 (uint32)WHEEL_SPAN + 12345, (uint32)(WHEEL_SPAN * 2) + 777};
+  bool result = true;
+  for (uint32 i = 0; i < countof(waits) && result; i++)
+  {
+    TestTimer timer;
+    SocketTimerWheel wheel;
+    uint64 currentTick = 4096 * 64 * 2 + 4096 + 33;
+    ScheduleTestTimer(wheel, timer, currentTick, waits[i]);
+    result = timer.DueTick == currentTick + waits[i] + 1;
+    result = result && RunUntilIdle(wheel, &currentTick, Y_UINT64_MAX, nullptr) && timer.FiredTick == timer.DueTick;
+  }
+
+  // a timer for the longest wait isn't fired early however far the wheel's advanced in one go
+  TestTimer timer;
+  SocketTimerWheel wheel;
+  ScheduleTestTimer(wheel, timer, 0, Y_UINT32_MAX);
+  result = result && FireDueTimers(wheel, WHEEL_SPAN * 3) == 0 && timer.IsScheduled();
+  result = result && wheel.CancelTimer(&timer);
+  return result;
+}
+
+static bool TestRandomTimers()
+{
+  // many timers across every level, scheduled, moved and cancelled as the wheel runs, each fires once, on time
+  static const uint32 TIMER_COUNT = 500;
+  TestTimer timers[TIMER_COUNT];
+  bool cancelled[TIMER_COUNT] = {};
+  SocketTimerWheel wheel;
+  uint32 state = 5;
+
+  uint64 currentTick = 123456;
+  for (uint32 i = 0; i < TIMER_COUNT; i++)
+  {
+    uint32 level = NextRandom(state) % SocketTimerWheel::Levels;
+    uint32 wait = NextRandom(state) % (1u << (SocketTimerWheel::SlotBits * (level + 1)));
+    ScheduleTestTimer(wheel, timers[i], currentTick, wait);
+  }
+
+  bool result = true;
+  for (uint32 step = 0; step < 200 && result; step++)
+  {
+    uint32 wait = wheel.GetTimerWait(currentTick, Y_UINT32_MAX);
+    currentTick += (wait == Y_UINT32_MAX) ? 1 : wait;
+    FireDueTimers(wheel, currentTick);
+
+    uint32 index = NextRandom(state) % TIMER_COUNT;
+    if (timers[index].IsScheduled() && (NextRandom(state) % 2) == 0)
+    {
+      result = wheel.CancelTimer(&timers[index]);
+      cancelled[index] = true;
+    }
+    else if (timers[index].FireCount == 0 && !cancelled[index])
+    {
+      ScheduleTestTimer(wheel, timers[index], currentTick, NextRandom(state) % 100000);
+    }
+  }
+
+  result = result && RunUntilIdle(wheel, &currentTick, Y_UINT64_MAX, nullptr);
+  for (uint32 i = 0; i < TIMER_COUNT && result; i++)
+  {
+    if (cancelled[i])
+      result = timers[i].FireCount == 0;
+    else
+      result = timers[i].FireCount == 1 && timers[i].FiredTick == timers[i].DueTick;
+  }
+
+  return result;
+}
+
+DEFINE_TEST_SUITE(SocketTimerWheel)
+{
+  bool scheduleResult = TestScheduleAndFire();
+  if (scheduleResult)
+    Log_InfoPrint("PASS: schedule and fire");
+  else
+    Log_ErrorPrint("FAIL: schedule and fire");
+
+  bool cancelResult = TestCancel();
+  if (cancelResult)
+    Log_InfoPrint("PASS: cancel");
+  else
+    Log_ErrorPrint("FAIL: cancel");
+
+  bool cascadeResult = TestCascade();
+  if (cascadeResult)
+    Log_InfoPrint("PASS: cascade");
+  else
+    Log_ErrorPrint("FAIL: cascade");
+
+  bool beyondSpanResult = TestBeyondSpan();
+  if (beyondSpanResult)
+    Log_InfoPrint("PASS: beyond the wheel span");
+  else
+    Log_ErrorPrint("FAIL: beyond the wheel span");
+
+  bool randomResult = TestRandomTimers();
+  if (randomResult)
+    Log_InfoPrint("PASS: random timers");
+  else
+    Log_ErrorPrint("FAIL: random timers");
+
+  return scheduleResult && cancelResult && cascadeResult && beyondSpanResult && randomResult;
+}
@@ -0,0 +1,600 @@
+#include "TestSuite.h"
+#include "YBaseLib/Error.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/Sockets/BufferedStreamSocket.h"
+#include "YBaseLib/Sockets/DatagramSocket.h"
+#include "YBaseLib/Sockets/ListenSocket.h"
+#include "YBaseLib/Sockets/MessageSocket.h"
+#include "YBaseLib/Sockets/RPCSocket.h"
+#include "YBaseLib/Sockets/SocketMultiplexer.h"
+#include "YBaseLib/Thread.h"
+#include "YBaseLib/Timer.h"
+Log_SetChannel(TestSockets);
+
+// Everything connects over loopback, to listen sockets on port 0, so the tests don't need the network or a free port.
+
+static void FillPattern(byte* pBytes, size_t count, uint32 seed)
+{
+  for (size_t i = 0; i < count; i++)
+    pBytes[i] = (byte)(((uint32)i * 2654435761u + seed * 40503u) >> 24);
+}
+
+static bool CheckPattern(const byte* pBytes, size_t count, uint32 seed)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    if (pBytes[i] != (byte)(((uint32)i * 2654435761u + seed * 40503u) >> 24))
+      return false;
+  }
+
+  return true;
+}
+
+static bool GetLoopbackAddress(SocketAddress* pAddress)
+{
+  return SocketAddress::Parse(SocketAddress::Type_IPv4, "127.0.0.1", 0, pAddress);
+}
+
+// Runs the multiplexer, or waits on its worker threads, until the condition holds, giving up after a while.
+template<typename Condition>
+static bool WaitFor(SocketMultiplexer* pMultiplexer, bool workerThreads, Condition condition)
+{
+  Timer timer;
+  while (!condition())
+  {
+    if (timer.GetTimeSeconds() > 20.0)
+      return false;
+
+    if (workerThreads)
+      Thread::Sleep(1);
+    else
+      pMultiplexer->PollEvents(10);
+  }
+
+  return true;
+}
+
+// Echoes what it receives, as much as the send buffer takes, and the rest once there's room. The buffers are small
+// so they wrap and fill.
+class EchoSocket : public BufferedStreamSocket
+{
+public:
+  EchoSocket() : BufferedStreamSocket(4096, 4096) {}
+
+protected:
+  virtual void OnRead() override { Echo(); }
+  virtual void OnSendBufferSpace() override { Echo(); }
+
+private:
+  void Echo()
+  {
+    const void* pData;
+    size_t size;
+    while (AcquireReadBuffer(&pData, &size))
+    {
+      size_t written = Write(pData, size);
+      ReleaseReadBuffer(written);
+      if (written < size)
+        break;
+    }
+  }
+};
+
+// keeps what it receives, from the receive buffer or straight from pooled buffers, whichever the mode is
+class CollectorSocket : public BufferedStreamSocket
+{
+public:
+  CollectorSocket() : BufferedStreamSocket(4096, 4096), m_disconnected(false) {}
+
+  size_t GetReceivedSize()
+  {
+    m_receivedLock.Lock();
+    size_t size = m_received.GetSize();
+    m_receivedLock.Unlock();
+    return size;
+  }
+
+  const PODArray<byte>& GetReceived() const { return m_received; }
+  bool IsDisconnected() const { return m_disconnected; }
+
+protected:
+  virtual void OnRead() override
+  {
+    byte buffer[1024];
+    size_t size;
+    while ((size = Read(buffer, sizeof(buffer))) > 0)
+      Keep(buffer, size);
+  }
+
+  virtual void OnReadBuffer(SocketBuffer* pBuffer) override { Keep(pBuffer->GetData(), pBuffer->GetSize()); }
+
+  virtual void OnDisconnected(Error* pError) override
+  {
+    m_disconnected = true;
+    BufferedStreamSocket::OnDisconnected(pError);
+  }
+
+private:
+  void Keep(const byte* pData, size_t size)
+  {
+    m_receivedLock.Lock();
+    m_received.AddRange(pData, (uint32)size);
+    m_receivedLock.Unlock();
+  }
+
+  Mutex m_receivedLock;
+  PODArray<byte> m_received;
+  volatile bool m_disconnected;
+};
+
+static bool TestEcho(SOCKET_MULTIPLEXER_TYPE type, bool workerThreads, bool pooledBuffers, uint64 sendRateLimit)
+{
+  Error error;
+  SocketMultiplexer* pMultiplexer = SocketMultiplexer::Create(type, &error);
+  if (pMultiplexer == nullptr)
+    return false;
+
+  if (workerThreads)
+    pMultiplexer->CreateWorkerThreads(2);
+
+  SocketAddress address;
+  ListenSocket* pListenSocket = GetLoopbackAddress(&address) ?
+                                  pMultiplexer->CreateListenSocket<EchoSocket>(&address, &error) :
+                                  nullptr;
+  CollectorSocket* pClient = (pListenSocket != nullptr) ?
+                               pMultiplexer->ConnectStreamSocket<CollectorSocket>(pListenSocket->GetLocalAddress(),
+                                                                                  &error) :
+                               nullptr;
+
+  // far more than the buffers on either side hold, so both wrap many times and writes wait for room
+  static const size_t PAYLOAD_SIZE = 256 * 1024;
+  PODArray<byte> payload;
+  payload.Resize(PAYLOAD_SIZE);
+  FillPattern(payload.GetBasePointer(), PAYLOAD_SIZE, 1);
+
+  bool result = (pClient != nullptr);
+  if (result)
+  {
+    if (pooledBuffers)
+      pClient->SetReceiveMode(BufferedStreamSocket::ReceiveMode_PooledBuffers);
+    if (sendRateLimit > 0)
+      pClient->SetSendRateLimit(sendRateLimit, 16384);
+
+    Timer timer;
+    size_t sent = 0;
+    result = WaitFor(pMultiplexer, workerThreads, [pClient, &payload, &sent]() {
+      if (sent < PAYLOAD_SIZE)
+        sent += pClient->Write(payload.GetBasePointer() + sent, PAYLOAD_SIZE - sent);
+
+      return (pClient->GetReceivedSize() == PAYLOAD_SIZE || pClient->IsDisconnected());
+    });
+
+    // what comes back is what went, in order
+    result = result && !pClient->IsDisconnected() && pClient->GetReceived().GetSize() == PAYLOAD_SIZE &&
+             CheckPattern(pClient->GetReceived().GetBasePointer(), PAYLOAD_SIZE, 1);
+    result = result && pListenSocket->GetConnectionsAccepted() == 1;
+
+    // past the burst, the limit holds the sender back, give or take the timer's slack
+    if (sendRateLimit > 0)
+      result = result && timer.GetTimeSeconds() >= 0.8 * (double)(PAYLOAD_SIZE - 16384) / (double)sendRateLimit;
+  }
+
+  if (pClient != nullptr)
+  {
+    pClient->Close();
+    pClient->Release();
+  }
+  if (pListenSocket != nullptr)
+  {
+    pListenSocket->Close();
+    pListenSocket->Release();
+  }
+
+  delete pMultiplexer;
+  return result;
+}
+
+static bool TestEchoBackends()
+{
+  static const SOCKET_MULTIPLEXER_TYPE types[] = {SOCKET_MULTIPLEXER_TYPE_GENERIC, SOCKET_MULTIPLEXER_TYPE_POLL,
+                                                  SOCKET_MULTIPLEXER_TYPE_EPOLL, SOCKET_MULTIPLEXER_TYPE_KQUEUE};
+
+  bool result = true;
+  for (uint32 i = 0; i < countof(types); i++)
+  {
+    if (!SocketMultiplexer::IsTypeSupported(types[i]))
+      continue;
+
+    bool typeResult = TestEcho(types[i], false, false, 0);
+    if (!typeResult)
+      Log_ErrorPrintf("FAIL: echo on multiplexer type %u", (uint32)types[i]);
+
+    result &= typeResult;
+  }
+
+  return result;
+}
+
+// Checks each message received against the one sent in its place. Accepted sockets are made by the multiplexer, so
+// what they see is kept here.
+struct MessageCheck
+{
+  static uint32 GetMessageSize(uint32 index) { return (index * 977) % 4097; }
+
+  static uint32 Received;
+  static bool Mismatched;
+};
+uint32 MessageCheck::Received;
+bool MessageCheck::Mismatched;
+
+template<MessageSocket::LengthPrefix Prefix>
+class MessageCheckSocket : public MessageSocket
+{
+public:
+  MessageCheckSocket() : MessageSocket(Prefix, 4096) {}
+
+protected:
+  virtual void OnMessage(const void* pData, size_t size) override
+  {
+    uint32 index = MessageCheck::Received++;
+    if (size != MessageCheck::GetMessageSize(index) || !CheckPattern((const byte*)pData, size, index))
+      MessageCheck::Mismatched = true;
+  }
+};
+
+template<MessageSocket::LengthPrefix Prefix>
+static bool TestMessages(bool batched)
+{
+  Error error;
+  SocketMultiplexer* pMultiplexer = SocketMultiplexer::Create(&error);
+  if (pMultiplexer == nullptr)
+    return false;
+
+  MessageCheck::Received = 0;
+  MessageCheck::Mismatched = false;
+
+  SocketAddress address;
+  ListenSocket* pListenSocket = GetLoopbackAddress(&address) ?
+                                  pMultiplexer->CreateListenSocket<MessageCheckSocket<Prefix>>(&address, &error) :
+                                  nullptr;
+  MessageSocket* pClient = (pListenSocket != nullptr) ?
+                             pMultiplexer->ConnectStreamSocket<MessageCheckSocket<Prefix>>(
+                               pListenSocket->GetLocalAddress(), &error) :
+                             nullptr;
+
+  // Sizes up to the maximum that don't divide the receive buffer, so frames keep landing across its end and are
+  // put back together, along with empty messages.
+  static const uint32 MESSAGE_COUNT = 2000;
+  static const uint32 BATCH_SIZE = 8;
+  PODArray<byte> messages[BATCH_SIZE];
+  bool result = (pClient != nullptr);
+  if (result)
+  {
+    uint32 sent = 0;
+    result = WaitFor(pMultiplexer, false, [pClient, batched, &messages, &sent]() {
+      while (sent < MESSAGE_COUNT)
+      {
+        const void* ppMessages[BATCH_SIZE];
+        size_t messageSizes[BATCH_SIZE];
+        uint32 count = batched ? Min(BATCH_SIZE, MESSAGE_COUNT - sent) : 1;
+        for (uint32 i = 0; i < count; i++)
+        {
+          messages[i].Resize(Max(MessageCheck::GetMessageSize(sent + i), 1u));
+          FillPattern(messages[i].GetBasePointer(), MessageCheck::GetMessageSize(sent + i), sent + i);
+          ppMessages[i] = messages[i].GetBasePointer();
+          messageSizes[i] = MessageCheck::GetMessageSize(sent + i);
+        }
+
+        uint32 taken = batched ? pClient->WriteMessages(ppMessages, messageSizes, count) :
+                                 (pClient->WriteMessage(ppMessages[0], messageSizes[0]) ? 1 : 0);
+        sent += taken;
+        if (taken < count)
+          break;
+      }
+
+      return (MessageCheck::Received == MESSAGE_COUNT || MessageCheck::Mismatched);
+    });
+
+    result = result && !MessageCheck::Mismatched && MessageCheck::Received == MESSAGE_COUNT;
+
+    // one over the maximum isn't sent
+    messages[0].Resize(4097);
+    result = result && !pClient->WriteMessage(messages[0].GetBasePointer(), 4097);
+  }
+
+  if (pClient != nullptr)
+  {
+    pClient->Close();
+    pClient->Release();
+  }
+  if (pListenSocket != nullptr)
+  {
+    pListenSocket->Close();
+    pListenSocket->Release();
+  }
+
+  delete pMultiplexer;
+  return result;
+}
+
+// keeps each datagram, and counts those not from where they're expected to come
+class DatagramCollectorSocket : public DatagramSocket
+{
+public:
+  DatagramCollectorSocket() : m_pExpectedFromAddress(nullptr), m_unexpectedCount(0) {}
+
+  virtual ~DatagramCollectorSocket()
+  {
+    for (uint32 i = 0; i < m_received.GetSize(); i++)
+      m_received[i]->Release();
+  }
+
+  const PODArray<SocketBuffer*>& GetReceived() const { return m_received; }
+  uint32 GetUnexpectedCount() const { return m_unexpectedCount; }
+  void SetExpectedFromAddress(const SocketAddress* pAddress) { m_pExpectedFromAddress = pAddress; }
+
+protected:
+  virtual void OnDatagram(SocketBuffer* pBuffer, const SocketAddress* pFromAddress) override
+  {
+    if (m_pExpectedFromAddress == nullptr || *pFromAddress != *m_pExpectedFromAddress)
+      m_unexpectedCount++;
+
+    pBuffer->AddRef();
+    m_received.Add(pBuffer);
+  }
+
+private:
+  PODArray<SocketBuffer*> m_received;
+  const SocketAddress* m_pExpectedFromAddress;
+  uint32 m_unexpectedCount;
+};
+
+static bool TestDatagrams()
+{
+  Error error;
+  SocketMultiplexer* pMultiplexer = SocketMultiplexer::Create(&error);
+  if (pMultiplexer == nullptr)
+    return false;
+
+  SocketAddress address;
+  DatagramCollectorSocket* pSender =
+    GetLoopbackAddress(&address) ? pMultiplexer->CreateDatagramSocket<DatagramCollectorSocket>(&address, &error) :
+                                   nullptr;
+  DatagramCollectorSocket* pReceiver =
+    (pSender != nullptr) ? pMultiplexer->CreateDatagramSocket<DatagramCollectorSocket>(&address, &error) : nullptr;
+
+  // one at a time, as a batch, and cut from one buffer by SendSegmented, the last segment shorter
+  static const uint32 SINGLE_COUNT = 10;
+  static const uint32 BATCH_COUNT = 10;
+  static const size_t SEGMENT_SIZE = 1000;
+  static const size_t SEGMENTED_SIZE = 9500;
+  byte datagrams[SINGLE_COUNT + BATCH_COUNT][200];
+  byte segmented[SEGMENTED_SIZE];
+  bool result = (pReceiver != nullptr);
+  if (result)
+  {
+    const SocketAddress* pTo = pReceiver->GetLocalAddress();
+    pReceiver->SetExpectedFromAddress(pSender->GetLocalAddress());
+    for (uint32 i = 0; i < SINGLE_COUNT; i++)
+    {
+      FillPattern(datagrams[i], 100 + i, i);
+      result = result && pSender->SendTo(pTo, datagrams[i], 100 + i);
+    }
+
+    DatagramSocket::OutgoingDatagram batch[BATCH_COUNT];
+    for (uint32 i = 0; i < BATCH_COUNT; i++)
+    {
+      uint32 index = SINGLE_COUNT + i;
+      FillPattern(datagrams[index], 100 + index, index);
+      batch[i].pAddress = pTo;
+      batch[i].pData = datagrams[index];
+      batch[i].Size = 100 + index;
+    }
+    result = result && pSender->SendBatch(batch, BATCH_COUNT) == BATCH_COUNT;
+
+    FillPattern(segmented, SEGMENTED_SIZE, 1000);
+    result = result && pSender->SendSegmented(pTo, segmented, SEGMENTED_SIZE, SEGMENT_SIZE);
+
+    // loopback doesn't drop or reorder them
+    static const uint32 SEGMENT_COUNT = (uint32)((SEGMENTED_SIZE + SEGMENT_SIZE - 1) / SEGMENT_SIZE);
+    static const uint32 TOTAL_COUNT = SINGLE_COUNT + BATCH_COUNT + SEGMENT_COUNT;
+    result = result && WaitFor(pMultiplexer, false,
+                               [pReceiver]() { return pReceiver->GetReceived().GetSize() >= TOTAL_COUNT; });
+    result = result && pReceiver->GetReceived().GetSize() == TOTAL_COUNT && pReceiver->GetUnexpectedCount() == 0;
+    for (uint32 i = 0; i < TOTAL_COUNT && result; i++)
+    {
+      const SocketBuffer* pBuffer = pReceiver->GetReceived()[i];
+      if (i < SINGLE_COUNT + BATCH_COUNT)
+      {
+        result = pBuffer->GetSize() == 100 + i && CheckPattern(pBuffer->GetData(), 100 + i, i);
+      }
+      else
+      {
+        size_t offset = (i - SINGLE_COUNT - BATCH_COUNT) * SEGMENT_SIZE;
+        size_t size = Min(SEGMENT_SIZE, SEGMENTED_SIZE - offset);
+        result = pBuffer->GetSize() == size && std::memcmp(pBuffer->GetData(), segmented + offset, size) == 0;
+      }
+    }
+
+    // nothing was sent the other way
+    result = result && pSender->GetReceived().GetSize() == 0;
+  }
+
+  if (pReceiver != nullptr)
+  {
+    pReceiver->Close();
+    pReceiver->Release();
+  }
+  if (pSender != nullptr)
+  {
+    pSender->Close();
+    pSender->Release();
+  }
+
+  delete pMultiplexer;
+  return result;
+}
+
+enum TestMethod
+{
+  TestMethod_Add,
+};
+
+// accepted sockets have their methods from the start
+class AddServerSocket : public RPCSocket
+{
+public:
+  AddServerSocket()
+  {
+    GetChannel()->RegisterMethod(TestMethod_Add, [](RPCChannel* pChannel, uint32 requestID, BinaryReader* pArguments) {
+      int32 sum = pArguments->ReadVarInt32() + pArguments->ReadVarInt32();
+      pChannel->BeginResponse(requestID)->WriteVarInt32(sum);
+      pChannel->EndMessage();
+    });
+  }
+};
+
+static bool TestRPCSocket()
+{
+  Error error;
+  SocketMultiplexer* pMultiplexer = SocketMultiplexer::Create(&error);
+  if (pMultiplexer == nullptr)
+    return false;
+
+  SocketAddress address;
+  ListenSocket* pListenSocket =
+    GetLoopbackAddress(&address) ? pMultiplexer->CreateListenSocket<AddServerSocket>(&address, &error) : nullptr;
+  RPCSocket* pClient = (pListenSocket != nullptr) ?
+                         pMultiplexer->ConnectStreamSocket<RPCSocket>(pListenSocket->GetLocalAddress(), &error) :
+                         nullptr;
+
+  // enough calls outstanding at once that they're batched, and some wait for room in the send buffer
+  static const uint32 CALL_COUNT = 5000;
+  uint32 answered = 0;
+  uint32 wrong = 0;
+  bool result = (pClient != nullptr);
+  if (result)
+  {
+    for (uint32 i = 0; i < CALL_COUNT; i++)
+    {
+      BinaryWriter* pArguments = pClient->GetChannel()->BeginCall(
+        TestMethod_Add, [i, &answered, &wrong](BinaryReader* pResults, const Error*) {
+          answered++;
+          if (pResults == nullptr || pResults->ReadVarInt32() != (int32)i * 3 - 7)
+            wrong++;
+        });
+      pArguments->WriteVarInt32((int32)i * 3);
+      pArguments->WriteVarInt32(-7);
+      pClient->GetChannel()->EndMessage();
+    }
+
+    result = WaitFor(pMultiplexer, false, [&answered]() { return answered == CALL_COUNT; });
+    result = result && wrong == 0 && pClient->GetChannel()->GetOutstandingCallCount() == 0;
+  }
+
+  if (pClient != nullptr)
+  {
+    pClient->Close();
+    pClient->Release();
+  }
+  if (pListenSocket != nullptr)
+  {
+    pListenSocket->Close();
+    pListenSocket->Release();
+  }
+
+  delete pMultiplexer;
+  return result;
+}
+
+static bool TestAddresses()
+{
+  // parsed, printed, and parsed again from what was printed, comes out the same
+  SocketAddress ipv4, ipv6, mapped;
+  bool result = SocketAddress::Parse(SocketAddress::Type_IPv4, "192.168.1.20", 8080, &ipv4) &&
+                ipv4.GetType() == SocketAddress::Type_IPv4 && ipv4.ToString() == "192.168.1.20:8080";
+  result = result && SocketAddress::Parse(SocketAddress::Type_IPv6, "fe80::1", 443, &ipv6) &&
+           ipv6.GetType() == SocketAddress::Type_IPv6 && ipv6.ToString() == "[fe80::1]:443";
+  result = result && SocketAddress::Parse(SocketAddress::Type_IPv6, "::ffff:10.0.0.1", 1, &mapped) &&
+           mapped.ToString() == "[::ffff:10.0.0.1]:1";
+
+  SocketAddress reparsed;
+  result = result && SocketAddress::Parse(SocketAddress::Type_IPv4, "192.168.1.20", 8080, &reparsed) &&
+           reparsed == ipv4 && HashTrait<SocketAddress>::GetHash(reparsed) == HashTrait<SocketAddress>::GetHash(ipv4);
+
+  // through the raw sockaddr and back, and copies
+  SocketAddress fromSockaddr;
+  fromSockaddr.SetFromSockaddr(ipv6.GetData(), ipv6.GetLength());
+  SocketAddress copy(ipv4);
+  SocketAddress assigned;
+  assigned = ipv6;
+  result = result && fromSockaddr == ipv6 && copy == ipv4 && assigned == ipv6 && ipv4 != ipv6;
+
+  // the port is part of the address
+  copy.SetPort(8081);
+  result = result && copy != ipv4 && copy.ToString() == "192.168.1.20:8081";
+
+  // numeric hosts resolve without a lookup, to what they parse to
+  SocketAddress resolved, loopback;
+  result = result && SocketAddress::Resolve("127.0.0.1", 99, &resolved) &&
+           SocketAddress::Parse(SocketAddress::Type_IPv4, "127.0.0.1", 99, &loopback) && resolved == loopback;
+
+  // malformed text, or text of the other family, doesn't parse
+  SocketAddress bad;
+  result = result && !SocketAddress::Parse(SocketAddress::Type_IPv4, "256.0.0.1", 1, &bad) &&
+           !SocketAddress::Parse(SocketAddress::Type_IPv4, "1.2.3", 1, &bad) &&
+           !SocketAddress::Parse(SocketAddress::Type_IPv4, "::1", 1, &bad) &&
+           !SocketAddress::Parse(SocketAddress::Type_IPv6, "127.0.0.1", 1, &bad) &&
+           !SocketAddress::Parse(SocketAddress::Type_IPv6, "fe80::g", 1, &bad);
+
+  SocketAddress unknown;
+  unknown.SetUnknown();
+  result = result && unknown.GetLength() == 0 && unknown.ToString() == "<unknown>";
+  return result;
+}
+
+DEFINE_TEST_SUITE(Sockets)
+{
+  bool addressResult = TestAddresses();
+  if (addressResult)
+    Log_InfoPrint("PASS: addresses");
+  else
+    Log_ErrorPrint("FAIL: addresses");
+
+  bool echoResult = TestEchoBackends();
+  if (echoResult)
+    Log_InfoPrint("PASS: echo on each multiplexer type");
+  else
+    Log_ErrorPrint("FAIL: echo on each multiplexer type");
+
+  bool variantResult = TestEcho(SocketMultiplexer::GetDefaultType(), true, false, 0) &&
+                       TestEcho(SocketMultiplexer::GetDefaultType(), false, true, 0) &&
+                       TestEcho(SocketMultiplexer::GetDefaultType(), false, false, 1024 * 1024);
+  if (variantResult)
+    Log_InfoPrint("PASS: echo on worker threads, into pooled buffers and rate limited");
+  else
+    Log_ErrorPrint("FAIL: echo on worker threads, into pooled buffers and rate limited");
+
+  bool messageResult = TestMessages<MessageSocket::LengthPrefix_VarUInt32>(false) &&
+                       TestMessages<MessageSocket::LengthPrefix_UInt32>(true);
+  if (messageResult)
+    Log_InfoPrint("PASS: message framing");
+  else
+    Log_ErrorPrint("FAIL: message framing");
+
+  bool datagramResult = TestDatagrams();
+  if (datagramResult)
+    Log_InfoPrint("PASS: datagrams");
+  else
+    Log_ErrorPrint("FAIL: datagrams");
+
+  bool rpcResult = TestRPCSocket();
+  if (rpcResult)
+    Log_InfoPrint("PASS: RPC socket");
+  else
+    Log_ErrorPrint("FAIL: RPC socket");
+
+  return addressResult && echoResult && variantResult && messageResult && datagramResult && rpcResult;
+}
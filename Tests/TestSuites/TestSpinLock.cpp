@@ -0,0 +1,85 @@
+#include "TestSuite.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Mutex.h"
+#include "YBaseLib/SpinLock.h"
+#include "YBaseLib/Thread.h"
+Log_SetChannel(TestSpinLock);
+
+static const uint32 ThreadCount = 4;
+static const uint32 Iterations = 50000;
+
+// Increments a plain counter under the lock, which only comes out right if the lock excludes the other threads.
+template<class LOCK, class GUARD>
+class CountingThread : public Thread
+{
+public:
+  CountingThread() : m_pLock(nullptr), m_pCounter(nullptr) {}
+
+  void SetCounter(LOCK* pLock, uint32* pCounter)
+  {
+    m_pLock = pLock;
+    m_pCounter = pCounter;
+  }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    for (uint32 i = 0; i < Iterations; i++)
+    {
+      GUARD guard(*m_pLock);
+      *m_pCounter = *m_pCounter + 1;
+    }
+
+    return 0;
+  }
+
+private:
+  LOCK* m_pLock;
+  uint32* m_pCounter;
+};
+
+template<class LOCK, class GUARD>
+static bool TestExclusion(const char* lockName, LOCK& lock)
+{
+  uint32 counter = 0;
+  CountingThread<LOCK, GUARD> threads[ThreadCount];
+  for (uint32 i = 0; i < ThreadCount; i++)
+  {
+    threads[i].SetCounter(&lock, &counter);
+    threads[i].Start();
+  }
+  for (uint32 i = 0; i < ThreadCount; i++)
+    threads[i].Join();
+
+  // a guard that's tried while the lock's held doesn't get it
+  bool result = (counter == ThreadCount * Iterations);
+  {
+    GUARD guard(lock);
+    GUARD otherGuard(lock, false);
+    result = result && !otherGuard.TryLock();
+    guard.Unlock();
+    result = result && otherGuard.TryLock();
+  }
+  {
+    GUARD guard(lock, false);
+    result = result && guard.TryLock();
+  }
+
+  if (result)
+    Log_InfoPrintf("PASS: %s", lockName);
+  else
+    Log_ErrorPrintf("FAIL: %s, counted %u", lockName, counter);
+  return result;
+}
+
+DEFINE_TEST_SUITE(SpinLock)
+{
+  SpinLock spinLock;
+  TicketLock ticketLock;
+  MCSLock mcsLock;
+  Mutex adaptiveMutex(1024);
+  return TestExclusion<SpinLock, ScopedLock<SpinLock>>("spin lock", spinLock) &&
+         TestExclusion<TicketLock, ScopedLock<TicketLock>>("ticket lock", ticketLock) &&
+         TestExclusion<MCSLock, MCSLockGuard>("mcs lock", mcsLock) &&
+         TestExclusion<Mutex, ScopedLock<Mutex>>("adaptive mutex", adaptiveMutex);
+}
@@ -0,0 +1,155 @@
+#include "TestSuite.h"
+#include "YBaseLib/Array.h"
+#include "YBaseLib/HashTrait.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+Log_SetChannel(TestString);
+
+static String MakeHeapString(const char* text)
+{
+  String str;
+  str.AppendString(text);
+  return str;
+}
+
+static bool TestStringMoves()
+{
+  // heap buffers change hands, the source is left empty
+  String source = MakeHeapString("a string on the heap");
+  const char* pBuffer = source.GetCharArray();
+  String moved(std::move(source));
+  if (moved.GetCharArray() != pBuffer || !source.IsEmpty() || !moved.Compare("a string on the heap"))
+    return false;
+
+  String assigned = MakeHeapString("replaced");
+  assigned = std::move(moved);
+  if (assigned.GetCharArray() != pBuffer || !moved.IsEmpty())
+    return false;
+
+  // moving to itself keeps the text
+  String& alias = assigned;
+  assigned = std::move(alias);
+  if (!assigned.Compare("a string on the heap"))
+    return false;
+
+  // stack and static buffers can't be taken, the text is copied and the source is untouched
+  SmallString stackSource("on the stack");
+  String fromStack(std::move(stackSource));
+  if (!fromStack.Compare("on the stack") || !stackSource.Compare("on the stack") ||
+      fromStack.GetCharArray() == stackSource.GetCharArray())
+  {
+    return false;
+  }
+
+  StaticString staticSource("static text");
+  String fromStatic;
+  fromStatic = std::move(staticSource);
+  if (!fromStatic.Compare("static text") || !staticSource.Compare("static text"))
+    return false;
+
+  // stack strings take heap buffers, and copy other stack strings into their own buffer
+  SmallString stackTarget(MakeHeapString("heap into stack"));
+  if (!stackTarget.Compare("heap into stack"))
+    return false;
+
+  String heapSource = MakeHeapString("taken by a stack string");
+  pBuffer = heapSource.GetCharArray();
+  SmallString stackTaker(std::move(heapSource));
+  if (stackTaker.GetCharArray() != pBuffer || !heapSource.IsEmpty())
+    return false;
+
+  TinyString stackCopy("stack to stack");
+  SmallString stackMoved(std::move(stackCopy));
+  const char* pStackBuffer = stackMoved.GetCharArray();
+  stackMoved = SmallString("another stack string");
+  if (!stackMoved.Compare("another stack string") || stackMoved.GetCharArray() != pStackBuffer)
+    return false;
+
+  // shared buffers move their reference
+  String shared = MakeHeapString("shared");
+  String copy(shared);
+  String movedCopy(std::move(copy));
+  if (movedCopy.GetCharArray() != shared.GetCharArray() || !copy.IsEmpty())
+    return false;
+  movedCopy.AppendCharacter('!');
+  if (!shared.Compare("shared") || !movedCopy.Compare("shared!"))
+    return false;
+
+  // arrays take strings without copying them
+  Array<String> strings;
+  String element = MakeHeapString("element");
+  pBuffer = element.GetCharArray();
+  strings.Add(std::move(element));
+  strings.Add(MakeHeapString("temporary"));
+  return (strings.GetSize() == 2 && strings[0].GetCharArray() == pBuffer && strings[1].Compare("temporary"));
+}
+
+// the hash a string should have, worked out from scratch
+static bool HashMatches(const String& str)
+{
+  return (str.GetHash() == Y_HashBytes(str.GetCharArray(), str.GetLength()) &&
+          HashTrait<String>::GetHash(str) == str.GetHash());
+}
+
+static bool TestCachedHash()
+{
+  // copies share the text and its hash, and a change to one leaves the others' hash alone
+  String original = MakeHeapString("textures/stone.png");
+  String copy(original);
+  if (!HashMatches(original) || !HashMatches(copy) || copy.GetHash() != original.GetHash())
+    return false;
+
+  copy.AppendCharacter('!');
+  if (!HashMatches(copy) || !HashMatches(original) || copy.GetHash() == original.GetHash())
+    return false;
+
+  // every kind of change drops the cached hash, including those that keep the buffer
+  String str = MakeHeapString("Some Channel Name");
+  String keep(str);
+  bool result = HashMatches(str);
+  str.Erase(4, 8);
+  result = result && HashMatches(str) && HashMatches(keep) && keep.Compare("Some Channel Name");
+  str.Replace('S', 's');
+  result = result && HashMatches(str) && HashMatches(keep) && keep.Compare("Some Channel Name");
+  str.ToUpper();
+  result = result && HashMatches(str);
+  str.Resize(3);
+  result = result && HashMatches(str);
+  str.PrependString("pre-");
+  result = result && HashMatches(str);
+  str.InsertString(1, "xyz");
+  result = result && HashMatches(str);
+  str.GetWriteableCharArray()[0] = 'Q';
+  str.UpdateSize();
+  result = result && HashMatches(str);
+  str.Assign(StringView(str).SubView(2, 3));
+  result = result && HashMatches(str);
+  str.Clear();
+  result = result && HashMatches(str);
+  if (!result)
+    return false;
+
+  // strings that can't be shared work it out each time
+  SmallString stackString("on the stack");
+  StaticString staticString("static text");
+  String empty;
+  return (HashMatches(stackString) && HashMatches(staticString) && HashMatches(empty) &&
+          stackString.GetHash() == MakeHeapString("on the stack").GetHash());
+}
+
+DEFINE_TEST_SUITE(String)
+{
+  if (!TestStringMoves())
+  {
+    Log_ErrorPrint("String move test failed");
+    return false;
+  }
+
+  if (!TestCachedHash())
+  {
+    Log_ErrorPrint("String cached hash test failed");
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,132 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/StringBuilder.h"
+#include "YBaseLib/Timer.h"
+#include <cstring>
+Log_SetChannel(TestStringBuilder);
+
+// takes at most Limit bytes in total, like a socket whose send buffer fills up
+struct LimitedVectorWriter
+{
+  static const size_t Limit = 100000;
+
+  String Received;
+
+  size_t WriteVector(const void** ppBuffers, const size_t* pBufferLengths, size_t numBuffers)
+  {
+    size_t written = 0;
+    for (size_t i = 0; i < numBuffers; i++)
+    {
+      size_t length = Min(pBufferLengths[i], Limit - Received.GetLength());
+      Received.AppendString(static_cast<const char*>(ppBuffers[i]), uint32(length));
+      written += length;
+    }
+    return written;
+  }
+};
+
+static void BuildText(StringBuilder& builder, String& expected, uint32 count)
+{
+  for (uint32 i = 0; i < count; i++)
+  {
+    builder.AppendFormat("<item id=\"{}\" value=\"{:.2f}\">", i, i * 0.25);
+    expected.AppendFormat("<item id=\"{}\" value=\"{:.2f}\">", i, i * 0.25);
+    builder.AppendString("text");
+    expected.AppendString("text");
+    builder.AppendFormattedString("%05u", i);
+    expected.AppendFormattedString("%05u", i);
+    builder.AppendCharacter('\n');
+    expected.AppendCharacter('\n');
+  }
+
+  // longer than any chunk
+  String large;
+  for (uint32 i = 0; i < StringBuilder::MaxChunkSize + 1000; i++)
+    large.AppendCharacter(char('a' + i % 26));
+  builder.AppendString(large);
+  expected.AppendString(large);
+}
+
+static bool CheckContents(const StringBuilder& builder, const String& expected)
+{
+  String copied;
+  builder.CopyTo(copied);
+  if (builder.GetLength() != expected.GetLength() || !copied.Compare(expected))
+  {
+    Log_ErrorPrintf("CopyTo gave %u characters, expected %u", copied.GetLength(), expected.GetLength());
+    return false;
+  }
+
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  bool streamMatches = builder.WriteToStream(pStream) && pStream->GetSize() == expected.GetLength() &&
+                       std::memcmp(pStream->GetMemoryPointer(), expected.GetCharArray(), expected.GetLength()) == 0;
+  pStream->Release();
+  if (!streamMatches)
+  {
+    Log_ErrorPrint("WriteToStream output does not match");
+    return false;
+  }
+
+  return true;
+}
+
+DEFINE_TEST_SUITE(StringBuilder)
+{
+  StringBuilder builder(64);
+  String expected;
+  BuildText(builder, expected, 5000);
+  if (!CheckContents(builder, expected))
+    return false;
+
+  Log_DevPrintf("%u characters in %u chunks", uint32(builder.GetLength()), builder.GetChunkCount());
+
+  // vectored writes go out in batches, and stop where the writer does
+  LimitedVectorWriter writer;
+  uint64 written = builder.WriteVector(&writer);
+  if (written != LimitedVectorWriter::Limit || !writer.Received.Compare(expected.SubString(0, int32(written))))
+  {
+    Log_ErrorPrintf("WriteVector wrote %u bytes, expected %u", uint32(written), uint32(LimitedVectorWriter::Limit));
+    return false;
+  }
+
+  // cleared builders reuse their chunks
+  uint32 chunkCount = builder.GetChunkCount();
+  builder.Clear();
+  expected.Clear();
+  if (!builder.IsEmpty() || builder.GetChunkCount() != 0 || !CheckContents(builder, expected))
+    return false;
+  BuildText(builder, expected, 5000);
+  if (builder.GetChunkCount() != chunkCount || !CheckContents(builder, expected))
+    return false;
+
+  // chunks from an arena
+  MemoryArena arena;
+  {
+    StringBuilder arenaBuilder(arena);
+    String arenaExpected;
+    BuildText(arenaBuilder, arenaExpected, 100);
+    if (!CheckContents(arenaBuilder, arenaExpected) || arena.GetBytesUsed() < arenaBuilder.GetLength())
+      return false;
+  }
+
+  // assembling a few megabytes one piece at a time
+  static const uint32 PieceCount = 200000;
+  static const char piece[] = "<element attribute=\"value\">some text</element>\n";
+  Timer timer;
+  String appended;
+  for (uint32 i = 0; i < PieceCount; i++)
+    appended.AppendString(piece, sizeof(piece) - 1);
+  double stringTime = timer.GetTimeMilliseconds();
+
+  timer.Reset();
+  StringBuilder built;
+  for (uint32 i = 0; i < PieceCount; i++)
+    built.AppendString(piece, sizeof(piece) - 1);
+  double builderTime = timer.GetTimeMilliseconds();
+
+  Log_InfoPrintf("%u bytes: String::AppendString %.2fms, StringBuilder %.2fms in %u chunks", appended.GetLength(),
+                 stringTime, builderTime, built.GetChunkCount());
+  return (built.GetLength() == appended.GetLength());
+}
@@ -0,0 +1,746 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/NumberConversion.h"
+#include "YBaseLib/Sockets/SocketAddress.h"
+#include "YBaseLib/StringConverter.h"
+#include "YBaseLib/StringParser.h"
+#include "YBaseLib/TextWriter.h"
+#include "YBaseLib/Timer.h"
+#include "YBaseLib/Timestamp.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+Log_SetChannel(TestStringConverter);
+
+static uint64 NextRandom(uint64* pState)
+{
+  uint64 x = *pState;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *pState = x;
+  return x;
+}
+
+struct FormatTestPoint
+{
+  int32 x;
+  int32 y;
+};
+
+namespace TypedFormat {
+template<>
+struct Formatter<FormatTestPoint>
+{
+  static void Format(String& destination, const FormatTestPoint& value, const StringView& spec)
+  {
+    destination.AppendFormat("({}, {})", value.x, value.y);
+    if (!spec.IsEmpty())
+      destination.AppendFormat(" [{}]", spec);
+  }
+};
+} // namespace TypedFormat
+
+enum FormatTestEnum
+{
+  FORMAT_TEST_ENUM_SEVEN = 7
+};
+
+// the checks run at compile time
+Y_CHECK_FORMAT("no placeholders");
+Y_CHECK_FORMAT("{} {} {{}}", 1, 2);
+Y_CHECK_FORMAT("{1} {0} {1:>8}", 1, "two");
+static_assert(!TypedFormat::IsFormatValid("{} {}", 1), "missing argument");
+static_assert(!TypedFormat::IsFormatValid("{}", 2), "unused argument");
+static_assert(!TypedFormat::IsFormatValid("{2}", 2), "index out of range");
+static_assert(!TypedFormat::IsFormatValid("{:x", 1), "unterminated placeholder");
+static_assert(!TypedFormat::IsFormatValid("}", 0), "lone closing brace");
+
+static bool CheckFormatted(const String& result, const char* expected)
+{
+  if (result != expected)
+  {
+    Log_ErrorPrintf("FAIL: formatted '%s' (expecting '%s')", result.GetCharArray(), expected);
+    return false;
+  }
+
+  return true;
+}
+
+static bool TestTypedFormat()
+{
+  SmallString str;
+  str.AssignFormat("{} + {} = {}, {{{}}}", 1, 2u, int64(3), "braces");
+  if (!CheckFormatted(str, "1 + 2 = 3, {braces}"))
+    return false;
+
+  String heapString("heap");
+  StackString<16> stackString("stack");
+  str.AssignFormat("{}/{}/{}/{}/{}/{}", heapString, stackString, StringView("viewed", 4), 'c', true, int8(-5));
+  if (!CheckFormatted(str, "heap/stack/view/c/true/-5"))
+    return false;
+
+  str.AssignFormat("{1}{0}{1}", "a", "b");
+  if (!CheckFormatted(str, "bab"))
+    return false;
+
+  // integer specs
+  str.AssignFormat("{:x} {:X} {:#x} {:b} {:#o} {:08x} {:+d} {:5} {:<5}| {:^6}| {:*>4} {:05}", 255u, 255u, 255u, 5u, 8u,
+                   0xBEEFu, 3, 42, 42, 42, 7, -42);
+  if (!CheckFormatted(str, "ff FF 0xff 101 010 0000beef +3    42 42   |   42  | ***7 -0042"))
+    return false;
+
+  str.AssignFormat("{} {} {:x} {:d} {:c} {}", int64(-9223372036854775807LL - 1), uint64(18446744073709551615ULL),
+                   uint64(18446744073709551615ULL), 'A', 66, FORMAT_TEST_ENUM_SEVEN);
+  if (!CheckFormatted(str, "-9223372036854775808 18446744073709551615 ffffffffffffffff 65 B 7"))
+    return false;
+
+  // floating point, shortest round-trip unless a precision is given
+  str.AssignFormat("{} {} {:.2f} {:.3e} {:8.1f}| {:+} {:08.3f} {}", 0.1, 0.1f, 3.14159, 1234.5, -2.25, 1.5, -1.5,
+                   1e300 * 1e300);
+  if (!CheckFormatted(str, "0.1 0.1 3.14 1.234e+03     -2.2| +1.5 -001.500 inf"))
+    return false;
+
+  // strings can be cut off and padded
+  const char* nullString = nullptr;
+  str.AssignFormat("{:.3}|{:>6}|{:-^7}|{}", "truncated", "right", "mid", nullString);
+  if (!CheckFormatted(str, "tru| right|--mid--|(null)"))
+    return false;
+
+  // custom types and pointers
+  FormatTestPoint point = {3, -4};
+  str.AssignFormat("{} {:spec} {} {}", point, point, (const void*)0x1234, nullptr);
+  if (!CheckFormatted(str, "(3, -4) (3, -4) [spec] 0x1234 0x0"))
+    return false;
+
+  SocketAddress address;
+  if (!SocketAddress::Parse(SocketAddress::Type_IPv4, "127.0.0.1", 8080, &address))
+  {
+    Log_ErrorPrintf("FAIL: socket address parse");
+    return false;
+  }
+  str.AssignFormat("<{}>", address);
+  if (!CheckFormatted(str, "<127.0.0.1:8080>") || !CheckFormatted(address.ToString(), "127.0.0.1:8080"))
+    return false;
+
+  Timestamp timestamp = Timestamp::FromUnixTimestamp(86400 * 365);
+  str.AssignFormat("{:%Y}|{}", timestamp, timestamp);
+  SmallString expectedTime;
+  timestamp.ToString(expectedTime, "%Y|%Y-%m-%d %H:%M:%S");
+  if (!CheckFormatted(str, expectedTime))
+    return false;
+
+  // formats only known at run time write bad placeholders out as they are
+  String runtimeFormat("{} {5} {");
+  str.AssignFormat(runtimeFormat, 1);
+  if (!CheckFormatted(str, "1 {5} {"))
+    return false;
+
+  // appends grow the string past its stack buffer, and long output isn't cut off
+  TinyString grown;
+  for (uint32 i = 0; i < 200; i++)
+    grown.AppendFormat("{},", i % 10);
+  if (grown.GetLength() != 400 || !grown.StartsWith("0,1,2,3") || !grown.EndsWith("8,9,"))
+  {
+    Log_ErrorPrintf("FAIL: appended format length %u", grown.GetLength());
+    return false;
+  }
+
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  {
+    TextWriter writer(pStream);
+    writer.WriteFormat("{}={:.1f};", "pi", 3.14159);
+    writer.WriteFormatLine("{}", grown);
+  }
+  bool streamMatches =
+    (pStream->GetSize() == 7 + 401 && std::memcmp(pStream->GetMemoryPointer(), "pi=3.1;0,1,2", 12) == 0);
+  pStream->Release();
+  if (!streamMatches)
+  {
+    Log_ErrorPrintf("FAIL: text writer format");
+    return false;
+  }
+
+  Log_InfoFmt("PASS: typed format ({} {})", "checked", FORMAT_TEST_ENUM_SEVEN);
+  return true;
+}
+
+static bool TestIntegerFormatting()
+{
+  struct TestCase
+  {
+    int64 value;
+    const char* expected;
+  };
+  static const TestCase testCases[] = {
+    {0, "0"},
+    {7, "7"},
+    {-7, "-7"},
+    {10, "10"},
+    {99, "99"},
+    {100, "100"},
+    {-1000, "-1000"},
+    {123456789, "123456789"},
+    {2147483647, "2147483647"},
+    {-2147483647 - 1, "-2147483648"},
+    {4294967296LL, "4294967296"},
+    {9223372036854775807LL, "9223372036854775807"},
+    {-9223372036854775807LL - 1, "-9223372036854775808"},
+  };
+
+  char buffer[NumberConversion::MaxIntegerLength + 1];
+  for (uint32 i = 0; i < countof(testCases); i++)
+  {
+    buffer[NumberConversion::FormatInt64(buffer, testCases[i].value)] = '\0';
+    if (Y_strcmp(buffer, testCases[i].expected) != 0)
+    {
+      Log_ErrorPrintf("FAIL: int64 formatted as '%s' (expecting '%s')", buffer, testCases[i].expected);
+      return false;
+    }
+  }
+
+  buffer[NumberConversion::FormatUInt64(buffer, 18446744073709551615ULL)] = '\0';
+  if (Y_strcmp(buffer, "18446744073709551615") != 0)
+  {
+    Log_ErrorPrintf("FAIL: uint64 max formatted as '%s'", buffer);
+    return false;
+  }
+
+  // every digit count both ways through the 32-bit and 64-bit paths
+  uint64 state = 0x9E3779B97F4A7C15ULL;
+  for (uint32 i = 0; i < 100000; i++)
+  {
+    uint64 value = NextRandom(&state) >> (i % 64);
+    char expected[32];
+    std::snprintf(expected, sizeof(expected), "%llu", (unsigned long long)value);
+    buffer[NumberConversion::FormatUInt64(buffer, value)] = '\0';
+
+    uint64 parsed;
+    uint32 parsedLength = NumberConversion::ParseUInt64(buffer, &parsed);
+    if (Y_strcmp(buffer, expected) != 0 || parsedLength != Y_strlen(buffer) || parsed != value)
+    {
+      Log_ErrorPrintf("FAIL: uint64 %s formatted as '%s'", expected, buffer);
+      return false;
+    }
+
+    int32 value32 = int32(uint32(value));
+    std::snprintf(expected, sizeof(expected), "%d", value32);
+    buffer[NumberConversion::FormatInt32(buffer, value32)] = '\0';
+    if (Y_strcmp(buffer, expected) != 0)
+    {
+      Log_ErrorPrintf("FAIL: int32 %s formatted as '%s'", expected, buffer);
+      return false;
+    }
+  }
+
+  Log_InfoPrintf("PASS: integer formatting");
+  return true;
+}
+
+static bool TestIntegerParsing()
+{
+  int32 value32;
+  int64 value64;
+  uint32 uvalue32;
+  uint64 uvalue64;
+  if (NumberConversion::ParseInt32("  -1234xyz", &value32) != 7 || value32 != -1234 ||
+      NumberConversion::ParseInt32("+0x7fFF", &value32) != 7 || value32 != 0x7FFF ||
+      NumberConversion::ParseInt32("0x", &value32) != 1 || value32 != 0 ||
+      NumberConversion::ParseInt32("abc", &value32) != 0 || value32 != 0 ||
+      NumberConversion::ParseInt32(StringView("12345", 3), &value32) != 3 || value32 != 123)
+  {
+    Log_ErrorPrintf("FAIL: int32 parsing");
+    return false;
+  }
+
+  // out of range saturates, unsigned negates unless the magnitude is out of range too
+  if (NumberConversion::ParseInt32("99999999999", &value32) != 11 || value32 != 2147483647 ||
+      NumberConversion::ParseInt32("-2147483648", &value32) != 11 || value32 != -2147483647 - 1 ||
+      NumberConversion::ParseInt32("-2147483649", &value32) != 11 || value32 != -2147483647 - 1 ||
+      NumberConversion::ParseInt64("-9223372036854775808", &value64) != 20 || value64 != -9223372036854775807LL - 1 ||
+      NumberConversion::ParseInt64("9223372036854775808", &value64) != 19 || value64 != 9223372036854775807LL ||
+      NumberConversion::ParseUInt32("4294967296", &uvalue32) != 10 || uvalue32 != 0xFFFFFFFFu ||
+      NumberConversion::ParseUInt32("-1", &uvalue32) != 2 || uvalue32 != 0xFFFFFFFFu ||
+      NumberConversion::ParseUInt32("-4294967295", &uvalue32) != 11 || uvalue32 != 1 ||
+      NumberConversion::ParseUInt32("-99999999999", &uvalue32) != 12 || uvalue32 != 0xFFFFFFFFu ||
+      NumberConversion::ParseUInt64("-99999999999999999999", &uvalue64) != 21 || uvalue64 != 0xFFFFFFFFFFFFFFFFULL ||
+      StringConverter::StringToUInt32("-99999999999") != 0xFFFFFFFFu ||
+      StringConverter::StringToUInt64("-99999999999999999999") != 0xFFFFFFFFFFFFFFFFULL)
+  {
+    Log_ErrorPrintf("FAIL: integer overflow");
+    return false;
+  }
+
+  if (StringConverter::StringToInt16("-300") != -300 || StringConverter::StringToUInt8("0xff") != 0xFF ||
+      StringConverter::StringToInt64("  -9000000000") != -9000000000LL || StringConverter::StringToByte("12") != 12)
+  {
+    Log_ErrorPrintf("FAIL: string converter integers");
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: integer parsing");
+  return true;
+}
+
+static bool CheckDoubleRoundTrip(double value)
+{
+  char buffer[NumberConversion::MaxFloatLength + 1];
+  uint32 length = NumberConversion::FormatDouble(buffer, value);
+  buffer[length] = '\0';
+
+  double parsed;
+  uint32 parsedLength = NumberConversion::ParseDouble(buffer, &parsed);
+  double runtimeParsed = std::strtod(buffer, NULL);
+  if (length > NumberConversion::MaxFloatLength || parsedLength != length ||
+      std::memcmp(&parsed, &value, sizeof(value)) != 0 || std::memcmp(&runtimeParsed, &value, sizeof(value)) != 0)
+  {
+    Log_ErrorPrintf("FAIL: double %.17g written as '%s', read back as %.17g", value, buffer, parsed);
+    return false;
+  }
+
+  return true;
+}
+
+static bool CheckFloatRoundTrip(float value)
+{
+  char buffer[NumberConversion::MaxFloatLength + 1];
+  uint32 length = NumberConversion::FormatFloat(buffer, value);
+  buffer[length] = '\0';
+
+  float parsed;
+  uint32 parsedLength = NumberConversion::ParseFloat(buffer, &parsed);
+  float runtimeParsed = std::strtof(buffer, NULL);
+  if (length > NumberConversion::MaxFloatLength || parsedLength != length ||
+      std::memcmp(&parsed, &value, sizeof(value)) != 0 || std::memcmp(&runtimeParsed, &value, sizeof(value)) != 0)
+  {
+    Log_ErrorPrintf("FAIL: float %.9g written as '%s', read back as %.9g", value, buffer, parsed);
+    return false;
+  }
+
+  return true;
+}
+
+static bool TestFloatFormatting()
+{
+  struct TestCase
+  {
+    double value;
+    const char* expected;
+  };
+  static const TestCase testCases[] = {
+    {0.0, "0"},
+    {-0.0, "-0"},
+    {1.0, "1"},
+    {-2.5, "-2.5"},
+    {0.1, "0.1"},
+    {123.25, "123.25"},
+    {0.001, "0.001"},
+    {1e-7, "1e-7"},
+    {1.5e30, "1.5e+30"},
+    {1e20, "100000000000000000000"},
+    {1e21, "1e+21"},
+    {0.000001, "0.000001"},
+    {5e-324, "5e-324"},
+    {1.7976931348623157e308, "1.7976931348623157e+308"},
+    {2.2250738585072014e-308, "2.2250738585072014e-308"},
+    {0.30000000000000004, "0.30000000000000004"},
+  };
+
+  char buffer[NumberConversion::MaxFloatLength + 1];
+  for (uint32 i = 0; i < countof(testCases); i++)
+  {
+    buffer[NumberConversion::FormatDouble(buffer, testCases[i].value)] = '\0';
+    if (Y_strcmp(buffer, testCases[i].expected) != 0 || !CheckDoubleRoundTrip(testCases[i].value))
+    {
+      Log_ErrorPrintf("FAIL: double formatted as '%s' (expecting '%s')", buffer, testCases[i].expected);
+      return false;
+    }
+  }
+
+  buffer[NumberConversion::FormatFloat(buffer, 0.1f)] = '\0';
+  if (Y_strcmp(buffer, "0.1") != 0 || StringConverter::FloatToString(3.0e38f) != "3e+38" ||
+      StringConverter::DoubleToString(-1.0 / 3.0) != "-0.3333333333333333")
+  {
+    Log_ErrorPrintf("FAIL: float formatted as '%s'", buffer);
+    return false;
+  }
+
+  // random bit patterns cover denormals and every exponent, skipping infinities and nans
+  uint64 state = 0x2545F4914F6CDD1DULL;
+  for (uint32 i = 0; i < 200000; i++)
+  {
+    uint64 bits = NextRandom(&state);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    if (((bits >> 52) & 0x7FF) != 0x7FF && !CheckDoubleRoundTrip(value))
+      return false;
+
+    uint32 floatBits = uint32(bits >> 32);
+    float floatValue;
+    std::memcpy(&floatValue, &floatBits, sizeof(floatValue));
+    if (((floatBits >> 23) & 0xFF) != 0xFF && !CheckFloatRoundTrip(floatValue))
+      return false;
+  }
+
+  // short decimals, which take the parser's fast path
+  for (uint32 i = 0; i < 100000; i++)
+  {
+    uint64 random = NextRandom(&state);
+    double value = double(random % 100000000) / double(uint64(1) << (random >> 60));
+    float floatValue = float(random % 1000000) / 1000.0f;
+    if (!CheckDoubleRoundTrip(value) || !CheckFloatRoundTrip(floatValue))
+      return false;
+  }
+
+  Log_InfoPrintf("PASS: float formatting round trips");
+  return true;
+}
+
+static bool TestFloatParsing()
+{
+  const double infinity = std::numeric_limits<double>::infinity();
+  double value;
+  float floatValue;
+  if (NumberConversion::ParseDouble("  1.25e2,", &value) != 8 || value != 125.0 ||
+      NumberConversion::ParseDouble("-.5", &value) != 3 || value != -0.5 ||
+      NumberConversion::ParseDouble("7.e", &value) != 2 || value != 7.0 ||
+      NumberConversion::ParseDouble("3e+", &value) != 1 || value != 3.0 ||
+      NumberConversion::ParseDouble(".", &value) != 0 || value != 0.0 ||
+      NumberConversion::ParseDouble(StringView("2.75", 3), &value) != 3 || value != 2.7 ||
+      NumberConversion::ParseDouble("0e999", &value) != 5 || value != 0.0 ||
+      NumberConversion::ParseDouble("1e400", &value) != 5 || value != infinity ||
+      NumberConversion::ParseDouble("-inf", &value) != 4 || value != -infinity ||
+      NumberConversion::ParseDouble("nan", &value) != 3 || value == value ||
+      NumberConversion::ParseDouble("0x1p4", &value) != 5 || value != 16.0 ||
+      NumberConversion::ParseDouble("12345678901234567890123", &value) != 23 || value != 12345678901234567890123.0 ||
+      NumberConversion::ParseFloat("3.4028235e38", &floatValue) != 12 || floatValue != 3.4028235e38f ||
+      NumberConversion::ParseFloat("1e-45", &floatValue) != 5 || floatValue != 1e-45f)
+  {
+    Log_ErrorPrintf("FAIL: double parsing");
+    return false;
+  }
+
+  // digits past the 128 byte stack copy
+  String longNumber("0.");
+  for (uint32 i = 0; i < 300; i++)
+    longNumber.AppendCharacter('3');
+  if (NumberConversion::ParseDouble(longNumber, &value) != longNumber.GetLength() || value != 1.0 / 3.0 ||
+      StringConverter::StringToDouble("  -4.5") != -4.5 || StringConverter::StringToFloat("0.1") != 0.1f)
+  {
+    Log_ErrorPrintf("FAIL: long double parsing");
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: float parsing");
+  return true;
+}
+
+// the vector blocks have to agree with the scalar loops in CString, wherever the text stops being hex
+static bool TestHexConversion()
+{
+  byte bytes[200];
+  uint64 state = 0x6A09E667F3BCC908ULL;
+  for (uint32 i = 0; i < countof(bytes); i++)
+    bytes[i] = byte(NextRandom(&state));
+
+  char expected[countof(bytes) * 2 + 1];
+  byte decoded[countof(bytes)];
+  byte expectedDecoded[countof(bytes)];
+  for (uint32 length = 0; length <= countof(bytes); length++)
+  {
+    Y_makehexstring(bytes, length, expected, sizeof(expected));
+    String hex(StringConverter::BytesToHexString(bytes, length));
+    if (!hex.Compare(expected) || StringConverter::HexStringToBytes(decoded, length, hex) != length ||
+        std::memcmp(decoded, bytes, length) != 0)
+    {
+      Log_ErrorPrintf("FAIL: hex round trip of %u bytes, '%s'", length, hex.GetCharArray());
+      return false;
+    }
+  }
+
+  // upper case, a bad character anywhere, an odd digit at the end and a destination too small
+  String hex(StringConverter::BytesToHexString(bytes, countof(bytes)));
+  hex.ToUpper();
+  for (uint32 i = 0; i < 120; i++)
+  {
+    uint32 badPosition = uint32(NextRandom(&state) % (hex.GetLength() + 1));
+    uint32 textLength = uint32(NextRandom(&state) % (hex.GetLength() + 1));
+    uint32 destinationSize = uint32(NextRandom(&state) % (countof(bytes) + 1));
+    String text(hex);
+    if (badPosition < text.GetLength())
+      text[badPosition] = "g/:@`G \xff"[i % 8];
+
+    uint32 expectedLength = Y_parsehexstring(text, textLength, expectedDecoded, destinationSize, true, NULL);
+    uint32 decodedLength = StringConverter::HexStringToBytes(decoded, destinationSize, StringView(text, textLength));
+    if (decodedLength != expectedLength || std::memcmp(decoded, expectedDecoded, decodedLength) != 0)
+    {
+      Log_ErrorPrintf("FAIL: hex decode of %u characters with a bad one at %u into %u bytes, %u (expecting %u)",
+                      textLength, badPosition, destinationSize, decodedLength, expectedLength);
+      return false;
+    }
+  }
+
+  Log_InfoPrintf("PASS: hex conversion");
+  return true;
+}
+
+static bool TestArrayConversion()
+{
+  static const int32 integers[] = {0, -1, 42, 2147483647, -2147483647 - 1, 100000};
+  static const float floats[] = {0.5f, -3e30f, 0.1f, 1.0f};
+  String text;
+  StringConverter::Int32ArrayToString(text, integers, countof(integers));
+  if (text != "0 -1 42 2147483647 -2147483648 100000")
+  {
+    Log_ErrorPrintf("FAIL: int32 array formatted as '%s'", text.GetCharArray());
+    return false;
+  }
+
+  int32 parsedIntegers[countof(integers) + 1];
+  if (StringConverter::StringToInt32Array(parsedIntegers, countof(parsedIntegers), text) != countof(integers) ||
+      std::memcmp(parsedIntegers, integers, sizeof(integers)) != 0)
+  {
+    Log_ErrorPrintf("FAIL: int32 array read back");
+    return false;
+  }
+
+  // replaces what was there, and stops at a field that isn't a number or when the destination is full
+  StringConverter::FloatArrayToString(text, floats, countof(floats), ", ");
+  float parsedFloats[countof(floats)];
+  if (text != "0.5, -3e+30, 0.1, 1" ||
+      StringConverter::StringToFloatArray(parsedFloats, countof(parsedFloats), text) != countof(floats) ||
+      std::memcmp(parsedFloats, floats, sizeof(floats)) != 0 ||
+      StringConverter::StringToFloatArray(parsedFloats, 2, text) != 2 ||
+      StringConverter::StringToFloatArray(parsedFloats, countof(parsedFloats), " 1.5,,\t2 3x 4") != 2 ||
+      parsedFloats[1] != 2.0f || StringConverter::StringToInt32Array(parsedIntegers, 4, "") != 0)
+  {
+    Log_ErrorPrintf("FAIL: float array '%s'", text.GetCharArray());
+    return false;
+  }
+
+  StringConverter::Int32ArrayToString(text, integers, 0);
+  if (!text.IsEmpty())
+  {
+    Log_ErrorPrintf("FAIL: empty int32 array formatted as '%s'", text.GetCharArray());
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: array conversion");
+  return true;
+}
+
+// no pass/fail on speed, this is for comparing against printf and strtod on a given machine
+static void BenchmarkConversions()
+{
+  static const uint32 Count = 200000;
+  double* values = new double[Count];
+  uint64 state = 0x853C49E6748FEA9BULL;
+  for (uint32 i = 0; i < Count; i++)
+    values[i] = double(int64(NextRandom(&state))) * 1e-10;
+
+  char buffer[64];
+  uint64 checksum = 0;
+  Timer timer;
+  for (uint32 i = 0; i < Count; i++)
+    checksum += uint32(std::snprintf(buffer, sizeof(buffer), "%.17g", values[i]));
+  double printfTime = timer.GetTimeNanoseconds() / Count;
+
+  timer.Reset();
+  for (uint32 i = 0; i < Count; i++)
+    checksum += NumberConversion::FormatDouble(buffer, values[i]);
+  double formatTime = timer.GetTimeNanoseconds() / Count;
+
+  timer.Reset();
+  for (uint32 i = 0; i < Count; i++)
+    checksum += uint32(std::snprintf(buffer, sizeof(buffer), "%d", int32(values[i])));
+  double printfIntTime = timer.GetTimeNanoseconds() / Count;
+
+  timer.Reset();
+  for (uint32 i = 0; i < Count; i++)
+    checksum += NumberConversion::FormatInt32(buffer, int32(values[i]));
+  double formatIntTime = timer.GetTimeNanoseconds() / Count;
+
+  static const char* parseInputs[] = {"3.14159", "-0.0625", "12345.678", "1e-5", "42"};
+  double sum = 0.0;
+  timer.Reset();
+  for (uint32 i = 0; i < Count; i++)
+    sum += std::strtod(parseInputs[i % countof(parseInputs)], NULL);
+  double strtodTime = timer.GetTimeNanoseconds() / Count;
+
+  timer.Reset();
+  for (uint32 i = 0; i < Count; i++)
+  {
+    double value;
+    NumberConversion::ParseDouble(parseInputs[i % countof(parseInputs)], &value);
+    sum += value;
+  }
+  double parseTime = timer.GetTimeNanoseconds() / Count;
+
+  SmallString message;
+  timer.Reset();
+  for (uint32 i = 0; i < Count; i++)
+  {
+    message.Format("%s %d of %u: %.17g", "item", int32(i), Count, values[i]);
+    checksum += message.GetLength();
+  }
+  double formattedStringTime = timer.GetTimeNanoseconds() / Count;
+
+  timer.Reset();
+  for (uint32 i = 0; i < Count; i++)
+  {
+    message.AssignFormat("{} {} of {}: {}", "item", int32(i), Count, values[i]);
+    checksum += message.GetLength();
+  }
+  double typedFormatTime = timer.GetTimeNanoseconds() / Count;
+
+  static const uint32 HexLength = 4096;
+  byte* hexBytes = new byte[HexLength];
+  char* hexBuffer = new char[HexLength * 2 + 1];
+  std::memcpy(hexBytes, values, HexLength);
+  String hexString;
+  timer.Reset();
+  for (uint32 i = 0; i < 100; i++)
+    checksum += Y_makehexstring(hexBytes, HexLength, hexBuffer, HexLength * 2 + 1);
+  double scalarHexTime = timer.GetTimeNanoseconds() / (100 * HexLength);
+
+  timer.Reset();
+  for (uint32 i = 0; i < 100; i++)
+  {
+    StringConverter::BytesToHexString(hexString, hexBytes, HexLength);
+    checksum += StringConverter::HexStringToBytes(hexBytes, HexLength, hexString);
+  }
+  double hexTime = timer.GetTimeNanoseconds() / (100 * HexLength);
+  delete[] hexBuffer;
+  delete[] hexBytes;
+
+  Log_InfoPrintf("double format: snprintf %.1fns, NumberConversion %.1fns", printfTime, formatTime);
+  Log_InfoPrintf("message format: String::Format %.1fns, AssignFormat %.1fns", formattedStringTime, typedFormatTime);
+  Log_InfoPrintf("int32 format: snprintf %.1fns, NumberConversion %.1fns", printfIntTime, formatIntTime);
+  Log_InfoPrintf("hex per byte: Y_makehexstring %.2fns, BytesToHexString and back %.2fns", scalarHexTime, hexTime);
+  Log_InfoPrintf("double parse: strtod %.1fns, NumberConversion %.1fns (checksum %u, %f)", strtodTime, parseTime,
+                 uint32(checksum), sum);
+  delete[] values;
+}
+
+// fields joined with |, to compare against the expected split in one go
+static bool CheckTokens(const char* text, const char* delimiters, uint32 flags, const char* expected)
+{
+  SmallString joined;
+  StringTokenizer tokenizer(text, delimiters, flags);
+  for (const StringView& token : tokenizer)
+  {
+    joined.AppendString(token);
+    joined.AppendCharacter('|');
+  }
+
+  if (!joined.Compare(expected))
+  {
+    Log_ErrorPrintf("split of '%s' gave '%s', expected '%s'", text, joined.GetCharArray(), expected);
+    return false;
+  }
+
+  return true;
+}
+
+static bool TestTokenizer()
+{
+  static const uint32 Trim = StringTokenizer::FLAG_TRIM_WHITESPACE;
+  static const uint32 Skip = StringTokenizer::FLAG_SKIP_EMPTY;
+  static const uint32 Quoted = StringTokenizer::FLAG_QUOTED_FIELDS;
+  if (!CheckTokens("", ",", 0, "") || !CheckTokens("a", ",", 0, "a|") || !CheckTokens("a,,b,", ",", 0, "a||b||") ||
+      !CheckTokens(",", ",", 0, "||") || !CheckTokens("a,,b,", ",", Skip, "a|b|") ||
+      !CheckTokens("a;b,c", ",;", 0, "a|b|c|") || !CheckTokens(" a , b\t,\tc ", ",", Trim, "a|b|c|") ||
+      !CheckTokens(" a , b ", ",", 0, " a | b |") || !CheckTokens("1 2  3", " ", Trim | Skip, "1|2|3|") ||
+      !CheckTokens("a\t\tb", "\t", Trim, "a||b|") ||
+      !CheckTokens("\"a,b\",c", ",", Quoted, "a,b|c|") ||
+      !CheckTokens(" \" x \" ,y", ",", Quoted | Trim, " x |y|") ||
+      !CheckTokens("\"say \"\"hi\"\"\",z", ",", Quoted, "say \"\"hi\"\"|z|") ||
+      !CheckTokens("\"\",,x", ",", Quoted | Skip, "|x|") || !CheckTokens("\"open,end", ",", Quoted, "open,end|") ||
+      !CheckTokens("\"a\"junk,b", ",", Quoted, "a|b|") || !CheckTokens("\"a\",b", ",", 0, "\"a\"|b|"))
+  {
+    return false;
+  }
+
+  StringTokenizer tokenizer("key=\"quoted \"\"value\"\"\"", "=", StringTokenizer::FLAG_QUOTED_FIELDS);
+  StringView key, value;
+  if (!tokenizer.Next(&key) || tokenizer.WasQuoted() || !tokenizer.Next(&value) || !tokenizer.WasQuoted() ||
+      tokenizer.Next(&value) || !tokenizer.IsAtEnd())
+  {
+    return false;
+  }
+
+  SmallString unescaped;
+  StringTokenizer::UnescapeQuotes(value, unescaped);
+  if (!unescaped.Compare("quoted \"value\"") || key != StringView("key"))
+  {
+    Log_ErrorPrintf("unescaped '%s'", unescaped.GetCharArray());
+    return false;
+  }
+
+  // tokens point into the original text
+  const char* text = "first,second";
+  StringTokenizer pointerTokenizer(text);
+  StringView token;
+  return (pointerTokenizer.Next(&token) && token.GetData() == text && pointerTokenizer.GetRemaining() == "second");
+}
+
+static bool TestArrayParsing()
+{
+  PODArray<int32> integers;
+  if (!StringParser::ParseInt32Array("1, -2,3 , 0x10,,  42", &integers) || integers.GetSize() != 5 ||
+      integers[0] != 1 || integers[1] != -2 || integers[2] != 3 || integers[3] != 16 || integers[4] != 42)
+  {
+    Log_ErrorPrint("ParseInt32Array failed");
+    return false;
+  }
+
+  // stops at the first bad field, keeping what came before
+  PODArray<uint32> unsignedValues;
+  if (StringParser::ParseUInt32Array("7 8 nine 10", &unsignedValues, " ") || unsignedValues.GetSize() != 2 ||
+      unsignedValues[1] != 8)
+  {
+    Log_ErrorPrint("ParseUInt32Array accepted a bad field");
+    return false;
+  }
+
+  PODArray<float> floats;
+  PODArray<double> doubles;
+  if (!StringParser::ParseFloatArray("0.5\t1.25\t-3e2", &floats) || floats.GetSize() != 3 || floats[0] != 0.5f ||
+      floats[1] != 1.25f || floats[2] != -300.0f || !StringParser::ParseDoubleArray("", &doubles) ||
+      doubles.GetSize() != 0 || StringParser::ParseDoubleArray("1.5x", &doubles) ||
+      !StringParser::ParseDoubleArray("0.1;0.2", &doubles, ";") || doubles.GetSize() != 2 || doubles[1] != 0.2)
+  {
+    Log_ErrorPrint("ParseFloatArray/ParseDoubleArray failed");
+    return false;
+  }
+
+  return true;
+}
+
+DEFINE_TEST_SUITE(StringConverter)
+{
+  if (!TestIntegerFormatting())
+    return false;
+  if (!TestIntegerParsing())
+    return false;
+  if (!TestFloatFormatting())
+    return false;
+  if (!TestFloatParsing())
+    return false;
+  if (!TestHexConversion())
+    return false;
+  if (!TestArrayConversion())
+    return false;
+  if (!TestTypedFormat())
+    return false;
+  if (!TestTokenizer())
+    return false;
+  if (!TestArrayParsing())
+    return false;
+
+  BenchmarkConversions();
+  return true;
+}
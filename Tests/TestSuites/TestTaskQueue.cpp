@@ -0,0 +1,544 @@
+#include "TestSuite.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/CallbackQueue.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/TaskGraph.h"
+#include "YBaseLib/TaskQueue.h"
+#include "YBaseLib/Timer.h"
+Log_SetChannel(TestTaskQueue);
+
+static const uint32 PRODUCER_COUNT = 4;
+static const uint32 TASKS_PER_PRODUCER = 20000;
+
+class ProducerThread : public Thread
+{
+public:
+  ProducerThread(TaskQueue* pTaskQueue, volatile uint32* pCounter) : m_pTaskQueue(pTaskQueue), m_pCounter(pCounter) {}
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    volatile uint32* pCounter = m_pCounter;
+    for (uint32 i = 0; i < TASKS_PER_PRODUCER; i++)
+    {
+      // vary the task size so entries land at different offsets each pass around the fifo
+      if ((i % 3) == 0)
+      {
+        byte padding[40] = {};
+        m_pTaskQueue->QueueLambdaTask([pCounter, padding]() { Y_AtomicIncrement(*pCounter); });
+      }
+      else
+      {
+        m_pTaskQueue->QueueLambdaTask([pCounter]() { Y_AtomicIncrement(*pCounter); });
+      }
+    }
+
+    return 0;
+  }
+
+private:
+  TaskQueue* m_pTaskQueue;
+  volatile uint32* m_pCounter;
+};
+
+static bool TestProducers(bool lockFree, bool spinningWorkers)
+{
+  Y_ATOMIC_DECL uint32 counter = 0;
+
+  // keep the queue small so producers wrap around and wait on the consumer
+  TaskQueue taskQueue;
+  if (!taskQueue.Initialize(4096, 1, lockFree))
+    return false;
+  if (spinningWorkers)
+    taskQueue.SetIdlePolicy(WorkerIdlePolicy::LowLatency());
+
+  ProducerThread* producers[PRODUCER_COUNT];
+  for (uint32 i = 0; i < PRODUCER_COUNT; i++)
+  {
+    producers[i] = new ProducerThread(&taskQueue, &counter);
+    producers[i]->Start();
+  }
+
+  for (uint32 i = 0; i < PRODUCER_COUNT; i++)
+  {
+    producers[i]->Join();
+    delete producers[i];
+  }
+
+  // blocking tasks should see everything queued before them
+  uint32 seenCount = 0;
+  taskQueue.QueueBlockingLambdaTask([&counter, &seenCount]() { seenCount = counter; });
+  WorkerIdleStats idleStats = taskQueue.GetIdleStats();
+  taskQueue.ExitWorkers();
+
+  const uint32 expected = PRODUCER_COUNT * TASKS_PER_PRODUCER;
+  if (counter != expected || seenCount != expected)
+  {
+    Log_ErrorPrintf("FAIL: %s queue executed %u tasks (blocking task saw %u), expected %u",
+                    lockFree ? "lock-free" : "locked", counter, seenCount, expected);
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: %s queue executed %u tasks (%s workers: %llu spin, %llu yield, %llu parks)",
+                 lockFree ? "lock-free" : "locked", counter, spinningWorkers ? "spinning" : "parking",
+                 idleStats.SpinWakeups, idleStats.YieldWakeups, idleStats.Parks);
+  return true;
+}
+
+static bool TestBatch(TaskQueue* pTaskQueue, const char* name)
+{
+  static const uint32 BATCH_COUNT = 100;
+  static const uint32 TASKS_PER_BATCH = 200;
+  Y_ATOMIC_DECL uint32 counter = 0;
+  pTaskQueue->SetStatsEnabled(true);
+
+  // batches are larger than the queue, so they also have to wake workers part way through
+  for (uint32 i = 0; i < BATCH_COUNT; i++)
+  {
+    TaskQueue::BatchScope batch(pTaskQueue);
+    for (uint32 j = 0; j < TASKS_PER_BATCH; j++)
+      batch.QueueLambdaTask([&counter]() { Y_AtomicIncrement(counter); });
+  }
+
+  pTaskQueue->ExitWorkers();
+
+  const uint32 expected = BATCH_COUNT * TASKS_PER_BATCH;
+  if (counter != expected)
+  {
+    Log_ErrorPrintf("FAIL: %s batches executed %u tasks, expected %u", name, counter, expected);
+    return false;
+  }
+
+  // thread pool tasks can still be recording the last task
+  SchedulerStats stats = pTaskQueue->GetStats();
+  for (uint32 i = 0; i < 1000 && stats.Totals.TasksExecuted != expected; i++)
+  {
+    Thread::Sleep(1);
+    stats = pTaskQueue->GetStats();
+  }
+
+  if (stats.Totals.TasksExecuted != expected || stats.Totals.QueueTime.GetCount() != expected)
+  {
+    Log_ErrorPrintf("FAIL: %s batch stats counted %llu tasks, expected %u", name, stats.Totals.TasksExecuted, expected);
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: %s batches (queue p99 %.3fms)", name, stats.Totals.QueueTime.GetPercentileMilliseconds(99.0));
+  return true;
+}
+
+static bool TestBatches()
+{
+  {
+    TaskQueue taskQueue;
+    if (!taskQueue.Initialize(4096, 2) || !TestBatch(&taskQueue, "locked"))
+      return false;
+  }
+
+  {
+    TaskQueue taskQueue;
+    if (!taskQueue.Initialize(4096, 2, true) || !TestBatch(&taskQueue, "lock-free"))
+      return false;
+  }
+
+  {
+    ThreadPool threadPool(4);
+    TaskQueue taskQueue;
+    if (!taskQueue.Initialize(&threadPool, 4096) || !TestBatch(&taskQueue, "thread pool"))
+      return false;
+  }
+
+  return true;
+}
+
+static bool TestDiamondGraph(TaskGraph* pGraph, const char* name)
+{
+  static const uint32 ITERATIONS = 200;
+  for (uint32 iteration = 0; iteration < ITERATIONS; iteration++)
+  {
+    // a -> (b, c) -> d, each task records the order it ran in
+    Y_ATOMIC_DECL uint32 sequence = 0;
+    uint32 order[5] = {};
+
+    TaskGraph::TaskHandle a(pGraph->CreateTask([&]() { order[0] = Y_AtomicIncrement(sequence); }));
+    TaskGraph::TaskHandle b(pGraph->CreateTask([&]() { order[1] = Y_AtomicIncrement(sequence); }, &a, 1));
+    TaskGraph::TaskHandle c(pGraph->CreateTask([&]() { order[2] = Y_AtomicIncrement(sequence); }, &a, 1));
+    TaskGraph::TaskHandle bc[2] = {b, c};
+    TaskGraph::TaskHandle d(pGraph->CreateTask([&]() { order[3] = Y_AtomicIncrement(sequence); }, bc, 2));
+
+    // submit in reverse so nothing runs before its dependencies are wired up
+    pGraph->Submit(d);
+    pGraph->Submit(c);
+    pGraph->Submit(b);
+    pGraph->Submit(a);
+    pGraph->WaitFor(d);
+
+    // continuation on an already-finished task runs straight away
+    TaskGraph::TaskHandle e(pGraph->AddContinuation(d, [&]() { order[4] = Y_AtomicIncrement(sequence); }));
+    pGraph->WaitForAll();
+
+    if (order[0] != 1 || order[1] <= order[0] || order[2] <= order[0] || order[3] <= order[1] ||
+        order[3] <= order[2] || order[4] != 5 || !e->IsFinished() || pGraph->GetOutstandingTaskCount() != 0)
+    {
+      Log_ErrorPrintf("FAIL: %s graph ran out of order (%u %u %u %u %u)", name, order[0], order[1], order[2],
+                      order[3], order[4]);
+      return false;
+    }
+  }
+
+  Log_InfoPrintf("PASS: %s graph", name);
+  return true;
+}
+
+static bool TestTaskGraph()
+{
+  // inline queue, waits execute the tasks
+  {
+    TaskQueue taskQueue;
+    if (!taskQueue.Initialize(4096, 0))
+      return false;
+
+    TaskGraph graph(&taskQueue);
+    if (!TestDiamondGraph(&graph, "inline queue"))
+      return false;
+  }
+
+  {
+    TaskQueue taskQueue;
+    if (!taskQueue.Initialize(4096, 2))
+      return false;
+
+    bool result;
+    {
+      TaskGraph graph(&taskQueue);
+      result = TestDiamondGraph(&graph, "threaded queue");
+    }
+
+    taskQueue.ExitWorkers();
+    if (!result)
+      return false;
+  }
+
+  {
+    ThreadPool threadPool(4);
+    TaskGraph graph(&threadPool);
+    if (!TestDiamondGraph(&graph, "thread pool"))
+      return false;
+  }
+
+  return true;
+}
+
+static bool TestFiberJobs(uint32 workerCount, bool lockFree)
+{
+  static const uint32 PARENT_COUNT = 16;
+  static const uint32 CHILD_COUNT = 32;
+
+  TaskQueue taskQueue;
+  if (!taskQueue.EnableFiberJobs(65536))
+  {
+    Log_InfoPrintf("SKIP: fibers not supported");
+    return true;
+  }
+
+  if (!taskQueue.Initialize(65536, workerCount, lockFree))
+    return false;
+
+  // each parent waits on its children from inside a task, with a single worker that only works if the wait
+  // suspends the parent's fiber rather than blocking the worker
+  Y_ATOMIC_DECL uint32 childCount = 0;
+  Y_ATOMIC_DECL uint32 parentCount = 0;
+  TaskQueue* pTaskQueue = &taskQueue;
+  TaskQueue::JobCounter parentCounter;
+  for (uint32 i = 0; i < PARENT_COUNT; i++)
+  {
+    taskQueue.QueueCountedLambdaTask(&parentCounter, [pTaskQueue, &childCount, &parentCount]() {
+      TaskQueue::JobCounter childCounter;
+      for (uint32 j = 0; j < CHILD_COUNT; j++)
+        pTaskQueue->QueueCountedLambdaTask(&childCounter, [&childCount]() { Y_AtomicIncrement(childCount); });
+
+      pTaskQueue->WaitForCounter(&childCounter);
+      if (childCounter.IsComplete())
+        Y_AtomicIncrement(parentCount);
+    });
+  }
+
+  taskQueue.WaitForCounter(&parentCounter);
+  taskQueue.ExitWorkers();
+
+  if (childCount != PARENT_COUNT * CHILD_COUNT || parentCount != PARENT_COUNT)
+  {
+    Log_ErrorPrintf("FAIL: fiber jobs with %u workers ran %u children and %u parents", workerCount, childCount,
+                    parentCount);
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: fiber jobs with %u workers%s", workerCount, lockFree ? " (lock-free)" : "");
+  return true;
+}
+
+static void IncrementCounter(volatile uint32* pCounter)
+{
+  Y_AtomicIncrement(*pCounter);
+}
+
+class CallbackProducerThread : public Thread
+{
+public:
+  CallbackProducerThread(CallbackQueue* pCallbackQueue, volatile uint32* pCounter)
+    : m_pCallbackQueue(pCallbackQueue), m_pCounter(pCounter)
+  {
+  }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    for (uint32 i = 0; i < TASKS_PER_PRODUCER; i++)
+    {
+      // functors, and lambdas stored in the node, in an overflow block and allocated
+      volatile uint32* pCounter = m_pCounter;
+      if ((i % 4) == 0)
+      {
+        m_pCallbackQueue->AddCallback(new FunctorFP1<volatile uint32*>(IncrementCounter, pCounter));
+      }
+      else if ((i % 4) == 1)
+      {
+        m_pCallbackQueue->AddCallback([pCounter]() { Y_AtomicIncrement(*pCounter); });
+      }
+      else if ((i % 4) == 2)
+      {
+        byte padding[CallbackQueue::InlineCallbackSize] = {};
+        m_pCallbackQueue->AddCallback([pCounter, padding]() { Y_AtomicIncrement(*pCounter); });
+      }
+      else
+      {
+        byte padding[CallbackQueue::OverflowCallbackSize] = {};
+        m_pCallbackQueue->AddCallback([pCounter, padding]() { Y_AtomicIncrement(*pCounter); });
+      }
+
+      if ((i % 256) == 0)
+        Thread::Yield();
+    }
+
+    return 0;
+  }
+
+private:
+  CallbackQueue* m_pCallbackQueue;
+  volatile uint32* m_pCounter;
+};
+
+static bool TestCallbackQueue()
+{
+  Y_ATOMIC_DECL uint32 counter = 0;
+  const uint32 expected = PRODUCER_COUNT * TASKS_PER_PRODUCER;
+
+  // this thread is the consumer, running callbacks while the producers are still adding them
+  CallbackQueue callbackQueue;
+  callbackQueue.SetStatsEnabled(true);
+
+  CallbackProducerThread* producers[PRODUCER_COUNT];
+  for (uint32 i = 0; i < PRODUCER_COUNT; i++)
+  {
+    producers[i] = new CallbackProducerThread(&callbackQueue, &counter);
+    producers[i]->Start();
+  }
+
+  while (counter != expected)
+  {
+    callbackQueue.RunCallbacks();
+    Thread::Yield();
+  }
+
+  for (uint32 i = 0; i < PRODUCER_COUNT; i++)
+  {
+    producers[i]->Join();
+    delete producers[i];
+  }
+
+  // left in the queue, the destructor has to free them
+  callbackQueue.AddCallback(new FunctorFP1<volatile uint32*>(IncrementCounter, &counter));
+  byte padding[CallbackQueue::InlineCallbackSize] = {};
+  callbackQueue.AddCallback([&counter, padding]() { Y_AtomicIncrement(counter); });
+
+  SchedulerStats stats = callbackQueue.GetStats();
+  if (counter != expected || stats.QueueDepth != 2 || stats.Totals.TasksExecuted != expected)
+  {
+    Log_ErrorPrintf("FAIL: callback queue ran %u callbacks (stats say %llu, depth %u), expected %u", counter,
+                    (unsigned long long)stats.Totals.TasksExecuted, stats.QueueDepth, expected);
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: callback queue ran %u callbacks from %u producers", counter, PRODUCER_COUNT);
+  return true;
+}
+
+static bool TestSharedStrings()
+{
+  static const uint32 TASK_COUNT = 20000;
+  Y_ATOMIC_DECL uint32 matched = 0;
+
+  TaskQueue taskQueue;
+  if (!taskQueue.Initialize(4096, 4, true))
+    return false;
+
+  // every task gets a copy sharing the buffer, and the workers copy, modify and release them concurrently
+  String shared;
+  shared.Format("shared string buffer %u", 12345u);
+  for (uint32 i = 0; i < TASK_COUNT; i++)
+  {
+    String copy(shared);
+    taskQueue.QueueLambdaTask([copy, &matched, i]() {
+      String local(copy);
+      if ((i & 1) != 0)
+        local.AppendCharacter('!');
+      if (local.StartsWith(StringView("shared string buffer 12345")) && local.GetLength() == 26 + (i & 1))
+        Y_AtomicIncrement(matched);
+    });
+  }
+
+  taskQueue.QueueBlockingLambdaTask([]() {});
+  taskQueue.ExitWorkers();
+
+  if (matched != TASK_COUNT || shared != "shared string buffer 12345")
+  {
+    Log_ErrorPrintf("FAIL: %u of %u tasks saw their shared string", matched, TASK_COUNT);
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: %u tasks shared a string buffer", TASK_COUNT);
+  return true;
+}
+
+static bool TestDelayedTasks()
+{
+  TaskQueue taskQueue;
+  if (!taskQueue.Initialize(4096, 2))
+    return false;
+
+  // queued out of order, they run in deadline order and no sooner than asked, give or take the clock's millisecond
+  static const uint32 delays[] = {60, 20, 40};
+  Y_ATOMIC_DECL uint32 runCount = 0;
+  uint32 order[countof(delays)] = {};
+  double elapsed[countof(delays)] = {};
+  Timer timer;
+  for (uint32 i = 0; i < countof(delays); i++)
+  {
+    taskQueue.QueueDelayedLambdaTask(delays[i], [&, i]() {
+      elapsed[i] = timer.GetTimeMilliseconds();
+      order[Y_AtomicIncrement(runCount) - 1] = i;
+    });
+  }
+
+  // cancelled before it's due, it never runs
+  Y_ATOMIC_DECL uint32 cancelledRuns = 0;
+  TaskQueue::TimerID cancelledTimer =
+    taskQueue.QueueDelayedLambdaTask(30, [&cancelledRuns]() { Y_AtomicIncrement(cancelledRuns); });
+  bool cancelledInTime = taskQueue.CancelTimer(cancelledTimer);
+
+  // a periodic timer keeps going until cancelled, and the id goes stale after that
+  Y_ATOMIC_DECL uint32 periodicRuns = 0;
+  TaskQueue::TimerID periodicTimer =
+    taskQueue.QueuePeriodicLambdaTask(5, [&periodicRuns]() { Y_AtomicIncrement(periodicRuns); });
+
+  // only waiting on timers, the workers sleep until a deadline rather than polling for one
+  WorkerIdleStats idleBefore = taskQueue.GetIdleStats();
+  while (Y_AtomicLoad(runCount) < countof(delays) || Y_AtomicLoad(periodicRuns) < 5)
+    Thread::Sleep(1);
+  WorkerIdleStats idleAfter = taskQueue.GetIdleStats();
+
+  bool periodicCancelled = taskQueue.CancelTimer(periodicTimer);
+  uint32 periodicRunsAtCancel = periodicRuns;
+  Thread::Sleep(30);
+
+  // one more run can finish if it was running when cancelled
+  bool result = cancelledInTime && cancelledRuns == 0 && !taskQueue.CancelTimer(cancelledTimer) &&
+                periodicCancelled && !taskQueue.CancelTimer(periodicTimer) &&
+                periodicRuns <= periodicRunsAtCancel + 1 && order[0] == 1 && order[1] == 2 && order[2] == 0;
+  for (uint32 i = 0; i < countof(delays); i++)
+    result &= elapsed[i] >= delays[i] - 1;
+
+  // a deadline wakes each worker at most once, a few more for the periodic timer and spurious wake-ups
+  uint64 parks = idleAfter.Parks - idleBefore.Parks;
+  result &= parks < 100;
+
+  // left pending, the queue drops it
+  taskQueue.QueueDelayedLambdaTask(10000, [&cancelledRuns]() { Y_AtomicIncrement(cancelledRuns); });
+  taskQueue.ExitWorkers();
+
+  if (!result)
+  {
+    Log_ErrorPrintf("FAIL: delayed tasks ran in order %u %u %u after %.1f %.1f %.1fms, %u periodic runs, %llu parks",
+                    order[0], order[1], order[2], elapsed[0], elapsed[1], elapsed[2], periodicRuns,
+                    (unsigned long long)parks);
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: delayed tasks, %u periodic runs, %llu parks", periodicRunsAtCancel, (unsigned long long)parks);
+  return true;
+}
+
+static bool TestDelayedTasksWithoutWorkers()
+{
+  // the caller runs timers as they come due, along with queued tasks
+  TaskQueue taskQueue;
+  if (!taskQueue.Initialize(4096, 0))
+    return false;
+
+  uint32 delayedRuns = 0;
+  uint32 periodicRuns = 0;
+  Timer timer;
+  taskQueue.QueueDelayedLambdaTask(10, [&delayedRuns]() { delayedRuns++; });
+  TaskQueue::TimerID periodicTimer = taskQueue.QueuePeriodicLambdaTask(2, [&periodicRuns]() { periodicRuns++; });
+
+  taskQueue.ExecuteQueuedTasks();
+  bool ranEarly = (delayedRuns != 0 && timer.GetTimeMilliseconds() < 9.0);
+  while (delayedRuns == 0 || periodicRuns < 3)
+  {
+    taskQueue.ExecuteQueuedTasks();
+    Thread::Sleep(1);
+  }
+
+  bool result = !ranEarly && delayedRuns == 1 && timer.GetTimeMilliseconds() >= 9.0 &&
+                taskQueue.CancelTimer(periodicTimer);
+  if (!result)
+  {
+    Log_ErrorPrintf("FAIL: delayed tasks without workers, %u delayed runs, %u periodic runs", delayedRuns,
+                    periodicRuns);
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: delayed tasks without workers");
+  return true;
+}
+
+DEFINE_TEST_SUITE(TaskQueue)
+{
+  if (!TestProducers(false, false))
+    return false;
+  if (!TestProducers(true, false))
+    return false;
+  if (!TestProducers(false, true))
+    return false;
+  if (!TestProducers(true, true))
+    return false;
+  if (!TestBatches())
+    return false;
+  if (!TestTaskGraph())
+    return false;
+  if (!TestFiberJobs(1, false))
+    return false;
+  if (!TestFiberJobs(4, true))
+    return false;
+  if (!TestCallbackQueue())
+    return false;
+  if (!TestSharedStrings())
+    return false;
+  if (!TestDelayedTasks())
+    return false;
+  if (!TestDelayedTasksWithoutWorkers())
+    return false;
+
+  return true;
+}
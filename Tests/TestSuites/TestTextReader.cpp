@@ -0,0 +1,159 @@
+#include "TestSuite.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/ParallelTextReader.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/TextReader.h"
+#include "YBaseLib/ThreadPool.h"
+Log_SetChannel(TestTextReader);
+
+static const char s_testFileName[] = "TestTextReader.tmp";
+
+// line i is "line <i>" padded with i % 97 dots, every third ends in \r\n, and line 1000 is longer than a buffer
+static const uint32 TestLineCount = 5000;
+static const uint32 LongLineIndex = 1000;
+
+static void GetTestLine(uint32 index, String& line)
+{
+  line.Format("line %u ", index);
+  uint32 padding = (index == LongLineIndex) ? (TextReader::DefaultBufferSize * 2 + 17) : (index % 97);
+  for (uint32 i = 0; i < padding; i++)
+    line.AppendCharacter('.');
+}
+
+static void GetTestText(String& text)
+{
+  SmallString line;
+  for (uint32 i = 0; i < TestLineCount; i++)
+  {
+    GetTestLine(i, line);
+    text.AppendString(line);
+    if (i + 1 < TestLineCount)
+      text.AppendString((i % 3 == 0) ? "\r\n" : "\n");
+  }
+}
+
+static bool WriteTestFile(const String& text)
+{
+  ByteStream* pStream =
+    FileSystem::OpenFile(s_testFileName, BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE | BYTESTREAM_OPEN_TRUNCATE);
+  if (pStream == nullptr)
+    return false;
+
+  bool result = pStream->Write2(text.GetCharArray(), text.GetLength());
+  pStream->Release();
+  return result;
+}
+
+// every line comes back through each overload, from a copied and a mapped stream
+static bool TestReadLines(uint32 openMode, const char* streamName)
+{
+  ByteStream* pStream = FileSystem::OpenFile(s_testFileName, BYTESTREAM_OPEN_READ | openMode);
+  if (pStream == nullptr)
+  {
+    Log_ErrorPrintf("FAIL: opening %s stream", streamName);
+    return false;
+  }
+
+  bool result = true;
+  String expected, line;
+  {
+    TextReader reader(pStream);
+    StringView lineView;
+    for (uint32 i = 0; result && i < TestLineCount; i++)
+    {
+      GetTestLine(i, expected);
+      if (i % 2 == 0)
+        result = reader.ReadLine(&lineView) && expected.Compare(lineView);
+      else
+        result = reader.ReadLine(&line) && expected.Compare(line);
+
+      if (!result)
+        Log_ErrorPrintf("FAIL: %s stream line %u", streamName, i);
+    }
+
+    result = result && !reader.ReadLine(&lineView) && !reader.ReadLine(&line);
+  }
+
+  // what's read ahead is given back, so a reader can stop and another carry on
+  pStream->SeekAbsolute(0);
+  {
+    TextReader reader(pStream);
+    result = result && reader.ReadLine(&line) && line.Compare("line 0 ");
+  }
+  {
+    TextReader reader(pStream);
+    char buffer[8];
+    uint32 length;
+    bool endOfLine;
+    char character;
+    result = result && reader.ReadLine(buffer, sizeof(buffer), &length, &endOfLine) && length == 7 && !endOfLine &&
+             Y_strcmp(buffer, "line 1 ") == 0;
+    result = result && reader.ReadLine(buffer, sizeof(buffer), &length, &endOfLine) && length == 1 && endOfLine &&
+             reader.ReadCharacter(&character) && character == 'l';
+  }
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrintf("PASS: %s stream lines", streamName);
+  return result;
+}
+
+// every line is seen once with its offset, across chunks far smaller than some lines
+static bool TestParallelLines(const String& text)
+{
+  ByteStream* pStream = FileSystem::OpenFile(s_testFileName, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_MAPPED);
+  if (pStream == nullptr || pStream->GetBasePointer() == nullptr)
+  {
+    Log_InfoPrint("SKIP: parallel lines, files can't be mapped");
+    if (pStream != nullptr)
+      pStream->Release();
+    return true;
+  }
+
+  ThreadPool threadPool(3);
+  Y_ATOMIC_DECL uint32 lineCount = 0;
+  Y_ATOMIC_DECL uint32 mismatchCount = 0;
+  const char* pText = text.GetCharArray();
+  bool result = ParallelForEachLine(&threadPool, pStream, [&](uint64 offset, const StringView& line) {
+    Y_AtomicIncrement(lineCount);
+    if (line.GetData() != reinterpret_cast<const char*>(pStream->GetBasePointer()) + offset ||
+        Y_strncmp(pText + offset, line.GetData(), line.GetLength()) != 0 || line.GetLength() == 0 ||
+        line.GetData()[line.GetLength() - 1] == '\r')
+    {
+      Y_AtomicIncrement(mismatchCount);
+    }
+  }, 4096);
+
+  // and a stream that isn't in memory is refused
+  pStream->Release();
+  pStream = FileSystem::OpenFile(s_testFileName, BYTESTREAM_OPEN_READ);
+  result = result && pStream != nullptr && !ParallelForEachLine(&threadPool, pStream, [](uint64, const StringView&) {});
+  if (pStream != nullptr)
+    pStream->Release();
+
+  if (!result || lineCount != TestLineCount || mismatchCount != 0)
+  {
+    Log_ErrorPrintf("FAIL: parallel lines, %u lines, %u mismatched", lineCount, mismatchCount);
+    return false;
+  }
+
+  Log_InfoPrint("PASS: parallel lines");
+  return true;
+}
+
+DEFINE_TEST_SUITE(TextReader)
+{
+  String text;
+  GetTestText(text);
+  bool result = WriteTestFile(text);
+  if (!result)
+    Log_ErrorPrint("FAIL: writing test file");
+
+  result = result && TestReadLines(0, "file") && TestReadLines(BYTESTREAM_OPEN_MAPPED, "mapped") &&
+           TestParallelLines(text);
+  FileSystem::DeleteFile(s_testFileName);
+  return result;
+}
@@ -0,0 +1,103 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/TextWriter.h"
+Log_SetChannel(TestTextWriter);
+
+#ifdef Y_PLATFORM_WINDOWS
+static const char s_newLine[] = "\r\n";
+#else
+static const char s_newLine[] = "\n";
+#endif
+
+static String GetStreamText(GrowableMemoryByteStream* pStream)
+{
+  String text;
+  text.AppendString(reinterpret_cast<const char*>(pStream->GetMemoryPointer()), (uint32)pStream->GetSize());
+  return text;
+}
+
+// small writes wait in the buffer, everything comes out in order once flushed
+static bool TestBuffering()
+{
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  String expected;
+  bool result;
+  {
+    TextWriter writer(pStream);
+    writer.Write("a=");
+    writer.WriteInt32(-42);
+    writer.Write(",b=");
+    writer.WriteUInt64(18446744073709551615ull);
+    writer.Write(",c=");
+    writer.WriteDouble(0.1);
+    writer.Write(",d=");
+    writer.WriteFloat(1.5f);
+    writer.WriteLine("");
+    result = (pStream->GetSize() == 0);
+    expected.Format("a=-42,b=18446744073709551615,c=0.1,d=1.5%s", s_newLine);
+
+    // longer than the printf versions' old stack buffer, so they used to cut it off
+    String longText;
+    for (uint32 i = 0; i < 2000; i++)
+      longText.AppendCharacter('a' + (char)(i % 26));
+    writer.WriteFormattedLine("%s|%u", longText.GetCharArray(), 7u);
+    expected.AppendFormattedString("%s|7%s", longText.GetCharArray(), s_newLine);
+
+    // bigger than the buffer, and many small pieces that fill it over and over
+    String hugeText;
+    for (uint32 i = 0; i < TextWriter::BufferSize * 3; i++)
+      hugeText.AppendCharacter('0' + (char)(i % 10));
+    writer.Write(hugeText);
+    expected.AppendString(hugeText);
+    for (uint32 i = 0; i < 10000; i++)
+    {
+      writer.WriteUInt32(i);
+      writer.WriteFormattedString(" %c ", 'x');
+      expected.AppendFormattedString("%u x ", i);
+    }
+
+    result = result && writer.Flush() && GetStreamText(pStream).Compare(expected);
+    writer.Write("tail");
+    expected.AppendString("tail");
+  }
+
+  // and the rest when it's destroyed
+  result = result && GetStreamText(pStream).Compare(expected);
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: buffering");
+  else
+    Log_ErrorPrint("FAIL: buffering");
+  return result;
+}
+
+// a stream that fills up fails the flush, and the writer drops what comes after
+static bool TestErrors()
+{
+  char memory[64];
+  MemoryByteStream* pStream = ByteStream_CreateMemoryStream(memory, sizeof(memory));
+  bool result;
+  {
+    TextWriter writer(pStream);
+    for (uint32 i = 0; i < 100; i++)
+      writer.WriteFormattedString("%u,", i);
+
+    result = !writer.Flush() && writer.InErrorState();
+    writer.Write("more");
+    result = result && !writer.Flush();
+  }
+  pStream->Release();
+
+  if (result)
+    Log_InfoPrint("PASS: errors");
+  else
+    Log_ErrorPrint("FAIL: errors");
+  return result;
+}
+
+DEFINE_TEST_SUITE(TextWriter)
+{
+  return TestBuffering() && TestErrors();
+}
@@ -0,0 +1,122 @@
+#include "TestSuite.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Thread.h"
+#include "YBaseLib/ThreadLocal.h"
+#include <thread>
+Log_SetChannel(TestThreadLocal);
+
+static Y_ATOMIC_DECL int32 s_liveValues = 0;
+
+struct CountedValue
+{
+  CountedValue() : Value(0) { Y_AtomicIncrement(s_liveValues); }
+  ~CountedValue() { Y_AtomicDecrement(s_liveValues); }
+
+  uint32 Value;
+};
+
+static ThreadLocal<CountedValue> s_staticValue;
+static ThreadLocal<CountedValue> s_recreatedValue;
+
+// a value whose destructor creates another, the way a buffer flush might log
+struct RecreatingValue
+{
+  ~RecreatingValue() { s_recreatedValue.Get().Value = 1; }
+};
+
+static ThreadLocal<RecreatingValue> s_recreatingValue;
+
+class ThreadLocalThread : public Thread
+{
+public:
+  ThreadLocalThread() : m_pValue(nullptr), m_pSeen(nullptr) {}
+  void SetValue(ThreadLocal<CountedValue>* pValue) { m_pValue = pValue; }
+  CountedValue* GetSeen() const { return m_pSeen; }
+
+protected:
+  virtual int ThreadEntryPoint() override
+  {
+    m_pSeen = &m_pValue->Get();
+    m_pSeen->Value++;
+    s_staticValue->Value++;
+    s_recreatingValue.Get();
+    return (m_pValue->Get().Value == 1) ? 0 : 1;
+  }
+
+private:
+  ThreadLocal<CountedValue>* m_pValue;
+  CountedValue* m_pSeen;
+};
+
+static bool TestThreadExit()
+{
+  static const uint32 ThreadCount = 4;
+  bool result = true;
+  {
+    ThreadLocal<CountedValue> value;
+    result = result && value.Peek() == nullptr && value->Value == 0 && value.Peek() == &value.Get();
+
+    ThreadLocalThread threads[ThreadCount];
+    for (uint32 i = 0; i < ThreadCount; i++)
+    {
+      threads[i].SetValue(&value);
+      threads[i].Start();
+    }
+    for (uint32 i = 0; i < ThreadCount; i++)
+      result = result && threads[i].Join() == 0 && threads[i].GetSeen() != &value.Get();
+
+    // the threads' values are gone, only this thread's is left
+    result = result && s_liveValues == 1 && value->Value == 0;
+
+    value.Release();
+    result = result && s_liveValues == 0 && value.Peek() == nullptr;
+    value.Get();
+
+    // threads that aren't Threads are cleaned up by the platform
+    std::thread nativeThread([&value]() { value->Value = 5; });
+    nativeThread.join();
+    result = result && s_liveValues == 1;
+  }
+
+  // destroying the ThreadLocal took this thread's value with it
+  result = result && s_liveValues == 0;
+
+  if (result)
+    Log_InfoPrintf("PASS: thread exit");
+  else
+    Log_ErrorPrintf("FAIL: thread exit, %d values live", s_liveValues);
+  return result;
+}
+
+static bool TestOwnerDestruction()
+{
+  // a value from a thread that outlives its ThreadLocal is destroyed with it
+  ThreadLocal<CountedValue>* pValue = new ThreadLocal<CountedValue>();
+  Y_ATOMIC_DECL uint32 stage = 0;
+  std::thread otherThread([pValue, &stage]() {
+    pValue->Get();
+    Y_AtomicStore(stage, uint32(1));
+    while (Y_AtomicLoad(stage) != 2)
+      Thread::Yield();
+  });
+
+  while (Y_AtomicLoad(stage) != 1)
+    Thread::Yield();
+  bool result = (s_liveValues == 1);
+  delete pValue;
+  result = result && s_liveValues == 0;
+  Y_AtomicStore(stage, uint32(2));
+  otherThread.join();
+
+  result = result && s_liveValues == 0;
+  if (result)
+    Log_InfoPrintf("PASS: owner destruction");
+  else
+    Log_ErrorPrintf("FAIL: owner destruction, %d values live", s_liveValues);
+  return result;
+}
+
+DEFINE_TEST_SUITE(ThreadLocal)
+{
+  return TestThreadExit() && TestOwnerDestruction();
+}
@@ -0,0 +1,583 @@
+#include "TestSuite.h"
+#include "YBaseLib/Atomic.h"
+#include "YBaseLib/CPUID.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/ParallelFor.h"
+#include "YBaseLib/ParallelSort.h"
+#include "YBaseLib/ThreadPool.h"
+#include "YBaseLib/Timer.h"
+Log_SetChannel(TestThreadPool);
+
+static Y_ATOMIC_DECL uint32 s_completedItems = 0;
+
+class CountingWorkItem : public ThreadPoolWorkItem
+{
+public:
+  CountingWorkItem(ThreadPool* pThreadPool, uint32 children) : m_pThreadPool(pThreadPool), m_children(children) {}
+
+protected:
+  virtual int32 ProcessWork() override
+  {
+    // queue children from the worker, these go to the local deque and can be stolen
+    for (uint32 i = 0; i < m_children; i++)
+    {
+      CountingWorkItem* pChild = new CountingWorkItem(m_pThreadPool, 0);
+      m_pThreadPool->EnqueueWorkItem(pChild);
+      pChild->Release();
+    }
+
+    Y_AtomicIncrement(s_completedItems);
+    return 0;
+  }
+
+private:
+  ThreadPool* m_pThreadPool;
+  uint32 m_children;
+};
+
+static bool WaitForCount(uint32 expected)
+{
+  for (uint32 i = 0; i < 10000; i++)
+  {
+    if (s_completedItems == expected)
+      return true;
+
+    Thread::Sleep(1);
+  }
+
+  Log_ErrorPrintf("FAIL: expected %u items, completed %u", expected, s_completedItems);
+  return false;
+}
+
+static bool TestInjectedItems(ThreadPool* pThreadPool)
+{
+  static const uint32 ITEM_COUNT = 10000;
+  s_completedItems = 0;
+
+  for (uint32 i = 0; i < ITEM_COUNT; i++)
+  {
+    CountingWorkItem* pItem = new CountingWorkItem(pThreadPool, 0);
+    pThreadPool->EnqueueWorkItem(pItem);
+    pItem->Release();
+  }
+
+  return WaitForCount(ITEM_COUNT);
+}
+
+static bool TestStolenItems(ThreadPool* pThreadPool)
+{
+  static const uint32 PARENT_COUNT = 64;
+  static const uint32 CHILD_COUNT = 500;
+  s_completedItems = 0;
+
+  for (uint32 i = 0; i < PARENT_COUNT; i++)
+  {
+    CountingWorkItem* pItem = new CountingWorkItem(pThreadPool, CHILD_COUNT);
+    pThreadPool->EnqueueWorkItem(pItem);
+    pItem->Release();
+  }
+
+  return WaitForCount(PARENT_COUNT * (CHILD_COUNT + 1));
+}
+
+static bool TestSignaledItem(ThreadPool* pThreadPool)
+{
+  ThreadPoolWorkItemSignaled* pItem = new ThreadPoolWorkItemSignaled();
+  pThreadPool->EnqueueWorkItem(pItem);
+  pItem->WaitForCompletion();
+
+  bool result = pItem->IsCompleted();
+  pItem->Release();
+  return result;
+}
+
+// Records the order items ran in, and optionally blocks the worker until released.
+class OrderedWorkItem : public ThreadPoolWorkItem
+{
+public:
+  OrderedWorkItem(ThreadPool* pThreadPool, uint32 id, uint32* pOrder, Event* pReleaseEvent = nullptr)
+    : m_pThreadPool(pThreadPool), m_id(id), m_pOrder(pOrder), m_pReleaseEvent(pReleaseEvent), m_sawHigherPriority(false)
+  {
+  }
+
+  bool SawHigherPriority() const { return m_sawHigherPriority; }
+
+protected:
+  virtual int32 ProcessWork() override
+  {
+    if (m_pReleaseEvent != nullptr)
+      m_pReleaseEvent->Wait();
+
+    m_sawHigherPriority = m_pThreadPool->ShouldYieldToOtherTask();
+    m_pOrder[Y_AtomicIncrement(s_completedItems) - 1] = m_id;
+    return 0;
+  }
+
+private:
+  ThreadPool* m_pThreadPool;
+  uint32 m_id;
+  uint32* m_pOrder;
+  Event* m_pReleaseEvent;
+  bool m_sawHigherPriority;
+};
+
+static bool TestPriorities()
+{
+  // one worker, so the order is decided purely by the scheduler
+  static const uint32 ITEMS_PER_CLASS = 8;
+  ThreadPool threadPool(1);
+  uint32 order[ITEMS_PER_CLASS * 2 + 2];
+  s_completedItems = 0;
+
+  // hold the worker while everything is queued. the blocker is background so it should see the pending work.
+  Event releaseEvent;
+  OrderedWorkItem* pBlocker = new OrderedWorkItem(&threadPool, 100, order, &releaseEvent);
+  pBlocker->SetPriority(THREADPOOL_PRIORITY_BACKGROUND);
+  threadPool.EnqueueWorkItem(pBlocker);
+  while (!pBlocker->IsStarted())
+    Thread::Yield();
+
+  for (uint32 i = 0; i < ITEMS_PER_CLASS; i++)
+  {
+    OrderedWorkItem* pItem = new OrderedWorkItem(&threadPool, i, order);
+    pItem->SetPriority(THREADPOOL_PRIORITY_BACKGROUND);
+    threadPool.EnqueueWorkItem(pItem);
+    pItem->Release();
+  }
+  for (uint32 i = 0; i < ITEMS_PER_CLASS; i++)
+  {
+    OrderedWorkItem* pItem = new OrderedWorkItem(&threadPool, ITEMS_PER_CLASS + i, order);
+    pItem->SetPriority(THREADPOOL_PRIORITY_REALTIME);
+    threadPool.EnqueueWorkItem(pItem);
+    pItem->Release();
+  }
+
+  // an overdue background item beats everything
+  OrderedWorkItem* pOverdue = new OrderedWorkItem(&threadPool, 200, order);
+  pOverdue->SetPriority(THREADPOOL_PRIORITY_BACKGROUND);
+  pOverdue->SetDeadline(0);
+  threadPool.EnqueueWorkItem(pOverdue);
+  pOverdue->Release();
+
+  releaseEvent.Signal();
+  if (!WaitForCount(ITEMS_PER_CLASS * 2 + 2))
+  {
+    pBlocker->Release();
+    return false;
+  }
+
+  bool blockerYield = pBlocker->SawHigherPriority();
+  pBlocker->Release();
+  if (!blockerYield)
+  {
+    Log_ErrorPrintf("FAIL: background item did not see pending realtime work");
+    return false;
+  }
+
+  if (order[0] != 100 || order[1] != 200)
+  {
+    Log_ErrorPrintf("FAIL: overdue item ran at position %u", (order[1] == 200) ? 1 : order[1]);
+    return false;
+  }
+
+  // realtime items first, apart from the odd background item let through by the starvation check
+  uint32 backgroundBeforeRealtime = 0;
+  uint32 realtimeRemaining = ITEMS_PER_CLASS;
+  for (uint32 i = 2; i < countof(order) && realtimeRemaining > 0; i++)
+  {
+    if (order[i] >= ITEMS_PER_CLASS)
+      realtimeRemaining--;
+    else
+      backgroundBeforeRealtime++;
+  }
+  if (backgroundBeforeRealtime > 1)
+  {
+    Log_ErrorPrintf("FAIL: %u background items ran before the realtime items", backgroundBeforeRealtime);
+    return false;
+  }
+
+  return true;
+}
+
+static bool TestIdlePolicy(ThreadPool* pThreadPool)
+{
+  // short bursts with gaps, so spinning workers pick up each burst without parking
+  static const uint32 BURST_COUNT = 50;
+  static const uint32 ITEMS_PER_BURST = 20;
+  pThreadPool->SetIdlePolicy(WorkerIdlePolicy::LowLatency());
+  s_completedItems = 0;
+
+  for (uint32 burst = 0; burst < BURST_COUNT; burst++)
+  {
+    for (uint32 i = 0; i < ITEMS_PER_BURST; i++)
+    {
+      CountingWorkItem* pItem = new CountingWorkItem(pThreadPool, 0);
+      pThreadPool->EnqueueWorkItem(pItem);
+      pItem->Release();
+    }
+
+    // busy-wait rather than sleeping, so the next burst arrives while the workers are still spinning
+    Timer timer;
+    while (s_completedItems != (burst + 1) * ITEMS_PER_BURST)
+    {
+      if (timer.GetTimeSeconds() > 10.0)
+      {
+        Log_ErrorPrintf("FAIL: burst %u did not complete", burst);
+        return false;
+      }
+    }
+  }
+
+  pThreadPool->SetIdlePolicy(WorkerIdlePolicy::Park());
+
+  WorkerIdleStats stats = pThreadPool->GetIdleStats();
+  if (stats.SpinWakeups + stats.YieldWakeups == 0)
+  {
+    Log_ErrorPrintf("FAIL: spinning workers never found work while spinning");
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: idle policy (%llu spin, %llu yield, %llu parks, %.3fms average wake)", stats.SpinWakeups,
+                 stats.YieldWakeups, stats.Parks, stats.GetAverageWakeLatencyMilliseconds());
+  return true;
+}
+
+static bool TestParallelFor(ThreadPool* pThreadPool)
+{
+  static const uint32 COUNT = 100000;
+  uint32* pValues = new uint32[COUNT];
+  Y_memzero(pValues, sizeof(uint32) * COUNT);
+
+  // every index exactly once, with a grain that doesn't divide the range
+  ParallelFor(pThreadPool, 0, COUNT, 37, [pValues](uint32 i) { pValues[i]++; });
+  for (uint32 i = 0; i < COUNT; i++)
+  {
+    if (pValues[i] != 1)
+    {
+      Log_ErrorPrintf("FAIL: ParallelFor visited index %u %u times", i, pValues[i]);
+      delete[] pValues;
+      return false;
+    }
+  }
+
+  uint64 sum = ParallelReduce(pThreadPool, 0, COUNT, 100, (uint64)0,
+                              [](uint32 rangeBegin, uint32 rangeEnd, uint64 value) {
+                                for (uint32 i = rangeBegin; i < rangeEnd; i++)
+                                  value += i;
+                                return value;
+                              },
+                              [](uint64 a, uint64 b) { return a + b; });
+
+  delete[] pValues;
+
+  const uint64 expected = (uint64)COUNT * (COUNT - 1) / 2;
+  if (sum != expected)
+  {
+    Log_ErrorPrintf("FAIL: ParallelReduce returned %llu, expected %llu", sum, expected);
+    return false;
+  }
+
+  // nested from inside a work item
+  Y_ATOMIC_DECL uint32 nestedCount = 0;
+  ParallelFor(pThreadPool, 0, 16, 1, [pThreadPool, &nestedCount](uint32) {
+    ParallelFor(pThreadPool, 0, 64, 4, [&nestedCount](uint32) { Y_AtomicIncrement(nestedCount); });
+  });
+  if (nestedCount != 16 * 64)
+  {
+    Log_ErrorPrintf("FAIL: nested ParallelFor ran %u bodies, expected %u", nestedCount, 16 * 64);
+    return false;
+  }
+
+  return true;
+}
+
+static bool TestParallelSort(ThreadPool* pThreadPool)
+{
+  // odd count, so the chunks and merge pieces don't divide evenly, and few distinct keys to stress ties
+  static const uint32 COUNT = 200003;
+  uint32* pValues = new uint32[COUNT];
+  uint32 seed = 99;
+  for (uint32 i = 0; i < COUNT; i++)
+  {
+    seed = seed * 1664525 + 1013904223;
+    pValues[i] = (i & 1) ? (seed >> 4) : (seed >> 28);
+  }
+
+  uint64 checksum = 0;
+  for (uint32 i = 0; i < COUNT; i++)
+    checksum += pValues[i];
+
+  Y_parallel_sort(pThreadPool, pValues, COUNT);
+  for (uint32 i = 0; i < COUNT; i++)
+  {
+    checksum -= pValues[i];
+    if (i > 0 && pValues[i - 1] > pValues[i])
+    {
+      Log_ErrorPrintf("FAIL: parallel sort out of order at %u", i);
+      delete[] pValues;
+      return false;
+    }
+  }
+
+  delete[] pValues;
+  if (checksum != 0)
+  {
+    Log_ErrorPrintf("FAIL: parallel sort lost elements");
+    return false;
+  }
+
+  return true;
+}
+
+static bool TestAffinity()
+{
+  Y_CPU_TOPOLOGY topology;
+  Y_ReadCPUTopology(&topology);
+
+  // cores partition the processors, and so do nodes
+  uint64 coreProcessors = 0;
+  for (uint32 i = 0; i < topology.CoreCount; i++)
+  {
+    if (topology.CoreMasks[i] == 0 || (coreProcessors & topology.CoreMasks[i]) != 0)
+    {
+      Log_ErrorPrintf("FAIL: core %u mask 0x%llx is empty or overlaps", i, topology.CoreMasks[i]);
+      return false;
+    }
+    coreProcessors |= topology.CoreMasks[i];
+  }
+
+  uint64 nodeProcessors = 0;
+  for (uint32 i = 0; i < topology.NodeCount; i++)
+    nodeProcessors |= topology.NodeMasks[i];
+
+  if (topology.CoreCount == 0 || topology.NodeCount == 0 || nodeProcessors != coreProcessors)
+  {
+    Log_ErrorPrintf("FAIL: topology has %u cores and %u nodes covering different processors", topology.CoreCount,
+                    topology.NodeCount);
+    return false;
+  }
+
+  // more workers than cores, every worker gets a single core inside its node
+  const uint32 workerCount = topology.CoreCount * 2 + 1;
+  for (uint32 i = 0; i < workerCount; i++)
+  {
+    uint64 nodeMask = ThreadPool::GetWorkerAffinityMask(THREADPOOL_AFFINITY_PER_NODE, i, workerCount);
+    uint64 coreMask = ThreadPool::GetWorkerAffinityMask(THREADPOOL_AFFINITY_PER_CORE, i, workerCount);
+    if (ThreadPool::GetWorkerAffinityMask(THREADPOOL_AFFINITY_NONE, i, workerCount) != 0 || nodeMask == 0 ||
+        coreMask == 0 || (coreMask & ~nodeMask) != 0)
+    {
+      Log_ErrorPrintf("FAIL: worker %u placed on node 0x%llx core 0x%llx", i, nodeMask, coreMask);
+      return false;
+    }
+  }
+
+  // pinned workers still run everything
+  ThreadPool threadPool(Min(topology.CoreCount, (uint32)4), THREADPOOL_AFFINITY_PER_CORE);
+  if (threadPool.GetAffinity() != THREADPOOL_AFFINITY_PER_CORE || !TestInjectedItems(&threadPool))
+    return false;
+
+  Log_InfoPrintf("PASS: affinity (%u processors, %u cores, %u nodes)", topology.LogicalProcessorCount,
+                 topology.CoreCount, topology.NodeCount);
+  return true;
+}
+
+static bool TestSchedulerStats(ThreadPool* pThreadPool)
+{
+  // bucket bounds have to cover the values mapped to them
+  static const uint64 values[] = {0, 7, 8, 9, 15, 16, 1000, 123456789, 0xFFFFFFFFFFFFFFFFULL};
+  for (uint32 i = 0; i < countof(values); i++)
+  {
+    uint32 index = LatencyHistogram::GetBucketIndex(values[i]);
+    if (index >= LatencyHistogram::BucketCount || LatencyHistogram::GetBucketUpperBound(index) < values[i] ||
+        (index > 0 && LatencyHistogram::GetBucketUpperBound(index - 1) >= values[i]))
+    {
+      Log_ErrorPrintf("FAIL: histogram bucket %u does not hold %llu", index, values[i]);
+      return false;
+    }
+  }
+
+  static const uint32 ITEM_COUNT = 1000;
+  pThreadPool->SetStatsEnabled(true);
+  SchedulerStats before = pThreadPool->GetStats();
+  s_completedItems = 0;
+
+  for (uint32 i = 0; i < ITEM_COUNT; i++)
+  {
+    CountingWorkItem* pItem = new CountingWorkItem(pThreadPool, 0);
+    pThreadPool->EnqueueWorkItem(pItem);
+    pItem->Release();
+  }
+
+  if (!WaitForCount(ITEM_COUNT))
+    return false;
+
+  // the counters are bumped after the item returns, give the last ones a moment
+  SchedulerStats stats;
+  for (uint32 i = 0; i < 1000; i++)
+  {
+    stats = pThreadPool->GetStats();
+    if (stats.Totals.TasksExecuted - before.Totals.TasksExecuted == ITEM_COUNT)
+      break;
+
+    Thread::Sleep(1);
+  }
+
+  pThreadPool->SetStatsEnabled(false);
+
+  uint64 executed = stats.Totals.TasksExecuted - before.Totals.TasksExecuted;
+  uint64 queued = stats.Totals.QueueTime.GetCount() - before.Totals.QueueTime.GetCount();
+  if (executed != ITEM_COUNT || queued != ITEM_COUNT)
+  {
+    Log_ErrorPrintf("FAIL: stats counted %llu executed, %llu queued, expected %u", executed, queued, ITEM_COUNT);
+    return false;
+  }
+
+  const LatencyHistogram& queueTime = stats.Totals.QueueTime;
+  if (queueTime.GetPercentile(50.0) > queueTime.GetPercentile(99.0) || queueTime.GetPercentile(99.0) > queueTime.GetMax())
+  {
+    Log_ErrorPrintf("FAIL: queue time percentiles out of order");
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: scheduler stats (queue p50 %.3fms, p99 %.3fms, execution p99 %.3fms, utilization %.2f)",
+                 queueTime.GetPercentileMilliseconds(50.0), queueTime.GetPercentileMilliseconds(99.0),
+                 stats.Totals.ExecutionTime.GetPercentileMilliseconds(99.0), stats.GetUtilization());
+  return true;
+}
+
+// Waits for a release while marked as blocked, as an item doing I/O would.
+class BlockingWorkItem : public ThreadPoolWorkItem
+{
+public:
+  BlockingWorkItem(Event* pReleaseEvent) : m_pReleaseEvent(pReleaseEvent) {}
+
+protected:
+  virtual int32 ProcessWork() override
+  {
+    ThreadPoolBlockingScope blockingScope;
+    m_pReleaseEvent->Wait();
+    Y_AtomicIncrement(s_completedItems);
+    return 0;
+  }
+
+private:
+  Event* m_pReleaseEvent;
+};
+
+// Busy for a while without saying so, so only a backlog makes the pool grow.
+class SlowWorkItem : public ThreadPoolWorkItem
+{
+protected:
+  virtual int32 ProcessWork() override
+  {
+    Thread::Sleep(2);
+    Y_AtomicIncrement(s_completedItems);
+    return 0;
+  }
+};
+
+static bool WaitForRunningWorkers(ThreadPool* pThreadPool, uint32 expected)
+{
+  for (uint32 i = 0; i < 5000 && pThreadPool->GetRunningWorkerThreadCount() != expected; i++)
+    Thread::Sleep(1);
+
+  return (pThreadPool->GetRunningWorkerThreadCount() == expected);
+}
+
+// A blocked worker's queued work is taken by a new one, rather than waiting for it.
+static bool TestBlockedWorkerCompensation(ThreadPool* pThreadPool)
+{
+  s_completedItems = 0;
+  Event releaseEvent;
+  BlockingWorkItem* pBlockingItem = new BlockingWorkItem(&releaseEvent);
+  pThreadPool->EnqueueWorkItem(pBlockingItem);
+  pBlockingItem->Release();
+
+  CountingWorkItem* pItem = new CountingWorkItem(pThreadPool, 0);
+  pThreadPool->EnqueueWorkItem(pItem);
+  pItem->Release();
+
+  bool result = WaitForCount(1);
+  releaseEvent.Signal();
+  return WaitForCount(2) && result;
+}
+
+static bool TestElasticPool()
+{
+  ThreadPool threadPool(1, THREADPOOL_AFFINITY_NONE, 4);
+  threadPool.SetIdleTimeout(20);
+
+  if (!TestBlockedWorkerCompensation(&threadPool))
+  {
+    Log_ErrorPrintf("FAIL: elastic pool didn't start a worker for a blocked one");
+    return false;
+  }
+
+  // extra workers retire once idle, and their slots are used again when the pool next grows
+  if (!WaitForRunningWorkers(&threadPool, 1) || !TestBlockedWorkerCompensation(&threadPool) ||
+      !WaitForRunningWorkers(&threadPool, 1))
+  {
+    Log_ErrorPrintf("FAIL: elastic pool has %u workers running after going idle",
+                    threadPool.GetRunningWorkerThreadCount());
+    return false;
+  }
+
+  // a backlog grows the pool, but never past its maximum
+  static const uint32 SLOW_ITEM_COUNT = 200;
+  s_completedItems = 0;
+  for (uint32 i = 0; i < SLOW_ITEM_COUNT; i++)
+  {
+    SlowWorkItem* pItem = new SlowWorkItem();
+    threadPool.EnqueueWorkItem(pItem);
+    pItem->Release();
+  }
+
+  uint32 peakWorkers = 0;
+  while (s_completedItems != SLOW_ITEM_COUNT)
+  {
+    peakWorkers = Max(peakWorkers, threadPool.GetRunningWorkerThreadCount());
+    Thread::Sleep(1);
+  }
+
+  // stealing covers the workers added since
+  if (peakWorkers < 2 || peakWorkers > 4 || !TestInjectedItems(&threadPool) || !TestStolenItems(&threadPool))
+  {
+    Log_ErrorPrintf("FAIL: elastic pool peaked at %u workers for a backlog", peakWorkers);
+    return false;
+  }
+
+  // a fixed size pool can't compensate, but the hint is harmless
+  ThreadPool fixedPool(2);
+  if (fixedPool.IsElastic() || !TestBlockedWorkerCompensation(&fixedPool))
+    return false;
+
+  Log_InfoPrintf("PASS: elastic pool, peak of %u workers", peakWorkers);
+  return true;
+}
+
+DEFINE_TEST_SUITE(ThreadPool)
+{
+  ThreadPool threadPool(4);
+  if (!TestInjectedItems(&threadPool))
+    return false;
+  if (!TestStolenItems(&threadPool))
+    return false;
+  if (!TestSignaledItem(&threadPool))
+    return false;
+  if (!TestParallelFor(&threadPool))
+    return false;
+  if (!TestParallelSort(&threadPool))
+    return false;
+  if (!TestIdlePolicy(&threadPool))
+    return false;
+  if (!TestSchedulerStats(&threadPool))
+    return false;
+  if (!TestPriorities())
+    return false;
+  if (!TestAffinity())
+    return false;
+  if (!TestElasticPool())
+    return false;
+
+  return true;
+}
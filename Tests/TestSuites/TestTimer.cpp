@@ -0,0 +1,41 @@
+#include "TestSuite.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Thread.h"
+#include "YBaseLib/Timer.h"
+Log_SetChannel(TestTimer);
+
+// the fast timer agrees with the system timer over an interval, and doesn't run backwards
+DEFINE_TEST_SUITE(Timer)
+{
+  Timer timer;
+  Y_TIMER_VALUE startValue = Y_FastTimerGetValue();
+  Thread::Sleep(50);
+  Y_TIMER_VALUE endValue = Y_FastTimerGetValue();
+  double systemMilliseconds = timer.GetTimeMilliseconds();
+  double fastMilliseconds = Y_FastTimerConvertToMilliseconds(endValue - startValue);
+
+  Y_TIMER_VALUE lastValue = Y_FastTimerGetValue();
+  for (uint32 i = 0; i < 100000; i++)
+  {
+    Y_TIMER_VALUE value = Y_FastTimerGetValue();
+    if (value < lastValue)
+    {
+      Log_ErrorPrint("FAIL: fast timer ran backwards");
+      return false;
+    }
+    lastValue = value;
+  }
+
+  Log_DevPrintf("fast timer %s: %.3fms, system timer %.3fms",
+                Y_FastTimerUsesCPUCounter() ? "uses the cpu counter" : "falls back", fastMilliseconds,
+                systemMilliseconds);
+  if (fastMilliseconds < systemMilliseconds * 0.9 || fastMilliseconds > systemMilliseconds * 1.1)
+  {
+    Log_ErrorPrintf("FAIL: fast timer measured %.3fms, the system timer %.3fms", fastMilliseconds,
+                    systemMilliseconds);
+    return false;
+  }
+
+  Log_InfoPrint("PASS: fast timer");
+  return true;
+}
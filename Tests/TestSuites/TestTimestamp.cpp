@@ -0,0 +1,64 @@
+#include "TestSuite.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/Timestamp.h"
+Log_SetChannel(TestTimestamp);
+
+// the formatter's cached prefix matches strftime, moving between seconds, for each fraction length
+static bool TestFormatter()
+{
+  static const char format[] = "%Y-%m-%d %H:%M:%S";
+  for (uint32 digits = 0; digits <= TimestampFormatter::MaxFractionDigits; digits++)
+  {
+    TimestampFormatter formatter(format, digits);
+    Timestamp first = Timestamp::Now();
+    for (uint32 i = 0; i < 1000; i++)
+    {
+      // with a second later and back again every so often
+      Timestamp timestamp = Timestamp::Now();
+      if ((i % 100) == 50)
+        timestamp = Timestamp::FromUnixTimestamp(first.AsUnixTimestamp() + 1 + i);
+
+      String expected(timestamp.ToString(format));
+      if (digits > 0)
+      {
+        uint32 fraction = timestamp.GetSubSecondMicroseconds();
+        for (uint32 j = digits; j < TimestampFormatter::MaxFractionDigits; j++)
+          fraction /= 10;
+        expected.AppendFormattedString(".%0*u", digits, fraction);
+      }
+
+      uint32 length;
+      const char* text = formatter.Format(timestamp, &length);
+      if (!expected.Compare(text) || length != expected.GetLength())
+      {
+        Log_ErrorPrintf("FAIL: formatter wrote '%s', not '%s'", text, expected.GetCharArray());
+        return false;
+      }
+    }
+  }
+
+  Log_InfoPrint("PASS: formatter");
+  return true;
+}
+
+// the coarse clock is only behind by ticks
+static bool TestCoarseClock()
+{
+  Timestamp coarse = Timestamp::NowCoarse();
+  Timestamp precise = Timestamp::Now();
+  double difference = precise.DifferenceInSeconds(coarse);
+  if (difference < -0.1 || difference > 0.1)
+  {
+    Log_ErrorPrintf("FAIL: coarse clock is %.6f seconds from the precise clock", difference);
+    return false;
+  }
+
+  Log_InfoPrint("PASS: coarse clock");
+  return true;
+}
+
+DEFINE_TEST_SUITE(Timestamp)
+{
+  return TestFormatter() && TestCoarseClock();
+}
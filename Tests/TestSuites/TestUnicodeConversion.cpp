@@ -0,0 +1,234 @@
+#include "TestSuite.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/Timer.h"
+#include "YBaseLib/UnicodeConversion.h"
+#include <cstring>
+Log_SetChannel(TestUnicodeConversion);
+
+using namespace UnicodeConversion;
+
+// one code point of each encoded length, "aé€😀" in UTF-8, UTF-16 and UTF-32
+static const char s_mixedUTF8[] = "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80";
+static const char16_t s_mixedUTF16[] = {0x61, 0xE9, 0x20AC, 0xD83D, 0xDE00};
+static const char32_t s_mixedUTF32[] = {0x61, 0xE9, 0x20AC, 0x1F600};
+
+static bool TestRoundTrips()
+{
+  const uint32 utf8Length = sizeof(s_mixedUTF8) - 1;
+  char16_t utf16[16];
+  char32_t utf32[16];
+  char utf8[16];
+  if (GetUTF16Length(s_mixedUTF8, utf8Length) != countof(s_mixedUTF16) ||
+      GetUTF32Length(s_mixedUTF8, utf8Length) != countof(s_mixedUTF32) ||
+      GetUTF8Length(s_mixedUTF16, countof(s_mixedUTF16)) != utf8Length ||
+      GetUTF8Length(s_mixedUTF32, countof(s_mixedUTF32)) != utf8Length)
+  {
+    Log_ErrorPrint("FAIL: converted lengths");
+    return false;
+  }
+
+  if (UTF8ToUTF16(utf16, countof(utf16), s_mixedUTF8, utf8Length) != countof(s_mixedUTF16) ||
+      std::memcmp(utf16, s_mixedUTF16, sizeof(s_mixedUTF16)) != 0 ||
+      UTF8ToUTF32(utf32, countof(utf32), s_mixedUTF8, utf8Length) != countof(s_mixedUTF32) ||
+      std::memcmp(utf32, s_mixedUTF32, sizeof(s_mixedUTF32)) != 0 ||
+      UTF16ToUTF8(utf8, countof(utf8), s_mixedUTF16, countof(s_mixedUTF16)) != utf8Length ||
+      std::memcmp(utf8, s_mixedUTF8, utf8Length) != 0 ||
+      UTF32ToUTF8(utf8, countof(utf8), s_mixedUTF32, countof(s_mixedUTF32)) != utf8Length ||
+      std::memcmp(utf8, s_mixedUTF8, utf8Length) != 0)
+  {
+    Log_ErrorPrint("FAIL: mixed round trips");
+    return false;
+  }
+
+  // destinations exactly the right size work, one less doesn't
+  if (UTF8ToUTF16(utf16, countof(s_mixedUTF16), s_mixedUTF8, utf8Length) != countof(s_mixedUTF16) ||
+      UTF8ToUTF16(utf16, countof(s_mixedUTF16) - 1, s_mixedUTF8, utf8Length) != InvalidLength ||
+      UTF16ToUTF8(utf8, utf8Length - 1, s_mixedUTF16, countof(s_mixedUTF16)) != InvalidLength ||
+      UTF8ToUTF16(utf16, 0, "a", 1) != InvalidLength || UTF8ToUTF16(utf16, 0, "", 0) != 0)
+  {
+    Log_ErrorPrint("FAIL: destination sizes");
+    return false;
+  }
+
+  // a non-ASCII character at every position of a long ASCII run, through the vector loops and their tails
+  SmallString text;
+  char16_t wide[80];
+  char32_t wider[80];
+  for (uint32 position = 0; position <= 64; position++)
+  {
+    text.Clear();
+    for (uint32 i = 0; i < 64; i++)
+    {
+      if (i == position)
+        text.AppendString("\xE2\x82\xAC");
+      text.AppendCharacter(char('0' + i % 64));
+    }
+
+    uint32 wideLength = UTF8ToUTF16(wide, countof(wide), text, text.GetLength());
+    uint32 widerLength = UTF8ToUTF32(wider, countof(wider), text, text.GetLength());
+    SmallString back, back32;
+    if (wideLength != (position < 64 ? 65u : 64u) || widerLength != wideLength ||
+        (position < 64 && (wide[position] != 0x20AC || wider[position] != 0x20AC)) ||
+        !AppendUTF16(back, wide, wideLength) || !AppendUTF32(back32, wider, widerLength) || back != text ||
+        back32 != text)
+    {
+      Log_ErrorPrintf("FAIL: round trip with a non-ASCII character at %u", position);
+      return false;
+    }
+  }
+
+  // appending adds to what's there
+  SmallString appended("path: ");
+  if (!AppendUTF16(appended, s_mixedUTF16, countof(s_mixedUTF16)) || !appended.StartsWith("path: ") ||
+      appended.GetLength() != 6 + sizeof(s_mixedUTF8) - 1 || !appended.EndsWith(s_mixedUTF8))
+  {
+    Log_ErrorPrint("FAIL: append");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: round trips");
+  return true;
+}
+
+static bool TestInvalidInput()
+{
+  static const struct
+  {
+    const char* Text;
+    uint32 ErrorOffset;
+  } invalidUTF8[] = {
+    {"ab\x80", 2},               // lone continuation byte
+    {"\xC0\xAF", 0},             // overlong '/'
+    {"\xC1\xBF", 0},             // overlong 0x7F
+    {"\xE0\x80\xAF", 0},         // overlong three-byte form
+    {"\xF0\x80\x80\xAF", 0},     // overlong four-byte form
+    {"x\xED\xA0\x80", 1},        // encoded surrogate
+    {"\xF4\x90\x80\x80", 0},     // past U+10FFFF
+    {"\xF5\x80\x80\x80", 0},     // lead byte that's never valid
+    {"\xC3", 0},                 // truncated
+    {"abc\xE2\x82", 3},          // truncated three-byte form
+    {"\xE2\x28\xA1", 0},         // bad continuation
+    {"0123456789abcdef\xFF", 16} // after a full vector of ASCII
+  };
+
+  for (uint32 i = 0; i < countof(invalidUTF8); i++)
+  {
+    const char* pText = invalidUTF8[i].Text;
+    uint32 length = Y_strlen(pText);
+    uint32 errorOffset = 0xFFFF;
+    char16_t utf16[32];
+    if (ValidateUTF8(pText, length, &errorOffset) || errorOffset != invalidUTF8[i].ErrorOffset ||
+        GetUTF16Length(pText, length) != InvalidLength || GetUTF32Length(pText, length) != InvalidLength ||
+        UTF8ToUTF16(utf16, countof(utf16), pText, length) != InvalidLength)
+    {
+      Log_ErrorPrintf("FAIL: invalid UTF-8 %u accepted, or error at %u", i, errorOffset);
+      return false;
+    }
+  }
+
+  // the largest code point and the ones just outside the surrogates are fine
+  static const char validEdges[] = "\xF4\x8F\xBF\xBF\xED\x9F\xBF\xEE\x80\x80\xEF\xBF\xBF\x7F";
+  if (!ValidateUTF8(validEdges, sizeof(validEdges) - 1))
+  {
+    Log_ErrorPrint("FAIL: valid edge cases rejected");
+    return false;
+  }
+
+  // unpaired surrogates, high one at the end, low one alone, high one followed by a non-surrogate
+  static const char16_t highAtEnd[] = {'a', 0xD83D};
+  static const char16_t lowAlone[] = {'a', 'b', 0xDE00, 'c'};
+  static const char16_t highThenLetter[] = {0xD83D, 'x'};
+  uint32 errorOffset = 0;
+  char utf8[16];
+  String unchanged("unchanged");
+  if (ValidateUTF16(highAtEnd, countof(highAtEnd), &errorOffset) || errorOffset != 1 ||
+      ValidateUTF16(lowAlone, countof(lowAlone), &errorOffset) || errorOffset != 2 ||
+      ValidateUTF16(highThenLetter, countof(highThenLetter), &errorOffset) || errorOffset != 0 ||
+      GetUTF8Length(lowAlone, countof(lowAlone)) != InvalidLength ||
+      UTF16ToUTF8(utf8, countof(utf8), highAtEnd, countof(highAtEnd)) != InvalidLength ||
+      AppendUTF16(unchanged, lowAlone, countof(lowAlone)) || unchanged != "unchanged")
+  {
+    Log_ErrorPrint("FAIL: unpaired surrogates accepted");
+    return false;
+  }
+
+  static const char32_t badUTF32[] = {'a', 0xD800, 0x110000};
+  if (ValidateUTF32(badUTF32, 2, &errorOffset) || errorOffset != 1 || ValidateUTF32(badUTF32 + 2, 1) ||
+      !ValidateUTF32(s_mixedUTF32, countof(s_mixedUTF32)) || GetUTF8Length(badUTF32, 3) != InvalidLength)
+  {
+    Log_ErrorPrint("FAIL: invalid UTF-32 accepted");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: invalid input");
+  return true;
+}
+
+static bool TestStackString()
+{
+  // short paths stay in the object, long ones go to the heap
+  UTF16StackString<8> shortPath("a\xC3\xA9");
+  if (!shortPath.IsValid() || shortPath.GetLength() != 2 || shortPath.GetCharArray()[1] != 0xE9 ||
+      shortPath.GetCharArray()[2] != 0)
+  {
+    Log_ErrorPrint("FAIL: short stack string");
+    return false;
+  }
+
+  // more bytes than fit, but few enough code units
+  UTF16StackString<8> multiByte("\xE2\x82\xAC\xE2\x82\xAC\xE2\x82\xAC\xE2\x82\xAC");
+  if (!multiByte.IsValid() || multiByte.GetLength() != 4 || multiByte.GetCharArray()[3] != 0x20AC)
+  {
+    Log_ErrorPrint("FAIL: multi-byte stack string");
+    return false;
+  }
+
+  SmallString longText;
+  for (uint32 i = 0; i < 100; i++)
+    longText.AppendString("dir\xC3\xA9/");
+  UTF16StackString<16> longPath(longText);
+  if (!longPath.IsValid() || longPath.GetLength() != 500 || longPath.GetCharArray()[499] != '/' ||
+      longPath.GetCharArray()[500] != 0)
+  {
+    Log_ErrorPrint("FAIL: long stack string");
+    return false;
+  }
+
+  UTF16StackString<16> invalid("bad\xFF");
+  UTF16StackString<4> invalidLong("longer than four\xFF");
+  if (invalid.IsValid() || invalid.GetLength() != 0 || invalid.GetCharArray()[0] != 0 || invalidLong.IsValid() ||
+      invalidLong.GetCharArray()[0] != 0)
+  {
+    Log_ErrorPrint("FAIL: invalid stack string");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: stack strings");
+  return true;
+}
+
+DEFINE_TEST_SUITE(UnicodeConversion)
+{
+  if (!TestRoundTrips() || !TestInvalidInput() || !TestStackString())
+    return false;
+
+  // a megabyte of mostly ASCII text
+  String text;
+  while (text.GetLength() < 1024 * 1024)
+    text.AppendString("C:\\Projects\\Engine\\Data\\Textures\\Caf\xC3\xA9\\Rock_Diffuse.dds;");
+
+  char16_t* pWide = new char16_t[text.GetLength()];
+  Timer timer;
+  uint32 wideLength = UTF8ToUTF16(pWide, text.GetLength(), text, text.GetLength());
+  double toWideTime = timer.GetTimeMilliseconds();
+
+  timer.Reset();
+  String back;
+  bool appended = AppendUTF16(back, pWide, wideLength);
+  double fromWideTime = timer.GetTimeMilliseconds();
+  delete[] pWide;
+
+  Log_InfoPrintf("%u bytes: to UTF-16 %.2fms, back to UTF-8 %.2fms", text.GetLength(), toWideTime, fromWideTime);
+  return (appended && back == text);
+}
@@ -0,0 +1,123 @@
+#include "TestSuite.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/Platform.h"
+#include "YBaseLib/VirtualArray.h"
+Log_SetChannel(TestVirtualArray);
+
+static bool TestPlatformMemory()
+{
+  size_t pageSize = Platform::GetVirtualMemoryPageSize();
+  size_t size = pageSize * 64;
+  byte* pMemory = static_cast<byte*>(Platform::ReserveVirtualMemory(size, 0));
+  bool result = pMemory != nullptr && Platform::CommitVirtualMemory(pMemory + pageSize, pageSize * 2);
+  if (result)
+  {
+    // committed pages read as zero, and again after being decommitted and committed
+    pMemory[pageSize] = 1;
+    pMemory[pageSize * 3 - 1] = 2;
+    result = pMemory[pageSize + 1] == 0 && pMemory[pageSize * 3 - 1] == 2;
+
+    Platform::DecommitVirtualMemory(pMemory + pageSize, pageSize * 2);
+    result = result && Platform::CommitVirtualMemory(pMemory + pageSize, pageSize * 2) && pMemory[pageSize] == 0;
+  }
+  Platform::ReleaseVirtualMemory(pMemory, size);
+
+  // the hints only change where the memory comes from, where they do anything
+  pMemory = static_cast<byte*>(Platform::ReserveVirtualMemory(size, Y_MALLOC_FLAG_HUGE_PAGES | Y_MALLOC_FLAG_NUMA_LOCAL));
+  result = result && pMemory != nullptr && Platform::CommitVirtualMemory(pMemory, size);
+  if (result)
+  {
+    pMemory[size - 1] = 3;
+    result = pMemory[size - 1] == 3;
+  }
+  Platform::ReleaseVirtualMemory(pMemory, size);
+
+  if (result)
+    Log_InfoPrintf("PASS: reserve and commit, %u byte pages", (uint32)pageSize);
+  else
+    Log_ErrorPrintf("FAIL: reserve and commit");
+  return result;
+}
+
+// counts constructions and destructions
+struct TrackedValue
+{
+  static int LiveCount;
+
+  TrackedValue() : Value(0) { LiveCount++; }
+  TrackedValue(uint32 value) : Value(value) { LiveCount++; }
+  TrackedValue(const TrackedValue& other) : Value(other.Value) { LiveCount++; }
+  ~TrackedValue() { LiveCount--; }
+
+  uint32 Value;
+};
+int TrackedValue::LiveCount = 0;
+
+static bool TestGrowth()
+{
+  bool result = true;
+  {
+    // room for a gigabyte, growing to a few megabytes
+    static const uint32 COUNT = 1000000;
+    VirtualArray<TrackedValue> values(256 * 1024 * 1024);
+    values.Emplace(7u);
+    const TrackedValue* pFirst = &values[0];
+
+    for (uint32 i = 1; i < COUNT; i++)
+      values.Add(TrackedValue(i * 3));
+
+    // nothing moved, and only what's in use is committed
+    result = &values[0] == pFirst && values.GetSize() == COUNT && values[0].Value == 7 &&
+             TrackedValue::LiveCount == (int)COUNT && values.GetCommittedBytes() >= COUNT * sizeof(TrackedValue) &&
+             values.GetCommittedBytes() < COUNT * sizeof(TrackedValue) + 2 * values.CommitGranularity;
+    for (uint32 i = 1; i < COUNT && result; i++)
+      result = values[i].Value == i * 3;
+
+    uint64 sum = 0;
+    for (const TrackedValue& value : values)
+      sum += value.Value;
+    result = result && sum == 7 + 3 * ((uint64)(COUNT - 1) * COUNT / 2);
+
+    // shrinking gives back everything above the elements that are left, and they grow again in place
+    values.Resize(1000);
+    values.Shrink();
+    result = result && TrackedValue::LiveCount == 1000 && values.GetCommittedBytes() == values.CommitGranularity &&
+             values.PopBack().Value == 999 * 3 && values.LastElement().Value == 998 * 3;
+
+    values.Resize(200000);
+    result = result && &values[0] == pFirst && values[199999].Value == 0 && TrackedValue::LiveCount == 200000;
+
+    values.Clear();
+    values.Shrink();
+    result = result && values.IsEmpty() && values.GetCommittedBytes() == 0 && TrackedValue::LiveCount == 0;
+
+    values.AddRange(pFirst, 0);
+    TrackedValue range[3] = {1u, 2u, 3u};
+    values.AddRange(range, 3);
+    result = result && values.GetSize() == 3 && values[2].Value == 3 && TrackedValue::LiveCount == 6;
+  }
+
+  // the array's destructor destroys what's left
+  result = result && TrackedValue::LiveCount == 0;
+
+  VirtualArray<uint64> hugePages(16 * 1024 * 1024,
+                                 VirtualArray<uint64>::FLAG_HUGE_PAGES | VirtualArray<uint64>::FLAG_NUMA_LOCAL);
+  for (uint32 i = 0; i < 500000; i++)
+    hugePages.Add(i);
+  result = result && hugePages[499999] == 499999 &&
+           (hugePages.GetCommittedBytes() % VirtualArray<uint64>::HugePageCommitGranularity) == 0;
+
+  if (result)
+    Log_InfoPrintf("PASS: growth");
+  else
+    Log_ErrorPrintf("FAIL: growth");
+  return result;
+}
+
+DEFINE_TEST_SUITE(VirtualArray)
+{
+  bool result = true;
+  result &= TestPlatformMemory();
+  result &= TestGrowth();
+  return result;
+}
@@ -0,0 +1,234 @@
+#include "TestSuite.h"
+#include "YBaseLib/BinaryBlob.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/VirtualFileSystem.h"
+#include "YBaseLib/ZipArchive.h"
+Log_SetChannel(TestVirtualFileSystem);
+
+static const char s_testDirectoryName[] = "TestVirtualFileSystem.tmp";
+
+// files hold their own name, so where they were read from shows
+static bool WriteFile(const char* fileName)
+{
+  ByteStream* pStream;
+  if (!ByteStream_OpenFileStream(fileName,
+                                 BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_CREATE_PATH | BYTESTREAM_OPEN_WRITE |
+                                   BYTESTREAM_OPEN_TRUNCATE,
+                                 &pStream))
+  {
+    return false;
+  }
+
+  bool result = pStream->Write2(fileName, Y_strlen(fileName));
+  pStream->Release();
+  return result;
+}
+
+static bool CreateTestFiles()
+{
+  static const char* fileNames[] = {"base/a.txt", "base/sub/b.txt", "base/.hidden", "overlay/a.txt",
+                                    "overlay/sub/c.txt", "same/a.txt"};
+
+  PathString path;
+  bool result = true;
+  for (uint32 i = 0; i < countof(fileNames) && result; i++)
+  {
+    path.Format("%s/%s", s_testDirectoryName, fileNames[i]);
+    result = WriteFile(path);
+  }
+
+  return result;
+}
+
+// checks a file can be opened and has the expected contents
+static bool CheckContents(const VirtualFileSystem& vfs, const char* path, const char* expectedContents)
+{
+  ByteStream* pStream = vfs.OpenFile(path, BYTESTREAM_OPEN_READ);
+  if (pStream == nullptr)
+    return (expectedContents == nullptr);
+
+  char contents[256];
+  uint32 length = pStream->Read(contents, sizeof(contents) - 1);
+  contents[length] = '\0';
+  pStream->Release();
+  return (expectedContents != nullptr && Y_strcmp(contents, expectedContents) == 0);
+}
+
+static bool CheckSource(const VirtualFileSystem& vfs, const char* path, uint32 expectedMountID,
+                        const char* expectedContents)
+{
+  uint32 mountID;
+  VirtualFileSystem::MOUNT_TYPE mountType;
+  String sourcePath;
+  return vfs.ResolvePath(path, &mountID, &mountType, &sourcePath) && mountID == expectedMountID &&
+         CheckContents(vfs, path, expectedContents);
+}
+
+static bool TestMounts()
+{
+  VirtualFileSystem vfs;
+  PathString basePath, overlayPath, samePath, missingPath;
+  basePath.Format("%s/base", s_testDirectoryName);
+  overlayPath.Format("%s/overlay", s_testDirectoryName);
+  samePath.Format("%s/same", s_testDirectoryName);
+  missingPath.Format("%s/missing", s_testDirectoryName);
+
+  // the overlay is mounted first, but wins by priority
+  uint32 overlayID = vfs.MountDirectory("", overlayPath, 1);
+  uint32 baseID = vfs.MountDirectory("", basePath);
+  PathString baseA, baseB, overlayA, overlayC, sameA;
+  baseA.Format("%s/base/a.txt", s_testDirectoryName);
+  baseB.Format("%s/base/sub/b.txt", s_testDirectoryName);
+  overlayA.Format("%s/overlay/a.txt", s_testDirectoryName);
+  overlayC.Format("%s/overlay/sub/c.txt", s_testDirectoryName);
+  sameA.Format("%s/same/a.txt", s_testDirectoryName);
+  bool result = overlayID != 0 && baseID != 0 && baseID != overlayID && vfs.MountDirectory("", missingPath) == 0 &&
+                CheckSource(vfs, "a.txt", overlayID, overlayA) && CheckSource(vfs, "sub/b.txt", baseID, baseB) &&
+                CheckSource(vfs, "sub/c.txt", overlayID, overlayC) && vfs.DirectoryExists("sub") &&
+                !vfs.FileExists("sub") && !vfs.FileExists("d.txt") && !CheckContents(vfs, "d.txt", "") &&
+                vfs.GetEntryCount() == 5;
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: directory mounts");
+    return false;
+  }
+
+  // paths are resolved however they're written
+  result = CheckContents(vfs, "SUB/B.TXT", baseB) && CheckContents(vfs, "/sub\\./c.txt", overlayC) &&
+           CheckContents(vfs, "sub/../a.txt", overlayA) && CheckContents(vfs, "../../a.txt", overlayA) &&
+           vfs.OpenFile("a.txt", BYTESTREAM_OPEN_WRITE) == nullptr;
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: path resolution");
+    return false;
+  }
+
+  // searches see one namespace
+  FileSystem::FindResultsArray results;
+  result = vfs.FindFiles("", "*", FILESYSTEM_FIND_FILES, &results) && results.GetSize() == 1 &&
+           Y_strcmp(results[0].FileName, "a.txt") == 0 &&
+           results[0].Size == overlayA.GetLength() &&
+           vfs.FindFiles("", "*", FILESYSTEM_FIND_FILES | FILESYSTEM_FIND_FOLDERS | FILESYSTEM_FIND_RECURSIVE,
+                         &results) &&
+           results.GetSize() == 4 &&
+           vfs.FindFiles("", "*", FILESYSTEM_FIND_FILES | FILESYSTEM_FIND_RECURSIVE | FILESYSTEM_FIND_HIDDEN_FILES,
+                         &results) &&
+           results.GetSize() == 4 &&
+           vfs.FindFiles("/sub", "c.*", FILESYSTEM_FIND_FILES, &results) && results.GetSize() == 1 &&
+           Y_strcmp(results[0].FileName, "sub/c.txt") == 0 &&
+           vfs.FindFiles("sub", "*", FILESYSTEM_FIND_FILES | FILESYSTEM_FIND_RELATIVE_PATHS, &results) &&
+           results.GetSize() == 2 && !vfs.FindFiles("a.txt", "*", FILESYSTEM_FIND_FILES, &results);
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: searches");
+    return false;
+  }
+
+  // mounts of the same priority are won by the last, memory mounts can sit under a path
+  uint32 sameID = vfs.MountDirectory("", samePath, 1);
+  uint32 memoryID = vfs.MountMemory("packs/memory", 2);
+  static const char memoryContents[] = "in memory";
+  BinaryBlob* pBlob = BinaryBlob::CreateFromPointer(memoryContents, sizeof(memoryContents) - 1);
+  result = sameID != 0 && memoryID != 0 && CheckSource(vfs, "a.txt", sameID, sameA) &&
+           vfs.AddMemoryFile(memoryID, "x.bin", pBlob) && !vfs.AddMemoryFile(baseID, "x.bin", pBlob) &&
+           CheckSource(vfs, "packs/memory/x.bin", memoryID, memoryContents) && vfs.DirectoryExists("packs") &&
+           CheckSource(vfs, "packs", 0, nullptr);
+  pBlob->Release();
+
+  // streams hold on to the blob when it's replaced
+  ByteStream* pMemoryStream = vfs.OpenFile("packs/memory/x.bin", BYTESTREAM_OPEN_READ);
+  pBlob = BinaryBlob::CreateFromPointer("replaced", 8);
+  result = result && pMemoryStream != nullptr && vfs.AddMemoryFile(memoryID, "x.bin", pBlob) &&
+           CheckContents(vfs, "packs/memory/x.bin", "replaced") && pMemoryStream->GetSize() == 9;
+  pBlob->Release();
+  if (pMemoryStream != nullptr)
+    pMemoryStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: overlays");
+    return false;
+  }
+
+  // unmounting uncovers what was underneath, and refreshing picks up changes
+  PathString newPath;
+  newPath.Format("%s/base/sub/new.txt", s_testDirectoryName);
+  result = vfs.Unmount(sameID) && vfs.Unmount(overlayID) && !vfs.Unmount(overlayID) &&
+           CheckSource(vfs, "a.txt", baseID, baseA) && !vfs.FileExists("sub/c.txt") && WriteFile(newPath) &&
+           !vfs.FileExists("sub/new.txt");
+  vfs.Refresh();
+  result = result && CheckContents(vfs, "sub/new.txt", newPath) &&
+           CheckContents(vfs, "packs/memory/x.bin", "replaced");
+  vfs.UnmountAll();
+  result = result && vfs.GetEntryCount() == 0 && !vfs.FileExists("a.txt");
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: unmounting");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: mounts");
+  return true;
+}
+
+#ifdef HAVE_ZLIB
+
+static bool TestArchiveMounts()
+{
+  // an archive with a file both on disk and in it
+  GrowableMemoryByteStream* pArchiveStream = ByteStream_CreateGrowableMemoryStream();
+  ZipArchive* pArchive = ZipArchive::CreateArchive(pArchiveStream);
+  static const char* fileNames[] = {"a.txt", "zip/d.txt"};
+  bool result = (pArchive != nullptr);
+  for (uint32 i = 0; i < countof(fileNames) && result; i++)
+  {
+    ByteStream* pStream = pArchive->OpenFile(fileNames[i], BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE);
+    result = (pStream != nullptr && pStream->Write2(fileNames[i], Y_strlen(fileNames[i])));
+    if (pStream != nullptr)
+      pStream->Release();
+  }
+
+  VirtualFileSystem vfs;
+  PathString basePath;
+  basePath.Format("%s/base", s_testDirectoryName);
+  uint32 baseID = vfs.MountDirectory("", basePath);
+  uint32 archiveID = result ? vfs.MountArchive("", pArchive, 1) : 0;
+  result = result && baseID != 0 && archiveID != 0 && CheckSource(vfs, "a.txt", archiveID, "a.txt") &&
+           CheckSource(vfs, "ZIP/D.TXT", archiveID, "zip/d.txt") && vfs.DirectoryExists("zip") &&
+           vfs.FileExists("sub/b.txt");
+
+  vfs.UnmountAll();
+  delete pArchive;
+  pArchiveStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: archive mounts");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: archive mounts");
+  return true;
+}
+
+#endif
+
+DEFINE_TEST_SUITE(VirtualFileSystem)
+{
+  FileSystem::DeleteDirectory(s_testDirectoryName, true);
+  if (!CreateTestFiles())
+  {
+    Log_ErrorPrint("FAIL: creating the test files");
+    FileSystem::DeleteDirectory(s_testDirectoryName, true);
+    return false;
+  }
+
+  bool result = TestMounts();
+#ifdef HAVE_ZLIB
+  result = result && TestArchiveMounts();
+#endif
+
+  FileSystem::DeleteDirectory(s_testDirectoryName, true);
+  return result;
+}
@@ -0,0 +1,143 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/XMLPullReader.h"
+Log_SetChannel(TestXMLPullReader);
+
+static const char s_document[] = "\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                                 "<!DOCTYPE scene [ <!ENTITY unused \"x>y\"> ]>\n"
+                                 "<!-- a comment before the root -->\n"
+                                 "<scene name=\"test\" version='2'>\n"
+                                 "  <object id=\"1\" label=\"a &lt;b&gt; &amp; &quot;c&quot; &#65;&#x42;&#x20AC;\"/>\n"
+                                 "  <object id=\"2\" note=\"line\r\nbreak\ttab\">text &amp; more</object>\n"
+                                 "  <!-- between -->\n"
+                                 "  <data><![CDATA[raw <not> &markup;]]></data>\n"
+                                 "  <empty></empty>\n"
+                                 "</scene>\n";
+
+// Expects the next token to be of the type, name and value, a null value meaning none.
+static bool Expect(XMLPullReader& reader, XMLREADER_TOKEN_TYPE type, const char* name, const char* value)
+{
+  if (!reader.NextToken() || reader.GetTokenType() != type || Y_strcmp(reader.GetNodeName(), name) != 0 ||
+      (value == NULL) != (reader.GetNodeValue() == NULL) ||
+      (value != NULL && (Y_strcmp(reader.GetNodeValue(), value) != 0 || !reader.GetNodeValueView().Compare(value))))
+  {
+    Log_ErrorPrintf("FAIL: expected token %u '%s'", uint32(type), name);
+    return false;
+  }
+
+  return true;
+}
+
+// every kind of token, with attributes, entities and line breaks decoded and plain values left in place
+static bool TestTokens()
+{
+  ReadOnlyMemoryByteStream* pStream = ByteStream_CreateReadOnlyMemoryStream(s_document, sizeof(s_document) - 1);
+  XMLPullReader reader;
+  bool result = reader.Create(pStream, "document.xml") && Expect(reader, XMLREADER_TOKEN_ELEMENT, "scene", NULL);
+
+  StringView view;
+  result = result && !reader.IsEmptyElement() && Y_strcmp(reader.FetchAttribute("version"), "2") == 0 &&
+           reader.FetchAttributeView("name", &view) && view.Compare("test") &&
+           view.GetData() > s_document && view.GetEnd() < s_document + sizeof(s_document) &&
+           reader.FetchAttribute("missing") == NULL && Y_strcmp(reader.FetchAttributeDefault("missing", "d"), "d") == 0;
+
+  // attributes in order, with the copies they hand out staying valid
+  const char* pFirstName = NULL;
+  result = result && reader.MoveToFirstAttribute() && (pFirstName = reader.GetNodeName()) != NULL &&
+           reader.MoveToNextAttribute() && Y_strcmp(reader.GetNodeName(), "version") == 0 &&
+           !reader.MoveToNextAttribute() && Y_strcmp(pFirstName, "name") == 0 && reader.MoveToElement() &&
+           reader.GetNodeNameView().Compare("scene");
+
+  result = result && Expect(reader, XMLREADER_TOKEN_ELEMENT, "object", NULL) && reader.IsEmptyElement() &&
+           Y_strcmp(reader.FetchAttribute("label"), "a <b> & \"c\" AB\xE2\x82\xAC") == 0 &&
+           Y_strcmp(reader.FetchAttribute("id"), "1") == 0;
+
+  result = result && Expect(reader, XMLREADER_TOKEN_ELEMENT, "object", NULL) &&
+           Y_strcmp(reader.FetchAttribute("note"), "line break tab") == 0 &&
+           Expect(reader, XMLREADER_TOKEN_TEXT, "#text", "text & more") &&
+           Expect(reader, XMLREADER_TOKEN_END_ELEMENT, "object", NULL);
+
+  result = result && Expect(reader, XMLREADER_TOKEN_ELEMENT, "data", NULL) &&
+           Expect(reader, XMLREADER_TOKEN_TEXT, "#text", "raw <not> &markup;") &&
+           Expect(reader, XMLREADER_TOKEN_END_ELEMENT, "data", NULL);
+
+  result = result && Expect(reader, XMLREADER_TOKEN_ELEMENT, "empty", NULL) && !reader.IsEmptyElement() &&
+           Expect(reader, XMLREADER_TOKEN_END_ELEMENT, "empty", NULL) &&
+           Expect(reader, XMLREADER_TOKEN_END_ELEMENT, "scene", NULL) && !reader.NextToken() &&
+           !reader.InErrorState();
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: tokens");
+  return result;
+}
+
+// skipping and element text, on a stream that isn't in memory
+static bool TestSkipping()
+{
+  GrowableMemoryByteStream* pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+  pMemoryStream->Write(s_document, uint32(sizeof(s_document) - 1));
+  pMemoryStream->SeekAbsolute(0);
+
+  XMLSelector versionSelector("0|1|2");
+  XMLSelector emptySelector("other|EMPTY");
+  XMLPullReader reader;
+  bool result = reader.Create(pMemoryStream, "document.xml") && reader.NextToken() &&
+                reader.SelectAttribute("version", versionSelector) == 2 &&
+                reader.SelectAttribute("missing", versionSelector, false) == -1 && reader.MoveToElement() &&
+                reader.SkipToElement("OBJECT") && reader.SkipCurrentElement() && reader.NextToken() &&
+                reader.FetchAttribute("note") != NULL && reader.GetElementText(true).Compare("text & more") &&
+                reader.GetTokenType() == XMLREADER_TOKEN_END_ELEMENT && reader.ExpectEndOfElementName("object") &&
+                reader.NextToken() && reader.SkipCurrentElement() && reader.ExpectEndOfElementName("data") &&
+                reader.NextToken() && reader.Select("other|empty") == 1 && reader.Select(emptySelector) == 1 &&
+                reader.Select(versionSelector, false) == -1 && reader.SkipCurrentElement() &&
+                reader.NextToken() && reader.ExpectEndOfElementName("scene");
+
+  pMemoryStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: skipping");
+  else
+    Log_ErrorPrint("FAIL: skipping");
+  return result;
+}
+
+// badly formed documents stop the reader
+static bool TestErrors()
+{
+  static const char* documents[] = {
+    "<a><b></a>", "<a>", "<a x=\"1></a>", "<a x></a>", "<a>&bogus;</a>", "<a/><b/>", "text<a/>", "<a><!-- </a>", "",
+  };
+
+  bool result = true;
+  for (uint32 i = 0; i < countof(documents); i++)
+  {
+    ReadOnlyMemoryByteStream* pStream = ByteStream_CreateReadOnlyMemoryStream(documents[i], Y_strlen(documents[i]));
+    XMLPullReader reader;
+    reader.Create(pStream, "bad.xml");
+    while (reader.NextToken())
+    {
+      // entities are only decoded when asked for
+      if (reader.GetTokenType() == XMLREADER_TOKEN_TEXT)
+        reader.GetNodeValue();
+    }
+
+    if (!reader.InErrorState())
+    {
+      Log_ErrorPrintf("FAIL: '%s' read without an error", documents[i]);
+      result = false;
+    }
+    pStream->Release();
+  }
+
+  if (result)
+    Log_InfoPrint("PASS: errors");
+  return result;
+}
+
+DEFINE_TEST_SUITE(XMLPullReader)
+{
+  return TestTokens() && TestSkipping() && TestErrors();
+}
@@ -0,0 +1,45 @@
+#include "TestSuite.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/XMLSelector.h"
+Log_SetChannel(TestXMLSelector);
+
+// every value against every selection string, a selector has to agree with Y_selectstring
+static bool TestMatching()
+{
+  static const char* selectionStrings[] = {
+    "", "a", "mesh|material|light", "A|b|a", "x||y", "|first", "last|", "Mesh|MESH|mesh",
+    "one|two|three|four|five|six|seven|eight|nine|ten|eleven|twelve"};
+  static const char* values[] = {"",      "a",    "A",    "b",    "mesh", "MATERIAL", "light",   "lights", "ligh", "x",
+                                 "y",     "first", "last", "Mesh", "ten",  "TWELVE",   "twelve ", "zero",   "seven"};
+
+  bool result = true;
+  for (uint32 i = 0; i < countof(selectionStrings); i++)
+  {
+    XMLSelector selector(selectionStrings[i]);
+    for (uint32 j = 0; j < countof(values); j++)
+    {
+      int32 expected = Y_selectstring(selectionStrings[i], values[j]);
+      int32 found = selector.Find(values[j]);
+      if (found != expected)
+      {
+        Log_ErrorPrintf("FAIL: '%s' in '%s' is %d, expected %d", values[j], selectionStrings[i], found, expected);
+        result = false;
+      }
+    }
+  }
+
+  // views of a longer string match on their own length
+  XMLSelector selector("mesh|material");
+  result = result && selector.GetAlternativeCount() == 2 && selector.Find(StringView("materials", 8)) == 1 &&
+           selector.Find(StringView("mesh", 3)) == -1;
+
+  if (result)
+    Log_InfoPrint("PASS: matching");
+  return result;
+}
+
+DEFINE_TEST_SUITE(XMLSelector)
+{
+  return TestMatching();
+}
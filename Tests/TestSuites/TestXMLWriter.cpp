@@ -0,0 +1,132 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/String.h"
+#include "YBaseLib/XMLPullReader.h"
+#include "YBaseLib/XMLWriter.h"
+#include <cstring>
+Log_SetChannel(TestXMLWriter);
+
+static bool CheckOutput(const char* testName, GrowableMemoryByteStream* pStream, const char* expected)
+{
+  uint32 expectedLength = Y_strlen(expected);
+  if (pStream->GetSize() != expectedLength || std::memcmp(pStream->GetMemoryPointer(), expected, expectedLength) != 0)
+  {
+    Log_ErrorPrintf("FAIL: %s: wrote '%.*s'", testName, uint32(pStream->GetSize()), pStream->GetMemoryPointer());
+    return false;
+  }
+
+  Log_InfoPrintf("PASS: %s", testName);
+  return true;
+}
+
+// the same text xmlTextWriter writes, indentation, escaping and all
+static bool TestDocument()
+{
+  static const byte data[] = {0x00, 0x01, 0xFE};
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  {
+    XMLWriter writer;
+    writer.Create(pStream);
+    writer.StartElement("scene");
+    writer.WriteAttribute("name", "a<b>&\"c\"\n\t\r'x' \xE2\x82\xAC");
+    writer.WriteAttributef("label", "%s-%u", "item", 7u);
+    writer.WriteAttributeInt32("offset", -12);
+    writer.WriteAttributeUInt64("size", 18446744073709551615ull);
+    writer.WriteAttributeFloat("scale", 0.5f);
+    writer.WriteAttributeDouble("ratio", 0.1);
+    writer.WriteEmptyElement("object");
+    writer.StartElement("object");
+    writer.WriteString("text <&> \"q\" \r\n\t\xE2\x82\xAC");
+    writer.EndElement();
+    writer.StartElement("group");
+    writer.StartElement("code");
+    writer.WriteCDATA("raw <x> ]]> end");
+    writer.EndElement();
+    writer.StartElement("data");
+    writer.WriteBase64EncodedData(data, sizeof(data));
+    writer.EndElement();
+    writer.StartElement("empty");
+    writer.WriteString("");
+    writer.EndElement();
+    writer.EndElement();
+
+    // Close ends the scene
+    writer.Close();
+  }
+
+  bool result = CheckOutput("document", pStream,
+                            "<?xml version=\"1.0\"?>\n"
+                            "<scene name=\"a&lt;b&gt;&amp;&quot;c&quot;&#10;&#9;&#13;'x' &#x20AC;\" label=\"item-7\" "
+                            "offset=\"-12\" size=\"18446744073709551615\" scale=\"0.5\" ratio=\"0.1\">\n"
+                            "    <object/>\n"
+                            "    <object>text &lt;&amp;&gt; &quot;q&quot; &#13;\n\t\xE2\x82\xAC</object>\n"
+                            "    <group>\n"
+                            "        <code><![CDATA[raw <x> ]]]]><![CDATA[> end]]></code>\n"
+                            "        <data>AAH+</data>\n"
+                            "        <empty></empty>\n"
+                            "    </group>\n"
+                            "</scene>\n");
+  pStream->Release();
+  return result;
+}
+
+// values longer than the buffer, with escapes either side of the 16 byte blocks, read back the same
+static bool TestLongValues()
+{
+  String value;
+  for (uint32 i = 0; i < 3000; i++)
+    value.AppendCharacter((i % 37 == 0) ? '&' : ((i % 53 == 0) ? '"' : char('a' + (i % 26))));
+
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  {
+    XMLWriter writer;
+    writer.Create(pStream);
+    writer.StartElement("root");
+    writer.WriteAttribute("value", value);
+    writer.WriteAttributef("formatted", "%s", value.GetCharArray());
+    writer.WriteString(value);
+    writer.EndElement();
+    writer.Close();
+  }
+
+  pStream->SeekAbsolute(0);
+  XMLPullReader reader;
+  bool result = reader.Create(pStream, "long.xml") && reader.NextToken() &&
+                Y_strcmp(reader.FetchAttribute("value"), value) == 0 &&
+                Y_strcmp(reader.FetchAttribute("formatted"), value) == 0 &&
+                reader.GetElementText().Compare(value);
+
+  pStream->Release();
+  if (result)
+    Log_InfoPrint("PASS: long values");
+  else
+    Log_ErrorPrint("FAIL: long values");
+  return result;
+}
+
+// misuse stops the writer, and Close still ends the open elements
+static bool TestErrors()
+{
+  GrowableMemoryByteStream* pStream = ByteStream_CreateGrowableMemoryStream();
+  bool result;
+  {
+    XMLWriter writer;
+    writer.Create(pStream);
+    writer.StartElement("a");
+    writer.WriteString("text");
+    writer.WriteAttribute("late", "1");
+    result = writer.InErrorState();
+    writer.Close();
+  }
+
+  result = result && CheckOutput("errors", pStream, "<?xml version=\"1.0\"?>\n<a>text</a>\n");
+  pStream->Release();
+  return result;
+}
+
+DEFINE_TEST_SUITE(XMLWriter)
+{
+  return TestDocument() && TestLongValues() && TestErrors();
+}
@@ -0,0 +1,883 @@
+#include "TestSuite.h"
+#include "YBaseLib/ByteStream.h"
+#include "YBaseLib/CString.h"
+#include "YBaseLib/Compression.h"
+#include "YBaseLib/FileSystem.h"
+#include "YBaseLib/Log.h"
+#include "YBaseLib/PODArray.h"
+#include "YBaseLib/ProgressCallbacks.h"
+#include "YBaseLib/ThreadPool.h"
+#include "YBaseLib/ZipArchive.h"
+#include <cstring>
+Log_SetChannel(TestZipArchive);
+
+#ifdef HAVE_ZLIB
+
+static const char s_testDirectoryName[] = "TestZipArchive.tmp";
+
+struct TestFile
+{
+  const char* FileName;
+  uint32 Size;
+  uint32 CompressionLevel;
+};
+
+// one file is bigger than an extraction batch, so it's read on its own
+static const TestFile s_testFiles[] = {
+  {"a.txt", 100, 6},           {"empty.txt", 0, 6},          {"stored.bin", 5000, 0},
+  {"dir/b.txt", 70000, 6},     {"dir/sub/c.bin", 12345, 1},  {"dir/sub/empty.bin", 0, 0},
+  {"big/huge.bin", 33 * 1024 * 1024, 0},
+};
+
+// contents that depend on the name, compressible but not trivially
+static void FillContents(const char* fileName, uint32 size, PODArray<byte>* pContents)
+{
+  pContents->Resize(size);
+  uint32 seed = Y_strlen(fileName);
+  for (uint32 i = 0; i < size; i++)
+    (*pContents)[i] = (byte)(fileName[i % seed] + (i / 512));
+}
+
+static bool WriteArchiveFiles(ZipArchive* pArchive)
+{
+  PODArray<byte> contents;
+  for (uint32 i = 0; i < countof(s_testFiles); i++)
+  {
+    const TestFile& testFile = s_testFiles[i];
+    FillContents(testFile.FileName, testFile.Size, &contents);
+
+    ByteStream* pStream =
+      pArchive->OpenFile(testFile.FileName, BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE, testFile.CompressionLevel);
+    if (pStream == nullptr)
+      return false;
+
+    bool result = (testFile.Size == 0 || pStream->Write2(contents.GetBasePointer(), testFile.Size));
+    pStream->Release();
+    if (!result)
+      return false;
+  }
+
+  return true;
+}
+
+static bool CheckExtractedFile(const char* directory, const char* fileName, uint32 size)
+{
+  PathString path;
+  path.Format("%s/%s", directory, fileName);
+
+  ByteStream* pStream;
+  if (!ByteStream_OpenFileStream(path, BYTESTREAM_OPEN_READ, &pStream))
+    return false;
+
+  PODArray<byte> expected, contents;
+  FillContents(fileName, size, &expected);
+  contents.Resize(size + 1);
+  bool result = (pStream->GetSize() == size && pStream->Read(contents.GetBasePointer(), size + 1) == size &&
+                 (size == 0 || std::memcmp(contents.GetBasePointer(), expected.GetBasePointer(), size) == 0));
+  pStream->Release();
+  return result;
+}
+
+static bool CheckStreamContents(ByteStream* pStream, const char* fileName, uint32 size)
+{
+  PODArray<byte> expected, contents;
+  FillContents(fileName, size, &expected);
+  contents.Resize(size + 1);
+  return (pStream->Read(contents.GetBasePointer(), size + 1) == size &&
+          (size == 0 || std::memcmp(contents.GetBasePointer(), expected.GetBasePointer(), size) == 0));
+}
+
+static bool CheckArchiveFile(ZipArchive* pArchive, const char* fileName, uint32 size, uint32 openMode)
+{
+  ByteStream* pStream = pArchive->OpenFile(fileName, BYTESTREAM_OPEN_READ | openMode);
+  if (pStream == nullptr)
+    return false;
+
+  bool result = CheckStreamContents(pStream, fileName, size);
+  pStream->Release();
+  return result;
+}
+
+static bool CheckExtraction(ZipArchive* pArchive, ThreadPool* pThreadPool, const char* directoryName)
+{
+  PathString directory;
+  directory.Format("%s/%s", s_testDirectoryName, directoryName);
+  if (!pArchive->ExtractAll(directory, pThreadPool))
+    return false;
+
+  for (uint32 i = 0; i < countof(s_testFiles); i++)
+  {
+    if (!CheckExtractedFile(directory, s_testFiles[i].FileName, s_testFiles[i].Size))
+    {
+      Log_ErrorPrintf("'%s' was not extracted correctly", s_testFiles[i].FileName);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool TestExtraction(ThreadPool* pThreadPool)
+{
+  // from an archive in memory, which is inflated in place
+  GrowableMemoryByteStream* pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+  ZipArchive* pArchive = ZipArchive::CreateArchive(pMemoryStream);
+  bool result = WriteArchiveFiles(pArchive) && CheckExtraction(pArchive, nullptr, "memory") &&
+                CheckExtraction(pArchive, pThreadPool, "memory_parallel");
+  delete pArchive;
+  pMemoryStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: extraction from memory");
+    return false;
+  }
+
+  // from an archive on disk, which is read in batches
+  PathString archivePath;
+  archivePath.Format("%s/archive.zip", s_testDirectoryName);
+  ByteStream* pFileStream;
+  result = ByteStream_OpenFileStream(archivePath,
+                                     BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_CREATE_PATH | BYTESTREAM_OPEN_WRITE |
+                                       BYTESTREAM_OPEN_TRUNCATE | BYTESTREAM_OPEN_SEEKABLE,
+                                     &pFileStream);
+  if (result)
+  {
+    pArchive = ZipArchive::CreateArchive(pFileStream);
+    result = WriteArchiveFiles(pArchive) && pArchive->CommitChanges();
+    delete pArchive;
+    pFileStream->Release();
+  }
+
+  pArchive = nullptr;
+  if (result && ByteStream_OpenFileStream(archivePath, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_SEEKABLE, &pFileStream))
+  {
+    pArchive = ZipArchive::OpenArchiveReadOnly(pFileStream);
+    pFileStream->Release();
+  }
+
+  result = pArchive != nullptr && CheckExtraction(pArchive, pThreadPool, "file");
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: extraction from a file");
+    delete pArchive;
+    return false;
+  }
+
+  // missing files fail, the rest are still extracted
+  PathString directory;
+  directory.Format("%s/some", s_testDirectoryName);
+  static const char* someFiles[] = {"dir/b.txt", "missing.txt", "a.txt"};
+  result = !pArchive->ExtractFiles(someFiles, countof(someFiles), directory, pThreadPool) &&
+           CheckExtractedFile(directory, "dir/b.txt", 70000) && CheckExtractedFile(directory, "a.txt", 100) &&
+           !CheckExtractedFile(directory, "big/huge.bin", 33 * 1024 * 1024);
+  delete pArchive;
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: extracting some files");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: extraction");
+  return true;
+}
+
+static bool TestParallelCompression(ThreadPool* pThreadPool)
+{
+  // streamed writes span several batches, buffered ones are compressed whole
+  GrowableMemoryByteStream* pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+  ZipArchive* pArchive = ZipArchive::CreateArchive(pMemoryStream);
+  pArchive->SetCompressionThreadPool(pThreadPool);
+  struct ParallelFile
+  {
+    const char* FileName;
+    uint32 Size;
+    uint32 OpenMode;
+  };
+  static const ParallelFile parallelFiles[] = {
+    {"streamed.bin", 9 * 1024 * 1024 + 123, BYTESTREAM_OPEN_STREAMED},
+    {"buffered.bin", 3 * 1024 * 1024 + 45, BYTESTREAM_OPEN_SEEKABLE},
+    {"small.bin", 1000, BYTESTREAM_OPEN_STREAMED},
+    {"empty.bin", 0, BYTESTREAM_OPEN_SEEKABLE},
+  };
+
+  PODArray<byte> contents;
+  bool result = true;
+  for (uint32 i = 0; i < countof(parallelFiles) && result; i++)
+  {
+    FillContents(parallelFiles[i].FileName, parallelFiles[i].Size, &contents);
+    ByteStream* pStream = pArchive->OpenFile(
+      parallelFiles[i].FileName, BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE | parallelFiles[i].OpenMode);
+    result = (pStream != nullptr);
+
+    // written in pieces that don't line up with the blocks
+    for (uint32 offset = 0; offset < parallelFiles[i].Size && result; offset += 100000)
+    {
+      uint32 length = Min(parallelFiles[i].Size - offset, (uint32)100000);
+      result = pStream->Write2(contents.GetBasePointer() + offset, length);
+    }
+
+    if (pStream != nullptr)
+      pStream->Release();
+  }
+
+  // read back with one inflate stream per file, as other tools would
+  for (uint32 i = 0; i < countof(parallelFiles) && result; i++)
+  {
+    FILESYSTEM_STAT_DATA statData;
+    result = CheckArchiveFile(pArchive, parallelFiles[i].FileName, parallelFiles[i].Size, BYTESTREAM_OPEN_STREAMED) &&
+             pArchive->StatFile(parallelFiles[i].FileName, &statData) && statData.Size == parallelFiles[i].Size;
+  }
+
+  delete pArchive;
+  pMemoryStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: parallel compression");
+    return false;
+  }
+
+  // many files at once, stored and deflated
+  static const char* fileNames[] = {"a.txt", "b.txt", "dir/c.txt", "large.bin", "empty.txt"};
+  static const uint32 fileSizes[] = {10, 5000, 70000, 2 * 1024 * 1024, 0};
+  PODArray<byte> fileContents[countof(fileNames)];
+  ZipArchive::FileContents files[countof(fileNames)];
+  for (uint32 i = 0; i < countof(fileNames); i++)
+  {
+    FillContents(fileNames[i], fileSizes[i], &fileContents[i]);
+    files[i].FileName = fileNames[i];
+    files[i].pData = fileContents[i].GetBasePointer();
+    files[i].Size = fileSizes[i];
+  }
+
+  for (uint32 compressionLevel = 0; compressionLevel <= 6 && result; compressionLevel += 6)
+  {
+    pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+    pArchive = ZipArchive::CreateArchive(pMemoryStream);
+    result = pArchive->WriteFiles(files, countof(files), compressionLevel, pThreadPool);
+    for (uint32 i = 0; i < countof(fileNames) && result; i++)
+      result = CheckArchiveFile(pArchive, fileNames[i], fileSizes[i], BYTESTREAM_OPEN_SEEKABLE);
+
+    delete pArchive;
+    pMemoryStream->Release();
+  }
+
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: writing many files");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: parallel compression");
+  return true;
+}
+
+// whether a file's stream points into memory, rather than holding a copy
+static bool IsReadInPlace(ZipArchive* pArchive, const char* fileName, const byte* pArchiveMemory, uint64 archiveSize)
+{
+  ByteStream* pStream = pArchive->OpenFile(fileName, BYTESTREAM_OPEN_READ);
+  if (pStream == nullptr)
+    return false;
+
+  const byte* pData = pStream->GetBasePointer();
+  bool result = (pData != nullptr && pData >= pArchiveMemory &&
+                 (pData + pStream->GetSize()) <= (pArchiveMemory + archiveSize));
+  pStream->Release();
+  return result;
+}
+
+static bool TestStoredInPlace()
+{
+  // stored files in a mapped archive are read where they are, deflated ones can't be
+  PathString archivePath;
+  archivePath.Format("%s/stored.zip", s_testDirectoryName);
+  ByteStream* pFileStream;
+  bool result = ByteStream_OpenFileStream(archivePath,
+                                          BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_CREATE_PATH | BYTESTREAM_OPEN_WRITE |
+                                            BYTESTREAM_OPEN_TRUNCATE | BYTESTREAM_OPEN_SEEKABLE,
+                                          &pFileStream);
+  if (result)
+  {
+    ZipArchive* pArchive = ZipArchive::CreateArchive(pFileStream);
+    result = WriteArchiveFiles(pArchive) && pArchive->CommitChanges();
+    delete pArchive;
+    pFileStream->Release();
+  }
+
+  ZipArchive* pArchive = nullptr;
+  if (result && ByteStream_OpenFileStream(archivePath, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_MAPPED, &pFileStream))
+  {
+    pArchive = ZipArchive::OpenArchiveReadOnly(pFileStream);
+    const byte* pArchiveMemory = pFileStream->GetBasePointer();
+    uint64 archiveSize = pFileStream->GetSize();
+    pFileStream->Release();
+
+    // opened without SEEKABLE, which would otherwise be a streamed read
+    ByteStream* pStream = (pArchive != nullptr) ? pArchive->OpenFile("stored.bin", BYTESTREAM_OPEN_READ) : nullptr;
+    PODArray<byte> expected;
+    FillContents("stored.bin", 5000, &expected);
+    result = pArchive != nullptr && pArchiveMemory != nullptr && pStream != nullptr && pStream->GetSize() == 5000 &&
+             std::memcmp(pStream->GetBasePointer(), expected.GetBasePointer(), 5000) == 0 &&
+             IsReadInPlace(pArchive, "stored.bin", pArchiveMemory, archiveSize) &&
+             IsReadInPlace(pArchive, "big/huge.bin", pArchiveMemory, archiveSize) &&
+             !IsReadInPlace(pArchive, "dir/b.txt", pArchiveMemory, archiveSize);
+    if (pStream != nullptr)
+      pStream->Release();
+
+    delete pArchive;
+  }
+  else
+  {
+    result = false;
+  }
+
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: stored files in place");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: stored files in place");
+  return true;
+}
+
+static bool TestUnsafeNames()
+{
+  GrowableMemoryByteStream* pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+  ZipArchive* pArchive = ZipArchive::CreateArchive(pMemoryStream);
+  static const char* unsafeNames[] = {"../escaped.txt", "dir/../../escaped.txt", "/escaped.txt"};
+  bool result = true;
+  for (uint32 i = 0; i < countof(unsafeNames) && result; i++)
+  {
+    ByteStream* pStream = pArchive->OpenFile(unsafeNames[i], BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE);
+    result = (pStream != nullptr && pStream->Write2("x", 1));
+    if (pStream != nullptr)
+      pStream->Release();
+  }
+
+  PathString directory;
+  directory.Format("%s/unsafe/inner", s_testDirectoryName);
+  result = result && !pArchive->ExtractAll(directory) && !FileSystem::FileExists("TestZipArchive.tmp/escaped.txt") &&
+           !FileSystem::FileExists("TestZipArchive.tmp/unsafe/escaped.txt");
+  delete pArchive;
+  pMemoryStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: unsafe names");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: unsafe names");
+  return true;
+}
+
+// Poorly compressible writes in one go, which can leave the output buffer exactly full when the write returns, so
+// the stream has to make room before it can finish the deflate.
+static bool TestStreamedFinish()
+{
+  PODArray<byte> contents;
+  contents.Resize(1024 * 1024);
+  uint32 state = 1;
+  for (uint32 i = 0; i < contents.GetSize(); i++)
+  {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    contents[i] = (byte)("abcdefgh"[state % 8]);
+  }
+
+  static const uint32 sizes[] = {1024 * 1024, 700000, 300001, 65536};
+  bool result = true;
+  for (uint32 i = 0; i < countof(sizes) && result; i++)
+  {
+    GrowableMemoryByteStream* pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+    ZipArchive* pArchive = ZipArchive::CreateArchive(pMemoryStream);
+    ByteStream* pStream = pArchive->OpenFile("random.txt", BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE, 6);
+    result = (pStream != nullptr && pStream->Write2(contents.GetBasePointer(), sizes[i]));
+    if (pStream != nullptr)
+      pStream->Release();
+
+    PODArray<byte> readContents;
+    readContents.Resize(sizes[i] + 1);
+    result = result && pArchive->CommitChanges();
+    pStream = result ? pArchive->OpenFile("random.txt", BYTESTREAM_OPEN_READ) : nullptr;
+    result = (pStream != nullptr && pStream->Read(readContents.GetBasePointer(), sizes[i] + 1) == sizes[i] &&
+              std::memcmp(readContents.GetBasePointer(), contents.GetBasePointer(), sizes[i]) == 0);
+    if (pStream != nullptr)
+      pStream->Release();
+
+    delete pArchive;
+    pMemoryStream->Release();
+  }
+
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: streamed finish");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: streamed finish");
+  return true;
+}
+
+static bool TestZstandard(ThreadPool* pThreadPool)
+{
+  // written through streams and WriteFiles, read back streamed, buffered and extracted
+  GrowableMemoryByteStream* pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+  ZipArchive* pArchive = ZipArchive::CreateArchive(pMemoryStream);
+  bool available = Compression::IsCodecAvailable(COMPRESSION_CODEC_ZSTD);
+  bool result = !pArchive->SetCompressionCodec(COMPRESSION_CODEC_LZ4) &&
+                pArchive->SetCompressionCodec(COMPRESSION_CODEC_ZSTD) == available;
+  if (result && available)
+  {
+    PODArray<byte> contents;
+    FillContents("bulk.txt", 50000, &contents);
+    ZipArchive::FileContents bulkFile = {"bulk.txt", contents.GetBasePointer(), contents.GetSize()};
+    result = WriteArchiveFiles(pArchive) && pArchive->WriteFiles(&bulkFile, 1, 3, pThreadPool) &&
+             CheckExtraction(pArchive, pThreadPool, "zstd") && CheckArchiveFile(pArchive, "bulk.txt", 50000, 0) &&
+             CheckArchiveFile(pArchive, "dir/b.txt", 70000, 0) &&
+             CheckArchiveFile(pArchive, "dir/b.txt", 70000, BYTESTREAM_OPEN_SEEKABLE) &&
+             CheckArchiveFile(pArchive, "empty.txt", 0, 0) && pArchive->CommitChanges() &&
+             pArchive->VerifyAll(pThreadPool);
+  }
+
+  delete pArchive;
+  pMemoryStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: zstandard entries");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: zstandard entries");
+  return true;
+}
+
+static bool CheckIndexedArchive(ZipArchive* pArchive)
+{
+  FILESYSTEM_STAT_DATA statData;
+  FileSystem::FindResultsArray results;
+  return pArchive != nullptr && CheckArchiveFile(pArchive, "a.txt", 100, 0) &&
+         CheckArchiveFile(pArchive, "dir/sub/c.bin", 12345, BYTESTREAM_OPEN_SEEKABLE) &&
+         CheckArchiveFile(pArchive, "stored.bin", 5000, 0) && pArchive->StatFile("DIR/B.txt", &statData) &&
+         statData.Size == 70000 && (statData.Attributes & FILESYSTEM_FILE_ATTRIBUTE_COMPRESSED) != 0 &&
+         !pArchive->StatFile("dir/missing.txt", &statData) &&
+         pArchive->FindFiles("dir", "*", FILESYSTEM_FIND_FILES | FILESYSTEM_FIND_RECURSIVE, &results) &&
+         results.GetSize() == 3 && pArchive->FindFiles("/DIR/sub", "*.BIN", FILESYSTEM_FIND_FILES, &results) &&
+         results.GetSize() == 2 && pArchive->FindFiles("dir", "*", FILESYSTEM_FIND_FILES, &results) &&
+         results.GetSize() == 1 && Y_strcmp(results[0].FileName, "dir/b.txt") == 0 &&
+         !pArchive->FindFiles("di", "*", FILESYSTEM_FIND_FILES | FILESYSTEM_FIND_RECURSIVE, &results);
+}
+
+static bool TestSavedIndex(ThreadPool* pThreadPool)
+{
+  // the index is saved after committing, which rebuilds it from what was written
+  GrowableMemoryByteStream* pArchiveStream = ByteStream_CreateGrowableMemoryStream();
+  GrowableMemoryByteStream* pIndexStream = ByteStream_CreateGrowableMemoryStream();
+  ZipArchive* pArchive = ZipArchive::CreateArchive(pArchiveStream);
+  bool result = WriteArchiveFiles(pArchive) && pArchive->CommitChanges() && CheckIndexedArchive(pArchive) &&
+                pArchive->SaveIndex(pIndexStream) && !pArchive->IsIndexLoaded();
+  delete pArchive;
+
+  // loaded in place from memory
+  pArchive = nullptr;
+  if (result && pIndexStream->SeekAbsolute(0))
+  {
+    pArchive = ZipArchive::OpenArchiveReadOnly(pArchiveStream, pIndexStream);
+    result = CheckIndexedArchive(pArchive) && pArchive->IsIndexLoaded() &&
+             CheckExtraction(pArchive, pThreadPool, "indexed");
+  }
+  else
+  {
+    result = false;
+  }
+
+  // and read from a file
+  PathString indexPath;
+  indexPath.Format("%s/archive.index", s_testDirectoryName);
+  ByteStream* pFileStream;
+  if (result && ByteStream_OpenFileStream(indexPath,
+                                          BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_CREATE_PATH | BYTESTREAM_OPEN_WRITE |
+                                            BYTESTREAM_OPEN_TRUNCATE | BYTESTREAM_OPEN_SEEKABLE,
+                                          &pFileStream))
+  {
+    result = pArchive->SaveIndex(pFileStream);
+    pFileStream->Release();
+  }
+  delete pArchive;
+
+  pArchive = nullptr;
+  if (result && ByteStream_OpenFileStream(indexPath, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_SEEKABLE, &pFileStream))
+  {
+    pArchive = ZipArchive::OpenArchiveReadOnly(pArchiveStream, pFileStream);
+    pFileStream->Release();
+    result = CheckIndexedArchive(pArchive) && pArchive->IsIndexLoaded();
+    delete pArchive;
+  }
+  else
+  {
+    result = false;
+  }
+
+  // a damaged index is ignored
+  ReadOnlyMemoryByteStream* pTruncatedStream =
+    ByteStream_CreateReadOnlyMemoryStream(pIndexStream->GetMemoryPointer(), (size_t)pIndexStream->GetSize() - 1);
+  pArchive = ZipArchive::OpenArchiveReadOnly(pArchiveStream, pTruncatedStream);
+  result = result && CheckIndexedArchive(pArchive) && !pArchive->IsIndexLoaded();
+  delete pArchive;
+  pTruncatedStream->Release();
+
+  // as is one for an archive that's changed since
+  GrowableMemoryByteStream* pChangedStream = ByteStream_CreateGrowableMemoryStream();
+  pArchive = ZipArchive::OpenArchiveReadWrite(pArchiveStream, pChangedStream);
+  result = result && pArchive != nullptr && pArchive->DeleteFile("empty.txt") && pArchive->CommitChanges();
+  delete pArchive;
+
+  pArchive = nullptr;
+  if (result && pIndexStream->SeekAbsolute(0))
+  {
+    FILESYSTEM_STAT_DATA statData;
+    pArchive = ZipArchive::OpenArchiveReadOnly(pChangedStream, pIndexStream);
+    result = CheckIndexedArchive(pArchive) && !pArchive->IsIndexLoaded() && !pArchive->StatFile("empty.txt", &statData);
+  }
+  else
+  {
+    result = false;
+  }
+
+  delete pArchive;
+  pChangedStream->Release();
+  pIndexStream->Release();
+  pArchiveStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: saved index");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: saved index");
+  return true;
+}
+
+static void CountArchiveFile(const char* filename, const FILESYSTEM_STAT_DATA* pStatData, void* pUserData)
+{
+  (*reinterpret_cast<uint32*>(pUserData))++;
+}
+
+static bool TestZip64(ThreadPool* pThreadPool)
+{
+  // more files than the end of central directory record can count, each holding its own name
+  static const uint32 fileCount = 70000;
+  static const uint32 nameSize = 16;
+  PODArray<char> names;
+  names.Resize(fileCount * nameSize);
+  PODArray<ZipArchive::FileContents> files;
+  files.Resize(fileCount);
+  for (uint32 i = 0; i < fileCount; i++)
+  {
+    char* name = names.GetBasePointer() + i * nameSize;
+    files[i].FileName = name;
+    files[i].pData = name;
+    files[i].Size = Y_snprintf(name, nameSize, "many/%u.txt", i);
+  }
+
+  GrowableMemoryByteStream* pArchiveStream = ByteStream_CreateGrowableMemoryStream();
+  ZipArchive* pArchive = ZipArchive::CreateArchive(pArchiveStream);
+  bool result = pArchive->WriteFiles(files.GetBasePointer(), fileCount, 0, pThreadPool) && pArchive->CommitChanges();
+  delete pArchive;
+
+  // the count is saturated in the end of central directory record, and read from the ZIP64 one
+  const byte* pEndOfCentralDirectory = pArchiveStream->GetMemoryPointer() + pArchiveStream->GetSize() - 22;
+  result = result && pArchiveStream->GetSize() > 22 && pEndOfCentralDirectory[10] == 0xFF &&
+           pEndOfCentralDirectory[11] == 0xFF;
+
+  pArchive = result ? ZipArchive::OpenArchiveReadOnly(pArchiveStream) : nullptr;
+  uint32 foundCount = 0;
+  if (pArchive != nullptr)
+  {
+    pArchive->EnumerateFiles(CountArchiveFile, &foundCount);
+
+    char contents[nameSize];
+    ByteStream* pStream = pArchive->OpenFile("many/69999.txt", BYTESTREAM_OPEN_READ);
+    result = (foundCount == fileCount && pStream != nullptr && pStream->Read(contents, sizeof(contents)) == 14 &&
+              std::memcmp(contents, "many/69999.txt", 14) == 0);
+    if (pStream != nullptr)
+      pStream->Release();
+  }
+  else
+  {
+    result = false;
+  }
+
+  delete pArchive;
+  pArchiveStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrintf("FAIL: zip64 (%u of %u files)", foundCount, fileCount);
+    return false;
+  }
+
+  Log_InfoPrint("PASS: zip64");
+  return true;
+}
+
+static bool WriteArchiveFile(ZipArchive* pArchive, const char* fileName, uint32 size)
+{
+  PODArray<byte> contents;
+  FillContents(fileName, size, &contents);
+  ByteStream* pStream = pArchive->OpenFile(fileName, BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_WRITE);
+  if (pStream == nullptr)
+    return false;
+
+  bool result = pStream->Write2(contents.GetBasePointer(), size);
+  pStream->Release();
+  return result;
+}
+
+// the files after appending to an archive from WriteArchiveFiles
+static bool CheckAppendedArchive(ZipArchive* pArchive)
+{
+  FILESYSTEM_STAT_DATA statData;
+  return pArchive != nullptr && CheckArchiveFile(pArchive, "a.txt", 200, 0) &&
+         CheckArchiveFile(pArchive, "new.txt", 3000, 0) && CheckArchiveFile(pArchive, "dir/b.txt", 70000, 0) &&
+         CheckArchiveFile(pArchive, "big/huge.bin", 33 * 1024 * 1024, BYTESTREAM_OPEN_STREAMED) &&
+         !pArchive->StatFile("empty.txt", &statData) && !pArchive->StatFile("discarded.txt", &statData);
+}
+
+// opens the test files in an order of their own, with a missing and a repeated file
+static bool CheckBatchOpen(ZipArchive* pArchive, ThreadPool* pThreadPool)
+{
+  static const char* fileNames[] = {"dir/sub/c.bin", "missing.txt", "a.txt",   "big/huge.bin",      "empty.txt",
+                                    "stored.bin",    "dir/b.txt",   "a.txt",   "dir/sub/empty.bin"};
+  ByteStream* pStreams[countof(fileNames)];
+  bool result = (pArchive->OpenFiles(fileNames, countof(fileNames), pStreams, pThreadPool) == countof(fileNames) - 1);
+  for (uint32 i = 0; i < countof(fileNames); i++)
+  {
+    uint32 size = 0;
+    for (uint32 j = 0; j < countof(s_testFiles); j++)
+    {
+      if (Y_strcmp(s_testFiles[j].FileName, fileNames[i]) == 0)
+        size = s_testFiles[j].Size;
+    }
+
+    if (pStreams[i] == nullptr)
+    {
+      result &= (Y_strcmp(fileNames[i], "missing.txt") == 0);
+      continue;
+    }
+
+    result &= CheckStreamContents(pStreams[i], fileNames[i], size);
+    pStreams[i]->Release();
+  }
+
+  return result;
+}
+
+static bool TestBatchOpen(ThreadPool* pThreadPool)
+{
+  // from an archive on disk, read in runs, and from one in memory, decompressed in place
+  PathString archivePath;
+  archivePath.Format("%s/batch.zip", s_testDirectoryName);
+  ByteStream* pFileStream;
+  bool result = ByteStream_OpenFileStream(archivePath,
+                                          BYTESTREAM_OPEN_CREATE | BYTESTREAM_OPEN_CREATE_PATH | BYTESTREAM_OPEN_WRITE |
+                                            BYTESTREAM_OPEN_TRUNCATE | BYTESTREAM_OPEN_SEEKABLE,
+                                          &pFileStream);
+  if (result)
+  {
+    ZipArchive* pArchive = ZipArchive::CreateArchive(pFileStream);
+    result = WriteArchiveFiles(pArchive) && pArchive->CommitChanges();
+    delete pArchive;
+    pFileStream->Release();
+  }
+
+  ZipArchive* pArchive = nullptr;
+  if (result && ByteStream_OpenFileStream(archivePath, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_SEEKABLE, &pFileStream))
+  {
+    pArchive = ZipArchive::OpenArchiveReadOnly(pFileStream);
+    pFileStream->Release();
+  }
+
+  result = pArchive != nullptr && CheckBatchOpen(pArchive, pThreadPool) && CheckBatchOpen(pArchive, nullptr);
+  delete pArchive;
+
+  GrowableMemoryByteStream* pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+  pArchive = ZipArchive::CreateArchive(pMemoryStream);
+  result = result && WriteArchiveFiles(pArchive) && pArchive->CommitChanges() &&
+           CheckBatchOpen(pArchive, pThreadPool);
+  delete pArchive;
+
+  // files appended and not yet committed are found as well
+  pArchive = result ? ZipArchive::OpenArchiveForAppend(pMemoryStream) : nullptr;
+  result = pArchive != nullptr && WriteArchiveFile(pArchive, "a.txt", 200);
+  const char* newFileName = "a.txt";
+  ByteStream* pStream;
+  result = result && pArchive->OpenFiles(&newFileName, 1, &pStream, pThreadPool) == 1 &&
+           CheckStreamContents(pStream, "a.txt", 200);
+  if (result)
+    pStream->Release();
+
+  delete pArchive;
+  pMemoryStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: batch open");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: batch open");
+  return true;
+}
+
+// counts the errors it's shown
+class ErrorCountingProgressCallbacks : public BaseProgressCallbacks
+{
+public:
+  ErrorCountingProgressCallbacks() : m_errorCount(0) {}
+
+  uint32 GetErrorCount() const { return m_errorCount; }
+  uint32 GetValue() const { return m_progressValue; }
+
+  virtual void DisplayError(const char* message) override { m_errorCount++; }
+  virtual void DisplayWarning(const char* message) override {}
+  virtual void DisplayInformation(const char* message) override {}
+  virtual void DisplayDebugMessage(const char* message) override {}
+  virtual void ModalError(const char* message) override {}
+  virtual bool ModalConfirmation(const char* message) override { return false; }
+  virtual uint32 ModalPrompt(const char* message, uint32 nOptions, ...) override { return 0; }
+
+private:
+  uint32 m_errorCount;
+};
+
+// the offset of the first match of what in the memory, or -1
+static int64 FindBytes(const byte* pMemory, uint64 size, const void* pWhat, uint32 whatSize)
+{
+  for (uint64 i = 0; i + whatSize <= size; i++)
+  {
+    if (std::memcmp(pMemory + i, pWhat, whatSize) == 0)
+      return (int64)i;
+  }
+
+  return -1;
+}
+
+static bool TestVerify(ThreadPool* pThreadPool)
+{
+  // the archive from the batch open test, on disk
+  PathString archivePath;
+  archivePath.Format("%s/batch.zip", s_testDirectoryName);
+  ByteStream* pFileStream;
+  ZipArchive* pArchive = nullptr;
+  if (ByteStream_OpenFileStream(archivePath, BYTESTREAM_OPEN_READ | BYTESTREAM_OPEN_SEEKABLE, &pFileStream))
+  {
+    pArchive = ZipArchive::OpenArchiveReadOnly(pFileStream);
+    pFileStream->Release();
+  }
+
+  ErrorCountingProgressCallbacks callbacks;
+  bool result = pArchive != nullptr && pArchive->VerifyAll(pThreadPool, &callbacks) &&
+                callbacks.GetErrorCount() == 0 && callbacks.GetValue() == countof(s_testFiles);
+  delete pArchive;
+
+  // a stored file's data and a deflated file's CRC damaged in memory
+  GrowableMemoryByteStream* pMemoryStream = ByteStream_CreateGrowableMemoryStream();
+  pArchive = ZipArchive::CreateArchive(pMemoryStream);
+  result = result && WriteArchiveFiles(pArchive) && pArchive->CommitChanges() && pArchive->VerifyAll(nullptr);
+  delete pArchive;
+
+  PODArray<byte> storedContents;
+  FillContents("stored.bin", 5000, &storedContents);
+  byte* pMemory = pMemoryStream->GetMemoryPointer();
+  int64 storedOffset = FindBytes(pMemory, pMemoryStream->GetSize(), storedContents.GetBasePointer(), 5000);
+  int64 nameOffset = FindBytes(pMemory, pMemoryStream->GetSize(), "dir/b.txt", 9);
+  result = result && storedOffset >= 0 && nameOffset >= 16;
+  if (result)
+  {
+    pMemory[storedOffset + 2500] ^= 0xFF;
+
+    // the CRC is 16 bytes before the name in the local header
+    pMemory[nameOffset - 16] ^= 0xFF;
+  }
+
+  pArchive = result ? ZipArchive::OpenArchiveReadOnly(pMemoryStream) : nullptr;
+  ErrorCountingProgressCallbacks damagedCallbacks;
+  result = pArchive != nullptr && !pArchive->VerifyAll(pThreadPool, &damagedCallbacks) &&
+           damagedCallbacks.GetErrorCount() == 2;
+  delete pArchive;
+  pMemoryStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: verification");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: verification");
+  return true;
+}
+
+static bool TestAppend()
+{
+  GrowableMemoryByteStream* pArchiveStream = ByteStream_CreateGrowableMemoryStream();
+  ZipArchive* pArchive = ZipArchive::CreateArchive(pArchiveStream);
+  bool result = WriteArchiveFiles(pArchive) && pArchive->CommitChanges();
+  delete pArchive;
+  uint64 originalSize = pArchiveStream->GetSize();
+
+  // adding, replacing and deleting files only writes the new files and a central directory
+  pArchive = result ? ZipArchive::OpenArchiveForAppend(pArchiveStream) : nullptr;
+  result = pArchive != nullptr && pArchive->IsAppending() && WriteArchiveFile(pArchive, "a.txt", 200) &&
+           WriteArchiveFile(pArchive, "new.txt", 3000) && pArchive->DeleteFile("empty.txt") &&
+           pArchive->CommitChanges() && pArchive->IsWritable() && CheckAppendedArchive(pArchive) &&
+           pArchiveStream->GetSize() < originalSize + 64 * 1024;
+
+  // committing nothing leaves the stream alone, discarding writes the central directory after what was discarded
+  uint64 appendedSize = pArchiveStream->GetSize();
+  result = result && pArchive->CommitChanges() && pArchiveStream->GetSize() == appendedSize &&
+           WriteArchiveFile(pArchive, "discarded.txt", 1000) && pArchive->DeleteFile("new.txt") &&
+           pArchive->DiscardChanges() && pArchive->IsWritable() && CheckAppendedArchive(pArchive);
+  delete pArchive;
+
+  pArchive = result ? ZipArchive::OpenArchiveReadOnly(pArchiveStream) : nullptr;
+  result = CheckAppendedArchive(pArchive);
+  delete pArchive;
+
+  // compacting drops the replaced and discarded files and the old central directories
+  GrowableMemoryByteStream* pCompactedStream = ByteStream_CreateGrowableMemoryStream();
+  result = result && ZipArchive::CompactArchive(pArchiveStream, pCompactedStream) &&
+           pCompactedStream->GetSize() < pArchiveStream->GetSize();
+
+  pArchive = result ? ZipArchive::OpenArchiveReadOnly(pCompactedStream) : nullptr;
+  result = CheckAppendedArchive(pArchive);
+  delete pArchive;
+
+  pCompactedStream->Release();
+  pArchiveStream->Release();
+  if (!result)
+  {
+    Log_ErrorPrint("FAIL: appending");
+    return false;
+  }
+
+  Log_InfoPrint("PASS: appending");
+  return true;
+}
+
+#endif
+
+DEFINE_TEST_SUITE(ZipArchive)
+{
+#ifdef HAVE_ZLIB
+  FileSystem::DeleteDirectory(s_testDirectoryName, true);
+
+  ThreadPool threadPool(4);
+  bool result = TestExtraction(&threadPool) && TestBatchOpen(&threadPool) && TestVerify(&threadPool) &&
+                TestParallelCompression(&threadPool) && TestStoredInPlace() && TestUnsafeNames() &&
+                TestStreamedFinish() && TestZstandard(&threadPool) && TestSavedIndex(&threadPool) &&
+                TestZip64(&threadPool) && TestAppend();
+
+  FileSystem::DeleteDirectory(s_testDirectoryName, true);
+  return result;
+#else
+  return true;
+#endif
+}